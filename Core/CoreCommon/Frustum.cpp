@@ -2,6 +2,8 @@
 #include <assert.h>
 #include <math.h>
 #include <memory.h>
+#include <DirectXMath.h>     // for _XM_SSE_INTRINSICS_
+#include <intrin.h>          // for _BitScanForward
 
 //---------------------------------------
 // Desc:   helpers to get a square of input value
@@ -307,3 +309,185 @@ bool Frustum::CubeTest(
 
     return false;
 }
+
+//---------------------------------------------------------
+// Desc:   classify the axis-aligned bounding box against the frustum
+//         (in the same space as the frustum planes)
+// Args:   - cx,cy,cz: center of the box
+//         - ex,ey,ez: half of the box size along each axis
+// Ret:    DISJOINT if the box is fully behind any plane, CONTAINS if
+//         it is in front of all the planes, and INTERSECTS otherwise
+//---------------------------------------------------------
+eContainmentType Frustum::AABBTest(
+    const float cx, const float cy, const float cz,
+    const float ex, const float ey, const float ez) const
+{
+    bool intersects = false;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        const Vec3& n = planes_[i].n;
+
+        // the projected radius of the box onto the plane's normal
+        const float r    = (ex * fabsf(n.x)) + (ey * fabsf(n.y)) + (ez * fabsf(n.z));
+        const float dist = Dot(n, { cx,cy,cz }) + planes_[i].d;
+
+        if (dist < -r)
+            return DISJOINT;
+
+        intersects |= (dist < r);
+    }
+
+    return (intersects) ? INTERSECTS : CONTAINS;
+}
+
+//---------------------------------------------------------
+// Desc:   a kernel of batched sphere test: a sphere is visible if it isn't
+//         fully behind any plane: dot(n, center) + d >= -radius
+// Args:   - radiuses: radius per sphere (if UNIFORM_RADIUS == false)
+//         - radius:   the same radius for all the spheres (if UNIFORM_RADIUS == true)
+// Ret:    the number of visible spheres (their idxs are stored into outVisIdxs)
+//---------------------------------------------------------
+template <bool UNIFORM_RADIUS>
+static int SphereTestBatchKernel(
+    const FrustumPlane* planes,
+    const float* xs,
+    const float* ys,
+    const float* zs,
+    const float* radiuses,
+    const float radius,
+    const int count,
+    int* outVisIdxs)
+{
+    assert(xs && ys && zs && outVisIdxs);
+    assert(UNIFORM_RADIUS || radiuses);
+
+    int numVisible = 0;
+    int i = 0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+    __m128 nx[6], ny[6], nz[6], d[6];
+
+    for (int p = 0; p < 6; ++p)
+    {
+        nx[p] = _mm_set1_ps(planes[p].n.x);
+        ny[p] = _mm_set1_ps(planes[p].n.y);
+        nz[p] = _mm_set1_ps(planes[p].n.z);
+        d[p]  = _mm_set1_ps(planes[p].d);
+    }
+
+    const __m128 uniformNegR = _mm_set1_ps(-radius);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 x    = _mm_loadu_ps(xs + i);
+        const __m128 y    = _mm_loadu_ps(ys + i);
+        const __m128 z    = _mm_loadu_ps(zs + i);
+        const __m128 negR = (UNIFORM_RADIUS) ? uniformNegR : _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radiuses + i));
+
+        // all the lanes are visible until some plane culls them
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 dist = _mm_add_ps(_mm_mul_ps(nx[p], x), d[p]);
+            dist = _mm_add_ps(_mm_mul_ps(ny[p], y), dist);
+            dist = _mm_add_ps(_mm_mul_ps(nz[p], z), dist);
+
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(dist, negR));
+        }
+
+        // compact idxs of visible lanes
+        int mask = _mm_movemask_ps(visible);
+
+        while (mask)
+        {
+            unsigned long lane;
+            _BitScanForward(&lane, (unsigned long)mask);
+            outVisIdxs[numVisible++] = i + (int)lane;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // the rest of elements (or all of them if there is no SSE)
+    for (; i < count; ++i)
+    {
+        const float negR = (UNIFORM_RADIUS) ? -radius : -radiuses[i];
+        bool isVisible = true;
+
+        for (int p = 0; p < 6; ++p)
+            isVisible &= (Dot(planes[p].n, { xs[i], ys[i], zs[i] }) + planes[p].d >= negR);
+
+        outVisIdxs[numVisible] = i;
+        numVisible += isVisible;
+    }
+
+    return numVisible;
+}
+
+//---------------------------------------------------------
+// Desc:   batched test of spheres against the frustum
+// Args:   - xs, ys, zs:  arrays of spheres centers (SoA)
+//         - radiuses:    array of spheres radiuses
+//         - count:       the number of spheres
+//         - outVisIdxs:  output arr of visible spheres idxs (must have space for count elements)
+// Ret:    the number of visible spheres
+//---------------------------------------------------------
+int Frustum::SphereTestBatch(
+    const float* xs,
+    const float* ys,
+    const float* zs,
+    const float* radiuses,
+    const int count,
+    int* outVisIdxs) const
+{
+    return SphereTestBatchKernel<false>(planes_, xs, ys, zs, radiuses, 0.0f, count, outVisIdxs);
+}
+
+//---------------------------------------------------------
+// Desc:   batched test of spheres (with the same radius) against the frustum
+//---------------------------------------------------------
+int Frustum::SphereTestBatch(
+    const float* xs,
+    const float* ys,
+    const float* zs,
+    const float radius,
+    const int count,
+    int* outVisIdxs) const
+{
+    return SphereTestBatchKernel<true>(planes_, xs, ys, zs, nullptr, radius, count, outVisIdxs);
+}
+
+//---------------------------------------------------------
+// Desc:   batched test of axis-aligned cubes against the frustum:
+//         the cube is culled if it is fully behind any plane,
+//         so its projected radius onto the plane normal is:
+//         halfSize * (|nx| + |ny| + |nz|)
+// Args:   - xs, ys, zs:  arrays of cubes centers (SoA)
+//         - halfSize:    half of the cube size along each axis
+//         - count:       the number of cubes
+//         - outVisIdxs:  output arr of visible cubes idxs (must have space for count elements)
+// Ret:    the number of visible cubes
+//---------------------------------------------------------
+int Frustum::CubeTestBatch(
+    const float* xs,
+    const float* ys,
+    const float* zs,
+    const float halfSize,
+    const int count,
+    int* outVisIdxs) const
+{
+    // the projected radius is different per plane so we test with
+    // a plane which was shifted by this radius: dot(n, c) + (d + r) >= 0
+    FrustumPlane shifted[6];
+
+    for (int p = 0; p < 6; ++p)
+    {
+        const Vec3& n = planes_[p].n;
+        shifted[p]    = planes_[p];
+        shifted[p].d += halfSize * (fabsf(n.x) + fabsf(n.y) + fabsf(n.z));
+    }
+
+    return SphereTestBatchKernel<true>(shifted, xs, ys, zs, nullptr, 0.0f, count, outVisIdxs);
+}
@@ -92,6 +92,41 @@ public:
     bool SphereTest(const float x, const float y, const float z, const float radius);
     bool CubeTest  (const float x, const float y, const float z, const float size);
 
+    // is used for hierarchical culling: CONTAINS means all the children are visible too
+    eContainmentType AABBTest(
+        const float cx, const float cy, const float cz,
+        const float ex, const float ey, const float ez) const;
+
+    // BATCHED TESTS: input data is in SoA layout and is tested by 4 elements per iteration;
+    // idxs of visible elements are written (compacted) into outVisIdxs which must have
+    // space for count elements; return the number of visible elements
+    int SphereTestBatch(
+        const float* xs,
+        const float* ys,
+        const float* zs,
+        const float* radiuses,
+        const int count,
+        int* outVisIdxs) const;
+
+    // the same but all the spheres have the same radius
+    int SphereTestBatch(
+        const float* xs,
+        const float* ys,
+        const float* zs,
+        const float radius,
+        const int count,
+        int* outVisIdxs) const;
+
+    // NOTE: cube is visible if it isn't fully behind any plane (so it is a conservative
+    //       test unlike the CubeTest which checks only vertices of the cube)
+    int CubeTestBatch(
+        const float* xs,
+        const float* ys,
+        const float* zs,
+        const float halfSize,
+        const int count,
+        int* outVisIdxs) const;
+
 
 public:
     FrustumPlane planes_[6];
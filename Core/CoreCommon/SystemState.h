@@ -16,6 +16,11 @@ namespace Core
 class SystemState
 {
 public:
+	static constexpr int MAX_NUM_GPU_PASSES   = 16;
+	static constexpr int MAX_NUM_BIND_TYPES   = 8;
+	static constexpr int MAX_NUM_UPLOAD_TYPES = 8;
+	static constexpr int MAX_NUM_WORKERS      = 32;
+
 	bool isEditorMode = true;                // to define if we want to render the engine's GUI onto the screen
 	bool isShowDbgInfo = false;              // show/hide debug text info in the game mode
 	bool intersect = false;                  // the flag to define if we clicked on some model or not
@@ -23,21 +28,67 @@ public:
 	int mouseX = 0;                          // the mouse cursor X position in the window
 	int mouseY = 0;                          // the mouse cursor Y position in the window
 	int fps = 0;                             // framerate
-	int cpu = 0;                             // cpu performance
+	int cpu = 0;                             // cpu usage by the process (% of all the cores)
 	int wndWidth_  = 800;                    // current width of the main window 
 	int wndHeight_ = 600;                    // current height of the main window
 				
 	uint32_t visibleVerticesCount = 0;            // the number of rendered vertices for this frame
 	uint32_t visibleObjectsCount = 0;             // the number of rendered models for this frame
 	uint32_t numVisiblePointLights = 0;
+	uint32_t numVisibleSpotLights = 0;
 	uint32_t cellsDrawn = 0;                      // the number of rendered terrain cells
 	uint32_t cellsCulled = 0;                     // the number of culled terrain cells
 	uint32_t pickedEnttID_ = 0;                   // currently chosen entity (its ID)
+	uint32_t numBindsIssued = 0;                  // the number of state binds which went to the driver for the last frame
+	uint32_t numBindsFiltered = 0;                // the number of skipped redundant binds for the last frame
 
     float deltaTime = 0.0f;                  // seconds per last frame
 	float frameTime = 0.0f;                  // ms per last frame
+	float frameTimeP50 = 0.0f;               // percentiles of frame times (ms) over the last frames
+	float frameTimeP95 = 0.0f;
+	float frameTimeP99 = 0.0f;
     float updateTime = 0.0f;                 // duration time of the whole update process
     float renderTime = 0.0f;                 // duration time of the whole rendering process
+
+	// GPU time (ms) of the frame and its passes (averaged, see Render::GpuProfiler)
+	float gpuFrameTime = 0.0f;
+	float gpuPassTimes[MAX_NUM_GPU_PASSES]{ 0.0f };
+	const char* gpuPassNames[MAX_NUM_GPU_PASSES]{ nullptr };
+	int numGpuPasses = 0;
+
+	// render workload of the last frame (see Render::FrameStats): in total and by passes
+	uint32_t numDrawCalls = 0;
+	uint32_t numIndirectDraws = 0;               // their instances/primitives aren't known on the CPU
+	uint32_t numInstances = 0;
+	uint64_t numPrimitives = 0;                  // triangles (or lines/points)
+	uint32_t gpuPassDraws[MAX_NUM_GPU_PASSES]{ 0 };
+	uint32_t gpuPassInstances[MAX_NUM_GPU_PASSES]{ 0 };
+	uint64_t gpuPassPrimitives[MAX_NUM_GPU_PASSES]{ 0 };
+
+	// state binds of the last frame by types (see Render::StateCache)
+	uint32_t bindsIssued[MAX_NUM_BIND_TYPES]{ 0 };
+	uint32_t bindsFiltered[MAX_NUM_BIND_TYPES]{ 0 };
+	const char* bindTypeNames[MAX_NUM_BIND_TYPES]{ nullptr };
+	int numBindTypes = 0;
+
+	// mapped bytes of the last frame by types of buffers and texture uploads
+	uint64_t uploadBytes[MAX_NUM_UPLOAD_TYPES]{ 0 };
+	uint32_t uploadMaps[MAX_NUM_UPLOAD_TYPES]{ 0 };
+	const char* uploadTypeNames[MAX_NUM_UPLOAD_TYPES]{ nullptr };
+	int numUploadTypes = 0;
+	uint64_t texUploadBytes = 0;
+	uint32_t texUploadTiles = 0;
+
+	// telemetry of the process (is sampled once per second, see TelemetrySampler)
+	float workerCpu[MAX_NUM_WORKERS]{ 0.0f };    // % of a single core by each job system worker
+	int numWorkers = 0;
+	uint64_t workingSetBytes = 0;
+	uint64_t committedBytes = 0;
+	uint64_t videoMemUsage = 0;                  // local (dedicated) video memory
+	uint64_t videoMemBudget = 0;
+	uint64_t sharedVideoMemUsage = 0;            // non-local (shared system) memory
+	uint64_t sharedVideoMemBudget = 0;
+
 	DirectX::XMFLOAT3 cameraPos;             // the current position of the currently main camera
 	DirectX::XMFLOAT3 cameraDir;             // the current rotation of the currently main camera
 	DirectX::XMMATRIX cameraView;            // view matrix of the currently main camera
@@ -0,0 +1,472 @@
+// =================================================================================
+// Filename:     AssetHotReloader.cpp
+// Description:  implementation of the AssetHotReloader's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "AssetHotReloader.h"
+
+#include "../Texture/TextureMgr.h"
+#include "../Model/ModelMgr.h"
+
+#include <AssetPack.h>
+
+
+namespace Core
+{
+
+// reload only after this time since the last change (editors save files by several writes)
+static constexpr uint64 CHANGES_SETTLE_TIME_MS = 300;
+
+//---------------------------------------------------------
+// Desc:  get the current time in milliseconds (steady clock)
+//---------------------------------------------------------
+static uint64 GetTimeMs()
+{
+    using namespace std::chrono;
+    return (uint64)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+///////////////////////////////////////////////////////////
+
+AssetHotReloader::~AssetHotReloader()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool AssetHotReloader::Initialize(const char* dataDirPath)
+{
+    if (StrHelper::IsEmpty(dataDirPath))
+    {
+        LogErr("input path to the data directory is empty");
+        return false;
+    }
+
+    // paths of changed files are prefixed by the dir path (with a trailing slash)
+    strncpy(dirPath_, dataDirPath, sizeof(dirPath_) - 2);
+    const size_t len = strlen(dirPath_);
+
+    if ((dirPath_[len - 1] != '/') && (dirPath_[len - 1] != '\\'))
+        dirPath_[len] = '/';
+
+    // (is opened for overlapped reads so the watcher can be stopped at any moment)
+    hDir_ = CreateFileA(
+        dirPath_,
+        FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+        nullptr);
+
+    if (hDir_ == INVALID_HANDLE_VALUE)
+    {
+        sprintf(g_String, "can't watch the data directory (assets hot reload is off): %s", dirPath_);
+        LogErr(g_String);
+        return false;
+    }
+
+    hStopEvent_ = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    watcher_    = std::thread(&AssetHotReloader::WatchLoop, this);
+
+    LogMsgf("assets hot reload: watching %s", dirPath_);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void AssetHotReloader::Shutdown()
+{
+    if (watcher_.joinable())
+    {
+        SetEvent(hStopEvent_);
+        watcher_.join();
+    }
+
+    if (hStopEvent_)
+    {
+        CloseHandle(hStopEvent_);
+        hStopEvent_ = nullptr;
+    }
+
+    if (hDir_ != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(hDir_);
+        hDir_ = INVALID_HANDLE_VALUE;
+    }
+
+    // jobs of reloading are owned (and waited) by the texture/model managers
+    nodes_.clear();
+    fileToNodes_.clear();
+    changedFiles_.clear();
+    numActive_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+int AssetHotReloader::AddNode(
+    const char* name,
+    ReloadFunc&& func,
+    std::initializer_list<const char*> filePaths,
+    std::initializer_list<int> deps)
+{
+    const int nodeIdx = (int)nodes_.size();
+
+    Node node;
+    node.type = ASSET_NODE_CUSTOM;
+    node.name = (name) ? name : "";
+    node.func = std::move(func);
+
+    for (const int depIdx : deps)
+    {
+        // a dependency must be added before the node (so there are no cycles)
+        if ((depIdx < 0) || (depIdx >= nodeIdx))
+        {
+            sprintf(g_String, "hot reload node '%s': wrong idx of dependency: %d", node.name.c_str(), depIdx);
+            LogErr(g_String);
+            continue;
+        }
+
+        node.deps.push_back(depIdx);
+        nodes_[depIdx].dependents.push_back(nodeIdx);
+    }
+
+    nodes_.push_back(std::move(node));
+
+    for (const char* filePath : filePaths)
+    {
+        if (!StrHelper::IsEmpty(filePath))
+            fileToNodes_.emplace(AssetPack::HashPath(filePath), nodeIdx);
+    }
+
+    return nodeIdx;
+}
+
+///////////////////////////////////////////////////////////
+
+int AssetHotReloader::AddTextureNode(const TexID id)
+{
+    // the file of the texture is its name (it is resolved when the file is changed)
+    const int nodeIdx = FindAssetNode(ASSET_NODE_TEXTURE, id);
+
+    if (nodeIdx >= 0)
+        return nodeIdx;
+
+    return AddAssetNode(ASSET_NODE_TEXTURE, id, g_TextureMgr.GetTexByID(id).GetName().c_str());
+}
+
+///////////////////////////////////////////////////////////
+
+int AssetHotReloader::AddModelNode(const ModelID id)
+{
+    // the .de3d file of the model is resolved by the model manager when it is changed
+    const int nodeIdx = FindAssetNode(ASSET_NODE_MODEL, id);
+
+    if (nodeIdx >= 0)
+        return nodeIdx;
+
+    return AddAssetNode(ASSET_NODE_MODEL, id, g_ModelMgr.GetModelByID(id).GetName());
+}
+
+///////////////////////////////////////////////////////////
+
+void AssetHotReloader::RequestReload(const char* filePath)
+{
+    if (StrHelper::IsEmpty(filePath))
+        return;
+
+    std::lock_guard<std::mutex> lock(changesMutex_);
+    changedFiles_.push_back(filePath);
+    isChanged_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void AssetHotReloader::Update()
+{
+    // a new batch of changes is taken only when the prev one is reloaded
+    // (so a node is never marked while it is being reloaded)
+    if (numActive_ == 0)
+    {
+        if (isOverflow_.exchange(false))
+            LogErr("assets hot reload: too many changes at once (some of them are lost)");
+
+        const bool isSettled = isChanged_ && (GetTimeMs() - lastChangeTimeMs_ >= CHANGES_SETTLE_TIME_MS);
+
+        if (!isSettled)
+            return;
+
+        MarkChangedFiles();
+
+        if (numActive_ == 0)
+            return;
+
+        numReloaded_  = 0;
+        batchStartMs_ = GetTimeMs();
+    }
+
+    // dependencies of a node always have smaller idxs so a node which is reloaded
+    // synchronously lets its dependents be started during the same pass
+    for (int i = 0; i < (int)nodes_.size(); ++i)
+    {
+        Node& node = nodes_[i];
+
+        if (node.state == ASSET_NODE_RELOADING)
+        {
+            if (IsReloadDone(node))
+            {
+                node.state = ASSET_NODE_IDLE;
+                --numActive_;
+            }
+            continue;
+        }
+
+        if (node.state != ASSET_NODE_DIRTY)
+            continue;
+
+        bool areDepsReloaded = true;
+
+        for (const int depIdx : node.deps)
+            areDepsReloaded &= (nodes_[depIdx].state == ASSET_NODE_IDLE);
+
+        if (!areDepsReloaded)
+            continue;
+
+        // a node which is failed to be reloaded keeps its prev version
+        if (!StartReload(node))
+        {
+            sprintf(g_String, "assets hot reload: can't reload (the prev version is kept): %s", node.name.c_str());
+            LogErr(g_String);
+            node.state = ASSET_NODE_IDLE;
+            --numActive_;
+            continue;
+        }
+
+        ++numReloaded_;
+
+        if (node.type == ASSET_NODE_CUSTOM)
+        {
+            node.state = ASSET_NODE_IDLE;
+            --numActive_;
+        }
+        else
+        {
+            node.state = ASSET_NODE_RELOADING;
+        }
+    }
+
+    if (numActive_ == 0)
+        LogMsgf("assets hot reload: %d objects are reloaded (%d ms)", numReloaded_, (int)(GetTimeMs() - batchStartMs_));
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+void AssetHotReloader::WatchLoop()
+{
+    // collect paths of written files; which engine objects are made of them
+    // is defined by the main thread when changes are settled
+
+    alignas(DWORD) uint8 buffer[16384];
+    OVERLAPPED           overlapped{};
+    overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+    const HANDLE events[2] = { overlapped.hEvent, hStopEvent_ };
+    const DWORD  filter    = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME;
+    char         name[MAX_PATH]{ '\0' };
+
+    while (true)
+    {
+        ResetEvent(overlapped.hEvent);
+
+        if (!ReadDirectoryChangesW(hDir_, buffer, sizeof(buffer), TRUE, filter, nullptr, &overlapped, nullptr))
+            break;
+
+        const DWORD waitResult = WaitForMultipleObjects(2, events, FALSE, INFINITE);
+        DWORD       numBytes   = 0;
+
+        if (waitResult != WAIT_OBJECT_0)
+        {
+            // we're stopped: cancel the pending read and wait until it's really cancelled
+            CancelIo(hDir_);
+            GetOverlappedResult(hDir_, &overlapped, &numBytes, TRUE);
+            break;
+        }
+
+        GetOverlappedResult(hDir_, &overlapped, &numBytes, FALSE);
+
+        // the buffer is overflowed so names of changed files are lost
+        if (numBytes == 0)
+        {
+            isOverflow_ = true;
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(changesMutex_);
+
+        for (const uint8* pEntry = buffer; ;)
+        {
+            const FILE_NOTIFY_INFORMATION& info = *(const FILE_NOTIFY_INFORMATION*)pEntry;
+
+            // editors often save by writing a temp file and renaming it
+            const bool isWritten =
+                (info.Action == FILE_ACTION_MODIFIED) ||
+                (info.Action == FILE_ACTION_ADDED) ||
+                (info.Action == FILE_ACTION_RENAMED_NEW_NAME);
+
+            if (isWritten)
+            {
+                const int numChars = (int)(info.FileNameLength / sizeof(WCHAR));
+                const int len      = WideCharToMultiByte(CP_UTF8, 0, info.FileName, numChars, name, sizeof(name) - 1, nullptr, nullptr);
+
+                if (len > 0)
+                {
+                    name[len] = '\0';
+                    changedFiles_.push_back(std::string(dirPath_) + name);
+                }
+            }
+
+            if (info.NextEntryOffset == 0)
+                break;
+
+            pEntry += info.NextEntryOffset;
+        }
+
+        lastChangeTimeMs_ = GetTimeMs();
+        isChanged_        = true;
+    }
+
+    CloseHandle(overlapped.hEvent);
+}
+
+///////////////////////////////////////////////////////////
+
+int AssetHotReloader::FindAssetNode(const eNodeType type, const uint32 assetID) const
+{
+    for (int i = 0; i < (int)nodes_.size(); ++i)
+    {
+        if ((nodes_[i].type == type) && (nodes_[i].assetID == assetID))
+            return i;
+    }
+
+    return -1;
+}
+
+///////////////////////////////////////////////////////////
+
+int AssetHotReloader::AddAssetNode(const eNodeType type, const uint32 assetID, const char* name)
+{
+    Node node;
+    node.type    = type;
+    node.assetID = assetID;
+    node.name    = (name) ? name : "";
+
+    nodes_.push_back(std::move(node));
+    return (int)nodes_.size() - 1;
+}
+
+///////////////////////////////////////////////////////////
+
+void AssetHotReloader::MarkChangedFiles()
+{
+    std::vector<std::string> changedFiles;
+    {
+        std::lock_guard<std::mutex> lock(changesMutex_);
+        changedFiles.swap(changedFiles_);
+        isChanged_ = false;
+    }
+
+    // a file is usually written several times so it's in the list several times
+    std::sort(changedFiles.begin(), changedFiles.end());
+    changedFiles.erase(std::unique(changedFiles.begin(), changedFiles.end()), changedFiles.end());
+
+    for (const std::string& filePath : changedFiles)
+        MarkFile(filePath.c_str());
+}
+
+///////////////////////////////////////////////////////////
+
+void AssetHotReloader::MarkFile(const char* filePath)
+{
+    // mark nodes which are made of the file
+    const auto range = fileToNodes_.equal_range(AssetPack::HashPath(filePath));
+
+    for (auto it = range.first; it != range.second; ++it)
+        MarkDirty(it->second);
+
+    // and assets which are loaded from it (their nodes are created on demand)
+    const TexID texID = g_TextureMgr.GetIDByName(filePath);
+
+    if (texID != INVALID_TEXTURE_ID)
+        MarkDirty(AddTextureNode(texID));
+
+    const ModelID modelID = g_ModelMgr.GetModelIdByPath(filePath);
+
+    if (modelID != INVALID_MODEL_ID)
+        MarkDirty(AddModelNode(modelID));
+}
+
+///////////////////////////////////////////////////////////
+
+void AssetHotReloader::MarkDirty(const int nodeIdx)
+{
+    Node& node = nodes_[nodeIdx];
+
+    if (node.state != ASSET_NODE_IDLE)
+        return;
+
+    node.state = ASSET_NODE_DIRTY;
+    ++numActive_;
+
+    // (a dependent always has a greater idx so there are no cycles)
+    for (const int dependentIdx : node.dependents)
+        MarkDirty(dependentIdx);
+}
+
+///////////////////////////////////////////////////////////
+
+bool AssetHotReloader::StartReload(Node& node)
+{
+    switch (node.type)
+    {
+        case ASSET_NODE_TEXTURE:
+            return g_TextureMgr.ReloadAsync(node.assetID);
+
+        case ASSET_NODE_MODEL:
+            return g_ModelMgr.ReloadAsync(node.assetID);
+
+        case ASSET_NODE_CUSTOM:
+        {
+            try
+            {
+                return node.func && node.func();
+            }
+            catch (EngineException& e)
+            {
+                LogErr(e);
+                return false;
+            }
+        }
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+bool AssetHotReloader::IsReloadDone(const Node& node) const
+{
+    // reloaded assets are swapped in by their managers (see Engine::Update())
+    switch (node.type)
+    {
+        case ASSET_NODE_TEXTURE: return !g_TextureMgr.IsReloading(node.assetID);
+        case ASSET_NODE_MODEL:   return !g_ModelMgr.IsReloading(node.assetID);
+        default:                 return true;
+    }
+}
+
+} // namespace Core
@@ -0,0 +1,138 @@
+// =================================================================================
+// Filename:     AssetHotReloader.h
+// Description:  incremental hot reload of assets with dependency tracking:
+//
+//               - a watcher thread waits for changes of files in the data
+//                 directory and its subdirectories (ReadDirectoryChangesW)
+//                 and collects paths of the changed files;
+//               - each node of the dependency graph is an engine object
+//                 (a texture, a model or anything with a reload callback, e.g.
+//                 the terrain or the sky) which is made of some files and can
+//                 depend on other nodes;
+//               - a changed file marks its nodes and all the nodes which depend on
+//                 them (transitively) so only these objects are reloaded; a texture
+//                 or a model by the changed file is found even if it has no node;
+//               - textures and models are decoded by jobs and replaced in place by
+//                 their managers (so TexID/ModelID/MaterialID stay the same); a node
+//                 is reloaded only after all its dependencies are reloaded
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <windows.h>
+
+#include <atomic>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+namespace Core
+{
+
+class AssetHotReloader
+{
+public:
+    using ReloadFunc = std::function<bool()>;
+
+public:
+    AssetHotReloader() {}
+    ~AssetHotReloader();
+
+    // restrict a copying of this class instance
+    AssetHotReloader(const AssetHotReloader&) = delete;
+    AssetHotReloader& operator=(const AssetHotReloader&) = delete;
+
+    // start watching the directory (recursively); paths of changed files
+    // are relative to the working dir, e.g. "data/textures/brick01d.dds"
+    bool Initialize(const char* dataDirPath);
+    void Shutdown();
+
+    // add a node which is reloaded by the callback (by the main thread) when any of
+    // its files is changed or any of its dependencies (their idxs) is reloaded;
+    // a dependency must be added before the node (so there are no cycles);
+    // return: idx of the added node (to be a dependency of next nodes)
+    int AddNode(
+        const char* name,
+        ReloadFunc&& func,
+        std::initializer_list<const char*> filePaths,
+        std::initializer_list<int> deps = {});
+
+    // nodes of assets which are reloaded by jobs (a node is created once per asset)
+    int AddTextureNode(const TexID id);
+    int AddModelNode  (const ModelID id);
+
+    // reload nodes by the file as if it was changed (e.g. by the editor)
+    void RequestReload(const char* filePath);
+
+    // is called by the main thread when the render thread is synced: start reloading
+    // of changed nodes (in order of dependencies) and finish the reloaded ones
+    void Update();
+
+    inline bool IsInitialized() const { return watcher_.joinable(); }
+    inline bool IsReloading()   const { return numActive_ > 0; }
+
+private:
+    enum eNodeType
+    {
+        ASSET_NODE_TEXTURE,
+        ASSET_NODE_MODEL,
+        ASSET_NODE_CUSTOM,
+    };
+
+    enum eNodeState
+    {
+        ASSET_NODE_IDLE,
+        ASSET_NODE_DIRTY,                          // must be reloaded
+        ASSET_NODE_RELOADING,                      // is being reloaded by a job
+    };
+
+    struct Node
+    {
+        eNodeType    type  = ASSET_NODE_CUSTOM;
+        eNodeState   state = ASSET_NODE_IDLE;
+        uint32       assetID = 0;                  // TexID or ModelID
+        std::string  name;
+        ReloadFunc   func;
+        cvector<int> deps;                         // nodes which are reloaded before this one
+        cvector<int> dependents;                   // nodes which are reloaded after this one
+    };
+
+    void WatchLoop();
+    int  FindAssetNode(const eNodeType type, const uint32 assetID) const;
+    int  AddAssetNode (const eNodeType type, const uint32 assetID, const char* name);
+
+    void MarkChangedFiles();
+    void MarkFile (const char* filePath);
+    void MarkDirty(const int nodeIdx);
+
+    bool StartReload (Node& node);
+    bool IsReloadDone(const Node& node) const;
+
+private:
+    std::vector<Node>                      nodes_;        // in order of dependencies
+    std::unordered_multimap<uint64, int>   fileToNodes_;  // hash of a normalized path => idx of node
+    int                                    numActive_    = 0;       // dirty and reloading nodes
+    int                                    numReloaded_  = 0;       // by the current batch of changes
+    uint64                                 batchStartMs_ = 0;
+
+    char                                   dirPath_[64]{ '\0' };
+    std::thread                            watcher_;
+    HANDLE                                 hDir_       = INVALID_HANDLE_VALUE;
+    HANDLE                                 hStopEvent_ = nullptr;   // wakes the watcher up to stop it
+
+    std::mutex                             changesMutex_;
+    std::vector<std::string>               changedFiles_;           // are collected by the watcher
+    std::atomic<uint64>                    lastChangeTimeMs_ = 0;   // to wait until an editor finishes saving
+    std::atomic<bool>                      isChanged_  = false;     // are there changed files since the last batch?
+    std::atomic<bool>                      isOverflow_ = false;     // some changes are lost (too many at once)
+};
+
+} // namespace Core
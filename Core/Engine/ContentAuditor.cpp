@@ -0,0 +1,398 @@
+// =================================================================================
+// Filename:  ContentAuditor.cpp
+// Desc:      implementation of the performance audit of the content
+//
+// Created:   14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "ContentAuditor.h"
+#include "Settings.h"
+#include "../Model/ModelMgr.h"
+#include "../Texture/TextureMgr.h"
+#include "../Mesh/MaterialMgr.h"
+#include <DirectXTex.h>
+#include <filesystem>
+#include <math.h>
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+static const char* s_AuditCategoryNames[NUM_AUDIT_CATEGORIES] =
+{
+    "model",
+    "texture",
+    "material",
+    "region",
+};
+
+//---------------------------------------------------------
+// Desc:   read budgets from the settings (AUDIT_* keys)
+//---------------------------------------------------------
+void AuditBudgets::LoadFromSettings(const Settings& settings)
+{
+    maxModelTris          = settings.GetFloat("AUDIT_MAX_MODEL_TRIS");
+    maxTrisPerSqMeter     = settings.GetFloat("AUDIT_MAX_TRIS_PER_SQ_METER");
+    minTrisForLods        = settings.GetFloat("AUDIT_MIN_TRIS_FOR_LODS");
+    maxTextureSize        = settings.GetFloat("AUDIT_MAX_TEXTURE_SIZE");
+    maxUncompressedSize   = settings.GetFloat("AUDIT_MAX_UNCOMPRESSED_SIZE");
+    maxMaterials          = settings.GetFloat("AUDIT_MAX_MATERIALS");
+    regionSize            = std::max(1.0f, settings.GetFloat("AUDIT_REGION_SIZE"));
+    maxDrawCallsPerRegion = settings.GetFloat("AUDIT_MAX_DRAW_CALLS_PER_REGION");
+    maxTrisPerRegion      = settings.GetFloat("AUDIT_MAX_TRIS_PER_REGION");
+    maxLightsPerRegion    = settings.GetFloat("AUDIT_MAX_LIGHTS_PER_REGION");
+}
+
+//---------------------------------------------------------
+// Desc:   collect rows of all the assets and regions of the scene
+//---------------------------------------------------------
+void ContentAuditor::Run(const ECS::EntityMgr& enttMgr, const AuditBudgets& budgets)
+{
+    entries_.clear();
+    numIssues_ = 0;
+
+    AuditModels(budgets);
+    AuditTextures(budgets);
+    AuditMaterials(budgets);
+    AuditRegions(enttMgr, budgets);
+
+    // issues go first so the log/CSV starts with the things to fix
+    Sort(AUDIT_COL_OVER, false);
+
+    sprintf(g_String, "content audit: %d rows, %d issues", (int)entries_.size(), numIssues_);
+    LogMsg(g_String);
+}
+
+//---------------------------------------------------------
+// Desc:   sort rows by the column (ties are kept in the order of categories/names)
+//---------------------------------------------------------
+void ContentAuditor::Sort(const eAuditColumn column, const bool ascending)
+{
+    auto compare = [column](const AuditEntry& a, const AuditEntry& b)
+    {
+        switch (column)
+        {
+            case AUDIT_COL_CATEGORY: return (a.category != b.category) ? ((int)a.category - (int)b.category) : strcmp(a.name, b.name);
+            case AUDIT_COL_NAME:     return strcmp(a.name, b.name);
+            case AUDIT_COL_METRIC:   return strcmp(a.metric, b.metric);
+            case AUDIT_COL_VALUE:    return (a.value  < b.value)  ? -1 : (a.value  > b.value)  ? 1 : 0;
+            case AUDIT_COL_BUDGET:   return (a.budget < b.budget) ? -1 : (a.budget > b.budget) ? 1 : 0;
+            case AUDIT_COL_OVER:     return (int)a.isOver - (int)b.isOver;
+        }
+        return 0;
+    };
+
+    std::stable_sort(entries_.begin(), entries_.end(), [&](const AuditEntry& a, const AuditEntry& b)
+    {
+        const int res = compare(a, b);
+        return (ascending) ? (res < 0) : (res > 0);
+    });
+}
+
+//---------------------------------------------------------
+// Desc:   write all the rows (in the current order) into the CSV file
+//---------------------------------------------------------
+bool ContentAuditor::ExportCSV(const char* path) const
+{
+    CAssert::True(path && path[0] != '\0', "input path to the CSV file is empty");
+
+    const std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    std::error_code err;
+
+    if (!dir.empty())
+        std::filesystem::create_directories(dir, err);
+
+    FILE* pFile = fopen(path, "w");
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open a file to write the content audit: %s", path);
+        LogErr(g_String);
+        return false;
+    }
+
+    fprintf(pFile, "category,name,metric,value,budget,over_budget\n");
+
+    for (const AuditEntry& entry : entries_)
+    {
+        // names may contain commas so they are quoted
+        fprintf(pFile, "%s,\"%s\",%s,%.3f,%.3f,%d\n",
+            s_AuditCategoryNames[entry.category],
+            entry.name,
+            entry.metric,
+            entry.value,
+            entry.budget,
+            (int)entry.isOver);
+    }
+
+    fclose(pFile);
+
+    sprintf(g_String, "content audit is written into: %s", path);
+    LogMsg(g_String);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+const char* ContentAuditor::GetCategoryName(const eAuditCategory category)
+{
+    return (category < NUM_AUDIT_CATEGORIES) ? s_AuditCategoryNames[category] : "";
+}
+
+//---------------------------------------------------------
+// Desc:   Sandbox.exe --audit path
+// Ret:    true if the audit is requested (outPath is the CSV file)
+//---------------------------------------------------------
+bool ContentAuditor::ParseCmdLine(int argc, char* argv[], char* outPath, const int bufSize)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--audit") != 0)
+            continue;
+
+        if (i + 1 >= argc)
+        {
+            sprintf(g_String, "no path after the arg: %s", argv[i]);
+            LogErr(g_String);
+            return false;
+        }
+
+        snprintf(outPath, bufSize, "%s", argv[i + 1]);
+        return true;
+    }
+
+    return false;
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+
+//---------------------------------------------------------
+// Desc:   triangles of models, their density, LODs and index format
+//---------------------------------------------------------
+void ContentAuditor::AuditModels(const AuditBudgets& budgets)
+{
+    // idx 0 is the placeholder of models which aren't loaded yet
+    for (index i = 1; i < g_ModelMgr.GetNumAssets(); ++i)
+    {
+        const BasicModel& model = g_ModelMgr.GetModelByIdx(i);
+        const char*       name  = model.GetName();
+        const float       tris  = (float)(model.GetNumLod0Indices() / 3);
+
+        // a density of triangles by the largest face of the AABB is
+        // proportional to triangles per pixel when the model is on screen
+        const XMFLOAT3& ext   = model.GetModelAABB().Extents;
+        const float     area  = 4.0f * std::max({ ext.x*ext.y, ext.y*ext.z, ext.x*ext.z });
+        const float     dense = (area > 0.0001f) ? tris / area : 0.0f;
+
+        AddEntry(AUDIT_MODEL, name, "triangles",     tris,  budgets.maxModelTris,      tris  > budgets.maxModelTris);
+        AddEntry(AUDIT_MODEL, name, "tris_per_sq_m", dense, budgets.maxTrisPerSqMeter, dense > budgets.maxTrisPerSqMeter);
+
+        // heavy models must have simplified LODs
+        const float numLods = (float)model.GetNumLods();
+        AddEntry(AUDIT_MODEL, name, "lods", numLods, 2, (tris >= budgets.minTrisForLods) && (numLods < 2));
+
+        // 32-bit indices where all the vertices are addressable by 16 bits;
+        // shared geometry is reported by its owner
+        if (!model.IsGeometryShared())
+        {
+            const bool is32   = (model.GetIndexFormat() == DXGI_FORMAT_R32_UINT);
+            const bool fits16 = (model.GetNumVertices() <= UINT16_MAX);
+            AddEntry(AUDIT_MODEL, name, "index_bits", (is32) ? 32.0f : 16.0f, (fits16) ? 16.0f : 32.0f, is32 && fits16);
+        }
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   sizes and formats of textures
+//---------------------------------------------------------
+void ContentAuditor::AuditTextures(const AuditBudgets& budgets)
+{
+    // aliases (the same content) share a resource: it is checked once
+    cvector<ID3D11Resource*> resources;
+    cvector<TexID>           texIDs;
+
+    for (index i = 0; i < g_TextureMgr.GetNumTextures(); ++i)
+    {
+        const TexID     id   = g_TextureMgr.GetTexIdByIdx(i);
+        ID3D11Resource* pRes = g_TextureMgr.GetTexByID(id).GetResource();
+
+        if (!pRes || resources.has_value(pRes))
+            continue;
+
+        resources.push_back(pRes);
+        texIDs.push_back(id);
+    }
+
+    for (index i = 0; i < resources.size(); ++i)
+    {
+        ID3D11Texture2D* pTex2D = nullptr;
+
+        if (FAILED(resources[i]->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&pTex2D)))
+            continue;
+
+        D3D11_TEXTURE2D_DESC desc;
+        pTex2D->GetDesc(&desc);
+        SafeRelease(&pTex2D);
+
+        const char* name         = g_TextureMgr.GetTexByID(texIDs[i]).GetName().c_str();
+        const float maxSide      = (float)std::max(desc.Width, desc.Height);
+        const bool  isCompressed = DirectX::IsCompressed(desc.Format);
+        const bool  isPow2       = ((desc.Width & (desc.Width - 1)) == 0) && ((desc.Height & (desc.Height - 1)) == 0);
+
+        AddEntry(AUDIT_TEXTURE, name, "size",         maxSide,                   budgets.maxTextureSize, maxSide > budgets.maxTextureSize);
+        AddEntry(AUDIT_TEXTURE, name, "compressed",   (isCompressed) ? 1.0f : 0, 1, !isCompressed && (maxSide > budgets.maxUncompressedSize));
+        AddEntry(AUDIT_TEXTURE, name, "power_of_two", (isPow2)       ? 1.0f : 0, 1, !isPow2);
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   the number of materials (each unique one breaks a batch)
+//---------------------------------------------------------
+void ContentAuditor::AuditMaterials(const AuditBudgets& budgets)
+{
+    const float numMaterials = (float)g_MaterialMgr.GetNumAllMaterials();
+    AddEntry(AUDIT_MATERIAL, "all materials", "count", numMaterials, budgets.maxMaterials, numMaterials > budgets.maxMaterials);
+}
+
+//---------------------------------------------------------
+// Desc:   draw calls, triangles and lights per cell of the XZ grid
+//---------------------------------------------------------
+void ContentAuditor::AuditRegions(const ECS::EntityMgr& enttMgr, const AuditBudgets& budgets)
+{
+    struct RegionItem
+    {
+        int64_t region  = 0;
+        ModelID modelID = INVALID_MODEL_ID;
+    };
+
+    const float invSize = 1.0f / budgets.regionSize;
+
+    auto getRegion = [invSize](const XMFLOAT3& pos)
+    {
+        const int64_t x = (int64_t)floorf(pos.x * invSize);
+        const int64_t z = (int64_t)floorf(pos.z * invSize);
+        return (x << 32) | (z & 0xFFFFFFFF);
+    };
+
+    // models of entities which are rendered by themselves (not by a merged cell)
+    const ECS::Model&    model    = enttMgr.GetComponentModel();
+    const ECS::Rendered& rendered = enttMgr.GetComponentRendered();
+
+    cvector<EntityID> enttsIDs;
+    cvector<ModelID>  modelsIDs;
+
+    for (index i = 0; i < model.enttsIDs_.size(); ++i)
+    {
+        const EntityID id  = model.enttsIDs_[i];
+        const EntityID* it = std::lower_bound(rendered.ids.begin(), rendered.ids.end(), id);
+
+        if ((it == rendered.ids.end()) || (*it != id) || rendered.mergedInto[it - rendered.ids.begin()])
+            continue;
+
+        enttsIDs.push_back(id);
+        modelsIDs.push_back(model.modelIDs_[i]);
+    }
+
+    cvector<XMFLOAT3>   positions;
+    cvector<RegionItem> items(enttsIDs.size());
+
+    if (!enttsIDs.empty())
+        enttMgr.transformSystem_.GetPositions(enttsIDs.data(), enttsIDs.size(), positions);
+
+    for (index i = 0; i < enttsIDs.size(); ++i)
+        items[i] = { getRegion(positions[i]), modelsIDs[i] };
+
+    // lights (point and spot: directional ones light everything anyway)
+    const ECS::Light& light = enttMgr.GetComponentLight();
+    cvector<EntityID> lightsIDs;
+    cvector<int64_t>  lightsRegions;
+
+    lightsIDs.append_vector(light.pointLights.ids);
+    lightsIDs.append_vector(light.spotLights.ids);
+    lightsRegions.resize(lightsIDs.size());
+
+    if (!lightsIDs.empty())
+        enttMgr.transformSystem_.GetPositions(lightsIDs.data(), lightsIDs.size(), positions);
+
+    for (index i = 0; i < lightsIDs.size(); ++i)
+        lightsRegions[i] = getRegion(positions[i]);
+
+    std::sort(items.begin(), items.end(), [](const RegionItem& a, const RegionItem& b)
+    {
+        return (a.region != b.region) ? (a.region < b.region) : (a.modelID < b.modelID);
+    });
+    std::sort(lightsRegions.begin(), lightsRegions.end());
+
+    // all the regions which have either models or lights
+    cvector<int64_t> regions;
+    regions.reserve(items.size() + lightsRegions.size());
+
+    for (const RegionItem& item : items)
+        regions.push_back(item.region);
+
+    regions.append_vector(lightsRegions);
+    std::sort(regions.begin(), regions.end());
+    regions.resize(std::unique(regions.begin(), regions.end()) - regions.begin());
+
+    index itemIdx  = 0;
+    index lightIdx = 0;
+
+    for (const int64_t region : regions)
+    {
+        // instances of the same model are batched so each unique model of
+        // the region costs a draw call per its subset
+        float drawCalls = 0;
+        float tris      = 0;
+
+        for (; (itemIdx < items.size()) && (items[itemIdx].region == region); ++itemIdx)
+        {
+            const BasicModel& basicModel = g_ModelMgr.GetModelByID(items[itemIdx].modelID);
+
+            if ((itemIdx == 0) || (items[itemIdx-1].region != region) || (items[itemIdx-1].modelID != items[itemIdx].modelID))
+                drawCalls += (float)basicModel.GetNumSubsets();
+
+            tris += (float)(basicModel.GetNumLod0Indices() / 3);
+        }
+
+        float numLights = 0;
+
+        for (; (lightIdx < lightsRegions.size()) && (lightsRegions[lightIdx] == region); ++lightIdx)
+            numLights++;
+
+        char name[64];
+        snprintf(name, sizeof(name), "region (%d, %d)", (int)(region >> 32), (int)(int32_t)(region & 0xFFFFFFFF));
+
+        AddEntry(AUDIT_REGION, name, "draw_calls", drawCalls, budgets.maxDrawCallsPerRegion, drawCalls > budgets.maxDrawCallsPerRegion);
+        AddEntry(AUDIT_REGION, name, "triangles",  tris,      budgets.maxTrisPerRegion,      tris      > budgets.maxTrisPerRegion);
+        AddEntry(AUDIT_REGION, name, "lights",     numLights, budgets.maxLightsPerRegion,    numLights > budgets.maxLightsPerRegion);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void ContentAuditor::AddEntry(
+    const eAuditCategory category,
+    const char* name,
+    const char* metric,
+    const float value,
+    const float budget,
+    const bool isOver)
+{
+    entries_.push_back(AuditEntry());
+    AuditEntry& entry = entries_.back();
+
+    snprintf(entry.name,   sizeof(entry.name),   "%s", (name) ? name : "");
+    snprintf(entry.metric, sizeof(entry.metric), "%s", metric);
+    entry.value    = value;
+    entry.budget   = budget;
+    entry.category = category;
+    entry.isOver   = isOver;
+
+    numIssues_ += (int)isOver;
+}
+
+} // namespace Core
@@ -0,0 +1,132 @@
+// =================================================================================
+// Filename:     ContentAuditor.h
+// Description:  a performance audit of the content: all the loaded models, textures
+//               and materials and the entities of the scene are checked against
+//               budgets (AUDIT_* in settings.txt) and each measured value becomes
+//               a row of the report:
+//
+//               - models:    triangles (LOD 0), triangles per square meter of
+//                            the largest face of its AABB, missing LODs of heavy
+//                            models, 32-bit indices which could be 16-bit;
+//               - textures:  size, uncompressed big textures, non-power-of-two
+//                            sizes (aliases of the same resource are checked once);
+//               - materials: the number of all the materials;
+//               - regions:   cells of the XZ grid: an estimate of draw calls
+//                            (subsets of unique models, as instances are batched),
+//                            triangles and point/spot lights in the cell
+//
+//               the report can be sorted by any column and exported as CSV; it is
+//               run by the editor (Tools -> Content audit) or by the command line:
+//
+//                 Sandbox.exe --audit data/audit/content.csv
+//
+//               (the process exits after the scene is initialized and the report
+//               is written; the exit code is nonzero if any budget is exceeded)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include "Entity/EntityMgr.h"
+
+
+namespace Core
+{
+
+class Settings;
+
+enum eAuditCategory : uint8
+{
+    AUDIT_MODEL,
+    AUDIT_TEXTURE,
+    AUDIT_MATERIAL,
+    AUDIT_REGION,
+
+    NUM_AUDIT_CATEGORIES
+};
+
+// columns of the report (for sorting)
+enum eAuditColumn
+{
+    AUDIT_COL_CATEGORY,
+    AUDIT_COL_NAME,
+    AUDIT_COL_METRIC,
+    AUDIT_COL_VALUE,
+    AUDIT_COL_BUDGET,
+    AUDIT_COL_OVER,
+
+    NUM_AUDIT_COLUMNS
+};
+
+///////////////////////////////////////////////////////////
+
+struct AuditBudgets
+{
+    float maxModelTris          = 100000;     // triangles of LOD 0
+    float maxTrisPerSqMeter     = 5000;       // by the largest face of the model's AABB
+    float minTrisForLods        = 5000;       // a model with more triangles must have LODs
+    float maxTextureSize        = 2048;       // the largest side (texels)
+    float maxUncompressedSize   = 512;        // a bigger uncompressed texture is an issue
+    float maxMaterials          = 256;
+    float regionSize            = 64;         // side of a region (cell of the XZ grid)
+    float maxDrawCallsPerRegion = 500;
+    float maxTrisPerRegion      = 2000000;
+    float maxLightsPerRegion    = 16;         // point + spot lights
+
+    void LoadFromSettings(const Settings& settings);
+};
+
+///////////////////////////////////////////////////////////
+
+struct AuditEntry
+{
+    char           name[64]{ '\0' };          // of an asset or a region ("region (x, z)")
+    char           metric[24]{ '\0' };
+    float          value    = 0;
+    float          budget   = 0;
+    eAuditCategory category = AUDIT_MODEL;
+    bool           isOver   = false;          // the value is out of the budget
+};
+
+///////////////////////////////////////////////////////////
+
+class ContentAuditor
+{
+public:
+    // collect rows of all the assets and regions of the scene
+    void Run(const ECS::EntityMgr& enttMgr, const AuditBudgets& budgets);
+
+    void Sort(const eAuditColumn column, const bool ascending);
+
+    bool ExportCSV(const char* path) const;
+
+    inline const cvector<AuditEntry>& GetEntries()   const { return entries_; }
+    inline int                        GetNumIssues() const { return numIssues_; }
+
+    static const char* GetCategoryName(const eAuditCategory category);
+
+    // Sandbox.exe --audit path: returns true if the audit is requested
+    static bool ParseCmdLine(int argc, char* argv[], char* outPath, const int bufSize);
+
+private:
+    void AuditModels   (const AuditBudgets& budgets);
+    void AuditTextures (const AuditBudgets& budgets);
+    void AuditMaterials(const AuditBudgets& budgets);
+    void AuditRegions  (const ECS::EntityMgr& enttMgr, const AuditBudgets& budgets);
+
+    void AddEntry(
+        const eAuditCategory category,
+        const char* name,
+        const char* metric,
+        const float value,
+        const float budget,
+        const bool isOver);
+
+private:
+    cvector<AuditEntry> entries_;
+    int                 numIssues_ = 0;
+};
+
+} // namespace Core
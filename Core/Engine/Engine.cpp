@@ -12,6 +12,11 @@
 #include "../Terrain/Terrain.h"
 #include "../Texture/TextureMgr.h"
 #include "../Model/ModelMgr.h"
+#include <JobSystem.h>
+#include <IoScheduler.h>
+#include <Profiler.h>
+#include <HitchRecorder.h>
+#include <CVars.h>
 //#include <winuser.h>
 
 #pragma warning (disable : 4996)
@@ -35,6 +40,19 @@ Engine::~Engine()
     LogMsgf("%s%s", YELLOW, "            START OF THE DESTROYMENT:            ");
     LogMsgf("%s%s", YELLOW, "-------------------------------------------------");
 
+    // finish the frame in flight before anything is destroyed
+    renderThread_.Stop();
+    inputReplay_.Stop();            // the header of a recording gets the number of frames
+    g_CVars.Clear();                // callbacks refer to subsystems
+    telemetry_.Stop();              // it samples job system workers
+    assetHotReloader_.Shutdown();
+
+    // the scene can still be written by a job
+    g_ProjectSaver.Wait();
+
+    // usage (and peaks) of memory by subsystems during the whole run
+    g_MemTracker.LogReport();
+    g_MemTracker.DumpReport("memory_report.txt");
 
     // unregister the window class, destroys the window,
     // reset the responsible members;
@@ -48,7 +66,12 @@ Engine::~Engine()
         LogDbg("engine desctuctor");
     }
 
-    imGuiLayer_.Shutdown();
+    if (!isHeadless_)
+        imGuiLayer_.Shutdown();
+
+    // stop the I/O thread (completions are delivered by jobs) and worker threads
+    g_IoScheduler.Shutdown();
+    g_JobSystem.Shutdown();
 
     LogMsg("the engine is shut down successfully");
 }
@@ -80,16 +103,29 @@ bool Engine::Initialize(
         CAssert::True(pUserInterface != nullptr, "input ptr to the User Interface == nullptr");
         CAssert::True(pRender != nullptr,        "input ptr to the Render == nullptr");
 
+        // zones of this thread are named as "main" in captured traces
+        g_CpuProfiler.SetThreadName("main");
+
         // WINDOW: store a handle to the application instance
         hInstance_      = hInstance;  
         hwnd_           = mainWnd;
         windowTitle_    = windowTitle;
+        isHeadless_     = (mainWnd == NULL);
 
         // init pointers
         pEnttMgr_       = pEnttMgr;
         pUserInterface_ = pUserInterface;
         pRender_        = pRender;
 
+        // JOB SYSTEM: create a pool of worker threads (number of hardware threads - 1);
+        // NOTE: the application can start it earlier to run its init tasks
+        if (!g_JobSystem.IsInitialized())
+            g_JobSystem.Initialize();
+
+        // I/O SCHEDULER: a single thread of overlapped reads for streamed content
+        if (!g_IoScheduler.IsInitialized())
+            g_IoScheduler.Initialize();
+
 
         // GRAPHICS SYSTEM: initialize the graphics system
         bool result = graphics_.Initialize(
@@ -108,15 +144,117 @@ bool Engine::Initialize(
         systemState_.wndHeight_       = d3d.GetWindowHeight();
         
 #if 0
-        // SOUND SYSTEM: initialize the sound obj
+        // SOUND SYSTEM: initialize the sound obj and preload short effects
         result = sound_.Initialize(hwnd_);
         CAssert::True(result, "can't initialize the sound system");
+
+        sound_.LoadEffect("data/sounds/stepL.wav");
+        sound_.LoadEffect("data/sounds/stepR.wav");
 #endif
 
-        // TIMERS: (game timer, CPU)
+        // SIMULATION: a rate of the fixed-step update
+        const int simHz = settings.GetInt("SIMULATION_HZ");
+        simStep_        = (simHz > 0) ? (1.0f / (float)simHz) : 0.0f;
+
+        // INPUT: mouse look by raw input
+        mouseSensitivity_ = settings.GetFloat("MOUSE_SENSITIVITY");
+
+        // INPUT REPLAY: frames between checkpoints (hashes of the world) of a recording
+        replayCheckpointFrames_ = settings.GetInt("INPUT_REPLAY_CHECKPOINT_FRAMES");
+
+        // TIMERS: (game timer)
         timer_.Tick();                 
-        cpu_.Initialize();
-        imGuiLayer_.Initialize(hwnd_, pDevice, pContext);
+        simGameTime_ = timer_.GetGameTime();
+
+        // TELEMETRY: cpu/memory usage of the process, workers and the adapter
+        telemetry_.Start(pDevice);
+
+        // the editor's UI needs a window
+        if (!isHeadless_)
+            imGuiLayer_.Initialize(hwnd_, pDevice, pContext);
+
+        // RENDER THREAD: the game mode is rendered by a dedicated thread
+        if (settings.GetBool("RENDER_THREAD"))
+        {
+            renderThread_.Start([this]()
+            {
+                FramePacket& packet = framePackets_[currPacketIdx_];
+
+                // the render thread waits for the swap chain instead of the main one
+                graphics_.GetD3DClass().WaitForFrameLatency();
+                RenderFramePacket(packet);
+            });
+        }
+
+        // HITCH RECORDER: frames around a spike are dumped as a trace
+        if (settings.GetBool("HITCH_RECORDER"))
+        {
+            HitchRecorder::Config hitchConfig;
+            hitchConfig.thresholdRatio = settings.GetFloat("HITCH_THRESHOLD_RATIO");
+            hitchConfig.minHitchMs     = settings.GetFloat("HITCH_MIN_MS");
+
+            g_HitchRecorder.SetConfig(hitchConfig);
+            g_HitchRecorder.SetEnabled(true);
+        }
+
+        // EDITOR IDLE REDRAW: the scene isn't rendered again while nothing is changed
+        isEditorIdleRedraw_ = settings.GetBool("EDITOR_IDLE_REDRAW");
+        idleRedrawMs_       = settings.GetInt("EDITOR_IDLE_REDRAW_MS");
+
+        // FRAME PACING: the cap of frames (if VSYNC doesn't limit them) and low rates
+        // of the unfocused editor and of the power-saving mode
+        frameLimitFps_ = settings.GetInt("FRAME_LIMIT_FPS");
+        powerSaveFps_  = settings.GetInt("POWER_SAVE_FPS");
+        unfocusedFps_  = settings.GetInt("EDITOR_UNFOCUSED_FPS");
+        isPowerSaving_ = settings.GetBool("POWER_SAVE_MODE");
+        frameLimiter_.Initialize();
+
+        // MEMORY BUDGETS: (in MB) overruns are logged by the memory tracker
+        const char* memBudgetKeys[NUM_MEM_TAGS] =
+        {
+            nullptr,                                        // MEM_TAG_OTHER isn't budgeted
+            "MEM_BUDGET_ECS_MB",
+            "MEM_BUDGET_MODELS_MB",
+            "MEM_BUDGET_TEXTURES_MB",
+            "MEM_BUDGET_TERRAIN_MB",
+            "MEM_BUDGET_RENDER_MB",
+            "MEM_BUDGET_UI_MB",
+            "MEM_BUDGET_LOG_MB",
+        };
+        const char* gpuMemBudgetKeys[NUM_GPU_MEM_TAGS] =
+        {
+            "GPU_MEM_BUDGET_TEXTURES_MB",
+            "GPU_MEM_BUDGET_MODELS_MB",
+            "GPU_MEM_BUDGET_TERRAIN_MB",
+            "GPU_MEM_BUDGET_TARGETS_MB",
+        };
+
+        for (int i = 0; i < NUM_MEM_TAGS; ++i)
+        {
+            if (memBudgetKeys[i])
+                g_MemTracker.SetBudget((eMemTag)i, (uint64)settings.GetInt(memBudgetKeys[i]) << 20);
+        }
+
+        for (int i = 0; i < NUM_GPU_MEM_TAGS; ++i)
+            g_MemTracker.SetGpuBudget((eGpuMemTag)i, (uint64)settings.GetInt(gpuMemBudgetKeys[i]) << 20);
+
+        // WORLD PARTITION: far chunks of the world are dormant (or streamed out)
+        if (settings.GetBool("WORLD_PARTITION"))
+        {
+            ECS::WorldPartitionParams partition;
+            strncpy(partition.dirPath, settings.GetString("WORLD_PARTITION_DIR"), sizeof(partition.dirPath) - 1);
+            partition.chunkDimension = settings.GetFloat("CHUNK_DIMENSION");
+            partition.activeDist     = settings.GetFloat("WORLD_PARTITION_ACTIVE_DIST");
+            partition.unloadDist     = settings.GetFloat("WORLD_PARTITION_UNLOAD_DIST");
+            partition.hysteresis     = settings.GetFloat("WORLD_PARTITION_HYSTERESIS");
+            partition.isStreaming    = settings.GetBool("WORLD_PARTITION_STREAMING");
+
+            pEnttMgr->worldPartitionSystem_.Initialize(partition);
+        }
+
+        // ASSETS HOT RELOAD: changed files of the data dir are reloaded by Update()
+        if (settings.GetBool("ASSET_HOT_RELOAD"))
+            assetHotReloader_.Initialize("data/");
 
         LogMsg("is initialized!");
     }
@@ -131,34 +269,88 @@ bool Engine::Initialize(
 
 ///////////////////////////////////////////////////////////
 
+void Engine::WaitForNextFrame()
+{
+    // with a flip model swap chain we block here instead of inside Present() so the
+    // input is sampled as late as possible (no-op for the BLT model);
+    // NOTE: the render thread waits by itself right before rendering of a packet
+    if (!IsRenderThreadActive())
+        graphics_.GetD3DClass().WaitForFrameLatency();
+}
+
+///////////////////////////////////////////////////////////
+
 void Engine::Update()
 {
+    // the frame starts here (a requested capture of frames is started/stopped)
+    g_CpuProfiler.BeginFrame();
+    g_HitchRecorder.BeginFrame();
+    PROFILE_SCOPE("Engine::Update");
+
+    // knobs which are changed by the console are applied while nothing is rendered
+    if (g_CVars.HasChanges())
+    {
+        SyncRenderThread();
+        g_CVars.ApplyChanges();
+    }
+
     auto updateStartTime = std::chrono::steady_clock::now();
     timer_.Tick();
-    
-#if 0
-    // to update the system stats each of timers classes we needs to call its 
-    // own Update function for each frame of execution the application goes through
-    cpu_.Update();
 
-    // update the percentage of total cpu use that is occuring each second
-    systemState_.cpu = cpu_->GetCpuPercentage();
-#endif
+    // the replay feeds the recorded input and delta time instead of the real ones
+    if (inputReplay_.IsReplaying())
+    {
+        ReplayFrameInput();
+    }
+    else
+    {
+        // get the time which passed since the previous frame
+        deltaTime_ = timer_.GetDeltaTime();
+        constexpr float maxDeltaTime = (1000.0f / 60.0f);
+        deltaTime_ = (deltaTime_ > maxDeltaTime) ? maxDeltaTime : deltaTime_;
 
-    // get the time which passed since the previous frame
-    deltaTime_ = timer_.GetDeltaTime();
-    constexpr float maxDeltaTime = (1000.0f / 60.0f);
-    deltaTime_ = (deltaTime_ > maxDeltaTime) ? maxDeltaTime : deltaTime_;
+        // (is written if the recording is on)
+        inputReplay_.BeginFrame(deltaTime_);
+    }
 
     systemState_.deltaTime = deltaTime_;
     systemState_.frameTime = deltaTime_ * 1000.0f;
 
-    // update the entities and related data
-    pEnttMgr_->Update(timer_.GetGameTime(), deltaTime_);
+    // update the entities and related data (sounds are heard by the current camera)
+    pEnttMgr_->soundSystem_.SetListener(graphics_.GetCurrentCamera());
+    UpdateSimulation();
+
+    // voices of positional sounds which are heard after this frame's steps
+    const ECS::AudibleEmitters& audible = pEnttMgr_->soundSystem_.GetAudibleEmitters();
+
+    sound_.UpdateEmitters(
+        audible.ids.data(),
+        audible.soundIds.data(),
+        audible.gains.data(),
+        audible.pans.data(),
+        (int)audible.ids.size());
 
     // compute fps and frame time (ms)
     CalculateFrameStats();
 
+    // the simulation above went in parallel with rendering of the prev frame;
+    // the code below touches the render data so the render thread must be done
+    SyncRenderThread();
+
+    // add models which were loaded by jobs since the prev frame
+    g_ModelMgr.Update();
+
+    // swap in textures and streamed mips which were loaded by jobs (the render thread is synced)
+    g_TextureMgr.Update(graphics_.GetD3DClass().GetDeviceContext());
+
+    // start reloading of changed assets (they are swapped in by the managers above)
+    if (assetHotReloader_.IsInitialized())
+        assetHotReloader_.Update();
+
+    // thumbnails which were requested by the editor's browsers in the prev frame
+    if (systemState_.isEditorMode)
+        graphics_.UpdateThumbnails(pRender_);
+
     pUserInterface_->Update(graphics_.GetD3DClass().GetDeviceContext(), systemState_);
 
     // handle keyboard imput
@@ -175,6 +367,15 @@ void Engine::Update()
 
     graphics_.Update(systemState_, deltaTime_, timer_.GetGameTime(), pEnttMgr_, pRender_);
 
+    // apply the result of GPU picking if it is ready
+    EntityID pickedEnttID = 0;
+
+    if (graphics_.GetGpuPickResult(pRender_, pickedEnttID))
+        SelectEntt(pUserInterface_, pickedEnttID, isPickAdditive_);
+
+    // write the recorded frame (or check the replayed world against its checkpoint)
+    inputReplay_.EndFrame(*pEnttMgr_);
+
     // compute the duration of the engine's update process
     auto updateEndTime = std::chrono::steady_clock::now();
     std::chrono::duration<float, std::milli> updateDuration = updateEndTime - updateStartTime;
@@ -183,6 +384,100 @@ void Engine::Update()
 
 ///////////////////////////////////////////////////////////
 
+void Engine::UpdateSimulation()
+{
+    // update the ECS with a fixed step so the simulation doesn't depend on the frame rate;
+    // the time which isn't enough for a full step is kept for the next frame and
+    // is used to interpolate transformations for rendering
+
+    ECS::TransformSystem& transformSys = pEnttMgr_->transformSystem_;
+
+    const int64_t nowTicks = RawInputQueue::GetTicks();
+
+    // a variable step: once per frame
+    if (simStep_ <= 0.0f)
+    {
+        ApplyMouseLook(nowTicks);
+        pEnttMgr_->Update(timer_.GetGameTime(), deltaTime_);
+        transformSys.SetInterpolationAlpha(1.0f);
+        return;
+    }
+
+    simAccumulator_ += deltaTime_;
+
+    const double ticksPerSec = (double)RawInputQueue::GetTicksPerSecond();
+
+    for (int i = 0; (simAccumulator_ >= simStep_) && (i < MAX_SIM_STEPS_PER_FRAME); ++i)
+    {
+        // a step gets only the mouse input which came before its end time
+        // (the rest time of the accumulator is still ahead of the step)
+        const float restTime = simAccumulator_ - simStep_;
+        ApplyMouseLook(nowTicks - (int64_t)(restTime * ticksPerSec));
+
+        simGameTime_ += simStep_;
+        pEnttMgr_->Update(simGameTime_, simStep_);
+        simAccumulator_ -= simStep_;
+    }
+
+    // we're too slow so drop the time we can't simulate
+    if (simAccumulator_ >= simStep_)
+        simAccumulator_ = 0.0f;
+
+    transformSys.SetInterpolationAlpha(simAccumulator_ / simStep_);
+}
+
+///////////////////////////////////////////////////////////
+
+void Engine::ApplyMouseLook(const int64_t untilTicks)
+{
+    int dx = 0;
+    int dy = 0;
+
+    // the deltas are consumed even if nothing is rotated (so they don't pile up)
+    bool hasDeltas = rawInput_.Consume(untilTicks, dx, dy);
+
+    // each step of the replay gets the recorded deltas instead of the real ones
+    inputReplay_.MouseLook(dx, dy, hasDeltas);
+
+    if (!hasDeltas)
+        return;
+
+    const float rotY  = dx * mouseSensitivity_;
+    const float pitch = dy * mouseSensitivity_;
+
+    if (systemState_.isEditorMode)
+    {
+        // the editor camera is rotated only while the middle button is held
+        if (!mouse_.IsMiddleDown())
+            return;
+
+        const EntityID camID      = pEnttMgr_->nameSystem_.GetIdByName("editor_camera");
+        ECS::CameraSystem& camSys = pEnttMgr_->cameraSystem_;
+
+        // rotate around some particular point
+        if (camSys.IsFixedLook(camID))
+        {
+            assert(0 && "FIXME");
+            //cam.RotateYAroundFixedLook(rotY);
+            //cam.PitchAroundFixedLook  (pitch);
+        }
+        // rotate around itself
+        else
+        {
+            camSys.Pitch  (camID, pitch);
+            camSys.RotateY(camID, rotY);
+        }
+    }
+    else
+    {
+        ECS::PlayerSystem& player = pEnttMgr_->playerSystem_;
+        player.RotateY(rotY);
+        player.Pitch  (pitch);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 void Engine::CalculateFrameStats()
 {
     // measure the number of frames being rendered per second (FPS);
@@ -191,48 +486,162 @@ void Engine::CalculateFrameStats()
     // code computes the avetage frames per second, and also the average time it takes
     // to render one frame. These stats are appended to the window caption bar
 
-    static int frameCount = 0;
-    static int timeElapsed = 0;
+    static int   frameCount  = 0;
+    static float timeElapsed = 0.0f;
     
     frameCount++;
 
+    // the real frame time (the delta time of the simulation is clamped)
+    frameTimeSamples_[frameTimeSampleIdx_] = timer_.GetDeltaTime() * 1000.0f;
+    frameTimeSampleIdx_  = (frameTimeSampleIdx_ + 1) % NUM_FRAME_TIME_SAMPLES;
+    numFrameTimeSamples_ = std::min(numFrameTimeSamples_ + 1, NUM_FRAME_TIME_SAMPLES);
+
     // compute averages over one second period
-    if ((timer_.GetGameTime() - timeElapsed) >= 1.0f)
+    const float gameTime = timer_.GetGameTime();
+
+    if ((gameTime - timeElapsed) >= 1.0f)
     {
         // store the fps value for later using (for example: render this value as text onto the screen)
-        systemState_.fps = frameCount;
+        systemState_.fps = (int)(frameCount / (gameTime - timeElapsed));
    
         // reset for next average
-        frameCount = 0;
-        ++timeElapsed;
+        frameCount  = 0;
+        timeElapsed = gameTime;
+
+        // percentiles of frame times (spikes which are hidden by the average fps)
+        float sorted[NUM_FRAME_TIME_SAMPLES];
+        const int num = numFrameTimeSamples_;
+
+        memcpy(sorted, frameTimeSamples_, sizeof(float) * num);
+        std::sort(sorted, sorted + num);
+
+        systemState_.frameTimeP50 = sorted[(num - 1) * 50 / 100];
+        systemState_.frameTimeP95 = sorted[(num - 1) * 95 / 100];
+        systemState_.frameTimeP99 = sorted[(num - 1) * 99 / 100];
+
+        // video memory of managers (render targets are added by frame buffers themselves)
+        g_MemTracker.SetGpuUsage(GPU_MEM_TEXTURES, g_TextureMgr.GetGpuMemoryUsage());
+        g_MemTracker.SetGpuUsage(GPU_MEM_MODELS,   g_ModelMgr.GetGpuMemoryUsage());
+        g_MemTracker.SetGpuUsage(GPU_MEM_TERRAIN,  g_ModelMgr.GetTerrainGpuMemoryUsage());
+        g_MemTracker.CheckBudgets();
+
+        // the last telemetry sample (we don't wait for the sampler)
+        const TelemetryData telemetry = telemetry_.GetLast();
+
+        systemState_.cpu                  = (int)telemetry.processCpu;
+        systemState_.numWorkers           = telemetry.numWorkers;
+        systemState_.workingSetBytes      = telemetry.workingSetBytes;
+        systemState_.committedBytes       = telemetry.committedBytes;
+        systemState_.videoMemUsage        = telemetry.videoMemUsage;
+        systemState_.videoMemBudget       = telemetry.videoMemBudget;
+        systemState_.sharedVideoMemUsage  = telemetry.sharedVideoMemUsage;
+        systemState_.sharedVideoMemBudget = telemetry.sharedVideoMemBudget;
+
+        memcpy(systemState_.workerCpu, telemetry.workerCpu, sizeof(float) * telemetry.numWorkers);
+    }
+}
 
-        // print FPS/frame_time as the window caption
-#if 0
-        PROCESS_MEMORY_COUNTERS pmc;
-        DWORD processID;
-        GetWindowThreadProcessId(hwnd_, &processID);
+///////////////////////////////////////////////////////////
 
-        HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processID);
-        CAssert::True(hProcess != NULL, "can't get a process handle of the window");
-        
-        GetProcessMemoryInfo(hProcess, &pmc, sizeof(pmc));
-
-        std::wostringstream outs;
-        outs.precision(6);
-        outs << windowTitle_ << L" "
-             << L"FPS: " << systemState_.fps << L" "
-             << L"Frame Time: " << systemState_.frameTime << L" (ms); "
-             << L"RAM Usage: " << pmc.WorkingSetSize / 1024 / 1024 << L" (mb)";
-        SetWindowText(hwnd_, outs.str().c_str());		
-#endif
+void Engine::RenderFrame()
+{
+    // extract the state which the rendering needs into a frame packet and render it;
+    // if the render thread is active it submits the packet while the main thread
+    // goes to simulation of the next frame
+    PROFILE_SCOPE("Engine::RenderFrame");
+
+    try
+    {
+        currPacketIdx_ ^= 1;
+        FramePacket& packet = framePackets_[currPacketIdx_];
+
+        packet.sysState = systemState_;
+        packet.isFailed = false;
+
+        // an idle frame of the editor: only UI is rendered over the cached scene image
+        isSceneCached_ = systemState_.isEditorMode && !IsSceneChanged();
+
+        if (!isSceneCached_)
+            graphics_.ExtractFramePacket(pEnttMgr_, packet);
+
+        if (IsRenderThreadActive())
+        {
+            isPacketInFlight_ = true;
+            renderThread_.Kick();
+            return;
+        }
+
+        RenderFramePacket(packet);
+        FinishFramePacket(packet);
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't extract a frame packet");
+        isExit_ = true;                   // exit after it (shutdown the engine)
     }
 }
 
 ///////////////////////////////////////////////////////////
 
-void Engine::RenderFrame()
+bool Engine::IsSceneChanged()
+{
+    // check if the scene must be rendered again in the editor mode: all the cheap
+    // signs of a change are checked; UI edits (materials, lights, etc.) always come
+    // with input events; time animations (sky, water, animated textures) are
+    // refreshed once in a while
+
+    using namespace std::chrono;
+
+    if (!isEditorIdleRedraw_)
+        return true;
+
+    const ECS::EntityMgr& mgr = *pEnttMgr_;
+    const steady_clock::time_point now = steady_clock::now();
+
+    const bool isChanged =
+        hadInput_                                                             ||
+        !graphics_.HasCachedScene()                                           ||
+        graphics_.IsGpuPickRequested()                                        ||
+        !mgr.transformSystem_.GetChangedEntts().empty()                       ||
+        (mgr.GetStructureVersion()    != lastStructVersion_)                  ||
+        (g_TextureMgr.GetSRVsVersion() != lastSRVsVersion_)                   ||
+        (memcmp(&systemState_.cameraView, &lastCamView_, sizeof(lastCamView_)) != 0) ||
+        (memcmp(&systemState_.cameraProj, &lastCamProj_, sizeof(lastCamProj_)) != 0) ||
+        (duration_cast<milliseconds>(now - lastSceneRenderTime_).count() >= idleRedrawMs_);
+
+    hadInput_          = false;
+    lastStructVersion_ = mgr.GetStructureVersion();
+    lastSRVsVersion_   = g_TextureMgr.GetSRVsVersion();
+    lastCamView_       = systemState_.cameraView;
+    lastCamProj_       = systemState_.cameraProj;
+
+    // a few frames after the change are still rendered since some results
+    // (culling, picking, streaming) come from the prev frames
+    if (isChanged)
+        framesSinceChange_ = 0;
+    else if (framesSinceChange_ < IDLE_GRACE_FRAMES)
+        ++framesSinceChange_;
+
+    if (framesSinceChange_ < IDLE_GRACE_FRAMES)
+    {
+        lastSceneRenderTime_ = now;
+        return true;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+void Engine::RenderFramePacket(FramePacket& packet)
 {
     // this function executes rendering of each frame;
+    // NOTE: it is executed by the render thread in the game mode (if it is active)
+    // so it must not touch the ECS and the engine's state (only the packet)
+    PROFILE_SCOPE("Engine::RenderFramePacket");
+    MEM_TAG_SCOPE(MEM_TAG_RENDER);
+
     try
     {
         using namespace DirectX;
@@ -240,23 +649,35 @@ void Engine::RenderFrame()
         auto renderStartTime = std::chrono::steady_clock::now();
         D3DClass& d3d = graphics_.GetD3DClass();
         ID3D11DeviceContext* pContext = d3d.GetDeviceContext();
+        Render::GpuProfiler& gpuProfiler = pRender_->GetGpuProfiler();
+        SystemState& sysState = packet.sysState;
 
+        // GPU time of passes is measured for the whole frame (including UI)
+        gpuProfiler.BeginFrame(pContext);
        
-        if (systemState_.isEditorMode)
+        if (sysState.isEditorMode)
         {
             // Clear all the buffers before frame rendering and render our 3D scene
             d3d.ResetBackBufferRenderTarget();
             d3d.ResetViewport();
 
             d3d.BeginScene();
-            graphics_.Render3D(pEnttMgr_, pRender_);
+
+            if (!isSceneCached_)
+                graphics_.Render3D(packet, pRender_);
             
-            // begin rendering of the editor elements
-            imGuiLayer_.Begin();
-            RenderUI(pUserInterface_, pRender_);
+            // begin rendering of the editor elements (the editor is always rendered by
+            // the main thread and its UI changes the engine's state directly)
+            if (!isHeadless_)
+            {
+                gpuProfiler.BeginPass(pContext, Render::GPU_PASS_UI);
+                imGuiLayer_.Begin();
+                RenderUI(pUserInterface_, pRender_, systemState_);
 
-            ImGui::End();
-            imGuiLayer_.End();
+                ImGui::End();
+                imGuiLayer_.End();
+                gpuProfiler.EndPass(pContext, Render::GPU_PASS_UI);
+            }
         }
 
         // we aren't in the editor mode
@@ -264,12 +685,56 @@ void Engine::RenderFrame()
         {
             // Clear all the buffers before frame rendering and render our 3D scene
             d3d.BeginScene();
-            graphics_.Render3D(pEnttMgr_, pRender_);
+            graphics_.Render3D(packet, pRender_);
 
             // render game UI
-            RenderUI(pUserInterface_, pRender_);
+            gpuProfiler.BeginPass(pContext, Render::GPU_PASS_UI);
+            RenderUI(pUserInterface_, pRender_, sysState);
+            gpuProfiler.EndPass(pContext, Render::GPU_PASS_UI);
+        }
+
+        gpuProfiler.EndFrame(pContext);
+
+        // averaged GPU times (of frames which were finished a few frames ago)
+        sysState.gpuFrameTime = gpuProfiler.GetFrameTime();
+        sysState.numGpuPasses = Render::NUM_GPU_PASSES;
+
+        for (int i = 0; i < Render::NUM_GPU_PASSES; ++i)
+        {
+            const Render::eGpuPass pass = Render::eGpuPass(i);
+            sysState.gpuPassTimes[i] = gpuProfiler.GetPassTime(pass);
+            sysState.gpuPassNames[i] = Render::GpuProfiler::GetPassName(pass);
+        }
+
+        // render workload of this frame (including UI)
+        Render::g_FrameStats.EndFrame();
+        const Render::FrameStatsData& frameStats = Render::g_FrameStats.GetLastFrame();
+
+        sysState.numDrawCalls     = frameStats.total.numDraws;
+        sysState.numIndirectDraws = frameStats.total.numIndirect;
+        sysState.numInstances     = frameStats.total.numInstances;
+        sysState.numPrimitives    = frameStats.total.numPrimitives;
+
+        for (int i = 0; i < Render::NUM_GPU_PASSES; ++i)
+        {
+            sysState.gpuPassDraws[i]      = frameStats.passes[i].numDraws;
+            sysState.gpuPassInstances[i]  = frameStats.passes[i].numInstances;
+            sysState.gpuPassPrimitives[i] = frameStats.passes[i].numPrimitives;
+        }
+
+        sysState.numUploadTypes = Render::NUM_UPLOAD_TYPES;
+
+        for (int i = 0; i < Render::NUM_UPLOAD_TYPES; ++i)
+        {
+            sysState.uploadBytes[i]     = frameStats.uploadBytes[i];
+            sysState.uploadMaps[i]      = frameStats.numMaps[i];
+            sysState.uploadTypeNames[i] = Render::FrameStats::GetUploadTypeName(Render::eUploadType(i));
         }
 
+        const TexUploadStats& texUploads = g_TextureMgr.GetUploadStats();
+        sysState.texUploadBytes = texUploads.lastFrameBytes;
+        sysState.texUploadTiles = texUploads.lastFrameTiles;
+
         // Show the rendered stuff on the screen
         d3d.EndScene();
 
@@ -279,31 +744,61 @@ void Engine::RenderFrame()
         // compute the duration of the engine's rendering process
         auto renderEndTime = std::chrono::steady_clock::now();
         std::chrono::duration<float, std::milli> renderDuration = renderEndTime - renderStartTime;
-        systemState_.renderTime = renderDuration.count();
+        sysState.renderTime = renderDuration.count();
     }
     catch (EngineException & e)
     {
         LogErr(e, true);
         LogErr("can't render a frame");
-        isExit_ = true;                   // exit after it (shutdown the engine)
+        packet.isFailed = true;           // exit after it (shutdown the engine)
     }
 }
 
 ///////////////////////////////////////////////////////////
 
-void Engine::RenderUI(UI::UserInterface* pUI, Render::CRender* pRender)
+void Engine::SyncRenderThread()
+{
+    if (!isPacketInFlight_)
+        return;
+
+    renderThread_.Wait();
+    isPacketInFlight_ = false;
+
+    FinishFramePacket(framePackets_[currPacketIdx_]);
+}
+
+///////////////////////////////////////////////////////////
+
+void Engine::RenderUI(
+    UI::UserInterface* pUI,
+    Render::CRender* pRender,
+    SystemState& sysState)
 {
     D3DClass& d3d = graphics_.GetD3DClass();
 
     // preparation before 2D rendering
     d3d.TurnZBufferOff();
-    d3d.TurnOnBlending(ALPHA_ENABLE);
+    d3d.TurnOnBlending(RSMask(ALPHA_ENABLE));
     d3d.TurnOnRSfor2Drendering();
 
-    if (systemState_.isEditorMode)
+    // an idle frame of the editor: restore the scene image which was cached before
+    if (isSceneCached_)
+    {
+        graphics_.PresentCachedScene();
+    }
+    else
+    {
+        // the scene was rendered with a lower resolution (if the dynamic resolution is on)
+        graphics_.UpscaleScene(pRender);
+
+        if (sysState.isEditorMode && isEditorIdleRedraw_)
+            graphics_.CacheSceneImage();
+    }
+
+    if (sysState.isEditorMode)
     {
         // all render the scene view space and gizmos (if any entt is selected)
-        pUI->RenderSceneWnd(systemState_);
+        pUI->RenderSceneWnd(sysState);
 
         // HACK: we set background color for ImGui elements (except of scene windows)
         //       each fucking time because if we doesn't it we will have 
@@ -313,7 +808,7 @@ void Engine::RenderUI(UI::UserInterface* pUI, Render::CRender* pRender)
         colors[ImGuiCol_WindowBg] = imGuiLayer_.GetBackgroundColor();
 
         
-        pUI->RenderEditor(systemState_);
+        pUI->RenderEditor(sysState);
 
         // reset: ImGui window bg color to fully invisible since we
         //        want to see the scene through the window
@@ -326,7 +821,7 @@ void Engine::RenderUI(UI::UserInterface* pUI, Render::CRender* pRender)
         pUI->RenderGameUI(
             d3d.GetDeviceContext(),
             pRender->GetShadersContainer().fontShader_,
-            systemState_);
+            sysState);
     }
 
     // reset after 2D rendering
@@ -339,17 +834,40 @@ void Engine::RenderUI(UI::UserInterface* pUI, Render::CRender* pRender)
 // =================================================================================
 // Window events handlers 
 // =================================================================================
+void Engine::LimitFrameRate()
+{
+    // low rate modes only sleep (the CPU isn't busy with spinning)
+    if (isUnfocused_ && systemState_.isEditorMode)
+        frameLimiter_.Wait(unfocusedFps_, false);
+
+    else if (isPowerSaving_)
+        frameLimiter_.Wait(powerSaveFps_, false);
+
+    else
+        frameLimiter_.Wait(frameLimitFps_, true);
+}
+
+///////////////////////////////////////////////////////////
+
 void Engine::EventActivate(const APP_STATE state)
 {
     // define that the app is curretly running or paused
 
     if (state == APP_STATE::ACTIVATED)
     {
-        isPaused_ = false;
+        isPaused_    = false;
+        isUnfocused_ = false;
         timer_.Start();
     }
     else if (state == APP_STATE::DEACTIVATED)
     {
+        // the editor keeps ticking (with a low rate) so its window is still refreshed
+        if (systemState_.isEditorMode && isEditorIdleRedraw_)
+        {
+            isUnfocused_ = true;
+            return;
+        }
+
         isPaused_ = true;
         timer_.Stop();
     }
@@ -368,6 +886,9 @@ void Engine::EventWindowResize(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPara
 {
     SIZE newSize{ LOWORD(lParam), HIWORD(lParam) };
 
+    // the swap chain can't be resized while the render thread presents into it
+    SyncRenderThread();
+
     // try to resize the window
     if (!graphics_.GetD3DClass().ResizeSwapChain(hwnd, newSize))
     {
@@ -413,6 +934,8 @@ void Engine::EventWindowSizing(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPara
                 SWP_NOMOVE | SWP_NOZORDER);
 
             // try to resize the window
+            SyncRenderThread();
+
             if (!graphics_.GetD3DClass().ResizeSwapChain(hwnd, { width, height }))
                 PostQuitMessage(0);
 
@@ -685,6 +1208,14 @@ void Engine::HandleEditorEventKeyboard(UI::UserInterface* pUI, ECS::EntityMgr* p
 
                 break;
             }
+            case KEY_F6:
+            {
+                // capture a few frames by the CPU profiler (chrome://tracing)
+                if (!keyboard_.WasPressedBefore(KEY_F6))
+                    g_CpuProfiler.RequestCapture(10, "profile_trace.json");
+
+                break;
+            }
             case VK_ESCAPE:
             {
                 // if we pressed the ESC button we exit from the application
@@ -849,8 +1380,14 @@ void Engine::HandleGameEventKeyboard(UI::UserInterface* pUI, ECS::EntityMgr* pEn
 
 void Engine::EventKeyboard(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
-    // a handler for all the keyboard events
+    // a handler for all the keyboard events;
+    // the replay ignores the real input (it handles the recorded messages)
+    if (inputReplay_.IsReplaying())
+        return;
+
+    inputReplay_.RecordMessage(INPUT_REPLAY_KEYBOARD, uMsg, wParam, lParam);
     inputMgr_.HandleKeyboardMessage(keyboard_, uMsg, wParam, lParam);
+    hadInput_ = true;
 }
 
 
@@ -884,10 +1421,26 @@ void Engine::SwitchFlashLight(ECS::EntityMgr& mgr, Render::CRender& render)
 
 ///////////////////////////////////////////////////////////
 
+void Engine::SelectEntt(UI::UserInterface* pUI, const EntityID id, const bool isAdditive)
+{
+    // update the UI about selection of the entity (0 - nothing is selected);
+    // additive (ctrl+click): the entt is added to the selection or removed from there
+    if (isAdditive)
+    {
+        pUI->ToggleSelectedEntt(id);
+        return;
+    }
+
+    pUI->SetSelectedEntt(id);
+    //userInterface_.SetGizmoOperation(ImGuizmo::OPERATION::TRANSLATE);
+    pUI->SetGizmoOperation(ImGuizmo::OPERATION(-1));  // turn off the gizmo
+}
+
+///////////////////////////////////////////////////////////
+
 void Engine::HandleEditorEventMouse(UI::UserInterface* pUI, ECS::EntityMgr* pEnttMgr)
 {
     using enum MouseEvent::EventType;
-    static bool isMouseMiddlePressed = false;
 
     while (!mouse_.EventBufferIsEmpty())
     {
@@ -903,54 +1456,24 @@ void Engine::HandleEditorEventMouse(UI::UserInterface* pUI, ECS::EntityMgr* pEnt
                 systemState_.mouseY = mouseEvent_.GetPosY();
                 break;
             }
-            case RAW_MOVE:
-            {
-                // handle moving of the camera around fixed look_at point (if we set any fixed one)
-           
-                // if we want to rotate a camera
-                if (isMouseMiddlePressed)
-                {
-                    const EntityID camID      = pEnttMgr->nameSystem_.GetIdByName("editor_camera");
-                    ECS::CameraSystem& camSys = pEnttMgr->cameraSystem_;
-
-                    // rotate around some particular point
-                    if (camSys.IsFixedLook(camID))
-                    {
-                        assert(0 && "FIXME");
-                        //cam.RotateYAroundFixedLook(mouseEvent_.GetPosX() * 0.01f);
-                        //cam.PitchAroundFixedLook  (mouseEvent_.GetPosY() * 0.01f);
-                    }
-                    // rotate around itself
-                    else
-                    {
-                        camSys.Pitch  (camID, mouseEvent_.GetPosY() * deltaTime_);
-                        camSys.RotateY(camID, mouseEvent_.GetPosX() * deltaTime_);
-                    }
-                }
-                break;
-            }
             case LPress:
             {
 
                 // if we currenly hovering the scene window with our mouse
                 // and we don't hover any gizmo we execute entity picking (selection) test
-                if (pUI->IsSceneWndHovered() && !pUI->IsGizmoHovered())
+                // (with ALT the UI does box selection instead)
+                if (pUI->IsSceneWndHovered() && !pUI->IsGizmoHovered() && !keyboard_.IsPressed(KEY_ALT))
                 {
-                    EntityID selectedEnttID = 0;
-                    selectedEnttID = graphics_.TestEnttSelection(mouseEvent_.GetPosX(), mouseEvent_.GetPosY(), pEnttMgr_);
+                    const int sx = mouseEvent_.GetPosX();
+                    const int sy = mouseEvent_.GetPosY();
 
-                    // update the UI about selection of the entity
-                    if (selectedEnttID)
-                    {
-                        pUI->SetSelectedEntt(selectedEnttID);
-                        //userInterface_.SetGizmoOperation(ImGuizmo::OPERATION::TRANSLATE);
-                        pUI->SetGizmoOperation(ImGuizmo::OPERATION(-1));  // turn off the gizmo
-                    }
+                    isPickAdditive_ = keyboard_.IsPressed(KEY_CONTROL);
+
+                    // the result of GPU picking is handled in Update() a frame later
+                    if (graphics_.IsGpuPicking() && pRender_->GetEntityIdBuffer().IsInitialized())
+                        graphics_.RequestGpuPick(sx, sy);
                     else
-                    {
-                        pUI->SetSelectedEntt(0);
-                        pUI->SetGizmoOperation(ImGuizmo::OPERATION(-1));  // turn off the gizmo
-                    }
+                        SelectEntt(pUI, graphics_.TestEnttSelection(sx, sy, pEnttMgr_), isPickAdditive_);
 
                     // detach camera from any fixed look_at point
                     //graphics_.SetFixedLookState(false);
@@ -980,8 +1503,6 @@ void Engine::HandleEditorEventMouse(UI::UserInterface* pUI, ECS::EntityMgr* pEnt
                 }
                 break;
             }
-            case MPress:             isMouseMiddlePressed = true;  break;
-            case MRelease:           isMouseMiddlePressed = false; break;
             case LeftDoubleClick:
             {
                 return;
@@ -1046,22 +1567,6 @@ void Engine::HandleGameEventMouse(UI::UserInterface* pUI, ECS::EntityMgr* pEnttM
             SetCursorPos(800, 450);                           // to prevent the cursor to get out of the window
             break;
         }
-        case MouseEvent::EventType::RAW_MOVE:
-        {
-            // update the rotation data of the camera
-            // with the current state of the input devices. The movement function will update
-            // the position of the camera to the location for this frame
-
-            ECS::PlayerSystem& player = pEnttMgr->playerSystem_;
-
-            const float rotY  = mouseEvent_.GetPosX() * deltaTime_;
-            const float pitch = mouseEvent_.GetPosY() * deltaTime_;
-           
-            player.RotateY(rotY);
-            player.Pitch  (pitch);
-    
-            break;
-        }
     }
 }
 
@@ -1070,6 +1575,29 @@ void Engine::HandleGameEventMouse(UI::UserInterface* pUI, ECS::EntityMgr* pEnttM
 void Engine::EventMouse(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
     // handler for all the mouse events;
+    // the replay ignores the real input (it handles the recorded messages)
+    if (inputReplay_.IsReplaying())
+        return;
+
+    hadInput_ = true;
+
+    // raw deltas are queued and consumed by the simulation steps (see ApplyMouseLook());
+    // the recording writes deltas of each step instead of raw messages
+    if (uMsg == WM_INPUT)
+    {
+        inputMgr_.HandleRawInputMessage(rawInput_, wParam, lParam);
+        return;
+    }
+
+    inputReplay_.RecordMessage(INPUT_REPLAY_MOUSE, uMsg, wParam, lParam);
+    HandleMouseMessage(uMsg, wParam, lParam);
+}
+
+///////////////////////////////////////////////////////////
+
+void Engine::HandleMouseMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+    // a real or replayed mouse message (besides raw input)
 
     inputMgr_.HandleMouseMessage(mouse_, uMsg, wParam, lParam);
 
@@ -1094,6 +1622,8 @@ void Engine::TurnOnEditorMode()
 {
     // switch from the game to the editor mode
 
+    RestorePlaySnapshot();
+
     D3DClass&      d3d         = graphics_.GetD3DClass();
     const EntityID editorCamID = pEnttMgr_->nameSystem_.GetIdByName("editor_camera");
 
@@ -1129,6 +1659,162 @@ void Engine::TurnOnEditorMode()
 
 ///////////////////////////////////////////////////////////
 
+void Engine::TakePlaySnapshot()
+{
+    // write all the data of the world into memory (arrays of components
+    // are written as contiguous blocks so it is mostly memcpy)
+
+    auto start = std::chrono::steady_clock::now();
+
+    // the render thread can still touch the world; and chunks
+    // of the world partition must be in their final states
+    SyncRenderThread();
+    pEnttMgr_->worldPartitionSystem_.FinishIO();
+    playSnapshot_.Clear();
+
+    hasPlaySnapshot_ = pEnttMgr_->Serialize(playSnapshot_);
+
+    if (!hasPlaySnapshot_)
+    {
+        LogErr("can't take a snapshot of the world: changes of the play-test won't be reverted");
+        return;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = end - start;
+
+    LogMsgf("world snapshot is taken (%.2f MB, duration: %.2f ms)",
+            (double)playSnapshot_.GetDataSize() / (1024.0 * 1024.0),
+            elapsed.count());
+}
+
+///////////////////////////////////////////////////////////
+
+void Engine::RestorePlaySnapshot()
+{
+    // revert all the changes of the play-test: the world is replaced
+    // with the snapshot which was taken when the game mode was turned on
+
+    if (!hasPlaySnapshot_)
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // the render thread can still read the world
+    SyncRenderThread();
+    hasPlaySnapshot_ = false;
+
+    if (!playSnapshotReader_.LoadFromMemory(playSnapshot_) || !pEnttMgr_->Deserialize(playSnapshotReader_))
+    {
+        LogErr("can't restore the world from the snapshot");
+        return;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = end - start;
+
+    LogMsgf("world is restored from the snapshot (duration: %.2f ms)", elapsed.count());
+}
+
+///////////////////////////////////////////////////////////
+
+bool Engine::StartInputRecording(const char* filePath)
+{
+    // the world is saved as it is right now so the render thread must be done
+    // with it; and chunks of the world partition must be in their final states
+    SyncRenderThread();
+    pEnttMgr_->worldPartitionSystem_.FinishIO();
+
+    // a variable step depends on the real time so a recording always goes with a fixed one
+    if (simStep_ <= 0.0f)
+    {
+        simStep_ = 1.0f / 60.0f;
+        LogMsg("input recording: the simulation is switched to a fixed step (60 Hz)");
+    }
+
+    simAccumulator_ = 0.0f;
+
+    return inputReplay_.StartRecording(
+        filePath,
+        *pEnttMgr_,
+        simStep_,
+        deltaTime_,
+        simGameTime_,
+        systemState_.isEditorMode,
+        replayCheckpointFrames_);
+}
+
+///////////////////////////////////////////////////////////
+
+bool Engine::StartInputReplay(const char* filePath, const char* tracePath)
+{
+    // restore the world of the recording and set up the simulation as it was
+    // at the first recorded frame; all the replayed frames are profiled
+
+    SyncRenderThread();
+    pEnttMgr_->worldPartitionSystem_.FinishIO();
+
+    if (!inputReplay_.StartReplay(filePath, *pEnttMgr_))
+        return false;
+
+    const InputReplayHeader& header = inputReplay_.GetHeader();
+
+    // the same mode as of the recording (the restored world mustn't be replaced with a play snapshot)
+    if ((bool)header.isEditorMode != systemState_.isEditorMode)
+    {
+        hasPlaySnapshot_ = false;
+
+        if (header.isEditorMode)
+            TurnOnEditorMode();
+        else
+            TurnOnGameMode();
+    }
+
+    simStep_        = header.simStep;
+    simAccumulator_ = 0.0f;
+    simGameTime_    = header.startGameTime;
+    deltaTime_      = header.prevDeltaTime;
+
+    g_CpuProfiler.RequestCapture((int)inputReplay_.GetNumFrames(), tracePath);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void Engine::ReplayFrameInput()
+{
+    // feed the recorded messages and delta time of the frame instead of the real ones
+
+    float deltaTime = deltaTime_;
+
+    // all the frames are replayed (the trace of the profiler is written by now)
+    if (!inputReplay_.BeginFrame(deltaTime))
+    {
+        inputReplay_.Stop();
+        isExit_ = true;
+        return;
+    }
+
+    uint32 numMsgs = 0;
+    const InputReplayMsg* msgs = inputReplay_.GetFrameMessages(numMsgs);
+
+    // messages came before the frame so their handlers still use the prev delta time
+    for (uint32 i = 0; i < numMsgs; ++i)
+    {
+        const InputReplayMsg& msg = msgs[i];
+
+        if (msg.device == INPUT_REPLAY_KEYBOARD)
+            inputMgr_.HandleKeyboardMessage(keyboard_, msg.msg, (WPARAM)msg.wParam, (LPARAM)msg.lParam);
+        else
+            HandleMouseMessage(msg.msg, (WPARAM)msg.wParam, (LPARAM)msg.lParam);
+    }
+
+    hadInput_  = hadInput_ || (numMsgs > 0);
+    deltaTime_ = deltaTime;
+}
+
+///////////////////////////////////////////////////////////
+
 void TurnOnMouseLookBehavior(HWND hwnd)
 {
     // limit the cursor to the be always in the window rectangle
@@ -1150,10 +1836,53 @@ void TurnOnMouseLookBehavior(HWND hwnd)
 
 ///////////////////////////////////////////////////////////
 
+void Engine::FinishFramePacket(const FramePacket& packet)
+{
+    // copy the stats of the rendered frame back into the engine's state
+
+    const SystemState& rendered = packet.sysState;
+
+    systemState_.visibleVerticesCount = rendered.visibleVerticesCount;
+    systemState_.numBindsIssued       = rendered.numBindsIssued;
+    systemState_.numBindsFiltered     = rendered.numBindsFiltered;
+    systemState_.renderTime           = rendered.renderTime;
+    systemState_.gpuFrameTime         = rendered.gpuFrameTime;
+    systemState_.numGpuPasses         = rendered.numGpuPasses;
+
+    memcpy(systemState_.gpuPassTimes, rendered.gpuPassTimes, sizeof(rendered.gpuPassTimes));
+    memcpy(systemState_.gpuPassNames, rendered.gpuPassNames, sizeof(rendered.gpuPassNames));
+
+    systemState_.numDrawCalls     = rendered.numDrawCalls;
+    systemState_.numIndirectDraws = rendered.numIndirectDraws;
+    systemState_.numInstances     = rendered.numInstances;
+    systemState_.numPrimitives    = rendered.numPrimitives;
+    systemState_.numBindTypes     = rendered.numBindTypes;
+    systemState_.numUploadTypes   = rendered.numUploadTypes;
+    systemState_.texUploadBytes   = rendered.texUploadBytes;
+    systemState_.texUploadTiles   = rendered.texUploadTiles;
+
+    memcpy(systemState_.gpuPassDraws,      rendered.gpuPassDraws,      sizeof(rendered.gpuPassDraws));
+    memcpy(systemState_.gpuPassInstances,  rendered.gpuPassInstances,  sizeof(rendered.gpuPassInstances));
+    memcpy(systemState_.gpuPassPrimitives, rendered.gpuPassPrimitives, sizeof(rendered.gpuPassPrimitives));
+    memcpy(systemState_.bindsIssued,       rendered.bindsIssued,       sizeof(rendered.bindsIssued));
+    memcpy(systemState_.bindsFiltered,     rendered.bindsFiltered,     sizeof(rendered.bindsFiltered));
+    memcpy(systemState_.bindTypeNames,     rendered.bindTypeNames,     sizeof(rendered.bindTypeNames));
+    memcpy(systemState_.uploadBytes,       rendered.uploadBytes,       sizeof(rendered.uploadBytes));
+    memcpy(systemState_.uploadMaps,        rendered.uploadMaps,        sizeof(rendered.uploadMaps));
+    memcpy(systemState_.uploadTypeNames,   rendered.uploadTypeNames,   sizeof(rendered.uploadTypeNames));
+
+    if (packet.isFailed)
+        isExit_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
 void Engine::TurnOnGameMode()
 {
     // switch from the editor to the game mode
 
+    TakePlaySnapshot();
+
     const EntityID gameCamID = pEnttMgr_->nameSystem_.GetIdByName("game_camera");
 
     graphics_.GetD3DClass().ToggleFullscreen(hwnd_, true);
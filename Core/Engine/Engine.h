@@ -11,6 +11,10 @@
 #include <CoreCommon/SystemState.h>
 
 #include "EventListener.h"
+#include "RenderThread.h"
+#include "TelemetrySampler.h"
+#include "InputReplay.h"
+#include "AssetHotReloader.h"
 
 #include "../ImGui/ImGuiLayer.h"
 #include "../Sound/SoundClass.h"
@@ -25,9 +29,9 @@
 // window module
 #include "../Window/WindowContainer.h"
 
-// cpu/times
-#include "../Timers/cpuclass.h"
+// times
 #include "../Timers/GameTimer.h"
+#include "../Timers/FrameLimiter.h"
 
 // graphics stuff
 #include "../Mesh/MaterialMgr.h"
@@ -68,21 +72,62 @@ public:
 
     bool InitializeGUI(D3DClass& d3d, const Settings& settings);
 
+    // wait until the swap chain can accept a new frame (must be called before
+    // window messages are processed so the frame is based on the latest input)
+    void WaitForNextFrame();
+
     // update the state of the engine/game for the current frame
     void Update();                         
 
+    void UpdateSimulation();               // update the ECS with a fixed (or variable) step
+
+    // rotate the camera (editor) or the player (game) by raw mouse deltas
+    // which came before the time (QPC ticks)
+    void ApplyMouseLook(const int64_t untilTicks);
     void CalculateFrameStats();            // measure the number of frames being rendered per second (FPS)
-    void RenderFrame();                    // do all the rendering onto the screen
-    void RenderUI(UI::UserInterface* pUI, Render::CRender* pRender);
+
+    // extract a frame packet and render it (right now or by the render thread)
+    void RenderFrame();
+    void RenderFramePacket(FramePacket& packet);
+    void RenderUI(UI::UserInterface* pUI, Render::CRender* pRender, SystemState& sysState);
+
+    // wait until the render thread is finished with the frame in flight (if any)
+    // and copy the stats of its packet back; must be called before the main
+    // thread touches the renderer or the immediate context
+    void SyncRenderThread();
+
+    // is the frame rendered by the render thread? (the editor's UI reads/writes
+    // the ECS during rendering so the editor mode is always rendered in place)
+    inline bool IsRenderThreadActive() const { return renderThread_.IsRunning() && !systemState_.isEditorMode; }
 
     inline bool IsPaused()                   const { return isPaused_; }
+
+    // wait until the next frame according to the frame cap: the editor isn't
+    // paused when its window isn't focused but ticks with a low rate; the
+    // power-saving mode (e.g. for menus) ticks with a low rate as well
+    void LimitFrameRate();
+
+    inline void SetPowerSaving(const bool state)   { isPowerSaving_ = state; }
+    inline bool IsPowerSaving()              const { return isPowerSaving_; }
     inline bool IsExit()                     const { return isExit_; }
 
+    // there is no window (and no editor UI): is initialized by a NULL window handle
+    inline bool IsHeadless()                 const { return isHeadless_; }
+
     // access functions return a copy of the main window handle or app instance handle;
     inline HWND           GetHWND()          const { return hwnd_; }
     inline HINSTANCE      GetInstance()      const { return hInstance_; }
     inline CGraphics& GetGraphicsClass()       { return graphics_; }
     inline GameTimer&     GetTimer()               { return timer_; }
+    inline const SystemState& GetSystemState() const { return systemState_; }
+    inline AssetHotReloader& GetAssetHotReloader()     { return assetHotReloader_; }
+
+    // record the session (input, delta time, seed and the world) or replay the recorded
+    // one instead of the real time and input; the replay is profiled and the engine
+    // exits when all the frames are replayed (see InputReplay)
+    bool StartInputRecording(const char* filePath);
+    bool StartInputReplay(const char* filePath, const char* tracePath);
+    inline bool IsInputReplaying()           const { return inputReplay_.IsReplaying(); }
 
     // event listener methods implementation
     virtual void EventActivate(const APP_STATE state) override;
@@ -104,6 +149,10 @@ public:
 
     void HandleEditorEventMouse(UI::UserInterface* pUI, ECS::EntityMgr* pEnttMgr);
     void HandleGameEventMouse(UI::UserInterface* pUI, ECS::EntityMgr* pEnttMgr);
+    void SelectEntt(UI::UserInterface* pUI, const EntityID id, const bool isAdditive = false);
+
+    // idle frames of the editor: is anything which is seen changed since the last render of the scene?
+    bool IsSceneChanged();
 
     void RenderModelIntoTexture(
         ID3D11DeviceContext* pContext,
@@ -114,6 +163,11 @@ public:
 private:
     void TurnOnEditorMode();
     void TurnOnGameMode();
+    void TakePlaySnapshot();
+    void RestorePlaySnapshot();
+    void FinishFramePacket(const FramePacket& packet);
+    void HandleMouseMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
+    void ReplayFrameInput();
 
 private:
     HWND      hwnd_         = NULL;             // main window handle
@@ -124,16 +178,62 @@ private:
     bool      isMinimized_  = false;            // is the window minimized?
     bool      isMaximized_  = true;             // is the window maximized?
     bool      isResizing_   = false;            // are we resizing the window?
+    bool      isPickAdditive_ = false;          // the pending pick was requested with ctrl (added to the selection)
+    bool      isHeadless_   = false;            // no window: perf checks on machines without GPUs
     float     deltaTime_    = 0.0f;             // the time since the previous frame
 
+    // fixed-step simulation: the ECS is updated with a constant step (0 - a variable step once per frame)
+    // and the renderer interpolates transformations between the two last steps
+    static constexpr int MAX_SIM_STEPS_PER_FRAME = 5;  // so a long frame can't cause a spiral of death
+    float     simStep_        = 0.0f;
+    float     simAccumulator_ = 0.0f;
+    float     simGameTime_    = 0.0f;
+
     std::string windowTitle_{ "" };             // window title/caption
 
     //Settings           settings_;             // settings container							   
     SystemState         systemState_;           // contains different info about the state of the engine
-    CpuClass            cpu_;                   // cpu usage counter
+    TelemetrySampler    telemetry_;             // cpu/memory usage (is sampled by its own thread)
     GameTimer           timer_;                 // used to keep track of the "delta-time" and game time
 
+    // frame pacing: the cap of the usual mode (0 - no cap) and of the low rate modes
+    FrameLimiter        frameLimiter_;
+    int                 frameLimitFps_  = 0;
+    int                 powerSaveFps_   = 30;
+    int                 unfocusedFps_   = 10;
+    bool                isPowerSaving_  = false;
+
+    // frame times (ms) of the last frames for percentiles of the frame stats
+    static constexpr int NUM_FRAME_TIME_SAMPLES = 256;
+    float               frameTimeSamples_[NUM_FRAME_TIME_SAMPLES]{ 0.0f };
+    int                 numFrameTimeSamples_ = 0;
+    int                 frameTimeSampleIdx_  = 0;
+
+    // a frame is rendered from its packet; the render thread consumes the packet
+    // of the prev frame while the main thread simulates the next one
+    RenderThread        renderThread_;
+    FramePacket         framePackets_[2];
+    int                 currPacketIdx_    = 0;
+    bool                isPacketInFlight_ = false;
+
+    // play-in-editor: the world is snapshotted into memory when the game mode is
+    // turned on and is restored when we go back into the editor (so the play-test
+    // doesn't change the edited world); buffers are kept between play-tests
+    ECS::WorldFileWriter playSnapshot_;
+    ECS::WorldFileReader playSnapshotReader_;
+    bool                 hasPlaySnapshot_ = false;
+
+    // deterministic recording/replay of input for reproducible perf runs;
+    // the world is hashed each replayCheckpointFrames_ to detect a divergence
+    InputReplay          inputReplay_;
+    int                  replayCheckpointFrames_ = 300;
+
+    // reloads changed assets at a sync point of the frame (see Update())
+    AssetHotReloader    assetHotReloader_;
+
     InputManager        inputMgr_;
+    RawInputQueue       rawInput_;              // timestamped raw mouse deltas (consumed per simulation step)
+    float               mouseSensitivity_ = 0.0166f;
     KeyboardClass       keyboard_;              // represents a keyboard device
     MouseClass          mouse_;                 // represents a mouse device
     CGraphics           graphics_;              // rendering system
@@ -144,6 +244,22 @@ private:
     MouseEvent          mouseEvent_;          // the current mouse event
     SoundClass          sound_;
 
+    // idle-throttled editor: the scene is rendered only if something could be changed
+    // (the camera, transforms, entts, input, assets) or once in a while for time
+    // animations; otherwise its cached image is presented under UI
+    static constexpr int IDLE_GRACE_FRAMES = 4;   // frames which are still redrawn after a change (GPU readbacks, culling of the prev frame)
+    bool                isEditorIdleRedraw_  = false;
+    bool                isSceneCached_       = false;   // the current frame presents the cached scene image
+    bool                isUnfocused_         = false;
+    bool                hadInput_            = false;   // input events since the prev frame
+    int                 idleRedrawMs_        = 250;
+    int                 framesSinceChange_   = 0;
+    uint32              lastStructVersion_   = 0;
+    uint32              lastSRVsVersion_     = 0;
+    std::chrono::steady_clock::time_point lastSceneRenderTime_;
+    DirectX::XMMATRIX   lastCamView_;
+    DirectX::XMMATRIX   lastCamProj_;
+
     ECS::EntityMgr*     pEnttMgr_ = nullptr;
     UI::UserInterface*  pUserInterface_ = nullptr;
     Render::CRender*    pRender_ = nullptr;
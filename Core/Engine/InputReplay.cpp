@@ -0,0 +1,446 @@
+// =================================================================================
+// Filename:     InputReplay.cpp
+// Description:  implementation of the InputReplay's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "InputReplay.h"
+
+#include <time.h>
+
+#pragma warning (disable : 4996)
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// Desc:   the path of the world which is stored along with the replay
+//---------------------------------------------------------
+static void GetWorldPath(const char* replayPath, char* outPath, const int bufSize)
+{
+    snprintf(outPath, bufSize, "%s.world", replayPath);
+}
+
+///////////////////////////////////////////////////////////
+
+InputReplay::~InputReplay()
+{
+    Stop();
+}
+
+//---------------------------------------------------------
+// Desc:   find args of the recording/replay in the command line:
+//         Sandbox.exe --record-input path
+//         Sandbox.exe --replay-input path [trace=path]
+// Args:   - outPath:      a buffer for the path of the replay file
+//         - outTracePath: a buffer for the path of the profiler's trace (replay only)
+//---------------------------------------------------------
+eInputReplayMode InputReplay::ParseCmdLine(
+    int argc,
+    char* argv[],
+    char* outPath,
+    char* outTracePath,
+    const int bufSize)
+{
+    eInputReplayMode mode = INPUT_REPLAY_NONE;
+
+    snprintf(outTracePath, bufSize, "%s", "replay_trace.json");
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+
+        const bool isRecord = (strcmp(arg, "--record-input") == 0);
+        const bool isReplay = (strcmp(arg, "--replay-input") == 0);
+
+        if (isRecord || isReplay)
+        {
+            if (i + 1 >= argc)
+            {
+                sprintf(g_String, "no path after the arg: %s", arg);
+                LogErr(g_String);
+                return INPUT_REPLAY_NONE;
+            }
+
+            mode = (isRecord) ? INPUT_REPLAY_RECORD : INPUT_REPLAY_PLAY;
+            snprintf(outPath, bufSize, "%s", argv[++i]);
+        }
+        else if (strncmp(arg, "trace=", 6) == 0)
+        {
+            snprintf(outTracePath, bufSize, "%s", arg + 6);
+        }
+    }
+
+    return mode;
+}
+
+//---------------------------------------------------------
+// Desc:   save the world as it is right now, seed rand() and start writing frames
+// Args:   - filePath:           where to write frames (the world goes nearby)
+//         - simStep:            the fixed step of the simulation
+//         - prevDeltaTime:      delta time of the frame before the first recorded one
+//         - startGameTime:      game time of the simulation at the first recorded frame
+//         - isEditorMode:       the mode has to be the same during the replay
+//         - checkpointInterval: frames between hashes of the world (0 - no hashes)
+//---------------------------------------------------------
+bool InputReplay::StartRecording(
+    const char* filePath,
+    ECS::EntityMgr& mgr,
+    const float simStep,
+    const float prevDeltaTime,
+    const float startGameTime,
+    const bool isEditorMode,
+    const int checkpointInterval)
+{
+    if (mode_ != INPUT_REPLAY_NONE)
+    {
+        LogErr("the input recording (or replay) is already started");
+        return false;
+    }
+
+    if (!filePath || (filePath[0] == '\0'))
+    {
+        LogErr("input path to the replay file is empty");
+        return false;
+    }
+
+    char worldPath[256]{ '\0' };
+    GetWorldPath(filePath, worldPath, sizeof(worldPath));
+
+    worldWriter_.Clear();
+
+    if (!mgr.Serialize(worldWriter_) || !worldWriter_.SaveToFile(worldPath))
+    {
+        sprintf(g_String, "can't save the world of the input recording: %s", worldPath);
+        LogErr(g_String);
+        return false;
+    }
+
+    pFile_ = fopen(filePath, "wb");
+
+    if (!pFile_)
+    {
+        sprintf(g_String, "can't open the replay file for writing: %s", filePath);
+        LogErr(g_String);
+        return false;
+    }
+
+    header_                    = {};
+    header_.magic              = MAGIC;
+    header_.version            = VERSION;
+    header_.seed               = (uint32)time(NULL);
+    header_.checkpointInterval = (checkpointInterval > 0) ? (uint32)checkpointInterval : 0;
+    header_.isEditorMode       = isEditorMode;
+    header_.simStep            = simStep;
+    header_.prevDeltaTime      = prevDeltaTime;
+    header_.startGameTime      = startGameTime;
+
+    // the header is rewritten with the number of frames when the recording is stopped
+    fwrite(&header_, sizeof(header_), 1, pFile_);
+
+    srand(header_.seed);
+
+    msgs_.clear();
+    looks_.clear();
+    currFrame_   = {};
+    frameIdx_    = 0;
+    mode_        = INPUT_REPLAY_RECORD;
+
+    LogMsgf("input recording is started: %s (seed: %u)", filePath, header_.seed);
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   read all the frames of the replay into memory, restore the world
+//         of the recording and seed rand() with the recorded seed
+//---------------------------------------------------------
+bool InputReplay::StartReplay(const char* filePath, ECS::EntityMgr& mgr)
+{
+    if (mode_ != INPUT_REPLAY_NONE)
+    {
+        LogErr("the input recording (or replay) is already started");
+        return false;
+    }
+
+    if (!filePath || (filePath[0] == '\0'))
+    {
+        LogErr("input path to the replay file is empty");
+        return false;
+    }
+
+    FILE* pFile = fopen(filePath, "rb");
+
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open the replay file: %s", filePath);
+        LogErr(g_String);
+        return false;
+    }
+
+    header_ = {};
+
+    if ((fread(&header_, sizeof(header_), 1, pFile) != 1) ||
+        (header_.magic   != MAGIC) ||
+        (header_.version != VERSION))
+    {
+        sprintf(g_String, "invalid header of the replay file: %s", filePath);
+        LogErr(g_String);
+        fclose(pFile);
+        return false;
+    }
+
+    frames_.clear();
+    msgs_.clear();
+    looks_.clear();
+
+    // if the recording wasn't stopped (a crash) we still read all the whole frames
+    InputReplayFrame frame;
+    bool isCorrupted = false;
+
+    while (fread(&frame, sizeof(frame), 1, pFile) == 1)
+    {
+        frame.firstMsg  = (uint32)msgs_.size();
+        frame.firstLook = (uint32)looks_.size();
+
+        msgs_.resize(msgs_.size() + frame.numMsgs);
+        looks_.resize(looks_.size() + frame.numLooks);
+
+        if ((fread(msgs_.data()  + frame.firstMsg,  sizeof(InputReplayMsg),  frame.numMsgs,  pFile) != frame.numMsgs) ||
+            (fread(looks_.data() + frame.firstLook, sizeof(InputReplayLook), frame.numLooks, pFile) != frame.numLooks))
+        {
+            isCorrupted = true;
+            break;
+        }
+
+        frames_.push_back(frame);
+    }
+
+    fclose(pFile);
+
+    if (isCorrupted)
+    {
+        sprintf(g_String, "the last frame of the replay is truncated (%d frames are read): %s", (int)frames_.size(), filePath);
+        LogErr(g_String);
+    }
+
+    // the run starts from the same world
+    char worldPath[256]{ '\0' };
+    GetWorldPath(filePath, worldPath, sizeof(worldPath));
+
+    if (!worldReader_.LoadFromFile(worldPath) || !mgr.Deserialize(worldReader_))
+    {
+        sprintf(g_String, "can't restore the world of the replay: %s", worldPath);
+        LogErr(g_String);
+        frames_.clear();
+        return false;
+    }
+
+    srand(header_.seed);
+
+    currFrame_          = {};
+    frameIdx_           = 0;
+    lookIdx_            = 0;
+    numDiverged_        = 0;
+    firstDivergedFrame_ = 0;
+    mode_               = INPUT_REPLAY_PLAY;
+
+    LogMsgf("input replay is started: %s (frames: %d, seed: %u)", filePath, (int)frames_.size(), header_.seed);
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   finish the recording (the header gets the number of frames) or the replay
+//---------------------------------------------------------
+void InputReplay::Stop()
+{
+    if (mode_ == INPUT_REPLAY_RECORD)
+    {
+        header_.numFrames = frameIdx_;
+
+        fseek(pFile_, 0, SEEK_SET);
+        fwrite(&header_, sizeof(header_), 1, pFile_);
+        fclose(pFile_);
+        pFile_ = nullptr;
+
+        LogMsgf("input recording is stopped (frames: %u)", frameIdx_);
+    }
+    else if (mode_ == INPUT_REPLAY_PLAY)
+    {
+        LogMsgf("input replay is stopped (frames: %u of %d)", frameIdx_, (int)frames_.size());
+
+        if (numDiverged_ > 0)
+        {
+            sprintf(g_String, "the replay diverged from the recording since frame %u (%u checkpoints mismatch)", firstDivergedFrame_, numDiverged_);
+            LogErr(g_String);
+        }
+    }
+
+    mode_ = INPUT_REPLAY_NONE;
+    frames_.clear();
+    msgs_.clear();
+    looks_.clear();
+}
+
+//---------------------------------------------------------
+// Desc:   is called at the start of the engine's update
+// Args:   - inOutDeltaTime: the real delta time (it is recorded) or is replaced
+//                           with the recorded one
+// Ret:    false if all the frames are replayed
+//---------------------------------------------------------
+bool InputReplay::BeginFrame(float& inOutDeltaTime)
+{
+    if (mode_ == INPUT_REPLAY_RECORD)
+    {
+        // messages of the frame are already in msgs_: they came before the update
+        currFrame_           = {};
+        currFrame_.deltaTime = inOutDeltaTime;
+        return true;
+    }
+
+    if (mode_ != INPUT_REPLAY_PLAY)
+        return true;
+
+    if (frameIdx_ >= (uint32)frames_.size())
+        return false;
+
+    currFrame_     = frames_[frameIdx_];
+    lookIdx_       = 0;
+    inOutDeltaTime = currFrame_.deltaTime;
+
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   is called at the end of the engine's update: write the frame (recording)
+//         or compare the world with the recorded checkpoint (replay)
+//---------------------------------------------------------
+void InputReplay::EndFrame(ECS::EntityMgr& mgr)
+{
+    if (mode_ == INPUT_REPLAY_RECORD)
+    {
+        currFrame_.numMsgs  = (uint32)msgs_.size();
+        currFrame_.numLooks = (uint32)looks_.size();
+
+        if ((header_.checkpointInterval > 0) && (frameIdx_ % header_.checkpointInterval == 0))
+        {
+            currFrame_.hasCheckpoint  = 1;
+            currFrame_.checkpointHash = HashWorld(mgr);
+        }
+
+        fwrite(&currFrame_,   sizeof(currFrame_),      1,                   pFile_);
+        fwrite(msgs_.data(),  sizeof(InputReplayMsg),  currFrame_.numMsgs,  pFile_);
+        fwrite(looks_.data(), sizeof(InputReplayLook), currFrame_.numLooks, pFile_);
+
+        msgs_.clear();
+        looks_.clear();
+        ++frameIdx_;
+    }
+    else if (mode_ == INPUT_REPLAY_PLAY)
+    {
+        if (currFrame_.hasCheckpoint && (HashWorld(mgr) != currFrame_.checkpointHash))
+        {
+            if (numDiverged_ == 0)
+            {
+                firstDivergedFrame_ = frameIdx_;
+                sprintf(g_String, "the world of the replay diverged from the recording at frame %u", frameIdx_);
+                LogErr(g_String);
+            }
+
+            ++numDiverged_;
+        }
+
+        ++frameIdx_;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   store a keyboard/mouse message till the end of the next update
+//         (the replay ignores the real input)
+//---------------------------------------------------------
+void InputReplay::RecordMessage(
+    const eInputReplayDevice device,
+    const UINT msg,
+    const WPARAM wParam,
+    const LPARAM lParam)
+{
+    if (mode_ != INPUT_REPLAY_RECORD)
+        return;
+
+    InputReplayMsg rec;
+    rec.device = device;
+    rec.msg    = msg;
+    rec.wParam = (uint64)wParam;
+    rec.lParam = (int64_t)lParam;
+
+    msgs_.push_back(rec);
+}
+
+//---------------------------------------------------------
+// Desc:   get recorded messages of the current replayed frame
+//---------------------------------------------------------
+const InputReplayMsg* InputReplay::GetFrameMessages(uint32& outNumMsgs) const
+{
+    if (mode_ != INPUT_REPLAY_PLAY)
+    {
+        outNumMsgs = 0;
+        return nullptr;
+    }
+
+    outNumMsgs = currFrame_.numMsgs;
+    return msgs_.data() + currFrame_.firstMsg;
+}
+
+//---------------------------------------------------------
+// Desc:   is called by each simulation step which consumes raw mouse deltas
+//---------------------------------------------------------
+void InputReplay::MouseLook(int& inOutDx, int& inOutDy, bool& inOutHasDeltas)
+{
+    if (mode_ == INPUT_REPLAY_RECORD)
+    {
+        looks_.push_back({ inOutDx, inOutDy, inOutHasDeltas });
+    }
+    else if (mode_ == INPUT_REPLAY_PLAY)
+    {
+        InputReplayLook look;
+
+        // the replay makes the same steps so there is a record for each of them
+        if (lookIdx_ < currFrame_.numLooks)
+            look = looks_[currFrame_.firstLook + lookIdx_++];
+
+        inOutDx        = look.dx;
+        inOutDy        = look.dy;
+        inOutHasDeltas = (look.hasDeltas != 0);
+    }
+}
+
+
+// =================================================================================
+// private methods
+// =================================================================================
+
+//---------------------------------------------------------
+// Desc:   FNV-1a hash of the serialized world (chunks of the world partition
+//         are finished first so both the recording and the replay hash the same)
+//---------------------------------------------------------
+uint64 InputReplay::HashWorld(ECS::EntityMgr& mgr)
+{
+    mgr.worldPartitionSystem_.FinishIO();
+
+    worldWriter_.Clear();
+    mgr.Serialize(worldWriter_);
+
+    const cvector<uint8>& data = worldWriter_.GetData();
+    uint64 hash = 14695981039346656037ULL;
+
+    for (const uint8 byte : data)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+} // namespace Core
@@ -0,0 +1,173 @@
+// =================================================================================
+// Filename:     InputReplay.h
+// Description:  deterministic recording and replay of a session for reproducible
+//               performance runs: per frame we record the delta time, keyboard and
+//               mouse messages (as they came into the window proc), and raw mouse
+//               deltas consumed by each simulation step; a seed of rand() and the
+//               world (ECS) at the start are stored as well;
+//
+//               the replay restores the world, forces the recorded fixed step and
+//               feeds the same sequence into Engine::Update() instead of the real
+//               time and input (so a run can be profiled again and again);
+//
+//               each N frames a hash of the serialized world is stored as
+//               a checkpoint so the replay detects where it diverged
+//
+//               file:   [header][frame_0][frame_1]...[frame_N]
+//               frame:  [InputReplayFrame][messages][mouse looks]
+//               world:  the path of the replay + ".world" (see WorldFileWriter)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include "Entity/EntityMgr.h"
+#include <stdio.h>
+#include <windows.h>
+
+
+namespace Core
+{
+
+enum eInputReplayMode
+{
+    INPUT_REPLAY_NONE,
+    INPUT_REPLAY_RECORD,
+    INPUT_REPLAY_PLAY,
+};
+
+enum eInputReplayDevice : uint32
+{
+    INPUT_REPLAY_KEYBOARD,
+    INPUT_REPLAY_MOUSE,
+};
+
+///////////////////////////////////////////////////////////
+
+struct InputReplayHeader
+{
+    uint32 magic              = 0;
+    uint32 version            = 0;
+    uint32 seed               = 0;      // of rand() (MathHelper::RandF, etc.)
+    uint32 numFrames          = 0;      // is written when the recording is stopped
+    uint32 checkpointInterval = 0;      // frames between hashes of the world (0 - no checkpoints)
+    uint32 isEditorMode       = 0;
+    float  simStep            = 0;      // the fixed step of the recorded simulation
+    float  prevDeltaTime      = 0;      // delta time before the first frame (mouse handlers use it)
+    float  startGameTime      = 0;      // game time of the simulation at the first frame
+};
+
+struct InputReplayMsg
+{
+    uint32  device = 0;                 // eInputReplayDevice
+    uint32  msg    = 0;
+    uint64  wParam = 0;
+    int64_t lParam = 0;
+};
+
+struct InputReplayLook
+{
+    int32_t dx        = 0;
+    int32_t dy        = 0;
+    uint32  hasDeltas = 0;
+};
+
+struct InputReplayFrame
+{
+    float  deltaTime      = 0;
+    uint32 numMsgs        = 0;
+    uint32 numLooks       = 0;
+    uint32 hasCheckpoint  = 0;
+    uint64 checkpointHash = 0;
+    uint32 firstMsg       = 0;          // (replay only) idx of the first message of the frame
+    uint32 firstLook      = 0;          // (replay only) idx of the first mouse look of the frame
+};
+
+///////////////////////////////////////////////////////////
+
+class InputReplay
+{
+public:
+    static constexpr uint32 MAGIC   = 0x50524945;   // "EIRP" (engine input replay)
+    static constexpr uint32 VERSION = 1;
+
+public:
+    InputReplay() {}
+    ~InputReplay();
+
+    // restrict a copying of this class instance
+    InputReplay(const InputReplay&) = delete;
+    InputReplay& operator=(const InputReplay&) = delete;
+
+    // find "--record-input path" or "--replay-input path [trace=path]" in args of the command line
+    static eInputReplayMode ParseCmdLine(
+        int argc,
+        char* argv[],
+        char* outPath,
+        char* outTracePath,
+        const int bufSize);
+
+    // snapshot the world, seed rand() and start writing frames into the file
+    bool StartRecording(
+        const char* filePath,
+        ECS::EntityMgr& mgr,
+        const float simStep,
+        const float prevDeltaTime,
+        const float startGameTime,
+        const bool isEditorMode,
+        const int checkpointInterval);
+
+    // read all the frames and restore the world of the recording
+    // (the caller applies the mode and the fixed step of the header)
+    bool StartReplay(const char* filePath, ECS::EntityMgr& mgr);
+
+    void Stop();
+
+    // record the delta time or replace it with the recorded one;
+    // ret: false if the replay is over
+    bool BeginFrame(float& inOutDeltaTime);
+
+    // write the frame (recording) or check the world against its checkpoint (replay)
+    void EndFrame(ECS::EntityMgr& mgr);
+
+    // a keyboard/mouse message which came from the window (is ignored by the replay)
+    void RecordMessage(const eInputReplayDevice device, const UINT msg, const WPARAM wParam, const LPARAM lParam);
+
+    // messages of the current replayed frame
+    const InputReplayMsg* GetFrameMessages(uint32& outNumMsgs) const;
+
+    // record the mouse deltas of a simulation step or replace them with the recorded ones
+    void MouseLook(int& inOutDx, int& inOutDy, bool& inOutHasDeltas);
+
+    inline eInputReplayMode         GetMode()      const { return mode_; }
+    inline bool                     IsRecording()  const { return mode_ == INPUT_REPLAY_RECORD; }
+    inline bool                     IsReplaying()  const { return mode_ == INPUT_REPLAY_PLAY; }
+    inline const InputReplayHeader& GetHeader()    const { return header_; }
+    inline uint32                   GetNumFrames() const { return (uint32)frames_.size(); }
+    inline uint32                   GetNumDivergedCheckpoints() const { return numDiverged_; }
+
+private:
+    uint64 HashWorld(ECS::EntityMgr& mgr);
+
+private:
+    eInputReplayMode          mode_ = INPUT_REPLAY_NONE;
+    FILE*                     pFile_ = nullptr;   // recording only
+    InputReplayHeader         header_;
+
+    cvector<InputReplayFrame> frames_;            // (replay) all the frames
+    cvector<InputReplayMsg>   msgs_;              // (record) of the current frame; (replay) of all the frames
+    cvector<InputReplayLook>  looks_;
+
+    InputReplayFrame          currFrame_;
+    uint32                    frameIdx_     = 0;
+    uint32                    lookIdx_      = 0;  // (replay) the next mouse look of the current frame
+    uint32                    numDiverged_  = 0;
+    uint32                    firstDivergedFrame_ = 0;
+
+    ECS::WorldFileWriter      worldWriter_;
+    ECS::WorldFileReader      worldReader_;
+};
+
+} // namespace Core
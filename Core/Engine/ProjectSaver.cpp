@@ -4,15 +4,30 @@
 // 
 // Created:        10.12.24
 // =================================================================================
+#include <CoreCommon/pch.h>
 #include "ProjectSaver.h"
 #include "../Model/ModelMgr.h"
 
+#include <chrono>
+#include <filesystem>
+
+#pragma warning (disable : 4996)
+
 
 namespace Core
 {
 
+// a global instance of the project saver
+ProjectSaver g_ProjectSaver;
+
+///////////////////////////////////////////////////////////
+
 ProjectSaver::ProjectSaver() {}
-ProjectSaver::~ProjectSaver() {}
+
+ProjectSaver::~ProjectSaver()
+{
+    Wait();
+}
 
 ///////////////////////////////////////////////////////////
 
@@ -28,4 +43,112 @@ void ProjectSaver::LoadModels(ID3D11Device* pDevice)
     g_ModelMgr.Deserialize(pDevice);
 }
 
+///////////////////////////////////////////////////////////
+
+bool ProjectSaver::SaveSceneAsync(ECS::EntityMgr& enttMgr, const char* sceneDirPath)
+{
+    if (!sceneDirPath || sceneDirPath[0] == '\0')
+    {
+        LogErr("input path to the scene directory is empty");
+        return false;
+    }
+
+    if (strlen(sceneDirPath) >= sizeof(snapshotDirPath_))
+    {
+        sprintf(g_String, "path to the scene directory is too long: %s", sceneDirPath);
+        LogErr(g_String);
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // the job of the previous save uses the snapshot
+    Wait();
+
+    std::unique_ptr<ECS::WorldFileWriter> pSnapshot = std::make_unique<ECS::WorldFileWriter>();
+
+    if (!enttMgr.Serialize(*pSnapshot))
+    {
+        sprintf(g_String, "can't take a snapshot of the scene: %s", sceneDirPath);
+        LogErr(g_String);
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(sceneDirPath, error);
+
+    if (error)
+    {
+        sprintf(g_String, "can't create the scene directory: %s", sceneDirPath);
+        LogErr(g_String);
+        return false;
+    }
+
+    pSnapshot_ = std::move(pSnapshot);
+    strcpy(snapshotDirPath_, sceneDirPath);
+
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = end - start;
+
+    LogMsgf("scene snapshot is taken (%.2f MB, duration: %.2f ms); saving: %s",
+            (double)pSnapshot_->GetDataSize() / (1024.0 * 1024.0),
+            elapsed.count(),
+            sceneDirPath);
+
+    g_JobSystem.Run([this]() { SaveSnapshot(); }, &counter_);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ProjectSaver::Wait()
+{
+    if (!counter_.IsDone())
+        g_JobSystem.Wait(counter_);
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+void ProjectSaver::SaveSnapshot()
+{
+    // write changed chunks of the snapshot;
+    // NOTE: is executed by a job so g_String isn't used here
+
+    char msg[160]{ '\0' };
+    auto start = std::chrono::steady_clock::now();
+
+    // chunks of another directory (or of the previous run) are known only from its manifest
+    if (strcmp(dirPath_, snapshotDirPath_) != 0)
+    {
+        ECS::WorldFileReader::ReadManifest(snapshotDirPath_, savedManifest_);
+        strcpy(dirPath_, snapshotDirPath_);
+    }
+
+    cvector<ECS::WorldChunkFileDesc> manifest;
+    const int numWritten = pSnapshot_->SaveToDir(snapshotDirPath_, savedManifest_, manifest);
+
+    if (numWritten < 0)
+    {
+        snprintf(msg, sizeof(msg), "can't save the scene into the directory: %s", snapshotDirPath_);
+        LogErr(msg);
+
+        // the state of the directory is unknown so it will be read again by the next save
+        dirPath_[0] = '\0';
+    }
+    else
+    {
+        auto end = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::milli> elapsed = end - start;
+
+        LogMsgf("scene is saved: %d of %d chunks are written (duration: %.2f ms)",
+                numWritten, (int)manifest.size(), elapsed.count());
+
+        savedManifest_ = std::move(manifest);
+    }
+
+    pSnapshot_.reset();
+}
+
 } // namespace Core
@@ -1,12 +1,23 @@
 // =================================================================================
 // Filename:       ProjectSaver.h
-// Description:    functional for storing the current project state into a file
+// Description:    functional for storing the current project state into a file:
+//
+//                 - the scene is saved differentially as a world directory: the main
+//                   thread only copies data of components into a snapshot (memcpy of
+//                   arrays) and a job hashes the chunks of this snapshot and writes
+//                   only the chunks which are changed since the last save;
+//                 - models are exported only if they are changed since the last save
+//                   (see ModelMgr::Serialize())
 // 
 // Created:        10.12.24
 // =================================================================================
 #pragma once
 
 #include <d3d11.h>
+#include <JobSystem.h>
+#include "Entity/EntityMgr.h"            // from the ECS module
+
+#include <memory>
 
 namespace Core
 {
@@ -19,6 +30,32 @@ public:
 
 	void StoreModels(ID3D11Device* pDevice);
 	void LoadModels(ID3D11Device* pDevice);
+
+    // take a snapshot of entities and start saving of its changed chunks
+    // into the directory by a job; if the previous save isn't finished yet
+    // the snapshot waits for it (so saves go in order)
+    bool SaveSceneAsync(ECS::EntityMgr& enttMgr, const char* sceneDirPath);
+
+    // wait until the scene is saved (e.g. before shutdown)
+    void Wait();
+
+    inline bool IsSaving() const { return !counter_.IsDone(); }
+
+private:
+    void SaveSnapshot();
+
+private:
+    std::unique_ptr<ECS::WorldFileWriter> pSnapshot_;
+    cvector<ECS::WorldChunkFileDesc>      savedManifest_;          // chunks of the last save (are used by the job only)
+    char                                  dirPath_[64]{ '\0' };    // where savedManifest_ is from
+    char                                  snapshotDirPath_[64]{ '\0' };
+    JobCounter                            counter_;
 };
 
-}
\ No newline at end of file
+
+// =================================================================================
+// Declare a global instance of the project saver
+// =================================================================================
+extern ProjectSaver g_ProjectSaver;
+
+}
@@ -0,0 +1,108 @@
+// =================================================================================
+// Filename:     RenderThread.cpp
+// Description:  implementation of the RenderThread's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "RenderThread.h"
+#include <Profiler.h>
+
+namespace Core
+{
+
+RenderThread::~RenderThread()
+{
+    Stop();
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderThread::Start(RenderFunc&& renderFunc)
+{
+    if (IsRunning())
+    {
+        LogErr("the render thread is already started");
+        return;
+    }
+
+    renderFunc_     = std::move(renderFunc);
+    isFramePending_ = false;
+    isExit_         = false;
+    thread_         = std::thread(&RenderThread::ThreadLoop, this);
+
+    LogMsg("the render thread is started");
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderThread::Stop()
+{
+    if (!IsRunning())
+        return;
+
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isExit_ = true;
+    }
+    cvKick_.notify_one();
+
+    thread_.join();
+    renderFunc_ = nullptr;
+
+    LogMsg("the render thread is stopped");
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderThread::Kick()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        assert(!isFramePending_ && "the previous frame isn't waited");
+        isFramePending_ = true;
+    }
+    cvKick_.notify_one();
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderThread::Wait()
+{
+    PROFILE_SCOPE("RenderThread::Wait");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cvDone_.wait(lock, [this]() { return !isFramePending_; });
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+void RenderThread::ThreadLoop()
+{
+    // zones of this thread are named as "render" in captured traces
+    g_CpuProfiler.SetThreadName("render");
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cvKick_.wait(lock, [this]() { return isFramePending_ || isExit_; });
+
+            if (isExit_)
+                return;
+        }
+
+        renderFunc_();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            isFramePending_ = false;
+        }
+        cvDone_.notify_all();
+    }
+}
+
+} // namespace Core
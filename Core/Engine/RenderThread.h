@@ -0,0 +1,67 @@
+// =================================================================================
+// Filename:     RenderThread.h
+// Description:  a dedicated thread which executes the rendering of a frame
+//               (submission of D3D11 work) while the main thread simulates
+//               the next one:
+//
+//               - the main thread calls Kick() when a frame packet is ready
+//                 and Wait() before it touches the renderer/immediate context
+//                 again (so only one frame is in flight at a time);
+//               - Kick()/Wait() go through a mutex so the packet which was
+//                 filled before Kick() is visible to the render thread and
+//                 the results of the frame are visible after Wait()
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+namespace Core
+{
+
+class RenderThread
+{
+public:
+    using RenderFunc = std::function<void()>;
+
+    RenderThread() {}
+    ~RenderThread();
+
+    // restrict a copying of this class instance
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // create the thread which executes renderFunc once per each Kick()
+    void Start(RenderFunc&& renderFunc);
+
+    // finish the current frame (if any) and join the thread
+    void Stop();
+
+    // start rendering of a frame (the previous one must be already waited)
+    void Kick();
+
+    // wait until the current frame is rendered (returns at once if there is no frame)
+    void Wait();
+
+    inline bool IsRunning() const { return thread_.joinable(); }
+
+private:
+    void ThreadLoop();
+
+private:
+    std::thread             thread_;
+    std::mutex              mutex_;
+    std::condition_variable cvKick_;             // a frame is kicked / the thread must exit
+    std::condition_variable cvDone_;             // the frame is rendered
+    RenderFunc              renderFunc_;
+
+    bool                    isFramePending_ = false;
+    bool                    isExit_         = false;
+};
+
+} // namespace Core
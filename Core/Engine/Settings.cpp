@@ -5,6 +5,8 @@
 // Revising:    27.11.22
 ////////////////////////////////////////////////////////////////////
 #include "Settings.h"
+#include <FileSystem.h>
+#include <MemHelpers.h>
 
 
 namespace Core
@@ -30,12 +32,14 @@ Settings::~Settings()
 bool Settings::LoadSettingsFromFile()
 {
     // load engine settings from the "settings.txt" file
+    // (from mounted asset packs or from disk)
 
     const char* pathSettingsFile = "data/settings.txt";
 
-    // open file
-    FILE* pFile = nullptr;
-    if ((pFile = fopen(pathSettingsFile, "r")) == nullptr)
+    uint8* fileData = nullptr;
+    size_t fileSize = 0;
+
+    if (!FileSys::ReadFile(pathSettingsFile, fileData, fileSize))
     {
         sprintf(g_String, "can't open the settings file: %s", pathSettingsFile);
         LogErr(g_String);
@@ -48,25 +52,38 @@ bool Settings::LoadSettingsFromFile()
     char key[bufsize]{ '\0' };
     char val[bufsize]{ '\0' };
 
-    // read in all the pairs [setting_key => setting_value]
-    while (fgets(buf, bufsize, pFile))
+    const char* line = (const char*)fileData;
+    const char* end  = line + fileSize;
+
+    // read in all the pairs [setting_key => setting_value] line by line
+    while (line < end)
     {
-        if (buf[0] == '\n')
-            continue;
+        const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+        const size_t len    = (lineEnd ? lineEnd : end) - line;
+        const size_t bufLen = (len < bufsize - 1) ? len : bufsize - 1;
 
-        sscanf(buf, "%s %s", key, val);
+        memcpy(buf, line, bufLen);
+        buf[bufLen] = '\0';
+        line += len + 1;
+
+        key[0] = '\0';
+        val[0] = '\0';
+
+        // skip empty and comment (#) lines
+        if ((sscanf(buf, "%s %s", key, val) < 1) || (key[0] == '#'))
+            continue;
 
         // try to insert a pair [key => value]; if we didn't manage to do it we throw an exception
         if (!settingsList_.insert({ key, val }).second) 
         {
-            fclose(pFile);
+            SafeDeleteArr(fileData);
             sprintf(g_String, "can't insert a pair [key=>value] into the settings list: [key: %s => value: %s]", key, val);
             LogErr(g_String);
             return false;
         }
     }
 
-    fclose(pFile);
+    SafeDeleteArr(fileData);
     return true;
 }
 
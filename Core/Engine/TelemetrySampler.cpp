@@ -0,0 +1,203 @@
+// =================================================================================
+// Filename:     TelemetrySampler.cpp
+// Description:  implementation of the TelemetrySampler's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "TelemetrySampler.h"
+
+#include <JobSystem.h>
+#include <d3d11.h>
+#include <dxgi1_4.h>
+#include <psapi.h>
+
+#pragma comment(lib, "psapi.lib")
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// Desc:   convert a FILETIME into a number of 100ns units
+//---------------------------------------------------------
+static inline uint64_t ToUInt64(const FILETIME& time)
+{
+    return ((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime;
+}
+
+///////////////////////////////////////////////////////////
+
+TelemetrySampler::~TelemetrySampler()
+{
+    Stop();
+}
+
+///////////////////////////////////////////////////////////
+
+void TelemetrySampler::Start(ID3D11Device* pDevice, const int intervalMs)
+{
+    if (IsRunning())
+    {
+        LogErr("the telemetry sampler is already started");
+        return;
+    }
+
+    // video memory info is available only since DXGI 1.4
+    if (pDevice)
+    {
+        IDXGIDevice*  pDxgiDevice = nullptr;
+        IDXGIAdapter* pAdapter    = nullptr;
+
+        if (SUCCEEDED(pDevice->QueryInterface(__uuidof(IDXGIDevice), (void**)&pDxgiDevice)) &&
+            SUCCEEDED(pDxgiDevice->GetAdapter(&pAdapter)))
+        {
+            if (FAILED(pAdapter->QueryInterface(__uuidof(IDXGIAdapter3), (void**)&pAdapter_)))
+                LogMsg("DXGI 1.4 isn't supported: video memory usage isn't sampled");
+        }
+
+        SafeRelease(&pAdapter);
+        SafeRelease(&pDxgiDevice);
+    }
+
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+
+    numCores_   = (sysInfo.dwNumberOfProcessors > 0) ? (int)sysInfo.dwNumberOfProcessors : 1;
+    intervalMs_ = (intervalMs > 0) ? intervalMs : 1000;
+    isExit_     = false;
+
+    // the first sample only sets the starting times
+    TelemetryData data;
+    Sample(data);
+
+    thread_ = std::thread(&TelemetrySampler::ThreadLoop, this);
+}
+
+///////////////////////////////////////////////////////////
+
+void TelemetrySampler::Stop()
+{
+    if (IsRunning())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            isExit_ = true;
+        }
+        cvExit_.notify_one();
+        thread_.join();
+    }
+
+    SafeRelease(&pAdapter_);
+}
+
+///////////////////////////////////////////////////////////
+
+TelemetryData TelemetrySampler::GetLast()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_;
+}
+
+
+// =================================================================================
+// PRIVATE HELPERS
+// =================================================================================
+void TelemetrySampler::ThreadLoop()
+{
+    TelemetryData data;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+
+            if (cvExit_.wait_for(lock, std::chrono::milliseconds(intervalMs_), [this]() { return isExit_; }))
+                return;
+        }
+
+        // sample without the lock so the main thread is never blocked by the system calls
+        Sample(data);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        last_ = data;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   sample times and memory of the process
+//         (CPU usage is computed for the time since the prev sample)
+//---------------------------------------------------------
+void TelemetrySampler::Sample(TelemetryData& outData)
+{
+    FILETIME now, creation, exit, kernel, user;
+
+    GetSystemTimeAsFileTime(&now);
+    const uint64_t wallTime  = ToUInt64(now);
+    const uint64_t wallDelta = wallTime - prevWallTime_;
+    const bool     isValid   = (prevWallTime_ != 0) && (wallDelta > 0);
+
+    // CPU: the whole process
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+    {
+        const uint64_t processTime = ToUInt64(kernel) + ToUInt64(user);
+
+        if (isValid)
+            outData.processCpu = 100.0f * (float)(processTime - prevProcessTime_) / (float)(wallDelta * numCores_);
+
+        prevProcessTime_ = processTime;
+    }
+
+    // CPU: workers of the job system (each one has a single core at most)
+    int numWorkers = g_JobSystem.GetNumWorkers();
+
+    if (numWorkers > TelemetryData::MAX_NUM_WORKERS)
+        numWorkers = TelemetryData::MAX_NUM_WORKERS;
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        HANDLE hThread = (HANDLE)g_JobSystem.GetWorkerHandle(i);
+
+        if (!GetThreadTimes(hThread, &creation, &exit, &kernel, &user))
+            continue;
+
+        const uint64_t threadTime = ToUInt64(kernel) + ToUInt64(user);
+
+        if (isValid)
+            outData.workerCpu[i] = 100.0f * (float)(threadTime - prevWorkerTimes_[i]) / (float)wallDelta;
+
+        prevWorkerTimes_[i] = threadTime;
+    }
+
+    outData.numWorkers = numWorkers;
+    prevWallTime_      = wallTime;
+
+    // RAM: a pseudo handle of the process is enough (there is nothing to open/close)
+    PROCESS_MEMORY_COUNTERS_EX pmc;
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc)))
+    {
+        outData.workingSetBytes = pmc.WorkingSetSize;
+        outData.committedBytes  = pmc.PrivateUsage;
+    }
+
+    // VRAM: usage and budget which the OS gives to the process
+    if (pAdapter_)
+    {
+        DXGI_QUERY_VIDEO_MEMORY_INFO info;
+
+        if (SUCCEEDED(pAdapter_->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info)))
+        {
+            outData.videoMemUsage  = info.CurrentUsage;
+            outData.videoMemBudget = info.Budget;
+        }
+
+        if (SUCCEEDED(pAdapter_->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &info)))
+        {
+            outData.sharedVideoMemUsage  = info.CurrentUsage;
+            outData.sharedVideoMemBudget = info.Budget;
+        }
+    }
+}
+
+} // namespace Core
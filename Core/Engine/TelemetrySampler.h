@@ -0,0 +1,89 @@
+// =================================================================================
+// Filename:     TelemetrySampler.h
+// Description:  a background thread which samples process telemetry once per
+//               the interval: CPU usage of the process and of each job system
+//               worker, working set and committed memory, and the video memory
+//               usage/budget of the adapter (IDXGIAdapter3::QueryVideoMemoryInfo);
+//
+//               the main thread never waits for a sample: it just copies the
+//               last one (see GetLast) under a short lock
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <CoreCommon/SystemState.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+struct ID3D11Device;
+struct IDXGIAdapter3;
+
+
+namespace Core
+{
+
+struct TelemetryData
+{
+    static constexpr int MAX_NUM_WORKERS = SystemState::MAX_NUM_WORKERS;
+
+    float    processCpu = 0.0f;                   // % of all the cores
+    float    workerCpu[MAX_NUM_WORKERS]{ 0.0f };  // % of a single core by each worker
+    int      numWorkers = 0;
+
+    uint64_t workingSetBytes = 0;                 // physical memory of the process
+    uint64_t committedBytes  = 0;                 // private (committed) memory of the process
+
+    uint64_t videoMemUsage        = 0;            // local (dedicated) video memory
+    uint64_t videoMemBudget       = 0;
+    uint64_t sharedVideoMemUsage  = 0;            // non-local (shared system) memory
+    uint64_t sharedVideoMemBudget = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+class TelemetrySampler
+{
+public:
+    TelemetrySampler() {}
+    ~TelemetrySampler();
+
+    // restrict a copying of this class instance
+    TelemetrySampler(const TelemetrySampler&) = delete;
+    TelemetrySampler& operator=(const TelemetrySampler&) = delete;
+
+    // pDevice is used only to get the adapter (video memory isn't sampled if
+    // the adapter doesn't support DXGI 1.4); workers of the job system must
+    // be already started and must be alive until Stop()
+    void Start(ID3D11Device* pDevice, const int intervalMs = 1000);
+    void Stop();
+
+    // a copy of the last sample
+    TelemetryData GetLast();
+
+    inline bool IsRunning() const { return thread_.joinable(); }
+
+private:
+    void ThreadLoop();
+    void Sample(TelemetryData& outData);
+
+private:
+    std::thread             thread_;
+    std::mutex              mutex_;
+    std::condition_variable cvExit_;
+    bool                    isExit_     = false;
+    int                     intervalMs_ = 1000;
+
+    TelemetryData           last_;                // is guarded by the mutex
+    IDXGIAdapter3*          pAdapter_   = nullptr;
+
+    // times of the prev sample (100ns units of FILETIME) to compute usage of the interval
+    uint64_t                prevWallTime_    = 0;
+    uint64_t                prevProcessTime_ = 0;
+    uint64_t                prevWorkerTimes_[TelemetryData::MAX_NUM_WORKERS]{ 0 };
+    int                     numCores_        = 1;
+};
+
+} // namespace Core
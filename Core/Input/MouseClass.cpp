@@ -53,12 +53,6 @@ void MouseClass::OnMouseMove(int x, int y)
 	eventBuffer_.push(MouseEvent(MouseEvent::EventType::Move, x, y));
 }
 
-// handles the relative changes of the mouse position
-void MouseClass::OnMouseMoveRaw(int x, int y)
-{
-	eventBuffer_.push(MouseEvent(MouseEvent::EventType::RAW_MOVE, x, y));
-}
-
 void MouseClass::OnLeftDoubleClick()
 {
 	// handle left button double clicking
@@ -15,7 +15,6 @@ public:
 	void OnWheelUp(int x, int y);
 	void OnWheelDown(int x, int y);
 	void OnMouseMove(int x, int y);
-	void OnMouseMoveRaw(int x, int y); // handles the relative changes of the mouse position
 	void OnLeftDoubleClick();
 
 	inline bool IsLeftDown()         const { return leftIsDown_; };
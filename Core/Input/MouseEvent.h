@@ -21,7 +21,6 @@ public:
 		WheelUp,
 		WheelDown,
 		Move,
-		RAW_MOVE,
 		LeftDoubleClick,
 		Invalid
 	};
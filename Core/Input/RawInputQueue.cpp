@@ -0,0 +1,122 @@
+// =================================================================================
+// Filename:     RawInputQueue.cpp
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "RawInputQueue.h"
+
+
+void RawInputQueue::ReadRawInput(const HRAWINPUT hInput)
+{
+    // all the input which is read here gets the same timestamp (the time of reading)
+
+    const int64_t ticks = GetTicks();
+
+    // the input of the current message isn't in the buffer anymore so read it separately
+    RAWINPUT raw;
+    UINT     size = sizeof(raw);
+
+    if (GetRawInputData(hInput, RID_INPUT, &raw, &size, sizeof(RAWINPUTHEADER)) != (UINT)-1)
+        PushMouse(raw, ticks);
+
+    // read the rest pending input by batches
+    while (true)
+    {
+        UINT batchSize = BATCH_SIZE;
+        const UINT num = GetRawInputBuffer((RAWINPUT*)batch_, &batchSize, sizeof(RAWINPUTHEADER));
+
+        if ((num == 0) || (num == (UINT)-1))
+            break;
+
+        const RAWINPUT* pBlock = (const RAWINPUT*)batch_;
+
+        for (UINT i = 0; i < num; ++i)
+        {
+            PushMouse(*pBlock, ticks);
+            pBlock = NEXTRAWINPUTBLOCK(pBlock);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool RawInputQueue::Consume(const int64_t untilTicks, int& outDx, int& outDy)
+{
+    outDx = 0;
+    outDy = 0;
+
+    const uint32 writePos = writePos_.load(std::memory_order_acquire);
+    uint32       readPos  = readPos_.load(std::memory_order_relaxed);
+    bool         isAny    = false;
+
+    // deltas are ordered by their timestamps
+    while ((readPos != writePos) && (ring_[readPos & MASK].ticks <= untilTicks))
+    {
+        const RawMouseDelta& delta = ring_[readPos & MASK];
+        outDx += delta.dx;
+        outDy += delta.dy;
+
+        ++readPos;
+        isAny = true;
+    }
+
+    readPos_.store(readPos, std::memory_order_release);
+    return isAny;
+}
+
+///////////////////////////////////////////////////////////
+
+int64_t RawInputQueue::GetTicks()
+{
+    LARGE_INTEGER ticks;
+    QueryPerformanceCounter(&ticks);
+    return (int64_t)ticks.QuadPart;
+}
+
+///////////////////////////////////////////////////////////
+
+int64_t RawInputQueue::GetTicksPerSecond()
+{
+    static const int64_t s_Freq = []()
+    {
+        LARGE_INTEGER freq;
+        QueryPerformanceFrequency(&freq);
+        return (int64_t)freq.QuadPart;
+    }();
+
+    return s_Freq;
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+void RawInputQueue::PushMouse(const RAWINPUT& raw, const int64_t ticks)
+{
+    // only relative moves of the mouse are queued (buttons and the wheel come
+    // by window messages; absolute coords are sent e.g. by remote desktops)
+
+    if (raw.header.dwType != RIM_TYPEMOUSE)
+        return;
+
+    const RAWMOUSE& mouse = raw.data.mouse;
+
+    if ((mouse.usFlags & MOUSE_MOVE_ABSOLUTE) || ((mouse.lLastX == 0) && (mouse.lLastY == 0)))
+        return;
+
+    const uint32 writePos = writePos_.load(std::memory_order_relaxed);
+    const uint32 readPos  = readPos_.load(std::memory_order_acquire);
+
+    if (writePos - readPos >= CAPACITY)
+    {
+        numDropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    RawMouseDelta& delta = ring_[writePos & MASK];
+    delta.ticks = ticks;
+    delta.dx    = (int32_t)mouse.lLastX;
+    delta.dy    = (int32_t)mouse.lLastY;
+
+    writePos_.store(writePos + 1, std::memory_order_release);
+}
@@ -0,0 +1,80 @@
+// =================================================================================
+// Filename:     RawInputQueue.h
+// Description:  a bounded lock-free queue of timestamped raw mouse deltas:
+//               a single producer (the thread which pumps window messages) /
+//               a single consumer (the simulation);
+//
+//               - on WM_INPUT all the pending raw input of the thread is read
+//                 at once by GetRawInputBuffer (instead of a call per message);
+//               - deltas aren't coalesced by the OS (as WM_MOUSEMOVE ones are) so
+//                 high-DPI mice give all their counts;
+//               - each simulation step consumes only deltas which came before
+//                 the end time of the step (the rest ones wait for the next step)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <atomic>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+
+struct RawMouseDelta
+{
+    int64_t ticks = 0;                                   // QPC time of reading
+    int32_t dx    = 0;
+    int32_t dy    = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+class RawInputQueue
+{
+public:
+    // max number of deltas which aren't consumed yet (must be a power of 2)
+    static constexpr uint32 CAPACITY = 1024;
+
+    RawInputQueue() {}
+
+    // restrict copying
+    RawInputQueue(const RawInputQueue&) = delete;
+    RawInputQueue& operator=(const RawInputQueue&) = delete;
+
+    // PRODUCER: read the input of the WM_INPUT message and all the raw input
+    // which is still pending for the thread (by batches)
+    void ReadRawInput(const HRAWINPUT hInput);
+
+    // CONSUMER: sum deltas which came before (or at) the time and remove them;
+    // return false if there are no such deltas
+    bool Consume(const int64_t untilTicks, int& outDx, int& outDy);
+
+    // get the number of dropped deltas since the prev call and reset it
+    inline uint32 ResetNumDropped() { return numDropped_.exchange(0, std::memory_order_relaxed); }
+
+    // QPC time (the same clock as timestamps of deltas)
+    static int64_t GetTicks();
+    static int64_t GetTicksPerSecond();
+
+private:
+    void PushMouse(const RAWINPUT& raw, const int64_t ticks);
+
+private:
+    static constexpr uint32 MASK         = CAPACITY - 1;
+    static constexpr uint32 BATCH_SIZE   = 16 * 1024;    // bytes of raw input which are read by a single GetRawInputBuffer()
+    static_assert((CAPACITY & MASK) == 0, "capacity of the raw input queue must be a power of 2");
+
+    RawMouseDelta ring_[CAPACITY];
+
+    // positions are placed on separate cache lines so producer and consumer don't share them
+    alignas(64) std::atomic<uint32> writePos_   = 0;
+    alignas(64) std::atomic<uint32> readPos_    = 0;
+    alignas(64) std::atomic<uint32> numDropped_ = 0;
+
+    // is used only by the producer
+    alignas(8) BYTE batch_[BATCH_SIZE];
+};
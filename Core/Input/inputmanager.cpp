@@ -69,8 +69,6 @@ LRESULT InputManager::HandleMouseMessage(
 	WPARAM wParam,
 	LPARAM lParam)
 {
-	static bool isMouseMoving = false;
-
 	int x = LOWORD(lParam);
 	int y = HIWORD(lParam);
 
@@ -79,7 +77,6 @@ LRESULT InputManager::HandleMouseMessage(
 		case WM_MOUSEMOVE:
 		{
 			mouse.OnMouseMove(x, y);
-			isMouseMoving = true;
 			return 0;
 		}
 		case WM_LBUTTONDOWN: 
@@ -129,45 +126,20 @@ LRESULT InputManager::HandleMouseMessage(
 			mouse.OnLeftDoubleClick();
 			return 0;
 		}
-		// --- raw input --- //
-		case WM_INPUT:
-		{
-			if (isMouseMoving == true)
-			{
-				UINT dataSize = 0;
-				void* ptrToLParam = &lParam;
-				HRAWINPUT* ptrHRawInput = static_cast<HRAWINPUT*>(ptrToLParam); // convert the lParam structure to HRAWINPUT
-
-				GetRawInputData(*ptrHRawInput, RID_INPUT, NULL, &dataSize, sizeof(RAWINPUTHEADER));
-
-				// if we got some data about a raw input
-				// NOTE: it is supposed that dataSize <= 48
-				if (dataSize > 0 && dataSize < 49) 
-				{
-					BYTE rawData[48];
-					
-					if (GetRawInputData(*ptrHRawInput, RID_INPUT, rawData, &dataSize, sizeof(RAWINPUTHEADER)) == dataSize)
-					{
-						//void* ptrRawDataGetToVoid = rawData;
-						RAWINPUT* raw = static_cast<RAWINPUT*>((void*)rawData);
-						if (raw->header.dwType == RIM_TYPEMOUSE)
-						{
-							// set how much the mouse position changed from the previous one
-							mouse.OnMouseMoveRaw(raw->data.mouse.lLastX, raw->data.mouse.lLastY);
-							isMouseMoving = false;
-						}
-					}
-				}
-			}
-			else
-			{
-				mouse.OnMouseMoveRaw(0, 0);
-			}
+	} // switch
 
-			return 0;
+	return 0;
+}
 
-		} // case WM_INPUT
-	} // switch
+///////////////////////////////////////////////////////////
 
+LRESULT InputManager::HandleRawInputMessage(
+	RawInputQueue& queue,
+	WPARAM wParam,
+	LPARAM lParam)
+{
+	// read the input of this message and all the raw input which is pending
+	// by now (so the rest WM_INPUT messages of this frame are almost empty)
+	queue.ReadRawInput(reinterpret_cast<HRAWINPUT>(lParam));
 	return 0;
 }
@@ -8,6 +8,7 @@
 
 #include "MouseClass.h"
 #include "KeyboardClass.h"
+#include "RawInputQueue.h"
 
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
@@ -20,6 +21,9 @@ class InputManager
 public:
 	LRESULT HandleKeyboardMessage(KeyboardClass & keyboard, const UINT &message, WPARAM wParam, LPARAM lParam);
 	LRESULT HandleMouseMessage(MouseClass & mouse, const UINT &message, WPARAM wParam, LPARAM lParam);
+
+	// WM_INPUT: relative moves of the mouse are pushed into the queue
+	LRESULT HandleRawInputMessage(RawInputQueue& queue, WPARAM wParam, LPARAM lParam);
 };
 
 
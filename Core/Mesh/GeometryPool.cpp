@@ -0,0 +1,390 @@
+// =================================================================================
+// Filename:     GeometryPool.cpp
+// Description:  implementation of the GeometryPool's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "GeometryPool.h"
+
+
+namespace Core
+{
+
+// init a global instance of the geometry pool
+GeometryPool g_GeometryPool;
+
+//---------------------------------------------------------
+// Desc:   upload elements into the range of DEFAULT buffer
+//---------------------------------------------------------
+static void UploadRange(
+    ID3D11DeviceContext* pContext,
+    ID3D11Buffer* pBuffer,
+    const void* data,
+    const UINT elemSize,
+    const uint32 start,
+    const uint32 count)
+{
+    D3D11_BOX box;
+    box.left   = start * elemSize;
+    box.right  = (start + count) * elemSize;
+    box.top    = 0;
+    box.bottom = 1;
+    box.front  = 0;
+    box.back   = 1;
+
+    pContext->UpdateSubresource(pBuffer, 0, &box, data, 0, 0);
+}
+
+///////////////////////////////////////////////////////////
+
+GeometryPool::GeometryPool()
+{
+}
+
+GeometryPool::~GeometryPool()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+void GeometryPool::Initialize(ID3D11Device* pDevice)
+{
+    CAssert::True(pDevice != nullptr, "input ptr to the device == nullptr");
+
+    Shutdown();
+
+    pDevice_ = pDevice;
+    pDevice_->GetImmediateContext(&pContext_);
+
+    if (!AddBlock(BLOCK_NUM_VERTICES, BLOCK_NUM_INDICES, BLOCK_NUM_INDICES))
+        LogErr("can't create the first block of the geometry pool");
+}
+
+///////////////////////////////////////////////////////////
+
+void GeometryPool::Shutdown()
+{
+    for (Block& block : blocks_)
+    {
+        SafeRelease(&block.pVB);
+        SafeRelease(&block.pIB);
+        SafeRelease(&block.pIB16);
+    }
+
+    blocks_.clear();
+    SafeRelease(&pContext_);
+    pDevice_ = nullptr;
+}
+
+///////////////////////////////////////////////////////////
+
+bool GeometryPool::Allocate(
+    const Vertex3D* vertices,
+    const int numVertices,
+    const UINT* indices,
+    const int numIndices,
+    GeometryAlloc& outAlloc)
+{
+    // allocate ranges for vertices and indices in the same block (so a single
+    // pair of buffers is bound for the geometry) and upload the data there
+
+    if (!IsInit())
+    {
+        LogErr("the geometry pool isn't initialized");
+        return false;
+    }
+
+    if (!vertices || !indices || (numVertices <= 0) || (numIndices <= 0))
+    {
+        LogErr("wrong input geometry data");
+        return false;
+    }
+
+    const uint32 numV = (uint32)numVertices;
+    const uint32 numI = (uint32)numIndices;
+
+    // indices are local for the geometry (the base vertex is added by draws)
+    const bool is16Bit = (numV <= UINT16_MAX + 1);
+
+    if (!AllocRanges(numV, numI, is16Bit, outAlloc))
+        return false;
+
+    const Block& block = blocks_[outAlloc.blockIdx];
+
+    packedVertices_.resize_uninitialized(numV);
+    PackVertices(vertices, packedVertices_.data(), numVertices);
+
+    UploadRange(pContext_, block.pVB, packedVertices_.data(), sizeof(Vertex3DPacked), outAlloc.baseVertex, numV);
+
+    if (is16Bit)
+    {
+        indices16_.resize_uninitialized(numI);
+
+        for (uint32 i = 0; i < numI; ++i)
+            indices16_[i] = (uint16)indices[i];
+
+        UploadRange(pContext_, block.pIB16, indices16_.data(), sizeof(uint16), outAlloc.baseIndex, numI);
+    }
+    else
+    {
+        UploadRange(pContext_, block.pIB, indices, sizeof(UINT), outAlloc.baseIndex, numI);
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool GeometryPool::AllocatePacked(
+    const Vertex3DPacked* vertices,
+    const int numVertices,
+    const void* indices,
+    const int numIndices,
+    const DXGI_FORMAT indexFormat,
+    GeometryAlloc& outAlloc)
+{
+    // allocate ranges for the geometry which is already packed and upload it
+    // directly from the input memory (there are no intermediate copies)
+
+    if (!IsInit())
+    {
+        LogErr("the geometry pool isn't initialized");
+        return false;
+    }
+
+    if (!vertices || !indices || (numVertices <= 0) || (numIndices <= 0))
+    {
+        LogErr("wrong input geometry data");
+        return false;
+    }
+
+    if ((indexFormat != DXGI_FORMAT_R16_UINT) && (indexFormat != DXGI_FORMAT_R32_UINT))
+    {
+        LogErr("wrong format of input indices (expected: R16_UINT or R32_UINT)");
+        return false;
+    }
+
+    const uint32 numV    = (uint32)numVertices;
+    const uint32 numI    = (uint32)numIndices;
+    const bool   is16Bit = (indexFormat == DXGI_FORMAT_R16_UINT);
+
+    if (!AllocRanges(numV, numI, is16Bit, outAlloc))
+        return false;
+
+    const Block& block = blocks_[outAlloc.blockIdx];
+
+    UploadRange(pContext_, block.pVB, vertices, sizeof(Vertex3DPacked), outAlloc.baseVertex, numV);
+
+    if (is16Bit)
+        UploadRange(pContext_, block.pIB16, indices, sizeof(uint16), outAlloc.baseIndex, numI);
+    else
+        UploadRange(pContext_, block.pIB, indices, sizeof(UINT), outAlloc.baseIndex, numI);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool GeometryPool::AllocRanges(
+    const uint32 numV,
+    const uint32 numI,
+    const bool is16Bit,
+    GeometryAlloc& outAlloc)
+{
+    // find (or add) a block which has space for both vertices and indices
+
+    uint32 vertexStart = 0;
+    uint32 indexStart  = 0;
+    int    blockIdx    = -1;
+
+    for (int i = 0; i < (int)blocks_.size(); ++i)
+    {
+        Block&          block       = blocks_[i];
+        cvector<Range>& freeIndices = (is16Bit) ? block.freeIndices16 : block.freeIndices;
+
+        if (!AllocRange(block.freeVertices, numV, vertexStart))
+            continue;
+
+        if (!AllocRange(freeIndices, numI, indexStart))
+        {
+            FreeRange(block.freeVertices, vertexStart, numV);
+            continue;
+        }
+
+        blockIdx = i;
+        break;
+    }
+
+    // there is no space: add a new block (at least of the geometry size)
+    if (blockIdx == -1)
+    {
+        const uint32 numNeededI  = (numI > BLOCK_NUM_INDICES)  ? numI : BLOCK_NUM_INDICES;
+        const uint32 blockNumV   = (numV > BLOCK_NUM_VERTICES) ? numV : BLOCK_NUM_VERTICES;
+        const uint32 blockNumI   = (is16Bit) ? BLOCK_NUM_INDICES : numNeededI;
+        const uint32 blockNumI16 = (is16Bit) ? numNeededI : BLOCK_NUM_INDICES;
+
+        if (!AddBlock(blockNumV, blockNumI, blockNumI16))
+        {
+            LogErr("can't add a new block into the geometry pool");
+            return false;
+        }
+
+        Block& block = blocks_.back();
+        blockIdx     = (int)blocks_.size() - 1;
+
+        AllocRange(block.freeVertices, numV, vertexStart);
+        AllocRange((is16Bit) ? block.freeIndices16 : block.freeIndices, numI, indexStart);
+    }
+
+    const Block& block = blocks_[blockIdx];
+
+    outAlloc.pVB         = block.pVB;
+    outAlloc.pIB         = (is16Bit) ? block.pIB16 : block.pIB;
+    outAlloc.baseVertex  = vertexStart;
+    outAlloc.baseIndex   = indexStart;
+    outAlloc.numVertices = numV;
+    outAlloc.numIndices  = numI;
+    outAlloc.blockIdx    = blockIdx;
+    outAlloc.indexFormat = (is16Bit) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void GeometryPool::Free(GeometryAlloc& alloc)
+{
+    if (!alloc.IsValid())
+        return;
+
+    // the pool can be already shut down (the blocks are released anyway)
+    if (IsInit() && (alloc.blockIdx < (int)blocks_.size()))
+    {
+        Block& block = blocks_[alloc.blockIdx];
+        const bool is16Bit = (alloc.indexFormat == DXGI_FORMAT_R16_UINT);
+
+        FreeRange(block.freeVertices, alloc.baseVertex, alloc.numVertices);
+        FreeRange((is16Bit) ? block.freeIndices16 : block.freeIndices, alloc.baseIndex, alloc.numIndices);
+    }
+
+    alloc = GeometryAlloc();
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+bool GeometryPool::AddBlock(const uint32 numVertices, const uint32 numIndices, const uint32 numIndices16)
+{
+    Block block;
+
+    D3D11_BUFFER_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+
+    // data is written only into the allocated ranges so DEFAULT usage
+    desc.Usage     = D3D11_USAGE_DEFAULT;
+    desc.ByteWidth = sizeof(Vertex3DPacked) * numVertices;
+    desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+    HRESULT hr = pDevice_->CreateBuffer(&desc, nullptr, &block.pVB);
+    if (FAILED(hr))
+        return false;
+
+    desc.ByteWidth = sizeof(UINT) * numIndices;
+    desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+    hr = pDevice_->CreateBuffer(&desc, nullptr, &block.pIB);
+    if (FAILED(hr))
+    {
+        SafeRelease(&block.pVB);
+        return false;
+    }
+
+    desc.ByteWidth = sizeof(uint16) * numIndices16;
+
+    hr = pDevice_->CreateBuffer(&desc, nullptr, &block.pIB16);
+    if (FAILED(hr))
+    {
+        SafeRelease(&block.pVB);
+        SafeRelease(&block.pIB);
+        return false;
+    }
+
+    block.freeVertices.push_back({ 0, numVertices });
+    block.freeIndices.push_back({ 0, numIndices });
+    block.freeIndices16.push_back({ 0, numIndices16 });
+    blocks_.push_back(std::move(block));
+
+    LogMsgf("geometry pool: added a block (vertices: %u, indices: %u, 16-bit indices: %u)", numVertices, numIndices, numIndices16);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool GeometryPool::AllocRange(
+    cvector<Range>& freeRanges,
+    const uint32 count,
+    uint32& outStart)
+{
+    // first fit: cut the range from the beginning of the first large enough free range
+
+    for (index i = 0; i < freeRanges.size(); ++i)
+    {
+        Range& range = freeRanges[i];
+
+        if (range.count < count)
+            continue;
+
+        outStart     = range.start;
+        range.start += count;
+        range.count -= count;
+
+        if (range.count == 0)
+            freeRanges.erase(i);
+
+        return true;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+void GeometryPool::FreeRange(
+    cvector<Range>& freeRanges,
+    const uint32 start,
+    const uint32 count)
+{
+    // put the range back keeping the order by start and merge it with neighbours
+
+    index idx = 0;
+
+    while ((idx < freeRanges.size()) && (freeRanges[idx].start < start))
+        ++idx;
+
+    const bool mergePrev = (idx > 0)                 && (freeRanges[idx-1].start + freeRanges[idx-1].count == start);
+    const bool mergeNext = (idx < freeRanges.size()) && (start + count == freeRanges[idx].start);
+
+    if (mergePrev && mergeNext)
+    {
+        freeRanges[idx-1].count += count + freeRanges[idx].count;
+        freeRanges.erase(idx);
+    }
+    else if (mergePrev)
+    {
+        freeRanges[idx-1].count += count;
+    }
+    else if (mergeNext)
+    {
+        freeRanges[idx].start  = start;
+        freeRanges[idx].count += count;
+    }
+    else
+    {
+        freeRanges.insert_before(idx, { start, count });
+    }
+}
+
+} // namespace Core
@@ -0,0 +1,131 @@
+// =================================================================================
+// Filename:     GeometryPool.h
+// Description:  suballocation of static geometry (vertices/indices of models)
+//               from a few large shared buffers so draws of different models
+//               go with the same VB/IB and there are no rebinds between them:
+//
+//               - each block is a pair of DEFAULT vertex/index buffers, data is
+//                 written into the allocated ranges by UpdateSubresource();
+//               - ranges are allocated by the first fit and merged when freed;
+//               - geometry which is bigger than a block gets a block of its size;
+//               - vertices are stored packed (see VertexPacked.h);
+//               - each block has two index buffers: 16-bit indices for geometry
+//                 with <= 65536 vertices (most of props) and 32-bit for the rest;
+//
+//               NOTE: isn't thread-safe (uses the immediate context for uploading)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include "VertexPacked.h"
+
+#include <d3d11.h>
+
+
+namespace Core
+{
+
+struct GeometryAlloc
+{
+    ID3D11Buffer* pVB         = nullptr;
+    ID3D11Buffer* pIB         = nullptr;
+    uint32        baseVertex  = 0;          // is added to vertex starts of subsets
+    uint32        baseIndex   = 0;          // is added to index starts of subsets
+    uint32        numVertices = 0;
+    uint32        numIndices  = 0;
+    int           blockIdx    = -1;         // -1: isn't allocated
+    DXGI_FORMAT   indexFormat = DXGI_FORMAT_R32_UINT;
+
+    inline bool IsValid() const { return (blockIdx >= 0); }
+};
+
+///////////////////////////////////////////////////////////
+
+class GeometryPool
+{
+public:
+    static constexpr uint32 BLOCK_NUM_VERTICES = 1 << 19;
+    static constexpr uint32 BLOCK_NUM_INDICES  = 1 << 21;
+
+public:
+    GeometryPool();
+    ~GeometryPool();
+
+    // restrict a copying of this class instance
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    void Initialize(ID3D11Device* pDevice);
+    void Shutdown();
+
+    // allocate ranges for the geometry in one of the blocks and upload it
+    // (vertices are packed while uploading; indices become 16-bit if the
+    // number of vertices allows it)
+    bool Allocate(
+        const Vertex3D* vertices,
+        const int numVertices,
+        const UINT* indices,
+        const int numIndices,
+        GeometryAlloc& outAlloc);
+
+    // the same but the geometry is already in the GPU format (for instance, it is
+    // a memory-mapped model file): the data is uploaded as is without copying
+    bool AllocatePacked(
+        const Vertex3DPacked* vertices,
+        const int numVertices,
+        const void* indices,
+        const int numIndices,
+        const DXGI_FORMAT indexFormat,
+        GeometryAlloc& outAlloc);
+
+    void Free(GeometryAlloc& alloc);
+
+    inline bool IsInit()       const { return (pDevice_ != nullptr); }
+    inline int  GetNumBlocks() const { return (int)blocks_.size(); }
+
+private:
+    struct Range
+    {
+        uint32 start = 0;
+        uint32 count = 0;
+    };
+
+    struct Block
+    {
+        ID3D11Buffer*  pVB   = nullptr;
+        ID3D11Buffer*  pIB   = nullptr;     // 32-bit indices
+        ID3D11Buffer*  pIB16 = nullptr;     // 16-bit indices
+        cvector<Range> freeVertices;        // SORTED by start
+        cvector<Range> freeIndices;         // SORTED by start
+        cvector<Range> freeIndices16;       // SORTED by start
+    };
+
+    bool AddBlock(const uint32 numVertices, const uint32 numIndices, const uint32 numIndices16);
+
+    bool AllocRanges(
+        const uint32 numV,
+        const uint32 numI,
+        const bool is16Bit,
+        GeometryAlloc& outAlloc);
+
+    static bool AllocRange(cvector<Range>& freeRanges, const uint32 count, uint32& outStart);
+    static void FreeRange (cvector<Range>& freeRanges, const uint32 start, const uint32 count);
+
+private:
+    ID3D11Device*           pDevice_  = nullptr;
+    ID3D11DeviceContext*    pContext_ = nullptr;
+    cvector<Block>          blocks_;
+    cvector<Vertex3DPacked> packedVertices_;       // a buffer for packing of the uploaded vertices
+    cvector<uint16>         indices16_;            // a buffer for narrowing of the uploaded indices
+};
+
+
+// =================================================================================
+// Declare a global instance of the geometry pool
+// =================================================================================
+extern GeometryPool g_GeometryPool;
+
+} // namespace Core
@@ -21,6 +21,7 @@ namespace Core
 enum eMaterialProp : uint32
 {
     ALPHA_CLIPPING,
+    LOW_RES_BLENDING,           // blended surfaces are rendered offscreen with a lower resolution (if it is on)
     NUM_PROPERTIES,
 };
 
@@ -74,7 +75,10 @@ struct Material
         properties |= ((int)(state) << prop);  // setup flag
     }
 
-    inline void SetAlphaClip(const bool state) { SetFlag(ALPHA_CLIPPING, state); }
+    inline void SetAlphaClip(const bool state)      { SetFlag(ALPHA_CLIPPING, state); }
+    inline void SetLowResBlending(const bool state) { SetFlag(LOW_RES_BLENDING, state); }
+
+    inline bool HasFlag(const eMaterialProp prop) const { return properties & (1 << prop); }
 
 };
 
@@ -50,12 +50,35 @@ MaterialID MaterialMgr::AddMaterial(Material&& material)
 
     ids_.push_back(id);
     materials_.push_back(std::move(material));
+    ++colorsVersion_;
+    ++texturesVersion_;
 
     return id;
 }
 
 ///////////////////////////////////////////////////////////
 
+bool MaterialMgr::ReplaceMaterial(const MaterialID id, Material&& material)
+{
+    const index idx = ids_.get_idx(id);
+    const bool exist = (idx < ids_.size()) && (ids_[idx] == id);
+
+    if (!exist)
+    {
+        sprintf(g_String, "can't replace: there is no material by ID: %ld", id);
+        LogErr(g_String);
+        return false;
+    }
+
+    materials_[idx] = std::move(material);
+    ++colorsVersion_;
+    ++texturesVersion_;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
 bool MaterialMgr::SetMaterialColorData(
     const MaterialID id,
     const Float4& ambient,
@@ -80,6 +103,29 @@ bool MaterialMgr::SetMaterialColorData(
     mat.diffuse   = diffuse;
     mat.specular  = specular;
     mat.reflect   = reflect;
+    ++colorsVersion_;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool MaterialMgr::SetMaterialTexture(const MaterialID id, const eTexType type, const TexID texID)
+{
+    // set a texture of the input type for the material by ID
+
+    const index idx = ids_.get_idx(id);
+    const bool exist = (idx < ids_.size()) && (ids_[idx] == id);
+
+    if (!exist)
+    {
+        sprintf(g_String, "there is no material by ID: %ld", id);
+        LogErr(g_String);
+        return false;
+    }
+
+    materials_[idx].SetTexture(type, texID);
+    ++texturesVersion_;
 
     return true;
 }
@@ -161,4 +207,15 @@ MaterialID MaterialMgr::GetMaterialIdByIdx(const index idx) const
     return ids_[idx * isValid];
 }
 
+///////////////////////////////////////////////////////////
+
+index MaterialMgr::GetMaterialIdxByID(const MaterialID id) const
+{
+    // return an idx of material by ID or idx 0 if there is no such material
+    const index idx = ids_.get_idx(id);
+    const bool exist = (ids_[idx] == id);
+
+    return idx * exist;
+}
+
 } // namespace Core
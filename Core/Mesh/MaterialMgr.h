@@ -23,6 +23,9 @@ public:
     // adders/setters
     MaterialID AddMaterial(Material&& material);
 
+    // replace data of the material by ID (e.g. when its model is hot reloaded)
+    bool       ReplaceMaterial(const MaterialID id, Material&& material);
+
     bool SetMaterialColorData(
         const MaterialID id,
         const Float4& ambient,
@@ -30,13 +33,25 @@ public:
         const Float4& specular,
         const Float4& reflect);
 
+    bool SetMaterialTexture(const MaterialID id, const eTexType type, const TexID texID);
+
     // getters
     Material&  GetMaterialByID    (const MaterialID id);
     void       GetMaterialsByIDs  (const MaterialID* ids, const size numMaterials, cvector<Material>& outMaterials);
     MaterialID GetMaterialIdByName(const char* name) const;
     MaterialID GetMaterialIdByIdx (const index idx) const;
+    index      GetMaterialIdxByID (const MaterialID id) const;
+
+    inline size           GetNumAllMaterials()        const { return materials_.size(); }
+    inline const Material& GetMaterialByIdx(const index idx) const { return materials_[idx]; }
+
+    // is incremented each time when a material is added/replaced or its colors are changed
+    // (so the renderer knows when to re-upload the table of materials into GPU)
+    inline uint32 GetColorsVersion() const { return colorsVersion_; }
 
-    inline size GetNumAllMaterials() const { return materials_.size(); }
+    // is incremented each time when a material is added/replaced or its textures are changed
+    // (so cached tables of textures of instances are resolved again)
+    inline uint32 GetTexturesVersion() const { return texturesVersion_; }
 
 
 private:
@@ -44,6 +59,8 @@ private:
     cvector<Material>   materials_;
 
     cvector<index>      idxs_;
+    uint32              colorsVersion_ = 0;
+    uint32              texturesVersion_ = 0;
 
     static MaterialMgr* pInstance_;
     static MaterialID   lastMaterialID_;
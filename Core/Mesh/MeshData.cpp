@@ -0,0 +1,31 @@
+// =================================================================================
+// Filename:    MeshData.cpp
+// 
+// Created:     14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "MeshData.h"
+
+
+namespace Core
+{
+
+MeshData::~MeshData()
+{
+    // buffers are released by their own destructor
+    SafeDeleteArr(vertices_);
+    SafeDeleteArr(indices_);
+}
+
+///////////////////////////////////////////////////////////
+
+bool MeshData::Release()
+{
+    if (refCount_.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return false;
+
+    delete this;
+    return true;
+}
+
+} // namespace Core
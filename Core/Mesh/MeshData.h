@@ -0,0 +1,47 @@
+// =================================================================================
+// Filename:      MeshData.h
+// Description:   a reference-counted immutable geometry which is shared between
+//                models (see BasicModel::Copy): CPU copies of vertices/indices and
+//                the GPU buffers; subsets (with their materials) stay per model;
+//                the data is deleted together with its last owner
+// 
+// Created:       14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "MeshGeometry.h"
+#include <atomic>
+
+
+namespace Core
+{
+
+class MeshData
+{
+public:
+    MeshData() {}
+    ~MeshData();
+
+    // restrict copying
+    MeshData(const MeshData&) = delete;
+    MeshData& operator=(const MeshData&) = delete;
+
+    inline void AddRef()         { refCount_.fetch_add(1, std::memory_order_relaxed); }
+    inline bool IsShared() const { return refCount_.load(std::memory_order_acquire) > 1; }
+
+    // release a reference; the data is deleted by the last one
+    // return: true if the data is deleted
+    bool Release();
+
+public:
+    MeshGeometry        buffers_;                    // only VB/IB are used (subsets are per model)
+    Vertex3D*           vertices_    = nullptr;
+    UINT*               indices_     = nullptr;
+    uint32              numVertices_ = 0;
+    uint32              numIndices_  = 0;
+
+private:
+    std::atomic<uint32> refCount_ = 1;
+};
+
+} // namespace Core
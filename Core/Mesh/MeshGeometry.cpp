@@ -26,9 +26,13 @@ MeshGeometry::~MeshGeometry()
 MeshGeometry::MeshGeometry(MeshGeometry&& rhs) noexcept :
     vb_(std::move(rhs.vb_)),
     ib_(std::move(rhs.ib_)),
+    ib16_(std::move(rhs.ib16_)),
+    poolAlloc_(std::exchange(rhs.poolAlloc_, GeometryAlloc())),
+    pSharedBuffers_(std::exchange(rhs.pSharedBuffers_, nullptr)),
     vertexStride_(std::exchange(rhs.vertexStride_, 0)),
     subsets_(std::exchange(rhs.subsets_, nullptr)),
-    numSubsets_(std::exchange(rhs.numSubsets_, 0))
+    numSubsets_(std::exchange(rhs.numSubsets_, 0)),
+    indexFormat_(std::exchange(rhs.indexFormat_, DXGI_FORMAT_R32_UINT))
 {
     // move constructor
 }
@@ -55,8 +59,50 @@ void MeshGeometry::Shutdown()
     SafeDeleteArr(subsets_);
     numSubsets_ = 0;
 
+    ReleaseBuffers();
+    indexFormat_ = DXGI_FORMAT_R32_UINT;
+}
+
+///////////////////////////////////////////////////////////
+
+void MeshGeometry::ReleaseBuffers()
+{
     vb_.Shutdown();
     ib_.Shutdown();
+    ib16_.Shutdown();
+    g_GeometryPool.Free(poolAlloc_);
+    pSharedBuffers_ = nullptr;
+}
+
+///////////////////////////////////////////////////////////
+
+void MeshGeometry::MoveBuffersTo(MeshGeometry& dst)
+{
+    CAssert::True(this != &dst,     "can't move buffers into the same mesh");
+    CAssert::True(!pSharedBuffers_, "can't move buffers which aren't owned by the mesh");
+
+    dst.ReleaseBuffers();
+
+    dst.vb_           = std::move(vb_);
+    dst.ib_           = std::move(ib_);
+    dst.ib16_         = std::move(ib16_);
+    dst.poolAlloc_    = std::exchange(poolAlloc_, GeometryAlloc());
+    dst.vertexStride_ = vertexStride_;
+    dst.indexFormat_  = indexFormat_;
+}
+
+///////////////////////////////////////////////////////////
+
+void MeshGeometry::ShareBuffers(const MeshGeometry& src)
+{
+    CAssert::True(this != &src,         "can't share buffers of the same mesh");
+    CAssert::True(!src.pSharedBuffers_, "can't share buffers which aren't owned by the input mesh");
+
+    ReleaseBuffers();
+
+    pSharedBuffers_ = &src;
+    vertexStride_   = src.vertexStride_;
+    indexFormat_    = src.indexFormat_;
 }
 
 ///////////////////////////////////////////////////////////
@@ -76,9 +122,9 @@ void MeshGeometry::Copy(
     CAssert::True(numVertices > 0,     "input number of vertices must be > 0");
     CAssert::True(numIndices > 0,      "input number of indices must be > 0");
 
-    InitVertexBuffer(pDevice, vertices, numVertices);
-    InitIndexBuffer(pDevice, indices, numIndices);
+    // NOTE: subsets go first since their reallocation resets the whole mesh
     SetSubsets(mesh.subsets_, mesh.numSubsets_);
+    InitBuffers(pDevice, vertices, indices, numVertices, numIndices);
 }
 
 ///////////////////////////////////////////////////////////
@@ -135,8 +181,12 @@ void MeshGeometry::InitVertexBuffer(
 
     constexpr bool isBufferDynamic = false;
 
-    vb_.Initialize(pDevice, vertices, numVertices, isBufferDynamic);
-    vertexStride_ = sizeof(Vertex3D);
+    cvector<Vertex3DPacked> packedVertices;
+    packedVertices.resize_uninitialized(numVertices);
+    PackVertices(vertices, packedVertices.data(), numVertices);
+
+    vb_.Initialize(pDevice, packedVertices.data(), numVertices, isBufferDynamic);
+    vertexStride_ = sizeof(Vertex3DPacked);
 }
 
 ///////////////////////////////////////////////////////////
@@ -144,12 +194,96 @@ void MeshGeometry::InitVertexBuffer(
 void MeshGeometry::InitIndexBuffer(
     ID3D11Device* pDevice,
     const UINT* indices,
-    int numIndices)
+    int numIndices,
+    const int numVertices)
+{
+    CAssert::True(indices != nullptr, "input ptr to indices arr == nullptr");
+    CAssert::True(numIndices > 0, "input number of indices must be > 0");
+
+    ib_.Shutdown();
+    ib16_.Shutdown();
+
+    // indices are local for the geometry so they fit 16 bits if vertices do
+    if (numVertices <= UINT16_MAX + 1)
+    {
+        cvector<uint16> indices16;
+        indices16.resize_uninitialized(numIndices);
+
+        for (int i = 0; i < numIndices; ++i)
+            indices16[i] = (uint16)indices[i];
+
+        ib16_.Initialize(pDevice, indices16.data(), numIndices);
+        indexFormat_ = DXGI_FORMAT_R16_UINT;
+    }
+    else
+    {
+        ib_.Initialize(pDevice, indices, numIndices);
+        indexFormat_ = DXGI_FORMAT_R32_UINT;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void MeshGeometry::InitBuffers(
+    ID3D11Device* pDevice,
+    const Vertex3D* vertices,
+    const UINT* indices,
+    const int numVertices,
+    const int numIndices)
 {
+    // static geometry goes into the shared pool so draws of different
+    // models don't need rebinding of buffers; own buffers are a fallback
+
+    ReleaseBuffers();
+
+    if (g_GeometryPool.IsInit() &&
+        g_GeometryPool.Allocate(vertices, numVertices, indices, numIndices, poolAlloc_))
+    {
+        vertexStride_ = sizeof(Vertex3DPacked);
+        indexFormat_  = poolAlloc_.indexFormat;
+        return;
+    }
+
+    InitVertexBuffer(pDevice, vertices, numVertices);
+    InitIndexBuffer(pDevice, indices, numIndices, numVertices);
+}
+
+///////////////////////////////////////////////////////////
+
+void MeshGeometry::InitBuffersPacked(
+    ID3D11Device* pDevice,
+    const Vertex3DPacked* vertices,
+    const void* indices,
+    const int numVertices,
+    const int numIndices,
+    const DXGI_FORMAT indexFormat)
+{
+    // the input data is passed directly as initial data of buffers
+    // (or of an upload into the pool) so there is no packing/narrowing
+
+    CAssert::True(vertices != nullptr, "input ptr to vertices arr == nullptr");
     CAssert::True(indices != nullptr, "input ptr to indices arr == nullptr");
+    CAssert::True(numVertices > 0, "input number of vertices must be > 0");
     CAssert::True(numIndices > 0, "input number of indices must be > 0");
 
-    ib_.Initialize(pDevice, indices, numIndices);
+    ReleaseBuffers();
+
+    vertexStride_ = sizeof(Vertex3DPacked);
+    indexFormat_  = indexFormat;
+
+    if (g_GeometryPool.IsInit() &&
+        g_GeometryPool.AllocatePacked(vertices, numVertices, indices, numIndices, indexFormat, poolAlloc_))
+    {
+        return;
+    }
+
+    constexpr bool isBufferDynamic = false;
+    vb_.Initialize(pDevice, vertices, numVertices, isBufferDynamic);
+
+    if (indexFormat == DXGI_FORMAT_R16_UINT)
+        ib16_.Initialize(pDevice, (const uint16*)indices, numIndices);
+    else
+        ib_.Initialize(pDevice, (const UINT*)indices, numIndices);
 }
 
 ///////////////////////////////////////////////////////////
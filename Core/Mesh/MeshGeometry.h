@@ -9,13 +9,36 @@
 
 #include <Types.h>
 #include "Vertex.h"
+#include "VertexPacked.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include "GeometryPool.h"
 
 
 namespace Core
 {
 
+// max number of levels of detail (LOD 0 is the origin geometry)
+constexpr int MAX_NUM_MESH_LODS = 4;
+
+// the last level of detail: the model is rendered by its impostor (see ImpostorBaker);
+// for models without an impostor it is clamped to their last mesh LOD
+constexpr uint8_t IMPOSTOR_LOD = MAX_NUM_MESH_LODS;
+
+// a cluster of LOD 0 triangles of a subset (see MeshletBuilder): a contiguous range
+// of indices with bounds in model space which is culled on GPU separately
+struct Meshlet
+{
+    DirectX::XMFLOAT3 center;                       // bounding sphere
+    float             radius     = 0;
+    DirectX::XMFLOAT3 coneAxis;                     // average normal of triangles
+    float             coneCutoff = 1;               // sin of the normal cone's half angle (1: is never backfacing)
+    uint32_t          indexStart = 0;               // in the common buffer (as of subsets)
+    uint32_t          indexCount = 0;
+    uint16_t          subsetID   = 0;
+    uint16_t          padding[3]{ 0 };
+};
+
 class MeshGeometry
 {
 public:
@@ -23,10 +46,18 @@ public:
     {
         Subset() {}
 
+        // get an index range of the level of detail (must be < BasicModel::numLods_)
+        inline uint32_t GetIndexStart(const int lod) const { return (lod == 0) ? indexStart : lodIndexStart[lod - 1]; }
+        inline uint32_t GetIndexCount(const int lod) const { return (lod == 0) ? indexCount : lodIndexCount[lod - 1]; }
+
         uint32_t   vertexStart = 0;                         // start pos of vertex in the common buffer
         uint32_t   vertexCount = 0;                         // how many vertices this subset has
         uint32_t   indexStart = 0;                          // start pos of index in the common buffer
         uint32_t   indexCount = 0;                          // how many indices this subset has
+        uint32_t   lodIndexStart[MAX_NUM_MESH_LODS - 1]{0}; // index ranges of simplified geometry (LOD 1, 2, ...);
+        uint32_t   lodIndexCount[MAX_NUM_MESH_LODS - 1]{0}; // they use the same vertices as LOD 0
+        uint32_t   meshletStart = 0;                        // range in BasicModel::meshlets_ (is empty for small subsets)
+        uint32_t   meshletCount = 0;
         char       name[SUBSET_NAME_LENGTH_LIMIT]{ '\0' };  // each subset must have its own name
         MaterialID materialID = INVALID_MATERIAL_ID;        // an ID to the related material (multiple meshes/subset of the model can have the same material so we just can use the same ID)
         uint16_t   id = -1;                                 // subset ID
@@ -59,7 +90,47 @@ public:
     void SetSubsets(const Subset* subsets, const int numSubsets);
 
     void InitVertexBuffer(ID3D11Device* pDevice, const Vertex3D* vertices, const int count);
-    void InitIndexBuffer (ID3D11Device* pDevice, const UINT* indices, const int count);
+    // indices are stored as 16-bit if the number of vertices allows it
+    void InitIndexBuffer (ID3D11Device* pDevice, const UINT* indices, const int count, const int numVertices);
+
+    // put the geometry into the shared pool (if it's initialized)
+    // or into own vertex/index buffers of this mesh
+    void InitBuffers(
+        ID3D11Device* pDevice,
+        const Vertex3D* vertices,
+        const UINT* indices,
+        const int numVertices,
+        const int numIndices);
+
+    // the same but the geometry is already in the GPU format (packed vertices and
+    // indices of indexFormat) so it is uploaded from the input memory as is
+    void InitBuffersPacked(
+        ID3D11Device* pDevice,
+        const Vertex3DPacked* vertices,
+        const void* indices,
+        const int numVertices,
+        const int numIndices,
+        const DXGI_FORMAT indexFormat);
+
+    // release own buffers (or stop using shared ones)
+    void ReleaseBuffers();
+
+    // move own buffers into dst (its buffers are released); subsets aren't moved
+    void MoveBuffersTo(MeshGeometry& dst);
+
+    // draw with buffers of src (see MeshData) instead of own ones;
+    // src must outlive the sharing (or it's stopped by ReleaseBuffers/InitBuffers)
+    void ShareBuffers(const MeshGeometry& src);
+
+    inline bool IsSharingBuffers() const { return pSharedBuffers_ != nullptr; }
+
+    // buffers to draw with: if the geometry is in the pool, vertex/index
+    // starts of subsets must be offset by the base vertex/index
+    inline ID3D11Buffer* GetVB()          const { const MeshGeometry& b = Buffers(); return (b.poolAlloc_.IsValid()) ? b.poolAlloc_.pVB : b.vb_.Get(); }
+    inline ID3D11Buffer* GetIB()          const { const MeshGeometry& b = Buffers(); return (b.poolAlloc_.IsValid()) ? b.poolAlloc_.pIB : (b.ib16_.Get()) ? b.ib16_.Get() : b.ib_.Get(); }
+    inline DXGI_FORMAT   GetIndexFormat() const { return indexFormat_; }
+    inline uint32        GetBaseVertex()  const { return Buffers().poolAlloc_.baseVertex; }
+    inline uint32        GetBaseIndex()   const { return Buffers().poolAlloc_.baseIndex; }
 
     void SetSubsetName(const SubsetID subsetID, const char* name);
 
@@ -68,17 +139,23 @@ public:
 
 
 private:
+    inline const MeshGeometry& Buffers() const { return (pSharedBuffers_) ? *pSharedBuffers_ : *this; }
+
     bool CheckInputParamsForMaterialsSetting(
         const SubsetID* subsetsIDs,
         const MaterialID* materialsIDs,
         const size count);
 
 public:
-    VertexBuffer<Vertex3D> vb_;
-    IndexBuffer<UINT>      ib_;
-    MeshGeometry::Subset*  subsets_ = nullptr;       // data about each mesh of model
-    uint16_t               vertexStride_ = 0;
-    uint16_t               numSubsets_ = 0;
+    VertexBuffer<Vertex3DPacked> vb_;                // vertices are packed at uploading
+    IndexBuffer<UINT>            ib_;
+    IndexBuffer<uint16>          ib16_;              // is used instead of ib_ for small geometry
+    GeometryAlloc                poolAlloc_;         // ranges in the geometry pool (if the geometry is there)
+    const MeshGeometry*          pSharedBuffers_ = nullptr; // buffers of shared geometry (aren't owned)
+    MeshGeometry::Subset*        subsets_ = nullptr; // data about each mesh of model
+    uint16_t                     vertexStride_ = 0;
+    uint16_t                     numSubsets_ = 0;
+    DXGI_FORMAT                  indexFormat_ = DXGI_FORMAT_R32_UINT;
 };
 
 }
@@ -86,6 +86,13 @@ public:
         ID3D11Device* pDevice,
         const int numVertices);
 
+    // init a DEFAULT usage buffer: it isn't mapped but its ranges can be
+    // rewritten by UpdateRange (e.g. partial uploads of edited vertices)
+    bool InitializeUpdatable(
+        ID3D11Device* pDevice,
+        const T* pVertices,
+        const int numVertices);
+
     // ------------------------------------------
 
     void UpdateDynamic(
@@ -93,6 +100,22 @@ public:
         T* vertices,
         const size count);
 
+    // update with vertices of another type which are converted (e.g. packed)
+    // right into the mapped memory so there is no intermediate copy
+    template <typename SrcT>
+    void UpdateDynamic(
+        ID3D11DeviceContext* pContext,
+        const SrcT* vertices,
+        const size count,
+        void (*convert)(const SrcT*, T*, const int));
+
+    // upload only vertices [start, start+count) of this DEFAULT usage buffer
+    void UpdateRange(
+        ID3D11DeviceContext* pContext,
+        const T* vertices,
+        const int start,
+        const int count);
+
     // ------------------------------------------
 
     void CopyBuffer(
@@ -245,6 +268,85 @@ bool VertexBuffer<T>::InitializeEmpty(
 
 ///////////////////////////////////////////////////////////
 
+template <typename T>
+bool VertexBuffer<T>::InitializeUpdatable(
+    ID3D11Device* pDevice,
+    const T* pVertices,
+    const int numVertices)
+{
+    // init a DEFAULT usage buffer with vertices data
+
+    if (!pVertices)
+    {
+        LogErr("input ptr to arr of vertices == nullptr");
+        return false;
+    }
+
+    if (numVertices <= 0)
+    {
+        LogErr("input number of vertices must be > 0");
+        return false;
+    }
+
+    D3D11_BUFFER_DESC desc;
+    ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
+
+    desc.Usage               = D3D11_USAGE_DEFAULT;           // the GPU reads it, the CPU updates it by UpdateSubresource
+    desc.CPUAccessFlags      = 0;
+    desc.ByteWidth           = sizeof(T) * numVertices;
+    desc.BindFlags           = D3D11_BIND_VERTEX_BUFFER;
+    desc.StructureByteStride = 0;
+    desc.MiscFlags           = 0;
+
+    HRESULT hr = InitializeHelper(pDevice, desc, pVertices);
+    if (FAILED(hr))
+    {
+        LogErr("can't create a vertex buffer");
+        return false;
+    }
+
+    stride_      = sizeof(T);
+    vertexCount_ = numVertices;
+    usageType_   = desc.Usage;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename T>
+void VertexBuffer<T>::UpdateRange(
+    ID3D11DeviceContext* pContext,
+    const T* vertices,
+    const int start,
+    const int count)
+{
+    // update a range of this DEFAULT vertex buffer (only this range is uploaded)
+    try
+    {
+        CAssert::True(usageType_ == D3D11_USAGE_DEFAULT, "not default usage of the buffer");
+        CAssert::True(vertices && (start >= 0) && (count > 0), "wrong input data");
+        CAssert::True((u32)(start + count) <= vertexCount_, "the range is out of the buffer");
+
+        D3D11_BOX box;
+        box.left   = start * stride_;
+        box.right  = (start + count) * stride_;
+        box.top    = 0;
+        box.bottom = 1;
+        box.front  = 0;
+        box.back   = 1;
+
+        pContext->UpdateSubresource(pBuffer_, 0, &box, vertices, 0, 0);
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        throw EngineException("can't update a range of the vertex buffer");
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 template <typename T>
 void VertexBuffer<T>::UpdateDynamic(
     ID3D11DeviceContext* pContext,
@@ -276,6 +378,38 @@ void VertexBuffer<T>::UpdateDynamic(
 
 ///////////////////////////////////////////////////////////
 
+template <typename T>
+template <typename SrcT>
+void VertexBuffer<T>::UpdateDynamic(
+    ID3D11DeviceContext* pContext,
+    const SrcT* vertices,
+    const size count,
+    void (*convert)(const SrcT*, T*, const int))
+{
+    // update this DYNAMIC vertex buffer with converted vertices
+    try
+    {
+        CAssert::True(usageType_ == D3D11_USAGE_DYNAMIC, "not dynamic usage of the buffer");
+        CAssert::True(vertices && convert && ((u32)count <= vertexCount_), "wrong input data");
+
+        D3D11_MAPPED_SUBRESOURCE mappedResource;
+        const HRESULT hr = pContext->Map(pBuffer_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+        CAssert::NotFailed(hr, "failed to map the vertex buffer");
+
+        // NOTE: the mapped memory is write-combined so it's only written (sequentially)
+        convert(vertices, (T*)mappedResource.pData, (int)count);
+
+        pContext->Unmap(pBuffer_, 0);
+    }
+    catch (EngineException & e)
+    {
+        LogErr(e);
+        throw EngineException("can't update the dynamic vertex buffer");
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 template <typename T>
 void VertexBuffer<T>::CopyBuffer(
     ID3D11Device* pDevice,
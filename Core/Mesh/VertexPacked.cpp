@@ -0,0 +1,99 @@
+// =================================================================================
+// Filename:     VertexPacked.cpp
+// Description:  packing/unpacking of vertices into the compressed formats
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "VertexPacked.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// Desc:  pack a unit vector from [-1, 1] into [0, 1] of 10:10:10:2 unorm
+//---------------------------------------------------------
+static inline XMUDECN4 PackUnitVector(const XMFLOAT3& v)
+{
+    const XMVECTOR half = XMVectorReplicate(0.5f);
+    XMVECTOR vec        = XMVectorMultiplyAdd(XMLoadFloat3(&v), half, half);
+
+    XMUDECN4 packed;
+    XMStoreUDecN4(&packed, XMVectorSetW(vec, 1.0f));
+    return packed;
+}
+
+//---------------------------------------------------------
+// Desc:  inverse of the PackUnitVector()
+//---------------------------------------------------------
+static inline XMFLOAT3 UnpackUnitVector(const XMUDECN4& packed)
+{
+    const XMVECTOR vec = XMLoadUDecN4(&packed);
+
+    XMFLOAT3 v;
+    XMStoreFloat3(&v, XMVectorMultiplyAdd(vec, XMVectorReplicate(2.0f), XMVectorReplicate(-1.0f)));
+    return v;
+}
+
+///////////////////////////////////////////////////////////
+
+void PackVertices(const Vertex3D* vertices, Vertex3DPacked* outVertices, const int count)
+{
+    assert(vertices && outVertices);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const Vertex3D& in  = vertices[i];
+        Vertex3DPacked& out = outVertices[i];
+
+        out.position = in.position;
+        out.texture  = XMHALF2(in.texture.x, in.texture.y);
+        out.normal   = PackUnitVector(in.normal);
+        out.tangent  = PackUnitVector(in.tangent);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void PackVertices(const Vertex3dTerrain* vertices, Vertex3dTerrainPacked* outVertices, const int count)
+{
+    assert(vertices && outVertices);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const Vertex3dTerrain& in  = vertices[i];
+        Vertex3dTerrainPacked& out = outVertices[i];
+
+        out.position = in.position;
+        out.normal   = PackUnitVector(in.normal);
+        out.tangent  = PackUnitVector(in.tangent);
+
+        XMStoreUShortN2(&out.texture, XMLoadFloat2(&in.texture));
+        XMStoreUByteN4(&out.color, XMLoadFloat4(&in.color));
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void UnpackVertices(const Vertex3DPacked* vertices, Vertex3D* outVertices, const int count)
+{
+    assert(vertices && outVertices);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const Vertex3DPacked& in  = vertices[i];
+        Vertex3D&             out = outVertices[i];
+
+        out.position = in.position;
+        out.normal   = UnpackUnitVector(in.normal);
+        out.tangent  = UnpackUnitVector(in.tangent);
+
+        XMStoreFloat2(&out.texture, XMLoadHalf2(&in.texture));
+    }
+}
+
+} // namespace Core
@@ -0,0 +1,55 @@
+// =================================================================================
+// Filename:     VertexPacked.h
+// Description:  compressed formats of vertices which are stored in GPU buffers:
+//
+//               - positions stay as full floats (the depth pre-pass must
+//                 compute the same positions as the main passes);
+//               - UVs of models are half floats, UVs of terrain are unorm16
+//                 (they are normalized over the terrain size);
+//               - normals and tangents are 10:10:10:2 unorm as (v * 0.5 + 0.5)
+//                 and are decoded in shaders (see hlsl/PackedVertex.hlsli);
+//               - colors of terrain are unorm8 RGBA
+//
+//               CPU copies of geometry are kept as Vertex3D/Vertex3dTerrain
+//               (raycasting, BVH, simplification, export), they are packed
+//               only at uploading into GPU
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Vertex.h"
+#include "Vertex3dTerrain.h"
+#include <DirectXPackedVector.h>
+
+
+namespace Core
+{
+
+struct Vertex3DPacked
+{
+    DirectX::XMFLOAT3                  position;  // DXGI_FORMAT_R32G32B32_FLOAT
+    DirectX::PackedVector::XMHALF2     texture;   // DXGI_FORMAT_R16G16_FLOAT
+    DirectX::PackedVector::XMUDECN4    normal;    // DXGI_FORMAT_R10G10B10A2_UNORM
+    DirectX::PackedVector::XMUDECN4    tangent;   // DXGI_FORMAT_R10G10B10A2_UNORM
+};
+
+struct Vertex3dTerrainPacked
+{
+    DirectX::XMFLOAT3                  position;  // DXGI_FORMAT_R32G32B32_FLOAT
+    DirectX::PackedVector::XMUSHORTN2  texture;   // DXGI_FORMAT_R16G16_UNORM
+    DirectX::PackedVector::XMUDECN4    normal;    // DXGI_FORMAT_R10G10B10A2_UNORM
+    DirectX::PackedVector::XMUDECN4    tangent;   // DXGI_FORMAT_R10G10B10A2_UNORM
+    DirectX::PackedVector::XMUBYTEN4   color;     // DXGI_FORMAT_R8G8B8A8_UNORM
+};
+
+static_assert(sizeof(Vertex3DPacked) == 24,        "the packed vertex must match the input layouts");
+static_assert(sizeof(Vertex3dTerrainPacked) == 28, "the packed terrain vertex must match the input layout");
+
+///////////////////////////////////////////////////////////
+
+void PackVertices  (const Vertex3D* vertices,        Vertex3DPacked* outVertices,        const int count);
+void PackVertices  (const Vertex3dTerrain* vertices, Vertex3dTerrainPacked* outVertices, const int count);
+void UnpackVertices(const Vertex3DPacked* vertices,  Vertex3D* outVertices,              const int count);
+
+} // namespace Core
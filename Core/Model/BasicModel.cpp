@@ -5,6 +5,7 @@
 // =================================================================================
 #include <CoreCommon/pch.h>
 #include "BasicModel.h"
+#include "MeshKernels.h"
 
 
 namespace Core
@@ -41,12 +42,17 @@ BasicModel::BasicModel(BasicModel&& rhs) noexcept :
     subsetsAABB_(std::exchange(rhs.subsetsAABB_, nullptr)),
     vertices_   (std::exchange(rhs.vertices_, nullptr)),
     indices_    (std::exchange(rhs.indices_, nullptr)),
+    pSharedMesh_(std::exchange(rhs.pSharedMesh_, nullptr)),
+    bvh_        (std::move(rhs.bvh_)),
+    meshlets_   (std::move(rhs.meshlets_)),
+    skinned_    (std::move(rhs.skinned_)),
 
     numVertices_(rhs.numVertices_),
     numIndices_ (rhs.numIndices_),
     numSubsets_ (rhs.numSubsets_),
     numBones_   (rhs.numBones_),
-    numAnimClips_(rhs.numAnimClips_)
+    numAnimClips_(rhs.numAnimClips_),
+    numLods_    (rhs.numLods_)
 {
     // move constructor
     memmove(name_, rhs.name_, strlen(rhs.name_));
@@ -68,45 +74,92 @@ BasicModel& BasicModel::operator=(BasicModel&& rhs) noexcept
 
 ///////////////////////////////////////////////////////////
 
-void BasicModel::Copy(ID3D11Device* pDevice, const BasicModel& rhs)
+void BasicModel::Copy(BasicModel& rhs)
 {
-    // deep copy of data
+    // the geometry isn't duplicated: both models refer the same MeshData,
+    // and the rest data (subsets, AABBs, etc.) is copied
 
-    assert(0 && "TODO: FIX IT");
-#if 0
-    Clear();
-    AllocateMemory(rhs.numVertices_, rhs.numIndices_, rhs.numSubsets_);
+    CAssert::True(this != &rhs,                         "can't copy a model into itself");
+    CAssert::True(rhs.vertices_ && rhs.indices_,        "the input model has no geometry");
+    CAssert::True(rhs.meshes_.GetVB() != nullptr,       "the input model has no buffers");
+    CAssert::True(rhs.numSubsets_ > 0,                  "the input model has no subsets");
 
-    type_ = rhs.type_;
-    name_ = "copy_of_" + rhs.name_;
+    Shutdown();
+    rhs.ShareGeometry();
+
+    pSharedMesh_ = rhs.pSharedMesh_;
+    pSharedMesh_->AddRef();
+
+    vertices_     = rhs.vertices_;
+    indices_      = rhs.indices_;
+    numVertices_  = rhs.numVertices_;
+    numIndices_   = rhs.numIndices_;
+    numSubsets_   = rhs.numSubsets_;
+    numBones_     = rhs.numBones_;
+    numAnimClips_ = rhs.numAnimClips_;
+    numLods_      = rhs.numLods_;
+    type_         = rhs.type_;
+    modelAABB_    = rhs.modelAABB_;
+    impostor_     = rhs.impostor_;
+
+    snprintf(name_, sizeof(name_), "copy_of_%s", rhs.name_);
+
+    // NOTE: subsets go first since their reallocation resets the whole mesh
+    meshes_.SetSubsets(rhs.meshes_.subsets_, rhs.numSubsets_);
+    meshes_.ShareBuffers(pSharedMesh_->buffers_);
+
+    subsetsAABB_ = new DirectX::BoundingBox[numSubsets_];
+    std::copy(rhs.subsetsAABB_, rhs.subsetsAABB_ + numSubsets_, subsetsAABB_);
 
-    modelAABB_ = rhs.modelAABB_;
+    meshlets_ = rhs.meshlets_;
+    skinned_  = rhs.skinned_;
 
-    // copy textures / materials / AABB of each subset
-    std::copy(rhs.texIDs_, rhs.texIDs_ + numTextures_, texIDs_);
-    std::copy(rhs.materials_, rhs.materials_ + numMats_, materials_);
-    std::copy(rhs.subsetsAABB_, rhs.subsetsAABB_ + numSubsets_, subsetsAABB_);
+    if (!rhs.bvh_.IsEmpty())
+        BuildTriangleBVH();
+}
 
-    CopyVertices(rhs.vertices_, rhs.numVertices_);
-    CopyIndices(rhs.indices_, rhs.numIndices_);
+///////////////////////////////////////////////////////////
 
-    // copy VB/IB, and subsets data
-    meshes_.Copy(pDevice, vertices_, indices_, numVertices_, numIndices_, rhs.meshes_);
+void BasicModel::MakeGeometryUnique(ID3D11Device* pDevice)
+{
+    if (!pSharedMesh_)
+        return;
 
-    numVertices_ = rhs.numVertices_;
-    numIndices_  = rhs.numIndices_;
-    numMats_     = rhs.numMats_;
-    numSubsets_  = rhs.numSubsets_;
-    numTextures_ = rhs.numTextures_;
-#endif
+    MeshData* pData = pSharedMesh_;
+    pSharedMesh_ = nullptr;
+
+    // the last owner takes the geometry back
+    if (!pData->IsShared())
+    {
+        pData->vertices_ = nullptr;
+        pData->indices_  = nullptr;
+        pData->buffers_.MoveBuffersTo(meshes_);
+        pData->Release();
+        return;
+    }
+
+    Vertex3D* vertices = new Vertex3D[numVertices_];
+    UINT*     indices  = new UINT[numIndices_];
+
+    std::copy(vertices_, vertices_ + numVertices_, vertices);
+    std::copy(indices_,  indices_  + numIndices_,  indices);
+
+    vertices_ = vertices;
+    indices_  = indices;
+
+    meshes_.ReleaseBuffers();
+    pData->Release();
+
+    // without a device the buffers must be initialized by the caller after editing
+    if (pDevice)
+        InitializeBuffers(pDevice);
 }
 
 ///////////////////////////////////////////////////////////
 
 void BasicModel::InitializeBuffers(ID3D11Device* pDevice)
 {
-    meshes_.InitVertexBuffer(pDevice, vertices_, numVertices_);
-    meshes_.InitIndexBuffer(pDevice, indices_, numIndices_);
+    meshes_.InitBuffers(pDevice, vertices_, indices_, numVertices_, numIndices_);
 }
 
 ///////////////////////////////////////////////////////////
@@ -120,14 +173,17 @@ void BasicModel::Shutdown()
     meshes_.~MeshGeometry();
 
     SafeDeleteArr(subsetsAABB_);
-    SafeDeleteArr(vertices_);
-    SafeDeleteArr(indices_);
+    ReleaseGeometry();
+    bvh_.Clear();
+    meshlets_.clear();
+    skinned_.Clear();
 
     numVertices_  = 0;
     numIndices_   = 0;
     numSubsets_   = 0;
     numBones_     = 0;
     numAnimClips_ = 0;
+    numLods_      = 1;
 }
 
 ///////////////////////////////////////////////////////////
@@ -137,8 +193,10 @@ void BasicModel::ClearMemory()
     meshes_.~MeshGeometry();
 
     SafeDeleteArr(subsetsAABB_);
-    SafeDeleteArr(vertices_);
-    SafeDeleteArr(indices_);
+    ReleaseGeometry();
+    bvh_.Clear();
+    meshlets_.clear();
+    skinned_.Clear();
 }
 
 
@@ -235,6 +293,7 @@ void BasicModel::AllocateVertices(const int numVertices)
 {
     CAssert::True(numVertices > 0, "new number of vertices must be > 0");
 
+    MakeGeometryUnique();
     SafeDeleteArr(vertices_);
     vertices_ = new Vertex3D[numVertices]{};
     numVertices_ = numVertices;
@@ -246,6 +305,7 @@ void BasicModel::AllocateIndices(const int numIndices)
 {
     CAssert::True(numIndices > 0, "new number of indices must be > 0");
 
+    MakeGeometryUnique();
     SafeDeleteArr(indices_);
     indices_ = new UINT[numIndices]{ 0 };
     numIndices_ = numIndices;
@@ -259,6 +319,7 @@ void BasicModel::CopyVertices(const Vertex3D* vertices, const int numVertices)
     CAssert::True(vertices != nullptr, "input ptr to vertices == nullptr");
     CAssert::True(numVertices > 0,     "input number of vertices must be > 0");
 
+    MakeGeometryUnique();
     std::copy(vertices, vertices + numVertices, vertices_);
 }
 
@@ -270,6 +331,7 @@ void BasicModel::CopyIndices(const UINT* indices, const int numIndices)
     CAssert::True(indices != nullptr, "input ptr to indices == nullptr");
     CAssert::True(numIndices > 0,     "input number of indices must be > 0");
 
+    MakeGeometryUnique();
     std::copy(indices, indices + numIndices, indices_);
 }
 
@@ -366,61 +428,83 @@ void BasicModel::ComputeModelAABB()
     // compute a bounding box of the whole model by AABB of each subset (mesh)
     // NOTE: subsets AABBs must be already computed before
 
-    using namespace DirectX;
+    MeshKernels::MergeAABBs(subsetsAABB_, numSubsets_, modelAABB_);
+}
+
+///////////////////////////////////////////////////////////
 
-    XMVECTOR vMin{ FLT_MAX, FLT_MAX, FLT_MAX };
-    XMVECTOR vMax{ FLT_MIN, FLT_MIN, FLT_MIN };
+void BasicModel::ComputeSubsetsAABB()
+{
+    // compute a bounding box of each subset (mesh) of the model by its vertices
+    // NOTE: there must be already data of vertices and subsets
 
-    // go through each subset (mesh)
     for (int i = 0; i < numSubsets_; ++i)
     {
-        const DirectX::BoundingBox& subsetAABB = subsetsAABB_[i];
+        const MeshGeometry::Subset& subset = meshes_.subsets_[i];
 
-        // define min/max point of this mesh
-        const XMVECTOR meshVecCenter  = XMLoadFloat3(&subsetAABB.Center);
-        const XMVECTOR meshVecExtents = XMLoadFloat3(&subsetAABB.Extents);
-        const XMVECTOR meshVecMax = meshVecCenter + meshVecExtents;
-        const XMVECTOR meshVecMin = meshVecCenter - meshVecExtents;
+        MeshKernels::ComputeAABB(
+            &vertices_[subset.vertexStart].position,
+            sizeof(Vertex3D),
+            subset.vertexCount,
+            subsetsAABB_[i]);
+    }
+}
+
+///////////////////////////////////////////////////////////
 
-        vMin = XMVectorMin(vMin, meshVecMin);
-        vMax = XMVectorMax(vMax, meshVecMax);
+void BasicModel::BuildTriangleBVH()
+{
+    if (!vertices_ || !indices_ || (numSubsets_ == 0))
+    {
+        sprintf(g_String, "can't build triangle BVH: there is no geometry (model: %s)", name_);
+        LogErr(g_String);
+        return;
     }
 
-    // compute a model's AABB
-    XMStoreFloat3(&modelAABB_.Center,  0.5f * (vMin + vMax));
-    XMStoreFloat3(&modelAABB_.Extents, 0.5f * (vMax - vMin));
+    bvh_.Build(vertices_, indices_, meshes_.subsets_, numSubsets_);
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+void BasicModel::ShareGeometry()
+{
+    // move the geometry into a shared MeshData (if it isn't shared yet)
+
+    if (pSharedMesh_)
+        return;
+
+    MeshData* pData     = new MeshData();
+    pData->vertices_    = vertices_;
+    pData->indices_     = indices_;
+    pData->numVertices_ = numVertices_;
+    pData->numIndices_  = numIndices_;
+
+    meshes_.MoveBuffersTo(pData->buffers_);
+    meshes_.ShareBuffers(pData->buffers_);
+
+    pSharedMesh_ = pData;
 }
 
 ///////////////////////////////////////////////////////////
 
-void BasicModel::ComputeSubsetsAABB()
+void BasicModel::ReleaseGeometry()
 {
-    // compute a bounding box of each subset (mesh) of the model by its vertices
-    // NOTE: there must be already data of vertices and subsets
+    // NOTE: buffers of the mesh must be released before
 
-    using namespace DirectX;
-    
-    // go through each subset (mesh)
-    for (int i = 0; i < numSubsets_; ++i)
+    if (!pSharedMesh_)
     {
-        MeshGeometry::Subset& subset = meshes_.subsets_[i];
-        Vertex3D* vertices = vertices_ + subset.vertexStart;
-
-        XMVECTOR vMin{ FLT_MAX, FLT_MAX, FLT_MAX };
-        XMVECTOR vMax{ FLT_MIN, FLT_MIN, FLT_MIN };
-        
-        // go through each vertex of this subset (mesh)
-        for (u32 vIdx = 0; vIdx < subset.vertexCount; ++vIdx)
-        {
-            XMVECTOR P = XMLoadFloat3(&vertices[vIdx].position);
-            vMin = DirectX::XMVectorMin(vMin, P);
-            vMax = DirectX::XMVectorMax(vMax, P);
-        }
-
-        // convert min/max representation to center and extents representation
-        DirectX::XMStoreFloat3(&subsetsAABB_[i].Center,  0.5f * (vMin + vMax));
-        DirectX::XMStoreFloat3(&subsetsAABB_[i].Extents, 0.5f * (vMax - vMin));
+        SafeDeleteArr(vertices_);
+        SafeDeleteArr(indices_);
+        return;
     }
+
+    vertices_ = nullptr;
+    indices_  = nullptr;
+
+    pSharedMesh_->Release();
+    pSharedMesh_ = nullptr;
 }
 
 } // namespace Core
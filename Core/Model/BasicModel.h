@@ -8,6 +8,10 @@
 //                need to read the mesh data such as for computing bounding volumes,
 //                picking, or collision detection
 // 
+//                The geometry (CPU copies and GPU buffers) can be shared between
+//                models (see Copy()): in this case it is owned by a reference-counted
+//                MeshData and is copied only when it is edited (copy-on-write)
+// 
 // Created:       30.10.24
 // =================================================================================
 #pragma once
@@ -17,6 +21,9 @@
 #include "../Mesh/Vertex.h"
 #include "../Mesh/Material.h"
 #include "../Mesh/MeshGeometry.h"
+#include "../Mesh/MeshData.h"
+#include "TriangleBVH.h"
+#include "SkinnedData.h"
 
 #include "../Texture/TextureTypes.h"
 
@@ -24,6 +31,21 @@
 #include <DirectXCollision.h>
 
 
+// pre-rendered views of the model around the Y axis (see ImpostorBaker)
+struct ImpostorAtlas
+{
+    inline bool IsBaked() const { return texID != INVALID_TEXTURE_ID; }
+
+    TexID             texID    = INVALID_TEXTURE_ID;
+    DirectX::XMFLOAT3 center   = { 0,0,0 };        // center of the quad in model space
+    DirectX::XMFLOAT2 size     = { 0,0 };          // width and height of the quad in model space
+    uint16_t          numViews = 0;
+    uint16_t          numCols  = 0;                // the atlas grid of views
+    uint16_t          numRows  = 0;
+};
+
+///////////////////////////////////////////////////////////
+
 enum eModelType : uint8_t
 {
     Invalid,
@@ -38,6 +60,7 @@ enum eModelType : uint8_t
     Terrain,
     LineBox,     // is used to visualise bounding boxes (AABB)
     Sky,         // this model is used to render the sky
+    MergedCell,  // static props of a grid cell which are merged into a single mesh (see StaticMeshMerger)
 };
 
 ///////////////////////////////////////////////////////////
@@ -59,8 +82,14 @@ public:
     BasicModel(const BasicModel&) = delete;
     BasicModel& operator=(const BasicModel&) = delete;
 
-    // deep copy
-    void Copy(ID3D11Device* pDevice, const BasicModel& rhs);
+    // copy of the model which shares the geometry with rhs (subsets with their
+    // materials, AABBs, etc. are per model); rhs isn't const since its geometry
+    // is moved into a shared MeshData (if it isn't shared yet)
+    void Copy(BasicModel& rhs);
+
+    // copy-on-write: must be called before the geometry is edited in place; if the
+    // geometry is shared it's copied (and its buffers are recreated if there is a device)
+    void MakeGeometryUnique(ID3D11Device* pDevice = nullptr);
 
     void InitializeBuffers(ID3D11Device* pDevice);
     void Shutdown();
@@ -87,6 +116,17 @@ public:
     inline int GetNumVertices()                         const { return numVertices_; }
     inline int GetNumIndices()                          const { return numIndices_; }
     inline int GetNumSubsets()                          const { return numSubsets_; }
+    inline int GetNumLods()                             const { return numLods_; }
+    inline DXGI_FORMAT GetIndexFormat()                 const { return meshes_.GetIndexFormat(); }
+    inline bool IsGeometryShared()                      const { return pSharedMesh_ != nullptr; }
+    inline bool IsSkinned()                             const { return skinned_.IsSkinned(); }
+
+    // num of indices of the origin geometry (LOD 0); indices of
+    // simplified LODs are stored after them in the same buffer
+    inline int GetNumLod0Indices() const
+    {
+        return (numLods_ > 1) ? (int)meshes_.subsets_[0].lodIndexStart[0] : (int)numIndices_;
+    }
 
 
     // update API
@@ -109,6 +149,13 @@ public:
     void ComputeModelAABB();
     void ComputeSubsetsAABB();
 
+    // build a triangle BVH (for ray casts) by the CPU copy of LOD 0 geometry
+    void BuildTriangleBVH();
+
+private:
+    void ShareGeometry();
+    void ReleaseGeometry();
+
 public:
     char                  name_[32] = "inv";
     ModelID               id_ = 0;
@@ -117,6 +164,7 @@ public:
     uint16_t              numSubsets_ = 0;
     uint16_t              numBones_ = 0;
     uint16_t              numAnimClips_ = 0;                             // animation clips
+    uint8_t               numLods_ = 1;                                  // levels of detail (see MeshSimplifier)
     eModelType            type_ = eModelType::Invalid;
     
     MeshGeometry          meshes_;                     // contains all the meshes data
@@ -126,6 +174,12 @@ public:
     // keep CPU copies of the meshes data to read from
     Vertex3D*             vertices_ = nullptr;
     UINT*                 indices_ = nullptr;
+    MeshData*             pSharedMesh_ = nullptr;      // if not null: vertices_/indices_ and buffers are of this shared geometry
+
+    TriangleBVH           bvh_;                        // over LOD 0 triangles (for picking/ray casts)
+    cvector<Meshlet>      meshlets_;                   // clusters of LOD 0 triangles of big subsets (for GPU culling; see MeshletBuilder)
+    ImpostorAtlas         impostor_;                   // the last LOD (if it is baked)
+    SkinnedData           skinned_;                    // skin weights, the skeleton and baked clips (if the model is animated)
 };
 
 } // namespace Core
@@ -0,0 +1,121 @@
+// =================================================================================
+// Filename:     DE3DFormat.h
+// Description:  binary layout of the .de3d v2 model file: a single blob which
+//               can be memory-mapped and used in place (without parsing);
+//
+//               [header][table of sections][sections...]
+//
+//               each section is a plain array of POD elements; vertices (already
+//               packed) and indices (already of the final width) are aligned by
+//               a page so their mapped views are passed to the GPU upload as is
+//
+//               NOTE: files of v1 (text headers + binary arrays) are still read
+//                     by the ModelLoader
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include "../Mesh/MeshGeometry.h"
+#include "../Mesh/Material.h"
+#include "SkinnedData.h"
+#include <DirectXCollision.h>
+
+
+namespace Core
+{
+
+constexpr char   DE3D_MAGIC[8]          = "DE3Dv2";
+constexpr uint32 DE3D_VERSION           = 2;
+constexpr uint32 DE3D_PAGE_ALIGNMENT    = 4096;  // for vertex/index sections
+constexpr uint32 DE3D_SECTION_ALIGNMENT = 16;    // for other sections
+constexpr int    DE3D_TEX_PATH_LENGTH   = 128;
+
+///////////////////////////////////////////////////////////
+
+enum eDE3DSection : uint32
+{
+    DE3D_SECTION_SUBSETS,               // DE3DSubset       [numSubsets]
+    DE3D_SECTION_SUBSETS_AABB,          // BoundingBox      [numSubsets]
+    DE3D_SECTION_VERTICES,              // Vertex3DPacked   [numVertices]
+    DE3D_SECTION_INDICES,               // uint16 or uint32 [numIndices]
+    DE3D_SECTION_BVH_NODES,             // TriangleBVH::Node[numNodes]   (optional)
+    DE3D_SECTION_BVH_TRIANGLES,         // UINT             [numTris*3]  (optional)
+    DE3D_SECTION_BVH_TRI_IDXS,          // uint32           [numTris]    (optional)
+    DE3D_SECTION_MATERIALS,             // DE3DMaterial     [numSubsets] (optional)
+    DE3D_SECTION_MESHLETS,              // Meshlet          [numMeshlets] (optional; sorted by subsets)
+    DE3D_SECTION_SKIN,                  // VertexSkin       [numVertices] (optional: skinned models only)
+    DE3D_SECTION_BONES,                 // Bone             [numBones]    (optional)
+    DE3D_SECTION_ANIM_CLIPS,            // AnimClip         [numAnimClips] (optional)
+    DE3D_SECTION_ANIM_PALETTES,         // BoneMatrix       [numFrames*numBones] (optional; baked frames of all the clips)
+
+    NUM_DE3D_SECTIONS
+};
+
+static_assert(sizeof(Meshlet) == 48, "the layout of meshlets is a part of the .de3d format");
+static_assert(sizeof(Bone) == 100,    "the layout of bones is a part of the .de3d format");
+static_assert(sizeof(AnimClip) == 48, "the layout of clips is a part of the .de3d format");
+
+///////////////////////////////////////////////////////////
+
+struct DE3DSection
+{
+    uint32 type   = 0;                  // eDE3DSection
+    uint32 count  = 0;                  // number of elements
+    uint64 offset = 0;                  // in bytes from the start of the file
+    uint64 size   = 0;                  // in bytes
+};
+
+///////////////////////////////////////////////////////////
+
+struct DE3DHeader
+{
+    char                 magic[8]{ '\0' };
+    uint32               version      = DE3D_VERSION;
+    uint32               numSections  = 0;
+
+    uint32               modelID      = 0;
+    char                 name[32]{ '\0' };
+    uint32               numVertices  = 0;
+    uint32               numIndices   = 0;
+    uint16               numSubsets   = 0;
+    uint16               numBones     = 0;
+    uint16               numAnimClips = 0;
+    uint8                numLods      = 1;
+    uint8                modelType    = 0;
+    uint32               indexSize    = 4;    // 2 or 4 bytes per index
+    DirectX::BoundingBox modelAABB;
+};
+
+///////////////////////////////////////////////////////////
+
+struct DE3DSubset
+{
+    uint32 vertexStart = 0;
+    uint32 vertexCount = 0;
+    uint32 indexStart  = 0;
+    uint32 indexCount  = 0;
+    uint32 lodIndexStart[MAX_NUM_MESH_LODS - 1]{ 0 };
+    uint32 lodIndexCount[MAX_NUM_MESH_LODS - 1]{ 0 };
+    uint16 id          = 0;
+    uint16 padding     = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+struct DE3DMaterial
+{
+    // a material of the subset; textures are referenced by paths relative to
+    // the working directory (an empty path: there is no texture of this type)
+    char   subsetName[SUBSET_NAME_LENGTH_LIMIT]{ '\0' };
+    char   name[MAX_LENGTH_MATERIAL_NAME]{ '\0' };
+    Float4 ambient    = { 1,1,1,1 };
+    Float4 diffuse    = { 1,1,1,1 };
+    Float4 specular   = { 0,0,0,1 };
+    Float4 reflect    = { .5f, .5f, .5f, 1 };
+    uint32 properties = 0;
+    char   texPaths[NUM_TEXTURE_TYPES][DE3D_TEX_PATH_LENGTH]{ '\0' };
+};
+
+} // namespace Core
@@ -0,0 +1,115 @@
+// =================================================================================
+// Filename:     DerivedDataCache.cpp
+// Description:  implementation of the DerivedDataCache's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "DerivedDataCache.h"
+#include "ModelImporter.h"
+#include "../Mesh/MaterialMgr.h"
+#include "../Texture/TextureMgr.h"
+#include <MappedFile.h>
+
+namespace fs = std::filesystem;
+
+
+namespace Core
+{
+
+// a directory of derived files (relatively to the assets dir)
+static const char* DERIVED_DATA_DIR = "ddc/";
+
+// FNV-1a params
+static constexpr uint64 FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static constexpr uint64 FNV_PRIME        = 1099511628211ULL;
+
+
+//---------------------------------------------------------
+// Desc:  mix the input bytes into the hash
+//---------------------------------------------------------
+static void HashBytes(uint64& hash, const void* data, const size_t numBytes)
+{
+    const uint8* bytes = (const uint8*)data;
+
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:  mix the input value into the hash
+//---------------------------------------------------------
+template <typename T>
+static void HashValue(uint64& hash, const T value)
+{
+    HashBytes(hash, &value, sizeof(value));
+}
+
+///////////////////////////////////////////////////////////
+
+bool DerivedDataCache::ComputeKey(
+    const char* srcPath,
+    const ModelImportSettings& settings,
+    uint64& outKey)
+{
+    // the content is hashed (not a name or a modification time) so a copied
+    // or touched but not changed file still finds its derived data
+
+    MappedFile srcFile;
+
+    if (!srcFile.Open(srcPath))
+        return false;
+
+    uint64 hash = FNV_OFFSET_BASIS;
+
+    HashBytes(hash, srcFile.GetData(), srcFile.GetSize());
+
+    // each setting separately (so padding of the struct isn't hashed)
+    HashValue(hash, settings.postProcessFlags);
+    HashValue(hash, settings.optimizeMesh);
+    HashValue(hash, settings.numLods);
+    HashValue(hash, settings.buildMeshlets);
+    HashValue(hash, IMPORTER_VERSION);
+
+    outKey = hash;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void DerivedDataCache::GetDerivedPath(const uint64 key, char* outPath, const int outPathSize)
+{
+    snprintf(outPath, outPathSize, "%s%016llx.de3d", DERIVED_DATA_DIR, (unsigned long long)key);
+}
+
+///////////////////////////////////////////////////////////
+
+bool DerivedDataCache::IsCacheable(const BasicModel& model)
+{
+    const MeshGeometry::Subset* subsets = model.meshes_.subsets_;
+
+    for (int i = 0; i < model.numSubsets_; ++i)
+    {
+        const Material& mat = g_MaterialMgr.GetMaterialByID(subsets[i].materialID);
+
+        for (int type = 0; type < NUM_TEXTURE_TYPES; ++type)
+        {
+            const TexID id = mat.textureIDs[type];
+
+            if (id == INVALID_TEXTURE_ID)
+                continue;
+
+            const Texture* pTex = g_TextureMgr.GetTexPtrByID(id);
+
+            if (!pTex || !fs::exists(pTex->GetName()))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace Core
@@ -0,0 +1,46 @@
+// =================================================================================
+// Filename:     DerivedDataCache.h
+// Description:  a cache of models which are derived from source assets
+//               (.fbx, .obj, etc.) by the import pipeline (assimp import, mesh
+//               optimization, LODs, BVH): the result is stored as a .de3d file
+//               and is reused by next imports instead of running the pipeline;
+//
+//               a derived file is found by a key:
+//                 hash(content of the source file + import settings + IMPORTER_VERSION)
+//               so an edited source file or a changed setting gives another key
+//               (the stale file just isn't used anymore)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include "BasicModel.h"
+
+
+namespace Core
+{
+
+struct ModelImportSettings;
+
+class DerivedDataCache
+{
+public:
+    // increase it when the import pipeline starts to produce a different output
+    static constexpr uint32 IMPORTER_VERSION = 3;
+
+    // compute a key of the derived data (false if the source file can't be read)
+    static bool ComputeKey(
+        const char* srcPath,
+        const ModelImportSettings& settings,
+        uint64& outKey);
+
+    // get a path of the derived .de3d file by key (relatively to the assets dir)
+    static void GetDerivedPath(const uint64 key, char* outPath, const int outPathSize);
+
+    // can the model be restored from a derived file? (its textures must be
+    // referenced by paths so embedded textures of the source file can't be cached)
+    static bool IsCacheable(const BasicModel& model);
+};
+
+} // namespace Core
@@ -8,6 +8,7 @@
 #include "GeometryGenerator.h"
 
 #include "../Model/ModelMath.h"
+#include "../Model/MeshKernels.h"
 #include "../Render/Color.h"
 
 #pragma warning (disable : 4996)
@@ -25,71 +26,20 @@ namespace Core
 
 void GeometryGenerator::ComputeTangents(
     Vertex3D* vertices,
-    UINT* indices,
+    const int numVertices,
+    const UINT* indices,
     const int numIndices)
 {
-    // compute tangent for each input vertex
+    // compute tangent for each input vertex (tangents of all the triangles which share
+    // a vertex are accumulated so it is smooth across the mesh)
     try
     {
-        CAssert::True(vertices,       "input ptr to vertices arr == nullptr");
-        CAssert::True(indices,        "input ptr to indices arr == nullptr");
-        CAssert::True(numIndices > 0, "input number of indices must be > 0");
+        CAssert::True(vertices,        "input ptr to vertices arr == nullptr");
+        CAssert::True(indices,         "input ptr to indices arr == nullptr");
+        CAssert::True(numVertices > 0, "input number of vertices must be > 0");
+        CAssert::True(numIndices > 0,  "input number of indices must be > 0");
 
-        for (int i = 0; i < numIndices;)
-        {
-            // get indices
-            const UINT i0 = indices[i++];
-            const UINT i1 = indices[i++];
-            const UINT i2 = indices[i++];
-
-            // get vertices by indices
-            Vertex3D& v0 = vertices[i0];
-            Vertex3D& v1 = vertices[i1];
-            Vertex3D& v2 = vertices[i2];
-
-            // compute edge vectors of the triangle
-            const XMFLOAT3 e0 = {
-                v1.position.x - v0.position.x,
-                v1.position.y - v0.position.y,
-                v1.position.z - v0.position.z };
-
-            const XMFLOAT3 e1 = {
-                v2.position.x - v0.position.x,
-                v2.position.y - v0.position.y,
-                v2.position.z - v0.position.z };
-
-            // compute deltas of texture coords
-            const float du0 = v1.texture.x - v0.texture.x;
-            const float dv0 = v1.texture.y - v0.texture.y;
-            const float du1 = v2.texture.x - v0.texture.x;
-            const float dv1 = v2.texture.y - v0.texture.y;
-
-            // compute interse matrix of texture coords
-            const float invDet = 1.0f / (du0 * dv1 - dv0 * du1);
-
-            //  | m00 m01 |
-            //  | m10 m11 |
-            const float m00 = invDet * +dv1;
-            const float m01 = invDet * -dv0;
-            const float m10 = invDet * -du1;
-            const float m11 = invDet * +du0;
-
-            // compute tangent coords
-            float Tx = (m00 * e0.x) + (m01 * e1.x);
-            float Ty = (m00 * e0.y) + (m01 * e1.y);
-            float Tz = (m00 * e0.z) + (m01 * e0.z);
-
-            // normalize the tangent
-            const float invTangLen = 1.0f / sqrtf(Tx * Tx + Ty * Ty + Tz * Tz);
-            Tx *= invTangLen;
-            Ty *= invTangLen;
-            Tz *= invTangLen;
-
-            // store tangent into vertices
-            v0.tangent = { Tx, Ty, Tz };
-            v1.tangent = { Tx, Ty, Tz };
-            v2.tangent = { Tx, Ty, Tz };
-        }
+        ModelMath::ComputeTangents(vertices, numVertices, indices, numIndices);
     }
     catch (EngineException& e)
     {
@@ -1209,7 +1159,7 @@ void GeometryGenerator::GenerateSphere(
     BuildSphereVertices(model.vertices_, vertexIdx, params, numVertices);
     BuildSphereIndices(model.indices_, vertexIdx - 1, sliceCount, stackCount);
 
-    ComputeTangents(model.vertices_, model.indices_, model.GetNumIndices());
+    ComputeTangents(model.vertices_, model.GetNumVertices(), model.indices_, model.GetNumIndices());
 }
 
 ///////////////////////////////////////////////////////////
@@ -1467,22 +1417,8 @@ void GeometryGenerator::ComputeAABB(
     const int numVertices,
     DirectX::BoundingBox& aabb)
 {
-    using namespace DirectX;
-
     // compute the bounding box of the mesh
-    XMVECTOR vMin{ FLT_MAX, FLT_MAX, FLT_MAX };
-    XMVECTOR vMax{ FLT_MIN, FLT_MIN, FLT_MIN };
-
-    for (int i = 0; i < numVertices; ++i)
-    {
-        XMVECTOR P = XMLoadFloat3(&vertices[i].position);
-        vMin = DirectX::XMVectorMin(vMin, P);
-        vMax = DirectX::XMVectorMax(vMax, P);
-    }
-
-    // convert min/max representation to center and extents representation
-    DirectX::XMStoreFloat3(&aabb.Center, 0.5f * (vMin + vMax));
-    DirectX::XMStoreFloat3(&aabb.Extents, 0.5f * (vMax - vMin));
+    MeshKernels::ComputeAABB(&vertices[0].position, sizeof(Vertex3D), numVertices, aabb);
 }
 
 ///////////////////////////////////////////////////////////
@@ -1775,10 +1711,6 @@ void GeometryGenerator::Subdivide(BasicModel& model)
 {
     // subdivide the input geosphere mesh into a smaller triangles
 
-    int vertexIdx = 0;
-    int indexIdx = 0;
-
-    const int numVertices = model.numVertices_;
     const int numIndices = model.numIndices_;
     const int newNumVertices = numIndices * 2;      // the number of vertices/indices of the subdivided geometry
     const int newNumIndices = numIndices * 4;      
@@ -1797,82 +1729,14 @@ void GeometryGenerator::Subdivide(BasicModel& model)
     model.meshes_.subsets_[0].vertexCount = newNumVertices;
     model.meshes_.subsets_[0].indexCount = newNumIndices;
 
-    //       v1
-    //       *
-    //      / \
-    //     /   \
-    //  m0*-----*m1
-    //   / \   / \
-    //  /   \ /   \
-    // *-----*-----*
-    // v0    m2     v2
-
-    Vertex3D* newVertices = model.vertices_;
-    UINT* newIndices = model.indices_;
-    
-    // go through each origin triangle and divide it
-    for (int i = 0; i < numIndices / 3; ++i)
-    {
-        // make vertices of subdivided triangle
-        Vertex3D& v0 = newVertices[vertexIdx++];
-        Vertex3D& v1 = newVertices[vertexIdx++];
-        Vertex3D& v2 = newVertices[vertexIdx++];
-
-        Vertex3D& m0 = newVertices[vertexIdx++];
-        Vertex3D& m1 = newVertices[vertexIdx++];
-        Vertex3D& m2 = newVertices[vertexIdx++];
-
-        // copy 3 old main vertices
-        const int baseIdx = i * 3;
-        v0 = oldVertices[oldIndices[baseIdx + 0] ];
-        v1 = oldVertices[oldIndices[baseIdx + 1] ];
-        v2 = oldVertices[oldIndices[baseIdx + 2] ];
-
-        //
-        // generate midpoints
-        //
-
-        // For subdivision, we just care about the position component. We derive the other
-        // vertex components in GenerateGeosphereMesh.
-        m0.position = DirectX::XMFLOAT3(
-            0.5f * (v0.position.x + v1.position.x),
-            0.5f * (v0.position.y + v1.position.y),
-            0.5f * (v0.position.z + v1.position.z));
-
-        m1.position = DirectX::XMFLOAT3(
-            0.5f * (v1.position.x + v2.position.x),
-            0.5f * (v1.position.y + v2.position.y),
-            0.5f * (v1.position.z + v2.position.z));
-
-        m2.position = DirectX::XMFLOAT3(
-            0.5f * (v0.position.x + v2.position.x),
-            0.5f * (v0.position.y + v2.position.y),
-            0.5f * (v0.position.z + v2.position.z));
-
-        //
-        // add new indices
-        //
-        
-        const int newGeoIdx = i * 6;
-    
-        // make indices of subdivided triangle
-        newIndices[indexIdx++] = newGeoIdx + 0;
-        newIndices[indexIdx++] = newGeoIdx + 3;
-        newIndices[indexIdx++] = newGeoIdx + 5;
-
-        newIndices[indexIdx++] = newGeoIdx + 3;
-        newIndices[indexIdx++] = newGeoIdx + 4;
-        newIndices[indexIdx++] = newGeoIdx + 5;
-
-        newIndices[indexIdx++] = newGeoIdx + 5;
-        newIndices[indexIdx++] = newGeoIdx + 4;
-        newIndices[indexIdx++] = newGeoIdx + 2;
-
-        newIndices[indexIdx++] = newGeoIdx + 3;
-        newIndices[indexIdx++] = newGeoIdx + 1;
-        newIndices[indexIdx++] = newGeoIdx + 4;
-
-    }
+    // midpoints get only positions: we derive the other
+    // vertex components in GenerateGeosphereMesh
+    MeshKernels::SubdivideTriangles(
+        oldVertices,
+        oldIndices,
+        numIndices / 3,
+        model.vertices_,
+        model.indices_);
 
     SafeDeleteArr(oldVertices);
     SafeDeleteArr(oldIndices);
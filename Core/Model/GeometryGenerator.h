@@ -37,7 +37,11 @@ private:
 public:
     GeometryGenerator() {};
 
-    void ComputeTangents(Vertex3D* vertices, UINT* indices, const int numIndices);
+    void ComputeTangents(
+        Vertex3D* vertices,
+        const int numVertices,
+        const UINT* indices,
+        const int numIndices);
 
     void GenerateCube(BasicModel& model);
     void GenerateLineBox(BasicModel& model);
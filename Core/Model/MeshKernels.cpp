@@ -0,0 +1,323 @@
+// =================================================================================
+// Filename:     MeshKernels.cpp
+// Description:  implementation of the MeshKernels' functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "MeshKernels.h"
+#include <JobSystem.h>
+#include <type_traits>
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// Desc:  get the i-th element of the strided array
+//---------------------------------------------------------
+template <typename T>
+static inline T* At(T* arr, const size stride, const index i)
+{
+    using Byte = std::conditional_t<std::is_const_v<T>, const uint8, uint8>;
+    return (T*)((Byte*)arr + (i * stride));
+}
+
+//---------------------------------------------------------
+// Desc:  execute fn(startIdx, endIdx) for chunks of the range by jobs
+//        (or in place if the range is small)
+//---------------------------------------------------------
+template <typename Fn>
+static inline void ForEachChunk(const size numElems, Fn&& fn)
+{
+    if (numElems <= MeshKernels::ELEMS_PER_JOB)
+        fn((index)0, numElems);
+    else
+        g_JobSystem.ParallelFor(numElems, MeshKernels::ELEMS_PER_JOB, std::forward<Fn>(fn));
+}
+
+//---------------------------------------------------------
+// Desc:  min/max of points in range [start, end); 4 independent accumulators
+//        so the next point doesn't wait for min/max of the previous one
+//---------------------------------------------------------
+static void MinMaxOfRange(
+    const XMFLOAT3* points,
+    const size stride,
+    const index start,
+    const index end,
+    XMVECTOR& outMin,
+    XMVECTOR& outMax)
+{
+    XMVECTOR min0 = XMVectorReplicate(+FLT_MAX);
+    XMVECTOR max0 = XMVectorReplicate(-FLT_MAX);
+    XMVECTOR min1 = min0, min2 = min0, min3 = min0;
+    XMVECTOR max1 = max0, max2 = max0, max3 = max0;
+
+    index i = start;
+
+    for (; i + 4 <= end; i += 4)
+    {
+        const XMVECTOR p0 = XMLoadFloat3(At(points, stride, i + 0));
+        const XMVECTOR p1 = XMLoadFloat3(At(points, stride, i + 1));
+        const XMVECTOR p2 = XMLoadFloat3(At(points, stride, i + 2));
+        const XMVECTOR p3 = XMLoadFloat3(At(points, stride, i + 3));
+
+        min0 = XMVectorMin(min0, p0);  max0 = XMVectorMax(max0, p0);
+        min1 = XMVectorMin(min1, p1);  max1 = XMVectorMax(max1, p1);
+        min2 = XMVectorMin(min2, p2);  max2 = XMVectorMax(max2, p2);
+        min3 = XMVectorMin(min3, p3);  max3 = XMVectorMax(max3, p3);
+    }
+
+    for (; i < end; ++i)
+    {
+        const XMVECTOR p = XMLoadFloat3(At(points, stride, i));
+        min0 = XMVectorMin(min0, p);
+        max0 = XMVectorMax(max0, p);
+    }
+
+    outMin = XMVectorMin(XMVectorMin(min0, min1), XMVectorMin(min2, min3));
+    outMax = XMVectorMax(XMVectorMax(max0, max1), XMVectorMax(max2, max3));
+}
+
+
+// =================================================================================
+//                              PUBLIC METHODS
+// =================================================================================
+void MeshKernels::TransformPoints(
+    const XMFLOAT3* inPoints,
+    const size inStride,
+    XMFLOAT3* outPoints,
+    const size outStride,
+    const size numPoints,
+    const XMMATRIX& m)
+{
+    assert((inPoints != nullptr) && (outPoints != nullptr));
+
+    const XMVECTOR r0 = m.r[0];
+    const XMVECTOR r1 = m.r[1];
+    const XMVECTOR r2 = m.r[2];
+    const XMVECTOR r3 = m.r[3];
+
+    ForEachChunk(numPoints, [&](const index start, const index end)
+    {
+        for (index i = start; i < end; ++i)
+        {
+            const XMVECTOR p = XMLoadFloat3(At(inPoints, inStride, i));
+
+            // x*r0 + y*r1 + z*r2 + r3
+            XMVECTOR res = XMVectorMultiplyAdd(XMVectorSplatZ(p), r2, r3);
+            res = XMVectorMultiplyAdd(XMVectorSplatY(p), r1, res);
+            res = XMVectorMultiplyAdd(XMVectorSplatX(p), r0, res);
+
+            XMStoreFloat3(At(outPoints, outStride, i), res);
+        }
+    });
+}
+
+///////////////////////////////////////////////////////////
+
+void MeshKernels::TransformDirections(
+    const XMFLOAT3* inDirs,
+    const size inStride,
+    XMFLOAT3* outDirs,
+    const size outStride,
+    const size numDirs,
+    const XMMATRIX& m,
+    const bool normalize)
+{
+    assert((inDirs != nullptr) && (outDirs != nullptr));
+
+    const XMVECTOR r0 = m.r[0];
+    const XMVECTOR r1 = m.r[1];
+    const XMVECTOR r2 = m.r[2];
+
+    ForEachChunk(numDirs, [&](const index start, const index end)
+    {
+        for (index i = start; i < end; ++i)
+        {
+            const XMVECTOR d = XMLoadFloat3(At(inDirs, inStride, i));
+
+            // x*r0 + y*r1 + z*r2
+            XMVECTOR res = XMVectorMultiply(XMVectorSplatZ(d), r2);
+            res = XMVectorMultiplyAdd(XMVectorSplatY(d), r1, res);
+            res = XMVectorMultiplyAdd(XMVectorSplatX(d), r0, res);
+
+            if (normalize)
+                res = XMVector3Normalize(res);
+
+            XMStoreFloat3(At(outDirs, outStride, i), res);
+        }
+    });
+}
+
+//---------------------------------------------------------
+// Desc:  min/max of points: big arrays are reduced by chunks (in parallel)
+//        and then the chunks are reduced in a fixed order
+//---------------------------------------------------------
+void MeshKernels::ComputeMinMax(
+    const XMFLOAT3* points,
+    const size stride,
+    const size numPoints,
+    XMFLOAT3& outMin,
+    XMFLOAT3& outMax)
+{
+    if ((points == nullptr) || (numPoints <= 0))
+    {
+        outMin = { 0,0,0 };
+        outMax = { 0,0,0 };
+        return;
+    }
+
+    XMVECTOR vMin;
+    XMVECTOR vMax;
+
+    if (numPoints <= ELEMS_PER_JOB)
+    {
+        MinMaxOfRange(points, stride, 0, numPoints, vMin, vMax);
+    }
+    else
+    {
+        const size numChunks = (numPoints + ELEMS_PER_JOB - 1) / ELEMS_PER_JOB;
+        cvector<XMFLOAT3> chunkMins(numChunks);
+        cvector<XMFLOAT3> chunkMaxs(numChunks);
+
+        g_JobSystem.ParallelFor(numChunks, 1, [&](const index startChunk, const index endChunk)
+        {
+            for (index c = startChunk; c < endChunk; ++c)
+            {
+                const index start = c * ELEMS_PER_JOB;
+                const index end   = std::min(start + ELEMS_PER_JOB, numPoints);
+
+                XMVECTOR cMin, cMax;
+                MinMaxOfRange(points, stride, start, end, cMin, cMax);
+
+                XMStoreFloat3(&chunkMins[c], cMin);
+                XMStoreFloat3(&chunkMaxs[c], cMax);
+            }
+        });
+
+        vMin = XMLoadFloat3(&chunkMins[0]);
+        vMax = XMLoadFloat3(&chunkMaxs[0]);
+
+        for (index c = 1; c < numChunks; ++c)
+        {
+            vMin = XMVectorMin(vMin, XMLoadFloat3(&chunkMins[c]));
+            vMax = XMVectorMax(vMax, XMLoadFloat3(&chunkMaxs[c]));
+        }
+    }
+
+    XMStoreFloat3(&outMin, vMin);
+    XMStoreFloat3(&outMax, vMax);
+}
+
+///////////////////////////////////////////////////////////
+
+void MeshKernels::ComputeAABB(
+    const XMFLOAT3* points,
+    const size stride,
+    const size numPoints,
+    BoundingBox& outAABB)
+{
+    XMFLOAT3 minPoint;
+    XMFLOAT3 maxPoint;
+    ComputeMinMax(points, stride, numPoints, minPoint, maxPoint);
+
+    // convert min/max representation to center and extents representation
+    const XMVECTOR vMin = XMLoadFloat3(&minPoint);
+    const XMVECTOR vMax = XMLoadFloat3(&maxPoint);
+
+    XMStoreFloat3(&outAABB.Center,  XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f));
+    XMStoreFloat3(&outAABB.Extents, XMVectorScale(XMVectorSubtract(vMax, vMin), 0.5f));
+}
+
+///////////////////////////////////////////////////////////
+
+void MeshKernels::MergeAABBs(
+    const BoundingBox* boxes,
+    const size numBoxes,
+    BoundingBox& outAABB)
+{
+    if ((boxes == nullptr) || (numBoxes <= 0))
+    {
+        outAABB.Center  = { 0,0,0 };
+        outAABB.Extents = { 0,0,0 };
+        return;
+    }
+
+    XMVECTOR vMin = XMVectorReplicate(+FLT_MAX);
+    XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+
+    for (index i = 0; i < numBoxes; ++i)
+    {
+        const XMVECTOR center  = XMLoadFloat3(&boxes[i].Center);
+        const XMVECTOR extents = XMLoadFloat3(&boxes[i].Extents);
+
+        vMin = XMVectorMin(vMin, XMVectorSubtract(center, extents));
+        vMax = XMVectorMax(vMax, XMVectorAdd(center, extents));
+    }
+
+    XMStoreFloat3(&outAABB.Center,  XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f));
+    XMStoreFloat3(&outAABB.Extents, XMVectorScale(XMVectorSubtract(vMax, vMin), 0.5f));
+}
+
+//---------------------------------------------------------
+// Desc:  each triangle writes only its own vertices/indices so triangles
+//        are subdivided by jobs independently
+//
+//               v1
+//               *
+//              / \
+//             /   \
+//        m01 *-----* m12
+//           / \   / \
+//          /   \ /   \
+//         *-----*-----*
+//        v0    m02     v2
+//---------------------------------------------------------
+void MeshKernels::SubdivideTriangles(
+    const Vertex3D* vertices,
+    const UINT* indices,
+    const size numTriangles,
+    Vertex3D* outVertices,
+    UINT* outIndices)
+{
+    assert((vertices != nullptr) && (indices != nullptr));
+    assert((outVertices != nullptr) && (outIndices != nullptr));
+
+    const XMVECTOR half = XMVectorReplicate(0.5f);
+
+    ForEachChunk(numTriangles, [&](const index start, const index end)
+    {
+        for (index i = start; i < end; ++i)
+        {
+            const UINT* tri = indices + (i * 3);
+            Vertex3D*   v   = outVertices + (i * 6);
+            UINT*       idx = outIndices  + (i * 12);
+            const UINT  base = (UINT)(i * 6);
+
+            // copy 3 old main vertices
+            v[0] = vertices[tri[0]];
+            v[1] = vertices[tri[1]];
+            v[2] = vertices[tri[2]];
+
+            // midpoints of edges (v0, v1), (v1, v2), (v0, v2)
+            const XMVECTOR p0 = XMLoadFloat3(&v[0].position);
+            const XMVECTOR p1 = XMLoadFloat3(&v[1].position);
+            const XMVECTOR p2 = XMLoadFloat3(&v[2].position);
+
+            XMStoreFloat3(&v[3].position, XMVectorMultiply(XMVectorAdd(p0, p1), half));
+            XMStoreFloat3(&v[4].position, XMVectorMultiply(XMVectorAdd(p1, p2), half));
+            XMStoreFloat3(&v[5].position, XMVectorMultiply(XMVectorAdd(p0, p2), half));
+
+            // indices of 4 subdivided triangles
+            idx[0]  = base + 0;  idx[1]  = base + 3;  idx[2]  = base + 5;
+            idx[3]  = base + 3;  idx[4]  = base + 4;  idx[5]  = base + 5;
+            idx[6]  = base + 5;  idx[7]  = base + 4;  idx[8]  = base + 2;
+            idx[9]  = base + 3;  idx[10] = base + 1;  idx[11] = base + 4;
+        }
+    });
+}
+
+} // namespace Core
@@ -0,0 +1,85 @@
+// =================================================================================
+// Filename:     MeshKernels.h
+// Description:  bulk (SIMD) kernels of mesh processing which are shared by the
+//               import, procedural generation and merging of meshes:
+//
+//               - transformation of points/directions by a matrix;
+//               - min/max reduction of points (AABB);
+//               - subdivision of triangles by midpoints of their edges;
+//
+//               arrays are strided (in bytes) so positions/normals are processed
+//               right in arrays of vertices; all the math goes by DirectXMath (SSE)
+//               and big arrays are split into chunks which are processed by jobs
+//               of the job system (small ones are processed in place)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Mesh/Vertex.h"
+#include <Types.h>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+
+namespace Core
+{
+
+class MeshKernels
+{
+public:
+    // arrays which are shorter than it are processed by the caller thread
+    static constexpr size ELEMS_PER_JOB = 16384;
+
+    // out[i] = in[i] * m (w == 1); the matrix must be affine (there is no division by w);
+    // in and out may be the same array (with the same stride)
+    static void TransformPoints(
+        const DirectX::XMFLOAT3* inPoints,
+        const size inStride,
+        DirectX::XMFLOAT3* outPoints,
+        const size outStride,
+        const size numPoints,
+        const DirectX::XMMATRIX& m);
+
+    // out[i] = in[i] * m (w == 0) and normalized if it is asked (normals, tangents)
+    static void TransformDirections(
+        const DirectX::XMFLOAT3* inDirs,
+        const size inStride,
+        DirectX::XMFLOAT3* outDirs,
+        const size outStride,
+        const size numDirs,
+        const DirectX::XMMATRIX& m,
+        const bool normalize);
+
+    // min/max of points; for no points both are zeros
+    static void ComputeMinMax(
+        const DirectX::XMFLOAT3* points,
+        const size stride,
+        const size numPoints,
+        DirectX::XMFLOAT3& outMin,
+        DirectX::XMFLOAT3& outMax);
+
+    static void ComputeAABB(
+        const DirectX::XMFLOAT3* points,
+        const size stride,
+        const size numPoints,
+        DirectX::BoundingBox& outAABB);
+
+    // a box which contains all the input boxes
+    static void MergeAABBs(
+        const DirectX::BoundingBox* boxes,
+        const size numBoxes,
+        DirectX::BoundingBox& outAABB);
+
+    // split each triangle into 4 ones by midpoints of its edges: a triangle
+    // gets its own 6 vertices (v0, v1, v2, m01, m12, m02) and 12 indices;
+    // midpoints get only positions (other components are derived by the caller)
+    static void SubdivideTriangles(
+        const Vertex3D* vertices,
+        const UINT* indices,
+        const size numTriangles,
+        Vertex3D* outVertices,
+        UINT* outIndices);
+};
+
+} // namespace Core
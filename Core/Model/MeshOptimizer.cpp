@@ -0,0 +1,483 @@
+// =================================================================================
+// Filename:     MeshOptimizer.cpp
+// Description:  implementation of the MeshOptimizer's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "MeshOptimizer.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// Desc:  a score of the vertex by the Forsyth's algorithm: vertices which
+//        are recently used and have few not emitted triangles are preferred
+// Args:  - cachePos:      position in the LRU cache (-1: isn't in the cache)
+//        - numActiveTris: the number of not emitted triangles of the vertex
+//---------------------------------------------------------
+static float ComputeVertexScore(const int cachePos, const int numActiveTris)
+{
+    constexpr float CACHE_DECAY_POWER   = 1.5f;
+    constexpr float LAST_TRI_SCORE      = 0.75f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    // no triangles left: the vertex is useless
+    if (numActiveTris == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+
+    if (cachePos >= 0)
+    {
+        // vertices of the last triangle get a fixed score so the next triangle
+        // doesn't just go back and forth over the same edge
+        if (cachePos < 3)
+        {
+            score = LAST_TRI_SCORE;
+        }
+        else
+        {
+            constexpr float scaler = 1.0f / (MeshOptimizer::CACHE_SIZE - 3);
+            score = powf(1.0f - (cachePos - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+
+    // boost vertices with few triangles left so they are finished and leave the cache
+    score += VALENCE_BOOST_SCALE * powf((float)numActiveTris, -VALENCE_BOOST_POWER);
+
+    return score;
+}
+
+///////////////////////////////////////////////////////////
+
+MeshOptimizer::Stats MeshOptimizer::Optimize(BasicModel& model)
+{
+    CAssert::True(model.vertices_ != nullptr, "the model has no CPU copy of vertices");
+    CAssert::True(model.indices_ != nullptr,  "the model has no CPU copy of indices");
+    CAssert::True(model.numLods_ == 1,        "the optimization must go before LODs generation");
+
+    // indices are reordered in place (the caller reinitializes buffers after it)
+    model.MakeGeometryUnique();
+
+    // skin weights go by the same idxs as vertices
+    const bool isSkinned = model.IsSkinned();
+
+    Stats stats;
+    float sumMissesBefore = 0;
+    float sumMissesAfter  = 0;
+    int   numTris         = 0;
+
+    for (int i = 0; i < model.GetNumSubsets(); ++i)
+    {
+        const MeshGeometry::Subset& subset = model.meshes_.subsets_[i];
+
+        // NOTE: indices are relative to the subset's vertexStart
+        Vertex3D*  vertices    = model.vertices_ + subset.vertexStart;
+        VertexSkin* skin       = (isSkinned) ? model.skinned_.skin.data() + subset.vertexStart : nullptr;
+        UINT*      indices     = model.indices_ + subset.indexStart;
+        const int  numIndices  = (int)subset.indexCount;
+        const int  numVertices = (int)subset.vertexCount;
+        const int  numSubsetTris = numIndices / 3;
+
+        if ((numSubsetTris == 0) || (numVertices == 0))
+            continue;
+
+        sumMissesBefore += ComputeACMR(indices, numIndices, numVertices) * numSubsetTris;
+
+        OptimizeVertexCache(indices, numIndices, numVertices);
+        stats.numClusters += OptimizeOverdraw(vertices, indices, numIndices, numVertices);
+        OptimizeVertexFetch(vertices, skin, indices, numIndices, numVertices);
+
+        sumMissesAfter += ComputeACMR(indices, numIndices, numVertices) * numSubsetTris;
+        numTris        += numSubsetTris;
+    }
+
+    if (numTris > 0)
+    {
+        stats.acmrBefore = sumMissesBefore / numTris;
+        stats.acmrAfter  = sumMissesAfter / numTris;
+    }
+
+    return stats;
+}
+
+///////////////////////////////////////////////////////////
+
+float MeshOptimizer::ComputeACMR(const UINT* indices, const int numIndices, const int numVertices)
+{
+    // simulate a FIFO cache: a vertex is in the cache if less than
+    // ACMR_CACHE_SIZE misses happened since it was put there
+
+    const int numTris = numIndices / 3;
+
+    if (numTris == 0)
+        return 0.0f;
+
+    cvector<int> timestamps(numVertices, 0);
+    int          time      = ACMR_CACHE_SIZE + 1;
+    int          numMisses = 0;
+
+    for (int i = 0; i < numTris * 3; ++i)
+    {
+        const UINT v = indices[i];
+
+        if (time - timestamps[v] > ACMR_CACHE_SIZE)
+        {
+            timestamps[v] = time++;
+            ++numMisses;
+        }
+    }
+
+    return (float)numMisses / (float)numTris;
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+void MeshOptimizer::OptimizeVertexCache(UINT* indices, const int numIndices, const int numVertices)
+{
+    // reorder triangles by the Forsyth's algorithm: each time emit the triangle
+    // with the best score among triangles of vertices in the simulated LRU cache
+
+    const int numTris = numIndices / 3;
+
+    // build adjacency: triangles of each vertex; for each vertex the active
+    // (not emitted) ones are kept in front of its range
+    vertNumActiveTris_.resize(numVertices);
+    vertTriOffsets_.resize(numVertices + 1);
+    vertTris_.resize(numTris * 3);
+    vertCachePos_.resize(numVertices);
+    vertScores_.resize(numVertices);
+
+    std::fill(vertNumActiveTris_.begin(), vertNumActiveTris_.end(), 0);
+
+    for (int i = 0; i < numTris * 3; ++i)
+        ++vertNumActiveTris_[indices[i]];
+
+    vertTriOffsets_[0] = 0;
+
+    for (int v = 0; v < numVertices; ++v)
+        vertTriOffsets_[v + 1] = vertTriOffsets_[v] + vertNumActiveTris_[v];
+
+    // (cache positions are used as cursors of filling for a moment)
+    for (int v = 0; v < numVertices; ++v)
+        vertCachePos_[v] = vertTriOffsets_[v];
+
+    for (int t = 0; t < numTris; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+            vertTris_[vertCachePos_[indices[t*3 + k]]++] = t;
+    }
+
+    for (int v = 0; v < numVertices; ++v)
+    {
+        vertCachePos_[v] = -1;
+        vertScores_[v]   = ComputeVertexScore(-1, vertNumActiveTris_[v]);
+    }
+
+    triScores_.resize(numTris);
+    triIsEmitted_.resize(numTris);
+    std::fill(triIsEmitted_.begin(), triIsEmitted_.end(), (uint8)0);
+
+    for (int t = 0; t < numTris; ++t)
+    {
+        const UINT* tri = indices + t*3;
+        triScores_[t] = vertScores_[tri[0]] + vertScores_[tri[1]] + vertScores_[tri[2]];
+    }
+
+    // LRU cache (+3 slots for vertices of the new triangle before they are pushed out)
+    int cache[CACHE_SIZE + 3];
+    int newCache[CACHE_SIZE + 3];
+    int cacheSize  = 0;
+    int bestTri    = -1;
+    int scanCursor = 0;
+
+    outIndices_.resize(numTris * 3);
+
+    for (int n = 0; n < numTris; ++n)
+    {
+        // nothing good in the cache: take the next not emitted triangle
+        if (bestTri < 0)
+        {
+            while (triIsEmitted_[scanCursor])
+                ++scanCursor;
+
+            bestTri = scanCursor;
+        }
+
+        const UINT* tri = indices + bestTri*3;
+
+        triIsEmitted_[bestTri] = 1;
+        outIndices_[n*3 + 0] = tri[0];
+        outIndices_[n*3 + 1] = tri[1];
+        outIndices_[n*3 + 2] = tri[2];
+
+        // vertices of the triangle go to the front of the cache
+        int newCacheSize = 0;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const int v = (int)tri[k];
+
+            if ((k > 0) && (v == (int)tri[0] || (k > 1 && v == (int)tri[1])))
+                continue;
+
+            newCache[newCacheSize++] = v;
+
+            // remove the triangle from the active ones of the vertex
+            // (a degenerate triangle is in the list of its vertex twice)
+            int* vertTris  = vertTris_.data() + vertTriOffsets_[v];
+            int& numActive = vertNumActiveTris_[v];
+
+            for (int j = 0; j < numActive; )
+            {
+                if (vertTris[j] == bestTri)
+                    std::swap(vertTris[j], vertTris[--numActive]);
+                else
+                    ++j;
+            }
+        }
+
+        for (int i = 0; i < cacheSize; ++i)
+        {
+            const int v = cache[i];
+
+            if ((v != (int)tri[0]) && (v != (int)tri[1]) && (v != (int)tri[2]))
+                newCache[newCacheSize++] = v;
+        }
+
+        // update scores of vertices in the cache and of ones which are pushed out
+        for (int i = 0; i < newCacheSize; ++i)
+        {
+            const int v   = newCache[i];
+            const int pos = (i < CACHE_SIZE) ? i : -1;
+
+            vertCachePos_[v] = pos;
+            vertScores_[v]   = ComputeVertexScore(pos, vertNumActiveTris_[v]);
+        }
+
+        // update scores of their triangles and find the best one
+        float bestScore = -1.0f;
+        bestTri = -1;
+
+        for (int i = 0; i < newCacheSize; ++i)
+        {
+            const int  v        = newCache[i];
+            const int* vertTris = vertTris_.data() + vertTriOffsets_[v];
+
+            for (int j = 0; j < vertNumActiveTris_[v]; ++j)
+            {
+                const int   t  = vertTris[j];
+                const UINT* tv = indices + t*3;
+                const float score = vertScores_[tv[0]] + vertScores_[tv[1]] + vertScores_[tv[2]];
+
+                triScores_[t] = score;
+
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTri   = t;
+                }
+            }
+        }
+
+        cacheSize = (newCacheSize < CACHE_SIZE) ? newCacheSize : CACHE_SIZE;
+        memcpy(cache, newCache, sizeof(int) * cacheSize);
+    }
+
+    memcpy(indices, outIndices_.data(), sizeof(UINT) * numTris * 3);
+}
+
+///////////////////////////////////////////////////////////
+
+int MeshOptimizer::OptimizeOverdraw(
+    const Vertex3D* vertices,
+    UINT* indices,
+    const int numIndices,
+    const int numVertices)
+{
+    // split the cache optimized triangles into clusters at points where the
+    // cache is "restarted" (all 3 vertices are missed) and sort clusters from
+    // the ones which face outside of the mesh (are rather visible and occlude
+    // others) to the inner ones; returns the number of clusters
+
+    const int numTris = numIndices / 3;
+
+    if (numTris < MIN_CLUSTER_NUM_TRIS * 2)
+        return 1;
+
+    const float acmrBefore = ComputeACMR(indices, numIndices, numVertices);
+
+    // find cluster boundaries by the FIFO cache (timestamps are in vertCachePos_)
+    vertCachePos_.resize(numVertices);
+    std::fill(vertCachePos_.begin(), vertCachePos_.end(), 0);
+
+    int time = ACMR_CACHE_SIZE + 1;
+
+    clusterStarts_.clear();
+    clusterStarts_.push_back(0);
+
+    for (int t = 0; t < numTris; ++t)
+    {
+        int numMisses = 0;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const UINT v = indices[t*3 + k];
+
+            if (time - vertCachePos_[v] > ACMR_CACHE_SIZE)
+            {
+                vertCachePos_[v] = time++;
+                ++numMisses;
+            }
+        }
+
+        if ((numMisses == 3) && (t - clusterStarts_.back() >= MIN_CLUSTER_NUM_TRIS))
+            clusterStarts_.push_back(t);
+    }
+
+    clusterStarts_.push_back(numTris);
+
+    const int numClusters = (int)clusterStarts_.size() - 1;
+
+    if (numClusters < 2)
+        return 1;
+
+    // the center of the mesh (area weighted)
+    XMVECTOR meshCenter = XMVectorZero();
+    float    meshArea   = 0.0f;
+
+    for (int t = 0; t < numTris; ++t)
+    {
+        const XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t*3 + 0]].position);
+        const XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t*3 + 1]].position);
+        const XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t*3 + 2]].position);
+        const float    area = XMVectorGetX(XMVector3Length(XMVector3Cross(p1 - p0, p2 - p0)));
+
+        meshCenter += (p0 + p1 + p2) * area;
+        meshArea   += area;
+    }
+
+    if (meshArea <= 0.0f)
+        return 1;
+
+    meshCenter /= (3.0f * meshArea);
+
+    // sort key of each cluster: how much it faces outside from the mesh center
+    clusterKeys_.resize(numClusters);
+    clusterOrder_.resize(numClusters);
+
+    for (int c = 0; c < numClusters; ++c)
+    {
+        XMVECTOR center = XMVectorZero();
+        XMVECTOR normal = XMVectorZero();
+        float    area   = 0.0f;
+
+        for (int t = clusterStarts_[c]; t < clusterStarts_[c + 1]; ++t)
+        {
+            const XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t*3 + 0]].position);
+            const XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t*3 + 1]].position);
+            const XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t*3 + 2]].position);
+            const XMVECTOR n  = XMVector3Cross(p1 - p0, p2 - p0);     // its length is 2 * area
+            const float    a  = XMVectorGetX(XMVector3Length(n));
+
+            center += (p0 + p1 + p2) * a;
+            normal += n;
+            area   += a;
+        }
+
+        center = (area > 0.0f) ? center / (3.0f * area) : meshCenter;
+
+        clusterKeys_[c]  = XMVectorGetX(XMVector3Dot(center - meshCenter, XMVector3Normalize(normal)));
+        clusterOrder_[c] = c;
+    }
+
+    std::stable_sort(clusterOrder_.begin(), clusterOrder_.end(), [this](const int a, const int b)
+    {
+        return clusterKeys_[a] > clusterKeys_[b];
+    });
+
+    // put triangles by the sorted clusters
+    outIndices_.resize(numTris * 3);
+    int numOutIndices = 0;
+
+    for (const int c : clusterOrder_)
+    {
+        const int start = clusterStarts_[c] * 3;
+        const int count = (clusterStarts_[c + 1] - clusterStarts_[c]) * 3;
+
+        memcpy(outIndices_.data() + numOutIndices, indices + start, sizeof(UINT) * count);
+        numOutIndices += count;
+    }
+
+    // the sorting costs too many cache misses: keep the cache optimized order
+    const float acmrAfter = ComputeACMR(outIndices_.data(), numIndices, numVertices);
+
+    if (acmrAfter > acmrBefore * OVERDRAW_ACMR_THRESHOLD)
+        return 1;
+
+    memcpy(indices, outIndices_.data(), sizeof(UINT) * numTris * 3);
+    return numClusters;
+}
+
+///////////////////////////////////////////////////////////
+
+void MeshOptimizer::OptimizeVertexFetch(
+    Vertex3D* vertices,
+    VertexSkin* skin,
+    UINT* indices,
+    const int numIndices,
+    const int numVertices)
+{
+    // remap vertices by the order of their first use by triangles;
+    // unused vertices are moved to the end (the subset's range stays the same)
+
+    constexpr UINT NOT_USED = UINT_MAX;
+
+    vertRemap_.resize(numVertices);
+    std::fill(vertRemap_.begin(), vertRemap_.end(), NOT_USED);
+
+    UINT nextIdx = 0;
+
+    for (int i = 0; i < numIndices; ++i)
+    {
+        UINT& remap = vertRemap_[indices[i]];
+
+        if (remap == NOT_USED)
+            remap = nextIdx++;
+
+        indices[i] = remap;
+    }
+
+    for (UINT& remap : vertRemap_)
+    {
+        if (remap == NOT_USED)
+            remap = nextIdx++;
+    }
+
+    outVertices_.resize(numVertices);
+
+    for (int v = 0; v < numVertices; ++v)
+        outVertices_[vertRemap_[v]] = vertices[v];
+
+    std::copy(outVertices_.begin(), outVertices_.end(), vertices);
+
+    if (!skin)
+        return;
+
+    outSkin_.resize(numVertices);
+
+    for (int v = 0; v < numVertices; ++v)
+        outSkin_[vertRemap_[v]] = skin[v];
+
+    std::copy(outSkin_.begin(), outSkin_.end(), skin);
+}
+
+} // namespace Core
@@ -0,0 +1,86 @@
+// =================================================================================
+// Filename:     MeshOptimizer.h
+// Description:  import-time optimization of meshes geometry for GPU:
+//
+//               - vertex cache: triangles of each subset are reordered by the
+//                 Forsyth's algorithm (LRU cache scoring) so post-transform
+//                 cache hits go up;
+//               - overdraw: the cache optimized order is split into clusters
+//                 (at cache "restarts") which are sorted from outer-facing ones
+//                 to inner so early-Z rejects more; it is accepted only if ACMR
+//                 doesn't grow more than by OVERDRAW_ACMR_THRESHOLD;
+//               - vertex fetch: vertices of each subset are remapped by the
+//                 order of their first use so fetches go sequentially
+//                 (skin weights of skinned models are remapped with them);
+//
+//               ACMR (average cache miss ratio) is the number of transformed
+//               vertices per triangle by a FIFO cache of ACMR_CACHE_SIZE
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "BasicModel.h"
+#include <cvector.h>
+
+
+namespace Core
+{
+
+class MeshOptimizer
+{
+public:
+    static constexpr int   CACHE_SIZE              = 32;     // LRU cache which is simulated by the scoring
+    static constexpr int   ACMR_CACHE_SIZE         = 16;     // FIFO cache for measuring
+    static constexpr float OVERDRAW_ACMR_THRESHOLD = 1.05f;  // max ACMR growth for overdraw sorting
+    static constexpr int   MIN_CLUSTER_NUM_TRIS    = 32;     // clusters smaller than it are merged with previous one
+
+    struct Stats
+    {
+        float acmrBefore = 0;
+        float acmrAfter  = 0;
+        int   numClusters = 0;                // overdraw clusters of all the subsets
+    };
+
+    // optimize the CPU copy of vertices/indices of the model (LOD 0 only);
+    // NOTE: must be called before LODs generation, BVH building and InitializeBuffers()
+    Stats Optimize(BasicModel& model);
+
+    // compute ACMR of the triangles
+    static float ComputeACMR(const UINT* indices, const int numIndices, const int numVertices);
+
+private:
+    void OptimizeVertexCache(UINT* indices, const int numIndices, const int numVertices);
+
+    int OptimizeOverdraw(
+        const Vertex3D* vertices,
+        UINT* indices,
+        const int numIndices,
+        const int numVertices);
+
+    void OptimizeVertexFetch(
+        Vertex3D* vertices,
+        VertexSkin* skin,                 // can be nullptr (a static model)
+        UINT* indices,
+        const int numIndices,
+        const int numVertices);
+
+private:
+    // scratch buffers (are reused for all the subsets)
+    cvector<int>      vertTriOffsets_;    // per vertex: start of its triangles in vertTris_
+    cvector<int>      vertTris_;          // triangles of each vertex
+    cvector<int>      vertNumActiveTris_; // per vertex: triangles which aren't emitted yet
+    cvector<int>      vertCachePos_;      // per vertex: position in the LRU cache (-1: isn't there)
+    cvector<float>    vertScores_;
+    cvector<float>    triScores_;
+    cvector<uint8>    triIsEmitted_;
+    cvector<UINT>     outIndices_;
+    cvector<int>      clusterStarts_;     // first triangle of each cluster (+ the end)
+    cvector<int>      clusterOrder_;
+    cvector<float>    clusterKeys_;
+    cvector<UINT>     vertRemap_;
+    cvector<Vertex3D> outVertices_;
+    cvector<VertexSkin> outSkin_;
+};
+
+} // namespace Core
@@ -0,0 +1,207 @@
+// =================================================================================
+// Filename:     MeshSimplifier.cpp
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "MeshSimplifier.h"
+#include <unordered_map>
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+void MeshSimplifier::GenerateLods(BasicModel& model, const int numLods)
+{
+    // generate simplified index sets of each subset and append them
+    // to the model's indices: [LOD 0 of all subsets][LOD 1 of all subsets]...
+
+    CAssert::True(model.vertices_ != nullptr, "the model has no CPU copy of vertices");
+    CAssert::True(model.indices_ != nullptr,  "the model has no CPU copy of indices");
+
+    const int maxNumLods = (numLods < MAX_NUM_MESH_LODS) ? numLods : MAX_NUM_MESH_LODS;
+    const int numSubsets = model.GetNumSubsets();
+    MeshGeometry::Subset* subsets = model.meshes_.subsets_;
+
+    model.numLods_ = 1;
+
+    cvector<UINT> indices(model.indices_, model.indices_ + model.numIndices_);
+    cvector<UINT> lodIndices;
+    cvector<UINT> subsetIndices;
+
+    for (int lod = 1; lod < maxNumLods; ++lod)
+    {
+        lodIndices.clear();
+
+        int numPrevIndices = 0;
+        int numLodIndices  = 0;
+
+        for (int i = 0; i < numSubsets; ++i)
+        {
+            MeshGeometry::Subset& subset = subsets[i];
+            const UINT  prevStart  = subset.GetIndexStart(lod - 1);
+            const int   prevCount  = (int)subset.GetIndexCount(lod - 1);
+
+            const int numIndices = SimplifySubset(
+                model.vertices_,
+                subset,
+                model.subsetsAABB_[i],
+                LOD_GRID_RESOLUTIONS[lod - 1],
+                indices.data() + prevStart,
+                prevCount,
+                subsetIndices);
+
+            subset.lodIndexStart[lod - 1] = (uint32_t)(indices.size() + lodIndices.size());
+
+            // the whole subset is collapsed: keep the prev level for it
+            if (numIndices == 0)
+            {
+                subset.lodIndexStart[lod - 1] = prevStart;
+                subset.lodIndexCount[lod - 1] = prevCount;
+                numLodIndices += prevCount;
+            }
+            else
+            {
+                lodIndices.append_vector(subsetIndices);
+                subset.lodIndexCount[lod - 1] = numIndices;
+                numLodIndices += numIndices;
+            }
+
+            numPrevIndices += prevCount;
+        }
+
+        // this level isn't simple enough to be worth it (so the next ones won't be either)
+        if (numLodIndices > (int)(numPrevIndices * MIN_REDUCTION))
+            break;
+
+        indices.append_vector(lodIndices);
+        model.numLods_ = (uint8_t)(lod + 1);
+    }
+
+    if (model.numLods_ == 1)
+        return;
+
+    // replace the CPU copy of indices with the extended one
+    model.AllocateIndices((int)indices.size());
+    model.CopyIndices(indices.data(), (int)indices.size());
+}
+
+///////////////////////////////////////////////////////////
+
+int MeshSimplifier::SimplifySubset(
+    const Vertex3D* vertices,
+    const MeshGeometry::Subset& subset,
+    const DirectX::BoundingBox& aabb,
+    const int gridResolution,
+    const UINT* srcIndices,
+    const int numSrcIndices,
+    cvector<UINT>& outIndices)
+{
+    // simplify triangles of the subset by vertex clustering;
+    // NOTE: indices are relative to the subset's vertexStart
+
+    outIndices.clear();
+
+    const int numVertices = (int)subset.vertexCount;
+
+    if ((numVertices == 0) || (numSrcIndices == 0))
+        return 0;
+
+    const Vertex3D* verts = vertices + subset.vertexStart;
+
+    // grid cells are cubes (by the largest side of the AABB)
+    const float maxExtent = (aabb.Extents.x > aabb.Extents.y) ?
+        ((aabb.Extents.x > aabb.Extents.z) ? aabb.Extents.x : aabb.Extents.z) :
+        ((aabb.Extents.y > aabb.Extents.z) ? aabb.Extents.y : aabb.Extents.z);
+
+    if (maxExtent <= 0.0f)
+        return 0;
+
+    const float    invCellSize = (float)gridResolution / (2.0f * maxExtent);
+    const XMFLOAT3 gridMin(
+        aabb.Center.x - aabb.Extents.x,
+        aabb.Center.y - aabb.Extents.y,
+        aabb.Center.z - aabb.Extents.z);
+
+    // compute a cluster key for each vertex: 3 x 20 bits of the cell + 3 bits of the normal octant
+    clusterKeys_.resize(numVertices);
+
+    for (int i = 0; i < numVertices; ++i)
+    {
+        const XMFLOAT3& p = verts[i].position;
+        const XMFLOAT3& n = verts[i].normal;
+
+        const uint64 cx = (uint64)((p.x - gridMin.x) * invCellSize) & 0xFFFFF;
+        const uint64 cy = (uint64)((p.y - gridMin.y) * invCellSize) & 0xFFFFF;
+        const uint64 cz = (uint64)((p.z - gridMin.z) * invCellSize) & 0xFFFFF;
+        const uint64 octant = (n.x < 0.0f) | ((n.y < 0.0f) << 1) | ((n.z < 0.0f) << 2);
+
+        clusterKeys_[i] = (cx << 43) | (cy << 23) | (cz << 3) | octant;
+    }
+
+    // find the center of each cluster...
+    struct Cluster
+    {
+        XMFLOAT3 sum     = { 0,0,0 };
+        int      count   = 0;
+        UINT     rep     = 0;          // idx of the representative vertex
+        float    repDist = FLT_MAX;    // its squared distance to the cluster's center
+    };
+
+    std::unordered_map<uint64, Cluster> clusters;
+    clusters.reserve(numVertices);
+
+    for (int i = 0; i < numVertices; ++i)
+    {
+        Cluster& c = clusters[clusterKeys_[i]];
+        c.sum.x += verts[i].position.x;
+        c.sum.y += verts[i].position.y;
+        c.sum.z += verts[i].position.z;
+        c.count++;
+    }
+
+    // ...and its vertex which is the closest to this center
+    for (int i = 0; i < numVertices; ++i)
+    {
+        Cluster& c = clusters[clusterKeys_[i]];
+        const float inv = 1.0f / (float)c.count;
+
+        const float dx = verts[i].position.x - c.sum.x * inv;
+        const float dy = verts[i].position.y - c.sum.y * inv;
+        const float dz = verts[i].position.z - c.sum.z * inv;
+        const float dist = dx*dx + dy*dy + dz*dz;
+
+        if (dist < c.repDist)
+        {
+            c.repDist = dist;
+            c.rep     = (UINT)i;
+        }
+    }
+
+    clusterReps_.resize(numVertices);
+
+    for (int i = 0; i < numVertices; ++i)
+        clusterReps_[i] = clusters[clusterKeys_[i]].rep;
+
+    // remap triangles and drop the degenerate ones
+    outIndices.reserve(numSrcIndices);
+
+    for (int i = 0; i < numSrcIndices; i += 3)
+    {
+        const UINT i0 = clusterReps_[srcIndices[i + 0]];
+        const UINT i1 = clusterReps_[srcIndices[i + 1]];
+        const UINT i2 = clusterReps_[srcIndices[i + 2]];
+
+        if ((i0 == i1) || (i1 == i2) || (i0 == i2))
+            continue;
+
+        outIndices.push_back(i0);
+        outIndices.push_back(i1);
+        outIndices.push_back(i2);
+    }
+
+    return (int)outIndices.size();
+}
+
+} // namespace Core
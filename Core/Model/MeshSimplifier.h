@@ -0,0 +1,53 @@
+// =================================================================================
+// Filename:     MeshSimplifier.h
+// Description:  generates levels of detail (LODs) for models by vertex clustering:
+//
+//               - vertices of each subset are snapped to a uniform grid (which is
+//                 coarser for each next LOD) and split by normals octant, so
+//                 opposite faces of thin geometry don't collapse into each other;
+//               - each cluster is replaced by its vertex which is the closest
+//                 to the cluster's center so LODs reuse the vertex buffer;
+//               - degenerate triangles are dropped and the rest are appended to
+//                 the model's indices as a new index range per subset
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "BasicModel.h"
+#include <cvector.h>
+
+
+namespace Core
+{
+
+class MeshSimplifier
+{
+public:
+    // number of grid cells by the largest side of the subset's AABB for LOD 1, 2, ...
+    static constexpr int LOD_GRID_RESOLUTIONS[MAX_NUM_MESH_LODS - 1] = { 32, 12, 5 };
+
+    // a new LOD is dropped if it has more than this fraction of triangles of the prev one
+    static constexpr float MIN_REDUCTION = 0.85f;
+
+    // generate up to numLods levels (including LOD 0) for the model by its CPU copy
+    // of vertices/indices; NOTE: must be called before InitializeBuffers()
+    void GenerateLods(BasicModel& model, const int numLods);
+
+private:
+    // simplify indices of a single subset; returns the number of output indices
+    int SimplifySubset(
+        const Vertex3D* vertices,
+        const MeshGeometry::Subset& subset,
+        const DirectX::BoundingBox& aabb,
+        const int gridResolution,
+        const UINT* srcIndices,
+        const int numSrcIndices,
+        cvector<UINT>& outIndices);
+
+private:
+    cvector<uint64> clusterKeys_;        // per vertex of the current subset
+    cvector<UINT>   clusterReps_;        // per vertex: idx of its cluster's representative
+};
+
+} // namespace Core
@@ -0,0 +1,193 @@
+// =================================================================================
+// Filename:     MeshletBuilder.cpp
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "MeshletBuilder.h"
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+// a normal cone which is wider than this (dot of the axis and the farthest normal)
+// is never backfacing so it isn't tested at all
+static constexpr float MIN_CONE_DOT = 0.1f;
+
+///////////////////////////////////////////////////////////
+
+void MeshletBuilder::Build(BasicModel& model)
+{
+    CAssert::True(model.vertices_ != nullptr, "the model has no CPU copy of vertices");
+    CAssert::True(model.indices_ != nullptr,  "the model has no CPU copy of indices");
+
+    MeshGeometry::Subset* subsets = model.meshes_.subsets_;
+    model.meshlets_.clear();
+
+    for (int i = 0; i < model.GetNumSubsets(); ++i)
+    {
+        MeshGeometry::Subset& subset = subsets[i];
+
+        subset.meshletStart = (uint32)model.meshlets_.size();
+        subset.meshletCount = 0;
+
+        if ((int)(subset.indexCount / 3) < MIN_SUBSET_TRIANGLES)
+            continue;
+
+        BuildSubset(model, subset, model.meshlets_);
+        subset.meshletCount = (uint32)model.meshlets_.size() - subset.meshletStart;
+    }
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+void MeshletBuilder::BuildSubset(
+    const BasicModel& model,
+    const MeshGeometry::Subset& subset,
+    cvector<Meshlet>& outMeshlets)
+{
+    // indices of the subset are relative to its first vertex
+
+    const Vertex3D* vertices = model.vertices_ + subset.vertexStart;
+    const UINT*     indices  = model.indices_;
+    const uint32    numTris  = subset.indexCount / 3;
+
+    vertexStamps_.resize(subset.vertexCount);
+    std::fill(vertexStamps_.begin(), vertexStamps_.end(), 0);
+
+    uint32 stamp    = 1;
+    uint32 numVerts = 0;
+    uint32 startIdx = subset.indexStart;
+    uint32 endIdx   = subset.indexStart;
+
+    auto flush = [&]()
+    {
+        Meshlet meshlet;
+        meshlet.indexStart = startIdx;
+        meshlet.indexCount = endIdx - startIdx;
+        meshlet.subsetID   = subset.id;
+
+        ComputeBounds(vertices, indices, meshlet);
+        outMeshlets.push_back(meshlet);
+
+        startIdx = endIdx;
+        numVerts = 0;
+        ++stamp;
+    };
+
+    for (uint32 tri = 0; tri < numTris; ++tri)
+    {
+        const UINT i0 = indices[endIdx + 0];
+        const UINT i1 = indices[endIdx + 1];
+        const UINT i2 = indices[endIdx + 2];
+
+        if ((i0 >= subset.vertexCount) || (i1 >= subset.vertexCount) || (i2 >= subset.vertexCount))
+        {
+            endIdx += 3;
+            continue;
+        }
+
+        // the number of vertices this triangle adds into the current meshlet
+        auto countNew = [&]()
+        {
+            return (uint32)(vertexStamps_[i0] != stamp) +
+                   (uint32)((vertexStamps_[i1] != stamp) && (i1 != i0)) +
+                   (uint32)((vertexStamps_[i2] != stamp) && (i2 != i0) && (i2 != i1));
+        };
+
+        const uint32 numMeshletTris = (endIdx - startIdx) / 3;
+
+        if ((numVerts + countNew() > MAX_VERTICES) || (numMeshletTris + 1 > MAX_TRIANGLES))
+            flush();
+
+        numVerts += countNew();
+        vertexStamps_[i0] = stamp;
+        vertexStamps_[i1] = stamp;
+        vertexStamps_[i2] = stamp;
+        endIdx += 3;
+    }
+
+    if (endIdx > startIdx)
+        flush();
+}
+
+///////////////////////////////////////////////////////////
+
+void MeshletBuilder::ComputeBounds(
+    const Vertex3D* vertices,
+    const UINT* indices,
+    Meshlet& meshlet) const
+{
+    // a bounding sphere around the center of the AABB of vertices and
+    // a cone of triangle normals (as a sum of unit normals)
+
+    const UINT* tris    = indices + meshlet.indexStart;
+    const int   numIdxs = (int)meshlet.indexCount;
+
+    XMVECTOR vMin = XMVectorReplicate(+FLT_MAX);
+    XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+    XMVECTOR sumN = XMVectorZero();
+
+    for (int i = 0; i < numIdxs; i += 3)
+    {
+        const XMVECTOR p0 = XMLoadFloat3(&vertices[tris[i + 0]].position);
+        const XMVECTOR p1 = XMLoadFloat3(&vertices[tris[i + 1]].position);
+        const XMVECTOR p2 = XMLoadFloat3(&vertices[tris[i + 2]].position);
+
+        vMin = XMVectorMin(vMin, XMVectorMin(p0, XMVectorMin(p1, p2)));
+        vMax = XMVectorMax(vMax, XMVectorMax(p0, XMVectorMax(p1, p2)));
+
+        // clockwise triangles are front faces
+        const XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+
+        if (XMVectorGetX(XMVector3LengthSq(n)) > 1e-20f)
+            sumN = XMVectorAdd(sumN, XMVector3Normalize(n));
+    }
+
+    const XMVECTOR center = XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f);
+    float radiusSq = 0;
+
+    for (int i = 0; i < numIdxs; ++i)
+    {
+        const XMVECTOR p = XMLoadFloat3(&vertices[tris[i]].position);
+        radiusSq = std::max(radiusSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p, center))));
+    }
+
+    XMStoreFloat3(&meshlet.center, center);
+    meshlet.radius = sqrtf(radiusSq);
+
+    // the cone is degenerate: the meshlet is never backfacing
+    meshlet.coneAxis   = { 0,0,0 };
+    meshlet.coneCutoff = 1.0f;
+
+    if (XMVectorGetX(XMVector3LengthSq(sumN)) < 1e-12f)
+        return;
+
+    const XMVECTOR axis   = XMVector3Normalize(sumN);
+    float          minDot = 1.0f;
+
+    for (int i = 0; i < numIdxs; i += 3)
+    {
+        const XMVECTOR p0 = XMLoadFloat3(&vertices[tris[i + 0]].position);
+        const XMVECTOR p1 = XMLoadFloat3(&vertices[tris[i + 1]].position);
+        const XMVECTOR p2 = XMLoadFloat3(&vertices[tris[i + 2]].position);
+        const XMVECTOR n  = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+
+        if (XMVectorGetX(XMVector3LengthSq(n)) > 1e-20f)
+            minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(XMVector3Normalize(n), axis)));
+    }
+
+    if (minDot <= MIN_CONE_DOT)
+        return;
+
+    // the meshlet is backfacing if the direction from the camera to its center is
+    // inside the cone of (-normals) widened by the sphere:
+    // dot(center - camPos, axis) >= coneCutoff * length(center - camPos) + radius
+    XMStoreFloat3(&meshlet.coneAxis, axis);
+    meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+} // namespace Core
@@ -0,0 +1,53 @@
+// =================================================================================
+// Filename:     MeshletBuilder.h
+// Description:  splits LOD 0 triangles of big subsets into meshlets (clusters of
+//               up to MAX_TRIANGLES triangles / MAX_VERTICES vertices) with bounding
+//               spheres and normal cones, so the GPU culling can reject invisible
+//               parts of a big mesh (by the frustum, backfacing and Hi-Z):
+//
+//               - triangles are walked in the order of the index buffer and a new
+//                 meshlet is started when the current one is full; so triangles
+//                 aren't reordered and each meshlet is a contiguous range of indices;
+//               - the order is of MeshOptimizer so neighbor triangles go together
+//                 and meshlets are compact
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "BasicModel.h"
+#include <cvector.h>
+
+
+namespace Core
+{
+
+class MeshletBuilder
+{
+public:
+    static constexpr int MAX_VERTICES  = 64;
+    static constexpr int MAX_TRIANGLES = 124;
+
+    // smaller subsets are culled as a whole
+    static constexpr int MIN_SUBSET_TRIANGLES = 4096;
+
+    // build meshlets of the model (model.meshlets_ and ranges of subsets) by its
+    // CPU copy of vertices/indices; NOTE: must be called after the MeshOptimizer
+    void Build(BasicModel& model);
+
+private:
+    void BuildSubset(
+        const BasicModel& model,
+        const MeshGeometry::Subset& subset,
+        cvector<Meshlet>& outMeshlets);
+
+    void ComputeBounds(
+        const Vertex3D* vertices,
+        const UINT* indices,
+        Meshlet& meshlet) const;
+
+private:
+    cvector<uint32> vertexStamps_;       // per vertex of the current subset: (the last meshlet which uses it) + 1
+};
+
+} // namespace Core
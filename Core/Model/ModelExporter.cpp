@@ -8,6 +8,9 @@
 #include "../Texture/TextureTypes.h"
 #include "ImgConverter.h"
 #include "../Texture/TextureMgr.h"
+#include "../Mesh/MaterialMgr.h"
+#include "../Mesh/VertexPacked.h"
+#include "DE3DFormat.h"
 
 namespace fs = std::filesystem;
 
@@ -15,6 +18,46 @@ namespace fs = std::filesystem;
 namespace Core
 {
 
+//---------------------------------------------------------
+// Desc:   add a section into the table of the .de3d v2 file
+//         (offsets are computed when all the sections are added)
+//---------------------------------------------------------
+static void AddSection(
+    DE3DSection* sections,
+    const void** sectionsData,
+    uint32& numSections,
+    const eDE3DSection type,
+    const uint32 count,
+    const uint32 elemSize,
+    const void* data)
+{
+    DE3DSection& section = sections[numSections];
+    section.type  = type;
+    section.count = count;
+    section.size  = (uint64)count * elemSize;
+
+    sectionsData[numSections] = data;
+    numSections++;
+}
+
+//---------------------------------------------------------
+// Desc:   write zero bytes until the stream reaches the offset
+//---------------------------------------------------------
+static void PadUpTo(std::ofstream& fout, const uint64 offset)
+{
+    static const char zeros[DE3D_PAGE_ALIGNMENT]{ 0 };
+    uint64 pos = (uint64)fout.tellp();
+
+    while (pos < offset)
+    {
+        const uint64 num = std::min(offset - pos, (uint64)DE3D_PAGE_ALIGNMENT);
+        fout.write(zeros, num);
+        pos += num;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 ModelExporter::ModelExporter()
 {
     // create a directory for this exported model (if not exist)
@@ -24,68 +67,262 @@ ModelExporter::ModelExporter()
 
 ///////////////////////////////////////////////////////////
 
-void ModelExporter::ExportIntoDE3D(
+bool ModelExporter::ExportIntoDE3D(
     ID3D11Device* pDevice,
     const BasicModel& model,
     const char* dstRelativePath)
 {
-    // store model's data into a .de3d file by path
+    // store model's data into a .de3d file by path; the file is written
+    // in the v2 format: a blob of sections in the GPU-ready form which
+    // is memory-mapped by the loader (see DE3DFormat.h)
 
-    if ((dstRelativePath == nullptr) && (dstRelativePath[0] == '\0'))
+    if ((dstRelativePath == nullptr) || (dstRelativePath[0] == '\0'))
     {
         LogErr("can't export model into internal .de3d format: dst path is empty!");
-        return;
+        return false;
+    }
+
+    // NOTE: local buffers instead of g_String since exports run in parallel
+    char msg[512]{ '\0' };
+
+    if ((model.numVertices_ == 0) || (model.numIndices_ == 0) || (model.numSubsets_ == 0))
+    {
+        snprintf(msg, sizeof(msg), "can't export model into .de3d format: it has no geometry: %s", model.name_);
+        LogErr(msg);
+        return false;
     }
 
     char targetDir[256]{ '\0' };
-    char* fullPath = g_String;
+    char fullPath[256]{ '\0' };
 
     // generate a full path and target directory path
-    sprintf(fullPath, "%s%s", g_RelPathAssetsDir, dstRelativePath);
+    snprintf(fullPath, sizeof(fullPath), "%s%s", g_RelPathAssetsDir, dstRelativePath);
     FileSys::GetParentPath(fullPath, targetDir);
 
     // create a directory for this exported model (if dir not exist)
-    if (!fs::exists(targetDir))
-        fs::create_directory(targetDir);
+    std::error_code errCode;
+    fs::create_directories(targetDir, errCode);
 
     // open .de3d file for writing model's data
     std::ofstream fout(fullPath, std::ios::out | std::ios::binary);
     if (!fout)
     {
-        sprintf(g_String, "can't open a file for model exporting (into .de3d format): %s", fullPath);
-        LogErr(g_String);
-        return;
+        snprintf(msg, sizeof(msg), "can't open a file for model exporting (into .de3d format): %s", fullPath);
+        LogErr(msg);
+        return false;
+    }
+
+    // ---------------------------------------------
+    // prepare the data in the form it is used by the GPU
+
+    const int  numVertices = (int)model.numVertices_;
+    const int  numIndices  = (int)model.numIndices_;
+    const int  numSubsets  = (int)model.numSubsets_;
+    const bool is16Bit     = (model.numVertices_ <= UINT16_MAX + 1);
+
+    cvector<Vertex3DPacked> packedVertices;
+    packedVertices.resize_uninitialized(numVertices);
+    PackVertices(model.vertices_, packedVertices.data(), numVertices);
+
+    cvector<uint16> indices16;
+    if (is16Bit)
+    {
+        indices16.resize_uninitialized(numIndices);
+
+        for (int i = 0; i < numIndices; ++i)
+            indices16[i] = (uint16)model.indices_[i];
+    }
+
+    cvector<DE3DSubset> subsets(numSubsets);
+    for (int i = 0; i < numSubsets; ++i)
+    {
+        const MeshGeometry::Subset& src = model.meshes_.subsets_[i];
+        DE3DSubset&                 dst = subsets[i];
+
+        dst.vertexStart = src.vertexStart;
+        dst.vertexCount = src.vertexCount;
+        dst.indexStart  = src.indexStart;
+        dst.indexCount  = src.indexCount;
+        dst.id          = src.id;
+
+        for (int lod = 0; lod < MAX_NUM_MESH_LODS - 1; ++lod)
+        {
+            dst.lodIndexStart[lod] = src.lodIndexStart[lod];
+            dst.lodIndexCount[lod] = src.lodIndexCount[lod];
+        }
+    }
+
+    // materials of subsets (only textures from files can be referenced)
+    cvector<DE3DMaterial> materials(numSubsets);
+    for (int i = 0; i < numSubsets; ++i)
+    {
+        const MeshGeometry::Subset& subset = model.meshes_.subsets_[i];
+        const Material&             mat    = g_MaterialMgr.GetMaterialByID(subset.materialID);
+        DE3DMaterial&               dst    = materials[i];
+
+        strncpy(dst.subsetName, subset.name, sizeof(dst.subsetName) - 1);
+        strncpy(dst.name,       mat.name,    sizeof(dst.name) - 1);
+
+        dst.ambient    = mat.ambient;
+        dst.diffuse    = mat.diffuse;
+        dst.specular   = mat.specular;
+        dst.reflect    = mat.reflect;
+        dst.properties = mat.properties;
+
+        for (int type = 0; type < NUM_TEXTURE_TYPES; ++type)
+        {
+            const Texture* pTex = (mat.textureIDs[type] != INVALID_TEXTURE_ID) ? g_TextureMgr.GetTexPtrByID(mat.textureIDs[type]) : nullptr;
+
+            if (pTex && fs::exists(pTex->GetName()))
+                strncpy(dst.texPaths[type], pTex->GetName().c_str(), DE3D_TEX_PATH_LENGTH - 1);
+        }
+    }
+
+    // ---------------------------------------------
+    // fill in the header and the table of sections
+
+    DE3DHeader header;
+    strncpy(header.magic, DE3D_MAGIC, sizeof(header.magic));
+    strncpy(header.name, model.name_, sizeof(header.name) - 1);
+
+    header.modelID      = model.id_;
+    header.numVertices  = model.numVertices_;
+    header.numIndices   = model.numIndices_;
+    header.numSubsets   = model.numSubsets_;
+    header.numBones     = model.numBones_;
+    header.numAnimClips = model.numAnimClips_;
+    header.numLods      = model.numLods_;
+    header.modelType    = (uint8)model.type_;
+    header.indexSize    = (is16Bit) ? sizeof(uint16) : sizeof(UINT);
+    header.modelAABB    = model.modelAABB_;
+
+    DE3DSection sections[NUM_DE3D_SECTIONS];
+    const void* sectionsData[NUM_DE3D_SECTIONS]{ nullptr };
+    uint32      numSections = 0;
+
+    const TriangleBVH& bvh          = model.bvh_;
+    const uint32       numNodes     = (uint32)bvh.GetNumNodes();
+    const uint32       numTriangles = (uint32)bvh.GetNumTriangles();
+    const void*        indices      = (is16Bit) ? (const void*)indices16.data() : (const void*)model.indices_;
+
+    AddSection(sections, sectionsData, numSections, DE3D_SECTION_SUBSETS,      numSubsets,  sizeof(DE3DSubset),           subsets.data());
+    AddSection(sections, sectionsData, numSections, DE3D_SECTION_SUBSETS_AABB, numSubsets,  sizeof(DirectX::BoundingBox), model.subsetsAABB_);
+    AddSection(sections, sectionsData, numSections, DE3D_SECTION_VERTICES,     numVertices, sizeof(Vertex3DPacked),       packedVertices.data());
+    AddSection(sections, sectionsData, numSections, DE3D_SECTION_INDICES,      numIndices,  header.indexSize,             indices);
+    AddSection(sections, sectionsData, numSections, DE3D_SECTION_MATERIALS,    numSubsets,  sizeof(DE3DMaterial),         materials.data());
+
+    // the triangle BVH is cached so it isn't rebuilt at each loading
+    if (!bvh.IsEmpty())
+    {
+        AddSection(sections, sectionsData, numSections, DE3D_SECTION_BVH_NODES,     numNodes,         sizeof(TriangleBVH::Node), bvh.nodes_.data());
+        AddSection(sections, sectionsData, numSections, DE3D_SECTION_BVH_TRIANGLES, numTriangles * 3, sizeof(UINT),              bvh.triangles_.data());
+        AddSection(sections, sectionsData, numSections, DE3D_SECTION_BVH_TRI_IDXS,  numTriangles,     sizeof(uint32),            bvh.triIdxs_.data());
+    }
+
+    if (!model.meshlets_.empty())
+    {
+        const uint32 numMeshlets = (uint32)model.meshlets_.size();
+        AddSection(sections, sectionsData, numSections, DE3D_SECTION_MESHLETS, numMeshlets, sizeof(Meshlet), model.meshlets_.data());
+    }
+
+    // skin weights, the skeleton and baked clips of an animated model
+    const SkinnedData& skinned = model.skinned_;
+
+    if (skinned.IsSkinned())
+    {
+        const uint32 numBones    = skinned.GetNumBones();
+        const uint32 numClips    = (uint32)skinned.clips.size();
+        const uint32 numPalettes = (uint32)skinned.palettes.size();
+
+        header.numBones     = (uint16)numBones;
+        header.numAnimClips = (uint16)numClips;
+
+        AddSection(sections, sectionsData, numSections, DE3D_SECTION_SKIN,  numVertices, sizeof(VertexSkin), skinned.skin.data());
+        AddSection(sections, sectionsData, numSections, DE3D_SECTION_BONES, numBones,    sizeof(Bone),       skinned.bones.data());
+
+        if ((numClips > 0) && (numPalettes > 0))
+        {
+            AddSection(sections, sectionsData, numSections, DE3D_SECTION_ANIM_CLIPS,    numClips,    sizeof(AnimClip),   skinned.clips.data());
+            AddSection(sections, sectionsData, numSections, DE3D_SECTION_ANIM_PALETTES, numPalettes, sizeof(BoneMatrix), skinned.palettes.data());
+        }
+        else
+        {
+            header.numAnimClips = 0;
+        }
+    }
+    else
+    {
+        header.numBones     = 0;
+        header.numAnimClips = 0;
+    }
+
+    header.numSections = numSections;
+
+    // compute offsets: vertices/indices start at a page so their mapped
+    // views can be passed into the GPU upload as is
+    uint64 offset = sizeof(DE3DHeader) + sizeof(DE3DSection) * numSections;
+
+    for (uint32 i = 0; i < numSections; ++i)
+    {
+        const bool   isGeometry = (sections[i].type == DE3D_SECTION_VERTICES) || (sections[i].type == DE3D_SECTION_INDICES);
+        const uint64 alignment  = (isGeometry) ? DE3D_PAGE_ALIGNMENT : DE3D_SECTION_ALIGNMENT;
+
+        offset = (offset + alignment - 1) & ~(alignment - 1);
+        sections[i].offset = offset;
+        offset += sections[i].size;
+    }
+
+    // ---------------------------------------------
+    // write the blob
+
+    fout.write((const char*)&header, sizeof(header));
+    fout.write((const char*)sections, sizeof(DE3DSection) * numSections);
+
+    for (uint32 i = 0; i < numSections; ++i)
+    {
+        PadUpTo(fout, sections[i].offset);
+        fout.write((const char*)sectionsData[i], sections[i].size);
+    }
+
+    if (!fout)
+    {
+        snprintf(msg, sizeof(msg), "can't write model into .de3d file: %s", fullPath);
+        LogErr(msg);
+        return false;
     }
-    
-    WriteHeader(fout, model);
-    WriteMaterials(pDevice, fout, model, targetDir);
-    WriteSubsetTable(fout, model.meshes_.subsets_, model.numSubsets_);
-
-    WriteModelSubsetsAABB(fout, model.modelAABB_, model.subsetsAABB_, model.numSubsets_);
-    WriteVertices(fout, model.vertices_, model.numVertices_);
-    WriteIndices(fout, model.indices_, model.numIndices_);
+
+    return true;
 }
 
+///////////////////////////////////////////////////////////
 
-// =================================================================================
-//                               PRIVATE METHODS
-// =================================================================================
-void ModelExporter::WriteHeader(std::ofstream& fout, const BasicModel& model)
+bool ModelExporter::IsUpToDate(const char* dstRelativePath) const
 {
-    fout << "***************Header***************\n";
-    fout << "#ModelID "   << model.id_ << '\n';
-    fout << "#ModelName " << model.name_ << '\n';
-    fout << "#ModelType " << (int)model.type_ << '\n';
-    fout << "#Meshes "    << model.numSubsets_ << '\n';
-    fout << "#Vertices "  << model.numVertices_ << '\n';
-    fout << "#Indices "   << model.numIndices_ << '\n';
-    fout << "#Bones "     << model.numBones_ << '\n';
-    fout << "#AnimationClips " << model.numAnimClips_ << '\n';
-    fout << '\n';
+    // a file is up to date if it exists and is of the current format version
+    // (files of older versions are exported again)
+
+    if ((dstRelativePath == nullptr) || (dstRelativePath[0] == '\0'))
+        return false;
+
+    char fullPath[256]{ '\0' };
+    snprintf(fullPath, sizeof(fullPath), "%s%s", g_RelPathAssetsDir, dstRelativePath);
+
+    std::ifstream fin(fullPath, std::ios::in | std::ios::binary);
+    if (!fin)
+        return false;
+
+    DE3DHeader header;
+    if (!fin.read((char*)&header, sizeof(header)))
+        return false;
+
+    return (strncmp(header.magic, DE3D_MAGIC, sizeof(header.magic)) == 0) &&
+           (header.version == DE3D_VERSION);
 }
 
-///////////////////////////////////////////////////////////
 
+// =================================================================================
+//                               PRIVATE METHODS
+// =================================================================================
 void WriteTextureIntoFile(
     const fs::path& texFullPath,
     ID3D11Device* pDevice,
@@ -225,7 +462,6 @@ void WriteSubsetTextures(
 #endif
 }
 
-
 ///////////////////////////////////////////////////////////
 
 
@@ -274,88 +510,6 @@ void ModelExporter::WriteMaterials(
 
 ///////////////////////////////////////////////////////////
 
-void ModelExporter::WriteSubsetTable(
-    std::ofstream& fout,
-    const MeshGeometry::Subset* subsets,
-    const int numSubsets)
-{
-    // write data of each subset in the model
-
-    CAssert::True((subsets != nullptr) && (numSubsets > 0), "wrong subsets data");
-
-    fout << "***************SubsetTable*******************\n";
-
-    for (int i = 0; i < numSubsets; ++i)
-    {
-        fout << "SubsetID: "    << subsets[i].id << ' '
-             << "VertexStart: " << subsets[i].vertexStart << ' '
-             << "VertexCount: " << subsets[i].vertexCount << ' '
-             << "IndexStart: "  << subsets[i].indexStart << ' '
-             << "IndexCount: "  << subsets[i].indexCount << std::endl;
-    }
-
-    fout << std::endl;
-}
-
-///////////////////////////////////////////////////////////
-
-void ModelExporter::WriteModelSubsetsAABB(
-    std::ofstream& fout,
-    const DirectX::BoundingBox& modelAABB,
-    const DirectX::BoundingBox* subsetsAABBs,
-    const int numAABB)
-{
-    CAssert::True((subsetsAABBs != nullptr) && (numAABB > 0), "wrong input data");
-
-    // write data about AABB of the whole model and each model's subset
-
-    fout << "***************AABB(center,extents)*******************\n";
-
-    fout << "Model: ";
-    WriteAABB(fout, modelAABB);
-
-    for (int i = 0; i < numAABB; ++i)
-    {
-        fout << "Subset_" << i << ": ";
-        WriteAABB(fout, subsetsAABBs[i]);
-    }
-
-    fout << std::endl;
-}
-
-///////////////////////////////////////////////////////////
-
-
-void ModelExporter::WriteVertices(
-    std::ofstream& fout,
-    const Vertex3D* vertices,
-    const int numVertices)
-{
-    // write data of each vertex in the model
-
-    CAssert::True((vertices != nullptr) && (numVertices > 0), "wrong vertices data");
-
-    fout << "***************Vertices**********************\n";
-    fout.write((char*)vertices, sizeof(Vertex3D) * numVertices);
-}
-
-///////////////////////////////////////////////////////////
-
-void ModelExporter::WriteIndices(
-    std::ofstream& fout,
-    const UINT* indices,
-    const int numIndices)
-{
-    // write indices data (faces/triangles) of the model
-
-    CAssert::True((indices != nullptr) && (numIndices > 0), "wrong subsets data");
-
-    fout << "***************Triangles*********************\n";
-    fout.write((char*)indices, sizeof(UINT) * numIndices);
-}
-
-///////////////////////////////////////////////////////////
-
 void ModelExporter::WriteMaterialProps(std::ofstream& fout, const Material& mat)
 {
     // write input material into file output stream
@@ -383,19 +537,4 @@ void ModelExporter::WriteMaterialProps(std::ofstream& fout, const Material& mat)
         << mat.reflect.z << '\n';
 }
 
-///////////////////////////////////////////////////////////
-
-void ModelExporter::WriteAABB(
-    std::ofstream& fout,
-    const DirectX::BoundingBox& aabb)
-{
-    // write the AABB data into the file output stream
-    fout << aabb.Center.x << ' '
-        << aabb.Center.y << ' '
-        << aabb.Center.z << ' '
-        << aabb.Extents.x << ' '
-        << aabb.Extents.y << ' '
-        << aabb.Extents.z << '\n';
-}
-
 } // namespace Core
@@ -1,7 +1,7 @@
 // *********************************************************************************
 // Filename:     ModelExporter.h
 // Description:  exports models which were imported or manually generated into
-//               the .de3d format
+//               the .de3d format (v2: a memory-mappable blob, see DE3DFormat.h)
 // 
 // Created:      11.11.24
 // *********************************************************************************
@@ -18,43 +18,23 @@ class ModelExporter
 public:
 	ModelExporter();
 
-	void ExportIntoDE3D(
+	// NOTE: doesn't touch the GPU and global buffers so different models
+	//       can be exported by several threads at once
+	bool ExportIntoDE3D(
 		ID3D11Device* pDevice,
 		const BasicModel& model, 
 		const char* path);
 
-private:
-	void WriteHeader(std::ofstream& fout, const BasicModel& model);
+	// is there a .de3d file of the current version by the path (relative to assets)?
+	bool IsUpToDate(const char* path) const;
 
+private:
 	void WriteMaterials(
 		ID3D11Device* pDevice,
 		std::ofstream& fout, 
 		const BasicModel& model,
 		const char* targetDirFullPath);
 
-	void WriteSubsetTable(
-		std::ofstream& fout, 
-		const MeshGeometry::Subset* subsets,
-		const int numSubsets);
-
-	void WriteModelSubsetsAABB(
-		std::ofstream& fout,
-		const DirectX::BoundingBox& modelAABB,
-		const DirectX::BoundingBox* subsetsAABBs,
-		const int numAABB);
-
-	void WriteVertices(
-		std::ofstream& fout, 
-		const Vertex3D* vertices,
-		const int numVertices);
-
-	void WriteIndices(
-		std::ofstream& fout,
-		const UINT* indices,
-		const int numIndices);
-
-	void WriteAABB(std::ofstream& fout, const DirectX::BoundingBox& aabb);
-	void WriteFLOAT3(std::ofstream& fout, const DirectX::XMFLOAT3& data);
 	void WriteMaterialProps(std::ofstream& fout, const Material& mat);
 };
 
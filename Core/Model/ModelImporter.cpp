@@ -7,10 +7,12 @@
 #include "ModelImporter.h"
 
 #include "ModelMath.h"
+#include "MeshKernels.h"
 #include "../Mesh/MaterialMgr.h"
 #include "../Model/ModelLoaderM3D.h"
 #include "../Texture/TextureMgr.h"
 #include "../Model/ModelImporterHelpers.h"
+#include <JobSystem.h>
 
 using namespace DirectX;
 
@@ -18,12 +20,19 @@ using namespace DirectX;
 namespace Core
 {
 
-// duration time of importing process
-double ModelImporter::s_ImportDuration_     = 0.0;
-double ModelImporter::s_TexLoadingDuration_ = 0.0;
-double ModelImporter::s_VerticesLoading_    = 0.0;
-double ModelImporter::s_NodesLoading_       = 0.0;
-double ModelImporter::s_SceneLoading_       = 0.0;
+// per-stage stats of importing process
+ModelImportStats ModelImporter::s_Stats_;
+
+using TimePoint = std::chrono::steady_clock::time_point;
+
+//---------------------------------------------------------
+// Desc:  get the number of milliseconds since the input time point
+//---------------------------------------------------------
+static double GetElapsedMs(const TimePoint& start)
+{
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
 
 
 // =================================================================================
@@ -32,10 +41,12 @@ double ModelImporter::s_SceneLoading_       = 0.0;
 bool ModelImporter::LoadFromFile(
     ID3D11Device* pDevice,
     BasicModel& model,
-    const char* filePath)
+    const char* filePath,
+    const ModelImportSettings& settings)
 {
     // this function initializes a new model from the file 
     // of type .blend, .fbx, .3ds, .obj, .m3d, etc.
+    MEM_TAG_SCOPE(MEM_TAG_MODELS);
 
     if ((filePath == nullptr) || (filePath[0] == '\0'))
     {
@@ -69,14 +80,7 @@ bool ModelImporter::LoadFromFile(
 
         auto sceneStart = std::chrono::steady_clock::now();
 
-        const aiScene* pScene = importer.ReadFile(
-            filePath,
-            aiProcess_FixInfacingNormals |
-            aiProcess_GenNormals |
-            aiProcess_CalcTangentSpace |
-            aiProcess_ImproveCacheLocality |
-            aiProcess_Triangulate |
-            aiProcess_ConvertToLeftHanded);
+        const aiScene* pScene = importer.ReadFile(filePath, settings.postProcessFlags);
 
         // assert that we successfully read the data file
         if (pScene == nullptr)
@@ -87,29 +91,103 @@ bool ModelImporter::LoadFromFile(
         }
 
         // compute duration of the scene loading
-        auto sceneEnd = std::chrono::steady_clock::now();
-        std::chrono::duration<double, std::milli> sceneElapsed = sceneEnd - sceneStart;
-        ModelImporter::s_SceneLoading_ += sceneElapsed.count();
+        s_Stats_.sceneLoading += GetElapsedMs(sceneStart);
+
+        // --------------------------------------
+
+        // flatten the node tree into a list of meshes: each mesh already knows
+        // where its vertices/indices start so meshes don't depend on each other
+        auto flattenStart = std::chrono::steady_clock::now();
+
+        cvector<MeshWorkItem> items;
+        uint32 numVertices = 0;
+        uint32 numIndices  = 0;
+
+        FlattenNodes(pScene->mRootNode, pScene, items, numVertices, numIndices);
 
+        const int numSubsets = (int)items.size();
 
-        // compute how many vertices/indices/materials/subsets this model has
-        ComputeNumOfData(model, pScene->mRootNode, pScene);
+        model.numVertices_ = numVertices;
+        model.numIndices_  = numIndices;
+        model.numSubsets_  = (uint16)numSubsets;
 
         // allocate memory for vertices/indices/etc.
         model.AllocateMemory(model.numVertices_, model.numIndices_, model.numSubsets_);
 
-        int subsetIdx = 0;
-        auto nodeStart = std::chrono::steady_clock::now();
+        s_Stats_.flattening += GetElapsedMs(flattenStart);
+
+        // --------------------------------------
+
+        // the skeleton goes before geometry so skin weights are read together with vertices
+        auto skeletonStart = std::chrono::steady_clock::now();
+
+        cvector<const aiNode*> boneNodes;
+        const bool isSkinned = BuildSkeleton(pScene, items, model, boneNodes);
+
+        s_Stats_.animations += GetElapsedMs(skeletonStart);
+
+        // --------------------------------------
+
+        // load vertices/indices/AABB of all the meshes in parallel
+        // (each job writes only into ranges of its own subsets)
+        auto geometryStart = std::chrono::steady_clock::now();
+
+        g_JobSystem.ParallelFor(numSubsets, 1, [&](const index startIdx, const index endIdx)
+        {
+            for (index i = startIdx; i < endIdx; ++i)
+            {
+                ProcessMeshGeometry(model, items[i], (int)i);
+
+                if (isSkinned)
+                    ProcessMeshSkin(model, items[i], boneNodes);
+            }
+        });
+
+        s_Stats_.geometry += GetElapsedMs(geometryStart);
+
+        // bake clips into palettes of the skeleton
+        if (isSkinned && pScene->HasAnimations())
+        {
+            auto bakingStart = std::chrono::steady_clock::now();
+            BakeAnimations(pScene, boneNodes, model);
+            s_Stats_.animations += GetElapsedMs(bakingStart);
+        }
+
+        // --------------------------------------
+
+        // read colors and define texture sources of materials in parallel
+        auto materialsStart = std::chrono::steady_clock::now();
+
+        std::vector<MeshMaterialData> materials(numSubsets);
+        char parentDirPath[256]{ '\0' };
+
+        FileSys::GetParentPath(filePath, parentDirPath);
+
+        g_JobSystem.ParallelFor(numSubsets, 1, [&](const index startIdx, const index endIdx)
+        {
+            for (index i = startIdx; i < endIdx; ++i)
+            {
+                const aiMaterial* pAiMat = pScene->mMaterials[items[i].pMesh->mMaterialIndex];
+                Material&         mat    = materials[i].material;
+
+                LoadMaterialColorsData(pAiMat, mat);
+                GetMaterialTexSources(pAiMat, pScene, parentDirPath, materials[i].textures);
+                strncpy(mat.name, pAiMat->GetName().C_Str(), MAX_LENGTH_MATERIAL_NAME);
+            }
+        });
+
+        s_Stats_.materials += GetElapsedMs(materialsStart);
+
+        // load textures of all the materials at once
+        LoadMaterialTextures(pDevice, materials);
+
+        // store materials into the material manager and also store their IDs into subsets
+        auto registrationStart = std::chrono::steady_clock::now();
 
-        // load all the meshes/materials/textures/etc.
-        ProcessNode(
-            pDevice,
-            model,
-            subsetIdx,
-            pScene->mRootNode,
-            pScene,
-            DirectX::XMMatrixIdentity(),
-            filePath);
+        for (int i = 0; i < numSubsets; ++i)
+            model.meshes_.subsets_[i].materialID = g_MaterialMgr.AddMaterial(std::move(materials[i].material));
+
+        s_Stats_.registration += GetElapsedMs(registrationStart);
 
 #if 0
         // compute normal vectors
@@ -198,16 +276,10 @@ bool ModelImporter::LoadFromFile(
 
         importer.FreeScene();
 
-        // compute the duration of the nodes processing
-        auto nodeEnd = std::chrono::steady_clock::now();
-        std::chrono::duration<double, std::milli> nodeElapsed = nodeEnd - nodeStart;
-        ModelImporter::s_NodesLoading_ += nodeElapsed.count();
-
         // compute the duration of the whole process of importing
-        auto end = std::chrono::steady_clock::now();
-        std::chrono::duration<double, std::milli> elapsed = end - start;
-
-        ModelImporter::s_ImportDuration_ += elapsed.count();
+        s_Stats_.total += GetElapsedMs(start);
+        s_Stats_.numModels++;
+        s_Stats_.numMeshes += numSubsets;
 
         sprintf(g_String, "Model is loaded from file: %s", filePath);
         LogDbg(g_String);
@@ -227,127 +299,41 @@ bool ModelImporter::LoadFromFile(
 // =================================================================================
 //                              PRIVATE METHODS
 // =================================================================================
-void ModelImporter::ComputeNumOfData(
-    BasicModel& model,
-    const aiNode* pNode,
-    const aiScene* pScene)
-{
-    // go through all the meshes in the current model's node
-    for (UINT i = 0; i < pNode->mNumMeshes; i++)
-    {
-        aiMesh* pMesh = pScene->mMeshes[pNode->mMeshes[i]];
-
-        // accumulate the amount of vertices/indices/subsets in this model
-        model.numVertices_ += pMesh->mNumVertices;
-        model.numIndices_ += pMesh->mNumFaces * 3;
-        model.numSubsets_++;
-    }
-
-    // go through all the child nodes of the current node and handle it
-    for (UINT i = 0; i < pNode->mNumChildren; i++)
-    {
-        ComputeNumOfData(model, pNode->mChildren[i], pScene);
-    }
-}
-
-///////////////////////////////////////////////////////////
-
-void ModelImporter::ProcessNode(
-    ID3D11Device* pDevice,
-    BasicModel& model,
-    int& subsetIdx,
+void ModelImporter::FlattenNodes(
     const aiNode* pNode,
     const aiScene* pScene,
-    const DirectX::XMMATRIX& parentTransformMatrix,  // a matrix which is used to transform position of this mesh to the proper location
-    const char* filePath)                            // full path to the model
+    cvector<MeshWorkItem>& outItems,
+    uint32& numVertices,
+    uint32& numIndices)
 {
-    //
-    // this function goes through each node of the scene's tree structure
-    // starting from the root node and initializes a mesh using data of this each node;
-    //
-    // created mesh is pushed into the input meshes array
-    //
+    // go through the node tree (depth first) and put each mesh into the list
+    // together with start positions of its vertices/indices in the model
 
-    const XMMATRIX nodeTransformMatrix = XMMATRIX(&pNode->mTransformation.a1) * parentTransformMatrix;
-
-    // go through all the meshes in the current model's node
     for (UINT i = 0; i < pNode->mNumMeshes; i++)
     {
-        aiMesh* pMesh = pScene->mMeshes[pNode->mMeshes[i]];
-
-        // handle this mesh and push it into the model's meshes array
-        ProcessMesh(
-            pDevice,
-            model,
-            subsetIdx,
-            pMesh,
-            pScene,
-            nodeTransformMatrix,
-            filePath);
-
-        ++subsetIdx;
+        const aiMesh* pMesh = pScene->mMeshes[pNode->mMeshes[i]];
+
+        MeshWorkItem item;
+        item.pMesh       = pMesh;
+        item.vertexStart = numVertices;
+        item.indexStart  = numIndices;
+        outItems.push_back(item);
+
+        // accumulate the amount of vertices/indices in this model
+        numVertices += pMesh->mNumVertices;
+        numIndices  += pMesh->mNumFaces * 3;
     }
 
     // go through all the child nodes of the current node and handle it
     for (UINT i = 0; i < pNode->mNumChildren; i++)
     {
-        ProcessNode(
-            pDevice,
-            model,
-            subsetIdx,
-            pNode->mChildren[i],
-            pScene,
-            nodeTransformMatrix,
-            filePath);
-    }
-}
-
-///////////////////////////////////////////////////////////
-
-void ModelImporter::ProcessMesh(
-    ID3D11Device* pDevice,
-    BasicModel& model,
-    int& subsetIdx,
-    const aiMesh* pMesh,                                    // the current mesh of the model
-    const aiScene* pScene,                            // a ptr to the scene of this model type
-    const DirectX::XMMATRIX& transformMatrix,        // a matrix which is used to transform position of this mesh to the proper location
-    const char* filePath)                      // full path to the model
-{
-    
-    MeshGeometry::Subset& subset = model.meshes_.subsets_[subsetIdx];
-
-    try
-    {
-        Material material;
-
-        model.meshes_.SetSubsetName(subsetIdx, pMesh->mName.C_Str());
-
-        // load vertices/indices/subsets data
-        GetVerticesIndicesOfMesh(pMesh, model, subset, subsetIdx);
-
-        // get material data of this mesh
-        aiMaterial* pAiMat = pScene->mMaterials[pMesh->mMaterialIndex];
-        LoadMaterialColorsData(pAiMat, material);
-
-        // load available textures for this mesh and store IDs of these texture into the material
-        LoadMaterialTextures(pDevice, material.textureIDs, pAiMat, subset, pScene, filePath);
-
-        // store a material into the material manager and also store its material ID into the subset (mesh)
-        strncpy(material.name, pAiMat->GetName().C_Str(), MAX_LENGTH_MATERIAL_NAME);
-        subset.materialID = g_MaterialMgr.AddMaterial(std::move(material));
-        
-    }
-    catch (EngineException& e)
-    {
-        LogErr(e);
-        sprintf(g_String, "can't import a mesh \"%s\" for a model from file: %s", subset.name, filePath);
-        throw EngineException(g_String);
+        FlattenNodes(pNode->mChildren[i], pScene, outItems, numVertices, numIndices);
     }
 }
 
 ///////////////////////////////////////////////////////////
 
-void ModelImporter::LoadMaterialColorsData(aiMaterial* pMaterial, Material& mat)
+void ModelImporter::LoadMaterialColorsData(const aiMaterial* pMaterial, Material& mat)
 {
     // read material properties for this mesh
 
@@ -377,49 +363,27 @@ void ModelImporter::LoadMaterialColorsData(aiMaterial* pMaterial, Material& mat)
 
 ///////////////////////////////////////////////////////////
 
-void ModelImporter::LoadMaterialTextures(
-    ID3D11Device* pDevice,
-    TexID* texIDs,
+void ModelImporter::GetMaterialTexSources(
     const aiMaterial* pMaterial,
-    const MeshGeometry::Subset& subset,
     const aiScene* pScene,
-    const char* filePath)
+    const char* parentDirPath,
+    TexSource* outSources)
 {
     //
-    // load all the available textures for this mesh by its material data
+    // define where each texture of the material comes from (a file or embedded data);
+    // NOTE: it is executed by worker threads so the scene is only read here
     //
 
-    std::vector<aiTextureType> texTypesToLoad;
-    std::vector<UINT> texCounts;
-
-    // define what texture types to load
-    for (u32 i = 1; i < NUM_TEXTURE_TYPES; ++i)
+    for (u32 texType = 1; texType < NUM_TEXTURE_TYPES; ++texType)
     {
-        const aiTextureType type = (aiTextureType)i;
-
-        // if there are some textures by this type
-        if (UINT texCount = pMaterial->GetTextureCount(type))
-        {
-            texTypesToLoad.push_back(type);
-            texCounts.push_back(texCount);
-        }
-    }
-
-  
-
-    std::map<aiTextureType, std::string> texTypeToPath;
+        const aiTextureType type     = (aiTextureType)texType;
+        const UINT          texCount = pMaterial->GetTextureCount(type);
 
-    // compute the duration of textures loading for this model
-    auto start = std::chrono::steady_clock::now();
-
-
-    // go through available texture type and load responsible texture
-    for (size idx = 0; idx < std::ssize(texTypesToLoad); ++idx)
-    {
-        aiTextureType type = texTypesToLoad[idx];
+        // height maps are used as normal maps
+        TexSource& src = outSources[(type == aiTextureType_HEIGHT) ? aiTextureType_NORMALS : type];
 
         // go through each texture of this aiTextureType for this aiMaterial
-        for (UINT i = 0; i < texCounts[idx]; i++)
+        for (UINT i = 0; i < texCount; i++)
         {
             // get path to the texture file
             aiString path;
@@ -431,92 +395,124 @@ void ModelImporter::LoadMaterialTextures(
                 pMaterial,
                 i, type);
 
-            type = (type == aiTextureType_HEIGHT) ? aiTextureType_NORMALS : type;
-
             switch (storeType)
             {
-                // load a tex which is located on the disk
-            case TexStoreType::Disk:
-            {
-                // make and store a pair [texture_type => texture_filepath]
-                 // get path to the directory which contains a model's data file
-                char texturePath[256]{ '\0' };
-                FileSys::GetParentPath(filePath, g_String);
-                sprintf(texturePath, "%s%s", g_String, path.C_Str());
-
-                texTypeToPath.insert_or_assign(type, texturePath);
-
-                break;
+                // a tex which is located on the disk (relatively to the model's file)
+                case TexStoreType::Disk:
+                {
+                    snprintf(src.name, sizeof(src.name), "%s%s", parentDirPath, path.C_Str());
+                    src.storeType = storeType;
+                    src.pAiTex    = nullptr;
+                    break;
+                }
+
+                // an embedded compressed texture
+                case TexStoreType::EmbeddedCompressed:
+                {
+                    FileSys::GetFileName(path.C_Str(), src.name);
+                    src.storeType = storeType;
+                    src.pAiTex    = pScene->GetEmbeddedTexture(path.C_Str());
+                    break;
+                }
+
+                // an embedded indexed compressed texture
+                case TexStoreType::EmbeddedIndexCompressed:
+                {
+                    FileSys::GetFileName(path.C_Str(), src.name);
+                    src.storeType = storeType;
+                    src.pAiTex    = pScene->mTextures[GetIndexOfEmbeddedCompressedTexture(&path)];
+                    break;
+                }
+
+                default:
+                    break;
             }
+        }
+    }
+}
 
-            // load an embedded compressed texture
-            case TexStoreType::EmbeddedCompressed:
-            {
-                const aiTexture* pAiTexture = pScene->GetEmbeddedTexture(path.C_Str());
-                constexpr bool   mipMapped = true;
-                char             textureName[64]{ '\0' };
-
-                FileSys::GetFileName(path.C_Str(), textureName);
+///////////////////////////////////////////////////////////
 
-                Texture texture(
-                    pDevice,
-                    textureName,
-                    (uint8_t*)(pAiTexture->pcData),         // data of texture
-                    pAiTexture->mWidth,                     
-                    pAiTexture->mHeight,
-                    mipMapped);
+void ModelImporter::LoadMaterialTextures(
+    ID3D11Device* pDevice,
+    std::vector<MeshMaterialData>& materials)
+{
+    //
+    // load all the textures of the model's materials and store their IDs:
+    //  1. textures from disk are added as placeholders right away: they are
+    //     decoded by jobs and swapped in by the TextureMgr later (or their mips
+    //     are loaded by the streamer if texture streaming is enabled);
+    //  2. embedded textures are created by the caller thread
+    //     (managers aren't thread-safe)
+    //
 
-                // add into the tex mgr a new texture
-                const TexID id = g_TextureMgr.Add(textureName, std::move(texture));
+    auto loadingStart = std::chrono::steady_clock::now();
+    const bool isStreamed = g_TextureMgr.IsStreamingEnabled();
 
+    for (MeshMaterialData& data : materials)
+    {
+        for (int type = 0; type < NUM_TEXTURE_TYPES; ++type)
+        {
+            const TexSource& src = data.textures[type];
 
-                texIDs[type] = id;
+            if (src.storeType != TexStoreType::Disk)
+                continue;
 
-                break;
-            }
+            const bool isNew = (g_TextureMgr.GetIDByName(src.name) == INVALID_TEXTURE_ID);
 
-            // load an embedded indexed compressed texture
-            case TexStoreType::EmbeddedIndexCompressed:
-            {
-                constexpr bool  mipMapped = true;
-                const UINT      index = GetIndexOfEmbeddedCompressedTexture(&path);
-                char            textureName[64]{ '\0' };
+            data.material.textureIDs[type] = (isStreamed) ?
+                g_TextureMgr.LoadFromFileStreamed(src.name) :
+                g_TextureMgr.LoadAsync(src.name);
 
-                FileSys::GetFileName(path.C_Str(), textureName);
-                aiTexture* pAiTex = pScene->mTextures[index];
+            s_Stats_.numTexFromDisk += (isNew && data.material.textureIDs[type] != INVALID_TEXTURE_ID);
+        }
+    }
 
-                Texture texture(
-                    pDevice,
-                    textureName,
-                    (uint8_t*)(pAiTex->pcData),
-                    pAiTex->mWidth,
-                    pAiTex->mHeight,
-                    mipMapped);
+    s_Stats_.texLoading += GetElapsedMs(loadingStart);
 
-                // add into the tex mgr a new texture
-                const TexID id = g_TextureMgr.Add(textureName, std::move(texture));            
+    // --------------------------------------
 
-                texIDs[type] = id;
+    auto registrationStart = std::chrono::steady_clock::now();
 
-                break;
+    for (MeshMaterialData& data : materials)
+    {
+        for (int type = 0; type < NUM_TEXTURE_TYPES; ++type)
+        {
+            const TexSource& src = data.textures[type];
+            TexID&           id  = data.material.textureIDs[type];
 
-            } // end switch/case
+            switch (src.storeType)
+            {
+                case TexStoreType::EmbeddedCompressed:
+                case TexStoreType::EmbeddedIndexCompressed:
+                {
+                    id = g_TextureMgr.GetIDByName(src.name);
+
+                    if (id != INVALID_TEXTURE_ID)
+                        break;
+
+                    // add into the tex mgr a new texture
+                    constexpr bool mipMapped = true;
+
+                    Texture texture(
+                        pDevice,
+                        src.name,
+                        (uint8_t*)(src.pAiTex->pcData),         // data of texture
+                        src.pAiTex->mWidth,
+                        src.pAiTex->mHeight,
+                        mipMapped);
+
+                    id = g_TextureMgr.Add(src.name, std::move(texture));
+                    break;
+                }
+
+                default:
+                    break;
             }
         }
     }
 
-
-    // load textures from files
-    for (const auto& [type, path] : texTypeToPath)
-    {
-        texIDs[type] = g_TextureMgr.LoadFromFile(path.c_str());
-    }
-
-    // compute the duration of textures loading for this model
-    auto end = std::chrono::steady_clock::now();
-    std::chrono::duration<double, std::milli> elapsed = end - start;
-
-    ModelImporter::s_TexLoadingDuration_ += elapsed.count();
+    s_Stats_.registration += GetElapsedMs(registrationStart);
 }
 
 ///////////////////////////////////////////////////////////
@@ -587,42 +583,34 @@ void ComputeMeshAABB(
     aiVector3D* verticesPos,
     const int numVertices)
 {
-    // compute the bounding box of the mesh
-    XMVECTOR vMin{ FLT_MAX, FLT_MAX, FLT_MAX };
-    XMVECTOR vMax{ FLT_MIN, FLT_MIN, FLT_MIN };
-
-    for (int i = 0; i < numVertices; ++i)
-    {
-        XMVECTOR P{ verticesPos[i].x, verticesPos[i].y, verticesPos[i].z };
-        vMin = XMVectorMin(vMin, P);
-        vMax = XMVectorMax(vMax, P);
-    }
-
-    // convert min/max representation to center and extents representation
-    XMStoreFloat3(&aabb.Center,  0.5f * (vMin + vMax));
-    XMStoreFloat3(&aabb.Extents, 0.5f * (vMax - vMin));
+    // compute the bounding box of the mesh (aiVector3D has the same layout as XMFLOAT3)
+    static_assert(sizeof(aiVector3D) == sizeof(XMFLOAT3));
+
+    MeshKernels::ComputeAABB(
+        (const XMFLOAT3*)verticesPos,
+        sizeof(aiVector3D),
+        numVertices,
+        aabb);
 }
 
 ///////////////////////////////////////////////////////////
 
-void ModelImporter::GetVerticesIndicesOfMesh(
-    const aiMesh* pMesh,
+void ModelImporter::ProcessMeshGeometry(
     BasicModel& model,
-    MeshGeometry::Subset& currSubset,
+    const MeshWorkItem& item,
     const int subsetIdx)
 {
-    // fill in the arrays with vertices/indices/subset data of the input mesh
+    // fill in the arrays with vertices/indices/subset data of the input mesh;
+    // NOTE: it is executed by worker threads (each mesh has its own ranges)
 
-    auto start = std::chrono::steady_clock::now();
+    const aiMesh*         pMesh      = item.pMesh;
+    MeshGeometry::Subset& currSubset = model.meshes_.subsets_[subsetIdx];
 
-    // compute the number of previous vertices/indices so we will know a starting
-    // position to continue writing data
-    for (int i = 0; i < subsetIdx; ++i)
-    {
-        const MeshGeometry::Subset& subset = model.meshes_.subsets_[i];
-        currSubset.vertexStart += subset.vertexCount;
-        currSubset.indexStart += subset.indexCount;
-    }
+    model.meshes_.SetSubsetName(subsetIdx, pMesh->mName.C_Str());
+
+    // start positions were computed when the node tree was flattened
+    currSubset.vertexStart = item.vertexStart;
+    currSubset.indexStart  = item.indexStart;
 
     // define how many vertices/indices this subset (mesh) has
     currSubset.vertexCount = pMesh->mNumVertices;
@@ -644,13 +632,412 @@ void ModelImporter::GetVerticesIndicesOfMesh(
         model.subsetsAABB_[subsetIdx],
         pMesh->mVertices,
         currSubset.vertexCount);
+}
+
+///////////////////////////////////////////////////////////
+
+//---------------------------------------------------------
+// Desc:  assimp matrices are for column vectors: transpose them into
+//        the row vector convention of DirectXMath
+//---------------------------------------------------------
+static XMMATRIX ToXMMatrix(const aiMatrix4x4& m)
+{
+    return XMMatrixTranspose(XMMATRIX(
+        m.a1, m.a2, m.a3, m.a4,
+        m.b1, m.b2, m.b3, m.b4,
+        m.c1, m.c2, m.c3, m.c4,
+        m.d1, m.d2, m.d3, m.d4));
+}
+
+//---------------------------------------------------------
+// Desc:  get an idx of the node in the list (or -1)
+//---------------------------------------------------------
+static int FindNodeIdx(const cvector<const aiNode*>& nodes, const aiNode* pNode)
+{
+    for (int i = 0; i < (int)nodes.size(); ++i)
+    {
+        if (nodes[i] == pNode)
+            return i;
+    }
+
+    return -1;
+}
+
+//---------------------------------------------------------
+// Desc:  put into the skeleton all the marked nodes of the subtree;
+//        a parent always goes before its children
+//---------------------------------------------------------
+static void AddBoneNodes(
+    const aiNode* pNode,
+    const int parentIdx,
+    const cvector<const aiNode*>& markedNodes,
+    const cvector<XMFLOAT4X4>& markedOffsets,
+    SkinnedData& skinned,
+    cvector<const aiNode*>& outBoneNodes)
+{
+    int       idx  = parentIdx;
+    const int mark = FindNodeIdx(markedNodes, pNode);
+
+    if (mark != -1)
+    {
+        Bone bone;
+        strncpy(bone.name, pNode->mName.C_Str(), ANIM_NAME_LENGTH - 1);
+        bone.parentIdx = parentIdx;
+        bone.offset    = markedOffsets[mark];
+
+        idx = (int)skinned.bones.size();
+        skinned.bones.push_back(bone);
+        outBoneNodes.push_back(pNode);
+    }
+
+    for (UINT i = 0; i < pNode->mNumChildren; ++i)
+        AddBoneNodes(pNode->mChildren[i], idx, markedNodes, markedOffsets, skinned, outBoneNodes);
+}
+
+///////////////////////////////////////////////////////////
+
+bool ModelImporter::BuildSkeleton(
+    const aiScene* pScene,
+    const cvector<MeshWorkItem>& items,
+    BasicModel& model,
+    cvector<const aiNode*>& outBoneNodes)
+{
+    // mark nodes of bones and all their ancestors (so global transforms can be
+    // computed by the skeleton only); nodes without weights get an identity offset
+
+    cvector<const aiNode*> markedNodes;
+    cvector<XMFLOAT4X4>    markedOffsets;
+    XMFLOAT4X4             identity;
+
+    XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+    for (const MeshWorkItem& item : items)
+    {
+        const aiMesh* pMesh = item.pMesh;
+
+        for (UINT b = 0; b < pMesh->mNumBones; ++b)
+        {
+            const aiBone* pBone = pMesh->mBones[b];
+            const aiNode* pNode = pScene->mRootNode->FindNode(pBone->mName);
+
+            if (!pNode)
+                continue;
+
+            int mark = FindNodeIdx(markedNodes, pNode);
+
+            if (mark == -1)
+            {
+                mark = (int)markedNodes.size();
+                markedNodes.push_back(pNode);
+                markedOffsets.push_back(identity);
+            }
+
+            XMStoreFloat4x4(&markedOffsets[mark], ToXMMatrix(pBone->mOffsetMatrix));
+
+            for (const aiNode* pParent = pNode->mParent; pParent; pParent = pParent->mParent)
+            {
+                if (FindNodeIdx(markedNodes, pParent) != -1)
+                    break;
+
+                markedNodes.push_back(pParent);
+                markedOffsets.push_back(identity);
+            }
+        }
+    }
+
+    if (markedNodes.empty())
+        return false;
+
+    if (markedNodes.size() > MAX_NUM_BONES)
+    {
+        sprintf(g_String, "model %s has too many bones: %d (max %d); it is imported as a static one",
+                model.name_, (int)markedNodes.size(), MAX_NUM_BONES);
+        LogErr(g_String);
+        return false;
+    }
+
+    SkinnedData& skinned = model.skinned_;
+
+    skinned.Clear();
+    skinned.bones.reserve(markedNodes.size());
+    outBoneNodes.reserve(markedNodes.size());
+
+    AddBoneNodes(pScene->mRootNode, -1, markedNodes, markedOffsets, skinned, outBoneNodes);
+
+    // vertices without weights stay in the bind pose by the root
+    // (the palette of the root == identity)
+    VertexSkin rootSkin;
+    rootSkin.weights[0] = 255;
+
+    skinned.skin.resize(model.numVertices_, rootSkin);
+    model.numBones_ = (uint16)skinned.bones.size();
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelImporter::ProcessMeshSkin(
+    BasicModel& model,
+    const MeshWorkItem& item,
+    const cvector<const aiNode*>& boneNodes)
+{
+    // keep the 4 biggest weights of each vertex and quantize them into unorm8
+    // so they sum up to 255 exactly;
+    // NOTE: it is executed by worker threads (each mesh has its own range)
+
+    const aiMesh* pMesh = item.pMesh;
+    const aiNode* pRoot = boneNodes[0];           // ancestors are marked up to the root of the scene
+
+    if (pMesh->mNumBones == 0)
+        return;
+
+    const UINT     numVertices = pMesh->mNumVertices;
+    cvector<int>   idxs   (numVertices * MAX_BONE_INFLUENCES, 0);
+    cvector<float> weights(numVertices * MAX_BONE_INFLUENCES, 0.0f);
+
+    for (UINT b = 0; b < pMesh->mNumBones; ++b)
+    {
+        const aiBone* pBone   = pMesh->mBones[b];
+        const int     boneIdx = FindNodeIdx(boneNodes, pRoot->FindNode(pBone->mName));
+
+        if (boneIdx == -1)
+            continue;
+
+        for (UINT w = 0; w < pBone->mNumWeights; ++w)
+        {
+            const aiVertexWeight& vw = pBone->mWeights[w];
+
+            if (vw.mVertexId >= numVertices)
+                continue;
+
+            // replace the smallest influence of the vertex
+            int*   vIdxs    = idxs.data()    + vw.mVertexId * MAX_BONE_INFLUENCES;
+            float* vWeights = weights.data() + vw.mVertexId * MAX_BONE_INFLUENCES;
+            int    minSlot  = 0;
+
+            for (int s = 1; s < MAX_BONE_INFLUENCES; ++s)
+            {
+                if (vWeights[s] < vWeights[minSlot])
+                    minSlot = s;
+            }
+
+            if (vw.mWeight > vWeights[minSlot])
+            {
+                vIdxs[minSlot]    = boneIdx;
+                vWeights[minSlot] = vw.mWeight;
+            }
+        }
+    }
+
+    VertexSkin* skin = model.skinned_.skin.data() + item.vertexStart;
+
+    for (UINT v = 0; v < numVertices; ++v)
+    {
+        const int*   vIdxs    = idxs.data()    + v * MAX_BONE_INFLUENCES;
+        const float* vWeights = weights.data() + v * MAX_BONE_INFLUENCES;
+        float        sum      = 0;
+        int          maxSlot  = 0;
+
+        for (int s = 0; s < MAX_BONE_INFLUENCES; ++s)
+        {
+            sum += vWeights[s];
+            maxSlot = (vWeights[s] > vWeights[maxSlot]) ? s : maxSlot;
+        }
+
+        // no weights: keep the root
+        if (sum <= 0.0f)
+            continue;
+
+        int total = 0;
+
+        for (int s = 0; s < MAX_BONE_INFLUENCES; ++s)
+        {
+            const int q = (int)(vWeights[s] / sum * 255.0f + 0.5f);
+            skin[v].boneIdxs[s] = (uint8)vIdxs[s];
+            skin[v].weights[s]  = (uint8)q;
+            total += q;
+        }
+
+        // the rounding error goes to the biggest influence
+        skin[v].weights[maxSlot] = (uint8)(skin[v].weights[maxSlot] + (255 - total));
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+//---------------------------------------------------------
+// Desc:  find a key pair around the tick (keys are sorted by time)
+// Ret:   idx of the first key; outFactor - lerp factor to the next one
+//---------------------------------------------------------
+template <typename TKey>
+static UINT FindKeys(const TKey* keys, const UINT numKeys, const double tick, float& outFactor)
+{
+    outFactor = 0.0f;
+
+    if ((numKeys < 2) || (tick <= keys[0].mTime))
+        return 0;
+
+    for (UINT i = 0; i < numKeys - 1; ++i)
+    {
+        if (tick < keys[i + 1].mTime)
+        {
+            const double dt = keys[i + 1].mTime - keys[i].mTime;
+            outFactor = (dt > 0) ? (float)((tick - keys[i].mTime) / dt) : 0.0f;
+            return i;
+        }
+    }
+
+    return numKeys - 1;
+}
+
+//---------------------------------------------------------
+// Desc:  a local transform of the animated node at the tick (S * R * T)
+//---------------------------------------------------------
+static XMMATRIX SampleNodeAnim(const aiNodeAnim* pAnim, const double tick)
+{
+    XMVECTOR S = XMVectorSplatOne();
+    XMVECTOR R = XMQuaternionIdentity();
+    XMVECTOR T = XMVectorZero();
+    float    t = 0;
+
+    if (pAnim->mNumScalingKeys > 0)
+    {
+        const UINT        i  = FindKeys(pAnim->mScalingKeys, pAnim->mNumScalingKeys, tick, t);
+        const UINT        j  = (i + 1 < pAnim->mNumScalingKeys) ? i + 1 : i;
+        const aiVector3D& s0 = pAnim->mScalingKeys[i].mValue;
+        const aiVector3D& s1 = pAnim->mScalingKeys[j].mValue;
+
+        S = XMVectorLerp(XMVectorSet(s0.x, s0.y, s0.z, 0), XMVectorSet(s1.x, s1.y, s1.z, 0), t);
+    }
+
+    if (pAnim->mNumRotationKeys > 0)
+    {
+        const UINT          i  = FindKeys(pAnim->mRotationKeys, pAnim->mNumRotationKeys, tick, t);
+        const UINT          j  = (i + 1 < pAnim->mNumRotationKeys) ? i + 1 : i;
+        const aiQuaternion& q0 = pAnim->mRotationKeys[i].mValue;
+        const aiQuaternion& q1 = pAnim->mRotationKeys[j].mValue;
 
+        R = XMQuaternionSlerp(XMVectorSet(q0.x, q0.y, q0.z, q0.w), XMVectorSet(q1.x, q1.y, q1.z, q1.w), t);
+    }
+
+    if (pAnim->mNumPositionKeys > 0)
+    {
+        const UINT        i  = FindKeys(pAnim->mPositionKeys, pAnim->mNumPositionKeys, tick, t);
+        const UINT        j  = (i + 1 < pAnim->mNumPositionKeys) ? i + 1 : i;
+        const aiVector3D& p0 = pAnim->mPositionKeys[i].mValue;
+        const aiVector3D& p1 = pAnim->mPositionKeys[j].mValue;
+
+        T = XMVectorLerp(XMVectorSet(p0.x, p0.y, p0.z, 1), XMVectorSet(p1.x, p1.y, p1.z, 1), t);
+    }
+
+    return XMMatrixScalingFromVector(S) * XMMatrixRotationQuaternion(R) * XMMatrixTranslationFromVector(T);
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelImporter::BakeAnimations(
+    const aiScene* pScene,
+    const cvector<const aiNode*>& boneNodes,
+    BasicModel& model)
+{
+    // for each frame: global = local * parentGlobal (bones go parents first),
+    // palette = offset * global * inverse(bind global of the root) so the
+    // runtime only blends 4 matrices per vertex
+
+    SkinnedData&   skinned  = model.skinned_;
+    const uint32   numBones = skinned.GetNumBones();
+    const XMMATRIX invRoot  = XMMatrixInverse(nullptr, ToXMMatrix(pScene->mRootNode->mTransformation));
+
+    // define frames of the clips
+    uint32 numFrames = 0;
+
+    for (UINT a = 0; a < pScene->mNumAnimations; ++a)
+    {
+        const aiAnimation* pAnim       = pScene->mAnimations[a];
+        const double       ticksPerSec = (pAnim->mTicksPerSecond > 0) ? pAnim->mTicksPerSecond : 25.0;
+        const float        duration    = (float)(pAnim->mDuration / ticksPerSec);
+
+        AnimClip clip;
+        clip.firstFrame = numFrames;
+        clip.numFrames  = (uint32)ceilf(duration * ANIM_BAKE_FPS) + 1;
+        clip.fps        = ANIM_BAKE_FPS;
+        clip.duration   = duration;
+
+        if (pAnim->mName.length > 0)
+            strncpy(clip.name, pAnim->mName.C_Str(), ANIM_NAME_LENGTH - 1);
+        else
+            snprintf(clip.name, ANIM_NAME_LENGTH, "clip_%u", a);
+
+        if (numFrames + clip.numFrames > MAX_NUM_ANIM_FRAMES)
+        {
+            sprintf(g_String, "model %s: too many frames of animations (max %d); clip %s and next ones are skipped",
+                    model.name_, MAX_NUM_ANIM_FRAMES, clip.name);
+            LogErr(g_String);
+            break;
+        }
+
+        numFrames += clip.numFrames;
+        skinned.clips.push_back(clip);
+    }
+
+    skinned.palettes.resize(numFrames * numBones);
+
+    // bake frames of each clip in parallel (frames don't depend on each other)
+    for (index c = 0; c < skinned.clips.size(); ++c)
+    {
+        const AnimClip&    clip        = skinned.clips[c];
+        const aiAnimation* pAnim       = pScene->mAnimations[c];
+        const double       ticksPerSec = (pAnim->mTicksPerSecond > 0) ? pAnim->mTicksPerSecond : 25.0;
+
+        // a channel of each bone (nullptr: the node isn't animated)
+        cvector<const aiNodeAnim*> channels(numBones, nullptr);
+
+        for (UINT ch = 0; ch < pAnim->mNumChannels; ++ch)
+        {
+            const aiNodeAnim* pChannel = pAnim->mChannels[ch];
 
-    // compute the duration of the vertices/indices loading process for the whole model
-    auto end = std::chrono::steady_clock::now();
-    std::chrono::duration<double, std::milli> elapsed = end - start;
+            for (uint32 b = 0; b < numBones; ++b)
+            {
+                if (boneNodes[b]->mName == pChannel->mNodeName)
+                {
+                    channels[b] = pChannel;
+                    break;
+                }
+            }
+        }
+
+        g_JobSystem.ParallelFor(clip.numFrames, 4, [&](const index startIdx, const index endIdx)
+        {
+            XMMATRIX globals[MAX_NUM_BONES];
+
+            for (index f = startIdx; f < endIdx; ++f)
+            {
+                const double tick   = std::min((double)f / clip.fps * ticksPerSec, pAnim->mDuration);
+                BoneMatrix*  pFrame = skinned.palettes.data() + (clip.firstFrame + f) * numBones;
+
+                for (uint32 b = 0; b < numBones; ++b)
+                {
+                    const Bone&    bone  = skinned.bones[b];
+                    const XMMATRIX local = (channels[b]) ?
+                        SampleNodeAnim(channels[b], tick) :
+                        ToXMMatrix(boneNodes[b]->mTransformation);
+
+                    globals[b] = (bone.parentIdx >= 0) ? local * globals[bone.parentIdx] : local;
+
+                    // store 3 rows of the transposed matrix (translation goes into w)
+                    XMFLOAT4X4 palette;
+                    XMStoreFloat4x4(&palette, XMMatrixTranspose(XMLoadFloat4x4(&bone.offset) * globals[b] * invRoot));
+
+                    pFrame[b].rows[0] = { palette._11, palette._12, palette._13, palette._14 };
+                    pFrame[b].rows[1] = { palette._21, palette._22, palette._23, palette._24 };
+                    pFrame[b].rows[2] = { palette._31, palette._32, palette._33, palette._34 };
+                }
+            }
+        });
+    }
 
-    ModelImporter::s_VerticesLoading_ += elapsed.count();
+    model.numAnimClips_ = (uint16)skinned.clips.size();
 }
 
 } // namespace Core
@@ -8,6 +8,8 @@
 #pragma once
 
 #include "../Model/BasicModel.h"
+#include "../Texture/textureclass.h"
+#include <cvector.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
@@ -21,61 +23,130 @@
 namespace Core
 {
 
+// settings of the import pipeline (they are a part of the key of
+// derived data so a changed setting invalidates only assets imported with it)
+struct ModelImportSettings
+{
+	uint32 postProcessFlags =            // assimp post-processing steps
+		aiProcess_FixInfacingNormals |
+		aiProcess_GenNormals |
+		aiProcess_CalcTangentSpace |
+		aiProcess_ImproveCacheLocality |
+		aiProcess_Triangulate |
+		aiProcess_LimitBoneWeights |         // up to 4 bones per vertex (MAX_BONE_INFLUENCES)
+		aiProcess_ConvertToLeftHanded;
+
+	bool   optimizeMesh  = true;         // reorder by MeshOptimizer
+	int    numLods       = MAX_NUM_MESH_LODS;
+	bool   buildMeshlets = true;         // split big subsets into clusters for GPU culling (MeshletBuilder)
+};
+
+///////////////////////////////////////////////////////////
+
+// per-stage stats of the import pipeline (in milliseconds of wall time);
+// they are accumulated by all the imports until Reset()
+struct ModelImportStats
+{
+	double total           = 0;          // the whole LoadFromFile
+	double sceneLoading    = 0;          // assimp ReadFile + post-processing
+	double flattening      = 0;          // node tree => list of meshes
+	double geometry        = 0;          // vertices/indices/AABB of meshes (in parallel)
+	double materials       = 0;          // colors and texture sources (in parallel)
+	double texLoading      = 0;          // textures from disk (queued for async loading)
+	double registration    = 0;          // embedded textures, adding into managers
+	double animations      = 0;          // skeleton, skin weights, baking of clips
+
+	uint32 numModels       = 0;
+	uint32 numMeshes       = 0;
+	uint32 numTexFromDisk  = 0;
+
+	inline void Reset() { *this = ModelImportStats(); }
+};
+
+///////////////////////////////////////////////////////////
+
 class ModelImporter final
 {
 public:
 	ModelImporter() {};
 	
-	bool LoadFromFile(ID3D11Device* pDevice, BasicModel& model, const char* filePath);
+	bool LoadFromFile(
+		ID3D11Device* pDevice,
+		BasicModel& model,
+		const char* filePath,
+		const ModelImportSettings& settings = ModelImportSettings());
 
 
-    static double s_ImportDuration_;
-    static double s_TexLoadingDuration_;
-    static double s_VerticesLoading_;
-    static double s_NodesLoading_;
-    static double s_SceneLoading_;
+	// is updated by the thread which calls LoadFromFile (the main one)
+	static ModelImportStats s_Stats_;
 
 private:
-	void ComputeNumOfData(
-		BasicModel& model,
+	// a mesh of the flattened node tree (its idx in the list == subset idx)
+	struct MeshWorkItem
+	{
+		const aiMesh* pMesh       = nullptr;
+		uint32        vertexStart = 0;
+		uint32        indexStart  = 0;
+	};
+
+	// where a texture of some type for the subset comes from
+	struct TexSource
+	{
+		TexStoreType     storeType = TexStoreType::None;
+		const aiTexture* pAiTex    = nullptr;       // for embedded textures
+		char             name[256]{ '\0' };         // a path on disk OR a name of embedded
+	};
+
+	struct MeshMaterialData
+	{
+		Material  material;
+		TexSource textures[NUM_TEXTURE_TYPES];
+	};
+
+	void FlattenNodes(
 		const aiNode* pNode,
-		const aiScene* pScene);
+		const aiScene* pScene,
+		cvector<MeshWorkItem>& outItems,
+		uint32& numVertices,
+		uint32& numIndices);
 
-	void ProcessNode(
-		ID3D11Device* pDevice,
+	void ProcessMeshGeometry(
 		BasicModel& model,
-		int& subsetIdx,
-		const aiNode* pNode, 
-		const aiScene* pScene, 
-		const DirectX::XMMATRIX& parentTrasformMatrix,
-		const char* filePath);
-
-	void ProcessMesh(
-		ID3D11Device* pDevice, 
+		const MeshWorkItem& item,
+		const int subsetIdx);
+
+	// collect bones of all the meshes (with their ancestors) in the depth-first
+	// order; outBoneNodes[i] is the node of the i-th bone
+	bool BuildSkeleton(
+		const aiScene* pScene,
+		const cvector<MeshWorkItem>& items,
+		BasicModel& model,
+		cvector<const aiNode*>& outBoneNodes);
+
+	void ProcessMeshSkin(
 		BasicModel& model,
-		int& subsetIdx,
-		const aiMesh* pMesh, 
-		const aiScene* pScene, 
-		const DirectX::XMMATRIX & transformMatrix,
-		const char* filePath);
+		const MeshWorkItem& item,
+		const cvector<const aiNode*>& boneNodes);
+
+	// sample each animation with ANIM_BAKE_FPS into skinning palettes
+	void BakeAnimations(
+		const aiScene* pScene,
+		const cvector<const aiNode*>& boneNodes,
+		BasicModel& model);
 
 	void LoadMaterialColorsData(
-        aiMaterial* pMaterial,
-        Material& mat);
+		const aiMaterial* pMaterial,
+		Material& mat);
 
-	void LoadMaterialTextures(
-		ID3D11Device* pDevice,
-		TexID* texIDs,
+	void GetMaterialTexSources(
 		const aiMaterial* pMaterial,
-		const MeshGeometry::Subset& subset,
 		const aiScene* pScene,
-		const char* filePath);
+		const char* parentDirPath,
+		TexSource* outSources);
 
-	void GetVerticesIndicesOfMesh(
-		const aiMesh* pMesh,
-		BasicModel& model,
-		MeshGeometry::Subset& subset,
-		const int subsetIdx);
+	void LoadMaterialTextures(
+		ID3D11Device* pDevice,
+		std::vector<MeshMaterialData>& materials);
 
 	void ExecuteModelMathCalculations(Vertex3D* vertices, const int numVertices);
 
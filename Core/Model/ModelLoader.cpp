@@ -6,6 +6,9 @@
 #include <CoreCommon/pch.h>
 #include "ModelLoader.h"
 #include "../Texture/TextureMgr.h"
+#include "../Mesh/MaterialMgr.h"
+#include "../Mesh/VertexPacked.h"
+#include <HitchRecorder.h>
 
 namespace fs = std::filesystem;
 
@@ -27,7 +30,24 @@ bool ModelLoader::Load(const char* modelFilePath, BasicModel& outModel)
     char modelPath[256]{ '\0' };
     sprintf(modelPath, "%s%s", g_RelPathAssetsDir, modelFilePath);
 
-	
+    HitchEventScope hitchEvent("model", modelFilePath);
+	materials_.clear();
+
+	// files of v2 are used in place by the mapped view
+	if (mappedFile_.Open(modelPath))
+	{
+		const DE3DHeader* pHeader = (const DE3DHeader*)mappedFile_.GetData();
+
+		if ((mappedFile_.GetSize() >= sizeof(DE3DHeader)) &&
+			(strncmp(pHeader->magic, DE3D_MAGIC, sizeof(pHeader->magic)) == 0))
+		{
+			return LoadMapped(modelPath, outModel);
+		}
+
+		// this is a v1 file
+		mappedFile_.Close();
+	}
+
 	std::ifstream fin(modelPath, std::ios::in | std::ios::binary);
     if (!fin)
     {
@@ -55,6 +75,8 @@ bool ModelLoader::Load(const char* modelFilePath, BasicModel& outModel)
 
 		ReadVertices(fin, outModel.numVertices_, outModel.vertices_);
 		ReadIndices(fin, outModel.numIndices_, outModel.indices_);
+		ReadLods(fin, outModel);
+		ReadTriangleBVH(fin, outModel);
 
 		// bind textures to the model, etc.
         const std::string modelDir = fs::path(modelPath).parent_path().string();
@@ -76,9 +98,388 @@ bool ModelLoader::Load(const char* modelFilePath, BasicModel& outModel)
 }
 
 
+///////////////////////////////////////////////////////////
+
+void ModelLoader::InitializeBuffers(ID3D11Device* pDevice, BasicModel& model)
+{
+	if (!pMappedVertices_ || !pMappedIndices_)
+	{
+		model.InitializeBuffers(pDevice);
+		return;
+	}
+
+	// vertices and indices are already in the GPU format
+	model.meshes_.InitBuffersPacked(
+		pDevice,
+		pMappedVertices_,
+		pMappedIndices_,
+		(int)model.numVertices_,
+		(int)model.numIndices_,
+		mappedIndexFormat_);
+
+	pMappedVertices_ = nullptr;
+	pMappedIndices_  = nullptr;
+	mappedFile_.Close();
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelLoader::SetupMaterials(
+	BasicModel& model,
+	const MaterialID* reuseIDs,
+	const int numReuseIDs)
+{
+	if (materials_.empty())
+		return;
+
+	MeshGeometry::Subset* subsets = model.GetSubsets();
+
+	for (int i = 0; i < model.numSubsets_; ++i)
+	{
+		const DE3DMaterial& src = materials_[i];
+		Material            mat;
+
+		strncpy(subsets[i].name, src.subsetName, SUBSET_NAME_LENGTH_LIMIT - 1);
+		strncpy(mat.name, src.name, MAX_LENGTH_MATERIAL_NAME - 1);
+
+		mat.ambient    = src.ambient;
+		mat.diffuse    = src.diffuse;
+		mat.specular   = src.specular;
+		mat.reflect    = src.reflect;
+		mat.properties = src.properties;
+
+		for (int type = 0; type < NUM_TEXTURE_TYPES; ++type)
+		{
+			if (src.texPaths[type][0] != '\0')
+				mat.textureIDs[type] = g_TextureMgr.LoadFromFileStreamed(src.texPaths[type]);
+		}
+
+		if (reuseIDs && (i < numReuseIDs))
+		{
+			g_MaterialMgr.ReplaceMaterial(reuseIDs[i], std::move(mat));
+			subsets[i].materialID = reuseIDs[i];
+		}
+		else
+		{
+			subsets[i].materialID = g_MaterialMgr.AddMaterial(std::move(mat));
+		}
+	}
+
+	materials_.clear();
+}
+
+
 // =================================================================================
 // Private API
 // =================================================================================
+bool ModelLoader::LoadMapped(const char* modelPath, BasicModel& model)
+{
+	// fill in the model by sections of the mapped v2 file; the CPU copies
+	// (for picking, AABBs, etc.) are decoded from the view while vertices and
+	// indices for the GPU stay in the mapping until InitializeBuffers()
+
+	const uint8*      pData    = mappedFile_.GetData();
+	const DE3DHeader& header   = *(const DE3DHeader*)pData;
+	const uint64      tableEnd = sizeof(DE3DHeader) + (uint64)sizeof(DE3DSection) * header.numSections;
+
+	pMappedVertices_ = nullptr;
+	pMappedIndices_  = nullptr;
+
+	if ((header.version != DE3D_VERSION)            ||
+		(header.numSections > NUM_DE3D_SECTIONS)    ||
+		(tableEnd > mappedFile_.GetSize())          ||
+		(header.numVertices == 0)                   ||
+		(header.numIndices == 0)                    ||
+		(header.numSubsets == 0)                    ||
+		(header.numLods < 1)                        ||
+		(header.numLods > MAX_NUM_MESH_LODS)        ||
+		((header.indexSize != sizeof(uint16)) && (header.indexSize != sizeof(UINT))))
+	{
+		sprintf(g_String, "invalid header of .de3d file: %s", modelPath);
+		LogErr(g_String);
+		mappedFile_.Close();
+		return false;
+	}
+
+	const DE3DSection* sections    = (const DE3DSection*)(pData + sizeof(DE3DHeader));
+	const uint32       numSections = header.numSections;
+	const uint32       numSubsets  = header.numSubsets;
+
+	const uint8* pSubsets  = GetSection(sections, numSections, DE3D_SECTION_SUBSETS,      numSubsets,         sizeof(DE3DSubset));
+	const uint8* pAABBs    = GetSection(sections, numSections, DE3D_SECTION_SUBSETS_AABB, numSubsets,         sizeof(DirectX::BoundingBox));
+	const uint8* pVertices = GetSection(sections, numSections, DE3D_SECTION_VERTICES,     header.numVertices, sizeof(Vertex3DPacked));
+	const uint8* pIndices  = GetSection(sections, numSections, DE3D_SECTION_INDICES,      header.numIndices,  header.indexSize);
+
+	if (!pSubsets || !pAABBs || !pVertices || !pIndices)
+	{
+		sprintf(g_String, "there are no (or invalid) geometry sections in .de3d file: %s", modelPath);
+		LogErr(g_String);
+		mappedFile_.Close();
+		return false;
+	}
+
+	try
+	{
+		model.id_           = header.modelID;
+		model.type_         = eModelType(header.modelType);
+		model.numSubsets_   = header.numSubsets;
+		model.numVertices_  = header.numVertices;
+		model.numIndices_   = header.numIndices;
+		model.numBones_     = header.numBones;
+		model.numAnimClips_ = header.numAnimClips;
+		model.numLods_      = header.numLods;
+		model.modelAABB_    = header.modelAABB;
+
+		strncpy(model.name_, header.name, sizeof(model.name_) - 1);
+		model.name_[sizeof(model.name_) - 1] = '\0';
+
+		model.AllocateMemory(model.numVertices_, model.numIndices_, model.numSubsets_);
+
+		// subsets and their AABBs
+		const DE3DSubset*     srcSubsets = (const DE3DSubset*)pSubsets;
+		MeshGeometry::Subset* subsets    = model.GetSubsets();
+
+		for (uint32 i = 0; i < numSubsets; ++i)
+		{
+			subsets[i].id          = srcSubsets[i].id;
+			subsets[i].vertexStart = srcSubsets[i].vertexStart;
+			subsets[i].vertexCount = srcSubsets[i].vertexCount;
+			subsets[i].indexStart  = srcSubsets[i].indexStart;
+			subsets[i].indexCount  = srcSubsets[i].indexCount;
+
+			for (int lod = 0; lod < MAX_NUM_MESH_LODS - 1; ++lod)
+			{
+				subsets[i].lodIndexStart[lod] = srcSubsets[i].lodIndexStart[lod];
+				subsets[i].lodIndexCount[lod] = srcSubsets[i].lodIndexCount[lod];
+			}
+		}
+
+		memcpy(model.subsetsAABB_, pAABBs, sizeof(DirectX::BoundingBox) * numSubsets);
+
+		// CPU copies of the geometry
+		UnpackVertices((const Vertex3DPacked*)pVertices, model.vertices_, (int)header.numVertices);
+
+		if (header.indexSize == sizeof(uint16))
+		{
+			const uint16* indices16 = (const uint16*)pIndices;
+
+			for (uint32 i = 0; i < header.numIndices; ++i)
+				model.indices_[i] = indices16[i];
+		}
+		else
+		{
+			memcpy(model.indices_, pIndices, sizeof(UINT) * header.numIndices);
+		}
+
+		// materials (are created later by SetupMaterials)
+		const uint8* pMaterials = GetSection(sections, numSections, DE3D_SECTION_MATERIALS, numSubsets, sizeof(DE3DMaterial));
+
+		if (pMaterials)
+		{
+			materials_.resize(numSubsets);
+			memcpy(materials_.data(), pMaterials, sizeof(DE3DMaterial) * numSubsets);
+		}
+
+		// a cached triangle BVH (if there is no such the BVH is built after loading)
+		model.bvh_.Clear();
+
+		const DE3DSection* pNodesSection = nullptr;
+		for (uint32 i = 0; i < numSections; ++i)
+		{
+			if (sections[i].type == DE3D_SECTION_BVH_NODES)
+				pNodesSection = &sections[i];
+		}
+
+		if (pNodesSection)
+		{
+			const uint32 numNodes     = pNodesSection->count;
+			const uint32 numTriangles = (uint32)model.GetNumLod0Indices() / 3;
+
+			const uint8* pNodes   = GetSection(sections, numSections, DE3D_SECTION_BVH_NODES,     numNodes,         sizeof(TriangleBVH::Node));
+			const uint8* pTris    = GetSection(sections, numSections, DE3D_SECTION_BVH_TRIANGLES, numTriangles * 3, sizeof(UINT));
+			const uint8* pTriIdxs = GetSection(sections, numSections, DE3D_SECTION_BVH_TRI_IDXS,  numTriangles,     sizeof(uint32));
+
+			if (pNodes && pTris && pTriIdxs && (numNodes > 0))
+			{
+				TriangleBVH& bvh = model.bvh_;
+				bvh.nodes_.resize(numNodes);
+				bvh.triangles_.resize(numTriangles * 3);
+				bvh.triIdxs_.resize(numTriangles);
+
+				memcpy(bvh.nodes_.data(),     pNodes,   sizeof(TriangleBVH::Node) * numNodes);
+				memcpy(bvh.triangles_.data(), pTris,    sizeof(UINT) * numTriangles * 3);
+				memcpy(bvh.triIdxs_.data(),   pTriIdxs, sizeof(uint32) * numTriangles);
+			}
+			else
+			{
+				sprintf(g_String, "invalid triangle BVH of model: %s", model.name_);
+				LogErr(g_String);
+			}
+		}
+
+		// meshlets (ranges of subsets are restored by their subset IDs)
+		model.meshlets_.clear();
+
+		for (uint32 i = 0; i < numSections; ++i)
+		{
+			if (sections[i].type != DE3D_SECTION_MESHLETS)
+				continue;
+
+			const uint32 numMeshlets = sections[i].count;
+			const uint8* pMeshlets   = GetSection(sections, numSections, DE3D_SECTION_MESHLETS, numMeshlets, sizeof(Meshlet));
+
+			if (pMeshlets && (numMeshlets > 0))
+			{
+				model.meshlets_.resize(numMeshlets);
+				memcpy(model.meshlets_.data(), pMeshlets, sizeof(Meshlet) * numMeshlets);
+			}
+		}
+
+		// meshlets are sorted by subsets so each subset gets a contiguous range;
+		// a meshlet out of LOD 0 indices of its subset makes all of them invalid
+		bool isMeshletsValid = true;
+
+		for (uint32 i = 0, m = 0; i < numSubsets; ++i)
+		{
+			subsets[i].meshletStart = m;
+
+			for (; (m < model.meshlets_.size()) && (model.meshlets_[m].subsetID == subsets[i].id); ++m)
+			{
+				const Meshlet& meshlet = model.meshlets_[m];
+
+				isMeshletsValid &= (meshlet.indexStart >= subsets[i].indexStart);
+				isMeshletsValid &= (meshlet.indexStart + meshlet.indexCount <= subsets[i].indexStart + subsets[i].indexCount);
+			}
+
+			subsets[i].meshletCount = m - subsets[i].meshletStart;
+		}
+
+		if (!isMeshletsValid)
+		{
+			sprintf(g_String, "invalid meshlets of model: %s", model.name_);
+			LogErr(g_String);
+
+			model.meshlets_.clear();
+
+			for (uint32 i = 0; i < numSubsets; ++i)
+			{
+				subsets[i].meshletStart = 0;
+				subsets[i].meshletCount = 0;
+			}
+		}
+
+		// skeletal animation (only skinned models have these sections)
+		LoadSkinnedData(sections, numSections, header, model);
+	}
+	catch (std::bad_alloc& e)
+	{
+		LogErr(e.what());
+		LogErr("can't allocate memory for model's data");
+		model.Shutdown();
+		mappedFile_.Close();
+		return false;
+	}
+
+	pMappedVertices_   = (const Vertex3DPacked*)pVertices;
+	pMappedIndices_    = pIndices;
+	mappedIndexFormat_ = (header.indexSize == sizeof(uint16)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////
+
+const uint8* ModelLoader::GetSection(
+	const DE3DSection* sections,
+	const uint32 numSections,
+	const eDE3DSection type,
+	const uint32 count,
+	const uint64 elemSize) const
+{
+	// get a pointer to the section's data in the mapped file
+	// (or nullptr if there is no such section or it doesn't match the expected size)
+
+	for (uint32 i = 0; i < numSections; ++i)
+	{
+		const DE3DSection& section = sections[i];
+
+		if (section.type != type)
+			continue;
+
+		const bool isValid =
+			(section.count == count) &&
+			(section.size == count * elemSize) &&
+			(section.offset + section.size <= mappedFile_.GetSize());
+
+		return (isValid) ? mappedFile_.GetData() + section.offset : nullptr;
+	}
+
+	return nullptr;
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelLoader::LoadSkinnedData(
+	const DE3DSection* sections,
+	const uint32 numSections,
+	const DE3DHeader& header,
+	BasicModel& model)
+{
+	SkinnedData& skinned = model.skinned_;
+	skinned.Clear();
+
+	if (header.numBones == 0)
+		return;
+
+	const uint32 numBones = header.numBones;
+	const uint32 numClips = header.numAnimClips;
+
+	const uint8* pSkin  = GetSection(sections, numSections, DE3D_SECTION_SKIN,       header.numVertices, sizeof(VertexSkin));
+	const uint8* pBones = GetSection(sections, numSections, DE3D_SECTION_BONES,      numBones,           sizeof(Bone));
+	const uint8* pClips = GetSection(sections, numSections, DE3D_SECTION_ANIM_CLIPS, numClips,           sizeof(AnimClip));
+
+	if (!pSkin || !pBones || (numBones > MAX_NUM_BONES))
+	{
+		sprintf(g_String, "invalid skin of model: %s (it is loaded as a static one)", model.name_);
+		LogErr(g_String);
+		model.numBones_     = 0;
+		model.numAnimClips_ = 0;
+		return;
+	}
+
+	skinned.skin.resize_uninitialized(header.numVertices);
+	skinned.bones.resize_uninitialized(numBones);
+	memcpy(skinned.skin.data(),  pSkin,  sizeof(VertexSkin) * header.numVertices);
+	memcpy(skinned.bones.data(), pBones, sizeof(Bone) * numBones);
+
+	// clips go one after another so their frames are counted by the last one
+	uint32 numFrames = 0;
+
+	if (pClips && (numClips > 0))
+	{
+		const AnimClip& last = ((const AnimClip*)pClips)[numClips - 1];
+		numFrames = last.firstFrame + last.numFrames;
+	}
+
+	const uint8* pPalettes = (numFrames > 0) ?
+		GetSection(sections, numSections, DE3D_SECTION_ANIM_PALETTES, numFrames * numBones, sizeof(BoneMatrix)) :
+		nullptr;
+
+	if (pPalettes && (numFrames <= MAX_NUM_ANIM_FRAMES))
+	{
+		skinned.clips.resize_uninitialized(numClips);
+		skinned.palettes.resize_uninitialized(numFrames * numBones);
+		memcpy(skinned.clips.data(),    pClips,    sizeof(AnimClip) * numClips);
+		memcpy(skinned.palettes.data(), pPalettes, sizeof(BoneMatrix) * numFrames * numBones);
+	}
+	else
+	{
+		model.numAnimClips_ = 0;
+	}
+}
+
+///////////////////////////////////////////////////////////
+
 void ModelLoader::ReadHeader(std::ifstream& fin, BasicModel& model)
 {
 	std::string ignore;
@@ -175,7 +576,7 @@ void ModelLoader::SetupSubsets(
             sprintf(g_String, "%s%s%s", modelDirPath, "/textures/", params.texPaths[j].c_str());
 
             // ...and load it
-			const TexID texID = g_TextureMgr.LoadFromFile(g_String);
+			const TexID texID = g_TextureMgr.LoadFromFileStreamed(g_String);
 		}
 	}
 }
@@ -237,32 +638,128 @@ void ModelLoader::ReadVertices(
 	int numVertices,
 	Vertex3D* vertices)
 {
-	std::string ignore;
+	std::string header;
 
-	// vertices header text
-	fin >> ignore;
+	// vertices header text (defines if vertices are packed)
+	fin >> header;
 	fin.get();
 
 	// read in data of each vertex
-	fin.read((char*)vertices, sizeof(Vertex3D) * numVertices);
+	if (header.find("PackedVertices") != std::string::npos)
+	{
+		cvector<Vertex3DPacked> packedVertices;
+		packedVertices.resize_uninitialized(numVertices);
+
+		fin.read((char*)packedVertices.data(), sizeof(Vertex3DPacked) * numVertices);
+		UnpackVertices(packedVertices.data(), vertices, numVertices);
+	}
+	else
+	{
+		fin.read((char*)vertices, sizeof(Vertex3D) * numVertices);
+	}
 }
 
 ///////////////////////////////////////////////////////////
 
 void ModelLoader::ReadIndices(
 	std::ifstream& fin,
-	int numTriangles,
+	int numIndices,
 	UINT* indices)
 {
-	int faceIdx = 0;
 	std::string ignore;
 
 	// triangles header text
 	fin >> ignore;
 	fin.get();
 
-	// read in indices data of each triangle face
-	fin.read((char*)indices, sizeof(UINT) * numTriangles * 3);
+	// read in indices data of each triangle face (and indices of LODs if there are any)
+	fin.read((char*)indices, sizeof(UINT) * numIndices);
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelLoader::ReadLods(std::ifstream& fin, BasicModel& model)
+{
+	// read in index ranges of levels of detail of each subset;
+	// NOTE: files which were exported before LODs don't have this section
+
+	std::string ignore;
+	int numLods = 1;
+
+	model.numLods_ = 1;
+
+	// LODs header text
+	if (!(fin >> ignore))
+		return;
+
+	fin >> ignore >> numLods;
+
+	if ((numLods < 1) || (numLods > MAX_NUM_MESH_LODS))
+	{
+		sprintf(g_String, "invalid number of LODs (%d) of model: %s", numLods, model.name_);
+		LogErr(g_String);
+		return;
+	}
+
+	MeshGeometry::Subset* subsets = model.GetSubsets();
+
+	for (int i = 0; i < model.numSubsets_; ++i)
+	{
+		fin >> ignore >> ignore;                  // subset ID
+
+		for (int lod = 1; lod < numLods; ++lod)
+		{
+			fin >> ignore >> subsets[i].lodIndexStart[lod - 1];
+			fin >> ignore >> subsets[i].lodIndexCount[lod - 1];
+		}
+	}
+
+	model.numLods_ = (uint8_t)numLods;
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelLoader::ReadTriangleBVH(std::ifstream& fin, BasicModel& model)
+{
+	// read in a cached triangle BVH of the model;
+	// NOTE: files which were exported before BVHs don't have this section
+	//       (if so the BVH stays empty and is built after loading)
+
+	std::string ignore;
+	int numNodes     = 0;
+	int numTriangles = 0;
+
+	model.bvh_.Clear();
+
+	// BVH header text
+	if (!fin || !(fin >> ignore))
+		return;
+
+	fin >> ignore >> numNodes >> ignore >> numTriangles;
+	fin.get();
+
+	if ((numNodes <= 0) || (numTriangles*3 != model.GetNumLod0Indices()))
+	{
+		sprintf(g_String, "invalid triangle BVH (nodes: %d, triangles: %d) of model: %s", numNodes, numTriangles, model.name_);
+		LogErr(g_String);
+		return;
+	}
+
+	TriangleBVH& bvh = model.bvh_;
+	bvh.nodes_.resize(numNodes);
+	bvh.triangles_.resize(numTriangles * 3);
+	bvh.triIdxs_.resize(numTriangles);
+
+	fin.read((char*)bvh.nodes_.data(),     sizeof(TriangleBVH::Node) * numNodes);
+	fin.read((char*)bvh.triangles_.data(), sizeof(UINT) * numTriangles * 3);
+	fin.read((char*)bvh.triIdxs_.data(),   sizeof(uint32) * numTriangles);
+
+	if (!fin)
+	{
+		sprintf(g_String, "can't read triangle BVH of model: %s", model.name_);
+		LogErr(g_String);
+		bvh.Clear();
+	}
 }
 
 ///////////////////////////////////////////////////////////
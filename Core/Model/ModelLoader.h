@@ -7,6 +7,8 @@
 #pragma once
 
 #include "BasicModel.h"
+#include "DE3DFormat.h"
+#include <MappedFile.h>
 #include <string>
 
 namespace Core
@@ -28,7 +30,38 @@ public:
 public:
 	bool Load(const char* modelFilePath, BasicModel& outModel);
 
+	// create vertex/index buffers of the loaded model: if it was loaded from
+	// a v2 file the GPU data is uploaded directly from the mapped file
+	// (and the file is unmapped after that)
+	void InitializeBuffers(ID3D11Device* pDevice, BasicModel& model);
+
+	// create materials (and load their textures) of subsets if the file has them;
+	// reuseIDs: (optional) materials which are replaced instead of creating new ones
+	//           (by subsets: e.g. materials of the model before its hot reload);
+	// NOTE: must be called by the main thread (material/texture managers aren't thread-safe)
+	void SetupMaterials(
+		BasicModel& model,
+		const MaterialID* reuseIDs = nullptr,
+		const int numReuseIDs = 0);
+
 private:
+	bool LoadMapped(const char* modelPath, BasicModel& model);
+
+	const uint8* GetSection(
+		const DE3DSection* sections,
+		const uint32 numSections,
+		const eDE3DSection type,
+		const uint32 count,
+		const uint64 elemSize) const;
+
+	// copy skin weights, bones and baked clips out of the mapped file
+	// (an invalid set of them makes the model a static one)
+	void LoadSkinnedData(
+		const DE3DSection* sections,
+		const uint32 numSections,
+		const DE3DHeader& header,
+		BasicModel& model);
+
 	void ReadHeader(std::ifstream& fin, BasicModel& model);
 
 	void ReadMaterials(
@@ -60,10 +93,20 @@ private:
 
 	void ReadIndices(
 		std::ifstream& fin,
-		int numTriangles,
+		int numIndices,
 		UINT* indices);
 
+	void ReadLods(std::ifstream& fin, BasicModel& model);
+	void ReadTriangleBVH(std::ifstream& fin, BasicModel& model);
+
 	void ReadAABB(std::ifstream& fin, DirectX::BoundingBox& aabb);
+
+private:
+	MappedFile            mappedFile_;                 // a v2 file (until InitializeBuffers)
+	const Vertex3DPacked* pMappedVertices_ = nullptr;
+	const void*           pMappedIndices_  = nullptr;
+	DXGI_FORMAT           mappedIndexFormat_ = DXGI_FORMAT_R32_UINT;
+	cvector<DE3DMaterial> materials_;                  // are copied out of the mapping
 };
 
 } // namespace Core
@@ -4,12 +4,137 @@
 ////////////////////////////////////////////////////////////////////
 #include <CoreCommon/pch.h>
 #include "ModelMath.h"
+#include <JobSystem.h>
+#include <memory>
 
 using namespace DirectX;
 
 namespace Core
 {
 
+// a partition of triangles is summed by a single job; the number of partitions doesn't
+// depend on the number of threads, and each one needs a temp array of tangents of all
+// the vertices (so they are limited)
+static constexpr int MIN_TRIS_PER_PARTITION = 8192;
+static constexpr int MAX_NUM_PARTITIONS     = 8;
+
+// the number of triangles/vertices per job for independent elements
+static constexpr int ELEMS_PER_JOB = 4096;
+
+
+//---------------------------------------------------------
+// Desc:  compute an unnormalized tangent of the triangle (so bigger triangles
+//        contribute more into tangents of their vertices); a triangle with
+//        degenerate texture coords gives the zero vector
+//---------------------------------------------------------
+static inline XMVECTOR ComputeTriangleTangent(
+	const Vertex3D& v0,
+	const Vertex3D& v1,
+	const Vertex3D& v2)
+{
+	const XMVECTOR p0 = XMLoadFloat3(&v0.position);
+	const XMVECTOR e0 = XMVectorSubtract(XMLoadFloat3(&v1.position), p0);
+	const XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&v2.position), p0);
+
+	// deltas of texture coords
+	const float du0 = v1.texture.x - v0.texture.x;
+	const float dv0 = v1.texture.y - v0.texture.y;
+	const float du1 = v2.texture.x - v0.texture.x;
+	const float dv1 = v2.texture.y - v0.texture.y;
+
+	const float det = (du0 * dv1) - (dv0 * du1);
+
+	if (fabsf(det) < 1e-12f)
+		return XMVectorZero();
+
+	// T = (e0 * dv1 - e1 * dv0) / det
+	return XMVectorScale(XMVectorSubtract(XMVectorScale(e0, dv1), XMVectorScale(e1, dv0)), 1.0f / det);
+}
+
+//---------------------------------------------------------
+// Desc:  orthogonalize the summed tangent against the normal (Gram-Schmidt),
+//        normalize it and store into the vertex; if the sum is degenerate
+//        the vertex keeps its tangent
+//---------------------------------------------------------
+static inline void StoreVertexTangent(Vertex3D& vertex, XMVECTOR tangent)
+{
+	const XMVECTOR normal = XMLoadFloat3(&vertex.normal);
+
+	tangent = XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent)));
+
+	if (XMVectorGetX(XMVector3LengthSq(tangent)) < 1e-20f)
+		return;
+
+	XMStoreFloat3(&vertex.tangent, XMVector3Normalize(tangent));
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelMath::ComputeTangents(
+	Vertex3D* vertices,
+	const int numVertices,
+	const UINT* indices,
+	const int numIndices)
+{
+	assert(vertices != nullptr);
+	assert(indices != nullptr);
+
+	const int numTris = numIndices / 3;
+
+	if ((numVertices <= 0) || (numTris <= 0))
+		return;
+
+	const int numParts    = std::clamp(numTris / MIN_TRIS_PER_PARTITION, 1, MAX_NUM_PARTITIONS);
+	const int trisPerPart = (numTris + numParts - 1) / numParts;
+
+	// sums of tangents per vertex of each partition (zero initialized)
+	std::unique_ptr<XMFLOAT3[]> sums = std::make_unique<XMFLOAT3[]>((size_t)numParts * numVertices);
+	XMFLOAT3* pSums = sums.get();
+
+	// 1. each partition sums up tangents of its triangles
+	g_JobSystem.ParallelFor(numParts, 1, [=](const index start, const index end)
+	{
+		for (index part = start; part < end; ++part)
+		{
+			XMFLOAT3* partSums = pSums + part * numVertices;
+			const int tri0     = (int)part * trisPerPart;
+			const int tri1     = std::min(tri0 + trisPerPart, numTris);
+
+			for (int tri = tri0; tri < tri1; ++tri)
+			{
+				const UINT i0 = indices[3*tri + 0];
+				const UINT i1 = indices[3*tri + 1];
+				const UINT i2 = indices[3*tri + 2];
+
+				if ((i0 >= (UINT)numVertices) || (i1 >= (UINT)numVertices) || (i2 >= (UINT)numVertices))
+					continue;
+
+				const XMVECTOR tangent = ComputeTriangleTangent(vertices[i0], vertices[i1], vertices[i2]);
+
+				XMStoreFloat3(&partSums[i0], XMVectorAdd(XMLoadFloat3(&partSums[i0]), tangent));
+				XMStoreFloat3(&partSums[i1], XMVectorAdd(XMLoadFloat3(&partSums[i1]), tangent));
+				XMStoreFloat3(&partSums[i2], XMVectorAdd(XMLoadFloat3(&partSums[i2]), tangent));
+			}
+		}
+	});
+
+	// 2. reduce partitions for each vertex
+	g_JobSystem.ParallelFor(numVertices, ELEMS_PER_JOB, [=](const index start, const index end)
+	{
+		for (index v = start; v < end; ++v)
+		{
+			XMVECTOR sum = XMVectorZero();
+
+			for (int part = 0; part < numParts; ++part)
+				sum = XMVectorAdd(sum, XMLoadFloat3(&pSums[part * numVertices + v]));
+
+			StoreVertexTangent(vertices[v], sum);
+		}
+	});
+}
+
+///////////////////////////////////////////////////////////
+
 void ModelMath::CalculateModelVectors(
 	Vertex3D*& vertices,
 	int count,
@@ -20,6 +145,7 @@ void ModelMath::CalculateModelVectors(
 	// in the model. Then for each of those triangles it gets the three vertices and uses
 	// that to calculate the tangent, binormal, and normal. After calculating those three
 	// normal vectors it then saves them back into the model structure.
+	// (faces don't share vertices so they are processed by jobs independently)
 
 	// Input:
 	// 1. An array of vertices (vertices).
@@ -28,46 +154,41 @@ void ModelMath::CalculateModelVectors(
 	assert(vertices != nullptr);
 	assert(count > 2);
 
-	DirectX::XMVECTOR tangent;
-	DirectX::XMVECTOR binormal;
-	
-
 	// calculate the number of faces in the model
-	const size_t facesCount = count / 3;
+	const index facesCount = count / 3;
+	Vertex3D*   pVertices  = vertices;
 
 	// go throught all the faces and calculate the tangent, binormal, and normal vectors
-	for (size_t faceIdx = 0, dataIdx = 0; faceIdx < facesCount; ++faceIdx)
+	g_JobSystem.ParallelFor(facesCount, ELEMS_PER_JOB, [this, pVertices, calculateNormals](const index start, const index end)
 	{
-		
-		// calculate the tangent and binormal of that face
-		CalculateTangentBinormal(
-			vertices[dataIdx++],
-			vertices[dataIdx++],
-			vertices[dataIdx++],
-			tangent,
-			binormal);
-
-		// if we want to compute normals as well
-		if (calculateNormals)
-		{
-			DirectX::XMVECTOR normalVec;
-	
-			CalculateNormal(tangent, binormal, normalVec);
-	
-			// store these normal vectors into the vertices of the face
-			XMStoreFloat3(&vertices[dataIdx-3].normal, normalVec);
-			XMStoreFloat3(&vertices[dataIdx-2].normal, normalVec);
-			XMStoreFloat3(&vertices[dataIdx-1].normal, normalVec);
-		}
-	
+		DirectX::XMVECTOR tangent;
+		DirectX::XMVECTOR binormal;
 
-		// store the tangent, and binormal for this face back in the vertex structure
-		for (int backIndex = 3; backIndex > 0; backIndex--)
+		for (index faceIdx = start; faceIdx < end; ++faceIdx)
 		{
-			const int vIdx = (int)dataIdx - backIndex;  // an index of the vertex
-			XMStoreFloat3(&vertices[vIdx].tangent, tangent);
+			Vertex3D* face = pVertices + faceIdx * 3;
+
+			// calculate the tangent and binormal of that face
+			CalculateTangentBinormal(face[0], face[1], face[2], tangent, binormal);
+
+			// if we want to compute normals as well
+			if (calculateNormals)
+			{
+				DirectX::XMVECTOR normalVec;
+				CalculateNormal(tangent, binormal, normalVec);
+
+				// store these normal vectors into the vertices of the face
+				XMStoreFloat3(&face[0].normal, normalVec);
+				XMStoreFloat3(&face[1].normal, normalVec);
+				XMStoreFloat3(&face[2].normal, normalVec);
+			}
+
+			// store the tangent for this face back in the vertex structure
+			XMStoreFloat3(&face[0].tangent, tangent);
+			XMStoreFloat3(&face[1].tangent, tangent);
+			XMStoreFloat3(&face[2].tangent, tangent);
 		}
-	}
+	});
 }
 
 ///////////////////////////////////////////////////////////
@@ -82,52 +203,28 @@ void ModelMath::CalculateTangentBinormal(
 	// the CalculateTangentBinormal() takes in three vertices and then
 	// calculates and returns the tangent and binormal of those three vertices
 
-	float den = 0.0f;    // denominator of the tangent/binormal equation
-	float tuVector[2]{ 0.0f };
-	float tvVector[2]{ 0.0f };
-	
-	const DirectX::XMVECTOR vertex1_pos = DirectX::XMLoadFloat3(&vertex1.position);
-	const DirectX::XMVECTOR vertex2_pos = DirectX::XMLoadFloat3(&vertex2.position);
-	const DirectX::XMVECTOR vertex3_pos = DirectX::XMLoadFloat3(&vertex3.position);
+	const XMVECTOR pos1 = XMLoadFloat3(&vertex1.position);
 
 	// calculate the two vectors of edges for this face
-	DirectX::XMFLOAT3 edge1;
-	DirectX::XMFLOAT3 edge2;
-	DirectX::XMStoreFloat3(&edge1, DirectX::XMVectorSubtract(vertex2_pos, vertex1_pos));
-	DirectX::XMStoreFloat3(&edge2, DirectX::XMVectorSubtract(vertex3_pos, vertex1_pos));
+	const XMVECTOR edge1 = XMVectorSubtract(XMLoadFloat3(&vertex2.position), pos1);
+	const XMVECTOR edge2 = XMVectorSubtract(XMLoadFloat3(&vertex3.position), pos1);
 	
 	// calculate the tu and tv texture space vectors
-	tuVector[0] = vertex2.texture.x - vertex1.texture.x; 
-	tvVector[0] = vertex2.texture.y - vertex1.texture.y;
-
-	tuVector[1] = vertex3.texture.x - vertex1.texture.x;
-	tvVector[1] = vertex3.texture.y - vertex1.texture.y;
+	const float tu0 = vertex2.texture.x - vertex1.texture.x;
+	const float tv0 = vertex2.texture.y - vertex1.texture.y;
+	const float tu1 = vertex3.texture.x - vertex1.texture.x;
+	const float tv1 = vertex3.texture.y - vertex1.texture.y;
 
 	// calculate the denominator of the tangent/binormal equation
-	den = 1.0f / (tuVector[0] * tvVector[1] - tuVector[1] * tvVector[0]);
-
-#if 0
-	if (isinf(den))
-	{
-		throw std::runtime_error("denominator of the tangent/binormal equation is infinite");
-	}
-#endif
+	const float den = 1.0f / (tu0 * tv1 - tu1 * tv0);
 
 	// calculate the cross products and multiply by the coefficient to get 
-	// the tangent and binormal;
-	const float tangent_x = (tvVector[1] * edge1.x - tvVector[0] * edge2.x) * den;
-	const float tangent_y = (tvVector[1] * edge1.y - tvVector[0] * edge2.y) * den;
-	const float tangent_z = (tvVector[1] * edge1.z - tvVector[0] * edge2.z) * den;
-
-	const float binormal_x = (tuVector[0] * edge2.x - tuVector[1] * edge1.x) * den;
-	const float binormal_y = (tuVector[0] * edge2.y - tuVector[1] * edge1.y) * den;
-	const float binormal_z = (tuVector[0] * edge2.z - tuVector[1] * edge1.z) * den;
-
-	// normalize the tangent components and then store it
-	tangent = DirectX::XMVector3Normalize({ tangent_x, tangent_y, tangent_z });
+	// the tangent and binormal, and normalize them
+	tangent  = XMVectorScale(XMVectorSubtract(XMVectorScale(edge1, tv1), XMVectorScale(edge2, tv0)), den);
+	binormal = XMVectorScale(XMVectorSubtract(XMVectorScale(edge2, tu0), XMVectorScale(edge1, tu1)), den);
 
-	// normalize the binormal components and then store it
-	binormal = DirectX::XMVector3Normalize({ binormal_x, binormal_y, binormal_z });
+	tangent  = XMVector3Normalize(tangent);
+	binormal = XMVector3Normalize(binormal);
 }
 
 ///////////////////////////////////////////////////////////
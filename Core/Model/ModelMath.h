@@ -1,7 +1,9 @@
 ////////////////////////////////////////////////////////////////////
 // Filename:     ModelMath.h
 // Description:  constains functions for calculation model math
-//               (normal, tangent, binormal, etc.)
+//               (normal, tangent, binormal, etc.);
+//               the per-triangle math goes through SIMD (DirectXMath)
+//               and big meshes are processed by jobs of the job system
 //
 // Created:      05.02.23
 ////////////////////////////////////////////////////////////////////
@@ -15,7 +17,19 @@ namespace Core
 class ModelMath
 {
 public:
+	// compute a tangent of each vertex of the indexed mesh: tangents of all the triangles
+	// which share a vertex are summed up and orthogonalized against the vertex normal;
+	// triangles are split into partitions which are summed by jobs (each one into its
+	// own array) and then the partitions are reduced per vertex in a fixed order
+	// (so the result doesn't depend on the number of threads)
+	static void ComputeTangents(
+		Vertex3D* vertices,
+		const int numVertices,
+		const UINT* indices,
+		const int numIndices);
+
 	// function for calculating the tangent and binormal vectors for the model
+	// (a non-indexed list of triangles, so each triangle is processed independently)
 	void CalculateModelVectors(
 		Vertex3D*& vertices,
 		int count,
@@ -35,4 +49,3 @@ public:
 };
 
 } // namespace Core
-
@@ -8,6 +8,12 @@
 #include "ModelExporter.h"
 #include "ModelsCreator.h"
 #include "ModelStorageSerializer.h"
+#include "../Mesh/MaterialMgr.h"
+#include "../Render/GpuMemory.h"
+
+#include <AssetPack.h>
+#include <TextTokenizer.h>
+#include <sstream>
 
 namespace fs = std::filesystem;
 
@@ -44,27 +50,47 @@ ModelMgr::ModelMgr()
 
 ///////////////////////////////////////////////////////////
 
-void SerializeModels(
+static int SerializeModels(
     ID3D11Device* pDevice,
-    const BasicModel* models,
+    const BasicModel* const* models,
     const std::string* relativePathsToAssets,
-    const size numModels,
+    const bool* isChanged,
     const index startIdx,
     const index endIdx)
 {
+    // export models of the range which are changed since the last save
+    // or which don't have an up-to-date .de3d file;
+    // NOTE: can be executed by several threads at once (for different ranges)
+    // return: the number of exported models
+
     ModelExporter exporter;
+    int numExported = 0;
 
     for (index i = startIdx; i < endIdx; ++i)
     {
-        // generate full path to the model in .de3d format
-        sprintf(g_String, "%s%s", g_RelPathAssetsDir, relativePathsToAssets[i].c_str());
+        if (!isChanged[i] && exporter.IsUpToDate(relativePathsToAssets[i].c_str()))
+            continue;
 
-        // if there is no such model in internal format we store it as asset
-        if (fopen(g_String, "r+") == nullptr)
-        {
-            exporter.ExportIntoDE3D(pDevice, models[i], relativePathsToAssets[i].c_str());
-        }
+        if (exporter.ExportIntoDE3D(pDevice, *models[i], relativePathsToAssets[i].c_str()))
+            numExported++;
     }
+
+    return numExported;
+}
+
+//---------------------------------------------------------
+// Desc:  read the whole text file into the string (empty if there is no such file)
+//---------------------------------------------------------
+static std::string ReadTextFile(const char* filepath)
+{
+    std::ifstream fin(filepath, std::ios::in | std::ios::binary);
+
+    if (!fin)
+        return std::string();
+
+    std::ostringstream ss;
+    ss << fin.rdbuf();
+    return ss.str();
 }
 
 ///////////////////////////////////////////////////////////
@@ -76,125 +102,135 @@ void ModelMgr::Serialize(ID3D11Device* pDevice)
 
     LogDbg("serialization: start");
 
-    auto start = std::chrono::steady_clock::now();
-
+    // models which are still being loaded must be stored as well
+    FinishLoading();
 
+    auto start = std::chrono::steady_clock::now();
 
     const char* pathToDataFile = "data/model_storage_data.txt";
 
-    std::ofstream fout(pathToDataFile, std::ios::out);
-    CAssert::True(fout.is_open(), "can't open a file for serialization of models storage");
-
+    // the first models are created by the engine at each start so they aren't stored
+    constexpr index firstStoredIdx = 2;
 
     ModelStorageSerializer serializer;
-    const size numModels = GetNumAssets() - 2;
-    std::vector<std::string> relativePathsToAssets(numModels);
-
-    serializer.WriteHeader(fout, numModels, lastModelID_);
+    std::ostringstream     storageData;
+    const index            numModels = std::max(GetNumAssets() - (int)firstStoredIdx, 0);
 
     // generate relative paths based on models names
-    for (index i = 2; i < numModels; ++i)
+    std::vector<std::string> relativePathsToAssets(numModels);
+
+    for (index i = 0; i < numModels; ++i)
     {
-        const std::string& name = models_[i].name_;
-        relativePathsToAssets[i] = std::string(name + "/" + name + ".de3d");
+        const std::string name = ModelAt(firstStoredIdx + i).name_;
+        relativePathsToAssets[i] = name + "/" + name + ".de3d";
     }
 
-    serializer.WriteModelsInfo(fout, ids_.data(), relativePathsToAssets.data(), numModels);
+    serializer.WriteHeader(storageData, numModels, lastModelID_);
 
+    if (numModels > 0)
+        serializer.WriteModelsInfo(storageData, ids_.data() + firstStoredIdx, relativePathsToAssets.data(), numModels);
 
-    // export assets from memory into the internal .de3d format
-    ModelExporter exporter;
+    // the storage file is rewritten only if it is changed (the file of the previous
+    // run is compared only once: after that its content is known)
+    if (savedStorageData_.empty())
+        savedStorageData_ = ReadTextFile(pathToDataFile);
 
-#if 0
-    for (index i = 2; i < numModels; ++i)
+    if (storageData.str() != savedStorageData_)
     {
-        // if there is no such model in internal format we store it as asset
-        if (!fs::exists(g_RelPathAssetsDir + relativePathsToAssets[i]))
-        {
-            exporter.ExportIntoDE3D(pDevice, models_[i], relativePathsToAssets[i]);
-        }
+        std::ofstream fout(pathToDataFile, std::ios::out | std::ios::binary);
+        CAssert::True(fout.is_open(), "can't open a file for serialization of models storage");
+
+        fout << storageData.str();
+        fout.close();
+
+        savedStorageData_ = storageData.str();
     }
-#endif
-
-    size numModelsToExport = (numModels - 2);
-    const index firstHalfRangeStart = 2;
-    const index firstHalfRangeEnd = numModels / 2;
-    const index secondHalfRangeStart = numModels / 2;
-    const index secondHalfRangeEnd = numModelsToExport + 2;
-
-    SerializeModels(
-        pDevice,
-        models_.data(),
-        relativePathsToAssets.data(),
-        models_.size(),
-        firstHalfRangeStart,
-        firstHalfRangeEnd);
-
-    SerializeModels(
-        pDevice,
-        models_.data(),
-        relativePathsToAssets.data(),
-        models_.size(),
-        secondHalfRangeStart,
-        secondHalfRangeEnd);
-
-#if 0
-    std::thread th(
-        SerializeModels,
-        pDevice,
-        models_.data(),
-        relativePathsToAssets.data(),
-        models_.size(),
-        firstHalfRangeStart,
-        firstHalfRangeEnd);
-
-    SerializeModels(
-        pDevice,
-        models_.data(),
-        relativePathsToAssets.data(),
-        models_.size(),
-        secondHalfRangeStart,
-        secondHalfRangeEnd);
-
-   th.join();
-#endif
+
+    if (numModels <= 0)
+    {
+        LogDbg("serialization: finished (there are no models to store)");
+        return;
+    }
+
+    // find models which are changed since the last save: the first save compares
+    // with .de3d files only (materials of loaded models are the same as in files)
+    std::unique_ptr<bool[]> isChanged = std::make_unique<bool[]>(numModels);
+
+    for (index i = 0; i < numModels; ++i)
+    {
+        const ModelID id   = ids_[firstStoredIdx + i];
+        const uint64  hash = HashMaterials(ModelAt(firstStoredIdx + i));
+        auto          it   = savedMaterialsHashes_.find(id);
+
+        isChanged[i] = ((it != savedMaterialsHashes_.end()) && (it->second != hash)) ||
+                       (std::find(dirtyModels_.begin(), dirtyModels_.end(), id) != dirtyModels_.end());
+
+        savedMaterialsHashes_[id] = hash;
+    }
+
+    dirtyModels_.clear();
+
+    // export assets from memory into the internal .de3d format; models differ
+    // a lot in size so each one is a separate chunk (for balancing between threads)
+    cvector<const BasicModel*> storedModels(numModels);
+
+    for (index i = 0; i < numModels; ++i)
+        storedModels[i] = &ModelAt(firstStoredIdx + i);
+
+    const BasicModel* const* models = storedModels.data();
+    const std::string* paths  = relativePathsToAssets.data();
+    const bool*        changed = isChanged.get();
+    std::atomic<int>   numExported = 0;
+
+    g_JobSystem.ParallelFor(numModels, 1, [pDevice, models, paths, changed, &numExported](const index start, const index end)
+    {
+        numExported += SerializeModels(pDevice, models, paths, changed, start, end);
+    });
 
     auto end = std::chrono::steady_clock::now();
     std::chrono::duration<double, std::milli> elapsed = end - start;
 
-    sprintf(g_String, "Model mgr serialization duration: %f sec", elapsed.count());
-    LogMsg(g_String);
-
-    fout.close();
+    LogMsgf("Model mgr serialization: %d of %d models are exported (duration: %.2f ms)",
+            numExported.load(), (int)numModels, elapsed.count());
 
     LogDbg("serialization: finished");
 }
 
 ///////////////////////////////////////////////////////////
 
+void ModelMgr::MarkDirty(const ModelID id)
+{
+    if (std::find(dirtyModels_.begin(), dirtyModels_.end(), id) == dirtyModels_.end())
+        dirtyModels_.push_back(id);
+}
+
+///////////////////////////////////////////////////////////
+
 void ModelMgr::Deserialize(ID3D11Device* pDevice)
 {
+    MEM_TAG_SCOPE(MEM_TAG_MODELS);
+
     LogDbg("deserialization: start");
 
-    std::string ignore;
-    ModelsCreator creator;
-    int numModelsToLoad = 0;
-    const std::string pathToDataFile = "data/model_storage_data.txt";
+    int           numModelsToLoad = 0;
+    const char*   pathToDataFile  = "data/model_storage_data.txt";
+    TextTokenizer tokenizer;
 
-    std::ifstream fin(pathToDataFile, std::ios::in);
-    CAssert::True(fin.is_open(), "can't open a file for deserialization of models storage");
+    CAssert::True(tokenizer.Open(pathToDataFile), "can't open a file for deserialization of models storage");
 
     // skip header
-    fin >> ignore;
+    tokenizer.Skip();
+
+    tokenizer.ReadKey("#LastID:", lastModelID_);
+    tokenizer.ReadKey("#ModelsCount:", numModelsToLoad);
+    tokenizer.Skip();                  // header of the models list
 
-    fin >> ignore >> lastModelID_;
-    fin >> ignore >> numModelsToLoad;
-    fin >> ignore;
+    CAssert::True(!tokenizer.IsFailed() && (numModelsToLoad >= 0), "models storage data file is corrupted");
 
     // prepare memory
     size curSize = std::ssize(ids_);
     ids_.reserve(curSize + numModelsToLoad);
-    models_.reserve(curSize + numModelsToLoad);
+    handles_.reserve(curSize + numModelsToLoad);
 
     std::vector<ModelID>     modelsIDs(numModelsToLoad, INVALID_MODEL_ID);
     std::vector<std::string> pathsToAssets(numModelsToLoad, "invalid");
@@ -202,22 +238,284 @@ void ModelMgr::Deserialize(ID3D11Device* pDevice)
     // read in all pairs [id => path] from the file
     for (int i = 0; i < numModelsToLoad; ++i)
     {
-        fin >> modelsIDs[i] >> pathsToAssets[i];
+        const char* path    = nullptr;
+        size_t      pathLen = 0;
+
+        tokenizer.Read(modelsIDs[i]);
+
+        if (tokenizer.Next(path, pathLen))
+            pathsToAssets[i].assign(path, pathLen);
     }
 
+    CAssert::True(!tokenizer.IsFailed(), "models storage data file is corrupted");
+
+    pDevice_ = pDevice;
+    pendingModels_.reserve(pendingModels_.size() + numModelsToLoad);
+
     for (int i = 0; i < numModelsToLoad; ++i)
     {
-        // load a model from the internal format
-        ModelID loadedModelID = creator.CreateFromDE3D(pDevice, pathsToAssets[i].c_str());
+        PendingModel* pPending = new PendingModel();
+        pPending->expectedID   = modelsIDs[i];
+        pPending->path         = pathsToAssets[i];
+
+        StartLoading(pPending);
+    }
+
+    LogDbg("deserialization: loading jobs are started");
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelMgr::StartLoading(PendingModel* pPending)
+{
+    ID3D11Device* pDevice = pDevice_;
+    pendingModels_.push_back(pPending);
+
+    // the model is decoded right into its final slot (which isn't published
+    // by ID until the model is ready) so publishing doesn't move it
+    pPending->handle = models_.Allocate();
+    pPending->pModel = models_.Get(pPending->handle);
+
+    // read/decode a model from the internal format by a job
+    g_JobSystem.Run([pPending, pDevice]()
+    {
+        MEM_TAG_SCOPE(MEM_TAG_MODELS);
+
+        if (!pPending->pModel)
+        {
+            pPending->isDone.store(true, std::memory_order_release);
+            return;
+        }
+
+        ModelsCreator creator;
+        pPending->isLoaded = creator.LoadFromDE3D(pPending->path.c_str(), pPending->loader, *pPending->pModel);
+
+        // the device is free-threaded so own buffers of the model can be created
+        // right here; but the geometry pool is filled by the immediate context
+        // so in this case the buffers are created by the main thread (by Update)
+        if (pPending->isLoaded && !g_GeometryPool.IsInit())
+        {
+            pPending->loader.InitializeBuffers(pDevice, *pPending->pModel);
+            pPending->hasBuffers = true;
+        }
+
+        pPending->isDone.store(true, std::memory_order_release);
+    }, &loadCounter_);
+}
+
+///////////////////////////////////////////////////////////
+
+bool ModelMgr::ReloadAsync(const ModelID id)
+{
+    const auto it = modelPaths_.find(id);
+
+    if (it == modelPaths_.end())
+    {
+        sprintf(g_String, "can't reload model (ID: %ud): it isn't loaded from .de3d file", id);
+        LogErr(g_String);
+        return false;
+    }
+
+    PendingModel* pPending = new PendingModel();
+    pPending->expectedID   = id;
+    pPending->path         = it->second;
+    pPending->isReload     = true;
+
+    StartLoading(pPending);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ModelMgr::IsReloading(const ModelID id) const
+{
+    for (const PendingModel* pPending : pendingModels_)
+    {
+        if (pPending->isReload && (pPending->expectedID == id))
+            return true;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+ModelID ModelMgr::GetModelIdByPath(const char* path) const
+{
+    if (StrHelper::IsEmpty(path))
+        return INVALID_MODEL_ID;
+
+    char         fullPath[256]{ '\0' };
+    const uint64 pathHash = AssetPack::HashPath(path);
+
+    for (const auto& [id, relPath] : modelPaths_)
+    {
+        snprintf(fullPath, sizeof(fullPath), "%s%s", g_RelPathAssetsDir, relPath.c_str());
+
+        if (AssetPack::HashPath(fullPath) == pathHash)
+            return id;
+    }
+
+    return INVALID_MODEL_ID;
+}
+
+///////////////////////////////////////////////////////////
+
+ModelID ModelMgr::GetSharedModel(const uint64 key) const
+{
+    auto it = sharedModels_.find(key);
+    return (it != sharedModels_.end()) ? it->second : INVALID_MODEL_ID;
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelMgr::AddSharedModel(const uint64 key, const ModelID id)
+{
+    sharedModels_[key] = id;
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelMgr::Update()
+{
+    // add models which are ready into the storage (the order of
+    // the rest pending models is kept)
+    MEM_TAG_SCOPE(MEM_TAG_MODELS);
+
+    if (pendingModels_.empty())
+        return;
+
+    index numLeft = 0;
+
+    for (PendingModel* pPending : pendingModels_)
+    {
+        if (!pPending->isDone.load(std::memory_order_acquire))
+        {
+            pendingModels_[numLeft++] = pPending;
+            continue;
+        }
+
+        PublishModel(*pPending);
+        SafeDelete(pPending);
+    }
+
+    pendingModels_.resize(numLeft);
+
+    if (pendingModels_.empty())
+        LogDbg("deserialization: finished");
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelMgr::FinishLoading()
+{
+    // the waiting thread helps to execute loading jobs
+    g_JobSystem.Wait(loadCounter_);
+    Update();
+}
+
+///////////////////////////////////////////////////////////
+
+uint64 ModelMgr::HashMaterials(const BasicModel& model) const
+{
+    // FNV-1a hash of data of materials of all the model's subsets
+    // (is used to find models which must be exported again)
+
+    uint64 hash = 14695981039346656037ULL;
+
+    for (int i = 0; i < model.GetNumSubsets(); ++i)
+    {
+        const Material& mat   = g_MaterialMgr.GetMaterialByID(model.meshes_.subsets_[i].materialID);
+        const uint8*    bytes = (const uint8*)&mat;
 
-        if (modelsIDs[i] != loadedModelID)
+        for (size_t j = 0; j < sizeof(Material); ++j)
         {
-            sprintf(g_String, "ID (%ud) of loaded model is not equal to the expected (%ud) one", loadedModelID, modelsIDs[i]);
-            LogErr(g_String);
+            hash ^= bytes[j];
+            hash *= 1099511628211ULL;
         }
     }
 
-    LogDbg("deserialization: finished");
+    return hash;
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelMgr::PublishModel(PendingModel& pending)
+{
+    if (!pending.isLoaded)
+    {
+        // a model which is failed to be reloaded keeps its prev version
+        sprintf(g_String, "can't load model (expected ID: %ud) by path: %s", pending.expectedID, pending.path.c_str());
+        LogErr(g_String);
+
+        models_.Release(pending.handle);
+        return;
+    }
+
+    if (!pending.hasBuffers)
+        pending.loader.InitializeBuffers(pDevice_, *pending.pModel);
+
+    if (pending.isReload)
+    {
+        ReplaceModel(pending);
+        models_.Release(pending.handle);
+        return;
+    }
+
+    pending.loader.SetupMaterials(*pending.pModel);
+
+    const ModelID loadedModelID = InsertModel(pending.handle);
+
+    if (pending.expectedID != loadedModelID)
+    {
+        sprintf(g_String, "ID (%ud) of loaded model is not equal to the expected (%ud) one", loadedModelID, pending.expectedID);
+        LogErr(g_String);
+    }
+
+    if (loadedModelID != INVALID_MODEL_ID)
+        modelPaths_[loadedModelID] = pending.path;
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelMgr::ReplaceModel(PendingModel& pending)
+{
+    // swap in a reloaded model (is called when models aren't used by rendering
+    // so the old buffers can be released right here)
+
+    const ModelID id  = pending.expectedID;
+    const index   idx = ids_.get_idx(id);
+
+    if ((idx < 0) || (idx >= std::ssize(ids_)) || (ids_[idx] != id))
+    {
+        sprintf(g_String, "can't replace model: there is no model by ID: %ud", id);
+        LogErr(g_String);
+        return;
+    }
+
+    BasicModel& oldModel = ModelAt(idx);
+    BasicModel& newModel = *pending.pModel;
+
+    // materials of the model are replaced in place if it has the same subsets
+    cvector<MaterialID> materialIDs;
+
+    if (oldModel.numSubsets_ == newModel.numSubsets_)
+    {
+        const MeshGeometry::Subset* oldSubsets = oldModel.GetSubsets();
+        materialIDs.resize(oldModel.numSubsets_);
+
+        for (int i = 0; i < oldModel.numSubsets_; ++i)
+            materialIDs[i] = oldSubsets[i].materialID;
+    }
+
+    pending.loader.SetupMaterials(newModel, materialIDs.data(), (int)materialIDs.size());
+
+    // the model is replaced at the same address (references to it stay valid)
+    newModel.id_ = id;
+    oldModel     = std::move(newModel);
+
+    sprintf(g_String, "model is hot reloaded (ID: %ud): %s", id, pending.path.c_str());
+    LogMsg(g_String);
 }
 
 ///////////////////////////////////////////////////////////
@@ -225,6 +523,8 @@ void ModelMgr::Deserialize(ID3D11Device* pDevice)
 ModelID ModelMgr::AddModel(BasicModel&& model)
 {
     // check if there is no such model id yet
+    MEM_TAG_SCOPE(MEM_TAG_MODELS);
+
     if (ids_.binary_search(model.id_))
     {
         sprintf(g_String, "can't add model: there is already a model by ID: %ud", model.id_);
@@ -232,11 +532,37 @@ ModelID ModelMgr::AddModel(BasicModel&& model)
         return INVALID_MODEL_ID;
     }
 
-    const ModelID id = model.id_;
-    const index idx = ids_.get_insert_idx(model.id_);
+    return InsertModel(models_.Allocate(std::move(model)));
+}
+
+//---------------------------------------------------------
+// Desc:   publish the model of the slot by its ID (the slot is released
+//         if there is already a model by such ID)
+//---------------------------------------------------------
+ModelID ModelMgr::InsertModel(const SlabHandle handle)
+{
+    BasicModel* pModel = models_.Get(handle);
+
+    if (!pModel)
+    {
+        LogErr("can't add model: the pool of models is full");
+        return INVALID_MODEL_ID;
+    }
+
+    const ModelID id = pModel->id_;
+
+    if (ids_.binary_search(id))
+    {
+        sprintf(g_String, "can't add model: there is already a model by ID: %ud", id);
+        LogErr(g_String);
+        models_.Release(handle);
+        return INVALID_MODEL_ID;
+    }
+
+    const index idx = ids_.get_insert_idx(id);
 
     ids_.insert_before(idx, id);
-    models_.insert_before(idx, std::move(model));
+    handles_.insert_before(idx, handle);
 
     return id;
 }
@@ -247,14 +573,18 @@ BasicModel& ModelMgr::AddEmptyModel()
 {
     // push new empty model into the storage;
     // return: a ref to this new model
+    MEM_TAG_SCOPE(MEM_TAG_MODELS);
 
     const ModelID id = lastModelID_;
     ++lastModelID_;
 
+    const SlabHandle handle = models_.Allocate();
+    CAssert::True(handle.IsValid(), "can't add model: the pool of models is full");
+
     ids_.push_back(id);
-    models_.push_back(BasicModel());
+    handles_.push_back(handle);
 
-    BasicModel& model = models_.back();
+    BasicModel& model = models_[handle];
     model.id_ = id;
 
     return model;
@@ -276,11 +606,14 @@ void ModelMgr::GetModelsByIDs(
     cvector<index> idxs;
     ids_.get_idxs(ids, numModels, idxs);
 
-    // get pointers by idxs
+    // get pointers by idxs (models which aren't loaded yet are replaced with the placeholder)
     outModels.resize(numModels);
 
     for (int i = 0; const index idx : idxs)
-        outModels[i++] = &models_[idx];
+    {
+        const bool exist = (idx < std::ssize(ids_)) && (ids_[idx] == ids[i]);
+        outModels[i++] = &ModelAt(idx * exist);
+    }
 }
 
 ///////////////////////////////////////////////////////////
@@ -289,9 +622,24 @@ BasicModel& ModelMgr::GetModelByID(const ModelID id)
 {
     // return a model by ID, or invalid model (by idx == 0) if there is no such ID
     const index idx = ids_.get_idx(id);
-    const bool exist = (ids_[idx] == id);
+    const bool exist = (idx >= 0) && (ids_[idx] == id);
 
-    return models_[idx * exist];
+    return ModelAt(idx * exist);
+}
+
+///////////////////////////////////////////////////////////
+
+SlabHandle ModelMgr::GetModelHandle(const ModelID id) const
+{
+    const index idx = ids_.get_idx(id);
+    return ((idx >= 0) && (ids_[idx] == id)) ? handles_[idx] : SlabHandle();
+}
+
+///////////////////////////////////////////////////////////
+
+BasicModel* ModelMgr::GetModelByHandle(const SlabHandle handle)
+{
+    return models_.Get(handle);
 }
 
 ///////////////////////////////////////////////////////////
@@ -303,19 +651,19 @@ BasicModel& ModelMgr::GetModelByName(const char* name)
     if ((name == nullptr) || (name[0] == '\0'))
     {
         LogErr("input name is empty");
-        return models_[0];                  // return empty model (actually cube)
+        return ModelAt(0);                  // return empty model (actually cube)
     }
 
-    for (index i = 0; i < std::ssize(models_); ++i)
+    for (index i = 0; i < std::ssize(ids_); ++i)
     {
-        if (strcmp(models_[i].name_, name) == 0)
-            return models_[i];
+        if (strcmp(ModelAt(i).name_, name) == 0)
+            return ModelAt(i);
     }
 
     // return an empty model if we didn't find any
     sprintf(g_String, "there is no model by name: %s", name);
     LogErr(g_String);
-    return models_[0];                  
+    return ModelAt(0);
 }
 
 ///////////////////////////////////////////////////////////
@@ -330,9 +678,9 @@ ModelID ModelMgr::GetModelIdByName(const char* name)
         return ids_[0];                  // return empty model (actually cube)
     }
 
-    for (index i = 0; i < std::ssize(models_); ++i)
+    for (index i = 0; i < std::ssize(ids_); ++i)
     {
-        if (strcmp(models_[i].name_, name) == 0)
+        if (strcmp(ModelAt(i).name_, name) == 0)
             return ids_[i];
     }
 
@@ -352,7 +700,55 @@ void ModelMgr::GetModelsNamesList(cvector<ModelName>& names)
     names.resize(numNames);
 
     for (int i = 0; i < numNames; ++i)
-        strcpy(names[i].name, models_[i].GetName());
+        strcpy(names[i].name, ModelAt(i).GetName());
+}
+
+///////////////////////////////////////////////////////////
+
+uint64 ModelMgr::GetGpuMemoryUsage() const
+{
+    // models which share geometry (or are in the pool) have the same buffers
+
+    cvector<ID3D11Buffer*> buffers;
+    buffers.reserve(handles_.size() * 2 + 2);
+
+    for (const SlabHandle handle : handles_)
+    {
+        const BasicModel& model = models_[handle];
+
+        buffers.push_back(model.meshes_.GetVB());
+        buffers.push_back(model.meshes_.GetIB());
+    }
+
+    buffers.push_back(sky_.GetVertexBuffer());
+    buffers.push_back(sky_.GetIndexBuffer());
+
+    std::sort(buffers.begin(), buffers.end());
+
+    uint64 bytes = 0;
+
+    for (index i = 0; i < buffers.size(); ++i)
+    {
+        if ((i == 0) || (buffers[i] != buffers[i-1]))
+            bytes += GetGpuMemorySize(buffers[i]);
+    }
+
+    return bytes;
+}
+
+///////////////////////////////////////////////////////////
+
+uint64 ModelMgr::GetTerrainGpuMemoryUsage() const
+{
+    const TerrainGeomipmapped& terrain = terrainGeomip_;
+
+    return GetGpuMemorySize(terrain.GetVertexBuffer())     +
+           GetGpuMemorySize(terrain.GetIndexBuffer())      +
+           GetGpuMemorySize(terrain.GetTessVertexBuffer()) +
+           GetGpuMemorySize(terrain.GetGridVertexBuffer()) +
+           GetGpuMemorySize(terrain.GetGridIndexBuffer())  +
+           GetGpuMemorySize(terrain.GetPatchStartsBuffer()) +
+           GetGpuMemorySize(terrain.patchMorphsVB_.Get());
 }
 
 } // namespace Core
@@ -12,6 +12,11 @@
 #include "../Terrain/Terrain.h"
 #include "../Terrain/TerrainGeomipmapped.h"
 #include "BasicModel.h"
+#include "ModelLoader.h"
+#include <JobSystem.h>
+#include <SlabPool.h>
+#include <atomic>
+#include <unordered_map>
 
 namespace Core
 {
@@ -21,34 +26,116 @@ class ModelMgr
 public:
     ModelMgr();
 
+    // write the storage file and export models which are changed since the last
+    // save (their materials data is changed or they are marked as dirty) or which
+    // don't have an up-to-date .de3d file; the storage file is written only
+    // if its content is changed
     void        Serialize  (ID3D11Device* pDevice);
+
+    // the model must be exported by the next Serialize() (e.g. its geometry is edited)
+    void        MarkDirty  (const ModelID id);
+
+    // start loading of the stored models by jobs (in parallel); each model is
+    // added into the storage by Update() when it is ready, until that its ID
+    // (the ID is the same as it was stored) is resolved into the placeholder model
     void        Deserialize(ID3D11Device* pDevice);
 
+    // add models which are loaded by jobs into the storage;
+    // NOTE: is called by the main thread when models aren't used by rendering
+    void        Update();
+
+    // wait until all the models of Deserialize() are loaded and added
+    void        FinishLoading();
+
+    inline bool IsLoading() const { return !pendingModels_.empty(); }
+
+    // hot reload: load the .de3d file of the model again by a job; the model is
+    // replaced by Update() in place so it keeps its ID (and IDs of its materials
+    // if the number of subsets isn't changed)
+    bool        ReloadAsync(const ModelID id);
+    bool        IsReloading(const ModelID id) const;
+
+    // a model which is loaded from the .de3d file by path (relatively to the working dir)
+    ModelID     GetModelIdByPath(const char* path) const;
+
+    // shared procedural models (see ModelsCreator): key is a hash of type and params
+    ModelID     GetSharedModel(const uint64 key) const;
+    void        AddSharedModel(const uint64 key, const ModelID id);
+
     ModelID     AddModel(BasicModel&& model);
     BasicModel& AddEmptyModel();
 
+    // models live in a slab pool so a reference to a model stays valid while
+    // others are added; a handle is generation-checked so it can be kept by
+    // other systems and resolved later (nullptr if the slot is released)
+    SlabHandle  GetModelHandle  (const ModelID id) const;
+    BasicModel* GetModelByHandle(const SlabHandle handle);
+
     void        GetModelsByIDs  (const ModelID* ids, const size numModels, cvector<const BasicModel*>& outModels);
+    // a model which isn't loaded (yet) is replaced with the placeholder (idx == 0)
     BasicModel& GetModelByID    (const ModelID id);
     BasicModel& GetModelByName  (const char* name);
     ModelID     GetModelIdByName(const char* name);
 
     void        GetModelsNamesList(cvector<ModelName>& names);
 
+    // video memory of vertex/index buffers (a buffer of the geometry pool is counted once)
+    uint64      GetGpuMemoryUsage() const;
+    uint64      GetTerrainGpuMemoryUsage() const;
+
     inline Terrain&             GetTerrain()         { return terrain_; }
     inline TerrainGeomipmapped& GetTerrainGeomip()   { return terrainGeomip_; }
     inline SkyModel&            GetSky()             { return sky_; }
 
     inline int                  GetNumAssets() const { return (int)std::ssize(ids_); }
+    inline const BasicModel&    GetModelByIdx(const index idx) const { return ModelAt(idx); }
 
     
 private:
-    cvector<ModelID>    ids_;
-    cvector<BasicModel> models_;
+    struct PendingModel
+    {
+        // a model which is loaded by a job right into its slot of the pool
+        ModelLoader       loader;         // keeps the mapped file until buffers are created
+        SlabHandle        handle;
+        BasicModel*       pModel     = nullptr;
+        ModelID           expectedID = INVALID_MODEL_ID;
+        std::string       path;
+        std::atomic<bool> isDone     = false;
+        bool              isLoaded   = false;
+        bool              hasBuffers = false;
+        bool              isReload   = false;   // replaces the model by expectedID
+    };
+
+    void    StartLoading(PendingModel* pPending);
+    uint64  HashMaterials(const BasicModel& model) const;
+    void    PublishModel(PendingModel& pending);
+    void    ReplaceModel(PendingModel& pending);
+    ModelID InsertModel (const SlabHandle handle);
+
+    inline BasicModel&       ModelAt(const index idx)       { return models_[handles_[idx]]; }
+    inline const BasicModel& ModelAt(const index idx) const { return models_[handles_[idx]]; }
+
+private:
+    cvector<ModelID>       ids_;            // SORTED
+    cvector<SlabHandle>    handles_;        // of models in the pool (parallel to ids_)
+    SlabPool<BasicModel>   models_;
 
     SkyModel            sky_;
     Terrain             terrain_;
     TerrainGeomipmapped terrainGeomip_;
 
+    cvector<PendingModel*> pendingModels_;  // are being loaded (in order of the storage file)
+    std::unordered_map<ModelID, std::string> modelPaths_;  // of loaded models (relatively to the assets dir)
+    std::unordered_map<uint64, ModelID>      sharedModels_; // procedural models by hash of their params
+    JobCounter          loadCounter_;
+
+    // dirty tracking for differential saving
+    std::unordered_map<ModelID, uint64> savedMaterialsHashes_;  // hash of materials of each model at the last save
+    cvector<ModelID>    dirtyModels_;
+    std::string         savedStorageData_;                      // content of the storage file at the last save
+
+    ID3D11Device*       pDevice_ = nullptr;
+
     static ModelMgr*    pInstance_;
     static ModelID      lastModelID_;
 };
@@ -11,7 +11,7 @@ ModelStorageSerializer::ModelStorageSerializer()
 ///////////////////////////////////////////////////////////
 
 void ModelStorageSerializer::WriteHeader(
-    std::ofstream& fout,
+    std::ostream& fout,
     const size numModels,
     const ModelID lastModelID)
 {
@@ -26,7 +26,7 @@ void ModelStorageSerializer::WriteHeader(
 ///////////////////////////////////////////////////////////
 
 void ModelStorageSerializer::WriteModelsInfo(
-    std::ofstream& fout,
+    std::ostream& fout,
     const ModelID* ids,
     const std::string* paths,
     const size numModels)
@@ -34,7 +34,7 @@ void ModelStorageSerializer::WriteModelsInfo(
     assert((ids != nullptr) && (paths != nullptr) && (numModels > 0) && "invalid input args");
 
     // write info about this model into the data file
-    for (index i = 1; i < numModels; ++i)
+    for (index i = 0; i < numModels; ++i)
     {
         fout << ids[i] << ' ' << paths[i] << '\n';
     }
@@ -1,6 +1,6 @@
 #pragma once
 #include <Types.h>
-#include <fstream>
+#include <ostream>
 #include <string>
 
 namespace Core
@@ -12,7 +12,7 @@ public:
 	ModelStorageSerializer();
 
 	void WriteHeader(
-		std::ofstream& fout, 
+		std::ostream& fout, 
 		const size numModels, 
 		const ModelID lastModelID);
 
@@ -22,7 +22,7 @@ public:
 		const size numNames);
 
 	void WriteModelsInfo(
-		std::ofstream& fout,
+		std::ostream& fout,
 		const ModelID* ids, 
 		const std::string* paths, 
 		const size numModels);
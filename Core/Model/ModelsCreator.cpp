@@ -15,9 +15,17 @@
 #include "../Model/BasicModel.h"
 #include "../Terrain/Terrain.h"
 #include "ModelImporter.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "ModelExporter.h"
+#include "DerivedDataCache.h"
 
 #include "../Model/ModelMgr.h"
 #include "../Texture/TextureMgr.h"
+#include <TextTokenizer.h>
+
+#include <initializer_list>
 
 using namespace DirectX;
 
@@ -35,26 +43,17 @@ ModelID ModelsCreator::CreateFromDE3D(ID3D11Device* pDevice, const char* modelPa
 {
     // load model's data from a file in the INTERNAL format .de3d
 
-    char relativePath[256]{ '\0' };             // path relative to the working directory
-    strcat(relativePath, g_RelPathAssetsDir);
-    strcat(relativePath, modelPath);
-
     try
     {
         ModelLoader loader;
         BasicModel model;
 
-        // load a model from file
-        const bool isLoaded = loader.Load(relativePath, model);
-        if (!isLoaded)
-        {
-            sprintf(g_String, "can't load model from file: %s", relativePath);
-            LogErr(g_String);
+        if (!LoadFromDE3D(modelPath, loader, model))
             return INVALID_MODEL_ID;
-        }
 
-        // init vertex/index buffers
-        model.InitializeBuffers(pDevice);
+        // init vertex/index buffers (directly from the mapped file if it is of v2)
+        loader.InitializeBuffers(pDevice, model);
+        loader.SetupMaterials(model);
 
         // add model into the model manager
         ModelID id = id = model.id_;
@@ -65,7 +64,7 @@ ModelID ModelsCreator::CreateFromDE3D(ID3D11Device* pDevice, const char* modelPa
     catch (EngineException& e)
     {
         LogErr(e);
-        sprintf(g_String, "can't load model by path: %s", relativePath);
+        sprintf(g_String, "can't load model by path: %s", modelPath);
         LogErr(g_String);
         return INVALID_MODEL_ID;
     }
@@ -73,31 +72,146 @@ ModelID ModelsCreator::CreateFromDE3D(ID3D11Device* pDevice, const char* modelPa
 
 ///////////////////////////////////////////////////////////
 
+bool ModelsCreator::LoadFromDE3D(
+    const char* modelPath,
+    ModelLoader& loader,
+    BasicModel& outModel)
+{
+    // load model's data (and the CPU-side data which is built by it)
+    // from a file in the INTERNAL format .de3d
+    //
+    // input: modelPath -- path relatively to the assets dir (it's prefixed by the loader)
+
+    try
+    {
+        // load a model from file
+        const bool isLoaded = loader.Load(modelPath, outModel);
+        if (!isLoaded)
+        {
+            sprintf(g_String, "can't load model from file: %s%s", g_RelPathAssetsDir, modelPath);
+            LogErr(g_String);
+            return false;
+        }
+
+        // files exported before triangle BVHs don't have it cached
+        if (outModel.bvh_.IsEmpty())
+            outModel.BuildTriangleBVH();
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        sprintf(g_String, "can't load model by path: %s%s", g_RelPathAssetsDir, modelPath);
+        LogErr(g_String);
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 ModelID ModelsCreator::ImportFromFile(
     ID3D11Device* pDevice,
     const char* modelPath)
+{
+    return ImportFromFile(pDevice, modelPath, ModelImportSettings());
+}
+
+///////////////////////////////////////////////////////////
+
+ModelID ModelsCreator::ImportFromFile(
+    ID3D11Device* pDevice,
+    const char* modelPath,
+    const ModelImportSettings& settings)
 {
     // create a model by loading its vertices/indices/texture data/etc. from a file
     try
     {
+        BasicModel&   model = g_ModelMgr.AddEmptyModel();
+        const ModelID id    = model.id_;
+
+        // if this source file was already imported with the same settings
+        // we just load the derived .de3d file
+        char   derivedPath[64]{ '\0' };
+        uint64 key    = 0;
+        bool   hasKey = DerivedDataCache::ComputeKey(modelPath, settings, key);
+
+        if (hasKey)
+        {
+            ModelExporter exporter;
+            DerivedDataCache::GetDerivedPath(key, derivedPath, sizeof(derivedPath));
+
+            if (exporter.IsUpToDate(derivedPath))
+            {
+                ModelLoader loader;
+
+                if (LoadFromDE3D(derivedPath, loader, model))
+                {
+                    loader.InitializeBuffers(pDevice, model);
+                    loader.SetupMaterials(model);
+
+                    FileSys::GetFileStem(modelPath, g_String);
+                    model.SetName(g_String);
+                    model.id_   = id;
+                    model.type_ = eModelType::Imported;
+
+                    LogMsgf("model import: %s: is restored from the derived data: %s", modelPath, derivedPath);
+                    return id;
+                }
+
+                // the derived file is broken: do a full import
+                model.Shutdown();
+                model.id_ = id;
+            }
+        }
+
         ModelImporter importer;
-        BasicModel& model = g_ModelMgr.AddEmptyModel();
 
         // import model from a file by path
-        importer.LoadFromFile(pDevice, model, modelPath);
+        importer.LoadFromFile(pDevice, model, modelPath, settings);
+
+        // reorder triangles/vertices for the vertex cache, overdraw and fetch
+        // (before LODs/BVH so they are built over the optimized order)
+        if (settings.optimizeMesh)
+        {
+            MeshOptimizer optimizer;
+            const MeshOptimizer::Stats stats = optimizer.Optimize(model);
+            LogMsgf("mesh optimizer: %s: ACMR %.3f -> %.3f (overdraw clusters: %d)",
+                    modelPath, stats.acmrBefore, stats.acmrAfter, stats.numClusters);
+        }
 
-        // initialize vb/ib
-        model.InitializeBuffers(pDevice);
-        
         model.ComputeSubsetsAABB();
         model.ComputeModelAABB();
 
+        // generate simplified index sets (levels of detail) for far distances
+        MeshSimplifier simplifier;
+        simplifier.GenerateLods(model, settings.numLods);
+
+        // split big meshes into meshlets so they are culled on GPU by parts
+        if (settings.buildMeshlets)
+        {
+            MeshletBuilder meshletBuilder;
+            meshletBuilder.Build(model);
+        }
+
+        // build a triangle BVH for picking/ray casts
+        model.BuildTriangleBVH();
+
+        // initialize vb/ib
+        model.InitializeBuffers(pDevice);
+
         // set a name and type for the model
         FileSys::GetFileStem(modelPath, g_String);
 
         model.SetName(g_String);
         model.type_ = eModelType::Imported;
 
+        // store the result so the next import of this source file skips the pipeline
+        if (hasKey && DerivedDataCache::IsCacheable(model))
+        {
+            ModelExporter exporter;
+            exporter.ExportIntoDE3D(pDevice, model, derivedPath);
+        }
 
         return model.id_;
     }
@@ -111,6 +225,43 @@ ModelID ModelsCreator::ImportFromFile(
 }
 
 
+//---------------------------------------------------------
+// Desc:  a key of the shared procedural model: FNV-1a hash of its type and params
+//        (integer params are passed as floats, they are exact for such values)
+//---------------------------------------------------------
+static uint64 MakeSharedModelKey(const eModelType type, std::initializer_list<float> params)
+{
+    uint64 hash = 14695981039346656037ULL;
+
+    auto hashBytes = [&hash](const void* pData, const size_t numBytes)
+    {
+        const uint8* bytes = (const uint8*)pData;
+
+        for (size_t i = 0; i < numBytes; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    const uint32 typeID = (uint32)type;
+    hashBytes(&typeID, sizeof(typeID));
+
+    for (const float param : params)
+        hashBytes(&param, sizeof(param));
+
+    return hash;
+}
+
+//---------------------------------------------------------
+// Desc:  find a shared model which was created with the same key before
+//---------------------------------------------------------
+static ModelID FindSharedModel(const bool isShared, const uint64 key)
+{
+    return (isShared) ? g_ModelMgr.GetSharedModel(key) : INVALID_MODEL_ID;
+}
+
+
 // ************************************************************************************
 //                                 HELPERS API
 // ************************************************************************************
@@ -132,6 +283,7 @@ ModelID ModelsCreator::CreatePlane(
 
     model.ComputeSubsetsAABB();
     model.ComputeModelAABB();
+    model.BuildTriangleBVH();
 
     // setup name and type
     sprintf(model.name_, "plane_%ud", model.GetID());
@@ -166,10 +318,16 @@ ModelID ModelsCreator::CreateBoundingLineBox(ID3D11Device* pDevice)
 
 ///////////////////////////////////////////////////////////
 
-ModelID ModelsCreator::CreateCube(ID3D11Device* pDevice)
+ModelID ModelsCreator::CreateCube(ID3D11Device* pDevice, const bool isShared)
 {
     // THIS FUNCTION creates a cube model and stores it into the storage;
 
+    const uint64  key      = MakeSharedModelKey(eModelType::Cube, {});
+    const ModelID sharedID = FindSharedModel(isShared, key);
+
+    if (sharedID != INVALID_MODEL_ID)
+        return sharedID;
+
     GeometryGenerator geoGen;
     BasicModel& model = g_ModelMgr.AddEmptyModel();
     
@@ -181,11 +339,15 @@ ModelID ModelsCreator::CreateCube(ID3D11Device* pDevice)
 
     model.ComputeSubsetsAABB();
     model.ComputeModelAABB();
+    model.BuildTriangleBVH();
 
     // setup name and type
     sprintf(model.name_, "cube_%ud", model.GetID());
     model.type_ = eModelType::Cube;
 
+    if (isShared)
+        g_ModelMgr.AddSharedModel(key, model.id_);
+
     return model.id_;
 }
 
@@ -255,12 +417,23 @@ ModelID ModelsCreator::CreateSkyDome(
 
 ModelID ModelsCreator::CreateSphere(
     ID3D11Device* pDevice,
-    const MeshSphereParams& params)
+    const MeshSphereParams& params,
+    const bool isShared)
 {
     // generate a new sphere model by input params
     // 
     // input:  geometry params for a mesh generation;
-    // return: created model ID
+    // return: created (or shared) model ID
+
+    const uint64  key = MakeSharedModelKey(eModelType::Sphere, {
+        params.radius_,
+        (float)params.sliceCount_,
+        (float)params.stackCount_ });
+
+    const ModelID sharedID = FindSharedModel(isShared, key);
+
+    if (sharedID != INVALID_MODEL_ID)
+        return sharedID;
 
     GeometryGenerator geoGen;
     BasicModel& model = g_ModelMgr.AddEmptyModel();
@@ -279,11 +452,15 @@ ModelID ModelsCreator::CreateSphere(
 
     model.SetSubsetAABB(0, aabb);
     model.SetModelAABB(aabb);
+    model.BuildTriangleBVH();
 
     // setup name and type
     sprintf(model.name_, "sphere_%ud", model.GetID());
     model.type_ = eModelType::Sphere;
 
+    if (isShared)
+        g_ModelMgr.AddSharedModel(key, model.id_);
+
     return model.id_;
 }
 
@@ -291,12 +468,22 @@ ModelID ModelsCreator::CreateSphere(
 
 ModelID ModelsCreator::CreateGeoSphere(
     ID3D11Device* pDevice,
-    const MeshGeosphereParams& params)
+    const MeshGeosphereParams& params,
+    const bool isShared)
 {
     // generate a new GEOSPHERE model by input params
     // 
     // input:  geometry params for a mesh generation;
-    // return: created model ID
+    // return: created (or shared) model ID
+
+    const uint64  key = MakeSharedModelKey(eModelType::GeoSphere, {
+        params.radius_,
+        (float)params.numSubdivisions_ });
+
+    const ModelID sharedID = FindSharedModel(isShared, key);
+
+    if (sharedID != INVALID_MODEL_ID)
+        return sharedID;
 
     GeometryGenerator geoGen;
     BasicModel& model = g_ModelMgr.AddEmptyModel();
@@ -315,10 +502,14 @@ ModelID ModelsCreator::CreateGeoSphere(
 
     model.SetSubsetAABB(0, aabb);
     model.SetModelAABB(aabb);
+    model.BuildTriangleBVH();
 
     // setup name and type
     sprintf(model.name_, "geo_sphere_%ud", model.GetID());
     model.type_ = eModelType::GeoSphere;
+
+    if (isShared)
+        g_ModelMgr.AddSharedModel(key, model.id_);
     
     return model.id_;
 }
@@ -339,6 +530,7 @@ ModelID ModelsCreator::CreateSkull(ID3D11Device* pDevice)
     // setup the bounding box of the model
     model.ComputeSubsetsAABB();
     model.ComputeModelAABB();
+    model.BuildTriangleBVH();
 
     sprintf(model.name_, "skull_%ud", model.GetID());
     model.type_ = eModelType::Skull;
@@ -352,27 +544,30 @@ void ModelsCreator::ReadSkullMeshFromFile(BasicModel& model, const char* filepat
 {
     try
     {
-        FILE* pFile = nullptr;
+        TextTokenizer tokenizer;
 
-        if ((pFile = fopen(filepath, "r+")) == NULL)
+        if (!tokenizer.Open(filepath))
         {
             sprintf(g_String, "can't load a skull model data file: %s", filepath);
             LogErr(g_String);
             return;
         }
 
-        char buf[64]{ '\0' };
-
-        // ---------------------------------
-
         int numVertices = 0;
         int numTriangles = 0;
         constexpr int numSubsets = 1;      // the model has only one mesh (subset)
 
         // read in number of vertices and triangles
-        fscanf(pFile, "%s %d", buf, &numVertices);
-        fscanf(pFile, "%s %d", buf, &numTriangles);
-        fscanf(pFile, "%s %s %s %s", buf, buf, buf, buf);
+        tokenizer.ReadKey("VertexCount:", numVertices);
+        tokenizer.ReadKey("TriangleCount:", numTriangles);
+        tokenizer.Skip(4);                 // "VertexList (pos, normal) {"
+
+        if (tokenizer.IsFailed() || (numVertices <= 0) || (numTriangles <= 0))
+        {
+            sprintf(g_String, "a skull model data file is corrupted: %s", filepath);
+            LogErr(g_String);
+            return;
+        }
 
         // allocate memory for the vertices and indices data
         model.AllocateMemory(numVertices, numTriangles * 3, numSubsets);
@@ -382,20 +577,22 @@ void ModelsCreator::ReadSkullMeshFromFile(BasicModel& model, const char* filepat
             XMFLOAT3& pos  = model.vertices_[i].position;
             XMFLOAT3& norm = model.vertices_[i].normal;
 
-            fscanf(pFile, "%f %f %f", &pos.x, &pos.y, &pos.z);
-            fscanf(pFile, "%f %f %f", &norm.x, &norm.y, &norm.z);
+            tokenizer.Read(pos.x, pos.y, pos.z);
+            tokenizer.Read(norm.x, norm.y, norm.z);
         }
 
-        // skip separators
-        fscanf(pFile, "%s%s%s", &buf, &buf, &buf);
+        // skip separators: "} TriangleList {"
+        tokenizer.Skip(3);
 
         // read in indices
         for (int i = 0; i < (int)model.numIndices_; ++i)
+            tokenizer.Read(model.indices_[i]);
+
+        if (tokenizer.IsFailed())
         {
-            fscanf(pFile, "%ud", &model.indices_[i]);
+            sprintf(g_String, "a skull model data file is corrupted: %s", filepath);
+            LogErr(g_String);
         }
-      
-        fclose(pFile);
     }
     catch (const std::bad_alloc& e)
     {
@@ -441,12 +638,25 @@ ModelID ModelsCreator::CreatePyramid(
 
 ModelID ModelsCreator::CreateCylinder(
     ID3D11Device* pDevice,
-    const MeshCylinderParams& params)
+    const MeshCylinderParams& params,
+    const bool isShared)
 {
     // generate new cylinder model by input params
     // 
     // input:  (if passed NULL then default) geometry params for a mesh generation;
-    // return: created model ID
+    // return: created (or shared) model ID
+
+    const uint64  key = MakeSharedModelKey(eModelType::Cylinder, {
+        params.bottomRadius_,
+        params.topRadius_,
+        params.height_,
+        (float)params.sliceCount_,
+        (float)params.stackCount_ });
+
+    const ModelID sharedID = FindSharedModel(isShared, key);
+
+    if (sharedID != INVALID_MODEL_ID)
+        return sharedID;
 
     GeometryGenerator geoGen;
     BasicModel& model = g_ModelMgr.AddEmptyModel();
@@ -465,11 +675,15 @@ ModelID ModelsCreator::CreateCylinder(
 
     model.SetSubsetAABB(0, aabb);
     model.SetModelAABB(aabb);
+    model.BuildTriangleBVH();
 
     // setup name and type
     sprintf(model.name_, "cylinder_%ud", model.GetID());
     model.type_ = eModelType::Cylinder;
 
+    if (isShared)
+        g_ModelMgr.AddSharedModel(key, model.id_);
+
     return model.id_;
 }
 
@@ -528,7 +742,7 @@ void GenerateHeightsForTerrainGrid(BasicModel& grid)
 
     // after creation of heights we compute tangent for each vertex
     GeometryGenerator geoGen;
-    geoGen.ComputeTangents(grid.vertices_, grid.indices_, grid.numIndices_);
+    geoGen.ComputeTangents(grid.vertices_, grid.numVertices_, grid.indices_, grid.numIndices_);
 }
 
 ///////////////////////////////////////////////////////////
@@ -651,13 +865,12 @@ bool TerrainInitHeight(TerrainGeomipmapped& terrain, const TerrainConfig& terrai
 
 //---------------------------------------------------------
 // Desc:   generate terrain's tile map or load it from file
+//         (a .dds texture map is loaded later by the texture manager)
 // Args:   - terrain:    actual terrain's class
 //         - terrainCfg: container for different configs for terrain
 //---------------------------------------------------------
 bool TerrainInitTileMap(TerrainGeomipmapped& terrain, const TerrainConfig& terrainCfg)
 {
-    bool result = false;
-
     // generate new texture map 
     if (terrainCfg.generateTextureMap)
     {
@@ -668,13 +881,104 @@ bool TerrainInitTileMap(TerrainGeomipmapped& terrain, const TerrainConfig& terra
         terrain.LoadTile(HIGHEST_TILE, terrainCfg.pathHighestTile);
 
         // generate texture map based on loaded tiles and height map
-        result = terrain.GenerateTextureMap(terrainCfg.textureMapSize);
+        return terrain.GenerateTextureMap(terrainCfg.textureMapSize);
+    }
+
+    char extension[8]{ '\0' };
+    FileSys::GetFileExt(terrainCfg.pathTextureMap, extension);
+
+    if (strcmp(extension, ".dds") == 0)
+        return true;
+
+    // load texture map from file
+    return terrain.LoadTextureMap(terrainCfg.pathTextureMap);
+}
+
+//---------------------------------------------------------
+// Desc:   create a texture from raw data or recreate the existing one
+//         in place (when the terrain is reloaded) so its ID stays the same
+//---------------------------------------------------------
+static TexID CreateOrRecreateTexture(
+    const TexID id,
+    const char* name,
+    const uint8* data,
+    const uint width,
+    const uint height,
+    const int bpp,
+    const bool mipMapped)
+{
+    if (id == INVALID_TEXTURE_ID)
+        return g_TextureMgr.CreateTextureFromRawData(name, data, width, height, bpp, mipMapped);
+
+    Texture& tex = g_TextureMgr.GetTexByID(id);
+    g_TextureMgr.RecreateTextureFromRawData(name, data, width, height, bpp, mipMapped, tex);
+
+    return id;
+}
 
-        Image& tileMap = terrain.texture_;
-        constexpr bool mipMapped = true;
+//---------------------------------------------------------
+// Desc:   the same but the texture is block compressed on upload (the generated
+//         maps are 4-8 times smaller in VRAM); if saveDir isn't empty the
+//         compressed texture is also saved there by the file name
+//---------------------------------------------------------
+static TexID CreateOrRecreateCompressedTexture(
+    const TexID id,
+    const char* name,
+    const uint8* data,
+    const uint width,
+    const uint height,
+    const int bpp,
+    const bool mipMapped,
+    const char* saveDir,
+    const char* saveFilename)
+{
+    char savePath[128]{ '\0' };
+
+    if (!StrHelper::IsEmpty(saveDir))
+        snprintf(savePath, sizeof(savePath), "%s%s", saveDir, saveFilename);
+
+    const TexID texID = g_TextureMgr.CreateCompressedFromRawData(name, data, width, height, bpp, mipMapped, savePath, id);
+
+    // an uncompressed texture is better than no texture at all
+    if (texID == INVALID_TEXTURE_ID)
+        return CreateOrRecreateTexture(id, name, data, width, height, bpp, mipMapped);
+
+    return texID;
+}
+
+//---------------------------------------------------------
+// Desc:   create a texture resource for the terrain's tile map
+// Args:   - terrain:    actual terrain's class
+//         - terrainCfg: container for different configs for terrain
+//---------------------------------------------------------
+bool TerrainCreateTileMapTexture(TerrainGeomipmapped& terrain, const TerrainConfig& terrainCfg)
+{
+    if (!terrainCfg.generateTextureMap)
+    {
+        char extension[8]{ '\0' };
+        FileSys::GetFileExt(terrainCfg.pathTextureMap, extension);
+
+        // the loaded (not .dds) texture map is already in memory
+        return (strcmp(extension, ".dds") == 0) ? terrain.LoadTextureMap(terrainCfg.pathTextureMap) : true;
+    }
 
-        // create texture resource
-        const TexID tileMapTexId = g_TextureMgr.CreateTextureFromRawData(
+    Image& tileMap = terrain.texture_;
+    constexpr bool mipMapped = true;
+
+    // create texture resource
+    const TexID tileMapTexId = (terrainCfg.compressGeneratedMaps) ?
+        CreateOrRecreateCompressedTexture(
+            tileMap.GetID(),
+            "terrain_tile_map",
+            tileMap.GetData(),
+            tileMap.GetWidth(),
+            tileMap.GetHeight(),
+            tileMap.GetBPP(),
+            mipMapped,
+            terrainCfg.pathSaveCompressedMaps,
+            "generated_texture_map.dds") :
+        CreateOrRecreateTexture(
+            tileMap.GetID(),
             "terrain_tile_map",
             tileMap.GetData(),
             tileMap.GetWidth(),
@@ -682,26 +986,17 @@ bool TerrainInitTileMap(TerrainGeomipmapped& terrain, const TerrainConfig& terra
             tileMap.GetBPP(),
             mipMapped);
 
-        if (tileMapTexId)
-        {
-            LogDbg("terrain_tile_map texture is created");
-            tileMap.SetID(tileMapTexId);
-        }
-        else
-        {
-            LogErr("can't create texture resource for terrain's tile map");
-            result = false;
-        }
-
-        //terrain.SaveTextureMap(terrainCfg.pathSaveTextureMap);
-    }
-    // load texture map from file
-    else
+    if (!tileMapTexId)
     {
-        result = terrain.LoadTextureMap(terrainCfg.pathTextureMap);
+        LogErr("can't create texture resource for terrain's tile map");
+        return false;
     }
 
-    return result;
+    LogDbg("terrain_tile_map texture is created");
+    tileMap.SetID(tileMapTexId);
+
+    //terrain.SaveTextureMap(terrainCfg.pathSaveTextureMap);
+    return true;
 }
 
 //---------------------------------------------------------
@@ -737,33 +1032,48 @@ bool TerrainInitLightMap(TerrainGeomipmapped& terrain, const TerrainConfig& terr
         terrain.SaveLightMap(terrainCfg.pathSaveLightMap);
     }
 
-    // if we successfully loaded/generated lightmap's raw data
-    if (result)
-    {
-        LightmapData& lightmap = terrain.lightmap_;
+    return result;
+}
 
-        // create texture resource
-        const TexID lightmapTexId = g_TextureMgr.CreateTextureFromRawData(
+//---------------------------------------------------------
+// Desc:   create a texture resource for loaded/generated lightmap's raw data
+// Args:   - terrain:    actual terrain's class
+//         - terrainCfg: container for different configs for terrain
+//---------------------------------------------------------
+bool TerrainCreateLightMapTexture(TerrainGeomipmapped& terrain, const TerrainConfig& terrainCfg)
+{
+    LightmapData& lightmap = terrain.lightmap_;
+
+    // create texture resource (a generated lightmap is compressed into BC4)
+    const TexID lightmapTexId = (terrainCfg.compressGeneratedMaps && terrainCfg.generateLightMap) ?
+        CreateOrRecreateCompressedTexture(
+            lightmap.id,
+            "terrain_light_map",
+            lightmap.pData,
+            lightmap.size,
+            lightmap.size,
+            8,             // bits per pixel
+            false,
+            terrainCfg.pathSaveCompressedMaps,
+            "generated_light_map.dds") :
+        CreateOrRecreateTexture(
+            lightmap.id,
             "terrain_light_map",
             lightmap.pData,
             lightmap.size,
             lightmap.size,
-            8,                 // bits per pixel
+            8,             // bits per pixel
             false);
 
-        if (lightmapTexId)
-        {
-            LogDbg("terrain_light_map texture is created");
-            terrain.lightmap_.id = lightmapTexId;
-        }
-        else
-        {
-            LogErr("can't create texture resource for terrain's lightmap");
-            result = false;
-        }
+    if (!lightmapTexId)
+    {
+        LogErr("can't create texture resource for terrain's lightmap");
+        return false;
     }
 
-    return result;
+    LogDbg("terrain_light_map texture is created");
+    terrain.lightmap_.id = lightmapTexId;
+    return true;
 }
 
 //---------------------------------------------------------
@@ -776,19 +1086,55 @@ bool ModelsCreator::CreateTerrainGeomipmapped(
     ID3D11Device* pDevice,
     const char* configFilename)
 {
+    TerrainConfig terrainCfg;
+
+    return GenerateTerrainGeomipmapped(configFilename, terrainCfg) &&
+           UploadTerrainGeomipmapped(pDevice, terrainCfg);
+}
+
+//---------------------------------------------------------
+// Desc:   generate/load all the CPU side data of the geomipmapped terrain:
+//         heights, tile map, light map, detail map and the grid of LODs;
+//         neither the device nor the texture manager is used here so
+//         it can be executed by a worker thread
+// Args:   - configFilename: path to file with params for terrain
+//         - outCfg:         params of the terrain (are needed for uploading)
+//         - sizeOverride:   width/depth instead of the config's ones (0 - no override)
+//---------------------------------------------------------
+bool ModelsCreator::GenerateTerrainGeomipmapped(
+    const char* configFilename,
+    TerrainConfig& outCfg,
+    const int sizeOverride)
+{
+    MEM_TAG_SCOPE(MEM_TAG_TERRAIN);
+
     if (StrHelper::IsEmpty(configFilename))
     {
         LogErr("intput path to terrain config file is empty!");
         return false;
     }
 
-    TerrainGeomipmapped& terrain = g_ModelMgr.GetTerrainGeomip();
+    TerrainGeomipmapped& terrain    = g_ModelMgr.GetTerrainGeomip();
+    TerrainConfig&       terrainCfg = outCfg;
     GeometryGenerator    geoGen;
-    TerrainConfig        terrainCfg;
 
     // load from the file meta-info about the terrain 
     terrain.LoadSetupFile(configFilename, terrainCfg);
 
+    // a loaded height map has its own size so only generated heights can be resized
+    if (sizeOverride > 0)
+    {
+        if (terrainCfg.generateHeights)
+        {
+            terrainCfg.width = sizeOverride;
+            terrainCfg.depth = sizeOverride;
+        }
+        else
+        {
+            LogErr("terrain heights are loaded from the file so its size can't be changed");
+        }
+    }
+
     const int width = terrainCfg.width;
     const int depth = terrainCfg.depth;
 
@@ -839,6 +1185,50 @@ bool ModelsCreator::CreateTerrainGeomipmapped(
         exit(-1);
     }
 
+#if 0
+    ComputeAveragedNormals(
+        terrain.vertices_,
+        terrain.indices_,
+        terrain.numVertices_,
+        terrain.numIndices_);
+#endif
+
+    // build the static grid of vertices and indices of all the LODs
+    if (!terrain.InitGeomipmapping(terrainCfg.patchSize))
+    {
+        LogErr("can't initialize the terrain's geomipmapping");
+        exit(-1);
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   create GPU resources (textures, buffers) of the generated terrain
+//         NOTE: the texture manager isn't thread-safe so call it from the main thread
+// Args:   - pDevice:        ptr to DirectX11 device
+//         - terrainCfg:     params of the generated terrain
+//---------------------------------------------------------
+bool ModelsCreator::UploadTerrainGeomipmapped(
+    ID3D11Device* pDevice,
+    const TerrainConfig& terrainCfg)
+{
+    TerrainGeomipmapped& terrain = g_ModelMgr.GetTerrainGeomip();
+
+    const int width = terrainCfg.width;
+    const int depth = terrainCfg.depth;
+
+    if (!TerrainCreateTileMapTexture(terrain, terrainCfg))
+    {
+        LogErr("can't initialize the terrain's tile map");
+        exit(-1);
+    }
+
+    if (!TerrainCreateLightMapTexture(terrain, terrainCfg))
+    {
+        LogErr("can't initialize the terrain's light map");
+        exit(-1);
+    }
 
     // ------------------------------------------
     // Create DirectX textures for the terrain
@@ -847,7 +1237,8 @@ bool ModelsCreator::CreateTerrainGeomipmapped(
    
     Image&         detailMap = terrain.detailMap_;
    
-    const TexID detailMapTexId = g_TextureMgr.CreateTextureFromRawData(
+    const TexID detailMapTexId = CreateOrRecreateTexture(
+        detailMap.GetID(),
         "terrain_detail_map",
         detailMap.GetData(),
         detailMap.GetWidth(),
@@ -860,28 +1251,39 @@ bool ModelsCreator::CreateTerrainGeomipmapped(
 
   
     detailMap.SetID(detailMapTexId);
-   
-#if 0
-    ComputeAveragedNormals(
-        terrain.vertices_,
-        terrain.indices_,
-        terrain.numVertices_,
-        terrain.numIndices_);
-#endif
-
-    terrain.ClearMemory();
-    terrain.AllocateMemory(1000000, 1);
-    UINT indices[1]{ 0 };
 
     // initialize vertex/index buffers
     terrain.InitBuffers(
         pDevice,
         terrain.vertices_,
-        indices, //terrain.indices_,
+        terrain.indices_,
         terrain.numVertices_,
-        1);      // terrain.numIndices_);
+        terrain.numIndices_);
+
+    // the tessellated terrain: control points of the patches grid and
+    // the height map texture (is sampled in the domain shader)
+    if (terrain.InitTessellation(pDevice))
+    {
+        Image& heightMap = terrain.heightMap_;
 
-    terrain.InitGeomipmapping(terrainCfg.patchSize);
+        // a single channel texture without mipmaps: heights are sampled
+        // from the top level only and only by the red channel
+        if (terrain.heightMapTexID_ == INVALID_TEXTURE_ID)
+        {
+            terrain.heightMapTexID_ = g_TextureMgr.CreateGrayTexture(
+                "terrain_height_map",
+                heightMap.GetData(),
+                heightMap.GetWidth(),
+                heightMap.GetHeight());
+        }
+        else
+        {
+            Texture heightTex;
+
+            if (heightTex.InitializeGray(pDevice, "terrain_height_map", heightMap.GetData(), heightMap.GetWidth(), heightMap.GetHeight()))
+                g_TextureMgr.ReplaceTexture(terrain.heightMapTexID_, std::move(heightTex));
+        }
+    }
 
     // compute the bounding box of the terrain
     const DirectX::XMFLOAT3 center = { 0,0,0 };
@@ -897,4 +1299,39 @@ bool ModelsCreator::CreateTerrainGeomipmapped(
     return true;
 }
 
+//---------------------------------------------------------
+// Desc:   regenerate the geomipmapped terrain from its config and maps and
+//         upload it again; textures of the terrain are recreated in place
+// Args:   - pDevice:        ptr to DirectX11 device
+//         - configFilename: path to file with params for terrain
+//---------------------------------------------------------
+bool ModelsCreator::ReloadTerrainGeomipmapped(
+    ID3D11Device* pDevice,
+    const char* configFilename)
+{
+    TerrainGeomipmapped& terrain = g_ModelMgr.GetTerrainGeomip();
+    TerrainConfig        terrainCfg;
+
+    // maps are loaded/generated from scratch so remember IDs of their textures
+    const TexID tileMapID   = terrain.texture_.GetID();
+    const TexID detailMapID = terrain.detailMap_.GetID();
+    const TexID lightMapID  = terrain.lightmap_.id;
+
+    if (!GenerateTerrainGeomipmapped(configFilename, terrainCfg))
+        return false;
+
+    // a loaded (.dds) tile map is a texture by itself: it is reloaded as a texture
+    if (terrainCfg.generateTextureMap)
+        terrain.texture_.SetID(tileMapID);
+
+    terrain.detailMap_.SetID(detailMapID);
+    terrain.lightmap_.id = lightMapID;
+
+    if (!UploadTerrainGeomipmapped(pDevice, terrainCfg))
+        return false;
+
+    LogMsgf("terrain is hot reloaded: %s", configFilename);
+    return true;
+}
+
 } // namespace Core
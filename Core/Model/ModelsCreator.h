@@ -15,13 +15,25 @@
 namespace Core
 {
 
+class ModelLoader;
+struct ModelImportSettings;
+struct TerrainConfig;
+
+
 class ModelsCreator
 {
 public:
 	ModelsCreator();
 
 	ModelID CreateFromDE3D(ID3D11Device* pDevice, const char* modelPath);
+
+	// load (without creation of GPU buffers and adding into the model manager)
+	// a model from the .de3d file; can be called by any thread
+	bool LoadFromDE3D(const char* modelPath, ModelLoader& loader, BasicModel& outModel);
+	// import a model by assimp (or reuse a derived .de3d file of the same source
+	// file and import settings which was produced by some previous import)
 	ModelID ImportFromFile(ID3D11Device* pDevice, const char* modelPath);
+	ModelID ImportFromFile(ID3D11Device* pDevice, const char* modelPath, const ModelImportSettings& settings);
 
 	// create a model according to its type and with default params
 	ModelID Create(ID3D11Device* pDevice, const eModelType type);
@@ -29,12 +41,17 @@ public:
 	ModelID CreateSkyDome(ID3D11Device* pDevice, const float radius, const int sliceCount, const int stackCount);
 	ModelID CreatePlane(ID3D11Device* pDevice, const float width = 1.0f, const float height = 1.0f);
 	ModelID CreateBoundingLineBox(ID3D11Device* pDevice);
-	ModelID CreateCube(ID3D11Device* pDevice);
+
+    // procedural primitives are shared: a request with the same type and params
+    // returns the same model (and GPU buffers) so entities vary it by the scale
+    // of their transform; pass isShared == false to get a unique model which
+    // can be modified (e.g. its material or geometry)
+	ModelID CreateCube(ID3D11Device* pDevice, const bool isShared = true);
 	
-	ModelID CreateSphere(ID3D11Device* pDevice, const MeshSphereParams& params);
-	ModelID CreateGeoSphere(ID3D11Device* pDevice, const MeshGeosphereParams& params);
+	ModelID CreateSphere(ID3D11Device* pDevice, const MeshSphereParams& params, const bool isShared = true);
+	ModelID CreateGeoSphere(ID3D11Device* pDevice, const MeshGeosphereParams& params, const bool isShared = true);
 
-	ModelID CreateCylinder(ID3D11Device* pDevice, const MeshCylinderParams& params);
+	ModelID CreateCylinder(ID3D11Device* pDevice, const MeshCylinderParams& params, const bool isShared = true);
 	ModelID CreateSkull(ID3D11Device* pDevice);
 	ModelID CreatePyramid(ID3D11Device* pDevice, const MeshPyramidParams& params = NULL);
 	ModelID CreateGrid(ID3D11Device* pDevice, const u32 width, const u32 depth);
@@ -45,6 +62,16 @@ public:
     void CreateSkySphere          (ID3D11Device* pDevice, const float radius, const int sliceCount, const int stackCount);
     bool CreateTerrain            (ID3D11Device* pDevice, const char* configFilename);
     bool CreateTerrainGeomipmapped(ID3D11Device* pDevice, const char* configFilename);
+
+    // the geomipmapped terrain in two steps: CPU data is generated by any thread
+    // and then GPU resources are created by the main thread
+    // (sizeOverride: a width/depth of 2^n+1 instead of the config's one if heights are generated)
+    bool GenerateTerrainGeomipmapped(const char* configFilename, TerrainConfig& outCfg, const int sizeOverride = 0);
+    bool UploadTerrainGeomipmapped  (ID3D11Device* pDevice, const TerrainConfig& cfg);
+
+    // hot reload: generate and upload the terrain again (by the main thread when
+    // the terrain isn't rendered); its textures keep their IDs so the material is valid
+    bool ReloadTerrainGeomipmapped  (ID3D11Device* pDevice, const char* configFilename);
 	
 private:
 	void ReadSkullMeshFromFile(BasicModel& model, const char* filepath);
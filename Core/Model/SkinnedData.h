@@ -0,0 +1,91 @@
+// =================================================================================
+// Filename:     SkinnedData.h
+// Description:  skeletal animation data of a model:
+//
+//               - per vertex: up to 4 bone influences (idxs + unorm8 weights
+//                 which sum up to 255) by the same idxs as BasicModel::vertices_;
+//               - the skeleton: bones in the depth-first order (a parent always
+//                 goes before its children) with offset matrices from the bind
+//                 pose (mesh space) into the bone space;
+//               - clips are baked at import into skinning palettes sampled with
+//                 a fixed rate: for each frame of each clip there is a matrix per
+//                 bone (offset * animated global transform) so the runtime neither
+//                 interpolates keys nor walks the hierarchy; all the frames of all
+//                 the clips go one after another and are uploaded as a single
+//                 animation texture (a row per frame, 3 texels per bone)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <DirectXMath.h>
+
+
+namespace Core
+{
+
+constexpr int   MAX_NUM_BONES          = 256;    // bone idxs of vertices are uint8
+constexpr int   MAX_BONE_INFLUENCES    = 4;
+constexpr int   MAX_NUM_ANIM_FRAMES    = 16384;  // rows of the animation texture (the D3D11 limit)
+constexpr int   ANIM_NAME_LENGTH       = 32;
+constexpr float ANIM_BAKE_FPS          = 30.0f;  // clips are sampled with this rate at import
+
+///////////////////////////////////////////////////////////
+
+struct VertexSkin
+{
+    uint8 boneIdxs[MAX_BONE_INFLUENCES]{ 0 };
+    uint8 weights [MAX_BONE_INFLUENCES]{ 0 };    // unorm8: 255 == 1.0
+};
+
+struct Bone
+{
+    char                name[ANIM_NAME_LENGTH]{ '\0' };
+    int32_t             parentIdx = -1;          // -1: a root
+    DirectX::XMFLOAT4X4 offset;                  // bind pose (mesh space) => bone space
+};
+
+struct AnimClip
+{
+    char   name[ANIM_NAME_LENGTH]{ '\0' };
+    uint32 firstFrame = 0;                       // the first row of the clip in the baked palettes
+    uint32 numFrames  = 0;
+    float  fps        = ANIM_BAKE_FPS;
+    float  duration   = 0;                       // in seconds
+};
+
+// a skinning matrix as 3 rows of the transposed affine matrix
+// (the same layout as the world matrix of instances in shaders)
+struct BoneMatrix
+{
+    DirectX::XMFLOAT4 rows[3];
+};
+
+static_assert(sizeof(VertexSkin) == 8,  "the layout of skin weights is a part of the .de3d format and of the input layout");
+static_assert(sizeof(BoneMatrix) == 48, "the layout of palettes is a part of the .de3d format and of the animation texture");
+
+///////////////////////////////////////////////////////////
+
+struct SkinnedData
+{
+    cvector<VertexSkin> skin;                    // per vertex of the model
+    cvector<Bone>       bones;
+    cvector<AnimClip>   clips;
+    cvector<BoneMatrix> palettes;                // [frame * numBones + bone] of all the clips
+
+    inline bool   IsSkinned()    const { return !skin.empty() && !bones.empty(); }
+    inline uint32 GetNumBones()  const { return (uint32)bones.size(); }
+    inline uint32 GetNumFrames() const { return (bones.empty()) ? 0 : (uint32)(palettes.size() / bones.size()); }
+
+    inline void Clear()
+    {
+        skin.clear();
+        bones.clear();
+        clips.clear();
+        palettes.clear();
+    }
+};
+
+} // namespace Core
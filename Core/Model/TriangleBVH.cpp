@@ -0,0 +1,447 @@
+// =================================================================================
+// Filename:     TriangleBVH.cpp
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "TriangleBVH.h"
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// helpers
+//---------------------------------------------------------
+static inline float SurfaceArea(const XMFLOAT3& min, const XMFLOAT3& max)
+{
+    const float dx = max.x - min.x;
+    const float dy = max.y - min.y;
+    const float dz = max.z - min.z;
+    return 2.0f * (dx*dy + dy*dz + dz*dx);
+}
+
+static inline void Grow(XMFLOAT3& min, XMFLOAT3& max, const XMFLOAT3& pmin, const XMFLOAT3& pmax)
+{
+    min.x = (pmin.x < min.x) ? pmin.x : min.x;
+    min.y = (pmin.y < min.y) ? pmin.y : min.y;
+    min.z = (pmin.z < min.z) ? pmin.z : min.z;
+    max.x = (pmax.x > max.x) ? pmax.x : max.x;
+    max.y = (pmax.y > max.y) ? pmax.y : max.y;
+    max.z = (pmax.z > max.z) ? pmax.z : max.z;
+}
+
+static inline float GetAxis(const XMFLOAT3& v, const int axis)
+{
+    return (&v.x)[axis];
+}
+
+//---------------------------------------------------------
+// Desc:  slab test of the ray against AABB;
+//        returns the entry distance or FLT_MAX if there is no hit closer than maxDist
+//---------------------------------------------------------
+static inline float RayBox(
+    const TriangleBVH::Node& node,
+    const XMFLOAT3& origin,
+    const XMFLOAT3& invDir,
+    const float maxDist)
+{
+    const float tx0 = (node.min.x - origin.x) * invDir.x;
+    const float tx1 = (node.max.x - origin.x) * invDir.x;
+    const float ty0 = (node.min.y - origin.y) * invDir.y;
+    const float ty1 = (node.max.y - origin.y) * invDir.y;
+    const float tz0 = (node.min.z - origin.z) * invDir.z;
+    const float tz1 = (node.max.z - origin.z) * invDir.z;
+
+    float tmin = (tx0 < tx1) ? tx0 : tx1;
+    float tmax = (tx0 < tx1) ? tx1 : tx0;
+
+    const float tyMin = (ty0 < ty1) ? ty0 : ty1;
+    const float tyMax = (ty0 < ty1) ? ty1 : ty0;
+    const float tzMin = (tz0 < tz1) ? tz0 : tz1;
+    const float tzMax = (tz0 < tz1) ? tz1 : tz0;
+
+    tmin = (tyMin > tmin) ? tyMin : tmin;
+    tmin = (tzMin > tmin) ? tzMin : tmin;
+    tmax = (tyMax < tmax) ? tyMax : tmax;
+    tmax = (tzMax < tmax) ? tzMax : tmax;
+
+    if ((tmax >= tmin) && (tmax > 0.0f) && (tmin < maxDist))
+        return tmin;
+
+    return FLT_MAX;
+}
+
+//---------------------------------------------------------
+// Desc:  Moller-Trumbore ray/triangle test (two-sided)
+//---------------------------------------------------------
+static inline bool RayTriangle(
+    const XMFLOAT3& o,
+    const XMFLOAT3& d,
+    const XMFLOAT3& v0,
+    const XMFLOAT3& v1,
+    const XMFLOAT3& v2,
+    float& outDist)
+{
+    const XMFLOAT3 e1 = { v1.x - v0.x, v1.y - v0.y, v1.z - v0.z };
+    const XMFLOAT3 e2 = { v2.x - v0.x, v2.y - v0.y, v2.z - v0.z };
+
+    // p = d x e2
+    const XMFLOAT3 p = { d.y*e2.z - d.z*e2.y, d.z*e2.x - d.x*e2.z, d.x*e2.y - d.y*e2.x };
+    const float  det = e1.x*p.x + e1.y*p.y + e1.z*p.z;
+
+    if (fabsf(det) < 1e-12f)
+        return false;
+
+    const float    invDet = 1.0f / det;
+    const XMFLOAT3 s      = { o.x - v0.x, o.y - v0.y, o.z - v0.z };
+    const float    u      = (s.x*p.x + s.y*p.y + s.z*p.z) * invDet;
+
+    if ((u < 0.0f) || (u > 1.0f))
+        return false;
+
+    // q = s x e1
+    const XMFLOAT3 q = { s.y*e1.z - s.z*e1.y, s.z*e1.x - s.x*e1.z, s.x*e1.y - s.y*e1.x };
+    const float    v = (d.x*q.x + d.y*q.y + d.z*q.z) * invDet;
+
+    if ((v < 0.0f) || (u + v > 1.0f))
+        return false;
+
+    outDist = (e2.x*q.x + e2.y*q.y + e2.z*q.z) * invDet;
+    return outDist > 0.0f;
+}
+
+
+// =================================================================================
+// PUBLIC API
+// =================================================================================
+void TriangleBVH::Clear()
+{
+    nodes_.purge();
+    triangles_.purge();
+    triIdxs_.purge();
+}
+
+///////////////////////////////////////////////////////////
+
+void TriangleBVH::Build(
+    const Vertex3D* vertices,
+    const UINT* indices,
+    const MeshGeometry::Subset* subsets,
+    const int numSubsets)
+{
+    CAssert::True(vertices != nullptr, "input ptr to vertices == nullptr");
+    CAssert::True(indices  != nullptr, "input ptr to indices == nullptr");
+    CAssert::True(subsets  != nullptr, "input ptr to subsets == nullptr");
+
+    Clear();
+
+    int numTriangles = 0;
+
+    for (int i = 0; i < numSubsets; ++i)
+        numTriangles += (int)subsets[i].indexCount / 3;
+
+    if (numTriangles == 0)
+        return;
+
+    // gather triangles (with absolute vertex idxs) and their bounds
+    triangles_.resize(numTriangles * 3);
+    triIdxs_.resize(numTriangles);
+    centroids_.resize(numTriangles);
+    triMins_.resize(numTriangles);
+    triMaxs_.resize(numTriangles);
+
+    int tri = 0;
+
+    for (int i = 0; i < numSubsets; ++i)
+    {
+        const MeshGeometry::Subset& subset = subsets[i];
+        const int numSubsetTris = (int)subset.indexCount / 3;
+
+        for (int t = 0; t < numSubsetTris; ++t, ++tri)
+        {
+            const UINT* src = indices + subset.indexStart + t*3;
+            UINT* dst = triangles_.data() + tri*3;
+
+            dst[0] = src[0] + subset.vertexStart;
+            dst[1] = src[1] + subset.vertexStart;
+            dst[2] = src[2] + subset.vertexStart;
+
+            const XMFLOAT3& v0 = vertices[dst[0]].position;
+            const XMFLOAT3& v1 = vertices[dst[1]].position;
+            const XMFLOAT3& v2 = vertices[dst[2]].position;
+
+            XMFLOAT3 mn = v0;
+            XMFLOAT3 mx = v0;
+            Grow(mn, mx, v1, v1);
+            Grow(mn, mx, v2, v2);
+
+            triMins_[tri]   = mn;
+            triMaxs_[tri]   = mx;
+            centroids_[tri] = { (v0.x+v1.x+v2.x) / 3.0f, (v0.y+v1.y+v2.y) / 3.0f, (v0.z+v1.z+v2.z) / 3.0f };
+            triIdxs_[tri]   = (subset.indexStart / 3) + t;
+        }
+    }
+
+    // the tree has at most (2 * numTriangles - 1) nodes
+    nodes_.reserve(2 * numTriangles);
+    nodes_.resize(1);
+
+    Node& root       = nodes_[0];
+    root.leftOrFirst = 0;
+    root.count       = numTriangles;
+    ComputeNodeBounds(root);
+
+    Subdivide(0, 0);
+
+    // release temp data of the build
+    centroids_.purge();
+    triMins_.purge();
+    triMaxs_.purge();
+}
+
+///////////////////////////////////////////////////////////
+
+bool TriangleBVH::Intersect(
+    const Vertex3D* vertices,
+    const XMFLOAT3& origin,
+    const XMFLOAT3& dir,
+    float& inOutDist,
+    uint32& outTriangle) const
+{
+    if (nodes_.empty())
+        return false;
+
+    const XMFLOAT3 invDir = { 1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z };
+
+    if (RayBox(nodes_[0], origin, invDir, inOutDist) == FLT_MAX)
+        return false;
+
+    uint32 stack[MAX_DEPTH + 2];
+    int    stackSize = 0;
+    bool   isHit     = false;
+
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node& node = nodes_[stack[--stackSize]];
+
+        if (node.IsLeaf())
+        {
+            for (uint32 i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+            {
+                const UINT* tri = triangles_.data() + i*3;
+                float dist = 0.0f;
+
+                if (RayTriangle(
+                    origin, dir,
+                    vertices[tri[0]].position,
+                    vertices[tri[1]].position,
+                    vertices[tri[2]].position,
+                    dist) && (dist < inOutDist))
+                {
+                    inOutDist   = dist;
+                    outTriangle = triIdxs_[i];
+                    isHit       = true;
+                }
+            }
+            continue;
+        }
+
+        // visit the closest child first so the farther one can be rejected by the hit distance
+        const uint32 left  = node.leftOrFirst;
+        const uint32 right = left + 1;
+        const float  distL = RayBox(nodes_[left],  origin, invDir, inOutDist);
+        const float  distR = RayBox(nodes_[right], origin, invDir, inOutDist);
+
+        if (distL <= distR)
+        {
+            if (distR != FLT_MAX) stack[stackSize++] = right;
+            if (distL != FLT_MAX) stack[stackSize++] = left;
+        }
+        else
+        {
+            if (distL != FLT_MAX) stack[stackSize++] = left;
+            if (distR != FLT_MAX) stack[stackSize++] = right;
+        }
+    }
+
+    return isHit;
+}
+
+
+// =================================================================================
+// PRIVATE HELPERS
+// =================================================================================
+void TriangleBVH::Subdivide(const uint32 nodeIdx, const int depth)
+{
+    const Node node = nodes_[nodeIdx];     // copy: nodes_ may grow below
+
+    if ((node.count <= MAX_LEAF_TRIANGLES) || (depth >= MAX_DEPTH))
+        return;
+
+    int   axis     = 0;
+    float splitPos = 0.0f;
+    const float splitCost = FindBestSplit(node, axis, splitPos);
+    const float leafCost  = (float)node.count * SurfaceArea(node.min, node.max);
+
+    if (splitCost >= leafCost)
+        return;
+
+    // partition triangles of the node by the split plane
+    int i = (int)node.leftOrFirst;
+    int j = i + (int)node.count - 1;
+
+    while (i <= j)
+    {
+        if (GetAxis(centroids_[i], axis) < splitPos)
+        {
+            ++i;
+            continue;
+        }
+
+        std::swap(centroids_[i], centroids_[j]);
+        std::swap(triMins_[i],   triMins_[j]);
+        std::swap(triMaxs_[i],   triMaxs_[j]);
+        std::swap(triIdxs_[i],   triIdxs_[j]);
+        std::swap(triangles_[i*3 + 0], triangles_[j*3 + 0]);
+        std::swap(triangles_[i*3 + 1], triangles_[j*3 + 1]);
+        std::swap(triangles_[i*3 + 2], triangles_[j*3 + 2]);
+        --j;
+    }
+
+    const uint32 leftCount = (uint32)i - node.leftOrFirst;
+
+    if ((leftCount == 0) || (leftCount == node.count))
+        return;
+
+    const uint32 left  = (uint32)nodes_.size();
+    const uint32 right = left + 1;
+    nodes_.resize(nodes_.size() + 2);
+
+    nodes_[left].leftOrFirst  = node.leftOrFirst;
+    nodes_[left].count        = leftCount;
+    nodes_[right].leftOrFirst = (uint32)i;
+    nodes_[right].count       = node.count - leftCount;
+
+    ComputeNodeBounds(nodes_[left]);
+    ComputeNodeBounds(nodes_[right]);
+
+    // the node becomes an inner one
+    nodes_[nodeIdx].leftOrFirst = left;
+    nodes_[nodeIdx].count       = 0;
+
+    Subdivide(left,  depth + 1);
+    Subdivide(right, depth + 1);
+}
+
+///////////////////////////////////////////////////////////
+
+void TriangleBVH::ComputeNodeBounds(Node& node) const
+{
+    node.min = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+    node.max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    for (uint32 i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+        Grow(node.min, node.max, triMins_[i], triMaxs_[i]);
+}
+
+///////////////////////////////////////////////////////////
+
+float TriangleBVH::FindBestSplit(
+    const Node& node,
+    int& outAxis,
+    float& outSplitPos) const
+{
+    // binned SAH: triangles are put into bins by their centroids along each axis,
+    // the best split is searched only between bins;
+    // return: the SAH cost of the best split (FLT_MAX if there is no any)
+
+    struct Bin
+    {
+        XMFLOAT3 min   = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+        XMFLOAT3 max   = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        int      count = 0;
+    };
+
+    const uint32 first = node.leftOrFirst;
+    const uint32 last  = node.leftOrFirst + node.count;
+
+    // bounds of centroids (bins must cover them, not triangles)
+    XMFLOAT3 cmin = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+    XMFLOAT3 cmax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    for (uint32 i = first; i < last; ++i)
+        Grow(cmin, cmax, centroids_[i], centroids_[i]);
+
+    float bestCost = FLT_MAX;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float bmin = GetAxis(cmin, axis);
+        const float bmax = GetAxis(cmax, axis);
+
+        if (bmin == bmax)
+            continue;
+
+        Bin bins[NUM_SAH_BINS];
+        const float scale = (float)NUM_SAH_BINS / (bmax - bmin);
+
+        for (uint32 i = first; i < last; ++i)
+        {
+            int binIdx = (int)((GetAxis(centroids_[i], axis) - bmin) * scale);
+            binIdx = (binIdx < NUM_SAH_BINS - 1) ? binIdx : NUM_SAH_BINS - 1;
+
+            Bin& bin = bins[binIdx];
+            Grow(bin.min, bin.max, triMins_[i], triMaxs_[i]);
+            bin.count++;
+        }
+
+        // sweep from the left and from the right to get areas/counts of each split
+        float leftArea [NUM_SAH_BINS - 1];
+        float rightArea[NUM_SAH_BINS - 1];
+        int   leftCount [NUM_SAH_BINS - 1];
+        int   rightCount[NUM_SAH_BINS - 1];
+
+        XMFLOAT3 lmin = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+        XMFLOAT3 lmax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        XMFLOAT3 rmin = lmin;
+        XMFLOAT3 rmax = lmax;
+        int lsum = 0;
+        int rsum = 0;
+
+        for (int i = 0; i < NUM_SAH_BINS - 1; ++i)
+        {
+            lsum += bins[i].count;
+            leftCount[i] = lsum;
+            Grow(lmin, lmax, bins[i].min, bins[i].max);
+            leftArea[i] = (lsum > 0) ? SurfaceArea(lmin, lmax) : 0.0f;
+
+            const int r = NUM_SAH_BINS - 1 - i;
+            rsum += bins[r].count;
+            rightCount[r - 1] = rsum;
+            Grow(rmin, rmax, bins[r].min, bins[r].max);
+            rightArea[r - 1] = (rsum > 0) ? SurfaceArea(rmin, rmax) : 0.0f;
+        }
+
+        const float binWidth = (bmax - bmin) / (float)NUM_SAH_BINS;
+
+        for (int i = 0; i < NUM_SAH_BINS - 1; ++i)
+        {
+            const float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+
+            if (cost < bestCost)
+            {
+                bestCost    = cost;
+                outAxis     = axis;
+                outSplitPos = bmin + binWidth * (float)(i + 1);
+            }
+        }
+    }
+
+    return bestCost;
+}
+
+} // namespace Core
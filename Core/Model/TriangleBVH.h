@@ -0,0 +1,96 @@
+// =================================================================================
+// Filename:     TriangleBVH.h
+// Description:  a static bounding volume hierarchy over triangles of a model
+//               (in model space); is used for ray picking and ray casts:
+//
+//               - is built once at load time by binned SAH (or loaded from .de3d);
+//               - nodes are stored in a flat array, children of an inner node
+//                 are neighbours so a node keeps only one child idx;
+//               - triangles are stored as a reordered copy of LOD 0 indices
+//                 (already offset by vertexStart of their subsets) so leaves
+//                 reference a contiguous range of them
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Mesh/Vertex.h"
+#include "../Mesh/MeshGeometry.h"
+
+#include <Types.h>
+#include <cvector.h>
+#include <DirectXMath.h>
+
+
+namespace Core
+{
+
+class TriangleBVH
+{
+public:
+    // leaves with less triangles aren't split any further
+    static constexpr int MAX_LEAF_TRIANGLES = 4;
+    static constexpr int NUM_SAH_BINS       = 8;
+    static constexpr int MAX_DEPTH          = 64;
+
+    struct Node
+    {
+        DirectX::XMFLOAT3 min;
+        uint32            leftOrFirst;     // inner: idx of the left child (right == left + 1); leaf: first triangle
+        DirectX::XMFLOAT3 max;
+        uint32            count;           // inner: 0; leaf: number of triangles
+
+        inline bool IsLeaf() const { return count > 0; }
+    };
+
+    TriangleBVH() {}
+
+    void Clear();
+
+    // build the hierarchy over LOD 0 triangles of all the subsets
+    void Build(
+        const Vertex3D* vertices,
+        const UINT* indices,
+        const MeshGeometry::Subset* subsets,
+        const int numSubsets);
+
+    // find the closest intersection of the ray with triangles (in model space);
+    // the direction isn't required to be unit length: distances are measured
+    // in its lengths (so a world space ray transformed by an inverse world
+    // matrix gives world space distances);
+    //
+    // inOutDist:   in - max distance to search; out - distance to the hit
+    // outTriangle: idx of the hit triangle (in order of the source indices)
+    bool Intersect(
+        const Vertex3D* vertices,
+        const DirectX::XMFLOAT3& origin,
+        const DirectX::XMFLOAT3& dir,
+        float& inOutDist,
+        uint32& outTriangle) const;
+
+    inline bool IsEmpty()         const { return nodes_.empty(); }
+    inline int  GetNumNodes()     const { return (int)nodes_.size(); }
+    inline int  GetNumTriangles() const { return (int)triIdxs_.size(); }
+
+private:
+    void Subdivide(const uint32 nodeIdx, const int depth);
+    void ComputeNodeBounds(Node& node) const;
+
+    float FindBestSplit(
+        const Node& node,
+        int& outAxis,
+        float& outSplitPos) const;
+
+public:
+    cvector<Node>   nodes_;            // [0] is the root
+    cvector<UINT>   triangles_;        // 3 vertex idxs per triangle (by BVH order)
+    cvector<uint32> triIdxs_;          // BVH order => idx of the source triangle
+
+private:
+    // temp data of the build
+    cvector<DirectX::XMFLOAT3> centroids_;
+    cvector<DirectX::XMFLOAT3> triMins_;
+    cvector<DirectX::XMFLOAT3> triMaxs_;
+};
+
+} // namespace Core
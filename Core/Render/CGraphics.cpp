@@ -6,8 +6,15 @@
 #include "CGraphics.h"
 #include "../Input/inputcodes.h"
 #include "../Texture/TextureMgr.h"
+#include "../Texture/TextureCooker.h"
 #include "../Model/ModelMgr.h"
 #include "../Mesh/MaterialMgr.h"
+#include "../Mesh/GeometryPool.h"
+#include "ImpostorBaker.h"
+#include <CoreCommon/Frustum.h>
+#include <JobSystem.h>
+#include <Profiler.h>
+#include <CVars.h>
 
 using namespace DirectX;
 
@@ -15,7 +22,14 @@ using namespace DirectX;
 namespace Core
 {
 
+// thumbnails of the editor's browsers are kept between sessions
+static const char* THUMBNAILS_ATLAS_PATH = "data/ui/thumbnails.dds";
+static const char* THUMBNAILS_SLOTS_PATH = "data/ui/thumbnails.txt";
+
+///////////////////////////////////////////////////////////
+
 CGraphics::CGraphics() :
+    frameArena_(FRAME_ARENA_INIT_CAPACITY),
     texturesBuf_(NUM_TEXTURE_TYPES, nullptr)
 {
     LogDbg("constructor");
@@ -39,6 +53,8 @@ bool CGraphics::Initialize(
     ECS::EntityMgr* pEnttMgr,
     Render::CRender* pRender)
 {
+    MEM_TAG_SCOPE(MEM_TAG_RENDER);
+
     return InitHelper(hwnd, systemState, settings, pEnttMgr, pRender);
 }
 
@@ -49,14 +65,102 @@ void CGraphics::Update(
     ECS::EntityMgr* pEnttMgr,
     Render::CRender* pRender)
 {
+    MEM_TAG_SCOPE(MEM_TAG_RENDER);
+
     UpdateHelper(sysState, deltaTime, gameTime, pEnttMgr, pRender);
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::Render3D(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender)
+void CGraphics::ExtractFramePacket(ECS::EntityMgr* pEnttMgr, FramePacket& outPacket)
+{
+    PROFILE_SCOPE("CGraphics::ExtractFramePacket");
+
+    // sky: it follows the camera
+    const EntityID skyEnttID = pEnttMgr->nameSystem_.GetIdByName("sky");
+    outPacket.hasSky         = (skyEnttID != INVALID_ENTITY_ID);
+
+    if (outPacket.hasSky)
+    {
+        const XMFLOAT3 skyOffset     = pEnttMgr->transformSystem_.GetPosition(skyEnttID);
+        const XMFLOAT3 eyePos        = pEnttMgr->cameraSystem_.GetPos(currCameraID_);
+        const XMFLOAT3 translation   = skyOffset + eyePos;
+        const XMMATRIX world         = DirectX::XMMatrixTranslation(translation.x, translation.y, translation.z);
+
+        outPacket.skyWorldViewProj   = DirectX::XMMatrixTranspose(world * viewProj_);
+    }
+
+    // terrain (its patches are already updated)
+    outPacket.hasTerrain = (pEnttMgr->nameSystem_.GetIdByName("terrain") != INVALID_ENTITY_ID);
+
+    if (outPacket.hasTerrain && isTerrainTessellation_)
+        ExtractTerrainTessParams(pEnttMgr, outPacket.terrainTess);
+
+    // debug lines: bounding boxes are read from the ECS right now
+    if (aabbShowMode_ != NONE)
+    {
+        AddBoundingLineBoxes(pEnttMgr);
+        AddBoundingLineSpheres(pEnttMgr);
+    }
+
+    outPacket.pDebugLines = &g_DebugDraw.Flush();
+}
+
+//---------------------------------------------------------
+// Desc:   params of the tessellated terrain for this frame: the patches
+//         are culled by the world frustum and edges are tessellated by
+//         their length in pixels of the window
+//---------------------------------------------------------
+void CGraphics::ExtractTerrainTessParams(
+    ECS::EntityMgr* pEnttMgr,
+    Render::ConstBufType::cbTerrainTess& outParams)
+{
+    const TerrainGeomipmapped& terrain = g_ModelMgr.GetTerrainGeomip();
+    const SystemState&         sysState = *pSysState_;
+
+    // normals of the planes must look inside
+    const ECS::CameraFrameData& camFrame = pEnttMgr->cameraSystem_.GetFrameData(currCameraID_);
+
+    for (int i = 0; i < 6; ++i)
+        outParams.planes[i] = camFrame.innerPlanesW[i];
+
+    outParams.viewProj         = DirectX::XMMatrixTranspose(viewProj_);
+    outParams.eyePosW          = sysState.cameraPos;
+    outParams.screenScale      = sysState.cameraProj.r[1].m128_f32[1] * 0.5f * (float)d3d_.GetWindowHeight();
+    outParams.targetEdgePixels = terrainTessEdgePixels_;
+    outParams.maxTessFactor    = 64.0f;
+
+    // the height map is an 8-bit gray image (its sample is in range [0,1])
+    outParams.heightScale      = 255.0f * terrain.GetHeightScale();
+    outParams.texelSize        = 1.0f / (float)terrain.heightMap_.GetWidth();
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::Render3D(FramePacket& packet, Render::CRender* pRender)
 {
-    RenderHelper(pEnttMgr, pRender);
+    pFramePacket_ = &packet;
+    RenderHelper(pRender);
+
+    // instances ranges of this frame are reused only after the GPU finished it
+    pRender->EndFrame(pDeviceContext_);
+
+    // how many binds went to the driver and how many were redundant
+    const Render::StateCache::Stats& bindStats = pRender->GetStateCache().GetLastFrameStats();
+    packet.sysState.numBindsIssued   = bindStats.numIssued;
+    packet.sysState.numBindsFiltered = bindStats.numFiltered;
+    packet.sysState.numBindTypes     = Render::StateCache::NUM_BIND_TYPES;
+
+    for (int i = 0; i < Render::StateCache::NUM_BIND_TYPES; ++i)
+    {
+        const Render::StateCache::eBindType type = Render::StateCache::eBindType(i);
+
+        packet.sysState.bindsIssued[i]   = bindStats.issued[i];
+        packet.sysState.bindsFiltered[i] = bindStats.filtered[i];
+        packet.sysState.bindTypeNames[i] = Render::StateCache::GetBindTypeName(type);
+    }
+
+    pFramePacket_ = nullptr;
 }
 
 ///////////////////////////////////////////////////////////
@@ -79,6 +183,58 @@ bool CGraphics::InitHelper(
         LogMsgf("%s------------------------------------------------------------", YELLOW);
 
         pSysState_ = &systemState;
+        isOcclusionCulling_ = settings.GetBool("OCCLUSION_CULLING");
+        isSoftOcclusionCulling_ = settings.GetBool("SOFTWARE_OCCLUSION_CULLING");
+        isVisibilityCache_  = settings.GetBool("VISIBILITY_CACHE");
+        smallCullPixels_    = settings.GetFloat("SMALL_FEATURE_CULL_PIXELS");
+        lightLodPixels_     = settings.GetFloat("LIGHT_LOD_PIXELS");
+        impostorDist_       = settings.GetFloat("IMPOSTOR_DISTANCE");
+        isGpuPicking_       = settings.GetBool("GPU_PICKING");
+        isPackMaterialTextures_ = settings.GetBool("PACK_MATERIAL_TEXTURES");
+        isGpuDrivenRendering_   = settings.GetBool("GPU_DRIVEN_RENDERING");
+        isStaticBatches_        = settings.GetBool("STATIC_BATCHES");
+        staticMergeParams_.cellSize        = settings.GetFloat("MERGE_STATIC_CELL_SIZE");
+        staticMergeParams_.maxPropVertices = settings.GetInt("MERGE_STATIC_MAX_PROP_VERTICES");
+        isDepthPrepass_         = settings.GetBool("DEPTH_PREPASS");
+        isDeferredShading_      = settings.GetBool("DEFERRED_SHADING");
+        isDynamicResolution_    = settings.GetBool("DYNAMIC_RESOLUTION");
+        isFxaa_                 = settings.GetBool("FXAA");
+        isTerrainTessellation_  = settings.GetBool("TERRAIN_TESSELLATION");
+        terrainTessEdgePixels_  = settings.GetFloat("TERRAIN_TESSELLATION_EDGE_PIXELS");
+        terrainLodPixelError_   = settings.GetFloat("TERRAIN_LOD_PIXEL_ERROR");
+        terrainMorphRange_      = settings.GetFloat("TERRAIN_GEOMORPH_RANGE");
+        terrainMorphPixelError_ = settings.GetFloat("TERRAIN_GEOMORPH_PIXEL_ERROR");
+        isTerrainHorizonCulling_ = settings.GetBool("TERRAIN_HORIZON_CULLING");
+        isPortalCulling_        = settings.GetBool("PORTAL_CULLING");
+        isBakedStaticLights_    = settings.GetBool("BAKED_STATIC_LIGHTS");
+        lightBakeParams_.cellSize = settings.GetFloat("BAKED_STATIC_LIGHTS_CELL_SIZE");
+        lightBakeParams_.maxDim   = settings.GetInt("BAKED_STATIC_LIGHTS_MAX_DIM");
+        particlesSoftDistance_  = settings.GetFloat("PARTICLES_SOFT_DISTANCE");
+        lowResBlendFactor_      = std::clamp(settings.GetInt("LOW_RES_BLENDING_FACTOR"), 1, 4);
+        isLowResParticles_      = settings.GetBool("LOW_RES_PARTICLES");
+        isPlanarReflection_     = settings.GetBool("PLANAR_REFLECTION");
+        reflectParams_.resScale       = settings.GetFloat("PLANAR_REFLECTION_RES_SCALE");
+        reflectParams_.updateInterval = settings.GetInt("PLANAR_REFLECTION_UPDATE_INTERVAL");
+        reflectParams_.lodBias        = settings.GetInt("PLANAR_REFLECTION_LOD_BIAS");
+        reflectParams_.strength       = settings.GetFloat("PLANAR_REFLECTION_STRENGTH");
+        isTerrainVertexPulling_ = settings.GetBool("TERRAIN_VERTEX_PULLING");
+        isTerrainStreaming_     = settings.GetBool("TERRAIN_STREAMING");
+
+        TerrainStreamingParams& streaming = terrainStreamingParams_;
+        strncpy(streaming.dirPath, settings.GetString("TERRAIN_STREAMING_DIR"), sizeof(streaming.dirPath) - 1);
+        streaming.patchesPerTile   = settings.GetInt("TERRAIN_STREAMING_PATCHES_PER_TILE");
+        streaming.maxResidentTiles = settings.GetInt("TERRAIN_STREAMING_MAX_TILES");
+        streaming.loadRadius       = settings.GetFloat("TERRAIN_STREAMING_RADIUS");
+
+        isTerrainVT_                       = settings.GetBool("TERRAIN_VIRTUAL_TEXTURE");
+        terrainVTParams_.virtualSize       = settings.GetInt("TERRAIN_VT_SIZE");
+        terrainVTParams_.pageSize          = settings.GetInt("TERRAIN_VT_PAGE_SIZE");
+        terrainVTParams_.cachePagesPerSide = settings.GetInt("TERRAIN_VT_CACHE_PAGES_PER_SIDE");
+        terrainVTParams_.maxBakesPerFrame  = settings.GetInt("TERRAIN_VT_BAKES_PER_FRAME");
+
+        dynamicRes_.Initialize(
+            settings.GetFloat("DYNAMIC_RESOLUTION_TARGET_MS"),
+            settings.GetFloat("DYNAMIC_RESOLUTION_MIN_SCALE"));
 
         result = initGraphics.InitializeDirectX(d3d_, hwnd, settings);
         CAssert::True(result, "can't initialize D3DClass");
@@ -88,11 +244,50 @@ bool CGraphics::InitHelper(
 
         // initializer the textures global manager (container)
         g_TextureMgr.Initialize(pDevice_);
-    
-        // create frustums for frustum culling
-        frustums_.push_back(DirectX::BoundingFrustum());
+
+        // cook textures into block compressed .dds before anything is loaded
+        // (only new or changed sources are cooked; the TextureMgr prefers cooked files)
+        if (settings.GetBool("TEXTURE_COOKING"))
+        {
+            TexCookStats cookStats;
+            TextureCooker::CookDirectory(pDevice_, g_RelPathTexDir, cookStats);
+            TextureCooker::CookDirectory(pDevice_, g_RelPathExtModelsDir, cookStats);
+
+            LogMsgf("texture cooking: cooked %u, skipped %u, failed %u; %llu KB => %llu KB",
+                cookStats.numCooked,
+                cookStats.numSkipped,
+                cookStats.numFailed,
+                (unsigned long long)(cookStats.srcBytes >> 10),
+                (unsigned long long)(cookStats.dstBytes >> 10));
+        }
+
+        if (settings.GetBool("TEXTURE_STREAMING"))
+        {
+            TexStreamingParams texStreaming;
+            texStreaming.budgetBytes     = (uint64)settings.GetInt("TEXTURE_STREAMING_BUDGET_MB") << 20;
+            texStreaming.minResidentSize = (uint)settings.GetInt("TEXTURE_STREAMING_MIN_SIZE");
+
+            g_TextureMgr.EnableStreaming(texStreaming);
+        }
+
+        // textures from raw data (terrain maps, etc.) are uploaded within a per frame budget
+        if (settings.GetBool("STAGED_TEXTURE_UPLOADS"))
+        {
+            TexUploadParams texUploads;
+            texUploads.budgetBytes = (uint64)settings.GetInt("TEXTURE_UPLOAD_BUDGET_KB") << 10;
+
+            g_TextureMgr.EnableStagedUploads(texUploads);
+        }
+
+        // static geometry of models is suballocated from a few shared buffers
+        if (settings.GetBool("GEOMETRY_POOL"))
+            g_GeometryPool.Initialize(pDevice_);
+
+        // nothing is loaded here: the atlas is loaded when a browser is opened
+        thumbnails_.Initialize(pDevice_, THUMBNAILS_ATLAS_PATH, THUMBNAILS_SLOTS_PATH);
 
         BuildGeometryBuffers();
+        RegisterCVars();
     }
     catch (EngineException & e)
     {
@@ -112,9 +307,105 @@ void CGraphics::Shutdown()
 {
     // Shutdowns all the graphics rendering parts, releases the memory
     LogDbg("graphics shutdown");
+
+    thumbnails_.Shutdown(d3d_.GetDeviceContext());
+    SafeRelease(&pSceneImage_);
+    lightBaker_.Release();
+    renderGraph_.Shutdown();
+    terrainStreamer_.Shutdown();
+    terrainVT_.Shutdown();
+    g_TextureMgr.ShutdownLoading();
+
     d3d_.Shutdown();
 }
 
+///////////////////////////////////////////////////////////
+
+void CGraphics::RegisterCVars()
+{
+    // culling, LODs and passes which can be switched at runtime (by the same keys
+    // as in settings); changes of culling drop the visibility cache since its
+    // results are computed with the prev values
+
+    g_CVars.RegisterBool("VSYNC_ENABLED", d3d_.IsVSync(), "present with vertical sync",
+        [this](const CVar& var) { d3d_.SetVSync(var.GetBool()); });
+
+    g_CVars.RegisterBool("OCCLUSION_CULLING", isOcclusionCulling_, "cull entts hidden behind others by the Hi-Z buffer",
+        [this](const CVar& var) { isOcclusionCulling_ = var.GetBool(); visCacheStillFrames_ = 0; });
+
+    g_CVars.RegisterBool("SOFTWARE_OCCLUSION_CULLING", isSoftOcclusionCulling_, "cull entts hidden behind others by occluders rasterized on CPU",
+        [this](const CVar& var) { isSoftOcclusionCulling_ = var.GetBool(); visCacheStillFrames_ = 0; });
+
+    g_CVars.RegisterBool("VISIBILITY_CACHE", isVisibilityCache_, "reuse visibility of the prev frame while the camera and scene are still",
+        [this](const CVar& var) { isVisibilityCache_ = var.GetBool(); visCacheStillFrames_ = 0; });
+
+    g_CVars.RegisterFloat("SMALL_FEATURE_CULL_PIXELS", smallCullPixels_, 0.0f, 64.0f, "cull entts which are projected into less pixels",
+        [this](const CVar& var) { smallCullPixels_ = var.GetFloat(); visCacheStillFrames_ = 0; });
+
+    g_CVars.RegisterFloat("LIGHT_LOD_PIXELS", lightLodPixels_, 0.0f, 64.0f, "cull lights which cover less pixels",
+        [this](const CVar& var) { lightLodPixels_ = var.GetFloat(); });
+
+    g_CVars.RegisterFloat("IMPOSTOR_DISTANCE", impostorDist_, 0.0f, 10000.0f, "render entts further than it by impostors (0 - never)",
+        [this](const CVar& var) { impostorDist_ = var.GetFloat(); visCacheStillFrames_ = 0; });
+
+    g_CVars.RegisterBool("GPU_DRIVEN_RENDERING", isGpuDrivenRendering_, "cull the opaque pass on GPU and render it by indirect draws",
+        [this](const CVar& var) { isGpuDrivenRendering_ = var.GetBool(); visCacheStillFrames_ = 0; });
+
+    g_CVars.RegisterBool("STATIC_BATCHES", isStaticBatches_, "keep instances of static entts on GPU",
+        [this](const CVar& var) { isStaticBatches_ = var.GetBool(); });
+
+    g_CVars.RegisterBool("DEPTH_PREPASS", isDepthPrepass_, "fill depth before the opaque passes",
+        [this](const CVar& var) { isDepthPrepass_ = var.GetBool(); });
+
+    g_CVars.RegisterBool("DEFERRED_SHADING", isDeferredShading_, "shade the opaque pass by the G-buffer and tiled lighting",
+        [this](const CVar& var) { isDeferredShading_ = var.GetBool(); });
+
+    g_CVars.RegisterBool("TERRAIN_TESSELLATION", isTerrainTessellation_, "tessellate the terrain on GPU instead of geomipmapping",
+        [this](const CVar& var) { isTerrainTessellation_ = var.GetBool(); });
+
+    g_CVars.RegisterFloat("TERRAIN_TESSELLATION_EDGE_PIXELS", terrainTessEdgePixels_, 1.0f, 64.0f, "target length of tessellated terrain edges",
+        [this](const CVar& var) { terrainTessEdgePixels_ = var.GetFloat(); });
+
+    g_CVars.RegisterFloat("TERRAIN_LOD_PIXEL_ERROR", terrainLodPixelError_, 0.25f, 32.0f, "max screen-space error of terrain LODs",
+        [this](const CVar& var) { terrainLodPixelError_ = var.GetFloat(); });
+
+    g_CVars.RegisterFloat("TERRAIN_GEOMORPH_RANGE", terrainMorphRange_, 0.0f, 1.0f, "part of a terrain LOD's distances where it is morphed to the next one (0 - off)",
+        [this](const CVar& var) { terrainMorphRange_ = var.GetFloat(); g_ModelMgr.GetTerrainGeomip().SetMorphRange(terrainMorphRange_); });
+
+    g_CVars.RegisterFloat("TERRAIN_GEOMORPH_PIXEL_ERROR", terrainMorphPixelError_, 0.25f, 64.0f, "max screen-space error of geomorphed terrain LODs",
+        [this](const CVar& var) { terrainMorphPixelError_ = var.GetFloat(); });
+
+    g_CVars.RegisterBool("TERRAIN_HORIZON_CULLING", isTerrainHorizonCulling_, "cull terrain patches and entts hidden behind hills by the CPU horizon buffer",
+        [this](const CVar& var) { isTerrainHorizonCulling_ = var.GetBool(); visCacheStillFrames_ = 0; });
+
+    g_CVars.RegisterBool("PORTAL_CULLING", isPortalCulling_, "cull entts and lights of interiors which aren't seen through portals",
+        [this](const CVar& var) { isPortalCulling_ = var.GetBool(); visCacheStillFrames_ = 0; });
+
+    g_CVars.RegisterBool("BAKED_STATIC_LIGHTS", isBakedStaticLights_, "light by the baked volume of static point/spot lights (they aren't put into the clusters)",
+        [this](const CVar& var) { isBakedStaticLights_ = var.GetBool(); visCacheStillFrames_ = 0; });
+
+    g_CVars.RegisterInt("LOW_RES_BLENDING_FACTOR", lowResBlendFactor_, 1, 4, "render blended LOW_RES_BLENDING materials in N times smaller (1 - off)",
+        [this](const CVar& var) { lowResBlendFactor_ = var.GetInt(); });
+
+    g_CVars.RegisterBool("LOW_RES_PARTICLES", isLowResParticles_, "render particles with the low resolution blending too",
+        [this](const CVar& var) { isLowResParticles_ = var.GetBool(); });
+
+    g_CVars.RegisterBool("PLANAR_REFLECTION", isPlanarReflection_, "reflect flagged entts by the plane of the mirror entt",
+        [this](const CVar& var) { isPlanarReflection_ = var.GetBool(); });
+
+    g_CVars.RegisterFloat("PLANAR_REFLECTION_RES_SCALE", reflectParams_.resScale, 0.1f, 1.0f, "size of the planar reflection relatively to the screen",
+        [this](const CVar& var) { reflectParams_.resScale = var.GetFloat(); });
+
+    g_CVars.RegisterInt("PLANAR_REFLECTION_UPDATE_INTERVAL", reflectParams_.updateInterval, 1, 8, "re-render the planar reflection once in N frames",
+        [this](const CVar& var) { reflectParams_.updateInterval = var.GetInt(); });
+
+    g_CVars.RegisterInt("PLANAR_REFLECTION_LOD_BIAS", reflectParams_.lodBias, 0, 3, "casters of the planar reflection get LODs coarser by N",
+        [this](const CVar& var) { reflectParams_.lodBias = var.GetInt(); });
+
+    g_CVars.RegisterFloat("PLANAR_REFLECTION_STRENGTH", reflectParams_.strength, 0.0f, 1.0f, "how much of the reflection is blended over the mirror",
+        [this](const CVar& var) { reflectParams_.strength = var.GetFloat(); });
+}
+
 
 // =================================================================================
 // Update / prepare scene
@@ -129,6 +420,7 @@ void CGraphics::UpdateHelper(
 {
     // update all the graphics related stuff for this frame
 
+    PROFILE_SCOPE("CGraphics::Update");
 
     TerrainGeomipmapped& terrain = g_ModelMgr.GetTerrainGeomip();
     
@@ -144,18 +436,21 @@ void CGraphics::UpdateHelper(
         ECS::PlayerSystem& player = pEnttMgr->playerSystem_;
         XMFLOAT3 playerPos = player.GetPosition();
 
-        const float terrainSize = (float)terrain.heightMap_.GetWidth();
+        // the streamed terrain is larger than the loaded one
+        const bool  isStreamed   = terrainStreamer_.IsActive();
+        const float terrainSizeX = (isStreamed) ? terrainStreamer_.GetWorldSizeX() : (float)terrain.heightMap_.GetWidth();
+        const float terrainSizeZ = (isStreamed) ? terrainStreamer_.GetWorldSizeZ() : (float)terrain.heightMap_.GetWidth();
 
         // clamp the camera position to be only on the terrain
         if (playerPos.x < 0)
             playerPos.x = 0;
-        if (playerPos.x >= terrainSize)
-            playerPos.x = terrainSize - 1;
+        if (playerPos.x >= terrainSizeX)
+            playerPos.x = terrainSizeX - 1;
 
         if (playerPos.z < 0)
             playerPos.z = 0;
-        if (playerPos.z >= terrainSize)
-            playerPos.z = terrainSize - 1;
+        if (playerPos.z >= terrainSizeZ)
+            playerPos.z = terrainSizeZ - 1;
 
 
         if (player.IsFreeFlyMode())
@@ -167,7 +462,19 @@ void CGraphics::UpdateHelper(
         else
         {
             // make player's offset by Y-axis to be at fixed height over the terrain
-            const float terrainHeight = terrain.GetScaledInterpolatedHeightAtPoint(playerPos.x, playerPos.z);
+            // (the height of the streamed terrain is 0 till the tile is loaded)
+            float terrainHeight = 0;
+
+            if (isStreamed)
+            {
+                terrainStreamer_.GetHeightAtPoint(playerPos.x, playerPos.z, terrainHeight);
+            }
+            else
+            {
+                const XMFLOAT2 playerXZ = { playerPos.x, playerPos.z };
+                terrain.SampleHeights(&playerXZ, 1, &terrainHeight);
+            }
+
             const float offsetOverTerrain = 2;
 
             player.SetMinVerticalOffset(terrainHeight + offsetOverTerrain);
@@ -225,12 +532,12 @@ void CGraphics::UpdateHelper(
 
     pEnttMgr->cameraSystem_.UpdateView(currCamID);
 
+    // matrices and frustums of the camera are computed once by UpdateView()
+    const ECS::CameraFrameData& camFrame = pEnttMgr->cameraSystem_.GetFrameData(currCamID);
+
     sysState.cameraView = pEnttMgr->cameraSystem_.GetView(currCamID);
     sysState.cameraProj = pEnttMgr->cameraSystem_.GetProj(currCamID);
-    viewProj_           = sysState.cameraView * sysState.cameraProj;
-
-    // build the frustum in view space from the projection matrix
-    DirectX::BoundingFrustum::CreateFromMatrix(frustums_[0], sysState.cameraProj);
+    viewProj_           = camFrame.viewProj;
 
 
     // ---------------------------------------------
@@ -254,40 +561,133 @@ void CGraphics::UpdateHelper(
     camParams.nearZ = pEnttMgr->cameraSystem_.GetNearZ(currCamID);
     camParams.farZ  = pEnttMgr->cameraSystem_.GetFarZ(currCamID);
 
+    // LODs of terrain patches are chosen by their error projected onto the screen
+    camParams.screenHeight  = (float)d3d_.GetWindowHeight();
+    // (geomorphed LODs are switched invisibly so they can be much coarser)
+    camParams.maxPixelError = (terrain.IsMorphing()) ? terrainMorphPixelError_ : terrainLodPixelError_;
 
-    // 6 planes representation of frustum
-    DirectX::XMVECTOR planes[6];
-    frustums_[0].GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+    // world-space frustum planes (normals look inside)
+    memcpy(camParams.planes, camFrame.innerPlanesW, sizeof(camParams.planes));
 
-    // setup params for each frustum plane 
-    for (int i = 0; i < 6; ++i)
+    // upload edited regions of the terrain (if there are any)
+    terrain.UpdateDirtyRegions(pDeviceContext_);
+
+    // the terrain is created after the graphics so its buffers for vertex pulling
+    // are built by the first frame (the tessellation and streaming have a priority)
+    if (isTerrainVertexPulling_ && !terrain.IsVertexPulling() && !isTerrainStreaming_ && !IsTerrainTessellated(pRender))
+    {
+        isTerrainVertexPulling_ =
+            pRender->shadersContainer_.terrainShader_.IsVertexPulling() &&
+            terrain.InitVertexPulling(pDevice_);
+
+        terrain.SetMorphRange(terrainMorphRange_);
+    }
+
+    // cull terrain patches and choose their LODs (the terrain geometry is static);
+    // the tessellated terrain is culled and tessellated by the GPU
+    {
+        PROFILE_SCOPE("TerrainTessellation");
+
+        if (isTerrainStreaming_)
+        {
+            // the streaming is started by the first frame since the terrain (the source
+            // of tiles if they aren't split yet) is created after the graphics
+            if (!terrainStreamer_.IsActive())
+                isTerrainStreaming_ = terrainStreamer_.Initialize(pDevice_, terrainStreamingParams_, &terrain);
+
+            terrainStreamer_.Update(camParams);
+        }
+        else if (!IsTerrainTessellated(pRender))
+        {
+            terrain.SetHorizonCulling(isTerrainHorizonCulling_);
+            terrain.Update(camParams);
+        }
+    }
+
+    // pages of the terrain's virtual texture which were requested by the GPU
+    UpdateTerrainVT(pRender);
+
+
+    // cells of merged static props are rebuilt if their props were moved/destroyed
+    if (staticMerger_.Update(pDevice_, *pEnttMgr))
+        InvalidateVisibilityCache();
+
+    // upload materials before the visibility cache is checked: repacking of
+    // textures invalidates the cache (instances must know which maps are packed)
+    UpdateMaterialsTable(pRender);
+
+    // streamed textures got other mips: instances must refer to the new SRVs
+    if (g_TextureMgr.GetSRVsVersion() != texSRVsVersion_)
     {
-        // normalized plane (normal: x,y,z; w is d = -dot(n,p0))
-        camParams.planes[i][0] = -planes[i].m128_f32[0];
-        camParams.planes[i][1] = -planes[i].m128_f32[1];
-        camParams.planes[i][2] = -planes[i].m128_f32[2];
-        camParams.planes[i][3] = -planes[i].m128_f32[3];
+        texSRVsVersion_ = g_TextureMgr.GetSRVsVersion();
+        InvalidateVisibilityCache();
     }
 
-    // recompute terrain patches and load them into GPU
-    terrain.Update(camParams);
-    terrain.vb_.UpdateDynamic(pDeviceContext_, terrain.vertices_, terrain.verticesOffset_);
+    // the opaque pass is culled on GPU: its scene is uploaded only if it is changed
+    if (IsGpuDriven(pRender))
+    {
+        UpdateGpuScene(pEnttMgr, pRender);
+        SetupGpuCullParams(sysState, pEnttMgr);
+    }
 
+    // records of static entts are uploaded only if the set of them is changed
+    if (IsStaticBatches(pRender))
+        UpdateStaticBatches(pEnttMgr, pRender);
 
     // ------------------------------------------
     // perform frustum culling on all of our currently loaded entities
-    ComputeFrustumCulling(sysState, pEnttMgr);
+    // (if the camera and the scene are still we reuse results of the prev frame)
+    const bool isVisCacheHit = UpdateVisibilityCache(sysState, pEnttMgr);
+
+    if (!isVisCacheHit)
+    {
+        ComputeFrustumCulling(sysState, pEnttMgr);
+        ComputeSoftwareOcclusionCulling(sysState, pEnttMgr);
+        ComputeHorizonCulling(sysState, pEnttMgr, pRender);
+        ComputePortalCulling(sysState, pEnttMgr);
+        ComputeOcclusionCulling(sysState, pEnttMgr, pRender);
+        ComputeLodsOfVisibleEntts(sysState, pEnttMgr);
+    }
+
     ComputeFrustumCullingOfLightSources(sysState, pEnttMgr);
 
+    // particles move each frame whether the visibility is cached or not
+    UpdateParticles(sysState, deltaTime, pEnttMgr, pRender);
+
+    // grass is scattered around the camera each frame (it is swayed by the wind anyway)
+    UpdateGrass(sysState, totalGameTime, pEnttMgr, pRender);
+
+    // animated entts are culled and get their frames each frame as well
+    UpdateSkinnedCrowds(pEnttMgr, pRender);
+
     // Update shaders common data for this frame
+    pRender->perFrameData_.deltaTime     = deltaTime;
+    pRender->perFrameData_.totalGameTime = totalGameTime;
     UpdateShadersDataPerFrame(pEnttMgr, pRender);
 
+    // cascades of the sun's shadows follow the camera (casters are culled for each of them)
+    UpdateShadows(pEnttMgr, pRender);
+
+    // the mirror is culled by the camera, casters of its reflection by the reflected frustum
+    UpdatePlanarReflection(sysState, pEnttMgr, pRender);
+
+    // visible entts and their instances of the prev frame are still actual
+    if (isVisCacheHit)
+        return;
+
+    // clear rendering data of the prev frame / instances set
+    pRender->dataStorage_.Clear();
+    rsDataToRender_.Clear();
+
     // prepare all the visible entities data for rendering
     const cvector<EntityID>& visibleEntts = pEnttMgr->renderSystem_.GetAllVisibleEntts();
 
     // separate entts into opaque, entts with alpha clipping, blended, etc.
     pEnttMgr->renderStatesSystem_.SeparateEnttsByRenderStates(visibleEntts, rsDataToRender_);
 
+    // far entts are rendered by impostors instead of meshes
+    SeparateImpostorEntts(pEnttMgr, pRender);
+
     pSysState_->visibleVerticesCount = 0;
 
 
@@ -354,8 +754,80 @@ void CGraphics::UpdateHelper(
     // ----------------------------------------------------
     // prepare data for each entts set
    
+    PrepStaticInstancesForRender(pEnttMgr, pRender);
     PrepBasicInstancesForRender(pEnttMgr, pRender);
     PrepAlphaClippedInstancesForRender(pEnttMgr, pRender);
+    PrepImpostorsForRender(pEnttMgr, pRender);
+}
+
+///////////////////////////////////////////////////////////
+
+bool CGraphics::UpdateVisibilityCache(const SystemState& sysState, ECS::EntityMgr* pEnttMgr)
+{
+    // check if we can reuse the visible set and instances of the prev frame;
+    // it is possible only if nothing is moved (including interpolated entts),
+    // no entts were created/destroyed and the camera pose is almost the same;
+    // returns true if the cache is valid for this frame
+
+    PROFILE_SCOPE("VisibilityCache");
+
+    using namespace DirectX;
+    const ECS::EntityMgr& mgr = *pEnttMgr;
+
+    const bool isSceneStill =
+        mgr.transformSystem_.GetChangedEntts().empty() &&
+        !mgr.texTransformSystem_.HasCpuTexAnimations() &&
+        (mgr.GetStructureVersion() == visCacheSceneVersion_) &&
+        (mgr.portalSystem_.GetVersion() == visCachePortalsVersion_);
+
+    // compare the camera pose with the pose the cache was built from
+    const XMVECTOR posDiff = XMVectorSubtract(XMLoadFloat3(&sysState.cameraPos), visCacheView_.r[3]);
+    const XMVECTOR rotDiff = XMVectorMax(
+        XMVectorMax(
+            XMVectorAbs(XMVectorSubtract(sysState.cameraView.r[0], visCacheView_.r[0])),
+            XMVectorAbs(XMVectorSubtract(sysState.cameraView.r[1], visCacheView_.r[1]))),
+        XMVectorAbs(XMVectorSubtract(sysState.cameraView.r[2], visCacheView_.r[2])));
+
+    const XMVECTOR rotThreshold = XMVectorReplicate(VIS_CACHE_ROT_THRESHOLD);
+    const XMVECTOR projEqual    = XMVectorAndInt(
+        XMVectorAndInt(XMVectorEqual(sysState.cameraProj.r[0], visCacheProj_.r[0]), XMVectorEqual(sysState.cameraProj.r[1], visCacheProj_.r[1])),
+        XMVectorAndInt(XMVectorEqual(sysState.cameraProj.r[2], visCacheProj_.r[2]), XMVectorEqual(sysState.cameraProj.r[3], visCacheProj_.r[3])));
+
+    const bool isPoseStill =
+        (currCameraID_ == visCacheCameraID_) &&
+        (XMVectorGetX(XMVector3LengthSq(posDiff)) < VIS_CACHE_POS_THRESHOLD * VIS_CACHE_POS_THRESHOLD) &&
+        XMVector3Less(rotDiff, rotThreshold) &&
+        XMVector4EqualInt(projEqual, XMVectorTrueInt());
+
+    if (!isSceneStill || !isPoseStill)
+    {
+        // remember the new pose; NOTE: the 4th row of the cached view keeps
+        // the camera position (instead of the view translation)
+        visCacheView_         = sysState.cameraView;
+        visCacheView_.r[3]    = XMVectorSetW(XMLoadFloat3(&sysState.cameraPos), 1.0f);
+        visCacheProj_         = sysState.cameraProj;
+        visCacheCameraID_     = currCameraID_;
+        visCacheSceneVersion_ = mgr.GetStructureVersion();
+        visCachePortalsVersion_ = mgr.portalSystem_.GetVersion();
+        visCacheStillFrames_  = 0;
+        isVisCacheValid_      = false;
+        return false;
+    }
+
+    if (isVisCacheValid_ && (visCacheAge_ < VIS_CACHE_MAX_AGE))
+    {
+        ++visCacheAge_;
+        return true;
+    }
+
+    // the cache is rebuilt during this frame: it can be used by the next frames
+    // only if the pose was still long enough so the Hi-Z buffer (which has
+    // a latency of a few frames) was already built from this pose
+    ++visCacheStillFrames_;
+    isVisCacheValid_ = isVisibilityCache_ && (visCacheStillFrames_ >= VIS_CACHE_WARMUP_FRAMES);
+    visCacheAge_     = 0;
+
+    return false;
 }
 
 ///////////////////////////////////////////////////////////
@@ -363,6 +835,12 @@ void CGraphics::UpdateHelper(
 void CGraphics::PrepBasicInstancesForRender(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender)
 {
     // prepare rendering data of entts which have default render states
+    // (if the opaque pass is GPU-driven these entts are already on GPU)
+
+    PROFILE_SCOPE("PrepBasicInstances");
+
+    if (IsGpuDriven(pRender))
+        return;
 
     const EntityID* ids = rsDataToRender_.enttsDefault_.ids_.data();
     const size numEntts = rsDataToRender_.enttsDefault_.ids_.size();
@@ -376,8 +854,10 @@ void CGraphics::PrepBasicInstancesForRender(ECS::EntityMgr* pEnttMgr, Render::CR
         ids,
         numEntts,
         pEnttMgr,
+        frameArena_,
         storage.modelInstBuffer,
-        storage.modelInstances);
+        storage.modelInstances,
+        pSysState_->cameraPos);
 
     // compute how many vertices will we render
     for (const Render::Instance& inst : storage.modelInstances)
@@ -386,10 +866,73 @@ void CGraphics::PrepBasicInstancesForRender(ECS::EntityMgr* pEnttMgr, Render::CR
 
 ///////////////////////////////////////////////////////////
 
+void CGraphics::PrepStaticInstancesForRender(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender)
+{
+    // visible static entts with default render states are rendered from static
+    // batches so they are moved out of the default list (which goes per-frame);
+    // only the list of their records is uploaded
+
+    PROFILE_SCOPE("PrepStaticInstances");
+
+    if (!IsStaticBatches(pRender) || staticBatchesData_.entts.empty())
+        return;
+
+    cvector<EntityID>& ids = rsDataToRender_.enttsDefault_.ids_;
+
+    if (ids.empty())
+        return;
+
+    // split visible entts into static and dynamic ones (the order is kept)
+    cvector<EntityID> staticEntts;
+    cvector<bool>     isStatic;
+
+    staticEntts.reserve(ids.size());
+    staticBatchesData_.entts.binary_search(ids.data(), ids.size(), isStatic);
+
+    index numDynamic = 0;
+
+    for (index i = 0; i < ids.size(); ++i)
+    {
+        if (isStatic[i])
+            staticEntts.push_back(ids[i]);
+        else
+            ids[numDynamic++] = ids[i];
+    }
+
+    ids.resize(numDynamic);
+
+    if (staticEntts.empty())
+        return;
+
+    Render::RenderDataStorage& storage = pRender->dataStorage_;
+
+    prep_.PrepareStaticInstancesForRendering(
+        staticEntts.data(),
+        staticEntts.size(),
+        pEnttMgr,
+        staticBatchesData_,
+        storage.staticModelInstances,
+        storage.staticRecordIdxs,
+        pSysState_->cameraPos);
+
+    // the visible buffer keeps its content while the visibility cache is hit
+    pRender->GatherStaticInstances(
+        pDeviceContext_,
+        storage.staticRecordIdxs.data(),
+        (UINT)storage.staticRecordIdxs.size());
+
+    for (const Render::Instance& inst : storage.staticModelInstances)
+        pSysState_->visibleVerticesCount += inst.numInstances * inst.GetNumVertices();
+}
+
+///////////////////////////////////////////////////////////
+
 void CGraphics::PrepAlphaClippedInstancesForRender(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender)
 {
     // prepare rendering data of entts which have alpha clip + cull none
 
+    PROFILE_SCOPE("PrepAlphaClippedInstances");
+
     const EntityID* ids = rsDataToRender_.enttsAlphaClipping_.ids_.data();
     const size numEntts = rsDataToRender_.enttsAlphaClipping_.ids_.size();
 
@@ -402,8 +945,10 @@ void CGraphics::PrepAlphaClippedInstancesForRender(ECS::EntityMgr* pEnttMgr, Ren
         ids,
         numEntts,
         pEnttMgr,
+        frameArena_,
         storage.alphaClippedModelInstBuffer,
-        storage.alphaClippedModelInstances);
+        storage.alphaClippedModelInstances,
+        pSysState_->cameraPos);
 
     // compute how many vertices will we render
     for (const Render::Instance& inst : storage.alphaClippedModelInstances)
@@ -418,6 +963,8 @@ void CGraphics::PrepBlendedInstancesForRender(
 {
     // prepare rendering data of entts which have alpha clip + cull none
 
+    PROFILE_SCOPE("PrepBlendedInstances");
+
     const EntityID* ids = rsDataToRender_.enttsBlended_.ids_.data();
     const size numEntts = rsDataToRender_.enttsBlended_.ids_.size();
 
@@ -430,8 +977,10 @@ void CGraphics::PrepBlendedInstancesForRender(
         ids,
         numEntts,
         pEnttMgr,
+        frameArena_,
         storage.blendedModelInstBuffer,
-        storage.blendedModelInstances);
+        storage.blendedModelInstances,
+        pSysState_->cameraPos);
 
     // compute how many vertices will we render
     for (const Render::Instance& inst : storage.alphaClippedModelInstances)
@@ -440,202 +989,1879 @@ void CGraphics::PrepBlendedInstancesForRender(
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::ComputeFrustumCulling(
-    SystemState& sysState,
-    ECS::EntityMgr* pEnttMgr)
+void CGraphics::SeparateImpostorEntts(
+    ECS::EntityMgr* pEnttMgr,
+    Render::CRender* pRender)
 {
-    ECS::EntityMgr& mgr = *pEnttMgr;
-    ECS::RenderSystem& renderSys = mgr.renderSystem_;
-
-    const cvector<EntityID>& enttsRenderable = renderSys.GetAllEnttsIDs();
-    const size numRenderableEntts = enttsRenderable.size();
-    size numVisEntts = 0;                                     // the number of currently visible entts
+    // move entts which got the impostor LOD (and whose models have a baked impostor)
+    // from the default and alpha clipped sets into the impostors set;
+    // NOTE: the GPU-driven opaque pass selects LODs on GPU so its entts stay meshes
 
-    if (numRenderableEntts == 0)
-        return;
+    PROFILE_SCOPE("SeparateImpostors");
 
-    static cvector<BoundingSphere> boundSpheres;                   // bounding sphere of the whole entity
-    static cvector<index>          idxsToVisEntts(numRenderableEntts);
-    static cvector<XMMATRIX>       enttsLocal(numRenderableEntts);
+    cvector<EntityID>& impostors = rsDataToRender_.enttsImpostors_.ids_;
+    impostors.clear();
 
-    // get arr of bounding spheres for each renderable entt
-    mgr.boundingSystem_.GetBoundSpheres(
-        enttsRenderable.data(),
-        numRenderableEntts,
-        boundSpheres);
+    cvector<EntityID>* enttsSets[] =
+    {
+        (IsGpuDriven(pRender)) ? nullptr : &rsDataToRender_.enttsDefault_.ids_,
+        &rsDataToRender_.enttsAlphaClipping_.ids_,
+    };
 
-#if 1
-    // inverse world matrix of each renderable entt
-    static cvector<XMMATRIX> invWorlds;  
+    cvector<uint8> lods;
 
-    // get inverse world matrix of each renderable entt
-    mgr.transformSystem_.GetInverseWorlds(
-        enttsRenderable.data(),
-        numRenderableEntts,
-        invWorlds);
+    for (cvector<EntityID>* pIds : enttsSets)
+    {
+        if (!pIds || pIds->empty())
+            continue;
 
-    const XMMATRIX invView = mgr.cameraSystem_.GetInverseView(currCameraID_);
+        cvector<EntityID>& ids = *pIds;
+        pEnttMgr->renderSystem_.GetLods(ids.data(), ids.size(), lods);
 
-    // compute local space matrices for frustum transformations
-    for (index i = 0; i < numRenderableEntts; ++i)
-        enttsLocal[i] = DirectX::XMMatrixMultiply(invView, invWorlds[i]);
+        // compact the set (the order of remaining entts is kept)
+        index numKept = 0;
 
-    // go through each entity and define if it is visible
-    for (index idx = 0; idx < numRenderableEntts; ++idx)
-    {
-        // transform the camera frustum from view space to the object's local space
-        DirectX::BoundingFrustum LSpaceFrustum;
-        frustums_[0].Transform(LSpaceFrustum, enttsLocal[idx]);
+        for (index i = 0; i < ids.size(); ++i)
+        {
+            if (lods[i] == IMPOSTOR_LOD)
+            {
+                const ModelID modelID = pEnttMgr->modelSystem_.GetModelIdRelatedToEntt(ids[i]);
 
-        idxsToVisEntts[numVisEntts] = idx;
-        numVisEntts += LSpaceFrustum.Intersects(boundSpheres[idx]);
-    }
+                if (g_ModelMgr.GetModelByID(modelID).impostor_.IsBaked())
+                {
+                    impostors.push_back(ids[i]);
+                    continue;
+                }
+            }
 
-#else
-    static ECS::cvector<XMMATRIX> worlds;
+            ids[numKept++] = ids[i];
+        }
 
-    mgr.transformSystem_.GetWorlds(
-        enttsRenderable.data(),
-        numRenderableEntts,
-        worlds);
+        ids.resize(numKept);
+    }
+}
 
-    // offset of entity in local space relatively to the Origin
-    for (index i = 0; i < numRenderableEntts; ++i)
-    {
-        // change radius
-        boundSpheres[i].Radius *= worlds[i].r[0].m128_f32[0];
+///////////////////////////////////////////////////////////
 
-        // change position
-        float* pos = worlds[i].r[3].m128_f32;
-        boundSpheres[i].Center.x += pos[0];
-        boundSpheres[i].Center.y += pos[1];
-        boundSpheres[i].Center.z += pos[2];
-    }
+void CGraphics::PrepImpostorsForRender(
+    ECS::EntityMgr* pEnttMgr,
+    Render::CRender* pRender)
+{
+    // prepare a point per impostor (sorted by models) and a batch per model
 
-    // transform camera's frustum to world space
-    DirectX::BoundingFrustum WSpaceFrustum;
-    frustums_[0].Transform(WSpaceFrustum, mgr.cameraSystem_.GetInverseView(currCameraID_));
+    PROFILE_SCOPE("PrepImpostors");
 
-    // Load origin and orientation of the frustum.
-    XMVECTOR vOrigin = XMLoadFloat3(&WSpaceFrustum.Origin);
-    XMVECTOR vOrientation = XMLoadFloat4(&WSpaceFrustum.Orientation);
+    impostorsData_.clear();
+    impostorBatches_.clear();
 
-    // Create 6 planes (do it inline to encourage use of registers)
-    XMVECTOR NearPlane = XMVectorSet(0.0f, 0.0f, -1.0f, WSpaceFrustum.Near);
-    NearPlane = DirectX::Internal::XMPlaneTransform(NearPlane, vOrientation, vOrigin);
-    NearPlane = XMPlaneNormalize(NearPlane);
+    const cvector<EntityID>& impostors = rsDataToRender_.enttsImpostors_.ids_;
 
-    XMVECTOR FarPlane = XMVectorSet(0.0f, 0.0f, 1.0f, -WSpaceFrustum.Far);
-    FarPlane = DirectX::Internal::XMPlaneTransform(FarPlane, vOrientation, vOrigin);
-    FarPlane = XMPlaneNormalize(FarPlane);
+    if (impostors.empty())
+        return;
 
-    XMVECTOR RightPlane = XMVectorSet(1.0f, 0.0f, -WSpaceFrustum.RightSlope, 0.0f);
-    RightPlane = DirectX::Internal::XMPlaneTransform(RightPlane, vOrientation, vOrigin);
-    RightPlane = XMPlaneNormalize(RightPlane);
+    cvector<ModelID>  modelsIDs;
+    cvector<EntityID> enttsSortedByModels;
+    cvector<size>     numEnttsPerModel;
 
-    XMVECTOR LeftPlane = XMVectorSet(-1.0f, 0.0f, WSpaceFrustum.LeftSlope, 0.0f);
-    LeftPlane = DirectX::Internal::XMPlaneTransform(LeftPlane, vOrientation, vOrigin);
-    LeftPlane = XMPlaneNormalize(LeftPlane);
+    pEnttMgr->modelSystem_.GetModelsIdsRelatedToEntts(
+        impostors.data(),
+        impostors.size(),
+        modelsIDs,
+        enttsSortedByModels,
+        numEnttsPerModel);
 
-    XMVECTOR TopPlane = XMVectorSet(0.0f, 1.0f, -WSpaceFrustum.TopSlope, 0.0f);
-    TopPlane = DirectX::Internal::XMPlaneTransform(TopPlane, vOrientation, vOrigin);
-    TopPlane = XMPlaneNormalize(TopPlane);
+    const size numMaxImpostors = pRender->shadersContainer_.impostorShader_.GetMaxNumImpostors();
+    const size numImpostors    = std::min(enttsSortedByModels.size(), numMaxImpostors);
 
-    XMVECTOR BottomPlane = XMVectorSet(0.0f, -1.0f, WSpaceFrustum.BottomSlope, 0.0f);
-    BottomPlane = DirectX::Internal::XMPlaneTransform(BottomPlane, vOrientation, vOrigin);
-    BottomPlane = XMPlaneNormalize(BottomPlane);
+    ArenaSpan<XMMATRIX> worlds = frameArena_.Alloc<XMMATRIX>(numImpostors);
+    pEnttMgr->transformSystem_.GetRenderWorlds(enttsSortedByModels.data(), numImpostors, worlds.data());
 
+    impostorsData_.resize(numImpostors);
+    index enttIdx = 0;
 
-    // go through each entity and define if it is visible
-    for (index idx = 0; idx < numRenderableEntts; ++idx)
+    for (index modelIdx = 0; modelIdx < modelsIDs.size(); ++modelIdx)
     {
-        const DirectX::ContainmentType type = boundSpheres[idx].ContainedBy(NearPlane, FarPlane, RightPlane, LeftPlane, TopPlane, BottomPlane);
-        idxsToVisEntts[numVisEntts] = idx;
-        numVisEntts += ((type == INTERSECTS) | (type == CONTAINS));
-    }
-#endif
+        const ImpostorAtlas& atlas = g_ModelMgr.GetModelByID(modelsIDs[modelIdx]).impostor_;
+        const int            start = (int)enttIdx;
+        const index          end   = std::min(enttIdx + numEnttsPerModel[modelIdx], numImpostors);
 
-    // ------------------------------------------
+        for (; enttIdx < end; ++enttIdx)
+        {
+            const XMMATRIX& W   = worlds[enttIdx];
+            const XMVECTOR  fwd = W.r[2];                                // the model's +Z axis (with scale)
+            const float     scale = XMVectorGetX(XMVector3Length(fwd));
+            const float     fwdX  = XMVectorGetX(fwd);
+            const float     fwdZ  = XMVectorGetZ(fwd);
+            const float     lenXZ = sqrtf(fwdX*fwdX + fwdZ*fwdZ);
+
+            Render::ConstBufType::InstancedDataImpostor& data = impostorsData_[enttIdx];
+
+            XMStoreFloat3(&data.centerW, XMVector3Transform(XMLoadFloat3(&atlas.center), W));
+            data.size      = { atlas.size.x * scale, atlas.size.y * scale };
+            data.forwardXZ = (lenXZ > 0.0001f) ? XMFLOAT2(fwdX / lenXZ, fwdZ / lenXZ) : XMFLOAT2(0, 1);
+        }
 
-    // store ids of visible entts
-    cvector<EntityID>& visibleEntts = renderSys.GetAllVisibleEntts();
-    visibleEntts.resize(numVisEntts);
+        if (end > start)
+        {
+            ImpostorBatch batch;
+            batch.texID = atlas.texID;
+            batch.atlas = { (float)atlas.numViews, (float)atlas.numCols, (float)atlas.numRows, 0.0f };
+            batch.start = start;
+            batch.count = (int)(end - start);
 
-    for (index i = 0; i < numVisEntts; ++i)
-        visibleEntts[i] = enttsRenderable[idxsToVisEntts[i]];
+            impostorBatches_.push_back(batch);
+        }
+    }
 
-    sysState.visibleObjectsCount = (u32)numVisEntts;
+    // each impostor is a quad
+    pSysState_->visibleVerticesCount += 4 * (uint32)numImpostors;
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::ComputeFrustumCullingOfLightSources(
+void CGraphics::ComputeFrustumCulling(
     SystemState& sysState,
     ECS::EntityMgr* pEnttMgr)
 {
-    // store IDs of light sources which are currently visible by camera frustum
-    // (by visibility means the WHOLE area which is lit by this light source)
+    PROFILE_SCOPE("FrustumCulling");
 
-    using namespace DirectX;
     ECS::EntityMgr& mgr = *pEnttMgr;
+    ECS::RenderSystem& renderSys = mgr.renderSystem_;
 
-    mgr.renderSystem_.ClearVisibleLightSources();
-    cvector<EntityID>& visPointLights = mgr.renderSystem_.GetVisiblePointLights();
+    // the query is kept up to date by the entity mgr so we don't need to
+    // intersect renderable entts with bounding ones each frame
+    if (!pRenderableQuery_)
+        pRenderableQuery_ = &mgr.CreateQuery<ECS::Rendered, ECS::Bounding>();
+
+    cvector<EntityID>& visibleEntts = renderSys.GetAllVisibleEntts();
+    visibleEntts.clear();
+    sysState.visibleObjectsCount = 0;
+
+    if (pRenderableQuery_->GetEntts().empty())
+        return;
+
+    // world-space bounds (are refreshed by the bounding system only for moved entts)
+    const ECS::Bounding&         bounding = pRenderableQuery_->Get<ECS::Bounding>();
+    const ECS::Rendered&         rendered = pRenderableQuery_->Get<ECS::Rendered>();
+    const ECS::BoundingWorldSoA& world    = bounding.world;
+
+    // world-space planes of the camera frustum (are cached once per frame);
+    // the BVH takes outer planes and the batched tests take inner ones
+    const ECS::CameraFrameData& camFrame    = mgr.cameraSystem_.GetFrameData(currCameraID_);
+    const XMFLOAT4*             planes      = camFrame.planesW;
+    const XMFLOAT4*             innerPlanes = camFrame.innerPlanesW;
+
+    Frustum frustum;
+    frustum.Initialize(
+        &innerPlanes[0].x, &innerPlanes[1].x,
+        &innerPlanes[2].x, &innerPlanes[3].x,
+        &innerPlanes[4].x, &innerPlanes[5].x);
+
+    // traverse the BVH: whole subtrees outside of the frustum are skipped
+    cullInsideEntts_.clear();
+    cullIntersectedEntts_.clear();
+    bounding.tree.QueryFrustum(planes, 6, cullInsideEntts_, cullIntersectedEntts_);
+
+    visibleEntts.reserve(cullInsideEntts_.size() + cullIntersectedEntts_.size());
+
+    // small feature culling: drop entts whose bounding sphere radius is projected
+    // into less than smallCullPixels_ pixels (scaled by the entt's factor);
+    // r_px = r * proj[1][1] * (screenHeight / 2) / dist (so we compare squares)
+    const float    pixelScale  = sysState.cameraProj.r[1].m128_f32[1] * 0.5f * (float)d3d_.GetWindowHeight();
+    const float    minPixelsSq = smallCullPixels_ * smallCullPixels_;
+    const XMFLOAT3 camPos      = sysState.cameraPos;
+
+    auto IsBigEnough = [&](const index boundIdx, const index renderIdx)
+    {
+        const float dx     = world.sphereX[boundIdx] - camPos.x;
+        const float dy     = world.sphereY[boundIdx] - camPos.y;
+        const float dz     = world.sphereZ[boundIdx] - camPos.z;
+        const float rPx    = world.sphereR[boundIdx] * pixelScale;
+        const float factor = rendered.smallCullFactors[renderIdx];
+
+        return (rPx * rPx) >= (minPixelsSq * factor * factor * (dx*dx + dy*dy + dz*dz));
+    };
+
+    // entts of fully visible subtrees don't need any frustum test
+    for (const EntityID id : cullInsideEntts_)
+    {
+        const index renderIdx = rendered.sparseIdxs.GetIdx(id);
+
+        // merged static props are rendered by their cell entts
+        if ((renderIdx == ECS::SparseSet::INVALID_IDX) || (rendered.mergedInto[renderIdx] != INVALID_ENTITY_ID))
+            continue;
 
-    // get all the point light sources which are in the visibility range
-    const size numPointLights      = mgr.lightSystem_.GetNumPointLights();
-    const EntityID* pointLightsIDs = mgr.lightSystem_.GetPointLights().ids.data();
+        if (IsBigEnough(bounding.sparseIdxs.GetIdx(id), renderIdx))
+            visibleEntts.push_back(id);
+    }
+
+    // for entts on the frustum borders test their spheres: gather them in SoA layout
+    // and test by the batched SIMD kernel (in parallel if there are too many of them)
+    const size numIntersected = cullIntersectedEntts_.size();
 
+    ArenaSpan<EntityID> ids = frameArena_.Alloc<EntityID>(numIntersected);
+    ArenaSpan<float>    xs  = frameArena_.Alloc<float>(numIntersected);
+    ArenaSpan<float>    ys  = frameArena_.Alloc<float>(numIntersected);
+    ArenaSpan<float>    zs  = frameArena_.Alloc<float>(numIntersected);
+    ArenaSpan<float>    rs  = frameArena_.Alloc<float>(numIntersected);
+    int numToTest = 0;
+
+    for (const EntityID id : cullIntersectedEntts_)
+    {
+        const index renderIdx = rendered.sparseIdxs.GetIdx(id);
 
-    static cvector<XMMATRIX> invWorlds(numPointLights);
-    static cvector<XMMATRIX> localSpaces(numPointLights);
+        // merged static props are rendered by their cell entts
+        if ((renderIdx == ECS::SparseSet::INVALID_IDX) || (rendered.mergedInto[renderIdx] != INVALID_ENTITY_ID))
+            continue;
 
-    // get inverse world matrix of each point light source
-    mgr.transformSystem_.GetInverseWorlds(pointLightsIDs, numPointLights, invWorlds);
+        const index idx = bounding.sparseIdxs.GetIdx(id);
 
-    const XMMATRIX invView = mgr.cameraSystem_.GetInverseView(currCameraID_);
+        if (!IsBigEnough(idx, renderIdx))
+            continue;
 
-    // compute local space matrices for frustum transformations
-    for (int i = 0; i < numPointLights; ++i)
-        localSpaces[i] = DirectX::XMMatrixMultiply(invView, invWorlds[i]);
+        ids[numToTest] = id;
+        xs[numToTest]  = world.sphereX[idx];
+        ys[numToTest]  = world.sphereY[idx];
+        zs[numToTest]  = world.sphereZ[idx];
+        rs[numToTest]  = world.sphereR[idx];
+        ++numToTest;
+    }
 
-    visPointLights.resize(numPointLights);
-    u32 numVisPointLights = 0;
-    constexpr DirectX::BoundingSphere defaultBoundSphere({ 0,0,0 }, 1);
+    const index    numChunks      = (numToTest + CULL_JOB_GRAIN - 1) / CULL_JOB_GRAIN;
+    ArenaSpan<int> visIdxs        = frameArena_.Alloc<int>(numToTest);
+    ArenaSpan<int> numVisPerChunk = frameArena_.Alloc<int>(numChunks);
 
-    // go through each point light source and define if it is visible
-    for (int idx = 0; idx < numPointLights; ++idx)
+    // each chunk writes its compacted visible idxs into its own range of visIdxs
+    g_JobSystem.ParallelFor(numToTest, CULL_JOB_GRAIN, [&](const index start, const index end)
+    {
+        numVisPerChunk[start / CULL_JOB_GRAIN] = frustum.SphereTestBatch(
+            xs.data() + start,
+            ys.data() + start,
+            zs.data() + start,
+            rs.data() + start,
+            (int)(end - start),
+            visIdxs.data() + start);
+    });
+
+    for (index chunk = 0; chunk < numChunks; ++chunk)
     {
-        // transform the camera frustum from view space to the point light local space
-        BoundingFrustum LSpaceFrustum;
-        frustums_[0].Transform(LSpaceFrustum, localSpaces[idx]);
+        const index start = chunk * CULL_JOB_GRAIN;
 
-        // if we see any part of bound sphere we store an index to related light source
-        if (LSpaceFrustum.Intersects(defaultBoundSphere))
-            visPointLights[numVisPointLights++] = pointLightsIDs[idx];
+        for (int i = 0; i < numVisPerChunk[chunk]; ++i)
+            visibleEntts.push_back(ids[start + visIdxs[start + i]]);
     }
 
-    visPointLights.resize(numVisPointLights);
+    // the rest of the pipeline expects SORTED ids
+    std::sort(visibleEntts.begin(), visibleEntts.end());
 
-    // we'll use these values to render counts onto the screen
-    sysState.numVisiblePointLights = numVisPointLights;
+    sysState.visibleObjectsCount = (u32)visibleEntts.size();
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::UpdateShadersDataPerFrame(
+void CGraphics::ComputeOcclusionCulling(
+    SystemState& sysState,
     ECS::EntityMgr* pEnttMgr,
     Render::CRender* pRender)
 {
-    // Update shaders common data for this frame: 
-    // viewProj matrix, camera position, light sources data, etc.
+    // remove entts which are hidden behind others from the frustum visible ones;
+    // we test world AABBs against the Hi-Z buffer which was built from
+    // the depth of one of the prev frames (so there is no GPU stall)
 
-    Render::PerFrameData& perFrameData = pRender->perFrameData_;
+    PROFILE_SCOPE("OcclusionCulling");
 
-    perFrameData.viewProj = DirectX::XMMatrixTranspose(viewProj_);
-    perFrameData.cameraPos = pEnttMgr->transformSystem_.GetPosition(currCameraID_);
+    if (!isOcclusionCulling_)
+        return;
 
-    SetupLightsForFrame(pEnttMgr, perFrameData);
+    Render::HiZBuffer& hiZ = pRender->GetHiZBuffer();
+    hiZ.ReadBack(pDeviceContext_);
+
+    cvector<EntityID>& visibleEntts = pEnttMgr->renderSystem_.GetAllVisibleEntts();
+
+    if (!hiZ.IsReady() || visibleEntts.empty())
+        return;
+
+    const ECS::Bounding&         bounding = pRenderableQuery_->Get<ECS::Bounding>();
+    const ECS::BoundingWorldSoA& world    = bounding.world;
+    const index                  numEntts = visibleEntts.size();
+
+    ArenaSpan<uint8> isVisible = frameArena_.Alloc<uint8>(numEntts);
+
+    g_JobSystem.ParallelFor(numEntts, OCCLUSION_JOB_GRAIN, [&](const index start, const index end)
+    {
+        for (index i = start; i < end; ++i)
+        {
+            const index idx = bounding.sparseIdxs.GetIdx(visibleEntts[i]);
+
+            const XMFLOAT3 aabbMin(world.minX[idx], world.minY[idx], world.minZ[idx]);
+            const XMFLOAT3 aabbMax(world.maxX[idx], world.maxY[idx], world.maxZ[idx]);
+
+            isVisible[i] = hiZ.IsVisible(aabbMin, aabbMax);
+        }
+    });
+
+    // compact in place so the ids stay SORTED
+    index numVisible = 0;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        if (isVisible[i])
+            visibleEntts[numVisible++] = visibleEntts[i];
+    }
+
+    visibleEntts.resize(numVisible);
+    sysState.visibleObjectsCount = (u32)numVisible;
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::ComputeSoftwareOcclusionCulling(
+    SystemState& sysState,
+    ECS::EntityMgr* pEnttMgr)
+{
+    // remove entts which are hidden behind others from the frustum visible ones:
+    // the biggest of them on the screen are rasterized by proxies into a coarse
+    // CPU depth buffer of this frame and world AABBs are tested against it
+    // (is used instead of Hi-Z on low-end configs since it doesn't need the GPU)
+
+    PROFILE_SCOPE("SoftwareOcclusionCulling");
+
+    if (!isSoftOcclusionCulling_)
+        return;
+
+    cvector<EntityID>& visibleEntts = pEnttMgr->renderSystem_.GetAllVisibleEntts();
+
+    if (visibleEntts.empty())
+        return;
+
+    const ECS::Bounding&         bounding = pRenderableQuery_->Get<ECS::Bounding>();
+    const ECS::BoundingWorldSoA& world    = bounding.world;
+    const index                  numEntts = visibleEntts.size();
+
+    // choose occluders: entts which are the biggest on the screen
+    const float    projScaleY = sysState.cameraProj.r[1].m128_f32[1] * 0.5f;
+    const XMFLOAT3 camPos     = sysState.cameraPos;
+    const float    minSizeSq  = OCCLUDER_MIN_SCREEN_SIZE * OCCLUDER_MIN_SCREEN_SIZE;
+
+    ArenaSpan<float> sizes      = frameArena_.Alloc<float>(numEntts);
+    ArenaSpan<index> candidates = frameArena_.Alloc<index>(numEntts);
+    index            numCandidates = 0;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index idx = bounding.sparseIdxs.GetIdx(visibleEntts[i]);
+
+        const float dx = world.sphereX[idx] - camPos.x;
+        const float dy = world.sphereY[idx] - camPos.y;
+        const float dz = world.sphereZ[idx] - camPos.z;
+        const float r  = world.sphereR[idx];
+
+        // squared fraction of the screen height (as for LODs)
+        sizes[i] = 4.0f * r * r * projScaleY * projScaleY / (dx*dx + dy*dy + dz*dz + 1e-6f);
+
+        if (sizes[i] > minSizeSq)
+            candidates[numCandidates++] = i;
+    }
+
+    const index maxOccluders = SoftwareOcclusion::MAX_OCCLUDERS;
+    index* candidatesEnd = candidates.data() + numCandidates;
+
+    if (numCandidates > maxOccluders)
+    {
+        std::nth_element(candidates.data(), candidates.data() + maxOccluders, candidatesEnd,
+            [&sizes](const index a, const index b) { return sizes[a] > sizes[b]; });
+
+        numCandidates = maxOccluders;
+    }
+
+    // take those of them whose models have proxies (they are built by the first use)
+    ArenaSpan<EntityID>             occluderIds = frameArena_.Alloc<EntityID>(numCandidates);
+    ArenaSpan<const OccluderProxy*> proxies     = frameArena_.Alloc<const OccluderProxy*>(numCandidates);
+    index                           numOccluders = 0;
+
+    for (index i = 0; i < numCandidates; ++i)
+    {
+        const EntityID       enttID  = visibleEntts[candidates[i]];
+        const ModelID        modelID = pEnttMgr->modelSystem_.GetModelIdRelatedToEntt(enttID);
+        const OccluderProxy* pProxy  = softOcclusion_.GetProxy(g_ModelMgr.GetModelByID(modelID));
+
+        if (pProxy)
+        {
+            occluderIds[numOccluders] = enttID;
+            proxies[numOccluders++]   = pProxy;
+        }
+    }
+
+    softOcclusion_.BeginFrame(viewProj_);
+
+    if (numOccluders > 0)
+    {
+        const ECS::TransformSystem& transformSys = pEnttMgr->transformSystem_;
+        ArenaSpan<XMMATRIX>         worlds       = frameArena_.Alloc<XMMATRIX>(numOccluders);
+
+        transformSys.GetIdxs(occluderIds.data(), numOccluders, softOccluderIdxs_);
+        transformSys.GatherWorlds(softOccluderIdxs_.data(), numOccluders, worlds.data());
+
+        for (index i = 0; i < numOccluders; ++i)
+        {
+            // skip entts without a transformation (their record is "invalid")
+            if (softOccluderIdxs_[i] != 0)
+                softOcclusion_.AddOccluder(proxies[i], worlds[i]);
+        }
+    }
+
+    softOcclusion_.Rasterize();
+
+    if (softOcclusion_.GetNumOccluders() == 0)
+        return;
+
+    ArenaSpan<uint8> isVisible = frameArena_.Alloc<uint8>(numEntts);
+
+    g_JobSystem.ParallelFor(numEntts, OCCLUSION_JOB_GRAIN, [&](const index start, const index end)
+    {
+        for (index i = start; i < end; ++i)
+        {
+            const index idx = bounding.sparseIdxs.GetIdx(visibleEntts[i]);
+
+            const XMFLOAT3 aabbMin(world.minX[idx], world.minY[idx], world.minZ[idx]);
+            const XMFLOAT3 aabbMax(world.maxX[idx], world.maxY[idx], world.maxZ[idx]);
+
+            isVisible[i] = softOcclusion_.IsVisible(aabbMin, aabbMax);
+        }
+    });
+
+    // compact in place so the ids stay SORTED
+    index numVisible = 0;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        if (isVisible[i])
+            visibleEntts[numVisible++] = visibleEntts[i];
+    }
+
+    visibleEntts.resize(numVisible);
+    sysState.visibleObjectsCount = (u32)numVisible;
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::ComputeHorizonCulling(
+    SystemState& sysState,
+    ECS::EntityMgr* pEnttMgr,
+    const Render::CRender* pRender)
+{
+    // remove entts which are hidden behind hills: world AABBs are tested against
+    // the horizon buffer which was built by the terrain's patches in this frame
+    // (by the ring which is closer than the entt so it is hidden only by the terrain before it)
+
+    PROFILE_SCOPE("HorizonCulling");
+
+    // the horizon is built only by the geomipmapped terrain which is updated on CPU
+    if (!isTerrainHorizonCulling_ || isTerrainStreaming_ || IsTerrainTessellated(pRender))
+        return;
+
+    const TerrainHorizon& horizon = g_ModelMgr.GetTerrainGeomip().GetHorizon();
+
+    if (!horizon.IsActive())
+        return;
+
+    cvector<EntityID>& visibleEntts = pEnttMgr->renderSystem_.GetAllVisibleEntts();
+
+    if (visibleEntts.empty())
+        return;
+
+    const ECS::Bounding&         bounding = pRenderableQuery_->Get<ECS::Bounding>();
+    const ECS::BoundingWorldSoA& world    = bounding.world;
+    const index                  numEntts = visibleEntts.size();
+
+    // compact in place so the ids stay SORTED
+    index numVisible = 0;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index idx = bounding.sparseIdxs.GetIdx(visibleEntts[i]);
+
+        const bool isOccluded = horizon.IsOccludedByRings(
+            world.minX[idx], world.minY[idx], world.minZ[idx],
+            world.maxX[idx], world.maxY[idx], world.maxZ[idx]);
+
+        if (!isOccluded)
+            visibleEntts[numVisible++] = visibleEntts[i];
+    }
+
+    visibleEntts.resize(numVisible);
+    sysState.visibleObjectsCount = (u32)numVisible;
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::ComputePortalCulling(SystemState& sysState, ECS::EntityMgr* pEnttMgr)
+{
+    // remove entts of interiors which aren't seen through portals: cells are reached
+    // from the camera's cell by open portals which narrow the camera frustum and
+    // world AABBs of entts are tested against frusta of the cells they touch;
+    // the result is used by the lights culling as well
+
+    PROFILE_SCOPE("PortalCulling");
+
+    if (!isPortalCulling_)
+        return;
+
+    ECS::EntityMgr&     mgr       = *pEnttMgr;
+    ECS::PortalSystem&  portalSys = mgr.portalSystem_;
+
+    // the scene has no cells (the visibility isn't restricted)
+    if (!portalSys.ComputeVisibility(sysState.cameraPos, mgr.cameraSystem_.GetFrameData(currCameraID_).innerPlanesW))
+        return;
+
+    cvector<EntityID>& visibleEntts = mgr.renderSystem_.GetAllVisibleEntts();
+
+    if (visibleEntts.empty())
+        return;
+
+    const ECS::Bounding&         bounding = pRenderableQuery_->Get<ECS::Bounding>();
+    const ECS::BoundingWorldSoA& world    = bounding.world;
+    const index                  numEntts = visibleEntts.size();
+
+    // compact in place so the ids stay SORTED
+    index numVisible = 0;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index idx = bounding.sparseIdxs.GetIdx(visibleEntts[i]);
+
+        const DirectX::XMFLOAT3 minP = { world.minX[idx], world.minY[idx], world.minZ[idx] };
+        const DirectX::XMFLOAT3 maxP = { world.maxX[idx], world.maxY[idx], world.maxZ[idx] };
+
+        if (portalSys.IsBoxVisible(minP, maxP))
+            visibleEntts[numVisible++] = visibleEntts[i];
+    }
+
+    visibleEntts.resize(numVisible);
+    sysState.visibleObjectsCount = (u32)numVisible;
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::ComputeLodsOfVisibleEntts(
+    const SystemState& sysState,
+    ECS::EntityMgr* pEnttMgr)
+{
+    // select a level of detail of each visible entt by the projected size
+    // of its bounding sphere (as a fraction of the screen height)
+
+    PROFILE_SCOPE("ComputeLods");
+
+    const cvector<EntityID>& visibleEntts = pEnttMgr->renderSystem_.GetAllVisibleEntts();
+    const index              numEntts     = visibleEntts.size();
+
+    if (numEntts == 0)
+        return;
+
+    const ECS::Bounding&         bounding = pRenderableQuery_->Get<ECS::Bounding>();
+    const ECS::BoundingWorldSoA& world    = bounding.world;
+
+    // projected radius (in NDC) == radius * proj[1][1] / dist and NDC height == 2
+    const float    projScaleY = sysState.cameraProj.r[1].m128_f32[1] * 0.5f;
+    const XMFLOAT3 camPos     = sysState.cameraPos;
+
+    // entts past this distance get the impostor LOD
+    const float impostorDistSq = (impostorDist_ > 0.0f) ? impostorDist_ * impostorDist_ : FLT_MAX;
+
+    ArenaSpan<uint8> lods = frameArena_.Alloc<uint8>(numEntts);
+
+    // the projected size (in pixels) is reported for textures of materials so
+    // the texture streamer knows which mips are wanted
+    const bool  isTexStreaming = g_TextureMgr.IsStreamingEnabled();
+    const float screenHeight   = (float)d3d_.GetWindowHeight();
+
+    if (isTexStreaming)
+        g_TextureMgr.BeginTexUsageReport();
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index idx = bounding.sparseIdxs.GetIdx(visibleEntts[i]);
+
+        const float dx = world.sphereX[idx] - camPos.x;
+        const float dy = world.sphereY[idx] - camPos.y;
+        const float dz = world.sphereZ[idx] - camPos.z;
+        const float r  = world.sphereR[idx];
+
+        // compare squares to avoid sqrt: (2 * r * scale)^2 < size^2 * dist^2
+        const float diameterSq = 4.0f * r * r * projScaleY * projScaleY;
+        const float distSq     = dx*dx + dy*dy + dz*dz;
+
+        uint8 lod = 0;
+
+        while ((lod < MAX_NUM_MESH_LODS - 1) &&
+               (diameterSq < LOD_SCREEN_SIZES[lod] * LOD_SCREEN_SIZES[lod] * distSq))
+        {
+            ++lod;
+        }
+
+        lods[i] = (distSq > impostorDistSq) ? IMPOSTOR_LOD : lod;
+
+        if (isTexStreaming && (lods[i] != IMPOSTOR_LOD))
+        {
+            const float sizePx = sqrtf(diameterSq / (distSq + 1e-6f)) * screenHeight;
+            const ECS::MaterialData data = pEnttMgr->materialSystem_.GetDataByEnttID(visibleEntts[i]);
+
+            for (const MaterialID matID : data.materialsIDs)
+            {
+                const Material& mat = g_MaterialMgr.GetMaterialByID(matID);
+                g_TextureMgr.ReportTexUsage(mat.textureIDs, NUM_TEXTURE_TYPES, sizePx);
+            }
+        }
+    }
+
+    pEnttMgr->renderSystem_.SetLods(visibleEntts.data(), lods.data(), numEntts);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::ComputeFrustumCullingOfLightSources(
+    SystemState& sysState,
+    ECS::EntityMgr* pEnttMgr)
+{
+    // store IDs of light sources which are currently visible by camera frustum
+    // (by visibility means the WHOLE area which is lit by this light source):
+    // point lights are tested by their range spheres and spotlights by spheres
+    // which bound their cones; all the tests are in world space by the batched kernel;
+    // then lights which contribute too little to the screen are faded/dropped (light LOD)
+
+    PROFILE_SCOPE("LightsCulling");
+
+    using namespace DirectX;
+    ECS::EntityMgr&         mgr      = *pEnttMgr;
+    const ECS::LightSystem& lightSys = mgr.lightSystem_;
+    LightTempData&          tmp      = lightTempData_;
+
+    mgr.renderSystem_.ClearVisibleLightSources();
+    cvector<EntityID>& visPointLights = mgr.renderSystem_.GetVisiblePointLights();
+    cvector<EntityID>& visSpotLights  = mgr.renderSystem_.GetVisibleSpotLights();
+
+    tmp.visPointLightFades.clear();
+    tmp.visSpotLightFades.clear();
+
+    const ECS::PointLights& pointLights = lightSys.GetPointLights();
+    const ECS::SpotLights&  spotLights  = lightSys.GetSpotLights();
+    const size numPointLights = pointLights.ids.size();
+    const size numSpotLights  = spotLights.ids.size();
+
+    // world-space planes of the camera frustum (are cached once per frame)
+    const XMFLOAT4* innerPlanes = mgr.cameraSystem_.GetFrameData(currCameraID_).innerPlanesW;
+
+    // lights of interiors are culled by the last computed portal visibility as well
+    const ECS::PortalSystem& portalSys    = mgr.portalSystem_;
+    const bool               isPortalTest = isPortalCulling_ && portalSys.IsActive();
+
+    // baked static lights are applied by the light volume (unless they aren't static anymore)
+    const bool isBakedTest = isBakedStaticLights_ && lightBaker_.HasVolume();
+
+    auto IsBaked = [&](const EntityID id)
+    {
+        return isBakedTest && lightBaker_.IsBaked(id) && lightSys.IsStatic(id);
+    };
+
+    Frustum frustum;
+    frustum.Initialize(
+        &innerPlanes[0].x, &innerPlanes[1].x,
+        &innerPlanes[2].x, &innerPlanes[3].x,
+        &innerPlanes[4].x, &innerPlanes[5].x);
+
+    // light LOD: a contribution is the radius of the bound sphere in pixels scaled by the brightness;
+    // r_px = r * proj[1][1] * (screenHeight / 2) / dist
+    const float    pixelScale = sysState.cameraProj.r[1].m128_f32[1] * 0.5f * (float)d3d_.GetWindowHeight();
+    const float    minPixels  = lightLodPixels_;
+    const XMFLOAT3 camPos     = sysState.cameraPos;
+
+    auto GetLodFade = [&](const float x, const float y, const float z, const float r, const XMFLOAT4& diffuse)
+    {
+        if (minPixels <= 0.0f)
+            return 1.0f;
+
+        const float dx        = x - camPos.x;
+        const float dy        = y - camPos.y;
+        const float dz        = z - camPos.z;
+        const float dist      = sqrtf(dx*dx + dy*dy + dz*dz);
+        const float intensity = std::max(diffuse.x, std::max(diffuse.y, diffuse.z));
+
+        // the camera is inside the lit area
+        if (dist <= r)
+            return (intensity > 0.0f) ? 1.0f : 0.0f;
+
+        const float contribution = r * pixelScale * intensity / dist;
+
+        // fade in over [min, 2*min] so lights don't pop
+        return MathHelper::Clamp((contribution - minPixels) / minPixels, 0.0f, 1.0f);
+    };
+
+    // ----------------------------------------------------
+    // point lights: range spheres
+
+    if (numPointLights > 0)
+    {
+        ArenaSpan<XMFLOAT3> positions = frameArena_.Alloc<XMFLOAT3>(numPointLights);
+        ArenaSpan<float>    xs        = frameArena_.Alloc<float>(numPointLights);
+        ArenaSpan<float>    ys        = frameArena_.Alloc<float>(numPointLights);
+        ArenaSpan<float>    zs        = frameArena_.Alloc<float>(numPointLights);
+        ArenaSpan<int>      visIdxs   = frameArena_.Alloc<int>(numPointLights);
+
+        // positions are read right from the Transform component
+        const ConstSpan<XMFLOAT4> posAndScales = mgr.transformSystem_.GetPosAndUniformScalesSpan();
+        mgr.transformSystem_.GetIdxs(pointLights.ids.data(), numPointLights, tmp.transformIdxs);
+
+        for (index i = 0; i < numPointLights; ++i)
+        {
+            const XMFLOAT4& pos = posAndScales[tmp.transformIdxs[i]];
+            xs[i] = pos.x;
+            ys[i] = pos.y;
+            zs[i] = pos.z;
+        }
+
+        // ranges are already in SoA layout
+        const int numVis = frustum.SphereTestBatch(
+            xs.data(), ys.data(), zs.data(),
+            pointLights.range.data(),
+            (int)numPointLights,
+            visIdxs.data());
+
+        visPointLights.reserve(numVis);
+        tmp.visPointLightFades.reserve(numVis);
+
+        // visible idxs are ascending so the output ids remain SORTED
+        for (int i = 0; i < numVis; ++i)
+        {
+            const index idx  = visIdxs[i];
+
+            if (isPortalTest && !portalSys.IsSphereVisible(xs[idx], ys[idx], zs[idx], pointLights.range[idx]))
+                continue;
+
+            if (IsBaked(pointLights.ids[idx]))
+                continue;
+
+            const float fade = GetLodFade(xs[idx], ys[idx], zs[idx], pointLights.range[idx], pointLights.diffuse[idx]);
+
+            if (fade <= 0.0f)
+                continue;
+
+            visPointLights.push_back(pointLights.ids[idx]);
+            tmp.visPointLightFades.push_back(fade);
+        }
+    }
+
+    // ----------------------------------------------------
+    // spotlights: spheres which bound their cones
+
+    if (numSpotLights > 0)
+    {
+        ArenaSpan<float> xs      = frameArena_.Alloc<float>(numSpotLights);
+        ArenaSpan<float> ys      = frameArena_.Alloc<float>(numSpotLights);
+        ArenaSpan<float> zs      = frameArena_.Alloc<float>(numSpotLights);
+        ArenaSpan<float> rs      = frameArena_.Alloc<float>(numSpotLights);
+        ArenaSpan<int>   visIdxs = frameArena_.Alloc<int>(numSpotLights);
+
+        mgr.transformSystem_.GetPositionsAndDirections(
+            spotLights.ids.data(),
+            numSpotLights,
+            tmp.spotLightsPositions,
+            tmp.spotLightsDirections);
+
+        for (index i = 0; i < numSpotLights; ++i)
+        {
+            // the cone ends where the spot factor pow(cos(a), spot) falls below the cutoff
+            constexpr float spotCutoff = 0.01f;
+            const float     range      = spotLights.range[i];
+            const float     spot       = spotLights.spot[i];
+            const float     cosA       = (spot > 0.0f) ? powf(spotCutoff, 1.0f / spot) : 0.0f;
+
+            const XMFLOAT3& pos = tmp.spotLightsPositions[i];
+            XMFLOAT3        dir = tmp.spotLightsDirections[i];
+            const float     len = sqrtf(dir.x*dir.x + dir.y*dir.y + dir.z*dir.z);
+
+            if (len > 0.0f)
+            {
+                dir.x /= len;
+                dir.y /= len;
+                dir.z /= len;
+            }
+
+            // the min sphere of the cone: for wide cones it is the sphere of its base disk,
+            // for narrow ones the sphere through the apex and the base circle
+            float offset, radius;
+
+            if (cosA < 0.70710678f)
+            {
+                offset = range * cosA;
+                radius = range * sqrtf(std::max(0.0f, 1.0f - cosA*cosA));
+
+                // a cone wider than a hemisphere: bound by the range sphere
+                if (cosA <= 0.0f)
+                {
+                    offset = 0.0f;
+                    radius = range;
+                }
+            }
+            else
+            {
+                offset = range / (2.0f * cosA);
+                radius = offset;
+            }
+
+            xs[i] = pos.x + dir.x * offset;
+            ys[i] = pos.y + dir.y * offset;
+            zs[i] = pos.z + dir.z * offset;
+            rs[i] = radius;
+        }
+
+        const int numVis = frustum.SphereTestBatch(
+            xs.data(), ys.data(), zs.data(), rs.data(),
+            (int)numSpotLights,
+            visIdxs.data());
+
+        visSpotLights.reserve(numVis + 1);
+        tmp.visSpotLightFades.reserve(numVis + 1);
+
+        // the first spotlight is the flashlight: the shaders always expect it by idx 0
+        visSpotLights.push_back(spotLights.ids[0]);
+        tmp.visSpotLightFades.push_back(1.0f);
+
+        for (int i = 0; i < numVis; ++i)
+        {
+            const index idx = visIdxs[i];
+
+            if (idx == 0)
+                continue;
+
+            if (isPortalTest && !portalSys.IsSphereVisible(xs[idx], ys[idx], zs[idx], rs[idx]))
+                continue;
+
+            if (IsBaked(spotLights.ids[idx]))
+                continue;
+
+            const float fade = GetLodFade(xs[idx], ys[idx], zs[idx], rs[idx], spotLights.diffuse[idx]);
+
+            if (fade <= 0.0f)
+                continue;
+
+            visSpotLights.push_back(spotLights.ids[idx]);
+            tmp.visSpotLightFades.push_back(fade);
+        }
+    }
+
+    // we'll use these values to render counts onto the screen
+    sysState.numVisiblePointLights = (u32)visPointLights.size();
+    sysState.numVisibleSpotLights  = (u32)visSpotLights.size();
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UpdateMaterialsTable(Render::CRender* pRender)
+{
+    // upload colors of all the materials into the GPU table (structured buffer)
+    // so instances refer to their materials only by idx
+
+    const uint32 version = g_MaterialMgr.GetColorsVersion();
+
+    if (version == materialsTableVersion_)
+        return;
+
+    const size numMaterials = g_MaterialMgr.GetNumAllMaterials();
+    materialsTable_.resize(numMaterials);
+    materialTexLayers_.resize(numMaterials);
+
+    if (isPackMaterialTextures_ && (numMaterials != numPackedMaterials_))
+        PackMaterialsTextures(pRender);
+
+    for (index i = 0; i < numMaterials; ++i)
+    {
+        const Material& mat = g_MaterialMgr.GetMaterialByIdx(i);
+
+        materialsTable_[i].ambient_  = DirectX::XMFLOAT4(&mat.ambient.x);
+        materialsTable_[i].diffuse_  = DirectX::XMFLOAT4(&mat.diffuse.x);
+        materialsTable_[i].specular_ = DirectX::XMFLOAT4(&mat.specular.x);
+        materialsTable_[i].reflect_  = DirectX::XMFLOAT4(&mat.reflect.x);
+
+        materialTexLayers_[i].diffuse = g_TextureMgr.GetLayerInTexArr(packedDiffuseArrID_, mat.textureIDs[TEX_TYPE_DIFFUSE]);
+        materialTexLayers_[i].normal  = g_TextureMgr.GetLayerInTexArr(packedNormalArrID_,  mat.textureIDs[TEX_TYPE_NORMALS]);
+    }
+
+    pRender->UpdateMaterialsTable(
+        pDeviceContext_,
+        materialsTable_.data(),
+        materialTexLayers_.data(),
+        (int)numMaterials);
+
+    materialsTableVersion_ = version;
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::PackMaterialsTextures(Render::CRender* pRender)
+{
+    // pack diffuse and normal maps of all the materials into texture arrays
+    // so subsets with different materials don't need separate texture binds
+    // (the LightPS samples them by layers from the materials table)
+
+    const size numMaterials = g_MaterialMgr.GetNumAllMaterials();
+    cvector<TexID> diffuseIDs;
+    cvector<TexID> normalIDs;
+
+    diffuseIDs.resize(numMaterials);
+    normalIDs.resize(numMaterials);
+
+    for (index i = 0; i < numMaterials; ++i)
+    {
+        const Material& mat = g_MaterialMgr.GetMaterialByIdx(i);
+        diffuseIDs[i] = mat.textureIDs[TEX_TYPE_DIFFUSE];
+        normalIDs[i]  = mat.textureIDs[TEX_TYPE_NORMALS];
+    }
+
+    packedDiffuseArrID_ = g_TextureMgr.PackIntoTextureArray("packed_diffuse_maps", diffuseIDs.data(), numMaterials);
+    packedNormalArrID_  = g_TextureMgr.PackIntoTextureArray("packed_normal_maps",  normalIDs.data(),  numMaterials);
+    numPackedMaterials_ = numMaterials;
+
+    ID3D11ShaderResourceView* pDiffuseArr = (packedDiffuseArrID_ != INVALID_TEXTURE_ID) ? g_TextureMgr.GetSRVByTexID(packedDiffuseArrID_) : nullptr;
+    ID3D11ShaderResourceView* pNormalArr  = (packedNormalArrID_  != INVALID_TEXTURE_ID) ? g_TextureMgr.GetSRVByTexID(packedNormalArrID_)  : nullptr;
+
+    pRender->SetMaterialTexArrays(pDiffuseArr, pNormalArr);
+    prep_.SetPackedTexArrs(packedDiffuseArrID_, packedNormalArrID_);
+
+    // the cached instances don't know about the new layers
+    InvalidateVisibilityCache();
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UpdateGpuScene(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender)
+{
+    // upload all the entts with default render states into the GPU culling;
+    // it is done only if entts were added/removed/moved so as long as the scene
+    // is still the CPU cost of the opaque pass doesn't depend on the number of entts
+
+    ECS::EntityMgr& mgr = *pEnttMgr;
+
+    // only movements of the uploaded entts matter (not of the camera, lights, etc.)
+    bool isAnyMoved = false;
+
+    for (const EntityID id : mgr.transformSystem_.GetChangedEntts())
+    {
+        if (gpuSceneRsData_.enttsDefault_.ids_.binary_search(id))
+        {
+            isAnyMoved = true;
+            break;
+        }
+    }
+
+    const bool isSceneStill =
+        isGpuSceneValid_ &&
+        !isAnyMoved &&
+        !mgr.texTransformSystem_.HasCpuTexAnimations() &&
+        (mgr.GetStructureVersion() == gpuSceneVersion_);
+
+    if (isSceneStill)
+        return;
+
+    if (!pRenderableQuery_)
+        pRenderableQuery_ = &mgr.CreateQuery<ECS::Rendered, ECS::Bounding>();
+
+    const cvector<EntityID>& allRenderable = pRenderableQuery_->GetEntts();
+    const ECS::Rendered&     rendered      = pRenderableQuery_->Get<ECS::Rendered>();
+
+    // merged static props are culled and rendered as parts of their cells
+    cvector<EntityID> renderableEntts;
+    renderableEntts.reserve(allRenderable.size());
+
+    for (const EntityID id : allRenderable)
+    {
+        const index renderIdx = rendered.sparseIdxs.GetIdx(id);
+
+        if ((renderIdx != ECS::SparseSet::INVALID_IDX) && (rendered.mergedInto[renderIdx] == INVALID_ENTITY_ID))
+            renderableEntts.push_back(id);
+    }
+
+    gpuSceneRsData_.Clear();
+    gpuSceneInstances_.clear();
+    gpuSceneBounds_.clear();
+    gpuSceneDraws_.clear();
+    gpuSceneClusters_.clear();
+    gpuSceneInstBuffer_.Resize(0);
+
+    if (!renderableEntts.empty())
+        mgr.renderStatesSystem_.SeparateEnttsByRenderStates(renderableEntts, gpuSceneRsData_);
+
+    const cvector<EntityID>& ids = gpuSceneRsData_.enttsDefault_.ids_;
+
+    if (!ids.empty())
+    {
+        prep_.PrepareGpuSceneData(
+            ids.data(),
+            ids.size(),
+            pEnttMgr,
+            frameArena_,
+            gpuSceneInstBuffer_,
+            gpuSceneInstances_,
+            gpuSceneBounds_,
+            gpuSceneDraws_,
+            gpuSceneClusters_);
+    }
+
+    pRender->GetGpuCulling().Upload(
+        pDeviceContext_,
+        gpuSceneInstBuffer_,
+        gpuSceneBounds_.data(),
+        gpuSceneInstances_,
+        gpuSceneDraws_,
+        gpuSceneClusters_);
+
+    gpuSceneVersion_ = mgr.GetStructureVersion();
+    isGpuSceneValid_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UpdateStaticBatches(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender)
+{
+    // upload records of static entts with default render states into static batches;
+    // it is done only if entts were added/removed, marked as static (or not) or
+    // some static entt was moved anyway
+
+    ECS::EntityMgr& mgr = *pEnttMgr;
+
+    bool isAnyMoved = false;
+
+    for (const EntityID id : mgr.transformSystem_.GetChangedEntts())
+    {
+        if (staticBatchesData_.entts.binary_search(id))
+        {
+            isAnyMoved = true;
+            break;
+        }
+    }
+
+    const bool isSceneStill =
+        isStaticBatchesValid_ &&
+        !isAnyMoved &&
+        !mgr.texTransformSystem_.HasCpuTexAnimations() &&
+        (mgr.GetStructureVersion() == staticSceneVersion_) &&
+        (mgr.renderSystem_.GetStaticVersion() == staticFlagsVersion_);
+
+    if (isSceneStill)
+        return;
+
+    if (!pRenderableQuery_)
+        pRenderableQuery_ = &mgr.CreateQuery<ECS::Rendered, ECS::Bounding>();
+
+    const cvector<EntityID>& renderableEntts = pRenderableQuery_->GetEntts();
+
+    // only entts with default render states go into batches
+    ECS::RenderStatesSystem::EnttsRenderStatesData rsData;
+    cvector<EntityID> staticEntts;
+    cvector<EntityID> ids;
+
+    if (!renderableEntts.empty())
+        mgr.renderStatesSystem_.SeparateEnttsByRenderStates(renderableEntts, rsData);
+
+    mgr.renderSystem_.GetStaticEntts(staticEntts);
+    ids.reserve(staticEntts.size());
+
+    const ECS::Rendered& rendered = pRenderableQuery_->Get<ECS::Rendered>();
+
+    // merged static props are rendered by their cells (which are static as well)
+    for (const EntityID id : rsData.enttsDefault_.ids_)
+    {
+        if (staticEntts.binary_search(id) && (rendered.mergedInto[rendered.sparseIdxs.GetIdx(id)] == INVALID_ENTITY_ID))
+            ids.push_back(id);
+    }
+
+    staticBatchesData_.Clear();
+    staticInstBuffer_.Resize(0);
+
+    if (!ids.empty())
+    {
+        prep_.PrepareStaticBatchesData(
+            ids.data(),
+            ids.size(),
+            pEnttMgr,
+            frameArena_,
+            staticInstBuffer_,
+            staticBatchesData_);
+    }
+
+    pRender->GetStaticBatches().Upload(pDeviceContext_, staticInstBuffer_);
+
+    // the batches can't be used if they aren't uploaded
+    if (!pRender->GetStaticBatches().HasBatches())
+        staticBatchesData_.Clear();
+
+    // cached instances may refer to the old batches
+    isVisCacheValid_      = false;
+    staticSceneVersion_   = mgr.GetStructureVersion();
+    staticFlagsVersion_   = mgr.renderSystem_.GetStaticVersion();
+    isStaticBatchesValid_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UpdateTerrainVT(Render::CRender* pRender)
+{
+    // the texture map of the loaded terrain is a virtual texture: its pages are
+    // requested by the terrain PS and are baked here a few per frame
+
+    PROFILE_SCOPE("UpdateTerrainVT");
+
+    if (!isTerrainVT_ || terrainStreamer_.IsActive())
+        return;
+
+    Render::VirtualTexture& vt = pRender->GetTerrainVT();
+
+    // the virtual texture is started by the first frame since the terrain
+    // (and its tiles) is created after the graphics
+    if (!terrainVT_.IsInitialized())
+    {
+        TerrainGeomipmapped& terrain = g_ModelMgr.GetTerrainGeomip();
+
+        if (!terrain.heightMap_.IsLoaded())
+            return;
+
+        isTerrainVT_ = terrainVT_.Initialize(pDevice_, vt, terrainVTParams_, &terrain);
+
+        // the terrain is textured by its texture map as before
+        if (!isTerrainVT_)
+            return;
+    }
+
+    terrainVT_.Update(pDeviceContext_, vt);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UpdateGrass(
+    const SystemState& sysState,
+    const float totalGameTime,
+    ECS::EntityMgr* pEnttMgr,
+    Render::CRender* pRender)
+{
+    // choose terrain patches within the grass distance which are inside of the frustum
+    // and scatter grass over them on GPU (the CPU cost depends only on the distance)
+
+    PROFILE_SCOPE("UpdateGrass");
+
+    Render::GrassScatter& grass = pRender->GetGrassScatter();
+
+    if (!grass.IsInitialized())
+        return;
+
+    const TerrainGeomipmapped& terrain = g_ModelMgr.GetTerrainGeomip();
+    const int numPatchesPerSide = terrain.numPatchesPerSide_;
+
+    Render::GrassFrame frame;
+    grassPatches_.clear();
+
+    // the streamed terrain has its own tiles: grass is scattered only over the loaded terrain
+    const bool hasTerrain =
+        !terrainStreamer_.IsActive() &&
+        (terrain.heightMapTexID_ != INVALID_TEXTURE_ID) &&
+        (numPatchesPerSide > 0) &&
+        (terrain.patchMinY_.size() == numPatchesPerSide * numPatchesPerSide);
+
+    if (!hasTerrain)
+    {
+        grass.Scatter(pDeviceContext_, nullptr, 0, frame);
+        return;
+    }
+
+    const ECS::CameraFrameData&     camFrame      = pEnttMgr->cameraSystem_.GetFrameData(currCameraID_);
+    const DirectX::BoundingFrustum& WSpaceFrustum = camFrame.frustumW;
+
+    const Render::GrassParams& params    = grass.GetParams();
+    const float                patchSize = (float)terrain.patchSize_;
+    const float                maxDist   = params.maxDistance;
+
+    // the camera in the height map space
+    const float camX = sysState.cameraPos.x - terrain.originX_;
+    const float camZ = sysState.cameraPos.z - terrain.originZ_;
+
+    const int px0 = std::max(0,                     (int)floorf((camX - maxDist) / patchSize));
+    const int pz0 = std::max(0,                     (int)floorf((camZ - maxDist) / patchSize));
+    const int px1 = std::min(numPatchesPerSide - 1, (int)floorf((camX + maxDist) / patchSize));
+    const int pz1 = std::min(numPatchesPerSide - 1, (int)floorf((camZ + maxDist) / patchSize));
+
+    for (int pz = pz0; pz <= pz1; ++pz)
+    {
+        for (int px = px0; px <= px1; ++px)
+        {
+            const float x0 = px * patchSize;
+            const float z0 = pz * patchSize;
+
+            // the closest point of the patch (by XZ) must be within the distance
+            const float dx = camX - std::clamp(camX, x0, x0 + patchSize);
+            const float dz = camZ - std::clamp(camZ, z0, z0 + patchSize);
+
+            if ((dx*dx + dz*dz) > (maxDist * maxDist))
+                continue;
+
+            const int   patchNum = terrain.GetPatchNumber(px, pz);
+            const float minY     = terrain.patchMinY_[patchNum];
+            const float maxY     = terrain.patchMaxY_[patchNum] + params.bladeHeight;
+
+            const DirectX::BoundingBox box(
+                { terrain.originX_ + x0 + 0.5f*patchSize, 0.5f * (minY + maxY), terrain.originZ_ + z0 + 0.5f*patchSize },
+                { 0.5f*patchSize, 0.5f * (maxY - minY), 0.5f*patchSize });
+
+            if (WSpaceFrustum.Intersects(box))
+                grassPatches_.push_back(Render::GrassPatch{ { x0, z0 }, { 0, 0 } });
+        }
+    }
+
+    // normals of the planes must look inside
+    for (int i = 0; i < 6; ++i)
+        frame.planes[i] = camFrame.innerPlanesW[i];
+
+    frame.viewProj    = viewProj_;
+    frame.cameraPos   = sysState.cameraPos;
+    frame.time        = totalGameTime;
+    frame.origin      = { terrain.originX_, terrain.originZ_ };
+    frame.heightScale = 255.0f * terrain.GetHeightScale();     // the height map is an 8-bit gray image
+    frame.texelSize   = 1.0f / (float)terrain.heightMap_.GetWidth();
+    frame.patchSize   = patchSize;
+
+    // the density and the color of grass come from the diffuse texture of the terrain
+    const Material& mat = g_MaterialMgr.GetMaterialByID(terrain.materialID_);
+
+    frame.pHeightMap  = g_TextureMgr.GetSRVByTexID(terrain.heightMapTexID_);
+    frame.pTextureMap = (mat.textureIDs[TEX_TYPE_DIFFUSE] != INVALID_TEXTURE_ID) ? g_TextureMgr.GetSRVByTexID(mat.textureIDs[TEX_TYPE_DIFFUSE]) : nullptr;
+    frame.pLightmap   = (terrain.lightmap_.id != INVALID_TEXTURE_ID) ? g_TextureMgr.GetSRVByTexID(terrain.lightmap_.id) : nullptr;
+
+    bool isFogEnabled = false;
+    pRender->GetFogData(frame.fogColor, frame.fogStart, frame.fogRange, isFogEnabled);
+
+    if (!isFogEnabled)
+        frame.fogRange = 0.0f;
+
+    grass.Scatter(pDeviceContext_, grassPatches_.data(), (UINT)grassPatches_.size(), frame);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UpdateSkinnedCrowds(
+    ECS::EntityMgr* pEnttMgr,
+    Render::CRender* pRender)
+{
+    // cull animated entts, choose a pair of baked frames for each of them and
+    // prepare an instanced batch per subset of each skinned model (poses aren't
+    // computed on CPU: the VS blends palettes from the animation texture)
+
+    PROFILE_SCOPE("UpdateSkinnedCrowds");
+
+    skinnedInstances_.clear();
+    skinnedBatches_.clear();
+
+    Render::SkinnedCrowds& crowds = pRender->GetSkinnedCrowds();
+
+    if (!crowds.IsInitialized())
+        return;
+
+    const ECS::Animator& animators = pEnttMgr->GetComponent<ECS::Animator>();
+
+    if (animators.ids_.empty())
+    {
+        crowds.UpdateInstances(pDeviceContext_, nullptr, 0);
+        return;
+    }
+
+    // cull by world bounding spheres
+    const DirectX::BoundingFrustum& WSpaceFrustum = pEnttMgr->cameraSystem_.GetFrameData(currCameraID_).frustumW;
+    cvector<DirectX::BoundingSphere> spheres;
+    cvector<EntityID>                visEntts;
+
+    pEnttMgr->boundingSystem_.GetWorldBoundSpheres(animators.ids_.data(), animators.ids_.size(), spheres);
+    visEntts.reserve(animators.ids_.size());
+
+    for (index i = 0; i < animators.ids_.size(); ++i)
+    {
+        if (WSpaceFrustum.Intersects(spheres[i]))
+            visEntts.push_back(animators.ids_[i]);
+    }
+
+    cvector<ModelID>  modelsIDs;
+    cvector<EntityID> enttsSortedByModels;
+    cvector<size>     numEnttsPerModel;
+
+    pEnttMgr->modelSystem_.GetModelsIdsRelatedToEntts(
+        visEntts.data(),
+        visEntts.size(),
+        modelsIDs,
+        enttsSortedByModels,
+        numEnttsPerModel);
+
+    const size          numEntts = enttsSortedByModels.size();
+    ArenaSpan<XMMATRIX> worlds   = frameArena_.Alloc<XMMATRIX>(numEntts);
+    pEnttMgr->transformSystem_.GetRenderWorlds(enttsSortedByModels.data(), numEntts, worlds.data());
+
+    const UINT capacity = crowds.GetCapacity();
+    index      enttIdx  = 0;
+
+    for (index modelIdx = 0; modelIdx < modelsIDs.size(); enttIdx += numEnttsPerModel[modelIdx++])
+    {
+        BasicModel& model = g_ModelMgr.GetModelByID(modelsIDs[modelIdx]);
+        const Core::SkinnedData& skinned = model.skinned_;
+
+        if (!skinned.IsSkinned() || skinned.clips.empty())
+            continue;
+
+        // upload the skin and palettes of the model when its first instance is visible
+        auto it = skinnedAnimSets_.find(model.id_);
+
+        if (it == skinnedAnimSets_.end())
+        {
+            const int animSet = crowds.AddAnimSet(
+                pDevice_,
+                skinned.skin.data(),
+                (UINT)skinned.skin.size(),
+                skinned.palettes.data()->rows,
+                skinned.GetNumBones(),
+                skinned.GetNumFrames());
+
+            it = skinnedAnimSets_.insert({ model.id_, animSet }).first;
+        }
+
+        if (it->second < 0)
+            continue;
+
+        const index enttsEnd = enttIdx + numEnttsPerModel[modelIdx];
+
+        const MeshGeometry&         meshes  = model.meshes_;
+        const MeshGeometry::Subset* subsets = model.GetSubsets();
+
+        // an instance per entity per subset: subsets differ by materials
+        for (int subsetIdx = 0; subsetIdx < model.GetNumSubsets(); ++subsetIdx)
+        {
+            const MeshGeometry::Subset& subset   = subsets[subsetIdx];
+            const size                  numToAdd = std::min(enttsEnd - enttIdx, (size)capacity - skinnedInstances_.size());
+
+            if (numToAdd <= 0)
+                break;
+
+            const Material& mat         = g_MaterialMgr.GetMaterialByID(subset.materialID);
+            const uint32    materialIdx = (uint32)g_MaterialMgr.GetMaterialIdxByID(subset.materialID);
+
+            Render::SkinnedBatch batch;
+            batch.animSet       = it->second;
+            batch.pVB           = meshes.GetVB();
+            batch.pIB           = meshes.GetIB();
+            batch.vertexStride  = (UINT)sizeof(Vertex3DPacked);
+            batch.indexFormat   = meshes.GetIndexFormat();
+            batch.indexCount    = subset.indexCount;
+            batch.startIndex    = meshes.GetBaseIndex() + subset.indexStart;
+            batch.baseVertex    = (INT)(meshes.GetBaseVertex() + subset.vertexStart);
+            batch.startInstance = (UINT)skinnedInstances_.size();
+            batch.numInstances  = (UINT)numToAdd;
+
+            g_TextureMgr.GetSRVsByTexIDs(mat.textureIDs, NUM_TEXTURE_TYPES, texturesBuf_);
+            memcpy(batch.texSRVs, texturesBuf_.begin(), NUM_TEXTURE_TYPES * sizeof(ID3D11ShaderResourceView*));
+
+            for (index i = enttIdx; i < enttIdx + numToAdd; ++i)
+            {
+                const index           animIdx = animators.sparseIdxs_.GetIdx(enttsSortedByModels[i]);
+                const uint16          clipIdx = animators.clipIdxs_[animIdx];
+                const Core::AnimClip& clip    = skinned.clips[(clipIdx < skinned.clips.size()) ? clipIdx : 0];
+
+                // clips are looped: blend the two nearest baked frames
+                const float  pos   = fmodf(animators.times_[animIdx] * clip.fps, (float)clip.numFrames);
+                const uint32 frame = std::min((uint32)pos, clip.numFrames - 1);
+
+                skinnedInstances_.push_back(Render::SkinnedInstance());
+                Render::SkinnedInstance& instance = skinnedInstances_.back();
+
+                const XMMATRIX W = DirectX::XMMatrixTranspose(worlds[i]);
+                DirectX::XMStoreFloat4(&instance.world[0], W.r[0]);
+                DirectX::XMStoreFloat4(&instance.world[1], W.r[1]);
+                DirectX::XMStoreFloat4(&instance.world[2], W.r[2]);
+
+                instance.materialIdx = materialIdx;
+                instance.frame0      = clip.firstFrame + frame;
+                instance.frame1      = clip.firstFrame + (frame + 1) % clip.numFrames;
+                instance.frameLerp   = pos - (float)frame;
+            }
+
+            skinnedBatches_.push_back(batch);
+        }
+    }
+
+    crowds.UpdateInstances(pDeviceContext_, skinnedInstances_.data(), (UINT)skinnedInstances_.size());
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UpdateShadows(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender)
+{
+    // set up cascades of the sun's shadow maps and prepare their casters: casters of
+    // each cascade are culled by the BVH; static ones are prepared only if the cache
+    // of the cascade is re-rendered (it was scrolled, the light was turned or static
+    // entts were changed), dynamic ones are prepared each frame
+
+    PROFILE_SCOPE("UpdateShadows");
+
+    ECS::EntityMgr&             mgr          = *pEnttMgr;
+    Render::ShadowMaps&         shadowMaps   = pRender->GetShadowMaps();
+    const Render::PerFrameData& perFrameData = pRender->perFrameData_;
+
+    isShadowsPass_ = false;
+
+    if (!IsShadows(pRender))
+        return;
+
+    // only the sun (the first directional light) casts shadows
+    if (perFrameData.numDirLights == 0)
+    {
+        shadowMaps.Disable(pDeviceContext_);
+        return;
+    }
+
+    // the set of static entts is refreshed only if entts were added/removed or marked as static (or not)
+    bool isStaticChanged =
+        (mgr.GetStructureVersion() != shadowSceneVersion_) ||
+        (mgr.renderSystem_.GetStaticVersion() != shadowFlagsVersion_);
+
+    if (isStaticChanged)
+    {
+        mgr.renderSystem_.GetStaticEntts(shadowStaticEntts_);
+        shadowSceneVersion_ = mgr.GetStructureVersion();
+        shadowFlagsVersion_ = mgr.renderSystem_.GetStaticVersion();
+    }
+
+    // a moved static entt invalidates the cache as well
+    const cvector<EntityID>& changedEntts = mgr.transformSystem_.GetChangedEntts();
+
+    for (index i = 0; !isStaticChanged && (i < changedEntts.size()); ++i)
+        isStaticChanged = shadowStaticEntts_.binary_search(changedEntts[i]);
+
+    shadowMaps.SetupCascades(
+        perFrameData.view,
+        perFrameData.proj,
+        perFrameData.dirLights[0].direction,
+        isStaticChanged);
+
+    if (!pRenderableQuery_)
+        pRenderableQuery_ = &mgr.CreateQuery<ECS::Rendered, ECS::Bounding>();
+
+    const ECS::Bounding& bounding = pRenderableQuery_->Get<ECS::Bounding>();
+    const ECS::Rendered& rendered = pRenderableQuery_->Get<ECS::Rendered>();
+
+    // prepare instances of either static or dynamic entts of the input list
+    auto PrepareCasters = [&](
+        const cvector<EntityID>& ids,
+        const bool isStatic,
+        Render::InstBuffData& outBuffer,
+        cvector<Render::Instance>& outInstances)
+    {
+        shadowPrepIds_.clear();
+
+        for (const EntityID id : ids)
+        {
+            if (shadowStaticEntts_.binary_search(id) == isStatic)
+                shadowPrepIds_.push_back(id);
+        }
+
+        if (shadowPrepIds_.empty())
+            return;
+
+        prep_.PrepareEnttsDataForRendering(
+            shadowPrepIds_.data(),
+            shadowPrepIds_.size(),
+            pEnttMgr,
+            frameArena_,
+            outBuffer,
+            outInstances,
+            perFrameData.cameraPos);
+    };
+
+    for (int i = 0; i < shadowMaps.GetNumCascades(); ++i)
+    {
+        const Render::ShadowCascade& cascade        = shadowMaps.GetCascade(i);
+        ShadowCasters&               staticCasters  = staticShadowCasters_[i];
+        ShadowCasters&               dynamicCasters = dynamicShadowCasters_[i];
+
+        staticCasters.Clear();
+        dynamicCasters.Clear();
+
+        // casters are inside of the cascade or between it and the light
+        shadowCasterIds_.clear();
+        shadowIntersectedIds_.clear();
+        bounding.tree.QueryFrustum(cascade.planes, 5, shadowCasterIds_, shadowIntersectedIds_);
+        shadowCasterIds_.append_vector(shadowIntersectedIds_);
+
+        // merged static props are rendered by their cell entts
+        size numCasters = 0;
+
+        for (const EntityID id : shadowCasterIds_)
+        {
+            const index renderIdx = rendered.sparseIdxs.GetIdx(id);
+
+            if ((renderIdx != ECS::SparseSet::INVALID_IDX) && (rendered.mergedInto[renderIdx] == INVALID_ENTITY_ID))
+                shadowCasterIds_[numCasters++] = id;
+        }
+
+        shadowCasterIds_.resize(numCasters);
+
+        if (shadowCasterIds_.empty())
+            continue;
+
+        // blended entts don't cast shadows
+        mgr.renderStatesSystem_.SeparateEnttsByRenderStates(shadowCasterIds_, shadowRsData_);
+
+        const cvector<EntityID>& opaqueIds    = shadowRsData_.enttsDefault_.ids_;
+        const cvector<EntityID>& alphaClipIds = shadowRsData_.enttsAlphaClipping_.ids_;
+
+        if (cascade.isStaticDirty)
+        {
+            PrepareCasters(opaqueIds,    true, staticCasters.opaqueBuffer,    staticCasters.opaque);
+            PrepareCasters(alphaClipIds, true, staticCasters.alphaClipBuffer, staticCasters.alphaClipped);
+        }
+
+        PrepareCasters(opaqueIds,    false, dynamicCasters.opaqueBuffer,    dynamicCasters.opaque);
+        PrepareCasters(alphaClipIds, false, dynamicCasters.alphaClipBuffer, dynamicCasters.alphaClipped);
+    }
+
+    isShadowsPass_ = true;
+}
+
+//---------------------------------------------------------
+// Desc:   set up the planar reflection by the mirror of this frame and prepare its
+//         casters: the mirror is prepared each frame (it is marked in the stencil),
+//         casters are culled by the reflected frustum and prepared with coarser LODs
+//         only if the reflection is re-rendered in this frame
+//---------------------------------------------------------
+void CGraphics::UpdatePlanarReflection(
+    const SystemState& sysState,
+    ECS::EntityMgr* pEnttMgr,
+    Render::CRender* pRender)
+{
+    PROFILE_SCOPE("UpdatePlanarReflection");
+
+    ECS::EntityMgr&           mgr  = *pEnttMgr;
+    Render::PlanarReflection& refl = pRender->GetPlanarReflection();
+
+    isReflectionPass_    = false;
+    isReflectionVisible_ = false;
+    reflectCasters_.Clear();
+    reflectMirror_.Clear();
+
+    if (!IsPlanarReflection(pRender))
+        return;
+
+    // params can be changed by cvars
+    refl.SetParams(reflectParams_);
+
+    if (isReflectionDirty_)
+    {
+        refl.Invalidate();
+        isReflectionDirty_ = false;
+    }
+
+    if (!pRenderableQuery_)
+        pRenderableQuery_ = &mgr.CreateQuery<ECS::Rendered, ECS::Bounding>();
+
+    const ECS::Bounding&         bounding = pRenderableQuery_->Get<ECS::Bounding>();
+    const ECS::Rendered&         rendered = pRenderableQuery_->Get<ECS::Rendered>();
+    const ECS::BoundingWorldSoA& world    = bounding.world;
+
+    // the mirror is rendered by itself (not by a merged cell)
+    const index mirrorRenderIdx = rendered.sparseIdxs.GetIdx(reflectMirrorID_);
+    const index mirrorBoundIdx  = bounding.sparseIdxs.GetIdx(reflectMirrorID_);
+
+    if ((mirrorRenderIdx == ECS::SparseSet::INVALID_IDX) ||
+        (mirrorBoundIdx  == ECS::SparseSet::INVALID_IDX) ||
+        (rendered.mergedInto[mirrorRenderIdx] != INVALID_ENTITY_ID))
+        return;
+
+    // nothing is reflected if the mirror is out of the camera frustum (planes look outside)
+    const ECS::CameraFrameData& camFrame = mgr.cameraSystem_.GetFrameData(currCameraID_);
+
+    const XMVECTOR center = XMVectorSet(
+        world.sphereX[mirrorBoundIdx],
+        world.sphereY[mirrorBoundIdx],
+        world.sphereZ[mirrorBoundIdx],
+        1.0f);
+
+    for (int i = 0; i < 6; ++i)
+    {
+        if (XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&camFrame.planesW[i]), center)) > world.sphereR[mirrorBoundIdx])
+            return;
+    }
+
+    // the plane goes through the origin of the mirror, its normal is the local Y axis
+    const XMMATRIX mirrorWorld = mgr.transformSystem_.GetWorldMatrixOfEntt(reflectMirrorID_);
+
+    XMFLOAT4 plane;
+    XMStoreFloat4(&plane, XMPlaneFromPointNormal(mirrorWorld.r[3], XMVector3Normalize(mirrorWorld.r[1])));
+
+    // the camera is behind the mirror
+    if (!refl.Setup(sysState.cameraView, sysState.cameraProj, sysState.cameraPos, plane, camFrame.planesW))
+        return;
+
+    // the set of casters is refreshed only if entts were added/removed or (un)marked as casters
+    if ((mgr.GetStructureVersion() != reflectSceneVersion_) ||
+        (mgr.renderSystem_.GetReflectionVersion() != reflectFlagsVersion_))
+    {
+        mgr.renderSystem_.GetReflectionCasters(reflectCasterEntts_);
+        reflectSceneVersion_ = mgr.GetStructureVersion();
+        reflectFlagsVersion_ = mgr.renderSystem_.GetReflectionVersion();
+    }
+
+    if (reflectCasterEntts_.empty())
+        return;
+
+    // the mirror is marked in the stencil each frame (by the camera of this frame)
+    const EntityID mirrorID = reflectMirrorID_;
+
+    prep_.PrepareEnttsDataForRendering(
+        &mirrorID,
+        1,
+        pEnttMgr,
+        frameArena_,
+        reflectMirror_.opaqueBuffer,
+        reflectMirror_.opaque,
+        sysState.cameraPos);
+
+    // the last image is reused between updates
+    isReflectionVisible_ = !reflectMirror_.opaque.empty();
+
+    if (!isReflectionVisible_ || !refl.NeedsUpdate())
+        return;
+
+    // casters are in the reflected frustum and in front of the mirror
+    reflectCasterIds_.clear();
+    reflectIntersectedIds_.clear();
+    bounding.tree.QueryFrustum(refl.GetCullPlanes(), Render::PlanarReflection::NUM_CULL_PLANES, reflectCasterIds_, reflectIntersectedIds_);
+    reflectCasterIds_.append_vector(reflectIntersectedIds_);
+
+    // only flagged entts are reflected; merged static props are rendered by their cell entts
+    size numCasters = 0;
+
+    for (const EntityID id : reflectCasterIds_)
+    {
+        const index renderIdx = rendered.sparseIdxs.GetIdx(id);
+
+        if ((id != mirrorID) &&
+            (renderIdx != ECS::SparseSet::INVALID_IDX) &&
+            (rendered.mergedInto[renderIdx] == INVALID_ENTITY_ID) &&
+            reflectCasterEntts_.binary_search(id))
+        {
+            reflectCasterIds_[numCasters++] = id;
+        }
+    }
+
+    reflectCasterIds_.resize(numCasters);
+
+    // the image is cleared even if there are no casters in the reflected frustum
+    isReflectionPass_ = true;
+
+    if (reflectCasterIds_.empty())
+        return;
+
+    // blended entts aren't reflected
+    mgr.renderStatesSystem_.SeparateEnttsByRenderStates(reflectCasterIds_, reflectRsData_);
+
+    // the same LOD selection as for the camera (see ComputeLodsOfVisibleEntts) by the
+    // distance to the reflected camera, but coarser by the bias; the LODs of the camera
+    // are restored right after the preparation
+    const float    projScaleY = sysState.cameraProj.r[1].m128_f32[1] * 0.5f;
+    const XMFLOAT3 camPos     = refl.GetCameraPos();
+    const int      lodBias    = refl.GetParams().lodBias;
+
+    auto PrepareCasters = [&](
+        const cvector<EntityID>& ids,
+        Render::InstBuffData& outBuffer,
+        cvector<Render::Instance>& outInstances)
+    {
+        if (ids.empty())
+            return;
+
+        reflectLods_.resize(ids.size());
+
+        for (index i = 0; i < ids.size(); ++i)
+        {
+            const index idx = bounding.sparseIdxs.GetIdx(ids[i]);
+
+            const float dx = world.sphereX[idx] - camPos.x;
+            const float dy = world.sphereY[idx] - camPos.y;
+            const float dz = world.sphereZ[idx] - camPos.z;
+            const float r  = world.sphereR[idx];
+
+            const float diameterSq = 4.0f * r * r * projScaleY * projScaleY;
+            const float distSq     = dx*dx + dy*dy + dz*dz;
+
+            int lod = 0;
+
+            while ((lod < MAX_NUM_MESH_LODS - 1) &&
+                   (diameterSq < LOD_SCREEN_SIZES[lod] * LOD_SCREEN_SIZES[lod] * distSq))
+            {
+                ++lod;
+            }
+
+            reflectLods_[i] = (uint8)std::min(lod + lodBias, MAX_NUM_MESH_LODS - 1);
+        }
+
+        mgr.renderSystem_.GetLods(ids.data(), ids.size(), reflectSavedLods_);
+        mgr.renderSystem_.SetLods(ids.data(), reflectLods_.data(), ids.size());
+
+        prep_.PrepareEnttsDataForRendering(
+            ids.data(),
+            ids.size(),
+            pEnttMgr,
+            frameArena_,
+            outBuffer,
+            outInstances,
+            camPos);
+
+        mgr.renderSystem_.SetLods(ids.data(), reflectSavedLods_.data(), ids.size());
+    };
+
+    PrepareCasters(reflectRsData_.enttsDefault_.ids_,       reflectCasters_.opaqueBuffer,    reflectCasters_.opaque);
+    PrepareCasters(reflectRsData_.enttsAlphaClipping_.ids_, reflectCasters_.alphaClipBuffer, reflectCasters_.alphaClipped);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UpdateParticles(
+    const SystemState& sysState,
+    const float deltaTime,
+    ECS::EntityMgr* pEnttMgr,
+    Render::CRender* pRender)
+{
+    // take the accumulated particles of emitters and spawn/simulate/sort them on GPU;
+    // the CPU cost depends only on the number of emitters which spawn in this frame
+
+    PROFILE_SCOPE("UpdateParticles");
+
+    Render::GpuParticles& particles = pRender->GetGpuParticles();
+
+    if (!particles.IsInitialized())
+        return;
+
+    pEnttMgr->particleSystem_.CollectEmissions(particleEmissions_);
+
+    const ECS::ParticleEmissions& emissions = particleEmissions_;
+    const size numEmitters = emissions.ids.size();
+
+    gpuEmitters_.resize(numEmitters);
+    numParticleTextures_ = 0;
+
+    for (index i = 0; i < numEmitters; ++i)
+    {
+        const ECS::ParticleEmitterParams& params = emissions.params[i];
+        Render::GpuParticleEmitter&       dst    = gpuEmitters_[i];
+
+        // textures of the frame are bound by slots: emitters with textures
+        // which don't fit into slots are rendered by round sprites
+        uint32 texSlot = 0xF;
+
+        if (params.texID != INVALID_TEXTURE_ID)
+        {
+            for (uint32 slot = 0; slot < numParticleTextures_; ++slot)
+            {
+                if (particleTexIDs_[slot] == params.texID)
+                {
+                    texSlot = slot;
+                    break;
+                }
+            }
+
+            if ((texSlot == 0xF) && (numParticleTextures_ < Render::GpuParticles::MAX_TEXTURES))
+            {
+                texSlot = numParticleTextures_;
+                particleTexIDs_[numParticleTextures_++] = params.texID;
+            }
+        }
+
+        dst.position   = emissions.positions[i];
+        dst.axis       = emissions.axes[i];
+        dst.numSpawns  = emissions.numSpawns[i];
+        dst.lifetime   = { params.minLifetime, params.maxLifetime };
+        dst.speed      = { params.minSpeed, params.maxSpeed };
+        dst.size       = { params.startSize, params.endSize };
+        dst.spreadCos  = cosf(params.spreadAngle);
+        dst.gravity    = params.gravity;
+        dst.startColor = Render::PackParticleColor(params.startColor);
+        dst.endColor   = Render::PackParticleColor(params.endColor);
+        dst.drag       = params.drag;
+        dst.flags      = Render::PackParticleFlags(
+                            texSlot,
+                            params.atlasCols,
+                            params.atlasRows,
+                            params.blend == ECS::PARTICLE_BLEND_ADDITIVE);
+    }
+
+    Render::GpuParticlesFrame frame;
+    frame.view         = sysState.cameraView;
+    frame.proj         = sysState.cameraProj;
+    frame.cameraPos    = sysState.cameraPos;
+    frame.deltaTime    = deltaTime;
+    frame.nearZ        = pEnttMgr->cameraSystem_.GetNearZ(currCameraID_);
+    frame.farZ         = pEnttMgr->cameraSystem_.GetFarZ(currCameraID_);
+    frame.softDistance = particlesSoftDistance_;
+
+    particles.Update(pDeviceContext_, gpuEmitters_.data(), (UINT)numEmitters, frame);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::SetupGpuCullParams(const SystemState& sysState, ECS::EntityMgr* pEnttMgr)
+{
+    // params of the GPU culling are the same as of the CPU culling
+    // (see ComputeFrustumCulling and ComputeLodsOfVisibleEntts)
+
+    // normals of the planes must look inside
+    const ECS::CameraFrameData& camFrame = pEnttMgr->cameraSystem_.GetFrameData(currCameraID_);
+
+    for (int i = 0; i < 6; ++i)
+        gpuCullParams_.planes[i] = camFrame.innerPlanesW[i];
+
+    gpuCullParams_.cameraPos  = sysState.cameraPos;
+    gpuCullParams_.projScaleY = sysState.cameraProj.r[1].m128_f32[1] * 0.5f;
+    gpuCullParams_.useHiZ     = isOcclusionCulling_;
+
+    for (int i = 0; i < MAX_NUM_MESH_LODS - 1; ++i)
+        gpuCullParams_.lodScreenSizes[i] = LOD_SCREEN_SIZES[i];
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UpdateShadersDataPerFrame(
+    ECS::EntityMgr* pEnttMgr,
+    Render::CRender* pRender)
+{
+    // Update shaders common data for this frame: 
+    // viewProj matrix, camera position, light sources data, etc.
+
+    PROFILE_SCOPE("UpdateShadersDataPerFrame");
+
+    Render::PerFrameData& perFrameData = pRender->perFrameData_;
+
+    perFrameData.view         = pSysState_->cameraView;
+    perFrameData.proj         = pSysState_->cameraProj;
+    perFrameData.viewProj     = DirectX::XMMatrixTranspose(viewProj_);
+    perFrameData.cameraPos    = pEnttMgr->transformSystem_.GetPosition(currCameraID_);
+    perFrameData.screenWidth  = (float)d3d_.GetWindowWidth();
+    perFrameData.screenHeight = (float)d3d_.GetWindowHeight();
+
+    SetupLightsForFrame(pEnttMgr, perFrameData);
+
+    // the volume of baked static lights is switched along with their culling
+    if (isBakedStaticLights_ && lightBaker_.HasVolume())
+    {
+        pRender->SetStaticLights(
+            lightBaker_.GetSRVs(),
+            lightBaker_.GetBoundsMin(),
+            lightBaker_.GetBoundsMax(),
+            lightBaker_.GetNormalBias());
+    }
+    else
+    {
+        pRender->SetStaticLights(nullptr, { 0,0,0 }, { 0,0,0 }, 0.0f);
+    }
 
     // update lighting data, camera pos, etc. for this frame
     pRender->UpdatePerFrame(pDeviceContext_, perFrameData);
@@ -643,407 +2869,1685 @@ void CGraphics::UpdateShadersDataPerFrame(
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::ClearRenderingDataBeforeFrame(
-    ECS::EntityMgr* pEnttMgr,
-    Render::CRender* pRender)
+void CGraphics::ClearRenderingDataBeforeFrame(
+    ECS::EntityMgr* pEnttMgr,
+    Render::CRender* pRender)
+{
+    // NOTE: rendering data of the previous frame / instances set is cleared
+    // only when it is rebuilt (see UpdateHelper) so the visibility cache can reuse it
+
+    // release transient data of the frame before the prev one
+    frameArena_.BeginFrame();
+
+    // release pooled render targets which aren't used anymore
+    renderGraph_.GetPool().EndFrame();
+}
+
+///////////////////////////////////////////////////////////
+
+// memory allocation and releasing
+void* CGraphics::operator new(size_t i)
+{
+    if (void* ptr = MemTracker::Allocate(i, 16, MEM_TAG_RENDER))
+        return ptr;
+
+    LogErr("can't allocate memory for this object");
+    throw std::bad_alloc{};
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::operator delete(void* ptr)
+{
+    MemTracker::Free(ptr);
+}
+
+
+// =================================================================================
+// Rendering methods
+// =================================================================================
+void CGraphics::RenderHelper(Render::CRender* pRender)
+{
+    PROFILE_SCOPE("CGraphics::Render3D");
+
+    try
+    {
+        // prepare the sky textures: in different shaders we will sample the sky
+        // texture pixels so we bind them only once at the beginning of the frame
+        const SkyModel& sky = g_ModelMgr.GetSky();
+        const TexID* skyTexIDs = sky.GetTexIDs();
+        const int skyTexMaxNum = sky.GetMaxTexturesNum();
+
+        // get shader resource views (textures) for the sky
+        ID3D11DeviceContext* pContext = pDeviceContext_;
+        g_TextureMgr.GetSRVsByTexIDs(skyTexIDs, skyTexMaxNum, texturesBuf_);
+        pRender->GetStateCache().SetPSShaderResources(pContext, 0U, 1U, texturesBuf_.data());
+
+        // the fog is blended into the sky by its LUT (is rebuilt only if the sky is changed)
+        pRender->UpdateSkyFog(pContext, texturesBuf_[0]);
+
+
+        // the passes are declared by a render graph which culls unused ones
+        // and binds/aliases their targets
+        SetupRenderGraph(pRender);
+
+        Render::StateCache& stateCache = pRender->GetStateCache();
+
+        for (int pass = 0; pass < renderGraph_.GetNumPasses(); ++pass)
+        {
+            if (!renderGraph_.BeginPass(pDevice_, pContext, stateCache, pass))
+                continue;
+
+            ExecuteScenePass(pRender, renderGraph_.GetPassType(pass));
+            renderGraph_.EndPass(pass);
+        }
+
+        // UI is rendered into the back buffer (the graph could unbind it)
+        if (!IsSceneTarget())
+        {
+            d3d_.ResetBackBufferRenderTarget();
+            d3d_.ResetViewport();
+        }
+
+    }
+    catch (const std::out_of_range& e)
+    {
+        LogErr(e.what());
+        LogErr("there is no such a key to data");
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't render 3D entts onto the scene");
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::RenderModel(BasicModel& model, const DirectX::XMMATRIX& world)
+{
+    // for specific purposes:
+    // just render a single asset/model at the center of the world
+}
+
+///////////////////////////////////////////////////////////
+
+void InitMatIconFrameBuffer(
+    ID3D11Device* pDevice,
+    FrameBuffer& buf,
+    const int iconWidth,
+    const int iconHeight,
+    const float nearZ,
+    const float farZ)
+{
+    // init a single frame buffer which is used to render material big icon (for the editor's material browser)
+
+    // setup params for the frame buffers
+    FrameBufferSpecification frameBufSpec;
+    frameBufSpec.width          = (UINT)iconWidth;
+    frameBufSpec.height         = (UINT)iconHeight;
+    frameBufSpec.format         = DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM;
+    frameBufSpec.screenNear     = nearZ;
+    frameBufSpec.screenDepth    = farZ;
+
+    // TODO: if input params differ from the frame buffer's params we need to recreate the frame buffer according to new params
+    
+    buf.Initialize(pDevice, frameBufSpec);
+}
+
+///////////////////////////////////////////////////////////
+
+bool CGraphics::RenderBigMaterialIcon(
+    const MaterialID matID,
+    const int iconWidth,
+    const int iconHeight,
+    const float yRotationAngle,
+    Render::CRender* pRender,
+    ID3D11ShaderResourceView** outMaterialImg)
+{
+    if (!pRender)
+    {
+        LogErr("input ptr to render == nullptr");
+        return false;
+    }
+    if (!outMaterialImg)
+    {
+        LogErr("input shader resource view == nullptr");
+        return false;
+    }
+
+ 
+    D3DClass& d3d                 = GetD3DClass();
+    ID3D11Device* pDevice         = d3d.GetDevice();
+    ID3D11DeviceContext* pContext = d3d.GetDeviceContext();
+    const float nearZ             = d3d.GetScreenNear();
+    const float farZ              = d3d.GetScreenDepth();
+
+    if (!materialBigIconFrameBuf_.IsInit())
+        InitMatIconFrameBuffer(pDevice, materialBigIconFrameBuf_, iconWidth, iconHeight, nearZ, farZ);
+
+    // get a sphere model
+    const ModelID basicSphereID    = g_ModelMgr.GetModelIdByName("basic_sphere");
+    BasicModel& sphere             = g_ModelMgr.GetModelByID(basicSphereID);
+    const MeshGeometry& sphereMesh = sphere.meshes_;
+
+    ID3D11Buffer* vb     = sphereMesh.GetVB();
+    ID3D11Buffer* ib     = sphereMesh.GetIB();
+    const int indexCount = (int)sphere.GetNumIndices();
+    const int vertexSize = (int)sphereMesh.vertexStride_;
+
+    // change view*proj matrix so we will be able to render material icons properly
+    const XMMATRIX world    = XMMatrixRotationY(yRotationAngle);
+    const XMMATRIX view     = XMMatrixTranslation(0, 0, 1.1f);
+    const XMMATRIX proj     = XMMatrixPerspectiveFovLH(1.0f, 1.0f, 0.1f, 100.0f);
+
+    Render::MaterialIconShader& matIconShader = pRender->shadersContainer_.materialIconShader_;
+    matIconShader.SetMatrix(pContext, world, view, proj);
+
+
+    // prepare responsible frame buffer for rendering
+    materialBigIconFrameBuf_.ClearBuffers(pContext, { 0,0,0,0 });
+    materialBigIconFrameBuf_.Bind(pContext);
+
+    // prepare material data and its textures
+    const Material& mat = g_MaterialMgr.GetMaterialByID(matID);
+
+    const Render::Material renderMat(
+        DirectX::XMFLOAT4(&mat.ambient.x),
+        DirectX::XMFLOAT4(&mat.diffuse.x),
+        DirectX::XMFLOAT4(&mat.specular.x),
+        DirectX::XMFLOAT4(&mat.reflect.x));
+
+    cvector<ID3D11ShaderResourceView*> texSRVs;
+    g_TextureMgr.GetSRVsByTexIDs(mat.textureIDs, NUM_TEXTURE_TYPES, texSRVs);
+
+    // render material into responsible frame buffer
+    matIconShader.PrepareRendering(pContext, vb, ib, sphereMesh.GetIndexFormat(), vertexSize);
+    matIconShader.Render(pContext, indexCount, sphereMesh.GetBaseIndex(), sphereMesh.GetBaseVertex(), texSRVs.data(), renderMat);
+
+    // reset camera's viewProj to the previous one (it can be game or editor camera)
+    pRender->SetViewProj(pContext, DirectX::XMMatrixTranspose(viewProj_));
+
+    // copy frame buffer texture into the input SRV
+    *outMaterialImg = materialBigIconFrameBuf_.GetSRV();
+
+    d3d.ResetBackBufferRenderTarget();
+    d3d.ResetViewport();
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool CGraphics::BakeImpostor(const ModelID modelID, Render::CRender* pRender)
+{
+    if (!pRender)
+    {
+        LogErr("input ptr to render == nullptr");
+        return false;
+    }
+
+    D3DClass& d3d                 = GetD3DClass();
+    ID3D11Device* pDevice         = d3d.GetDevice();
+    ID3D11DeviceContext* pContext = d3d.GetDeviceContext();
+    RenderStates& renderStates    = d3d.GetRenderStates();
+    BasicModel& model             = g_ModelMgr.GetModelByID(modelID);
+
+    // the impostor is baked once so its textures mustn't be placeholders
+    g_TextureMgr.FinishAsyncLoads();
+
+    // leaves and branches are usually two-sided
+    renderStates.SetRS(pContext, RSMask(CULL_NONE));
+
+    ImpostorBaker baker;
+    const bool result = baker.Bake(pDevice, pContext, pRender->shadersContainer_.materialIconShader_, model);
+
+    renderStates.ResetRS(pContext);
+
+    // reset camera's viewProj, render target and viewport
+    pRender->SetViewProj(pContext, DirectX::XMMatrixTranspose(viewProj_));
+    d3d.ResetBackBufferRenderTarget();
+    d3d.ResetViewport();
+
+    // entts of this model may be already in the visible set
+    InvalidateVisibilityCache();
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////
+
+int CGraphics::MergeStaticProps(ECS::EntityMgr* pEnttMgr)
+{
+    if (!pEnttMgr)
+    {
+        LogErr("input ptr to the entity mgr == nullptr");
+        return 0;
+    }
+
+    // props must have their geometry to be merged
+    g_ModelMgr.FinishLoading();
+
+    const int numCells = staticMerger_.Merge(pDevice_, *pEnttMgr, staticMergeParams_);
+    InvalidateVisibilityCache();
+
+    return numCells;
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UnmergeStaticProps(ECS::EntityMgr* pEnttMgr)
+{
+    if (!pEnttMgr)
+    {
+        LogErr("input ptr to the entity mgr == nullptr");
+        return;
+    }
+
+    staticMerger_.Unmerge(*pEnttMgr);
+    InvalidateVisibilityCache();
+}
+
+///////////////////////////////////////////////////////////
+
+bool CGraphics::BakeStaticLights(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender)
+{
+    if (!pEnttMgr || !pRender)
+    {
+        LogErr("input ptr to the entity mgr or render == nullptr");
+        return false;
+    }
+
+    // the current volumes are released by the bake so they mustn't be used
+    pRender->SetStaticLights(nullptr, { 0,0,0 }, { 0,0,0 }, 0.0f);
+
+    const bool result = lightBaker_.Bake(pDevice_, *pEnttMgr, lightBakeParams_, g_RelPathBakedDir);
+
+    // baked lights leave the light clusters
+    InvalidateVisibilityCache();
+    return result;
+}
+
+///////////////////////////////////////////////////////////
+
+bool CGraphics::LoadStaticLights(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender)
+{
+    // use the stored bake; if there is no bake (or the static lights
+    // were changed since it) they are baked anew (the volume is set to
+    // the render by each UpdateShadersDataPerFrame)
+
+    if (!pEnttMgr || !pRender)
+    {
+        LogErr("input ptr to the entity mgr or render == nullptr");
+        return false;
+    }
+
+    pRender->SetStaticLights(nullptr, { 0,0,0 }, { 0,0,0 }, 0.0f);
+
+    if (!lightBaker_.Load(pDevice_, *pEnttMgr, g_RelPathBakedDir))
+        return BakeStaticLights(pEnttMgr, pRender);
+
+    InvalidateVisibilityCache();
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::SetupRenderGraph(Render::CRender* pRender)
+{
+    // declare passes of the 3D scene (in the order of execution) and their targets:
+    // the back buffer, or transient (pooled) textures if the scene is rendered
+    // offscreen (dynamic resolution / FXAA); passes which are switched off by
+    // settings aren't added at all
+
+    const UINT wndWidth  = (UINT)d3d_.GetWindowWidth();
+    const UINT wndHeight = (UINT)d3d_.GetWindowHeight();
+
+    renderGraph_.Reset();
+    isSoftParticles_ = false;
+
+    if (IsSceneTarget())
+    {
+        // the averaged time of frames which were finished a few frames ago
+        if (isDynamicResolution_)
+            dynamicRes_.Update(pRender->GetGpuProfiler().GetFrameTime());
+
+        // the textures always have the window size so a change of the scale
+        // is just a change of the viewport (and the pool keeps the same textures)
+        const float scale = GetRenderScale();
+        sceneWidth_  = (UINT)ceilf(wndWidth  * scale);
+        sceneHeight_ = (UINT)ceilf(wndHeight * scale);
+
+        const RGTextureDesc colorDesc = { wndWidth, wndHeight, DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE };
+        const RGTextureDesc depthDesc = { wndWidth, wndHeight, DXGI_FORMAT_R24G8_TYPELESS, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE };
+
+        sceneColorRes_ = renderGraph_.CreateTexture("scene_color", colorDesc);
+        sceneDepthRes_ = renderGraph_.CreateTexture("scene_depth", depthDesc);
+
+        // is upscaled into the back buffer before UI (see UpscaleScene)
+        renderGraph_.Extract(sceneColorRes_);
+    }
+    else
+    {
+        sceneWidth_  = wndWidth;
+        sceneHeight_ = wndHeight;
+
+        const RGTextureDesc colorDesc = { wndWidth, wndHeight, d3d_.GetBackBufferFormat(), D3D11_BIND_RENDER_TARGET };
+        const RGTextureDesc depthDesc = { wndWidth, wndHeight, DXGI_FORMAT_R24G8_TYPELESS, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE };
+
+        // are cleared by D3DClass::BeginScene()
+        sceneColorRes_ = renderGraph_.ImportTexture("back_buffer", colorDesc, d3d_.GetRenderTargetView(), nullptr, nullptr);
+        sceneDepthRes_ = renderGraph_.ImportTexture("depth_buffer", depthDesc, nullptr, d3d_.GetDepthStencilView(), d3d_.GetDepthSRV());
+    }
+
+    // the sun's shadow maps are sampled by all the lit passes (they have their own targets)
+    if (isShadowsPass_)
+        renderGraph_.AddPass("shadows", SCENE_PASS_SHADOWS, true);
+
+    // casters of the planar reflection are rendered into its own target (it is composited later)
+    if (isReflectionPass_)
+        renderGraph_.AddPass("planar_reflection", SCENE_PASS_REFLECTION, true);
+
+    // the opaque pass is culled on GPU and is rendered by indirect draws
+    if (IsGpuDriven(pRender))
+        AddScenePass("gpu_driven", SCENE_PASS_GPU_DRIVEN);
+
+    // fill depth so the main passes shade each pixel only once
+    if (IsDepthPrepass(pRender))
+    {
+        const int pass = renderGraph_.AddPass("depth_prepass", SCENE_PASS_DEPTH_PREPASS);
+        renderGraph_.Write(pass, sceneDepthRes_);
+        renderGraph_.SetViewport(pass, (float)sceneWidth_, (float)sceneHeight_);
+    }
+
+    // the deferred shading lights the G-buffer by the same light clusters instead of the forward pass
+    if (IsDeferredShading(pRender))
+        AddScenePass("deferred", SCENE_PASS_DEFERRED);
+    else
+        AddScenePass("opaque", SCENE_PASS_OPAQUE);
+
+    // the instances are already prepared so the entity IDs pass is cheap
+    // (it renders into its own target and is read back later)
+    if (isPickRequested_ && !pRender->GetEntityIdBuffer().IsPending())
+        renderGraph_.AddPass("entity_ids", SCENE_PASS_ENTITY_IDS, true);
+
+    AddScenePass("terrain",   SCENE_PASS_TERRAIN);
+
+    if (pRender->GetGrassScatter().HasPatches())
+        AddScenePass("grass", SCENE_PASS_GRASS);
+
+    if (!skinnedBatches_.empty())
+        AddScenePass("skinned", SCENE_PASS_SKINNED);
+
+    AddScenePass("impostors", SCENE_PASS_IMPOSTORS);
+
+    // the sky goes after all the opaque geometry: its pixels behind
+    // the written depth are rejected before shading
+    AddScenePass("sky_dome",  SCENE_PASS_SKY_DOME);
+
+    // the reflection is blended over pixels of the mirror (which are marked
+    // in the stencil) before the blended content which can cover the mirror
+    if (isReflectionVisible_ && (isReflectionPass_ || pRender->GetPlanarReflection().HasImage()))
+        AddScenePass("reflection_composite", SCENE_PASS_REFLECTION_COMPOSITE);
+
+    // blended content of LOW_RES_BLENDING materials (and maybe particles) is rendered
+    // offscreen with a lower resolution and composited over the scene after it
+    const bool isLowRes          = IsLowResBlending(pRender);
+    const bool isParticles       = pRender->GetGpuParticles().IsActive();
+    const bool isLowResParticles = isLowRes && isParticles && isLowResParticles_;
+
+    isLowResEnttsPass_ = isLowRes && HasLowResInstances(pRender);
+
+    // blended entts go after all the opaque geometry (sorted from far to near)
+    if (!pRender->dataStorage_.blendedModelInstances.empty())
+        AddScenePass("blended", SCENE_PASS_BLENDED);
+
+    // blended particles go after all the opaque geometry; soft particles read
+    // the scene depth so it isn't bound (the multisampled one stays bound as a
+    // plain depth test)
+    if (isParticles && !isLowResParticles)
+    {
+        const bool isMultisampled = !IsSceneTarget() && (d3d_.GetDepthNumSamples() > 1);
+
+        if (isMultisampled || (particlesSoftDistance_ <= 0.0f))
+        {
+            AddScenePass("particles", SCENE_PASS_PARTICLES);
+        }
+        else
+        {
+            const int pass = renderGraph_.AddPass("particles", SCENE_PASS_PARTICLES);
+            renderGraph_.Read (pass, sceneDepthRes_);
+            renderGraph_.Write(pass, sceneColorRes_);
+            renderGraph_.SetViewport(pass, (float)sceneWidth_, (float)sceneHeight_);
+            isSoftParticles_ = true;
+        }
+    }
+
+    if (isLowResEnttsPass_ || isLowResParticles)
+        AddLowResPasses(isLowResEnttsPass_, isLowResParticles);
+
+    // the grid is blended over the whole scene but it's still hidden by the geometry
+    if (isEditorGrid_ && !isGameMode_ && pRender->GetEditorGrid().IsInitialized())
+        AddScenePass("editor_grid", SCENE_PASS_EDITOR_GRID);
+
+    AddScenePass("debug_lines", SCENE_PASS_DEBUG_LINES);
+
+    // the depth of this frame is used for occlusion culling of the next frames
+    if (isOcclusionCulling_)
+    {
+        const int pass = renderGraph_.AddPass("hi_z", SCENE_PASS_HI_Z, true);
+        renderGraph_.Read(pass, sceneDepthRes_);
+    }
+
+    renderGraph_.Compile();
+}
+
+///////////////////////////////////////////////////////////
+
+int CGraphics::AddScenePass(const char* name, const eScenePass type)
+{
+    // a pass which renders into the scene color with the depth test
+    const int pass = renderGraph_.AddPass(name, type);
+
+    renderGraph_.Read (pass, sceneDepthRes_);
+    renderGraph_.Write(pass, sceneColorRes_);
+    renderGraph_.Write(pass, sceneDepthRes_);
+    renderGraph_.SetViewport(pass, (float)sceneWidth_, (float)sceneHeight_);
+
+    return pass;
+}
+
+//---------------------------------------------------------
+// Desc:   declare passes of the low resolution blending: the scene depth is
+//         downsampled, blended content is rendered into the low resolution
+//         targets and then it's upsampled over the scene color
+// Args:   - isEntts:      are there blended instances of LOW_RES_BLENDING materials?
+//         - isParticles:  are particles rendered with the low resolution?
+//---------------------------------------------------------
+void CGraphics::AddLowResPasses(const bool isEntts, const bool isParticles)
+{
+    using Render::LowResBlending;
+
+    const UINT factor = (UINT)lowResBlendFactor_;
+    const RGTextureDesc& sceneDesc = renderGraph_.GetDesc(sceneDepthRes_);
+
+    // the textures are of the scaled window size (so they are kept by the pool),
+    // only the scaled rendered part of the scene is drawn
+    const UINT texWidth   = LowResBlending::GetLowResSize(sceneDesc.width,  factor);
+    const UINT texHeight  = LowResBlending::GetLowResSize(sceneDesc.height, factor);
+    const float vpWidth   = (float)LowResBlending::GetLowResSize(sceneWidth_,  factor);
+    const float vpHeight  = (float)LowResBlending::GetLowResSize(sceneHeight_, factor);
+
+    // premultiplied color (the alpha is the coverage); float for less banding of thin smoke
+    const RGTextureDesc colorDesc = { texWidth, texHeight, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE };
+    const RGTextureDesc depthDesc = { texWidth, texHeight, DXGI_FORMAT_R24G8_TYPELESS,     D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE };
+
+    lowResColorRes_ = renderGraph_.CreateTexture("low_res_color", colorDesc);
+    lowResDepthRes_ = renderGraph_.CreateTexture("low_res_depth", depthDesc);
+
+    int pass = renderGraph_.AddPass("low_res_depth", SCENE_PASS_LOW_RES_DEPTH);
+    renderGraph_.Read (pass, sceneDepthRes_);
+    renderGraph_.Write(pass, lowResColorRes_);
+    renderGraph_.Write(pass, lowResDepthRes_);
+    renderGraph_.SetViewport(pass, vpWidth, vpHeight);
+
+    if (isEntts)
+    {
+        pass = renderGraph_.AddPass("low_res_blended", SCENE_PASS_LOW_RES_BLENDED);
+        renderGraph_.Read (pass, lowResDepthRes_);
+        renderGraph_.Write(pass, lowResColorRes_);
+        renderGraph_.Write(pass, lowResDepthRes_);
+        renderGraph_.SetViewport(pass, vpWidth, vpHeight);
+    }
+
+    if (isParticles)
+    {
+        // soft particles read the low resolution depth instead of the depth test
+        pass = renderGraph_.AddPass("low_res_particles", SCENE_PASS_LOW_RES_PARTICLES);
+        renderGraph_.Read (pass, lowResDepthRes_);
+        renderGraph_.Write(pass, lowResColorRes_);
+
+        if (particlesSoftDistance_ > 0.0f)
+            isSoftParticles_ = true;
+        else
+            renderGraph_.Write(pass, lowResDepthRes_);
+
+        renderGraph_.SetViewport(pass, vpWidth, vpHeight);
+    }
+
+    pass = renderGraph_.AddPass("low_res_composite", SCENE_PASS_LOW_RES_COMPOSITE);
+    renderGraph_.Read (pass, lowResColorRes_);
+    renderGraph_.Read (pass, lowResDepthRes_);
+    renderGraph_.Read (pass, sceneDepthRes_);
+    renderGraph_.Write(pass, sceneColorRes_);
+    renderGraph_.SetViewport(pass, (float)sceneWidth_, (float)sceneHeight_);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::ExecuteScenePass(Render::CRender* pRender, const int type)
+{
+    ID3D11DeviceContext* pContext = pDeviceContext_;
+
+    switch (type)
+    {
+        case SCENE_PASS_SHADOWS:
+            RenderShadows(pRender);
+            break;
+
+        case SCENE_PASS_REFLECTION:
+            RenderPlanarReflection(pRender);
+            break;
+
+        case SCENE_PASS_GPU_DRIVEN:
+            RenderEnttsGpuDriven(pRender);
+            break;
+
+        case SCENE_PASS_DEPTH_PREPASS:
+            RenderDepthPrepass(pRender);
+            break;
+
+        case SCENE_PASS_OPAQUE:
+        {
+            // draw-call-heavy passes can be recorded on several threads
+            // (the debug shader updates its const buffer per draw so it goes by the immediate context)
+            if (pRender->GetCommandRecorder().IsInitialized() && !pRender->isDebugMode_)
+            {
+                RenderEnttsDeferred(pRender);
+            }
+            else
+            {
+                RenderEnttsDefault(pRender);
+                RenderEnttsAlphaClipCullNone(pRender);
+            }
+
+            if (isDepthPrepassDone_)
+            {
+                d3d_.GetRenderStates().ResetDSS(pContext);
+                isDepthPrepassDone_ = false;
+            }
+            break;
+        }
+
+        case SCENE_PASS_DEFERRED:
+        {
+            RenderDeferredShading(pRender);
+
+            if (isDepthPrepassDone_)
+            {
+                d3d_.GetRenderStates().ResetDSS(pContext);
+                isDepthPrepassDone_ = false;
+            }
+            break;
+        }
+
+        case SCENE_PASS_ENTITY_IDS:
+            RenderEntityIds(pRender);
+            break;
+
+        case SCENE_PASS_TERRAIN:
+            RenderTerrain(pRender);
+            break;
+
+        case SCENE_PASS_GRASS:
+            RenderGrass(pRender);
+            break;
+
+        case SCENE_PASS_SKINNED:
+            RenderSkinned(pRender);
+            break;
+
+        case SCENE_PASS_SKY_DOME:
+            RenderSkyDome(pRender);
+            break;
+
+        case SCENE_PASS_IMPOSTORS:
+            RenderImpostors(pRender);
+            break;
+
+        case SCENE_PASS_REFLECTION_COMPOSITE:
+            CompositePlanarReflection(pRender);
+            break;
+
+        case SCENE_PASS_BLENDED:
+            RenderEnttsBlended(pRender, false);
+            break;
+
+        case SCENE_PASS_PARTICLES:
+            RenderParticles(pRender, false);
+            break;
+
+        case SCENE_PASS_LOW_RES_DEPTH:
+        {
+            pRender->GetLowResBlending().Downsample(
+                pContext,
+                renderGraph_.GetRTV(lowResColorRes_),
+                renderGraph_.GetSRV(sceneDepthRes_),
+                (UINT)lowResBlendFactor_,
+                sceneWidth_,
+                sceneHeight_);
+
+            RenderStates& renderStates = d3d_.GetRenderStates();
+            renderStates.ResetBS(pContext);
+            renderStates.ResetDSS(pContext);
+            break;
+        }
+
+        case SCENE_PASS_LOW_RES_BLENDED:
+        {
+            // the light PS finds its cluster by pixel coords
+            pRender->SetLightClustersPixelScale(pContext, (float)lowResBlendFactor_);
+            RenderEnttsBlended(pRender, true);
+            pRender->SetLightClustersPixelScale(pContext, 1.0f);
+            break;
+        }
+
+        case SCENE_PASS_LOW_RES_PARTICLES:
+            RenderParticles(pRender, true);
+            break;
+
+        case SCENE_PASS_LOW_RES_COMPOSITE:
+        {
+            pRender->CompositeLowResBlending(
+                pContext,
+                renderGraph_.GetSRV(lowResColorRes_),
+                renderGraph_.GetSRV(lowResDepthRes_),
+                renderGraph_.GetSRV(sceneDepthRes_),
+                (UINT)lowResBlendFactor_,
+                sceneWidth_,
+                sceneHeight_);
+
+            RenderStates& renderStates = d3d_.GetRenderStates();
+            renderStates.ResetBS(pContext);
+            renderStates.ResetDSS(pContext);
+            break;
+        }
+
+        case SCENE_PASS_EDITOR_GRID:
+            RenderEditorGrid(pRender);
+            break;
+
+        case SCENE_PASS_DEBUG_LINES:
+            RenderDebugLines(pRender);
+            break;
+
+        case SCENE_PASS_HI_Z:
+        {
+            // the offscreen depth isn't multisampled and only its scaled part is rendered
+            pRender->BuildHiZBuffer(
+                pContext,
+                renderGraph_.GetSRV(sceneDepthRes_),
+                sceneWidth_,
+                sceneHeight_,
+                (IsSceneTarget()) ? 1 : d3d_.GetDepthNumSamples(),
+                viewProj_);
+            break;
+        }
+
+        default:
+            sprintf(g_String, "unknown type of scene pass: %d", type);
+            LogErr(g_String);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UpscaleScene(Render::CRender* pRender)
+{
+    // stretch the rendered part of the scene buffer to the whole back buffer
+    // (and anti-alias it if FXAA is on);
+    // NOTE: the caller disables the depth test (UI is rendered right after it)
+
+    if (!IsSceneTarget() || (sceneColorRes_ == RG_INVALID_RESOURCE))
+        return;
+
+    d3d_.ResetBackBufferRenderTarget();
+    d3d_.ResetViewport();
+
+    const RGTextureDesc& desc = renderGraph_.GetDesc(sceneColorRes_);
+
+    pRender->shadersContainer_.upscaleShader_.Render(
+        pDeviceContext_,
+        renderGraph_.GetSRV(sceneColorRes_),
+        desc.width,
+        desc.height,
+        sceneWidth_,
+        sceneHeight_,
+        isFxaa_);
+
+    // the scene color can be aliased by the next frame
+    renderGraph_.ReleaseExtracted();
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::CacheSceneImage()
+{
+    // copy the back buffer (the scene is already upscaled there but UI isn't rendered yet);
+    // the image is recreated if the back buffer is changed (e.g. the window is resized)
+
+    ID3D11Texture2D* pBackBuffer = d3d_.GetBackBufferTex();
+
+    if (!pBackBuffer)
+        return;
+
+    D3D11_TEXTURE2D_DESC backDesc;
+    pBackBuffer->GetDesc(&backDesc);
+
+    if (pSceneImage_)
+    {
+        D3D11_TEXTURE2D_DESC imageDesc;
+        pSceneImage_->GetDesc(&imageDesc);
+
+        if ((imageDesc.Width            != backDesc.Width)  ||
+            (imageDesc.Height           != backDesc.Height) ||
+            (imageDesc.Format           != backDesc.Format) ||
+            (imageDesc.SampleDesc.Count != backDesc.SampleDesc.Count))
+        {
+            SafeRelease(&pSceneImage_);
+        }
+    }
+
+    if (!pSceneImage_)
+    {
+        // only a copy destination/source (CopyResource needs the same format and samples)
+        D3D11_TEXTURE2D_DESC desc = backDesc;
+        desc.Usage          = D3D11_USAGE_DEFAULT;
+        desc.BindFlags      = 0;
+        desc.CPUAccessFlags = 0;
+        desc.MiscFlags      = 0;
+
+        if (FAILED(pDevice_->CreateTexture2D(&desc, nullptr, &pSceneImage_)))
+        {
+            LogErr("can't create a texture for the cached scene image");
+            isSceneImageValid_ = false;
+            return;
+        }
+    }
+
+    pDeviceContext_->CopyResource(pSceneImage_, pBackBuffer);
+    isSceneImageValid_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool CGraphics::HasCachedScene() const
+{
+    // the image is valid and it has the same size as the back buffer
+
+    ID3D11Texture2D* pBackBuffer = d3d_.GetBackBufferTex();
+
+    if (!isSceneImageValid_ || !pSceneImage_ || !pBackBuffer)
+        return false;
+
+    D3D11_TEXTURE2D_DESC backDesc;
+    D3D11_TEXTURE2D_DESC imageDesc;
+    pBackBuffer->GetDesc(&backDesc);
+    pSceneImage_->GetDesc(&imageDesc);
+
+    return (imageDesc.Width == backDesc.Width) && (imageDesc.Height == backDesc.Height);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::PresentCachedScene()
+{
+    // an idle frame: the scene wasn't rendered so restore its last image under UI
+    if (HasCachedScene())
+        pDeviceContext_->CopyResource(d3d_.GetBackBufferTex(), pSceneImage_);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::UpdateThumbnails(Render::CRender* pRender)
+{
+    // make thumbnails which were requested by the editor's browsers since the prev
+    // frame: texture thumbnails are made by jobs (here they are only uploaded) and
+    // a few icons of materials (sphere model with particular material) are rendered
+
+    if (!pRender)
+    {
+        LogErr("input ptr to render == nullptr");
+        return;
+    }
+
+    D3DClass&            d3d      = GetD3DClass();
+    ID3D11DeviceContext* pContext = d3d.GetDeviceContext();
+
+    const ModelID     basicSphereID = g_ModelMgr.GetModelIdByName("basic_sphere");
+    const BasicModel& sphere        = g_ModelMgr.GetModelByID(basicSphereID);
+
+    Render::MaterialIconShader& matIconShader = pRender->shadersContainer_.materialIconShader_;
+
+    // icons are cached between sessions so their textures mustn't be placeholders
+    if (thumbnails_.HasIconRequests())
+        g_TextureMgr.FinishAsyncLoads();
+
+    if (thumbnails_.Update(pContext, matIconShader, sphere) > 0)
+    {
+        // reset camera's viewProj to the previous one (it can be game or editor camera)
+        pRender->SetViewProj(pContext, DirectX::XMMatrixTranspose(viewProj_));
+        d3d.ResetBackBufferRenderTarget();
+        d3d.ResetViewport();
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::RenderShadows(Render::CRender* pRender)
 {
-    // clear rendering data from the previous frame / instances set
+    // render casters into the sun's shadow maps: static casters are rendered into
+    // the cache of a cascade only if it is invalid, and each frame dynamic casters
+    // are rendered over a copy of this cache
 
-    pRender->dataStorage_.Clear();
-    rsDataToRender_.Clear();
-}
+    PROFILE_SCOPE("Render: shadows");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_SHADOWS);
 
-///////////////////////////////////////////////////////////
+    Render::ShadowMaps&  shadowMaps = pRender->GetShadowMaps();
+    RenderStates&        states     = d3d_.GetRenderStates();
+    ID3D11DeviceContext* pContext   = pDeviceContext_;
 
-// memory allocation and releasing
-void* CGraphics::operator new(size_t i)
-{
-    if (void* ptr = _aligned_malloc(i, 16))
-        return ptr;
+    states.ResetBS(pContext);
+    states.ResetDSS(pContext);
 
-    LogErr("can't allocate memory for this object");
-    throw std::bad_alloc{};
+    shadowMaps.Begin(pContext, pRender->perFrameData_.totalGameTime);
+
+    for (int i = 0; i < shadowMaps.GetNumCascades(); ++i)
+    {
+        if (shadowMaps.GetCascade(i).isStaticDirty)
+        {
+            shadowMaps.BeginStaticCasters(pContext, i);
+            RenderShadowCasters(pRender, staticShadowCasters_[i]);
+            staticShadowCasters_[i].Clear();
+        }
+
+        shadowMaps.BeginDynamicCasters(pContext, i);
+        RenderShadowCasters(pRender, dynamicShadowCasters_[i]);
+    }
+
+    shadowMaps.End(pContext, pRender->GetConstBufferVSPerFrame());
+
+    // the raster state of casters was bound by the shadow maps
+    states.ResetRS(pContext);
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::operator delete(void* ptr)
+void CGraphics::RenderShadowCasters(Render::CRender* pRender, const ShadowCasters& casters)
 {
-    _aligned_free(ptr);
-}
+    // render depth of casters by the depth pre-pass shaders (the light's view-proj is bound);
+    // each range is rendered right after its upload since the next upload can discard the ring
 
+    Render::DepthPrepass& prepass  = pRender->GetDepthPrepass();
+    Render::InstanceRing& ring     = pRender->GetInstanceRing();
+    ID3D11DeviceContext*  pContext = pDeviceContext_;
+    const UINT            elemSize = sizeof(Render::ConstBufType::InstancedData);
 
-// =================================================================================
-// Rendering methods
-// =================================================================================
-void CGraphics::RenderHelper(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender)
-{
-    try
+    if (!casters.opaque.empty())
     {
-        // prepare the sky textures: in different shaders we will sample the sky
-        // texture pixels so we bind them only once at the beginning of the frame
-        const SkyModel& sky = g_ModelMgr.GetSky();
-        const TexID* skyTexIDs = sky.GetTexIDs();
-        const int skyTexMaxNum = sky.GetMaxTexturesNum();
+        const UINT baseInstance = pRender->UpdateInstancedBuffer(pContext, casters.opaqueBuffer);
+
+        prepass.Render(
+            pContext,
+            ring.GetBuffer(),
+            casters.opaque.data(),
+            (int)casters.opaque.size(),
+            elemSize,
+            baseInstance,
+            false);
+    }
 
-        // get shader resource views (textures) for the sky
-        ID3D11DeviceContext* pContext = pDeviceContext_;
-        g_TextureMgr.GetSRVsByTexIDs(skyTexIDs, skyTexMaxNum, texturesBuf_);
-        pContext->PSSetShaderResources(0U, 1U, texturesBuf_.data());
+    if (!casters.alphaClipped.empty())
+    {
+        const UINT baseInstance = pRender->UpdateInstancedBuffer(pContext, casters.alphaClipBuffer);
+
+        prepass.Render(
+            pContext,
+            ring.GetBuffer(),
+            casters.alphaClipped.data(),
+            (int)casters.alphaClipped.size(),
+            elemSize,
+            baseInstance,
+            true);
+    }
+}
 
+///////////////////////////////////////////////////////////
 
-        RenderEnttsDefault(pRender);
-        RenderEnttsAlphaClipCullNone(pRender);
-        RenderTerrain(pRender, pEnttMgr);
-        RenderSkyDome(pRender, pEnttMgr);
-        //RenderFoggedBillboards(pRender, pEnttMgr);
+void CGraphics::RenderPlanarReflection(Render::CRender* pRender)
+{
+    // render casters into the planar reflection by the reflected camera (there is
+    // no depth pre-pass for them); the reflection flips the winding of triangles
+    // so front faces are counter-clockwise
 
-#if 0
-        pDeviceContext_->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+    PROFILE_SCOPE("Render: planar reflection");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_REFLECTION);
 
-        const EntityID* visEntts = entityMgr_.renderSystem_.GetAllVisibleEntts().data();
-        const size numVisEntts = entityMgr_.renderSystem_.GetVisibleEnttsCount();
+    Render::PlanarReflection& refl     = pRender->GetPlanarReflection();
+    RenderStates&             states   = d3d_.GetRenderStates();
+    ID3D11DeviceContext*      pContext = pDeviceContext_;
 
-        // check if we are able and need to render bounding line boxes
-        if ((numVisEntts != 0) && (aabbShowMode_ != NONE))
-            return;
+    states.ResetBS(pContext);
+    states.ResetDSS(pContext);
 
-        RenderBoundingLineBoxes(pRender, pEnttMgr, visEntts, numVisEntts);
-        RenderBoundingLineSpheres();
-        RenderEnttsBlended();
-#endif
-    }
-    catch (const std::out_of_range& e)
+    if (!refl.Begin(pDevice_, pContext, sceneWidth_, sceneHeight_, pRender->perFrameData_.totalGameTime))
+        return;
+
+    pRender->BeginReflectionLighting(pContext, refl.GetCameraPos());
+
+    // each range is rendered right after its upload since the next upload can discard the ring
+    if (!reflectCasters_.opaque.empty())
     {
-        LogErr(e.what());
-        LogErr("there is no such a key to data");
+        states.SetRS(pContext, RSMask(FILL_SOLID) | RSMask(CULL_BACK) | RSMask(FRONT_COUNTER_CLOCKWISE));
+
+        const UINT baseInstance = pRender->UpdateInstancedBuffer(pContext, reflectCasters_.opaqueBuffer);
+
+        pRender->RenderInstances(
+            pContext,
+            Render::ShaderTypes::LIGHT,
+            reflectCasters_.opaque.data(),
+            (int)reflectCasters_.opaque.size(),
+            baseInstance,
+            Render::DRAW_PASS_OPAQUE);
     }
-    catch (EngineException& e)
+
+    if (!reflectCasters_.alphaClipped.empty())
     {
-        LogErr(e);
-        LogErr("can't render 3D entts onto the scene");
+        states.SetRS(pContext, RS_CULL_NONE_CCW);
+        pRender->SwitchAlphaClipping(pContext, true);
+
+        const UINT baseInstance = pRender->UpdateInstancedBuffer(pContext, reflectCasters_.alphaClipBuffer);
+
+        pRender->RenderInstances(
+            pContext,
+            Render::ShaderTypes::LIGHT,
+            reflectCasters_.alphaClipped.data(),
+            (int)reflectCasters_.alphaClipped.size(),
+            baseInstance,
+            Render::DRAW_PASS_ALPHA_CLIPPED);
+
+        pRender->SwitchAlphaClipping(pContext, false);
     }
+
+    pRender->EndReflectionLighting(pContext);
+    refl.End(pContext, pRender->GetConstBufferVSPerFrame());
+
+    states.ResetRS(pContext);
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::RenderModel(BasicModel& model, const DirectX::XMMATRIX& world)
+void CGraphics::CompositePlanarReflection(Render::CRender* pRender)
 {
-    // for specific purposes:
-    // just render a single asset/model at the center of the world
+    // mark visible pixels of the mirror in the stencil (by the depth pre-pass shaders
+    // so the depth is the same as of the mirror in the scene depth) and blend the
+    // reflection over the marked pixels by a fullscreen triangle
+
+    PROFILE_SCOPE("Render: reflection composite");
+
+    Render::PlanarReflection& refl     = pRender->GetPlanarReflection();
+    RenderStates&             states   = d3d_.GetRenderStates();
+    ID3D11DeviceContext*      pContext = pDeviceContext_;
+    constexpr UINT            stencilRef = 1;
+
+    if (reflectMirror_.opaque.empty() || !refl.HasImage())
+        return;
+
+    states.ResetRS(pContext);
+    states.SetBS(pContext, RSMask(NO_RENDER_TARGET_WRITES));
+    states.SetDSS(pContext, RSMask(MARK_MIRROR), stencilRef);
+
+    const UINT baseInstance = pRender->UpdateInstancedBuffer(pContext, reflectMirror_.opaqueBuffer);
+
+    pRender->GetDepthPrepass().Render(
+        pContext,
+        pRender->GetInstanceRing().GetBuffer(),
+        reflectMirror_.opaque.data(),
+        (int)reflectMirror_.opaque.size(),
+        sizeof(Render::ConstBufType::InstancedData),
+        baseInstance,
+        false);
+
+    // the composite binds its own blend state
+    states.SetDSS(pContext, RSMask(DRAW_REFLECTION), stencilRef);
+    refl.Composite(pContext, sceneWidth_, sceneHeight_);
+
+    states.ResetBS(pContext);
+    states.ResetDSS(pContext);
 }
 
 ///////////////////////////////////////////////////////////
 
-void InitMatIconFrameBuffer(
-    ID3D11Device* pDevice,
-    FrameBuffer& buf,
-    const int iconWidth,
-    const int iconHeight,
-    const float nearZ,
-    const float farZ)
+void CGraphics::RenderDepthPrepass(Render::CRender* pRender)
 {
-    // init a single frame buffer which is used to render material big icon (for the editor's material browser)
+    // render depth of the visible opaque and alpha clipped entts so the main passes
+    // are tested by DEPTH_EQUAL and the light shader isn't executed for hidden pixels;
+    // instances are uploaded here and the main passes reuse their ranges of the ring
+    // (each pass is rendered right after its upload since the next upload can discard the ring)
+
+    PROFILE_SCOPE("Render: depth prepass");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_DEPTH_PREPASS);
+
+    const Render::RenderDataStorage& storage  = pRender->dataStorage_;
+    Render::DepthPrepass&            prepass  = pRender->GetDepthPrepass();
+    Render::InstanceRing&            ring     = pRender->GetInstanceRing();
+    RenderStates&                    states   = d3d_.GetRenderStates();
+    ID3D11DeviceContext*             pContext = pDeviceContext_;
+    const UINT                       elemSize = sizeof(Render::ConstBufType::InstancedData);
+
+    if (storage.modelInstances.empty() && storage.staticModelInstances.empty() && storage.alphaClippedModelInstances.empty())
+        return;
 
-    // setup params for the frame buffers
-    FrameBufferSpecification frameBufSpec;
-    frameBufSpec.width          = (UINT)iconWidth;
-    frameBufSpec.height         = (UINT)iconHeight;
-    frameBufSpec.format         = DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM;
-    frameBufSpec.screenNear     = nearZ;
-    frameBufSpec.screenDepth    = farZ;
+    states.ResetBS(pContext);
+    states.SetDSS(pContext, RSMask(DEPTH_ENABLED), 1);
 
-    // TODO: if input params differ from the frame buffer's params we need to recreate the frame buffer according to new params
-    
-    buf.Initialize(pDevice, frameBufSpec);
+    // static entts are already in the visible buffer of static batches
+    if (!storage.staticModelInstances.empty())
+    {
+        states.ResetRS(pContext);
+
+        prepass.Render(
+            pContext,
+            pRender->GetStaticBatches().GetVisibleBuffer(),
+            storage.staticModelInstances.data(),
+            (int)storage.staticModelInstances.size(),
+            elemSize,
+            0,
+            false);
+    }
+
+    if (!storage.modelInstances.empty())
+    {
+        modelInstBase_ = pRender->UpdateInstancedBuffer(pContext, storage.modelInstBuffer);
+        instRingGen_   = ring.GetGeneration();
+
+        states.ResetRS(pContext);
+
+        prepass.Render(
+            pContext,
+            ring.GetBuffer(),
+            storage.modelInstances.data(),
+            (int)storage.modelInstances.size(),
+            elemSize,
+            modelInstBase_,
+            false);
+    }
+
+    if (!storage.alphaClippedModelInstances.empty())
+    {
+        alphaClippedInstBase_ = pRender->UpdateInstancedBuffer(pContext, storage.alphaClippedModelInstBuffer);
+        alphaClippedRingGen_  = ring.GetGeneration();
+
+        states.SetRS(pContext, RS_CULL_NONE_CW);
+
+        prepass.Render(
+            pContext,
+            ring.GetBuffer(),
+            storage.alphaClippedModelInstances.data(),
+            (int)storage.alphaClippedModelInstances.size(),
+            elemSize,
+            alphaClippedInstBase_,
+            true);
+
+        states.ResetRS(pContext);
+    }
+
+    isDepthPrepassDone_ = true;
 }
 
 ///////////////////////////////////////////////////////////
 
-void InitMatIconFrameBuffers(
-    ID3D11Device* pDevice,
-    cvector<FrameBuffer>& frameBuffers,
-    const size numIcons,
-    const int iconWidth,
-    const int iconHeight,
-    const float nearZ,
-    const float farZ)
+void CGraphics::RenderEnttsDefault(Render::CRender* pRender)
 {
-    // initialize frame buffers which will be used to render material icons (for material browser in the editor)
+    PROFILE_SCOPE("Render: default");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_DEFAULT);
 
-    // setup params for the frame buffers (we will use the same params for each)
-    FrameBufferSpecification frameBufSpec;
-    frameBufSpec.width          = (UINT)iconWidth;
-    frameBufSpec.height         = (UINT)iconHeight;
-    frameBufSpec.format         = DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM;
-    frameBufSpec.screenNear     = nearZ;
-    frameBufSpec.screenDepth    = farZ;
+    const Render::RenderDataStorage& storage = pRender->dataStorage_;
 
-    // release memory from the previous set of frame buffers
-    for (FrameBuffer& buf : frameBuffers)
-        buf.Shutdown();
+    // check if we have any instances to render
+    if (storage.modelInstances.empty() && storage.staticModelInstances.empty())
+        return;
 
-    // alloc memory for frame buffers and init each frame buffer
-    frameBuffers.resize(numIcons);
 
-    for (index i = 0; i < numIcons; ++i)
+    // setup states before rendering
+    if (pRender->shadersContainer_.debugShader_.GetDebugType() == Render::eDebugState::DBG_WIREFRAME)
     {
-        if (!frameBuffers[i].Initialize(pDevice, frameBufSpec))
-        {
-            sprintf(g_String, "can't initialize a frame buffer (idx: %d)", (int)i);
-            LogErr(g_String);
-        }
+        RenderStates& renderStates = d3d_.GetRenderStates();
+        renderStates.SetRS(pDeviceContext_, RS_WIREFRAME);
+    }
+    else if (IsOverdrawDebug(pRender))
+    {
+        d3d_.GetRenderStates().ResetRS(pDeviceContext_);
+        SetOverdrawStates(pDeviceContext_);
+    }
+    else
+    {
+        d3d_.GetRenderStates().ResetRS(pDeviceContext_);
+        d3d_.GetRenderStates().ResetBS(pDeviceContext_);
+
+        if (isDepthPrepassDone_)
+            d3d_.GetRenderStates().SetDSS(pDeviceContext_, RSMask(DEPTH_EQUAL), 1);
+    }
+
+    // static entts go from the visible buffer of static batches
+    if (!storage.staticModelInstances.empty())
+    {
+        pRender->RenderInstances(
+            pDeviceContext_,
+            pRender->GetStaticBatches().GetVisibleBuffer(),
+            Render::ShaderTypes::LIGHT,
+            storage.staticModelInstances.data(),
+            (int)storage.staticModelInstances.size(),
+            0,
+            Render::DRAW_PASS_OPAQUE);
+    }
+
+    if (storage.modelInstances.empty())
+        return;
+
+    // instances can be already uploaded by the depth pre-pass
+    if (!isDepthPrepassDone_ || (instRingGen_ != pRender->GetInstanceRing().GetGeneration()))
+    {
+        modelInstBase_ = pRender->UpdateInstancedBuffer(pDeviceContext_, storage.modelInstBuffer);
+        instRingGen_   = pRender->GetInstanceRing().GetGeneration();
     }
+
+    pRender->RenderInstances(
+        pDeviceContext_,
+        Render::ShaderTypes::LIGHT,
+        storage.modelInstances.data(),
+        (int)storage.modelInstances.size(),
+        modelInstBase_,
+        Render::DRAW_PASS_OPAQUE);
 }
 
 ///////////////////////////////////////////////////////////
 
-bool CGraphics::RenderBigMaterialIcon(
-    const MaterialID matID,
-    const int iconWidth,
-    const int iconHeight,
-    const float yRotationAngle,
-    Render::CRender* pRender,
-    ID3D11ShaderResourceView** outMaterialImg)
+void CGraphics::RenderEnttsAlphaClipCullNone(Render::CRender* pRender)
 {
-    if (!pRender)
+    // render all the visible entts with cull_none and alpha clipping;
+    // (entts for instance: wire fence, bushes, leaves, etc.)
+
+    PROFILE_SCOPE("Render: alpha clip");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_ALPHA_CLIP);
+
+    const Render::RenderDataStorage& storage = pRender->dataStorage_;
+
+    // check if we have any instances to render
+    if (storage.alphaClippedModelInstances.empty())
+        return;
+
+    RenderStates& renderStates = d3d_.GetRenderStates();
+    ID3D11DeviceContext* pContext = pDeviceContext_;
+
+
+    // setup states before rendering
+    if (pRender->shadersContainer_.debugShader_.GetDebugType() == Render::eDebugState::DBG_WIREFRAME)
     {
-        LogErr("input ptr to render == nullptr");
-        return false;
+        renderStates.SetRS(pContext, RS_WIREFRAME);
     }
-    if (!outMaterialImg)
+    else if (IsOverdrawDebug(pRender))
     {
-        LogErr("input shader resource view == nullptr");
-        return false;
+        renderStates.SetRS(pContext, RS_CULL_NONE_CW);
+        SetOverdrawStates(pContext);
     }
+    else
+    {
+        renderStates.SetRS(pContext, RS_CULL_NONE_CW);
+        renderStates.ResetBS(pContext);
+        pRender->SwitchAlphaClipping(pContext, true);
 
- 
-    D3DClass& d3d                 = GetD3DClass();
-    ID3D11Device* pDevice         = d3d.GetDevice();
-    ID3D11DeviceContext* pContext = d3d.GetDeviceContext();
-    const float nearZ             = d3d.GetScreenNear();
-    const float farZ              = d3d.GetScreenDepth();
+        if (isDepthPrepassDone_)
+            renderStates.SetDSS(pContext, RSMask(DEPTH_EQUAL), 1);
+        else
+            renderStates.ResetDSS(pContext);
+    }
 
-    if (!materialBigIconFrameBuf_.IsInit())
-        InitMatIconFrameBuffer(pDevice, materialBigIconFrameBuf_, iconWidth, iconHeight, nearZ, farZ);
+    // load instances data (if it isn't uploaded by the depth pre-pass) and render them
+    if (!isDepthPrepassDone_ || (alphaClippedRingGen_ != pRender->GetInstanceRing().GetGeneration()))
+    {
+        alphaClippedInstBase_ = pRender->UpdateInstancedBuffer(pContext, storage.alphaClippedModelInstBuffer);
+        alphaClippedRingGen_  = pRender->GetInstanceRing().GetGeneration();
+    }
 
-    // get a sphere model
-    const ModelID basicSphereID    = g_ModelMgr.GetModelIdByName("basic_sphere");
-    BasicModel& sphere             = g_ModelMgr.GetModelByID(basicSphereID);
-    const MeshGeometry& sphereMesh = sphere.meshes_;
+    pRender->RenderInstances(
+        pContext,
+        Render::ShaderTypes::LIGHT,
+        storage.alphaClippedModelInstances.data(),
+        (int)storage.alphaClippedModelInstances.size(),
+        alphaClippedInstBase_,
+        Render::DRAW_PASS_ALPHA_CLIPPED);
 
-    ID3D11Buffer* vb     = sphereMesh.vb_.Get();
-    ID3D11Buffer* ib     = sphereMesh.ib_.Get();
-    const int indexCount = (int)sphereMesh.ib_.GetIndexCount();
-    const int vertexSize = (int)sphereMesh.vb_.GetStride();
+    // reset rendering pipeline
+    renderStates.ResetRS(pContext);
+    pRender->SwitchAlphaClipping(pContext, false);
+}
 
-    // change view*proj matrix so we will be able to render material icons properly
-    const XMMATRIX world    = XMMatrixRotationY(yRotationAngle);
-    const XMMATRIX view     = XMMatrixTranslation(0, 0, 1.1f);
-    const XMMATRIX proj     = XMMatrixPerspectiveFovLH(1.0f, 1.0f, 0.1f, 100.0f);
+///////////////////////////////////////////////////////////
 
-    Render::MaterialIconShader& matIconShader = pRender->shadersContainer_.materialIconShader_;
-    matIconShader.SetMatrix(pContext, world, view, proj);
+void CGraphics::RenderDeferredShading(Render::CRender* pRender)
+{
+    // render the visible opaque and alpha clipped entts into the G-buffer and light
+    // it by the tiled compute shader (by the same light clusters of the frame) so
+    // lights are computed once per pixel whatever the overdraw is;
+    // if the G-buffer can't be used the forward passes are rendered instead
 
+    PROFILE_SCOPE("Render: deferred shading");
 
-    // prepare responsible frame buffer for rendering
-    materialBigIconFrameBuf_.ClearBuffers(pContext, { 0,0,0,0 });
-    materialBigIconFrameBuf_.Bind(pContext);
+    const Render::RenderDataStorage& storage  = pRender->dataStorage_;
+    Render::DeferredShading&         deferred = pRender->GetDeferredShading();
+    Render::InstanceRing&            ring     = pRender->GetInstanceRing();
+    RenderStates&                    states   = d3d_.GetRenderStates();
+    ID3D11DeviceContext*             pContext = pDeviceContext_;
 
-    // prepare material data and its textures
-    const Material& mat = g_MaterialMgr.GetMaterialByID(matID);
+    if (storage.modelInstances.empty() && storage.staticModelInstances.empty() && storage.alphaClippedModelInstances.empty())
+        return;
 
-    const Render::Material renderMat(
-        DirectX::XMFLOAT4(&mat.ambient.x),
-        DirectX::XMFLOAT4(&mat.diffuse.x),
-        DirectX::XMFLOAT4(&mat.specular.x),
-        DirectX::XMFLOAT4(&mat.reflect.x));
+    if (!deferred.BeginGBuffer(pContext))
+    {
+        RenderEnttsDefault(pRender);
+        RenderEnttsAlphaClipCullNone(pRender);
+        return;
+    }
 
-    cvector<ID3D11ShaderResourceView*> texSRVs;
-    g_TextureMgr.GetSRVsByTexIDs(mat.textureIDs, NUM_TEXTURE_TYPES, texSRVs);
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pContext, Render::GPU_PASS_DEFERRED);
 
-    // render material into responsible frame buffer
-    matIconShader.PrepareRendering(pContext, vb, ib, vertexSize);
-    matIconShader.Render(pContext, indexCount, texSRVs.data(), renderMat);
+    states.ResetRS(pContext);
+    states.ResetBS(pContext);
 
-    // reset camera's viewProj to the previous one (it can be game or editor camera)
-    pRender->SetViewProj(pContext, DirectX::XMMatrixTranspose(viewProj_));
+    if (isDepthPrepassDone_)
+        states.SetDSS(pContext, RSMask(DEPTH_EQUAL), 1);
+
+    // static entts go from the visible buffer of static batches
+    if (!storage.staticModelInstances.empty())
+    {
+        pRender->RenderGBufferInstances(
+            pContext,
+            pRender->GetStaticBatches().GetVisibleBuffer(),
+            storage.staticModelInstances.data(),
+            (int)storage.staticModelInstances.size(),
+            0,
+            Render::DRAW_PASS_OPAQUE);
+    }
+
+    // instances can be already uploaded by the depth pre-pass
+    if (!storage.modelInstances.empty())
+    {
+        if (!isDepthPrepassDone_ || (instRingGen_ != ring.GetGeneration()))
+        {
+            modelInstBase_ = pRender->UpdateInstancedBuffer(pContext, storage.modelInstBuffer);
+            instRingGen_   = ring.GetGeneration();
+        }
+
+        pRender->RenderGBufferInstances(
+            pContext,
+            ring.GetBuffer(),
+            storage.modelInstances.data(),
+            (int)storage.modelInstances.size(),
+            modelInstBase_,
+            Render::DRAW_PASS_OPAQUE);
+    }
+
+    if (!storage.alphaClippedModelInstances.empty())
+    {
+        if (!isDepthPrepassDone_ || (alphaClippedRingGen_ != ring.GetGeneration()))
+        {
+            alphaClippedInstBase_ = pRender->UpdateInstancedBuffer(pContext, storage.alphaClippedModelInstBuffer);
+            alphaClippedRingGen_  = ring.GetGeneration();
+        }
+
+        states.SetRS(pContext, RS_CULL_NONE_CW);
+        pRender->SwitchAlphaClipping(pContext, true);
+
+        pRender->RenderGBufferInstances(
+            pContext,
+            ring.GetBuffer(),
+            storage.alphaClippedModelInstances.data(),
+            (int)storage.alphaClippedModelInstances.size(),
+            alphaClippedInstBase_,
+            Render::DRAW_PASS_ALPHA_CLIPPED);
+
+        states.ResetRS(pContext);
+        pRender->SwitchAlphaClipping(pContext, false);
+    }
 
-    // copy frame buffer texture into the input SRV
-    *outMaterialImg = materialBigIconFrameBuf_.GetSRV();
+    deferred.EndGBuffer(pContext);
 
-    d3d.ResetBackBufferRenderTarget();
-    d3d.ResetViewport();
+    // light the G-buffer and composite it into the scene color
+    pRender->RenderDeferredLighting(pContext, renderGraph_.GetSRV(sceneDepthRes_), sceneWidth_, sceneHeight_);
 
-    return true;
+    states.ResetDSS(pContext);
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::RenderMaterialsIcons(
-    ECS::EntityMgr* pEnttMgr,
-    Render::CRender* pRender,
-    ID3D11ShaderResourceView** outArrShaderResourceViews,
-    const size numIcons,
-    const int iconWidth,
-    const int iconHeight)
+void CGraphics::RenderEnttsDeferred(Render::CRender* pRender)
 {
-    // render material icon (just sphere model with particular material) into
-    // frame buffer and store shader resource view into the input arr;
-    //
-    // NOTE: outArrShaderResourceViews.size() must == numShaderResourceViews
+    // the same as RenderEnttsDefault() + RenderEnttsAlphaClipCullNone() but instances
+    // of each pass are split into chunks which are recorded into deferred contexts
+    // on worker threads; then command lists are replayed in order
 
-    if (!pRender)
-    {
-        LogErr("input ptr to render == nullptr");
+    PROFILE_SCOPE("Render: deferred recording");
+
+    const Render::RenderDataStorage& storage  = pRender->dataStorage_;
+    Render::CommandRecorder&         recorder = pRender->GetCommandRecorder();
+    RenderStates&                    states   = d3d_.GetRenderStates();
+    ID3D11DeviceContext*             pContext = pDeviceContext_;
+
+    const bool hasDefault      = !storage.modelInstances.empty();
+    const bool hasStatic       = !storage.staticModelInstances.empty();
+    const bool hasAlphaClipped = !storage.alphaClippedModelInstances.empty();
+
+    if (!hasDefault && !hasStatic && !hasAlphaClipped)
         return;
+
+    const bool isWireframe = (pRender->shadersContainer_.debugShader_.GetDebugType() == Render::eDebugState::DBG_WIREFRAME);
+
+    // deferred contexts only draw so all the uploads are done here
+    // (unless instances are already uploaded by the depth pre-pass)
+    const Render::InstanceRing& ring = pRender->GetInstanceRing();
+
+    if (hasDefault && (!isDepthPrepassDone_ || (instRingGen_ != ring.GetGeneration())))
+    {
+        modelInstBase_ = pRender->UpdateInstancedBuffer(pContext, storage.modelInstBuffer);
+        instRingGen_   = ring.GetGeneration();
     }
-    if (!outArrShaderResourceViews)
+    if (hasAlphaClipped && (!isDepthPrepassDone_ || (alphaClippedRingGen_ != ring.GetGeneration())))
     {
-        LogErr("input arr of shader resource views == nullptr");
-        return;
+        alphaClippedInstBase_ = pRender->UpdateInstancedBuffer(pContext, storage.alphaClippedModelInstBuffer);
+        alphaClippedRingGen_  = ring.GetGeneration();
     }
 
-    D3DClass& d3d                 = GetD3DClass();
-    ID3D11Device* pDevice         = d3d.GetDevice();
-    ID3D11DeviceContext* pContext = d3d.GetDeviceContext();
-    const float nearZ             = d3d.GetScreenNear();
-    const float farZ              = d3d.GetScreenDepth();
+    // setup states of each pass on the immediate context and capture them
+    if (isWireframe)
+    {
+        states.SetRS(pContext, RS_WIREFRAME);
+    }
+    else
+    {
+        states.ResetRS(pContext);
+        states.ResetBS(pContext);
 
-    InitMatIconFrameBuffers(pDevice, materialsFrameBuffers_, numIcons, iconWidth, iconHeight, nearZ, farZ);
+        if (isDepthPrepassDone_)
+            states.SetDSS(pContext, RSMask(DEPTH_EQUAL), 1);
+    }
+    defaultPassState_.Capture(pContext);
 
-    // get a sphere model
-    const ModelID basicSphereID    = g_ModelMgr.GetModelIdByName("basic_sphere");
-    BasicModel& sphere             = g_ModelMgr.GetModelByID(basicSphereID);
-    const MeshGeometry& sphereMesh = sphere.meshes_;
+    if (!isWireframe)
+    {
+        states.SetRS(pContext, RS_CULL_NONE_CW);
 
-    ID3D11Buffer* vb     = sphereMesh.vb_.Get();
-    ID3D11Buffer* ib     = sphereMesh.ib_.Get();
-    const int indexCount = (int)sphereMesh.ib_.GetIndexCount();
-    const int vertexSize = (int)sphereMesh.vb_.GetStride();
+        if (isDepthPrepassDone_)
+            states.SetDSS(pContext, RSMask(DEPTH_EQUAL), 1);
+        else
+            states.ResetDSS(pContext);
+    }
+    alphaClippedPassState_.Capture(pContext);
+
+    // split contexts between the passes
+    const int numContexts        = recorder.GetNumContexts();
+    const int numDefaultContexts = (!hasAlphaClipped) ? numContexts : (!hasDefault) ? 0 : (numContexts + 1) / 2;
+
+    // chunk of instances for each context
+    const Render::Instance* chunkInstances[Render::CommandRecorder::MAX_NUM_CONTEXTS];
+    int                     chunkNumInstances[Render::CommandRecorder::MAX_NUM_CONTEXTS];
+    UINT                    chunkBaseInstance[Render::CommandRecorder::MAX_NUM_CONTEXTS];
+
+    auto SplitIntoChunks = [&](
+        const cvector<Render::Instance>& instances,
+        const UINT baseInstance,
+        const int firstCtx,
+        const int numCtxs)
+    {
+        const int numInstances = (int)instances.size();
+        UINT      base         = baseInstance;
 
-    // change view*proj matrix so we will be able to render material icons properly
-    const XMMATRIX world = XMMatrixRotationY(0.0f);
-    const XMMATRIX view  = XMMatrixTranslation(0, 0, 1.1f);
-    const XMMATRIX proj  = XMMatrixPerspectiveFovLH(1.0f, 1.0f, 0.1f, 100.0f);
+        for (int ctx = 0, start = 0; ctx < numCtxs; ++ctx)
+        {
+            const int end = (int)(((index)numInstances * (ctx + 1)) / numCtxs);
 
-    Render::MaterialIconShader& matIconShader = pRender->shadersContainer_.materialIconShader_;
+            chunkInstances   [firstCtx + ctx] = instances.data() + start;
+            chunkNumInstances[firstCtx + ctx] = end - start;
+            chunkBaseInstance[firstCtx + ctx] = base;
 
-    matIconShader.SetMatrix(pContext, world, view, proj);
-    matIconShader.PrepareRendering(pContext, vb, ib, vertexSize);
+            // data of the next chunk goes after all the subsets of this one
+            for (int i = start; i < end; ++i)
+                base += (UINT)(instances[i].subsets.size() * instances[i].numInstances);
+
+            start = end;
+        }
+    };
+
+    if (hasDefault)
+        SplitIntoChunks(storage.modelInstances, modelInstBase_, 0, numDefaultContexts);
 
-    // render material by idx into responsible frame buffer
-    for (int matIdx = 0; FrameBuffer& buf : materialsFrameBuffers_)
+    if (hasAlphaClipped)
+        SplitIntoChunks(storage.alphaClippedModelInstances, alphaClippedInstBase_, numDefaultContexts, numContexts - numDefaultContexts);
+
+    // record each chunk into its own deferred context
+    g_JobSystem.ParallelFor(numContexts, 1, [&](const index start, const index end)
     {
-        buf.ClearBuffers(pContext, { 0,0,0,0 });
-        buf.Bind(pContext);
+        for (index i = start; i < end; ++i)
+        {
+            if (chunkNumInstances[i] == 0)
+                continue;
 
-        // prepare material data and its textures
-        Material& mat = g_MaterialMgr.GetMaterialByID(matIdx);
+            const Render::PipelineState& state = (i < numDefaultContexts) ? defaultPassState_ : alphaClippedPassState_;
+            ID3D11DeviceContext* pDeferred     = recorder.BeginRecording((int)i, state);
 
-        const Render::Material renderMat(
-            XMFLOAT4(&mat.ambient.x),
-            XMFLOAT4(&mat.diffuse.x),
-            XMFLOAT4(&mat.specular.x),
-            XMFLOAT4(&mat.reflect.x));
+            pRender->RenderInstances(
+                pDeferred,
+                Render::ShaderTypes::LIGHT,
+                chunkInstances[i],
+                chunkNumInstances[i],
+                chunkBaseInstance[i],
+                (i < numDefaultContexts) ? Render::DRAW_PASS_OPAQUE : Render::DRAW_PASS_ALPHA_CLIPPED);
 
-        cvector<ID3D11ShaderResourceView*> texSRVs;
-        g_TextureMgr.GetSRVsByTexIDs(mat.textureIDs, NUM_TEXTURE_TYPES, texSRVs);
-        
-        matIconShader.Render(pContext, indexCount, texSRVs.data(), renderMat);
+            recorder.EndRecording((int)i);
+        }
+    });
+
+    // replay command lists in order (GPU time is measured on the immediate context)
+    Render::GpuProfiler& gpuProfiler = pRender->GetGpuProfiler();
+
+    gpuProfiler.BeginPass(pContext, Render::GPU_PASS_DEFAULT);
+
+    for (int i = 0; i < numDefaultContexts; ++i)
+        recorder.Execute(pContext, i);
+
+    // static entts are a few draws from the visible buffer of static batches
+    // so they go right on the immediate context
+    if (hasStatic)
+    {
+        if (isWireframe)
+        {
+            states.SetRS(pContext, RS_WIREFRAME);
+        }
+        else
+        {
+            states.ResetRS(pContext);
+
+            if (isDepthPrepassDone_)
+                states.SetDSS(pContext, RSMask(DEPTH_EQUAL), 1);
+        }
 
-        ++matIdx;
+        pRender->RenderInstances(
+            pContext,
+            pRender->GetStaticBatches().GetVisibleBuffer(),
+            Render::ShaderTypes::LIGHT,
+            storage.staticModelInstances.data(),
+            (int)storage.staticModelInstances.size(),
+            0,
+            Render::DRAW_PASS_OPAQUE);
     }
 
-    // reset camera's viewProj to the previous one (it can be game or editor camera)
-    pRender->SetViewProj(pContext, DirectX::XMMatrixTranspose(viewProj_));
+    gpuProfiler.EndPass(pContext, Render::GPU_PASS_DEFAULT);
+
+    if (hasAlphaClipped)
+    {
+        gpuProfiler.BeginPass(pContext, Render::GPU_PASS_ALPHA_CLIP);
 
-    // copy frame buffers textures into the input array of SRVs
-    for (int i = 0; FrameBuffer& buf : materialsFrameBuffers_)
-        outArrShaderResourceViews[i++] = buf.GetSRV();
+        // is read by the recorded draws only when they are executed
+        if (!isWireframe)
+            pRender->SwitchAlphaClipping(pContext, true);
+
+        for (int i = numDefaultContexts; i < numContexts; ++i)
+            recorder.Execute(pContext, i);
+
+        pRender->SwitchAlphaClipping(pContext, false);
+
+        gpuProfiler.EndPass(pContext, Render::GPU_PASS_ALPHA_CLIP);
+    }
+
+    states.ResetRS(pContext);
+
+    // don't hold the render targets (they can be recreated on resize)
+    defaultPassState_.Release();
+    alphaClippedPassState_.Release();
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::RenderEnttsDefault(Render::CRender* pRender)
+void CGraphics::RenderEnttsGpuDriven(Render::CRender* pRender)
 {
-    const Render::RenderDataStorage& storage = pRender->dataStorage_;
+    // cull the opaque entts on GPU and render the survived ones by indirect draws
+    // (the CPU cost doesn't depend on the number of entts but only on the number
+    // of unique (model, subset, LOD) draws)
 
-    // check if we have any instances to render
-    if (storage.modelInstances.empty())
+    PROFILE_SCOPE("Render: GPU-driven");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_GPU_DRIVEN);
+
+    if (!pRender->GetGpuCulling().HasScene())
         return;
 
+    ID3D11DeviceContext* pContext = pDeviceContext_;
+    RenderStates&        states   = d3d_.GetRenderStates();
 
-    // setup states before rendering
     if (pRender->shadersContainer_.debugShader_.GetDebugType() == Render::eDebugState::DBG_WIREFRAME)
     {
-        RenderStates& renderStates = d3d_.GetRenderStates();
-        renderStates.SetRS(pDeviceContext_, { FILL_WIREFRAME, CULL_BACK, FRONT_CLOCKWISE });
+        states.SetRS(pContext, RS_WIREFRAME);
     }
     else
     {
-        d3d_.GetRenderStates().ResetRS(pDeviceContext_);
-        d3d_.GetRenderStates().ResetBS(pDeviceContext_);
+        states.ResetRS(pContext);
+        states.ResetBS(pContext);
     }
 
-    pRender->UpdateInstancedBuffer(pDeviceContext_, storage.modelInstBuffer);
-
-    pRender->RenderInstances(
-        pDeviceContext_,
-        Render::ShaderTypes::LIGHT,
-        storage.modelInstances.data(),
-        (int)storage.modelInstances.size());
+    pRender->CullGpuInstances(pContext, gpuCullParams_);
+    pRender->RenderGpuCulledInstances(pContext);
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::RenderEnttsAlphaClipCullNone(Render::CRender* pRender)
+void CGraphics::RenderEntityIds(Render::CRender* pRender)
 {
-    // render all the visible entts with cull_none and alpha clipping;
-    // (entts for instance: wire fence, bushes, leaves, etc.)
+    // render IDs of the visible opaque and alpha clipped entts into the 1x1 target
+    // for the picked pixel (blended entts and terrain aren't pickable as on CPU)
 
-    const Render::RenderDataStorage& storage = pRender->dataStorage_;
-
-    // check if we have any instances to render
-    if (storage.alphaClippedModelInstances.empty())
-        return;
+    PROFILE_SCOPE("Render: entity IDs");
 
-    RenderStates& renderStates = d3d_.GetRenderStates();
-    ID3D11DeviceContext* pContext = pDeviceContext_;
+    const Render::RenderDataStorage& storage = pRender->dataStorage_;
+    Render::EntityIdBuffer&          idBuf   = pRender->GetEntityIdBuffer();
+    RenderStates&                    states  = d3d_.GetRenderStates();
+    ID3D11DeviceContext*             pContext = pDeviceContext_;
+    Render::InstanceRing&            ring     = pRender->GetInstanceRing();
+    const UINT                       elemSize = sizeof(Render::ConstBufType::InstancedData);
 
+    idBuf.Begin(
+        pContext,
+        pickX_,
+        pickY_,
+        (float)d3d_.GetWindowWidth(),
+        (float)d3d_.GetWindowHeight(),
+        viewProj_);
+
+    // the GPU culling result of this frame is still in the args buffer
+    if (IsGpuDriven(pRender) && pRender->GetGpuCulling().HasScene())
+    {
+        const Render::GpuCulling& culling = pRender->GetGpuCulling();
+
+        states.ResetRS(pContext);
+
+        idBuf.RenderIndirect(
+            pContext,
+            culling.GetVisibleBuffer(),
+            culling.GetArgsBuffer(),
+            culling.GetInstances().data(),
+            culling.GetDraws().data(),
+            (int)culling.GetDraws().size(),
+            Render::GpuCulling::INSTANCE_SIZE);
+    }
 
-    // setup states before rendering
-    if (pRender->shadersContainer_.debugShader_.GetDebugType() == Render::eDebugState::DBG_WIREFRAME)
+    if (!storage.staticModelInstances.empty())
     {
-        renderStates.SetRS(pContext, { FILL_WIREFRAME, CULL_BACK, FRONT_CLOCKWISE });
+        states.ResetRS(pContext);
+
+        idBuf.Render(
+            pContext,
+            pRender->GetStaticBatches().GetVisibleBuffer(),
+            storage.staticModelInstances.data(),
+            (int)storage.staticModelInstances.size(),
+            elemSize,
+            0,
+            false);
     }
-    else
+
+    // instances of the main pass are still in the ring so we reuse their ranges
+    // (they are reloaded only if the ring was discarded since then)
+    if (!storage.modelInstances.empty())
     {
-        renderStates.SetRS(pContext, { FILL_SOLID, CULL_NONE, FRONT_CLOCKWISE });
-        renderStates.ResetBS(pContext);
-        renderStates.ResetDSS(pContext);
-        pRender->SwitchAlphaClipping(pContext, true);
+        if (instRingGen_ != ring.GetGeneration())
+            modelInstBase_ = pRender->UpdateInstancedBuffer(pContext, storage.modelInstBuffer);
+
+        states.ResetRS(pContext);
+
+        idBuf.Render(
+            pContext,
+            ring.GetBuffer(),
+            storage.modelInstances.data(),
+            (int)storage.modelInstances.size(),
+            elemSize,
+            modelInstBase_,
+            false);
     }
 
-    // load instances data and render them
-    pRender->UpdateInstancedBuffer(pContext, storage.alphaClippedModelInstBuffer);
+    if (!storage.alphaClippedModelInstances.empty())
+    {
+        if (alphaClippedRingGen_ != ring.GetGeneration())
+            alphaClippedInstBase_ = pRender->UpdateInstancedBuffer(pContext, storage.alphaClippedModelInstBuffer);
 
-    pRender->RenderInstances(
-        pContext,
-        Render::ShaderTypes::LIGHT,
-        storage.alphaClippedModelInstances.data(),
-        (int)storage.alphaClippedModelInstances.size());
+        states.SetRS(pContext, RS_CULL_NONE_CW);
 
-    // reset rendering pipeline
-    renderStates.ResetRS(pContext);
-    pRender->SwitchAlphaClipping(pContext, false);
+        idBuf.Render(
+            pContext,
+            ring.GetBuffer(),
+            storage.alphaClippedModelInstances.data(),
+            (int)storage.alphaClippedModelInstances.size(),
+            elemSize,
+            alphaClippedInstBase_,
+            true);
+
+        states.ResetRS(pContext);
+    }
+
+    idBuf.End(pContext);
+    isPickRequested_ = false;
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::RenderEnttsBlended(Render::CRender* pRender)
+void CGraphics::RenderEnttsBlended(Render::CRender* pRender, const bool isLowRes)
 {
-    // render all the visible blended entts
+    // render the visible blended entts (only low resolution ones, or all the rest);
+    // NOTE: blending states of entts are bits of ECS render states hashes which are used as masks as is
+    static_assert((ECS::NO_RENDER_TARGET_WRITES == NO_RENDER_TARGET_WRITES) &&
+                  (ECS::NO_BLENDING             == ALPHA_DISABLE) &&
+                  (ECS::TRANSPARENCY            == TRANSPARENCY) &&
+                  (ECS::FRONT_CLOCKWISE         == FRONT_CLOCKWISE),
+                  "bits of ECS render states must be the same as of Core::RenderStatesMask");
+
+    PROFILE_SCOPE("Render: blended");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_BLENDED);
 
     const Render::RenderDataStorage& storage = pRender->dataStorage_;
 
@@ -1052,112 +4556,248 @@ void CGraphics::RenderEnttsBlended(Render::CRender* pRender)
         return;
 
     const ECS::EnttsBlended& blendData = rsDataToRender_.enttsBlended_;
-    const ECS::eRenderState* blendStates = blendData.states_.data();
+    const uint32* blendStates = blendData.states_.data();
     const size numBlendStates = blendData.states_.size();
     const size* numInstancesPerBlendState = blendData.instanceCountPerBS_.data();
     const Render::InstBuffData& instBuffer = storage.blendedModelInstBuffer;
 
     // push data into the instanced buffer
-    pRender->UpdateInstancedBuffer(pDeviceContext_, instBuffer);
+    // (each pass maps its own range of the instances ring)
+    UINT baseInstance = pRender->UpdateInstancedBuffer(pDeviceContext_, instBuffer);
 
+    RenderStates& renderStates = d3d_.GetRenderStates();
     int instanceOffset = 0;
 
     // go through each blending state, turn it on and render blended entts with this state
+    // (inside the group draws are sorted from far to near); if there is the low resolution
+    // pass, the group is split into runs of instances which go into the same pass
     for (index bsIdx = 0; bsIdx < numBlendStates; ++bsIdx)
     {
-        d3d_.TurnOnBlending(eRenderState(blendStates[bsIdx]));
+        const RenderStatesMask blendState = blendStates[bsIdx];
+
+        if (isLowRes)
+            renderStates.SetOffscreenBS(pDeviceContext_, blendState);
+        else
+            d3d_.TurnOnBlending(blendState);
+
+        const Render::Instance* instances = &(storage.blendedModelInstances[instanceOffset]);
+        const int numInstances = (int)numInstancesPerBlendState[bsIdx];
 
-        for (u32 instCount = 0; instCount < numInstancesPerBlendState[bsIdx]; ++instCount)
+        for (int runStart = 0; runStart < numInstances; )
         {
-            const Render::Instance* instance = &(storage.blendedModelInstances[instanceOffset]);
-            pRender->RenderInstances(pDeviceContext_, Render::ShaderTypes::LIGHT, instance, 1);
-            ++instanceOffset;
+            const bool isRunLowRes = isLowResEnttsPass_ && IsLowResInstance(instances[runStart], blendState);
+            int runEnd = runStart + 1;
+
+            while ((runEnd < numInstances) &&
+                   ((isLowResEnttsPass_ && IsLowResInstance(instances[runEnd], blendState)) == isRunLowRes))
+            {
+                ++runEnd;
+            }
+
+            if (isRunLowRes == isLowRes)
+            {
+                pRender->RenderInstances(
+                    pDeviceContext_,
+                    Render::ShaderTypes::LIGHT,
+                    instances + runStart,
+                    runEnd - runStart,
+                    baseInstance,
+                    Render::DRAW_PASS_BLENDED);
+            }
+
+            // data of the next run goes after all the subsets of this one
+            for (int i = runStart; i < runEnd; ++i)
+                baseInstance += (UINT)(instances[i].subsets.size() * instances[i].numInstances);
+
+            runStart = runEnd;
         }
+
+        instanceOffset += numInstances;
     }
+
+    renderStates.ResetBS(pDeviceContext_);
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::RenderBoundingLineBoxes(
-    Render::CRender* pRender,
-    ECS::EntityMgr* pEnttMgr)
+bool CGraphics::IsLowResInstance(const Render::Instance& instance, const RenderStatesMask blendState)
 {
-    Render::RenderDataStorage& storage           = pRender->dataStorage_;
-    Render::InstBuffData& instancesBuffer        = storage.boundingLineBoxBuffer;
-    cvector<Render::Instance>& instances = storage.boundingLineBoxInstances;
+    if (!d3d_.GetRenderStates().HasOffscreenBS(blendState))
+        return false;
 
-    // prepare the line box instance
-    const int numInstances = 1;                // how many different line box models we have
-    const ModelID lineBoxId = 1;
-    BasicModel& lineBox = g_ModelMgr.GetModelByID(lineBoxId);
-    
-    // we will use only one type of model -- line box
-    instances.resize(1);                         
-    Render::Instance& instance = instances[0];
-    prep_.PrepareInstanceData(lineBox, instance);
+    for (const MaterialID matID : instance.materialIDs)
+    {
+        if (!g_MaterialMgr.GetMaterialByID(matID).HasFlag(LOW_RES_BLENDING))
+            return false;
+    }
 
+    return !instance.materialIDs.empty();
+}
 
-    // choose the bounding box show mode
-    // (1: box around the while model, 2: box around each model's mesh)
-    if (aabbShowMode_ == MODEL)
-        prep_.PrepareEnttsBoundingLineBox(pEnttMgr, instance, instancesBuffer);
-    else if (aabbShowMode_ == MESH)
-        prep_.PrepareEnttsMeshesBoundingLineBox(pEnttMgr, instance, instancesBuffer);
+///////////////////////////////////////////////////////////
+
+bool CGraphics::HasLowResInstances(Render::CRender* pRender)
+{
+    const Render::RenderDataStorage& storage = pRender->dataStorage_;
+    const ECS::EnttsBlended& blendData = rsDataToRender_.enttsBlended_;
+    index instanceOffset = 0;
 
+    for (index bsIdx = 0; bsIdx < blendData.states_.size(); ++bsIdx)
+    {
+        const index numInstances = (index)blendData.instanceCountPerBS_[bsIdx];
 
-    // render
-    ID3D11DeviceContext* pContext = pDeviceContext_;
-    pContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+        for (index i = 0; i < numInstances; ++i)
+        {
+            if (IsLowResInstance(storage.blendedModelInstances[instanceOffset + i], blendData.states_[bsIdx]))
+                return true;
+        }
+
+        instanceOffset += numInstances;
+    }
 
-    pRender->UpdateInstancedBuffer(pContext, instancesBuffer);
-    pRender->RenderBoundingLineBoxes(pContext, &instance, numInstances);
+    return false;
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::RenderBoundingLineSpheres()
+void CGraphics::AddBoundingLineBoxes(ECS::EntityMgr* pEnttMgr)
 {
-    // render line bound sphere around each visible point light source
+    // add a box around each visible entity (its world AABB) or around
+    // each mesh of each visible entity (OBBs of meshes in world space)
 
-#if 0
-    const std::vector<EntityID>& visPointLights = entityMgr_.renderSystem_.GetArrVisibleLightSources();
-    const size numVisLightSources = std::ssize(visPointLights);
+    PROFILE_SCOPE("Render: bounding boxes");
+
+    const cvector<EntityID>& visEntts = pEnttMgr->renderSystem_.GetAllVisibleEntts();
+    const size numVisEntts            = visEntts.size();
+
+    if ((numVisEntts == 0) || !pRenderableQuery_)
+        return;
 
-    if (numVisLightSources > 0)
+    const uint32 color = DebugDraw::PackColor(1, 1, 0);
+
+    if (aabbShowMode_ == MODEL)
     {
-        Render::RenderDataStorage& storage = render_.dataStorage_;
-        Render::InstBuffData& instancesBuffer = storage.boundingLineBoxBuffer_;
-        std::vector<Render::Instance>& instances = storage.boundingLineBoxInstances_;
+        const ECS::Bounding&         bounding = pRenderableQuery_->Get<ECS::Bounding>();
+        const ECS::BoundingWorldSoA& world    = bounding.world;
+
+        debugLines_.resize(numVisEntts * 24);
+        int numBoxes = 0;
+
+        for (const EntityID id : visEntts)
+        {
+            const index idx = bounding.sparseIdxs.GetIdx(id);
+            if (idx == ECS::SparseSet::INVALID_IDX)
+                continue;
 
-        // prepare instance data
-        const int numInstances = 1;
-        BasicModel& boundSphere = modelStorage_.GetModelByName("bound_sphere");
+            const XMFLOAT3 minPoint = { world.minX[idx], world.minY[idx], world.minZ[idx] };
+            const XMFLOAT3 maxPoint = { world.maxX[idx], world.maxY[idx], world.maxZ[idx] };
 
-        instances.resize(1);
-        Render::Instance& instance = instances[0];
-        prep_.PrepareInstanceData(boundSphere, instance);
+            DebugDraw::BuildAABB(minPoint, maxPoint, color, debugLines_.data() + (24 * numBoxes));
+            ++numBoxes;
+        }
 
+        g_DebugDraw.AddLines(debugLines_.data(), 24 * numBoxes);
+    }
+    else if (aabbShowMode_ == MESH)
+    {
+        pEnttMgr->boundingSystem_.GetOBBs(visEntts.data(), numVisEntts, debugNumBoxesPerEntt_, debugOBBs_);
+        pEnttMgr->transformSystem_.GetWorlds(visEntts.data(), numVisEntts, debugWorlds_);
 
-        // prepare instances buffer data
-        instance.numInstances = numVisLightSources;
-        instancesBuffer.Resize(instance.numInstances);
+        debugLines_.resize(debugOBBs_.size() * 24);
+        XMFLOAT3 corners[BoundingOrientedBox::CORNER_COUNT];
 
-        // generate world matrix for each instance of bounding sphere 
-        for (int i = 0; i < (int)numVisLightSources; ++i)
+        // OBBs of meshes are in local space of the entity
+        for (int boxIdx = 0, i = 0; i < (int)numVisEntts; ++i)
         {
-            const int pointLightIdx = idxsToVisLightSources[i];
-            const float scale = posAndRange[pointLightIdx].range;
-            const XMFLOAT3& pos = posAndRange[pointLightIdx].position;
-            instancesBuffer.worlds_[i] = DirectX::XMMatrixScaling(scale, scale, scale) * DirectX::XMMatrixTranslation(pos.x, pos.y, pos.z);
+            for (size j = 0; j < debugNumBoxesPerEntt_[i]; ++j, ++boxIdx)
+            {
+                BoundingOrientedBox obbW;
+                debugOBBs_[boxIdx].Transform(obbW, debugWorlds_[i]);
+                obbW.GetCorners(corners);
+
+                DebugDraw::BuildBox(corners, color, debugLines_.data() + (24 * boxIdx));
+            }
         }
 
-        pDeviceContext_->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP);
+        g_DebugDraw.AddLines(debugLines_.data(), debugLines_.size());
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::AddBoundingLineSpheres(ECS::EntityMgr* pEnttMgr)
+{
+    // add a sphere (by the range) around each visible point light source
+
+    const cvector<EntityID>& visPointLights = pEnttMgr->renderSystem_.GetVisiblePointLights();
+    const size numVisPointLights            = visPointLights.size();
+
+    if (numVisPointLights == 0)
+        return;
+
+    const ECS::PointLights&   pointLights  = pEnttMgr->lightSystem_.GetPointLights();
+    const ConstSpan<XMFLOAT4> posAndScales = pEnttMgr->transformSystem_.GetPosAndUniformScalesSpan();
+    LightTempData&            tmp          = lightTempData_;
+
+    pointLights.sparseIdxs.GetIdxs(visPointLights, tmp.pointLightIdxs, 0);
+    pEnttMgr->transformSystem_.GetIdxs(visPointLights.data(), numVisPointLights, tmp.transformIdxs);
+
+    const uint32 color = DebugDraw::PackColor(1, 0.5f, 0);
 
-        // render
-        render_.UpdateInstancedBuffer(pDeviceContext_, instancesBuffer);
-        render_.RenderBoundingLineBoxes(pDeviceContext_, &instance, numInstances);
+    for (index i = 0; i < numVisPointLights; ++i)
+    {
+        const XMFLOAT4& pos = posAndScales[tmp.transformIdxs[i]];
+
+        g_DebugDraw.AddSphere(
+            XMFLOAT3(pos.x, pos.y, pos.z),
+            pointLights.range[tmp.pointLightIdxs[i]],
+            color);
     }
-#endif
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::RenderDebugLines(Render::CRender* pRender)
+{
+    // render all the debug lines of this frame (from any system) by a single draw call
+
+    // the lines were taken from the debug drawing at extraction
+    const cvector<Render::VertexDebugLine>* pLines = pFramePacket_->pDebugLines;
+
+    if (!pLines || pLines->empty())
+        return;
+
+    const cvector<Render::VertexDebugLine>& lines = *pLines;
+
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_BOUNDING_BOXES);
+
+    pRender->shadersContainer_.debugLineShader_.Render(
+        pDevice_,
+        pDeviceContext_,
+        lines.data(),
+        (UINT)lines.size());
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::RenderEditorGrid(Render::CRender* pRender)
+{
+    // render the procedural grid of the editor by a single draw without vertices
+
+    PROFILE_SCOPE("Render: editor grid");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_EDITOR_GRID);
+
+    // the camera of the extracted frame (the render thread can be ahead of the update)
+    const SystemState& sysState = pFramePacket_->sysState;
+    const XMMATRIX     viewProj = sysState.cameraView * sysState.cameraProj;
+
+    pRender->GetEditorGrid().Render(pDeviceContext_, viewProj, sysState.cameraPos);
+
+    // the grid sets its own states (through the same state cache)
+    RenderStates& renderStates = d3d_.GetRenderStates();
+    renderStates.ResetRS(pDeviceContext_);
+    renderStates.ResetBS(pDeviceContext_);
+    renderStates.ResetDSS(pDeviceContext_);
 }
 
 ///////////////////////////////////////////////////////////
@@ -1168,6 +4808,9 @@ void CGraphics::RenderFoggedBillboards(
 {
     // render billboard of entities which are fully fogged so we see only its silhouette
 
+    PROFILE_SCOPE("Render: billboards");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_BILLBOARDS);
+
     const EntityID* foggedEntts = rsDataToRender_.enttsFogged_.ids_.data();
     const size numFoggedEntts = rsDataToRender_.enttsFogged_.ids_.size();
 
@@ -1175,10 +4818,10 @@ void CGraphics::RenderFoggedBillboards(
     if (numFoggedEntts == 0)
         return;
 
-    d3d_.TurnOnBlending(ALPHA_TO_COVERAGE);
+    d3d_.TurnOnBlending(RSMask(ALPHA_TO_COVERAGE));
 
     RenderStates& renderStates = d3d_.GetRenderStates();
-    renderStates.SetRS(pDeviceContext_, CULL_NONE);
+    renderStates.SetRS(pDeviceContext_, RSMask(CULL_NONE));
     pRender->SwitchAlphaClipping(pDeviceContext_, true);
 
     //
@@ -1207,23 +4850,126 @@ void CGraphics::RenderFoggedBillboards(
     instance.texSRVs = { g_TextureMgr.GetTexPtrByName("tree_billboard")->GetTextureResourceView() };
     instance.vertexStride = sizeof(TreePointSprite);
 
-    pRender->shadersContainer_.billboardShader_.Render(pDeviceContext_, instance);
+    pRender->shadersContainer_.billboardShader_.Render(pDeviceContext_, instance);
+
+    // reset rendering pipeline
+    renderStates.ResetRS(pDeviceContext_);
+    pRender->SwitchAlphaClipping(pDeviceContext_, false);
+   
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::RenderImpostors(Render::CRender* pRender)
+{
+    // render far entts by quads of their models' impostor atlases
+
+    PROFILE_SCOPE("Render: impostors");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_IMPOSTORS);
+
+    if (impostorsData_.empty())
+        return;
+
+    Render::ImpostorShader& shader = pRender->shadersContainer_.impostorShader_;
+    shader.UpdateInstancedBuffer(pDeviceContext_, impostorsData_.data(), (int)impostorsData_.size());
+
+    RenderStates& renderStates = d3d_.GetRenderStates();
+    renderStates.SetRS(pDeviceContext_, RSMask(CULL_NONE));
+
+    for (const ImpostorBatch& batch : impostorBatches_)
+    {
+        shader.Render(
+            pDeviceContext_,
+            g_TextureMgr.GetSRVByTexID(batch.texID),
+            batch.atlas,
+            batch.start,
+            batch.count);
+    }
+
+    renderStates.ResetRS(pDeviceContext_);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::RenderGrass(Render::CRender* pRender)
+{
+    // render grass clumps which were scattered over the terrain in this frame
+
+    PROFILE_SCOPE("Render: grass");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_GRASS);
+
+    RenderStates& renderStates = d3d_.GetRenderStates();
+    renderStates.ResetBS(pDeviceContext_);
+    renderStates.ResetDSS(pDeviceContext_);
+
+    pRender->GetGrassScatter().Render(pDeviceContext_);
+
+    // the grass sets its own raster state (through the same state cache)
+    renderStates.ResetRS(pDeviceContext_);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::RenderSkinned(Render::CRender* pRender)
+{
+    // render animated entts: a single instanced draw per subset of each skinned model
+
+    PROFILE_SCOPE("Render: skinned");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_SKINNED);
+
+    RenderStates& renderStates = d3d_.GetRenderStates();
+    renderStates.ResetBS(pDeviceContext_);
+    renderStates.ResetDSS(pDeviceContext_);
+    renderStates.ResetRS(pDeviceContext_);
+
+    // crowds are lit forward by the light PS (by the same light clusters)
+    Render::LightShader& lightShader = pRender->GetLightShader();
+
+    pRender->GetSkinnedCrowds().Render(
+        pDeviceContext_,
+        skinnedBatches_.data(),
+        (UINT)skinnedBatches_.size(),
+        lightShader.GetPS().GetShader(),
+        lightShader.GetSamplerState().GetSampler());
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::RenderParticles(Render::CRender* pRender, const bool isLowRes)
+{
+    // render GPU particles (sorted back to front) over the scene (or into the low resolution target)
 
-    // reset rendering pipeline
+    PROFILE_SCOPE("Render: particles");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_PARTICLES);
+
+    ID3D11ShaderResourceView* texSRVs[Render::GpuParticles::MAX_TEXTURES]{ nullptr };
+
+    for (UINT i = 0; i < numParticleTextures_; ++i)
+        texSRVs[i] = g_TextureMgr.GetSRVByTexID(particleTexIDs_[i]);
+
+    // the depth isn't bound by the pass of soft particles: it's read by the PS
+    const RGResource depthRes = (isLowRes) ? lowResDepthRes_ : sceneDepthRes_;
+    ID3D11ShaderResourceView* pDepthSRV = (isSoftParticles_) ? renderGraph_.GetSRV(depthRes) : nullptr;
+
+    // (the premultiplied blending of particles is already fine for the low resolution target)
+    pRender->GetGpuParticles().Render(pDeviceContext_, texSRVs, numParticleTextures_, pDepthSRV);
+
+    // particles set their own states (through the same state cache)
+    RenderStates& renderStates = d3d_.GetRenderStates();
     renderStates.ResetRS(pDeviceContext_);
-    pRender->SwitchAlphaClipping(pDeviceContext_, false);
-   
+    renderStates.ResetBS(pDeviceContext_);
+    renderStates.ResetDSS(pDeviceContext_);
 }
 
 ///////////////////////////////////////////////////////////
 
-void CGraphics::RenderSkyDome(Render::CRender* pRender, ECS::EntityMgr* pEnttMgr)
+void CGraphics::RenderSkyDome(Render::CRender* pRender)
 {
-    // check if we at least have a sky entity
-    const EntityID skyEnttID = pEnttMgr->nameSystem_.GetIdByName("sky");
+    PROFILE_SCOPE("Render: sky dome");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_SKY_DOME);
 
-    // if we haven't any sky entity
-    if (skyEnttID == INVALID_ENTITY_ID)
+    // if we haven't any sky entity (the overdraw heatmap shows only the scene's geometry)
+    if (!pFramePacket_->hasSky || IsOverdrawDebug(pRender))
         return;
 
     const SkyModel& sky = g_ModelMgr.GetSky();
@@ -1241,35 +4987,59 @@ void CGraphics::RenderSkyDome(Render::CRender* pRender, ECS::EntityMgr* pEnttMgr
     ID3D11DeviceContext* pContext = pDeviceContext_;
 
     RenderStates& renderStates = d3d_.GetRenderStates();
-    renderStates.SetRS(pContext, { FILL_SOLID, CULL_NONE, FRONT_COUNTER_CLOCKWISE });
+    renderStates.SetRS(pContext, RS_CULL_NONE_CCW);
     renderStates.ResetBS(pContext);
-    renderStates.SetDSS(pContext, SKY_DOME, 1);
+    renderStates.SetDSS(pContext, RSMask(SKY_DOME), 1);
 
 
-    // compute a worldViewProj matrix for the sky instance
-    const XMFLOAT3 skyOffset     = pEnttMgr->transformSystem_.GetPosition(skyEnttID);
-    const XMFLOAT3 eyePos        = pEnttMgr->cameraSystem_.GetPos(currCameraID_);
-    const XMFLOAT3 translation   = skyOffset + eyePos;
-    const XMMATRIX world         = DirectX::XMMatrixTranslation(translation.x, translation.y, translation.z);
-    const XMMATRIX worldViewProj = DirectX::XMMatrixTranspose(world * viewProj_);
-
-    pRender->RenderSkyDome(pContext, instance, worldViewProj);
+    // the worldViewProj matrix of the sky is computed at extraction
+    pRender->RenderSkyDome(pContext, instance, pFramePacket_->skyWorldViewProj);
 }
 
 //---------------------------------------------------------
 // Desc:   render terrain onto the screen
 // Args:   - pRender: a pointer to the renderer (look at Render module)
-//         - pEnttMgr: a pointer to the ECS manager (look at ECS module)
 //---------------------------------------------------------
-void CGraphics::RenderTerrain(Render::CRender* pRender, ECS::EntityMgr* pEnttMgr)
+void CGraphics::RenderTerrain(Render::CRender* pRender)
 {
-    const EntityID terrainID = pEnttMgr->nameSystem_.GetIdByName("terrain");
+    PROFILE_SCOPE("Render: terrain");
+    Render::GpuProfileScope gpuScope(pRender->GetGpuProfiler(), pDeviceContext_, Render::GPU_PASS_TERRAIN);
 
     // if we haven't any terrain entity
-    if (terrainID == INVALID_ENTITY_ID)
+    if (!pFramePacket_->hasTerrain)
+        return;
+
+    if (terrainStreamer_.IsActive())
+    {
+        RenderTerrainTiles(pRender);
         return;
+    }
+
+    // the texture map is sampled from the virtual texture (if it is) and
+    // its pages which are requested by this frame are read back later
+    Render::VirtualTexture& vt   = pRender->GetTerrainVT();
+    const bool              isVT = isTerrainVT_ && terrainVT_.IsReady();
+
+    if (isVT)
+        vt.Bind(pDeviceContext_);
+
+    if (IsTerrainTessellated(pRender))
+        RenderTerrainTessellated(pRender);
+    else
+        RenderTerrainGeomipmapped(pRender);
 
+    if (isVT)
+    {
+        vt.Unbind(pDeviceContext_);
+        vt.CopyFeedback(pDeviceContext_);
+    }
+}
 
+//---------------------------------------------------------
+// Desc:   render visible patches of the geomipmapped terrain
+//---------------------------------------------------------
+void CGraphics::RenderTerrainGeomipmapped(Render::CRender* pRender)
+{
     // prepare the terrain instance
     TerrainGeomipmapped& terrain = g_ModelMgr.GetTerrainGeomip();
     Render::TerrainInstance instance;
@@ -1285,15 +5055,40 @@ void CGraphics::RenderTerrain(Render::CRender* pRender, ECS::EntityMgr* pEnttMgr
     g_TextureMgr.GetSRVsByTexIDs(mat.textureIDs, NUM_TEXTURE_TYPES, texturesBuf_);
     memcpy(instance.textures, texturesBuf_.begin(), NUM_TEXTURE_TYPES * sizeof(ID3D11ShaderResourceView*));
 
-    // vertex/index buffers data
-    instance.vertexStride   = terrain.GetVertexStride();
-    instance.pVB            = terrain.GetVertexBuffer();
-    instance.pIB            = terrain.GetIndexBuffer();
-    instance.numVertices    = terrain.verticesOffset_;
-    instance.indexCount     = terrain.GetNumIndices();
+    // vertex/index buffers data: the whole grid of vertices or (for vertex
+    // pulling) the grid of a single patch and heights from the height map
+    if (terrain.IsVertexPulling())
+    {
+        instance.vertexStride   = terrain.GetGridVertexStride();
+        instance.pVB            = terrain.GetGridVertexBuffer();
+        instance.pIB            = terrain.GetGridIndexBuffer();
+        instance.pPatchStartsVB = terrain.GetPatchStartsBuffer();
+        instance.heightMap      = g_TextureMgr.GetSRVByTexID(terrain.heightMapTexID_);
+
+        // morphs of the visible patches were computed by this frame's update
+        terrain.UploadPatchMorphs(pDeviceContext_);
+        instance.pPatchMorphsVB   = terrain.GetPatchMorphsBuffer();
+        instance.patchMorphStride = terrain.GetPatchMorphStride();
+    }
+    else
+    {
+        instance.vertexStride   = terrain.GetVertexStride();
+        instance.pVB            = terrain.GetVertexBuffer();
+        instance.pIB            = terrain.GetIndexBuffer();
+        instance.numVertices    = terrain.GetNumVertices();
+        instance.indexCount     = terrain.GetNumIndices();
+    }
+
+    // draw list of visible patches
+    instance.patchStartIndices = terrain.drawStartIndices_.data();
+    instance.patchIndexCounts  = terrain.drawIndexCounts_.data();
+    instance.patchBaseVertices = terrain.drawBaseVertices_.data();
+    instance.patchNumbers      = terrain.drawPatchNums_.data();
+    instance.numPatches        = (UINT)terrain.drawStartIndices_.size();
 
     // for debugging
     instance.wantDebug = terrain.wantDebug_;
+    SetupTerrainHeatmap(pRender, terrain, instance);
 
     // setup rendering pipeline before rendering of the sky dome
    
@@ -1304,10 +5099,15 @@ void CGraphics::RenderTerrain(Render::CRender* pRender, ECS::EntityMgr* pEnttMgr
     // setup states before rendering
     if (pRender->shadersContainer_.debugShader_.GetDebugType() == Render::eDebugState::DBG_WIREFRAME)
     {
-        renderStates.SetRS(pDeviceContext_, { FILL_WIREFRAME, CULL_BACK, FRONT_CLOCKWISE });
+        renderStates.SetRS(pDeviceContext_, RS_WIREFRAME);
         renderStates.ResetBS(pContext);
         renderStates.ResetDSS(pContext);
     }
+    else if (IsOverdrawDebug(pRender))
+    {
+        renderStates.ResetRS(pContext);
+        SetOverdrawStates(pContext);
+    }
     else
     {
         renderStates.ResetRS(pContext);
@@ -1315,15 +5115,212 @@ void CGraphics::RenderTerrain(Render::CRender* pRender, ECS::EntityMgr* pEnttMgr
         renderStates.ResetDSS(pContext);
     }
 
-    pRender->shadersContainer_.terrainShader_.RenderVertices(pContext, instance);
+    if (terrain.IsVertexPulling())
+    {
+        // the same positions as of the static grid of geomipmapping
+        Render::ConstBufType::cbvsTerrainGrid params;
+        params.origin      = { terrain.originX_, terrain.originZ_ };
+        params.gridStep    = (float)terrain.patchSize_ / (float)(terrain.patchSize_ - 1);
+        params.heightScale = 255.0f * terrain.GetHeightScale();   // the height map is an 8-bit gray image
+        params.texelSize   = 1.0f / (float)terrain.heightMap_.GetWidth();
+        params.cellsPerPatch = (uint32)(terrain.patchSize_ - 1);
+
+        pRender->shadersContainer_.terrainShader_.RenderPatchesPulled(pContext, instance, params);
+    }
+    else
+    {
+        pRender->shadersContainer_.terrainShader_.RenderPatches(pContext, instance);
+    }
 
     // compute how many vertices we already rendered
-    pSysState_->visibleVerticesCount += (uint32_t)terrain.verticesOffset_;
-    //pSysState_->visibleVerticesCount += terrain.vb_.GetVertexCount();
+    pFramePacket_->sysState.visibleVerticesCount += (uint32_t)terrain.GetNumIndicesPerFrame();
 
     terrain.wantDebug_ = false;
 }
 
+//---------------------------------------------------------
+// Desc:   render the terrain by the coarse patches grid which is
+//         culled and tessellated on GPU (no CPU work per frame)
+//---------------------------------------------------------
+void CGraphics::RenderTerrainTessellated(Render::CRender* pRender)
+{
+    TerrainGeomipmapped& terrain = g_ModelMgr.GetTerrainGeomip();
+    Render::TerrainInstance instance;
+
+    // prepare material and textures (the same as of the geomipmapped terrain)
+    const Material& mat = g_MaterialMgr.GetMaterialByID(terrain.materialID_);
+    memcpy(&instance.material.ambient_.x,  &mat.ambient.x,  sizeof(float) * 4);
+    memcpy(&instance.material.diffuse_.x,  &mat.diffuse.x,  sizeof(float) * 4);
+    memcpy(&instance.material.specular_.x, &mat.specular.x, sizeof(float) * 4);
+    memcpy(&instance.material.reflect_.x,  &mat.reflect.x,  sizeof(float) * 4);
+
+    g_TextureMgr.GetSRVsByTexIDs(mat.textureIDs, NUM_TEXTURE_TYPES, texturesBuf_);
+    memcpy(instance.textures, texturesBuf_.begin(), NUM_TEXTURE_TYPES * sizeof(ID3D11ShaderResourceView*));
+
+    // control points of patches and the height map for displacement
+    instance.vertexStride = terrain.GetTessVertexStride();
+    instance.pVB          = terrain.GetTessVertexBuffer();
+    instance.numVertices  = terrain.GetNumTessControlPoints();
+    instance.heightMap    = g_TextureMgr.GetSRVByTexID(terrain.heightMapTexID_);
+
+    RenderStates&        renderStates = d3d_.GetRenderStates();
+    ID3D11DeviceContext* pContext     = pDeviceContext_;
+
+    // setup states before rendering
+    if (pRender->shadersContainer_.debugShader_.GetDebugType() == Render::eDebugState::DBG_WIREFRAME)
+        renderStates.SetRS(pContext, RS_WIREFRAME);
+    else
+        renderStates.ResetRS(pContext);
+
+    renderStates.ResetBS(pContext);
+    renderStates.ResetDSS(pContext);
+
+    pRender->shadersContainer_.terrainShader_.RenderTessellated(pContext, instance, pFramePacket_->terrainTess);
+
+    // the number of generated vertices is known only by the GPU
+    pFramePacket_->sysState.visibleVerticesCount += (uint32_t)instance.numVertices;
+}
+
+//---------------------------------------------------------
+// Desc:   render the resident tiles of the streamed terrain: each tile is
+//         a geomipmapped terrain with its own texture/light maps (the rest
+//         of material is taken from the loaded terrain)
+//---------------------------------------------------------
+void CGraphics::RenderTerrainTiles(Render::CRender* pRender)
+{
+    const TerrainGeomipmapped& baseTerrain = g_ModelMgr.GetTerrainGeomip();
+    Render::TerrainInstance instance;
+
+    const Material& mat = g_MaterialMgr.GetMaterialByID(baseTerrain.materialID_);
+    memcpy(&instance.material.ambient_.x,  &mat.ambient.x,  sizeof(float) * 4);
+    memcpy(&instance.material.diffuse_.x,  &mat.diffuse.x,  sizeof(float) * 4);
+    memcpy(&instance.material.specular_.x, &mat.specular.x, sizeof(float) * 4);
+    memcpy(&instance.material.reflect_.x,  &mat.reflect.x,  sizeof(float) * 4);
+
+    g_TextureMgr.GetSRVsByTexIDs(mat.textureIDs, NUM_TEXTURE_TYPES, texturesBuf_);
+    memcpy(instance.textures, texturesBuf_.begin(), NUM_TEXTURE_TYPES * sizeof(ID3D11ShaderResourceView*));
+
+    RenderStates&        renderStates = d3d_.GetRenderStates();
+    ID3D11DeviceContext* pContext     = pDeviceContext_;
+
+    // setup states before rendering
+    if (pRender->shadersContainer_.debugShader_.GetDebugType() == Render::eDebugState::DBG_WIREFRAME)
+        renderStates.SetRS(pContext, RS_WIREFRAME);
+    else
+        renderStates.ResetRS(pContext);
+
+    if (IsOverdrawDebug(pRender))
+    {
+        SetOverdrawStates(pContext);
+    }
+    else
+    {
+        renderStates.ResetBS(pContext);
+        renderStates.ResetDSS(pContext);
+    }
+
+    for (int i = 0; i < terrainStreamer_.GetNumSlots(); ++i)
+    {
+        if (!terrainStreamer_.IsSlotVisible(i))
+            continue;
+
+        const TerrainTileSlot&     slot    = terrainStreamer_.GetSlot(i);
+        const TerrainGeomipmapped& terrain = slot.terrain;
+
+        if (terrain.drawStartIndices_.empty())
+            continue;
+
+        // the maps of this tile
+        if (slot.texMapID != INVALID_TEXTURE_ID)
+            instance.textures[TEX_TYPE_DIFFUSE] = g_TextureMgr.GetSRVByTexID(slot.texMapID);
+
+        if (slot.lightMapID != INVALID_TEXTURE_ID)
+            instance.textures[TEX_TYPE_LIGHTMAP] = g_TextureMgr.GetSRVByTexID(slot.lightMapID);
+
+        instance.vertexStride      = terrain.GetVertexStride();
+        instance.pVB               = terrain.GetVertexBuffer();
+        instance.pIB               = terrain.GetIndexBuffer();
+        instance.numVertices       = terrain.GetNumVertices();
+        instance.indexCount        = terrain.GetNumIndices();
+
+        instance.patchStartIndices = terrain.drawStartIndices_.data();
+        instance.patchIndexCounts  = terrain.drawIndexCounts_.data();
+        instance.patchBaseVertices = terrain.drawBaseVertices_.data();
+        instance.numPatches        = (UINT)terrain.drawStartIndices_.size();
+        SetupTerrainHeatmap(pRender, terrain, instance);
+
+        pRender->shadersContainer_.terrainShader_.RenderPatches(pContext, instance);
+
+        pFramePacket_->sysState.visibleVerticesCount += (uint32_t)terrain.GetNumIndicesPerFrame();
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   setup params of the performance heatmaps for the terrain
+//         (the terrain isn't rendered by the debug shader so it has its own ones)
+//---------------------------------------------------------
+void CGraphics::SetupTerrainHeatmap(
+    Render::CRender* pRender,
+    const TerrainGeomipmapped& terrain,
+    Render::TerrainInstance& instance)
+{
+    if (!IsHeatmapDebug(pRender))
+    {
+        instance.debugType = 0;
+        instance.patchLods = nullptr;
+        return;
+    }
+
+    // a cell of the grid is 2 triangles
+    const float gridStep = (float)terrain.patchSize_ / (float)(terrain.patchSize_ - 1);
+
+    instance.debugType   = GetDebugState(pRender);
+    instance.patchLods   = terrain.drawLods_.data();
+    instance.triAreaLod0 = 0.5f * gridStep * gridStep;
+}
+
+//---------------------------------------------------------
+// Desc:   the overdraw heatmap: each shaded fragment is added to the
+//         target by its layer color (without the depth test and writes)
+//---------------------------------------------------------
+void CGraphics::SetOverdrawStates(ID3D11DeviceContext* pContext)
+{
+    RenderStates& renderStates = d3d_.GetRenderStates();
+
+    renderStates.SetBS(pContext, RSMask(ADDING));
+    renderStates.SetDSS(pContext, RSMask(DEPTH_DISABLED), 0);
+}
+
+///////////////////////////////////////////////////////////
+
+void GatherPointLights(
+    const ECS::PointLights& lights,
+    const ECS::TransformSystem& transformSys,
+    const EntityID* ids,
+    const index* lightIdxs,                 // idxs of the lights in the light system
+    const size numLights,
+    cvector<index>& tmpTransformIdxs,
+    Render::PointLight* outLights)
+{
+    // gather props of point lights (SoA in the light system) and their positions
+    // (the Transform component) right into the output render lights
+
+    for (index i = 0; i < numLights; ++i)
+    {
+        const index         idx   = lightIdxs[i];
+        Render::PointLight& light = outLights[i];
+
+        light.ambient  = lights.ambient[idx];
+        light.diffuse  = lights.diffuse[idx];
+        light.specular = lights.specular[idx];
+        light.att      = lights.att[idx];
+        light.range    = lights.range[idx];
+    }
+
+    transformSys.GetIdxs(ids, numLights, tmpTransformIdxs);
+    transformSys.GatherPositions(tmpTransformIdxs.data(), numLights, &outLights[0].position, sizeof(Render::PointLight));
+}
+
 ///////////////////////////////////////////////////////////
 
 void CGraphics::SetupLightsForFrame(
@@ -1333,19 +5330,24 @@ void CGraphics::SetupLightsForFrame(
     // convert light source data from the ECS into Render format
     // (they are the same so we simply need to copy data)
 
+    PROFILE_SCOPE("SetupLightsForFrame");
+
     const ECS::LightSystem& lightSys         = pEnttMgr->lightSystem_;
     const ECS::RenderSystem& renderSys       = pEnttMgr->renderSystem_;
     const ECS::TransformSystem& transformSys = pEnttMgr->transformSystem_;
 
     const ECS::DirLights&  dirLights  = lightSys.GetDirLights();
-    const ECS::SpotLights& spotLights = lightSys.GetSpotLights();
-
-    const size numDirLights   = dirLights.data.size();
-    const size numSpotLights  = spotLights.data.size();
 
+    const cvector<EntityID>& visSpotLights  = renderSys.GetVisibleSpotLights();
     const cvector<EntityID>& visPointLights = renderSys.GetVisiblePointLights();
+    const size numDirLights                 = dirLights.data.size();
+    const size numSpotLights                = visSpotLights.size();
     const size numVisPointLightSources      = visPointLights.size();
 
+    // fades of the light LOD (are parallel to visible lights)
+    const cvector<float>& pointFades = lightTempData_.visPointLightFades;
+    const cvector<float>& spotFades  = lightTempData_.visSpotLightFades;
+
 
     outData.ResizeLightData((int)numDirLights, (int)numVisPointLightSources, (int)numSpotLights);
 
@@ -1354,25 +5356,30 @@ void CGraphics::SetupLightsForFrame(
 
     if (numVisPointLightSources > 0)
     {
-        lightSys.GetPointLightsData(
+        const ECS::PointLights& pointLights = lightSys.GetPointLights();
+        LightTempData&          tmp         = lightTempData_;
+
+        pointLights.sparseIdxs.GetIdxs(visPointLights, tmp.pointLightIdxs, 0);
+
+        GatherPointLights(
+            pointLights,
+            transformSys,
             visPointLights.data(),
+            tmp.pointLightIdxs.data(),
             numVisPointLightSources,
-            lightTempData_.pointLightsData,
-            lightTempData_.pointLightsPositions);
+            tmp.transformIdxs,
+            outData.pointLights);
 
-        // store light properties, range, and attenuation
+        // scale colors by fades of the light LOD
         for (index i = 0; i < numVisPointLightSources; ++i)
         {
-            outData.pointLights[i].ambient  = lightTempData_.pointLightsData[i].ambient;
-            outData.pointLights[i].diffuse  = lightTempData_.pointLightsData[i].diffuse;
-            outData.pointLights[i].specular = lightTempData_.pointLightsData[i].specular;
-            outData.pointLights[i].att      = lightTempData_.pointLightsData[i].att;
-            outData.pointLights[i].range    = lightTempData_.pointLightsData[i].range;
-        }
+            const XMVECTOR      fade  = XMVectorReplicate(pointFades[i]);
+            Render::PointLight& light = outData.pointLights[i];
 
-        // store positions
-        for (index i = 0; i < numVisPointLightSources; ++i)
-            outData.pointLights[i].position = lightTempData_.pointLightsPositions[i];
+            XMStoreFloat4(&light.ambient,  XMLoadFloat4(&light.ambient)  * fade);
+            XMStoreFloat4(&light.diffuse,  XMLoadFloat4(&light.diffuse)  * fade);
+            XMStoreFloat4(&light.specular, XMLoadFloat4(&light.specular) * fade);
+        }
     }
 
     // ----------------------------------------------------
@@ -1399,28 +5406,168 @@ void CGraphics::SetupLightsForFrame(
     // ----------------------------------------------------
     // prepare data of spot lights
 
-    lightSys.GetSpotLightsData(
-        spotLights.ids.data(),
-        numSpotLights,
-        lightTempData_.spotLightsData,
-        lightTempData_.spotLightsPositions,
-        lightTempData_.spotLightsDirections);
+    if (numSpotLights > 0)
+    {
+        lightSys.GetSpotLightsData(
+            visSpotLights.data(),
+            numSpotLights,
+            lightTempData_.spotLightsData,
+            lightTempData_.spotLightsPositions,
+            lightTempData_.spotLightsDirections);
+    }
 
     for (index i = 0; i < numSpotLights; ++i)
     {
-        outData.spotLights[i].ambient  = lightTempData_.spotLightsData[i].ambient;
-        outData.spotLights[i].diffuse  = lightTempData_.spotLightsData[i].diffuse;
-        outData.spotLights[i].specular = lightTempData_.spotLightsData[i].specular;
+        const XMVECTOR fade = XMVectorReplicate(spotFades[i]);
+
+        XMStoreFloat4(&outData.spotLights[i].ambient,  XMLoadFloat4(&lightTempData_.spotLightsData[i].ambient)  * fade);
+        XMStoreFloat4(&outData.spotLights[i].diffuse,  XMLoadFloat4(&lightTempData_.spotLightsData[i].diffuse)  * fade);
+        XMStoreFloat4(&outData.spotLights[i].specular, XMLoadFloat4(&lightTempData_.spotLightsData[i].specular) * fade);
         outData.spotLights[i].range    = lightTempData_.spotLightsData[i].range;
         outData.spotLights[i].spot     = lightTempData_.spotLightsData[i].spot;
         outData.spotLights[i].att      = lightTempData_.spotLightsData[i].att;
     }
 
-    for (int i = 0; const XMFLOAT3& pos : lightTempData_.spotLightsPositions)
-        outData.spotLights[i++].position = pos;
+    for (index i = 0; i < numSpotLights; ++i)
+    {
+        outData.spotLights[i].position  = lightTempData_.spotLightsPositions[i];
+        outData.spotLights[i].direction = lightTempData_.spotLightsDirections[i];
+    }
+
+    // ----------------------------------------------------
+    // patches of the GPU copy of all point lights
+
+    SetupResidentPointLights(pEnttMgr, outData);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::SetupResidentPointLights(
+    ECS::EntityMgr* pEnttMgr,
+    Render::PerFrameData& outData)
+{
+    // the GPU keeps all the point lights (by their idxs in the light system)
+    // so we only gather lights which are changed since the previous frame
+    // and idxs of visible lights for the clusters
+
+    ECS::LightSystem&          lightSys     = pEnttMgr->lightSystem_;
+    const ECS::PointLights&    pointLights  = lightSys.GetPointLights();
+    const cvector<EntityID>&   visIds       = pEnttMgr->renderSystem_.GetVisiblePointLights();
+    const cvector<EntityID>&   movedIds     = pEnttMgr->transformSystem_.GetChangedEntts();
+    const size                 numLights    = pointLights.ids.size();
+    LightTempData&             tmp          = lightTempData_;
+
+    tmp.pointLightPatchIdxs.clear();
+
+    // lights faded by the light LOD in this frame (visible ids are SORTED)
+    tmp.fadedPointLightIds.clear();
+
+    for (index i = 0; i < visIds.size(); ++i)
+    {
+        if (tmp.visPointLightFades[i] < 1.0f)
+            tmp.fadedPointLightIds.push_back(visIds[i]);
+    }
+
+    // lights are added/removed (so idxs are shifted): upload all of them
+    if ((residentPointLightsVersion_ != pointLights.version) || (numResidentPointLights_ != numLights))
+    {
+        tmp.pointLightPatchIdxs.resize(numLights);
+
+        for (index i = 0; i < numLights; ++i)
+            tmp.pointLightPatchIdxs[i] = i;
+
+        residentPointLightsVersion_ = pointLights.version;
+        numResidentPointLights_     = numLights;
+    }
+    else
+    {
+        tmp.pointLightPatchIdxs = pointLights.changedIdxs;
+
+        // moved lights (changed transforms)
+        for (const EntityID id : movedIds)
+        {
+            const index idx = pointLights.sparseIdxs.GetIdx(id);
+
+            if (idx != ECS::SparseSet::INVALID_IDX)
+                tmp.pointLightPatchIdxs.push_back(idx);
+        }
+
+        // faded lights get faded colors, and lights faded in the prev frame get back full ones
+        for (const cvector<EntityID>* pIds : { &tmp.fadedPointLightIds, &tmp.prevFadedPointLightIds })
+        {
+            for (const EntityID id : *pIds)
+            {
+                const index idx = pointLights.sparseIdxs.GetIdx(id);
+
+                if (idx != ECS::SparseSet::INVALID_IDX)
+                    tmp.pointLightPatchIdxs.push_back(idx);
+            }
+        }
+
+        std::sort(tmp.pointLightPatchIdxs.begin(), tmp.pointLightPatchIdxs.end());
+
+        const auto last = std::unique(tmp.pointLightPatchIdxs.begin(), tmp.pointLightPatchIdxs.end());
+        tmp.pointLightPatchIdxs.resize(last - tmp.pointLightPatchIdxs.begin());
+    }
+
+    lightSys.ClearChangedPointLights();
+
+    // gather data of changed lights
+    const size numPatches = tmp.pointLightPatchIdxs.size();
+
+    tmp.pointLightPatchIds.resize(numPatches);
+    tmp.pointLightPatchIdxsU32.resize(numPatches);
+    tmp.pointLightPatches.resize(numPatches);
+
+    for (index i = 0; i < numPatches; ++i)
+    {
+        tmp.pointLightPatchIds[i]     = pointLights.ids[tmp.pointLightPatchIdxs[i]];
+        tmp.pointLightPatchIdxsU32[i] = (uint32)tmp.pointLightPatchIdxs[i];
+    }
+
+    if (numPatches > 0)
+    {
+        // patch idxs are already idxs of lights in the light system
+        GatherPointLights(
+            pointLights,
+            pEnttMgr->transformSystem_,
+            tmp.pointLightPatchIds.data(),
+            tmp.pointLightPatchIdxs.data(),
+            numPatches,
+            tmp.transformIdxs,
+            tmp.pointLightPatches.data());
+
+        // scale colors of lights which are faded by the light LOD
+        for (index i = 0; i < numPatches; ++i)
+        {
+            const EntityID id = tmp.pointLightPatchIds[i];
+
+            if (!tmp.fadedPointLightIds.binary_search(id))
+                continue;
+
+            const index    visIdx = visIds.get_idx(id);
+            const XMVECTOR fade   = XMVectorReplicate(tmp.visPointLightFades[visIdx]);
+            Render::PointLight& light = tmp.pointLightPatches[i];
+
+            XMStoreFloat4(&light.ambient,  XMLoadFloat4(&light.ambient)  * fade);
+            XMStoreFloat4(&light.diffuse,  XMLoadFloat4(&light.diffuse)  * fade);
+            XMStoreFloat4(&light.specular, XMLoadFloat4(&light.specular) * fade);
+        }
+    }
+
+    tmp.prevFadedPointLightIds = tmp.fadedPointLightIds;
+
+    // resident idx of each visible light
+    tmp.visPointLightIdxs.resize(visIds.size());
 
-    for (int i = 0; const XMFLOAT3& dir : lightTempData_.spotLightsDirections)
-        outData.spotLights[i++].direction = dir;
+    for (index i = 0; i < visIds.size(); ++i)
+        tmp.visPointLightIdxs[i] = (uint32)pointLights.sparseIdxs.GetIdx(visIds[i]);
+
+    outData.visPointLightIdxs      = tmp.visPointLightIdxs.data();
+    outData.pointLightPatches      = tmp.pointLightPatches.data();
+    outData.pointLightPatchIdxs    = tmp.pointLightPatchIdxsU32.data();
+    outData.numPointLightPatches   = (int)numPatches;
+    outData.numResidentPointLights = (int)numLights;
 }
 
 ///////////////////////////////////////////////////////////
@@ -1438,7 +5585,6 @@ int CGraphics::TestEnttSelection(const int sx, const int sy, ECS::EntityMgr* pEn
     const XMMATRIX& P       = pEnttMgr->cameraSystem_.GetProj(currCameraID_);
     const XMMATRIX& invView = pEnttMgr->cameraSystem_.GetInverseView(currCameraID_);
 
-    // TODO: optimize it!
     const float xndc = (+2.0f * sx / d3d_.GetWindowWidth() - 1.0f);
     const float yndc = (-2.0f * sy / d3d_.GetWindowHeight() + 1.0f);
 
@@ -1446,90 +5592,116 @@ int CGraphics::TestEnttSelection(const int sx, const int sy, ECS::EntityMgr* pEn
     const float vx = xndc / P.r[0].m128_f32[0];
     const float vy = yndc / P.r[1].m128_f32[1];
 
-    // ray definition in view space
-    XMVECTOR rayOrigin_ = { 0,0,0,1 };
-    XMVECTOR rayDir_    = { vx, vy, 1, 0 };
-
-    // assume we have not picked anything yet, 
-    // so init the ID to 0 and triangle idx to -1
-    uint32_t selectedEnttID = 0;
-    int selectedTriangleIdx = -1;
-    float tmin = MathHelper::Infinity;  // the distance along the ray where the intersection occurs
-    float dist = 0;                     // the length of the ray from origin to the intersection point with the AABB
+    // transform the ray into world space
+    XMFLOAT3 rayOrigin;
+    XMFLOAT3 rayDir;
+    XMStoreFloat3(&rayOrigin, XMVector3TransformCoord(XMVectorSet(0, 0, 0, 1), invView));
+    XMStoreFloat3(&rayDir,    XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(vx, vy, 1, 0), invView)));
 
+    // walk the entity BVH and then triangle BVHs of models
+    // (skip the camera entt itself since the ray starts inside of it)
+    RayHit hit;
+    const bool     isHit          = rayCaster_.Cast(*pEnttMgr, rayOrigin, rayDir, MathHelper::Infinity, hit, currCameraID_);
+    const EntityID selectedEnttID = isHit ? hit.enttID : 0;
 
-    // go through each visible entt and check if we have an intersection with it
-    for (const EntityID enttID : pEnttMgr->renderSystem_.GetAllVisibleEntts())
+    // print a msg about selection of the entity
+    if (selectedEnttID)
     {
-        //const EntityID enttID = visEntts[i];
-        const ModelID modelID = pEnttMgr->modelSystem_.GetModelIdRelatedToEntt(enttID);
-        const BasicModel& model = g_ModelMgr.GetModelByID(modelID);
+        const char* name = pEnttMgr->nameSystem_.GetNameById(selectedEnttID);
 
-        if (model.type_ == eModelType::Terrain)
-        {
-            continue;
-        }
-    
-        // get an inverse world matrix of the current entt
-        const XMMATRIX invWorld = pEnttMgr->transformSystem_.GetInverseWorld(enttID);
-        const XMMATRIX toLocal = DirectX::XMMatrixMultiply(invView, invWorld);
+        sprintf(g_String, "picked entt (id: %ld; name: %s)", selectedEnttID, name);
+        LogMsgf("%s%s", YELLOW, g_String);
+    }
 
-        XMVECTOR rayOrigin = XMVector3TransformCoord(rayOrigin_, toLocal);   // supposed to take a point (w == 1)
-        XMVECTOR rayDir    = XMVector3TransformNormal(rayDir_, toLocal);  // supposed to take a vec (w == 0)
+    // return ID of the selected entt, or 0 if we didn't pick any
+    return selectedEnttID;
+}
 
-        // make the ray direction unit length for the intersection tests
-        rayDir = XMVector3Normalize(rayDir);
+///////////////////////////////////////////////////////////
 
+void CGraphics::TestEnttsSelectionInRect(
+    const int x0,
+    const int y0,
+    const int x1,
+    const int y1,
+    ECS::EntityMgr* pEnttMgr,
+    cvector<EntityID>& outIds)
+{
+    // box selection: project positions of all the entts with models into
+    // the screen and check if they are inside of the input rect;
+    // NOTE: the rect corners can be in any order
 
-        // if we hit the bounding box of the model, then we might have picked
-        // a model triangle, so do the ray/triangle tests;
-        //
-        // if we didn't hit the bounding box, then it is impossible that we
-        // hit the model, so do not waste efford doing ray/triangle tests
-        if (model.GetModelAABB().Intersects(rayOrigin, rayDir, dist))
-        {
-            // execute ray/triangle tests
-            for (int i = 0; i < model.GetNumIndices() / 3; ++i)
-            {
-                // indices for this triangle
-                UINT i0 = model.indices_[i * 3 + 0];
-                UINT i1 = model.indices_[i * 3 + 1];
-                UINT i2 = model.indices_[i * 3 + 2];
+    using namespace DirectX;
 
-                // vertices for this triangle
-                XMVECTOR v0 = XMLoadFloat3(&model.vertices_[i0].position);
-                XMVECTOR v1 = XMLoadFloat3(&model.vertices_[i1].position);
-                XMVECTOR v2 = XMLoadFloat3(&model.vertices_[i2].position);
+    outIds.clear();
 
-                // we have to iterate over all the triangle in order 
-                // to find the nearest intersection
-                float t = 0.0f;
+    const EntityID* ids = nullptr;
+    size numEntts = 0;
+    pEnttMgr->modelSystem_.GetAllEntts(ids, numEntts);
 
-                if (DirectX::TriangleTests::Intersects(rayOrigin, rayDir, v0, v1, v2, t))
-                {
-                    if (t <= tmin)
-                    {
-                        // this is the new nearest picked entt and its triangle
-                        tmin = t;
-                        selectedTriangleIdx = i;
-                        selectedEnttID = enttID;
-                    }
-                }
-            }
-        }
-    }
+    if (numEntts == 0)
+        return;
 
-    // print a msg about selection of the entity
-    if (selectedEnttID)
+    // the rect in NDC
+    const float w     = (float)d3d_.GetWindowWidth();
+    const float h     = (float)d3d_.GetWindowHeight();
+    const float minX  = +2.0f * std::min(x0, x1) / w - 1.0f;
+    const float maxX  = +2.0f * std::max(x0, x1) / w - 1.0f;
+    const float minY  = -2.0f * std::max(y0, y1) / h + 1.0f;
+    const float maxY  = -2.0f * std::min(y0, y1) / h + 1.0f;
+
+    const XMMATRIX& viewProj = pEnttMgr->cameraSystem_.GetViewProj(currCameraID_);
+
+    cvector<XMFLOAT3> positions;
+    pEnttMgr->transformSystem_.GetPositions(ids, numEntts, positions);
+
+    for (index i = 0; i < numEntts; ++i)
     {
-        const std::string& name = pEnttMgr->nameSystem_.GetNameById(selectedEnttID);
+        const XMVECTOR clip = XMVector4Transform(XMVectorSet(positions[i].x, positions[i].y, positions[i].z, 1), viewProj);
+        const float    cw   = XMVectorGetW(clip);
 
-        sprintf(g_String, "picked entt (id: %ld; name: %s)", selectedEnttID, name.c_str());
-        LogMsgf("%s%s", YELLOW, g_String);
+        // behind the camera
+        if (cw <= 0.0f)
+            continue;
+
+        const float ndcX = XMVectorGetX(clip) / cw;
+        const float ndcY = XMVectorGetY(clip) / cw;
+
+        if ((ndcX >= minX) && (ndcX <= maxX) && (ndcY >= minY) && (ndcY <= maxY))
+            outIds.push_back(ids[i]);
     }
 
-    // return ID of the selected entt, or 0 if we didn't pick any
-    return selectedEnttID;
+    sprintf(g_String, "box selection: %d entts", (int)outIds.size());
+    LogMsgf("%s%s", YELLOW, g_String);
+}
+
+///////////////////////////////////////////////////////////
+
+void CGraphics::RequestGpuPick(const int sx, const int sy)
+{
+    // the pixel is out of the screen
+    if (sx < 0 || sy < 0 || sx >= d3d_.GetWindowWidth() || sy >= d3d_.GetWindowHeight())
+        return;
+
+    // a newer request replaces the one which isn't rendered yet
+    pickX_           = sx;
+    pickY_           = sy;
+    isPickRequested_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool CGraphics::GetGpuPickResult(Render::CRender* pRender, EntityID& outEnttID)
+{
+    // out:  true if the result of a pick is ready (outEnttID == 0 if there was no entt)
+
+    if (!pRender->GetEntityIdBuffer().ReadBack(pDeviceContext_, outEnttID))
+        return false;
+
+    if (outEnttID)
+        LogMsgf("%spicked entt on GPU (id: %ld)", YELLOW, outEnttID);
+
+    return true;
 }
 
 ///////////////////////////////////////////////////////////
@@ -16,11 +16,24 @@
 #include "../Input/MouseEvent.h"
 
 #include "RenderDataPreparator.h"
+#include "RayCaster.h"
 
 // render stuff
 #include "CRender.h"
 #include "InitializeGraphics.h"        // for initialization of the graphics
 #include "FrameBuffer.h"      // for rendering to some particular texture
+#include "ThumbnailCache.h"
+#include "DynamicResolution.h"
+#include "RenderGraph.h"
+#include "DebugDraw.h"
+#include "FramePacket.h"
+#include "StaticMeshMerger.h"
+#include "LightBaker.h"
+#include "SoftwareOcclusion.h"
+
+// terrain stuff
+#include "../Terrain/TerrainTileStreamer.h"
+#include "../Terrain/TerrainVirtualTexture.h"
 
 // Entity-Component-System
 #include "Entity/EntityMgr.h"
@@ -35,11 +48,52 @@ namespace Core
 struct LightTempData
 {
     cvector<DirectX::XMVECTOR>  dirLightsDirections;
-    cvector<ECS::PointLight>    pointLightsData;
-    cvector<DirectX::XMFLOAT3>  pointLightsPositions;
+    cvector<index>              pointLightIdxs;          // idxs of point lights in the light system
+    cvector<index>              transformIdxs;           // idxs of lights in the Transform component
     cvector<ECS::SpotLight>     spotLightsData;
     cvector<DirectX::XMFLOAT3>  spotLightsPositions;
     cvector<DirectX::XMFLOAT3>  spotLightsDirections;
+
+    // resident point lights: patches of the GPU copy, and idxs of visible lights in it
+    cvector<index>              pointLightPatchIdxs;
+    cvector<uint32>             pointLightPatchIdxsU32;
+    cvector<EntityID>           pointLightPatchIds;
+    cvector<Render::PointLight> pointLightPatches;
+    cvector<uint32>             visPointLightIdxs;
+
+    // light LOD: a fade of each visible light (1 - full intensity), and point lights
+    // which were faded in the prev frame (their resident copy must be restored)
+    cvector<float>              visPointLightFades;
+    cvector<float>              visSpotLightFades;
+    cvector<EntityID>           fadedPointLightIds;
+    cvector<EntityID>           prevFadedPointLightIds;
+};
+
+// passes of the 3D scene (types of passes in the render graph)
+enum eScenePass
+{
+    SCENE_PASS_SHADOWS,
+    SCENE_PASS_REFLECTION,           // casters are rendered into the offscreen planar reflection
+    SCENE_PASS_GPU_DRIVEN,
+    SCENE_PASS_DEPTH_PREPASS,
+    SCENE_PASS_OPAQUE,
+    SCENE_PASS_DEFERRED,             // the opaque pass by the deferred shading
+    SCENE_PASS_ENTITY_IDS,
+    SCENE_PASS_TERRAIN,
+    SCENE_PASS_GRASS,
+    SCENE_PASS_SKINNED,
+    SCENE_PASS_SKY_DOME,
+    SCENE_PASS_IMPOSTORS,
+    SCENE_PASS_REFLECTION_COMPOSITE, // the mirror is marked by stencil and the reflection is blended over it
+    SCENE_PASS_BLENDED,
+    SCENE_PASS_PARTICLES,
+    SCENE_PASS_LOW_RES_DEPTH,        // the scene depth is downsampled for the low resolution blending
+    SCENE_PASS_LOW_RES_BLENDED,
+    SCENE_PASS_LOW_RES_PARTICLES,
+    SCENE_PASS_LOW_RES_COMPOSITE,    // the low resolution color is upsampled over the scene
+    SCENE_PASS_EDITOR_GRID,
+    SCENE_PASS_DEBUG_LINES,
+    SCENE_PASS_HI_Z,
 };
 
 // --------------------------------------------------------
@@ -87,8 +141,18 @@ public:
     void ComputeFrustumCullingOld           (SystemState& sysState, ECS::EntityMgr* pEnttMgr);
 
     void ComputeFrustumCullingOfLightSources(SystemState& sysState, ECS::EntityMgr* pEnttMgr);
+    void ComputeOcclusionCulling            (SystemState& sysState, ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    void ComputeSoftwareOcclusionCulling    (SystemState& sysState, ECS::EntityMgr* pEnttMgr);
+    void ComputeHorizonCulling              (SystemState& sysState, ECS::EntityMgr* pEnttMgr, const Render::CRender* pRender);
+    void ComputePortalCulling               (SystemState& sysState, ECS::EntityMgr* pEnttMgr);
+    void ComputeLodsOfVisibleEntts          (const SystemState& sysState, ECS::EntityMgr* pEnttMgr);
     void ClearRenderingDataBeforeFrame      (ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
-    void Render3D                           (ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+
+    // fill the packet by the state which the render passes need (is called
+    // by the main thread after Update()); Render3D() doesn't touch the ECS
+    // so it can be executed by the render thread
+    void ExtractFramePacket                 (ECS::EntityMgr* pEnttMgr, FramePacket& outPacket);
+    void Render3D                           (FramePacket& packet, Render::CRender* pRender);
     void RenderModel                        (BasicModel& model, const DirectX::XMMATRIX& world);
 
     bool RenderBigMaterialIcon(
@@ -99,13 +163,33 @@ public:
         Render::CRender* pRender,
         ID3D11ShaderResourceView** outMaterialImg);
 
-    void RenderMaterialsIcons(
-        ECS::EntityMgr* pEnttMgr,
-        Render::CRender* pRender,
-        ID3D11ShaderResourceView** outArrShaderResourceViews,
-        const size numIcons,
-        const int iconWidth,
-        const int iconHeight);
+    // make thumbnails which were requested by the editor's browsers (once per frame);
+    // NOTE: the immediate context must be free (the render thread is synced)
+    void UpdateThumbnails(Render::CRender* pRender);
+
+    // render an impostor atlas of the model (its last LOD for far distances)
+    bool BakeImpostor(const ModelID modelID, Render::CRender* pRender);
+
+    // merge small static props into meshes per grid cell (see StaticMeshMerger);
+    // return the number of created cells
+    int  MergeStaticProps  (ECS::EntityMgr* pEnttMgr);
+    void UnmergeStaticProps(ECS::EntityMgr* pEnttMgr);
+
+    // bake static point/spot lights into the light volume (see LightBaker) / load
+    // the existing bake if it isn't stale; baked lights are skipped by the light culling
+    bool BakeStaticLights(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    bool LoadStaticLights(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+
+    // dynamic resolution / FXAA: the 3D scene is rendered into a transient texture (with
+    // the scale chosen by the GPU frame time) which is stretched (and anti-aliased) to
+    // the back buffer before UI; does nothing if each of these is disabled
+    void UpscaleScene(Render::CRender* pRender);
+
+    // idle frames of the editor: the last image of the scene (without UI) is kept
+    // so if nothing is changed it is presented instead of rendering the scene anew
+    void CacheSceneImage();
+    bool HasCachedScene() const;
+    void PresentCachedScene();
 
 
     // ----------------------------------
@@ -113,14 +197,30 @@ public:
     inline void SetGameMode(bool enableGameMode)                    { isGameMode_ = enableGameMode; }
     inline void SetAABBShowMode(const AABBShowMode mode)            { aabbShowMode_ = mode; }
     inline void SetFullFogDist(const int dist)                      { if (dist > 0) fullFogDistance_ = dist; }  // after this distance we use only billboards (I hope for it)
+    inline void SetDeferredShading(const bool enable)               { isDeferredShading_ = enable; }            // per scene: deferred (many lights) or clustered forward shading
+    inline void SetEditorGrid(const bool show)                      { isEditorGrid_ = show; }                   // the grid over the ground plane (only out of the game mode)
+    inline bool IsDeferredShadingEnabled()                    const { return isDeferredShading_; }
+
+    // the entt whose plane reflects the scene (its local Y axis is the normal of the reflective side);
+    // only entts which are marked by RenderSystem::SetReflectionCaster() are reflected
+    inline void     SetReflectionMirror(const EntityID id)          { if (id != reflectMirrorID_) { reflectMirrorID_ = id; isReflectionDirty_ = true; } }
+    inline EntityID GetReflectionMirror()                     const { return reflectMirrorID_; }
 
     inline void     SetCurrentCamera(const EntityID cameraID)       { currCameraID_ = cameraID; }
+    inline void     InvalidateVisibilityCache()                     { isVisCacheValid_ = false; isGpuSceneValid_ = false; isStaticBatchesValid_ = false; isSceneImageValid_ = false; }  // call it after changes which aren't tracked by the cache (materials, textures, etc.)
     inline EntityID GetCurrentCamera()                        const { return currCameraID_; }
 
     // ---------------------------------------
     // INLINE GETTERS/SETTERS
 
     inline D3DClass&       GetD3DClass()                      { return d3d_; }
+    inline ThumbnailCache& GetThumbnails()                    { return thumbnails_; }
+    inline float           GetRenderScale()             const { return (isDynamicResolution_) ? dynamicRes_.GetScale() : 1.0f; }
+    inline bool            IsSceneTarget()              const { return isDynamicResolution_ || isFxaa_; }
+
+    // the tessellated terrain is used only if its shaders are initialized
+    inline bool IsTerrainTessellated(const Render::CRender* pRender) const
+    {   return isTerrainTessellation_ && pRender->shadersContainer_.terrainShader_.IsTessellation();   }
 
     // ---------------------------------------
 
@@ -133,6 +233,25 @@ public:
     // check if we have any entity by these coords of the screen
     int TestEnttSelection(const int sx, const int sy, ECS::EntityMgr* pEnttMgr);
 
+    // get SORTED IDs of entts (with models) which origins are projected into the screen rect
+    void TestEnttsSelectionInRect(
+        const int x0,
+        const int y0,
+        const int x1,
+        const int y1,
+        ECS::EntityMgr* pEnttMgr,
+        cvector<EntityID>& outIds);
+
+    // scene ray queries (for line of sight, hitscan, etc.)
+    inline RayCaster& GetRayCaster() { return rayCaster_; }
+
+    // GPU picking: the entity IDs pass runs in the next rendered frame and
+    // its result is available (as a rule) one frame later
+    inline bool IsGpuPicking()       const { return isGpuPicking_; }
+    inline bool IsGpuPickRequested() const { return isPickRequested_; }
+    void RequestGpuPick  (const int sx, const int sy);
+    bool GetGpuPickResult(Render::CRender* pRender, EntityID& outEnttID);
+
 private:
 
     bool InitHelper(
@@ -146,6 +265,9 @@ private:
         const Settings& settings,
         Render::CRender* pRender);
 
+    // knobs which are changed at runtime (see CVarRegistry)
+    void RegisterCVars();
+
     void UpdateHelper(
         SystemState& sysState,
         const float deltaTime,
@@ -153,9 +275,68 @@ private:
         ECS::EntityMgr* pEnttMgr,
         Render::CRender* pRender);
 
-    void RenderHelper(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    void RenderHelper(Render::CRender* pRender);
+
+    void SetupRenderGraph(Render::CRender* pRender);
+    int  AddScenePass    (const char* name, const eScenePass type);
+    void AddLowResPasses (const bool isEntts, const bool isParticles);
+    void ExecuteScenePass(Render::CRender* pRender, const int type);
   
     void UpdateShadersDataPerFrame(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    bool UpdateVisibilityCache    (const SystemState& sysState, ECS::EntityMgr* pEnttMgr);
+    void UpdateMaterialsTable     (Render::CRender* pRender);
+    void PackMaterialsTextures    (Render::CRender* pRender);
+    void UpdateGpuScene           (ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    void SetupGpuCullParams       (const SystemState& sysState, ECS::EntityMgr* pEnttMgr);
+    void UpdateStaticBatches      (ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    void UpdateGrass              (const SystemState& sysState, const float totalGameTime, ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    void UpdateTerrainVT          (Render::CRender* pRender);
+    void UpdateParticles          (const SystemState& sysState, const float deltaTime, ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    void UpdateSkinnedCrowds      (ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    void UpdateShadows            (ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    void UpdatePlanarReflection   (const SystemState& sysState, ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    void PrepStaticInstancesForRender(ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+
+    // is the opaque pass culled on GPU and rendered by indirect draws?
+    inline bool IsGpuDriven(Render::CRender* pRender) { return isGpuDrivenRendering_ && pRender->GetGpuCulling().IsInitialized(); }
+
+    // are instances of static entts kept on GPU? (the GPU-driven pass has all the entts there)
+    inline bool IsStaticBatches(Render::CRender* pRender) { return isStaticBatches_ && !IsGpuDriven(pRender) && pRender->GetStaticBatches().IsInitialized(); }
+
+    // do we fill depth before the opaque and alpha clipped passes? (debug shaders
+    // don't guarantee the same depth so they go without it)
+    inline bool IsDepthPrepass(Render::CRender* pRender) { return isDepthPrepass_ && !pRender->isDebugMode_ && pRender->GetDepthPrepass().IsInitialized(); }
+
+    // the state of the debug shader (if it is used)
+    inline int GetDebugState(Render::CRender* pRender) const
+    {   return (pRender->isDebugMode_) ? pRender->shadersContainer_.debugShader_.GetDebugType() : Render::DBG_TURN_OFF;   }
+
+    // the overdraw heatmap adds each shaded fragment without the depth test
+    inline bool IsOverdrawDebug(Render::CRender* pRender) const { return GetDebugState(pRender) == Render::DBG_SHOW_OVERDRAW; }
+
+    // performance heatmaps are rendered by the debug shader and by the terrain shader
+    inline bool IsHeatmapDebug(Render::CRender* pRender) const { return GetDebugState(pRender) >= Render::DBG_SHOW_OVERDRAW; }
+
+    // are shadows of the sun cast? (casters are rendered by the depth pre-pass shaders)
+    // the deferred shading replaces the forward opaque pass (at runtime it is switched per scene);
+    // a multisampled depth is always shaded forward
+    inline bool IsDeferredShading(Render::CRender* pRender)
+    {   return isDeferredShading_ && !pRender->isDebugMode_ && !IsGpuDriven(pRender) && pRender->GetDeferredShading().IsInitialized() && (IsSceneTarget() || (d3d_.GetDepthNumSamples() == 1));   }
+
+    // is blended content rendered offscreen with a lower resolution? (a multisampled depth can't be downsampled)
+    inline bool IsLowResBlending(Render::CRender* pRender)
+    {   return (lowResBlendFactor_ > 1) && !pRender->isDebugMode_ && pRender->GetLowResBlending().IsInitialized() && (IsSceneTarget() || (d3d_.GetDepthNumSamples() == 1));   }
+
+    // is the blended instance rendered by the low resolution pass? (all its materials
+    // must want it and the blend state must be representable by the premultiplied target)
+    bool IsLowResInstance(const Render::Instance& instance, const RenderStatesMask blendState);
+    bool HasLowResInstances(Render::CRender* pRender);
+
+    inline bool IsShadows(Render::CRender* pRender) { return pRender->GetShadowMaps().IsInitialized() && pRender->GetDepthPrepass().IsInitialized(); }
+
+    // is there a mirror which reflects the scene? (the mirror is marked by the depth pre-pass shaders)
+    inline bool IsPlanarReflection(Render::CRender* pRender)
+    {   return isPlanarReflection_ && (reflectMirrorID_ != INVALID_ENTITY_ID) && !pRender->isDebugMode_ && pRender->GetPlanarReflection().IsInitialized() && pRender->GetDepthPrepass().IsInitialized();   }
 
     // ------------------------------------------
     // rendering data prepararion stage API
@@ -163,22 +344,45 @@ private:
     void PrepBasicInstancesForRender        (ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
     void PrepAlphaClippedInstancesForRender (ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
     void PrepBlendedInstancesForRender      (ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    void SeparateImpostorEntts              (ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
+    void PrepImpostorsForRender             (ECS::EntityMgr* pEnttMgr, Render::CRender* pRender);
 
     // ------------------------------------------
 
+    void RenderShadows               (Render::CRender* pRender);
+    void RenderPlanarReflection      (Render::CRender* pRender);
+    void CompositePlanarReflection   (Render::CRender* pRender);
+    void RenderDepthPrepass          (Render::CRender* pRender);
     void RenderEnttsDefault          (Render::CRender* pRender);
     void RenderEnttsAlphaClipCullNone(Render::CRender* pRender);
-    void RenderEnttsBlended          (Render::CRender* pRender);
+    void RenderDeferredShading       (Render::CRender* pRender);
+    void RenderEnttsDeferred         (Render::CRender* pRender);
+    void RenderEnttsGpuDriven        (Render::CRender* pRender);
+    void RenderEnttsBlended          (Render::CRender* pRender, const bool isLowRes);
     void RenderFoggedBillboards      (Render::CRender* pRender, ECS::EntityMgr* pEnttMgr);
     void RenderMaterialSphere        (const int matIdx, Render::CRender* pRender);
+    void RenderEntityIds             (Render::CRender* pRender);
+    void RenderImpostors             (Render::CRender* pRender);
+    void RenderGrass                 (Render::CRender* pRender);
+    void RenderSkinned               (Render::CRender* pRender);
+    void RenderParticles             (Render::CRender* pRender, const bool isLowRes);
 
     // ------------------------------------------
 
-    // render bounding boxes of models/meshes/light_sources/etc.
-    void RenderBoundingLineBoxes(Render::CRender* pRender, ECS::EntityMgr* pEnttMgr);
-    void RenderBoundingLineSpheres();
-    void RenderSkyDome(Render::CRender* pRender, ECS::EntityMgr* pEnttMgr);
-    void RenderTerrain(Render::CRender* pRender, ECS::EntityMgr* pEnttMgr);
+    // add bounding boxes of models/meshes and spheres of light sources into the debug
+    // drawing (at extraction); the debug lines of the frame are rendered by RenderDebugLines()
+    void AddBoundingLineBoxes  (ECS::EntityMgr* pEnttMgr);
+    void AddBoundingLineSpheres(ECS::EntityMgr* pEnttMgr);
+    void RenderDebugLines      (Render::CRender* pRender);
+    void RenderEditorGrid      (Render::CRender* pRender);
+    void RenderSkyDome(Render::CRender* pRender);
+    void RenderTerrain(Render::CRender* pRender);
+    void RenderTerrainGeomipmapped(Render::CRender* pRender);
+    void RenderTerrainTessellated(Render::CRender* pRender);
+    void RenderTerrainTiles(Render::CRender* pRender);
+    void SetupTerrainHeatmap(Render::CRender* pRender, const TerrainGeomipmapped& terrain, Render::TerrainInstance& instance);
+    void SetOverdrawStates(ID3D11DeviceContext* pContext);
+    void ExtractTerrainTessParams(ECS::EntityMgr* pEnttMgr, Render::ConstBufType::cbTerrainTess& outParams);
 
 #if 0
     void UpdateInstanceBuffAndRenderInstances(
@@ -191,6 +395,7 @@ private:
     // ------------------------------------------
 
     void SetupLightsForFrame(ECS::EntityMgr* pEnttMgr, Render::PerFrameData& perFrameData);
+    void SetupResidentPointLights(ECS::EntityMgr* pEnttMgr, Render::PerFrameData& perFrameData);
 
 public:
     DirectX::XMMATRIX WVO_            = DirectX::XMMatrixIdentity();  // main_world * baseView * ortho
@@ -207,23 +412,224 @@ public:
     ID3D11Device*         pDevice_ = nullptr;
     ID3D11DeviceContext*  pDeviceContext_ = nullptr;
     SystemState*          pSysState_ = nullptr;                       // we got this ptr during init
-
-    std::vector<DirectX::BoundingFrustum> frustums_;
+    FramePacket*          pFramePacket_ = nullptr;                    // the packet which is being rendered (by Render3D)
 
     D3DClass              d3d_;
     RenderDataPreparator  prep_;
+    RayCaster             rayCaster_;
     FrameBuffer           frameBuffer_;                           // for rendering to some texture
+    DynamicResolution     dynamicRes_;
+
+    // passes of the 3D scene and their targets (are re-declared each frame)
+    RenderGraph           renderGraph_;
+    RGResource            sceneColorRes_ = RG_INVALID_RESOURCE;
+    RGResource            sceneDepthRes_ = RG_INVALID_RESOURCE;
+    UINT                  sceneWidth_    = 0;                     // the rendered part of the scene targets
+    UINT                  sceneHeight_   = 0;
+    RGResource            lowResColorRes_ = RG_INVALID_RESOURCE;  // targets of the low resolution blending
+    RGResource            lowResDepthRes_ = RG_INVALID_RESOURCE;
     EntityID currCameraID_ = 0;
+
+    // cached query of renderable entts (is used for frustum culling)
+    ECS::Query<ECS::Rendered, ECS::Bounding>* pRenderableQuery_ = nullptr;
+    cvector<EntityID> cullInsideEntts_;                             // entts of BVH subtrees which are fully inside the frustum
+    cvector<EntityID> cullIntersectedEntts_;                        // entts whose BVH leaves intersect the frustum borders
+    static constexpr index CULL_JOB_GRAIN = 4096;                   // min number of spheres per culling job
+    static constexpr index OCCLUSION_JOB_GRAIN = 1024;              // min number of AABBs per occlusion culling job
+
+    // software occlusion: frustum visible entts whose bounding sphere covers more
+    // than this fraction of the screen height are candidates for occluders
+    static constexpr float OCCLUDER_MIN_SCREEN_SIZE = 0.1f;
+    SoftwareOcclusion softOcclusion_;
+    cvector<index>    softOccluderIdxs_;                            // transform idxs of occluders of the frame
+
+    // an entt gets LOD i+1 when its bounding sphere covers less than LOD_SCREEN_SIZES[i]
+    // of the screen height (then the LOD is clamped by the number of LODs of its model)
+    static constexpr float LOD_SCREEN_SIZES[MAX_NUM_MESH_LODS - 1] = { 0.25f, 0.08f, 0.03f };
+
+    // entts whose bounding sphere radius is projected into less pixels are culled
+    // (the threshold is scaled per entt, see ECS::RenderSystem::SetSmallCullFactor)
+    float smallCullPixels_ = 1.0f;
+
+    // light LOD: a light is dropped when its contribution (the range sphere radius in
+    // pixels scaled by the max diffuse channel) is less than this value, and it is
+    // faded in up to the doubled value (0 - disabled)
+    float lightLodPixels_ = 4.0f;
+
+    // entts which are farther get the impostor LOD (if their models have a baked impostor; 0 - disabled)
+    float impostorDist_ = 200.0f;
+
+    // ranges of the instances ring which are written in the current frame (are reused
+    // by the main passes and the entity IDs pass while the ring generation is the same)
+    UINT modelInstBase_        = 0;
+    UINT alphaClippedInstBase_ = 0;
+    UINT instRingGen_          = 0;
+    UINT alphaClippedRingGen_  = 0;
+
+    // states of the default and alpha clipped passes for recording on deferred contexts
+    Render::PipelineState defaultPassState_;
+    Render::PipelineState alphaClippedPassState_;
+
+    // GPU picking (see RequestGpuPick)
+    bool isGpuPicking_     = false;
+    bool isPickRequested_  = false;
+    int  pickX_            = 0;
+    int  pickY_            = 0;
+
+    // the last image of the scene for idle frames of the editor (see CacheSceneImage)
+    ID3D11Texture2D* pSceneImage_       = nullptr;
+    bool             isSceneImageValid_ = false;
+
+    // temporal visibility cache: if the camera and the scene are still the same
+    // (up to thresholds) we reuse the visible set and instances of the prev frame
+    static constexpr float VIS_CACHE_POS_THRESHOLD   = 0.01f;       // max camera movement (in world units)
+    static constexpr float VIS_CACHE_ROT_THRESHOLD   = 0.0005f;     // max difference of view matrix rotation elements
+    static constexpr int   VIS_CACHE_WARMUP_FRAMES   = 4;           // the pose must be still so long (the Hi-Z buffer has a latency)
+    static constexpr int   VIS_CACHE_MAX_AGE         = 120;         // the cache is rebuilt in any case after so many frames
+    DirectX::XMMATRIX      visCacheView_             = DirectX::XMMatrixIdentity();
+    DirectX::XMMATRIX      visCacheProj_             = DirectX::XMMatrixIdentity();
+    EntityID               visCacheCameraID_         = 0;
+    uint32                 visCacheSceneVersion_     = 0;           // the entity mgr's structure version
+    uint32                 visCachePortalsVersion_   = 0;           // the portal system's version (cells, portals, opened doors)
+    int                    visCacheStillFrames_      = 0;           // how many frames the pose and the scene are still
+    int                    visCacheAge_              = 0;           // how many frames the cache is reused
+    bool                   isVisCacheValid_          = false;
     
     // for rendering
     ECS::RenderStatesSystem::EnttsRenderStatesData rsDataToRender_;
 
+    // impostors sorted by models: each model is rendered by a range of the instanced buffer
+    struct ImpostorBatch
+    {
+        TexID                                  texID = INVALID_TEXTURE_ID;
+        Render::ConstBufType::cbgsImpostorAtlas atlas;
+        int                                    start = 0;
+        int                                    count = 0;
+    };
+
+    cvector<Render::ConstBufType::InstancedDataImpostor> impostorsData_;
+    cvector<ImpostorBatch>                               impostorBatches_;
+
+    // terrain patches to scatter grass over in this frame
+    cvector<Render::GrassPatch>            grassPatches_;
+
+    // animated entts by instances of skinned models (an animation set per model is uploaded lazily)
+    cvector<Render::SkinnedInstance>       skinnedInstances_;
+    cvector<Render::SkinnedBatch>          skinnedBatches_;
+    std::map<ModelID, int>                 skinnedAnimSets_;
+
+    // shadow casters of a cascade: static ones are prepared only when the cache of
+    // the cascade is re-rendered, dynamic ones are prepared each frame
+    struct ShadowCasters
+    {
+        Render::InstBuffData      opaqueBuffer;
+        Render::InstBuffData      alphaClipBuffer;
+        cvector<Render::Instance> opaque;
+        cvector<Render::Instance> alphaClipped;
+
+        inline void Clear() { opaque.clear(); alphaClipped.clear(); }
+    };
+
+    void RenderShadowCasters(Render::CRender* pRender, const ShadowCasters& casters);
+
+    ShadowCasters                          staticShadowCasters_ [Render::ShadowMaps::MAX_CASCADES];
+    ShadowCasters                          dynamicShadowCasters_[Render::ShadowMaps::MAX_CASCADES];
+    ECS::RenderStatesSystem::EnttsRenderStatesData shadowRsData_;
+    cvector<EntityID>                      shadowStaticEntts_;               // SORTED: is refreshed when the static set is changed
+    cvector<EntityID>                      shadowCasterIds_;
+    cvector<EntityID>                      shadowIntersectedIds_;
+    cvector<EntityID>                      shadowPrepIds_;
+    uint32                                 shadowSceneVersion_ = UINT32_MAX; // the entity mgr's structure version
+    uint32                                 shadowFlagsVersion_ = UINT32_MAX; // the render system's static version
+    bool                                   isShadowsPass_      = false;      // shadows are cast in this frame
+
+    // the planar reflection: casters are culled by the reflected frustum and prepared only
+    // in frames when the reflection is re-rendered, the mirror itself is prepared each frame
+    // (its pixels are marked in the stencil before the composite)
+    ShadowCasters                          reflectCasters_;
+    ShadowCasters                          reflectMirror_;                   // only opaque
+    ECS::RenderStatesSystem::EnttsRenderStatesData reflectRsData_;
+    Render::PlanarReflectionParams         reflectParams_;
+    cvector<EntityID>                      reflectCasterEntts_;              // SORTED: is refreshed when flags of casters are changed
+    cvector<EntityID>                      reflectCasterIds_;
+    cvector<EntityID>                      reflectIntersectedIds_;
+    cvector<uint8>                         reflectLods_;
+    cvector<uint8>                         reflectSavedLods_;
+    uint32                                 reflectSceneVersion_ = UINT32_MAX; // the entity mgr's structure version
+    uint32                                 reflectFlagsVersion_ = UINT32_MAX; // the render system's reflection version
+    EntityID                               reflectMirrorID_     = INVALID_ENTITY_ID;
+    bool                                   isPlanarReflection_  = false;     // is the planar reflection enabled at all?
+    bool                                   isReflectionDirty_   = false;     // the mirror was changed: the last image is outdated
+    bool                                   isReflectionPass_    = false;     // casters are rendered into the reflection in this frame
+    bool                                   isReflectionVisible_ = false;     // the mirror is visible in this frame (so it is composited)
+
+    // emitters of particles of the frame (particles themselves are only on GPU)
+    ECS::ParticleEmissions                 particleEmissions_;
+    cvector<Render::GpuParticleEmitter>    gpuEmitters_;
+    TexID                                  particleTexIDs_[Render::GpuParticles::MAX_TEXTURES]{ INVALID_TEXTURE_ID };
+    UINT                                   numParticleTextures_ = 0;
+
     LightTempData lightTempData_;
 
+    // buffers for preparation of the bounding boxes (debug lines)
+    cvector<size>                           debugNumBoxesPerEntt_;
+    cvector<DirectX::BoundingOrientedBox>   debugOBBs_;
+    cvector<DirectX::XMMATRIX>              debugWorlds_;
+    cvector<Render::VertexDebugLine>        debugLines_;
+
+    // transient per-frame data (culling, rendering data preparation, etc.)
+    static constexpr size_t FRAME_ARENA_INIT_CAPACITY = 1 << 20;
+    FrameArena frameArena_;
+
     FrameBuffer                         materialBigIconFrameBuf_;
-    cvector<FrameBuffer>                materialsFrameBuffers_;   // frame buffers which are used to render materials icons (for editor's material browser)
+    ThumbnailCache                      thumbnails_;              // thumbnails of textures and materials (for editor's browsers)
     cvector<ID3D11ShaderResourceView*>  texturesBuf_;             // to avoid reallocation each time we use this shared buffer
 
+    // the GPU table of materials is re-uploaded only when the materials mgr's version is changed
+    cvector<Render::Material>           materialsTable_;
+    cvector<Render::MaterialTexLayers>  materialTexLayers_;
+    uint32                              materialsTableVersion_ = UINT32_MAX;
+
+    // instances are rebuilt when streamed textures replace their SRVs
+    uint32                              texSRVsVersion_        = 0;
+
+    // diffuse/normal maps of materials packed into texture arrays (are repacked when materials are added)
+    TexID                               packedDiffuseArrID_    = INVALID_TEXTURE_ID;
+    TexID                               packedNormalArrID_     = INVALID_TEXTURE_ID;
+    size                                numPackedMaterials_    = 0;
+
+    // GPU-driven opaque pass: all the entts with default render states are uploaded
+    // into the GPU culling and are re-uploaded only when the scene is changed
+    ECS::RenderStatesSystem::EnttsRenderStatesData gpuSceneRsData_;
+    Render::InstBuffData                gpuSceneInstBuffer_;
+    cvector<Render::Instance>           gpuSceneInstances_;
+    cvector<Render::GpuInstanceBounds>  gpuSceneBounds_;
+    cvector<Render::GpuDraw>            gpuSceneDraws_;
+    cvector<Render::GpuCluster>         gpuSceneClusters_;
+    Render::GpuCullParams               gpuCullParams_;
+    uint32                              gpuSceneVersion_       = 0;     // the entity mgr's structure version
+    bool                                isGpuSceneValid_       = false;
+
+    // static batches: instance records of static entts with default render states
+    // are uploaded once; each frame only the list of visible ones is sent
+    StaticBatchesData                   staticBatchesData_;
+    Render::InstBuffData                staticInstBuffer_;
+    uint32                              staticSceneVersion_    = 0;     // the entity mgr's structure version
+    uint32                              staticFlagsVersion_    = 0;     // the render system's static version
+    bool                                isStaticBatchesValid_  = false;
+
+    // small static props which are merged into meshes per grid cell
+    StaticMeshMerger                    staticMerger_;
+    StaticMergeParams                   staticMergeParams_;
+
+    // the volume of baked static lights
+    LightBaker                          lightBaker_;
+    LightBakeParams                     lightBakeParams_;
+
+    // the GPU copy of all point lights is fully re-uploaded only when lights are added/removed
+    uint32                              residentPointLightsVersion_ = UINT32_MAX;
+    size                                numResidentPointLights_     = 0;
+
     // temp for geometry buffer testing
     void BuildGeometryBuffers();
     ID3D11Buffer* pGeomVB_ = nullptr;
@@ -235,6 +641,40 @@ public:
     bool isBeginCheck_ = false;                // a variable which is used to determine if the user has clicked on the screen or not
     bool isIntersect_ = false;                 // a flag to define if we clicked on some model or not
     bool isGameMode_ = false;
+    bool isEditorGrid_ = true;                 // do we render the grid over the ground plane out of the game mode?
+    bool isOcclusionCulling_ = true;           // do we cull entts hidden behind others (by the Hi-Z buffer)?
+    bool isSoftOcclusionCulling_ = false;      // do we cull entts hidden behind others (by the CPU rasterized occluders)?
+    bool isVisibilityCache_ = true;            // do we reuse visibility of the prev frame if nothing is changed?
+    bool isPackMaterialTextures_ = false;      // do we sample materials textures from packed texture arrays?
+    bool isGpuDrivenRendering_ = false;        // do we cull the opaque pass on GPU (and render it by indirect draws)?
+    bool isStaticBatches_ = false;             // do we keep instance data of static entts on GPU (and send only their visibility)?
+    bool isDepthPrepass_ = false;              // do we fill depth before the opaque and alpha clipped passes?
+    bool isDepthPrepassDone_ = false;          // is the depth of the current frame already filled?
+    bool isDeferredShading_ = false;           // do we shade the opaque pass by the G-buffer and the tiled lighting (instead of forward)?
+    bool isSoftParticles_ = false;             // does the particles pass read the scene depth (instead of the depth test)?
+    bool isDynamicResolution_ = false;         // do we render the 3D scene with a scale chosen by the GPU frame time?
+    bool isFxaa_ = false;                      // do we anti-alias the 3D scene by post-process (instead of MSAA)?
+    bool isTerrainTessellation_ = false;       // do we tessellate the terrain on GPU (instead of the CPU geomipmapping)?
+    float terrainTessEdgePixels_ = 16.0f;      // desired screen-space length of a tessellated terrain edge
+    float terrainLodPixelError_ = 2.0f;        // max screen-space error of a geomipmapped terrain patch (in pixels)
+    float terrainMorphRange_ = 0.0f;           // geomorphing of the vertex pulled terrain: a part of a LOD's distances where it is morphed to the parent (0 - off)
+    float terrainMorphPixelError_ = 8.0f;      // max screen-space error of a terrain patch while it is geomorphed (LODs are switched invisibly)
+    bool isTerrainHorizonCulling_ = false;     // do we cull terrain patches and entts hidden behind hills (by the CPU horizon buffer of the geomipmapped terrain)?
+    bool isPortalCulling_ = false;             // do we cull entts and lights of interiors which aren't seen through portals (by cells and portals of the scene)?
+    bool isBakedStaticLights_ = false;         // do we light by the baked volume of static lights (instead of putting them into the clusters)?
+    float particlesSoftDistance_ = 0.5f;       // particles closer to the scene depth than this distance are faded (0 - no fade)
+    int  lowResBlendFactor_ = 1;               // blended content of LOW_RES_BLENDING materials is rendered in N times smaller (1 - off, 2 - half, 4 - quarter)
+    bool isLowResParticles_ = false;           // are particles rendered with the low resolution too?
+    bool isLowResEnttsPass_ = false;           // are low resolution blended entts rendered by their own pass in this frame?
+    bool isTerrainVertexPulling_ = false;      // do we render the geomipmapped terrain by a shared patch grid and heights from the height map?
+    bool isTerrainStreaming_ = false;          // do we stream the terrain by tiles from disk (instead of the loaded one)?
+
+    TerrainStreamingParams terrainStreamingParams_;
+    TerrainTileStreamer    terrainStreamer_;
+
+    bool                   isTerrainVT_ = false;   // is the texture map of the loaded terrain virtual (pages are baked on demand)?
+    TerrainVTParams        terrainVTParams_;
+    TerrainVirtualTexture  terrainVT_;
 
     AABBShowMode aabbShowMode_ = NONE;
 
@@ -0,0 +1,199 @@
+// =================================================================================
+// Filename:     DebugDraw.cpp
+// Description:  implementation of the DebugDraw's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "DebugDraw.h"
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+// init a global instance of the debug drawing
+DebugDraw g_DebugDraw;
+
+// pairs of corners of a box which are connected by edges
+// (the corners order is the same as in DirectX::BoundingBox::GetCorners())
+static const int s_BoxEdges[12][2] =
+{
+    {0,1}, {1,2}, {2,3}, {3,0},             // face of the first 4 corners (the near one of a frustum)
+    {4,5}, {5,6}, {6,7}, {7,4},             // face of the last 4 corners
+    {0,4}, {1,5}, {2,6}, {3,7},             // sides
+};
+
+//---------------------------------------------------------
+// Desc:   pack a color (components in the range [0, 1]) into RGBA8
+//---------------------------------------------------------
+uint32 DebugDraw::PackColor(const float r, const float g, const float b, const float a)
+{
+    const uint32 ur = (uint32)(std::clamp(r, 0.0f, 1.0f) * 255.0f + 0.5f);
+    const uint32 ug = (uint32)(std::clamp(g, 0.0f, 1.0f) * 255.0f + 0.5f);
+    const uint32 ub = (uint32)(std::clamp(b, 0.0f, 1.0f) * 255.0f + 0.5f);
+    const uint32 ua = (uint32)(std::clamp(a, 0.0f, 1.0f) * 255.0f + 0.5f);
+
+    return ur | (ug << 8) | (ub << 16) | (ua << 24);
+}
+
+//---------------------------------------------------------
+// Desc:   add a single line
+//---------------------------------------------------------
+void DebugDraw::AddLine(const XMFLOAT3& from, const XMFLOAT3& to, const uint32 color)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    vertices_.push_back({ from, color });
+    vertices_.push_back({ to,   color });
+}
+
+//---------------------------------------------------------
+// Desc:   add already prepared lines (pairs of vertices)
+//---------------------------------------------------------
+void DebugDraw::AddLines(const Vertex* vertices, const size numVertices)
+{
+    if (!vertices || (numVertices <= 0))
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const size oldSize = vertices_.size();
+    vertices_.resize(oldSize + numVertices);
+    memcpy(vertices_.data() + oldSize, vertices, sizeof(Vertex) * numVertices);
+}
+
+//---------------------------------------------------------
+// Desc:   add an axis-aligned box by its min/max points
+//---------------------------------------------------------
+void DebugDraw::AddAABB(const XMFLOAT3& minPoint, const XMFLOAT3& maxPoint, const uint32 color)
+{
+    Vertex lines[24];
+    BuildAABB(minPoint, maxPoint, color, lines);
+    AddLines(lines, 24);
+}
+
+//---------------------------------------------------------
+// Desc:   add an oriented box (in world space)
+//---------------------------------------------------------
+void DebugDraw::AddBox(const BoundingOrientedBox& box, const uint32 color)
+{
+    XMFLOAT3 corners[BoundingOrientedBox::CORNER_COUNT];
+    box.GetCorners(corners);
+
+    Vertex lines[24];
+    BuildBox(corners, color, lines);
+    AddLines(lines, 24);
+}
+
+//---------------------------------------------------------
+// Desc:   add a frustum (in world space)
+//---------------------------------------------------------
+void DebugDraw::AddFrustum(const BoundingFrustum& frustum, const uint32 color)
+{
+    // the corners of a frustum have the same order as of a box
+    XMFLOAT3 corners[BoundingFrustum::CORNER_COUNT];
+    frustum.GetCorners(corners);
+
+    Vertex lines[24];
+    BuildBox(corners, color, lines);
+    AddLines(lines, 24);
+}
+
+//---------------------------------------------------------
+// Desc:   add a sphere as 3 circles (in the XY, XZ and YZ planes)
+//---------------------------------------------------------
+void DebugDraw::AddSphere(
+    const XMFLOAT3& center,
+    const float radius,
+    const uint32 color,
+    const int numSegments)
+{
+    constexpr int maxSegments = 64;
+    const int     numSegs     = std::clamp(numSegments, 4, maxSegments);
+    const float   step        = XM_2PI / (float)numSegs;
+
+    Vertex lines[3 * 2 * maxSegments];
+    int    numVertices = 0;
+
+    for (int i = 0; i < numSegs; ++i)
+    {
+        const float s0 = radius * sinf(step * (float)i);
+        const float c0 = radius * cosf(step * (float)i);
+        const float s1 = radius * sinf(step * (float)(i + 1));
+        const float c1 = radius * cosf(step * (float)(i + 1));
+
+        // XY plane
+        lines[numVertices++] = { { center.x + c0, center.y + s0, center.z }, color };
+        lines[numVertices++] = { { center.x + c1, center.y + s1, center.z }, color };
+
+        // XZ plane
+        lines[numVertices++] = { { center.x + c0, center.y, center.z + s0 }, color };
+        lines[numVertices++] = { { center.x + c1, center.y, center.z + s1 }, color };
+
+        // YZ plane
+        lines[numVertices++] = { { center.x, center.y + c0, center.z + s0 }, color };
+        lines[numVertices++] = { { center.x, center.y + c1, center.z + s1 }, color };
+    }
+
+    AddLines(lines, numVertices);
+}
+
+//---------------------------------------------------------
+// Desc:   take all the lines which were added since the previous call
+//---------------------------------------------------------
+const cvector<DebugDraw::Vertex>& DebugDraw::Flush()
+{
+    renderVertices_.clear();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(vertices_, renderVertices_);
+
+    return renderVertices_;
+}
+
+///////////////////////////////////////////////////////////
+
+void DebugDraw::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    vertices_.clear();
+    renderVertices_.clear();
+}
+
+//---------------------------------------------------------
+// Desc:   build 12 lines of a box by its 8 corners
+//---------------------------------------------------------
+void DebugDraw::BuildBox(const XMFLOAT3* corners, const uint32 color, Vertex* outVertices)
+{
+    for (int i = 0; i < 12; ++i)
+    {
+        outVertices[2*i + 0] = { corners[s_BoxEdges[i][0]], color };
+        outVertices[2*i + 1] = { corners[s_BoxEdges[i][1]], color };
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   build 12 lines of an axis-aligned box by its min/max points
+//---------------------------------------------------------
+void DebugDraw::BuildAABB(
+    const XMFLOAT3& p0,
+    const XMFLOAT3& p1,
+    const uint32 color,
+    Vertex* outVertices)
+{
+    // the same order as in DirectX::BoundingBox::GetCorners()
+    const XMFLOAT3 corners[8] =
+    {
+        { p0.x, p0.y, p1.z },  { p1.x, p0.y, p1.z },
+        { p1.x, p1.y, p1.z },  { p0.x, p1.y, p1.z },
+        { p0.x, p0.y, p0.z },  { p1.x, p0.y, p0.z },
+        { p1.x, p1.y, p0.z },  { p0.x, p1.y, p0.z },
+    };
+
+    BuildBox(corners, color, outVertices);
+}
+
+} // namespace Core
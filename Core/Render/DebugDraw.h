@@ -0,0 +1,95 @@
+// =================================================================================
+// Filename:     DebugDraw.h
+// Description:  an immediate-mode debug drawing: lines, boxes, spheres and
+//               frustums are added during the frame (from any thread) and are
+//               accumulated into a single line list which is rendered by one
+//               draw call (see Render::DebugLineShader);
+//
+//               - the primitives live only for a single frame;
+//               - the add-methods lock a mutex once per call so prefer the bulk
+//                 AddLines() when there are a lot of lines;
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include "Shaders/DebugLineShader.h"   // from the Render module
+
+#include <mutex>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+
+namespace Core
+{
+
+class DebugDraw
+{
+    using Vertex = Render::VertexDebugLine;
+
+public:
+    static constexpr int DEFAULT_SPHERE_SEGMENTS = 24;
+
+    // pack a color (components in the range [0, 1]) into RGBA8
+    static uint32 PackColor(const float r, const float g, const float b, const float a = 1.0f);
+
+    // ----------------------------------------------------
+
+    void AddLine(
+        const DirectX::XMFLOAT3& from,
+        const DirectX::XMFLOAT3& to,
+        const uint32 color);
+
+    // add already prepared lines (pairs of vertices)
+    void AddLines(const Vertex* vertices, const size numVertices);
+
+    void AddAABB(
+        const DirectX::XMFLOAT3& minPoint,
+        const DirectX::XMFLOAT3& maxPoint,
+        const uint32 color);
+
+    void AddBox   (const DirectX::BoundingOrientedBox& box, const uint32 color);
+    void AddFrustum(const DirectX::BoundingFrustum& frustum, const uint32 color);
+
+    // a sphere is drawn by 3 circles (one per each axis plane)
+    void AddSphere(
+        const DirectX::XMFLOAT3& center,
+        const float radius,
+        const uint32 color,
+        const int numSegments = DEFAULT_SPHERE_SEGMENTS);
+
+    // ----------------------------------------------------
+
+    // take all the lines of this frame (the accumulation buffer is swapped
+    // with the render one so the add-methods don't wait for the rendering);
+    // NOTE: the returned buffer is valid until the next call
+    const cvector<Vertex>& Flush();
+
+    void Clear();
+
+    // build 12 lines (24 vertices) of a box by its 8 corners
+    // (in the order of DirectX::BoundingBox::GetCorners())
+    static void BuildBox(const DirectX::XMFLOAT3* corners, const uint32 color, Vertex* outVertices);
+
+    // build lines of a box by its min/max points (24 vertices)
+    static void BuildAABB(
+        const DirectX::XMFLOAT3& minPoint,
+        const DirectX::XMFLOAT3& maxPoint,
+        const uint32 color,
+        Vertex* outVertices);
+
+private:
+    std::mutex      mutex_;
+    cvector<Vertex> vertices_;              // lines which are accumulated during the frame
+    cvector<Vertex> renderVertices_;        // lines of the previous Flush()
+};
+
+
+// =================================================================================
+// Declare a global instance of the debug drawing
+// =================================================================================
+extern DebugDraw g_DebugDraw;
+
+} // namespace Core
@@ -0,0 +1,65 @@
+// =================================================================================
+// Filename:     DynamicResolution.cpp
+// Description:  implementation of the DynamicResolution's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "DynamicResolution.h"
+#include <GpuProfiler.h>
+
+
+namespace Core
+{
+
+// the profiler averages frames which are read back a few frames later
+static constexpr int NUM_FRAMES_TO_MEASURE =
+    Render::GpuProfiler::NUM_AVERAGE_FRAMES +
+    Render::GpuProfiler::NUM_FRAMES_IN_FLIGHT;
+
+///////////////////////////////////////////////////////////
+
+void DynamicResolution::Initialize(const float targetFrameTime, const float minScale)
+{
+    targetFrameTime_   = (targetFrameTime > 0.0f) ? targetFrameTime : 16.0f;
+    minScale_          = std::clamp(minScale, SCALE_STEP, 1.0f);
+    scale_             = 1.0f;
+    framesSinceChange_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+bool DynamicResolution::Update(const float gpuFrameTime)
+{
+    // the profiler has no results yet
+    if (gpuFrameTime <= 0.0f)
+        return false;
+
+    if (++framesSinceChange_ < NUM_FRAMES_TO_MEASURE)
+        return false;
+
+    float newScale = scale_;
+
+    if (gpuFrameTime > targetFrameTime_ * HEADROOM_DOWN)
+    {
+        // the scale which would give the target time (at least one step down)
+        const float fitScale = scale_ * sqrtf(targetFrameTime_ * HEADROOM_DOWN / gpuFrameTime);
+        newScale = std::min(floorf(fitScale / SCALE_STEP) * SCALE_STEP, scale_ - SCALE_STEP);
+    }
+    else if (gpuFrameTime < targetFrameTime_ * HEADROOM_UP)
+    {
+        newScale = scale_ + SCALE_STEP;
+    }
+
+    newScale = std::clamp(roundf(newScale / SCALE_STEP) * SCALE_STEP, minScale_, 1.0f);
+
+    if (fabsf(newScale - scale_) < 0.5f * SCALE_STEP)
+        return false;
+
+    scale_             = newScale;
+    framesSinceChange_ = 0;
+
+    return true;
+}
+
+} // namespace Core
@@ -0,0 +1,43 @@
+// =================================================================================
+// Filename:     DynamicResolution.h
+// Description:  chooses the render scale of the 3D scene by the GPU frame time:
+//               the GPU time is roughly proportional to the number of pixels
+//               (scale^2) so if the frame is too slow we go down at once to
+//               the scale which fits the target, and if there is enough
+//               headroom we go up by a single step;
+//
+//               the scale is quantized and is changed at most once per
+//               averaging window of the GPU profiler (the measured time must
+//               be of frames which were rendered with the current scale)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+namespace Core
+{
+
+class DynamicResolution
+{
+public:
+    static constexpr float SCALE_STEP      = 0.05f;
+    static constexpr float HEADROOM_DOWN   = 0.95f;      // go down if GPU time > target * HEADROOM_DOWN
+    static constexpr float HEADROOM_UP     = 0.75f;      // go up   if GPU time < target * HEADROOM_UP
+
+    void Initialize(const float targetFrameTime, const float minScale);
+
+    // input: the averaged GPU frame time (in ms);
+    // return true if the scale was changed
+    bool Update(const float gpuFrameTime);
+
+    inline float GetScale()           const { return scale_; }
+    inline float GetTargetFrameTime() const { return targetFrameTime_; }
+
+private:
+    float targetFrameTime_   = 16.0f;                    // in ms
+    float minScale_          = 0.5f;
+    float scale_             = 1.0f;
+    int   framesSinceChange_ = 0;
+};
+
+} // namespace Core
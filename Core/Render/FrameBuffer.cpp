@@ -4,6 +4,7 @@
 // ====================================================================================
 #include <CoreCommon/pch.h>
 #include "FrameBuffer.h"
+#include "GpuMemory.h"
 
 
 namespace Core
@@ -22,14 +23,19 @@ FrameBuffer::~FrameBuffer()
 
 FrameBuffer::FrameBuffer(FrameBuffer&& rhs) noexcept
     :
+    specification_       { rhs.specification_ },
     pRenderTargetTexture_(std::exchange(rhs.pRenderTargetTexture_, nullptr)),
     pRenderTargetView_   (std::exchange(rhs.pRenderTargetView_, nullptr)),
     pShaderResourceView_ (std::exchange(rhs.pShaderResourceView_, nullptr)),
     pDepthStencilBuffer_ (std::exchange(rhs.pDepthStencilBuffer_, nullptr)),
     pDepthStencilView_   (std::exchange(rhs.pDepthStencilView_, nullptr)),
+    pDepthSRV_           (std::exchange(rhs.pDepthSRV_, nullptr)),
     viewport_            { rhs.viewport_ },
     projection_          { rhs.projection_ },
-    orthoMatrix_         { rhs.orthoMatrix_ }
+    orthoMatrix_         { rhs.orthoMatrix_ },
+    renderScale_         { rhs.renderScale_ },
+    gpuBytes_            { std::exchange(rhs.gpuBytes_, 0) },
+    isInit_              { std::exchange(rhs.isInit_, false) }
 {
     // move-constructor
 }
@@ -52,6 +58,10 @@ FrameBuffer& FrameBuffer::operator=(FrameBuffer&& rhs) noexcept
 
 void FrameBuffer::Shutdown()
 {
+    g_MemTracker.RemoveGpu(GPU_MEM_RENDER_TARGETS, gpuBytes_);
+    gpuBytes_ = 0;
+
+    SafeRelease(&pDepthSRV_);
     SafeRelease(&pDepthStencilView_);
     SafeRelease(&pDepthStencilBuffer_);
     SafeRelease(&pShaderResourceView_);
@@ -93,6 +103,7 @@ bool FrameBuffer::Initialize(ID3D11Device* pDevice, const FrameBufferSpecificati
         CreateDepthStencilBuffer(pDevice);
         CreateDepthStencilView(pDevice);
         SetupViewportAndMatrices();
+        UpdateGpuMemoryUsage();
 
         isInit_ = true;
     }
@@ -131,6 +142,7 @@ void FrameBuffer::ResizeBuffers(
         pContext->OMSetRenderTargets(_countof(nullViews), nullViews, nullptr);
 
         // 2. Release rendering target
+        SafeRelease(&pDepthSRV_);
         SafeRelease(&pDepthStencilBuffer_);
         SafeRelease(&pDepthStencilView_);
         SafeRelease(&pShaderResourceView_);
@@ -145,6 +157,10 @@ void FrameBuffer::ResizeBuffers(
         CreateDepthStencilBuffer(pDevice);
         CreateDepthStencilView(pDevice);
         SetupViewportAndMatrices();
+        UpdateGpuMemoryUsage();
+
+        // keep the current render scale for the new size
+        SetRenderScale(renderScale_);
     }
     catch (EngineException& e)
     {
@@ -191,6 +207,17 @@ void FrameBuffer::ClearBuffers(
     pContext->ClearDepthStencilView(pDepthStencilView_, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 }
 
+//////////////////////////////////////////////////////////
+
+void FrameBuffer::SetRenderScale(const float scale)
+{
+    // the projection matrices aren't changed: the same image is rendered just by less pixels
+    renderScale_ = std::clamp(scale, 0.01f, 1.0f);
+
+    viewport_.Width  = ceilf((float)specification_.width  * renderScale_);
+    viewport_.Height = ceilf((float)specification_.height * renderScale_);
+}
+
 
 
 // ====================================================================================
@@ -279,6 +306,13 @@ void FrameBuffer::CreateDepthStencilBuffer(ID3D11Device* pDevice)
     desc.SampleDesc.Quality = 0;
     desc.Usage              = D3D11_USAGE_DEFAULT;
     desc.BindFlags          = D3D11_BIND_DEPTH_STENCIL;
+
+    // typeless so we can create both the depth stencil view and the shader resource view
+    if (specification_.readableDepth)
+    {
+        desc.Format     = DXGI_FORMAT_R24G8_TYPELESS;
+        desc.BindFlags |= D3D11_BIND_SHADER_RESOURCE;
+    }
     desc.CPUAccessFlags     = 0;
     desc.MiscFlags          = 0;
 
@@ -302,8 +336,23 @@ void FrameBuffer::CreateDepthStencilView(ID3D11Device* pDevice)
 
     // create the depth stencil view
     //hr = pDevice->CreateDepthStencilView(pDepthStencilBuffer_, &desc, &pDepthStencilView_);
-    hr = pDevice->CreateDepthStencilView(pDepthStencilBuffer_, nullptr, &pDepthStencilView_);
+    hr = pDevice->CreateDepthStencilView(pDepthStencilBuffer_, (specification_.readableDepth) ? &desc : nullptr, &pDepthStencilView_);
     CAssert::NotFailed(hr, "can't create the depth stencil view");
+
+    if (!specification_.readableDepth)
+        return;
+
+    // create a view to read the depth in shaders
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+    ZeroMemory(&srvDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
+
+    srvDesc.Format                    = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+    srvDesc.ViewDimension             = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MostDetailedMip = 0;
+    srvDesc.Texture2D.MipLevels       = 1;
+
+    hr = pDevice->CreateShaderResourceView(pDepthStencilBuffer_, &srvDesc, &pDepthSRV_);
+    CAssert::NotFailed(hr, "can't create a shader resource view of the depth buffer");
 }
 
 ///////////////////////////////////////////////////////////
@@ -334,4 +383,17 @@ void FrameBuffer::SetupViewportAndMatrices()
     orthoMatrix_ = DirectX::XMMatrixOrthographicLH(w, h, nearZ, farZ);
 }
 
+///////////////////////////////////////////////////////////
+
+void FrameBuffer::UpdateGpuMemoryUsage()
+{
+    // replace the previous size of textures by the current one
+    // (the render target and depth buffers are recreated on resize)
+
+    g_MemTracker.RemoveGpu(GPU_MEM_RENDER_TARGETS, gpuBytes_);
+
+    gpuBytes_ = GetGpuMemorySize(pRenderTargetTexture_) + GetGpuMemorySize(pDepthStencilBuffer_);
+    g_MemTracker.AddGpu(GPU_MEM_RENDER_TARGETS, gpuBytes_);
+}
+
 } // namespace Core
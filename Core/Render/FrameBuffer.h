@@ -25,6 +25,7 @@ struct FrameBufferSpecification
     DXGI_FORMAT format = DXGI_FORMAT(0);   // texture surface format
     float       screenNear = 0.0f;
     float       screenDepth = 0.0f;
+    bool        readableDepth = false;     // create a typeless depth buffer with SRV (to read the depth in shaders)
 };
 
 ///////////////////////////////////////////////////////////
@@ -57,6 +58,11 @@ public:
     void Bind(ID3D11DeviceContext* pContext);
     void ClearBuffers(ID3D11DeviceContext* pContext, const DirectX::XMFLOAT4& rgbaColor);
 
+    // render only into the top-left part of the textures (scale of each dimension
+    // in range (0, 1]) so the resolution can be changed without reallocation;
+    // NOTE: is applied by the next Bind()
+    void SetRenderScale(const float scale);
+
 
     //
     // inline getters
@@ -65,6 +71,7 @@ public:
 
     inline ID3D11ShaderResourceView*  GetSRV()                const { return pShaderResourceView_; }
     inline ID3D11ShaderResourceView** GetAddressOfSRV()             { return &pShaderResourceView_; }
+    inline ID3D11ShaderResourceView*  GetDepthSRV()           const { return pDepthSRV_; }
 
     inline void GetProjectionMatrix(DirectX::XMMATRIX& proj)  const { proj = projection_; }
     inline void GetOrthoMatrix(DirectX::XMMATRIX& ortho)      const { ortho = orthoMatrix_; }
@@ -72,6 +79,10 @@ public:
     inline UINT GetTexWidth()                                 const { return specification_.width; }
     inline UINT GetTexHeight()                                const { return specification_.height; }
 
+    inline float GetRenderScale()                             const { return renderScale_; }
+    inline UINT  GetScaledWidth()                             const { return (UINT)viewport_.Width; }
+    inline UINT  GetScaledHeight()                            const { return (UINT)viewport_.Height; }
+
 private:
     void CreateRenderTargetTexture(ID3D11Device* pDevice);
     void CreateRenderTargetView(ID3D11Device* pDevice);
@@ -79,6 +90,7 @@ private:
     void CreateDepthStencilBuffer(ID3D11Device* pDevice);
     void CreateDepthStencilView(ID3D11Device* pDevice);
     void SetupViewportAndMatrices();
+    void UpdateGpuMemoryUsage();
 
 private:
     FrameBufferSpecification  specification_;
@@ -87,9 +99,12 @@ private:
     ID3D11ShaderResourceView* pShaderResourceView_  = nullptr;
     ID3D11Texture2D*          pDepthStencilBuffer_  = nullptr;
     ID3D11DepthStencilView*   pDepthStencilView_    = nullptr;
+    ID3D11ShaderResourceView* pDepthSRV_            = nullptr;    // only if the spec has readableDepth
     D3D11_VIEWPORT            viewport_             = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
     DirectX::XMMATRIX         projection_           = DirectX::XMMatrixIdentity();
     DirectX::XMMATRIX         orthoMatrix_          = DirectX::XMMatrixIdentity();
+    float                     renderScale_          = 1.0f;
+    uint64                    gpuBytes_             = 0;          // is added to the GPU_MEM_RENDER_TARGETS
     bool                      isInit_               = false;
 };
 
@@ -0,0 +1,46 @@
+// =================================================================================
+// Filename:     FramePacket.h
+// Description:  a snapshot of the state which is needed to render a frame;
+//               it is filled by the main thread (see CGraphics::ExtractFramePacket)
+//               and then is consumed by the render thread so the render passes
+//               never read the ECS which is updated at the same time;
+//
+//               NOTE: visible instances, lights and per frame constants are
+//               uploaded into the renderer's buffers during the extraction too
+//               (by CGraphics::Update) so the packet refers them implicitly
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <CoreCommon/SystemState.h>
+#include <cvector.h>
+#include "Shaders/DebugLineShader.h"   // from the Render module
+#include "Common/ConstBufferTypes.h"   // from the Render module
+
+#include <DirectXMath.h>
+
+
+namespace Core
+{
+
+struct FramePacket
+{
+    // camera, UI flags, etc.; stats of the rendering (GPU times, binds, render
+    // time) are written into it and are copied back when the frame is finished
+    SystemState       sysState;
+
+    DirectX::XMMATRIX skyWorldViewProj;             // is already transposed
+    bool              hasSky     = false;
+    bool              hasTerrain = false;
+
+    // params of the tessellated terrain (if this mode is on)
+    Render::ConstBufType::cbTerrainTess terrainTess;
+
+    // lines of the debug drawing (are valid until the next packet is extracted)
+    const cvector<Render::VertexDebugLine>* pDebugLines = nullptr;
+
+    bool              isFailed   = false;           // the frame can't be rendered (the engine exits)
+};
+
+} // namespace Core
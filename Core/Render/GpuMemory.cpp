@@ -0,0 +1,118 @@
+// =================================================================================
+// Filename:     GpuMemory.cpp
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "GpuMemory.h"
+#include <DirectXTex.h>
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// Desc:   bytes of all the mips of a single slice (depth - for 3D textures)
+//---------------------------------------------------------
+static uint64 GetMipChainSize(
+    const DXGI_FORMAT format,
+    const UINT width,
+    const UINT height,
+    const UINT depth,
+    const UINT numMips)
+{
+    uint64 bytes = 0;
+
+    for (UINT mip = 0; mip < numMips; ++mip)
+    {
+        const size_t w = std::max(1U, width  >> mip);
+        const size_t h = std::max(1U, height >> mip);
+        const size_t d = std::max(1U, depth  >> mip);
+
+        size_t rowPitch   = 0;
+        size_t slicePitch = 0;
+
+        if (FAILED(DirectX::ComputePitch(format, w, h, rowPitch, slicePitch)))
+            return 0;
+
+        bytes += (uint64)slicePitch * d;
+    }
+
+    return bytes;
+}
+
+//---------------------------------------------------------
+// Desc:   MipLevels == 0 in a desc means the full mip chain
+//---------------------------------------------------------
+static UINT GetNumMips(const UINT mipLevels, const UINT width, const UINT height, const UINT depth)
+{
+    if (mipLevels)
+        return mipLevels;
+
+    UINT size    = std::max(width, std::max(height, depth));
+    UINT numMips = 1;
+
+    while (size > 1)
+    {
+        size >>= 1;
+        ++numMips;
+    }
+
+    return numMips;
+}
+
+///////////////////////////////////////////////////////////
+
+uint64 GetGpuMemorySize(const D3D11_TEXTURE2D_DESC& desc)
+{
+    const UINT   numMips    = GetNumMips(desc.MipLevels, desc.Width, desc.Height, 1);
+    const uint64 sliceBytes = GetMipChainSize(desc.Format, desc.Width, desc.Height, 1, numMips);
+
+    return sliceBytes * desc.ArraySize * std::max(1U, desc.SampleDesc.Count);
+}
+
+///////////////////////////////////////////////////////////
+
+uint64 GetGpuMemorySize(ID3D11Resource* pResource)
+{
+    if (!pResource)
+        return 0;
+
+    D3D11_RESOURCE_DIMENSION dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+    pResource->GetType(&dimension);
+
+    switch (dimension)
+    {
+        case D3D11_RESOURCE_DIMENSION_BUFFER:
+        {
+            D3D11_BUFFER_DESC desc;
+            ((ID3D11Buffer*)pResource)->GetDesc(&desc);
+            return desc.ByteWidth;
+        }
+        case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
+        {
+            D3D11_TEXTURE1D_DESC desc;
+            ((ID3D11Texture1D*)pResource)->GetDesc(&desc);
+
+            const UINT numMips = GetNumMips(desc.MipLevels, desc.Width, 1, 1);
+            return GetMipChainSize(desc.Format, desc.Width, 1, 1, numMips) * desc.ArraySize;
+        }
+        case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
+        {
+            D3D11_TEXTURE2D_DESC desc;
+            ((ID3D11Texture2D*)pResource)->GetDesc(&desc);
+            return GetGpuMemorySize(desc);
+        }
+        case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
+        {
+            D3D11_TEXTURE3D_DESC desc;
+            ((ID3D11Texture3D*)pResource)->GetDesc(&desc);
+
+            const UINT numMips = GetNumMips(desc.MipLevels, desc.Width, desc.Height, desc.Depth);
+            return GetMipChainSize(desc.Format, desc.Width, desc.Height, desc.Depth, numMips);
+        }
+    }
+
+    return 0;
+}
+
+} // namespace Core
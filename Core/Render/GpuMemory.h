@@ -0,0 +1,21 @@
+// =================================================================================
+// Filename:     GpuMemory.h
+// Description:  sizes of D3D11 resources in the video memory (for the accounting
+//               by the MemTracker); data of all the mips, array slices and samples
+//               is counted; the driver's padding and alignment aren't known
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <d3d11.h>
+
+
+namespace Core
+{
+
+uint64 GetGpuMemorySize(const D3D11_TEXTURE2D_DESC& desc);
+uint64 GetGpuMemorySize(ID3D11Resource* pResource);
+
+} // namespace Core
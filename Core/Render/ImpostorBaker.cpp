@@ -0,0 +1,160 @@
+// =================================================================================
+// Filename:     ImpostorBaker.cpp
+// Description:  implementation of the ImpostorBaker's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "ImpostorBaker.h"
+#include "FrameBuffer.h"
+#include "CRender.h"
+#include "../Texture/TextureMgr.h"
+#include "../Mesh/MaterialMgr.h"
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+bool ImpostorBaker::Bake(
+    ID3D11Device* pDevice,
+    ID3D11DeviceContext* pContext,
+    Render::MaterialIconShader& shader,
+    BasicModel& model)
+{
+    FrameBuffer atlasBuf;
+
+    try
+    {
+        CAssert::True(pDevice != nullptr,  "input ptr to the device == nullptr");
+        CAssert::True(pContext != nullptr, "input ptr to the device context == nullptr");
+
+        // the quad must cover the model from any direction around the Y axis
+        const XMFLOAT3& center  = model.modelAABB_.Center;
+        const XMFLOAT3& extents = model.modelAABB_.Extents;
+        const float     radius  = sqrtf(extents.x * extents.x + extents.z * extents.z);
+        const float     maxDist = sqrtf(radius * radius + extents.y * extents.y);
+
+        if ((radius <= 0.0f) || (extents.y <= 0.0f))
+        {
+            sprintf(g_String, "can't bake an impostor of model (%s): its AABB is empty", model.name_);
+            LogErr(g_String);
+            return false;
+        }
+
+        // all the views are rendered into cells of a single frame buffer
+        FrameBufferSpecification spec;
+        spec.width       = (UINT)(CELL_SIZE * NUM_COLS);
+        spec.height      = (UINT)(CELL_SIZE * NUM_ROWS);
+        spec.format      = DXGI_FORMAT_R8G8B8A8_UNORM;
+        spec.screenNear  = 0.1f;
+        spec.screenDepth = 1000.0f;
+
+        bool result = atlasBuf.Initialize(pDevice, spec);
+        CAssert::True(result, "can't initialize a frame buffer for the impostor atlas");
+
+        // the background is transparent (the impostor shader clips it)
+        atlasBuf.ClearBuffers(pContext, { 0,0,0,0 });
+        atlasBuf.Bind(pContext);
+
+        const MeshGeometry& meshes = model.meshes_;
+
+        shader.PrepareRendering(
+            pContext,
+            meshes.GetVB(),
+            meshes.GetIB(),
+            meshes.GetIndexFormat(),
+            (int)meshes.vertexStride_);
+
+        // the camera is outside of the bounding sphere
+        const float    camDist = maxDist + 1.0f;
+        const XMMATRIX proj    = XMMatrixOrthographicLH(2.0f * radius, 2.0f * extents.y, 0.1f, camDist + maxDist + 1.0f);
+        const XMVECTOR target  = XMLoadFloat3(&center);
+        const XMVECTOR up      = { 0, 1, 0, 0 };
+
+        cvector<ID3D11ShaderResourceView*> texSRVs;
+
+        for (int view = 0; view < NUM_VIEWS; ++view)
+        {
+            const int   col   = view % NUM_COLS;
+            const int   row   = view / NUM_COLS;
+            const float angle = XM_2PI * (float)view / (float)NUM_VIEWS;
+
+            const D3D11_VIEWPORT viewport =
+            {
+                (float)(col * CELL_SIZE),
+                (float)(row * CELL_SIZE),
+                (float)CELL_SIZE,
+                (float)CELL_SIZE,
+                0.0f,
+                1.0f
+            };
+            pContext->RSSetViewports(1, &viewport);
+
+            // the direction from the model to the camera
+            const XMVECTOR dir  = { sinf(angle), 0, cosf(angle), 0 };
+            const XMVECTOR eye  = XMVectorAdd(target, XMVectorScale(dir, camDist));
+            const XMMATRIX vMat = XMMatrixLookAtLH(eye, target, up);
+
+            shader.SetMatrix(pContext, XMMatrixIdentity(), vMat, proj);
+
+            for (int i = 0; i < model.GetNumSubsets(); ++i)
+            {
+                const MeshGeometry::Subset& subset = meshes.subsets_[i];
+                const Material&             mat    = g_MaterialMgr.GetMaterialByID(subset.materialID);
+
+                const Render::Material renderMat(
+                    XMFLOAT4(&mat.ambient.x),
+                    XMFLOAT4(&mat.diffuse.x),
+                    XMFLOAT4(&mat.specular.x),
+                    XMFLOAT4(&mat.reflect.x));
+
+                g_TextureMgr.GetSRVsByTexIDs(mat.textureIDs, NUM_TEXTURE_TYPES, texSRVs);
+
+                shader.Render(
+                    pContext,
+                    (int)subset.indexCount,
+                    subset.indexStart + meshes.GetBaseIndex(),
+                    (int)(subset.vertexStart + meshes.GetBaseVertex()),
+                    texSRVs.data(),
+                    renderMat);
+            }
+        }
+
+        // copy the frame buffer into a texture of the manager
+        ID3D11Resource* pAtlasRes = nullptr;
+        atlasBuf.GetSRV()->GetResource(&pAtlasRes);
+
+        Texture atlasTex;
+        atlasTex.Copy(pAtlasRes);
+        SafeRelease(&pAtlasRes);
+
+        char texName[64]{ '\0' };
+        snprintf(texName, sizeof(texName), "impostor_%s", model.name_);
+        atlasTex.SetName(texName);
+
+        ImpostorAtlas& impostor = model.impostor_;
+        impostor.texID    = g_TextureMgr.Add(texName, std::move(atlasTex));
+        impostor.center   = center;
+        impostor.size     = { 2.0f * radius, 2.0f * extents.y };
+        impostor.numViews = (uint16_t)NUM_VIEWS;
+        impostor.numCols  = (uint16_t)NUM_COLS;
+        impostor.numRows  = (uint16_t)NUM_ROWS;
+
+        atlasBuf.Shutdown();
+
+        LogMsgf("impostor of model (%s) is baked: %d views (%ux%u)", model.name_, NUM_VIEWS, spec.width, spec.height);
+        return impostor.IsBaked();
+    }
+    catch (EngineException& e)
+    {
+        atlasBuf.Shutdown();
+        LogErr(e);
+        sprintf(g_String, "can't bake an impostor of model (%s)", model.name_);
+        LogErr(g_String);
+        return false;
+    }
+}
+
+} // namespace Core
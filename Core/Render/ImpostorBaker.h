@@ -0,0 +1,47 @@
+// =================================================================================
+// Filename:     ImpostorBaker.h
+// Description:  bakes an impostor atlas of a model: the model (LOD 0) is
+//               rendered by an orthographic camera from NUM_VIEWS directions
+//               around the Y axis into cells of a single frame buffer which
+//               is copied into a texture of the textures manager;
+//
+//               at runtime the impostor is the last level of detail: a y-axis
+//               aligned quad which blends the two nearest views
+//               (see Render::ImpostorShader)
+//
+//               NOTE: the lighting is baked (by the material icon shader)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Model/BasicModel.h"
+#include <d3d11.h>
+
+namespace Render
+{
+    class MaterialIconShader;
+}
+
+
+namespace Core
+{
+
+class ImpostorBaker
+{
+public:
+    static constexpr int NUM_VIEWS = 16;                    // views around the Y axis (the first one looks at the model's +Z side)
+    static constexpr int NUM_COLS  = 4;                     // the atlas grid
+    static constexpr int NUM_ROWS  = NUM_VIEWS / NUM_COLS;
+    static constexpr int CELL_SIZE = 256;                   // width/height of a single view (in texels)
+
+    // render the views of the model and store the atlas into model.impostor_;
+    // NOTE: the caller sets/resets render states, render target and viewport
+    bool Bake(
+        ID3D11Device* pDevice,
+        ID3D11DeviceContext* pContext,
+        Render::MaterialIconShader& shader,
+        BasicModel& model);
+};
+
+} // namespace Core
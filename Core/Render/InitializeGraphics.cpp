@@ -34,18 +34,38 @@ bool InitializeGraphics::InitializeDirectX(
 
     try 
     {
-        bool result = d3d.Initialize(
-            hwnd,
-            settings.GetBool("VSYNC_ENABLED"),
-            settings.GetBool("FULL_SCREEN"),
-            settings.GetBool("ENABLE_4X_MSAA"),
-            settings.GetFloat("NEAR_Z"),
-            settings.GetFloat("FAR_Z"));         // how far we can see
+        // the post-process anti-aliasing replaces MSAA (so the back buffer,
+        // depth and rasterizer states aren't multisampled)
+        const bool enable4xMSAA = settings.GetBool("ENABLE_4X_MSAA") && !settings.GetBool("FXAA");
+        bool result = false;
+
+        // there is no window in the headless mode: a software device renders offscreen
+        if (hwnd == NULL)
+        {
+            result = d3d.InitializeHeadless(
+                settings.GetInt("WINDOW_WIDTH"),
+                settings.GetInt("WINDOW_HEIGHT"),
+                strcmp(settings.GetString("HEADLESS_DEVICE"), "reference") == 0,
+                settings.GetFloat("NEAR_Z"),
+                settings.GetFloat("FAR_Z"));
+        }
+        else
+        {
+            result = d3d.Initialize(
+                hwnd,
+                settings.GetBool("VSYNC_ENABLED"),
+                settings.GetBool("FULL_SCREEN"),
+                enable4xMSAA,
+                settings.GetBool("FLIP_MODEL_SWAP_CHAIN"),
+                settings.GetInt("MAX_FRAME_LATENCY"),
+                settings.GetFloat("NEAR_Z"),
+                settings.GetFloat("FAR_Z"));     // how far we can see
+        }
 
         CAssert::True(result, "can't initialize the Direct3D");
 
         // setup the rasterizer state to default params
-        d3d.SetRS({ eRenderState::CULL_BACK, eRenderState::FILL_SOLID });
+        d3d.SetRS(RSMask(CULL_BACK) | RSMask(FILL_SOLID));
     }
     catch (EngineException & e)
     {
@@ -0,0 +1,785 @@
+// =================================================================================
+// Filename:     LightBaker.cpp
+// Description:  implementation of the LightBaker's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "LightBaker.h"
+#include "../Model/ModelMgr.h"
+#include "Entity/EntityMgr.h"
+#include <JobSystem.h>
+#include <DirectXTex.h>
+
+namespace fs = std::filesystem;
+using namespace DirectX;
+
+
+namespace Core
+{
+
+// files of a bake (in the dir of the bake)
+static const char* HEADER_FILENAME = "static_lights.bin";
+static const char* VOLUME_FILENAMES[LightBaker::NUM_VOLUMES] =
+{
+    "static_lights_diffuse.dds",
+    "static_lights_ambient.dds",
+    "static_lights_dir.dds",
+};
+
+// the direction is signed so it can't be stored as the unsigned BC6H
+static const DXGI_FORMAT VOLUME_FORMATS[LightBaker::NUM_VOLUMES] =
+{
+    DXGI_FORMAT_BC6H_UF16,
+    DXGI_FORMAT_BC6H_UF16,
+    DXGI_FORMAT_BC6H_SF16,
+};
+
+static constexpr uint32 HEADER_MAGIC = 0x4B42534C;   // "LSBK"
+
+struct StaticLightsHeader
+{
+    uint32   magic      = HEADER_MAGIC;
+    uint32   version    = LightBaker::BAKE_VERSION;
+    int32_t  dims[3]    = { 0,0,0 };
+    XMFLOAT3 boundsMin  = { 0,0,0 };
+    XMFLOAT3 boundsMax  = { 0,0,0 };
+    float    normalBias = 0;
+    uint64   lightsHash = 0;
+    uint32   numLights  = 0;                 // is followed by SORTED IDs of baked lights
+};
+
+// the bake is split into jobs by rows of voxels (along the x axis)
+static constexpr int BAKE_JOB_GRAIN = 4;
+
+//---------------------------------------------------------
+// Desc:  FNV-1a hash of bytes (is continued from the input hash)
+//---------------------------------------------------------
+static uint64 HashBytes(uint64 hash, const void* pData, const size_t numBytes)
+{
+    const uint8* bytes = (const uint8*)pData;
+
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+//---------------------------------------------------------
+// Desc:  number of voxels by an axis: a multiple of 4 (whole BC blocks)
+//---------------------------------------------------------
+static int ComputeDim(const float extent, const float cellSize, const int maxDim)
+{
+    const int maxDim4 = std::max(4, maxDim & ~3);
+    const int dim     = (int)ceilf(extent / cellSize);
+
+    return std::min(maxDim4, (std::max(dim, 4) + 3) & ~3);
+}
+
+
+// =================================================================================
+// public API
+// =================================================================================
+LightBaker::~LightBaker()
+{
+    Release();
+}
+
+///////////////////////////////////////////////////////////
+
+void LightBaker::Release()
+{
+    for (ID3D11ShaderResourceView*& pSRV : pSRVs_)
+        SafeRelease(&pSRV);
+
+    bakedIds_.clear();
+    dims_[0] = dims_[1] = dims_[2] = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+bool LightBaker::Bake(
+    ID3D11Device* pDevice,
+    ECS::EntityMgr& mgr,
+    const LightBakeParams& params,
+    const char* dirPath)
+{
+    try
+    {
+        CAssert::True(pDevice != nullptr,                     "input ptr to the device == nullptr");
+        CAssert::True(dirPath && dirPath[0] != '\0',          "input path to the bake dir is empty");
+        CAssert::True((params.cellSize > 0) && (params.maxDim >= 4), "invalid params of the light bake");
+
+        Release();
+        stats_ = LightBakeStats();
+
+        // models must have their geometry to cast shadows
+        g_ModelMgr.FinishLoading();
+
+        GatherLights(mgr);
+
+        if (lights_.empty())
+        {
+            LogMsgf("light bake: there are no static lights");
+            return false;
+        }
+
+        ComputeBounds(params);
+
+        if (params.isShadows)
+            GatherOccluders(mgr);
+        else
+            occluders_.clear();
+
+        // occluders of each light: which AABBs touch its range sphere
+        const int numLights = (int)lights_.size();
+
+        lightOccludersStart_.resize(numLights + 1);
+        lightOccluders_.clear();
+
+        for (int i = 0; i < numLights; ++i)
+        {
+            const BakeLight& light = lights_[i];
+            lightOccludersStart_[i] = (int)lightOccluders_.size();
+
+            for (int o = 0; o < (int)occluders_.size(); ++o)
+            {
+                const Occluder& occ = occluders_[o];
+
+                const float dx = std::max(std::max(occ.minP.x - light.pos.x, light.pos.x - occ.maxP.x), 0.0f);
+                const float dy = std::max(std::max(occ.minP.y - light.pos.y, light.pos.y - occ.maxP.y), 0.0f);
+                const float dz = std::max(std::max(occ.minP.z - light.pos.z, light.pos.z - occ.maxP.z), 0.0f);
+
+                if (dx*dx + dy*dy + dz*dz <= light.range * light.range)
+                    lightOccluders_.push_back(o);
+            }
+        }
+        lightOccludersStart_[numLights] = (int)lightOccluders_.size();
+
+        // ------------------------------------------------
+        // bake voxels into float volumes (each job writes its own rows)
+
+        const int dimX = dims_[0];
+        const int dimY = dims_[1];
+        const int dimZ = dims_[2];
+
+        ScratchImage volumes[NUM_VOLUMES];
+
+        for (ScratchImage& volume : volumes)
+        {
+            const HRESULT hr = volume.Initialize3D(DXGI_FORMAT_R32G32B32A32_FLOAT, dimX, dimY, dimZ, 1);
+            CAssert::NotFailed(hr, "can't allocate a volume of the light bake");
+        }
+
+        const XMFLOAT3 voxelSize =
+        {
+            (boundsMax_.x - boundsMin_.x) / dimX,
+            (boundsMax_.y - boundsMin_.y) / dimY,
+            (boundsMax_.z - boundsMin_.z) / dimZ,
+        };
+
+        std::atomic<uint64> numRays = 0;
+        const auto          start   = std::chrono::steady_clock::now();
+
+        g_JobSystem.ParallelFor(dimY * dimZ, BAKE_JOB_GRAIN, [&](const index startRow, const index endRow)
+        {
+            uint64 jobRays = 0;
+
+            for (index row = startRow; row < endRow; ++row)
+            {
+                const int y = (int)(row % dimY);
+                const int z = (int)(row / dimY);
+
+                float* rows[NUM_VOLUMES];
+
+                for (int v = 0; v < NUM_VOLUMES; ++v)
+                {
+                    const Image* pSlice = volumes[v].GetImage(0, 0, z);
+                    rows[v] = (float*)(pSlice->pixels + y * pSlice->rowPitch);
+                }
+
+                XMFLOAT3 p;
+                p.y = boundsMin_.y + ((float)y + 0.5f) * voxelSize.y;
+                p.z = boundsMin_.z + ((float)z + 0.5f) * voxelSize.z;
+
+                for (int x = 0; x < dimX; ++x)
+                {
+                    p.x = boundsMin_.x + ((float)x + 0.5f) * voxelSize.x;
+                    BakeVoxel(p, rows[0] + x*4, rows[1] + x*4, rows[2] + x*4, jobRays);
+                }
+            }
+
+            numRays += jobRays;
+        });
+
+        stats_.bakeTimeMs   = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats_.numRays      = numRays;
+        stats_.numLights    = numLights;
+        stats_.numOccluders = (int)occluders_.size();
+        stats_.dims[0]      = dimX;
+        stats_.dims[1]      = dimY;
+        stats_.dims[2]      = dimZ;
+
+        // ------------------------------------------------
+        // compress the volumes (on GPU if it is possible), store and create SRVs
+
+        std::error_code error;
+        fs::create_directories(dirPath, error);
+
+        char path[256]{ '\0' };
+        wchar_t wPath[256]{ L'\0' };
+
+        for (int i = 0; i < NUM_VOLUMES; ++i)
+        {
+            const ScratchImage& src = volumes[i];
+            ScratchImage        compressed;
+
+            HRESULT hr = Compress(
+                pDevice,
+                src.GetImages(),
+                src.GetImageCount(),
+                src.GetMetadata(),
+                VOLUME_FORMATS[i],
+                TEX_COMPRESS_DEFAULT,
+                TEX_ALPHA_WEIGHT_DEFAULT,
+                compressed);
+
+            if (FAILED(hr))
+            {
+                hr = Compress(
+                    src.GetImages(),
+                    src.GetImageCount(),
+                    src.GetMetadata(),
+                    VOLUME_FORMATS[i],
+                    TEX_COMPRESS_PARALLEL,
+                    TEX_THRESHOLD_DEFAULT,
+                    compressed);
+            }
+            CAssert::NotFailed(hr, "can't compress a volume of the light bake");
+
+            snprintf(path, sizeof(path), "%s%s", dirPath, VOLUME_FILENAMES[i]);
+            StrHelper::StrToWide(path, wPath);
+
+            hr = SaveToDDSFile(
+                compressed.GetImages(),
+                compressed.GetImageCount(),
+                compressed.GetMetadata(),
+                DDS_FLAGS_NONE,
+                wPath);
+
+            if (FAILED(hr))
+            {
+                sprintf(g_String, "can't save a volume of the light bake: %s", path);
+                LogErr(g_String);
+            }
+
+            hr = CreateShaderResourceView(
+                pDevice,
+                compressed.GetImages(),
+                compressed.GetImageCount(),
+                compressed.GetMetadata(),
+                &pSRVs_[i]);
+            CAssert::NotFailed(hr, "can't create a SRV of the light bake volume");
+        }
+
+        snprintf(path, sizeof(path), "%s%s", dirPath, HEADER_FILENAME);
+
+        if (!SaveHeader(path))
+        {
+            sprintf(g_String, "can't save a header of the light bake: %s", path);
+            LogErr(g_String);
+        }
+
+        LogMsgf("light bake: %d lights, %d occluders, %dx%dx%d voxels, %llu rays, %.1f ms",
+                stats_.numLights, stats_.numOccluders, dimX, dimY, dimZ, (unsigned long long)stats_.numRays, stats_.bakeTimeMs);
+
+        lights_.clear();
+        occluders_.clear();
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't bake static lights");
+        Release();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool LightBaker::Load(ID3D11Device* pDevice, ECS::EntityMgr& mgr, const char* dirPath)
+{
+    try
+    {
+        CAssert::True(pDevice != nullptr,            "input ptr to the device == nullptr");
+        CAssert::True(dirPath && dirPath[0] != '\0', "input path to the bake dir is empty");
+
+        Release();
+
+        char path[256]{ '\0' };
+        snprintf(path, sizeof(path), "%s%s", dirPath, HEADER_FILENAME);
+
+        StaticLightsHeader header;
+        cvector<EntityID>  ids;
+
+        if (!LoadHeader(path, header, ids))
+            return false;
+
+        // the bake is stale if any static light was added/removed/changed
+        GatherLights(mgr);
+        const uint64 lightsHash = ComputeLightsHash();
+        lights_.clear();
+
+        if ((lightsHash != header.lightsHash) || (ids.size() != bakedIds_.size()))
+        {
+            LogMsgf("light bake: %s is stale (static lights were changed)", path);
+            bakedIds_.clear();
+            return false;
+        }
+
+        wchar_t wPath[256]{ L'\0' };
+
+        for (int i = 0; i < NUM_VOLUMES; ++i)
+        {
+            snprintf(path, sizeof(path), "%s%s", dirPath, VOLUME_FILENAMES[i]);
+            StrHelper::StrToWide(path, wPath);
+
+            TexMetadata  metadata;
+            ScratchImage volume;
+            HRESULT      hr = LoadFromDDSFile(wPath, DDS_FLAGS_NONE, &metadata, volume);
+
+            if (FAILED(hr) ||
+                (metadata.dimension != TEX_DIMENSION_TEXTURE3D) ||
+                ((int)metadata.width  != header.dims[0]) ||
+                ((int)metadata.height != header.dims[1]) ||
+                ((int)metadata.depth  != header.dims[2]))
+            {
+                sprintf(g_String, "light bake: can't load a volume: %s", path);
+                LogErr(g_String);
+                Release();
+                return false;
+            }
+
+            hr = CreateShaderResourceView(pDevice, volume.GetImages(), volume.GetImageCount(), metadata, &pSRVs_[i]);
+            CAssert::NotFailed(hr, "can't create a SRV of the light bake volume");
+        }
+
+        boundsMin_  = header.boundsMin;
+        boundsMax_  = header.boundsMax;
+        normalBias_ = header.normalBias;
+        dims_[0]    = header.dims[0];
+        dims_[1]    = header.dims[1];
+        dims_[2]    = header.dims[2];
+
+        LogMsgf("light bake: %d static lights are loaded (%dx%dx%d voxels)",
+                (int)bakedIds_.size(), dims_[0], dims_[1], dims_[2]);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        Release();
+        return false;
+    }
+}
+
+
+// =================================================================================
+// private API
+// =================================================================================
+void LightBaker::GatherLights(ECS::EntityMgr& mgr)
+{
+    // lights of the bake are the active static point/spot lights
+
+    ECS::LightSystem&        lightSys  = mgr.lightSystem_;
+    const ECS::PointLights&  points    = lightSys.GetPointLights();
+    const ECS::SpotLights&   spots     = lightSys.GetSpotLights();
+    const cvector<EntityID>& staticIds = lightSys.GetStaticLights();
+
+    lights_.clear();
+    bakedIds_.clear();
+
+    for (const EntityID id : staticIds)
+    {
+        if (!lightSys.IsLightActive(id))
+            continue;
+
+        BakeLight light;
+        memset(&light, 0, sizeof(light));
+
+        const index pointIdx = points.sparseIdxs.GetIdx(id);
+        const index spotIdx  = spots.sparseIdxs.GetIdx(id);
+
+        if (pointIdx != SparseSet::INVALID_IDX)
+        {
+            const XMFLOAT4& a = points.ambient[pointIdx];
+            const XMFLOAT4& d = points.diffuse[pointIdx];
+
+            light.pos     = mgr.transformSystem_.GetPosition(id);
+            light.ambient = { a.x, a.y, a.z };
+            light.diffuse = { d.x, d.y, d.z };
+            light.att     = points.att[pointIdx];
+            light.range   = points.range[pointIdx];
+        }
+        else if (spotIdx != SparseSet::INVALID_IDX)
+        {
+            const XMFLOAT4& a   = spots.ambient[spotIdx];
+            const XMFLOAT4& d   = spots.diffuse[spotIdx];
+            const XMVECTOR  dir = XMVector3Normalize(mgr.transformSystem_.GetDirectionVec(id));
+
+            light.pos     = mgr.transformSystem_.GetPosition(id);
+            XMStoreFloat3(&light.dir, dir);
+            light.ambient = { a.x, a.y, a.z };
+            light.diffuse = { d.x, d.y, d.z };
+            light.att     = spots.att[spotIdx];
+            light.range   = spots.range[spotIdx];
+            light.spot    = spots.spot[spotIdx];
+            light.isSpot  = true;
+        }
+        else
+        {
+            continue;
+        }
+
+        if (light.range <= 0.0f)
+            continue;
+
+        // static ids are SORTED so the baked ones are SORTED as well
+        lights_.push_back(light);
+        bakedIds_.push_back(id);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void LightBaker::GatherOccluders(ECS::EntityMgr& mgr)
+{
+    // occluders are models of static entts (merged props are
+    // occluded by their cells so they aren't gathered twice)
+
+    cvector<EntityID> staticEntts;
+    cvector<XMMATRIX> worlds;
+    cvector<XMMATRIX> invWorlds;
+
+    mgr.renderSystem_.GetStaticEntts(staticEntts);
+    occluders_.clear();
+
+    if (staticEntts.empty())
+        return;
+
+    mgr.transformSystem_.GetWorlds(staticEntts.data(), staticEntts.size(), worlds);
+    mgr.transformSystem_.GetInverseWorlds(staticEntts.data(), staticEntts.size(), invWorlds);
+
+    occluders_.reserve(staticEntts.size());
+
+    for (index i = 0; i < staticEntts.size(); ++i)
+    {
+        const EntityID id = staticEntts[i];
+
+        if (mgr.renderSystem_.GetMergedInto(id) != INVALID_ENTITY_ID)
+            continue;
+
+        const ModelID modelID = mgr.modelSystem_.GetModelIdRelatedToEntt(id);
+
+        if (modelID == INVALID_MODEL_ID)
+            continue;
+
+        const BasicModel& model = g_ModelMgr.GetModelByID(modelID);
+
+        if ((model.type_ == eModelType::Terrain) || model.bvh_.IsEmpty() || (model.vertices_ == nullptr))
+            continue;
+
+        BoundingBox worldAABB;
+        model.GetModelAABB().Transform(worldAABB, worlds[i]);
+
+        const XMFLOAT3& c = worldAABB.Center;
+        const XMFLOAT3& e = worldAABB.Extents;
+
+        // only occluders which are inside the volume can shadow its voxels
+        if ((c.x + e.x < boundsMin_.x) || (c.x - e.x > boundsMax_.x) ||
+            (c.y + e.y < boundsMin_.y) || (c.y - e.y > boundsMax_.y) ||
+            (c.z + e.z < boundsMin_.z) || (c.z - e.z > boundsMax_.z))
+            continue;
+
+        Occluder occ;
+        occ.invWorld = invWorlds[i];
+        occ.minP     = { c.x - e.x, c.y - e.y, c.z - e.z };
+        occ.maxP     = { c.x + e.x, c.y + e.y, c.z + e.z };
+        occ.pModel   = &model;
+
+        occluders_.push_back(occ);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void LightBaker::ComputeBounds(const LightBakeParams& params)
+{
+    // the volume is the union of the range spheres of the lights
+
+    boundsMin_ = { +FLT_MAX, +FLT_MAX, +FLT_MAX };
+    boundsMax_ = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    for (const BakeLight& light : lights_)
+    {
+        boundsMin_.x = std::min(boundsMin_.x, light.pos.x - light.range);
+        boundsMin_.y = std::min(boundsMin_.y, light.pos.y - light.range);
+        boundsMin_.z = std::min(boundsMin_.z, light.pos.z - light.range);
+
+        boundsMax_.x = std::max(boundsMax_.x, light.pos.x + light.range);
+        boundsMax_.y = std::max(boundsMax_.y, light.pos.y + light.range);
+        boundsMax_.z = std::max(boundsMax_.z, light.pos.z + light.range);
+    }
+
+    dims_[0] = ComputeDim(boundsMax_.x - boundsMin_.x, params.cellSize, params.maxDim);
+    dims_[1] = ComputeDim(boundsMax_.y - boundsMin_.y, params.cellSize, params.maxDim);
+    dims_[2] = ComputeDim(boundsMax_.z - boundsMin_.z, params.cellSize, params.maxDim);
+
+    // the bias is by the biggest side of a voxel so a sample point leaves its voxel by any axis
+    const float voxelSize = std::max(
+        std::max((boundsMax_.x - boundsMin_.x) / dims_[0], (boundsMax_.y - boundsMin_.y) / dims_[1]),
+        (boundsMax_.z - boundsMin_.z) / dims_[2]);
+
+    normalBias_ = params.normalBias * voxelSize;
+}
+
+///////////////////////////////////////////////////////////
+
+uint64 LightBaker::ComputeLightsHash() const
+{
+    // a hash of all the props of the baked lights (field by field:
+    // the padding of the structure isn't hashed)
+
+    uint64 hash = 14695981039346656037ull;
+
+    for (index i = 0; i < lights_.size(); ++i)
+    {
+        const BakeLight& l = lights_[i];
+
+        hash = HashBytes(hash, &bakedIds_[i], sizeof(EntityID));
+        hash = HashBytes(hash, &l.pos,        sizeof(l.pos));
+        hash = HashBytes(hash, &l.dir,        sizeof(l.dir));
+        hash = HashBytes(hash, &l.ambient,    sizeof(l.ambient));
+        hash = HashBytes(hash, &l.diffuse,    sizeof(l.diffuse));
+        hash = HashBytes(hash, &l.att,        sizeof(l.att));
+        hash = HashBytes(hash, &l.range,      sizeof(l.range));
+        hash = HashBytes(hash, &l.spot,       sizeof(l.spot));
+        hash = HashBytes(hash, &l.isSpot,     sizeof(l.isSpot));
+    }
+
+    return hash;
+}
+
+///////////////////////////////////////////////////////////
+
+void LightBaker::BakeVoxel(
+    const XMFLOAT3& p,
+    float* outDiffuse,
+    float* outAmbient,
+    float* outDir,
+    uint64& inOutNumRays) const
+{
+    // sum lights which reach the point (by the same attenuation as in LightHelper.hlsli)
+
+    XMFLOAT3 diffuse = { 0,0,0 };
+    XMFLOAT3 ambient = { 0,0,0 };
+    XMFLOAT3 dir     = { 0,0,0 };
+    float    sumLum  = 0;
+
+    for (int i = 0; i < (int)lights_.size(); ++i)
+    {
+        const BakeLight& light = lights_[i];
+
+        XMFLOAT3    L      = { light.pos.x - p.x, light.pos.y - p.y, light.pos.z - p.z };
+        const float distSq = L.x*L.x + L.y*L.y + L.z*L.z;
+
+        if ((distSq > light.range * light.range) || (distSq < 1e-8f))
+            continue;
+
+        const float dist    = sqrtf(distSq);
+        const float invDist = 1.0f / dist;
+
+        L.x *= invDist;
+        L.y *= invDist;
+        L.z *= invDist;
+
+        float att = 0;
+
+        if (light.isSpot)
+        {
+            const float cosA = std::max(-(L.x*light.dir.x + L.y*light.dir.y + L.z*light.dir.z), 0.0f);
+            const float spot = powf(cosA, light.spot);
+
+            att = spot * (light.att.x + light.att.y * invDist + light.att.z * invDist * invDist);
+        }
+        else
+        {
+            const float denom = light.att.x + light.att.y * dist + light.att.z * distSq;
+            att = (denom > 0.0f) ? 1.0f / denom : 0.0f;
+        }
+
+        if (att <= 0.0f)
+            continue;
+
+        // the ambient isn't shadowed (as by the light shader)
+        ambient.x += light.ambient.x * att;
+        ambient.y += light.ambient.y * att;
+        ambient.z += light.ambient.z * att;
+
+        const float lum = (0.2126f * light.diffuse.x + 0.7152f * light.diffuse.y + 0.0722f * light.diffuse.z) * att;
+
+        if (lum <= 0.0f)
+            continue;
+
+        ++inOutNumRays;
+
+        if (IsOccluded(i, p, L, dist))
+            continue;
+
+        diffuse.x += light.diffuse.x * att;
+        diffuse.y += light.diffuse.y * att;
+        diffuse.z += light.diffuse.z * att;
+
+        dir.x  += L.x * lum;
+        dir.y  += L.y * lum;
+        dir.z  += L.z * lum;
+        sumLum += lum;
+    }
+
+    // the mean direction: its length tells how much the light is directional
+    const float invLum = (sumLum > 0.0f) ? 1.0f / sumLum : 0.0f;
+
+    outDiffuse[0] = diffuse.x;
+    outDiffuse[1] = diffuse.y;
+    outDiffuse[2] = diffuse.z;
+    outDiffuse[3] = 1.0f;
+
+    outAmbient[0] = ambient.x;
+    outAmbient[1] = ambient.y;
+    outAmbient[2] = ambient.z;
+    outAmbient[3] = 1.0f;
+
+    outDir[0] = dir.x * invLum;
+    outDir[1] = dir.y * invLum;
+    outDir[2] = dir.z * invLum;
+    outDir[3] = 1.0f;
+}
+
+///////////////////////////////////////////////////////////
+
+bool LightBaker::IsOccluded(
+    const int lightIdx,
+    const XMFLOAT3& origin,
+    const XMFLOAT3& dir,
+    const float dist) const
+{
+    // is the segment from the origin to the light crossed by any occluder of the light?
+    // (the BVH query is const and has its stack on the call stack so it is thread-safe)
+
+    const XMFLOAT3 invDir  = { 1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z };
+    const XMVECTOR rayPos  = XMVectorSet(origin.x, origin.y, origin.z, 1.0f);
+    const XMVECTOR rayDir  = XMVectorSet(dir.x, dir.y, dir.z, 0.0f);
+    const float    maxDist = dist * 0.999f;
+
+    const int start = lightOccludersStart_[lightIdx];
+    const int end   = lightOccludersStart_[lightIdx + 1];
+
+    for (int i = start; i < end; ++i)
+    {
+        const Occluder& occ = occluders_[lightOccluders_[i]];
+
+        // slab test of the world AABB
+        const float tx0 = (occ.minP.x - origin.x) * invDir.x;
+        const float tx1 = (occ.maxP.x - origin.x) * invDir.x;
+        const float ty0 = (occ.minP.y - origin.y) * invDir.y;
+        const float ty1 = (occ.maxP.y - origin.y) * invDir.y;
+        const float tz0 = (occ.minP.z - origin.z) * invDir.z;
+        const float tz1 = (occ.maxP.z - origin.z) * invDir.z;
+
+        const float tmin = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::min(tz0, tz1));
+        const float tmax = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1));
+
+        if ((tmax < tmin) || (tmax < 0.0f) || (tmin > maxDist))
+            continue;
+
+        // the direction isn't normalized in model space so distances are still in world units
+        XMFLOAT3 localOrigin;
+        XMFLOAT3 localDir;
+        XMStoreFloat3(&localOrigin, XMVector3TransformCoord(rayPos, occ.invWorld));
+        XMStoreFloat3(&localDir,    XMVector3TransformNormal(rayDir, occ.invWorld));
+
+        float  hitDist = maxDist;
+        uint32 tri     = 0;
+
+        if (occ.pModel->bvh_.Intersect(occ.pModel->vertices_, localOrigin, localDir, hitDist, tri))
+            return true;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+bool LightBaker::SaveHeader(const char* path) const
+{
+    StaticLightsHeader header;
+    header.dims[0]    = dims_[0];
+    header.dims[1]    = dims_[1];
+    header.dims[2]    = dims_[2];
+    header.boundsMin  = boundsMin_;
+    header.boundsMax  = boundsMax_;
+    header.normalBias = normalBias_;
+    header.lightsHash = ComputeLightsHash();
+    header.numLights  = (uint32)bakedIds_.size();
+
+    FILE* pFile = fopen(path, "wb");
+
+    if (!pFile)
+        return false;
+
+    bool result = true;
+    result &= (fwrite(&header, sizeof(header), 1, pFile) == 1);
+    result &= (fwrite(bakedIds_.data(), sizeof(EntityID), bakedIds_.size(), pFile) == (size_t)bakedIds_.size());
+
+    fclose(pFile);
+    return result;
+}
+
+///////////////////////////////////////////////////////////
+
+bool LightBaker::LoadHeader(const char* path, StaticLightsHeader& outHeader, cvector<EntityID>& outIds)
+{
+    FILE* pFile = fopen(path, "rb");
+
+    // there is no bake yet
+    if (!pFile)
+        return false;
+
+    bool result = (fread(&outHeader, sizeof(outHeader), 1, pFile) == 1);
+
+    result &= (outHeader.magic   == HEADER_MAGIC);
+    result &= (outHeader.version == BAKE_VERSION);
+    result &= (outHeader.dims[0] > 0) && (outHeader.dims[1] > 0) && (outHeader.dims[2] > 0);
+
+    if (result)
+    {
+        outIds.resize(outHeader.numLights);
+        result &= (fread(outIds.data(), sizeof(EntityID), outIds.size(), pFile) == (size_t)outIds.size());
+    }
+
+    fclose(pFile);
+
+    if (!result)
+    {
+        sprintf(g_String, "light bake: invalid or old header: %s", path);
+        LogErr(g_String);
+    }
+
+    return result;
+}
+
+} // namespace Core
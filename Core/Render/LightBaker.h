@@ -0,0 +1,162 @@
+// =================================================================================
+// Filename:     LightBaker.h
+// Description:  an offline baker of static point/spot lights (see LightSystem::SetStatic)
+//               into a world-space light volume (a 3D lightmap) over their ranges:
+//
+//               - each voxel keeps the sum of the diffuse colors of lights which
+//                 reach its center (attenuated as by the light shader and shadowed
+//                 by models of static entts), the sum of their ambient colors and
+//                 the mean direction to them (weighted by the luminance) so the
+//                 runtime restores N dot L for mostly single-light areas;
+//               - voxels are baked on all the worker threads (a job per row);
+//               - volumes are compressed into BC6H (on GPU if it is possible) and
+//                 stored as DDS files + a header with the bounds and the hash of the
+//                 baked lights; the bake is reused until the static lights change
+//
+//               baked lights aren't put into the light clusters so per-pixel loops
+//               go only over dynamic lights (see StaticLights.hlsli)
+//
+//               NOTE: only the diffuse and ambient of static lights are baked (their
+//                     specular is dropped), and the terrain doesn't cast shadows
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace ECS
+{
+class EntityMgr;
+}
+
+
+namespace Core
+{
+
+class BasicModel;
+struct StaticLightsHeader;
+
+struct LightBakeParams
+{
+    float cellSize   = 1.0f;                 // the min size of a voxel (by each axis)
+    int   maxDim     = 128;                  // max voxels by each axis (voxels are bigger for big volumes)
+    float normalBias = 0.5f;                 // in voxels: how far a sample point is pushed out of the surface
+    bool  isShadows  = true;                 // static models cast shadows
+};
+
+///////////////////////////////////////////////////////////
+
+struct LightBakeStats
+{
+    int    dims[3]      = { 0,0,0 };
+    int    numLights    = 0;
+    int    numOccluders = 0;
+    uint64 numRays      = 0;                 // shadow rays (tested against the occluders)
+    float  bakeTimeMs   = 0;                 // without the compression
+};
+
+///////////////////////////////////////////////////////////
+
+class LightBaker
+{
+public:
+    static constexpr uint32 BAKE_VERSION = 1;
+    static constexpr int    NUM_VOLUMES  = 3;       // diffuse, ambient, direction
+
+    LightBaker() {}
+    ~LightBaker();
+
+    // restrict a copying of this class instance
+    LightBaker(const LightBaker&) = delete;
+    LightBaker& operator=(const LightBaker&) = delete;
+
+    // bake all the static lights of the scene and store the result into dirPath;
+    // return false if there are no static lights or it is failed
+    bool Bake(
+        ID3D11Device* pDevice,
+        ECS::EntityMgr& mgr,
+        const LightBakeParams& params,
+        const char* dirPath);
+
+    // load a bake from dirPath; return false if there is no bake or
+    // it is stale (static lights were changed since the bake)
+    bool Load(ID3D11Device* pDevice, ECS::EntityMgr& mgr, const char* dirPath);
+
+    void Release();
+
+    inline bool HasVolume() const { return pSRVs_[0] != nullptr; }
+    inline bool IsBaked(const EntityID id) const { return bakedIds_.binary_search(id); }
+
+    inline ID3D11ShaderResourceView* const* GetSRVs()        const { return pSRVs_; }
+    inline const DirectX::XMFLOAT3&         GetBoundsMin()   const { return boundsMin_; }
+    inline const DirectX::XMFLOAT3&         GetBoundsMax()   const { return boundsMax_; }
+    inline float                            GetNormalBias()  const { return normalBias_; }
+    inline const cvector<EntityID>&         GetBakedLights() const { return bakedIds_; }
+    inline const LightBakeStats&            GetStats()       const { return stats_; }
+
+private:
+    struct BakeLight
+    {
+        DirectX::XMFLOAT3 pos;
+        DirectX::XMFLOAT3 dir;               // spotlight: the direction of the cone
+        DirectX::XMFLOAT3 ambient;
+        DirectX::XMFLOAT3 diffuse;
+        DirectX::XMFLOAT3 att;               // (A0, A1, A2)
+        float             range;
+        float             spot;              // 0 - a point light
+        bool              isSpot;
+    };
+
+    struct Occluder
+    {
+        DirectX::XMMATRIX invWorld;
+        DirectX::XMFLOAT3 minP;              // world AABB
+        DirectX::XMFLOAT3 maxP;
+        const BasicModel* pModel;
+    };
+
+    void GatherLights   (ECS::EntityMgr& mgr);
+    void GatherOccluders(ECS::EntityMgr& mgr);
+    void ComputeBounds  (const LightBakeParams& params);
+
+    uint64 ComputeLightsHash() const;
+
+    void BakeVoxel(
+        const DirectX::XMFLOAT3& p,
+        float* outDiffuse,
+        float* outAmbient,
+        float* outDir,
+        uint64& inOutNumRays) const;
+
+    bool IsOccluded(
+        const int lightIdx,
+        const DirectX::XMFLOAT3& origin,
+        const DirectX::XMFLOAT3& dir,
+        const float dist) const;
+
+    bool SaveHeader(const char* path) const;
+    bool LoadHeader(const char* path, StaticLightsHeader& outHeader, cvector<EntityID>& outIds);
+
+private:
+    ID3D11ShaderResourceView* pSRVs_[NUM_VOLUMES] = { nullptr, nullptr, nullptr };
+
+    DirectX::XMFLOAT3  boundsMin_  = { 0,0,0 };
+    DirectX::XMFLOAT3  boundsMax_  = { 0,0,0 };
+    float              normalBias_ = 0;          // in world units
+    int                dims_[3]    = { 0,0,0 };
+    cvector<EntityID>  bakedIds_;                // SORTED
+    LightBakeStats     stats_;
+
+    // transient data of the bake
+    cvector<BakeLight> lights_;                  // by order of bakedIds_
+    cvector<Occluder>  occluders_;
+    cvector<int>       lightOccludersStart_;     // occluders of the light i: lightOccluders_[start[i], start[i+1])
+    cvector<int>       lightOccluders_;
+};
+
+} // namespace Core
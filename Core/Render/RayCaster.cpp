@@ -0,0 +1,118 @@
+// =================================================================================
+// Filename:     RayCaster.cpp
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "RayCaster.h"
+#include "../Model/ModelMgr.h"
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+bool RayCaster::Cast(
+    ECS::EntityMgr& mgr,
+    const XMFLOAT3& origin,
+    const XMFLOAT3& dir,
+    const float maxDist,
+    RayHit& outHit,
+    const EntityID ignoreID)
+{
+    candIds_.clear();
+    candDists_.clear();
+
+    mgr.boundingSystem_.QueryRay(origin, dir, maxDist, candIds_, candDists_);
+
+    if (candIds_.empty())
+        return false;
+
+    // test candidates from the closest one
+    candOrder_.resize(candIds_.size());
+
+    for (index i = 0; i < candOrder_.size(); ++i)
+        candOrder_[i] = i;
+
+    std::sort(candOrder_.begin(), candOrder_.end(), [this](const index a, const index b)
+    {
+        return candDists_[a] < candDists_[b];
+    });
+
+    const XMVECTOR rayOrigin = XMVectorSet(origin.x, origin.y, origin.z, 1.0f);
+    const XMVECTOR rayDir    = XMVectorSet(dir.x, dir.y, dir.z, 0.0f);
+
+    float closestDist = maxDist;
+    bool  isHit       = false;
+
+    for (const index i : candOrder_)
+    {
+        // all the rest bounds are farther than the found hit
+        if (candDists_[i] > closestDist)
+            break;
+
+        const EntityID id = candIds_[i];
+
+        if (id == ignoreID)
+            continue;
+
+        const ModelID     modelID = mgr.modelSystem_.GetModelIdRelatedToEntt(id);
+        const BasicModel& model   = g_ModelMgr.GetModelByID(modelID);
+
+        if ((model.type_ == eModelType::Terrain) || model.bvh_.IsEmpty())
+            continue;
+
+        // transform the ray into model space; the direction isn't normalized
+        // so distances along it are still in world units
+        const XMMATRIX& invWorld = mgr.transformSystem_.GetInverseWorld(id);
+
+        XMFLOAT3 localOrigin;
+        XMFLOAT3 localDir;
+        XMStoreFloat3(&localOrigin, XMVector3TransformCoord(rayOrigin, invWorld));
+        XMStoreFloat3(&localDir,    XMVector3TransformNormal(rayDir, invWorld));
+
+        float  dist = closestDist;
+        uint32 tri  = 0;
+
+        if (model.bvh_.Intersect(model.vertices_, localOrigin, localDir, dist, tri))
+        {
+            closestDist        = dist;
+            isHit              = true;
+            outHit.enttID      = id;
+            outHit.triangleIdx = tri;
+            outHit.dist        = dist;
+        }
+    }
+
+    if (isHit)
+    {
+        outHit.pos.x = origin.x + dir.x * closestDist;
+        outHit.pos.y = origin.y + dir.y * closestDist;
+        outHit.pos.z = origin.z + dir.z * closestDist;
+    }
+
+    return isHit;
+}
+
+///////////////////////////////////////////////////////////
+
+bool RayCaster::HasLineOfSight(
+    ECS::EntityMgr& mgr,
+    const XMFLOAT3& from,
+    const XMFLOAT3& to,
+    const EntityID ignoreID)
+{
+    const XMFLOAT3 delta = { to.x - from.x, to.y - from.y, to.z - from.z };
+    const float    dist  = sqrtf(delta.x*delta.x + delta.y*delta.y + delta.z*delta.z);
+
+    if (dist < 0.0001f)
+        return true;
+
+    const float    invDist = 1.0f / dist;
+    const XMFLOAT3 dir     = { delta.x * invDist, delta.y * invDist, delta.z * invDist };
+
+    RayHit hit;
+    return !Cast(mgr, from, dir, dist, hit, ignoreID);
+}
+
+} // namespace Core
@@ -0,0 +1,64 @@
+// =================================================================================
+// Filename:     RayCaster.h
+// Description:  scene-level ray queries (picking, line of sight, hitscan):
+//
+//               - the entity AABB tree gives entts whose bounds are hit by the ray;
+//               - they are tested in order of distance to their bounds so the rest
+//                 are rejected as soon as a closer triangle hit is found;
+//               - each candidate is tested by the triangle BVH of its model
+//                 (in model space, distances stay in world units)
+//
+//               NOTE: the terrain isn't tested (it has no triangle BVH)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <DirectXMath.h>
+#include "Entity/EntityMgr.h"
+
+
+namespace Core
+{
+
+struct RayHit
+{
+    EntityID          enttID      = INVALID_ENTITY_ID;
+    uint32            triangleIdx = 0;             // idx of the triangle in the model's LOD 0 indices
+    float             dist        = 0.0f;          // along the ray from its origin
+    DirectX::XMFLOAT3 pos         = { 0,0,0 };     // world space
+};
+
+///////////////////////////////////////////////////////////
+
+class RayCaster
+{
+public:
+    RayCaster() {}
+
+    // find the closest entt hit by the ray (in world space);
+    // NOTE: dir must be unit length
+    bool Cast(
+        ECS::EntityMgr& mgr,
+        const DirectX::XMFLOAT3& origin,
+        const DirectX::XMFLOAT3& dir,
+        const float maxDist,
+        RayHit& outHit,
+        const EntityID ignoreID = INVALID_ENTITY_ID);
+
+    // check if there is no any entt between two points
+    bool HasLineOfSight(
+        ECS::EntityMgr& mgr,
+        const DirectX::XMFLOAT3& from,
+        const DirectX::XMFLOAT3& to,
+        const EntityID ignoreID = INVALID_ENTITY_ID);
+
+private:
+    cvector<EntityID> candIds_;
+    cvector<float>    candDists_;
+    cvector<index>    candOrder_;
+};
+
+} // namespace Core
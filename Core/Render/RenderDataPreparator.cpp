@@ -8,37 +8,55 @@
 #include "../Model/ModelMgr.h"
 #include "../Mesh/MaterialMgr.h"
 #include "../Texture/TextureMgr.h"
+#include <algorithm>
+#include <cfloat>
 
 
 namespace Core
 {
 
-RenderDataPreparator::RenderDataPreparator() :
-    textureSRVs_(1028, nullptr)
+RenderDataPreparator::RenderDataPreparator()
 {}
 
 ///////////////////////////////////////////////////////////
 
 void PrepareInstancesWorldMatrices(
     ECS::EntityMgr* pEnttMgr,
+    FrameArena& frameArena,
     const EntityID* enttsSortedByModels,
     const size numEntts,
     Render::InstBuffData& instanceBuffData,                 // data for the instances buffer
-    const cvector<Render::Instance>& instances)     // instances (models) data for rendering
+    cvector<Render::Instance>& instances,           // instances (models) data for rendering
+    const DirectX::XMFLOAT3& cameraPos)
 {
-    // prepare world matrix for each subset (mesh) of each entity
+    // prepare world matrix for each subset (mesh) of each entity;
+    // and set a distance to the nearest entt of each instance (for sorting of draws)
+
+    using namespace DirectX;
 
-    cvector<DirectX::XMMATRIX> worlds;
-    pEnttMgr->transformSystem_.GetWorlds(enttsSortedByModels, numEntts, worlds);
+    ArenaSpan<XMMATRIX> worlds = frameArena.Alloc<XMMATRIX>(numEntts);
+    pEnttMgr->transformSystem_.GetRenderWorlds(enttsSortedByModels, numEntts, worlds.data());
 
-    for (int worldIdx = 0, i = 0; const Render::Instance & instance : instances)
+    const XMVECTOR camPos = XMLoadFloat3(&cameraPos);
+
+    for (int worldIdx = 0, i = 0; Render::Instance& instance : instances)
     {
         // currently: set the same world matrix for each subset (mesh) of the entity
         for (int subsetIdx = 0; subsetIdx < instance.subsets.size(); ++subsetIdx)
         {
-            memcpy(&(instanceBuffData.worlds_[i]), &(worlds[worldIdx]), sizeof(DirectX::XMMATRIX) * instance.numInstances);
+            memcpy(&(instanceBuffData.worlds_[i]), &(worlds[worldIdx]), sizeof(XMMATRIX) * instance.numInstances);
             i += instance.numInstances;
         }
+
+        float minSqrDist = 0.0f;
+
+        for (int j = 0; j < instance.numInstances; ++j)
+        {
+            const float sqrDist = XMVectorGetX(XMVector3LengthSq(worlds[worldIdx + j].r[3] - camPos));
+            minSqrDist = (j == 0 || sqrDist < minSqrDist) ? sqrDist : minSqrDist;
+        }
+
+        instance.depth = sqrtf(minSqrDist);
         worldIdx += instance.numInstances;
     }
 }
@@ -47,6 +65,7 @@ void PrepareInstancesWorldMatrices(
 
 void PrepareInstancesTextureTransformations(
     ECS::EntityMgr* pEnttMgr,
+    FrameArena& frameArena,
     const EntityID* enttsSortedByModels,
     const size numEntts,
     Render::InstBuffData& instanceBuffData,         // data for the instances buffer
@@ -54,12 +73,12 @@ void PrepareInstancesTextureTransformations(
 {
     // prepare texture transformation matrix for each subset (mesh) of each entity
 
-    cvector<DirectX::XMMATRIX> enttsTexTransforms;
+    ArenaSpan<DirectX::XMMATRIX> enttsTexTransforms = frameArena.Alloc<DirectX::XMMATRIX>(numEntts);
 
     pEnttMgr->texTransformSystem_.GetTexTransformsForEntts(
         enttsSortedByModels,
         numEntts,
-        enttsTexTransforms);
+        enttsTexTransforms.data());
 
     for (int transformIdx = 0, i = 0; const Render::Instance & instance : instances)
     {
@@ -75,14 +94,34 @@ void PrepareInstancesTextureTransformations(
     }
 }
 
+///////////////////////////////////////////////////////////
+
+void PrepareInstancesEnttIds(
+    const EntityID* enttsSortedByModels,
+    Render::InstBuffData& instanceBuffData,         // data for the instances buffer
+    const cvector<Render::Instance>& instances)     // instances (models) data for rendering
+{
+    // set entity ID for each subset (mesh) of each entity (for the entity IDs pass)
+
+    for (int enttIdx = 0, i = 0; const Render::Instance& instance : instances)
+    {
+        for (int subsetIdx = 0; subsetIdx < instance.subsets.size(); ++subsetIdx)
+        {
+            memcpy(&(instanceBuffData.enttIds_[i]), &(enttsSortedByModels[enttIdx]), sizeof(uint32_t) * instance.numInstances);
+            i += instance.numInstances;
+        }
+        enttIdx += instance.numInstances;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 void PrepareInstancesMaterials(
     Render::InstBuffData& instanceBuffData,
     const cvector<Render::Instance>& instances,
-    const cvector<Render::Material>& materialsSortedByInstances)
+    const cvector<uint32>& materialsSortedByInstances)
 {
     int materialIdx = 0;
-    //const Render::Material& mat : materialsSortedByInstances
-
 
     // for each instance
     for (int i = 0; const Render::Instance& instance : instances)
@@ -93,7 +132,7 @@ void PrepareInstancesMaterials(
             // set the same material numInstances times (arr of the same geometry and material)
             for (int j = 0; j < instance.numInstances; ++j)
             {
-                instanceBuffData.materials_[i++] = materialsSortedByInstances[materialIdx];
+                instanceBuffData.materialIdxs_[i++] = materialsSortedByInstances[materialIdx];
             }
             materialIdx++;
         }
@@ -106,8 +145,10 @@ void RenderDataPreparator::PrepareEnttsDataForRendering(
     const EntityID* enttsIds,
     const size numEntts,
     ECS::EntityMgr* pEnttMgr,
+    FrameArena& frameArena,                         // for transient data of this frame
     Render::InstBuffData& instanceBuffData,         // data for the instances buffer
-    cvector<Render::Instance>& instances)       // instances (models) data for rendering
+    cvector<Render::Instance>& instances,       // instances (models) data for rendering
+    const DirectX::XMFLOAT3& cameraPos)
 {
     // prepare instances data and instances buffer for rendering entities by input IDs;
 
@@ -115,8 +156,8 @@ void RenderDataPreparator::PrepareEnttsDataForRendering(
     CAssert::True(numEntts > 0,        "input number of entities must be > 0");
 
     // get data of models which are related to the input entts
-    cvector<EntityID>         enttsSortedByInstances;
-    cvector<Render::Material> materialsSortedByInstances;
+    cvector<EntityID> enttsSortedByInstances;
+    cvector<uint32>   materialsSortedByInstances;     // idxs into the GPU table of materials
 
     PrepareInstancesData(
         enttsIds,
@@ -138,19 +179,28 @@ void RenderDataPreparator::PrepareEnttsDataForRendering(
     // prepare world matrix for each mesh of each instance
     PrepareInstancesWorldMatrices(
         pEnttMgr,
+        frameArena,
         enttsSortedByInstances.data(),
         numEntts,
         instanceBuffData,
-        instances);
+        instances,
+        cameraPos);
 
     // prepate texture transformation for each mesh of each instance
     PrepareInstancesTextureTransformations(
         pEnttMgr,
+        frameArena,
         enttsSortedByInstances.data(),
         numEntts,
         instanceBuffData,
         instances);
 
+    // set entity ID for each mesh of each instance
+    PrepareInstancesEnttIds(
+        enttsSortedByInstances.data(),
+        instanceBuffData,
+        instances);
+
 #if 1
     PrepareInstancesMaterials(
         //pEnttMgr,
@@ -164,91 +214,358 @@ void RenderDataPreparator::PrepareEnttsDataForRendering(
 
 ///////////////////////////////////////////////////////////
 
-void RenderDataPreparator::PrepareEnttsBoundingLineBox(
+void RenderDataPreparator::PrepareGpuSceneData(
+    const EntityID* enttsIds,
+    const size numEntts,
     ECS::EntityMgr* pEnttMgr,
-    Render::Instance& instance,
-    Render::InstBuffData& instanceBuffer)
+    FrameArena& frameArena,
+    Render::InstBuffData& instanceBuffData,
+    cvector<Render::Instance>& instances,
+    cvector<Render::GpuInstanceBounds>& outBounds,
+    cvector<Render::GpuDraw>& outDraws,
+    cvector<Render::GpuCluster>& outClusters)
 {
-    // prepare data to render bounding box of each visible entity
-    // (BB of the whole model)
+    CAssert::True(enttsIds != nullptr, "input ptr to entities IDs arr == nullptr");
+    CAssert::True(numEntts > 0,        "input number of entities must be > 0");
 
-    assert(0 && "FIXME");
+    ECS::EntityMgr& mgr = *pEnttMgr;
 
-#if 0
-    ECS::EntityMgr&                 mgr = *pEnttMgr;
-    ECS::cvector<ModelID>           modelsIDs;
-    ECS::cvector<EntityID>          enttsSortByModels(numEntts);
-    ECS::cvector<size>              numInstancesPerModel;
-    ECS::cvector<DirectX::XMMATRIX> boxLocals;         // local space matrix of the AABB of the whole model
-    ECS::cvector<DirectX::XMMATRIX> worlds;            // world matrix of each visible entity
+    // all the entts go by LOD 0 so there is a single instance per model
+    // (or per entt with unique materials); LODs become separate draws
+    cvector<uint8> lods(numEntts, 0);
+    mgr.renderSystem_.SetLods(enttsIds, lods.data(), numEntts);
 
+    cvector<EntityID> enttsSortedByInstances;
+    cvector<uint32>   materialsSortedByInstances;
 
-    mgr.modelSystem_.GetModelsIdsRelatedToEntts(
-        visibleEntts,
+    PrepareInstancesData(
+        enttsIds,
         numEntts,
-        modelsIDs,
-        enttsSortByModels,
-        numInstancesPerModel);
-    
-    // get AABB of each visible model
-    ECS::cvector<DirectX::BoundingBox> modelsAABBs(std::ssize(modelsIDs));
+        pEnttMgr,
+        instances,
+        enttsSortedByInstances,
+        materialsSortedByInstances);
+
+    int numElems = 0;
+
+    for (const Render::Instance& instance : instances)
+        numElems += (instance.numInstances * (int)std::ssize(instance.subsets));
+
+    instanceBuffData.Resize(numElems);
 
-    for (int i = 0; const ModelID id : modelsIDs)
-        modelsAABBs[i++] = g_ModelMgr.GetModelByID(id).GetModelAABB();
+    // the camera position is used only for sorting of draws (they aren't sorted here)
+    PrepareInstancesWorldMatrices(pEnttMgr, frameArena, enttsSortedByInstances.data(), numEntts, instanceBuffData, instances, { 0,0,0 });
+    PrepareInstancesTextureTransformations(pEnttMgr, frameArena, enttsSortedByInstances.data(), numEntts, instanceBuffData, instances);
+    PrepareInstancesEnttIds(enttsSortedByInstances.data(), instanceBuffData, instances);
+    PrepareInstancesMaterials(instanceBuffData, instances, materialsSortedByInstances);
 
-    // get world matrix for each entts and local space matrix by each model's AABB
-    mgr.transformSystem_.GetWorldMatricesOfEntts(enttsSortByModels.data(), numEntts, worlds);
-    mgr.boundingSystem_.GetBoxesLocalSpaceMatrices(modelsAABBs.data(), modelsAABBs.size(), boxLocals);
+    // world bounds of each entt
+    cvector<DirectX::BoundingSphere> spheres;
+    mgr.boundingSystem_.GetWorldBoundSpheres(enttsSortedByInstances.data(), numEntts, spheres);
 
-    // prepare instances buffer data
-    instance.numInstances = (int)numEntts;
-    instanceBuffer.Resize(instance.numInstances);
+    outBounds.resize(numElems);
+    outDraws.clear();
+    outClusters.clear();
 
-    // prepare world matrix for each bounding box to render
-    for (index i = 0, instIdx = 0; i < std::ssize(boxLocals); ++i)
+    for (int i = 0, enttIdx = 0, recIdx = 0; i < (int)instances.size(); ++i)
     {
-        for (index j = 0; j < numInstancesPerModel[i]; ++j, ++instIdx)
-            instanceBuffer.worlds_[instIdx] = boxLocals[i] * worlds[instIdx];
+        const Render::Instance& instance = instances[i];
+        const ModelID           modelID  = mgr.modelSystem_.GetModelIdRelatedToEntt(enttsSortedByInstances[enttIdx]);
+        const BasicModel&       model    = g_ModelMgr.GetModelByID(modelID);
+        const MeshGeometry&     meshes   = model.meshes_;
+        const int               numLods  = model.GetNumLods();
+
+        for (int subsetIdx = 0; subsetIdx < (int)instance.subsets.size(); ++subsetIdx)
+        {
+            const MeshGeometry::Subset& subset       = meshes.subsets_[subsetIdx];
+            const uint32                drawIdx      = (uint32)outDraws.size();
+            const uint32                clusterStart = (uint32)outClusters.size();
+            const uint32                numClusters  = subset.meshletCount;
+
+            Render::GpuDraw draw;
+            draw.baseVertex  = (INT)instance.subsets[subsetIdx].vertexStart;
+            draw.instanceIdx = i;
+            draw.subsetIdx   = subsetIdx;
+
+            // LOD 0 of a big subset is drawn by its meshlets (each one is culled separately)
+            for (uint32 m = 0; m < numClusters; ++m)
+            {
+                const Meshlet& meshlet = model.meshlets_[subset.meshletStart + m];
+
+                draw.indexCount = meshlet.indexCount;
+                draw.startIndex = meshlet.indexStart + meshes.GetBaseIndex();
+                outDraws.push_back(draw);
+
+                Render::GpuCluster cluster;
+                cluster.center     = meshlet.center;
+                cluster.radius     = meshlet.radius;
+                cluster.coneAxis   = meshlet.coneAxis;
+                cluster.coneCutoff = meshlet.coneCutoff;
+                outClusters.push_back(cluster);
+            }
+
+            // a draw per each LOD of the subset
+            for (int lod = (numClusters > 0) ? 1 : 0; lod < numLods; ++lod)
+            {
+                draw.indexCount = subset.GetIndexCount(lod);
+                draw.startIndex = subset.GetIndexStart(lod) + meshes.GetBaseIndex();
+                outDraws.push_back(draw);
+            }
+
+            // records of this subset go by entts of the instance
+            for (int j = 0; j < instance.numInstances; ++j, ++recIdx)
+            {
+                const DirectX::BoundingSphere& sphere = spheres[enttIdx + j];
+                Render::GpuInstanceBounds&     bounds = outBounds[recIdx];
+
+                bounds.center       = sphere.Center;
+                bounds.radius       = sphere.Radius;
+                bounds.drawIdx      = drawIdx;
+                bounds.numLods      = (uint32)numLods;
+                bounds.clusterStart = clusterStart;
+                bounds.numClusters  = numClusters;
+            }
+        }
+
+        enttIdx += instance.numInstances;
     }
-#endif
 }
 
+
 ///////////////////////////////////////////////////////////
 
-void RenderDataPreparator::PrepareEnttsMeshesBoundingLineBox(
+void RenderDataPreparator::PrepareStaticBatchesData(
+    const EntityID* enttsIds,
+    const size numEntts,
     ECS::EntityMgr* pEnttMgr,
-    Render::Instance& instance,
-    Render::InstBuffData& instanceBuffer)
+    FrameArena& frameArena,
+    Render::InstBuffData& instanceBuffData,
+    StaticBatchesData& outData)
 {
-    // prepare data to render bounding box of each mesh of each visible entity
+    CAssert::True(enttsIds != nullptr, "input ptr to entities IDs arr == nullptr");
+    CAssert::True(numEntts > 0,        "input number of entities must be > 0");
 
-    assert(0 && "FIXME");
+    ECS::EntityMgr& mgr = *pEnttMgr;
+    outData.Clear();
 
-#if 0
-    CAssert::True(visibleEntts != nullptr, "input ptr to entities IDs arr == nullptr");
-    CAssert::True(numEntts > 0,            "input number of entts must be > 0");
-    
-    ECS::EntityMgr&    mgr = *pEnttMgr_;
-    ECS::cvector<size> numBoxesPerEntt;                     // how many boxes each entt has
-    ECS::cvector<DirectX::XMMATRIX> locals;                 // local space of each mesh of each entity
-    ECS::cvector<DirectX::XMMATRIX> worlds;                 // world matrix of each visible entity
+    // records are the same for each LOD so batches are made at LOD 0;
+    // LODs of entts are selected by the culling so they are restored then
+    cvector<uint8> currLods;
+    mgr.renderSystem_.GetLods(enttsIds, numEntts, currLods);
+
+    cvector<uint8> lods(numEntts, 0);
+    mgr.renderSystem_.SetLods(enttsIds, lods.data(), numEntts);
+
+    cvector<EntityID> enttsSortedByInstances;
+    cvector<uint32>   materialsSortedByInstances;
+
+    PrepareInstancesData(
+        enttsIds,
+        numEntts,
+        pEnttMgr,
+        outData.batches,
+        enttsSortedByInstances,
+        materialsSortedByInstances);
+
+    mgr.renderSystem_.SetLods(enttsIds, currLods.data(), numEntts);
+
+    int numElems = 0;
+
+    for (const Render::Instance& instance : outData.batches)
+        numElems += (instance.numInstances * (int)std::ssize(instance.subsets));
+
+    instanceBuffData.Resize(numElems);
+
+    PrepareInstancesWorldMatrices(pEnttMgr, frameArena, enttsSortedByInstances.data(), numEntts, instanceBuffData, outData.batches, { 0,0,0 });
+    PrepareInstancesTextureTransformations(pEnttMgr, frameArena, enttsSortedByInstances.data(), numEntts, instanceBuffData, outData.batches);
+    PrepareInstancesEnttIds(enttsSortedByInstances.data(), instanceBuffData, outData.batches);
+    PrepareInstancesMaterials(instanceBuffData, outData.batches, materialsSortedByInstances);
+
+    // where each batch starts in the records buffer
+    const size numBatches = outData.batches.size();
 
-    mgr.boundingSystem_.GetBoxLocalSpaceMatricesByIDs(visibleEntts, numEntts, numBoxesPerEntt, locals);
-    mgr.transformSystem_.GetWorldMatricesOfEntts(visibleEntts, numEntts, worlds);
+    outData.models.resize(numBatches);
+    outData.recordStarts.resize(numBatches);
 
-    // prepare instances buffer data
-    instance.numInstances = (int)std::ssize(locals);
-    instanceBuffer.Resize(instance.numInstances);
+    cvector<uint32> batchesSortedByInstances(numEntts);
+    cvector<uint32> slotsSortedByInstances(numEntts);
 
-    for (index instanceIdx = 0, i = 0; i < worlds.size(); ++i)
+    for (index i = 0, enttIdx = 0, recIdx = 0; i < numBatches; ++i)
     {
-        for (index idx = 0; idx < numBoxesPerEntt[i]; ++idx)
+        const Render::Instance& batch = outData.batches[i];
+
+        outData.models[i]       = mgr.modelSystem_.GetModelIdRelatedToEntt(enttsSortedByInstances[enttIdx]);
+        outData.recordStarts[i] = (uint32)recIdx;
+        recIdx += batch.numInstances * batch.subsets.size();
+
+        for (int j = 0; j < batch.numInstances; ++j, ++enttIdx)
         {
-            instanceBuffer.worlds_[instanceIdx] = locals[instanceIdx] * worlds[i];
-            ++instanceIdx;
+            batchesSortedByInstances[enttIdx] = (uint32)i;
+            slotsSortedByInstances[enttIdx]   = (uint32)j;
         }
     }
-#endif
+
+    // entts are sorted by IDs so their batches are found by binary search
+    cvector<index> order(numEntts);
+
+    for (index i = 0; i < numEntts; ++i)
+        order[i] = i;
+
+    std::sort(order.begin(), order.end(), [&](const index a, const index b)
+    {
+        return enttsSortedByInstances[a] < enttsSortedByInstances[b];
+    });
+
+    outData.entts.resize(numEntts);
+    outData.enttBatches.resize(numEntts);
+    outData.enttSlots.resize(numEntts);
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        outData.entts[i]       = enttsSortedByInstances[order[i]];
+        outData.enttBatches[i] = batchesSortedByInstances[order[i]];
+        outData.enttSlots[i]   = slotsSortedByInstances[order[i]];
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderDataPreparator::PrepareStaticInstancesForRendering(
+    const EntityID* visibleIds,
+    const size numEntts,
+    ECS::EntityMgr* pEnttMgr,
+    const StaticBatchesData& data,
+    cvector<Render::Instance>& outInstances,
+    cvector<uint32>& outRecordIdxs,
+    const DirectX::XMFLOAT3& cameraPos)
+{
+    // only the visibility list is made per frame: the instance of each
+    // (batch, LOD) pair is a copy of the batch with index ranges of the LOD
+
+    using namespace DirectX;
+
+    outInstances.clear();
+    outRecordIdxs.clear();
+
+    if ((numEntts == 0) || data.entts.empty())
+        return;
+
+    CAssert::True(visibleIds != nullptr, "input ptr to entities IDs arr == nullptr");
+
+    ECS::EntityMgr& mgr = *pEnttMgr;
+
+    cvector<uint8> lods;
+    mgr.renderSystem_.GetLods(visibleIds, numEntts, lods);
+
+    cvector<XMFLOAT3> positions;
+    mgr.transformSystem_.GetPositions(visibleIds, numEntts, positions);
+
+    // find the batch of each visible entt and count entts of each (batch, LOD) pair
+    const size numBatches = data.batches.size();
+
+    cvector<uint32> keys(numEntts);
+    cvector<uint32> slots(numEntts);
+    cvector<int>    counts(numBatches * MAX_NUM_MESH_LODS, 0);
+    size            numSorted = 0;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index idx = data.entts.get_idx(visibleIds[i]);
+
+        if ((idx < 0) || (data.entts[idx] != visibleIds[i]))
+        {
+            keys[i] = UINT32_MAX;
+            continue;
+        }
+
+        const uint32      batchIdx = data.enttBatches[idx];
+        const BasicModel& model    = g_ModelMgr.GetModelByID(data.models[batchIdx]);
+        const int         maxLod   = model.GetNumLods() - 1;
+        const int         lod      = (lods[i] < maxLod) ? lods[i] : maxLod;
+
+        keys[i]  = batchIdx * MAX_NUM_MESH_LODS + (uint32)lod;
+        slots[i] = data.enttSlots[idx];
+        counts[keys[i]]++;
+        ++numSorted;
+    }
+
+    if (numSorted == 0)
+        return;
+
+    // offsets of each (batch, LOD) pair in the sorted list and its instance
+    cvector<index> offsets(counts.size());
+    cvector<int>   instIdxs(counts.size(), -1);
+
+    for (index key = 0, offset = 0, instIdx = 0; key < counts.size(); ++key)
+    {
+        offsets[key] = offset;
+        offset += counts[key];
+
+        if (counts[key] == 0)
+            continue;
+
+        const index       batchIdx = key / MAX_NUM_MESH_LODS;
+        const int         lod      = (int)(key % MAX_NUM_MESH_LODS);
+        const BasicModel& model    = g_ModelMgr.GetModelByID(data.models[batchIdx]);
+        const MeshGeometry& meshes = model.meshes_;
+
+        outInstances.push_back(data.batches[batchIdx]);
+        Render::Instance& instance = outInstances.back();
+
+        for (index s = 0; s < instance.subsets.size(); ++s)
+        {
+            instance.subsets[s].indexStart = meshes.subsets_[s].GetIndexStart(lod) + meshes.GetBaseIndex();
+            instance.subsets[s].indexCount = meshes.subsets_[s].GetIndexCount(lod);
+        }
+
+        instance.numInstances = counts[key];
+        instance.depth        = FLT_MAX;
+        instance.lod          = (uint8)lod;
+        instIdxs[key]         = (int)instIdx++;
+    }
+
+    // sort visible entts by (batch, LOD) pairs; distance to the nearest one of
+    // each instance is used for sorting of draws
+    cvector<uint32> sortedSlots(numSorted);
+    cvector<uint32> sortedKeys(numSorted);
+    const XMVECTOR  camPos = XMLoadFloat3(&cameraPos);
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const uint32 key = keys[i];
+
+        if (key == UINT32_MAX)
+            continue;
+
+        const index pos = offsets[key]++;
+        sortedSlots[pos] = slots[i];
+        sortedKeys[pos]  = key;
+
+        Render::Instance& instance = outInstances[instIdxs[key]];
+        const float       dist     = XMVectorGetX(XMVector3Length(XMLoadFloat3(&positions[i]) - camPos));
+
+        instance.depth = (dist < instance.depth) ? dist : instance.depth;
+    }
+
+    // records of each instance go by subsets (the same as in the instances ring)
+    outRecordIdxs.reserve(numSorted * 2);
+
+    for (index i = 0; i < numSorted; )
+    {
+        const uint32            key      = sortedKeys[i];
+        const index             batchIdx = key / MAX_NUM_MESH_LODS;
+        const Render::Instance& batch    = data.batches[batchIdx];
+        const uint32            start    = data.recordStarts[batchIdx];
+        const index             count    = outInstances[instIdxs[key]].numInstances;
+
+        for (index s = 0; s < batch.subsets.size(); ++s)
+        {
+            for (index j = i; j < i + count; ++j)
+                outRecordIdxs.push_back(start + (uint32)s * batch.numInstances + sortedSlots[j]);
+        }
+
+        i += count;
+    }
 }
 
 
@@ -261,35 +578,32 @@ void RenderDataPreparator::PrepareInstancesData(
     ECS::EntityMgr* pEnttMgr,
     cvector<Render::Instance>& instances,
     cvector<EntityID>& outEnttsSortedByInstances,
-    cvector<Render::Material>& outMaterials)      // one material per mesh of each instance
+    cvector<uint32>& outMaterialIdxs)      // one material idx per mesh of each instance
 {
     CAssert::True(ids != nullptr, "input ptr to entities IDs arr == nullptr");
     CAssert::True(numEntts > 0,   "input number of entities must be > 0");
 
     // separate entities into 2 groups: entts with mesh based materials / with its unique materials
-    cvector<EntityID> enttsWithOrigMat;
-    cvector<EntityID> enttsWithUniqueMat;
-
     SeparateEnttsByMaterialGroups(
         *pEnttMgr,
         ids,
         numEntts,
-        enttsWithOrigMat,
-        enttsWithUniqueMat);
+        s_EnttsWithOrigMat,
+        s_EnttsWithUniqueMat);
 
     // prepare instances for entts which materials are based on model
     PrepareInstancesForEntts(
         *pEnttMgr,
-        enttsWithOrigMat.data(),
-        enttsWithOrigMat.size(),
+        s_EnttsWithOrigMat.data(),
+        s_EnttsWithOrigMat.size(),
         instances,
         outEnttsSortedByInstances);
 
     // prepare instances for entts which materials are unique per each entt
     PrepareInstancesForEnttsWithUniqueMaterials(
         *pEnttMgr,
-        enttsWithUniqueMat.data(),
-        enttsWithUniqueMat.size(),
+        s_EnttsWithUniqueMat.data(),
+        s_EnttsWithUniqueMat.size(),
         instances,
         outEnttsSortedByInstances);
 
@@ -299,7 +613,7 @@ void RenderDataPreparator::PrepareInstancesData(
 
     // prepare materials data for each instance
     for (int i = 0; Render::Instance& instance : instances)
-        PrepareMaterialForInstance(instance, outMaterials);
+        PrepareMaterialForInstance(instance, outMaterialIdxs);
 }
 
 ///////////////////////////////////////////////////////////
@@ -313,17 +627,19 @@ void RenderDataPreparator::SeparateEnttsByMaterialGroups(
 {
     // separate entities by entts with mesh based materials and unique materials
 
-    cvector<bool> materialsFlags;
+    cvector<bool>& materialsFlags = s_MaterialsFlags;
     mgr.materialSystem_.GetMaterialsFlagsByEntts(ids, numEntts, materialsFlags);
 
     // we expect that maybe all the entts has materials which are the same as its model and just a bit of entitites may have unique materials
+    outEnttsWithOrigMat.clear();
+    outEnttsWithUniqueMat.clear();
     outEnttsWithOrigMat.reserve(numEntts);
     outEnttsWithUniqueMat.reserve(8);
 
 #if 0
     LogMsg("list of entts BEFORE grouping: ", eConsoleColor::YELLOW);
     for (index i = 0; i < numEntts; ++i)
-        LogMsgf("entity [%s] [%d]", mgr.nameSystem_.GetNameById(ids[i]).c_str(), ids[i]);
+        LogMsgf("entity [%s] [%d]", mgr.nameSystem_.GetNameById(ids[i]), ids[i]);
 #endif
 
     // extract entts with materials based on model
@@ -345,11 +661,11 @@ void RenderDataPreparator::SeparateEnttsByMaterialGroups(
 
     LogErr("orig mat: ");
     for (const EntityID id : outEnttsWithOrigMat)
-        LogMsgf("entity [%s] [%d]", mgr.nameSystem_.GetNameById(id).c_str(), id);
+        LogMsgf("entity [%s] [%d]", mgr.nameSystem_.GetNameById(id), id);
 
     LogErr("unique mat: ");
     for (const EntityID id : outEnttsWithUniqueMat)
-        LogMsgf("entity [%s] [%d]", mgr.nameSystem_.GetNameById(id).c_str(), id);
+        LogMsgf("entity [%s] [%d]", mgr.nameSystem_.GetNameById(id), id);
 #endif
 }
 
@@ -371,9 +687,10 @@ void RenderDataPreparator::PrepareInstancesForEntts(
     if (numEntts == 0)
         return;
 
-    cvector<ModelID>  modelsIDs;
-    cvector<EntityID> enttsSortedByModels;
-    cvector<size>     numEnttsPerModel;
+    // entts are grouped by models with a single pass (see ModelSystem)
+    cvector<ModelID>&  modelsIDs           = s_ModelsIDs;
+    cvector<EntityID>& enttsSortedByModels = s_EnttsSortedByModels;
+    cvector<size>&     numEnttsPerModel    = s_NumEnttsPerModel;
 
     mgr.modelSystem_.GetModelsIdsRelatedToEntts(
         ids,
@@ -382,26 +699,67 @@ void RenderDataPreparator::PrepareInstancesForEntts(
         enttsSortedByModels,
         numEnttsPerModel);
 
-    const index startInstanceIdx = instances.size();
-    const size  numInstances = modelsIDs.size();
+    const size numModels = modelsIDs.size();
 
-    // store entities IDs which are sorted by models (by instances)
-    outEnttsSortedByInstances.append_vector(std::move(enttsSortedByModels));
+    // get pointers to models by its IDs
+    cvector<const BasicModel*>& models = s_Models;
+    g_ModelMgr.GetModelsByIDs(modelsIDs.data(), modelsIDs.size(), models);
+
+    // get levels of detail of entts (are selected during culling)
+    cvector<uint8>& lods = s_Lods;
+    mgr.renderSystem_.GetLods(enttsSortedByModels.data(), enttsSortedByModels.size(), lods);
+
+    // count entts of each (model, LOD) pair; one instance per each non-empty pair
+    cvector<int>& numEnttsPerLod = s_NumEnttsPerLod;
+    numEnttsPerLod.resize(numModels * MAX_NUM_MESH_LODS);
+    std::fill(numEnttsPerLod.begin(), numEnttsPerLod.end(), 0);
+    size numInstances = 0;
+
+    for (index j = 0, enttIdx = 0; j < numModels; ++j)
+    {
+        const int maxLod = models[j]->GetNumLods() - 1;
+        int* counts = numEnttsPerLod.data() + j * MAX_NUM_MESH_LODS;
+
+        for (index k = 0; k < numEnttsPerModel[j]; ++k, ++enttIdx)
+        {
+            const int lod = (lods[enttIdx] < maxLod) ? lods[enttIdx] : maxLod;
+            lods[enttIdx] = (uint8)lod;
+            counts[lod]++;
+        }
+
+        for (int lod = 0; lod <= maxLod; ++lod)
+            numInstances += (counts[lod] > 0);
+    }
+
+    // sort entts of each model by LODs (stable so the order inside of a batch is kept)
+    const index startInstanceIdx = instances.size();
+    const index startEnttIdx     = outEnttsSortedByInstances.size();
 
-    // update how many instances will we have at all
     instances.resize(instances.size() + numInstances);
+    outEnttsSortedByInstances.resize(startEnttIdx + numEntts);
 
-    // get pointers to models by its IDs
-    cvector<const BasicModel*> models;
-    g_ModelMgr.GetModelsByIDs(modelsIDs.data(), modelsIDs.size(), models);
+    for (index j = 0, enttIdx = 0, instIdx = startInstanceIdx, offset = startEnttIdx; j < numModels; ++j)
+    {
+        const int* counts = numEnttsPerLod.data() + j * MAX_NUM_MESH_LODS;
+        index lodOffsets[MAX_NUM_MESH_LODS];
 
-    // fill in particular instance with data of model
-    for (index i = startInstanceIdx, j = 0; j < numInstances; ++i, ++j)
-        PrepareInstanceData(*models[j], instances[i]);
+        for (int lod = 0; lod < MAX_NUM_MESH_LODS; ++lod)
+        {
+            lodOffsets[lod] = offset;
+            offset += counts[lod];
+
+            if (counts[lod] == 0)
+                continue;
+
+            // fill in particular instance with data of model and LOD
+            PrepareInstanceData(*models[j], instances[instIdx], lod);
+            instances[instIdx].numInstances = counts[lod];
+            ++instIdx;
+        }
 
-    // how many instances of this model will be rendered
-    for (index i = startInstanceIdx, j = 0; j < numInstances; ++i, ++j)
-        instances[i].numInstances = (int)numEnttsPerModel[j];
+        for (index k = 0; k < numEnttsPerModel[j]; ++k, ++enttIdx)
+            outEnttsSortedByInstances[lodOffsets[lods[enttIdx]]++] = enttsSortedByModels[enttIdx];
+    }
 }
 
 ///////////////////////////////////////////////////////////
@@ -453,14 +811,22 @@ void RenderDataPreparator::PrepareInstancesForEnttsWithUniqueMaterials(
     cvector<const BasicModel*> models;
     g_ModelMgr.GetModelsByIDs(modelsIDs.data(), modelsIDs.size(), models);
 
+    // get levels of detail of entts (are selected during culling)
+    cvector<uint8> lods;
+    mgr.renderSystem_.GetLods(
+        outEnttsSortedByInstances.data() + (outEnttsSortedByInstances.size() - numNewInstances),
+        numNewInstances,
+        lods);
+
     // fill in particular instance with data of model
-    for (index i = startInstanceIdx, modelIdx = 0; const size num : numEnttsPerInstance)
+    for (index i = startInstanceIdx, k = 0, modelIdx = 0; const size num : numEnttsPerInstance)
     {
-        for (index j = 0; j < num; ++j, ++i)
-        {
-            const BasicModel& model = *(models[modelIdx]);
-            PrepareInstanceData(model, instances[i]);
-        }
+        const BasicModel& model = *(models[modelIdx]);
+        const int maxLod = model.GetNumLods() - 1;
+
+        for (index j = 0; j < num; ++j, ++i, ++k)
+            PrepareInstanceData(model, instances[i], (lods[k] < maxLod) ? lods[k] : maxLod);
+
         ++modelIdx;
     }
 
@@ -469,12 +835,12 @@ void RenderDataPreparator::PrepareInstancesForEnttsWithUniqueMaterials(
         instances[i].numInstances = 1;
 
     // fill instances with material IDs of related entity (so later we will load textures using these IDs)
-    for (index i = startInstanceIdx; ECS::MaterialData& data : materialsDataPerEntt)
+    for (index i = startInstanceIdx; const ECS::MaterialData& data : materialsDataPerEntt)
     {
         const MaterialID* matsIDs = data.materialsIDs.data();
         const size        numIDs = data.materialsIDs.size();
 
-        std::move(matsIDs, matsIDs + numIDs, instances[i++].materialIDs.data());
+        std::copy(matsIDs, matsIDs + numIDs, instances[i++].materialIDs.data());
     }
 }
 
@@ -482,7 +848,8 @@ void RenderDataPreparator::PrepareInstancesForEnttsWithUniqueMaterials(
 
 void RenderDataPreparator::PrepareInstanceData(
     const BasicModel& model,
-    Render::Instance& instance)
+    Render::Instance& instance,
+    const int lod)
 {
     // fill in the rendering instance with input model data;
     // 
@@ -491,11 +858,17 @@ void RenderDataPreparator::PrepareInstanceData(
 
     strcpy(instance.name, model.name_);
 
-    // copy buffers data
+    // copy buffers data (if the geometry is in the shared pool
+    // the subsets ranges are offset within the pool's buffers)
     const MeshGeometry& meshes = model.meshes_;
-    instance.vertexStride = meshes.vb_.GetStride();
-    instance.pVB          = meshes.vb_.Get();
-    instance.pIB          = meshes.ib_.Get();
+    instance.vertexStride = meshes.vertexStride_;
+    instance.pVB          = meshes.GetVB();
+    instance.pIB          = meshes.GetIB();
+    instance.indexFormat  = meshes.GetIndexFormat();
+    instance.lod          = (uint8)lod;
+
+    const uint32 baseVertex = meshes.GetBaseVertex();
+    const uint32 baseIndex  = meshes.GetBaseIndex();
 
     // prepare data of each subset (mesh)
     const size numSubsets = model.GetNumSubsets();
@@ -513,10 +886,10 @@ void RenderDataPreparator::PrepareInstanceData(
         strcpy(dstSubset.name, srcSubset.name);
 
         // copy subset's vertex/index info
-        dstSubset.vertexStart = srcSubset.vertexStart;
+        dstSubset.vertexStart = srcSubset.vertexStart + baseVertex;
         dstSubset.vertexCount = srcSubset.vertexCount;
-        dstSubset.indexStart  = srcSubset.indexStart;
-        dstSubset.indexCount  = srcSubset.indexCount;
+        dstSubset.indexStart  = srcSubset.GetIndexStart(lod) + baseIndex;
+        dstSubset.indexCount  = srcSubset.GetIndexCount(lod);
     }
 
     // prepare material IDs
@@ -530,65 +903,142 @@ void RenderDataPreparator::PrepareInstanceData(
 
 void RenderDataPreparator::PrepareTexturesForInstance(Render::Instance& instance)
 {
-    // prepare textures for the instance which are based on original related model
+    // prepare textures for the instance which are based on original related model;
+    // they are resolved only once per a set of materials, later the cached table
+    // is just copied into the instance
 
-    
-    const size numSubsets = (int)instance.subsets.size();
+    const InstanceTexTable& table = GetTexTable(instance);
 
-    // prepare valid textures (SRVs) for this instance
-    //constexpr int     numElems = 180000;
-    
-    materials_.resize(numSubsets);
-    
-    // get materials data by materials IDs (one material per one subset)
-    g_MaterialMgr.GetMaterialsByIDs(instance.materialIDs.data(), numSubsets, materials_);
+    instance.texSRVs    = table.texSRVs;
+    instance.features   = table.features;
+    instance.packedTexs = table.packedTexs;
+}
 
-    // go through each material and store related textures IDs
-    for (index i = 0, texIdx = 0; i < numSubsets; ++i)
+///////////////////////////////////////////////////////////
+
+const InstanceTexTable& RenderDataPreparator::GetTexTable(const Render::Instance& instance)
+{
+    // get a resolved table of textures by material IDs of the instance's subsets;
+    // all the tables are dropped if any material or texture SRV is changed since
+    // the IDs are the same but what they refer to may be different
+
+    const uint32 matVersion  = g_MaterialMgr.GetTexturesVersion();
+    const uint32 srvsVersion = g_TextureMgr.GetSRVsVersion();
+
+    if ((matVersion != texTablesMatVersion_) || (srvsVersion != texTablesSRVsVersion_))
     {
-        for (index j = 0; j < NUM_TEXTURE_TYPES; ++j)
-        {
-            texturesIDs_[texIdx++] = materials_[i].textureIDs[j]; // TODO: memcpy
-        }
+        texTables_.clear();
+        texTablesMatVersion_  = matVersion;
+        texTablesSRVsVersion_ = srvsVersion;
+    }
+
+    // FNV-1a hash of the material IDs
+    const MaterialID* matIDs     = instance.materialIDs.data();
+    const size        numSubsets = instance.materialIDs.size();
+    uint64            hash       = 14695981039346656037ULL;
+
+    for (index i = 0; i < numSubsets; ++i)
+    {
+        hash ^= matIDs[i];
+        hash *= 1099511628211ULL;
     }
 
-    g_TextureMgr.GetSRVsByTexIDs(texturesIDs_, NUM_TEXTURE_TYPES * numSubsets, textureSRVs_);
+    InstanceTexTable& table = texTables_[hash];
 
-    // store texture SRVs into the instance
-    instance.texSRVs.resize(numSubsets * NUM_TEXTURE_TYPES);
+    const bool isResolved =
+        (table.materialIDs.size() == numSubsets) &&
+        (table.texSRVs.size() == numSubsets * NUM_TEXTURE_TYPES) &&
+        std::equal(matIDs, matIDs + numSubsets, table.materialIDs.begin());
 
-    for (index i = 0; i < NUM_TEXTURE_TYPES * numSubsets; ++i)
-        instance.texSRVs[i] = textureSRVs_[i];
+    // a new set of materials (or a collision: the table is replaced)
+    if (!isResolved)
+        ResolveTexTable(instance, table);
+
+    return table;
 }
 
 ///////////////////////////////////////////////////////////
 
-void RenderDataPreparator::PrepareMaterialForInstance(
+void RenderDataPreparator::ResolveTexTable(
     const Render::Instance& instance,
-    cvector<Render::Material>& outMaterials)
+    InstanceTexTable& outTable)
 {
-    // prepare one material data per each mesh of the input instance and
-    // push them back into the outMaterials array
+    // resolve SRVs of textures of each material of the instance's subsets and
+    // mark features of these subsets (to choose pixel shader variants)
 
-    const size numSubsets = (int)instance.subsets.size();
-    materials_.resize(numSubsets);
+    const size numSubsets = instance.materialIDs.size();
+    const size numTex     = numSubsets * NUM_TEXTURE_TYPES;
 
-    // prepare more memory for the materials
-    index outMatIdx = outMaterials.size();
-    const size numMaterials = outMatIdx + numSubsets;
-    outMaterials.resize(numMaterials);
+    outTable.materialIDs = instance.materialIDs;
+    texturesIDs_.resize(numTex);
 
-    // get materials data by materials IDs (one material per one subset)
-    g_MaterialMgr.GetMaterialsByIDs(instance.materialIDs.data(), numSubsets, materials_);
+    // go through each material and store related textures IDs
+    for (index i = 0; i < numSubsets; ++i)
+    {
+        const Material& mat = g_MaterialMgr.GetMaterialByID(instance.materialIDs[i]);
+        memcpy(texturesIDs_.data() + i * NUM_TEXTURE_TYPES, mat.textureIDs, sizeof(TexID) * NUM_TEXTURE_TYPES);
+    }
+
+    outTable.texSRVs.clear();
+
+    if (numTex > 0)
+    {
+        g_TextureMgr.GetSRVsByTexIDs(texturesIDs_.data(), numTex, textureSRVs_);
+        outTable.texSRVs.resize(numTex);
+        memcpy(outTable.texSRVs.data(), textureSRVs_.data(), sizeof(SRV*) * numTex);
+    }
+
+    outTable.features.resize(numSubsets);
 
-    // go through each material and convert it into the Render::Material
-    for (index i = 0; outMatIdx < numMaterials; ++outMatIdx, ++i)
+    for (index i = 0; i < numSubsets; ++i)
     {
-        outMaterials[outMatIdx].ambient_  = DirectX::XMFLOAT4(&materials_[i].ambient.x);
-        outMaterials[outMatIdx].diffuse_  = DirectX::XMFLOAT4(&materials_[i].diffuse.x);
-        outMaterials[outMatIdx].specular_ = DirectX::XMFLOAT4(&materials_[i].specular.x);
-        outMaterials[outMatIdx].reflect_  = DirectX::XMFLOAT4(&materials_[i].reflect.x);
+        const bool hasNormalMap = (texturesIDs_[i * NUM_TEXTURE_TYPES + TEX_TYPE_NORMALS] != INVALID_TEXTURE_ID);
+        outTable.features[i] = (hasNormalMap) ? Render::SUBSET_NORMAL_MAP : 0;
     }
+
+    // mark subsets which maps are sampled from the packed arrays
+    outTable.packedTexs.clear();
+
+    if ((packedDiffuseArrID_ == INVALID_TEXTURE_ID) && (packedNormalArrID_ == INVALID_TEXTURE_ID))
+        return;
+
+    outTable.packedTexs.resize(numSubsets);
+
+    for (index i = 0; i < numSubsets; ++i)
+    {
+        const TexID diffuseID = texturesIDs_[i * NUM_TEXTURE_TYPES + TEX_TYPE_DIFFUSE];
+        const TexID normalID  = texturesIDs_[i * NUM_TEXTURE_TYPES + TEX_TYPE_NORMALS];
+        uint8       packed    = 0;
+
+        if (g_TextureMgr.GetLayerInTexArr(packedDiffuseArrID_, diffuseID) >= 0)
+            packed |= Render::PACKED_TEX_DIFFUSE;
+
+        if (g_TextureMgr.GetLayerInTexArr(packedNormalArrID_, normalID) >= 0)
+            packed |= Render::PACKED_TEX_NORMAL;
+
+        outTable.packedTexs[i] = packed;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderDataPreparator::PrepareMaterialForInstance(
+    const Render::Instance& instance,
+    cvector<uint32>& outMaterialIdxs)
+{
+    // prepare one material idx per each mesh of the input instance and
+    // push them back into the outMaterialIdxs array;
+    // NOTE: colors of materials are stored in the GPU table (see CGraphics::UpdateMaterialsTable)
+    //       so here we only need idxs into this table
+
+    const size numSubsets = (int)instance.subsets.size();
+
+    // prepare more memory for the idxs
+    index outMatIdx = outMaterialIdxs.size();
+    outMaterialIdxs.resize(outMatIdx + numSubsets);
+
+    for (index i = 0; i < numSubsets; ++i, ++outMatIdx)
+        outMaterialIdxs[outMatIdx] = (uint32)g_MaterialMgr.GetMaterialIdxByID(instance.materialIDs[i]);
 }
 
 ///////////////////////////////////////////////////////////
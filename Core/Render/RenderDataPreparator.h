@@ -9,12 +9,49 @@
 #include "../Model/BasicModel.h"
 #include <Common/ECSTypes.h>
 #include <Types.h>  
+#include <FrameArena.h>
 #include "Entity/EntityMgr.h"
 #include "CRender.h"
+#include <unordered_map>
 
 namespace Core
 {
 
+// textures of an instance resolved by its material IDs (one per subset); the table
+// is valid while versions of materials and SRVs are the same as on its resolving
+struct InstanceTexTable
+{
+    cvector<MaterialID> materialIDs;                 // to check a hash collision
+    cvector<ID3D11ShaderResourceView*> texSRVs;      // NUM_TEXTURE_TYPES per subset
+    cvector<uint8>      features;                    // eSubsetFeature flags per subset
+    cvector<uint8>      packedTexs;                  // ePackedTex flags per subset (empty: nothing is packed)
+};
+
+// instances of static entts which are kept on GPU (see Render::StaticBatches):
+// records of batch b subset s go by recordStarts[b] + s * numInstances + slot
+struct StaticBatchesData
+{
+    void Clear()
+    {
+        batches.clear();
+        models.clear();
+        recordStarts.clear();
+        entts.clear();
+        enttBatches.clear();
+        enttSlots.clear();
+    }
+
+    cvector<Render::Instance> batches;               // instances at LOD 0
+    cvector<ModelID>          models;                // model of each batch
+    cvector<uint32>           recordStarts;          // the first record of each batch
+
+    cvector<EntityID>         entts;                 // sorted by IDs
+    cvector<uint32>           enttBatches;           // batch of each entt
+    cvector<uint32>           enttSlots;             // position of each entt inside of its batch
+};
+
+///////////////////////////////////////////////////////////
+
 class RenderDataPreparator
 {
 private:
@@ -23,6 +60,14 @@ private:
 public:
     RenderDataPreparator();
 
+    // textures from these arrays are sampled by layers (see TextureMgr::PackIntoTextureArray)
+    inline void SetPackedTexArrs(const TexID diffuseArrID, const TexID normalArrID)
+    {
+        packedDiffuseArrID_ = diffuseArrID;
+        packedNormalArrID_  = normalArrID;
+        texTables_.clear();
+    }
+
     void PrepareInstanceFromModel(
         BasicModel& model,
         Render::Instance& instance);
@@ -31,8 +76,48 @@ public:
         const EntityID* enttsIds,
         const size numEntts,
         ECS::EntityMgr* pEnttMgr,
+        FrameArena& frameArena,                      // for transient data of this frame
         Render::InstBuffData& instanceBuffData,      // data for the instance buffer
-        cvector<Render::Instance>& instances);   // instances (models subsets) data for rendering
+        cvector<Render::Instance>& instances,    // instances (models subsets) data for rendering
+        const DirectX::XMFLOAT3& cameraPos);     // for distances to instances (sorting of draws)
+
+    // prepare the scene for GPU-driven rendering: instances of all the input entts
+    // (at LOD 0), world bounds of each instance record and an indirect draw per
+    // each (instance, subset, LOD); the LOD is selected later by the culling shader;
+    // LOD 0 of subsets with meshlets is a draw per each meshlet (cluster)
+    void PrepareGpuSceneData(
+        const EntityID* enttsIds,
+        const size numEntts,
+        ECS::EntityMgr* pEnttMgr,
+        FrameArena& frameArena,
+        Render::InstBuffData& instanceBuffData,
+        cvector<Render::Instance>& instances,
+        cvector<Render::GpuInstanceBounds>& outBounds,
+        cvector<Render::GpuDraw>& outDraws,
+        cvector<Render::GpuCluster>& outClusters);
+
+    // prepare records of the input static entts (at LOD 0) for uploading into
+    // static batches; batches and positions of entts are stored into outData
+    void PrepareStaticBatchesData(
+        const EntityID* enttsIds,
+        const size numEntts,
+        ECS::EntityMgr* pEnttMgr,
+        FrameArena& frameArena,
+        Render::InstBuffData& instanceBuffData,
+        StaticBatchesData& outData);
+
+    // prepare instances of visible static entts (by their current LODs) which are
+    // rendered from the visible buffer of static batches, and indices of their
+    // records in the same order (for the gathering); entts which aren't in the
+    // batches are skipped
+    void PrepareStaticInstancesForRendering(
+        const EntityID* visibleIds,
+        const size numEntts,
+        ECS::EntityMgr* pEnttMgr,
+        const StaticBatchesData& data,
+        cvector<Render::Instance>& outInstances,
+        cvector<uint32>& outRecordIdxs,
+        const DirectX::XMFLOAT3& cameraPos);
 
     // ----------------------------------------------------
 
@@ -42,21 +127,10 @@ public:
         ECS::EntityMgr* pEnttMgr,
         cvector<Render::Instance>& instances,
         cvector<EntityID>&        outEnttsSortedByModels,
-        cvector<Render::Material>& outMaterialsSortedByInstances);
+        cvector<uint32>&          outMaterialIdxsSortedByInstances);
 
-    void PrepareInstanceData(const BasicModel& model, Render::Instance& instance);
-      
-    // ----------------------------------------------------
-
-    void PrepareEnttsBoundingLineBox(
-        ECS::EntityMgr* pEnttMgr,
-        Render::Instance& instance,
-        Render::InstBuffData& instanceBuffer);
-
-    void PrepareEnttsMeshesBoundingLineBox(
-        ECS::EntityMgr* pEnttMgr,
-        Render::Instance& instance,
-        Render::InstBuffData& instanceBuffer);
+    // NOTE: subsets of the instance get index ranges of the input level of detail
+    void PrepareInstanceData(const BasicModel& model, Render::Instance& instance, const int lod = 0);
 
 private:
     void SeparateEnttsByMaterialGroups(
@@ -81,13 +155,35 @@ private:
         cvector<EntityID>& outEnttsSortedByInstances);
 
     void PrepareTexturesForInstance(Render::Instance& instance);
-    void PrepareMaterialForInstance(const Render::Instance& instance, cvector<Render::Material>& outMat);
+    void PrepareMaterialForInstance(const Render::Instance& instance, cvector<uint32>& outMatIdxs);
+
+    const InstanceTexTable& GetTexTable(const Render::Instance& instance);
+    void ResolveTexTable(const Render::Instance& instance, InstanceTexTable& outTable);
 
 private:
-    //constexpr int     numElems = 1028;
-    TexID             texturesIDs_[1028]{ INVALID_TEXTURE_ID };
+    // resolved textures by hash of material IDs of instances (is reset when
+    // any material or SRV is changed)
+    std::unordered_map<uint64, InstanceTexTable> texTables_;
+    uint32            texTablesMatVersion_ = 0;
+    uint32            texTablesSRVsVersion_ = 0;
+
+    cvector<TexID>    texturesIDs_;
     cvector<SRV*>     textureSRVs_;
-    cvector<Material> materials_;
+
+    TexID             packedDiffuseArrID_ = INVALID_TEXTURE_ID;
+    TexID             packedNormalArrID_  = INVALID_TEXTURE_ID;
+
+    // transient buffers of grouping entts into instances (are kept
+    // between frames so they aren't reallocated)
+    cvector<bool>              s_MaterialsFlags;
+    cvector<EntityID>          s_EnttsWithOrigMat;
+    cvector<EntityID>          s_EnttsWithUniqueMat;
+    cvector<ModelID>           s_ModelsIDs;
+    cvector<EntityID>          s_EnttsSortedByModels;
+    cvector<size>              s_NumEnttsPerModel;
+    cvector<const BasicModel*> s_Models;
+    cvector<uint8>             s_Lods;
+    cvector<int>               s_NumEnttsPerLod;
 };
 
 } // namespace Core
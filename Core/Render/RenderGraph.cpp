@@ -0,0 +1,505 @@
+// =================================================================================
+// Filename:     RenderGraph.cpp
+// Description:  implementation of the RenderGraph's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "RenderGraph.h"
+#include <StateCache.h>
+
+
+namespace Core
+{
+
+void RenderGraph::Reset()
+{
+    // return everything what is still acquired (textures of culled or failed passes)
+    for (Resource& res : resources_)
+    {
+        if (res.poolIdx != TransientTexturePool::INVALID_TEXTURE)
+            pool_.Release(res.poolIdx);
+    }
+
+    resources_.clear();
+    passes_.clear();
+
+    // we don't know what is bound at the beginning of the frame
+    pBoundRTV_       = nullptr;
+    pBoundDSV_       = nullptr;
+    numCulledPasses_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderGraph::Shutdown()
+{
+    Reset();
+    pool_.Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+RGResource RenderGraph::CreateTexture(const char* name, const RGTextureDesc& desc)
+{
+    Resource res;
+    res.name = name;
+    res.desc = desc;
+
+    resources_.push_back(res);
+    return (RGResource)resources_.size() - 1;
+}
+
+///////////////////////////////////////////////////////////
+
+RGResource RenderGraph::ImportTexture(
+    const char* name,
+    const RGTextureDesc& desc,
+    ID3D11RenderTargetView* pRTV,
+    ID3D11DepthStencilView* pDSV,
+    ID3D11ShaderResourceView* pSRV)
+{
+    Resource res;
+    res.name       = name;
+    res.desc       = desc;
+    res.pRTV       = pRTV;
+    res.pDSV       = pDSV;
+    res.pSRV       = pSRV;
+    res.isImported = true;
+    res.isCleared  = true;                 // the owner clears it
+
+    resources_.push_back(res);
+    return (RGResource)resources_.size() - 1;
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderGraph::Extract(const RGResource res)
+{
+    if (!IsValid(res))
+    {
+        sprintf(g_String, "there is no resource by idx: %d", res);
+        LogErr(g_String);
+        return;
+    }
+
+    resources_[res].isExtracted = true;
+}
+
+///////////////////////////////////////////////////////////
+
+int RenderGraph::AddPass(const char* name, const int passType, const bool hasSideEffects)
+{
+    Pass pass;
+    pass.name           = name;
+    pass.type           = passType;
+    pass.hasSideEffects = hasSideEffects;
+
+    passes_.push_back(pass);
+    return (int)passes_.size() - 1;
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderGraph::Read(const int pass, const RGResource res)
+{
+    if (!IsValidPass(pass) || !IsValid(res))
+    {
+        sprintf(g_String, "invalid pass (%d) or resource (%d)", pass, res);
+        LogErr(g_String);
+        return;
+    }
+
+    Pass& p = passes_[pass];
+
+    if (p.numReads >= MAX_PASS_READS)
+    {
+        sprintf(g_String, "pass (%s) can't read more than %d resources", p.name, MAX_PASS_READS);
+        LogErr(g_String);
+        return;
+    }
+
+    p.reads[p.numReads++] = res;
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderGraph::Write(const int pass, const RGResource res)
+{
+    if (!IsValidPass(pass) || !IsValid(res))
+    {
+        sprintf(g_String, "invalid pass (%d) or resource (%d)", pass, res);
+        LogErr(g_String);
+        return;
+    }
+
+    Pass& p = passes_[pass];
+
+    if (p.numWrites >= MAX_PASS_WRITES)
+    {
+        sprintf(g_String, "pass (%s) can't write more than %d resources", p.name, MAX_PASS_WRITES);
+        LogErr(g_String);
+        return;
+    }
+
+    p.writes[p.numWrites++] = res;
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderGraph::SetViewport(const int pass, const float width, const float height)
+{
+    if (!IsValidPass(pass))
+    {
+        sprintf(g_String, "there is no pass by idx: %d", pass);
+        LogErr(g_String);
+        return;
+    }
+
+    passes_[pass].vpWidth  = width;
+    passes_[pass].vpHeight = height;
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderGraph::Compile()
+{
+    CullPasses();
+    ComputeLifetimes();
+}
+
+///////////////////////////////////////////////////////////
+
+bool RenderGraph::BeginPass(
+    ID3D11Device* pDevice,
+    ID3D11DeviceContext* pContext,
+    Render::StateCache& cache,
+    const int pass)
+{
+    if (!IsValidPass(pass) || passes_[pass].isCulled)
+        return false;
+
+    const Pass& p = passes_[pass];
+
+    // transient textures are acquired at their first use
+    for (int i = 0; i < p.numReads + p.numWrites; ++i)
+    {
+        const RGResource idx = (i < p.numReads) ? p.reads[i] : p.writes[i - p.numReads];
+        Resource&        res = resources_[idx];
+
+        if (res.isImported || (res.poolIdx != TransientTexturePool::INVALID_TEXTURE))
+            continue;
+
+        res.poolIdx = pool_.Acquire(pDevice, res.desc);
+
+        if (res.poolIdx == TransientTexturePool::INVALID_TEXTURE)
+        {
+            sprintf(g_String, "can't execute pass (%s): no texture for resource (%s)", p.name, res.name);
+            LogErr(g_String);
+            return false;
+        }
+    }
+
+    // a read resource mustn't be bound as a target (except of the targets of this
+    // pass: e.g. a depth buffer which is read by the depth test)
+    for (int i = 0; i < p.numReads; ++i)
+    {
+        if (IsWritten(p, p.reads[i]))
+            continue;
+
+        ID3D11RenderTargetView* pRTV = GetRTV(p.reads[i]);
+        ID3D11DepthStencilView* pDSV = GetDSV(p.reads[i]);
+
+        if ((pRTV && (pRTV == pBoundRTV_)) || (pDSV && (pDSV == pBoundDSV_)))
+        {
+            pContext->OMSetRenderTargets(0, nullptr, nullptr);
+            pBoundRTV_ = nullptr;
+            pBoundDSV_ = nullptr;
+        }
+    }
+
+    // a written resource mustn't be bound as a shader input
+    ID3D11RenderTargetView* pRTV = nullptr;
+    ID3D11DepthStencilView* pDSV = nullptr;
+    UINT width  = 0;
+    UINT height = 0;
+
+    for (int i = 0; i < p.numWrites; ++i)
+    {
+        const RGResource idx = p.writes[i];
+
+        cache.UnbindShaderResource(pContext, GetSRV(idx));
+
+        if (IsDepth(idx))
+            pDSV = GetDSV(idx);
+        else
+            pRTV = GetRTV(idx);
+
+        width  = resources_[idx].desc.width;
+        height = resources_[idx].desc.height;
+    }
+
+    // bind targets of the pass (a pass without targets keeps the current ones)
+    if (!pRTV && !pDSV)
+        return true;
+
+    if ((pRTV != pBoundRTV_) || (pDSV != pBoundDSV_))
+    {
+        pContext->OMSetRenderTargets((pRTV) ? 1 : 0, &pRTV, pDSV);
+        pBoundRTV_ = pRTV;
+        pBoundDSV_ = pDSV;
+    }
+
+    const D3D11_VIEWPORT viewport =
+    {
+        0.0f,
+        0.0f,
+        (p.vpWidth  > 0.0f) ? p.vpWidth  : (float)width,
+        (p.vpHeight > 0.0f) ? p.vpHeight : (float)height,
+        0.0f,
+        1.0f
+    };
+    pContext->RSSetViewports(1, &viewport);
+
+    // the first writer clears transient targets
+    for (int i = 0; i < p.numWrites; ++i)
+    {
+        Resource& res = resources_[p.writes[i]];
+
+        if (res.isCleared)
+            continue;
+
+        if (IsDepth(p.writes[i]))
+        {
+            pContext->ClearDepthStencilView(GetDSV(p.writes[i]), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+        }
+        else
+        {
+            // the same bg color as of the back buffer
+            const FLOAT bgColor[4]{ 0, 1, 1, 0 };
+            pContext->ClearRenderTargetView(GetRTV(p.writes[i]), bgColor);
+        }
+
+        res.isCleared = true;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderGraph::EndPass(const int pass)
+{
+    if (!IsValidPass(pass))
+        return;
+
+    const Pass& p = passes_[pass];
+
+    // return textures after their last use so the next passes can alias them
+    for (int i = 0; i < p.numReads + p.numWrites; ++i)
+    {
+        const RGResource idx = (i < p.numReads) ? p.reads[i] : p.writes[i - p.numReads];
+        Resource&        res = resources_[idx];
+
+        if (res.isImported || res.isExtracted || (res.lastPass != pass))
+            continue;
+
+        if (res.poolIdx != TransientTexturePool::INVALID_TEXTURE)
+        {
+            // the texture can be bound as the target of a next pass with the same desc
+            if (GetRTV(idx) == pBoundRTV_) pBoundRTV_ = nullptr;
+            if (GetDSV(idx) == pBoundDSV_) pBoundDSV_ = nullptr;
+
+            pool_.Release(res.poolIdx);
+            res.poolIdx = TransientTexturePool::INVALID_TEXTURE;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderGraph::ReleaseExtracted()
+{
+    for (Resource& res : resources_)
+    {
+        if (res.isExtracted && (res.poolIdx != TransientTexturePool::INVALID_TEXTURE))
+        {
+            pool_.Release(res.poolIdx);
+            res.poolIdx = TransientTexturePool::INVALID_TEXTURE;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+ID3D11ShaderResourceView* RenderGraph::GetSRV(const RGResource res) const
+{
+    if (!IsValid(res))
+        return nullptr;
+
+    const Resource& r = resources_[res];
+
+    if (r.isImported)
+        return r.pSRV;
+
+    return (r.poolIdx != TransientTexturePool::INVALID_TEXTURE) ? pool_.GetTexture(r.poolIdx).pSRV : nullptr;
+}
+
+///////////////////////////////////////////////////////////
+
+ID3D11RenderTargetView* RenderGraph::GetRTV(const RGResource res) const
+{
+    if (!IsValid(res))
+        return nullptr;
+
+    const Resource& r = resources_[res];
+
+    if (r.isImported)
+        return r.pRTV;
+
+    return (r.poolIdx != TransientTexturePool::INVALID_TEXTURE) ? pool_.GetTexture(r.poolIdx).pRTV : nullptr;
+}
+
+///////////////////////////////////////////////////////////
+
+ID3D11DepthStencilView* RenderGraph::GetDSV(const RGResource res) const
+{
+    if (!IsValid(res))
+        return nullptr;
+
+    const Resource& r = resources_[res];
+
+    if (r.isImported)
+        return r.pDSV;
+
+    return (r.poolIdx != TransientTexturePool::INVALID_TEXTURE) ? pool_.GetTexture(r.poolIdx).pDSV : nullptr;
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+bool RenderGraph::IsDepth(const RGResource res) const
+{
+    return (resources_[res].desc.bindFlags & D3D11_BIND_DEPTH_STENCIL);
+}
+
+///////////////////////////////////////////////////////////
+
+bool RenderGraph::IsWritten(const Pass& pass, const RGResource res) const
+{
+    for (int i = 0; i < pass.numWrites; ++i)
+    {
+        if (pass.writes[i] == res)
+            return true;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderGraph::CullPasses()
+{
+    // a pass is used if any of its written resources is read by a used pass
+    // (or is an output of the graph); we go backward from unused resources
+
+    for (Resource& res : resources_)
+        res.refCount = (res.isImported || res.isExtracted) ? 1 : 0;
+
+    for (Pass& p : passes_)
+    {
+        p.refCount = p.numWrites;
+        p.isCulled = false;
+
+        for (int i = 0; i < p.numReads; ++i)
+            resources_[p.reads[i]].refCount++;
+    }
+
+    stack_.clear();
+
+    for (int i = 0; i < (int)resources_.size(); ++i)
+    {
+        if (resources_[i].refCount == 0)
+            stack_.push_back(i);
+    }
+
+    // passes which write nothing are used only for their side effects
+    for (Pass& p : passes_)
+    {
+        if ((p.numWrites == 0) && !p.hasSideEffects)
+        {
+            p.isCulled = true;
+
+            for (int i = 0; i < p.numReads; ++i)
+            {
+                if (--resources_[p.reads[i]].refCount == 0)
+                    stack_.push_back(p.reads[i]);
+            }
+        }
+    }
+
+    for (int s = 0; s < (int)stack_.size(); ++s)
+    {
+        const RGResource unused = stack_[s];
+
+        for (Pass& p : passes_)
+        {
+            if (p.isCulled)
+                continue;
+
+            for (int w = 0; w < p.numWrites; ++w)
+            {
+                if (p.writes[w] != unused)
+                    continue;
+
+                if ((--p.refCount == 0) && !p.hasSideEffects)
+                {
+                    p.isCulled = true;
+
+                    for (int i = 0; i < p.numReads; ++i)
+                    {
+                        if (--resources_[p.reads[i]].refCount == 0)
+                            stack_.push_back(p.reads[i]);
+                    }
+                }
+            }
+        }
+    }
+
+    numCulledPasses_ = 0;
+
+    for (const Pass& p : passes_)
+        numCulledPasses_ += (int)p.isCulled;
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderGraph::ComputeLifetimes()
+{
+    for (Resource& res : resources_)
+    {
+        res.firstPass = -1;
+        res.lastPass  = -1;
+    }
+
+    for (int pass = 0; pass < (int)passes_.size(); ++pass)
+    {
+        const Pass& p = passes_[pass];
+
+        if (p.isCulled)
+            continue;
+
+        for (int i = 0; i < p.numReads + p.numWrites; ++i)
+        {
+            Resource& res = resources_[(i < p.numReads) ? p.reads[i] : p.writes[i - p.numReads]];
+
+            if (res.firstPass == -1)
+                res.firstPass = pass;
+
+            res.lastPass = pass;
+        }
+    }
+}
+
+} // namespace Core
@@ -0,0 +1,155 @@
+// =================================================================================
+// Filename:     RenderGraph.h
+// Description:  a small frame graph: each frame the passes are declared (in the
+//               order of execution) with the resources they read and write, then:
+//
+//               - Compile() culls passes which results are never used (a pass
+//                 without side effects which writes only unused resources) and
+//                 computes lifetimes of transient textures;
+//               - BeginPass()/EndPass() are called around execution of each pass:
+//                 a transient texture is acquired from the pool at its first use
+//                 and is returned after the last one (so it is aliased by later
+//                 passes with the same desc), resource hazards are resolved
+//                 (a read resource is unbound from the output merger, a written
+//                 one is unbound from shader slots), and the targets of the pass
+//                 are bound (and cleared by the first writer)
+//
+//               NOTE: the graph doesn't call passes itself, the caller executes
+//                     each pass by its type (see CGraphics::RenderHelper())
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "TransientTexturePool.h"
+#include <d3d11.h>
+
+namespace Render
+{
+    class StateCache;
+}
+
+
+namespace Core
+{
+
+using RGResource = int;
+constexpr RGResource RG_INVALID_RESOURCE = -1;
+
+///////////////////////////////////////////////////////////
+
+class RenderGraph
+{
+public:
+    static constexpr int MAX_PASS_READS  = 4;
+    static constexpr int MAX_PASS_WRITES = 4;
+
+    RenderGraph() {}
+
+    // restrict a copying of this class instance
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // forget passes and resources of the previous frame
+    void Reset();
+    void Shutdown();
+
+    // a texture which lives only within the frame (is taken from the pool)
+    RGResource CreateTexture(const char* name, const RGTextureDesc& desc);
+
+    // a texture which is owned by someone else (a back buffer, etc.);
+    // imported textures are outputs of the graph so their writers are never culled
+    RGResource ImportTexture(
+        const char* name,
+        const RGTextureDesc& desc,
+        ID3D11RenderTargetView* pRTV,
+        ID3D11DepthStencilView* pDSV,
+        ID3D11ShaderResourceView* pSRV);
+
+    // keep the transient texture after the execution (it must be returned
+    // by ReleaseExtracted() before the next frame)
+    void Extract(const RGResource res);
+
+    // passType is the caller's id to execute the pass; a pass with side effects
+    // (readback, GPU work for the next frames) is never culled
+    int  AddPass(const char* name, const int passType, const bool hasSideEffects = false);
+    // a target which is also used by the pass (depth test, blending) is both read and written
+    void Read (const int pass, const RGResource res);
+    void Write(const int pass, const RGResource res);
+    void SetViewport(const int pass, const float width, const float height);
+
+    void Compile();
+
+    // return false if the pass is culled (or its textures can't be created)
+    bool BeginPass(ID3D11Device* pDevice, ID3D11DeviceContext* pContext, Render::StateCache& cache, const int pass);
+    void EndPass  (const int pass);
+
+    // return the extracted textures into the pool
+    void ReleaseExtracted();
+
+    // ----------------------------------------------------
+
+    inline int  GetNumPasses()                   const { return (int)passes_.size(); }
+    inline int  GetPassType(const int pass)      const { return passes_[pass].type; }
+    inline bool IsPassCulled(const int pass)     const { return passes_[pass].isCulled; }
+    inline int  GetNumCulledPasses()             const { return numCulledPasses_; }
+
+    ID3D11ShaderResourceView* GetSRV(const RGResource res) const;
+    ID3D11RenderTargetView*   GetRTV(const RGResource res) const;
+    ID3D11DepthStencilView*   GetDSV(const RGResource res) const;
+
+    inline const RGTextureDesc&  GetDesc(const RGResource res) const { return resources_[res].desc; }
+    inline TransientTexturePool& GetPool()                             { return pool_; }
+
+private:
+    struct Resource
+    {
+        const char*               name       = nullptr;
+        RGTextureDesc             desc;
+        ID3D11RenderTargetView*   pRTV       = nullptr;     // views of imported textures
+        ID3D11DepthStencilView*   pDSV       = nullptr;
+        ID3D11ShaderResourceView* pSRV       = nullptr;
+        int                       poolIdx    = TransientTexturePool::INVALID_TEXTURE;
+        int                       firstPass  = -1;           // lifetime within not culled passes
+        int                       lastPass   = -1;
+        int                       refCount   = 0;            // number of reading passes (is used for culling)
+        bool                      isImported = false;
+        bool                      isExtracted = false;
+        bool                      isCleared  = false;
+    };
+
+    struct Pass
+    {
+        const char* name           = nullptr;
+        int         type           = 0;
+        RGResource  reads[MAX_PASS_READS];
+        RGResource  writes[MAX_PASS_WRITES];
+        int         numReads       = 0;
+        int         numWrites      = 0;
+        int         refCount       = 0;                      // number of written resources which are used
+        float       vpWidth        = 0.0f;                   // 0 - the size of the targets
+        float       vpHeight       = 0.0f;
+        bool        hasSideEffects = false;
+        bool        isCulled       = false;
+    };
+
+    inline bool IsValid(const RGResource res) const { return (res >= 0) && (res < (int)resources_.size()); }
+    inline bool IsValidPass(const int pass)   const { return (pass >= 0) && (pass < (int)passes_.size()); }
+
+    bool IsDepth  (const RGResource res) const;
+    bool IsWritten(const Pass& pass, const RGResource res) const;
+    void CullPasses();
+    void ComputeLifetimes();
+
+private:
+    cvector<Resource>         resources_;
+    cvector<Pass>             passes_;
+    cvector<RGResource>       stack_;                        // unused resources (for culling)
+    TransientTexturePool      pool_;
+
+    ID3D11RenderTargetView*   pBoundRTV_ = nullptr;          // the output merger state which is set by the graph
+    ID3D11DepthStencilView*   pBoundDSV_ = nullptr;
+    int                       numCulledPasses_ = 0;
+};
+
+} // namespace Core
@@ -6,6 +6,7 @@
 // *********************************************************************************
 #include <CoreCommon/pch.h>
 #include "RenderStates.h"
+#include <bit>
 
 #pragma warning(disable : 4996)
 
@@ -28,173 +29,130 @@ void RenderStates::InitAll(ID3D11Device* pDevice, const bool multisampleEnable)
 {
     InitAllRasterParams(pDevice, multisampleEnable);
     InitAllBlendStates(pDevice);
+    InitOffscreenBlendStates(pDevice);
     InitAllDepthStencilStates(pDevice);
-
-    // init some hashes to use it later during switching between some states
-    turnOffFillModesHash_ &= ~(1 << FILL_SOLID);
-    turnOffFillModesHash_ &= ~(1 << FILL_WIREFRAME);
-
-    turnOffCullModesHash_ &= ~(1 << CULL_BACK);
-    turnOffCullModesHash_ &= ~(1 << CULL_FRONT);
-    turnOffCullModesHash_ &= ~(1 << CULL_NONE);
 }
 
 ///////////////////////////////////////////////////////////
 
 void RenderStates::DestroyAll()
 {
-    for (auto& it : blendStates_)
-        SafeRelease(&it.second);
-
-    for (auto& it : rasterStates_)
-        SafeRelease(&it.second);
-
-    for (auto& it : depthStencilStates_)
-        SafeRelease(&it.second);
-        
-    blendStates_.clear();
-    rasterStates_.clear();
-    depthStencilStates_.clear();
+    for (ID3D11BlendState*& pBS : blendStates_)
+        SafeRelease(&pBS);
+
+    for (ID3D11BlendState*& pBS : offscreenBlendStates_)
+        SafeRelease(&pBS);
+
+    for (ID3D11RasterizerState*& pRS : rasterStates_)
+        SafeRelease(&pRS);
+
+    for (ID3D11DepthStencilState*& pDSS : depthStencilStates_)
+        SafeRelease(&pDSS);
 }
 
 ///////////////////////////////////////////////////////////
 
-ID3D11BlendState* RenderStates::GetBS(const eRenderState state)
+void RenderStates::SetRS(ID3D11DeviceContext* pContext, const RenderStatesMask params)
 {
-    // return a ptr to the blending state by input key
-    try
-    {
-        return blendStates_.at(state);
-    }
-    catch (const std::out_of_range&)
+    // set up a raster state according to the input params: each kind of params
+    // which is in the input mask replaces the current one of this kind
+
+    RenderStatesMask mask = rasterStateMask_;
+
+    if (params & RS_FILL_MODES)
+        mask = (mask & ~RS_FILL_MODES)  | (params & RS_FILL_MODES);
+
+    if (params & RS_CULL_MODES)
+        mask = (mask & ~RS_CULL_MODES)  | (params & RS_CULL_MODES);
+
+    if (params & RS_FRONT_MODES)
+        mask = (mask & ~RS_FRONT_MODES) | (params & RS_FRONT_MODES);
+
+    ID3D11RasterizerState* pRS = rasterStates_[mask & RS_RASTER_PARAMS];
+
+    if (!pRS)
     {
-        sprintf(g_String, "unknown blend state key: %d", state);
-        LogErr(g_String);
-        return nullptr;
+        PrintErrAboutRSMask(mask);
+        return;
     }
+
+    BindRS(pContext, pRS);
+    rasterStateMask_ = mask;
 }
 
 ///////////////////////////////////////////////////////////
 
-ID3D11RasterizerState* RenderStates::GetRS(const std::set<eRenderState>& states)
+void RenderStates::SetBS(ID3D11DeviceContext* pContext, const RenderStatesMask state)
 {
-    // return a ptr to the rasterizer state by input key
-    return nullptr;
-}
+    // set a blending state by input mask (only its lowest bit is used)
 
-///////////////////////////////////////////////////////////
+    const int         bit = std::countr_zero(state);
+    ID3D11BlendState* pBS = (bit < NUM_RENDER_STATES) ? blendStates_[bit] : nullptr;
 
-ID3D11DepthStencilState* RenderStates::GetDSS(const eRenderState state)
-{
-    // return a ptr to the depth stencil state by state enum key
-    try
-    {
-        return depthStencilStates_.at(state);
-    }
-    catch (const std::out_of_range&)
+    if (!pBS)
     {
-        sprintf(g_String, "there is no depth stencil state by key: %d", state);
+        sprintf(g_String, "there is no blend state (BS) by mask: %x", state);
         LogErr(g_String);
-        return nullptr;
+        BindBS(pContext, nullptr, NULL);
+        return;
     }
-}
 
-///////////////////////////////////////////////////////////
+    // these states use a blend factor
+    constexpr RenderStatesMask withFactor = RSMask(TRANSPARENCY) | RSMask(NO_RENDER_TARGET_WRITES);
+    constexpr FLOAT            blendFactor[4] = { 0.5f,0.5f,0.5f,0.5f };
 
-void RenderStates::SetRS(ID3D11DeviceContext* pContext, const eRenderState state)
-{
-    SetRS(pContext, std::set<eRenderState>{state});
+    BindBS(pContext, pBS, (state & withFactor) ? blendFactor : NULL);
 }
 
 ///////////////////////////////////////////////////////////
 
-void RenderStates::SetRS(ID3D11DeviceContext* pContext, const std::set<eRenderState>& states)
+bool RenderStates::HasOffscreenBS(const RenderStatesMask state) const
 {
-    // set up a raster state according to the input states params
-
-    UpdateRSHash(states);
-    pContext->RSSetState(GetRasterStateByHash(GetCurrentRSHash()));
+    const int bit = std::countr_zero(state);
+    return (bit < NUM_RENDER_STATES) && (offscreenBlendStates_[bit] != nullptr);
 }
 
 ///////////////////////////////////////////////////////////
 
-void RenderStates::SetRSByHash(ID3D11DeviceContext* pContext, const uint8_t hash)
+void RenderStates::SetOffscreenBS(ID3D11DeviceContext* pContext, const RenderStatesMask state)
 {
-    // set up a raster state according to the input hash
+    // set an offscreen blend state by input mask (only its lowest bit is used)
 
-    ID3D11RasterizerState* pRS = nullptr;
+    const int         bit = std::countr_zero(state);
+    ID3D11BlendState* pBS = (bit < NUM_RENDER_STATES) ? offscreenBlendStates_[bit] : nullptr;
 
-    // if the RS by input hash is valid AND we don't want to set the same RS
-    if ((rasterStateHash_ != hash) && (pRS = GetRasterStateByHash(hash)))
-    {
-        pContext->RSSetState(pRS);
-        rasterStateHash_ = hash;
-    }
-}
-
-///////////////////////////////////////////////////////////
-
-void RenderStates::SetBS(ID3D11DeviceContext* pContext, const eRenderState state)
-{
-    // set a blending state by input key
-    try
-    {
-        ID3D11BlendState* pBS = blendStates_.at(state);
-
-        switch (state)
-        {
-            case ALPHA_DISABLE:
-            case ALPHA_ENABLE:
-            case ADDING:
-            case SUBTRACTING:
-            case MULTIPLYING:
-            case ALPHA_TO_COVERAGE:
-            {
-                pContext->OMSetBlendState(pBS, NULL, 0xFFFFFFFF);
-                break;
-            }
-            case TRANSPARENCY:
-            case NO_RENDER_TARGET_WRITES:
-            {
-                //float blendFactor[4] = { 0,0,0,0 };
-                float blendFactor[4] = { 0.5f,0.5f,0.5f,0.5f };
-                pContext->OMSetBlendState(pBS, blendFactor, 0xFFFFFFFF);
-                break;
-            }
-            default:
-            {
-                sprintf(g_String, "there is no case for handling blend state: %d", state);
-                LogErr(g_String);
-            }
-        }
-    }
-    catch (const std::out_of_range&)
+    if (!pBS)
     {
-        sprintf(g_String, "there is no blend state (BS) by key: %d", state);
+        sprintf(g_String, "there is no offscreen blend state (BS) by mask: %x", state);
         LogErr(g_String);
-        pContext->OMSetBlendState(nullptr, NULL, 0xFFFFFFFF);
+        BindBS(pContext, nullptr, NULL);
+        return;
     }
 
+    BindBS(pContext, pBS, NULL);
 }
 
 ///////////////////////////////////////////////////////////
 
 void RenderStates::SetDSS(
     ID3D11DeviceContext* pContext, 
-    const eRenderState state, 
+    const RenderStatesMask state,
     const UINT stencilRef)
 {
-    // set a depth stencil state by input key
-    try
-    {
-        pContext->OMSetDepthStencilState(depthStencilStates_.at(state), stencilRef);
-    }
-    catch (const std::out_of_range&)
+    // set a depth stencil state by input mask (only its lowest bit is used)
+
+    const int                bit  = std::countr_zero(state);
+    ID3D11DepthStencilState* pDSS = (bit < NUM_RENDER_STATES) ? depthStencilStates_[bit] : nullptr;
+
+    if (!pDSS)
     {
-        sprintf(g_String, "there is no depth stencil state (DSS) by key: %d", state);
+        sprintf(g_String, "there is no depth stencil state (DSS) by mask: %x", state);
         LogErr(g_String);
-        pContext->OMSetDepthStencilState(0, 0);
+        BindDSS(pContext, nullptr, 0);
+        return;
     }
+
+    BindDSS(pContext, pDSS, stencilRef);
 }
 
 
@@ -202,159 +160,44 @@ void RenderStates::SetDSS(
 //                            PRIVATE METHODS
 // ********************************************************************************
 
-void InitFillRasterParams()
-{
-
-}
-void InitCullRasterParams();
-
 void RenderStates::InitAllRasterParams(ID3D11Device* pDevice, bool multisampleEnable)
 {
-    // create/set up the rasterizer state objects
-    // 
-    // firstly we set up a description for a raster state, then we create it
-    // after creation we generate a hash for this particular raster state
-    // and insert into the map created pairs ['hash' => 'ptr_to_raster_state']
+    // create the rasterizer state objects: one per each combination of
+    // fill mode + cull mode + front face, and store it by mask of its params
 
     try
     {
-        HRESULT hr = S_OK;
-        ID3D11RasterizerState* pRasterState = nullptr;
+        constexpr eRenderState   fills[2]  = { FILL_SOLID, FILL_WIREFRAME };
+        constexpr eRenderState   culls[3]  = { CULL_BACK, CULL_FRONT, CULL_NONE };
+        constexpr eRenderState   fronts[2] = { FRONT_CLOCKWISE, FRONT_COUNTER_CLOCKWISE };
+
+        constexpr D3D11_FILL_MODE fillModes[2] = { D3D11_FILL_SOLID, D3D11_FILL_WIREFRAME };
+        constexpr D3D11_CULL_MODE cullModes[3] = { D3D11_CULL_BACK, D3D11_CULL_FRONT, D3D11_CULL_NONE };
+
         D3D11_RASTERIZER_DESC desc;
         ZeroMemory(&desc, sizeof(D3D11_RASTERIZER_DESC));
-
-        //
-        // 1. DEFAULT: fill solid + cull back + front cw
-        //
-        desc.FillMode = D3D11_FILL_SOLID;
-        desc.CullMode = D3D11_CULL_BACK;
-        desc.FrontCounterClockwise = false;
-        desc.DepthClipEnable = true;
+        desc.DepthClipEnable   = true;
         desc.MultisampleEnable = multisampleEnable;
 
-        hr = pDevice->CreateRasterizerState(&desc, &pRasterState);
-        CAssert::NotFailed(hr, "can't create a raster state");
-
-        UpdateRSHash({ FILL_SOLID, CULL_BACK, FRONT_CLOCKWISE });
-        rasterStates_.insert({ GetCurrentRSHash(), pRasterState });
-
-
-        //
-        // 2. fill_solid + cull_back + front ccw
-        //
-        desc.FillMode = D3D11_FILL_SOLID;
-        desc.CullMode = D3D11_CULL_BACK;
-        desc.FrontCounterClockwise = true;
-        desc.DepthClipEnable = true;
-
-        hr = pDevice->CreateRasterizerState(&desc, &pRasterState);
-        CAssert::NotFailed(hr, "can't create a raster state");
-
-        ResetRasterStateHash();
-        UpdateRSHash({ FILL_SOLID, CULL_BACK, FRONT_COUNTER_CLOCKWISE });
-        rasterStates_.insert({ GetCurrentRSHash(), pRasterState });
-
-
-        //
-        // 3. fill_solid + cull_none + front ccw
-        //
-        desc.FillMode = D3D11_FILL_SOLID;
-        desc.CullMode = D3D11_CULL_NONE;
-        desc.FrontCounterClockwise = true;
-        desc.DepthClipEnable = true;
-
-        hr = pDevice->CreateRasterizerState(&desc, &pRasterState);
-        CAssert::NotFailed(hr, "can't create a raster state");
-
-        ResetRasterStateHash();
-        UpdateRSHash({ FILL_SOLID, CULL_NONE, FRONT_COUNTER_CLOCKWISE });
-        rasterStates_.insert({ GetCurrentRSHash(), pRasterState });
-
-        //
-        // 4. fill_solid + cull_none + front cw
-        //
-        desc.FillMode = D3D11_FILL_SOLID;
-        desc.CullMode = D3D11_CULL_NONE;
-        desc.FrontCounterClockwise = false;
-        desc.DepthClipEnable = true;
-
-        hr = pDevice->CreateRasterizerState(&desc, &pRasterState);
-        CAssert::NotFailed(hr, "can't create a raster state");
-
-        ResetRasterStateHash();
-        UpdateRSHash({ FILL_SOLID, CULL_NONE, FRONT_CLOCKWISE });
-        rasterStates_.insert({ GetCurrentRSHash(), pRasterState });
-
-
-        //
-        // 5. fill solid + cull front + front cw
-        //
-        desc.FillMode = D3D11_FILL_SOLID;
-        desc.CullMode = D3D11_CULL_FRONT;
-        desc.FrontCounterClockwise = false;
-        desc.DepthClipEnable = true;
-
-        hr = pDevice->CreateRasterizerState(&desc, &pRasterState);
-        CAssert::NotFailed(hr, "can't create a raster state");
-
-        ResetRasterStateHash();
-        UpdateRSHash({ FILL_SOLID, CULL_FRONT, FRONT_CLOCKWISE });
-        rasterStates_.insert({ GetCurrentRSHash(), pRasterState });
-
-
-        //
-        // 6. fill wireframe + cull back + front cw
-        //
-        desc.FillMode = D3D11_FILL_WIREFRAME;
-        desc.CullMode = D3D11_CULL_BACK;
-        desc.FrontCounterClockwise = false;
-        desc.DepthClipEnable = true;
-
-        hr = pDevice->CreateRasterizerState(&desc, &pRasterState);
-        CAssert::NotFailed(hr, "can't create a raster state");
-
-        ResetRasterStateHash();
-        UpdateRSHash({ FILL_WIREFRAME, CULL_BACK, FRONT_CLOCKWISE });
-        rasterStates_.insert({ GetCurrentRSHash(), pRasterState });
-
-
-        //
-        // 7. fill wireframe + cull front + front cw
-        //
-        desc.FillMode = D3D11_FILL_WIREFRAME;
-        desc.CullMode = D3D11_CULL_FRONT;
-        desc.FrontCounterClockwise = false;
-        desc.DepthClipEnable = true;
-
-        hr = pDevice->CreateRasterizerState(&desc, &pRasterState);
-        CAssert::NotFailed(hr, "can't create a raster state");
-
-        ResetRasterStateHash();
-        UpdateRSHash({ FILL_WIREFRAME, CULL_FRONT, FRONT_CLOCKWISE });
-        rasterStates_.insert({ GetCurrentRSHash(), pRasterState });
-
-
-        //
-        // 8. fill wireframe + cull none + front cw
-        //
-        desc.FillMode = D3D11_FILL_WIREFRAME;
-        desc.CullMode = D3D11_CULL_NONE;
-        desc.FrontCounterClockwise = false;
-        desc.DepthClipEnable = true;
-
-        hr = pDevice->CreateRasterizerState(&desc, &pRasterState);
-        CAssert::NotFailed(hr, "can't create a raster state");
+        for (int f = 0; f < 2; ++f)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                for (int fr = 0; fr < 2; ++fr)
+                {
+                    desc.FillMode              = fillModes[f];
+                    desc.CullMode              = cullModes[c];
+                    desc.FrontCounterClockwise = (fronts[fr] == FRONT_COUNTER_CLOCKWISE);
 
-        ResetRasterStateHash();
-        UpdateRSHash({ FILL_WIREFRAME, CULL_NONE, FRONT_CLOCKWISE });
-        rasterStates_.insert({ GetCurrentRSHash(), pRasterState });
+                    const RenderStatesMask mask = RSMask(fills[f]) | RSMask(culls[c]) | RSMask(fronts[fr]);
 
+                    const HRESULT hr = pDevice->CreateRasterizerState(&desc, &rasterStates_[mask]);
+                    CAssert::NotFailed(hr, "can't create a raster state");
+                }
+            }
+        }
 
-        //
-        // AFTER ALL: reset the rasterizer state hash after initialization
-        //            and set the default params
-        ResetRasterStateHash();
-        UpdateRSHash({ FILL_SOLID, CULL_BACK, FRONT_CLOCKWISE });
+        rasterStateMask_ = RS_DEFAULT;
     }
     catch (EngineException& e)
     {
@@ -512,6 +355,50 @@ void RenderStates::InitAllBlendStates(ID3D11Device* pDevice)
 
 ///////////////////////////////////////////////////////////
 
+void RenderStates::InitOffscreenBlendStates(ID3D11Device* pDevice)
+{
+    // the target is composited by: scene * (1 - alpha) + rgb
+
+    HRESULT hr = S_OK;
+    D3D11_BLEND_DESC blendDesc { 0 };
+    D3D11_RENDER_TARGET_BLEND_DESC& rtbd = blendDesc.RenderTarget[0];
+
+    blendDesc.AlphaToCoverageEnable  = false;
+    blendDesc.IndependentBlendEnable = false;
+
+    rtbd.BlendEnable           = TRUE;
+    rtbd.BlendOp               = D3D11_BLEND_OP_ADD;
+    rtbd.BlendOpAlpha          = D3D11_BLEND_OP_ADD;
+    rtbd.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+    //
+    // Transparent BS: the color is "over" the accumulated one, the coverage grows
+    //
+    rtbd.SrcBlend       = D3D11_BLEND_SRC_ALPHA;
+    rtbd.DestBlend      = D3D11_BLEND_INV_SRC_ALPHA;
+    rtbd.SrcBlendAlpha  = D3D11_BLEND_ONE;
+    rtbd.DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+
+    hr = pDevice->CreateBlendState(&blendDesc, &offscreenBlendStates_[TRANSPARENCY]);
+    CAssert::NotFailed(hr, "can't create an offscreen transparent blend state");
+
+    //
+    // Adding BS (and alpha enabled which adds as well): the coverage isn't changed
+    //
+    rtbd.SrcBlend       = D3D11_BLEND_ONE;
+    rtbd.DestBlend      = D3D11_BLEND_ONE;
+    rtbd.SrcBlendAlpha  = D3D11_BLEND_ZERO;
+    rtbd.DestBlendAlpha = D3D11_BLEND_ONE;
+
+    hr = pDevice->CreateBlendState(&blendDesc, &offscreenBlendStates_[ADDING]);
+    CAssert::NotFailed(hr, "can't create an offscreen adding blend state");
+
+    hr = pDevice->CreateBlendState(&blendDesc, &offscreenBlendStates_[ALPHA_ENABLE]);
+    CAssert::NotFailed(hr, "can't create an offscreen alpha enabled blend state");
+}
+
+///////////////////////////////////////////////////////////
+
 void RenderStates::InitAllDepthStencilStates(ID3D11Device* pDevice)
 {
     // initialize different depth stencil states
@@ -544,12 +431,13 @@ void RenderStates::InitAllDepthStencilStates(ID3D11Device* pDevice)
     // (noRenderTargetWritesBS) which will disable writing any color information 
     // to the backbuffer, so that we will have the combined effect which will 
     // be used to write only to the stencil.
+    // NOTE: the mirror is already in the scene depth so it is marked by LESS_EQUAL
 
     D3D11_DEPTH_STENCIL_DESC mirrorDesc;
 
     mirrorDesc.DepthEnable      = true;
     mirrorDesc.DepthWriteMask   = D3D11_DEPTH_WRITE_MASK_ZERO;
-    mirrorDesc.DepthFunc        = D3D11_COMPARISON_LESS;
+    mirrorDesc.DepthFunc        = D3D11_COMPARISON_LESS_EQUAL;
     mirrorDesc.StencilEnable    = true;
     mirrorDesc.StencilReadMask  = 0xff;
     mirrorDesc.StencilWriteMask = 0xff;
@@ -569,15 +457,16 @@ void RenderStates::InitAllDepthStencilStates(ID3D11Device* pDevice)
 
 
     // draw reflection:
-    // this state will be used to draw the geometry that should appear as a reflection
-    // in mirror. We will set the stencil test up so that we will only render pixels
-    // if they have been previously marked as part of the mirror by the MarkMirrorDSS.
+    // this state will be used to draw the reflection (which is rendered offscreen, see
+    // Render::PlanarReflection) by a fullscreen triangle over the mirror. We will set
+    // the stencil test up so that we will only render pixels if they have been
+    // previously marked as part of the mirror by the MarkMirrorDSS.
 
     CD3D11_DEPTH_STENCIL_DESC drawReflectionDesc(D3D11_DEFAULT);
 
-    drawReflectionDesc.DepthEnable      = true;
-    drawReflectionDesc.DepthWriteMask   = D3D11_DEPTH_WRITE_MASK_ALL;
-    drawReflectionDesc.DepthFunc        = D3D11_COMPARISON_LESS;
+    drawReflectionDesc.DepthEnable      = false;
+    drawReflectionDesc.DepthWriteMask   = D3D11_DEPTH_WRITE_MASK_ZERO;
+    drawReflectionDesc.DepthFunc        = D3D11_COMPARISON_ALWAYS;
     drawReflectionDesc.StencilEnable    = true;
     drawReflectionDesc.StencilReadMask  = 0xff;
     drawReflectionDesc.StencilWriteMask = 0xff;
@@ -629,124 +518,99 @@ void RenderStates::InitAllDepthStencilStates(ID3D11Device* pDevice)
     CAssert::NotFailed(hr, "can't create a no double blend depth stencil state");
 
     //
-    // for the SKY DOME rendering
+    // for the SKY DOME rendering: the dome is on the far plane (z == w) and is
+    // rendered after the opaque geometry so covered pixels are rejected by early-Z
     //
     CD3D11_DEPTH_STENCIL_DESC desc(D3D11_DEFAULT);
     desc.DepthFunc      = D3D11_COMPARISON_LESS_EQUAL;
     desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
 
-    hr = pDevice->CreateDepthStencilState(&depthStencilDesc, &depthStencilStates_[SKY_DOME]);
+    hr = pDevice->CreateDepthStencilState(&desc, &depthStencilStates_[SKY_DOME]);
     CAssert::NotFailed(hr, "can't create a depth stencil state");
-}
-
-///////////////////////////////////////////////////////////
-
-ID3D11RasterizerState* RenderStates::GetRasterStateByHash(const uint8_t hash)
-{
-    // return a pointer to some rasterizer state by hash
-    try
-    {
-        return rasterStates_.at(hash);
-    }
-    catch (const std::out_of_range&)
-    {
-        sprintf(g_String, "there is no rasterizer state by hash: %x", hash);
-        LogErr(g_String);
-        PrintErrAboutRSHash(hash);
-        return nullptr;
-    }
-}
-
-///////////////////////////////////////////////////////////
 
-void RenderStates::UpdateRSHash(const std::set<eRenderState>& rsParams)
-{
-    // setup the rasterizer state hash according to the params 
+    //
+    // for the main passes after the depth pre-pass: the depth is already
+    // filled so only the visible pixels are shaded
+    //
+    CD3D11_DEPTH_STENCIL_DESC depthEqualDesc(D3D11_DEFAULT);
+    depthEqualDesc.DepthFunc      = D3D11_COMPARISON_EQUAL;
+    depthEqualDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
 
-    for (const eRenderState param : rsParams)
-    {
-        switch (param)
-        {
-            // switch between rasterizer fill modes
-            case FILL_SOLID:
-            case FILL_WIREFRAME:
-            {
-                rasterStateHash_ &= turnOffFillModesHash_;   // turn off all the fill modes
-                TurnOnRasterParam(param);
-                break;
-            }
-            // switch between rasterizer culling modes
-            case CULL_BACK:
-            case CULL_FRONT:
-            case CULL_NONE:
-            {
-                rasterStateHash_ &= turnOffCullModesHash_;   // turn off all the cull modes
-                TurnOnRasterParam(param);
-                break;
-            }
-            case FRONT_CLOCKWISE:
-            {
-                // &= ~(1 << rsParam);
-                rasterStateHash_ &= ~(1 << FRONT_COUNTER_CLOCKWISE); // turn off
-                rasterStateHash_ |= (1 << FRONT_CLOCKWISE);          // turn on
-                break;
-            }
-            case FRONT_COUNTER_CLOCKWISE:
-            {
-                rasterStateHash_ &= ~(1 << FRONT_CLOCKWISE);         // turn off
-                rasterStateHash_ |= (1 << FRONT_COUNTER_CLOCKWISE);  // turn on
-                break;
-            }
-            default:
-            {
-                sprintf(g_String, "unknown rasterizer state parameter: %d", param);
-                LogErr(g_String);
-                return;
-            }
-        }
-    }	
+    hr = pDevice->CreateDepthStencilState(&depthEqualDesc, &depthStencilStates_[DEPTH_EQUAL]);
+    CAssert::NotFailed(hr, "can't create a depth equal stencil state");
 }
 
 ///////////////////////////////////////////////////////////
 
-void RenderStates::PrintErrAboutRSHash(const uint8_t bitfield)
+void RenderStates::PrintErrAboutRSMask(const RenderStatesMask mask)
 {
-    // if we got somewhere some wrong hash we call this method to 
+    // if we got somewhere some wrong mask we call this method to 
     // print an error message about it
 
-    char bitfieldChars[8]{ '\0' };
-    char rasterStatesNamesBuf[256] {'\0'};
-
-    const std::map<eRenderState, const char*> rasterParamsNames =
+    constexpr const char* rasterParamsNames[] =
     {
-        {FILL_SOLID,              "FILL_SOLID"},
-        {FILL_WIREFRAME,          "FILL_WIREFRAME"},
-        {CULL_BACK,               "CULL_BACK"},
-        {CULL_FRONT,              "CULL_FRONT"},
-        {CULL_NONE,               "CULL_NONE"},
-        {FRONT_COUNTER_CLOCKWISE, "FRONT_COUNTER_CLOCKWISE"},
-        {FRONT_CLOCKWISE,         "FRONT_CLOCKWISE"},
+        "FILL_SOLID",
+        "FILL_WIREFRAME",
+        "CULL_BACK",
+        "CULL_FRONT",
+        "CULL_NONE",
+        "FRONT_COUNTER_CLOCKWISE",
+        "FRONT_CLOCKWISE",
     };
 
-    // convert bitfield into string
-    itoa(bitfield, bitfieldChars, 2);
+    char rasterStatesNamesBuf[256] {'\0'};
 
-    // go through each bitflag
-    for (int i = 7; i >= 0; i--)
+    // get a name for each raster param bit which is set
+    for (int i = 0; i <= FRONT_CLOCKWISE; ++i)
     {
-        // get a name for this bigflag if it == 1
-        if (bitfieldChars[i] == '1')
+        if (mask & (1u << i))
         {
-            strcat(rasterStatesNamesBuf, rasterParamsNames.at((eRenderState)i));
+            strcat(rasterStatesNamesBuf, rasterParamsNames[i]);
             strcat(rasterStatesNamesBuf, ", ");
         }
     }
 
     // print error info about not existent rasterizer state
-    LogErr("can't get a raster state ptr by hash:");
-    LogMsgf("%s%s", RED, bitfieldChars);
+    sprintf(g_String, "there is no rasterizer state by mask: %x", mask);
+    LogErr(g_String);
     LogMsgf("%s%s", RED, "which is responsible to such params(at the same time) :");
     LogMsgf("%s%s", RED, rasterStatesNamesBuf);
 }
 
+///////////////////////////////////////////////////////////
+
+void RenderStates::BindRS(ID3D11DeviceContext* pContext, ID3D11RasterizerState* pRS)
+{
+    if (pStateCache_)
+        pStateCache_->SetRasterState(pContext, pRS);
+    else
+        pContext->RSSetState(pRS);
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderStates::BindBS(
+    ID3D11DeviceContext* pContext,
+    ID3D11BlendState* pBS,
+    const FLOAT* blendFactor)
+{
+    if (pStateCache_)
+        pStateCache_->SetBlendState(pContext, pBS, blendFactor, 0xFFFFFFFF);
+    else
+        pContext->OMSetBlendState(pBS, blendFactor, 0xFFFFFFFF);
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderStates::BindDSS(
+    ID3D11DeviceContext* pContext,
+    ID3D11DepthStencilState* pDSS,
+    const UINT stencilRef)
+{
+    if (pStateCache_)
+        pStateCache_->SetDepthStencilState(pContext, pDSS, stencilRef);
+    else
+        pContext->OMSetDepthStencilState(pDSS, stencilRef);
+}
+
 } // namespace Core
@@ -6,9 +6,9 @@
 // *********************************************************************************
 #pragma once
 
+#include "StateCache.h"          // from the Render module
 #include <d3d11.h>
-#include <map>
-#include <set>
+#include <stdint.h>
 
 
 namespace Core
@@ -39,10 +39,11 @@ enum eRenderState // : byte
     // depth stencil states
     DEPTH_ENABLED,
     DEPTH_DISABLED,
-    MARK_MIRROR,                  // for rendering mirror reflections
-    DRAW_REFLECTION,
+    MARK_MIRROR,                  // for rendering mirror reflections: marks the mirror in the stencil
+    DRAW_REFLECTION,              // only the stencil test by the marked mirror (without depth)
     NO_DOUBLE_BLEND,
     SKY_DOME,
+    DEPTH_EQUAL,                  // test by EQUAL without writes (after the depth pre-pass)
 
     NUM_RENDER_STATES,            // to make possible iteration over the enum
 
@@ -51,6 +52,25 @@ enum eRenderState // : byte
 
 ///////////////////////////////////////////////////////////
 
+// a bit per render state; bits of rasterizer params and blending states are the same
+// as in hashes of ECS::RenderStatesSystem so these hashes are used as masks as is
+using RenderStatesMask = uint32_t;
+
+constexpr RenderStatesMask RSMask(const eRenderState state) { return (1u << state); }
+
+constexpr RenderStatesMask RS_FILL_MODES    = RSMask(FILL_SOLID) | RSMask(FILL_WIREFRAME);
+constexpr RenderStatesMask RS_CULL_MODES    = RSMask(CULL_BACK)  | RSMask(CULL_FRONT) | RSMask(CULL_NONE);
+constexpr RenderStatesMask RS_FRONT_MODES   = RSMask(FRONT_COUNTER_CLOCKWISE) | RSMask(FRONT_CLOCKWISE);
+constexpr RenderStatesMask RS_RASTER_PARAMS = RS_FILL_MODES | RS_CULL_MODES | RS_FRONT_MODES;
+
+// the most used rasterizer states
+constexpr RenderStatesMask RS_DEFAULT       = RSMask(FILL_SOLID)     | RSMask(CULL_BACK) | RSMask(FRONT_CLOCKWISE);
+constexpr RenderStatesMask RS_WIREFRAME     = RSMask(FILL_WIREFRAME) | RSMask(CULL_BACK) | RSMask(FRONT_CLOCKWISE);
+constexpr RenderStatesMask RS_CULL_NONE_CW  = RSMask(FILL_SOLID)     | RSMask(CULL_NONE) | RSMask(FRONT_CLOCKWISE);
+constexpr RenderStatesMask RS_CULL_NONE_CCW = RSMask(FILL_SOLID)     | RSMask(CULL_NONE) | RSMask(FRONT_COUNTER_CLOCKWISE);
+
+///////////////////////////////////////////////////////////
+
 class RenderStates
 {
 public:
@@ -60,49 +80,60 @@ public:
     void InitAll(ID3D11Device* pDevice, const bool multisampleEnable);
     void DestroyAll();
 
-    inline void ResetRS (ID3D11DeviceContext* pDeviceContext) { SetRS(pDeviceContext, { FILL_SOLID, CULL_BACK, FRONT_CLOCKWISE }); }
-    inline void ResetBS (ID3D11DeviceContext* pDeviceContext) { SetBS(pDeviceContext, ALPHA_DISABLE); }
-    inline void ResetDSS(ID3D11DeviceContext* pDeviceContext) { pDeviceContext->OMSetDepthStencilState(0, 0); }
+    inline void ResetRS (ID3D11DeviceContext* pDeviceContext) { SetRS(pDeviceContext, RS_DEFAULT); }
+    inline void ResetBS (ID3D11DeviceContext* pDeviceContext) { SetBS(pDeviceContext, RSMask(ALPHA_DISABLE)); }
+    inline void ResetDSS(ID3D11DeviceContext* pDeviceContext) { BindDSS(pDeviceContext, nullptr, 0); }
+
+    // after it all the states are bound through the cache (filters redundant binds)
+    inline void SetStateCache(Render::StateCache* pCache) { pStateCache_ = pCache; }
 
     // get blend state / raster state / depth stencil state
-    ID3D11BlendState*        GetBS(const eRenderState state);
-    ID3D11RasterizerState*   GetRS(const std::set<eRenderState>& states);
-    ID3D11DepthStencilState* GetDSS(const eRenderState state);
+    // (a raster state by a full mask of its params: fill + cull + front)
+    inline ID3D11BlendState*        GetBS (const eRenderState state)      const { return blendStates_[state]; }
+    inline ID3D11RasterizerState*   GetRS (const RenderStatesMask params) const { return rasterStates_[params & RS_RASTER_PARAMS]; }
+    inline ID3D11DepthStencilState* GetDSS(const eRenderState state)      const { return depthStencilStates_[state]; }
+
+    // returns a mask of params of the current rasterizer state
+    inline RenderStatesMask GetCurrentRSMask() const { return rasterStateMask_; }
 
-    // returns a hash to the pointer of the current rasterizer state
-    inline uint8_t GetCurrentRSHash() const { return rasterStateHash_; }
+    // set raster state: params of the input mask replace the current params
+    // of the same kind (fill/cull/front); the rest of params are kept
+    void SetRS (ID3D11DeviceContext* pDeviceContext, const RenderStatesMask params);
 
-    // set raster state
-    void SetRS       (ID3D11DeviceContext* pDeviceContext, const eRenderState state);
-    void SetRS       (ID3D11DeviceContext* pDeviceContext, const std::set<eRenderState>& states);
-    void SetRSByHash (ID3D11DeviceContext* pDeviceContext, const uint8_t hash);
+    // set blend state / depth stencil state by a mask with a single bit of the state
+    void SetBS (ID3D11DeviceContext* pDeviceContext, const RenderStatesMask state);
+    void SetDSS(ID3D11DeviceContext* pDeviceContext, const RenderStatesMask state, const UINT stencilRef);
 
-    // set blend state / depth stencil state
-    void SetBS       (ID3D11DeviceContext* pDeviceContext, const eRenderState key);
-    void SetDSS      (ID3D11DeviceContext* pDeviceContext, const eRenderState key, const UINT stencilRef);
+    // offscreen variants of blend states for a target which is cleared to (0,0,0,0) and
+    // composited over the scene later (see Render::LowResBlending): rgb is accumulated
+    // premultiplied by alpha, the alpha accumulates the coverage; only the states which
+    // can be composited this way have them (no subtracting/multiplying)
+    bool HasOffscreenBS(const RenderStatesMask state) const;
+    void SetOffscreenBS(ID3D11DeviceContext* pDeviceContext, const RenderStatesMask state);
 
 private:
     void InitAllRasterParams      (ID3D11Device* pDevice, bool multisampleEnable);
     void InitAllBlendStates       (ID3D11Device* pDevice);
+    void InitOffscreenBlendStates (ID3D11Device* pDevice);
     void InitAllDepthStencilStates(ID3D11Device* pDevice);
 
-    inline void ResetRasterStateHash() { rasterStateHash_ &= 0; }
-    inline void TurnOnRasterParam(const eRenderState rsParam) { rasterStateHash_ |= (1 << rsParam);  }
-
-    ID3D11RasterizerState* GetRasterStateByHash(const uint8_t hash);
+    void PrintErrAboutRSMask(const RenderStatesMask mask);
 
-    void UpdateRSHash(const std::set<eRenderState>& rsParams);
-    void PrintErrAboutRSHash(const uint8_t bitfield);
+    void BindRS (ID3D11DeviceContext* pContext, ID3D11RasterizerState* pRS);
+    void BindBS (ID3D11DeviceContext* pContext, ID3D11BlendState* pBS, const FLOAT* blendFactor);
+    void BindDSS(ID3D11DeviceContext* pContext, ID3D11DepthStencilState* pDSS, const UINT stencilRef);
 
 private:
-    std::map<eRenderState, ID3D11BlendState*>         blendStates_;
-    std::map<uint8_t,      ID3D11RasterizerState*>    rasterStates_;
-    std::map<eRenderState, ID3D11DepthStencilState*>  depthStencilStates_;
-
-    // rasterizer state related stuff
-    uint8_t rasterStateHash_     { 0b0000'0000 };              // hash to particular rasterizer state
-    uint8_t turnOffCullModesHash_{ 0b1111'1111 };              // using this hash we turn off ALL the CULL modes at the same time
-    uint8_t turnOffFillModesHash_{ 0b1111'1111 };              // using this hash we turn off ALL the FILL modes at the same time
+    // all the states are precreated: blend and depth stencil states by the bit
+    // of their state, raster states by masks of their params (nullptr: no state)
+    ID3D11BlendState*        blendStates_[NUM_RENDER_STATES]{ nullptr };
+    ID3D11BlendState*        offscreenBlendStates_[NUM_RENDER_STATES]{ nullptr };
+    ID3D11RasterizerState*   rasterStates_[RS_RASTER_PARAMS + 1]{ nullptr };
+    ID3D11DepthStencilState* depthStencilStates_[NUM_RENDER_STATES]{ nullptr };
+
+    RenderStatesMask         rasterStateMask_ = RS_DEFAULT;     // params of the current rasterizer state
+
+    Render::StateCache* pStateCache_ = nullptr;                // is owned by the Render module
 };
 
 }
@@ -0,0 +1,392 @@
+// =================================================================================
+// Filename:     SoftwareOcclusion.cpp
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "SoftwareOcclusion.h"
+#include "../Model/BasicModel.h"
+#include <JobSystem.h>
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+// a triangle with a vertex closer than it (in clip space w) is dropped: it is
+// conservative since a missing occluder can only make something visible
+static constexpr float NEAR_W = 1e-3f;
+
+
+//---------------------------------------------------------
+// Desc:   get the proxy of the model: positions and indices of its coarsest
+//         LOD (all the subsets) with only used vertices
+// Ret:    nullptr if the model can't be an occluder (it is skinned, has no CPU
+//         copy of geometry or its proxy is too complex)
+//---------------------------------------------------------
+const OccluderProxy* SoftwareOcclusion::GetProxy(const BasicModel& model)
+{
+    auto it = proxies_.find(model.GetID());
+
+    if (it != proxies_.end())
+        return it->second.IsEmpty() ? nullptr : &it->second;
+
+    OccluderProxy& proxy = proxies_[model.GetID()];
+
+    if (model.IsSkinned() || !model.vertices_ || !model.indices_)
+        return nullptr;
+
+    const int lod        = model.GetNumLods() - 1;
+    const int numSubsets = model.GetNumSubsets();
+    int       numIndices = 0;
+
+    for (int i = 0; i < numSubsets; ++i)
+        numIndices += (int)model.meshes_.subsets_[i].GetIndexCount(lod);
+
+    if ((numIndices == 0) || (numIndices > MAX_PROXY_TRIANGLES * 3))
+        return nullptr;
+
+    // remap vertices of the model into a compact set of used ones
+    std::unordered_map<UINT, uint16> remap;
+    proxy.indices.reserve(numIndices);
+
+    for (int i = 0; i < numSubsets; ++i)
+    {
+        const MeshGeometry::Subset& subset = model.meshes_.subsets_[i];
+        const UINT* indices = model.indices_ + subset.GetIndexStart(lod);
+        const int   count   = (int)subset.GetIndexCount(lod);
+
+        for (int j = 0; j < count; ++j)
+        {
+            // NOTE: indices are relative to the subset's vertexStart
+            const UINT vertexIdx = subset.vertexStart + indices[j];
+            auto       found     = remap.find(vertexIdx);
+
+            if (found == remap.end())
+            {
+                if (proxy.positions.size() >= MAX_PROXY_VERTICES)
+                {
+                    proxy.positions.clear();
+                    proxy.indices.clear();
+                    return nullptr;
+                }
+
+                found = remap.emplace(vertexIdx, (uint16)proxy.positions.size()).first;
+                proxy.positions.push_back(model.vertices_[vertexIdx].position);
+            }
+
+            proxy.indices.push_back(found->second);
+        }
+    }
+
+    return &proxy;
+}
+
+///////////////////////////////////////////////////////////
+
+void SoftwareOcclusion::ClearProxies()
+{
+    proxies_.clear();
+}
+
+///////////////////////////////////////////////////////////
+
+void SoftwareOcclusion::BeginFrame(const XMMATRIX& viewProj)
+{
+    viewProj_     = viewProj;
+    hasOccluders_ = false;
+
+    occluders_.clear();
+    triangles_.clear();
+}
+
+///////////////////////////////////////////////////////////
+
+void SoftwareOcclusion::AddOccluder(const OccluderProxy* pProxy, const XMMATRIX& world)
+{
+    if (!pProxy || pProxy->IsEmpty() || (occluders_.size() >= MAX_OCCLUDERS))
+        return;
+
+    occluders_.push_back(Occluder{ pProxy, world, (index)triangles_.size() });
+    triangles_.resize_uninitialized(triangles_.size() + pProxy->indices.size() / 3);
+}
+
+//---------------------------------------------------------
+// Desc:   set up triangles of all the queued occluders and rasterize them:
+//         both stages are executed by jobs (per occluder and per tile)
+//---------------------------------------------------------
+void SoftwareOcclusion::Rasterize()
+{
+    if (depths_.size() != WIDTH * HEIGHT)
+        depths_.resize(WIDTH * HEIGHT);
+
+    if (occluders_.empty())
+        return;
+
+    g_JobSystem.ParallelFor(occluders_.size(), 1, [&](const index start, const index end)
+    {
+        for (index i = start; i < end; ++i)
+            SetupTriangles(occluders_[i]);
+    });
+
+    g_JobSystem.ParallelFor(NUM_TILES_X * NUM_TILES_Y, 1, [&](const index start, const index end)
+    {
+        for (index i = start; i < end; ++i)
+            RasterizeTile((int)(i % NUM_TILES_X), (int)(i / NUM_TILES_X));
+    });
+
+    hasOccluders_ = true;
+}
+
+//---------------------------------------------------------
+// Desc:   transform the occluder's proxy into pixels of the depth buffer and
+//         compute edge functions and the depth plane of each its triangle
+//         (both windings are rasterized: proxies aren't always closed)
+//---------------------------------------------------------
+void SoftwareOcclusion::SetupTriangles(const Occluder& occluder)
+{
+    const OccluderProxy& proxy    = *occluder.pProxy;
+    const XMMATRIX       worldVP  = occluder.world * viewProj_;
+    const index          numVerts = proxy.positions.size();
+    const index          numTris  = proxy.indices.size() / 3;
+
+    XMFLOAT4 screen[MAX_PROXY_VERTICES];      // x, y in pixels, z in NDC, w of clip space
+
+    for (index i = 0; i < numVerts; ++i)
+    {
+        const XMVECTOR clip = XMVector3Transform(XMLoadFloat3(&proxy.positions[i]), worldVP);
+        const float    w    = XMVectorGetW(clip);
+
+        screen[i].w = w;
+
+        if (w < NEAR_W)
+            continue;
+
+        const float invW = 1.0f / w;
+
+        screen[i].x = ( XMVectorGetX(clip) * invW * 0.5f + 0.5f) * (float)WIDTH;
+        screen[i].y = (-XMVectorGetY(clip) * invW * 0.5f + 0.5f) * (float)HEIGHT;
+        screen[i].z =   XMVectorGetZ(clip) * invW;
+    }
+
+    OccluderTriangle* tris = triangles_.data() + occluder.firstTriangle;
+
+    for (index t = 0; t < numTris; ++t)
+    {
+        OccluderTriangle& tri = tris[t];
+        const XMFLOAT4*   v0  = &screen[proxy.indices[t*3 + 0]];
+        const XMFLOAT4*   v1  = &screen[proxy.indices[t*3 + 1]];
+        const XMFLOAT4*   v2  = &screen[proxy.indices[t*3 + 2]];
+
+        // mark as empty till it is surely rasterized
+        tri.minX = 1;
+        tri.maxX = 0;
+
+        if ((v0->w < NEAR_W) || (v1->w < NEAR_W) || (v2->w < NEAR_W))
+            continue;
+
+        float area = (v1->x - v0->x) * (v2->y - v0->y) - (v2->x - v0->x) * (v1->y - v0->y);
+
+        if (fabsf(area) < 1e-6f)
+            continue;
+
+        // make the winding positive so inside is where all the edge functions are >= 0
+        if (area < 0.0f)
+        {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        // bbox of pixel centers
+        const float fMinX = std::min(v0->x, std::min(v1->x, v2->x));
+        const float fMaxX = std::max(v0->x, std::max(v1->x, v2->x));
+        const float fMinY = std::min(v0->y, std::min(v1->y, v2->y));
+        const float fMaxY = std::max(v0->y, std::max(v1->y, v2->y));
+
+        if ((fMaxX < 0.0f) || (fMinX > (float)WIDTH) || (fMaxY < 0.0f) || (fMinY > (float)HEIGHT))
+            continue;
+
+        const XMFLOAT4* verts[3] = { v0, v1, v2 };
+
+        for (int e = 0; e < 3; ++e)
+        {
+            const XMFLOAT4& a = *verts[e];
+            const XMFLOAT4& b = *verts[(e + 1) % 3];
+
+            tri.edgeA[e] = a.y - b.y;
+            tri.edgeB[e] = b.x - a.x;
+            tri.edgeC[e] = (b.y - a.y) * a.x - (b.x - a.x) * a.y;
+        }
+
+        const float dx1 = v1->x - v0->x,  dy1 = v1->y - v0->y,  dz1 = v1->z - v0->z;
+        const float dx2 = v2->x - v0->x,  dy2 = v2->y - v0->y,  dz2 = v2->z - v0->z;
+        const float invArea = 1.0f / area;
+
+        tri.dzdx = (dz1 * dy2 - dz2 * dy1) * invArea;
+        tri.dzdy = (dx1 * dz2 - dx2 * dz1) * invArea;
+        tri.z0   = v0->z - tri.dzdx * v0->x - tri.dzdy * v0->y;
+
+        // clamp before conversion: vertices close to the near plane are far outside
+        tri.minX = (int)std::max(fMinX - 0.5f, 0.0f);
+        tri.minY = (int)std::max(fMinY - 0.5f, 0.0f);
+        tri.maxX = (int)std::min(fMaxX + 0.5f, (float)(WIDTH  - 1));
+        tri.maxY = (int)std::min(fMaxY + 0.5f, (float)(HEIGHT - 1));
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   clear the tile and rasterize into it all the triangles which overlap
+//         it, 4 pixels per step: a pixel is covered if its center is inside of
+//         all the 3 edges, and it keeps the nearest depth
+//---------------------------------------------------------
+void SoftwareOcclusion::RasterizeTile(const int tileX, const int tileY)
+{
+    const int tx0 = tileX * TILE_WIDTH;
+    const int ty0 = tileY * TILE_HEIGHT;
+    const int tx1 = tx0 + TILE_WIDTH - 1;
+    const int ty1 = ty0 + TILE_HEIGHT - 1;
+
+    const __m128 farDepth  = _mm_set1_ps(1.0f);
+    const __m128 zero      = _mm_setzero_ps();
+    const __m128 pxOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+    for (int y = ty0; y <= ty1; ++y)
+    {
+        float* row = depths_.data() + y * WIDTH;
+
+        for (int x = tx0; x <= tx1; x += 4)
+            _mm_storeu_ps(row + x, farDepth);
+    }
+
+    const index numTris = triangles_.size();
+
+    for (index t = 0; t < numTris; ++t)
+    {
+        const OccluderTriangle& tri = triangles_[t];
+
+        if ((tri.minX > tri.maxX) ||
+            (tri.maxX < tx0) || (tri.minX > tx1) ||
+            (tri.maxY < ty0) || (tri.minY > ty1))
+            continue;
+
+        // x range is aligned by 4 (the tile is aligned as well)
+        const int x0 = std::max(tri.minX, tx0) & ~3;
+        const int x1 = std::min(tri.maxX, tx1);
+        const int y0 = std::max(tri.minY, ty0);
+        const int y1 = std::min(tri.maxY, ty1);
+
+        const __m128 a0 = _mm_set1_ps(tri.edgeA[0]);
+        const __m128 a1 = _mm_set1_ps(tri.edgeA[1]);
+        const __m128 a2 = _mm_set1_ps(tri.edgeA[2]);
+        const __m128 step0 = _mm_set1_ps(tri.edgeA[0] * 4.0f);
+        const __m128 step1 = _mm_set1_ps(tri.edgeA[1] * 4.0f);
+        const __m128 step2 = _mm_set1_ps(tri.edgeA[2] * 4.0f);
+        const __m128 dzdx  = _mm_set1_ps(tri.dzdx);
+        const __m128 zStep = _mm_set1_ps(tri.dzdx * 4.0f);
+
+        const __m128 px = _mm_add_ps(_mm_set1_ps((float)x0), pxOffsets);
+
+        for (int y = y0; y <= y1; ++y)
+        {
+            const float py = (float)y + 0.5f;
+
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), _mm_set1_ps(tri.edgeB[0] * py + tri.edgeC[0]));
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), _mm_set1_ps(tri.edgeB[1] * py + tri.edgeC[1]));
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), _mm_set1_ps(tri.edgeB[2] * py + tri.edgeC[2]));
+            __m128 z  = _mm_add_ps(_mm_mul_ps(dzdx, px), _mm_set1_ps(tri.z0 + tri.dzdy * py));
+
+            float* row = depths_.data() + y * WIDTH;
+
+            for (int x = x0; x <= x1; x += 4)
+            {
+                const __m128 mask = _mm_and_ps(
+                    _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                    _mm_cmpge_ps(e2, zero));
+
+                if (_mm_movemask_ps(mask))
+                {
+                    const __m128 depth   = _mm_loadu_ps(row + x);
+                    const __m128 nearest = _mm_min_ps(depth, z);
+
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, nearest), _mm_andnot_ps(mask, depth)));
+                }
+
+                e0 = _mm_add_ps(e0, step0);
+                e1 = _mm_add_ps(e1, step1);
+                e2 = _mm_add_ps(e2, step2);
+                z  = _mm_add_ps(z, zStep);
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   the box is hidden if the nearest depth of its corners is behind
+//         the depth of each pixel of its screen rect
+//---------------------------------------------------------
+bool SoftwareOcclusion::IsVisible(const XMFLOAT3& aabbMin, const XMFLOAT3& aabbMax) const
+{
+    if (!hasOccluders_)
+        return true;
+
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        const XMVECTOR corner = XMVectorSet(
+            (i & 1) ? aabbMax.x : aabbMin.x,
+            (i & 2) ? aabbMax.y : aabbMin.y,
+            (i & 4) ? aabbMax.z : aabbMin.z,
+            1.0f);
+
+        const XMVECTOR clip = XMVector4Transform(corner, viewProj_);
+        const float    w    = XMVectorGetW(clip);
+
+        // the box crosses the near plane: we can't say anything
+        if (w < NEAR_W)
+            return true;
+
+        XMFLOAT3 ndc;
+        XMStoreFloat3(&ndc, XMVectorScale(clip, 1.0f / w));
+
+        minX = (ndc.x < minX) ? ndc.x : minX;
+        maxX = (ndc.x > maxX) ? ndc.x : maxX;
+        minY = (ndc.y < minY) ? ndc.y : minY;
+        maxY = (ndc.y > maxY) ? ndc.y : maxY;
+        minZ = (ndc.z < minZ) ? ndc.z : minZ;
+    }
+
+    // the box is outside of the screen (it is culled by the frustum anyway)
+    if ((maxX < -1.0f) || (minX > 1.0f) || (maxY < -1.0f) || (minY > 1.0f))
+        return true;
+
+    minX = std::max(minX, -1.0f);
+    maxX = std::min(maxX,  1.0f);
+    minY = std::max(minY, -1.0f);
+    maxY = std::min(maxY,  1.0f);
+
+    // NDC => pixels (y goes down); x range is aligned by 4
+    const int x0 = (int)((minX * 0.5f + 0.5f) * WIDTH) & ~3;
+    const int x1 = std::min((int)((maxX * 0.5f + 0.5f) * WIDTH),  WIDTH - 1);
+    const int y0 = (int)((0.5f - maxY * 0.5f) * HEIGHT);
+    const int y1 = std::min((int)((0.5f - minY * 0.5f) * HEIGHT), HEIGHT - 1);
+
+    const __m128 boxZ = _mm_set1_ps(minZ);
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        const float* row = depths_.data() + y * WIDTH;
+
+        for (int x = x0; x <= x1; x += 4)
+        {
+            if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxZ)))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace Core
@@ -0,0 +1,124 @@
+// =================================================================================
+// Filename:     SoftwareOcclusion.h
+// Description:  masked software occlusion culling on CPU (an alternative of the
+//               Hi-Z buffer for configs with a weak GPU or without the readback):
+//
+//               - the biggest frustum visible entts are chosen as occluders each
+//                 frame; each of them is drawn by a low-poly proxy of its model
+//                 (the coarsest LOD which was generated at import, see MeshSimplifier);
+//               - proxies are transformed and set up on worker threads, then tiles
+//                 of a coarse depth buffer are rasterized in parallel (SSE: 4 pixels
+//                 per step, the coverage is a mask of 3 edge functions);
+//               - world AABBs of the frustum visible entts are tested against the
+//                 buffer of the same frame so there is no latency as of Hi-Z
+//
+//               NOTE: the depth is the D3D NDC z (0 - near, 1 - far)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <DirectXMath.h>
+#include <unordered_map>
+
+
+namespace Core
+{
+
+class BasicModel;
+
+// =================================================================================
+// Data structures
+// =================================================================================
+struct OccluderProxy
+{
+    inline bool IsEmpty() const { return indices.empty(); }
+
+    cvector<DirectX::XMFLOAT3> positions;       // in model space
+    cvector<uint16>            indices;         // a triangle list
+};
+
+///////////////////////////////////////////////////////////
+
+struct OccluderTriangle
+{
+    float edgeA[3];                             // edge functions: A*x + B*y + C >= 0 inside
+    float edgeB[3];
+    float edgeC[3];
+    float z0;                                   // depth plane: z0 + dzdx*x + dzdy*y
+    float dzdx;
+    float dzdy;
+    int   minX, minY, maxX, maxY;               // pixel bbox clipped by the buffer (empty if minX > maxX)
+};
+
+// =================================================================================
+// Class
+// =================================================================================
+class SoftwareOcclusion
+{
+public:
+    static constexpr int WIDTH               = 256;     // pixels of the depth buffer
+    static constexpr int HEIGHT              = 128;
+    static constexpr int TILE_WIDTH          = 64;      // a tile is rasterized by a single job (must be a multiple of 4)
+    static constexpr int TILE_HEIGHT         = 32;
+    static constexpr int NUM_TILES_X         = WIDTH / TILE_WIDTH;
+    static constexpr int NUM_TILES_Y         = HEIGHT / TILE_HEIGHT;
+
+    static constexpr int MAX_OCCLUDERS       = 64;      // per frame
+    static constexpr int MAX_PROXY_TRIANGLES = 512;     // models with a more complex proxy aren't occluders
+    static constexpr int MAX_PROXY_VERTICES  = 1024;
+
+public:
+    SoftwareOcclusion() {}
+
+    // restrict a copying of this class instance
+    SoftwareOcclusion(const SoftwareOcclusion&) = delete;
+    SoftwareOcclusion& operator=(const SoftwareOcclusion&) = delete;
+
+    // get the proxy of the model (it is built by the first request);
+    // ret: nullptr if the model can't be an occluder
+    const OccluderProxy* GetProxy(const BasicModel& model);
+
+    // drop built proxies (their models are changed or unloaded)
+    void ClearProxies();
+
+    // start a new frame: occluders of the prev one are dropped
+    void BeginFrame(const DirectX::XMMATRIX& viewProj);
+
+    // queue an occluder to be rasterized by Rasterize()
+    void AddOccluder(const OccluderProxy* pProxy, const DirectX::XMMATRIX& world);
+
+    // rasterize queued occluders into the depth buffer (on the job system)
+    void Rasterize();
+
+    // test a world AABB against the depth buffer:
+    // returns false only if the box is surely hidden behind occluders
+    bool IsVisible(const DirectX::XMFLOAT3& aabbMin, const DirectX::XMFLOAT3& aabbMax) const;
+
+    inline int GetNumOccluders() const { return (int)occluders_.size(); }
+    inline int GetNumTriangles() const { return (int)triangles_.size(); }
+
+private:
+    struct Occluder
+    {
+        const OccluderProxy* pProxy;
+        DirectX::XMMATRIX    world;
+        index                firstTriangle;     // in triangles_
+    };
+
+    void SetupTriangles(const Occluder& occluder);
+    void RasterizeTile(const int tileX, const int tileY);
+
+private:
+    std::unordered_map<ModelID, OccluderProxy> proxies_;   // model => proxy (empty if the model can't be an occluder)
+
+    DirectX::XMMATRIX         viewProj_ = DirectX::XMMatrixIdentity();
+    cvector<Occluder>         occluders_;
+    cvector<OccluderTriangle> triangles_;
+    cvector<float>            depths_;                     // WIDTH x HEIGHT, rows go down
+    bool                      hasOccluders_ = false;       // is anything rasterized in this frame?
+};
+
+} // namespace Core
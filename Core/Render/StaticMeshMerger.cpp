@@ -0,0 +1,610 @@
+// =================================================================================
+// Filename:     StaticMeshMerger.cpp
+// Description:  implementation of the StaticMeshMerger's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "StaticMeshMerger.h"
+#include "../Model/ModelMgr.h"
+#include "../Model/MeshOptimizer.h"
+#include "../Model/MeshSimplifier.h"
+#include "../Model/MeshletBuilder.h"
+#include "../Model/MeshKernels.h"
+#include "Entity/EntityMgr.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// Desc:  a key of the grid cell which contains the point (over the XZ plane)
+//---------------------------------------------------------
+static int64_t GetCellKey(const float x, const float z, const float cellSize)
+{
+    const int32 cx = (int32)floorf(x / cellSize);
+    const int32 cz = (int32)floorf(z / cellSize);
+
+    return ((int64_t)cx << 32) | (uint32)cz;
+}
+
+//---------------------------------------------------------
+// Desc:  find a cell by its entt ID; return -1 if there is no such
+//---------------------------------------------------------
+template <typename TCell>
+static index FindCell(const cvector<TCell>& cells, const EntityID id)
+{
+    for (index i = 0; i < cells.size(); ++i)
+    {
+        if (cells[i].id == id)
+            return i;
+    }
+
+    return -1;
+}
+
+
+// =================================================================================
+//                               PUBLIC METHODS
+// =================================================================================
+int StaticMeshMerger::Merge(
+    ID3D11Device* pDevice,
+    ECS::EntityMgr& mgr,
+    const StaticMergeParams& params)
+{
+    CAssert::True(pDevice != nullptr,     "input ptr to the device == nullptr");
+    CAssert::True(params.cellSize > 0.0f, "size of a merging cell must be > 0");
+
+    params_ = params;
+
+    // cells which were loaded with the scene must be known before the new ones are created
+    SyncCells(mgr);
+
+    // ---------------------------------------------
+    // only static entts with default render states can be merged
+
+    cvector<EntityID> staticEntts;
+    mgr.renderSystem_.GetStaticEntts(staticEntts);
+
+    if (staticEntts.empty())
+        return 0;
+
+    ECS::RenderStatesSystem::EnttsRenderStatesData rsData;
+    mgr.renderStatesSystem_.SeparateEnttsByRenderStates(staticEntts, rsData);
+
+    const cvector<EntityID>& defaultEntts = rsData.enttsDefault_.ids_;
+
+    if (defaultEntts.empty())
+        return 0;
+
+    cvector<ECS::RenderShaderType> shaderTypes;
+    cvector<XMMATRIX>              worlds;
+
+    mgr.renderSystem_.GetRenderingDataOfEntts(defaultEntts.data(), defaultEntts.size(), shaderTypes);
+    mgr.transformSystem_.GetWorlds(defaultEntts.data(), defaultEntts.size(), worlds);
+
+    // ---------------------------------------------
+    // select small props and put each into its cell
+
+    struct Candidate
+    {
+        int64_t  key;
+        EntityID id;
+        XMFLOAT3 center;
+    };
+
+    cvector<Candidate> candidates;
+    candidates.reserve(defaultEntts.size());
+
+    const float maxExtent = params.cellSize * 0.5f;
+
+    for (index i = 0; i < defaultEntts.size(); ++i)
+    {
+        const EntityID id = defaultEntts[i];
+
+        const bool canBeMerged =
+            (shaderTypes[i] == ECS::LIGHT_SHADER) &&
+            (mgr.renderSystem_.GetMergedInto(id) == INVALID_ENTITY_ID) &&
+            (FindCell(cells_, id) == -1) &&
+            !mgr.texTransformSystem_.HasTexTransform(id);
+
+        if (!canBeMerged)
+            continue;
+
+        const ModelID modelID = mgr.modelSystem_.GetModelIdRelatedToEntt(id);
+
+        if (modelID == INVALID_MODEL_ID)
+            continue;
+
+        const BasicModel& model = g_ModelMgr.GetModelByID(modelID);
+
+        if ((model.vertices_ == nullptr) || (model.numVertices_ > (uint32)params.maxPropVertices))
+            continue;
+
+        BoundingBox worldAABB;
+        model.GetModelAABB().Transform(worldAABB, worlds[i]);
+
+        const XMFLOAT3& ext = worldAABB.Extents;
+
+        if ((ext.x > maxExtent) || (ext.y > maxExtent) || (ext.z > maxExtent))
+            continue;
+
+        const XMFLOAT3& c = worldAABB.Center;
+        candidates.push_back({ GetCellKey(c.x, c.z, params.cellSize), id, c });
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+    {
+        return (a.key != b.key) ? (a.key < b.key) : (a.id < b.id);
+    });
+
+    // ---------------------------------------------
+    // create a cell per group of props
+
+    cvector<EntityID> props;
+    int numCells       = 0;
+    int numMergedProps = 0;
+
+    for (index start = 0; start < candidates.size(); )
+    {
+        index end = start + 1;
+
+        while ((end < candidates.size()) && (candidates[end].key == candidates[start].key))
+            ++end;
+
+        if ((int)(end - start) >= MIN_PROPS_PER_CELL)
+        {
+            // the mesh is built relatively to the cell's center (at the average height of its props)
+            const int32 cx = (int32)(candidates[start].key >> 32);
+            const int32 cz = (int32)(uint32)(candidates[start].key & 0xFFFFFFFF);
+            float       sumY = 0.0f;
+
+            props.clear();
+
+            for (index i = start; i < end; ++i)
+            {
+                props.push_back(candidates[i].id);
+                sumY += candidates[i].center.y;
+            }
+
+            const XMFLOAT3 center =
+            {
+                ((float)cx + 0.5f) * params.cellSize,
+                sumY / (float)props.size(),
+                ((float)cz + 0.5f) * params.cellSize,
+            };
+
+            if (CreateCell(pDevice, mgr, props.data(), props.size(), center) != INVALID_ENTITY_ID)
+            {
+                ++numCells;
+                numMergedProps += (int)props.size();
+            }
+        }
+
+        start = end;
+    }
+
+    structureVersion_ = mgr.GetStructureVersion();
+
+    LogMsgf("static props merging: %d cells are created (%d props are merged)",
+            numCells, numMergedProps);
+
+    return numCells;
+}
+
+///////////////////////////////////////////////////////////
+
+void StaticMeshMerger::Unmerge(ECS::EntityMgr& mgr)
+{
+    // destroy all the cells (their models are kept for the next merging)
+
+    SyncCells(mgr);
+
+    while (!cells_.empty())
+        RemoveCell(mgr, cells_.size() - 1, true);
+
+    structureVersion_ = mgr.GetStructureVersion();
+}
+
+///////////////////////////////////////////////////////////
+
+bool StaticMeshMerger::Update(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
+{
+    bool isChanged = false;
+
+    // entts were created/destroyed: check if any cell or any of its props is destroyed
+    if (structureVersion_ != mgr.GetStructureVersion())
+    {
+        SyncCells(mgr);
+
+        cvector<EntityID> props;
+
+        for (index i = 0; i < cells_.size(); )
+        {
+            if (!mgr.CheckEnttExist(cells_[i].id))
+            {
+                RemoveCell(mgr, i, false);
+                isChanged = true;
+                continue;
+            }
+
+            GetCellProps(mgr, cells_[i].id, props);
+
+            if ((int)props.size() != cells_[i].numProps)
+            {
+                // the rebuilt cell is pushed to the end (or is removed)
+                RebuildCell(pDevice, mgr, i);
+                isChanged = true;
+                continue;
+            }
+
+            ++i;
+        }
+    }
+
+    // rebuild cells whose props were moved
+    const cvector<EntityID>& changedEntts = mgr.transformSystem_.GetChangedEntts();
+
+    if (!cells_.empty() && !changedEntts.empty())
+    {
+        cvector<EntityID> movedCells;
+
+        for (const EntityID id : changedEntts)
+        {
+            const EntityID cellID = mgr.renderSystem_.GetMergedInto(id);
+
+            if ((cellID != INVALID_ENTITY_ID) && (std::find(movedCells.begin(), movedCells.end(), cellID) == movedCells.end()))
+                movedCells.push_back(cellID);
+        }
+
+        for (const EntityID cellID : movedCells)
+        {
+            const index cellIdx = FindCell(cells_, cellID);
+
+            if (cellIdx != -1)
+            {
+                RebuildCell(pDevice, mgr, cellIdx);
+                isChanged = true;
+            }
+        }
+    }
+
+    structureVersion_ = mgr.GetStructureVersion();
+    return isChanged;
+}
+
+
+// =================================================================================
+//                               PRIVATE METHODS
+// =================================================================================
+void StaticMeshMerger::SyncCells(ECS::EntityMgr& mgr)
+{
+    // add cells which are unknown yet (were loaded with the scene): the ECS
+    // keeps only the merged flags so cells are found by them
+
+    cvector<EntityID> ids;
+    cvector<EntityID> cellsIDs;
+    mgr.renderSystem_.GetMergedEntts(ids, cellsIDs);
+
+    for (const EntityID cellID : cellsIDs)
+    {
+        const index cellIdx = FindCell(cells_, cellID);
+
+        if (cellIdx != -1)
+            continue;
+
+        Cell cell;
+        cell.id       = cellID;
+        cell.modelID  = mgr.modelSystem_.GetModelIdRelatedToEntt(cellID);
+        cell.numProps = (int)std::count(cellsIDs.begin(), cellsIDs.end(), cellID);
+
+        cells_.push_back(cell);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+EntityID StaticMeshMerger::CreateCell(
+    ID3D11Device* pDevice,
+    ECS::EntityMgr& mgr,
+    const EntityID* props,
+    const size numProps,
+    const XMFLOAT3& center)
+{
+    // build a merged model of input props and create a cell entt which renders it
+
+    const ModelID modelID = AllocModel();
+    BasicModel&   model   = g_ModelMgr.GetModelByID(modelID);
+
+    if (!BuildCellModel(mgr, props, numProps, center, model))
+    {
+        freeModels_.push_back(modelID);
+        return INVALID_ENTITY_ID;
+    }
+
+    model.InitializeBuffers(pDevice);
+    snprintf(model.name_, sizeof(model.name_), "static_cell_%u", modelID);
+    model.type_ = eModelType::MergedCell;
+
+    // ---------------------------------------------
+
+    const EntityID id         = mgr.CreateEntity();
+    const size     numSubsets = model.GetNumSubsets();
+
+    ECS::RenderInitParams renderParams;
+    renderParams.shaderType   = ECS::LIGHT_SHADER;
+    renderParams.topologyType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+    cvector<MaterialID>        materialsIDs(numSubsets);
+    cvector<ECS::BoundingType> boundTypes(numSubsets, ECS::BoundingType::BOUND_BOX);
+
+    for (index i = 0; i < numSubsets; ++i)
+        materialsIDs[i] = model.meshes_.subsets_[i].materialID;
+
+    mgr.AddTransformComponent(id, center, { 0,0,0,1 }, 1.0f);
+    mgr.AddNameComponent(id, "static_cell_" + std::to_string(id));
+    mgr.AddModelComponent(id, modelID);
+    mgr.AddMaterialComponent(id, materialsIDs.data(), numSubsets, true);
+    mgr.AddRenderingComponent(id, renderParams);
+    mgr.AddBoundingComponent(id, numSubsets, boundTypes.data(), model.GetSubsetsAABB());
+    mgr.renderSystem_.SetStatic(&id, 1, true);
+
+    // the props are rendered by the cell from now on
+    mgr.renderSystem_.SetMergedInto(props, numProps, id);
+
+    Cell cell;
+    cell.id       = id;
+    cell.modelID  = modelID;
+    cell.numProps = (int)numProps;
+    cells_.push_back(cell);
+
+    return id;
+}
+
+///////////////////////////////////////////////////////////
+
+bool StaticMeshMerger::BuildCellModel(
+    ECS::EntityMgr& mgr,
+    const EntityID* props,
+    const size numProps,
+    const XMFLOAT3& center,
+    BasicModel& model)
+{
+    // pre-transform geometry (LOD 0) of input props into a single model:
+    // a subset per material; positions are relative to the cell's center
+
+    cvector<XMMATRIX> worlds;
+    cvector<bool>     meshBasedFlags;
+
+    mgr.transformSystem_.GetWorlds(props, numProps, worlds);
+    mgr.materialSystem_.GetMaterialsFlagsByEntts(props, numProps, meshBasedFlags);
+
+    struct Part
+    {
+        MaterialID        matID;
+        index             propIdx;
+        const BasicModel* pSrc;
+        int               subsetIdx;
+    };
+
+    cvector<Part> parts;
+    uint32 numVertices = 0;
+    uint32 numIndices  = 0;
+
+    for (index i = 0; i < numProps; ++i)
+    {
+        const ModelID     srcID = mgr.modelSystem_.GetModelIdRelatedToEntt(props[i]);
+        const BasicModel& src   = g_ModelMgr.GetModelByID(srcID);
+
+        if ((srcID == INVALID_MODEL_ID) || (src.vertices_ == nullptr))
+            continue;
+
+        const ECS::MaterialData matData = mgr.materialSystem_.GetDataByEnttID(props[i]);
+
+        for (int s = 0; s < src.numSubsets_; ++s)
+        {
+            const MeshGeometry::Subset& subset = src.meshes_.subsets_[s];
+
+            const MaterialID matID = (meshBasedFlags[i] || (s >= (int)matData.materialsIDs.size()))
+                ? subset.materialID
+                : matData.materialsIDs[s];
+
+            parts.push_back({ matID, i, &src, s });
+            numVertices += subset.vertexCount;
+            numIndices  += subset.indexCount;
+        }
+    }
+
+    if (parts.empty() || (numIndices == 0))
+        return false;
+
+    // group parts by materials (the order of props is kept inside a group)
+    std::sort(parts.begin(), parts.end(), [](const Part& a, const Part& b)
+    {
+        if (a.matID != b.matID)
+            return a.matID < b.matID;
+
+        return (a.propIdx != b.propIdx) ? (a.propIdx < b.propIdx) : (a.subsetIdx < b.subsetIdx);
+    });
+
+    int numSubsets = 1;
+
+    for (index i = 1; i < parts.size(); ++i)
+        numSubsets += (parts[i].matID != parts[i-1].matID);
+
+    // ---------------------------------------------
+    // fill in the geometry
+
+    const ModelID id = model.id_;
+    model.Shutdown();
+    model.id_ = id;
+    model.AllocateMemory((int)numVertices, (int)numIndices, numSubsets);
+
+    const XMVECTOR offset    = XMLoadFloat3(&center);
+    uint32         vertexIdx = 0;
+    uint32         indexIdx  = 0;
+    int            subsetIdx = -1;
+
+    for (index i = 0; i < parts.size(); ++i)
+    {
+        const Part& part = parts[i];
+
+        // start a new subset for the next material
+        if ((i == 0) || (part.matID != parts[i-1].matID))
+        {
+            ++subsetIdx;
+
+            MeshGeometry::Subset& dst = model.meshes_.subsets_[subsetIdx];
+            dst.id          = (uint16_t)subsetIdx;
+            dst.vertexStart = vertexIdx;
+            dst.indexStart  = indexIdx;
+            dst.vertexCount = 0;
+            dst.indexCount  = 0;
+            dst.materialID  = part.matID;
+
+            snprintf(g_String, sizeof(g_String), "material_%u", part.matID);
+            model.meshes_.SetSubsetName((SubsetID)subsetIdx, g_String);
+        }
+
+        MeshGeometry::Subset&       dst     = model.meshes_.subsets_[subsetIdx];
+        const MeshGeometry::Subset& srcSub  = part.pSrc->meshes_.subsets_[part.subsetIdx];
+        const XMMATRIX&             world   = worlds[part.propIdx];
+        const Vertex3D*             srcVerts = part.pSrc->vertices_ + srcSub.vertexStart;
+        const UINT*                 srcIdxs  = part.pSrc->indices_  + srcSub.indexStart;
+
+        // indices are relative to the start vertex of the subset
+        const uint32 baseVertex = vertexIdx - dst.vertexStart;
+
+        // copy vertices and bake the world (relatively to the offset) right in place
+        Vertex3D* outVerts = model.vertices_ + vertexIdx;
+        std::copy(srcVerts, srcVerts + srcSub.vertexCount, outVerts);
+
+        const XMMATRIX toMerged = world * XMMatrixTranslationFromVector(XMVectorNegate(offset));
+
+        MeshKernels::TransformPoints(
+            &outVerts[0].position, sizeof(Vertex3D),
+            &outVerts[0].position, sizeof(Vertex3D),
+            srcSub.vertexCount, toMerged);
+
+        MeshKernels::TransformDirections(
+            &outVerts[0].normal, sizeof(Vertex3D),
+            &outVerts[0].normal, sizeof(Vertex3D),
+            srcSub.vertexCount, world, true);
+
+        MeshKernels::TransformDirections(
+            &outVerts[0].tangent, sizeof(Vertex3D),
+            &outVerts[0].tangent, sizeof(Vertex3D),
+            srcSub.vertexCount, world, true);
+
+        vertexIdx += srcSub.vertexCount;
+
+        for (uint32 n = 0; n < srcSub.indexCount; ++n)
+            model.indices_[indexIdx++] = baseVertex + srcIdxs[n];
+
+        dst.vertexCount += srcSub.vertexCount;
+        dst.indexCount  += srcSub.indexCount;
+    }
+
+    // the same pipeline as for imported models
+    MeshOptimizer().Optimize(model);
+
+    model.ComputeSubsetsAABB();
+    model.ComputeModelAABB();
+
+    MeshSimplifier().GenerateLods(model, params_.numLods);
+    MeshletBuilder().Build(model);
+    model.BuildTriangleBVH();
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void StaticMeshMerger::RebuildCell(ID3D11Device* pDevice, ECS::EntityMgr& mgr, const index cellIdx)
+{
+    // recreate the cell by its current props (its model is reused)
+
+    const Cell cell = cells_[cellIdx];
+    cvector<EntityID> props;
+
+    GetCellProps(mgr, cell.id, props);
+
+    if ((int)props.size() < MIN_PROPS_PER_CELL)
+    {
+        RemoveCell(mgr, cellIdx, true);
+        return;
+    }
+
+    const XMFLOAT3 center = mgr.transformSystem_.GetPosition(cell.id);
+
+    cells_.erase(cellIdx);
+    mgr.DestroyEntities(&cell.id, 1);
+    freeModels_.push_back(cell.modelID);
+
+    if (CreateCell(pDevice, mgr, props.data(), props.size(), center) == INVALID_ENTITY_ID)
+        mgr.renderSystem_.SetMergedInto(props.data(), props.size(), INVALID_ENTITY_ID);
+}
+
+///////////////////////////////////////////////////////////
+
+void StaticMeshMerger::RemoveCell(ECS::EntityMgr& mgr, const index cellIdx, const bool destroyEntt)
+{
+    // props of the cell are rendered by themselves again
+
+    const Cell cell = cells_[cellIdx];
+    cvector<EntityID> props;
+
+    GetCellProps(mgr, cell.id, props);
+
+    if (!props.empty())
+        mgr.renderSystem_.SetMergedInto(props.data(), props.size(), INVALID_ENTITY_ID);
+
+    if (destroyEntt && mgr.CheckEnttExist(cell.id))
+        mgr.DestroyEntities(&cell.id, 1);
+
+    if (cell.modelID != INVALID_MODEL_ID)
+        freeModels_.push_back(cell.modelID);
+
+    cells_.erase(cellIdx);
+}
+
+///////////////////////////////////////////////////////////
+
+void StaticMeshMerger::GetCellProps(
+    ECS::EntityMgr& mgr,
+    const EntityID cellID,
+    cvector<EntityID>& outProps) const
+{
+    cvector<EntityID> ids;
+    cvector<EntityID> cellsIDs;
+
+    mgr.renderSystem_.GetMergedEntts(ids, cellsIDs);
+    outProps.clear();
+
+    for (index i = 0; i < ids.size(); ++i)
+    {
+        if (cellsIDs[i] == cellID)
+            outProps.push_back(ids[i]);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+ModelID StaticMeshMerger::AllocModel()
+{
+    // get a model of some removed cell or add a new one
+
+    if (!freeModels_.empty())
+    {
+        const ModelID id = freeModels_.back();
+        freeModels_.pop_back();
+        return id;
+    }
+
+    return g_ModelMgr.AddEmptyModel().GetID();
+}
+
+} // namespace Core
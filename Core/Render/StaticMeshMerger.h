@@ -0,0 +1,104 @@
+// =================================================================================
+// Filename:     StaticMeshMerger.h
+// Description:  merging of small static props into meshes per spatial cell:
+//
+//               - static entts with default render states and small models are
+//                 put into cells of a XZ grid; props of a cell are pre-transformed
+//                 into a single model (relatively to the cell's center) which has
+//                 one subset per material;
+//               - each cell is an entity (model, materials, bounding) so it is
+//                 culled as a unit and rendered by a few draws instead of a few
+//                 per prop;
+//               - the original entts are kept for editing: they are only marked
+//                 as merged (see ECS::RenderSystem::SetMergedInto) so they aren't
+//                 culled and rendered by themselves;
+//               - a cell is rebuilt if any of its props is moved or destroyed;
+//                 if the cell entt is destroyed its props are rendered by
+//                 themselves again
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace ECS
+{
+class EntityMgr;
+}
+
+
+namespace Core
+{
+
+class BasicModel;
+
+struct StaticMergeParams
+{
+    float cellSize        = 32.0f;     // size of a grid cell (in world units)
+    int   maxPropVertices = 4096;      // models with more vertices aren't merged
+    int   numLods         = 3;         // levels of detail of each merged mesh
+};
+
+///////////////////////////////////////////////////////////
+
+class StaticMeshMerger
+{
+public:
+    static constexpr int MIN_PROPS_PER_CELL = 2;
+
+    // merge all the static props which aren't merged yet;
+    // return the number of created cells
+    int  Merge(ID3D11Device* pDevice, ECS::EntityMgr& mgr, const StaticMergeParams& params);
+
+    // destroy all the cells: their props are rendered by themselves again
+    void Unmerge(ECS::EntityMgr& mgr);
+
+    // rebuild cells whose props were moved/destroyed (must be called each frame after
+    // the ECS update); return true if any cell was changed
+    bool Update(ID3D11Device* pDevice, ECS::EntityMgr& mgr);
+
+    inline int GetNumCells() const { return (int)cells_.size(); }
+
+private:
+    struct Cell
+    {
+        EntityID id       = INVALID_ENTITY_ID;
+        ModelID  modelID  = INVALID_MODEL_ID;
+        int      numProps = 0;                 // to find out if some prop was destroyed
+    };
+
+    void     SyncCells  (ECS::EntityMgr& mgr);
+
+    EntityID CreateCell(
+        ID3D11Device* pDevice,
+        ECS::EntityMgr& mgr,
+        const EntityID* props,
+        const size numProps,
+        const DirectX::XMFLOAT3& center);
+
+    bool     BuildCellModel(
+        ECS::EntityMgr& mgr,
+        const EntityID* props,
+        const size numProps,
+        const DirectX::XMFLOAT3& center,
+        BasicModel& model);
+
+    void     RebuildCell(ID3D11Device* pDevice, ECS::EntityMgr& mgr, const index cellIdx);
+    void     RemoveCell (ECS::EntityMgr& mgr, const index cellIdx, const bool destroyEntt);
+    void     GetCellProps(ECS::EntityMgr& mgr, const EntityID cellID, cvector<EntityID>& outProps) const;
+
+    ModelID  AllocModel();
+
+private:
+    StaticMergeParams params_;
+    cvector<Cell>     cells_;
+    cvector<ModelID>  freeModels_;             // models of removed cells (are reused by new ones)
+    uint32            structureVersion_ = 0;   // of the ECS when cells were checked the last time
+};
+
+} // namespace Core
@@ -0,0 +1,416 @@
+// =================================================================================
+// Filename:     ThumbnailAtlas.cpp
+// Description:  implementation of the ThumbnailAtlas's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "ThumbnailAtlas.h"
+#include "ImgConverter.h"
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+bool ThumbnailAtlas::Initialize(ID3D11Device* pDevice)
+{
+    if (!pDevice)
+    {
+        LogErr("input ptr to the device == nullptr");
+        return false;
+    }
+
+    if (!CreateAtlasTex(pDevice))
+        return false;
+
+    slots_.clear();
+    slots_.resize(NUM_SLOTS);
+    keyToSlot_.clear();
+    hasUnsavedData_ = false;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ThumbnailAtlas::Shutdown()
+{
+    SafeRelease(&pAtlasSRV_);
+    SafeRelease(&pAtlasTex_);
+
+    slots_.clear();
+    keyToSlot_.clear();
+    hasUnsavedData_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ThumbnailAtlas::LoadFromFile(
+    ID3D11Device* pDevice,
+    const char* atlasPath,
+    const char* slotsPath)
+{
+    // load the atlas baked in the previous sessions; if anything
+    // is wrong the atlas stays empty so thumbnails will be remade
+
+    // NOTE: it can be executed by a worker thread so g_String isn't used here
+    char msg[320]{ '\0' };
+
+    if (!fs::exists(atlasPath) || !fs::exists(slotsPath))
+        return false;
+
+    FILE* pFile = fopen(slotsPath, "r");
+    if (!pFile)
+        return false;
+
+    int numSlots = 0;
+
+    if ((fscanf(pFile, "slots %d", &numSlots) != 1) || (numSlots < 0) || (numSlots > NUM_SLOTS))
+    {
+        fclose(pFile);
+        snprintf(msg, sizeof(msg), "invalid header of thumbnails slots: %s", slotsPath);
+        LogErr(msg);
+        return false;
+    }
+
+    cvector<Slot> slots(NUM_SLOTS, Slot());
+    std::unordered_map<uint64, int> keyToSlot;
+
+    int                slot = 0;
+    unsigned long long key  = 0;
+    unsigned long long hash = 0;
+
+    for (int i = 0; (i < numSlots) && (fscanf(pFile, "%d %llx %llx", &slot, &key, &hash) == 3); ++i)
+    {
+        if ((slot < 0) || (slot >= NUM_SLOTS) || (key == 0) || slots[slot].key)
+            continue;
+
+        slots[slot].key     = (uint64)key;
+        slots[slot].hash    = (uint64)hash;
+        slots[slot].isReady = true;
+        keyToSlot.emplace((uint64)key, slot);
+    }
+
+    fclose(pFile);
+
+
+    ScratchImage            image;
+    ImgReader::ImgConverter converter;
+    ID3D11Resource*         pRes = nullptr;
+
+    if (!converter.LoadFromFile(atlasPath, image))
+        return false;
+
+    const TexMetadata& metadata = image.GetMetadata();
+
+    if ((metadata.format != DXGI_FORMAT_R8G8B8A8_UNORM) ||
+        (metadata.width  != (size_t)(NUM_COLS * ICON_SIZE)) ||
+        (metadata.height != (size_t)(NUM_ROWS * ICON_SIZE)))
+    {
+        snprintf(msg, sizeof(msg), "params of thumbnails atlas don't match (it will be rebaked): %s", atlasPath);
+        LogErr(msg);
+        return false;
+    }
+
+    HRESULT hr = converter.CreateTexture2dEx(
+        pDevice,
+        *image.GetImage(0, 0, 0),
+        metadata,
+        D3D11_USAGE_DEFAULT,
+        D3D11_BIND_SHADER_RESOURCE,
+        0,
+        0,
+        false,
+        &pRes);
+
+    if (FAILED(hr))
+    {
+        snprintf(msg, sizeof(msg), "can't create a texture of thumbnails atlas: %s", atlasPath);
+        LogErr(msg);
+        return false;
+    }
+
+    ID3D11Texture2D*          pTex = nullptr;
+    ID3D11ShaderResourceView* pSRV = nullptr;
+
+    hr = pRes->QueryInterface(IID_ID3D11Texture2D, (void**)&pTex);
+    SafeRelease(&pRes);
+
+    if (SUCCEEDED(hr))
+        hr = pDevice->CreateShaderResourceView(pTex, nullptr, &pSRV);
+
+    if (FAILED(hr))
+    {
+        SafeRelease(&pTex);
+        LogErr("can't create a shader resource view of thumbnails atlas");
+        return false;
+    }
+
+    SafeRelease(&pAtlasSRV_);
+    SafeRelease(&pAtlasTex_);
+
+    pAtlasTex_      = pTex;
+    pAtlasSRV_      = pSRV;
+    slots_          = std::move(slots);
+    keyToSlot_      = std::move(keyToSlot);
+    hasUnsavedData_ = false;
+
+    snprintf(msg, sizeof(msg), "thumbnails atlas is loaded: %s (%d slots)", atlasPath, (int)keyToSlot_.size());
+    LogMsg(msg);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ThumbnailAtlas::SaveToFile(
+    ID3D11Device* pDevice,
+    ID3D11DeviceContext* pContext,
+    const char* atlasPath,
+    const char* slotsPath)
+{
+    if (!pAtlasTex_)
+        return false;
+
+    try
+    {
+        ScratchImage            image;
+        ImgReader::ImgConverter converter;
+
+        converter.LoadFromMemory(pDevice, pContext, pAtlasTex_, image);
+
+        if (!converter.SaveToFile(image, DDS_FLAGS_NONE, atlasPath))
+        {
+            sprintf(g_String, "can't save thumbnails atlas: %s", atlasPath);
+            throw EngineException(g_String);
+        }
+
+        FILE* pFile = fopen(slotsPath, "w");
+        if (!pFile)
+        {
+            sprintf(g_String, "can't open a file for thumbnails slots: %s", slotsPath);
+            throw EngineException(g_String);
+        }
+
+        int numReady = 0;
+
+        for (const Slot& slot : slots_)
+            numReady += (slot.key && slot.isReady);
+
+        fprintf(pFile, "slots %d\n", numReady);
+
+        for (int i = 0; i < (int)slots_.size(); ++i)
+        {
+            if (slots_[i].key && slots_[i].isReady)
+                fprintf(pFile, "%d %016llx %016llx\n", i, (unsigned long long)slots_[i].key, (unsigned long long)slots_[i].hash);
+        }
+
+        fclose(pFile);
+
+        hasUnsavedData_ = false;
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't save the thumbnails atlas");
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+int ThumbnailAtlas::Find(const uint64 key)
+{
+    const auto it = keyToSlot_.find(key);
+
+    if (it == keyToSlot_.end())
+        return INVALID_SLOT;
+
+    slots_[it->second].lastUsed = frame_;
+    return it->second;
+}
+
+///////////////////////////////////////////////////////////
+
+int ThumbnailAtlas::Peek(const uint64 key) const
+{
+    const auto it = keyToSlot_.find(key);
+    return (it != keyToSlot_.end()) ? it->second : INVALID_SLOT;
+}
+
+///////////////////////////////////////////////////////////
+
+int ThumbnailAtlas::Allocate(const uint64 key)
+{
+    if (!IsInit() || (key == 0))
+        return INVALID_SLOT;
+
+    const int existing = Find(key);
+    if (existing != INVALID_SLOT)
+        return existing;
+
+    // a free slot or the least recently used one (but not used in this frame)
+    int    victim   = INVALID_SLOT;
+    uint32 lastUsed = frame_;
+
+    for (int i = 0; i < (int)slots_.size(); ++i)
+    {
+        if (slots_[i].key == 0)
+        {
+            victim = i;
+            break;
+        }
+
+        if (slots_[i].lastUsed < lastUsed)
+        {
+            victim   = i;
+            lastUsed = slots_[i].lastUsed;
+        }
+    }
+
+    if (victim == INVALID_SLOT)
+        return INVALID_SLOT;
+
+    Slot& slot = slots_[victim];
+
+    if (slot.key)
+        keyToSlot_.erase(slot.key);
+
+    slot.key       = key;
+    slot.hash      = 0;
+    slot.lastUsed  = frame_;
+    slot.isReady   = false;
+    slot.isChecked = false;
+
+    keyToSlot_.emplace(key, victim);
+    return victim;
+}
+
+///////////////////////////////////////////////////////////
+
+void ThumbnailAtlas::Free(const uint64 key)
+{
+    const auto it = keyToSlot_.find(key);
+
+    if (it == keyToSlot_.end())
+        return;
+
+    slots_[it->second] = Slot();
+    keyToSlot_.erase(it);
+    hasUnsavedData_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ThumbnailAtlas::UploadPixels(
+    ID3D11DeviceContext* pContext,
+    const int slot,
+    const uint8* pixels,
+    const uint64 hash)
+{
+    assert((slot >= 0) && (slot < NUM_SLOTS));
+
+    D3D11_BOX box;
+    box.left   = (UINT)((slot % NUM_COLS) * ICON_SIZE);
+    box.top    = (UINT)((slot / NUM_COLS) * ICON_SIZE);
+    box.front  = 0;
+    box.right  = box.left + ICON_SIZE;
+    box.bottom = box.top + ICON_SIZE;
+    box.back   = 1;
+
+    pContext->UpdateSubresource(pAtlasTex_, 0, &box, pixels, ICON_SIZE * 4, 0);
+
+    slots_[slot].hash      = hash;
+    slots_[slot].isReady   = true;
+    slots_[slot].isChecked = true;
+    hasUnsavedData_        = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ThumbnailAtlas::CopyIcon(
+    ID3D11DeviceContext* pContext,
+    const int slot,
+    ID3D11Resource* pIcon,
+    const uint64 hash)
+{
+    assert((slot >= 0) && (slot < NUM_SLOTS));
+
+    const UINT dstX = (UINT)((slot % NUM_COLS) * ICON_SIZE);
+    const UINT dstY = (UINT)((slot / NUM_COLS) * ICON_SIZE);
+
+    pContext->CopySubresourceRegion(pAtlasTex_, 0, dstX, dstY, 0, pIcon, 0, nullptr);
+
+    slots_[slot].hash      = hash;
+    slots_[slot].isReady   = true;
+    slots_[slot].isChecked = true;
+    hasUnsavedData_        = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ThumbnailAtlas::MarkChecked(const int slot)
+{
+    assert((slot >= 0) && (slot < NUM_SLOTS));
+    slots_[slot].isChecked = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ThumbnailAtlas::GetSlotUV(const int slot, float* uv0, float* uv1)
+{
+    uv0[0] = (float)(slot % NUM_COLS) / NUM_COLS;
+    uv0[1] = (float)(slot / NUM_COLS) / NUM_ROWS;
+    uv1[0] = uv0[0] + 1.0f / NUM_COLS;
+    uv1[1] = uv0[1] + 1.0f / NUM_ROWS;
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+bool ThumbnailAtlas::CreateAtlasTex(ID3D11Device* pDevice)
+{
+    D3D11_TEXTURE2D_DESC desc;
+    desc.Width              = (UINT)(NUM_COLS * ICON_SIZE);
+    desc.Height             = (UINT)(NUM_ROWS * ICON_SIZE);
+    desc.MipLevels          = 1;
+    desc.ArraySize          = 1;
+    desc.Format             = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.SampleDesc.Count   = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Usage              = D3D11_USAGE_DEFAULT;
+    desc.BindFlags          = D3D11_BIND_SHADER_RESOURCE;
+    desc.CPUAccessFlags     = 0;
+    desc.MiscFlags          = 0;
+
+    ID3D11Texture2D*          pTex = nullptr;
+    ID3D11ShaderResourceView* pSRV = nullptr;
+
+    HRESULT hr = pDevice->CreateTexture2D(&desc, nullptr, &pTex);
+    if (FAILED(hr))
+    {
+        LogErr("can't create a texture for thumbnails atlas");
+        return false;
+    }
+
+    hr = pDevice->CreateShaderResourceView(pTex, nullptr, &pSRV);
+    if (FAILED(hr))
+    {
+        SafeRelease(&pTex);
+        LogErr("can't create a shader resource view of thumbnails atlas");
+        return false;
+    }
+
+    SafeRelease(&pAtlasSRV_);
+    SafeRelease(&pAtlasTex_);
+
+    pAtlasTex_ = pTex;
+    pAtlasSRV_ = pSRV;
+
+    return true;
+}
+
+} // namespace Core
@@ -0,0 +1,120 @@
+// =================================================================================
+// Filename:     ThumbnailAtlas.h
+// Description:  thumbnails of assets for the editor's browsers (textures, material
+//               icons) which are stored in slots of a single shared atlas:
+//
+//               - a slot is found by the key of its asset; the least recently used
+//                 slot is evicted when there is no free one (a slot which is used
+//                 in the current frame is never evicted);
+//               - each slot keeps a hash of the data its thumbnail was made from
+//                 so the owner can check if the thumbnail is stale;
+//               - the atlas and its slots are stored on the disk between sessions
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <d3d11.h>
+
+#include <unordered_map>
+
+
+namespace Core
+{
+
+class ThumbnailAtlas
+{
+    using SRV = ID3D11ShaderResourceView;
+
+public:
+    static constexpr int ICON_SIZE    = 96;                            // width/height of a single slot (in texels)
+    static constexpr int NUM_COLS     = 32;
+    static constexpr int NUM_ROWS     = 32;
+    static constexpr int NUM_SLOTS    = NUM_COLS * NUM_ROWS;
+    static constexpr int INVALID_SLOT = -1;
+
+    ThumbnailAtlas() {}
+    ~ThumbnailAtlas() { Shutdown(); }
+
+    // restrict a copying of this class instance
+    ThumbnailAtlas(const ThumbnailAtlas&) = delete;
+    ThumbnailAtlas& operator=(const ThumbnailAtlas&) = delete;
+
+    // create an empty atlas
+    bool Initialize(ID3D11Device* pDevice);
+    void Shutdown();
+
+    // load the atlas baked in the previous sessions; only the device is used
+    // (no immediate context) so it can be called by any thread
+    bool LoadFromFile(ID3D11Device* pDevice, const char* atlasPath, const char* slotsPath);
+    bool SaveToFile  (ID3D11Device* pDevice, ID3D11DeviceContext* pContext, const char* atlasPath, const char* slotsPath);
+
+    // slots which are found or allocated since this call aren't evicted until the next one
+    inline void BeginFrame() { ++frame_; }
+
+    // get a slot of the key and mark it as used; return INVALID_SLOT if there is no such a slot
+    int  Find(const uint64 key);
+
+    // the same as Find() but the slot isn't marked as used
+    int  Peek(const uint64 key) const;
+
+    // get a free slot (or evict the least recently used one) for the key; the content
+    // of the slot is invalid until it is uploaded; return INVALID_SLOT if all the
+    // slots are used in the current frame
+    int  Allocate(const uint64 key);
+    void Free    (const uint64 key);
+
+    // upload RGBA8 pixels (ICON_SIZE x ICON_SIZE) or copy an RGBA8 texture
+    // of the same size into the slot; after it the slot is ready
+    void UploadPixels(ID3D11DeviceContext* pContext, const int slot, const uint8* pixels, const uint64 hash);
+    void CopyIcon    (ID3D11DeviceContext* pContext, const int slot, ID3D11Resource* pIcon, const uint64 hash);
+
+    // the owner checked the slot in this session (its hash is up to date)
+    void MarkChecked(const int slot);
+
+    // all the slots of keys which are accepted by the filter are checked again
+    template <typename Filter>
+    void Uncheck(Filter&& filter)
+    {
+        for (Slot& slot : slots_)
+        {
+            if (slot.key && filter(slot.key))
+                slot.isChecked = false;
+        }
+    }
+
+    // get UV of the top left and bottom right corners of the slot
+    static void GetSlotUV(const int slot, float* uv0, float* uv1);
+
+    inline SRV*   GetSRV()                    const { return pAtlasSRV_; }
+    inline bool   IsInit()                    const { return pAtlasTex_ != nullptr; }
+    inline bool   HasUnsavedData()            const { return hasUnsavedData_; }
+    inline bool   IsReady  (const int slot)   const { return slots_[slot].isReady; }
+    inline bool   IsChecked(const int slot)   const { return slots_[slot].isChecked; }
+    inline uint64 GetHash  (const int slot)   const { return slots_[slot].hash; }
+
+private:
+    struct Slot
+    {
+        uint64 key       = 0;                          // 0 - the slot is free
+        uint64 hash      = 0;                          // of the data which the thumbnail is made from
+        uint32 lastUsed  = 0;                          // a frame when it was used last time
+        bool   isReady   = false;                      // the content is uploaded
+        bool   isChecked = false;                      // the hash is checked by the owner in this session
+    };
+
+    bool CreateAtlasTex(ID3D11Device* pDevice);
+
+private:
+    ID3D11Texture2D*                pAtlasTex_ = nullptr;
+    SRV*                            pAtlasSRV_ = nullptr;
+
+    cvector<Slot>                   slots_;
+    std::unordered_map<uint64, int> keyToSlot_;
+    uint32                          frame_          = 1;
+    bool                            hasUnsavedData_ = false;
+};
+
+} // namespace Core
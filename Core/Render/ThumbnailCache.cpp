@@ -0,0 +1,581 @@
+// =================================================================================
+// Filename:     ThumbnailCache.cpp
+// Description:  implementation of the ThumbnailCache's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "ThumbnailCache.h"
+#include "CRender.h"
+#include "../Texture/TextureMgr.h"
+#include "../Texture/TextureCooker.h"
+#include "../Mesh/MaterialMgr.h"
+
+#include <DirectXTex.h>
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+// FNV-1a params
+static constexpr uint64 FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static constexpr uint64 FNV_PRIME        = 1099511628211ULL;
+
+static constexpr int    ICON_SIZE        = ThumbnailAtlas::ICON_SIZE;
+
+//---------------------------------------------------------
+// Desc:  mix the input bytes into the hash
+//---------------------------------------------------------
+static void HashBytes(uint64& hash, const void* data, const size_t numBytes)
+{
+    const uint8* bytes = (const uint8*)data;
+
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:  scale the smallest mip of the image which isn't less than the icon
+//        to RGBA8 pixels of the icon (is executed by a worker thread)
+//---------------------------------------------------------
+static bool MakeThumbnailPixels(const ScratchImage& image, uint8* outPixels)
+{
+    const TexMetadata& metadata = image.GetMetadata();
+    size_t             mip      = 0;
+
+    while ((mip + 1 < metadata.mipLevels) &&
+           (std::max(metadata.width >> (mip + 1), metadata.height >> (mip + 1)) >= (size_t)ICON_SIZE))
+    {
+        ++mip;
+    }
+
+    // bytes of sRGB textures are kept as they are (the atlas is drawn as is)
+    const DXGI_FORMAT dstFormat = (IsSRGB(metadata.format)) ?
+        DXGI_FORMAT_R8G8B8A8_UNORM_SRGB :
+        DXGI_FORMAT_R8G8B8A8_UNORM;
+
+    const Image* pSrc = image.GetImage(mip, 0, 0);
+    ScratchImage decompressed;
+    ScratchImage converted;
+    ScratchImage resized;
+
+    if (!pSrc)
+        return false;
+
+    if (IsCompressed(pSrc->format))
+    {
+        if (FAILED(Decompress(*pSrc, dstFormat, decompressed)))
+            return false;
+
+        pSrc = decompressed.GetImage(0, 0, 0);
+    }
+    else if (pSrc->format != dstFormat)
+    {
+        if (FAILED(Convert(*pSrc, dstFormat, TEX_FILTER_DEFAULT, TEX_THRESHOLD_DEFAULT, converted)))
+            return false;
+
+        pSrc = converted.GetImage(0, 0, 0);
+    }
+
+    // WIC isn't used by workers (COM isn't initialized for them)
+    if ((pSrc->width != (size_t)ICON_SIZE) || (pSrc->height != (size_t)ICON_SIZE))
+    {
+        if (FAILED(Resize(*pSrc, ICON_SIZE, ICON_SIZE, TEX_FILTER_TRIANGLE | TEX_FILTER_FORCE_NON_WIC, resized)))
+            return false;
+
+        pSrc = resized.GetImage(0, 0, 0);
+    }
+
+    for (int y = 0; y < ICON_SIZE; ++y)
+        memcpy(outPixels + y * ICON_SIZE * 4, pSrc->pixels + y * pSrc->rowPitch, ICON_SIZE * 4);
+
+    return true;
+}
+
+
+// =================================================================================
+// Public API
+// =================================================================================
+void ThumbnailCache::Initialize(
+    ID3D11Device* pDevice,
+    const char* atlasPath,
+    const char* slotsPath)
+{
+    if (!pDevice || StrHelper::IsEmpty(atlasPath) || StrHelper::IsEmpty(slotsPath))
+    {
+        LogErr("can't init thumbnails cache: invalid input args");
+        return;
+    }
+
+    pDevice_ = pDevice;
+    strncpy(atlasPath_, atlasPath, sizeof(atlasPath_) - 1);
+    strncpy(slotsPath_, slotsPath, sizeof(slotsPath_) - 1);
+}
+
+///////////////////////////////////////////////////////////
+
+void ThumbnailCache::Shutdown(ID3D11DeviceContext* pContext)
+{
+    // the jobs write into the loads (and the atlas) so wait for them before deleting
+    g_JobSystem.Wait(jobsCounter_);
+
+    for (TexLoad* pLoad : texLoads_)
+    {
+        delete[] pLoad->pixels;
+        delete pLoad;
+    }
+
+    if (pContext && atlas_.HasUnsavedData())
+        atlas_.SaveToFile(pDevice_, pContext, atlasPath_, slotsPath_);
+
+    atlas_.Shutdown();
+    iconBuf_.Shutdown();
+
+    texLoads_.clear();
+    texRequests_.clear();
+    iconRequests_.clear();
+    noThumbnails_.clear();
+
+    isAtlasLoaded_.store(false, std::memory_order_release);
+    isLoadStarted_ = false;
+    pDevice_       = nullptr;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ThumbnailCache::GetTextureThumbnail(
+    const TexID id,
+    SRV*& outSRV,
+    float* uv0,
+    float* uv1)
+{
+    if (!IsAtlasReady())
+        return false;
+
+    Texture*     pTex = g_TextureMgr.GetTexPtrByID(id);
+    const uint64 key  = MakeKey(THUMBNAIL_TEXTURE, (pTex) ? pTex->GetName().c_str() : nullptr, id);
+
+    // there is no file to make a thumbnail from: draw the texture itself
+    if (noThumbnails_.find(key) != noThumbnails_.end())
+    {
+        outSRV = g_TextureMgr.GetSRVByTexID(id);
+        uv0[0] = uv0[1] = 0.0f;
+        uv1[0] = uv1[1] = 1.0f;
+        return outSRV != nullptr;
+    }
+
+    const int slot = AcquireSlot(key);
+
+    if (slot == ThumbnailAtlas::INVALID_SLOT)
+        return false;
+
+    // a thumbnail of the prev session (or before reloading) is drawn until it is checked
+    if (!atlas_.IsChecked(slot))
+        texRequests_.push_back({ key, id });
+
+    if (!atlas_.IsReady(slot))
+        return false;
+
+    outSRV = atlas_.GetSRV();
+    ThumbnailAtlas::GetSlotUV(slot, uv0, uv1);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ThumbnailCache::GetMaterialIcon(
+    const MaterialID id,
+    SRV*& outSRV,
+    float* uv0,
+    float* uv1)
+{
+    if (!IsAtlasReady())
+        return false;
+
+    const Material& mat  = g_MaterialMgr.GetMaterialByID(id);
+    const uint64    key  = MakeKey(THUMBNAIL_MATERIAL, mat.name, id);
+    const int       slot = AcquireSlot(key);
+
+    if (slot == ThumbnailAtlas::INVALID_SLOT)
+        return false;
+
+    // materials data is on the main thread so it is checked right here
+    if (!atlas_.IsChecked(slot))
+    {
+        const uint64 hash = ComputeMaterialHash(id);
+
+        if (atlas_.IsReady(slot) && (atlas_.GetHash(slot) == hash))
+            atlas_.MarkChecked(slot);
+        else
+            iconRequests_.push_back({ key, hash, id });
+    }
+
+    if (!atlas_.IsReady(slot))
+        return false;
+
+    outSRV = atlas_.GetSRV();
+    ThumbnailAtlas::GetSlotUV(slot, uv0, uv1);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ThumbnailCache::InvalidateMaterialIcons()
+{
+    if (isAtlasLoaded_.load(std::memory_order_acquire))
+        atlas_.Uncheck([](const uint64 key) { return (key >> 56) == THUMBNAIL_MATERIAL; });
+}
+
+///////////////////////////////////////////////////////////
+
+int ThumbnailCache::Update(
+    ID3D11DeviceContext* pContext,
+    Render::MaterialIconShader& shader,
+    const BasicModel& sphere)
+{
+    if (!isAtlasLoaded_.load(std::memory_order_acquire) || !atlas_.IsInit())
+        return 0;
+
+    // textures were reloaded (or streamed): check their thumbnails again
+    const uint32 srvsVersion = g_TextureMgr.GetSRVsVersion();
+
+    if (texSRVsVersion_ != srvsVersion)
+    {
+        texSRVsVersion_ = srvsVersion;
+        noThumbnails_.clear();
+        atlas_.Uncheck([](const uint64 key) { return (key >> 56) == THUMBNAIL_TEXTURE; });
+    }
+
+    FinishTexLoads(pContext);
+    StartTexLoads();
+    const int numRendered = RenderIcons(pContext, shader, sphere);
+
+    // requests are made again by the browsers each frame (only for visible items)
+    texRequests_.clear();
+    iconRequests_.clear();
+    atlas_.BeginFrame();
+
+    return numRendered;
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+uint64 ThumbnailCache::MakeKey(const eThumbnailType type, const char* name, const uint32 id)
+{
+    // assets are keyed by names since their IDs aren't stable between sessions;
+    // the high byte is the type of the thumbnail (so a key is never 0)
+
+    uint64 hash = FNV_OFFSET_BASIS;
+
+    if (!StrHelper::IsEmpty(name))
+        HashBytes(hash, name, strlen(name));
+    else
+        HashBytes(hash, &id, sizeof(id));
+
+    return (hash & 0x00FFFFFFFFFFFFFFULL) | ((uint64)type << 56);
+}
+
+//---------------------------------------------------------
+// Desc:  make a thumbnail of the texture file (is executed by a worker thread);
+//        the file isn't decoded if its stamp is equal to the hash of the slot
+//---------------------------------------------------------
+void ThumbnailCache::LoadTexThumbnail(TexLoad* pLoad)
+{
+    MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+
+    std::error_code error;
+
+    const uintmax_t fileSize = fs::file_size(pLoad->path, error);
+
+    // a generated texture (or the file is deleted)
+    if (error)
+    {
+        pLoad->isDone.store(true, std::memory_order_release);
+        return;
+    }
+
+    const fs::file_time_type fileTime = fs::last_write_time(pLoad->path, error);
+    const int64              timeTicks = (error) ? 0 : (int64)fileTime.time_since_epoch().count();
+
+    uint64 stamp = FNV_OFFSET_BASIS;
+    HashBytes(stamp, &fileSize, sizeof(fileSize));
+    HashBytes(stamp, &timeTicks, sizeof(timeTicks));
+    pLoad->stamp = (stamp != 0) ? stamp : 1;
+
+    if (pLoad->stamp != pLoad->hash)
+    {
+        // a cooked texture already has all the mips
+        char cookedPath[256]{ '\0' };
+        const bool  isCooked = TextureCooker::FindCooked(pLoad->path, cookedPath, sizeof(cookedPath));
+        const char* path     = (isCooked) ? cookedPath : pLoad->path;
+
+        ScratchImage image;
+        uint8*       pixels = new uint8[ICON_SIZE * ICON_SIZE * 4];
+
+        if (Texture::DecodeFromFile(path, image) && MakeThumbnailPixels(image, pixels))
+            pLoad->pixels = pixels;
+        else
+            delete[] pixels;
+    }
+
+    pLoad->isDone.store(true, std::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////
+
+uint64 ThumbnailCache::ComputeMaterialHash(const MaterialID id)
+{
+    // hash everything what the icon is rendered from; textures are hashed
+    // by names since their IDs aren't stable between sessions
+
+    const Material& mat = g_MaterialMgr.GetMaterialByID(id);
+    uint64 hash = FNV_OFFSET_BASIS;
+
+    HashBytes(hash, &mat.ambient,  sizeof(mat.ambient));
+    HashBytes(hash, &mat.diffuse,  sizeof(mat.diffuse));
+    HashBytes(hash, &mat.specular, sizeof(mat.specular));
+    HashBytes(hash, &mat.reflect,  sizeof(mat.reflect));
+    HashBytes(hash, &mat.properties, sizeof(mat.properties));
+
+    for (int i = 0; i < NUM_TEXTURE_TYPES; ++i)
+    {
+        const std::string& texName = g_TextureMgr.GetTexPtrByID(mat.textureIDs[i])->GetName();
+        HashBytes(hash, texName.c_str(), texName.size() + 1);
+    }
+
+    // 0 is reserved for empty slots
+    return (hash != 0) ? hash : 1;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ThumbnailCache::IsAtlasReady()
+{
+    // the atlas of the prev session is loaded by a job so it isn't touched until
+    // the job is done; if there is no such atlas (or it is broken) an empty one is used
+
+    if (!pDevice_)
+        return false;
+
+    if (!isLoadStarted_)
+    {
+        isLoadStarted_ = true;
+
+        g_JobSystem.Run([this]()
+        {
+            atlas_.LoadFromFile(pDevice_, atlasPath_, slotsPath_);
+            isAtlasLoaded_.store(true, std::memory_order_release);
+        },
+        &jobsCounter_);
+
+        return false;
+    }
+
+    if (!isAtlasLoaded_.load(std::memory_order_acquire))
+        return false;
+
+    if (!atlas_.IsInit() && !atlas_.Initialize(pDevice_))
+    {
+        LogErr("can't init thumbnails atlas");
+        pDevice_ = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+int ThumbnailCache::AcquireSlot(const uint64 key)
+{
+    const int slot = atlas_.Find(key);
+    return (slot != ThumbnailAtlas::INVALID_SLOT) ? slot : atlas_.Allocate(key);
+}
+
+///////////////////////////////////////////////////////////
+
+void ThumbnailCache::FinishTexLoads(ID3D11DeviceContext* pContext)
+{
+    index numPending = 0;
+
+    for (TexLoad* pLoad : texLoads_)
+    {
+        if (!pLoad->isDone.load(std::memory_order_acquire))
+        {
+            texLoads_[numPending++] = pLoad;
+            continue;
+        }
+
+        // the slot can be evicted while loading
+        const int slot = atlas_.Peek(pLoad->key);
+
+        if (slot != ThumbnailAtlas::INVALID_SLOT)
+        {
+            if (pLoad->pixels)
+            {
+                atlas_.UploadPixels(pContext, slot, pLoad->pixels, pLoad->stamp);
+            }
+            else if (pLoad->stamp && (pLoad->stamp == pLoad->hash))
+            {
+                atlas_.MarkChecked(slot);
+            }
+            else
+            {
+                // there is no file or it can't be decoded
+                atlas_.Free(pLoad->key);
+                noThumbnails_.insert(pLoad->key);
+            }
+        }
+
+        delete[] pLoad->pixels;
+        delete pLoad;
+    }
+
+    texLoads_.resize(numPending);
+}
+
+///////////////////////////////////////////////////////////
+
+void ThumbnailCache::StartTexLoads()
+{
+    for (const TexRequest& req : texRequests_)
+    {
+        if (texLoads_.size() >= MAX_LOADS_IN_FLIGHT)
+            return;
+
+        const int slot = atlas_.Peek(req.key);
+
+        if ((slot == ThumbnailAtlas::INVALID_SLOT) || atlas_.IsChecked(slot) || IsTexLoading(req.key))
+            continue;
+
+        const Texture* pTex = g_TextureMgr.GetTexPtrByID(req.id);
+
+        if (!pTex)
+            continue;
+
+        TexLoad* pLoad = new TexLoad();
+        pLoad->key  = req.key;
+        pLoad->hash = (atlas_.IsReady(slot)) ? atlas_.GetHash(slot) : 0;
+        strncpy(pLoad->path, pTex->GetName().c_str(), sizeof(pLoad->path) - 1);
+
+        texLoads_.push_back(pLoad);
+        g_JobSystem.Run([pLoad]() { LoadTexThumbnail(pLoad); }, &jobsCounter_);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool ThumbnailCache::IsTexLoading(const uint64 key) const
+{
+    for (const TexLoad* pLoad : texLoads_)
+    {
+        if (pLoad->key == key)
+            return true;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+int ThumbnailCache::RenderIcons(
+    ID3D11DeviceContext* pContext,
+    Render::MaterialIconShader& shader,
+    const BasicModel& sphere)
+{
+    if (iconRequests_.empty())
+        return 0;
+
+    if (!iconBuf_.IsInit())
+    {
+        FrameBufferSpecification spec;
+        spec.width       = (UINT)ICON_SIZE;
+        spec.height      = (UINT)ICON_SIZE;
+        spec.format      = DXGI_FORMAT_R8G8B8A8_UNORM;
+        spec.screenNear  = 0.1f;
+        spec.screenDepth = 100.0f;
+
+        if (!iconBuf_.Initialize(pDevice_, spec))
+        {
+            LogErr("can't init a frame buffer for material icons");
+            iconRequests_.clear();
+            return 0;
+        }
+    }
+
+    const MeshGeometry& sphereMesh = sphere.meshes_;
+
+    const XMMATRIX world = XMMatrixRotationY(0.0f);
+    const XMMATRIX view  = XMMatrixTranslation(0, 0, 1.1f);
+    const XMMATRIX proj  = XMMatrixPerspectiveFovLH(1.0f, 1.0f, 0.1f, 100.0f);
+
+    ID3D11Resource* pIconRes = nullptr;
+    iconBuf_.GetSRV()->GetResource(&pIconRes);
+
+    cvector<ID3D11ShaderResourceView*> texSRVs;
+    bool isPrepared  = false;
+    int  numRendered = 0;
+
+    for (const IconRequest& req : iconRequests_)
+    {
+        if (numRendered >= MAX_ICONS_PER_FRAME)
+            break;
+
+        // the slot can be evicted or the icon can be requested twice
+        const int slot = atlas_.Peek(req.key);
+
+        if ((slot == ThumbnailAtlas::INVALID_SLOT) || atlas_.IsChecked(slot))
+            continue;
+
+        // setup the pipeline only if there is anything to render
+        if (!isPrepared)
+        {
+            shader.SetMatrix(pContext, world, view, proj);
+            shader.PrepareRendering(
+                pContext,
+                sphereMesh.GetVB(),
+                sphereMesh.GetIB(),
+                sphereMesh.GetIndexFormat(),
+                (int)sphereMesh.vertexStride_);
+
+            isPrepared = true;
+        }
+
+        iconBuf_.ClearBuffers(pContext, { 0,0,0,0 });
+        iconBuf_.Bind(pContext);
+
+        // prepare material data and its textures
+        const Material& mat = g_MaterialMgr.GetMaterialByID(req.id);
+
+        const Render::Material renderMat(
+            XMFLOAT4(&mat.ambient.x),
+            XMFLOAT4(&mat.diffuse.x),
+            XMFLOAT4(&mat.specular.x),
+            XMFLOAT4(&mat.reflect.x));
+
+        g_TextureMgr.GetSRVsByTexIDs(mat.textureIDs, NUM_TEXTURE_TYPES, texSRVs);
+
+        shader.Render(
+            pContext,
+            sphere.GetNumIndices(),
+            sphereMesh.GetBaseIndex(),
+            (int)sphereMesh.GetBaseVertex(),
+            texSRVs.data(),
+            renderMat);
+
+        atlas_.CopyIcon(pContext, slot, pIconRes, req.hash);
+        ++numRendered;
+    }
+
+    SafeRelease(&pIconRes);
+    return numRendered;
+}
+
+} // namespace Core
@@ -0,0 +1,139 @@
+// =================================================================================
+// Filename:     ThumbnailCache.h
+// Description:  on-demand thumbnails of textures and icons of materials for the
+//               editor's browsers (they are stored in a shared ThumbnailAtlas):
+//
+//               - a browser asks only for thumbnails of its visible items; if
+//                 a thumbnail isn't ready it is requested and the browser draws
+//                 a placeholder meanwhile;
+//               - a texture thumbnail is made by a job: it decodes the texture file,
+//                 takes its smallest mip which isn't less than the icon and scales
+//                 it down; the main thread only uploads the pixels into the atlas;
+//               - a material icon is rendered on the GPU (a sphere with the material)
+//                 and a few icons are rendered per frame;
+//               - thumbnails are kept between sessions so a thumbnail is remade only
+//                 if its source is changed (the texture file or the material's data)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "ThumbnailAtlas.h"
+#include "FrameBuffer.h"
+#include "../Model/BasicModel.h"
+
+#include <JobSystem.h>
+#include <atomic>
+#include <unordered_set>
+
+namespace Render
+{
+    class MaterialIconShader;
+}
+
+
+namespace Core
+{
+
+class ThumbnailCache
+{
+    using SRV = ID3D11ShaderResourceView;
+
+public:
+    static constexpr int MAX_LOADS_IN_FLIGHT = 4;      // jobs which make texture thumbnails at once
+    static constexpr int MAX_ICONS_PER_FRAME = 8;      // material icons which are rendered per frame
+
+    ThumbnailCache() {}
+    ~ThumbnailCache() { Shutdown(); }
+
+    // restrict a copying of this class instance
+    ThumbnailCache(const ThumbnailCache&) = delete;
+    ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+    // the atlas of the previous session is loaded by a job when
+    // the first thumbnail is requested
+    void Initialize(ID3D11Device* pDevice, const char* atlasPath, const char* slotsPath);
+
+    // wait for the jobs and save the atlas (if it is changed and the context is passed)
+    void Shutdown(ID3D11DeviceContext* pContext = nullptr);
+
+    // get a slot of the thumbnail in the atlas (output: SRV of the atlas and UV of the slot);
+    // return false if the thumbnail isn't ready yet (it is requested then)
+    bool GetTextureThumbnail(const TexID id,      SRV*& outSRV, float* uv0, float* uv1);
+    bool GetMaterialIcon    (const MaterialID id, SRV*& outSRV, float* uv0, float* uv1);
+
+    // material data is changed: icons are checked again (only changed ones are re-rendered)
+    void InvalidateMaterialIcons();
+
+    // finish jobs and start new ones, render requested material icons;
+    // return the number of rendered icons;
+    // NOTE: the immediate context must be free; if any icon is rendered
+    //       the caller resets render target, viewport and camera matrices
+    int Update(
+        ID3D11DeviceContext* pContext,
+        Render::MaterialIconShader& shader,
+        const BasicModel& sphere);
+
+    // are there material icons to render? (their textures mustn't be placeholders)
+    inline bool HasIconRequests() const { return !iconRequests_.empty(); }
+
+private:
+    enum eThumbnailType : uint64
+    {
+        THUMBNAIL_TEXTURE  = 1,
+        THUMBNAIL_MATERIAL = 2,
+    };
+
+    struct TexLoad
+    {
+        uint64            key    = 0;
+        uint64            hash   = 0;                  // of the slot when the load is started (equal to the stamp: the slot is up to date)
+        char              path[256]{ '\0' };
+        uint64            stamp  = 0;                  // of the file (0: there is no file)
+        uint8*            pixels = nullptr;            // RGBA8 ICON_SIZE x ICON_SIZE (nullptr: isn't decoded)
+        std::atomic<bool> isDone = false;
+    };
+
+    static uint64 MakeKey(const eThumbnailType type, const char* name, const uint32 id);
+    static void   LoadTexThumbnail(TexLoad* pLoad);
+    static uint64 ComputeMaterialHash(const MaterialID id);
+
+    bool IsAtlasReady();
+    int  AcquireSlot(const uint64 key);
+    void FinishTexLoads(ID3D11DeviceContext* pContext);
+    void StartTexLoads();
+    bool IsTexLoading(const uint64 key) const;
+    int  RenderIcons(ID3D11DeviceContext* pContext, Render::MaterialIconShader& shader, const BasicModel& sphere);
+
+private:
+    struct TexRequest
+    {
+        uint64 key = 0;
+        TexID  id  = INVALID_TEXTURE_ID;
+    };
+
+    struct IconRequest
+    {
+        uint64     key  = 0;
+        uint64     hash = 0;                           // of the material's data
+        MaterialID id   = 0;
+    };
+
+    ID3D11Device*              pDevice_ = nullptr;
+    ThumbnailAtlas             atlas_;
+    FrameBuffer                iconBuf_;                  // a single material icon is rendered here and copied into its slot
+
+    char                       atlasPath_[64]{ '\0' };
+    char                       slotsPath_[64]{ '\0' };
+    std::atomic<bool>          isAtlasLoaded_ = false;    // the job which loads the atlas is done
+    bool                       isLoadStarted_ = false;
+
+    cvector<TexRequest>        texRequests_;              // visible texture thumbnails which aren't ready (or checked)
+    cvector<IconRequest>       iconRequests_;             // the same for material icons
+    cvector<TexLoad*>          texLoads_;
+    std::unordered_set<uint64> noThumbnails_;             // textures without a file (e.g. generated ones): their own SRVs are drawn
+    JobCounter                 jobsCounter_;
+    uint32                     texSRVsVersion_ = 0;       // texture's SRVs are changed: thumbnails are checked again
+};
+
+} // namespace Core
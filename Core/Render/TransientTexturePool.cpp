@@ -0,0 +1,188 @@
+// =================================================================================
+// Filename:     TransientTexturePool.cpp
+// Description:  implementation of the TransientTexturePool's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "TransientTexturePool.h"
+
+
+namespace Core
+{
+
+void TransientTexturePool::Shutdown()
+{
+    for (PooledTexture& tex : textures_)
+        ReleaseTexture(tex);
+
+    textures_.clear();
+    numTextures_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+int TransientTexturePool::Acquire(ID3D11Device* pDevice, const RGTextureDesc& desc)
+{
+    int freeSlot = INVALID_TEXTURE;
+
+    for (int i = 0; i < (int)textures_.size(); ++i)
+    {
+        PooledTexture& tex = textures_[i];
+
+        if (!tex.pTexture)
+        {
+            if (freeSlot == INVALID_TEXTURE)
+                freeSlot = i;
+            continue;
+        }
+
+        // reuse a texture which was released by a previous pass (or frame)
+        if (!tex.isInUse && (tex.desc == desc))
+        {
+            tex.isInUse   = true;
+            tex.lastFrame = currFrame_;
+            return i;
+        }
+    }
+
+    if (freeSlot == INVALID_TEXTURE)
+    {
+        freeSlot = (int)textures_.size();
+        textures_.push_back(PooledTexture());
+    }
+
+    PooledTexture& tex = textures_[freeSlot];
+
+    if (!CreateTexture(pDevice, desc, tex))
+    {
+        ReleaseTexture(tex);
+        return INVALID_TEXTURE;
+    }
+
+    tex.isInUse   = true;
+    tex.lastFrame = currFrame_;
+    numTextures_++;
+
+    return freeSlot;
+}
+
+///////////////////////////////////////////////////////////
+
+void TransientTexturePool::Release(const int idx)
+{
+    if ((idx < 0) || (idx >= (int)textures_.size()))
+    {
+        sprintf(g_String, "there is no pooled texture by idx: %d", idx);
+        LogErr(g_String);
+        return;
+    }
+
+    textures_[idx].isInUse = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void TransientTexturePool::EndFrame()
+{
+    for (PooledTexture& tex : textures_)
+    {
+        if (tex.pTexture && !tex.isInUse && (currFrame_ - tex.lastFrame > MAX_UNUSED_FRAMES))
+        {
+            ReleaseTexture(tex);
+            numTextures_--;
+        }
+    }
+
+    currFrame_++;
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+bool TransientTexturePool::CreateTexture(
+    ID3D11Device* pDevice,
+    const RGTextureDesc& desc,
+    PooledTexture& tex)
+{
+    try
+    {
+        CAssert::True(pDevice != nullptr, "input ptr to the device == nullptr");
+        CAssert::True((desc.width > 0) && (desc.height > 0), "input texture size must be > 0");
+
+        D3D11_TEXTURE2D_DESC texDesc;
+        ZeroMemory(&texDesc, sizeof(texDesc));
+
+        texDesc.Width              = desc.width;
+        texDesc.Height             = desc.height;
+        texDesc.MipLevels          = 1;
+        texDesc.ArraySize          = 1;
+        texDesc.Format             = desc.format;
+        texDesc.SampleDesc.Count   = 1;
+        texDesc.SampleDesc.Quality = 0;
+        texDesc.Usage              = D3D11_USAGE_DEFAULT;
+        texDesc.BindFlags          = desc.bindFlags;
+
+        HRESULT hr = pDevice->CreateTexture2D(&texDesc, nullptr, &tex.pTexture);
+        CAssert::NotFailed(hr, "can't create a pooled texture");
+
+        // a depth buffer is typeless so both DSV and SRV can be created
+        const bool isDepth = (desc.bindFlags & D3D11_BIND_DEPTH_STENCIL);
+
+        if (desc.bindFlags & D3D11_BIND_RENDER_TARGET)
+        {
+            hr = pDevice->CreateRenderTargetView(tex.pTexture, nullptr, &tex.pRTV);
+            CAssert::NotFailed(hr, "can't create a render target view of pooled texture");
+        }
+
+        if (isDepth)
+        {
+            D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+            ZeroMemory(&dsvDesc, sizeof(dsvDesc));
+
+            dsvDesc.Format        = DXGI_FORMAT_D24_UNORM_S8_UINT;
+            dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+
+            hr = pDevice->CreateDepthStencilView(tex.pTexture, &dsvDesc, &tex.pDSV);
+            CAssert::NotFailed(hr, "can't create a depth stencil view of pooled texture");
+        }
+
+        if (desc.bindFlags & D3D11_BIND_SHADER_RESOURCE)
+        {
+            D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+            ZeroMemory(&srvDesc, sizeof(srvDesc));
+
+            srvDesc.Format              = (isDepth) ? DXGI_FORMAT_R24_UNORM_X8_TYPELESS : desc.format;
+            srvDesc.ViewDimension       = D3D11_SRV_DIMENSION_TEXTURE2D;
+            srvDesc.Texture2D.MipLevels = 1;
+
+            hr = pDevice->CreateShaderResourceView(tex.pTexture, &srvDesc, &tex.pSRV);
+            CAssert::NotFailed(hr, "can't create a shader resource view of pooled texture");
+        }
+
+        tex.desc = desc;
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        sprintf(g_String, "can't create a pooled texture (%ux%u, format: %d)", desc.width, desc.height, (int)desc.format);
+        LogErr(g_String);
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void TransientTexturePool::ReleaseTexture(PooledTexture& tex)
+{
+    SafeRelease(&tex.pSRV);
+    SafeRelease(&tex.pDSV);
+    SafeRelease(&tex.pRTV);
+    SafeRelease(&tex.pTexture);
+
+    tex.isInUse = false;
+}
+
+} // namespace Core
@@ -0,0 +1,88 @@
+// =================================================================================
+// Filename:     TransientTexturePool.h
+// Description:  a pool of 2D textures (with their RTV/DSV/SRV) for transient render
+//               targets of the render graph: a texture is acquired by its desc and
+//               is returned to the pool after its last use within the frame, so
+//               another pass with the same desc reuses (aliases) it;
+//
+//               textures which weren't used for MAX_UNUSED_FRAMES frames are
+//               released so after a resize (or a disabled feature) the VRAM
+//               doesn't grow
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <d3d11.h>
+
+
+namespace Core
+{
+
+struct RGTextureDesc
+{
+    UINT        width     = 0;
+    UINT        height    = 0;
+    DXGI_FORMAT format    = DXGI_FORMAT_UNKNOWN;     // for a depth buffer: DXGI_FORMAT_R24G8_TYPELESS
+    UINT        bindFlags = 0;                       // D3D11_BIND_RENDER_TARGET / D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE
+
+    inline bool operator==(const RGTextureDesc& rhs) const
+    {
+        return (width == rhs.width) && (height == rhs.height) && (format == rhs.format) && (bindFlags == rhs.bindFlags);
+    }
+};
+
+///////////////////////////////////////////////////////////
+
+struct PooledTexture
+{
+    RGTextureDesc               desc;
+    ID3D11Texture2D*            pTexture  = nullptr;
+    ID3D11RenderTargetView*     pRTV      = nullptr;
+    ID3D11DepthStencilView*     pDSV      = nullptr;
+    ID3D11ShaderResourceView*   pSRV      = nullptr;
+    uint32                      lastFrame = 0;       // when it was acquired the last time
+    bool                        isInUse   = false;
+};
+
+///////////////////////////////////////////////////////////
+
+class TransientTexturePool
+{
+public:
+    static constexpr uint32 MAX_UNUSED_FRAMES = 8;
+    static constexpr int    INVALID_TEXTURE   = -1;
+
+    TransientTexturePool() {}
+    ~TransientTexturePool() { Shutdown(); }
+
+    // restrict a copying of this class instance
+    TransientTexturePool(const TransientTexturePool&) = delete;
+    TransientTexturePool& operator=(const TransientTexturePool&) = delete;
+
+    void Shutdown();
+
+    // return an idx of a free texture with such desc (a new one is created if there is
+    // no such texture) or INVALID_TEXTURE if we failed to create it
+    int  Acquire(ID3D11Device* pDevice, const RGTextureDesc& desc);
+    void Release(const int idx);
+
+    // release textures which weren't used for a while (call it once per frame)
+    void EndFrame();
+
+    inline const PooledTexture& GetTexture(const int idx) const { return textures_[idx]; }
+    inline int                  GetNumTextures()          const { return numTextures_; }
+
+private:
+    bool CreateTexture(ID3D11Device* pDevice, const RGTextureDesc& desc, PooledTexture& tex);
+    void ReleaseTexture(PooledTexture& tex);
+
+private:
+    cvector<PooledTexture> textures_;                // released slots (pTexture == nullptr) are reused
+    uint32                 currFrame_   = 0;
+    int                    numTextures_ = 0;         // alive textures
+};
+
+} // namespace Core
@@ -4,6 +4,7 @@
 // ================================================================================
 #include <CoreCommon/pch.h>
 #include "d3dclass.h"
+#include <dxgi1_5.h>     // for the flip model: IDXGISwapChain2 (frame latency), IDXGIFactory5 (tearing)
 
 #pragma warning (disable : 4996)
 
@@ -54,6 +55,8 @@ bool D3DClass::Initialize(
     const bool vsyncEnabled,
     const bool fullScreen,
     const bool enable4xMSAA,
+    const bool flipModel,
+    const int maxFrameLatency,
     const float screenNear, 
     const float screenDepth)
 {
@@ -101,6 +104,8 @@ bool D3DClass::Initialize(
         vsyncEnabled_ = vsyncEnabled;        // define if VSYNC is enabled or not
         fullScreen_   = fullScreen;          // define if window is full screen or not
         enable4xMsaa_ = enable4xMSAA;        // use 4X MSAA?
+        flipModel_    = flipModel;           // FLIP_DISCARD swap chain?
+        maxFrameLatency_ = std::clamp(maxFrameLatency, 1, 16);
         screenNear_   = screenNear;
         screenDepth_  = screenDepth;
 
@@ -126,6 +131,60 @@ bool D3DClass::Initialize(
 
 ///////////////////////////////////////////////////////////
 
+bool D3DClass::InitializeHeadless(
+    const int width,
+    const int height,
+    const bool useReferenceDevice,
+    const float screenNear,
+    const float screenDepth)
+{
+    try
+    {
+        LogDbg("D3DClass start of initialization (headless)");
+
+        CAssert::True((width > 0) && (height > 0), "wrong dimensions of the offscreen target");
+        CAssert::True((screenNear > 0.0f) && (screenDepth > screenNear), "wrong screen near or depth values");
+
+        // the offscreen target has the same size in all the modes
+        wndWidth_            = width;
+        wndHeight_           = height;
+        windowedModeWidth_   = width;
+        windowedModeHeight_  = height;
+        fullScreenWndWidth_  = width;
+        fullScreenWndHeight_ = height;
+
+        vsyncEnabled_ = false;
+        fullScreen_   = false;
+        enable4xMsaa_ = false;
+        flipModel_    = false;
+        screenNear_   = screenNear;
+        screenDepth_  = screenDepth;
+        driverType_   = (useReferenceDevice) ? D3D_DRIVER_TYPE_REFERENCE : D3D_DRIVER_TYPE_WARP;
+
+        InitializeDevice();
+        InitializeOffscreenTarget(width, height);
+        InitializeViewport(width, height);
+
+        renderStates_.InitAll(pDevice_, false);
+        InitializeDepthStencil(width, height);
+
+        LogMsgf("is initialized without a window (%s device, %dx%d)",
+            (useReferenceDevice) ? "reference" : "WARP",
+            width,
+            height);
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        Shutdown();
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
 void D3DClass::Shutdown()
 {
     // reset the screen state and release the allocated memory
@@ -135,10 +194,18 @@ void D3DClass::Shutdown()
         pSwapChain_->SetFullscreenState(FALSE, nullptr);
 
 
+    if (frameLatencyWaitable_)
+    {
+        CloseHandle(frameLatencyWaitable_);
+        frameLatencyWaitable_ = nullptr;
+    }
+
     // release all the depth stencil stuff
+    SafeRelease(&pDepthSRV_);
     SafeRelease(&pDepthStencilView_);
     SafeRelease(&pDepthStencilBuffer_);
     SafeRelease(&pRenderTargetView_);
+    SafeRelease(&pMsaaColorBuffer_);
     SafeRelease(&pBackBuffer_);
     SafeRelease(&pContext_);
     SafeRelease(&pDevice_);
@@ -151,7 +218,7 @@ void* D3DClass::operator new(size_t i)
 {
     // memory allocation
 
-    if (void* ptr = _aligned_malloc(i, 16))
+    if (void* ptr = MemTracker::Allocate(i, 16, MEM_TAG_RENDER))
     {
         return ptr;
     }
@@ -162,7 +229,7 @@ void* D3DClass::operator new(size_t i)
 
 void D3DClass::operator delete(void* p)
 {
-    _aligned_free(p);
+    MemTracker::Free(p);
 }
 
 ///////////////////////////////////////////////////////////
@@ -172,6 +239,10 @@ void D3DClass::BeginScene()
     // before rendering of each frame we need to reset buffers
 
     const FLOAT bgColor[4]{ 0, 1, 1, 0 };
+
+    // flip model unbinds the back buffer from the pipeline after each Present()
+    if (flipModel_)
+        ResetBackBufferRenderTarget();
     
     // clear the render target view with particular color
     pContext_->ClearRenderTargetView(pRenderTargetView_, bgColor);
@@ -187,9 +258,32 @@ void D3DClass::EndScene()
     // after all the rendering into the back buffer 
     // we need to present it on the screen
 
+    // headless: there is nothing to present but commands must be executed
+    if (!pSwapChain_)
+    {
+        pContext_->Flush();
+        return;
+    }
+
+    // the flip model back buffer isn't multisampled
+    if (pMsaaColorBuffer_)
+        pContext_->ResolveSubresource(pBackBuffer_, 0, pMsaaColorBuffer_, 0, backBufferFormat_);
+
     // if vertical synchronization is enabled the first param will be set to 1
-    // or in another case it will be set to 0 (no vsync)
-    pSwapChain_->Present((UINT)vsyncEnabled_, 0);
+    // or in another case it will be set to 0 (no vsync);
+    // tearing is allowed only without vsync (the flip model swap chain is always windowed)
+    const UINT presentFlags = (allowTearing_ && !vsyncEnabled_) ? DXGI_PRESENT_ALLOW_TEARING : 0;
+
+    pSwapChain_->Present((UINT)vsyncEnabled_, presentFlags);
+}
+
+///////////////////////////////////////////////////////////
+
+void D3DClass::WaitForFrameLatency()
+{
+    // the timeout is to not hang forever if the swap chain is lost (minimized window, etc.)
+    if (frameLatencyWaitable_)
+        WaitForSingleObjectEx(frameLatencyWaitable_, 1000, TRUE);
 }
 
 ///////////////////////////////////////////////////////////
@@ -238,10 +332,10 @@ void D3DClass::TurnOnRSfor2Drendering()
 {
     // we call this function to set up a raster state 
     // for proper rendering of 2D elements / UI;
-    // NOTE: we store a hash of the previous RS so later we can set it back
+    // NOTE: we store a mask of the previous RS so later we can set it back
 
-    prevRasterStateHash_ = renderStates_.GetCurrentRSHash();
-    renderStates_.SetRS(pContext_, { FILL_SOLID, CULL_BACK, FRONT_CLOCKWISE });
+    prevRasterStateMask_ = renderStates_.GetCurrentRSMask();
+    renderStates_.SetRS(pContext_, RS_DEFAULT);
 }
 
 
@@ -269,6 +363,7 @@ void D3DClass::InitializeDirectX(
 
         // initialize all the main parts of DirectX
         InitializeSwapChain(hwnd, wndWidth, wndHeight);
+        InitializeFrameLatency();
         InitializeRenderTargetView();
         InitializeViewport(wndWidth, wndHeight);
     }
@@ -293,12 +388,14 @@ void D3DClass::InitializeDevice()
     createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
 #endif
 
-    IDXGIAdapter* pAdapter = adaptersReader_.GetDXGIAdapterByIdx(displayAdapterIndex_);
+    // a software device isn't created by an adapter
+    const bool isSoftware = (driverType_ != D3D_DRIVER_TYPE_UNKNOWN);
+    IDXGIAdapter* pAdapter = (isSoftware) ? nullptr : adaptersReader_.GetDXGIAdapterByIdx(displayAdapterIndex_);
 
     HRESULT hr = D3D11CreateDevice(
         pAdapter,
-        D3D_DRIVER_TYPE_UNKNOWN,
-        0,                                          // no software device
+        driverType_,
+        0,                                          // no software rasterizer DLL
         createDeviceFlags,
         0, 0,                                       // default feature level array
         D3D11_SDK_VERSION,
@@ -346,15 +443,19 @@ bool D3DClass::ResizeSwapChain(HWND hwnd, SIZE newSize)
         // 2. Release rendering target
         SafeRelease(&pDepthStencilBuffer_);
         SafeRelease(&pDepthStencilView_);
+        SafeRelease(&pDepthSRV_);
         SafeRelease(&pRenderTargetView_);
+        SafeRelease(&pMsaaColorBuffer_);
+        SafeRelease(&pBackBuffer_);
         pContext->Flush();
 
         // 3. Resize buffer:
         //    Preserve the existing buffer count and format.
         //    Automatically choose the width and height to match the client rect for HWNDs.
+        //    (the flags must be the same as during creation of the swap chain)
         hr = pSwapChain_->ResizeBuffers(0, 0, 0,
             DXGI_FORMAT_UNKNOWN,                  
-            DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH);
+            swapChainFlags_);
         CAssert::NotFailed(hr, "can't resize swap chain buffers");
 
         // 4. recreate the render target view, depth stencil buffer/view, and viewport
@@ -376,6 +477,10 @@ bool D3DClass::ResizeSwapChain(HWND hwnd, SIZE newSize)
 
 void D3DClass::InitializeSwapChain(HWND hwnd, const int width, const int height)
 {
+    // the flip model saves a copy of the back buffer during presentation and lets us
+    // control the number of queued frames; if it isn't supported (before Windows 10)
+    // we go back to the BLT model
+
     HRESULT hr = S_OK;
     DXGI_SWAP_CHAIN_DESC sd { 0 };
 
@@ -416,10 +521,58 @@ void D3DClass::InitializeSwapChain(HWND hwnd, const int width, const int height)
     IDXGIFactory* pDxgiFactory = nullptr;
     hr = pDxgiAdapter->GetParent(__uuidof(IDXGIFactory), (void**)&pDxgiFactory);
     CAssert::NotFailed(hr, "can't get the interface of DXGI Factory");
-        
+
+
+    if (flipModel_)
+    {
+        DXGI_SWAP_CHAIN_DESC flipDesc = sd;
+
+        // tearing is needed to present without vsync on variable refresh rate displays
+        IDXGIFactory5* pDxgiFactory5 = nullptr;
+        BOOL           allowTearing  = FALSE;
+
+        if (SUCCEEDED(pDxgiFactory->QueryInterface(__uuidof(IDXGIFactory5), (void**)&pDxgiFactory5)))
+        {
+            hr = pDxgiFactory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof(allowTearing));
+            allowTearing_ = SUCCEEDED(hr) && allowTearing;
+            SafeRelease(&pDxgiFactory5);
+        }
+
+        // the flip model requires at least 2 single-sampled buffers (MSAA is resolved
+        // into the back buffer) and the frame latency waitable object isn't supported
+        // in the exclusive full screen mode so we always create a window
+        flipDesc.BufferCount        = 2;
+        flipDesc.SwapEffect         = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+        flipDesc.Windowed           = TRUE;
+        flipDesc.SampleDesc.Count   = 1;
+        flipDesc.SampleDesc.Quality = 0;
+        flipDesc.Flags              = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH | DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+
+        if (allowTearing_)
+            flipDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+
+        hr = pDxgiFactory->CreateSwapChain(pDevice_, &flipDesc, &pSwapChain_);
+
+        if (SUCCEEDED(hr))
+        {
+            swapChainFlags_ = flipDesc.Flags;
+            LogMsgf("swap chain: flip model (tearing: %s)", (allowTearing_) ? "on" : "off");
+        }
+        else
+        {
+            LogErr("can't create a flip model swap chain (go back to the BLT model)");
+            flipModel_    = false;
+            allowTearing_ = false;
+        }
+    }
 
     // Create the swap chain
-    pDxgiFactory->CreateSwapChain(pDevice_, &sd, &pSwapChain_);
+    if (!flipModel_)
+    {
+        hr = pDxgiFactory->CreateSwapChain(pDevice_, &sd, &pSwapChain_);
+        swapChainFlags_ = sd.Flags;
+    }
+
     CAssert::NotFailed(hr, "can't create the swap chain");
     CAssert::NotNullptr(pSwapChain_, "something went wrong during creation of the swap chain because pSwapChain == NULLPTR");
 
@@ -432,6 +585,29 @@ void D3DClass::InitializeSwapChain(HWND hwnd, const int width, const int height)
 
 ///////////////////////////////////////////////////////////
 
+void D3DClass::InitializeFrameLatency()
+{
+    // limit the number of queued frames and get an object which is signaled
+    // when the swap chain can accept one more frame (see WaitForFrameLatency())
+
+    if (!flipModel_)
+        return;
+
+    IDXGISwapChain2* pSwapChain2 = nullptr;
+    HRESULT hr = pSwapChain_->QueryInterface(__uuidof(IDXGISwapChain2), (void**)&pSwapChain2);
+    CAssert::NotFailed(hr, "can't get the interface of DXGI Swap Chain 2");
+
+    hr = pSwapChain2->SetMaximumFrameLatency((UINT)maxFrameLatency_);
+    CAssert::NotFailed(hr, "can't set the maximum frame latency");
+
+    frameLatencyWaitable_ = pSwapChain2->GetFrameLatencyWaitableObject();
+    SafeRelease(&pSwapChain2);
+
+    CAssert::NotNullptr(frameLatencyWaitable_, "can't get the frame latency waitable object");
+}
+
+///////////////////////////////////////////////////////////
+
 void D3DClass::InitializeRenderTargetView()
 {
     // create and set up the render target view to the back buffer;
@@ -444,6 +620,15 @@ void D3DClass::InitializeRenderTargetView()
         hr = pSwapChain_->GetBuffer(0, __uuidof(ID3D11Texture2D), (VOID**)&pBackBuffer);
         CAssert::NotFailed(hr, "can't get a buffer from the swap chain");
 
+        // the flip model back buffer is single-sampled so we render into
+        // a separate MSAA buffer and resolve it before presenting
+        if (flipModel_ && enable4xMsaa_)
+        {
+            pBackBuffer_ = pBackBuffer;
+            InitializeMsaaColorBuffer();
+            return;
+        }
+
         // create a render target view 
         if (pBackBuffer)
         {
@@ -461,6 +646,55 @@ void D3DClass::InitializeRenderTargetView()
 
 ///////////////////////////////////////////////////////////
 
+void D3DClass::InitializeMsaaColorBuffer()
+{
+    // create a multisampled color buffer of the back buffer's size and a render target view to it
+
+    D3D11_TEXTURE2D_DESC desc;
+    pBackBuffer_->GetDesc(&desc);
+
+    desc.SampleDesc.Count   = 4;
+    desc.SampleDesc.Quality = m4xMsaaQuality_ - 1;
+    desc.Usage              = D3D11_USAGE_DEFAULT;
+    desc.BindFlags          = D3D11_BIND_RENDER_TARGET;
+    desc.CPUAccessFlags     = 0;
+    desc.MiscFlags          = 0;
+
+    HRESULT hr = pDevice_->CreateTexture2D(&desc, nullptr, &pMsaaColorBuffer_);
+    CAssert::NotFailed(hr, "can't create a MSAA color buffer");
+
+    hr = pDevice_->CreateRenderTargetView(pMsaaColorBuffer_, nullptr, &pRenderTargetView_);
+    CAssert::NotFailed(hr, "can't create a render target view of the MSAA color buffer");
+}
+
+///////////////////////////////////////////////////////////
+
+void D3DClass::InitializeOffscreenTarget(const UINT width, const UINT height)
+{
+    // the headless mode: a texture is used instead of the swap chain's back buffer
+
+    D3D11_TEXTURE2D_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+
+    desc.Width              = width;
+    desc.Height             = height;
+    desc.MipLevels          = 1;
+    desc.ArraySize          = 1;
+    desc.Format             = backBufferFormat_;
+    desc.SampleDesc.Count   = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Usage              = D3D11_USAGE_DEFAULT;
+    desc.BindFlags          = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+    HRESULT hr = pDevice_->CreateTexture2D(&desc, nullptr, &pBackBuffer_);
+    CAssert::NotFailed(hr, "can't create an offscreen render target");
+
+    hr = pDevice_->CreateRenderTargetView(pBackBuffer_, nullptr, &pRenderTargetView_);
+    CAssert::NotFailed(hr, "can't create a render target view of the offscreen target");
+}
+
+///////////////////////////////////////////////////////////
+
 void D3DClass::InitializeDepthStencil(const UINT width, const UINT height)
 {
     // creates the depth stencil buffer, depth stencil view
@@ -494,7 +728,7 @@ void D3DClass::InitializeDepthStencilTextureBuffer(const UINT width, const UINT
     D3D11_TEXTURE2D_DESC desc;
     desc.Width          = width;
     desc.Height         = height;
-    desc.Format         = DXGI_FORMAT_D24_UNORM_S8_UINT;	// 24 bits for the depth and 8 bits for the stencil
+    desc.Format         = DXGI_FORMAT_R24G8_TYPELESS;	// 24 bits for the depth and 8 bits for the stencil (typeless so we can read the depth in shaders)
     desc.MipLevels      = 1;
     desc.ArraySize      = 1;
 
@@ -504,7 +738,7 @@ void D3DClass::InitializeDepthStencilTextureBuffer(const UINT width, const UINT
     desc.SampleDesc.Quality = (enable4xMsaa_) ? m4xMsaaQuality_ - 1 : 0;
     
     desc.Usage          = D3D11_USAGE_DEFAULT;
-    desc.BindFlags      = D3D11_BIND_DEPTH_STENCIL;
+    desc.BindFlags      = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
     desc.CPUAccessFlags = 0;
     desc.MiscFlags      = 0;
 
@@ -517,23 +751,34 @@ void D3DClass::InitializeDepthStencilTextureBuffer(const UINT width, const UINT
 
 void D3DClass::InitializeDepthStencilView()
 {
-#if 0
     D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc;
     ZeroMemory(&depthStencilViewDesc, sizeof(D3D11_DEPTH_STENCIL_VIEW_DESC));
 
     // Setup the depth stencil view description
+    // (the buffer is typeless so we must specify the format)
     depthStencilViewDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-    depthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+    depthStencilViewDesc.ViewDimension = (enable4xMsaa_) ? D3D11_DSV_DIMENSION_TEXTURE2DMS : D3D11_DSV_DIMENSION_TEXTURE2D;
     depthStencilViewDesc.Texture2D.MipSlice = 0;
-#endif
 
     // Create a depth stencil view
-    const HRESULT hr = pDevice_->CreateDepthStencilView(
+    HRESULT hr = pDevice_->CreateDepthStencilView(
         pDepthStencilBuffer_,
-        nullptr,                  // &depthStencilViewDesc, -- because we specified the type of our depth/stencil buffer, we specify null for this parameter
+        &depthStencilViewDesc,
         &pDepthStencilView_);
 
     CAssert::NotFailed(hr, "can't create a depth stencil view");
+
+    // create a view to read the depth in shaders
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+    ZeroMemory(&srvDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
+
+    srvDesc.Format                    = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+    srvDesc.ViewDimension             = (enable4xMsaa_) ? D3D11_SRV_DIMENSION_TEXTURE2DMS : D3D11_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MostDetailedMip = 0;
+    srvDesc.Texture2D.MipLevels       = 1;
+
+    hr = pDevice_->CreateShaderResourceView(pDepthStencilBuffer_, &srvDesc, &pDepthSRV_);
+    CAssert::NotFailed(hr, "can't create a shader resource view for the depth buffer");
 }
 
 ///////////////////////////////////////////////////////////
@@ -562,6 +807,10 @@ void D3DClass::SetupViewportParams(
 
 bool D3DClass::ToggleFullscreen(HWND hwnd, bool isFullscreen)
 {
+    // there is no window in the headless mode
+    if (!pSwapChain_)
+        return false;
+
     try
     {
         LogDbg("ToggleFullscreen(): " + (isFullscreen) ? "true" : "false");
@@ -587,8 +836,13 @@ bool D3DClass::ToggleFullscreen(HWND hwnd, bool isFullscreen)
             HRESULT hr = hr = pSwapChain_->ResizeTarget(&mode);
             CAssert::NotFailed(hr, "can't resize a target during switching of the fullscreen mode");
 
-            hr = pSwapChain_->SetFullscreenState(TRUE, nullptr);
-            CAssert::NotFailed(hr, "can't set full screen state");
+            // the flip model "full screen" is a window of the screen size
+            // (the frame latency waitable object doesn't work in the exclusive mode)
+            if (!flipModel_)
+            {
+                hr = pSwapChain_->SetFullscreenState(TRUE, nullptr);
+                CAssert::NotFailed(hr, "can't set full screen state");
+            }
 
             // another one for good luck
             hr = pSwapChain_->ResizeTarget(&mode);
@@ -607,8 +861,13 @@ bool D3DClass::ToggleFullscreen(HWND hwnd, bool isFullscreen)
             mode.Width  = windowedModeWidth_;
             mode.Height = windowedModeHeight_;
 
-            HRESULT hr = pSwapChain_->SetFullscreenState(FALSE, nullptr);
-            CAssert::NotFailed(hr, "can't switch to WINDOWED mode");
+            HRESULT hr = S_OK;
+
+            if (!flipModel_)
+            {
+                hr = pSwapChain_->SetFullscreenState(FALSE, nullptr);
+                CAssert::NotFailed(hr, "can't switch to WINDOWED mode");
+            }
 
             hr = pSwapChain_->ResizeTarget(&mode);
             CAssert::NotFailed(hr, "can't resize a target during switching of the fullscreen mode");
@@ -32,9 +32,20 @@ public:
         const bool vsync, 
         const bool fullScreen, 
         const bool enable4xMSAA,
+        const bool flipModel,
+        const int maxFrameLatency,
         const float screenNear, 
         const float screenDepth);
 
+    // headless mode (perf checks on machines without GPUs): a WARP (or reference)
+    // device renders into an offscreen target; there is no window and swap chain
+    bool InitializeHeadless(
+        const int width,
+        const int height,
+        const bool useReferenceDevice,
+        const float screenNear,
+        const float screenDepth);
+
     void SetupViewportParams(
         const float width,
         const float height,
@@ -48,6 +59,10 @@ public:
     // execute some operations before each frame and after each frame
     void BeginScene();
     void EndScene();
+
+    // block until the swap chain can accept one more frame (flip model only);
+    // is called before the input is sampled so the frame is based on the latest input
+    void WaitForFrameLatency();
     
 
     void GetDeviceAndDeviceContext(ID3D11Device*& pDevice, ID3D11DeviceContext*& pContext);
@@ -60,14 +75,18 @@ public:
     inline ID3D11Device*             GetDevice()           const { return pDevice_; }
     inline ID3D11DeviceContext*      GetDeviceContext()    const { return pContext_; }
     inline ID3D11DepthStencilView*   GetDepthStencilView() const { return pDepthStencilView_;}
+    inline ID3D11ShaderResourceView* GetDepthSRV()         const { return pDepthSRV_; }
     inline ID3D11Texture2D*          GetBackBufferTex()    const { return pBackBuffer_;}
     inline ID3D11RenderTargetView*   GetRenderTargetView() const { return pRenderTargetView_; }
     inline DXGI_FORMAT               GetBackBufferFormat() const { return backBufferFormat_; }
+    inline UINT                      GetDepthNumSamples()  const { return (enable4xMsaa_) ? 4 : 1; }
     inline int                       GetWindowWidth()      const { return wndWidth_; }
     inline int                       GetWindowHeight()     const { return wndHeight_; }
     inline float                     GetAspectRatio()      const { return (float)wndWidth_ / (float)wndHeight_; }
     inline float                     GetScreenNear()       const { return screenNear_; }
     inline float                     GetScreenDepth()      const { return screenDepth_; }
+    inline bool                      IsFlipModel()         const { return flipModel_; }
+    inline bool                      IsHeadless()          const { return driverType_ != D3D_DRIVER_TYPE_UNKNOWN; }
 
     // get world/ortho matrix
     //inline const DirectX::XMMATRIX& GetWorldMatrix()       const { return worldMatrix_; }
@@ -78,22 +97,21 @@ public:
     inline RenderStates& GetRenderStates()                       { return renderStates_; }
 
     // set rasterizer states (RS)
-    inline void SetRS(const eRenderState state)                  { renderStates_.SetRS(pContext_, state); }
-    inline void SetRS(const std::set<eRenderState>& states)      { renderStates_.SetRS(pContext_, states); }
+    inline void SetRS(const RenderStatesMask params)             { renderStates_.SetRS(pContext_, params); }
 
     // turning the Z buffer on and off when rendering 2D images
-    inline void TurnZBufferOn()                                  { pContext_->OMSetDepthStencilState(renderStates_.GetDSS(eRenderState::DEPTH_ENABLED), 1); }
-    inline void TurnZBufferOff()                                 { pContext_->OMSetDepthStencilState(renderStates_.GetDSS(eRenderState::DEPTH_DISABLED), 1); }
+    inline void TurnZBufferOn()                                  { renderStates_.SetDSS(pContext_, RSMask(DEPTH_ENABLED), 1); }
+    inline void TurnZBufferOff()                                 { renderStates_.SetDSS(pContext_, RSMask(DEPTH_DISABLED), 1); }
 
-    inline void TurnOnBlending(const eRenderState state)         { renderStates_.SetBS(pContext_, state); }
-    inline void TurnOffBlending()                                { renderStates_.SetBS(pContext_, eRenderState::ALPHA_DISABLE); }
+    inline void TurnOnBlending(const RenderStatesMask state)     { renderStates_.SetBS(pContext_, state); }
+    inline void TurnOffBlending()                                { renderStates_.SetBS(pContext_, RSMask(ALPHA_DISABLE)); }
 
     // set default render target/viewport
     inline void ResetBackBufferRenderTarget()                    { pContext_->OMSetRenderTargets(1, &pRenderTargetView_, pDepthStencilView_); }
     inline void ResetViewport()                                  { pContext_->RSSetViewports(1, &viewport_); }
 
     void TurnOnRSfor2Drendering();
-    inline void TurnOffRSfor2Drendering()                        { renderStates_.SetRSByHash(pContext_, prevRasterStateHash_); }
+    inline void TurnOffRSfor2Drendering()                        { renderStates_.SetRS(pContext_, prevRasterStateMask_); }
 
     // fullscreen/windowed stuff
     bool ToggleFullscreen(HWND hwnd, bool isFullscreen);
@@ -103,6 +121,10 @@ public:
     // handler for the window resizing
     bool ResizeSwapChain(HWND hwnd, SIZE newSize);
 
+    // is used by the next Present()
+    inline void SetVSync(const bool enable)                      { vsyncEnabled_ = enable; }
+    inline bool IsVSync()                                  const { return vsyncEnabled_; }
+
     // memory allocation
     void* operator new(size_t i);
     void operator delete(void* p);
@@ -119,7 +141,10 @@ private:
     void EnumerateAdapters(); // get data about the video card, user's screen, etc.
     void InitializeDevice();
     void InitializeSwapChain(HWND hwnd, const int width, const int height);
+    void InitializeFrameLatency();
     void InitializeRenderTargetView();
+    void InitializeMsaaColorBuffer();
+    void InitializeOffscreenTarget(const UINT width, const UINT height);
 
     // initialize depth stencil parts
     void InitializeDepthStencil(const UINT width, const UINT height);
@@ -138,17 +163,20 @@ private:
     IDXGISwapChain*			  pSwapChain_        = nullptr;    
     ID3D11Device*			  pDevice_           = nullptr;    
     ID3D11DeviceContext*	  pContext_          = nullptr;    
-    ID3D11Texture2D*          pBackBuffer_       = nullptr;    // the render target texture resource
+    ID3D11Texture2D*          pBackBuffer_       = nullptr;    // the swap chain's buffer (is kept only if it's a target of the MSAA resolve)
+    ID3D11Texture2D*          pMsaaColorBuffer_  = nullptr;    // flip model doesn't support MSAA back buffers so we render here and resolve
     ID3D11RenderTargetView*   pRenderTargetView_ = nullptr;    // where we are going to render our buffers
+    HANDLE                    frameLatencyWaitable_ = nullptr; // is signaled when the swap chain can accept one more frame
     D3D11_VIEWPORT            viewport_{0};
 
     // depth stencil stuff
     ID3D11Texture2D*		  pDepthStencilBuffer_ = nullptr;
     ID3D11DepthStencilView*	  pDepthStencilView_ = nullptr;
+    ID3D11ShaderResourceView* pDepthSRV_         = nullptr;    // to read the depth (building of the Hi-Z buffer, etc.)
 
     AdapterReader             adaptersReader_;
     RenderStates              renderStates_;
-    uint8_t                   prevRasterStateHash_ = 0;
+    RenderStatesMask          prevRasterStateMask_ = RS_DEFAULT;
 
     DXGI_FORMAT backBufferFormat_ = DXGI_FORMAT_R8G8B8A8_UNORM;
     int   wndWidth_             = 800;       // current window width
@@ -166,6 +194,12 @@ private:
     bool enable4xMsaa_          = false;   // use 4X MSAA?
     UINT m4xMsaaQuality_        = 0;       // 4X MSAA quality level
     UINT displayAdapterIndex_   = 0;       // set adapter idx (if there is any discrete graphics adapter we use this discrete adapter as primary)
+    D3D_DRIVER_TYPE driverType_ = D3D_DRIVER_TYPE_UNKNOWN;   // by the adapter; WARP/REFERENCE - the headless mode
+
+    bool flipModel_             = false;   // FLIP_DISCARD swap chain (BLT model DISCARD is a fallback)
+    bool allowTearing_          = false;   // present without vsync in windowed mode (variable refresh rate displays)
+    UINT swapChainFlags_        = 0;       // the same flags must be passed into ResizeBuffers()
+    int  maxFrameLatency_       = 1;       // max number of frames queued for presentation
 };
 
 
@@ -27,11 +27,9 @@ SoundClass::~SoundClass()
 bool SoundClass::Initialize(HWND hwnd)
 {
     // Firstly we initialize the DirectSound API as well as the primary buffer.
-    // Once that is initialized then the LoadWaveFile() function can be called 
-    // which will load in the .wav audio file and initialize the secondary 
-    // buffer with the audio information from the .wav file.
-    // After loading is completed then PlayWaveFile() is called which then plays
-    // the .wav file once
+    // Once that is initialized the stream of long sounds is created (it has its
+    // own small circular buffer and a worker thread); short effects are loaded
+    // later by LoadEffect()
     try
     {
         LogDbg("init");
@@ -42,16 +40,8 @@ bool SoundClass::Initialize(HWND hwnd)
         result = InitializeDirectSound(hwnd);
         CAssert::True(result, "can't initialize DirectSound");
 
-        // generate a path to the file
-        sprintf(g_String, "%s%s", g_RelPathAudioDir, "bateman.wav");
-
-        // load a wave audio file onto a secondary buffer
-        result = LoadWaveFile(g_String, &pSecondaryBuffer1_);
-        CAssert::True(result, "can't load in a wave audio file");
-
-        // play the wave file now that it has been loaded
-        result = PlayWaveFile();
-        CAssert::True(result, "can't play the wave audio file");
+        result = stream_.Initialize(pDirectSound_);
+        CAssert::True(result, "can't initialize the sound stream");
 
         return true;
     }
@@ -67,11 +57,19 @@ bool SoundClass::Initialize(HWND hwnd)
 
 void SoundClass::Shutdown()
 {
-    // The Shutdown() function first releases the secondary buffer which held the .wav file
-    // audio data. Once that completes this function then  releases
+    // The Shutdown() function first stops the stream and releases the secondary buffers
+    // which held the .wav effects audio data. Once that completes this function then releases
     // the primary buffer and the DirectSound interface.
 
-    SafeRelease(&pSecondaryBuffer1_);         // release the secondary buffer
+    stream_.Shutdown();
+    numEmitterVoices_ = 0;
+
+    for (Effect& effect : effects_)
+    {
+        for (IDirectSoundBuffer8*& pVoice : effect.voices)
+            SafeRelease(&pVoice);             // release the secondary buffer
+    }
+    effects_.clear();
 
     // shutdown the Direct Sound API
     SafeRelease(&pPrimaryBuffer_);            // release the primary sound buffer pointer
@@ -82,32 +80,205 @@ void SoundClass::Shutdown()
 
 ///////////////////////////////////////////////////////////
 
-bool SoundClass::PlayWaveFile()
+SoundID SoundClass::LoadEffect(const char* filename)
 {
-    /*
-    The PlayWaveFile() function will play the audio file stored in the secondary buffer.
-    The moment you use the Play function it will automatically mix the audio onto the primary
-    buffer and start it playing if it wasn't already. Also note that we set the position
-    to start playing at the beginning of the secondary sound buffer otherwise it will continue
-    from where it last stopped playing. And since we set the capabilities of the buffer
-    to allow us to control the sound we set the volume to maximum here.
-    */
+    // load the effect onto a secondary buffer and make its pool of voices:
+    // duplicates share the audio data of the original buffer so they are cheap
 
-    HRESULT hr = S_OK;
+    Effect effect;
 
-    // set the position at the beginning of the sound buffer
-    hr = pSecondaryBuffer1_->SetCurrentPosition(0);
-    CAssert::NotFailed(hr, "can't set the position in the sound buffer");
+    try
+    {
+        CAssert::NotNullptr(pDirectSound_, "DirectSound isn't initialized");
 
-    // set volume of the buffer to 100%
-    hr = pSecondaryBuffer1_->SetVolume(DSBVOLUME_MAX);
-    CAssert::NotFailed(hr, "can't set volume of the secondary buffer");
+        HRESULT hr = S_OK;
 
-    // play the contents of the secondary sound buffer
-    hr = pSecondaryBuffer1_->Play(0, 0, 0);
-    CAssert::NotFailed(hr, "can't play the contents of the secondary buffer");
+        bool result = LoadWaveFile(filename, &effect.voices[0]);
+        CAssert::True(result, "can't load in a wave audio file");
 
-    return true;
+        for (int i = 1; i < VOICES_PER_EFFECT; ++i)
+        {
+            IDirectSoundBuffer* pDuplicate = nullptr;
+
+            hr = pDirectSound_->DuplicateSoundBuffer(effect.voices[0], &pDuplicate);
+            CAssert::NotFailed(hr, "can't duplicate a sound buffer");
+
+            hr = pDuplicate->QueryInterface(IID_IDirectSoundBuffer8, (void**)&effect.voices[i]);
+            SafeRelease(&pDuplicate);
+            CAssert::NotFailed(hr, "can't create a voice of the sound effect");
+        }
+
+        effects_.push_back(effect);
+        return (SoundID)(effects_.size() - 1);
+    }
+    catch (EngineException& e)
+    {
+        for (IDirectSoundBuffer8*& pVoice : effect.voices)
+            SafeRelease(&pVoice);
+
+        LogErr(e);
+        sprintf(g_String, "can't load a sound effect: %s", filename);
+        LogErr(g_String);
+        return INVALID_SOUND_ID;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool SoundClass::PlayEffect(const SoundID id, const LONG volume)
+{
+    // The moment you use the Play function it will automatically mix the audio onto the primary
+    // buffer and start it playing if it wasn't already. Also note that we set the position
+    // to start playing at the beginning of the voice otherwise it will continue
+    // from where it last stopped playing
+
+    if ((id < 0) || (id >= (SoundID)effects_.size()))
+        return false;
+
+    Effect& effect = effects_[id];
+
+    // find a free voice starting from the oldest one
+    int voiceIdx = FindFreeVoice(effect);
+
+    // all the voices are busy: the oldest one (which isn't taken by an emitter) is restarted
+    for (int i = 0; (voiceIdx == -1) && (i < VOICES_PER_EFFECT); ++i)
+    {
+        const int idx = (effect.nextVoice + i) % VOICES_PER_EFFECT;
+
+        if (!effect.isReserved[idx])
+            voiceIdx = idx;
+    }
+
+    if (voiceIdx == -1)
+        return false;
+
+    effect.nextVoice = (voiceIdx + 1) % VOICES_PER_EFFECT;
+
+    IDirectSoundBuffer8* pVoice = effect.voices[voiceIdx];
+
+    pVoice->SetCurrentPosition(0);
+    pVoice->SetVolume(volume);
+    pVoice->SetPan(DSBPAN_CENTER);
+
+    return SUCCEEDED(pVoice->Play(0, 0, 0));
+}
+
+///////////////////////////////////////////////////////////
+
+//---------------------------------------------------------
+// Desc:  convert a linear gain [0, 1] into DirectSound volume (hundredths of dB)
+//---------------------------------------------------------
+static LONG GainToVolume(const float gain)
+{
+    if (gain <= 0.00001f)
+        return DSBVOLUME_MIN;
+
+    const LONG volume = (LONG)(2000.0f * log10f(gain));
+    return (volume < DSBVOLUME_MIN) ? DSBVOLUME_MIN : volume;
+}
+
+//---------------------------------------------------------
+// Desc:  convert a pan [-1 (left), 1 (right)] into DirectSound pan
+//        (an attenuation of the opposite channel in hundredths of dB)
+//---------------------------------------------------------
+static LONG PanToDirectSound(const float pan)
+{
+    const float absPan      = (fabsf(pan) > 1.0f) ? 1.0f : fabsf(pan);
+    const LONG  attenuation = -GainToVolume(1.0f - absPan);
+
+    return (pan > 0.0f) ? attenuation : -attenuation;
+}
+
+///////////////////////////////////////////////////////////
+
+void SoundClass::UpdateEmitters(
+    const EntityID* ids,
+    const uint32* soundIds,
+    const float* gains,
+    const float* pans,
+    const int numEmitters)
+{
+    // release voices of emitters which aren't heard anymore
+    for (int i = 0; i < numEmitterVoices_; )
+    {
+        const EmitterVoice& ev = emitterVoices_[i];
+        const bool isHeard     = (std::find(ids, ids + numEmitters, ev.id) != ids + numEmitters);
+
+        if (isHeard)
+        {
+            ++i;
+            continue;
+        }
+
+        Effect& effect = effects_[ev.sound];
+        effect.voices[ev.voice]->Stop();
+        effect.isReserved[ev.voice] = false;
+
+        emitterVoices_[i] = emitterVoices_[--numEmitterVoices_];
+    }
+
+    for (int i = 0; i < numEmitters; ++i)
+    {
+        // find the voice of the emitter
+        int evIdx = 0;
+
+        while ((evIdx < numEmitterVoices_) && (emitterVoices_[evIdx].id != ids[i]))
+            ++evIdx;
+
+        // the emitter becomes audible: take a free voice of its sound (if there is no
+        // voice the emitter isn't played in this frame)
+        if (evIdx == numEmitterVoices_)
+        {
+            const SoundID sound = (SoundID)soundIds[i];
+
+            if ((numEmitterVoices_ == MAX_EMITTER_VOICES) || (sound < 0) || (sound >= (SoundID)effects_.size()))
+                continue;
+
+            Effect&   effect = effects_[sound];
+            const int voice  = FindFreeVoice(effect);
+
+            if (voice == -1)
+                continue;
+
+            effect.isReserved[voice] = true;
+            emitterVoices_[numEmitterVoices_++] = { ids[i], sound, voice };
+
+            IDirectSoundBuffer8* pVoice = effect.voices[voice];
+            pVoice->SetVolume(GainToVolume(gains[i]));
+            pVoice->SetPan(PanToDirectSound(pans[i]));
+            pVoice->SetCurrentPosition(0);
+            pVoice->Play(0, 0, DSBPLAY_LOOPING);
+            continue;
+        }
+
+        const EmitterVoice&  ev     = emitterVoices_[evIdx];
+        IDirectSoundBuffer8* pVoice = effects_[ev.sound].voices[ev.voice];
+
+        pVoice->SetVolume(GainToVolume(gains[i]));
+        pVoice->SetPan(PanToDirectSound(pans[i]));
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+int SoundClass::FindFreeVoice(const Effect& effect) const
+{
+    // find a voice which isn't played and isn't taken by an emitter (starting
+    // from the oldest one); return -1 if there is no such a voice
+
+    for (int i = 0; i < VOICES_PER_EFFECT; ++i)
+    {
+        const int idx    = (effect.nextVoice + i) % VOICES_PER_EFFECT;
+        DWORD     status = 0;
+
+        if (effect.isReserved[idx])
+            continue;
+
+        if (SUCCEEDED(effect.voices[idx]->GetStatus(&status)) && !(status & DSBSTATUS_PLAYING))
+            return idx;
+    }
+
+    return -1;
 }
 
 ///////////////////////////////////////////////////////////
@@ -218,56 +389,14 @@ bool SoundClass::VerifyWaveHeaderFile(const WaveHeaderType& waveFileHeader)
 {
     // verify the wave header file so we ensure everything is correct
 
-    int isEqual = 0;
-
-    // check that the chunk ID is the RIFF format
-    isEqual = strncmp(waveFileHeader.chunkId, "RIFF", 4);
-    CAssert::True(isEqual == 0, "chunk ID isn't the RIFF format");
-
-    // check that the format is the WAVE format
-    isEqual = strncmp(waveFileHeader.format, "WAVE", 4);
-    CAssert::True(isEqual == 0, "the file format is not the WAVE format");
-
-    // check that the sub chunk ID is the fmt format
-    isEqual = strncmp(waveFileHeader.subChunkId, "fmt ", 4);
-    CAssert::True(isEqual == 0, "the sub chunk Id is not the fmt format");
-
-    // check that the audio format is WAVE_FORMAT_PCM
-    CAssert::True(waveFileHeader.audioFormat == WAVE_FORMAT_PCM, "the audio format is not WAVE_FORMAT_PCM");
-
-    // check that the wave file was recorded in stereo format
-    CAssert::True(static_cast<bool>(waveFileHeader.numChannels == 2), "the wave file wasn't recorded in stereo format");
-
-    // check that the wave file was recorded at a sample rate of 44.1KHz
-    CAssert::True(static_cast<bool>(waveFileHeader.sampleRate == 44100), "the wave file wasn't recorded at a sample rate of 44.1KHz");
-
-    // ensure that the wave file was recorded in 16 bit format
-    CAssert::True(static_cast<bool>(waveFileHeader.bitsPerSample == 16), "the wave file wasn't recorded in 16 bit format");
-
-    // check for the data chunk header
-    isEqual = strncmp(waveFileHeader.dataChunkId, "data", 4);
-    CAssert::True(isEqual == 0, "wrong data chunk header");
+    const char* err = CheckWaveHeader(waveFileHeader);
+    CAssert::True(err == nullptr, err);
 
     return true;
 }
 
 ///////////////////////////////////////////////////////////
 
-void SoundClass::SetDefaultWaveFormat(WAVEFORMATEX& waveFormat)
-{
-    // set up the wave format with default parameters for the sound buffer
-
-    waveFormat.wFormatTag = WAVE_FORMAT_PCM;
-    waveFormat.nSamplesPerSec = 44100;
-    waveFormat.wBitsPerSample = 16;
-    waveFormat.nChannels = 2;
-    waveFormat.nBlockAlign = (waveFormat.wBitsPerSample / 8) * waveFormat.nChannels;
-    waveFormat.nAvgBytesPerSec = waveFormat.nSamplesPerSec * waveFormat.nBlockAlign;
-    waveFormat.cbSize = 0;
-}
-
-///////////////////////////////////////////////////////////
-
 bool SoundClass::CreateSecondaryBuffer(const WaveHeaderType& waveFileHeader, IDirectSoundBuffer8** secondaryBuffer)
 {
     // setup and create a secondary sound buffer
@@ -290,7 +419,7 @@ bool SoundClass::CreateSecondaryBuffer(const WaveHeaderType& waveFileHeader, IDi
 
     // set the buffer description of the secondary sound buffer that the wave file will be loaded onto.
     bufferDesc.dwSize = sizeof(DSBUFFERDESC);
-    bufferDesc.dwFlags = DSBCAPS_CTRLVOLUME;
+    bufferDesc.dwFlags = DSBCAPS_CTRLVOLUME | DSBCAPS_CTRLPAN;
     bufferDesc.dwBufferBytes = waveFileHeader.dataSize;
     bufferDesc.dwReserved = 0;
     bufferDesc.lpwfxFormat = &waveFormat;
@@ -1,9 +1,11 @@
 ////////////////////////////////////////////////////////////////////
 // Filename:     SoundClass.h
 // Description:  this class ecapsulates the DirectSound functionality
-//               as well as the .wav audio loading and playing capabilities.
+//               as well as the .wav audio loading and playing capabilities:
+//               short effects are preloaded with pools of voices and long
+//               sounds (music, ambience) are streamed (see SoundStream)
 // Created:      05.01.23
-// Revised:      07.01.23
+// Revised:      14.10.26
 ////////////////////////////////////////////////////////////////////
 #pragma once
 
@@ -23,45 +25,71 @@
 #include <dsound.h>
 #include <stdio.h>
 
+#include <Types.h>
+#include <cvector.h>
+#include "WaveFile.h"
+#include "SoundStream.h"
+
 
 namespace Core
 {
 
+using SoundID = int;                                     // an index of a preloaded sound effect
+
 class SoundClass
 {
-private:
-	// this structure is used here for the .wav file format;
-	// its necessary to read in the header to determine the required
-	// information for loading in the .wav audio data;
-	struct WaveHeaderType
-	{
-		char  chunkId[4];
-		ULONG chunkSize;
-		char  format[4];
-		char  subChunkId[4];
-		ULONG  subChunkSize;
-		USHORT audioFormat;
-		USHORT numChannels;
-		ULONG  sampleRate;
-		ULONG  bytesPerSecond;
-		USHORT blockAlign;
-		USHORT bitsPerSample;
-		char   dataChunkId[4];
-		ULONG  dataSize;
-	};
-
-
 public:
+	static constexpr int     VOICES_PER_EFFECT  = 4;        // how many copies of the same effect can be played at once
+	static constexpr int     MAX_EMITTER_VOICES = 32;       // max number of positional sounds which are played at once
+	static constexpr SoundID INVALID_SOUND_ID  = -1;
+
 	SoundClass();
 	SoundClass(const SoundClass& o) = delete;
 	~SoundClass();
 
-	bool Initialize(HWND hwnd); // will initialize DirectSound and load in the audio file and then play it once.
-	void Shutdown();            // will release the audio file and shutdown DirectSound
+	bool Initialize(HWND hwnd); // will initialize DirectSound and the music stream
+	void Shutdown();            // will release the sounds and shutdown DirectSound
+
+	// load a short .wav effect into memory with its pool of voices;
+	// NOTE: must be called at loading time (it reads the file and allocates)
+	SoundID LoadEffect(const char* filename);
 
-	bool PlayWaveFile();
+	// play the effect by a free voice of its pool (the oldest one is restarted if
+	// all are busy): it never allocates or waits for the disk
+	bool PlayEffect(const SoundID id, const LONG volume = DSBVOLUME_MAX);
+
+	// long sounds (music, ambience) are streamed from the disk by a worker thread
+	inline void PlayMusic(const char* filename, const bool isLoop = true) { stream_.Play(filename, isLoop); }
+	inline void StopMusic()                                               { stream_.Stop(); }
+	inline void SetMusicVolume(const LONG volume)                         { stream_.SetVolume(volume); }
+
+	// positional sounds: voices of effects are reserved by audible emitters and looped;
+	// emitters which aren't in the list anymore release their voices
+	// (input: the audible list of the ECS sound system: gains [0, 1], pans [-1, 1])
+	void UpdateEmitters(
+		const EntityID* ids,
+		const uint32* soundIds,
+		const float* gains,
+		const float* pans,
+		const int numEmitters);
 
 private:
+	struct Effect
+	{
+		IDirectSoundBuffer8* voices[VOICES_PER_EFFECT]{ nullptr };  // duplicates share the memory of the first one
+		bool                 isReserved[VOICES_PER_EFFECT]{ false };// the voice is taken by an emitter
+		int                  nextVoice = 0;
+	};
+
+	struct EmitterVoice
+	{
+		EntityID id    = 0;
+		SoundID  sound = INVALID_SOUND_ID;
+		int      voice = 0;
+	};
+
+	int  FindFreeVoice(const Effect& effect) const;
+
 	bool InitializeDirectSound(HWND hwnd);
 
 	bool LoadWaveFile(const char* filename, IDirectSoundBuffer8** ppSoundBuffer);
@@ -69,12 +97,14 @@ private:
 	bool ReadWaveData(const WaveHeaderType& waveFileHeader, IDirectSoundBuffer8** secondaryBuffer, FILE* filePtr);
 
 	bool VerifyWaveHeaderFile(const WaveHeaderType& waveFileHeader);
-	void SetDefaultWaveFormat(WAVEFORMATEX& waveFormat);
 
 private:
-	IDirectSound8* pDirectSound_ = nullptr;
-	IDirectSoundBuffer* pPrimaryBuffer_ = nullptr;
-	IDirectSoundBuffer8* pSecondaryBuffer1_ = nullptr;  // for each sound we need a separate secondary buffer
+	IDirectSound8*       pDirectSound_   = nullptr;
+	IDirectSoundBuffer*  pPrimaryBuffer_ = nullptr;
+	cvector<Effect>      effects_;                          // for each sound we need a separate secondary buffer
+	EmitterVoice         emitterVoices_[MAX_EMITTER_VOICES];
+	int                  numEmitterVoices_ = 0;
+	SoundStream          stream_;
 };
 
 } // namespace Core
@@ -0,0 +1,369 @@
+// =================================================================================
+// Filename:     SoundStream.cpp
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "SoundStream.h"
+#include "WaveFile.h"
+
+
+namespace Core
+{
+
+bool SoundStream::Initialize(IDirectSound8* pDirectSound)
+{
+    try
+    {
+        HRESULT                  hr = S_OK;
+        WAVEFORMATEX             waveFormat;
+        DSBUFFERDESC             bufferDesc;
+        IDirectSoundBuffer*      pTempBuffer = nullptr;
+        IDirectSoundNotify8*     pNotify     = nullptr;
+        DSBPOSITIONNOTIFY        positions[NUM_SEGMENTS];
+
+        CAssert::NotNullptr(pDirectSound, "DirectSound isn't initialized");
+
+        // the circular buffer of the stream (notifications need GETCURRENTPOSITION2 for the accurate cursor)
+        SetDefaultWaveFormat(waveFormat);
+
+        bufferDesc.dwSize          = sizeof(DSBUFFERDESC);
+        bufferDesc.dwFlags         = DSBCAPS_CTRLVOLUME | DSBCAPS_CTRLPOSITIONNOTIFY | DSBCAPS_GETCURRENTPOSITION2;
+        bufferDesc.dwBufferBytes   = SEGMENT_BYTES * NUM_SEGMENTS;
+        bufferDesc.dwReserved      = 0;
+        bufferDesc.lpwfxFormat     = &waveFormat;
+        bufferDesc.guid3DAlgorithm = GUID_NULL;
+
+        hr = pDirectSound->CreateSoundBuffer(&bufferDesc, &pTempBuffer, NULL);
+        CAssert::NotFailed(hr, "can't create a temporary sound buffer for streaming");
+
+        hr = pTempBuffer->QueryInterface(IID_IDirectSoundBuffer8, (void**)&pBuffer_);
+        SafeRelease(&pTempBuffer);
+        CAssert::NotFailed(hr, "can't create the streaming sound buffer");
+
+        // an event is signaled when the play cursor passes the end of a segment
+        for (int i = 0; i < NUM_SEGMENTS; ++i)
+        {
+            hSegmentEvents_[i] = CreateEvent(NULL, FALSE, FALSE, NULL);
+            CAssert::True(hSegmentEvents_[i] != NULL, "can't create an event of the streaming buffer");
+
+            positions[i].dwOffset     = (i + 1) * SEGMENT_BYTES - 1;
+            positions[i].hEventNotify = hSegmentEvents_[i];
+        }
+
+        hr = pBuffer_->QueryInterface(IID_IDirectSoundNotify8, (void**)&pNotify);
+        CAssert::NotFailed(hr, "can't get the notify interface of the streaming buffer");
+
+        hr = pNotify->SetNotificationPositions(NUM_SEGMENTS, positions);
+        SafeRelease(&pNotify);
+        CAssert::NotFailed(hr, "can't set notification positions of the streaming buffer");
+
+        hCmdEvent_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+        CAssert::True(hCmdEvent_ != NULL, "can't create a command event of the streaming buffer");
+
+        isExit_ = false;
+        thread_ = std::thread(&SoundStream::ThreadLoop, this);
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void SoundStream::Shutdown()
+{
+    if (thread_.joinable())
+    {
+        isExit_ = true;
+        SetEvent(hCmdEvent_);
+        thread_.join();
+    }
+
+    for (HANDLE& hEvent : hSegmentEvents_)
+    {
+        if (hEvent)
+            CloseHandle(hEvent);
+        hEvent = NULL;
+    }
+
+    if (hCmdEvent_)
+    {
+        CloseHandle(hCmdEvent_);
+        hCmdEvent_ = NULL;
+    }
+
+    SafeRelease(&pBuffer_);
+}
+
+///////////////////////////////////////////////////////////
+
+void SoundStream::Play(const char* filename, const bool isLoop)
+{
+    if (!thread_.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(cmdMutex_);
+        cmd_       = STREAM_CMD_PLAY;
+        cmdIsLoop_ = isLoop;
+        strncpy(cmdPath_, filename, sizeof(cmdPath_) - 1);
+        cmdPath_[sizeof(cmdPath_) - 1] = '\0';
+    }
+
+    SetEvent(hCmdEvent_);
+}
+
+///////////////////////////////////////////////////////////
+
+void SoundStream::Stop()
+{
+    if (!thread_.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(cmdMutex_);
+        cmd_ = STREAM_CMD_STOP;
+    }
+
+    SetEvent(hCmdEvent_);
+}
+
+///////////////////////////////////////////////////////////
+
+void SoundStream::SetVolume(const LONG volume)
+{
+    if (pBuffer_)
+        pBuffer_->SetVolume(volume);
+}
+
+
+// =================================================================================
+// Private methods (are executed by the worker)
+// =================================================================================
+void SoundStream::ThreadLoop()
+{
+    HANDLE events[NUM_SEGMENTS + 1];
+    events[0] = hCmdEvent_;
+
+    for (int i = 0; i < NUM_SEGMENTS; ++i)
+        events[i + 1] = hSegmentEvents_[i];
+
+    while (!isExit_)
+    {
+        const DWORD res = WaitForMultipleObjects(NUM_SEGMENTS + 1, events, FALSE, INFINITE);
+
+        if (isExit_)
+            break;
+
+        if (res == WAIT_OBJECT_0)
+        {
+            ExecuteCmd();
+            continue;
+        }
+
+        const int segment = (int)(res - WAIT_OBJECT_0) - 1;
+
+        if ((segment < 0) || (segment >= NUM_SEGMENTS) || !isPlaying_)
+            continue;
+
+        // the last data of a non-looped sound is played
+        if (segment == endSegment_)
+        {
+            StopPlayback();
+            continue;
+        }
+
+        // the segment is played so it is refilled while the others are played
+        FillSegment(segment);
+    }
+
+    StopPlayback();
+}
+
+///////////////////////////////////////////////////////////
+
+void SoundStream::ExecuteCmd()
+{
+    char       path[256];
+    bool       isLoop = false;
+    eStreamCmd cmd    = STREAM_CMD_NONE;
+
+    {
+        std::lock_guard<std::mutex> lock(cmdMutex_);
+        cmd    = cmd_;
+        isLoop = cmdIsLoop_;
+        strcpy(path, cmdPath_);
+        cmd_   = STREAM_CMD_NONE;
+    }
+
+    if (cmd == STREAM_CMD_STOP)
+    {
+        StopPlayback();
+    }
+    else if (cmd == STREAM_CMD_PLAY)
+    {
+        StopPlayback();
+
+        if (!OpenFile(path))
+            return;
+
+        isLoop_ = isLoop;
+
+        for (int i = 0; i < NUM_SEGMENTS; ++i)
+            FillSegment(i);
+
+        pBuffer_->SetCurrentPosition(0);
+
+        if (FAILED(pBuffer_->Play(0, 0, DSBPLAY_LOOPING)))
+        {
+            char msg[300];
+            snprintf(msg, sizeof(msg), "can't play the streamed sound: %s", path);
+            LogErr(msg);
+            StopPlayback();
+            return;
+        }
+
+        isPlaying_ = true;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool SoundStream::OpenFile(const char* filename)
+{
+    WaveHeaderType header;
+    char           msg[300];
+
+    pFile_ = fopen(filename, "rb");
+
+    if (!pFile_)
+    {
+        snprintf(msg, sizeof(msg), "can't open a file of the streamed sound: %s", filename);
+        LogErr(msg);
+        return false;
+    }
+
+    if (fread(&header, sizeof(header), 1, pFile_) != 1)
+    {
+        snprintf(msg, sizeof(msg), "can't read in the wave file header: %s", filename);
+        LogErr(msg);
+        CloseFile();
+        return false;
+    }
+
+    if (const char* err = CheckWaveHeader(header))
+    {
+        snprintf(msg, sizeof(msg), "%s: %s", err, filename);
+        LogErr(msg);
+        CloseFile();
+        return false;
+    }
+
+    if (header.dataSize == 0)
+    {
+        CloseFile();
+        return false;
+    }
+
+    // the wave data starts at the end of the data chunk header
+    dataStart_  = (long)sizeof(WaveHeaderType);
+    dataSize_   = header.dataSize;
+    dataLeft_   = header.dataSize;
+    endSegment_ = -1;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void SoundStream::CloseFile()
+{
+    if (pFile_)
+    {
+        fclose(pFile_);
+        pFile_ = nullptr;
+    }
+
+    dataSize_ = 0;
+    dataLeft_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+void SoundStream::FillSegment(const int segment)
+{
+    // read the next data of the file into the segment; after the end of
+    // a non-looped sound the rest of the segment is filled with silence
+
+    BYTE* pDst  = nullptr;
+    DWORD size  = 0;
+
+    if (FAILED(pBuffer_->Lock(segment * SEGMENT_BYTES, SEGMENT_BYTES, (void**)&pDst, &size, nullptr, nullptr, 0)))
+        return;
+
+    DWORD written = 0;
+
+    while ((written < size) && pFile_)
+    {
+        if (dataLeft_ == 0)
+        {
+            if (!isLoop_)
+                break;
+
+            fseek(pFile_, dataStart_, SEEK_SET);
+            dataLeft_ = dataSize_;
+        }
+
+        const DWORD  toRead = std::min(size - written, dataLeft_);
+        const size_t count  = fread(pDst + written, 1, toRead, pFile_);
+
+        // a broken file: it is played until this point
+        if (count == 0)
+        {
+            dataLeft_ = 0;
+            isLoop_   = false;
+            break;
+        }
+
+        written   += (DWORD)count;
+        dataLeft_ -= (DWORD)count;
+    }
+
+    // 16-bit PCM silence
+    if (written < size)
+        memset(pDst + written, 0, size - written);
+
+    // remember which segment has the last data so the playback is stopped after it
+    if (!isLoop_ && (dataLeft_ == 0) && (endSegment_ == -1))
+        endSegment_ = (written > 0) ? segment : (segment + NUM_SEGMENTS - 1) % NUM_SEGMENTS;
+
+    pBuffer_->Unlock(pDst, size, nullptr, 0);
+}
+
+///////////////////////////////////////////////////////////
+
+void SoundStream::StopPlayback()
+{
+    if (pBuffer_)
+        pBuffer_->Stop();
+
+    CloseFile();
+
+    // notifications which came before the stop are dropped
+    for (HANDLE hEvent : hSegmentEvents_)
+    {
+        if (hEvent)
+            ResetEvent(hEvent);
+    }
+
+    endSegment_ = -1;
+    isPlaying_  = false;
+}
+
+} // namespace Core
@@ -0,0 +1,92 @@
+// =================================================================================
+// Filename:     SoundStream.h
+// Description:  streaming playback of long sounds (music, ambience): instead of
+//               loading the whole .wav file there is a small circular secondary
+//               buffer which is refilled from the disk by a worker thread:
+//
+//               - the buffer is split into segments; DirectSound signals an event
+//                 when the play cursor passes the end of a segment so the worker
+//                 refills that segment while the others are played;
+//               - play/stop requests only post a command to the worker so the
+//                 caller never waits for the disk (the file is opened and the
+//                 first segments are read by the worker as well)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <windows.h>
+#include <mmsystem.h>
+#include <dsound.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+
+namespace Core
+{
+
+class SoundStream
+{
+public:
+    static constexpr int   NUM_SEGMENTS  = 2;                  // double buffering
+    static constexpr DWORD SEGMENT_BYTES = 44100 * 4 / 2;      // 0.5 sec of 44.1KHz 16-bit stereo
+
+    SoundStream() {}
+    ~SoundStream() { Shutdown(); }
+
+    // restrict a copying of this class instance
+    SoundStream(const SoundStream&) = delete;
+    SoundStream& operator=(const SoundStream&) = delete;
+
+    // create the circular buffer, its notifications and the worker thread
+    bool Initialize(IDirectSound8* pDirectSound);
+    void Shutdown();
+
+    // post a request to the worker (the current sound is replaced)
+    void Play(const char* filename, const bool isLoop);
+    void Stop();
+
+    void SetVolume(const LONG volume);
+
+private:
+    enum eStreamCmd
+    {
+        STREAM_CMD_NONE,
+        STREAM_CMD_PLAY,
+        STREAM_CMD_STOP,
+    };
+
+    void ThreadLoop();
+    void ExecuteCmd();
+    bool OpenFile(const char* filename);
+    void CloseFile();
+    void FillSegment(const int segment);
+    void StopPlayback();
+
+private:
+    IDirectSoundBuffer8* pBuffer_ = nullptr;
+    HANDLE               hSegmentEvents_[NUM_SEGMENTS]{ NULL };   // the play cursor passed the end of the segment
+    HANDLE               hCmdEvent_  = NULL;                      // a command is posted (or the thread must exit)
+    std::thread          thread_;
+    std::atomic<bool>    isExit_     = false;
+
+    // the posted command (guarded by the mutex)
+    std::mutex           cmdMutex_;
+    eStreamCmd           cmd_        = STREAM_CMD_NONE;
+    char                 cmdPath_[256]{ '\0' };
+    bool                 cmdIsLoop_  = false;
+
+    // is used only by the worker
+    FILE*                pFile_      = nullptr;
+    long                 dataStart_  = 0;              // offset of the wave data in the file
+    DWORD                dataSize_   = 0;
+    DWORD                dataLeft_   = 0;              // bytes which aren't read yet
+    int                  endSegment_ = -1;             // a segment with the last data (non-looped sound)
+    bool                 isLoop_     = false;
+    bool                 isPlaying_  = false;
+};
+
+} // namespace Core
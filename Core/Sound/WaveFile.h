@@ -0,0 +1,86 @@
+// =================================================================================
+// Filename:     WaveFile.h
+// Description:  the header of a .wav file and its checking; it is shared by sound
+//               effects (which are loaded at once) and streamed sounds
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <windows.h>
+#include <mmsystem.h>
+#include <string.h>
+
+
+namespace Core
+{
+
+// this structure is used here for the .wav file format;
+// its necessary to read in the header to determine the required
+// information for loading in the .wav audio data;
+struct WaveHeaderType
+{
+    char   chunkId[4];
+    ULONG  chunkSize;
+    char   format[4];
+    char   subChunkId[4];
+    ULONG  subChunkSize;
+    USHORT audioFormat;
+    USHORT numChannels;
+    ULONG  sampleRate;
+    ULONG  bytesPerSecond;
+    USHORT blockAlign;
+    USHORT bitsPerSample;
+    char   dataChunkId[4];
+    ULONG  dataSize;
+};
+
+//---------------------------------------------------------
+// Desc:  check that the file is a 44.1KHz 16-bit stereo PCM wave
+//        (the format of the primary buffer)
+// Ret:   an error message or nullptr if the header is fine
+//---------------------------------------------------------
+inline const char* CheckWaveHeader(const WaveHeaderType& header)
+{
+    if (strncmp(header.chunkId, "RIFF", 4) != 0)
+        return "chunk ID isn't the RIFF format";
+
+    if (strncmp(header.format, "WAVE", 4) != 0)
+        return "the file format is not the WAVE format";
+
+    if (strncmp(header.subChunkId, "fmt ", 4) != 0)
+        return "the sub chunk Id is not the fmt format";
+
+    if (header.audioFormat != WAVE_FORMAT_PCM)
+        return "the audio format is not WAVE_FORMAT_PCM";
+
+    if (header.numChannels != 2)
+        return "the wave file wasn't recorded in stereo format";
+
+    if (header.sampleRate != 44100)
+        return "the wave file wasn't recorded at a sample rate of 44.1KHz";
+
+    if (header.bitsPerSample != 16)
+        return "the wave file wasn't recorded in 16 bit format";
+
+    if (strncmp(header.dataChunkId, "data", 4) != 0)
+        return "wrong data chunk header";
+
+    return nullptr;
+}
+
+//---------------------------------------------------------
+// Desc:  set up the wave format with default parameters for the sound buffers
+//---------------------------------------------------------
+inline void SetDefaultWaveFormat(WAVEFORMATEX& waveFormat)
+{
+    waveFormat.wFormatTag      = WAVE_FORMAT_PCM;
+    waveFormat.nSamplesPerSec  = 44100;
+    waveFormat.wBitsPerSample  = 16;
+    waveFormat.nChannels       = 2;
+    waveFormat.nBlockAlign     = (waveFormat.wBitsPerSample / 8) * waveFormat.nChannels;
+    waveFormat.nAvgBytesPerSec = waveFormat.nSamplesPerSec * waveFormat.nBlockAlign;
+    waveFormat.cbSize          = 0;
+}
+
+} // namespace Core
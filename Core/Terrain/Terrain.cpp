@@ -72,7 +72,12 @@ bool Terrain::InitBuffers(
         CAssert::True(numIndices > 0,  "input number of indices must be > 0");
 
         constexpr bool isDynamic = false;
-        vb_.Initialize(pDevice, vertices, numVertices, isDynamic);
+
+        cvector<Vertex3dTerrainPacked> packedVertices;
+        packedVertices.resize_uninitialized(numVertices);
+        PackVertices(vertices, packedVertices.data(), numVertices);
+
+        vb_.Initialize(pDevice, packedVertices.data(), numVertices, isDynamic);
         ib_.Initialize(pDevice, indices, numIndices);
 
         return true;
@@ -129,12 +134,10 @@ void Terrain::SetTexture(const int idx, const TexID texID)
         return;
     }
 
-    // everything is ok so set the texture for terrain's material
-    Material& mat = g_MaterialMgr.GetMaterialByID(materialID_);
-
+    // everything is ok so set the texture for terrain's material;
     // NOTE: we used slightly different approach of terrain types:
     // for instance ambient texture type can be used for detail map or something like that
-    mat.SetTexture(eTexType(idx), texID);
+    g_MaterialMgr.SetMaterialTexture(materialID_, eTexType(idx), texID);
 }
 
 } // namespace
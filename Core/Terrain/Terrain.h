@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../Mesh/Vertex3dTerrain.h"
+#include "../Mesh/VertexPacked.h"
 #include "../Mesh/VertexBuffer.h"
 #include "../Mesh/IndexBuffer.h"
 #include "TerrainBase.h"
@@ -54,12 +55,12 @@ public:
 
 public:
     char                name_[8] = "terrain";
-    uint8_t             vertexStride_ = sizeof(Vertex3dTerrain);
+    uint8_t             vertexStride_ = sizeof(Vertex3dTerrainPacked);
     uint32_t            numVertices_ = 0;
     uint32_t            numIndices_ = 0;
     MaterialID          materialID_ = 0;
 
-    VertexBuffer<Vertex3dTerrain> vb_;
+    VertexBuffer<Vertex3dTerrainPacked> vb_;     // vertices are packed at uploading
     IndexBuffer<UINT>   ib_;
     DirectX::XMFLOAT3   center_;
     DirectX::XMFLOAT3   extents_;
@@ -4,6 +4,9 @@
 #include <CoreCommon/pch.h>
 #include "TerrainBase.h"
 #include "../Texture/TextureMgr.h"
+#include <JobSystem.h>
+#include <TextTokenizer.h>
+#include <DirectXMath.h>    // for _XM_SSE_INTRINSICS_
 #include <time.h>
 
 #pragma warning (disable : 4996)
@@ -13,10 +16,197 @@
 namespace Core
 {
 
+// granularity of the parallel generation of heights (rows/columns per job);
+// the number of columns is a multiple of 4 so each job filters them by SSE
+static constexpr index GEN_ROWS_PER_JOB = 16;
+static constexpr index GEN_COLS_PER_JOB = 64;
+
+// granularity of the parallel height sampling (points per job)
+static constexpr index SAMPLES_PER_JOB  = 1024;
+
+//---------------------------------------------------------
+// Desc:  floor/ceil of the integer division (b > 0)
+//---------------------------------------------------------
+static inline int FloorDiv(const int a, const int b)
+{
+    return (a / b) - (((a % b) != 0) && (a < 0));
+}
+
+static inline int CeilDiv(const int a, const int b)
+{
+    return -FloorDiv(-a, b);
+}
+
+//---------------------------------------------------------
+// Desc:  raise a row of heights by one side of the fault line:
+//        the side test (x-x1)*dirZ - dirX*(z-z1) > 0 is linear by x so
+//        it is solved once per row and a continuous range of x is raised
+// Args:  - row:        heights of the row z
+//        - size:       number of heights in the row
+//        - x1, z1:     a point of the fault line
+//        - dirX, dirZ: direction of the fault line
+//        - height:     how much to raise
+//---------------------------------------------------------
+static void RaiseRowByFault(
+    float* row,
+    const int size,
+    const int z,
+    const int x1,
+    const int z1,
+    const int dirX,
+    const int dirZ,
+    const float height)
+{
+    // the test is: x*dirZ + c > 0
+    const int c = -(x1 * dirZ) - dirX * (z - z1);
+    int begin = 0;
+    int end   = size;
+
+    if (dirZ > 0)
+        begin = FloorDiv(-c, dirZ) + 1;
+
+    else if (dirZ < 0)
+        end = CeilDiv(c, -dirZ);
+
+    else if (c <= 0)
+        return;
+
+    begin = std::max(begin, 0);
+    end   = std::min(end, size);
+
+    int x = begin;
+
+#if defined(_XM_SSE_INTRINSICS_)
+    const __m128 h = _mm_set1_ps(height);
+
+    for (; x + 4 <= end; x += 4)
+        _mm_storeu_ps(row + x, _mm_add_ps(_mm_loadu_ps(row + x), h));
+#endif
+
+    for (; x < end; ++x)
+        row[x] += height;
+}
+
+//---------------------------------------------------------
+// Desc:  bilinearly sample scaled heights at points [start, end)
+// Args:  - heights:     8-bit height map (mapSize x mapSize, mapSize >= 2)
+//        - heightScale: scale of heights
+//        - xz:          input points
+//        - outY:        output heights
+//---------------------------------------------------------
+static void SampleHeightsRange(
+    const uint8* heights,
+    const int mapSize,
+    const float heightScale,
+    const DirectX::XMFLOAT2* xz,
+    const index start,
+    const index end,
+    float* outY)
+{
+    // a point is clamped so its cell (x0,z0)-(x0+1,z0+1) is inside of the map
+    const float maxCoord = (float)(mapSize - 1);
+    const float maxCell  = (float)(mapSize - 2);
+    index       i        = start;
+
+#if defined(_XM_SSE_INTRINSICS_)
+    const __m128 vZero    = _mm_setzero_ps();
+    const __m128 vMax     = _mm_set1_ps(maxCoord);
+    const __m128 vMaxCell = _mm_set1_ps(maxCell);
+    const __m128 vScale   = _mm_set1_ps(heightScale);
+
+    alignas(16) int cellX[4];
+    alignas(16) int cellZ[4];
+    alignas(16) int h1[4], h2[4], h3[4], h4[4];
+
+    for (; i + 4 <= end; i += 4)
+    {
+        // deinterleave 4 points: (x0 z0 x1 z1) (x2 z2 x3 z3) => (x0 x1 x2 x3) (z0 z1 z2 z3)
+        const __m128 p01 = _mm_loadu_ps(&xz[i].x);
+        const __m128 p23 = _mm_loadu_ps(&xz[i + 2].x);
+        const __m128 x   = _mm_min_ps(_mm_max_ps(_mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2,0,2,0)), vZero), vMax);
+        const __m128 z   = _mm_min_ps(_mm_max_ps(_mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3,1,3,1)), vZero), vMax);
+
+        // the coords are non-negative so the truncation is floor
+        const __m128 fx = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(x)), vMaxCell);
+        const __m128 fz = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(z)), vMaxCell);
+
+        _mm_store_si128((__m128i*)cellX, _mm_cvttps_epi32(fx));
+        _mm_store_si128((__m128i*)cellZ, _mm_cvttps_epi32(fz));
+
+        // there is no gather in SSE: fetch 4 corners of each cell
+        for (int k = 0; k < 4; ++k)
+        {
+            const uint8* p = heights + (cellZ[k] * mapSize) + cellX[k];
+            h1[k] = p[0];
+            h2[k] = p[1];
+            h3[k] = p[mapSize];
+            h4[k] = p[mapSize + 1];
+        }
+
+        const __m128 tx   = _mm_sub_ps(x, fx);
+        const __m128 tz   = _mm_sub_ps(z, fz);
+        const __m128 v1   = _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)h1));
+        const __m128 v2   = _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)h2));
+        const __m128 v3   = _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)h3));
+        const __m128 v4   = _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)h4));
+
+        // bilinear interpolation
+        const __m128 v12  = _mm_add_ps(v1, _mm_mul_ps(tx, _mm_sub_ps(v2, v1)));
+        const __m128 v34  = _mm_add_ps(v3, _mm_mul_ps(tx, _mm_sub_ps(v4, v3)));
+        const __m128 h    = _mm_add_ps(v12, _mm_mul_ps(tz, _mm_sub_ps(v34, v12)));
+
+        _mm_storeu_ps(outY + i, _mm_mul_ps(h, vScale));
+    }
+#endif
+
+    for (; i < end; ++i)
+    {
+        const float x  = MathHelper::Clamp(xz[i].x, 0.0f, maxCoord);
+        const float z  = MathHelper::Clamp(xz[i].y, 0.0f, maxCoord);
+        const float fx = std::min(floorf(x), maxCell);
+        const float fz = std::min(floorf(z), maxCell);
+
+        const uint8* p  = heights + ((int)fz * mapSize) + (int)fx;
+        const float  tx = x - fx;
+        const float  tz = z - fz;
+
+        const float v12 = p[0]       + tx * (p[1]           - p[0]);
+        const float v34 = p[mapSize] + tx * (p[mapSize + 1] - p[mapSize]);
+
+        outY[i] = heightScale * (v12 + tz * (v34 - v12));
+    }
+}
+
 // =================================================================================
 // Public methods
 // =================================================================================
 
+//---------------------------------------------------------
+// Desc:   compute bilinearly interpolated scaled heights at many points at once
+// Args:   - xz:   points (x, z) in the height map space
+//         - n:    number of points
+//         - outY: output heights (n values)
+//---------------------------------------------------------
+void TerrainBase::SampleHeights(const DirectX::XMFLOAT2* xz, const size n, float* outY) const
+{
+    const uint8* heights = heightMap_.GetData();
+    const int    mapSize = heightMap_.GetWidth();
+
+    if (!xz || !outY || (n <= 0))
+        return;
+
+    if (!heights || (mapSize < 2))
+    {
+        LogErr("can't sample terrain heights: there is no height map");
+        return;
+    }
+
+    g_JobSystem.ParallelFor((index)n, SAMPLES_PER_JOB, [&](const index start, const index end)
+    {
+        SampleHeightsRange(heights, mapSize, heightScale_, xz, start, end, outY);
+    });
+}
+
 // --------------------------------------------------------
 // Desc:   release memory from all the images raw pixels data
 //         (usually we call it after creation of all the necessary
@@ -55,45 +245,32 @@ bool TerrainBase::LoadSetupFile(const char* filename, TerrainConfig& outConfigs)
         return false;
     }
 
-    // open the setup file
-    FILE* pFile = fopen(filename, "r");
-    if (!pFile)
+    // map the setup file
+    TextTokenizer tok;
+
+    if (!tok.Open(filename))
     {
         sprintf(g_String, "can't open a terrain setup file: %s", filename);
         LogErr(g_String);
         return false;
     }
 
-    int           tempBool = 0;
-    constexpr int bufsize = 256;
-    char          buf[bufsize]{ '\0' };
-    char          tmpChars[64]{'\0'};
-    float         fl[4]{0};
+    int   tempBool = 0;
+    char  tmpChars[64]{'\0'};
+    float fl[4]{0};
 
     LogDbg("Start: read in the terrain setup file");
 
     // read in terrain common data
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Path_texture_map: %s", outConfigs.pathTextureMap);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Path_height_map: %s", outConfigs.pathHeightMap);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Path_detail_map: %s", outConfigs.pathDetailMap);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Path_light_map: %s", outConfigs.pathLightMap);
+    tok.ReadKeyStr("Path_texture_map:", outConfigs.pathTextureMap, sizeof(outConfigs.pathTextureMap));
+    tok.ReadKeyStr("Path_height_map:",  outConfigs.pathHeightMap,  sizeof(outConfigs.pathHeightMap));
+    tok.ReadKeyStr("Path_detail_map:",  outConfigs.pathDetailMap,  sizeof(outConfigs.pathDetailMap));
+    tok.ReadKeyStr("Path_light_map:",   outConfigs.pathLightMap,   sizeof(outConfigs.pathLightMap));
 
     // depth, width, height_scale
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Terrain_depth: %d", &outConfigs.depth);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Terrain_width: %d", &outConfigs.width);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Height_scaling: %f", &outConfigs.heightScale);
+    tok.ReadKey("Terrain_depth:",  outConfigs.depth);
+    tok.ReadKey("Terrain_width:",  outConfigs.width);
+    tok.ReadKey("Height_scaling:", outConfigs.heightScale);
 
     // setup data fields
     terrainDepth_ = outConfigs.depth;
@@ -101,75 +278,45 @@ bool TerrainBase::LoadSetupFile(const char* filename, TerrainConfig& outConfigs)
     heightScale_  = outConfigs.heightScale;
 
     // do we want to generate terrain texture (tile) map?
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Generate_texture_map: %d", &tempBool);
-    outConfigs.generateTextureMap = (uint8)tempBool;
+    if (tok.ReadKey("Generate_texture_map:", tempBool))
+        outConfigs.generateTextureMap = (uint8)tempBool;
 
     // do we want to generate terrain heights?
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Generate_heights: %d", &tempBool);
-    outConfigs.generateHeights = (uint8)tempBool;
+    if (tok.ReadKey("Generate_heights:", tempBool))
+        outConfigs.generateHeights = (uint8)tempBool;
 
     // do we want to generate lightmap for the terrain?
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Generate_lightmap: %d", &tempBool);
-    outConfigs.generateLightMap = (uint8)tempBool;
+    if (tok.ReadKey("Generate_lightmap:", tempBool))
+        outConfigs.generateLightMap = (uint8)tempBool;
 
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Use_gen_fault_formation: %d", &tempBool);
-    outConfigs.useGenFaultFormation = (uint8)tempBool;
+    if (tok.ReadKey("Use_gen_fault_formation:", tempBool))
+        outConfigs.useGenFaultFormation = (uint8)tempBool;
 
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Use_gen_midpoint_displacement: %d", &tempBool);
-    outConfigs.useGenMidpointDisplacement = (uint8)tempBool;
+    if (tok.ReadKey("Use_gen_midpoint_displacement:", tempBool))
+        outConfigs.useGenMidpointDisplacement = (uint8)tempBool;
 
 
     // read in params for heights generation
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Fault_formation_iterations: %d", &outConfigs.numIterations);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Fault_formation_min_delta: %d", &outConfigs.minDelta);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Fault_formation_max_delta: %d", &outConfigs.maxDelta);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Fault_formation_filter: %f", &outConfigs.filter);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Midpoint_displacement_roughness: %f", &outConfigs.roughness);
+    tok.ReadKey("Fault_formation_iterations:",      outConfigs.numIterations);
+    tok.ReadKey("Fault_formation_min_delta:",       outConfigs.minDelta);
+    tok.ReadKey("Fault_formation_max_delta:",       outConfigs.maxDelta);
+    tok.ReadKey("Fault_formation_filter:",          outConfigs.filter);
+    tok.ReadKey("Midpoint_displacement_roughness:", outConfigs.roughness);
 
 
     // read in params for texture map
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Generated_texture_map_size: %d", &outConfigs.textureMapSize);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Path_lowest_tile: %s", outConfigs.pathLowestTile);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Path_low_tile: %s", outConfigs.pathLowTile);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Path_high_tile: %s", outConfigs.pathHighTile);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Path_highest_tile: %s", outConfigs.pathHighestTile);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Path_save_generated_height_map: %s", outConfigs.pathSaveHeightMap);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Path_save_generated_texture_map: %s", outConfigs.pathSaveTextureMap);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Path_save_generated_light_map: %s", outConfigs.pathSaveLightMap);
+    tok.ReadKey   ("Generated_texture_map_size:",      outConfigs.textureMapSize);
+    tok.ReadKeyStr("Path_lowest_tile:",                outConfigs.pathLowestTile,     sizeof(outConfigs.pathLowestTile));
+    tok.ReadKeyStr("Path_low_tile:",                   outConfigs.pathLowTile,        sizeof(outConfigs.pathLowTile));
+    tok.ReadKeyStr("Path_high_tile:",                  outConfigs.pathHighTile,       sizeof(outConfigs.pathHighTile));
+    tok.ReadKeyStr("Path_highest_tile:",               outConfigs.pathHighestTile,    sizeof(outConfigs.pathHighestTile));
+    tok.ReadKeyStr("Path_save_generated_height_map:",  outConfigs.pathSaveHeightMap,  sizeof(outConfigs.pathSaveHeightMap));
+    tok.ReadKeyStr("Path_save_generated_texture_map:", outConfigs.pathSaveTextureMap, sizeof(outConfigs.pathSaveTextureMap));
+    tok.ReadKeyStr("Path_save_generated_light_map:",   outConfigs.pathSaveLightMap,   sizeof(outConfigs.pathSaveLightMap));
 
 
     // lightmap generation params
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Lighting_type: %s", tmpChars);
+    tok.ReadKeyStr("Lighting_type:", tmpChars, sizeof(tmpChars));
 
     if (strcmp(tmpChars, "HEIGHT_BASED") == 0)
         outConfigs.lightingType = HEIGHT_BASED;
@@ -181,33 +328,32 @@ bool TerrainBase::LoadSetupFile(const char* filename, TerrainConfig& outConfigs)
         outConfigs.lightingType = SLOPE_LIGHT;
 
 
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Light_color: %f %f %f %f", &fl[0], &fl[1], &fl[2], &fl[3]);
-
-    outConfigs.lightColor = { fl[0], fl[1], fl[2], fl[3] };
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Light_direction_x: %d",      &outConfigs.lightDirX);
+    if (tok.ReadKey("Light_color:", fl[0], fl[1], fl[2], fl[3]))
+        outConfigs.lightColor = { fl[0], fl[1], fl[2], fl[3] };
 
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Light_direction_z: %d",      &outConfigs.lightDirZ);
+    tok.ReadKey("Light_direction_x:",     outConfigs.lightDirX);
+    tok.ReadKey("Light_direction_z:",     outConfigs.lightDirZ);
+    tok.ReadKey("Light_min_brightness:",  outConfigs.lightMinBrightness);
+    tok.ReadKey("Light_max_brightness:",  outConfigs.lightMaxBrightness);
+    tok.ReadKey("Light_shadow_softness:", outConfigs.shadowSoftness);
 
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Light_min_brightness: %f",   &outConfigs.lightMinBrightness);
 
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Light_max_brightness: %f",   &outConfigs.lightMaxBrightness);
-
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Light_shadow_softness: %f",  &outConfigs.shadowSoftness);
+    // load geomipmapping params
+    tok.ReadKey("Geomipmapping_patch_size:", outConfigs.patchSize);
 
+    // (optional) block compression of generated maps: older setup files don't have it
+    if (!tok.IsEnd() && tok.ReadKey("Compress_generated_maps:", tempBool))
+        outConfigs.compressGeneratedMaps = (uint8)tempBool;
 
-    // load geomipmapping params
-    fgets(buf, bufsize, pFile);
-    sscanf(buf, "Geomipmapping_patch_size: %d", &outConfigs.patchSize);
+    if (!tok.IsEnd())
+        tok.ReadKeyStr("Path_save_compressed_maps:", outConfigs.pathSaveCompressedMaps, sizeof(outConfigs.pathSaveCompressedMaps));
 
-    // close the setup file
-    fclose(pFile);
+    // the setup file must contain all the params in the same order
+    if (tok.IsFailed())
+    {
+        sprintf(g_String, "terrain setup file is corrupted (some params are skipped): %s", filename);
+        LogErr(g_String);
+    }
 
     LogDbg("End: the terrain setup file is read in successfully!");
 
@@ -225,12 +371,31 @@ bool TerrainBase::LoadHeightMapFromBMP(const char* filename)
 
 // --------------------------------------------------------
 // Desc:   load a grayscale RAW height map
-//         (it contains num elements and raw height data)
+//         (it contains only 8-bit heights of a square map);
+//         the file is memory-mapped and its heights are used in place
+//         so there is neither parsing nor copying into a separate buffer
 // Args:   - filename: path to the file
 // --------------------------------------------------------
 bool TerrainBase::LoadHeightMapFromRAW(const char* filename)
 {
-    return heightMap_.LoadData(filename);
+    UnloadHeightMap();
+
+    if (!heightMapFile_.Open(filename))
+        return false;
+
+    // we expect a square map
+    const size_t numBytes  = heightMapFile_.GetSize();
+    const uint   dimension = (uint)sqrt((double)numBytes);
+
+    if ((size_t)dimension * dimension != numBytes)
+    {
+        sprintf(g_String, "RAW height map isn't square (%zu bytes): %s", numBytes, filename);
+        LogErr(g_String);
+        heightMapFile_.Close();
+        return false;
+    }
+
+    return heightMap_.Wrap(heightMapFile_.GetData(), dimension, dimension, 8);
 }
 
 // --------------------------------------------------------
@@ -345,6 +510,7 @@ bool TerrainBase::SaveHeightMap(const char* filename)
 void TerrainBase::UnloadHeightMap()
 {
     heightMap_.Unload();
+    heightMapFile_.Close();
 }
 
 // --------------------------------------------------------
@@ -381,7 +547,7 @@ bool TerrainBase::GenHeightFaultFormation(
         CAssert::True(numIterations > 0, "input number of iterations must be > 0");
 
         // unload previous height data if we has any
-        heightMap_.Unload();
+        UnloadHeightMap();
 
         // need it for truly random generation of heights
         if (trueRandom)
@@ -391,11 +557,17 @@ bool TerrainBase::GenHeightFaultFormation(
         heightMap_.Create(size, size, 8);
         tempBuf = new float[size * size]{ 0.0f };
 
-        for (int currIteration = 0; currIteration < numIterations; ++currIteration)
+        // pick the fault lines at first: the order of rand() calls is the same
+        // as of a sequential generation, so a seed still gives the same map
+        struct FaultLine
         {
-            // calculate the height range (lerp from maxDelta to minDelta) for this fault-pass
-            const float height = (float)(maxDelta - ((maxDelta - minDelta) * currIteration) / numIterations);
+            int x1, z1;
+            int dirX, dirZ;
+        };
+        cvector<FaultLine> faults(numIterations);
 
+        for (int currIteration = 0; currIteration < numIterations; ++currIteration)
+        {
             // pick two points at random from the entire height map
             const int randX1 = rand() % size;
             const int randZ1 = rand() % size;
@@ -409,24 +581,36 @@ bool TerrainBase::GenHeightFaultFormation(
                 randZ2 = rand() % size;
             }
 
-            // <dirX1, dirX2> is a vec going the same direction as the division line
-            const int dirX1 = randX2 - randX1;
-            const int dirZ1 = randZ2 - randZ1;
+            // <dirX, dirZ> is a vec going the same direction as the division line
+            FaultLine& fault = faults[currIteration];
+            fault.x1   = randX1;
+            fault.z1   = randZ1;
+            fault.dirX = randX2 - randX1;
+            fault.dirZ = randZ2 - randZ1;
+        }
+
+        for (int currIteration = 0; currIteration < numIterations; ++currIteration)
+        {
+            // calculate the height range (lerp from maxDelta to minDelta) for this fault-pass
+            const float      height = (float)(maxDelta - ((maxDelta - minDelta) * currIteration) / numIterations);
+            const FaultLine& fault  = faults[currIteration];
 
-            // set heights for one half
-            for (int z = 0; z < size; ++z)
+            // set heights for one half (rows are independent)
+            g_JobSystem.ParallelFor(size, GEN_ROWS_PER_JOB, [&](const index start, const index end)
             {
-                for (int x = 0; x < size; ++x)
+                for (index z = start; z < end; ++z)
                 {
-                    // <dirX2, dirZ2> is a vector from point <randX1, randZ1> to the curr point (in the loop)
-                    const int dirX2 = x - randX1;
-                    const int dirZ2 = z - randZ1;
-
-                    // if the result of (dirX2*dirZ1 - dirX1*dirZ2) is "up" (above 0), then raise this point by height
-                    if ((dirX2 * dirZ1 - dirX1 * dirZ2) > 0)
-                        tempBuf[(z * size) + x] += height;
+                    RaiseRowByFault(
+                        tempBuf + (z * size),
+                        size,
+                        (int)z,
+                        fault.x1,
+                        fault.z1,
+                        fault.dirX,
+                        fault.dirZ,
+                        height);
                 }
-            }
+            });
 
             // erode terrain
             FilterHeightField(tempBuf, filter);
@@ -436,11 +620,7 @@ bool TerrainBase::GenHeightFaultFormation(
         NormalizeTerrain(tempBuf, size);
 
         // transfer the terrain into our class's uint8_t height buffer
-        for (int z = 0; z < size; ++z)
-        {
-            for (int x = 0; x < size; ++x)
-                SetHeightAtPoint((uint8)tempBuf[(z * size) + x], x, z);
-        }
+        TransferHeights(tempBuf, size);
 
         // delete temp buffer
         SafeDeleteArr(tempBuf);
@@ -455,7 +635,7 @@ bool TerrainBase::GenHeightFaultFormation(
     }
     catch (EngineException& e)
     {
-        heightMap_.Unload();
+        UnloadHeightMap();
         SafeDeleteArr(tempBuf);
 
         LogErr(e);
@@ -493,7 +673,7 @@ bool TerrainBase::GenHeightMidpointDisplacement(const int size, float roughness,
         CAssert::True(IsPow2(size), "input size must be a power of 2");
 
         // unload previous height data if we has any
-        heightMap_.Unload();
+        UnloadHeightMap();
 
         if (roughness < 0)
             roughness *= -1;
@@ -509,6 +689,9 @@ bool TerrainBase::GenHeightMidpointDisplacement(const int size, float roughness,
         heightMap_.Create(size, size, 8);
         tempBuf = new float[size*size]{0.0f};
 
+        // random offsets of a displacement stage
+        cvector<float> offsets;
+
         // being the displacement process
         while (rectSize > 0)
         {
@@ -517,6 +700,19 @@ bool TerrainBase::GenHeightMidpointDisplacement(const int size, float roughness,
             const float maxHeight = +height * 0.5f;
 
             const int halfRectSize = rectSize >> 1;
+            const int numRects     = size / rectSize;   // by each axis
+
+            // the random offsets are taken in the same order as by a sequential
+            // generation (so a seed still gives the same map) and then rectangles
+            // are computed in parallel: each step writes only points which aren't
+            // read by the same step; when the rectangle is a single texel
+            // (halfRectSize == 0) the points overlap so this stage is sequential
+            const index rectsPerJob = (halfRectSize > 0) ? GEN_ROWS_PER_JOB : numRects;
+
+            offsets.resize(2 * numRects * numRects);
+
+            for (int k = 0; k < numRects * numRects; ++k)
+                offsets[k] = MathHelper::RandF(minHeight, maxHeight);
 
             /* Diamond step -
 
@@ -538,27 +734,32 @@ bool TerrainBase::GenHeightMidpointDisplacement(const int size, float roughness,
             d = (ni,nj)
             e = (mi,mj)  */
 
-            for (int i = 0; i < size; i += rectSize)
+            g_JobSystem.ParallelFor(numRects, rectsPerJob, [&](const index start, const index end)
             {
-                const int ni = (i+rectSize) & (size-1);       // (i + rectSize) % size
-                const int mi = i + halfRectSize;
-
-                for (int j = 0; j < size; j += rectSize)
+                for (int ri = (int)start; ri < (int)end; ++ri)
                 {
-                    const int nj  = (j+rectSize) & (size-1);  // (j+rectSize) % size
-                    const int mj  = j + halfRectSize;
-                    const int idx = mi + (mj*size);
-
-                    tempBuf[idx] =
-                        tempBuf[i  + (j*size)]  +
-                        tempBuf[ni + (j*size)]  +
-                        tempBuf[i  + (nj*size)] +
-                        tempBuf[ni + (nj*size)];
-
-                    tempBuf[idx] *= 0.25f;
-                    tempBuf[idx] += MathHelper::RandF(minHeight, maxHeight);
+                    const int i  = ri * rectSize;
+                    const int ni = (i+rectSize) & (size-1);       // (i + rectSize) % size
+                    const int mi = i + halfRectSize;
+
+                    for (int rj = 0; rj < numRects; ++rj)
+                    {
+                        const int j   = rj * rectSize;
+                        const int nj  = (j+rectSize) & (size-1);  // (j+rectSize) % size
+                        const int mj  = j + halfRectSize;
+                        const int idx = mi + (mj*size);
+
+                        tempBuf[idx] =
+                            tempBuf[i  + (j*size)]  +
+                            tempBuf[ni + (j*size)]  +
+                            tempBuf[i  + (nj*size)] +
+                            tempBuf[ni + (nj*size)];
+
+                        tempBuf[idx] *= 0.25f;
+                        tempBuf[idx] += offsets[(ri * numRects) + rj];
+                    }
                 }
-            }
+            });
 
             /* Square step -
 
@@ -597,43 +798,54 @@ bool TerrainBase::GenHeightMidpointDisplacement(const int size, float roughness,
                 f = (mi,mj)
                 g = (mi,j)
                 h = (i,mj)  */
-            for (int i = 0; i < size; i += rectSize)
-            {
-                const int ni  = (i+rectSize) & (size-1);                 // (i+rectSize) % size
-                const int mi  = (i+halfRectSize);
-                const int pmi = (i-halfRectSize+size) & (size-1);        // (i-halfRectSize+size) % size
-
-                for (int j = 0; j < size; j += rectSize)
-                {
-                    const int nj  = (j+rectSize) & (size-1);             // (j + rectSize) % size
-                    const int mj  = (j+halfRectSize);
-                    const int pmj = (j-halfRectSize+size) & (size-1);    // (j-halfRectSize + size) % size
-
-                    // calculate the square value for the top side of the rectangle
-                    const int idx1 = mi + (j*size);
-
-                    tempBuf[idx1] =
-                        tempBuf[i  + (j*size)]    +
-                        tempBuf[ni + (j*size)]    +
-                        tempBuf[mi + (pmj*size)]  +
-                        tempBuf[mi + (mj*size)];
-
-                    tempBuf[idx1] *= 0.25f;
-                    tempBuf[idx1] += MathHelper::RandF(minHeight, maxHeight);
 
-                    // calculate the square value for the left side of the rectangle
-                    const int idx2 = i + (mj*size);
+            // two offsets per rectangle (top side, left side)
+            for (int k = 0; k < 2 * numRects * numRects; ++k)
+                offsets[k] = MathHelper::RandF(minHeight, maxHeight);
 
-                    tempBuf[idx2] =
-                        tempBuf[i   + (j*size)]   +
-                        tempBuf[i   + (nj*size)]  +
-                        tempBuf[pmi + (mj*size)]  +
-                        tempBuf[mi  + (mj*size)];
-
-                    tempBuf[idx2] *= 0.25f;
-                    tempBuf[idx2] += MathHelper::RandF(minHeight, maxHeight);
+            g_JobSystem.ParallelFor(numRects, rectsPerJob, [&](const index start, const index end)
+            {
+                for (int ri = (int)start; ri < (int)end; ++ri)
+                {
+                    const int i   = ri * rectSize;
+                    const int ni  = (i+rectSize) & (size-1);                 // (i+rectSize) % size
+                    const int mi  = (i+halfRectSize);
+                    const int pmi = (i-halfRectSize+size) & (size-1);        // (i-halfRectSize+size) % size
+
+                    for (int rj = 0; rj < numRects; ++rj)
+                    {
+                        const int j   = rj * rectSize;
+                        const int nj  = (j+rectSize) & (size-1);             // (j + rectSize) % size
+                        const int mj  = (j+halfRectSize);
+                        const int pmj = (j-halfRectSize+size) & (size-1);    // (j-halfRectSize + size) % size
+                        const int k   = 2 * ((ri * numRects) + rj);
+
+                        // calculate the square value for the top side of the rectangle
+                        const int idx1 = mi + (j*size);
+
+                        tempBuf[idx1] =
+                            tempBuf[i  + (j*size)]    +
+                            tempBuf[ni + (j*size)]    +
+                            tempBuf[mi + (pmj*size)]  +
+                            tempBuf[mi + (mj*size)];
+
+                        tempBuf[idx1] *= 0.25f;
+                        tempBuf[idx1] += offsets[k];
+
+                        // calculate the square value for the left side of the rectangle
+                        const int idx2 = i + (mj*size);
+
+                        tempBuf[idx2] =
+                            tempBuf[i   + (j*size)]   +
+                            tempBuf[i   + (nj*size)]  +
+                            tempBuf[pmi + (mj*size)]  +
+                            tempBuf[mi  + (mj*size)];
+
+                        tempBuf[idx2] *= 0.25f;
+                        tempBuf[idx2] += offsets[k + 1];
+                    }
                 }
-            }
+            });
 
             // reduce the rectangle size by two to prepare for the next displacement stage
             rectSize /= 2;
@@ -646,11 +858,7 @@ bool TerrainBase::GenHeightMidpointDisplacement(const int size, float roughness,
         NormalizeTerrain(tempBuf, size);
 
         // transfer the terrain into our class's uint_8 height buffer
-        for (int z = 0; z < size; ++z)
-        {
-            for (int x = 0; x < size; ++x)
-                SetHeightAtPoint((uint8_t)tempBuf[(z*size) + x], x, z);
-        }
+        TransferHeights(tempBuf, size);
 
         // delete temp buffer
         SafeDeleteArr(tempBuf);
@@ -665,7 +873,7 @@ bool TerrainBase::GenHeightMidpointDisplacement(const int size, float roughness,
     }
     catch (EngineException& e)
     {
-        heightMap_.Unload();
+        UnloadHeightMap();
         SafeDeleteArr(tempBuf);
         LogErr(e);
         return false;
@@ -678,34 +886,32 @@ bool TerrainBase::GenHeightMidpointDisplacement(const int size, float roughness,
 // =================================================================================
 
 // ----------------------------------------------------
-// Desc:   generate a texture map from four tiles (that
-//         must be loaded before this function is called)
-// Args:   - size: the size of the texture map to be generated
+// Desc:   compute height regions of the loaded tiles and blending percentages
+//         of each tile by the height (they are the same for any texel so the
+//         texture map and pages of the virtual texture are blended by them)
+// Args:   - outLoadedTilesIdxs: idxs of the loaded tiles (the first numTiles)
+//         - outBlendFactors:    [loaded tile][height] => blending percentage
+// Ret:    the number of loaded tiles
 // ----------------------------------------------------
-bool TerrainBase::GenerateTextureMap(const uint texMapSize)
+int TerrainBase::ComputeTileBlendFactors(
+    int outLoadedTilesIdxs[TRN_NUM_TILES],
+    float outBlendFactors[TRN_NUM_TILES][256])
 {
-    // check input params
-    if (texMapSize <= 0)
-    {
-        LogErr("can't generate texture map: input size for texture map must be > 0");
-        return false;
-    }
-
-    LogDbg("wait while texture map is generated");
-
     // find out the number and indices of tiles that we have
     int numTiles = 0;
-    int loadedTilesIdxs[TRN_NUM_TILES]{ 0 };
 
     for (int i = 0; i < TRN_NUM_TILES; ++i)
     {
         // if the curr tile is loaded, then we add one to the total tile count
-        loadedTilesIdxs[numTiles] = i;
+        outLoadedTilesIdxs[numTiles] = i;
         numTiles += tiles_.textureTiles[i].IsLoaded();
     }
 
     tiles_.numTiles = numTiles;
 
+    if (numTiles == 0)
+        return 0;
+
     /*
         [idx] - index of the tile
         L     - lowest height
@@ -727,7 +933,7 @@ bool TerrainBase::GenerateTextureMap(const uint texMapSize)
     for (int i = 0; i < numTiles; ++i)
     {
         // we only want to perform these calculations if we actually have a tile loaded
-        const int tileIdx = loadedTilesIdxs[i];
+        const int tileIdx = outLoadedTilesIdxs[i];
         TerrainTextureRegions& reg = tiles_.regions[tileIdx];
 
         // calculate the three height boundaries (low, optimal, high)
@@ -738,6 +944,56 @@ bool TerrainBase::GenerateTextureMap(const uint texMapSize)
         reg.highHeight    = (lastHeight - reg.lowHeight) + lastHeight;
     }
 
+    const int lowestTileOptimalHeight = tiles_.regions[LOWEST_TILE].optimalHeight;
+
+    // the blending percentage depends only on the tile and the height (0-255)
+    // so it is computed once per height instead of once per texel;
+    // 0 means that the height doesn't belong to the tile's region
+    for (int i = 0; i < numTiles; ++i)
+    {
+        const int                    tileIdx = outLoadedTilesIdxs[i];
+        const TerrainTextureRegions& region  = tiles_.regions[tileIdx];
+
+        for (int height = 0; height < 256; ++height)
+        {
+            // if current height doesn't belong to the current region
+            if ((height < region.lowHeight) || (height > region.highHeight))
+                continue;
+
+            // if the height is lower than the lowest tile's height, then we want full brightness,
+            // if we don't do this, the area will get darkened, and no texture will get shown
+            if ((tileIdx == LOWEST_TILE) && (height < lowestTileOptimalHeight))
+                outBlendFactors[i][height] = 1.0f;
+
+            // get the blending percentage for this tile
+            else
+                outBlendFactors[i][height] = RegionPercent(tileIdx, height);
+        }
+    }
+
+    return numTiles;
+}
+
+// ----------------------------------------------------
+// Desc:   generate a texture map from four tiles (that
+//         must be loaded before this function is called)
+// Args:   - size: the size of the texture map to be generated
+// ----------------------------------------------------
+bool TerrainBase::GenerateTextureMap(const uint texMapSize)
+{
+    // check input params
+    if (texMapSize <= 0)
+    {
+        LogErr("can't generate texture map: input size for texture map must be > 0");
+        return false;
+    }
+
+    LogDbg("wait while texture map is generated");
+
+    int   loadedTilesIdxs[TRN_NUM_TILES]{ 0 };
+    float blendFactors[TRN_NUM_TILES][256]{ 0.0f };
+    const int numTiles = ComputeTileBlendFactors(loadedTilesIdxs, blendFactors);
+
     // create room for a new texture
     constexpr uint bpp = 24;
     texture_.Create(texMapSize, texMapSize, bpp);
@@ -745,70 +1001,60 @@ bool TerrainBase::GenerateTextureMap(const uint texMapSize)
     // get the height map to texture map ratio (since, the most of the time,
     // the texture map will be a higher resolution that the height map, so we
     // need the ration of height map pixels to texture map pixels)
-    const float heightMapSize         = (float)heightMap_.GetWidth();
-    const float mapRatio              = heightMapSize / texMapSize;    // for instance: 128 / 256
+    const float heightMapSize = (float)heightMap_.GetWidth();
+    const float mapRatio      = heightMapSize / texMapSize;    // for instance: 128 / 256
+    const int   iTexMapSize   = (int)texMapSize;
 
-    const int iTexMapSize             = (int)texMapSize;
-    const int lowestTileOptimalHeight = tiles_.regions[LOWEST_TILE].optimalHeight;
-        
-    // create the texture data
-    for (int z = 0; z < iTexMapSize; ++z)
+    // create the texture data (rows of texels are independent)
+    g_JobSystem.ParallelFor(iTexMapSize, GEN_ROWS_PER_JOB, [&](const index start, const index end)
     {
-        for (int x = 0; x < iTexMapSize; ++x)
+        for (int z = (int)start; z < (int)end; ++z)
         {
-            // set our total color counters to 0.0f
-            float totalRed   = 0.0f;
-            float totalGreen = 0.0f;
-            float totalBlue  = 0.0f;
-
-            // compute interpolated height
-            const int height = (int)InterpolateHeight(x, z, mapRatio, heightMapSize);
-
-
-            // loop through the loaded tiles
-            for (int i = 0; i < numTiles; ++i)
+            for (int x = 0; x < iTexMapSize; ++x)
             {
-                const int tileIdx                  = loadedTilesIdxs[i];
-                const TerrainTextureRegions region = tiles_.regions[tileIdx];
+                // set our total color counters to 0.0f
+                float totalRed   = 0.0f;
+                float totalGreen = 0.0f;
+                float totalBlue  = 0.0f;
 
-                // if current height doesn't belong to the current region
-                if ((height < region.lowHeight) || (height > region.highHeight))
-                    continue;
+                // compute interpolated height
+                const int height = MathHelper::Clamp(InterpolateHeight(x, z, mapRatio, heightMapSize), 0, 255);
 
-                const Image& tile = tiles_.textureTiles[tileIdx];
-                float blendFactor = 0.0f;
+                // loop through the loaded tiles
+                for (int i = 0; i < numTiles; ++i)
+                {
+                    const float blendFactor = blendFactors[i][height];
 
-                uint texX = x;
-                uint texZ = z;
+                    if (blendFactor == 0.0f)
+                        continue;
 
-                // get texture coordinates
-                GetTexCoords(tile, texX, texZ);
+                    const Image& tile = tiles_.textureTiles[loadedTilesIdxs[i]];
 
-                // get the curr color in the texture at the coordinates that we got in GetTexCoords
-                uint8 red, green, blue;
-                tile.GetColor(texX, texZ, red, green, blue);
+                    uint texX = x;
+                    uint texZ = z;
 
-                // if the height is lower than the lowest tile's height, then we want full brightness,
-               // if we don't do this, the area will get darkened, and no texture will get shown
-                if ((tileIdx == LOWEST_TILE) && (height < lowestTileOptimalHeight))
-                    blendFactor = 1.0f;
+                    // get texture coordinates
+                    GetTexCoords(tile, texX, texZ);
 
-                // get the curr coordinate's blending percentage for this tile
-                else
-                    blendFactor = RegionPercent(tileIdx, height);
+                    // get the curr color in the texture at the coordinates that we got in GetTexCoords
+                    uint8 red, green, blue;
+                    tile.GetColor(texX, texZ, red, green, blue);
 
-                // calculate the RGB values that will be used
-                totalRed   += (red   * blendFactor);
-                totalGreen += (green * blendFactor);
-                totalBlue  += (blue  * blendFactor);
+                    // calculate the RGB values that will be used
+                    totalRed   += (red   * blendFactor);
+                    totalGreen += (green * blendFactor);
+                    totalBlue  += (blue  * blendFactor);
+                }
 
-            }
+                // set our terrain's texture color to the one that we previously calculated
+                texture_.SetColor(x, z, (uint8)totalRed, (uint8)totalGreen, (uint8)totalBlue);
 
-            // set our terrain's texture color to the one that we previously calculated
-            texture_.SetColor(x, z, (uint8)totalRed, (uint8)totalGreen, (uint8)totalBlue);
+            } // for by X
+        } // for by Z
+    });
 
-        } // for by X
-    } // for by Z
+    // pages of the virtual texture are baked from the new map params
+    texMapVersion_++;
 
     LogMsg("texture map is generated successfully");
     return true;
@@ -981,21 +1227,72 @@ void TerrainBase::FilterHeightField(float* heightData, const float filter)
 {
     const int size = heightMap_.GetWidth();
 
-    // erode left to right
-    for (int i = 0; i < size; ++i)
-        FilterHeightBand(&heightData[size*i], 1, size, filter);
+    // erode left to right and right to left (rows are independent)
+    g_JobSystem.ParallelFor(size, GEN_ROWS_PER_JOB, [&](const index start, const index end)
+    {
+        for (index i = start; i < end; ++i)
+        {
+            FilterHeightBand(&heightData[size*i], 1, size, filter);
+            FilterHeightBand(&heightData[size*i + size-1], -1, size, filter);
+        }
+    });
+
+    // erode top to bottom and bottom to top (columns are independent)
+    g_JobSystem.ParallelFor(size, GEN_COLS_PER_JOB, [&](const index start, const index end)
+    {
+        FilterHeightColumns(heightData, size, (int)start, (int)end, filter);
+    });
+}
+
+// --------------------------------------------------------
+// Desc:  apply the erosion filter to a range of columns: top to bottom
+//        and then bottom to top; 4 adjacent columns are filtered at once
+//        (the result is the same as of FilterHeightBand for each column)
+// Args:  - heightData: the height values to be filtered
+//        - size:       the size of the height field
+//        - x0, x1:     the range of columns [x0, x1)
+//        - filter:     the filter strength
+// --------------------------------------------------------
+void TerrainBase::FilterHeightColumns(
+    float* heightData,
+    const int size,
+    const int x0,
+    const int x1,
+    const float filter)
+{
+    int x = x0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+    const __m128 f    = _mm_set1_ps(filter);
+    const __m128 invF = _mm_set1_ps(1 - filter);
+
+    for (; x + 4 <= x1; x += 4)
+    {
+        // top to bottom
+        __m128 v = _mm_loadu_ps(heightData + x);
 
-    // erode right to left
-    for (int i = 0; i < size; ++i)
-        FilterHeightBand(&heightData[size*i + size-1], -1, size, filter);
+        for (int z = 1; z < size; ++z)
+        {
+            float* p = heightData + (z*size) + x;
+            v = _mm_add_ps(_mm_mul_ps(f, v), _mm_mul_ps(invF, _mm_loadu_ps(p)));
+            _mm_storeu_ps(p, v);
+        }
 
-    // erode top to bottom
-    for (int i = 0; i < size; ++i)
-        FilterHeightBand(&heightData[i], size, size, filter);
+        // bottom to top
+        for (int z = size-2; z >= 0; --z)
+        {
+            float* p = heightData + (z*size) + x;
+            v = _mm_add_ps(_mm_mul_ps(f, v), _mm_mul_ps(invF, _mm_loadu_ps(p)));
+            _mm_storeu_ps(p, v);
+        }
+    }
+#endif
 
-    // erode from bottom to top
-    for (int i = 0; i < size; ++i)
-        FilterHeightBand(&heightData[size*(size-1)+i], -size, size, filter);
+    for (; x < x1; ++x)
+    {
+        FilterHeightBand(&heightData[x], size, size, filter);
+        FilterHeightBand(&heightData[size*(size-1) + x], -size, size, filter);
+    }
 }
 
 // --------------------------------------------------------
@@ -1005,16 +1302,61 @@ void TerrainBase::FilterHeightField(float* heightData, const float filter)
 // --------------------------------------------------------
 void TerrainBase::NormalizeTerrain(float* heightData, const int size)
 {
-    float min = heightData[0];
-    float max = heightData[0];
+    const index numValues    = (index)size * size;
+    const index valuesPerJob = GEN_ROWS_PER_JOB * size;
+    const index numJobs      = (numValues + valuesPerJob - 1) / valuesPerJob;
+
+    // min/max of each job
+    cvector<float> mins(numJobs, heightData[0]);
+    cvector<float> maxs(numJobs, heightData[0]);
 
     // find the min/max values of the input height buffer
-    for (int i = 1; i < size*size; ++i)
+    g_JobSystem.ParallelFor(numValues, valuesPerJob, [&](const index start, const index end)
+    {
+        index i   = start;
+        float min = heightData[start];
+        float max = heightData[start];
+
+#if defined(_XM_SSE_INTRINSICS_)
+        __m128 vMin = _mm_set1_ps(min);
+        __m128 vMax = _mm_set1_ps(max);
+
+        for (; i + 4 <= end; i += 4)
+        {
+            const __m128 h = _mm_loadu_ps(heightData + i);
+            vMin = _mm_min_ps(vMin, h);
+            vMax = _mm_max_ps(vMax, h);
+        }
+
+        float lanesMin[4];
+        float lanesMax[4];
+        _mm_storeu_ps(lanesMin, vMin);
+        _mm_storeu_ps(lanesMax, vMax);
+
+        for (int k = 0; k < 4; ++k)
+        {
+            min = std::min(min, lanesMin[k]);
+            max = std::max(max, lanesMax[k]);
+        }
+#endif
+
+        for (; i < end; ++i)
+        {
+            min = std::min(min, heightData[i]);
+            max = std::max(max, heightData[i]);
+        }
+
+        mins[start / valuesPerJob] = min;
+        maxs[start / valuesPerJob] = max;
+    });
+
+    float min = mins[0];
+    float max = maxs[0];
+
+    for (index i = 1; i < numJobs; ++i)
     {
-        if (heightData[i] > max)
-            max = heightData[i];
-        else if (heightData[i] < min)
-            min = heightData[i];
+        min = std::min(min, mins[i]);
+        max = std::max(max, maxs[i]);
     }
 
     // find the range of the altitude
@@ -1024,8 +1366,41 @@ void TerrainBase::NormalizeTerrain(float* heightData, const int size)
     const float invHeight = 255.0f / (max - min);
 
     // scale the values to a range of 0-255
-    for (int i = 0; i < size*size; ++i)
-        heightData[i] = (heightData[i] - min) * invHeight;
+    g_JobSystem.ParallelFor(numValues, valuesPerJob, [&](const index start, const index end)
+    {
+        index i = start;
+
+#if defined(_XM_SSE_INTRINSICS_)
+        const __m128 vMin = _mm_set1_ps(min);
+        const __m128 vInv = _mm_set1_ps(invHeight);
+
+        for (; i + 4 <= end; i += 4)
+        {
+            const __m128 h = _mm_loadu_ps(heightData + i);
+            _mm_storeu_ps(heightData + i, _mm_mul_ps(_mm_sub_ps(h, vMin), vInv));
+        }
+#endif
+
+        for (; i < end; ++i)
+            heightData[i] = (heightData[i] - min) * invHeight;
+    });
+}
+
+// --------------------------------------------------------
+// Desc:  transfer normalized (0-255) heights into the 8-bit height map
+// Args:  - heightData: the height data buffer
+//        - size:       the size of the height map
+// --------------------------------------------------------
+void TerrainBase::TransferHeights(const float* heightData, const int size)
+{
+    g_JobSystem.ParallelFor(size, GEN_ROWS_PER_JOB, [&](const index start, const index end)
+    {
+        for (int z = (int)start; z < (int)end; ++z)
+        {
+            for (int x = 0; x < size; ++x)
+                SetHeightAtPoint((uint8)heightData[(z * size) + x], x, z);
+        }
+    });
 }
 
 // --------------------------------------------------------
@@ -1055,8 +1430,7 @@ bool TerrainBase::LoadLightMap(const char* filename)
         lightmap_.size = (int)sqrtf((float)fileSize);
 
         // great success!
-        sprintf(g_String, "Loaded light map: %s", filename);
-        LogMsg(g_String);
+        LogMsgf("Loaded light map: %s", filename);
         return true;
     }
     catch (const std::bad_alloc& e)
@@ -1143,14 +1517,17 @@ uint8 TerrainBase::CalculateLightingAtPoint(const int x, const int z)
 // --------------------------------------------------------
 void TerrainBase::CalculateLightingHeightBased(const int size)
 {
-    // loop through all vertices
-    for (int z = 0; z < size; ++z)
+    // loop through all vertices (rows are independent)
+    g_JobSystem.ParallelFor(size, GEN_ROWS_PER_JOB, [&](const index start, const index end)
     {
-        for (int x = 0; x < size; ++x)
+        for (int z = (int)start; z < (int)end; ++z)
         {
-            SetBrightnessAtPoint(x, z, GetTrueHeightAtPoint(x, z));
+            for (int x = 0; x < size; ++x)
+            {
+                SetBrightnessAtPoint(x, z, GetTrueHeightAtPoint(x, z));
+            }
         }
-    }
+    });
 }
 
 // --------------------------------------------------------
@@ -1170,35 +1547,39 @@ void TerrainBase::CalculateLightingSlope(
     const float maxBrightness,
     const float softness)
 {
-    float shade = 0.0f;
     const float invLightSoftness = 1.0f / softness;
 
-
-    // loop through all vertices
-    for (int z = 0; z < size; ++z)
+    // loop through all vertices (the lightmap is written only by the heights
+    // so rows are independent)
+    g_JobSystem.ParallelFor(size, GEN_ROWS_PER_JOB, [&](const index start, const index end)
     {
-        for (int x = 0; x < size; ++x)
+        for (int z = (int)start; z < (int)end; ++z)
         {
-            // ensure that we won't be stepping over array boundaries by doing this
-            if (z >= dirZ && x >= dirX)
+            for (int x = 0; x < size; ++x)
             {
-                shade = 1.0f - (GetTrueHeightAtPoint(x-dirX, z-dirZ) -
-                                GetTrueHeightAtPoint(x, z)) * invLightSoftness;
-            }
+                float shade = 0.0f;
 
-            // if we are, then just return a very bright color value (white)
-            else
-                shade = 1.0f;
+                // ensure that we won't be stepping over array boundaries by doing this
+                if (z >= dirZ && x >= dirX)
+                {
+                    shade = 1.0f - (GetTrueHeightAtPoint(x-dirX, z-dirZ) -
+                                    GetTrueHeightAtPoint(x, z)) * invLightSoftness;
+                }
 
-            // clamp the shading value to the min/max brightness boundaries
-            if (shade < minBrightness)
-                shade = minBrightness;
-            if (shade > maxBrightness)
-                shade = maxBrightness;
+                // if we are, then just return a very bright color value (white)
+                else
+                    shade = 1.0f;
 
-            SetBrightnessAtPoint(x, z, (uint)(shade * 255));
+                // clamp the shading value to the min/max brightness boundaries
+                if (shade < minBrightness)
+                    shade = minBrightness;
+                if (shade > maxBrightness)
+                    shade = maxBrightness;
+
+                SetBrightnessAtPoint(x, z, (uint)(shade * 255));
+            }
         }
-    }
+    });
 }
 
 // --------------------------------------------------------
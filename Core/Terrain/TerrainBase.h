@@ -17,6 +17,7 @@
 // =================================================================================
 #pragma once
 #include "../Texture/Image.h"
+#include <MappedFile.h>
 #include <d3d11.h>
 
 namespace Core
@@ -64,6 +65,7 @@ struct TerrainConfig
     char    pathSaveHeightMap[64]{ '\0' };
     char    pathSaveTextureMap[64]{ '\0' };
     char    pathSaveLightMap[64]{ '\0' };
+    char    pathSaveCompressedMaps[64]{ '\0' };  // a dir for .dds of compressed generated maps (empty - aren't saved)
 
     int     depth       = 256;                  // terrain length by Z-axis
     int     width       = 256;                  // terrain length by X-axis
@@ -75,6 +77,7 @@ struct TerrainConfig
     uint8   generateLightMap            :1 = 1;
     uint8   useGenFaultFormation        :1 = 1;   // what kind of heights generator will we use?
     uint8   useGenMidpointDisplacement  :1 = 0;
+    uint8   compressGeneratedMaps       :1 = 0;   // are generated texture/light maps block compressed on upload (they can't be painted then)?
 
     // params related to the "Fault formation" algorithm of heights generation
     int     numIterations   = 64;      
@@ -112,6 +115,28 @@ struct LightmapData
 
 ///////////////////////////////////////////////////////////
 
+struct TerrainDirtyRect
+{
+    // a changed rectangle [x0, x1) x [z0, z1) of a map (in texels)
+    int x0 = INT_MAX;
+    int z0 = INT_MAX;
+    int x1 = 0;
+    int z1 = 0;
+
+    inline bool IsEmpty() const { return (x0 >= x1) || (z0 >= z1); }
+    inline void Reset()         { x0 = z0 = INT_MAX; x1 = z1 = 0; }
+
+    inline void Add(const int ax0, const int az0, const int ax1, const int az1)
+    {
+        x0 = std::min(x0, ax0);
+        z0 = std::min(z0, az0);
+        x1 = std::max(x1, ax1);
+        z1 = std::max(z1, az1);
+    }
+};
+
+///////////////////////////////////////////////////////////
+
 struct TerrainTextureRegions
 {   //    0%         optimalHeight        0%
     //    |               |               |
@@ -137,7 +162,8 @@ struct TerrainTextureTiles
 
 struct CameraParams
 {
-    // 6 frustum planes (4 value per normalized plane: normal_vec(float3) + d(float))
+    // 6 world-space frustum planes (4 value per normalized plane: normal_vec(float3) + d(float));
+    // normals look inside
     float planes[6][4];
 
     // position in world
@@ -158,6 +184,10 @@ struct CameraParams
     float fovY        = 0;
     float nearZ       = 0;
     float farZ        = 0;
+
+    // screen params for the screen-space error of terrain LODs
+    float screenHeight  = 0;        // in pixels
+    float maxPixelError = 1;        // max allowed error of a patch (in pixels)
 };
 
 
@@ -191,6 +221,10 @@ public:
     
     // texture map generation methods
     bool  GenerateTextureMap(const uint size);
+
+    int   ComputeTileBlendFactors(
+        int outLoadedTilesIdxs[TRN_NUM_TILES],
+        float outBlendFactors[TRN_NUM_TILES][256]);
     
     float RegionPercent     (const int tileType, const int height);
     void  GetTexCoords      (const Image& tex, uint& inOutX, uint& inOutY);
@@ -260,6 +294,11 @@ public:
         return height12 + tz * (height34-height12);
     }
 
+    // compute bilinearly interpolated scaled heights at many points at once
+    // (4 points per SSE step; the points are clamped by the height map),
+    // is used to snap a lot of entities to the ground
+    void SampleHeights(const DirectX::XMFLOAT2* xz, const size n, float* outY) const;
+
     // ----------------------------------------------------
 
     inline int   GetDepth()       const { return terrainDepth_; }
@@ -348,6 +387,20 @@ public:
     inline void SetBrightnessAtPoint(const int x, const int z, const uint8 brightness)
     {   lightmap_.pData[(z*lightmap_.size) + x] = brightness;   }
 
+    //--------------------------------------------------------------
+    // Desc:   mark a rectangle [x0,x1) x [z0,z1) of a map as changed (e.g. by
+    //         editing) so only this region is uploaded to GPU by
+    //         TerrainGeomipmapped::UpdateDirtyRegions()
+    //--------------------------------------------------------------
+    inline void MarkHeightMapDirty(const int x0, const int z0, const int x1, const int z1)
+    {   heightMapDirty_.Add(x0, z0, x1, z1);   }
+
+    inline void MarkTextureMapDirty(const int x0, const int z0, const int x1, const int z1)
+    {   textureMapDirty_.Add(x0, z0, x1, z1);   }
+
+    inline void MarkLightMapDirty(const int x0, const int z0, const int x1, const int z1)
+    {   lightMapDirty_.Add(x0, z0, x1, z1);   }
+
     //--------------------------------------------------------------
     // Desc:   set the color of the terrain's lighting system
     // Args:   - vecColor: the color of the light
@@ -384,7 +437,9 @@ private:
     // terrain heights erosion/bluring/normalization methods
     void FilterHeightBand (float* band, const int stride, const int count, const float filter);
     void FilterHeightField(float* heightData, const float filter);
+    void FilterHeightColumns(float* heightData, const int size, const int x0, const int x1, const float filter);
     void NormalizeTerrain (float* heightData, const int size);
+    void TransferHeights  (const float* heightData, const int size);
 
 public:
     //int                 heightMapSize_ = 0;             // must be power of two
@@ -396,10 +451,12 @@ public:
     TerrainTextureTiles tiles_;
     Image               texture_;                 // diffuse texture
     Image               heightMap_;
+    MappedFile          heightMapFile_;           // a RAW height map is used right from the mapped file
     Image               detailMap_;
     bool                textureMapped_ = false;
     bool                multitextured_ = false;
     bool                detailMapped_ = false;
+    uint32              texMapVersion_ = 0;       // is changed each time the texture map is (re)generated
 
     // lighting info
     eLightingTypes      lightingType_ = HEIGHT_BASED;
@@ -411,6 +468,11 @@ public:
     int                 directionX_ = 0;
     int                 directionZ_ = 0;
 
+    // changed regions of maps which aren't uploaded to GPU yet
+    TerrainDirtyRect    heightMapDirty_;
+    TerrainDirtyRect    textureMapDirty_;
+    TerrainDirtyRect    lightMapDirty_;
+
     // stat variables
     int vertsPerFrame_ = 0;
     int trisPerFrame_ = 0;
@@ -9,16 +9,14 @@
 #include <CoreCommon/Frustum.h>
 #include "TerrainGeomipmapped.h"
 #include "../Mesh/MaterialMgr.h"
+#include "../Texture/TextureMgr.h"
 
 #include <DirectXMath.h>
 #include <DirectXCollision.h>
+#include <JobSystem.h>
 
 using namespace DirectX;
 
-#define COMPUTE_NORMALS                 1
-#define COMPUTE_AVERAGED_MID_NORMALS    1
-#define COMPUTE_AVERAGED_CENTER_NORMALS 1
-
 //---------------------------------------
 // Desc:   helpers to get a square of input value
 //---------------------------------------
@@ -53,6 +51,11 @@ void TerrainGeomipmapped::Shutdown()
     // release memory from the vertex buffer and index buffer
     vb_.Shutdown();
     ib_.Shutdown();
+    tessVB_.Shutdown();
+    gridVB_.Shutdown();
+    gridIB_.Shutdown();
+    patchStartsVB_.Shutdown();
+    patchMorphsVB_.Shutdown();
 }
 
 ///////////////////////////////////////////////////////////
@@ -85,7 +88,9 @@ void TerrainGeomipmapped::AllocateMemory(const int numVertices, const int numInd
 }
 
 //---------------------------------------------------------
-// Desc:   initiate the geomipmapping system
+// Desc:   initiate the geomipmapping system: the vertices and
+//         indices are computed only once here so per frame we
+//         only choose an index range for each visible patch
 // Args:   - patchSize:  the size of the patch (in vertices)
 //                       a good size is usually around 17 (17x17 verts)
 //---------------------------------------------------------
@@ -108,6 +113,9 @@ bool TerrainGeomipmapped::InitGeomipmapping(const int patchSize)
         if (patches_)
             Shutdown();
 
+        // the grid of vertices/indices is built from scratch
+        ClearMemory();
+
         // initiate the patch info
         patchSize_         = patchSize;
         numPatchesPerSide_ = terrainSize / patchSize;
@@ -135,7 +143,32 @@ bool TerrainGeomipmapped::InitGeomipmapping(const int patchSize)
             patches_[i].isVisible = false;
         }
 
-        LogMsg("Geomipmapping system successfully initialized");
+        // the static grid of vertices
+        gridVertsPerSide_ = numPatchesPerSide_ * (patchSize - 1) + 1;
+        numVertices_      = (uint32)(gridVertsPerSide_ * gridVertsPerSide_);
+        vertices_         = new Vertex3dTerrain[numVertices_]{};
+
+        patchMinY_.resize(numAllPatches);
+        patchMaxY_.resize(numAllPatches);
+        patchErrors_.resize(numAllPatches * (maxLOD_ + 1));
+
+        BuildGridVertices(0, 0, gridVertsPerSide_, gridVertsPerSide_);
+
+        cvector<UINT> indices;
+        BuildIndexVariants(gridVertsPerSide_, indices);
+
+        numIndices_ = (uint32)indices.size();
+        indices_    = new UINT[numIndices_];
+        memcpy(indices_, indices.data(), sizeof(UINT) * numIndices_);
+
+        ComputePatchBounds(0, 0, numPatchesPerSide_, numPatchesPerSide_);
+        ComputePatchErrors(0, 0, numPatchesPerSide_, numPatchesPerSide_);
+        BuildQuadtree();
+
+        visiblePatches_.clear();
+        visiblePatches_.reserve(numAllPatches);
+
+        LogMsgf("Geomipmapping system successfully initialized (vertices: %u, indices of all the LODs: %u)", numVertices_, numIndices_);
         return true;
     }
     catch (const std::bad_alloc& e)
@@ -144,6 +177,12 @@ bool TerrainGeomipmapped::InitGeomipmapping(const int patchSize)
         LogErr("can't allocate memory for geomipmapping patches");
         return false;
     }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't initialize the geomipmapping system");
+        return false;
+    }
 }
 
 ///////////////////////////////////////////////////////////
@@ -163,8 +202,13 @@ bool TerrainGeomipmapped::InitBuffers(
         CAssert::True(numVertices > 0,  "input number of vertices must be > 0");
         CAssert::True(numIndices > 0,   "input number of indices must be > 0");
 
-        constexpr bool isDynamic = true;
-        vb_.Initialize(pDevice, vertices, numVertices, isDynamic);
+        // the grid is static: per frame we only choose indices ranges;
+        // it is updatable since edited regions are uploaded by UpdateDirtyRegions()
+        cvector<Vertex3dTerrainPacked> packedVertices;
+        packedVertices.resize_uninitialized(numVertices);
+        PackVertices(vertices, packedVertices.data(), numVertices);
+
+        vb_.InitializeUpdatable(pDevice, packedVertices.data(), numVertices);
         ib_.Initialize(pDevice, indices, numIndices);
 
         return true;
@@ -176,162 +220,558 @@ bool TerrainGeomipmapped::InitBuffers(
     }
 }
 
-#define USE_DX_FRUSTUM false
-
 //---------------------------------------------------------
-// Desc:   test if we are currently in the patch by input coords
-// Args:   - camPosX, camPosZ: position of the camera by X-axis and Z-axis
-//         - cx, cz:           center of the patch by X-axis and Z-axis
-//         - halfSize:         half of the patch length
+// Desc:   upload regions of maps which are marked as changed (see
+//         TerrainBase::Mark*Dirty): for heights only the vertices, the patches
+//         bounds/errors and the control points around the region are rebuilt
+//         and uploaded; for the texture/light maps only the rectangle of texels
+//         NOTE: the CPU copies of maps and vertices_ must be kept
 //---------------------------------------------------------
-inline bool TestWeInPatch(
-    const int camPosX,
-    const int camPosZ,
-    const int cx,
-    const int cz,
-    const int halfSize)
+void TerrainGeomipmapped::UpdateDirtyRegions(ID3D11DeviceContext* pContext)
 {
-    return (camPosX >= cx-halfSize) || (camPosX <= cx+halfSize) ||
-           (camPosZ >= cz-halfSize) || (camPosZ <= cz+halfSize);
+    if (!heightMapDirty_.IsEmpty())
+    {
+        UpdateHeightRegion(pContext, heightMapDirty_);
+        heightMapDirty_.Reset();
+    }
+
+    if (!textureMapDirty_.IsEmpty())
+    {
+        const TerrainDirtyRect& rect = textureMapDirty_;
+
+        if (texture_.GetData())
+        {
+            g_TextureMgr.UpdateTextureRegion(
+                pContext,
+                texture_.GetID(),
+                texture_.GetData(),
+                texture_.GetWidth(),
+                texture_.GetHeight(),
+                texture_.GetBPP(),
+                std::max(rect.x0, 0),
+                std::max(rect.z0, 0),
+                rect.x1,
+                rect.z1);
+        }
+        textureMapDirty_.Reset();
+    }
+
+    if (!lightMapDirty_.IsEmpty())
+    {
+        const TerrainDirtyRect& rect = lightMapDirty_;
+
+        if (lightmap_.pData)
+        {
+            g_TextureMgr.UpdateTextureRegion(
+                pContext,
+                lightmap_.id,
+                lightmap_.pData,
+                lightmap_.size,
+                lightmap_.size,
+                8,                    // bits per pixel
+                std::max(rect.x0, 0),
+                std::max(rect.z0, 0),
+                rect.x1,
+                rect.z1);
+        }
+        lightMapDirty_.Reset();
+    }
 }
 
 //---------------------------------------------------------
-// Desc:   update the geomipmapping system
-// Args:   - cameraPos: camera position in the world
+// Desc:   rebuild and upload everything which depends on the changed heights
+// Args:   - rect: the changed rectangle of the height map
 //---------------------------------------------------------
-void TerrainGeomipmapped::Update(const CameraParams& camParams)
+void TerrainGeomipmapped::UpdateHeightRegion(ID3D11DeviceContext* pContext, const TerrainDirtyRect& rect)
 {
-    const int camPosX = (int)camParams.posX;
-    const int camPosY = (int)camParams.posY;
-    const int camPosZ = (int)camParams.posZ;
-
-    const int patchSize     = patchSize_;
-    const int halfPatchSize = patchSize / 2;
-    const float fHalfPatchSz = (float)halfPatchSize;
-
-    // BAD way to determine patch LOD
-    constexpr int nearDist      = 100;
-    constexpr int midDist       = 150;
-    constexpr int farDist       = 200;
-    constexpr int nearDistSqr   = nearDist * nearDist;
-    constexpr int midDistSqr    = midDist * midDist;
-    constexpr int farDistSqr    = farDist * farDist;
-
-    // radius of each patch
-    const float radius = sqrtf(SQR(fHalfPatchSz) + SQR(fHalfPatchSz) + SQR(fHalfPatchSz));
-    
-
-    // compute frustum by input camera's params
-    Frustum frustum;
+    if (!vertices_ || !patches_)
+    {
+        LogErr("can't update a region of terrain heights: there is no CPU copy of vertices");
+        return;
+    }
 
-    frustum.Initialize(
-        camParams.planes[0],
-        camParams.planes[1],
-        camParams.planes[2],
-        camParams.planes[3],
-        camParams.planes[4],
-        camParams.planes[5]);
+    const int   cellsPerPatch = patchSize_ - 1;
+    const int   lastVert      = gridVertsPerSide_ - 1;
+    const int   lastPatch     = numPatchesPerSide_ - 1;
+    const float step          = (float)patchSize_ / (float)cellsPerPatch;
 
+    // a vertex samples heights bilinearly up to one grid step around it (for its normal)
+    const int k0 = MathHelper::Clamp((int)floorf((rect.x0 - 1 - step) / step), 0, lastVert);
+    const int j0 = MathHelper::Clamp((int)floorf((rect.z0 - 1 - step) / step), 0, lastVert);
+    const int k1 = MathHelper::Clamp((int)ceilf ((rect.x1 + step) / step),     0, lastVert);
+    const int j1 = MathHelper::Clamp((int)ceilf ((rect.z1 + step) / step),     0, lastVert);
 
-    const DirectX::XMMATRIX view(camParams.viewMatrix);
-    const int numPerSide = numPatchesPerSide_;
+    // patches which contain these vertices (border vertices are shared)
+    const int px0 = MathHelper::Clamp((k0 - 1) / cellsPerPatch, 0, lastPatch);
+    const int pz0 = MathHelper::Clamp((j0 - 1) / cellsPerPatch, 0, lastPatch);
+    const int px1 = MathHelper::Clamp(k1 / cellsPerPatch,       0, lastPatch) + 1;
+    const int pz1 = MathHelper::Clamp(j1 / cellsPerPatch,       0, lastPatch) + 1;
 
-    // go through each patch and define if it is visible and
-    // if so compute the squared distance to it 
-    for (int z = 0; z < numPerSide; ++z)
-    {
-        // patch center by Z-axis
-        const int pz = (z * patchSize) + halfPatchSize;
+    BuildGridVertices(k0, j0, k1+1, j1+1);
+    ComputePatchBounds(px0, pz0, px1, pz1);
+    ComputePatchErrors(px0, pz0, px1, pz1);
+
+    if (!quadNodes_.empty())
+        RefitQuadNode(0, px0, pz0, px1, pz1);
 
-        for (int x = 0; x < numPerSide; ++x)
+    try
+    {
+        // upload the changed vertices row by row (there is no GPU copy
+        // of the grid if the terrain is rendered by vertex pulling)
+        if (vb_.Get())
         {
-            // compute patch center
-            const int  px    = (x * patchSize) + halfPatchSize;
-            const int  py    = (int)GetScaledHeightAtPoint(px, pz);
-            GeomPatch& patch = patches_[GetPatchNumber(x, z)];
-
-            // transform the patch center from world space into camera (view) space
-            DirectX::XMVECTOR center = { (float)px, (float)py, (float)pz };
-            center = DirectX::XMVector3Transform(center, view);
-            DirectX::XMFLOAT3 c;                
-            DirectX::XMStoreFloat3(&c, center);
-
-            //---------------------------------------------
-            // cull non-visible patches
-
-            // first of all we execute frustum/sphere test because of simple computations
-            patch.isVisible = frustum.SphereTest(c.x, c.y, c.z, radius);
-
-#if 1
-            // if we passed frustum/sphere test then we execute frustum/cube
-            // test for higher precision
-            if (patch.isVisible)
+            const int rowLen = k1 - k0 + 1;
+            cvector<Vertex3dTerrainPacked> packed;
+            packed.resize_uninitialized(rowLen);
+
+            for (int j = j0; j <= j1; ++j)
             {
-                bool cubeTest = frustum.CubeTest(c.x, c.y, c.z, fHalfPatchSz);
-                bool weInPatch = TestWeInPatch(camPosX, camPosZ, px, pz, halfPatchSize);
+                const int start = (j * gridVertsPerSide_) + k0;
 
-                patch.isVisible = cubeTest || weInPatch;
+                PackVertices(vertices_ + start, packed.data(), rowLen);
+                vb_.UpdateRange(pContext, packed.data(), start, rowLen);
             }
-            // we don't see this patch so just move to the next patch computation
-            else
+        }
+
+        // control points of the tessellated terrain (4 per patch)
+        if (tessVB_.Get())
+        {
+            const int numPoints = (px1 - px0) * 4;
+            cvector<GeomTessControlPoint> points(numPoints);
+
+            for (int pz = pz0; pz < pz1; ++pz)
             {
-                continue;
+                for (int px = px0; px < px1; ++px)
+                    BuildTessControlPoints(px, pz, &points[(px - px0) * 4]);
+
+                tessVB_.UpdateRange(pContext, points.data(), GetPatchNumber(px0, pz) * 4, numPoints);
             }
-#endif
+        }
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't upload a region of terrain vertices");
+    }
 
-            if (patch.isVisible)
-            {
-                // get the square of the distance from the camera to the patch
-                patch.distSqr = (SQR(px-camPosX) + SQR(py-camPosY) + SQR(pz-camPosZ));
+    // the height map texture (is sampled by the tessellated terrain and by vertex pulling)
+    if (heightMapTexID_ != INVALID_TEXTURE_ID)
+    {
+        g_TextureMgr.UpdateTextureRegion(
+            pContext,
+            heightMapTexID_,
+            heightMap_.GetData(),
+            heightMap_.GetWidth(),
+            heightMap_.GetHeight(),
+            heightMap_.GetBPP(),
+            std::max(rect.x0, 0),
+            std::max(rect.z0, 0),
+            rect.x1,
+            rect.z1);
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   build 4 control points of the patch for the tessellated terrain
+//         (see the corners order in TerrainHS.hlsl)
+//---------------------------------------------------------
+void TerrainGeomipmapped::BuildTessControlPoints(const int px, const int pz, GeomTessControlPoint* outPoints) const
+{
+    const int maxCoord = heightMap_.GetWidth() - 1;
+    const int x0       = px * patchSize_;
+    const int z0       = pz * patchSize_;
+    const int x1       = std::min(x0 + patchSize_, maxCoord);
+    const int z1       = std::min(z0 + patchSize_, maxCoord);
+
+    // the corners are shared by adjacent patches so their heights
+    // (and tess factors of common edges) are the same
+    const int      patchNum = GetPatchNumber(px, pz);
+    const XMFLOAT2 boundsY  = { patchMinY_[patchNum], patchMaxY_[patchNum] };
+
+    outPoints[0] = { { (float)x0, GetScaledHeightAtPoint(x0, z1), (float)z1 }, boundsY };
+    outPoints[1] = { { (float)x1, GetScaledHeightAtPoint(x1, z1), (float)z1 }, boundsY };
+    outPoints[2] = { { (float)x0, GetScaledHeightAtPoint(x0, z0), (float)z0 }, boundsY };
+    outPoints[3] = { { (float)x1, GetScaledHeightAtPoint(x1, z0), (float)z0 }, boundsY };
+}
+
+//---------------------------------------------------------
+// Desc:   build control points of the tessellated terrain (4 corners
+//         per patch, see the corners order in TerrainHS.hlsl)
+//         NOTE: InitGeomipmapping must be called before
+//---------------------------------------------------------
+bool TerrainGeomipmapped::InitTessellation(ID3D11Device* pDevice)
+{
+    try
+    {
+        CAssert::True(patches_ != nullptr, "the geomipmapping system isn't initialized");
+
+        const int numPerSide  = numPatchesPerSide_;
+
+        cvector<GeomTessControlPoint> points(numPerSide * numPerSide * 4);
+
+        for (int pz = 0, i = 0; pz < numPerSide; ++pz)
+        {
+            for (int px = 0; px < numPerSide; ++px, i += 4)
+                BuildTessControlPoints(px, pz, &points[i]);
+        }
+
+        const bool result = tessVB_.InitializeUpdatable(pDevice, points.data(), (int)points.size());
+        CAssert::True(result, "can't initialize a vertex buffer of control points");
+
+        LogMsgf("terrain tessellation is initialized (patches: %d)", numPerSide * numPerSide);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't initialize the terrain tessellation");
+        return false;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   build buffers for rendering by vertex pulling: the grid of a single
+//         patch, its indices of all the LODs/variants and the first grid vertex
+//         of each patch (is fetched per instance); the GPU copy of the whole
+//         grid of vertices isn't needed anymore so it is released
+//---------------------------------------------------------
+bool TerrainGeomipmapped::InitVertexPulling(ID3D11Device* pDevice)
+{
+    try
+    {
+        CAssert::True(patches_ != nullptr,                   "the geomipmapping system isn't initialized");
+        CAssert::True(heightMapTexID_ != INVALID_TEXTURE_ID, "there is no height map texture to fetch heights from");
+
+        const int vertsPerSide  = patchSize_;
+        const int cellsPerPatch = patchSize_ - 1;
+        const int numPerSide    = numPatchesPerSide_;
+
+        // the grid of one patch
+        cvector<GeomGridVertex> gridVerts(vertsPerSide * vertsPerSide);
+
+        for (int j = 0, i = 0; j < vertsPerSide; ++j)
+        {
+            for (int k = 0; k < vertsPerSide; ++k, ++i)
+                gridVerts[i] = { (uint16)k, (uint16)j };
+        }
+
+        // the same index ranges as of the whole grid (indexRanges_) but
+        // relative to the first vertex of the patch's own grid
+        cvector<UINT> indices;
+        BuildIndexVariants(vertsPerSide, indices);
+
+        // the first vertex of each patch in the whole grid
+        cvector<GeomGridVertex> patchStarts(numPerSide * numPerSide);
+
+        for (int pz = 0; pz < numPerSide; ++pz)
+        {
+            for (int px = 0; px < numPerSide; ++px)
+                patchStarts[GetPatchNumber(px, pz)] = { (uint16)(px * cellsPerPatch), (uint16)(pz * cellsPerPatch) };
+        }
+
+        bool result = gridVB_.Initialize(pDevice, gridVerts.data(), (int)gridVerts.size());
+        CAssert::True(result, "can't initialize a vertex buffer of the patch grid");
+
+        result = gridIB_.Initialize(pDevice, indices.data(), (int)indices.size());
+        CAssert::True(result, "can't initialize an index buffer of the patch grid");
+
+        result = patchStartsVB_.Initialize(pDevice, patchStarts.data(), (int)patchStarts.size());
+        CAssert::True(result, "can't initialize a vertex buffer of the patches starts");
+
+        patchMorphs_.resize(patchStarts.size());
+        result = patchMorphsVB_.Initialize(pDevice, patchMorphs_.data(), (int)patchMorphs_.size(), true);
+        CAssert::True(result, "can't initialize a vertex buffer of the patches morphs");
+
+        // the CPU copy of vertices_ is still used for patches errors
+        vb_.Shutdown();
+
+        LogMsgf("terrain vertex pulling is initialized (grid vertices: %d, patches: %d)", (int)gridVerts.size(), (int)patchStarts.size());
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        gridVB_.Shutdown();
+        gridIB_.Shutdown();
+        patchStartsVB_.Shutdown();
+        patchMorphsVB_.Shutdown();
+
+        LogErr(e);
+        LogErr("can't initialize the terrain vertex pulling");
+        return false;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   update the geomipmapping system: cull patches hierarchically
+//         by the quadtree and compute LODs of the visible ones
+// Args:   - camParams: camera params (position in world, view matrix,
+//                      frustum planes in world space, fov and screen params)
+//---------------------------------------------------------
+void TerrainGeomipmapped::Update(const CameraParams& camParams)
+{
+    if (quadNodes_.empty())
+        return;
+
+    const float camPosX = camParams.posX;
+    const float camPosY = camParams.posY;
+    const float camPosZ = camParams.posZ;
+
+    const int   numPerSide    = numPatchesPerSide_;
+    const float patchSize     = (float)patchSize_;
+    const float halfPatchSize = 0.5f * patchSize;
+    const int   maxLOD        = maxLOD_;
+
+    constexpr float maxDistSqr = (float)((1 << 27) - 1);    // limit of GeomPatch::distSqr
+
+    // a geometric error E at distance D is projected into (E * pixelsPerUnit / D) pixels
+    // so the LOD is acceptable if its error is <= (D * errorPerDist)
+    const float pixelsPerUnit = (0.5f * camParams.screenHeight) / tanf(0.5f * camParams.fovY);
+    const float errorPerDist  = std::max(camParams.maxPixelError, 0.01f) / std::max(pixelsPerUnit, 1.0f);
+
+    // the frustum planes are already in world space (are cached by the camera)
+    // so patch AABBs are tested as is
+    const float (*planes)[4] = camParams.planes;
+    const bool  isMorphing    = IsMorphing();
+
+    Frustum frustum;
+    frustum.Initialize(planes[0], planes[1], planes[2], planes[3], planes[4], planes[5]);
+
+    // reset only the patches which were visible in the prev frame
+    for (const int patchNum : visiblePatches_)
+        patches_[patchNum].isVisible = false;
+
+    visiblePatches_.clear();
+
+    //---------------------------------------------
+    // cull non-visible patches: a disjoint node is skipped with all its
+    // subtree, and a contained node accepts all its patches at once
 
-                const int distSqr = patch.distSqr;
+    quadStack_.clear();
+    quadStack_.push_back(0);
 
-                // if we see this patch then compute its LOD
-                patch.LOD =                                                    // LOD_0: by default (when distSqr < nearDistSqr)
-                    1 * ((distSqr >= nearDistSqr) & (distSqr < midDistSqr)) +  // LOD_1: distSqr in range [nearDistSqr, midDistSqr)
-                    2 * ((distSqr >= midDistSqr)  & (distSqr < farDistSqr)) +  // LOD_2: distSqr in range [midDistSqr, farDistSqr)
-                    3 *  (distSqr >= farDistSqr);                              // LOD_3: distSqr is >= farDistSqr
+    while (!quadStack_.empty())
+    {
+        const GeomQuadNode& node = quadNodes_[quadStack_.back()];
+        quadStack_.pop_back();
+
+        // the node's AABB in world space
+        const float ex = halfPatchSize * (float)(node.x1 - node.x0);
+        const float ez = halfPatchSize * (float)(node.z1 - node.z0);
+        const float ey = 0.5f * (node.maxY - node.minY);
+        const float cx = (patchSize * node.x0) + ex + originX_;
+        const float cz = (patchSize * node.z0) + ez + originZ_;
+        const float cy = node.minY + ey;
+
+        switch (frustum.AABBTest(cx, cy, cz, ex, ey, ez))
+        {
+            case DISJOINT:
+                break;
+
+            case CONTAINS:
+                AcceptQuadNode(node);
+                break;
+
+            case INTERSECTS:
+                if (node.numChildren == 0)
+                {
+                    AcceptQuadNode(node);
+                    break;
+                }
+                for (int i = 0; i < node.numChildren; ++i)
+                    quadStack_.push_back(node.firstChild + i);
+                break;
+        }
+    }
+
+    //---------------------------------------------
+    // compute the distance to each visible patch and choose its LOD by
+    // the screen-space error
+
+    for (const int patchNum : visiblePatches_)
+    {
+        GeomPatch& patch = patches_[patchNum];
+
+        // the closest point of the patch's AABB to the camera
+        const float x0 = ((patchNum % numPerSide) * patchSize) + originX_;
+        const float z0 = ((patchNum / numPerSide) * patchSize) + originZ_;
+        const float px = MathHelper::Clamp(camPosX, x0, x0 + patchSize);
+        const float pz = MathHelper::Clamp(camPosZ, z0, z0 + patchSize);
+        const float py = MathHelper::Clamp(camPosY, patchMinY_[patchNum], patchMaxY_[patchNum]);
+
+        // get the square of the distance from the camera to the patch
+        const float distSqr = SQR(px-camPosX) + SQR(py-camPosY) + SQR(pz-camPosZ);
+        const float maxErr  = sqrtf(distSqr) * errorPerDist;
+
+        // errors grow with LOD so we go from the coarsest one
+        int LOD = maxLOD;
+
+        while ((LOD > 0) && (GetPatchError(patchNum, LOD) > maxErr))
+            --LOD;
+
+        patch.isVisible = true;
+        patch.distSqr   = (uint32)std::min(distSqr, maxDistSqr);
+        patch.LOD       = LOD;
+
+        // the LOD is chosen at distances [start, end) (where its own error and
+        // the parent's one are acceptable) so the patch is morphed to the parent
+        // within the last part of this range and is the same as the parent at the end
+        if (isMorphing)
+        {
+            float morph = 0;
+
+            if (LOD < maxLOD)
+            {
+                const float start      = GetPatchError(patchNum, LOD)     / errorPerDist;
+                const float end        = GetPatchError(patchNum, LOD + 1) / errorPerDist;
+                const float morphStart = end - morphRange_ * (end - start);
+
+                morph = MathHelper::Clamp((sqrtf(distSqr) - morphStart) / std::max(end - morphStart, 0.001f), 0.0f, 1.0f);
             }
+
+            patchMorphs_[patchNum].morph = morph;
         }
     }
 
+    // remove patches which are hidden behind closer hills (their LODs
+    // are kept since visible neighbors are stitched with them)
+    CullPatchesByHorizon(camParams);
+
     // recompute the geometry for the terrain
     ComputeTesselation();
 }
 
 //---------------------------------------------------------
-// Desc:   compute geometry for each terrain's patch
-//         according to its LOD
+// Desc:   mark all the patches of the node as visible
+//         (they are tested no more)
+//---------------------------------------------------------
+void TerrainGeomipmapped::AcceptQuadNode(const GeomQuadNode& node)
+{
+    for (int pz = node.z0; pz < node.z1; ++pz)
+    {
+        for (int px = node.x0; px < node.x1; ++px)
+            visiblePatches_.push_back(GetPatchNumber(px, pz));
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   horizon occlusion culling of the visible patches: they are passed from
+//         the nearest ones (by the min distance) and each patch is tested by
+//         the horizon which is made by all the patches which are entirely closer
+//         (by the max distance) so a hill hides the patches behind it;
+//         at the end all the patches are in the horizon for culling of entities
+//---------------------------------------------------------
+void TerrainGeomipmapped::CullPatchesByHorizon(const CameraParams& camParams)
+{
+    numOccludedPatches_ = 0;
+
+    if (!isHorizonCulling_)
+    {
+        horizon_.Reset();
+        return;
+    }
+
+    horizon_.BeginFrame(camParams, 2.0f * patchSize_);
+
+    if (!horizon_.IsActive() || visiblePatches_.empty())
+    {
+        horizon_.EndFrame();
+        return;
+    }
+
+    const int   numPerSide = numPatchesPerSide_;
+    const float patchSize  = (float)patchSize_;
+    const index numVisible = visiblePatches_.size();
+
+    horizonOccludees_.resize(numVisible);
+    horizonOccluders_.resize(numVisible);
+
+    for (index i = 0; i < numVisible; ++i)
+    {
+        const int   patchNum = visiblePatches_[i];
+        const float x0       = ((patchNum % numPerSide) * patchSize) + originX_;
+        const float z0       = ((patchNum / numPerSide) * patchSize) + originZ_;
+        float       minDist  = 0;
+        float       maxDist  = 0;
+
+        horizon_.GetDistances(x0, z0, x0 + patchSize, z0 + patchSize, minDist, maxDist);
+
+        horizonOccludees_[i] = { minDist, patchNum };
+        horizonOccluders_[i] = { maxDist, patchNum };
+    }
+
+    const auto byDist = [](const GeomHorizonItem& a, const GeomHorizonItem& b) { return a.dist < b.dist; };
+    std::sort(horizonOccludees_.begin(), horizonOccludees_.end(), byDist);
+    std::sort(horizonOccluders_.begin(), horizonOccluders_.end(), byDist);
+
+    // a patch is solid up to its min height so it is an occluder of this height
+    const auto addOccluder = [&](const int patchNum)
+    {
+        const float x0 = ((patchNum % numPerSide) * patchSize) + originX_;
+        const float z0 = ((patchNum / numPerSide) * patchSize) + originZ_;
+        horizon_.AddOccluder(x0, z0, x0 + patchSize, z0 + patchSize, patchMinY_[patchNum]);
+    };
+
+    index numOccluders = 0;
+    index numLeft      = 0;
+
+    for (const GeomHorizonItem& item : horizonOccludees_)
+    {
+        while ((numOccluders < numVisible) && (horizonOccluders_[numOccluders].dist <= item.dist))
+            addOccluder(horizonOccluders_[numOccluders++].patchNum);
+
+        const int   patchNum = item.patchNum;
+        const float x0       = ((patchNum % numPerSide) * patchSize) + originX_;
+        const float z0       = ((patchNum / numPerSide) * patchSize) + originZ_;
+
+        if (horizon_.IsOccluded(x0, z0, x0 + patchSize, z0 + patchSize, patchMaxY_[patchNum]))
+        {
+            patches_[patchNum].isVisible = false;
+            numOccludedPatches_++;
+        }
+        else
+        {
+            visiblePatches_[numLeft++] = patchNum;
+        }
+    }
+
+    while (numOccluders < numVisible)
+        addOccluder(horizonOccluders_[numOccluders++].patchNum);
+
+    horizon_.EndFrame();
+
+    // the visible patches are in the front-to-back order now
+    visiblePatches_.resize(numLeft);
+}
+
+//---------------------------------------------------------
+// Desc:   choose an index range for each visible patch
+//         according to its LOD and make a draw list of them
 //---------------------------------------------------------
 void TerrainGeomipmapped::ComputeTesselation(void)
 {
     // reset the counting variables
-    verticesOffset_  = 0;
-    indicesOffset_   = 0;
     patchesPerFrame_ = 0;
     vertsPerFrame_   = 0;
     trisPerFrame_    = 0;
 
+    drawStartIndices_.clear();
+    drawIndexCounts_.clear();
+    drawBaseVertices_.clear();
+    drawPatchNums_.clear();
+    drawLods_.clear();
+
     const int numPerSide = numPatchesPerSide_;
 
-    // go through each patch
-    for (int z = 0; z < numPerSide; ++z)
+    // go through each visible patch
+    for (const int num : visiblePatches_)
     {
-        for (int x = 0; x < numPerSide; ++x)
-        {
-            int num = GetPatchNumber(x, z);
-
-            if (patches_[num].isVisible)
-            {
-                ComputePatch(num, x, z);
-                patchesPerFrame_++;
-            }
-        }
+        ComputePatch(num, num % numPerSide, num / numPerSide);
+        patchesPerFrame_++;
     }
 }
 
 //---------------------------------------------------------
-// Desc:   compute vertices for this patch
+// Desc:   add a draw of this patch into the draw list
 // Args:   - currPatchNum: the number of current patch
 //         - px: patch location by X-axis
 //         - pz: patch location by Z-axis
@@ -341,531 +781,539 @@ void TerrainGeomipmapped::ComputePatch(
     const int px,
     const int pz)
 {
+    const uint32 LOD        = patches_[currPatchNum].LOD;
+    const int    lastPatch  = numPatchesPerSide_ - 1;
+
+    // if a neighbor patch is of a lower detail (greater LOD) we skip mid vertices
+    // of the fans along this side to prevent cracks; there is no geometry outside
+    // of the terrain so the border sides always use all their vertices
     GeomNeighbor patchNeighbor;
-    GeomNeighbor fanNeighbor;
+    patchNeighbor.left  = (px == 0)         || (patches_[GetPatchNumber(px-1, pz)].LOD <= LOD);
+    patchNeighbor.up    = (pz == lastPatch) || (patches_[GetPatchNumber(px, pz+1)].LOD <= LOD);
+    patchNeighbor.right = (px == lastPatch) || (patches_[GetPatchNumber(px+1, pz)].LOD <= LOD);
+    patchNeighbor.down  = (pz == 0)         || (patches_[GetPatchNumber(px, pz-1)].LOD <= LOD);
+
+    const int variant =
+        (patchNeighbor.left  << 0) |
+        (patchNeighbor.up    << 1) |
+        (patchNeighbor.right << 2) |
+        (patchNeighbor.down  << 3);
+
+    const GeomIndexRange& range = GetIndexRange(LOD, variant);
+
+    // the patch's indices are local so we offset them to the patch's first vertex in the grid
+    const int cellsPerPatch = patchSize_ - 1;
+    const int baseVertex    = (pz * cellsPerPatch * gridVertsPerSide_) + (px * cellsPerPatch);
+
+    drawStartIndices_.push_back(range.startIndex);
+    drawIndexCounts_.push_back(range.indexCount);
+    drawBaseVertices_.push_back(baseVertex);
+    drawPatchNums_.push_back((UINT)currPatchNum);
+    drawLods_.push_back((UINT)LOD);
+
+    if (IsMorphing())
+        ComputePatchMorph(currPatchNum, px, pz);
+
+    vertsPerFrame_ += (int)range.indexCount;
+    trisPerFrame_  += (int)range.indexCount / 3;
+}
 
-    uint32 LOD = patches_[currPatchNum].LOD;
+//---------------------------------------------------------
+// Desc:   setup morphing of sides of the patch: a side is morphed by the same
+//         factor/LOD by both the neighbors so their shared vertices match:
+//         - the same LODs:       the max of both factors (the side reaches the
+//                                parent's shape before any of them switches);
+//         - the neighbor is coarser: this side uses only vertices of the neighbor's
+//                                LOD (see ComputePatch) so they're morphed as of it;
+//         - the neighbor is finer:   the neighbor does the same by this patch
+//---------------------------------------------------------
+void TerrainGeomipmapped::ComputePatchMorph(const int currPatchNum, const int px, const int pz)
+{
+    GeomPatchMorph& morph     = patchMorphs_[currPatchNum];
+    const uint32    LOD       = patches_[currPatchNum].LOD;
+    const int       lastPatch = numPatchesPerSide_ - 1;
+
+    // neighbors in the order of sides: left, up, right, down (-1: outside of the terrain)
+    const int neighbors[4] =
+    {
+        (px > 0)         ? GetPatchNumber(px-1, pz) : -1,
+        (pz < lastPatch) ? GetPatchNumber(px, pz+1) : -1,
+        (px < lastPatch) ? GetPatchNumber(px+1, pz) : -1,
+        (pz > 0)         ? GetPatchNumber(px, pz-1) : -1,
+    };
 
-    int patchNumLeft  = GetPatchNumber(px-1, pz);
-    int patchNumUp    = GetPatchNumber(px,   pz+1);
-    int patchNumRight = GetPatchNumber(px+1, pz);
-    int patchNumDown  = GetPatchNumber(px,   pz-1);
+    morph.LOD      = LOD;
+    morph.edgeLODs = 0;
 
-    // find out info about the patch to the current patch's left, if the patch is of
-    // a greater detail or there is no patch to the left, we cant render the
-    
-    // the left patch
-    patchNeighbor.left  = (patches_[patchNumLeft].LOD <= LOD || px == 0);
+    for (int i = 0; i < 4; ++i)
+    {
+        uint32 edgeLOD   = LOD;
+        float  edgeMorph = morph.morph;
 
-    // the upper patch
-    patchNeighbor.up    = (patches_[patchNumUp].LOD <= LOD || pz == numPatchesPerSide_);
+        if (neighbors[i] != -1)
+        {
+            const uint32 neighborLOD   = patches_[neighbors[i]].LOD;
+            const float  neighborMorph = patchMorphs_[neighbors[i]].morph;
 
-    // the right patch
-    patchNeighbor.right = (patches_[patchNumRight].LOD <= LOD || px == numPatchesPerSide_);
+            if (neighborLOD == LOD)
+            {
+                edgeMorph = std::max(edgeMorph, neighborMorph);
+            }
+            else if (neighborLOD > LOD)
+            {
+                edgeLOD   = neighborLOD;
+                edgeMorph = neighborMorph;
+            }
+        }
 
-    // lower patch
-    patchNeighbor.down  = (patches_[patchNumDown].LOD <= LOD || pz == 0);
+        morph.edgeMorphs[i] = edgeMorph;
+        morph.edgeLODs     |= (edgeLOD << (i * 8));
+    }
+}
 
+///////////////////////////////////////////////////////////
 
-    // determine the distance btw each triangle-fan that we will be rendering
-    const int   iPatchSize = patchSize_;
-    const float fPatchSize = (float)iPatchSize;
+void TerrainGeomipmapped::SetMorphRange(const float range)
+{
+    morphRange_ = MathHelper::Clamp(range, 0.0f, 1.0f);
 
-    // find out how many fan divisions we are going to have
-    const int   divisor    = (iPatchSize - 1) >> (LOD + 1);
+    // morphs of patches are computed only while it is on
+    for (GeomPatchMorph& morph : patchMorphs_)
+        morph = GeomPatchMorph();
+}
 
-    // the size btw the center of each triangle fan (for instance: LOD_3 --> divisor = 1, size = 17, halfSize = 8)
-    const float size       = fPatchSize / divisor;
-    
-    // half the size btw the center of each triangle fan (this will be the size btw each vertex)
-    const float halfSize   = size * 0.5f;
-   
+//---------------------------------------------------------
+// Desc:   upload morphs of patches (only visible ones are actual
+//         but only they are fetched by draws of this frame)
+//---------------------------------------------------------
+void TerrainGeomipmapped::UploadPatchMorphs(ID3D11DeviceContext* pContext)
+{
+    if (!IsMorphing() || visiblePatches_.empty())
+        return;
 
-    // go through each subpatch
-    for (float z = halfSize; (z + halfSize) < fPatchSize + 1; z += size)
+    try
     {
+        patchMorphsVB_.UpdateDynamic(pContext, patchMorphs_.data(), patchMorphs_.size());
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't upload morphs of the terrain patches");
+    }
+}
 
-        // if this fan is in the bottom row, we may need to adjust it's rendering
-        // to prevent cracks
-        if (z == halfSize)
-            fanNeighbor.down = patchNeighbor.down;
-        else
-            fanNeighbor.down = true;
+//---------------------------------------------------------
+// Desc:   compute min/max height of each patch (by the height map texels
+//         which are covered by the patch); is used for culling
+//---------------------------------------------------------
+void TerrainGeomipmapped::ComputePatchBounds(const int px0, const int pz0, const int px1, const int pz1)
+{
+    const int patchSize  = patchSize_;
+    const int maxCoord   = heightMap_.GetWidth() - 1;
 
-        // if this fan is in the top row, we may need to adjust it's rendering
-        // to prevent cracks
-        if (z >= (fPatchSize - halfSize))
-            fanNeighbor.up = patchNeighbor.up;
-        else
-            fanNeighbor.up = true;
+    for (int pz = pz0; pz < pz1; ++pz)
+    {
+        for (int px = px0; px < px1; ++px)
+        {
+            const int i  = GetPatchNumber(px, pz);
+            const int x0 = px * patchSize;
+            const int z0 = pz * patchSize;
+            const int x1 = std::min(x0 + patchSize, maxCoord);
+            const int z1 = std::min(z0 + patchSize, maxCoord);
 
-        const float patchCenterZ = pz * fPatchSize + z;
+            float minY = FLT_MAX;
+            float maxY = -FLT_MAX;
 
+            for (int z = z0; z <= z1; ++z)
+            {
+                for (int x = x0; x <= x1; ++x)
+                {
+                    const float h = GetScaledHeightAtPoint(x, z);
+                    minY = std::min(minY, h);
+                    maxY = std::max(maxY, h);
+                }
+            }
 
-        for (float x = halfSize; (x + halfSize) < fPatchSize + 1; x += size)
-        {
-            // if this fan is in the left row, we may need to adjust it's rendering
-            // to prevent cracks
-            if (x == halfSize)
-                fanNeighbor.left = patchNeighbor.left;
-            else
-                fanNeighbor.left = true;
-
-            // if this fan is in the right row, we may need to adjust it's rendering
-            // to prevent cracks
-            if (x >= (fPatchSize - halfSize))
-                fanNeighbor.right = patchNeighbor.right;
-            else
-                fanNeighbor.right = true;
-
-
-            // compute the triangle fan
-            ComputeFan(px*fPatchSize + x, patchCenterZ, size, fanNeighbor);
+            patchMinY_[i] = minY;
+            patchMaxY_[i] = maxY;
         }
     }
 }
 
 //---------------------------------------------------------
-// Desc:   compute normal vector by 3 input positions
-// Args:   - pos0, pos1, pos2: positions in 3D space
-// Ret:    - vec3 value:       3D normal vector
+// Desc:   compute the geometric error of each patch per LOD: the max
+//         deviation of heights of the LOD_0 vertices from the surface of
+//         a coarser LOD (its vertices are each (1 << LOD) of LOD_0 ones);
+//         errors are non-decreasing by LOD so the LOD choice is monotonic
+//         NOTE: the grid of vertices must be built before
 //---------------------------------------------------------
-XMFLOAT3 ComputeFaceNormal(
-    const XMFLOAT3& pos0,
-    const XMFLOAT3& pos1,
-    const XMFLOAT3& pos2)
+void TerrainGeomipmapped::ComputePatchErrors(const int px0, const int pz0, const int px1, const int pz1)
 {
-    // compute face normal for the first triangle
-    XMVECTOR v0 = DirectX::XMLoadFloat3(&pos0);
-    XMVECTOR v1 = DirectX::XMLoadFloat3(&pos1);
-    XMVECTOR v2 = DirectX::XMLoadFloat3(&pos2);
+    const int numLODs       = maxLOD_ + 1;
+    const int cellsPerPatch = patchSize_ - 1;
+    const int pitch         = gridVertsPerSide_;
 
-    XMVECTOR e0 = v1 - v0;
-    XMVECTOR e1 = v2 - v0;
+    for (int pz = pz0; pz < pz1; ++pz)
+    {
+        for (int px = px0; px < px1; ++px)
+        {
+            const int patchNum = GetPatchNumber(px, pz);
+
+            // the first vertex of the patch in the grid
+            const Vertex3dTerrain* verts = vertices_ + (pz * cellsPerPatch * pitch) + (px * cellsPerPatch);
+            float* errors = &patchErrors_[patchNum * numLODs];
 
-    XMVECTOR normal = DirectX::XMVector3Normalize(DirectX::XMVector3Cross(e0, e1));
+            errors[0] = 0.0f;
 
-    float* n = normal.m128_f32;
-    return { n[0], n[1], n[2] };
+            for (int LOD = 1; LOD < numLODs; ++LOD)
+            {
+                const int   step    = 1 << LOD;
+                const float invStep = 1.0f / (float)step;
+                float       maxErr  = errors[LOD-1];
+
+                for (int j = 0; j <= cellsPerPatch; ++j)
+                {
+                    // the coarse cell which contains this vertex
+                    const int   j0 = (j / step) * step;
+                    const int   j1 = std::min(j0 + step, cellsPerPatch);
+                    const float tz = (j - j0) * invStep;
+
+                    for (int i = 0; i <= cellsPerPatch; ++i)
+                    {
+                        const int   i0 = (i / step) * step;
+                        const int   i1 = std::min(i0 + step, cellsPerPatch);
+                        const float tx = (i - i0) * invStep;
+
+                        // the height of the coarse surface (bilinear by the cell's corners)
+                        const float h00 = verts[j0*pitch + i0].position.y;
+                        const float h10 = verts[j0*pitch + i1].position.y;
+                        const float h01 = verts[j1*pitch + i0].position.y;
+                        const float h11 = verts[j1*pitch + i1].position.y;
+
+                        const float h0  = h00 + (h10 - h00) * tx;
+                        const float h1  = h01 + (h11 - h01) * tx;
+                        const float h   = h0  + (h1  - h0)  * tz;
+
+                        maxErr = std::max(maxErr, fabsf(verts[j*pitch + i].position.y - h));
+                    }
+                }
+
+                errors[LOD] = maxErr;
+            }
+        }
+    }
 }
 
 //---------------------------------------------------------
-// Desc:   compute a single fan geometry
-// Args:   - cx, cz:   center of the triangle fan to render
-//         - size:     the fan's entire size
-//         - neighbor: the fan's neighbor structure (used to avoid cracking)
+// Desc:   build the quadtree over the grid of patches: each node is split
+//         by the middle into (up to) 4 children until a single patch;
+//         NOTE: patches bounds must be computed before
 //---------------------------------------------------------
-void TerrainGeomipmapped::ComputeFan(
-    const float cx,
-    const float cz,
-    const float size,
-    const GeomNeighbor& neighbor)
+void TerrainGeomipmapped::BuildQuadtree(void)
 {
-    const float halfSize       = size * 0.5f;
-    const float invTerrainSize = 1.0f / heightMap_.GetWidth();
+    quadNodes_.clear();
 
-    // calc the texture coords
-    const float texLeft   = fabsf(cx - halfSize) * invTerrainSize;
-    const float texBottom = fabsf(cz - halfSize) * invTerrainSize;
-    const float texRight  = fabsf(cx + halfSize) * invTerrainSize;
-    const float texTop    = fabsf(cz + halfSize) * invTerrainSize;
+    if (numPatchesPerSide_ <= 0)
+        return;
 
-    const float midX      = (texLeft + texRight) * 0.5f;
-    const float midZ      = (texBottom + texTop) * 0.5f;
+    // the root covers the whole terrain
+    GeomQuadNode root;
+    root.x1 = (uint16)numPatchesPerSide_;
+    root.z1 = (uint16)numPatchesPerSide_;
 
-    // vertices positions
-    const int   centerX   = (int)cx;
-    const int   centerZ   = (int)cz;
+    quadNodes_.reserve(2 * numPatchesPerSide_ * numPatchesPerSide_);
+    quadNodes_.push_back(root);
+    BuildQuadChildren(0);
 
-    const float fLeft     = cx - halfSize;
-    const float fRight    = cx + halfSize;
-    const float fUp       = cz + halfSize;
-    const float fDown     = cz - halfSize;
+    LogMsgf("terrain quadtree is built (nodes: %d)", (int)quadNodes_.size());
+}
 
-    const int   iLeft     = (int)(fLeft);
-    const int   iRight    = (int)(fRight);
-    const int   iUp       = (int)(fUp);
-    const int   iDown     = (int)(fDown);
+//---------------------------------------------------------
+// Desc:   recursively build children of the node and compute the node's
+//         height bounds as a union of the children bounds
+//---------------------------------------------------------
+void TerrainGeomipmapped::BuildQuadChildren(const int nodeIdx)
+{
+    // a copy since the array of nodes grows below
+    const GeomQuadNode node  = quadNodes_[nodeIdx];
+    const int          sizeX = node.x1 - node.x0;
+    const int          sizeZ = node.z1 - node.z0;
 
+    // a leaf is a single patch
+    if ((sizeX == 1) && (sizeZ == 1))
+    {
+        const int patchNum = GetPatchNumber(node.x0, node.z0);
+        quadNodes_[nodeIdx].minY = patchMinY_[patchNum];
+        quadNodes_[nodeIdx].maxY = patchMaxY_[patchNum];
+        return;
+    }
 
-    /*
-        Fan visualization
+    // split ranges by X and Z (a side of one patch isn't split)
+    const uint16 splitsX[3] = { node.x0, (uint16)(node.x0 + sizeX/2), node.x1 };
+    const uint16 splitsZ[3] = { node.z0, (uint16)(node.z0 + sizeZ/2), node.z1 };
+    const int    numX       = (sizeX > 1) ? 2 : 1;
+    const int    numZ       = (sizeZ > 1) ? 2 : 1;
 
-        NOTE: Vertex by number in braces is optional according
-              to LOD of its neighbor patch
+    // add all the children at once so they are stored one after another
+    const int firstChild  = (int)quadNodes_.size();
+    const int numChildren = numX * numZ;
 
-        3 -------- (4) -------- 5
-        | \         |         / |
-        |    \      |      /    |
-        |      \    |    /      |
-        |         \ | /         |
-       (2) -------- 0 -------- (6)
-        |         / | \         |
-        |      /    |    \      |
-        |    /      |      \    |
-        | /         |         \ |
-        1 -------- (8) -------- 7
+    for (int iz = 0; iz < numZ; ++iz)
+    {
+        for (int ix = 0; ix < numX; ++ix)
+        {
+            GeomQuadNode child;
+            child.x0 = (numX == 1) ? node.x0 : splitsX[ix];
+            child.x1 = (numX == 1) ? node.x1 : splitsX[ix+1];
+            child.z0 = (numZ == 1) ? node.z0 : splitsZ[iz];
+            child.z1 = (numZ == 1) ? node.z1 : splitsZ[iz+1];
 
-    */
+            quadNodes_.push_back(child);
+        }
+    }
 
-    float height = 0;
-    Vertex3dTerrain vertices[9];
-
-    // CENTER vertex (0)
-    //height               = GetScaledHeightAtPoint((int)cx, (int)cz);
-    height               = GetScaledInterpolatedHeightAtPoint(cx, cz);
-    vertices[0].position = { cx, height, cz };
-    vertices[0].texture  = { midX, midZ };
-
-    // LOWER-LEFT vertex (1)
-    //height               = GetScaledHeightAtPoint(iLeft, iDown);
-    height               = GetScaledInterpolatedHeightAtPoint(fLeft, fDown);
-    vertices[1].position = { fLeft, height, fDown};
-    vertices[1].texture  = { texLeft, texBottom };
-
-    // UPPER-LEFT vertex (3)
-    //height               = GetScaledHeightAtPoint(iLeft, iUp);
-    height               = GetScaledInterpolatedHeightAtPoint(fLeft, fUp);
-    vertices[3].position = { fLeft, height, fUp };
-    vertices[3].texture  = { texLeft, texTop };
-
-    // UPPER-RIGHT vertex (5)
-    //height               = GetScaledHeightAtPoint(iRight, iUp);
-    height               = GetScaledInterpolatedHeightAtPoint(fRight, fUp);
-    vertices[5].position = { fRight, height, fUp };
-    vertices[5].texture  = { texRight, texTop };
-   
-    // LOWER-RIGHT vertex (7)
-    //height               = GetScaledHeightAtPoint(iRight, iDown);
-    height               = GetScaledInterpolatedHeightAtPoint(fRight, fDown);
-    vertices[7].position = { fRight, height, fDown };
-    vertices[7].texture  = { texRight, texBottom };
-
-    // ----------------------------------------------------
-
-    Vertex3dTerrain vertexBuf[24];
-    int   numVerts = 0;  // number of vertices in this fan
-
-    // add vertex 2 (so we have two triangles on the left side fan)
-    if (neighbor.left)                          
-    {
-        // MID-LEFT vertex (2): use this vertex if the left patch is NOT of a lower LOD
-        //height               = GetScaledHeightAtPoint(iLeft, centerZ);
-        height               = GetScaledInterpolatedHeightAtPoint(fLeft, cz);
-        vertices[2].position = { fLeft, height, cz };
-        vertices[2].texture  = { texLeft, midZ };
-
-        vertexBuf[numVerts + 0] = vertices[0];    
-        vertexBuf[numVerts + 1] = vertices[1];    //  3
-        vertexBuf[numVerts + 2] = vertices[2];    //  | \ 
-                                                  //  2--0
-        vertexBuf[numVerts + 3] = vertices[0];    //  | /
-        vertexBuf[numVerts + 4] = vertices[2];    //  1
-        vertexBuf[numVerts + 5] = vertices[3];
-
-#if COMPUTE_NORMALS
-        // compute normal vectors for the first and second triangle
-        XMFLOAT3 normal1 = ComputeFaceNormal(
-                                vertexBuf[numVerts + 0].position,
-                                vertexBuf[numVerts + 1].position,
-                                vertexBuf[numVerts + 2].position);
-
-        XMFLOAT3 normal2 = ComputeFaceNormal(
-                                vertexBuf[numVerts + 3].position,
-                                vertexBuf[numVerts + 4].position,
-                                vertexBuf[numVerts + 5].position);
-
-        // --------------------------------------
-
-        vertexBuf[numVerts + 0].normal = normal1;
-        vertexBuf[numVerts + 1].normal = normal1;
-        vertexBuf[numVerts + 2].normal = normal1;
-
-        vertexBuf[numVerts + 3].normal = normal2;
-        vertexBuf[numVerts + 4].normal = normal2;
-        vertexBuf[numVerts + 5].normal = normal2;
-
-        // average the normal vector for vertex 2 in this triangle
-        XMFLOAT3 avgNormal = vertexBuf[numVerts+2].normal + vertexBuf[numVerts+4].normal;
-        avgNormal *= 0.5f;
-        const XMFLOAT3 normalizedAvgNormal = DirectX::XMFloat3Normalize(avgNormal);
-
-        vertexBuf[numVerts + 2].normal = normalizedAvgNormal;
-        vertexBuf[numVerts + 4].normal = normalizedAvgNormal;
-
-        // --------------------------------------
-#endif
-        numVerts += 6;
-    }
-    // we have no mid-left vertex
-    else
-    {                                           //  3
-        vertexBuf[numVerts+0] = vertices[0];    //  | \ 
-        vertexBuf[numVerts+1] = vertices[1];    //  |  0
-        vertexBuf[numVerts+2] = vertices[3];    //  | /
-                                                //  1
-#if COMPUTE_NORMALS
-         // compute normal vectors for the triangle
-        XMFLOAT3 normal = ComputeFaceNormal(
-            vertexBuf[numVerts + 0].position,
-            vertexBuf[numVerts + 1].position,
-            vertexBuf[numVerts + 2].position);
-
-        vertexBuf[numVerts + 0].normal = normal;
-        vertexBuf[numVerts + 1].normal = normal;
-        vertexBuf[numVerts + 2].normal = normal;
-#endif
-        numVerts += 3;
-    }
-
-    // add vertex 4 (so we have two triangles on the upper side of the fan)
-    if (neighbor.up)
-    {
-        // UPPER-MID vertex (4): use this vertex if the upper patch is NOT of a lower LOD
-        //height               = GetScaledHeightAtPoint(centerX, iUp);
-        height               = GetScaledInterpolatedHeightAtPoint(cx, fUp);
-        vertices[4].position = { cx, height, fUp };
-        vertices[4].texture  = { midX, texTop };
-
-        vertexBuf[numVerts + 0] = vertices[0];
-        vertexBuf[numVerts + 1] = vertices[3];    
-        vertexBuf[numVerts + 2] = vertices[4];    //  3--4--5
-                                                  //   \ | /
-        vertexBuf[numVerts + 3] = vertices[0];    //     0
-        vertexBuf[numVerts + 4] = vertices[4];    
-        vertexBuf[numVerts + 5] = vertices[5];
-
-#if COMPUTE_NORMALS
-        // compute normal vectors for the first and second triangle
-        XMFLOAT3 normal1 = ComputeFaceNormal(
-            vertexBuf[numVerts + 0].position,
-            vertexBuf[numVerts + 1].position,
-            vertexBuf[numVerts + 2].position);
-
-        XMFLOAT3 normal2 = ComputeFaceNormal(
-            vertexBuf[numVerts + 3].position,
-            vertexBuf[numVerts + 4].position,
-            vertexBuf[numVerts + 5].position);
-
-        // --------------------------------------
-
-        vertexBuf[numVerts + 0].normal = normal1;
-        vertexBuf[numVerts + 1].normal = normal1;
-        vertexBuf[numVerts + 2].normal = normal1;
-
-        vertexBuf[numVerts + 3].normal = normal2;
-        vertexBuf[numVerts + 4].normal = normal2;
-        vertexBuf[numVerts + 5].normal = normal2;
-
-        // average the normal vector for vertex 4 in this triangle
-        XMFLOAT3 avgNormal = (normal1 + normal2);
-        avgNormal *= 0.5f;
-        const XMFLOAT3 normalizedAvgNormal = DirectX::XMFloat3Normalize(avgNormal);
-
-        vertexBuf[numVerts + 2].normal = normalizedAvgNormal;
-        vertexBuf[numVerts + 4].normal = normalizedAvgNormal;
-
-        // --------------------------------------
-#endif
-
-        numVerts += 6;
-    }
-    // we have no upper-mid vertex
-    else
+    float minY = FLT_MAX;
+    float maxY = -FLT_MAX;
+
+    for (int i = 0; i < numChildren; ++i)
     {
-        vertexBuf[numVerts+0] = vertices[0];    //  3-----5
-        vertexBuf[numVerts+1] = vertices[3];    //   \   /
-        vertexBuf[numVerts+2] = vertices[5];    //     0
+        BuildQuadChildren(firstChild + i);
 
+        minY = std::min(minY, quadNodes_[firstChild + i].minY);
+        maxY = std::max(maxY, quadNodes_[firstChild + i].maxY);
+    }
+
+    GeomQuadNode& outNode = quadNodes_[nodeIdx];
+    outNode.minY        = minY;
+    outNode.maxY        = maxY;
+    outNode.firstChild  = firstChild;
+    outNode.numChildren = (uint8)numChildren;
+}
 
-#if COMPUTE_NORMALS
-        // compute normal vectors for the triangle
-        XMFLOAT3 normal = ComputeFaceNormal(
-            vertexBuf[numVerts + 0].position,
-            vertexBuf[numVerts + 1].position,
-            vertexBuf[numVerts + 2].position);
+//---------------------------------------------------------
+// Desc:   recompute height bounds of the nodes which cover any patch of
+//         the range [px0,px1) x [pz0,pz1) (after these patches are changed)
+//---------------------------------------------------------
+void TerrainGeomipmapped::RefitQuadNode(
+    const int nodeIdx,
+    const int px0,
+    const int pz0,
+    const int px1,
+    const int pz1)
+{
+    GeomQuadNode& node = quadNodes_[nodeIdx];
 
-        vertexBuf[numVerts + 0].normal = normal;
-        vertexBuf[numVerts + 1].normal = normal;
-        vertexBuf[numVerts + 2].normal = normal;
-#endif
+    // the node doesn't cover changed patches
+    if ((node.x1 <= px0) || (node.x0 >= px1) || (node.z1 <= pz0) || (node.z0 >= pz1))
+        return;
 
-        numVerts += 3;
+    // a leaf is a single patch
+    if (node.numChildren == 0)
+    {
+        const int patchNum = GetPatchNumber(node.x0, node.z0);
+        node.minY = patchMinY_[patchNum];
+        node.maxY = patchMaxY_[patchNum];
+        return;
     }
 
-    // add vertex 6 (so we have two triangles on the right side of the fan)
-    if (neighbor.right)
+    float minY = FLT_MAX;
+    float maxY = -FLT_MAX;
+
+    for (int i = node.firstChild; i < node.firstChild + node.numChildren; ++i)
     {
-        // MID-RIGHT vertex(6): use this vertex if the right patch is NOT of a lower LOD
-        //height               = GetScaledHeightAtPoint(iRight, centerZ);
-        height               = GetScaledInterpolatedHeightAtPoint(fRight, cz);
-        vertices[6].position = { fRight, height, cz };
-        vertices[6].texture  = { texRight, midZ };
+        RefitQuadNode(i, px0, pz0, px1, pz1);
 
-        vertexBuf[numVerts + 0] = vertices[0];
-        vertexBuf[numVerts + 1] = vertices[5];      //     5
-        vertexBuf[numVerts + 2] = vertices[6];      //   / |
-                                                    //  0--6
-        vertexBuf[numVerts + 3] = vertices[0];      //   \ |
-        vertexBuf[numVerts + 4] = vertices[6];      //     7
-        vertexBuf[numVerts + 5] = vertices[7];
+        minY = std::min(minY, quadNodes_[i].minY);
+        maxY = std::max(maxY, quadNodes_[i].maxY);
+    }
 
-#if COMPUTE_NORMALS
-        // compute normal vectors for the first and second triangle
-        XMFLOAT3 normal1 = ComputeFaceNormal(
-            vertexBuf[numVerts + 0].position,
-            vertexBuf[numVerts + 1].position,
-            vertexBuf[numVerts + 2].position);
+    node.minY = minY;
+    node.maxY = maxY;
+}
 
-        XMFLOAT3 normal2 = ComputeFaceNormal(
-            vertexBuf[numVerts + 3].position,
-            vertexBuf[numVerts + 4].position,
-            vertexBuf[numVerts + 5].position);
+//---------------------------------------------------------
+// Desc:   fill in vertices_ with a static grid which covers all the patches:
+//         adjacent patches share their border vertices, and the distance
+//         btw vertices is (patchSize / (patchSize-1)) as of a patch of LOD_0;
+//         only vertices [k0,k1) x [j0,j1) of the grid are (re)built
+//---------------------------------------------------------
+void TerrainGeomipmapped::BuildGridVertices(const int k0, const int j0, const int k1, const int j1)
+{
+    constexpr index ROWS_PER_JOB = 16;
 
-        // --------------------------------------
+    const int   terrainSize    = heightMap_.GetWidth();
+    const int   numVertsSide   = gridVertsPerSide_;
+    const float step           = (float)patchSize_ / (float)(patchSize_ - 1);
+    const float invTerrainSize = 1.0f / (float)terrainSize;
+    const float maxCoord       = (float)(terrainSize - 1);
 
-        vertexBuf[numVerts + 0].normal = normal1;
-        vertexBuf[numVerts + 1].normal = normal1;
-        vertexBuf[numVerts + 2].normal = normal1;
+    // rows are independent so they are built by jobs
+    g_JobSystem.ParallelFor(j1 - j0, ROWS_PER_JOB, [&](const index start, const index end)
+    {
+        for (int j = j0 + (int)start; j < j0 + (int)end; ++j)
+        {
+            const float z  = j * step;
+            const float zD = MathHelper::Clamp(z - step, 0.0f, maxCoord);
+            const float zU = MathHelper::Clamp(z + step, 0.0f, maxCoord);
 
-        vertexBuf[numVerts + 3].normal = normal2;
-        vertexBuf[numVerts + 4].normal = normal2;
-        vertexBuf[numVerts + 5].normal = normal2;
+            for (int k = k0, i = (j * numVertsSide) + k0; k < k1; ++k, ++i)
+            {
+                const float x  = k * step;
+                const float xL = MathHelper::Clamp(x - step, 0.0f, maxCoord);
+                const float xR = MathHelper::Clamp(x + step, 0.0f, maxCoord);
 
-        // average the normal vector for vertex 6 in this triangle
-        XMFLOAT3 avgNormal = vertexBuf[numVerts + 2].normal + vertexBuf[numVerts + 4].normal;
-        avgNormal *= 0.5f;
-        const XMFLOAT3 normalizedAvgNormal = DirectX::XMFloat3Normalize(avgNormal);
+                Vertex3dTerrain& v = vertices_[i];
+                v.position = { x + originX_, GetScaledInterpolatedHeightAtPoint(x, z), z + originZ_ };
+                v.texture  = { x * invTerrainSize, z * invTerrainSize };
 
-        vertexBuf[numVerts + 2].normal = normalizedAvgNormal;
-        vertexBuf[numVerts + 4].normal = normalizedAvgNormal;
+                // a smooth normal by central differences of heights
+                const float hL = GetScaledInterpolatedHeightAtPoint(xL, z);
+                const float hR = GetScaledInterpolatedHeightAtPoint(xR, z);
+                const float hD = GetScaledInterpolatedHeightAtPoint(x, zD);
+                const float hU = GetScaledInterpolatedHeightAtPoint(x, zU);
 
-#endif
-        // --------------------------------------
+                v.normal = DirectX::XMFloat3Normalize({ hL - hR, 2.0f * step, hD - hU });
+            }
+        }
+    });
+}
 
-        numVerts += 6;
-    }
-    // we have no mid-right vertex
-    else
-    {                                           //     5
-        vertexBuf[numVerts+0] = vertices[0];    //   / |
-        vertexBuf[numVerts+1] = vertices[5];    //  0  |
-        vertexBuf[numVerts+2] = vertices[7];    //   \ |
-                                                //     7
-
-#if COMPUTE_NORMALS
-        // compute normal vectors for the triangle
-        XMFLOAT3 normal = ComputeFaceNormal(
-            vertexBuf[numVerts + 0].position,
-            vertexBuf[numVerts + 1].position,
-            vertexBuf[numVerts + 2].position);
-
-        vertexBuf[numVerts + 0].normal = normal;
-        vertexBuf[numVerts + 1].normal = normal;
-        vertexBuf[numVerts + 2].normal = normal;
-#endif
-        numVerts += 3;
-
-    }
-
-    // add vertex 8 (so we have two triangles on the bottom side of the fan)
-    if (neighbor.down)
-    {
-        // LOWER-MID vertex (8): use this vertex if the bottom patch is NOT of a lower LOD
-        //height               = GetScaledHeightAtPoint(centerX, iDown);
-        height               = GetScaledInterpolatedHeightAtPoint(cx, fDown);
-        vertices[8].position = { cx, height, fDown };
-        vertices[8].texture  = { midX, texBottom };
-
-        vertexBuf[numVerts + 0] = vertices[0];
-        vertexBuf[numVerts + 1] = vertices[7];
-        vertexBuf[numVerts + 2] = vertices[8];      //     0
-                                                    //   / | \ 
-        vertexBuf[numVerts + 3] = vertices[0];      //  1--8--7
-        vertexBuf[numVerts + 4] = vertices[8];    
-        vertexBuf[numVerts + 5] = vertices[1];
-
-#if COMPUTE_NORMALS
-        // compute normal vectors for the first and second triangle
-        XMFLOAT3 normal1 = ComputeFaceNormal(
-            vertexBuf[numVerts + 0].position,
-            vertexBuf[numVerts + 1].position,
-            vertexBuf[numVerts + 2].position);
-
-        XMFLOAT3 normal2 = ComputeFaceNormal(
-            vertexBuf[numVerts + 3].position,
-            vertexBuf[numVerts + 4].position,
-            vertexBuf[numVerts + 5].position);
-
-        // --------------------------------------
-
-        vertexBuf[numVerts + 0].normal = normal1;
-        vertexBuf[numVerts + 1].normal = normal1;
-        vertexBuf[numVerts + 2].normal = normal1;
-
-        vertexBuf[numVerts + 3].normal = normal2;
-        vertexBuf[numVerts + 4].normal = normal2;
-        vertexBuf[numVerts + 5].normal = normal2;
-
-        // average the normal vector for vertex 8 in this triangle
-        XMFLOAT3 avgNormal = vertexBuf[numVerts + 2].normal + vertexBuf[numVerts + 4].normal;
-        avgNormal *= 0.5f;
-        const XMFLOAT3 normalizedAvgNormal = DirectX::XMFloat3Normalize(avgNormal);
-
-        vertexBuf[numVerts + 2].normal = normalizedAvgNormal;
-        vertexBuf[numVerts + 4].normal = normalizedAvgNormal;
-#endif
-
-        // --------------------------------------
-
-        numVerts += 6;
-    }
-    // we have no bottom-mid vertex
-    else
+//---------------------------------------------------------
+// Desc:   build indices of each LOD and each neighbors variant (and their
+//         ranges in indexRanges_); the indices are relative to the first
+//         vertex of a patch in a grid
+// Args:   - pitch:      the number of vertices per row of the grid
+//         - outIndices: indices of all the variants one after another
+//---------------------------------------------------------
+void TerrainGeomipmapped::BuildIndexVariants(const int pitch, cvector<UINT>& outIndices)
+{
+    const int cellsPerPatch = patchSize_ - 1;
+    cvector<UINT>& indices  = outIndices;
+
+    indices.clear();
+
+    indexRanges_.resize((maxLOD_ + 1) * NUM_NEIGHBOR_VARIANTS);
+
+    for (int LOD = 0; LOD <= maxLOD_; ++LOD)
     {
-        vertexBuf[numVerts+0] = vertices[0];    //     0
-        vertexBuf[numVerts+1] = vertices[7];    //   /   \ 
-        vertexBuf[numVerts+2] = vertices[1];    //  1-----7
+        // half of a fan's size (in grid cells) and the number of fans per patch side
+        const int halfSize   = 1 << LOD;
+        const int fanSize    = halfSize * 2;
+        const int numFans    = cellsPerPatch >> (LOD + 1);
+        const int lastFan    = numFans - 1;
 
-#if COMPUTE_NORMALS
-           // compute normal vectors for the triangle
-        XMFLOAT3 normal = ComputeFaceNormal(
-            vertexBuf[numVerts + 0].position,
-            vertexBuf[numVerts + 1].position,
-            vertexBuf[numVerts + 2].position);
+        for (int variant = 0; variant < NUM_NEIGHBOR_VARIANTS; ++variant)
+        {
+            GeomIndexRange& range = indexRanges_[LOD*NUM_NEIGHBOR_VARIANTS + variant];
+            range.startIndex = (uint32)indices.size();
 
-        vertexBuf[numVerts + 0].normal = normal;
-        vertexBuf[numVerts + 1].normal = normal;
-        vertexBuf[numVerts + 2].normal = normal;
-#endif
-        numVerts += 3;
+            // only fans along the sides of the patch may skip their mid vertices
+            for (int fz = 0; fz < numFans; ++fz)
+            {
+                for (int fx = 0; fx < numFans; ++fx)
+                {
+                    GeomNeighbor fanNeighbor;
+                    fanNeighbor.left  = (fx != 0)       || (variant & (1 << 0));
+                    fanNeighbor.up    = (fz != lastFan) || (variant & (1 << 1));
+                    fanNeighbor.right = (fx != lastFan) || (variant & (1 << 2));
+                    fanNeighbor.down  = (fz != 0)       || (variant & (1 << 3));
+
+                    const int cx = (fx * fanSize) + halfSize;
+                    const int cz = (fz * fanSize) + halfSize;
+
+                    AddFanIndices(indices, pitch, cx, cz, halfSize, fanNeighbor);
+                }
+            }
 
+            range.indexCount = (uint32)indices.size() - range.startIndex;
+        }
     }
+}
 
-#if COMPUTE_AVERAGED_CENTER_NORMALS
-    XMFLOAT3 centralNormal{0,0,0};
+//---------------------------------------------------------
+// Desc:   add indices of a single fan (the same triangles as of the
+//         fan visualization below)
+// Args:   - pitch:    the number of vertices per row of the grid
+//         - cx, cz:   center of the fan (in grid cells relatively to the patch)
+//         - halfSize: half of the fan's size (in grid cells)
+//         - neighbor: the fan's neighbor structure (used to avoid cracking)
+//---------------------------------------------------------
+void TerrainGeomipmapped::AddFanIndices(
+    cvector<UINT>& outIndices,
+    const int pitch,
+    const int cx,
+    const int cz,
+    const int halfSize,
+    const GeomNeighbor& neighbor) const
+{
+    /*
+        Fan visualization
 
-    // compute averaged normal for central vertex
-    for (int i = 0; i < numVerts/3; ++i)
-    {
-        centralNormal += vertexBuf[i*3].normal;
-    }
-    centralNormal *= 0.125f;
+        NOTE: Vertex by number in braces is optional according
+              to LOD of its neighbor patch
 
-    // normalize averaged central normal vector
-    DirectX::XMFloat3Normalize(centralNormal);
+        3 -------- (4) -------- 5
+        | \         |         / |
+        |    \      |      /    |
+        |      \    |    /      |
+        |         \ | /         |
+       (2) -------- 0 -------- (6)
+        |         / | \         |
+        |      /    |    \      |
+        |    /      |      \    |
+        | /         |         \ |
+        1 -------- (8) -------- 7
+
+    */
+    const int  left  = cx - halfSize;
+    const int  right = cx + halfSize;
+    const int  up    = cz + halfSize;
+    const int  down  = cz - halfSize;
 
-    // set averaged central normal for each triangle
-    for (int i = 0; i < numVerts / 3; ++i)
+    const UINT v[9] =
     {
-        vertexBuf[i*3+ 0].normal = centralNormal;
-    }
-#endif
+        (UINT)(cz   * pitch + cx),       // 0: center
+        (UINT)(down * pitch + left),     // 1: lower-left
+        (UINT)(cz   * pitch + left),     // 2: mid-left
+        (UINT)(up   * pitch + left),     // 3: upper-left
+        (UINT)(up   * pitch + cx),       // 4: upper-mid
+        (UINT)(up   * pitch + right),    // 5: upper-right
+        (UINT)(cz   * pitch + right),    // 6: mid-right
+        (UINT)(down * pitch + right),    // 7: lower-right
+        (UINT)(down * pitch + cx),       // 8: lower-mid
+    };
+
+    // corners of each side of the fan (in the clockwise order) and its mid vertex
+    constexpr int sides[4][3] =
+    {
+        { 1, 2, 3 },    // left
+        { 3, 4, 5 },    // up
+        { 5, 6, 7 },    // right
+        { 7, 8, 1 },    // down
+    };
+    const bool useMid[4] = { neighbor.left, neighbor.up, neighbor.right, neighbor.down };
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const int* side = sides[i];
 
+        if (useMid[i])
+        {
+            outIndices.push_back(v[0]);
+            outIndices.push_back(v[side[0]]);
+            outIndices.push_back(v[side[1]]);
 
-    // copy vertices into the main buffer so later we will load all of them into GPU
-    memcpy(&vertices_[verticesOffset_], vertexBuf, sizeof(Vertex3dTerrain) * numVerts);
-    verticesOffset_ += numVerts;
+            outIndices.push_back(v[0]);
+            outIndices.push_back(v[side[1]]);
+            outIndices.push_back(v[side[2]]);
+        }
+        else
+        {
+            outIndices.push_back(v[0]);
+            outIndices.push_back(v[side[0]]);
+            outIndices.push_back(v[side[2]]);
+        }
+    }
 }
 
 ///////////////////////////////////////////////////////////
@@ -913,12 +1361,10 @@ void TerrainGeomipmapped::SetTexture(const int idx, const TexID texID)
         return;
     }
 
-    // everything is ok so set the texture for terrain's material
-    Material& mat = g_MaterialMgr.GetMaterialByID(materialID_);
-
+    // everything is ok so set the texture for terrain's material;
     // NOTE: we used slightly different approach of terrain types:
     // for instance ambient texture type can be used for detail map or something like that
-    mat.SetTexture(eTexType(idx), texID);
+    g_MaterialMgr.SetMaterialTexture(materialID_, eTexType(idx), texID);
 }
 
 } // namespace
@@ -8,9 +8,11 @@
 #pragma once
 
 #include "../Mesh/Vertex3dTerrain.h"
+#include "../Mesh/VertexPacked.h"
 #include "../Mesh/VertexBuffer.h"
 #include "../Mesh/IndexBuffer.h"
 #include "TerrainBase.h"
+#include "TerrainHorizon.h"
 
 namespace Core
 {
@@ -35,6 +37,76 @@ struct GeomNeighbor
     uint8 down  : 1;
 };
 
+///////////////////////////////////////////////////////////
+
+struct GeomTessControlPoint
+{
+    // a corner of a patch of the tessellated terrain
+    DirectX::XMFLOAT3 pos;          // y is the height at the corner
+    DirectX::XMFLOAT2 boundsY;      // min/max height of the whole patch (for culling in HS)
+};
+
+///////////////////////////////////////////////////////////
+
+struct GeomGridVertex
+{
+    // a vertex of the terrain rendered by vertex pulling: a vertex of the grid which
+    // is shared by all the patches (or the first grid vertex of a patch per instance);
+    // the height, normal and texture coords are computed from the height map by the VS
+    uint16 x = 0;                   // DXGI_FORMAT_R16G16_UINT
+    uint16 z = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+struct GeomPatchMorph
+{
+    // geomorphing of a patch rendered by vertex pulling (is fetched per instance):
+    // vertices which are absent in the parent (coarser) LOD are moved towards
+    // the parent's surface by the morph factor so the LOD is switched without a pop;
+    // vertices of a side are morphed by the factor/LOD of the side which is the same
+    // for both the neighbor patches (so there are no cracks)
+    float  edgeMorphs[4] = { 0,0,0,0 };     // left, up, right, down (as of GeomNeighbor)
+    float  morph         = 0;               // of inner vertices: 0 - own LOD, 1 - parent LOD
+    uint32 LOD           = 0;
+    uint32 edgeLODs      = 0;               // LOD of each side (8 bits per side in the same order)
+    float  padding       = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+struct GeomIndexRange
+{
+    // a range of the index buffer for a single (LOD, neighbors variant) pair
+    uint32 startIndex = 0;
+    uint32 indexCount = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+struct GeomQuadNode
+{
+    // a node of the quadtree over the grid of patches: it covers
+    // the patches in the range [x0, x1) x [z0, z1)
+    float  minY        = 0;         // min/max height of all the covered patches
+    float  maxY        = 0;
+    uint16 x0          = 0;
+    uint16 z0          = 0;
+    uint16 x1          = 0;
+    uint16 z1          = 0;
+    int    firstChild  = -1;        // children of the node are stored one after another
+    uint8  numChildren = 0;         // 0 for a leaf (a single patch)
+};
+
+///////////////////////////////////////////////////////////
+
+struct GeomHorizonItem
+{
+    // a visible patch for the horizon culling (is sorted by the distance)
+    float  dist     = 0;            // min or max distance to the camera in the XZ plane
+    int    patchNum = 0;
+};
+
 // =================================================================================
 // Class
 // =================================================================================
@@ -53,6 +125,8 @@ public:
         const int numVertices,
         const int numIndices);
 
+    // build the static grid of vertices and the index buffer variants
+    // of all the LODs (into vertices_/indices_; upload them by InitBuffers)
     bool InitGeomipmapping(const int patchSize);
 
     bool InitBuffers(
@@ -62,22 +136,49 @@ public:
         const int numVertices,
         const int numIndices);
 
+    // build the coarse patches grid for the tessellated terrain: 4 control points
+    // per patch (the patches are culled and tessellated by the GPU so Update()
+    // isn't needed for this mode)
+    bool InitTessellation(ID3D11Device* pDevice);
+
+    // build buffers for rendering by vertex pulling: a single grid of one patch
+    // (only 2D grid coords per vertex) is shared by all the patches and the heights
+    // are fetched from heightMapTexID_ (so the GPU copy of the vertices_ grid
+    // is released); patches are culled and chosen by LODs by Update() as usual
+    // NOTE: InitGeomipmapping and creation of the height map texture must be done before
+    bool InitVertexPulling(ID3D11Device* pDevice);
+
+    // geomorphing of the vertex pulled terrain: a patch is morphed to its parent LOD
+    // within the last part (range: [0,1]) of the distances at which its LOD is chosen
+    // so LODs are switched invisibly (0 - geomorphing is off)
+    void        SetMorphRange(const float range);
+    inline bool IsMorphing()                const { return (morphRange_ > 0) && (patchMorphsVB_.Get() != nullptr); }
+
+    // horizon occlusion culling: visible patches are added into the horizon buffer
+    // from the nearest ones and patches behind hills are removed by Update; the built
+    // horizon is used for culling of entities then (see GetHorizon)
+    inline void SetHorizonCulling(const bool state)       { isHorizonCulling_ = state; }
+    inline const TerrainHorizon& GetHorizon()       const { return horizon_; }
+    inline int  GetNumOccludedPatches()             const { return numOccludedPatches_; }
+    inline bool IsHorizonCulling()                  const { return isHorizonCulling_; }
+
+    // upload morph factors of the visible patches (is called by the main thread after Update)
+    void UploadPatchMorphs(ID3D11DeviceContext* pContext);
+
+    // upload only the changed regions of maps (see TerrainBase::Mark*Dirty);
+    // NOTE: it must be called when the GPU doesn't use the buffers (by the main thread)
+    void UpdateDirtyRegions(ID3D11DeviceContext* pContext);
+
+    // cull patches by the quadtree (a node which is fully inside of the frustum
+    // accepts all its patches without further tests) and choose LODs of visible
+    // ones: the coarsest LOD which screen-space error is within camParams.maxPixelError
     void Update(const CameraParams& camParams);
 
+    // choose an index range for each visible patch according to its LOD
+    // and LODs of its neighbors (there is no geometry generation per frame)
     void ComputeTesselation(void);
     void ComputePatch(const int currPatchNum, const int px, const int pz);
-
-    void ComputeFan(
-        const float cx,
-        const float cz,
-        const float size,
-        const GeomNeighbor& neighbor);
-
-    void ComputeFanWithIndices(
-        const float cx,
-        const float cz,
-        const float size,
-        const GeomNeighbor& neighbor);
+    void ComputePatchMorph(const int currPatchNum, const int px, const int pz);
 
     // ------------------------------------------
     // getters
@@ -90,40 +191,113 @@ public:
     inline ID3D11Buffer* GetVertexBuffer()      const { return vb_.Get(); }
     inline ID3D11Buffer* GetIndexBuffer()       const { return ib_.Get(); }
 
+    inline ID3D11Buffer* GetTessVertexBuffer()  const { return tessVB_.Get(); }
+    inline int GetTessVertexStride()            const { return tessVB_.GetStride(); }
+    inline int GetNumTessControlPoints()        const { return tessVB_.GetVertexCount(); }
+
+    inline ID3D11Buffer* GetGridVertexBuffer()  const { return gridVB_.Get(); }
+    inline ID3D11Buffer* GetGridIndexBuffer()   const { return gridIB_.Get(); }
+    inline ID3D11Buffer* GetPatchStartsBuffer() const { return patchStartsVB_.Get(); }
+    inline int GetGridVertexStride()            const { return gridVB_.GetStride(); }
+    inline ID3D11Buffer* GetPatchMorphsBuffer() const { return (IsMorphing()) ? patchMorphsVB_.Get() : nullptr; }
+    inline int GetPatchMorphStride()            const { return patchMorphsVB_.GetStride(); }
+    inline bool IsVertexPulling()               const { return gridVB_.Get() != nullptr; }
+
     // get the number of patches being rendered per frame
     inline int GetNumPatchesPerFrame(void) const
     {   return patchesPerFrame_;   }
 
+    // get the number of indices being rendered per frame
+    inline int GetNumIndicesPerFrame(void) const
+    {   return vertsPerFrame_;   }
+
     // get the current patch number by input coords
     inline int GetPatchNumber(int px, int pz) const
     {   return (pz*numPatchesPerSide_) + px;   }
 
+    // get the index range by LOD and neighbors variant (see NUM_NEIGHBOR_VARIANTS)
+    inline const GeomIndexRange& GetIndexRange(const int LOD, const int variant) const
+    {   return indexRanges_[LOD*NUM_NEIGHBOR_VARIANTS + variant];   }
+
+    // get the geometric error (max height deviation from LOD_0) of the patch at this LOD
+    inline float GetPatchError(const int patchNum, const int LOD) const
+    {   return patchErrors_[patchNum*(maxLOD_+1) + LOD];   }
+
     // ------------------------------------------
     // setters
     // ------------------------------------------
 
     void SetAABB(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents);
+
+    // offset of the terrain in world (is used by streamed tiles of a large terrain);
+    // must be set before InitGeomipmapping
+    inline void SetOrigin(const float x, const float z) { originX_ = x; originZ_ = z; }
     void SetMaterial(const MaterialID matID);
     void SetTexture(const int idx, const TexID texID);
 
+private:
+    void BuildGridVertices (const int k0,  const int j0,  const int k1,  const int j1);
+    void BuildIndexVariants(const int pitch, cvector<UINT>& outIndices);
+    void ComputePatchBounds(const int px0, const int pz0, const int px1, const int pz1);
+    void ComputePatchErrors(const int px0, const int pz0, const int px1, const int pz1);
+    void BuildQuadtree(void);
+    void BuildQuadChildren(const int nodeIdx);
+    void RefitQuadNode(const int nodeIdx, const int px0, const int pz0, const int px1, const int pz1);
+    void AcceptQuadNode(const GeomQuadNode& node);
+    void CullPatchesByHorizon(const CameraParams& camParams);
+
+    void BuildTessControlPoints(const int px, const int pz, GeomTessControlPoint* outPoints) const;
+    void UpdateHeightRegion(ID3D11DeviceContext* pContext, const TerrainDirtyRect& rect);
+
+    void AddFanIndices(
+        cvector<UINT>& outIndices,
+        const int pitch,
+        const int cx,
+        const int cz,
+        const int halfSize,
+        const GeomNeighbor& neighbor) const;
+
 public:
+    // each patch has 16 variants of its indices: a bit per side (left=1, up=2,
+    // right=4, down=8) is set if the mid vertices of this side are used
+    static constexpr int NUM_NEIGHBOR_VARIANTS = 16;
+
     char                name_[32]           = "terrain_geomipmapped";
-    uint8_t             vertexStride_       = sizeof(Vertex3dTerrain);
+    uint8_t             vertexStride_       = sizeof(Vertex3dTerrainPacked);
     uint32_t            numVertices_        = 0;
     uint32_t            numIndices_         = 0;
     MaterialID          materialID_         = 0;
 
-    VertexBuffer<Vertex3dTerrain> vb_;
+    VertexBuffer<Vertex3dTerrainPacked> vb_;     // vertices are packed at uploading
     IndexBuffer<UINT>   ib_;
+    VertexBuffer<GeomTessControlPoint>  tessVB_; // control points of the tessellated terrain
+    TexID               heightMapTexID_     = 0; // displacement of the tessellated terrain (and of the vertex pulling)
+
+    // rendering by vertex pulling (see InitVertexPulling)
+    VertexBuffer<GeomGridVertex> gridVB_;        // the grid of a single patch (patchSize_^2 vertices)
+    IndexBuffer<UINT>   gridIB_;                 // the same LODs/variants ranges but relative to gridVB_
+    VertexBuffer<GeomGridVertex> patchStartsVB_; // per instance: the first grid vertex of each patch
+    VertexBuffer<GeomPatchMorph> patchMorphsVB_; // per instance: geomorphing of each patch (is dynamic)
+    cvector<GeomPatchMorph> patchMorphs_;        // CPU copy (is filled for the visible patches by Update)
+    float               morphRange_         = 0;        // see SetMorphRange
     DirectX::XMFLOAT3   center_;
+    float               originX_            = 0;        // position of the height map's (0,0) in world
+    float               originZ_            = 0;
     DirectX::XMFLOAT3   extents_;
 
     // keep CPU copy of the vertices/indices data to read from
     Vertex3dTerrain*    vertices_           = nullptr;
     UINT*               indices_            = nullptr;
 
-    int verticesOffset_ = 0;
-    int indicesOffset_ = 0;
+    int                 gridVertsPerSide_   = 0;        // the static grid of vertices: numPatchesPerSide_ * (patchSize_-1) + 1
+    cvector<GeomIndexRange> indexRanges_;               // (maxLOD_+1) * NUM_NEIGHBOR_VARIANTS ranges of the index buffer
+
+    // draw list of visible patches for the current frame (SoA)
+    cvector<UINT>       drawStartIndices_;
+    cvector<UINT>       drawIndexCounts_;
+    cvector<int>        drawBaseVertices_;
+    cvector<UINT>       drawPatchNums_;                 // the patch number (instance) of each draw
+    cvector<UINT>       drawLods_;                      // LOD of each draw (for the LOD heatmap)
 
     GeomPatch*          patches_            = nullptr;  // array of terrain's patches (geometry sets)
     int                 patchSize_          = 17;       // size (width and depth) of a single patch
@@ -131,6 +305,19 @@ public:
     int                 maxLOD_             = 4;        // the number of LOD's for this terrain
     int                 patchesPerFrame_    = 0;
 
+    cvector<float>      patchMinY_;                     // min/max height of each patch (is computed once)
+    cvector<float>      patchMaxY_;
+    cvector<float>      patchErrors_;                   // (maxLOD_+1) geometric errors per patch (is computed once)
+    cvector<GeomQuadNode> quadNodes_;                   // the quadtree for culling (the root is the first)
+    cvector<int>        quadStack_;                     // transient stack of nodes for the traversal
+    cvector<int>        visiblePatches_;                // numbers of patches which are visible in the current frame
+
+    TerrainHorizon      horizon_;                       // is built by Update if isHorizonCulling_
+    cvector<GeomHorizonItem> horizonOccludees_;         // transient: visible patches by min distance
+    cvector<GeomHorizonItem> horizonOccluders_;         // transient: visible patches by max distance
+    int                 numOccludedPatches_ = 0;
+    bool                isHorizonCulling_   = false;
+
     bool                wantDebug_          = false;
 };
 
@@ -0,0 +1,310 @@
+// =================================================================================
+// Filename:  TerrainHorizon.cpp
+// Desc:      implementation of the horizon buffer for terrain occlusion culling
+//
+// Created:   14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "TerrainHorizon.h"
+#include "TerrainBase.h"
+
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+
+namespace Core
+{
+
+// the horizon isn't used if the frustum is wider by azimuths (the camera
+// looks too steeply up/down so the frustum covers almost a full circle)
+constexpr float HORIZON_MAX_HALF_RANGE = 0.45f * XM_PI;
+
+//---------------------------------------
+// Desc:   wrap the angle into [-PI, PI]
+//---------------------------------------
+inline float WrapAngle(float angle)
+{
+    if (angle >  XM_PI) angle -= XM_2PI;
+    if (angle < -XM_PI) angle += XM_2PI;
+    return angle;
+}
+
+//---------------------------------------------------------
+// Desc:   setup the buffer for the camera of this frame: columns split the
+//         range of azimuths which is covered by the frustum
+// Args:   - camParams:     camera params (position, view and projection matrices)
+//         - firstRingDist: distance of the closest ring (see IsOccludedByRings)
+//---------------------------------------------------------
+void TerrainHorizon::BeginFrame(const CameraParams& camParams, const float firstRingDist)
+{
+    camX_ = camParams.posX;
+    camY_ = camParams.posY;
+    camZ_ = camParams.posZ;
+
+    for (int i = 0; i < NUM_COLUMNS; ++i)
+        horizon_[i] = -FLT_MAX;
+
+    for (int i = 0; i < NUM_RINGS; ++i)
+        ringDists_[i] = firstRingDist * (float)(1 << i);
+
+    numRingsDone_ = 0;
+
+    // basis of the camera in world (columns of the view matrix)
+    const float* view = camParams.viewMatrix;
+    const XMFLOAT3 right(view[0], view[4], view[8]);
+    const XMFLOAT3 up   (view[1], view[5], view[9]);
+    const XMFLOAT3 look (view[2], view[6], view[10]);
+
+    // the frustum's half-sizes at the distance 1
+    const float tanX = 1.0f / std::max(camParams.projMatrix[0], 0.001f);
+    const float tanY = 1.0f / std::max(camParams.projMatrix[5], 0.001f);
+
+    yaw_ = atan2f(look.x, look.z);
+
+    // the frustum is a convex cone so its azimuths are limited by its 4 edges
+    float halfRange = 0;
+    isActive_       = true;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const float sx = (i & 1) ? tanX : -tanX;
+        const float sy = (i & 2) ? tanY : -tanY;
+
+        const float dx = look.x + sx*right.x + sy*up.x;
+        const float dz = look.z + sx*right.z + sy*up.z;
+
+        if ((dx*dx + dz*dz) < 1e-6f)
+        {
+            isActive_ = false;
+            return;
+        }
+
+        halfRange = std::max(halfRange, fabsf(WrapAngle(atan2f(dx, dz) - yaw_)));
+    }
+
+    if (halfRange > HORIZON_MAX_HALF_RANGE)
+    {
+        isActive_ = false;
+        return;
+    }
+
+    // a margin of a column for the precision
+    halfRange   = halfRange * (1.0f + 1.0f / NUM_COLUMNS);
+    startAngle_ = -halfRange;
+    colsPerRad_ = NUM_COLUMNS / (2.0f * halfRange);
+}
+
+//---------------------------------------------------------
+// Desc:   snapshot the rings which are further than all the occluders
+//---------------------------------------------------------
+void TerrainHorizon::EndFrame()
+{
+    for (; numRingsDone_ < NUM_RINGS; ++numRingsDone_)
+        memcpy(rings_[numRingsDone_], horizon_, sizeof(horizon_));
+}
+
+//---------------------------------------------------------
+// Desc:   raise the horizon by a solid box [x0,x1] x [-inf,minY] x [z0,z1]
+//         in the columns which are fully covered by it
+//---------------------------------------------------------
+void TerrainHorizon::AddOccluder(
+    const float x0,
+    const float z0,
+    const float x1,
+    const float z1,
+    const float minY)
+{
+    if (!isActive_)
+        return;
+
+    float minDist = 0;
+    float maxDist = 0;
+    GetDistances(x0, z0, x1, z1, minDist, maxDist);
+
+    // occluders come by their max distance so the rings which are closer
+    // than this one are complete
+    while ((numRingsDone_ < NUM_RINGS) && (ringDists_[numRingsDone_] < maxDist))
+    {
+        memcpy(rings_[numRingsDone_], horizon_, sizeof(horizon_));
+        numRingsDone_++;
+    }
+
+    int col0 = 0;
+    int col1 = 0;
+
+    if (!GetColumns(x0, z0, x1, z1, true, col0, col1))
+        return;
+
+    // a ray of the column passes through the box at some distance within
+    // [minDist, maxDist] so it is blocked for sure if its elevation is lower
+    const float dy        = minY - camY_;
+    const float elevation = dy / ((dy > 0) ? maxDist : std::max(minDist, 0.001f));
+
+    for (int i = col0; i <= col1; ++i)
+        horizon_[i] = std::max(horizon_[i], elevation);
+}
+
+//---------------------------------------------------------
+// Desc:   test if the box [x0,x1] x [-inf,maxY] x [z0,z1] is under the current horizon
+//---------------------------------------------------------
+bool TerrainHorizon::IsOccluded(
+    const float x0,
+    const float z0,
+    const float x1,
+    const float z1,
+    const float maxY) const
+{
+    if (!isActive_)
+        return false;
+
+    int col0 = 0;
+    int col1 = 0;
+
+    if (!GetColumns(x0, z0, x1, z1, false, col0, col1))
+        return false;
+
+    float minDist = 0;
+    float maxDist = 0;
+    GetDistances(x0, z0, x1, z1, minDist, maxDist);
+
+    // the max elevation of the box's points
+    const float dy        = maxY - camY_;
+    const float elevation = dy / ((dy > 0) ? std::max(minDist, 0.001f) : maxDist);
+
+    return IsBelow(horizon_, col0, col1, elevation);
+}
+
+//---------------------------------------------------------
+// Desc:   test the box by the closest ring before it: the ring has only the occluders
+//         which are closer than the box (is used after all the occluders are added)
+//---------------------------------------------------------
+bool TerrainHorizon::IsOccludedByRings(
+    const float minX, const float minY, const float minZ,
+    const float maxX, const float maxY, const float maxZ) const
+{
+    if (!isActive_)
+        return false;
+
+    float minDist = 0;
+    float maxDist = 0;
+    GetDistances(minX, minZ, maxX, maxZ, minDist, maxDist);
+
+    // the box is closer than the first ring
+    if (minDist < ringDists_[0])
+        return false;
+
+    int ring = 0;
+
+    while ((ring + 1 < NUM_RINGS) && (ringDists_[ring + 1] <= minDist))
+        ++ring;
+
+    int col0 = 0;
+    int col1 = 0;
+
+    if (!GetColumns(minX, minZ, maxX, maxZ, false, col0, col1))
+        return false;
+
+    const float dy        = maxY - camY_;
+    const float elevation = dy / ((dy > 0) ? minDist : maxDist);
+
+    return IsBelow(rings_[ring], col0, col1, elevation);
+}
+
+//---------------------------------------------------------
+// Desc:   the min/max distance (in the XZ plane) from the camera to the rectangle
+//---------------------------------------------------------
+void TerrainHorizon::GetDistances(
+    const float x0,
+    const float z0,
+    const float x1,
+    const float z1,
+    float& outMin,
+    float& outMax) const
+{
+    const float nx = std::clamp(camX_, x0, x1) - camX_;
+    const float nz = std::clamp(camZ_, z0, z1) - camZ_;
+    const float fx = std::max(fabsf(x0 - camX_), fabsf(x1 - camX_));
+    const float fz = std::max(fabsf(z0 - camZ_), fabsf(z1 - camZ_));
+
+    outMin = sqrtf(nx*nx + nz*nz);
+    outMax = sqrtf(fx*fx + fz*fz);
+}
+
+//---------------------------------------------------------
+// Desc:   get the range of columns of the rectangle's azimuths
+// Args:   - fullyCovered: only columns which are fully inside of the azimuths
+//                         (for occluders) or all the touched ones (for occludees)
+// Ret:    false if there are no such columns or the camera is inside of the rectangle
+//---------------------------------------------------------
+bool TerrainHorizon::GetColumns(
+    const float x0,
+    const float z0,
+    const float x1,
+    const float z1,
+    const bool fullyCovered,
+    int& outCol0,
+    int& outCol1) const
+{
+    if ((camX_ >= x0) && (camX_ <= x1) && (camZ_ >= z0) && (camZ_ <= z1))
+        return false;
+
+    // the rectangle covers less than PI (the camera is outside of it) and contains
+    // the direction to its center, so the corners are measured from this direction
+    const float center = WrapAngle(atan2f(0.5f*(x0+x1) - camX_, 0.5f*(z0+z1) - camZ_) - yaw_);
+    const float xs[2]  = { x0 - camX_, x1 - camX_ };
+    const float zs[2]  = { z0 - camZ_, z1 - camZ_ };
+
+    float minOffset = 0;
+    float maxOffset = 0;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const float offset = WrapAngle(atan2f(xs[i & 1], zs[i >> 1]) - yaw_ - center);
+        minOffset = std::min(minOffset, offset);
+        maxOffset = std::max(maxOffset, offset);
+    }
+
+    const float lo = (center + minOffset - startAngle_) * colsPerRad_;
+    const float hi = (center + maxOffset - startAngle_) * colsPerRad_;
+
+    // is out of the frustum by azimuths
+    if ((hi <= 0) || (lo >= NUM_COLUMNS))
+        return false;
+
+    if (fullyCovered)
+    {
+        outCol0 = (int)ceilf(lo);
+        outCol1 = (int)floorf(hi) - 1;
+    }
+    else
+    {
+        outCol0 = (int)floorf(lo);
+        outCol1 = (int)ceilf(hi) - 1;
+    }
+
+    outCol0 = std::max(outCol0, 0);
+    outCol1 = std::min(outCol1, NUM_COLUMNS - 1);
+
+    return outCol0 <= outCol1;
+}
+
+//---------------------------------------------------------
+// Desc:   is the elevation under the horizon in all the columns of the range?
+//---------------------------------------------------------
+bool TerrainHorizon::IsBelow(
+    const float* horizon,
+    const int col0,
+    const int col1,
+    const float elevation) const
+{
+    for (int i = col0; i <= col1; ++i)
+    {
+        if (horizon[i] <= elevation)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace Core
@@ -0,0 +1,93 @@
+// =================================================================================
+// Filename:     TerrainHorizon.h
+// Description:  a horizon buffer for occlusion culling behind hills: the max
+//               elevation (tangent of the angle) of the terrain per column where
+//               a column is a range of azimuths around the camera, so it is the
+//               same as a screen column for a level camera but is valid for any pitch;
+//
+//               - occluders are terrain patches which are added in the order of
+//                 their farthest distance: the patch is solid up to its min height
+//                 so it hides everything below it in the columns it fully covers;
+//               - an occludee (a patch or an entity's box) is hidden if its top is
+//                 below the horizon in all its columns and the horizon is made
+//                 only by the occluders which are closer than the occludee;
+//               - for tests after the whole buffer is built (entities) the buffer
+//                 is snapshotted at distance rings: an occludee is tested against
+//                 the ring which is closer than the occludee's nearest point
+//
+//               everything is conservative (an object can be visible only if the
+//               test says so) and works in 2D distances by the XZ plane
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+
+
+namespace Core
+{
+
+struct CameraParams;
+
+class TerrainHorizon
+{
+public:
+    static constexpr int NUM_COLUMNS = 256;
+    static constexpr int NUM_RINGS   = 8;           // distances of rings: firstRingDist * 2^i
+
+    // setup the buffer for the camera of this frame; the horizon is off for this frame
+    // if the camera looks too steeply up/down (its azimuths cover almost a full circle)
+    void BeginFrame(const CameraParams& camParams, const float firstRingDist);
+
+    // snapshot the rings which aren't reached by occluders yet
+    void EndFrame();
+
+    // the horizon isn't built for this frame (nothing is occluded)
+    inline void Reset() { isActive_ = false; }
+
+    // add a solid box [x0,x1] x [-inf,minY] x [z0,z1];
+    // NOTE: occluders must be added in the order of increasing of their max distance
+    void AddOccluder(const float x0, const float z0, const float x1, const float z1, const float minY);
+
+    // test a box by the current buffer (the caller guarantees that all the occluders
+    // are closer than the box: see AddOccluder)
+    bool IsOccluded(const float x0, const float z0, const float x1, const float z1, const float maxY) const;
+
+    // test a box by the rings (after EndFrame)
+    bool IsOccludedByRings(
+        const float minX, const float minY, const float minZ,
+        const float maxX, const float maxY, const float maxZ) const;
+
+    // the min/max distance (in the XZ plane) from the camera to the rectangle
+    void GetDistances(const float x0, const float z0, const float x1, const float z1, float& outMin, float& outMax) const;
+
+    inline bool IsActive() const { return isActive_; }
+
+private:
+    // the range of columns which are covered by the rectangle (false if it
+    // contains the camera or goes out of the columns range)
+    bool GetColumns(
+        const float x0, const float z0, const float x1, const float z1,
+        const bool fullyCovered,
+        int& outCol0,
+        int& outCol1) const;
+
+    bool IsBelow(const float* horizon, const int col0, const int col1, const float elevation) const;
+
+private:
+    float horizon_[NUM_COLUMNS];
+    float rings_[NUM_RINGS][NUM_COLUMNS];
+    float ringDists_[NUM_RINGS];
+    int   numRingsDone_ = 0;
+
+    float camX_         = 0;
+    float camY_         = 0;
+    float camZ_         = 0;
+    float yaw_          = 0;                // azimuth of the view direction
+    float startAngle_   = 0;                // azimuth of the first column (relatively to yaw_)
+    float colsPerRad_   = 0;
+    bool  isActive_     = false;
+};
+
+} // namespace Core
@@ -0,0 +1,850 @@
+// =================================================================================
+// Filename:     TerrainTileStreamer.cpp
+// Description:  implementation of the TerrainTileStreamer's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "TerrainTileStreamer.h"
+#include "../Texture/TextureMgr.h"
+
+
+namespace Core
+{
+
+//---------------------------------------
+// Desc:   helpers to build a path to a file of tiles and to read/write it
+//---------------------------------------
+static void GetTilePath(
+    char* outPath,
+    const size_t pathSize,
+    const char* dirPath,
+    const int tx,
+    const int tz,
+    const char* ext)
+{
+    snprintf(outPath, pathSize, "%stile_%d_%d.%s", dirPath, tx, tz, ext);
+}
+
+static bool WriteTileFile(const char* path, const uint8* data, const size_t numBytes)
+{
+    FILE* pFile = fopen(path, "wb");
+
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open a file for writing: %s", path);
+        LogErr(g_String);
+        return false;
+    }
+
+    const size_t numWritten = fwrite(data, 1, numBytes, pFile);
+    fclose(pFile);
+
+    return numWritten == numBytes;
+}
+
+
+//---------------------------------------
+// Desc:   read/write the header of tiles (tiles.txt in the directory)
+//---------------------------------------
+static bool WriteTilesHeader(const char* dirPath, const TerrainTilesHeader& header)
+{
+    char path[128]{ '\0' };
+    snprintf(path, sizeof(path), "%stiles.txt", dirPath);
+
+    FILE* pFile = fopen(path, "w");
+
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open a file for writing: %s", path);
+        LogErr(g_String);
+        return false;
+    }
+
+    fprintf(pFile, "tile_size       %d\n", header.tileSize);
+    fprintf(pFile, "patch_size      %d\n", header.patchSize);
+    fprintf(pFile, "tex_tile_size   %d\n", header.texTileSize);
+    fprintf(pFile, "num_tiles_x     %d\n", header.numTilesX);
+    fprintf(pFile, "num_tiles_z     %d\n", header.numTilesZ);
+    fprintf(pFile, "height_scale    %f\n", header.heightScale);
+    fprintf(pFile, "has_tex_maps    %d\n", (int)header.hasTexMaps);
+    fprintf(pFile, "has_light_maps  %d\n", (int)header.hasLightMaps);
+
+    fclose(pFile);
+    return true;
+}
+
+static bool ReadTilesHeader(const char* dirPath, TerrainTilesHeader& outHeader)
+{
+    char path[128]{ '\0' };
+    snprintf(path, sizeof(path), "%stiles.txt", dirPath);
+
+    FILE* pFile = fopen(path, "r");
+
+    if (!pFile)
+        return false;
+
+    char  key[32]{ '\0' };
+    float value = 0;
+
+    while (fscanf(pFile, "%31s %f", key, &value) == 2)
+    {
+        if      (strcmp(key, "tile_size") == 0)      outHeader.tileSize     = (int)value;
+        else if (strcmp(key, "patch_size") == 0)     outHeader.patchSize    = (int)value;
+        else if (strcmp(key, "tex_tile_size") == 0)  outHeader.texTileSize  = (int)value;
+        else if (strcmp(key, "num_tiles_x") == 0)    outHeader.numTilesX    = (int)value;
+        else if (strcmp(key, "num_tiles_z") == 0)    outHeader.numTilesZ    = (int)value;
+        else if (strcmp(key, "height_scale") == 0)   outHeader.heightScale  = value;
+        else if (strcmp(key, "has_tex_maps") == 0)   outHeader.hasTexMaps   = (value != 0);
+        else if (strcmp(key, "has_light_maps") == 0) outHeader.hasLightMaps = (value != 0);
+    }
+
+    fclose(pFile);
+
+    return (outHeader.tileSize > 0) &&
+           (outHeader.patchSize > 1) &&
+           (outHeader.tileSize % outHeader.patchSize == 0) &&
+           (outHeader.numTilesX > 0) &&
+           (outHeader.numTilesZ > 0);
+}
+
+//---------------------------------------
+// Desc:   get the smallest power of 2 which is >= value
+//---------------------------------------
+static int NextPow2(const int value)
+{
+    int pow2 = 1;
+
+    while (pow2 < value)
+        pow2 <<= 1;
+
+    return pow2;
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename T>
+static void RemoveValue(cvector<T>& arr, const T& value)
+{
+    const index idx = arr.find(value);
+
+    if (idx != -1)
+        arr.erase(idx);
+}
+
+
+// =================================================================================
+//                              splitting into tiles
+// =================================================================================
+
+//---------------------------------------------------------
+// Desc:   split the height map (and texture/light maps if they are loaded)
+//         of the terrain into tiles
+// Args:   - terrain:        the source of maps
+//         - dirPath:        where to write tiles (must end with '/')
+//         - patchSize:      size of a geomipmapping patch (in vertices)
+//         - patchesPerTile: the number of patches by a side of a tile
+//---------------------------------------------------------
+bool TerrainTileStreamer::SplitTerrain(
+    const TerrainBase& terrain,
+    const char* dirPath,
+    const int patchSize,
+    const int patchesPerTile)
+{
+    try
+    {
+        const Image& heightMap = terrain.heightMap_;
+        const Image& texMap    = terrain.texture_;
+        const LightmapData& lightMap = terrain.lightmap_;
+
+        const int mapSize  = (int)heightMap.GetWidth();
+        const int tileSize = patchSize * patchesPerTile;
+
+        CAssert::True(heightMap.GetData() != nullptr,        "the terrain has no height map");
+        CAssert::True((patchSize > 1) && (patchesPerTile > 0), "wrong size of tiles");
+        CAssert::True(mapSize > tileSize,                    "the height map is smaller than a tile");
+
+        TerrainTilesHeader header;
+        header.tileSize     = tileSize;
+        header.patchSize    = patchSize;
+        header.texTileSize  = NextPow2(tileSize);
+        header.numTilesX    = (mapSize - 1) / tileSize;
+        header.numTilesZ    = (mapSize - 1) / tileSize;
+        header.heightScale  = terrain.GetHeightScale();
+        header.hasTexMaps   = (texMap.GetData() != nullptr) && (texMap.GetBPP() == 24);
+        header.hasLightMaps = (lightMap.pData != nullptr);
+
+        std::filesystem::create_directories(dirPath);
+
+        const int heightsSize = tileSize + 2;
+        const int texSize     = header.texTileSize;
+        const int maxCoord    = mapSize - 1;
+
+        // tile-local UVs of the geomipmapped grid are (pos / heightsSize) so a texel
+        // of the tile's maps covers (heightsSize / texSize) of height map texels
+        const float texelToHeight = (float)heightsSize / (float)texSize;
+        const float texRatio      = (header.hasTexMaps)   ? (float)texMap.GetWidth() / (float)mapSize : 0.0f;
+        const float lightRatio    = (header.hasLightMaps) ? (float)lightMap.size     / (float)mapSize : 0.0f;
+
+        cvector<uint8> heights(heightsSize * heightsSize);
+        cvector<uint8> texels (texSize * texSize * 3);
+        cvector<uint8> light  (texSize * texSize);
+        char path[128]{ '\0' };
+
+        for (int tz = 0; tz < header.numTilesZ; ++tz)
+        {
+            for (int tx = 0; tx < header.numTilesX; ++tx)
+            {
+                const int x0 = tx * tileSize;
+                const int z0 = tz * tileSize;
+
+                // heights (the borders are duplicated in adjacent tiles)
+                for (int j = 0, i = 0; j < heightsSize; ++j)
+                {
+                    const int z = std::min(z0 + j, maxCoord);
+
+                    for (int k = 0; k < heightsSize; ++k, ++i)
+                        heights[i] = heightMap.GetPixelGray(std::min(x0 + k, maxCoord), z);
+                }
+
+                GetTilePath(path, sizeof(path), dirPath, tx, tz, "height");
+                CAssert::True(WriteTileFile(path, heights.data(), heights.size()), "can't write heights of a tile");
+
+                // texture map
+                if (header.hasTexMaps)
+                {
+                    const int maxTex = (int)texMap.GetWidth() - 1;
+
+                    for (int j = 0, i = 0; j < texSize; ++j)
+                    {
+                        const float z = z0 + (j + 0.5f) * texelToHeight;
+                        const uint  v = (uint)std::min((int)(z * texRatio), maxTex);
+
+                        for (int k = 0; k < texSize; ++k, i += 3)
+                        {
+                            const float x = x0 + (k + 0.5f) * texelToHeight;
+                            const uint  u = (uint)std::min((int)(x * texRatio), maxTex);
+
+                            texMap.GetColor(u, v, texels[i+0], texels[i+1], texels[i+2]);
+                        }
+                    }
+
+                    GetTilePath(path, sizeof(path), dirPath, tx, tz, "tex");
+                    CAssert::True(WriteTileFile(path, texels.data(), texels.size()), "can't write a texture map of a tile");
+                }
+
+                // light map
+                if (header.hasLightMaps)
+                {
+                    const int maxLight = lightMap.size - 1;
+
+                    for (int j = 0, i = 0; j < texSize; ++j)
+                    {
+                        const float z = z0 + (j + 0.5f) * texelToHeight;
+                        const int   v = std::min((int)(z * lightRatio), maxLight);
+
+                        for (int k = 0; k < texSize; ++k, ++i)
+                        {
+                            const float x = x0 + (k + 0.5f) * texelToHeight;
+                            const int   u = std::min((int)(x * lightRatio), maxLight);
+
+                            light[i] = lightMap.pData[(v * lightMap.size) + u];
+                        }
+                    }
+
+                    GetTilePath(path, sizeof(path), dirPath, tx, tz, "light");
+                    CAssert::True(WriteTileFile(path, light.data(), light.size()), "can't write a light map of a tile");
+                }
+            }
+        }
+
+        CAssert::True(WriteTilesHeader(dirPath, header), "can't write the header of tiles");
+
+        LogMsgf("terrain is split into %dx%d tiles (%s)", header.numTilesX, header.numTilesZ, dirPath);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't split the terrain into tiles");
+        return false;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   split a RAW 8-bit height map (mapSize x mapSize) into tiles;
+//         rows are read by bands so a huge map is never loaded at once
+//---------------------------------------------------------
+bool TerrainTileStreamer::SplitRawHeightMap(
+    const char* rawPath,
+    const int mapSize,
+    const float heightScale,
+    const char* dirPath,
+    const int patchSize,
+    const int patchesPerTile)
+{
+    FILE* pSrc = nullptr;
+
+    try
+    {
+        const int tileSize = patchSize * patchesPerTile;
+
+        CAssert::True((patchSize > 1) && (patchesPerTile > 0), "wrong size of tiles");
+        CAssert::True(mapSize > tileSize,                      "the height map is smaller than a tile");
+
+        pSrc = fopen(rawPath, "rb");
+        CAssert::True(pSrc != nullptr, "can't open the RAW height map");
+
+        TerrainTilesHeader header;
+        header.tileSize    = tileSize;
+        header.patchSize   = patchSize;
+        header.texTileSize = NextPow2(tileSize);
+        header.numTilesX   = (mapSize - 1) / tileSize;
+        header.numTilesZ   = (mapSize - 1) / tileSize;
+        header.heightScale = heightScale;
+
+        std::filesystem::create_directories(dirPath);
+
+        const int heightsSize = tileSize + 2;
+        const int maxCoord    = mapSize - 1;
+
+        cvector<uint8> band(heightsSize * mapSize);              // rows of a single row of tiles
+        cvector<uint8> heights(heightsSize * heightsSize);
+        char path[128]{ '\0' };
+
+        for (int tz = 0; tz < header.numTilesZ; ++tz)
+        {
+            const int z0 = tz * tileSize;
+
+            for (int j = 0; j < heightsSize; ++j)
+            {
+                const long row = (long)std::min(z0 + j, maxCoord);
+
+                fseek(pSrc, row * mapSize, SEEK_SET);
+                const size_t numRead = fread(band.data() + (j * mapSize), 1, mapSize, pSrc);
+                CAssert::True(numRead == (size_t)mapSize, "the RAW height map is smaller than expected");
+            }
+
+            for (int tx = 0; tx < header.numTilesX; ++tx)
+            {
+                const int x0 = tx * tileSize;
+
+                for (int j = 0, i = 0; j < heightsSize; ++j)
+                {
+                    const uint8* rowData = band.data() + (j * mapSize);
+
+                    for (int k = 0; k < heightsSize; ++k, ++i)
+                        heights[i] = rowData[std::min(x0 + k, maxCoord)];
+                }
+
+                GetTilePath(path, sizeof(path), dirPath, tx, tz, "height");
+                CAssert::True(WriteTileFile(path, heights.data(), heights.size()), "can't write heights of a tile");
+            }
+        }
+
+        fclose(pSrc);
+
+        CAssert::True(WriteTilesHeader(dirPath, header), "can't write the header of tiles");
+
+        LogMsgf("RAW height map (%s) is split into %dx%d tiles", rawPath, header.numTilesX, header.numTilesZ);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        if (pSrc)
+            fclose(pSrc);
+
+        LogErr(e);
+        sprintf(g_String, "can't split the RAW height map into tiles: %s", rawPath);
+        LogErr(g_String);
+        return false;
+    }
+}
+
+
+// =================================================================================
+//                              streaming
+// =================================================================================
+
+bool TerrainTileStreamer::Initialize(
+    ID3D11Device* pDevice,
+    const TerrainStreamingParams& params,
+    const TerrainGeomipmapped* pSource)
+{
+    try
+    {
+        CAssert::True(pDevice != nullptr,          "input ptr to the device == nullptr");
+        CAssert::True(params.maxResidentTiles > 0, "the budget of resident tiles must be > 0");
+
+        Shutdown();
+
+        pDevice_ = pDevice;
+        params_  = params;
+        header_  = TerrainTilesHeader();
+
+        // there are no tiles yet so we split the loaded terrain
+        if (!ReadTilesHeader(params.dirPath, header_))
+        {
+            CAssert::True(pSource && pSource->heightMap_.GetData(), "there are no terrain tiles and no height map to split");
+
+            sprintf(g_String, "terrain tiles aren't found (%s): split the loaded terrain", params.dirPath);
+            LogMsg(g_String);
+
+            const bool result = SplitTerrain(*pSource, params.dirPath, pSource->patchSize_, params.patchesPerTile);
+            CAssert::True(result, "can't split the terrain into tiles");
+
+            header_ = TerrainTilesHeader();
+            CAssert::True(ReadTilesHeader(params.dirPath, header_), "can't read the header of terrain tiles");
+        }
+
+        numSlots_ = params.maxResidentTiles;
+        slots_    = new TerrainTileSlot[numSlots_];
+        frameIdx_ = 0;
+
+        isActive_ = true;
+
+        LogMsgf("terrain streaming is initialized (tiles: %dx%d of %d texels, budget: %d tiles)",
+            header_.numTilesX, header_.numTilesZ, header_.tileSize, numSlots_);
+        return true;
+    }
+    catch (const std::bad_alloc& e)
+    {
+        LogErr(e.what());
+        LogErr("can't allocate memory for terrain tiles");
+        Shutdown();
+        return false;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't initialize the terrain streaming");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void TerrainTileStreamer::Shutdown()
+{
+    // each request is completed (at least as cancelled) so all the
+    // tiles which are being loaded come into loaded_
+    for (TerrainTileData* pData : loading_)
+        CancelLoad(*pData);
+
+    g_JobSystem.Wait(ioCounter_);
+
+    for (TerrainTileData* pData : loaded_)
+        delete pData;
+
+    for (TerrainTileData* pData : readyData_)
+        delete pData;
+
+    loaded_.clear();
+    loading_.clear();
+    readyData_.clear();
+    requested_.clear();
+    brokenTiles_.clear();
+    desired_.clear();
+    desiredDist_.clear();
+    missing_.clear();
+
+    // NOTE: textures of slots stay in the textures manager (it has no removal)
+    SafeDeleteArr(slots_);
+    numSlots_ = 0;
+    isActive_ = false;
+}
+
+//---------------------------------------------------------
+// Desc:   update the residency of tiles by the camera and update
+//         the geomipmapping of the resident tiles which are visible
+//---------------------------------------------------------
+void TerrainTileStreamer::Update(const CameraParams& camParams)
+{
+    if (!isActive_)
+        return;
+
+    ++frameIdx_;
+
+    const float tileSize   = (float)header_.tileSize;
+    const float camX       = camParams.posX;
+    const float camZ       = camParams.posZ;
+    const float radius     = params_.loadRadius;
+    const int   numTilesX  = header_.numTilesX;
+    const int   numTilesZ  = header_.numTilesZ;
+
+    // ---------------------------------------------
+    // tiles around the camera sorted by the distance (the nearest first)
+
+    const int r      = (int)ceilf(radius / tileSize);
+    const int camTx  = (int)floorf(camX / tileSize);
+    const int camTz  = (int)floorf(camZ / tileSize);
+
+    desired_.clear();
+    desiredDist_.clear();
+
+    for (int tz = std::max(camTz - r, 0); tz <= std::min(camTz + r, numTilesZ - 1); ++tz)
+    {
+        for (int tx = std::max(camTx - r, 0); tx <= std::min(camTx + r, numTilesX - 1); ++tx)
+        {
+            // the distance to the tile's rectangle
+            const float x0   = tx * tileSize;
+            const float z0   = tz * tileSize;
+            const float dx   = std::max(std::max(x0 - camX, 0.0f), camX - (x0 + tileSize));
+            const float dz   = std::max(std::max(z0 - camZ, 0.0f), camZ - (z0 + tileSize));
+            const float dist = sqrtf(dx*dx + dz*dz);
+
+            if (dist > radius)
+                continue;
+
+            // insert sorted by distance
+            desired_.push_back(tz * numTilesX + tx);
+            desiredDist_.push_back(dist);
+
+            for (vsize i = desired_.size() - 1; (i > 0) && (desiredDist_[i-1] > desiredDist_[i]); --i)
+            {
+                std::swap(desired_[i], desired_[i-1]);
+                std::swap(desiredDist_[i], desiredDist_[i-1]);
+            }
+        }
+    }
+
+    // we can't keep more tiles than the budget
+    while ((int)desired_.size() > numSlots_)
+    {
+        desired_.pop_back();
+        desiredDist_.pop_back();
+    }
+
+    // ---------------------------------------------
+    // mark resident tiles as used and collect missing ones
+
+    missing_.clear();
+
+    for (const int key : desired_)
+    {
+        const int slotIdx = FindSlot(key);
+
+        if (slotIdx != -1)
+            slots_[slotIdx].lastUsedFrame = frameIdx_;
+
+        else if (!requested_.has_value(key) && !brokenTiles_.has_value(key))
+            missing_.push_back(key);
+    }
+
+    // ---------------------------------------------
+    // tiles which are being loaded: the camera could move away from them so
+    // they are cancelled (their files aren't read if they are still pending),
+    // else the priority of their reads follows the current distance
+
+    for (TerrainTileData* pData : loading_)
+    {
+        if (pData->isCanceled)
+            continue;
+
+        const int   key = pData->tz * numTilesX + pData->tx;
+        const index idx = desired_.find(key);
+
+        if (idx == -1)
+        {
+            CancelLoad(*pData);
+            continue;
+        }
+
+        for (const IoRequestID id : pData->ioRequests)
+            g_IoScheduler.SetPriority(id, -desiredDist_[idx]);
+    }
+
+    // missing tiles are in the desired order (the nearest first)
+    for (const int key : missing_)
+        StartLoad(key, desiredDist_[desired_.find(key)]);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (TerrainTileData* pData : loaded_)
+        {
+            RemoveValue(loading_, pData);
+            readyData_.push_back(pData);
+        }
+
+        loaded_.clear();
+    }
+
+    // ---------------------------------------------
+    // build a few loaded tiles (uploading to GPU)
+
+    int numBuilds = 0;
+
+    while (!readyData_.empty() && (numBuilds < MAX_BUILDS_PER_FRAME))
+    {
+        TerrainTileData* pData = readyData_[0];
+        readyData_.erase(0);
+
+        const int key = pData->tz * numTilesX + pData->tx;
+        RemoveValue(requested_, key);
+
+        // the tile went out of the radius while it was loaded
+        if (pData->isCanceled)
+        {
+            delete pData;
+            continue;
+        }
+
+        if (!pData->isLoaded)
+        {
+            sprintf(g_String, "can't load terrain tile (%d, %d)", pData->tx, pData->tz);
+            LogErr(g_String);
+            brokenTiles_.push_back(key);
+        }
+        // the tile is still needed
+        else if (IsDesired(key) && (FindSlot(key) == -1))
+        {
+            const int slotIdx = AcquireSlot();
+
+            // if there is no slot the tile will be requested again later
+            if (slotIdx != -1)
+            {
+                if (!BuildTile(slots_[slotIdx], *pData, slotIdx))
+                    brokenTiles_.push_back(key);
+
+                numBuilds++;
+            }
+        }
+
+        delete pData;
+    }
+
+    // ---------------------------------------------
+    // cull patches and choose LODs of the visible tiles
+
+    for (int i = 0; i < numSlots_; ++i)
+    {
+        if (IsSlotVisible(i))
+            slots_[i].terrain.Update(camParams);
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   get the scaled height of the streamed terrain at point (x,z)
+//---------------------------------------------------------
+bool TerrainTileStreamer::GetHeightAtPoint(const float x, const float z, float& outHeight) const
+{
+    if (!isActive_)
+        return false;
+
+    const float tileSize = (float)header_.tileSize;
+    const int   tx       = (int)floorf(x / tileSize);
+    const int   tz       = (int)floorf(z / tileSize);
+
+    if ((tx < 0) || (tz < 0) || (tx >= header_.numTilesX) || (tz >= header_.numTilesZ))
+        return false;
+
+    const int slotIdx = FindSlot(tz * header_.numTilesX + tx);
+
+    if (slotIdx == -1)
+        return false;
+
+    const TerrainGeomipmapped& terrain = slots_[slotIdx].terrain;
+    outHeight = terrain.GetScaledInterpolatedHeightAtPoint(x - terrain.originX_, z - terrain.originZ_);
+    return true;
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+
+//---------------------------------------------------------
+// Desc:   request reads of files of the tile by the I/O scheduler (a nearer
+//         tile is read first); the job of the last completed file passes
+//         the tile to the main thread
+//---------------------------------------------------------
+void TerrainTileStreamer::StartLoad(const int key, const float dist)
+{
+    TerrainTileData* pData = new TerrainTileData;
+    pData->tx = key % header_.numTilesX;
+    pData->tz = key / header_.numTilesX;
+
+    const int heightsSize = header_.tileSize + 2;
+    const int texSize     = header_.texTileSize;
+
+    struct TileFile
+    {
+        const char*     ext;
+        cvector<uint8>* pOut;
+        size_t          numBytes;
+    };
+
+    TileFile files[TerrainTileData::NUM_FILES];
+    int      numFiles = 0;
+
+    files[numFiles++] = { "height", &pData->heights, (size_t)(heightsSize * heightsSize) };
+
+    if (header_.hasTexMaps)
+        files[numFiles++] = { "tex", &pData->texels, (size_t)(texSize * texSize * 3) };
+
+    if (header_.hasLightMaps)
+        files[numFiles++] = { "light", &pData->light, (size_t)(texSize * texSize) };
+
+    pData->numPendingFiles = numFiles;
+    loading_.push_back(pData);
+    requested_.push_back(key);
+
+    for (int i = 0; i < numFiles; ++i)
+    {
+        char path[128]{ '\0' };
+        GetTilePath(path, sizeof(path), params_.dirPath, pData->tx, pData->tz, files[i].ext);
+
+        cvector<uint8>* pOut     = files[i].pOut;
+        const size_t    numBytes = files[i].numBytes;
+
+        // a file of an unexpected size is treated as a missing one (and the tile
+        // without heights is broken); texture/light maps are optional
+        pData->ioRequests[i] = g_IoScheduler.Request(path, -dist, [this, pData, pOut, numBytes](IoCompletion& completion)
+        {
+            MEM_TAG_SCOPE(MEM_TAG_TERRAIN);
+
+            if ((completion.status == IO_STATUS_DONE) && (completion.size == numBytes))
+            {
+                pOut->resize(numBytes);
+                memcpy(pOut->data(), completion.data, numBytes);
+            }
+
+            SafeDeleteArr(completion.data);
+
+            if (pData->numPendingFiles.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                pData->isLoaded = !pData->heights.empty();
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                loaded_.push_back(pData);
+            }
+        }, &ioCounter_);
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   the tile isn't needed anymore: its files which aren't read
+//         yet won't be read at all (the tile still comes into loaded_)
+//---------------------------------------------------------
+void TerrainTileStreamer::CancelLoad(TerrainTileData& data)
+{
+    data.isCanceled = true;
+
+    for (const IoRequestID id : data.ioRequests)
+        g_IoScheduler.Cancel(id);
+}
+
+//---------------------------------------------------------
+// Desc:   build a geomipmapped terrain of the tile in the slot
+//         (GPU resources of the slot's prev tile are reused)
+//---------------------------------------------------------
+bool TerrainTileStreamer::BuildTile(
+    TerrainTileSlot& slot,
+    const TerrainTileData& data,
+    const int slotIdx)
+{
+    TerrainGeomipmapped& terrain = slot.terrain;
+
+    const int tileSize    = header_.tileSize;
+    const int heightsSize = tileSize + 2;
+    const int texSize     = header_.texTileSize;
+
+    // the slot is free till the tile is built
+    slot.key = -1;
+
+    if (!terrain.heightMap_.Create(heightsSize, heightsSize, 8))
+        return false;
+
+    memcpy(terrain.heightMap_.GetData(), data.heights.data(), heightsSize * heightsSize);
+
+    terrain.SetHeightScale(header_.heightScale);
+    terrain.SetOrigin((float)(data.tx * tileSize), (float)(data.tz * tileSize));
+
+    if (!terrain.InitGeomipmapping(header_.patchSize))
+        return false;
+
+    if (!terrain.InitBuffers(pDevice_, terrain.vertices_, terrain.indices_, terrain.numVertices_, terrain.numIndices_))
+        return false;
+
+    // the CPU copy of the grid isn't needed after uploading
+    terrain.ClearMemory();
+
+    // texture/light maps of the tile
+    constexpr bool mipMapped = true;
+    char texName[48]{ '\0' };
+
+    if (!data.texels.empty())
+    {
+        snprintf(texName, sizeof(texName), "terrain_tile_tex_%d", slotIdx);
+
+        if (slot.texMapID == INVALID_TEXTURE_ID)
+            slot.texMapID = g_TextureMgr.CreateTextureFromRawData(texName, data.texels.data(), texSize, texSize, 24, mipMapped);
+        else
+            g_TextureMgr.RecreateTextureFromRawData(texName, data.texels.data(), texSize, texSize, 24, mipMapped, g_TextureMgr.GetTexByID(slot.texMapID));
+    }
+
+    if (!data.light.empty())
+    {
+        snprintf(texName, sizeof(texName), "terrain_tile_light_%d", slotIdx);
+
+        if (slot.lightMapID == INVALID_TEXTURE_ID)
+            slot.lightMapID = g_TextureMgr.CreateTextureFromRawData(texName, data.light.data(), texSize, texSize, 8, mipMapped);
+        else
+            g_TextureMgr.RecreateTextureFromRawData(texName, data.light.data(), texSize, texSize, 8, mipMapped, g_TextureMgr.GetTexByID(slot.lightMapID));
+    }
+
+    slot.key           = data.tz * header_.numTilesX + data.tx;
+    slot.lastUsedFrame = frameIdx_;
+
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   get an idx of the slot with the tile by key (-1 if not resident)
+//---------------------------------------------------------
+int TerrainTileStreamer::FindSlot(const int key) const
+{
+    for (int i = 0; i < numSlots_; ++i)
+    {
+        if (slots_[i].key == key)
+            return i;
+    }
+
+    return -1;
+}
+
+//---------------------------------------------------------
+// Desc:   get a free slot or a slot of the tile which wasn't used for the
+//         longest time (tiles which are used in the current frame are kept);
+//         return -1 if all the slots are in use
+//---------------------------------------------------------
+int TerrainTileStreamer::AcquireSlot(void) const
+{
+    int    lruIdx   = -1;
+    uint32 lruFrame = frameIdx_;
+
+    for (int i = 0; i < numSlots_; ++i)
+    {
+        if (slots_[i].key == -1)
+            return i;
+
+        if (slots_[i].lastUsedFrame < lruFrame)
+        {
+            lruFrame = slots_[i].lastUsedFrame;
+            lruIdx   = i;
+        }
+    }
+
+    return lruIdx;
+}
+
+///////////////////////////////////////////////////////////
+
+bool TerrainTileStreamer::IsDesired(const int key) const
+{
+    return desired_.has_value(key);
+}
+
+} // namespace Core
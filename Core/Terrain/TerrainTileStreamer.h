@@ -0,0 +1,186 @@
+// =================================================================================
+// Filename:     TerrainTileStreamer.h
+// Description:  streaming of a large terrain by tiles: the height map (and the
+//               texture/light maps) is split into fixed-size tiles on disk once;
+//               at runtime files of the tiles around the camera are read by the
+//               I/O scheduler (the nearest first, tiles which went out of the load
+//               radius are cancelled) and each resident tile is rendered as a small
+//               geomipmapped terrain (with its own culling and LODs);
+//
+//               the number of resident tiles is limited by a budget: when a new
+//               tile is loaded it takes a free slot or a slot of the tile which
+//               wasn't used for the longest time (its GPU resources are reused)
+//
+//               the directory of tiles:
+//                 tiles.txt            - header (tile size, number of tiles, etc.)
+//                 tile_<x>_<z>.height  - (tileSize+2)^2 8-bit heights
+//                                        (adjacent tiles share their border heights)
+//                 tile_<x>_<z>.tex     - texTileSize^2 RGB texture map (optional)
+//                 tile_<x>_<z>.light   - texTileSize^2 8-bit light map (optional)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "TerrainGeomipmapped.h"
+
+#include <IoScheduler.h>
+#include <JobSystem.h>
+#include <atomic>
+#include <mutex>
+
+
+namespace Core
+{
+
+// =================================================================================
+// Data structures
+// =================================================================================
+struct TerrainStreamingParams
+{
+    char  dirPath[64]      = "data/terrain/tiles/";
+    int   patchesPerTile   = 8;         // tile size (in patches) is used only when tiles are split
+    int   maxResidentTiles = 16;        // residency budget
+    float loadRadius       = 500;       // tiles closer than this are loaded (in world units)
+};
+
+///////////////////////////////////////////////////////////
+
+struct TerrainTilesHeader
+{
+    int   tileSize     = 0;             // in height map texels (a multiple of the patch size)
+    int   patchSize    = 0;
+    int   texTileSize  = 0;             // size of texture/light maps of a tile (a power of 2)
+    int   numTilesX    = 0;
+    int   numTilesZ    = 0;
+    float heightScale  = 1.0f;
+    bool  hasTexMaps   = false;
+    bool  hasLightMaps = false;
+};
+
+///////////////////////////////////////////////////////////
+
+struct TerrainTileData
+{
+    // raw data of a tile; its files are read by the I/O scheduler
+    // and each one is copied here by the job of its completion
+    static constexpr int NUM_FILES = 3;             // heights, texture map, light map
+
+    int              tx = 0;
+    int              tz = 0;
+    cvector<uint8>   heights;
+    cvector<uint8>   texels;
+    cvector<uint8>   light;
+    IoRequestID      ioRequests[NUM_FILES]{ INVALID_IO_REQUEST_ID, INVALID_IO_REQUEST_ID, INVALID_IO_REQUEST_ID };
+    std::atomic<int> numPendingFiles = 0;          // the last completed file passes the tile to the main thread
+    bool             isLoaded   = false;
+    bool             isCanceled = false;            // is set by the main thread
+};
+
+///////////////////////////////////////////////////////////
+
+struct TerrainTileSlot
+{
+    // a resident tile
+    TerrainGeomipmapped terrain;
+    TexID               texMapID      = INVALID_TEXTURE_ID;
+    TexID               lightMapID    = INVALID_TEXTURE_ID;
+    int                 key           = -1;         // tz*numTilesX + tx (-1 if the slot is free)
+    uint32              lastUsedFrame = 0;
+};
+
+// =================================================================================
+// Class
+// =================================================================================
+class TerrainTileStreamer
+{
+public:
+    TerrainTileStreamer() {}
+    ~TerrainTileStreamer() { Shutdown(); }
+
+    // restrict a copying of this class instance
+    TerrainTileStreamer(const TerrainTileStreamer&) = delete;
+    TerrainTileStreamer& operator=(const TerrainTileStreamer&) = delete;
+
+    // split the loaded maps of the terrain into tiles
+    static bool SplitTerrain(
+        const TerrainBase& terrain,
+        const char* dirPath,
+        const int patchSize,
+        const int patchesPerTile);
+
+    // split a RAW 8-bit height map into tiles without loading all of it
+    // (only a band of rows per row of tiles is in memory)
+    static bool SplitRawHeightMap(
+        const char* rawPath,
+        const int mapSize,
+        const float heightScale,
+        const char* dirPath,
+        const int patchSize,
+        const int patchesPerTile);
+
+    // read the header of tiles (files of tiles are read by g_IoScheduler); if there are no tiles
+    // on disk yet and pSource has a height map then it is split into tiles before
+    bool Initialize(
+        ID3D11Device* pDevice,
+        const TerrainStreamingParams& params,
+        const TerrainGeomipmapped* pSource);
+
+    void Shutdown();
+
+    // choose tiles around the camera, request loading of missing ones, build
+    // a few loaded tiles and update (cull, choose LODs) the visible resident tiles
+    void Update(const CameraParams& camParams);
+
+    // get the scaled height by the resident tile under the point (false if there is no such tile)
+    bool GetHeightAtPoint(const float x, const float z, float& outHeight) const;
+
+    // is the slot's tile drawn in the current frame?
+    inline bool IsSlotVisible(const int i)        const { return (slots_[i].key != -1) && (slots_[i].lastUsedFrame == frameIdx_); }
+
+    inline bool                   IsActive()      const { return isActive_; }
+    inline int                    GetNumSlots()   const { return numSlots_; }
+    inline TerrainTileSlot&       GetSlot(const int i)  { return slots_[i]; }
+    inline const TerrainTilesHeader& GetHeader()  const { return header_; }
+
+    // size of the whole streamed terrain in world units
+    inline float GetWorldSizeX() const { return (float)(header_.numTilesX * header_.tileSize); }
+    inline float GetWorldSizeZ() const { return (float)(header_.numTilesZ * header_.tileSize); }
+
+private:
+    void StartLoad(const int key, const float dist);
+    void CancelLoad(TerrainTileData& data);
+    bool BuildTile(TerrainTileSlot& slot, const TerrainTileData& data, const int slotIdx);
+    int  FindSlot(const int key) const;
+    int  AcquireSlot(void) const;
+    bool IsDesired(const int key) const;
+
+private:
+    ID3D11Device*           pDevice_    = nullptr;
+    TerrainTilesHeader      header_;
+    TerrainStreamingParams  params_;
+
+    TerrainTileSlot*        slots_      = nullptr;  // resident tiles (the budget)
+    int                     numSlots_   = 0;
+    uint32                  frameIdx_   = 0;
+
+    // main thread only
+    cvector<int>            desired_;               // keys of tiles around the camera (the nearest first)
+    cvector<float>          desiredDist_;
+    cvector<int>            missing_;               // desired keys which aren't resident
+    cvector<int>            requested_;             // keys which are being loaded
+    cvector<int>            brokenTiles_;           // keys of tiles which can't be loaded
+    cvector<TerrainTileData*> loading_;             // tiles whose files are being read
+    cvector<TerrainTileData*> readyData_;           // loaded tiles which wait for building
+
+    // shared with jobs of I/O completions (guarded by mutex_)
+    std::mutex              mutex_;
+    cvector<TerrainTileData*> loaded_;              // results of loading
+    JobCounter              ioCounter_;             // a fence for completions of all the requests
+
+    bool                    isActive_   = false;
+
+    static constexpr int    MAX_BUILDS_PER_FRAME = 2;   // GPU uploads of new tiles per frame
+};
+
+} // namespace Core
@@ -0,0 +1,511 @@
+// =================================================================================
+// Filename:     TerrainVirtualTexture.cpp
+// Description:  implementation of the TerrainVirtualTexture's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "TerrainVirtualTexture.h"
+#include <JobSystem.h>
+#include <Profiler.h>
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// Desc:   create GPU resources of the virtual texture and prepare the splat
+//         inputs; pages are baked by Update() (the first one is the page of
+//         the last mip so the texture can be sampled after the first update)
+//---------------------------------------------------------
+bool TerrainVirtualTexture::Initialize(
+    ID3D11Device* pDevice,
+    Render::VirtualTexture& vt,
+    const TerrainVTParams& params,
+    TerrainBase* pTerrain)
+{
+    if (!pTerrain || !pTerrain->heightMap_.IsLoaded())
+    {
+        LogErr("can't initialize the terrain virtual texture: there is no height map");
+        return false;
+    }
+
+    pTerrain_ = pTerrain;
+    params_   = params;
+
+    if (!BuildTileMips())
+    {
+        LogErr("can't initialize the terrain virtual texture: there are no tiles to bake pages from");
+        return false;
+    }
+
+    Render::VirtualTextureParams vtParams;
+    vtParams.virtualSize       = (UINT)params.virtualSize;
+    vtParams.pageSize          = (UINT)params.pageSize;
+    vtParams.cachePagesPerSide = (UINT)params.cachePagesPerSide;
+
+    if (!vt.Initialize(pDevice, vtParams))
+        return false;
+
+    // the page table has the layout of the feedback
+    numMips_      = (int)vt.GetNumMips();
+    pagesPerSide_ = (int)vt.GetPagesPerSide();
+    numEntries_   = (int)vt.GetNumEntries();
+    border_       = (int)vtParams.border;
+    slotsPerSide_ = params.cachePagesPerSide;
+
+    for (int mip = 0; mip < numMips_; ++mip)
+        mipOffsets_[mip] = (int)vt.GetMipOffset(mip);
+
+    pageToSlot_.resize(numEntries_);
+    requestMarks_.resize(numEntries_);
+    indirection_.resize(numEntries_);
+    slots_.resize(slotsPerSide_ * slotsPerSide_);
+
+    const int maxBakes     = std::max(1, params.maxBakesPerFrame);
+    const int slotSize     = (int)vt.GetPageSizeWithBorders();
+    bakeTexels_.resize(maxBakes * slotSize * slotSize * 4);
+    bakePages_.reserve(maxBakes);
+    bakeSlots_.reserve(maxBakes);
+
+    DropPages();
+
+    isInit_ = true;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void TerrainVirtualTexture::Shutdown()
+{
+    for (int i = 0; i < TRN_NUM_TILES; ++i)
+    {
+        for (int mip = 0; mip < MAX_TILE_MIPS; ++mip)
+            tileMips_[i][mip] = TerrainVTTileMip();
+
+        numTileMips_[i] = 0;
+    }
+
+    pageToSlot_.clear();
+    requestMarks_.clear();
+    slots_.clear();
+    indirection_.clear();
+    requests_.clear();
+    bakeTexels_.clear();
+
+    pTerrain_ = nullptr;
+    numTiles_ = 0;
+    isReady_  = false;
+    isInit_   = false;
+}
+
+//---------------------------------------------------------
+// Desc:   copy loaded tiles into RGB8 mip chains and compute blend factors
+//         by heights (the same as for the generated texture map)
+// Ret:    false if there are no tiles
+//---------------------------------------------------------
+bool TerrainVirtualTexture::BuildTileMips()
+{
+    memset(blendFactors_, 0, sizeof(blendFactors_));
+    numTiles_      = pTerrain_->ComputeTileBlendFactors(loadedTilesIdxs_, blendFactors_);
+    texMapVersion_ = pTerrain_->texMapVersion_;
+
+    for (int i = 0; i < numTiles_; ++i)
+    {
+        const Image& tile   = pTerrain_->tiles_.textureTiles[loadedTilesIdxs_[i]];
+        const int    width  = (int)tile.GetWidth();
+        const int    height = (int)tile.GetHeight();
+
+        // mip 0 is the tile as is
+        TerrainVTTileMip& top = tileMips_[i][0];
+        top.width  = width;
+        top.height = height;
+        top.texels.resize(width * height * 3);
+
+        for (int z = 0; z < height; ++z)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                uint8* pTexel = top.texels.data() + (z * width + x) * 3;
+                tile.GetColor(x, z, pTexel[0], pTexel[1], pTexel[2]);
+            }
+        }
+
+        // 2x2 box filter down to a single texel: a page of a coarse mip is
+        // blended from tiles of the same scale (so it doesn't alias)
+        int numMips = 1;
+
+        while ((numMips < MAX_TILE_MIPS) &&
+               ((tileMips_[i][numMips - 1].width > 1) || (tileMips_[i][numMips - 1].height > 1)))
+        {
+            const TerrainVTTileMip& src = tileMips_[i][numMips - 1];
+            TerrainVTTileMip&       dst = tileMips_[i][numMips];
+
+            dst.width  = std::max(1, src.width >> 1);
+            dst.height = std::max(1, src.height >> 1);
+            dst.texels.resize(dst.width * dst.height * 3);
+
+            for (int z = 0; z < dst.height; ++z)
+            {
+                const int z0 = std::min(z * 2,     src.height - 1);
+                const int z1 = std::min(z * 2 + 1, src.height - 1);
+
+                for (int x = 0; x < dst.width; ++x)
+                {
+                    const int x0 = std::min(x * 2,     src.width - 1);
+                    const int x1 = std::min(x * 2 + 1, src.width - 1);
+
+                    const uint8* p00 = src.texels.data() + (z0 * src.width + x0) * 3;
+                    const uint8* p01 = src.texels.data() + (z0 * src.width + x1) * 3;
+                    const uint8* p10 = src.texels.data() + (z1 * src.width + x0) * 3;
+                    const uint8* p11 = src.texels.data() + (z1 * src.width + x1) * 3;
+                    uint8*       pDst = dst.texels.data() + (z * dst.width + x) * 3;
+
+                    for (int c = 0; c < 3; ++c)
+                        pDst[c] = (uint8)((p00[c] + p01[c] + p10[c] + p11[c] + 2) >> 2);
+                }
+            }
+
+            numMips++;
+        }
+
+        numTileMips_[i] = numMips;
+    }
+
+    return numTiles_ > 0;
+}
+
+//---------------------------------------------------------
+// Desc:   make all the pages non-resident (the page of the last mip is baked
+//         again by the next update)
+//---------------------------------------------------------
+void TerrainVirtualTexture::DropPages()
+{
+    for (int& slot : pageToSlot_)
+        slot = -1;
+
+    for (uint32& mark : requestMarks_)
+        mark = 0;
+
+    for (TerrainVTSlot& slot : slots_)
+        slot = TerrainVTSlot();
+
+    requests_.clear();
+    requestsCursor_     = 0;
+    numResident_        = 0;
+    isIndirectionDirty_ = true;
+    isReady_            = false;
+}
+
+//---------------------------------------------------------
+// Desc:   read back requests, bake missing pages (no more than the budget)
+//         and upload them and the indirection if it is changed
+//---------------------------------------------------------
+void TerrainVirtualTexture::Update(ID3D11DeviceContext* pContext, Render::VirtualTexture& vt)
+{
+    if (!isInit_)
+        return;
+
+    frameIdx_++;
+
+    // the terrain is regenerated: pages of the prev maps are useless
+    if (pTerrain_->texMapVersion_ != texMapVersion_)
+    {
+        if (!BuildTileMips())
+        {
+            isReady_ = false;
+            return;
+        }
+
+        DropPages();
+    }
+
+    // requests of a few frames ago (if the GPU is done with that frame)
+    uint32        stamp    = 0;
+    const uint32* feedback = vt.MapFeedback(pContext, stamp);
+
+    if (feedback)
+    {
+        ProcessFeedback(feedback, stamp);
+        vt.UnmapFeedback(pContext);
+    }
+
+    // the page of the last mip covers the whole map: it goes before anything else
+    // (and is never evicted)
+    const int rootPageIdx = mipOffsets_[numMips_ - 1];
+
+    if (pageToSlot_[rootPageIdx] == -1)
+    {
+        requests_.clear();
+        requests_.push_back(rootPageIdx);
+        requestsCursor_ = 0;
+    }
+
+    // choose slots for the most wanted missing pages
+    const int maxBakes = std::max(1, params_.maxBakesPerFrame);
+    bakePages_.clear();
+    bakeSlots_.clear();
+
+    while ((requestsCursor_ < (int)requests_.size()) && ((int)bakePages_.size() < maxBakes))
+    {
+        const int pageIdx = requests_[requestsCursor_];
+
+        // the page is already baked (as an ancestor of another page, etc.)
+        if (pageToSlot_[pageIdx] != -1)
+        {
+            requestsCursor_++;
+            continue;
+        }
+
+        const int slot = AcquireSlot();
+
+        // all the slots are taken by pages which are still in use
+        if (slot == -1)
+            break;
+
+        // evict the prev page of the slot
+        if (slots_[slot].pageIdx != -1)
+        {
+            pageToSlot_[slots_[slot].pageIdx] = -1;
+            numResident_--;
+        }
+
+        slots_[slot].pageIdx       = pageIdx;
+        slots_[slot].lastUsedFrame = frameIdx_;
+        pageToSlot_[pageIdx]       = slot;
+        numResident_++;
+
+        bakePages_.push_back(pageIdx);
+        bakeSlots_.push_back(slot);
+        requestsCursor_++;
+    }
+
+    // bake pages in parallel (each of them into its own buffer) and upload
+    if (!bakePages_.empty())
+    {
+        PROFILE_SCOPE("TerrainVT: bake pages");
+
+        const int slotSize  = (int)vt.GetPageSizeWithBorders();
+        const int pageBytes = slotSize * slotSize * 4;
+
+        g_JobSystem.ParallelFor(bakePages_.size(), 1, [&](const index start, const index end)
+        {
+            for (index i = start; i < end; ++i)
+                BakePage(bakePages_[i], bakeTexels_.data() + i * pageBytes);
+        });
+
+        for (index i = 0; i < bakePages_.size(); ++i)
+        {
+            const int slot = bakeSlots_[i];
+            vt.UploadPage(pContext, slot % slotsPerSide_, slot / slotsPerSide_, bakeTexels_.data() + i * pageBytes);
+        }
+
+        isIndirectionDirty_ = true;
+    }
+
+    if (isIndirectionDirty_ && (pageToSlot_[rootPageIdx] != -1))
+    {
+        UploadIndirection(pContext, vt);
+        isIndirectionDirty_ = false;
+        isReady_            = true;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   requested pages are entries equal to the stamp: resident ones are
+//         marked as used and missing ones (with their missing ancestors) become
+//         the new list of requests (the old one is dropped)
+//---------------------------------------------------------
+void TerrainVirtualTexture::ProcessFeedback(const uint32* feedback, const uint32 stamp)
+{
+    PROFILE_SCOPE("TerrainVT: process feedback");
+
+    requests_.clear();
+    requestsCursor_ = 0;
+
+    for (int pageIdx = 0; pageIdx < numEntries_; ++pageIdx)
+    {
+        if (feedback[pageIdx] != stamp)
+            continue;
+
+        const int slot = pageToSlot_[pageIdx];
+
+        if (slot != -1)
+            slots_[slot].lastUsedFrame = frameIdx_;
+        else
+            AddRequest(pageIdx);
+    }
+
+    // coarser pages first: they cover more and are fallbacks of finer ones
+    // (mips go one after another in entries so it is by the idx)
+    std::sort(requests_.begin(), requests_.end(), [](const int a, const int b) { return a > b; });
+}
+
+//---------------------------------------------------------
+// Desc:   add the missing page and its missing ancestors (without duplicates)
+//---------------------------------------------------------
+void TerrainVirtualTexture::AddRequest(const int pageIdx)
+{
+    int mip, x, z;
+    DecodePage(pageIdx, mip, x, z);
+
+    for (; mip < numMips_; ++mip, x >>= 1, z >>= 1)
+    {
+        const int pages = pagesPerSide_ >> mip;
+        const int idx   = mipOffsets_[mip] + z * pages + x;
+
+        // the rest of ancestors are requested already or are resident
+        if ((requestMarks_[idx] == frameIdx_) || (pageToSlot_[idx] != -1))
+            break;
+
+        requestMarks_[idx] = frameIdx_;
+        requests_.push_back(idx);
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   find a free slot or the slot of the least recently requested page
+//         (the page of the last mip and pages in use aren't evicted)
+// Ret:    idx of the slot or -1 if there is no such slot
+//---------------------------------------------------------
+int TerrainVirtualTexture::AcquireSlot()
+{
+    const int rootPageIdx = mipOffsets_[numMips_ - 1];
+    int       lruSlot     = -1;
+    uint32    lruFrame    = UINT32_MAX;
+
+    for (int i = 0; i < (int)slots_.size(); ++i)
+    {
+        const TerrainVTSlot& slot = slots_[i];
+
+        if (slot.pageIdx == -1)
+            return i;
+
+        if ((slot.pageIdx == rootPageIdx) || (frameIdx_ - slot.lastUsedFrame < EVICT_FRAMES))
+            continue;
+
+        if (slot.lastUsedFrame < lruFrame)
+        {
+            lruFrame = slot.lastUsedFrame;
+            lruSlot  = i;
+        }
+    }
+
+    return lruSlot;
+}
+
+//---------------------------------------------------------
+// Desc:   get the mip and page coords by its entry
+//---------------------------------------------------------
+void TerrainVirtualTexture::DecodePage(const int pageIdx, int& outMip, int& outX, int& outZ) const
+{
+    int mip = numMips_ - 1;
+
+    while ((mip > 0) && (pageIdx < mipOffsets_[mip]))
+        mip--;
+
+    const int pages = pagesPerSide_ >> mip;
+    const int local = pageIdx - mipOffsets_[mip];
+
+    outMip = mip;
+    outX   = local % pages;
+    outZ   = local / pages;
+}
+
+//---------------------------------------------------------
+// Desc:   bake the page with its borders as TerrainBase::GenerateTextureMap()
+//         does by texels of the virtual texture: tiles are blended by the
+//         interpolated height; a texel of mip N is blended from mip N of tiles
+// Args:   - outTexels: (pageSize + 2*border)^2 RGBA8 texels
+//---------------------------------------------------------
+void TerrainVirtualTexture::BakePage(const int pageIdx, uint8* outTexels)
+{
+    int mip, pageX, pageZ;
+    DecodePage(pageIdx, mip, pageX, pageZ);
+
+    const int   pageSize      = params_.pageSize;
+    const int   slotSize      = pageSize + 2 * border_;
+    const int   mipSize       = params_.virtualSize >> mip;      // texels per side of the mip
+    const int   step          = 1 << mip;                        // texels of mip 0 per texel of the mip
+    const float heightMapSize = (float)pTerrain_->heightMap_.GetWidth();
+    const float mapRatio      = heightMapSize / (float)params_.virtualSize;
+
+    for (int z = 0; z < slotSize; ++z)
+    {
+        // borders are texels of the neighbour pages (clamped at the edges of the map)
+        const int tz = MathHelper::Clamp(pageZ * pageSize + z - border_, 0, mipSize - 1);
+
+        for (int x = 0; x < slotSize; ++x)
+        {
+            const int tx = MathHelper::Clamp(pageX * pageSize + x - border_, 0, mipSize - 1);
+
+            // the height at the center of the texel
+            const int height = MathHelper::Clamp(
+                pTerrain_->InterpolateHeight(tx * step + (step >> 1), tz * step + (step >> 1), mapRatio, heightMapSize),
+                0, 255);
+
+            float totalRed   = 0.0f;
+            float totalGreen = 0.0f;
+            float totalBlue  = 0.0f;
+
+            for (int i = 0; i < numTiles_; ++i)
+            {
+                const float blendFactor = blendFactors_[i][height];
+
+                if (blendFactor == 0.0f)
+                    continue;
+
+                // tiles repeat over the map
+                const TerrainVTTileMip& tile   = tileMips_[i][std::min(mip, numTileMips_[i] - 1)];
+                const uint8*            pTexel = tile.texels.data() + ((tz % tile.height) * tile.width + (tx % tile.width)) * 3;
+
+                totalRed   += (pTexel[0] * blendFactor);
+                totalGreen += (pTexel[1] * blendFactor);
+                totalBlue  += (pTexel[2] * blendFactor);
+            }
+
+            uint8* pOut = outTexels + (z * slotSize + x) * 4;
+            pOut[0] = (uint8)std::min(totalRed,   255.0f);
+            pOut[1] = (uint8)std::min(totalGreen, 255.0f);
+            pOut[2] = (uint8)std::min(totalBlue,  255.0f);
+            pOut[3] = 255;
+        }
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   rebuild entries of all the mips from the coarsest one: a missing page
+//         refers to the same slot as its parent does; all the mips are uploaded
+//         (it is a few hundreds of KB and happens only if pages are changed)
+//---------------------------------------------------------
+void TerrainVirtualTexture::UploadIndirection(ID3D11DeviceContext* pContext, Render::VirtualTexture& vt)
+{
+    for (int mip = numMips_ - 1; mip >= 0; --mip)
+    {
+        const int pages = pagesPerSide_ >> mip;
+
+        for (int z = 0; z < pages; ++z)
+        {
+            for (int x = 0; x < pages; ++x)
+            {
+                const int idx  = mipOffsets_[mip] + z * pages + x;
+                const int slot = pageToSlot_[idx];
+
+                if (slot != -1)
+                {
+                    indirection_[idx] = Render::VirtualTexture::PackEntry(slot % slotsPerSide_, slot / slotsPerSide_, mip);
+                }
+                else
+                {
+                    // the last mip is always resident so there is a parent here
+                    const int parentPages = pages >> 1;
+                    indirection_[idx] = indirection_[mipOffsets_[mip + 1] + (z >> 1) * parentPages + (x >> 1)];
+                }
+            }
+        }
+
+        vt.UploadIndirection(pContext, mip, indirection_.data() + mipOffsets_[mip]);
+    }
+}
+
+} // namespace Core
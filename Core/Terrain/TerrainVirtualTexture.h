@@ -0,0 +1,143 @@
+// =================================================================================
+// Filename:     TerrainVirtualTexture.h
+// Description:  the texture map of the terrain as a virtual texture: it is the same
+//               map as TerrainBase::GenerateTextureMap() would produce by the size
+//               of the virtual texture (tiles are blended by heights with texels
+//               of tiles 1:1), but only pages which are seen are generated:
+//
+//               - the GPU requests pages (of the mip it needs) through the feedback
+//                 of Render::VirtualTexture; the requests are read back a few
+//                 frames later;
+//               - missing pages (coarser ones first, together with their missing
+//                 ancestors) are baked on demand by the job system, a few pages
+//                 per frame, right from the splat inputs: the height map and mips
+//                 of tiles (so a coarse page is as cheap as a fine one);
+//               - a baked page takes a free slot of the page cache or the slot of
+//                 the page which wasn't requested for the longest time; the page
+//                 of the last mip (the whole map) is always resident so there is
+//                 always something to sample
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "TerrainBase.h"
+#include "VirtualTexture.h"         // from the Render module
+
+
+namespace Core
+{
+
+// =================================================================================
+// Data structures
+// =================================================================================
+struct TerrainVTParams
+{
+    int virtualSize       = 16384;      // texels per side at mip 0 (a power of 2)
+    int pageSize          = 128;        // texels per side of a page (a power of 2)
+    int cachePagesPerSide = 16;         // the page cache has N x N pages
+    int maxBakesPerFrame  = 8;
+};
+
+///////////////////////////////////////////////////////////
+
+struct TerrainVTTileMip
+{
+    cvector<uint8> texels;              // RGB8
+    int            width  = 0;
+    int            height = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+struct TerrainVTSlot
+{
+    int    pageIdx       = -1;          // an entry of the page in the feedback/indirection (-1 if the slot is free)
+    uint32 lastUsedFrame = 0;
+};
+
+// =================================================================================
+// Class
+// =================================================================================
+class TerrainVirtualTexture
+{
+public:
+    static constexpr int    MAX_TILE_MIPS = 16;
+    static constexpr uint32 EVICT_FRAMES  = 8;      // a page can be evicted if it wasn't requested for this number of frames
+
+public:
+    TerrainVirtualTexture() {}
+    ~TerrainVirtualTexture() { Shutdown(); }
+
+    // restrict a copying of this class instance
+    TerrainVirtualTexture(const TerrainVirtualTexture&) = delete;
+    TerrainVirtualTexture& operator=(const TerrainVirtualTexture&) = delete;
+
+    // create GPU resources of the virtual texture and mips of the terrain's tiles
+    // (the tiles must be loaded: the texture map is generated from them)
+    bool Initialize(
+        ID3D11Device* pDevice,
+        Render::VirtualTexture& vt,
+        const TerrainVTParams& params,
+        TerrainBase* pTerrain);
+
+    void Shutdown();
+
+    // read back requests of pages, bake the most wanted missing pages and upload
+    // them and the indirection; NOTE: is executed on the immediate context
+    void Update(ID3D11DeviceContext* pContext, Render::VirtualTexture& vt);
+
+    // can the virtual texture be sampled (the page of the last mip is resident)?
+    inline bool IsReady()          const { return isReady_; }
+    inline bool IsInitialized()    const { return isInit_; }
+    inline int  GetNumResident()   const { return numResident_; }
+
+private:
+    bool BuildTileMips();
+    void DropPages();
+    void ProcessFeedback(const uint32* feedback, const uint32 stamp);
+    void AddRequest(const int pageIdx);
+    int  AcquireSlot();
+    void DecodePage(const int pageIdx, int& outMip, int& outX, int& outZ) const;
+    void BakePage(const int pageIdx, uint8* outTexels);
+    void UploadIndirection(ID3D11DeviceContext* pContext, Render::VirtualTexture& vt);
+
+private:
+    TerrainBase*          pTerrain_        = nullptr;
+    TerrainVTParams       params_;
+
+    // splat inputs (are rebuilt if the texture map is regenerated)
+    TerrainVTTileMip      tileMips_[TRN_NUM_TILES][MAX_TILE_MIPS];
+    int                   numTileMips_[TRN_NUM_TILES]{ 0 };
+    int                   loadedTilesIdxs_[TRN_NUM_TILES]{ 0 };
+    float                 blendFactors_[TRN_NUM_TILES][256]{ 0.0f };
+    int                   numTiles_        = 0;
+    uint32                texMapVersion_   = 0;
+
+    // the page table
+    int                   numMips_         = 0;
+    int                   pagesPerSide_    = 0;     // at mip 0
+    int                   mipOffsets_[Render::VirtualTexture::MAX_NUM_MIPS]{ 0 };
+    int                   numEntries_      = 0;
+    int                   border_          = 0;
+    int                   slotsPerSide_    = 0;
+    cvector<int>          pageToSlot_;              // per page of each mip: a slot of the cache (-1 if it isn't resident)
+    cvector<uint32>       requestMarks_;            // per page: the frame when the page was added into requests_
+    cvector<TerrainVTSlot> slots_;
+    cvector<uint32>       indirection_;             // entries of all the mips (the layout of the feedback)
+    cvector<int>          requests_;                // missing pages to bake (the coarsest first)
+    int                   requestsCursor_  = 0;     // the next request to bake
+
+    // pages which are baked in the current frame
+    cvector<uint8>        bakeTexels_;
+    cvector<int>          bakePages_;
+    cvector<int>          bakeSlots_;
+
+    uint32                frameIdx_        = 0;
+    int                   numResident_     = 0;
+    bool                  isIndirectionDirty_ = false;
+    bool                  isReady_         = false;
+    bool                  isInit_          = false;
+};
+
+} // namespace Core
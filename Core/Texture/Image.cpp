@@ -8,14 +8,189 @@
 
 #include <math.h>   // for abs()
 
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>       // for __cpuid()
+#include <tmmintrin.h>    // SSSE3: _mm_shuffle_epi8() (pshufb)
+#define IMG_USE_SSSE3 1
+#else
+#define IMG_USE_SSSE3 0
+#endif
+
 #pragma warning (disable : 4996)
 
 
 namespace Core
 {
 
-// swapping values with XOR (NOTE: works only for int values)
-#define SWAP(a, b) ((a ^= b), (b ^= a), (a ^= b))
+//---------------------------------------------------------
+// Desc:  check (once) if the CPU supports SSSE3 instructions
+//---------------------------------------------------------
+static bool HasSSSE3()
+{
+#if IMG_USE_SSSE3
+    static const bool hasSSSE3 = []()
+    {
+        int cpuInfo[4]{ 0 };
+        __cpuid(cpuInfo, 1);
+        return (cpuInfo[2] & (1 << 9)) != 0;    // ECX bit 9: SSSE3
+    }();
+
+    return hasSSSE3;
+#else
+    return false;
+#endif
+}
+
+//---------------------------------------------------------
+// Desc:  swap R and B channels of 24 bits pixels (BGR <=> RGB);
+//        src and dst can point to the same memory (in place swizzle)
+//---------------------------------------------------------
+static void SwizzleRB24(uint8* dst, const uint8* src, const size_t numPixels)
+{
+    size_t i = 0;
+
+#if IMG_USE_SSSE3
+    if (HasSSSE3())
+    {
+        // 5 pixels (15 bytes) per register: the 16th byte is stored as is and
+        // it is rewritten by the next step so 16 bytes (6 pixels) must be left
+        const __m128i mask = _mm_setr_epi8(2,1,0, 5,4,3, 8,7,6, 11,10,9, 14,13,12, 15);
+
+        for (; i + 6 <= numPixels; i += 5)
+        {
+            const __m128i px = _mm_loadu_si128((const __m128i*)(src + i*3));
+            _mm_storeu_si128((__m128i*)(dst + i*3), _mm_shuffle_epi8(px, mask));
+        }
+    }
+#endif
+
+    for (; i < numPixels; ++i)
+    {
+        const uint8 c0 = src[i*3 + 0];
+        const uint8 c1 = src[i*3 + 1];
+        const uint8 c2 = src[i*3 + 2];
+
+        dst[i*3 + 0] = c2;
+        dst[i*3 + 1] = c1;
+        dst[i*3 + 2] = c0;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:  swap R and B channels of 32 bits pixels (BGRA <=> RGBA);
+//        src and dst can point to the same memory (in place swizzle)
+//---------------------------------------------------------
+static void SwizzleRB32(uint8* dst, const uint8* src, const size_t numPixels)
+{
+    size_t i = 0;
+
+#if IMG_USE_SSSE3
+    if (HasSSSE3())
+    {
+        const __m128i mask = _mm_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
+
+        for (; i + 4 <= numPixels; i += 4)
+        {
+            const __m128i px = _mm_loadu_si128((const __m128i*)(src + i*4));
+            _mm_storeu_si128((__m128i*)(dst + i*4), _mm_shuffle_epi8(px, mask));
+        }
+    }
+#endif
+
+    for (; i < numPixels; ++i)
+    {
+        const uint8 c0 = src[i*4 + 0];
+        const uint8 c2 = src[i*4 + 2];
+
+        dst[i*4 + 0] = c2;
+        dst[i*4 + 1] = src[i*4 + 1];
+        dst[i*4 + 2] = c0;
+        dst[i*4 + 3] = src[i*4 + 3];
+    }
+}
+
+//---------------------------------------------------------
+// Desc:  swap R and B channels of 24 or 32 bits pixels
+//---------------------------------------------------------
+static void SwizzleRB(uint8* dst, const uint8* src, const size_t numPixels, const uint bytesPerPixel)
+{
+    if (bytesPerPixel == 4)
+        SwizzleRB32(dst, src, numPixels);
+    else
+        SwizzleRB24(dst, src, numPixels);
+}
+
+//---------------------------------------------------------
+// Desc:  fill a run of pixels with the same (already swizzled) pixel:
+//        memset if all its bytes are equal, or doubling of the filled part
+//---------------------------------------------------------
+static void FillRun(uint8* dst, const uint8* pixel, const uint bytesPerPixel, const uint numPixels)
+{
+    const size_t runBytes = (size_t)numPixels * bytesPerPixel;
+    bool         isSameBytes = true;
+
+    for (uint i = 1; i < bytesPerPixel; ++i)
+        isSameBytes &= (pixel[i] == pixel[0]);
+
+    // black, white, gray, etc.
+    if (isSameBytes)
+    {
+        memset(dst, pixel[0], runBytes);
+        return;
+    }
+
+    memcpy(dst, pixel, bytesPerPixel);
+
+    for (size_t filled = bytesPerPixel; filled < runBytes;)
+    {
+        const size_t numBytes = (filled < runBytes - filled) ? filled : runBytes - filled;
+
+        memcpy(dst + filled, dst, numBytes);
+        filled += numBytes;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:  decode RLE compressed BGR(A) pixels into RGB(A) pixels;
+//        each packet is a run of the same pixel or a run of raw pixels
+//        (packets can cross rows so the image is decoded as a single run)
+// Args:  - dst:           output pixels (numPixels * bytesPerPixel bytes)
+//        - data:          compressed data (is moved to the end of it)
+//---------------------------------------------------------
+static void DecodeRleTGA(
+    uint8* dst,
+    uint8*& data,
+    const uint numPixels,
+    const uint bytesPerPixel)
+{
+    for (uint currPixel = 0; currPixel < numPixels;)
+    {
+        const uint8 header = *data++;
+        uint        count  = (header & 0x7f) + 1;
+
+        // a broken file can't write out of the image
+        if (count > numPixels - currPixel)
+            count = numPixels - currPixel;
+
+        uint8* dstRun = dst + (size_t)currPixel * bytesPerPixel;
+
+        if (header & 0x80)
+        {
+            uint8 pixel[4]{ 0 };
+            SwizzleRB(pixel, data, 1, bytesPerPixel);
+            FillRun(dstRun, pixel, bytesPerPixel, count);
+
+            data += bytesPerPixel;
+        }
+        else
+        {
+            SwizzleRB(dstRun, data, count, bytesPerPixel);
+            data += (size_t)count * bytesPerPixel;
+        }
+
+        currPixel += count;
+    }
+}
 
 // --------------------------------------------------------
 // Image's destructor
@@ -136,8 +311,7 @@ bool Image::LoadData(const char* filename)
 
         // the file's data was successfully loaded
         isLoaded_ = true;
-        sprintf(g_String, "File is loaded correctly: %s", filename);
-        LogMsg(g_String);
+        LogMsgf("File is loaded correctly: %s", filename);
         return true;
     }
     catch (std::bad_alloc& e)
@@ -212,8 +386,7 @@ bool Image::Save(const char* filename)
     }
 
 
-    sprintf(g_String, "The height map was saved successfully: %s", filename);
-    LogMsg(g_String);
+    LogMsgf("The height map was saved successfully: %s", filename);
 
     return true;
 }
@@ -353,13 +526,8 @@ bool Image::SaveBMP(const char* filename) const
     // if original image is already 24 bits per pixel
     else if (bpp_ == 24)
     {
-        memcpy(bmpPixels, pixels_, imageSize);
-
         // swap the image bit order (RGB to BGR)
-        for (int i = 0; i < (int)imageSize; i += bytesPerPixel)
-        {
-            SWAP(bmpPixels[i], bmpPixels[i + 2]);
-        }
+        SwizzleRB24(bmpPixels, pixels_, imageSize / bytesPerPixel);
     }
 
     // convert original 32 bits image into 24 bits image
@@ -400,16 +568,47 @@ void Image::Unload()
 {
     if (isLoaded_)
     {
-        SafeDeleteArr(pixels_);
+        if (isExternal_)
+            pixels_ = nullptr;
+        else
+            SafeDeleteArr(pixels_);
 
         width_  = 0;
         height_ = 0;
         bpp_    = 0;
 
-        isLoaded_ = false;
+        isLoaded_   = false;
+        isExternal_ = false;
     }
 }
 
+// --------------------------------------------------------
+// Desc:   use external memory as pixels of the image (no copying)
+// Args:   - pixels:  the memory (must be valid until Unload() of the image)
+//         - width, height: dimensions of the image
+//         - bpp:     bits per pixel
+// --------------------------------------------------------
+bool Image::Wrap(uint8* pixels, const uint width, const uint height, const uint bpp)
+{
+    if (!pixels || width == 0 || height == 0 || bpp == 0)
+    {
+        LogErr("can't wrap pixels: invalid input args");
+        return false;
+    }
+
+    Unload();
+
+    pixels_        = pixels;
+    width_         = width;
+    height_        = height;
+    bpp_           = bpp;
+    bytesPerPixel_ = bpp / 8;
+    isLoaded_      = true;
+    isExternal_    = true;
+
+    return true;
+}
+
 //--------------------------------------------------------------
 // Desc:   a windows RGB bitmap (BMP) image loader
 // Args:   - filename: path to the file
@@ -479,11 +678,7 @@ bool Image::LoadRgbBMP(const char* filename)
         }
 
         // swap the R and B values to get RGB since the bitmap color format is in BGR
-        for (int i = 0; i < (int)infoHeader.sizeImage; i += 3)
-        {
-            // swap values without using extra space for a temp variable
-            SWAP(pixels_[i], pixels_[i + 2]);
-        }
+        SwizzleRB24(pixels_, pixels_, infoHeader.sizeImage / 3);
 
 
         // close the file
@@ -648,9 +843,8 @@ bool Image::LoadGrayscaleBMP(const char* filename)
 bool Image::LoadTGA(const char* filename)
 {
     TGAInfoHeader tgaInfo;
-    FILE*  pFile = nullptr;
     uint8* pixelsData = nullptr;
-    int    fileSize = 0;
+    size_t fileSize = 0;
     
     try
     {
@@ -661,26 +855,16 @@ bool Image::LoadTGA(const char* filename)
             return false;
         }
 
-        // open the file for reading (in binary mode)
-        pFile = fopen(filename, "rb");
-        if (!pFile)
+        // read in file content (from asset packs or from disk)
+        if (!FileSys::ReadFile(filename, pixelsData, fileSize))
         {
-            sprintf(g_String, "can't open file: %s", filename);
+            sprintf(g_String, "can't read in pixels data: %s", filename);
             throw EngineException(g_String);
         }
 
-        // get file length
-        fseek(pFile, 0, SEEK_END);
-        fileSize = ftell(pFile);
-        fseek(pFile, 0, SEEK_SET);
-
-        // allocate memory for the file content
-        pixelsData = new uint8[fileSize]{0};
-
-        // read in file content
-        if (fread(pixelsData, 1, fileSize, pFile) != (unsigned)fileSize)
+        if (fileSize < sizeof(TGAInfoHeader))
         {
-            sprintf(g_String, "can't read in pixels data: %s", filename);
+            sprintf(g_String, "the TGA file is too small: %s", filename);
             throw EngineException(g_String);
         }
 
@@ -702,12 +886,8 @@ bool Image::LoadTGA(const char* filename)
         // skip the header and move to the actual pixels data
         fileData += sizeof(TGAInfoHeader);
 
-        // copy pixels raw data into buffer
-        uint imageSize = width*height*(bpp/8);
-        memcpy(pixels_, fileData, imageSize);
-
-        // close the file
-        fclose(pFile);
+        // skip the image ID field (if there is any)
+        fileData += tgaInfo.idLength;
 
         // define if tga image is compressed or uncompressed
         switch (tgaInfo.imageType)
@@ -752,7 +932,6 @@ bool Image::LoadTGA(const char* filename)
     catch (EngineException& e)
     {
         LogErr(e);
-        fclose(pFile);
         SafeDeleteArr(pixelsData);
         SafeDeleteArr(pixels_);
         return false;
@@ -766,58 +945,7 @@ bool Image::LoadTGA(const char* filename)
 //--------------------------------------------------------------
 void Image::LoadCompressedTGA24(uint8*& data, const int width, const int height)
 {
-    constexpr uint bytesPerPixel = 3;
-    uint           currByte = 0;
-    uint8          colorBuf[bytesPerPixel]{ 0 };
-
-
-    for (int y = 0; y < height; ++y)
-    {
-        for (int x = 0; x < width;)
-        {
-            uint8 c = *(uint*)data;
-            data++;
-
-            if (c & 0x80)
-            {
-                c = (c & 0x7f) + 1;
-                x += c;
-
-                // read in BGR pixel
-                memcpy(colorBuf, data, bytesPerPixel);
-                data += bytesPerPixel;
-
-                // fill with the same color (and store BGR as RGB)
-                for (int i = 0; i < c; ++i)
-                {
-                    pixels_[currByte + 0] = colorBuf[2];
-                    pixels_[currByte + 1] = colorBuf[1];
-                    pixels_[currByte + 2] = colorBuf[0];
-
-                    currByte += bytesPerPixel;
-                }
-            }
-            else
-            {
-                ++c;
-                x += c;
-
-                for (int i = 0; i < c; ++i)
-                {
-                    // read in BGR pixel
-                    memcpy(colorBuf, data, bytesPerPixel);
-                    data += bytesPerPixel;
-
-                    // store BGR as RGB
-                    pixels_[currByte + 0] = colorBuf[2];
-                    pixels_[currByte + 1] = colorBuf[1];
-                    pixels_[currByte + 2] = colorBuf[0];
-
-                    currByte += bytesPerPixel;
-                }
-            }
-        }
-    }
+    DecodeRleTGA(pixels_, data, (uint)(width * height), 3);
 }
 
 //--------------------------------------------------------------
@@ -827,60 +955,7 @@ void Image::LoadCompressedTGA24(uint8*& data, const int width, const int height)
 //--------------------------------------------------------------
 void Image::LoadCompressedTGA32(uint8*& data, const int width, const int height)
 {
-    constexpr uint bytesPerPixel = 4;
-    uint           currByte = 0;
-    uint8          colorBuf[bytesPerPixel]{ 0 };
-
-    for (int y = 0; y < height; ++y)
-    {
-        for (int x = 0; x < width;)
-        {
-            uint8 c = *(uint*)data;
-            data++;
-
-            if (c & 0x80)
-            {
-                c = (c & 0x7f) + 1;
-                x += c;
-
-                // read in BGRA pixel
-                memcpy(colorBuf, data, bytesPerPixel);
-                data += bytesPerPixel;
-
-                // fill with the same color
-                for (int i = 0; i < c; ++i)
-                {
-                    // store BGRA as RGBA
-                    pixels_[currByte + 0] = colorBuf[2];
-                    pixels_[currByte + 1] = colorBuf[1];
-                    pixels_[currByte + 2] = colorBuf[0];
-                    pixels_[currByte + 3] = colorBuf[3];
-
-                    currByte += bytesPerPixel;
-                }
-            }
-            else
-            {
-                ++c;
-                x += c;
-
-                for (int i = 0; i < c; ++i)
-                {
-                    // read in BGRA pixel
-                    memcpy(colorBuf, data, bytesPerPixel);
-                    data += bytesPerPixel;
-
-                    // store BGRA as RGBA
-                    pixels_[currByte + 0] = colorBuf[2];
-                    pixels_[currByte + 1] = colorBuf[1];
-                    pixels_[currByte + 2] = colorBuf[0];
-                    pixels_[currByte + 3] = colorBuf[3];
-
-                    currByte += bytesPerPixel;
-                }
-            }
-        }
-    }
+    DecodeRleTGA(pixels_, data, (uint)(width * height), 4);
 }
 
 // --------------------------------------------------------
@@ -892,15 +967,9 @@ void Image::LoadUncompressedTGA(const TGAInfoHeader& header, uint8*& pixelsData)
     const uint bytesPerPixel  = header.BytesPerPixel();
     const uint imgSizeInBytes = numPixels * bytesPerPixel;
 
-    // copy the image data
-    memcpy(pixels_, pixelsData, imgSizeInBytes);
-
-    // byte swapping
-    for (int idx = 0; idx < (int)imgSizeInBytes; idx += bytesPerPixel)
-    {
-        SWAP(pixels_[idx], pixels_[idx+2]);
-    }
-  
+    // copy the image data swapping BGR(A) to RGB(A) at once
+    SwizzleRB(pixels_, pixelsData, numPixels, bytesPerPixel);
+    pixelsData += imgSizeInBytes;
 }
 
 } // namespace Core
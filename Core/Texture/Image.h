@@ -115,6 +115,10 @@ public:
         const int width,
         const int height);
 
+    // use external memory as pixels of the image (e.g. a memory-mapped file);
+    // the image doesn't own this memory so it is not released by Unload()
+    bool Wrap(uint8* pixels, const uint width, const uint height, const uint bpp);
+
     void Unload();
 
     // ----------------------------------------------------
@@ -201,6 +205,7 @@ private:
     uint    bytesPerPixel_ = 0;
     uint8*  pixels_     = nullptr;
     bool    isLoaded_   = false;
+    bool    isExternal_ = false;       // pixels_ aren't owned by the image (see Wrap())
 };
 
 } // namespace Core
@@ -0,0 +1,347 @@
+// =================================================================================
+// Filename:     TextureCooker.cpp
+// Description:  implementation of the TextureCooker's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "TextureCooker.h"
+#include "textureclass.h"
+#include <DirectXTex.h>
+
+namespace fs = std::filesystem;
+
+
+namespace Core
+{
+
+// a directory of cooked textures (the version is a part of it)
+static const char* COOKED_TEX_DIR = "data/cooked/tex_v1/";
+
+static_assert(TextureCooker::COOKER_VERSION == 1, "update COOKED_TEX_DIR by the cooker version");
+
+// extensions of source textures which can be cooked
+static const char* COOKABLE_EXTS[] = { ".dds", ".tga", ".png", ".jpg", ".jpeg", ".bmp" };
+
+// suffixes of file stems by usage
+static const char* NORMAL_SUFFIXES[] = { "_nrm", "_normal", "_norm", "_n" };
+static const char* MASK_SUFFIXES[]   = { "_mask", "_rough", "_roughness", "_gloss", "_metal", "_metallic", "_height", "_disp", "_opacity" };
+
+
+//---------------------------------------------------------
+// Desc:  convert the str into lowercase in place
+//---------------------------------------------------------
+static void ToLower(char* str)
+{
+    for (; *str; ++str)
+        *str = (char)tolower((uint8)*str);
+}
+
+//---------------------------------------------------------
+// Desc:  check if the lowercase str ends with suffix
+//---------------------------------------------------------
+static bool EndsWith(const char* str, const char* suffix)
+{
+    const size_t len       = strlen(str);
+    const size_t suffixLen = strlen(suffix);
+
+    return (len >= suffixLen) && (strcmp(str + len - suffixLen, suffix) == 0);
+}
+
+//---------------------------------------------------------
+// Desc:  check if the source texture can be cooked by its extension
+//---------------------------------------------------------
+static bool IsCookableExt(const char* ext)
+{
+    for (const char* cookable : COOKABLE_EXTS)
+    {
+        if (strcmp(ext, cookable) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+//---------------------------------------------------------
+// Desc:  get the number of bytes of all the images (mips) of the texture
+//---------------------------------------------------------
+static uint64 GetImagesBytes(const DirectX::ScratchImage& image)
+{
+    uint64 bytes = 0;
+
+    for (size_t i = 0; i < image.GetImageCount(); ++i)
+        bytes += image.GetImages()[i].slicePitch;
+
+    return bytes;
+}
+
+//---------------------------------------------------------
+// Desc:  choose a block compressed format by usage of the texture
+//---------------------------------------------------------
+static DXGI_FORMAT GetCookedFormat(
+    const eTexCookUsage usage,
+    const DirectX::ScratchImage& image,
+    const bool hasGpuEncoder)
+{
+    // NOTE: UNORM (not SRGB) formats are used since textures are sampled as is
+    //       (the same as the source data)
+
+    switch (usage)
+    {
+        case TEX_COOK_USAGE_NORMAL:  return DXGI_FORMAT_BC5_UNORM;
+        case TEX_COOK_USAGE_MASK:    return DXGI_FORMAT_BC4_UNORM;
+        default:                     break;
+    }
+
+    // BC7 is too slow to be encoded on the CPU for a whole textures dir
+    if (hasGpuEncoder)
+        return DXGI_FORMAT_BC7_UNORM;
+
+    return (image.IsAlphaAllOpaque()) ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC3_UNORM;
+}
+
+
+// =================================================================================
+// Public API
+// =================================================================================
+bool TextureCooker::FindCooked(const char* srcPath, char* outPath, const int outPathSize)
+{
+    if (StrHelper::IsEmpty(srcPath) || !outPath)
+        return false;
+
+    GetCookedPath(srcPath, outPath, outPathSize);
+    return IsUpToDate(srcPath, outPath);
+}
+
+///////////////////////////////////////////////////////////
+
+bool TextureCooker::Cook(ID3D11Device* pDevice, const char* srcPath, TexCookStats& stats)
+{
+    using namespace DirectX;
+
+    char cookedPath[256]{ '\0' };
+    char ext[256]{ '\0' };
+
+    GetCookedPath(srcPath, cookedPath, sizeof(cookedPath));
+    FileSys::GetFileExt(srcPath, ext);
+    ToLower(ext);
+
+    if (!IsCookableExt(ext) || IsUpToDate(srcPath, cookedPath))
+    {
+        stats.numSkipped++;
+        return false;
+    }
+
+    // only uncompressed single 2D textures are cooked (cube maps and arrays are skipped)
+    if (strcmp(ext, ".dds") == 0)
+    {
+        wchar_t     wSrcPath[256]{ L'\0' };
+        TexMetadata metadata;
+
+        StrHelper::StrToWide(srcPath, wSrcPath);
+
+        if (FAILED(GetMetadataFromDDSFile(wSrcPath, DDS_FLAGS_NONE, metadata)) ||
+            IsCompressed(metadata.format) ||
+            (metadata.dimension != TEX_DIMENSION_TEXTURE2D) ||
+            (metadata.arraySize != 1))
+        {
+            stats.numSkipped++;
+            return false;
+        }
+    }
+
+    ScratchImage image;
+
+    if (!Texture::DecodeFromFile(srcPath, image))
+    {
+        stats.numFailed++;
+        return false;
+    }
+
+    const TexMetadata& metadata = image.GetMetadata();
+
+    // the top mip of a block compressed texture must consist of whole blocks
+    if ((metadata.width % 4) || (metadata.height % 4))
+    {
+        LogMsgf("texture cooking: %s: is skipped (%dx%d isn't a multiple of 4)", srcPath, (int)metadata.width, (int)metadata.height);
+        stats.numSkipped++;
+        return false;
+    }
+
+    // single channel sources are sampled as masks anyway
+    const eTexCookUsage usage  = (BitsPerColor(metadata.format) > 0) && (BitsPerPixel(metadata.format) == BitsPerColor(metadata.format)) ?
+                                 TEX_COOK_USAGE_MASK :
+                                 GetUsageByName(srcPath);
+    const DXGI_FORMAT   format = GetCookedFormat(usage, image, pDevice != nullptr);
+    ScratchImage        compressed;
+    HRESULT             hr     = S_OK;
+
+    if (format == DXGI_FORMAT_BC7_UNORM)
+    {
+        hr = Compress(
+            pDevice,
+            image.GetImages(),
+            image.GetImageCount(),
+            metadata,
+            format,
+            TEX_COMPRESS_DEFAULT,
+            TEX_ALPHA_WEIGHT_DEFAULT,
+            compressed);
+    }
+    else
+    {
+        hr = Compress(
+            image.GetImages(),
+            image.GetImageCount(),
+            metadata,
+            format,
+            TEX_COMPRESS_PARALLEL,
+            TEX_THRESHOLD_DEFAULT,
+            compressed);
+    }
+
+    if (FAILED(hr))
+    {
+        sprintf(g_String, "can't compress a texture: %s", srcPath);
+        LogErr(g_String);
+        stats.numFailed++;
+        return false;
+    }
+
+    std::error_code error;
+    fs::create_directories(fs::path(cookedPath).parent_path(), error);
+
+    wchar_t wCookedPath[256]{ L'\0' };
+    StrHelper::StrToWide(cookedPath, wCookedPath);
+
+    hr = SaveToDDSFile(
+        compressed.GetImages(),
+        compressed.GetImageCount(),
+        compressed.GetMetadata(),
+        DDS_FLAGS_NONE,
+        wCookedPath);
+
+    if (FAILED(hr))
+    {
+        sprintf(g_String, "can't save a cooked texture: %s", cookedPath);
+        LogErr(g_String);
+        stats.numFailed++;
+        return false;
+    }
+
+    stats.numCooked++;
+    stats.srcBytes += GetImagesBytes(image);
+    stats.dstBytes += GetImagesBytes(compressed);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureCooker::CookDirectory(ID3D11Device* pDevice, const char* dirPath, TexCookStats& stats)
+{
+    std::error_code error;
+
+    if (StrHelper::IsEmpty(dirPath) || !fs::is_directory(dirPath, error))
+    {
+        sprintf(g_String, "there is no textures directory to cook: %s", (dirPath) ? dirPath : "");
+        LogErr(g_String);
+        return;
+    }
+
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(dirPath, error))
+    {
+        if (!entry.is_regular_file(error))
+            continue;
+
+        // textures are referenced by generic paths (with '/')
+        const std::string srcPath = entry.path().generic_string();
+
+        Cook(pDevice, srcPath.c_str(), stats);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+eTexCookUsage TextureCooker::GetUsageByName(const char* srcPath)
+{
+    char stem[128]{ '\0' };
+
+    FileSys::GetFileStem(srcPath, stem);
+    ToLower(stem);
+
+    for (const char* suffix : NORMAL_SUFFIXES)
+    {
+        if (EndsWith(stem, suffix))
+            return TEX_COOK_USAGE_NORMAL;
+    }
+
+    // a short "n" suffix after a number: brick01n, stones2n, etc.
+    const size_t len = strlen(stem);
+
+    if ((len >= 2) && (stem[len - 1] == 'n') && isdigit((uint8)stem[len - 2]))
+        return TEX_COOK_USAGE_NORMAL;
+
+    for (const char* suffix : MASK_SUFFIXES)
+    {
+        if (EndsWith(stem, suffix))
+            return TEX_COOK_USAGE_MASK;
+    }
+
+    return TEX_COOK_USAGE_ALBEDO;
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+void TextureCooker::GetCookedPath(const char* srcPath, char* outPath, const int outPathSize)
+{
+    // mirror the source path in the cooked dir:
+    //   data/textures/brick01d.png => data/cooked/tex_v1/textures/brick01d.png.dds
+    //   data/textures/brick01d.dds => data/cooked/tex_v1/textures/brick01d.dds
+
+    const char* relPath = srcPath;
+
+    if (strncmp(relPath, "data/", 5) == 0)
+        relPath += 5;
+
+    while ((*relPath == '/') || (*relPath == '.'))
+        ++relPath;
+
+    char ext[256]{ '\0' };
+    FileSys::GetFileExt(srcPath, ext);
+    ToLower(ext);
+
+    const char* cookedExt = (strcmp(ext, ".dds") == 0) ? "" : ".dds";
+
+    snprintf(outPath, outPathSize, "%s%s%s", COOKED_TEX_DIR, relPath, cookedExt);
+
+    // a drive letter of an absolute path can't be a part of the path
+    for (char* ch = outPath + strlen(COOKED_TEX_DIR); *ch; ++ch)
+    {
+        if (*ch == ':')
+            *ch = '_';
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool TextureCooker::IsUpToDate(const char* srcPath, const char* cookedPath)
+{
+    // the cooked file is up to date if it isn't older than its source
+
+    std::error_code error;
+
+    const fs::file_time_type cookedTime = fs::last_write_time(cookedPath, error);
+    if (error)
+        return false;
+
+    const fs::file_time_type srcTime = fs::last_write_time(srcPath, error);
+    if (error)
+        return false;
+
+    return (cookedTime >= srcTime);
+}
+
+} // namespace Core
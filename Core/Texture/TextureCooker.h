@@ -0,0 +1,74 @@
+// =================================================================================
+// Filename:     TextureCooker.h
+// Description:  offline cooking of source textures (.tga, .png, .jpg, .bmp and
+//               uncompressed .dds) into block compressed .dds files with
+//               precomputed mips; a format is chosen by usage of the texture:
+//
+//                 albedo: BC7 (BC1/BC3 if there is no device for the GPU encoder)
+//                 normal: BC5 (only XY are stored; Z is restored by the shader)
+//                 mask:   BC4 (single channel sources and maps named like masks)
+//
+//               cooked files are stored in the cache dir (mirroring paths of
+//               sources) and are preferred by the TextureMgr while they are
+//               newer than their sources
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <d3d11.h>
+
+
+namespace Core
+{
+
+enum eTexCookUsage
+{
+    TEX_COOK_USAGE_ALBEDO,
+    TEX_COOK_USAGE_NORMAL,
+    TEX_COOK_USAGE_MASK,
+};
+
+///////////////////////////////////////////////////////////
+
+struct TexCookStats
+{
+    uint32 numCooked  = 0;
+    uint32 numSkipped = 0;            // already up to date or can't be compressed
+    uint32 numFailed  = 0;
+    uint64 srcBytes   = 0;            // of decoded mips before compression
+    uint64 dstBytes   = 0;            // of mips after compression
+};
+
+///////////////////////////////////////////////////////////
+
+class TextureCooker
+{
+public:
+    // increase it when cooking starts to produce a different output
+    // (the version is a part of the cache dir so old files aren't used anymore)
+    static constexpr uint32 COOKER_VERSION = 1;
+
+    // get a path of the up to date cooked file for the source texture;
+    // returns false if there is no such a file (the source must be used)
+    static bool FindCooked(const char* srcPath, char* outPath, const int outPathSize);
+
+    // cook a single texture (pDevice is optional: BC7 is encoded on the GPU by it);
+    // NOTE: the GPU encoder uses the immediate context so call it from the main thread
+    static bool Cook(ID3D11Device* pDevice, const char* srcPath, TexCookStats& stats);
+
+    // cook all the textures of the directory (and its subdirectories)
+    // which aren't cooked yet or their cooked files are stale
+    static void CookDirectory(ID3D11Device* pDevice, const char* dirPath, TexCookStats& stats);
+
+    // get a usage by name conventions: *_nrm, *_normal, *_n, *<digit>n (e.g. brick01n)
+    // are normal maps; *_mask, *_rough, *_metal, *_height, etc. are masks
+    static eTexCookUsage GetUsageByName(const char* srcPath);
+
+private:
+    static void GetCookedPath(const char* srcPath, char* outPath, const int outPathSize);
+    static bool IsUpToDate   (const char* srcPath, const char* cookedPath);
+};
+
+} // namespace Core
@@ -7,7 +7,12 @@
 #include <CoreCommon/pch.h>
 #include "../Render/d3dclass.h"
 #include "TextureMgr.h"
+#include "TextureCooker.h"
 #include "ImageReader.h"
+#include "../Render/GpuMemory.h"
+#include <DirectXTex.h>
+#include <MappedFile.h>
+#include <HitchRecorder.h>
 
 
 namespace Core
@@ -22,6 +27,151 @@ TextureMgr* TextureMgr::pInstance_ = nullptr;
 // we use this value as ID for each created/added texture
 TexID TextureMgr::lastTexID_ = 0;
 
+// FNV-1a params
+static constexpr uint64 FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static constexpr uint64 FNV_PRIME        = 1099511628211ULL;
+
+
+//---------------------------------------------------------
+// Desc:  mix the input bytes into the hash
+//---------------------------------------------------------
+static void HashBytes(uint64& hash, const void* data, const size_t numBytes)
+{
+    const uint8* bytes = (const uint8*)data;
+
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:  normalize a texture name (path): lowercase, '/' separators,
+//        without "." parts and with resolved ".." parts
+//        (e.g. "Data\Models\..\Textures\.\Brick.png" => "data/textures/brick.png")
+//---------------------------------------------------------
+static void NormalizeName(const char* name, char* outName, const size_t outNameSize)
+{
+    size_t len = 0;
+
+    for (const char* ch = name; *ch; )
+    {
+        // get the next part of the path
+        const char* partEnd = ch;
+
+        while (*partEnd && (*partEnd != '/') && (*partEnd != '\\'))
+            ++partEnd;
+
+        const size_t partLen  = partEnd - ch;
+        const bool   isDot    = (partLen == 1) && (ch[0] == '.');
+        const bool   isDotDot = (partLen == 2) && (ch[0] == '.') && (ch[1] == '.');
+
+        // the start of the last written part
+        size_t lastStart = len;
+
+        while ((lastStart > 0) && (outName[lastStart - 1] != '/'))
+            --lastStart;
+
+        const bool isLastDotDot = (len - lastStart == 2) && (outName[lastStart] == '.') && (outName[lastStart + 1] == '.');
+
+        if (isDotDot && (len > 0) && !isLastDotDot)
+        {
+            // "a/b/.." => "a"
+            len = (lastStart > 0) ? lastStart - 1 : 0;
+        }
+        else if ((partLen > 0) && !isDot)
+        {
+            if ((len > 0) && (len + 1 < outNameSize))
+                outName[len++] = '/';
+
+            for (size_t i = 0; (i < partLen) && (len + 1 < outNameSize); ++i)
+                outName[len++] = (char)tolower((uint8)ch[i]);
+        }
+
+        ch = (*partEnd) ? partEnd + 1 : partEnd;
+    }
+
+    outName[len] = '\0';
+}
+
+//---------------------------------------------------------
+// Desc:  get a hash of the normalized texture name
+//---------------------------------------------------------
+static uint64 HashName(const char* name)
+{
+    char normalized[256]{ '\0' };
+    NormalizeName(name, normalized, sizeof(normalized));
+
+    uint64 hash = FNV_OFFSET_BASIS;
+    HashBytes(hash, normalized, strlen(normalized));
+
+    return hash;
+}
+
+//---------------------------------------------------------
+// Desc:  check if names are the same after normalization
+//---------------------------------------------------------
+static bool IsSameName(const char* name1, const char* name2)
+{
+    char normalized1[256]{ '\0' };
+    char normalized2[256]{ '\0' };
+
+    NormalizeName(name1, normalized1, sizeof(normalized1));
+    NormalizeName(name2, normalized2, sizeof(normalized2));
+
+    return strcmp(normalized1, normalized2) == 0;
+}
+
+//---------------------------------------------------------
+// Desc:  get a hash of the file content (can be called by any thread)
+// Ret:   false if the file can't be read
+//---------------------------------------------------------
+static bool HashFileContent(const char* path, uint64& outHash)
+{
+    MappedFile file;
+
+    if (!file.Open(path) || (file.GetSize() == 0))
+        return false;
+
+    outHash = FNV_OFFSET_BASIS;
+    HashBytes(outHash, file.GetData(), file.GetSize());
+
+    // 0 is reserved for "there is no hash"
+    outHash = (outHash != 0) ? outHash : 1;
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:  get the number of bytes of the texture's GPU resource (all the mips/layers)
+//---------------------------------------------------------
+static uint64 GetTextureBytes(Texture& tex)
+{
+    ID3D11Texture2D* pTex2D  = nullptr;
+    uint64           bytes   = 0;
+
+    if (!tex.GetResource() || FAILED(tex.GetResource()->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&pTex2D)))
+        return 0;
+
+    D3D11_TEXTURE2D_DESC desc;
+    pTex2D->GetDesc(&desc);
+    SafeRelease(&pTex2D);
+
+    for (UINT mip = 0; mip < desc.MipLevels; ++mip)
+    {
+        const UINT w = (desc.Width  >> mip) ? (desc.Width  >> mip) : 1;
+        const UINT h = (desc.Height >> mip) ? (desc.Height >> mip) : 1;
+
+        size_t rowPitch   = 0;
+        size_t slicePitch = 0;
+
+        if (SUCCEEDED(DirectX::ComputePitch(desc.Format, w, h, rowPitch, slicePitch)))
+            bytes += (uint64)slicePitch * desc.ArraySize;
+    }
+
+    return bytes;
+}
+
 
 ///////////////////////////////////////////////////////////
 
@@ -35,7 +185,7 @@ TextureMgr::TextureMgr()
         constexpr size reserveForTexCount = 128;
         ids_.reserve(reserveForTexCount);
         names_.reserve(reserveForTexCount);
-        textures_.reserve(reserveForTexCount);
+        texHandles_.reserve(reserveForTexCount);
         shaderResourceViews_.reserve(reserveForTexCount);
     }
     else
@@ -50,8 +200,11 @@ TextureMgr::~TextureMgr()
 {
     ids_.clear();
     names_.clear();
-    textures_.clear();   
+    texHandles_.clear();
+    textures_.Clear();
     shaderResourceViews_.clear();
+    nameToID_.clear();
+    contentToID_.clear();
     
     pInstance_ = nullptr;
 }
@@ -154,6 +307,8 @@ TexID TextureMgr::CreateTextureFromRawData(
     const int bpp,
     const bool mipMapped)
 {
+    MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+
     uint8* initData = nullptr;
     cvector<uint8> convertedData;
 
@@ -190,6 +345,24 @@ TexID TextureMgr::CreateTextureFromRawData(
             initData = convertedData.data();
         }
 
+        // staged: the texture is created empty and its texels are copied by
+        // the uploader within a per frame budget (mips are generated on GPU)
+        if (uploader_.IsInitialized())
+        {
+            Texture texture;
+
+            if (!texture.InitializeEmpty(g_pDevice, name, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, mipMapped))
+            {
+                sprintf(g_String, "can't create a texture for staged upload: %s", name);
+                throw EngineException(g_String);
+            }
+
+            ID3D11ShaderResourceView* pSRVForMips = (mipMapped) ? texture.GetTextureResourceView() : nullptr;
+            uploader_.Enqueue(texture.GetResource(), pSRVForMips, initData, width, height, DXGI_FORMAT_R8G8B8A8_UNORM);
+
+            return Add(name, std::move(texture));
+        }
+
         // create a DirectX texture
         Texture texture(g_pDevice, name, initData, width, height, mipMapped);
 
@@ -210,6 +383,56 @@ TexID TextureMgr::CreateTextureFromRawData(
     }
 }
 
+// --------------------------------------------------------
+// Desc:   create a single channel DirectX texture (R8_UNORM) with
+//         input 8-bit data (in 4 times less memory than an RGBA one)
+// Args:   - name:      a name for texture identification
+//         - data:      8-bit pixels data
+//         - width:     the texture width
+//         - height:    the texture height
+// Ret:    an ID of created texture (for details look at TextureMgr)
+// --------------------------------------------------------
+TexID TextureMgr::CreateGrayTexture(
+    const char* name,
+    const uint8* data,
+    const uint width,
+    const uint height)
+{
+    try
+    {
+        // check input params
+        CAssert::True(!StrHelper::IsEmpty(name), "input name is empty");
+        CAssert::True(data,                      "input ptr to image data array == nullptr");
+        CAssert::True(width & height,            "input width and height must be > 0");
+
+        Texture texture;
+
+        if (uploader_.IsInitialized())
+        {
+            if (!texture.InitializeEmpty(g_pDevice, name, width, height, DXGI_FORMAT_R8_UNORM, false))
+            {
+                sprintf(g_String, "can't create a single channel texture: %s", name);
+                throw EngineException(g_String);
+            }
+
+            uploader_.Enqueue(texture.GetResource(), nullptr, data, width, height, DXGI_FORMAT_R8_UNORM);
+        }
+        else if (!texture.InitializeGray(g_pDevice, name, data, width, height))
+        {
+            sprintf(g_String, "can't create a single channel texture: %s", name);
+            throw EngineException(g_String);
+        }
+
+        // move texture into the textures manager and return an ID of the texture
+        return Add(name, std::move(texture));
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        return INVALID_TEXTURE_ID;
+    }
+}
+
 // --------------------------------------------------------
 // Desc:   recreate a DirectX texture with the image's input raw data
 //         (release the previous data and init with new)
@@ -258,15 +481,49 @@ void TextureMgr::RecreateTextureFromRawData(
         const TexID id  = GetIDByName(inOutTex.GetName().c_str());
         const index idx = ids_.get_idx(id);
 
-        // init texture with raw data
-        if (!inOutTex.Initialize(g_pDevice, name, initData, width, height, mipMapped))
+        // staged: if the resource fits new texels it is kept (and its SRV isn't changed)
+        if (uploader_.IsInitialized())
         {
-            sprintf(g_String, "can't initialize texture: %s", name);
-            throw EngineException(g_String);
+            constexpr DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+            if (!inOutTex.IsUploadCompatible(width, height, format, mipMapped))
+            {
+                if (!inOutTex.InitializeEmpty(g_pDevice, name, width, height, format, mipMapped))
+                {
+                    sprintf(g_String, "can't initialize texture: %s", name);
+                    throw EngineException(g_String);
+                }
+
+                shaderResourceViews_[idx] = inOutTex.GetTextureResourceView();
+                ++srvsVersion_;
+            }
+
+            ID3D11ShaderResourceView* pSRVForMips = (mipMapped) ? inOutTex.GetTextureResourceView() : nullptr;
+            uploader_.Enqueue(inOutTex.GetResource(), pSRVForMips, initData, width, height, format);
+        }
+        else
+        {
+            // init texture with raw data
+            if (!inOutTex.Initialize(g_pDevice, name, initData, width, height, mipMapped))
+            {
+                sprintf(g_String, "can't initialize texture: %s", name);
+                throw EngineException(g_String);
+            }
+
+            // update shader resource view by this texture
+            shaderResourceViews_[idx] = inOutTex.GetTextureResourceView();
+            ++srvsVersion_;
         }
 
-        // update shader resource view by this texture
-        shaderResourceViews_[idx] = inOutTex.GetTextureResourceView();
+        // the whole texture is replaced so its CPU mips (if any) are stale
+        for (index i = 0; i < regionMips_.size(); ++i)
+        {
+            if (regionMips_[i].texID == id)
+            {
+                regionMips_.erase(i);
+                break;
+            }
+        }
     }
     catch (std::bad_alloc& e)
     {
@@ -280,178 +537,1055 @@ void TextureMgr::RecreateTextureFromRawData(
     }
 }
 
-///////////////////////////////////////////////////////////
-
-void TextureMgr::SetTexName(const TexID id, const char* inName)
+//---------------------------------------------------------
+// Desc:   block compress raw data which is generated at runtime (terrain maps):
+//         8-bit data => BC4, color => BC7 by the GPU encoder (BC1 by the CPU
+//         if the GPU one failed); mips are generated before compression;
+//         an image which isn't a multiple of 4 (e.g. a lightmap by 513 heights)
+//         is resized down to it
+// Args:   - data:          actual pixels data (one element per channel)
+//         - width, height: the size of the image (>= 4)
+//         - bpp:           bits per pixel (8, 24 or 32)
+//         - outImage:      compressed mips
+//---------------------------------------------------------
+static void CompressRawData(
+    const uint8* data,
+    const uint width,
+    const uint height,
+    const int bpp,
+    const bool mipMapped,
+    DirectX::ScratchImage& outImage)
 {
-    // update a name of the texture by id
+    using namespace DirectX;
 
-    if (IsNameEmpty(inName))
+    CAssert::True(data,                                     "input ptr to image data array == nullptr");
+    CAssert::True(bpp == 8 || bpp == 24 || bpp == 32,       "input number of bits per pixel must be equal to 8, 24 or 32");
+    CAssert::True((width >= 4) && (height >= 4),            "the size of a block compressed texture must be >= 4");
+
+    const bool        isGray = (bpp == 8);
+    const DXGI_FORMAT format = (isGray) ? DXGI_FORMAT_R8_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
+    ScratchImage      src;
+
+    CAssert::NotFailed(src.Initialize2D(format, width, height, 1, 1), "can't allocate an image for compression");
+
+    // gray texels are compressed as is, colors are expanded into 32 bits
+    if (isGray || (bpp == 32))
     {
-        LogErr("input name is empty");
-        return;
+        const uint   srcPitch = width * (bpp / 8);
+        const Image* pImg     = src.GetImage(0, 0, 0);
+
+        for (uint y = 0; y < height; ++y)
+            memcpy(pImg->pixels + y * pImg->rowPitch, data + y * srcPitch, srcPitch);
+    }
+    else
+    {
+        cvector<uint8> convertedData;
+        ConvertInto32bits(data, width, height, bpp, convertedData);
+        memcpy(src.GetPixels(), convertedData.data(), src.GetPixelsSize());
     }
 
-    const index idx = ids_.get_idx(id);
+    // the top mip must consist of whole blocks (maps are sampled by normalized coords anyway)
+    ScratchImage resized;
 
-    if (ids_[idx] != id)
+    if ((width % 4) || (height % 4))
     {
-        sprintf(g_String, "there is no texture by ID: %ud", id);
-        LogErr(g_String);
-        return;
+        CAssert::NotFailed(
+            Resize(*src.GetImage(0, 0, 0), width & ~3u, height & ~3u, TEX_FILTER_LINEAR, resized),
+            "can't resize an image for compression");
     }
 
-    // length of texture name cannot be bigger than MAX_LENGTH_TEXTURE_NAME
-    size_t sz = strlen(inName);
-    sz = (sz > MAX_LENGTH_TEXTURE_NAME) ? MAX_LENGTH_TEXTURE_NAME : sz;  
+    const ScratchImage& top = (resized.GetImageCount() > 0) ? resized : src;
+    ScratchImage        mipChain;
 
-    // update name
-    names_[idx] = inName;
-    //strncpy(names_[idx].name, inName, sz);
+    if (mipMapped)
+    {
+        CAssert::NotFailed(
+            GenerateMipMaps(*top.GetImage(0, 0, 0), TEX_FILTER_BOX, 0, mipChain),
+            "can't generate mips for compression");
+    }
 
-    textures_[idx].SetName(inName);
-}
+    const ScratchImage& image = (mipMapped) ? mipChain : top;
+    HRESULT             hr    = E_FAIL;
 
+    // BC7 is encoded by the DirectCompute encoder of DirectXTex (on the immediate context)
+    if (!isGray && g_pDevice)
+    {
+        hr = Compress(
+            g_pDevice,
+            image.GetImages(),
+            image.GetImageCount(),
+            image.GetMetadata(),
+            DXGI_FORMAT_BC7_UNORM,
+            TEX_COMPRESS_DEFAULT,
+            TEX_ALPHA_WEIGHT_DEFAULT,
+            outImage);
+    }
 
-///////////////////////////////////////////////////////////
+    if (FAILED(hr))
+    {
+        hr = Compress(
+            image.GetImages(),
+            image.GetImageCount(),
+            image.GetMetadata(),
+            (isGray) ? DXGI_FORMAT_BC4_UNORM : DXGI_FORMAT_BC1_UNORM,
+            TEX_COMPRESS_PARALLEL,
+            TEX_THRESHOLD_DEFAULT,
+            outImage);
+    }
 
-#if 0
-TexID TextureMgr::Add(const TexName& name, Texture& tex)
+    CAssert::NotFailed(hr, "can't compress the image");
+}
+
+//---------------------------------------------------------
+// Desc:   create a block compressed texture from raw data which is generated at
+//         runtime (or recreate the existing texture in place so its ID stays the same)
+// Args:   - name:       a name for texture identification
+//         - data:       actual pixels data (one element per channel)
+//         - width:      the texture width  (is resized down to a multiple of 4)
+//         - height:     the texture height (is resized down to a multiple of 4)
+//         - bpp:        bits per pixel (8 => BC4; 24 or 32 => BC7/BC1)
+//         - mipMapped:  defines if we will generate mipmaps of not
+//         - savePath:   (optional) where to save the compressed texture as .dds
+//         - recreateID: (optional) the texture to recreate
+// Ret:    an ID of the texture (for details look at TextureMgr)
+//---------------------------------------------------------
+TexID TextureMgr::CreateCompressedFromRawData(
+    const char* name,
+    const uint8* data,
+    const uint width,
+    const uint height,
+    const int bpp,
+    const bool mipMapped,
+    const char* savePath,
+    const TexID recreateID)
 {
-    // add a new texture by name and return its generated ID
+    using namespace DirectX;
+    MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+
     try
     {
-        CAssert::NotEmpty(name.empty(), "a texture name (path) cannot be empty");
-
-        // if there is already a texture by such name we just return its ID
-        const bool isNotUniqueName = (names_.find(name) != -1);
+        CAssert::True(!StrHelper::IsEmpty(name), "input name is empty");
 
-        if (isNotUniqueName)
-            return GetIDByName(name);
+        const auto   start = std::chrono::steady_clock::now();
+        ScratchImage compressed;
 
+        CompressRawData(data, width, height, bpp, mipMapped, compressed);
 
-        // else we add a new texture
-        const TexID id = GenID();
+        if (!StrHelper::IsEmpty(savePath))
+        {
+            wchar_t wSavePath[256]{ L'\0' };
+            StrHelper::StrToWide(savePath, wSavePath);
+
+            const HRESULT hr = SaveToDDSFile(
+                compressed.GetImages(),
+                compressed.GetImageCount(),
+                compressed.GetMetadata(),
+                DDS_FLAGS_NONE,
+                wSavePath);
+
+            if (FAILED(hr))
+            {
+                sprintf(g_String, "can't save a compressed texture: %s", savePath);
+                LogErr(g_String);
+            }
+        }
 
-        ids_.push_back(id);
-        names_.push_back(name);
-        textures_.push_back(std::move(tex));
-        shaderResourceViews_.push_back(textures_.back().GetTextureResourceView());
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
 
-        // return an id of the added texture
-        return id;
-    }
-    catch (EngineException& e)
-    {
-        LogErr(e);
-        throw EngineException("can't add a texture by name: " + name);
-    }
-}
-#endif
+        LogMsgf("texture %s is compressed into %s: %u KB => %u KB (%.1f ms)",
+            name,
+            (compressed.GetMetadata().format == DXGI_FORMAT_BC7_UNORM) ? "BC7" :
+            (compressed.GetMetadata().format == DXGI_FORMAT_BC4_UNORM) ? "BC4" : "BC1",
+            (uint)((4 * (uint64)width * height * ((mipMapped) ? 4 : 3) / 3) >> 10),     // RGBA8 texels (+ a third for mips)
+            (uint)(compressed.GetPixelsSize() >> 10),
+            elapsed.count());
 
-///////////////////////////////////////////////////////////
+        // create a new texture
+        if (recreateID == INVALID_TEXTURE_ID)
+        {
+            Texture texture;
 
-TexID TextureMgr::Add(const char* name, Texture&& tex)
-{
-    // add a new texture by name and return its generated ID
-    try
-    {
-        CAssert::True(!IsNameEmpty(name), "a texture name cannot be empty");
+            if (!texture.InitializeFromImage(g_pDevice, name, compressed))
+            {
+                sprintf(g_String, "can't create a compressed texture: %s", name);
+                throw EngineException(g_String);
+            }
 
-        TexID id = INVALID_TEXTURE_ID;
+            return Add(name, std::move(texture));
+        }
 
-        // if there is already a texture with such name we just return its ID
-        id = GetIDByName(name);
-        if (id != 0)
-            return id;
+        // or replace the resource of the existing one
+        const index idx = ids_.get_idx(recreateID);
+        CAssert::True(ids_[idx] == recreateID, "there is no texture by the input ID");
 
+        Texture& tex = TexAt(idx);
 
-        // else we add a new texture
-        id = GenID();
+        if (!tex.InitializeFromImage(g_pDevice, name, compressed))
+        {
+            sprintf(g_String, "can't recreate a compressed texture: %s", name);
+            throw EngineException(g_String);
+        }
 
-        ids_.push_back(id);
-        names_.push_back(name);
+        shaderResourceViews_[idx] = tex.GetTextureResourceView();
+        ++srvsVersion_;
 
-        textures_.push_back(std::move(tex));
-        shaderResourceViews_.push_back(textures_.back().GetTextureResourceView());
+        // the whole texture is replaced so its CPU mips (if any) are stale
+        for (index i = 0; i < regionMips_.size(); ++i)
+        {
+            if (regionMips_[i].texID == recreateID)
+            {
+                regionMips_.erase(i);
+                break;
+            }
+        }
 
-        // return an ID of the added texture
-        return id;
+        return recreateID;
+    }
+    catch (std::bad_alloc& e)
+    {
+        sprintf(g_String, "can't allocate memory for the compressed texture: %s", name);
+        LogErr(e.what());
+        LogErr(g_String);
+        return INVALID_TEXTURE_ID;
     }
     catch (EngineException& e)
     {
         LogErr(e);
-        sprintf(g_String, "can't add a texture by name: %s", name);
-        throw EngineException(g_String);
+        sprintf(g_String, "can't create a compressed texture: %s", name);
+        LogErr(g_String);
+        return INVALID_TEXTURE_ID;
     }
 }
 
-///////////////////////////////////////////////////////////
-
-TexID TextureMgr::LoadFromFile(const char* dirPath, const char* texturePath)
+//---------------------------------------------------------
+// Desc:   convert a rectangle [x0,x1) x [y0,y1) of the image into 32 bits
+// Args:   - data:     pixels of the whole image (8, 24 or 32 bits per pixel)
+//         - width:    width of the image
+//         - outData:  where to write the texel (x0,y0)
+//         - outPitch: number of texels per row of the output
+//---------------------------------------------------------
+static void ConvertRegionInto32bits(
+    const uint8* data,
+    const uint width,
+    const int bpp,
+    const uint x0,
+    const uint y0,
+    const uint x1,
+    const uint y1,
+    uint8* outData,
+    const uint outPitch)
 {
-    // return an ID to the texture which is loaded from the file by input path
-    //
-    // input: dirPath     -- directory relatively to the project working directory
-    //        texturePath -- path to texture relatively to the dirPath
+    const uint bytesPerPixel = (uint)bpp / 8;
 
-
-    // check input params
-    if ((dirPath == nullptr) || (dirPath[0] == '\0'))
+    for (uint y = y0; y < y1; ++y)
     {
-        LogErr("input path to directory is empty!");
-        return INVALID_TEXTURE_ID;
+        const uint8* src = data + ((y * width) + x0) * bytesPerPixel;
+        uint8*       dst = outData + ((y - y0) * outPitch * 4);
+
+        for (uint x = x0; x < x1; ++x, src += bytesPerPixel, dst += 4)
+        {
+            // grayscale
+            if (bpp == 8)
+            {
+                dst[0] = src[0];
+                dst[1] = src[0];
+                dst[2] = src[0];
+                dst[3] = 255;
+            }
+            else
+            {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = (bpp == 32) ? src[3] : 255;
+            }
+        }
     }
+}
 
-    if ((texturePath == nullptr) || (texturePath[0] == '\0'))
+//---------------------------------------------------------
+// Desc:   compute a rectangle of a mip by the 2x2 box filter of the previous mip
+// Args:   - src, srcW, srcH:  RGBA texels of the previous (bigger) mip
+//         - dst, dstW:        RGBA texels of the mip
+//         - x0, y0, x1, y1:   the rectangle in the mip
+//---------------------------------------------------------
+static void DownsampleRegion(
+    const uint8* src,
+    const uint srcW,
+    const uint srcH,
+    uint8* dst,
+    const uint dstW,
+    const uint x0,
+    const uint y0,
+    const uint x1,
+    const uint y1)
+{
+    for (uint y = y0; y < y1; ++y)
     {
-        LogErr("input path to texture is empty!");
-        return INVALID_TEXTURE_ID;
+        const uint8* row0 = src + (std::min(2*y,     srcH-1) * srcW * 4);
+        const uint8* row1 = src + (std::min(2*y + 1, srcH-1) * srcW * 4);
+
+        for (uint x = x0; x < x1; ++x)
+        {
+            const uint sx0 = std::min(2*x,     srcW-1) * 4;
+            const uint sx1 = std::min(2*x + 1, srcW-1) * 4;
+            uint8*     out = dst + ((y * dstW) + x) * 4;
+
+            for (int c = 0; c < 4; ++c)
+                out[c] = (uint8)((row0[sx0+c] + row0[sx1+c] + row1[sx0+c] + row1[sx1+c] + 2) >> 2);
+        }
     }
+}
 
-    // create a full path to the texture (relatively to the project working directory) and load this texture
-    sprintf(g_String, "%s%s", dirPath, texturePath);
-    return LoadFromFile(g_String);
+//---------------------------------------------------------
+// Desc:   upload a rectangle of texels into a mip of the texture
+// Args:   - src:         the texel (x0,y0) of the source
+//         - srcRowPitch: number of bytes per row of the source
+//---------------------------------------------------------
+static void UploadRegion(
+    ID3D11DeviceContext* pContext,
+    ID3D11Resource* pResource,
+    const UINT mip,
+    const uint x0,
+    const uint y0,
+    const uint x1,
+    const uint y1,
+    const uint8* src,
+    const uint srcRowPitch)
+{
+    D3D11_BOX box;
+    box.left   = x0;
+    box.right  = x1;
+    box.top    = y0;
+    box.bottom = y1;
+    box.front  = 0;
+    box.back   = 1;
+
+    pContext->UpdateSubresource(pResource, mip, &box, src, srcRowPitch, 0);
 }
 
 ///////////////////////////////////////////////////////////
 
-TexID TextureMgr::LoadFromFile(const char* path)
+bool TextureMgr::UpdateTextureRegion(
+    ID3D11DeviceContext* pContext,
+    const TexID id,
+    const uint8* data,
+    const uint width,
+    const uint height,
+    const int bpp,
+    const uint x0,
+    const uint y0,
+    const uint x1,
+    const uint y1)
 {
-    // return an ID to the texture which is loaded from the file by input path
-
     try
     {
-#if DEBUG || _DEBUG
-        if (!FileSys::Exists(path))
-            return INVALID_TEXTURE_ID;
-#endif
+        // check input params
+        CAssert::True(pContext != nullptr,                "input ptr to the device context == nullptr");
+        CAssert::True(data != nullptr,                    "input ptr to image data array == nullptr");
+        CAssert::True(bpp == 8 || bpp == 24 || bpp == 32, "input number of bits per pixel must be equal to 8, 24 or 32");
 
-        // if there is already such a texture we just return its ID
-        TexID id = GetIDByName(path);
-        if (id != 0)
-            return id;
+        const index idx = ids_.get_idx(id);
+        CAssert::True(ids_[idx] == id, "there is no texture by the input ID");
 
+        Texture& tex = TexAt(idx);
+        CAssert::True((tex.GetWidth() == width) && (tex.GetHeight() == height), "the size of the image differs from the size of the texture");
 
-        // else we create a new texture from file
-        id = GenID();
+        // clamp the rectangle by the image
+        uint rx0 = x0;
+        uint ry0 = y0;
+        uint rx1 = std::min(x1, width);
+        uint ry1 = std::min(y1, height);
+
+        if ((rx0 >= rx1) || (ry0 >= ry1))
+            return true;
+
+        ID3D11Resource*      pResource = tex.GetResource();
+        D3D11_TEXTURE2D_DESC desc;
+
+        // the staged upload of the whole texture must go before the region
+        if (uploader_.IsPending(pResource))
+            uploader_.Finish(pContext, pResource);
+
+        ((ID3D11Texture2D*)pResource)->GetDesc(&desc);
+
+        // texels of a compressed texture can be replaced only as a whole
+        // (see CreateCompressedFromRawData)
+        if (DirectX::IsCompressed(desc.Format))
+        {
+            sprintf(g_String, "a block compressed texture can't be updated by regions: %s", tex.GetName().c_str());
+            throw EngineException(g_String);
+        }
+
+        // a single channel texture: upload 8-bit texels as is
+        if (desc.Format == DXGI_FORMAT_R8_UNORM)
+        {
+            CAssert::True(bpp == 8, "a single channel texture can be updated only by 8-bit data");
+            UploadRegion(pContext, pResource, 0, rx0, ry0, rx1, ry1, data + (ry0 * width) + rx0, width);
+            return true;
+        }
+
+        // no mipmaps: convert and upload only the rectangle
+        if (desc.MipLevels == 1)
+        {
+            const uint     rectW = rx1 - rx0;
+            cvector<uint8> convertedData(rectW * (ry1 - ry0) * 4);
+
+            ConvertRegionInto32bits(data, width, bpp, rx0, ry0, rx1, ry1, convertedData.data(), rectW);
+            UploadRegion(pContext, pResource, 0, rx0, ry0, rx1, ry1, convertedData.data(), rectW * 4);
+            return true;
+        }
+
+        // update the rectangle of each mip in the CPU copy and upload it
+        const index chainIdx = GetRegionMipChain(id, data, width, height, bpp, desc.MipLevels);
+        uint8*      texels   = regionMips_[chainIdx].texels.data();
+
+        uint offset = 0;
+        uint w      = width;
+        uint h      = height;
+
+        ConvertRegionInto32bits(data, width, bpp, rx0, ry0, rx1, ry1, texels + ((ry0 * w) + rx0) * 4, w);
+        UploadRegion(pContext, pResource, 0, rx0, ry0, rx1, ry1, texels + ((ry0 * w) + rx0) * 4, w * 4);
+
+        for (UINT mip = 1; mip < desc.MipLevels; ++mip)
+        {
+            const uint srcOffset = offset;
+            const uint srcW      = w;
+            const uint srcH      = h;
+
+            offset += (w * h * 4);
+            w = std::max(1U, w >> 1);
+            h = std::max(1U, h >> 1);
+
+            // texels of the mip which cover the changed ones of the previous mip
+            rx0 >>= 1;
+            ry0 >>= 1;
+            rx1 = std::min((rx1 + 1) >> 1, w);
+            ry1 = std::min((ry1 + 1) >> 1, h);
+
+            uint8* mipTexels = texels + offset;
+
+            DownsampleRegion(texels + srcOffset, srcW, srcH, mipTexels, w, rx0, ry0, rx1, ry1);
+            UploadRegion(pContext, pResource, mip, rx0, ry0, rx1, ry1, mipTexels + ((ry0 * w) + rx0) * 4, w * 4);
+        }
+
+        return true;
+    }
+    catch (std::bad_alloc& e)
+    {
+        LogErr(e.what());
+        LogErr("can't allocate memory for updating a region of texture");
+        return false;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        sprintf(g_String, "can't update a region of texture (id: %d)", (int)id);
+        LogErr(g_String);
+        return false;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   get (or create) a CPU copy of the mip chain of the texture
+//         (the mips are made from the raw data by the 2x2 box filter)
+// Ret:    an index of the chain in regionMips_
+//---------------------------------------------------------
+index TextureMgr::GetRegionMipChain(
+    const TexID id,
+    const uint8* data,
+    const uint width,
+    const uint height,
+    const int bpp,
+    const uint numMips)
+{
+    for (index i = 0; i < regionMips_.size(); ++i)
+    {
+        const RegionMipChain& chain = regionMips_[i];
+
+        if ((chain.texID == id) && (chain.width == width) && (chain.height == height))
+            return i;
+    }
+
+    RegionMipChain chain;
+    chain.texID  = id;
+    chain.width  = width;
+    chain.height = height;
+
+    // compute the size of all the mips
+    uint numBytes = 0;
+
+    for (uint mip = 0, w = width, h = height; mip < numMips; ++mip)
+    {
+        numBytes += (w * h * 4);
+        w = std::max(1U, w >> 1);
+        h = std::max(1U, h >> 1);
+    }
+
+    chain.texels.resize(numBytes);
+    uint8* texels = chain.texels.data();
+
+    ConvertRegionInto32bits(data, width, bpp, 0, 0, width, height, texels, width);
+
+    for (uint mip = 1, offset = 0, w = width, h = height; mip < numMips; ++mip)
+    {
+        const uint srcOffset = offset;
+        const uint srcW      = w;
+        const uint srcH      = h;
+
+        offset += (w * h * 4);
+        w = std::max(1U, w >> 1);
+        h = std::max(1U, h >> 1);
+
+        DownsampleRegion(texels + srcOffset, srcW, srcH, texels + offset, w, 0, 0, w, h);
+    }
+
+    regionMips_.push_back(std::move(chain));
+    return regionMips_.size() - 1;
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::SetTexName(const TexID id, const char* inName)
+{
+    // update a name of the texture by id
+
+    if (IsNameEmpty(inName))
+    {
+        LogErr("input name is empty");
+        return;
+    }
+
+    const index idx = ids_.get_idx(id);
+
+    if (ids_[idx] != id)
+    {
+        sprintf(g_String, "there is no texture by ID: %ud", id);
+        LogErr(g_String);
+        return;
+    }
+
+    // length of texture name cannot be bigger than MAX_LENGTH_TEXTURE_NAME
+    size_t sz = strlen(inName);
+    sz = (sz > MAX_LENGTH_TEXTURE_NAME) ? MAX_LENGTH_TEXTURE_NAME : sz;  
+
+    // update name
+    UnindexName(names_[idx].c_str(), id);
+    names_[idx] = inName;
+    IndexName(inName, id);
+    //strncpy(names_[idx].name, inName, sz);
+
+    TexAt(idx).SetName(inName);
+}
+
+
+///////////////////////////////////////////////////////////
+
+#if 0
+TexID TextureMgr::Add(const TexName& name, Texture& tex)
+{
+    // add a new texture by name and return its generated ID
+    try
+    {
+        CAssert::NotEmpty(name.empty(), "a texture name (path) cannot be empty");
+
+        // if there is already a texture by such name we just return its ID
+        const bool isNotUniqueName = (names_.find(name) != -1);
+
+        if (isNotUniqueName)
+            return GetIDByName(name);
+
+
+        // else we add a new texture
+        const TexID id = GenID();
+
+        ids_.push_back(id);
+        names_.push_back(name);
+        Texture& added = PushTexture(std::move(tex));
+        shaderResourceViews_.push_back(added.GetTextureResourceView());
+
+        // return an id of the added texture
+        return id;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        throw EngineException("can't add a texture by name: " + name);
+    }
+}
+#endif
+
+///////////////////////////////////////////////////////////
+
+TexID TextureMgr::Add(const char* name, Texture&& tex)
+{
+    // add a new texture by name and return its generated ID
+    MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+
+    try
+    {
+        CAssert::True(!IsNameEmpty(name), "a texture name cannot be empty");
+
+        TexID id = INVALID_TEXTURE_ID;
+
+        // if there is already a texture with such name we just return its ID
+        id = GetIDByName(name);
+        if (id != 0)
+            return id;
+
+
+        // else we add a new texture
+        id = GenID();
+
+        ids_.push_back(id);
+        names_.push_back(name);
+        IndexName(name, id);
+
+        Texture& added = PushTexture(std::move(tex));
+        shaderResourceViews_.push_back(added.GetTextureResourceView());
+
+        // return an ID of the added texture
+        return id;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        sprintf(g_String, "can't add a texture by name: %s", name);
+        throw EngineException(g_String);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+TexID TextureMgr::LoadFromFile(const char* dirPath, const char* texturePath)
+{
+    // return an ID to the texture which is loaded from the file by input path
+    //
+    // input: dirPath     -- directory relatively to the project working directory
+    //        texturePath -- path to texture relatively to the dirPath
+
+
+    // check input params
+    if ((dirPath == nullptr) || (dirPath[0] == '\0'))
+    {
+        LogErr("input path to directory is empty!");
+        return INVALID_TEXTURE_ID;
+    }
+
+    if ((texturePath == nullptr) || (texturePath[0] == '\0'))
+    {
+        LogErr("input path to texture is empty!");
+        return INVALID_TEXTURE_ID;
+    }
+
+    // create a full path to the texture (relatively to the project working directory) and load this texture
+    sprintf(g_String, "%s%s", dirPath, texturePath);
+    return LoadFromFile(g_String);
+}
+
+///////////////////////////////////////////////////////////
+
+TexID TextureMgr::LoadFromFile(const char* path)
+{
+    // return an ID to the texture which is loaded from the file by input path
+    MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+
+    try
+    {
+#if DEBUG || _DEBUG
+        if (!FileSys::Exists(path))
+            return INVALID_TEXTURE_ID;
+#endif
+
+        // if there is already such a texture we just return its ID
+        TexID id = GetIDByName(path);
+        if (id != 0)
+            return id;
+
+        // the same image by another path: share its GPU resource
+        uint64     contentHash = 0;
+        const bool hasHash     = HashFileContent(path, contentHash);
+        const TexID srcID      = (hasHash) ? FindByContent(contentHash) : INVALID_TEXTURE_ID;
+
+        if (srcID != INVALID_TEXTURE_ID)
+            return AddAlias(path, srcID);
+
+
+        // else we create a new texture from file (a cooked one is preferred
+        // but the texture is still named by the source path)
+        HitchEventScope hitchEvent("texture", path);
+        char cookedPath[256]{ '\0' };
+        const bool isCooked = TextureCooker::FindCooked(path, cookedPath, sizeof(cookedPath));
+
+        id = GenID();
 
         ids_.push_back(id);
         names_.push_back(path);
-        textures_.push_back(std::move(Texture(pDevice_, path)));
-        shaderResourceViews_.push_back(textures_.back().GetTextureResourceView());
+        IndexName(path, id);
+        Texture& added = PushTexture(Texture(pDevice_, (isCooked) ? cookedPath : path));
+        added.SetName(path);
+        shaderResourceViews_.push_back(added.GetTextureResourceView());
+
+        // check if we successfully created this texture
+        bool isSuccess = (added.GetTextureResourceView() != nullptr);
+
+        if (isSuccess && hasHash)
+            contentToID_.emplace(contentHash, id);
+        
+        return (isSuccess) ? id : INVALID_TEXTURE_ID;	
+    }
+    catch (EngineException& e)
+    {
+        sprintf(g_String, "can't create a texture from file: %s", path);
+        LogErr(e);
+        return INVALID_TEXTURE_ID;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+TexID TextureMgr::LoadAsync(const char* path)
+{
+    // return an ID to the texture by path: it is a 1x1 placeholder until
+    // the texture is decoded by a job (the device is free-threaded)
+    MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+
+    if (IsNameEmpty(path))
+    {
+        LogErr("input path to the texture is empty");
+        return INVALID_TEXTURE_ID;
+    }
+
+#if DEBUG || _DEBUG
+    if (!FileSys::Exists(path))
+        return INVALID_TEXTURE_ID;
+#endif
+
+    // if there is already such a texture (maybe still loading) we just return its ID
+    TexID id = GetIDByName(path);
+    if (id != INVALID_TEXTURE_ID)
+        return id;
+
+    Texture placeholder(pDevice_, Colors::UnloadedTextureColor);
+    placeholder.SetName(path);
+
+    id = Add(path, std::move(placeholder));
+
+    AsyncLoad* pLoad = new AsyncLoad();
+    pLoad->id = id;
+    strncpy(pLoad->path, path, sizeof(pLoad->path) - 1);
+
+    StartAsyncLoad(pLoad);
+    return id;
+}
+
+///////////////////////////////////////////////////////////
+
+bool TextureMgr::ReloadAsync(const TexID id)
+{
+    const index idx = ids_.get_idx(id);
+
+    if ((idx < 0) || (ids_[idx] != id))
+    {
+        sprintf(g_String, "can't reload: there is no texture by id: %d", (int)id);
+        LogErr(g_String);
+        return false;
+    }
+
+    const char* path = names_[idx].c_str();
+
+    if (!FileSys::Exists(path))
+        return false;
+
+    // a streamed texture is streamed from scratch (the cooked file is stale if
+    // the source is changed so it is found only if the cooked file is changed)
+    if (streamer_.IsStreamed(id))
+    {
+        char cookedPath[256]{ '\0' };
+        const bool isCooked = TextureCooker::FindCooked(path, cookedPath, sizeof(cookedPath));
+
+        streamer_.Reload(id, (isCooked) ? cookedPath : path);
+        return true;
+    }
+
+    AsyncLoad* pLoad = new AsyncLoad();
+    pLoad->id       = id;
+    pLoad->isReload = true;
+    strncpy(pLoad->path, path, sizeof(pLoad->path) - 1);
+
+    StartAsyncLoad(pLoad);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool TextureMgr::IsReloading(const TexID id) const
+{
+    for (const AsyncLoad* pLoad : asyncLoads_)
+    {
+        if (pLoad->id == id)
+            return true;
+    }
 
-        // check if we successfully created this texture
-        bool isSuccess = (textures_.back().GetTextureResourceView() != nullptr);
-        
-        return (isSuccess) ? id : INVALID_TEXTURE_ID;	
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::StartAsyncLoad(AsyncLoad* pLoad)
+{
+    asyncLoads_.push_back(pLoad);
+
+    ID3D11Device* pDevice = pDevice_;
+
+    g_JobSystem.Run([pDevice, pLoad]()
+    {
+        MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+        HitchEventScope hitchEvent("texture async", pLoad->path);
+
+        // a cooked (block compressed with mips) file is preferred
+        DirectX::ScratchImage image;
+        char                  cookedPath[256]{ '\0' };
+        const bool            isCooked = TextureCooker::FindCooked(pLoad->path, cookedPath, sizeof(cookedPath));
+
+        // the hash is used for content dedup when the texture is swapped in
+        if (!HashFileContent(pLoad->path, pLoad->contentHash))
+            pLoad->contentHash = 0;
+
+        if (Texture::DecodeFromFile((isCooked) ? cookedPath : pLoad->path, image))
+            pLoad->texture.InitializeFromImage(pDevice, pLoad->path, image);
+
+        pLoad->isDone.store(true, std::memory_order_release);
+    }, &asyncLoadsCounter_);
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::FinishAsyncLoads()
+{
+    SwapInAsyncLoads(true);
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::Update(ID3D11DeviceContext* pContext)
+{
+    MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+
+    SwapInAsyncLoads(false);
+    streamer_.Update(pContext, *this);
+
+    if (uploader_.IsInitialized())
+        uploader_.Update(pContext);
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::SwapInAsyncLoads(const bool wait)
+{
+    // replace placeholders by textures which are decoded by jobs
+
+    if (asyncLoads_.empty())
+        return;
+
+    if (wait)
+        g_JobSystem.Wait(asyncLoadsCounter_);
+
+    index numPending = 0;
+
+    for (AsyncLoad* pLoad : asyncLoads_)
+    {
+        if (!pLoad->isDone.load(std::memory_order_acquire))
+        {
+            asyncLoads_[numPending++] = pLoad;
+            continue;
+        }
+
+        // the same image by another path is already loaded: share its GPU resource
+        // (a reloaded texture keeps its own resource since its file is being edited)
+        const TexID srcID = (pLoad->contentHash && !pLoad->isReload) ? FindByContent(pLoad->contentHash) : INVALID_TEXTURE_ID;
+
+        if (srcID != INVALID_TEXTURE_ID)
+        {
+            MakeAlias(srcID, pLoad->path, pLoad->texture);
+            ReplaceTexture(pLoad->id, std::move(pLoad->texture));
+
+            delete pLoad;
+            continue;
+        }
+
+        // the file can't be decoded on the CPU: load it as usual (by the caller thread)
+        if (!pLoad->texture.GetTextureResourceView())
+            pLoad->texture = Texture(pDevice_, pLoad->path);
+
+        // a texture which is failed to be created keeps its placeholder (or the prev content)
+        if (pLoad->texture.GetTextureResourceView())
+        {
+            // the old content of a reloaded texture isn't its content anymore
+            if (pLoad->isReload)
+            {
+                for (auto it = contentToID_.begin(); it != contentToID_.end();)
+                    it = (it->second == pLoad->id) ? contentToID_.erase(it) : std::next(it);
+            }
+
+            ReplaceTexture(pLoad->id, std::move(pLoad->texture));
+
+            if (pLoad->contentHash)
+                contentToID_.emplace(pLoad->contentHash, pLoad->id);
+        }
+
+        delete pLoad;
     }
-    catch (EngineException& e)
+
+    asyncLoads_.resize(numPending);
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::IndexName(const char* name, const TexID id)
+{
+    // the first texture by the name stays in the index
+    if (!IsNameEmpty(name))
+        nameToID_.emplace(HashName(name), id);
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::UnindexName(const char* name, const TexID id)
+{
+    if (IsNameEmpty(name))
+        return;
+
+    const auto it = nameToID_.find(HashName(name));
+
+    if ((it != nameToID_.end()) && (it->second == id))
+        nameToID_.erase(it);
+}
+
+///////////////////////////////////////////////////////////
+
+TexID TextureMgr::FindByContent(const uint64 contentHash) const
+{
+    const auto it = contentToID_.find(contentHash);
+    return (it != contentToID_.end()) ? it->second : INVALID_TEXTURE_ID;
+}
+
+///////////////////////////////////////////////////////////
+
+TexID TextureMgr::AddAlias(const char* name, const TexID srcID)
+{
+    // add a texture by name which shares the GPU resource of the src texture
+    Texture alias;
+    MakeAlias(srcID, name, alias);
+
+    return Add(name, std::move(alias));
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::MakeAlias(const TexID srcID, const char* name, Texture& outAlias)
+{
+    Texture& src = GetTexByID(srcID);
+
+    outAlias.InitializeAlias(src, name);
+
+    dedupStats_.numDeduped++;
+    dedupStats_.bytesSaved += GetTextureBytes(src);
+
+    LogMsgf("texture %s: is an alias of %s (the same content)", name, src.GetName().c_str());
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::EnableStreaming(const TexStreamingParams& params)
+{
+    // textures which are loaded by LoadFromFileStreamed() after this call are streamed
+    streamer_.Initialize(pDevice_, params);
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::EnableStagedUploads(const TexUploadParams& params)
+{
+    // textures which are created from raw data after this call are uploaded by tiles
+    uploader_.Initialize(pDevice_, params);
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::ShutdownLoading()
+{
+    // wait for loading jobs; streamed textures keep their current mips
+    g_JobSystem.Wait(asyncLoadsCounter_);
+
+    for (AsyncLoad* pLoad : asyncLoads_)
+        delete pLoad;
+
+    asyncLoads_.clear();
+    streamer_.Shutdown();
+    uploader_.Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+TexID TextureMgr::LoadFromFileStreamed(const char* path)
+{
+    // return an ID to the texture by path: it is a 1x1 placeholder
+    // until its mips are loaded by the streamer
+    MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+
+    if (!streamer_.IsEnabled())
+        return LoadAsync(path);
+
+    if (IsNameEmpty(path))
     {
-        sprintf(g_String, "can't create a texture from file: %s", path);
-        LogErr(e);
+        LogErr("input path to the texture is empty");
+        return INVALID_TEXTURE_ID;
+    }
+
+#if DEBUG || _DEBUG
+    if (!FileSys::Exists(path))
         return INVALID_TEXTURE_ID;
+#endif
+
+    // if there is already such a texture we just return its ID
+    TexID id = GetIDByName(path);
+    if (id != INVALID_TEXTURE_ID)
+        return id;
+
+    // the name of the texture is a path so exporters still get a path to the file
+    Texture placeholder(pDevice_, Colors::UnloadedTextureColor);
+    placeholder.SetName(path);
+
+    // mips are streamed from a cooked file if there is any
+    char cookedPath[256]{ '\0' };
+    const bool isCooked = TextureCooker::FindCooked(path, cookedPath, sizeof(cookedPath));
+
+    id = Add(path, std::move(placeholder));
+    streamer_.AddTexture(id, (isCooked) ? cookedPath : path);
+
+    return id;
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureMgr::ReplaceTexture(const TexID id, Texture&& tex)
+{
+    const index idx = ids_.get_idx(id);
+
+    if ((idx < 0) || (ids_[idx] != id))
+    {
+        sprintf(g_String, "there is no texture by id: %d", (int)id);
+        LogErr(g_String);
+        return;
     }
+
+    tex.SetName(names_[idx]);
+
+    TexAt(idx)                = std::move(tex);
+    shaderResourceViews_[idx] = TexAt(idx).GetTextureResourceView();
+
+    ++srvsVersion_;
 }
 
 ///////////////////////////////////////////////////////////
@@ -462,6 +1596,8 @@ TexID TextureMgr::LoadTextureArray(
     const size numTextures,
     const DXGI_FORMAT format)
 {
+    MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+
     try
     {
         CAssert::True(!IsNameEmpty(textureObjName), "input name for the texture object is empty");
@@ -483,8 +1619,9 @@ TexID TextureMgr::LoadTextureArray(
         // store data into the texture manager
         ids_.push_back(id);
         names_.push_back(texArr.GetName());
+        IndexName(texArr.GetName().c_str(), id);
         shaderResourceViews_.push_back(texArr.GetTextureResourceView());
-        textures_.push_back(std::move(texArr));
+        PushTexture(std::move(texArr));
 
         return id;
     }
@@ -498,6 +1635,197 @@ TexID TextureMgr::LoadTextureArray(
 
 ///////////////////////////////////////////////////////////
 
+TexID TextureMgr::PackIntoTextureArray(
+    const char* name,
+    const TexID* texIDs,
+    const size numTextures)
+{
+    // pack textures by input IDs into a Texture2DArray: textures must have the same
+    // size/format/mips so we take the most common group of them, the others
+    // stay separate (GetLayerInTexArr() returns -1 for them);
+    // if there is already an array by such name it is replaced
+    MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+
+    try
+    {
+        CAssert::True(!IsNameEmpty(name), "input name for the texture array is empty");
+        CAssert::True(texIDs,             "input ptr to arr of textures IDs == nullptr");
+
+        // get unique valid IDs
+        cvector<TexID> uniqueIDs;
+        uniqueIDs.reserve(numTextures);
+
+        // streamed textures change their size/mips so they aren't packed
+        for (index i = 0; i < numTextures; ++i)
+        {
+            if ((texIDs[i] != INVALID_TEXTURE_ID) && !streamer_.IsStreamed(texIDs[i]))
+                uniqueIDs.push_back(texIDs[i]);
+        }
+
+        std::sort(uniqueIDs.begin(), uniqueIDs.end());
+        uniqueIDs.resize(std::unique(uniqueIDs.begin(), uniqueIDs.end()) - uniqueIDs.begin());
+
+        // get 2D textures and their descriptions (cube maps and arrays are skipped)
+        cvector<TexID>                candidateIDs;
+        cvector<ID3D11Texture2D*>     candidates;
+        cvector<D3D11_TEXTURE2D_DESC> descs;
+
+        for (const TexID id : uniqueIDs)
+        {
+            const index idx = ids_.get_idx(id);
+
+            if ((idx < 0) || (ids_[idx] != id) || !TexAt(idx).GetResource())
+                continue;
+
+            ID3D11Texture2D* pTex2D = nullptr;
+            const HRESULT hr = TexAt(idx).GetResource()->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&pTex2D);
+
+            if (FAILED(hr))
+                continue;
+
+            D3D11_TEXTURE2D_DESC desc;
+            pTex2D->GetDesc(&desc);
+
+            if ((desc.ArraySize != 1) || (desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE))
+            {
+                SafeRelease(&pTex2D);
+                continue;
+            }
+
+            candidateIDs.push_back(id);
+            candidates.push_back(pTex2D);
+            descs.push_back(desc);
+        }
+
+        // find the most common size/format/mips
+        index bestIdx   = -1;
+        int   bestCount = 0;
+
+        for (index i = 0; i < descs.size(); ++i)
+        {
+            int count = 0;
+
+            for (index j = 0; j < descs.size(); ++j)
+            {
+                count += (descs[j].Width     == descs[i].Width)     &&
+                         (descs[j].Height    == descs[i].Height)    &&
+                         (descs[j].MipLevels == descs[i].MipLevels) &&
+                         (descs[j].Format    == descs[i].Format);
+            }
+
+            if (count > bestCount)
+            {
+                bestIdx   = i;
+                bestCount = count;
+            }
+        }
+
+        // collect textures of this group (IDs stay sorted so idx == layer)
+        PackedTexArr              packed;
+        cvector<ID3D11Texture2D*> layers;
+
+        for (index j = 0; (bestCount > 1) && (j < descs.size()); ++j)
+        {
+            const bool isSame =
+                (descs[j].Width     == descs[bestIdx].Width)     &&
+                (descs[j].Height    == descs[bestIdx].Height)    &&
+                (descs[j].MipLevels == descs[bestIdx].MipLevels) &&
+                (descs[j].Format    == descs[bestIdx].Format);
+
+            if (isSame && (layers.size() < D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION))
+            {
+                packed.texIDs.push_back(candidateIDs[j]);
+                layers.push_back(candidates[j]);
+            }
+        }
+
+        // a single texture doesn't need any array
+        if (layers.size() < 2)
+        {
+            for (ID3D11Texture2D*& pTex2D : candidates)
+                SafeRelease(&pTex2D);
+
+            return INVALID_TEXTURE_ID;
+        }
+
+        Texture texArr(pDevice_, name, layers.data(), layers.size());
+
+        for (ID3D11Texture2D*& pTex2D : candidates)
+            SafeRelease(&pTex2D);
+
+        CAssert::True(texArr.GetTextureResourceView(), "can't pack textures into array");
+
+        // replace an existing array or store a new one
+        TexID     id        = GetIDByName(name);
+        const int numLayers = (int)layers.size();
+
+        if (id != INVALID_TEXTURE_ID)
+        {
+            const index idx = ids_.get_idx(id);
+            shaderResourceViews_[idx] = texArr.GetTextureResourceView();
+            TexAt(idx)                = std::move(texArr);
+        }
+        else
+        {
+            id = GenID();
+            ids_.push_back(id);
+            names_.push_back(texArr.GetName());
+            IndexName(texArr.GetName().c_str(), id);
+            shaderResourceViews_.push_back(texArr.GetTextureResourceView());
+            PushTexture(std::move(texArr));
+        }
+
+        packed.arrID = id;
+        bool isReplaced = false;
+
+        for (PackedTexArr& arr : packedArrs_)
+        {
+            if (arr.arrID == id)
+            {
+                arr = std::move(packed);
+                isReplaced = true;
+                break;
+            }
+        }
+
+        if (!isReplaced)
+            packedArrs_.push_back(std::move(packed));
+
+        LogMsgf("packed %d textures into array: %s", numLayers, name);
+        return id;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        sprintf(g_String, "can't pack textures into array: %s", name);
+        LogErr(g_String);
+        return INVALID_TEXTURE_ID;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+int TextureMgr::GetLayerInTexArr(const TexID arrID, const TexID texID) const
+{
+    if ((arrID == INVALID_TEXTURE_ID) || (texID == INVALID_TEXTURE_ID))
+        return -1;
+
+    for (const PackedTexArr& arr : packedArrs_)
+    {
+        if (arr.arrID != arrID)
+            continue;
+
+        const index layer = arr.texIDs.get_idx(texID);
+        const bool  exist = (layer >= 0) && (arr.texIDs[layer] == texID);
+
+        return (exist) ? (int)layer : -1;
+    }
+
+    return -1;
+}
+
+///////////////////////////////////////////////////////////
+
 TexID TextureMgr::CreateWithColor(const Color& color)
 {
     // if there is already a color texture by such ID we just return an ID to it;
@@ -520,7 +1848,7 @@ Texture& TextureMgr::GetTexByID(const TexID id)
     const index idx = ids_.get_idx(id);
     const bool exist = (ids_[idx] == id);
 
-    return textures_[idx * exist];
+    return TexAt(idx * exist);
 }
 
 ///////////////////////////////////////////////////////////
@@ -531,7 +1859,22 @@ Texture* TextureMgr::GetTexPtrByID(const TexID id)
     const index idx = ids_.get_idx(id);
     const bool exist = (ids_[idx] == id);
 
-    return &textures_[idx * exist];
+    return &TexAt(idx * exist);
+}
+
+///////////////////////////////////////////////////////////
+
+SlabHandle TextureMgr::GetTexHandle(const TexID id) const
+{
+    const index idx = ids_.get_idx(id);
+    return ((idx >= 0) && (ids_[idx] == id)) ? texHandles_[idx] : SlabHandle();
+}
+
+///////////////////////////////////////////////////////////
+
+Texture* TextureMgr::GetTexByHandle(const SlabHandle handle)
+{
+    return textures_.Get(handle);
 }
 
 ///////////////////////////////////////////////////////////
@@ -546,8 +1889,10 @@ Texture* TextureMgr::GetTexPtrByName(const char* name)
         return nullptr;
     }
 
-    const index idx = names_.find(name);
-    return (idx != -1) ? &textures_[idx] : &textures_[0];
+    const TexID id  = GetIDByName(name);
+    const index idx = ids_.get_idx(id);
+
+    return ((id != INVALID_TEXTURE_ID) && (ids_[idx] == id)) ? &TexAt(idx) : &TexAt(0);
 }
 
 
@@ -556,17 +1901,25 @@ Texture* TextureMgr::GetTexPtrByName(const char* name)
 // =================================================================================
 TexID TextureMgr::GetIDByName(const char* inName)
 {
-    // return an ID of texture object by input name;
+    // return an ID of texture object by input name (the same file by
+    // a differently written path is found as well);
     // if there is no such a textures we return 0;
 
-    for (index i = 0; i < names_.size(); ++i)
-    {
-        if (strcmp(names_[i].c_str(), inName) == 0)
-            return ids_[i];
-    }
+    if (IsNameEmpty(inName))
+        return INVALID_TEXTURE_ID;
+
+    const auto it = nameToID_.find(HashName(inName));
+
+    if (it == nameToID_.end())
+        return INVALID_TEXTURE_ID;
 
-    // if we didn't find any ID by name we return 0
-    return INVALID_TEXTURE_ID;
+    // check for a collision of hashes
+    const index idx = ids_.get_idx(it->second);
+
+    if ((idx < 0) || (ids_[idx] != it->second) || !IsSameName(names_[idx].c_str(), inName))
+        return INVALID_TEXTURE_ID;
+
+    return it->second;
 }
 
 ///////////////////////////////////////////////////////////
@@ -579,6 +1932,35 @@ TexID TextureMgr::GetTexIdByIdx(const index idx) const
     return (isValidIdx) ? ids_[idx] : INVALID_TEXTURE_ID;
 }
 
+///////////////////////////////////////////////////////////
+
+uint64 TextureMgr::GetGpuMemoryUsage()
+{
+    cvector<ID3D11Resource*> resources;
+    resources.reserve(texHandles_.size());
+
+    for (const SlabHandle handle : texHandles_)
+    {
+        Texture& tex = textures_[handle];
+
+        if (tex.GetResource())
+            resources.push_back(tex.GetResource());
+    }
+
+    std::sort(resources.begin(), resources.end());
+
+    // the staging pool of uploads
+    uint64 bytes = uploader_.GetStats().stagingBytes;
+
+    for (index i = 0; i < resources.size(); ++i)
+    {
+        if ((i == 0) || (resources[i] != resources[i-1]))
+            bytes += GetGpuMemorySize(resources[i]);
+    }
+
+    return bytes;
+}
+
 ///////////////////////////////////////////////////////////
 #if 0
 void TextureMgr::GetIDsByNames(
@@ -712,10 +2094,28 @@ void TextureMgr::AddDefaultTex(const char* name, Texture&& tex)
     // add some default texture into the TextureMgr and
     // set for it a specified id
 
-    ids_.push_back(GenID());
+    const TexID id = GenID();
+
+    ids_.push_back(id);
     names_.push_back(name);
-    textures_.push_back(std::move(tex));
-    shaderResourceViews_.push_back(textures_.back().GetTextureResourceView());
+    IndexName(name, id);
+    Texture& added = PushTexture(std::move(tex));
+    shaderResourceViews_.push_back(added.GetTextureResourceView());
+}
+
+//---------------------------------------------------------
+// Desc:  move the texture into the pool and store its handle;
+//        NOTE: the caller pushes its ID by itself (parallel to texHandles_)
+//---------------------------------------------------------
+Texture& TextureMgr::PushTexture(Texture&& tex)
+{
+    const SlabHandle handle = textures_.Allocate(std::move(tex));
+
+    if (!handle.IsValid())
+        throw EngineException("can't add a texture: the pool of textures is full");
+
+    texHandles_.push_back(handle);
+    return textures_[handle];
 }
 
 } // namespace Core
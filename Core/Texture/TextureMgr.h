@@ -10,16 +10,31 @@
 #pragma once
 
 #include "textureclass.h"
+#include "TextureStreamer.h"
+#include "TextureUploader.h"
 
 #include <cvector.h>
+#include <JobSystem.h>
+#include <SlabPool.h>
 #include <d3d11.h>
 #include <d3dx11tex.h>
 #include <string>
+#include <unordered_map>
 
 
 namespace Core
 {
 
+// textures which are loaded from files with the same content (by different paths)
+// are aliases of a single GPU resource
+struct TexDedupStats
+{
+    uint32 numDeduped = 0;
+    uint64 bytesSaved = 0;                  // VRAM of the aliased resources
+};
+
+///////////////////////////////////////////////////////////
+
 class TextureMgr
 {
 public:
@@ -47,6 +62,13 @@ public:
         const int bpp,
         const bool mipMapped);
 
+    // create a single channel (R8_UNORM) texture without mipmaps from 8-bit data
+    TexID CreateGrayTexture(
+        const char* name,
+        const uint8* data,
+        const uint width,
+        const uint height);
+
     void RecreateTextureFromRawData(
         const char* name,
         const uint8* data,
@@ -56,11 +78,75 @@ public:
         const bool mipMapped,
         Texture& inOutTex);
 
+    // create a block compressed texture from raw data which is generated at runtime
+    // (8-bit data => BC4, color => BC7 by the GPU encoder); if recreateID is valid
+    // the existing texture is recreated in place; if savePath isn't empty the result
+    // is written there as .dds; regions of such a texture can't be updated anymore;
+    // NOTE: the GPU encoder uses the immediate context so call it from the main thread
+    TexID CreateCompressedFromRawData(
+        const char* name,
+        const uint8* data,
+        const uint width,
+        const uint height,
+        const int bpp,
+        const bool mipMapped,
+        const char* savePath,
+        const TexID recreateID = INVALID_TEXTURE_ID);
+
+    // upload only a rectangle [x0,x1) x [y0,y1) of the texture from raw data of
+    // the whole image (the same size as the texture; bpp: 8, 24 or 32;
+    // a single channel texture is updated only by 8-bit data);
+    // for a texture with mipmaps the rectangle of each mip is recomputed from
+    // a CPU copy of the mip chain which is made by the first call for the texture
+    bool UpdateTextureRegion(
+        ID3D11DeviceContext* pContext,
+        const TexID id,
+        const uint8* data,
+        const uint width,
+        const uint height,
+        const int bpp,
+        const uint x0,
+        const uint y0,
+        const uint x1,
+        const uint y1);
+
     TexID Add(const char* name, Texture& tex);
     TexID Add(const char* name, Texture&& tex);
 
     TexID LoadFromFile(const char* dirPath, const char* texturePath);
     TexID LoadFromFile(const char* path);
+
+    // return an ID of the texture right away: it is bound to a placeholder until
+    // the texture is decoded by a job and swapped in by Update()
+    TexID LoadAsync(const char* path);
+
+    // block until all the async loads are swapped in (e.g. before baking)
+    void  FinishAsyncLoads();
+
+    // hot reload: decode the file of the texture (its name) again by a job and
+    // swap it in by Update(); the texture keeps its ID so materials stay valid
+    bool  ReloadAsync(const TexID id);
+    bool  IsReloading(const TexID id) const;
+
+    // mips streaming: the texture is added as a placeholder and its mips are loaded
+    // later by the streamer (if streaming isn't enabled it is loaded by LoadAsync())
+    void  EnableStreaming(const TexStreamingParams& params);
+    void  EnableStagedUploads(const TexUploadParams& params);
+    TexID LoadFromFileStreamed(const char* path);
+
+    // wait for jobs of async loads and streaming
+    void  ShutdownLoading();
+
+    // usage of this frame by the render: a screen size (in pixels) of the textures
+    inline void BeginTexUsageReport()                                                     { streamer_.BeginUsageReport(); }
+    inline void ReportTexUsage(const TexID* ids, const size numIDs, const float sizePx)   { streamer_.ReportUsage(ids, numIDs, sizePx); }
+
+    // swap in async loaded textures and update mips streaming;
+    // NOTE: the immediate context must be free (the render thread is synced)
+    void  Update(ID3D11DeviceContext* pContext);
+
+    // replace the texture by ID (its name stays the same) so SRVs are changed
+    void  ReplaceTexture(const TexID id, Texture&& tex);
         
     TexID LoadTextureArray(
         const char* textureObjName,
@@ -68,6 +154,17 @@ public:
         const size numTextures,
         const DXGI_FORMAT format);
 
+    // pack textures into a Texture2DArray so they can be sampled by layers
+    // with a single binding (only the most common size/format/mips is packed);
+    // returns an ID of the array or INVALID_TEXTURE_ID if nothing to pack
+    TexID PackIntoTextureArray(
+        const char* name,
+        const TexID* texIDs,
+        const size numTextures);
+
+    // returns a layer of the texture in the packed array or -1 if it isn't there
+    int GetLayerInTexArr(const TexID arrID, const TexID texID) const;
+
     // TODO: FIX IT
     //void LoadFromFile(const std::vector<TexPath>& texPaths, std::vector<TexID>& outTexIDs);
 
@@ -81,8 +178,16 @@ public:
     Texture* GetTexPtrByID  (const TexID id);
     Texture* GetTexPtrByName(const char* name);
 
+    // a handle stays valid (and the texture keeps its address) until the manager is destroyed
+    SlabHandle GetTexHandle  (const TexID id) const;
+    Texture*   GetTexByHandle(const SlabHandle handle);
+
     TexID GetIDByName (const char* name);
     TexID GetTexIdByIdx(const index idx) const;
+    inline size GetNumTextures() const { return ids_.size(); }
+
+    // video memory of all the textures (a resource shared by aliases is counted once)
+    uint64 GetGpuMemoryUsage();
     //void GetIDsByNames(const char* names, const size numNames, cvector<TexID>& outIDs);
 
     ID3D11ShaderResourceView* GetSRVByTexID  (const TexID texID);
@@ -92,6 +197,17 @@ public:
     inline size                             GetNumShaderResourceViews()   const { return shaderResourceViews_.size(); }
 
     inline bool                             IsNameEmpty(const char* name) const { return ((name == nullptr) || (name[0] == '\0')); }
+
+    // is increased each time when any SRV is replaced (cached SRVs must be refreshed)
+    inline uint32                           GetSRVsVersion()              const { return srvsVersion_; }
+
+    inline size                             GetNumAsyncLoads()            const { return asyncLoads_.size(); }
+    inline const TexDedupStats&             GetDedupStats()               const { return dedupStats_; }
+    inline bool                             IsStreamingEnabled()          const { return streamer_.IsEnabled(); }
+    inline bool                             IsStreamed(const TexID id)    const { return streamer_.IsStreamed(id); }
+    inline const TexStreamingStats&         GetStreamingStats()           const { return streamer_.GetStats(); }
+    inline bool                             IsStagedUploads()             const { return uploader_.IsInitialized(); }
+    inline const TexUploadStats&            GetUploadStats()              const { return uploader_.GetStats(); }
 #if 0
     void GetAllTexturesPathsWithinDirectory(
         const std::string& pathToDir,
@@ -100,10 +216,60 @@ public:
 
 private:
     void AddDefaultTex(const char* name, Texture&& tex);
+    void SwapInAsyncLoads(const bool wait);
+
+    struct AsyncLoad;
+    void StartAsyncLoad(AsyncLoad* pLoad);
+
+    // names are indexed by hashes of their normalized form (lowercase, '/' separators,
+    // without "." and ".." parts) so the same file by different paths is found
+    void  IndexName  (const char* name, const TexID id);
+    void  UnindexName(const char* name, const TexID id);
+
+    // content dedup: ID of a texture loaded from a file with the same content (or 0)
+    TexID FindByContent(const uint64 contentHash) const;
+    TexID AddAlias (const char* name, const TexID srcID);
+    void  MakeAlias(const TexID srcID, const char* name, Texture& outAlias);
 
     inline int GenID() { return lastTexID_++; }
 
+    // textures are stored in the pool so they never move when new ones are added
+    inline Texture& TexAt(const index idx) { return textures_[texHandles_[idx]]; }
+    Texture&        PushTexture(Texture&& tex);
+
+    index GetRegionMipChain(
+        const TexID id,
+        const uint8* data,
+        const uint width,
+        const uint height,
+        const int bpp,
+        const uint numMips);
+
 private:
+    struct PackedTexArr
+    {
+        TexID          arrID = INVALID_TEXTURE_ID;
+        cvector<TexID> texIDs;                      // SORTED: idx == layer in the array
+    };
+
+    struct AsyncLoad
+    {
+        TexID             id = INVALID_TEXTURE_ID;
+        char              path[256]{ '\0' };         // of the source file (the texture name)
+        uint64            contentHash = 0;            // of the source file (0: can't be read)
+        Texture           texture;
+        bool              isReload = false;           // the texture is already loaded (isn't deduped again)
+        std::atomic<bool> isDone = false;
+    };
+
+    struct RegionMipChain
+    {
+        TexID          texID  = INVALID_TEXTURE_ID;
+        uint           width  = 0;
+        uint           height = 0;
+        cvector<uint8> texels;                      // RGBA texels of all the mips one after another
+    };
+
     static TexID         lastTexID_;
     static TextureMgr*   pInstance_;
     ID3D11Device*        pDevice_ = nullptr;
@@ -111,7 +277,22 @@ private:
     cvector<TexID>       ids_;                 // SORTED array of unique IDs
     cvector<SRV*>        shaderResourceViews_;
     cvector<std::string> names_;               // name (there can be path) which is used for searching of texture
-    cvector<Texture>     textures_;
+    cvector<SlabHandle>  texHandles_;          // of textures in the pool (parallel to ids_)
+    SlabPool<Texture>    textures_;
+
+    cvector<PackedTexArr> packedArrs_;        // arrays made by PackIntoTextureArray()
+    cvector<RegionMipChain> regionMips_;      // CPU mips of textures updated by UpdateTextureRegion()
+
+    std::unordered_map<uint64, TexID> nameToID_;      // hash of a normalized name => ID
+    std::unordered_map<uint64, TexID> contentToID_;   // hash of a file content => ID of the texture which owns the resource
+    TexDedupStats        dedupStats_;
+
+    cvector<AsyncLoad*>  asyncLoads_;
+    JobCounter           asyncLoadsCounter_;
+
+    TextureStreamer      streamer_;
+    TextureUploader      uploader_;
+    uint32               srvsVersion_ = 0;
 
 
     // transient arrays are used in GetSRVsByTexIDs()
@@ -0,0 +1,525 @@
+// =================================================================================
+// Filename:     TextureStreamer.cpp
+// Description:  implementation of the TextureStreamer's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "TextureStreamer.h"
+#include "TextureMgr.h"
+#include <DirectXTex.h>
+#include <HitchRecorder.h>
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// Desc:  get max(width, height) of the mip
+//---------------------------------------------------------
+static uint GetMipSize(const uint width, const uint height, const int mip)
+{
+    const uint w = ((width  >> mip) > 0) ? (width  >> mip) : 1;
+    const uint h = ((height >> mip) > 0) ? (height >> mip) : 1;
+
+    return (w > h) ? w : h;
+}
+
+//---------------------------------------------------------
+// Desc:  get the most detailed mip which isn't bigger than maxSize
+//---------------------------------------------------------
+static int GetMipBySize(const uint width, const uint height, const int numMips, const uint maxSize)
+{
+    int mip = 0;
+
+    while ((mip + 1 < numMips) && (GetMipSize(width, height, mip) > maxSize))
+        ++mip;
+
+    return mip;
+}
+
+//---------------------------------------------------------
+// Desc:  decode the texture file and create the texture from mips which
+//        aren't bigger than pLoad->maxSize (is executed by a worker thread)
+//---------------------------------------------------------
+template <typename Load>
+static void LoadMips(ID3D11Device* pDevice, Load* pLoad)
+{
+    MEM_TAG_SCOPE(MEM_TAG_TEXTURES);
+    HitchEventScope hitchEvent("texture streaming", pLoad->path);
+
+    DirectX::ScratchImage image;
+
+    if (Texture::DecodeFromFile(pLoad->path, image))
+    {
+        const DirectX::TexMetadata& metadata = image.GetMetadata();
+
+        pLoad->format     = metadata.format;
+        pLoad->fullWidth  = (uint)metadata.width;
+        pLoad->fullHeight = (uint)metadata.height;
+        pLoad->numMips    = (int)metadata.mipLevels;
+
+        const int firstMip = GetMipBySize(pLoad->fullWidth, pLoad->fullHeight, pLoad->numMips, pLoad->maxSize);
+        pLoad->texture.InitializeFromImage(pDevice, pLoad->path, image, (uint)firstMip);
+    }
+
+    pLoad->isDone.store(true, std::memory_order_release);
+}
+
+
+// =================================================================================
+// Public API
+// =================================================================================
+void TextureStreamer::Initialize(ID3D11Device* pDevice, const TexStreamingParams& params)
+{
+    CAssert::NotNullptr(pDevice, "ptr to the device == nullptr");
+
+    pDevice_ = pDevice;
+    params_  = params;
+
+    params_.minResidentSize  = (params_.minResidentSize  > 0) ? params_.minResidentSize  : 1;
+    params_.maxLoadsInFlight = (params_.maxLoadsInFlight > 0) ? params_.maxLoadsInFlight : 1;
+
+    sprintf(g_String, "texture streaming: budget %llu MB, min resident size %u",
+        (unsigned long long)(params_.budgetBytes >> 20), params_.minResidentSize);
+    LogMsg(g_String);
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureStreamer::Shutdown()
+{
+    // the jobs write into pending loads so wait for them before deleting
+    g_JobSystem.Wait(loadsCounter_);
+
+    for (PendingLoad* pLoad : pendingLoads_)
+        delete pLoad;
+
+    pendingLoads_.clear();
+    ids_.clear();
+    textures_.clear();
+    lruOrder_.clear();
+
+    stats_   = TexStreamingStats();
+    pDevice_ = nullptr;
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureStreamer::AddTexture(const TexID id, const char* path)
+{
+    if (!IsEnabled() || (id == INVALID_TEXTURE_ID) || StrHelper::IsEmpty(path))
+        return;
+
+    if (Find(id))
+        return;
+
+    StreamedTex tex;
+    tex.id             = id;
+    tex.lastUsedReport = usageReport_;
+    strncpy(tex.path, path, sizeof(tex.path) - 1);
+
+    // ids are generated by increasing so the arr stays SORTED
+    ids_.push_back(id);
+    textures_.push_back(tex);
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureStreamer::Reload(const TexID id, const char* path)
+{
+    StreamedTex* pTex = Find(id);
+
+    if (!pTex || StrHelper::IsEmpty(path))
+        return;
+
+    // a load in flight is of the old file: its result is dropped by the generation
+    strncpy(pTex->path, path, sizeof(pTex->path) - 1);
+    pTex->generation++;
+    pTex->fullWidth     = 0;
+    pTex->fullHeight    = 0;
+    pTex->numMips       = 0;
+    pTex->residentMip   = -1;
+    pTex->residentBytes = 0;
+    pTex->fadeLod       = 0;
+    pTex->isLoading     = false;
+    pTex->isBroken      = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureStreamer::BeginUsageReport()
+{
+    ++usageReport_;
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureStreamer::ReportUsage(const TexID* ids, const size numIDs, const float screenSizePx)
+{
+    // the first report of the texture in the current usage report resets its wanted size
+    for (index i = 0; i < numIDs; ++i)
+    {
+        if (ids[i] == INVALID_TEXTURE_ID)
+            continue;
+
+        StreamedTex* pTex = Find(ids[i]);
+
+        if (!pTex)
+            continue;
+
+        if (pTex->lastUsedReport != usageReport_)
+        {
+            pTex->lastUsedReport = usageReport_;
+            pTex->wantedSize     = screenSizePx;
+        }
+        else if (screenSizePx > pTex->wantedSize)
+        {
+            pTex->wantedSize = screenSizePx;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureStreamer::Update(ID3D11DeviceContext* pContext, TextureMgr& mgr)
+{
+    if (!IsEnabled())
+        return;
+
+    FinishLoads(pContext, mgr);
+    FadeInMips(pContext, mgr);
+    ComputeTargets();
+    DropMips(pContext, mgr);
+    StartLoads();
+
+    stats_.numTextures   = (uint32)textures_.size();
+    stats_.numLoading    = (uint32)pendingLoads_.size();
+    stats_.residentBytes = 0;
+
+    for (const StreamedTex& tex : textures_)
+        stats_.residentBytes += tex.residentBytes;
+}
+
+///////////////////////////////////////////////////////////
+
+bool TextureStreamer::IsStreamed(const TexID id) const
+{
+    const index idx = ids_.get_idx(id);
+    return (idx >= 0) && (ids_[idx] == id);
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+TextureStreamer::StreamedTex* TextureStreamer::Find(const TexID id)
+{
+    const index idx = ids_.get_idx(id);
+    return ((idx >= 0) && (ids_[idx] == id)) ? &textures_[idx] : nullptr;
+}
+
+//---------------------------------------------------------
+// Desc:   swap in textures which were created by jobs; if a texture gets
+//         more detailed mips they are faded in from the prev resident mip
+//---------------------------------------------------------
+void TextureStreamer::FinishLoads(ID3D11DeviceContext* pContext, TextureMgr& mgr)
+{
+    index numPending = 0;
+
+    for (PendingLoad* pLoad : pendingLoads_)
+    {
+        if (!pLoad->isDone.load(std::memory_order_acquire))
+        {
+            pendingLoads_[numPending++] = pLoad;
+            continue;
+        }
+
+        StreamedTex* pTex = Find(pLoad->id);
+        Texture&     loaded = pLoad->texture;
+
+        // the file was reloaded after the load had been started
+        if (pTex && (pLoad->generation != pTex->generation))
+        {
+            delete pLoad;
+            continue;
+        }
+
+        if (pTex && !loaded.GetTextureResourceView())
+        {
+            pTex->isLoading = false;
+            pTex->isBroken  = true;
+        }
+        else if (pTex)
+        {
+            pTex->isLoading  = false;
+            pTex->format     = pLoad->format;
+            pTex->fullWidth  = pLoad->fullWidth;
+            pTex->fullHeight = pLoad->fullHeight;
+            pTex->numMips    = pLoad->numMips;
+
+            const int newMip = GetMipBySize(pTex->fullWidth, pTex->fullHeight, pTex->numMips, GetMipSize(loaded.GetWidth(), loaded.GetHeight(), 0));
+
+            // mips may have been dropped while loading: use the result only if it is better
+            if ((pTex->residentMip < 0) || (newMip < pTex->residentMip))
+            {
+                // fade from the prev resident mip (there is nothing to fade from a placeholder)
+                pTex->fadeLod = (pTex->residentMip < 0) ? 0.0f : (float)(pTex->residentMip - newMip);
+
+                if (pTex->fadeLod > 0.0f)
+                    pContext->SetResourceMinLOD(loaded.GetResource(), pTex->fadeLod);
+
+                pTex->residentMip   = newMip;
+                pTex->residentBytes = GetMipsBytes(*pTex, newMip);
+
+                mgr.ReplaceTexture(pTex->id, std::move(loaded));
+                stats_.numLoaded++;
+            }
+        }
+
+        delete pLoad;
+    }
+
+    pendingLoads_.resize(numPending);
+}
+
+//---------------------------------------------------------
+// Desc:   lower the min LOD of textures with new mips towards 0 (the most detailed)
+//---------------------------------------------------------
+void TextureStreamer::FadeInMips(ID3D11DeviceContext* pContext, TextureMgr& mgr)
+{
+    for (StreamedTex& tex : textures_)
+    {
+        if (tex.fadeLod <= 0.0f)
+            continue;
+
+        tex.fadeLod -= MIP_FADE_SPEED;
+        tex.fadeLod  = (tex.fadeLod > 0.0f) ? tex.fadeLod : 0.0f;
+
+        if (ID3D11Resource* pResource = mgr.GetTexByID(tex.id).GetResource())
+            pContext->SetResourceMinLOD(pResource, tex.fadeLod);
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   choose mips which will be resident: the wanted ones if all of them
+//         fit into the budget; else textures which weren't seen for the longest
+//         time keep only low mips and then all the seen ones lose a mip at a time
+//---------------------------------------------------------
+void TextureStreamer::ComputeTargets()
+{
+    uint64 totalBytes = 0;
+
+    lruOrder_.resize(0);
+
+    for (index i = 0; i < textures_.size(); ++i)
+    {
+        StreamedTex& tex = textures_[i];
+
+        if (tex.isBroken)
+        {
+            tex.targetMip = tex.residentMip;
+            continue;
+        }
+
+        // the file isn't read yet: load only low mips
+        if (tex.fullWidth == 0)
+        {
+            tex.targetMip = 0;
+            continue;
+        }
+
+        const int  minMip = GetMinResidentMip(tex);
+        const bool isSeen = (tex.lastUsedReport == usageReport_);
+
+        // a texture which isn't seen now keeps its mips until the budget is exceeded
+        if (isSeen)
+            tex.targetMip = GetWantedMip(tex);
+        else
+            tex.targetMip = (tex.residentMip >= 0 && tex.residentMip < minMip) ? tex.residentMip : minMip;
+
+        totalBytes += GetMipsBytes(tex, tex.targetMip);
+        lruOrder_.push_back(i);
+    }
+
+    stats_.wantedBytes = totalBytes;
+
+    if (totalBytes <= params_.budgetBytes)
+        return;
+
+    // the least recently used first
+    std::sort(lruOrder_.begin(), lruOrder_.end(), [this](const index a, const index b)
+    {
+        return textures_[a].lastUsedReport < textures_[b].lastUsedReport;
+    });
+
+    // textures which aren't seen now keep only their low mips
+    for (const index i : lruOrder_)
+    {
+        StreamedTex& tex = textures_[i];
+
+        if ((totalBytes <= params_.budgetBytes) || (tex.lastUsedReport == usageReport_))
+            break;
+
+        const int minMip = GetMinResidentMip(tex);
+
+        totalBytes   -= GetMipsBytes(tex, tex.targetMip) - GetMipsBytes(tex, minMip);
+        tex.targetMip = minMip;
+    }
+
+    // all the seen textures lose a mip at a time (the most detailed one is the biggest)
+    bool isChanged = true;
+
+    while ((totalBytes > params_.budgetBytes) && isChanged)
+    {
+        isChanged = false;
+
+        for (const index i : lruOrder_)
+        {
+            StreamedTex& tex = textures_[i];
+
+            if (tex.targetMip >= GetMinResidentMip(tex))
+                continue;
+
+            totalBytes -= GetMipsBytes(tex, tex.targetMip) - GetMipsBytes(tex, tex.targetMip + 1);
+            tex.targetMip++;
+            isChanged = true;
+
+            if (totalBytes <= params_.budgetBytes)
+                break;
+        }
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   drop mips of textures which are more detailed than their targets
+//         by a GPU copy of the rest mips into a smaller texture
+//---------------------------------------------------------
+void TextureStreamer::DropMips(ID3D11DeviceContext* pContext, TextureMgr& mgr)
+{
+    int numDrops = 0;
+
+    for (StreamedTex& tex : textures_)
+    {
+        if (numDrops >= params_.maxDropsPerFrame)
+            break;
+
+        if ((tex.residentMip < 0) || (tex.targetMip <= tex.residentMip) || tex.isLoading)
+            continue;
+
+        Texture smaller;
+
+        if (!smaller.InitializeFromMips(pDevice_, pContext, mgr.GetTexByID(tex.id), (uint)(tex.targetMip - tex.residentMip)))
+        {
+            // block compressed mips can't be dropped below whole blocks
+            tex.targetMip = tex.residentMip;
+            continue;
+        }
+
+        tex.residentMip   = GetMipBySize(tex.fullWidth, tex.fullHeight, tex.numMips, GetMipSize(smaller.GetWidth(), smaller.GetHeight(), 0));
+        tex.residentBytes = GetMipsBytes(tex, tex.residentMip);
+        tex.fadeLod       = 0.0f;
+
+        mgr.ReplaceTexture(tex.id, std::move(smaller));
+        stats_.numDropped++;
+        ++numDrops;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   start jobs for textures which need more detailed mips:
+//         placeholders first, then the most recently used ones
+//---------------------------------------------------------
+void TextureStreamer::StartLoads()
+{
+    for (StreamedTex& tex : textures_)
+    {
+        if (pendingLoads_.size() >= params_.maxLoadsInFlight)
+            return;
+
+        if ((tex.residentMip < 0) && !tex.isLoading && !tex.isBroken)
+            StartLoad(tex);
+    }
+
+    // upgrades: the most recently used first (lruOrder_ is sorted by usage
+    // only if the budget is exceeded; else all of them are seen anyway)
+    for (index i = lruOrder_.size() - 1; i >= 0; --i)
+    {
+        if (pendingLoads_.size() >= params_.maxLoadsInFlight)
+            return;
+
+        StreamedTex& tex = textures_[lruOrder_[i]];
+
+        if (!tex.isLoading && !tex.isBroken && (tex.residentMip >= 0) && (tex.targetMip < tex.residentMip))
+            StartLoad(tex);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureStreamer::StartLoad(StreamedTex& tex)
+{
+    PendingLoad* pLoad = new PendingLoad();
+
+    pLoad->id         = tex.id;
+    pLoad->generation = tex.generation;
+    strncpy(pLoad->path, tex.path, sizeof(pLoad->path) - 1);
+
+    // the size of the file isn't known yet: load only the low mips
+    pLoad->maxSize = (tex.fullWidth == 0) ?
+        params_.minResidentSize :
+        GetMipSize(tex.fullWidth, tex.fullHeight, tex.targetMip);
+
+    tex.isLoading = true;
+    pendingLoads_.push_back(pLoad);
+
+    ID3D11Device* pDevice = pDevice_;
+    g_JobSystem.Run([pDevice, pLoad]() { LoadMips(pDevice, pLoad); }, &loadsCounter_);
+}
+
+///////////////////////////////////////////////////////////
+
+int TextureStreamer::GetMinResidentMip(const StreamedTex& tex) const
+{
+    return GetMipBySize(tex.fullWidth, tex.fullHeight, tex.numMips, params_.minResidentSize);
+}
+
+///////////////////////////////////////////////////////////
+
+int TextureStreamer::GetWantedMip(const StreamedTex& tex) const
+{
+    // the least detailed mip which is still not smaller than the screen size
+    const int minMip = GetMinResidentMip(tex);
+    int       mip    = 0;
+
+    while ((mip < minMip) && ((float)GetMipSize(tex.fullWidth, tex.fullHeight, mip + 1) >= tex.wantedSize))
+        ++mip;
+
+    return mip;
+}
+
+///////////////////////////////////////////////////////////
+
+uint64 TextureStreamer::GetMipsBytes(const StreamedTex& tex, const int topMip) const
+{
+    // the number of bytes of mips [topMip, numMips)
+    uint64 bytes = 0;
+
+    for (int mip = (topMip > 0) ? topMip : 0; mip < tex.numMips; ++mip)
+    {
+        const uint w = ((tex.fullWidth  >> mip) > 0) ? (tex.fullWidth  >> mip) : 1;
+        const uint h = ((tex.fullHeight >> mip) > 0) ? (tex.fullHeight >> mip) : 1;
+
+        size_t rowPitch   = 0;
+        size_t slicePitch = 0;
+
+        if (SUCCEEDED(DirectX::ComputePitch(tex.format, w, h, rowPitch, slicePitch)))
+            bytes += slicePitch;
+        else
+            bytes += (uint64)w * h * 4;
+    }
+
+    return bytes;
+}
+
+} // namespace Core
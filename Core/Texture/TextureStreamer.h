@@ -0,0 +1,160 @@
+// =================================================================================
+// Filename:     TextureStreamer.h
+// Description:  streaming of texture mips from disk within a VRAM budget:
+//
+//               - a streamed texture starts as a 1x1 placeholder and its low
+//                 mips (up to minResidentSize) are loaded right after it;
+//               - the render prep reports a screen size (in pixels) of textures
+//                 of visible entts so each texture gets a wanted mip;
+//               - mips are decoded and the texture is created by a job (the device
+//                 is free-threaded) and it is swapped in by the main thread; added
+//                 mips are faded in by SetResourceMinLOD() so they don't pop;
+//               - if the wanted mips don't fit into the budget, textures which
+//                 weren't seen for the longest time are dropped to their low
+//                 mips first (LRU) and then all the seen ones lose a mip at a time;
+//                 mips are dropped by a GPU copy into a smaller texture
+//
+//               NOTE: D3D11 has no partially resident textures (without tiled
+//                     resources) so each set of resident mips is a separate resource
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "textureclass.h"
+
+#include <cvector.h>
+#include <JobSystem.h>
+#include <d3d11.h>
+
+
+namespace Core
+{
+
+class TextureMgr;
+
+// =================================================================================
+// Data structures
+// =================================================================================
+struct TexStreamingParams
+{
+    uint64 budgetBytes      = 1024ULL << 20;   // VRAM for mips of streamed textures
+    uint   minResidentSize  = 64;              // mips of this size (and less) are always resident
+    int    maxLoadsInFlight = 4;               // jobs which decode textures at once
+    int    maxDropsPerFrame = 4;               // GPU copies into smaller textures per frame
+};
+
+///////////////////////////////////////////////////////////
+
+struct TexStreamingStats
+{
+    uint64 residentBytes = 0;
+    uint64 wantedBytes   = 0;                  // before the budget is applied
+    uint32 numTextures   = 0;
+    uint32 numLoading    = 0;
+    uint32 numLoaded     = 0;                  // since the start
+    uint32 numDropped    = 0;                  // since the start
+};
+
+// =================================================================================
+// Class
+// =================================================================================
+class TextureStreamer
+{
+public:
+    TextureStreamer() {}
+    ~TextureStreamer() { Shutdown(); }
+
+    // restrict a copying of this class instance
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    void Initialize(ID3D11Device* pDevice, const TexStreamingParams& params);
+
+    // wait for the loading jobs and forget all the textures
+    void Shutdown();
+
+    // start streaming of the texture (it is already added with a placeholder)
+    void AddTexture(const TexID id, const char* path);
+
+    // the file of the texture is changed: stream it from scratch (by the path);
+    // the current mips stay bound until the low mips of the new file are loaded
+    void Reload(const TexID id, const char* path);
+
+    // usage of this frame: textures which aren't reported are candidates for eviction
+    void BeginUsageReport();
+    void ReportUsage(const TexID* ids, const size numIDs, const float screenSizePx);
+
+    // swap in loaded textures, fade in their mips, apply the budget and start new loads;
+    // NOTE: the immediate context must be free (the render thread is synced)
+    void Update(ID3D11DeviceContext* pContext, TextureMgr& mgr);
+
+    bool IsStreamed(const TexID id) const;
+
+    inline bool                     IsEnabled() const { return pDevice_ != nullptr; }
+    inline const TexStreamingStats& GetStats()  const { return stats_; }
+
+private:
+    struct StreamedTex
+    {
+        TexID       id             = INVALID_TEXTURE_ID;
+        char        path[256]{ '\0' };
+        DXGI_FORMAT format         = DXGI_FORMAT_UNKNOWN;
+        uint        fullWidth      = 0;            // of the top mip in the file (0: the file isn't read yet)
+        uint        fullHeight     = 0;
+        int         numMips        = 0;            // of the full chain
+        int         residentMip    = -1;           // the most detailed resident mip (-1: only a placeholder)
+        int         targetMip      = 0;
+        float       wantedSize     = 0;            // the max reported screen size (in pixels)
+        float       fadeLod        = 0;            // the current min LOD of the resource
+        uint64      residentBytes  = 0;
+        uint32      lastUsedReport = 0;
+        uint32      generation     = 0;            // is increased by each reload of the file
+        bool        isLoading      = false;
+        bool        isBroken       = false;        // the file can't be decoded
+    };
+
+    struct PendingLoad
+    {
+        TexID             id         = INVALID_TEXTURE_ID;
+        char              path[256]{ '\0' };
+        uint              maxSize    = 0;          // max(width, height) of the top mip to load
+        Texture           texture;
+        DXGI_FORMAT       format     = DXGI_FORMAT_UNKNOWN;
+        uint              fullWidth  = 0;
+        uint              fullHeight = 0;
+        int               numMips    = 0;
+        uint32            generation = 0;          // of the texture when the load is started
+        std::atomic<bool> isDone     = false;
+    };
+
+    StreamedTex* Find(const TexID id);
+
+    void FinishLoads(ID3D11DeviceContext* pContext, TextureMgr& mgr);
+    void FadeInMips (ID3D11DeviceContext* pContext, TextureMgr& mgr);
+    void ComputeTargets();
+    void DropMips   (ID3D11DeviceContext* pContext, TextureMgr& mgr);
+    void StartLoads ();
+    void StartLoad  (StreamedTex& tex);
+
+    int    GetMinResidentMip(const StreamedTex& tex) const;
+    int    GetWantedMip     (const StreamedTex& tex) const;
+    uint64 GetMipsBytes     (const StreamedTex& tex, const int topMip) const;
+
+private:
+    ID3D11Device*          pDevice_     = nullptr;
+    TexStreamingParams     params_;
+    TexStreamingStats      stats_;
+
+    cvector<TexID>         ids_;                   // SORTED (ids are generated by increasing)
+    cvector<StreamedTex>   textures_;
+    cvector<PendingLoad*>  pendingLoads_;
+    cvector<index>         lruOrder_;              // transient: idxs of textures sorted by last usage
+    JobCounter             loadsCounter_;
+
+    uint32                 usageReport_ = 0;       // idx of the current usage report
+
+    static constexpr float MIP_FADE_SPEED = 0.25f; // mips per frame
+};
+
+} // namespace Core
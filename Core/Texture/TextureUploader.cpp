@@ -0,0 +1,341 @@
+// =================================================================================
+// Filename:     TextureUploader.cpp
+// Description:  implementation of the TextureUploader's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include <CoreCommon/pch.h>
+#include "TextureUploader.h"
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// Desc:  bytes per texel of the supported upload formats (0 - unsupported)
+//---------------------------------------------------------
+static uint GetBytesPerTexel(const DXGI_FORMAT format)
+{
+    switch (format)
+    {
+        case DXGI_FORMAT_R8G8B8A8_UNORM: return 4;
+        case DXGI_FORMAT_R8_UNORM:       return 1;
+        default:                         return 0;
+    }
+}
+
+
+// =================================================================================
+//                               PUBLIC METHODS
+// =================================================================================
+void TextureUploader::Initialize(ID3D11Device* pDevice, const TexUploadParams& params)
+{
+    CAssert::True(pDevice != nullptr,         "input ptr to the device == nullptr");
+    CAssert::True(params.budgetBytes > 0,     "budget of texture uploads must be > 0");
+    CAssert::True(params.maxStagingTiles > 0, "max number of staging tiles must be > 0");
+
+    pDevice_ = pDevice;
+    params_  = params;
+
+    LogMsgf("texture uploads: staged by %u tiles, budget %llu KB per frame",
+            TILE_SIZE, (unsigned long long)(params.budgetBytes >> 10));
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureUploader::Shutdown()
+{
+    for (Upload* pUpload : uploads_)
+        ReleaseUpload(pUpload);
+
+    for (StagingTile& tile : tiles_)
+        SafeRelease(&tile.pTex);
+
+    g_MemTracker.RemoveGpu(GPU_MEM_TEXTURES, stats_.stagingBytes);
+
+    uploads_.clear();
+    tiles_.clear();
+    stats_   = TexUploadStats();
+    pDevice_ = nullptr;
+}
+
+///////////////////////////////////////////////////////////
+
+bool TextureUploader::Enqueue(
+    ID3D11Resource* pDst,
+    ID3D11ShaderResourceView* pSRVForMips,
+    const uint8* texels,
+    const uint width,
+    const uint height,
+    const DXGI_FORMAT format)
+{
+    const uint bytesPerTexel = GetBytesPerTexel(format);
+
+    if (!pDst || !texels || (width == 0) || (height == 0) || (bytesPerTexel == 0))
+    {
+        LogErr("can't enqueue a texture upload: invalid input args");
+        return false;
+    }
+
+    // new texels replace the ones which aren't uploaded yet
+    for (index i = 0; i < uploads_.size(); ++i)
+    {
+        if (uploads_[i]->pDst == pDst)
+        {
+            ReleaseUpload(uploads_[i]);
+            uploads_.erase(i);
+            break;
+        }
+    }
+
+    Upload* pUpload = new Upload();
+
+    pUpload->pDst          = pDst;
+    pUpload->pSRV          = pSRVForMips;
+    pUpload->width         = width;
+    pUpload->height        = height;
+    pUpload->bytesPerTexel = bytesPerTexel;
+    pUpload->format        = format;
+    pUpload->texels.resize((size)width * height * bytesPerTexel);
+    memcpy(pUpload->texels.data(), texels, pUpload->texels.size());
+
+    // the texture can be released by its owner before the upload is done
+    pDst->AddRef();
+
+    if (pSRVForMips)
+        pSRVForMips->AddRef();
+
+    uploads_.push_back(pUpload);
+
+    stats_.pendingBytes += pUpload->texels.size();
+    stats_.numPending    = (uint32)uploads_.size();
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureUploader::Update(ID3D11DeviceContext* pContext)
+{
+    ++frameIdx_;
+
+    stats_.lastFrameBytes = stats_.frameBytes;
+    stats_.lastFrameTiles = stats_.frameTiles;
+    stats_.frameBytes     = 0;
+    stats_.frameTiles     = 0;
+
+    if (uploads_.empty())
+        return;
+
+    uint64 budget = params_.budgetBytes;
+    index  numLeft = 0;
+    bool   isStarved = false;                          // no free staging tile in this frame
+
+    for (Upload* pUpload : uploads_)
+    {
+        while (!isStarved && (budget > 0) && (pUpload->nextTile < GetNumTiles(*pUpload)))
+        {
+            uint64 bytes = 0;
+
+            if (!CopyNextTile(pContext, *pUpload, false, bytes))
+            {
+                isStarved = true;
+                break;
+            }
+
+            budget = (bytes < budget) ? budget - bytes : 0;
+        }
+
+        // mip 0 is copied: generate the rest of the chain
+        if (pUpload->nextTile == GetNumTiles(*pUpload))
+        {
+            if (pUpload->pSRV)
+                pContext->GenerateMips(pUpload->pSRV);
+
+            ReleaseUpload(pUpload);
+            ++stats_.numUploaded;
+            continue;
+        }
+
+        uploads_[numLeft++] = pUpload;
+    }
+
+    uploads_.resize(numLeft);
+    stats_.numPending = (uint32)uploads_.size();
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureUploader::Finish(ID3D11DeviceContext* pContext, ID3D11Resource* pDst)
+{
+    index numLeft = 0;
+
+    for (Upload* pUpload : uploads_)
+    {
+        if (pDst && (pUpload->pDst != pDst))
+        {
+            uploads_[numLeft++] = pUpload;
+            continue;
+        }
+
+        uint64 bytes = 0;
+
+        while (pUpload->nextTile < GetNumTiles(*pUpload))
+        {
+            if (!CopyNextTile(pContext, *pUpload, true, bytes))
+            {
+                LogErr("can't finish a texture upload: there is no staging texture");
+                break;
+            }
+        }
+
+        if (pUpload->pSRV)
+            pContext->GenerateMips(pUpload->pSRV);
+
+        ReleaseUpload(pUpload);
+        ++stats_.numUploaded;
+    }
+
+    uploads_.resize(numLeft);
+    stats_.numPending = (uint32)uploads_.size();
+}
+
+///////////////////////////////////////////////////////////
+
+bool TextureUploader::IsPending(const ID3D11Resource* pDst) const
+{
+    for (const Upload* pUpload : uploads_)
+    {
+        if (pUpload->pDst == pDst)
+            return true;
+    }
+
+    return false;
+}
+
+
+// =================================================================================
+//                               PRIVATE METHODS
+// =================================================================================
+bool TextureUploader::CopyNextTile(
+    ID3D11DeviceContext* pContext,
+    Upload& upload,
+    const bool wait,
+    uint64& outBytes)
+{
+    // copy the next tile of texels through a staging texture into mip 0
+
+    const int tileIdx = AcquireTile(upload.format, wait);
+
+    if (tileIdx == -1)
+        return false;
+
+    StagingTile& tile = tiles_[tileIdx];
+
+    const uint numTilesX = (upload.width + TILE_SIZE - 1) / TILE_SIZE;
+    const uint x0        = (upload.nextTile % numTilesX) * TILE_SIZE;
+    const uint y0        = (upload.nextTile / numTilesX) * TILE_SIZE;
+    const uint w         = ((x0 + TILE_SIZE) <= upload.width)  ? TILE_SIZE : upload.width  - x0;
+    const uint h         = ((y0 + TILE_SIZE) <= upload.height) ? TILE_SIZE : upload.height - y0;
+    const uint rowBytes  = w * upload.bytesPerTexel;
+
+    // the tile is free (is checked by AcquireTile) so mapping doesn't wait
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    const UINT mapFlags = (wait) ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT;
+
+    if (FAILED(pContext->Map(tile.pTex, 0, D3D11_MAP_WRITE, mapFlags, &mapped)))
+        return false;
+
+    const uint8* src      = upload.texels.data() + ((size)y0 * upload.width + x0) * upload.bytesPerTexel;
+    const size   srcPitch = (size)upload.width * upload.bytesPerTexel;
+    uint8*       dst      = (uint8*)mapped.pData;
+
+    for (uint row = 0; row < h; ++row)
+        memcpy(dst + (size)row * mapped.RowPitch, src + row * srcPitch, rowBytes);
+
+    pContext->Unmap(tile.pTex, 0);
+
+    const D3D11_BOX box = { 0, 0, 0, w, h, 1 };
+    pContext->CopySubresourceRegion(upload.pDst, 0, x0, y0, 0, tile.pTex, 0, &box);
+
+    tile.lastUsedFrame = frameIdx_;
+    ++upload.nextTile;
+
+    outBytes             = (uint64)rowBytes * h;
+    upload.copiedBytes  += outBytes;
+    stats_.pendingBytes -= outBytes;
+    stats_.frameBytes   += outBytes;
+    stats_.frameTiles++;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+int TextureUploader::AcquireTile(const DXGI_FORMAT format, const bool wait)
+{
+    // get a staging tile of the format which isn't used by copies in flight
+    // (or create a new one if the pool isn't full yet); return -1 if there is no such
+
+    int numOfFormat = 0;
+    int oldestIdx   = -1;
+
+    for (int i = 0; i < (int)tiles_.size(); ++i)
+    {
+        if (tiles_[i].format != format)
+            continue;
+
+        ++numOfFormat;
+
+        if ((tiles_[i].lastUsedFrame + NUM_FRAMES_IN_FLIGHT) <= frameIdx_)
+            return i;
+
+        if ((oldestIdx == -1) || (tiles_[i].lastUsedFrame < tiles_[oldestIdx].lastUsedFrame))
+            oldestIdx = i;
+    }
+
+    if (numOfFormat < params_.maxStagingTiles)
+    {
+        D3D11_TEXTURE2D_DESC desc{};
+        desc.Width            = TILE_SIZE;
+        desc.Height           = TILE_SIZE;
+        desc.MipLevels        = 1;
+        desc.ArraySize        = 1;
+        desc.Format           = format;
+        desc.SampleDesc.Count = 1;
+        desc.Usage            = D3D11_USAGE_STAGING;
+        desc.CPUAccessFlags   = D3D11_CPU_ACCESS_WRITE;
+
+        StagingTile tile;
+        tile.format = format;
+
+        if (SUCCEEDED(pDevice_->CreateTexture2D(&desc, nullptr, &tile.pTex)))
+        {
+            const uint64 bytes = (uint64)TILE_SIZE * TILE_SIZE * GetBytesPerTexel(format);
+
+            stats_.stagingBytes += bytes;
+            g_MemTracker.AddGpu(GPU_MEM_TEXTURES, bytes);
+
+            tiles_.push_back(tile);
+            return (int)tiles_.size() - 1;
+        }
+
+        LogErr("can't create a staging texture for uploads");
+    }
+
+    // a forced upload waits for the oldest tile (Map() does it)
+    return (wait) ? oldestIdx : -1;
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureUploader::ReleaseUpload(Upload* pUpload)
+{
+    stats_.pendingBytes -= (pUpload->texels.size() - pUpload->copiedBytes);
+
+    SafeRelease(&pUpload->pSRV);
+    SafeRelease(&pUpload->pDst);
+    delete pUpload;
+}
+
+} // namespace Core
@@ -0,0 +1,135 @@
+// =================================================================================
+// Filename:     TextureUploader.h
+// Description:  staged uploads of textures which are created at runtime from raw
+//               data (terrain texture/light maps, generated textures, etc.):
+//
+//               - the texture is created empty (without initial data) so its
+//                 creation doesn't wait for the copy of texels;
+//               - texels are copied by tiles through a pool of staging textures
+//                 (each tile is a Map() + CopySubresourceRegion()); only a budget
+//                 of bytes is copied per frame so big uploads are spread over
+//                 a few frames instead of a hitch;
+//               - a staging tile isn't written again until the GPU is done with
+//                 its previous copy (a few frames later), so Map() doesn't stall;
+//               - when all the tiles of mip 0 are copied the mip chain
+//                 is generated on GPU by GenerateMips()
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <d3d11.h>
+
+
+namespace Core
+{
+
+struct TexUploadParams
+{
+    uint64 budgetBytes     = 4ULL << 20;        // texels which are copied per frame
+    int    maxStagingTiles = 64;                // of each format
+};
+
+///////////////////////////////////////////////////////////
+
+struct TexUploadStats
+{
+    uint64 pendingBytes  = 0;                   // which aren't copied yet
+    uint64 stagingBytes  = 0;                   // of the staging pool
+    uint32 numPending    = 0;                   // textures
+    uint32 numUploaded   = 0;                   // since the start
+
+    // copied between the last two updates (~ by the last frame)
+    uint64 frameBytes     = 0;
+    uint32 frameTiles     = 0;
+    uint64 lastFrameBytes = 0;
+    uint32 lastFrameTiles = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+class TextureUploader
+{
+public:
+    static constexpr uint TILE_SIZE            = 256;  // texels of a staging tile side
+    static constexpr int  NUM_FRAMES_IN_FLIGHT = 3;    // a tile is reused only after this number of frames
+
+    TextureUploader() {}
+    ~TextureUploader() { Shutdown(); }
+
+    // restrict a copying of this class instance
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    void Initialize(ID3D11Device* pDevice, const TexUploadParams& params);
+    void Shutdown();
+
+    // queue a copy of texels into mip 0 of the texture (format: RGBA8 or R8);
+    // if the SRV is passed then mips are generated on GPU after the copy
+    // (the texture must be created with D3D11_RESOURCE_MISC_GENERATE_MIPS);
+    // a pending upload into the same texture is replaced
+    bool Enqueue(
+        ID3D11Resource* pDst,
+        ID3D11ShaderResourceView* pSRVForMips,
+        const uint8* texels,
+        const uint width,
+        const uint height,
+        const DXGI_FORMAT format);
+
+    // copy tiles within the per frame budget;
+    // NOTE: the immediate context must be free (the render thread is synced)
+    void Update(ID3D11DeviceContext* pContext);
+
+    // copy the rest of the upload into the texture right away (or all the
+    // uploads if pDst == nullptr); e.g. before the texture is updated by a region
+    void Finish(ID3D11DeviceContext* pContext, ID3D11Resource* pDst = nullptr);
+
+    bool IsPending(const ID3D11Resource* pDst) const;
+
+    inline bool                  IsInitialized() const { return pDevice_ != nullptr; }
+    inline const TexUploadStats& GetStats()      const { return stats_; }
+
+private:
+    struct Upload
+    {
+        ID3D11Resource*           pDst = nullptr;       // is referenced till the upload is done
+        ID3D11ShaderResourceView* pSRV = nullptr;       // for mips generation (can be nullptr)
+        cvector<uint8>            texels;
+        uint                      width         = 0;
+        uint                      height        = 0;
+        uint                      bytesPerTexel = 0;
+        DXGI_FORMAT               format        = DXGI_FORMAT_UNKNOWN;
+        uint                      nextTile      = 0;    // tiles go by rows
+        uint64                    copiedBytes   = 0;
+    };
+
+    struct StagingTile
+    {
+        ID3D11Texture2D* pTex          = nullptr;
+        DXGI_FORMAT      format        = DXGI_FORMAT_UNKNOWN;
+        uint64           lastUsedFrame = 0;
+    };
+
+    // return false if there is no free staging tile (the upload goes on in the next frame)
+    bool  CopyNextTile(ID3D11DeviceContext* pContext, Upload& upload, const bool wait, uint64& outBytes);
+    int   AcquireTile (const DXGI_FORMAT format, const bool wait);
+    void  ReleaseUpload(Upload* pUpload);
+
+    inline uint GetNumTiles(const Upload& u) const
+    {
+        return ((u.width + TILE_SIZE - 1) / TILE_SIZE) * ((u.height + TILE_SIZE - 1) / TILE_SIZE);
+    }
+
+private:
+    ID3D11Device*        pDevice_ = nullptr;
+    TexUploadParams      params_;
+    TexUploadStats       stats_;
+
+    cvector<Upload*>     uploads_;                      // in order of enqueuing
+    cvector<StagingTile> tiles_;
+    uint64               frameIdx_ = NUM_FRAMES_IN_FLIGHT;
+};
+
+} // namespace Core
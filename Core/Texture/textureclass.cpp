@@ -5,6 +5,7 @@
 #include "textureclass.h"
 #include "ImageReader.h"
 #include "ImgConverter.h"
+#include <DirectXTex.h>
 #include <D3DX11tex.h>
 
 #pragma warning (disable : 4996)
@@ -260,6 +261,111 @@ Texture::Texture(
 
 ///////////////////////////////////////////////////////////
 
+Texture::Texture(
+    ID3D11Device* pDevice,
+    const char* name,
+    ID3D11Texture2D* const* srcTextures,
+    const size numTextures)
+{
+    // create a TEXTURE 2D ARRAY and associated view from already loaded textures:
+    // each texture (with all its mips) becomes a layer of the array;
+    // NOTE: unlike the array from files there is no readback through the CPU
+
+    ID3D11Texture2D*          textureArr = nullptr;
+    ID3D11ShaderResourceView* texArrSRV  = nullptr;
+    ID3D11DeviceContext*      pContext   = nullptr;
+
+    try
+    {
+        CAssert::True((name != nullptr) && (name[0] != '\0'), "input name for the texture object is empty");
+        CAssert::True(srcTextures != nullptr,                 "input arr of textures == nullptr");
+        CAssert::True(numTextures > 0,                        "input number of textures must be > 0");
+
+        D3D11_TEXTURE2D_DESC texElemDesc;
+        srcTextures[0]->GetDesc(&texElemDesc);
+
+        for (index i = 1; i < numTextures; ++i)
+        {
+            D3D11_TEXTURE2D_DESC desc;
+            srcTextures[i]->GetDesc(&desc);
+
+            const bool isSame =
+                (desc.Width     == texElemDesc.Width)     &&
+                (desc.Height    == texElemDesc.Height)    &&
+                (desc.MipLevels == texElemDesc.MipLevels) &&
+                (desc.Format    == texElemDesc.Format)    &&
+                (desc.ArraySize == 1);
+
+            CAssert::True(isSame, "all the textures of array must have the same size/format/mips");
+        }
+
+        D3D11_TEXTURE2D_DESC texArrayDesc;
+        texArrayDesc.Width              = texElemDesc.Width;
+        texArrayDesc.Height             = texElemDesc.Height;
+        texArrayDesc.MipLevels          = texElemDesc.MipLevels;
+        texArrayDesc.ArraySize          = (UINT)numTextures;
+        texArrayDesc.Format             = texElemDesc.Format;
+        texArrayDesc.SampleDesc.Count   = 1;
+        texArrayDesc.SampleDesc.Quality = 0;
+        texArrayDesc.Usage              = D3D11_USAGE_DEFAULT;
+        texArrayDesc.BindFlags          = D3D11_BIND_SHADER_RESOURCE;
+        texArrayDesc.CPUAccessFlags     = 0;
+        texArrayDesc.MiscFlags          = 0;
+
+        HRESULT hr = pDevice->CreateTexture2D(&texArrayDesc, nullptr, &textureArr);
+        CAssert::NotFailed(hr, "can't create a texture array");
+
+        // copy each mip of each texture into the related subresource of the array
+        pDevice->GetImmediateContext(&pContext);
+
+        for (UINT layer = 0; layer < (UINT)numTextures; ++layer)
+        {
+            for (UINT mip = 0; mip < texArrayDesc.MipLevels; ++mip)
+            {
+                pContext->CopySubresourceRegion(
+                    textureArr,
+                    D3D11CalcSubresource(mip, layer, texArrayDesc.MipLevels),
+                    0, 0, 0,
+                    srcTextures[layer],
+                    D3D11CalcSubresource(mip, 0, texArrayDesc.MipLevels),
+                    nullptr);
+            }
+        }
+
+        SafeRelease(&pContext);
+
+
+        // create a resource view to the texture array
+        D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+        viewDesc.Format                         = texArrayDesc.Format;
+        viewDesc.ViewDimension                  = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+        viewDesc.Texture2DArray.MostDetailedMip = 0;
+        viewDesc.Texture2DArray.MipLevels       = texArrayDesc.MipLevels;
+        viewDesc.Texture2DArray.FirstArraySlice = 0;
+        viewDesc.Texture2DArray.ArraySize       = (UINT)numTextures;
+
+        hr = pDevice->CreateShaderResourceView(textureArr, &viewDesc, &texArrSRV);
+        CAssert::NotFailed(hr, "can't create a shader resource view for texture array");
+
+        // assignment
+        pTexture_     = textureArr;
+        pTextureView_ = texArrSRV;
+        width_        = texArrayDesc.Width;
+        height_       = texArrayDesc.Height;
+        name_         = name;
+    }
+    catch (EngineException& e)
+    {
+        SafeRelease(&pContext);
+        SafeRelease(&textureArr);
+        SafeRelease(&texArrSRV);
+
+        LogErr(e);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 Texture::Texture(ID3D11Device* pDevice, const Color & color)
 {
     // create a 1x1 texture with input color value
@@ -462,6 +568,444 @@ bool Texture::Initialize(
     }
 }
 
+//---------------------------------------------------------
+// Desc:   initialize a single channel texture (DXGI_FORMAT_R8_UNORM)
+//         with input 8-bit data; there is only one mip level
+// Args:   - pDevice:   a ptr to DirectX11 device
+//         - name:      name for the texture
+//         - data:      8-bit pixels raw data (width * height bytes)
+//         - width:     width of the image
+//         - height:    height of the image
+// Ret:    true if texture was successfully initialized
+//---------------------------------------------------------
+bool Texture::InitializeGray(
+    ID3D11Device* pDevice,
+    const char* name,
+    const uint8* data,
+    const uint width,
+    const uint height)
+{
+    try
+    {
+        // check input params
+        CAssert::True(!StrHelper::IsEmpty(name),   "input name for the texture is empty");
+        CAssert::True(data != nullptr,            "input ptr to texture data == nullptr");
+        CAssert::True((width > 0) && (height > 0), "input img dimensions is wrong (must be > 0)");
+
+        // release memory from prev data (if we have any)
+        Release();
+
+        ID3D11Texture2D*       p2DTexture = nullptr;
+        D3D11_TEXTURE2D_DESC   textureDesc;
+        D3D11_SUBRESOURCE_DATA initialData{};
+
+        // setup description for this texture
+        textureDesc.Format             = DXGI_FORMAT_R8_UNORM;
+        textureDesc.Width              = width;
+        textureDesc.Height             = height;
+        textureDesc.ArraySize          = 1;
+        textureDesc.MipLevels          = 1;
+        textureDesc.BindFlags          = D3D11_BIND_SHADER_RESOURCE;
+        textureDesc.Usage              = D3D11_USAGE_DEFAULT;
+        textureDesc.CPUAccessFlags     = 0;
+        textureDesc.SampleDesc.Count   = 1;
+        textureDesc.SampleDesc.Quality = 0;
+        textureDesc.MiscFlags          = 0;
+
+        // setup initial data for this texture
+        initialData.pSysMem     = data;
+        initialData.SysMemPitch = width;
+
+        HRESULT hr = pDevice->CreateTexture2D(&textureDesc, &initialData, &p2DTexture);
+        CAssert::NotFailed(hr, "Failed to create a single channel texture");
+
+        pTexture_ = p2DTexture;
+
+        // setup description for a shader resource view (SRV)
+        CD3D11_SHADER_RESOURCE_VIEW_DESC srvDesc(D3D11_SRV_DIMENSION_TEXTURE2D, textureDesc.Format);
+
+        hr = pDevice->CreateShaderResourceView(pTexture_, &srvDesc, &pTextureView_);
+        CAssert::NotFailed(hr, "Failed to create shader resource view of a single channel texture");
+
+        width_  = width;
+        height_ = height;
+        name_   = name;
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        sprintf(g_String, "can't create a single channel texture: %s", name);
+        LogErr(g_String);
+
+        // in case of any exception we will try to create 1x1 single color texture
+        Initialize1x1ColorTexture(pDevice, Colors::UnloadedTextureColor);
+
+        return false;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   create a texture without initial data (is filled by TextureUploader)
+// Args:   - pDevice:   a ptr to DirectX11 device
+//         - name:      name for the texture
+//         - width:     width of the image
+//         - height:    height of the image
+//         - format:    DXGI_FORMAT_R8G8B8A8_UNORM or DXGI_FORMAT_R8_UNORM
+//         - mipMapped: a full mip chain which is generated on GPU
+// Ret:    true if texture was successfully initialized
+//---------------------------------------------------------
+bool Texture::InitializeEmpty(
+    ID3D11Device* pDevice,
+    const char* name,
+    const uint width,
+    const uint height,
+    const DXGI_FORMAT format,
+    const bool mipMapped)
+{
+    try
+    {
+        // check input params
+        CAssert::True(!StrHelper::IsEmpty(name),   "input name for the texture is empty");
+        CAssert::True((width > 0) && (height > 0), "input img dimensions is wrong (must be > 0)");
+
+        // release memory from prev data (if we have any)
+        Release();
+
+        ID3D11Texture2D*     p2DTexture = nullptr;
+        D3D11_TEXTURE2D_DESC textureDesc;
+
+        // GenerateMips() renders mips so the texture must be a render target as well
+        textureDesc.Format             = format;
+        textureDesc.Width              = width;
+        textureDesc.Height             = height;
+        textureDesc.ArraySize          = 1;
+        textureDesc.MipLevels          = (mipMapped) ? 0 : 1;
+        textureDesc.BindFlags          = (mipMapped) ? (D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET) : D3D11_BIND_SHADER_RESOURCE;
+        textureDesc.Usage              = D3D11_USAGE_DEFAULT;
+        textureDesc.CPUAccessFlags     = 0;
+        textureDesc.SampleDesc.Count   = 1;
+        textureDesc.SampleDesc.Quality = 0;
+        textureDesc.MiscFlags          = (mipMapped) ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
+
+        HRESULT hr = pDevice->CreateTexture2D(&textureDesc, nullptr, &p2DTexture);
+        CAssert::NotFailed(hr, "Failed to create an empty texture");
+
+        pTexture_ = p2DTexture;
+
+        // the SRV sees all the mips
+        CD3D11_SHADER_RESOURCE_VIEW_DESC srvDesc(D3D11_SRV_DIMENSION_TEXTURE2D, format, 0, (UINT)-1);
+
+        hr = pDevice->CreateShaderResourceView(pTexture_, &srvDesc, &pTextureView_);
+        CAssert::NotFailed(hr, "Failed to create shader resource view of an empty texture");
+
+        width_  = width;
+        height_ = height;
+        name_   = name;
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        sprintf(g_String, "can't create an empty texture: %s", name);
+        LogErr(g_String);
+
+        // in case of any exception we will try to create 1x1 single color texture
+        Initialize1x1ColorTexture(pDevice, Colors::UnloadedTextureColor);
+
+        return false;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   check if the texture was created by InitializeEmpty() with the same
+//         size/format/mips so new texels can be uploaded without recreation
+//---------------------------------------------------------
+bool Texture::IsUploadCompatible(
+    const uint width,
+    const uint height,
+    const DXGI_FORMAT format,
+    const bool mipMapped)
+{
+    if (!pTexture_)
+        return false;
+
+    D3D11_TEXTURE2D_DESC desc;
+    ((ID3D11Texture2D*)pTexture_)->GetDesc(&desc);
+
+    const bool hasGenMips = (desc.MiscFlags & D3D11_RESOURCE_MISC_GENERATE_MIPS) != 0;
+
+    return (desc.Width  == width)  &&
+           (desc.Height == height) &&
+           (desc.Format == format) &&
+           (desc.Usage  == D3D11_USAGE_DEFAULT) &&
+           (desc.ArraySize == 1) &&
+           (hasGenMips == mipMapped) &&
+           (mipMapped || (desc.MipLevels == 1));
+}
+
+//---------------------------------------------------------
+// Desc:   decode an image file into the CPU memory with a full mip chain
+// Args:   - filePath: a path to the image file
+//         - outImage: decoded mips of the image
+// Ret:    false if the file can't be read or decoded
+//---------------------------------------------------------
+bool Texture::DecodeFromFile(const char* filePath, DirectX::ScratchImage& outImage)
+{
+    using namespace DirectX;
+
+    if (StrHelper::IsEmpty(filePath))
+    {
+        LogErr("input path to texture is empty");
+        return false;
+    }
+
+    // NOTE: it can be executed by worker threads so g_String isn't used here
+    char msg[320]{ '\0' };
+
+    // decoding is shared with the offline (batch) conversion of images
+    ImgReader::ImgConverter imgConv;
+    ScratchImage            image;
+    HRESULT                 hr = S_OK;
+
+    if (!imgConv.LoadFromFile(filePath, image))
+    {
+        snprintf(msg, sizeof(msg), "can't decode a texture from file: %s", filePath);
+        LogErr(msg);
+        return false;
+    }
+
+    const TexMetadata& metadata = image.GetMetadata();
+
+    if (metadata.dimension != TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1)
+    {
+        snprintf(msg, sizeof(msg), "only a single 2D texture can be decoded from file: %s", filePath);
+        LogErr(msg);
+        return false;
+    }
+
+    // the file already has mips (or block compressed data can't be filtered on the CPU)
+    if ((metadata.mipLevels > 1) || IsCompressed(metadata.format))
+    {
+        outImage = std::move(image);
+        return true;
+    }
+
+    hr = GenerateMipMaps(
+        image.GetImages(),
+        image.GetImageCount(),
+        metadata,
+        TEX_FILTER_DEFAULT,
+        0,                                // a full mip chain down to 1x1
+        outImage);
+
+    // we still can use the top mip
+    if (FAILED(hr))
+    {
+        snprintf(msg, sizeof(msg), "can't generate mipmaps of texture: %s", filePath);
+        LogErr(msg);
+        outImage = std::move(image);
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   create the texture and its SRV from mips of the decoded image
+// Args:   - pDevice:  a ptr to DirectX11 device
+//         - name:     name for the texture
+//         - image:    decoded mips (see DecodeFromFile)
+//         - firstMip: the most detailed mip to use (less detailed are used all)
+// Ret:    true if texture was successfully initialized
+//---------------------------------------------------------
+bool Texture::InitializeFromImage(
+    ID3D11Device* pDevice,
+    const char* name,
+    const DirectX::ScratchImage& image,
+    const uint firstMip)
+{
+    using namespace DirectX;
+
+    try
+    {
+        const TexMetadata& metadata = image.GetMetadata();
+
+        CAssert::True(pDevice != nullptr,                        "input ptr to the device == nullptr");
+        CAssert::True(!StrHelper::IsEmpty(name),                 "input name for the texture is empty");
+        CAssert::True(metadata.dimension == TEX_DIMENSION_TEXTURE2D, "input image isn't a 2D texture");
+        CAssert::True(firstMip < metadata.mipLevels,             "input first mip is out of range");
+
+        // release memory from prev data (if we have any)
+        Release();
+
+        // the top mip of a block compressed texture must consist of whole blocks
+        uint topMip = firstMip;
+
+        while ((topMip > 0) &&
+               IsCompressed(metadata.format) &&
+               ((image.GetImage(topMip, 0, 0)->width % 4) || (image.GetImage(topMip, 0, 0)->height % 4)))
+        {
+            --topMip;
+        }
+
+        const uint             numMips = (uint)metadata.mipLevels - topMip;
+        const Image*           pTopImg = image.GetImage(topMip, 0, 0);
+        D3D11_SUBRESOURCE_DATA initialData[D3D11_REQ_MIP_LEVELS];
+        D3D11_TEXTURE2D_DESC   textureDesc;
+        ID3D11Texture2D*       p2DTexture = nullptr;
+
+        for (uint mip = 0; mip < numMips; ++mip)
+        {
+            const Image* pImg = image.GetImage(topMip + mip, 0, 0);
+
+            initialData[mip].pSysMem          = pImg->pixels;
+            initialData[mip].SysMemPitch      = (UINT)pImg->rowPitch;
+            initialData[mip].SysMemSlicePitch = (UINT)pImg->slicePitch;
+        }
+
+        // setup description for this texture
+        textureDesc.Format             = metadata.format;
+        textureDesc.Width              = (UINT)pTopImg->width;
+        textureDesc.Height             = (UINT)pTopImg->height;
+        textureDesc.ArraySize          = 1;
+        textureDesc.MipLevels          = numMips;
+        textureDesc.BindFlags          = D3D11_BIND_SHADER_RESOURCE;
+        textureDesc.Usage              = D3D11_USAGE_DEFAULT;
+        textureDesc.CPUAccessFlags     = 0;
+        textureDesc.SampleDesc.Count   = 1;
+        textureDesc.SampleDesc.Quality = 0;
+        textureDesc.MiscFlags          = 0;
+
+        HRESULT hr = pDevice->CreateTexture2D(&textureDesc, initialData, &p2DTexture);
+        CAssert::NotFailed(hr, "can't create a texture from the decoded image");
+
+        pTexture_ = p2DTexture;
+
+        hr = pDevice->CreateShaderResourceView(pTexture_, nullptr, &pTextureView_);
+        CAssert::NotFailed(hr, "can't create shader resource view of a texture from the decoded image");
+
+        width_  = textureDesc.Width;
+        height_ = textureDesc.Height;
+        name_   = name;
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        // the texture stays empty (without SRV) so the caller can handle it
+        LogErr(e);
+        Release();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool Texture::InitializeFromMips(
+    ID3D11Device* pDevice,
+    ID3D11DeviceContext* pContext,
+    Texture& src,
+    const uint numDroppedMips)
+{
+    // create the texture from mips [numDroppedMips, numMips) of the src texture;
+    // the data is copied on the GPU (so the immediate context is used)
+
+    using namespace DirectX;
+
+    ID3D11Texture2D* pSrc2D = nullptr;
+    ID3D11Texture2D* pDst2D = nullptr;
+
+    try
+    {
+        CAssert::True(pDevice != nullptr,  "input ptr to the device == nullptr");
+        CAssert::True(pContext != nullptr, "input ptr to the device context == nullptr");
+        CAssert::True(src.GetResource(),   "input src texture is empty");
+
+        HRESULT hr = src.GetResource()->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&pSrc2D);
+        CAssert::NotFailed(hr, "input src texture isn't a 2D texture");
+
+        D3D11_TEXTURE2D_DESC desc;
+        pSrc2D->GetDesc(&desc);
+
+        // the top mip of a block compressed texture must consist of whole blocks
+        uint topMip = (numDroppedMips < desc.MipLevels) ? numDroppedMips : desc.MipLevels - 1;
+
+        while ((topMip > 0) &&
+               IsCompressed(desc.Format) &&
+               (((desc.Width >> topMip) % 4) || ((desc.Height >> topMip) % 4)))
+        {
+            --topMip;
+        }
+
+        CAssert::True(topMip > 0, "there are no mips to drop from the src texture");
+
+        const uint srcNumMips = desc.MipLevels;
+        const std::string texName = src.GetName();
+
+        desc.Width     = (desc.Width  >> topMip) ? (desc.Width  >> topMip) : 1;
+        desc.Height    = (desc.Height >> topMip) ? (desc.Height >> topMip) : 1;
+        desc.MipLevels = srcNumMips - topMip;
+
+        hr = pDevice->CreateTexture2D(&desc, nullptr, &pDst2D);
+        CAssert::NotFailed(hr, "can't create a texture for mips of the src texture");
+
+        for (uint mip = 0; mip < desc.MipLevels; ++mip)
+        {
+            const UINT dstSubresource = D3D11CalcSubresource(mip, 0, desc.MipLevels);
+            const UINT srcSubresource = D3D11CalcSubresource(topMip + mip, 0, srcNumMips);
+
+            pContext->CopySubresourceRegion(pDst2D, dstSubresource, 0, 0, 0, pSrc2D, srcSubresource, nullptr);
+        }
+
+        // release memory from prev data (if we have any)
+        Release();
+
+        pTexture_ = pDst2D;
+        pDst2D    = nullptr;
+
+        hr = pDevice->CreateShaderResourceView(pTexture_, nullptr, &pTextureView_);
+        CAssert::NotFailed(hr, "can't create shader resource view of a texture from mips");
+
+        width_  = desc.Width;
+        height_ = desc.Height;
+        name_   = texName;
+
+        SafeRelease(&pSrc2D);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        SafeRelease(&pSrc2D);
+        SafeRelease(&pDst2D);
+        Release();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void Texture::InitializeAlias(const Texture& src, const char* name)
+{
+    // release memory from prev data (if we have any)
+    Release();
+
+    pTexture_     = src.pTexture_;
+    pTextureView_ = src.pTextureView_;
+
+    if (pTexture_)
+        pTexture_->AddRef();
+
+    if (pTextureView_)
+        pTextureView_->AddRef();
+
+    width_  = src.width_;
+    height_ = src.height_;
+    name_   = (name) ? name : src.name_;
+}
+
 ///////////////////////////////////////////////////////////
 
 void Texture::Release()
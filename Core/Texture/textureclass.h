@@ -16,6 +16,8 @@
 #include <assimp/material.h>
 #include <d3d11.h>
 
+namespace DirectX { class ScratchImage; }
+
 
 namespace Core
 {
@@ -64,6 +66,14 @@ public:
         const size numTextures,
         const DXGI_FORMAT format);
 
+    // pack already loaded textures (with the same size/format/mips) into
+    // a Texture2DArray; the data is copied on the GPU
+    Texture(
+        ID3D11Device* pDevice,
+        const char* name,
+        ID3D11Texture2D* const* srcTextures,
+        const size numTextures);
+
     // make 1x1 texture with single color
     Texture(ID3D11Device* pDevice, const Color& color);
 
@@ -95,6 +105,58 @@ public:
         const uint height,
         const bool mipMapped);
 
+    // initialize a single channel (R8_UNORM) texture without mipmaps
+    // right from 8-bit data (e.g. heights: no conversion into RGBA)
+    bool InitializeGray(
+        ID3D11Device* pDevice,
+        const char* name,
+        const uint8* data,
+        const uint width,
+        const uint height);
+
+    // create a texture without initial data (its texels are uploaded later by
+    // TextureUploader); format: RGBA8 or R8; if mipMapped the texture has
+    // a full mip chain which can be generated on GPU (GenerateMips)
+    bool InitializeEmpty(
+        ID3D11Device* pDevice,
+        const char* name,
+        const uint width,
+        const uint height,
+        const DXGI_FORMAT format,
+        const bool mipMapped);
+
+    // can texels of this size/format be uploaded into the texture as is?
+    bool IsUploadCompatible(
+        const uint width,
+        const uint height,
+        const DXGI_FORMAT format,
+        const bool mipMapped);
+
+    // decode an image file (.dds, .tga, .png, .jpg, .bmp) into the CPU memory with
+    // a full mip chain (it is generated if the file has only one mip);
+    // NOTE: the GPU isn't touched so it can be called by any thread
+    static bool DecodeFromFile(const char* filePath, DirectX::ScratchImage& outImage);
+
+    // create the texture from mips [firstMip, numMips) of the decoded image;
+    // only the device is used (no immediate context) so it can be called by any thread
+    bool InitializeFromImage(
+        ID3D11Device* pDevice,
+        const char* name,
+        const DirectX::ScratchImage& image,
+        const uint firstMip = 0);
+
+    // create the texture from mips [numDroppedMips, numMips) of the src texture
+    // by a GPU copy (the top mip of a block compressed texture is kept whole by blocks)
+    bool InitializeFromMips(
+        ID3D11Device* pDevice,
+        ID3D11DeviceContext* pContext,
+        Texture& src,
+        const uint numDroppedMips);
+
+    // share the GPU resource and SRV of the src texture (they are reference
+    // counted so the resource lives while any of the textures refers to it)
+    void InitializeAlias(const Texture& src, const char* name);
+
     void Release();
 
     // deep copy
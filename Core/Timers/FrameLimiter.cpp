@@ -0,0 +1,118 @@
+// =================================================================================
+// Filename:     FrameLimiter.cpp
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "FrameLimiter.h"
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+
+namespace Core
+{
+
+//---------------------------------------------------------
+// Desc:  get the current QPC time
+//---------------------------------------------------------
+static __int64 GetTicks()
+{
+    LARGE_INTEGER ticks;
+    QueryPerformanceCounter(&ticks);
+    return ticks.QuadPart;
+}
+
+///////////////////////////////////////////////////////////
+
+void FrameLimiter::Initialize()
+{
+    QueryPerformanceFrequency((LARGE_INTEGER*)&ticksPerSec_);
+
+    // a high resolution timer is available since Windows 10 (1803);
+    // the usual one wakes up by the system timer tick (up to ~15.6 ms late)
+    hTimer_    = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    isHighRes_ = (hTimer_ != NULL);
+
+    if (!hTimer_)
+        hTimer_ = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+
+    lastDeadline_ = GetTicks();
+}
+
+///////////////////////////////////////////////////////////
+
+void FrameLimiter::Shutdown()
+{
+    if (hTimer_)
+    {
+        CloseHandle((HANDLE)hTimer_);
+        hTimer_ = nullptr;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void FrameLimiter::Wait(const int targetFps, const bool isPrecise)
+{
+    const __int64 now = GetTicks();
+
+    if (targetFps <= 0)
+    {
+        lastDeadline_ = now;
+        return;
+    }
+
+    const __int64 period   = ticksPerSec_ / targetFps;
+    const __int64 deadline = lastDeadline_ + period;
+
+    // the frame is late: don't wait; if it is later than a whole period
+    // we restart pacing from now (we don't try to catch up the lost frames)
+    if (now >= deadline)
+    {
+        lastDeadline_ = (now - deadline > period) ? now : deadline;
+        return;
+    }
+
+    // a wake up of the timer may be late so the last fraction is spun
+    const __int64 spinMargin = (!isPrecise) ? 0 : (isHighRes_ ? ticksPerSec_ / 2000 : ticksPerSec_ / 500);
+    const __int64 sleepTicks = deadline - now - spinMargin;
+
+    if (sleepTicks > 0)
+        SleepFor(sleepTicks);
+
+    if (isPrecise)
+    {
+        while (GetTicks() < deadline)
+            YieldProcessor();
+    }
+
+    lastDeadline_ = deadline;
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+void FrameLimiter::SleepFor(const __int64 ticks)
+{
+    if (!hTimer_)
+    {
+        Sleep((DWORD)(ticks * 1000 / ticksPerSec_));
+        return;
+    }
+
+    // a negative due time is relative (in 100 ns intervals)
+    LARGE_INTEGER dueTime;
+    dueTime.QuadPart = -(ticks * 10'000'000 / ticksPerSec_);
+
+    if (SetWaitableTimerEx((HANDLE)hTimer_, &dueTime, 0, NULL, NULL, NULL, 0))
+        WaitForSingleObject((HANDLE)hTimer_, INFINITE);
+}
+
+} // namespace Core
@@ -0,0 +1,47 @@
+// =================================================================================
+// Filename:     FrameLimiter.h
+// Description:  caps the frame rate (when VSYNC doesn't do it): the rest time of
+//               the frame is slept by a high resolution waitable timer and only
+//               its last fraction is spun for a precise deadline;
+//
+//               - a power-saving wait doesn't spin at all (the deadline may be
+//                 missed by a bit but the CPU sleeps the whole time);
+//               - frames are paced by deadlines (not by the time of the wait) so
+//                 the cap doesn't drift; a frame which is too late restarts pacing
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+
+namespace Core
+{
+
+class FrameLimiter
+{
+public:
+    FrameLimiter() {}
+    ~FrameLimiter() { Shutdown(); }
+
+    // restrict a copying of this class instance
+    FrameLimiter(const FrameLimiter&) = delete;
+    FrameLimiter& operator=(const FrameLimiter&) = delete;
+
+    void Initialize();
+    void Shutdown();
+
+    // wait until the deadline of the next frame (targetFps <= 0: no cap);
+    // isPrecise: spin the last fraction of the wait instead of sleeping it
+    void Wait(const int targetFps, const bool isPrecise);
+
+private:
+    void SleepFor(const __int64 ticks);
+
+private:
+    void*   hTimer_        = nullptr;              // a waitable timer (nullptr: Sleep() is used)
+    bool    isHighRes_     = false;                // the timer is created with CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+    __int64 ticksPerSec_   = 1;
+    __int64 lastDeadline_  = 0;                    // QPC ticks where the prev frame was released
+};
+
+} // namespace Core
@@ -2,7 +2,9 @@
 // Filename:     DebugEditor.h
 // Description:  editor parts to control the debugging:
 //               turn on/off showing of the normals, binormals, bounding boxes,
-//               switching the wireframe or fill mode, etc.
+//               switching the wireframe or fill mode, etc.;
+//               also shows GPU time and workload of each render pass, binds,
+//               uploads, and memory of subsystems
 // 
 // Created:      01.01.25
 // =================================================================================
@@ -10,7 +12,9 @@
 
 #include <Assert.h>
 #include <log.h>
+#include <MemTracker.h>
 #include <UICommon/IFacadeEngineToUI.h>
+#include <CoreCommon/SystemState.h>
 #include <imgui.h>
 
 
@@ -59,7 +63,14 @@ public:
 			"only spot lighting",       // for instance: flashlight
 			"only diffuse map",
 			"only normal map",
-            "wireframe"
+            "wireframe",
+
+            // performance heatmaps
+            "overdraw",                 // additive: the brighter the more layers
+            "LOD",                      // green - LOD 0 ... red - LOD 3+
+            "light count",              // point/spot lights of the pixel's cluster
+            "triangle density",         // red - a triangle per pixel (or more)
+            "batches",                  // a color per draw call
 		};
 
         static int debugOption = 0;
@@ -71,6 +82,251 @@ public:
 		if (anyBtnWasPressed)
 			pFacade_->SwitchDebugState(debugOption);
 	}
+
+    ///////////////////////////////////////////////////////
+
+	void DrawGpuPasses(const Core::SystemState& sysState)
+	{
+		// show averaged GPU time of each render pass and its part of the frame
+
+		const float frameTime = sysState.gpuFrameTime;
+
+		ImGui::Text("GPU frame: %.3f ms", frameTime);
+
+		if (!ImGui::BeginTable("GpuPasses", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+			return;
+
+		ImGui::TableSetupColumn("pass");
+		ImGui::TableSetupColumn("ms");
+		ImGui::TableSetupColumn("% of frame");
+		ImGui::TableHeadersRow();
+
+		for (int i = 0; i < sysState.numGpuPasses; ++i)
+		{
+			const float passTime = sysState.gpuPassTimes[i];
+			const float part     = (frameTime > 0.0f) ? passTime / frameTime : 0.0f;
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(sysState.gpuPassNames[i]);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", passTime);
+			ImGui::TableNextColumn();
+			ImGui::ProgressBar(part, ImVec2(-1.0f, 0.0f));
+		}
+
+		ImGui::EndTable();
+	}
+
+    ///////////////////////////////////////////////////////
+
+	void DrawTelemetry(const Core::SystemState& sysState)
+	{
+		// show the last sample of the process telemetry (see Core::TelemetrySampler)
+
+		constexpr float toMB = 1.0f / (1024.0f * 1024.0f);
+
+		ImGui::Text("CPU (process): %d%%", sysState.cpu);
+		ImGui::Text("Working set:   %.1f MB", (float)sysState.workingSetBytes * toMB);
+		ImGui::Text("Committed:     %.1f MB", (float)sysState.committedBytes * toMB);
+		ImGui::Text("VRAM:          %.1f / %.1f MB", (float)sysState.videoMemUsage * toMB, (float)sysState.videoMemBudget * toMB);
+		ImGui::Text("Shared VRAM:   %.1f / %.1f MB", (float)sysState.sharedVideoMemUsage * toMB, (float)sysState.sharedVideoMemBudget * toMB);
+
+		if (!ImGui::BeginTable("Workers", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+			return;
+
+		ImGui::TableSetupColumn("worker");
+		ImGui::TableSetupColumn("%");
+		ImGui::TableSetupColumn("load");
+		ImGui::TableHeadersRow();
+
+		for (int i = 0; i < sysState.numWorkers; ++i)
+		{
+			const float usage = sysState.workerCpu[i];
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%d", i + 1);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", usage);
+			ImGui::TableNextColumn();
+			ImGui::ProgressBar(usage * 0.01f, ImVec2(-1.0f, 0.0f));
+		}
+
+		ImGui::EndTable();
+	}
+
+    ///////////////////////////////////////////////////////
+
+	void DrawFrameStats(const Core::SystemState& sysState)
+	{
+		// show the render workload of the last frame: draws by passes, binds by types, uploads
+
+		constexpr float toKB = 1.0f / 1024.0f;
+
+		ImGui::Text("Draw calls: %u (indirect: %u)", sysState.numDrawCalls, sysState.numIndirectDraws);
+		ImGui::Text("Instances:  %u", sysState.numInstances);
+		ImGui::Text("Primitives: %llu", (unsigned long long)sysState.numPrimitives);
+
+		if (ImGui::BeginTable("PassDraws", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+		{
+			ImGui::TableSetupColumn("pass");
+			ImGui::TableSetupColumn("draws");
+			ImGui::TableSetupColumn("instances");
+			ImGui::TableSetupColumn("primitives");
+			ImGui::TableHeadersRow();
+
+			for (int i = 0; i < sysState.numGpuPasses; ++i)
+			{
+				if (sysState.gpuPassDraws[i] == 0)
+					continue;
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(sysState.gpuPassNames[i]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", sysState.gpuPassDraws[i]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", sysState.gpuPassInstances[i]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)sysState.gpuPassPrimitives[i]);
+			}
+
+			ImGui::EndTable();
+		}
+
+		ImGui::Separator();
+		ImGui::Text("Binds: %u issued, %u filtered", sysState.numBindsIssued, sysState.numBindsFiltered);
+
+		if (ImGui::BeginTable("Binds", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+		{
+			ImGui::TableSetupColumn("type");
+			ImGui::TableSetupColumn("issued");
+			ImGui::TableSetupColumn("filtered");
+			ImGui::TableHeadersRow();
+
+			for (int i = 0; i < sysState.numBindTypes; ++i)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(sysState.bindTypeNames[i]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", sysState.bindsIssued[i]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", sysState.bindsFiltered[i]);
+			}
+
+			ImGui::EndTable();
+		}
+
+		ImGui::Separator();
+
+		if (ImGui::BeginTable("Uploads", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+		{
+			ImGui::TableSetupColumn("upload");
+			ImGui::TableSetupColumn("KB");
+			ImGui::TableSetupColumn("maps");
+			ImGui::TableHeadersRow();
+
+			for (int i = 0; i < sysState.numUploadTypes; ++i)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(sysState.uploadTypeNames[i]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.1f", (float)sysState.uploadBytes[i] * toKB);
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", sysState.uploadMaps[i]);
+			}
+
+			// texture uploads are copied by tiles through staging textures
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted("textures");
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", (float)sysState.texUploadBytes * toKB);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", sysState.texUploadTiles);
+
+			ImGui::EndTable();
+		}
+	}
+
+    ///////////////////////////////////////////////////////
+
+	void DrawMemory()
+	{
+		// show current/peak memory of each subsystem (a row is red when it exceeds the budget)
+
+		constexpr float toMB = 1.0f / (1024.0f * 1024.0f);
+		const ImVec4 overColor(1.0f, 0.3f, 0.3f, 1.0f);
+
+		ImGui::Text("Total: %.2f MB (peak: %.2f MB)",
+			g_MemTracker.GetTotal()     * toMB,
+			g_MemTracker.GetTotalPeak() * toMB);
+
+		if (!ImGui::BeginTable("Memory", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+			return;
+
+		ImGui::TableSetupColumn("owner");
+		ImGui::TableSetupColumn("MB");
+		ImGui::TableSetupColumn("peak MB");
+		ImGui::TableSetupColumn("budget MB");
+		ImGui::TableSetupColumn("allocs");
+		ImGui::TableHeadersRow();
+
+		for (int i = 0; i < NUM_MEM_TAGS; ++i)
+		{
+			const eMemTag tag    = (eMemTag)i;
+			const uint64  budget = g_MemTracker.GetBudget(tag);
+			const uint64  curr   = g_MemTracker.GetCurrent(tag);
+			const bool    isOver = budget && (curr > budget);
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(MemTracker::GetTagName(tag));
+			ImGui::TableNextColumn();
+
+			if (isOver)
+				ImGui::TextColored(overColor, "%.2f", curr * toMB);
+			else
+				ImGui::Text("%.2f", curr * toMB);
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", g_MemTracker.GetPeak(tag) * toMB);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.0f", budget * toMB);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)g_MemTracker.GetNumAllocs(tag));
+		}
+
+		// video memory
+		for (int i = 0; i < NUM_GPU_MEM_TAGS; ++i)
+		{
+			const eGpuMemTag tag    = (eGpuMemTag)i;
+			const uint64     budget = g_MemTracker.GetGpuBudget(tag);
+			const uint64     curr   = g_MemTracker.GetGpuCurrent(tag);
+			const bool       isOver = budget && (curr > budget);
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("gpu %s", MemTracker::GetGpuTagName(tag));
+			ImGui::TableNextColumn();
+
+			if (isOver)
+				ImGui::TextColored(overColor, "%.2f", curr * toMB);
+			else
+				ImGui::Text("%.2f", curr * toMB);
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", g_MemTracker.GetGpuPeak(tag) * toMB);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.0f", budget * toMB);
+			ImGui::TableNextColumn();
+		}
+
+		ImGui::EndTable();
+	}
 };
 
 } // namespace UI
@@ -14,15 +14,10 @@ namespace UI
 
 void MaterialAssetsBrowser::Initialize(IFacadeEngineToUI* pFacade)
 {
-    if (pFacade)
-    {
-
-        size numMaterials = 0;
-        pFacade->GetNumMaterials(numMaterials);
-        numItems_ = (int)numMaterials + 1;
+    // NOTE: icons aren't rendered here: they are requested only for visible items
 
-        pFacade->RenderMaterialsIcons(0, numItems_, (int)iconSize_, (int)iconSize_);
-    }
+    if (pFacade)
+        UpdateNumItems(pFacade);
 }
 
 ///////////////////////////////////////////////////////////
@@ -47,15 +42,18 @@ void MaterialAssetsBrowser::Render(IFacadeEngineToUI* pFacade, bool* pOpen)
     {
         const int availWidth = (int)ImGui::GetContentRegionAvail().x;
 
-        // if we changed the width of the browser's window
-        if ((prevAvailWidth_ != availWidth) || isNeedUpdateIcons_)
+        // if we changed the width of the browser's window (or materials are added)
+        if (UpdateNumItems(pFacade) || (prevAvailWidth_ != availWidth))
         {
             UpdateLayoutSizes(availWidth);
             prevAvailWidth_ = availWidth;
-            isNeedUpdateIcons_ = false;
+        }
 
-            // update icons images
-            pFacade->RenderMaterialsIcons(0, numItems_, (int)iconSize_, (int)iconSize_);
+        // icons of changed materials are re-rendered when they are visible
+        if (isNeedUpdateIcons_)
+        {
+            isNeedUpdateIcons_ = false;
+            pFacade->InvalidateMaterialIcons();
         }
 
         // setup start position for debug info rendering
@@ -108,6 +106,21 @@ bool MaterialAssetsBrowser::WasMaterialChanged()
 // =================================================================================
 // Private methods
 // =================================================================================
+bool MaterialAssetsBrowser::UpdateNumItems(IFacadeEngineToUI* pFacade)
+{
+    // return true if the number of materials is changed
+
+    size numMaterials = 0;
+    pFacade->GetNumMaterials(numMaterials);
+
+    const bool isChanged = (numItems_ != (int)numMaterials + 1);
+    numItems_ = (int)numMaterials + 1;
+
+    return isChanged;
+}
+
+///////////////////////////////////////////////////////////
+
 void MaterialAssetsBrowser::RenderMenuBar(bool* pOpen)
 {
     if (ImGui::BeginMenuBar())
@@ -245,9 +258,18 @@ void MaterialAssetsBrowser::DrawMaterialIcons(const ImVec2 startPos, IFacadeEngi
                         showIconContextMenu_ = true;
                     }
                
-                    // draw texture image icon
-                    ImGui::SetCursorScreenPos(pos);
-                    ImGui::Image((ImTextureID)pFacade->materialIcons_[itemIdx], { iconSize_, iconSize_ });
+                    // draw icon from its slot of the shared atlas (it is rendered on demand)
+                    MaterialID matID  = 0;
+                    SRV*       pAtlas = nullptr;
+                    ImVec2     uv0(0, 0);
+                    ImVec2     uv1(1, 1);
+
+                    if (pFacade->GetMaterialIdByIdx(itemIdx, matID) &&
+                        pFacade->GetMaterialIcon(matID, pAtlas, &uv0.x, &uv1.x))
+                    {
+                        ImGui::SetCursorScreenPos(pos);
+                        ImGui::Image((ImTextureID)pAtlas, { iconSize_, iconSize_ }, uv0, uv1);
+                    }
 
                     // draw label (just index)
                     const ImVec2 boxMin(pos.x - 1, pos.y - 1);
@@ -331,7 +353,6 @@ void MaterialAssetsBrowser::ComputeZooming(const ImVec2 startPos, const int avai
             iconSize_ *= powf(1.1f, zoomWheelAccum_);
             iconSize_ = std::clamp(iconSize_, 16.0f, 512.0f);
             zoomWheelAccum_ -= (int)zoomWheelAccum_;
-            isNeedUpdateIcons_ = true;
             UpdateLayoutSizes(availWidth);
             
 
@@ -26,6 +26,7 @@ public:
     bool              WasMaterialChanged();
 
 private:
+    bool UpdateNumItems      (IFacadeEngineToUI* pFacade);
     void RenderMenuBar       (bool* pOpen);
     void UpdateLayoutSizes   (int availWidth);
     void RenderDebugInfo     (const int availWidth);
@@ -65,12 +66,11 @@ private:
 
     bool    stretchSpacing_         = false;
     bool    materialWasChanged_     = false;
-    bool    isNeedUpdateIcons_      = false;     // set true when we resizing the browser or zooming in/out
+    bool    isNeedUpdateIcons_      = false;     // set true when materials are changed (icons are checked again and only changed ones are re-rendered)
     bool    showMaterialEditorWnd_  = false;     // show a window for editing a single material (opens through contex menu when hit RMB over some icon) 
     bool    showMaterialDeleteWnd_  = false;     // show a window for deleting a single material (opens through contex menu when hit RMB over some icon)
     bool    showIconContextMenu_    = false;
     bool    rotateMaterialBigIcon_  = false;
-    cvector<ID3D11ShaderResourceView*> materialsIcons_;
 };
 
 }; // namespace UI
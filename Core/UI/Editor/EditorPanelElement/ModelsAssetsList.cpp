@@ -29,15 +29,23 @@ void ModelsAssetsList::LoadModelsNamesList(IFacadeEngineToUI* pFacade)
 
 void ModelsAssetsList::PrintModelsNamesList()
 {
-    // print a selectable list of models names
+    // print a selectable list of models names (only visible lines are submitted)
 
-    const std::string selectedName = selectedModelName_;
+    ImGuiListClipper clipper;
+    clipper.Begin((int)modelsNames_.size());
 
-    for (const std::string& name : modelsNames_)
+    while (clipper.Step())
     {
-        if (ImGui::Selectable(name.c_str(), selectedName == name, ImGuiSelectableFlags_DontClosePopups))
-            selectedModelName_ = name;
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+        {
+            const std::string& name = modelsNames_[i];
+
+            if (ImGui::Selectable(name.c_str(), selectedModelName_ == name, ImGuiSelectableFlags_DontClosePopups))
+                selectedModelName_ = name;
+        }
     }
+
+    clipper.End();
 }
 
 } // namespace UI
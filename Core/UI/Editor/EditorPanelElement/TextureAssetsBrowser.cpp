@@ -14,17 +14,15 @@ namespace UI
 
 void TextureAssetsBrowser::Initialize(IFacadeEngineToUI* pFacade)
 {
-    if (pFacade)
-    {
-        // get a pointer to the array of textures shader resource views
-        size tmpNumItems = 0;
-        pFacade->GetArrTexturesSRVs(arrShaderResourceViews_, tmpNumItems);
-        numItems_ = (int)tmpNumItems;
-    }
-    else
+    // NOTE: thumbnails aren't made here: they are requested only for visible icons
+
+    if (!pFacade)
     {
         LogErr("can't init textures browser");
+        return;
     }
+
+    UpdateNumItems(pFacade);
 }
 
 ///////////////////////////////////////////////////////
@@ -33,12 +31,16 @@ void TextureAssetsBrowser::Render(IFacadeEngineToUI* pFacade, bool* pOpen)
 {
     // render a browser (window) of loaded textures
 
-    if (!pFacade && !arrShaderResourceViews_)
+    if (!pFacade)
     {
         LogErr("can't render textures browser");
         return;
     }
 
+    // textures can be added since the prev frame
+    if (UpdateNumItems(pFacade))
+        prevAvailWidth_ = 0.0f;
+
     ImGui::SetNextWindowContentSize(ImVec2(0.0f, layoutOuterPadding_ + numLayoutLine_ * (layoutItemSize_.y + layoutItemSpacing_)));
   
     RenderMenuBar(pOpen);
@@ -85,6 +87,22 @@ void TextureAssetsBrowser::Render(IFacadeEngineToUI* pFacade, bool* pOpen)
 // =================================================================================
 // Private methods
 // =================================================================================
+bool TextureAssetsBrowser::UpdateNumItems(IFacadeEngineToUI* pFacade)
+{
+    // return true if the number of textures is changed
+
+    SRV** arrSRVs     = nullptr;
+    size  tmpNumItems = 0;
+    pFacade->GetArrTexturesSRVs(arrSRVs, tmpNumItems);
+
+    const bool isChanged = (numItems_ != (int)tmpNumItems);
+    numItems_ = (int)tmpNumItems;
+
+    return isChanged;
+}
+
+///////////////////////////////////////////////////////////
+
 void TextureAssetsBrowser::RenderMenuBar(bool* pOpen)
 {
     if (ImGui::BeginMenuBar())
@@ -208,9 +226,16 @@ void TextureAssetsBrowser::DrawTextureIcons(const ImVec2 startPos, IFacadeEngine
                     ImDrawList* pDrawList = ImGui::GetWindowDrawList();
                     pDrawList->AddRectFilled(boxMin, boxMax, iconBgColor);
 
-                    // draw texture image icon
-                    ImGui::SetCursorScreenPos(pos);
-                    ImGui::Image((ImTextureID)arrShaderResourceViews_[itemIdx], { iconSize_, iconSize_ });
+                    // draw a thumbnail from the shared atlas (if it isn't ready yet there is only background)
+                    SRV*   pThumbnail = nullptr;
+                    ImVec2 uv0(0, 0);
+                    ImVec2 uv1(1, 1);
+
+                    if (pFacade->GetTextureThumbnail(itemIdx, pThumbnail, &uv0.x, &uv1.x))
+                    {
+                        ImGui::SetCursorScreenPos(pos);
+                        ImGui::Image((ImTextureID)pThumbnail, { iconSize_, iconSize_ }, uv0, uv1);
+                    }
 
                     // draw label (just index)
                     const ImU32 labelColor = ImGui::GetColorU32(ImGuiCol_Text);
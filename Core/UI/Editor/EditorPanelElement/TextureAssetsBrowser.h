@@ -32,6 +32,7 @@ public:
     }
 
 private:
+    bool UpdateNumItems   (IFacadeEngineToUI* pFacade);
     void RenderMenuBar    (bool* pOpen);
     void UpdateLayoutSizes(const float availWidth);       
     void RenderDebugInfo  (const float availWidth);   
@@ -39,7 +40,6 @@ private:
     void ComputeZooming   (const ImVec2 startPos, const float availWidth);
 
 private:
-    SRV**   arrShaderResourceViews_ = nullptr;
     TexID   selectedTexItemID_ = -1;
 
     float   prevAvailWidth_  = 0.0f;      // if curr and prev avail width aren't equal - we call UpdateLayoutSizes()
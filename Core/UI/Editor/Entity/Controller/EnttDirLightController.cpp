@@ -108,13 +108,6 @@ void EnttDirLightController::UndoCommand(const ICommand* pCmd, const EntityID id
 // (execute some change of directed light source and store this event into history)
 // =================================================================================
 
-static std::string GenerateMsgForHistory(const EntityID id, const std::string& propertyName)
-{
-    return "changed " + propertyName + " of entt (type: directed light; id: " + std::to_string(id) + ")";
-}
-
-///////////////////////////////////////////////////////////
-
 static std::string GenerateErrMsg(const EntityID id, const std::string& propertyName)
 {
     return "can't change " + propertyName + " of entt (type: directed light; id: " + std::to_string(id) + ")";
@@ -134,7 +127,7 @@ void EnttDirLightController::ExecChangeAmbient(const EntityID id, const ColorRGB
         // generate an "undo" command and store it into the history
         g_EventsHistory.Push(
             CmdChangeColor(CHANGE_DIR_LIGHT_AMBIENT, oldAmbient),
-            GenerateMsgForHistory(id, "ambient"),
+            "changed ambient of entt (type: directed light)",
             id);
     }
     else
@@ -157,7 +150,7 @@ void EnttDirLightController::ExecChangeDiffuse(const EntityID id, const ColorRGB
         // generate an "undo" command and store it into the history
         g_EventsHistory.Push(
             CmdChangeColor(CHANGE_DIR_LIGHT_DIFFUSE, oldDiffuse),
-            GenerateMsgForHistory(id, "diffuse"),
+            "changed diffuse of entt (type: directed light)",
             id);
     }
     else
@@ -180,7 +173,7 @@ void EnttDirLightController::ExecChangeSpecular(const EntityID id, const ColorRG
         // generate an "undo" command and store it into the history
         g_EventsHistory.Push(
             CmdChangeColor(CHANGE_DIR_LIGHT_SPECULAR, oldSpecular),
-            GenerateMsgForHistory(id, "specular"),
+            "changed specular of entt (type: directed light)",
             id);
     }
     else
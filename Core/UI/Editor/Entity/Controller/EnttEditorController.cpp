@@ -46,6 +46,10 @@ void EnttEditorController::Initialize(IFacadeEngineToUI* pFacade)
 void EnttEditorController::SetSelectedEntt(const EntityID enttID)
 {
     // set that we have selected some entity and load its data
+    // (a single entt: the multi-selection is reset)
+
+    selectedEnttData_.groupIds.clear();
+    isGroupDragging_ = false;
 
     // if we deselected the chosen entt so we won't render any control panel
     // until we won't select any other
@@ -165,6 +169,20 @@ void EnttEditorController::Render()
     if (enttID == 0)
         return;
 
+    // data of components is loaded when the entt is selected so reload only the changed
+    // one (the transform can be changed by the engine as well, not only by the editor)
+    const EntityID* changedIds = nullptr;
+    int numChanged = 0;
+
+    if (pFacade_->GetTransformChangedEntts(changedIds, numChanged) &&
+        std::binary_search(changedIds, changedIds + numChanged, enttID))
+    {
+        const cvector<eEnttComponentType>& types = selectedEnttData_.componentsTypes;
+
+        if (std::find(types.begin(), types.end(), TransformComponent) != types.end())
+            transformController_.LoadEnttData(enttID);
+    }
+
     // we want the next editor panel to be visible
     static bool isOpen = true;
     ImGui::SetNextItemOpen(isOpen);
@@ -174,6 +192,12 @@ void EnttEditorController::Render()
     ImGui::Separator();
     RenderEntityIdAndName(enttID, selectedEnttData_.name);
 
+    if (IsSelectedGroup())
+        ImGui::Text("Selected entts: %d (components of the first one are shown)", (int)selectedEnttData_.groupIds.size());
+
+    if (ImGui::Button("Select all with the same model"))
+        SelectEnttsWithSameModel();
+
 
     // render view (editor control fields) for each added component
     for (const eEnttComponentType type : selectedEnttData_.componentsTypes)
@@ -249,6 +273,107 @@ void EnttEditorController::Render()
 }
 
 
+///////////////////////////////////////////////////////////
+
+void EnttEditorController::SetSelectedEntts(
+    const EntityID* ids,
+    const int numEntts,
+    const EntityID primaryID)
+{
+    if (!ids || (numEntts <= 0))
+    {
+        SetSelectedEntt(0);
+        return;
+    }
+
+    // load data of the primary entt (it resets the group)
+    SetSelectedEntt((primaryID) ? primaryID : ids[0]);
+
+    if (numEntts == 1)
+        return;
+
+    cvector<EntityID>& group = selectedEnttData_.groupIds;
+    group.assign(ids, ids + numEntts);
+    std::sort(group.begin(), group.end());
+
+    UpdateGroupPivot();
+}
+
+///////////////////////////////////////////////////////////
+
+void EnttEditorController::ToggleSelectedEntt(const EntityID id)
+{
+    // ctrl+click: add the entt to the selection or remove it from there
+
+    if (id == 0)
+        return;
+
+    cvector<EntityID> ids = selectedEnttData_.groupIds;
+
+    if (ids.empty() && selectedEnttData_.IsSelectedAnyEntt())
+        ids.push_back(selectedEnttData_.id);
+
+    auto it = std::lower_bound(ids.begin(), ids.end(), id);
+
+    // remove: the primary entt is kept if it is still selected
+    if ((it != ids.end()) && (*it == id))
+    {
+        ids.erase(it);
+
+        const EntityID primaryID = (id == selectedEnttData_.id) ? 0 : selectedEnttData_.id;
+        SetSelectedEntts(ids.data(), (int)ids.size(), primaryID);
+    }
+    // add: the just clicked entt becomes the primary one
+    else
+    {
+        ids.insert(it, id);
+        SetSelectedEntts(ids.data(), (int)ids.size(), id);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EnttEditorController::SelectEnttsWithSameModel()
+{
+    cvector<EntityID> ids;
+
+    if (pFacade_->GetEnttsWithSameModel(selectedEnttData_.id, ids))
+        SetSelectedEntts(ids.data(), (int)ids.size(), selectedEnttData_.id);
+}
+
+///////////////////////////////////////////////////////////
+
+void EnttEditorController::UpdateGroupPivot()
+{
+    // the gizmo of the group is placed at the center of its entts
+
+    const cvector<EntityID>& group = selectedEnttData_.groupIds;
+    const int numEntts = (int)group.size();
+
+    if (numEntts == 0)
+        return;
+
+    cvector<Vec3>  positions(numEntts);
+    cvector<Vec3>  directions(numEntts);
+    cvector<float> scales(numEntts);
+
+    if (!pFacade_->GetEnttsTransformData(group.data(), numEntts, positions.data(), directions.data(), scales.data()))
+        return;
+
+    Vec3 center(0, 0, 0);
+
+    for (const Vec3& pos : positions)
+    {
+        center.x += pos.x;
+        center.y += pos.y;
+        center.z += pos.z;
+    }
+
+    const float invNum = 1.0f / numEntts;
+    groupPivot_ = Vec3(center.x * invNum, center.y * invNum, center.z * invNum);
+}
+
+
 // =================================================================================
 // For manipulation with gizmos
 // =================================================================================
@@ -292,6 +417,129 @@ void EnttEditorController::UpdateSelectedEnttWorld(const DirectX::XMMATRIX& worl
 }
 
 
+///////////////////////////////////////////////////////////
+
+void EnttEditorController::UpdateSelectedGroupWorld(const DirectX::XMMATRIX& world)
+{
+    // the gizmo is placed at the pivot of the group each frame so the world contains
+    // only the change of the current frame; it is applied to the whole group at once
+
+    using namespace DirectX;
+
+    const cvector<EntityID>& group = selectedEnttData_.groupIds;
+    const int numEntts = (int)group.size();
+
+    XMVECTOR scale, rotQuat, translation;
+    XMMatrixDecompose(&scale, &rotQuat, &translation, world);
+
+    if (!isGroupDragging_)
+    {
+        isGroupDragging_   = true;
+        groupDragOffset_   = Vec3(0, 0, 0);
+        groupDragRotation_ = Vec4(0, 0, 0, 1);
+    }
+
+    switch (pStatesGUI_->gizmoOperation)
+    {
+        case ImGuizmo::OPERATION::TRANSLATE:
+        {
+            const XMVECTOR pivot = XMVectorSet(groupPivot_.x, groupPivot_.y, groupPivot_.z, 1.0f);
+            const Vec3     delta = Vec3(XMVectorSubtract(translation, pivot));
+
+            if ((delta.x == 0) && (delta.y == 0) && (delta.z == 0))
+                break;
+
+            if (pFacade_->AdjustEnttsPositions(group.data(), numEntts, delta))
+            {
+                groupPivot_      = Vec3(groupPivot_.x + delta.x, groupPivot_.y + delta.y, groupPivot_.z + delta.z);
+                groupDragOffset_ = Vec3(groupDragOffset_.x + delta.x, groupDragOffset_.y + delta.y, groupDragOffset_.z + delta.z);
+            }
+            break;
+        }
+        case ImGuizmo::OPERATION::ROTATE:
+        {
+            if (XMQuaternionIsIdentity(rotQuat))
+                break;
+
+            // each entt is rotated around itself
+            if (pFacade_->RotateEnttsByQuat(group.data(), numEntts, Vec4(rotQuat)))
+            {
+                const XMVECTOR accum = XMQuaternionMultiply(groupDragRotation_.ToXMVector(), rotQuat);
+                groupDragRotation_   = Vec4(accum);
+            }
+            break;
+        }
+        default:
+        {
+            // there is no uniform scaling of a group around its pivot
+            break;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EnttEditorController::EndGroupTransform()
+{
+    // the drag is finished: store undo commands of all the entts of the group
+    // as a single entry of the events history
+
+    using namespace DirectX;
+
+    if (!isGroupDragging_)
+        return;
+
+    isGroupDragging_ = false;
+
+    const cvector<EntityID>& group = selectedEnttData_.groupIds;
+    const int numEntts = (int)group.size();
+
+    const bool isMoved   = (groupDragOffset_.x != 0) || (groupDragOffset_.y != 0) || (groupDragOffset_.z != 0);
+    const bool isRotated = !XMQuaternionIsIdentity(groupDragRotation_.ToXMVector());
+
+    if (numEntts == 0 || (!isMoved && !isRotated))
+        return;
+
+    cvector<ICommand> undoCmds(numEntts);
+
+    if (isMoved)
+    {
+        cvector<Vec3>  positions(numEntts);
+        cvector<Vec3>  directions(numEntts);
+        cvector<float> scales(numEntts);
+
+        pFacade_->GetEnttsTransformData(group.data(), numEntts, positions.data(), directions.data(), scales.data());
+
+        // undo: set the positions before the drag
+        for (int i = 0; i < numEntts; ++i)
+        {
+            const Vec3 oldPos(
+                positions[i].x - groupDragOffset_.x,
+                positions[i].y - groupDragOffset_.y,
+                positions[i].z - groupDragOffset_.z);
+
+            undoCmds[i] = CmdChangeVec3(CHANGE_ENTITY_POSITION, oldPos);
+        }
+
+        g_EventsHistory.PushGroup(undoCmds.data(), group.data(), numEntts, "moved a group of entts");
+    }
+
+    if (isRotated)
+    {
+        // undo: rotate each entt by the inverse rotation of the whole drag
+        const Vec4 invRot(XMQuaternionInverse(groupDragRotation_.ToXMVector()));
+
+        for (ICommand& cmd : undoCmds)
+            cmd = CmdChangeVec4(CHANGE_ENTITY_DIRECTION, invRot);
+
+        g_EventsHistory.PushGroup(undoCmds.data(), group.data(), numEntts, "rotated a group of entts");
+    }
+
+    // update editor fields of the primary entt
+    transformController_.LoadEnttData(selectedEnttData_.id);
+}
+
+
 // =================================================================================
 // private API: commands executors
 // =================================================================================
@@ -45,6 +45,13 @@ private:
     IFacadeEngineToUI*          pFacade_ = nullptr;          // facade interface btw GUI and engine        
     StatesGUI*                  pStatesGUI_ = nullptr;
 
+    // the gizmo of a group is placed at its center; changes of the current drag
+    // are accumulated so the whole drag is a single entry of the events history
+    Vec3                        groupPivot_;
+    Vec3                        groupDragOffset_;
+    Vec4                        groupDragRotation_ = { 0,0,0,1 };
+    bool                        isGroupDragging_   = false;
+
 public:
     EnttEditorController(StatesGUI* pStatesGUI);
 
@@ -54,10 +61,27 @@ public:
 
     inline EntityID GetSelectedEnttID() const { return selectedEnttData_.id; }
 
+    // multi-selection (box select, ctrl+click, select by model);
+    // primaryID: the entt which components are shown (0 - the first one)
+    void SetSelectedEntts(const EntityID* ids, const int numEntts, const EntityID primaryID = 0);
+    void ToggleSelectedEntt(const EntityID id);
+    void SelectEnttsWithSameModel();
+
+    inline bool                     IsSelectedGroup()   const { return selectedEnttData_.IsSelectedGroup(); }
+    inline const cvector<EntityID>& GetSelectedGroup()  const { return selectedEnttData_.groupIds; }
+    inline const Vec3&              GetGroupPivot()     const { return groupPivot_; }
+    inline bool                     IsGroupDragging()   const { return isGroupDragging_; }
+
 
     // methods for transformations with gizmo
     void UpdateSelectedEnttWorld(const DirectX::XMMATRIX& world);
 
+    // the same for a group: deltas are applied to all the entts by batched calls;
+    // when the drag is finished it is stored into the history as a single entry
+    void UpdateSelectedGroupWorld(const DirectX::XMMATRIX& world);
+    void EndGroupTransform();
+    void UpdateGroupPivot();
+
     // execute command and store this change into the events history
     virtual void Execute(const ICommand* pCommand) override;
 
@@ -138,13 +138,6 @@ void EnttPointLightController::UndoCommand(const ICommand* pCmd, const EntityID
 // (execute some change of point light source and store this event into history)
 // =================================================================================
 
-static std::string GenerateMsgForHistory(const EntityID id, const std::string& propertyName)
-{
-    return "changed " + propertyName + " of entt (type: point light; id: " + std::to_string(id) + ")";
-}
-
-///////////////////////////////////////////////////////////
-
 static std::string GenerateErrMsg(const EntityID id, const std::string& propertyName)
 {
     return "can't change " + propertyName + " of entt (type: point light; id: " + std::to_string(id) + ")";
@@ -164,7 +157,7 @@ void EnttPointLightController::ExecChangeAmbient(const EntityID id, const ColorR
 		// generate an "undo" command and store it into the history
 		g_EventsHistory.Push(
 			CmdChangeColor(CHANGE_POINT_LIGHT_AMBIENT, oldAmbient),
-            GenerateMsgForHistory(id, "ambient"),
+            "changed ambient of entt (type: point light)",
 			id);
 	}
 	else
@@ -187,7 +180,7 @@ void EnttPointLightController::ExecChangeDiffuse(const EntityID id, const ColorR
 		// generate an "undo" command and store it into the history
 		g_EventsHistory.Push(
 			CmdChangeColor(CHANGE_POINT_LIGHT_DIFFUSE, oldDiffuse),
-            GenerateMsgForHistory(id, "diffuse"),
+            "changed diffuse of entt (type: point light)",
 			id);
 	}
 	else
@@ -210,7 +203,7 @@ void EnttPointLightController::ExecChangeSpecular(const EntityID id, const Color
 		// generate an "undo" command and store it into the history
 		g_EventsHistory.Push(
 			CmdChangeColor(CHANGE_POINT_LIGHT_SPECULAR, oldSpecular),
-            GenerateMsgForHistory(id, "specular"),
+            "changed specular of entt (type: point light)",
 			id);
 	}
 	else
@@ -233,7 +226,7 @@ void EnttPointLightController::ExecChangeRange(const EntityID id, const float ra
 		// generate an "undo" command and store it into the history
 		g_EventsHistory.Push(
 			CmdChangeFloat(CHANGE_POINT_LIGHT_RANGE, oldRange),
-            GenerateMsgForHistory(id, "range"),
+            "changed range of entt (type: point light)",
 			id);
 	}
 	else
@@ -256,7 +249,7 @@ void EnttPointLightController::ExecChangeAttenuation(const EntityID id, const Ve
 		// generate an "undo" command and store it into the history
 		g_EventsHistory.Push(
 			CmdChangeVec3(CHANGE_POINT_LIGHT_ATTENUATION, oldAttenuation),
-            GenerateMsgForHistory(id, "attenuation"),
+            "changed attenuation of entt (type: point light)",
 			id);
 	}
 	else
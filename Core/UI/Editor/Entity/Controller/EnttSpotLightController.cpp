@@ -138,13 +138,6 @@ void EnttSpotLightController::UndoCommand(const ICommand* pCmd, const EntityID i
 // Private API: change spotlight properties
 // =================================================================================
 
-static std::string GenerateMsgForHistory(const EntityID id, const std::string& propertyName)
-{
-    return "changed " + propertyName + " of entt (type: spotlight; id: " + std::to_string(id) + ")";
-}
-
-///////////////////////////////////////////////////////////
-
 static std::string GenerateErrMsg(const EntityID id, const std::string& propertyName)
 {
     return "can't change " + propertyName + " of entt (type: spotlight; id: " + std::to_string(id) + ")";
@@ -164,7 +157,7 @@ void EnttSpotLightController::ExecChangeAmbient(const EntityID id, const ColorRG
         // generate an "undo" command and store it into the history
         g_EventsHistory.Push(
             CmdChangeColor(CHANGE_SPOT_LIGHT_AMBIENT, oldAmbient),
-            GenerateMsgForHistory(id, "ambient"),
+            "changed ambient of entt (type: spotlight)",
             id);
     }
     else
@@ -187,7 +180,7 @@ void EnttSpotLightController::ExecChangeDiffuse(const EntityID id, const ColorRG
         // generate an "undo" command and store it into the history
         g_EventsHistory.Push(
             CmdChangeColor(CHANGE_SPOT_LIGHT_DIFFUSE, oldDiffuse),
-            GenerateMsgForHistory(id, "diffuse"),
+            "changed diffuse of entt (type: spotlight)",
             id);
     }
     else
@@ -210,7 +203,7 @@ void EnttSpotLightController::ExecChangeSpecular(const EntityID id, const ColorR
         // generate an "undo" command and store it into the history
         g_EventsHistory.Push(
             CmdChangeColor(CHANGE_SPOT_LIGHT_SPECULAR, oldSpecular),
-            GenerateMsgForHistory(id, "specular"),
+            "changed specular of entt (type: spotlight)",
             id);
     }
     else
@@ -235,7 +228,7 @@ void EnttSpotLightController::ExecChangeDirection(const EntityID id, const Vec3&
         // generate an "undo" command and store it into the history
         gEventsHistory.Push(
             CmdChangeVec3(CHANGE_SPOT_LIGHT_DIRECTION, oldDirection),
-            GenerateMsgForHistory(id, "direction"),
+            "changed direction of entt (type: spotlight)",
             id);
     }
     else
@@ -268,7 +261,7 @@ void EnttSpotLightController::ExecChangeDirectionByQuat(const EntityID id, const
         // generate an "undo" command and store it into the history
         gEventsHistory.Push(
             CmdChangeVec3(CHANGE_SPOT_LIGHT_DIRECTION, origDirection),
-            GenerateMsgForHistory(id, "direction"),
+            "changed direction of entt (type: spotlight)",
             id);
     }
     else
@@ -294,7 +287,7 @@ void EnttSpotLightController::ExecChangeRange(const EntityID id, const float ran
         // generate an "undo" command and store it into the history
         g_EventsHistory.Push(
             CmdChangeFloat(CHANGE_SPOT_LIGHT_RANGE, oldRange),
-            GenerateMsgForHistory(id, "range"),
+            "changed range of entt (type: spotlight)",
             id);
     }
     else
@@ -319,7 +312,7 @@ void EnttSpotLightController::ExecChangeAttenuation(const EntityID id, const Vec
         // generate an "undo" command and store it into the history
         g_EventsHistory.Push(
             CmdChangeVec3(CHANGE_SPOT_LIGHT_ATTENUATION, oldAttenuation),
-            GenerateMsgForHistory(id, "attenuation"),
+            "changed attenuation of entt (type: spotlight)",
             id);
     }
 }
@@ -340,7 +333,7 @@ void EnttSpotLightController::ExecChangeSpotExponent(const EntityID id, const fl
         // generate an "undo" command and store it into the history
         g_EventsHistory.Push(
             CmdChangeFloat(CHANGE_SPOT_LIGHT_SPOT_EXPONENT, oldSpotExponent),
-            GenerateMsgForHistory(id, "spot exponent"),
+            "changed spot exponent of entt (type: spotlight)",
             id);
     }
     else
@@ -99,7 +99,8 @@ void EnttTransformController::LoadEnttData(const EntityID id)
     Vec3 direction;
     float uniScale = 0.0f;
 
-    if (pFacade_->GetEnttTransformData(id, position, direction, uniScale))
+    // (a batched call does a single lookup of the entt instead of one per property)
+    if (pFacade_->GetEnttsTransformData(&id, 1, &position, &direction, &uniScale))
         data_.SetData(position, direction, uniScale);
 }
 
@@ -121,8 +122,7 @@ void EnttTransformController::ExecChangePosition(const EntityID id, const Vec3&
 
         // generate an "undo" command and store it into the history
         const CmdChangeVec3 undoCmd(CHANGE_ENTITY_POSITION, oldPos);
-        const std::string msg = "changed posisition of entt (id: " + std::to_string(id) + ")";
-        g_EventsHistory.Push(undoCmd, msg, id);
+        g_EventsHistory.Push(undoCmd, "changed position of entt", id);
     }
     else
     {
@@ -147,8 +147,7 @@ void EnttTransformController::ExecChangeDirection(const EntityID id, const Vec4&
 
         // generate an "undo" command and store it into the history
         const CmdChangeVec3 undoCmd(CHANGE_ENTITY_DIRECTION, oldDirection);
-        sprintf(g_String, "changed direction of entt (id: %ld)", id);
-        g_EventsHistory.Push(undoCmd, g_String, id);
+        g_EventsHistory.Push(undoCmd, "changed direction of entt", id);
     }
     else
     {
@@ -172,8 +171,7 @@ void EnttTransformController::ExecChangeUniformScale(const EntityID id, const fl
 
         // generate an "undo" command and store it into the history
         const CmdChangeFloat undoCmd(CHANGE_ENTITY_SCALE, oldUniformScale);
-        sprintf(g_String, "changed uniform scale of entt (id: %ld)", id);
-        g_EventsHistory.Push(undoCmd, g_String, id);
+        g_EventsHistory.Push(undoCmd, "changed uniform scale of entt", id);
     }
     else
     {
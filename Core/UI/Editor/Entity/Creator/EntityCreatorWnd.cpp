@@ -22,6 +22,13 @@ void EntityCreatorWnd::ShowAddComponentCheckboxes()
     ImGui::Text("Add components:");
     ImGui::Checkbox("Model", &(addedComponents_.isAddedModel));
     ImGui::Checkbox("Rendered", &(addedComponents_.isAddedRendered));
+
+    // a cell and a portal exclude each other
+    if (ImGui::Checkbox("Portal cell", &(addedComponents_.isAddedPortalCell)))
+        addedComponents_.isAddedPortal = false;
+
+    if (ImGui::Checkbox("Portal", &(addedComponents_.isAddedPortal)))
+        addedComponents_.isAddedPortalCell = false;
 }
 
 ///////////////////////////////////////////////////////////
@@ -60,6 +67,24 @@ void EntityCreatorWnd::ShowRenderedComponentFields()
 
 ///////////////////////////////////////////////////////////
 
+void EntityCreatorWnd::ShowPortalComponentFields()
+{
+    if (addedComponents_.isAddedPortalCell && ImGui::CollapsingHeader("Setup Portal cell:"))
+    {
+        ImGui::Text("A box of a room (in local space; zero - by bounds of the entity)");
+        ImGui::DragFloat3("cell extents", portalData_.cellExtents.xyz, 0.1f, 0.0f, 1000.0f);
+    }
+
+    if (addedComponents_.isAddedPortal && ImGui::CollapsingHeader("Setup Portal:"))
+    {
+        ImGui::Text("A rectangle in the local XY plane (cells around it are found automatically)");
+        ImGui::DragFloat("half width",  &portalData_.halfWidth,  0.05f, 0.01f, 100.0f);
+        ImGui::DragFloat("half height", &portalData_.halfHeight, 0.05f, 0.01f, 100.0f);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 void EntityCreatorWnd::RenderCreationWindow(bool* pOpen, IFacadeEngineToUI* pFacade)
 {
     if (*pOpen == false)
@@ -95,6 +120,8 @@ void EntityCreatorWnd::RenderCreationWindow(bool* pOpen, IFacadeEngineToUI* pFac
         if (addedComponents_.isAddedRendered)
             ShowRenderedComponentFields();
 
+        ShowPortalComponentFields();
+
         ImGui::Separator();
 
         // OK, Cancel, Reset buttons
@@ -143,13 +170,27 @@ void EntityCreatorWnd::RenderCreationWindow(bool* pOpen, IFacadeEngineToUI* pFac
         LogMsgf("");
 
         EntityID enttID = pFacade->CreateEntity();
-        ModelID modelID = pFacade->GetModelIdByName(modelData_.selectedModelName);
 
         pFacade->AddTransformComponent(enttID, pos, dir, uniScale);
         pFacade->AddNameComponent(enttID, nameData_.enttName);
-        pFacade->AddModelComponent(enttID, modelID);
-        pFacade->AddRenderedComponent(enttID);
-        pFacade->AddBoundingComponent(enttID, 1, DirectX::BoundingBox({ 0,0,0 }, { 1,1,1 }));
+
+        // cells and portals are invisible helpers of interiors
+        if (addedComponents_.isAddedPortalCell)
+        {
+            pFacade->AddPortalCellComponent(enttID, portalData_.cellExtents);
+        }
+        else if (addedComponents_.isAddedPortal)
+        {
+            pFacade->AddPortalComponent(enttID, portalData_.halfWidth, portalData_.halfHeight);
+        }
+        else
+        {
+            ModelID modelID = pFacade->GetModelIdByName(modelData_.selectedModelName);
+
+            pFacade->AddModelComponent(enttID, modelID);
+            pFacade->AddRenderedComponent(enttID);
+            pFacade->AddBoundingComponent(enttID, 1, DirectX::BoundingBox({ 0,0,0 }, { 1,1,1 }));
+        }
 
     }
 #endif
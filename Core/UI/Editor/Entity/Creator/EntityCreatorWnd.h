@@ -23,6 +23,10 @@ struct eAddedComponents
     bool isAddedCamera = false;
     bool isAddedTexture = false;
     bool isAddedTexTransform = false;
+
+    // interiors visibility: such entts have no model (they are invisible helpers)
+    bool isAddedPortalCell = false;
+    bool isAddedPortal = false;
 };
 
 ///////////////////////////////////////////////////////////
@@ -40,6 +44,13 @@ struct ModelComponentData
     std::string selectedModelName = "invalid_model";
 };
 
+struct PortalComponentData
+{
+    Vec3 cellExtents = { 0,0,0 };        // zero - the cell is fitted to the entity's bounds
+    float halfWidth  = 1.0f;             // of the portal's rectangle
+    float halfHeight = 1.0f;
+};
+
 struct NameComponentData
 {
     const int maxNameLength = 64;
@@ -61,6 +72,7 @@ private:
     void ShowTransformComponentFields();
     void ShowModelComponentFields(IFacadeEngineToUI* pFacade);
     void ShowRenderedComponentFields();
+    void ShowPortalComponentFields();
 
 private:
     // window elements
@@ -70,6 +82,7 @@ private:
     eAddedComponents        addedComponents_;
     TransformComponentData  transformData_;
     ModelComponentData      modelData_;
+    PortalComponentData     portalData_;
     NameComponentData       nameData_;
     
 };
@@ -28,6 +28,7 @@ enum eEnttLightType
 struct SelectedEnttData
 {
     inline bool IsSelectedAnyEntt()         const { return (id != 0); }
+    inline bool IsSelectedGroup()           const { return (groupIds.size() > 1); }
 
     
     EntityID        id = 0;                         // selected entity ID
@@ -35,6 +36,10 @@ struct SelectedEnttData
     eEnttLightType  lightType = NUM_LIGHT_TYPES;
     
     cvector<eEnttComponentType> componentsTypes;   // types of components which are added to the entity
+
+    // multi-selection: SORTED IDs of all the selected entts (the one above is among them
+    // and its components are shown in the editor); empty if only one entt is selected
+    cvector<EntityID> groupIds;
 };
 
 
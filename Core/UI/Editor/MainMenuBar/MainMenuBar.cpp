@@ -24,7 +24,8 @@ void MainMenuBar::RenderBar(StatesGUI& states)
             }
             else if (ImGui::MenuItem("Save", "Ctrl+S"))
             {
-                // TODO:: make saving of the engine project
+                // save entities of the current scene into the scene file
+                states.saveScene = true;
             }
             else if (ImGui::MenuItem("Exit"))
             {
@@ -56,6 +57,29 @@ void MainMenuBar::RenderBar(StatesGUI& states)
 
         // --------------------------------------------
 
+        if (ImGui::BeginMenu("Tools"))
+        {
+            // small static props are merged into meshes per grid cell (the original
+            // entts are kept; a cell is rebuilt when any of its props is edited)
+            if (ImGui::MenuItem("Merge static props"))
+                states.mergeStaticProps = true;
+
+            if (ImGui::MenuItem("Unmerge static props"))
+                states.unmergeStaticProps = true;
+
+            // static point/spot lights are baked into the light volume (after their
+            // or the static geometry's changes)
+            if (ImGui::MenuItem("Bake static lights"))
+                states.bakeStaticLights = true;
+
+            // models/textures/regions of the scene which are out of budgets (see ContentAuditor)
+            ImGui::MenuItem("Content audit", NULL, &states.showWndContentAudit);
+
+            ImGui::EndMenu();
+        }
+
+        // --------------------------------------------
+
         // setup color for the button as like it is a usual menu bar elements
         ImGui::PushStyleColor(ImGuiCol_Button, ImGui::GetColorU32(ImGuiCol_MenuBarBg));
 
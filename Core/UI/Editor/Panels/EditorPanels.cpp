@@ -6,6 +6,7 @@
 #include <CoreCommon/pch.h>
 #include "EditorPanels.h"
 #include <UICommon/EventsHistory.h>
+#include <CVars.h>
 #include <imgui.h>
 
 
@@ -51,6 +52,7 @@ void EditorPanels::Render(Core::SystemState& sysState)
     RenderPropertiesControllerWnd();
     RenderDebugPanel(sysState);
     RenderLogPanel();
+    RenderConsolePanel();
     RenderEditorEventHistory();
 
     if (pStatesGUI_->showWndModelsBrowser)
@@ -61,6 +63,9 @@ void EditorPanels::Render(Core::SystemState& sysState)
     if (pStatesGUI_->showWndMaterialsBrowser)
         RenderMaterialsBrowser();
 
+    if (pStatesGUI_->showWndContentAudit)
+        RenderContentAuditWnd();
+
     
     //if (pStatesGUI_->showWnd)
     //RenderWndModelAssetsCreation()
@@ -92,10 +97,13 @@ void EditorPanels::RenderLogPanel()
             ImVec4(1, 1, 0, 1)              // color for LOG_TYPE_FORMATTED
         };
 
+        // messages are added by the log writer thread
+        std::lock_guard<std::mutex> lock(pLogStorage->mutex);
+
         for (int i = 0; i < pLogStorage->numLogs; ++i)
         {
-            const LogMessage& log = pLogStorage->logs[i];
-            ImGui::TextColored(textColors[log.type], log.msg);
+            const LogMessage& log = pLogStorage->GetLog(i);
+            ImGui::TextColored(textColors[log.type], "%s", log.msg);
         }
             
     }
@@ -104,6 +112,91 @@ void EditorPanels::RenderLogPanel()
 
 ///////////////////////////////////////////////////////////
 
+void EditorPanels::RenderConsolePanel()
+{
+    // show console variables (new values are applied at the start of the next frame)
+    // and execute console commands (their output goes into the log)
+
+    if (ImGui::Begin("Console"))
+    {
+        ImGui::InputText("filter", consoleFilter_, sizeof(consoleFilter_));
+
+        const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY;
+        const float tableHeight     = -ImGui::GetFrameHeightWithSpacing();
+
+        if (ImGui::BeginTable("CVars", 3, flags, ImVec2(0.0f, tableHeight)))
+        {
+            ImGui::TableSetupColumn("name");
+            ImGui::TableSetupColumn("value");
+            ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableHeadersRow();
+
+            for (CVar* pVar : g_CVars.GetAll())
+            {
+                if (consoleFilter_[0] && !strstr(pVar->GetName(), consoleFilter_))
+                    continue;
+
+                ImGui::PushID(pVar);
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(pVar->GetName());
+
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("%s", pVar->GetDesc());
+
+                ImGui::TableNextColumn();
+                ImGui::SetNextItemWidth(-1.0f);
+
+                switch (pVar->GetType())
+                {
+                    case CVAR_BOOL:
+                    {
+                        bool value = pVar->GetBool();
+                        if (ImGui::Checkbox("##value", &value))
+                            g_CVars.SetFloat(pVar, (value) ? 1.0f : 0.0f);
+                        break;
+                    }
+                    case CVAR_INT:
+                    {
+                        int value = pVar->GetInt();
+                        if (ImGui::DragInt("##value", &value, 1.0f, (int)pVar->GetMin(), (int)pVar->GetMax()))
+                            g_CVars.SetFloat(pVar, (float)value);
+                        break;
+                    }
+                    case CVAR_FLOAT:
+                    {
+                        float value = pVar->GetFloat();
+                        const float speed = (pVar->GetMax() - pVar->GetMin()) * 0.001f;
+
+                        if (ImGui::DragFloat("##value", &value, (speed > 0.0f) ? speed : 0.01f, pVar->GetMin(), pVar->GetMax()))
+                            g_CVars.SetFloat(pVar, value);
+                        break;
+                    }
+                }
+
+                ImGui::TableNextColumn();
+                if (ImGui::SmallButton("reset"))
+                    g_CVars.SetDefault(pVar);
+
+                ImGui::PopID();
+            }
+
+            ImGui::EndTable();
+        }
+
+        // "NAME value", "NAME", "list [filter]"
+        if (ImGui::InputText("command", consoleCmd_, sizeof(consoleCmd_), ImGuiInputTextFlags_EnterReturnsTrue))
+        {
+            g_CVars.Execute(consoleCmd_);
+            consoleCmd_[0] = '\0';
+            ImGui::SetKeyboardFocusHere(-1);
+        }
+    }
+    ImGui::End();
+}
+
+///////////////////////////////////////////////////////////
+
 void EditorPanels::RenderModelsBrowser()
 {
     if (ImGui::Begin("Models browser", &pStatesGUI_->showWndTexturesBrowser))
@@ -160,18 +253,103 @@ void EditorPanels::RenderMaterialsBrowser()
 
 ///////////////////////////////////////////////////////////
 
+void EditorPanels::RenderContentAuditWnd()
+{
+    // show the content audit: rows which are out of budgets are red;
+    // a click on a column header sorts the rows by this column
+
+    ImGui::SetNextWindowSize(ImVec2(700, 400), ImGuiCond_FirstUseEver);
+
+    if (ImGui::Begin("Content audit", &pStatesGUI_->showWndContentAudit))
+    {
+        if (ImGui::Button("Run"))
+            pFacadeEngineToUI_->RunContentAudit(contentAuditor_);
+
+        ImGui::SameLine();
+        ImGui::Checkbox("issues only", &auditIssuesOnly_);
+
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(250);
+        ImGui::InputText("##AuditCsvPath", auditCsvPath_, sizeof(auditCsvPath_));
+
+        ImGui::SameLine();
+        if (ImGui::Button("Export CSV"))
+            contentAuditor_.ExportCSV(auditCsvPath_);
+
+        const cvector<Core::AuditEntry>& entries = contentAuditor_.GetEntries();
+        ImGui::Text("rows: %d; issues: %d", (int)entries.size(), contentAuditor_.GetNumIssues());
+
+        constexpr ImGuiTableFlags flags =
+            ImGuiTableFlags_Sortable      |
+            ImGuiTableFlags_RowBg         |
+            ImGuiTableFlags_BordersInnerV |
+            ImGuiTableFlags_ScrollY       |
+            ImGuiTableFlags_Resizable;
+
+        if (ImGui::BeginTable("ContentAudit", Core::NUM_AUDIT_COLUMNS, flags))
+        {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("category");
+            ImGui::TableSetupColumn("name");
+            ImGui::TableSetupColumn("metric");
+            ImGui::TableSetupColumn("value");
+            ImGui::TableSetupColumn("budget");
+            ImGui::TableSetupColumn("over", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+            ImGui::TableHeadersRow();
+
+            // rows are sorted by the auditor only when the specs are changed
+            ImGuiTableSortSpecs* pSpecs = ImGui::TableGetSortSpecs();
+
+            if (pSpecs && pSpecs->SpecsDirty && (pSpecs->SpecsCount > 0))
+            {
+                const ImGuiTableColumnSortSpecs& spec = pSpecs->Specs[0];
+                contentAuditor_.Sort((Core::eAuditColumn)spec.ColumnIndex, spec.SortDirection == ImGuiSortDirection_Ascending);
+                pSpecs->SpecsDirty = false;
+            }
+
+            const ImVec4 colorOver = ImVec4(1, 0.3f, 0.3f, 1);
+            const ImVec4 colorOk   = ImGui::GetStyleColorVec4(ImGuiCol_Text);
+
+            for (const Core::AuditEntry& entry : entries)
+            {
+                if (auditIssuesOnly_ && !entry.isOver)
+                    continue;
+
+                const ImVec4& color = (entry.isOver) ? colorOver : colorOk;
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::TextColored(color, "%s", Core::ContentAuditor::GetCategoryName(entry.category));
+                ImGui::TableNextColumn(); ImGui::TextColored(color, "%s", entry.name);
+                ImGui::TableNextColumn(); ImGui::TextColored(color, "%s", entry.metric);
+                ImGui::TableNextColumn(); ImGui::TextColored(color, "%.1f", entry.value);
+                ImGui::TableNextColumn(); ImGui::TextColored(color, "%.1f", entry.budget);
+                ImGui::TableNextColumn(); ImGui::TextColored(color, "%s", (entry.isOver) ? "yes" : "");
+            }
+
+            ImGui::EndTable();
+        }
+    }
+    ImGui::End();
+}
+
+///////////////////////////////////////////////////////////
+
 void EditorPanels::RenderEditorEventHistory()
 {
     if (ImGui::Begin("Events history"))
     {
-        const std::deque<HistoryItem>& eventsHistory = g_EventsHistory.history_;
         int idx = 0;
 
-        for (auto it = eventsHistory.begin(); it != eventsHistory.end(); ++it)
+        g_EventsHistory.ForEachEntry([&idx](const HistoryCmd& cmd, const int numCmds)
         {
-            ImGui::Text("Event[%d]: %s", idx, it->msg_.c_str());
+            // a batch is shown by its first command
+            if (numCmds > 1)
+                ImGui::Text("Event[%d]: %s (entt: %u; +%d more)", idx, g_EventsHistory.GetMsg(cmd), cmd.entityID_, numCmds - 1);
+            else
+                ImGui::Text("Event[%d]: %s (entt: %u)", idx, g_EventsHistory.GetMsg(cmd), cmd.entityID_);
+
             ++idx;
-        }
+        });
     }
     ImGui::End();
 }
@@ -185,41 +363,52 @@ void EditorPanels::RenderEntitiesListWnd(Core::SystemState& sysState)
 
     if (ImGui::Begin("Entities List", &pStatesGUI_->showWndEnttsList))
     {
-        const uint32_t* pEnttsIDs = nullptr;
-        int numEntts = 0;
+        const uint32_t version = pFacadeEngineToUI_->GetEnttsStructureVersion();
 
-        // get an ID of each entity on the scene
-        pFacadeEngineToUI_->GetAllEnttsIDs(pEnttsIDs, numEntts);
-
-        cvector<std::string> enttsNames(numEntts);
+        // get an ID and a name of each entity on the scene (by a single batched call)
+        if (version != listVersion_)
+        {
+            const EntityID* pEnttsIDs = nullptr;
+            int numEntts = 0;
 
-        // ------ TODO: optimize ----------
-        // 
-        // get a name of each entity on the scene
-        for (int i = 0; std::string& name : enttsNames)
-            pFacadeEngineToUI_->GetEnttNameByID(pEnttsIDs[i++], name);
+            pFacadeEngineToUI_->GetAllEnttsIDs(pEnttsIDs, numEntts);
 
-        /*
-        for (int i = 0; i < numEnttsTypes; ++i)
-        {
+            listEnttsIDs_.assign(pEnttsIDs, pEnttsIDs + numEntts);
+            listEnttsNames_.resize(numEntts);
+            pFacadeEngineToUI_->GetEnttsNames(listEnttsIDs_.data(), numEntts, listEnttsNames_.data());
 
+            listVersion_ = version;
         }
-        if (isOpen = ImGui::CollapsingHeader("Spotlight Properties", ImGuiTreeNodeFlags_SpanFullWidth))
-            viewLight_.Render(spotLightController_.GetModel());
-            */
 
-        const EntityID currSelectedEnttID = enttEditorController_.GetSelectedEnttID();
+        const EntityID currSelectedEnttID        = enttEditorController_.GetSelectedEnttID();
+        const cvector<EntityID>& selectedGroup   = enttEditorController_.GetSelectedGroup();
 
-        // render selectable menu with entts names
-        for (int i = 0; i < numEntts; ++i)
-        {
-            bool isSelected = (pEnttsIDs[i] == currSelectedEnttID);
+        // render selectable menu with entts names (only the visible rows)
+        ImGuiListClipper clipper;
+        clipper.Begin((int)listEnttsIDs_.size());
 
-            if (ImGui::Selectable(enttsNames[i].c_str(), isSelected, ImGuiSelectableFlags_AllowDoubleClick))
+        while (clipper.Step())
+        {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
             {
-                const EntityID id = pEnttsIDs[i];
+                const EntityID id = listEnttsIDs_[i];
+                const bool isSelected = (id == currSelectedEnttID) ||
+                                        std::binary_search(selectedGroup.begin(), selectedGroup.end(), id);
+
+                ImGui::PushID((int)id);
+                const bool isClicked = ImGui::Selectable(listEnttsNames_[i], isSelected, ImGuiSelectableFlags_AllowDoubleClick);
+                ImGui::PopID();
+
+                if (!isClicked)
+                    continue;
+
                 sysState.pickedEnttID_ = id;                 // set this ID into the system state
-                enttEditorController_.SetSelectedEntt(id);   // and update the editor to show data of this entt
+
+                // and update the editor to show data of this entt (ctrl+click: multi-selection)
+                if (ImGui::GetIO().KeyCtrl)
+                    enttEditorController_.ToggleSelectedEntt(id);
+                else
+                    enttEditorController_.SetSelectedEntt(id);
 
                 // if we do double click on the selectable item we move our camera
                 // to this item in world and fix on in
@@ -251,6 +440,8 @@ void EditorPanels::RenderDebugPanel(const Core::SystemState& systemState)
         // show fps and frame time
         ImGui::Text("Fps:        %d", systemState.fps);
         ImGui::Text("Frame time: %f", systemState.frameTime);
+        ImGui::Text("Frame time p50/p95/p99: %.2f / %.2f / %.2f ms",
+                    systemState.frameTimeP50, systemState.frameTimeP95, systemState.frameTimeP99);
 
 
         const DirectX::XMFLOAT3& camPos = systemState.cameraPos;
@@ -258,6 +449,35 @@ void EditorPanels::RenderDebugPanel(const Core::SystemState& systemState)
         ImGui::Text("Camera pos: %.2f %.2f %.2f", camPos.x, camPos.y, camPos.z);
 
         ImGui::Text("Visible point lights: %d", systemState.numVisiblePointLights);
+        ImGui::Text("Visible spotlights: %d", systemState.numVisibleSpotLights);
+
+        // show GPU time of each render pass
+        if (ImGui::TreeNode("GPU passes:"))
+        {
+            debugEditor_.DrawGpuPasses(systemState);
+            ImGui::TreePop();
+        }
+
+        // show draw calls, binds and uploads of the last frame
+        if (ImGui::TreeNode("Frame stats:"))
+        {
+            debugEditor_.DrawFrameStats(systemState);
+            ImGui::TreePop();
+        }
+
+        // show cpu usage by the process and workers, RAM and VRAM
+        if (ImGui::TreeNode("Telemetry:"))
+        {
+            debugEditor_.DrawTelemetry(systemState);
+            ImGui::TreePop();
+        }
+
+        // show memory usage of each subsystem and its budget
+        if (ImGui::TreeNode("Memory:"))
+        {
+            debugEditor_.DrawMemory();
+            ImGui::TreePop();
+        }
 
         // show debug options
         if (ImGui::TreeNode("Show as Color:"))
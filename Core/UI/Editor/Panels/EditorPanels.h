@@ -18,6 +18,7 @@
 #include "../Entity/Controller/EnttEditorController.h"
 #include "../Fog/FogEditorController.h"
 #include "../Entity/Creator/EntityCreatorWnd.h"
+#include "../../../Engine/ContentAuditor.h"
 
 
 namespace UI
@@ -37,10 +38,12 @@ private:
     void RenderPropertiesControllerWnd();
     void RenderDebugPanel(const Core::SystemState& sysState);
     void RenderLogPanel();
+    void RenderConsolePanel();
     void RenderModelsBrowser();
     void RenderTexturesBrowser();
     void RenderMaterialsBrowser();
     void RenderEditorEventHistory();
+    void RenderContentAuditWnd();
 
     void RenderWndEntityCreation(bool* pOpen, IFacadeEngineToUI* pFacade);
     void RenderWndModelAssetsCreation(bool* pOpen);
@@ -59,6 +62,21 @@ private:
     TextureAssetsBrowser  texturesBrowser_;
     MaterialAssetsBrowser materialsBrowser_;
     ModelsAssetsList      modelsAssetsList_;
+
+    // the entities list is fetched again only when the entts structure is changed
+    // (entts are created/destroyed or get new components)
+    cvector<EntityID>     listEnttsIDs_;
+    cvector<const char*>  listEnttsNames_;
+    uint32_t              listVersion_ = UINT32_MAX;
+
+    // the console of cvars
+    char                  consoleFilter_[64]{ '\0' };
+    char                  consoleCmd_[128]{ '\0' };
+
+    // the content audit (rows are kept until the next run)
+    Core::ContentAuditor  contentAuditor_;
+    char                  auditCsvPath_[128] = "data/audit/content.csv";
+    bool                  auditIssuesOnly_ = true;
 };
 
 } // namespace UI
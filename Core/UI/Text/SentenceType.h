@@ -9,6 +9,8 @@
 ////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <MemTracker.h>
+
 
 namespace UI
 {
@@ -31,7 +33,7 @@ public:
 
 	void* operator new(std::size_t size)  // a replaceable allocation
 	{
-		if (void* ptr = _aligned_malloc(size, 16))
+		if (void* ptr = MemTracker::Allocate(size, 16, MEM_TAG_UI))
 		{
 			return ptr;
 		}
@@ -43,7 +45,7 @@ public:
 	// ordinary delete
 	void operator delete(void* p) noexcept
 	{
-		_aligned_free(p);
+		MemTracker::Free(p);
 	}
 
 	//
@@ -28,65 +28,29 @@ TextStore::~TextStore()
 // =================================================================================
 void TextStore::InitDebugText(ID3D11Device* pDevice, FontClass& font)
 {
-    constexpr size      vbSize = maxNumVerticesInDbgText;
-    constexpr size      ibSize = maxNumCharsInDbgText * 6;  // 6 indices per symbol
-    const cvector<UINT> indices(ibSize, 0);
-    const bool          isDynamic = true;
-
-    // ----------------------------------------------------
-   
-    // offset in the buf of raw vertices
-    index vOffset = 0;  
-
-    // build vertices for the whole debug const text
-    Core::VertexFont rawVertices[maxNumVerticesInDbgText];
+    // allocate glyph ranges for the debug sentences (they must be added before)
+    // and create buffers for the whole text
 
     for (index idx = 0; idx < numDbgConstSentences_; ++idx)
     {
-        // number of vertices for the current sentence
-        const size numVertices = (size)strlen(dbgConstSentences_[idx].text) * 4;
-
-        // rebuild vertices for this sentence
-        font.BuildVertexArray(
-            rawVertices + vOffset,
-            numVertices,
-            dbgConstSentences_[idx].text,
-            dbgConstSentences_[idx].drawAtX,
-            dbgConstSentences_[idx].drawAtY);
-
-        vOffset += numVertices;
-
-        if (vOffset >= maxNumVerticesInDbgText)
-        {
-            LogErr("too much vertices for the vertex buffer of debug const sentences");
-            idx = numDbgConstSentences_;   // go out from the for-loop
-        }
-    }
-    // compute actual number of indices (vOffset / vertices_per_sym * indices_per_sym)
-    indexCountDbgConstText_ = (u32)(vOffset / 4 * 6);
+        DbgSentence& sentence = dbgConstSentences_[idx];
+        const size   numChars = (size)strlen(sentence.text);
 
-    // ----------------------------------------------------
-
-    // init vertex buffer for debug const and dynamic sentences
-    if (!vbDbgConstText_.Initialize(pDevice, rawVertices, (int)vOffset, !isDynamic))
-    {
-        LogErr("can't create a const vertex buffer for debug text");
-        return;
+        sentence.firstVertex = AllocGlyphs(numChars);
+        BuildGlyphs(font, sentence.firstVertex, numChars, sentence.text, sentence.drawAtX, sentence.drawAtY);
     }
-    if (!vbDbgDynamicText_.Initialize(pDevice, dbgTextRawVertices_, vbSize, isDynamic))
-    {
-        LogErr("can't create a dynamic vertex buffer for debug text");
-        return;
-    }
-
-    // init common index buffer (is used by both debug const and dynamic sentences)
-    font.BuildIndexArray(indices.data(), ibSize);
 
-    if (!ibDbgText_.Initialize(pDevice, indices.data(), ibSize))
+    // the content of dynamic sentences is changed so they get the max size
+    for (index idx = 0; idx < numDbgDynamicSentences_; ++idx)
     {
-        LogErr("can't create an index buffer for debug (dynamic) text");
-        return;
+        DbgSentence& sentence = dbgDynamicSentences_[idx];
+
+        sentence.firstVertex = AllocGlyphs(maxNumCharsPerSentence);
+        BuildGlyphs(font, sentence.firstVertex, maxNumCharsPerSentence, sentence.text, sentence.drawAtX, sentence.drawAtY);
     }
+
+    if (!InitBuffers(pDevice, font))
+        LogErr("can't create buffers for debug text");
 }
 
 ///////////////////////////////////////////////////////////
@@ -113,27 +77,13 @@ SentenceID TextStore::CreateConstSentence(
 
         maxStrSize_.push_back(std::ssize(textContent));
         textContent_.push_back(textContent);
+        isDynamic_.push_back(false);
 
-        cvector<Core::VertexFont> vertices;
-        cvector<UINT>             indices;
-
-        BuildTextVerticesIndices(
-            pDevice,
-            maxStrSize_.back(),
-            textContent,
-            drawAt,
-            font,
-            vertices,
-            indices);
-
-
-        // initialize the VB/IB for this text string
-        constexpr bool isDynamic = false;
-        Core::VertexBuffer<Core::VertexFont> vb(pDevice, vertices.data(), (int)vertices.size(), isDynamic);
-        Core::IndexBuffer<UINT>              ib(pDevice, indices.data(), (int)indices.size());
+        // glyphs of this text string go into the common text buffer
+        firstVertex_.push_back(AllocGlyphs(maxStrSize_.back()));
+        BuildGlyphs(font, firstVertex_.back(), maxStrSize_.back(), textContent.c_str(), drawAt.x, drawAt.y);
 
-        vertexBuffers_.push_back(std::move(vb));
-        indexBuffers_.push_back(std::move(ib));
+        CAssert::True(InitBuffers(pDevice, font), "can't recreate buffers for text");
 
         return ids_.back();
     }
@@ -173,25 +123,14 @@ SentenceID TextStore::CreateSentence(
            
         maxStrSize_.push_back(maxStrSize);       
         textContent_.push_back(textContent);
+        isDynamic_.push_back(isDynamic);
 
-        cvector<Core::VertexFont> vertices;
-        cvector<UINT> indices;
-        
-        BuildTextVerticesIndices(
-            pDevice,
-            maxStrSize,
-            textContent,
-            drawAt,
-            font, 
-            vertices,
-            indices);
-
-        // initialize the VB/IB for this text string
-        Core::VertexBuffer<Core::VertexFont> vb(pDevice, vertices.data(), (int)vertices.size(), isDynamic);
-        Core::IndexBuffer<UINT>              ib(pDevice, indices.data(), (int)indices.size());
-
-        vertexBuffers_.push_back(std::move(vb));
-        indexBuffers_.push_back(std::move(ib));
+        // the range of glyphs is reserved by the max size so the content can be
+        // changed without reallocation of the common text buffer
+        firstVertex_.push_back(AllocGlyphs(maxStrSize));
+        BuildGlyphs(font, firstVertex_.back(), maxStrSize, textContent.c_str(), drawAt.x, drawAt.y);
+
+        CAssert::True(InitBuffers(pDevice, font), "can't recreate buffers for text");
 
         return id;
     }
@@ -243,17 +182,13 @@ void TextStore::AddDebugDynamicSentence(
 ///////////////////////////////////////////////////////////
 
 void TextStore::GetRenderingData(
-    ID3D11Buffer** outConstVbPtr,    // a ptr to the const vertex buf of const debug text
-    ID3D11Buffer** outDynamicVbPtr,  // a ptr to the dynamic vertex buf of dynamic debug text
+    ID3D11Buffer** outVbPtr,         // a ptr to the vertex buf of the whole text
     ID3D11Buffer** outIbPtr,
-    u32& outConstIndexCount,         // index count for debug const sentences
-    u32& outDynamicIndexCount)       // index count for debug dynamic sentences
+    u32& outIndexCount)              // index count for the whole text
 {
-    *outConstVbPtr       = vbDbgConstText_.Get();
-    *outDynamicVbPtr     = vbDbgDynamicText_.Get();
-    *outIbPtr            = ibDbgText_.Get();
-    outConstIndexCount   = indexCountDbgConstText_;
-    outDynamicIndexCount = indexCountDbgDynamicText_;
+    *outVbPtr     = vbText_.Get();
+    *outIbPtr     = ibText_.Get();
+    outIndexCount = (vbText_.Get()) ? (u32)(glyphVertices_.size() / 4 * 6) : 0;
 }
 
 
@@ -265,32 +200,50 @@ void TextStore::UpdateDebugText(
     FontClass& font,
     const Core::SystemState& sysState)
 {
-    // update text content of each debug string
+    // format new text content of each debug string (only changed ones are rebuilt)
+    char texts[maxNumDbgSentences][maxNumCharsPerSentence]{};
     int i = 0;
 
-    sprintf(dbgDynamicSentences_[i++].text, "%d",       sysState.fps);
-    sprintf(dbgDynamicSentences_[i++].text, "%05.2fms", sysState.frameTime);
-    sprintf(dbgDynamicSentences_[i++].text, "%05.2fms", sysState.updateTime);
-    sprintf(dbgDynamicSentences_[i++].text, "%05.2fms", sysState.renderTime);
+    sprintf(texts[i++], "%d",       sysState.fps);
+    sprintf(texts[i++], "%05.2fms", sysState.frameTime);
+    sprintf(texts[i++], "%05.2fms", sysState.updateTime);
+    sprintf(texts[i++], "%05.2fms", sysState.renderTime);
 
     // pos info
-    sprintf(dbgDynamicSentences_[i++].text, "%.2f", sysState.cameraPos.x);
-    sprintf(dbgDynamicSentences_[i++].text, "%.2f", sysState.cameraPos.y);
-    sprintf(dbgDynamicSentences_[i++].text, "%.2f", sysState.cameraPos.z);
+    sprintf(texts[i++], "%.2f", sysState.cameraPos.x);
+    sprintf(texts[i++], "%.2f", sysState.cameraPos.y);
+    sprintf(texts[i++], "%.2f", sysState.cameraPos.z);
 
     // rotation info
-    sprintf(dbgDynamicSentences_[i++].text, "%.2f", sysState.cameraDir.x);
-    sprintf(dbgDynamicSentences_[i++].text, "%.2f", sysState.cameraDir.y);
-    sprintf(dbgDynamicSentences_[i++].text, "%.2f", sysState.cameraDir.z);
+    sprintf(texts[i++], "%.2f", sysState.cameraDir.x);
+    sprintf(texts[i++], "%.2f", sysState.cameraDir.y);
+    sprintf(texts[i++], "%.2f", sysState.cameraDir.z);
 
     // render info
-    sprintf(dbgDynamicSentences_[i++].text, "%d", sysState.visibleObjectsCount);
-    sprintf(dbgDynamicSentences_[i++].text, "%d", sysState.visibleVerticesCount);
-    sprintf(dbgDynamicSentences_[i++].text, "%d", sysState.visibleVerticesCount / 3);
-    sprintf(dbgDynamicSentences_[i++].text, "%d", sysState.cellsDrawn);
-    sprintf(dbgDynamicSentences_[i++].text, "%d", sysState.cellsCulled);
+    sprintf(texts[i++], "%d", sysState.visibleObjectsCount);
+    sprintf(texts[i++], "%d", sysState.visibleVerticesCount);
+    sprintf(texts[i++], "%d", sysState.visibleVerticesCount / 3);
+    sprintf(texts[i++], "%d", sysState.cellsDrawn);
+    sprintf(texts[i++], "%d", sysState.cellsCulled);
+
+    // render workload
+    uint64_t uploadBytes = sysState.texUploadBytes;
 
-    UpdateDebugSentences(pContext, font);
+    for (int type = 0; type < sysState.numUploadTypes; ++type)
+        uploadBytes += sysState.uploadBytes[type];
+
+    sprintf(texts[i++], "%u", sysState.numDrawCalls);
+    sprintf(texts[i++], "%u (%u)", sysState.numBindsIssued, sysState.numBindsFiltered);
+    sprintf(texts[i++], "%.1fKB", (float)uploadBytes / 1024.0f);
+
+    // telemetry (working set/committed memory, video memory usage/budget)
+    constexpr float toMB = 1.0f / (1024.0f * 1024.0f);
+
+    sprintf(texts[i++], "%d%%", sysState.cpu);
+    sprintf(texts[i++], "%.0f (%.0f)MB", (float)sysState.workingSetBytes * toMB, (float)sysState.committedBytes * toMB);
+    sprintf(texts[i++], "%.0f (%.0f)MB", (float)sysState.videoMemUsage * toMB, (float)sysState.videoMemBudget * toMB);
+
+    UpdateDebugSentences(font, texts, (size)i);
 }
 
 ///////////////////////////////////////////////////////////
@@ -301,111 +254,156 @@ void TextStore::Update(
     const Core::SystemState& sysState)
 
 {
-    // update the content of the dynamic text and dynamic vertex buffers
+    // update the content of the dynamic text
     UpdateDebugText(pContext, font, sysState);
+
+    // upload glyphs of all the sentences by a single map (only if some content is changed)
+    if (isTextChanged_ && vbText_.Get())
+    {
+        vbText_.UpdateDynamic(pContext, glyphVertices_.data(), glyphVertices_.size());
+        isTextChanged_ = false;
+    }
 }
 
 
 // ====================================================================================
 //                            PRIVATE MODICATION API 
 // ====================================================================================
-void TextStore::BuildTextVerticesIndices(
-    ID3D11Device* pDevice,
-    const size maxStrSize,
-    const std::string& textContent,
-    const DirectX::XMFLOAT2& drawAt,
-    FontClass& font,                      // font for the text
-    cvector<Core::VertexFont>& vertices,
-    cvector<UINT>& indices)
-{ 
-    // build a vertex and index buffer for the input string by its 
-    // textContent and places its vertices at the drawAt position;
-    try
+index TextStore::AllocGlyphs(const size maxNumChars)
+{
+    // reserve a range of glyphs in the common text buffer and return its first vertex;
+    // NOTE: the GPU buffers must be recreated after it (see InitBuffers)
+
+    constexpr size verticesPerChar = 4;
+    const index    firstVertex     = glyphVertices_.size();
+
+    glyphVertices_.resize(firstVertex + maxNumChars * verticesPerChar, Core::VertexFont());
+    return firstVertex;
+}
+
+///////////////////////////////////////////////////////////
+
+void TextStore::BuildGlyphs(
+    FontClass& font,
+    const index firstVertex,
+    const size maxNumChars,
+    const char* text,
+    const float drawAtX,
+    const float drawAtY)
+{
+    // rebuild glyphs of a sentence in its range; the rest of the range is zeroed
+    // (spaces and the tail after a shorter text are degenerate quads)
+
+    constexpr size verticesPerChar = 4;
+    const size     numVertices     = maxNumChars * verticesPerChar;
+
+    if (numVertices == 0)
+        return;
+
+    if (text && (strlen(text) > maxNumChars))
     {
-        CAssert::True(!textContent.empty(), "the input str is empty");
-        CAssert::True(maxStrSize >= std::ssize(textContent), "maxStrSize must be >= sentence size");
-
-        constexpr size numVerticesPerChar = 4;
-        constexpr size numIndicesPerChar  = 6;
-        const     size numVertices        = maxStrSize * numVerticesPerChar;
-        const     size numIndices         = maxStrSize * numIndicesPerChar;
-
-        vertices.resize(numVertices);
-        indices.resize(numIndices, 0);
-        
-        // fill in vertex and index arrays with initial data
-        font.BuildVertexArray(vertices.data(), numVertices, textContent.c_str(), drawAt.x, drawAt.y);
-        font.BuildIndexArray(indices.data(), numIndices);
+        sprintf(g_String, "the text is longer than its range of glyphs (%d): %s", (int)maxNumChars, text);
+        LogErr(g_String);
+        return;
     }
-    catch (EngineException & e)
+
+    Core::VertexFont* vertices = glyphVertices_.data() + firstVertex;
+
+    for (index i = 0; i < numVertices; ++i)
+        vertices[i] = Core::VertexFont();
+
+    if (text && (text[0] != '\0'))
+        font.BuildVertexArray(vertices, numVertices, text, drawAtX, drawAtY);
+
+    isTextChanged_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool TextStore::InitBuffers(ID3D11Device* pDevice, FontClass& font)
+{
+    // (re)create the vertex buffer of all the glyphs and the common index buffer
+    // (is called only when ranges of glyphs are added so it's rare)
+
+    const size numVertices = glyphVertices_.size();
+    const size numIndices  = numVertices / 4 * 6;         // 6 indices per symbol
+
+    if (numVertices == 0)
+        return true;
+
+    cvector<UINT> indices(numIndices, 0);
+    font.BuildIndexArray(indices.data(), numIndices);
+
+    constexpr bool isDynamic = true;
+
+    if (!vbText_.Initialize(pDevice, glyphVertices_.data(), (int)numVertices, isDynamic))
     {
-        LogErr(e);
-        sprintf(g_String, "can't build buffers for the sentence: %s", textContent.c_str());
-        LogErr(g_String);
+        LogErr("can't create a vertex buffer for text");
+        return false;
     }
+
+    if (!ibText_.Initialize(pDevice, indices.data(), (int)numIndices))
+    {
+        LogErr("can't create an index buffer for text");
+        return false;
+    }
+
+    // the vertex buffer is initialized with the actual glyphs
+    isTextChanged_ = false;
+    return true;
 }
 
 ///////////////////////////////////////////////////////////
 
 void TextStore::UpdateSentenceByIdx(
-    ID3D11DeviceContext* pContext,
     FontClass& font,
     const index idx,
     const char* newStr)
 {
     // update the sentence by idx with new content;
-    // also we rebuild its vertices according to this new content
-    // and update its VB
+    // also we rebuild its glyphs according to this new content
+    // (the VB is updated once per frame in Update())
 
     textContent_[idx] = newStr;
 
-    constexpr size numMaxVertices = 256;             // suppose max 64 symbols * 4 vertex per each symbol
-    Core::VertexFont vertices[numMaxVertices];
-    constexpr size verticesPerChar = 4;
-    const size maxNumVerticesInSentence = maxStrSize_[idx] * verticesPerChar;
-
-    // rebuild vertices for this sentence
-    font.BuildVertexArray(
-        vertices,
-        maxNumVerticesInSentence,
+    BuildGlyphs(
+        font,
+        firstVertex_[idx],
+        maxStrSize_[idx],
         newStr,
         drawAt_[idx].x,
         drawAt_[idx].y);
-
-    // update VB with new vertices
-    vertexBuffers_[idx].UpdateDynamic(pContext, vertices, maxNumVerticesInSentence);
 }
 
 ///////////////////////////////////////////////////////////
 
-void TextStore::UpdateDebugSentences(ID3D11DeviceContext* pContext, FontClass& font)
+void TextStore::UpdateDebugSentences(
+    FontClass& font,
+    const char (*newTexts)[maxNumCharsPerSentence],
+    const size numTexts)
 {
-    // update text content of the debug dynamic strings, rebuild vertices,
-    // and also update the vertex buffer with these new vertices
+    // update text content of the debug dynamic strings and rebuild glyphs
+    // only of strings which are changed
 
-    constexpr size verticesPerChar = 4;
-    index vOffset = 0;                    // offset in the buf of raw vertices
+    const size num = std::min(numTexts, numDbgDynamicSentences_);
 
-    for (index idx = 0; idx < numDbgDynamicSentences_; ++idx)
+    for (index idx = 0; idx < num; ++idx)
     {
-        // number of vertices for the current sentence
-        const size numVertices = (size)strlen(dbgDynamicSentences_[idx].text) * verticesPerChar;
-
-        // rebuild vertices for this sentence
-        font.BuildVertexArray(
-            dbgTextRawVertices_ + vOffset,
-            numVertices,
-            dbgDynamicSentences_[idx].text,
-            dbgDynamicSentences_[idx].drawAtX,
-            dbgDynamicSentences_[idx].drawAtY);
-
-        vOffset += numVertices;
-    }
+        DbgSentence& sentence = dbgDynamicSentences_[idx];
+
+        if (strcmp(sentence.text, newTexts[idx]) == 0)
+            continue;
 
-    // compute actual number of indices (vOffset / vertices_per_sym * indices_per_sym)
-    indexCountDbgDynamicText_ = (u32)(vOffset / 4 * 6);  
+        strcpy(sentence.text, newTexts[idx]);
 
-    vbDbgDynamicText_.UpdateDynamic(pContext, dbgTextRawVertices_, vOffset);
+        BuildGlyphs(
+            font,
+            sentence.firstVertex,
+            maxNumCharsPerSentence,
+            sentence.text,
+            sentence.drawAtX,
+            sentence.drawAtY);
+    }
 }
 
 } // namespace UI
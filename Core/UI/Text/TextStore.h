@@ -5,6 +5,11 @@
 //               It uses FontClass to create the vertex buffer for strings
 //               and then uses FontShaderClass to render this buffer;
 //
+//               all the text is batched into a single dynamic VB (and a common
+//               IB) so it is rendered by a single draw call; each sentence owns
+//               a fixed range of glyphs (by its max size) and only ranges of
+//               sentences whose content is changed are rebuilt;
+//
 // Revising:     04.06.22
 ////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
@@ -75,11 +80,9 @@ public:
         const float drawAtY);
 
     void GetRenderingData(
-        ID3D11Buffer** outConstVbPtr,
-        ID3D11Buffer** outDynamicVbPtr,
+        ID3D11Buffer** outVbPtr,
         ID3D11Buffer** outIbPtr,
-        u32& outConstIndexCount,    // index count for debug const sentences
-        u32& outDynamicIndexCount); // index count for debug dynamic sentences
+        u32& outIndexCount);        // index count for the whole text
 
     void Update(
         ID3D11DeviceContext* pContext,
@@ -88,14 +91,17 @@ public:
 
 private:
 
-    void BuildTextVerticesIndices(
-        ID3D11Device* pDevice,
-        const size maxStrSize,                             // maximal size for this string (if it will be bigger we will have a vertex buffer overflow)
-        const std::string& textContent,
-        const DirectX::XMFLOAT2& drawAt,                   // upper left position of the str
-        FontClass& font,                                   // font for the text
-        cvector<Core::VertexFont>& vertices,
-        cvector<UINT>& indices);
+    index AllocGlyphs(const size maxNumChars);
+
+    void BuildGlyphs(
+        FontClass& font,
+        const index firstVertex,
+        const size maxNumChars,
+        const char* text,
+        const float drawAtX,
+        const float drawAtY);
+
+    bool InitBuffers(ID3D11Device* pDevice, FontClass& font);
 
     void UpdateDebugText(
         ID3D11DeviceContext* pContext,
@@ -103,12 +109,14 @@ private:
         const Core::SystemState& sysState);
     
     void UpdateSentenceByIdx(
-        ID3D11DeviceContext* pContext,
         FontClass& font,
         const index idx,
         const char* newStr);
 
-    void UpdateDebugSentences(ID3D11DeviceContext* pContext, FontClass& font);
+    void UpdateDebugSentences(
+        FontClass& font,
+        const char (*newTexts)[maxNumCharsPerSentence],
+        const size numTexts);
 
 private:
     struct DbgSentence
@@ -116,6 +124,7 @@ private:
         char  text[maxNumCharsPerSentence]{'\0'};
         float drawAtX = 0;
         float drawAtY = 0;
+        index firstVertex = 0;       // the first vertex of its glyphs range
     };
 
 private:
@@ -131,22 +140,20 @@ private:
     cvector<DirectX::XMFLOAT2>        drawAt_;         // upper left corner of sentence
     cvector<size>                     maxStrSize_;     // maximal number of vertices per each string
     cvector<bool>                     isDynamic_;      // is this str modifiable?
-
-    cvector<Core::VertexBuffer<Core::VertexFont>> vertexBuffers_;
-    cvector<Core::IndexBuffer<UINT>>              indexBuffers_;
+    cvector<index>                    firstVertex_;    // the first vertex of each sentence's glyphs range
 
 
     size                numDbgConstSentences_ = 0;
     size                numDbgDynamicSentences_ = 0;
     DbgSentence         dbgConstSentences_[maxNumDbgSentences];
     DbgSentence         dbgDynamicSentences_[maxNumDbgSentences];
-    Core::VertexFont    dbgTextRawVertices_[maxNumVerticesInDbgText];
 
-    Core::VertexBuffer<Core::VertexFont> vbDbgConstText_;
-    Core::VertexBuffer<Core::VertexFont> vbDbgDynamicText_;
-    Core::IndexBuffer<UINT>              ibDbgText_;  // we use the same index buffer for const and dynamic debug sentences since vertex order is the same for both
-    u32 indexCountDbgConstText_ = 0;
-    u32 indexCountDbgDynamicText_ = 0;
+    // glyphs (4 vertices per symbol) of all the sentences: is a CPU copy of the VB;
+    // unused glyphs of a range are degenerate (zeroed) quads
+    cvector<Core::VertexFont>            glyphVertices_;
+    Core::VertexBuffer<Core::VertexFont> vbText_;
+    Core::IndexBuffer<UINT>              ibText_;     // the vertex order of each glyph is the same so the IB is common
+    bool                                 isTextChanged_ = false;
 
 };
 
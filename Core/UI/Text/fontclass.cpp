@@ -144,7 +144,7 @@ void* FontClass::operator new(size_t i)
 	// memory allocation
 	// any FontClass object is aligned on 16 in the memory
 
-	if (void* ptr = _aligned_malloc(i, 16))
+	if (void* ptr = MemTracker::Allocate(i, 16, MEM_TAG_UI))
 	{
 		return ptr;
 	}
@@ -155,7 +155,7 @@ void* FontClass::operator new(size_t i)
 
 void FontClass::operator delete(void* p)
 {
-	_aligned_free(p);
+	MemTracker::Free(p);
 }
 
 
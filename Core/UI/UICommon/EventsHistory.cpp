@@ -4,14 +4,44 @@
 // Created:       08.02.25  by DimaSkup
 // =================================================================================
 #include "EventsHistory.h"
+#include <chrono>
+#include <string.h>
 
 
 namespace UI
 {
 
-void EventsHistory::Push(const ICommand cmd, const std::string& msg, const uint32_t entityID)
+// FNV-1a params
+static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static constexpr uint64_t FNV_PRIME        = 1099511628211ULL;
+
+//---------------------------------------------------------
+// Desc:  get the current time in milliseconds
+//---------------------------------------------------------
+static uint64_t GetTimeMs()
+{
+	using namespace std::chrono;
+	return (uint64_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+///////////////////////////////////////////////////////////
+
+void EventsHistory::Push(const ICommand& cmd, const char* msg, const uint32_t entityID)
 {
-	tempHistory_.push_back(HistoryItem(cmd, msg, entityID));
+	// only the first change of the property is kept: it is the value before the edit
+
+	for (const HistoryCmd& pending : tempHistory_)
+	{
+		if ((pending.cmd_.type_ == cmd.type_) && (pending.entityID_ == entityID))
+			return;
+	}
+
+	HistoryCmd record;
+	record.cmd_      = cmd;
+	record.entityID_ = entityID;
+	record.msgIdx_   = InternMsg(msg);
+
+	tempHistory_.push_back(record);
 }
 
 ///////////////////////////////////////////////////////////
@@ -20,41 +50,210 @@ void EventsHistory::FlushTempHistory()
 {
 	// create an actual history item after we release mouse or keyboard
 
-    if (tempHistory_.empty())
-        return;
+	if (tempHistory_.empty() || (batchDepth_ > 0))
+		return;
+
+	const uint64_t timeMs = GetTimeMs();
+
+	// the same property as the last entry: the undo value of that entry is kept
+	if (IsCoalesced(timeMs))
+	{
+		tempHistory_.clear();
+		lastFlushTimeMs_ = timeMs;
+		return;
+	}
+
+	// a batch can't be bigger than the whole history
+	if (tempHistory_.size() > MAX_NUM_CMDS)
+		tempHistory_.resize(MAX_NUM_CMDS);
+
+	for (index i = 0; i < tempHistory_.size(); ++i)
+	{
+		tempHistory_[i].isFirst_ = (i == 0);
+		PushToRing(tempHistory_[i]);
+	}
+
+	++numEntries_;
+	lastFlushTimeMs_ = timeMs;
+	tempHistory_.clear();
+}
+
+///////////////////////////////////////////////////////////
+
+void EventsHistory::BeginBatch()
+{
+	// changes which were made before the batch are a separate entry
+	if (batchDepth_ == 0)
+		FlushTempHistory();
+
+	++batchDepth_;
+}
+
+///////////////////////////////////////////////////////////
+
+void EventsHistory::EndBatch()
+{
+	if (batchDepth_ == 0)
+		return;
+
+	if (--batchDepth_ == 0)
+	{
+		// a batch is never coalesced with the prev entry
+		lastFlushTimeMs_ = 0;
+		FlushTempHistory();
+	}
+}
+
+///////////////////////////////////////////////////////////
+
+void EventsHistory::PushGroup(
+	const ICommand* cmds,
+	const uint32_t* entityIDs,
+	const int numCmds,
+	const char* msg)
+{
+	if (!cmds || !entityIDs || (numCmds <= 0))
+		return;
 
-	HistoryItem forward;   // alternative undo
-	HistoryItem undo;      // classis undo (ctrl+z)
+	// changes which were made before the group edit are a separate entry
+	FlushTempHistory();
 
-	if (cmdHistoryIdx_ > 64)
+	// a batch can't be bigger than the whole history
+	const int      num    = (numCmds < MAX_NUM_CMDS) ? numCmds : MAX_NUM_CMDS;
+	const uint16_t msgIdx = InternMsg(msg);
+
+	for (int i = 0; i < num; ++i)
 	{
-		--cmdHistoryIdx_;
-		history_.pop_front();	
+		HistoryCmd record;
+		record.cmd_      = cmds[i];
+		record.entityID_ = entityIDs[i];
+		record.msgIdx_   = msgIdx;
+		record.isFirst_  = (i == 0);
+
+		PushToRing(record);
 	}
 
-	undo = tempHistory_.front();         // starting value
-	forward = tempHistory_.back();       // final change
+	++numEntries_;
 
-	history_.push_back(undo);
-	tempHistory_.clear();         
-	++cmdHistoryIdx_;
+	// a group edit is never coalesced with the next one
+	lastFlushTimeMs_ = 0;
 }
 
 ///////////////////////////////////////////////////////////
 
-HistoryItem EventsHistory::Undo()
+bool EventsHistory::Undo(cvector<HistoryCmd>& outCmds)
+{
+	outCmds.clear();
+
+	if (numEntries_ == 0)
+		return false;
+
+	// records of the last entry in reverse order
+	while (numCmds_ > 0)
+	{
+		const HistoryCmd& cmd = At(numCmds_ - 1);
+		outCmds.push_back(cmd);
+		--numCmds_;
+
+		if (cmd.isFirst_)
+			break;
+	}
+
+	--numEntries_;
+
+	// the next edit isn't coalesced with the entry which is before the undone one
+	lastFlushTimeMs_ = 0;
+	return true;
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+uint16_t EventsHistory::InternMsg(const char* msg)
 {
-	if (!history_.empty())
+	// messages are the same for all the edits of a property so each of them
+	// is stored once and records keep only its idx
+
+	if (!msg)
+		msg = "";
+
+	uint64_t hash = FNV_OFFSET_BASIS;
+
+	for (const char* ch = msg; *ch; ++ch)
+	{
+		hash ^= (uint8_t)*ch;
+		hash *= FNV_PRIME;
+	}
+
+	const auto range = msgsIdxs_.equal_range(hash);
+
+	for (auto it = range.first; it != range.second; ++it)
 	{
-		//HistoryItem item = history_[cmdHistoryIdx_ - 1];
-		HistoryItem item = history_.back();
-		history_.pop_back();
-		--cmdHistoryIdx_;
+		if (strcmp(msgs_[it->second].c_str(), msg) == 0)
+			return it->second;
+	}
+
+	// too many different messages: the first one is used
+	if (msgs_.size() >= MAX_NUM_MSGS)
+		return 0;
+
+	const uint16_t idx = (uint16_t)msgs_.size();
+	msgs_.push_back(msg);
+	msgsIdxs_.emplace(hash, idx);
+
+	return idx;
+}
 
-		return item;
+///////////////////////////////////////////////////////////
+
+void EventsHistory::PushToRing(const HistoryCmd& cmd)
+{
+	// the ring is full: the oldest entries are dropped
+
+	if (numCmds_ >= MAX_NUM_CMDS)
+		DropOldestEntry();
+
+	ring_[(head_ + numCmds_) % MAX_NUM_CMDS] = cmd;
+	++numCmds_;
+}
+
+///////////////////////////////////////////////////////////
+
+void EventsHistory::DropOldestEntry()
+{
+	if (numCmds_ == 0)
+		return;
+
+	do
+	{
+		head_ = (head_ + 1) % MAX_NUM_CMDS;
+		--numCmds_;
 	}
-	
-	return HistoryItem(ICommand(), "", 0);
+	while ((numCmds_ > 0) && !At(0).isFirst_);
+
+	--numEntries_;
+}
+
+///////////////////////////////////////////////////////////
+
+bool EventsHistory::IsCoalesced(const uint64_t timeMs) const
+{
+	// a single change of the same property of the same entity as the last entry
+	// (which is a single change too) soon after it
+
+	if ((numEntries_ == 0) || (tempHistory_.size() != 1) || (lastFlushTimeMs_ == 0))
+		return false;
+
+	if (timeMs - lastFlushTimeMs_ > COALESCE_TIME_MS)
+		return false;
+
+	const HistoryCmd& last = At(numCmds_ - 1);
+	const HistoryCmd& curr = tempHistory_[0];
+
+	return last.isFirst_ &&
+	       (last.cmd_.type_ == curr.cmd_.type_) &&
+	       (last.entityID_  == curr.entityID_);
 }
 
 } // namespace UI
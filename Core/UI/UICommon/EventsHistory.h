@@ -2,68 +2,114 @@
 // Filename:      EventsHistory.h
 // Description:   a container for editor events;
 //                represents a history of events, stores commands which
-//                were executed, and also stores a reverse commands for UNDO
+//                were executed, and also stores a reverse commands for UNDO;
+//
+//                - the history is a ring of compact POD records (an undo command,
+//                  an entity ID and an idx of an interned message) so its memory
+//                  is bounded: the oldest entries are dropped when the ring is full;
+//                - an entry of the history can consist of several records (a batch:
+//                  e.g. one edit of several entities) which are undone together;
+//                - consecutive edits of the same property of the same entity
+//                  (a mouse drag or a few edits one after another) are one entry
 // 
 // Created:       08.02.25  by DimaSkup
 // =================================================================================
 #pragma once
 
 #include "ICommand.h"
+#include <cvector.h>
+#include <stdint.h>
 #include <string>
-#include <deque>
+#include <unordered_map>
 
 
 namespace UI
 {
 
-struct HistoryCmdPair
+struct HistoryCmd
 {
-	// a pair of commands: undo (ctrl+Z)
-	// and alternative undo (alt+Z) to move forward in history
+	ICommand cmd_;                             // an undo command
+	uint32_t entityID_ = 0;
+	uint16_t msgIdx_   = 0;                    // idx of the interned message
+	uint16_t isFirst_  = 0;                    // the first record of an entry (the rest records of its batch follow it)
 };
 
 ///////////////////////////////////////////////////////////
 
-struct HistoryItem
+class EventsHistory
 {
-	HistoryItem() {};
-
-	HistoryItem(
-		const ICommand cmd, 
-		const std::string& msg, 
-		const uint32_t entityID) 
-		:
-		cmd_(cmd),
-		msg_(msg),
-		entityID_(entityID) {}
-
-	ICommand cmd_;
-	std::string msg_;
-	uint32_t entityID_;
-};
+public:
+	static constexpr int MAX_NUM_CMDS     = 8192;   // capacity of the ring (records of all the entries; a group edit has a record per entity)
+	static constexpr int MAX_NUM_MSGS     = 512;    // interned messages (the rest ones are shown as the first one)
+	static constexpr int COALESCE_TIME_MS = 1000;   // consecutive edits of the same property within this time are one entry
 
-///////////////////////////////////////////////////////////
-
-struct EventsHistory
-{
-	// int historyLimit = 64;
-	int cmdHistoryIdx_ = 0;     // idx of out current position in history
-	std::deque<HistoryItem> history_;
+	EventsHistory() {}
 
+	// restrict a copying of this class instance
+	EventsHistory(const EventsHistory&) = delete;
+	EventsHistory& operator=(const EventsHistory&) = delete;
 
 	// temporal history: when we hold down a mouse button we don't want to save
-	//                   any micro-changes so we store these changes into the temp
-	//                   history and then sum up all these changes to create
-	//                   a true history event
-	std::deque<HistoryItem> tempHistory_;
+	//                   any micro-changes so we store only the first change of each
+	//                   property (its undo value) and flush them all as one entry
+	void Push(const ICommand& cmd, const char* msg, const uint32_t entityID);
+	void FlushTempHistory();
 
+	// all the changes between these calls are one entry (even if the temp history is flushed)
+	void BeginBatch();
+	void EndBatch();
 
-	void Push(const ICommand cmd, const std::string& msg, const uint32_t entityID);
-	void FlushTempHistory();
-	HistoryItem Undo();
+	// push an edit of a group of entities as a single entry at once (an undo command
+	// per entity) without scanning the temp history for each of them
+	void PushGroup(const ICommand* cmds, const uint32_t* entityIDs, const int numCmds, const char* msg);
+
+	// pop the last entry; output: its records (the last pushed record is the first one)
+	bool Undo(cvector<HistoryCmd>& outCmds);
+
+	// visit entries from the oldest one: func(const HistoryCmd& firstCmd, const int numCmds)
+	template <typename Func>
+	void ForEachEntry(Func&& func) const
+	{
+		int i = 0;
+
+		while (i < numCmds_)
+		{
+			int next = i + 1;
 
-	inline bool HasHistory()     const { return !history_.empty(); }
+			while ((next < numCmds_) && !At(next).isFirst_)
+				++next;
+
+			func(At(i), next - i);
+			i = next;
+		}
+	}
+
+	inline const char* GetMsg(const HistoryCmd& cmd) const { return (cmd.msgIdx_ < msgs_.size()) ? msgs_[cmd.msgIdx_].c_str() : ""; }
+
+	inline bool HasHistory()     const { return numEntries_ > 0; }
 	inline bool HasTempHistory() const { return !tempHistory_.empty(); }
+	inline int  GetNumEntries()  const { return numEntries_; }
+
+private:
+	uint16_t InternMsg(const char* msg);
+	void     PushToRing(const HistoryCmd& cmd);
+	void     DropOldestEntry();
+	bool     IsCoalesced(const uint64_t timeMs) const;
+
+	inline const HistoryCmd& At(const int i) const { return ring_[(head_ + i) % MAX_NUM_CMDS]; }
+
+private:
+	HistoryCmd          ring_[MAX_NUM_CMDS];
+	int                 head_       = 0;       // idx of the oldest record in the ring
+	int                 numCmds_    = 0;
+	int                 numEntries_ = 0;
+
+	cvector<HistoryCmd> tempHistory_;         // the first change of each property since the last flush
+	int                 batchDepth_ = 0;
+	uint64_t            lastFlushTimeMs_ = 0;  // 0: the last entry can't be coalesced (e.g. it was undone)
+
+	cvector<std::string>                       msgs_;
+	std::unordered_multimap<uint64_t, uint16_t> msgsIdxs_;   // hash of message => idx of message
 };
 
 
@@ -9,6 +9,9 @@
 #include "../../Mesh/MaterialMgr.h"
 #include "../../Model/ModelMgr.h"
 #include "../../Texture/TextureMgr.h"   // texture mgr is used to get textures by its IDs
+#include "../../Engine/ProjectSaver.h"
+#include "../../Engine/ContentAuditor.h"
+#include "../../Engine/Settings.h"
 
 #pragma warning (disable : 4996)
 
@@ -43,6 +46,59 @@ ModelID FacadeEngineToUI::GetModelIdByName(const std::string& name)
     return g_ModelMgr.GetModelIdByName(name.c_str());
 }
 
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::SaveScene()
+{
+    // all the components are written as blocks so the next startup
+    // bulk-loads them instead of building the scene by code;
+    // only a snapshot is taken here: changed chunks are written by a job
+    return g_ProjectSaver.SaveSceneAsync(*pEntityMgr_, g_RelPathSceneDir);
+}
+
+///////////////////////////////////////////////////////////
+
+int FacadeEngineToUI::MergeStaticProps()
+{
+    return pGraphics_->MergeStaticProps(pEntityMgr_);
+}
+
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::UnmergeStaticProps()
+{
+    pGraphics_->UnmergeStaticProps(pEntityMgr_);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::BakeStaticLights()
+{
+    return pGraphics_->BakeStaticLights(pEntityMgr_, pRender_);
+}
+
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::RunContentAudit(Core::ContentAuditor& auditor)
+{
+    // budgets are read from the file each time so they can be tuned without a restart
+    try
+    {
+        const Settings settings;
+        AuditBudgets   budgets;
+
+        budgets.LoadFromSettings(settings);
+        auditor.Run(*pEntityMgr_, budgets);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        return false;
+    }
+}
+
 
 // =================================================================================
 // Get camera info
@@ -182,6 +238,22 @@ bool FacadeEngineToUI::AddBoundingComponent(const EntityID id, const int boundTy
 
 ///////////////////////////////////////////////////////////
 
+bool FacadeEngineToUI::AddPortalCellComponent(const EntityID id, const Vec3& extents)
+{
+    pEntityMgr_->AddPortalCellComponent(id, extents.ToFloat3());
+    return pEntityMgr_->portalSystem_.HasEntity(id);
+}
+
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::AddPortalComponent(const EntityID id, const float halfWidth, const float halfHeight)
+{
+    pEntityMgr_->AddPortalComponent(id, halfWidth, halfHeight);
+    return pEntityMgr_->portalSystem_.HasEntity(id);
+}
+
+///////////////////////////////////////////////////////////
+
 bool FacadeEngineToUI::GetAllEnttsIDs(
     const EntityID*& outPtrToEnttsIDsArr,
     int& outNumEntts) const
@@ -209,6 +281,65 @@ bool FacadeEngineToUI::GetEnttNameByID(const EntityID enttID, std::string& name)
 
 ///////////////////////////////////////////////////////////
 
+uint32_t FacadeEngineToUI::GetEnttsStructureVersion() const
+{
+    return pEntityMgr_->GetStructureVersion();
+}
+
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::GetEnttsNames(
+    const EntityID* ids,
+    const int numEntts,
+    const char** outNames) const
+{
+    if (!ids || !outNames || (numEntts <= 0))
+        return false;
+
+    pEntityMgr_->nameSystem_.GetNamesByIds(ids, (size)numEntts, outNames);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::GetEnttsTransformData(
+    const EntityID* ids,
+    const int numEntts,
+    Vec3* outPos,
+    Vec3* outDirs,
+    float* outScales) const
+{
+    // gather transform data of all the input entts by a single lookup per entt
+
+    if (!ids || !outPos || !outDirs || !outScales || (numEntts <= 0))
+        return false;
+
+    ECS::TransformSoA soa;
+    pEntityMgr_->transformSystem_.GetTransformsSoA(ids, (size)numEntts, soa);
+
+    for (int i = 0; i < numEntts; ++i)
+    {
+        outPos[i]    = Vec3(soa.posX[i], soa.posY[i], soa.posZ[i]);
+        outDirs[i]   = Vec3(soa.quatX[i], soa.quatY[i], soa.quatZ[i]);
+        outScales[i] = soa.scale[i];
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::GetTransformChangedEntts(const EntityID*& outIds, int& outNumEntts) const
+{
+    const cvector<EntityID>& changed = pEntityMgr_->transformSystem_.GetChangedEntts();
+
+    outIds      = changed.data();
+    outNumEntts = (int)changed.size();
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
 bool FacadeEngineToUI::GetEnttsOfModelType(const EntityID*& enttsIDs, int& numEntts)
 {
     pEntityMgr_->modelSystem_.GetAllEntts(enttsIDs, (size&)numEntts);
@@ -295,6 +426,58 @@ bool FacadeEngineToUI::RotateEnttByQuat(const EntityID id, const Vec4& rotQuat)
 
 ///////////////////////////////////////////////////////////
 
+bool FacadeEngineToUI::AdjustEnttsPositions(const EntityID* ids, const int numEntts, const Vec3& adjustBy)
+{
+    if (numEntts <= 0)
+        return false;
+
+    return pEntityMgr_->transformSystem_.AdjustPositions(ids, (size)numEntts, adjustBy.ToXMVector());
+}
+
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::RotateEnttsByQuat(const EntityID* ids, const int numEntts, const Vec4& rotQuat)
+{
+    if (numEntts <= 0)
+        return false;
+
+    return pEntityMgr_->transformSystem_.RotateLocalSpacesByQuat(ids, (size)numEntts, rotQuat.ToXMVector());
+}
+
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::GetEnttsWithSameModel(const EntityID id, cvector<EntityID>& outIds) const
+{
+    // get all the entts which are related to the same model as the input one
+
+    ECS::ModelSystem& modelSys = pEntityMgr_->modelSystem_;
+    const ModelID modelID      = modelSys.GetModelIdRelatedToEntt(id);
+
+    if (modelID == INVALID_MODEL_ID)
+    {
+        outIds.clear();
+        return false;
+    }
+
+    modelSys.GetEnttsByModel(modelID, outIds);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::GetEnttsInScreenRect(
+    const int x0,
+    const int y0,
+    const int x1,
+    const int y1,
+    cvector<EntityID>& outIds) const
+{
+    pGraphics_->TestEnttsSelectionInRect(x0, y0, x1, y1, pEntityMgr_, outIds);
+    return !outIds.empty();
+}
+
+///////////////////////////////////////////////////////////
+
 bool FacadeEngineToUI::GetEnttLightType(const EntityID id, int& lightType) const
 {
     // output:  a code of light type which is added to entity by ID
@@ -898,28 +1081,44 @@ bool FacadeEngineToUI::SetEnttMaterial(
     // set a material (matID) for subset/mesh (subsetID) of entity (enttID)
 
     pEntityMgr_->materialSystem_.SetMaterial(enttID, subsetID, matID);
+
+    // instances of the prev frame have old materials
+    pGraphics_->InvalidateVisibilityCache();
     return true;
 }
 
 ///////////////////////////////////////////////////////////
 
-bool FacadeEngineToUI::RenderMaterialsIcons(
-    const int startMaterialIdx,               // render materials of some particular range [start, start + num_of_views]
-    const size numIcons,
-    const int iconWidth,
-    const int iconHeight)
+bool FacadeEngineToUI::GetTextureThumbnail(
+    const index texIdx,
+    SRV*& outSRV,
+    float* uv0,
+    float* uv1)
 {
-    materialIcons_.resize(numIcons);
+    const TexID id = g_TextureMgr.GetTexIdByIdx(texIdx);
 
-    pGraphics_->RenderMaterialsIcons(
-        pEntityMgr_,
-        pRender_,
-        materialIcons_.data(),
-        numIcons,
-        iconWidth,
-        iconHeight);
+    if (id == INVALID_TEXTURE_ID)
+        return false;
 
-    return true;
+    return pGraphics_->GetThumbnails().GetTextureThumbnail(id, outSRV, uv0, uv1);
+}
+
+///////////////////////////////////////////////////////////
+
+bool FacadeEngineToUI::GetMaterialIcon(
+    const MaterialID matID,
+    SRV*& outSRV,
+    float* uv0,
+    float* uv1)
+{
+    return pGraphics_->GetThumbnails().GetMaterialIcon(matID, outSRV, uv0, uv1);
+}
+
+///////////////////////////////////////////////////////////
+
+void FacadeEngineToUI::InvalidateMaterialIcons()
+{
+    pGraphics_->GetThumbnails().InvalidateMaterialIcons();
 }
 
 ///////////////////////////////////////////////////////////
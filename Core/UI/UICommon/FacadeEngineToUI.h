@@ -36,6 +36,11 @@ public:
 
 
     virtual ModelID GetModelIdByName(const std::string& name) override;
+    virtual bool    SaveScene() override;
+    virtual int     MergeStaticProps() override;
+    virtual bool    UnmergeStaticProps() override;
+    virtual bool    BakeStaticLights() override;
+    virtual bool    RunContentAudit(Core::ContentAuditor& auditor) override;
 
     //
     // get camera info
@@ -57,11 +62,18 @@ public:
     virtual bool AddModelComponent    (const EntityID enttID, const uint32_t modelID)                                       override;
     virtual bool AddRenderedComponent (const EntityID enttID)                                                               override;
     virtual bool AddBoundingComponent (const EntityID id, const int boundType, const DirectX::BoundingBox& aabb)            override;
+    virtual bool AddPortalCellComponent(const EntityID id, const Vec3& extents)                                             override;
+    virtual bool AddPortalComponent   (const EntityID id, const float halfWidth, const float halfHeight)                    override;
 
     virtual bool     GetAllEnttsIDs   (const EntityID*& outPtrToEnttsIDsArr, int& outNumEntts)                        const override;
     virtual EntityID GetEnttIDByName  (const std::string& name)                                                       const override;
     virtual bool     GetEnttNameByID  (const EntityID id, std::string& outName)                                       const override;
 
+    virtual uint32_t GetEnttsStructureVersion()                                                                        const override;
+    virtual bool     GetEnttsNames        (const EntityID* ids, const int numEntts, const char** outNames)              const override;
+    virtual bool     GetEnttsTransformData(const EntityID* ids, const int numEntts, Vec3* outPos, Vec3* outDirs, float* outScales) const override;
+    virtual bool     GetTransformChangedEntts(const EntityID*& outIds, int& outNumEntts)                              const override;
+
     // extract entities with particular component
     virtual bool GetEnttsOfModelType  (const EntityID*& enttsIDs, int& numEntts)                                            override;
     virtual bool GetEnttsOfCameraType (const EntityID*& enttsIDs, int& numEntts)                                            override;
@@ -80,6 +92,12 @@ public:
 
     virtual bool RotateEnttByQuat(const EntityID id, const Vec4& rotQuat) override;
 
+    virtual bool AdjustEnttsPositions(const EntityID* ids, const int numEntts, const Vec3& adjustBy) override;
+    virtual bool RotateEnttsByQuat   (const EntityID* ids, const int numEntts, const Vec4& rotQuat)  override;
+
+    virtual bool GetEnttsWithSameModel(const EntityID id, cvector<EntityID>& outIds)                 const override;
+    virtual bool GetEnttsInScreenRect (const int x0, const int y0, const int x1, const int y1, cvector<EntityID>& outIds) const override;
+
     virtual bool GetEnttLightType(const EntityID id, int& lightType)                                                 const override;
 
     // =============================================================================
@@ -221,11 +239,9 @@ public:
         const SubsetID subsetID,
         const MaterialID matID) override;
 
-    virtual bool RenderMaterialsIcons(
-        const int startMaterialIdx,        // render materials of some particular range [start, start + num_of_views]
-        const size numIcons,
-        const int iconWidth,
-        const int iconHeight) override;
+    virtual bool GetTextureThumbnail(const index texIdx,     SRV*& outSRV, float* uv0, float* uv1) override;
+    virtual bool GetMaterialIcon    (const MaterialID matID, SRV*& outSRV, float* uv0, float* uv1) override;
+    virtual void InvalidateMaterialIcons() override;
 
     virtual bool RenderMaterialBigIconByID(
         const MaterialID matID,
@@ -21,6 +21,11 @@
 #include <DirectXCollision.h>
 
 
+namespace Core
+{
+class ContentAuditor;
+}
+
 namespace UI
 {
 //
@@ -82,13 +87,26 @@ class IFacadeEngineToUI
 {
 public:
     ID3D11ShaderResourceView*          pMaterialBigIcon_ = nullptr; // big material icon for browsing/editing particular chosen material
-    cvector<ID3D11ShaderResourceView*> materialIcons_;              // list of icons in the editor material browser
     float                              deltaTime = 0.0f;
 
     virtual ~IFacadeEngineToUI() {};
 
     virtual ModelID GetModelIdByName(const std::string& name) { return 0; }
 
+    // write all the entities into the scene file (it is loaded on the next startup)
+    virtual bool SaveScene() { return false; }
+
+    // merge small static props into meshes per grid cell (return the number of
+    // created cells) or render each of them by itself again
+    virtual int  MergeStaticProps()   { return 0; }
+    virtual bool UnmergeStaticProps() { return false; }
+
+    // bake static point/spot lights into the light volume anew (see Core::LightBaker)
+    virtual bool BakeStaticLights()   { return false; }
+
+    // audit models/textures/materials and the scene against budgets of settings
+    virtual bool RunContentAudit(Core::ContentAuditor& auditor) { return false; }
+
 
     // =============================================================================
     // get/set camera properties
@@ -110,12 +128,23 @@ public:
     virtual bool AddModelComponent    (const EntityID enttID, const uint32_t modelID)                                       { return false; }
     virtual bool AddRenderedComponent (const EntityID enttID)                                                               { return false; }
     virtual bool AddBoundingComponent (const EntityID id, const int boundType, const DirectX::BoundingBox& aabb)            { return false; }
+    virtual bool AddPortalCellComponent(const EntityID id, const Vec3& extents)                                             { return false; }
+    virtual bool AddPortalComponent   (const EntityID id, const float halfWidth, const float halfHeight)                    { return false; }
 
 
     virtual bool     GetAllEnttsIDs   (const EntityID*& outPtrToEnttsIDsArr, int& outNumEntts)        const { return false; }
     virtual EntityID GetEnttIDByName  (const std::string& name)                                       const { return 0; }
     virtual bool     GetEnttNameByID  (const EntityID id, std::string& outName)                       const { return false; }
 
+    // batched queries for editor panels which show lots of entts:
+    // NOTE: names ptrs are valid until the entts structure version is changed
+    virtual uint32_t GetEnttsStructureVersion()                                                         const { return 0; }
+    virtual bool     GetEnttsNames        (const EntityID* ids, const int numEntts, const char** outNames) const { return false; }
+    virtual bool     GetEnttsTransformData(const EntityID* ids, const int numEntts, Vec3* outPos, Vec3* outDirs, float* outScales) const { return false; }
+
+    // get SORTED IDs of entts which were transformed during the last frame
+    virtual bool     GetTransformChangedEntts(const EntityID*& outIds, int& outNumEntts)             const { return false; }
+
     // extract entities with particular component
     virtual bool GetEnttsOfModelType  (const EntityID*& enttsIDs, int& numEntts)                             { return false; }
     virtual bool GetEnttsOfCameraType (const EntityID*& enttsIDs, int& numEntts)                             { return false; }
@@ -135,6 +164,14 @@ public:
 
     virtual bool RotateEnttByQuat(const EntityID id, const Vec4& rotQuat) { return false; }
 
+    // transform a group of entts by a single batched call (multi-selection)
+    virtual bool AdjustEnttsPositions(const EntityID* ids, const int numEntts, const Vec3& adjustBy) { return false; }
+    virtual bool RotateEnttsByQuat   (const EntityID* ids, const int numEntts, const Vec4& rotQuat)  { return false; }
+
+    // selection of groups: output is SORTED
+    virtual bool GetEnttsWithSameModel(const EntityID id, cvector<EntityID>& outIds)                 const { return false; }
+    virtual bool GetEnttsInScreenRect (const int x0, const int y0, const int x1, const int y1, cvector<EntityID>& outIds) const { return false; }
+
     virtual bool GetEnttLightType(const EntityID id, int& lightType)                                 const { return false; }
 
 
@@ -284,11 +321,11 @@ public:
         const SubsetID subsetID,
         const MaterialID matID) { return false; }
 
-    virtual bool RenderMaterialsIcons(
-        const int startMaterialIdx,            // render materials of some particular range [start, start + num_of_views]
-        const size numIcons,
-        const int iconWidth,
-        const int iconHeight) { return false; }
+    // thumbnails for browsers (output: SRV of the shared atlas and UV of the thumbnail's slot);
+    // a thumbnail is made on demand so false is returned until it is ready (draw a placeholder)
+    virtual bool GetTextureThumbnail(const index texIdx,     SRV*& outSRV, float* uv0, float* uv1) { return false; }
+    virtual bool GetMaterialIcon    (const MaterialID matID, SRV*& outSRV, float* uv0, float* uv1) { return false; }
+    virtual void InvalidateMaterialIcons() {}                                  // materials are changed: their icons are checked again
 
     virtual bool RenderMaterialBigIconByID(
         const MaterialID matID,
@@ -19,6 +19,13 @@ struct StatesGUI
     bool showWndEnttCreation  = false;
     bool showWndEnttsList = true;
     bool showWndEnttProperties = true;
+    bool showWndContentAudit   = false;
+
+    // requests from the main menu (are handled right after the menu is rendered)
+    bool saveScene = false;
+    bool mergeStaticProps   = false;
+    bool unmergeStaticProps = false;
+    bool bakeStaticLights   = false;
 
 
     // browsers stuff
@@ -49,6 +49,7 @@ void UserInterface::Initialize(
     const std::string& videoCardName)
 {
     // initialize the graphics user interface (GUI)
+    MEM_TAG_SCOPE(MEM_TAG_UI);
 
     LogDbg("initialization of the User Interface");
 
@@ -95,6 +96,8 @@ void UserInterface::Update(
     const Core::SystemState& systemState)
 {
     // each frame we call this function for updating the UI
+    MEM_TAG_SCOPE(MEM_TAG_UI);
+
     try
     {
         pFacadeEngineToUI_->deltaTime = systemState.deltaTime;
@@ -120,13 +123,18 @@ void UserInterface::UndoEditorLastEvent()
     //               can undo this event and place the model at the beginning position
 
 
-    if (g_EventsHistory.HasHistory())
+    // all the commands of the entry (a batch) are undone in reverse order
+    cvector<HistoryCmd> cmds;
+
+    if (g_EventsHistory.Undo(cmds))
     {
-        HistoryItem historyItem = g_EventsHistory.Undo();
+        EnttEditorController& controller = editorPanels_.enttEditorController_;
 
-        editorPanels_.enttEditorController_.Undo(
-            &historyItem.cmd_,
-            historyItem.entityID_);
+        for (const HistoryCmd& cmd : cmds)
+            controller.Undo(&cmd.cmd_, cmd.entityID_);
+
+        // entts of the selected group could be moved back
+        controller.UpdateGroupPivot();
     }
 }
 
@@ -277,6 +285,8 @@ void UserInterface::RenderGameUI(
     Core::SystemState& systemState)
 {
     // print onto the screen some debug info
+    MEM_TAG_SCOPE(MEM_TAG_UI);
+
     if (systemState.isShowDbgInfo)
         RenderDebugInfo(pContext, fontShader, systemState);
 }
@@ -286,6 +296,7 @@ void UserInterface::RenderGameUI(
 void UserInterface::RenderEditor(Core::SystemState& systemState)
 {
     // Render the editor's panels and related stuff
+    MEM_TAG_SCOPE(MEM_TAG_UI);
 
     // "Run scene" docked window
     if (ImGui::Begin("Run scene"))
@@ -312,6 +323,36 @@ void UserInterface::RenderEditor(Core::SystemState& systemState)
 
     editorMainMenuBar_.RenderBar(guiStates_);
 
+    if (guiStates_.saveScene)
+    {
+        guiStates_.saveScene = false;
+
+        if (!pFacadeEngineToUI_->SaveScene())
+            LogErr("can't save the scene");
+    }
+
+    if (guiStates_.mergeStaticProps)
+    {
+        guiStates_.mergeStaticProps = false;
+        pFacadeEngineToUI_->MergeStaticProps();
+    }
+
+    if (guiStates_.unmergeStaticProps)
+    {
+        guiStates_.unmergeStaticProps = false;
+
+        if (!pFacadeEngineToUI_->UnmergeStaticProps())
+            LogErr("can't unmerge static props");
+    }
+
+    if (guiStates_.bakeStaticLights)
+    {
+        guiStates_.bakeStaticLights = false;
+
+        if (!pFacadeEngineToUI_->BakeStaticLights())
+            LogErr("can't bake static lights");
+    }
+
     // show window to control engine options
     if (guiStates_.showWndEngineOptions)
         editorMainMenuBar_.RenderWndEngineOptions(&guiStates_.showWndEngineOptions);
@@ -337,6 +378,9 @@ void UserInterface::RenderSceneWnd(Core::SystemState& sysState)
         //
         EnttEditorController& controller = editorPanels_.enttEditorController_;
         uint32_t selectedEntt = GetSelectedEntt();
+
+        // box selection: drag with the left mouse button while the ALT is held
+        RenderBoxSelection(controller);
         
         // if any entt is selected and any gizmo operation is chosen
         if (selectedEntt && (guiStates_.gizmoOperation != -1))    
@@ -361,7 +405,10 @@ void UserInterface::RenderSceneWnd(Core::SystemState& sysState)
 
             // handle directed and spot lights in a separate way for correct change
             // of its direction using gizmo
-            const Vec3 pos = pFacadeEngineToUI_->GetEnttPosition(selectedEntt);
+            // (a group is transformed around its center)
+            const Vec3 pos = (controller.IsSelectedGroup()) ?
+                controller.GetGroupPivot() :
+                pFacadeEngineToUI_->GetEnttPosition(selectedEntt);
 
             world       = DirectX::XMMatrixIdentity();
             world.r[3]  = {pos.x, pos.y, pos.z, 1.0f};
@@ -408,7 +455,15 @@ void UserInterface::RenderSceneWnd(Core::SystemState& sysState)
             // if we do some manipulations using guizmo
             if (ImGuizmo::IsUsingAny())
             {
-                controller.UpdateSelectedEnttWorld(world);
+                if (controller.IsSelectedGroup())
+                    controller.UpdateSelectedGroupWorld(world);
+                else
+                    controller.UpdateSelectedEnttWorld(world);
+            }
+            // a drag of the group is finished
+            else if (controller.IsGroupDragging())
+            {
+                controller.EndGroupTransform();
             }
         }
     }
@@ -417,6 +472,43 @@ void UserInterface::RenderSceneWnd(Core::SystemState& sysState)
 
 ///////////////////////////////////////////////////////////
 
+void UserInterface::RenderBoxSelection(EnttEditorController& controller)
+{
+    // select all the entts (with models) which are inside of the dragged rect
+
+    const ImGuiIO& io = ImGui::GetIO();
+
+    if (!isBoxSelecting_)
+    {
+        if (isSceneWndHovered_ && io.KeyAlt && ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+        {
+            isBoxSelecting_  = true;
+            boxSelectStartX_ = io.MousePos.x;
+            boxSelectStartY_ = io.MousePos.y;
+        }
+        return;
+    }
+
+    const ImVec2 start = { boxSelectStartX_, boxSelectStartY_ };
+    const ImVec2 end   = io.MousePos;
+
+    ImDrawList* pDrawList = ImGui::GetForegroundDrawList();
+    pDrawList->AddRectFilled(start, end, IM_COL32(255, 255, 0, 32));
+    pDrawList->AddRect      (start, end, IM_COL32(255, 255, 0, 255));
+
+    if (!ImGui::IsMouseReleased(ImGuiMouseButton_Left))
+        return;
+
+    isBoxSelecting_ = false;
+
+    cvector<EntityID> ids;
+    pFacadeEngineToUI_->GetEnttsInScreenRect((int)start.x, (int)start.y, (int)end.x, (int)end.y, ids);
+
+    controller.SetSelectedEntts(ids.data(), (int)ids.size());
+}
+
+///////////////////////////////////////////////////////////
+
 void UserInterface::RenderDebugInfo(
     ID3D11DeviceContext* pContext,
     Render::FontShader& fontShader,
@@ -429,25 +521,23 @@ void UserInterface::RenderDebugInfo(
     ID3D11ShaderResourceView* const* ppFontTexSRV = font1_.GetTextureResourceViewAddress();
     
     // prepare buffers for rendering
-    ID3D11Buffer*  vertexBuffers[2]{ nullptr };
-    ID3D11Buffer*  pIB = nullptr;         // IB is common for both vertex buffers
-    u32            indexCounts[2]{ 0 };
-    constexpr size numSentences = 2;      // we have only two text buffers for the whole debug text: one for const sentences, one for dynamic sentences
-
-    textStorage_.GetRenderingData(
-        &vertexBuffers[0],                // vb: debug const text
-        &vertexBuffers[1],                // vb: debug dynamic text
-        &pIB,
-        indexCounts[0],                   // actual index count for debug const text
-        indexCounts[1]);                  // actual index count for debug dynamic text
+    ID3D11Buffer*  pVB = nullptr;
+    ID3D11Buffer*  pIB = nullptr;
+    u32            indexCount = 0;
+    constexpr size numBuffers = 1;        // the whole text is batched into a single buffer (a draw per font)
+
+    textStorage_.GetRenderingData(&pVB, &pIB, indexCount);
+
+    if (indexCount == 0)
+        return;
 
     // render
     fontShader.Render(
         pContext,
-        vertexBuffers,
+        &pVB,
         pIB,
-        indexCounts,
-        numSentences,
+        &indexCount,
+        numBuffers,
         sizeof(Core::VertexFont),
         ppFontTexSRV);
 }
@@ -76,6 +76,7 @@ public:
 		const int maxStrSize);              // max possible length for this string
 
 	inline void SetSelectedEntt(const uint32_t entityID)       { editorPanels_.enttEditorController_.SetSelectedEntt(entityID); }
+	inline void ToggleSelectedEntt(const uint32_t entityID)    { editorPanels_.enttEditorController_.ToggleSelectedEntt(entityID); }
 	inline uint32_t GetSelectedEntt()                    const { return editorPanels_.enttEditorController_.GetSelectedEnttID(); }
 
 	// gizmo stuff
@@ -99,6 +100,8 @@ private:
 
 	DirectX::XMFLOAT2 ComputePosOnScreen(const POINT& drawAt);
 
+	void RenderBoxSelection(EnttEditorController& controller);
+
 private:
 	int                windowWidth_ = 800;
 	int                windowHeight_ = 600;
@@ -116,6 +119,9 @@ private:
 
 	bool               isNeedToRecomputeGUI_ = true;     // defines if we need to recompute GUI elements positions/sizes for the next frame
 	bool               isSceneWndHovered_ = false;       // is currently scene windows is hovered by mouse
+	bool               isBoxSelecting_    = false;       // the selection rect is being dragged
+	float              boxSelectStartX_ = 0.0f;          // screen coords where the selection rect was started
+	float              boxSelectStartY_ = 0.0f;
 };
 
 } // namespace UI
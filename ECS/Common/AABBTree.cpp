@@ -0,0 +1,629 @@
+// =================================================================================
+// Filename:     AABBTree.cpp
+// Description:  implementation of the AABBTree's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "AABBTree.h"
+
+using namespace DirectX;
+
+namespace ECS
+{
+
+// fat AABB = AABB + (extents * FAT_FACTOR + FAT_MARGIN) by each side
+static constexpr float FAT_FACTOR = 0.1f;
+static constexpr float FAT_MARGIN = 0.1f;
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::Clear()
+{
+    nodes_.clear();
+    leaves_.Clear();
+
+    root_      = NULL_NODE;
+    freeList_  = NULL_NODE;
+    numLeaves_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::Update(const EntityID id, const XMFLOAT3& aabbMin, const XMFLOAT3& aabbMax)
+{
+    index leaf = leaves_.GetIdx(id);
+
+    if (leaf != SparseSet::INVALID_IDX)
+    {
+        // the entt is still inside its fat AABB so the tree isn't changed
+        if (Contains(nodes_[leaf], aabbMin, aabbMax))
+            return;
+
+        RemoveLeaf((int)leaf);
+    }
+    else
+    {
+        leaf = AllocNode();
+        nodes_[leaf].id = id;
+        leaves_.Set(id, leaf);
+        ++numLeaves_;
+    }
+
+    // enlarge the AABB so small movements won't cause reinsertion
+    const float mx = (aabbMax.x - aabbMin.x) * FAT_FACTOR + FAT_MARGIN;
+    const float my = (aabbMax.y - aabbMin.y) * FAT_FACTOR + FAT_MARGIN;
+    const float mz = (aabbMax.z - aabbMin.z) * FAT_FACTOR + FAT_MARGIN;
+
+    Node& node = nodes_[leaf];
+    node.min = { aabbMin.x - mx, aabbMin.y - my, aabbMin.z - mz };
+    node.max = { aabbMax.x + mx, aabbMax.y + my, aabbMax.z + mz };
+
+    InsertLeaf((int)leaf);
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::Remove(const EntityID* ids, const size numEntts)
+{
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index leaf = leaves_.GetIdx(ids[i]);
+
+        if (leaf == SparseSet::INVALID_IDX)
+            continue;
+
+        RemoveLeaf((int)leaf);
+        FreeNode((int)leaf);
+        leaves_.Remove(ids[i]);
+        --numLeaves_;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::QueryFrustum(
+    const XMFLOAT4* planes,
+    const int numPlanes,
+    cvector<EntityID>& outInside,
+    cvector<EntityID>& outIntersected) const
+{
+    CAssert::True(planes != nullptr, "input ptr to planes arr == nullptr");
+
+    if (root_ == NULL_NODE)
+        return;
+
+    s_Stack.clear();
+    s_Stack.push_back(root_);
+
+    while (!s_Stack.empty())
+    {
+        const int   nodeIdx = s_Stack.back();
+        const Node& node    = nodes_[nodeIdx];
+        s_Stack.pop_back();
+
+        const float cx = (node.max.x + node.min.x) * 0.5f;
+        const float cy = (node.max.y + node.min.y) * 0.5f;
+        const float cz = (node.max.z + node.min.z) * 0.5f;
+        const float ex = (node.max.x - node.min.x) * 0.5f;
+        const float ey = (node.max.y - node.min.y) * 0.5f;
+        const float ez = (node.max.z - node.min.z) * 0.5f;
+
+        bool isOutside  = false;
+        bool isInside   = true;
+
+        for (int i = 0; i < numPlanes; ++i)
+        {
+            // distance from the box center to the plane and the projected box radius
+            const XMFLOAT4& p = planes[i];
+            const float dist  = p.x*cx + p.y*cy + p.z*cz + p.w;
+            const float r     = fabsf(p.x)*ex + fabsf(p.y)*ey + fabsf(p.z)*ez;
+
+            isOutside |= (dist > r);
+            isInside  &= (dist <= -r);
+        }
+
+        // the whole subtree is culled
+        if (isOutside)
+            continue;
+
+        // the whole subtree is visible
+        if (isInside)
+        {
+            CollectLeaves(nodeIdx, outInside);
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            outIntersected.push_back(node.id);
+            continue;
+        }
+
+        s_Stack.push_back(node.child1);
+        s_Stack.push_back(node.child2);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::QueryRay(
+    const XMFLOAT3& origin,
+    const XMFLOAT3& dir,
+    const float maxDist,
+    cvector<EntityID>& outIds,
+    cvector<float>& outDists) const
+{
+    if (root_ == NULL_NODE)
+        return;
+
+    const XMFLOAT3 invDir = { 1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z };
+
+    s_Stack.clear();
+    s_Stack.push_back(root_);
+
+    while (!s_Stack.empty())
+    {
+        const Node& node = nodes_[s_Stack.back()];
+        s_Stack.pop_back();
+
+        // slab test
+        const float tx0 = (node.min.x - origin.x) * invDir.x;
+        const float tx1 = (node.max.x - origin.x) * invDir.x;
+        const float ty0 = (node.min.y - origin.y) * invDir.y;
+        const float ty1 = (node.max.y - origin.y) * invDir.y;
+        const float tz0 = (node.min.z - origin.z) * invDir.z;
+        const float tz1 = (node.max.z - origin.z) * invDir.z;
+
+        float tmin = (tx0 < tx1) ? tx0 : tx1;
+        float tmax = (tx0 < tx1) ? tx1 : tx0;
+
+        const float tyMin = (ty0 < ty1) ? ty0 : ty1;
+        const float tyMax = (ty0 < ty1) ? ty1 : ty0;
+        const float tzMin = (tz0 < tz1) ? tz0 : tz1;
+        const float tzMax = (tz0 < tz1) ? tz1 : tz0;
+
+        tmin = (tyMin > tmin) ? tyMin : tmin;
+        tmin = (tzMin > tmin) ? tzMin : tmin;
+        tmax = (tyMax < tmax) ? tyMax : tmax;
+        tmax = (tzMax < tmax) ? tzMax : tmax;
+
+        if ((tmax < tmin) || (tmax < 0.0f) || (tmin > maxDist))
+            continue;
+
+        if (node.IsLeaf())
+        {
+            outIds.push_back(node.id);
+            outDists.push_back((tmin > 0.0f) ? tmin : 0.0f);
+            continue;
+        }
+
+        s_Stack.push_back(node.child1);
+        s_Stack.push_back(node.child2);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::QueryAABB(
+    const XMFLOAT3& aabbMin,
+    const XMFLOAT3& aabbMax,
+    cvector<EntityID>& outIds) const
+{
+    if (root_ == NULL_NODE)
+        return;
+
+    s_Stack.clear();
+    s_Stack.push_back(root_);
+
+    while (!s_Stack.empty())
+    {
+        const Node& node = nodes_[s_Stack.back()];
+        s_Stack.pop_back();
+
+        const bool overlap =
+            (node.min.x <= aabbMax.x) && (aabbMin.x <= node.max.x) &&
+            (node.min.y <= aabbMax.y) && (aabbMin.y <= node.max.y) &&
+            (node.min.z <= aabbMax.z) && (aabbMin.z <= node.max.z);
+
+        if (!overlap)
+            continue;
+
+        if (node.IsLeaf())
+        {
+            outIds.push_back(node.id);
+            continue;
+        }
+
+        s_Stack.push_back(node.child1);
+        s_Stack.push_back(node.child2);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::QuerySphere(
+    const XMFLOAT3& center,
+    const float radius,
+    cvector<EntityID>& outIds) const
+{
+    if (root_ == NULL_NODE)
+        return;
+
+    const float radiusSq = radius * radius;
+
+    s_Stack.clear();
+    s_Stack.push_back(root_);
+
+    while (!s_Stack.empty())
+    {
+        const Node& node = nodes_[s_Stack.back()];
+        s_Stack.pop_back();
+
+        if (DistSqToBox(node, center) > radiusSq)
+            continue;
+
+        if (node.IsLeaf())
+        {
+            outIds.push_back(node.id);
+            continue;
+        }
+
+        s_Stack.push_back(node.child1);
+        s_Stack.push_back(node.child2);
+    }
+}
+
+
+// =================================================================================
+// PRIVATE HELPERS
+// =================================================================================
+int AABBTree::AllocNode()
+{
+    // get a node from the free list or add a new one
+
+    if (freeList_ == NULL_NODE)
+    {
+        nodes_.push_back(Node());
+        return (int)nodes_.size() - 1;
+    }
+
+    const int nodeIdx = freeList_;
+    freeList_ = nodes_[nodeIdx].parent;
+    nodes_[nodeIdx] = Node();
+
+    return nodeIdx;
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::FreeNode(const int nodeIdx)
+{
+    Node& node  = nodes_[nodeIdx];
+    node.parent = freeList_;
+    node.child1 = NULL_NODE;
+    node.child2 = NULL_NODE;
+    node.height = -1;
+    node.id     = INVALID_ENTITY_ID;
+
+    freeList_ = nodeIdx;
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::InsertLeaf(const int leaf)
+{
+    if (root_ == NULL_NODE)
+    {
+        root_ = leaf;
+        nodes_[root_].parent = NULL_NODE;
+        return;
+    }
+
+    // find the best sibling for the new leaf by the surface area heuristic
+    const Node& leafNode = nodes_[leaf];
+    int sibling = root_;
+
+    while (!nodes_[sibling].IsLeaf())
+    {
+        const Node& node = nodes_[sibling];
+        XMFLOAT3 mn, mx;
+
+        const float area = SurfaceArea(node.min, node.max);
+        Union(node, leafNode, mn, mx);
+        const float combinedArea = SurfaceArea(mn, mx);
+
+        // cost of creating a new parent for this node and the new leaf
+        const float cost = 2.0f * combinedArea;
+
+        // minimum cost of pushing the leaf further down the tree
+        const float inheritCost = 2.0f * (combinedArea - area);
+
+        float costs[2];
+        const int children[2] = { node.child1, node.child2 };
+
+        for (int i = 0; i < 2; ++i)
+        {
+            const Node& child = nodes_[children[i]];
+            Union(child, leafNode, mn, mx);
+
+            const float newArea = SurfaceArea(mn, mx);
+            const float oldArea = child.IsLeaf() ? 0.0f : SurfaceArea(child.min, child.max);
+
+            costs[i] = (child.IsLeaf()) ? (newArea + inheritCost) : (newArea - oldArea + inheritCost);
+        }
+
+        if ((cost < costs[0]) && (cost < costs[1]))
+            break;
+
+        sibling = (costs[0] < costs[1]) ? children[0] : children[1];
+    }
+
+    // create a new parent for the sibling and the leaf
+    const int oldParent = nodes_[sibling].parent;
+    const int newParent = AllocNode();
+
+    Node& parent = nodes_[newParent];
+    parent.parent = oldParent;
+    parent.child1 = sibling;
+    parent.child2 = leaf;
+    parent.height = nodes_[sibling].height + 1;
+    Union(nodes_[sibling], nodes_[leaf], parent.min, parent.max);
+
+    if (oldParent != NULL_NODE)
+    {
+        if (nodes_[oldParent].child1 == sibling)
+            nodes_[oldParent].child1 = newParent;
+        else
+            nodes_[oldParent].child2 = newParent;
+    }
+    else
+    {
+        root_ = newParent;
+    }
+
+    nodes_[sibling].parent = newParent;
+    nodes_[leaf].parent    = newParent;
+
+    RefitAncestors(newParent);
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::RemoveLeaf(const int leaf)
+{
+    if (leaf == root_)
+    {
+        root_ = NULL_NODE;
+        return;
+    }
+
+    // replace the parent by the sibling of the leaf
+    const int parent      = nodes_[leaf].parent;
+    const int grandParent = nodes_[parent].parent;
+    const int sibling     = (nodes_[parent].child1 == leaf) ? nodes_[parent].child2 : nodes_[parent].child1;
+
+    if (grandParent != NULL_NODE)
+    {
+        if (nodes_[grandParent].child1 == parent)
+            nodes_[grandParent].child1 = sibling;
+        else
+            nodes_[grandParent].child2 = sibling;
+
+        nodes_[sibling].parent = grandParent;
+        FreeNode(parent);
+
+        RefitAncestors(grandParent);
+    }
+    else
+    {
+        root_ = sibling;
+        nodes_[sibling].parent = NULL_NODE;
+        FreeNode(parent);
+    }
+
+    nodes_[leaf].parent = NULL_NODE;
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::RefitAncestors(int nodeIdx)
+{
+    // walk back up the tree: balance it and fix heights and AABBs
+
+    while (nodeIdx != NULL_NODE)
+    {
+        nodeIdx = Balance(nodeIdx);
+
+        Node& node = nodes_[nodeIdx];
+        const Node& child1 = nodes_[node.child1];
+        const Node& child2 = nodes_[node.child2];
+
+        node.height = 1 + ((child1.height > child2.height) ? child1.height : child2.height);
+        Union(child1, child2, node.min, node.max);
+
+        nodeIdx = node.parent;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+int AABBTree::Balance(const int iA)
+{
+    // perform a left or right rotation if node A is imbalanced;
+    // return the new root idx of this subtree
+
+    Node& A = nodes_[iA];
+
+    if (A.IsLeaf() || (A.height < 2))
+        return iA;
+
+    const int iB = A.child1;
+    const int iC = A.child2;
+    Node& B = nodes_[iB];
+    Node& C = nodes_[iC];
+
+    const int balance = C.height - B.height;
+
+    // rotate C up
+    if (balance > 1)
+    {
+        const int iF = C.child1;
+        const int iG = C.child2;
+        Node& F = nodes_[iF];
+        Node& G = nodes_[iG];
+
+        // swap A and C
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+
+        // A's old parent should point to C
+        if (C.parent != NULL_NODE)
+        {
+            if (nodes_[C.parent].child1 == iA)
+                nodes_[C.parent].child1 = iC;
+            else
+                nodes_[C.parent].child2 = iC;
+        }
+        else
+        {
+            root_ = iC;
+        }
+
+        // rotate
+        if (F.height > G.height)
+        {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            Union(B, G, A.min, A.max);
+            Union(A, F, C.min, C.max);
+
+            A.height = 1 + ((B.height > G.height) ? B.height : G.height);
+            C.height = 1 + ((A.height > F.height) ? A.height : F.height);
+        }
+        else
+        {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            Union(B, F, A.min, A.max);
+            Union(A, G, C.min, C.max);
+
+            A.height = 1 + ((B.height > F.height) ? B.height : F.height);
+            C.height = 1 + ((A.height > G.height) ? A.height : G.height);
+        }
+
+        return iC;
+    }
+
+    // rotate B up
+    if (balance < -1)
+    {
+        const int iD = B.child1;
+        const int iE = B.child2;
+        Node& D = nodes_[iD];
+        Node& E = nodes_[iE];
+
+        // swap A and B
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+
+        // A's old parent should point to B
+        if (B.parent != NULL_NODE)
+        {
+            if (nodes_[B.parent].child1 == iA)
+                nodes_[B.parent].child1 = iB;
+            else
+                nodes_[B.parent].child2 = iB;
+        }
+        else
+        {
+            root_ = iB;
+        }
+
+        // rotate
+        if (D.height > E.height)
+        {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            Union(C, E, A.min, A.max);
+            Union(A, D, B.min, B.max);
+
+            A.height = 1 + ((C.height > E.height) ? C.height : E.height);
+            B.height = 1 + ((A.height > D.height) ? A.height : D.height);
+        }
+        else
+        {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            Union(C, D, A.min, A.max);
+            Union(A, E, B.min, B.max);
+
+            A.height = 1 + ((C.height > D.height) ? C.height : D.height);
+            B.height = 1 + ((A.height > E.height) ? A.height : E.height);
+        }
+
+        return iB;
+    }
+
+    return iA;
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::CollectLeaves(const int nodeIdx, cvector<EntityID>& outIds) const
+{
+    // push all the leaves of the subtree into the output arr;
+    // NOTE: continues using the same traversal stack
+
+    const size stackBase = s_Stack.size();
+    s_Stack.push_back(nodeIdx);
+
+    while (s_Stack.size() > stackBase)
+    {
+        const Node& node = nodes_[s_Stack.back()];
+        s_Stack.pop_back();
+
+        if (node.IsLeaf())
+        {
+            outIds.push_back(node.id);
+            continue;
+        }
+
+        s_Stack.push_back(node.child1);
+        s_Stack.push_back(node.child2);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void AABBTree::Union(const Node& a, const Node& b, XMFLOAT3& outMin, XMFLOAT3& outMax)
+{
+    outMin.x = (a.min.x < b.min.x) ? a.min.x : b.min.x;
+    outMin.y = (a.min.y < b.min.y) ? a.min.y : b.min.y;
+    outMin.z = (a.min.z < b.min.z) ? a.min.z : b.min.z;
+
+    outMax.x = (a.max.x > b.max.x) ? a.max.x : b.max.x;
+    outMax.y = (a.max.y > b.max.y) ? a.max.y : b.max.y;
+    outMax.z = (a.max.z > b.max.z) ? a.max.z : b.max.z;
+}
+
+///////////////////////////////////////////////////////////
+
+float AABBTree::SurfaceArea(const XMFLOAT3& min, const XMFLOAT3& max)
+{
+    const float dx = max.x - min.x;
+    const float dy = max.y - min.y;
+    const float dz = max.z - min.z;
+
+    return 2.0f * (dx*dy + dy*dz + dz*dx);
+}
+
+} // namespace ECS
@@ -0,0 +1,223 @@
+// =================================================================================
+// Filename:     AABBTree.h
+// Description:  a dynamic AABB tree (bounding volume hierarchy) over world-space
+//               bounds of entities; is used to cull the scene by frustum
+//               with a cost which is proportional to the visible part of it:
+//
+//               - each leaf stores a "fat" AABB (enlarged by a margin) so small
+//                 movements of the entity don't change the tree at all;
+//               - a leaf is reinserted only when its actual AABB leaves the fat one;
+//               - the tree is kept balanced by rotations (as AVL tree);
+//               - a frustum query accepts/rejects whole subtrees;
+//               - a ray query collects entts whose fat AABBs are hit by the ray;
+//               - box/sphere queries collect entts whose fat AABBs overlap the volume;
+//               - a k-nearest query goes best-first by distances to nodes so only
+//                 nodes closer than the k-th found entt are visited
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "SparseSet.h"
+#include <Types.h>
+#include <cvector.h>
+#include <DirectXMath.h>
+#include <algorithm>
+#include <math.h>
+
+namespace ECS
+{
+
+class AABBTree
+{
+public:
+    static constexpr int NULL_NODE = -1;
+
+    AABBTree() {}
+
+    void Clear();
+
+    // insert a leaf for the entt or refit its leaf if the entt is already in the tree
+    void Update(const EntityID id, const DirectX::XMFLOAT3& aabbMin, const DirectX::XMFLOAT3& aabbMax);
+
+    // remove leaves of input entts (if they have any)
+    void Remove(const EntityID* ids, const size numEntts);
+
+    // collect entts whose fat AABBs are visible: entts of fully visible subtrees
+    // are pushed into outInside (they don't need any further test) and
+    // entts which intersect the frustum borders are pushed into outIntersected;
+    // NOTE: normals of planes must look outside of the frustum
+    void QueryFrustum(
+        const DirectX::XMFLOAT4* planes,
+        const int numPlanes,
+        cvector<EntityID>& outInside,
+        cvector<EntityID>& outIntersected) const;
+
+    // collect entts whose fat AABBs are hit by the ray closer than maxDist
+    // and distances along the ray to entry points of their AABBs (unordered)
+    void QueryRay(
+        const DirectX::XMFLOAT3& origin,
+        const DirectX::XMFLOAT3& dir,
+        const float maxDist,
+        cvector<EntityID>& outIds,
+        cvector<float>& outDists) const;
+
+    // collect entts whose fat AABBs overlap the box / the sphere (unordered)
+    void QueryAABB(
+        const DirectX::XMFLOAT3& aabbMin,
+        const DirectX::XMFLOAT3& aabbMax,
+        cvector<EntityID>& outIds) const;
+
+    void QuerySphere(
+        const DirectX::XMFLOAT3& center,
+        const float radius,
+        cvector<EntityID>& outIds) const;
+
+    // collect up to k entts closest to the point (not farther than maxDist) sorted
+    // by the distance; distFunc(id, float& outDistSq) returns false to skip the
+    // entt or returns its exact squared distance (which is supposed to be not
+    // less than the distance to its fat AABB)
+    template <typename DistFunc>
+    void QueryNearest(
+        const DirectX::XMFLOAT3& point,
+        const int k,
+        const float maxDist,
+        DistFunc distFunc,
+        cvector<EntityID>& outIds,
+        cvector<float>& outDists) const;
+
+    inline size GetNumLeaves() const { return numLeaves_; }
+    inline int  GetHeight()    const { return (root_ == NULL_NODE) ? 0 : nodes_[root_].height; }
+
+private:
+    struct Node
+    {
+        DirectX::XMFLOAT3 min;
+        DirectX::XMFLOAT3 max;
+
+        int      parent = NULL_NODE;     // or the next free node if this one is in the free list
+        int      child1 = NULL_NODE;
+        int      child2 = NULL_NODE;
+        int      height = 0;             // leaf == 0; free node == -1
+        EntityID id     = INVALID_ENTITY_ID;
+
+        inline bool IsLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    int  AllocNode();
+    void FreeNode(const int nodeIdx);
+
+    void InsertLeaf(const int leaf);
+    void RemoveLeaf(const int leaf);
+    int  Balance(const int nodeIdx);
+
+    void RefitAncestors(int nodeIdx);
+    void CollectLeaves(const int nodeIdx, cvector<EntityID>& outIds) const;
+
+    // an entry of the k-nearest queue: a node or a leaf with an exact distance
+    struct NearestEntry
+    {
+        float distSq;
+        int   nodeIdx;
+        bool  isExact;
+    };
+
+    // squared distance from the point to the box (0 if the point is inside)
+    inline static float DistSqToBox(const Node& n, const DirectX::XMFLOAT3& p)
+    {
+        const float dx = std::max(std::max(n.min.x - p.x, p.x - n.max.x), 0.0f);
+        const float dy = std::max(std::max(n.min.y - p.y, p.y - n.max.y), 0.0f);
+        const float dz = std::max(std::max(n.min.z - p.z, p.z - n.max.z), 0.0f);
+
+        return dx*dx + dy*dy + dz*dz;
+    }
+
+    static void  Union(const Node& a, const Node& b, DirectX::XMFLOAT3& outMin, DirectX::XMFLOAT3& outMax);
+    static float SurfaceArea(const DirectX::XMFLOAT3& min, const DirectX::XMFLOAT3& max);
+
+    inline static bool Contains(const Node& n, const DirectX::XMFLOAT3& min, const DirectX::XMFLOAT3& max)
+    {
+        return (n.min.x <= min.x) && (n.min.y <= min.y) && (n.min.z <= min.z) &&
+               (n.max.x >= max.x) && (n.max.y >= max.y) && (n.max.z >= max.z);
+    }
+
+private:
+    cvector<Node> nodes_;
+    int           root_      = NULL_NODE;
+    int           freeList_  = NULL_NODE;
+    size          numLeaves_ = 0;
+
+    SparseSet     leaves_;                 // entity ID => idx of its leaf node
+    mutable cvector<int> s_Stack;          // static stack for traversal
+    mutable cvector<NearestEntry> s_Queue; // static priority queue for the k-nearest query
+};
+
+
+// =================================================================================
+// TEMPLATES IMPLEMENTATION
+// =================================================================================
+template <typename DistFunc>
+void AABBTree::QueryNearest(
+    const DirectX::XMFLOAT3& point,
+    const int k,
+    const float maxDist,
+    DistFunc distFunc,
+    cvector<EntityID>& outIds,
+    cvector<float>& outDists) const
+{
+    // best-first traversal: the closest entry is popped first so when a leaf with
+    // an exact distance is popped there is nothing closer among the rest ones
+
+    outIds.clear();
+    outDists.clear();
+
+    if ((root_ == NULL_NODE) || (k <= 0))
+        return;
+
+    const auto  greater   = [](const NearestEntry& a, const NearestEntry& b) { return a.distSq > b.distSq; };
+    const float maxDistSq = maxDist * maxDist;
+
+    s_Queue.clear();
+    s_Queue.push_back({ DistSqToBox(nodes_[root_], point), root_, false });
+
+    while (!s_Queue.empty() && ((int)outIds.size() < k))
+    {
+        std::pop_heap(s_Queue.begin(), s_Queue.end(), greater);
+        const NearestEntry entry = s_Queue.back();
+        s_Queue.pop_back();
+
+        // all the rest entries are even farther
+        if (entry.distSq > maxDistSq)
+            break;
+
+        const Node& node = nodes_[entry.nodeIdx];
+
+        if (entry.isExact)
+        {
+            outIds.push_back(node.id);
+            outDists.push_back(sqrtf(entry.distSq));
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            // put the leaf back with its exact distance (if it isn't filtered out)
+            float distSq = 0.0f;
+
+            if (distFunc(node.id, distSq))
+            {
+                s_Queue.push_back({ std::max(distSq, entry.distSq), entry.nodeIdx, true });
+                std::push_heap(s_Queue.begin(), s_Queue.end(), greater);
+            }
+            continue;
+        }
+
+        s_Queue.push_back({ DistSqToBox(nodes_[node.child1], point), node.child1, false });
+        std::push_heap(s_Queue.begin(), s_Queue.end(), greater);
+
+        s_Queue.push_back({ DistSqToBox(nodes_[node.child2], point), node.child2, false });
+        std::push_heap(s_Queue.begin(), s_Queue.end(), greater);
+    }
+}
+
+} // namespace ECS
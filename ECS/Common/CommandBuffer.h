@@ -0,0 +1,109 @@
+// =================================================================================
+// Filename:     CommandBuffer.h
+// Description:  a buffer of deferred structural changes of the ECS (creation and
+//               destroyment of entts, adding/removing of components) which is
+//               recorded by a single thread while systems are executed in parallel
+//               (see EntityMgr::GetCommandBuffer);
+//
+//               the sorted arrays of components can't be changed at this moment so
+//               commands of all the threads are played back at the sync point of
+//               EntityMgr::Update: they are grouped (by a prefab or a component type)
+//               and sorted by IDs, so each group is applied by a single batched
+//               merge per component instead of an insertion per command
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "ECSTypes.h"
+#include "Prefab.h"
+#include <cvector.h>
+#include <DirectXMath.h>
+
+namespace ECS
+{
+
+class CommandBuffer
+{
+public:
+    // create an entt with all the components of the prefab (it must be alive until the
+    // playback) placed by pos (with the prefab's rotation/scale if they aren't passed);
+    // return: idx of the entt's ID in GetCreatedEntts() (after the playback)
+    inline index Instantiate(const Prefab& prefab, const DirectX::XMFLOAT3& pos)
+    {
+        return Instantiate(prefab, pos, prefab.dirQuat, prefab.uniformScale);
+    }
+
+    inline index Instantiate(
+        const Prefab& prefab,
+        const DirectX::XMFLOAT3& pos,
+        const DirectX::XMVECTOR& dirQuat,
+        const float uniformScale)
+    {
+        creates_.push_back({ &prefab, INVALID_ENTITY_ID, pos, dirQuat, uniformScale, (uint32)numCreated_ });
+        return numCreated_++;
+    }
+
+    // add all the components of the prefab to the existing entt (which doesn't have
+    // any of them yet); its transform (if the prefab has it) is placed by pos
+    inline void AddComponents(const EntityID id, const Prefab& prefab, const DirectX::XMFLOAT3& pos = { 0,0,0 })
+    {
+        adds_.push_back({ &prefab, id, pos, prefab.dirQuat, prefab.uniformScale, 0 });
+    }
+
+    inline void RemoveComponent(const EntityID id, const eComponentType type)
+    {
+        removes_.push_back({ id, type });
+    }
+
+    inline void Destroy(const EntityID id)
+    {
+        destroys_.push_back(id);
+    }
+
+    inline bool IsEmpty() const
+    {
+        return creates_.empty() && adds_.empty() && removes_.empty() && destroys_.empty();
+    }
+
+    // IDs of entts which were created by the last playback (by the order of Instantiate calls)
+    inline const cvector<EntityID>& GetCreatedEntts() const { return createdEntts_; }
+
+private:
+    friend class EntityMgr;
+
+    struct PrefabCmd
+    {
+        const Prefab*     pPrefab = nullptr;
+        EntityID          id      = INVALID_ENTITY_ID;      // the target of AddComponents
+        DirectX::XMFLOAT3 pos;
+        DirectX::XMVECTOR dirQuat;
+        float             uniformScale = 1.0f;
+        uint32            createIdx    = 0;                 // idx in createdEntts_
+    };
+
+    struct RemoveCmd
+    {
+        EntityID       id   = INVALID_ENTITY_ID;
+        eComponentType type = NameComponent;
+    };
+
+    // is called by the entity manager after the playback
+    inline void Clear()
+    {
+        creates_.clear();
+        adds_.clear();
+        removes_.clear();
+        destroys_.clear();
+        numCreated_ = 0;
+    }
+
+    cvector<PrefabCmd> creates_;
+    cvector<PrefabCmd> adds_;
+    cvector<RemoveCmd> removes_;
+    cvector<EntityID>  destroys_;
+    cvector<EntityID>  createdEntts_;
+    index              numCreated_ = 0;
+};
+
+} // namespace ECS
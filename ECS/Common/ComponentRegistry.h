@@ -0,0 +1,185 @@
+// =================================================================================
+// Filename:     ComponentRegistry.h
+// Description:  compile-time registration of components:
+//
+//               - names of all the component types are in a constexpr table
+//                 (by eComponentType) so there are no runtime maps of names;
+//               - ComponentTraits<T> gives the eComponentType, the bit mask,
+//                 the name and the sparse set of a component storage type T;
+//               - ComponentList<Ts...> is a type list with its constexpr mask
+//                 and a compile-time ForEach over its types; RegisteredComponents
+//                 lists all the component storages of the entity manager
+//
+//               so generic code (queries, Get<T>/Add<T> of the entity manager,
+//               masks of the update scheduler) is specialized at compile time
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "ECSTypes.h"
+#include "SparseSet.h"
+
+#include "../Components/Transform.h"
+#include "../Components/Movement.h"
+#include "../Components/Model.h"
+#include "../Components/Rendered.h"
+#include "../Components/Name.h"
+#include "../Components/Material.h"
+#include "../Components/TextureTransform.h"
+#include "../Components/Light.h"
+#include "../Components/RenderStates.h"
+#include "../Components/Bounding.h"
+#include "../Components/Camera.h"
+#include "../Components/Hierarchy.h"
+#include "../Components/SoundEmitter.h"
+#include "../Components/ParticleEmitter.h"
+#include "../Components/Collider.h"
+#include "../Components/Animator.h"
+#include "../Components/Portal.h"
+
+#include <array>
+#include <type_traits>
+
+namespace ECS
+{
+
+// =================================================================================
+// NAMES OF COMPONENTS (by eComponentType)
+// =================================================================================
+constexpr auto COMPONENT_NAMES = std::to_array<const char*>(
+{
+    "Name",
+    "Transform",
+    "Movement",
+    "Rendered",
+    "Model",
+
+    "Camera",
+    "Material",
+    "Texture transform",
+    "Light",
+    "Render states",
+    "Bounding",
+
+    "Player",
+    "Hierarchy",
+    "Sound emitter",
+    "Particle emitter",
+    "Collider",
+    "Animator",
+    "Portal",
+
+    // not implemented yet
+    "AI",
+    "Health",
+    "Damage",
+    "Enemy",
+
+    "Physics type",
+    "Velocity",
+    "Grounded",
+    "Collision",
+});
+
+static_assert(COMPONENT_NAMES.size() == NUM_COMPONENTS, "each component type must have a name");
+
+constexpr const char* GetComponentName(const eComponentType type)
+{
+    return ((uint32)type < NUM_COMPONENTS) ? COMPONENT_NAMES[type] : "Invalid";
+}
+
+
+// =================================================================================
+// COMPONENT TRAITS: component storage type => its eComponentType, mask, name
+// =================================================================================
+template <typename T>
+struct ComponentTraits;
+
+#define ECS_REGISTER_COMPONENT(CompT, compType)                                   \
+    template <>                                                                   \
+    struct ComponentTraits<CompT>                                                 \
+    {                                                                             \
+        static constexpr eComponentType    TYPE = compType;                       \
+        static constexpr ComponentBitfield BIT  = GetComponentBit(compType);      \
+        static constexpr const char*       NAME = COMPONENT_NAMES[compType];      \
+    };
+
+// a component which can be queried (has the sparse set: entt ID => data idx)
+#define ECS_REGISTER_SPARSE_COMPONENT(CompT, compType, sparseMember)              \
+    template <>                                                                   \
+    struct ComponentTraits<CompT>                                                 \
+    {                                                                             \
+        static constexpr eComponentType    TYPE = compType;                       \
+        static constexpr ComponentBitfield BIT  = GetComponentBit(compType);      \
+        static constexpr const char*       NAME = COMPONENT_NAMES[compType];      \
+        static inline const SparseSet& GetSparseIdxs(const CompT& comp) { return comp.sparseMember; } \
+    };
+
+ECS_REGISTER_SPARSE_COMPONENT(Transform,        TransformComponent,        sparseIdxs)
+ECS_REGISTER_SPARSE_COMPONENT(Movement,         MoveComponent,             sparseIdxs_)
+ECS_REGISTER_SPARSE_COMPONENT(Model,            ModelComponent,            sparseIdxs_)
+ECS_REGISTER_SPARSE_COMPONENT(Rendered,         RenderedComponent,         sparseIdxs)
+ECS_REGISTER_SPARSE_COMPONENT(Name,             NameComponent,             sparseIdxs_)
+ECS_REGISTER_SPARSE_COMPONENT(Material,         MaterialComponent,         sparseIdxs)
+ECS_REGISTER_SPARSE_COMPONENT(TextureTransform, TextureTransformComponent, sparseIdxs)
+ECS_REGISTER_SPARSE_COMPONENT(Light,            LightComponent,            sparseIdxs)
+ECS_REGISTER_SPARSE_COMPONENT(RenderStates,     RenderStatesComponent,     sparseIdxs_)
+ECS_REGISTER_SPARSE_COMPONENT(Bounding,         BoundingComponent,         sparseIdxs)
+ECS_REGISTER_SPARSE_COMPONENT(Hierarchy,        HierarchyComponent,        sparseIdxs)
+ECS_REGISTER_SPARSE_COMPONENT(SoundEmitter,     SoundEmitterComponent,     sparseIdxs_)
+ECS_REGISTER_SPARSE_COMPONENT(ParticleEmitter,  ParticleEmitterComponent,  sparseIdxs_)
+ECS_REGISTER_SPARSE_COMPONENT(Collider,         ColliderComponent,         sparseIdxs_)
+ECS_REGISTER_SPARSE_COMPONENT(Animator,         AnimatorComponent,         sparseIdxs_)
+ECS_REGISTER_SPARSE_COMPONENT(Portal,           PortalComponent,           sparseIdxs_)
+ECS_REGISTER_COMPONENT       (Camera,           CameraComponent)
+
+#undef ECS_REGISTER_SPARSE_COMPONENT
+#undef ECS_REGISTER_COMPONENT
+
+
+// =================================================================================
+// COMPONENT LIST: a compile-time list of component storage types
+// =================================================================================
+template <typename... Ts>
+struct ComponentList
+{
+    static constexpr size              COUNT = sizeof...(Ts);
+    static constexpr ComponentBitfield MASK  = (ComponentBitfield(0) | ... | ComponentTraits<Ts>::BIT);
+
+    // call func.template operator()<T>() for each type of the list (by order)
+    template <typename Func>
+    static constexpr void ForEach(Func&& func)
+    {
+        (func.template operator()<Ts>(), ...);
+    }
+
+    template <typename T>
+    static constexpr bool Contains() { return (std::is_same_v<T, Ts> || ...); }
+};
+
+// a bit mask of the components set (for instance: ComponentMask<Transform, Rendered>)
+template <typename... Ts>
+constexpr ComponentBitfield ComponentMask = ComponentList<Ts...>::MASK;
+
+// all the component storages which are owned by the entity manager
+using RegisteredComponents = ComponentList<
+    Transform,
+    Movement,
+    Model,
+    Rendered,
+    Name,
+    Material,
+    TextureTransform,
+    Light,
+    RenderStates,
+    Bounding,
+    Camera,
+    Hierarchy,
+    SoundEmitter,
+    ParticleEmitter,
+    Collider,
+    Animator,
+    Portal>;
+
+} // namespace ECS
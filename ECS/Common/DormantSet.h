@@ -0,0 +1,107 @@
+// =================================================================================
+// Filename:     DormantSet.h
+// Description:  a SORTED set of entts whose updates are skipped by some system
+//               (entts of dormant chunks of the world partition);
+//
+//               the system asks for idxs of its active records (the ones which
+//               aren't dormant); these idxs are rebuilt by a single merge pass
+//               only after the dormant entts or the system's records were changed
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "ECSTypes.h"
+#include <cvector.h>
+#include <algorithm>
+
+namespace ECS
+{
+
+class DormantSet
+{
+public:
+    inline bool IsEmpty()                    const { return ids_.empty(); }
+    inline size GetSize()                    const { return ids_.size(); }
+    inline bool IsDormant(const EntityID id) const { return ids_.binary_search(id); }
+
+    // the records of the system were added/removed (their idxs are shifted)
+    inline void MarkDirty() { isDirty_ = true; }
+
+    inline void Clear()
+    {
+        ids_.clear();
+        activeIdxs_.clear();
+        isDirty_ = true;
+    }
+
+    // -----------------------------------------------------
+
+    void Set(const EntityID* ids, const size numEntts, const bool isDormant)
+    {
+        // input ids must be SORTED
+
+        if (!ids || (numEntts <= 0))
+            return;
+
+        if (isDormant)
+        {
+            tmpIds_.resize(ids_.size() + numEntts);
+            const EntityID* end = std::set_union(ids_.begin(), ids_.end(), ids, ids + numEntts, tmpIds_.begin());
+            tmpIds_.resize(end - tmpIds_.begin());
+        }
+        else
+        {
+            tmpIds_.resize(ids_.size());
+            const EntityID* end = std::set_difference(ids_.begin(), ids_.end(), ids, ids + numEntts, tmpIds_.begin());
+            tmpIds_.resize(end - tmpIds_.begin());
+        }
+
+        ids_     = tmpIds_;
+        isDirty_ = true;
+    }
+
+    // -----------------------------------------------------
+
+    inline void Remove(const EntityID* ids, const size numEntts)
+    {
+        // entts were destroyed
+        Set(ids, numEntts, false);
+    }
+
+    // -----------------------------------------------------
+
+    const cvector<index>& GetActiveIdxs(const cvector<EntityID>& recordsIds)
+    {
+        // return: idxs of records (by SORTED ids of the system) which aren't dormant
+
+        if (!isDirty_)
+            return activeIdxs_;
+
+        activeIdxs_.clear();
+        activeIdxs_.reserve(recordsIds.size());
+
+        const size numDormant = ids_.size();
+        index      d          = 0;
+
+        for (index i = 0; i < recordsIds.size(); ++i)
+        {
+            while ((d < numDormant) && (ids_[d] < recordsIds[i]))
+                ++d;
+
+            if ((d == numDormant) || (ids_[d] != recordsIds[i]))
+                activeIdxs_.push_back(i);
+        }
+
+        isDirty_ = false;
+        return activeIdxs_;
+    }
+
+private:
+    cvector<EntityID> ids_;                 // SORTED
+    cvector<EntityID> tmpIds_;
+    cvector<index>    activeIdxs_;
+    bool              isDirty_ = true;
+};
+
+} // namespace ECS
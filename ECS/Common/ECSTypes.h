@@ -7,6 +7,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <Types.h>
 
 namespace ECS
 {
@@ -37,13 +38,18 @@ enum eComponentType
     BoundingComponent,             // for using AABB, OBB, bounding spheres
 
     PlayerComponent,               // to hold First-Person-Shooter (FPS) player's data
+    HierarchyComponent,            // parent-children relations between entities
+    SoundEmitterComponent,         // a positional (3D) sound source
+    ParticleEmitterComponent,      // a source of particles which are simulated on GPU
+    ColliderComponent,             // a collision shape (sphere/OBB) which is tested by the sweep-and-prune broad phase
+    AnimatorComponent,             // playback state of a skeletal animation (the clip, time and speed)
+    PortalComponent,               // a cell (a room) or a portal between cells for the visibility of interiors
 
     // NOT IMPLEMENTED YET
     AIComponent,
     HealthComponent,
     DamageComponent,
     EnemyComponent,
-    ColliderComponent,
 
     PhysicsTypeComponent,
     VelocityComponent,
@@ -53,6 +59,40 @@ enum eComponentType
     NUM_COMPONENTS
 };
 
+static_assert(NUM_COMPONENTS <= sizeof(ComponentBitfield) * 8, "too many components for the ComponentBitfield");
+
+// make a bitmask by component type
+constexpr ComponentBitfield GetComponentBit(const eComponentType type)
+{
+    return (ComponentBitfield)1 << type;
+}
+
+///////////////////////////////////////////////////////////
+
+// entity ID consists of: [generation: 8 bits][slot: 24 bits];
+// when entity is destroyed its slot is reused with the next generation,
+// so stale IDs of destroyed entts don't match the new entity in the same slot
+constexpr uint32 ENTT_SLOT_BITS = 24;
+constexpr uint32 ENTT_SLOT_MASK = (1u << ENTT_SLOT_BITS) - 1;
+constexpr uint32 ENTT_GEN_MASK  = 0xFF;
+
+constexpr uint32 GetEnttSlot(const EntityID id)
+{
+    return id & ENTT_SLOT_MASK;
+}
+
+constexpr uint32 GetEnttGeneration(const EntityID id)
+{
+    return id >> ENTT_SLOT_BITS;
+}
+
+constexpr EntityID MakeEnttID(const uint32 slot, const uint32 generation)
+{
+    return ((generation & ENTT_GEN_MASK) << ENTT_SLOT_BITS) | (slot & ENTT_SLOT_MASK);
+}
+
+///////////////////////////////////////////////////////////
+
 enum RenderShaderType
 {
     COLOR_SHADER,
@@ -0,0 +1,106 @@
+// =================================================================================
+// Filename:     Prefab.h
+// Description:  a template of an entity (a "tree", a "street lamp"): a set of
+//               components with their data which is captured once and then
+//               instantiated many times by EntityMgr::Instantiate();
+//
+//               all the instances of a batch are added into each component's
+//               arrays by a single merge pass, and the bitfields/queries are
+//               updated once for the whole batch (instead of a pass per component
+//               and per Add*Component call)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "ECSTypes.h"
+#include "../Components/Rendered.h"
+#include "../Components/Bounding.h"
+#include <cvector.h>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <string>
+
+namespace ECS
+{
+
+struct Prefab
+{
+    // components of instances (bits by eComponentType)
+    ComponentBitfield   components = 0;
+
+    // NAME: instances are named "<name>_<number of instance>"
+    std::string         name;
+
+    // TRANSFORM: defaults for instances which don't get their own ones
+    DirectX::XMVECTOR   dirQuat      = { 0,0,0,1 };
+    float               uniformScale = 1.0f;
+
+    // MODEL
+    ModelID             modelID = INVALID_MODEL_ID;
+
+    // RENDERED (+ RENDER STATES with default states)
+    RenderInitParams    renderParams;
+
+    // MATERIAL: a material per subset (mesh) of the model
+    cvector<MaterialID> materialsIDs;
+    bool                areMaterialsMeshBased = true;
+
+    // BOUNDING: a type and AABB per subset (mesh) of the model
+    cvector<BoundingType>         boundTypes;
+    cvector<DirectX::BoundingBox> AABBs;
+
+    // -----------------------------------------------------
+
+    inline bool Has(const eComponentType type) const
+    {
+        return components & GetComponentBit(type);
+    }
+
+    inline Prefab& SetName(const char* inName)
+    {
+        name = inName;
+        components |= GetComponentBit(NameComponent);
+        return *this;
+    }
+
+    inline Prefab& SetTransform(const DirectX::XMVECTOR& inDirQuat, const float inUniformScale)
+    {
+        dirQuat      = inDirQuat;
+        uniformScale = inUniformScale;
+        components  |= GetComponentBit(TransformComponent);
+        return *this;
+    }
+
+    inline Prefab& SetModel(const ModelID id)
+    {
+        modelID     = id;
+        components |= GetComponentBit(ModelComponent);
+        return *this;
+    }
+
+    inline Prefab& SetRendering(const RenderInitParams& params)
+    {
+        renderParams = params;
+        components  |= GetComponentBit(RenderedComponent) | GetComponentBit(RenderStatesComponent);
+        return *this;
+    }
+
+    inline Prefab& SetMaterials(const MaterialID* ids, const size numSubsets, const bool meshBased)
+    {
+        materialsIDs.assign(ids, ids + numSubsets);
+        areMaterialsMeshBased = meshBased;
+        components |= GetComponentBit(MaterialComponent);
+        return *this;
+    }
+
+    inline Prefab& SetBounding(const BoundingType* types, const DirectX::BoundingBox* boxes, const size numSubsets)
+    {
+        boundTypes.assign(types, types + numSubsets);
+        AABBs.assign(boxes, boxes + numSubsets);
+        components |= GetComponentBit(BoundingComponent);
+        return *this;
+    }
+};
+
+} // namespace ECS
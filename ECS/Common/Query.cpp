@@ -0,0 +1,96 @@
+// =================================================================================
+// Filename:     Query.cpp
+// Description:  implementation of the QueryBase's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "Query.h"
+
+
+namespace ECS
+{
+
+void QueryBase::Reset(
+    const EntityID* ids,
+    const ComponentBitfield* hashes,
+    const size numEntts)
+{
+    // rebuild the list of matching entts from scratch
+    // (input ids aren't supposed to be sorted)
+
+    ids_.clear();
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        if (Matches(hashes[i]))
+            ids_.push_back(ids[i]);
+    }
+
+    std::sort(ids_.begin(), ids_.end());
+    isIdxsDirty_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void QueryBase::OnComponentsAdded(
+    const EntityID* ids,
+    const ComponentBitfield* hashes,
+    const size numEntts)
+{
+    // some of queried components were added to input entts;
+    // add entts which match the query now (and weren't in it before)
+
+    cvector<EntityID> newIds;
+    newIds.reserve(numEntts);
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        if (Matches(hashes[i]) && !std::binary_search(ids_.begin(), ids_.end(), ids[i]))
+            newIds.push_back(ids[i]);
+    }
+
+    // records of components were inserted so their idxs are shifted
+    isIdxsDirty_ = true;
+
+    if (newIds.empty())
+        return;
+
+    std::sort(newIds.begin(), newIds.end());
+    newIds.resize(std::unique(newIds.begin(), newIds.end()) - newIds.begin());
+
+    // execute sorted insertion
+    cvector<index> idxs;
+    ids_.merge_sorted(newIds, idxs);
+}
+
+///////////////////////////////////////////////////////////
+
+void QueryBase::OnEnttsRemoved(const EntityID* ids, const size numEntts)
+{
+    // remove input entts from the list of matching ones
+
+    cvector<index> idxs;
+    idxs.reserve(numEntts);
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const EntityID* it = std::lower_bound(ids_.begin(), ids_.end(), ids[i]);
+
+        if ((it != ids_.end()) && (*it == ids[i]))
+            idxs.push_back(it - ids_.begin());
+    }
+
+    // records of components were removed so their idxs are shifted
+    isIdxsDirty_ = true;
+
+    if (idxs.empty())
+        return;
+
+    std::sort(idxs.begin(), idxs.end());
+    idxs.resize(std::unique(idxs.begin(), idxs.end()) - idxs.begin());
+
+    ids_.erase_by_idxs(idxs);
+}
+
+} // namespace ECS
@@ -0,0 +1,126 @@
+// =================================================================================
+// Filename:     Query.h
+// Description:  a cached query of entities which have a particular set of
+//               components (for instance: Query<Transform, Rendered, Material>);
+//
+//               the entity manager keeps the list of matching entities up to
+//               date when components are added or entities are destroyed, so
+//               systems don't need to intersect IDs lists by hand each frame;
+//
+//               for each component of the query we also hand out an array of
+//               idxs into the component's dense arrays (by the same order as
+//               the matching entts), these idxs are recomputed lazily only
+//               after the components data was changed
+//
+//               NOTE: isn't thread-safe: GetIdxs() can recompute the cached idxs
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "ECSTypes.h"
+#include "SparseSet.h"
+#include "ComponentRegistry.h"
+
+#include <cvector.h>
+#include <tuple>
+#include <type_traits>
+
+namespace ECS
+{
+
+// =================================================================================
+// QUERY BASE: the list of matching entts (independent of components types)
+// =================================================================================
+class QueryBase
+{
+public:
+    QueryBase(const ComponentBitfield mask) : mask_(mask) {}
+    virtual ~QueryBase() {}
+
+    // restrict copying
+    QueryBase(const QueryBase&) = delete;
+    QueryBase& operator=(const QueryBase&) = delete;
+
+    inline ComponentBitfield        GetMask()  const { return mask_; }
+    inline const cvector<EntityID>& GetEntts() const { return ids_; }     // SORTED
+    inline size                     Size()     const { return ids_.size(); }
+    inline bool                     Empty()    const { return ids_.empty(); }
+
+    // check if entity with such a components hash matches the query
+    inline bool Matches(const ComponentBitfield hash) const { return (hash & mask_) == mask_; }
+
+    // the data of components was changed so the cached idxs are invalid
+    inline void MarkIdxsDirty() { isIdxsDirty_ = true; }
+
+    // these are called by the entity manager to keep the query up to date
+    void Reset(const EntityID* ids, const ComponentBitfield* hashes, const size numEntts);
+    void OnComponentsAdded(const EntityID* ids, const ComponentBitfield* hashes, const size numEntts);
+    void OnEnttsRemoved(const EntityID* ids, const size numEntts);
+
+protected:
+    ComponentBitfield mask_ = 0;
+    cvector<EntityID> ids_;                 // SORTED ids of matching entts
+    bool              isIdxsDirty_ = true;
+};
+
+
+// =================================================================================
+// QUERY: matching entts + idxs into the data of each queried component
+// =================================================================================
+template <typename... Ts>
+class Query : public QueryBase
+{
+    static_assert(sizeof...(Ts) > 0, "a query must have at least one component");
+
+public:
+    Query(const Ts*... pComponents) :
+        QueryBase(ComponentMask<Ts...>),
+        pComponents_(pComponents...)
+    {
+    }
+
+    // get the component's data storage
+    template <typename T>
+    inline const T& Get() const
+    {
+        return *std::get<const T*>(pComponents_);
+    }
+
+    // get idxs into the dense arrays of the component T:
+    // idxs[i] is an idx of the record of entity GetEntts()[i]
+    template <typename T>
+    const cvector<index>& GetIdxs()
+    {
+        if (isIdxsDirty_)
+            UpdateIdxs();
+
+        return idxs_[GetTypeIdx<T>()];
+    }
+
+private:
+    template <typename T>
+    static constexpr size GetTypeIdx()
+    {
+        static_assert((std::is_same_v<T, Ts> || ...), "there is no such component in the query");
+
+        // the position of T in the list of queried components
+        size idx = 0;
+        bool found = false;
+        ((found = found || std::is_same_v<T, Ts>, idx += !found), ...);
+
+        return idx;
+    }
+
+    void UpdateIdxs()
+    {
+        ((ComponentTraits<Ts>::GetSparseIdxs(Get<Ts>()).GetIdxs(ids_, idxs_[GetTypeIdx<Ts>()])), ...);
+        isIdxsDirty_ = false;
+    }
+
+private:
+    std::tuple<const Ts*...> pComponents_;
+    cvector<index>           idxs_[sizeof...(Ts)];
+};
+
+} // namespace ECS
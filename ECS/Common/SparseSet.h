@@ -0,0 +1,207 @@
+// =================================================================================
+// Filename:     SparseSet.h
+// Description:  a sparse table to map 'entity_id' => 'data_idx' of some component;
+//
+//               each component keeps its data in dense SORTED arrays (ids, data);
+//               this table is a sparse lookup array indexed by entity's slot which
+//               stores an idx into these dense arrays, so we can get an idx of
+//               entity's record in O(1) instead of binary search over ids;
+//
+//               we also keep a full ID per slot, so stale IDs (of destroyed
+//               entts whose slot is already reused) don't match any record
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "ECSTypes.h"
+#include <cvector.h>
+#include <algorithm>
+
+namespace ECS
+{
+
+class SparseSet
+{
+public:
+    static constexpr index INVALID_IDX = -1;
+
+    // -----------------------------------------------------
+
+    inline index GetIdx(const EntityID id) const
+    {
+        // return an idx of the record in the dense arrays
+        // or INVALID_IDX if there is no record for such entity
+        const EntityID slot = GetEnttSlot(id);
+
+        if ((slot < (EntityID)sparse_.size()) && (ids_[slot] == id))
+            return sparse_[slot];
+
+        return INVALID_IDX;
+    }
+
+    inline bool Has(const EntityID id) const
+    {
+        return GetIdx(id) != INVALID_IDX;
+    }
+
+    // -----------------------------------------------------
+
+    bool HasAll(const EntityID* ids, const size numIds) const
+    {
+        // check if there are records for each input entity
+
+        bool hasAll = true;
+
+        for (index i = 0; i < numIds; ++i)
+            hasAll &= Has(ids[i]);
+
+        return hasAll;
+    }
+
+    bool HasAny(const EntityID* ids, const size numIds) const
+    {
+        // check if there is a record at least for one input entity
+
+        bool hasAny = false;
+
+        for (index i = 0; i < numIds; ++i)
+            hasAny |= Has(ids[i]);
+
+        return hasAny;
+    }
+
+    // -----------------------------------------------------
+
+    void GetIdxs(
+        const EntityID* ids,
+        const size numIds,
+        cvector<index>& outIdxs,
+        const index missingIdx = INVALID_IDX) const
+    {
+        // out: an idx into the dense arrays for each input entity;
+        //      if there is no record for some entity we put the missingIdx instead
+        //      (components which store "invalid" data by idx 0 pass 0 here)
+
+        outIdxs.resize_uninitialized(numIds);
+
+        for (index i = 0; i < numIds; ++i)
+        {
+            const index idx = GetIdx(ids[i]);
+            outIdxs[i] = (idx != INVALID_IDX) ? idx : missingIdx;
+        }
+    }
+
+    inline void GetIdxs(
+        const cvector<EntityID>& ids,
+        cvector<index>& outIdxs,
+        const index missingIdx = INVALID_IDX) const
+    {
+        GetIdxs(ids.data(), ids.size(), outIdxs, missingIdx);
+    }
+
+    void GetExistingIdxs(
+        const EntityID* ids,
+        const size numIds,
+        cvector<index>& outIdxs) const
+    {
+        // out: SORTED unique idxs of records only for entts which have them
+        //      (is used for batched removal of records from the dense arrays)
+
+        outIdxs.clear();
+        outIdxs.reserve(numIds);
+
+        for (index i = 0; i < numIds; ++i)
+        {
+            const index idx = GetIdx(ids[i]);
+
+            if (idx != INVALID_IDX)
+                outIdxs.push_back(idx);
+        }
+
+        std::sort(outIdxs.begin(), outIdxs.end());
+        outIdxs.resize(std::unique(outIdxs.begin(), outIdxs.end()) - outIdxs.begin());
+    }
+
+    // -----------------------------------------------------
+
+    inline void Set(const EntityID id, const index idx)
+    {
+        // bind entity to the record by idx in the dense arrays
+        const EntityID slot = GetEnttSlot(id);
+
+        if (slot >= (EntityID)sparse_.size())
+            Grow(slot);
+
+        sparse_[slot] = idx;
+        ids_[slot]    = id;
+    }
+
+    inline void Remove(const EntityID id)
+    {
+        const EntityID slot = GetEnttSlot(id);
+
+        if ((slot < (EntityID)sparse_.size()) && (ids_[slot] == id))
+        {
+            sparse_[slot] = INVALID_IDX;
+            ids_[slot]    = INVALID_ENTITY_ID;
+        }
+    }
+
+    inline void Remove(const EntityID* ids, const size numIds)
+    {
+        for (index i = 0; i < numIds; ++i)
+            Remove(ids[i]);
+    }
+
+    // -----------------------------------------------------
+
+    void Rebuild(const cvector<EntityID>& denseIds, const index fromIdx = 0)
+    {
+        // update the table by dense (SORTED) array of IDs;
+        //
+        // since we execute sorted insertion/removal into dense arrays
+        // only records starting from the first changed idx are shifted,
+        // so we update our table for the range [fromIdx, end) only
+        //
+        // NOTE: must be called after each insertion/removal of records
+
+        const size numIds = denseIds.size();
+
+        for (index i = (fromIdx > 0) ? fromIdx : 0; i < numIds; ++i)
+            Set(denseIds[i], i);
+    }
+
+    inline void Clear()        { sparse_.clear(); ids_.clear(); }
+    inline size Size()   const { return sparse_.size(); }
+
+private:
+    void Grow(const EntityID maxSlot)
+    {
+        // make the table big enough to hold the entity by maxSlot
+
+        const size oldSize = sparse_.size();
+        const size newSize = (size)maxSlot + 1;
+
+        if (newSize <= oldSize)
+            return;
+
+        // grow ahead to prevent reallocation for each new entity
+        sparse_.reserve(newSize + (newSize >> 1));
+        ids_.reserve(newSize + (newSize >> 1));
+        sparse_.resize(newSize);
+        ids_.resize(newSize);
+
+        for (index i = oldSize; i < newSize; ++i)
+        {
+            sparse_[i] = INVALID_IDX;
+            ids_[i]    = INVALID_ENTITY_ID;
+        }
+    }
+
+private:
+    cvector<index>    sparse_;   // sparse_[entity_slot] == idx into the dense arrays
+    cvector<EntityID> ids_;      // ids_[entity_slot]    == full ID (with generation) of the entity which owns this slot
+};
+
+} // namespace ECS
@@ -0,0 +1,144 @@
+// =================================================================================
+// Filename:     StringTable.cpp
+// Description:  implementation of the StringTable's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "StringTable.h"
+
+
+namespace ECS
+{
+
+StringTable::StringTable()
+{
+    Clear();
+}
+
+///////////////////////////////////////////////////////////
+
+void StringTable::Clear()
+{
+    chars_.clear();
+    offsets_.clear();
+    lengths_.clear();
+    hashes_.clear();
+
+    // add an empty string (its handle is also used as a marker of free hash slot)
+    chars_.push_back('\0');
+    offsets_.push_back(0);
+    lengths_.push_back(0);
+    hashes_.push_back(ComputeHash("", 0));
+
+    slots_.resize(64);
+
+    for (StrHandle& slot : slots_)
+        slot = EMPTY_STR_HANDLE;
+}
+
+///////////////////////////////////////////////////////////
+
+uint32 StringTable::ComputeHash(const char* str, const size len)
+{
+    // FNV-1a (32-bit)
+    uint32 hash = 2166136261u;
+
+    for (index i = 0; i < len; ++i)
+    {
+        hash ^= (uint8)str[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+///////////////////////////////////////////////////////////
+
+StrHandle StringTable::Find(const char* str, const size len) const
+{
+    if (len == 0)
+        return EMPTY_STR_HANDLE;
+
+    const uint32 hash = ComputeHash(str, len);
+    const size   mask = slots_.size() - 1;
+
+    for (size slot = hash & mask; ; slot = (slot + 1) & mask)
+    {
+        const StrHandle h = slots_[slot];
+
+        if (h == EMPTY_STR_HANDLE)
+            return EMPTY_STR_HANDLE;
+
+        if ((hashes_[h] == hash) && (lengths_[h] == len) && (memcmp(GetStr(h), str, len) == 0))
+            return h;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+StrHandle StringTable::Intern(const char* str, const size len)
+{
+    if (len == 0)
+        return EMPTY_STR_HANDLE;
+
+    CAssert::True(str != nullptr, "input ptr to string == nullptr");
+
+    StrHandle h = Find(str, len);
+
+    if (h != EMPTY_STR_HANDLE)
+        return h;
+
+    // keep the load factor of the hash map <= 0.5
+    if ((Size() + 1) * 2 > slots_.size())
+        Rehash(slots_.size() * 2);
+
+    // add the string into the arena
+    h = (StrHandle)Size();
+
+    const size offset = chars_.size();
+    chars_.resize(offset + len + 1);
+    memcpy(chars_.data() + offset, str, len);
+    chars_[offset + len] = '\0';
+
+    offsets_.push_back((uint32)offset);
+    lengths_.push_back((uint32)len);
+    hashes_.push_back(ComputeHash(str, len));
+
+    // add the handle into the hash map
+    const size mask = slots_.size() - 1;
+    size slot = hashes_[h] & mask;
+
+    while (slots_[slot] != EMPTY_STR_HANDLE)
+        slot = (slot + 1) & mask;
+
+    slots_[slot] = h;
+
+    return h;
+}
+
+///////////////////////////////////////////////////////////
+
+void StringTable::Rehash(const size numSlots)
+{
+    // NOTE: numSlots must be a power of 2
+
+    slots_.resize(numSlots);
+
+    for (StrHandle& slot : slots_)
+        slot = EMPTY_STR_HANDLE;
+
+    const size mask = numSlots - 1;
+
+    for (StrHandle h = 1; h < (StrHandle)Size(); ++h)
+    {
+        size slot = hashes_[h] & mask;
+
+        while (slots_[slot] != EMPTY_STR_HANDLE)
+            slot = (slot + 1) & mask;
+
+        slots_[slot] = h;
+    }
+}
+
+} // namespace ECS
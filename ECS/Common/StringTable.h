@@ -0,0 +1,63 @@
+// =================================================================================
+// Filename:     StringTable.h
+// Description:  a table of interned strings:
+//
+//               - chars of all the strings are stored in a single arena
+//                 (each string is null-terminated);
+//               - each unique string gets a 32-bit handle (its idx in the table);
+//               - an open-addressing hash map (linear probing) is used
+//                 for O(1) lookup: string => handle
+//
+//               NOTE: strings are never removed from the table (until Clear)
+//               NOTE: ptrs returned by GetStr() are valid until the next Intern()
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <string>
+
+namespace ECS
+{
+
+using StrHandle = uint32;
+
+class StringTable
+{
+public:
+    // the handle of an empty string (it is always in the table)
+    static constexpr StrHandle EMPTY_STR_HANDLE = 0;
+
+    StringTable();
+
+    // get a handle of the string (add the string if there is no such one yet)
+    StrHandle Intern(const char* str, const size len);
+    inline StrHandle Intern(const std::string& str) { return Intern(str.data(), (size)str.size()); }
+
+    // return a handle of the string or EMPTY_STR_HANDLE if there is no such string
+    StrHandle Find(const char* str, const size len) const;
+    inline StrHandle Find(const std::string& str) const { return Find(str.data(), (size)str.size()); }
+
+    void Clear();
+
+    inline size        Size()                         const { return offsets_.size(); }
+    inline const char* GetStr   (const StrHandle h)   const { return chars_.data() + offsets_[h]; }
+    inline uint32      GetLength(const StrHandle h)   const { return lengths_[h]; }
+
+private:
+    static uint32 ComputeHash(const char* str, const size len);
+
+    void Rehash(const size numSlots);
+
+private:
+    cvector<char>      chars_;      // arena: chars of all the strings
+    cvector<uint32>    offsets_;    // handle => offset of string in arena
+    cvector<uint32>    lengths_;    // handle => length of string (without '\0')
+    cvector<uint32>    hashes_;     // handle => hash of string (so we don't rehash chars when grow)
+
+    cvector<StrHandle> slots_;      // open-addressing hash map: slot => handle (EMPTY_STR_HANDLE if slot is free)
+};
+
+} // namespace ECS
@@ -0,0 +1,185 @@
+// =================================================================================
+// Filename:     SubsetPool.h
+// Description:  per-subset (mesh) data of all the records of a component stored
+//               in a single flat pool; each record (by the same idx as ids of
+//               the component) has only a range (offset, count) into the pool;
+//
+//               ranges follow the order of records so the pool is rebuilt by
+//               a single pass on insertion and compacted in-place on removal
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "ECSTypes.h"
+#include <cvector.h>
+#include <algorithm>
+
+namespace ECS
+{
+
+struct SubsetRange
+{
+    uint32 offset = 0;
+    uint32 count  = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+template <typename T>
+struct SubsetSpan
+{
+    // a view of subsets of a single record;
+    // NOTE: is invalidated by any change of the pool
+
+    const T* first = nullptr;
+    const T* last  = nullptr;
+
+    inline const T*  data()                   const { return first; }
+    inline ptrdiff_t size()                   const { return last - first; }
+    inline bool      empty()                  const { return first == last; }
+    inline const T*  begin()                  const { return first; }
+    inline const T*  end()                    const { return last; }
+    inline const T&  operator[](ptrdiff_t i)  const { return first[i]; }
+};
+
+///////////////////////////////////////////////////////////
+
+template <typename T>
+class SubsetPool
+{
+public:
+    inline size             GetNumRecords()              const { return ranges_.size(); }
+    inline size             GetSize()                    const { return pool_.size(); }
+    inline uint32           GetCount(const index idx)    const { return ranges_[idx].count; }
+    inline T*               Get     (const index idx)          { return pool_.data() + ranges_[idx].offset; }
+    inline const T*         Get     (const index idx)    const { return pool_.data() + ranges_[idx].offset; }
+    inline const cvector<T>& GetPool()                   const { return pool_; }
+    inline const cvector<SubsetRange>& GetRanges()       const { return ranges_; }
+
+    inline SubsetSpan<T> GetSpan(const index idx) const
+    {
+        const T* first = Get(idx);
+        return { first, first + ranges_[idx].count };
+    }
+
+    inline void Clear()
+    {
+        ranges_.clear();
+        pool_.clear();
+    }
+
+    // -----------------------------------------------------
+
+    void PushBack(const T* values, const uint32 count)
+    {
+        // add a record after all the others
+        ranges_.push_back({ (uint32)pool_.size(), count });
+
+        const size start = pool_.size();
+        pool_.resize(start + count);
+        std::copy(values, values + count, pool_.begin() + start);
+    }
+
+    // -----------------------------------------------------
+
+    void Assign(const uint32* counts, const size numRecords, const T* values)
+    {
+        // set all the records at once (for instance: after deserialization);
+        // values of the records go one after another
+
+        ranges_.resize(numRecords);
+        uint32 offset = 0;
+
+        for (index i = 0; i < numRecords; ++i)
+        {
+            ranges_[i] = { offset, counts[i] };
+            offset += counts[i];
+        }
+
+        pool_.resize(offset);
+        std::copy(values, values + offset, pool_.begin());
+    }
+
+    // -----------------------------------------------------
+
+    void InsertByIdxs(const cvector<index>& sortedIdxs, const T* values, const uint32 count)
+    {
+        // insert records which have the same subsets (count values for each);
+        // sortedIdxs are the final idxs of new records (see cvector::merge_sorted)
+
+        const size numNew     = sortedIdxs.size();
+        const size numRecords = ranges_.size() + numNew;
+
+        if (numNew == 0)
+            return;
+
+        tmpRanges_.resize(numRecords);
+        tmpPool_.resize(pool_.size() + numNew * count);
+
+        uint32 offset = 0;
+
+        for (index i = 0, oldIdx = 0, newIdx = 0; i < numRecords; ++i)
+        {
+            if ((newIdx < numNew) && (sortedIdxs[newIdx] == i))
+            {
+                std::copy(values, values + count, tmpPool_.begin() + offset);
+                tmpRanges_[i] = { offset, count };
+                ++newIdx;
+            }
+            else
+            {
+                const SubsetRange& range = ranges_[oldIdx++];
+                const T*           src   = pool_.data() + range.offset;
+
+                std::copy(src, src + range.count, tmpPool_.begin() + offset);
+                tmpRanges_[i] = { offset, range.count };
+            }
+
+            offset += tmpRanges_[i].count;
+        }
+
+        std::swap(ranges_, tmpRanges_);
+        std::swap(pool_,   tmpPool_);
+    }
+
+    // -----------------------------------------------------
+
+    void EraseByIdxs(const cvector<index>& sortedIdxs)
+    {
+        // remove records by idxs and compact the pool in-place
+
+        if (sortedIdxs.empty())
+            return;
+
+        const size numRecords = ranges_.size();
+        uint32 offset = ranges_[sortedIdxs[0]].offset;
+        index  dst    = sortedIdxs[0];
+
+        for (index i = sortedIdxs[0], delIdx = 0; i < numRecords; ++i)
+        {
+            if ((delIdx < sortedIdxs.size()) && (sortedIdxs[delIdx] == i))
+            {
+                ++delIdx;
+                continue;
+            }
+
+            const SubsetRange range = ranges_[i];
+            std::copy(pool_.begin() + range.offset, pool_.begin() + range.offset + range.count, pool_.begin() + offset);
+
+            ranges_[dst++] = { offset, range.count };
+            offset += range.count;
+        }
+
+        ranges_.resize(dst);
+        pool_.resize(offset);
+    }
+
+private:
+    cvector<SubsetRange> ranges_;       // per record (by idx)
+    cvector<T>           pool_;         // subsets of all the records
+    cvector<SubsetRange> tmpRanges_;
+    cvector<T>           tmpPool_;
+};
+
+} // namespace ECS
@@ -0,0 +1,157 @@
+// =================================================================================
+// Filename:     SystemScheduler.cpp
+// Description:  implementation of the SystemScheduler's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "SystemScheduler.h"
+#include <Profiler.h>
+
+#pragma warning (disable : 4996)
+
+
+namespace ECS
+{
+
+SystemScheduler::SystemScheduler()
+{
+}
+
+///////////////////////////////////////////////////////////
+
+SystemScheduler::~SystemScheduler()
+{
+}
+
+///////////////////////////////////////////////////////////
+
+void SystemScheduler::AddTask(
+    const char* name,
+    const ComponentBitfield reads,
+    const ComponentBitfield writes,
+    TaskFunc&& func)
+{
+    CAssert::True(name != nullptr,  "input name of the task == nullptr");
+    CAssert::True(func != nullptr,  "input function of the task is empty");
+
+    Task task;
+    task.name   = name;
+    task.reads  = reads;
+    task.writes = writes;
+    task.func   = std::move(func);
+
+    tasks_.push_back(std::move(task));
+    isGraphBuilt_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void SystemScheduler::Execute()
+{
+    // run tasks without dependencies; each finished task starts
+    // its dependents when it was the last dependency for them
+
+    const int numTasks = (int)tasks_.size();
+
+    if (numTasks == 0)
+        return;
+
+    if (!isGraphBuilt_)
+        BuildGraph();
+
+    for (int i = 0; i < numTasks; ++i)
+        numDepsLeft_[i].store(tasks_[i].numDeps, std::memory_order_relaxed);
+
+    JobCounter counter;
+
+    for (int i = 0; i < numTasks; ++i)
+    {
+        if (tasks_[i].numDeps == 0)
+            RunTask(i, counter);
+    }
+
+    g_JobSystem.Wait(counter);
+}
+
+///////////////////////////////////////////////////////////
+
+void SystemScheduler::Clear()
+{
+    tasks_.clear();
+    numDepsLeft_.reset();
+    isGraphBuilt_ = false;
+}
+
+
+// =================================================================================
+// PRIVATE HELPERS
+// =================================================================================
+void SystemScheduler::BuildGraph()
+{
+    // make an edge from each task to each later task with conflicting components
+
+    const int numTasks = (int)tasks_.size();
+
+    for (Task& task : tasks_)
+    {
+        task.dependents.clear();
+        task.numDeps = 0;
+    }
+
+    for (int i = 0; i < numTasks; ++i)
+    {
+        for (int j = i + 1; j < numTasks; ++j)
+        {
+            if (HasConflict(tasks_[i], tasks_[j]))
+            {
+                tasks_[i].dependents.push_back(j);
+                tasks_[j].numDeps++;
+            }
+        }
+    }
+
+    numDepsLeft_ = std::make_unique<std::atomic<int>[]>(numTasks);
+    isGraphBuilt_ = true;
+
+    for (int i = 0; i < numTasks; ++i)
+    {
+        sprintf(g_String, "update task: %-20s  (dependencies: %d)", tasks_[i].name, tasks_[i].numDeps);
+        LogDbg(g_String);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void SystemScheduler::RunTask(const int taskIdx, JobCounter& counter)
+{
+    g_JobSystem.Run([this, taskIdx, &counter]()
+    {
+        Task& task = tasks_[taskIdx];
+
+        // tasks are executed by workers so their memory is tagged here
+        MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+        try
+        {
+            PROFILE_SCOPE(task.name);
+            task.func();
+        }
+        catch (EngineException& e)
+        {
+            LogErr(e);
+            sprintf(g_String, "update task failed: %s", task.name);
+            LogErr(g_String);
+        }
+
+        // start dependents which have no more unfinished dependencies
+        for (const int dependentIdx : task.dependents)
+        {
+            if (numDepsLeft_[dependentIdx].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                RunTask(dependentIdx, counter);
+        }
+    },
+    &counter);
+}
+
+} // namespace ECS
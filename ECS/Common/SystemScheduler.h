@@ -0,0 +1,82 @@
+// =================================================================================
+// Filename:     SystemScheduler.h
+// Description:  a scheduler of ECS systems updates;
+//
+//               each update task declares a set of components which it reads
+//               and a set of components which it writes; using these sets we
+//               build a dependency graph (DAG) between tasks and execute it
+//               on the job system, so tasks which touch disjoint components
+//               are executed concurrently
+//
+//               a task depends on each previously added task if:
+//               - one of them writes a component which is read/written by another
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <JobSystem.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace ECS
+{
+
+class SystemScheduler
+{
+public:
+    using TaskFunc = std::function<void()>;
+
+    SystemScheduler();
+    ~SystemScheduler();
+
+    // restrict copying
+    SystemScheduler(const SystemScheduler&) = delete;
+    SystemScheduler& operator=(const SystemScheduler&) = delete;
+
+    // NOTE: the order of adding is important: tasks with conflicting
+    //       component sets are executed in the order of adding
+    void AddTask(
+        const char* name,
+        const ComponentBitfield reads,
+        const ComponentBitfield writes,
+        TaskFunc&& func);
+
+    // execute all the tasks according to the dependency graph;
+    // returns when all the tasks are done
+    void Execute();
+
+    void Clear();
+
+    inline size GetNumTasks() const { return tasks_.size(); }
+
+private:
+    struct Task
+    {
+        const char*       name = nullptr;
+        ComponentBitfield reads  = 0;
+        ComponentBitfield writes = 0;
+        TaskFunc          func;
+        cvector<int>      dependents;         // tasks which must wait for this one
+        int               numDeps = 0;        // the number of tasks we must wait for
+    };
+
+    void BuildGraph();
+    void RunTask(const int taskIdx, JobCounter& counter);
+
+    inline bool HasConflict(const Task& t1, const Task& t2) const
+    {
+        return (t1.writes & (t2.reads | t2.writes)) || (t2.writes & t1.reads);
+    }
+
+private:
+    cvector<Task>                       tasks_;
+    std::unique_ptr<std::atomic<int>[]> numDepsLeft_;     // per task: the number of not finished dependencies during execution
+    bool                                isGraphBuilt_ = false;
+};
+
+} // namespace ECS
@@ -0,0 +1,677 @@
+// =================================================================================
+// Filename:     WorldFile.cpp
+// Description:  implementation of the world file writer/reader
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "WorldFile.h"
+
+#pragma warning (disable : 4996)
+
+
+namespace ECS
+{
+
+//---------------------------------------------------------
+// Desc:  FNV-1a hash of data of a chunk
+//---------------------------------------------------------
+static uint64 HashBytes(const uint8* pData, const uint64 numBytes)
+{
+    uint64 hash = 14695981039346656037ULL;
+
+    for (uint64 i = 0; i < numBytes; ++i)
+    {
+        hash ^= pData[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+//---------------------------------------------------------
+// Desc:  make a path to the file inside the world directory
+//---------------------------------------------------------
+static void MakeDirFilePath(
+    char* outPath,
+    const size outSize,
+    const char* dirPath,
+    const char* filename)
+{
+    const size   len = strlen(dirPath);
+    const bool   hasSlash = (len > 0) && ((dirPath[len-1] == '/') || (dirPath[len-1] == '\\'));
+    const char*  separator = (hasSlash) ? "" : "/";
+
+    snprintf(outPath, outSize, "%s%s%s", dirPath, separator, filename);
+}
+
+//---------------------------------------------------------
+// Desc:  make a path to the file of the chunk: the name contains the type
+//        and the hash of chunk's data so a changed chunk never overwrites
+//        the file which is used by the current manifest
+//---------------------------------------------------------
+static void MakeChunkFilePath(
+    char* outPath,
+    const size outSize,
+    const char* dirPath,
+    const WorldChunkFileDesc& desc)
+{
+    char filename[64]{ '\0' };
+    snprintf(filename, sizeof(filename), "chunk_%u_%016llx.bin", desc.type, (unsigned long long)desc.hash);
+
+    MakeDirFilePath(outPath, outSize, dirPath, filename);
+}
+
+//---------------------------------------------------------
+// Desc:  check if there is the same chunk in the manifest
+//---------------------------------------------------------
+static bool HasChunk(const cvector<WorldChunkFileDesc>& manifest, const WorldChunkFileDesc& desc)
+{
+    for (const WorldChunkFileDesc& other : manifest)
+    {
+        if ((other.type    == desc.type) &&
+            (other.version == desc.version) &&
+            (other.size    == desc.size) &&
+            (other.hash    == desc.hash))
+            return true;
+    }
+
+    return false;
+}
+
+//---------------------------------------------------------
+// Desc:  write a block of data into the file (the file is rewritten)
+//---------------------------------------------------------
+static bool WriteFileData(const char* filepath, const void* pData, const uint64 numBytes)
+{
+    FILE* pFile = fopen(filepath, "wb");
+
+    if (!pFile)
+        return false;
+
+    const bool result = (numBytes == 0) || (fwrite(pData, 1, (size_t)numBytes, pFile) == (size_t)numBytes);
+    fclose(pFile);
+
+    return result;
+}
+
+// =================================================================================
+// WRITER
+// =================================================================================
+void WorldFileWriter::BeginChunk(const uint32 type, const uint32 version)
+{
+    CAssert::True(!isChunkOpened_, "can't begin a new chunk: the previous one isn't ended");
+
+    WorldChunkDesc desc;
+    desc.type    = type;
+    desc.version = version;
+    desc.offset  = (uint64)data_.size();
+
+    chunks_.push_back(desc);
+    isChunkOpened_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldFileWriter::EndChunk()
+{
+    CAssert::True(isChunkOpened_, "can't end a chunk: there is no opened chunk");
+
+    WorldChunkDesc& desc = chunks_.back();
+    desc.size = (uint64)data_.size() - desc.offset;
+
+    isChunkOpened_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+bool WorldFileWriter::SaveToFile(const char* filepath) const
+{
+    // write the header, the table of chunks (with absolute offsets), and all the data
+
+    if (!filepath || filepath[0] == '\0')
+    {
+        LogErr("input path to the world file is empty");
+        return false;
+    }
+
+    if (isChunkOpened_)
+    {
+        LogErr("can't save the world file: the last chunk isn't ended");
+        return false;
+    }
+
+    FILE* pFile = fopen(filepath, "wb");
+
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open the world file for writing: %s", filepath);
+        LogErr(g_String);
+        return false;
+    }
+
+    WorldFileHeader header;
+    header.numChunks = (uint32)chunks_.size();
+
+    // the data of chunks starts right after the table (aligned)
+    const uint64 tableSize   = sizeof(WorldChunkDesc) * chunks_.size();
+    const uint64 dataOffset  = (sizeof(WorldFileHeader) + tableSize + WORLD_FILE_ALIGNMENT - 1) & ~(uint64)(WORLD_FILE_ALIGNMENT - 1);
+    const uint64 paddingSize = dataOffset - sizeof(WorldFileHeader) - tableSize;
+
+    cvector<WorldChunkDesc> table = chunks_;
+
+    for (WorldChunkDesc& desc : table)
+        desc.offset += dataOffset;
+
+    const uint8 padding[WORLD_FILE_ALIGNMENT]{ 0 };
+
+    bool result = true;
+    result &= (fwrite(&header, sizeof(header), 1, pFile) == 1);
+    result &= (fwrite(table.data(), sizeof(WorldChunkDesc), table.size(), pFile) == (size_t)table.size());
+    result &= (fwrite(padding, 1, paddingSize, pFile) == paddingSize);
+    result &= (fwrite(data_.data(), 1, data_.size(), pFile) == (size_t)data_.size());
+
+    fclose(pFile);
+
+    if (!result)
+    {
+        sprintf(g_String, "can't write data into the world file: %s", filepath);
+        LogErr(g_String);
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////
+
+int WorldFileWriter::SaveToDir(
+    const char* dirPath,
+    const cvector<WorldChunkFileDesc>& prevManifest,
+    cvector<WorldChunkFileDesc>& outManifest) const
+{
+    char msg[320]{ '\0' };
+    char path[256]{ '\0' };
+
+    if (!dirPath || dirPath[0] == '\0')
+    {
+        LogErr("input path to the world directory is empty");
+        return -1;
+    }
+
+    if (isChunkOpened_)
+    {
+        LogErr("can't save the world directory: the last chunk isn't ended");
+        return -1;
+    }
+
+    // write the changed chunks (unchanged ones already have their files)
+    int  numWritten  = 0;
+    bool isSameTable = (prevManifest.size() == chunks_.size());
+
+    outManifest.resize(chunks_.size());
+
+    for (index i = 0; i < chunks_.size(); ++i)
+    {
+        const WorldChunkDesc& chunk = chunks_[i];
+        WorldChunkFileDesc&   desc  = outManifest[i];
+
+        desc.type    = chunk.type;
+        desc.version = chunk.version;
+        desc.size    = chunk.size;
+        desc.hash    = HashBytes(data_.data() + chunk.offset, chunk.size);
+
+        if (isSameTable)
+        {
+            const WorldChunkFileDesc& prev = prevManifest[i];
+            isSameTable = (prev.type == desc.type) && (prev.version == desc.version) && (prev.size == desc.size) && (prev.hash == desc.hash);
+        }
+
+        if (HasChunk(prevManifest, desc))
+            continue;
+
+        MakeChunkFilePath(path, sizeof(path), dirPath, desc);
+
+        if (!WriteFileData(path, data_.data() + chunk.offset, chunk.size))
+        {
+            snprintf(msg, sizeof(msg), "can't write a chunk of the world: %s", path);
+            LogErr(msg);
+            return -1;
+        }
+
+        ++numWritten;
+    }
+
+    // nothing is changed since the previous save
+    if (isSameTable)
+        return 0;
+
+    // the new manifest replaces the previous one only when all its chunks are written
+    WorldFileHeader header;
+    header.magic     = WORLD_DIR_MAGIC;
+    header.numChunks = (uint32)outManifest.size();
+
+    char manifestPath[256]{ '\0' };
+    char tmpPath[256]{ '\0' };
+    MakeDirFilePath(manifestPath, sizeof(manifestPath), dirPath, WORLD_DIR_MANIFEST_NAME);
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", manifestPath);
+
+    FILE* pFile = fopen(tmpPath, "wb");
+
+    if (!pFile)
+    {
+        snprintf(msg, sizeof(msg), "can't open the manifest of the world for writing: %s", tmpPath);
+        LogErr(msg);
+        return -1;
+    }
+
+    bool result = true;
+    result &= (fwrite(&header, sizeof(header), 1, pFile) == 1);
+    result &= (fwrite(outManifest.data(), sizeof(WorldChunkFileDesc), outManifest.size(), pFile) == (size_t)outManifest.size());
+    fclose(pFile);
+
+    remove(manifestPath);
+
+    if (!result || (rename(tmpPath, manifestPath) != 0))
+    {
+        snprintf(msg, sizeof(msg), "can't write the manifest of the world: %s", manifestPath);
+        LogErr(msg);
+        return -1;
+    }
+
+    // remove files of chunks which aren't used by the new manifest
+    for (const WorldChunkFileDesc& prev : prevManifest)
+    {
+        if (HasChunk(outManifest, prev))
+            continue;
+
+        MakeChunkFilePath(path, sizeof(path), dirPath, prev);
+        remove(path);
+    }
+
+    return numWritten;
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldFileWriter::Clear()
+{
+    chunks_.clear();
+    data_.clear();
+    isChunkOpened_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldFileWriter::WriteBytes(const void* pData, const size numBytes)
+{
+    if (numBytes <= 0)
+        return;
+
+    const size offset = data_.size();
+    data_.resize(offset + numBytes);
+    memcpy(data_.data() + offset, pData, numBytes);
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldFileWriter::AlignData()
+{
+    // add padding so the next block will be aligned
+
+    const size currSize    = data_.size();
+    const size alignedSize = (currSize + WORLD_FILE_ALIGNMENT - 1) & ~(size)(WORLD_FILE_ALIGNMENT - 1);
+
+    data_.resize(alignedSize);
+
+    for (index i = currSize; i < alignedSize; ++i)
+        data_[i] = 0;
+}
+
+
+// =================================================================================
+// READER
+// =================================================================================
+bool WorldFileReader::LoadFromFile(const char* filepath)
+{
+    // read the whole file with a single call and validate its header and table of chunks
+
+    if (!filepath || filepath[0] == '\0')
+    {
+        LogErr("input path to the world file is empty");
+        return false;
+    }
+
+    FILE* pFile = fopen(filepath, "rb");
+
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open the world file for reading: %s", filepath);
+        LogErr(g_String);
+        return false;
+    }
+
+    fseek(pFile, 0, SEEK_END);
+    const long fileSize = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    if (fileSize < (long)sizeof(WorldFileHeader))
+    {
+        fclose(pFile);
+        sprintf(g_String, "the world file is corrupted: %s", filepath);
+        LogErr(g_String);
+        return false;
+    }
+
+    data_.resize(fileSize);
+    const size_t numReadBytes = fread(data_.data(), 1, fileSize, pFile);
+    fclose(pFile);
+
+    if (numReadBytes != (size_t)fileSize)
+    {
+        sprintf(g_String, "can't read the world file: %s", filepath);
+        LogErr(g_String);
+        return false;
+    }
+
+    // check the header
+    const WorldFileHeader* pHeader = (const WorldFileHeader*)data_.data();
+
+    if (pHeader->magic != WORLD_FILE_MAGIC)
+    {
+        sprintf(g_String, "it isn't a world file: %s", filepath);
+        LogErr(g_String);
+        return false;
+    }
+
+    if (pHeader->version != WORLD_FILE_VERSION)
+    {
+        sprintf(g_String, "unsupported version of the world file (%u, expected: %u): %s", pHeader->version, WORLD_FILE_VERSION, filepath);
+        LogErr(g_String);
+        return false;
+    }
+
+    // check the table of chunks
+    const uint64 tableEnd = sizeof(WorldFileHeader) + sizeof(WorldChunkDesc) * (uint64)pHeader->numChunks;
+
+    if (tableEnd > (uint64)fileSize)
+    {
+        sprintf(g_String, "the world file is corrupted (invalid table of chunks): %s", filepath);
+        LogErr(g_String);
+        return false;
+    }
+
+    numChunks_ = pHeader->numChunks;
+    pChunks_   = (const WorldChunkDesc*)(data_.data() + sizeof(WorldFileHeader));
+
+    for (uint32 i = 0; i < numChunks_; ++i)
+    {
+        if (pChunks_[i].offset + pChunks_[i].size > (uint64)fileSize)
+        {
+            sprintf(g_String, "the world file is corrupted (invalid chunk: %u): %s", pChunks_[i].type, filepath);
+            LogErr(g_String);
+            return false;
+        }
+    }
+
+    pCurrChunk_ = nullptr;
+    cursor_     = 0;
+    chunkEnd_   = 0;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool WorldFileReader::LoadFromDir(const char* dirPath)
+{
+    // chunks are placed in memory in the same way as in a single
+    // world file so the reading code doesn't depend on the source
+
+    cvector<WorldChunkFileDesc> manifest;
+
+    if (!ReadManifest(dirPath, manifest))
+    {
+        sprintf(g_String, "can't read the manifest of the world directory: %s", dirPath);
+        LogErr(g_String);
+        return false;
+    }
+
+    const uint64 numChunks = (uint64)manifest.size();
+    const uint64 tableSize = sizeof(WorldChunkDesc) * numChunks;
+    uint64       offset    = (sizeof(WorldFileHeader) + tableSize + WORLD_FILE_ALIGNMENT - 1) & ~(uint64)(WORLD_FILE_ALIGNMENT - 1);
+
+    cvector<WorldChunkDesc> table(manifest.size());
+
+    for (index i = 0; i < manifest.size(); ++i)
+    {
+        table[i].type    = manifest[i].type;
+        table[i].version = manifest[i].version;
+        table[i].offset  = offset;
+        table[i].size    = manifest[i].size;
+
+        offset = (offset + manifest[i].size + WORLD_FILE_ALIGNMENT - 1) & ~(uint64)(WORLD_FILE_ALIGNMENT - 1);
+    }
+
+    WorldFileHeader header;
+    header.numChunks = (uint32)numChunks;
+
+    data_.resize((size)offset);
+    memcpy(data_.data(), &header, sizeof(header));
+    memcpy(data_.data() + sizeof(header), table.data(), tableSize);
+
+    char path[256]{ '\0' };
+
+    for (index i = 0; i < manifest.size(); ++i)
+    {
+        MakeChunkFilePath(path, sizeof(path), dirPath, manifest[i]);
+
+        FILE* pFile = fopen(path, "rb");
+
+        if (!pFile)
+        {
+            sprintf(g_String, "can't open a chunk of the world: %s", path);
+            LogErr(g_String);
+            return false;
+        }
+
+        fseek(pFile, 0, SEEK_END);
+        const long fileSize = ftell(pFile);
+        fseek(pFile, 0, SEEK_SET);
+
+        const size_t numBytes = (size_t)table[i].size;
+        const bool   result   = (fileSize == (long)numBytes) && (fread(data_.data() + table[i].offset, 1, numBytes, pFile) == numBytes);
+        fclose(pFile);
+
+        if (!result)
+        {
+            sprintf(g_String, "a chunk of the world is corrupted: %s", path);
+            LogErr(g_String);
+            return false;
+        }
+    }
+
+    numChunks_  = header.numChunks;
+    pChunks_    = (const WorldChunkDesc*)(data_.data() + sizeof(WorldFileHeader));
+    pCurrChunk_ = nullptr;
+    cursor_     = 0;
+    chunkEnd_   = 0;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool WorldFileReader::LoadFromMemory(const WorldFileWriter& writer)
+{
+    // place the header and the table of chunks in front of the writer's data
+    // so it is a single memcpy of all the chunks
+
+    const cvector<WorldChunkDesc>& chunks = writer.GetChunks();
+    const cvector<uint8>&          data   = writer.GetData();
+
+    if (chunks.empty())
+    {
+        LogErr("can't load the world from memory: there are no chunks");
+        return false;
+    }
+
+    const uint64 tableSize  = sizeof(WorldChunkDesc) * (uint64)chunks.size();
+    const uint64 dataOffset = (sizeof(WorldFileHeader) + tableSize + WORLD_FILE_ALIGNMENT - 1) & ~(uint64)(WORLD_FILE_ALIGNMENT - 1);
+
+    WorldFileHeader header;
+    header.numChunks = (uint32)chunks.size();
+
+    data_.resize((size)(dataOffset + data.size()));
+    memcpy(data_.data(), &header, sizeof(header));
+    memcpy(data_.data() + dataOffset, data.data(), data.size());
+
+    WorldChunkDesc* pTable = (WorldChunkDesc*)(data_.data() + sizeof(WorldFileHeader));
+
+    for (index i = 0; i < chunks.size(); ++i)
+    {
+        pTable[i]         = chunks[i];
+        pTable[i].offset += dataOffset;
+    }
+
+    numChunks_  = header.numChunks;
+    pChunks_    = pTable;
+    pCurrChunk_ = nullptr;
+    cursor_     = 0;
+    chunkEnd_   = 0;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool WorldFileReader::ReadManifest(const char* dirPath, cvector<WorldChunkFileDesc>& outManifest)
+{
+    // NOTE: can be executed by any thread (g_String isn't used)
+
+    outManifest.clear();
+
+    if (!dirPath || dirPath[0] == '\0')
+        return false;
+
+    char path[256]{ '\0' };
+    MakeDirFilePath(path, sizeof(path), dirPath, WORLD_DIR_MANIFEST_NAME);
+
+    FILE* pFile = fopen(path, "rb");
+
+    if (!pFile)
+        return false;
+
+    WorldFileHeader header;
+    bool result = (fread(&header, sizeof(header), 1, pFile) == 1);
+    result &= (header.magic == WORLD_DIR_MAGIC) && (header.version == WORLD_FILE_VERSION);
+
+    if (result)
+    {
+        outManifest.resize(header.numChunks);
+        result &= (fread(outManifest.data(), sizeof(WorldChunkFileDesc), header.numChunks, pFile) == (size_t)header.numChunks);
+    }
+
+    fclose(pFile);
+
+    if (!result)
+    {
+        char msg[320]{ '\0' };
+        snprintf(msg, sizeof(msg), "the manifest of the world is corrupted or of unsupported version: %s", path);
+        LogErr(msg);
+        outManifest.clear();
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////
+
+bool WorldFileReader::IsWorldDir(const char* path)
+{
+    if (!path || path[0] == '\0')
+        return false;
+
+    char manifestPath[256]{ '\0' };
+    MakeDirFilePath(manifestPath, sizeof(manifestPath), path, WORLD_DIR_MANIFEST_NAME);
+
+    FILE* pFile = fopen(manifestPath, "rb");
+
+    if (!pFile)
+        return false;
+
+    fclose(pFile);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool WorldFileReader::BeginChunk(const uint32 type)
+{
+    for (uint32 i = 0; i < numChunks_; ++i)
+    {
+        if (pChunks_[i].type == type)
+        {
+            pCurrChunk_ = pChunks_ + i;
+            cursor_     = pCurrChunk_->offset;
+            chunkEnd_   = pCurrChunk_->offset + pCurrChunk_->size;
+            return true;
+        }
+    }
+
+    pCurrChunk_ = nullptr;
+    cursor_     = 0;
+    chunkEnd_   = 0;
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+const WorldArrayHeader* WorldFileReader::ReadArrayHeader(const uint32 elemSize)
+{
+    // read a header of the next array in the current chunk and check
+    // if the array's data fits into the chunk; return nullptr if something is wrong
+
+    if (!pCurrChunk_)
+    {
+        LogErr("there is no opened chunk to read from");
+        return nullptr;
+    }
+
+    if (cursor_ + sizeof(WorldArrayHeader) > chunkEnd_)
+    {
+        sprintf(g_String, "unexpected end of the world chunk (type: %u)", pCurrChunk_->type);
+        LogErr(g_String);
+        return nullptr;
+    }
+
+    const WorldArrayHeader* pHeader = (const WorldArrayHeader*)GetCurrPtr();
+
+    if (pHeader->elemSize != elemSize)
+    {
+        sprintf(g_String, "layout of the world chunk (type: %u) doesn't match: elem size %u (expected: %u)", pCurrChunk_->type, pHeader->elemSize, elemSize);
+        LogErr(g_String);
+        return nullptr;
+    }
+
+    if (cursor_ + sizeof(WorldArrayHeader) + pHeader->count * elemSize > chunkEnd_)
+    {
+        sprintf(g_String, "the world chunk (type: %u) is corrupted", pCurrChunk_->type);
+        LogErr(g_String);
+        return nullptr;
+    }
+
+    cursor_ += sizeof(WorldArrayHeader);
+    return pHeader;
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldFileReader::Skip(const uint64 numBytes)
+{
+    // move to the next aligned array
+    cursor_ += numBytes;
+    cursor_  = (cursor_ + WORLD_FILE_ALIGNMENT - 1) & ~(uint64)(WORLD_FILE_ALIGNMENT - 1);
+}
+
+} // namespace ECS
@@ -0,0 +1,227 @@
+// =================================================================================
+// Filename:     WorldFile.h
+// Description:  a versioned binary format of the ECS world data:
+//
+//               [header][table of chunks][chunk_0][chunk_1]...[chunk_N]
+//
+//               each chunk contains data of a single component (or of the
+//               entity manager itself) as a sequence of arrays; each array is
+//               stored as a contiguous POD block aligned to WORLD_FILE_ALIGNMENT
+//               so the file can be memory-mapped and arrays can be bulk-copied
+//               right into the cvector storage of components
+//
+//               the same chunks can be stored as a world directory (for differential
+//               saving): each chunk is a separate file named by the hash of its data
+//               and the manifest contains the table of chunks; so a save writes only
+//               the changed chunks and unchanged files aren't touched at all
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <string.h>
+#include <type_traits>
+
+namespace ECS
+{
+
+constexpr uint32 WORLD_FILE_MAGIC     = 0x46574544;     // "DEWF" (doors engine world file)
+constexpr uint32 WORLD_FILE_VERSION   = 1;
+constexpr uint32 WORLD_FILE_ALIGNMENT = 16;
+constexpr uint32 WORLD_DIR_MAGIC      = 0x4D574544;     // "DEWM" (doors engine world manifest)
+constexpr const char* WORLD_DIR_MANIFEST_NAME = "manifest.dewm";
+
+///////////////////////////////////////////////////////////
+
+struct WorldFileHeader
+{
+    uint32 magic     = WORLD_FILE_MAGIC;
+    uint32 version   = WORLD_FILE_VERSION;
+    uint32 numChunks = 0;
+    uint32 reserved  = 0;
+};
+
+struct WorldChunkDesc
+{
+    uint32 type    = 0;          // eComponentType or some special chunk marker
+    uint32 version = 0;          // version of the chunk's layout
+    uint64 offset  = 0;          // offset in bytes from the beginning of the file
+    uint64 size    = 0;          // size of the chunk in bytes
+};
+
+// a record of the world directory's manifest
+struct WorldChunkFileDesc
+{
+    uint32 type    = 0;
+    uint32 version = 0;
+    uint64 size    = 0;          // size of the chunk in bytes
+    uint64 hash    = 0;          // FNV-1a hash of chunk's data (is a part of the chunk's filename)
+};
+
+struct WorldArrayHeader
+{
+    uint64 count    = 0;         // the number of elements
+    uint32 elemSize = 0;         // sizeof of a single element (to detect layout changes)
+    uint32 reserved = 0;
+};
+
+
+// =================================================================================
+// WRITER
+// =================================================================================
+class WorldFileWriter
+{
+public:
+    void BeginChunk(const uint32 type, const uint32 version = 1);
+    void EndChunk();
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        WriteArray(&value, 1);
+    }
+
+    template <typename T>
+    void WriteArray(const cvector<T>& arr)
+    {
+        WriteArray(arr.data(), arr.size());
+    }
+
+    template <typename T>
+    void WriteArray(const T* data, const size count)
+    {
+        static_assert(std::is_standard_layout_v<T>, "only POD data can be written as a block");
+
+        WorldArrayHeader header;
+        header.count    = (uint64)count;
+        header.elemSize = (uint32)sizeof(T);
+
+        WriteBytes(&header, sizeof(header));
+        WriteBytes(data, sizeof(T) * count);
+        AlignData();
+    }
+
+    bool SaveToFile(const char* filepath) const;
+
+    // save chunks into the world directory (it must exist); a chunk is written only
+    // if there is no chunk with the same hash in the prevManifest (the manifest
+    // of the previous save into this directory); files of chunks which aren't
+    // used anymore are removed after the new manifest is written;
+    // NOTE: can be executed by any thread (g_String isn't used)
+    // return: the number of written chunks or -1 if failed
+    int SaveToDir(
+        const char* dirPath,
+        const cvector<WorldChunkFileDesc>& prevManifest,
+        cvector<WorldChunkFileDesc>& outManifest) const;
+
+    // drop all the chunks but keep the memory (so a snapshot is retaken without allocations)
+    void Clear();
+
+    inline size                           GetDataSize() const { return data_.size(); }
+    inline const cvector<WorldChunkDesc>& GetChunks()   const { return chunks_; }
+    inline const cvector<uint8>&          GetData()     const { return data_; }
+
+private:
+    void WriteBytes(const void* pData, const size numBytes);
+    void AlignData();
+
+private:
+    cvector<WorldChunkDesc> chunks_;
+    cvector<uint8>          data_;              // data of all the chunks (offsets are relative to the first chunk)
+    bool                    isChunkOpened_ = false;
+};
+
+
+// =================================================================================
+// READER
+// =================================================================================
+class WorldFileReader
+{
+public:
+    bool LoadFromFile(const char* filepath);
+
+    // load all the chunks of the world directory (see WorldFileWriter::SaveToDir)
+    // so they are read in the same way as from a single world file
+    bool LoadFromDir(const char* dirPath);
+
+    // take chunks right from the memory of the writer (a snapshot of the world)
+    // so they are read in the same way as from a world file too
+    bool LoadFromMemory(const WorldFileWriter& writer);
+
+    // read the table of chunks of the world directory; returns false if there is no manifest
+    static bool ReadManifest(const char* dirPath, cvector<WorldChunkFileDesc>& outManifest);
+    static bool IsWorldDir  (const char* path);
+
+    // move the reading cursor to the beginning of the chunk by type;
+    // return false if there is no such chunk in the file
+    bool BeginChunk(const uint32 type);
+
+    inline uint32 GetChunkVersion() const { return pCurrChunk_ ? pCurrChunk_->version : 0; }
+
+    template <typename T>
+    bool Read(T& outValue)
+    {
+        const T* pData = nullptr;
+
+        if (!ReadArray(pData, 1))
+            return false;
+
+        memcpy(&outValue, pData, sizeof(T));
+        return true;
+    }
+
+    template <typename T>
+    bool ReadArray(cvector<T>& outArr)
+    {
+        // bulk copy of the array block into the cvector
+        static_assert(std::is_standard_layout_v<T>, "only POD data can be read as a block");
+
+        const WorldArrayHeader* pHeader = ReadArrayHeader(sizeof(T));
+
+        if (!pHeader)
+            return false;
+
+        outArr.resize((size)pHeader->count);
+
+        if (pHeader->count > 0)
+            memcpy(outArr.data(), GetCurrPtr(), sizeof(T) * pHeader->count);
+
+        Skip(sizeof(T) * pHeader->count);
+        return true;
+    }
+
+    template <typename T>
+    bool ReadArray(const T*& outData, const size expectedCount)
+    {
+        // get a ptr to the array right in the loaded file memory (without copying)
+        static_assert(std::is_standard_layout_v<T>, "only POD data can be read as a block");
+
+        const WorldArrayHeader* pHeader = ReadArrayHeader(sizeof(T));
+
+        if (!pHeader || ((expectedCount >= 0) && (pHeader->count != (uint64)expectedCount)))
+            return false;
+
+        outData = (const T*)GetCurrPtr();
+        Skip(sizeof(T) * pHeader->count);
+
+        return true;
+    }
+
+private:
+    const WorldArrayHeader* ReadArrayHeader(const uint32 elemSize);
+
+    inline const uint8* GetCurrPtr() const { return data_.data() + cursor_; }
+    void Skip(const uint64 numBytes);
+
+private:
+    cvector<uint8>        data_;                 // the whole content of the file
+    const WorldChunkDesc* pChunks_    = nullptr;
+    const WorldChunkDesc* pCurrChunk_ = nullptr;
+    uint32                numChunks_  = 0;
+    uint64                cursor_     = 0;       // reading position inside the data_
+    uint64                chunkEnd_   = 0;       // the end of the current chunk
+};
+
+} // namespace ECS
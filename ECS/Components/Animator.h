@@ -0,0 +1,30 @@
+// =================================================================================
+// Filename:     Animator.h
+// Description:  an ECS component which contains playback states of skeletal
+//               animations: the clip of the entity's model which is played,
+//               the playback time and speed (clips are looped); poses themselves
+//               aren't computed on CPU (see SkinnedData and SkinnedCrowds)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Common/SparseSet.h"
+#include <Types.h>
+#include <cvector.h>
+
+
+namespace ECS
+{
+
+struct Animator
+{
+    cvector<EntityID> ids_;                       // entities IDs (SORTED)
+    cvector<uint16>   clipIdxs_;                  // an idx of the clip in the model's skinned data
+    cvector<float>    times_;                     // playback time in seconds (is wrapped by the clip's duration at rendering)
+    cvector<float>    speeds_;                    // playback rate (1 - the original speed)
+
+    SparseSet         sparseIdxs_;                // O(1) lookup: entity ID => data idx
+};
+
+} // namespace ECS
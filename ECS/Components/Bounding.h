@@ -6,6 +6,9 @@
 // =================================================================================
 #pragma once
 
+#include "../Common/SparseSet.h"
+#include "../Common/SubsetPool.h"
+#include "../Common/AABBTree.h"
 #include <Types.h>
 #include <cvector.h>
 #include <DirectXCollision.h>
@@ -24,36 +27,16 @@ enum BoundingType
 
 // ----------------------------------------------
 
-struct BoundingData
+struct BoundingWorldSoA
 {
-	// contains bounding data for each subset (mesh / submesh) of the entity
-	// NOTE: idx == 0 means subset_0
-	//       idx == 1 means subset_1
-	//       etc.
+	// world-space bounding volumes of the whole entity in SoA layout
+	// (by the same idx as Bounding::ids); are refreshed only for entts
+	// whose transformation was changed
 
-    BoundingData() {};
-
-	BoundingData(
-        DirectX::BoundingSphere sphere,        // around the whole entity
-		const size numData,
-		const BoundingType* types,             // AABB type per mesh
-		const DirectX::BoundingBox* AABBs) :
-        boundSphere(sphere),
-		types(types, types + numData)
-	{
-		obbs.resize(numData);
-
-		// convert each input AABB into OBB
-		for (index i = 0; i < numData; ++i)
-			DirectX::BoundingOrientedBox::CreateFromBoundingBox(obbs[i], AABBs[i]);
-	}
-
-    DirectX::BoundingSphere boundSphere;           // around the whole entity
-
-
-    cvector<BoundingType> types;                   // type per mesh: AABB/sphere
-	cvector<DirectX::BoundingOrientedBox> obbs;    // per mesh: center, extents, rotation
-}; 
+	cvector<float> sphereX, sphereY, sphereZ, sphereR;    // sphere: center + radius
+	cvector<float> minX, minY, minZ;                      // AABB: min point
+	cvector<float> maxX, maxY, maxZ;                      // AABB: max point
+};
 
 
 // =================================================================================
@@ -65,8 +48,19 @@ struct Bounding
 	// center  - center of the box / sphere; 
 	// extents - Distance from the center to each side OR radius of the sphere
 
-	cvector<EntityID>     ids;
-	cvector<BoundingData> data;
+	// local space: a sphere around the whole entity + bounding data for each
+	// subset (mesh / submesh) of the entity in flat pools (both pools have
+	// the same ranges: subset_0 of the entt is the first one of its range, etc.)
+	cvector<EntityID>                        ids;
+	cvector<DirectX::BoundingSphere>         spheres;
+	SubsetPool<BoundingType>                 types;    // type per mesh: AABB/sphere
+	SubsetPool<DirectX::BoundingOrientedBox> obbs;     // per mesh: center, extents, rotation
+
+	BoundingWorldSoA      world;         // world space (cache)
+	cvector<EntityID>     newIds;        // SORTED: entts whose world bounds aren't computed yet
+	AABBTree              tree;          // BVH over world AABBs (for frustum culling)
+
+	SparseSet             sparseIdxs;    // O(1) lookup: entity ID => data idx
 };
 
 
@@ -8,6 +8,7 @@
 
 #include "../Common/ECSTypes.h"
 #include <Types.h>
+#include <DirectXCollision.h>
 #include <map>
 
 
@@ -48,15 +49,49 @@ struct CameraData
 
 ///////////////////////////////////////////////////////////
 
+// world-space frustum planes in SoA layout (normals look inside): 6 planes are
+// padded to 8 by planes which never cull so they are tested by 4 per iteration
+struct FrustumPlanesSoA
+{
+    alignas(16) float nx[8];
+    alignas(16) float ny[8];
+    alignas(16) float nz[8];
+    alignas(16) float d[8];
+};
+
+///////////////////////////////////////////////////////////
+
+// derived data of the camera: is recomputed once per frame by UpdateView()
+// (and when the projection is changed) so its consumers don't rederive it;
+// isn't serialized
+struct CameraFrameData
+{
+    XMMATRIX viewProj    = DirectX::XMMatrixIdentity();
+    XMMATRIX invProj     = DirectX::XMMatrixIdentity();
+    XMMATRIX invViewProj = DirectX::XMMatrixIdentity();
+
+    DirectX::BoundingFrustum frustumV;            // in view space (built from the proj matrix)
+    DirectX::BoundingFrustum frustumW;            // in world space
+
+    // world-space planes in order: near, far, right, left, top, bottom
+    DirectX::XMFLOAT4 planesW[6];                 // normals look outside (as of BoundingFrustum)
+    DirectX::XMFLOAT4 innerPlanesW[6];            // normals look inside
+    FrustumPlanesSoA  planesSoA;                  // the inner planes for SIMD tests
+};
+
+///////////////////////////////////////////////////////////
+
 // ECS component
 struct Camera
 {
     Camera()
     {
         data.emplace(0, CameraData());
+        frameData.emplace(0, CameraFrameData());
     }
 
-    std::map<EntityID, CameraData> data;
+    std::map<EntityID, CameraData>      data;
+    std::map<EntityID, CameraFrameData> frameData;
 };
 
 }
@@ -0,0 +1,68 @@
+// =================================================================================
+// Filename:     Collider.h
+// Description:  an ECS component which contains collision shapes of entities:
+//               a sphere or an oriented box in local space (is taken from the
+//               Bounding component of the entity) along with world-space shapes
+//               and AABBs which are refreshed only for moved entts
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Common/SparseSet.h"
+#include <Types.h>
+#include <cvector.h>
+#include <DirectXCollision.h>
+
+
+namespace ECS
+{
+
+enum eColliderShape : uint8
+{
+    COLLIDER_SPHERE,
+    COLLIDER_OBB,
+};
+
+///////////////////////////////////////////////////////////
+
+struct ColliderData
+{
+    // local space shape of the collider (only one of them is used by the shape type)
+    DirectX::BoundingSphere      sphere;
+    DirectX::BoundingOrientedBox obb;
+
+    // a pair is tested only if: (layerA & maskB) && (layerB & maskA)
+    uint32   layer   = 1;
+    uint32   mask    = 0xFFFFFFFF;
+    uint8    shape   = COLLIDER_SPHERE;           // eColliderShape
+    uint8    padding[3] = { 0,0,0 };
+};
+
+///////////////////////////////////////////////////////////
+
+struct ColliderWorldSoA
+{
+    // world-space AABBs of colliders in SoA layout (by the same idx as Collider::ids_)
+    cvector<float> minX, minY, minZ;
+    cvector<float> maxX, maxY, maxZ;
+
+    // world-space shapes for the narrow phase
+    cvector<DirectX::BoundingSphere>      spheres;
+    cvector<DirectX::BoundingOrientedBox> obbs;
+};
+
+///////////////////////////////////////////////////////////
+
+struct Collider
+{
+    cvector<EntityID>     ids_;                   // entities IDs (SORTED)
+    cvector<ColliderData> data_;                  // local space
+
+    ColliderWorldSoA      world_;                 // world space (cache)
+    cvector<EntityID>     newIds_;                // SORTED: entts whose world shapes aren't computed yet
+
+    SparseSet             sparseIdxs_;            // O(1) lookup: entity ID => data idx
+};
+
+} // namespace ECS
@@ -0,0 +1,80 @@
+// *********************************************************************************
+// Filename:     TransformSoA.h
+// Description:  a structure-of-arrays (SoA) layout of transformation data
+//               (position, direction quaternion, uniform scale);
+//
+//               is used by bulk updates of the TransformSystem: each array
+//               contains a single scalar for each entity so the SIMD kernel
+//               can load data of 4 entities with a single instruction
+//               and build 4 world matrices per iteration
+//
+// Created:      14.10.26  by DimaSkup
+// *********************************************************************************
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+
+namespace ECS
+{
+
+struct TransformSoA
+{
+    // the number of entities processed by the kernel per iteration
+    static constexpr size LANES = 4;
+
+    // the number of entities per job when a bulk update is split across
+    // threads (must be a multiple of LANES so each job processes full registers)
+    static constexpr size JOB_GRAIN = 1024;
+    static_assert((JOB_GRAIN % LANES) == 0, "job grain must be a multiple of lanes number");
+
+    // -----------------------------------------------------
+
+    void Resize(const size numEntts)
+    {
+        // NOTE: we allocate memory aligned to the number of lanes so the kernel
+        //       can always load a full SIMD register (the tail is padded)
+
+        numElems = numEntts;
+        const size paddedSize = GetPaddedSize();
+
+        for (cvector<float>* pArr : { &posX, &posY, &posZ, &quatX, &quatY, &quatZ, &quatW, &scale })
+            pArr->resize_uninitialized(paddedSize);
+
+        idxs.resize_uninitialized(numEntts);
+
+        // fill the padding with identity transformation
+        for (index i = numEntts; i < paddedSize; ++i)
+        {
+            posX[i]  = posY[i]  = posZ[i]  = 0.0f;
+            quatX[i] = quatY[i] = quatZ[i] = 0.0f;
+            quatW[i] = 1.0f;
+            scale[i] = 1.0f;
+        }
+    }
+
+    inline size GetPaddedSize() const
+    {
+        return (numElems + LANES - 1) & ~(LANES - 1);
+    }
+
+    inline size Size() const { return numElems; }
+
+    // -----------------------------------------------------
+
+    cvector<float> posX;
+    cvector<float> posY;
+    cvector<float> posZ;
+
+    cvector<float> quatX;       // direction quaternion
+    cvector<float> quatY;
+    cvector<float> quatZ;
+    cvector<float> quatW;
+
+    cvector<float> scale;       // uniform scale
+
+    cvector<index> idxs;        // idx of each entity's record in the Transform component (0 if there is no record)
+    size           numElems = 0;
+};
+
+} // namespace ECS
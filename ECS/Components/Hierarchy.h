@@ -1,41 +1,56 @@
 // =================================================================================
 // Filename:     Hierarchy.h
 // Description:  ECS component to hold entities hierarchy data:
-//               entity can have only one "parent" and have multiple "children"
+//               entity can have only one "parent" and have multiple "children";
+//
+//               nodes are stored in flat arrays sorted by depth (parents always
+//               go before their children) and linked by idxs (parent, first child,
+//               next sibling) so transformations can be propagated from parents
+//               to children with a single linear pass over the arrays
 //
 // Created:      24.04.2025 by DimaSkup
 // =================================================================================
 #pragma once
 
+#include "../Common/SparseSet.h"
 #include <Types.h>
-#include <map>
-#include <set>
+#include <cvector.h>
+#include <DirectXMath.h>
 
 namespace ECS
 {
 
-struct HierarchyNode
+// ECS component
+__declspec(align(16)) struct Hierarchy
 {
-    HierarchyNode() {}
-
-    EntityID parentID = 0;
-    std::set<EntityID> children{};
-
-    // position of entity relatively to its parent (offset from parent to child)
-    XMFLOAT3 relativePos{0,0,0};       
-};
+    // is used when a node has no parent/children/next sibling
+    static constexpr index INVALID_NODE_IDX = SparseSet::INVALID_IDX;
 
-///////////////////////////////////////////////////////////
+    inline size Size() const { return ids.size(); }
 
-// ECS component
-struct Hierarchy
-{
-    Hierarchy()
+    void Clear()
     {
-        data.emplace(0, HierarchyNode());
+        ids.clear();
+        parentIdxs.clear();
+        firstChildIdxs.clear();
+        nextSiblingIdxs.clear();
+        depths.clear();
+        localPosAndScales.clear();
+        localRotations.clear();
+        sparseIdxs.Clear();
     }
 
-    std::map<EntityID, HierarchyNode> data;
+    cvector<EntityID>          ids;                 // SORTED BY DEPTH: ids of nodes (roots go first)
+    cvector<index>             parentIdxs;          // idx of the parent node (INVALID_NODE_IDX for roots)
+    cvector<index>             firstChildIdxs;      // idx of the first child node
+    cvector<index>             nextSiblingIdxs;     // idx of the next node with the same parent
+    cvector<uint16>            depths;              // 0 for roots
+
+    // transformation of node relatively to its parent (is unused for roots)
+    cvector<DirectX::XMFLOAT4> localPosAndScales;   // offset in parent's space (x,y,z); uniform scale (w)
+    cvector<DirectX::XMVECTOR> localRotations;      // rotation quaternion
+
+    SparseSet sparseIdxs;                           // O(1) lookup: entity ID => node idx
 };
 
 } // namespace ECS
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "../Common/ECSTypes.h"
+#include "../Common/SparseSet.h"
 #include <Types.h>
 #include <cvector.h>
 #include <DirectXMath.h>
@@ -222,18 +223,85 @@ __declspec(align(16)) struct DirLights
 {
     cvector<EntityID> ids;
     cvector<DirLight> data;
+    SparseSet sparseIdxs;
 };
 
+enum eLightFlags : uint8
+{
+    LIGHT_FLAG_NONE  = 0,
+    LIGHT_FLAG_DIRTY = (1 << 0),  // the light is already in changedIdxs
+};
+
+// point lights in SoA layout: each array has an element per light (by the same idx)
+// so batched updates touch only the props they change;
+// positions are stored in the Transform component
 __declspec(align(16)) struct PointLights
 {
     cvector<EntityID> ids;
-    cvector<PointLight> data;
+    cvector<XMFLOAT4> ambient;
+    cvector<XMFLOAT4> diffuse;
+    cvector<XMFLOAT4> specular;
+    cvector<XMFLOAT3> att;        // attenuation (A0, A1, A2)
+    cvector<float>    range;
+    cvector<uint8>    flags;      // eLightFlags
+    SparseSet sparseIdxs;
+
+    // the renderer keeps a GPU copy of all point lights so it's patched by them
+    // (positions are tracked by the Transform component)
+    cvector<index> changedIdxs;   // lights which props were changed since the prev clear (unique)
+    uint32 version = 0;           // is incremented when lights are added/removed (idxs are shifted)
 };
 
+// spotlights in SoA layout (positions and directions are stored in the Transform component)
 __declspec(align(16)) struct SpotLights
 {
     cvector<EntityID> ids;
-    cvector<SpotLight> data;
+    cvector<XMFLOAT4> ambient;
+    cvector<XMFLOAT4> diffuse;
+    cvector<XMFLOAT4> specular;
+    cvector<XMFLOAT3> att;        // attenuation (A0, A1, A2)
+    cvector<float>    range;
+    cvector<float>    spot;       // spot exponent
+    SparseSet sparseIdxs;
+};
+
+
+// *********************************************************************************
+//                     CONTAINERS FOR ANIMATIONS OF LIGHT SOURCES
+// *********************************************************************************
+
+// flickering point lights: diffuse = baseDiffuse * (1 - amplitude * noise(t));
+// (each animation container is SORTED by ids and is updated by a single pass)
+struct LightFlickers
+{
+    cvector<EntityID> ids;
+    cvector<XMFLOAT4> baseDiffuse;
+    cvector<float>    amplitude;    // [0, 1]: how much the light dims at most
+    cvector<float>    frequency;    // flickers per second
+    cvector<float>    phase;        // so neighbour lights don't flicker in sync
+    SparseSet         sparseIdxs;
+};
+
+// lights which circle around a center in the XZ-plane
+struct LightOrbits
+{
+    cvector<EntityID> ids;
+    cvector<float>    centerX;
+    cvector<float>    centerY;
+    cvector<float>    centerZ;
+    cvector<float>    radius;
+    cvector<float>    angularSpeed; // radians per second
+    cvector<float>    phase;        // initial angle
+    SparseSet         sparseIdxs;
+};
+
+// lights which are attached (with an offset) to other entts
+struct LightFollows
+{
+    cvector<EntityID> ids;
+    cvector<EntityID> targetIds;
+    cvector<XMFLOAT3> offsets;      // in world space
+    SparseSet         sparseIdxs;
 };
 
 // *********************************************************************************
@@ -257,6 +325,15 @@ struct Light
     DirLights           dirLights;
     PointLights         pointLights;
     SpotLights          spotLights;
+
+    LightFlickers       flickers;
+    LightOrbits         orbits;
+    LightFollows        follows;
+
+    // point/spot lights which never move/change (so their lighting can be baked) (SORTED)
+    cvector<EntityID>   staticIds;
+
+    SparseSet           sparseIdxs;     // O(1) lookup: entity ID => data idx
 };
 
 
@@ -3,12 +3,15 @@
 // Description:  an ECS component which contains material data of entities;
 //               each entity can have multiple subsets (meshes)
 //               and each subset can have its own unique material;
-//               so we create an array of materials IDs for each entity by ID;
+//               materials IDs of all the entts are stored in a single flat pool
+//               and each entity has only a range of it;
 // 
 // Created:      28.06.24
 // *********************************************************************************
 #pragma once
 
+#include "../Common/SparseSet.h"
+#include "../Common/SubsetPool.h"
 #include <Types.h>
 #include <cvector.h>
 
@@ -17,15 +20,9 @@ namespace ECS
 
 struct MaterialData
 {
-    MaterialData() {}
-
-    MaterialData(const MaterialID* ids, const size numMaterials)
-    {
-        materialsIDs.resize(numMaterials);
-        std::copy(ids, ids + numMaterials, materialsIDs.begin());
-    }
-
-    cvector<MaterialID> materialsIDs;
+    // materials IDs of subsets of the entity (a view of the Material::materials pool;
+    // so it is valid only until the component is changed)
+    SubsetSpan<MaterialID> materialsIDs;
 };
 
 ///////////////////////////////////////////////////////////
@@ -33,12 +30,14 @@ struct MaterialData
 // ECS component
 struct Material
 {
-    cvector<EntityID>     enttsIDs;
-    cvector<MaterialData> data;
+    cvector<EntityID>      enttsIDs;
+    SubsetPool<MaterialID> materials;               // materials IDs per subset (by the same idx as enttsIDs)
 
     // a flag to define if all the materials (MaterialData) which are related to entity
     // are based on related model (means related to entity)
-    cvector<bool>         flagsMeshBasedMaterials;  
+    cvector<bool>          flagsMeshBasedMaterials;  
+
+    SparseSet              sparseIdxs;              // O(1) lookup: entity ID => data idx
 };
 
 }
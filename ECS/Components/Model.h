@@ -7,6 +7,7 @@
 // *********************************************************************************
 #pragma once
 
+#include "../Common/SparseSet.h"
 #include <Types.h>
 #include <cvector.h>
 
@@ -17,6 +18,13 @@ struct Model
 {
     cvector<EntityID> enttsIDs_;   // primary keys (can have only unique values)
     cvector<ModelID>  modelIDs_;   // there can be multiple the same values
+
+    // models are rarely changed so entts are grouped by them in advance (see ModelSystem):
+    // a group is kept after its last entt is removed (so indices of groups are stable)
+    cvector<uint32>   groups_;      // group of each entt (idx into groupModels_)
+    cvector<ModelID>  groupModels_; // SORTED: the model of each group
+
+    SparseSet sparseIdxs_;         // O(1) lookup: entity ID => data idx
 };
 
 }
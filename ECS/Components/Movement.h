@@ -6,6 +6,7 @@
 // *********************************************************************************
 #pragma once
 
+#include "../Common/SparseSet.h"
 #include <Types.h>
 #include <cvector.h>
 
@@ -18,6 +19,8 @@ struct Movement
 	cvector<EntityID> ids_;                              // entities IDs
 	cvector<DirectX::XMFLOAT4> translationAndUniScales_; // translation (x,y,z); uniform scale (w)
 	cvector<DirectX::XMVECTOR> rotationQuats_;           // rotation quatertion {0, pitch, yaw, roll}
+
+	SparseSet sparseIdxs_;                               // O(1) lookup: entity ID => data idx
 };
 
 }
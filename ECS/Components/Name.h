@@ -6,9 +6,10 @@
 // *********************************************************************************
 #pragma once
 
+#include "../Common/SparseSet.h"
+#include "../Common/StringTable.h"
 #include <Types.h>
 #include <cvector.h>
-#include <string>
 
 namespace ECS
 {
@@ -17,8 +18,13 @@ struct Name
 {
 	// both vectors have the same length because 
 	// there is one to one records ['entity_id' => 'entity_name']
-	cvector<EntityID> ids_;
-	cvector<std::string> names_;
+	cvector<EntityID>  ids_;
+	cvector<StrHandle> names_;            // handles of names in the strings table
+
+	StringTable        strings_;          // interned chars of all the names
+	cvector<EntityID>  enttsByName_;      // O(1) lookup: name handle => ID of entity with such a name (the smallest one)
+
+	SparseSet sparseIdxs_;       // O(1) lookup: entity ID => data idx
 };
 
 }
@@ -0,0 +1,62 @@
+// =================================================================================
+// Filename:     ParticleEmitter.h
+// Description:  an ECS component which contains data of particle emitters:
+//               particles are spawned at the entity's position along its up axis
+//               and are simulated/rendered on GPU (see Render::GpuParticles)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Common/SparseSet.h"
+#include <Types.h>
+#include <cvector.h>
+#include <DirectXMath.h>
+
+
+namespace ECS
+{
+
+enum eParticleBlend : uint8
+{
+    PARTICLE_BLEND_ALPHA,                         // smoke, dust, etc. (is sorted back to front)
+    PARTICLE_BLEND_ADDITIVE,                      // fire, sparks, etc.
+};
+
+///////////////////////////////////////////////////////////
+
+struct ParticleEmitterParams
+{
+    DirectX::XMFLOAT4 startColor  = { 1,1,1,1 };  // color of a particle is lerped over its lifetime
+    DirectX::XMFLOAT4 endColor    = { 1,1,1,0 };
+
+    float    spawnRate   = 20.0f;                 // particles per second
+    float    minLifetime = 1.0f;                  // in seconds
+    float    maxLifetime = 2.0f;
+    float    minSpeed    = 0.5f;                  // start speed along the emission cone
+    float    maxSpeed    = 1.0f;
+    float    spreadAngle = 0.3f;                  // half angle of the emission cone around the up axis (in radians)
+    float    startSize   = 0.5f;                  // size of a quad is lerped over the lifetime
+    float    endSize     = 1.0f;
+    float    gravity     = 0.0f;                  // acceleration along -Y (negative: particles rise)
+    float    drag        = 0.0f;                  // damping of the velocity per second
+
+    TexID    texID       = INVALID_TEXTURE_ID;
+    uint8    atlasCols   = 1;                     // frames of a flipbook atlas are played over the lifetime
+    uint8    atlasRows   = 1;
+    uint8    blend       = PARTICLE_BLEND_ALPHA;  // eParticleBlend
+    uint8    padding     = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+struct ParticleEmitter
+{
+    cvector<EntityID>              ids_;          // entities IDs (SORTED)
+    cvector<ParticleEmitterParams> params_;
+    cvector<float>                 spawnAccums_;  // not spawned (fractional) particles since the last collection
+
+    SparseSet                      sparseIdxs_;   // O(1) lookup: entity ID => data idx
+};
+
+} // namespace ECS
@@ -0,0 +1,65 @@
+// =================================================================================
+// Filename:     Portal.h
+// Description:  an ECS component for the visibility of interiors by cells and portals:
+//
+//               - a cell is a box of a room (in local space of the entt, so its
+//                 world bounds are the AABB of the transformed box);
+//               - a portal is an opening between two cells (a doorway, a window):
+//                 a rectangle in the local XY plane of the entt (its normal is the
+//                 local +Z axis); the cell behind the portal and the cell in front
+//                 of it are set explicitly or are found by probing points around
+//                 the portal (no cell there means the outside)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Common/SparseSet.h"
+#include <Types.h>
+#include <cvector.h>
+#include <DirectXMath.h>
+
+
+namespace ECS
+{
+
+enum ePortalType : uint8
+{
+    PORTAL_TYPE_CELL,
+    PORTAL_TYPE_PORTAL,
+};
+
+enum ePortalSide : uint8
+{
+    PORTAL_SIDE_BACK,                             // by the local -Z of the portal
+    PORTAL_SIDE_FRONT,                            // by the local +Z of the portal
+};
+
+///////////////////////////////////////////////////////////
+
+struct PortalData
+{
+    // cell:   the center and half sizes of the box in local space;
+    // portal: half width (x) and half height (y) of the rectangle (center and z aren't used)
+    DirectX::XMFLOAT3 center  = { 0,0,0 };
+    DirectX::XMFLOAT3 extents = { 1,1,1 };
+
+    // portal: cells behind and in front of it (INVALID_ENTITY_ID - is found automatically)
+    EntityID cells[2] = { INVALID_ENTITY_ID, INVALID_ENTITY_ID };
+
+    uint8    type     = PORTAL_TYPE_CELL;         // ePortalType
+    uint8    isOpen   = 1;                        // portal: a closed portal (a door) blocks the visibility
+    uint8    padding[2] = { 0,0 };
+};
+
+///////////////////////////////////////////////////////////
+
+struct Portal
+{
+    cvector<EntityID>   ids_;                     // entities IDs (SORTED)
+    cvector<PortalData> data_;
+
+    SparseSet           sparseIdxs_;              // O(1) lookup: entity ID => data idx
+};
+
+} // namespace ECS
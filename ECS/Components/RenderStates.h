@@ -7,6 +7,7 @@
 // *********************************************************************************
 #pragma once
 
+#include "../Common/SparseSet.h"
 #include <Types.h>
 #include <cvector.h>
 
@@ -76,10 +77,27 @@ static const cvector<eRenderState> g_AlphaClipCullNoneStates =
 
 ///////////////////////////////////////////////////////////
 
+// buckets of entts by render states: are recomputed only when states are changed
+// so each frame we just distribute visible entts by these buckets
+enum eRenderStatesBucket : uint8
+{
+    RS_BUCKET_OTHER,                 // any not supported combination of states
+    RS_BUCKET_DEFAULT,
+    RS_BUCKET_ALPHA_CLIP_CULL_NONE,
+    RS_BUCKET_BLENDED,               // default states + blending (one bucket per blending state)
+
+    NUM_RS_BUCKETS = RS_BUCKET_BLENDED + (TRANSPARENCY - ALPHA_ENABLE + 1)
+};
+
+///////////////////////////////////////////////////////////
+
 struct RenderStates
 {
     cvector<EntityID> ids_;
     cvector<u32> statesHashes_;    // hash where each bit responds for a specific render state
+    cvector<uint8> buckets_;       // render states bucket of each entt (eRenderStatesBucket)
+
+    SparseSet sparseIdxs_;         // O(1) lookup: entity ID => data idx
 };
 
 
@@ -107,7 +125,7 @@ struct EnttsBlended
 {
     cvector<EntityID>   ids_;
     cvector<size>       instanceCountPerBS_;
-    cvector<eRenderState>    states_;                   // each instances set has its own blending state
+    cvector<u32>        states_;                         // each instances set has its own blending state (a bit of the states hash)
 
     void Clear()
     {
@@ -138,6 +156,17 @@ struct EnttsReflection
 
 // ------------------------------------------------
 
+struct EnttsImpostors
+{
+    // IDs of entities which are farther than the impostor distance and whose
+    // models have an impostor so they are rendered as a single quad
+    cvector<EntityID> ids_;
+
+    void Clear() { ids_.clear(); }
+};
+
+// ------------------------------------------------
+
 struct EnttsFarThanFog
 {
     // container for IDs of entities that are farther than the fog range
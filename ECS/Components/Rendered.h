@@ -7,6 +7,7 @@
 #pragma once
 
 #include "../Common/ECSTypes.h"
+#include "../Common/SparseSet.h"
 #include <Types.h>
 #include <cvector.h>
 #include <d3d11.h>
@@ -27,9 +28,19 @@ struct Rendered
     cvector<EntityID>                   ids;
     cvector<RenderShaderType>           shaderTypes;
     cvector<D3D11_PRIMITIVE_TOPOLOGY>   primTopologies;
+    cvector<uint8>                      lods;                   // level of detail which is selected during culling (isn't serialized)
+    cvector<float>                      smallCullFactors;       // scale of the small feature culling threshold (0 - never cull by size)
+    cvector<uint8>                      staticFlags;            // 1: the entt never moves so its instance data is kept on GPU
+    uint32                              staticVersion = 0;      // is incremented when any static flag is changed
+    cvector<EntityID>                   mergedInto;             // a cell entt whose merged mesh renders this entt (0 - renders itself)
+    cvector<uint8>                      reflectFlags;           // 1: the entt is rendered into the planar reflection
+    uint32                              reflectVersion = 0;     // is incremented when any reflection flag is changed
 
     cvector<EntityID>                   visibleEnttsIDs;        // currently visible entts (models) for this frame
     cvector<EntityID>                   visiblePointLightsIDs;  // currently visible point light sources
+    cvector<EntityID>                   visibleSpotLightsIDs;   // currently visible spotlights (the flashlight is always the first)
+
+    SparseSet                           sparseIdxs;             // O(1) lookup: entity ID => data idx
 };
 
 }
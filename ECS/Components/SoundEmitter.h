@@ -0,0 +1,30 @@
+// =================================================================================
+// Filename:     SoundEmitter.h
+// Description:  an ECS component which contains data of positional (3D) sound
+//               sources: a looped sound which is heard around the entity
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Common/SparseSet.h"
+#include <Types.h>
+#include <cvector.h>
+
+
+namespace ECS
+{
+
+struct SoundEmitter
+{
+    cvector<EntityID> ids_;                       // entities IDs (SORTED)
+    cvector<uint32>   soundIds_;                  // a preloaded sound of the audio system
+    cvector<float>    volumes_;                   // [0, 1]
+    cvector<float>    minDists_;                  // the sound is heard with the full volume within this distance
+    cvector<float>    maxDists_;                  // the sound isn't heard beyond this distance
+    cvector<uint8>    priorities_;                // emitters with higher priorities take voices first
+
+    SparseSet         sparseIdxs_;                // O(1) lookup: entity ID => data idx
+};
+
+} // namespace ECS
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "Helpers/TextureTransformHelpers.h"
+#include "../Common/SparseSet.h"
 
 
 namespace ECS
@@ -42,6 +43,7 @@ struct TextureTransform
         texStaticTrans.ids.push_back(0);
         texStaticTrans.transformations.push_back(I);
 
+        sparseIdxs.Set(INVALID_ENTITY_ID, 0);
     }
 
     cvector<EntityID>           ids;
@@ -52,6 +54,8 @@ struct TextureTransform
     TexAtlasAnimations          texAtlasAnim;
     TexRotationsAroundCoords    texRotations;
 
+    SparseSet                   sparseIdxs;              // O(1) lookup: entity ID => data idx
+
     eComponentType              type = eComponentType::TextureTransformComponent;
 };
 
@@ -6,6 +6,7 @@
 // *********************************************************************************
 #pragma once
 
+#include "../Common/SparseSet.h"
 #include <Types.h>
 #include <cvector.h>
 #include <DirectXMath.h>
@@ -13,6 +14,19 @@
 namespace ECS
 {
 
+// flags to define what transformation data of the entity must be updated
+enum eTransformDirtyFlags : uint8
+{
+    TRANSFORM_CLEAN      = 0,
+    TRANSFORM_CHANGED    = (1 << 0),   // world was changed during this frame (is reset by TransformSystem::FlushDirty)
+    WORLD_DIRTY          = (1 << 1),   // world must be recomputed using pos/direction/scale
+    INV_WORLD_DIRTY      = (1 << 2),   // inverse world must be recomputed
+    WORLD_NOT_TRS        = (1 << 3),   // world was transformed by arbitrary matrix so it isn't (uniform scale * rotation * translation) anymore
+    WORLD_INTERPOLATED   = (1 << 4),   // world was changed during the last simulation step so it is interpolated for rendering
+};
+
+///////////////////////////////////////////////////////////
+
 __declspec(align(16)) struct Transform
 {
     Transform()
@@ -28,14 +42,25 @@ __declspec(align(16)) struct Transform
 
         worlds.push_back(nanMatrix);
         invWorlds.push_back(nanMatrix); // inverse world matrix
+        prevWorlds.push_back(nanMatrix);
+        dirtyFlags.push_back(TRANSFORM_CLEAN);
+
+        sparseIdxs.Set(INVALID_ENTITY_ID, 0);
     }
 
 
     cvector<EntityID> ids;
     cvector<DirectX::XMMATRIX> worlds;
     cvector<DirectX::XMMATRIX> invWorlds;           // inverse world matrices
+    cvector<DirectX::XMMATRIX> prevWorlds;          // worlds at the start of the last simulation step (for render interpolation)
     cvector<DirectX::XMFLOAT4> posAndUniformScale;  // pos (x,y,z); uniform scale (w)
     cvector<DirectX::XMVECTOR> directions;          // normalized direction vector
+
+    cvector<uint8>             dirtyFlags;          // per record: a set of eTransformDirtyFlags
+    cvector<EntityID>          dirtyIds;            // entts which were changed since the last flush
+    cvector<EntityID>          changedIds;          // SORTED: entts which were changed during the last frame
+
+    SparseSet sparseIdxs;                           // O(1) lookup: entity ID => data idx
 };
 
 }
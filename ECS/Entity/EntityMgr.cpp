@@ -1,5 +1,7 @@
 #include "../Common/pch.h"
 #include "EntityMgr.h"
+#include <Profiler.h>
+#include <MemTracker.h>
 
 #pragma warning (disable : 4996)
 
@@ -24,7 +26,13 @@ EntityMgr::EntityMgr() :
     boundingSystem_     { &bounding_ },
     cameraSystem_       { &camera_, &transformSystem_ },
     hierarchySystem_    { &hierarchy_, &transformSystem_ },
-    playerSystem_       { &transformSystem_, &cameraSystem_, &hierarchySystem_ }
+    soundSystem_        { &soundEmitters_, &transformSystem_, &cameraSystem_ },
+    particleSystem_     { &particleEmitters_, &transformSystem_ },
+    colliderSystem_     { &colliders_ },
+    animationSystem_    { &animators_ },
+    portalSystem_       { &portals_, &transformSystem_ },
+    playerSystem_       { &transformSystem_, &cameraSystem_, &hierarchySystem_ },
+    worldPartitionSystem_ { this }
    
 {
     LogDbg("start of entity mgr init");
@@ -36,25 +44,12 @@ EntityMgr::EntityMgr() :
     ids_.reserve(reserveMemForEnttsCount);
     componentHashes_.reserve(reserveMemForEnttsCount);
 
-    // make pairs ['component_type' => 'component_name']
-    componentTypeToName_ =
-    {
-        { TransformComponent,           "Transform" },
-        { NameComponent,                "Name" },
-        { MoveComponent,                "Movement" },
-        { ModelComponent,               "Model" },
-        { RenderedComponent,            "Rendered" },
-        { MaterialComponent,            "Textured" },
-        { TextureTransformComponent,    "Texture transform" },
-        { LightComponent,               "Light" },
-        { RenderStatesComponent,        "Render states" },
-        { BoundingComponent,            "Bounding" },
-        { CameraComponent,              "Camera" },
-    };
-
     // add "invalid" entity with ID == 0
     ids_.push_back(INVALID_ENTITY_ID);
     componentHashes_.push_back(0);
+    sparseIdxs_.Set(INVALID_ENTITY_ID, 0);
+
+    InitUpdateScheduler();
 
     LogDbg("entity mgr is initialized");
 }
@@ -115,14 +110,125 @@ void EntityMgr::SetupLogger(FILE* pFile)
 
 bool EntityMgr::Serialize(const std::string& dataFilepath)
 {
-    return false;
+    // write data of the entity manager and all the components
+    // into the binary world file (each component is a separate chunk)
+
+    WorldFileWriter writer;
+
+    if (!Serialize(writer))
+    {
+        sprintf(g_String, "can't serialize entities data into the file: %s", dataFilepath.c_str());
+        LogErr(g_String);
+        return false;
+    }
+
+    if (!writer.SaveToFile(dataFilepath.c_str()))
+        return false;
+
+    sprintf(g_String, "entities data is serialized into the file: %s", dataFilepath.c_str());
+    LogMsg(g_String);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool EntityMgr::Serialize(WorldFileWriter& writer)
+{
+    try
+    {
+        writer.BeginChunk(ENTT_MGR_SERIALIZE_DATA_BLOCK_MARKER);
+        writer.Write(lastEntityID_);
+        writer.WriteArray(ids_);
+        writer.WriteArray(componentHashes_);
+        writer.WriteArray(freeIds_);
+        writer.EndChunk();
+
+        std::apply([&writer](auto&... systems) { (systems.Serialize(writer), ...); }, GetSerializedSystems());
+        worldPartitionSystem_.Serialize(writer);
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        return false;
+    }
 }
 
 ///////////////////////////////////////////////////////////
 
 bool EntityMgr::Deserialize(const std::string& dataFilepath)
 {
-    return false;
+    // load the binary world file (or the world directory) and replace data
+    // of the entity manager and all the components with data from it
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    WorldFileReader reader;
+    const char*     path     = dataFilepath.c_str();
+    const bool      isLoaded = (WorldFileReader::IsWorldDir(path)) ? reader.LoadFromDir(path) : reader.LoadFromFile(path);
+
+    if (!isLoaded)
+        return false;
+
+    if (!Deserialize(reader))
+    {
+        sprintf(g_String, "can't deserialize entities data from the file: %s", path);
+        LogErr(g_String);
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool EntityMgr::Deserialize(WorldFileReader& reader)
+{
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    try
+    {
+        if (!reader.BeginChunk(ENTT_MGR_SERIALIZE_DATA_BLOCK_MARKER))
+        {
+            LogErr("there is no entity manager data in the world file");
+            return false;
+        }
+
+        bool result = true;
+        result &= reader.Read(lastEntityID_);
+        result &= reader.ReadArray(ids_);
+        result &= reader.ReadArray(componentHashes_);
+        result &= reader.ReadArray(freeIds_);
+        result &= (componentHashes_.size() == ids_.size());
+
+        if (!result)
+        {
+            LogErr("entity manager data in the world file is corrupted");
+            return false;
+        }
+
+        sparseIdxs_.Clear();
+        sparseIdxs_.Rebuild(ids_);
+
+        for (std::unique_ptr<QueryBase>& pQuery : queries_)
+            pQuery->Reset(ids_.data(), componentHashes_.data(), ids_.size());
+
+        ++structureVersion_;
+
+        // chunks go by the same order as they were written
+        std::apply([&](auto&... systems) { ((result &= systems.Deserialize(reader)), ...); }, GetSerializedSystems());
+
+        // entts of unloaded chunks are restored from their chunk files (if the partition isn't streaming)
+        result &= worldPartitionSystem_.Deserialize(reader);
+
+        return result;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        return false;
+    }
 }
 
 
@@ -133,13 +239,33 @@ bool EntityMgr::Deserialize(const std::string& dataFilepath)
 
 #pragma region PublicCreationDestroymentAPI
 
+EntityID EntityMgr::GenerateID()
+{
+    // reuse a slot of some destroyed entity (with the next generation)
+    // or make a new slot if there is no free ones
+
+    if (!freeIds_.empty())
+    {
+        const EntityID id = freeIds_.back();
+        freeIds_.pop_back();
+        return id;
+    }
+
+    CAssert::True((EntityID)lastEntityID_ <= ENTT_SLOT_MASK, "too many entities: there is no free slot for a new one");
+
+    return MakeEnttID(lastEntityID_++, 0);
+}
+
+///////////////////////////////////////////////////////////
+
 EntityID EntityMgr::CreateEntity()
 {
     // create a new empty entity;
     // return: its ID
 
-    EntityID id = lastEntityID_++;
+    const EntityID id = GenerateID();
 
+    sparseIdxs_.Set(id, ids_.size());
     ids_.push_back(id);
     componentHashes_.push_back(0);
 
@@ -173,30 +299,322 @@ cvector<EntityID> EntityMgr::CreateEntities(const int newEnttsCount)
     // unique ID and set that it hasn't any component by default;
     //
     // return: SORTED array of IDs of just created entities;
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
 
     CAssert::True(newEnttsCount > 0, "new entitites count cannot be <= 0");
 
     cvector<EntityID> generatedIDs(newEnttsCount, INVALID_ENTITY_ID);
 
-    // "generate" consistent IDs
+    // "generate" IDs (recycled ones can be less than the others so sort them)
     for (EntityID& id : generatedIDs)
-        id = lastEntityID_++;
+        id = GenerateID();
+
+    std::sort(generatedIDs.begin(), generatedIDs.end());
 
     // append ids and hashes of entities
+    const index firstIdx = ids_.size();
+
     ids_.append_vector(generatedIDs);
+    sparseIdxs_.Rebuild(ids_, firstIdx);
     componentHashes_.append_vector(cvector<ComponentBitfield>(newEnttsCount, 0));
 
+    ++structureVersion_;
     return generatedIDs;
 }
 
 ///////////////////////////////////////////////////////////
 
-void EntityMgr::DestroyEntities(const EntityID* ids, const size numEntts)
+void EntityMgr::DestroyEntities(const EntityID* ids, const size numEntts, const bool recycleIds)
 {
-    //CAssert::True(ids != nullptr, "input ptr to enitites IDs arr == nullptr");
-    //CAssert::True(numEntts > 0, "input number of entts must be > 0");
+    // destroy a batch of entities: remove all their components
+    // (each component's data is compacted once for the whole batch),
+    // and put their slots into the free list for reusing
+    // (if not recycleIds the slots are kept so entts can be restored by the same IDs)
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    CAssert::True(ids != nullptr, "input ptr to enitites IDs arr == nullptr");
+    CAssert::True(numEntts > 0, "input number of entts must be > 0");
+
+    cvector<EntityID> enttsIDs;
+    enttsIDs.reserve(numEntts);
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        if ((ids[i] != INVALID_ENTITY_ID) && sparseIdxs_.Has(ids[i]))
+        {
+            enttsIDs.push_back(ids[i]);
+        }
+        else
+        {
+            sprintf(g_String, "can't destroy entity: there is no entity by ID: %u", ids[i]);
+            LogErr(g_String);
+        }
+    }
+
+    // remove duplicates
+    std::sort(enttsIDs.begin(), enttsIDs.end());
+    enttsIDs.resize(std::unique(enttsIDs.begin(), enttsIDs.end()) - enttsIDs.begin());
+
+    const size num = enttsIDs.size();
+
+    if (num == 0)
+        return;
+
+    const EntityID* destroyedIds = enttsIDs.data();
+
+    std::apply([=](auto&... systems) { (systems.RemoveRecords(destroyedIds, num), ...); }, GetRecordsSystems());
+
+    // ids_ isn't sorted so we just swap-and-pop each destroyed entt
+    if (recycleIds)
+        freeIds_.reserve(freeIds_.size() + num);
+
+    for (const EntityID id : enttsIDs)
+    {
+        const index idx     = sparseIdxs_.GetIdx(id);
+        const index lastIdx = ids_.size() - 1;
+
+        ids_[idx]             = ids_[lastIdx];
+        componentHashes_[idx] = componentHashes_[lastIdx];
+        sparseIdxs_.Set(ids_[idx], idx);
 
-    assert("TODO: IMPLEMENT IT!" && 0);
+        ids_.pop_back();
+        componentHashes_.pop_back();
+        sparseIdxs_.Remove(id);
+
+        if (recycleIds)
+            freeIds_.push_back(MakeEnttID(GetEnttSlot(id), GetEnttGeneration(id) + 1));
+    }
+
+    for (std::unique_ptr<QueryBase>& pQuery : queries_)
+        pQuery->OnEnttsRemoved(destroyedIds, num);
+
+    ++structureVersion_;
+}
+
+///////////////////////////////////////////////////////////
+
+bool EntityMgr::RestoreEntities(const EntityID* ids, const size numEntts)
+{
+    // create empty entities with the input IDs (SORTED) which were destroyed
+    // without recycling of their slots (so there can't be another entt in the slot)
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    CAssert::True(ids != nullptr, "input ptr to enitites IDs arr == nullptr");
+    CAssert::True(numEntts > 0, "input number of entts must be > 0");
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const EntityID id = ids[i];
+
+        if ((id == INVALID_ENTITY_ID) || sparseIdxs_.Has(id) || ((int)GetEnttSlot(id) >= lastEntityID_))
+        {
+            sprintf(g_String, "can't restore entity: ID is invalid or it is already used: %u", id);
+            LogErr(g_String);
+            return false;
+        }
+    }
+
+    const index firstIdx = ids_.size();
+
+    ids_.append_vector(cvector<EntityID>(ids, ids + numEntts));
+    sparseIdxs_.Rebuild(ids_, firstIdx);
+    componentHashes_.append_vector(cvector<ComponentBitfield>(numEntts, 0));
+
+    ++structureVersion_;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+cvector<EntityID> EntityMgr::Instantiate(
+    const Prefab& prefab,
+    const size numInstances,
+    const XMFLOAT3* positions,
+    const XMVECTOR* dirQuats,
+    const float* uniformScales)
+{
+    // create a batch of entts by the prefab: each component gets all the instances
+    // by a single merge pass of its arrays, then the bitfields of the new entts
+    // are set and the cached queries are updated only once for the whole batch
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    if (numInstances <= 0)
+    {
+        LogErr("can't instantiate a prefab: the number of instances must be > 0");
+        return {};
+    }
+
+    cvector<EntityID> ids = CreateEntities((int)numInstances);
+    AddPrefabComponents(prefab, ids.data(), numInstances, positions, dirQuats, uniformScales);
+
+    return ids;
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::AddPrefabComponents(
+    const Prefab& prefab,
+    const EntityID* pIds,
+    const size num,
+    const XMFLOAT3* positions,
+    const XMVECTOR* dirQuats,
+    const float* uniformScales)
+{
+    // add each component of the prefab to all the input entts by a single batch;
+    // then the bitfields of the entts are set and the cached queries are updated once
+
+    // components which are actually added (a failed one is skipped)
+    ComponentBitfield addedMask = 0;
+
+    try
+    {
+        if (prefab.Has(NameComponent))
+        {
+            cvector<std::string> names(num);
+            char postfix[16];
+
+            for (index i = 0; i < num; ++i)
+            {
+                snprintf(postfix, sizeof(postfix), "_%d", (int)i);
+                names[i] = prefab.name + postfix;
+            }
+
+            nameSystem_.AddRecords(pIds, names.data(), num);
+            addedMask |= GetComponentBit(NameComponent);
+        }
+
+        if (prefab.Has(TransformComponent))
+        {
+            const cvector<XMFLOAT3> defPositions ((positions)     ? 0 : num, XMFLOAT3{ 0,0,0 });
+            const cvector<XMVECTOR> defDirQuats  ((dirQuats)      ? 0 : num, prefab.dirQuat);
+            const cvector<float>    defScales    ((uniformScales) ? 0 : num, prefab.uniformScale);
+
+            transformSystem_.AddRecords(
+                pIds,
+                (positions)     ? positions     : defPositions.data(),
+                (dirQuats)      ? dirQuats      : defDirQuats.data(),
+                (uniformScales) ? uniformScales : defScales.data(),
+                num);
+
+            addedMask |= GetComponentBit(TransformComponent);
+        }
+
+        if (prefab.Has(ModelComponent))
+        {
+            modelSystem_.AddRecords(pIds, prefab.modelID, num);
+            addedMask |= GetComponentBit(ModelComponent);
+        }
+
+        if (prefab.Has(RenderedComponent))
+        {
+            const cvector<RenderInitParams> params(num, prefab.renderParams);
+            renderSystem_.AddRecords(pIds, params.data(), num);
+            addedMask |= GetComponentBit(RenderedComponent);
+        }
+
+        if (prefab.Has(RenderStatesComponent))
+        {
+            renderStatesSystem_.AddWithDefaultStates(pIds, num);
+            addedMask |= GetComponentBit(RenderStatesComponent);
+        }
+
+        if (prefab.Has(MaterialComponent))
+        {
+            const cvector<MaterialID>& matIDs = prefab.materialsIDs;
+            materialSystem_.AddRecords(pIds, num, matIDs.data(), matIDs.size(), prefab.areMaterialsMeshBased);
+            addedMask |= GetComponentBit(MaterialComponent);
+        }
+
+        if (prefab.Has(BoundingComponent))
+        {
+            CAssert::True(prefab.boundTypes.size() == prefab.AABBs.size(), "the prefab must have a bounding type per AABB");
+            boundingSystem_.Add(pIds, num, prefab.AABBs.size(), prefab.boundTypes.data(), prefab.AABBs.data());
+            addedMask |= GetComponentBit(BoundingComponent);
+        }
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr(GetErrMsg("can't add all the components of the prefab to entts: ", pIds, num).c_str());
+    }
+
+    if (addedMask != 0)
+    {
+        for (index i = 0; i < num; ++i)
+            componentHashes_[sparseIdxs_.GetIdx(pIds[i])] |= addedMask;
+
+        UpdateQueries(pIds, num, addedMask);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::RemoveComponent(const EntityID* ids, const size numEntts, const eComponentType type)
+{
+    // remove records of the component from its system by a single compaction pass;
+    // entts which don't have this component are skipped
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    CAssert::True(ids != nullptr, "input ptr to enitites IDs arr == nullptr");
+
+    const ComponentBitfield bit = GetComponentBit(type);
+    cvector<EntityID>       enttsIDs;
+    enttsIDs.reserve(numEntts);
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        if (sparseIdxs_.Has(ids[i]) && EnttHasComponents(ids[i], bit))
+            enttsIDs.push_back(ids[i]);
+    }
+
+    std::sort(enttsIDs.begin(), enttsIDs.end());
+    enttsIDs.resize(std::unique(enttsIDs.begin(), enttsIDs.end()) - enttsIDs.begin());
+
+    const EntityID* pIds = enttsIDs.data();
+    const size      num  = enttsIDs.size();
+
+    if (num == 0)
+        return;
+
+    switch (type)
+    {
+        case NameComponent:             nameSystem_.RemoveRecords(pIds, num);         break;
+        case TransformComponent:        transformSystem_.RemoveRecords(pIds, num);    break;
+        case MoveComponent:             moveSystem_.RemoveRecords(pIds, num);         break;
+        case RenderedComponent:         renderSystem_.RemoveRecords(pIds, num);       break;
+        case ModelComponent:            modelSystem_.RemoveRecords(pIds, num);        break;
+        case CameraComponent:           cameraSystem_.RemoveRecords(pIds, num);       break;
+        case MaterialComponent:         materialSystem_.RemoveRecords(pIds, num);     break;
+        case TextureTransformComponent: texTransformSystem_.RemoveRecords(pIds, num); break;
+        case LightComponent:            lightSystem_.RemoveRecords(pIds, num);        break;
+        case RenderStatesComponent:     renderStatesSystem_.RemoveRecords(pIds, num); break;
+        case BoundingComponent:         boundingSystem_.RemoveRecords(pIds, num);     break;
+        case HierarchyComponent:        hierarchySystem_.RemoveRecords(pIds, num);    break;
+        case SoundEmitterComponent:     soundSystem_.RemoveRecords(pIds, num);        break;
+        case ParticleEmitterComponent:  particleSystem_.RemoveRecords(pIds, num);     break;
+        case ColliderComponent:         colliderSystem_.RemoveRecords(pIds, num);     break;
+        case AnimatorComponent:         animationSystem_.RemoveRecords(pIds, num);    break;
+        case PortalComponent:           portalSystem_.RemoveRecords(pIds, num);       break;
+
+        default:
+        {
+            sprintf(g_String, "can't remove a component of type %d: it isn't removable", (int)type);
+            LogErr(g_String);
+            return;
+        }
+    }
+
+    for (const EntityID id : enttsIDs)
+        componentHashes_[sparseIdxs_.GetIdx(id)] &= ~bit;
+
+    // entts don't match queries of this component anymore
+    for (std::unique_ptr<QueryBase>& pQuery : queries_)
+    {
+        if (pQuery->GetMask() & bit)
+            pQuery->OnEnttsRemoved(pIds, num);
+    }
+
+    ++structureVersion_;
 }
 
 
@@ -208,107 +626,353 @@ void EntityMgr::DestroyEntities(const EntityID* ids, const size numEntts)
 
 void EntityMgr::Update(const float totalGameTime, const float deltaTime)
 {
-    //moveSystem_.UpdateAllMoves(deltaTime, transformSystem_);
-    texTransformSystem_.UpdateAllTextrureAnimations(totalGameTime, deltaTime);
-    lightSystem_.Update(deltaTime, totalGameTime);
+    // execute all the update tasks; systems which touch
+    // disjoint components are executed concurrently
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+    PROFILE_SCOPE("EntityMgr::Update");
 
-    cvector<EntityID> ids(16);
+    updateTotalTime_ = totalGameTime;
+    updateDeltaTime_ = deltaTime;
+
+    // stream chunks of the world around the player (entts can be created/destroyed
+    // here so it's done before the update tasks; moved entts of the prev step are reassigned)
+    if (worldPartitionSystem_.IsActive() && CheckEnttExist(playerSystem_.GetPlayerID()))
+        worldPartitionSystem_.Update(playerSystem_.GetPosition());
+
+    // keep worlds of the prev step for render interpolation
+    transformSystem_.BeginSimulationStep();
+
+    updateScheduler_.Execute();
+
+    // the sync point of structural changes which were recorded by the update tasks
+    PlaybackCommands();
+}
+
+///////////////////////////////////////////////////////////
+
+CommandBuffer& EntityMgr::GetCommandBuffer()
+{
+    const int threadIdx = g_JobSystem.GetCurrQueueIdx();
+    CAssert::True(threadIdx < MAX_CMD_BUFFERS, "there is no command buffer for the thread: too many threads of the job system");
+
+    return cmdBuffers_[threadIdx];
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::PlaybackCommands()
+{
+    // apply structural changes of all the threads: commands of each kind are
+    // gathered from all the buffers and grouped (by a prefab or a component type),
+    // so each group is applied by a single batch with SORTED ids
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+    PROFILE_SCOPE("EntityMgr::PlaybackCommands");
+
+    using PrefabCmd = CommandBuffer::PrefabCmd;
+    using RemoveCmd = CommandBuffer::RemoveCmd;
+
+    // a prefab command and the idx of its buffer
+    struct Cmd
+    {
+        const PrefabCmd* pCmd      = nullptr;
+        int              bufferIdx = 0;
+    };
+
+    cvector<Cmd>       creates;
+    cvector<Cmd>       adds;
+    cvector<RemoveCmd> removes;
+    cvector<EntityID>  destroys;
 
-    for (const Event& e : events_)
+    for (int i = 0; i < MAX_CMD_BUFFERS; ++i)
     {
-        switch (e.type)
+        CommandBuffer& buffer = cmdBuffers_[i];
+        buffer.createdEntts_.resize(buffer.numCreated_);
+
+        if (buffer.IsEmpty())
+            continue;
+
+        for (const PrefabCmd& cmd : buffer.creates_)
+            creates.push_back({ &cmd, i });
+
+        for (const PrefabCmd& cmd : buffer.adds_)
+            adds.push_back({ &cmd, i });
+
+        removes.append_vector(buffer.removes_);
+        destroys.append_vector(buffer.destroys_);
+    }
+
+    cvector<XMFLOAT3> positions;
+    cvector<XMVECTOR> dirQuats;
+    cvector<float>    scales;
+    cvector<EntityID> ids;
+
+    // gather transforms of the group [start, end)
+    const auto gatherTransforms = [&](const cvector<Cmd>& cmds, const index start, const index end)
+    {
+        positions.clear();
+        dirQuats.clear();
+        scales.clear();
+
+        for (index i = start; i < end; ++i)
         {
-            case EVENT_TRANSLATE:
-            {
-                // compute offset for translation
-                EntityID id = e.enttID;
-                XMFLOAT3 prevPos = transformSystem_.GetPosition(id);
-                XMFLOAT3 offset = { e.x-prevPos.x, e.y-prevPos.y, e.z-prevPos.z };
+            positions.push_back(cmds[i].pCmd->pos);
+            dirQuats.push_back(cmds[i].pCmd->dirQuat);
+            scales.push_back(cmds[i].pCmd->uniformScale);
+        }
+    };
 
-                // make an arr of entt and its children's ids
-                hierarchySystem_.GetChildrenArr(id, ids);
-                ids.push_back(id);
+    // CREATE: a batch per prefab
+    std::stable_sort(creates.begin(), creates.end(),
+        [](const Cmd& a, const Cmd& b) { return a.pCmd->pPrefab < b.pCmd->pPrefab; });
 
-                // adjust position for entt and its children
-                transformSystem_.AdjustPositions(ids.data(), ids.size(), { offset.x, offset.y, offset.z });
+    for (index start = 0, end = 0; start < creates.size(); start = end)
+    {
+        const Prefab* pPrefab = creates[start].pCmd->pPrefab;
 
-#if 0
-                EntityID playerID = playerSystem_.GetPlayerID();
-                XMFLOAT3 t = { e.x, e.y, e.z };
-                XMFLOAT3 playerOldPos = playerSystem_.GetPosition();
+        while ((end < creates.size()) && (creates[end].pCmd->pPrefab == pPrefab))
+            ++end;
 
-                cvector<EntityID> ids;
-                hierarchySystem_.GetChildrenArr(playerID, ids);
-                ids.push_back(playerID);
+        gatherTransforms(creates, start, end);
+        ids = Instantiate(*pPrefab, end - start, positions.data(), dirQuats.data(), scales.data());
 
-                XMFLOAT3 offset = { t.x-playerOldPos.x, t.y - playerOldPos.y, t.z - playerOldPos.z};
+        // the i-th created entt is placed by the i-th position
+        for (index i = 0; i < ids.size(); ++i)
+        {
+            const Cmd& cmd = creates[start + i];
+            cmdBuffers_[cmd.bufferIdx].createdEntts_[cmd.pCmd->createIdx] = ids[i];
+        }
+    }
 
-                transformSystem_.AdjustPositions(ids.data(), ids.size(), { offset.x, offset.y, offset.z });
-#endif
-                break;
-            }
-            case EVENT_ROTATE:
-            {
-                break;
-            }
-            case EVENT_SCALE:
-            {
-                break;
-            }
-            case EVENT_PLAYER_RUN:              // set the player is running or not
-            {
-                playerSystem_.SetIsRunning(e.x);
-                break;
-            }
-            case EVENT_PLAYER_JUMP:
-            {
-                playerSystem_.Move(ePlayerState::JUMP);
-                break;
-            }
-            case EVENT_PLAYER_MOVE_FORWARD:
-            {
-                playerSystem_.Move(ePlayerState::MOVE_FORWARD);
-                break;
-            }
-            case EVENT_PLAYER_MOVE_BACK:
-            {
-                playerSystem_.Move(ePlayerState::MOVE_BACK);
-                break;
-            }
-            case EVENT_PLAYER_MOVE_RIGHT:
-            {
-                playerSystem_.Move(ePlayerState::MOVE_RIGHT);
-                break;
-            }
-            case EVENT_PLAYER_MOVE_LEFT:
-            {
-                playerSystem_.Move(ePlayerState::MOVE_LEFT);
-                break;
-            }
-            case EVENT_PLAYER_MOVE_UP:
-            {
-                playerSystem_.Move(ePlayerState::MOVE_UP);
-                break;
-            }
-            case EVENT_PLAYER_MOVE_DOWN:
+    // ADD COMPONENTS: a batch per prefab (by SORTED ids of entts which don't have them)
+    std::sort(adds.begin(), adds.end(), [](const Cmd& a, const Cmd& b)
+    {
+        return (a.pCmd->pPrefab != b.pCmd->pPrefab) ? (a.pCmd->pPrefab < b.pCmd->pPrefab) : (a.pCmd->id < b.pCmd->id);
+    });
+
+    for (index start = 0, end = 0; start < adds.size(); start = end)
+    {
+        const Prefab* pPrefab = adds[start].pCmd->pPrefab;
+
+        while ((end < adds.size()) && (adds[end].pCmd->pPrefab == pPrefab))
+            ++end;
+
+        // skip duplicates and entts which already have some of the components
+        index numValid = start;
+
+        for (index i = start; i < end; ++i)
+        {
+            const EntityID id = adds[i].pCmd->id;
+
+            if ((numValid > start) && (adds[numValid - 1].pCmd->id == id))
+                continue;
+
+            if (!sparseIdxs_.Has(id) || (componentHashes_[sparseIdxs_.GetIdx(id)] & pPrefab->components))
             {
-                playerSystem_.Move(ePlayerState::MOVE_DOWN);
-                break;
+                sprintf(g_String, "can't add components of a prefab: there is no entt or it already has some of them: %u", id);
+                LogErr(g_String);
+                continue;
             }
+
+            adds[numValid++] = adds[i];
         }
+
+        if (numValid == start)
+            continue;
+
+        gatherTransforms(adds, start, numValid);
+        ids.resize(numValid - start);
+
+        for (index i = start; i < numValid; ++i)
+            ids[i - start] = adds[i].pCmd->id;
+
+        AddPrefabComponents(*pPrefab, ids.data(), ids.size(), positions.data(), dirQuats.data(), scales.data());
+    }
+
+    // REMOVE COMPONENTS: a batch per component type
+    std::sort(removes.begin(), removes.end(),
+        [](const RemoveCmd& a, const RemoveCmd& b) { return a.type < b.type; });
+
+    for (index start = 0, end = 0; start < removes.size(); start = end)
+    {
+        const eComponentType type = removes[start].type;
+        ids.clear();
+
+        for (; (end < removes.size()) && (removes[end].type == type); ++end)
+            ids.push_back(removes[end].id);
+
+        RemoveComponent(ids.data(), ids.size(), type);
     }
 
+    // DESTROY: a single batch (duplicates are removed by it)
+    if (!destroys.empty())
+        DestroyEntities(destroys.data(), destroys.size());
 
-    playerSystem_.Update(deltaTime);
+    for (CommandBuffer& buffer : cmdBuffers_)
+        buffer.Clear();
+}
 
-    // we handled all the events so clear the list of event
-    events_.clear();
+///////////////////////////////////////////////////////////
 
+void EntityMgr::InitUpdateScheduler()
+{
+    // register update tasks with sets of components which
+    // they read/write; NOTE: the order of registration matters
+
+    SystemScheduler& scheduler = updateScheduler_;
+
+    scheduler.AddTask(
+        "movement",
+        MoveSystem::UPDATE_READS,
+        MoveSystem::UPDATE_WRITES,
+        [this]() { moveSystem_.UpdateAllMoves(updateDeltaTime_, transformSystem_); });
+
+    scheduler.AddTask(
+        "texture_transform",
+        TextureTransformSystem::UPDATE_READS,
+        TextureTransformSystem::UPDATE_WRITES,
+        [this]() { texTransformSystem_.UpdateAllTextrureAnimations(updateTotalTime_, updateDeltaTime_); });
+
+    scheduler.AddTask(
+        "light",
+        LightSystem::UPDATE_READS,
+        LightSystem::UPDATE_WRITES,
+        [this]() { lightSystem_.Update(updateDeltaTime_, updateTotalTime_); });
+
+    scheduler.AddTask(
+        "events",
+        GetComponentBit(HierarchyComponent),
+        GetComponentBit(TransformComponent) | GetComponentBit(PlayerComponent),
+        [this]() { HandleEvents(); });
+
+    scheduler.AddTask(
+        "player",
+        PlayerSystem::UPDATE_READS,
+        PlayerSystem::UPDATE_WRITES,
+        [this]() { playerSystem_.Update(updateDeltaTime_); });
+
+    // move children after their parents (parents were moved by all the tasks above)
+    scheduler.AddTask(
+        "hierarchy",
+        HierarchySystem::UPDATE_READS,
+        HierarchySystem::UPDATE_WRITES,
+        [this]() { hierarchySystem_.PropagateTransforms(); });
+
+    // recompute matrices only of entts which were moved/rotated/scaled during this frame
+    scheduler.AddTask(
+        "transform_flush",
+        TransformSystem::FLUSH_READS,
+        TransformSystem::FLUSH_WRITES,
+        [this]() { transformSystem_.FlushDirty(); });
+
+    // refresh world bounds only of entts which were moved during this frame
+    scheduler.AddTask(
+        "bounding_update",
+        BoundingSystem::UPDATE_READS,
+        BoundingSystem::UPDATE_WRITES,
+        [this]() { boundingSystem_.UpdateWorldBounds(transformSystem_); });
+
+    // colliding pairs by the final positions of the step
+    scheduler.AddTask(
+        "collision",
+        ColliderSystem::UPDATE_READS,
+        ColliderSystem::UPDATE_WRITES,
+        [this]() { colliderSystem_.Update(transformSystem_); });
+
+    // gains/panning of sound emitters by their final positions of the step
+    scheduler.AddTask(
+        "sound",
+        SoundSystem::UPDATE_READS,
+        SoundSystem::UPDATE_WRITES,
+        [this]() { soundSystem_.Update(); });
+
+    // particles to spawn are accumulated by steps (they are spawned on GPU once per frame)
+    scheduler.AddTask(
+        "particles",
+        ParticleSystem::UPDATE_READS,
+        ParticleSystem::UPDATE_WRITES,
+        [this]() { particleSystem_.Update(updateDeltaTime_); });
+
+    // playback times of skeletal animations (poses are sampled on GPU)
+    scheduler.AddTask(
+        "animation",
+        AnimationSystem::UPDATE_READS,
+        AnimationSystem::UPDATE_WRITES,
+        [this]() { animationSystem_.Update(updateDeltaTime_); });
 }
 
+///////////////////////////////////////////////////////////
+
+void EntityMgr::HandleEvents()
+{
+    // the sync point of events: take all the events which were added since
+    // the prev frame and dispatch them by batches (one batch per event type)
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    EventBatches& batches = eventBatches_;
+    eventQueue_.Drain(batches);
+
+    const uint32 numDropped = eventQueue_.ResetNumDropped();
+
+    if (numDropped > 0)
+    {
+        sprintf(g_String, "the events queue is full: %u events were dropped", numDropped);
+        LogErr(g_String);
+    }
+
+    // translate entts and their children
+    cvector<EntityID> ids(16);
+
+    for (const Event& e : batches.Get(EVENT_TRANSLATE))
+    {
+        // compute offset for translation
+        EntityID id = e.enttID;
+        XMFLOAT3 prevPos = transformSystem_.GetPosition(id);
+        XMFLOAT3 offset = { e.x-prevPos.x, e.y-prevPos.y, e.z-prevPos.z };
+
+        // make an arr of entt and its children's ids
+        hierarchySystem_.GetChildrenArr(id, ids);
+        ids.push_back(id);
+
+        // adjust position for entt and its children
+        transformSystem_.AdjustPositions(ids.data(), ids.size(), { offset.x, offset.y, offset.z });
+    }
+
+    // set the player is running or not (only the latest state matters)
+    const cvector<Event>& runEvents = batches.Get(EVENT_PLAYER_RUN);
+
+    if (!runEvents.empty())
+        playerSystem_.SetIsRunning(runEvents.back().x);
+
+    // player's movement states are flags so we set each of them once
+    constexpr std::pair<eEventType, ePlayerState> moveEvents[] =
+    {
+        { EVENT_PLAYER_JUMP,         ePlayerState::JUMP },
+        { EVENT_PLAYER_MOVE_FORWARD, ePlayerState::MOVE_FORWARD },
+        { EVENT_PLAYER_MOVE_BACK,    ePlayerState::MOVE_BACK },
+        { EVENT_PLAYER_MOVE_RIGHT,   ePlayerState::MOVE_RIGHT },
+        { EVENT_PLAYER_MOVE_LEFT,    ePlayerState::MOVE_LEFT },
+        { EVENT_PLAYER_MOVE_UP,      ePlayerState::MOVE_UP },
+        { EVENT_PLAYER_MOVE_DOWN,    ePlayerState::MOVE_DOWN },
+    };
+
+    for (const auto& [eventType, state] : moveEvents)
+    {
+        if (!batches.Get(eventType).empty())
+            playerSystem_.Move(state);
+    }
+
+    // NOTE: EVENT_ROTATE and EVENT_SCALE aren't handled yet
+
+    // we handled all the events so clear the batches (memory is kept)
+    batches.Clear();
+}
+
+///////////////////////////////////////////////////////////
+
 void EntityMgr::AddEvent(const Event& e)
 {
-    events_.push_back(e);
+    // NOTE: if the queue is full the event is dropped (it is reported in HandleEvents)
+    eventQueue_.Push(e);
 }
 
 // *********************************************************************************
@@ -324,8 +988,10 @@ void EntityMgr::SetEnttHasComponent(
     const eComponentType compType)
 {
     // set that an entity by ID has such a component 
-    const index idx = ids_.get_idx(id);
-    componentHashes_[idx] |= (1 << compType);
+    const index idx = sparseIdxs_.GetIdx(id);
+    componentHashes_[idx] |= GetComponentBit(compType);
+
+    UpdateQueries(&id, 1, GetComponentBit(compType));
 }
 
 ///////////////////////////////////////////////////////////
@@ -338,13 +1004,15 @@ void EntityMgr::SetEnttsHaveComponent(
     // add the same component to each input entt
 
     cvector<index> idxs;
-    ids_.get_idxs(ids, numEntts, idxs);
+    sparseIdxs_.GetIdxs(ids, numEntts, idxs, 0);
 
     // generate hash mask by input component type
-    ComponentBitfield hashMask = 1 << compType;
+    const ComponentBitfield hashMask = GetComponentBit(compType);
 
     for (const index idx : idxs)
         componentHashes_[idx] |= hashMask;
+
+    UpdateQueries(ids, numEntts, hashMask);
 }
 
 ///////////////////////////////////////////////////////////
@@ -358,7 +1026,7 @@ void EntityMgr::SetEnttsHaveComponents(
 
     // get data idx of each input entt
     cvector<index> idxs;
-    ids_.get_idxs(ids, numEntts, idxs);
+    sparseIdxs_.GetIdxs(ids, numEntts, idxs, 0);
 
     // generate hash mask by input component types
     ComponentBitfield hashMask = 0;
@@ -367,6 +1035,35 @@ void EntityMgr::SetEnttsHaveComponents(
 
     for (const index idx : idxs)
         componentHashes_[idx] |= hashMask;
+
+    UpdateQueries(ids, numEntts, hashMask);
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::UpdateQueries(
+    const EntityID* ids,
+    const size numEntts,
+    const ComponentBitfield addedMask)
+{
+    // add input entts into the cached queries which they match now
+
+    ++structureVersion_;
+
+    if (queries_.empty())
+        return;
+
+    cvector<index> idxs;
+    cvector<ComponentBitfield> hashes;
+
+    sparseIdxs_.GetIdxs(ids, numEntts, idxs, 0);
+    componentHashes_.get_data_by_idxs(idxs, hashes);
+
+    for (std::unique_ptr<QueryBase>& pQuery : queries_)
+    {
+        if (pQuery->GetMask() & addedMask)
+            pQuery->OnComponentsAdded(ids, hashes.data(), numEntts);
+    }
 }
 
 ///////////////////////////////////////////////////////////
@@ -374,6 +1071,8 @@ void EntityMgr::SetEnttsHaveComponents(
 void EntityMgr::AddNameComponent(const EntityID& id, const std::string& name)
 {
     // add the Name component to a single entity in terms of arrays
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     AddNameComponent(&id, &name, 1);
 }
 
@@ -386,6 +1085,8 @@ void EntityMgr::AddNameComponent(
 {
     // add the Name component to all the input entities
     // so each entity will have its own name
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     try
     {
         nameSystem_.AddRecords(ids, names, numEntts);
@@ -407,6 +1108,8 @@ void EntityMgr::AddTransformComponent(
     const float uniformScale)
 {
     // add the Transform component to a single entity in terms of arrays
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     AddTransformComponent(&enttID, 1, &position, &dirQuat, &uniformScale);
 }
 
@@ -420,6 +1123,8 @@ void EntityMgr::AddTransformComponent(
     const float* uniformScales)
 {
     // add transform component to all the input entities
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     try
     {
         transformSystem_.AddRecords(ids, positions, dirQuats, uniformScales, numEntts);
@@ -442,6 +1147,8 @@ void EntityMgr::AddMoveComponent(
     const float uniformScaleFactor)
 {
     // add the Move component to a single entity
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     AddMoveComponent(&id, &translation, &rotationQuat, &uniformScaleFactor, 1);
 }
 
@@ -456,6 +1163,7 @@ void EntityMgr::AddMoveComponent(
 {
     // add the Move component to all the input entities;
     // and setup entities movement using input data arrays
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
 
     try
     {
@@ -477,6 +1185,8 @@ void EntityMgr::AddModelComponent(
     const ModelID modelID)
 {
     // add the Model component: relate a single entity ID to a single modelID
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     AddModelComponent(&enttID, modelID, 1);
 }
 
@@ -489,6 +1199,7 @@ void EntityMgr::AddModelComponent(
 {
     // add the Model component to each input entity by ID in terms of arrays;
     // here we relate the same model to each input entt
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
 
     try
     {
@@ -513,6 +1224,7 @@ void EntityMgr::AddModelComponent(
 {
     // add ModelComponent to each entity by its ID; 
     // and bind to each input entity a model by respective idx (one to one)
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
 
     try
     {
@@ -542,6 +1254,8 @@ void EntityMgr::AddRenderingComponent(
     const RenderInitParams& params)
 {
     // add rendering component to a single entity by ID
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     AddRenderingComponent(&id, 1, &params);
 }
 
@@ -554,6 +1268,7 @@ void EntityMgr::AddRenderingComponent(
 {
     // add the Rendered component to each input entity by ID
     // and setup them with the same rendering params 
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
 
     const cvector<RenderInitParams> paramsArr(numEntts, params);
     AddRenderingComponent(ids, numEntts, paramsArr.data());
@@ -568,6 +1283,7 @@ void EntityMgr::AddRenderingComponent(
 {
     // add RenderComponent to each entity by its ID; 
     // so these entities will be rendered onto the screen
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
 
     try
     {
@@ -598,6 +1314,7 @@ void EntityMgr::AddMaterialComponent(
     // in: materialsIDs          -- arr of material IDs (each material ID will be related to a single submesh of the entity)
     //     numSubmeshes          -- how many meshes does input entity have
     //     areMaterialsMeshBased -- defines if all the materials IDs are the same as materials IDs of the related model
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
 
     try
     {
@@ -609,7 +1326,7 @@ void EntityMgr::AddMaterialComponent(
     }
     catch (EngineException& e)
     {
-        sprintf(g_String, "can't add Material component to entt (id: %ud; name: %s)", enttID, nameSystem_.GetNameById(enttID).c_str());
+        sprintf(g_String, "can't add Material component to entt (id: %ud; name: %s)", enttID, nameSystem_.GetNameById(enttID));
         LogErr(e);
         LogErr(g_String);
     }
@@ -617,12 +1334,39 @@ void EntityMgr::AddMaterialComponent(
 
 ///////////////////////////////////////////////////////////
 
+void EntityMgr::AddMaterialComponent(
+    const EntityID* ids,
+    const size numEntts,
+    const MaterialID* materialsIDs,
+    const size numSubmeshes,
+    const bool areMaterialsMeshBased)
+{
+    // add the same set of materials to each input entity by ID
+    // (for instance: we have 100 the same trees with the same materials)
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    try
+    {
+        materialSystem_.AddRecords(ids, numEntts, materialsIDs, numSubmeshes, areMaterialsMeshBased);
+        SetEnttsHaveComponent(ids, numEntts, MaterialComponent);
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr(GetErrMsg("can't add Material component to entts: ", ids, numEntts).c_str());
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 void EntityMgr::AddTextureTransformComponent(
     const EntityID id,
     const TexTransformType type,
     const TexTransformInitParams& params)
 {
     // add texture transformation to a signle entity by ID
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     AddTextureTransformComponent(&id, 1, type, params);
 }
 
@@ -638,6 +1382,7 @@ void EntityMgr::AddTextureTransformComponent(
     //
     // in:   type     -- what kind of texture transformation we want to apply?
     //       params -- struct of arrays of texture transformations params according to the input type
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
 
     try
     {
@@ -660,6 +1405,8 @@ void EntityMgr::AddLightComponent(
     DirLightsInitParams& params)
 {
     // add light component (directed light) to each input entity by ID 
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     try
     {
         lightSystem_.AddDirLights(ids, numEntts, params);
@@ -679,6 +1426,8 @@ void EntityMgr::AddLightComponent(
     const size numEntts,
     PointLightsInitParams& params)
 {
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     try
     {
         lightSystem_.AddPointLights(ids, numEntts, params);
@@ -700,6 +1449,8 @@ void EntityMgr::AddLightComponent(
 {
     // add light component to each input entity by ID;
     // 
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     try
     {
         lightSystem_.AddSpotLights(ids, numEntts, params);
@@ -717,6 +1468,8 @@ void EntityMgr::AddLightComponent(
 void EntityMgr::AddRenderStatesComponent(const EntityID id)
 {
     // add the RenderStates component to the input entt and setup it with DEFAULT states
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     AddRenderStatesComponent(&id, 1);
 }
 
@@ -726,6 +1479,8 @@ void EntityMgr::AddRenderStatesComponent(const EntityID* ids, const size numEntt
 {
     // add the RenderStates component to the input entts and 
     // setup each with DEFAULT states
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     try
     {
         renderStatesSystem_.AddWithDefaultStates(ids, numEntts);
@@ -747,6 +1502,8 @@ void EntityMgr::AddBoundingComponent(
     const DirectX::BoundingBox& aabb)
 {
     // add bounding component to a single entity
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     try
     {
         boundingSystem_.Add(id, type, aabb);
@@ -771,6 +1528,8 @@ void EntityMgr::AddBoundingComponent(
 {
     // apply the same set of AABBs to each input entity
     // (for instance: we have 100 the same trees so each will have the same set of AABBs)
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     try
     {
         boundingSystem_.Add(ids, numEntts, numSubsets, types, AABBs);
@@ -791,6 +1550,8 @@ void EntityMgr::AddBoundingComponent(
     const DirectX::BoundingSphere* spheres,
     const size numEntts)
 {
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     assert(0 && "FIXME");
     // add bounding spheres to each input entity by ID (input arrays are supposed to be equal)
     try
@@ -811,6 +1572,8 @@ void EntityMgr::AddBoundingComponent(
 void EntityMgr::AddCameraComponent(const EntityID id, const CameraData& data)
 {
     // add a camera component to the entity by input ID
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     try
     {
         cameraSystem_.AddRecord(id, data);
@@ -829,6 +1592,8 @@ void EntityMgr::AddCameraComponent(const EntityID id, const CameraData& data)
 void EntityMgr::AddPlayerComponent(const EntityID id)
 {
     // add a player component to the entity by input ID
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
     try
     {
         playerSystem_.SetPlayer(id);
@@ -842,17 +1607,303 @@ void EntityMgr::AddPlayerComponent(const EntityID id)
     }
 }
 
+///////////////////////////////////////////////////////////
+
+void EntityMgr::AddSoundEmitterComponent(
+    const EntityID id,
+    const uint32 soundID,
+    const float volume,
+    const float minDist,
+    const float maxDist,
+    const uint8 priority)
+{
+    // add a sound emitter component to the entity by input ID
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    try
+    {
+        soundSystem_.AddRecords(&id, &soundID, &volume, &minDist, &maxDist, &priority, 1);
+        SetEnttHasComponent(id, SoundEmitterComponent);
+    }
+    catch (EngineException& e)
+    {
+        sprintf(g_String, "can't add a sound emitter component to entt: %ud", id);
+        LogErr(e);
+        LogErr(g_String);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::AddParticleEmitterComponent(const EntityID id, const ParticleEmitterParams& params)
+{
+    // add a particle emitter component to the entity by input ID
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    try
+    {
+        particleSystem_.AddRecords(&id, &params, 1);
+        SetEnttHasComponent(id, ParticleEmitterComponent);
+    }
+    catch (EngineException& e)
+    {
+        sprintf(g_String, "can't add a particle emitter component to entt: %ud", id);
+        LogErr(e);
+        LogErr(g_String);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::AddColliderComponent(
+    const EntityID id,
+    const eColliderShape shape,
+    const uint32 layer,
+    const uint32 mask)
+{
+    // add a collider component to the entity by input ID;
+    // its shape is made from the local bounds of the entity
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    try
+    {
+        CAssert::True(bounding_.sparseIdxs.Has(id), "the entity has no bounding component");
+
+        cvector<DirectX::BoundingSphere> spheres;
+        DirectX::BoundingBox aabb;
+
+        boundingSystem_.GetBoundSpheres(&id, 1, spheres);
+        boundingSystem_.GetAABB(id, aabb);
+
+        ColliderData data;
+        data.sphere = spheres[0];
+        data.layer  = layer;
+        data.mask   = mask;
+        data.shape  = shape;
+        DirectX::BoundingOrientedBox::CreateFromBoundingBox(data.obb, aabb);
+
+        colliderSystem_.AddRecords(&id, &data, 1);
+        SetEnttHasComponent(id, ColliderComponent);
+    }
+    catch (EngineException& e)
+    {
+        sprintf(g_String, "can't add a collider component to entt: %ud", id);
+        LogErr(e);
+        LogErr(g_String);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::AddAnimatorComponent(
+    const EntityID id,
+    const uint16 clipIdx,
+    const float speed,
+    const float time)
+{
+    // add an animator component to the entity by input ID
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    try
+    {
+        animationSystem_.AddRecords(&id, &clipIdx, &speed, &time, 1);
+        SetEnttHasComponent(id, AnimatorComponent);
+    }
+    catch (EngineException& e)
+    {
+        sprintf(g_String, "can't add an animator component to entt: %ud", id);
+        LogErr(e);
+        LogErr(g_String);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::AddPortalComponent(const EntityID id, const PortalData& data)
+{
+    // add a portal component (a cell or a portal) to the entity by input ID
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+
+    try
+    {
+        portalSystem_.AddRecords(&id, &data, 1);
+        SetEnttHasComponent(id, PortalComponent);
+    }
+    catch (EngineException& e)
+    {
+        sprintf(g_String, "can't add a portal component to entt: %ud", id);
+        LogErr(e);
+        LogErr(g_String);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::AddPortalCellComponent(const EntityID id, const DirectX::XMFLOAT3& extents)
+{
+    // add a cell (a box of a room) to the entity by input ID
+
+    PortalData data;
+    data.type    = PORTAL_TYPE_CELL;
+    data.extents = extents;
+
+    // fit the cell to the local bounds of the entity
+    if ((extents.x <= 0) || (extents.y <= 0) || (extents.z <= 0))
+    {
+        if (!bounding_.sparseIdxs.Has(id))
+        {
+            sprintf(g_String, "can't add a portal cell to entt: %ud (no extents and no bounding component)", id);
+            LogErr(g_String);
+            return;
+        }
+
+        DirectX::BoundingBox aabb;
+        boundingSystem_.GetAABB(id, aabb);
+
+        data.center  = aabb.Center;
+        data.extents = aabb.Extents;
+    }
+
+    AddPortalComponent(id, data);
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::AddPortalComponent(
+    const EntityID id,
+    const float halfWidth,
+    const float halfHeight,
+    const EntityID cellBack,
+    const EntityID cellFront)
+{
+    // add a portal (an opening between cells) to the entity by input ID
+
+    PortalData data;
+    data.type     = PORTAL_TYPE_PORTAL;
+    data.extents  = { halfWidth, halfHeight, 0 };
+    data.cells[PORTAL_SIDE_BACK]  = cellBack;
+    data.cells[PORTAL_SIDE_FRONT] = cellFront;
+
+    AddPortalComponent(id, data);
+}
+
 #pragma endregion
 
 
+// ************************************************************************************
+//                            PUBLIC SPATIAL QUERIES
+// ************************************************************************************
+
+void EntityMgr::QuerySphere(
+    const XMFLOAT3& center,
+    const float radius,
+    cvector<EntityID>& outIds,
+    const ComponentBitfield withComponents) const
+{
+    outIds.clear();
+    boundingSystem_.QuerySphere(center, radius, outIds);
+    FilterByComponents(outIds, nullptr, withComponents);
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::QueryAABB(
+    const XMFLOAT3& aabbMin,
+    const XMFLOAT3& aabbMax,
+    cvector<EntityID>& outIds,
+    const ComponentBitfield withComponents) const
+{
+    outIds.clear();
+    boundingSystem_.QueryAABB(aabbMin, aabbMax, outIds);
+    FilterByComponents(outIds, nullptr, withComponents);
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::QueryNearest(
+    const XMFLOAT3& point,
+    const int k,
+    const float maxDist,
+    cvector<EntityID>& outIds,
+    cvector<float>& outDists,
+    const ComponentBitfield withComponents) const
+{
+    // the filter goes inside of the traversal so we get k entts
+    // which match it (and not k nearest ones of any kind)
+    const auto filter = [this, withComponents](const EntityID id)
+    {
+        return EnttHasComponents(id, withComponents);
+    };
+
+    boundingSystem_.QueryNearest(point, k, maxDist, filter, outIds, outDists);
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityMgr::QueryRay(
+    const XMFLOAT3& origin,
+    const XMFLOAT3& dir,
+    const float maxDist,
+    cvector<EntityID>& outIds,
+    cvector<float>& outDists,
+    const ComponentBitfield withComponents) const
+{
+    outIds.clear();
+    outDists.clear();
+
+    boundingSystem_.QueryRay(origin, dir, maxDist, outIds, outDists);
+    FilterByComponents(outIds, &outDists, withComponents);
+
+    // sort hits by distance (insertion sort: there are only a few of them usually)
+    for (index i = 1; i < outIds.size(); ++i)
+    {
+        const EntityID id   = outIds[i];
+        const float    dist = outDists[i];
+        index j = i;
+
+        for (; (j > 0) && (outDists[j-1] > dist); --j)
+        {
+            outIds[j]   = outIds[j-1];
+            outDists[j] = outDists[j-1];
+        }
+
+        outIds[j]   = id;
+        outDists[j] = dist;
+    }
+}
+
+
 // ************************************************************************************
 //                               PRIVATE HELPERS
 // ************************************************************************************
 
-ComponentBitfield EntityMgr::GetHashByComponent(const eComponentType component)
+void EntityMgr::FilterByComponents(
+    cvector<EntityID>& ids,
+    cvector<float>* pDists,
+    const ComponentBitfield mask) const
 {
-    ComponentBitfield bitmask = 0;
-    return (bitmask |= (1 << component));
+    // compact arrays in place (the order is kept)
+    if (mask == 0)
+        return;
+
+    size num = 0;
+
+    for (index i = 0; i < ids.size(); ++i)
+    {
+        const bool keep = EnttHasComponents(ids[i], mask);
+
+        ids[num] = ids[i];
+
+        if (pDists)
+            (*pDists)[num] = (*pDists)[i];
+
+        num += keep;
+    }
+
+    ids.resize(num);
+
+    if (pDists)
+        pDists->resize(num);
 }
 
 ///////////////////////////////////////////////////////////
@@ -879,8 +1930,8 @@ bool EntityMgr::GetComponentNamesByEntt(const EntityID id, cvector<std::string>&
     // out:    names array of components which are added to entity by ID;
     // return: false if there is no entity by ID
 
-    const index idx = ids_.get_idx(id);
-    const bool exist = (ids_[idx] == id);
+    const index idx = sparseIdxs_.GetIdx(id);
+    const bool exist = (idx != SparseSet::INVALID_IDX);
 
     if (!exist)
     {
@@ -893,8 +1944,8 @@ bool EntityMgr::GetComponentNamesByEntt(const EntityID id, cvector<std::string>&
 
     for (int i = 0; i < eComponentType::NUM_COMPONENTS; ++i)
     {
-        if (hash & (1 << i))
-            names.push_back(componentTypeToName_.at(eComponentType(i)));
+        if (hash & GetComponentBit(eComponentType(i)))
+            names.push_back(GetComponentName(eComponentType(i)));
     }
 
     return true;
@@ -907,8 +1958,8 @@ bool EntityMgr::GetComponentTypesByEntt(const EntityID id, cvector<uint8_t>& typ
     // out:    names array of component types which are added to entity by ID;
     // return: false if there is no entity by ID
 
-    const index idx = ids_.get_idx(id);
-    const bool exist = (ids_[idx] == id);
+    const index idx = sparseIdxs_.GetIdx(id);
+    const bool exist = (idx != SparseSet::INVALID_IDX);
 
     if (!exist)
     {
@@ -922,7 +1973,7 @@ bool EntityMgr::GetComponentTypesByEntt(const EntityID id, cvector<uint8_t>& typ
 
     for (int i = 0; i < (int)eComponentType::NUM_COMPONENTS; ++i)
     {
-        if (hash & (1 << i))
+        if (hash & GetComponentBit(eComponentType(i)))
             types.push_back((uint8_t)i);
     }
 
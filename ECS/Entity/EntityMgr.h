@@ -21,6 +21,11 @@
 #include "../Components/Camera.h"
 #include "../Components/Player.h"
 #include "../Components/Hierarchy.h"
+#include "../Components/SoundEmitter.h"
+#include "../Components/ParticleEmitter.h"
+#include "../Components/Collider.h"
+#include "../Components/Animator.h"
+#include "../Components/Portal.h"
 
 // systems (ECS)
 #include "../Systems/TransformSystem.h"
@@ -36,11 +41,24 @@
 #include "../Systems/CameraSystem.h"
 #include "../Systems/PlayerSystem.h"
 #include "../Systems/HierarchySystem.h"
+#include "../Systems/SoundSystem.h"
+#include "../Systems/ParticleSystem.h"
+#include "../Systems/ColliderSystem.h"
+#include "../Systems/AnimationSystem.h"
+#include "../Systems/PortalSystem.h"
+#include "../Systems/WorldPartitionSystem.h"
 
 // events (ECS)
 #include "../Events/IEvent.h"
+#include "../Events/EventQueue.h"
 
-#include <deque>
+#include "../Common/SystemScheduler.h"
+#include "../Common/ComponentRegistry.h"
+#include "../Common/Query.h"
+#include "../Common/Prefab.h"
+#include "../Common/CommandBuffer.h"
+
+#include <tuple>
 
 namespace ECS
 {
@@ -61,11 +79,33 @@ public:
 
     // public serialization / deserialization API
     bool Serialize(const std::string& dataFilepath);
-    bool Deserialize(const std::string& dataFilepath);
+    bool Deserialize(const std::string& dataFilepath);        // a world file or a world directory
+
+    // write all the data as chunks into memory of the writer (a snapshot
+    // which can be saved by another thread, see WorldFileWriter::SaveToDir)
+    bool Serialize(WorldFileWriter& writer);
+
+    // replace all the data with chunks of the reader (a loaded world file or a snapshot)
+    bool Deserialize(WorldFileReader& reader);
 
     // public creation/destroyment API
     cvector<EntityID> CreateEntities(const int newEnttsCount);
-    void DestroyEntities(const EntityID* ids, const size numEntts);
+    void DestroyEntities(const EntityID* ids, const size numEntts, const bool recycleIds = true);
+
+    // create entts with exactly these IDs (which were destroyed without recycling
+    // of their slots, see WorldPartitionSystem); components are added as usual
+    bool RestoreEntities(const EntityID* ids, const size numEntts);
+
+    // create numInstances entts with all the components of the prefab by a single
+    // batch (each component's arrays are merged once); an instance is placed by its
+    // position and gets the prefab's rotation/scale if dirQuats/uniformScales == nullptr;
+    // return: SORTED IDs of created entts (the i-th one is placed by positions[i])
+    cvector<EntityID> Instantiate(
+        const Prefab& prefab,
+        const size numInstances,
+        const XMFLOAT3* positions,
+        const XMVECTOR* dirQuats = nullptr,
+        const float* uniformScales = nullptr);
 
     EntityID CreateEntity();
     EntityID CreateEntity(const char* enttName);
@@ -73,8 +113,23 @@ public:
 
     void Update(const float totalGameTime, const float deltaTime);
 
+    // can be called from any thread (events are handled during the next Update)
     void AddEvent(const Event& e);
 
+    // a buffer of deferred structural changes of the calling thread (the main thread
+    // or a job of the job system): systems which are executed in parallel record
+    // changes into it and they are applied at the end of Update (see PlaybackCommands)
+    CommandBuffer& GetCommandBuffer();
+
+    // apply the recorded commands of all the threads: creates, adds of components,
+    // removes of components and destroys (each group by a single batch)
+    // NOTE: must not be called concurrently with the ECS update
+    void PlaybackCommands();
+
+    // remove a component from entts (which have it) by a single batch;
+    // NOTE: the player component can't be removed
+    void RemoveComponent(const EntityID* ids, const size numEntts, const eComponentType type);
+
     // =============================================================================
     // PUBLIC METHODS: ADD COMPONENTS 
     // =============================================================================
@@ -151,6 +206,13 @@ public:
         const size numSubmeshes,
         const bool areMaterialsMeshBased);
 
+    void AddMaterialComponent(               // the same materials set for each input entt
+        const EntityID* ids,
+        const size numEntts,
+        const MaterialID* materialsIDs,
+        const size numSubmeshes,
+        const bool areMaterialsMeshBased);
+
 
     // add TEXTURE TRANSFORM component
     void AddTextureTransformComponent(
@@ -208,6 +270,49 @@ public:
 
     void AddPlayerComponent(const EntityID id);
 
+    // add SOUND EMITTER component (a looped positional sound by ID of a preloaded sound)
+    void AddSoundEmitterComponent(
+        const EntityID id,
+        const uint32 soundID,
+        const float volume,
+        const float minDist,
+        const float maxDist,
+        const uint8 priority = 0);
+
+    // add PARTICLE EMITTER component (particles are spawned along the entity's up axis)
+    void AddParticleEmitterComponent(const EntityID id, const ParticleEmitterParams& params);
+
+    // add COLLIDER component: the local shape is taken from the Bounding component
+    // of the entity (its bounding sphere or the box around all its meshes)
+    void AddColliderComponent(
+        const EntityID id,
+        const eColliderShape shape,
+        const uint32 layer = 1,
+        const uint32 mask  = 0xFFFFFFFF);
+
+    // add ANIMATOR component: plays a clip of the entity's (skinned) model in a loop
+    void AddAnimatorComponent(
+        const EntityID id,
+        const uint16 clipIdx,
+        const float speed = 1.0f,
+        const float time  = 0.0f);
+
+    // add PORTAL component (a cell or a portal) by its full data
+    void AddPortalComponent(const EntityID id, const PortalData& data);
+
+    // add PORTAL component as a cell: a box of a room in local space of the entity;
+    // zero extents mean that the box is taken from the Bounding component of the entity
+    void AddPortalCellComponent(const EntityID id, const DirectX::XMFLOAT3& extents);
+
+    // add PORTAL component as a portal: a rectangle in the local XY plane of the entity;
+    // cells which aren't set are found automatically around the portal
+    void AddPortalComponent(
+        const EntityID id,
+        const float halfWidth,
+        const float halfHeight,
+        const EntityID cellBack  = INVALID_ENTITY_ID,
+        const EntityID cellFront = INVALID_ENTITY_ID);
+
 
     // =============================================================================
     // public API: QUERY
@@ -221,8 +326,34 @@ public:
     inline const TextureTransform&  GetComponentTexTransform()  const { return texTransform_; }
     inline const Light&             GetComponentLight()         const { return light_; }
     inline const Bounding&          GetComponentBounding()      const { return bounding_; }
-
-    inline const std::map<eComponentType, std::string>& GetMapCompTypeToName() { return componentTypeToName_; }
+    inline const RenderStates&      GetComponentRenderStates()  const { return renderStates_; }
+
+    // get a component's storage by its type
+    template <typename T>
+    const T& GetComponent() const;
+
+    // add a component T to entts: args are forwarded to the Add*Component method
+    // of this type (for instance: Add<ParticleEmitter>(id, params))
+    template <typename T, typename... Args>
+    void Add(Args&&... args);
+
+    // create a cached query of entts which have all the Ts components;
+    // the query is owned and kept up to date by the entity manager
+    // (for instance: CreateQuery<Transform, Rendered, Material>())
+    template <typename... Ts>
+    Query<Ts...>& CreateQuery();
+
+    // is changed each time when entts are created/destroyed or get new components
+    // (so caches of the renderer can find out that the scene is still the same)
+    inline uint32 GetStructureVersion() const { return structureVersion_; }
+
+    // does the entity have all the components Ts (the mask is made at compile time)
+    template <typename... Ts>
+    inline bool EnttHas(const EntityID id) const
+    {
+        const index idx = sparseIdxs_.GetIdx(id);
+        return (idx != SparseSet::INVALID_IDX) && ((componentHashes_[idx] & ComponentMask<Ts...>) == ComponentMask<Ts...>);
+    }
 
     inline const size      GetNumAllEntts() const { return ids_.size(); }
     inline const EntityID* GetAllEnttsIDs() const { return ids_.data(); }
@@ -230,11 +361,97 @@ public:
     bool GetComponentNamesByEntt(const EntityID id, cvector<std::string>& names) const;
     bool GetComponentTypesByEntt(const EntityID id, cvector<uint8_t>& types)     const;
 
-    inline bool CheckEnttExist(const EntityID id)                         const { return ids_.binary_search(id); }
-    inline bool CheckEnttsExist(const EntityID* ids, const size numEntts) const { return ids_.binary_search(ids, numEntts); }
+    inline bool CheckEnttExist(const EntityID id)                         const { return sparseIdxs_.Has(id); }
+    inline bool CheckEnttsExist(const EntityID* ids, const size numEntts) const { return sparseIdxs_.HasAll(ids, numEntts); }
+
+
+    // =============================================================================
+    // public API: SPATIAL QUERIES
+    // =============================================================================
+    // queries go over world bounds of entts which have the Bounding component
+    // (by its BVH); only entts which have all the components of withComponents
+    // are returned (0: any entt); output arrays are cleared;
+    // NOTE: must not be called concurrently with the ECS update
+
+    // entts whose world AABBs overlap the sphere / the box (unordered)
+    void QuerySphere(
+        const XMFLOAT3& center,
+        const float radius,
+        cvector<EntityID>& outIds,
+        const ComponentBitfield withComponents = 0) const;
+
+    void QueryAABB(
+        const XMFLOAT3& aabbMin,
+        const XMFLOAT3& aabbMax,
+        cvector<EntityID>& outIds,
+        const ComponentBitfield withComponents = 0) const;
+
+    // up to k entts which are the closest to the point (sorted by distance)
+    void QueryNearest(
+        const XMFLOAT3& point,
+        const int k,
+        const float maxDist,
+        cvector<EntityID>& outIds,
+        cvector<float>& outDists,
+        const ComponentBitfield withComponents = 0) const;
+
+    // entts whose world AABBs are hit by the ray (sorted by distance to entry points)
+    void QueryRay(
+        const XMFLOAT3& origin,
+        const XMFLOAT3& dir,
+        const float maxDist,
+        cvector<EntityID>& outIds,
+        cvector<float>& outDists,
+        const ComponentBitfield withComponents = 0) const;
 
 private:
-    ComponentBitfield GetHashByComponent(const eComponentType component);
+    // does the existing entt have all the components of the mask
+    inline bool EnttHasComponents(const EntityID id, const ComponentBitfield mask) const
+    {
+        return (componentHashes_[sparseIdxs_.GetIdx(id)] & mask) == mask;
+    }
+
+    // remove entts (and their distances) which don't have all the components of the mask
+    void FilterByComponents(cvector<EntityID>& ids, cvector<float>* pDists, const ComponentBitfield mask) const;
+
+    // get an ID for a new entity (a recycled one or with a new slot)
+    EntityID GenerateID();
+
+    // update cached queries after components were added to input entts
+    void UpdateQueries(const EntityID* ids, const size numEntts, const ComponentBitfield addedMask);
+
+    // add all the components of the prefab to SORTED entts (see Instantiate)
+    void AddPrefabComponents(
+        const Prefab& prefab,
+        const EntityID* ids,
+        const size numEntts,
+        const XMFLOAT3* positions,
+        const XMVECTOR* dirQuats,
+        const float* uniformScales);
+
+    // systems which store their data in world files (the order is the order of chunks)
+    inline auto GetSerializedSystems()
+    {
+        return std::tie(
+            nameSystem_, transformSystem_, moveSystem_, modelSystem_, renderSystem_,
+            materialSystem_, texTransformSystem_, lightSystem_, renderStatesSystem_,
+            boundingSystem_, cameraSystem_, hierarchySystem_, playerSystem_,
+            soundSystem_, particleSystem_, colliderSystem_, animationSystem_, portalSystem_);
+    }
+
+    // systems which keep records of entts (are removed when entts are destroyed)
+    inline auto GetRecordsSystems()
+    {
+        return std::tie(
+            nameSystem_, transformSystem_, moveSystem_, modelSystem_, renderSystem_,
+            materialSystem_, texTransformSystem_, lightSystem_, renderStatesSystem_,
+            boundingSystem_, cameraSystem_, hierarchySystem_, soundSystem_,
+            particleSystem_, colliderSystem_, animationSystem_, portalSystem_);
+    }
+
+    // update helpers
+    void InitUpdateScheduler();
+    void HandleEvents();
  
     // common setters: components
     void SetEnttHasComponent(
@@ -270,22 +487,50 @@ public:
     CameraSystem            cameraSystem_;
     PlayerSystem            playerSystem_;
     HierarchySystem         hierarchySystem_;
+    SoundSystem             soundSystem_;
+    ParticleSystem          particleSystem_;
+    ColliderSystem          colliderSystem_;
+    AnimationSystem         animationSystem_;
+    PortalSystem            portalSystem_;
+
+    // isn't a system of components: assigns entts to chunks and streams them
+    WorldPartitionSystem    worldPartitionSystem_;
     
 
-    // "ID" of an entity is just a numeral index
+    // "ID" of an entity is a slot index + generation (see MakeEnttID);
+    // NOTE: this array isn't sorted (destroyed entts are swapped with the last one)
     cvector<EntityID> ids_;
 
+    // O(1) lookup: entity ID => idx into ids_ and componentHashes_
+    SparseSet sparseIdxs_;
+
     // bit flags for every component, indicating whether this object "has it"
     cvector<ComponentBitfield> componentHashes_;
 
-    std::map<eComponentType, std::string> componentTypeToName_;  
-
 
 private:
-    std::deque<Event> events_;
+    // events from all the threads; they are dispatched in batches by types
+    EventQueue   eventQueue_;
+    EventBatches eventBatches_;
+
+    // executes systems updates according to their components dependencies
+    SystemScheduler  updateScheduler_;
+
+    // deferred structural changes: a buffer per thread of the job system
+    static constexpr int MAX_CMD_BUFFERS = 64;
+    CommandBuffer    cmdBuffers_[MAX_CMD_BUFFERS];
+    float            updateTotalTime_ = 0.0f;
+    float            updateDeltaTime_ = 0.0f;
 
     static int       lastEntityID_;
 
+    // IDs (slot + next generation) of destroyed entts for reusing
+    cvector<EntityID> freeIds_;
+
+    // cached queries of entts by components sets
+    cvector<std::unique_ptr<QueryBase>> queries_;
+    uint32                              structureVersion_ = 0;
+
     // COMPONENTS
     Transform        transform_;
     Movement         movement_;
@@ -299,6 +544,80 @@ private:
     Bounding         bounding_;
     Camera           camera_;
     Hierarchy        hierarchy_;
+    SoundEmitter     soundEmitters_;
+    ParticleEmitter  particleEmitters_;
+    Collider         colliders_;
+    Animator         animators_;
+    Portal           portals_;
 };
 
+
+// =================================================================================
+// TEMPLATES IMPLEMENTATION
+// =================================================================================
+template <typename T>
+const T& EntityMgr::GetComponent() const
+{
+    static_assert(RegisteredComponents::Contains<T>(), "the component isn't registered (see ComponentRegistry.h)");
+
+    if constexpr (std::is_same_v<T, Transform>)             return transform_;
+    else if constexpr (std::is_same_v<T, Movement>)         return movement_;
+    else if constexpr (std::is_same_v<T, Model>)            return modelComponent_;
+    else if constexpr (std::is_same_v<T, Rendered>)         return renderComponent_;
+    else if constexpr (std::is_same_v<T, Name>)             return names_;
+    else if constexpr (std::is_same_v<T, Material>)         return materialComponent_;
+    else if constexpr (std::is_same_v<T, TextureTransform>) return texTransform_;
+    else if constexpr (std::is_same_v<T, Light>)            return light_;
+    else if constexpr (std::is_same_v<T, RenderStates>)     return renderStates_;
+    else if constexpr (std::is_same_v<T, Bounding>)         return bounding_;
+    else if constexpr (std::is_same_v<T, Camera>)           return camera_;
+    else if constexpr (std::is_same_v<T, Hierarchy>)        return hierarchy_;
+    else if constexpr (std::is_same_v<T, SoundEmitter>)     return soundEmitters_;
+    else if constexpr (std::is_same_v<T, ParticleEmitter>)  return particleEmitters_;
+    else if constexpr (std::is_same_v<T, Collider>)         return colliders_;
+    else if constexpr (std::is_same_v<T, Animator>)         return animators_;
+    else if constexpr (std::is_same_v<T, Portal>)           return portals_;
+    else static_assert(!sizeof(T), "there is no such component in the entity manager");
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename T, typename... Args>
+void EntityMgr::Add(Args&&... args)
+{
+    static_assert(RegisteredComponents::Contains<T>(), "the component isn't registered (see ComponentRegistry.h)");
+
+    if constexpr (std::is_same_v<T, Transform>)             AddTransformComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, Movement>)         AddMoveComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, Model>)            AddModelComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, Rendered>)         AddRenderingComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, Name>)             AddNameComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, Material>)         AddMaterialComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, TextureTransform>) AddTextureTransformComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, Light>)            AddLightComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, RenderStates>)     AddRenderStatesComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, Bounding>)         AddBoundingComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, Camera>)           AddCameraComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, SoundEmitter>)     AddSoundEmitterComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, ParticleEmitter>)  AddParticleEmitterComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, Collider>)         AddColliderComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, Animator>)         AddAnimatorComponent(std::forward<Args>(args)...);
+    else if constexpr (std::is_same_v<T, Portal>)           AddPortalComponent(std::forward<Args>(args)...);
+    else static_assert(!sizeof(T), "the component can't be added by Add<T>() (see hierarchy methods)");
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename... Ts>
+Query<Ts...>& EntityMgr::CreateQuery()
+{
+    auto pQuery = std::make_unique<Query<Ts...>>(&GetComponent<Ts>()...);
+    pQuery->Reset(ids_.data(), componentHashes_.data(), ids_.size());
+
+    Query<Ts...>& query = *pQuery;
+    queries_.push_back(std::move(pQuery));
+
+    return query;
+}
+
 };
@@ -0,0 +1,98 @@
+// =================================================================================
+// Filename:     EventQueue.cpp
+// Description:  implementation of the EventQueue's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "EventQueue.h"
+
+
+namespace ECS
+{
+
+EventQueue::EventQueue()
+{
+    // each cell expects a producer with the same position
+    for (uint32 i = 0; i < CAPACITY; ++i)
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////
+
+bool EventQueue::Push(const Event& e)
+{
+    uint32 pos = enqueuePos_.load(std::memory_order_relaxed);
+    Cell* pCell = nullptr;
+
+    for (;;)
+    {
+        pCell = &cells_[pos & MASK];
+
+        const uint32 seq = pCell->sequence.load(std::memory_order_acquire);
+        const int diff = (int)(seq - pos);
+
+        // the cell is free: try to reserve it
+        if (diff == 0)
+        {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        // the cell still contains a not consumed event: the queue is full
+        else if (diff < 0)
+        {
+            numDropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // another producer has taken this position
+        else
+        {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    pCell->data = e;
+    pCell->sequence.store(pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool EventQueue::Pop(Event& outEvent)
+{
+    Cell& cell = cells_[dequeuePos_ & MASK];
+    const uint32 seq = cell.sequence.load(std::memory_order_acquire);
+
+    // there is no written event in this cell yet
+    if ((int)(seq - (dequeuePos_ + 1)) < 0)
+        return false;
+
+    outEvent = cell.data;
+
+    // free the cell for the producer of the next lap
+    cell.sequence.store(dequeuePos_ + CAPACITY, std::memory_order_release);
+    ++dequeuePos_;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+size EventQueue::Drain(EventBatches& outBatches)
+{
+    size numEvents = 0;
+    Event e;
+
+    // NOTE: the number of popped events is limited by the capacity so
+    //       producers which push events right now can't keep us here forever
+    while ((numEvents < CAPACITY) && Pop(e))
+    {
+        outBatches.batches[GetEventTypeIdx(e.type)].push_back(e);
+        ++numEvents;
+    }
+
+    return numEvents;
+}
+
+} // namespace ECS
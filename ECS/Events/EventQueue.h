@@ -0,0 +1,100 @@
+// =================================================================================
+// Filename:     EventQueue.h
+// Description:  a bounded lock-free queue of ECS events:
+//               multiple producers (any thread) / a single consumer;
+//
+//               the queue is a ring buffer of cells with sequence numbers:
+//               producers reserve a cell with a single CAS on the write position,
+//               the consumer reads cells in order without any atomic RMW ops;
+//               so pushing an event costs neither locks nor allocations
+//
+//               events are drained once per frame (in EntityMgr::Update)
+//               into batches grouped by event types
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "IEvent.h"
+#include <Types.h>
+#include <cvector.h>
+#include <atomic>
+
+namespace ECS
+{
+
+// =================================================================================
+// EVENTS GROUPED BY TYPES
+// =================================================================================
+struct EventBatches
+{
+    EventBatches()
+    {
+        // reserve memory once so batching doesn't allocate during the game
+        for (cvector<Event>& batch : batches)
+            batch.reserve(64);
+    }
+
+    inline const cvector<Event>& Get(const eEventType type) const
+    {
+        return batches[GetEventTypeIdx(type)];
+    }
+
+    inline void Clear()
+    {
+        for (cvector<Event>& batch : batches)
+            batch.clear();
+    }
+
+    cvector<Event> batches[NUM_EVENT_TYPES];
+};
+
+// =================================================================================
+// EVENT QUEUE
+// =================================================================================
+class EventQueue
+{
+public:
+    // max number of events which aren't handled yet (must be a power of 2)
+    static constexpr uint32 CAPACITY = 1024;
+
+    EventQueue();
+
+    // restrict copying
+    EventQueue(const EventQueue&) = delete;
+    EventQueue& operator=(const EventQueue&) = delete;
+
+    // can be called from any thread;
+    // return false if the queue is full (the event is dropped)
+    bool Push(const Event& e);
+
+    // NOTE: must be called only by the consumer thread
+    bool Pop(Event& outEvent);
+
+    // pop all the events which are in the queue at the moment and
+    // append them to batches by their types; return the number of events
+    // NOTE: must be called only by the consumer thread
+    size Drain(EventBatches& outBatches);
+
+    // get the number of dropped events since the prev call and reset it
+    inline uint32 ResetNumDropped() { return numDropped_.exchange(0, std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32 MASK = CAPACITY - 1;
+    static_assert((CAPACITY & MASK) == 0, "capacity of the event queue must be a power of 2");
+
+    struct Cell
+    {
+        std::atomic<uint32> sequence;
+        Event               data;
+    };
+
+    Cell cells_[CAPACITY];
+
+    // positions are placed on separate cache lines so producers and consumer don't share them
+    alignas(64) std::atomic<uint32> enqueuePos_ = 0;
+    alignas(64) uint32              dequeuePos_ = 0;
+    alignas(64) std::atomic<uint32> numDropped_ = 0;
+};
+
+} // namespace ECS
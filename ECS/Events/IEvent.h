@@ -24,6 +24,22 @@ enum eEventType
     EVENT_PLAYER_MOVE_DOWN     = (1 << 12),       // when free fly camera mode
 };
 
+// the number of event types (bits of eEventType)
+constexpr int NUM_EVENT_TYPES = 13;
+
+///////////////////////////////////////////////////////////
+
+constexpr int GetEventTypeIdx(const eEventType type)
+{
+    // get an idx of the event type's bit (is used to group events by types)
+    int idx = 0;
+
+    while ((idx < NUM_EVENT_TYPES) && !(type & (1 << idx)))
+        ++idx;
+
+    return (idx < NUM_EVENT_TYPES) ? idx : 0;   // unknown type => EVENT_INVALID
+}
+
 // =================================================================================
 // Basic event
 // =================================================================================
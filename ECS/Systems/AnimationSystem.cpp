@@ -0,0 +1,199 @@
+// =================================================================================
+// Filename:     AnimationSystem.cpp
+// Description:  implementation of the AnimationSystem's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "AnimationSystem.h"
+
+
+namespace ECS
+{
+
+AnimationSystem::AnimationSystem(Animator* pAnimatorComponent)
+{
+    CAssert::NotNullptr(pAnimatorComponent, "ptr to the Animator component == nullptr");
+    pAnimatorComponent_ = pAnimatorComponent;
+}
+
+
+// ================================================================================
+//                PUBLIC SERIALIZATION / DESERIALIZATION API
+// ================================================================================
+void AnimationSystem::Serialize(WorldFileWriter& writer)
+{
+    const Animator& comp = *pAnimatorComponent_;
+
+    writer.BeginChunk(AnimatorComponent);
+    writer.WriteArray(comp.ids_);
+    writer.WriteArray(comp.clipIdxs_);
+    writer.WriteArray(comp.times_);
+    writer.WriteArray(comp.speeds_);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool AnimationSystem::Deserialize(WorldFileReader& reader)
+{
+    Animator& comp = *pAnimatorComponent_;
+
+    // world files which were saved before animators have no such chunk
+    if (!reader.BeginChunk(AnimatorComponent))
+    {
+        comp.ids_.clear();
+        comp.clipIdxs_.clear();
+        comp.times_.clear();
+        comp.speeds_.clear();
+        comp.sparseIdxs_.Clear();
+        return true;
+    }
+
+    bool result = true;
+    result &= reader.ReadArray(comp.ids_);
+    result &= reader.ReadArray(comp.clipIdxs_);
+    result &= reader.ReadArray(comp.times_);
+    result &= reader.ReadArray(comp.speeds_);
+    result &= (comp.clipIdxs_.size() == comp.ids_.size());
+    result &= (comp.times_.size()    == comp.ids_.size());
+    result &= (comp.speeds_.size()   == comp.ids_.size());
+
+    if (!result)
+    {
+        LogErr("animators data in the world file is corrupted");
+        return false;
+    }
+
+    comp.sparseIdxs_.Clear();
+    comp.sparseIdxs_.Rebuild(comp.ids_);
+    dormant_.MarkDirty();
+
+    return true;
+}
+
+
+// ================================================================================
+//                              PUBLIC UPDATING API
+// ================================================================================
+void AnimationSystem::Update(const float deltaTime)
+{
+    Animator&    comp     = *pAnimatorComponent_;
+    size         numEntts = comp.ids_.size();
+    const index* idxs     = nullptr;
+
+    // skip animators of dormant chunks
+    if (!dormant_.IsEmpty())
+    {
+        const cvector<index>& activeIdxs = dormant_.GetActiveIdxs(comp.ids_);
+        idxs     = activeIdxs.data();
+        numEntts = activeIdxs.size();
+    }
+
+    float*       times  = comp.times_.data();
+    const float* speeds = comp.speeds_.data();
+
+    for (index n = 0; n < numEntts; ++n)
+    {
+        const index i    = (idxs) ? idxs[n] : n;
+        const float time = times[i] + speeds[i] * deltaTime;
+
+        times[i] = (time >= MAX_TIME) ? time - MAX_TIME : time;
+    }
+}
+
+
+// ================================================================================
+//                      PUBLIC CREATION / DELETING API
+// ================================================================================
+void AnimationSystem::AddRecords(
+    const EntityID* ids,
+    const uint16* clipIdxs,
+    const float* speeds,
+    const float* times,
+    const size numEntts)
+{
+    CAssert::True(ids && clipIdxs && speeds && times, "some of input ptrs == nullptr");
+    CAssert::True(numEntts > 0, "input number of entts must be > 0");
+
+    Animator& comp = *pAnimatorComponent_;
+
+    // execute sorted insertion into the data arrays
+    cvector<index> idxs;
+    comp.ids_.merge_sorted(ids, numEntts, idxs);
+    comp.clipIdxs_.insert_by_idxs(idxs, clipIdxs);
+    comp.times_.insert_by_idxs(idxs, times);
+    comp.speeds_.insert_by_idxs(idxs, speeds);
+
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+    dormant_.MarkDirty();
+}
+
+///////////////////////////////////////////////////////////
+
+void AnimationSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Animator& comp = *pAnimatorComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs_.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    comp.ids_.erase_by_idxs(idxs);
+    comp.clipIdxs_.erase_by_idxs(idxs);
+    comp.times_.erase_by_idxs(idxs);
+    comp.speeds_.erase_by_idxs(idxs);
+
+    comp.sparseIdxs_.Remove(ids, numEntts);
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+
+    dormant_.Remove(ids, numEntts);
+}
+
+
+// ================================================================================
+//                           PUBLIC GETTERS / SETTERS
+// ================================================================================
+bool AnimationSystem::SetClip(const EntityID id, const uint16 clipIdx)
+{
+    Animator&   comp = *pAnimatorComponent_;
+    const index idx  = comp.sparseIdxs_.GetIdx(id);
+
+    if (idx == SparseSet::INVALID_IDX)
+    {
+        sprintf(g_String, "there is no animator by entt: %u", id);
+        LogErr(g_String);
+        return false;
+    }
+
+    comp.clipIdxs_[idx] = clipIdx;
+    comp.times_[idx]    = 0.0f;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool AnimationSystem::SetSpeed(const EntityID id, const float speed)
+{
+    Animator&   comp = *pAnimatorComponent_;
+    const index idx  = comp.sparseIdxs_.GetIdx(id);
+
+    if (idx == SparseSet::INVALID_IDX)
+    {
+        sprintf(g_String, "there is no animator by entt: %u", id);
+        LogErr(g_String);
+        return false;
+    }
+
+    comp.speeds_[idx] = speed;
+    return true;
+}
+
+} // namespace ECS
@@ -0,0 +1,69 @@
+// =================================================================================
+// Filename:     AnimationSystem.h
+// Description:  Entity-Component-System (ECS) system for skeletal animations:
+//
+//               the update only advances playback times of animators (a single
+//               multiply-add per entt), all the rest is done by the renderer:
+//               it takes the baked frames of the clip by the time and skins
+//               vertices on GPU so the CPU cost doesn't depend on the number
+//               of bones or vertices
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Components/Animator.h"
+#include "../Common/WorldFile.h"
+#include "../Common/DormantSet.h"
+
+
+namespace ECS
+{
+
+class AnimationSystem final
+{
+public:
+    // times are wrapped by this period so they don't lose precision in long sessions
+    // (a looped clip can jump to another frame only once per this time)
+    static constexpr float MAX_TIME = 3600.0f;
+
+    AnimationSystem(Animator* pAnimatorComponent);
+    ~AnimationSystem() {}
+
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
+    // components accessed during the update (is used by the update scheduler)
+    static constexpr ComponentBitfield UPDATE_READS  = GetComponentBit(AnimatorComponent);
+    static constexpr ComponentBitfield UPDATE_WRITES = GetComponentBit(AnimatorComponent);
+
+    // advance playback times of animators
+    void Update(const float deltaTime);
+
+    // NOTE: ids must be SORTED
+    void AddRecords(
+        const EntityID* ids,
+        const uint16* clipIdxs,
+        const float* speeds,
+        const float* times,
+        const size numEntts);
+
+    void RemoveRecords(const EntityID* ids, const size numEntts);
+
+    // start playing another clip from the beginning; return false if there is no animator by such ID
+    bool SetClip(const EntityID id, const uint16 clipIdx);
+    bool SetSpeed(const EntityID id, const float speed);
+
+    inline bool HasEntity(const EntityID id) const { return pAnimatorComponent_->sparseIdxs_.Has(id); }
+    inline size GetNumAnimators()            const { return pAnimatorComponent_->ids_.size(); }
+
+    // dormant animators are paused (see WorldPartitionSystem); input ids must be SORTED
+    inline void SetDormant(const EntityID* ids, const size numEntts, const bool isDormant) { dormant_.Set(ids, numEntts, isDormant); }
+    inline void ClearDormant() { dormant_.Clear(); }
+
+private:
+    Animator*  pAnimatorComponent_ = nullptr;
+    DormantSet dormant_;
+};
+
+} // namespace ECS
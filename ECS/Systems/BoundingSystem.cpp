@@ -13,6 +13,8 @@ using namespace DirectX;
 BoundingSphere ComputeBoundingSphere(const BoundingBox* AABBs, const size count);
 BoundingBox    ComputeAABB          (const BoundingBox* AABBs, const size count);
 BoundingBox    ComputeAABB          (const BoundingOrientedBox* obbs, const size numOBBs);
+void           InsertWorldBounds    (BoundingWorldSoA& world, const cvector<index>& idxs);
+void           EraseWorldBounds     (BoundingWorldSoA& world, const cvector<index>& idxs);
 
 
 ///////////////////////////////////////////////////////////
@@ -24,6 +26,87 @@ BoundingSystem::BoundingSystem(Bounding* pBoundingComponent) :
 }
 
 
+// =================================================================================
+// Serialization / Deserialization
+// =================================================================================
+void BoundingSystem::Serialize(WorldFileWriter& writer)
+{
+    // bounding data of all the entts is stored as flat arrays
+    // of types/OBBs + the number of these per entt
+
+    const Bounding& comp = *pBoundingComponent_;
+    const size numEntts  = comp.ids.size();
+
+    cvector<uint32> numData(numEntts);
+
+    for (index i = 0; i < numEntts; ++i)
+        numData[i] = comp.obbs.GetCount(i);
+
+    writer.BeginChunk(BoundingComponent);
+    writer.WriteArray(comp.ids);
+    writer.WriteArray(comp.spheres);
+    writer.WriteArray(numData);
+    writer.WriteArray(comp.types.GetPool());
+    writer.WriteArray(comp.obbs.GetPool());
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool BoundingSystem::Deserialize(WorldFileReader& reader)
+{
+    Bounding& comp = *pBoundingComponent_;
+
+    if (!reader.BeginChunk(BoundingComponent))
+    {
+        LogErr("there is no bounding data in the world file");
+        return false;
+    }
+
+    cvector<uint32>            numData;
+    const BoundingType*        types = nullptr;
+    const BoundingOrientedBox* obbs  = nullptr;
+
+    bool result = true;
+    result &= reader.ReadArray(comp.ids);
+    result &= reader.ReadArray(comp.spheres);
+    result &= reader.ReadArray(numData);
+    result &= reader.ReadArray(types, -1);
+    result &= reader.ReadArray(obbs, -1);
+
+    result &= (comp.spheres.size() == comp.ids.size());
+    result &= (numData.size()      == comp.ids.size());
+
+    if (!result)
+    {
+        LogErr("bounding data in the world file is corrupted");
+        return false;
+    }
+
+    const size numEntts = comp.ids.size();
+    comp.types.Assign(numData.data(), numEntts, types);
+    comp.obbs.Assign(numData.data(), numEntts, obbs);
+
+    comp.sparseIdxs.Clear();
+    comp.sparseIdxs.Rebuild(comp.ids);
+
+    // world bounds aren't stored so compute them with the next update
+    BoundingWorldSoA& world = comp.world;
+    cvector<float>* arrs[] = {
+        &world.sphereX, &world.sphereY, &world.sphereZ, &world.sphereR,
+        &world.minX, &world.minY, &world.minZ,
+        &world.maxX, &world.maxY, &world.maxZ };
+
+    for (cvector<float>* pArr : arrs)
+        pArr->resize(numEntts, 0.0f);
+
+    comp.newIds = comp.ids;
+    comp.tree.Clear();
+
+    return true;
+}
+
+
 // =================================================================================
 // Update / Add
 // =================================================================================
@@ -40,14 +123,14 @@ void BoundingSystem::Update(
 
     Bounding& comp = *pBoundingComponent_;
 
-    comp.ids.get_idxs(ids, numEntts, s_Idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, s_Idxs, 0);
 
     for (index i = 0; i < numEntts; ++i)
     {
-        BoundingData& data = comp.data[s_Idxs[i]];
-        cvector<DirectX::BoundingOrientedBox>& obbs = data.obbs;
-        
-        for (index boxIdx = 0; boxIdx < obbs.size(); ++boxIdx)
+        BoundingOrientedBox* obbs    = comp.obbs.Get(s_Idxs[i]);
+        const uint32         numOBBs = comp.obbs.GetCount(s_Idxs[i]);
+
+        for (index boxIdx = 0; boxIdx < numOBBs; ++boxIdx)
             obbs[boxIdx].Transform(obbs[boxIdx], transforms[i]);
     }
 }
@@ -79,26 +162,145 @@ void BoundingSystem::Add(
 
     // check if we already have a record with such ID
     Bounding& comp = *pBoundingComponent_;
-    bool canAddComponent = !comp.ids.binary_search(ids, numEntts);
+    bool canAddComponent = !comp.sparseIdxs.HasAny(ids, numEntts);
     CAssert::True(canAddComponent, "can't add component: there is already a record with some entity id");
 
     // ---------------------------------------------
 
-    comp.ids.get_insert_idxs(ids, numEntts, s_Idxs);
+    // execute sorted insertion of input values
+    comp.ids.merge_sorted(ids, numEntts, s_Idxs);
 
-    // exec indices correction
-    for (index i = 0; i < numEntts; ++i)
-        s_Idxs[i] += i;
+    // each input entt has the same subsets so convert each input AABB into OBB once
+    cvector<BoundingOrientedBox> obbs(numSubsets);
 
-    // execute sorted insertion of input values
-    for (index i = 0; i < numEntts; ++i)
-        comp.ids.insert_before(s_Idxs[i], ids[i]);
+    for (index i = 0; i < numSubsets; ++i)
+        BoundingOrientedBox::CreateFromBoundingBox(obbs[i], AABBs[i]);
+
+    comp.spheres.insert_by_idxs(s_Idxs, ComputeBoundingSphere(AABBs, numSubsets));
+    comp.types.InsertByIdxs(s_Idxs, types, (uint32)numSubsets);
+    comp.obbs.InsertByIdxs(s_Idxs, obbs.data(), (uint32)numSubsets);
+    InsertWorldBounds(comp.world, s_Idxs);
 
+    comp.sparseIdxs.Rebuild(comp.ids, s_Idxs[0]);
+
+    // world bounds of these entts will be computed with the next update
+    cvector<index> idxs;
+    comp.newIds.merge_sorted(ids, numEntts, idxs);
+}
+
+///////////////////////////////////////////////////////////
+
+void BoundingSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED
 
-    DirectX::BoundingSphere sphere = ComputeBoundingSphere(AABBs, numSubsets);
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Bounding& comp = *pBoundingComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    comp.ids.erase_by_idxs(idxs);
+    comp.spheres.erase_by_idxs(idxs);
+    comp.types.EraseByIdxs(idxs);
+    comp.obbs.EraseByIdxs(idxs);
+    EraseWorldBounds(comp.world, idxs);
+    comp.tree.Remove(ids, numEntts);
+
+    comp.sparseIdxs.Remove(ids, numEntts);
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+void BoundingSystem::UpdateWorldBounds(TransformSystem& transformSys)
+{
+    // recompute world-space bounding volumes only of entts which were moved
+    // during the last frame or were just added (both arrays are SORTED)
+
+    Bounding& comp = *pBoundingComponent_;
+    const cvector<EntityID>& changedIds = transformSys.GetChangedEntts();
+
+    if (changedIds.empty() && comp.newIds.empty())
+        return;
+
+    s_Ids.resize(changedIds.size() + comp.newIds.size());
+
+    const EntityID* idsEnd = std::set_union(
+        changedIds.begin(), changedIds.end(),
+        comp.newIds.begin(), comp.newIds.end(),
+        s_Ids.begin());
+
+    s_Ids.resize(idsEnd - s_Ids.begin());
+    comp.newIds.clear();
+
+    // skip entts which have no bounding data
+    comp.sparseIdxs.GetIdxs(s_Ids.data(), s_Ids.size(), s_Idxs);
+    size numEntts = 0;
+
+    for (index i = 0; i < s_Ids.size(); ++i)
+    {
+        s_Ids[numEntts]  = s_Ids[i];
+        s_Idxs[numEntts] = s_Idxs[i];
+        numEntts += (s_Idxs[i] != SparseSet::INVALID_IDX);
+    }
+
+    if (numEntts == 0)
+        return;
+
+    s_Worlds.resize(numEntts);
+    transformSys.GetWorlds(s_Ids.data(), numEntts, s_Worlds.data());
+
+    BoundingWorldSoA& world = comp.world;
 
     for (index i = 0; i < numEntts; ++i)
-        comp.data.insert_before(s_Idxs[i], BoundingData(sphere, numSubsets, types, AABBs));
+    {
+        const index               idx    = s_Idxs[i];
+        const XMMATRIX&           W      = s_Worlds[i];
+        const BoundingSphere&     sphere = comp.spheres[idx];
+        const BoundingBox         aabb   = ComputeAABB(comp.obbs.Get(idx), comp.obbs.GetCount(idx));
+
+        // sphere: transform the center and scale the radius by the max axis scale
+        const XMVECTOR sCenter = XMVector3Transform(XMLoadFloat3(&sphere.Center), W);
+        const float    scaleX  = XMVectorGetX(XMVector3LengthSq(W.r[0]));
+        const float    scaleY  = XMVectorGetX(XMVector3LengthSq(W.r[1]));
+        const float    scaleZ  = XMVectorGetX(XMVector3LengthSq(W.r[2]));
+        const float    scaleXY = (scaleX > scaleY) ? scaleX : scaleY;
+        const float    maxScale = sqrtf((scaleXY > scaleZ) ? scaleXY : scaleZ);
+
+        world.sphereX[idx] = XMVectorGetX(sCenter);
+        world.sphereY[idx] = XMVectorGetY(sCenter);
+        world.sphereZ[idx] = XMVectorGetZ(sCenter);
+        world.sphereR[idx] = sphere.Radius * maxScale;
+
+        // AABB: transform the center and project the extents onto world axes
+        const XMVECTOR boxCenter  = XMVector3Transform(XMLoadFloat3(&aabb.Center), W);
+        const XMVECTOR boxExtents = XMLoadFloat3(&aabb.Extents);
+
+        XMVECTOR extents = XMVectorMultiply(XMVectorAbs(W.r[0]), XMVectorSplatX(boxExtents));
+        extents = XMVectorMultiplyAdd(XMVectorAbs(W.r[1]), XMVectorSplatY(boxExtents), extents);
+        extents = XMVectorMultiplyAdd(XMVectorAbs(W.r[2]), XMVectorSplatZ(boxExtents), extents);
+
+        XMFLOAT3 vMin;
+        XMFLOAT3 vMax;
+        XMStoreFloat3(&vMin, XMVectorSubtract(boxCenter, extents));
+        XMStoreFloat3(&vMax, XMVectorAdd(boxCenter, extents));
+
+        world.minX[idx] = vMin.x;
+        world.minY[idx] = vMin.y;
+        world.minZ[idx] = vMin.z;
+        world.maxX[idx] = vMax.x;
+        world.maxY[idx] = vMax.y;
+        world.maxZ[idx] = vMax.z;
+
+        // refit the leaf of this entt in the BVH
+        comp.tree.Update(s_Ids[i], vMin, vMax);
+    }
 }
 
 
@@ -121,11 +323,38 @@ void BoundingSystem::GetBoundSpheres(
 
     Bounding& comp = *pBoundingComponent_;
 
-    comp.ids.get_idxs(ids, numEntts, s_Idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, s_Idxs, 0);
     outBoundSpheres.resize(numEntts);
 
     for (int i = 0; const index idx : s_Idxs)
-        outBoundSpheres[i++] = comp.data[idx].boundSphere;
+        outBoundSpheres[i++] = comp.spheres[idx];
+}
+
+///////////////////////////////////////////////////////////
+
+void BoundingSystem::GetWorldBoundSpheres(
+    const EntityID* ids,
+    const size numEntts,
+    cvector<BoundingSphere>& outBoundSpheres)
+{
+    if (!ids)
+    {
+        LogErr("input ptr to ids arr == nullptr");
+        return;
+    }
+
+    const Bounding&         comp  = *pBoundingComponent_;
+    const BoundingWorldSoA& world = comp.world;
+
+    comp.sparseIdxs.GetIdxs(ids, numEntts, s_Idxs, 0);
+    outBoundSpheres.resize(numEntts);
+
+    for (int i = 0; const index idx : s_Idxs)
+    {
+        BoundingSphere& sphere = outBoundSpheres[i++];
+        sphere.Center = XMFLOAT3(world.sphereX[idx], world.sphereY[idx], world.sphereZ[idx]);
+        sphere.Radius = world.sphereR[idx];
+    }
 }
 
 ///////////////////////////////////////////////////////////
@@ -134,8 +363,75 @@ void BoundingSystem::GetAABB(const EntityID id, DirectX::BoundingBox& outAABB)
 {
     // get an axis-aligned bounding box of entity by input ID
     // (AABB of the whole entity)
-    const ECS::BoundingData& data = pBoundingComponent_->data[GetIdxByID(id)];
-    outAABB = ComputeAABB(data.obbs.data(), data.obbs.size());
+    const SubsetPool<BoundingOrientedBox>& obbs = pBoundingComponent_->obbs;
+    const index idx = GetIdxByID(id);
+
+    outAABB = ComputeAABB(obbs.Get(idx), obbs.GetCount(idx));
+}
+
+///////////////////////////////////////////////////////////
+
+void BoundingSystem::QueryAABB(
+    const XMFLOAT3& aabbMin,
+    const XMFLOAT3& aabbMax,
+    cvector<EntityID>& outIds) const
+{
+    // take candidates by fat AABBs of the BVH and keep only
+    // the ones whose actual world AABBs overlap the box
+
+    const Bounding&         comp  = *pBoundingComponent_;
+    const BoundingWorldSoA& world = comp.world;
+    const size              start = outIds.size();
+
+    comp.tree.QueryAABB(aabbMin, aabbMax, outIds);
+
+    size num = start;
+
+    for (index i = start; i < outIds.size(); ++i)
+    {
+        const EntityID id  = outIds[i];
+        const index    idx = comp.sparseIdxs.GetIdx(id);
+
+        const bool overlap =
+            (world.minX[idx] <= aabbMax.x) && (aabbMin.x <= world.maxX[idx]) &&
+            (world.minY[idx] <= aabbMax.y) && (aabbMin.y <= world.maxY[idx]) &&
+            (world.minZ[idx] <= aabbMax.z) && (aabbMin.z <= world.maxZ[idx]);
+
+        outIds[num] = id;
+        num += overlap;
+    }
+
+    outIds.resize(num);
+}
+
+///////////////////////////////////////////////////////////
+
+void BoundingSystem::QuerySphere(
+    const XMFLOAT3& center,
+    const float radius,
+    cvector<EntityID>& outIds) const
+{
+    // take candidates by fat AABBs of the BVH and keep only
+    // the ones whose actual world AABBs overlap the sphere
+
+    const Bounding& comp     = *pBoundingComponent_;
+    const size      start    = outIds.size();
+    const float     radiusSq = radius * radius;
+
+    comp.tree.QuerySphere(center, radius, outIds);
+
+    size num = start;
+
+    for (index i = start; i < outIds.size(); ++i)
+    {
+        const EntityID id  = outIds[i];
+        const index    idx = comp.sparseIdxs.GetIdx(id);
+
+        outIds[num] = id;
+        num += (DistSqToWorldAABB(idx, center) <= radiusSq);
+    }
+
+    outIds.resize(num);
 }
 
 ///////////////////////////////////////////////////////////
@@ -153,13 +449,13 @@ void BoundingSystem::GetOBBs(
 
 
     // get indices to responsible data by IDs
-    comp.ids.get_idxs(ids, numEntts, s_Idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, s_Idxs, 0);
 
     // get the number of bounding boxes per each entity
     outNumBoxesPerEntt.resize(numEntts);
 
     for (int i = 0; const index idx : s_Idxs)
-        outNumBoxesPerEntt[i++] = comp.data[idx].obbs.size();
+        outNumBoxesPerEntt[i++] = comp.obbs.GetCount(idx);
 
     // compute the number of all bounding boxes which we will get
     for (index i = 0; i < numEntts; ++i)
@@ -169,10 +465,10 @@ void BoundingSystem::GetOBBs(
     // get oriented bounding boxes for each mesh of each entity
     outOBBs.resize(numOBBs);
 
-    for (int obbIdx = 0; const index idx : s_Idxs)
+    for (BoundingOrientedBox* pDst = outOBBs.data(); const index idx : s_Idxs)
     {
-        for (DirectX::BoundingOrientedBox& obb : comp.data[idx].obbs)
-            outOBBs[obbIdx++] = obb;
+        const BoundingOrientedBox* obbs = comp.obbs.Get(idx);
+        pDst = std::copy(obbs, obbs + comp.obbs.GetCount(idx), pDst);
     }
 }
 
@@ -194,13 +490,13 @@ void BoundingSystem::GetBoxLocalSpaceMatricesByIDs(
     size numOBBs = 0;
 
 
-    comp.ids.get_idxs(ids, numEntts, s_Idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, s_Idxs, 0);
 
     // get the number of bounding boxes per each entity
     outNumBoxesPerEntt.resize(numEntts);
 
     for (int i = 0; const index idx : s_Idxs)
-        outNumBoxesPerEntt[i++] = comp.data[idx].obbs.size();
+        outNumBoxesPerEntt[i++] = comp.obbs.GetCount(idx);
 
     // compute the number of all bounding boxes which we will get
     for (index i = 0; i < numEntts; ++i)
@@ -212,7 +508,7 @@ void BoundingSystem::GetBoxLocalSpaceMatricesByIDs(
 
     for (int enttIdx = 0, obbIdx = 0; const index idx : s_Idxs)
     {
-        for (const DirectX::BoundingOrientedBox& obb : comp.data[idx].obbs)
+        for (const DirectX::BoundingOrientedBox& obb : comp.obbs.GetSpan(idx))
         {
             const XMVECTOR boxLScale = XMLoadFloat3(&obb.Extents);
             const XMVECTOR boxLRotQuat = XMLoadFloat4(&obb.Orientation);
@@ -348,4 +644,32 @@ BoundingBox ComputeAABB(const BoundingOrientedBox* obbs, const size numOBBs)
     return outAABB;
 }
 
+///////////////////////////////////////////////////////////
+
+void InsertWorldBounds(BoundingWorldSoA& world, const cvector<index>& idxs)
+{
+    // insert zeroed world bounds by idxs (they are computed with the next update)
+
+    cvector<float>* arrs[] = {
+        &world.sphereX, &world.sphereY, &world.sphereZ, &world.sphereR,
+        &world.minX, &world.minY, &world.minZ,
+        &world.maxX, &world.maxY, &world.maxZ };
+
+    for (cvector<float>* pArr : arrs)
+        pArr->insert_by_idxs(idxs, 0.0f);
+}
+
+///////////////////////////////////////////////////////////
+
+void EraseWorldBounds(BoundingWorldSoA& world, const cvector<index>& idxs)
+{
+    cvector<float>* arrs[] = {
+        &world.sphereX, &world.sphereY, &world.sphereZ, &world.sphereR,
+        &world.minX, &world.minY, &world.minZ,
+        &world.maxX, &world.maxY, &world.maxZ };
+
+    for (cvector<float>* pArr : arrs)
+        pArr->erase_by_idxs(idxs);
+}
+
 } // namespace ECS
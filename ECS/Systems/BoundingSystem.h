@@ -8,6 +8,8 @@
 
 #include "../Common/ECSTypes.h"
 #include "../Components/Bounding.h"
+#include "../Common/WorldFile.h"
+#include "TransformSystem.h"
 
 namespace ECS
 {
@@ -18,6 +20,9 @@ public:
     BoundingSystem(Bounding* pBoundingComponent);
     ~BoundingSystem() {}
 
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
     void Update(
         const EntityID* ids,
         const XMMATRIX* transforms,
@@ -36,6 +41,17 @@ public:
         const BoundingType* types,              // AABB type per mesh
         const DirectX::BoundingBox* AABBs);     // AABB per mesh
 
+    void RemoveRecords(const EntityID* ids, const size numEntts);
+
+    // recompute world-space bounding spheres/AABBs only of entts which were
+    // moved during the last frame (or were just added) and refit their BVH leaves;
+    // NOTE: is supposed to be called after the flush of transformations
+    void UpdateWorldBounds(TransformSystem& transformSys);
+
+    // components accessed during the update (is used by the update scheduler)
+    static constexpr ComponentBitfield UPDATE_READS  = GetComponentBit(TransformComponent);
+    static constexpr ComponentBitfield UPDATE_WRITES = GetComponentBit(BoundingComponent);
+
     // ----------------------------------------------------
 
     void GetBoundSpheres(
@@ -43,8 +59,47 @@ public:
         const size numEntts,
         cvector<DirectX::BoundingSphere>& outBoundSpheres);
 
+    // get world-space bounding spheres (see UpdateWorldBounds)
+    void GetWorldBoundSpheres(
+        const EntityID* ids,
+        const size numEntts,
+        cvector<DirectX::BoundingSphere>& outBoundSpheres);
+
     void GetAABB(const EntityID id, DirectX::BoundingBox& outAABB);
 
+    // get entts whose world bounds are hit by the ray (see AABBTree::QueryRay)
+    inline void QueryRay(
+        const DirectX::XMFLOAT3& origin,
+        const DirectX::XMFLOAT3& dir,
+        const float maxDist,
+        cvector<EntityID>& outIds,
+        cvector<float>& outDists) const
+    {
+        pBoundingComponent_->tree.QueryRay(origin, dir, maxDist, outIds, outDists);
+    }
+
+    // get entts whose world AABBs overlap the box / the sphere (are appended, unordered)
+    void QueryAABB(
+        const DirectX::XMFLOAT3& aabbMin,
+        const DirectX::XMFLOAT3& aabbMax,
+        cvector<EntityID>& outIds) const;
+
+    void QuerySphere(
+        const DirectX::XMFLOAT3& center,
+        const float radius,
+        cvector<EntityID>& outIds) const;
+
+    // get up to k entts whose world AABBs are the closest to the point (sorted by
+    // distance, 0 if the point is inside); filter(id) returns false to skip the entt
+    template <typename Filter>
+    void QueryNearest(
+        const DirectX::XMFLOAT3& point,
+        const int k,
+        const float maxDist,
+        Filter filter,
+        cvector<EntityID>& outIds,
+        cvector<float>& outDists) const;
+
     void GetOBBs(
         const EntityID* ids,
         const size numEntts,
@@ -67,22 +122,58 @@ public:
         DirectX::XMMATRIX& mat);
 
 private:
+    // squared distance from the point to the world AABB by idx
+    inline float DistSqToWorldAABB(const index idx, const DirectX::XMFLOAT3& p) const
+    {
+        const BoundingWorldSoA& w = pBoundingComponent_->world;
+
+        const float dx = std::max(std::max(w.minX[idx] - p.x, p.x - w.maxX[idx]), 0.0f);
+        const float dy = std::max(std::max(w.minY[idx] - p.y, p.y - w.maxY[idx]), 0.0f);
+        const float dz = std::max(std::max(w.minZ[idx] - p.z, p.z - w.maxZ[idx]), 0.0f);
+
+        return dx*dx + dy*dy + dz*dz;
+    }
+
     inline index GetIdxByID(const EntityID id)
     {
         // return valid idx if there is an entity by such ID;
         // or return -1 if there is no such entity;
-        const Bounding& comp = *pBoundingComponent_;
-        const index idx = comp.ids.get_idx(id);
-        const bool exist = (comp.ids[idx] == id);
-
-        return (exist) ? comp.ids.get_idx(id) : -1;
+        return pBoundingComponent_->sparseIdxs.GetIdx(id);
     }
 
 private:
-    cvector<index> s_Idxs;                   // static array of idxs to elements in array
+    cvector<index>    s_Idxs;                // static array of idxs to elements in array
+    cvector<EntityID> s_Ids;
+    cvector<XMMATRIX> s_Worlds;
     Bounding* pBoundingComponent_ = nullptr;
 };
 
 
+// =================================================================================
+// TEMPLATES IMPLEMENTATION
+// =================================================================================
+template <typename Filter>
+void BoundingSystem::QueryNearest(
+    const DirectX::XMFLOAT3& point,
+    const int k,
+    const float maxDist,
+    Filter filter,
+    cvector<EntityID>& outIds,
+    cvector<float>& outDists) const
+{
+    // leaves of the BVH have fat AABBs so the exact distance is taken by the world AABB
+    const auto distFunc = [this, &point, &filter](const EntityID id, float& outDistSq)
+    {
+        if (!filter(id))
+            return false;
+
+        outDistSq = DistSqToWorldAABB(pBoundingComponent_->sparseIdxs.GetIdx(id), point);
+        return true;
+    };
+
+    pBoundingComponent_->tree.QueryNearest(point, k, maxDist, distFunc, outIds, outDists);
+}
+
+
 
 } // namespace ECS
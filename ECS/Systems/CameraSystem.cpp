@@ -26,6 +26,74 @@ CameraSystem::~CameraSystem()
 }
 
 
+// =================================================================================
+//                  public API: serialization / deserialization
+// =================================================================================
+void CameraSystem::Serialize(WorldFileWriter& writer)
+{
+    // cameras are stored as pairs of arrays: ids + data
+
+    const Camera& comp   = *pCameraComponent_;
+    const size numCams = (size)comp.data.size();
+
+    cvector<EntityID>   ids;
+    cvector<CameraData> data;
+
+    ids.reserve(numCams);
+    data.reserve(numCams);
+
+    for (const auto& it : comp.data)
+    {
+        ids.push_back(it.first);
+        data.push_back(it.second);
+    }
+
+    writer.BeginChunk(CameraComponent);
+    writer.WriteArray(ids);
+    writer.WriteArray(data);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool CameraSystem::Deserialize(WorldFileReader& reader)
+{
+    Camera& comp = *pCameraComponent_;
+
+    if (!reader.BeginChunk(CameraComponent))
+    {
+        LogErr("there is no camera data in the world file");
+        return false;
+    }
+
+    cvector<EntityID> ids;
+    const CameraData* data = nullptr;
+
+    bool result = true;
+    result &= reader.ReadArray(ids);
+    result &= reader.ReadArray(data, ids.size());
+
+    if (!result)
+    {
+        LogErr("camera data in the world file is corrupted");
+        return false;
+    }
+
+    comp.data.clear();
+
+    for (index i = 0; i < ids.size(); ++i)
+        comp.data.emplace(ids[i], data[i]);
+
+    // derived data isn't stored so rebuild it by the loaded matrices
+    comp.frameData.clear();
+
+    for (const auto& it : comp.data)
+        UpdateFrameData(it.first);
+
+    return true;
+}
+
+
 // =================================================================================
 //                        public API: add / remove
 // =================================================================================
@@ -49,6 +117,8 @@ void CameraSystem::AddRecord(const EntityID id, const CameraData& data)
 
 void CameraSystem::RemoveRecord(const EntityID id)
 {
+    pCameraComponent_->frameData.erase(id);
+
     if (pCameraComponent_->data.erase(id) == 0)
     {
         sprintf(g_String, "can't remove (there is no camera by ID: %ld)", id);
@@ -58,6 +128,21 @@ void CameraSystem::RemoveRecord(const EntityID id)
 
 ///////////////////////////////////////////////////////////
 
+void CameraSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+    // remove cameras of input entts (if they have any)
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        pCameraComponent_->data.erase(ids[i]);
+        pCameraComponent_->frameData.erase(ids[i]);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 inline bool CameraSystem::HasEntity(const EntityID id) const
 {
     // return true if there is a camera with ID or false in another case
@@ -162,6 +247,8 @@ void CameraSystem::SetAspectRatio(const EntityID id, const float aspect)
 
         data.aspectRatio = aspect;
         data.proj = XMMatrixPerspectiveFovLH(data.fovY, aspect, data.nearZ, data.farZ);
+
+        UpdateFrameData(id);
     }
 }
 
@@ -197,6 +284,8 @@ void CameraSystem::SetupProjection(
         data.farWndHeight  = 2.0f * farZ  * tanf(0.5f * fovY);
 
         data.proj = XMMatrixPerspectiveFovLH(fovY, aspectRatio, nearZ, farZ);
+
+        UpdateFrameData(id);
     }
 }
 
@@ -333,9 +422,56 @@ const XMMATRIX& CameraSystem::UpdateView(const EntityID id)
     // compute inverse view matrix
     camData.invView = XMMatrixInverse(nullptr, camData.view);
 
+    UpdateFrameData(id);
+
     return camData.view;
 }
 
+///////////////////////////////////////////////////////////
+
+void CameraSystem::UpdateFrameData(const EntityID id)
+{
+    // compute derived matrices and frustum planes of the camera once
+    // so culling, picking and terrain LODs just read them
+
+    const CameraData& cam   = pCameraComponent_->data[id];
+    CameraFrameData&  frame = pCameraComponent_->frameData[id];
+
+    frame.viewProj    = cam.view * cam.proj;
+    frame.invProj     = XMMatrixInverse(nullptr, cam.proj);
+    frame.invViewProj = XMMatrixInverse(nullptr, frame.viewProj);
+
+    BoundingFrustum::CreateFromMatrix(frame.frustumV, cam.proj);
+    frame.frustumV.Transform(frame.frustumW, cam.invView);
+
+    XMVECTOR planes[6];
+    frame.frustumW.GetPlanes(
+        &planes[0], &planes[1], &planes[2],
+        &planes[3], &planes[4], &planes[5]);
+
+    FrustumPlanesSoA& soa = frame.planesSoA;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        XMStoreFloat4(&frame.planesW[i],      planes[i]);
+        XMStoreFloat4(&frame.innerPlanesW[i], XMVectorNegate(planes[i]));
+
+        soa.nx[i] = frame.innerPlanesW[i].x;
+        soa.ny[i] = frame.innerPlanesW[i].y;
+        soa.nz[i] = frame.innerPlanesW[i].z;
+        soa.d[i]  = frame.innerPlanesW[i].w;
+    }
+
+    // padding planes: any point is in front of them
+    for (int i = 6; i < 8; ++i)
+    {
+        soa.nx[i] = 0.0f;
+        soa.ny[i] = 0.0f;
+        soa.nz[i] = 0.0f;
+        soa.d[i]  = FLT_MAX;
+    }
+}
+
 
 // =================================================================================
 // Get camera's position/direction/vectors data
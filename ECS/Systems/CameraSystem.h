@@ -8,6 +8,7 @@
 
 #include "../Systems/TransformSystem.h"
 #include "../Components/Camera.h"
+#include "../Common/WorldFile.h"
 
 
 namespace ECS
@@ -19,10 +20,14 @@ public:
     CameraSystem(Camera* pCameraComponent, TransformSystem* pTransformSys);
     ~CameraSystem();
 
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
     const XMMATRIX& UpdateView(const EntityID id);
 
     void AddRecord   (const EntityID id, const CameraData& data);
     void RemoveRecord(const EntityID id);
+    void RemoveRecords(const EntityID* ids, const size numEntts);
     bool HasEntity   (const EntityID id) const;
 
     void Strafe (const EntityID id, const float d);
@@ -45,7 +50,15 @@ public:
     inline const XMMATRIX& GetProj       (const EntityID id) const { return (HasEntity(id)) ? GetData(id).proj     : pCameraComponent_->data[0].proj; }
     inline const XMMATRIX& GetOrtho      (const EntityID id) const { return (HasEntity(id)) ? GetData(id).ortho    : pCameraComponent_->data[0].ortho; }
 
-    inline const XMMATRIX  GetViewProj   (const EntityID id) const { return (HasEntity(id)) ? GetData(id).view * GetData(id).proj : DirectX::XMMatrixIdentity(); }
+    // derived matrices and frustums are cached by UpdateView() once per frame
+    inline const CameraFrameData& GetFrameData(const EntityID id) const { return (HasEntity(id)) ? GetCachedFrame(id) : GetCachedFrame(0); }
+
+    inline const XMMATRIX& GetViewProj   (const EntityID id) const { return GetFrameData(id).viewProj; }
+    inline const XMMATRIX& GetInverseProj(const EntityID id) const { return GetFrameData(id).invProj; }
+    inline const XMMATRIX& GetInverseViewProj(const EntityID id) const { return GetFrameData(id).invViewProj; }
+
+    inline const DirectX::BoundingFrustum& GetFrustumView (const EntityID id) const { return GetFrameData(id).frustumV; }
+    inline const DirectX::BoundingFrustum& GetFrustumWorld(const EntityID id) const { return GetFrameData(id).frustumW; }
 
     // get camera basis vectors
     inline const XMVECTOR& GetPosVec  (const EntityID id) const { return pTransformSys_->GetPositionVec(id); }
@@ -106,7 +119,10 @@ public:
     //inline void SetFixedLookAtPoint(const DirectX::XMVECTOR& lookAt) { lookAtPoint_ = lookAt; }
 
 private:
-    inline const ECS::CameraData& GetData(const EntityID id) const { return pCameraComponent_->data[id]; }
+    inline const ECS::CameraData&      GetData       (const EntityID id) const { return pCameraComponent_->data[id]; }
+    inline const ECS::CameraFrameData& GetCachedFrame(const EntityID id) const { return pCameraComponent_->frameData[id]; }
+
+    void UpdateFrameData(const EntityID id);
 
 private:
     Camera*          pCameraComponent_ = nullptr;
@@ -0,0 +1,484 @@
+// =================================================================================
+// Filename:     ColliderSystem.cpp
+// Description:  implementation of the ColliderSystem's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "ColliderSystem.h"
+#include <DirectXCollision.h>
+
+using namespace DirectX;
+
+
+namespace ECS
+{
+
+//---------------------------------------------------------
+// Desc:   is the endpoint a goes before the endpoint b;
+//         min endpoints go before max ones of the same value
+//         so touching intervals are overlapping
+//---------------------------------------------------------
+template <typename T>
+inline bool EndpointLess(const T& a, const T& b)
+{
+    return (a.value < b.value) || ((a.value == b.value) && ((a.data & 1) < (b.data & 1)));
+}
+
+//---------------------------------------------------------
+// Desc:   test if world shapes of two colliders are intersecting
+//---------------------------------------------------------
+bool ShapesIntersect(const ColliderWorldSoA& world, const uint8 shapeA, const uint8 shapeB, const index a, const index b)
+{
+    if (shapeA == COLLIDER_SPHERE)
+    {
+        return (shapeB == COLLIDER_SPHERE) ?
+            world.spheres[a].Intersects(world.spheres[b]) :
+            world.spheres[a].Intersects(world.obbs[b]);
+    }
+
+    return (shapeB == COLLIDER_SPHERE) ?
+        world.obbs[a].Intersects(world.spheres[b]) :
+        world.obbs[a].Intersects(world.obbs[b]);
+}
+
+///////////////////////////////////////////////////////////
+
+ColliderSystem::ColliderSystem(Collider* pColliderComponent)
+{
+    CAssert::NotNullptr(pColliderComponent, "ptr to the Collider component == nullptr");
+    pColliderComponent_ = pColliderComponent;
+}
+
+
+// ================================================================================
+//                PUBLIC SERIALIZATION / DESERIALIZATION API
+// ================================================================================
+void ColliderSystem::Serialize(WorldFileWriter& writer)
+{
+    const Collider& comp = *pColliderComponent_;
+
+    writer.BeginChunk(ColliderComponent);
+    writer.WriteArray(comp.ids_);
+    writer.WriteArray(comp.data_);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool ColliderSystem::Deserialize(WorldFileReader& reader)
+{
+    Collider& comp = *pColliderComponent_;
+
+    comp.ids_.clear();
+    comp.data_.clear();
+
+    // world files which were saved before colliders have no such chunk
+    if (reader.BeginChunk(ColliderComponent))
+    {
+        bool result = true;
+        result &= reader.ReadArray(comp.ids_);
+        result &= reader.ReadArray(comp.data_);
+        result &= (comp.data_.size() == comp.ids_.size());
+
+        if (!result)
+        {
+            LogErr("colliders data in the world file is corrupted");
+            comp.ids_.clear();
+            comp.data_.clear();
+            return false;
+        }
+    }
+
+    // world shapes of all the loaded colliders are computed by the next update
+    const size numEntts = comp.ids_.size();
+    ColliderWorldSoA& world = comp.world_;
+
+    world.minX.resize(numEntts);
+    world.minY.resize(numEntts);
+    world.minZ.resize(numEntts);
+    world.maxX.resize(numEntts);
+    world.maxY.resize(numEntts);
+    world.maxZ.resize(numEntts);
+    world.spheres.resize(numEntts);
+    world.obbs.resize(numEntts);
+
+    comp.newIds_ = comp.ids_;
+
+    comp.sparseIdxs_.Clear();
+    comp.sparseIdxs_.Rebuild(comp.ids_);
+
+    isEndpointsDirty_ = true;
+    return true;
+}
+
+
+// ================================================================================
+//                              PUBLIC UPDATING API
+// ================================================================================
+void ColliderSystem::Update(TransformSystem& transformSys)
+{
+    // pairs of the prev step are kept to find started/stopped collisions
+    std::swap(prevPairs_, pairs_);
+    pairs_.clear();
+    broadPairs_.clear();
+
+    stats_ = CollisionStats();
+    stats_.numColliders = (uint32)pColliderComponent_->ids_.size();
+
+    UpdateWorldShapes(transformSys);
+
+    if (stats_.numColliders > 1)
+    {
+        if (isEndpointsDirty_)
+            RebuildEndpoints();
+        else
+            SortEndpoints();
+
+        Sweep();
+        NarrowPhase();
+    }
+
+    beginPairs_.resize(pairs_.size());
+    endPairs_.resize(prevPairs_.size());
+
+    const CollisionPair* beginEnd = std::set_difference(
+        pairs_.begin(), pairs_.end(),
+        prevPairs_.begin(), prevPairs_.end(),
+        beginPairs_.begin());
+
+    const CollisionPair* endEnd = std::set_difference(
+        prevPairs_.begin(), prevPairs_.end(),
+        pairs_.begin(), pairs_.end(),
+        endPairs_.begin());
+
+    beginPairs_.resize(beginEnd - beginPairs_.begin());
+    endPairs_.resize(endEnd - endPairs_.begin());
+
+    stats_.numBroadPairs = (uint32)broadPairs_.size();
+    stats_.numPairs      = (uint32)pairs_.size();
+}
+
+///////////////////////////////////////////////////////////
+
+void ColliderSystem::UpdateWorldShapes(TransformSystem& transformSys)
+{
+    // recompute world shapes only of entts which were moved
+    // during the last step or were just added (both arrays are SORTED)
+
+    Collider& comp = *pColliderComponent_;
+    const cvector<EntityID>& changedIds = transformSys.GetChangedEntts();
+
+    if (changedIds.empty() && comp.newIds_.empty())
+        return;
+
+    s_Ids.resize(changedIds.size() + comp.newIds_.size());
+
+    const EntityID* idsEnd = std::set_union(
+        changedIds.begin(), changedIds.end(),
+        comp.newIds_.begin(), comp.newIds_.end(),
+        s_Ids.begin());
+
+    s_Ids.resize(idsEnd - s_Ids.begin());
+    comp.newIds_.clear();
+
+    // skip entts which have no collider
+    comp.sparseIdxs_.GetIdxs(s_Ids.data(), s_Ids.size(), s_Idxs);
+    size numEntts = 0;
+
+    for (index i = 0; i < s_Ids.size(); ++i)
+    {
+        s_Ids[numEntts]  = s_Ids[i];
+        s_Idxs[numEntts] = s_Idxs[i];
+        numEntts += (s_Idxs[i] != SparseSet::INVALID_IDX);
+    }
+
+    stats_.numMoved = (uint32)numEntts;
+
+    if (numEntts == 0)
+        return;
+
+    s_Worlds.resize(numEntts);
+    transformSys.GetWorlds(s_Ids.data(), numEntts, s_Worlds.data());
+
+    ColliderWorldSoA& world = comp.world_;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index         idx  = s_Idxs[i];
+        const XMMATRIX&     W    = s_Worlds[i];
+        const ColliderData& data = comp.data_[idx];
+
+        XMVECTOR center;
+        XMVECTOR extents;
+
+        if (data.shape == COLLIDER_SPHERE)
+        {
+            BoundingSphere& sphere = world.spheres[idx];
+            data.sphere.Transform(sphere, W);
+
+            center  = XMLoadFloat3(&sphere.Center);
+            extents = XMVectorReplicate(sphere.Radius);
+        }
+        else
+        {
+            BoundingOrientedBox& obb = world.obbs[idx];
+            data.obb.Transform(obb, W);
+
+            // project the extents of the box onto world axes
+            const XMMATRIX R  = XMMatrixRotationQuaternion(XMLoadFloat4(&obb.Orientation));
+            const XMVECTOR ex = XMLoadFloat3(&obb.Extents);
+
+            center  = XMLoadFloat3(&obb.Center);
+            extents = XMVectorMultiply(XMVectorAbs(R.r[0]), XMVectorSplatX(ex));
+            extents = XMVectorMultiplyAdd(XMVectorAbs(R.r[1]), XMVectorSplatY(ex), extents);
+            extents = XMVectorMultiplyAdd(XMVectorAbs(R.r[2]), XMVectorSplatZ(ex), extents);
+        }
+
+        XMFLOAT3 vMin;
+        XMFLOAT3 vMax;
+        XMStoreFloat3(&vMin, XMVectorSubtract(center, extents));
+        XMStoreFloat3(&vMax, XMVectorAdd(center, extents));
+
+        world.minX[idx] = vMin.x;
+        world.minY[idx] = vMin.y;
+        world.minZ[idx] = vMin.z;
+        world.maxX[idx] = vMax.x;
+        world.maxY[idx] = vMax.y;
+        world.maxZ[idx] = vMax.z;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void ColliderSystem::RebuildEndpoints()
+{
+    // colliders were added/removed so their idxs were changed:
+    // make endpoints from scratch and sort them fully
+
+    const ColliderWorldSoA& world    = pColliderComponent_->world_;
+    const size              numEntts = pColliderComponent_->ids_.size();
+
+    endpoints_.resize(numEntts * 2);
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        endpoints_[i*2 + 0] = { world.minX[i], (uint32)(i << 1)     };
+        endpoints_[i*2 + 1] = { world.maxX[i], (uint32)(i << 1) | 1 };
+    }
+
+    std::sort(endpoints_.begin(), endpoints_.end(), EndpointLess<SapEndpoint>);
+
+    activePos_.resize(numEntts);
+    isEndpointsDirty_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void ColliderSystem::SortEndpoints()
+{
+    // refresh values of endpoints and restore the order by insertion sort:
+    // by temporal coherence endpoints were moved only a little since the
+    // prev step so there are few swaps (it's O(n) for static scenes)
+
+    // nothing was moved so the order is still valid
+    if (stats_.numMoved == 0)
+        return;
+
+    const ColliderWorldSoA& world     = pColliderComponent_->world_;
+    const size              numPoints = endpoints_.size();
+    SapEndpoint*            points    = endpoints_.data();
+
+    for (index i = 0; i < numPoints; ++i)
+    {
+        const uint32 idx = points[i].data >> 1;
+        points[i].value  = (points[i].data & 1) ? world.maxX[idx] : world.minX[idx];
+    }
+
+    uint32 numSwaps = 0;
+
+    for (index i = 1; i < numPoints; ++i)
+    {
+        const SapEndpoint key = points[i];
+        index j = i;
+
+        while ((j > 0) && EndpointLess(key, points[j-1]))
+        {
+            points[j] = points[j-1];
+            --j;
+        }
+
+        numSwaps += (uint32)(i - j);
+        points[j] = key;
+    }
+
+    stats_.numSwaps = numSwaps;
+}
+
+///////////////////////////////////////////////////////////
+
+void ColliderSystem::Sweep()
+{
+    // go through sorted endpoints: a collider is active between its min and max;
+    // when an interval opens it overlaps by X with all the active ones so only
+    // Y/Z and filters of layers are tested
+
+    const Collider&         comp      = *pColliderComponent_;
+    const ColliderWorldSoA& world     = comp.world_;
+    const size              numPoints = endpoints_.size();
+
+    active_.clear();
+
+    for (index i = 0; i < numPoints; ++i)
+    {
+        const uint32 data = endpoints_[i].data;
+        const index  idx  = data >> 1;
+
+        if (data & 1)
+        {
+            // the interval is closed: swap-and-pop it from active ones
+            const uint32 pos  = activePos_[idx];
+            const index  last = active_.back();
+
+            active_[pos]     = last;
+            activePos_[last] = pos;
+            active_.pop_back();
+            continue;
+        }
+
+        const ColliderData& a = comp.data_[idx];
+
+        for (const index other : active_)
+        {
+            const ColliderData& b = comp.data_[other];
+
+            if (!(a.layer & b.mask) || !(b.layer & a.mask))
+                continue;
+
+            const bool overlap =
+                (world.minY[idx] <= world.maxY[other]) && (world.minY[other] <= world.maxY[idx]) &&
+                (world.minZ[idx] <= world.maxZ[other]) && (world.minZ[other] <= world.maxZ[idx]);
+
+            if (overlap)
+                broadPairs_.push_back({ (EntityID)idx, (EntityID)other });
+        }
+
+        activePos_[idx] = (uint32)active_.size();
+        active_.push_back(idx);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void ColliderSystem::NarrowPhase()
+{
+    // test actual shapes of pairs of the broad phase and make a SORTED list
+    // of pairs of entts IDs (ids_ are sorted so the smaller idx has the smaller ID)
+
+    const Collider& comp = *pColliderComponent_;
+
+    for (const CollisionPair& pair : broadPairs_)
+    {
+        const index a = (pair.idA < pair.idB) ? pair.idA : pair.idB;
+        const index b = (pair.idA < pair.idB) ? pair.idB : pair.idA;
+
+        if (ShapesIntersect(comp.world_, comp.data_[a].shape, comp.data_[b].shape, a, b))
+            pairs_.push_back({ comp.ids_[a], comp.ids_[b] });
+    }
+
+    std::sort(pairs_.begin(), pairs_.end());
+}
+
+
+// ================================================================================
+//                      PUBLIC CREATION / DELETING API
+// ================================================================================
+void ColliderSystem::AddRecords(
+    const EntityID* ids,
+    const ColliderData* data,
+    const size numEntts)
+{
+    CAssert::True(ids && data, "some of input ptrs == nullptr");
+    CAssert::True(numEntts > 0, "input number of entts must be > 0");
+
+    Collider&         comp  = *pColliderComponent_;
+    ColliderWorldSoA& world = comp.world_;
+
+    const cvector<float>               zeros(numEntts, 0.0f);
+    const cvector<BoundingSphere>      spheres(numEntts);
+    const cvector<BoundingOrientedBox> obbs(numEntts);
+
+    // execute sorted insertion into the data arrays
+    cvector<index> idxs;
+    comp.ids_.merge_sorted(ids, numEntts, idxs);
+    comp.data_.insert_by_idxs(idxs, data);
+
+    world.minX.insert_by_idxs(idxs, zeros.data());
+    world.minY.insert_by_idxs(idxs, zeros.data());
+    world.minZ.insert_by_idxs(idxs, zeros.data());
+    world.maxX.insert_by_idxs(idxs, zeros.data());
+    world.maxY.insert_by_idxs(idxs, zeros.data());
+    world.maxZ.insert_by_idxs(idxs, zeros.data());
+    world.spheres.insert_by_idxs(idxs, spheres.data());
+    world.obbs.insert_by_idxs(idxs, obbs.data());
+
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+
+    // world shapes are computed by the next update
+    const size numNew = comp.newIds_.size();
+    comp.newIds_.resize(numNew + numEntts);
+    std::copy(ids, ids + numEntts, comp.newIds_.begin() + numNew);
+    std::sort(comp.newIds_.begin(), comp.newIds_.end());
+
+    isEndpointsDirty_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ColliderSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED;
+    // their pairs will be reported as ended by the next update
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Collider& comp = *pColliderComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs_.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    ColliderWorldSoA& world = comp.world_;
+
+    comp.ids_.erase_by_idxs(idxs);
+    comp.data_.erase_by_idxs(idxs);
+
+    world.minX.erase_by_idxs(idxs);
+    world.minY.erase_by_idxs(idxs);
+    world.minZ.erase_by_idxs(idxs);
+    world.maxX.erase_by_idxs(idxs);
+    world.maxY.erase_by_idxs(idxs);
+    world.maxZ.erase_by_idxs(idxs);
+    world.spheres.erase_by_idxs(idxs);
+    world.obbs.erase_by_idxs(idxs);
+
+    comp.sparseIdxs_.Remove(ids, numEntts);
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+
+    // removed entts can be still waiting for their world shapes
+    size numNew = 0;
+
+    for (const EntityID id : comp.newIds_)
+    {
+        comp.newIds_[numNew] = id;
+        numNew += comp.sparseIdxs_.Has(id);
+    }
+
+    comp.newIds_.resize(numNew);
+    isEndpointsDirty_ = true;
+}
+
+} // namespace ECS
@@ -0,0 +1,125 @@
+// =================================================================================
+// Filename:     ColliderSystem.h
+// Description:  Entity-Component-System (ECS) system for colliders:
+//
+//               - world shapes/AABBs are recomputed only for entts which were
+//                 moved during the step (or were just added);
+//               - the broad phase is sweep-and-prune along X: min/max endpoints
+//                 of all the world AABBs are kept sorted between steps and are
+//                 re-sorted by insertion sort (objects move only a little per
+//                 step so it's almost linear); then a single sweep over the
+//                 endpoints produces pairs whose AABBs overlap by Y and Z too;
+//               - the narrow phase tests actual shapes of these pairs
+//                 (sphere/OBB) and produces a SORTED list of touching pairs;
+//               - the list is compared with the one of the prev step so
+//                 gameplay gets pairs which started/stopped touching
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Components/Collider.h"
+#include "../Common/WorldFile.h"
+#include "TransformSystem.h"
+
+
+namespace ECS
+{
+
+// a pair of colliding entts (idA < idB)
+struct CollisionPair
+{
+    EntityID idA = INVALID_ENTITY_ID;
+    EntityID idB = INVALID_ENTITY_ID;
+
+    inline bool operator<(const CollisionPair& rhs) const
+    {
+        return (idA < rhs.idA) || ((idA == rhs.idA) && (idB < rhs.idB));
+    }
+
+    inline bool operator==(const CollisionPair& rhs) const
+    {
+        return (idA == rhs.idA) && (idB == rhs.idB);
+    }
+};
+
+struct CollisionStats
+{
+    uint32 numColliders    = 0;
+    uint32 numMoved        = 0;                   // colliders whose world shapes were recomputed in the last step
+    uint32 numSwaps        = 0;                   // swaps of the insertion sort of endpoints
+    uint32 numBroadPairs   = 0;                   // pairs with overlapping AABBs
+    uint32 numPairs        = 0;                   // pairs with touching shapes
+};
+
+///////////////////////////////////////////////////////////
+
+class ColliderSystem final
+{
+public:
+    ColliderSystem(Collider* pColliderComponent);
+    ~ColliderSystem() {}
+
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
+    // components accessed during the update (is used by the update scheduler)
+    static constexpr ComponentBitfield UPDATE_READS  = GetComponentBit(TransformComponent);
+    static constexpr ComponentBitfield UPDATE_WRITES = GetComponentBit(ColliderComponent);
+
+    // refresh world shapes of moved entts and find colliding pairs;
+    // NOTE: is supposed to be called after the flush of transformations
+    void Update(TransformSystem& transformSys);
+
+    // NOTE: ids must be SORTED
+    void AddRecords(const EntityID* ids, const ColliderData* data, const size numEntts);
+    void RemoveRecords(const EntityID* ids, const size numEntts);
+
+    // results of the last update (all the lists are SORTED)
+    inline const cvector<CollisionPair>& GetPairs()      const { return pairs_; }
+    inline const cvector<CollisionPair>& GetBeginPairs() const { return beginPairs_; }   // started touching
+    inline const cvector<CollisionPair>& GetEndPairs()   const { return endPairs_; }     // stopped touching (or were removed)
+
+    inline const CollisionStats&         GetStats()      const { return stats_; }
+
+    inline bool HasEntity(const EntityID id) const { return pColliderComponent_->sparseIdxs_.Has(id); }
+    inline size GetNumColliders()            const { return pColliderComponent_->ids_.size(); }
+
+private:
+    // an endpoint of the AABB's interval by X: (collider idx << 1) | isMax
+    struct SapEndpoint
+    {
+        float  value;
+        uint32 data;
+    };
+
+    void UpdateWorldShapes(TransformSystem& transformSys);
+    void RebuildEndpoints();
+    void SortEndpoints();
+    void Sweep();
+    void NarrowPhase();
+
+private:
+    Collider*              pColliderComponent_ = nullptr;
+
+    cvector<SapEndpoint>   endpoints_;            // SORTED by value (is kept between steps)
+    bool                   isEndpointsDirty_   = true;   // colliders were added/removed (idxs were changed)
+
+    cvector<index>         active_;               // colliders whose intervals are open during the sweep
+    cvector<uint32>        activePos_;            // collider idx => position in active_
+
+    cvector<CollisionPair> broadPairs_;           // pairs of collider idxs (not entts IDs)
+    cvector<CollisionPair> pairs_;
+    cvector<CollisionPair> prevPairs_;
+    cvector<CollisionPair> beginPairs_;
+    cvector<CollisionPair> endPairs_;
+
+    CollisionStats         stats_;
+
+    // transient buffers (are kept between steps so they aren't reallocated)
+    cvector<EntityID>      s_Ids;
+    cvector<index>         s_Idxs;
+    cvector<XMMATRIX>      s_Worlds;
+};
+
+} // namespace ECS
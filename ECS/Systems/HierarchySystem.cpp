@@ -6,6 +6,80 @@
 namespace ECS
 {
 
+// =================================================================================
+// HELPERS
+// =================================================================================
+inline XMVECTOR LoadPosSoA(const TransformSoA& soa, const index i)
+{
+    return XMVectorSet(soa.posX[i], soa.posY[i], soa.posZ[i], 0.0f);
+}
+
+inline XMVECTOR LoadQuatSoA(const TransformSoA& soa, const index i)
+{
+    return XMVectorSet(soa.quatX[i], soa.quatY[i], soa.quatZ[i], soa.quatW[i]);
+}
+
+///////////////////////////////////////////////////////////
+
+void ComposeTransformSoA(
+    const XMVECTOR& parentPos,
+    const XMVECTOR& parentQuat,
+    const float parentScale,
+    const XMFLOAT4& localPosAndScale,
+    const XMVECTOR& localRotation,
+    TransformSoA& soa,
+    const index i)
+{
+    // compute world transformation of child: (S_l * R_l * T_l) * (S_p * R_p * T_p);
+    // since scales are uniform the result is TRS as well:
+    //   scale    = s_l * s_p
+    //   rotation = q_l * q_p
+    //   position = rotate(t_l, q_p) * s_p + t_p
+
+    const XMVECTOR localPos = XMLoadFloat4(&localPosAndScale);
+    const XMVECTOR pos      = XMVectorMultiplyAdd(XMVector3Rotate(localPos, parentQuat), XMVectorReplicate(parentScale), parentPos);
+
+    XMFLOAT3 p;
+    XMFLOAT4 q;
+    XMStoreFloat3(&p, pos);
+    XMStoreFloat4(&q, XMQuaternionMultiply(localRotation, parentQuat));
+
+    soa.posX[i]  = p.x;
+    soa.posY[i]  = p.y;
+    soa.posZ[i]  = p.z;
+    soa.quatX[i] = q.x;
+    soa.quatY[i] = q.y;
+    soa.quatZ[i] = q.z;
+    soa.quatW[i] = q.w;
+    soa.scale[i] = localPosAndScale.w * parentScale;
+}
+
+///////////////////////////////////////////////////////////
+
+void ComputeLocalTRS(
+    const XMVECTOR& childPos,
+    const XMVECTOR& childQuat,
+    const float childScale,
+    const XMVECTOR& parentPos,
+    const XMVECTOR& parentQuat,
+    const float parentScale,
+    XMFLOAT4& outLocalPosAndScale,
+    XMVECTOR& outLocalRotation)
+{
+    // inverse of ComposeTransformSoA(): get child's transformation in parent's space
+
+    const float invParentScale = (parentScale != 0.0f) ? (1.0f / parentScale) : 0.0f;
+    const XMVECTOR offset      = XMVectorSubtract(childPos, parentPos);
+    const XMVECTOR localPos    = XMVectorScale(XMVector3InverseRotate(offset, parentQuat), invParentScale);
+
+    XMStoreFloat4(&outLocalPosAndScale, XMVectorSetW(localPos, childScale * invParentScale));
+    outLocalRotation = XMQuaternionMultiply(childQuat, XMQuaternionConjugate(parentQuat));
+}
+
+
+// =================================================================================
+// HIERARCHY SYSTEM
+// =================================================================================
 HierarchySystem::HierarchySystem(
     Hierarchy* pHierarchyComponent,
     TransformSystem* pTransformSys)
@@ -24,9 +98,73 @@ HierarchySystem::HierarchySystem(
         LogErr("input ptr to the transform system == nullptr");
         return;
     }
+}
+
+///////////////////////////////////////////////////////
+
+void HierarchySystem::Serialize(WorldFileWriter& writer)
+{
+    // we store only parents and local transformations of nodes;
+    // the layout (order, children, siblings) is restored from these relations
 
-    // create "invalid" data which is used when we query for not existent entity ID
-    //pHierarchyComponent->data[0] = HierarchyNode();
+    cvector<EntityID> ids;
+    cvector<EntityID> parentIds;
+    cvector<XMFLOAT4> localPosAndScales;
+    cvector<XMVECTOR> localRotations;
+
+    GatherNodes(ids, parentIds, localPosAndScales, localRotations);
+
+    writer.BeginChunk(HierarchyComponent, 2);
+    writer.WriteArray(ids);
+    writer.WriteArray(parentIds);
+    writer.WriteArray(localPosAndScales);
+    writer.WriteArray(localRotations);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////
+
+bool HierarchySystem::Deserialize(WorldFileReader& reader)
+{
+    if (!reader.BeginChunk(HierarchyComponent))
+    {
+        LogErr("there is no hierarchy data in the world file");
+        return false;
+    }
+
+    if (reader.GetChunkVersion() != 2)
+    {
+        sprintf(g_String, "unsupported version of hierarchy data in the world file: %u", reader.GetChunkVersion());
+        LogErr(g_String);
+        return false;
+    }
+
+    cvector<EntityID> ids;
+    const EntityID*   parentIds         = nullptr;
+    const XMFLOAT4*   localPosAndScales = nullptr;
+    const XMVECTOR*   localRotations    = nullptr;
+
+    bool result = true;
+    result &= reader.ReadArray(ids);
+    result &= reader.ReadArray(parentIds, ids.size());
+    result &= reader.ReadArray(localPosAndScales, ids.size());
+    result &= reader.ReadArray(localRotations, ids.size());
+
+    if (!result)
+    {
+        LogErr("hierarchy data in the world file is corrupted");
+        return false;
+    }
+
+    const size numNodes = ids.size();
+
+    RebuildLayout(
+        ids,
+        cvector<EntityID>(parentIds, parentIds + numNodes),
+        cvector<XMFLOAT4>(localPosAndScales, localPosAndScales + numNodes),
+        cvector<XMVECTOR>(localRotations, localRotations + numNodes));
+
+    return true;
 }
 
 ///////////////////////////////////////////////////////
@@ -36,10 +174,11 @@ bool HierarchySystem::AddChild(const EntityID id, const EntityID childID)
     // add a child for the entity by ID;
     // return true if we managed to did it
 
-    Hierarchy& comp = *pHierarchy_;
+    const Hierarchy& comp = *pHierarchy_;
+    const index childIdx  = comp.sparseIdxs.GetIdx(childID);
 
     // if child already has some another parent
-    if (comp.data[childID].parentID != 0)
+    if ((childIdx != SparseSet::INVALID_IDX) && (comp.parentIdxs[childIdx] != Hierarchy::INVALID_NODE_IDX))
     {
         sprintf(
             g_String,
@@ -51,63 +190,451 @@ bool HierarchySystem::AddChild(const EntityID id, const EntityID childID)
         return false;
     }
 
-    const XMFLOAT3 parentPos = pTransformSys_->GetPosition(id);
-    const XMFLOAT3 childPos = pTransformSys_->GetPosition(childID);
+    return SetParent(childID, id);
+}
+
+///////////////////////////////////////////////////////
 
-    // compute position of child relatively to its parent (offset from parent to child)
-    const XMFLOAT3 relPos =
+bool HierarchySystem::SetParent(const EntityID childID, const EntityID parentID)
+{
+    // set a new parent to child entity (or detach the child if parentID == 0);
+    // if necessary we detach this child from its previous parent;
+    // the current world transformation of the child is kept
+
+    if (childID == INVALID_ENTITY_ID)
     {
-        childPos.x - parentPos.x,
-        childPos.y - parentPos.y,
-        childPos.z - parentPos.z,
-    };
+        LogErr("can't set a parent for invalid entity");
+        return false;
+    }
+
+    if (parentID == childID)
+    {
+        sprintf(g_String, "can't set entt (id: %ld) as a parent of itself", childID);
+        LogErr(g_String);
+        return false;
+    }
 
-    // set a new parent and relative position
-    comp.data[childID].parentID = id;
-    comp.data[childID].relativePos = relPos;
+    const Hierarchy& comp = *pHierarchy_;
+
+    // check for cycles: the new parent mustn't be a descendant of the child
+    for (index idx = comp.sparseIdxs.GetIdx(parentID); idx != SparseSet::INVALID_IDX; idx = comp.parentIdxs[idx])
+    {
+        if (comp.ids[idx] == childID)
+        {
+            sprintf(g_String, "can't set parent (id: %ld) for entt (id: %ld): it is a descendant of this entt", parentID, childID);
+            LogErr(g_String);
+            return false;
+        }
+    }
+
+    cvector<EntityID> ids;
+    cvector<EntityID> parentIds;
+    cvector<XMFLOAT4> localPosAndScales;
+    cvector<XMVECTOR> localRotations;
+
+    GatherNodes(ids, parentIds, localPosAndScales, localRotations);
+
+    // add the parent as a root if it isn't a node yet
+    if ((parentID != INVALID_ENTITY_ID) && !comp.sparseIdxs.Has(parentID))
+    {
+        ids.push_back(parentID);
+        parentIds.push_back(INVALID_ENTITY_ID);
+        localPosAndScales.push_back({ 0,0,0,1 });
+        localRotations.push_back({ 0,0,0,1 });
+    }
+
+    // update (or add) a node of the child
+    index childIdx = comp.sparseIdxs.GetIdx(childID);
+
+    if (childIdx == SparseSet::INVALID_IDX)
+    {
+        childIdx = ids.size();
+        ids.push_back(childID);
+        parentIds.push_back(INVALID_ENTITY_ID);
+        localPosAndScales.push_back({ 0,0,0,1 });
+        localRotations.push_back({ 0,0,0,1 });
+    }
 
-    // add a child entity for the parent entity by ID
-    comp.data[id].children.insert(childID);
+    parentIds[childIdx] = parentID;
 
+    if (parentID != INVALID_ENTITY_ID)
+        ComputeLocalTransform(childID, parentID, localPosAndScales[childIdx], localRotations[childIdx]);
 
+    RebuildLayout(ids, parentIds, localPosAndScales, localRotations);
     return true;
 }
 
 ///////////////////////////////////////////////////////
 
-void HierarchySystem::SetParent(const EntityID childID, const EntityID parentID)
+void HierarchySystem::RemoveRecords(const EntityID* ids, const size numEntts)
 {
-    // set a new parent to child entity;
-    // if necessary we detach this child from its previous parent
+    // remove hierarchy nodes of input entts: detach each of them from
+    // its parent, and children of removed entts become roots
 
-    Hierarchy& comp = *pHierarchy_;
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    const Hierarchy& comp = *pHierarchy_;
+
+    if (!comp.sparseIdxs.HasAny(ids, numEntts))
+        return;
+
+    cvector<EntityID> nodeIds;
+    cvector<EntityID> parentIds;
+    cvector<XMFLOAT4> localPosAndScales;
+    cvector<XMVECTOR> localRotations;
+
+    GatherNodes(nodeIds, parentIds, localPosAndScales, localRotations);
 
-    // if there is already a record with this child entity 
-    if (comp.data.contains(childID))
+    // mark nodes to remove
+    cvector<index> removedIdxs;
+    comp.sparseIdxs.GetExistingIdxs(ids, numEntts, removedIdxs);
+
+    for (const index idx : removedIdxs)
     {
-        // detach this child from its previous parent
-        EntityID prevParentID = comp.data[childID].parentID;
-        comp.data[prevParentID].children.erase(childID);
+        // detach children of the removed node
+        for (index child = comp.firstChildIdxs[idx]; child != Hierarchy::INVALID_NODE_IDX; child = comp.nextSiblingIdxs[child])
+            parentIds[child] = INVALID_ENTITY_ID;
     }
+
+    nodeIds.erase_by_idxs(removedIdxs);
+    parentIds.erase_by_idxs(removedIdxs);
+    localPosAndScales.erase_by_idxs(removedIdxs);
+    localRotations.erase_by_idxs(removedIdxs);
+
+    RebuildLayout(nodeIds, parentIds, localPosAndScales, localRotations);
 }
 
 ///////////////////////////////////////////////////////////
 
 XMFLOAT3 HierarchySystem::GetRelativePos(const EntityID childID) const
 {
-    // get a position relatively to parent
+    // get a position relatively to parent (offset from parent to child in world space)
+
     const Hierarchy& comp = *pHierarchy_;
+    const index idx       = comp.sparseIdxs.GetIdx(childID);
 
-    if (comp.data.contains(childID))
-    {
-        return comp.data.at(childID).relativePos;
-    }
-    else
+    if ((idx == SparseSet::INVALID_IDX) || (comp.parentIdxs[idx] == Hierarchy::INVALID_NODE_IDX))
     {
         sprintf(g_String, "there is no hierarchy data for entity: %d", childID);
         LogErr(g_String);
         return { 0,0,0 };
     }
+
+    const EntityID parentID    = comp.ids[comp.parentIdxs[idx]];
+    const XMVECTOR localPos    = XMLoadFloat4(&comp.localPosAndScales[idx]);
+    const XMVECTOR parentQuat  = pTransformSys_->GetDirectionVec(parentID);
+    const float    parentScale = pTransformSys_->GetUniformScale(parentID);
+
+    XMFLOAT3 relPos;
+    XMStoreFloat3(&relPos, XMVectorScale(XMVector3Rotate(localPos, parentQuat), parentScale));
+
+    return relPos;
+}
+
+///////////////////////////////////////////////////////////
+
+void HierarchySystem::UpdateRelativePos(const EntityID childID)
+{
+    Hierarchy& comp = *pHierarchy_;
+    const index idx = comp.sparseIdxs.GetIdx(childID);
+
+    if ((idx == SparseSet::INVALID_IDX) || (comp.parentIdxs[idx] == Hierarchy::INVALID_NODE_IDX))
+    {
+        sprintf(g_String, "there is no hierarchy data for entt: %d", childID);
+        LogErr(g_String);
+        return;
+    }
+
+    const EntityID parentID = comp.ids[comp.parentIdxs[idx]];
+    ComputeLocalTransform(childID, parentID, comp.localPosAndScales[idx], comp.localRotations[idx]);
+}
+
+///////////////////////////////////////////////////////////
+
+void HierarchySystem::UpdateChildrenPositions(const EntityID parentID)
+{
+    // set a new transformation for each child of the parent entity
+    // (child_world = child_local * parent_world) and rebuild their
+    // world matrices in a single batch
+
+    GetChildrenArr(parentID, s_ChildrenIds);
+
+    if (s_ChildrenIds.empty())
+        return;
+
+    const Hierarchy& comp     = *pHierarchy_;
+    const XMVECTOR parentPos  = pTransformSys_->GetPositionVec(parentID);
+    const XMVECTOR parentQuat = pTransformSys_->GetDirectionVec(parentID);
+    const float parentScale   = pTransformSys_->GetUniformScale(parentID);
+    const size numChildren    = s_ChildrenIds.size();
+    TransformSoA& soa         = s_TransformSoA;
+
+    pTransformSys_->GetTransformsSoA(s_ChildrenIds.data(), numChildren, soa);
+
+    for (index i = 0; i < numChildren; ++i)
+    {
+        const index idx = comp.sparseIdxs.GetIdx(s_ChildrenIds[i]);
+
+        ComposeTransformSoA(
+            parentPos, parentQuat, parentScale,
+            comp.localPosAndScales[idx],
+            comp.localRotations[idx],
+            soa, i);
+    }
+
+    pTransformSys_->SetTransformsSoA(soa);
+}
+
+///////////////////////////////////////////////////////////
+
+void HierarchySystem::PropagateTransforms()
+{
+    // a single linear pass over nodes: since they are sorted by depth
+    // a parent's world is always final before we get to its children;
+    // world matrices of all the updated children are rebuilt with the SIMD kernel
+
+    enum eNodeFlags : uint8
+    {
+        NODE_CHANGED = (1 << 0),    // world of the node was changed during this frame
+        NODE_UPDATED = (1 << 1),    // world of the node was recomputed by this pass
+    };
+
+    Hierarchy& comp     = *pHierarchy_;
+    const size numNodes = comp.Size();
+
+    if (numNodes == 0)
+        return;
+
+    TransformSoA& soa = s_TransformSoA;
+    pTransformSys_->GetTransformsSoA(comp.ids.data(), numNodes, soa);
+
+    s_NodeFlags.resize(numNodes);
+    bool hasUpdatedNodes = false;
+
+    for (index i = 0; i < numNodes; ++i)
+    {
+        const index parentIdx = comp.parentIdxs[i];
+        const bool hasParent  = (parentIdx != Hierarchy::INVALID_NODE_IDX) && (soa.idxs[parentIdx] != 0);
+
+        s_NodeFlags[i] = 0;
+
+        // the node has no transform data
+        if (soa.idxs[i] == 0)
+            continue;
+
+        if (!hasParent || !(s_NodeFlags[parentIdx] & NODE_CHANGED))
+        {
+            if (!pTransformSys_->IsChangedByIdx(soa.idxs[i]))
+                continue;
+
+            s_NodeFlags[i] = NODE_CHANGED;
+
+            // child was moved by itself: remember its new transformation relatively to the parent
+            if (hasParent)
+            {
+                ComputeLocalTRS(
+                    LoadPosSoA(soa, i),         LoadQuatSoA(soa, i),         soa.scale[i],
+                    LoadPosSoA(soa, parentIdx), LoadQuatSoA(soa, parentIdx), soa.scale[parentIdx],
+                    comp.localPosAndScales[i],
+                    comp.localRotations[i]);
+            }
+
+            continue;
+        }
+
+        ComposeTransformSoA(
+            LoadPosSoA(soa, parentIdx),
+            LoadQuatSoA(soa, parentIdx),
+            soa.scale[parentIdx],
+            comp.localPosAndScales[i],
+            comp.localRotations[i],
+            soa, i);
+
+        s_NodeFlags[i]  = NODE_CHANGED | NODE_UPDATED;
+        hasUpdatedNodes = true;
+    }
+
+    if (!hasUpdatedNodes)
+        return;
+
+    // write back only nodes which were recomputed
+    for (index i = 0; i < numNodes; ++i)
+    {
+        if (!(s_NodeFlags[i] & NODE_UPDATED))
+            soa.idxs[i] = 0;
+    }
+
+    pTransformSys_->SetTransformsSoA(soa);
+}
+
+
+// =================================================================================
+// PRIVATE HELPERS
+// =================================================================================
+void HierarchySystem::GatherNodes(
+    cvector<EntityID>& outIds,
+    cvector<EntityID>& outParentIds,
+    cvector<XMFLOAT4>& outLocalPosAndScales,
+    cvector<XMVECTOR>& outLocalRotations) const
+{
+    // get all the nodes in the current order (by depth) with IDs of their parents
+
+    const Hierarchy& comp = *pHierarchy_;
+    const size numNodes   = comp.Size();
+
+    outIds               = comp.ids;
+    outLocalPosAndScales = comp.localPosAndScales;
+    outLocalRotations    = comp.localRotations;
+    outParentIds.resize(numNodes);
+
+    for (index i = 0; i < numNodes; ++i)
+    {
+        const index parentIdx = comp.parentIdxs[i];
+        outParentIds[i] = (parentIdx != Hierarchy::INVALID_NODE_IDX) ? comp.ids[parentIdx] : INVALID_ENTITY_ID;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void HierarchySystem::RebuildLayout(
+    const cvector<EntityID>& ids,
+    const cvector<EntityID>& parentIds,
+    const cvector<XMFLOAT4>& localPosAndScales,
+    const cvector<XMVECTOR>& localRotations)
+{
+    // rebuild the flat layout of the hierarchy from the list of nodes (in any order):
+    // nodes are sorted by depth (siblings go one after another) and linked by idxs;
+    // nodes which have neither parent nor children are removed;
+    //
+    // NOTE: is called only when the structure of hierarchy is changed
+
+    Hierarchy& comp     = *pHierarchy_;
+    const size numNodes = ids.size();
+
+    // lookup: ID => idx in the input arrays
+    SparseSet lookup;
+
+    for (index i = 0; i < numNodes; ++i)
+        lookup.Set(ids[i], i);
+
+    cvector<index> inParentIdxs(numNodes, Hierarchy::INVALID_NODE_IDX);
+    cvector<int>   numChildren(numNodes, 0);
+    cvector<int>   depths(numNodes, 0);
+
+    for (index i = 0; i < numNodes; ++i)
+    {
+        if (parentIds[i] == INVALID_ENTITY_ID)
+            continue;
+
+        const index parentIdx = lookup.GetIdx(parentIds[i]);
+
+        if (parentIdx != SparseSet::INVALID_IDX)
+        {
+            inParentIdxs[i] = parentIdx;
+            ++numChildren[parentIdx];
+        }
+    }
+
+    // compute depth of each node (the number of steps up to the root)
+    for (index i = 0; i < numNodes; ++i)
+    {
+        int depth = 0;
+
+        for (index p = inParentIdxs[i]; (p != Hierarchy::INVALID_NODE_IDX) && (depth < numNodes); p = inParentIdxs[p])
+            ++depth;
+
+        depths[i] = depth;
+    }
+
+    // define the order of nodes: by depth, then by parent (so siblings are adjacent)
+    cvector<index> order;
+    order.reserve(numNodes);
+
+    for (index i = 0; i < numNodes; ++i)
+    {
+        if ((inParentIdxs[i] != Hierarchy::INVALID_NODE_IDX) || (numChildren[i] > 0))
+            order.push_back(i);
+    }
+
+    std::sort(order.begin(), order.end(), [&](const index a, const index b)
+    {
+        if (depths[a] != depths[b])
+            return depths[a] < depths[b];
+
+        if (parentIds[a] != parentIds[b])
+            return parentIds[a] < parentIds[b];
+
+        return ids[a] < ids[b];
+    });
+
+    // fill in the component's arrays
+    const size numOrdered = order.size();
+
+    comp.Clear();
+    comp.ids.resize(numOrdered);
+    comp.parentIdxs.resize(numOrdered);
+    comp.firstChildIdxs.resize(numOrdered);
+    comp.nextSiblingIdxs.resize(numOrdered);
+    comp.depths.resize(numOrdered);
+    comp.localPosAndScales.resize(numOrdered);
+    comp.localRotations.resize(numOrdered);
+
+    for (index i = 0; i < numOrdered; ++i)
+    {
+        const index src = order[i];
+
+        comp.ids[i]               = ids[src];
+        comp.depths[i]            = (uint16)depths[src];
+        comp.localPosAndScales[i] = localPosAndScales[src];
+        comp.localRotations[i]    = localRotations[src];
+        comp.firstChildIdxs[i]    = Hierarchy::INVALID_NODE_IDX;
+        comp.nextSiblingIdxs[i]   = Hierarchy::INVALID_NODE_IDX;
+
+        comp.sparseIdxs.Set(ids[src], i);
+    }
+
+    for (index i = 0; i < numOrdered; ++i)
+    {
+        const EntityID parentID = parentIds[order[i]];
+
+        comp.parentIdxs[i] = (parentID != INVALID_ENTITY_ID) ?
+                             comp.sparseIdxs.GetIdx(parentID) :
+                             Hierarchy::INVALID_NODE_IDX;
+    }
+
+    // link children of each parent (in backward order so the lists go forward)
+    for (index i = numOrdered - 1; i >= 0; --i)
+    {
+        const index parentIdx = comp.parentIdxs[i];
+
+        if (parentIdx == Hierarchy::INVALID_NODE_IDX)
+            continue;
+
+        comp.nextSiblingIdxs[i]        = comp.firstChildIdxs[parentIdx];
+        comp.firstChildIdxs[parentIdx] = i;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void HierarchySystem::ComputeLocalTransform(
+    const EntityID childID,
+    const EntityID parentID,
+    XMFLOAT4& outLocalPosAndScale,
+    XMVECTOR& outLocalRotation) const
+{
+    // compute transformation of child relatively to its parent
+    // using current transformations of both entities
+
+    ComputeLocalTRS(
+        pTransformSys_->GetPositionVec(childID),
+        pTransformSys_->GetDirectionVec(childID),
+        pTransformSys_->GetUniformScale(childID),
+        pTransformSys_->GetPositionVec(parentID),
+        pTransformSys_->GetDirectionVec(parentID),
+        pTransformSys_->GetUniformScale(parentID),
+        outLocalPosAndScale,
+        outLocalRotation);
 }
 
 } // namespace ECS
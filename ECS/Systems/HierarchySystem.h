@@ -9,6 +9,7 @@
 
 #include "../Components/Hierarchy.h"
 #include "../Systems/TransformSystem.h"
+#include "../Common/WorldFile.h"
 
 #pragma warning (disable : 4996)
 
@@ -20,44 +21,42 @@ class HierarchySystem
 public:
     HierarchySystem(Hierarchy* pHierarchyComponent, TransformSystem* pTransformSys);
 
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
     bool AddChild(const EntityID id, const EntityID childID);
-    void SetParent(const EntityID childID, const EntityID parentID);
+    bool SetParent(const EntityID childID, const EntityID parentID);
+
+    void RemoveRecords(const EntityID* ids, const size numEntts);
 
-    // get a position relatively to parent
+    // get a position relatively to parent (offset from parent to child in world space)
     XMFLOAT3 GetRelativePos(const EntityID childID) const;
 
-    void UpdateRelativePos(const EntityID childID)
-    {
-        Hierarchy& comp = *pHierarchy_;
-
-        if (comp.data.contains(childID))
-        {
-            HierarchyNode& node = comp.data.at(childID);
-
-            XMFLOAT3 posParent = pTransformSys_->GetPosition(node.parentID);
-            XMFLOAT3 posChild  = pTransformSys_->GetPosition(childID);
-
-            // compute new relative position
-            node.relativePos =
-            {
-                posChild.x - posParent.x,
-                posChild.y - posParent.y,
-                posChild.z - posParent.z
-            };
-        }
-        else
-        {
-            sprintf(g_String, "there is no hierarchy data for entt: %d", childID);
-            LogErr(g_String);
-        }
-    }
+    // recompute transformation of child relatively to its parent
+    // using current transformations of both entities
+    void UpdateRelativePos(const EntityID childID);
+
+    // move all the children after their parent using relative positions
+    void UpdateChildrenPositions(const EntityID parentID);
+
+    // compute world transformations (world = local * parent_world) of children
+    // whose parents were changed during this frame; children which were moved
+    // by themselves keep their new transformation relatively to the parent
+    void PropagateTransforms();
+
+    // components accessed during the update (is used by the update scheduler)
+    static constexpr ComponentBitfield UPDATE_READS  = GetComponentBit(HierarchyComponent);
+    static constexpr ComponentBitfield UPDATE_WRITES = GetComponentBit(TransformComponent);
 
     ///////////////////////////////////////////////////////
 
     inline bool HasChildren(const EntityID id) const
     {
         // return a flag to define if enitity has any children
-        return !GetChildrenSet(id).empty();
+        const index idx = pHierarchy_->sparseIdxs.GetIdx(id);
+
+        return (idx != SparseSet::INVALID_IDX) &&
+               (pHierarchy_->firstChildIdxs[idx] != Hierarchy::INVALID_NODE_IDX);
     }
 
     ///////////////////////////////////////////////////////
@@ -65,28 +64,44 @@ public:
     inline void GetChildrenArr(const EntityID id, cvector<EntityID>& outChildren) const
     {
         // output: an array of children IDs
+        const Hierarchy& comp = *pHierarchy_;
+        const index idx       = comp.sparseIdxs.GetIdx(id);
 
-        const std::set<EntityID>& children = GetChildrenSet(id);
-        outChildren.resize(children.size());
+        outChildren.clear();
 
-        for (int i = 0; const EntityID childID : children)
-            outChildren[i++] = childID;
-    }
-
-    ///////////////////////////////////////////////////////
-
-    inline const std::set<EntityID>& GetChildrenSet(const EntityID id) const
-    {
-        // return all the children of input entity
-        Hierarchy& comp  = *pHierarchy_;
-        const bool exist = comp.data.contains(id);
+        if (idx == SparseSet::INVALID_IDX)
+            return;
 
-        return comp.data[id * exist].children;      // if not exist we return empty set of children (of entity which ID == 0)
+        for (index child = comp.firstChildIdxs[idx]; child != Hierarchy::INVALID_NODE_IDX; child = comp.nextSiblingIdxs[child])
+            outChildren.push_back(comp.ids[child]);
     }
 
+private:
+    void GatherNodes(
+        cvector<EntityID>& outIds,
+        cvector<EntityID>& outParentIds,
+        cvector<XMFLOAT4>& outLocalPosAndScales,
+        cvector<XMVECTOR>& outLocalRotations) const;
+
+    void RebuildLayout(
+        const cvector<EntityID>& ids,
+        const cvector<EntityID>& parentIds,
+        const cvector<XMFLOAT4>& localPosAndScales,
+        const cvector<XMVECTOR>& localRotations);
+
+    void ComputeLocalTransform(
+        const EntityID childID,
+        const EntityID parentID,
+        XMFLOAT4& outLocalPosAndScale,
+        XMVECTOR& outLocalRotation) const;
+
 private:
     Hierarchy*       pHierarchy_    = nullptr;
     TransformSystem* pTransformSys_ = nullptr;
+
+    cvector<EntityID> s_ChildrenIds;        // static arr of children IDs for the bulk update
+    cvector<uint8>    s_NodeFlags;          // static arr of flags (per node) for transforms propagation
+    TransformSoA      s_TransformSoA;       // static transform data of children
 };
 
 } // namespace ECS
@@ -24,6 +24,262 @@ LightSystem::~LightSystem()
 }
 
 
+// =================================================================================
+// Serialization / Deserialization
+// =================================================================================
+void LightSystem::Serialize(WorldFileWriter& writer)
+{
+    // version 2: point/spot lights are stored by their SoA arrays + animations
+    // version 3: + IDs of static lights
+
+    const Light&         comp   = *pLightComponent_;
+    const PointLights&   points = comp.pointLights;
+    const SpotLights&    spots  = comp.spotLights;
+    const LightFlickers& fl     = comp.flickers;
+    const LightOrbits&   orbits = comp.orbits;
+    const LightFollows&  follow = comp.follows;
+
+    writer.BeginChunk(LightComponent, 3);
+    writer.WriteArray(comp.ids);
+    writer.WriteArray(comp.types);
+    writer.WriteArray(comp.isActive);
+
+    writer.WriteArray(comp.dirLights.ids);
+    writer.WriteArray(comp.dirLights.data);
+
+    writer.WriteArray(points.ids);
+    writer.WriteArray(points.ambient);
+    writer.WriteArray(points.diffuse);
+    writer.WriteArray(points.specular);
+    writer.WriteArray(points.att);
+    writer.WriteArray(points.range);
+
+    writer.WriteArray(spots.ids);
+    writer.WriteArray(spots.ambient);
+    writer.WriteArray(spots.diffuse);
+    writer.WriteArray(spots.specular);
+    writer.WriteArray(spots.att);
+    writer.WriteArray(spots.range);
+    writer.WriteArray(spots.spot);
+
+    writer.WriteArray(fl.ids);
+    writer.WriteArray(fl.baseDiffuse);
+    writer.WriteArray(fl.amplitude);
+    writer.WriteArray(fl.frequency);
+    writer.WriteArray(fl.phase);
+
+    writer.WriteArray(orbits.ids);
+    writer.WriteArray(orbits.centerX);
+    writer.WriteArray(orbits.centerY);
+    writer.WriteArray(orbits.centerZ);
+    writer.WriteArray(orbits.radius);
+    writer.WriteArray(orbits.angularSpeed);
+    writer.WriteArray(orbits.phase);
+
+    writer.WriteArray(follow.ids);
+    writer.WriteArray(follow.targetIds);
+    writer.WriteArray(follow.offsets);
+
+    writer.WriteArray(comp.staticIds);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+static void ReadLightsV1(WorldFileReader& reader, Light& comp, bool& result)
+{
+    // version 1: point/spot lights are stored as arrays of structures
+
+    PointLights& points = comp.pointLights;
+    SpotLights&  spots  = comp.spotLights;
+
+    cvector<PointLight> pointData;
+    cvector<SpotLight>  spotData;
+
+    result &= reader.ReadArray(points.ids);
+    result &= reader.ReadArray(pointData);
+
+    result &= reader.ReadArray(spots.ids);
+    result &= reader.ReadArray(spotData);
+
+    const size numPoints = pointData.size();
+    const size numSpots  = spotData.size();
+
+    points.ambient.resize(numPoints);
+    points.diffuse.resize(numPoints);
+    points.specular.resize(numPoints);
+    points.att.resize(numPoints);
+    points.range.resize(numPoints);
+
+    for (index i = 0; i < numPoints; ++i)
+    {
+        points.ambient[i]  = pointData[i].ambient;
+        points.diffuse[i]  = pointData[i].diffuse;
+        points.specular[i] = pointData[i].specular;
+        points.att[i]      = pointData[i].att;
+        points.range[i]    = pointData[i].range;
+    }
+
+    spots.ambient.resize(numSpots);
+    spots.diffuse.resize(numSpots);
+    spots.specular.resize(numSpots);
+    spots.att.resize(numSpots);
+    spots.range.resize(numSpots);
+    spots.spot.resize(numSpots);
+
+    for (index i = 0; i < numSpots; ++i)
+    {
+        spots.ambient[i]  = spotData[i].ambient;
+        spots.diffuse[i]  = spotData[i].diffuse;
+        spots.specular[i] = spotData[i].specular;
+        spots.att[i]      = spotData[i].att;
+        spots.range[i]    = spotData[i].range;
+        spots.spot[i]     = spotData[i].spot;
+    }
+
+    comp.flickers = LightFlickers();
+    comp.orbits   = LightOrbits();
+    comp.follows  = LightFollows();
+}
+
+///////////////////////////////////////////////////////////
+
+static void ReadLightsV2(WorldFileReader& reader, Light& comp, bool& result)
+{
+    PointLights&   points = comp.pointLights;
+    SpotLights&    spots  = comp.spotLights;
+    LightFlickers& fl     = comp.flickers;
+    LightOrbits&   orbits = comp.orbits;
+    LightFollows&  follow = comp.follows;
+
+    result &= reader.ReadArray(points.ids);
+    result &= reader.ReadArray(points.ambient);
+    result &= reader.ReadArray(points.diffuse);
+    result &= reader.ReadArray(points.specular);
+    result &= reader.ReadArray(points.att);
+    result &= reader.ReadArray(points.range);
+
+    result &= reader.ReadArray(spots.ids);
+    result &= reader.ReadArray(spots.ambient);
+    result &= reader.ReadArray(spots.diffuse);
+    result &= reader.ReadArray(spots.specular);
+    result &= reader.ReadArray(spots.att);
+    result &= reader.ReadArray(spots.range);
+    result &= reader.ReadArray(spots.spot);
+
+    result &= reader.ReadArray(fl.ids);
+    result &= reader.ReadArray(fl.baseDiffuse);
+    result &= reader.ReadArray(fl.amplitude);
+    result &= reader.ReadArray(fl.frequency);
+    result &= reader.ReadArray(fl.phase);
+
+    result &= reader.ReadArray(orbits.ids);
+    result &= reader.ReadArray(orbits.centerX);
+    result &= reader.ReadArray(orbits.centerY);
+    result &= reader.ReadArray(orbits.centerZ);
+    result &= reader.ReadArray(orbits.radius);
+    result &= reader.ReadArray(orbits.angularSpeed);
+    result &= reader.ReadArray(orbits.phase);
+
+    result &= reader.ReadArray(follow.ids);
+    result &= reader.ReadArray(follow.targetIds);
+    result &= reader.ReadArray(follow.offsets);
+
+    const size numPoints = points.ids.size();
+    const size numSpots  = spots.ids.size();
+
+    for (const size n : { points.ambient.size(), points.diffuse.size(), points.specular.size(), points.att.size(), points.range.size() })
+        result &= (n == numPoints);
+
+    for (const size n : { spots.ambient.size(), spots.diffuse.size(), spots.specular.size(), spots.att.size(), spots.range.size(), spots.spot.size() })
+        result &= (n == numSpots);
+
+    for (const size n : { fl.baseDiffuse.size(), fl.amplitude.size(), fl.frequency.size(), fl.phase.size() })
+        result &= (n == fl.ids.size());
+
+    for (const size n : { orbits.centerX.size(), orbits.centerY.size(), orbits.centerZ.size(), orbits.radius.size(), orbits.angularSpeed.size(), orbits.phase.size() })
+        result &= (n == orbits.ids.size());
+
+    result &= (follow.targetIds.size() == follow.ids.size());
+    result &= (follow.offsets.size()   == follow.ids.size());
+}
+
+///////////////////////////////////////////////////////////
+
+bool LightSystem::Deserialize(WorldFileReader& reader)
+{
+    Light& comp = *pLightComponent_;
+
+    if (!reader.BeginChunk(LightComponent))
+    {
+        LogErr("there is no light data in the world file");
+        return false;
+    }
+
+    const uint32 version = reader.GetChunkVersion();
+
+    if ((version < 1) || (version > 3))
+    {
+        sprintf(g_String, "unsupported version of light data in the world file: %u", version);
+        LogErr(g_String);
+        return false;
+    }
+
+    bool result = true;
+    result &= reader.ReadArray(comp.ids);
+    result &= reader.ReadArray(comp.types);
+    result &= reader.ReadArray(comp.isActive);
+
+    result &= reader.ReadArray(comp.dirLights.ids);
+    result &= reader.ReadArray(comp.dirLights.data);
+
+    if (version == 1)
+        ReadLightsV1(reader, comp, result);
+    else
+        ReadLightsV2(reader, comp, result);
+
+    if (version >= 3)
+        result &= reader.ReadArray(comp.staticIds);
+    else
+        comp.staticIds.clear();
+
+    result &= (comp.types.size()    == comp.ids.size());
+    result &= (comp.isActive.size() == comp.ids.size());
+    result &= (comp.dirLights.data.size()   == comp.dirLights.ids.size());
+    result &= (comp.pointLights.range.size() == comp.pointLights.ids.size());
+    result &= (comp.spotLights.range.size()  == comp.spotLights.ids.size());
+
+    if (!result)
+    {
+        LogErr("light data in the world file is corrupted");
+        return false;
+    }
+
+    // the renderer uploads all the point lights after loading
+    comp.pointLights.flags.resize(comp.pointLights.ids.size(), LIGHT_FLAG_NONE);
+    comp.pointLights.changedIdxs.clear();
+    ++comp.pointLights.version;
+
+    comp.sparseIdxs.Clear();
+    comp.dirLights.sparseIdxs.Clear();
+    comp.pointLights.sparseIdxs.Clear();
+    comp.spotLights.sparseIdxs.Clear();
+    comp.flickers.sparseIdxs.Clear();
+    comp.orbits.sparseIdxs.Clear();
+    comp.follows.sparseIdxs.Clear();
+
+    comp.sparseIdxs.Rebuild(comp.ids);
+    comp.dirLights.sparseIdxs.Rebuild(comp.dirLights.ids);
+    comp.pointLights.sparseIdxs.Rebuild(comp.pointLights.ids);
+    comp.spotLights.sparseIdxs.Rebuild(comp.spotLights.ids);
+    comp.flickers.sparseIdxs.Rebuild(comp.flickers.ids);
+    comp.orbits.sparseIdxs.Rebuild(comp.orbits.ids);
+    comp.follows.sparseIdxs.Rebuild(comp.follows.ids);
+
+    return true;
+}
+
+
 // =================================================================================
 // private API: common helpers
 // =================================================================================
@@ -52,6 +308,31 @@ XMFLOAT4 GetLightPropInvalidData()
     return { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
 }
 
+///////////////////////////////////////////////////////////
+
+inline void GetPointLightByIdx(const PointLights& lights, const index idx, PointLight& out)
+{
+    // assemble a point light from the SoA by idx
+    out.ambient  = lights.ambient[idx];
+    out.diffuse  = lights.diffuse[idx];
+    out.specular = lights.specular[idx];
+    out.att      = lights.att[idx];
+    out.range    = lights.range[idx];
+}
+
+///////////////////////////////////////////////////////////
+
+inline void GetSpotLightByIdx(const SpotLights& lights, const index idx, SpotLight& out)
+{
+    // assemble a spotlight from the SoA by idx
+    out.ambient  = lights.ambient[idx];
+    out.diffuse  = lights.diffuse[idx];
+    out.specular = lights.specular[idx];
+    out.att      = lights.att[idx];
+    out.range    = lights.range[idx];
+    out.spot     = lights.spot[idx];
+}
+
 
 // =================================================================================
 // public API: creation
@@ -68,39 +349,25 @@ void LightSystem::AddDirLights(
     
     Light& comp = *pLightComponent_;
     cvector<index> idxs;
-    comp.ids.get_insert_idxs(ids, numEntts, idxs);
-
-    // exec some index correction
-    for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
 
     // execute sorted insertion of new records into the data arrays of the component
-    for (index i = 0; i < numEntts; ++i)
-        comp.ids.insert_before(idxs[i], ids[i]);
-
-    for (index i = 0; i < numEntts; ++i)
-        comp.types.insert_before(idxs[i], LightType::DIRECTIONAL);
+    // (ids are merged in a single pass, the rest arrays are filled by the same idxs)
+    comp.ids.merge_sorted(ids, numEntts, idxs);
+    comp.types.insert_by_idxs(idxs, LightType::DIRECTIONAL);
+    comp.isActive.insert_by_idxs(idxs, true);
 
-    for (index i = 0; i < numEntts; ++i)
-        comp.isActive.insert_before(idxs[i], true);
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
 
     // ------------------------------------------
 
     // add ids and lights data into the light container
     DirLights& lights = GetDirLights();
 
-    lights.ids.get_idxs(ids, numEntts, idxs);
-
-    // exec some index correction
-    for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
-
     // execute sorted insertion of data
-    for (index i = 0; i < numEntts; ++i)
-        lights.ids.insert_before(idxs[i], ids[i]);
+    lights.ids.merge_sorted(ids, numEntts, idxs);
+    lights.data.insert_by_idxs(idxs, params.data.data());
 
-    for (index i = 0; i < numEntts; ++i)
-        lights.data.insert_before(idxs[i], params.data[i]);
+    lights.sparseIdxs.Rebuild(lights.ids, idxs[0]);
 }
 
 ///////////////////////////////////////////////////////////
@@ -116,39 +383,51 @@ void LightSystem::AddPointLights(
 
     Light& comp = *pLightComponent_;
     cvector<index> idxs;
-    comp.ids.get_insert_idxs(ids, numEntts, idxs);
-
-    // exec some index correction
-    for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
 
     // execute sorted insertion of new records into the data arrays of the component
-    for (index i = 0; i < numEntts; ++i)
-        comp.ids.insert_before(idxs[i], ids[i]);
-
-    for (index i = 0; i < numEntts; ++i)
-        comp.types.insert_before(idxs[i], LightType::POINT);
+    // (ids are merged in a single pass, the rest arrays are filled by the same idxs)
+    comp.ids.merge_sorted(ids, numEntts, idxs);
+    comp.types.insert_by_idxs(idxs, LightType::POINT);
+    comp.isActive.insert_by_idxs(idxs, true);
 
-    for (index i = 0; i < numEntts; ++i)
-        comp.isActive.insert_before(idxs[i], true);
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
 
     // ------------------------------------------
 
     // add ids and lights data into the light container
     PointLights& lights = GetPointLights();
+    const PointLight* data = params.data.data();
 
-    lights.ids.get_idxs(ids, numEntts, idxs);
+    cvector<XMFLOAT4> ambient(numEntts);
+    cvector<XMFLOAT4> diffuse(numEntts);
+    cvector<XMFLOAT4> specular(numEntts);
+    cvector<XMFLOAT3> att(numEntts);
+    cvector<float>    range(numEntts);
 
-    // exec some index correction
+    // split input lights into arrays by props
     for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
+    {
+        ambient[i]  = data[i].ambient;
+        diffuse[i]  = data[i].diffuse;
+        specular[i] = data[i].specular;
+        att[i]      = data[i].att;
+        range[i]    = data[i].range;
+    }
 
     // execute sorted insertion of data
-    for (index i = 0; i < numEntts; ++i)
-        lights.ids.insert_before(idxs[i], ids[i]);
-
-    for (index i = 0; i < numEntts; ++i)
-        lights.data.insert_before(idxs[i], params.data[i]);
+    lights.ids.merge_sorted(ids, numEntts, idxs);
+    lights.ambient.insert_by_idxs(idxs, ambient.data());
+    lights.diffuse.insert_by_idxs(idxs, diffuse.data());
+    lights.specular.insert_by_idxs(idxs, specular.data());
+    lights.att.insert_by_idxs(idxs, att.data());
+    lights.range.insert_by_idxs(idxs, range.data());
+    lights.flags.insert_by_idxs(idxs, (uint8)LIGHT_FLAG_NONE);
+
+    lights.sparseIdxs.Rebuild(lights.ids, idxs[0]);
+
+    // idxs are shifted so the renderer uploads all the lights
+    ++lights.version;
+    ResetChangedPointLights();
 }
 
 ///////////////////////////////////////////////////////////
@@ -164,38 +443,458 @@ void LightSystem::AddSpotLights(
 
     Light& comp = *pLightComponent_;
     cvector<index> idxs;
-    comp.ids.get_insert_idxs(ids, numEntts, idxs);
-
-    // exec some index correction
-    for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
 
     // execute sorted insertion of new records into the data arrays of the component
-    for (index i = 0; i < numEntts; ++i)
-        comp.ids.insert_before(idxs[i], ids[i]);
+    // (ids are merged in a single pass, the rest arrays are filled by the same idxs)
+    comp.ids.merge_sorted(ids, numEntts, idxs);
+    comp.types.insert_by_idxs(idxs, LightType::SPOT);
+    comp.isActive.insert_by_idxs(idxs, true);
 
-    for (index i = 0; i < numEntts; ++i)
-        comp.types.insert_before(idxs[i], LightType::SPOT);
-
-    for (index i = 0; i < numEntts; ++i)
-        comp.isActive.insert_before(idxs[i], true);
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
 
     // ------------------------------------------
 
     SpotLights& lights = GetSpotLights();
+    const SpotLight* data = params.data.data();
 
-    lights.ids.get_idxs(ids, numEntts, idxs);
+    cvector<XMFLOAT4> ambient(numEntts);
+    cvector<XMFLOAT4> diffuse(numEntts);
+    cvector<XMFLOAT4> specular(numEntts);
+    cvector<XMFLOAT3> att(numEntts);
+    cvector<float>    range(numEntts);
+    cvector<float>    spot(numEntts);
 
-    // exec some index correction
+    // split input lights into arrays by props
     for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
+    {
+        ambient[i]  = data[i].ambient;
+        diffuse[i]  = data[i].diffuse;
+        specular[i] = data[i].specular;
+        att[i]      = data[i].att;
+        range[i]    = data[i].range;
+        spot[i]     = data[i].spot;
+    }
 
     // execute sorted insertion of data
+    lights.ids.merge_sorted(ids, numEntts, idxs);
+    lights.ambient.insert_by_idxs(idxs, ambient.data());
+    lights.diffuse.insert_by_idxs(idxs, diffuse.data());
+    lights.specular.insert_by_idxs(idxs, specular.data());
+    lights.att.insert_by_idxs(idxs, att.data());
+    lights.range.insert_by_idxs(idxs, range.data());
+    lights.spot.insert_by_idxs(idxs, spot.data());
+
+    lights.sparseIdxs.Rebuild(lights.ids, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+static void RemoveFlickers(LightFlickers& fl, const EntityID* ids, const size numEntts);
+static void RemoveOrbits  (LightOrbits& orbits, const EntityID* ids, const size numEntts);
+static void RemoveFollows (LightFollows& follows, const EntityID* ids, const size numEntts);
+static void RemoveStatic  (cvector<EntityID>& staticIds, const EntityID* ids, const size numEntts);
+
+static inline float GetPhaseByID(const EntityID id)
+{
+    // a stable pseudo-random phase in [0, 2pi) so neighbour lights are out of sync
+    const uint32 hash = (uint32)id * 2654435761u;
+    return (float)(hash >> 8) * (DirectX::XM_2PI / 16777216.0f);
+}
+
+///////////////////////////////////////////////////////////
+
+void LightSystem::AddFlickers(
+    const EntityID* ids,
+    const size numEntts,
+    const float* amplitudes,
+    const float* frequencies)
+{
+    // make input point lights flicker around their current diffuse color
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+    CAssert::True(amplitudes && frequencies,          "input ptr to flicker params == nullptr");
+
+    Light&         comp   = *pLightComponent_;
+    PointLights&   points = comp.pointLights;
+    LightFlickers& fl     = comp.flickers;
+
+    RemoveFlickers(fl, ids, numEntts);
+    RemoveStatic(comp.staticIds, ids, numEntts);
+
+    cvector<EntityID> validIds;
+    cvector<XMFLOAT4> baseDiffuse;
+    cvector<float>    amplitude;
+    cvector<float>    frequency;
+    cvector<float>    phase;
+
     for (index i = 0; i < numEntts; ++i)
-        lights.ids.insert_before(idxs[i], ids[i]);
+    {
+        const index idx = points.sparseIdxs.GetIdx(ids[i]);
+
+        if (idx == -1)
+        {
+            LogErr(GenerateMsgNoEntity(ids[i], "point"));
+            continue;
+        }
+
+        validIds.push_back(ids[i]);
+        baseDiffuse.push_back(points.diffuse[idx]);
+        amplitude.push_back(MathHelper::Clamp(amplitudes[i], 0.0f, 1.0f));
+        frequency.push_back(frequencies[i]);
+        phase.push_back(GetPhaseByID(ids[i]));
+    }
+
+    if (validIds.empty())
+        return;
+
+    cvector<index> idxs;
+    fl.ids.merge_sorted(validIds, idxs);
+    fl.baseDiffuse.insert_by_idxs(idxs, baseDiffuse.data());
+    fl.amplitude.insert_by_idxs(idxs, amplitude.data());
+    fl.frequency.insert_by_idxs(idxs, frequency.data());
+    fl.phase.insert_by_idxs(idxs, phase.data());
+
+    fl.sparseIdxs.Rebuild(fl.ids, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+void LightSystem::AddOrbits(
+    const EntityID* ids,
+    const size numEntts,
+    const XMFLOAT3* centers,
+    const float* radiuses,
+    const float* angularSpeeds)
+{
+    // make input lights circle around centers in the XZ-plane;
+    // each light starts from its current angle around the center
+
+    CAssert::True((ids != nullptr) && (numEntts > 0),  "invalid input args");
+    CAssert::True(centers && radiuses && angularSpeeds, "input ptr to orbit params == nullptr");
+
+    Light&       comp   = *pLightComponent_;
+    LightOrbits& orbits = comp.orbits;
+
+    RemoveOrbits(orbits, ids, numEntts);
+    RemoveStatic(comp.staticIds, ids, numEntts);
+
+    cvector<XMFLOAT3> positions;
+    pTransformSys_->GetPositions(ids, numEntts, positions);
+
+    cvector<float> centerX(numEntts);
+    cvector<float> centerY(numEntts);
+    cvector<float> centerZ(numEntts);
+    cvector<float> phase(numEntts);
 
     for (index i = 0; i < numEntts; ++i)
-        lights.data.insert_before(idxs[i], params.data[i]);
+    {
+        const float dx = positions[i].x - centers[i].x;
+        const float dz = positions[i].z - centers[i].z;
+
+        centerX[i] = centers[i].x;
+        centerY[i] = centers[i].y;
+        centerZ[i] = centers[i].z;
+
+        // angle = phase + speed * t  =>  the current angle at the current time
+        phase[i] = atan2f(dz, dx) - angularSpeeds[i] * totalGameTime_;
+    }
+
+    cvector<index> idxs;
+    orbits.ids.merge_sorted(ids, numEntts, idxs);
+    orbits.centerX.insert_by_idxs(idxs, centerX.data());
+    orbits.centerY.insert_by_idxs(idxs, centerY.data());
+    orbits.centerZ.insert_by_idxs(idxs, centerZ.data());
+    orbits.radius.insert_by_idxs(idxs, radiuses);
+    orbits.angularSpeed.insert_by_idxs(idxs, angularSpeeds);
+    orbits.phase.insert_by_idxs(idxs, phase.data());
+
+    orbits.sparseIdxs.Rebuild(orbits.ids, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+void LightSystem::AddFollows(
+    const EntityID* ids,
+    const size numEntts,
+    const EntityID* targetIds,
+    const XMFLOAT3* offsets)
+{
+    // attach input lights to target entts: pos = target pos + offset
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+    CAssert::True(targetIds && offsets,               "input ptr to follow params == nullptr");
+
+    LightFollows& follows = pLightComponent_->follows;
+
+    RemoveFollows(follows, ids, numEntts);
+    RemoveStatic(pLightComponent_->staticIds, ids, numEntts);
+
+    cvector<index> idxs;
+    follows.ids.merge_sorted(ids, numEntts, idxs);
+    follows.targetIds.insert_by_idxs(idxs, targetIds);
+    follows.offsets.insert_by_idxs(idxs, offsets);
+
+    follows.sparseIdxs.Rebuild(follows.ids, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+static void RemoveDirLights(DirLights& lights, const EntityID* ids, const size numEntts)
+{
+    cvector<index> idxs;
+    lights.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    lights.ids.erase_by_idxs(idxs);
+    lights.data.erase_by_idxs(idxs);
+
+    lights.sparseIdxs.Remove(ids, numEntts);
+    lights.sparseIdxs.Rebuild(lights.ids, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+static void RemovePointLights(PointLights& lights, const EntityID* ids, const size numEntts)
+{
+    cvector<index> idxs;
+    lights.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    lights.ids.erase_by_idxs(idxs);
+    lights.ambient.erase_by_idxs(idxs);
+    lights.diffuse.erase_by_idxs(idxs);
+    lights.specular.erase_by_idxs(idxs);
+    lights.att.erase_by_idxs(idxs);
+    lights.range.erase_by_idxs(idxs);
+    lights.flags.erase_by_idxs(idxs);
+
+    lights.sparseIdxs.Remove(ids, numEntts);
+    lights.sparseIdxs.Rebuild(lights.ids, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+static void RemoveSpotLights(SpotLights& lights, const EntityID* ids, const size numEntts)
+{
+    cvector<index> idxs;
+    lights.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    lights.ids.erase_by_idxs(idxs);
+    lights.ambient.erase_by_idxs(idxs);
+    lights.diffuse.erase_by_idxs(idxs);
+    lights.specular.erase_by_idxs(idxs);
+    lights.att.erase_by_idxs(idxs);
+    lights.range.erase_by_idxs(idxs);
+    lights.spot.erase_by_idxs(idxs);
+
+    lights.sparseIdxs.Remove(ids, numEntts);
+    lights.sparseIdxs.Rebuild(lights.ids, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+static void RemoveFlickers(LightFlickers& fl, const EntityID* ids, const size numEntts)
+{
+    cvector<index> idxs;
+    fl.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    fl.ids.erase_by_idxs(idxs);
+    fl.baseDiffuse.erase_by_idxs(idxs);
+    fl.amplitude.erase_by_idxs(idxs);
+    fl.frequency.erase_by_idxs(idxs);
+    fl.phase.erase_by_idxs(idxs);
+
+    fl.sparseIdxs.Remove(ids, numEntts);
+    fl.sparseIdxs.Rebuild(fl.ids, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+static void RemoveOrbits(LightOrbits& orbits, const EntityID* ids, const size numEntts)
+{
+    cvector<index> idxs;
+    orbits.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    orbits.ids.erase_by_idxs(idxs);
+    orbits.centerX.erase_by_idxs(idxs);
+    orbits.centerY.erase_by_idxs(idxs);
+    orbits.centerZ.erase_by_idxs(idxs);
+    orbits.radius.erase_by_idxs(idxs);
+    orbits.angularSpeed.erase_by_idxs(idxs);
+    orbits.phase.erase_by_idxs(idxs);
+
+    orbits.sparseIdxs.Remove(ids, numEntts);
+    orbits.sparseIdxs.Rebuild(orbits.ids, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+static void RemoveFollows(LightFollows& follows, const EntityID* ids, const size numEntts)
+{
+    cvector<index> idxs;
+    follows.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    follows.ids.erase_by_idxs(idxs);
+    follows.targetIds.erase_by_idxs(idxs);
+    follows.offsets.erase_by_idxs(idxs);
+
+    follows.sparseIdxs.Remove(ids, numEntts);
+    follows.sparseIdxs.Rebuild(follows.ids, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+static void RemoveStatic(cvector<EntityID>& staticIds, const EntityID* ids, const size numEntts)
+{
+    cvector<index> idxs;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        if (staticIds.binary_search(ids[i]))
+            idxs.push_back(staticIds.get_idx(ids[i]));
+    }
+
+    if (idxs.empty())
+        return;
+
+    // (input ids aren't required to be SORTED)
+    std::sort(idxs.begin(), idxs.end());
+    staticIds.erase_by_idxs(idxs);
+}
+
+///////////////////////////////////////////////////////////
+
+void LightSystem::SetStatic(const EntityID* ids, const size numEntts, const bool isStatic)
+{
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Light& comp = *pLightComponent_;
+
+    if (!isStatic)
+    {
+        RemoveStatic(comp.staticIds, ids, numEntts);
+        return;
+    }
+
+    cvector<EntityID> validIds;
+    validIds.reserve(numEntts);
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const EntityID id = ids[i];
+
+        if (!IsPointLight(id) && !IsSpotLight(id))
+        {
+            sprintf(g_String, "can't make static: entt %u isn't a point/spot light", id);
+            LogErr(g_String);
+            continue;
+        }
+
+        if (comp.flickers.sparseIdxs.Has(id) ||
+            comp.orbits.sparseIdxs.Has(id)   ||
+            comp.follows.sparseIdxs.Has(id))
+        {
+            sprintf(g_String, "can't make static: light %u is animated", id);
+            LogErr(g_String);
+            continue;
+        }
+
+        if (!comp.staticIds.binary_search(id))
+            validIds.push_back(id);
+    }
+
+    if (validIds.empty())
+        return;
+
+    std::sort(validIds.begin(), validIds.end());
+
+    cvector<index> idxs;
+    comp.staticIds.merge_sorted(validIds.data(), validIds.size(), idxs);
+}
+
+///////////////////////////////////////////////////////////
+
+void LightSystem::RemoveAnimations(const EntityID* ids, const size numEntts)
+{
+    // remove any animations of input lights (lights themselves are kept);
+    // lights which follow removed entts are also stopped
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Light& comp = *pLightComponent_;
+
+    RemoveFlickers(comp.flickers, ids, numEntts);
+    RemoveOrbits  (comp.orbits,   ids, numEntts);
+    RemoveFollows (comp.follows,  ids, numEntts);
+
+    // input ids are sorted so the target can be searched by binary search
+    const cvector<EntityID>& targets = comp.follows.targetIds;
+    cvector<EntityID> orphans;
+
+    for (index i = 0; i < targets.size(); ++i)
+    {
+        if (std::binary_search(ids, ids + numEntts, targets[i]))
+            orphans.push_back(comp.follows.ids[i]);
+    }
+
+    if (!orphans.empty())
+        RemoveFollows(comp.follows, orphans.data(), orphans.size());
+}
+
+///////////////////////////////////////////////////////////
+
+void LightSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+    // remove light sources of input entts (if they have any) with a single
+    // pass over each data array, so the arrays remain SORTED
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Light& comp = *pLightComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    comp.ids.erase_by_idxs(idxs);
+    comp.types.erase_by_idxs(idxs);
+    comp.isActive.erase_by_idxs(idxs);
+
+    comp.sparseIdxs.Remove(ids, numEntts);
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
+
+    const size numPointLights = comp.pointLights.ids.size();
+
+    RemoveDirLights  (comp.dirLights,   ids, numEntts);
+    RemovePointLights(comp.pointLights, ids, numEntts);
+    RemoveSpotLights (comp.spotLights,  ids, numEntts);
+    RemoveAnimations(ids, numEntts);
+    RemoveStatic(comp.staticIds, ids, numEntts);
+
+    // idxs are shifted so the renderer uploads all the lights
+    if (comp.pointLights.ids.size() != numPointLights)
+    {
+        ++comp.pointLights.version;
+        ResetChangedPointLights();
+    }
 }
 
 
@@ -208,7 +907,7 @@ bool LightSystem::GetDirectedLightData(EntityID id, ECS::DirLight& outDirLight)
     // return: true - if there is such an entity by ID; false - in another case;
 
     DirLights& lights = GetDirLights();
-    const index idx = GetIdxByID(lights.ids, id);
+    const index idx = lights.sparseIdxs.GetIdx(id);
 
     // if we didn't find any entt by input ID
     if (idx == -1)
@@ -229,7 +928,7 @@ bool LightSystem::SetDirLightProp(
     const XMFLOAT4& value)
 {
     DirLights& lights = GetDirLights();
-    const index idx   = GetIdxByID(lights.ids, id);
+    const index idx   = lights.sparseIdxs.GetIdx(id);
 
     // if there is no entity by such ID we cannot update any data so return false
     if (idx == -1)
@@ -275,7 +974,7 @@ bool LightSystem::SetDirLightProp(
     const XMFLOAT3& val)
 {
     DirLights& lights = GetDirLights();
-    const index idx = GetIdxByID(lights.ids, id);
+    const index idx = lights.sparseIdxs.GetIdx(id);
 
     // if there is no entity by such ID we cannot update any data so return false
     if (idx == -1)
@@ -310,7 +1009,7 @@ XMFLOAT4 LightSystem::GetDirLightProp(const EntityID id, const LightProp prop)
     // get a property of the directed light entity by ID
 
     DirLights& lights = GetDirLights();
-    const index idx = GetIdxByID(lights.ids, id);
+    const index idx = lights.sparseIdxs.GetIdx(id);
 
     if (idx == -1)
     {
@@ -367,13 +1066,13 @@ void LightSystem::GetPointLightsData(
 
     cvector<index> idxs;
     PointLights& lights = GetPointLights();
-    lights.ids.get_idxs(ids, numEntts, idxs);
+    lights.sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
 
     // get point lights data by indices
     outData.resize(numEntts);
 
     for (int i = 0; const index idx : idxs)
-        outData[i++] = lights.data[idx];
+        GetPointLightByIdx(lights, idx, outData[i++]);
 
     // get point light positions (are store in the Transform component)
     pTransformSys_->GetPositions(ids, numEntts, outPositions);
@@ -398,11 +1097,11 @@ void LightSystem::GetSpotLightsData(
 
     cvector<index> idxs;
     SpotLights& lights = GetSpotLights();
-    lights.ids.get_idxs(ids, numEntts, idxs);
+    lights.sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
 
     // get spotlights by idxs
     for (int i = 0; const index idx : idxs)
-        outData[i++] = lights.data[idx];
+        GetSpotLightByIdx(lights, idx, outData[i++]);
 
     // get spotlights positions and directions
     pTransformSys_->GetPositionsAndDirections(ids, numEntts, outPositions, outDirections);
@@ -416,7 +1115,7 @@ bool LightSystem::GetPointLightData(const EntityID id, ECS::PointLight& outPoint
     // return: true - if there is such an entity by ID; false - in another case;
 
     PointLights& lights = GetPointLights();
-    const index idx = GetIdxByID(lights.ids, id);
+    const index idx = lights.sparseIdxs.GetIdx(id);
 
     // if we didn't find any entt by input ID
     if (idx == -1)
@@ -425,7 +1124,7 @@ bool LightSystem::GetPointLightData(const EntityID id, ECS::PointLight& outPoint
         return false;
     }
 
-    outPointLight = lights.data[idx];
+    GetPointLightByIdx(lights, idx, outPointLight);
     return true;
 }
 
@@ -436,7 +1135,7 @@ XMFLOAT4 LightSystem::GetPointLightProp(const EntityID id, const LightProp prop)
     // get a property of the point light entity by ID
 
     PointLights& lights = GetPointLights();
-    const index idx = GetIdxByID(lights.ids, id);
+    const index idx = lights.sparseIdxs.GetIdx(id);
     
     if (idx == -1)
     {
@@ -445,21 +1144,19 @@ XMFLOAT4 LightSystem::GetPointLightProp(const EntityID id, const LightProp prop)
         return GetLightPropInvalidData();
     }
 
-    PointLight& light = lights.data[idx];
-
     switch (prop)
     {
         case AMBIENT:
         {
-            return light.ambient;
+            return lights.ambient[idx];
         }
         case DIFFUSE:
         {
-            return light.diffuse;
+            return lights.diffuse[idx];
         }
         case SPECULAR:
         {
-            return light.specular;
+            return lights.specular[idx];
         }
         case POSITION:
         {
@@ -470,12 +1167,12 @@ XMFLOAT4 LightSystem::GetPointLightProp(const EntityID id, const LightProp prop)
         case RANGE:
         {
             // return the range value in each component of XMFLOAT4
-            const float r = light.range;
+            const float r = lights.range[idx];
             return { r, r, r, r };               
         }
         case ATTENUATION:
         {
-            const XMFLOAT3& att = light.att;
+            const XMFLOAT3& att = lights.att[idx];
             return { att.x, att.y, att.z, 1.0f };
         }
         default:
@@ -493,7 +1190,7 @@ bool LightSystem::SetPointLightProp(
     const XMFLOAT4& value)
 {
     PointLights& lights = GetPointLights();
-    const index idx     = GetIdxByID(lights.ids, id);
+    const index idx     = lights.sparseIdxs.GetIdx(id);
 
     // if there is no entity by such ID we cannot update any data so return false
     if (idx == -1)
@@ -502,23 +1199,29 @@ bool LightSystem::SetPointLightProp(
         return false;
     }
         
-    PointLight& light = lights.data[idx];
-
     switch (prop)
     {
         case LightProp::AMBIENT:
         {
-            light.ambient = value;
+            lights.ambient[idx] = value;
             break;
         }
         case LightProp::DIFFUSE:
         {
-            light.diffuse = value;
+            lights.diffuse[idx] = value;
+
+            // a flickering light flickers around the new color
+            LightFlickers& fl = pLightComponent_->flickers;
+            const index flIdx = fl.sparseIdxs.GetIdx(id);
+
+            if (flIdx != -1)
+                fl.baseDiffuse[flIdx] = value;
+
             break;
         }
         case LightProp::SPECULAR:
         {
-            light.specular = value;
+            lights.specular[idx] = value;
             break;
         }
         case LightProp::POSITION:
@@ -529,7 +1232,7 @@ bool LightSystem::SetPointLightProp(
         }
         case LightProp::ATTENUATION:
         {
-            light.att = { value.x, value.y, value.z };
+            lights.att[idx] = { value.x, value.y, value.z };
             break;
         }
         default:
@@ -539,6 +1242,10 @@ bool LightSystem::SetPointLightProp(
         }
     }
 
+    // (a changed position is tracked by the Transform component)
+    if (prop != LightProp::POSITION)
+        MarkPointLightChanged(idx);
+
     // we successfully updated some property of the light entity
     return true;
 }
@@ -551,7 +1258,7 @@ bool LightSystem::SetPointLightProp(
     const float value)
 {
     PointLights& lights = GetPointLights();
-    const index idx = GetIdxByID(lights.ids, id);
+    const index idx = lights.sparseIdxs.GetIdx(id);
 
     // if there is no entity by such ID we cannot update any data so return false
     if (idx == -1)
@@ -560,14 +1267,12 @@ bool LightSystem::SetPointLightProp(
         return false;
     }
 
-    PointLight& light = lights.data[idx];
-        
     // maybe there will be more props of float type so...
     switch (prop)
     {
         case LightProp::RANGE:
         {
-            light.range = value;
+            lights.range[idx] = value;
             break;
         }
         default:
@@ -577,6 +1282,8 @@ bool LightSystem::SetPointLightProp(
         }
     }
 
+    MarkPointLightChanged(idx);
+
     // we successfully updated some property of the light entity
     return true;
 }
@@ -591,7 +1298,7 @@ bool LightSystem::GetSpotLightData(const EntityID id, ECS::SpotLight& outSpotlig
     // return: true - if there is such an entity by ID; false - in another case;
 
     SpotLights& lights = GetSpotLights();
-    const index idx    = GetIdxByID(lights.ids, id);
+    const index idx    = lights.sparseIdxs.GetIdx(id);
 
     // if we didn't find any entt by input ID
     if (idx == -1)
@@ -600,7 +1307,7 @@ bool LightSystem::GetSpotLightData(const EntityID id, ECS::SpotLight& outSpotlig
         return false;
     }
 
-    outSpotlight = lights.data[idx];
+    GetSpotLightByIdx(lights, idx, outSpotlight);
     return true;
 }
 
@@ -611,7 +1318,7 @@ XMFLOAT4 LightSystem::GetSpotLightProp(const EntityID id, const LightProp prop)
     // get a property of the spotlight entity by ID
 
     SpotLights& lights = GetSpotLights();
-    const index idx    = GetIdxByID(lights.ids, id);
+    const index idx    = lights.sparseIdxs.GetIdx(id);
 
     if (idx == -1)
     {
@@ -620,21 +1327,19 @@ XMFLOAT4 LightSystem::GetSpotLightProp(const EntityID id, const LightProp prop)
         return GetLightPropInvalidData();
     }
 
-    SpotLight& light = lights.data[idx];
-
     switch (prop)
     {
         case AMBIENT:
         {
-            return light.ambient;
+            return lights.ambient[idx];
         }
         case DIFFUSE:
         {
-            return light.diffuse;
+            return lights.diffuse[idx];
         }
         case SPECULAR:
         {
-            return light.specular;
+            return lights.specular[idx];
         }
         case POSITION:
         {
@@ -651,18 +1356,18 @@ XMFLOAT4 LightSystem::GetSpotLightProp(const EntityID id, const LightProp prop)
         case RANGE:
         {
             // return the range value in each component of XMFLOAT4
-            const float r = light.range;
+            const float r = lights.range[idx];
             return { r, r, r, r };
         }
         case ATTENUATION:
         {
-            const XMFLOAT3& att = light.att;
+            const XMFLOAT3& att = lights.att[idx];
             return { att.x, att.y, att.z, 0.0f };
         }
         case SPOT_EXP:  
         {
             // spot exponent : light intensity fallof(for control the spotlight cone)
-            const float exp = light.spot;
+            const float exp = lights.spot[idx];
             return { exp, exp, exp, exp };
         }
         default:
@@ -681,7 +1386,7 @@ bool LightSystem::SetSpotLightProp(
     const XMFLOAT4& val)
 {
     SpotLights& lights = GetSpotLights();
-    const index idx    = GetIdxByID(lights.ids, id);
+    const index idx    = lights.sparseIdxs.GetIdx(id);
 
     // if there is no entity by such ID we cannot update any data so return false
     if (idx == -1)
@@ -690,23 +1395,21 @@ bool LightSystem::SetSpotLightProp(
         return false;
     }
 
-    SpotLight& light = lights.data[idx];
-
     switch (prop)
     {
         case LightProp::AMBIENT:
         {
-            light.ambient = val;
+            lights.ambient[idx] = val;
             break;
         }
         case LightProp::DIFFUSE:
         {
-            light.diffuse = val;
+            lights.diffuse[idx] = val;
             break;
         }
         case LightProp::SPECULAR:
         {
-            light.specular = val;
+            lights.specular[idx] = val;
             break;
         }
         case LightProp::POSITION:
@@ -723,7 +1426,7 @@ bool LightSystem::SetSpotLightProp(
         }
         case LightProp::ATTENUATION:
         {
-            light.att = { val.x, val.y, val.z };
+            lights.att[idx] = { val.x, val.y, val.z };
             break;
         }
         default:
@@ -745,7 +1448,7 @@ bool LightSystem::SetSpotLightProp(
     const float value)
 {
     SpotLights& lights = GetSpotLights();
-    const index idx = GetIdxByID(lights.ids, id);
+    const index idx = lights.sparseIdxs.GetIdx(id);
     
     // if there is no entity by such ID we cannot update any data so return false
     if (idx == -1)
@@ -754,18 +1457,16 @@ bool LightSystem::SetSpotLightProp(
         return false;
     }
 
-    SpotLight& light = lights.data[idx];
-
     switch (prop)
     {
         case LightProp::RANGE:
         {
-            light.range = value;
+            lights.range[idx] = value;
             break;
         }
         case LightProp::SPOT_EXP:
         {
-            light.spot = value;
+            lights.spot[idx] = value;
             break;
         }
         default:
@@ -788,47 +1489,210 @@ void LightSystem::Update(
     const float deltaTime,
     const float totalGameTime)
 {
-    //if (GetNumDirLights() > 0)
-    //	UpdateDirLights(deltaTime, totalGameTime);
+    // apply all the light animations by batched passes
+
+    const Light& comp = *pLightComponent_;
+
+    if (!comp.flickers.ids.empty())
+        UpdateFlickers(totalGameTime);
+
+    if (!comp.orbits.ids.empty())
+        UpdateOrbits(totalGameTime);
 
-    //if (GetNumPointLights() > 0)
-        //UpdatePointLights(deltaTime, totalGameTime);
+    if (!comp.follows.ids.empty())
+        UpdateFollows();
+
+    totalGameTime_ = totalGameTime;
 }
 
 ///////////////////////////////////////////////////////////
 
-void LightSystem::UpdateDirLights(
-    const float deltaTime,
-    const float totalGameTime)
+void LightSystem::ClearChangedPointLights()
+{
+    PointLights& lights = GetPointLights();
+
+    for (const index idx : lights.changedIdxs)
+    {
+        if (idx < (index)lights.flags.size())
+            lights.flags[idx] &= ~LIGHT_FLAG_DIRTY;
+    }
+
+    lights.changedIdxs.clear();
+}
+
+
+// =================================================================================
+// private methods: batched updates
+// =================================================================================
+static inline XMVECTOR Load4(const cvector<float>& arr, const index i)
+{
+    return DirectX::XMLoadFloat4((const XMFLOAT4*)(arr.data() + i));
+}
+
+static inline void Store4(cvector<float>& arr, const index i, const XMVECTOR v)
+{
+    DirectX::XMStoreFloat4((XMFLOAT4*)(arr.data() + i), v);
+}
+
+static inline XMVECTOR LoadTail(const cvector<float>& arr, const index i, const size num)
 {
-    // circle sun light over the land surface
+    // load up to 4 floats starting from i (the rest lanes are 0)
+    XMFLOAT4 v{ 0,0,0,0 };
+    float* dst = &v.x;
+
+    for (index k = 0; (k < 4) && (i + k < num); ++k)
+        dst[k] = arr[i + k];
 
-    DirLights& dirLights = GetDirLights();
+    return DirectX::XMLoadFloat4(&v);
+}
 
-    DirectX::XMFLOAT3 dir;
-    dir.x = 30.0f * cosf(0.2f * totalGameTime);
-    dir.y = -0.57735f;
-    dir.z = 30.0f * sinf(0.2f * totalGameTime);
+///////////////////////////////////////////////////////////
 
-    for (index idx = 0; idx < GetNumDirLights(); ++idx)
+void LightSystem::UpdateFlickers(const float totalGameTime)
+{
+    // compute intensities of all the flickering lights 4 at once:
+    //   angle = 2pi * freq * t + phase
+    //   noise = 0.5 + 0.5 * (0.6*sin(angle) + 0.4*sin(2.71*angle + phase))
+    //   k     = 1 - amplitude * noise
+
+    PointLights&         lights = GetPointLights();
+    const LightFlickers& fl     = pLightComponent_->flickers;
+    const size           num    = fl.ids.size();
+    const size           padded = (num + 3) & ~3;
+
+    s_Intensities.resize_uninitialized(padded);
+
+    const XMVECTOR t      = XMVectorReplicate(totalGameTime * XM_2PI);
+    const XMVECTOR half   = XMVectorReplicate(0.5f);
+    const XMVECTOR w0     = XMVectorReplicate(0.6f);
+    const XMVECTOR w1     = XMVectorReplicate(0.4f);
+    const XMVECTOR harm   = XMVectorReplicate(2.71f);
+    const XMVECTOR one    = XMVectorReplicate(1.0f);
+
+    for (index i = 0; i < padded; i += 4)
     {
-        SetDirLightProp(dirLights.ids[idx], ECS::LightProp::DIRECTION, dir);
+        const bool     full = (i + 4 <= num);
+        const XMVECTOR freq = (full) ? Load4(fl.frequency, i) : LoadTail(fl.frequency, i, num);
+        const XMVECTOR ph   = (full) ? Load4(fl.phase, i)     : LoadTail(fl.phase, i, num);
+        const XMVECTOR amp  = (full) ? Load4(fl.amplitude, i) : LoadTail(fl.amplitude, i, num);
+
+        // angle = freq * (2pi*t) + phase; angles are wrapped so sin() stays precise
+        const XMVECTOR angle = XMVectorModAngles(XMVectorMultiplyAdd(freq, t, ph));
+        const XMVECTOR a2    = XMVectorModAngles(XMVectorMultiplyAdd(angle, harm, ph));
+
+        const XMVECTOR s     = XMVectorMultiplyAdd(w0, XMVectorSin(angle), XMVectorMultiply(w1, XMVectorSin(a2)));
+        const XMVECTOR noise = XMVectorMultiplyAdd(half, s, half);
+
+        Store4(s_Intensities, i, XMVectorNegativeMultiplySubtract(amp, noise, one));
+    }
+
+    // scale the base colors and mark the lights for the renderer
+    lights.sparseIdxs.GetIdxs(fl.ids.data(), num, s_Idxs, -1);
+
+    for (index i = 0; i < num; ++i)
+    {
+        const index idx = s_Idxs[i];
+
+        if (idx == -1)
+            continue;
+
+        const XMFLOAT4& base = fl.baseDiffuse[i];
+        const float     k    = s_Intensities[i];
+
+        lights.diffuse[idx] = { base.x * k, base.y * k, base.z * k, base.w };
+        MarkPointLightChanged(idx);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void LightSystem::UpdateOrbits(const float totalGameTime)
+{
+    // move all the orbiting lights 4 at once (in the XZ-plane):
+    //   angle = phase + speed * t
+    //   pos   = center + radius * (cos(angle), 0, sin(angle))
+
+    const LightOrbits& orbits = pLightComponent_->orbits;
+    const size         num    = orbits.ids.size();
+
+    pTransformSys_->GetTransformsSoA(orbits.ids.data(), num, s_TransformSoA);
+    TransformSoA& soa = s_TransformSoA;
+
+    const XMVECTOR t = XMVectorReplicate(totalGameTime);
+
+    for (index i = 0; i < soa.GetPaddedSize(); i += TransformSoA::LANES)
+    {
+        const bool full = (i + 4 <= num);
+
+        const XMVECTOR speed  = (full) ? Load4(orbits.angularSpeed, i) : LoadTail(orbits.angularSpeed, i, num);
+        const XMVECTOR phase  = (full) ? Load4(orbits.phase, i)        : LoadTail(orbits.phase, i, num);
+        const XMVECTOR radius = (full) ? Load4(orbits.radius, i)       : LoadTail(orbits.radius, i, num);
+        const XMVECTOR cx     = (full) ? Load4(orbits.centerX, i)      : LoadTail(orbits.centerX, i, num);
+        const XMVECTOR cy     = (full) ? Load4(orbits.centerY, i)      : LoadTail(orbits.centerY, i, num);
+        const XMVECTOR cz     = (full) ? Load4(orbits.centerZ, i)      : LoadTail(orbits.centerZ, i, num);
+
+        XMVECTOR sinA, cosA;
+        XMVectorSinCos(&sinA, &cosA, XMVectorModAngles(XMVectorMultiplyAdd(speed, t, phase)));
+
+        Store4(soa.posX, i, XMVectorMultiplyAdd(radius, cosA, cx));
+        Store4(soa.posY, i, cy);
+        Store4(soa.posZ, i, XMVectorMultiplyAdd(radius, sinA, cz));
     }
+
+    pTransformSys_->SetTransformsSoA(soa);
+}
+
+///////////////////////////////////////////////////////////
+
+void LightSystem::UpdateFollows()
+{
+    // move all the following lights to their targets (+ offsets)
+
+    const LightFollows& follows = pLightComponent_->follows;
+    const size          num     = follows.ids.size();
+
+    pTransformSys_->GetPositions(follows.targetIds.data(), num, s_Positions);
+    pTransformSys_->GetTransformsSoA(follows.ids.data(), num, s_TransformSoA);
+
+    TransformSoA& soa = s_TransformSoA;
+
+    for (index i = 0; i < num; ++i)
+    {
+        soa.posX[i] = s_Positions[i].x + follows.offsets[i].x;
+        soa.posY[i] = s_Positions[i].y + follows.offsets[i].y;
+        soa.posZ[i] = s_Positions[i].z + follows.offsets[i].z;
+    }
+
+    pTransformSys_->SetTransformsSoA(soa);
+}
+
+///////////////////////////////////////////////////////////
+
+void LightSystem::MarkPointLightChanged(const index idx)
+{
+    // add the light into the list of changed ones only once
+
+    PointLights& lights = GetPointLights();
+
+    if (lights.flags[idx] & LIGHT_FLAG_DIRTY)
+        return;
+
+    lights.flags[idx] |= LIGHT_FLAG_DIRTY;
+    lights.changedIdxs.push_back(idx);
 }
 
 ///////////////////////////////////////////////////////////
 
-void LightSystem::UpdatePointLights(const float deltaTime, const float totalGameTime)
+void LightSystem::ResetChangedPointLights()
 {
-    // update point light props (position, color, etc.)
+    // is called when idxs are shifted: the whole buffer is uploaded anyway
 
-    PointLights& pointLights = GetPointLights();
+    PointLights& lights = GetPointLights();
 
-    float x = 30.0f * cosf(0.2f * totalGameTime);
-    float y = 3;
-    float z = 30.0f * sinf(0.2f * totalGameTime);
+    for (uint8& flag : lights.flags)
+        flag &= ~LIGHT_FLAG_DIRTY;
 
-    SetPointLightProp(pointLights.ids[0], LightProp::POSITION, {x, y, z, 1.0f});
+    lights.changedIdxs.clear();
 }
 
 ///////////////////////////////////////////////////////////
@@ -899,14 +1763,14 @@ bool LightSystem::GetPointLightsPositionAndRange(
     pTransformSys_->GetPositions(ids, numEntts, outPositions);
 
     // get range of each point light by ID
-    const cvector<PointLight>& lights = GetPointLights().data;
+    const cvector<float>& ranges = GetPointLights().range;
     cvector<index> idxs;
-    pLightComponent_->ids.get_idxs(ids, numEntts, idxs);
+    GetPointLights().sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
 
     outRanges.resize(numEntts);
 
     for (int i = 0; const index idx : idxs)
-        outRanges[i++] = lights[idx].range;
+        outRanges[i++] = ranges[idx];
 
     return true;
 }
@@ -915,7 +1779,7 @@ bool LightSystem::GetPointLightsPositionAndRange(
 
 void* LightSystem::operator new(size_t i)
 {
-    if (void* ptr = _aligned_malloc(i, 16))
+    if (void* ptr = MemTracker::Allocate(i, 16, MEM_TAG_ECS))
     {
         return ptr;
     }
@@ -926,7 +1790,7 @@ void* LightSystem::operator new(size_t i)
 
 void LightSystem::operator delete(void* p)
 {
-    _aligned_free(p);
+    MemTracker::Free(p);
 }
 
 
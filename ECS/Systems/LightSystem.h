@@ -8,6 +8,7 @@
 
 #include "../Components/Light.h"
 #include "../Systems/TransformSystem.h"
+#include "../Common/WorldFile.h"
 
 namespace ECS 
 {
@@ -18,6 +19,9 @@ public:
     LightSystem(Light* pLightComponent, TransformSystem* pTransformSys);
     ~LightSystem();
 
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
     // restrict a copying of this class instance 
     LightSystem(const LightSystem& obj) = delete;
     LightSystem& operator=(const LightSystem& obj) = delete;
@@ -29,15 +33,50 @@ public:
     void AddDirLights  (const EntityID* ids, const size numEntts, DirLightsInitParams& params);
     void AddPointLights(const EntityID* ids, const size numEntts, PointLightsInitParams& params);
     void AddSpotLights (const EntityID* ids, const size numEntts, SpotLightsInitParams& params);
+
+    void RemoveRecords (const EntityID* ids, const size numEntts);
         
     //
     // Public update API
     //
     void Update           (const float deltaTime, const float totalGameTime);
-    void UpdateDirLights  (const float deltaTime, const float totalGameTime);
-    void UpdatePointLights(const float deltaTime, const float totalGameTime);
     void UpdateFlashlight (const EntityID id, const XMFLOAT3& pos, const XMFLOAT3& dir);
 
+    // components accessed during the update (is used by the update scheduler)
+    static constexpr ComponentBitfield UPDATE_READS  = GetComponentBit(TransformComponent);
+    static constexpr ComponentBitfield UPDATE_WRITES = GetComponentBit(LightComponent) | GetComponentBit(TransformComponent);
+
+    //
+    // Public animation API: animations are applied to all the lights at once by
+    // vectorized passes of Update() (instead of per-entity Set*Prop() calls);
+    // NOTE: input ids must be SORTED; an animation replaces the prev one of the same type
+    //
+    void AddFlickers(
+        const EntityID* ids,
+        const size numEntts,
+        const float* amplitudes,
+        const float* frequencies);
+
+    void AddOrbits(
+        const EntityID* ids,
+        const size numEntts,
+        const XMFLOAT3* centers,
+        const float* radiuses,
+        const float* angularSpeeds);
+
+    void AddFollows(
+        const EntityID* ids,
+        const size numEntts,
+        const EntityID* targetIds,
+        const XMFLOAT3* offsets);
+
+    void RemoveAnimations(const EntityID* ids, const size numEntts);
+
+    // mark input point/spot lights as static (they never move/change so their
+    // lighting can be baked and the renderer may skip them); animated lights
+    // can't be static, and a new animation of a light resets its static state
+    void SetStatic(const EntityID* ids, const size numEntts, const bool isStatic);
+
     // get/set light active state
     bool SetLightIsActive(const EntityID id, const bool state);
     bool IsLightActive   (const EntityID id);
@@ -58,6 +97,9 @@ public:
     bool SetSpotLightProp     (const EntityID id, const LightProp prop, const XMFLOAT4& val);
     bool SetSpotLightProp     (const EntityID id, const LightProp prop, const float val);
 
+    // is called by the renderer when it has patched its copy of point lights
+    void ClearChangedPointLights();
+
 
     //
     // Public query API 
@@ -66,7 +108,7 @@ public:
     {
         // return valid idx if there is an entity by such ID;
         // or return -1 if there is no such entity;
-        return pLightComponent_->ids.get_idx(id);
+        return pLightComponent_->sparseIdxs.GetIdx(id);
     }
 
     inline index GetIdxByID(const cvector<EntityID>& ids, const EntityID id) const
@@ -77,16 +119,19 @@ public:
         return (ids[idx] == id) ? idx : -1;
     }
 
-    inline bool IsLightSource(const EntityID id)        const { return pLightComponent_->ids.binary_search(id); }
-    inline bool IsDirLight   (const EntityID id)        const { return pLightComponent_->dirLights.ids.binary_search(id); }
-    inline bool IsPointLight (const EntityID id)        const { return pLightComponent_->pointLights.ids.binary_search(id); }
-    inline bool IsSpotLight  (const EntityID id)        const { return pLightComponent_->spotLights.ids.binary_search(id); }
+    inline bool IsLightSource(const EntityID id)        const { return pLightComponent_->sparseIdxs.Has(id); }
+    inline bool IsDirLight   (const EntityID id)        const { return pLightComponent_->dirLights.sparseIdxs.Has(id); }
+    inline bool IsPointLight (const EntityID id)        const { return pLightComponent_->pointLights.sparseIdxs.Has(id); }
+    inline bool IsSpotLight  (const EntityID id)        const { return pLightComponent_->spotLights.sparseIdxs.Has(id); }
 
     inline DirLights&   GetDirLights()                  const { return pLightComponent_->dirLights; }
     inline PointLights& GetPointLights()                const { return pLightComponent_->pointLights; }
     inline SpotLights&  GetSpotLights()                 const { return pLightComponent_->spotLights; }
     inline LightType    GetLightType(const EntityID id) const { return pLightComponent_->types[GetIdxByID(id)]; }
 
+    inline bool                     IsStatic(const EntityID id) const { return pLightComponent_->staticIds.binary_search(id); }
+    inline const cvector<EntityID>& GetStaticLights()           const { return pLightComponent_->staticIds; }
+
     // get data for multiple entities
     void GetPointLightsData(
         const EntityID* ids,
@@ -121,8 +166,22 @@ public:
     void operator delete(void* p);
 
 private:
-    Light*           pLightComponent_ = nullptr;
-    TransformSystem* pTransformSys_ = nullptr;
+    void UpdateFlickers(const float totalGameTime);
+    void UpdateOrbits  (const float totalGameTime);
+    void UpdateFollows ();
+
+    void MarkPointLightChanged(const index idx);
+    void ResetChangedPointLights();
+
+private:
+    Light*            pLightComponent_ = nullptr;
+    TransformSystem*  pTransformSys_ = nullptr;
+    float             totalGameTime_ = 0.0f;     // of the last update (orbits start from the current angle)
+
+    cvector<index>    s_Idxs;                    // static arr of light idxs for the batched updates
+    cvector<float>    s_Intensities;             // static arr of flicker intensities (padded to 4)
+    cvector<XMFLOAT3> s_Positions;               // static arr of positions of followed entts
+    TransformSoA      s_TransformSoA;            // static transform data of animated lights
 };
 
 }; // namespace ECS
@@ -24,27 +24,77 @@ MaterialSystem::MaterialSystem(
     CAssert::True(pNameSys != nullptr,           "input ptr to the Name system == nullptr");
 
     // setup default (invalid) material which has ID == 0 for invalid entity
-    const cvector<MaterialID> materialsIDs(1, INVALID_MATERIAL_ID);
-    const bool                isMeshBasedMaterials = true;
-    MaterialData              matData(materialsIDs.data(), materialsIDs.size());
+    const MaterialID invalidMaterialID    = INVALID_MATERIAL_ID;
+    const bool       isMeshBasedMaterials = true;
 
     pMaterialComponent->enttsIDs.push_back(INVALID_ENTITY_ID);
-    pMaterialComponent->data.push_back(std::move(matData));
+    pMaterialComponent->materials.PushBack(&invalidMaterialID, 1);
     pMaterialComponent->flagsMeshBasedMaterials.push_back(isMeshBasedMaterials);
+    pMaterialComponent->sparseIdxs.Set(INVALID_ENTITY_ID, 0);
 }
 
 ///////////////////////////////////////////////////////////
 
-void MaterialSystem::Serialize(std::ofstream& fout, u32& offset)
+void MaterialSystem::Serialize(WorldFileWriter& writer)
 {
-    CAssert::True(false, "TODO: implement it!");
+    // materials of all the entts are stored as a single flat array + number of materials per entt
+    // (the pool is already flat and it follows the order of entts)
+
+    const Material& comp = *pMaterialComponent_;
+    const size numEntts  = comp.enttsIDs.size();
+
+    cvector<uint32> numMaterials(numEntts);
+
+    for (index i = 0; i < numEntts; ++i)
+        numMaterials[i] = comp.materials.GetCount(i);
+
+    writer.BeginChunk(MaterialComponent);
+    writer.WriteArray(comp.enttsIDs);
+    writer.WriteArray(comp.flagsMeshBasedMaterials);
+    writer.WriteArray(numMaterials);
+    writer.WriteArray(comp.materials.GetPool());
+    writer.EndChunk();
 }
 
 ///////////////////////////////////////////////////////////
 
-void MaterialSystem::Deserialize(std::ifstream& fin, const u32 offset)
+bool MaterialSystem::Deserialize(WorldFileReader& reader)
 {
-    CAssert::True(false, "TODO: implement it!");
+    Material& comp = *pMaterialComponent_;
+
+    if (!reader.BeginChunk(MaterialComponent))
+    {
+        LogErr("there is no materials data in the world file");
+        return false;
+    }
+
+    cvector<uint32> numMaterials;
+    const MaterialID* materialsIDs = nullptr;
+
+    bool result = true;
+    result &= reader.ReadArray(comp.enttsIDs);
+    result &= reader.ReadArray(comp.flagsMeshBasedMaterials);
+    result &= reader.ReadArray(numMaterials);
+    result &= reader.ReadArray(materialsIDs, -1);
+
+    const size numEntts = comp.enttsIDs.size();
+
+    result &= (numEntts > 0) && (comp.enttsIDs[0] == INVALID_ENTITY_ID);
+    result &= (comp.flagsMeshBasedMaterials.size() == numEntts);
+    result &= (numMaterials.size()                 == numEntts);
+
+    if (!result)
+    {
+        LogErr("materials data in the world file is corrupted");
+        return false;
+    }
+
+    comp.materials.Assign(numMaterials.data(), numEntts, materialsIDs);
+
+    comp.sparseIdxs.Clear();
+    comp.sparseIdxs.Rebuild(comp.enttsIDs);
+
+    return true;
 }
 
 ///////////////////////////////////////////////////////////
@@ -69,7 +119,7 @@ void MaterialSystem::AddRecord(
     Material& comp = *pMaterialComponent_;
 
     // if there is already a record with such entt ID
-    if (comp.enttsIDs.binary_search(enttID))
+    if (comp.sparseIdxs.Has(enttID))
     {
         char buf[64];
         sprintf(buf, "can't add record: there is already an entity by ID: %ud", enttID);
@@ -81,8 +131,64 @@ void MaterialSystem::AddRecord(
     const index idx = comp.enttsIDs.get_insert_idx(enttID);
 
     comp.enttsIDs.insert_before(idx, enttID);
-    comp.data.insert_before(idx, MaterialData(materialsIDs, numSubmeshes));
+    comp.materials.InsertByIdxs(cvector<index>(1, idx), materialsIDs, (uint32)numSubmeshes);
     comp.flagsMeshBasedMaterials.insert_before(idx, areMaterialsMeshBased);
+
+    comp.sparseIdxs.Rebuild(comp.enttsIDs, idx);
+}
+
+///////////////////////////////////////////////////////////
+
+void MaterialSystem::AddRecords(
+    const EntityID* ids,
+    const size numEntts,
+    const MaterialID* materialsIDs,
+    const size numSubmeshes,
+    const bool areMaterialsMeshBased)
+{
+    // add the same materials set to each input entity with a single merge pass
+    // over the data arrays (for instance: instances of the same prefab)
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+    CAssert::True(materialsIDs != nullptr,             "input ptr to materials IDs arr == nullptr");
+    CAssert::True(numSubmeshes > 0,                    "input number of submeshes must be > 0");
+
+    Material& comp = *pMaterialComponent_;
+
+    bool canAddComponent = !comp.sparseIdxs.HasAny(ids, numEntts);
+    CAssert::True(canAddComponent, "can't add component: there is already a record with some entity id");
+
+    cvector<index> idxs;
+    comp.enttsIDs.merge_sorted(ids, numEntts, idxs);
+    comp.materials.InsertByIdxs(idxs, materialsIDs, (uint32)numSubmeshes);
+    comp.flagsMeshBasedMaterials.insert_by_idxs(idxs, areMaterialsMeshBased);
+
+    comp.sparseIdxs.Rebuild(comp.enttsIDs, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+void MaterialSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Material& comp = *pMaterialComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    comp.enttsIDs.erase_by_idxs(idxs);
+    comp.materials.EraseByIdxs(idxs);
+    comp.flagsMeshBasedMaterials.erase_by_idxs(idxs);
+
+    comp.sparseIdxs.Remove(ids, numEntts);
+    comp.sparseIdxs.Rebuild(comp.enttsIDs, idxs[0]);
 }
 
 ///////////////////////////////////////////////////////////
@@ -95,12 +201,12 @@ void MaterialSystem::SetMaterial(
     // set a material (matID) for subset/mesh (enttSubmeshID) of entity (enttID)
 
     Material& comp = *pMaterialComponent_;
-    const index idx      = comp.enttsIDs.get_idx(enttID);
-    const bool exist     = (comp.enttsIDs[idx] == enttID);
+    const index idx      = comp.sparseIdxs.GetIdx(enttID);
+    const bool exist     = (idx != SparseSet::INVALID_IDX);
 
     if (exist)
     {
-        comp.data[idx].materialsIDs[0] = matID;
+        comp.materials.Get(idx)[0] = matID;
         comp.flagsMeshBasedMaterials[idx] = false;
     }
     else
@@ -113,16 +219,16 @@ void MaterialSystem::SetMaterial(
 
 ///////////////////////////////////////////////////////////
 
-const MaterialData& MaterialSystem::GetDataByEnttID(const EntityID id) const
+MaterialData MaterialSystem::GetDataByEnttID(const EntityID id) const
 {
     // get data (arr of material IDs) for entity by input ID
 
     const Material& comp = *pMaterialComponent_;
-    const index idx = comp.enttsIDs.get_idx(id);
-    const bool exist = (comp.enttsIDs[idx] == id);
+    const index idx = comp.sparseIdxs.GetIdx(id);
+    const bool exist = (idx != SparseSet::INVALID_IDX);
 
     // if there no data by input ID we return "invalid" data (by idx == 0)
-    return comp.data[idx * exist];
+    return { comp.materials.GetSpan(idx * exist) };
 }
 
 ///////////////////////////////////////////////////////////
@@ -141,7 +247,7 @@ void MaterialSystem::GetDataByEnttsIDs(
     const Material& comp = *pMaterialComponent_;
     cvector<index> idxs;
 
-    comp.enttsIDs.get_idxs(ids, numEntts, idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
 
 #if DEBUG || _DEBUG
     CheckEnttsHaveMaterialComponent(ids, idxs.data(), numEntts);
@@ -150,7 +256,7 @@ void MaterialSystem::GetDataByEnttsIDs(
     outMaterialsDataPerEntt.resize(numEntts);
 
     for (int i = 0; const index idx : idxs)
-        outMaterialsDataPerEntt[i++] = comp.data[idx];
+        outMaterialsDataPerEntt[i++] = { comp.materials.GetSpan(idx) };
 }
 
 ///////////////////////////////////////////////////////////
@@ -170,7 +276,7 @@ void MaterialSystem::GetMaterialsFlagsByEntts(
     Material& comp = *pMaterialComponent_;
     cvector<index> idxs;
 
-    comp.enttsIDs.get_idxs(ids, numEntts, idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
 
     // check if we have valid entities IDs
 #if DEBUG || _DEBUG
@@ -213,8 +319,8 @@ void MaterialSystem::CheckEnttsHaveMaterialComponent(
 const char* MaterialSystem::GenerateErrMsgNotHaveComponent(const EntityID id) const
 {
     // a helper to generate a message about the entity doesn't have this component
-    const std::string& name = pNameSystem_->GetNameById(id);
-    sprintf(g_String, "entity (ID: %ud; name: %s) doesn't have a material component!", id, name.c_str());
+    const char* name = pNameSystem_->GetNameById(id);
+    sprintf(g_String, "entity (ID: %ud; name: %s) doesn't have a material component!", id, name);
 
     return g_String;
 }
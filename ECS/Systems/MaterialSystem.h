@@ -9,6 +9,7 @@
 
 #include <Types.h>
 #include "../Components/Material.h"
+#include "../Common/WorldFile.h"
 #include "../Systems/NameSystem.h"
 #include <fstream>
 
@@ -21,8 +22,8 @@ public:
     MaterialSystem(Material* pMaterialComponent, NameSystem* pNameSys);
     ~MaterialSystem() {};
 
-    void Serialize(std::ofstream& fout, u32& offset);
-    void Deserialize(std::ifstream& fin, const u32 offset);
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
 
     void AddRecord(
         const EntityID enttID,
@@ -30,13 +31,24 @@ public:
         const size numSubmeshes,
         const bool areMaterialsMeshBased);
 
+    // add the same set of materials to each input entt (ids are SORTED)
+    void AddRecords(
+        const EntityID* ids,
+        const size numEntts,
+        const MaterialID* materialsIDs,
+        const size numSubmeshes,
+        const bool areMaterialsMeshBased);
+
+    void RemoveRecords(const EntityID* ids, const size numEntts);
+
     void SetMaterial(
         const EntityID enttID,
         const SubmeshID enttSubmeshID,
         const MaterialID matID);
 
 
-    const MaterialData& GetDataByEnttID(const EntityID enttID) const;
+    // NOTE: materials data is a view of the component (see MaterialData)
+    MaterialData GetDataByEnttID(const EntityID enttID) const;
 
     void GetDataByEnttsIDs(
         const EntityID* ids,
@@ -14,14 +14,44 @@ ModelSystem::ModelSystem(Model* pModelComponent) : pModelComponent_(pModelCompon
 
 ///////////////////////////////////////////////////////////
 
-void ModelSystem::Serialize(std::ofstream& fout, u32& offset)
+void ModelSystem::Serialize(WorldFileWriter& writer)
 {
+    const Model& comp = *pModelComponent_;
+
+    writer.BeginChunk(ModelComponent);
+    writer.WriteArray(comp.enttsIDs_);
+    writer.WriteArray(comp.modelIDs_);
+    writer.EndChunk();
 }
 
 ///////////////////////////////////////////////////////////
 
-void ModelSystem::Deserialize(std::ifstream& fin, const u32 offset)
+bool ModelSystem::Deserialize(WorldFileReader& reader)
 {
+    Model& comp = *pModelComponent_;
+
+    if (!reader.BeginChunk(ModelComponent))
+    {
+        LogErr("there is no model data in the world file");
+        return false;
+    }
+
+    bool result = true;
+    result &= reader.ReadArray(comp.enttsIDs_);
+    result &= reader.ReadArray(comp.modelIDs_);
+    result &= (comp.modelIDs_.size() == comp.enttsIDs_.size());
+
+    if (!result)
+    {
+        LogErr("model data in the world file is corrupted");
+        return false;
+    }
+
+    comp.sparseIdxs_.Clear();
+    comp.sparseIdxs_.Rebuild(comp.enttsIDs_);
+    RebuildGroups();
+
+    return true;
 }
 
 ///////////////////////////////////////////////////////////
@@ -38,25 +68,38 @@ void ModelSystem::AddRecords(
 
     Model& comp = *pModelComponent_;
     cvector<index> idxs;
-    const vsize newCapacity = comp.enttsIDs_.size() + numEntts;
-
-    comp.enttsIDs_.get_insert_idxs(enttsIDs, numEntts, idxs);
-    comp.enttsIDs_.reserve(newCapacity);
 
-    // sort insert of entities IDs (primary keys)
-    for (index i = 0; i < numEntts; ++i)
-        comp.enttsIDs_.insert_before(idxs[i] + i, enttsIDs[i]);
+    // sort insert of entities IDs (primary keys) and model IDs
+    comp.enttsIDs_.merge_sorted(enttsIDs, numEntts, idxs);
+    comp.modelIDs_.insert_by_idxs(idxs, modelID);
+    comp.groups_.insert_by_idxs(idxs, GetGroup(modelID));
 
-    // insert of model ID
-    for (index i = 0; i < numEntts; ++i)
-        comp.modelIDs_.insert_before(idxs[i] + i, modelID);
+    comp.sparseIdxs_.Rebuild(comp.enttsIDs_, idxs[0]);
 }
 
 ///////////////////////////////////////////////////////////
 
 void ModelSystem::RemoveRecords(const EntityID* ids, const size numEntts)
 {
-    CAssert::True(false, "TODO: IMPLEMENT IT!");
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Model& comp = *pModelComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs_.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    comp.enttsIDs_.erase_by_idxs(idxs);
+    comp.modelIDs_.erase_by_idxs(idxs);
+    comp.groups_.erase_by_idxs(idxs);
+
+    comp.sparseIdxs_.Remove(ids, numEntts);
+    comp.sparseIdxs_.Rebuild(comp.enttsIDs_, idxs[0]);
 }
 
 ///////////////////////////////////////////////////////////
@@ -67,12 +110,11 @@ ModelID ModelSystem::GetModelIdRelatedToEntt(const EntityID enttID)
 
     Model& comp = *pModelComponent_;
 
-    // 1. check if we have such entity ID;
-    // 2. get idx by value (or get 0 if there is no such)
-    const bool has = comp.enttsIDs_.binary_search(enttID);
-    const index idx = comp.enttsIDs_.get_idx(enttID) * has;
+    // get idx by value (or get 0 if there is no such)
+    const index idx = comp.sparseIdxs_.GetIdx(enttID);
+    const bool has  = (idx != SparseSet::INVALID_IDX);
 
-    return comp.modelIDs_[idx];
+    return comp.modelIDs_[idx * has];
 }
 
 ///////////////////////////////////////////////////////////
@@ -93,41 +135,45 @@ void ModelSystem::GetModelsIdsRelatedToEntts(
     CAssert::True(enttsIDs != nullptr, "input ptr to entities IDs arr == nullptr");
     CAssert::True(numEntts > 0,        "input number of entities must be > 0");
 
-    cvector<index> idxs;
-    const Model& comp = *pModelComponent_;
-    std::map<ModelID, cvector<EntityID>> modelToEntts;
+    // the group of each entt is precomputed (see GetGroup) so here we only
+    // distribute input entts by groups with a counting pass: models go in
+    // ascending order and the order of input entts is kept within each model
 
-    comp.enttsIDs_.get_idxs(enttsIDs, numEntts, idxs);
+    const Model& comp     = *pModelComponent_;
+    const size  numGroups = comp.groupModels_.size();
 
-    // get related models IDs and use them as keys
-    // and group entities by these models IDs
-    for (int i = 0; i < numEntts; ++i)
-    {
-        const ModelID modelID = comp.modelIDs_[idxs[i]];
-        const EntityID enttID = comp.enttsIDs_[idxs[i]];
-        modelToEntts[modelID].push_back(enttID);
-    }
+    comp.sparseIdxs_.GetIdxs(enttsIDs, numEntts, s_Idxs, 0);
 
-    // prepare memory
-    const size numModels = std::ssize(modelToEntts);
+    s_NumPerGroup.resize(numGroups);
+    std::fill(s_NumPerGroup.begin(), s_NumPerGroup.end(), 0);
 
-    outModelsIDs.resize(numModels);
-    outNumInstancesPerModel.resize(numModels);
-    outEnttsSortByModels.resize(numEntts);
+    for (index i = 0; i < numEntts; ++i)
+        ++s_NumPerGroup[comp.groups_[s_Idxs[i]]];
+
+    // get models of non-empty groups and a write position for each group
+    outModelsIDs.clear();
+    outNumInstancesPerModel.clear();
+    s_Offsets.resize(numGroups);
 
-    // get models IDs
-    for (int i = 0; const auto & it : modelToEntts)
-        outModelsIDs[i++] = it.first;
+    for (index group = 0, offset = 0; group < numGroups; ++group)
+    {
+        s_Offsets[group] = offset;
+        offset += s_NumPerGroup[group];
+
+        if (s_NumPerGroup[group] == 0)
+            continue;
+
+        outModelsIDs.push_back(comp.groupModels_[group]);
+        outNumInstancesPerModel.push_back(s_NumPerGroup[group]);
+    }
 
-    // compute the num of instances per each model
-    for (int i = 0; const auto & it : modelToEntts)
-        outNumInstancesPerModel[i++] = std::ssize(it.second);
+    // sort entts by models
+    outEnttsSortByModels.resize(numEntts);
 
-    // sort entts by models: copy sorted entts IDs by model into output array
-    for (index i = 0, offset = 0; const auto & it : modelToEntts)
+    for (index i = 0; i < numEntts; ++i)
     {
-        std::copy(it.second.begin(), it.second.end(), outEnttsSortByModels.begin() + offset);
-        offset += outNumInstancesPerModel[i++];
+        const index idx = s_Idxs[i];
+        outEnttsSortByModels[s_Offsets[comp.groups_[idx]]++] = comp.enttsIDs_[idx];
     }
 }
 
@@ -141,5 +187,63 @@ void ModelSystem::GetAllEntts(const EntityID*& ids, size& numEntts)
     numEntts = comp.enttsIDs_.size();
 }
 
+///////////////////////////////////////////////////////////
+
+void ModelSystem::GetEnttsByModel(const ModelID modelID, cvector<EntityID>& outIds) const
+{
+    // entts IDs are sorted so the output is sorted as well
+    const Model& comp = *pModelComponent_;
+    outIds.clear();
+
+    for (index i = 0; i < comp.modelIDs_.size(); ++i)
+    {
+        if (comp.modelIDs_[i] == modelID)
+            outIds.push_back(comp.enttsIDs_[i]);
+    }
+}
+
+
+// =================================================================================
+// PRIVATE METHODS
+// =================================================================================
+uint32 ModelSystem::GetGroup(const ModelID modelID)
+{
+    // return the group of the model (a new one is added if there is no such);
+    // groups are sorted by models so groups after a new one are shifted
+
+    Model& comp = *pModelComponent_;
+    const index idx = comp.groupModels_.get_insert_idx(modelID);
+
+    if ((idx > 0) && (comp.groupModels_[idx - 1] == modelID))
+        return (uint32)(idx - 1);
+
+    comp.groupModels_.insert_before(idx, modelID);
+
+    for (uint32& group : comp.groups_)
+        group += (group >= (uint32)idx);
+
+    return (uint32)idx;
+}
+
+///////////////////////////////////////////////////////////
+
+void ModelSystem::RebuildGroups()
+{
+    // make a group per each unique model and get the group of each entt
+
+    Model& comp = *pModelComponent_;
+
+    comp.groupModels_ = comp.modelIDs_;
+    std::sort(comp.groupModels_.begin(), comp.groupModels_.end());
+
+    const ModelID* last = std::unique(comp.groupModels_.begin(), comp.groupModels_.end());
+    comp.groupModels_.resize(last - comp.groupModels_.begin());
+
+    comp.groups_.resize(comp.modelIDs_.size());
+
+    for (index i = 0; i < comp.modelIDs_.size(); ++i)
+        comp.groups_[i] = (uint32)comp.groupModels_.get_idx(comp.modelIDs_[i]);
+}
+
 
 } // namespace ECS
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "../Components/Model.h"
+#include "../Common/WorldFile.h"
 #include <fstream>
 
 
@@ -20,8 +21,8 @@ public:
     ModelSystem(Model* pModelComponent);
     ~ModelSystem() {}
 
-    void Serialize(std::ofstream& fout, u32& offset);
-    void Deserialize(std::ifstream& fin, const u32 offset);
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
 
     void AddRecords(
         const EntityID* enttsIDs,
@@ -41,8 +42,20 @@ public:
 
     void GetAllEntts(const EntityID*& ids, size& numEntts);
 
+    // get SORTED IDs of all the entts which are related to the model
+    void GetEnttsByModel(const ModelID modelID, cvector<EntityID>& outIds) const;
+
+private:
+    uint32 GetGroup(const ModelID modelID);
+    void   RebuildGroups();
+
 private:
     Model* pModelComponent_ = nullptr;
+
+    // transient buffers (are kept between calls so they aren't reallocated)
+    cvector<index> s_Idxs;
+    cvector<size>  s_NumPerGroup;
+    cvector<index> s_Offsets;
 };
 
 } // namespace ECS
@@ -6,6 +6,7 @@
 // ================================================================================
 #include "../Common/pch.h"
 #include "MoveSystem.h"
+#include <JobSystem.h>
 
 
 namespace ECS
@@ -25,20 +26,174 @@ MoveSystem::MoveSystem(Transform* pTransformComponent, Movement* pMoveComponent)
 // ================================================================================
 //                PUBLIC SERIALIZATION / DESERIALIZATION API
 // ================================================================================
-void MoveSystem::Serialize(std::ofstream& fout, u32& offset)
+void MoveSystem::Serialize(WorldFileWriter& writer)
 {
+    const Movement& comp = *pMoveComponent_;
+
+    writer.BeginChunk(MoveComponent);
+    writer.WriteArray(comp.ids_);
+    writer.WriteArray(comp.translationAndUniScales_);
+    writer.WriteArray(comp.rotationQuats_);
+    writer.EndChunk();
 }
 
 ///////////////////////////////////////////////////////////
 
-void MoveSystem::Deserialize(std::ifstream& fin, const u32 offset)
+bool MoveSystem::Deserialize(WorldFileReader& reader)
 {
+    Movement& comp = *pMoveComponent_;
+
+    if (!reader.BeginChunk(MoveComponent))
+    {
+        LogErr("there is no movement data in the world file");
+        return false;
+    }
+
+    bool result = true;
+    result &= reader.ReadArray(comp.ids_);
+    result &= reader.ReadArray(comp.translationAndUniScales_);
+    result &= reader.ReadArray(comp.rotationQuats_);
+
+    result &= (comp.translationAndUniScales_.size() == comp.ids_.size());
+    result &= (comp.rotationQuats_.size()           == comp.ids_.size());
+
+    if (!result)
+    {
+        LogErr("movement data in the world file is corrupted");
+        return false;
+    }
+
+    comp.sparseIdxs_.Clear();
+    comp.sparseIdxs_.Rebuild(comp.ids_);
+
+    return true;
 }
 
 
 // ================================================================================
 //                              PUBLIC UPDATING API
 // ================================================================================
+static inline XMVECTOR Load4(const cvector<float>& arr, const index i)
+{
+    return DirectX::XMLoadFloat4((const XMFLOAT4*)(arr.data() + i));
+}
+
+static inline void Store4(cvector<float>& arr, const index i, const XMVECTOR v)
+{
+    DirectX::XMStoreFloat4((XMFLOAT4*)(arr.data() + i), v);
+}
+
+///////////////////////////////////////////////////////////
+
+void MoveKernelSoA(
+    const Movement& movement,
+    const index* moveIdxs,          // idx of movement record per SoA element (nullptr: the same idx)
+    const size numMoves,            // the number of valid SoA elements
+    const float deltaTime,
+    const index startIdx,
+    const index endIdx,
+    TransformSoA& soa)
+{
+    // apply movement (is defined per second) to 4 entts per iteration:
+    //   pos   += translation * dt
+    //   scale *= scaleFactor ^ dt
+    //   dir    = normalize(rotation^dt * dir)
+    //
+    // NOTE: the SoA arrays are padded to the number of lanes but the movement
+    //       arrays aren't so the padding lanes get "no movement"
+
+    using namespace DirectX;
+
+    const XMVECTOR dt        = XMVectorReplicate(deltaTime);
+    const XMVECTOR zero      = XMVectorZero();
+    const XMVECTOR one       = XMVectorSplatOne();
+    const XMVECTOR epsilon   = XMVectorReplicate(1e-5f);
+    const XMVECTOR noMove    = XMVectorSet(0, 0, 0, 1);     // zero translation; scale factor == 1
+    const XMVECTOR noRotate  = XMQuaternionIdentity();
+
+    for (index i = startIdx; i < endIdx; i += TransformSoA::LANES)
+    {
+        // AoS => SoA: after transposition each row contains a component of 4 entts
+        XMMATRIX tr;
+        XMMATRIX rot;
+
+        for (index j = 0; j < TransformSoA::LANES; ++j)
+        {
+            const bool  isValid = (i + j < numMoves);
+            const index m       = (isValid && moveIdxs) ? moveIdxs[i + j] : i + j;
+
+            tr.r[j]  = (isValid) ? XMLoadFloat4(&movement.translationAndUniScales_[m]) : noMove;
+            rot.r[j] = (isValid) ? movement.rotationQuats_[m] : noRotate;
+        }
+
+        tr  = XMMatrixTranspose(tr);
+        rot = XMMatrixTranspose(rot);
+
+        // translate and scale
+        Store4(soa.posX,  i, XMVectorMultiplyAdd(tr.r[0], dt, Load4(soa.posX, i)));
+        Store4(soa.posY,  i, XMVectorMultiplyAdd(tr.r[1], dt, Load4(soa.posY, i)));
+        Store4(soa.posZ,  i, XMVectorMultiplyAdd(tr.r[2], dt, Load4(soa.posZ, i)));
+        Store4(soa.scale, i, XMVectorMultiply(Load4(soa.scale, i), XMVectorPow(tr.r[3], dt)));
+
+        // rotation of this frame: slerp(identity, q, dt) == (cos(dt*w), axis * sin(dt*w)) where cos(w) == q.w;
+        // q and -q is the same rotation so take the shortest arc (as XMQuaternionSlerp does)
+        const XMVECTOR sign     = XMVectorSelect(one, XMVectorNegate(one), XMVectorLess(rot.r[3], zero));
+        const XMVECTOR cosOmega = XMVectorMin(XMVectorAbs(rot.r[3]), one);
+        const XMVECTOR sinOmega = XMVectorSqrt(XMVectorMax(zero, XMVectorNegativeMultiplySubtract(cosOmega, cosOmega, one)));
+
+        XMVECTOR sinT, cosT;
+        XMVectorSinCos(&sinT, &cosT, XMVectorMultiply(XMVectorACos(cosOmega), dt));
+
+        // for tiny angles: sin(dt*w) / sin(w) == dt
+        const XMVECTOR k  = XMVectorMultiply(sign, XMVectorSelect(dt, XMVectorDivide(sinT, sinOmega), XMVectorGreater(sinOmega, epsilon)));
+        const XMVECTOR ax = XMVectorMultiply(rot.r[0], k);
+        const XMVECTOR ay = XMVectorMultiply(rot.r[1], k);
+        const XMVECTOR az = XMVectorMultiply(rot.r[2], k);
+        const XMVECTOR aw = cosT;
+
+        const XMVECTOR bx = Load4(soa.quatX, i);
+        const XMVECTOR by = Load4(soa.quatY, i);
+        const XMVECTOR bz = Load4(soa.quatZ, i);
+        const XMVECTOR bw = Load4(soa.quatW, i);
+
+        // quaternions product: dir is rotated by rot (the same as XMQuaternionMultiply(dir, rot))
+        XMVECTOR qx = XMVectorMultiply(aw, bx);
+        qx = XMVectorMultiplyAdd(ax, bw, qx);
+        qx = XMVectorMultiplyAdd(ay, bz, qx);
+        qx = XMVectorNegativeMultiplySubtract(az, by, qx);
+
+        XMVECTOR qy = XMVectorMultiply(aw, by);
+        qy = XMVectorNegativeMultiplySubtract(ax, bz, qy);
+        qy = XMVectorMultiplyAdd(ay, bw, qy);
+        qy = XMVectorMultiplyAdd(az, bx, qy);
+
+        XMVECTOR qz = XMVectorMultiply(aw, bz);
+        qz = XMVectorMultiplyAdd(ax, by, qz);
+        qz = XMVectorNegativeMultiplySubtract(ay, bx, qz);
+        qz = XMVectorMultiplyAdd(az, bw, qz);
+
+        XMVECTOR qw = XMVectorMultiply(aw, bw);
+        qw = XMVectorNegativeMultiplySubtract(ax, bx, qw);
+        qw = XMVectorNegativeMultiplySubtract(ay, by, qw);
+        qw = XMVectorNegativeMultiplySubtract(az, bz, qw);
+
+        // normalize
+        XMVECTOR lenSq = XMVectorMultiply(qx, qx);
+        lenSq = XMVectorMultiplyAdd(qy, qy, lenSq);
+        lenSq = XMVectorMultiplyAdd(qz, qz, lenSq);
+        lenSq = XMVectorMultiplyAdd(qw, qw, lenSq);
+
+        const XMVECTOR invLen = XMVectorDivide(one, XMVectorSqrt(lenSq));
+
+        Store4(soa.quatX, i, XMVectorMultiply(qx, invLen));
+        Store4(soa.quatY, i, XMVectorMultiply(qy, invLen));
+        Store4(soa.quatZ, i, XMVectorMultiply(qz, invLen));
+        Store4(soa.quatW, i, XMVectorMultiply(qw, invLen));
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 void MoveSystem::UpdateAllMoves(
     const float deltaTime,
     TransformSystem& transformSys)
@@ -51,83 +206,37 @@ void MoveSystem::UpdateAllMoves(
 
     try
     {
-#if 0
-        Transform& transform = *pTransformComponent_;
-        Movement& movement = *pMoveComponent_;
-
-        cvector<XMFLOAT3> positions;
-        cvector<XMVECTOR> dirQuats;
-        cvector<float> uniformScales;
-
-        cvector<XMMATRIX> worldMatricesToUpdate;
-        cvector<ptrdiff_t> transformDataIdxs;
-
-        // current transform data of entities as XMVECTORs
-        cvector<XMVECTOR> positionsVec;
-        cvector<XMVECTOR> scalesVec;
-
-        // current movement data (scaled according to the deltaTime)
-        cvector<XMVECTOR> translationsVec;
-        cvector<XMVECTOR> rotQuatsVec;        
-        cvector<float> uniformScaleFactors;
-
-        // get entities transform data to update for this frame
-        transformSys.GetTransformDataOfEntts(
-            enttsToMove,
-            transformDataIdxs,
-            positions, 
-            dirQuats, 
-            uniformScales);
-
-        PrepareTransformData(
-            positions,
-            positionsVec);
-
-        PrepareMovementData( 
-            deltaTime,
-            movement.translationAndUniScales_,  // (x: trans_x, y: trans_y, z: trans_z, w: uniform_scale)
-            movement.rotationQuats_,
-            translationsVec,
-            rotQuatsVec,
-            uniformScaleFactors);
-
-        // compute new values of transform data using the movement data
-        ComputeTransformData(
-            deltaTime,
-            translationsVec,
-            rotQuatsVec,
-            uniformScaleFactors,
-            positionsVec,
-            dirQuats, 
-            uniformScales);
-
-        // write updated transform data into the Transform component
-        transformSys.SetTransformDataByDataIdxs(
-            transformDataIdxs, 
-            positionsVec, 
-            dirQuats, 
-            uniformScales);
-
-        // ------------------------------------------------------
-
-        // get world matrices which will be updated according to new transform data;
-        transformSys.GetMatricesByIdxs(
-            transformDataIdxs,
-            transformSys.GetAllWorldMatrices(),
-            worldMatricesToUpdate);
-
-        // rebuild world matrices of that entities which were moved
-        ComputeWorldMatrices(
-            translationsVec, 
-            rotQuatsVec, 
-            uniformScaleFactors,
-            worldMatricesToUpdate);
-
-        // apply updated world matrices
-        transformSys.SetWorldMatricesByDataIdxs(
-            transformDataIdxs, 
-            worldMatricesToUpdate);
-#endif
+        const Movement& movement = *pMoveComponent_;
+        const EntityID* ids      = enttsToMove.data();
+        size numEntts            = enttsToMove.size();
+        const index* moveIdxs    = nullptr;
+        TransformSoA& soa        = s_TransformSoA;
+
+        // skip entts of dormant chunks
+        if (!dormant_.IsEmpty())
+        {
+            const cvector<index>& activeIdxs = dormant_.GetActiveIdxs(enttsToMove);
+
+            if (activeIdxs.empty())
+                return;
+
+            enttsToMove.get_data_by_idxs(activeIdxs, activeIds_);
+            ids      = activeIds_.data();
+            numEntts = activeIds_.size();
+            moveIdxs = activeIdxs.data();
+        }
+
+        // get current transform data of entities to move
+        transformSys.GetTransformsSoA(ids, numEntts, soa);
+
+        // apply movement with the SIMD kernel (large batches are split across the job system)
+        g_JobSystem.ParallelFor(numEntts, TransformSoA::JOB_GRAIN, [&movement, &soa, moveIdxs, numEntts, deltaTime](const index start, const index end)
+        {
+            MoveKernelSoA(movement, moveIdxs, numEntts, deltaTime, start, end, soa);
+        });
+
+        // write updated transform data, rebuild world matrices and mark them dirty in a single batch
+        transformSys.SetTransformsSoA(soa);
     }
     catch (const std::out_of_range& e)
     {
@@ -168,33 +277,41 @@ void MoveSystem::AddRecords(
         normRotQuats[i] = DirectX::XMQuaternionNormalize(rotationQuats[i]);
 
 
+    // execute sorted insertion into the data arrays
     cvector<index> idxs;
-    comp.ids_.get_insert_idxs(ids, numEntts, idxs);
+    comp.ids_.merge_sorted(ids, numEntts, idxs);
+    comp.translationAndUniScales_.insert_by_idxs(idxs, packedTrScales.data());
+    comp.rotationQuats_.insert_by_idxs(idxs, normRotQuats.data());
 
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+    dormant_.MarkDirty();
+}
 
-    // allocate ahead more memory
-    const size newCapacity = comp.ids_.size() + numEntts;
-    comp.ids_.reserve(newCapacity);
-    comp.translationAndUniScales_.reserve(newCapacity);
-    comp.rotationQuats_.reserve(newCapacity);
+///////////////////////////////////////////////////////////
 
+void MoveSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED
 
-    // execute sorted insertion into the data arrays
-    for (index i = 0; i < numEntts; ++i)
-        comp.ids_.insert_before(idxs[i] + i, ids[i]);
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
 
-    for (index i = 0; i < numEntts; ++i)
-        comp.translationAndUniScales_.insert_before(idxs[i] + i, packedTrScales[i]);
+    Movement& comp = *pMoveComponent_;
+    cvector<index> idxs;
 
-    for (index i = 0; i < numEntts; ++i)
-        comp.rotationQuats_.insert_before(idxs[i] + i, normRotQuats[i]);
-}
+    comp.sparseIdxs_.GetExistingIdxs(ids, numEntts, idxs);
 
-///////////////////////////////////////////////////////////
+    if (idxs.empty())
+        return;
 
-void MoveSystem::RemoveRecords(const cvector<EntityID>& enttsIDs)
-{
-    throw EngineException("TODO: IMPLEMENT IT!");
+    comp.ids_.erase_by_idxs(idxs);
+    comp.translationAndUniScales_.erase_by_idxs(idxs);
+    comp.rotationQuats_.erase_by_idxs(idxs);
+
+    comp.sparseIdxs_.Remove(ids, numEntts);
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+
+    dormant_.Remove(ids, numEntts);
 }
 
 }
@@ -10,6 +10,8 @@
 // components
 #include "../Components/Movement.h"
 #include "../Components/Transform.h"
+#include "../Common/WorldFile.h"
+#include "../Common/DormantSet.h"
 
 // systems
 #include "TransformSystem.h"
@@ -25,11 +27,15 @@ public:
 		Movement* pMoveComponent);
 	~MoveSystem() {}
 
-	void Serialize(std::ofstream& fout, u32& offset);
-	void Deserialize(std::ifstream& fin, const u32 offset);
+	void Serialize(WorldFileWriter& writer);
+	bool Deserialize(WorldFileReader& reader);
 
 	void UpdateAllMoves(const float deltaTime, TransformSystem& transformSys);
 
+	// components accessed during the update (is used by the update scheduler)
+	static constexpr ComponentBitfield UPDATE_READS  = GetComponentBit(MoveComponent);
+	static constexpr ComponentBitfield UPDATE_WRITES = GetComponentBit(TransformComponent);
+
     void AddRecords(
         const EntityID* ids,
         const XMFLOAT3* translations,
@@ -37,13 +43,22 @@ public:
         const float* uniformScaleFactors,
         const size numEntts);
 
-	void RemoveRecords(const cvector<EntityID>& enttsIDs);
+	void RemoveRecords(const EntityID* ids, const size numEntts);
 
 	inline void GetEnttsIDsFromMoveComponent(cvector<EntityID>& outEnttsIDs) { outEnttsIDs = pMoveComponent_->ids_; }
 
+	// dormant entts aren't moved (see WorldPartitionSystem); input ids must be SORTED
+	inline void SetDormant(const EntityID* ids, const size numEntts, const bool isDormant) { dormant_.Set(ids, numEntts, isDormant); }
+	inline void ClearDormant() { dormant_.Clear(); }
+
 private:
 	Transform*   pTransformComponent_ = nullptr;
 	Movement*    pMoveComponent_ = nullptr;
+
+	TransformSoA s_TransformSoA;                // static transform data of the moved entities
+
+	DormantSet        dormant_;
+	cvector<EntityID> activeIds_;               // moved entts if some of them are dormant
 };
 
 }
@@ -12,19 +12,87 @@ NameSystem::NameSystem(Name* pNameComponent)
 
     // add invalid data; this data is returned when we ask for wrong entity
     pNameComponent_->ids_.push_back(INVALID_ENTITY_ID);
-    pNameComponent_->names_.push_back("invalid");
+    pNameComponent_->names_.push_back(pNameComponent_->strings_.Intern("invalid"));
+    pNameComponent_->sparseIdxs_.Set(INVALID_ENTITY_ID, 0);
 }
 
 ///////////////////////////////////////////////////////////
 
-void NameSystem::Serialize(std::ofstream& fout, u32& offset)
+void NameSystem::Serialize(WorldFileWriter& writer)
 {
+    // names are stored as a single blob of chars + length of each name
+
+    const Name& comp    = *pNameComponent_;
+    const size numNames = comp.names_.size();
+
+    cvector<uint32> lengths(numNames);
+    size numChars = 0;
+
+    for (index i = 0; i < numNames; ++i)
+    {
+        lengths[i] = comp.strings_.GetLength(comp.names_[i]);
+        numChars  += lengths[i];
+    }
+
+    cvector<char> chars(numChars);
+
+    for (index i = 0, pos = 0; i < numNames; pos += lengths[i++])
+        memcpy(chars.data() + pos, comp.strings_.GetStr(comp.names_[i]), lengths[i]);
+
+    writer.BeginChunk(NameComponent);
+    writer.WriteArray(comp.ids_);
+    writer.WriteArray(lengths);
+    writer.WriteArray(chars);
+    writer.EndChunk();
 }
 
 ///////////////////////////////////////////////////////////
 
-void NameSystem::Deserialize(std::ifstream& fin, const u32 offset)
+bool NameSystem::Deserialize(WorldFileReader& reader)
 {
+    Name& comp = *pNameComponent_;
+
+    if (!reader.BeginChunk(NameComponent))
+    {
+        LogErr("there is no names data in the world file");
+        return false;
+    }
+
+    cvector<uint32> lengths;
+    const char* chars = nullptr;
+
+    bool result = true;
+    result &= reader.ReadArray(comp.ids_);
+    result &= reader.ReadArray(lengths);
+    result &= reader.ReadArray(chars, -1);
+    result &= (lengths.size() == comp.ids_.size());
+
+    if (!result)
+    {
+        LogErr("names data in the world file is corrupted");
+        return false;
+    }
+
+    const size numNames = comp.ids_.size();
+    comp.names_.resize(numNames);
+    comp.strings_.Clear();
+
+    for (index i = 0, pos = 0; i < numNames; pos += lengths[i++])
+        comp.names_[i] = comp.strings_.Intern(chars + pos, lengths[i]);
+
+    // rebuild the lookup: name => entity (ids are sorted so the first one is the smallest)
+    comp.enttsByName_.resize(comp.strings_.Size());
+
+    for (EntityID& id : comp.enttsByName_)
+        id = INVALID_ENTITY_ID;
+
+    for (index i = numNames - 1; i > 0; --i)
+        comp.enttsByName_[comp.names_[i]] = comp.ids_[i];
+
+    comp.sparseIdxs_.Clear();
+    comp.sparseIdxs_.Rebuild(comp.ids_);
+
+    return true;
 }
 
 ///////////////////////////////////////////////////////////
@@ -38,44 +106,138 @@ void NameSystem::AddRecords(
 
     Name& comp = *pNameComponent_;
 
+    cvector<StrHandle> handles(numEntts);
+
+    for (index i = 0; i < numEntts; ++i)
+        handles[i] = comp.strings_.Intern(names[i]);
+
+    // execute sorted insertion of IDs and names
     cvector<index> idxs;
-    comp.ids_.get_insert_idxs(ids, numEntts, idxs);
+    comp.ids_.merge_sorted(ids, numEntts, idxs);
+    comp.names_.insert_by_idxs(idxs, handles.data());
 
-    // allocate additional memory ahead if we need
-    const size newCapacity = comp.ids_.size() + numEntts;
-    comp.ids_.reserve(newCapacity);
-    comp.names_.reserve(newCapacity);
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
 
-    // execute sorted insertion of IDs
-    for (index i = 0; i < numEntts; ++i)
-        comp.ids_.insert_before(idxs[i] + i, ids[i]);
+    // update the lookup: name => entity
+    const size numLookupEntries = comp.enttsByName_.size();
+    comp.enttsByName_.resize(comp.strings_.Size());
+
+    for (index i = numLookupEntries; i < comp.enttsByName_.size(); ++i)
+        comp.enttsByName_[i] = INVALID_ENTITY_ID;
 
     for (index i = 0; i < numEntts; ++i)
-        comp.names_.insert_before(idxs[i] + i, names[i]);
+    {
+        EntityID& enttID = comp.enttsByName_[handles[i]];
+
+        if ((enttID == INVALID_ENTITY_ID) || (ids[i] < enttID))
+            enttID = ids[i];
+    }
 }
 
 ///////////////////////////////////////////////////////////
 
-EntityID NameSystem::GetIdByName(const std::string& name)
+void NameSystem::RemoveRecords(const EntityID* ids, const size numEntts)
 {
-    // if there is such a name in the arr we return a responsible entity ID;
-    const Name& comp = *pNameComponent_;
-    const index idx  = comp.names_.find(name);
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Name& comp = *pNameComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs_.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
 
-    return (idx != -1) ? comp.ids_[idx] : INVALID_ENTITY_ID;
+    // store names of removed entts to update the lookup after removal
+    cvector<StrHandle> removedNames;
+    comp.names_.get_data_by_idxs(idxs, removedNames);
+
+    comp.ids_.erase_by_idxs(idxs);
+    comp.names_.erase_by_idxs(idxs);
+
+    comp.sparseIdxs_.Remove(ids, numEntts);
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+
+    for (const StrHandle name : removedNames)
+    {
+        const EntityID enttID = comp.enttsByName_[name];
+
+        if ((enttID != INVALID_ENTITY_ID) && !comp.sparseIdxs_.Has(enttID))
+            UpdateEnttByName(name);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+EntityID NameSystem::GetIdByName(const char* name) const
+{
+    // if there is such a name we return a responsible entity ID
+    // (if there are several entts with this name we return the smallest ID)
+
+    if (!name)
+        return INVALID_ENTITY_ID;
+
+    const Name& comp      = *pNameComponent_;
+    const StrHandle hName = comp.strings_.Find(name, (size)strlen(name));
+
+    if ((hName == StringTable::EMPTY_STR_HANDLE) || (hName >= comp.enttsByName_.size()))
+        return INVALID_ENTITY_ID;
+
+    return comp.enttsByName_[hName];
 }
 
 ///////////////////////////////////////////////////////////
 
-const std::string& NameSystem::GetNameById(const EntityID& id) const
+const char* NameSystem::GetNameById(const EntityID& id) const
 {
     // if there is such an ID in the arr we return a responsible entity name;
     const Name& comp = *pNameComponent_;
 
-    const index idx  = comp.ids_.get_idx(id);
-    const bool exist = (comp.ids_[idx] == id);
+    const index idx  = comp.sparseIdxs_.GetIdx(id);
+    const bool exist = (idx != SparseSet::INVALID_IDX);
+
+    return comp.strings_.GetStr(comp.names_[idx * exist]);
+}
 
-    return comp.names_[idx * exist];
+///////////////////////////////////////////////////////////
+
+void NameSystem::GetNamesByIds(
+    const EntityID* ids,
+    const size numEntts,
+    const char** outNames) const
+{
+    // NOTE: a record by [0] is the default empty name so it is used for missing entts
+    const Name& comp = *pNameComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs_.GetIdxs(ids, numEntts, idxs, 0);
+
+    for (index i = 0; i < numEntts; ++i)
+        outNames[i] = comp.strings_.GetStr(comp.names_[idxs[i]]);
+}
+
+///////////////////////////////////////////////////////////
+
+void NameSystem::UpdateEnttByName(const StrHandle name)
+{
+    // an entt with this name was removed so find another one with the same name
+    // (ids are sorted so the first found is the smallest one);
+    // NOTE: is called only when records are removed
+
+    Name& comp = *pNameComponent_;
+    comp.enttsByName_[name] = INVALID_ENTITY_ID;
+
+    for (index i = 1; i < comp.names_.size(); ++i)
+    {
+        if (comp.names_[i] == name)
+        {
+            comp.enttsByName_[name] = comp.ids_[i];
+            return;
+        }
+    }
 }
 
 
@@ -8,6 +8,7 @@
 
 #include <Types.h>
 #include "../Components/Name.h"
+#include "../Common/WorldFile.h"
 
 namespace ECS
 {
@@ -18,27 +19,31 @@ public:
 	NameSystem(Name* pNameComponent);
 	~NameSystem() {}
 
-	void Serialize(std::ofstream& fout, u32& offset);
-	void Deserialize(std::ifstream& fin, const u32 offset);
+	void Serialize(WorldFileWriter& writer);
+	bool Deserialize(WorldFileReader& reader);
 
     void AddRecords(
         const EntityID* ids,
         const std::string* names,
         const size numEntts);
 
+    void RemoveRecords(const EntityID* ids, const size numEntts);
+
 	//
 	// getters
 	//
-	EntityID GetIdByName(const std::string& name);
-	const std::string& GetNameById(const EntityID& id) const;
+	EntityID GetIdByName(const char* name) const;
+	inline EntityID GetIdByName(const std::string& name) const { return GetIdByName(name.c_str()); }
+
+	// NOTE: returned ptr is valid until new names are added
+	const char* GetNameById(const EntityID& id) const;
+
+	// the same for an arr of entts (an entt without a name gets an empty string)
+	void GetNamesByIds(const EntityID* ids, const size numEntts, const char** outNames) const;
 
 	
 private:
-	void CheckInputData(
-		const cvector<EntityID>& ids,
-		const cvector<std::string>& names);
-
-	index GetIdxByID(const EntityID id) const;
+	void UpdateEnttByName(const StrHandle name);
 
 private:
 	Name* pNameComponent_ = nullptr;
@@ -0,0 +1,248 @@
+// =================================================================================
+// Filename:     ParticleSystem.cpp
+// Description:  implementation of the ParticleSystem's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "ParticleSystem.h"
+
+
+namespace ECS
+{
+
+ParticleSystem::ParticleSystem(ParticleEmitter* pEmitterComponent, TransformSystem* pTransformSys)
+{
+    CAssert::NotNullptr(pEmitterComponent, "ptr to the ParticleEmitter component == nullptr");
+    CAssert::NotNullptr(pTransformSys,     "ptr to the transform system == nullptr");
+
+    pEmitterComponent_ = pEmitterComponent;
+    pTransformSys_     = pTransformSys;
+}
+
+
+// ================================================================================
+//                PUBLIC SERIALIZATION / DESERIALIZATION API
+// ================================================================================
+void ParticleSystem::Serialize(WorldFileWriter& writer)
+{
+    const ParticleEmitter& comp = *pEmitterComponent_;
+
+    writer.BeginChunk(ParticleEmitterComponent);
+    writer.WriteArray(comp.ids_);
+    writer.WriteArray(comp.params_);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool ParticleSystem::Deserialize(WorldFileReader& reader)
+{
+    ParticleEmitter& comp = *pEmitterComponent_;
+
+    // world files which were saved before particle emitters have no such chunk
+    if (!reader.BeginChunk(ParticleEmitterComponent))
+    {
+        comp.ids_.clear();
+        comp.params_.clear();
+        comp.spawnAccums_.clear();
+        comp.sparseIdxs_.Clear();
+        return true;
+    }
+
+    bool result = true;
+    result &= reader.ReadArray(comp.ids_);
+    result &= reader.ReadArray(comp.params_);
+    result &= (comp.params_.size() == comp.ids_.size());
+
+    if (!result)
+    {
+        LogErr("particle emitters data in the world file is corrupted");
+        return false;
+    }
+
+    comp.spawnAccums_.resize(comp.ids_.size(), 0.0f);
+
+    comp.sparseIdxs_.Clear();
+    comp.sparseIdxs_.Rebuild(comp.ids_);
+
+    return true;
+}
+
+
+// ================================================================================
+//                              PUBLIC UPDATING API
+// ================================================================================
+void ParticleSystem::Update(const float deltaTime)
+{
+    ParticleEmitter& comp     = *pEmitterComponent_;
+    size             numEntts = comp.ids_.size();
+    const index*     idxs     = nullptr;
+
+    // skip emitters of dormant chunks
+    if (!dormant_.IsEmpty())
+    {
+        const cvector<index>& activeIdxs = dormant_.GetActiveIdxs(comp.ids_);
+        idxs     = activeIdxs.data();
+        numEntts = activeIdxs.size();
+    }
+
+    for (index n = 0; n < numEntts; ++n)
+    {
+        const index i     = (idxs) ? idxs[n] : n;
+        const float rate  = comp.params_[i].spawnRate;
+        const float accum = comp.spawnAccums_[i] + rate * deltaTime;
+
+        // at least a single particle can be accumulated by a low spawn rate
+        float maxAccum = rate * MAX_ACCUM_TIME;
+        maxAccum = (maxAccum < 1.0f) ? 1.0f : maxAccum;
+
+        comp.spawnAccums_[i] = (accum > maxAccum) ? maxAccum : accum;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void ParticleSystem::CollectEmissions(ParticleEmissions& out)
+{
+    ParticleEmitter& comp     = *pEmitterComponent_;
+    const size       numEntts = comp.ids_.size();
+
+    out.clear();
+    spawnIds_.clear();
+    spawnIdxs_.clear();
+
+    // only emitters which have at least one whole particle to spawn
+    for (index i = 0; i < numEntts; ++i)
+    {
+        if (comp.spawnAccums_[i] >= 1.0f)
+        {
+            spawnIds_.push_back(comp.ids_[i]);
+            spawnIdxs_.push_back(i);
+        }
+    }
+
+    const size numSpawning = spawnIds_.size();
+
+    if (numSpawning == 0)
+        return;
+
+    using namespace DirectX;
+
+    pTransformSys_->GetPositions (spawnIds_.data(), numSpawning, positions_);
+    pTransformSys_->GetDirections(spawnIds_.data(), numSpawning, directions_);
+
+    out.ids = spawnIds_;
+    out.positions = positions_;
+    out.axes.resize_uninitialized(numSpawning);
+    out.numSpawns.resize_uninitialized(numSpawning);
+    out.params.resize_uninitialized(numSpawning);
+
+    const XMVECTOR up = { 0,1,0,0 };
+
+    for (index i = 0; i < numSpawning; ++i)
+    {
+        const index idx      = spawnIdxs_[i];
+        const float numWhole = floorf(comp.spawnAccums_[idx]);
+
+        comp.spawnAccums_[idx] -= numWhole;
+
+        // particles go along the rotated up axis of the emitter
+        XMStoreFloat3(&out.axes[i], XMVector3Rotate(up, directions_[i]));
+
+        out.numSpawns[i] = (uint32)numWhole;
+        out.params[i]    = comp.params_[idx];
+    }
+}
+
+
+// ================================================================================
+//                      PUBLIC CREATION / DELETING API
+// ================================================================================
+void ParticleSystem::AddRecords(
+    const EntityID* ids,
+    const ParticleEmitterParams* params,
+    const size numEntts)
+{
+    CAssert::True(ids && params, "some of input ptrs == nullptr");
+    CAssert::True(numEntts > 0, "input number of entts must be > 0");
+
+    ParticleEmitter& comp = *pEmitterComponent_;
+    const cvector<float> accums(numEntts, 0.0f);
+
+    // execute sorted insertion into the data arrays
+    cvector<index> idxs;
+    comp.ids_.merge_sorted(ids, numEntts, idxs);
+    comp.params_.insert_by_idxs(idxs, params);
+    comp.spawnAccums_.insert_by_idxs(idxs, accums.data());
+
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+    dormant_.MarkDirty();
+}
+
+///////////////////////////////////////////////////////////
+
+void ParticleSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    ParticleEmitter& comp = *pEmitterComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs_.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    comp.ids_.erase_by_idxs(idxs);
+    comp.params_.erase_by_idxs(idxs);
+    comp.spawnAccums_.erase_by_idxs(idxs);
+
+    comp.sparseIdxs_.Remove(ids, numEntts);
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+
+    dormant_.Remove(ids, numEntts);
+}
+
+
+// ================================================================================
+//                           PUBLIC GETTERS / SETTERS
+// ================================================================================
+bool ParticleSystem::SetParams(const EntityID id, const ParticleEmitterParams& params)
+{
+    ParticleEmitter& comp = *pEmitterComponent_;
+    const index      idx  = comp.sparseIdxs_.GetIdx(id);
+
+    if (idx == SparseSet::INVALID_IDX)
+    {
+        sprintf(g_String, "there is no particle emitter by entt: %u", id);
+        LogErr(g_String);
+        return false;
+    }
+
+    comp.params_[idx] = params;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ParticleSystem::GetParams(const EntityID id, ParticleEmitterParams& outParams) const
+{
+    const ParticleEmitter& comp = *pEmitterComponent_;
+    const index            idx  = comp.sparseIdxs_.GetIdx(id);
+
+    if (idx == SparseSet::INVALID_IDX)
+    {
+        sprintf(g_String, "there is no particle emitter by entt: %u", id);
+        LogErr(g_String);
+        return false;
+    }
+
+    outParams = comp.params_[idx];
+    return true;
+}
+
+} // namespace ECS
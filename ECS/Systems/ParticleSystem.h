@@ -0,0 +1,97 @@
+// =================================================================================
+// Filename:     ParticleSystem.h
+// Description:  Entity-Component-System (ECS) system for particle emitters:
+//
+//               - the update only accumulates the number of particles to spawn
+//                 by the spawn rate of each emitter (particles themselves don't
+//                 exist on CPU at all);
+//               - once per frame the renderer collects emissions: the number of
+//                 whole particles to spawn along with the emitter's position and
+//                 emission axis; so the CPU cost depends only on the number of
+//                 emitters but not on the number of particles
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Components/ParticleEmitter.h"
+#include "../Common/WorldFile.h"
+#include "../Common/DormantSet.h"
+#include "TransformSystem.h"
+
+
+namespace ECS
+{
+
+// emitters which spawn particles in this frame (the output of CollectEmissions)
+struct ParticleEmissions
+{
+    cvector<EntityID>              ids;
+    cvector<XMFLOAT3>              positions;
+    cvector<XMFLOAT3>              axes;          // world up axis of the emitter (the cone axis)
+    cvector<uint32>                numSpawns;
+    cvector<ParticleEmitterParams> params;
+
+    inline void clear()
+    {
+        ids.clear();
+        positions.clear();
+        axes.clear();
+        numSpawns.clear();
+        params.clear();
+    }
+};
+
+///////////////////////////////////////////////////////////
+
+class ParticleSystem final
+{
+public:
+    static constexpr float MAX_ACCUM_TIME = 0.25f;     // a long frame doesn't spawn more than this time of particles
+
+    ParticleSystem(ParticleEmitter* pEmitterComponent, TransformSystem* pTransformSys);
+    ~ParticleSystem() {}
+
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
+    // components accessed during the update (is used by the update scheduler)
+    static constexpr ComponentBitfield UPDATE_READS  = GetComponentBit(ParticleEmitterComponent);
+    static constexpr ComponentBitfield UPDATE_WRITES = GetComponentBit(ParticleEmitterComponent);
+
+    // accumulate particles to spawn by spawn rates
+    void Update(const float deltaTime);
+
+    // take the whole accumulated particles of all the emitters
+    // (is called once per frame after the ECS update)
+    void CollectEmissions(ParticleEmissions& out);
+
+    // NOTE: ids must be SORTED
+    void AddRecords(const EntityID* ids, const ParticleEmitterParams* params, const size numEntts);
+    void RemoveRecords(const EntityID* ids, const size numEntts);
+
+    // return false if there is no emitter by such ID
+    bool SetParams(const EntityID id, const ParticleEmitterParams& params);
+    bool GetParams(const EntityID id, ParticleEmitterParams& outParams) const;
+
+    inline bool HasEntity(const EntityID id) const { return pEmitterComponent_->sparseIdxs_.Has(id); }
+    inline size GetNumEmitters()             const { return pEmitterComponent_->ids_.size(); }
+
+    // dormant emitters don't accumulate particles (see WorldPartitionSystem); input ids must be SORTED
+    inline void SetDormant(const EntityID* ids, const size numEntts, const bool isDormant) { dormant_.Set(ids, numEntts, isDormant); }
+    inline void ClearDormant() { dormant_.Clear(); }
+
+private:
+    ParticleEmitter*   pEmitterComponent_ = nullptr;
+    TransformSystem*   pTransformSys_     = nullptr;
+
+    // collection buffers (are kept between frames so they aren't reallocated)
+    cvector<EntityID>  spawnIds_;
+    cvector<index>     spawnIdxs_;
+    cvector<XMFLOAT3>  positions_;
+    cvector<XMVECTOR>  directions_;
+
+    DormantSet         dormant_;
+};
+
+} // namespace ECS
@@ -28,6 +28,40 @@ PlayerSystem::PlayerSystem(
     CAssert::True(pHierarchySys != nullptr, "input ptr to camera system == nullptr");
 }
 
+//---------------------------------------------------------
+// Desc:    write/read the player's entity ID and its data (speeds, states, etc.)
+//---------------------------------------------------------
+void PlayerSystem::Serialize(WorldFileWriter& writer)
+{
+    writer.BeginChunk(PlayerComponent);
+    writer.Write(playerID_);
+    writer.Write(data_);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool PlayerSystem::Deserialize(WorldFileReader& reader)
+{
+    if (!reader.BeginChunk(PlayerComponent))
+    {
+        LogErr("there is no player data in the world file");
+        return false;
+    }
+
+    bool result = true;
+    result &= reader.Read(playerID_);
+    result &= reader.Read(data_);
+
+    if (!result)
+    {
+        LogErr("player data in the world file is corrupted");
+        return false;
+    }
+
+    return true;
+}
+
 //---------------------------------------------------------
 // Desc:    update the player's states
 // Args:    - deltaTime: the time since the prev frame
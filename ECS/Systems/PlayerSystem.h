@@ -10,6 +10,7 @@
 #include "../Systems/TransformSystem.h"
 #include "../Systems/CameraSystem.h"
 #include "../Systems/HierarchySystem.h"
+#include "../Common/WorldFile.h"
 
 
 
@@ -24,8 +25,15 @@ public:
         CameraSystem*    pCameraSys,
         HierarchySystem* pHierarchySys);
 
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
     void Update(const float deltaTime);
 
+    // components accessed during the update (is used by the update scheduler)
+    static constexpr ComponentBitfield UPDATE_READS  = GetComponentBit(HierarchyComponent);
+    static constexpr ComponentBitfield UPDATE_WRITES = GetComponentBit(TransformComponent) | GetComponentBit(PlayerComponent);
+
     inline void SetPlayer(const EntityID id) { playerID_ = id; }
 
     inline EntityID GetPlayerID()  const { return playerID_; }
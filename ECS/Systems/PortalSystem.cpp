@@ -0,0 +1,646 @@
+// =================================================================================
+// Filename:     PortalSystem.cpp
+// Description:  implementation of the PortalSystem's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "PortalSystem.h"
+#include <DirectXCollision.h>
+
+using namespace DirectX;
+
+
+namespace ECS
+{
+
+// cells of an auto-linked portal are found at this distance before/behind it
+static constexpr float PORTAL_PROBE_DIST     = 0.5f;
+
+// the camera which is closer to the portal's plane goes through the portal
+static constexpr float PORTAL_PLANE_EPSILON  = 0.05f;
+
+// each clipping by a plane adds at most one vertex to the portal's rectangle
+static constexpr int   MAX_POLY_VERTS        = 4 + PortalSystem::MAX_FRUSTUM_PLANES;
+
+//---------------------------------------------------------
+// Desc:   signed distance from the point to the plane
+//---------------------------------------------------------
+static inline float PlaneDist(const XMFLOAT4& pl, const XMFLOAT3& p)
+{
+    return pl.x*p.x + pl.y*p.y + pl.z*p.z + pl.w;
+}
+
+//---------------------------------------------------------
+// Desc:   clip a convex polygon by the plane (the part with positive distances is kept)
+// Ret:    the number of vertices of the clipped polygon
+//---------------------------------------------------------
+static int ClipPolygon(
+    const XMFLOAT3* inVerts,
+    const int numVerts,
+    const XMFLOAT4& plane,
+    XMFLOAT3* outVerts)
+{
+    int numOut = 0;
+
+    for (int i = 0; i < numVerts; ++i)
+    {
+        const XMFLOAT3& a  = inVerts[i];
+        const XMFLOAT3& b  = inVerts[(i + 1) % numVerts];
+        const float     da = PlaneDist(plane, a);
+        const float     db = PlaneDist(plane, b);
+
+        if ((da >= 0) && (numOut < MAX_POLY_VERTS))
+            outVerts[numOut++] = a;
+
+        // the edge crosses the plane
+        if (((da >= 0) != (db >= 0)) && (numOut < MAX_POLY_VERTS))
+        {
+            const float t = da / (da - db);
+            outVerts[numOut++] = { a.x + (b.x-a.x)*t, a.y + (b.y-a.y)*t, a.z + (b.z-a.z)*t };
+        }
+    }
+
+    return numOut;
+}
+
+//---------------------------------------------------------
+// Desc:   the box isn't fully behind any plane of the frustum (conservative)
+//---------------------------------------------------------
+static bool BoxInPlanes(const XMFLOAT4* planes, const int numPlanes, const XMFLOAT3& minP, const XMFLOAT3& maxP)
+{
+    const XMFLOAT3 c = { 0.5f*(minP.x+maxP.x), 0.5f*(minP.y+maxP.y), 0.5f*(minP.z+maxP.z) };
+    const XMFLOAT3 e = { 0.5f*(maxP.x-minP.x), 0.5f*(maxP.y-minP.y), 0.5f*(maxP.z-minP.z) };
+
+    for (int i = 0; i < numPlanes; ++i)
+    {
+        const XMFLOAT4& pl = planes[i];
+        const float     r  = fabsf(pl.x)*e.x + fabsf(pl.y)*e.y + fabsf(pl.z)*e.z;
+
+        if (PlaneDist(pl, c) + r < 0)
+            return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   the sphere isn't fully behind any plane of the frustum
+//---------------------------------------------------------
+static bool SphereInPlanes(const XMFLOAT4* planes, const int numPlanes, const XMFLOAT3& c, const float radius)
+{
+    for (int i = 0; i < numPlanes; ++i)
+    {
+        if (PlaneDist(planes[i], c) + radius < 0)
+            return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+PortalSystem::PortalSystem(Portal* pPortalComponent, TransformSystem* pTransformSystem)
+{
+    CAssert::NotNullptr(pPortalComponent, "ptr to the Portal component == nullptr");
+    CAssert::NotNullptr(pTransformSystem, "ptr to the transform system == nullptr");
+
+    pPortalComponent_ = pPortalComponent;
+    pTransformSystem_ = pTransformSystem;
+}
+
+
+// ================================================================================
+//                PUBLIC SERIALIZATION / DESERIALIZATION API
+// ================================================================================
+void PortalSystem::Serialize(WorldFileWriter& writer)
+{
+    const Portal& comp = *pPortalComponent_;
+
+    writer.BeginChunk(PortalComponent);
+    writer.WriteArray(comp.ids_);
+    writer.WriteArray(comp.data_);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool PortalSystem::Deserialize(WorldFileReader& reader)
+{
+    Portal& comp = *pPortalComponent_;
+
+    comp.ids_.clear();
+    comp.data_.clear();
+
+    // world files which were saved before portals have no such chunk
+    if (reader.BeginChunk(PortalComponent))
+    {
+        bool result = true;
+        result &= reader.ReadArray(comp.ids_);
+        result &= reader.ReadArray(comp.data_);
+        result &= (comp.data_.size() == comp.ids_.size());
+
+        if (!result)
+        {
+            LogErr("portals data in the world file is corrupted");
+            comp.ids_.clear();
+            comp.data_.clear();
+            return false;
+        }
+    }
+
+    comp.sparseIdxs_.Clear();
+    comp.sparseIdxs_.Rebuild(comp.ids_);
+
+    ++version_;
+    return true;
+}
+
+
+// ================================================================================
+//                      PUBLIC CREATION / DELETING API
+// ================================================================================
+void PortalSystem::AddRecords(const EntityID* ids, const PortalData* data, const size numEntts)
+{
+    CAssert::True(ids && data, "some of input ptrs == nullptr");
+    CAssert::True(numEntts > 0, "input number of entts must be > 0");
+
+    Portal& comp = *pPortalComponent_;
+
+    // execute sorted insertion into the data arrays
+    cvector<index> idxs;
+    comp.ids_.merge_sorted(ids, numEntts, idxs);
+    comp.data_.insert_by_idxs(idxs, data);
+
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+    ++version_;
+}
+
+///////////////////////////////////////////////////////////
+
+void PortalSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Portal& comp = *pPortalComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs_.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    comp.ids_.erase_by_idxs(idxs);
+    comp.data_.erase_by_idxs(idxs);
+
+    comp.sparseIdxs_.Remove(ids, numEntts);
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+
+    ++version_;
+}
+
+
+// ================================================================================
+//                           PUBLIC GETTERS / SETTERS
+// ================================================================================
+bool PortalSystem::SetPortalOpen(const EntityID id, const bool isOpen)
+{
+    Portal&     comp = *pPortalComponent_;
+    const index idx  = comp.sparseIdxs_.GetIdx(id);
+
+    if ((idx == SparseSet::INVALID_IDX) || (comp.data_[idx].type != PORTAL_TYPE_PORTAL))
+        return false;
+
+    if (comp.data_[idx].isOpen != (uint8)isOpen)
+    {
+        comp.data_[idx].isOpen = (uint8)isOpen;
+        ++version_;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool PortalSystem::IsPortalOpen(const EntityID id) const
+{
+    const Portal& comp = *pPortalComponent_;
+    const index   idx  = comp.sparseIdxs_.GetIdx(id);
+
+    return (idx != SparseSet::INVALID_IDX) && comp.data_[idx].isOpen;
+}
+
+
+// ================================================================================
+//                              PUBLIC VISIBILITY API
+// ================================================================================
+bool PortalSystem::ComputeVisibility(const XMFLOAT3& camPos, const XMFLOAT4* innerPlanes)
+{
+    CAssert::True(innerPlanes != nullptr, "input ptr to frustum planes == nullptr");
+
+    UpdateWorldShapes();
+    frusta_.clear();
+
+    stats_            = PortalStats();
+    stats_.numCells   = (uint32)cells_.size();
+    stats_.numPortals = (uint32)portals_.size();
+
+    isActive_ = !cells_.empty();
+
+    if (!isActive_)
+        return false;
+
+    camPos_   = camPos;
+    farPlane_ = innerPlanes[1];
+
+    PortalFrustum root;
+    root.numPlanes = 6;
+    memcpy(root.planes, innerPlanes, sizeof(XMFLOAT4) * 6);
+
+    // the camera out of all the cells sees interiors only through portals to the outside
+    const int numCells = (int)cells_.size();
+    const int camCell  = FindCell(camPos);
+    const int startIdx = (camCell >= 0) ? camCell : numCells;
+
+    isOnPath_.resize(numCells + 1);
+    memset(isOnPath_.data(), 0, isOnPath_.size());
+
+    Traverse(startIdx, root, 0);
+
+    // count the reached cells (the marks of the path are all reset after the traversal)
+    for (const PortalFrustum& frustum : frusta_)
+    {
+        stats_.numVisitedCells += (isOnPath_[frustum.cellIdx] == 0);
+        isOnPath_[frustum.cellIdx] = 1;
+    }
+
+    memset(isOnPath_.data(), 0, isOnPath_.size());
+
+    stats_.numFrusta  = (uint32)frusta_.size();
+    stats_.cameraCell = (camCell >= 0) ? cells_[camCell].id : INVALID_ENTITY_ID;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool PortalSystem::IsBoxVisible(const XMFLOAT3& minP, const XMFLOAT3& maxP) const
+{
+    if (!isActive_)
+        return true;
+
+    for (const PortalFrustum& frustum : frusta_)
+    {
+        if (IsInRegion(frustum.cellIdx, minP, maxP) && BoxInPlanes(frustum.planes, frustum.numPlanes, minP, maxP))
+            return true;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+bool PortalSystem::IsSphereVisible(const float x, const float y, const float z, const float radius) const
+{
+    if (!isActive_)
+        return true;
+
+    const XMFLOAT3 center = { x, y, z };
+    const XMFLOAT3 minP   = { x - radius, y - radius, z - radius };
+    const XMFLOAT3 maxP   = { x + radius, y + radius, z + radius };
+
+    for (const PortalFrustum& frustum : frusta_)
+    {
+        if (IsInRegion(frustum.cellIdx, minP, maxP) && SphereInPlanes(frustum.planes, frustum.numPlanes, center, radius))
+            return true;
+    }
+
+    return false;
+}
+
+
+// ================================================================================
+//                                PRIVATE HELPERS
+// ================================================================================
+void PortalSystem::UpdateWorldShapes()
+{
+    // world bounds of cells, rectangles of portals and links between them
+
+    const Portal& comp     = *pPortalComponent_;
+    const size    numEntts = comp.ids_.size();
+
+    cells_.clear();
+    portals_.clear();
+    cellPortalsStart_.clear();
+    cellPortals_.clear();
+
+    if (numEntts == 0)
+        return;
+
+    s_Worlds.resize(numEntts);
+    pTransformSystem_->GetWorlds(comp.ids_.data(), numEntts, s_Worlds.data());
+
+    // cells: the AABB of the transformed local box (their IDs remain SORTED)
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const PortalData& data = comp.data_[i];
+
+        if (data.type != PORTAL_TYPE_CELL)
+            continue;
+
+        BoundingBox box;
+        BoundingBox(data.center, data.extents).Transform(box, s_Worlds[i]);
+
+        CellWorld cell;
+        cell.minP = { box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z };
+        cell.maxP = { box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z };
+        cell.id   = comp.ids_[i];
+
+        cells_.push_back(cell);
+    }
+
+    const int numCells   = (int)cells_.size();
+    const int outsideIdx = numCells;
+
+    // portals: the rectangle in the local XY plane and cells on both its sides
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const PortalData& data = comp.data_[i];
+
+        if (data.type != PORTAL_TYPE_PORTAL)
+            continue;
+
+        const XMMATRIX& world = s_Worlds[i];
+        const float     ex    = data.extents.x;
+        const float     ey    = data.extents.y;
+
+        PortalWorld portal;
+        XMStoreFloat3(&portal.corners[0], XMVector3TransformCoord(XMVectorSet(-ex, -ey, 0, 1), world));
+        XMStoreFloat3(&portal.corners[1], XMVector3TransformCoord(XMVectorSet( ex, -ey, 0, 1), world));
+        XMStoreFloat3(&portal.corners[2], XMVector3TransformCoord(XMVectorSet( ex,  ey, 0, 1), world));
+        XMStoreFloat3(&portal.corners[3], XMVector3TransformCoord(XMVectorSet(-ex,  ey, 0, 1), world));
+
+        const XMVECTOR center = world.r[3];
+        const XMVECTOR normal = XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(0, 0, 1, 0), world));
+
+        XMStoreFloat4(&portal.plane, XMVectorSetW(normal, -XMVectorGetX(XMVector3Dot(normal, center))));
+        portal.isOpen = data.isOpen;
+
+        for (int side = PORTAL_SIDE_BACK; side <= PORTAL_SIDE_FRONT; ++side)
+        {
+            const EntityID cellID = data.cells[side];
+            int cellIdx = -1;
+
+            // an explicitly linked cell
+            if (cellID != INVALID_ENTITY_ID)
+            {
+                const CellWorld* it = std::lower_bound(cells_.begin(), cells_.end(), cellID,
+                    [](const CellWorld& cell, const EntityID id) { return cell.id < id; });
+
+                if ((it != cells_.end()) && (it->id == cellID))
+                    cellIdx = (int)(it - cells_.begin());
+            }
+
+            // or a cell which contains the point before/behind the portal
+            if (cellIdx < 0)
+            {
+                const float    dist = (side == PORTAL_SIDE_FRONT) ? PORTAL_PROBE_DIST : -PORTAL_PROBE_DIST;
+                XMFLOAT3 probe;
+                XMStoreFloat3(&probe, XMVectorMultiplyAdd(normal, XMVectorReplicate(dist), center));
+
+                cellIdx = FindCell(probe);
+            }
+
+            portal.cells[side] = (cellIdx >= 0) ? cellIdx : outsideIdx;
+        }
+
+        // a portal within a single cell (or within the outside) links nothing
+        if (portal.cells[0] != portal.cells[1])
+            portals_.push_back(portal);
+    }
+
+    // portals of each cell (the outside included): counts => offsets => idxs
+    cellPortalsStart_.resize(numCells + 2);
+    memset(cellPortalsStart_.data(), 0, sizeof(int) * cellPortalsStart_.size());
+
+    for (const PortalWorld& portal : portals_)
+    {
+        cellPortalsStart_[portal.cells[0] + 1]++;
+        cellPortalsStart_[portal.cells[1] + 1]++;
+    }
+
+    for (index i = 1; i < cellPortalsStart_.size(); ++i)
+        cellPortalsStart_[i] += cellPortalsStart_[i - 1];
+
+    cvector<int>& cursors = s_Cursors;
+    cursors = cellPortalsStart_;
+    cellPortals_.resize(cellPortalsStart_.back());
+
+    for (index i = 0; i < portals_.size(); ++i)
+    {
+        cellPortals_[cursors[portals_[i].cells[0]]++] = (int)i;
+        cellPortals_[cursors[portals_[i].cells[1]]++] = (int)i;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+int PortalSystem::FindCell(const XMFLOAT3& p) const
+{
+    // the smallest cell which contains the point (cells can be nested: a closet in a room);
+    // return -1 if the point is outside of all the cells
+
+    int   cellIdx = -1;
+    float minVolume = FLT_MAX;
+
+    for (index i = 0; i < cells_.size(); ++i)
+    {
+        const CellWorld& cell = cells_[i];
+
+        const bool isInside =
+            (p.x >= cell.minP.x) && (p.x <= cell.maxP.x) &&
+            (p.y >= cell.minP.y) && (p.y <= cell.maxP.y) &&
+            (p.z >= cell.minP.z) && (p.z <= cell.maxP.z);
+
+        if (!isInside)
+            continue;
+
+        const float volume = (cell.maxP.x - cell.minP.x) * (cell.maxP.y - cell.minP.y) * (cell.maxP.z - cell.minP.z);
+
+        if (volume < minVolume)
+        {
+            minVolume = volume;
+            cellIdx   = (int)i;
+        }
+    }
+
+    return cellIdx;
+}
+
+///////////////////////////////////////////////////////////
+
+void PortalSystem::Traverse(const int cellIdx, const PortalFrustum& frustum, const int depth)
+{
+    // the cell is seen by this frustum; go further through its open portals
+    // which are seen by it (the chain doesn't return into its own cells)
+
+    if (frusta_.size() >= MAX_FRUSTA)
+        return;
+
+    frusta_.push_back(frustum);
+    frusta_.back().cellIdx = cellIdx;
+
+    if (depth >= MAX_PORTAL_DEPTH)
+        return;
+
+    isOnPath_[cellIdx] = 1;
+
+    for (int i = cellPortalsStart_[cellIdx]; i < cellPortalsStart_[cellIdx + 1]; ++i)
+    {
+        const PortalWorld& portal = portals_[cellPortals_[i]];
+
+        if (!portal.isOpen)
+            continue;
+
+        const int nextIdx = (portal.cells[0] == cellIdx) ? portal.cells[1] : portal.cells[0];
+
+        if (isOnPath_[nextIdx])
+            continue;
+
+        PortalFrustum narrowed;
+
+        if (NarrowFrustum(portal, frustum, narrowed))
+            Traverse(nextIdx, narrowed, depth + 1);
+    }
+
+    isOnPath_[cellIdx] = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+bool PortalSystem::NarrowFrustum(
+    const PortalWorld& portal,
+    const PortalFrustum& parent,
+    PortalFrustum& outFrustum) const
+{
+    // make a frustum of the part of the portal which is seen by the parent frustum;
+    // return false if the portal isn't seen at all
+
+    const XMFLOAT3& cam     = camPos_;
+    const float     camDist = PlaneDist(portal.plane, cam);
+
+    // the camera goes through the portal: the narrowed frustum degenerates
+    // so the cell behind is seen by the parent frustum
+    if (fabsf(camDist) < PORTAL_PLANE_EPSILON)
+    {
+        outFrustum = parent;
+        return true;
+    }
+
+    // clip the rectangle by the parent frustum
+    XMFLOAT3  bufA[MAX_POLY_VERTS];
+    XMFLOAT3  bufB[MAX_POLY_VERTS];
+    XMFLOAT3* poly     = bufA;
+    XMFLOAT3* clipped  = bufB;
+    int       numVerts = 4;
+
+    memcpy(poly, portal.corners, sizeof(portal.corners));
+
+    for (int i = 0; i < parent.numPlanes; ++i)
+    {
+        numVerts = ClipPolygon(poly, numVerts, parent.planes[i], clipped);
+        std::swap(poly, clipped);
+
+        if (numVerts < 3)
+            return false;
+    }
+
+    // too many edges for the planes (a very rare case): the parent frustum is conservative
+    if (numVerts > MAX_FRUSTUM_PLANES - 2)
+    {
+        outFrustum = parent;
+        return true;
+    }
+
+    XMFLOAT3 centroid = { 0,0,0 };
+
+    for (int i = 0; i < numVerts; ++i)
+    {
+        centroid.x += poly[i].x;
+        centroid.y += poly[i].y;
+        centroid.z += poly[i].z;
+    }
+
+    centroid.x /= numVerts;
+    centroid.y /= numVerts;
+    centroid.z /= numVerts;
+
+    // planes through the camera and each edge of the clipped polygon
+    const XMVECTOR camPos = XMLoadFloat3(&cam);
+    outFrustum.numPlanes  = 0;
+
+    for (int i = 0; i < numVerts; ++i)
+    {
+        const XMVECTOR a      = XMVectorSubtract(XMLoadFloat3(&poly[i]), camPos);
+        const XMVECTOR b      = XMVectorSubtract(XMLoadFloat3(&poly[(i + 1) % numVerts]), camPos);
+        const XMVECTOR cross  = XMVector3Cross(a, b);
+        const float    lenSq  = XMVectorGetX(XMVector3LengthSq(cross));
+
+        // a degenerate edge (after clipping)
+        if (lenSq < 1e-12f)
+            continue;
+
+        XMFLOAT4& pl = outFrustum.planes[outFrustum.numPlanes++];
+        XMStoreFloat3((XMFLOAT3*)&pl, XMVectorScale(cross, 1.0f / sqrtf(lenSq)));
+        pl.w = -(pl.x*cam.x + pl.y*cam.y + pl.z*cam.z);
+
+        // the normal looks inside (to the polygon)
+        if (PlaneDist(pl, centroid) < 0)
+            pl = { -pl.x, -pl.y, -pl.z, -pl.w };
+    }
+
+    // only things behind the portal are seen through it
+    const float sign = (camDist > 0) ? -1.0f : 1.0f;
+    const XMFLOAT4& pp = portal.plane;
+
+    outFrustum.planes[outFrustum.numPlanes++] = { pp.x*sign, pp.y*sign, pp.z*sign, pp.w*sign };
+    outFrustum.planes[outFrustum.numPlanes++] = farPlane_;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool PortalSystem::IsInRegion(const int cellIdx, const XMFLOAT3& minP, const XMFLOAT3& maxP) const
+{
+    // a box belongs to each cell which it overlaps and to the outside
+    // if it isn't fully inside of any cell (for instance: walls of the building)
+
+    if (cellIdx < (int)cells_.size())
+    {
+        const CellWorld& cell = cells_[cellIdx];
+
+        return
+            (minP.x <= cell.maxP.x) && (maxP.x >= cell.minP.x) &&
+            (minP.y <= cell.maxP.y) && (maxP.y >= cell.minP.y) &&
+            (minP.z <= cell.maxP.z) && (maxP.z >= cell.minP.z);
+    }
+
+    for (const CellWorld& cell : cells_)
+    {
+        const bool isContained =
+            (minP.x >= cell.minP.x) && (maxP.x <= cell.maxP.x) &&
+            (minP.y >= cell.minP.y) && (maxP.y <= cell.maxP.y) &&
+            (minP.z >= cell.minP.z) && (maxP.z <= cell.maxP.z);
+
+        if (isContained)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace ECS
@@ -0,0 +1,139 @@
+// =================================================================================
+// Filename:     PortalSystem.h
+// Description:  Entity-Component-System (ECS) system for the visibility of interiors
+//               by cells and portals (see Portal.h):
+//
+//               - the traversal starts from the cell of the camera (or from the
+//                 outside) with the camera frustum; each open portal of the cell
+//                 is clipped by the current frustum and the rest of it makes a
+//                 narrowed frustum (planes through the camera and edges of the
+//                 clipped polygon + the portal plane) for the cell behind it;
+//               - a cell can be reached by several chains of portals so it keeps
+//                 all its frusta; the chain never returns into its own cells;
+//               - an object is visible if it touches a reached cell (or sticks out
+//                 of all the cells for the outside) and is inside one of its frusta
+//
+//               cells and portals are few so their world shapes (and links of
+//               portals) are rebuilt by each computation of the visibility
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Components/Portal.h"
+#include "../Common/WorldFile.h"
+#include "TransformSystem.h"
+
+
+namespace ECS
+{
+
+struct PortalStats
+{
+    uint32 numCells        = 0;
+    uint32 numPortals      = 0;
+    uint32 numVisitedCells = 0;                   // reached by the traversal (including the outside)
+    uint32 numFrusta       = 0;                   // narrowed frusta of all the reached cells
+    EntityID cameraCell    = INVALID_ENTITY_ID;   // INVALID_ENTITY_ID - the camera is outside
+};
+
+///////////////////////////////////////////////////////////
+
+class PortalSystem final
+{
+public:
+    static constexpr int MAX_PORTAL_DEPTH   = 8;  // max number of portals in a chain
+    static constexpr int MAX_FRUSTA         = 256;
+    static constexpr int MAX_FRUSTUM_PLANES = 16;
+
+    PortalSystem(Portal* pPortalComponent, TransformSystem* pTransformSystem);
+    ~PortalSystem() {}
+
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
+    // NOTE: ids must be SORTED
+    void AddRecords(const EntityID* ids, const PortalData* data, const size numEntts);
+    void RemoveRecords(const EntityID* ids, const size numEntts);
+
+    // a closed portal (for instance: a closed door) blocks the visibility;
+    // return false if there is no portal by such ID
+    bool SetPortalOpen(const EntityID id, const bool isOpen);
+    bool IsPortalOpen (const EntityID id) const;
+
+    // find reached cells and their frusta by the camera position and world-space
+    // planes of its frustum in order: near, far, right, left, top, bottom (normals look inside);
+    // return false if there are no cells (the visibility isn't restricted)
+    bool ComputeVisibility(const DirectX::XMFLOAT3& camPos, const DirectX::XMFLOAT4* innerPlanes);
+
+    // tests by the last computed visibility (everything is visible if it isn't active)
+    bool IsBoxVisible   (const DirectX::XMFLOAT3& minP, const DirectX::XMFLOAT3& maxP) const;
+    bool IsSphereVisible(const float x, const float y, const float z, const float radius) const;
+
+    // the set of portals/cells or their states was changed (so cached visibility is invalid)
+    inline uint32             GetVersion() const { return version_; }
+    inline bool               IsActive()   const { return isActive_; }
+    inline const PortalStats& GetStats()   const { return stats_; }
+
+    inline bool HasEntity(const EntityID id) const { return pPortalComponent_->sparseIdxs_.Has(id); }
+    inline size GetNumRecords()              const { return pPortalComponent_->ids_.size(); }
+
+private:
+    struct CellWorld
+    {
+        DirectX::XMFLOAT3 minP;
+        DirectX::XMFLOAT3 maxP;
+        EntityID          id;
+    };
+
+    struct PortalWorld
+    {
+        DirectX::XMFLOAT3 corners[4];
+        DirectX::XMFLOAT4 plane;                  // normal looks into the front cell
+        int               cells[2];               // idxs of the back/front cells (numCells - the outside)
+        bool              isOpen;
+    };
+
+    struct PortalFrustum
+    {
+        DirectX::XMFLOAT4 planes[MAX_FRUSTUM_PLANES];   // normals look inside
+        int               numPlanes = 0;
+        int               cellIdx   = 0;
+    };
+
+    void UpdateWorldShapes();
+    int  FindCell(const DirectX::XMFLOAT3& p) const;
+
+    void Traverse(const int cellIdx, const PortalFrustum& frustum, const int depth);
+
+    bool NarrowFrustum(
+        const PortalWorld& portal,
+        const PortalFrustum& parent,
+        PortalFrustum& outFrustum) const;
+
+    bool IsInRegion(const int cellIdx, const DirectX::XMFLOAT3& minP, const DirectX::XMFLOAT3& maxP) const;
+
+private:
+    Portal*                pPortalComponent_ = nullptr;
+    TransformSystem*       pTransformSystem_ = nullptr;
+
+    cvector<CellWorld>     cells_;
+    cvector<PortalWorld>   portals_;
+    cvector<int>           cellPortalsStart_;     // portals of the cell i: cellPortals_[start[i], start[i+1])
+    cvector<int>           cellPortals_;
+
+    cvector<PortalFrustum> frusta_;               // of all the reached cells
+    cvector<uint8>         isOnPath_;             // by cell idx: the cell is in the current chain of portals
+
+    DirectX::XMFLOAT3      camPos_    = { 0,0,0 };
+    DirectX::XMFLOAT4      farPlane_  = { 0,0,0,0 };
+    PortalStats            stats_;
+    uint32                 version_   = 0;
+    bool                   isActive_  = false;
+
+    // transient buffers (are kept between calls so they aren't reallocated)
+    cvector<DirectX::XMMATRIX> s_Worlds;
+    cvector<int>           s_Cursors;
+};
+
+} // namespace ECS
@@ -6,6 +6,7 @@
 // =================================================================================
 #include "../Common/pch.h"
 #include "RenderStatesSystem.h"
+#include <bit>
 
 #pragma warning (disable : 4996)
 
@@ -38,9 +39,8 @@ RenderStatesSystem::RenderStatesSystem(RenderStates* pRenderStatesComponent)
 	// make a hash mask to get entts: default + blending
 	GetHashByStates(blendingStates, blendingRSMask_);
 
-	// make a map of pairs ['bs_hash' => 'bs_state']
-	for (const eRenderState bs : blendingStates)
-		hashesToBS_.insert({ (1 << bs), bs });
+	// to check if entt has default render states (but without NO_BLENDING)
+	defaultNoBlendingMask_ = defaultRSMask_ & ~(1 << NO_BLENDING);
 
 	MakeDisablingMasks();
 }
@@ -54,6 +54,53 @@ RenderStatesSystem::~RenderStatesSystem()
 
 ///////////////////////////////////////////////////////////
 
+void RenderStatesSystem::Serialize(WorldFileWriter& writer)
+{
+	const RenderStates& comp = *pRSComponent_;
+
+	writer.BeginChunk(RenderStatesComponent);
+	writer.WriteArray(comp.ids_);
+	writer.WriteArray(comp.statesHashes_);
+	writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool RenderStatesSystem::Deserialize(WorldFileReader& reader)
+{
+	RenderStates& comp = *pRSComponent_;
+
+	if (!reader.BeginChunk(RenderStatesComponent))
+	{
+		LogErr("there is no render states data in the world file");
+		return false;
+	}
+
+	bool result = true;
+	result &= reader.ReadArray(comp.ids_);
+	result &= reader.ReadArray(comp.statesHashes_);
+	result &= (comp.statesHashes_.size() == comp.ids_.size());
+
+	if (!result)
+	{
+		LogErr("render states data in the world file is corrupted");
+		return false;
+	}
+
+	comp.sparseIdxs_.Clear();
+	comp.sparseIdxs_.Rebuild(comp.ids_);
+
+	// buckets aren't stored so recompute them
+	comp.buckets_.resize(comp.ids_.size());
+
+	for (index i = 0; i < comp.ids_.size(); ++i)
+		comp.buckets_[i] = ComputeBucket(comp.statesHashes_[i]);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////
+
 void RenderStatesSystem::AddWithDefaultStates(const EntityID* ids, const size numEntts)
 {
 	// add new records only with ids which aren't exist in the component yet;
@@ -70,16 +117,39 @@ void RenderStatesSystem::AddWithDefaultStates(const EntityID* ids, const size nu
 
     const size numToAdd = newIds.size();
 
+    // execute sorted insertion of IDs and storing of hashes according to related IDs
     cvector<index> idxs;
-    comp.ids_.get_insert_idxs(newIds, idxs);
+    comp.ids_.merge_sorted(newIds, idxs);
+    comp.statesHashes_.insert_by_idxs(idxs, hash);
+    comp.buckets_.insert_by_idxs(idxs, ComputeBucket(hash));
+
+    if (numToAdd > 0)
+        comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+void RenderStatesSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+	// remove records of input entts (if they have any) with a single pass
+	// over the data arrays, so the arrays remain SORTED
+
+	CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+	RenderStates& comp = *pRSComponent_;
+	cvector<index> idxs;
+
+	comp.sparseIdxs_.GetExistingIdxs(ids, numEntts, idxs);
 
-    // execute sorted insertion of IDs
-    for (index i = 0; i < numToAdd; ++i)
-        comp.ids_.insert_before(idxs[i] + i, newIds[i]);
+	if (idxs.empty())
+		return;
 
-    // execute storing of hashes according to related IDs
-    for (index i = 0; i < numToAdd; ++i)
-        comp.statesHashes_.insert_before(idxs[i] + i, hash);
+	comp.ids_.erase_by_idxs(idxs);
+	comp.statesHashes_.erase_by_idxs(idxs);
+	comp.buckets_.erase_by_idxs(idxs);
+
+	comp.sparseIdxs_.Remove(ids, numEntts);
+	comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
 }
 
 ///////////////////////////////////////////////////////////
@@ -114,21 +184,63 @@ void RenderStatesSystem::SeparateEnttsByRenderStates(
 	const cvector<EntityID>& ids,
 	EnttsRenderStatesData& outData)
 {
+	// render states are rarely changed so the bucket of each entt is precomputed
+	// (see UpdateBuckets); here we only distribute input entts by buckets
+	// with a single pass (the order of input entts is kept within each bucket)
+
 	const RenderStates& comp = *pRSComponent_;
-	const size idsCount = std::ssize(ids);
+	const size numEntts = ids.size();
+	size numPerBucket[NUM_RS_BUCKETS]{ 0 };
 
-	cvector<u32> hashes(idsCount);
-	cvector<index> idxs;
+	comp.sparseIdxs_.GetIdxs(ids, s_Idxs);
+	s_Buckets.resize(numEntts);
 
-    comp.ids_.get_idxs(ids, idxs);
+	// entts without render states record are considered as having "other" states
+	for (index i = 0; i < numEntts; ++i)
+		s_Buckets[i] = (s_Idxs[i] != SparseSet::INVALID_IDX) ? comp.buckets_[s_Idxs[i]] : RS_BUCKET_OTHER;
 
-	// get render states hashes by idxs
-	for (int i = 0; const index idx : idxs)
-		hashes[i++] = comp.statesHashes_[idx];
+	for (const uint8 bucket : s_Buckets)
+		++numPerBucket[bucket];
+
+	// prepare output arrays and a write position for each bucket
+	EntityID* outPos[NUM_RS_BUCKETS]{ nullptr };
+
+	outData.enttsDefault_.ids_.resize(numPerBucket[RS_BUCKET_DEFAULT]);
+	outData.enttsAlphaClipping_.ids_.resize(numPerBucket[RS_BUCKET_ALPHA_CLIP_CULL_NONE]);
+	outPos[RS_BUCKET_DEFAULT]              = outData.enttsDefault_.ids_.data();
+	outPos[RS_BUCKET_ALPHA_CLIP_CULL_NONE] = outData.enttsAlphaClipping_.ids_.data();
+
+	// blended entts are grouped by blending states (in order of these states)
+	EnttsBlended& blended = outData.enttsBlended_;
+	size numBlended = 0;
+
+	for (int bucket = RS_BUCKET_BLENDED; bucket < NUM_RS_BUCKETS; ++bucket)
+		numBlended += numPerBucket[bucket];
+
+	blended.ids_.resize(numBlended);
+	blended.instanceCountPerBS_.clear();
+	blended.states_.clear();
 
-	GetEnttsWithDefaultRS(ids, hashes, outData.enttsDefault_);
-	GetEnttsWithAlphaClipCullNone(ids, hashes, outData.enttsAlphaClipping_);
-	GetEnttsBlended(ids, hashes, outData.enttsBlended_);
+	for (int bucket = RS_BUCKET_BLENDED, offset = 0; bucket < NUM_RS_BUCKETS; ++bucket)
+	{
+		if (numPerBucket[bucket] == 0)
+			continue;
+
+		outPos[bucket] = blended.ids_.data() + offset;
+		offset += (int)numPerBucket[bucket];
+
+		blended.instanceCountPerBS_.push_back(numPerBucket[bucket]);
+		blended.states_.push_back(1u << (ALPHA_ENABLE + (bucket - RS_BUCKET_BLENDED)));
+	}
+
+	// distribute entts
+	for (index i = 0; i < numEntts; ++i)
+	{
+		const uint8 bucket = s_Buckets[i];
+
+		if (bucket != RS_BUCKET_OTHER)
+			*(outPos[bucket]++) = ids[i];
+	}
 }
 
 
@@ -146,7 +258,7 @@ void RenderStatesSystem::GetNewEntts(
 	cvector<bool> exists(numEntts, false);
 
     for (index i = 0; i < numEntts; ++i)
-        exists[i] |= comp.ids_.binary_search(ids[i]);
+        exists[i] |= comp.sparseIdxs_.Has(ids[i]);
 
 	newIds.reserve(numEntts);
 
@@ -220,177 +332,43 @@ void RenderStatesSystem::GetIdsByIdxs(
 
 ///////////////////////////////////////////////////////////
 
-void GetEnttsWithHash(
-	const cvector<EntityID>& ids,
-	const cvector<u32>& rsHashes,
-	const u32 hashMask,
-	cvector<EntityID>& outIds)
+uint8 RenderStatesSystem::ComputeBucket(const u32 hash) const
 {
-	// out: entts which have exact render states hash
+	// define a bucket of entt by its render states hash
 
-	const size enttsCount = std::ssize(ids);
-	int outIdIdx = 0;
+	if (hash == defaultRSMask_)
+		return RS_BUCKET_DEFAULT;
 
-	outIds.resize(enttsCount);
+	if (hash == alphaClipCullNoneMask_)
+		return RS_BUCKET_ALPHA_CLIP_CULL_NONE;
 
-	for (int i = 0; i < (int)enttsCount; ++i)
-	{
-		outIds[outIdIdx] = ids[i];
-		outIdIdx += (rsHashes[i] == hashMask);
-	}
+	// blending + all the other states are default
+	const u32  bsHash       = hash & blendingRSMask_;
+	const bool hasDefaultRS = (defaultNoBlendingMask_ == (hash & defaultNoBlendingMask_));
 
-	outIds.resize(outIdIdx);
-}
-
-///////////////////////////////////////////////////////////
-
-void RenderStatesSystem::GetEnttsWithDefaultRS(
-	const cvector<EntityID>& ids,
-	const cvector<u32>& hashes,
-	EnttsDefaultState& outData)
-{
-	// get entts which have only default render states
-	GetEnttsWithHash(ids, hashes, defaultRSMask_, outData.ids_);
-}
-
-///////////////////////////////////////////////////////////
-
-void RenderStatesSystem::GetEnttsWithAlphaClipCullNone(
-	const cvector<EntityID>& ids,
-	const cvector<u32>& hashes,
-	EnttsAlphaClipping& outData)
-{
-	// get entts which have the following specific render states:
-	// alpha clipping and cull none
-	GetEnttsWithHash(ids, hashes, alphaClipCullNoneMask_, outData.ids_);
-}
-
-///////////////////////////////////////////////////////////
-
-void RenderStatesSystem::FilterEnttsOnlyBlending(
-	const cvector<EntityID>& ids,
-	const cvector<u32>& hashes,
-	cvector<EntityID>& enttWithBS,
-	cvector<u32>& hashesWithBS)
-{
-	// filter ids and hashes of entts which has blending and other default render states
-	
-	const int enttsCount = (int)std::ssize(ids);
-	int blendedCount = 0;
-
-	enttWithBS.resize(enttsCount);
-	hashesWithBS.resize(enttsCount);
-
-	// to check if entt has default render states (but without NO_BLENDING)
-	u32 defaultHashMask = defaultRSMask_;
-	defaultHashMask &= ~(1 << NO_BLENDING);
-
-	// get entts only with blending (but all the other states are default)
-	for (int i = 0; i < (int)enttsCount; ++i)
+	if (bsHash && hasDefaultRS)
 	{
-		bool hasDefaultRS = (defaultHashMask == (hashes[i] & defaultHashMask));
+		// a single blending state: its bit is the bucket
+		if (std::has_single_bit(bsHash))
+			return (uint8)(RS_BUCKET_BLENDED + (std::countr_zero(bsHash) - ALPHA_ENABLE));
 
-		enttWithBS[blendedCount] = ids[i];
-		hashesWithBS[blendedCount] = hashes[i] & blendingRSMask_;          // == 1 if has blending state
-		blendedCount += (bool(hashesWithBS[blendedCount]) & hasDefaultRS); // if has bs and all the other default rs
+		sprintf(g_String, "unknown blending state hash: %ud", bsHash);
+		LogErr(g_String);
 	}
 
-	enttWithBS.resize(blendedCount);
-	hashesWithBS.resize(blendedCount);
+	return RS_BUCKET_OTHER;
 }
 
 ///////////////////////////////////////////////////////////
 
-
-void RenderStatesSystem::GetBlendingStatesByHashes(
-	const cvector<u32>& hashes,
-	cvector<eRenderState>& blendStates)
+void RenderStatesSystem::UpdateBuckets(const cvector<index>& idxs)
 {
-	// get blending state code for each hash
+	// recompute buckets of records by idxs (is called when their states were changed)
 
-	const size hashCount = std::ssize(hashes);
-	blendStates.resize(hashCount);
-	
-	for (int i = 0; i < hashCount; ++i)
-	{
-		switch (hashes[i])
-		{
-			case (1 << ALPHA_ENABLE):
-			{
-				blendStates[i] = ALPHA_ENABLE;
-				break;
-			}
-			case (1 << ADDING):
-			{
-				blendStates[i] = ADDING;
-				break;
-			}
-			case (1 << SUBTRACTING):
-			{
-				blendStates[i] = SUBTRACTING;
-				break;
-			}
-			case (1 << MULTIPLYING):
-			{
-				blendStates[i] = MULTIPLYING;
-				break;
-			}
-			case (1 << TRANSPARENCY):
-			{
-				blendStates[i] = TRANSPARENCY;
-				break;
-			}
-			default:
-			{
-                sprintf(g_String, "unknown blending state hash: %ud", hashes[i]);
-				LogErr(g_String);
-				break;
-			}
-		}
-	}
-}
-
-///////////////////////////////////////////////////////////
-
-void RenderStatesSystem::GetEnttsBlended(
-	const cvector<EntityID>& ids,
-	const cvector<u32>& hashes,
-	EnttsBlended& outData)
-{
-	cvector<EntityID> enttWithBS;
-	cvector<u32> hashesWithBS;
-	cvector<eRenderState> bsCodes;
-	std::map<eRenderState, cvector<EntityID>> bsToIdxs;
-	
-
-	FilterEnttsOnlyBlending(ids, hashes, enttWithBS, hashesWithBS);
-	GetBlendingStatesByHashes(hashesWithBS, bsCodes);
-
-	// separate entts by blending states
-	for (int i = 0; const eRenderState bs : bsCodes)
-		bsToIdxs[bs].push_back(enttWithBS[i++]);
-
-	const size bsCount = std::ssize(bsToIdxs);
-	outData.ids_.reserve(std::ssize(enttWithBS));
-	outData.instanceCountPerBS_.resize(bsCount);
-	outData.states_.resize(bsCount);
-
-	// clear some memory since we already don't need it
-	enttWithBS.clear();
-	hashesWithBS.clear();
-	bsCodes.clear();
-
-	// put entts ids into one array in sorted order by blending states
-    for (int i = 0; const auto & it : bsToIdxs)
-        outData.ids_.append_vector(it.second);
-
-	// store instances count per blending state
-	for (int i = 0; const auto& it : bsToIdxs)
-		outData.instanceCountPerBS_[i++] = it.second.size();
+	RenderStates& comp = *pRSComponent_;
 
-	// store blending states
-	for (int i = 0; const auto & it : bsToIdxs)
-		outData.states_[i++] = it.first;
+	for (const index idx : idxs)
+		comp.buckets_[idx] = ComputeBucket(comp.statesHashes_[idx]);
 }
 
 ///////////////////////////////////////////////////////////
@@ -405,7 +383,7 @@ void RenderStatesSystem::UpdateRecords(
 	cvector<u32> rsHashes(std::ssize(ids));
     cvector<index> idxs;
 
-    comp.ids_.get_idxs(ids, idxs);
+    comp.sparseIdxs_.GetIdxs(ids, idxs, 0);
 
 	// get render states hashes related to the input entts
 	for (int i = 0; const index idx : idxs)
@@ -416,6 +394,8 @@ void RenderStatesSystem::UpdateRecords(
 	// store updated render states hashes by idxs
 	for (int i = 0; const index idx : idxs)
 		comp.statesHashes_[idx] = rsHashes[i++];
+
+	UpdateBuckets(idxs);
 }
 
 ///////////////////////////////////////////////////////////
@@ -8,8 +8,8 @@
 #pragma once
 
 #include "../Components/RenderStates.h"
+#include "../Common/WorldFile.h"
 #include <cvector.h>
-#include <map>
 
 
 namespace ECS
@@ -28,6 +28,7 @@ public:
 		EnttsBlended       enttsBlended_;
 		EnttsReflection    enttsReflection_;
 		EnttsFarThanFog    enttsFogged_;
+		EnttsImpostors     enttsImpostors_;
 		
 		void Clear()
 		{
@@ -36,6 +37,7 @@ public:
 			enttsBlended_.Clear();
 			enttsReflection_.Clear();
             enttsFogged_.Clear();
+            enttsImpostors_.Clear();
 		}
 	};
 
@@ -43,6 +45,9 @@ public:
 	RenderStatesSystem(RenderStates* pRenderStatesComponent);
 	~RenderStatesSystem();
 
+	void Serialize(WorldFileWriter& writer);
+	bool Deserialize(WorldFileReader& reader);
+
 	// restrict a copying of this class instance 
 	RenderStatesSystem(const RenderStatesSystem& obj) = delete;
 	RenderStatesSystem& operator=(const RenderStatesSystem& obj) = delete;
@@ -50,6 +55,7 @@ public:
 	// ---------------------------------------------
 
     void AddWithDefaultStates(const EntityID* ids, const size numEntts);
+    void RemoveRecords       (const EntityID* ids, const size numEntts);
 
 	// update:
 	// 1. one state of single entt
@@ -84,30 +90,8 @@ private:
 		const cvector<ptrdiff_t>& idxs,
 		cvector<EntityID>& outIds);
 
-	void GetEnttsWithDefaultRS(
-		const cvector<EntityID>& ids,
-		const cvector<u32>& hashes,
-		EnttsDefaultState& outData);
-
-	void GetEnttsWithAlphaClipCullNone(
-		const cvector<EntityID>& ids,
-		const cvector<u32>& hashes,
-		EnttsAlphaClipping& outData);
-
-	void FilterEnttsOnlyBlending(
-		const cvector<EntityID>& ids,
-		const cvector<u32>& hashes,
-		cvector<EntityID>& enttWithBS,
-		cvector<u32>& hashesWithBS);
-
-	void GetBlendingStatesByHashes(
-		const cvector<u32>& hashes,
-		cvector<eRenderState>& blendStates);
-
-	void GetEnttsBlended(
-		const cvector<EntityID>& ids,
-		const cvector<u32>& hashes,
-		EnttsBlended& outData);
+	uint8 ComputeBucket(const u32 hash) const;
+	void  UpdateBuckets(const cvector<index>& idxs);
 
 	void UpdateRecords(
 		const cvector<EntityID>& ids,
@@ -139,6 +123,7 @@ private:
 	u32 defaultRSMask_ = 0;                          // default render states hash mask
 	u32 alphaClipCullNoneMask_ = 0;                  
 	u32 blendingRSMask_ = 0;                         // blending render states hash mask
+	u32 defaultNoBlendingMask_ = 0;                  // default render states but without NO_BLENDING
 
 	// a specific hash to define if entt has any not default render state
 	//u32 specRenderStatesTypes_ = 0;
@@ -152,9 +137,10 @@ private:
 	u32 disableAllAlphaClippingMask_ = UINT32_MAX;
 	u32 disableAllBlendingMask_      = UINT32_MAX;
 	u32 disableAllReflectionMask_ = UINT32_MAX;
-	
-	std::map<u32, eRenderState> hashesToRS_;   // hashes to RASTER states
-	std::map<u32, eRenderState> hashesToBS_;   // hashes to BLENDING states
+
+
+	cvector<index> s_Idxs;
+	cvector<uint8> s_Buckets;
 };
 
 
@@ -22,22 +22,103 @@ RenderSystem::RenderSystem(Rendered* pRenderComponent) :
     comp.ids.reserve(newCapacity);
     comp.shaderTypes.reserve(newCapacity);
     comp.primTopologies.reserve(newCapacity);
+    comp.lods.reserve(newCapacity);
+    comp.smallCullFactors.reserve(newCapacity);
+    comp.staticFlags.reserve(newCapacity);
+    comp.mergedInto.reserve(newCapacity);
+    comp.reflectFlags.reserve(newCapacity);
 }
 
 
 // =================================================================================
 //                            PUBLIC METHODS
 // =================================================================================
-void RenderSystem::Serialize(std::ofstream& fout, u32& offset)
+void RenderSystem::Serialize(WorldFileWriter& writer)
 {
     // serialize all the data from the Rendered component into the data file
+
+    const Rendered& comp = *pRenderComponent_;
+
+    writer.BeginChunk(RenderedComponent, 5);
+    writer.WriteArray(comp.ids);
+    writer.WriteArray(comp.shaderTypes);
+    writer.WriteArray(comp.primTopologies);
+    writer.WriteArray(comp.smallCullFactors);
+    writer.WriteArray(comp.staticFlags);
+    writer.WriteArray(comp.mergedInto);
+    writer.WriteArray(comp.reflectFlags);
+    writer.EndChunk();
 }
 
 /////////////////////////////////////////////////
 
-void RenderSystem::Deserialize(std::ifstream& fin, const u32 offset)
+bool RenderSystem::Deserialize(WorldFileReader& reader)
 {
     // deserialize the data from the data file into the Rendered component
+
+    Rendered& comp = *pRenderComponent_;
+
+    if (!reader.BeginChunk(RenderedComponent))
+    {
+        LogErr("there is no rendering data in the world file");
+        return false;
+    }
+
+    bool result = true;
+    result &= reader.ReadArray(comp.ids);
+    result &= reader.ReadArray(comp.shaderTypes);
+    result &= reader.ReadArray(comp.primTopologies);
+
+    // small feature culling factors were added in the 2nd version
+    if (reader.GetChunkVersion() >= 2)
+        result &= reader.ReadArray(comp.smallCullFactors);
+    else
+        comp.smallCullFactors.resize(comp.ids.size(), 1.0f);
+
+    // static flags were added in the 3rd version
+    if (reader.GetChunkVersion() >= 3)
+        result &= reader.ReadArray(comp.staticFlags);
+    else
+        comp.staticFlags.resize(comp.ids.size(), 0);
+
+    // merging of static props into cells was added in the 4th version
+    if (reader.GetChunkVersion() >= 4)
+        result &= reader.ReadArray(comp.mergedInto);
+    else
+        comp.mergedInto.resize(comp.ids.size(), INVALID_ENTITY_ID);
+
+    // casters of the planar reflection were added in the 5th version
+    if (reader.GetChunkVersion() >= 5)
+        result &= reader.ReadArray(comp.reflectFlags);
+    else
+        comp.reflectFlags.resize(comp.ids.size(), 0);
+
+    result &= (comp.shaderTypes.size()      == comp.ids.size());
+    result &= (comp.primTopologies.size()   == comp.ids.size());
+    result &= (comp.smallCullFactors.size() == comp.ids.size());
+    result &= (comp.staticFlags.size()      == comp.ids.size());
+    result &= (comp.mergedInto.size()       == comp.ids.size());
+    result &= (comp.reflectFlags.size()     == comp.ids.size());
+
+    if (!result)
+    {
+        LogErr("rendering data in the world file is corrupted");
+        return false;
+    }
+
+    comp.lods.resize(comp.ids.size());
+    memset(comp.lods.data(), 0, comp.lods.size());
+    ++comp.staticVersion;
+    ++comp.reflectVersion;
+
+    comp.visibleEnttsIDs.clear();
+    comp.visiblePointLightsIDs.clear();
+    comp.visibleSpotLightsIDs.clear();
+
+    comp.sparseIdxs.Clear();
+    comp.sparseIdxs.Rebuild(comp.ids);
+
+    return true;
 }
 
 /////////////////////////////////////////////////
@@ -57,28 +138,58 @@ void RenderSystem::AddRecords(
     Rendered& comp = *pRenderComponent_;
     cvector<index> idxs;
 
-    comp.ids.get_insert_idxs(ids, numEntts, idxs);
+    // merge ids in a single pass and get the final idx of each new record
+    comp.ids.merge_sorted(ids, numEntts, idxs);
 
-    // exec indices correction
-    for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
+    cvector<RenderShaderType>         shaderTypes(numEntts);
+    cvector<D3D11_PRIMITIVE_TOPOLOGY> primTopologies(numEntts);
 
-    // execute sorted insertion of input values
     for (index i = 0; i < numEntts; ++i)
-        comp.ids.insert_before(idxs[i], ids[i]);
+    {
+        shaderTypes[i]    = params[i].shaderType;
+        primTopologies[i] = params[i].topologyType;
+    }
 
-    for (index i = 0; i < numEntts; ++i)
-        comp.shaderTypes.insert_before(idxs[i], params[i].shaderType);
+    comp.shaderTypes.insert_by_idxs(idxs, shaderTypes.data());
+    comp.primTopologies.insert_by_idxs(idxs, primTopologies.data());
+    comp.lods.insert_by_idxs(idxs, uint8(0));
+    comp.smallCullFactors.insert_by_idxs(idxs, 1.0f);
+    comp.staticFlags.insert_by_idxs(idxs, uint8(0));
+    comp.mergedInto.insert_by_idxs(idxs, INVALID_ENTITY_ID);
+    comp.reflectFlags.insert_by_idxs(idxs, uint8(0));
 
-    for (index i = 0; i < numEntts; ++i)
-        comp.primTopologies.insert_before(idxs[i], params[i].topologyType);
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
 }
 
 /////////////////////////////////////////////////
 
 void RenderSystem::RemoveRecords(const EntityID* ids, const size numEntts)
 {
-    assert(0 && "TODO");
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Rendered& comp = *pRenderComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    comp.ids.erase_by_idxs(idxs);
+    comp.shaderTypes.erase_by_idxs(idxs);
+    comp.primTopologies.erase_by_idxs(idxs);
+    comp.lods.erase_by_idxs(idxs);
+    comp.smallCullFactors.erase_by_idxs(idxs);
+    comp.staticFlags.erase_by_idxs(idxs);
+    comp.mergedInto.erase_by_idxs(idxs);
+    comp.reflectFlags.erase_by_idxs(idxs);
+    ++comp.reflectVersion;
+
+    comp.sparseIdxs.Remove(ids, numEntts);
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
 }
 
 /////////////////////////////////////////////////
@@ -96,6 +207,188 @@ void RenderSystem::GetRenderingDataOfEntts(
     GetShaderTypesOfEntts(ids, numEntts, outShaderTypes);
 }
 
+/////////////////////////////////////////////////
+
+void RenderSystem::SetSmallCullFactor(const EntityID* ids, const size numEntts, const float factor)
+{
+    // setup a scale of the small feature culling threshold for input entts:
+    // > 1 - culled earlier (small props), 0 - never culled by the projected size
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+    CAssert::True(factor >= 0.0f, "small culling factor must be >= 0");
+
+    Rendered& comp = *pRenderComponent_;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index idx = comp.sparseIdxs.GetIdx(ids[i]);
+
+        if (idx != SparseSet::INVALID_IDX)
+            comp.smallCullFactors[idx] = factor;
+    }
+}
+
+/////////////////////////////////////////////////
+
+void RenderSystem::SetStatic(const EntityID* ids, const size numEntts, const bool isStatic)
+{
+    // mark input entts as static (or dynamic); the renderer rebuilds
+    // its static batches when the version of flags is changed
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Rendered&   comp = *pRenderComponent_;
+    const uint8 flag = (isStatic) ? 1 : 0;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index idx = comp.sparseIdxs.GetIdx(ids[i]);
+
+        if ((idx != SparseSet::INVALID_IDX) && (comp.staticFlags[idx] != flag))
+        {
+            comp.staticFlags[idx] = flag;
+            ++comp.staticVersion;
+        }
+    }
+}
+
+/////////////////////////////////////////////////
+
+void RenderSystem::GetStaticEntts(cvector<EntityID>& outIds) const
+{
+    // get IDs of all the static entts (sorted)
+
+    const Rendered& comp = *pRenderComponent_;
+    outIds.clear();
+
+    for (index i = 0; i < comp.ids.size(); ++i)
+    {
+        if (comp.staticFlags[i])
+            outIds.push_back(comp.ids[i]);
+    }
+}
+
+/////////////////////////////////////////////////
+
+void RenderSystem::SetMergedInto(const EntityID* ids, const size numEntts, const EntityID cellID)
+{
+    // set that input entts are rendered by the merged mesh of the cell entt
+    // (INVALID_ENTITY_ID - each entt is rendered by itself again)
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Rendered& comp = *pRenderComponent_;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index idx = comp.sparseIdxs.GetIdx(ids[i]);
+
+        if (idx != SparseSet::INVALID_IDX)
+            comp.mergedInto[idx] = cellID;
+    }
+}
+
+/////////////////////////////////////////////////
+
+void RenderSystem::GetMergedEntts(cvector<EntityID>& outIds, cvector<EntityID>& outCellsIDs) const
+{
+    // get IDs of all the merged entts (sorted) and a cell of each of them
+
+    const Rendered& comp = *pRenderComponent_;
+    outIds.clear();
+    outCellsIDs.clear();
+
+    for (index i = 0; i < comp.ids.size(); ++i)
+    {
+        if (comp.mergedInto[i] != INVALID_ENTITY_ID)
+        {
+            outIds.push_back(comp.ids[i]);
+            outCellsIDs.push_back(comp.mergedInto[i]);
+        }
+    }
+}
+
+/////////////////////////////////////////////////
+
+EntityID RenderSystem::GetMergedInto(const EntityID id) const
+{
+    // get a cell entt which renders input entt (or INVALID_ENTITY_ID if it isn't merged)
+
+    const Rendered& comp = *pRenderComponent_;
+    const index     idx  = comp.sparseIdxs.GetIdx(id);
+
+    return (idx != SparseSet::INVALID_IDX) ? comp.mergedInto[idx] : INVALID_ENTITY_ID;
+}
+
+/////////////////////////////////////////////////
+
+void RenderSystem::SetReflectionCaster(const EntityID* ids, const size numEntts, const bool isCaster)
+{
+    // mark input entts as casters of the planar reflection (or not); the renderer
+    // refreshes its list of casters when the version of flags is changed
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Rendered&   comp = *pRenderComponent_;
+    const uint8 flag = (isCaster) ? 1 : 0;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index idx = comp.sparseIdxs.GetIdx(ids[i]);
+
+        if ((idx != SparseSet::INVALID_IDX) && (comp.reflectFlags[idx] != flag))
+        {
+            comp.reflectFlags[idx] = flag;
+            ++comp.reflectVersion;
+        }
+    }
+}
+
+/////////////////////////////////////////////////
+
+void RenderSystem::GetReflectionCasters(cvector<EntityID>& outIds) const
+{
+    // get IDs of all the casters of the planar reflection (sorted)
+
+    const Rendered& comp = *pRenderComponent_;
+    outIds.clear();
+
+    for (index i = 0; i < comp.ids.size(); ++i)
+    {
+        if (comp.reflectFlags[i])
+            outIds.push_back(comp.ids[i]);
+    }
+}
+
+/////////////////////////////////////////////////
+
+void RenderSystem::SetLods(const EntityID* ids, const uint8* lods, const size numEntts)
+{
+    // store levels of detail which were selected for input entts
+
+    CAssert::True((ids != nullptr) && (lods != nullptr), "invalid input args");
+
+    Rendered& comp = *pRenderComponent_;
+
+    for (index i = 0; i < numEntts; ++i)
+        comp.lods[comp.sparseIdxs.GetIdx(ids[i])] = lods[i];
+}
+
+/////////////////////////////////////////////////
+
+void RenderSystem::GetLods(const EntityID* ids, const size numEntts, cvector<uint8>& outLods) const
+{
+    // get the current level of detail of each input entt
+
+    CAssert::True(ids != nullptr, "input ptr to entities IDs arr == nullptr");
+
+    const Rendered& comp = *pRenderComponent_;
+    outLods.resize(numEntts);
+
+    for (index i = 0; i < numEntts; ++i)
+        outLods[i] = comp.lods[comp.sparseIdxs.GetIdx(ids[i])];
+}
+
 
 // =================================================================================
 //                           PRIVATE METHODS
@@ -115,7 +408,7 @@ void RenderSystem::GetShaderTypesOfEntts(
 
 
     // get index into array of each input entity by ID
-    comp.ids.get_idxs(ids, numEntts, idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
    
     // get shader type of each input entity
     outShaderTypes.resize(numEntts);
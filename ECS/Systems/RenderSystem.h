@@ -7,6 +7,7 @@
 #pragma once
 
 #include "../Components/Rendered.h"
+#include "../Common/WorldFile.h"
 
 namespace ECS
 {
@@ -18,8 +19,8 @@ public:
 
     ~RenderSystem() {}
 
-    void Serialize(std::ofstream& fout, u32& offset);
-    void Deserialize(std::ifstream& fin, const u32 offset);
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
 
     void AddRecords(
         const EntityID* ids,
@@ -33,6 +34,30 @@ public:
         const size numEntts,
         cvector<ECS::RenderShaderType>& outShaderTypes);
 
+    void SetSmallCullFactor(const EntityID* ids, const size numEntts, const float factor);
+
+    // static entts are rendered from batches which are kept on GPU (they are
+    // rebuilt if any static entt is moved so mark only entts which never move)
+    void SetStatic(const EntityID* ids, const size numEntts, const bool isStatic);
+    void GetStaticEntts(cvector<EntityID>& outIds) const;
+    inline uint32 GetStaticVersion() const { return pRenderComponent_->staticVersion; }
+
+    // merged static props: an entt which is merged into a cell isn't culled and
+    // rendered by itself (the cell entt renders it) but it is kept for editing
+    void SetMergedInto(const EntityID* ids, const size numEntts, const EntityID cellID);
+    void GetMergedEntts(cvector<EntityID>& outIds, cvector<EntityID>& outCellsIDs) const;
+    EntityID GetMergedInto(const EntityID id) const;
+
+    // only flagged entts are rendered into the planar reflection (so a mirror
+    // costs only by the content which is really seen in it)
+    void SetReflectionCaster(const EntityID* ids, const size numEntts, const bool isCaster);
+    void GetReflectionCasters(cvector<EntityID>& outIds) const;
+    inline uint32 GetReflectionVersion() const { return pRenderComponent_->reflectVersion; }
+
+    // levels of detail of entts (are selected by the renderer during culling)
+    void SetLods(const EntityID* ids, const uint8* lods, const size numEntts);
+    void GetLods(const EntityID* ids, const size numEntts, cvector<uint8>& outLods) const;
+
 
     // clear an arr of entities that were visible in the previous frame;
     // so we will be able to use it again for the current frame;
@@ -40,12 +65,17 @@ public:
 
     // clear the array of visible light sources (were visible in the prev frame);
     // so we will be able to use it again for the current frame;
-    inline void ClearVisibleLightSources() { pRenderComponent_->visiblePointLightsIDs.clear(); }
+    inline void ClearVisibleLightSources()
+    {
+        pRenderComponent_->visiblePointLightsIDs.clear();
+        pRenderComponent_->visibleSpotLightsIDs.clear();
+    }
 
 
     // for debug/unit-test purposes
     inline const cvector<EntityID>& GetAllEnttsIDs()  const { return pRenderComponent_->ids; }
     inline cvector<EntityID>& GetVisiblePointLights() const { return pRenderComponent_->visiblePointLightsIDs; }
+    inline cvector<EntityID>& GetVisibleSpotLights()  const { return pRenderComponent_->visibleSpotLightsIDs; }
     
 
     inline void SetVisibleEntts(const cvector<EntityID>& inEntts)       { pRenderComponent_->visibleEnttsIDs = inEntts; }
@@ -0,0 +1,241 @@
+// =================================================================================
+// Filename:     SoundSystem.cpp
+// Description:  implementation of the SoundSystem's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "SoundSystem.h"
+
+
+namespace ECS
+{
+
+SoundSystem::SoundSystem(
+    SoundEmitter* pEmitterComponent,
+    TransformSystem* pTransformSys,
+    CameraSystem* pCameraSys)
+{
+    CAssert::NotNullptr(pEmitterComponent, "ptr to the SoundEmitter component == nullptr");
+    CAssert::NotNullptr(pTransformSys,     "ptr to the transform system == nullptr");
+    CAssert::NotNullptr(pCameraSys,        "ptr to the camera system == nullptr");
+
+    pEmitterComponent_ = pEmitterComponent;
+    pTransformSys_     = pTransformSys;
+    pCameraSys_        = pCameraSys;
+}
+
+
+// ================================================================================
+//                PUBLIC SERIALIZATION / DESERIALIZATION API
+// ================================================================================
+void SoundSystem::Serialize(WorldFileWriter& writer)
+{
+    const SoundEmitter& comp = *pEmitterComponent_;
+
+    writer.BeginChunk(SoundEmitterComponent);
+    writer.WriteArray(comp.ids_);
+    writer.WriteArray(comp.soundIds_);
+    writer.WriteArray(comp.volumes_);
+    writer.WriteArray(comp.minDists_);
+    writer.WriteArray(comp.maxDists_);
+    writer.WriteArray(comp.priorities_);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool SoundSystem::Deserialize(WorldFileReader& reader)
+{
+    SoundEmitter& comp = *pEmitterComponent_;
+
+    // world files which were saved before sound emitters have no such chunk
+    if (!reader.BeginChunk(SoundEmitterComponent))
+    {
+        comp.ids_.clear();
+        comp.soundIds_.clear();
+        comp.volumes_.clear();
+        comp.minDists_.clear();
+        comp.maxDists_.clear();
+        comp.priorities_.clear();
+        comp.sparseIdxs_.Clear();
+        return true;
+    }
+
+    bool result = true;
+    result &= reader.ReadArray(comp.ids_);
+    result &= reader.ReadArray(comp.soundIds_);
+    result &= reader.ReadArray(comp.volumes_);
+    result &= reader.ReadArray(comp.minDists_);
+    result &= reader.ReadArray(comp.maxDists_);
+    result &= reader.ReadArray(comp.priorities_);
+
+    result &= (comp.soundIds_.size()   == comp.ids_.size());
+    result &= (comp.volumes_.size()    == comp.ids_.size());
+    result &= (comp.minDists_.size()   == comp.ids_.size());
+    result &= (comp.maxDists_.size()   == comp.ids_.size());
+    result &= (comp.priorities_.size() == comp.ids_.size());
+
+    if (!result)
+    {
+        LogErr("sound emitters data in the world file is corrupted");
+        return false;
+    }
+
+    comp.sparseIdxs_.Clear();
+    comp.sparseIdxs_.Rebuild(comp.ids_);
+
+    return true;
+}
+
+
+// ================================================================================
+//                              PUBLIC UPDATING API
+// ================================================================================
+void SoundSystem::Update()
+{
+    const SoundEmitter& comp     = *pEmitterComponent_;
+    const size          numEntts = comp.ids_.size();
+
+    audible_.clear();
+
+    if ((numEntts == 0) || !pCameraSys_->HasEntity(listenerID_))
+        return;
+
+    using namespace DirectX;
+
+    pTransformSys_->GetPositions(comp.ids_.data(), numEntts, positions_);
+
+    const XMFLOAT3 listenerPos = pCameraSys_->GetPos(listenerID_);
+    XMFLOAT3       right;
+    XMStoreFloat3(&right, XMVector3Normalize(pCameraSys_->GetRightVec(listenerID_)));
+
+    gains_.resize_uninitialized(numEntts);
+    pans_.resize_uninitialized(numEntts);
+    candidates_.clear();
+
+    // the batched pass: attenuation and panning of all the emitters;
+    // an emitter is culled before it can take a voice if it isn't heard
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const float dx     = positions_[i].x - listenerPos.x;
+        const float dy     = positions_[i].y - listenerPos.y;
+        const float dz     = positions_[i].z - listenerPos.z;
+        const float distSq = dx*dx + dy*dy + dz*dz;
+        const float maxD   = comp.maxDists_[i];
+
+        if (distSq >= maxD * maxD)
+            continue;
+
+        const float dist = sqrtf(distSq);
+        const float minD = comp.minDists_[i];
+
+        // full volume within the min distance, a quadratic fade to zero at the max one
+        float t = (maxD > minD) ? (maxD - dist) / (maxD - minD) : 1.0f;
+        t = (t > 1.0f) ? 1.0f : t;
+
+        const float gain = comp.volumes_[i] * t * t;
+
+        if (gain < MIN_GAIN)
+            continue;
+
+        // panning by the side to the listener (a sound at the listener is centered)
+        const float invDist = (dist > 1e-4f) ? 1.0f / dist : 0.0f;
+
+        gains_[i] = gain;
+        pans_[i]  = (dx*right.x + dy*right.y + dz*right.z) * invDist;
+        candidates_.push_back(i);
+    }
+
+    // voice priority: keep only the most important emitters (priority, then gain)
+    const auto isMoreImportant = [&comp, this](const index a, const index b)
+    {
+        if (comp.priorities_[a] != comp.priorities_[b])
+            return comp.priorities_[a] > comp.priorities_[b];
+
+        return gains_[a] > gains_[b];
+    };
+
+    size numAudible = candidates_.size();
+
+    if (numAudible > MAX_AUDIBLE)
+    {
+        std::nth_element(candidates_.begin(), candidates_.begin() + MAX_AUDIBLE, candidates_.end(), isMoreImportant);
+        numAudible = MAX_AUDIBLE;
+    }
+
+    audible_.ids.resize(numAudible);
+    audible_.soundIds.resize(numAudible);
+    audible_.gains.resize(numAudible);
+    audible_.pans.resize(numAudible);
+
+    for (index i = 0; i < numAudible; ++i)
+    {
+        const index idx = candidates_[i];
+
+        audible_.ids[i]      = comp.ids_[idx];
+        audible_.soundIds[i] = comp.soundIds_[idx];
+        audible_.gains[i]    = gains_[idx];
+        audible_.pans[i]     = pans_[idx];
+    }
+}
+
+
+// ================================================================================
+//                      PUBLIC CREATION / DELETING API
+// ================================================================================
+void SoundSystem::AddRecords(
+    const EntityID* ids,
+    const uint32* soundIds,
+    const float* volumes,
+    const float* minDists,
+    const float* maxDists,
+    const uint8* priorities,
+    const size numEntts)
+{
+    CAssert::True(ids && soundIds && volumes && minDists && maxDists && priorities, "some of input ptrs == nullptr");
+    CAssert::True(numEntts > 0, "input number of entts must be > 0");
+
+    SoundEmitter& comp = *pEmitterComponent_;
+
+    // execute sorted insertion into the data arrays
+    cvector<index> idxs;
+    comp.ids_.merge_sorted(ids, numEntts, idxs);
+    comp.soundIds_.insert_by_idxs(idxs, soundIds);
+    comp.volumes_.insert_by_idxs(idxs, volumes);
+    comp.minDists_.insert_by_idxs(idxs, minDists);
+    comp.maxDists_.insert_by_idxs(idxs, maxDists);
+    comp.priorities_.insert_by_idxs(idxs, priorities);
+
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+}
+
+///////////////////////////////////////////////////////////
+
+void SoundSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    SoundEmitter& comp = *pEmitterComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs_.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    comp.ids_.erase_by_idxs(idxs);
+    comp.soundIds_.erase_by_idxs(idxs);
+    comp.volumes_.erase_by_idxs(idxs);
+    comp.minDists_.erase_by_idxs(idxs);
+    comp.maxDists_.erase_by_idxs(idxs);
+    comp.priorities_.erase_by_idxs(idxs);
+
+    comp.sparseIdxs_.Remove(ids, numEntts);
+    comp.sparseIdxs_.Rebuild(comp.ids_, idxs[0]);
+}
+
+} // namespace ECS
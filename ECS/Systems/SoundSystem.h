@@ -0,0 +1,103 @@
+// =================================================================================
+// Filename:     SoundSystem.h
+// Description:  Entity-Component-System (ECS) system for positional sounds:
+//
+//               - a single batched pass over all the emitters computes gains
+//                 (by distance attenuation) and panning relatively to the listener
+//                 (a camera); emitters beyond their max distance are culled;
+//               - only MAX_AUDIBLE emitters with the highest priorities (then
+//                 gains) are output so hundreds of emitters take voices (and
+//                 mixing) only for what is really heard;
+//               - the system doesn't play anything itself: the audio backend
+//                 takes the audible list after the update
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Components/SoundEmitter.h"
+#include "../Common/WorldFile.h"
+#include "TransformSystem.h"
+#include "CameraSystem.h"
+
+
+namespace ECS
+{
+
+// emitters which are heard (the output of the update)
+struct AudibleEmitters
+{
+    cvector<EntityID> ids;
+    cvector<uint32>   soundIds;
+    cvector<float>    gains;                      // [0, 1]
+    cvector<float>    pans;                       // [-1 (left), 1 (right)]
+
+    inline void clear()
+    {
+        ids.clear();
+        soundIds.clear();
+        gains.clear();
+        pans.clear();
+    }
+};
+
+///////////////////////////////////////////////////////////
+
+class SoundSystem final
+{
+public:
+    static constexpr int   MAX_AUDIBLE = 32;      // max number of emitters which take voices at once
+    static constexpr float MIN_GAIN    = 0.001f;  // quieter emitters are culled
+
+    SoundSystem(SoundEmitter* pEmitterComponent, TransformSystem* pTransformSys, CameraSystem* pCameraSys);
+    ~SoundSystem() {}
+
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
+    // components accessed during the update (is used by the update scheduler)
+    static constexpr ComponentBitfield UPDATE_READS  =
+        GetComponentBit(SoundEmitterComponent) |
+        GetComponentBit(TransformComponent)    |
+        GetComponentBit(CameraComponent);
+    static constexpr ComponentBitfield UPDATE_WRITES = 0;
+
+    // compute the audible list for the current listener
+    void Update();
+
+    // NOTE: ids must be SORTED
+    void AddRecords(
+        const EntityID* ids,
+        const uint32* soundIds,
+        const float* volumes,
+        const float* minDists,
+        const float* maxDists,
+        const uint8* priorities,
+        const size numEntts);
+
+    void RemoveRecords(const EntityID* ids, const size numEntts);
+
+    inline bool HasEntity(const EntityID id) const { return pEmitterComponent_->sparseIdxs_.Has(id); }
+
+    // sounds are heard by this camera entity
+    inline void     SetListener(const EntityID cameraID)       { listenerID_ = cameraID; }
+    inline EntityID GetListener()                        const { return listenerID_; }
+
+    inline const AudibleEmitters& GetAudibleEmitters()   const { return audible_; }
+
+private:
+    SoundEmitter*     pEmitterComponent_ = nullptr;
+    TransformSystem*  pTransformSys_     = nullptr;
+    CameraSystem*     pCameraSys_        = nullptr;
+    EntityID          listenerID_        = INVALID_ENTITY_ID;
+
+    // update buffers (are kept between updates so they aren't reallocated)
+    cvector<XMFLOAT3> positions_;
+    cvector<float>    gains_;
+    cvector<float>    pans_;
+    cvector<index>    candidates_;                // idxs of emitters which aren't culled
+
+    AudibleEmitters   audible_;
+};
+
+} // namespace ECS
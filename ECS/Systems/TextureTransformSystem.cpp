@@ -18,6 +18,94 @@ TextureTransformSystem::TextureTransformSystem(TextureTransform* pTexTransformCo
 }
 
 
+// *********************************************************************************
+//                      SERIALIZATION / DESERIALIZATION
+// *********************************************************************************
+void TextureTransformSystem::Serialize(WorldFileWriter& writer)
+{
+    const TextureTransform& comp = *pTexTransformComponent_;
+
+    writer.BeginChunk(TextureTransformComponent);
+    writer.WriteArray(comp.ids);
+    writer.WriteArray(comp.transformTypes);
+    writer.WriteArray(comp.texTransforms);
+
+    writer.WriteArray(comp.texStaticTrans.ids);
+    writer.WriteArray(comp.texStaticTrans.transformations);
+
+    writer.WriteArray(comp.texAtlasAnim.ids);
+    writer.WriteArray(comp.texAtlasAnim.timeSteps);
+    writer.WriteArray(comp.texAtlasAnim.currAnimTime);
+    writer.WriteArray(comp.texAtlasAnim.data);
+
+    writer.WriteArray(comp.texRotations.ids);
+    writer.WriteArray(comp.texRotations.texCoords);
+    writer.WriteArray(comp.texRotations.rotationsSpeed);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool TextureTransformSystem::Deserialize(WorldFileReader& reader)
+{
+    TextureTransform& comp = *pTexTransformComponent_;
+
+    if (!reader.BeginChunk(TextureTransformComponent))
+    {
+        LogErr("there is no texture transformations data in the world file");
+        return false;
+    }
+
+    TexStaticTransformations& statics   = comp.texStaticTrans;
+    TexAtlasAnimations&       atlasAnim = comp.texAtlasAnim;
+    TexRotationsAroundCoords& rotations = comp.texRotations;
+
+    bool result = true;
+    result &= reader.ReadArray(comp.ids);
+    result &= reader.ReadArray(comp.transformTypes);
+    result &= reader.ReadArray(comp.texTransforms);
+
+    result &= reader.ReadArray(statics.ids);
+    result &= reader.ReadArray(statics.transformations);
+
+    result &= reader.ReadArray(atlasAnim.ids);
+    result &= reader.ReadArray(atlasAnim.timeSteps);
+    result &= reader.ReadArray(atlasAnim.currAnimTime);
+    result &= reader.ReadArray(atlasAnim.data);
+
+    result &= reader.ReadArray(rotations.ids);
+    result &= reader.ReadArray(rotations.texCoords);
+    result &= reader.ReadArray(rotations.rotationsSpeed);
+
+    result &= (comp.ids.size() > 0) && (comp.ids[0] == INVALID_ENTITY_ID);
+    result &= (comp.transformTypes.size()     == comp.ids.size());
+    result &= (comp.texTransforms.size()      == comp.ids.size());
+    result &= (statics.transformations.size() == statics.ids.size());
+    result &= (atlasAnim.timeSteps.size()     == atlasAnim.ids.size());
+    result &= (atlasAnim.currAnimTime.size()  == atlasAnim.ids.size());
+    result &= (atlasAnim.data.size()          == atlasAnim.ids.size());
+    result &= (rotations.texCoords.size()     == rotations.ids.size());
+    result &= (rotations.rotationsSpeed.size()== rotations.ids.size());
+
+    if (!result)
+    {
+        LogErr("texture transformations data in the world file is corrupted");
+        return false;
+    }
+
+    comp.sparseIdxs.Clear();
+    comp.sparseIdxs.Rebuild(comp.ids);
+
+    // the stored transformations could be made in another mode of animations
+    if (isGpuTexAnimations_)
+        PackGpuTexAnimations();
+    else
+        ResetCpuTexAnimations();
+
+    return true;
+}
+
+
 // *********************************************************************************
 //                               PUBLIC METHODS
 // *********************************************************************************
@@ -46,10 +134,89 @@ void TextureTransformSystem::AddTexTransformation(
 
 ///////////////////////////////////////////////////////////
 
+void GetIdxsInSortedArr(
+    const cvector<EntityID>& sortedIds,
+    const EntityID* ids,
+    const size numEntts,
+    cvector<index>& outIdxs)
+{
+    // out: SORTED idxs of input entts which are in the sorted array
+
+    outIdxs.clear();
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const EntityID* it = std::lower_bound(sortedIds.begin(), sortedIds.end(), ids[i]);
+
+        if ((it != sortedIds.end()) && (*it == ids[i]))
+            outIdxs.push_back(it - sortedIds.begin());
+    }
+
+    std::sort(outIdxs.begin(), outIdxs.end());
+    outIdxs.resize(std::unique(outIdxs.begin(), outIdxs.end()) - outIdxs.begin());
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureTransformSystem::RemoveRecords(const EntityID* ids, const size numEntts)
+{
+    // remove texture transformations of input entts (if they have any);
+    // each data array is compacted with a single pass so it remains SORTED
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    TextureTransform& comp = *pTexTransformComponent_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    comp.ids.erase_by_idxs(idxs);
+    comp.transformTypes.erase_by_idxs(idxs);
+    comp.texTransforms.erase_by_idxs(idxs);
+
+    comp.sparseIdxs.Remove(ids, numEntts);
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
+
+    // remove specific data of each kind of transformation
+    TexStaticTransformations& statics = comp.texStaticTrans;
+    GetIdxsInSortedArr(statics.ids, ids, numEntts, idxs);
+    statics.ids.erase_by_idxs(idxs);
+    statics.transformations.erase_by_idxs(idxs);
+
+    TexAtlasAnimations& atlasAnim = comp.texAtlasAnim;
+    GetIdxsInSortedArr(atlasAnim.ids, ids, numEntts, idxs);
+    atlasAnim.ids.erase_by_idxs(idxs);
+    atlasAnim.timeSteps.erase_by_idxs(idxs);
+    atlasAnim.currAnimTime.erase_by_idxs(idxs);
+    atlasAnim.data.erase_by_idxs(idxs);
+
+    TexRotationsAroundCoords& rotations = comp.texRotations;
+    GetIdxsInSortedArr(rotations.ids, ids, numEntts, idxs);
+    rotations.ids.erase_by_idxs(idxs);
+    rotations.texCoords.erase_by_idxs(idxs);
+    rotations.rotationsSpeed.erase_by_idxs(idxs);
+}
+
+///////////////////////////////////////////////////////////
+
 void TextureTransformSystem::GetTexTransformsForEntts(
     const EntityID* ids,
     const size numEntts,
     cvector<XMMATRIX>& outTexTransforms)
+{
+    outTexTransforms.resize(numEntts);
+    GetTexTransformsForEntts(ids, numEntts, outTexTransforms.data());
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureTransformSystem::GetTexTransformsForEntts(
+    const EntityID* ids,
+    const size numEntts,
+    XMMATRIX* outTexTransforms)
 {
     // what we do here:
     // go through each input entity and define if it has some tex transformation 
@@ -58,21 +225,19 @@ void TextureTransformSystem::GetTexTransformsForEntts(
     // in:    arr of entities IDs
     // out:   arr of texture transformations for these entities
 
-    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+    CAssert::True((ids != nullptr) && (numEntts > 0) && (outTexTransforms != nullptr), "invalid input args");
 
     const TextureTransform& comp = *pTexTransformComponent_;
     cvector<bool> exist(numEntts);
     cvector<index> idxs(numEntts);
 
-    comp.ids.get_idxs(ids, numEntts, idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, idxs);
 
     // get bool flags to define if such entities exist in the component
     for (index i = 0; i < numEntts; ++i)
-        exist[i] = (comp.ids[idxs[i]] == ids[i]);
+        exist[i] = (idxs[i] != SparseSet::INVALID_IDX);
 
     // fill in the output arr with texture transformation matrices
-    outTexTransforms.resize(numEntts);
-
     for (index i = 0; i < numEntts; ++i)
         outTexTransforms[i] = (exist[i]) ? comp.texTransforms[idxs[i]] : DirectX::XMMatrixIdentity();
 }
@@ -84,8 +249,28 @@ void TextureTransformSystem::UpdateAllTextrureAnimations(
     const float deltaTime)
 {
     UpdateTextureStaticTransformation(deltaTime);
-    UpdateTextureAtlasAnimations(deltaTime);
-    UpdateTextureRotations(totalGameTime);
+
+    // in GPU mode these animations are evaluated in the vertex shader
+    if (!isGpuTexAnimations_)
+    {
+        UpdateTextureAtlasAnimations(deltaTime);
+        UpdateTextureRotations(totalGameTime);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureTransformSystem::SetGpuTexAnimations(const bool enable)
+{
+    if (isGpuTexAnimations_ == enable)
+        return;
+
+    isGpuTexAnimations_ = enable;
+
+    if (enable)
+        PackGpuTexAnimations();
+    else
+        ResetCpuTexAnimations();
 }
 
 
@@ -106,38 +291,19 @@ void TextureTransformSystem::AddStaticTexTransform(
     TexStaticTransformations& staticTransf = comp.texStaticTrans;
     const StaticTexTransInitParams& params = static_cast<const StaticTexTransInitParams&>(inParams);
 
-    cvector<index> idxs;
-    comp.ids.get_insert_idxs(ids, numEntts, idxs);
-
-    // exec indices correction
-    for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
-
     // execute sorted insertion of new records into the data arrays
-    for (index i = 0; i < numEntts; ++i)
-        comp.ids.insert_before(idxs[i], ids[i]);
-
-    for (index i = 0; i < numEntts; ++i)
-        comp.transformTypes.insert_before(idxs[i], TexTransformType::STATIC);
+    cvector<index> idxs;
+    comp.ids.merge_sorted(ids, numEntts, idxs);
+    comp.transformTypes.insert_by_idxs(idxs, TexTransformType::STATIC);
+    comp.texTransforms.insert_by_idxs(idxs, params.initTransform.data());
 
-    for (index i = 0; i < numEntts; ++i)
-        comp.texTransforms.insert_before(idxs[i], params.initTransform[i]);
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
 
     // --------------------------------------------------------
 
     // setup specific data for this kind of texture transformation
-    staticTransf.ids.get_insert_idxs(ids, numEntts, idxs);
-
-    // exec indices correction
-    for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
-
-    // execute sorted insertion of values
-    for (index i = 0; i < numEntts; ++i)
-        staticTransf.ids.insert_before(idxs[i], ids[i]);
-
-    for (index i = 0; i < numEntts; ++i)
-        staticTransf.transformations.insert_before(idxs[i], params.texTransforms[i]);
+    staticTransf.ids.merge_sorted(ids, numEntts, idxs);
+    staticTransf.transformations.insert_by_idxs(idxs, params.texTransforms.data());
 }
 
 ///////////////////////////////////////////////////////////
@@ -183,28 +349,26 @@ void TextureTransformSystem::AddAtlasTextureAnimation(
     PrepareAtlasAnimationInitData(numEntts, params, animData);
 
 
-    cvector<index> idxs;
-    comp.ids.get_insert_idxs(ids, numEntts, idxs);
+    // initially we set texture transformation matrix as scaling matrix
+    cvector<XMMATRIX> texTransforms(numEntts);
 
-    // exec indices correction
     for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
-
+        texTransforms[i] = DirectX::XMMatrixScaling(animData[i].texCellWidth, animData[i].texCellHeight, 0);
 
     // execute sorted insertion of data
-    for (index i = 0; i < numEntts; ++i)
-        comp.ids.insert_before(idxs[i], ids[i]);
-
-    for (index i = 0; i < numEntts; ++i)
-        comp.transformTypes.insert_before(idxs[i], TexTransformType::ATLAS_ANIMATION);
+    cvector<index> idxs;
+    comp.ids.merge_sorted(ids, numEntts, idxs);
+    comp.transformTypes.insert_by_idxs(idxs, TexTransformType::ATLAS_ANIMATION);
+    comp.texTransforms.insert_by_idxs(idxs, texTransforms.data());
 
-    // initially we set texture transformation matrix as scaling matrix
-    for (index i = 0; i < numEntts; ++i)
-        comp.texTransforms.insert_before(idxs[i], DirectX::XMMatrixScaling(animData[i].texCellWidth, animData[i].texCellHeight, 0));
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
         
     // store texture transformation (animation) data
     for (index i = 0; i < numEntts; ++i)
        AddAtlasAnimationData(ids[i], animData[i]);
+
+    if (isGpuTexAnimations_)
+        PackGpuTexAnimations();
 }
 
 ///////////////////////////////////////////////////////////
@@ -229,41 +393,25 @@ void TextureTransformSystem::AddRotationAroundTexCoord(
     TexRotationsAroundCoords& rotations = comp.texRotations;
     const RotationAroundCoordInitParams& rotationParams = static_cast<const RotationAroundCoordInitParams&>(inParams);
 
-    cvector<index> idxs;
-    comp.ids.get_insert_idxs(ids, numEntts, idxs);
-
-    // exec indices correction
-    for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
-
     // execute sorted insertion of data
-    for (index i = 0; i < numEntts; ++i)
-        comp.ids.insert_before(idxs[i], ids[i]);
-
-    for (index i = 0; i < numEntts; ++i)
-        comp.transformTypes.insert_before(idxs[i], TexTransformType::ROTATION_AROUND_TEX_COORD);
+    // (initial texture transformation is identity, it is modified during the time)
+    cvector<index> idxs;
+    comp.ids.merge_sorted(ids, numEntts, idxs);
+    comp.transformTypes.insert_by_idxs(idxs, TexTransformType::ROTATION_AROUND_TEX_COORD);
+    comp.texTransforms.insert_by_idxs(idxs, DirectX::XMMatrixIdentity());
 
-    for (index i = 0; i < numEntts; ++i)
-        comp.texTransforms.insert_before(idxs[i], DirectX::XMMatrixIdentity());   // initial texture transformation which is modified during the time
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
 
     // ------------------------------------------------------------
     // setup specific data for this kind of texture transformation
 
-    rotations.ids.get_insert_idxs(ids, numEntts, idxs);
-
-    // exec indices correction
-    for (index i = 0; i < numEntts; ++i)
-        idxs[i] += i;
-
     // execute sorted insertion of data
-    for (index i = 0; i < numEntts; ++i)
-        rotations.ids.insert_before(idxs[i], ids[i]);
-
-    for (index i = 0; i < numEntts; ++i)
-        rotations.texCoords.insert_before(idxs[i], rotationParams.center[i]);
+    rotations.ids.merge_sorted(ids, numEntts, idxs);
+    rotations.texCoords.insert_by_idxs(idxs, rotationParams.center.data());
+    rotations.rotationsSpeed.insert_by_idxs(idxs, rotationParams.speed.data());
 
-    for (index i = 0; i < numEntts; ++i)
-        rotations.rotationsSpeed.insert_before(idxs[i], rotationParams.speed[i]);
+    if (isGpuTexAnimations_)
+        PackGpuTexAnimations();
 }
 
 ///////////////////////////////////////////////////////////
@@ -305,7 +453,7 @@ void TextureTransformSystem::UpdateTextureStaticTransformation(const float delta
     TextureTransform& comp = *pTexTransformComponent_;
     cvector<index> idxs;
 
-    comp.ids.get_idxs(comp.texStaticTrans.ids, idxs);
+    comp.sparseIdxs.GetIdxs(comp.texStaticTrans.ids, idxs, 0);
    
     // currently we can only translate the texture over the surface
     for (int i = 0; const index idx : idxs)
@@ -399,7 +547,7 @@ void ApplyAtlasAnimationDataByIdxs(
         enttsToUpdate[i++] = anim.ids[animIdx];
 
     // get data idxs of transformations to update and apply new values by these idxs
-    comp.ids.get_idxs(enttsToUpdate, transformsIdxs);
+    comp.sparseIdxs.GetIdxs(enttsToUpdate, transformsIdxs, 0);
 
     // apply texture transformations by idxs
     for (index i = 0; const index idx : transformsIdxs)
@@ -454,7 +602,7 @@ void TextureTransformSystem::UpdateTextureRotations(const float totalGameTime)
     }
 
     // get data idxs of transformations to update and apply new values by these idxs
-    comp.ids.get_idxs(rotations.ids, idxs);
+    comp.sparseIdxs.GetIdxs(rotations.ids, idxs, 0);
     ApplyTexTransformsByIdxs(idxs, texTransToUpdate);
 }
 
@@ -472,4 +620,81 @@ void TextureTransformSystem::ApplyTexTransformsByIdxs(
         comp.texTransforms[idx] = newTexTransforms[i++];
 }
 
+///////////////////////////////////////////////////////////
+
+void TextureTransformSystem::PackGpuTexAnimations()
+{
+    // pack params of each atlas animation and rotation into its texture transformation
+    // (is unpacked in hlsl/TexTransformHelper.hlsli):
+    //   atlas:    r0 = { cell_width, cell_height, columns, tag }
+    //             r1 = { frame_duration, frames_count, 0, 0 }
+    //   rotation: r0 = { center_u, center_v, speed, tag }
+
+    using namespace DirectX;
+    TextureTransform& comp = *pTexTransformComponent_;
+    const TexAtlasAnimations&       anim      = comp.texAtlasAnim;
+    const TexRotationsAroundCoords& rotations = comp.texRotations;
+    cvector<index> idxs;
+
+    comp.sparseIdxs.GetIdxs(anim.ids, idxs, 0);
+
+    for (int i = 0; const index idx : idxs)
+    {
+        const float numCols = (float)anim.data[i].texColumns;
+        const float numRows = (float)anim.data[i].texRows;
+
+        comp.texTransforms[idx] = XMMATRIX(
+            1.0f / numCols,     1.0f / numRows,    numCols, GPU_TEX_ANIM_ATLAS,
+            anim.timeSteps[i],  numCols * numRows, 0.0f,    0.0f,
+            0.0f,               0.0f,              0.0f,    0.0f,
+            0.0f,               0.0f,              0.0f,    0.0f);
+        ++i;
+    }
+
+    comp.sparseIdxs.GetIdxs(rotations.ids, idxs, 0);
+
+    for (int i = 0; const index idx : idxs)
+    {
+        const XMFLOAT2& center = rotations.texCoords[i];
+
+        comp.texTransforms[idx] = XMMATRIX(
+            center.x, center.y, rotations.rotationsSpeed[i], GPU_TEX_ANIM_ROTATION,
+            0.0f,     0.0f,     0.0f,                        0.0f,
+            0.0f,     0.0f,     0.0f,                        0.0f,
+            0.0f,     0.0f,     0.0f,                        0.0f);
+        ++i;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void TextureTransformSystem::ResetCpuTexAnimations()
+{
+    // restart atlas animations from the first frame and reset rotations
+    // so the packed GPU params are replaced with usual matrices
+
+    TextureTransform& comp = *pTexTransformComponent_;
+    TexAtlasAnimations& anim = comp.texAtlasAnim;
+    cvector<index> idxs;
+
+    comp.sparseIdxs.GetIdxs(anim.ids, idxs, 0);
+
+    for (int i = 0; const index idx : idxs)
+    {
+        const float cellWidth  = 1.0f / (float)anim.data[i].texColumns;
+        const float cellHeight = 1.0f / (float)anim.data[i].texRows;
+
+        anim.data[i].currTexFrameIdx = 0;
+        anim.currAnimTime[i] = 0;
+        comp.texTransforms[idx] = DirectX::XMMatrixScaling(cellWidth, cellHeight, 0);
+        ++i;
+    }
+
+    // rotations are recomputed with the next update
+    comp.sparseIdxs.GetIdxs(comp.texRotations.ids, idxs, 0);
+
+    for (const index idx : idxs)
+        comp.texTransforms[idx] = DirectX::XMMatrixIdentity();
+}
+
 } // namespace ECS
@@ -11,7 +11,9 @@
 // ********************************************************************************
 #pragma once
 
+#include "../Common/ECSTypes.h"
 #include "../Components/TextureTransform.h"
+#include "../Common/WorldFile.h"
 #include <cvector.h>
 
 namespace ECS
@@ -23,6 +25,9 @@ public:
     TextureTransformSystem(TextureTransform* pTexTransformComp);
     ~TextureTransformSystem() {}
 
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
 
     void AddTexTransformation(
         const EntityID* ids,
@@ -30,15 +35,48 @@ public:
         const TexTransformType type,
         const TexTransformInitParams& params);
 
+    void RemoveRecords(const EntityID* ids, const size numEntts);
+
     void GetTexTransformsForEntts(
         const EntityID* ids,
         const size numEntts,
         cvector<XMMATRIX>& outTexTransforms);
 
+    // NOTE: outTexTransforms must have space for numEntts matrices
+    void GetTexTransformsForEntts(
+        const EntityID* ids,
+        const size numEntts,
+        XMMATRIX* outTexTransforms);
+
+    inline bool HasTexTransform(const EntityID id) const { return pTexTransformComponent_->sparseIdxs.Has(id); }
+
     void UpdateAllTextrureAnimations(const float totalGameTime, const float deltaTime);
 
+    // if enabled, atlas animations and rotations aren't updated on the CPU:
+    // their params are packed into the texture transformations once and
+    // the animations are evaluated in the vertex shader by the game time
+    void SetGpuTexAnimations(const bool enable);
+    inline bool IsGpuTexAnimations() const { return isGpuTexAnimations_; }
+
+    // do texture transformations of some entts change each frame on the CPU?
+    inline bool HasCpuTexAnimations() const
+    {
+        return !isGpuTexAnimations_ &&
+               (!pTexTransformComponent_->texAtlasAnim.ids.empty() ||
+                !pTexTransformComponent_->texRotations.ids.empty());
+    }
+
+    // tags of packed animations (are stored in texTransform.r[0].w)
+    // NOTE: must be the same as in hlsl/TexTransformHelper.hlsli
+    static constexpr float GPU_TEX_ANIM_ATLAS    = 1.0f;
+    static constexpr float GPU_TEX_ANIM_ROTATION = 2.0f;
+
+    // components accessed during the update (is used by the update scheduler)
+    static constexpr ComponentBitfield UPDATE_READS  = 0;
+    static constexpr ComponentBitfield UPDATE_WRITES = GetComponentBit(TextureTransformComponent);
+
 private:
-    inline bool CheckCanAddRecords(const EntityID* ids, const size numEntts) const { return !pTexTransformComponent_->ids.binary_search(ids, numEntts); }
+    inline bool CheckCanAddRecords(const EntityID* ids, const size numEntts) const { return !pTexTransformComponent_->sparseIdxs.HasAny(ids, numEntts); }
 
     void AddStaticTexTransform(
         const EntityID* ids,
@@ -67,7 +105,11 @@ private:
         const cvector<index>& idxs,
         const cvector<XMMATRIX>& texTransforms);
 
+    void PackGpuTexAnimations();
+    void ResetCpuTexAnimations();
+
     TextureTransform* pTexTransformComponent_ = nullptr;
+    bool              isGpuTexAnimations_     = false;
 };
 
 };
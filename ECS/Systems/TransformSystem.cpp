@@ -6,6 +6,7 @@
 // =================================================================================
 #include "../Common/pch.h"
 #include "TransformSystem.h"
+#include <JobSystem.h>
 
 #pragma warning (disable : 4996)
 
@@ -27,6 +28,91 @@ TransformSystem::~TransformSystem()
 }
 
 
+// =================================================================================
+// SERIALIZATION / DESERIALIZATION
+// =================================================================================
+void TransformSystem::Serialize(WorldFileWriter& writer)
+{
+    // write transformation data of all the entts (including the "invalid" record)
+
+    Transform& comp = *pTransform_;
+    const size numRecords = comp.ids.size();
+
+    // resolve lazy matrices so we write actual data
+    for (index idx = 1; idx < numRecords; ++idx)
+        UpdateIfDirtyByIdx(idx);
+
+    // we keep only the flag which defines how to compute the inverse world
+    cvector<uint8> flags(numRecords);
+
+    for (index idx = 0; idx < numRecords; ++idx)
+        flags[idx] = comp.dirtyFlags[idx] & WORLD_NOT_TRS;
+
+    writer.BeginChunk(TransformComponent);
+    writer.WriteArray(comp.ids);
+    writer.WriteArray(comp.posAndUniformScale);
+    writer.WriteArray(comp.directions);
+    writer.WriteArray(comp.worlds);
+    writer.WriteArray(comp.invWorlds);
+    writer.WriteArray(flags);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool TransformSystem::Deserialize(WorldFileReader& reader)
+{
+    Transform& comp = *pTransform_;
+
+    if (!reader.BeginChunk(TransformComponent))
+    {
+        LogErr("there is no transform data in the world file");
+        return false;
+    }
+
+    bool result = true;
+    result &= reader.ReadArray(comp.ids);
+    result &= reader.ReadArray(comp.posAndUniformScale);
+    result &= reader.ReadArray(comp.directions);
+    result &= reader.ReadArray(comp.worlds);
+    result &= reader.ReadArray(comp.invWorlds);
+    result &= reader.ReadArray(comp.dirtyFlags);
+
+    const size numRecords = comp.ids.size();
+
+    result &= (numRecords > 0) && (comp.ids[0] == INVALID_ENTITY_ID);
+    result &= (comp.posAndUniformScale.size() == numRecords);
+    result &= (comp.directions.size()         == numRecords);
+    result &= (comp.worlds.size()             == numRecords);
+    result &= (comp.invWorlds.size()          == numRecords);
+    result &= (comp.dirtyFlags.size()         == numRecords);
+
+    if (!result)
+    {
+        LogErr("transform data in the world file is corrupted");
+        return false;
+    }
+
+    // there is no prev simulation step yet
+    comp.prevWorlds = comp.worlds;
+
+    // all the loaded entts are considered as changed during this frame
+    comp.dirtyIds.clear();
+    comp.changedIds.clear();
+    comp.dirtyIds.reserve(numRecords);
+
+    for (index idx = 1; idx < numRecords; ++idx)
+    {
+        comp.dirtyFlags[idx] |= TRANSFORM_CHANGED;
+        comp.dirtyIds.push_back(comp.ids[idx]);
+    }
+
+    comp.sparseIdxs.Clear();
+    comp.sparseIdxs.Rebuild(comp.ids);
+
+    return true;
+}
+
 // =================================================================================
 // PUBLIC METHODS
 // =================================================================================
@@ -44,9 +130,31 @@ void TransformSystem::AddRecords(
 
 ///////////////////////////////////////////////////////////
 
-void TransformSystem::RemoveRecords(const cvector<EntityID>& enttsIDs)
+void TransformSystem::RemoveRecords(const EntityID* ids, const size numEntts)
 {
-    assert("TODO: IMPLEMENT IT!" && 0);
+    // remove records of input entts (if they have any) with a single pass
+    // over the data arrays, so the arrays remain SORTED
+
+    CAssert::True((ids != nullptr) && (numEntts > 0), "invalid input args");
+
+    Transform& comp = *pTransform_;
+    cvector<index> idxs;
+
+    comp.sparseIdxs.GetExistingIdxs(ids, numEntts, idxs);
+
+    if (idxs.empty())
+        return;
+
+    comp.ids.erase_by_idxs(idxs);
+    comp.worlds.erase_by_idxs(idxs);
+    comp.invWorlds.erase_by_idxs(idxs);
+    comp.prevWorlds.erase_by_idxs(idxs);
+    comp.posAndUniformScale.erase_by_idxs(idxs);
+    comp.directions.erase_by_idxs(idxs);
+    comp.dirtyFlags.erase_by_idxs(idxs);
+
+    comp.sparseIdxs.Remove(ids, numEntts);
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
 }
 
 // =================================================================================
@@ -69,10 +177,10 @@ void TransformSystem::GetPositions(
     Transform& comp = *pTransform_;
     cvector<index> idxs;
 
-    comp.ids.get_idxs(ids, numEntts, idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
 
     // get positions by idxs
-    outPositions.resize(numEntts);
+    outPositions.resize_uninitialized(numEntts);
 
     for (int i = 0; const index idx : idxs)
     {
@@ -97,10 +205,10 @@ void TransformSystem::GetDirections(
     Transform& comp = *pTransform_;
     cvector<index> idxs;
 
-    comp.ids.get_idxs(ids, numEntts, idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
 
     // get directions by idxs
-    outDirections.resize(numEntts);
+    outDirections.resize_uninitialized(numEntts);
 
     for (int i = 0; const index idx : idxs)
         outDirections[i++] = comp.directions[idx];
@@ -122,10 +230,10 @@ void TransformSystem::GetUniformScales(
     Transform& comp = *pTransform_;
     cvector<index> idxs;
 
-    comp.ids.get_idxs(ids, numEntts, idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
 
     // get uniform scales by idxs
-    outScales.resize(numEntts);
+    outScales.resize_uninitialized(numEntts);
 
     for (int i = 0; const index idx : idxs)
         outScales[i++] = comp.posAndUniformScale[idx].w;   // uniform scale values (float) is packed into float4 in the w-component
@@ -147,13 +255,13 @@ void TransformSystem::GetPositionsAndDirections(
         return;
     }
 
-    outPositions.resize(numEntts);
-    outDirections.resize(numEntts);
+    outPositions.resize_uninitialized(numEntts);
+    outDirections.resize_uninitialized(numEntts);
 
     Transform& comp = *pTransform_;
     cvector<index> idxs;
 
-    comp.ids.get_idxs(ids, numEntts, idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
 
     // get positions and directions by idxs
     for (int i = 0; const index idx : idxs)
@@ -244,7 +352,7 @@ bool TransformSystem::AdjustPositions(
     Transform& comp = *pTransform_;
 
     cvector<index> idxs;
-    comp.ids.get_idxs(ids, numEntts, idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
 
     XMFLOAT3 offset;
     XMStoreFloat3(&offset, adjustBy);
@@ -262,9 +370,9 @@ bool TransformSystem::AdjustPositions(
     for (const index idx : idxs)
         comp.worlds[idx].r[3] += adjustBy;
 
-    // update inverse worlds by idxs
+    // inverse worlds will be recomputed during the flush
     for (const index idx : idxs)
-        RecomputeInvWorldMatrixByIdx(idx);
+        MarkDirtyByIdx(idx, INV_WORLD_DIRTY);
 
     return true;
 }
@@ -289,7 +397,7 @@ bool TransformSystem::AdjustPosition(const EntityID id, const XMVECTOR& adjustBy
     pos.z += XMVectorGetZ(adjustBy);
 
     comp.worlds[idx].r[3] += adjustBy;
-    RecomputeInvWorldMatrixByIdx(idx);
+    MarkDirtyByIdx(idx, INV_WORLD_DIRTY);
 
     return true;
 }
@@ -316,7 +424,7 @@ bool TransformSystem::SetPositionVec(const EntityID id, const XMVECTOR& pos)
     data.z = p.z;
 
     comp.worlds[idx].r[3] = XMVECTOR{p.x, p.y, p.z, 1.0f};
-    RecomputeInvWorldMatrixByIdx(idx);
+    MarkDirtyByIdx(idx, INV_WORLD_DIRTY);
 
     return true;
 }
@@ -339,9 +447,9 @@ bool TransformSystem::SetPosition(const EntityID id, const XMFLOAT3& pos)
     data.y = pos.y;
     data.z = pos.z;
 
-    // recompute world matrix and inverse world matrix for this entity
+    // update translation of the world matrix; the inverse world will be recomputed during the flush
     comp.worlds[idx].r[3] = XMVECTOR{ pos.x, pos.y, pos.z, 1.0f };
-    RecomputeInvWorldMatrixByIdx(idx);
+    MarkDirtyByIdx(idx, INV_WORLD_DIRTY);
 
     return true;
 }
@@ -382,9 +490,8 @@ bool TransformSystem::SetUniScale(const EntityID id, const float uniformScale)
     // uniform scale is stored in the w-component
     pTransform_->posAndUniformScale[idx].w = uniformScale;
 
-    // recompute world matrix and inverse world matrix for this entity
-    RecomputeWorldMatrixByIdx(idx);
-    RecomputeInvWorldMatrixByIdx(idx);
+    // world matrix and inverse world matrix will be recomputed during the flush
+    MarkDirtyByIdx(idx, WORLD_DIRTY | INV_WORLD_DIRTY);
 
     return true;
 }
@@ -411,7 +518,7 @@ bool TransformSystem::RotateLocalSpacesByQuat(
     Transform& comp = *pTransform_;
 
     cvector<index> idxs;
-    comp.ids.get_idxs(ids, numEntts, idxs);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, idxs, 0);
 
     // TODO: maybe put here the check if all input entities are actually exist?
 
@@ -428,6 +535,9 @@ bool TransformSystem::RotateLocalSpacesByQuat(
     // rotate the worlds
     const XMMATRIX R = XMMatrixRotationQuaternion(quat);
 
+    for (const index idx : idxs)
+        ResolveWorldByIdx(idx);
+
     for (const index idx : idxs)
     {
         XMMATRIX oldWorld = comp.worlds[idx];
@@ -438,9 +548,9 @@ bool TransformSystem::RotateLocalSpacesByQuat(
         comp.worlds[idx].r[3] = translation;   // translate world to original position
     }
 
-    // compute inverse matrices of updated worlds
+    // inverse matrices of updated worlds will be recomputed during the flush
     for (const index idx : idxs)
-        RecomputeInvWorldMatrixByIdx(idx);
+        MarkDirtyByIdx(idx, INV_WORLD_DIRTY);
 
     return true;
 }
@@ -457,9 +567,9 @@ bool TransformSystem::RotateLocalSpaceByQuat(const EntityID id, const XMVECTOR&
     using namespace DirectX;
 
     Transform& comp = *pTransform_;
-    const index idx = comp.ids.get_idx(id);
+    const index idx = comp.sparseIdxs.GetIdx(id);
 
-    if (comp.ids[idx] != id)
+    if (idx == SparseSet::INVALID_IDX)
     {
         sprintf(g_String, "there is no transform data for entt by id: %ld", id);
         LogErr(g_String);
@@ -475,6 +585,8 @@ bool TransformSystem::RotateLocalSpaceByQuat(const EntityID id, const XMVECTOR&
     dir = DirectX::XMQuaternionMultiply(tmpVec, quat);
 
     // rotate the world
+    ResolveWorldByIdx(idx);
+
     const XMMATRIX R = XMMatrixRotationQuaternion(quat);
     XMMATRIX oldWorld = comp.worlds[idx];
     XMVECTOR translation = oldWorld.r[3];
@@ -483,7 +595,7 @@ bool TransformSystem::RotateLocalSpaceByQuat(const EntityID id, const XMVECTOR&
     comp.worlds[idx] = oldWorld * R;       // rotate world 
     comp.worlds[idx].r[3] = translation;   // translate world to original position
 
-    RecomputeInvWorldMatrixByIdx(idx);
+    MarkDirtyByIdx(idx, INV_WORLD_DIRTY);
 
     return true;
 }
@@ -505,8 +617,10 @@ void TransformSystem::TransformWorld(const EntityID id, const XMMATRIX& transfor
     SetPositionVec(id, newPos);
     SetDirection(id, newDir);
 
+    // arbitrary transformation so we will need the general 4x4 inverse for this world
+    ResolveWorldByIdx(idx);
     pTransform_->worlds[idx] = DirectX::XMMatrixMultiply(pTransform_->worlds[idx], transformation);
-    RecomputeInvWorldMatrixByIdx(idx);
+    MarkDirtyByIdx(idx, INV_WORLD_DIRTY | WORLD_NOT_TRS);
 }
 
 ///////////////////////////////////////////////////////////
@@ -514,7 +628,10 @@ void TransformSystem::TransformWorld(const EntityID id, const XMMATRIX& transfor
 DirectX::XMMATRIX TransformSystem::GetWorldMatrixOfEntt(const EntityID id)
 {
     // return a world matrix of entt by ID or return a matrix of NANs if there is no such entt by ID
-    return pTransform_->worlds[GetIdx(id)];
+    const index idx = GetIdx(id);
+    UpdateIfDirtyByIdx(idx);
+
+    return pTransform_->worlds[idx];
 }
 
 ///////////////////////////////////////////////////////////
@@ -522,7 +639,10 @@ DirectX::XMMATRIX TransformSystem::GetWorldMatrixOfEntt(const EntityID id)
 const DirectX::XMMATRIX& TransformSystem::GetInverseWorld(const EntityID id)
 {
     // return an inverse world matrix of entt by ID or return a matrix of NANs if there is no such entt by ID
-    return pTransform_->invWorlds[GetIdx(id)];
+    const index idx = GetIdx(id);
+    UpdateIfDirtyByIdx(idx);
+
+    return pTransform_->invWorlds[idx];
 }
 
 ///////////////////////////////////////////////////////////
@@ -531,12 +651,28 @@ void TransformSystem::GetWorlds(
     const EntityID* ids,
     const size numEntts,
     cvector<DirectX::XMMATRIX>& outWorlds)
+{
+    outWorlds.resize_uninitialized(numEntts);
+    GetWorlds(ids, numEntts, outWorlds.data());
+}
+
+///////////////////////////////////////////////////////////
+
+void TransformSystem::GetWorlds(
+    const EntityID* ids,
+    const size numEntts,
+    DirectX::XMMATRIX* outWorlds)
 {
     CAssert::True(ids != nullptr, "input ptr to entities IDs arr == nullptr");
     CAssert::True(numEntts > 0,   "input number of entities must be > 0");
+    CAssert::True(outWorlds != nullptr, "output ptr to worlds arr == nullptr");
 
     // get data idx by each ID and then get world matrices by these idxs
-    pTransform_->ids.get_idxs(ids, numEntts, s_Idxs);
+    pTransform_->sparseIdxs.GetIdxs(ids, numEntts, s_Idxs, 0);
+
+    for (const index idx : s_Idxs)
+        UpdateIfDirtyByIdx(idx);
+
     pTransform_->worlds.get_data_by_idxs(s_Idxs, outWorlds);
 }
 
@@ -547,14 +683,337 @@ void TransformSystem::GetInverseWorlds(
     const size numEntts,
     cvector<DirectX::XMMATRIX>& outInvWorlds)
 {
-    if (!ids || (numEntts < 0))
+    outInvWorlds.resize_uninitialized(numEntts * (numEntts > 0));
+    GetInverseWorlds(ids, numEntts, outInvWorlds.data());
+}
+
+///////////////////////////////////////////////////////////
+
+void TransformSystem::GetInverseWorlds(
+    const EntityID* ids,
+    const size numEntts,
+    DirectX::XMMATRIX* outInvWorlds)
+{
+    if (!ids || (numEntts < 0) || !outInvWorlds)
+    {
         LogErr("input args are invalid");
+        return;
+    }
 
     // get data idx by each ID and then get inverse world matrices by these idxs
-    pTransform_->ids.get_idxs(ids, numEntts, s_Idxs);
+    pTransform_->sparseIdxs.GetIdxs(ids, numEntts, s_Idxs, 0);
+
+    for (const index idx : s_Idxs)
+        UpdateIfDirtyByIdx(idx);
+
     pTransform_->invWorlds.get_data_by_idxs(s_Idxs, outInvWorlds);
 }
 
+///////////////////////////////////////////////////////////
+
+void TransformSystem::GatherPositions(
+    const index* idxs,
+    const size num,
+    XMFLOAT3* outPositions,
+    const size strideBytes) const
+{
+    CAssert::True((idxs != nullptr) && (outPositions != nullptr), "invalid input args");
+
+    const XMFLOAT4* data = pTransform_->posAndUniformScale.data();
+    uint8*          out  = (uint8*)outPositions;
+
+    for (index i = 0; i < num; ++i, out += strideBytes)
+    {
+        const XMFLOAT4& pos = data[idxs[i]];              // pos (float3) + scale (float)
+        *(XMFLOAT3*)out = { pos.x, pos.y, pos.z };
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void TransformSystem::GatherWorlds(
+    const index* idxs,
+    const size num,
+    XMMATRIX* outWorlds) const
+{
+    CAssert::True((idxs != nullptr) && (outWorlds != nullptr), "invalid input args");
+
+    const XMMATRIX* worlds = pTransform_->worlds.data();
+
+    for (index i = 0; i < num; ++i)
+        outWorlds[i] = worlds[idxs[i]];
+}
+
+///////////////////////////////////////////////////////////
+
+void TransformSystem::FlushDirty()
+{
+    // recompute world/inverse world matrices only for entts which were
+    // changed since the previous flush; and store IDs of these entts so
+    // consumers can skip the static ones
+
+    Transform& comp = *pTransform_;
+    cvector<EntityID>& changed = comp.changedIds;
+
+    changed.clear();
+    changed.reserve(comp.dirtyIds.size());
+
+    for (const EntityID id : comp.dirtyIds)
+    {
+        const index idx = comp.sparseIdxs.GetIdx(id);
+
+        // the record could be already removed
+        if (idx == SparseSet::INVALID_IDX)
+            continue;
+
+        UpdateIfDirtyByIdx(idx);
+
+        // reset all the flags except of the "not TRS" because
+        // this world still can't be inverted using the closed form;
+        // and mark the world as changed during this simulation step
+        comp.dirtyFlags[idx] &= WORLD_NOT_TRS;
+        comp.dirtyFlags[idx] |= WORLD_INTERPOLATED;
+        changed.push_back(id);
+    }
+
+    std::sort(changed.begin(), changed.end());
+    comp.dirtyIds.clear();
+}
+
+
+// =================================================================================
+// RENDER INTERPOLATION
+// =================================================================================
+void TransformSystem::BeginSimulationStep()
+{
+    // only entts which were changed during the prev step have (prev world != world)
+    // so after this call prev worlds of all the entts are equal to the current ones
+
+    Transform& comp = *pTransform_;
+
+    for (const EntityID id : comp.changedIds)
+    {
+        const index idx = comp.sparseIdxs.GetIdx(id);
+
+        // the record could be already removed
+        if (idx == SparseSet::INVALID_IDX)
+            continue;
+
+        UpdateIfDirtyByIdx(idx);
+        comp.prevWorlds[idx]  = comp.worlds[idx];
+        comp.dirtyFlags[idx] &= ~WORLD_INTERPOLATED;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void TransformSystem::GetRenderWorlds(
+    const EntityID* ids,
+    const size numEntts,
+    DirectX::XMMATRIX* outWorlds)
+{
+    // get worlds (s_Idxs is filled as well)
+    GetWorlds(ids, numEntts, outWorlds);
+
+    if (interpAlpha_ >= 1.0f)
+        return;
+
+    const Transform& comp = *pTransform_;
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const index idx   = s_Idxs[i];
+        const uint8 flags = comp.dirtyFlags[idx];
+
+        if (flags & WORLD_INTERPOLATED)
+        {
+            const bool isTRS = !(flags & WORLD_NOT_TRS);
+            outWorlds[i] = InterpolateWorld(comp.prevWorlds[idx], comp.worlds[idx], interpAlpha_, isTRS);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+XMMATRIX TransformSystem::InterpolateWorld(
+    const XMMATRIX& w0,
+    const XMMATRIX& w1,
+    const float alpha,
+    const bool isTRS)
+{
+    // blend two world matrices: for (uniform_scale * rotation * translation)
+    // we lerp scale/translation and slerp rotation so the matrix isn't skewed;
+    // arbitrary matrices are just blended by elements
+
+    if (!isTRS)
+    {
+        XMMATRIX w;
+        w.r[0] = XMVectorLerp(w0.r[0], w1.r[0], alpha);
+        w.r[1] = XMVectorLerp(w0.r[1], w1.r[1], alpha);
+        w.r[2] = XMVectorLerp(w0.r[2], w1.r[2], alpha);
+        w.r[3] = XMVectorLerp(w0.r[3], w1.r[3], alpha);
+        return w;
+    }
+
+    const XMVECTOR s0 = XMVector3Length(w0.r[0]);
+    const XMVECTOR s1 = XMVector3Length(w1.r[0]);
+
+    // upper 3x3 part without scale is a pure rotation
+    XMMATRIX R0 = w0;
+    XMMATRIX R1 = w1;
+    R0.r[0] /= s0;  R0.r[1] /= s0;  R0.r[2] /= s0;
+    R1.r[0] /= s1;  R1.r[1] /= s1;  R1.r[2] /= s1;
+
+    const XMVECTOR q = XMQuaternionSlerp(
+        XMQuaternionRotationMatrix(R0),
+        XMQuaternionRotationMatrix(R1),
+        alpha);
+
+    const XMVECTOR s = XMVectorLerp(s0, s1, alpha);
+
+    XMMATRIX w = XMMatrixRotationQuaternion(q);
+    w.r[0] *= s;
+    w.r[1] *= s;
+    w.r[2] *= s;
+    w.r[3] = XMVectorLerp(w0.r[3], w1.r[3], alpha);
+
+    return w;
+}
+
+
+// =================================================================================
+// BULK API (SoA + SIMD)
+// =================================================================================
+void TransformSystem::GetTransformsSoA(
+    const EntityID* ids,
+    const size numEntts,
+    TransformSoA& outSoA) const
+{
+    // gather position/direction/uniform scale of input entts into SoA layout;
+    // NOTE: if there is no transform data for some entt its idx in the SoA == 0
+
+    CAssert::True(ids != nullptr, "input ptr to entities IDs arr == nullptr");
+
+    const Transform& comp = *pTransform_;
+
+    outSoA.Resize(numEntts);
+    comp.sparseIdxs.GetIdxs(ids, numEntts, outSoA.idxs, 0);
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        const XMFLOAT4& data = comp.posAndUniformScale[outSoA.idxs[i]];
+
+        outSoA.posX[i]  = data.x;
+        outSoA.posY[i]  = data.y;
+        outSoA.posZ[i]  = data.z;
+        outSoA.scale[i] = data.w;
+    }
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        XMFLOAT4 q;
+        XMStoreFloat4(&q, comp.directions[outSoA.idxs[i]]);
+
+        outSoA.quatX[i] = q.x;
+        outSoA.quatY[i] = q.y;
+        outSoA.quatZ[i] = q.z;
+        outSoA.quatW[i] = q.w;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void TransformSystem::SetTransformsSoA(const TransformSoA& soa)
+{
+    // write back transformation data from SoA layout and rebuild
+    // world matrices of these entts with the SIMD kernel;
+    // NOTE: entts without transform data (idx == 0) are skipped
+
+    const size numEntts = soa.Size();
+
+    if (numEntts == 0)
+        return;
+
+    Transform& comp = *pTransform_;
+
+    s_Worlds.resize_uninitialized(numEntts);
+    XMMATRIX* worlds = s_Worlds.data();
+
+    // each entt has its own record so for large batches the matrices
+    // building and writing back are split across the job system
+    g_JobSystem.ParallelFor(numEntts, TransformSoA::JOB_GRAIN, [&soa, &comp, worlds](const index start, const index end)
+    {
+        ComputeWorldsSoA(soa, start, end, worlds);
+
+        for (index i = start; i < end; ++i)
+        {
+            const index idx = soa.idxs[i];
+
+            if (idx == 0)
+                continue;
+
+            comp.posAndUniformScale[idx] = { soa.posX[i], soa.posY[i], soa.posZ[i], soa.scale[i] };
+            comp.directions[idx]         = XMVectorSet(soa.quatX[i], soa.quatY[i], soa.quatZ[i], soa.quatW[i]);
+            comp.worlds[idx]             = worlds[i];
+        }
+    });
+
+    // mark records as dirty (the list of dirty entts isn't thread-safe so do it here)
+    for (const index idx : soa.idxs)
+    {
+        if (idx == 0)
+            continue;
+
+        // the world is actual and it is TRS again so only the inverse is dirty now
+        comp.dirtyFlags[idx] &= ~(WORLD_DIRTY | WORLD_NOT_TRS);
+        MarkDirtyByIdx(idx, INV_WORLD_DIRTY);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void TransformSystem::SetTransforms(
+    const EntityID* ids,
+    const size numEntts,
+    const XMFLOAT3* positions,
+    const XMVECTOR* dirQuats,
+    const float* uniformScales)
+{
+    // set position/direction/uniform scale for multiple entts at once
+    // and rebuild their world matrices using the bulk update
+
+    CAssert::True(ids && positions && dirQuats && uniformScales, "invalid input args");
+
+    if (numEntts <= 0)
+        return;
+
+    TransformSoA& soa = s_SoA;
+
+    soa.Resize(numEntts);
+    pTransform_->sparseIdxs.GetIdxs(ids, numEntts, soa.idxs, 0);
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        soa.posX[i]  = positions[i].x;
+        soa.posY[i]  = positions[i].y;
+        soa.posZ[i]  = positions[i].z;
+        soa.scale[i] = uniformScales[i];
+    }
+
+    for (index i = 0; i < numEntts; ++i)
+    {
+        XMFLOAT4 q;
+        XMStoreFloat4(&q, XMQuaternionNormalize(dirQuats[i]));
+
+        soa.quatX[i] = q.x;
+        soa.quatY[i] = q.y;
+        soa.quatZ[i] = q.z;
+        soa.quatW[i] = q.w;
+    }
+
+    SetTransformsSoA(soa);
+}
+
 
 // =================================================================================
 //                            PRIVATE HELPERS
@@ -570,30 +1029,23 @@ void TransformSystem::AddRecordsToTransformComponent(
 
     Transform& comp = *pTransform_;
 
-    bool canAddComponent = !comp.ids.binary_search(ids, numElems);
+    bool canAddComponent = !comp.sparseIdxs.HasAny(ids, numElems);
     CAssert::True(canAddComponent, "can't add component: there is already a record with some entity id");
 
+    // merge ids in a single pass and get the final idx of each new record
     cvector<index> idxs;
-    comp.ids.get_insert_idxs(ids, numElems, idxs);
-
-    // execute indices correction
-    for (index i = 0; i < idxs.size(); ++i)
-        idxs[i] += i;
+    comp.ids.merge_sorted(ids, numElems, idxs);
 
-    // store ids
-    for (index i = 0; i < numElems; ++i)
-        comp.ids.insert_before(idxs[i], ids[i]);
+    // store positions (we store uniform scale values in the w-component of float4)
+    cvector<XMFLOAT4> posAndScales(numElems);
 
-    // store positions
     for (index i = 0; i < numElems; ++i)
     {
         const XMFLOAT3& pos = positions[i];
-        comp.posAndUniformScale.insert_before(idxs[i], { pos.x, pos.y, pos.z, 1.0f });
+        posAndScales[i] = { pos.x, pos.y, pos.z, uniformScales[i] };
     }
 
-    // we store uniform scale values in the w-component of float4
-    for (index i = 0; i < numElems; ++i)
-        comp.posAndUniformScale[idxs[i]].w = uniformScales[i];
+    comp.posAndUniformScale.insert_by_idxs(idxs, posAndScales.data());
 
     // normalize all the input directions and store them into the component
     cvector<XMVECTOR> normDirections(numElems);
@@ -601,28 +1053,39 @@ void TransformSystem::AddRecordsToTransformComponent(
     for (int i = 0; i < numElems; ++i)
         normDirections[i] = DirectX::XMVector3Normalize(directions[i]);
 
-    for (index i = 0; i < numElems; ++i)
-        comp.directions.insert_before(idxs[i], normDirections[i]);
+    comp.directions.insert_by_idxs(idxs, normDirections.data());
 
     // ----------------------------------------------------
 
     // compute a world matrix and store it
     // and also compute an inverse world matrix and store it as well
+    cvector<XMMATRIX> worlds(numElems);
+    cvector<XMMATRIX> invWorlds(numElems);
+
     for (index i = 0; i < numElems; ++i)
     {
         const XMFLOAT3 pos = positions[i];
         const float scale  = uniformScales[i];
 
-        // compute a world matrix and store it
-        // and also compute an inverse world matrix and store it as well
         const XMMATRIX S = XMMatrixScaling(scale, scale, scale);
         //const XMMATRIX R = XMMatrixRotation(normDirections[i]);
         const XMMATRIX T = XMMatrixTranslation(pos.x, pos.y, pos.z);
-        const XMMATRIX world = S * T;
 
-        comp.worlds.insert_before(idxs[i], world);
-        comp.invWorlds.insert_before(idxs[i], XMMatrixInverse(nullptr, world));
+        worlds[i]    = S * T;
+        invWorlds[i] = GetInverseTRS(worlds[i]);
     }
+
+    comp.worlds.insert_by_idxs(idxs, worlds.data());
+    comp.invWorlds.insert_by_idxs(idxs, invWorlds.data());
+    comp.prevWorlds.insert_by_idxs(idxs, worlds.data());
+
+    // new entts are considered as changed during this frame
+    comp.dirtyFlags.insert_by_idxs(idxs, TRANSFORM_CHANGED);
+
+    comp.dirtyIds.append_vector(cvector<EntityID>(ids, ids + numElems));
+
+    // records starting from the first insertion idx were shifted so update the lookup table
+    comp.sparseIdxs.Rebuild(comp.ids, idxs[0]);
 }
 
 ///////////////////////////////////////////////////////////
@@ -631,9 +1094,9 @@ index TransformSystem::GetIdx(const EntityID id) const
 {
     // return valid idx if there is an entity by such ID;
     // or return 0 if there is no such entity;
-    const index idx = pTransform_->ids.get_idx(id);
+    const index idx = pTransform_->sparseIdxs.GetIdx(id);
 
-    if (pTransform_->ids[idx] != id)
+    if (idx == SparseSet::INVALID_IDX)
     {
         sprintf(g_String, "there is no transform data for entt by id: %ld", id);
         LogErr(g_String);
@@ -643,4 +1106,145 @@ index TransformSystem::GetIdx(const EntityID id) const
     return idx;
 }
 
+///////////////////////////////////////////////////////////
+
+void TransformSystem::ComputeWorldsSoA(
+    const TransformSoA& soa,
+    const index startIdx,
+    const index endIdx,
+    XMMATRIX* outWorlds)
+{
+    // build world matrices (uniform_scale * rotation(quat) * translation)
+    // for 4 entities per iteration; the rows of rotation matrix are:
+    //   r0 = { 1 - 2(yy + zz),     2(xy + zw),     2(xz - yw), 0 }
+    //   r1 = {     2(xy - zw), 1 - 2(xx + zz),     2(yz + xw), 0 }
+    //   r2 = {     2(xz + yw),     2(yz - xw), 1 - 2(xx + yy), 0 }
+    //
+    // NOTE: the SoA arrays are padded to the number of lanes so we always
+    //       process full registers but store only valid matrices
+
+#if defined(_XM_SSE_INTRINSICS_)
+    const __m128 one  = _mm_set1_ps(1.0f);
+    const __m128 two  = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (index i = startIdx; i < endIdx; i += TransformSoA::LANES)
+    {
+        const __m128 qx = _mm_loadu_ps(soa.quatX.data() + i);
+        const __m128 qy = _mm_loadu_ps(soa.quatY.data() + i);
+        const __m128 qz = _mm_loadu_ps(soa.quatZ.data() + i);
+        const __m128 qw = _mm_loadu_ps(soa.quatW.data() + i);
+        const __m128 s  = _mm_loadu_ps(soa.scale.data() + i);
+
+        const __m128 xx = _mm_mul_ps(qx, qx);
+        const __m128 yy = _mm_mul_ps(qy, qy);
+        const __m128 zz = _mm_mul_ps(qz, qz);
+        const __m128 xy = _mm_mul_ps(qx, qy);
+        const __m128 xz = _mm_mul_ps(qx, qz);
+        const __m128 yz = _mm_mul_ps(qy, qz);
+        const __m128 xw = _mm_mul_ps(qx, qw);
+        const __m128 yw = _mm_mul_ps(qy, qw);
+        const __m128 zw = _mm_mul_ps(qz, qw);
+
+        // scale factors: 2*s for the off-diagonal elements
+        const __m128 s2 = _mm_mul_ps(two, s);
+
+        __m128 m00 = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))));
+        __m128 m01 = _mm_mul_ps(s2, _mm_add_ps(xy, zw));
+        __m128 m02 = _mm_mul_ps(s2, _mm_sub_ps(xz, yw));
+        __m128 m03 = zero;
+
+        __m128 m10 = _mm_mul_ps(s2, _mm_sub_ps(xy, zw));
+        __m128 m11 = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))));
+        __m128 m12 = _mm_mul_ps(s2, _mm_add_ps(yz, xw));
+        __m128 m13 = zero;
+
+        __m128 m20 = _mm_mul_ps(s2, _mm_add_ps(xz, yw));
+        __m128 m21 = _mm_mul_ps(s2, _mm_sub_ps(yz, xw));
+        __m128 m22 = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))));
+        __m128 m23 = zero;
+
+        __m128 m30 = _mm_loadu_ps(soa.posX.data() + i);
+        __m128 m31 = _mm_loadu_ps(soa.posY.data() + i);
+        __m128 m32 = _mm_loadu_ps(soa.posZ.data() + i);
+        __m128 m33 = one;
+
+        // SoA => AoS: after transposition each register is a row of some matrix
+        _MM_TRANSPOSE4_PS(m00, m01, m02, m03);
+        _MM_TRANSPOSE4_PS(m10, m11, m12, m13);
+        _MM_TRANSPOSE4_PS(m20, m21, m22, m23);
+        _MM_TRANSPOSE4_PS(m30, m31, m32, m33);
+
+        const __m128 rows[4][4] =
+        {
+            { m00, m10, m20, m30 },
+            { m01, m11, m21, m31 },
+            { m02, m12, m22, m32 },
+            { m03, m13, m23, m33 },
+        };
+
+        const index numLeft    = endIdx - i;
+        const index numInBatch = (numLeft < TransformSoA::LANES) ? numLeft : TransformSoA::LANES;
+
+        for (index j = 0; j < numInBatch; ++j)
+        {
+            XMMATRIX& w = outWorlds[i + j];
+            w.r[0] = rows[j][0];
+            w.r[1] = rows[j][1];
+            w.r[2] = rows[j][2];
+            w.r[3] = rows[j][3];
+        }
+    }
+
+#else
+    // no intrinsics: build matrices one by one
+    for (index i = startIdx; i < endIdx; ++i)
+    {
+        const float s       = soa.scale[i];
+        const XMVECTOR quat = XMVectorSet(soa.quatX[i], soa.quatY[i], soa.quatZ[i], soa.quatW[i]);
+
+        outWorlds[i] =
+            XMMatrixScaling(s, s, s) *
+            XMMatrixRotationQuaternion(quat) *
+            XMMatrixTranslation(soa.posX[i], soa.posY[i], soa.posZ[i]);
+    }
+#endif
+}
+
+///////////////////////////////////////////////////////////
+
+void TransformSystem::MarkDirtyByIdx(const index idx, const uint8 flags)
+{
+    // set that some transformation data of entt by idx must be recomputed;
+    // if this entt wasn't changed during this frame yet we store its ID
+
+    uint8& entryFlags = pTransform_->dirtyFlags[idx];
+
+    if (!(entryFlags & TRANSFORM_CHANGED))
+        pTransform_->dirtyIds.push_back(pTransform_->ids[idx]);
+
+    entryFlags |= (flags | TRANSFORM_CHANGED);
+}
+
+///////////////////////////////////////////////////////////
+
+void TransformSystem::UpdateDirtyByIdx(const index idx)
+{
+    // recompute world and/or inverse world of entt by idx according to its flags
+
+    uint8& flags = pTransform_->dirtyFlags[idx];
+
+    if (flags & WORLD_DIRTY)
+    {
+        RecomputeWorldMatrixByIdx(idx);
+        flags &= ~WORLD_NOT_TRS;
+        flags |= INV_WORLD_DIRTY;
+    }
+
+    if (flags & INV_WORLD_DIRTY)
+        RecomputeInvWorldMatrixByIdx(idx);
+
+    flags &= ~(WORLD_DIRTY | INV_WORLD_DIRTY);
+}
+
 } // namespace ECS
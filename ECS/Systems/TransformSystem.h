@@ -8,6 +8,8 @@
 #pragma once
 #include "../Common/ECSTypes.h"
 #include "../Components/Transform.h"
+#include "../Components/Helpers/TransformSoA.h"
+#include "../Common/WorldFile.h"
 
 
 namespace ECS
@@ -19,6 +21,9 @@ public:
     TransformSystem(Transform* pTransform);
     ~TransformSystem();
 
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
 
     void AddRecords(
         const EntityID* ids,
@@ -27,7 +32,7 @@ public:
         const float* uniformScales,
         const size numElems);
 
-    void RemoveRecords(const cvector<EntityID>& enttsIDs);
+    void RemoveRecords(const EntityID* ids, const size numEntts);
 
     // -------------------------------------------------------
 
@@ -78,6 +83,12 @@ public:
         const size numEntts,
         cvector<DirectX::XMMATRIX>& outWorlds);
 
+    // NOTE: outWorlds must have space for numEntts matrices
+    void GetWorlds(
+        const EntityID* ids,
+        const size numEntts,
+        DirectX::XMMATRIX* outWorlds);
+
     // ----------------------------------------------------
 
     const DirectX::XMMATRIX& GetInverseWorld(const EntityID id);
@@ -87,6 +98,99 @@ public:
         const size numEntts,
         cvector<DirectX::XMMATRIX>& outInvWorlds);
 
+    // NOTE: outInvWorlds must have space for numEntts matrices
+    void GetInverseWorlds(
+        const EntityID* ids,
+        const size numEntts,
+        DirectX::XMMATRIX* outInvWorlds);
+
+    // ----------------------------------------------------
+
+    // BULK API: transformation data in SoA layout; world matrices of
+    // updated entts are rebuilt by the SIMD kernel (4 matrices per iteration)
+
+    void GetTransformsSoA(const EntityID* ids, const size numEntts, TransformSoA& outSoA) const;
+    void SetTransformsSoA(const TransformSoA& soa);
+
+    // ----------------------------------------------------
+
+    // ZERO-COPY API: read-only views over all the records in storage order (the record
+    // by idx 0 is the "invalid" one); matrices are actual after FlushDirty()
+
+    inline ConstSpan<EntityID> GetIdsSpan()                 const { return pTransform_->ids; }
+    inline ConstSpan<XMFLOAT4> GetPosAndUniformScalesSpan() const { return pTransform_->posAndUniformScale; }
+    inline ConstSpan<XMMATRIX> GetWorldsSpan()              const { return pTransform_->worlds; }
+    inline ConstSpan<XMMATRIX> GetInverseWorldsSpan()       const { return pTransform_->invWorlds; }
+
+    // idxs of records by ids (entts without a record get 0: the "invalid" record)
+    inline void GetIdxs(const EntityID* ids, const size numEntts, cvector<index>& outIdxs) const
+    {
+        pTransform_->sparseIdxs.GetIdxs(ids, numEntts, outIdxs, 0);
+    }
+
+    // gather data of records by idxs straight into the output memory (for instance a
+    // mapped GPU buffer); positions are written by strideBytes so they can be a field
+    // of an array of structs
+    void GatherPositions(
+        const index* idxs,
+        const size num,
+        XMFLOAT3* outPositions,
+        const size strideBytes = sizeof(XMFLOAT3)) const;
+
+    // NOTE: expects actual worlds (FlushDirty() is already called in this frame)
+    void GatherWorlds(
+        const index* idxs,
+        const size num,
+        XMMATRIX* outWorlds) const;
+
+    void SetTransforms(
+        const EntityID* ids,
+        const size numEntts,
+        const XMFLOAT3* positions,
+        const XMVECTOR* dirQuats,
+        const float* uniformScales);
+
+    // check if transformation of record by idx (from TransformSoA::idxs)
+    // was changed since the prev flush
+    inline bool IsChangedByIdx(const index idx) const
+    {
+        return pTransform_->dirtyFlags[idx] & TRANSFORM_CHANGED;
+    }
+
+    // ----------------------------------------------------
+
+    // recompute matrices only of entts which were changed since the prev flush;
+    // NOTE: is supposed to be called once per frame after all the updates
+    void FlushDirty();
+
+    // components accessed during the flush (is used by the update scheduler)
+    static constexpr ComponentBitfield FLUSH_READS  = 0;
+    static constexpr ComponentBitfield FLUSH_WRITES = GetComponentBit(TransformComponent);
+
+    // SORTED arr of entts whose world matrix was changed during the last frame
+    // (so culling, instance buffers, etc. can skip static entts)
+    inline const cvector<EntityID>& GetChangedEntts() const { return pTransform_->changedIds; }
+
+    // ----------------------------------------------------
+
+    // RENDER INTERPOLATION: when the simulation runs with a fixed step the renderer
+    // gets worlds which are blended between the prev and the last simulation step
+
+    // store worlds of entts changed during the prev step;
+    // NOTE: is supposed to be called before each simulation step
+    void BeginSimulationStep();
+
+    // alpha in range [0, 1]: a fraction of the fixed step which was accumulated since the last step
+    inline void  SetInterpolationAlpha(const float alpha) { interpAlpha_ = alpha; }
+    inline float GetInterpolationAlpha() const            { return interpAlpha_; }
+
+    // the same as GetWorlds but worlds of moving entts are interpolated;
+    // NOTE: outWorlds must have space for numEntts matrices
+    void GetRenderWorlds(
+        const EntityID* ids,
+        const size numEntts,
+        DirectX::XMMATRIX* outWorlds);
+
 
 private:
     void AddRecordsToTransformComponent(
@@ -100,6 +204,35 @@ private:
 
     index GetIdx(const EntityID id) const;
 
+    // build world matrices of SoA entts in range [startIdx, endIdx);
+    // NOTE: startIdx must be a multiple of TransformSoA::LANES
+    static void ComputeWorldsSoA(
+        const TransformSoA& soa,
+        const index startIdx,
+        const index endIdx,
+        XMMATRIX* outWorlds);
+
+    void MarkDirtyByIdx(const index idx, const uint8 flags);
+
+    inline void UpdateIfDirtyByIdx(const index idx)
+    {
+        // lazy update: if someone asks for matrices before the flush
+        if (pTransform_->dirtyFlags[idx] & (WORLD_DIRTY | INV_WORLD_DIRTY))
+            UpdateDirtyByIdx(idx);
+    }
+
+    void UpdateDirtyByIdx(const index idx);
+
+    inline void ResolveWorldByIdx(const index idx)
+    {
+        // we must have an actual world matrix before its direct modification
+        if (pTransform_->dirtyFlags[idx] & WORLD_DIRTY)
+        {
+            RecomputeWorldMatrixByIdx(idx);
+            pTransform_->dirtyFlags[idx] &= ~(WORLD_DIRTY | WORLD_NOT_TRS);
+        }
+    }
+
     inline void RecomputeWorldMatrixByIdx(const index idx)
     {
         // recompute world matrix for the entity by array idx
@@ -113,16 +246,51 @@ private:
     {
         // recompute inverse world matrix based on world by array idx;
         // NOTE: expects the world matrix to be computed already!!!
-        pTransform_->invWorlds[idx] = DirectX::XMMatrixInverse(nullptr, pTransform_->worlds[idx]);
+        const XMMATRIX& world = pTransform_->worlds[idx];
+
+        if (pTransform_->dirtyFlags[idx] & WORLD_NOT_TRS)
+            pTransform_->invWorlds[idx] = DirectX::XMMatrixInverse(nullptr, world);
+        else
+            pTransform_->invWorlds[idx] = GetInverseTRS(world);
     }
 
+    inline XMMATRIX GetInverseTRS(const XMMATRIX& w) const
+    {
+        // closed-form inverse of (uniform_scale * rotation * translation) matrix:
+        // the upper 3x3 part is (s * R) so its inverse is (1/s^2) * transpose;
+        // the inverse translation is (-t * inverse_3x3)
+        using namespace DirectX;
+
+        const XMVECTOR invScaleSq = XMVectorReciprocal(XMVector3Dot(w.r[0], w.r[0]));
+
+        XMMATRIX inv = w;
+        inv.r[3] = g_XMIdentityR3;
+        inv = XMMatrixTranspose(inv);
+
+        inv.r[0] = XMVectorMultiply(inv.r[0], invScaleSq);
+        inv.r[1] = XMVectorMultiply(inv.r[1], invScaleSq);
+        inv.r[2] = XMVectorMultiply(inv.r[2], invScaleSq);
+        inv.r[3] = XMVectorSetW(XMVectorNegate(XMVector3TransformNormal(w.r[3], inv)), 1.0f);
+
+        return inv;
+    }
+
+    static XMMATRIX InterpolateWorld(
+        const XMMATRIX& w0,
+        const XMMATRIX& w1,
+        const float alpha,
+        const bool isTRS);
+
     inline XMMATRIX GetMatTranslation(const XMFLOAT4& pos)    const { return DirectX::XMMatrixTranslation(pos.x, pos.y, pos.z); }
     inline XMMATRIX GetMatRotation(const XMVECTOR& direction) const { return DirectX::XMMatrixRotationQuaternion(direction); }
     inline XMMATRIX GetMatScaling(const float uScale)         const { return DirectX::XMMatrixScaling(uScale, uScale, uScale); }
 
 private:
     cvector<index> s_Idxs;              // static array of idxs to elements in array
+    cvector<XMMATRIX> s_Worlds;         // static array of world matrices computed by the bulk update
+    TransformSoA s_SoA;                 // static transformation data for the bulk update
     Transform* pTransform_ = nullptr;   // a ptr to the Transform component
+    float interpAlpha_ = 1.0f;          // 1 == use the last simulated worlds as is
 };
 
 }
@@ -0,0 +1,1624 @@
+// =================================================================================
+// Filename:     WorldPartitionSystem.cpp
+// Description:  implementation of the WorldPartitionSystem's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "WorldPartitionSystem.h"
+#include "../Entity/EntityMgr.h"
+#include <Profiler.h>
+#include <HitchRecorder.h>
+#include <MemTracker.h>
+#include <filesystem>
+
+using namespace DirectX;
+
+
+namespace ECS
+{
+
+// entts with these components are never streamed out
+static constexpr ComponentBitfield PINNED_COMPONENTS =
+    GetComponentBit(CameraComponent)            |
+    GetComponentBit(PlayerComponent)            |
+    GetComponentBit(HierarchyComponent)         |
+    GetComponentBit(TextureTransformComponent);
+
+// cameras and the player are never dormant (the player is the focus of the partition)
+static constexpr ComponentBitfield NOT_PARTITIONED_COMPONENTS =
+    GetComponentBit(CameraComponent) |
+    GetComponentBit(PlayerComponent);
+
+///////////////////////////////////////////////////////////
+
+template <typename T>
+inline static index FindSorted(const cvector<T>& arr, const T& value)
+{
+    // return an idx of the value in the SORTED array or -1 if there is no such value
+    const index idx = arr.get_idx(value);
+    return ((idx >= 0) && (arr[idx] == value)) ? idx : -1;
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename T>
+static void GetRecordsIdxs(
+    const T& comp,
+    const cvector<EntityID>& ids,
+    cvector<EntityID>& outIds,
+    cvector<index>& outIdxs)
+{
+    // out: input entts which have a record in the component and idxs of these records
+
+    const SparseSet& sparseIdxs = ComponentTraits<T>::GetSparseIdxs(comp);
+
+    outIds.clear();
+    outIdxs.clear();
+
+    for (const EntityID id : ids)
+    {
+        const index idx = sparseIdxs.GetIdx(id);
+
+        if (idx != SparseSet::INVALID_IDX)
+        {
+            outIds.push_back(id);
+            outIdxs.push_back(idx);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+static void GetRestoredIdxs(
+    const cvector<EntityID>& recordsIds,
+    const cvector<EntityID>& restoredIds,
+    cvector<EntityID>& outIds,
+    cvector<index>& outIdxs)
+{
+    // out: records of a chunk file which belong to restored entts (both inputs are SORTED)
+
+    outIds.clear();
+    outIdxs.clear();
+
+    for (index i = 0; i < recordsIds.size(); ++i)
+    {
+        if (restoredIds.binary_search(recordsIds[i]))
+        {
+            outIds.push_back(recordsIds[i]);
+            outIdxs.push_back(i);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+static void GetOffsets(const cvector<uint32>& counts, cvector<uint32>& outOffsets)
+{
+    // offsets of variable-length records in a flattened array
+    outOffsets.resize(counts.size());
+
+    for (uint32 i = 0, offset = 0; i < (uint32)counts.size(); offset += counts[i++])
+        outOffsets[i] = offset;
+}
+
+
+// =================================================================================
+// Constructor / destructor
+// =================================================================================
+WorldPartitionSystem::WorldPartitionSystem(EntityMgr* pEnttMgr) :
+    pEnttMgr_(pEnttMgr)
+{
+    CAssert::NotNullptr(pEnttMgr, "input ptr to the entity manager == nullptr");
+}
+
+///////////////////////////////////////////////////////////
+
+WorldPartitionSystem::~WorldPartitionSystem()
+{
+    // data of the entity manager can be already destroyed so
+    // pending chunk files are only finished but not merged
+    g_JobSystem.Wait(ioCounter_);
+
+    for (PendingIO* pPending : pendingIO_)
+        SafeDelete(pPending);
+}
+
+
+// =================================================================================
+// Serialization / deserialization
+// =================================================================================
+void WorldPartitionSystem::Serialize(WorldFileWriter& writer)
+{
+    // entts of saving chunks are still resident so they are
+    // in the world file; loading chunks are still in their files
+
+    cvector<ChunkKey> unloadedKeys;
+
+    for (index i = 0; i < chunkKeys_.size(); ++i)
+    {
+        if ((chunkStates_[i] == CHUNK_UNLOADED) || (chunkStates_[i] == CHUNK_LOADING))
+            unloadedKeys.push_back(chunkKeys_[i]);
+    }
+
+    writer.BeginChunk(WORLD_PARTITION_DATA_BLOCK_MARKER);
+    writer.WriteArray(unloadedKeys);
+    writer.EndChunk();
+}
+
+///////////////////////////////////////////////////////////
+
+bool WorldPartitionSystem::Deserialize(WorldFileReader& reader)
+{
+    // NOTE: is called after all the systems were deserialized
+
+    Reset();
+
+    // world files without the partition don't have unloaded chunks
+    if (!reader.BeginChunk(WORLD_PARTITION_DATA_BLOCK_MARKER))
+        return true;
+
+    cvector<ChunkKey> unloadedKeys;
+
+    if (!reader.ReadArray(unloadedKeys))
+    {
+        LogErr("world partition data in the world file is corrupted");
+        return false;
+    }
+
+    std::sort(unloadedKeys.begin(), unloadedKeys.end());
+
+    for (const ChunkKey key : unloadedKeys)
+    {
+        chunkKeys_.push_back(key);
+        chunkStates_.push_back(CHUNK_UNLOADED);
+        chunkEntts_.push_back(cvector<EntityID>());
+    }
+
+    // without the partition nobody will load these chunks so load them right now
+    if (!isActive_ || !params_.isStreaming)
+    {
+        bool result = true;
+
+        for (index i = 0; i < chunkKeys_.size(); ++i)
+            result &= LoadChunkNow(i);
+
+        return result;
+    }
+
+    return true;
+}
+
+
+// =================================================================================
+// Initialization / shutdown
+// =================================================================================
+bool WorldPartitionSystem::Initialize(const WorldPartitionParams& params)
+{
+    if (params.chunkDimension <= 0.0f)
+    {
+        LogErr("can't initialize the world partition: chunk dimension must be > 0");
+        return false;
+    }
+
+    params_ = params;
+
+    // a chunk must become dormant before it is unloaded
+    params_.unloadDist = std::max(params_.unloadDist, params_.activeDist + params_.hysteresis);
+
+    if (params_.isStreaming)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(params_.dirPath, ec);
+
+        if (ec)
+        {
+            sprintf(g_String, "can't create a directory for chunk files: %s", params_.dirPath);
+            LogErr(g_String);
+            return false;
+        }
+    }
+
+    // all the entts will be assigned by the next update
+    structureVersion_ = UINT32_MAX;
+    isActive_         = true;
+
+    sprintf(g_String, "world partition is initialized (chunk: %.1f, active: %.1f, unload: %.1f, streaming: %d)",
+        params_.chunkDimension, params_.activeDist, params_.unloadDist, (int)params_.isStreaming);
+    LogMsg(g_String);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldPartitionSystem::Shutdown()
+{
+    FinishIO();
+
+    // load chunks back so no entts are only in chunk files
+    for (index i = 0; i < chunkKeys_.size(); ++i)
+    {
+        if (chunkStates_[i] == CHUNK_UNLOADED)
+            LoadChunkNow(i);
+    }
+
+    Reset();
+    isActive_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldPartitionSystem::Reset()
+{
+    // drop all the chunks and make all the entts active again
+
+    g_JobSystem.Wait(ioCounter_);
+
+    for (PendingIO* pPending : pendingIO_)
+        SafeDelete(pPending);
+
+    pendingIO_.clear();
+
+    chunkKeys_.clear();
+    chunkStates_.clear();
+    chunkEntts_.clear();
+    ids_.clear();
+    enttsChunks_.clear();
+    touchedIds_.clear();
+    brokenChunks_.clear();
+    dormant_.Clear();
+
+    pEnttMgr_->moveSystem_.ClearDormant();
+    pEnttMgr_->particleSystem_.ClearDormant();
+    pEnttMgr_->animationSystem_.ClearDormant();
+
+    structureVersion_ = UINT32_MAX;
+}
+
+
+// =================================================================================
+// Update
+// =================================================================================
+void WorldPartitionSystem::Update(const XMFLOAT3& focusPos)
+{
+    if (!isActive_)
+        return;
+
+    MEM_TAG_SCOPE(MEM_TAG_ECS);
+    PROFILE_SCOPE("WorldPartition::Update");
+
+    // chunks change their states before entts are (re)assigned
+    // so new entts get the final state of their chunk
+    FinishPendingIO();
+    UpdateChunksStates(focusPos);
+
+    if (structureVersion_ != pEnttMgr_->GetStructureVersion())
+        SyncEntts(focusPos);
+
+    ReassignMovedEntts(focusPos);
+    ApplyDormancy();
+
+    structureVersion_ = pEnttMgr_->GetStructureVersion();
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldPartitionSystem::FinishIO()
+{
+    // the waiting thread helps to execute writing/reading jobs
+    g_JobSystem.Wait(ioCounter_);
+    FinishPendingIO();
+    ApplyDormancy();
+}
+
+///////////////////////////////////////////////////////////
+
+size WorldPartitionSystem::GetNumChunksByState(const eChunkState state) const
+{
+    return (size)std::count(chunkStates_.begin(), chunkStates_.end(), (uint8)state);
+}
+
+
+// =================================================================================
+// Private methods: states of chunks
+// =================================================================================
+void WorldPartitionSystem::UpdateChunksStates(const XMFLOAT3& focusPos)
+{
+    // change states by the distance to the focus; a chunk goes back only
+    // beyond the hysteresis margin so chunks on a border don't flip
+
+    const float wakeDist  = params_.activeDist;
+    const float sleepDist = params_.activeDist + params_.hysteresis;
+    const float loadDist  = params_.unloadDist;
+    const float saveDist  = params_.unloadDist + params_.hysteresis;
+    int         numIO     = 0;
+
+    for (index i = 0; i < chunkKeys_.size(); ++i)
+    {
+        const float dist     = GetDistToChunk(chunkKeys_[i], focusPos);
+        const bool  isBroken = brokenChunks_.binary_search(chunkKeys_[i]);
+
+        switch (chunkStates_[i])
+        {
+            case CHUNK_ACTIVE:
+            {
+                if (dist > sleepDist)
+                {
+                    chunkStates_[i] = CHUNK_DORMANT;
+                    touchedIds_.append_vector(chunkEntts_[i]);
+                }
+                break;
+            }
+            case CHUNK_DORMANT:
+            {
+                if (dist <= wakeDist)
+                {
+                    chunkStates_[i] = CHUNK_ACTIVE;
+                    touchedIds_.append_vector(chunkEntts_[i]);
+                }
+                else if (params_.isStreaming && (dist > saveDist) && !isBroken && (numIO < MAX_IO_PER_UPDATE))
+                {
+                    numIO += StartSaving(i);
+                }
+                break;
+            }
+            case CHUNK_UNLOADED:
+            {
+                if ((dist <= loadDist) && !isBroken && (numIO < MAX_IO_PER_UPDATE))
+                {
+                    StartLoading(i);
+                    ++numIO;
+                }
+                break;
+            }
+            default:
+            {
+                // the chunk file is being written/read
+                break;
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldPartitionSystem::ApplyDormancy()
+{
+    // each touched entt is dormant if its chunk isn't active
+    // (or it isn't dormant anymore if it was removed from the partition)
+
+    if (touchedIds_.empty())
+        return;
+
+    std::sort(touchedIds_.begin(), touchedIds_.end());
+    touchedIds_.resize(std::unique(touchedIds_.begin(), touchedIds_.end()) - touchedIds_.begin());
+
+    cvector<EntityID> toSleep;
+    cvector<EntityID> toWake;
+
+    for (const EntityID id : touchedIds_)
+    {
+        const index enttIdx   = FindSorted(ids_, id);
+        bool        isDormant = false;
+
+        if (enttIdx != -1)
+        {
+            const index chunkIdx = GetChunkIdx(enttsChunks_[enttIdx]);
+            isDormant = (chunkStates_[chunkIdx] != CHUNK_ACTIVE);
+        }
+
+        if (isDormant && !dormant_.IsDormant(id))
+            toSleep.push_back(id);
+
+        else if (!isDormant && dormant_.IsDormant(id))
+            toWake.push_back(id);
+    }
+
+    touchedIds_.clear();
+
+    MoveSystem&      moveSys     = pEnttMgr_->moveSystem_;
+    ParticleSystem&  particleSys = pEnttMgr_->particleSystem_;
+    AnimationSystem& animSys     = pEnttMgr_->animationSystem_;
+
+    dormant_   .Set(toWake.data(), toWake.size(), false);
+    moveSys    .SetDormant(toWake.data(), toWake.size(), false);
+    particleSys.SetDormant(toWake.data(), toWake.size(), false);
+    animSys    .SetDormant(toWake.data(), toWake.size(), false);
+
+    dormant_   .Set(toSleep.data(), toSleep.size(), true);
+    moveSys    .SetDormant(toSleep.data(), toSleep.size(), true);
+    particleSys.SetDormant(toSleep.data(), toSleep.size(), true);
+    animSys    .SetDormant(toSleep.data(), toSleep.size(), true);
+}
+
+
+// =================================================================================
+// Private methods: assignment of entts
+// =================================================================================
+void WorldPartitionSystem::SyncEntts(const XMFLOAT3& focusPos)
+{
+    // after entts were created/destroyed: assign new entts which have
+    // the Transform component and remove destroyed ones (a single merge
+    // pass over the SORTED ids of the partition and of the Transform)
+
+    const EntityMgr&         mgr        = *pEnttMgr_;
+    const cvector<EntityID>& transforms = mgr.GetComponent<Transform>().ids;
+
+    tmpIds_.clear();
+
+    index i = 0;
+    index t = 1;                      // the first transform record is of the "invalid" entt
+
+    while ((i < ids_.size()) || (t < transforms.size()))
+    {
+        const EntityID partId = (i < ids_.size())       ? ids_[i]       : UINT32_MAX;
+        const EntityID trId   = (t < transforms.size()) ? transforms[t] : UINT32_MAX;
+
+        if (partId == trId)
+        {
+            ++i;
+            ++t;
+        }
+        // the entt was destroyed (or lost its transform)
+        else if (partId < trId)
+        {
+            RemoveEnttFromChunk(partId, enttsChunks_[i]);
+            touchedIds_.push_back(partId);
+            tmpIds_.push_back(partId);
+            ++i;
+        }
+        // a new entt
+        else
+        {
+            const index idx = mgr.sparseIdxs_.GetIdx(trId);
+
+            if ((idx != SparseSet::INVALID_IDX) && !(mgr.componentHashes_[idx] & NOT_PARTITIONED_COMPONENTS))
+            {
+                const ChunkKey key = GetKeyByPos(mgr.transformSystem_.GetPosition(trId));
+                const index    pos = ids_.get_insert_idx(trId);
+
+                ids_.insert_before(pos, trId);
+                enttsChunks_.insert_before(pos, key);
+                AddEnttToChunk(trId, GetOrAddChunk(key, focusPos));
+                touchedIds_.push_back(trId);
+                ++i;
+            }
+            ++t;
+        }
+    }
+
+    // remove records of destroyed entts with a single pass
+    if (!tmpIds_.empty())
+    {
+        cvector<index> idxs;
+        ids_.get_idxs(tmpIds_, idxs);
+        ids_.erase_by_idxs(idxs);
+        enttsChunks_.erase_by_idxs(idxs);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldPartitionSystem::ReassignMovedEntts(const XMFLOAT3& focusPos)
+{
+    // entts which were moved during the last step can go into another chunk
+
+    const EntityMgr&         mgr     = *pEnttMgr_;
+    const cvector<EntityID>& changed = mgr.transformSystem_.GetChangedEntts();
+
+    for (const EntityID id : changed)
+    {
+        const index enttIdx = FindSorted(ids_, id);
+
+        if ((enttIdx == -1) || !mgr.CheckEnttExist(id))
+            continue;
+
+        const ChunkKey key = GetKeyByPos(mgr.transformSystem_.GetPosition(id));
+
+        if (key == enttsChunks_[enttIdx])
+            continue;
+
+        RemoveEnttFromChunk(id, enttsChunks_[enttIdx]);
+        AddEnttToChunk(id, GetOrAddChunk(key, focusPos));
+
+        enttsChunks_[enttIdx] = key;
+        touchedIds_.push_back(id);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldPartitionSystem::AddEnttToChunk(const EntityID id, const index chunkIdx)
+{
+    cvector<EntityID>& entts = chunkEntts_[chunkIdx];
+    entts.insert_before(entts.get_insert_idx(id), id);
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldPartitionSystem::RemoveEnttFromChunk(const EntityID id, const ChunkKey key)
+{
+    const index chunkIdx = GetChunkIdx(key);
+
+    if (chunkIdx == -1)
+        return;
+
+    cvector<EntityID>& entts = chunkEntts_[chunkIdx];
+    const index        idx   = FindSorted(entts, id);
+
+    if (idx != -1)
+        entts.erase(idx);
+}
+
+///////////////////////////////////////////////////////////
+
+index WorldPartitionSystem::GetChunkIdx(const ChunkKey key) const
+{
+    return FindSorted(chunkKeys_, key);
+}
+
+///////////////////////////////////////////////////////////
+
+index WorldPartitionSystem::GetOrAddChunk(const ChunkKey key, const XMFLOAT3& focusPos)
+{
+    // return an idx of the chunk by key; a new chunk gets a state by its distance
+
+    const index chunkIdx = GetChunkIdx(key);
+
+    if (chunkIdx != -1)
+        return chunkIdx;
+
+    const bool  isActive = (GetDistToChunk(key, focusPos) <= params_.activeDist);
+    const index idx      = chunkKeys_.get_insert_idx(key);
+
+    chunkKeys_.insert_before(idx, key);
+    chunkStates_.insert_before(idx, (uint8)((isActive) ? CHUNK_ACTIVE : CHUNK_DORMANT));
+    chunkEntts_.insert_before(idx, cvector<EntityID>());
+
+    return idx;
+}
+
+///////////////////////////////////////////////////////////
+
+ChunkKey WorldPartitionSystem::GetKeyByPos(const XMFLOAT3& pos) const
+{
+    const float invDim = 1.0f / params_.chunkDimension;
+    return MakeChunkKey((int)floorf(pos.x * invDim), (int)floorf(pos.z * invDim));
+}
+
+///////////////////////////////////////////////////////////
+
+float WorldPartitionSystem::GetDistToChunk(const ChunkKey key, const XMFLOAT3& pos) const
+{
+    // distance in the XZ-plane from the point to the chunk's rect (0 if the point is inside)
+
+    const float dim  = params_.chunkDimension;
+    const float minX = (float)GetChunkX(key) * dim;
+    const float minZ = (float)GetChunkZ(key) * dim;
+
+    const float dx = std::max(0.0f, std::max(minX - pos.x, pos.x - (minX + dim)));
+    const float dz = std::max(0.0f, std::max(minZ - pos.z, pos.z - (minZ + dim)));
+
+    return sqrtf(dx*dx + dz*dz);
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldPartitionSystem::GetChunkPath(const ChunkKey key, char* outPath, const int pathSize) const
+{
+    snprintf(outPath, pathSize, "%scell_%d_%d.bin", params_.dirPath, GetChunkX(key), GetChunkZ(key));
+}
+
+
+// =================================================================================
+// Private methods: streaming
+// =================================================================================
+bool WorldPartitionSystem::IsStreamable(const EntityID id) const
+{
+    // can the entt be saved into a chunk file and restored from it by the Add*Component API
+
+    const EntityMgr& mgr = *pEnttMgr_;
+    const index      idx = mgr.sparseIdxs_.GetIdx(id);
+
+    if ((idx == SparseSet::INVALID_IDX) || (mgr.componentHashes_[idx] & PINNED_COMPONENTS))
+        return false;
+
+    // hierarchies are stored only in the world file
+    if (mgr.GetComponent<Hierarchy>().sparseIdxs.Has(id))
+        return false;
+
+    // animations of lights refer to other entts (and directional lights have no positions)
+    const Light& light = mgr.GetComponent<Light>();
+
+    if (light.sparseIdxs.Has(id))
+    {
+        if (light.dirLights.sparseIdxs.Has(id) ||
+            light.flickers.sparseIdxs.Has(id) ||
+            light.orbits.sparseIdxs.Has(id) ||
+            light.follows.sparseIdxs.Has(id))
+            return false;
+    }
+
+    if (std::find(light.follows.targetIds.begin(), light.follows.targetIds.end(), id) != light.follows.targetIds.end())
+        return false;
+
+    // a merged static mesh renders this entt
+    const Rendered& rendered   = mgr.GetComponent<Rendered>();
+    const index     renderIdx  = rendered.sparseIdxs.GetIdx(id);
+
+    if ((renderIdx != SparseSet::INVALID_IDX) && (rendered.mergedInto[renderIdx] != INVALID_ENTITY_ID))
+        return false;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool WorldPartitionSystem::StartSaving(const index chunkIdx)
+{
+    // write streamable entts of the chunk into the chunk file by a job;
+    // entts are removed only after the file is written (see FinishPendingIO)
+    // return: false if there is nothing to save in the chunk
+
+    tmpIds_.clear();
+
+    for (const EntityID id : chunkEntts_[chunkIdx])
+    {
+        if (IsStreamable(id))
+            tmpIds_.push_back(id);
+    }
+
+    if (tmpIds_.empty())
+        return false;
+
+    PendingIO* pPending = new PendingIO();
+    pPending->key    = chunkKeys_[chunkIdx];
+    pPending->isSave = true;
+    pPending->ids    = tmpIds_;
+    GetChunkPath(pPending->key, pPending->path, sizeof(pPending->path));
+
+    try
+    {
+        WriteChunkFile(pPending->ids, pPending->writer);
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        sprintf(g_String, "can't write the chunk file: %s", pPending->path);
+        LogErr(g_String);
+
+        brokenChunks_.insert_before(brokenChunks_.get_insert_idx(pPending->key), pPending->key);
+        SafeDelete(pPending);
+        return false;
+    }
+
+    chunkStates_[chunkIdx] = CHUNK_SAVING;
+    pendingIO_.push_back(pPending);
+
+    g_JobSystem.Run([pPending]()
+    {
+        pPending->result = pPending->writer.SaveToFile(pPending->path);
+        pPending->isDone.store(true, std::memory_order_release);
+    }, &ioCounter_);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldPartitionSystem::StartLoading(const index chunkIdx)
+{
+    // read the chunk file by a job (it is merged by FinishPendingIO)
+
+    PendingIO* pPending = new PendingIO();
+    pPending->key       = chunkKeys_[chunkIdx];
+    pPending->isSave    = false;
+    GetChunkPath(pPending->key, pPending->path, sizeof(pPending->path));
+
+    chunkStates_[chunkIdx] = CHUNK_LOADING;
+    pendingIO_.push_back(pPending);
+
+    g_JobSystem.Run([pPending]()
+    {
+        MEM_TAG_SCOPE(MEM_TAG_ECS);
+        HitchEventScope hitchEvent("world chunk", pPending->path);
+
+        pPending->result = pPending->reader.LoadFromFile(pPending->path);
+        pPending->isDone.store(true, std::memory_order_release);
+    }, &ioCounter_);
+}
+
+///////////////////////////////////////////////////////////
+
+bool WorldPartitionSystem::LoadChunkNow(const index chunkIdx)
+{
+    // read and merge the unloaded chunk by the calling thread
+
+    char path[128]{ '\0' };
+    GetChunkPath(chunkKeys_[chunkIdx], path, sizeof(path));
+
+    WorldFileReader   reader;
+    cvector<EntityID> restoredIds;
+    HitchEventScope   hitchEvent("world chunk (sync)", path);
+
+    if (!reader.LoadFromFile(path) || !MergeChunkFile(reader, restoredIds))
+    {
+        sprintf(g_String, "can't load entts of the chunk file: %s", path);
+        LogErr(g_String);
+        return false;
+    }
+
+    chunkStates_[chunkIdx] = CHUNK_DORMANT;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void WorldPartitionSystem::FinishPendingIO()
+{
+    // remove entts of saved chunks and merge loaded chunks
+    // (the order of the rest pending files is kept)
+
+    if (pendingIO_.empty())
+        return;
+
+    index numLeft = 0;
+
+    for (PendingIO* pPending : pendingIO_)
+    {
+        if (!pPending->isDone.load(std::memory_order_acquire))
+        {
+            pendingIO_[numLeft++] = pPending;
+            continue;
+        }
+
+        const index chunkIdx = GetChunkIdx(pPending->key);
+
+        if (pPending->isSave)
+        {
+            if (pPending->result)
+            {
+                // entts which left the chunk while it was saved stay resident
+                // (they are skipped when the chunk is loaded again)
+                const cvector<EntityID>& resident = chunkEntts_[chunkIdx];
+                tmpIds_.clear();
+
+                for (const EntityID id : pPending->ids)
+                {
+                    if (resident.binary_search(id) && pEnttMgr_->CheckEnttExist(id))
+                        tmpIds_.push_back(id);
+                }
+
+                // slots aren't recycled so the entts are restored with the same IDs
+                if (!tmpIds_.empty())
+                    pEnttMgr_->DestroyEntities(tmpIds_.data(), tmpIds_.size(), false);
+
+                chunkStates_[chunkIdx] = CHUNK_UNLOADED;
+            }
+            else
+            {
+                sprintf(g_String, "can't save the chunk file (the chunk stays resident): %s", pPending->path);
+                LogErr(g_String);
+
+                brokenChunks_.insert_before(brokenChunks_.get_insert_idx(pPending->key), pPending->key);
+                chunkStates_[chunkIdx] = CHUNK_DORMANT;
+            }
+        }
+        else
+        {
+            cvector<EntityID> restoredIds;
+
+            if (pPending->result && MergeChunkFile(pPending->reader, restoredIds))
+            {
+                // restored entts are assigned by the next sync
+                chunkStates_[chunkIdx] = CHUNK_DORMANT;
+            }
+            else
+            {
+                sprintf(g_String, "can't load entts of the chunk file: %s", pPending->path);
+                LogErr(g_String);
+
+                brokenChunks_.insert_before(brokenChunks_.get_insert_idx(pPending->key), pPending->key);
+                chunkStates_[chunkIdx] = CHUNK_UNLOADED;
+            }
+        }
+
+        SafeDelete(pPending);
+    }
+
+    pendingIO_.resize(numLeft);
+}
+
+
+// =================================================================================
+// Private methods: chunk files
+// =================================================================================
+void WorldPartitionSystem::WriteChunkFile(const cvector<EntityID>& ids, WorldFileWriter& writer) const
+{
+    // write records of the input entts (SORTED) as chunks by components;
+    // (each component's chunk contains ids of its records and data arrays
+    // which are exactly what the Add*Component API takes)
+
+    const EntityMgr& mgr = *pEnttMgr_;
+    cvector<EntityID> recIds;
+    cvector<index>    idxs;
+
+    writer.BeginChunk(CHUNK_FILE_ENTTS_MARKER);
+    writer.WriteArray(ids);
+    writer.EndChunk();
+
+    // NAME: a single blob of chars + length of each name
+    {
+        const Name& comp = mgr.GetComponent<Name>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<uint32> lengths(recIds.size());
+        cvector<char>   chars;
+
+        for (index i = 0; i < idxs.size(); ++i)
+        {
+            const StrHandle name = comp.names_[idxs[i]];
+            const char*     str  = comp.strings_.GetStr(name);
+
+            lengths[i] = comp.strings_.GetLength(name);
+            chars.append_vector(cvector<char>(str, str + lengths[i]));
+        }
+
+        writer.BeginChunk(NameComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(lengths);
+        writer.WriteArray(chars);
+        writer.EndChunk();
+    }
+
+    // TRANSFORM
+    {
+        GetRecordsIdxs(mgr.GetComponent<Transform>(), ids, recIds, idxs);
+
+        cvector<XMFLOAT3> positions;
+        cvector<XMVECTOR> directions;
+        cvector<float>    scales;
+
+        mgr.transformSystem_.GetPositions    (recIds.data(), recIds.size(), positions);
+        mgr.transformSystem_.GetDirections   (recIds.data(), recIds.size(), directions);
+        mgr.transformSystem_.GetUniformScales(recIds.data(), recIds.size(), scales);
+
+        writer.BeginChunk(TransformComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(positions);
+        writer.WriteArray(directions);
+        writer.WriteArray(scales);
+        writer.EndChunk();
+    }
+
+    // MOVEMENT
+    {
+        const Movement& comp = mgr.GetComponent<Movement>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<XMFLOAT4> trScales;
+        cvector<XMVECTOR> rotQuats;
+        comp.translationAndUniScales_.get_data_by_idxs(idxs, trScales);
+        comp.rotationQuats_.get_data_by_idxs(idxs, rotQuats);
+
+        writer.BeginChunk(MoveComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(trScales);
+        writer.WriteArray(rotQuats);
+        writer.EndChunk();
+    }
+
+    // MODEL
+    {
+        const Model& comp = mgr.GetComponent<Model>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<ModelID> modelIDs;
+        comp.modelIDs_.get_data_by_idxs(idxs, modelIDs);
+
+        writer.BeginChunk(ModelComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(modelIDs);
+        writer.EndChunk();
+    }
+
+    // RENDERED
+    {
+        const Rendered& comp = mgr.GetComponent<Rendered>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<RenderShaderType>         shaderTypes;
+        cvector<D3D11_PRIMITIVE_TOPOLOGY> topologies;
+        cvector<float>                    smallCullFactors;
+        cvector<uint8>                    staticFlags;
+
+        comp.shaderTypes.get_data_by_idxs(idxs, shaderTypes);
+        comp.primTopologies.get_data_by_idxs(idxs, topologies);
+        comp.smallCullFactors.get_data_by_idxs(idxs, smallCullFactors);
+        comp.staticFlags.get_data_by_idxs(idxs, staticFlags);
+
+        writer.BeginChunk(RenderedComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(shaderTypes);
+        writer.WriteArray(topologies);
+        writer.WriteArray(smallCullFactors);
+        writer.WriteArray(staticFlags);
+        writer.EndChunk();
+    }
+
+    // MATERIAL: materials of all the entts are flattened
+    {
+        const Material& comp = mgr.GetComponent<Material>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<uint32>     counts(recIds.size());
+        cvector<MaterialID> materialsIDs;
+        cvector<uint8>      meshBasedFlags(recIds.size());
+
+        for (index i = 0; i < idxs.size(); ++i)
+        {
+            const SubsetSpan<MaterialID> matIDs = comp.materials.GetSpan(idxs[i]);
+
+            counts[i]         = (uint32)matIDs.size();
+            meshBasedFlags[i] = (uint8)comp.flagsMeshBasedMaterials[idxs[i]];
+            materialsIDs.append_vector(matIDs);
+        }
+
+        writer.BeginChunk(MaterialComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(counts);
+        writer.WriteArray(materialsIDs);
+        writer.WriteArray(meshBasedFlags);
+        writer.EndChunk();
+    }
+
+    // RENDER STATES
+    {
+        const RenderStates& comp = mgr.GetComponent<RenderStates>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<u32> hashes;
+        comp.statesHashes_.get_data_by_idxs(idxs, hashes);
+
+        writer.BeginChunk(RenderStatesComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(hashes);
+        writer.EndChunk();
+    }
+
+    // BOUNDING: local boxes of meshes of all the entts are flattened
+    // (the OBBs are made from AABBs so they aren't rotated)
+    {
+        const Bounding& comp = mgr.GetComponent<Bounding>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<uint32>               counts(recIds.size());
+        cvector<BoundingType>         types;
+        cvector<DirectX::BoundingBox> AABBs;
+
+        for (index i = 0; i < idxs.size(); ++i)
+        {
+            const uint32                        count  = comp.obbs.GetCount(idxs[i]);
+            const DirectX::BoundingOrientedBox* obbs   = comp.obbs.Get(idxs[i]);
+            const BoundingType*                 pTypes = comp.types.Get(idxs[i]);
+            counts[i] = count;
+
+            for (index j = 0; j < count; ++j)
+            {
+                types.push_back(pTypes[j]);
+                AABBs.push_back(DirectX::BoundingBox(obbs[j].Center, obbs[j].Extents));
+            }
+        }
+
+        writer.BeginChunk(BoundingComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(counts);
+        writer.WriteArray(types);
+        writer.WriteArray(AABBs);
+        writer.EndChunk();
+    }
+
+    // LIGHT: point lights and spotlights (positions/directions are in the Transform)
+    {
+        const LightSystem& lightSys = mgr.lightSystem_;
+        const Light&       comp     = mgr.GetComponent<Light>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<EntityID>   pointIds;
+        cvector<PointLight> pointLights;
+        cvector<uint8>      pointActive;
+        cvector<EntityID>   spotIds;
+        cvector<SpotLight>  spotLights;
+        cvector<uint8>      spotActive;
+
+        for (index i = 0; i < idxs.size(); ++i)
+        {
+            const EntityID id = recIds[i];
+
+            if (comp.types[idxs[i]] == POINT)
+            {
+                PointLight light;
+                lightSys.GetPointLightData(id, light);
+
+                pointIds.push_back(id);
+                pointLights.push_back(light);
+                pointActive.push_back((uint8)comp.isActive[idxs[i]]);
+            }
+            else if (comp.types[idxs[i]] == SPOT)
+            {
+                SpotLight light;
+                lightSys.GetSpotLightData(id, light);
+
+                spotIds.push_back(id);
+                spotLights.push_back(light);
+                spotActive.push_back((uint8)comp.isActive[idxs[i]]);
+            }
+        }
+
+        writer.BeginChunk(LightComponent);
+        writer.WriteArray(pointIds);
+        writer.WriteArray(pointLights);
+        writer.WriteArray(pointActive);
+        writer.WriteArray(spotIds);
+        writer.WriteArray(spotLights);
+        writer.WriteArray(spotActive);
+        writer.EndChunk();
+    }
+
+    // SOUND EMITTER
+    {
+        const SoundEmitter& comp = mgr.GetComponent<SoundEmitter>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<uint32> soundIds;
+        cvector<float>  volumes;
+        cvector<float>  minDists;
+        cvector<float>  maxDists;
+        cvector<uint8>  priorities;
+
+        comp.soundIds_.get_data_by_idxs(idxs, soundIds);
+        comp.volumes_.get_data_by_idxs(idxs, volumes);
+        comp.minDists_.get_data_by_idxs(idxs, minDists);
+        comp.maxDists_.get_data_by_idxs(idxs, maxDists);
+        comp.priorities_.get_data_by_idxs(idxs, priorities);
+
+        writer.BeginChunk(SoundEmitterComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(soundIds);
+        writer.WriteArray(volumes);
+        writer.WriteArray(minDists);
+        writer.WriteArray(maxDists);
+        writer.WriteArray(priorities);
+        writer.EndChunk();
+    }
+
+    // PARTICLE EMITTER
+    {
+        const ParticleEmitter& comp = mgr.GetComponent<ParticleEmitter>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<ParticleEmitterParams> params;
+        comp.params_.get_data_by_idxs(idxs, params);
+
+        writer.BeginChunk(ParticleEmitterComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(params);
+        writer.EndChunk();
+    }
+
+    // COLLIDER: the shape is made again from the restored bounds
+    {
+        const Collider& comp = mgr.GetComponent<Collider>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<uint8>  shapes(recIds.size());
+        cvector<uint32> layers(recIds.size());
+        cvector<uint32> masks(recIds.size());
+
+        for (index i = 0; i < idxs.size(); ++i)
+        {
+            const ColliderData& data = comp.data_[idxs[i]];
+            shapes[i] = data.shape;
+            layers[i] = data.layer;
+            masks[i]  = data.mask;
+        }
+
+        writer.BeginChunk(ColliderComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(shapes);
+        writer.WriteArray(layers);
+        writer.WriteArray(masks);
+        writer.EndChunk();
+    }
+
+    // ANIMATOR
+    {
+        const Animator& comp = mgr.GetComponent<Animator>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<uint16> clipIdxs;
+        cvector<float>  times;
+        cvector<float>  speeds;
+
+        comp.clipIdxs_.get_data_by_idxs(idxs, clipIdxs);
+        comp.times_.get_data_by_idxs(idxs, times);
+        comp.speeds_.get_data_by_idxs(idxs, speeds);
+
+        writer.BeginChunk(AnimatorComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(clipIdxs);
+        writer.WriteArray(times);
+        writer.WriteArray(speeds);
+        writer.EndChunk();
+    }
+
+    // PORTAL
+    {
+        const Portal& comp = mgr.GetComponent<Portal>();
+        GetRecordsIdxs(comp, ids, recIds, idxs);
+
+        cvector<PortalData> data;
+        comp.data_.get_data_by_idxs(idxs, data);
+
+        writer.BeginChunk(PortalComponent);
+        writer.WriteArray(recIds);
+        writer.WriteArray(data);
+        writer.EndChunk();
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool WorldPartitionSystem::MergeChunkFile(WorldFileReader& reader, cvector<EntityID>& outIds)
+{
+    // restore entts of the chunk file with their IDs and add all their
+    // components by the same API as the scene is built (so hashes of
+    // components, queries, and all the systems are updated as usual)
+    // out: IDs of restored entts (SORTED)
+
+    EntityMgr& mgr = *pEnttMgr_;
+    cvector<EntityID> fileIds;
+
+    if (!reader.BeginChunk(CHUNK_FILE_ENTTS_MARKER) || !reader.ReadArray(fileIds))
+    {
+        LogErr("there is no entts data in the chunk file");
+        return false;
+    }
+
+    // entts which are already resident (they left the chunk while it was saved) are skipped
+    outIds.clear();
+
+    for (const EntityID id : fileIds)
+    {
+        if (!mgr.CheckEnttExist(id))
+            outIds.push_back(id);
+    }
+
+    if (outIds.empty())
+        return true;
+
+    if (!mgr.RestoreEntities(outIds.data(), outIds.size()))
+        return false;
+
+    cvector<EntityID> recIds;
+    cvector<EntityID> ids;
+    cvector<index>    idxs;
+    bool              result = true;
+
+    // NAME
+    {
+        cvector<uint32> lengths;
+        cvector<char>   chars;
+        cvector<uint32> offsets;
+
+        result &= reader.BeginChunk(NameComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(lengths);
+        result &= reader.ReadArray(chars);
+        result &= (lengths.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+            GetOffsets(lengths, offsets);
+
+            cvector<std::string> names(ids.size());
+
+            for (index i = 0; i < idxs.size(); ++i)
+                names[i].assign(chars.data() + offsets[idxs[i]], lengths[idxs[i]]);
+
+            if (!ids.empty())
+                mgr.AddNameComponent(ids.data(), names.data(), ids.size());
+        }
+    }
+
+    // TRANSFORM
+    {
+        cvector<XMFLOAT3> positions;
+        cvector<XMVECTOR> directions;
+        cvector<float>    scales;
+
+        result &= reader.BeginChunk(TransformComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(positions);
+        result &= reader.ReadArray(directions);
+        result &= reader.ReadArray(scales);
+        result &= (positions.size() == recIds.size()) && (directions.size() == recIds.size()) && (scales.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+
+            cvector<XMFLOAT3> pos;
+            cvector<XMVECTOR> dirs;
+            cvector<float>    sc;
+            positions.get_data_by_idxs(idxs, pos);
+            directions.get_data_by_idxs(idxs, dirs);
+            scales.get_data_by_idxs(idxs, sc);
+
+            if (!ids.empty())
+                mgr.AddTransformComponent(ids.data(), ids.size(), pos.data(), dirs.data(), sc.data());
+        }
+    }
+
+    // MOVEMENT
+    {
+        cvector<XMFLOAT4> trScales;
+        cvector<XMVECTOR> rotQuats;
+
+        result &= reader.BeginChunk(MoveComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(trScales);
+        result &= reader.ReadArray(rotQuats);
+        result &= (trScales.size() == recIds.size()) && (rotQuats.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+
+            cvector<XMFLOAT3> translations(ids.size());
+            cvector<XMVECTOR> rots(ids.size());
+            cvector<float>    scaleFactors(ids.size());
+
+            for (index i = 0; i < idxs.size(); ++i)
+            {
+                const XMFLOAT4& t = trScales[idxs[i]];
+                translations[i] = { t.x, t.y, t.z };
+                scaleFactors[i] = t.w;
+                rots[i]         = rotQuats[idxs[i]];
+            }
+
+            if (!ids.empty())
+                mgr.AddMoveComponent(ids.data(), translations.data(), rots.data(), scaleFactors.data(), ids.size());
+        }
+    }
+
+    // MODEL
+    {
+        cvector<ModelID> modelIDs;
+
+        result &= reader.BeginChunk(ModelComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(modelIDs);
+        result &= (modelIDs.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+
+            cvector<ModelID> models;
+            modelIDs.get_data_by_idxs(idxs, models);
+
+            if (!ids.empty())
+                mgr.AddModelComponent(ids.data(), models.data(), ids.size());
+        }
+    }
+
+    // RENDERED
+    {
+        cvector<RenderShaderType>         shaderTypes;
+        cvector<D3D11_PRIMITIVE_TOPOLOGY> topologies;
+        cvector<float>                    smallCullFactors;
+        cvector<uint8>                    staticFlags;
+
+        result &= reader.BeginChunk(RenderedComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(shaderTypes);
+        result &= reader.ReadArray(topologies);
+        result &= reader.ReadArray(smallCullFactors);
+        result &= reader.ReadArray(staticFlags);
+        result &= (shaderTypes.size()      == recIds.size()) && (topologies.size()  == recIds.size());
+        result &= (smallCullFactors.size() == recIds.size()) && (staticFlags.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+
+            cvector<RenderInitParams> params(ids.size());
+
+            for (index i = 0; i < idxs.size(); ++i)
+            {
+                params[i].shaderType   = shaderTypes[idxs[i]];
+                params[i].topologyType = topologies[idxs[i]];
+            }
+
+            if (!ids.empty())
+                mgr.AddRenderingComponent(ids.data(), ids.size(), params.data());
+
+            for (index i = 0; i < idxs.size(); ++i)
+            {
+                mgr.renderSystem_.SetSmallCullFactor(&ids[i], 1, smallCullFactors[idxs[i]]);
+
+                if (staticFlags[idxs[i]])
+                    mgr.renderSystem_.SetStatic(&ids[i], 1, true);
+            }
+        }
+    }
+
+    // MATERIAL
+    {
+        cvector<uint32>     counts;
+        cvector<MaterialID> materialsIDs;
+        cvector<uint8>      meshBasedFlags;
+        cvector<uint32>     offsets;
+
+        result &= reader.BeginChunk(MaterialComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(counts);
+        result &= reader.ReadArray(materialsIDs);
+        result &= reader.ReadArray(meshBasedFlags);
+        result &= (counts.size() == recIds.size()) && (meshBasedFlags.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+            GetOffsets(counts, offsets);
+
+            for (index i = 0; i < idxs.size(); ++i)
+            {
+                const index r = idxs[i];
+                mgr.AddMaterialComponent(ids[i], materialsIDs.data() + offsets[r], counts[r], meshBasedFlags[r]);
+            }
+        }
+    }
+
+    // RENDER STATES: each bit of the hash is an eRenderState
+    {
+        cvector<u32> hashes;
+
+        result &= reader.BeginChunk(RenderStatesComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(hashes);
+        result &= (hashes.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+
+            if (!ids.empty())
+                mgr.AddRenderStatesComponent(ids.data(), ids.size());
+
+            cvector<eRenderState> states;
+
+            for (index i = 0; i < idxs.size(); ++i)
+            {
+                states.clear();
+
+                for (int state = 0; state < LAST_RS_TYPE; ++state)
+                {
+                    if (hashes[idxs[i]] & (1u << state))
+                        states.push_back((eRenderState)state);
+                }
+
+                mgr.renderStatesSystem_.UpdateStates(ids[i], states);
+            }
+        }
+    }
+
+    // BOUNDING
+    {
+        cvector<uint32>               counts;
+        cvector<BoundingType>         types;
+        cvector<DirectX::BoundingBox> AABBs;
+        cvector<uint32>               offsets;
+
+        result &= reader.BeginChunk(BoundingComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(counts);
+        result &= reader.ReadArray(types);
+        result &= reader.ReadArray(AABBs);
+        result &= (counts.size() == recIds.size()) && (types.size() == AABBs.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+            GetOffsets(counts, offsets);
+
+            for (index i = 0; i < idxs.size(); ++i)
+            {
+                const index r = idxs[i];
+
+                if (counts[r] > 0)
+                    mgr.AddBoundingComponent(&ids[i], 1, counts[r], types.data() + offsets[r], AABBs.data() + offsets[r]);
+            }
+        }
+    }
+
+    // LIGHT
+    {
+        cvector<EntityID>   pointIds;
+        cvector<PointLight> pointLights;
+        cvector<uint8>      pointActive;
+        cvector<EntityID>   spotIds;
+        cvector<SpotLight>  spotLights;
+        cvector<uint8>      spotActive;
+
+        result &= reader.BeginChunk(LightComponent);
+        result &= reader.ReadArray(pointIds);
+        result &= reader.ReadArray(pointLights);
+        result &= reader.ReadArray(pointActive);
+        result &= reader.ReadArray(spotIds);
+        result &= reader.ReadArray(spotLights);
+        result &= reader.ReadArray(spotActive);
+        result &= (pointLights.size() == pointIds.size()) && (pointActive.size() == pointIds.size());
+        result &= (spotLights.size()  == spotIds.size())  && (spotActive.size()  == spotIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(pointIds, outIds, ids, idxs);
+
+            if (!ids.empty())
+            {
+                PointLightsInitParams params;
+                pointLights.get_data_by_idxs(idxs, params.data);
+                mgr.AddLightComponent(ids.data(), ids.size(), params);
+
+                for (index i = 0; i < idxs.size(); ++i)
+                {
+                    if (!pointActive[idxs[i]])
+                        mgr.lightSystem_.SetLightIsActive(ids[i], false);
+                }
+            }
+
+            GetRestoredIdxs(spotIds, outIds, ids, idxs);
+
+            if (!ids.empty())
+            {
+                SpotLightsInitParams params;
+                spotLights.get_data_by_idxs(idxs, params.data);
+                mgr.AddLightComponent(ids.data(), ids.size(), params);
+
+                for (index i = 0; i < idxs.size(); ++i)
+                {
+                    if (!spotActive[idxs[i]])
+                        mgr.lightSystem_.SetLightIsActive(ids[i], false);
+                }
+            }
+        }
+    }
+
+    // SOUND EMITTER
+    {
+        cvector<uint32> soundIds;
+        cvector<float>  volumes;
+        cvector<float>  minDists;
+        cvector<float>  maxDists;
+        cvector<uint8>  priorities;
+
+        result &= reader.BeginChunk(SoundEmitterComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(soundIds);
+        result &= reader.ReadArray(volumes);
+        result &= reader.ReadArray(minDists);
+        result &= reader.ReadArray(maxDists);
+        result &= reader.ReadArray(priorities);
+        result &= (soundIds.size() == recIds.size()) && (volumes.size()    == recIds.size());
+        result &= (minDists.size() == recIds.size()) && (maxDists.size()   == recIds.size());
+        result &= (priorities.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+
+            for (index i = 0; i < idxs.size(); ++i)
+            {
+                const index r = idxs[i];
+                mgr.AddSoundEmitterComponent(ids[i], soundIds[r], volumes[r], minDists[r], maxDists[r], priorities[r]);
+            }
+        }
+    }
+
+    // PARTICLE EMITTER
+    {
+        cvector<ParticleEmitterParams> params;
+
+        result &= reader.BeginChunk(ParticleEmitterComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(params);
+        result &= (params.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+
+            for (index i = 0; i < idxs.size(); ++i)
+                mgr.AddParticleEmitterComponent(ids[i], params[idxs[i]]);
+        }
+    }
+
+    // COLLIDER (after the bounding)
+    {
+        cvector<uint8>  shapes;
+        cvector<uint32> layers;
+        cvector<uint32> masks;
+
+        result &= reader.BeginChunk(ColliderComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(shapes);
+        result &= reader.ReadArray(layers);
+        result &= reader.ReadArray(masks);
+        result &= (shapes.size() == recIds.size()) && (layers.size() == recIds.size()) && (masks.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+
+            for (index i = 0; i < idxs.size(); ++i)
+            {
+                const index r = idxs[i];
+                mgr.AddColliderComponent(ids[i], (eColliderShape)shapes[r], layers[r], masks[r]);
+            }
+        }
+    }
+
+    // ANIMATOR
+    {
+        cvector<uint16> clipIdxs;
+        cvector<float>  times;
+        cvector<float>  speeds;
+
+        result &= reader.BeginChunk(AnimatorComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(clipIdxs);
+        result &= reader.ReadArray(times);
+        result &= reader.ReadArray(speeds);
+        result &= (clipIdxs.size() == recIds.size()) && (times.size() == recIds.size()) && (speeds.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+
+            for (index i = 0; i < idxs.size(); ++i)
+            {
+                const index r = idxs[i];
+                mgr.AddAnimatorComponent(ids[i], clipIdxs[r], speeds[r], times[r]);
+            }
+        }
+    }
+
+    // PORTAL
+    {
+        cvector<PortalData> data;
+
+        result &= reader.BeginChunk(PortalComponent);
+        result &= reader.ReadArray(recIds);
+        result &= reader.ReadArray(data);
+        result &= (data.size() == recIds.size());
+
+        if (result)
+        {
+            GetRestoredIdxs(recIds, outIds, ids, idxs);
+
+            for (index i = 0; i < idxs.size(); ++i)
+                mgr.AddPortalComponent(ids[i], data[idxs[i]]);
+        }
+    }
+
+    if (!result)
+        LogErr("the chunk file is corrupted (restored entts can miss some components)");
+
+    return result;
+}
+
+} // namespace ECS
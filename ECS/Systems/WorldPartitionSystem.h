@@ -0,0 +1,181 @@
+// =================================================================================
+// Filename:     WorldPartitionSystem.h
+// Description:  a world partition: entts are assigned to chunks of a grid over
+//               the XZ-plane (by their positions) and chunks change their states
+//               by the distance to the player:
+//
+//               - ACTIVE:    entts are updated as usual;
+//               - DORMANT:   entts are resident but they are skipped by updates
+//                            of systems (movement, particles, animations);
+//               - UNLOADED:  streamable entts of the chunk were written into its
+//                            own chunk file (the same binary format as of the world
+//                            file) and removed; they are restored with the same IDs
+//                            when the player comes back;
+//
+//               chunk files are written/read by jobs; loaded chunks are merged into
+//               the entity manager by the main thread (before the ECS update);
+//               a chunk goes back into the prev state only beyond a hysteresis
+//               margin so chunks on a border don't flip each frame
+//
+//               NOTE: entts which can't be restored from a chunk file only stay
+//                     resident (they are still dormant): cameras, the player,
+//                     entts of hierarchies, entts with texture transforms,
+//                     directional lights and animated lights
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "../Common/ECSTypes.h"
+#include "../Common/WorldFile.h"
+#include "../Common/DormantSet.h"
+#include <JobSystem.h>
+#include <Types.h>
+#include <cvector.h>
+#include <atomic>
+
+
+namespace ECS
+{
+
+class EntityMgr;
+
+// =================================================================================
+// Data structures
+// =================================================================================
+enum eChunkState : uint8
+{
+    CHUNK_ACTIVE,
+    CHUNK_DORMANT,
+    CHUNK_SAVING,                        // entts are still resident while the chunk file is written
+    CHUNK_UNLOADED,
+    CHUNK_LOADING,                       // the chunk file is being read
+};
+
+///////////////////////////////////////////////////////////
+
+struct WorldPartitionParams
+{
+    char  dirPath[64]    = "data/world_chunks/";
+    float chunkDimension = 50;           // size of a grid cell (in world units)
+    float activeDist     = 100;          // entts of chunks closer than this are updated
+    float unloadDist     = 300;          // chunks further than this are streamed out
+    float hysteresis     = 25;           // a chunk goes back into the prev state only beyond this margin
+    bool  isStreaming    = false;        // unload far chunks (or only make them dormant)
+};
+
+///////////////////////////////////////////////////////////
+
+using ChunkKey = uint64;
+
+constexpr ChunkKey MakeChunkKey(const int cx, const int cz)
+{
+    return ((uint64)(uint32)cx << 32) | (uint64)(uint32)cz;
+}
+
+constexpr int GetChunkX(const ChunkKey key) { return (int)(uint32)(key >> 32); }
+constexpr int GetChunkZ(const ChunkKey key) { return (int)(uint32)(key & 0xFFFFFFFF); }
+
+// =================================================================================
+// Class
+// =================================================================================
+class WorldPartitionSystem
+{
+public:
+    static constexpr uint32 WORLD_PARTITION_DATA_BLOCK_MARKER = 1001;   // a chunk of the world file
+    static constexpr uint32 CHUNK_FILE_ENTTS_MARKER           = 1002;   // a chunk of the chunk file
+    static constexpr int    MAX_IO_PER_UPDATE                 = 2;      // chunk files to start writing/reading per update
+
+    WorldPartitionSystem(EntityMgr* pEnttMgr);
+    ~WorldPartitionSystem();
+
+    // restrict a copying of this class instance
+    WorldPartitionSystem(const WorldPartitionSystem&) = delete;
+    WorldPartitionSystem& operator=(const WorldPartitionSystem&) = delete;
+
+    // keys of unloaded chunks (their entts are stored only in chunk files)
+    void Serialize(WorldFileWriter& writer);
+    bool Deserialize(WorldFileReader& reader);
+
+    bool Initialize(const WorldPartitionParams& params);
+    void Shutdown();
+
+    // assign new/moved entts to chunks, merge loaded chunks, and change states
+    // of chunks by the distance to the focus point (the player's position);
+    // NOTE: entts are created/destroyed here so it must be called by the main
+    //       thread before the ECS update tasks are executed
+    void Update(const XMFLOAT3& focusPos);
+
+    // wait for all the chunk files which are being written/read
+    void FinishIO();
+
+    inline bool IsActive()                   const { return isActive_; }
+    inline bool IsDormant(const EntityID id) const { return dormant_.IsDormant(id); }
+
+    inline size GetNumChunks()               const { return chunkKeys_.size(); }
+    inline size GetNumDormantEntts()         const { return dormant_.GetSize(); }
+    size        GetNumChunksByState(const eChunkState state) const;
+
+private:
+    struct PendingIO
+    {
+        ChunkKey          key = 0;
+        bool              isSave = false;
+        cvector<EntityID> ids;                      // saved entts (SORTED)
+        WorldFileWriter   writer;
+        WorldFileReader   reader;
+        bool              result = false;
+        std::atomic<bool> isDone = false;
+        char              path[128]{ '\0' };
+    };
+
+    void     Reset();
+    void     UpdateChunksStates(const XMFLOAT3& focusPos);
+    void     SyncEntts         (const XMFLOAT3& focusPos);
+    void     ReassignMovedEntts(const XMFLOAT3& focusPos);
+    void     ApplyDormancy();
+    void     FinishPendingIO();
+
+    index    GetChunkIdx  (const ChunkKey key) const;
+    index    GetOrAddChunk(const ChunkKey key, const XMFLOAT3& focusPos);
+    ChunkKey GetKeyByPos  (const XMFLOAT3& pos) const;
+    float    GetDistToChunk(const ChunkKey key, const XMFLOAT3& pos) const;
+    void     GetChunkPath (const ChunkKey key, char* outPath, const int pathSize) const;
+
+    void     AddEnttToChunk     (const EntityID id, const index chunkIdx);
+    void     RemoveEnttFromChunk(const EntityID id, const ChunkKey key);
+
+    bool     IsStreamable(const EntityID id) const;
+    bool     StartSaving (const index chunkIdx);
+    void     StartLoading(const index chunkIdx);
+    bool     LoadChunkNow(const index chunkIdx);
+
+    void     WriteChunkFile(const cvector<EntityID>& ids, WorldFileWriter& writer) const;
+    bool     MergeChunkFile(WorldFileReader& reader, cvector<EntityID>& outIds);
+
+private:
+    EntityMgr*               pEnttMgr_ = nullptr;
+    WorldPartitionParams     params_;
+
+    // chunks (SORTED by keys)
+    cvector<ChunkKey>           chunkKeys_;
+    cvector<uint8>              chunkStates_;       // eChunkState
+    cvector<cvector<EntityID>>  chunkEntts_;        // resident entts of the chunk (SORTED)
+
+    // assigned entts (SORTED by ids)
+    cvector<EntityID>        ids_;
+    cvector<ChunkKey>        enttsChunks_;
+
+    DormantSet               dormant_;              // resident entts of not active chunks
+    cvector<EntityID>        touchedIds_;           // entts whose dormancy can be changed by this update
+    cvector<EntityID>        tmpIds_;
+    cvector<ChunkKey>        brokenChunks_;         // chunks whose files can't be written/read (SORTED)
+
+    cvector<PendingIO*>      pendingIO_;
+    JobCounter               ioCounter_;
+
+    uint32                   structureVersion_ = UINT32_MAX;   // of the entity manager by the last sync
+    bool                     isActive_ = false;
+};
+
+} // namespace ECS
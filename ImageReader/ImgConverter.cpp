@@ -3,6 +3,11 @@
 #include <CAssert.h>
 #include <log.h>
 #include <EngineException.h>
+#include <FileSystem.h>
+#include <JobSystem.h>
+#include <MemHelpers.h>
+
+#include <chrono>
 
 #pragma warning (disable : 4996)
 using namespace DirectX;
@@ -11,34 +16,388 @@ using namespace DirectX;
 namespace ImgReader
 {
 
+// extensions of images which can be converted into .dds by a batch
+static const char* BATCH_SRC_EXTS[] = { ".tga", ".png", ".jpg", ".jpeg", ".bmp", ".gif", ".tif", ".tiff" };
+
+//---------------------------------------------------------
+// Desc:  get a lowercase extension of the file (with a dot)
+//---------------------------------------------------------
+static std::string GetLowerExt(const fs::path& filepath)
+{
+    std::string ext = filepath.extension().string();
+
+    for (char& ch : ext)
+        ch = (char)tolower((unsigned char)ch);
+
+    return ext;
+}
+
+//---------------------------------------------------------
+// Desc:  check if the file can be converted by a batch
+//---------------------------------------------------------
+static bool IsBatchSrcExt(const fs::path& filepath)
+{
+    const std::string ext = GetLowerExt(filepath);
+
+    for (const char* srcExt : BATCH_SRC_EXTS)
+    {
+        if (ext == srcExt)
+            return true;
+    }
+
+    return false;
+}
+
+//---------------------------------------------------------
+// Desc:  decode an image of mounted asset packs from memory
+//        (an uncompressed entry is decoded in place)
+//---------------------------------------------------------
+static bool LoadFromPacks(const char* filePath, ScratchImage& outImage)
+{
+    const std::string ext   = GetLowerExt(filePath);
+    const uint8_t*    pData = nullptr;
+    uint8_t*          pCopy = nullptr;
+    size_t            size  = 0;
+
+    if (!FileSys::GetPackedView(filePath, pData, size))
+    {
+        if (!FileSys::ReadFile(filePath, pCopy, size))
+            return false;
+
+        pData = pCopy;
+    }
+
+    HRESULT hr = S_OK;
+
+    if (ext == ".dds")
+        hr = LoadFromDDSMemory(pData, size, DDS_FLAGS_NONE, nullptr, outImage);
+
+    else if (ext == ".tga")
+        hr = LoadFromTGAMemory(pData, size, nullptr, outImage);
+
+    else
+        hr = LoadFromWICMemory(pData, size, WIC_FLAGS_NONE, nullptr, outImage);
+
+    SafeDeleteArr(pCopy);
+    return SUCCEEDED(hr);
+}
+
+//---------------------------------------------------------
+// Desc:  check if the file exists and it isn't older than the other one
+//---------------------------------------------------------
+static bool IsNewerFile(const fs::path& filepath, const fs::path& otherPath)
+{
+    std::error_code error;
+
+    const fs::file_time_type time = fs::last_write_time(filepath, error);
+    if (error)
+        return false;
+
+    const fs::file_time_type otherTime = fs::last_write_time(otherPath, error);
+    if (error)
+        return false;
+
+    return (time >= otherTime);
+}
+
+//---------------------------------------------------------
+// Desc:  estimate the memory which is used to convert the image:
+//        decoded pixels + a mip chain + a processed copy (~4 bytes per texel)
+//---------------------------------------------------------
+static size_t EstimateConvertBytes(const fs::path& filepath)
+{
+    const std::string  ext = GetLowerExt(filepath);
+    const std::wstring wPath = filepath.wstring();
+    TexMetadata        metadata;
+    HRESULT            hr = S_OK;
+
+    if (ext == ".tga")
+        hr = GetMetadataFromTGAFile(wPath.c_str(), metadata);
+    else
+        hr = GetMetadataFromWICFile(wPath.c_str(), WIC_FLAGS_NONE, metadata);
+
+    // the file will fail anyway: it doesn't take much memory
+    if (FAILED(hr))
+        return 0;
+
+    return metadata.width * metadata.height * 4 * 3;
+}
+
+//---------------------------------------------------------
+// Desc:  a bound for the memory of images which are converted at once;
+//        an image is started when it fits into the budget (or nothing else
+//        is converted so a huge image can't stall the batch)
+//---------------------------------------------------------
+struct ConvertMemBudget
+{
+    std::mutex              mutex;
+    std::condition_variable released;
+    size_t                  usedBytes = 0;
+    size_t                  maxBytes  = 0;
+
+    void Acquire(const size_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [&]() { return (usedBytes == 0) || (usedBytes + bytes <= maxBytes); });
+        usedBytes += bytes;
+    }
+
+    void Release(const size_t bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            usedBytes -= bytes;
+        }
+        released.notify_all();
+    }
+};
+
 // *********************************************************************************
 //                            PUBLIC METHODS
 // *********************************************************************************
 
 bool ImgConverter::LoadFromFile(const fs::path& filepath, ScratchImage& outImage)
 {
-    // load image data from file into the input ScratchImage
+    // load image data from file into the input ScratchImage;
+    // NOTE: it can be executed by worker threads so g_String isn't used here
+
+    char            msg[320]{ '\0' };
+    std::error_code error;
 
-    if (!fs::exists(filepath))
+    // a file of mounted asset packs is decoded from memory
+    const std::string path = filepath.string();
+
+    if (FileSys::IsPacked(path.c_str()))
     {
-        sprintf(g_String, "there is no image/texture file: %s", filepath.string().c_str());
-        LogErr(g_String);
+        if (!LoadFromPacks(path.c_str(), outImage))
+        {
+            snprintf(msg, sizeof(msg), "can't load image/texture from packs: %s", path.c_str());
+            LogErr(msg);
+            return false;
+        }
+
+        return true;
+    }
+
+    if (!fs::exists(filepath, error))
+    {
+        snprintf(msg, sizeof(msg), "there is no image/texture file: %s", filepath.string().c_str());
+        LogErr(msg);
         return false;
     }
 
-    const wchar_t* path = filepath.wstring().c_str();
-    HRESULT hr = LoadFromWICFile(path, WIC_FLAGS_NONE, nullptr, outImage);
+    const std::string  ext   = GetLowerExt(filepath);
+    const std::wstring wPath = filepath.wstring();
+    HRESULT            hr    = S_OK;
+
+    if (ext == ".dds")
+        hr = LoadFromDDSFile(wPath.c_str(), DDS_FLAGS_NONE, nullptr, outImage);
+
+    else if (ext == ".tga")
+        hr = LoadFromTGAFile(wPath.c_str(), nullptr, outImage);
+
+    else
+        hr = LoadFromWICFile(wPath.c_str(), WIC_FLAGS_NONE, nullptr, outImage);
 
     if (FAILED(hr))
     {
-        sprintf(g_String, "can't load image/texture from file: %s", filepath.string().c_str());
-        LogErr(g_String);
+        snprintf(msg, sizeof(msg), "can't load image/texture from file: %s", filepath.string().c_str());
+        LogErr(msg);
         return false;
     }
 
     return true;
 }
 
+// --------------------------------------------------------
+// Desc:   convert a single image file into .dds (with mips)
+// Args:   - srcPath: a path to the source image
+//         - dstPath: a path to the output .dds file
+//         - params:  a dst format and a mips filter
+// Ret:    true if the .dds file is written
+// --------------------------------------------------------
+bool ImgConverter::ConvertFile(
+    const fs::path& srcPath,
+    const fs::path& dstPath,
+    const ImgBatchParams& params)
+{
+    try
+    {
+        ScratchImage srcImage;
+
+        if (!LoadFromFile(srcPath, srcImage))
+            return false;
+
+        ScratchImage mipChain(GenMipMaps(srcImage, params.mipFilter));
+
+        // src image already has the proper format
+        if (mipChain.GetMetadata().format == params.dstFormat)
+            return SaveToFile(mipChain, DDS_FLAGS_NONE, dstPath);
+
+        ScratchImage dstImage;
+        ProcessImage(mipChain, params.dstFormat, dstImage);
+
+        return SaveToFile(dstImage, DDS_FLAGS_NONE, dstPath);
+    }
+    catch (EngineException& e)
+    {
+        char msg[320]{ '\0' };
+
+        LogErr(e);
+        snprintf(msg, sizeof(msg), "can't convert image: %s", srcPath.string().c_str());
+        LogErr(msg);
+        return false;
+    }
+    catch (std::bad_alloc& e)
+    {
+        char msg[320]{ '\0' };
+
+        LogErr(e.what());
+        snprintf(msg, sizeof(msg), "can't allocate memory to convert image: %s", srcPath.string().c_str());
+        LogErr(msg);
+        return false;
+    }
+}
+
+// --------------------------------------------------------
+// Desc:   convert all the images of the directory into .dds files
+//         (which are placed next to sources)
+// --------------------------------------------------------
+void ImgConverter::ConvertDirectory(
+    const fs::path& dirPath,
+    const ImgBatchParams& params,
+    ImgBatchStats& outStats)
+{
+    std::error_code        error;
+    std::vector<fs::path>  srcPaths;
+
+    if (!fs::is_directory(dirPath, error))
+    {
+        sprintf(g_String, "there is no directory to convert images: %s", dirPath.string().c_str());
+        LogErr(g_String);
+        return;
+    }
+
+    if (params.recursive)
+    {
+        for (const fs::directory_entry& entry : fs::recursive_directory_iterator(dirPath, error))
+        {
+            if (entry.is_regular_file(error) && IsBatchSrcExt(entry.path()))
+                srcPaths.push_back(entry.path());
+        }
+    }
+    else
+    {
+        for (const fs::directory_entry& entry : fs::directory_iterator(dirPath, error))
+        {
+            if (entry.is_regular_file(error) && IsBatchSrcExt(entry.path()))
+                srcPaths.push_back(entry.path());
+        }
+    }
+
+    ConvertBatch(srcPaths, params, outStats);
+}
+
+// --------------------------------------------------------
+// Desc:   convert input images into .dds files in parallel: each thread
+//         takes the next image from the list when the previous one is done
+//         and when the memory budget allows to decode it
+// Args:   - srcPaths: paths to source images (.dds sources are skipped)
+//         - params:   conversion params and the memory budget
+//         - outStats: numbers of converted files and throughput
+// --------------------------------------------------------
+void ImgConverter::ConvertBatch(
+    const std::vector<fs::path>& srcPaths,
+    const ImgBatchParams& params,
+    ImgBatchStats& outStats)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    std::atomic<size_t>   nextIdx      = 0;
+    std::atomic<uint32_t> numConverted = 0;
+    std::atomic<uint32_t> numSkipped   = 0;
+    std::atomic<uint32_t> numFailed    = 0;
+    std::atomic<uint64_t> srcBytes     = 0;
+    std::atomic<uint64_t> dstBytes     = 0;
+    ConvertMemBudget      budget;
+
+    budget.maxBytes = params.maxMemoryBytes;
+
+    const index numThreads = (g_JobSystem.IsInitialized()) ? g_JobSystem.GetNumThreads() : 1;
+    const index numLanes   = (numThreads < (index)srcPaths.size()) ? numThreads : (index)srcPaths.size();
+
+    g_JobSystem.ParallelFor(numLanes, 1, [&](const index, const index)
+    {
+        for (size_t i = nextIdx++; i < srcPaths.size(); i = nextIdx++)
+        {
+            const fs::path& srcPath = srcPaths[i];
+            fs::path        dstPath;
+            std::error_code error;
+
+            GenDstImgPath(srcPath, dstPath);
+
+            // a .dds source would be overwritten by itself
+            if (GetLowerExt(srcPath) == ".dds")
+            {
+                numSkipped++;
+                continue;
+            }
+
+            // the output is up to date
+            if (IsNewerFile(dstPath, srcPath))
+            {
+                numSkipped++;
+                continue;
+            }
+
+            const size_t memBytes = EstimateConvertBytes(srcPath);
+
+            budget.Acquire(memBytes);
+            const bool isConverted = ConvertFile(srcPath, dstPath, params);
+            budget.Release(memBytes);
+
+            if (!isConverted)
+            {
+                numFailed++;
+                continue;
+            }
+
+            numConverted++;
+
+            const uintmax_t srcSize = fs::file_size(srcPath, error);
+            if (!error)
+                srcBytes += srcSize;
+
+            const uintmax_t dstSize = fs::file_size(dstPath, error);
+            if (!error)
+                dstBytes += dstSize;
+        }
+    });
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    outStats.numConverted += numConverted;
+    outStats.numSkipped   += numSkipped;
+    outStats.numFailed    += numFailed;
+    outStats.srcBytes     += srcBytes;
+    outStats.dstBytes     += dstBytes;
+    outStats.seconds      += elapsed.count();
+
+    const double seconds = (elapsed.count() > 0) ? elapsed.count() : 1e-6;
+    const double srcMB   = (double)srcBytes / (1 << 20);
+
+    LogMsgf("images batch: converted: %u, skipped: %u, failed: %u (%.2f MB => %.2f MB) in %.2f s: %.1f images/s, %.2f MB/s (%d threads)",
+        (uint32_t)numConverted,
+        (uint32_t)numSkipped,
+        (uint32_t)numFailed,
+        srcMB,
+        (double)dstBytes / (1 << 20),
+        elapsed.count(),
+        numConverted / seconds,
+        srcMB / seconds,
+        (int)numLanes);
+}
+
 // --------------------------------------------------------
 // Desc:   create a ScratchImage loading data from
 //         the input texture resource
@@ -186,8 +545,11 @@ void ImgConverter::Convert(
     if (srcFormat == dstFormat) 
         return;
 
-    sprintf(g_String, "convert format (from -> to): %d => %d", srcFormat, dstFormat);
-    LogDbg(g_String);
+    // NOTE: it can be executed by worker threads (a batch) so g_String isn't used here
+    char msg[128]{ '\0' };
+
+    snprintf(msg, sizeof(msg), "convert format (from -> to): %d => %d", srcFormat, dstFormat);
+    LogDbg(msg);
 
 
     const bool isSrcCompressed = DirectX::IsCompressed(srcFormat);
@@ -195,8 +557,8 @@ void ImgConverter::Convert(
 
     if (isSrcCompressed || isDstCompressed)
     {
-        sprintf(g_String, "can't handle compressed format (src or dst): %d => %d", srcFormat, dstFormat);
-        throw EngineException(g_String);
+        snprintf(msg, sizeof(msg), "can't handle compressed format (src or dst): %d => %d", srcFormat, dstFormat);
+        throw EngineException(msg);
     }
 
     // uncompressed => uncompressed
@@ -220,8 +582,10 @@ void ImgConverter::Decompress(
 
     const DXGI_FORMAT srcFormat = srcImage.GetMetadata().format;
 
-    sprintf(g_String, "decompress image (from -> to): %d => %d", srcFormat, dstFormat);
-    LogDbg(g_String);
+    char msg[128]{ '\0' };
+
+    snprintf(msg, sizeof(msg), "decompress image (from -> to): %d => %d", srcFormat, dstFormat);
+    LogDbg(msg);
 
 
     const bool isSrcCompressed = DirectX::IsCompressed(srcFormat);
@@ -229,8 +593,8 @@ void ImgConverter::Decompress(
 
     if (!isSrcCompressed || isDstCompressed)
     {
-        sprintf(g_String, "wrong format params: %d => %d", srcFormat, dstFormat);
-        throw EngineException(g_String);
+        snprintf(msg, sizeof(msg), "wrong format params: %d => %d", srcFormat, dstFormat);
+        throw EngineException(msg);
     }
 
     // compressed => uncompressed
@@ -255,6 +619,7 @@ void ImgConverter::Compress(
 
     HRESULT hr = S_OK;
     const DXGI_FORMAT srcFormat = srcImg.GetMetadata().format;
+    char msg[128]{ '\0' };
 
     bool isSrcCompressed = DirectX::IsCompressed(srcFormat);
     bool isDstCompressed = DirectX::IsCompressed(dstFormat);
@@ -262,8 +627,8 @@ void ImgConverter::Compress(
     // COMPRESS: uncompressed => compressed
     if (!isSrcCompressed && isDstCompressed)
     {
-        sprintf(g_String, "compress image: %d => %d", srcFormat, dstFormat);
-        LogDbg(g_String);
+        snprintf(msg, sizeof(msg), "compress image: %d => %d", srcFormat, dstFormat);
+        LogDbg(msg);
 
         hr = CompressEx(
             srcImg.GetImages(),
@@ -277,8 +642,8 @@ void ImgConverter::Compress(
     // RECOMPRESS: compressed => compressed
     else if (isSrcCompressed && isDstCompressed) 
     {
-        sprintf(g_String, "recompress image: %d => %d", srcFormat, dstFormat);
-        LogDbg(g_String);
+        snprintf(msg, sizeof(msg), "recompress image: %d => %d", srcFormat, dstFormat);
+        LogDbg(msg);
 
         ScratchImage tempImg;
 
@@ -430,8 +795,9 @@ bool ImgConverter::SaveToFile(
 
     if (FAILED(hr))
     {
-        sprintf(g_String, "can't save image into dds file: %s", dstPath.string().c_str());
-        LogErr(g_String);
+        char msg[320]{ '\0' };
+        snprintf(msg, sizeof(msg), "can't save image into dds file: %s", dstPath.string().c_str());
+        LogErr(msg);
         return false;
     }
 
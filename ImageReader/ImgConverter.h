@@ -7,6 +7,8 @@
 //                features:
 //                1. convertation between uncompressed formats;
 //                2. decompression from compressed formats;
+//                3. batch conversion of a directory (or a files list) into .dds
+//                   on all the cores (within a memory budget for decoded images);
 // 
 // Created:       12.11.24
 // ********************************************************************************
@@ -14,6 +16,8 @@
 
 #include <DirectXTex.h>
 #include <filesystem>
+#include <vector>
+#include <stdint.h>
 #include <d3d11.h>
 
 namespace fs = std::filesystem;
@@ -21,12 +25,54 @@ namespace fs = std::filesystem;
 
 namespace ImgReader
 {
+
+struct ImgBatchParams
+{
+    DXGI_FORMAT               dstFormat      = DXGI_FORMAT_BC3_UNORM;
+    DirectX::TEX_FILTER_FLAGS mipFilter      = DirectX::TEX_FILTER_DEFAULT;
+    size_t                    maxMemoryBytes = 512ULL << 20;   // for decoded images in flight
+    bool                      recursive      = true;           // convert subdirectories as well
+};
+
+///////////////////////////////////////////////////////////
+
+struct ImgBatchStats
+{
+    uint32_t numConverted = 0;
+    uint32_t numSkipped   = 0;        // the output is newer than the input
+    uint32_t numFailed    = 0;
+    uint64_t srcBytes     = 0;        // of converted input files
+    uint64_t dstBytes     = 0;        // of written .dds files
+    double   seconds      = 0;
+};
+
+///////////////////////////////////////////////////////////
     
 class ImgConverter
 {
 public:
+    // decode an image file (.dds, .tga or any WIC format: .png, .jpg, .bmp, etc.);
+    // NOTE: it is safe to be called from worker threads
     bool LoadFromFile(const fs::path& filepath, DirectX::ScratchImage& outImage);
 
+    // load, generate mips, convert/compress and save a single image as .dds
+    bool ConvertFile(
+        const fs::path& srcPath,
+        const fs::path& dstPath,
+        const ImgBatchParams& params);
+
+    // convert all the images of the directory (or the input files) in parallel;
+    // an image is skipped if its .dds (see GenDstImgPath) is newer than itself
+    void ConvertDirectory(
+        const fs::path& dirPath,
+        const ImgBatchParams& params,
+        ImgBatchStats& outStats);
+
+    void ConvertBatch(
+        const std::vector<fs::path>& srcPaths,
+        const ImgBatchParams& params,
+        ImgBatchStats& outStats);
+
     void LoadFromMemory(
         ID3D11Device* pDevice,
         ID3D11DeviceContext* pContext,
@@ -1,5 +1,7 @@
 #include "../Common/pch.h"
 #include "DDS_ImageReader.h"
+#include "DDSTextureLoader11.h"
+#include <MappedFile.h>
 #include <d3dx11tex.h>
 
 #pragma warning (disable : 4996)
@@ -19,6 +21,9 @@ bool DDS_ImageReader::LoadTextureFromFile(
     // and initializes input parameters: texture resource, shader resource view,
     // width and height of the texture;
 
+    if (LoadFromMappedFile(filePath, pDevice, ppTexture, ppTextureView, texWidth, texHeight))
+        return true;
+
 
     HRESULT hr = S_OK;
 
@@ -68,5 +73,71 @@ bool DDS_ImageReader::LoadTextureFromFile(
     return true;
 }
 
+///////////////////////////////////////////////////////////
+
+bool DDS_ImageReader::LoadFromMappedFile(
+    const char* filePath,
+    ID3D11Device* pDevice,
+    ID3D11Resource** ppTexture,
+    ID3D11ShaderResourceView** ppTextureView,
+    uint32_t& texWidth,
+    uint32_t& texHeight)
+{
+    // the layout of the beginning of a DDS file: the magic number and DDS_HEADER
+    constexpr uint32_t DDS_MAGIC            = 0x20534444;   // "DDS "
+    constexpr size_t   DDS_MIN_SIZE         = 4 + 124;
+    constexpr size_t   DDS_OFFSET_HEIGHT    = 4 + 8;
+    constexpr size_t   DDS_OFFSET_WIDTH     = 4 + 12;
+    constexpr size_t   DDS_OFFSET_MIP_COUNT = 4 + 24;
+
+    char ext[8]{ '\0' };
+    FileSys::GetFileExt(filePath, ext);
+
+    // .bmp files are loaded by D3DX as well
+    if (strcmp(ext, ".dds") != 0)
+        return false;
+
+    // the view stays mapped only until the texture is created: D3D copies
+    // the initial data into the resource
+    MappedFile file;
+
+    if (!file.Open(filePath) || (file.GetSize() < DDS_MIN_SIZE))
+        return false;
+
+    const uint8_t* pData = file.GetData();
+    uint32_t       magic = 0;
+    uint32_t       mipCount = 0;
+
+    memcpy(&magic,     pData,                        sizeof(magic));
+    memcpy(&texHeight, pData + DDS_OFFSET_HEIGHT,    sizeof(texHeight));
+    memcpy(&texWidth,  pData + DDS_OFFSET_WIDTH,     sizeof(texWidth));
+    memcpy(&mipCount,  pData + DDS_OFFSET_MIP_COUNT, sizeof(mipCount));
+
+    if (magic != DDS_MAGIC)
+        return false;
+
+    // a texture without mips gets the full chain generated by D3DX
+    // (the DDS loader creates only the mips of the file)
+    if ((mipCount <= 1) && ((texWidth > 1) || (texHeight > 1)))
+        return false;
+
+    const HRESULT hr = DirectX::CreateDDSTextureFromMemory(
+        pDevice,
+        pData,
+        file.GetSize(),
+        ppTexture,
+        ppTextureView);
+
+    if (FAILED(hr))
+    {
+        // some legacy formats aren't supported by the DDS loader
+        sprintf(g_String, "can't create a DDS texture from the mapped file (it is loaded by D3DX): %s", filePath);
+        LogMsg(g_String);
+        return false;
+    }
+
+    return true;
+}
+
 
 } // namespace ImgReader
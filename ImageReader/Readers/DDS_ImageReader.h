@@ -22,6 +22,19 @@ public:
 		ID3D11ShaderResourceView** ppTextureView,
 		uint32_t& texWidth,
         uint32_t& texHeight);
+
+private:
+    // create the texture right from the mapped file (or its pack entry): the initial
+    // data of each mip and array slice points into the mapping so the file isn't
+    // read into a heap buffer; ret: false if the file can't be loaded by this way
+    // (then it is loaded by D3DX)
+    bool LoadFromMappedFile(
+        const char* filePath,
+        ID3D11Device* pDevice,
+        ID3D11Resource** ppTexture,
+        ID3D11ShaderResourceView** ppTextureView,
+        uint32_t& texWidth,
+        uint32_t& texHeight);
 };
 
 
@@ -117,6 +117,10 @@ public:
 
     void Unload();
 
+    // copy pixels into a top-down RGBA (32 bits) buffer of width*height*4 bytes
+    // (rows of bottom-up images are flipped, 24 bits pixels get an opaque alpha)
+    bool CopyToRGBA(uint8* outPixels) const;
+
     // ----------------------------------------------------
     // Desc:   get the color (RGB triplet) from a texture pixel
     // Args:   - x, y: position to get color from
@@ -201,6 +205,7 @@ private:
     uint    bytesPerPixel_ = 0;
     uint8*  pixels_     = nullptr;
     bool    isLoaded_   = false;
+    bool    isBottomUp_ = false;       // the first row is the bottom one (TGA origin)
 };
 
 } // namespace Core
@@ -7,7 +7,9 @@
 #include <MathHelper.h>
 #include <log.h>
 #include <CAssert.h>
+#include <Profiler.h>
 #include "InitRender.h"
+#include "Common/InputLayouts.h"
 
 using XMFLOAT3 = DirectX::XMFLOAT3;
 using XMFLOAT4 = DirectX::XMFLOAT4;
@@ -24,42 +26,127 @@ CRender::~CRender() {}
 //                               public methods
 // =================================================================================
 
-bool CRender::Initialize(
-    ID3D11Device* pDevice,
-    ID3D11DeviceContext* pContext,
-    const InitParams& params) 
+bool CRender::LoadShaders(ID3D11Device* pDevice, const InitParams& params)
 {
+    // NOTE: the immediate context must not be touched here
+
     try
     {
-        pContext_ = pContext;
-
         bool result = true;
         HRESULT hr = S_OK;
         InitRender init;
 
+        // all the binds on the immediate context go through the state cache
+        shadersContainer_.SetStateCache(&stateCache_);
+        entityIdBuffer_.SetStateCache(&stateCache_);
+        depthPrepass_.SetStateCache(&stateCache_);
+        gpuParticles_.SetStateCache(&stateCache_);
+        grassScatter_.SetStateCache(&stateCache_);
+        skinnedCrowds_.SetStateCache(&stateCache_);
+        editorGrid_.SetStateCache(&stateCache_);
+        terrainVT_.SetStateCache(&stateCache_);
+        shadowMaps_.SetStateCache(&stateCache_);
+        deferredShading_.SetStateCache(&stateCache_);
+        lowResBlending_.SetStateCache(&stateCache_);
+        planarReflection_.SetStateCache(&stateCache_);
+        skyFogLut_.SetStateCache(&stateCache_);
+
         result = init.InitializeShaders(
             pDevice, 
-            pContext,
             shadersContainer_,
             params.worldViewOrtho);
         CAssert::True(result, "can't initialize shaders");
 
-        // --------------------------------------------
+        // billboards are expanded by vertex pulling or by the geometry shader
+        shadersContainer_.billboardShader_.SetVertexPulling(params.billboardVertexPulling);
 
-        // create instances buffer
-        const UINT maxInstancesNum = 9000;
-        D3D11_BUFFER_DESC vbd;
+        // without the Hi-Z buffer we just don't do occlusion culling
+        if (!hiZBuffer_.Initialize(pDevice, "shaders/HiZBuildCS.cso"))
+            LogErr("can't initialize the Hi-Z buffer");
+
+        // without the GPU culling the opaque pass is always culled on CPU
+        if (!gpuCulling_.Initialize(pDevice, "shaders/GpuCullCS.cso"))
+            LogErr("can't initialize the GPU culling");
+
+        // without static batches all the entts go by the per-frame path
+        if (!staticBatches_.Initialize(pDevice, "shaders/StaticGatherCS.cso"))
+            LogErr("can't initialize static batches");
+
+        // without the entity IDs buffer only CPU picking is available
+        if (!entityIdBuffer_.Initialize(pDevice, "shaders/EntityIdVS.cso", "shaders/EntityIdPS.cso"))
+            LogErr("can't initialize the entity IDs buffer");
+
+        // without the depth pre-pass the main passes just write depth themselves
+        if (!depthPrepass_.Initialize(pDevice, "shaders/DepthPrepassVS.cso", "shaders/DepthPrepassAlphaClipVS.cso", "shaders/DepthPrepassAlphaClipPS.cso"))
+            LogErr("can't initialize the depth pre-pass");
+
+        // without GPU particles emitters just don't spawn anything
+        if (params.maxParticles > 0)
+        {
+            if (!gpuParticles_.Initialize(pDevice, params.maxParticles))
+                LogErr("can't initialize GPU particles");
+        }
+
+        // without the grass scatter the terrain is just bare
+        if (params.maxGrassInstances > 0)
+        {
+            if (!grassScatter_.Initialize(pDevice, params.maxGrassInstances, params.grassParams))
+                LogErr("can't initialize the grass scatter");
+        }
+
+        // without skinned crowds animated entts just aren't rendered
+        if (params.maxSkinnedInstances > 0)
+        {
+            if (!skinnedCrowds_.Initialize(pDevice, params.maxSkinnedInstances))
+                LogErr("can't initialize skinned crowds");
+        }
+
+        // without the grid the editor just has no ground reference
+        if (!editorGrid_.Initialize(pDevice, params.editorGridParams))
+            LogErr("can't initialize the editor grid");
+
+        // without shadow maps the sun just lights everything
+        if (params.shadowParams.numCascades > 0)
+        {
+            if (!shadowMaps_.Initialize(pDevice, params.shadowParams))
+                LogErr("can't initialize shadow maps");
+        }
+
+        // without the deferred shading the opaque passes are always shaded forward
+        if (!deferredShading_.Initialize(pDevice, "shaders/GBufferPS.cso", "shaders/DeferredLightingCS.cso", "shaders/UpscaleVS.cso", "shaders/DeferredCompositePS.cso"))
+            LogErr("can't initialize the deferred shading");
+
+        // without it the blended content is always rendered with the full resolution
+        if (!lowResBlending_.Initialize(pDevice, "shaders/UpscaleVS.cso", "shaders/LowResDepthPS.cso", "shaders/LowResCompositePS.cso"))
+            LogErr("can't initialize the low resolution blending");
+
+        // without it mirrors are just not reflective (params are set by the owner later)
+        if (!planarReflection_.Initialize(pDevice, "shaders/UpscaleVS.cso", "shaders/PlanarReflectionPS.cso", PlanarReflectionParams()))
+            LogErr("can't initialize the planar reflection");
+
+        // without the sky fog LUT the fog gets only its fixed color
+        if (!skyFogLut_.Initialize(pDevice, "shaders/SkyFogLutCS.cso"))
+            LogErr("can't initialize the sky fog LUT");
+
+        // without the profiler GPU times of passes are just zeros
+        if (!gpuProfiler_.Initialize(pDevice))
+            LogErr("can't initialize the GPU profiler");
 
-        // setup buffer's description
-        vbd.Usage               = D3D11_USAGE_DYNAMIC;
-        vbd.ByteWidth           = static_cast<UINT>(sizeof(ConstBufType::InstancedData) * maxInstancesNum);
-        vbd.BindFlags           = D3D11_BIND_VERTEX_BUFFER;
-        vbd.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
-        vbd.MiscFlags           = 0;
-        vbd.StructureByteStride = 0;
+        // shaders which are recompiled in background when their sources are changed
+        InitShadersHotReload(pDevice);
 
-        hr = pDevice->CreateBuffer(&vbd, nullptr, &pInstancedBuffer_);
-        CAssert::NotFailed(hr, "can't create an instanced buffer");
+        // without deferred contexts all the passes are recorded on the immediate context
+        if (params.numDeferredContexts > 0)
+        {
+            if (!commandRecorder_.Initialize(pDevice, params.numDeferredContexts))
+                LogErr("can't initialize deferred contexts");
+        }
+
+        // --------------------------------------------
+
+        // create instances buffer
+        result = instanceRing_.Initialize(pDevice);
+        CAssert::True(result, "can't create an instanced buffer");
 
 
         // ------------------------ CONSTANT BUFFERS ------------------------------ 
@@ -82,6 +169,50 @@ bool CRender::Initialize(
 
         //hr = cbgsFixed_.Initialize(pDevice, pContext);
         //CAssert::NotFailed(hr, "can't initialize const buffer for GS");
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't load shaders of the CRender module");
+        return false;
+    }
+
+    isShadersLoaded_ = true;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool CRender::Initialize(
+    ID3D11Device* pDevice,
+    ID3D11DeviceContext* pContext,
+    const InitParams& params) 
+{
+    if (!isShadersLoaded_ && !LoadShaders(pDevice, params))
+    {
+        LogErr("can't initialize the CRender module");
+        return false;
+    }
+
+    try
+    {
+        pContext_ = pContext;
+        stateCache_.SetContext(pContext);
+
+        // without D3D11.1 per-draw constants are written into buffers of shaders
+        if (cbRing_.Initialize(pDevice, pContext))
+            shadersContainer_.materialIconShader_.SetConstBufferRing(&cbRing_);
+
+        // dynamic geometry of the frame is sub-allocated from a few large buffers
+        if (transientAlloc_.Initialize(pDevice, pContext))
+        {
+            shadersContainer_.debugLineShader_.SetTransientAllocator(&transientAlloc_);
+            shadersContainer_.impostorShader_.SetTransientAllocator(&transientAlloc_);
+            shadersContainer_.billboardShader_.SetTransientAllocator(&transientAlloc_);
+        }
+
+        // shaders could be loaded before the camera for 2D rendering is created
+        SetWorldViewOrtho(pContext, params.worldViewOrtho);
 
         // init fog params
         InitFogParams(pContext, params.fogColor, params.fogStart, params.fogRange);
@@ -97,11 +228,12 @@ bool CRender::Initialize(
         TerrainShader&  terrainShader = shadersContainer_.terrainShader_;
         
         // const buffers for vertex shaders (vsCB)
-        ID3D11Buffer* vsCBs[3] = 
+        ID3D11Buffer* vsCBs[4] = 
         {
             cbvsPerFrame_.Get(),                         // slot_0: is common for color/light/debug shader
             skyDomeShader.GetConstBufferVSPerFrame(),    // slot_1: sky dome
             fontShader.GetConstBufferVS(),               // slot_2: font shader
+            cbgsPerFrame_.Get(),                         // slot_3: billboards vertex pulling (view-proj and eye pos as for GS)
         };	
 
         // const buffers for geometry shaders (gsCB)
@@ -128,9 +260,9 @@ bool CRender::Initialize(
         const UINT numBuffersPS = sizeof(psCBs) / sizeof(ID3D11Buffer*);
 
         // bind constant buffers 
-        pContext->VSSetConstantBuffers(0, numBuffersVS, vsCBs);
-        pContext->GSSetConstantBuffers(0, numBuffersGS, gsCBs);
-        pContext->PSSetConstantBuffers(0, numBuffersPS, psCBs);
+        stateCache_.SetVSConstantBuffers(pContext, 0, numBuffersVS, vsCBs);
+        stateCache_.SetGSConstantBuffers(pContext, 0, numBuffersGS, gsCBs);
+        stateCache_.SetPSConstantBuffers(pContext, 0, numBuffersPS, psCBs);
     }
     catch (EngineException& e)
     {
@@ -145,20 +277,59 @@ bool CRender::Initialize(
 ///////////////////////////////////////////////////////////
 
 bool CRender::ShadersHotReload(ID3D11Device* pDevice)
+{
+    // shaders are compiled by a job and swapped in at the start of some next frame
+    (void)pDevice;
+    shaderHotReloader_.RequestReload();
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::InitShadersHotReload(ID3D11Device* pDevice)
 {
     try
     {
-        shadersContainer_.lightShader_.ShaderHotReload       (pDevice, "shaders/hlsl/LightVS.hlsl",        "shaders/hlsl/LightPS.hlsl");
-        shadersContainer_.materialIconShader_.ShaderHotReload(pDevice, "shaders/hlsl/MaterialIconVS.hlsl", "shaders/hlsl/MaterialIconPS.hlsl");
-        shadersContainer_.terrainShader_.ShaderHotReload     (pDevice, "shaders/hlsl/TerrainVS.hlsl",      "shaders/hlsl/TerrainPS.hlsl");
-        LogDbg("shaders are hot reloaded");
-
-        return true;
+        LightShader&        lightShader        = shadersContainer_.lightShader_;
+        MaterialIconShader& materialIconShader = shadersContainer_.materialIconShader_;
+        TerrainShader&      terrainShader      = shadersContainer_.terrainShader_;
+
+        const InputLayoutLight        layoutLight;
+        const InputLayoutMaterialIcon layoutMaterialIcon;
+        const InputLayoutTerrain      layoutTerrain;
+
+        // without watching only manual hot reload works
+        shaderHotReloader_.Initialize(pDevice, "shaders/hlsl");
+
+        shaderHotReloader_.AddShaders(
+            "shaders/hlsl/LightVS.hlsl",
+            "shaders/hlsl/LightPS.hlsl",
+            &lightShader.GetVS(),
+            &lightShader.GetPS(),
+            layoutLight.desc,
+            layoutLight.numElem,
+            &lightShader.GetPSPermutations());
+
+        shaderHotReloader_.AddShaders(
+            "shaders/hlsl/MaterialIconVS.hlsl",
+            "shaders/hlsl/MaterialIconPS.hlsl",
+            &materialIconShader.GetVS(),
+            &materialIconShader.GetPS(),
+            layoutMaterialIcon.desc,
+            layoutMaterialIcon.numElem);
+
+        shaderHotReloader_.AddShaders(
+            "shaders/hlsl/TerrainVS.hlsl",
+            "shaders/hlsl/TerrainPS.hlsl",
+            &terrainShader.GetVS(),
+            &terrainShader.GetPS(),
+            layoutTerrain.desc,
+            layoutTerrain.numElems);
     }
     catch (EngineException& e)
     {
         LogErr(e, true);
-        return false;
+        LogErr("can't initialize shaders hot reload");
     }
 }
 
@@ -175,8 +346,13 @@ void CRender::UpdatePerFrame(
 
     try 
     {
+        // swap in hot reloaded shaders (if any) before this frame draws something
+        if (shaderHotReloader_.Update())
+            stateCache_.Invalidate();
+
         // view * proj matrix must be already transposed
         cbvsPerFrame_.data.viewProj = data.viewProj;
+        cbvsPerFrame_.data.gameTime = data.totalGameTime;
         cbgsPerFrame_.data.viewProj = data.viewProj;
 
         // update the camera pos
@@ -184,19 +360,52 @@ void CRender::UpdatePerFrame(
         cbgsPerFrame_.data.cameraPosW = data.cameraPos;
 
         // update light sources data
-        UpdateLights(
-            data.dirLights,
+        UpdateLights(data.dirLights, data.numDirLights);
+
+        // load rarely changed params which were set since the prev frame
+        FlushConstBuffers(pContext);
+
+        // patch the GPU copy of all point lights by changed ones
+        if (data.visPointLightIdxs)
+        {
+            lightClusters_.PatchResidentPointLights(
+                pContext,
+                data.pointLightPatches,
+                data.pointLightPatchIdxs,
+                data.numPointLightPatches,
+                data.numResidentPointLights);
+        }
+
+        // point/spot lights are assigned to clusters and go into structured buffers
+        lightClusters_.Update(
+            pContext,
             data.pointLights,
+            data.visPointLightIdxs,
             data.spotLights,
-            data.numDirLights,
             data.numPointLights,
-            data.numSpotLights);
+            data.numSpotLights,
+            data.view,
+            data.proj,
+            data.screenWidth,
+            data.screenHeight,
+            cbpsPerFrame_.data);
 
         // after all we apply updates
         cbvsPerFrame_.ApplyChanges(pContext);
         cbpsPerFrame_.ApplyChanges(pContext);
         cbgsPerFrame_.ApplyChanges(pContext);
 
+        // bind the materials table for instances
+        stateCache_.SetVSShaderResources(pContext, MATERIALS_TABLE_SLOT, 1, &pMaterialsSRV_);
+        stateCache_.SetVSShaderResources(pContext, MATERIAL_TEX_LAYERS_SLOT, 1, &pTexLayersSRV_);
+        stateCache_.SetPSShaderResources(pContext, MATERIAL_TEX_ARRS_SLOT, 2, materialTexArrs_);
+
+        // bind light buffers and lists of lights per cluster
+        lightClusters_.Bind(pContext, stateCache_);
+
+        // (nullptrs if there are no baked lights so released volumes aren't kept bound)
+        stateCache_.SetPSShaderResources(pContext, STATIC_LIGHTS_SLOT, NUM_STATIC_LIGHTS_SRVS, staticLightsSRVs_);
+
     }
     catch (EngineException& e)
     {
@@ -210,87 +419,101 @@ void CRender::UpdatePerFrame(
 
 ///////////////////////////////////////////////////////////
 
-void CRender::UpdateInstancedBuffer(
+void CRender::FlushConstBuffers(ID3D11DeviceContext* pContext)
+{
+    // setters of fog, flashlight, sky, etc. only change params on CPU so
+    // each buffer is mapped at most once however many setters were called
+    cbpsRareChanged_.ApplyChangesIfDirty(pContext);
+    shadersContainer_.skyDomeShader_.FlushConstBuffers(pContext);
+}
+
+///////////////////////////////////////////////////////////
+
+UINT CRender::UpdateInstancedBuffer(
     ID3D11DeviceContext* pContext,
     const InstBuffData& data)
 {
-    UpdateInstancedBuffer(
+    return UpdateInstancedBuffer(
         pContext,
         data.worlds_,
         data.texTransforms_,
-        data.materials_,
+        data.materialIdxs_,
+        data.enttIds_,
         data.GetSize());     // get the number of elements to render
 }
 
 ///////////////////////////////////////////////////////////
 
-void CRender::UpdateInstancedBuffer(
+UINT CRender::UpdateInstancedBuffer(
     ID3D11DeviceContext* pContext,
     const DirectX::XMMATRIX* worlds,
     const DirectX::XMMATRIX* texTransforms,
-    const Material* materials,
+    const uint32_t* materialIdxs,
+    const uint32_t* enttIds,
     const int count)
 {
     // fill in the instanced buffer with data
+    PROFILE_SCOPE("UploadInstances");
+
     try
     {
         CAssert::True(worlds != nullptr,        "input arr of world matrices == nullptr");
         CAssert::True(texTransforms != nullptr, "input arr of texture transformations == nullptr");
-        CAssert::True(materials != nullptr,     "input arr of materials == nullptr");
+        CAssert::True(materialIdxs != nullptr,  "input arr of materials idxs == nullptr");
         CAssert::True(count > 0,                "input number of elements must be > 0");
 
-        // map the instanced buffer to write into it
-        D3D11_MAPPED_SUBRESOURCE mappedData;
-        HRESULT hr = pContext->Map(pInstancedBuffer_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
-        CAssert::NotFailed(hr, "can't map the instanced buffer");
+        // map a new range of the instances ring to write into it
+        UINT baseInstance = 0;
+        ConstBufType::InstancedData* dataView = instanceRing_.Map(pContext, (UINT)count, baseInstance);
+        CAssert::True(dataView != nullptr, "can't map the instanced buffer");
 
-        ConstBufType::InstancedData* dataView = (ConstBufType::InstancedData*)mappedData.pData;
-
-        // write data into the subresource
-        for (int i = 0; i < count; ++i)
+        // write data into the subresource: a single sequential pass
+        // (the mapped memory is write-combined)
+        if (enttIds)
         {
-            dataView[i].world = worlds[i];
-            dataView[i].worldInvTranspose = MathHelper::InverseTranspose(worlds[i]);
+            for (int i = 0; i < count; ++i)
+                ConstBufType::PackInstance(dataView[i], worlds[i], texTransforms[i], materialIdxs[i], enttIds[i]);
+        }
+        else
+        {
+            for (int i = 0; i < count; ++i)
+                ConstBufType::PackInstance(dataView[i], worlds[i], texTransforms[i], materialIdxs[i], 0);
         }
 
-        for (int i = 0; i < count; ++i)
-            dataView[i].texTransform = texTransforms[i];
-
-        for (int i = 0; i < count; ++i)
-            dataView[i].material = materials[i];
-
-        pContext->Unmap(pInstancedBuffer_, 0);
+        instanceRing_.Unmap(pContext);
+        return baseInstance;
     }
     catch (EngineException& e)
     {
         LogErr(e);
         LogErr("can't update instanced buffer for rendering");
+        return 0;
     }
 }
 
 ///////////////////////////////////////////////////////////
 
-void CRender::UpdateInstancedBufferWorlds(
+UINT CRender::UpdateInstancedBufferWorlds(
     ID3D11DeviceContext* pContext,
     cvector<DirectX::XMMATRIX>& worlds)
 {
+    PROFILE_SCOPE("UploadInstances");
+
     try
     {
-        // map the instanced buffer to write to it
-        D3D11_MAPPED_SUBRESOURCE mappedData;
-        HRESULT hr = pContext->Map(pInstancedBuffer_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
-        CAssert::NotFailed(hr, "can't map the instanced buffer");
+        // map a new range of the instances ring to write into it
+        UINT baseInstance = 0;
+        ConstBufType::InstancedData* dataView = instanceRing_.Map(pContext, (UINT)worlds.size(), baseInstance);
+        CAssert::True(dataView != nullptr, "can't map the instanced buffer");
 
-        ConstBufType::InstancedData* dataView = (ConstBufType::InstancedData*)mappedData.pData;
+        // write data into the subresource (whole records: the mapped memory is write-combined)
+        const DirectX::XMMATRIX identity = DirectX::XMMatrixIdentity();
 
-        // write data into the subresource
         for (index i = 0; i < std::ssize(worlds); ++i)
-        {
-            dataView[i].world = worlds[i];
-            dataView[i].worldInvTranspose = MathHelper::InverseTranspose(worlds[i]);
-        }
+            ConstBufType::PackInstance(dataView[i], worlds[i], identity, 0, 0);
 
-        pContext->Unmap(pInstancedBuffer_, 0);
+        instanceRing_.Unmap(pContext);
+        return baseInstance;
     }
     catch (EngineException& e)
     {
@@ -301,40 +524,133 @@ void CRender::UpdateInstancedBufferWorlds(
     {
         LogErr("can't update instanced buffer for rendering for some unknown reason :)");
     }
+
+    return 0;
 }
 
 ///////////////////////////////////////////////////////////
 
-void CRender::UpdateInstancedBufferMaterials(
+void CRender::EndFrame(ID3D11DeviceContext* pContext)
+{
+    instanceRing_.EndFrame(pContext);
+    cbRing_.EndFrame(pContext);
+    transientAlloc_.EndFrame(pContext);
+
+    // the state can be changed by someone else between frames (UI, frame buffers, etc.)
+    // so the next frame starts with the unknown state
+    stateCache_.EndFrame();
+    stateCache_.Invalidate();
+}
+
+//---------------------------------------------------------
+// Desc:   write elements into the dynamic structured buffer; if there is
+//         not enough space the buffer and its SRV are recreated with some reserve
+//---------------------------------------------------------
+static void UploadStructuredBuffer(
     ID3D11DeviceContext* pContext,
-    cvector<Material>& materials)
+    const void* data,
+    const UINT elemSize,
+    const int numElems,
+    ID3D11Buffer** ppBuffer,
+    ID3D11ShaderResourceView** ppSRV,
+    int& inOutCapacity)
 {
-    try
+    if (numElems > inOutCapacity)
     {
-        // map the instanced buffer to write to it
-        D3D11_MAPPED_SUBRESOURCE mappedData;
-        HRESULT hr = pContext->Map(pInstancedBuffer_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
-        CAssert::NotFailed(hr, "can't map the instanced buffer");
+        SafeRelease(ppSRV);
+        SafeRelease(ppBuffer);
+        inOutCapacity = 0;
 
-        ConstBufType::InstancedData* dataView = (ConstBufType::InstancedData*)mappedData.pData;
+        ID3D11Device* pDevice = nullptr;
+        pContext->GetDevice(&pDevice);
 
-        // write data into the subresource
-        for (index i = 0; i < std::ssize(materials); ++i)
-            dataView[i].material = materials[i];
+        // reserve some space so adding of a few elements won't cause recreation
+        const int capacity = numElems + (numElems >> 1);
 
-        pContext->Unmap(pInstancedBuffer_, 0);
+        D3D11_BUFFER_DESC desc;
+        desc.Usage               = D3D11_USAGE_DYNAMIC;
+        desc.ByteWidth           = elemSize * capacity;
+        desc.BindFlags           = D3D11_BIND_SHADER_RESOURCE;
+        desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        desc.StructureByteStride = elemSize;
+
+        HRESULT hr = pDevice->CreateBuffer(&desc, nullptr, ppBuffer);
+
+        if (SUCCEEDED(hr))
+        {
+            D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+            srvDesc.Format               = DXGI_FORMAT_UNKNOWN;
+            srvDesc.ViewDimension        = D3D11_SRV_DIMENSION_BUFFER;
+            srvDesc.Buffer.FirstElement  = 0;
+            srvDesc.Buffer.NumElements   = capacity;
+
+            hr = pDevice->CreateShaderResourceView(*ppBuffer, &srvDesc, ppSRV);
+        }
+
+        SafeRelease(&pDevice);
+        CAssert::NotFailed(hr, "can't create a structured buffer");
+
+        inOutCapacity = capacity;
     }
-    catch (EngineException& e)
+
+    // write elements into the buffer
+    D3D11_MAPPED_SUBRESOURCE mappedData;
+    HRESULT hr = pContext->Map(*ppBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+    CAssert::NotFailed(hr, "can't map a structured buffer");
+
+    memcpy(mappedData.pData, data, elemSize * numElems);
+    pContext->Unmap(*ppBuffer, 0);
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::UpdateMaterialsTable(
+    ID3D11DeviceContext* pContext,
+    const Material* materials,
+    const MaterialTexLayers* texLayers,
+    const int numMaterials)
+{
+    try
     {
-        LogErr(e);
-        LogErr("can't update instanced buffer MATERIALS for rendering");
+        CAssert::True(materials != nullptr, "input arr of materials == nullptr");
+        CAssert::True(texLayers != nullptr, "input arr of materials textures layers == nullptr");
+        CAssert::True(numMaterials > 0,     "input number of materials must be > 0");
+
+        UploadStructuredBuffer(
+            pContext,
+            materials,
+            sizeof(Material),
+            numMaterials,
+            &pMaterialsBuffer_,
+            &pMaterialsSRV_,
+            materialsCapacity_);
+
+        UploadStructuredBuffer(
+            pContext,
+            texLayers,
+            sizeof(MaterialTexLayers),
+            numMaterials,
+            &pTexLayersBuffer_,
+            &pTexLayersSRV_,
+            texLayersCapacity_);
     }
-    catch (...)
+    catch (EngineException& e)
     {
-        LogErr("can't update instanced buffer for rendering for some unknown reason :)");
+        LogErr(e);
+        LogErr("can't update the materials table");
     }
 }
 
+///////////////////////////////////////////////////////////
+
+void CRender::SetMaterialTexArrays(SRV* pDiffuseArr, SRV* pNormalArr)
+{
+    // the arrays are bound once per frame (see UpdatePerFrame)
+    materialTexArrs_[0] = pDiffuseArr;
+    materialTexArrs_[1] = pNormalArr;
+}
+
 
 
 
@@ -342,40 +658,34 @@ void CRender::UpdateInstancedBufferMaterials(
 //                               rendering methods
 // =================================================================================
 
-void CRender::RenderBoundingLineBoxes(
+void CRender::RenderInstances(
     ID3D11DeviceContext* pContext,
+    const ShaderTypes type,
     const Instance* instances,
-    const int numModels)
+    const int numInstances,
+    const UINT baseInstance,
+    const eDrawPass pass)
 {
-    try
-    {
-        const UINT instancedBuffElemSize = static_cast<UINT>(sizeof(ConstBufType::InstancedData));
-
-        shadersContainer_.colorShader_.Render(
-            pContext,
-            pInstancedBuffer_,
-            instances,
-            numModels,
-            instancedBuffElemSize);
-    }
-    catch (EngineException& e)
-    {
-        LogErr(e);
-        LogErr("can't render the bounding line boxes onto the screen");
-    }
-    catch (...)
-    {
-        LogErr("can't render the bounding line boxes for some unknown reason :(");
-    }
+    RenderInstances(
+        pContext,
+        instanceRing_.GetBuffer(),
+        type,
+        instances,
+        numInstances,
+        baseInstance,
+        pass);
 }
 
 ///////////////////////////////////////////////////////////
 
 void CRender::RenderInstances(
     ID3D11DeviceContext* pContext,
+    ID3D11Buffer* pInstancedBuffer,
     const ShaderTypes type,
     const Instance* instances,
-    const int numInstances)
+    const int numInstances,
+    const UINT baseInstance,
+    const eDrawPass pass)
 {
     try
     {
@@ -385,10 +695,11 @@ void CRender::RenderInstances(
         {
             shadersContainer_.debugShader_.Render(
                 pContext,
-                pInstancedBuffer_,
+                pInstancedBuffer,
                 instances,
                 numInstances,
-                instancedBuffElemSize);
+                instancedBuffElemSize,
+                baseInstance);
 
             return;
         }
@@ -401,10 +712,11 @@ void CRender::RenderInstances(
             {
                 shadersContainer_.colorShader_.Render(
                     pContext,
-                    pInstancedBuffer_,
+                    pInstancedBuffer,
                     instances,
                     numInstances,
-                    instancedBuffElemSize);
+                    instancedBuffElemSize,
+                    baseInstance);
 
                 break;
             }
@@ -412,10 +724,11 @@ void CRender::RenderInstances(
             {
                 shadersContainer_.textureShader_.Render(
                     pContext,
-                    pInstancedBuffer_,
+                    pInstancedBuffer,
                     instances,
                     numInstances,
-                    instancedBuffElemSize);
+                    instancedBuffElemSize,
+                    baseInstance);
                 break;
             }
 #if 0
@@ -423,21 +736,34 @@ void CRender::RenderInstances(
             {
                 shadersContainer_.billboardShader_.CRender(
                     pContext,
-                    pInstancedBuffer_,
+                    pInstancedBuffer,
                     instances,
                     numInstances,
-                    instancedBuffElemSize);
+                    instancedBuffElemSize,
+                    baseInstance);
                 break;
             }
 #endif
             case LIGHT:
             {
-                shadersContainer_.lightShader_.Render(
+                // each recording thread has its own sorter
+                static thread_local DrawSorter sorter;
+                sorter.Build(instances, numInstances, baseInstance, pass, (uint8)type);
+
+                // (flags are the same for the whole pass so they are a part of the key)
+                const uint32 permutationKey = LightShader::MakePermutationKey(
+                    cbpsRareChanged_.data.fogEnabled,
+                    pass == DRAW_PASS_ALPHA_CLIPPED,
+                    cbpsRareChanged_.data.numOfDirLights);
+
+                shadersContainer_.lightShader_.RenderSorted(
                     pContext,
-                    pInstancedBuffer_,
+                    pInstancedBuffer,
                     instances,
-                    numInstances,
-                    instancedBuffElemSize);
+                    sorter.GetDraws(),
+                    sorter.GetNumDraws(),
+                    instancedBuffElemSize,
+                    permutationKey);
 
                 break;
             }
@@ -445,10 +771,11 @@ void CRender::RenderInstances(
             {
                 shadersContainer_.outlineShader_.Render(
                     pContext,
-                    pInstancedBuffer_,
+                    pInstancedBuffer,
                     instances,
                     numInstances,
-                    instancedBuffElemSize);
+                    instancedBuffElemSize,
+                    baseInstance);
 
                 break;
             }
@@ -495,6 +822,257 @@ void CRender::RenderSkyDome(
     }
 }
 
+///////////////////////////////////////////////////////////
+
+void CRender::BuildHiZBuffer(
+    ID3D11DeviceContext* pContext,
+    ID3D11ShaderResourceView* pDepthSRV,
+    const UINT depthWidth,
+    const UINT depthHeight,
+    const UINT depthNumSamples,
+    const XMMATRIX& viewProj)
+{
+    // the depth buffer can't be read while it is bound as the depth stencil view
+    // so unbind it for a while and restore the output merger targets after
+    ID3D11RenderTargetView* pRTV = nullptr;
+    ID3D11DepthStencilView* pDSV = nullptr;
+
+    pContext->OMGetRenderTargets(1, &pRTV, &pDSV);
+    pContext->OMSetRenderTargets(1, &pRTV, nullptr);
+
+    hiZBuffer_.Build(pContext, pDepthSRV, depthWidth, depthHeight, depthNumSamples, viewProj);
+
+    pContext->OMSetRenderTargets(1, &pRTV, pDSV);
+
+    // OMGetRenderTargets() increments ref counters
+    SafeRelease(&pRTV);
+    SafeRelease(&pDSV);
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::CullGpuInstances(ID3D11DeviceContext* pContext, const GpuCullParams& params)
+{
+    // the visible instances buffer can be still bound as the instances stream
+    // since the prev frame; the runtime would unbind it silently when it is
+    // bound as UAV so unbind it through the state cache
+    ID3D11Buffer* const nullVB = nullptr;
+    const UINT          zero   = 0;
+
+    stateCache_.SetVertexBuffers(pContext, 1, 1, &nullVB, &zero, &zero);
+
+    gpuCulling_.Cull(pContext, params, hiZBuffer_);
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::GatherStaticInstances(ID3D11DeviceContext* pContext, const uint32* idxs, const UINT numIdxs)
+{
+    // the visible buffer of static batches can be still bound as the instances
+    // stream since the prev frame (see CullGpuInstances)
+    ID3D11Buffer* const nullVB = nullptr;
+    const UINT          zero   = 0;
+
+    stateCache_.SetVertexBuffers(pContext, 1, 1, &nullVB, &zero, &zero);
+
+    staticBatches_.Gather(pContext, idxs, numIdxs);
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::RenderGBufferInstances(
+    ID3D11DeviceContext* pContext,
+    ID3D11Buffer* pInstancedBuffer,
+    const Instance* instances,
+    const int numInstances,
+    const UINT baseInstance,
+    const eDrawPass pass)
+{
+    // the same sorting of draws as of the light shader (by textures, buffers, depth)
+    static thread_local DrawSorter sorter;
+    sorter.Build(instances, numInstances, baseInstance, pass, (uint8)LIGHT);
+
+    shadersContainer_.lightShader_.RenderSorted(
+        pContext,
+        pInstancedBuffer,
+        instances,
+        sorter.GetDraws(),
+        sorter.GetNumDraws(),
+        static_cast<UINT>(sizeof(ConstBufType::InstancedData)),
+        0,
+        deferredShading_.GetGBufferPS());
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::RenderDeferredLighting(
+    ID3D11DeviceContext* pContext,
+    ID3D11ShaderResourceView* pDepthSRV,
+    const UINT width,
+    const UINT height)
+{
+    // the lighting CS uses the same lights, clusters and shadows as the light PS;
+    // they are bound to CS by the same slots (see DeferredLightingCS.hlsl)
+    ID3D11Buffer* const cbs[2] = { cbpsPerFrame_.Get(), cbpsRareChanged_.Get() };
+
+    pContext->CSSetConstantBuffers(0, 2, cbs);
+    pContext->CSSetShaderResources(DeferredShading::CS_MATERIALS_SLOT, 1, &pMaterialsSRV_);
+    lightClusters_.BindCS(pContext);
+
+    // the fog of lit pixels is blended into the sky by the same LUT as of the light PS
+    ID3D11ShaderResourceView* pSkyFogSRV = skyFogLut_.GetSRV();
+    pContext->CSSetShaderResources(SkyFogLut::SLOT, 1, &pSkyFogSRV);
+    pContext->CSSetSamplers(0, 1, skyFogLut_.GetSampler());
+
+    if (cbpsPerFrame_.data.hasStaticLights)
+        pContext->CSSetShaderResources(STATIC_LIGHTS_SLOT, NUM_STATIC_LIGHTS_SRVS, staticLightsSRVs_);
+
+    // (without bound shadows the const buffer is read as zeros: no cascades)
+    if (shadowMaps_.IsActive())
+        shadowMaps_.BindCS(pContext);
+
+    deferredShading_.Light(pContext, pDepthSRV, width, height, perFrameData_.view, perFrameData_.proj);
+
+    // shadow maps and light buffers are written later (t23: shadow maps,
+    // t24..t27: light buffers, b8: shadows)
+    ID3D11ShaderResourceView* const nullSRVs[5] = { nullptr };
+    ID3D11Buffer*             const nullCB      = nullptr;
+
+    pContext->CSSetShaderResources(LightClusters::POINT_LIGHTS_SLOT - 1, 5, nullSRVs);
+    pContext->CSSetShaderResources(SkyFogLut::SLOT, 1, nullSRVs);
+    pContext->CSSetShaderResources(STATIC_LIGHTS_SLOT, NUM_STATIC_LIGHTS_SRVS, nullSRVs);
+    pContext->CSSetConstantBuffers(8, 1, &nullCB);
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::SetLightClustersPixelScale(ID3D11DeviceContext* pContext, const float scale)
+{
+    // the params of clusters are computed by the screen size (see LightClusters::Update)
+    // so they are rescaled relatively to the current scale
+    if ((scale <= 0.0f) || (scale == clusterPixelScale_))
+        return;
+
+    const float k = scale / clusterPixelScale_;
+
+    cbpsPerFrame_.data.clusterScaleX *= k;
+    cbpsPerFrame_.data.clusterScaleY *= k;
+    cbpsPerFrame_.ApplyChanges(pContext);
+
+    clusterPixelScale_ = scale;
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::CompositeLowResBlending(
+    ID3D11DeviceContext* pContext,
+    ID3D11ShaderResourceView* pLowColorSRV,
+    ID3D11ShaderResourceView* pLowDepthSRV,
+    ID3D11ShaderResourceView* pSceneDepthSRV,
+    const UINT factor,
+    const UINT width,
+    const UINT height)
+{
+    lowResBlending_.Composite(
+        pContext,
+        pLowColorSRV,
+        pLowDepthSRV,
+        pSceneDepthSRV,
+        factor,
+        width,
+        height,
+        perFrameData_.proj);
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::BeginReflectionLighting(ID3D11DeviceContext* pContext, const XMFLOAT3& cameraPos)
+{
+    ConstBufType::cbpsPerFrame& data = cbpsPerFrame_.data;
+
+    savedCameraPos_      = data.cameraPos;
+    savedNumPointLights_ = data.currNumPointLights;
+    savedNumSpotLights_  = data.currNumSpotLights;
+
+    // without point/spot lights the light PS skips the cluster lookup at all
+    data.cameraPos          = cameraPos;
+    data.currNumPointLights = 0;
+    data.currNumSpotLights  = 0;
+    cbpsPerFrame_.ApplyChanges(pContext);
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::EndReflectionLighting(ID3D11DeviceContext* pContext)
+{
+    ConstBufType::cbpsPerFrame& data = cbpsPerFrame_.data;
+
+    data.cameraPos          = savedCameraPos_;
+    data.currNumPointLights = savedNumPointLights_;
+    data.currNumSpotLights  = savedNumSpotLights_;
+    cbpsPerFrame_.ApplyChanges(pContext);
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::UpdateSkyFog(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSkyCubeSRV)
+{
+    skyFogLut_.Update(pContext, pSkyCubeSRV);
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::SetStaticLights(
+    ID3D11ShaderResourceView* const* ppSRVs,
+    const XMFLOAT3& boundsMin,
+    const XMFLOAT3& boundsMax,
+    const float normalBias)
+{
+    // the volumes are bound by the next UpdatePerFrame() (and by the deferred lighting)
+    ConstBufType::cbpsPerFrame& data = cbpsPerFrame_.data;
+
+    const bool hasVolumes = ppSRVs && ppSRVs[0] && ppSRVs[1] && ppSRVs[2];
+    const XMFLOAT3 size   = { boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z };
+
+    if (!hasVolumes || (size.x <= 0.0f) || (size.y <= 0.0f) || (size.z <= 0.0f))
+    {
+        for (UINT i = 0; i < NUM_STATIC_LIGHTS_SRVS; ++i)
+            staticLightsSRVs_[i] = nullptr;
+
+        data.hasStaticLights = 0;
+        return;
+    }
+
+    for (UINT i = 0; i < NUM_STATIC_LIGHTS_SRVS; ++i)
+        staticLightsSRVs_[i] = ppSRVs[i];
+
+    data.staticLightsMin        = boundsMin;
+    data.staticLightsInvSize    = { 1.0f / size.x, 1.0f / size.y, 1.0f / size.z };
+    data.staticLightsNormalBias = normalBias;
+    data.hasStaticLights        = 1;
+}
+
+///////////////////////////////////////////////////////////
+
+void CRender::RenderGpuCulledInstances(ID3D11DeviceContext* pContext)
+{
+    if (!gpuCulling_.HasScene())
+        return;
+
+    const cvector<Instance>& instances = gpuCulling_.GetInstances();
+    const cvector<GpuDraw>&  draws     = gpuCulling_.GetDraws();
+
+    shadersContainer_.lightShader_.RenderIndirect(
+        pContext,
+        gpuCulling_.GetVisibleBuffer(),
+        gpuCulling_.GetArgsBuffer(),
+        instances.data(),
+        draws.data(),
+        (int)draws.size(),
+        GpuCulling::INSTANCE_SIZE,
+        LightShader::MakePermutationKey(cbpsRareChanged_.data.fogEnabled, false, cbpsRareChanged_.data.numOfDirLights));
+}
+
 
 
 // =================================================================================
@@ -505,7 +1083,7 @@ void CRender::SwitchFlashLight(ID3D11DeviceContext* pContext, const bool state)
 {
     // switch the flashlight state
     cbpsRareChanged_.data.turnOnFlashLight = state;
-    cbpsRareChanged_.ApplyChanges(pContext);
+    cbpsRareChanged_.MarkDirty();
 }
 
 ///////////////////////////////////////////////////////////
@@ -514,7 +1092,7 @@ void CRender::SwitchAlphaClipping(ID3D11DeviceContext* pContext, const bool stat
 {
     // turn on/off alpha clipping
     cbpsRareChanged_.data.alphaClipping = state;
-    cbpsRareChanged_.ApplyChanges(pContext);
+    cbpsRareChanged_.MarkDirty();
 }
 
 ///////////////////////////////////////////////////////////
@@ -542,6 +1120,11 @@ void CRender::SwitchDebugState(ID3D11DeviceContext* pContext, const eDebugState
         case DBG_SHOW_ONLY_DIFFUSE_MAP:
         case DBG_SHOW_ONLY_NORMAL_MAP:
         case DBG_WIREFRAME:
+        case DBG_SHOW_OVERDRAW:
+        case DBG_SHOW_LOD:
+        case DBG_SHOW_LIGHT_COUNT:
+        case DBG_SHOW_TRIANGLE_DENSITY:
+        case DBG_SHOW_BATCHES:
         {
             isDebugMode_ = true;
             shadersContainer_.debugShader_.SetDebugType(pContext, state);
@@ -571,7 +1154,7 @@ void CRender::SetDirLightsCount(ID3D11DeviceContext* pContext, int numOfLights)
     }
 
     cbpsRareChanged_.data.numOfDirLights = numOfLights;
-    cbpsRareChanged_.ApplyChanges(pContext);
+    cbpsRareChanged_.MarkDirty();
 }
 
 // =================================================================================
@@ -581,7 +1164,7 @@ void CRender::SetFogEnabled(ID3D11DeviceContext* pContext, const bool state)
 {
     // turn on/off the fog effect
     cbpsRareChanged_.data.fogEnabled = state;
-    cbpsRareChanged_.ApplyChanges(pContext);
+    cbpsRareChanged_.MarkDirty();
 }
 
 ///////////////////////////////////////////////////////////
@@ -590,7 +1173,7 @@ void CRender::SetFogStart(ID3D11DeviceContext* pContext, const float start)
 {
     // setup where the for starts
     cbpsRareChanged_.data.fogStart = (start > 0) ? start : 0.0f;
-    cbpsRareChanged_.ApplyChanges(pContext);
+    cbpsRareChanged_.MarkDirty();
 }
 
 ///////////////////////////////////////////////////////////
@@ -599,7 +1182,7 @@ void CRender::SetFogRange(ID3D11DeviceContext* pContext, const float range)
 {
     // setup distance after start where objects will be fully fogged
     cbpsRareChanged_.data.fogRange = (range > 1) ? range : 1.0f;
-    cbpsRareChanged_.ApplyChanges(pContext);
+    cbpsRareChanged_.MarkDirty();
 }
 
 ///////////////////////////////////////////////////////////
@@ -607,7 +1190,7 @@ void CRender::SetFogRange(ID3D11DeviceContext* pContext, const float range)
 void CRender::SetFogColor(ID3D11DeviceContext* pContext, const DirectX::XMFLOAT3 color)
 {
     cbpsRareChanged_.data.fogColor = color;
-    cbpsRareChanged_.ApplyChanges(pContext);
+    cbpsRareChanged_.MarkDirty();
 }
 
 ///////////////////////////////////////////////////////////
@@ -634,7 +1217,7 @@ void CRender::InitFogParams(
     cbpsRareChanged_.data.fogStart = start;
     cbpsRareChanged_.data.fogRange = range;
 
-    cbpsRareChanged_.ApplyChanges(pContext);
+    cbpsRareChanged_.MarkDirty();
 }
 
 
@@ -649,6 +1232,7 @@ void CRender::SetSkyGradient(
     try
     {
         shadersContainer_.skyDomeShader_.SetSkyGradient(pContext, colorCenter, colorApex);
+        skyFogLut_.Invalidate();
     }
     catch (EngineException& e)
     {
@@ -666,6 +1250,7 @@ void CRender::SetSkyColorCenter(
     try
     {
         shadersContainer_.skyDomeShader_.SetSkyColorCenter(pContext, color);
+        skyFogLut_.Invalidate();
     }
     catch (EngineException& e)
     {
@@ -683,6 +1268,7 @@ void CRender::SetSkyColorApex(
     try
     {
         shadersContainer_.skyDomeShader_.SetSkyColorApex(pContext, color);
+        skyFogLut_.Invalidate();
     }
     catch (EngineException& e)
     {
@@ -694,42 +1280,20 @@ void CRender::SetSkyColorApex(
 
 ///////////////////////////////////////////////////////////
 
-void CRender::UpdateLights(
-    const DirLight* dirLights,
-    const PointLight* pointLights,
-    const SpotLight* spotLights,
-    const int numDirLights,
-    const int numPointLights,
-    const int numSpotLights)
+void CRender::UpdateLights(const DirLight* dirLights, const int numDirLights)
 {
-    // load updated light sources data into const buffers
+    // load updated directional light sources data into const buffers
 
     // if for some reason we need to update the number of directed light sources
     if (cbpsRareChanged_.data.numOfDirLights != numDirLights)
     {
         cbpsRareChanged_.data.numOfDirLights = numDirLights;
-        cbpsRareChanged_.ApplyChanges(pContext_);
+        cbpsRareChanged_.MarkDirty();
     }
     
     // update directional light sources
     for (int i = 0; i < numDirLights; ++i)
         cbpsPerFrame_.data.dirLights[i] = dirLights[i];
-
-    // we want to copy the proper number of point lights
-    const int pointLightsCountLimit  = ARRAYSIZE(cbpsPerFrame_.data.pointLights);
-    const int spotLightsCountLimit   = ARRAYSIZE(cbpsPerFrame_.data.spotLights);
-    const int numPointLightsToUpdate = (numPointLights >= pointLightsCountLimit) ? pointLightsCountLimit : numPointLights;
-    const int numSpotLightsToUpdate  = (numSpotLights >= spotLightsCountLimit) ? spotLightsCountLimit : numSpotLights;
-
-    cbpsPerFrame_.data.currNumPointLights = numPointLightsToUpdate;
-    cbpsPerFrame_.data.currNumSpotLights = numSpotLightsToUpdate;
-
-    // update point/spot light sources
-    for (int i = 0; i < numPointLightsToUpdate; ++i)
-        cbpsPerFrame_.data.pointLights[i] = pointLights[i];
-
-    for (int i = 0; i < numSpotLightsToUpdate; ++i)
-        cbpsPerFrame_.data.spotLights[i] = spotLights[i];
 }
 
 ///////////////////////////////////////////////////////////
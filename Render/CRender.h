@@ -10,6 +10,30 @@
 #include "Common/ConstBufferTypes.h"
 #include "Shaders/ShadersContainer.h"
 #include "Common/RenderTypes.h"
+#include "HiZBuffer.h"
+#include "GpuCulling.h"
+#include "GpuParticles.h"
+#include "GrassScatter.h"
+#include "SkinnedCrowds.h"
+#include "EditorGrid.h"
+#include "VirtualTexture.h"
+#include "ShadowMaps.h"
+#include "DeferredShading.h"
+#include "LowResBlending.h"
+#include "PlanarReflection.h"
+#include "SkyFogLut.h"
+#include "StaticBatches.h"
+#include "LightClusters.h"
+#include "EntityIdBuffer.h"
+#include "DepthPrepass.h"
+#include "ShaderHotReloader.h"
+#include "InstanceRing.h"
+#include "ConstBufferRing.h"
+#include "TransientAllocator.h"
+#include "CommandRecorder.h"
+#include "StateCache.h"
+#include "GpuProfiler.h"
+#include "FrameStats.h"
 
 #include <d3d11.h>
 #include <DirectXMath.h>
@@ -29,6 +53,28 @@ struct InitParams
     DirectX::XMFLOAT3 fogColor{ 0.5f, 0.5f, 0.5f };
     float             fogStart = 50;                 // a distance where the fog starts
     float             fogRange = 200;                // max distance after which all the objects are fogged
+
+    // the number of deferred contexts for multithreaded recording (0 - disabled)
+    int               numDeferredContexts = 0;
+
+    // expand billboards by instanced quads (true) or by the geometry shader (false)
+    bool              billboardVertexPulling = true;
+
+    // the capacity of the GPU particles pool (0 - disabled)
+    UINT              maxParticles = 0;
+
+    // max number of visible grass clumps scattered over the terrain (0 - disabled)
+    UINT              maxGrassInstances = 0;
+    GrassParams       grassParams;
+
+    // max number of instances of skinned models (subsets) per frame (0 - disabled)
+    UINT              maxSkinnedInstances = 0;
+
+    // the procedural grid over the ground plane (is rendered only in the editor)
+    EditorGridParams  editorGridParams;
+
+    // cascaded shadow maps of the sun (shadowParams.numCascades == 0 - disabled)
+    ShadowParams      shadowParams;
 };
 
 ///////////////////////////////////////////////////////////
@@ -46,12 +92,19 @@ public:
     // setup logger file ptr if we want to write logs into the file
     void SetupLogger(FILE* pFile);
 
-    // initialize the rendering subsystem
+    // load shaders and create GPU resources of the rendering subsystem;
+    // only the device is used so it can be executed by a worker thread
+    // (e.g. while the scene is loaded by the main thread)
+    bool LoadShaders(ID3D11Device* pDevice, const InitParams& params);
+
+    // initialize the rendering subsystem (shaders are loaded here
+    // if LoadShaders() wasn't called before)
     bool Initialize(
         ID3D11Device* pDevice,
         ID3D11DeviceContext* pContext,
         const InitParams& params);
 
+    // request recompilation of all the hot reloaded shaders (in background)
     bool ShadersHotReload(ID3D11Device* pDevice);
 
 
@@ -60,46 +113,147 @@ public:
     // ================================================================================
     void UpdatePerFrame(ID3D11DeviceContext* pContext, const PerFrameData& data);
 
-    void UpdateInstancedBuffer(
+    // write instances into a new range of the instances ring;
+    // return: start instance location of this range (is passed for rendering)
+    UINT UpdateInstancedBuffer(
         ID3D11DeviceContext* pContext,
         const InstBuffData& data);
 
-    void UpdateInstancedBuffer(
+    UINT UpdateInstancedBuffer(
         ID3D11DeviceContext* pContext,
         const DirectX::XMMATRIX* worlds,
         const DirectX::XMMATRIX* texTransforms,
-        const Material* materials,
+        const uint32_t* materialIdxs,
+        const uint32_t* enttIds,                 // can be nullptr
         const int count);
 
-    void UpdateInstancedBufferWorlds(
+    UINT UpdateInstancedBufferWorlds(
         ID3D11DeviceContext* pContext, 
         cvector<DirectX::XMMATRIX>& worlds);
 
-    void UpdateInstancedBufferMaterials(
+    // load const buffers which were changed by setters since the prev flush
+    // (is called once per frame by UpdatePerFrame)
+    void FlushConstBuffers(ID3D11DeviceContext* pContext);
+
+    // put fences for the instances/constants rings after all the draws of the frame
+    // and reset the per-frame stats of the state cache
+    void EndFrame(ID3D11DeviceContext* pContext);
+
+    // upload the table of all the materials into the structured buffer
+    // (instances refer materials by idxs in this table) along with layers
+    // of their textures in the packed texture arrays;
+    // NOTE: is supposed to be called only when materials were added/changed
+    void UpdateMaterialsTable(
         ID3D11DeviceContext* pContext,
-        cvector<Material>& materials);
+        const Material* materials,
+        const MaterialTexLayers* texLayers,
+        const int numMaterials);
+
+    // texture arrays which are sampled by layers from the materials table
+    // (can be nullptr if there is no array)
+    void SetMaterialTexArrays(SRV* pDiffuseArr, SRV* pNormalArr);
 
 
     // ================================================================================
     //                                  Rendering
     // ================================================================================
 
-    void RenderBoundingLineBoxes(
+    // NOTE: draws of the LIGHT shader are sorted by keys (see DrawSorter)
+    void RenderInstances(
         ID3D11DeviceContext* pContext,
+        const ShaderTypes type,
         const Instance* instances,
-        const int numModels);
+        const int numModels,
+        const UINT baseInstance,                 // returned by UpdateInstancedBuffer()
+        const eDrawPass pass);
 
+    // the same but instances are taken from the input per-instance stream
+    // (e.g. the visible buffer of static batches)
     void RenderInstances(
         ID3D11DeviceContext* pContext,
+        ID3D11Buffer* pInstancedBuffer,
         const ShaderTypes type,
         const Instance* instances,
-        const int numModels);
+        const int numModels,
+        const UINT baseInstance,
+        const eDrawPass pass);
 
     void RenderSkyDome(
         ID3D11DeviceContext* pContext,
         const SkyInstance& sky,
         const DirectX::XMMATRIX& worldViewProj);
 
+    // build the Hi-Z buffer from the depth of the rendered scene (for occlusion culling);
+    // NOTE: the depth buffer is temporary unbound from the output merger
+    void BuildHiZBuffer(
+        ID3D11DeviceContext* pContext,
+        ID3D11ShaderResourceView* pDepthSRV,
+        const UINT depthWidth,
+        const UINT depthHeight,
+        const UINT depthNumSamples,
+        const DirectX::XMMATRIX& viewProj);
+
+    // GPU-driven opaque pass: cull the scene which was uploaded into the GPU
+    // culling and render the visible instances by indirect draws
+    void CullGpuInstances        (ID3D11DeviceContext* pContext, const GpuCullParams& params);
+    void RenderGpuCulledInstances(ID3D11DeviceContext* pContext);
+
+    // static batches: gather records of visible static instances (by indices
+    // into the uploaded records) into the visible buffer of static batches
+    void GatherStaticInstances(ID3D11DeviceContext* pContext, const uint32* idxs, const UINT numIdxs);
+
+    // deferred shading: render instances into the G-buffer (by the light VS and
+    // the same sorted draws as of the light shader); the G-buffer must be bound
+    void RenderGBufferInstances(
+        ID3D11DeviceContext* pContext,
+        ID3D11Buffer* pInstancedBuffer,
+        const Instance* instances,
+        const int numInstances,
+        const UINT baseInstance,
+        const eDrawPass pass);
+
+    // light the G-buffer by the tiled compute shader (with the light clusters and
+    // shadows of this frame) and composite it into the bound scene color;
+    // width/height: the rendered part of the scene depth
+    void RenderDeferredLighting(
+        ID3D11DeviceContext* pContext,
+        ID3D11ShaderResourceView* pDepthSRV,
+        const UINT width,
+        const UINT height);
+
+    // the next passes render into a target which is in N times smaller than the screen
+    // (see LowResBlending) so the light PS finds its cluster by pixel coords * N;
+    // NOTE: must be restored by 1 after these passes
+    void SetLightClustersPixelScale(ID3D11DeviceContext* pContext, const float scale);
+
+    // blend the low resolution color of blended content over the bound scene color
+    // (by the camera of this frame); width/height: the rendered part of the scene depth
+    void CompositeLowResBlending(
+        ID3D11DeviceContext* pContext,
+        ID3D11ShaderResourceView* pLowColorSRV,
+        ID3D11ShaderResourceView* pLowDepthSRV,
+        ID3D11ShaderResourceView* pSceneDepthSRV,
+        const UINT factor,
+        const UINT width,
+        const UINT height);
+
+    // casters of the planar reflection are lit from the reflected camera and only
+    // by directed lights (clusters of point/spot lights are of the main camera);
+    // NOTE: must be restored by EndReflectionLighting() after casters are rendered
+    void BeginReflectionLighting(ID3D11DeviceContext* pContext, const DirectX::XMFLOAT3& cameraPos);
+    void EndReflectionLighting(ID3D11DeviceContext* pContext);
+
+    // rebuild the sky fog LUT if the sky is changed and bind it (PS slot t31)
+    void UpdateSkyFog(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSkyCubeSRV);
+
+    // set volumes of baked static lights: diffuse, ambient, direction (see StaticLights.hlsli)
+    // and their world bounds; nullptrs switch the baked lighting off
+    void SetStaticLights(
+        ID3D11ShaderResourceView* const* ppSRVs,
+        const DirectX::XMFLOAT3& boundsMin,
+        const DirectX::XMFLOAT3& boundsMax,
+        const float normalBias);
+
 
 
 
@@ -108,6 +262,30 @@ public:
     // ================================================================================
     inline ShadersContainer& GetShadersContainer() { return shadersContainer_; }
     inline LightShader&      GetLightShader()      { return shadersContainer_.lightShader_; }
+    inline HiZBuffer&        GetHiZBuffer()        { return hiZBuffer_; }
+    inline GpuCulling&       GetGpuCulling()       { return gpuCulling_; }
+    inline StaticBatches&    GetStaticBatches()    { return staticBatches_; }
+    inline EntityIdBuffer&   GetEntityIdBuffer()   { return entityIdBuffer_; }
+    inline DepthPrepass&     GetDepthPrepass()     { return depthPrepass_; }
+    inline GpuParticles&     GetGpuParticles()     { return gpuParticles_; }
+    inline GrassScatter&     GetGrassScatter()     { return grassScatter_; }
+    inline SkinnedCrowds&    GetSkinnedCrowds()    { return skinnedCrowds_; }
+    inline EditorGrid&       GetEditorGrid()       { return editorGrid_; }
+    inline VirtualTexture&   GetTerrainVT()        { return terrainVT_; }
+    inline ShadowMaps&       GetShadowMaps()       { return shadowMaps_; }
+    inline DeferredShading&  GetDeferredShading()  { return deferredShading_; }
+    inline LowResBlending&   GetLowResBlending()   { return lowResBlending_; }
+    inline PlanarReflection& GetPlanarReflection() { return planarReflection_; }
+    inline SkyFogLut&        GetSkyFogLut()        { return skyFogLut_; }
+    inline InstanceRing&     GetInstanceRing()     { return instanceRing_; }
+    inline ConstBufferRing&  GetConstBufferRing()  { return cbRing_; }
+    inline TransientAllocator& GetTransientAllocator() { return transientAlloc_; }
+    inline CommandRecorder&  GetCommandRecorder()  { return commandRecorder_; }
+    inline StateCache&       GetStateCache()       { return stateCache_; }
+    inline GpuProfiler&      GetGpuProfiler()      { return gpuProfiler_; }
+
+    // the camera's view-proj for VS (slot b0): is rebound after passes which replace it
+    inline ID3D11Buffer*     GetConstBufferVSPerFrame() const { return cbvsPerFrame_.Get(); }
 
     inline void GetFogData(DirectX::XMFLOAT3& color, float& start, float& range, bool& enabled)
     {
@@ -151,19 +329,36 @@ public:
     void SetViewProj      (ID3D11DeviceContext* pContext, const DirectX::XMMATRIX& viewProj);
 
 private:
-    void UpdateLights(
-        const DirLight* dirLights,
-        const PointLight* pointLights,
-        const SpotLight* spotLights,
-        const int numDirLights,
-        const int numPointLights,
-        const int numSpotLights);
+    void UpdateLights(const DirLight* dirLights, const int numDirLights);
+    void InitShadersHotReload(ID3D11Device* pDevice);
 
 public:
     ID3D11DeviceContext*                       pContext_ = nullptr;
 
-    ID3D11Buffer*                              pInstancedBuffer_ = nullptr;
-    cvector<ConstBufType::InstancedData>          instancedData_;    // instances common buffer
+    InstanceRing                               instanceRing_;     // instances data of all the instanced passes
+    ConstBufferRing                            cbRing_;           // per-draw constants (bound by offsets)
+    TransientAllocator                         transientAlloc_;   // dynamic geometry of the frame
+
+    // table of all the materials (VS slot t0)
+    static constexpr UINT                      MATERIALS_TABLE_SLOT = 0;
+    ID3D11Buffer*                              pMaterialsBuffer_    = nullptr;
+    ID3D11ShaderResourceView*                  pMaterialsSRV_       = nullptr;
+    int                                        materialsCapacity_   = 0;
+
+    // layers of materials textures in the packed arrays (VS slot t1)
+    static constexpr UINT                      MATERIAL_TEX_LAYERS_SLOT = 1;
+    ID3D11Buffer*                              pTexLayersBuffer_    = nullptr;
+    ID3D11ShaderResourceView*                  pTexLayersSRV_       = nullptr;
+    int                                        texLayersCapacity_   = 0;
+
+    // packed diffuse and normal maps arrays (PS slots t28, t29)
+    static constexpr UINT                      MATERIAL_TEX_ARRS_SLOT = 28;
+    ID3D11ShaderResourceView*                  materialTexArrs_[2]  = { nullptr, nullptr };
+
+    // volumes of baked static lights (PS and CS slots t35..t37), aren't owned
+    static constexpr UINT                      STATIC_LIGHTS_SLOT   = 35;
+    static constexpr UINT                      NUM_STATIC_LIGHTS_SRVS = 3;
+    ID3D11ShaderResourceView*                  staticLightsSRVs_[NUM_STATIC_LIGHTS_SRVS] = { nullptr, nullptr, nullptr };
 
     // const buffers for vertex shaders
     ConstantBuffer<ConstBufType::cbvsPerFrame>    cbvsPerFrame_;     
@@ -182,8 +377,33 @@ public:
     RenderDataStorage dataStorage_;
     PerFrameData      perFrameData_;                              // we need to keep this data because we use it multiple times during the frame
     ShadersContainer  shadersContainer_;                          // a struct with shader classes objects
-
+    HiZBuffer         hiZBuffer_;                                 // hierarchical depth for occlusion culling
+    GpuCulling        gpuCulling_;                                // culling of the GPU-driven opaque pass
+    StaticBatches     staticBatches_;                             // persistent instance data of static entts
+    LightClusters     lightClusters_;                             // point/spot lights assigned to clusters of the view frustum
+    EntityIdBuffer    entityIdBuffer_;                            // GPU picking by entity IDs
+    DepthPrepass      depthPrepass_;                              // depth-only pass before the opaque and alpha clipped passes
+    GpuParticles      gpuParticles_;                              // particles which are simulated and sorted on GPU
+    GrassScatter      grassScatter_;                              // grass scattered over terrain patches on GPU
+    SkinnedCrowds     skinnedCrowds_;                             // instanced skinned models by animation textures
+    EditorGrid        editorGrid_;                                // the grid of the editor by a single draw
+    VirtualTexture    terrainVT_;                                 // the virtual texture map of terrain (is initialized by its owner when the terrain is loaded)
+    ShadowMaps        shadowMaps_;                                // cascaded shadow maps of the sun with cached static casters
+    DeferredShading   deferredShading_;                           // G-buffer + tiled lighting (an alternative to the forward light shader)
+    LowResBlending    lowResBlending_;                            // the offscreen pass of blended content with a lower resolution
+    PlanarReflection  planarReflection_;                          // the reflection by a single mirror plane
+    SkyFogLut         skyFogLut_;                                 // the sky color along view directions for the fog
+    ShaderHotReloader shaderHotReloader_;                         // background recompilation of changed shaders
+    CommandRecorder   commandRecorder_;                           // deferred contexts for multithreaded recording
+    StateCache        stateCache_;                                // filters redundant binds on the immediate context
+    GpuProfiler       gpuProfiler_;                               // GPU time of each pass by timestamp queries
+
+    float             clusterPixelScale_ = 1.0f;                  // see SetLightClustersPixelScale()
+    DirectX::XMFLOAT3 savedCameraPos_    = { 0,0,0 };             // see BeginReflectionLighting()
+    int               savedNumPointLights_ = 0;
+    int               savedNumSpotLights_  = 0;
     bool              isDebugMode_ = false;                       // do we use the debug shader?
+    bool              isShadersLoaded_ = false;                   // is LoadShaders() done?
 };
 
 }; // namespace Render
@@ -0,0 +1,190 @@
+// =================================================================================
+// Filename:     CommandRecorder.cpp
+// Description:  implementation of the CommandRecorder's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "CommandRecorder.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <cassert>
+
+
+namespace Render
+{
+
+//---------------------------------------------------------
+// Desc:   capture the current state of the context;
+//         NOTE: Get* methods increment ref counters of the objects
+//---------------------------------------------------------
+void PipelineState::Capture(ID3D11DeviceContext* pContext)
+{
+    Release();
+
+    pContext->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, pRTVs, &pDSV);
+
+    numViewports = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+    pContext->RSGetViewports(&numViewports, viewports);
+
+    pContext->RSGetState(&pRS);
+    pContext->OMGetBlendState(&pBS, blendFactor, &sampleMask);
+    pContext->OMGetDepthStencilState(&pDSS, &stencilRef);
+    pContext->IAGetPrimitiveTopology(&topology);
+
+    pContext->VSGetConstantBuffers(0, NUM_CB_SLOTS, vsCBs);
+    pContext->PSGetConstantBuffers(0, NUM_CB_SLOTS, psCBs);
+    pContext->VSGetShaderResources(0, NUM_SRV_SLOTS, vsSRVs);
+    pContext->PSGetShaderResources(0, NUM_SRV_SLOTS, psSRVs);
+    pContext->PSGetSamplers(0, NUM_SAMPLER_SLOTS, psSamplers);
+}
+
+///////////////////////////////////////////////////////////
+
+void PipelineState::Apply(ID3D11DeviceContext* pContext) const
+{
+    pContext->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, pRTVs, pDSV);
+    pContext->RSSetViewports(numViewports, viewports);
+
+    pContext->RSSetState(pRS);
+    pContext->OMSetBlendState(pBS, blendFactor, sampleMask);
+    pContext->OMSetDepthStencilState(pDSS, stencilRef);
+    pContext->IASetPrimitiveTopology(topology);
+
+    pContext->VSSetConstantBuffers(0, NUM_CB_SLOTS, vsCBs);
+    pContext->PSSetConstantBuffers(0, NUM_CB_SLOTS, psCBs);
+    pContext->VSSetShaderResources(0, NUM_SRV_SLOTS, vsSRVs);
+    pContext->PSSetShaderResources(0, NUM_SRV_SLOTS, psSRVs);
+    pContext->PSSetSamplers(0, NUM_SAMPLER_SLOTS, psSamplers);
+}
+
+///////////////////////////////////////////////////////////
+
+void PipelineState::Release()
+{
+    for (ID3D11RenderTargetView*& pRTV : pRTVs)
+        SafeRelease(&pRTV);
+
+    SafeRelease(&pDSV);
+    SafeRelease(&pRS);
+    SafeRelease(&pBS);
+    SafeRelease(&pDSS);
+
+    for (UINT i = 0; i < NUM_CB_SLOTS; ++i)
+    {
+        SafeRelease(&vsCBs[i]);
+        SafeRelease(&psCBs[i]);
+    }
+
+    for (UINT i = 0; i < NUM_SRV_SLOTS; ++i)
+    {
+        SafeRelease(&vsSRVs[i]);
+        SafeRelease(&psSRVs[i]);
+    }
+
+    for (ID3D11SamplerState*& pSampler : psSamplers)
+        SafeRelease(&pSampler);
+}
+
+
+// =================================================================================
+// CommandRecorder
+// =================================================================================
+CommandRecorder::~CommandRecorder()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool CommandRecorder::Initialize(ID3D11Device* pDevice, const int numContexts)
+{
+    try
+    {
+        CAssert::True(numContexts > 0, "the number of deferred contexts must be > 0");
+
+        const int num = (numContexts < MAX_NUM_CONTEXTS) ? numContexts : MAX_NUM_CONTEXTS;
+
+        for (int i = 0; i < num; ++i)
+        {
+            const HRESULT hr = pDevice->CreateDeferredContext(0, &pContexts_[i]);
+            CAssert::NotFailed(hr, "can't create a deferred context");
+        }
+
+        numContexts_ = num;
+
+        // without driver command lists the runtime emulates them (so there is
+        // no reason to record on several threads but it still works)
+        D3D11_FEATURE_DATA_THREADING threading = { FALSE, FALSE };
+        pDevice->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading));
+
+        if (!threading.DriverCommandLists)
+            LogMsgf("%sdriver command lists aren't supported: they will be emulated", YELLOW);
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the command recorder");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void CommandRecorder::Shutdown()
+{
+    for (int i = 0; i < MAX_NUM_CONTEXTS; ++i)
+    {
+        SafeRelease(&pCommandLists_[i]);
+        SafeRelease(&pContexts_[i]);
+    }
+
+    numContexts_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+ID3D11DeviceContext* CommandRecorder::BeginRecording(
+    const int ctxIdx,
+    const PipelineState& state)
+{
+    assert(ctxIdx >= 0 && ctxIdx < numContexts_);
+
+    ID3D11DeviceContext* pContext = pContexts_[ctxIdx];
+    state.Apply(pContext);
+
+    return pContext;
+}
+
+///////////////////////////////////////////////////////////
+
+void CommandRecorder::EndRecording(const int ctxIdx)
+{
+    assert(ctxIdx >= 0 && ctxIdx < numContexts_);
+
+    // FALSE: the deferred context is reset to a default state after the list is done
+    SafeRelease(&pCommandLists_[ctxIdx]);
+    const HRESULT hr = pContexts_[ctxIdx]->FinishCommandList(FALSE, &pCommandLists_[ctxIdx]);
+
+    if (FAILED(hr))
+        LogErr("can't finish a command list");
+}
+
+///////////////////////////////////////////////////////////
+
+void CommandRecorder::Execute(ID3D11DeviceContext* pImmediateContext, const int ctxIdx)
+{
+    assert(ctxIdx >= 0 && ctxIdx < numContexts_);
+
+    if (!pCommandLists_[ctxIdx])
+        return;
+
+    // TRUE: keep the state of the immediate context for the next (not recorded) passes
+    pImmediateContext->ExecuteCommandList(pCommandLists_[ctxIdx], TRUE);
+    SafeRelease(&pCommandLists_[ctxIdx]);
+}
+
+} // namespace Render
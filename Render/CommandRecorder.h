@@ -0,0 +1,100 @@
+// =================================================================================
+// Filename:     CommandRecorder.h
+// Description:  a set of deferred contexts for recording draw calls on worker
+//               threads; the recorded command lists are replayed in order
+//               on the immediate context:
+//
+//               - a deferred context starts with a default pipeline state so
+//                 before recording we apply the state captured from the
+//                 immediate context (targets, viewport, states, const buffers,
+//                 shader resources, samplers);
+//               - all the uploads (instances, const buffers) are supposed to be
+//                 done on the immediate context before recording so deferred
+//                 contexts only bind and draw
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+// a snapshot of the pipeline state which is used by the instanced passes
+struct PipelineState
+{
+    static constexpr UINT NUM_CB_SLOTS      = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+    static constexpr UINT NUM_SRV_SLOTS     = 32;           // we don't bind resources into higher slots
+    static constexpr UINT NUM_SAMPLER_SLOTS = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+
+    PipelineState() {}
+    ~PipelineState() { Release(); }
+
+    // restrict a copying of this struct instance (it holds references)
+    PipelineState(const PipelineState&) = delete;
+    PipelineState& operator=(const PipelineState&) = delete;
+
+    void Capture(ID3D11DeviceContext* pContext);
+    void Apply  (ID3D11DeviceContext* pContext) const;
+    void Release();
+
+    ID3D11RenderTargetView*     pRTVs[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = { nullptr };
+    ID3D11DepthStencilView*     pDSV = nullptr;
+    D3D11_VIEWPORT              viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+    UINT                        numViewports = 0;
+
+    ID3D11RasterizerState*      pRS  = nullptr;
+    ID3D11BlendState*           pBS  = nullptr;
+    ID3D11DepthStencilState*    pDSS = nullptr;
+    float                       blendFactor[4] = { 0,0,0,0 };
+    UINT                        sampleMask = 0xffffffff;
+    UINT                        stencilRef = 0;
+
+    D3D11_PRIMITIVE_TOPOLOGY    topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+    ID3D11Buffer*               vsCBs[NUM_CB_SLOTS] = { nullptr };
+    ID3D11Buffer*               psCBs[NUM_CB_SLOTS] = { nullptr };
+    ID3D11ShaderResourceView*   vsSRVs[NUM_SRV_SLOTS] = { nullptr };
+    ID3D11ShaderResourceView*   psSRVs[NUM_SRV_SLOTS] = { nullptr };
+    ID3D11SamplerState*         psSamplers[NUM_SAMPLER_SLOTS] = { nullptr };
+};
+
+///////////////////////////////////////////////////////////
+
+class CommandRecorder
+{
+public:
+    static constexpr int MAX_NUM_CONTEXTS = 8;
+
+    CommandRecorder() {}
+    ~CommandRecorder();
+
+    // restrict a copying of this class instance
+    CommandRecorder(const CommandRecorder&) = delete;
+    CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+    bool Initialize(ID3D11Device* pDevice, const int numContexts);
+    void Shutdown();
+
+    // get a deferred context with the applied state for recording;
+    // NOTE: each context must be used by only one thread at the moment
+    ID3D11DeviceContext* BeginRecording(const int ctxIdx, const PipelineState& state);
+    void                 EndRecording  (const int ctxIdx);
+
+    // replay the recorded list on the immediate context (its state is kept)
+    // and release the list
+    void Execute(ID3D11DeviceContext* pImmediateContext, const int ctxIdx);
+
+    inline int  GetNumContexts() const { return numContexts_; }
+    inline bool IsInitialized()  const { return numContexts_ > 0; }
+
+private:
+    ID3D11DeviceContext* pContexts_[MAX_NUM_CONTEXTS]     = { nullptr };
+    ID3D11CommandList*   pCommandLists_[MAX_NUM_CONTEXTS] = { nullptr };
+    int                  numContexts_ = 0;
+};
+
+} // namespace Render
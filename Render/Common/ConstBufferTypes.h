@@ -13,14 +13,65 @@ namespace Render
 
 namespace ConstBufType
 {
+    // a compact record of the per-instance vertex stream (96 bytes instead of
+    // 3 full matrices): normals are transformed by the world's 3x3 in shaders
+    // (it is exact for uniform scale so the inverse transpose isn't needed)
     struct InstancedData
     {
-        DirectX::XMMATRIX  world;
-        DirectX::XMMATRIX  worldInvTranspose;
-        DirectX::XMMATRIX  texTransform;
-        Material           material;
+        DirectX::XMFLOAT4  world[3];         // columns of the world matrix (a transposed 3x4)
+        DirectX::XMFLOAT4  texTransform[2];  // a 2x3 affine matrix or params of a texture animation
+        uint32_t           materialIdx;      // idx into the materials table (structured buffer)
+        uint32_t           enttID;           // is used only by the entity IDs (picking) pass
+        uint32_t           padding[2];       // the culling shader copies records by 16 bytes
     };
 
+    static_assert(sizeof(InstancedData) == 96, "InstancedData must be the same as INSTANCE_SIZE of GpuCullCS.hlsl");
+
+    //---------------------------------------------------------
+    // Desc:  write all the fields of a record at once (the instances ring is
+    //        write-combined memory so it must be filled sequentially)
+    // Args:  - texTransform: a usual affine matrix (only its 2D part is kept)
+    //                        or packed animation params (a tag in [0].w)
+    //---------------------------------------------------------
+    inline void PackInstance(
+        InstancedData& out,
+        const DirectX::XMMATRIX& world,
+        const DirectX::XMMATRIX& texTransform,
+        const uint32_t materialIdx,
+        const uint32_t enttID)
+    {
+        using namespace DirectX;
+
+        const XMMATRIX worldT = XMMatrixTranspose(world);
+        XMFLOAT4X4 tex;
+        XMStoreFloat4x4(&tex, texTransform);
+
+        InstancedData rec;
+        XMStoreFloat4(&rec.world[0], worldT.r[0]);
+        XMStoreFloat4(&rec.world[1], worldT.r[1]);
+        XMStoreFloat4(&rec.world[2], worldT.r[2]);
+
+        // packed animation: its params are passed as is
+        if (tex._14 != 0.0f)
+        {
+            rec.texTransform[0] = { tex._11, tex._12, tex._13, tex._14 };
+            rec.texTransform[1] = { tex._21, tex._22, tex._23, tex._24 };
+        }
+        // uv' = (u, v, 1) * 2x3 (the translation is in the 4th row of the matrix)
+        else
+        {
+            rec.texTransform[0] = { tex._11, tex._21, tex._41, 0.0f };
+            rec.texTransform[1] = { tex._12, tex._22, tex._42, 0.0f };
+        }
+
+        rec.materialIdx = materialIdx;
+        rec.enttID      = enttID;
+        rec.padding[0]  = 0;
+        rec.padding[1]  = 0;
+
+        out = rec;
+    }
+
     __declspec(align(16)) struct InstancedDataBillboards
     {
         Material material;
@@ -28,12 +79,29 @@ namespace ConstBufType
         DirectX::XMFLOAT2 size;        // billboard size
     };
 
+    struct InstancedDataImpostor
+    {
+        DirectX::XMFLOAT3 centerW;     // center of the impostor quad in world
+        DirectX::XMFLOAT2 size;        // width and height of the quad (in world units)
+        DirectX::XMFLOAT2 forwardXZ;   // xz of the model's +Z axis in world (normalized)
+    };
+
+    struct cbgsImpostorAtlas
+    {
+        float numViews = 0;            // views around the Y axis which are baked into the atlas
+        float numCols  = 0;            // the atlas grid
+        float numRows  = 0;
+        float padding  = 0;
+    };
+
     // ----------------------------------------------------
 
     struct cbvsPerFrame
     {
         // a structure for vertex shader data which is changed each frame
         DirectX::XMMATRIX  viewProj;
+        float              gameTime = 0;       // is used to evaluate texture animations in the VS
+        DirectX::XMFLOAT3  padding;
     };
 
     // TEMP: for billboard shader
@@ -62,13 +130,25 @@ namespace ConstBufType
     struct cbpsPerFrame
     {
         // a structure for pixel shader data which is changed each frame
+        // (point/spot lights are in structured buffers, see LightClusters)
 
         DirLight           dirLights[3];
-        PointLight         pointLights[25];
-        SpotLight          spotLights[25];
         DirectX::XMFLOAT3  cameraPos;
         int                currNumPointLights = 0;
         int                currNumSpotLights = 0;
+
+        // params of the light clusters grid
+        uint32_t           clusterDims[3] = { 1,1,1 };   // number of clusters by x, y, z
+        float              clusterScaleX = 0;            // screen pixel => cluster x
+        float              clusterScaleY = 0;            // screen pixel => cluster y
+        float              clusterSliceScale = 0;        // view depth => cluster z: log(z) * scale + bias
+        float              clusterSliceBias = 0;
+
+        // the volume of baked static lights (see CRender::SetStaticLights)
+        DirectX::XMFLOAT3  staticLightsMin = { 0,0,0 };
+        int                hasStaticLights = 0;
+        DirectX::XMFLOAT3  staticLightsInvSize = { 0,0,0 };  // 1 / (max - min)
+        float              staticLightsNormalBias = 0;
     };
 
     // ----------------------------------------------------
@@ -146,6 +226,246 @@ namespace ConstBufType
         DirectX::XMFLOAT2 topRight;      // 1 1
         DirectX::XMFLOAT2 bottomRight;   // 1 0
     };
+
+
+    // =======================================================
+    // const buffers for COMPUTE shaders
+    // =======================================================
+    struct cbcsHiZBuild
+    {
+        uint32_t srcSize[2];             // width/height of the source level
+        uint32_t dstSize[2];             // width/height of the destination level
+        uint32_t numSamples;             // > 1 only if the source is the multisampled depth buffer
+        uint32_t padding[3];
+    };
+
+    struct cbcsGpuCull
+    {
+        DirectX::XMFLOAT4 planes[6];         // world frustum planes (normals look inside)
+        DirectX::XMMATRIX hiZViewProj;       // viewProj of the frame the Hi-Z was built from (transposed)
+        DirectX::XMFLOAT3 cameraPos;
+        uint32_t          numInstances;      // the number of instance records to cull
+        DirectX::XMFLOAT4 lodScreenSizesSq;  // squares of screen sizes where LOD i+1 starts (xyz)
+        float             projScaleYSq;      // (proj[1][1] * 0.5)^2
+        uint32_t          hiZNumLevels;      // 0: occlusion test is disabled
+        uint32_t          depthSize[2];      // size of the depth buffer the Hi-Z was built from
+    };
+
+    struct cbcsStaticGather
+    {
+        uint32_t numIdxs;                    // the number of records to copy
+        uint32_t padding[3];
+    };
+
+    struct cbcsParticleSort
+    {
+        uint32_t k;                          // the size of bitonic sequences which are merged (0: sort each block from scratch)
+        uint32_t j;                          // the distance btw compared elements (for the global step)
+        uint32_t padding[2];
+    };
+
+    // =======================================================
+    // const buffer for GPU particles (is bound to CS, VS and PS)
+    // =======================================================
+    struct cbParticles
+    {
+        DirectX::XMMATRIX view;              // transposed
+        DirectX::XMMATRIX proj;              // transposed
+        DirectX::XMFLOAT3 cameraPos;
+        float             deltaTime;
+        DirectX::XMFLOAT3 cameraForward;     // particles are sorted by the view depth along it
+        uint32_t          frameIdx;          // a seed of random numbers
+        uint32_t          numSpawns;         // particles to spawn in this frame (by all the emitters)
+        uint32_t          numEmitters;
+        float             nearZ;             // to linearize the scene depth
+        float             farZ;
+        float             invSoftDistance;   // 1 / distance of the soft particles fade
+        uint32_t          softParticles;     // the scene depth is bound to the PS
+        uint32_t          padding[2];
+    };
+
+    // =======================================================
+    // const buffer for the scattered grass (is bound to CS, VS and PS)
+    // =======================================================
+    struct cbGrass
+    {
+        DirectX::XMMATRIX viewProj;          // transposed
+        DirectX::XMFLOAT4 planes[6];         // world frustum planes (normals look inside)
+        DirectX::XMFLOAT3 cameraPos;
+        float             time;              // for the wind
+        DirectX::XMFLOAT2 origin;            // position of the height map's (0,0) in world
+        float             heightScale;       // a sample of the height map [0,1] => height in world
+        float             texelSize;         // 1 / size of the height map
+        float             cellSize;          // a single instance can be placed per cell
+        uint32_t          cellsPerSide;      // of a patch (a multiple of the group size)
+        float             maxDistance;       // no grass further
+        float             fadeStart;         // the density goes down to zero from here to the max distance
+        float             minSlopeCos;       // no grass on slopes steeper than this (by the normal's Y)
+        float             bladeHeight;
+        float             bladeWidth;
+        float             windStrength;
+        DirectX::XMFLOAT3 fogColor;
+        float             fogStart;
+        float             fogRange;
+        uint32_t          hasTextureMap;     // the density and the color come from the terrain texture map
+        uint32_t          hasLightmap;
+        uint32_t          padding;
+    };
+
+    // =======================================================
+    // const buffer for the procedural editor grid (is bound to VS and PS)
+    // =======================================================
+    struct cbEditorGrid
+    {
+        DirectX::XMMATRIX viewProj;          // transposed
+        DirectX::XMFLOAT3 cameraPos;
+        float             cellSize;          // distance btw minor lines
+        float             majorCellSize;     // distance btw major lines
+        float             fadeDistance;      // the grid fades out till this distance (the half size of the plane)
+        float             height;            // Y of the ground plane
+        float             lineWidth;         // in pixels
+    };
+
+    // =======================================================
+    // const buffer for the cascaded shadow maps (is bound to PS of lit geometry)
+    // =======================================================
+    struct cbShadows
+    {
+        DirectX::XMMATRIX transforms[4];     // world => texture space of each cascade (transposed)
+        DirectX::XMFLOAT4 splits;            // the far view depth of each cascade (unused ones are FLT_MAX)
+        float             texelSize;         // 1 / size of the shadow map
+        float             depthBias;
+        int               numCascades;       // 0: no shadows
+        float             fadeStart;         // shadows fade out till the far split of the last cascade
+    };
+
+    // =======================================================
+    // const buffer for the deferred lighting (is bound to CS)
+    // =======================================================
+    struct cbDeferred
+    {
+        DirectX::XMMATRIX invViewProj;       // clip => world space (transposed)
+        DirectX::XMFLOAT4 viewDepth;         // the 3rd column of the view matrix: dot(posW, viewDepth) == view depth
+        uint32_t          width;             // the rendered part of the G-buffer (in pixels)
+        uint32_t          height;
+        float             invWidth;
+        float             invHeight;
+    };
+
+    // =======================================================
+    // const buffer for building of the sky fog LUT (is bound to CS)
+    // =======================================================
+    struct cbSkyFog
+    {
+        uint32_t          lutSize;
+        float             invLutSize;
+        float             padding[2];
+    };
+
+    // =======================================================
+    // const buffers for the entity IDs (picking) pass
+    // =======================================================
+    struct cbEntityIds
+    {
+        // is bound to both VS and PS
+        DirectX::XMMATRIX viewProj;      // is narrowed to the picked pixel
+        uint32_t          alphaClipping; // clip transparent pixels (foliage, fences, etc.)
+        uint32_t          padding[3];
+    };
+
+    // =======================================================
+    // const buffers for the upscale (dynamic resolution / FXAA) pass
+    // =======================================================
+    struct cbpsUpscale
+    {
+        DirectX::XMFLOAT2 uvScale;       // the rendered part of the scene texture
+        DirectX::XMFLOAT2 uvMax;         // the center of the last rendered texel (so we don't filter texels out of the part)
+        DirectX::XMFLOAT2 texelSize;     // 1 / size of the scene texture
+        DirectX::XMFLOAT2 padding;
+    };
+
+    // =======================================================
+    // const buffers for the tessellated terrain (is bound to both HS and DS)
+    // =======================================================
+    struct cbTerrainTess
+    {
+        DirectX::XMMATRIX viewProj;              // transposed
+        DirectX::XMFLOAT4 planes[6];             // world frustum planes (normals look inside)
+        DirectX::XMFLOAT3 eyePosW;
+        float             screenScale = 0;       // proj[1][1] * 0.5 * viewport height: world size * screenScale / w => pixels
+        float             targetEdgePixels = 16; // desired screen-space length of a tessellated edge
+        float             maxTessFactor = 64;
+        float             heightScale = 1;       // a sample of the height map [0,1] => height in world
+        float             texelSize = 0;         // 1 / size of the height map (in texels)
+    };
+
+    // =======================================================
+    // const buffer for the terrain rendered by vertex pulling (is bound to VS)
+    // =======================================================
+    struct cbvsTerrainGrid
+    {
+        DirectX::XMFLOAT2 origin;                // position of the height map's (0,0) in world
+        float             gridStep = 1;          // distance btw grid vertices (a texel of the height map is 1 unit)
+        float             heightScale = 1;       // a sample of the height map [0,1] => height in world
+        float             texelSize = 0;         // 1 / size of the height map (in texels)
+        uint32_t          cellsPerPatch = 16;    // grid cells per side of a patch (for geomorphing of its sides)
+        float             padding[2];
+    };
+
+    // =======================================================
+    // const buffer for heatmaps of the terrain (is bound to PS; see eDebugState)
+    // =======================================================
+    struct cbpsTerrainDebug
+    {
+        int32_t           debugType = 0;         // 0 - the heatmaps are off
+        uint32_t          patchLod  = 0;         // of the current draw
+        uint32_t          patchNum  = 0;
+        float             triArea   = 0;         // area of a triangle of the current draw (by the XZ plane)
+    };
+
+    // =======================================================
+    // const buffer for the virtual texture of terrain (is bound to PS)
+    // =======================================================
+    struct cbVirtualTexture
+    {
+        float             virtualSize  = 0;      // texels per side at mip 0
+        float             pageSize     = 0;      // texels per side of a page (without borders)
+        float             border       = 0;      // texels on each side of a page in the cache
+        float             cacheSize    = 0;      // texels per side of the page cache
+        uint32_t          numMips      = 0;
+        uint32_t          pagesPerSide = 0;      // at mip 0
+        uint32_t          frame        = 0;      // a stamp of pages which are requested in this frame
+        uint32_t          enabled      = 0;
+        uint32_t          mipOffsets[16];        // the first entry of each mip in the feedback buffer (as uint4[4] in HLSL)
+    };
+
+    // =======================================================
+    // const buffer for the low resolution blending (is bound to PS)
+    // =======================================================
+    struct cbLowResBlend
+    {
+        uint32_t          factor       = 2;      // full resolution pixels per low resolution one (by each axis)
+        uint32_t          padding0     = 0;
+        uint32_t          fullMaxX     = 0;      // the last pixel of the rendered part of the scene depth
+        uint32_t          fullMaxY     = 0;
+        uint32_t          lowMaxX      = 0;      // the last pixel of the rendered part of low resolution targets
+        uint32_t          lowMaxY      = 0;
+        float             projA        = 0;      // view depth == projB / (depth - projA)
+        float             projB        = 0;
+        float             depthThreshold = 0.1f; // relative difference of view depths which is an edge
+        float             padding1[3]{ 0 };
+    };
+
+    // =======================================================
+    // const buffer for the composite of the planar reflection (is bound to PS)
+    // =======================================================
+    struct cbPlanarReflection
+    {
+        float             invSceneWidth  = 0;    // pixel => uv of the reflection
+        float             invSceneHeight = 0;
+        float             strength       = 0.5f; // how much of the reflection is blended over the mirror
+        float             padding        = 0;
+    };
 };
 
 
@@ -2,6 +2,9 @@
 // Filename:      InputLayouts.h
 // Description:   definitions of different input layouts for vertex shaders
 //
+//                NOTE: vertices of models and terrain are packed (see Core/Mesh/VertexPacked.h):
+//                half-float (or unorm16) UVs, 10:10:10:2 normals/tangents, unorm8 colors
+//
 // Created:       11.05.2025
 // =================================================================================
 #pragma once
@@ -16,34 +19,23 @@ namespace Render
 // --------------------------------------------------------
 struct InputLayoutLight
 {
-    const D3D11_INPUT_ELEMENT_DESC desc[20] =
+    const D3D11_INPUT_ELEMENT_DESC desc[10] =
     {
         // per vertex data
-        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"NORMAL",   0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TANGENT",  0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
 
         // per instance data
         {"WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,  D3D11_INPUT_PER_INSTANCE_DATA, 1},
         {"WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
         {"WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-
-        {"WORLD_INV_TRANSPOSE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD_INV_TRANSPOSE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD_INV_TRANSPOSE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD_INV_TRANSPOSE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 112, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-
-        {"TEX_TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 128, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"TEX_TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 144, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"TEX_TRANSFORM", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 160, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"TEX_TRANSFORM", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 176, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-
-        {"MATERIAL", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"MATERIAL", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"MATERIAL", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"MATERIAL", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+
+        {"TEX_TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"TEX_TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+
+        {"MATERIAL_IDX", 0, DXGI_FORMAT_R32_UINT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1},
     };
 
     const UINT numElem = sizeof(desc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
@@ -58,11 +50,52 @@ struct InputLayoutTerrain
     const D3D11_INPUT_ELEMENT_DESC desc[5] =
     {
         // per vertex data
-        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0}
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"NORMAL",   0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TANGENT",  0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM,     0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0}
+    };
+
+    const UINT numElems = sizeof(desc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
+};
+
+
+// --------------------------------------------------------
+// input vertex layout for the tessellated terrain: control points
+// of the coarse patches grid (corners of each patch)
+// --------------------------------------------------------
+struct InputLayoutTerrainPatch
+{
+    const D3D11_INPUT_ELEMENT_DESC desc[2] =
+    {
+        // per vertex data
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"BOUNDS",   0, DXGI_FORMAT_R32G32_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    };
+
+    const UINT numElems = sizeof(desc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
+};
+
+
+// --------------------------------------------------------
+// input vertex layout for the terrain rendered by vertex pulling:
+// a vertex of the grid shared by all the patches and (per instance)
+// the first grid vertex of the patch and its geomorphing (Core::GeomPatchMorph;
+// if there is no buffer in the slot 2 the morphs are zeros)
+// --------------------------------------------------------
+struct InputLayoutTerrainGrid
+{
+    const D3D11_INPUT_ELEMENT_DESC desc[5] =
+    {
+        // per vertex data
+        {"POSITION", 0, DXGI_FORMAT_R16G16_UINT,        0,                            0, D3D11_INPUT_PER_VERTEX_DATA,   0},
+
+        // per instance data
+        {"PATCH",    0, DXGI_FORMAT_R16G16_UINT,        1,                            0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"MORPH",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 2,                            0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"MORPH",    1, DXGI_FORMAT_R32_FLOAT,          2, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"LOD",      0, DXGI_FORMAT_R32G32_UINT,        2, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
     };
 
     const UINT numElems = sizeof(desc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
@@ -77,14 +110,94 @@ struct InputLayoutMaterialIcon
     const D3D11_INPUT_ELEMENT_DESC desc[4] =
     {
         // per vertex data
-        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"NORMAL",   0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TANGENT",  0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    };
+
+    const UINT numElem = sizeof(desc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
+
+};
+
+
+// --------------------------------------------------------
+// input vertex layout for the depth pre-pass of opaque geometry
+// (position only; instances data is the same as for the light shader)
+// --------------------------------------------------------
+struct InputLayoutDepthPrepass
+{
+    const D3D11_INPUT_ELEMENT_DESC desc[4] =
+    {
+        // per vertex data
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+
+        // per instance data
+        {"WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,  D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
     };
 
     const UINT numElem = sizeof(desc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
+};
+
+
+// --------------------------------------------------------
+// input vertex layout for the depth pre-pass of alpha clipped geometry
+// --------------------------------------------------------
+struct InputLayoutDepthPrepassAlphaClip
+{
+    const D3D11_INPUT_ELEMENT_DESC desc[8] =
+    {
+        // per vertex data
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+
+        // per instance data
+        {"WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,  D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
 
+        {"TEX_TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"TEX_TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+
+        {"MATERIAL_IDX", 0, DXGI_FORMAT_R32_UINT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+    };
+
+    const UINT numElem = sizeof(desc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
+};
+
+
+// --------------------------------------------------------
+// input vertex layout for skinned crowds: vertices of the model,
+// their skin weights (a separate stream) and per instance data
+// with frames of the animation texture to blend
+// --------------------------------------------------------
+struct InputLayoutSkinned
+{
+    const D3D11_INPUT_ELEMENT_DESC desc[12] =
+    {
+        // per vertex data
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"NORMAL",   0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TANGENT",  0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+
+        // per vertex skin (see Core/Model/SkinnedData.h)
+        {"BONE_IDXS",    0, DXGI_FORMAT_R8G8B8A8_UINT,  1, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"BONE_WEIGHTS", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 1, 4, D3D11_INPUT_PER_VERTEX_DATA, 0},
+
+        // per instance data
+        {"WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 2, 0,  D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 2, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 2, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+
+        {"MATERIAL_IDX", 0, DXGI_FORMAT_R32_UINT,     2, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"ANIM_FRAMES",  0, DXGI_FORMAT_R32G32_UINT,  2, 52, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"ANIM_LERP",    0, DXGI_FORMAT_R32_FLOAT,    2, 60, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+    };
+
+    const UINT numElem = sizeof(desc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
 };
 
 } // namespace Render
@@ -33,6 +33,16 @@ struct Material
 
 ///////////////////////////////////////////////////////////
 
+struct MaterialTexLayers
+{
+	// layers of the material textures in the packed texture arrays
+	// (-1: the texture isn't packed so it's bound separately)
+	int diffuse = -1;
+	int normal  = -1;
+};
+
+///////////////////////////////////////////////////////////
+
 struct DirLight
 {
 	DirLight() {}
@@ -31,6 +31,25 @@ constexpr int SUBSET_NAME_LENGTH_LIMIT = 32;
 // =================================================================================
 using SRV = ID3D11ShaderResourceView;
 
+// flags of subset textures which are sampled from the packed texture arrays
+// (by layers from the materials table) so they don't need separate binds
+enum ePackedTex : uint8
+{
+    PACKED_TEX_DIFFUSE = (1 << 0),
+    PACKED_TEX_NORMAL  = (1 << 1),
+};
+
+// idxs of these maps in textures of each subset (the same as in LightPS.hlsl)
+constexpr int PACKED_DIFFUSE_TEX_IDX = 1;
+constexpr int PACKED_NORMAL_TEX_IDX  = 6;
+
+// flags of features which a subset material really has (a pixel shader
+// variant is chosen by them so missing maps aren't sampled at all)
+enum eSubsetFeature : uint8
+{
+    SUBSET_NORMAL_MAP = (1 << 0),
+};
+
 
 // =================================================================================
 // ENUMS
@@ -48,6 +67,13 @@ enum eDebugState
     DBG_SHOW_ONLY_DIFFUSE_MAP,
     DBG_SHOW_ONLY_NORMAL_MAP,
     DBG_WIREFRAME,
+
+    // performance heatmaps
+    DBG_SHOW_OVERDRAW,          // an additive counter of shaded fragments (without the depth test)
+    DBG_SHOW_LOD,               // LOD of each entity and terrain patch
+    DBG_SHOW_LIGHT_COUNT,       // point/spot lights of the pixel's cluster
+    DBG_SHOW_TRIANGLE_DENSITY,  // triangles per pixel
+    DBG_SHOW_BATCHES,           // a color per draw call (instanced batch)
 };
 
 enum EnttsSetType
@@ -68,8 +94,11 @@ struct PerFrameData
 
     // common data
     DirectX::XMMATRIX WVO;                       // is used for 2D rendering (world * basic_view * ortho)
-    DirectX::XMMATRIX proj;
+    DirectX::XMMATRIX view;                      // (NOT transposed)
+    DirectX::XMMATRIX proj;                      // (NOT transposed)
     DirectX::XMMATRIX viewProj;                  // (is already transposed)
+    float             screenWidth  = 1;          // size of the render target (for light clusters)
+    float             screenHeight = 1;
     DirectX::XMFLOAT3 cameraPos;
     DirectX::XMFLOAT3 cameraDir;
 
@@ -81,6 +110,15 @@ struct PerFrameData
     int               numPointLights = 0;
     int               numSpotLights  = 0;
 
+    // the GPU keeps a resident copy of all point lights (by their idxs in the
+    // light system) so pointLights above are only visible ones to assign them
+    // to clusters, and the copy is patched only by changed lights
+    const uint32*     visPointLightIdxs      = nullptr;  // resident idx of each visible point light (null: not resident)
+    const PointLight* pointLightPatches      = nullptr;  // changed lights
+    const uint32*     pointLightPatchIdxs    = nullptr;  // their resident idxs (sorted)
+    int               numPointLightPatches   = 0;
+    int               numResidentPointLights = 0;        // the number of all point lights
+
     float             deltaTime      = 0;        // time passed since the previous frame
     float             totalGameTime  = 0;        // time passed since the start of the application
 
@@ -140,7 +178,8 @@ public:
     {
         SafeDeleteArr(worlds_);
         SafeDeleteArr(texTransforms_);
-        SafeDeleteArr(materials_);
+        SafeDeleteArr(materialIdxs_);
+        SafeDeleteArr(enttIds_);
         capacity_ = 0;
         size_ = 0;
     }
@@ -165,7 +204,8 @@ public:
 
                 worlds_             = new DirectX::XMMATRIX[newSize];
                 texTransforms_      = new DirectX::XMMATRIX[newSize];
-                materials_          = new Material[newSize];
+                materialIdxs_       = new uint32_t[newSize];
+                enttIds_            = new uint32_t[newSize]{ 0 };
                 capacity_           = newSize;	
             }
 
@@ -193,7 +233,8 @@ public:
 public:
     DirectX::XMMATRIX* worlds_ = nullptr;
     DirectX::XMMATRIX* texTransforms_ = nullptr;
-    Material*          materials_ = nullptr;
+    uint32_t*          materialIdxs_ = nullptr;      // idxs into the materials table
+    uint32_t*          enttIds_ = nullptr;           // for the entity IDs (picking) pass
 
 private:
     int                capacity_ = 0;   // how many elements we can put into this buffer
@@ -224,19 +265,25 @@ struct Instance
     char                name[32]{ '\0' };
     int                 numInstances = 0;  // how many instances will be rendered
     UINT                vertexStride = 0;  // size in bytes of a single vertex
+    float               depth = 0;         // distance from the camera to the nearest entt (for sorting of draws)
+    uint8               lod   = 0;         // LOD of the subsets' index ranges (for the debug heatmap)
 
     ID3D11Buffer*       pVB = nullptr;     // vertex buffer
     ID3D11Buffer*       pIB = nullptr;     // index buffer
+    DXGI_FORMAT         indexFormat = DXGI_FORMAT_R32_UINT;  // 16-bit indices for small geometry
     cvector<SRV*>       texSRVs;           // textures arr for each mesh
     cvector<Subset>     subsets;           // subInstance (mesh) data
     cvector<uint32_t>   materialIDs;
+    cvector<uint8>      packedTexs;        // ePackedTex flags per subset (can be empty: nothing is packed)
+    cvector<uint8>      features;          // eSubsetFeature flags per subset (can be empty: all the features)
     
 
     // --------------------------------
 
     inline int GetNumVertices() const
     {
-        return subsets.back().vertexStart + subsets.back().vertexCount;
+        // subsets can be offset in the shared buffers so count from the first one
+        return subsets.back().vertexStart + subsets.back().vertexCount - subsets[0].vertexStart;
     }
 
     // --------------------------------
@@ -248,6 +295,8 @@ struct Instance
         texSRVs.clear();
         subsets.clear();
         materialIDs.clear();
+        packedTexs.clear();
+        features.clear();
     }
 };
 
@@ -279,6 +328,31 @@ struct TerrainInstance
     SRV*          skyBoxTexture = nullptr;
     SRV*          textures[NUM_TEXTURE_TYPES]{nullptr};
     Material      material;
+
+    // draw list of visible patches (SoA): a range of the index buffer
+    // and an offset to the patch's first vertex in the vertex buffer
+    const UINT*   patchStartIndices = nullptr;
+    const UINT*   patchIndexCounts  = nullptr;
+    const int*    patchBaseVertices = nullptr;
+    const UINT*   patchNumbers      = nullptr;  // instance of each draw (vertex pulling only)
+    UINT          numPatches = 0;
+
+    SRV*          heightMap = nullptr;          // displacement of the tessellated terrain (and of vertex pulling)
+
+    // vertex pulling: pVB/pIB are the grid of a single patch and pPatchStartsVB
+    // is the first grid vertex of each patch (per instance)
+    ID3D11Buffer* pPatchStartsVB = nullptr;
+
+    // vertex pulling: geomorphing of each patch (per instance; nullptr - no morphing)
+    ID3D11Buffer* pPatchMorphsVB   = nullptr;
+    UINT          patchMorphStride = 0;
+
+    // performance heatmaps (see eDebugState): LOD of each patch and
+    // the area of a triangle of a LOD 0 patch (is doubled by each LOD per side)
+    const UINT*   patchLods    = nullptr;
+    int           debugType    = 0;
+    float         triAreaLod0  = 0;
+
     bool          wantDebug = false;
 };
 
@@ -293,18 +367,23 @@ struct RenderDataStorage
         modelInstances.clear();
         alphaClippedModelInstances.clear();
         blendedModelInstances.clear();
-        boundingLineBoxInstances.clear();
+        staticModelInstances.clear();
+        staticRecordIdxs.clear();
     }
 
     InstBuffData          modelInstBuffer;
     InstBuffData          alphaClippedModelInstBuffer;
     InstBuffData          blendedModelInstBuffer;
-    InstBuffData          boundingLineBoxBuffer;
 
     cvector<Instance> modelInstances;              // models with default render states
     cvector<Instance> alphaClippedModelInstances;
     cvector<Instance> blendedModelInstances;
-    cvector<Instance> boundingLineBoxInstances;
+
+    // visible static entts (default render states): their instances start from
+    // instance 0 of the visible buffer of static batches which is gathered by
+    // indices of records of static batches (see StaticBatches)
+    cvector<Instance> staticModelInstances;
+    cvector<uint32>   staticRecordIdxs;
 };
 
 ///////////////////////////////////////////////////////////
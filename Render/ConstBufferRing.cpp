@@ -0,0 +1,220 @@
+// =================================================================================
+// Filename:     ConstBufferRing.cpp
+// Description:  implementation of the ConstBufferRing's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "ConstBufferRing.h"
+#include "StateCache.h"
+#include "FrameStats.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <cstring>
+
+
+namespace Render
+{
+
+ConstBufferRing::~ConstBufferRing()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool ConstBufferRing::Initialize(ID3D11Device* pDevice, ID3D11DeviceContext* pImmediateContext)
+{
+    try
+    {
+        CAssert::True(pDevice,           "input ptr to the device == nullptr");
+        CAssert::True(pImmediateContext, "input ptr to the immediate context == nullptr");
+
+        // ranges of constant buffers are bound only since D3D11.1
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options{};
+        HRESULT hr = pDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+
+        if (FAILED(hr) || !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+        {
+            LogMsg("constant buffer offsetting isn't supported: per-draw constants use their own buffers");
+            return false;
+        }
+
+        hr = pImmediateContext->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&pContext1_);
+        CAssert::NotFailed(hr, "can't get the D3D11.1 immediate context");
+
+        D3D11_BUFFER_DESC desc;
+        desc.Usage               = D3D11_USAGE_DYNAMIC;
+        desc.ByteWidth           = BLOCK_SIZE * CAPACITY;
+        desc.BindFlags           = D3D11_BIND_CONSTANT_BUFFER;
+        desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags           = 0;
+        desc.StructureByteStride = 0;
+
+        hr = pDevice->CreateBuffer(&desc, nullptr, &pBuffer_);
+        CAssert::NotFailed(hr, "can't create a buffer for the constant buffer ring");
+
+        D3D11_QUERY_DESC queryDesc;
+        queryDesc.Query     = D3D11_QUERY_EVENT;
+        queryDesc.MiscFlags = 0;
+
+        for (Fence& fence : fences_)
+        {
+            hr = pDevice->CreateQuery(&queryDesc, &fence.pQuery);
+            CAssert::NotFailed(hr, "can't create a fence query for the constant buffer ring");
+        }
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the constant buffer ring");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void ConstBufferRing::Shutdown()
+{
+    for (Fence& fence : fences_)
+        SafeRelease(&fence.pQuery);
+
+    SafeRelease(&pBuffer_);
+    SafeRelease(&pContext1_);
+
+    firstFence_  = 0;
+    numFences_   = 0;
+    head_        = 0;
+    tail_        = 0;
+    needDiscard_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ConstBufferRing::Push(
+    ID3D11DeviceContext* pContext,
+    const void* pData,
+    const UINT numBytes,
+    Range& outRange)
+{
+    // deferred contexts can't be mapped with NO_OVERWRITE before the first DISCARD
+    // so they use usual constant buffers
+    if (!pContext1_ || (pContext != pContext1_) || !pData || (numBytes == 0))
+        return false;
+
+    const UINT count = (numBytes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    // a single bound range is limited by 4096 constants
+    if (count * CONSTANTS_PER_BLOCK > D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT)
+        return false;
+
+    RetireFinishedFrames();
+
+    // a range must be contiguous so we skip the rest of the ring if it isn't enough
+    uint64 start = head_;
+    const UINT offset = (UINT)(start % CAPACITY);
+
+    if (offset + count > CAPACITY)
+        start += CAPACITY - offset;
+
+    // the GPU still can read the data we are going to overwrite
+    if (start + count - tail_ > CAPACITY)
+        needDiscard_ = true;
+
+    D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+
+    if (needDiscard_)
+    {
+        // the driver gives us a new memory so all the prev ranges are free
+        mapType      = D3D11_MAP_WRITE_DISCARD;
+        start        = head_ + (CAPACITY - (UINT)(head_ % CAPACITY)) % CAPACITY;
+        tail_        = start;
+        needDiscard_ = false;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    const HRESULT hr = pContext1_->Map(pBuffer_, 0, mapType, 0, &mapped);
+
+    if (FAILED(hr))
+    {
+        LogErr("can't map the constant buffer ring");
+        needDiscard_ = true;
+        return false;
+    }
+
+    const UINT firstBlock = (UINT)(start % CAPACITY);
+
+    memcpy((uint8*)mapped.pData + firstBlock * BLOCK_SIZE, pData, numBytes);
+    pContext1_->Unmap(pBuffer_, 0);
+
+    head_ = start + count;
+    g_FrameStats.AddUpload(UPLOAD_CB_RING, numBytes);
+
+    outRange.firstConstant = firstBlock * CONSTANTS_PER_BLOCK;
+    outRange.numConstants  = count * CONSTANTS_PER_BLOCK;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ConstBufferRing::BindVS(StateCache& cache, const UINT slot, const Range& range)
+{
+    pContext1_->VSSetConstantBuffers1(slot, 1, &pBuffer_, &range.firstConstant, &range.numConstants);
+    cache.ForgetVSConstantBuffer(slot);
+}
+
+///////////////////////////////////////////////////////////
+
+void ConstBufferRing::BindPS(StateCache& cache, const UINT slot, const Range& range)
+{
+    pContext1_->PSSetConstantBuffers1(slot, 1, &pBuffer_, &range.firstConstant, &range.numConstants);
+    cache.ForgetPSConstantBuffer(slot);
+}
+
+///////////////////////////////////////////////////////////
+
+void ConstBufferRing::EndFrame(ID3D11DeviceContext* pContext)
+{
+    if (!pContext1_)
+        return;
+
+    RetireFinishedFrames();
+
+    // all the fences are in flight: the data of this frame will be retired
+    // together with the next frame (so we are just more conservative)
+    if (numFences_ == NUM_FENCES)
+        return;
+
+    Fence& fence = fences_[(firstFence_ + numFences_) % NUM_FENCES];
+    fence.end = head_;
+    pContext->End(fence.pQuery);
+    ++numFences_;
+}
+
+
+// =================================================================================
+// PRIVATE HELPERS
+// =================================================================================
+void ConstBufferRing::RetireFinishedFrames()
+{
+    // move the tail over frames which are already finished by the GPU
+    while (numFences_ > 0)
+    {
+        Fence& fence = fences_[firstFence_];
+
+        if (pContext1_->GetData(fence.pQuery, nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+            break;
+
+        // after a discard the tail can be already farther
+        tail_ = (fence.end > tail_) ? fence.end : tail_;
+
+        firstFence_ = (firstFence_ + 1) % NUM_FENCES;
+        --numFences_;
+    }
+}
+
+} // namespace Render
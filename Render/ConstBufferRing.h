@@ -0,0 +1,95 @@
+// =================================================================================
+// Filename:     ConstBufferRing.h
+// Description:  a persistent ring of per-draw constant data: each draw
+//               sub-allocates a range of 256-byte blocks, writes its constants
+//               into it with MAP_WRITE_NO_OVERWRITE, and binds the range
+//               by VS/PSSetConstantBuffers1 offsets (so there is no Map with
+//               DISCARD of a small buffer per draw);
+//
+//               ranges are retired by per-frame fences as of the InstanceRing;
+//
+//               NOTE: requires D3D11.1 constant buffer offsetting; if it isn't
+//                     supported IsSupported() is false and shaders keep using
+//                     their own constant buffers
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <d3d11_1.h>
+
+
+namespace Render
+{
+
+class StateCache;
+
+class ConstBufferRing
+{
+public:
+    static constexpr UINT BLOCK_SIZE          = 256;     // offsets must be multiples of 16 constants (16 bytes each)
+    static constexpr UINT CONSTANTS_PER_BLOCK = BLOCK_SIZE / 16;
+    static constexpr UINT CAPACITY            = 4096;    // max number of blocks in the ring (1 MB)
+    static constexpr int  NUM_FENCES          = 4;       // max number of frames in flight we track
+
+    // a range of the ring which is bound instead of a whole constant buffer
+    struct Range
+    {
+        UINT firstConstant = 0;
+        UINT numConstants  = 0;
+    };
+
+public:
+    ConstBufferRing() {}
+    ~ConstBufferRing();
+
+    // restrict a copying of this class instance
+    ConstBufferRing(const ConstBufferRing&) = delete;
+    ConstBufferRing& operator=(const ConstBufferRing&) = delete;
+
+    // the ring is used only by the immediate context
+    bool Initialize(ID3D11Device* pDevice, ID3D11DeviceContext* pImmediateContext);
+    void Shutdown();
+
+    inline bool IsSupported() const { return pContext1_ != nullptr; }
+
+    // copy constants of a draw into the ring;
+    // ret: false if the ring isn't supported or data can't be written (so use a usual buffer)
+    bool Push(ID3D11DeviceContext* pContext, const void* pData, const UINT numBytes, Range& outRange);
+
+    // bind the range into the slot (the slot is forgotten by the state cache
+    // since it doesn't shadow ranges)
+    void BindVS(StateCache& cache, const UINT slot, const Range& range);
+    void BindPS(StateCache& cache, const UINT slot, const Range& range);
+
+    // put a fence after all the draws of this frame
+    void EndFrame(ID3D11DeviceContext* pContext);
+
+    inline ID3D11Buffer* GetBuffer() const { return pBuffer_; }
+
+private:
+    void RetireFinishedFrames();
+
+private:
+    struct Fence
+    {
+        ID3D11Query* pQuery = nullptr;
+        uint64       end    = 0;                // ring head at the end of the frame
+    };
+
+    ID3D11Buffer*         pBuffer_   = nullptr;
+    ID3D11DeviceContext1* pContext1_ = nullptr;
+
+    Fence                 fences_[NUM_FENCES];
+    int                   firstFence_ = 0;      // the oldest fence in flight
+    int                   numFences_  = 0;
+
+    // monotonic counters of blocks (the offset in the ring is counter % CAPACITY)
+    uint64                head_ = 0;            // the next free block
+    uint64                tail_ = 0;            // the oldest block which can be still read by the GPU
+
+    bool                  needDiscard_ = true;  // the first map must discard
+};
+
+} // namespace Render
@@ -0,0 +1,307 @@
+// =================================================================================
+// Filename:     DeferredShading.cpp
+// Description:  implementation of the DeferredShading's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "DeferredShading.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <algorithm>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+static_assert(sizeof(ConstBufType::cbDeferred) % 16 == 0, "size of the const buffer must be a multiple of 16");
+
+// formats of the G-buffer targets (must be the same as in GBuffer.hlsli)
+static const DXGI_FORMAT s_TargetFormats[DeferredShading::NUM_GBUFFER_TARGETS] =
+{
+    DXGI_FORMAT_R8G8B8A8_UNORM,         // albedo
+    DXGI_FORMAT_R16G16_UNORM,           // octahedral normal
+    DXGI_FORMAT_R32_UINT,               // material idx | spec
+};
+
+///////////////////////////////////////////////////////////
+
+DeferredShading::~DeferredShading()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool DeferredShading::Initialize(
+    ID3D11Device* pDevice,
+    const char* gbufferPSFilePath,
+    const char* lightingCSFilePath,
+    const char* compositeVSFilePath,
+    const char* compositePSFilePath)
+{
+    try
+    {
+        bool result = gbufferPS_.Initialize(pDevice, gbufferPSFilePath);
+        CAssert::True(result, "can't initialize the G-buffer pixel shader");
+
+        result = lightingCS_.Initialize(pDevice, lightingCSFilePath);
+        CAssert::True(result, "can't initialize the lighting compute shader");
+
+        // the fullscreen triangle is generated by SV_VertexID
+        result = compositeVS_.Initialize(pDevice, compositeVSFilePath, nullptr, 0);
+        CAssert::True(result, "can't initialize the composite vertex shader");
+
+        result = compositePS_.Initialize(pDevice, compositePSFilePath);
+        CAssert::True(result, "can't initialize the composite pixel shader");
+
+        HRESULT hr = cbDeferred_.Initialize(pDevice);
+        CAssert::NotFailed(hr, "can't initialize the const buffer of the deferred lighting");
+
+        // lit pixels are just copied over the scene color
+        D3D11_DEPTH_STENCIL_DESC dssDesc;
+        ZeroMemory(&dssDesc, sizeof(dssDesc));
+        dssDesc.DepthEnable    = FALSE;
+        dssDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+        dssDesc.DepthFunc      = D3D11_COMPARISON_ALWAYS;
+        dssDesc.StencilEnable  = FALSE;
+
+        hr = pDevice->CreateDepthStencilState(&dssDesc, &pNoDepthState_);
+        CAssert::NotFailed(hr, "can't create a depth stencil state for the composite");
+
+        isInit_ = true;
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the deferred shading");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void DeferredShading::Shutdown()
+{
+    ReleaseTargets();
+
+    SafeRelease(&pNoDepthState_);
+    SafeRelease(&pPrevRTV_);
+    SafeRelease(&pPrevDSV_);
+
+    gbufferPS_.Shutdown();
+    lightingCS_.Shutdown();
+    compositeVS_.Shutdown();
+    compositePS_.Shutdown();
+    isInit_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+bool DeferredShading::BeginGBuffer(ID3D11DeviceContext* pContext)
+{
+    try
+    {
+        pContext->OMGetRenderTargets(1, &pPrevRTV_, &pPrevDSV_);
+        CAssert::True(pPrevDSV_ != nullptr, "there is no bound depth for the G-buffer");
+
+        // the G-buffer goes along with the scene depth so it has the same size
+        ID3D11Texture2D* pDepth = nullptr;
+        D3D11_TEXTURE2D_DESC depthDesc;
+
+        pPrevDSV_->GetResource((ID3D11Resource**)&pDepth);
+        pDepth->GetDesc(&depthDesc);
+        SafeRelease(&pDepth);
+
+        if (depthDesc.SampleDesc.Count > 1)
+        {
+            EndGBuffer(pContext);
+            return false;
+        }
+
+        if ((depthDesc.Width != width_) || (depthDesc.Height != height_))
+        {
+            ID3D11Device* pDevice = nullptr;
+            pContext->GetDevice(&pDevice);
+            CreateTargets(pDevice, depthDesc.Width, depthDesc.Height);
+            SafeRelease(&pDevice);
+        }
+
+        // the G-buffer can be still bound as input of the prev lighting
+        for (UINT i = 0; i < NUM_GBUFFER_TARGETS; ++i)
+            pStateCache_->UnbindShaderResource(pContext, pTargetSRVs_[i]);
+
+        pContext->OMSetRenderTargets(NUM_GBUFFER_TARGETS, pTargetRTVs_, pPrevDSV_);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't bind the G-buffer");
+        EndGBuffer(pContext);
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void DeferredShading::EndGBuffer(ID3D11DeviceContext* pContext)
+{
+    pContext->OMSetRenderTargets(1, &pPrevRTV_, pPrevDSV_);
+
+    // OMGetRenderTargets() increments ref counters
+    SafeRelease(&pPrevRTV_);
+    SafeRelease(&pPrevDSV_);
+}
+
+///////////////////////////////////////////////////////////
+
+void DeferredShading::Light(
+    ID3D11DeviceContext* pContext,
+    ID3D11ShaderResourceView* pDepthSRV,
+    const UINT width,
+    const UINT height,
+    const XMMATRIX& view,
+    const XMMATRIX& proj)
+{
+    if (!pDepthSRV || (width == 0) || (height == 0) || (width_ == 0))
+        return;
+
+    const UINT w = std::min(width, width_);
+    const UINT h = std::min(height, height_);
+
+    cbDeferred_.data.invViewProj = XMMatrixTranspose(XMMatrixInverse(nullptr, view * proj));
+    cbDeferred_.data.viewDepth   = { view.r[0].m128_f32[2], view.r[1].m128_f32[2], view.r[2].m128_f32[2], view.r[3].m128_f32[2] };
+    cbDeferred_.data.width       = w;
+    cbDeferred_.data.height      = h;
+    cbDeferred_.data.invWidth    = 1.0f / (float)w;
+    cbDeferred_.data.invHeight   = 1.0f / (float)h;
+    cbDeferred_.ApplyChanges(pContext);
+
+    // the depth can't be read while it is bound as the depth stencil view
+    ID3D11RenderTargetView* pRTV = nullptr;
+    ID3D11DepthStencilView* pDSV = nullptr;
+
+    pContext->OMGetRenderTargets(1, &pRTV, &pDSV);
+    pContext->OMSetRenderTargets(0, nullptr, nullptr);
+
+    // the lit texture is read by the composite of the prev frame
+    pStateCache_->UnbindShaderResource(pContext, pLitColorSRV_);
+
+    // ---------------------------------------------
+
+    ID3D11ShaderResourceView* const srvs[4] = { pTargetSRVs_[0], pTargetSRVs_[1], pTargetSRVs_[2], pDepthSRV };
+    ID3D11ShaderResourceView* const nullSRVs[4] = { nullptr };
+    ID3D11UnorderedAccessView*      nullUAV = nullptr;
+
+    pContext->CSSetShader(lightingCS_.GetShader(), nullptr, 0);
+    pContext->CSSetConstantBuffers(CS_CB_SLOT, 1, cbDeferred_.GetAddressOf());
+    pContext->CSSetShaderResources(CS_GBUFFER_SLOT, 4, srvs);
+    pContext->CSSetUnorderedAccessViews(0, 1, &pLitColorUAV_, nullptr);
+
+    // thread group is 8x8
+    pContext->Dispatch((w + 7) / 8, (h + 7) / 8, 1);
+
+    pContext->CSSetShaderResources(CS_GBUFFER_SLOT, 4, nullSRVs);
+    pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+    pContext->CSSetShader(nullptr, nullptr, 0);
+
+    // ---------------------------------------------
+
+    // composite lit pixels into the scene color
+    pContext->OMSetRenderTargets(1, &pRTV, pDSV);
+
+    pStateCache_->SetDepthStencilState(pContext, pNoDepthState_, 0);
+    pStateCache_->SetInputLayout(pContext, nullptr);
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    pStateCache_->SetVS(pContext, compositeVS_.GetShader());
+    pStateCache_->SetGS(pContext, nullptr);
+    pStateCache_->SetPS(pContext, compositePS_.GetShader());
+    pStateCache_->SetPSShaderResources(pContext, PS_LIT_COLOR_SLOT, 1, &pLitColorSRV_);
+
+    pStateCache_->Draw(pContext, 3, 0);
+
+    ID3D11ShaderResourceView* nullSRV = nullptr;
+    pStateCache_->SetPSShaderResources(pContext, PS_LIT_COLOR_SLOT, 1, &nullSRV);
+
+    // OMGetRenderTargets() increments ref counters
+    SafeRelease(&pRTV);
+    SafeRelease(&pDSV);
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+void DeferredShading::CreateTargets(ID3D11Device* pDevice, const UINT width, const UINT height)
+{
+    // create (or recreate if the scene depth is resized) the G-buffer and the lit texture
+
+    ReleaseTargets();
+
+    D3D11_TEXTURE2D_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+    desc.Width            = width;
+    desc.Height           = height;
+    desc.MipLevels        = 1;
+    desc.ArraySize        = 1;
+    desc.SampleDesc.Count = 1;
+    desc.Usage            = D3D11_USAGE_DEFAULT;
+    desc.BindFlags        = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+    HRESULT hr = S_OK;
+
+    for (UINT i = 0; i < NUM_GBUFFER_TARGETS; ++i)
+    {
+        desc.Format = s_TargetFormats[i];
+
+        hr = pDevice->CreateTexture2D(&desc, nullptr, &pTargets_[i]);
+        CAssert::NotFailed(hr, "can't create a G-buffer target");
+
+        hr = pDevice->CreateRenderTargetView(pTargets_[i], nullptr, &pTargetRTVs_[i]);
+        CAssert::NotFailed(hr, "can't create a RTV of the G-buffer target");
+
+        hr = pDevice->CreateShaderResourceView(pTargets_[i], nullptr, &pTargetSRVs_[i]);
+        CAssert::NotFailed(hr, "can't create a SRV of the G-buffer target");
+    }
+
+    desc.Format    = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+
+    hr = pDevice->CreateTexture2D(&desc, nullptr, &pLitColor_);
+    CAssert::NotFailed(hr, "can't create the lit texture");
+
+    hr = pDevice->CreateUnorderedAccessView(pLitColor_, nullptr, &pLitColorUAV_);
+    CAssert::NotFailed(hr, "can't create a UAV of the lit texture");
+
+    hr = pDevice->CreateShaderResourceView(pLitColor_, nullptr, &pLitColorSRV_);
+    CAssert::NotFailed(hr, "can't create a SRV of the lit texture");
+
+    width_  = width;
+    height_ = height;
+}
+
+///////////////////////////////////////////////////////////
+
+void DeferredShading::ReleaseTargets()
+{
+    for (UINT i = 0; i < NUM_GBUFFER_TARGETS; ++i)
+    {
+        SafeRelease(&pTargetSRVs_[i]);
+        SafeRelease(&pTargetRTVs_[i]);
+        SafeRelease(&pTargets_[i]);
+    }
+
+    SafeRelease(&pLitColorSRV_);
+    SafeRelease(&pLitColorUAV_);
+    SafeRelease(&pLitColor_);
+
+    width_  = 0;
+    height_ = 0;
+}
+
+} // namespace Render
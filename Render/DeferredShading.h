@@ -0,0 +1,128 @@
+// =================================================================================
+// Filename:     DeferredShading.h
+// Description:  an optional deferred shading path which replaces the forward
+//               light shader of the opaque and alpha clipped passes:
+//
+//               - the G-buffer pass renders instances by the light VS (the same
+//                 sorted draws as of the forward path) but its pixel shader only
+//                 writes the surface: albedo, the octahedral normal, spec and
+//                 the material idx (see GBuffer.hlsli);
+//               - the tiled lighting CS reads the G-buffer and the scene depth
+//                 and lights each pixel once by the same light buffers and
+//                 per-cluster lists as of the clustered forward shading
+//                 (see LightClusters), so the cost of lights doesn't depend
+//                 on the overdraw;
+//               - lit pixels are composited into the scene color by a fullscreen
+//                 triangle; pixels without geometry (the far depth) are clipped
+//
+//               NOTE: the G-buffer has the size of the scene depth and is never
+//                     cleared (it is read only where the depth was written);
+//                     a multisampled depth can't be shaded by this path
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/VertexShader.h"
+#include "Shaders/PixelShader.h"
+#include "Shaders/ComputeShader.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "StateCache.h"
+
+#include <Types.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+class DeferredShading
+{
+public:
+    static constexpr UINT NUM_GBUFFER_TARGETS = 3;
+
+    // compute shader slots (must be the same as in DeferredLightingCS.hlsl);
+    // the lights and const buffers of the light PS are bound to CS by their slots
+    static constexpr UINT CS_MATERIALS_SLOT = 0;
+    static constexpr UINT CS_GBUFFER_SLOT   = 1;      // albedo, normals, material/spec, depth
+    static constexpr UINT CS_CB_SLOT        = 9;
+
+    // the lit texture for the composite (doesn't overlap the sky cube map at t0)
+    static constexpr UINT PS_LIT_COLOR_SLOT = 1;
+
+    DeferredShading() {}
+    ~DeferredShading();
+
+    // restrict a copying of this class instance
+    DeferredShading(const DeferredShading&) = delete;
+    DeferredShading& operator=(const DeferredShading&) = delete;
+
+    bool Initialize(
+        ID3D11Device* pDevice,
+        const char* gbufferPSFilePath,
+        const char* lightingCSFilePath,
+        const char* compositeVSFilePath,
+        const char* compositePSFilePath);
+
+    void Shutdown();
+
+    // bind the G-buffer targets along with the currently bound depth (the scene depth);
+    // return false if this depth can't be shaded by the deferred path (it is multisampled)
+    // NOTE: output merger targets are restored by EndGBuffer()
+    bool BeginGBuffer(ID3D11DeviceContext* pContext);
+    void EndGBuffer  (ID3D11DeviceContext* pContext);
+
+    // light the rendered part (width x height) of the G-buffer and composite it into
+    // the bound scene color; view/proj are of the camera (NOT transposed);
+    // NOTE: light buffers, materials and const buffers of lights must be already
+    //       bound to CS (see CRender::RenderDeferredLighting)
+    void Light(
+        ID3D11DeviceContext* pContext,
+        ID3D11ShaderResourceView* pDepthSRV,
+        const UINT width,
+        const UINT height,
+        const DirectX::XMMATRIX& view,
+        const DirectX::XMMATRIX& proj);
+
+    inline bool               IsInitialized() const { return isInit_; }
+    inline ID3D11PixelShader* GetGBufferPS()        { return gbufferPS_.GetShader(); }
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+private:
+    void CreateTargets(ID3D11Device* pDevice, const UINT width, const UINT height);
+    void ReleaseTargets();
+
+private:
+    PixelShader                 gbufferPS_;
+    ComputeShader               lightingCS_;
+    VertexShader                compositeVS_;              // a fullscreen triangle (without input layout)
+    PixelShader                 compositePS_;
+    ID3D11DepthStencilState*    pNoDepthState_ = nullptr;  // for the composite
+
+    ConstantBuffer<ConstBufType::cbDeferred> cbDeferred_;
+
+    // G-buffer: albedo, normals, material/spec
+    ID3D11Texture2D*            pTargets_   [NUM_GBUFFER_TARGETS]{ nullptr };
+    ID3D11RenderTargetView*     pTargetRTVs_[NUM_GBUFFER_TARGETS]{ nullptr };
+    ID3D11ShaderResourceView*   pTargetSRVs_[NUM_GBUFFER_TARGETS]{ nullptr };
+
+    // the output of the lighting CS
+    ID3D11Texture2D*            pLitColor_    = nullptr;
+    ID3D11UnorderedAccessView*  pLitColorUAV_ = nullptr;
+    ID3D11ShaderResourceView*   pLitColorSRV_ = nullptr;
+
+    UINT                        width_  = 0;               // of the G-buffer (== of the scene depth)
+    UINT                        height_ = 0;
+
+    // targets of the scene which are restored by EndGBuffer()
+    ID3D11RenderTargetView*     pPrevRTV_ = nullptr;
+    ID3D11DepthStencilView*     pPrevDSV_ = nullptr;
+
+    StateCache*                 pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
+    bool                        isInit_ = false;
+};
+
+} // namespace Render
@@ -0,0 +1,141 @@
+// =================================================================================
+// Filename:     DepthPrepass.cpp
+// Description:  implementation of the DepthPrepass's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "DepthPrepass.h"
+#include "Common/InputLayouts.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+
+
+namespace Render
+{
+
+// idx of the diffuse map in textures of each subset (the same as in LightPS.hlsl)
+static constexpr int DIFFUSE_TEX_IDX = 1;
+
+///////////////////////////////////////////////////////////
+
+DepthPrepass::~DepthPrepass()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool DepthPrepass::Initialize(
+    ID3D11Device* pDevice,
+    const char* vsFilePath,
+    const char* vsAlphaClipFilePath,
+    const char* psAlphaClipFilePath)
+{
+    try
+    {
+        const InputLayoutDepthPrepass          layout;
+        const InputLayoutDepthPrepassAlphaClip layoutAlphaClip;
+
+        bool result = vs_.Initialize(pDevice, vsFilePath, layout.desc, layout.numElem);
+        CAssert::True(result, "can't initialize the vertex shader");
+
+        result = vsAlphaClip_.Initialize(pDevice, vsAlphaClipFilePath, layoutAlphaClip.desc, layoutAlphaClip.numElem);
+        CAssert::True(result, "can't initialize the alpha clipping vertex shader");
+
+        result = psAlphaClip_.Initialize(pDevice, psAlphaClipFilePath);
+        CAssert::True(result, "can't initialize the alpha clipping pixel shader");
+
+        // the same (default) sampler as of the light shader so mips are the same
+        result = samplerState_.Initialize(pDevice);
+        CAssert::True(result, "can't initialize the sampler state");
+
+        isInit_ = true;
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the depth pre-pass");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void DepthPrepass::Shutdown()
+{
+    vs_.Shutdown();
+    vsAlphaClip_.Shutdown();
+    psAlphaClip_.Shutdown();
+    isInit_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void DepthPrepass::Render(
+    ID3D11DeviceContext* pContext,
+    ID3D11Buffer* pInstancedBuffer,
+    const Instance* instances,
+    const int numInstances,
+    const UINT instancesBuffElemSize,
+    const UINT baseInstance,
+    const bool alphaClipping)
+{
+    // bind input layout and shaders; opaque geometry goes without a pixel shader
+    // so only depth is written (color targets aren't touched anyway)
+    if (alphaClipping)
+    {
+        pStateCache_->SetInputLayout(pContext, vsAlphaClip_.GetInputLayout());
+        pStateCache_->SetVS(pContext, vsAlphaClip_.GetShader());
+        pStateCache_->SetPS(pContext, psAlphaClip_.GetShader());
+        pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
+    }
+    else
+    {
+        pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+        pStateCache_->SetVS(pContext, vs_.GetShader());
+        pStateCache_->SetPS(pContext, nullptr);
+    }
+
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    // go through each instance and render it (the same ranges as in the light shader)
+    for (int i = 0, startInstanceLocation = (int)baseInstance; i < numInstances; ++i)
+    {
+        const Instance& instance = instances[i];
+
+        // bind vertex/index buffers
+        ID3D11Buffer* const vbs[2] = { instance.pVB, pInstancedBuffer };
+        const UINT stride[2] = { instance.vertexStride, instancesBuffElemSize };
+        const UINT offset[2] = { 0,0 };
+
+        pStateCache_->SetVertexBuffers(pContext, 0, 2, vbs, stride, offset);
+        pStateCache_->SetIndexBuffer(pContext, instance.pIB, instance.indexFormat, 0);
+
+        ID3D11ShaderResourceView* const* texSRVs = instance.texSRVs.data();
+        const int numSubsets = (int)std::ssize(instance.subsets);
+
+        for (int subsetIdx = 0; subsetIdx < numSubsets; ++subsetIdx)
+        {
+            // (is sampled only if the diffuse map isn't packed into the array)
+            if (alphaClipping)
+                pStateCache_->SetPSShaderResources(pContext, DIFFUSE_MAP_SLOT, 1, texSRVs + (subsetIdx * NUM_TEXTURE_TYPES) + DIFFUSE_TEX_IDX);
+
+            const Subset& subset = instance.subsets[subsetIdx];
+
+            pStateCache_->DrawIndexedInstanced(
+                pContext,
+                subset.indexCount,
+                instance.numInstances,
+                subset.indexStart,
+                subset.vertexStart,
+                startInstanceLocation + (subsetIdx * instance.numInstances));
+        }
+
+        startInstanceLocation += numSubsets * instance.numInstances;
+    }
+}
+
+} // namespace Render
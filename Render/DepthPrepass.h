@@ -0,0 +1,80 @@
+// =================================================================================
+// Filename:     DepthPrepass.h
+// Description:  an optional depth-only pass which goes before the opaque and
+//               alpha clipped passes:
+//
+//               - opaque instances are rendered by a position-only input layout
+//                 and without a pixel shader at all;
+//               - alpha clipped instances (foliage, fences, etc.) are clipped by
+//                 the diffuse alpha the same way as in the light shader;
+//               - then the main passes are tested by DEPTH_EQUAL without depth
+//                 writes so the heavy light shader is executed at most once per
+//                 pixel whatever the overdraw is
+//
+//               NOTE: instances are rendered by the same instances buffer
+//                     ranges as the main passes
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/VertexShader.h"
+#include "Shaders/PixelShader.h"
+#include "Shaders/SamplerState.h"
+#include "Common/RenderTypes.h"
+#include "StateCache.h"
+
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+class DepthPrepass
+{
+public:
+    // slot of the diffuse map (must be the same as in DepthPrepassAlphaClipPS.hlsl
+    // and as of gTextures[1] in LightPS.hlsl so the main pass doesn't rebind it)
+    static constexpr UINT DIFFUSE_MAP_SLOT = 2;
+
+    DepthPrepass() {}
+    ~DepthPrepass();
+
+    // restrict a copying of this class instance
+    DepthPrepass(const DepthPrepass&) = delete;
+    DepthPrepass& operator=(const DepthPrepass&) = delete;
+
+    bool Initialize(
+        ID3D11Device* pDevice,
+        const char* vsFilePath,
+        const char* vsAlphaClipFilePath,
+        const char* psAlphaClipFilePath);
+
+    void Shutdown();
+
+    // render depth of instances by the same instance buffer as the main pass;
+    // NOTE: raster and depth stencil states must be already set
+    void Render(
+        ID3D11DeviceContext* pContext,
+        ID3D11Buffer* pInstancedBuffer,
+        const Instance* instances,
+        const int numInstances,
+        const UINT instancesBuffElemSize,
+        const UINT baseInstance,
+        const bool alphaClipping);
+
+    inline bool IsInitialized() const { return isInit_; }
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+private:
+    VertexShader   vs_;                       // opaque: position only
+    VertexShader   vsAlphaClip_;              // alpha clipped: + texture coords
+    PixelShader    psAlphaClip_;
+    SamplerState   samplerState_;
+
+    StateCache*    pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
+    bool           isInit_ = false;
+};
+
+} // namespace Render
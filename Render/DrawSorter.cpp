@@ -0,0 +1,158 @@
+// =================================================================================
+// Filename:     DrawSorter.cpp
+// Description:  implementation of the DrawSorter's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "DrawSorter.h"
+#include <string.h>
+
+
+namespace Render
+{
+
+//---------------------------------------------------------
+// Desc:   hash an arr of pointers into the lowest numBits bits (FNV-1a)
+//---------------------------------------------------------
+static uint32 HashPtrs(const void* const* ptrs, const int num, const int numBits)
+{
+    uint64 hash = 14695981039346656037ULL;
+
+    for (int i = 0; i < num; ++i)
+    {
+        hash ^= (uint64)(uintptr_t)ptrs[i];
+        hash *= 1099511628211ULL;
+    }
+
+    // fold the upper bits so they affect the result as well
+    hash ^= (hash >> 32);
+    hash ^= (hash >> 16);
+
+    return (uint32)(hash & ((1ULL << numBits) - 1));
+}
+
+//---------------------------------------------------------
+// Desc:   quantize a non-negative depth into 16 bits keeping the order
+//---------------------------------------------------------
+static uint32 QuantizeDepth(const float depth)
+{
+    uint32 bits = 0;
+    const float d = (depth > 0.0f) ? depth : 0.0f;
+
+    memcpy(&bits, &d, sizeof(bits));
+    return bits >> 16;
+}
+
+///////////////////////////////////////////////////////////
+
+void DrawSorter::Build(
+    const Instance* instances,
+    const int numInstances,
+    const UINT baseInstance,
+    const eDrawPass pass,
+    const uint8 shaderType)
+{
+    int numDraws = 0;
+
+    for (int i = 0; i < numInstances; ++i)
+        numDraws += (int)instances[i].subsets.size();
+
+    draws_.resize(numDraws);
+
+    const uint64 passBits   = ((uint64)(pass & 0xF)       << 60) |
+                              ((uint64)(shaderType & 0xF) << 56);
+    const bool   isBlended  = (pass == DRAW_PASS_BLENDED);
+
+    for (int i = 0, drawIdx = 0, startInstance = (int)baseInstance; i < numInstances; ++i)
+    {
+        const Instance& instance = instances[i];
+        const int       numSubsets = (int)instance.subsets.size();
+
+        const void* const buffers[2] = { instance.pVB, instance.pIB };
+        const uint64 buffersBits = HashPtrs(buffers, 2, 20);
+        const uint64 depthBits   = QuantizeDepth(instance.depth);
+
+        for (int subsetIdx = 0; subsetIdx < numSubsets; ++subsetIdx, ++drawIdx)
+        {
+            // maps which are sampled from the packed arrays don't affect binds
+            const void* texs[NUM_TEXTURE_TYPES];
+            memcpy(texs, instance.texSRVs.data() + subsetIdx * NUM_TEXTURE_TYPES, sizeof(texs));
+
+            const uint8 packed = (instance.packedTexs.empty()) ? 0 : instance.packedTexs[subsetIdx];
+
+            if (packed & PACKED_TEX_DIFFUSE)
+                texs[PACKED_DIFFUSE_TEX_IDX] = nullptr;
+
+            if (packed & PACKED_TEX_NORMAL)
+                texs[PACKED_NORMAL_TEX_IDX] = nullptr;
+
+            const uint64 texturesBits = HashPtrs(texs, NUM_TEXTURE_TYPES, 20);
+
+            DrawCmd& draw = draws_[drawIdx];
+
+            // blended draws must go from far to near; opaque draws are grouped
+            // by states first and then go from near to far (for early-Z)
+            if (isBlended)
+                draw.key = passBits | ((0xFFFFULL - depthBits) << 40) | (texturesBits << 20) | buffersBits;
+            else
+                draw.key = passBits | (texturesBits << 36) | (buffersBits << 16) | depthBits;
+
+            draw.instanceIdx   = i;
+            draw.subsetIdx     = subsetIdx;
+            draw.startInstance = (UINT)(startInstance + subsetIdx * instance.numInstances);
+        }
+
+        startInstance += numSubsets * instance.numInstances;
+    }
+
+    RadixSort();
+}
+
+///////////////////////////////////////////////////////////
+
+void DrawSorter::RadixSort()
+{
+    // LSD radix sort by bytes of the key (is stable so equal keys keep the input order)
+
+    const index num = draws_.size();
+
+    if (num < 2)
+        return;
+
+    tmpDraws_.resize(num);
+
+    DrawCmd* src = draws_.data();
+    DrawCmd* dst = tmpDraws_.data();
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        index counts[256] = { 0 };
+
+        for (index i = 0; i < num; ++i)
+            counts[(src[i].key >> shift) & 0xFF]++;
+
+        // all the keys have the same byte: nothing to do in this pass
+        if (counts[(src[0].key >> shift) & 0xFF] == num)
+            continue;
+
+        for (index i = 0, offset = 0; i < 256; ++i)
+        {
+            const index count = counts[i];
+            counts[i] = offset;
+            offset += count;
+        }
+
+        for (index i = 0; i < num; ++i)
+            dst[counts[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+        DrawCmd* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    // the result is in the tmp arr after an odd number of passes
+    if (src != draws_.data())
+        memcpy(draws_.data(), src, sizeof(DrawCmd) * num);
+}
+
+} // namespace Render
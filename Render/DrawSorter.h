@@ -0,0 +1,72 @@
+// =================================================================================
+// Filename:     DrawSorter.h
+// Description:  sorting of draws (subsets of instances) by packed 64-bit keys
+//               so redundant binds of buffers and textures collapse:
+//
+//               opaque:   | pass:4 | shader:4 | textures:20 | buffers:20 | depth:16 |
+//               blended:  | pass:4 | shader:4 | far-to-near depth:16 | textures:20 | buffers:20 |
+//
+//               - textures/buffers fields are hashes of SRVs/VB+IB pointers
+//                 (collisions only make sorting worse but never wrong;
+//                 maps from the packed texture arrays aren't hashed);
+//               - depth is the distance to the nearest entt of the instance
+//                 (top bits of its float representation are monotonic);
+//               - keys are sorted by LSD radix sort (passes where all the keys
+//                 have the same byte are skipped)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Common/RenderTypes.h"
+
+#include <Types.h>
+#include <cvector.h>
+
+
+namespace Render
+{
+
+enum eDrawPass : uint8
+{
+    DRAW_PASS_OPAQUE,
+    DRAW_PASS_ALPHA_CLIPPED,
+    DRAW_PASS_BLENDED,
+};
+
+///////////////////////////////////////////////////////////
+
+struct DrawCmd
+{
+    uint64 key           = 0;
+    int    instanceIdx   = 0;        // idx into the input arr of instances
+    int    subsetIdx     = 0;
+    UINT   startInstance = 0;        // start instance location in the instances buffer
+};
+
+///////////////////////////////////////////////////////////
+
+class DrawSorter
+{
+public:
+    // make a draw of each subset of each instance and sort them by keys;
+    // (instances data is supposed to be laid out in the buffer from baseInstance)
+    void Build(
+        const Instance* instances,
+        const int numInstances,
+        const UINT baseInstance,
+        const eDrawPass pass,
+        const uint8 shaderType);
+
+    inline const DrawCmd* GetDraws()    const { return draws_.data(); }
+    inline int            GetNumDraws() const { return (int)draws_.size(); }
+
+private:
+    void RadixSort();
+
+private:
+    cvector<DrawCmd> draws_;
+    cvector<DrawCmd> tmpDraws_;
+};
+
+} // namespace Render
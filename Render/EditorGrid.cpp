@@ -0,0 +1,142 @@
+// =================================================================================
+// Filename:     EditorGrid.cpp
+// Description:  implementation of the EditorGrid's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "EditorGrid.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+static_assert(sizeof(ConstBufType::cbEditorGrid) % 16 == 0, "size of the const buffer must be a multiple of 16");
+
+// slots of resources (must be the same as in the grid shaders)
+static constexpr UINT CB_SLOT = 7;      // VS, PS
+
+///////////////////////////////////////////////////////////
+
+EditorGrid::~EditorGrid()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool EditorGrid::Initialize(ID3D11Device* pDevice, const EditorGridParams& params)
+{
+    try
+    {
+        CAssert::True(params.cellSize > 0.0f, "size of grid cells must be > 0");
+
+        // the quad is expanded from SV_VertexID so the VS has no input layout
+        bool result = vs_.Initialize(pDevice, "shaders/EditorGridVS.cso", nullptr, 0);
+        CAssert::True(result, "can't initialize the grid vertex shader");
+
+        result = ps_.Initialize(pDevice, "shaders/EditorGridPS.cso");
+        CAssert::True(result, "can't initialize the grid pixel shader");
+
+        CAssert::NotFailed(cbGrid_.Initialize(pDevice), "can't initialize the grid const buffer");
+
+        D3D11_RASTERIZER_DESC rsDesc;
+        ZeroMemory(&rsDesc, sizeof(rsDesc));
+        rsDesc.FillMode        = D3D11_FILL_SOLID;
+        rsDesc.CullMode        = D3D11_CULL_NONE;
+        rsDesc.DepthClipEnable = TRUE;
+
+        CAssert::NotFailed(pDevice->CreateRasterizerState(&rsDesc, &pRasterState_), "can't create a raster state of the grid");
+
+        D3D11_BLEND_DESC bsDesc;
+        ZeroMemory(&bsDesc, sizeof(bsDesc));
+        bsDesc.RenderTarget[0].BlendEnable           = TRUE;
+        bsDesc.RenderTarget[0].SrcBlend              = D3D11_BLEND_SRC_ALPHA;
+        bsDesc.RenderTarget[0].DestBlend             = D3D11_BLEND_INV_SRC_ALPHA;
+        bsDesc.RenderTarget[0].BlendOp               = D3D11_BLEND_OP_ADD;
+        bsDesc.RenderTarget[0].SrcBlendAlpha         = D3D11_BLEND_ONE;
+        bsDesc.RenderTarget[0].DestBlendAlpha        = D3D11_BLEND_ZERO;
+        bsDesc.RenderTarget[0].BlendOpAlpha          = D3D11_BLEND_OP_ADD;
+        bsDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+        CAssert::NotFailed(pDevice->CreateBlendState(&bsDesc, &pBlendState_), "can't create a blend state of the grid");
+
+        D3D11_DEPTH_STENCIL_DESC dsDesc;
+        ZeroMemory(&dsDesc, sizeof(dsDesc));
+        dsDesc.DepthEnable    = TRUE;
+        dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+        dsDesc.DepthFunc      = D3D11_COMPARISON_LESS_EQUAL;
+
+        CAssert::NotFailed(pDevice->CreateDepthStencilState(&dsDesc, &pDepthState_), "can't create a depth state of the grid");
+
+        params_ = params;
+        isInit_ = true;
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the editor grid");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EditorGrid::Shutdown()
+{
+    SafeRelease(&pDepthState_);
+    SafeRelease(&pBlendState_);
+    SafeRelease(&pRasterState_);
+
+    vs_.Shutdown();
+    ps_.Shutdown();
+
+    isInit_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void EditorGrid::Render(
+    ID3D11DeviceContext* pContext,
+    const XMMATRIX& viewProj,
+    const XMFLOAT3& cameraPos)
+{
+    if (!isInit_)
+        return;
+
+    ConstBufType::cbEditorGrid& cb = cbGrid_.data;
+
+    cb.viewProj      = XMMatrixTranspose(viewProj);
+    cb.cameraPos     = cameraPos;
+    cb.cellSize      = params_.cellSize;
+    cb.majorCellSize = params_.cellSize * (float)((params_.majorEvery > 1) ? params_.majorEvery : 1);
+    cb.fadeDistance  = params_.fadeDistance;
+    cb.height        = params_.height;
+    cb.lineWidth     = params_.lineWidth;
+    cbGrid_.ApplyChanges(pContext);
+
+    const FLOAT blendFactor[4] = { 0, 0, 0, 0 };
+
+    pStateCache_->SetInputLayout(pContext, nullptr);
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetGS(pContext, nullptr);
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetVSConstantBuffers(pContext, CB_SLOT, 1, cbGrid_.GetAddressOf());
+    pStateCache_->SetPSConstantBuffers(pContext, CB_SLOT, 1, cbGrid_.GetAddressOf());
+    pStateCache_->SetRasterState(pContext, pRasterState_);
+    pStateCache_->SetBlendState(pContext, pBlendState_, blendFactor, 0xFFFFFFFF);
+    pStateCache_->SetDepthStencilState(pContext, pDepthState_, 0);
+
+    // a single quad around the camera
+    pStateCache_->Draw(pContext, 4, 0);
+}
+
+} // namespace Render
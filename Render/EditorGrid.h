@@ -0,0 +1,77 @@
+// =================================================================================
+// Filename:     EditorGrid.h
+// Description:  the grid of the editor over the ground plane which is computed
+//               analytically in the pixel shader: a single quad around the camera
+//               is expanded from SV_VertexID (no vertex data at all) and lines are
+//               found by world coords of the pixel and their screen derivatives
+//               (so they are always about a pixel wide and fade out where cells
+//               become smaller than a few pixels instead of aliasing); the grid
+//               has no fixed extent, it just fades out by the distance
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/VertexShader.h"
+#include "Shaders/PixelShader.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "StateCache.h"
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+struct EditorGridParams
+{
+    float cellSize      = 1.0f;             // distance btw minor lines
+    int   majorEvery    = 10;               // cells btw major lines
+    float fadeDistance  = 200.0f;           // the grid fades out till this distance from the camera
+    float height        = 0.0f;             // Y of the ground plane
+    float lineWidth     = 1.0f;             // in pixels
+};
+
+///////////////////////////////////////////////////////////
+
+class EditorGrid
+{
+public:
+    EditorGrid() {}
+    ~EditorGrid();
+
+    // restrict a copying of this class instance
+    EditorGrid(const EditorGrid&) = delete;
+    EditorGrid& operator=(const EditorGrid&) = delete;
+
+    // shaders are loaded from "shaders/" (EditorGridVS, EditorGridPS)
+    bool Initialize(ID3D11Device* pDevice, const EditorGridParams& params);
+    void Shutdown();
+
+    // draw the grid over the scene by a single draw (the depth is tested but isn't written)
+    void Render(ID3D11DeviceContext* pContext, const DirectX::XMMATRIX& viewProj, const DirectX::XMFLOAT3& cameraPos);
+
+    inline bool IsInitialized() const { return isInit_; }
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+    inline const EditorGridParams& GetParams() const                         { return params_; }
+    inline void                    SetParams(const EditorGridParams& params) { params_ = params; }
+
+private:
+    VertexShader               vs_;                 // no input layout
+    PixelShader                ps_;
+    ConstantBuffer<ConstBufType::cbEditorGrid> cbGrid_;
+
+    ID3D11RasterizerState*     pRasterState_ = nullptr;   // no culling (the plane is seen from below as well)
+    ID3D11BlendState*          pBlendState_  = nullptr;   // alpha blending
+    ID3D11DepthStencilState*   pDepthState_  = nullptr;   // the depth test without writing
+    StateCache*                pStateCache_  = nullptr;   // filters redundant binds (is owned by CRender)
+
+    EditorGridParams           params_;
+    bool                       isInit_       = false;
+};
+
+} // namespace Render
@@ -0,0 +1,319 @@
+// =================================================================================
+// Filename:     EntityIdBuffer.cpp
+// Description:  implementation of the EntityIdBuffer's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "EntityIdBuffer.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <cstddef>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+// idx of the diffuse map in textures of each subset (the same as in LightPS.hlsl)
+static constexpr int DIFFUSE_TEX_IDX = 1;
+
+///////////////////////////////////////////////////////////
+
+EntityIdBuffer::~EntityIdBuffer()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool EntityIdBuffer::Initialize(
+    ID3D11Device* pDevice,
+    const char* vsFilePath,
+    const char* psFilePath)
+{
+    try
+    {
+        const D3D11_INPUT_ELEMENT_DESC inputLayoutDesc[] =
+        {
+            // per vertex data
+            {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+
+            // per instance data (see ConstBufType::InstancedData)
+            {"WORLD",   0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,  D3D11_INPUT_PER_INSTANCE_DATA, 1},
+            {"WORLD",   1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+            {"WORLD",   2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+            {"ENTT_ID", 0, DXGI_FORMAT_R32_UINT, 1, offsetof(ConstBufType::InstancedData, enttID), D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        };
+
+        const UINT layoutElemNum = sizeof(inputLayoutDesc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
+
+        bool result = vs_.Initialize(pDevice, vsFilePath, inputLayoutDesc, layoutElemNum);
+        CAssert::True(result, "can't initialize the vertex shader");
+
+        result = ps_.Initialize(pDevice, psFilePath);
+        CAssert::True(result, "can't initialize the pixel shader");
+
+        result = samplerState_.Initialize(pDevice);
+        CAssert::True(result, "can't initialize the sampler state");
+
+        HRESULT hr = cbEntityIds_.Initialize(pDevice);
+        CAssert::NotFailed(hr, "can't initialize the const buffer");
+
+        CreateResources(pDevice);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the entity IDs buffer");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityIdBuffer::Shutdown()
+{
+    SafeRelease(&pIdRTV_);
+    SafeRelease(&pIdTexture_);
+    SafeRelease(&pDepthDSV_);
+    SafeRelease(&pDepthTexture_);
+    SafeRelease(&pReadback_);
+    SafeRelease(&pPrevRTV_);
+    SafeRelease(&pPrevDSV_);
+
+    vs_.Shutdown();
+    ps_.Shutdown();
+    isPending_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityIdBuffer::Begin(
+    ID3D11DeviceContext* pContext,
+    const int sx,
+    const int sy,
+    const float screenWidth,
+    const float screenHeight,
+    const XMMATRIX& viewProj)
+{
+    // remember the current targets and viewport
+    numPrevViewports_ = 1;
+    pContext->OMGetRenderTargets(1, &pPrevRTV_, &pPrevDSV_);
+    pContext->RSGetViewports(&numPrevViewports_, &prevViewport_);
+
+    // NDC center of the picked pixel
+    const float cx = (2.0f * ((float)sx + 0.5f) / screenWidth) - 1.0f;
+    const float cy = 1.0f - (2.0f * ((float)sy + 0.5f) / screenHeight);
+
+    // scale the pixel onto the whole clip space (so a 1x1 target is enough)
+    const XMMATRIX pick(
+        screenWidth,       0,                  0, 0,
+        0,                 screenHeight,       0, 0,
+        0,                 0,                  1, 0,
+        -cx * screenWidth, -cy * screenHeight, 0, 1);
+
+    cbEntityIds_.data.viewProj      = XMMatrixTranspose(viewProj * pick);
+    cbEntityIds_.data.alphaClipping = 0;
+    cbEntityIds_.ApplyChanges(pContext);
+
+    const float clearID[4] = { 0,0,0,0 };             // 0 == no entity
+    pContext->ClearRenderTargetView(pIdRTV_, clearID);
+    pContext->ClearDepthStencilView(pDepthDSV_, D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+    const D3D11_VIEWPORT viewport = { 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f };
+    pContext->OMSetRenderTargets(1, &pIdRTV_, pDepthDSV_);
+    pContext->RSSetViewports(1, &viewport);
+
+    // bind input layout, shaders, samplers
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetVSConstantBuffers(pContext, CONST_BUFFER_SLOT, 1, cbEntityIds_.GetAddressOf());
+    pStateCache_->SetPSConstantBuffers(pContext, CONST_BUFFER_SLOT, 1, cbEntityIds_.GetAddressOf());
+    pStateCache_->SetPSSamplers(pContext, SAMPLER_SLOT, 1, samplerState_.GetAddressOf());
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityIdBuffer::Render(
+    ID3D11DeviceContext* pContext,
+    ID3D11Buffer* pInstancedBuffer,
+    const Instance* instances,
+    const int numInstances,
+    const UINT instancesBuffElemSize,
+    const UINT baseInstance,
+    const bool alphaClipping)
+{
+    if (cbEntityIds_.data.alphaClipping != (uint32_t)alphaClipping)
+    {
+        cbEntityIds_.data.alphaClipping = (uint32_t)alphaClipping;
+        cbEntityIds_.ApplyChanges(pContext);
+    }
+
+    // go through each instance and render it (the same order as in the light shader)
+    for (int i = 0, startInstanceLocation = (int)baseInstance; i < numInstances; ++i)
+    {
+        const Instance& instance = instances[i];
+
+        // bind vertex/index buffers
+        ID3D11Buffer* const vbs[2] = { instance.pVB, pInstancedBuffer };
+        const UINT stride[2] = { instance.vertexStride, instancesBuffElemSize };
+        const UINT offset[2] = { 0,0 };
+
+        pStateCache_->SetVertexBuffers(pContext, 0, 2, vbs, stride, offset);
+        pStateCache_->SetIndexBuffer(pContext, instance.pIB, instance.indexFormat, 0);
+
+        ID3D11ShaderResourceView* const* texSRVs = instance.texSRVs.data();
+        const int numSubsets = (int)std::ssize(instance.subsets);
+
+        for (int subsetIdx = 0; subsetIdx < numSubsets; ++subsetIdx)
+        {
+            if (alphaClipping)
+                pStateCache_->SetPSShaderResources(pContext, DIFFUSE_MAP_SLOT, 1, texSRVs + (subsetIdx * NUM_TEXTURE_TYPES) + DIFFUSE_TEX_IDX);
+
+            const Subset& subset = instance.subsets[subsetIdx];
+
+            pStateCache_->DrawIndexedInstanced(
+                pContext,
+                subset.indexCount,
+                instance.numInstances,
+                subset.indexStart,
+                subset.vertexStart,
+                startInstanceLocation + (subsetIdx * instance.numInstances));
+        }
+
+        startInstanceLocation += numSubsets * instance.numInstances;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityIdBuffer::RenderIndirect(
+    ID3D11DeviceContext* pContext,
+    ID3D11Buffer* pVisibleInstancesBuffer,
+    ID3D11Buffer* pArgsBuffer,
+    const Instance* instances,
+    const GpuDraw* draws,
+    const int numDraws,
+    const UINT instancesBuffElemSize)
+{
+    if (cbEntityIds_.data.alphaClipping != 0)
+    {
+        cbEntityIds_.data.alphaClipping = 0;
+        cbEntityIds_.ApplyChanges(pContext);
+    }
+
+    // visible records have the same layout as the instances ring
+    // so entity IDs are fetched by the same input layout
+    for (int i = 0; i < numDraws; ++i)
+    {
+        const Instance& instance = instances[draws[i].instanceIdx];
+
+        ID3D11Buffer* const vbs[2] = { instance.pVB, pVisibleInstancesBuffer };
+        const UINT stride[2] = { instance.vertexStride, instancesBuffElemSize };
+        const UINT offset[2] = { 0,0 };
+
+        pStateCache_->SetVertexBuffers(pContext, 0, 2, vbs, stride, offset);
+        pStateCache_->SetIndexBuffer(pContext, instance.pIB, instance.indexFormat, 0);
+
+        pStateCache_->DrawIndexedInstancedIndirect(pContext, pArgsBuffer, (UINT)i * GpuCulling::ARGS_STRIDE);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void EntityIdBuffer::End(ID3D11DeviceContext* pContext)
+{
+    pContext->CopyResource(pReadback_, pIdTexture_);
+    isPending_ = true;
+
+    // restore the pipeline
+    pContext->OMSetRenderTargets(1, &pPrevRTV_, pPrevDSV_);
+    pContext->RSSetViewports(numPrevViewports_, &prevViewport_);
+
+    // OMGetRenderTargets() increments ref counters
+    SafeRelease(&pPrevRTV_);
+    SafeRelease(&pPrevDSV_);
+}
+
+///////////////////////////////////////////////////////////
+
+bool EntityIdBuffer::ReadBack(ID3D11DeviceContext* pContext, EntityID& outEnttID)
+{
+    if (!isPending_)
+        return false;
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    const HRESULT hr = pContext->Map(pReadback_, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+
+    if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+        return false;
+
+    isPending_ = false;
+
+    if (FAILED(hr))
+    {
+        LogErr("can't map the entity IDs readback texture");
+        return false;
+    }
+
+    outEnttID = *(const uint32_t*)mapped.pData;
+    pContext->Unmap(pReadback_, 0);
+
+    return true;
+}
+
+
+// =================================================================================
+// PRIVATE HELPERS
+// =================================================================================
+void EntityIdBuffer::CreateResources(ID3D11Device* pDevice)
+{
+    // create a 1x1 ID target, its depth buffer and a staging texture for reading back
+
+    D3D11_TEXTURE2D_DESC desc;
+    desc.Width              = 1;
+    desc.Height             = 1;
+    desc.MipLevels          = 1;
+    desc.ArraySize          = 1;
+    desc.Format             = DXGI_FORMAT_R32_UINT;
+    desc.SampleDesc.Count   = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Usage              = D3D11_USAGE_DEFAULT;
+    desc.BindFlags          = D3D11_BIND_RENDER_TARGET;
+    desc.CPUAccessFlags     = 0;
+    desc.MiscFlags          = 0;
+
+    HRESULT hr = pDevice->CreateTexture2D(&desc, nullptr, &pIdTexture_);
+    CAssert::NotFailed(hr, "can't create a texture for entity IDs");
+
+    hr = pDevice->CreateRenderTargetView(pIdTexture_, nullptr, &pIdRTV_);
+    CAssert::NotFailed(hr, "can't create a RTV for entity IDs");
+
+    // depth
+    desc.Format    = DXGI_FORMAT_D32_FLOAT;
+    desc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+
+    hr = pDevice->CreateTexture2D(&desc, nullptr, &pDepthTexture_);
+    CAssert::NotFailed(hr, "can't create a depth texture for entity IDs");
+
+    hr = pDevice->CreateDepthStencilView(pDepthTexture_, nullptr, &pDepthDSV_);
+    CAssert::NotFailed(hr, "can't create a DSV for entity IDs");
+
+    // staging
+    desc.Format         = DXGI_FORMAT_R32_UINT;
+    desc.Usage          = D3D11_USAGE_STAGING;
+    desc.BindFlags      = 0;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+    hr = pDevice->CreateTexture2D(&desc, nullptr, &pReadback_);
+    CAssert::NotFailed(hr, "can't create a staging texture for entity IDs");
+}
+
+} // namespace Render
@@ -0,0 +1,125 @@
+// =================================================================================
+// Filename:     EntityIdBuffer.h
+// Description:  GPU picking: an optional pass which writes entity IDs into
+//               an R32_UINT target by the same instanced draws as the main pass:
+//
+//               - the pass runs only on frames where a pick was requested;
+//               - the projection is narrowed to the picked pixel so the target
+//                 (and its depth buffer) are only 1x1;
+//               - alpha clipped instances are clipped by the diffuse alpha
+//                 so picking is pixel-accurate for foliage, fences, etc.;
+//               - the result is copied into a staging texture and read back
+//                 without stall (as a rule in the next frame)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/VertexShader.h"
+#include "Shaders/PixelShader.h"
+#include "Shaders/SamplerState.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "Common/RenderTypes.h"
+#include "StateCache.h"
+#include "GpuCulling.h"
+
+#include <Types.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+class EntityIdBuffer
+{
+public:
+    // slots of resources (must be the same as in EntityIdVS/PS.hlsl); they don't
+    // overlap slots which are bound once per frame (const buffers, sky cube map)
+    static constexpr UINT CONST_BUFFER_SLOT = 11;
+    static constexpr UINT DIFFUSE_MAP_SLOT  = 1;
+    static constexpr UINT SAMPLER_SLOT      = 2;
+
+    EntityIdBuffer() {}
+    ~EntityIdBuffer();
+
+    // restrict a copying of this class instance
+    EntityIdBuffer(const EntityIdBuffer&) = delete;
+    EntityIdBuffer& operator=(const EntityIdBuffer&) = delete;
+
+    bool Initialize(
+        ID3D11Device* pDevice,
+        const char* vsFilePath,
+        const char* psFilePath);
+
+    void Shutdown();
+
+    // bind the 1x1 ID target and setup the projection for the pixel (sx, sy);
+    // NOTE: output merger targets and viewport are restored by End()
+    void Begin(
+        ID3D11DeviceContext* pContext,
+        const int sx,
+        const int sy,
+        const float screenWidth,
+        const float screenHeight,
+        const DirectX::XMMATRIX& viewProj);     // NOT transposed
+
+    // render instances by the same instance buffer as the main pass
+    void Render(
+        ID3D11DeviceContext* pContext,
+        ID3D11Buffer* pInstancedBuffer,
+        const Instance* instances,
+        const int numInstances,
+        const UINT instancesBuffElemSize,
+        const UINT baseInstance,
+        const bool alphaClipping);
+
+    // render opaque instances which were culled on the GPU (see GpuCulling)
+    void RenderIndirect(
+        ID3D11DeviceContext* pContext,
+        ID3D11Buffer* pVisibleInstancesBuffer,
+        ID3D11Buffer* pArgsBuffer,
+        const Instance* instances,
+        const GpuDraw* draws,
+        const int numDraws,
+        const UINT instancesBuffElemSize);
+
+    // enqueue a copy of the result for reading back and restore the pipeline
+    void End(ID3D11DeviceContext* pContext);
+
+    // get ID of the entity under the picked pixel if the GPU already finished
+    // with it (0 if there was no entity); never waits for the GPU
+    bool ReadBack(ID3D11DeviceContext* pContext, EntityID& outEnttID);
+
+    inline bool IsInitialized() const { return pReadback_ != nullptr; }
+    inline bool IsPending()     const { return isPending_; }
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+private:
+    void CreateResources(ID3D11Device* pDevice);
+
+private:
+    VertexShader                        vs_;
+    PixelShader                         ps_;
+    SamplerState                        samplerState_;
+    ConstantBuffer<ConstBufType::cbEntityIds> cbEntityIds_;
+
+    ID3D11Texture2D*                    pIdTexture_    = nullptr;
+    ID3D11RenderTargetView*             pIdRTV_        = nullptr;
+    ID3D11Texture2D*                    pDepthTexture_ = nullptr;
+    ID3D11DepthStencilView*             pDepthDSV_     = nullptr;
+    ID3D11Texture2D*                    pReadback_     = nullptr;
+
+    // pipeline state which is restored after the pass
+    ID3D11RenderTargetView*             pPrevRTV_      = nullptr;
+    ID3D11DepthStencilView*             pPrevDSV_      = nullptr;
+    D3D11_VIEWPORT                      prevViewport_;
+    UINT                                numPrevViewports_ = 0;
+
+    StateCache*                         pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
+    bool                                isPending_ = false;
+};
+
+} // namespace Render
@@ -0,0 +1,113 @@
+// =================================================================================
+// Filename:     FrameStats.cpp
+// Description:  implementation of the FrameStats's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "FrameStats.h"
+
+
+namespace Render
+{
+
+FrameStats g_FrameStats;
+
+static const char* s_UploadTypeNames[NUM_UPLOAD_TYPES] =
+{
+    "const buffers",
+    "const buffer ring",
+    "instances",
+    "transient VB",
+    "transient IB",
+};
+
+//---------------------------------------------------------
+// Desc:   the number of primitives which are assembled from numVertices
+//         (vertices or indices) by the topology
+//---------------------------------------------------------
+static uint64 GetNumPrimitives(const UINT numVertices, const D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+    switch (topology)
+    {
+        case D3D11_PRIMITIVE_TOPOLOGY_POINTLIST:      return numVertices;
+        case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:       return numVertices / 2;
+        case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP:      return (numVertices > 1) ? numVertices - 1 : 0;
+        case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:  return (numVertices > 2) ? numVertices - 2 : 0;
+
+        // patches: 32 control point patch lists follow each other in the enum
+        default:
+        {
+            if ((topology >= D3D11_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST) &&
+                (topology <= D3D11_PRIMITIVE_TOPOLOGY_32_CONTROL_POINT_PATCHLIST))
+            {
+                const UINT numControlPoints = 1 + (topology - D3D11_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST);
+                return numVertices / numControlPoints;
+            }
+
+            // a triangle list (the topology of deferred contexts isn't shadowed)
+            return numVertices / 3;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void FrameStats::AddDraw(
+    const UINT numVertices,
+    const UINT numInstances,
+    const D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+    PassCounters& pass = passes_[currPass_.load(std::memory_order_relaxed)];
+
+    pass.numDraws.fetch_add(1, std::memory_order_relaxed);
+    pass.numInstances.fetch_add(numInstances, std::memory_order_relaxed);
+    pass.numPrimitives.fetch_add(GetNumPrimitives(numVertices, topology) * numInstances, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////
+
+void FrameStats::AddIndirectDraw()
+{
+    PassCounters& pass = passes_[currPass_.load(std::memory_order_relaxed)];
+
+    pass.numDraws.fetch_add(1, std::memory_order_relaxed);
+    pass.numIndirect.fetch_add(1, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////
+
+void FrameStats::EndFrame()
+{
+    lastFrame_.total = PassDrawStats();
+
+    for (int i = 0; i <= NUM_GPU_PASSES; ++i)
+    {
+        PassDrawStats& dst = lastFrame_.passes[i];
+        PassCounters&  src = passes_[i];
+
+        dst.numDraws      = src.numDraws.exchange(0, std::memory_order_relaxed);
+        dst.numIndirect   = src.numIndirect.exchange(0, std::memory_order_relaxed);
+        dst.numInstances  = src.numInstances.exchange(0, std::memory_order_relaxed);
+        dst.numPrimitives = src.numPrimitives.exchange(0, std::memory_order_relaxed);
+
+        lastFrame_.total.numDraws      += dst.numDraws;
+        lastFrame_.total.numIndirect   += dst.numIndirect;
+        lastFrame_.total.numInstances  += dst.numInstances;
+        lastFrame_.total.numPrimitives += dst.numPrimitives;
+    }
+
+    for (int i = 0; i < NUM_UPLOAD_TYPES; ++i)
+    {
+        lastFrame_.uploadBytes[i] = uploadBytes_[i].exchange(0, std::memory_order_relaxed);
+        lastFrame_.numMaps[i]     = numMaps_[i].exchange(0, std::memory_order_relaxed);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+const char* FrameStats::GetUploadTypeName(const eUploadType type)
+{
+    return s_UploadTypeNames[type];
+}
+
+} // namespace Render
@@ -0,0 +1,114 @@
+// =================================================================================
+// Filename:     FrameStats.h
+// Description:  counters of the render workload of a frame: draw calls, instances
+//               and primitives of each render pass (a pass is the one which is
+//               measured by the GpuProfiler), and mapped bytes of each type of
+//               buffers;
+//
+//               draws are counted by the StateCache, uploads by their buffers;
+//               deferred contexts can record draws on worker threads so the
+//               counters are atomic; at the end of the frame the counters
+//               become stats of the last frame
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "GpuProfiler.h"
+#include <Types.h>
+#include <d3d11.h>
+#include <atomic>
+
+
+namespace Render
+{
+
+enum eUploadType
+{
+    UPLOAD_CONST_BUFFER,             // Map(DISCARD) of a constant buffer of a shader
+    UPLOAD_CB_RING,                  // per-draw constants of the ConstBufferRing
+    UPLOAD_INSTANCES,                // instances of the InstanceRing
+    UPLOAD_TRANSIENT_VB,             // dynamic geometry of the TransientAllocator
+    UPLOAD_TRANSIENT_IB,
+
+    NUM_UPLOAD_TYPES,
+};
+
+///////////////////////////////////////////////////////////
+
+struct PassDrawStats
+{
+    uint32 numDraws      = 0;
+    uint32 numIndirect   = 0;        // indirect draws (their instances/primitives are unknown on the CPU)
+    uint32 numInstances  = 0;
+    uint64 numPrimitives = 0;        // triangles (or lines/points) by the topology of the draw
+};
+
+///////////////////////////////////////////////////////////
+
+struct FrameStatsData
+{
+    static constexpr int PASS_NONE = NUM_GPU_PASSES;     // draws outside of measured passes
+
+    PassDrawStats passes[NUM_GPU_PASSES + 1];
+    PassDrawStats total;
+
+    uint64        uploadBytes[NUM_UPLOAD_TYPES]{ 0 };
+    uint32        numMaps[NUM_UPLOAD_TYPES]{ 0 };
+};
+
+///////////////////////////////////////////////////////////
+
+class FrameStats
+{
+public:
+    FrameStats() {}
+
+    // restrict a copying of this class instance
+    FrameStats(const FrameStats&) = delete;
+    FrameStats& operator=(const FrameStats&) = delete;
+
+    // draws are counted into this pass (is set by the GpuProfiler for passes of the immediate context)
+    inline void BeginPass(const eGpuPass pass) { currPass_.store((int)pass, std::memory_order_relaxed); }
+    inline void EndPass()                      { currPass_.store(FrameStatsData::PASS_NONE, std::memory_order_relaxed); }
+
+    void AddDraw(const UINT numVertices, const UINT numInstances, const D3D11_PRIMITIVE_TOPOLOGY topology);
+    void AddIndirectDraw();
+
+    inline void AddUpload(const eUploadType type, const uint64 numBytes)
+    {
+        uploadBytes_[type].fetch_add(numBytes, std::memory_order_relaxed);
+        numMaps_[type].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // counters of this frame become stats of the last frame
+    void EndFrame();
+
+    inline const FrameStatsData& GetLastFrame() const { return lastFrame_; }
+
+    static const char* GetUploadTypeName(const eUploadType type);
+
+private:
+    struct PassCounters
+    {
+        std::atomic<uint32> numDraws      = 0;
+        std::atomic<uint32> numIndirect   = 0;
+        std::atomic<uint32> numInstances  = 0;
+        std::atomic<uint64> numPrimitives = 0;
+    };
+
+    std::atomic<int>    currPass_ = FrameStatsData::PASS_NONE;
+    PassCounters        passes_[NUM_GPU_PASSES + 1];
+    std::atomic<uint64> uploadBytes_[NUM_UPLOAD_TYPES]{};
+    std::atomic<uint32> numMaps_[NUM_UPLOAD_TYPES]{};
+
+    FrameStatsData      lastFrame_;
+};
+
+
+// =================================================================================
+// a global instance of the frame stats
+// =================================================================================
+extern FrameStats g_FrameStats;
+
+} // namespace Render
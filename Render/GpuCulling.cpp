@@ -0,0 +1,412 @@
+// =================================================================================
+// Filename:     GpuCulling.cpp
+// Description:  implementation of the GpuCulling's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "GpuCulling.h"
+#include <MemHelpers.h>
+#include <MathHelper.h>
+#include <log.h>
+#include <CAssert.h>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+// the culling shader copies records by 16 bytes
+static_assert(GpuCulling::INSTANCE_SIZE % 16 == 0, "size of the instance record must be a multiple of 16");
+static_assert(sizeof(GpuInstanceBounds) == 32,     "size of bounds must be the same as in GpuCullCS.hlsl");
+static_assert(sizeof(GpuCluster) == 32,            "size of clusters must be the same as in GpuCullCS.hlsl");
+
+//---------------------------------------------------------
+// Desc:   create a DEFAULT structured buffer and its SRV
+//---------------------------------------------------------
+static void CreateStructuredBuffer(
+    ID3D11Device* pDevice,
+    const UINT numElems,
+    const UINT stride,
+    ID3D11Buffer** ppBuffer,
+    ID3D11ShaderResourceView** ppSRV)
+{
+    D3D11_BUFFER_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+
+    desc.Usage               = D3D11_USAGE_DEFAULT;
+    desc.ByteWidth           = numElems * stride;
+    desc.BindFlags           = D3D11_BIND_SHADER_RESOURCE;
+    desc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    desc.StructureByteStride = stride;
+
+    HRESULT hr = pDevice->CreateBuffer(&desc, nullptr, ppBuffer);
+    CAssert::NotFailed(hr, "can't create a structured buffer");
+
+    hr = pDevice->CreateShaderResourceView(*ppBuffer, nullptr, ppSRV);
+    CAssert::NotFailed(hr, "can't create a SRV of structured buffer");
+}
+
+//---------------------------------------------------------
+// Desc:   create a DEFAULT buffer which is accessed through raw views
+//---------------------------------------------------------
+static HRESULT CreateRawBuffer(
+    ID3D11Device* pDevice,
+    const UINT byteWidth,
+    const UINT bindFlags,
+    const UINT miscFlags,
+    const void* initData,
+    ID3D11Buffer** ppBuffer)
+{
+    D3D11_BUFFER_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+
+    desc.Usage     = D3D11_USAGE_DEFAULT;
+    desc.ByteWidth = byteWidth;
+    desc.BindFlags = bindFlags;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS | miscFlags;
+
+    D3D11_SUBRESOURCE_DATA data = { initData, 0, 0 };
+
+    return pDevice->CreateBuffer(&desc, (initData) ? &data : nullptr, ppBuffer);
+}
+
+//---------------------------------------------------------
+// Desc:   create a raw SRV or UAV of the whole buffer
+//---------------------------------------------------------
+static HRESULT CreateRawSRV(ID3D11Device* pDevice, ID3D11Buffer* pBuffer, const UINT byteWidth, ID3D11ShaderResourceView** ppSRV)
+{
+    D3D11_SHADER_RESOURCE_VIEW_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+
+    desc.Format                = DXGI_FORMAT_R32_TYPELESS;
+    desc.ViewDimension         = D3D11_SRV_DIMENSION_BUFFEREX;
+    desc.BufferEx.FirstElement = 0;
+    desc.BufferEx.NumElements  = byteWidth / 4;
+    desc.BufferEx.Flags        = D3D11_BUFFEREX_SRV_FLAG_RAW;
+
+    return pDevice->CreateShaderResourceView(pBuffer, &desc, ppSRV);
+}
+
+static HRESULT CreateRawUAV(ID3D11Device* pDevice, ID3D11Buffer* pBuffer, const UINT byteWidth, ID3D11UnorderedAccessView** ppUAV)
+{
+    D3D11_UNORDERED_ACCESS_VIEW_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+
+    desc.Format              = DXGI_FORMAT_R32_TYPELESS;
+    desc.ViewDimension       = D3D11_UAV_DIMENSION_BUFFER;
+    desc.Buffer.FirstElement = 0;
+    desc.Buffer.NumElements  = byteWidth / 4;
+    desc.Buffer.Flags        = D3D11_BUFFER_UAV_FLAG_RAW;
+
+    return pDevice->CreateUnorderedAccessView(pBuffer, &desc, ppUAV);
+}
+
+///////////////////////////////////////////////////////////
+
+GpuCulling::~GpuCulling()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool GpuCulling::Initialize(ID3D11Device* pDevice, const char* shaderPath)
+{
+    if (!cullCS_.Initialize(pDevice, shaderPath))
+    {
+        LogErr("can't initialize a compute shader for GPU culling");
+        return false;
+    }
+
+    if (FAILED(cbCull_.Initialize(pDevice)))
+    {
+        LogErr("can't initialize a const buffer for GPU culling");
+        cullCS_.Shutdown();
+        return false;
+    }
+
+    isInit_ = true;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuCulling::Shutdown()
+{
+    ReleaseBuffers();
+    cullCS_.Shutdown();
+
+    instances_.clear();
+    draws_.clear();
+    isInit_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuCulling::ReleaseBuffers()
+{
+    SafeRelease(&pRecordsSRV_);
+    SafeRelease(&pRecords_);
+    SafeRelease(&pBoundsSRV_);
+    SafeRelease(&pBounds_);
+    SafeRelease(&pClustersSRV_);
+    SafeRelease(&pClusters_);
+    SafeRelease(&pArgsInit_);
+    SafeRelease(&pArgsUAV_);
+    SafeRelease(&pArgs_);
+    SafeRelease(&pVisibleUAV_);
+    SafeRelease(&pVisible_);
+
+    recordsCapacity_  = 0;
+    drawsCapacity_    = 0;
+    visibleCapacity_  = 0;
+    clustersCapacity_ = 0;
+    numRecords_       = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+bool GpuCulling::CreateBuffers(
+    ID3D11Device* pDevice,
+    const UINT numRecords,
+    const UINT numDraws,
+    const UINT visibleCapacity,
+    const UINT numClusters)
+{
+    // (re)create buffers if the scene doesn't fit into them any more;
+    // capacities grow in 1.5 times so small changes of the scene don't cause it
+
+    try
+    {
+        HRESULT hr = S_OK;
+
+        if (numRecords > recordsCapacity_)
+        {
+            const UINT capacity = numRecords + numRecords / 2;
+
+            SafeRelease(&pRecordsSRV_);
+            SafeRelease(&pRecords_);
+            SafeRelease(&pBoundsSRV_);
+            SafeRelease(&pBounds_);
+            recordsCapacity_ = 0;
+
+            hr = CreateRawBuffer(pDevice, capacity * INSTANCE_SIZE, D3D11_BIND_SHADER_RESOURCE, 0, nullptr, &pRecords_);
+            CAssert::NotFailed(hr, "can't create a buffer of instance records");
+
+            hr = CreateRawSRV(pDevice, pRecords_, capacity * INSTANCE_SIZE, &pRecordsSRV_);
+            CAssert::NotFailed(hr, "can't create a SRV of instance records");
+
+            CreateStructuredBuffer(pDevice, capacity, sizeof(GpuInstanceBounds), &pBounds_, &pBoundsSRV_);
+
+            recordsCapacity_ = capacity;
+        }
+
+        if (numClusters > clustersCapacity_)
+        {
+            const UINT capacity = numClusters + numClusters / 2;
+
+            SafeRelease(&pClustersSRV_);
+            SafeRelease(&pClusters_);
+            clustersCapacity_ = 0;
+
+            CreateStructuredBuffer(pDevice, capacity, sizeof(GpuCluster), &pClusters_, &pClustersSRV_);
+
+            clustersCapacity_ = capacity;
+        }
+
+        if (numDraws > drawsCapacity_)
+        {
+            const UINT capacity  = numDraws + numDraws / 2;
+            const UINT byteWidth = capacity * ARGS_STRIDE;
+
+            SafeRelease(&pArgsInit_);
+            SafeRelease(&pArgsUAV_);
+            SafeRelease(&pArgs_);
+            drawsCapacity_ = 0;
+
+            // both buffers have the same desc so one can be copied into another
+            const UINT bindFlags = D3D11_BIND_UNORDERED_ACCESS;
+            const UINT miscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+
+            hr = CreateRawBuffer(pDevice, byteWidth, bindFlags, miscFlags, nullptr, &pArgs_);
+            CAssert::NotFailed(hr, "can't create a buffer of indirect args");
+
+            hr = CreateRawBuffer(pDevice, byteWidth, bindFlags, miscFlags, nullptr, &pArgsInit_);
+            CAssert::NotFailed(hr, "can't create a buffer of initial indirect args");
+
+            hr = CreateRawUAV(pDevice, pArgs_, byteWidth, &pArgsUAV_);
+            CAssert::NotFailed(hr, "can't create a UAV of indirect args");
+
+            drawsCapacity_ = capacity;
+        }
+
+        if (visibleCapacity > visibleCapacity_)
+        {
+            const UINT capacity  = visibleCapacity + visibleCapacity / 2;
+            const UINT byteWidth = capacity * INSTANCE_SIZE;
+
+            SafeRelease(&pVisibleUAV_);
+            SafeRelease(&pVisible_);
+            visibleCapacity_ = 0;
+
+            hr = CreateRawBuffer(pDevice, byteWidth, D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_UNORDERED_ACCESS, 0, nullptr, &pVisible_);
+            CAssert::NotFailed(hr, "can't create a buffer of visible instances");
+
+            hr = CreateRawUAV(pDevice, pVisible_, byteWidth, &pVisibleUAV_);
+            CAssert::NotFailed(hr, "can't create a UAV of visible instances");
+
+            visibleCapacity_ = capacity;
+        }
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't create buffers for GPU culling");
+        ReleaseBuffers();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuCulling::Upload(
+    ID3D11DeviceContext* pContext,
+    const InstBuffData& data,
+    const GpuInstanceBounds* bounds,
+    const cvector<Instance>& instances,
+    const cvector<GpuDraw>& draws,
+    const cvector<GpuCluster>& clusters)
+{
+    numRecords_ = 0;
+    instances_.clear();
+    draws_.clear();
+
+    const UINT numRecords  = (UINT)data.GetSize();
+    const UINT numDraws    = (UINT)draws.size();
+    const UINT numClusters = (UINT)clusters.size();
+
+    if ((numRecords == 0) || (numDraws == 0))
+        return;
+
+    CAssert::True(bounds != nullptr, "input ptr to bounds arr == nullptr");
+
+    // each draw reserves a range for all the instances of its geometry
+    cvector<UINT> args(numDraws * NUM_ARGS);
+    UINT visibleCapacity = 0;
+
+    for (UINT i = 0; i < numDraws; ++i)
+    {
+        const GpuDraw& draw = draws[i];
+        UINT*          arg  = args.data() + i * NUM_ARGS;
+
+        arg[0] = draw.indexCount;
+        arg[1] = 0;                            // instance count (is written by the culling)
+        arg[2] = draw.startIndex;
+        arg[3] = (UINT)draw.baseVertex;
+        arg[4] = visibleCapacity;              // start instance location
+
+        visibleCapacity += (UINT)instances[draw.instanceIdx].numInstances;
+    }
+
+    ID3D11Device* pDevice = nullptr;
+    pContext->GetDevice(&pDevice);
+    const bool result = CreateBuffers(pDevice, numRecords, numDraws, visibleCapacity, numClusters);
+    SafeRelease(&pDevice);
+
+    if (!result)
+        return;
+
+    // pack instance records in the same way as the instances ring does
+    cvector<ConstBufType::InstancedData> records(numRecords);
+
+    for (UINT i = 0; i < numRecords; ++i)
+    {
+        ConstBufType::PackInstance(
+            records[i],
+            data.worlds_[i],
+            data.texTransforms_[i],
+            data.materialIdxs_[i],
+            (data.enttIds_) ? data.enttIds_[i] : 0);
+    }
+
+    D3D11_BOX box = { 0, 0, 0, 0, 1, 1 };
+
+    box.right = numRecords * INSTANCE_SIZE;
+    pContext->UpdateSubresource(pRecords_, 0, &box, records.data(), 0, 0);
+
+    box.right = numRecords * sizeof(GpuInstanceBounds);
+    pContext->UpdateSubresource(pBounds_, 0, &box, bounds, 0, 0);
+
+    box.right = numDraws * ARGS_STRIDE;
+    pContext->UpdateSubresource(pArgsInit_, 0, &box, args.data(), 0, 0);
+
+    if (numClusters > 0)
+    {
+        box.right = numClusters * sizeof(GpuCluster);
+        pContext->UpdateSubresource(pClusters_, 0, &box, clusters.data(), 0, 0);
+    }
+
+    instances_  = instances;
+    draws_      = draws;
+    numRecords_ = numRecords;
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuCulling::Cull(
+    ID3D11DeviceContext* pContext,
+    const GpuCullParams& params,
+    const HiZBuffer& hiZ)
+{
+    if (!isInit_ || !HasScene())
+        return;
+
+    // reset instance counts of all the draws
+    pContext->CopyResource(pArgs_, pArgsInit_);
+
+    ConstBufType::cbcsGpuCull& cb = cbCull_.data;
+
+    for (int i = 0; i < 6; ++i)
+        cb.planes[i] = params.planes[i];
+
+    cb.cameraPos        = params.cameraPos;
+    cb.numInstances     = numRecords_;
+    cb.lodScreenSizesSq = XMFLOAT4(
+        params.lodScreenSizes[0] * params.lodScreenSizes[0],
+        params.lodScreenSizes[1] * params.lodScreenSizes[1],
+        params.lodScreenSizes[2] * params.lodScreenSizes[2],
+        0.0f);
+    cb.projScaleYSq     = params.projScaleY * params.projScaleY;
+
+    // occlusion test is done only if the pyramid was already built
+    const bool useHiZ = params.useHiZ && hiZ.IsGpuReady();
+
+    cb.hiZViewProj  = XMMatrixTranspose(hiZ.GetGpuViewProj());
+    cb.hiZNumLevels = (useHiZ) ? (uint32_t)hiZ.GetNumGpuLevels() : 0;
+    cb.depthSize[0] = hiZ.GetDepthWidth();
+    cb.depthSize[1] = hiZ.GetDepthHeight();
+    cbCull_.ApplyChanges(pContext);
+
+    ID3D11ShaderResourceView*  srvs[4] = { pRecordsSRV_, pBoundsSRV_, (useHiZ) ? hiZ.GetPyramidSRV() : nullptr, pClustersSRV_ };
+    ID3D11UnorderedAccessView* uavs[2] = { pArgsUAV_, pVisibleUAV_ };
+
+    pContext->CSSetShader(cullCS_.GetShader(), nullptr, 0);
+    pContext->CSSetConstantBuffers(0, 1, cbCull_.GetAddressOf());
+    pContext->CSSetShaderResources(0, 4, srvs);
+    pContext->CSSetUnorderedAccessViews(0, 2, uavs, nullptr);
+
+    pContext->Dispatch((numRecords_ + THREADS_NUM - 1) / THREADS_NUM, 1, 1);
+
+    // unbind so the results can be used as args and vertex buffer
+    ID3D11ShaderResourceView*  nullSRVs[4] = { nullptr, nullptr, nullptr, nullptr };
+    ID3D11UnorderedAccessView* nullUAVs[2] = { nullptr, nullptr };
+
+    pContext->CSSetShaderResources(0, 4, nullSRVs);
+    pContext->CSSetUnorderedAccessViews(0, 2, nullUAVs, nullptr);
+    pContext->CSSetShader(nullptr, nullptr, 0);
+}
+
+} // namespace Render
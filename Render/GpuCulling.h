@@ -0,0 +1,173 @@
+// =================================================================================
+// Filename:     GpuCulling.h
+// Description:  GPU-driven rendering of the opaque pass:
+//
+//               - instance records (the same layout as ConstBufType::InstancedData)
+//                 and their world bounds are uploaded once and are kept on the GPU
+//                 (they are re-uploaded only when the scene is changed);
+//               - each frame a compute shader tests each record against the frustum
+//                 and the Hi-Z pyramid, selects its LOD and appends the record into
+//                 a range of the visible instances buffer of its (subset, LOD) draw;
+//               - the instance counts of draws are written directly into an args
+//                 buffer which is consumed by DrawIndexedInstancedIndirect() so
+//                 the CPU never reads the culling result back;
+//               - the visible instances buffer is bound as the per-instance vertex
+//                 stream so the usual light shader input layout is used as is;
+//               - LOD 0 of a big subset is split into clusters (meshlets) with a draw
+//                 per each: if a record gets LOD 0 its clusters are tested one by one
+//                 (frustum, backfacing normal cone, Hi-Z) and the record is appended
+//                 only into draws of its visible clusters
+//
+//               NOTE: each draw reserves space for all the records of its instance
+//                     (any of them can get this LOD) so the visible buffer is up to
+//                     MAX_NUM_MESH_LODS times bigger than the records buffer
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/ComputeShader.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "Common/RenderTypes.h"
+#include "HiZBuffer.h"
+
+#include <Types.h>
+#include <cvector.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+// world bounds of a single instance record (must be the same as in GpuCullCS.hlsl)
+struct GpuInstanceBounds
+{
+    DirectX::XMFLOAT3 center;
+    float             radius       = 0;
+    uint32            drawIdx      = 0;    // the draw of LOD 0 or of the first cluster
+    uint32            numLods      = 1;    // draws of LOD i > 0 go after draws of LOD 0 (or of clusters)
+    uint32            clusterStart = 0;    // clusters of LOD 0 (0: LOD 0 is a single draw)
+    uint32            numClusters  = 0;
+};
+
+// bounds of a cluster of LOD 0 in model space (see Meshlet)
+struct GpuCluster
+{
+    DirectX::XMFLOAT3 center;
+    float             radius     = 0;
+    DirectX::XMFLOAT3 coneAxis;
+    float             coneCutoff = 1;      // 1: is never backfacing
+};
+
+// an indirect draw of a single (instance, subset, LOD)
+struct GpuDraw
+{
+    UINT indexCount  = 0;
+    UINT startIndex  = 0;
+    INT  baseVertex  = 0;
+    int  instanceIdx = 0;                  // instance (buffers, textures) of the draw
+    int  subsetIdx   = 0;
+};
+
+// params of culling for the current frame
+struct GpuCullParams
+{
+    DirectX::XMFLOAT4 planes[6];           // world frustum planes (normals look inside)
+    DirectX::XMFLOAT3 cameraPos;
+    float             projScaleY = 0;      // proj[1][1] * 0.5
+    float             lodScreenSizes[3]{ 0 };
+    bool              useHiZ     = false;
+};
+
+///////////////////////////////////////////////////////////
+
+class GpuCulling
+{
+public:
+    static constexpr UINT NUM_ARGS       = 5;                   // D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS
+    static constexpr UINT ARGS_STRIDE    = NUM_ARGS * sizeof(UINT);
+    static constexpr UINT INSTANCE_SIZE  = sizeof(ConstBufType::InstancedData);
+    static constexpr UINT THREADS_NUM    = 64;                  // the group size of the culling shader
+
+    GpuCulling() {}
+    ~GpuCulling();
+
+    // restrict a copying of this class instance
+    GpuCulling(const GpuCulling&) = delete;
+    GpuCulling& operator=(const GpuCulling&) = delete;
+
+    bool Initialize(ID3D11Device* pDevice, const char* shaderPath);
+    void Shutdown();
+
+    // upload instance records of the scene along with their bounds and draws;
+    // data of instance i subset s goes by numInstances records (the same order as
+    // in the instanced buffer), draws of each (instance, subset) go by its clusters
+    // (if there are) and LODs
+    void Upload(
+        ID3D11DeviceContext* pContext,
+        const InstBuffData& data,
+        const GpuInstanceBounds* bounds,
+        const cvector<Instance>& instances,
+        const cvector<GpuDraw>& draws,
+        const cvector<GpuCluster>& clusters);
+
+    // reset instance counts of draws and cull all the records into them
+    void Cull(
+        ID3D11DeviceContext* pContext,
+        const GpuCullParams& params,
+        const HiZBuffer& hiZ);
+
+    inline bool IsInitialized() const { return isInit_; }
+    inline bool HasScene()      const { return (numRecords_ > 0) && !draws_.empty(); }
+
+    inline ID3D11Buffer*            GetArgsBuffer()    const { return pArgs_; }
+    inline ID3D11Buffer*            GetVisibleBuffer() const { return pVisible_; }
+    inline const cvector<Instance>& GetInstances()     const { return instances_; }
+    inline const cvector<GpuDraw>&  GetDraws()         const { return draws_; }
+
+private:
+    void ReleaseBuffers();
+    bool CreateBuffers(
+        ID3D11Device* pDevice,
+        const UINT numRecords,
+        const UINT numDraws,
+        const UINT visibleCapacity,
+        const UINT numClusters);
+
+private:
+    ComputeShader                             cullCS_;
+    ConstantBuffer<ConstBufType::cbcsGpuCull> cbCull_;
+
+    // persistent scene data
+    ID3D11Buffer*               pRecords_     = nullptr;    // raw: instance records
+    ID3D11ShaderResourceView*   pRecordsSRV_  = nullptr;
+    ID3D11Buffer*               pBounds_      = nullptr;    // structured: GpuInstanceBounds
+    ID3D11ShaderResourceView*   pBoundsSRV_   = nullptr;
+    ID3D11Buffer*               pClusters_    = nullptr;    // structured: GpuCluster
+    ID3D11ShaderResourceView*   pClustersSRV_ = nullptr;
+
+    // args of draws with zero instance counts (are copied into pArgs_ each frame)
+    ID3D11Buffer*               pArgsInit_    = nullptr;
+
+    // results of culling
+    ID3D11Buffer*               pArgs_        = nullptr;    // raw: DrawIndexedInstancedIndirect args
+    ID3D11UnorderedAccessView*  pArgsUAV_     = nullptr;
+    ID3D11Buffer*               pVisible_     = nullptr;    // raw: compacted visible records (is bound as VB)
+    ID3D11UnorderedAccessView*  pVisibleUAV_  = nullptr;
+
+    UINT                        recordsCapacity_  = 0;
+    UINT                        drawsCapacity_    = 0;
+    UINT                        visibleCapacity_  = 0;
+    UINT                        clustersCapacity_ = 0;
+    UINT                        numRecords_       = 0;
+
+    // instances and draws for rendering (the same order as in the args buffer)
+    cvector<Instance>           instances_;
+    cvector<GpuDraw>            draws_;
+
+    bool                        isInit_ = false;
+};
+
+} // namespace Render
@@ -0,0 +1,612 @@
+// =================================================================================
+// Filename:     GpuParticles.cpp
+// Description:  implementation of the GpuParticles' functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "GpuParticles.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <cvector.h>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+static_assert(sizeof(GpuParticleEmitter) == 80,  "size of emitters must be the same as in ParticleEmitCS.hlsl");
+static_assert(sizeof(ConstBufType::cbParticles) % 16 == 0, "size of the const buffer must be a multiple of 16");
+
+// slots of resources (must be the same as in the particle shaders)
+static constexpr UINT CB_SLOT            = 6;      // VS, PS, emit/simulate CS (the sort CS has its own at b0)
+static constexpr UINT VS_PARTICLES_SLOT  = 12;     // + the sorted alive list at 13
+static constexpr UINT PS_DEPTH_SLOT      = 30;     // + textures at 31..34
+static constexpr UINT PS_SAMPLER_SLOT    = 3;
+
+static constexpr UINT NUM_DRAW_ARGS      = 4;      // D3D11_DRAW_INSTANCED_INDIRECT_ARGS
+
+//---------------------------------------------------------
+// Desc:   create a DEFAULT structured buffer along with its views
+//         (the UAV is created only if its flags aren't -1)
+//---------------------------------------------------------
+static void CreateStructuredBuffer(
+    ID3D11Device* pDevice,
+    const UINT numElems,
+    const UINT stride,
+    const void* initData,
+    const int uavFlags,
+    ID3D11Buffer** ppBuffer,
+    ID3D11ShaderResourceView** ppSRV,
+    ID3D11UnorderedAccessView** ppUAV)
+{
+    D3D11_BUFFER_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+
+    desc.Usage               = D3D11_USAGE_DEFAULT;
+    desc.ByteWidth           = numElems * stride;
+    desc.BindFlags           = D3D11_BIND_UNORDERED_ACCESS | ((ppSRV) ? D3D11_BIND_SHADER_RESOURCE : 0);
+    desc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    desc.StructureByteStride = stride;
+
+    D3D11_SUBRESOURCE_DATA data = { initData, 0, 0 };
+
+    HRESULT hr = pDevice->CreateBuffer(&desc, (initData) ? &data : nullptr, ppBuffer);
+    CAssert::NotFailed(hr, "can't create a structured buffer");
+
+    if (ppSRV)
+    {
+        hr = pDevice->CreateShaderResourceView(*ppBuffer, nullptr, ppSRV);
+        CAssert::NotFailed(hr, "can't create a SRV of structured buffer");
+    }
+
+    if (ppUAV && (uavFlags != -1))
+    {
+        D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+        ZeroMemory(&uavDesc, sizeof(uavDesc));
+
+        uavDesc.Format              = DXGI_FORMAT_UNKNOWN;
+        uavDesc.ViewDimension       = D3D11_UAV_DIMENSION_BUFFER;
+        uavDesc.Buffer.FirstElement = 0;
+        uavDesc.Buffer.NumElements  = numElems;
+        uavDesc.Buffer.Flags        = (UINT)uavFlags;
+
+        hr = pDevice->CreateUnorderedAccessView(*ppBuffer, &uavDesc, ppUAV);
+        CAssert::NotFailed(hr, "can't create a UAV of structured buffer");
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   the smallest power of 2 which is >= input value
+//---------------------------------------------------------
+static UINT NextPow2(const UINT value)
+{
+    UINT pow2 = 1;
+
+    while (pow2 < value)
+        pow2 <<= 1;
+
+    return pow2;
+}
+
+///////////////////////////////////////////////////////////
+
+GpuParticles::~GpuParticles()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool GpuParticles::Initialize(ID3D11Device* pDevice, const UINT maxParticles)
+{
+    try
+    {
+        CAssert::True(maxParticles > 0, "max number of particles must be > 0");
+
+        bool result = emitCS_.Initialize(pDevice, "shaders/ParticleEmitCS.cso");
+        CAssert::True(result, "can't initialize the particles emit shader");
+
+        result = simulateCS_.Initialize(pDevice, "shaders/ParticleSimulateCS.cso");
+        CAssert::True(result, "can't initialize the particles simulate shader");
+
+        result = sortLocalCS_.Initialize(pDevice, "shaders/ParticleSortLocalCS.cso");
+        CAssert::True(result, "can't initialize the particles local sort shader");
+
+        result = sortStepCS_.Initialize(pDevice, "shaders/ParticleSortStepCS.cso");
+        CAssert::True(result, "can't initialize the particles sort step shader");
+
+        // the vertex pulling VS has no input layout
+        result = vs_.Initialize(pDevice, "shaders/ParticleVS.cso", nullptr, 0);
+        CAssert::True(result, "can't initialize the particles vertex shader");
+
+        result = ps_.Initialize(pDevice, "shaders/ParticlePS.cso");
+        CAssert::True(result, "can't initialize the particles pixel shader");
+
+        // frames of flipbook atlases mustn't bleed into each other
+        D3D11_SAMPLER_DESC samplerDesc;
+        ZeroMemory(&samplerDesc, sizeof(samplerDesc));
+        samplerDesc.Filter         = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+        samplerDesc.AddressU       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressV       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressW       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+        samplerDesc.MaxLOD         = D3D11_FLOAT32_MAX;
+
+        result = samplerState_.Initialize(pDevice, &samplerDesc);
+        CAssert::True(result, "can't initialize the particles sampler state");
+
+        CAssert::NotFailed(cbParticles_.Initialize(pDevice), "can't initialize the particles const buffer");
+        CAssert::NotFailed(cbSort_.Initialize(pDevice),      "can't initialize the particles sort const buffer");
+
+        // the sort goes by blocks in groupshared memory so the capacity is at least a block
+        const UINT capacity = NextPow2((maxParticles < SORT_GROUP_SIZE) ? SORT_GROUP_SIZE : maxParticles);
+
+        CAssert::True(CreateBuffers(pDevice, capacity), "can't create buffers of particles");
+        CAssert::True(CreateStates(pDevice),            "can't create render states of particles");
+
+        capacity_       = capacity;
+        stats_.capacity = capacity;
+        isInit_         = true;
+
+        LogMsgf("GPU particles: capacity %u (%u KB)", capacity, (capacity * (PARTICLE_SIZE + 2 * SORT_ENTRY_SIZE + 4)) >> 10);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize GPU particles");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuParticles::Shutdown()
+{
+    ReleaseBuffers();
+
+    SafeRelease(&pBlendState_);
+    SafeRelease(&pDepthOffState_);
+    SafeRelease(&pDepthReadState_);
+    SafeRelease(&pRasterState_);
+
+    emitCS_.Shutdown();
+    simulateCS_.Shutdown();
+    sortLocalCS_.Shutdown();
+    sortStepCS_.Shutdown();
+    vs_.Shutdown();
+    ps_.Shutdown();
+
+    capacity_      = 0;
+    aliveTimeLeft_ = 0;
+    stats_         = GpuParticlesStats();
+    isInit_        = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuParticles::ReleaseBuffers()
+{
+    SafeRelease(&pParticlesUAV_);
+    SafeRelease(&pParticlesSRV_);
+    SafeRelease(&pParticles_);
+    SafeRelease(&pDeadListUAV_);
+    SafeRelease(&pDeadList_);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        SafeRelease(&pAliveSortUAVs_[i]);
+        SafeRelease(&pAliveAppendUAVs_[i]);
+        SafeRelease(&pAliveListSRVs_[i]);
+        SafeRelease(&pAliveLists_[i]);
+    }
+
+    SafeRelease(&pCountersSRV_);
+    SafeRelease(&pCounters_);
+    SafeRelease(&pDrawArgs_);
+    SafeRelease(&pEmittersSRV_);
+    SafeRelease(&pEmitters_);
+
+    isCountersInit_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+bool GpuParticles::CreateBuffers(ID3D11Device* pDevice, const UINT capacity)
+{
+    try
+    {
+        HRESULT hr = S_OK;
+
+        CreateStructuredBuffer(pDevice, capacity, PARTICLE_SIZE, nullptr, 0, &pParticles_, &pParticlesSRV_, &pParticlesUAV_);
+
+        // all the slots are free at the start
+        cvector<uint32> freeSlots(capacity);
+
+        for (UINT i = 0; i < capacity; ++i)
+            freeSlots[i] = i;
+
+        CreateStructuredBuffer(pDevice, capacity, sizeof(uint32), freeSlots.data(), D3D11_BUFFER_UAV_FLAG_APPEND, &pDeadList_, nullptr, &pDeadListUAV_);
+
+        for (int i = 0; i < 2; ++i)
+        {
+            CreateStructuredBuffer(pDevice, capacity, SORT_ENTRY_SIZE, nullptr, D3D11_BUFFER_UAV_FLAG_APPEND, &pAliveLists_[i], &pAliveListSRVs_[i], &pAliveAppendUAVs_[i]);
+
+            // a view without the counter: the sort reads/writes the list by idxs
+            D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+            ZeroMemory(&uavDesc, sizeof(uavDesc));
+
+            uavDesc.Format             = DXGI_FORMAT_UNKNOWN;
+            uavDesc.ViewDimension      = D3D11_UAV_DIMENSION_BUFFER;
+            uavDesc.Buffer.NumElements = capacity;
+
+            hr = pDevice->CreateUnorderedAccessView(pAliveLists_[i], &uavDesc, &pAliveSortUAVs_[i]);
+            CAssert::NotFailed(hr, "can't create a sort UAV of the alive list");
+        }
+
+        // counters are written by CopyStructureCount and are read by shaders as raw
+        D3D11_BUFFER_DESC desc;
+        ZeroMemory(&desc, sizeof(desc));
+
+        desc.Usage     = D3D11_USAGE_DEFAULT;
+        desc.ByteWidth = 4 * sizeof(uint32);
+        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+
+        hr = pDevice->CreateBuffer(&desc, nullptr, &pCounters_);
+        CAssert::NotFailed(hr, "can't create a buffer of particle counters");
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        ZeroMemory(&srvDesc, sizeof(srvDesc));
+
+        srvDesc.Format                = DXGI_FORMAT_R32_TYPELESS;
+        srvDesc.ViewDimension         = D3D11_SRV_DIMENSION_BUFFEREX;
+        srvDesc.BufferEx.NumElements  = 4;
+        srvDesc.BufferEx.Flags        = D3D11_BUFFEREX_SRV_FLAG_RAW;
+
+        hr = pDevice->CreateShaderResourceView(pCounters_, &srvDesc, &pCountersSRV_);
+        CAssert::NotFailed(hr, "can't create a SRV of particle counters");
+
+        // a quad (triangle strip) per each alive particle; the instance count is copied from the alive list
+        const UINT drawArgs[NUM_DRAW_ARGS] = { 4, 0, 0, 0 };
+        D3D11_SUBRESOURCE_DATA argsData    = { drawArgs, 0, 0 };
+
+        desc.ByteWidth = sizeof(drawArgs);
+        desc.BindFlags = 0;
+        desc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+
+        hr = pDevice->CreateBuffer(&desc, &argsData, &pDrawArgs_);
+        CAssert::NotFailed(hr, "can't create a buffer of particles draw args");
+
+        // emitters of the frame
+        desc.Usage               = D3D11_USAGE_DYNAMIC;
+        desc.ByteWidth           = MAX_EMITTERS * sizeof(GpuParticleEmitter);
+        desc.BindFlags           = D3D11_BIND_SHADER_RESOURCE;
+        desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        desc.StructureByteStride = sizeof(GpuParticleEmitter);
+
+        hr = pDevice->CreateBuffer(&desc, nullptr, &pEmitters_);
+        CAssert::NotFailed(hr, "can't create a buffer of particle emitters");
+
+        hr = pDevice->CreateShaderResourceView(pEmitters_, nullptr, &pEmittersSRV_);
+        CAssert::NotFailed(hr, "can't create a SRV of particle emitters");
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        ReleaseBuffers();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool GpuParticles::CreateStates(ID3D11Device* pDevice)
+{
+    // premultiplied alpha: alpha blended particles have (rgb * a, a),
+    // additive ones have (rgb * a, 0) so both go by a single draw
+    D3D11_BLEND_DESC blendDesc;
+    ZeroMemory(&blendDesc, sizeof(blendDesc));
+
+    D3D11_RENDER_TARGET_BLEND_DESC& rt = blendDesc.RenderTarget[0];
+    rt.BlendEnable           = TRUE;
+    rt.SrcBlend              = D3D11_BLEND_ONE;
+    rt.DestBlend             = D3D11_BLEND_INV_SRC_ALPHA;
+    rt.BlendOp               = D3D11_BLEND_OP_ADD;
+    rt.SrcBlendAlpha         = D3D11_BLEND_ONE;
+    rt.DestBlendAlpha        = D3D11_BLEND_INV_SRC_ALPHA;
+    rt.BlendOpAlpha          = D3D11_BLEND_OP_ADD;
+    rt.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+    if (FAILED(pDevice->CreateBlendState(&blendDesc, &pBlendState_)))
+        return false;
+
+    D3D11_DEPTH_STENCIL_DESC dsDesc;
+    ZeroMemory(&dsDesc, sizeof(dsDesc));
+
+    dsDesc.DepthEnable    = FALSE;
+    dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+    dsDesc.DepthFunc      = D3D11_COMPARISON_ALWAYS;
+
+    if (FAILED(pDevice->CreateDepthStencilState(&dsDesc, &pDepthOffState_)))
+        return false;
+
+    dsDesc.DepthEnable    = TRUE;
+    dsDesc.DepthFunc      = D3D11_COMPARISON_LESS_EQUAL;
+
+    if (FAILED(pDevice->CreateDepthStencilState(&dsDesc, &pDepthReadState_)))
+        return false;
+
+    D3D11_RASTERIZER_DESC rsDesc;
+    ZeroMemory(&rsDesc, sizeof(rsDesc));
+
+    rsDesc.FillMode        = D3D11_FILL_SOLID;
+    rsDesc.CullMode        = D3D11_CULL_NONE;
+    rsDesc.DepthClipEnable = TRUE;
+
+    return SUCCEEDED(pDevice->CreateRasterizerState(&rsDesc, &pRasterState_));
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuParticles::Update(
+    ID3D11DeviceContext* pContext,
+    const GpuParticleEmitter* emitters,
+    const UINT numEmitters,
+    const GpuParticlesFrame& frame)
+{
+    if (!isInit_)
+        return;
+
+    // upload emitters of the frame (those which don't fit are skipped)
+    const UINT numUsed  = (numEmitters < MAX_EMITTERS) ? numEmitters : MAX_EMITTERS;
+    UINT       numSpawns = 0;
+    float      maxLifetime = 0.0f;
+
+    if (numUsed > 0)
+    {
+        D3D11_MAPPED_SUBRESOURCE mapped;
+
+        if (FAILED(pContext->Map(pEmitters_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+        {
+            LogErr("can't map the buffer of particle emitters");
+            return;
+        }
+
+        GpuParticleEmitter* dst = (GpuParticleEmitter*)mapped.pData;
+
+        for (UINT i = 0; i < numUsed; ++i)
+        {
+            dst[i]            = emitters[i];
+            dst[i].spawnStart = numSpawns;
+
+            numSpawns  += emitters[i].numSpawns;
+            maxLifetime = (emitters[i].lifetime.y > maxLifetime) ? emitters[i].lifetime.y : maxLifetime;
+        }
+
+        pContext->Unmap(pEmitters_, 0);
+    }
+
+    stats_.numEmitters = numUsed;
+    stats_.numSpawned  = (numSpawns < capacity_) ? numSpawns : capacity_;
+
+    // nothing was spawned for the max lifetime: there are no alive particles (nothing to do)
+    aliveTimeLeft_ -= frame.deltaTime;
+
+    if (numSpawns > 0)
+        aliveTimeLeft_ = (maxLifetime > aliveTimeLeft_) ? maxLifetime : aliveTimeLeft_;
+
+    stats_.isActive = (aliveTimeLeft_ > 0.0f);
+
+    if (!stats_.isActive)
+    {
+        aliveTimeLeft_ = 0.0f;
+        return;
+    }
+
+    // a view direction is the 3rd column of the view matrix
+    XMFLOAT4X4 view;
+    XMStoreFloat4x4(&view, frame.view);
+
+    ConstBufType::cbParticles& cb = cbParticles_.data;
+
+    cb.view            = XMMatrixTranspose(frame.view);
+    cb.proj            = XMMatrixTranspose(frame.proj);
+    cb.cameraPos       = frame.cameraPos;
+    cb.deltaTime       = frame.deltaTime;
+    cb.cameraForward   = { view._13, view._23, view._33 };
+    cb.frameIdx        = ++frameIdx_;
+    cb.numSpawns       = stats_.numSpawned;
+    cb.numEmitters     = numUsed;
+    cb.nearZ           = frame.nearZ;
+    cb.farZ            = frame.farZ;
+    cb.invSoftDistance = (frame.softDistance > 0.0f) ? 1.0f / frame.softDistance : 0.0f;
+    cb.softParticles   = 0;
+    cbParticles_.ApplyChanges(pContext);
+
+    // the dead list is full and the alive lists are empty at the start
+    if (!isCountersInit_)
+    {
+        ID3D11UnorderedAccessView* uavs[3]   = { pDeadListUAV_, pAliveAppendUAVs_[0], pAliveAppendUAVs_[1] };
+        const UINT                 counts[3] = { capacity_, 0, 0 };
+
+        pContext->CSSetUnorderedAccessViews(0, 3, uavs, counts);
+        isCountersInit_ = true;
+    }
+
+    pContext->CSSetConstantBuffers(CB_SLOT, 1, cbParticles_.GetAddressOf());
+
+    if (stats_.numSpawned > 0)
+        Emit(pContext, stats_.numSpawned);
+
+    Simulate(pContext);
+    Sort(pContext);
+
+    ID3D11ShaderResourceView*  nullSRVs[2] = { nullptr, nullptr };
+    ID3D11UnorderedAccessView* nullUAVs[3] = { nullptr, nullptr, nullptr };
+
+    pContext->CSSetShaderResources(0, 2, nullSRVs);
+    pContext->CSSetUnorderedAccessViews(0, 3, nullUAVs, nullptr);
+    pContext->CSSetShader(nullptr, nullptr, 0);
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuParticles::Emit(ID3D11DeviceContext* pContext, const UINT numSpawns)
+{
+    // new particles take slots from the dead list (as many as there are)
+    // and are appended into the current alive list
+    pContext->CopyStructureCount(pCounters_, 0, pDeadListUAV_);
+
+    ID3D11ShaderResourceView*  srvs[2]   = { pEmittersSRV_, pCountersSRV_ };
+    ID3D11UnorderedAccessView* uavs[3]   = { pParticlesUAV_, pDeadListUAV_, pAliveAppendUAVs_[currList_] };
+    const UINT                 counts[3] = { (UINT)-1, (UINT)-1, (UINT)-1 };    // keep counters
+
+    pContext->CSSetShader(emitCS_.GetShader(), nullptr, 0);
+    pContext->CSSetShaderResources(0, 2, srvs);
+    pContext->CSSetUnorderedAccessViews(0, 3, uavs, counts);
+
+    pContext->Dispatch((numSpawns + THREADS_NUM - 1) / THREADS_NUM, 1, 1);
+
+    // the alive list is read by the simulation
+    ID3D11UnorderedAccessView* nullUAVs[3] = { nullptr, nullptr, nullptr };
+    pContext->CSSetUnorderedAccessViews(0, 3, nullUAVs, nullptr);
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuParticles::Simulate(ID3D11DeviceContext* pContext)
+{
+    // alive particles of the current list go into the next one (or into the dead one)
+    const UINT nextList = 1 - currList_;
+
+    pContext->CopyStructureCount(pCounters_, 4, pAliveAppendUAVs_[currList_]);
+
+    ID3D11ShaderResourceView*  srvs[2]   = { pAliveListSRVs_[currList_], pCountersSRV_ };
+    ID3D11UnorderedAccessView* uavs[3]   = { pParticlesUAV_, pDeadListUAV_, pAliveAppendUAVs_[nextList] };
+    const UINT                 counts[3] = { (UINT)-1, (UINT)-1, 0 };          // the next list is empty
+
+    pContext->CSSetShader(simulateCS_.GetShader(), nullptr, 0);
+    pContext->CSSetShaderResources(0, 2, srvs);
+    pContext->CSSetUnorderedAccessViews(0, 3, uavs, counts);
+
+    // the number of alive particles is known only by GPU so all the slots are dispatched
+    pContext->Dispatch(capacity_ / THREADS_NUM, 1, 1);
+
+    ID3D11ShaderResourceView*  nullSRVs[2] = { nullptr, nullptr };
+    ID3D11UnorderedAccessView* nullUAVs[3] = { nullptr, nullptr, nullptr };
+
+    pContext->CSSetShaderResources(0, 2, nullSRVs);
+    pContext->CSSetUnorderedAccessViews(0, 3, nullUAVs, nullptr);
+
+    // the count of the sort and the instance count of the draw
+    pContext->CopyStructureCount(pCounters_, 8, pAliveAppendUAVs_[nextList]);
+    pContext->CopyStructureCount(pDrawArgs_, 4, pAliveAppendUAVs_[nextList]);
+
+    currList_ = nextList;
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuParticles::Sort(ID3D11DeviceContext* pContext)
+{
+    // bitonic sort of the current alive list back to front (by view depth):
+    // merges of sequences up to a block size are done in groupshared memory,
+    // bigger ones go by global steps until the distance fits into a block
+    // NOTE: elements after the alive count are padded with the min depth
+
+    const UINT numGroups = capacity_ / SORT_GROUP_SIZE;
+
+    pContext->CSSetShaderResources(0, 1, &pCountersSRV_);
+    pContext->CSSetUnorderedAccessViews(0, 1, &pAliveSortUAVs_[currList_], nullptr);
+    pContext->CSSetConstantBuffers(0, 1, cbSort_.GetAddressOf());
+
+    ConstBufType::cbcsParticleSort& cb = cbSort_.data;
+
+    // sort each block from scratch
+    cb.k = 0;
+    cb.j = 0;
+    cbSort_.ApplyChanges(pContext);
+
+    pContext->CSSetShader(sortLocalCS_.GetShader(), nullptr, 0);
+    pContext->Dispatch(numGroups, 1, 1);
+
+    for (UINT k = 2 * SORT_GROUP_SIZE; k <= capacity_; k *= 2)
+    {
+        pContext->CSSetShader(sortStepCS_.GetShader(), nullptr, 0);
+
+        for (UINT j = k / 2; j >= SORT_GROUP_SIZE; j /= 2)
+        {
+            cb.k = k;
+            cb.j = j;
+            cbSort_.ApplyChanges(pContext);
+
+            // a thread per pair of elements
+            pContext->Dispatch(capacity_ / (2 * THREADS_NUM), 1, 1);
+        }
+
+        // the rest distances of this merge are within blocks
+        cb.k = k;
+        cb.j = SORT_GROUP_SIZE / 2;
+        cbSort_.ApplyChanges(pContext);
+
+        pContext->CSSetShader(sortLocalCS_.GetShader(), nullptr, 0);
+        pContext->Dispatch(numGroups, 1, 1);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuParticles::Render(
+    ID3D11DeviceContext* pContext,
+    ID3D11ShaderResourceView* const* texSRVs,
+    const UINT numTextures,
+    ID3D11ShaderResourceView* pDepthSRV)
+{
+    if (!IsActive())
+        return;
+
+    // soft particles: the scene depth is read right in the PS so the depth buffer
+    // isn't bound; otherwise particles are tested by the bound depth buffer
+    cbParticles_.data.softParticles = (pDepthSRV != nullptr);
+    cbParticles_.ApplyChanges(pContext);
+
+    ID3D11ShaderResourceView* vsSRVs[2] = { pParticlesSRV_, pAliveListSRVs_[currList_] };
+    ID3D11ShaderResourceView* psSRVs[1 + MAX_TEXTURES] = { pDepthSRV, nullptr, nullptr, nullptr, nullptr };
+
+    for (UINT i = 0; (i < numTextures) && (i < MAX_TEXTURES); ++i)
+        psSRVs[1 + i] = texSRVs[i];
+
+    const FLOAT blendFactor[4] = { 0,0,0,0 };
+
+    pStateCache_->SetInputLayout(pContext, nullptr);
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetGS(pContext, nullptr);
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetVSConstantBuffers(pContext, CB_SLOT, 1, cbParticles_.GetAddressOf());
+    pStateCache_->SetPSConstantBuffers(pContext, CB_SLOT, 1, cbParticles_.GetAddressOf());
+    pStateCache_->SetVSShaderResources(pContext, VS_PARTICLES_SLOT, 2, vsSRVs);
+    pStateCache_->SetPSShaderResources(pContext, PS_DEPTH_SLOT, 1 + MAX_TEXTURES, psSRVs);
+    pStateCache_->SetPSSamplers(pContext, PS_SAMPLER_SLOT, 1, samplerState_.GetAddressOf());
+
+    pStateCache_->SetRasterState(pContext, pRasterState_);
+    pStateCache_->SetBlendState(pContext, pBlendState_, blendFactor, 0xFFFFFFFF);
+    pStateCache_->SetDepthStencilState(pContext, (pDepthSRV) ? pDepthOffState_ : pDepthReadState_, 0);
+
+    pStateCache_->DrawInstancedIndirect(pContext, pDrawArgs_, 0);
+
+    // the lists are written by the next update and the depth by the next frame
+    ID3D11ShaderResourceView* nullSRVs[1 + MAX_TEXTURES] = { nullptr };
+
+    pStateCache_->SetVSShaderResources(pContext, VS_PARTICLES_SLOT, 2, nullSRVs);
+    pStateCache_->SetPSShaderResources(pContext, PS_DEPTH_SLOT, 1, nullSRVs);
+}
+
+} // namespace Render
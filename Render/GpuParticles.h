@@ -0,0 +1,216 @@
+// =================================================================================
+// Filename:     GpuParticles.h
+// Description:  a pool of particles which are spawned, simulated, sorted and
+//               rendered entirely on GPU:
+//
+//               - particles live in a structured buffer of a fixed capacity;
+//                 free slots are in a dead list (consume buffer) and slots of
+//                 the alive particles are in one of two alive lists (append
+//                 buffers) which are swapped each frame;
+//               - the emit shader takes a slot from the dead list for each new
+//                 particle (params of emitters are uploaded each frame) and
+//                 appends it into the current alive list;
+//               - the simulate shader integrates each alive particle and appends
+//                 it into the next alive list along with its view depth (or
+//                 returns its slot into the dead list if it died);
+//               - the next alive list is sorted back to front by a bitonic sort
+//                 so alpha blended particles are composited in the right order
+//                 (additive ones are premultiplied with zero alpha so they go
+//                 by the same draw);
+//               - particles are rendered by instanced quads which are expanded
+//                 from the sorted list in the vertex shader; the instance count
+//                 is copied from the counter of the alive list so the CPU never
+//                 reads it back (the CPU cost depends only on emitters);
+//               - pixels are faded by the distance to the scene depth behind
+//                 them (soft particles) so quads don't cut through geometry
+//
+//               NOTE: the whole pool is sorted each frame so the sort cost is
+//                     fixed by the capacity; when there are no emitters and all
+//                     the spawned particles are dead nothing is dispatched at all
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/ComputeShader.h"
+#include "Shaders/VertexShader.h"
+#include "Shaders/PixelShader.h"
+#include "Shaders/SamplerState.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "StateCache.h"
+
+#include <Types.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+// an emitter which spawns particles in this frame (must be the same as in ParticleEmitCS.hlsl)
+struct GpuParticleEmitter
+{
+    DirectX::XMFLOAT3 position;
+    uint32            spawnStart  = 0;     // idx of the first particle of this emitter among all the spawned in the frame
+    DirectX::XMFLOAT3 axis;                // world axis of the emission cone
+    uint32            numSpawns   = 0;
+    DirectX::XMFLOAT2 lifetime;            // min/max (in seconds)
+    DirectX::XMFLOAT2 speed;               // min/max
+    DirectX::XMFLOAT2 size;                // start/end
+    float             spreadCos   = 1;     // cos of half angle of the emission cone
+    float             gravity     = 0;     // acceleration along -Y
+    uint32            startColor  = 0;     // packed RGBA8
+    uint32            endColor    = 0;
+    float             drag        = 0;
+    uint32            flags       = 0;     // see PackParticleFlags()
+};
+
+// texture slot (bits 0-3), atlas columns (bits 4-11), atlas rows (bits 12-19), additive (bit 20)
+inline uint32 PackParticleFlags(const uint32 texSlot, const uint32 atlasCols, const uint32 atlasRows, const bool additive)
+{
+    return (texSlot & 0xF) | ((atlasCols & 0xFF) << 4) | ((atlasRows & 0xFF) << 12) | ((uint32)additive << 20);
+}
+
+// a color [0,1] in RGBA8 (R in the low byte)
+inline uint32 PackParticleColor(const DirectX::XMFLOAT4& c)
+{
+    const auto toByte = [](const float v)
+    {
+        const float s = (v < 0.0f) ? 0.0f : (v > 1.0f) ? 1.0f : v;
+        return (uint32)(s * 255.0f + 0.5f);
+    };
+
+    return toByte(c.x) | (toByte(c.y) << 8) | (toByte(c.z) << 16) | (toByte(c.w) << 24);
+}
+
+// params of the simulation and rendering of the current frame
+struct GpuParticlesFrame
+{
+    DirectX::XMMATRIX view;
+    DirectX::XMMATRIX proj;
+    DirectX::XMFLOAT3 cameraPos;
+    float             deltaTime    = 0;
+    float             nearZ        = 1;
+    float             farZ         = 1000;
+    float             softDistance = 0.5f;  // pixels closer to the scene depth than this distance are faded
+};
+
+struct GpuParticlesStats
+{
+    uint32 numEmitters = 0;                 // emitters of the last frame
+    uint32 numSpawned  = 0;                 // particles which were requested to spawn in the last frame
+    uint32 capacity    = 0;
+    bool   isActive    = false;             // there can be alive particles
+};
+
+///////////////////////////////////////////////////////////
+
+class GpuParticles
+{
+public:
+    static constexpr UINT THREADS_NUM        = 256;   // the group size of the emit/simulate shaders
+    static constexpr UINT SORT_GROUP_SIZE    = 1024;  // elements which are sorted in groupshared memory
+    static constexpr UINT MAX_EMITTERS       = 1024;  // per frame
+    static constexpr UINT MAX_TEXTURES       = 4;     // textures of particles per frame (PS slots t31..t34)
+    static constexpr UINT PARTICLE_SIZE      = 64;    // sizeof(Particle) in the shaders
+    static constexpr UINT SORT_ENTRY_SIZE    = 8;     // { view depth, particle idx }
+
+    GpuParticles() {}
+    ~GpuParticles();
+
+    // restrict a copying of this class instance
+    GpuParticles(const GpuParticles&) = delete;
+    GpuParticles& operator=(const GpuParticles&) = delete;
+
+    // capacity is rounded up to a power of 2 (for the sort); shaders are loaded by their
+    // names from "shaders/" (ParticleEmitCS, ParticleSimulateCS, ParticleSortLocalCS,
+    // ParticleSortStepCS, ParticleVS, ParticlePS)
+    bool Initialize(ID3D11Device* pDevice, const UINT maxParticles);
+    void Shutdown();
+
+    // spawn particles of emitters, simulate all the alive ones and sort them;
+    // NOTE: is executed on the immediate context (the render thread must be synced)
+    void Update(
+        ID3D11DeviceContext* pContext,
+        const GpuParticleEmitter* emitters,
+        const UINT numEmitters,
+        const GpuParticlesFrame& frame);
+
+    // render alive particles by textures which are referred by slots of emitters;
+    // pDepthSRV: the scene depth for soft particles (is nullptr if the depth buffer
+    // is still bound for the depth test, e.g. if it is multisampled)
+    void Render(
+        ID3D11DeviceContext* pContext,
+        ID3D11ShaderResourceView* const* texSRVs,
+        const UINT numTextures,
+        ID3D11ShaderResourceView* pDepthSRV);
+
+    inline bool IsInitialized() const { return isInit_; }
+    inline bool IsActive()      const { return isInit_ && (aliveTimeLeft_ > 0.0f); }
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+    inline const GpuParticlesStats& GetStats() const { return stats_; }
+
+private:
+    bool CreateBuffers(ID3D11Device* pDevice, const UINT capacity);
+    bool CreateStates (ID3D11Device* pDevice);
+    void ReleaseBuffers();
+
+    void Emit    (ID3D11DeviceContext* pContext, const UINT numSpawns);
+    void Simulate(ID3D11DeviceContext* pContext);
+    void Sort    (ID3D11DeviceContext* pContext);
+
+private:
+    ComputeShader              emitCS_;
+    ComputeShader              simulateCS_;
+    ComputeShader              sortLocalCS_;        // sorts blocks in groupshared memory
+    ComputeShader              sortStepCS_;         // a single global step of the bitonic sort
+    VertexShader               vs_;                 // vertex pulling (no input layout)
+    PixelShader                ps_;
+    SamplerState               samplerState_;
+
+    ConstantBuffer<ConstBufType::cbParticles>      cbParticles_;
+    ConstantBuffer<ConstBufType::cbcsParticleSort> cbSort_;
+
+    // particles pool
+    ID3D11Buffer*              pParticles_       = nullptr;   // structured: Particle
+    ID3D11ShaderResourceView*  pParticlesSRV_    = nullptr;
+    ID3D11UnorderedAccessView* pParticlesUAV_    = nullptr;
+
+    ID3D11Buffer*              pDeadList_        = nullptr;   // structured: uint (free slots)
+    ID3D11UnorderedAccessView* pDeadListUAV_     = nullptr;   // append/consume
+
+    // alive lists: { view depth, particle idx } (the current one and the next one)
+    ID3D11Buffer*              pAliveLists_[2]      { nullptr, nullptr };
+    ID3D11ShaderResourceView*  pAliveListSRVs_[2]   { nullptr, nullptr };
+    ID3D11UnorderedAccessView* pAliveAppendUAVs_[2] { nullptr, nullptr };
+    ID3D11UnorderedAccessView* pAliveSortUAVs_[2]   { nullptr, nullptr };  // without the counter (for the sort)
+
+    // counters of lists which are copied by CopyStructureCount: dead, current alive, next alive
+    ID3D11Buffer*              pCounters_        = nullptr;
+    ID3D11ShaderResourceView*  pCountersSRV_     = nullptr;
+
+    ID3D11Buffer*              pDrawArgs_        = nullptr;   // DrawInstancedIndirect args
+    ID3D11Buffer*              pEmitters_        = nullptr;   // dynamic structured: GpuParticleEmitter
+    ID3D11ShaderResourceView*  pEmittersSRV_     = nullptr;
+
+    ID3D11BlendState*          pBlendState_      = nullptr;   // premultiplied alpha
+    ID3D11DepthStencilState*   pDepthOffState_   = nullptr;   // soft particles: depth is read by the PS
+    ID3D11DepthStencilState*   pDepthReadState_  = nullptr;   // depth test without writes
+    ID3D11RasterizerState*     pRasterState_     = nullptr;   // no culling
+
+    StateCache*                pStateCache_      = nullptr;   // filters redundant binds (is owned by CRender)
+
+    UINT                       capacity_         = 0;
+    UINT                       currList_         = 0;         // the alive list which is rendered
+    uint32                     frameIdx_         = 0;         // a seed of random numbers
+    float                      aliveTimeLeft_    = 0;         // max time left of the spawned particles
+    bool                       isCountersInit_   = false;     // hidden counters of the lists are set by the first update
+    bool                       isInit_           = false;
+
+    GpuParticlesStats          stats_;
+};
+
+} // namespace Render
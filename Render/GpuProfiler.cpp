@@ -0,0 +1,268 @@
+// =================================================================================
+// Filename:     GpuProfiler.cpp
+// Description:  implementation of the GpuProfiler's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "GpuProfiler.h"
+#include "FrameStats.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <HitchRecorder.h>
+
+
+namespace Render
+{
+
+static const char* s_PassNames[NUM_GPU_PASSES] =
+{
+    "shadows",
+    "planar reflection",
+    "depth pre-pass",
+    "opaque (GPU-driven)",
+    "default",
+    "alpha clip",
+    "deferred shading",
+    "blended",
+    "terrain",
+    "grass",
+    "skinned",
+    "sky dome",
+    "billboards",
+    "impostors",
+    "particles",
+    "bounding boxes",
+    "editor grid",
+    "UI",
+};
+
+///////////////////////////////////////////////////////////
+
+GpuProfiler::~GpuProfiler()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool GpuProfiler::Initialize(ID3D11Device* pDevice)
+{
+    try
+    {
+        CAssert::True(pDevice != nullptr, "input ptr to the device == nullptr");
+
+        D3D11_QUERY_DESC disjointDesc  = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+        D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+        HRESULT hr = S_OK;
+
+        for (Frame& frame : frames_)
+        {
+            hr = pDevice->CreateQuery(&disjointDesc, &frame.pDisjoint);
+            CAssert::NotFailed(hr, "can't create a disjoint query");
+
+            hr = pDevice->CreateQuery(&timestampDesc, &frame.pFrameBegin);
+            CAssert::NotFailed(hr, "can't create a timestamp query");
+
+            hr = pDevice->CreateQuery(&timestampDesc, &frame.pFrameEnd);
+            CAssert::NotFailed(hr, "can't create a timestamp query");
+
+            for (int i = 0; i < NUM_GPU_PASSES; ++i)
+            {
+                hr = pDevice->CreateQuery(&timestampDesc, &frame.pPassBegin[i]);
+                CAssert::NotFailed(hr, "can't create a timestamp query");
+
+                hr = pDevice->CreateQuery(&timestampDesc, &frame.pPassEnd[i]);
+                CAssert::NotFailed(hr, "can't create a timestamp query");
+            }
+        }
+
+        isInitialized_ = true;
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuProfiler::Shutdown()
+{
+    for (Frame& frame : frames_)
+    {
+        SafeRelease(&frame.pDisjoint);
+        SafeRelease(&frame.pFrameBegin);
+        SafeRelease(&frame.pFrameEnd);
+
+        for (int i = 0; i < NUM_GPU_PASSES; ++i)
+        {
+            SafeRelease(&frame.pPassBegin[i]);
+            SafeRelease(&frame.pPassEnd[i]);
+        }
+
+        frame.isPending = false;
+    }
+
+    isInitialized_ = false;
+    isInFrame_     = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuProfiler::BeginFrame(ID3D11DeviceContext* pContext)
+{
+    if (!isInitialized_)
+        return;
+
+    // the slot of this frame was used NUM_FRAMES_IN_FLIGHT frames ago
+    Frame& frame = frames_[currFrame_];
+
+    if (frame.isPending)
+        ReadBack(pContext, frame);
+
+    for (bool& isUsed : frame.isPassUsed)
+        isUsed = false;
+
+    pContext->Begin(frame.pDisjoint);
+    pContext->End(frame.pFrameBegin);
+
+    isInFrame_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuProfiler::EndFrame(ID3D11DeviceContext* pContext)
+{
+    if (!isInFrame_)
+        return;
+
+    Frame& frame = frames_[currFrame_];
+
+    pContext->End(frame.pFrameEnd);
+    pContext->End(frame.pDisjoint);
+
+    frame.isPending = true;
+    isInFrame_      = false;
+    currFrame_      = (currFrame_ + 1) % NUM_FRAMES_IN_FLIGHT;
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuProfiler::BeginPass(ID3D11DeviceContext* pContext, const eGpuPass pass)
+{
+    // draws are counted into the pass even if it isn't measured
+    g_FrameStats.BeginPass(pass);
+
+    if (!isInFrame_)
+        return;
+
+    Frame& frame = frames_[currFrame_];
+
+    pContext->End(frame.pPassBegin[pass]);
+    frame.isPassUsed[pass] = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void GpuProfiler::EndPass(ID3D11DeviceContext* pContext, const eGpuPass pass)
+{
+    g_FrameStats.EndPass();
+
+    if (!isInFrame_)
+        return;
+
+    pContext->End(frames_[currFrame_].pPassEnd[pass]);
+}
+
+///////////////////////////////////////////////////////////
+
+const char* GpuProfiler::GetPassName(const eGpuPass pass)
+{
+    return s_PassNames[pass];
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+void GpuProfiler::ReadBack(ID3D11DeviceContext* pContext, Frame& frame)
+{
+    // never wait for the GPU: if something isn't ready the frame is dropped
+    // (its queries are just issued again by this frame)
+
+    constexpr UINT flags = D3D11_ASYNC_GETDATA_DONOTFLUSH;
+
+    frame.isPending = false;
+
+    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+    if (pContext->GetData(frame.pDisjoint, &disjoint, sizeof(disjoint), flags) != S_OK)
+        return;
+
+    // the GPU frequency was changed during the frame so timestamps are useless
+    if (disjoint.Disjoint || (disjoint.Frequency == 0))
+        return;
+
+    const double toMs = 1000.0 / (double)disjoint.Frequency;
+    UINT64       begin = 0;
+    UINT64       end   = 0;
+    double       passTimes[NUM_GPU_PASSES]{ 0 };
+
+    if ((pContext->GetData(frame.pFrameBegin, &begin, sizeof(begin), flags) != S_OK) ||
+        (pContext->GetData(frame.pFrameEnd,   &end,   sizeof(end),   flags) != S_OK))
+        return;
+
+    const double frameTime = (double)(end - begin) * toMs;
+
+    for (int i = 0; i < NUM_GPU_PASSES; ++i)
+    {
+        if (!frame.isPassUsed[i])
+            continue;
+
+        if ((pContext->GetData(frame.pPassBegin[i], &begin, sizeof(begin), flags) != S_OK) ||
+            (pContext->GetData(frame.pPassEnd[i],   &end,   sizeof(end),   flags) != S_OK))
+            return;
+
+        passTimes[i] = (double)(end - begin) * toMs;
+    }
+
+    // the hitch recorder needs times of each frame (averages hide spikes)
+    if (g_HitchRecorder.IsEnabled())
+    {
+        float       times[NUM_GPU_PASSES];
+        const char* names[NUM_GPU_PASSES];
+
+        for (int i = 0; i < NUM_GPU_PASSES; ++i)
+        {
+            times[i] = (float)passTimes[i];
+            names[i] = GetPassName(eGpuPass(i));
+        }
+
+        g_HitchRecorder.AddGpuFrame((float)frameTime, times, names, NUM_GPU_PASSES);
+    }
+
+    // accumulate and publish averages once per NUM_AVERAGE_FRAMES frames
+    for (int i = 0; i < NUM_GPU_PASSES; ++i)
+        sumPassTimes_[i] += passTimes[i];
+
+    sumFrameTime_ += frameTime;
+    ++numSummed_;
+
+    if (numSummed_ < NUM_AVERAGE_FRAMES)
+        return;
+
+    for (int i = 0; i < NUM_GPU_PASSES; ++i)
+    {
+        avgPassTimes_[i] = (float)(sumPassTimes_[i] / numSummed_);
+        sumPassTimes_[i] = 0;
+    }
+
+    avgFrameTime_ = (float)(sumFrameTime_ / numSummed_);
+    sumFrameTime_ = 0;
+    numSummed_    = 0;
+}
+
+} // namespace Render
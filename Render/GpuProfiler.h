@@ -0,0 +1,139 @@
+// =================================================================================
+// Filename:     GpuProfiler.h
+// Description:  measuring of GPU time of each render pass by timestamp queries:
+//
+//               - the whole frame is wrapped into a TIMESTAMP_DISJOINT query
+//                 and each pass into a pair of TIMESTAMP queries;
+//               - queries of a frame are read back NUM_FRAMES_IN_FLIGHT frames
+//                 later so reading never stalls the CPU (if results still aren't
+//                 ready or the frequency was disjoint the frame is just dropped);
+//               - times are averaged over NUM_AVERAGE_FRAMES frames
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+enum eGpuPass
+{
+    GPU_PASS_SHADOWS,
+    GPU_PASS_REFLECTION,             // casters of the planar reflection
+    GPU_PASS_DEPTH_PREPASS,
+    GPU_PASS_GPU_DRIVEN,             // the opaque pass culled on the GPU
+    GPU_PASS_DEFAULT,
+    GPU_PASS_ALPHA_CLIP,
+    GPU_PASS_DEFERRED,               // the G-buffer + tiled lighting (instead of default/alpha clip)
+    GPU_PASS_BLENDED,
+    GPU_PASS_TERRAIN,
+    GPU_PASS_GRASS,
+    GPU_PASS_SKINNED,                // instanced skinned crowds
+    GPU_PASS_SKY_DOME,
+    GPU_PASS_BILLBOARDS,
+    GPU_PASS_IMPOSTORS,
+    GPU_PASS_PARTICLES,
+    GPU_PASS_BOUNDING_BOXES,
+    GPU_PASS_EDITOR_GRID,
+    GPU_PASS_UI,
+
+    NUM_GPU_PASSES,
+};
+
+///////////////////////////////////////////////////////////
+
+class GpuProfiler
+{
+public:
+    static constexpr int NUM_FRAMES_IN_FLIGHT = 3;     // the delay of reading back (in frames)
+    static constexpr int NUM_AVERAGE_FRAMES   = 30;
+
+    GpuProfiler() {}
+    ~GpuProfiler();
+
+    // restrict a copying of this class instance
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    bool Initialize(ID3D11Device* pDevice);
+    void Shutdown();
+
+    // read back the oldest frame in flight and start queries of a new one;
+    // all the passes must be between BeginFrame() and EndFrame()
+    void BeginFrame(ID3D11DeviceContext* pContext);
+    void EndFrame  (ID3D11DeviceContext* pContext);
+
+    // each pass is measured once per frame (the immediate context only)
+    void BeginPass(ID3D11DeviceContext* pContext, const eGpuPass pass);
+    void EndPass  (ID3D11DeviceContext* pContext, const eGpuPass pass);
+
+    // averaged times in milliseconds
+    inline float GetPassTime(const eGpuPass pass) const { return avgPassTimes_[pass]; }
+    inline float GetFrameTime()                   const { return avgFrameTime_; }
+
+    static const char* GetPassName(const eGpuPass pass);
+
+    inline bool IsInitialized() const { return isInitialized_; }
+
+private:
+    struct Frame
+    {
+        ID3D11Query* pDisjoint   = nullptr;
+        ID3D11Query* pFrameBegin = nullptr;
+        ID3D11Query* pFrameEnd   = nullptr;
+        ID3D11Query* pPassBegin[NUM_GPU_PASSES]{ nullptr };
+        ID3D11Query* pPassEnd  [NUM_GPU_PASSES]{ nullptr };
+        bool         isPassUsed[NUM_GPU_PASSES]{ false };
+        bool         isPending   = false;          // are queries issued but not read yet?
+    };
+
+    void ReadBack(ID3D11DeviceContext* pContext, Frame& frame);
+
+private:
+    Frame  frames_[NUM_FRAMES_IN_FLIGHT];
+    int    currFrame_     = 0;
+    bool   isInFrame_     = false;
+    bool   isInitialized_ = false;
+
+    // sums of times (ms) of the frames which are being averaged now
+    double sumPassTimes_[NUM_GPU_PASSES]{ 0 };
+    double sumFrameTime_  = 0;
+    int    numSummed_     = 0;
+
+    float  avgPassTimes_[NUM_GPU_PASSES]{ 0 };
+    float  avgFrameTime_  = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+class GpuProfileScope
+{
+public:
+    // measure GPU time of the pass until the end of the scope
+    GpuProfileScope(GpuProfiler& profiler, ID3D11DeviceContext* pContext, const eGpuPass pass) :
+        profiler_(profiler),
+        pContext_(pContext),
+        pass_(pass)
+    {
+        profiler_.BeginPass(pContext_, pass_);
+    }
+
+    ~GpuProfileScope()
+    {
+        profiler_.EndPass(pContext_, pass_);
+    }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    GpuProfiler&         profiler_;
+    ID3D11DeviceContext* pContext_ = nullptr;
+    eGpuPass             pass_;
+};
+
+} // namespace Render
@@ -0,0 +1,307 @@
+// =================================================================================
+// Filename:     GrassScatter.cpp
+// Description:  implementation of the GrassScatter's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "GrassScatter.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <math.h>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+static_assert(sizeof(GrassPatch) == 16,                 "size of patches must be the same as in GrassScatterCS.hlsl");
+static_assert(sizeof(ConstBufType::cbGrass) % 16 == 0,  "size of the const buffer must be a multiple of 16");
+
+// slots of resources (must be the same as in the grass shaders)
+static constexpr UINT CB_SLOT            = 7;      // CS, VS, PS
+static constexpr UINT VS_INSTANCES_SLOT  = 15;
+
+///////////////////////////////////////////////////////////
+
+GrassScatter::~GrassScatter()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool GrassScatter::Initialize(ID3D11Device* pDevice, const UINT maxInstances, const GrassParams& params)
+{
+    try
+    {
+        CAssert::True(maxInstances > 0, "max number of grass instances must be > 0");
+
+        bool result = scatterCS_.Initialize(pDevice, "shaders/GrassScatterCS.cso");
+        CAssert::True(result, "can't initialize the grass scatter shader");
+
+        // the vertex pulling VS has no input layout
+        result = vs_.Initialize(pDevice, "shaders/GrassVS.cso", nullptr, 0);
+        CAssert::True(result, "can't initialize the grass vertex shader");
+
+        result = ps_.Initialize(pDevice, "shaders/GrassPS.cso");
+        CAssert::True(result, "can't initialize the grass pixel shader");
+
+        D3D11_SAMPLER_DESC samplerDesc;
+        ZeroMemory(&samplerDesc, sizeof(samplerDesc));
+        samplerDesc.Filter         = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+        samplerDesc.AddressU       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressV       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressW       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+        samplerDesc.MaxLOD         = D3D11_FLOAT32_MAX;
+
+        result = samplerState_.Initialize(pDevice, &samplerDesc);
+        CAssert::True(result, "can't initialize the grass sampler state");
+
+        CAssert::NotFailed(cbGrass_.Initialize(pDevice), "can't initialize the grass const buffer");
+        CAssert::True(CreateBuffers(pDevice, maxInstances), "can't create buffers of grass");
+
+        D3D11_RASTERIZER_DESC rsDesc;
+        ZeroMemory(&rsDesc, sizeof(rsDesc));
+        rsDesc.FillMode        = D3D11_FILL_SOLID;
+        rsDesc.CullMode        = D3D11_CULL_NONE;
+        rsDesc.DepthClipEnable = TRUE;
+
+        CAssert::NotFailed(pDevice->CreateRasterizerState(&rsDesc, &pRasterState_), "can't create a raster state of grass");
+
+        params_         = params;
+        capacity_       = maxInstances;
+        stats_.capacity = maxInstances;
+        isInit_         = true;
+
+        LogMsgf("grass scatter: capacity %u clumps (%u KB)", maxInstances, (maxInstances * INSTANCE_SIZE) >> 10);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the grass scatter");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void GrassScatter::Shutdown()
+{
+    ReleaseBuffers();
+    SafeRelease(&pRasterState_);
+
+    scatterCS_.Shutdown();
+    vs_.Shutdown();
+    ps_.Shutdown();
+
+    capacity_ = 0;
+    stats_    = GrassStats();
+    isInit_   = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void GrassScatter::ReleaseBuffers()
+{
+    SafeRelease(&pInstancesUAV_);
+    SafeRelease(&pInstancesSRV_);
+    SafeRelease(&pInstances_);
+    SafeRelease(&pDrawArgsUAV_);
+    SafeRelease(&pDrawArgs_);
+    SafeRelease(&pPatchesSRV_);
+    SafeRelease(&pPatches_);
+}
+
+///////////////////////////////////////////////////////////
+
+bool GrassScatter::CreateBuffers(ID3D11Device* pDevice, const UINT capacity)
+{
+    try
+    {
+        // visible clumps (are written by the scatter shader, are read by the VS)
+        D3D11_BUFFER_DESC desc;
+        ZeroMemory(&desc, sizeof(desc));
+
+        desc.Usage               = D3D11_USAGE_DEFAULT;
+        desc.ByteWidth           = capacity * INSTANCE_SIZE;
+        desc.BindFlags           = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+        desc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        desc.StructureByteStride = INSTANCE_SIZE;
+
+        HRESULT hr = pDevice->CreateBuffer(&desc, nullptr, &pInstances_);
+        CAssert::NotFailed(hr, "can't create a buffer of grass instances");
+
+        hr = pDevice->CreateShaderResourceView(pInstances_, nullptr, &pInstancesSRV_);
+        CAssert::NotFailed(hr, "can't create a SRV of grass instances");
+
+        hr = pDevice->CreateUnorderedAccessView(pInstances_, nullptr, &pInstancesUAV_);
+        CAssert::NotFailed(hr, "can't create a UAV of grass instances");
+
+        // the instance count is incremented right in the args by the scatter shader
+        const UINT drawArgs[4] = { VERTS_PER_CLUMP, 0, 0, 0 };
+        D3D11_SUBRESOURCE_DATA argsData = { drawArgs, 0, 0 };
+
+        ZeroMemory(&desc, sizeof(desc));
+        desc.Usage     = D3D11_USAGE_DEFAULT;
+        desc.ByteWidth = sizeof(drawArgs);
+        desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+        desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS | D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+
+        hr = pDevice->CreateBuffer(&desc, &argsData, &pDrawArgs_);
+        CAssert::NotFailed(hr, "can't create a buffer of grass draw args");
+
+        D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+        ZeroMemory(&uavDesc, sizeof(uavDesc));
+        uavDesc.Format             = DXGI_FORMAT_R32_TYPELESS;
+        uavDesc.ViewDimension      = D3D11_UAV_DIMENSION_BUFFER;
+        uavDesc.Buffer.NumElements = 4;
+        uavDesc.Buffer.Flags       = D3D11_BUFFER_UAV_FLAG_RAW;
+
+        hr = pDevice->CreateUnorderedAccessView(pDrawArgs_, &uavDesc, &pDrawArgsUAV_);
+        CAssert::NotFailed(hr, "can't create a UAV of grass draw args");
+
+        // patches of the frame
+        ZeroMemory(&desc, sizeof(desc));
+        desc.Usage               = D3D11_USAGE_DYNAMIC;
+        desc.ByteWidth           = MAX_PATCHES * sizeof(GrassPatch);
+        desc.BindFlags           = D3D11_BIND_SHADER_RESOURCE;
+        desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        desc.StructureByteStride = sizeof(GrassPatch);
+
+        hr = pDevice->CreateBuffer(&desc, nullptr, &pPatches_);
+        CAssert::NotFailed(hr, "can't create a buffer of grass patches");
+
+        hr = pDevice->CreateShaderResourceView(pPatches_, nullptr, &pPatchesSRV_);
+        CAssert::NotFailed(hr, "can't create a SRV of grass patches");
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        ReleaseBuffers();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void GrassScatter::Scatter(
+    ID3D11DeviceContext* pContext,
+    const GrassPatch* patches,
+    const UINT numPatches,
+    const GrassFrame& frame)
+{
+    if (!isInit_)
+        return;
+
+    const UINT numUsed = (numPatches < MAX_PATCHES) ? numPatches : MAX_PATCHES;
+    stats_.numPatches  = numUsed;
+
+    if (numUsed == 0)
+        return;
+
+    if (!frame.pHeightMap)
+    {
+        stats_.numPatches = 0;
+        return;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+
+    if (FAILED(pContext->Map(pPatches_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+    {
+        LogErr("can't map the buffer of grass patches");
+        stats_.numPatches = 0;
+        return;
+    }
+
+    memcpy(mapped.pData, patches, numUsed * sizeof(GrassPatch));
+    pContext->Unmap(pPatches_, 0);
+
+    // cells of a patch by the density (a multiple of the group size)
+    UINT cells = (UINT)ceilf(frame.patchSize * sqrtf(params_.density));
+    cells = ((cells + GROUP_SIZE - 1) / GROUP_SIZE) * GROUP_SIZE;
+    cells = (cells < GROUP_SIZE) ? GROUP_SIZE : (cells > MAX_CELLS_PER_SIDE) ? MAX_CELLS_PER_SIDE : cells;
+    cellsPerSide_ = cells;
+
+    ConstBufType::cbGrass& cb = cbGrass_.data;
+
+    cb.viewProj      = XMMatrixTranspose(frame.viewProj);
+    memcpy(cb.planes, frame.planes, sizeof(cb.planes));
+    cb.cameraPos     = frame.cameraPos;
+    cb.time          = frame.time;
+    cb.origin        = frame.origin;
+    cb.heightScale   = frame.heightScale;
+    cb.texelSize     = frame.texelSize;
+    cb.cellSize      = frame.patchSize / (float)cells;
+    cb.cellsPerSide  = cells;
+    cb.maxDistance   = params_.maxDistance;
+    cb.fadeStart     = (params_.fadeStart < params_.maxDistance) ? params_.fadeStart : 0.0f;
+    cb.minSlopeCos   = cosf(params_.maxSlope);
+    cb.bladeHeight   = params_.bladeHeight;
+    cb.bladeWidth    = params_.bladeWidth;
+    cb.windStrength  = params_.windStrength;
+    cb.fogColor      = frame.fogColor;
+    cb.fogStart      = frame.fogStart;
+    cb.fogRange      = frame.fogRange;
+    cb.hasTextureMap = (frame.pTextureMap != nullptr);
+    cb.hasLightmap   = (frame.pLightmap != nullptr);
+    cbGrass_.ApplyChanges(pContext);
+
+    // clumps of the prev frame are discarded
+    const UINT drawArgs[4] = { VERTS_PER_CLUMP, 0, 0, 0 };
+    pContext->UpdateSubresource(pDrawArgs_, 0, nullptr, drawArgs, 0, 0);
+
+    ID3D11ShaderResourceView*  srvs[4] = { pPatchesSRV_, frame.pHeightMap, frame.pTextureMap, frame.pLightmap };
+    ID3D11UnorderedAccessView* uavs[2] = { pDrawArgsUAV_, pInstancesUAV_ };
+
+    pContext->CSSetShader(scatterCS_.GetShader(), nullptr, 0);
+    pContext->CSSetConstantBuffers(CB_SLOT, 1, cbGrass_.GetAddressOf());
+    pContext->CSSetShaderResources(0, 4, srvs);
+    pContext->CSSetUnorderedAccessViews(0, 2, uavs, nullptr);
+    pContext->CSSetSamplers(0, 1, samplerState_.GetAddressOf());
+
+    // a thread per cell, a group layer per patch
+    pContext->Dispatch(cells / GROUP_SIZE, cells / GROUP_SIZE, numUsed);
+
+    ID3D11ShaderResourceView*  nullSRVs[4] = { nullptr, nullptr, nullptr, nullptr };
+    ID3D11UnorderedAccessView* nullUAVs[2] = { nullptr, nullptr };
+
+    pContext->CSSetShaderResources(0, 4, nullSRVs);
+    pContext->CSSetUnorderedAccessViews(0, 2, nullUAVs, nullptr);
+    pContext->CSSetShader(nullptr, nullptr, 0);
+}
+
+///////////////////////////////////////////////////////////
+
+void GrassScatter::Render(ID3D11DeviceContext* pContext)
+{
+    if (!HasPatches())
+        return;
+
+    pStateCache_->SetInputLayout(pContext, nullptr);
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetGS(pContext, nullptr);
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetVSConstantBuffers(pContext, CB_SLOT, 1, cbGrass_.GetAddressOf());
+    pStateCache_->SetPSConstantBuffers(pContext, CB_SLOT, 1, cbGrass_.GetAddressOf());
+    pStateCache_->SetVSShaderResources(pContext, VS_INSTANCES_SLOT, 1, &pInstancesSRV_);
+    pStateCache_->SetRasterState(pContext, pRasterState_);
+
+    // the number of clumps is known only by the GPU
+    pStateCache_->DrawInstancedIndirect(pContext, pDrawArgs_, 0);
+
+    // the instances are written by the next scattering
+    ID3D11ShaderResourceView* nullSRV = nullptr;
+    pStateCache_->SetVSShaderResources(pContext, VS_INSTANCES_SLOT, 1, &nullSRV);
+}
+
+} // namespace Render
@@ -0,0 +1,160 @@
+// =================================================================================
+// Filename:     GrassScatter.h
+// Description:  grass (ground cover) which is scattered over the terrain on GPU:
+//
+//               - the CPU only chooses terrain patches which are close to the
+//                 camera and are inside of the frustum (a fixed cost by the
+//                 scatter distance, there are no blades on CPU at all);
+//               - a compute shader covers each patch by a grid of cells and
+//                 places a clump of blades into a cell with the probability of
+//                 the density: it is taken from the terrain texture map (green
+//                 texels) and from the slope by the height map, and it goes down
+//                 to zero at the max distance; the clumps out of the frustum are
+//                 culled; positions are jittered by a hash of the cell (so they
+//                 are the same each frame);
+//               - visible clumps are appended into an instances buffer and their
+//                 count goes right into args of DrawInstancedIndirect; clumps are
+//                 expanded from SV_VertexID in the vertex shader (no vertex buffer)
+//                 and are swayed by the wind
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/ComputeShader.h"
+#include "Shaders/VertexShader.h"
+#include "Shaders/PixelShader.h"
+#include "Shaders/SamplerState.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "StateCache.h"
+
+#include <Types.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+// a terrain patch to scatter grass over (must be the same as in GrassScatterCS.hlsl)
+struct GrassPatch
+{
+    DirectX::XMFLOAT2 start;                // the min corner of the patch in the height map space
+    float             padding[2];
+};
+
+// params of the scattering (are the same each frame)
+struct GrassParams
+{
+    float density      = 4.0f;              // clumps per square unit (at most)
+    float maxDistance  = 80.0f;
+    float fadeStart    = 50.0f;
+    float maxSlope     = 0.6f;              // in radians
+    float bladeHeight  = 0.6f;
+    float bladeWidth   = 0.08f;
+    float windStrength = 0.15f;
+};
+
+// the terrain and the camera of the current frame
+struct GrassFrame
+{
+    DirectX::XMMATRIX viewProj;
+    DirectX::XMFLOAT4 planes[6];            // world frustum planes (normals look inside)
+    DirectX::XMFLOAT3 cameraPos;
+    float             time         = 0;
+
+    DirectX::XMFLOAT2 origin;               // position of the height map's (0,0) in world
+    float             heightScale  = 1;
+    float             texelSize    = 1;
+    float             patchSize    = 16;    // in world units
+
+    ID3D11ShaderResourceView* pHeightMap  = nullptr;
+    ID3D11ShaderResourceView* pTextureMap = nullptr;   // optional: the density is 1 without it
+    ID3D11ShaderResourceView* pLightmap   = nullptr;   // optional
+
+    DirectX::XMFLOAT3 fogColor;
+    float             fogStart     = 0;
+    float             fogRange     = 0;     // 0: no fog
+};
+
+struct GrassStats
+{
+    uint32 numPatches = 0;                  // patches which were scattered in the last frame
+    uint32 capacity   = 0;                  // max number of visible clumps
+};
+
+///////////////////////////////////////////////////////////
+
+class GrassScatter
+{
+public:
+    static constexpr UINT GROUP_SIZE         = 8;     // threads per side of a group of the scatter shader
+    static constexpr UINT MAX_CELLS_PER_SIDE = 64;    // of a single patch
+    static constexpr UINT MAX_PATCHES        = 1024;  // per frame
+    static constexpr UINT INSTANCE_SIZE      = 32;    // sizeof(GrassInstance) in the shaders
+    static constexpr UINT VERTS_PER_CLUMP    = 27;    // 3 blades by 3 triangles
+
+    GrassScatter() {}
+    ~GrassScatter();
+
+    // restrict a copying of this class instance
+    GrassScatter(const GrassScatter&) = delete;
+    GrassScatter& operator=(const GrassScatter&) = delete;
+
+    // shaders are loaded by their names from "shaders/" (GrassScatterCS, GrassVS, GrassPS)
+    bool Initialize(ID3D11Device* pDevice, const UINT maxInstances, const GrassParams& params);
+    void Shutdown();
+
+    // scatter clumps over input patches (the previous ones are discarded)
+    // NOTE: is executed on the immediate context (the render thread must be synced)
+    void Scatter(
+        ID3D11DeviceContext* pContext,
+        const GrassPatch* patches,
+        const UINT numPatches,
+        const GrassFrame& frame);
+
+    // render the clumps of the last scattering
+    void Render(ID3D11DeviceContext* pContext);
+
+    inline bool IsInitialized() const { return isInit_; }
+    inline bool HasPatches()    const { return isInit_ && (stats_.numPatches > 0); }
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+    inline const GrassParams& GetParams() const { return params_; }
+    inline const GrassStats&  GetStats()  const { return stats_; }
+
+private:
+    bool CreateBuffers(ID3D11Device* pDevice, const UINT capacity);
+    void ReleaseBuffers();
+
+private:
+    ComputeShader              scatterCS_;
+    VertexShader               vs_;                 // vertex pulling (no input layout)
+    PixelShader                ps_;
+    SamplerState               samplerState_;       // linear clamp (for maps of the terrain)
+
+    ConstantBuffer<ConstBufType::cbGrass> cbGrass_;
+
+    ID3D11Buffer*              pInstances_       = nullptr;   // structured: GrassInstance
+    ID3D11ShaderResourceView*  pInstancesSRV_    = nullptr;
+    ID3D11UnorderedAccessView* pInstancesUAV_    = nullptr;
+
+    ID3D11Buffer*              pDrawArgs_        = nullptr;   // DrawInstancedIndirect args (raw)
+    ID3D11UnorderedAccessView* pDrawArgsUAV_     = nullptr;
+
+    ID3D11Buffer*              pPatches_         = nullptr;   // dynamic structured: GrassPatch
+    ID3D11ShaderResourceView*  pPatchesSRV_      = nullptr;
+
+    ID3D11RasterizerState*     pRasterState_     = nullptr;   // no culling (blades are two-sided)
+    StateCache*                pStateCache_      = nullptr;   // filters redundant binds (is owned by CRender)
+
+    GrassParams                params_;
+    GrassStats                 stats_;
+    UINT                       capacity_         = 0;
+    UINT                       cellsPerSide_     = GROUP_SIZE;
+    bool                       isInit_           = false;
+};
+
+} // namespace Render
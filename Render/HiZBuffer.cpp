@@ -0,0 +1,450 @@
+// =================================================================================
+// Filename:     HiZBuffer.cpp
+// Description:  implementation of the HiZBuffer's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "HiZBuffer.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <cfloat>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+HiZBuffer::~HiZBuffer()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool HiZBuffer::Initialize(ID3D11Device* pDevice, const char* shaderPath)
+{
+    if (!buildCS_.Initialize(pDevice, shaderPath))
+    {
+        LogErr("can't initialize a compute shader for the Hi-Z buffer");
+        return false;
+    }
+
+    if (FAILED(cbBuild_.Initialize(pDevice)))
+    {
+        LogErr("can't initialize a const buffer for the Hi-Z buffer");
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void HiZBuffer::Shutdown()
+{
+    ReleaseResources();
+    buildCS_.Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+void HiZBuffer::ReleaseResources()
+{
+    for (int i = 0; i < MAX_NUM_LEVELS; ++i)
+    {
+        SafeRelease(&pLevelSRVs_[i]);
+        SafeRelease(&pLevelUAVs_[i]);
+    }
+
+    for (int i = 0; i < NUM_READBACKS; ++i)
+    {
+        SafeRelease(&pReadbacks_[i]);
+        isPending_[i] = false;
+    }
+
+    SafeRelease(&pPyramidSRV_);
+    SafeRelease(&pPyramid_);
+
+    numGpuLevels_ = 0;
+    depthWidth_   = 0;
+    depthHeight_  = 0;
+    writeIdx_     = 0;
+    readIdx_      = 0;
+    isReady_      = false;
+    isGpuReady_   = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void HiZBuffer::CreateResources(ID3D11Device* pDevice, const UINT depthWidth, const UINT depthHeight)
+{
+    // (re)create the GPU pyramid and staging ring for the current depth buffer size
+
+    ReleaseResources();
+
+    // compute sizes of levels: the chain stops at the first level which is small
+    // enough to be read back each frame
+    UINT width  = depthWidth;
+    UINT height = depthHeight;
+
+    while (numGpuLevels_ < MAX_NUM_LEVELS)
+    {
+        width  = (width  + 1) >> 1;
+        height = (height + 1) >> 1;
+
+        levelWidths_[numGpuLevels_]  = width;
+        levelHeights_[numGpuLevels_] = height;
+        ++numGpuLevels_;
+
+        if (width <= MAX_READBACK_WIDTH)
+            break;
+    }
+
+    D3D11_TEXTURE2D_DESC desc;
+    desc.Width              = levelWidths_[0];
+    desc.Height             = levelHeights_[0];
+    desc.MipLevels          = (UINT)numGpuLevels_;
+    desc.ArraySize          = 1;
+    desc.Format             = DXGI_FORMAT_R32_FLOAT;
+    desc.SampleDesc.Count   = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Usage              = D3D11_USAGE_DEFAULT;
+    desc.BindFlags          = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+    desc.CPUAccessFlags     = 0;
+    desc.MiscFlags          = 0;
+
+    HRESULT hr = pDevice->CreateTexture2D(&desc, nullptr, &pPyramid_);
+    CAssert::NotFailed(hr, "can't create a texture for the Hi-Z pyramid");
+
+    // view of the whole pyramid (for occlusion tests on the GPU)
+    hr = pDevice->CreateShaderResourceView(pPyramid_, nullptr, &pPyramidSRV_);
+    CAssert::NotFailed(hr, "can't create a SRV for the Hi-Z pyramid");
+
+    // views of each level
+    for (int i = 0; i < numGpuLevels_; ++i)
+    {
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        srvDesc.Format                    = DXGI_FORMAT_R32_FLOAT;
+        srvDesc.ViewDimension             = D3D11_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MostDetailedMip = (UINT)i;
+        srvDesc.Texture2D.MipLevels       = 1;
+
+        hr = pDevice->CreateShaderResourceView(pPyramid_, &srvDesc, &pLevelSRVs_[i]);
+        CAssert::NotFailed(hr, "can't create a SRV for the Hi-Z level");
+
+        D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+        uavDesc.Format             = DXGI_FORMAT_R32_FLOAT;
+        uavDesc.ViewDimension      = D3D11_UAV_DIMENSION_TEXTURE2D;
+        uavDesc.Texture2D.MipSlice = (UINT)i;
+
+        hr = pDevice->CreateUnorderedAccessView(pPyramid_, &uavDesc, &pLevelUAVs_[i]);
+        CAssert::NotFailed(hr, "can't create a UAV for the Hi-Z level");
+    }
+
+    // staging textures for reading back the last level
+    const int lastLevel = numGpuLevels_ - 1;
+
+    desc.Width          = levelWidths_[lastLevel];
+    desc.Height         = levelHeights_[lastLevel];
+    desc.MipLevels      = 1;
+    desc.Usage          = D3D11_USAGE_STAGING;
+    desc.BindFlags      = 0;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+    for (int i = 0; i < NUM_READBACKS; ++i)
+    {
+        hr = pDevice->CreateTexture2D(&desc, nullptr, &pReadbacks_[i]);
+        CAssert::NotFailed(hr, "can't create a staging texture for the Hi-Z readback");
+    }
+
+    depthWidth_  = depthWidth;
+    depthHeight_ = depthHeight;
+}
+
+///////////////////////////////////////////////////////////
+
+void HiZBuffer::Build(
+    ID3D11DeviceContext* pContext,
+    ID3D11ShaderResourceView* pDepthSRV,
+    const UINT depthWidth,
+    const UINT depthHeight,
+    const UINT depthNumSamples,
+    const XMMATRIX& viewProj)
+{
+    try
+    {
+        if (!pDepthSRV || (depthWidth == 0) || (depthHeight == 0))
+            return;
+
+        // the depth buffer was resized (or it is the first build)
+        if ((depthWidth != depthWidth_) || (depthHeight != depthHeight_))
+        {
+            ID3D11Device* pDevice = nullptr;
+            pContext->GetDevice(&pDevice);
+            CreateResources(pDevice, depthWidth, depthHeight);
+            SafeRelease(&pDevice);
+        }
+
+        // the GPU is too far behind: all the staging textures are still in use
+        if (isPending_[writeIdx_])
+            return;
+
+        ID3D11ShaderResourceView*  nullSRV = nullptr;
+        ID3D11UnorderedAccessView* nullUAV = nullptr;
+
+        pContext->CSSetShader(buildCS_.GetShader(), nullptr, 0);
+        pContext->CSSetConstantBuffers(0, 1, cbBuild_.GetAddressOf());
+
+        UINT srcWidth  = depthWidth;
+        UINT srcHeight = depthHeight;
+
+        for (int i = 0; i < numGpuLevels_; ++i)
+        {
+            ID3D11ShaderResourceView* pSrc       = (i == 0) ? pDepthSRV : pLevelSRVs_[i-1];
+            const UINT                numSamples = (i == 0) ? depthNumSamples : 1;
+
+            cbBuild_.data.srcSize[0] = srcWidth;
+            cbBuild_.data.srcSize[1] = srcHeight;
+            cbBuild_.data.dstSize[0] = levelWidths_[i];
+            cbBuild_.data.dstSize[1] = levelHeights_[i];
+            cbBuild_.data.numSamples = numSamples;
+            cbBuild_.ApplyChanges(pContext);
+
+            // multisampled depth is read through another slot (t1)
+            const UINT srcSlot = (numSamples > 1) ? 1 : 0;
+            pContext->CSSetShaderResources(srcSlot, 1, &pSrc);
+            pContext->CSSetUnorderedAccessViews(0, 1, &pLevelUAVs_[i], nullptr);
+
+            // thread group is 8x8
+            pContext->Dispatch((levelWidths_[i] + 7) / 8, (levelHeights_[i] + 7) / 8, 1);
+
+            // unbind so the level can be read as source by the next dispatch
+            pContext->CSSetShaderResources(srcSlot, 1, &nullSRV);
+            pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+
+            srcWidth  = levelWidths_[i];
+            srcHeight = levelHeights_[i];
+        }
+
+        pContext->CSSetShader(nullptr, nullptr, 0);
+
+        gpuViewProj_ = viewProj;
+        isGpuReady_  = true;
+
+        // enqueue a copy of the last level into the staging ring
+        const UINT lastLevel = (UINT)(numGpuLevels_ - 1);
+        pContext->CopySubresourceRegion(pReadbacks_[writeIdx_], 0, 0, 0, 0, pPyramid_, lastLevel, nullptr);
+
+        readbackViewProjs_[writeIdx_] = viewProj;
+        isPending_[writeIdx_]         = true;
+        writeIdx_                     = (writeIdx_ + 1) % NUM_READBACKS;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't build the Hi-Z buffer");
+        ReleaseResources();
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void HiZBuffer::ReadBack(ID3D11DeviceContext* pContext)
+{
+    // go through pending copies from the oldest one and take the latest
+    // finished copy; stop at the first copy which isn't ready yet
+
+    int readyIdx = -1;
+
+    while (isPending_[readIdx_])
+    {
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        const HRESULT hr = pContext->Map(pReadbacks_[readIdx_], 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+
+        if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+            break;
+
+        if (SUCCEEDED(hr))
+        {
+            // keep only the most fresh one: the prev one is overwritten
+            const int w = (int)levelWidths_[numGpuLevels_ - 1];
+            const int h = (int)levelHeights_[numGpuLevels_ - 1];
+
+            cpuDepths_.resize(w*h);
+            const uint8* pSrc = (const uint8*)mapped.pData;
+
+            for (int y = 0; y < h; ++y)
+                memcpy(cpuDepths_.data() + y*w, pSrc + y*mapped.RowPitch, sizeof(float) * w);
+
+            pContext->Unmap(pReadbacks_[readIdx_], 0);
+
+            cpuLevels_[0].width  = w;
+            cpuLevels_[0].height = h;
+            cpuLevels_[0].offset = 0;
+            readyIdx = readIdx_;
+        }
+
+        isPending_[readIdx_] = false;
+        readIdx_ = (readIdx_ + 1) % NUM_READBACKS;
+    }
+
+    if (readyIdx == -1)
+        return;
+
+    baseShift_      = numGpuLevels_;
+    cpuDepthWidth_  = depthWidth_;
+    cpuDepthHeight_ = depthHeight_;
+    cpuViewProj_    = readbackViewProjs_[readyIdx];
+
+    BuildCPULevels();
+    isReady_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void HiZBuffer::BuildCPULevels()
+{
+    // finish the max-depth pyramid up to a single texel
+
+    int totalTexels = cpuLevels_[0].width * cpuLevels_[0].height;
+    numCpuLevels_ = 1;
+
+    // compute layout of the levels
+    while (numCpuLevels_ < MAX_NUM_LEVELS)
+    {
+        const Level& prev = cpuLevels_[numCpuLevels_ - 1];
+
+        if ((prev.width == 1) && (prev.height == 1))
+            break;
+
+        Level& level = cpuLevels_[numCpuLevels_];
+        level.width  = (prev.width  + 1) >> 1;
+        level.height = (prev.height + 1) >> 1;
+        level.offset = totalTexels;
+
+        totalTexels += level.width * level.height;
+        ++numCpuLevels_;
+    }
+
+    cpuDepths_.resize(totalTexels);
+
+    for (int i = 1; i < numCpuLevels_; ++i)
+    {
+        const Level& src    = cpuLevels_[i-1];
+        const Level& dst    = cpuLevels_[i];
+        const float* srcArr = cpuDepths_.data() + src.offset;
+        float*       dstArr = cpuDepths_.data() + dst.offset;
+
+        for (int y = 0; y < dst.height; ++y)
+        {
+            const int y0 = y * 2;
+            const int y1 = (y0 + 1 < src.height) ? y0 + 1 : y0;
+
+            for (int x = 0; x < dst.width; ++x)
+            {
+                const int x0 = x * 2;
+                const int x1 = (x0 + 1 < src.width) ? x0 + 1 : x0;
+
+                const float d0 = srcArr[y0*src.width + x0];
+                const float d1 = srcArr[y0*src.width + x1];
+                const float d2 = srcArr[y1*src.width + x0];
+                const float d3 = srcArr[y1*src.width + x1];
+
+                const float m0 = (d0 > d1) ? d0 : d1;
+                const float m1 = (d2 > d3) ? d2 : d3;
+                dstArr[y*dst.width + x] = (m0 > m1) ? m0 : m1;
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool HiZBuffer::IsVisible(const XMFLOAT3& aabbMin, const XMFLOAT3& aabbMax) const
+{
+    if (!isReady_)
+        return true;
+
+    // project corners of the box into NDC by the viewProj of the pyramid
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        const XMVECTOR corner = XMVectorSet(
+            (i & 1) ? aabbMax.x : aabbMin.x,
+            (i & 2) ? aabbMax.y : aabbMin.y,
+            (i & 4) ? aabbMax.z : aabbMin.z,
+            1.0f);
+
+        const XMVECTOR clip = XMVector4Transform(corner, cpuViewProj_);
+        const float    w    = XMVectorGetW(clip);
+
+        // the box crosses the near plane: we can't say anything
+        if (w <= 1e-4f)
+            return true;
+
+        XMFLOAT3 ndc;
+        XMStoreFloat3(&ndc, XMVectorScale(clip, 1.0f / w));
+
+        minX = (ndc.x < minX) ? ndc.x : minX;
+        maxX = (ndc.x > maxX) ? ndc.x : maxX;
+        minY = (ndc.y < minY) ? ndc.y : minY;
+        maxY = (ndc.y > maxY) ? ndc.y : maxY;
+        minZ = (ndc.z < minZ) ? ndc.z : minZ;
+    }
+
+    // the box is outside of the old view (the camera has moved since then)
+    if ((maxX < -1.0f) || (minX > 1.0f) || (maxY < -1.0f) || (minY > 1.0f))
+        return true;
+
+    // NDC => pixels of the depth buffer (y goes down)
+    const float fw = (float)cpuDepthWidth_;
+    const float fh = (float)cpuDepthHeight_;
+
+    int px0 = (int)((minX * 0.5f + 0.5f) * fw);
+    int px1 = (int)((maxX * 0.5f + 0.5f) * fw);
+    int py0 = (int)((0.5f - maxY * 0.5f) * fh);
+    int py1 = (int)((0.5f - minY * 0.5f) * fh);
+
+    px0 = (px0 < 0) ? 0 : px0;
+    py0 = (py0 < 0) ? 0 : py0;
+    px1 = (px1 >= (int)cpuDepthWidth_)  ? (int)cpuDepthWidth_  - 1 : px1;
+    py1 = (py1 >= (int)cpuDepthHeight_) ? (int)cpuDepthHeight_ - 1 : py1;
+
+    // pixels => texels of the base level
+    int x0 = px0 >> baseShift_;
+    int x1 = px1 >> baseShift_;
+    int y0 = py0 >> baseShift_;
+    int y1 = py1 >> baseShift_;
+
+    // go up until the rect covers at most 2x2 texels
+    int levelIdx = 0;
+
+    while (((x1 - x0) > 1 || (y1 - y0) > 1) && (levelIdx + 1 < numCpuLevels_))
+    {
+        x0 >>= 1;  x1 >>= 1;
+        y0 >>= 1;  y1 >>= 1;
+        ++levelIdx;
+    }
+
+    const Level& level  = cpuLevels_[levelIdx];
+    const float* depths = cpuDepths_.data() + level.offset;
+    float        maxDepth = 0.0f;
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            const float d = depths[y*level.width + x];
+            maxDepth = (d > maxDepth) ? d : maxDepth;
+        }
+    }
+
+    // the nearest point of the box is behind the farthest occluder depth of the rect
+    return minZ <= maxDepth;
+}
+
+} // namespace Render
@@ -0,0 +1,126 @@
+// =================================================================================
+// Filename:     HiZBuffer.h
+// Description:  hierarchical depth buffer (Hi-Z) for occlusion culling:
+//
+//               - after the scene is rendered we build a max-depth mip chain
+//                 from the depth buffer by a compute shader;
+//               - a small level of this chain is copied into a ring of staging
+//                 textures and is read back a few frames later without stall;
+//               - on CPU we finish the pyramid up to 1x1 and test world AABBs
+//                 against it using the viewProj of the frame it was built from
+//
+//               NOTE: the result has a latency of 1-3 frames so an entity which
+//                     is just uncovered can appear one frame late
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/ComputeShader.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+
+#include <Types.h>
+#include <cvector.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+class HiZBuffer
+{
+public:
+    static constexpr int  MAX_NUM_LEVELS     = 16;
+    static constexpr int  NUM_READBACKS      = 3;    // size of the staging ring
+    static constexpr UINT MAX_READBACK_WIDTH = 256;  // we read back the first level which isn't wider than this
+
+    HiZBuffer() {}
+    ~HiZBuffer();
+
+    // restrict a copying of this class instance
+    HiZBuffer(const HiZBuffer&) = delete;
+    HiZBuffer& operator=(const HiZBuffer&) = delete;
+
+    bool Initialize(ID3D11Device* pDevice, const char* shaderPath);
+    void Shutdown();
+
+    // build the GPU pyramid from the depth buffer (which must be NOT bound as DSV
+    // at this moment) and enqueue a copy of its small level for reading back
+    void Build(
+        ID3D11DeviceContext* pContext,
+        ID3D11ShaderResourceView* pDepthSRV,
+        const UINT depthWidth,
+        const UINT depthHeight,
+        const UINT depthNumSamples,
+        const DirectX::XMMATRIX& viewProj);
+
+    // take the most fresh read back level (if the GPU already finished with it)
+    // and rebuild the CPU pyramid; never waits for the GPU
+    void ReadBack(ID3D11DeviceContext* pContext);
+
+    // test a world AABB against the CPU pyramid:
+    // returns false only if the box is surely hidden behind rendered geometry
+    bool IsVisible(const DirectX::XMFLOAT3& aabbMin, const DirectX::XMFLOAT3& aabbMax) const;
+
+    inline bool IsReady() const { return isReady_; }
+
+    // the GPU pyramid (all the levels) for occlusion tests on the GPU; it is
+    // valid only if IsGpuReady() and corresponds to GetGpuViewProj()
+    inline bool                      IsGpuReady()     const { return isGpuReady_; }
+    inline ID3D11ShaderResourceView* GetPyramidSRV()  const { return pPyramidSRV_; }
+    inline int                       GetNumGpuLevels()const { return numGpuLevels_; }
+    inline UINT                      GetDepthWidth()  const { return depthWidth_; }
+    inline UINT                      GetDepthHeight() const { return depthHeight_; }
+    inline const DirectX::XMMATRIX&  GetGpuViewProj() const { return gpuViewProj_; }
+
+private:
+    struct Level
+    {
+        int width  = 0;
+        int height = 0;
+        int offset = 0;                  // offset of the level's first texel in cpuDepths_
+    };
+
+    void CreateResources(ID3D11Device* pDevice, const UINT depthWidth, const UINT depthHeight);
+    void ReleaseResources();
+    void BuildCPULevels();
+
+private:
+    ComputeShader                              buildCS_;
+    ConstantBuffer<ConstBufType::cbcsHiZBuild> cbBuild_;
+
+    // GPU pyramid: level 0 is half of the depth buffer resolution
+    ID3D11Texture2D*           pPyramid_ = nullptr;
+    ID3D11ShaderResourceView*  pPyramidSRV_ = nullptr;  // all the levels
+    ID3D11ShaderResourceView*  pLevelSRVs_[MAX_NUM_LEVELS]{ nullptr };
+    ID3D11UnorderedAccessView* pLevelUAVs_[MAX_NUM_LEVELS]{ nullptr };
+    UINT                       levelWidths_[MAX_NUM_LEVELS]{ 0 };
+    UINT                       levelHeights_[MAX_NUM_LEVELS]{ 0 };
+    int                        numGpuLevels_ = 0;   // the last one is read back
+
+    UINT                       depthWidth_  = 0;
+    UINT                       depthHeight_ = 0;
+    DirectX::XMMATRIX          gpuViewProj_;        // viewProj of the last built GPU pyramid
+    bool                       isGpuReady_  = false;
+
+    // staging ring
+    ID3D11Texture2D*           pReadbacks_[NUM_READBACKS]{ nullptr };
+    DirectX::XMMATRIX          readbackViewProjs_[NUM_READBACKS];
+    bool                       isPending_[NUM_READBACKS]{ false };
+    int                        writeIdx_ = 0;       // where the next copy goes
+    int                        readIdx_  = 0;       // the oldest pending copy
+
+    // CPU pyramid (base level == the read back GPU level)
+    cvector<float>             cpuDepths_;
+    Level                      cpuLevels_[MAX_NUM_LEVELS];
+    int                        numCpuLevels_ = 0;
+    int                        baseShift_    = 0;   // log2 of depth buffer pixels per base level texel
+    UINT                       cpuDepthWidth_  = 0; // size of the depth buffer the CPU pyramid was built from
+    UINT                       cpuDepthHeight_ = 0;
+    DirectX::XMMATRIX          cpuViewProj_;
+    bool                       isReady_ = false;
+};
+
+} // namespace Render
@@ -16,7 +16,6 @@ namespace Render
 
 bool InitRender::InitializeShaders(
     ID3D11Device* pDevice,
-    ID3D11DeviceContext* pContext,
     ShadersContainer& shadersContainer,
     const DirectX::XMMATRIX& WVO)                 // world * base_view * ortho
 {
@@ -45,7 +44,7 @@ bool InitRender::InitializeShaders(
         result = shadersContainer.textureShader_.Initialize(pDevice, "shaders/textureVS.cso", "shaders/texturePS.cso");
         CAssert::True(result, "can't initialize the texture shader class");
 
-        result = shadersContainer.lightShader_.Initialize(pDevice, "shaders/LightVS.cso", "shaders/LightPS.cso");
+        result = shadersContainer.lightShader_.Initialize(pDevice, "shaders/LightVS.cso", "shaders/LightPS.cso", "shaders/hlsl/LightPS.hlsl");
         CAssert::True(result, "can't initialize the light shader class");
       
 
@@ -53,20 +52,23 @@ bool InitRender::InitializeShaders(
         result = shadersContainer.fontShader_.Initialize(pDevice, WVO, "shaders/fontVS.cso", "shaders/fontPS.cso");
         CAssert::True(result, "can't initialize the font shader class");
 
-        result = shadersContainer.debugShader_.Initialize(pDevice, "shaders/DebugVS.cso", "shaders/DebugPS.cso");
+        result = shadersContainer.debugShader_.Initialize(pDevice, "shaders/DebugVS.cso", "shaders/DebugGS.cso", "shaders/DebugPS.cso");
         CAssert::True(result, "can't initialize the debug shader");
 
         result = shadersContainer.skyDomeShader_.Initialize(pDevice, "shaders/SkyDomeVS.cso", "shaders/SkyDomePS.cso");
         CAssert::True(result, "can't initialize the sky dome shader");
         
 
-        // outline / billboard / material_icon
+        // outline / billboard / impostor / material_icon
         result = shadersContainer.outlineShader_.Initialize(pDevice, "shaders/OutlineVS.cso", "shaders/OutlinePS.cso");
         CAssert::True(result, "can't initialize the outline shader");
 
-        result = shadersContainer.billboardShader_.Initialize(pDevice, "shaders/billboardVS.cso", "shaders/billboardPS.cso", "shaders/billboardGS.cso");
+        result = shadersContainer.billboardShader_.Initialize(pDevice, "shaders/billboardVS.cso", "shaders/billboardPS.cso", "shaders/billboardGS.cso", "shaders/billboardPullVS.cso");
         CAssert::True(result, "can't initialize the billboard shader");
 
+        result = shadersContainer.impostorShader_.Initialize(pDevice, "shaders/ImpostorVS.cso", "shaders/ImpostorGS.cso", "shaders/ImpostorPS.cso");
+        CAssert::True(result, "can't initialize the impostor shader");
+
         result = shadersContainer.materialIconShader_.Initialize(pDevice, "shaders/MaterialIconVS.cso", "shaders/MaterialIconPS.cso");
         if (!result)
             LogErr("can't initialize the material icon shader");
@@ -76,6 +78,26 @@ bool InitRender::InitializeShaders(
         result = shadersContainer.terrainShader_.Initialize(pDevice, "shaders/TerrainVS.cso", "shaders/TerrainPS.cso");
         CAssert::True(result, "can't initialize the terrain shader");
 
+        // the tessellated terrain is optional (the geomipmapped one is used instead)
+        result = shadersContainer.terrainShader_.InitializeTessellation(pDevice, "shaders/TerrainTessVS.cso", "shaders/TerrainHS.cso", "shaders/TerrainDS.cso");
+        if (!result)
+            LogErr("can't initialize the terrain tessellation");
+
+        // vertex pulling of the terrain is optional as well
+        result = shadersContainer.terrainShader_.InitializeVertexPulling(pDevice, "shaders/TerrainGridVS.cso");
+        if (!result)
+            LogErr("can't initialize the terrain vertex pulling");
+
+
+        // upscale (dynamic resolution) and FXAA
+        result = shadersContainer.upscaleShader_.Initialize(pDevice, "shaders/UpscaleVS.cso", "shaders/UpscalePS.cso", "shaders/FxaaPS.cso");
+        CAssert::True(result, "can't initialize the upscale shader");
+
+
+        // debug lines
+        result = shadersContainer.debugLineShader_.Initialize(pDevice, "shaders/DebugLineVS.cso", "shaders/DebugLinePS.cso");
+        CAssert::True(result, "can't initialize the debug line shader");
+
         
         LogDbg("shaders initialization: finished successfully");
         LogMsgf("%s%s", YELLOW, "---------------------------------------------------------");
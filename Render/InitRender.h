@@ -20,7 +20,6 @@ public:
 	// initialize all the shaders (color, texture, light, etc.)
 	bool InitializeShaders(
 		ID3D11Device* pDevice,
-		ID3D11DeviceContext* pDeviceContext,
 		ShadersContainer& shadersContainer,
 		const DirectX::XMMATRIX& WVO);
 };
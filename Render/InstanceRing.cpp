@@ -0,0 +1,179 @@
+// =================================================================================
+// Filename:     InstanceRing.cpp
+// Description:  implementation of the InstanceRing's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "InstanceRing.h"
+#include "FrameStats.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+
+
+namespace Render
+{
+
+InstanceRing::~InstanceRing()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool InstanceRing::Initialize(ID3D11Device* pDevice)
+{
+    try
+    {
+        D3D11_BUFFER_DESC desc;
+        desc.Usage               = D3D11_USAGE_DYNAMIC;
+        desc.ByteWidth           = static_cast<UINT>(sizeof(ConstBufType::InstancedData) * CAPACITY);
+        desc.BindFlags           = D3D11_BIND_VERTEX_BUFFER;
+        desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags           = 0;
+        desc.StructureByteStride = 0;
+
+        HRESULT hr = pDevice->CreateBuffer(&desc, nullptr, &pBuffer_);
+        CAssert::NotFailed(hr, "can't create a buffer for the instances ring");
+
+        D3D11_QUERY_DESC queryDesc;
+        queryDesc.Query     = D3D11_QUERY_EVENT;
+        queryDesc.MiscFlags = 0;
+
+        for (Fence& fence : fences_)
+        {
+            hr = pDevice->CreateQuery(&queryDesc, &fence.pQuery);
+            CAssert::NotFailed(hr, "can't create a fence query for the instances ring");
+        }
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the instances ring");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void InstanceRing::Shutdown()
+{
+    for (Fence& fence : fences_)
+        SafeRelease(&fence.pQuery);
+
+    SafeRelease(&pBuffer_);
+
+    firstFence_  = 0;
+    numFences_   = 0;
+    head_        = 0;
+    tail_        = 0;
+    needDiscard_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+ConstBufType::InstancedData* InstanceRing::Map(
+    ID3D11DeviceContext* pContext,
+    const UINT count,
+    UINT& outBaseInstance)
+{
+    if (count > CAPACITY)
+    {
+        sprintf(g_String, "too many instances for the ring: %u (max: %u)", count, CAPACITY);
+        LogErr(g_String);
+        return nullptr;
+    }
+
+    RetireFinishedFrames(pContext);
+
+    // a range must be contiguous so we skip the rest of the ring if it isn't enough
+    uint64 start = head_;
+    const UINT offset = (UINT)(start % CAPACITY);
+
+    if (offset + count > CAPACITY)
+        start += CAPACITY - offset;
+
+    // the GPU still can read the data we are going to overwrite
+    if (start + count - tail_ > CAPACITY)
+        needDiscard_ = true;
+
+    D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+
+    if (needDiscard_)
+    {
+        // the driver gives us a new memory so all the prev ranges are free
+        mapType      = D3D11_MAP_WRITE_DISCARD;
+        start        = head_ + (CAPACITY - (UINT)(head_ % CAPACITY)) % CAPACITY;
+        tail_        = start;
+        needDiscard_ = false;
+        ++generation_;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    const HRESULT hr = pContext->Map(pBuffer_, 0, mapType, 0, &mapped);
+
+    if (FAILED(hr))
+    {
+        LogErr("can't map the instances ring");
+        needDiscard_ = true;
+        return nullptr;
+    }
+
+    head_           = start + count;
+    outBaseInstance = (UINT)(start % CAPACITY);
+
+    g_FrameStats.AddUpload(UPLOAD_INSTANCES, (uint64)count * sizeof(ConstBufType::InstancedData));
+
+    return (ConstBufType::InstancedData*)mapped.pData + outBaseInstance;
+}
+
+///////////////////////////////////////////////////////////
+
+void InstanceRing::Unmap(ID3D11DeviceContext* pContext)
+{
+    pContext->Unmap(pBuffer_, 0);
+}
+
+///////////////////////////////////////////////////////////
+
+void InstanceRing::EndFrame(ID3D11DeviceContext* pContext)
+{
+    RetireFinishedFrames(pContext);
+
+    // all the fences are in flight: the data of this frame will be retired
+    // together with the next frame (so we are just more conservative)
+    if (numFences_ == NUM_FENCES)
+        return;
+
+    Fence& fence = fences_[(firstFence_ + numFences_) % NUM_FENCES];
+    fence.end = head_;
+    pContext->End(fence.pQuery);
+    ++numFences_;
+}
+
+
+// =================================================================================
+// PRIVATE HELPERS
+// =================================================================================
+void InstanceRing::RetireFinishedFrames(ID3D11DeviceContext* pContext)
+{
+    // move the tail over frames which are already finished by the GPU
+    while (numFences_ > 0)
+    {
+        Fence& fence = fences_[firstFence_];
+
+        if (pContext->GetData(fence.pQuery, nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+            break;
+
+        // after a discard the tail can be already farther
+        tail_ = (fence.end > tail_) ? fence.end : tail_;
+
+        firstFence_ = (firstFence_ + 1) % NUM_FENCES;
+        --numFences_;
+    }
+}
+
+} // namespace Render
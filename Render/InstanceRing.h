@@ -0,0 +1,84 @@
+// =================================================================================
+// Filename:     InstanceRing.h
+// Description:  a persistent ring of instances data (ConstBufType::InstancedData)
+//               which is shared by all the instanced passes:
+//
+//               - each pass sub-allocates a contiguous range of the ring and
+//                 writes into it with MAP_WRITE_NO_OVERWRITE;
+//               - at the end of each frame we put a fence (event query); a range
+//                 is reused only after the fence of the frame it was written in
+//                 is passed by the GPU;
+//               - if there is no free space (the GPU is too far behind) we fall
+//                 back to MAP_WRITE_DISCARD and start over (the generation of
+//                 the ring is changed so earlier ranges become invalid)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Common/ConstBufferTypes.h"
+
+#include <Types.h>
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+class InstanceRing
+{
+public:
+    static constexpr UINT CAPACITY   = 32768;        // max number of instances elements in the ring
+    static constexpr int  NUM_FENCES = 4;            // max number of frames in flight we track
+
+    InstanceRing() {}
+    ~InstanceRing();
+
+    // restrict a copying of this class instance
+    InstanceRing(const InstanceRing&) = delete;
+    InstanceRing& operator=(const InstanceRing&) = delete;
+
+    bool Initialize(ID3D11Device* pDevice);
+    void Shutdown();
+
+    // sub-allocate a range of count elements and map it for writing;
+    // out: start instance location of the range (for DrawIndexedInstanced)
+    // ret: ptr to the first element of the range or nullptr if count is too big
+    ConstBufType::InstancedData* Map(
+        ID3D11DeviceContext* pContext,
+        const UINT count,
+        UINT& outBaseInstance);
+
+    void Unmap(ID3D11DeviceContext* pContext);
+
+    // put a fence after all the draws of this frame
+    void EndFrame(ID3D11DeviceContext* pContext);
+
+    inline ID3D11Buffer* GetBuffer()     const { return pBuffer_; }
+    inline UINT          GetGeneration() const { return generation_; }
+
+private:
+    void RetireFinishedFrames(ID3D11DeviceContext* pContext);
+
+private:
+    struct Fence
+    {
+        ID3D11Query* pQuery = nullptr;
+        uint64       end    = 0;                // ring head at the end of the frame
+    };
+
+    ID3D11Buffer* pBuffer_ = nullptr;
+
+    Fence         fences_[NUM_FENCES];
+    int           firstFence_ = 0;              // the oldest fence in flight
+    int           numFences_  = 0;
+
+    // monotonic counters of elements (the offset in the ring is counter % CAPACITY)
+    uint64        head_ = 0;                    // the next free element
+    uint64        tail_ = 0;                    // the oldest element which can be still read by the GPU
+
+    UINT          generation_   = 0;            // is changed by each discard of the buffer
+    bool          needDiscard_  = true;         // the first map must discard
+};
+
+} // namespace Render
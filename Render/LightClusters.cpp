@@ -0,0 +1,491 @@
+// =================================================================================
+// Filename:     LightClusters.cpp
+// Description:  implementation of the LightClusters' functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "LightClusters.h"
+#include <MemHelpers.h>
+#include <JobSystem.h>
+#include <log.h>
+#include <CAssert.h>
+#include <math.h>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+LightClusters::~LightClusters()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+void LightClusters::Shutdown()
+{
+    ReleaseArray(pointLightsBuf_);
+    ReleaseArray(residentPointLightsBuf_);
+    ReleaseArray(spotLightsBuf_);
+    ReleaseArray(clustersBuf_);
+    ReleaseArray(lightIdxsBuf_);
+}
+
+///////////////////////////////////////////////////////////
+
+void LightClusters::PatchResidentPointLights(
+    ID3D11DeviceContext* pContext,
+    const PointLight* lights,
+    const uint32* idxs,
+    const int numPatches,
+    const int numLights)
+{
+    try
+    {
+        CAssert::True(numPatches == 0 || (lights && idxs), "input arr of patches == nullptr");
+
+        GpuArray& arr = residentPointLightsBuf_;
+        constexpr UINT stride = sizeof(PointLight);
+
+        // grow the buffer keeping lights which are already there
+        if ((numLights > arr.capacity) || !arr.pBuffer)
+        {
+            ID3D11Device* pDevice = nullptr;
+            pContext->GetDevice(&pDevice);
+
+            const int capacity = (numLights > 0) ? numLights + (numLights >> 1) : 1;
+
+            D3D11_BUFFER_DESC desc;
+            desc.Usage               = D3D11_USAGE_DEFAULT;
+            desc.ByteWidth           = stride * (UINT)capacity;
+            desc.BindFlags           = D3D11_BIND_SHADER_RESOURCE;
+            desc.CPUAccessFlags      = 0;
+            desc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+            desc.StructureByteStride = stride;
+
+            GpuArray newArr;
+            HRESULT hr = pDevice->CreateBuffer(&desc, nullptr, &newArr.pBuffer);
+
+            if (SUCCEEDED(hr))
+            {
+                D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+                srvDesc.Format              = DXGI_FORMAT_UNKNOWN;
+                srvDesc.ViewDimension       = D3D11_SRV_DIMENSION_BUFFER;
+                srvDesc.Buffer.FirstElement = 0;
+                srvDesc.Buffer.NumElements  = capacity;
+
+                hr = pDevice->CreateShaderResourceView(newArr.pBuffer, &srvDesc, &newArr.pSRV);
+            }
+
+            SafeRelease(&pDevice);
+
+            if (FAILED(hr))
+                ReleaseArray(newArr);
+
+            CAssert::NotFailed(hr, "can't create a buffer of resident point lights");
+
+            if (arr.pBuffer)
+                pContext->CopySubresourceRegion(newArr.pBuffer, 0, 0, 0, 0, arr.pBuffer, 0, nullptr);
+
+            ReleaseArray(arr);
+            arr = newArr;
+            arr.capacity = capacity;
+        }
+
+        // write runs of lights with neighbour idxs by a single update
+        for (int i = 0; i < numPatches; )
+        {
+            int runEnd = i + 1;
+
+            while ((runEnd < numPatches) && (idxs[runEnd] == idxs[runEnd - 1] + 1))
+                ++runEnd;
+
+            const D3D11_BOX box = { idxs[i] * stride, 0, 0, (idxs[runEnd - 1] + 1) * stride, 1, 1 };
+            pContext->UpdateSubresource(arr.pBuffer, 0, &box, lights + i, 0, 0);
+
+            i = runEnd;
+        }
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't patch resident point lights");
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void LightClusters::Update(
+    ID3D11DeviceContext* pContext,
+    const PointLight* pointLights,
+    const uint32* visPointLightIdxs,
+    const SpotLight* spotLights,
+    const int numPointLights,
+    const int numSpotLights,
+    const XMMATRIX& view,
+    const XMMATRIX& proj,
+    const float screenWidth,
+    const float screenHeight,
+    ConstBufType::cbpsPerFrame& outParams)
+{
+    try
+    {
+        CAssert::True(screenWidth > 0 && screenHeight > 0, "input screen size must be > 0");
+        CAssert::True(numPointLights == 0 || pointLights, "input arr of point lights == nullptr");
+        CAssert::True(numSpotLights  == 0 || spotLights,  "input arr of spot lights == nullptr");
+
+        // extract params of the perspective projection:
+        // m33 = f/(f-n), m43 = -n*f/(f-n)
+        const float m33 = XMVectorGetZ(proj.r[2]);
+        const float m43 = XMVectorGetZ(proj.r[3]);
+
+        view_  = view;
+        p00_   = XMVectorGetX(proj.r[0]);
+        p11_   = XMVectorGetY(proj.r[1]);
+        nearZ_ = -m43 / m33;
+        farZ_  = m43 / (1.0f - m33);
+
+        // exponential slices: slice = log(z/near) / log(far/near) * DIM_Z
+        const float logFarNear = logf(farZ_ / nearZ_);
+        sliceScale_ = (float)DIM_Z / logFarNear;
+        sliceBias_  = -(float)DIM_Z * logf(nearZ_) / logFarNear;
+
+        // compute which clusters each light touches
+        pointBounds_.resize(numPointLights);
+        spotBounds_.resize(numSpotLights);
+
+        for (int i = 0; i < numPointLights; ++i)
+            ComputeBounds(pointLights[i].position, pointLights[i].range, pointBounds_[i]);
+
+        for (int i = 0; i < numSpotLights; ++i)
+            ComputeBounds(spotLights[i].position, spotLights[i].range, spotBounds_[i]);
+
+        // clusters refer to resident point lights by their idxs
+        visPointLightIdxs_ = visPointLightIdxs;
+        AssignLights();
+
+        // upload into GPU (resident point lights are already there)
+        if (!visPointLightIdxs_)
+            UploadArray(pContext, pointLightsBuf_, pointLights, numPointLights, sizeof(PointLight));
+
+        UploadArray(pContext, spotLightsBuf_,  spotLights,         numSpotLights,              sizeof(SpotLight));
+        UploadArray(pContext, clustersBuf_,    clusters_.data(),   NUM_CLUSTERS,               sizeof(uint32) * 2);
+        UploadArray(pContext, lightIdxsBuf_,   lightIdxs_.data(),  (int)lightIdxs_.size(),     sizeof(uint32));
+
+        // params for the pixel shader so it can find its cluster
+        outParams.currNumPointLights = numPointLights;
+        outParams.currNumSpotLights  = numSpotLights;
+        outParams.clusterDims[0]     = DIM_X;
+        outParams.clusterDims[1]     = DIM_Y;
+        outParams.clusterDims[2]     = DIM_Z;
+        outParams.clusterScaleX      = (float)DIM_X / screenWidth;
+        outParams.clusterScaleY      = (float)DIM_Y / screenHeight;
+        outParams.clusterSliceScale  = sliceScale_;
+        outParams.clusterSliceBias   = sliceBias_;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't update light clusters");
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void LightClusters::Bind(ID3D11DeviceContext* pContext, StateCache& stateCache)
+{
+    ID3D11ShaderResourceView* pPointLightsSRV = (visPointLightIdxs_) ? residentPointLightsBuf_.pSRV : pointLightsBuf_.pSRV;
+
+    stateCache.SetPSShaderResources(pContext, POINT_LIGHTS_SLOT, 1, &pPointLightsSRV);
+    stateCache.SetPSShaderResources(pContext, SPOT_LIGHTS_SLOT,  1, &spotLightsBuf_.pSRV);
+    stateCache.SetPSShaderResources(pContext, CLUSTERS_SLOT,     1, &clustersBuf_.pSRV);
+    stateCache.SetPSShaderResources(pContext, LIGHT_IDXS_SLOT,   1, &lightIdxsBuf_.pSRV);
+}
+
+///////////////////////////////////////////////////////////
+
+void LightClusters::BindCS(ID3D11DeviceContext* pContext)
+{
+    // the slots are consecutive: point lights, spot lights, clusters, light idxs
+    static_assert((SPOT_LIGHTS_SLOT == POINT_LIGHTS_SLOT + 1) && (LIGHT_IDXS_SLOT == POINT_LIGHTS_SLOT + 3), "slots must be consecutive");
+
+    ID3D11ShaderResourceView* const srvs[4] =
+    {
+        (visPointLightIdxs_) ? residentPointLightsBuf_.pSRV : pointLightsBuf_.pSRV,
+        spotLightsBuf_.pSRV,
+        clustersBuf_.pSRV,
+        lightIdxsBuf_.pSRV,
+    };
+
+    pContext->CSSetShaderResources(POINT_LIGHTS_SLOT, 4, srvs);
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+void LightClusters::ComputeBounds(
+    const XMFLOAT3& posW,
+    const float range,
+    LightBounds& outBounds) const
+{
+    // find a range of clusters which is touched by the light sphere;
+    // the range is conservative: we use the view space AABB of the sphere
+
+    outBounds = { 0, -1, 0, -1, 1, 0 };
+
+    XMFLOAT3 c;
+    XMStoreFloat3(&c, XMVector3TransformCoord(XMLoadFloat3(&posW), view_));
+
+    const float zMin = c.z - range;
+    const float zMax = c.z + range;
+
+    // the light is fully behind the camera or farther than the far plane
+    if ((zMax < nearZ_) || (zMin > farZ_))
+        return;
+
+    // depth slices
+    const float zFrom = (zMin > nearZ_) ? zMin : nearZ_;
+    const float zTo   = (zMax < farZ_)  ? zMax : farZ_;
+    const int   z0    = (int)floorf(logf(zFrom) * sliceScale_ + sliceBias_);
+    const int   z1    = (int)floorf(logf(zTo)   * sliceScale_ + sliceBias_);
+
+    outBounds.minZ = (z0 < 0) ? 0 : z0;
+    outBounds.maxZ = (z1 >= DIM_Z) ? DIM_Z-1 : z1;
+
+    // the sphere crosses the near plane: its projection is unbounded so take the whole screen
+    if (zMin <= nearZ_)
+    {
+        outBounds.minX = 0;
+        outBounds.maxX = DIM_X - 1;
+        outBounds.minY = 0;
+        outBounds.maxY = DIM_Y - 1;
+        return;
+    }
+
+    // project the AABB: extremes of x/z and y/z are reached at the min/max depth
+    const float invZMin = 1.0f / zMin;
+    const float invZMax = 1.0f / zMax;
+
+    const float l = c.x - range;
+    const float r = c.x + range;
+    const float b = c.y - range;
+    const float t = c.y + range;
+
+    const float ndcMinX = p00_ * ((l*invZMin < l*invZMax) ? l*invZMin : l*invZMax);
+    const float ndcMaxX = p00_ * ((r*invZMin > r*invZMax) ? r*invZMin : r*invZMax);
+    const float ndcMinY = p11_ * ((b*invZMin < b*invZMax) ? b*invZMin : b*invZMax);
+    const float ndcMaxY = p11_ * ((t*invZMin > t*invZMax) ? t*invZMin : t*invZMax);
+
+    // outside of the frustum
+    if ((ndcMaxX < -1.0f) || (ndcMinX > 1.0f) || (ndcMaxY < -1.0f) || (ndcMinY > 1.0f))
+    {
+        outBounds.minZ = 1;
+        outBounds.maxZ = 0;
+        return;
+    }
+
+    // NDC => tiles (y goes down on the screen)
+    const int x0 = (int)floorf((ndcMinX * 0.5f + 0.5f) * DIM_X);
+    const int x1 = (int)floorf((ndcMaxX * 0.5f + 0.5f) * DIM_X);
+    const int y0 = (int)floorf((0.5f - ndcMaxY * 0.5f) * DIM_Y);
+    const int y1 = (int)floorf((0.5f - ndcMinY * 0.5f) * DIM_Y);
+
+    outBounds.minX = (x0 < 0) ? 0 : x0;
+    outBounds.maxX = (x1 >= DIM_X) ? DIM_X-1 : x1;
+    outBounds.minY = (y0 < 0) ? 0 : y0;
+    outBounds.maxY = (y1 >= DIM_Y) ? DIM_Y-1 : y1;
+}
+
+///////////////////////////////////////////////////////////
+
+void LightClusters::AssignLights()
+{
+    // build per-cluster lists of lights:
+    // 1. count lights per cluster (in parallel over depth slices,
+    //    clusters of different slices don't overlap so there are no races);
+    // 2. compute offsets of lists by prefix sum;
+    // 3. fill in the lists (in parallel over depth slices again)
+
+    constexpr int CLUSTERS_PER_SLICE = DIM_X * DIM_Y;
+
+    const int numPointLights = (int)pointBounds_.size();
+    const int numSpotLights  = (int)spotBounds_.size();
+
+    numPointsInCluster_.resize(NUM_CLUSTERS);
+    numSpotsInCluster_.resize(NUM_CLUSTERS);
+    clusters_.resize(NUM_CLUSTERS * 2);
+
+    // 1. counting
+    g_JobSystem.ParallelFor(DIM_Z, 1, [&](const index start, const index end)
+    {
+        for (index z = start; z < end; ++z)
+        {
+            uint32* numPoints = numPointsInCluster_.data() + z * CLUSTERS_PER_SLICE;
+            uint32* numSpots  = numSpotsInCluster_.data()  + z * CLUSTERS_PER_SLICE;
+
+            memset(numPoints, 0, sizeof(uint32) * CLUSTERS_PER_SLICE);
+            memset(numSpots,  0, sizeof(uint32) * CLUSTERS_PER_SLICE);
+
+            for (const LightBounds& lb : pointBounds_)
+            {
+                if ((z < lb.minZ) || (z > lb.maxZ))
+                    continue;
+
+                for (int y = lb.minY; y <= lb.maxY; ++y)
+                    for (int x = lb.minX; x <= lb.maxX; ++x)
+                        ++numPoints[y*DIM_X + x];
+            }
+
+            // skip the flashlight
+            for (int i = 1; i < numSpotLights; ++i)
+            {
+                const LightBounds& lb = spotBounds_[i];
+
+                if ((z < lb.minZ) || (z > lb.maxZ))
+                    continue;
+
+                for (int y = lb.minY; y <= lb.maxY; ++y)
+                    for (int x = lb.minX; x <= lb.maxX; ++x)
+                        ++numSpots[y*DIM_X + x];
+            }
+        }
+    });
+
+    // 2. offsets
+    uint32 numIdxs = 0;
+
+    for (int i = 0; i < NUM_CLUSTERS; ++i)
+    {
+        const uint32 numPoints = numPointsInCluster_[i];
+        const uint32 numSpots  = numSpotsInCluster_[i];
+
+        // counts are packed by 16 bits
+        CAssert::True((numPoints <= 0xFFFF) && (numSpots <= 0xFFFF), "too many lights in a cluster");
+
+        clusters_[i*2 + 0] = numIdxs;
+        clusters_[i*2 + 1] = numPoints | (numSpots << 16);
+        numIdxs += numPoints + numSpots;
+    }
+
+    lightIdxs_.resize(numIdxs);
+
+    // 3. filling (the counters are reused as write cursors)
+    g_JobSystem.ParallelFor(DIM_Z, 1, [&](const index start, const index end)
+    {
+        for (index z = start; z < end; ++z)
+        {
+            const int firstCluster = (int)z * CLUSTERS_PER_SLICE;
+            uint32*   pointCursors = numPointsInCluster_.data() + firstCluster;
+            uint32*   spotCursors  = numSpotsInCluster_.data()  + firstCluster;
+
+            for (int i = 0; i < CLUSTERS_PER_SLICE; ++i)
+            {
+                const uint32 offset    = clusters_[(firstCluster + i) * 2];
+                const uint32 numPoints = clusters_[(firstCluster + i) * 2 + 1] & 0xFFFF;
+
+                pointCursors[i] = offset;
+                spotCursors[i]  = offset + numPoints;
+            }
+
+            for (int lightIdx = 0; lightIdx < numPointLights; ++lightIdx)
+            {
+                const LightBounds& lb = pointBounds_[lightIdx];
+
+                if ((z < lb.minZ) || (z > lb.maxZ))
+                    continue;
+
+                const uint32 pointIdx = (visPointLightIdxs_) ? visPointLightIdxs_[lightIdx] : (uint32)lightIdx;
+
+                for (int y = lb.minY; y <= lb.maxY; ++y)
+                    for (int x = lb.minX; x <= lb.maxX; ++x)
+                        lightIdxs_[pointCursors[y*DIM_X + x]++] = pointIdx;
+            }
+
+            for (int lightIdx = 1; lightIdx < numSpotLights; ++lightIdx)
+            {
+                const LightBounds& lb = spotBounds_[lightIdx];
+
+                if ((z < lb.minZ) || (z > lb.maxZ))
+                    continue;
+
+                for (int y = lb.minY; y <= lb.maxY; ++y)
+                    for (int x = lb.minX; x <= lb.maxX; ++x)
+                        lightIdxs_[spotCursors[y*DIM_X + x]++] = (uint32)lightIdx;
+            }
+        }
+    });
+}
+
+///////////////////////////////////////////////////////////
+
+void LightClusters::UploadArray(
+    ID3D11DeviceContext* pContext,
+    GpuArray& arr,
+    const void* data,
+    const int numElems,
+    const UINT stride)
+{
+    // write data into a dynamic structured buffer (it grows if there is not enough space)
+
+    if (numElems > arr.capacity || !arr.pBuffer)
+    {
+        ReleaseArray(arr);
+
+        ID3D11Device* pDevice = nullptr;
+        pContext->GetDevice(&pDevice);
+
+        // reserve some space so adding of a few elements won't cause recreation;
+        // (an empty buffer can't be created so there is at least one element)
+        const int capacity = (numElems > 0) ? numElems + (numElems >> 1) : 1;
+
+        D3D11_BUFFER_DESC desc;
+        desc.Usage               = D3D11_USAGE_DYNAMIC;
+        desc.ByteWidth           = stride * (UINT)capacity;
+        desc.BindFlags           = D3D11_BIND_SHADER_RESOURCE;
+        desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        desc.StructureByteStride = stride;
+
+        HRESULT hr = pDevice->CreateBuffer(&desc, nullptr, &arr.pBuffer);
+
+        if (SUCCEEDED(hr))
+        {
+            D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+            srvDesc.Format              = DXGI_FORMAT_UNKNOWN;
+            srvDesc.ViewDimension       = D3D11_SRV_DIMENSION_BUFFER;
+            srvDesc.Buffer.FirstElement = 0;
+            srvDesc.Buffer.NumElements  = capacity;
+
+            hr = pDevice->CreateShaderResourceView(arr.pBuffer, &srvDesc, &arr.pSRV);
+        }
+
+        SafeRelease(&pDevice);
+        CAssert::NotFailed(hr, "can't create a structured buffer for light clusters");
+
+        arr.capacity = capacity;
+    }
+
+    if (numElems == 0)
+        return;
+
+    D3D11_MAPPED_SUBRESOURCE mappedData;
+    const HRESULT hr = pContext->Map(arr.pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+    CAssert::NotFailed(hr, "can't map a structured buffer of light clusters");
+
+    memcpy(mappedData.pData, data, stride * numElems);
+    pContext->Unmap(arr.pBuffer, 0);
+}
+
+///////////////////////////////////////////////////////////
+
+void LightClusters::ReleaseArray(GpuArray& arr)
+{
+    SafeRelease(&arr.pSRV);
+    SafeRelease(&arr.pBuffer);
+    arr.capacity = 0;
+}
+
+} // namespace Render
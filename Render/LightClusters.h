@@ -0,0 +1,154 @@
+// =================================================================================
+// Filename:     LightClusters.h
+// Description:  clustered forward lighting: the view frustum is split into
+//               a 3D grid of clusters (screen tiles x exponential depth slices)
+//               and each cluster gets a list of point/spot lights which reach it;
+//
+//               - lights go into structured buffers (so their number isn't limited
+//                 by a size of the constant buffer);
+//               - point lights can be resident: the GPU keeps a copy of all of
+//                 them which is patched only by changed lights, and clusters
+//                 refer to visible lights by their resident idxs;
+//               - per-cluster lists are built on CPU by the job system
+//                 (in parallel over depth slices) each frame;
+//               - the pixel shader finds its cluster by SV_Position and
+//                 shades only lights of this cluster
+//
+//               NOTE: the spot light by idx 0 is the flashlight, it isn't put
+//                     into clusters (is computed separately by its flag)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Common/MaterialLightTypes.h"
+#include "Common/ConstBufferTypes.h"
+#include "StateCache.h"
+
+#include <Types.h>
+#include <cvector.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+class LightClusters
+{
+public:
+    // size of the clusters grid
+    static constexpr int DIM_X        = 16;
+    static constexpr int DIM_Y        = 9;
+    static constexpr int DIM_Z        = 24;
+    static constexpr int NUM_CLUSTERS = DIM_X * DIM_Y * DIM_Z;
+
+    // pixel shader slots of buffers (must be the same as in ClusteredLights.hlsli)
+    static constexpr UINT POINT_LIGHTS_SLOT = 24;
+    static constexpr UINT SPOT_LIGHTS_SLOT  = 25;
+    static constexpr UINT CLUSTERS_SLOT     = 26;
+    static constexpr UINT LIGHT_IDXS_SLOT   = 27;
+
+    LightClusters() {}
+    ~LightClusters();
+
+    // restrict a copying of this class instance
+    LightClusters(const LightClusters&) = delete;
+    LightClusters& operator=(const LightClusters&) = delete;
+
+    void Shutdown();
+
+    // write changed point lights into the resident copy of all point lights
+    // (it grows if numLights is bigger than its capacity keeping old lights)
+    void PatchResidentPointLights(
+        ID3D11DeviceContext* pContext,
+        const PointLight* lights,
+        const uint32* idxs,                      // sorted resident idxs of lights
+        const int numPatches,
+        const int numLights);
+
+    // assign lights to clusters, upload everything into GPU buffers
+    // and setup params of the grid in the per frame const buffer;
+    // visPointLightIdxs: resident idx of each visible point light
+    //                    (if null the visible point lights are uploaded as is)
+    void Update(
+        ID3D11DeviceContext* pContext,
+        const PointLight* pointLights,
+        const uint32* visPointLightIdxs,
+        const SpotLight* spotLights,
+        const int numPointLights,
+        const int numSpotLights,
+        const DirectX::XMMATRIX& view,           // NOT transposed
+        const DirectX::XMMATRIX& proj,           // NOT transposed
+        const float screenWidth,
+        const float screenHeight,
+        ConstBufType::cbpsPerFrame& outParams);
+
+    // bind all the buffers to the pixel shader stage
+    void Bind(ID3D11DeviceContext* pContext, StateCache& stateCache);
+
+    // bind all the buffers to the compute shader stage by the same slots
+    // (for the deferred lighting which shares the lists of clusters)
+    void BindCS(ID3D11DeviceContext* pContext);
+
+private:
+    struct LightBounds
+    {
+        // range of clusters which are touched by a light (inclusive);
+        // if the light isn't visible: minZ > maxZ
+        int minX, maxX;
+        int minY, maxY;
+        int minZ, maxZ;
+    };
+
+    struct GpuArray
+    {
+        ID3D11Buffer*             pBuffer  = nullptr;
+        ID3D11ShaderResourceView* pSRV     = nullptr;
+        int                       capacity = 0;
+    };
+
+    void ComputeBounds(
+        const DirectX::XMFLOAT3& posW,
+        const float range,
+        LightBounds& outBounds) const;
+
+    void AssignLights();
+
+    static void UploadArray(
+        ID3D11DeviceContext* pContext,
+        GpuArray& arr,
+        const void* data,
+        const int numElems,
+        const UINT stride);
+
+    static void ReleaseArray(GpuArray& arr);
+
+private:
+    // params of the current frame
+    DirectX::XMMATRIX    view_;
+    float                p00_        = 1.0f;   // projection scale by x
+    float                p11_        = 1.0f;   // projection scale by y
+    float                nearZ_      = 1.0f;
+    float                farZ_       = 1000.0f;
+    float                sliceScale_ = 1.0f;   // view depth => slice: log(z) * scale + bias
+    float                sliceBias_  = 0.0f;
+
+    cvector<LightBounds> pointBounds_;
+    cvector<LightBounds> spotBounds_;          // [0] is the flashlight (not used)
+
+    // per cluster: offset into light idxs list and (numPoint | numSpot << 16)
+    cvector<uint32>      numPointsInCluster_;
+    cvector<uint32>      numSpotsInCluster_;
+    cvector<uint32>      clusters_;            // pairs of uint32 (as uint2 in HLSL)
+    cvector<uint32>      lightIdxs_;           // for each cluster: idxs of point lights and then spot lights
+    const uint32*        visPointLightIdxs_ = nullptr;  // resident idxs of visible point lights (for the current update)
+
+    GpuArray             pointLightsBuf_;        // visible point lights (if they aren't resident)
+    GpuArray             residentPointLightsBuf_;// all point lights (DEFAULT usage)
+    GpuArray             spotLightsBuf_;
+    GpuArray             clustersBuf_;
+    GpuArray             lightIdxsBuf_;
+};
+
+} // namespace Render
@@ -0,0 +1,224 @@
+// =================================================================================
+// Filename:     LowResBlending.cpp
+// Description:  implementation of the LowResBlending's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "LowResBlending.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+static_assert(sizeof(ConstBufType::cbLowResBlend) % 16 == 0, "size of the const buffer must be a multiple of 16");
+
+///////////////////////////////////////////////////////////
+
+LowResBlending::~LowResBlending()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool LowResBlending::Initialize(
+    ID3D11Device* pDevice,
+    const char* vsFilePath,
+    const char* depthPSFilePath,
+    const char* compositePSFilePath)
+{
+    try
+    {
+        // the fullscreen triangle is generated by SV_VertexID
+        bool result = vs_.Initialize(pDevice, vsFilePath, nullptr, 0);
+        CAssert::True(result, "can't initialize the fullscreen vertex shader");
+
+        result = depthPS_.Initialize(pDevice, depthPSFilePath);
+        CAssert::True(result, "can't initialize the depth downsampling pixel shader");
+
+        result = compositePS_.Initialize(pDevice, compositePSFilePath);
+        CAssert::True(result, "can't initialize the composite pixel shader");
+
+        HRESULT hr = cbLowRes_.Initialize(pDevice);
+        CAssert::NotFailed(hr, "can't initialize the const buffer of the low resolution blending");
+
+        // depth states
+        D3D11_DEPTH_STENCIL_DESC dssDesc;
+        ZeroMemory(&dssDesc, sizeof(dssDesc));
+        dssDesc.DepthEnable    = TRUE;
+        dssDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+        dssDesc.DepthFunc      = D3D11_COMPARISON_ALWAYS;
+        dssDesc.StencilEnable  = FALSE;
+
+        hr = pDevice->CreateDepthStencilState(&dssDesc, &pDepthWriteState_);
+        CAssert::NotFailed(hr, "can't create a depth stencil state for the downsampling");
+
+        dssDesc.DepthEnable    = FALSE;
+        dssDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+
+        hr = pDevice->CreateDepthStencilState(&dssDesc, &pNoDepthState_);
+        CAssert::NotFailed(hr, "can't create a depth stencil state for the composite");
+
+        // blend states
+        D3D11_BLEND_DESC blendDesc;
+        ZeroMemory(&blendDesc, sizeof(blendDesc));
+
+        D3D11_RENDER_TARGET_BLEND_DESC& rt = blendDesc.RenderTarget[0];
+        rt.BlendEnable           = FALSE;
+        rt.SrcBlend              = D3D11_BLEND_ONE;
+        rt.DestBlend             = D3D11_BLEND_ZERO;
+        rt.BlendOp               = D3D11_BLEND_OP_ADD;
+        rt.SrcBlendAlpha         = D3D11_BLEND_ONE;
+        rt.DestBlendAlpha        = D3D11_BLEND_ZERO;
+        rt.BlendOpAlpha          = D3D11_BLEND_OP_ADD;
+        rt.RenderTargetWriteMask = 0;
+
+        hr = pDevice->CreateBlendState(&blendDesc, &pNoColorState_);
+        CAssert::NotFailed(hr, "can't create a blend state for the downsampling");
+
+        // the scene color is covered by the low resolution one: dst * (1 - coverage) + rgb
+        rt.BlendEnable           = TRUE;
+        rt.DestBlend             = D3D11_BLEND_INV_SRC_ALPHA;
+        rt.DestBlendAlpha        = D3D11_BLEND_INV_SRC_ALPHA;
+        rt.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+        hr = pDevice->CreateBlendState(&blendDesc, &pPremulState_);
+        CAssert::NotFailed(hr, "can't create a blend state for the composite");
+
+        isInit_ = true;
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the low resolution blending");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void LowResBlending::Shutdown()
+{
+    SafeRelease(&pDepthWriteState_);
+    SafeRelease(&pNoDepthState_);
+    SafeRelease(&pNoColorState_);
+    SafeRelease(&pPremulState_);
+
+    vs_.Shutdown();
+    depthPS_.Shutdown();
+    compositePS_.Shutdown();
+    isInit_ = false;
+}
+
+//---------------------------------------------------------
+// Desc:   clear the low resolution color and fill the bound low resolution
+//         depth by the farthest depth of each factor x factor block of the
+//         scene depth (so the blended content isn't cut by thin foreground)
+//---------------------------------------------------------
+void LowResBlending::Downsample(
+    ID3D11DeviceContext* pContext,
+    ID3D11RenderTargetView* pLowColorRTV,
+    ID3D11ShaderResourceView* pSceneDepthSRV,
+    const UINT factor,
+    const UINT sceneWidth,
+    const UINT sceneHeight)
+{
+    if (!isInit_ || !pLowColorRTV || !pSceneDepthSRV)
+        return;
+
+    // nothing is covered yet
+    const FLOAT clearColor[4] = { 0,0,0,0 };
+    pContext->ClearRenderTargetView(pLowColorRTV, clearColor);
+
+    UpdateConstBuffer(pContext, factor, sceneWidth, sceneHeight);
+    SetupFullscreen(pContext, depthPS_);
+
+    const FLOAT blendFactor[4] = { 0,0,0,0 };
+    pStateCache_->SetBlendState(pContext, pNoColorState_, blendFactor, 0xFFFFFFFF);
+    pStateCache_->SetDepthStencilState(pContext, pDepthWriteState_, 0);
+    pStateCache_->SetPSShaderResources(pContext, PS_SCENE_DEPTH_SLOT, 1, &pSceneDepthSRV);
+
+    pStateCache_->Draw(pContext, 3, 0);
+
+    ID3D11ShaderResourceView* nullSRV = nullptr;
+    pStateCache_->SetPSShaderResources(pContext, PS_SCENE_DEPTH_SLOT, 1, &nullSRV);
+}
+
+///////////////////////////////////////////////////////////
+
+void LowResBlending::Composite(
+    ID3D11DeviceContext* pContext,
+    ID3D11ShaderResourceView* pLowColorSRV,
+    ID3D11ShaderResourceView* pLowDepthSRV,
+    ID3D11ShaderResourceView* pSceneDepthSRV,
+    const UINT factor,
+    const UINT sceneWidth,
+    const UINT sceneHeight,
+    const XMMATRIX& proj)
+{
+    if (!isInit_ || !pLowColorSRV || !pLowDepthSRV || !pSceneDepthSRV)
+        return;
+
+    // view depth == proj[3][2] / (depth - proj[2][2])
+    cbLowRes_.data.projA = XMVectorGetZ(proj.r[2]);
+    cbLowRes_.data.projB = XMVectorGetZ(proj.r[3]);
+
+    UpdateConstBuffer(pContext, factor, sceneWidth, sceneHeight);
+    SetupFullscreen(pContext, compositePS_);
+
+    const FLOAT blendFactor[4] = { 0,0,0,0 };
+    pStateCache_->SetBlendState(pContext, pPremulState_, blendFactor, 0xFFFFFFFF);
+    pStateCache_->SetDepthStencilState(pContext, pNoDepthState_, 0);
+
+    ID3D11ShaderResourceView* srvs[3] = { pSceneDepthSRV, pLowColorSRV, pLowDepthSRV };
+    pStateCache_->SetPSShaderResources(pContext, PS_SCENE_DEPTH_SLOT, 3, srvs);
+
+    pStateCache_->Draw(pContext, 3, 0);
+
+    // the low resolution targets can be aliased by the next passes
+    ID3D11ShaderResourceView* nullSRVs[3] = { nullptr, nullptr, nullptr };
+    pStateCache_->SetPSShaderResources(pContext, PS_SCENE_DEPTH_SLOT, 3, nullSRVs);
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+void LowResBlending::SetupFullscreen(ID3D11DeviceContext* pContext, PixelShader& ps)
+{
+    // no vertex buffers: the fullscreen triangle is generated by SV_VertexID
+    pStateCache_->SetInputLayout(pContext, nullptr);
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetGS(pContext, nullptr);
+    pStateCache_->SetPS(pContext, ps.GetShader());
+    pStateCache_->SetPSConstantBuffers(pContext, CONST_BUFFER_SLOT, 1, cbLowRes_.GetAddressOf());
+}
+
+///////////////////////////////////////////////////////////
+
+void LowResBlending::UpdateConstBuffer(
+    ID3D11DeviceContext* pContext,
+    const UINT factor,
+    const UINT sceneWidth,
+    const UINT sceneHeight)
+{
+    const UINT lowWidth  = GetLowResSize(sceneWidth,  factor);
+    const UINT lowHeight = GetLowResSize(sceneHeight, factor);
+
+    cbLowRes_.data.factor   = factor;
+    cbLowRes_.data.fullMaxX = sceneWidth  - 1;
+    cbLowRes_.data.fullMaxY = sceneHeight - 1;
+    cbLowRes_.data.lowMaxX  = lowWidth  - 1;
+    cbLowRes_.data.lowMaxY  = lowHeight - 1;
+    cbLowRes_.ApplyChanges(pContext);
+}
+
+} // namespace Render
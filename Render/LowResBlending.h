@@ -0,0 +1,123 @@
+// =================================================================================
+// Filename:     LowResBlending.h
+// Description:  an optional offscreen pass of the blended geometry and particles
+//               with a half or quarter resolution (big smoke, fog cards and glass
+//               are fill-rate bound at the full one):
+//
+//               - the scene depth is downsampled into the low resolution depth
+//                 (by the farthest depth of each block of pixels) so the blended
+//                 content is still hidden by the opaque geometry;
+//               - the blended content is rendered into a low resolution color
+//                 which is cleared to (0,0,0,0): rgb is premultiplied by alpha,
+//                 the alpha is the coverage (see RenderStates::SetOffscreenBS);
+//               - the color is composited over the scene color by the depth aware
+//                 (bilateral) upsampling: the bilinear footprint is used where the
+//                 low resolution depths are close to the full resolution one, and
+//                 the nearest by depth texel is taken on edges of geometry
+//
+//               NOTE: the targets are owned by the caller (they are transient textures
+//                     of the render graph); a multisampled depth can't be downsampled
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/VertexShader.h"
+#include "Shaders/PixelShader.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "StateCache.h"
+
+#include <Types.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+class LowResBlending
+{
+public:
+    // the slot doesn't overlap const buffers which are bound once per frame
+    static constexpr UINT CONST_BUFFER_SLOT = 12;
+
+    // textures of the composite (don't overlap the sky cube map at t0);
+    // the downsampling reads the scene depth by the first slot
+    static constexpr UINT PS_SCENE_DEPTH_SLOT = 1;
+    static constexpr UINT PS_LOW_COLOR_SLOT   = 2;
+    static constexpr UINT PS_LOW_DEPTH_SLOT   = 3;
+
+    LowResBlending() {}
+    ~LowResBlending();
+
+    // restrict a copying of this class instance
+    LowResBlending(const LowResBlending&) = delete;
+    LowResBlending& operator=(const LowResBlending&) = delete;
+
+    bool Initialize(
+        ID3D11Device* pDevice,
+        const char* vsFilePath,
+        const char* depthPSFilePath,
+        const char* compositePSFilePath);
+
+    void Shutdown();
+
+    // write the downsampled scene depth into the bound low resolution depth and clear
+    // the low resolution color; input: sizes of the rendered parts (in pixels);
+    // NOTE: the caller binds both targets and the viewport of the low resolution
+    void Downsample(
+        ID3D11DeviceContext* pContext,
+        ID3D11RenderTargetView* pLowColorRTV,
+        ID3D11ShaderResourceView* pSceneDepthSRV,
+        const UINT factor,
+        const UINT sceneWidth,
+        const UINT sceneHeight);
+
+    // blend the low resolution color over the bound scene color; proj is of the camera (NOT transposed)
+    // NOTE: the caller binds the scene color and its viewport
+    void Composite(
+        ID3D11DeviceContext* pContext,
+        ID3D11ShaderResourceView* pLowColorSRV,
+        ID3D11ShaderResourceView* pLowDepthSRV,
+        ID3D11ShaderResourceView* pSceneDepthSRV,
+        const UINT factor,
+        const UINT sceneWidth,
+        const UINT sceneHeight,
+        const DirectX::XMMATRIX& proj);
+
+    // size of the low resolution (a rendered part or a target) by the full one
+    static inline UINT GetLowResSize(const UINT fullSize, const UINT factor)
+    {
+        return (fullSize + factor - 1) / factor;
+    }
+
+    inline bool IsInitialized() const { return isInit_; }
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+private:
+    void SetupFullscreen(ID3D11DeviceContext* pContext, PixelShader& ps);
+    void UpdateConstBuffer(
+        ID3D11DeviceContext* pContext,
+        const UINT factor,
+        const UINT sceneWidth,
+        const UINT sceneHeight);
+
+private:
+    VertexShader                vs_;                       // a fullscreen triangle (without input layout)
+    PixelShader                 depthPS_;                  // writes SV_Depth
+    PixelShader                 compositePS_;
+
+    ID3D11DepthStencilState*    pDepthWriteState_ = nullptr;  // always passes and writes (for the downsampling)
+    ID3D11DepthStencilState*    pNoDepthState_    = nullptr;  // for the composite
+    ID3D11BlendState*           pNoColorState_    = nullptr;  // the downsampling writes only depth
+    ID3D11BlendState*           pPremulState_     = nullptr;  // premultiplied alpha "over" (for the composite)
+
+    ConstantBuffer<ConstBufType::cbLowResBlend> cbLowRes_;
+
+    StateCache*                 pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
+    bool                        isInit_      = false;
+};
+
+} // namespace Render
@@ -0,0 +1,385 @@
+// =================================================================================
+// Filename:     PlanarReflection.cpp
+// Description:  implementation of the PlanarReflection's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "PlanarReflection.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <algorithm>
+#include <math.h>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+static_assert(sizeof(ConstBufType::cbPlanarReflection) % 16 == 0, "size of the const buffer must be a multiple of 16");
+
+// the clip plane is moved a bit behind the mirror so the geometry which
+// touches it (e.g. the shore of water) isn't cut with a visible gap
+static constexpr float CLIP_PLANE_OFFSET = 0.05f;
+
+///////////////////////////////////////////////////////////
+
+PlanarReflection::~PlanarReflection()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool PlanarReflection::Initialize(
+    ID3D11Device* pDevice,
+    const char* vsFilePath,
+    const char* psFilePath,
+    const PlanarReflectionParams& params)
+{
+    try
+    {
+        // the fullscreen triangle is generated by SV_VertexID
+        bool result = vs_.Initialize(pDevice, vsFilePath, nullptr, 0);
+        CAssert::True(result, "can't initialize the fullscreen vertex shader");
+
+        result = ps_.Initialize(pDevice, psFilePath);
+        CAssert::True(result, "can't initialize the composite pixel shader");
+
+        D3D11_SAMPLER_DESC samplerDesc;
+        ZeroMemory(&samplerDesc, sizeof(samplerDesc));
+        samplerDesc.Filter         = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+        samplerDesc.AddressU       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressV       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressW       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+        samplerDesc.MaxLOD         = D3D11_FLOAT32_MAX;
+
+        result = samplerState_.Initialize(pDevice, &samplerDesc);
+        CAssert::True(result, "can't initialize the sampler state");
+
+        HRESULT hr = cbCamera_.Initialize(pDevice);
+        CAssert::NotFailed(hr, "can't initialize the const buffer of the reflected camera");
+
+        hr = cbComposite_.Initialize(pDevice);
+        CAssert::NotFailed(hr, "can't initialize the const buffer of the composite");
+
+        // the reflection is blended over the mirror by the strength (in the alpha)
+        D3D11_BLEND_DESC blendDesc;
+        ZeroMemory(&blendDesc, sizeof(blendDesc));
+
+        D3D11_RENDER_TARGET_BLEND_DESC& rt = blendDesc.RenderTarget[0];
+        rt.BlendEnable           = TRUE;
+        rt.SrcBlend              = D3D11_BLEND_SRC_ALPHA;
+        rt.DestBlend             = D3D11_BLEND_INV_SRC_ALPHA;
+        rt.BlendOp               = D3D11_BLEND_OP_ADD;
+        rt.SrcBlendAlpha         = D3D11_BLEND_ZERO;
+        rt.DestBlendAlpha        = D3D11_BLEND_ONE;
+        rt.BlendOpAlpha          = D3D11_BLEND_OP_ADD;
+        rt.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+        hr = pDevice->CreateBlendState(&blendDesc, &pBlendState_);
+        CAssert::NotFailed(hr, "can't create a blend state for the composite");
+
+        SetParams(params);
+
+        isInit_ = true;
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the planar reflection");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void PlanarReflection::Shutdown()
+{
+    ReleaseTargets();
+    SafeRelease(&pBlendState_);
+    SafeRelease(&pPrevRTV_);
+    SafeRelease(&pPrevDSV_);
+
+    vs_.Shutdown();
+    ps_.Shutdown();
+
+    hasImage_ = false;
+    isInit_   = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void PlanarReflection::SetParams(const PlanarReflectionParams& params)
+{
+    params_                = params;
+    params_.resScale       = std::clamp(params.resScale, 0.1f, 1.0f);
+    params_.updateInterval = std::max(params.updateInterval, 1);
+    params_.lodBias        = std::max(params.lodBias, 0);
+    params_.strength       = std::clamp(params.strength, 0.0f, 1.0f);
+}
+
+//---------------------------------------------------------
+// Desc:   reflect the camera by the mirror plane, make the oblique projection
+//         (its near plane is the mirror plane) and world planes to cull casters
+// Args:   - view, proj:      of the main camera (NOT transposed)
+//         - mirrorPlane:     its normal looks to the reflected side
+//         - frustumPlanesW:  6 planes of the main camera (normals look outside)
+//---------------------------------------------------------
+bool PlanarReflection::Setup(
+    const XMMATRIX& view,
+    const XMMATRIX& proj,
+    const XMFLOAT3& cameraPos,
+    const XMFLOAT4& mirrorPlane,
+    const XMFLOAT4* frustumPlanesW)
+{
+    const XMVECTOR plane  = XMPlaneNormalize(XMLoadFloat4(&mirrorPlane));
+    const XMVECTOR camPos = XMLoadFloat3(&cameraPos);
+
+    if (XMVectorGetX(XMPlaneDotCoord(plane, camPos)) <= CLIP_PLANE_OFFSET)
+        return false;
+
+    // world => reflected world (it is its own inverse)
+    const XMMATRIX reflect  = XMMatrixReflect(plane);
+    const XMMATRIX reflView = reflect * view;
+
+    XMStoreFloat3(&cameraPos_, XMVector3TransformCoord(camPos, reflect));
+
+    // in the reflected world the images of entts in front of the mirror are behind it,
+    // so the kept half-space is behind the mirror; planes are transformed by the
+    // inverse transpose of points transformation (the inverse view is the camera world)
+    const XMVECTOR clipW = XMVectorAdd(
+        XMVectorNegate(plane),
+        XMVectorSet(0, 0, 0, CLIP_PLANE_OFFSET));
+
+    const XMMATRIX invView = XMMatrixInverse(nullptr, view);
+    const XMVECTOR clipV   = XMPlaneTransform(clipW, XMMatrixTranspose(invView));
+
+    XMFLOAT4 c;
+    XMStoreFloat4(&c, clipV);
+
+    // the oblique near plane (E. Lengyel): the 3rd column of the projection is replaced
+    // by the clip plane which is scaled so the far plane goes through the frustum corner
+    // opposite to the clip plane: q == inverse(proj) * (sgn(c.x), sgn(c.y), 1, 1)
+    XMFLOAT4X4 p;
+    XMStoreFloat4x4(&p, proj);
+
+    const float sx = (c.x > 0.0f) ? 1.0f : ((c.x < 0.0f) ? -1.0f : 0.0f);
+    const float sy = (c.y > 0.0f) ? 1.0f : ((c.y < 0.0f) ? -1.0f : 0.0f);
+
+    const float qx = sx / p._11;
+    const float qy = sy / p._22;
+    const float qz = 1.0f;
+    const float qw = (1.0f - p._33) / p._43;
+
+    const float dotCQ = (c.x * qx) + (c.y * qy) + (c.z * qz) + (c.w * qw);
+
+    if (fabsf(dotCQ) < 1e-6f)
+        return false;
+
+    const float a = 1.0f / dotCQ;
+
+    p._13 = c.x * a;
+    p._23 = c.y * a;
+    p._33 = c.z * a;
+    p._43 = c.w * a;
+
+    viewProj_ = reflView * XMLoadFloat4x4(&p);
+
+    // casters are culled by the reflected frustum and entts wholly behind the mirror are skipped
+    const XMMATRIX planesTransform = XMMatrixTranspose(reflect);
+
+    for (int i = 0; i < 6; ++i)
+    {
+        const XMVECTOR reflPlane = XMPlaneTransform(XMLoadFloat4(&frustumPlanesW[i]), planesTransform);
+        XMStoreFloat4(&cullPlanes_[i], reflPlane);
+    }
+
+    XMStoreFloat4(&cullPlanes_[6], XMVectorNegate(plane));
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool PlanarReflection::NeedsUpdate()
+{
+    if (!hasImage_ || (++framesSinceUpdate_ >= params_.updateInterval))
+    {
+        framesSinceUpdate_ = 0;
+        return true;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+bool PlanarReflection::Begin(
+    ID3D11Device* pDevice,
+    ID3D11DeviceContext* pContext,
+    const UINT screenWidth,
+    const UINT screenHeight,
+    const float gameTime)
+{
+    const UINT width  = std::max(1u, (UINT)(screenWidth  * params_.resScale));
+    const UINT height = std::max(1u, (UINT)(screenHeight * params_.resScale));
+
+    if ((width != width_) || (height != height_))
+    {
+        if (!CreateTargets(pDevice, width, height))
+            return false;
+    }
+
+    // remember the current targets and viewport
+    numPrevViewports_ = 1;
+    pContext->OMGetRenderTargets(1, &pPrevRTV_, &pPrevDSV_);
+    pContext->RSGetViewports(&numPrevViewports_, &prevViewport_);
+
+    // the reflection is written now
+    pStateCache_->UnbindShaderResource(pContext, pColorSRV_);
+
+    const FLOAT clearColor[4] = { 0,0,0,1 };
+    pContext->ClearRenderTargetView(pColorRTV_, clearColor);
+    pContext->ClearDepthStencilView(pDepthDSV_, D3D11_CLEAR_DEPTH, 1.0f, 0);
+    pContext->OMSetRenderTargets(1, &pColorRTV_, pDepthDSV_);
+
+    const D3D11_VIEWPORT viewport = { 0.0f, 0.0f, (float)width_, (float)height_, 0.0f, 1.0f };
+    pContext->RSSetViewports(1, &viewport);
+
+    cbCamera_.data.viewProj = XMMatrixTranspose(viewProj_);
+    cbCamera_.data.gameTime = gameTime;
+    cbCamera_.ApplyChanges(pContext);
+    pStateCache_->SetVSConstantBuffers(pContext, VS_CB_SLOT, 1, cbCamera_.GetAddressOf());
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void PlanarReflection::End(ID3D11DeviceContext* pContext, ID3D11Buffer* pCameraVSCB)
+{
+    // restore the pipeline
+    pContext->OMSetRenderTargets(1, &pPrevRTV_, pPrevDSV_);
+    pContext->RSSetViewports(numPrevViewports_, &prevViewport_);
+    pStateCache_->SetVSConstantBuffers(pContext, VS_CB_SLOT, 1, &pCameraVSCB);
+
+    // OMGetRenderTargets() increments ref counters
+    SafeRelease(&pPrevRTV_);
+    SafeRelease(&pPrevDSV_);
+
+    hasImage_ = (pColorSRV_ != nullptr);
+}
+
+///////////////////////////////////////////////////////////
+
+void PlanarReflection::Composite(
+    ID3D11DeviceContext* pContext,
+    const UINT sceneWidth,
+    const UINT sceneHeight)
+{
+    if (!isInit_ || !hasImage_ || (sceneWidth == 0) || (sceneHeight == 0))
+        return;
+
+    // the reflection is rendered by the same projection (into the whole target)
+    // so a pixel of the mirror takes the reflection by its screen coords
+    cbComposite_.data.invSceneWidth  = 1.0f / (float)sceneWidth;
+    cbComposite_.data.invSceneHeight = 1.0f / (float)sceneHeight;
+    cbComposite_.data.strength       = params_.strength;
+    cbComposite_.ApplyChanges(pContext);
+
+    // no vertex buffers: the fullscreen triangle is generated by SV_VertexID
+    pStateCache_->SetInputLayout(pContext, nullptr);
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetGS(pContext, nullptr);
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetPSConstantBuffers(pContext, CONST_BUFFER_SLOT, 1, cbComposite_.GetAddressOf());
+    pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
+    pStateCache_->SetPSShaderResources(pContext, PS_TEXTURE_SLOT, 1, &pColorSRV_);
+
+    const FLOAT blendFactor[4] = { 0,0,0,0 };
+    pStateCache_->SetBlendState(pContext, pBlendState_, blendFactor, 0xFFFFFFFF);
+
+    pStateCache_->Draw(pContext, 3, 0);
+
+    // the slot is used by textures of materials
+    ID3D11ShaderResourceView* nullSRV = nullptr;
+    pStateCache_->SetPSShaderResources(pContext, PS_TEXTURE_SLOT, 1, &nullSRV);
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+bool PlanarReflection::CreateTargets(ID3D11Device* pDevice, const UINT width, const UINT height)
+{
+    // create the color target of the reflection and its depth buffer
+
+    ReleaseTargets();
+
+    try
+    {
+        D3D11_TEXTURE2D_DESC desc;
+        desc.Width              = width;
+        desc.Height             = height;
+        desc.MipLevels          = 1;
+        desc.ArraySize          = 1;
+        desc.Format             = DXGI_FORMAT_R8G8B8A8_UNORM;
+        desc.SampleDesc.Count   = 1;
+        desc.SampleDesc.Quality = 0;
+        desc.Usage              = D3D11_USAGE_DEFAULT;
+        desc.BindFlags          = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+        desc.CPUAccessFlags     = 0;
+        desc.MiscFlags          = 0;
+
+        HRESULT hr = pDevice->CreateTexture2D(&desc, nullptr, &pColorTex_);
+        CAssert::NotFailed(hr, "can't create a texture of the reflection");
+
+        hr = pDevice->CreateRenderTargetView(pColorTex_, nullptr, &pColorRTV_);
+        CAssert::NotFailed(hr, "can't create a RTV of the reflection");
+
+        hr = pDevice->CreateShaderResourceView(pColorTex_, nullptr, &pColorSRV_);
+        CAssert::NotFailed(hr, "can't create a SRV of the reflection");
+
+        // depth
+        desc.Format    = DXGI_FORMAT_D32_FLOAT;
+        desc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+
+        hr = pDevice->CreateTexture2D(&desc, nullptr, &pDepthTex_);
+        CAssert::NotFailed(hr, "can't create a depth texture of the reflection");
+
+        hr = pDevice->CreateDepthStencilView(pDepthTex_, nullptr, &pDepthDSV_);
+        CAssert::NotFailed(hr, "can't create a DSV of the reflection");
+
+        width_  = width;
+        height_ = height;
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't create targets of the planar reflection");
+        ReleaseTargets();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void PlanarReflection::ReleaseTargets()
+{
+    SafeRelease(&pColorSRV_);
+    SafeRelease(&pColorRTV_);
+    SafeRelease(&pColorTex_);
+    SafeRelease(&pDepthDSV_);
+    SafeRelease(&pDepthTex_);
+
+    width_    = 0;
+    height_   = 0;
+    hasImage_ = false;
+}
+
+} // namespace Render
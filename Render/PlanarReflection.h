@@ -0,0 +1,157 @@
+// =================================================================================
+// Filename:     PlanarReflection.h
+// Description:  a reflection of the scene by a single mirror plane (water, polished
+//               floors, mirrors) which is rendered for a fraction of the cost of
+//               the main view:
+//
+//               - the camera is reflected by the plane and its projection gets the
+//                 oblique near plane (by the mirror plane) so nothing behind the
+//                 mirror is drawn and no user clip planes are needed;
+//               - the reflection is rendered into its own target with a reduced
+//                 resolution, only by flagged casters (see ECS::RenderSystem) which
+//                 are culled by the reflected frustum and drawn with a LOD bias;
+//                 point/spot lights aren't applied (clusters are of the main camera);
+//               - the target is re-rendered once in N frames, between updates the
+//                 last image is reused;
+//               - pixels of the mirror are marked in the scene stencil (MARK_MIRROR),
+//                 then the reflection is blended over them by a fullscreen triangle
+//                 with the stencil test (DRAW_REFLECTION)
+//
+//               NOTE: the mirror is one-sided, its plane normal looks to the reflected side
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/VertexShader.h"
+#include "Shaders/PixelShader.h"
+#include "Shaders/SamplerState.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "StateCache.h"
+
+#include <Types.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+struct PlanarReflectionParams
+{
+    float resScale       = 0.5f;            // size of the target relatively to the screen
+    int   updateInterval = 1;               // the reflection is re-rendered once in N frames
+    int   lodBias        = 1;               // casters are drawn by LODs which are coarser by N
+    float strength       = 0.5f;            // how much of the reflection is blended over the mirror
+};
+
+///////////////////////////////////////////////////////////
+
+class PlanarReflection
+{
+public:
+    static constexpr int  NUM_CULL_PLANES   = 7;    // the reflected frustum + the mirror plane
+    static constexpr UINT VS_CB_SLOT        = 0;    // replaces cbVSPerFrame of the camera while casters are rendered
+    static constexpr UINT CONST_BUFFER_SLOT = 12;   // of the composite (the same transient slot as of LowResBlending)
+    static constexpr UINT PS_TEXTURE_SLOT   = 1;    // of the composite (doesn't overlap the sky cube map at t0)
+
+    PlanarReflection() {}
+    ~PlanarReflection();
+
+    // restrict a copying of this class instance
+    PlanarReflection(const PlanarReflection&) = delete;
+    PlanarReflection& operator=(const PlanarReflection&) = delete;
+
+    bool Initialize(
+        ID3D11Device* pDevice,
+        const char* vsFilePath,
+        const char* psFilePath,
+        const PlanarReflectionParams& params);
+
+    void Shutdown();
+
+    // compute the reflected camera by the camera of this frame (view/proj are NOT
+    // transposed, frustum planes are in world space and look outside);
+    // ret: false if the camera is behind the mirror (there is nothing to reflect)
+    bool Setup(
+        const DirectX::XMMATRIX& view,
+        const DirectX::XMMATRIX& proj,
+        const DirectX::XMFLOAT3& cameraPos,
+        const DirectX::XMFLOAT4& mirrorPlane,
+        const DirectX::XMFLOAT4* frustumPlanesW);
+
+    // is the reflection re-rendered in this frame? (is called once per frame)
+    bool NeedsUpdate();
+
+    // the image is outdated (e.g. the mirror is changed): it isn't composited until the next update
+    inline void Invalidate() { hasImage_ = false; framesSinceUpdate_ = 0; }
+
+    // rendering of casters: Begin() => render casters => End();
+    // the target is (re)created by the size of the screen (in pixels); ret: false if it can't be
+    // NOTE: casters are rendered by the VS with the view-proj in b0 (as of the main pass)
+    bool Begin(
+        ID3D11Device* pDevice,
+        ID3D11DeviceContext* pContext,
+        const UINT screenWidth,
+        const UINT screenHeight,
+        const float gameTime);
+
+    // restore targets and the VS const buffer of the camera
+    void End(ID3D11DeviceContext* pContext, ID3D11Buffer* pCameraVSCB);
+
+    // blend the reflection over the bound scene color (the stencil test is set by the caller);
+    // input: the rendered part of the scene (in pixels)
+    void Composite(ID3D11DeviceContext* pContext, const UINT sceneWidth, const UINT sceneHeight);
+
+    inline bool IsInitialized() const { return isInit_; }
+    inline bool HasImage()      const { return hasImage_; }
+
+    inline const DirectX::XMMATRIX& GetViewProj()   const { return viewProj_; }
+    inline const DirectX::XMFLOAT3& GetCameraPos()  const { return cameraPos_; }
+    inline const DirectX::XMFLOAT4* GetCullPlanes() const { return cullPlanes_; }
+
+    inline const PlanarReflectionParams& GetParams() const { return params_; }
+    void SetParams(const PlanarReflectionParams& params);
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+private:
+    bool CreateTargets(ID3D11Device* pDevice, const UINT width, const UINT height);
+    void ReleaseTargets();
+
+private:
+    ID3D11Texture2D*           pColorTex_  = nullptr;
+    ID3D11RenderTargetView*    pColorRTV_  = nullptr;
+    ID3D11ShaderResourceView*  pColorSRV_  = nullptr;
+    ID3D11Texture2D*           pDepthTex_  = nullptr;
+    ID3D11DepthStencilView*    pDepthDSV_  = nullptr;
+    UINT                       width_      = 0;
+    UINT                       height_     = 0;
+
+    VertexShader               vs_;                           // a fullscreen triangle (without input layout)
+    PixelShader                ps_;
+    SamplerState               samplerState_;                 // bilinear, clamped
+    ID3D11BlendState*          pBlendState_ = nullptr;        // the reflection is blended by the strength
+
+    ConstantBuffer<ConstBufType::cbvsPerFrame>       cbCamera_;     // the reflected view-proj for the VS of casters
+    ConstantBuffer<ConstBufType::cbPlanarReflection> cbComposite_;
+
+    PlanarReflectionParams     params_;
+    DirectX::XMMATRIX          viewProj_   = DirectX::XMMatrixIdentity();  // reflected view * oblique proj (NOT transposed)
+    DirectX::XMFLOAT3          cameraPos_  = { 0,0,0 };       // the reflected camera position
+    DirectX::XMFLOAT4          cullPlanes_[NUM_CULL_PLANES];  // world planes of casters (normals look outside)
+    int                        framesSinceUpdate_ = 0;
+
+    // targets of the scene which are restored by End()
+    ID3D11RenderTargetView*    pPrevRTV_ = nullptr;
+    ID3D11DepthStencilView*    pPrevDSV_ = nullptr;
+    D3D11_VIEWPORT             prevViewport_;
+    UINT                       numPrevViewports_ = 1;
+
+    StateCache*                pStateCache_ = nullptr;        // filters redundant binds (is owned by CRender)
+    bool                       hasImage_    = false;          // was the reflection rendered at least once?
+    bool                       isInit_      = false;
+};
+
+} // namespace Render
@@ -0,0 +1,355 @@
+// =================================================================================
+// Filename:     ShaderHotReloader.cpp
+// Description:  implementation of the ShaderHotReloader's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "ShaderHotReloader.h"
+#include "Shaders/Helpers/ShaderCompiler.h"
+#include "Shaders/Helpers/ShaderCache.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <chrono>
+
+
+namespace Render
+{
+
+// compile only after this time since the last change (editors save files by several writes)
+static constexpr uint64 CHANGES_SETTLE_TIME_MS = 200;
+
+//---------------------------------------------------------
+// Desc:  get the current time in milliseconds (steady clock)
+//---------------------------------------------------------
+static uint64 GetTimeMs()
+{
+    using namespace std::chrono;
+    return (uint64)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//---------------------------------------------------------
+// Desc:  append compilation errors of the shader into the input string
+//---------------------------------------------------------
+static void AddErrors(std::string& outErrors, const char* shaderPath, ID3D10Blob* pErrorMsgs)
+{
+    outErrors += "can't hot reload the shader (the old one is kept): ";
+    outErrors += shaderPath;
+    outErrors += "\n";
+
+    if (pErrorMsgs)
+        outErrors += (const char*)pErrorMsgs->GetBufferPointer();
+}
+
+///////////////////////////////////////////////////////////
+
+ShaderHotReloader::~ShaderHotReloader()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool ShaderHotReloader::Initialize(ID3D11Device* pDevice, const char* srcDirPath)
+{
+    CAssert::True(pDevice != nullptr, "input ptr to the device == nullptr");
+
+    pDevice_ = pDevice;
+
+    // (is opened for overlapped reads so the watcher can be stopped at any moment)
+    hDir_ = CreateFileA(
+        srcDirPath,
+        FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+        nullptr);
+
+    if (hDir_ == INVALID_HANDLE_VALUE)
+    {
+        sprintf(g_String, "can't watch the directory of shader sources (only manual hot reload works): %s", srcDirPath);
+        LogErr(g_String);
+        return false;
+    }
+
+    hStopEvent_ = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    watcher_    = std::thread(&ShaderHotReloader::WatchLoop, this);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ShaderHotReloader::Shutdown()
+{
+    if (watcher_.joinable())
+    {
+        SetEvent(hStopEvent_);
+        watcher_.join();
+    }
+
+    if (hStopEvent_)
+    {
+        CloseHandle(hStopEvent_);
+        hStopEvent_ = nullptr;
+    }
+
+    if (hDir_ != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(hDir_);
+        hDir_ = INVALID_HANDLE_VALUE;
+    }
+
+    // the job uses entries so wait for it
+    if (isJobRunning_)
+    {
+        g_JobSystem.Wait(jobCounter_);
+        isJobRunning_ = false;
+    }
+
+    for (Entry& entry : entries_)
+    {
+        SafeRelease(&entry.pNewVS);
+        SafeRelease(&entry.pNewLayout);
+        SafeRelease(&entry.pNewPS);
+    }
+
+    entries_.clear();
+}
+
+///////////////////////////////////////////////////////////
+
+void ShaderHotReloader::AddShaders(
+    const char* vsPath,
+    const char* psPath,
+    VertexShader* pVS,
+    PixelShader* pPS,
+    const D3D11_INPUT_ELEMENT_DESC* layoutDesc,
+    const UINT layoutElemNum,
+    PixelShaderPermutations* pPermutations)
+{
+    CAssert::True(pVS && pPS, "input ptr to some shader == nullptr");
+    CAssert::True(!isJobRunning_, "can't add shaders while the compilation job is running");
+
+    Entry entry;
+    strncpy(entry.vsPath, vsPath, sizeof(entry.vsPath) - 1);
+    strncpy(entry.psPath, psPath, sizeof(entry.psPath) - 1);
+
+    entry.pVS           = pVS;
+    entry.pPS           = pPS;
+    entry.pPermutations = pPermutations;
+    entry.layout.resize(layoutElemNum);
+
+    for (UINT i = 0; i < layoutElemNum; ++i)
+        entry.layout[i] = layoutDesc[i];
+
+    // hashes of the current sources (so only their changes cause compilation)
+    entry.vsHash = ShaderCache::ComputeHash(vsPath, nullptr, "VS", "vs_5_0");
+    entry.psHash = ShaderCache::ComputeHash(psPath, nullptr, "PS", "ps_5_0");
+
+    entries_.push_back(std::move(entry));
+}
+
+///////////////////////////////////////////////////////////
+
+void ShaderHotReloader::RequestReload()
+{
+    isForced_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ShaderHotReloader::Update()
+{
+    bool isSwapped = false;
+
+    if (isJobRunning_)
+    {
+        if (!jobCounter_.IsDone())
+            return false;
+
+        isJobRunning_ = false;
+
+        if (!jobErrors_.empty())
+        {
+            LogErr(jobErrors_.c_str());
+            jobErrors_.clear();
+        }
+
+        isSwapped = SwapCompiled();
+    }
+
+    // start a new job if sources are changed (and the editor has finished writing)
+    const bool isSettled = isChanged_ && (GetTimeMs() - lastChangeTimeMs_ >= CHANGES_SETTLE_TIME_MS);
+
+    if (pDevice_ && (isForced_ || isSettled))
+    {
+        const bool force = isForced_;
+
+        isForced_     = false;
+        isChanged_    = false;
+        isJobRunning_ = true;
+
+        g_JobSystem.Run([this, force]() { CompileChanged(force); }, &jobCounter_);
+    }
+
+    return isSwapped;
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+void ShaderHotReloader::WatchLoop()
+{
+    // wait for any change in the directory; which shaders are really
+    // changed is defined by hashes when the job is executed
+
+    alignas(DWORD) uint8 buffer[4096];
+    OVERLAPPED           overlapped{};
+    overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+    const HANDLE events[2] = { overlapped.hEvent, hStopEvent_ };
+    const DWORD  filter    = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME;
+
+    while (true)
+    {
+        ResetEvent(overlapped.hEvent);
+
+        if (!ReadDirectoryChangesW(hDir_, buffer, sizeof(buffer), TRUE, filter, nullptr, &overlapped, nullptr))
+            break;
+
+        const DWORD waitResult = WaitForMultipleObjects(2, events, FALSE, INFINITE);
+        DWORD       numBytes   = 0;
+
+        if (waitResult != WAIT_OBJECT_0)
+        {
+            // we're stopped: cancel the pending read and wait until it's really cancelled
+            CancelIo(hDir_);
+            GetOverlappedResult(hDir_, &overlapped, &numBytes, TRUE);
+            break;
+        }
+
+        GetOverlappedResult(hDir_, &overlapped, &numBytes, FALSE);
+
+        lastChangeTimeMs_ = GetTimeMs();
+        isChanged_        = true;
+    }
+
+    CloseHandle(overlapped.hEvent);
+}
+
+///////////////////////////////////////////////////////////
+
+void ShaderHotReloader::CompileChanged(const bool force)
+{
+    // is executed by a job: compile shaders which hashes are changed;
+    // NOTE: the logger isn't thread-safe so errors are only collected here
+
+    for (Entry& entry : entries_)
+    {
+        const uint64 vsHash = ShaderCache::ComputeHash(entry.vsPath, nullptr, "VS", "vs_5_0");
+        const uint64 psHash = ShaderCache::ComputeHash(entry.psPath, nullptr, "PS", "ps_5_0");
+
+        if (force || (vsHash != entry.vsHash))
+        {
+            ID3D10Blob* pBytecode  = nullptr;
+            ID3D10Blob* pErrorMsgs = nullptr;
+
+            HRESULT hr = ShaderCompiler::CompileShaderFromFile(entry.vsPath, "VS", "vs_5_0", &pBytecode, nullptr, &pErrorMsgs);
+
+            if (SUCCEEDED(hr))
+                hr = pDevice_->CreateVertexShader(pBytecode->GetBufferPointer(), pBytecode->GetBufferSize(), nullptr, &entry.pNewVS);
+
+            if (SUCCEEDED(hr))
+            {
+                hr = pDevice_->CreateInputLayout(
+                    entry.layout.data(),
+                    (UINT)entry.layout.size(),
+                    pBytecode->GetBufferPointer(),
+                    pBytecode->GetBufferSize(),
+                    &entry.pNewLayout);
+            }
+
+            if (SUCCEEDED(hr))
+            {
+                entry.newVSHash = vsHash;
+            }
+            else
+            {
+                SafeRelease(&entry.pNewVS);
+                SafeRelease(&entry.pNewLayout);
+                AddErrors(jobErrors_, entry.vsPath, pErrorMsgs);
+            }
+
+            SafeRelease(&pBytecode);
+            SafeRelease(&pErrorMsgs);
+        }
+
+        if (force || (psHash != entry.psHash))
+        {
+            ID3D10Blob* pBytecode  = nullptr;
+            ID3D10Blob* pErrorMsgs = nullptr;
+
+            HRESULT hr = ShaderCompiler::CompileShaderFromFile(entry.psPath, "PS", "ps_5_0", &pBytecode, nullptr, &pErrorMsgs);
+
+            if (SUCCEEDED(hr))
+                hr = pDevice_->CreatePixelShader(pBytecode->GetBufferPointer(), pBytecode->GetBufferSize(), nullptr, &entry.pNewPS);
+
+            if (SUCCEEDED(hr))
+            {
+                entry.newPSHash = psHash;
+            }
+            else
+            {
+                SafeRelease(&entry.pNewPS);
+                AddErrors(jobErrors_, entry.psPath, pErrorMsgs);
+            }
+
+            SafeRelease(&pBytecode);
+            SafeRelease(&pErrorMsgs);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool ShaderHotReloader::SwapCompiled()
+{
+    // is called by the render thread at frame start when the job is done
+    // so no draw uses the old shaders at this moment
+
+    bool isSwapped = false;
+
+    for (Entry& entry : entries_)
+    {
+        if (entry.pNewVS)
+        {
+            entry.pVS->Swap(entry.pNewVS, entry.pNewLayout);
+            entry.pNewVS     = nullptr;
+            entry.pNewLayout = nullptr;
+            entry.vsHash     = entry.newVSHash;
+            isSwapped        = true;
+        }
+
+        if (entry.pNewPS)
+        {
+            entry.pPS->Swap(entry.pNewPS);
+            entry.pNewPS = nullptr;
+            entry.psHash = entry.newPSHash;
+            isSwapped    = true;
+
+            // variants from the same source: only ones with changed hashes are compiled
+            if (entry.pPermutations && entry.pPermutations->IsInitialized())
+                entry.pPermutations->Recompile(pDevice_);
+        }
+    }
+
+    if (isSwapped)
+        LogDbg("shaders are hot reloaded");
+
+    return isSwapped;
+}
+
+} // namespace Render
@@ -0,0 +1,111 @@
+// =================================================================================
+// Filename:     ShaderHotReloader.h
+// Description:  incremental background hot reload of shaders:
+//
+//               - a watcher thread waits for changes in the directory
+//                 of shader sources (ReadDirectoryChangesW);
+//               - when sources are changed a job compiles only shaders which
+//                 hashes of the source + includes are changed (see ShaderCache);
+//               - compiled shaders are swapped in by the render thread at
+//                 frame start (Update), so the frame never waits for compilation;
+//               - if a shader can't be compiled the old one is kept and errors
+//                 are just logged (without message boxes)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/VertexShader.h"
+#include "Shaders/PixelShader.h"
+#include "Shaders/PixelShaderPermutations.h"
+
+#include <Types.h>
+#include <cvector.h>
+#include <JobSystem.h>
+#include <d3d11.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+
+namespace Render
+{
+
+class ShaderHotReloader
+{
+public:
+    ShaderHotReloader() {}
+    ~ShaderHotReloader();
+
+    // restrict a copying of this class instance
+    ShaderHotReloader(const ShaderHotReloader&) = delete;
+    ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+
+    // start watching the directory of shader sources;
+    // return false if it can't be watched (e.g. no sources in shipped builds)
+    bool Initialize(ID3D11Device* pDevice, const char* srcDirPath);
+    void Shutdown();
+
+    // add a pair of shaders to reload (layout desc is copied);
+    // pPermutations: (optional) variants of the pixel shader from the same source
+    void AddShaders(
+        const char* vsPath,
+        const char* psPath,
+        VertexShader* pVS,
+        PixelShader* pPS,
+        const D3D11_INPUT_ELEMENT_DESC* layoutDesc,
+        const UINT layoutElemNum,
+        PixelShaderPermutations* pPermutations = nullptr);
+
+    // recompile all the shaders regardless of their hashes (at the next Update)
+    void RequestReload();
+
+    // is called at frame start by the render thread: swap in compiled shaders
+    // and start a new compilation job if sources are changed;
+    // return true if any shader was swapped (so cached binds must be invalidated)
+    bool Update();
+
+private:
+    struct Entry
+    {
+        char                              vsPath[64]{ '\0' };
+        char                              psPath[64]{ '\0' };
+        VertexShader*                     pVS = nullptr;
+        PixelShader*                      pPS = nullptr;
+        PixelShaderPermutations*          pPermutations = nullptr;
+        cvector<D3D11_INPUT_ELEMENT_DESC> layout;
+
+        uint64                            vsHash = 0;          // hashes of the current shaders
+        uint64                            psHash = 0;
+
+        // results of the compilation job (are owned until they're swapped in)
+        ID3D11VertexShader*               pNewVS     = nullptr;
+        ID3D11InputLayout*                pNewLayout = nullptr;
+        ID3D11PixelShader*                pNewPS     = nullptr;
+        uint64                            newVSHash  = 0;
+        uint64                            newPSHash  = 0;
+    };
+
+    void WatchLoop();
+    void CompileChanged(const bool force);        // is executed by a job
+    bool SwapCompiled();
+
+private:
+    cvector<Entry>      entries_;
+    ID3D11Device*       pDevice_ = nullptr;
+
+    std::thread         watcher_;
+    HANDLE              hDir_       = INVALID_HANDLE_VALUE;
+    HANDLE              hStopEvent_ = nullptr;   // wakes the watcher up to stop it
+
+    std::atomic<bool>   isChanged_ = false;      // are sources changed since the last job?
+    std::atomic<uint64> lastChangeTimeMs_ = 0;   // to wait until an editor finishes saving
+    bool                isForced_ = false;
+
+    JobCounter          jobCounter_;
+    bool                isJobRunning_ = false;
+    std::string         jobErrors_;              // are logged by the render thread
+};
+
+} // namespace Render
@@ -7,6 +7,9 @@
 namespace Render
 {
 
+// the billboards structured buffer is read by billboardPullVS.hlsl
+static_assert(sizeof(ConstBufType::InstancedDataBillboards) == 96, "the layout must match Billboard in billboardPullVS.hlsl");
+
 BillboardShader::BillboardShader()
 {
     strcpy(className_, __func__);
@@ -24,13 +27,14 @@ bool BillboardShader::Initialize(
     ID3D11Device* pDevice,
     const char* vsFilePath,
     const char* psFilePath,
-    const char* gsFilePath)
+    const char* gsFilePath,
+    const char* pullVsFilePath)
 {
     // initialize the shader class: hlsl for rendering textured objects;
     // also create an instanced buffer;
     try
     {
-        InitializeShaders(pDevice, vsFilePath, psFilePath, gsFilePath);
+        InitializeShaders(pDevice, vsFilePath, psFilePath, gsFilePath, pullVsFilePath);
         LogDbg("is initialized");
         return true;
     }
@@ -80,12 +84,33 @@ void BillboardShader::UpdateInstancedBuffer(
         CAssert::True(pInstancedBuffer_, "ptr to instanced buffer == nullptr (you have to initialize it!)");
 #endif
 
-        // map the instanced buffer to write into it
-        D3D11_MAPPED_SUBRESOURCE mappedData;
-        HRESULT hr = pContext->Map(pInstancedBuffer_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
-        CAssert::NotFailed(hr, "can't map the instanced buffer");
-
-        ConstBufType::InstancedDataBillboards* dataView = (ConstBufType::InstancedDataBillboards*)mappedData.pData;
+        // both paths have the same layout of instances
+        ID3D11Buffer* pBuffer = (isVertexPulling_) ? pInstancedSB_ : pInstancedBuffer_;
+        ConstBufType::InstancedDataBillboards* dataView = nullptr;
+
+        // the GS path reads instances as a vertex buffer so it can be sub-allocated
+        TransientAlloc<ConstBufType::InstancedDataBillboards> alloc;
+
+        if (!isVertexPulling_ && pTransientAlloc_)
+            alloc = pTransientAlloc_->Allocate<ConstBufType::InstancedDataBillboards>(pContext, TRANSIENT_POOL_VB, (UINT)numBillboards);
+
+        if (alloc.IsValid())
+        {
+            dataView             = alloc.ptr;
+            pCurrInstancedVB_    = alloc.pBuffer;
+            currInstancedOffset_ = alloc.offset;
+        }
+        else
+        {
+            // map the instanced buffer to write into it
+            D3D11_MAPPED_SUBRESOURCE mappedData;
+            HRESULT hr = pContext->Map(pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+            CAssert::NotFailed(hr, "can't map the instanced buffer");
+
+            dataView             = (ConstBufType::InstancedDataBillboards*)mappedData.pData;
+            pCurrInstancedVB_    = pInstancedBuffer_;
+            currInstancedOffset_ = 0;
+        }
 
         // write data into the subresource
         for (int i = 0; i < numBillboards; ++i)
@@ -98,7 +123,11 @@ void BillboardShader::UpdateInstancedBuffer(
             dataView[i].size = sizes[i];
 
         numCurrentInstances_ = numBillboards;
-        pContext->Unmap(pInstancedBuffer_, 0);
+
+        if (alloc.IsValid())
+            pTransientAlloc_->Unmap(pContext, alloc);
+        else
+            pContext->Unmap(pBuffer, 0);
     }
     catch (EngineException& e)
     {
@@ -124,53 +153,81 @@ void BillboardShader::Render(
     //
 
     // bind input layout, shaders, samplers
-    pContext->IASetInputLayout(vs_.GetInputLayout());
-    pContext->VSSetShader(vs_.GetShader(), nullptr, 0);
-    pContext->GSSetShader(gs_.GetShader(), nullptr, 0);
-    pContext->PSSetShader(ps_.GetShader(), nullptr, 0);
-    pContext->PSSetSamplers(0, 1, samplerState_.GetAddressOf());
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetGS(pContext, gs_.GetShader());
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
 
     UINT offset = 0;
 
     // bind vertex/index buffer and textures 2D array as well
-    pContext->IASetVertexBuffers(0, 1, &pBillboardVB, &stride, &offset);
-    pContext->IASetIndexBuffer(pBillboardIB, DXGI_FORMAT_R32_UINT, 0);
-    pContext->PSSetShaderResources(0, 1, ppTextureArrSRV);
+    pStateCache_->SetVertexBuffers(pContext, 0, 1, &pBillboardVB, &stride, &offset);
+    pStateCache_->SetIndexBuffer(pContext, pBillboardIB, DXGI_FORMAT_R32_UINT, 0);
+    pStateCache_->SetPSShaderResources(pContext, 0, 1, ppTextureArrSRV);
 
     // draw a billboard
-    pContext->DrawIndexed(4, 0, 0);
+    pStateCache_->DrawIndexed(pContext, 4, 0, 0);
 
     // unbind the geometry shader
-    pContext->GSSetShader(nullptr, nullptr, 0);
+    pStateCache_->SetGS(pContext, nullptr);
 }
 
 ///////////////////////////////////////////////////////////
 
 void BillboardShader::Render(ID3D11DeviceContext* pContext, const Instance& instance)
 {
+    if (isVertexPulling_)
+    {
+        RenderVertexPulling(pContext, instance.texSRVs.data());
+        return;
+    }
+
     // bind input layout, shaders, samplers
-    pContext->IASetInputLayout(vs_.GetInputLayout());
-    pContext->VSSetShader(vs_.GetShader(), nullptr, 0);
-    pContext->GSSetShader(gs_.GetShader(), nullptr, 0);
-    pContext->PSSetShader(ps_.GetShader(), nullptr, 0);
-    pContext->PSSetSamplers(0, 1, samplerState_.GetAddressOf());
-    pContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetGS(pContext, gs_.GetShader());
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
     // bind vertex/index buffer and textures 2D array as well
     const UINT instanceBufElemSize = sizeof(ConstBufType::InstancedDataBillboards);
-    ID3D11Buffer* const vbs[2]     = { instance.pVB, pInstancedBuffer_ };
+    ID3D11Buffer* const vbs[2]     = { instance.pVB, pCurrInstancedVB_ };
     const UINT stride[2]           = { instance.vertexStride, instanceBufElemSize };
-    const UINT offset[2]           = { 0,0 };
+    const UINT offset[2]           = { 0, currInstancedOffset_ };
 
-    pContext->IASetVertexBuffers(0, 2, vbs, stride, offset);
-    pContext->IASetIndexBuffer(instance.pIB, DXGI_FORMAT_R32_UINT, 0);
-    pContext->PSSetShaderResources(0, 1, instance.texSRVs.data());
+    pStateCache_->SetVertexBuffers(pContext, 0, 2, vbs, stride, offset);
+    pStateCache_->SetIndexBuffer(pContext, instance.pIB, instance.indexFormat, 0);
+    pStateCache_->SetPSShaderResources(pContext, 0, 1, instance.texSRVs.data());
 
     // draw billboard instances
-    pContext->DrawIndexedInstanced(4, numCurrentInstances_,	0, 0, 0);
+    pStateCache_->DrawIndexedInstanced(pContext, 4, numCurrentInstances_,	0, 0, 0);
 
     // unbind the geometry shader
-    pContext->GSSetShader(nullptr, nullptr, 0);
+    pStateCache_->SetGS(pContext, nullptr);
+}
+
+///////////////////////////////////////////////////////////
+
+void BillboardShader::RenderVertexPulling(
+    ID3D11DeviceContext* pContext,
+    SRV* const* ppTextureArrSRV)
+{
+    // draw an instanced 4-vertex quad (triangle strip) per billboard: there are
+    // no vertex buffers, the VS fetches billboards by SV_InstanceID
+
+    pStateCache_->SetInputLayout(pContext, nullptr);
+    pStateCache_->SetVS(pContext, vsPull_.GetShader());
+    pStateCache_->SetGS(pContext, nullptr);
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+
+    pStateCache_->SetVSShaderResources(pContext, BILLBOARDS_SLOT, 1, &pInstancedSRV_);
+    pStateCache_->SetPSShaderResources(pContext, 0, 1, ppTextureArrSRV);
+
+    pStateCache_->DrawInstanced(pContext, 4, numCurrentInstances_, 0, 0);
 }
 
 
@@ -179,7 +236,10 @@ void BillboardShader::Render(ID3D11DeviceContext* pContext, const Instance& inst
 // ====================================================================================
 void BillboardShader::Shutdown()
 {
+    SafeRelease(&pInstancedSRV_);
+    SafeRelease(&pInstancedSB_);
     SafeRelease(&pInstancedBuffer_);
+    pCurrInstancedVB_ = nullptr;
     instancedData_.clear();
 }
 
@@ -189,7 +249,8 @@ void BillboardShader::InitializeShaders(
     ID3D11Device* pDevice,
     const char* vsFilePath,
     const char* psFilePath,
-    const char* gsFilePath)
+    const char* gsFilePath,
+    const char* pullVsFilePath)
 {
     // initialized the vertex shader, pixel shader, input layout, 
     // sampler state, and different constant buffers
@@ -219,6 +280,10 @@ void BillboardShader::InitializeShaders(
     result = vs_.Initialize(pDevice, vsFilePath, inputLayoutDesc, layoutElemNum);
     CAssert::True(result, "can't initialize the vertex shader");
 
+    // the vertex pulling VS has no input layout
+    result = vsPull_.Initialize(pDevice, pullVsFilePath, nullptr, 0);
+    CAssert::True(result, "can't initialize the vertex pulling shader");
+
     result = gs_.Initialize(pDevice, gsFilePath);
     CAssert::True(result, "can't initialize the geometry shader");
 
@@ -243,6 +308,23 @@ void BillboardShader::InitializeShaders(
 
     HRESULT hr = pDevice->CreateBuffer(&desc, nullptr, &pInstancedBuffer_);
     CAssert::NotFailed(hr, "can't create an instanced buffer");
+
+    // create a structured buffer of the same instances (for the vertex pulling)
+    desc.BindFlags           = D3D11_BIND_SHADER_RESOURCE;
+    desc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    desc.StructureByteStride = sizeof(ConstBufType::InstancedDataBillboards);
+
+    hr = pDevice->CreateBuffer(&desc, nullptr, &pInstancedSB_);
+    CAssert::NotFailed(hr, "can't create a structured buffer of billboards");
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+    srvDesc.Format               = DXGI_FORMAT_UNKNOWN;
+    srvDesc.ViewDimension        = D3D11_SRV_DIMENSION_BUFFER;
+    srvDesc.Buffer.FirstElement  = 0;
+    srvDesc.Buffer.NumElements   = (UINT)numMaxInstances_;
+
+    hr = pDevice->CreateShaderResourceView(pInstancedSB_, &srvDesc, &pInstancedSRV_);
+    CAssert::NotFailed(hr, "can't create a SRV of the billboards structured buffer");
 }
 
 } // namespace Render
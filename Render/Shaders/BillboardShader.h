@@ -6,6 +6,8 @@
 #include "SamplerState.h"
 #include "../Common/ConstBufferTypes.h"
 #include "../Common/RenderTypes.h"
+#include "../StateCache.h"
+#include "../TransientAllocator.h"
 
 #include <d3d11.h>
 
@@ -29,7 +31,8 @@ public:
         ID3D11Device* pDevice,
         const char* vsFilePath,
         const char* psFilePath,
-        const char* gsFilePath);
+        const char* gsFilePath,
+        const char* pullVsFilePath);
 
     void UpdateInstancedBuffer(
         ID3D11DeviceContext* pContext,
@@ -47,32 +50,55 @@ public:
         const DirectX::XMFLOAT3 position);
 
     // Public rendering API
+    // (billboards are expanded by the GS or by vertex pulling, see SetVertexPulling)
     void Render(ID3D11DeviceContext* pContext, const Instance& instance);
 
     void Shutdown();
 
     // Public query API
     inline const char* GetShaderName() const { return className_; }
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+    inline void SetTransientAllocator(TransientAllocator* pAlloc) { pTransientAlloc_ = pAlloc; }
+
+    // expand billboards by an instanced quad which fetches its billboard from
+    // a structured buffer (true) or by the geometry shader (false);
+    // NOTE: call it before UpdateInstancedBuffer (each path has its own buffer)
+    inline void SetVertexPulling(const bool pulling) { isVertexPulling_ = pulling; }
+    inline bool IsVertexPulling() const              { return isVertexPulling_; }
 
 private:
     void InitializeShaders(
         ID3D11Device* pDevice,
         const char* vsFilename,
         const char* gsFilename,
-        const char* psFilename);
+        const char* psFilename,
+        const char* pullVsFilename);
+
+    void RenderVertexPulling(ID3D11DeviceContext* pContext, SRV* const* ppTextureArrSRV);
 
 private:
     VertexShader        vs_;
+    VertexShader        vsPull_;             // expands billboards without the GS
     GeometryShader      gs_;
     PixelShader         ps_;
     SamplerState        samplerState_;
 
-    ID3D11Buffer*                               pInstancedBuffer_ = nullptr;
+    // a slot of the billboards structured buffer in the VS (see billboardPullVS.hlsl)
+    static constexpr UINT BILLBOARDS_SLOT = 10;
+
+    ID3D11Buffer*                               pInstancedBuffer_ = nullptr;   // GS path: per instance vertex buffer (if the transient allocator can't be used)
+    ID3D11Buffer*                               pCurrInstancedVB_ = nullptr;   // GS path: where are instances of this frame
+    UINT                                        currInstancedOffset_ = 0;      // in bytes
+    TransientAllocator*                         pTransientAlloc_  = nullptr;   // is owned by CRender
+    ID3D11Buffer*                               pInstancedSB_     = nullptr;   // vertex pulling path: structured buffer
+    ID3D11ShaderResourceView*                   pInstancedSRV_    = nullptr;
     cvector<ConstBufType::InstancedDataBillboards> instancedData_;
 
+    StateCache* pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
     char className_[32]{"BillboardShader"};
     const int numMaxInstances_ = 500;                     // limit of instances
     int numCurrentInstances_ = 0;                         // how many instances will we render for this frame?
+    bool isVertexPulling_ = true;
 };
 
 }  // namespace Render
@@ -48,13 +48,14 @@ void ColorShader::Render(
     ID3D11Buffer* pInstancedBuffer,
     const Instance* instances,
     const int numModels,
-    const UINT instancedBuffElemSize)
+    const UINT instancedBuffElemSize,
+    const UINT baseInstance)
 {
-    int startInstanceLocation = 0;
+    int startInstanceLocation = (int)baseInstance;
 
-    pContext->IASetInputLayout(vs_.GetInputLayout());
-    pContext->VSSetShader(vs_.GetShader(), nullptr, 0);
-    pContext->PSSetShader(ps_.GetShader(), nullptr, 0);
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetPS(pContext, ps_.GetShader());
 
 
     // go through each instance and render it
@@ -68,8 +69,8 @@ void ColorShader::Render(
         // prepare input assembler (IA) stage before the rendering process
         ID3D11Buffer* const vbs[2] = { instance.pVB, pInstancedBuffer };
 
-        pContext->IASetVertexBuffers(0, 2, vbs, stride, offset);
-        pContext->IASetIndexBuffer(instance.pIB, DXGI_FORMAT_R32_UINT, 0);
+        pStateCache_->SetVertexBuffers(pContext, 0, 2, vbs, stride, offset);
+        pStateCache_->SetIndexBuffer(pContext, instance.pIB, instance.indexFormat, 0);
 
         SRV* const* texIDs = instance.texSRVs.data();
 
@@ -78,7 +79,8 @@ void ColorShader::Render(
         {
             const Subset& subset = instance.subsets[subsetIdx];
 
-            pContext->DrawIndexedInstanced(
+            pStateCache_->DrawIndexedInstanced(
+                pContext,
                 subset.indexCount,
                 instance.numInstances,
                 subset.indexStart,
@@ -125,22 +127,11 @@ void ColorShader::InitializeShaders(
         {"WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
         {"WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
         {"WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-
-        {"WORLD_INV_TRANSPOSE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD_INV_TRANSPOSE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD_INV_TRANSPOSE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD_INV_TRANSPOSE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 112, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-
-        {"TEX_TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 128, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"TEX_TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 144, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"TEX_TRANSFORM", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 160, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"TEX_TRANSFORM", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 176, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-
-        {"MATERIAL", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"MATERIAL", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"MATERIAL", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"MATERIAL", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+
+        {"TEX_TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"TEX_TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+
+        {"MATERIAL_IDX", 0, DXGI_FORMAT_R32_UINT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1},
     };
     
     const UINT layoutElemNum = sizeof(inputLayoutDesc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
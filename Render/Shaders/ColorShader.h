@@ -11,6 +11,7 @@
 #include "PixelShader.h"
 
 #include "../Common/RenderTypes.h"
+#include "../StateCache.h"
 
 #include <d3d11.h>
 #include <DirectXMath.h>
@@ -53,9 +54,11 @@ public:
         ID3D11Buffer* pInstancedBuffer,
         const Instance* instances,
         const int numModels,
-        const UINT instancesBuffElemSize);
+        const UINT instancesBuffElemSize,
+        const UINT baseInstance);
 
     inline const char* GetShaderName() const { return className_; }
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
 
 
 private:
@@ -68,6 +71,7 @@ private:
     VertexShader   vs_;
     PixelShader    ps_;
 
+    StateCache* pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
     char className_[32]{"ColorShader"};
 };
 
@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////
+// Filename: ComputeShader.cpp
+// Created:  14.10.26
+////////////////////////////////////////////////////////////////////
+#include "../Common/pch.h"
+#include "ComputeShader.h"
+
+#include "Helpers/CSOLoader.h"
+#include "Helpers/ShaderCompiler.h"
+
+
+namespace Render
+{
+
+ComputeShader::ComputeShader()
+{
+}
+
+ComputeShader::~ComputeShader()
+{
+}
+
+///////////////////////////////////////////////////////////
+
+bool ComputeShader::Initialize(ID3D11Device* pDevice, const char* shaderPath)
+{
+    // initializing of a compute shader object
+
+    if (StrHelper::IsEmpty(shaderPath))
+    {
+        LogErr("input path to compute shader file is empty!");
+        return false;
+    }
+
+    uint8_t* buffer = nullptr;
+
+    // load in shader bytecode
+    const size_t len = LoadCSO(shaderPath, buffer);
+    if (!len)
+    {
+        SafeDeleteArr(buffer);
+        sprintf(g_String, "Failed to load .CSO-file of compute shader: %s", shaderPath);
+        LogErr(g_String);
+        return false;
+    }
+
+    HRESULT hr = pDevice->CreateComputeShader((void*)buffer, len, nullptr, &pShader_);
+    if (FAILED(hr))
+    {
+        SafeDeleteArr(buffer);
+        sprintf(g_String, "Failed to create a compute shader obj: %s", shaderPath);
+        LogErr(g_String);
+        Shutdown();
+        return false;
+    }
+
+    // Release the compute shader buffer since it is no longer needed.
+    SafeDeleteArr(buffer);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ComputeShader::CompileShaderFromFile(
+    ID3D11Device* pDevice,
+    const char* shaderPath,
+    const char* funcName,
+    const char* shaderProfile)
+{
+    // is using for hot reload
+
+    if (StrHelper::IsEmpty(shaderPath) || StrHelper::IsEmpty(funcName) || StrHelper::IsEmpty(shaderProfile))
+    {
+        LogErr("input arguments are invalid: some string is empty");
+        return false;
+    }
+
+
+    ID3D10Blob*        pShaderBuffer = nullptr;
+    ID3D11ComputeShader* pShader = nullptr;
+    HRESULT hr = S_OK;
+
+    // compile a compute shader and load bytecode into the buffer
+    hr = ShaderCompiler::CompileShaderFromFile(
+        shaderPath,
+        funcName,
+        shaderProfile,
+        &pShaderBuffer);
+    if (FAILED(hr))
+    {
+        SafeRelease(&pShaderBuffer);
+        sprintf(g_String, "can't compile a compute shader from file: %s", shaderPath);
+        LogErr(g_String);
+        return false;
+    }
+
+
+    hr = pDevice->CreateComputeShader(
+        pShaderBuffer->GetBufferPointer(),
+        pShaderBuffer->GetBufferSize(),
+        nullptr,
+        &pShader);
+    if (FAILED(hr))
+    {
+        sprintf(g_String, "Failed to create a compute shader obj: %s", shaderPath);
+        LogErr(g_String);
+        Shutdown();
+        return false;
+    }
+
+    // Release the compute shader buffer since it is no longer needed.
+    SafeRelease(&pShaderBuffer);
+
+    // release previous shader's data if we have any
+    Shutdown();
+
+    pShader_ = pShader;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ComputeShader::Shutdown()
+{
+    LogDbg("shutdown");
+    SafeRelease(&pShader_);
+}
+
+} // namespace 
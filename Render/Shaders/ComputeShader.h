@@ -0,0 +1,39 @@
+////////////////////////////////////////////////////////////////////
+// Filename:     ComputeShader.h
+// Description:  this is a class for handling all the compute shader stuff
+//
+// Created:      14.10.26
+////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <d3d11.h>
+
+namespace Render
+{
+
+class ComputeShader
+{
+public:
+    ComputeShader();
+    ~ComputeShader();
+
+    bool Initialize(
+        ID3D11Device* pDevice,
+        const char* shaderPath);
+
+    bool CompileShaderFromFile(
+        ID3D11Device* pDevice,
+        const char* shaderPath,
+        const char* funcName,
+        const char* shaderProfile);
+
+    void Shutdown();
+
+    inline ID3D11ComputeShader* GetShader() { return pShader_; };
+
+private:
+    ID3D11ComputeShader* pShader_ = nullptr;
+};
+
+} // namespace
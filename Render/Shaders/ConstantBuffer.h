@@ -5,6 +5,7 @@
 // *********************************************************************************
 #pragma once
 
+#include "../FrameStats.h"
 #include <Log.h>
 #include <d3d11.h>
 #include <DirectXMath.h>
@@ -29,6 +30,17 @@ public:
 
 	void ApplyChanges(ID3D11DeviceContext* pContext);  // update the constant buffer data
 
+	// setters only mark the data as changed and it's loaded into the GPU once by
+	// the next flush (so a few setters in a row cost a single Map/Unmap)
+	inline void MarkDirty()     { isDirty_ = true; }
+	inline bool IsDirty() const { return isDirty_; }
+
+	inline void ApplyChangesIfDirty(ID3D11DeviceContext* pContext)
+	{
+		if (isDirty_)
+			ApplyChanges(pContext);
+	}
+
 	inline ID3D11Buffer* Get() const { return pBuffer_; }
 	inline ID3D11Buffer* const* GetAddressOf() const { return &pBuffer_; }
 
@@ -36,6 +48,7 @@ public:
 
 private:
 	ID3D11Buffer* pBuffer_ = nullptr;
+	bool          isDirty_ = false;
 };
 
 // *********************************************************************************
@@ -91,6 +104,10 @@ void ConstantBuffer<T>::ApplyChanges(ID3D11DeviceContext* pContext)
 	
 	CopyMemory(mappedResource.pData, &data, sizeof(T));
 	pContext->Unmap(pBuffer_, 0);
+
+	g_FrameStats.AddUpload(UPLOAD_CONST_BUFFER, sizeof(T));
+
+	isDirty_ = false;
 }
 
 
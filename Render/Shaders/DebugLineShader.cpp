@@ -0,0 +1,174 @@
+// =================================================================================
+// Filename:     DebugLineShader.cpp
+// Description:  implementation of the DebugLineShader's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "DebugLineShader.h"
+
+namespace Render
+{
+
+DebugLineShader::DebugLineShader()
+{
+    strcpy(className_, __func__);
+}
+
+DebugLineShader::~DebugLineShader()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool DebugLineShader::Initialize(
+    ID3D11Device* pDevice,
+    const char* vsFilePath,
+    const char* psFilePath)
+{
+    try
+    {
+        InitializeShaders(pDevice, vsFilePath, psFilePath);
+        LogDbg("is initialized");
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        Shutdown();
+        LogErr(e, true);
+        LogErr("can't initialize the debug line shader class");
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void DebugLineShader::Shutdown()
+{
+    SafeRelease(&pVB_);
+    vbCapacity_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+void DebugLineShader::Render(
+    ID3D11Device* pDevice,
+    ID3D11DeviceContext* pContext,
+    const VertexDebugLine* vertices,
+    const UINT numVertices)
+{
+    if (!vertices || (numVertices < 2))
+        return;
+
+    ID3D11Buffer* pVB    = nullptr;
+    UINT          offset = 0;
+
+    TransientAlloc<VertexDebugLine> alloc;
+
+    if (pTransientAlloc_)
+        alloc = pTransientAlloc_->Allocate<VertexDebugLine>(pContext, TRANSIENT_POOL_VB, numVertices);
+
+    if (alloc.IsValid())
+    {
+        memcpy(alloc.ptr, vertices, sizeof(VertexDebugLine) * numVertices);
+        pTransientAlloc_->Unmap(pContext, alloc);
+
+        pVB    = alloc.pBuffer;
+        offset = alloc.offset;
+    }
+    else
+    {
+        // grow the buffer at least twice so we don't recreate it each frame
+        if (numVertices > vbCapacity_)
+        {
+            const UINT capacity = std::max(numVertices, std::max(2 * vbCapacity_, MIN_VB_CAPACITY));
+
+            if (!CreateVertexBuffer(pDevice, capacity))
+                return;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mappedData;
+        HRESULT hr = pContext->Map(pVB_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+        if (FAILED(hr))
+        {
+            LogErr("can't map the vertex buffer of debug lines");
+            return;
+        }
+
+        memcpy(mappedData.pData, vertices, sizeof(VertexDebugLine) * numVertices);
+        pContext->Unmap(pVB_, 0);
+
+        pVB = pVB_;
+    }
+
+    const UINT stride = sizeof(VertexDebugLine);
+
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetGS(pContext, nullptr);
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+    pStateCache_->SetVertexBuffers(pContext, 0, 1, &pVB, &stride, &offset);
+
+    // an odd vertex (a broken pair) is dropped
+    pStateCache_->Draw(pContext, numVertices & ~1u, 0);
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+void DebugLineShader::InitializeShaders(
+    ID3D11Device* pDevice,
+    const char* vsFilePath,
+    const char* psFilePath)
+{
+    bool result = false;
+
+    const D3D11_INPUT_ELEMENT_DESC inputLayoutDesc[] =
+    {
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM,  0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    };
+
+    const UINT layoutElemNum = sizeof(inputLayoutDesc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
+
+    // initialize: VS, PS (the vertex buffer is created by the first Render()
+    // which can't use the transient allocator)
+    result = vs_.Initialize(pDevice, vsFilePath, inputLayoutDesc, layoutElemNum);
+    CAssert::True(result, "can't initialize the vertex shader");
+
+    result = ps_.Initialize(pDevice, psFilePath);
+    CAssert::True(result, "can't initialize the pixel shader");
+}
+
+///////////////////////////////////////////////////////////
+
+bool DebugLineShader::CreateVertexBuffer(ID3D11Device* pDevice, const UINT capacity)
+{
+    D3D11_BUFFER_DESC desc;
+    desc.Usage               = D3D11_USAGE_DYNAMIC;
+    desc.ByteWidth           = static_cast<UINT>(sizeof(VertexDebugLine) * capacity);
+    desc.BindFlags           = D3D11_BIND_VERTEX_BUFFER;
+    desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+    desc.MiscFlags           = 0;
+    desc.StructureByteStride = 0;
+
+    ID3D11Buffer* pBuffer = nullptr;
+    HRESULT hr = pDevice->CreateBuffer(&desc, nullptr, &pBuffer);
+    if (FAILED(hr))
+    {
+        sprintf(g_String, "can't create a vertex buffer for %u debug line vertices", capacity);
+        LogErr(g_String);
+        return false;
+    }
+
+    SafeRelease(&pVB_);
+    pVB_        = pBuffer;
+    vbCapacity_ = capacity;
+
+    return true;
+}
+
+} // namespace Render
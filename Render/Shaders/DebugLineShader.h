@@ -0,0 +1,85 @@
+// =================================================================================
+// Filename:     DebugLineShader.h
+// Description:  renders all the debug lines of the frame by a single draw call:
+//               the vertices are sub-allocated from the transient allocator;
+//               without it they are uploaded into an own dynamic vertex buffer
+//               which grows when it is too small (and is never shrunk)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "VertexShader.h"
+#include "PixelShader.h"
+#include "../StateCache.h"
+#include "../TransientAllocator.h"
+
+#include <Types.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+// a vertex of the line list (16 bytes)
+struct VertexDebugLine
+{
+    DirectX::XMFLOAT3 pos;              // in world space
+    uint32            color;            // RGBA8 (red in the lowest byte)
+};
+
+///////////////////////////////////////////////////////////
+
+class DebugLineShader
+{
+public:
+    static constexpr UINT MIN_VB_CAPACITY = 4096;            // in vertices
+
+    DebugLineShader();
+    ~DebugLineShader();
+
+    // restrict a copying of this class instance
+    DebugLineShader(const DebugLineShader&) = delete;
+    DebugLineShader& operator=(const DebugLineShader&) = delete;
+
+    bool Initialize(
+        ID3D11Device* pDevice,
+        const char* vsFilePath,
+        const char* psFilePath);
+
+    void Shutdown();
+
+    // upload the lines (pairs of vertices) and render them
+    void Render(
+        ID3D11Device* pDevice,
+        ID3D11DeviceContext* pContext,
+        const VertexDebugLine* vertices,
+        const UINT numVertices);
+
+    inline const char* GetShaderName()            const { return className_; }
+    inline UINT        GetVBCapacity()            const { return vbCapacity_; }
+    inline void        SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+    inline void        SetTransientAllocator(TransientAllocator* pAlloc) { pTransientAlloc_ = pAlloc; }
+
+private:
+    void InitializeShaders(
+        ID3D11Device* pDevice,
+        const char* vsFilePath,
+        const char* psFilePath);
+
+    bool CreateVertexBuffer(ID3D11Device* pDevice, const UINT capacity);
+
+private:
+    VertexShader        vs_;
+    PixelShader         ps_;
+
+    ID3D11Buffer*       pVB_        = nullptr;
+    UINT                vbCapacity_ = 0;                    // in vertices (the buffer is created only if it's needed)
+    TransientAllocator* pTransientAlloc_ = nullptr;         // is owned by CRender
+
+    StateCache* pStateCache_ = nullptr;                     // filters redundant binds (is owned by CRender)
+    char className_[32]{ "DebugLineShader" };
+};
+
+} // namespace Render
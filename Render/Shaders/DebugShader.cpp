@@ -26,11 +26,12 @@ DebugShader::~DebugShader()
 bool DebugShader::Initialize(
     ID3D11Device* pDevice,
     const char* vsFilePath,
+    const char* gsFilePath,
     const char* psFilePath)
 {
     try
     {
-        InitializeShaders(pDevice, vsFilePath, psFilePath);
+        InitializeShaders(pDevice, vsFilePath, gsFilePath, psFilePath);
         LogDbg("is initialized");
         return true;
     }
@@ -49,18 +50,29 @@ void DebugShader::Render(
     ID3D11Buffer* pInstancedBuffer,
     const Instance* instances,
     const int numModels,
-    const UINT instancedBuffElemSize)
+    const UINT instancedBuffElemSize,
+    const UINT baseInstance)
 {
     // bind input layout, shaders, samplers
-    pContext->IASetInputLayout(vs_.GetInputLayout());
-    pContext->VSSetShader(vs_.GetShader(), nullptr, 0);
-    pContext->PSSetShader(ps_.GetShader(), nullptr, 0);
-    pContext->PSSetSamplers(0, 1, samplerState_.GetAddressOf());
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
+
+    // only the triangle density needs areas of triangles
+    const bool isDensity = (GetDebugType() == DBG_SHOW_TRIANGLE_DENSITY);
+    const bool isPerDraw = IsPerDrawDebugType();
+
+    if (isDensity)
+    {
+        pStateCache_->SetGS(pContext, gs_.GetShader());
+        UpdateViewportSize(pContext);
+    }
 
     // ---------------------------------------------
     
     // go through each instance and render it
-    for (int i = 0, startInstanceLocation = 0; i < numModels; ++i)
+    for (int i = 0, startInstanceLocation = (int)baseInstance; i < numModels; ++i)
     {
         const Instance& instance = instances[i];
 
@@ -69,8 +81,8 @@ void DebugShader::Render(
         const UINT stride[2] = { instance.vertexStride, instancedBuffElemSize };
         const UINT offset[2] = { 0,0 };
 
-        pContext->IASetVertexBuffers(0, 2, vbs, stride, offset);
-        pContext->IASetIndexBuffer(instance.pIB, DXGI_FORMAT_R32_UINT, 0);
+        pStateCache_->SetVertexBuffers(pContext, 0, 2, vbs, stride, offset);
+        pStateCache_->SetIndexBuffer(pContext, instance.pIB, instance.indexFormat, 0);
 
         // textures arr
         SRV* const* texIDs = instance.texSRVs.data();
@@ -79,14 +91,24 @@ void DebugShader::Render(
         for (int subsetIdx = 0; subsetIdx < (int)std::ssize(instance.subsets); ++subsetIdx)
         {
             // update textures for the current subset
-            pContext->PSSetShaderResources(
+            pStateCache_->SetPSShaderResources(
+                pContext,
                 0U,
                 NUM_TEXTURE_TYPES,
                 texIDs + (subsetIdx * NUM_TEXTURE_TYPES));
 
             const Subset& subset = instance.subsets[subsetIdx];
 
-            pContext->DrawIndexedInstanced(
+            // each subset is a separate draw call: it is a batch of all the instances
+            if (isPerDraw)
+            {
+                cbpsRareChangedDebug_.data.drawLod   = instance.lod;
+                cbpsRareChangedDebug_.data.drawBatch = (uint)(((uintptr_t)instance.pVB >> 4) * 2654435761u) ^ subset.indexStart;
+                cbpsRareChangedDebug_.ApplyChanges(pContext);
+            }
+
+            pStateCache_->DrawIndexedInstanced(
+                pContext,
                 subset.indexCount,
                 instance.numInstances,
                 subset.indexStart,
@@ -96,6 +118,9 @@ void DebugShader::Render(
 
         startInstanceLocation += (int)std::ssize(instance.subsets) * instance.numInstances;
     }
+
+    if (isDensity)
+        pStateCache_->SetGS(pContext, nullptr);
 }
 
 ///////////////////////////////////////////////////////////
@@ -108,6 +133,25 @@ void DebugShader::SetDebugType(ID3D11DeviceContext* pContext, const eDebugState
     cbpsRareChangedDebug_.ApplyChanges(pContext);
 }
 
+///////////////////////////////////////////////////////////
+
+void DebugShader::UpdateViewportSize(ID3D11DeviceContext* pContext)
+{
+    // the size of the current target (the scene can be rendered with a dynamic resolution)
+    UINT           numViewports = 1;
+    D3D11_VIEWPORT viewport     = {};
+    pContext->RSGetViewports(&numViewports, &viewport);
+
+    if ((numViewports == 0) ||
+        ((cbpsRareChangedDebug_.data.viewportWidth  == viewport.Width) &&
+         (cbpsRareChangedDebug_.data.viewportHeight == viewport.Height)))
+        return;
+
+    cbpsRareChangedDebug_.data.viewportWidth  = viewport.Width;
+    cbpsRareChangedDebug_.data.viewportHeight = viewport.Height;
+    cbpsRareChangedDebug_.ApplyChanges(pContext);
+}
+
 
 // =================================================================================
 //                               private methods                                       
@@ -115,6 +159,7 @@ void DebugShader::SetDebugType(ID3D11DeviceContext* pContext, const eDebugState
 void DebugShader::InitializeShaders(
     ID3D11Device* pDevice,
     const char* vsFilePath,
+    const char* gsFilePath,
     const char* psFilePath)
 {
     //
@@ -129,30 +174,19 @@ void DebugShader::InitializeShaders(
     {
         // per vertex data
         {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,      0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"NORMAL",   0, DXGI_FORMAT_R10G10B10A2_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TANGENT",  0, DXGI_FORMAT_R10G10B10A2_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
 
         // per instance data
         {"WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
         {"WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
         {"WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-
-        {"WORLD_INV_TRANSPOSE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD_INV_TRANSPOSE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD_INV_TRANSPOSE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"WORLD_INV_TRANSPOSE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 112, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-
-        {"TEX_TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 128, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"TEX_TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 144, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"TEX_TRANSFORM", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 160, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"TEX_TRANSFORM", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 176, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-
-        {"MATERIAL", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"MATERIAL", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"MATERIAL", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-        {"MATERIAL", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+
+        {"TEX_TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"TEX_TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+
+        {"MATERIAL_IDX", 0, DXGI_FORMAT_R32_UINT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1},
     };
 
     const UINT layoutElemNum = sizeof(inputLayoutDesc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
@@ -163,6 +197,9 @@ void DebugShader::InitializeShaders(
     result = vs_.Initialize(pDevice, vsFilePath, inputLayoutDesc, layoutElemNum);
     CAssert::True(result, "can't initialize the vertex shader");
 
+    result = gs_.Initialize(pDevice, gsFilePath);
+    CAssert::True(result, "can't initialize the geometry shader");
+
     // initialize the DEFAULT pixel shader
     result = ps_.Initialize(pDevice, psFilePath);
     CAssert::True(result, "can't initialize the pixel shader");
@@ -1,15 +1,19 @@
 // ********************************************************************************
 // Filename:     DebugShader.h
-// Description:  is used to show normals, tangens, binormals as color
+// Description:  is used to show normals, tangens, binormals as color;
+//               also renders performance heatmaps (overdraw, LODs, lights
+//               per cluster, triangles per pixel, draw call batches)
 // Created:      24.11.24
 // ********************************************************************************
 #pragma once
 
 #include "VertexShader.h"
+#include "GeometryShader.h"
 #include "PixelShader.h"
 #include "SamplerState.h"         // for using textures sampler
 #include "ConstantBuffer.h"
 #include "../Common/RenderTypes.h"
+#include "../StateCache.h"
 
 #include <d3d11.h>
 
@@ -26,7 +30,17 @@ namespace BuffTypesDebug
 	struct cbpsRareChanged
 	{
 		// a structure for specific DEBUG PIXEL shader data which is rarely changed
-		int debugType = eDebugState::DBG_SHOW_NORMALS;
+		int   debugType = eDebugState::DBG_SHOW_NORMALS;
+
+		// params of the current draw call (are updated per draw only by heatmaps which need them)
+		int   drawLod   = 0;
+		uint  drawBatch = 0;                // a hash of the draw call
+		float padding0  = 0;
+
+		// triangles of the GS are measured in NDC and are scaled into pixels by it
+		float viewportWidth  = 1;
+		float viewportHeight = 1;
+		float padding1[2]    = { 0,0 };
 	};
 };
 
@@ -46,6 +60,7 @@ public:
     bool Initialize(
         ID3D11Device* pDevice,
         const char* vsFilePath,
+        const char* gsFilePath,
         const char* psFilePath);
 
 	void Render(
@@ -53,27 +68,43 @@ public:
 		ID3D11Buffer* pInstancedBuffer,
 		const Instance* instances,
 		const int numModels,
-		const UINT instancedBuffElemSize);
+		const UINT instancedBuffElemSize,
+		const UINT baseInstance);
 
 	// change debug type (show normals, tangents, only diffuse map, etc.)
 	void SetDebugType(ID3D11DeviceContext* pContext, const eDebugState state);
 
     inline int           GetDebugType()                const { return cbpsRareChangedDebug_.data.debugType; }
+
+    // heatmaps which are colored by params of each draw call (LOD, batch)
+    inline bool IsPerDrawDebugType() const
+    {
+        const int type = cbpsRareChangedDebug_.data.debugType;
+        return (type == DBG_SHOW_LOD) || (type == DBG_SHOW_BATCHES);
+    }
+
 	inline const char*   GetShaderName()               const { return className_; }
+	inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
 	inline ID3D11Buffer* GetConstBufferPSRareChanged() const { return cbpsRareChangedDebug_.Get(); }
 
 private:
 	void InitializeShaders(
 		ID3D11Device* pDevice,
 		const char* vsFilePath,
+        const char* gsFilePath,
         const char* psFilePath);
 
+    // setup the viewport size of the triangle density heatmap (if it is changed)
+    void UpdateViewportSize(ID3D11DeviceContext* pContext);
+
 private:
-	VertexShader vs_;
-	PixelShader  ps_;                       
+	VertexShader   vs_;
+	GeometryShader gs_;                     // measures screen areas of triangles (only for the triangle density)
+	PixelShader    ps_;                       
 	SamplerState samplerState_;                                            // a sampler for texturing
 	ConstantBuffer<BuffTypesDebug::cbpsRareChanged> cbpsRareChangedDebug_; // cbps - const buffer pixel shader for rare changed stuff
 
+	StateCache* pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
 	char className_[32]{"DebugShader"};
 };
 
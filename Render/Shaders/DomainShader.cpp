@@ -0,0 +1,71 @@
+// =================================================================================
+// Filename: DomainShader.cpp
+// Created:  14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "DomainShader.h"
+#include "Helpers/CSOLoader.h"
+
+
+namespace Render
+{
+
+DomainShader::~DomainShader()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool DomainShader::Initialize(ID3D11Device* pDevice, const char* shaderPath)
+{
+    // THIS FUNC loads a CSO shader by shaderPath
+    // and then creates a domain shader object
+
+    if ((shaderPath == nullptr) || (shaderPath[0] == '\0'))
+    {
+        LogErr("input path to domain shader file is empty!");
+        return false;
+    }
+
+    // load in shader bytecode
+    const size_t len = LoadCSO(shaderPath, pShaderBuffer_);
+    if (!len)
+    {
+        sprintf(g_String, "Failed to load .CSO-file of domain shader: %s", shaderPath);
+        LogErr(g_String);
+        Shutdown();
+        return false;
+    }
+
+    // --------------------------------------------
+
+    const HRESULT hr = pDevice->CreateDomainShader(
+        pShaderBuffer_,
+        len,
+        nullptr,
+        &pShader_);
+
+    if (FAILED(hr))
+    {
+        sprintf(g_String, "Failed to create a domain shader obj: %s", shaderPath);
+        LogErr(g_String);
+        Shutdown();
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void DomainShader::Shutdown()
+{
+    // Shutting down of the class object, releasing of the memory, etc.
+
+    LogDbg("Shutdown");
+    SafeDeleteArr(pShaderBuffer_);
+    SafeRelease(&pShader_);
+}
+
+}; // namespace Render
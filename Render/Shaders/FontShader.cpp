@@ -91,25 +91,25 @@ void FontShader::Render(
         CAssert::True(numSentences > 0, "input number of sentences must be > 0");
 
         // bind vertex/pixel shaders and input layout
-        pContext->VSSetShader(vs_.GetShader(), nullptr, 0U);
-        pContext->PSSetShader(ps_.GetShader(), nullptr, 0U);
-        pContext->IASetInputLayout(vs_.GetInputLayout());
+        pStateCache_->SetVS(pContext, vs_.GetShader());
+        pStateCache_->SetPS(pContext, ps_.GetShader());
+        pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
 
         // set the sampler state and textures
-        pContext->PSSetSamplers(0, 1, samplerState_.GetAddressOf());
-        pContext->PSSetShaderResources(0, 1, ppFontTexSRV);
+        pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
+        pStateCache_->SetPSShaderResources(pContext, 0, 1, ppFontTexSRV);
 
         const UINT stride = fontVertexSize;
         const UINT offset = 0;
 
-        pContext->IASetIndexBuffer(pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+        pStateCache_->SetIndexBuffer(pContext, pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
 
         for (index idx = 0; idx < numSentences; ++idx)
         {
-            pContext->IASetVertexBuffers(0, 1, &vertexBuffers[idx], &stride, &offset);
+            pStateCache_->SetVertexBuffers(pContext, 0, 1, &vertexBuffers[idx], &stride, &offset);
             
             // render the fonts on the screen
-            pContext->DrawIndexed(indexCounts[idx], 0, 0);
+            pStateCache_->DrawIndexed(pContext, indexCounts[idx], 0, 0);
         }
     }
     catch (EngineException& e)
@@ -13,6 +13,7 @@
 #include "ConstantBuffer.h"
 
 #include "../Common/ConstBufferTypes.h"
+#include "../StateCache.h"
 
 #include <Types.h>
 #include <d3d11.h>
@@ -58,6 +59,7 @@ public:
 
     // Public query API
     inline const char* GetShaderName()      const { return className_; }
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
     inline ID3D11Buffer* GetConstBufferVS() const { return matrixBuffer_.Get(); }
     inline ID3D11Buffer* GetConstBufferPS() const { return pixelBuffer_.Get(); }
 
@@ -77,6 +79,7 @@ private:
     ConstantBuffer<ConstBufType::ConstantMatrixBuffer_FontVS> matrixBuffer_;
     ConstantBuffer<ConstBufType::ConstantPixelBuffer_FontPS>  pixelBuffer_;   // text colour for the pixel shader
 
+    StateCache* pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
     char className_[32]{"FontShader"};
 };
 
@@ -2,6 +2,7 @@
 
 #include <CAssert.h>
 #include <log.h>
+#include <FileSystem.h>
 #include <stdexcept>
 
 #pragma warning (disable : 4996)
@@ -13,32 +14,18 @@ namespace Render
 static size_t LoadCSO(const char* shaderPath, uint8_t*& bytes)
 {
     // read in bytecode from the input .CSO file (compiled shader object)
+    // from mounted asset packs or from disk
     try
     {
-        FILE* pFile = fopen(shaderPath, "rb");
-        if (!pFile)
-        {
-            sprintf(g_String, "can't open a file with shader bytecode: %s", shaderPath);
-            LogErr(g_String);
-            return 0;
-        }
+        size_t len = 0;
 
-        fseek(pFile, 0, SEEK_END);
-        const size_t len = (size_t)ftell(pFile);
-
-        bytes = new uint8_t[len]{ 0 };
-        fseek(pFile, 0, SEEK_SET);
-
-        size_t readCount = fread(bytes, 1, len, pFile);
-        if (readCount != len)
+        if (!FileSys::ReadFile(shaderPath, bytes, len))
         {
-            SafeDeleteArr(bytes);
             sprintf(g_String, "can't read data from a file with shader bytecode: %s", shaderPath);
             LogErr(g_String);
             return 0;
         }
 
-        fclose(pFile);
         return len;
     }
     catch (std::bad_alloc& e)
@@ -47,10 +34,8 @@ static size_t LoadCSO(const char* shaderPath, uint8_t*& bytes)
 
         LogErr(e.what());
         LogErr(g_String);
-        return false;
+        return 0;
     }
-
-    return true;
 }
 
 } // namespace Render
@@ -0,0 +1,253 @@
+// =================================================================================
+// Filename:     ShaderCache.cpp
+// Description:  implementation of the ShaderCache's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "ShaderCache.h"
+#include <log.h>
+#include <filesystem>
+
+#pragma warning (disable : 4996)
+
+namespace fs = std::filesystem;
+
+
+namespace Render
+{
+
+// cached bytecode and the manifest are here (relatively to the working directory)
+static const char* SHADER_CACHE_DIR      = "shaders/cache/";
+static const char* SHADER_CACHE_MANIFEST = "shaders/cache/manifest.txt";
+
+// includes of includes are hashed as well but not deeper than this
+static constexpr int MAX_INCLUDE_DEPTH   = 8;
+
+// FNV-1a params
+static constexpr uint64 FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static constexpr uint64 FNV_PRIME        = 1099511628211ULL;
+
+
+//---------------------------------------------------------
+// Desc:  mix the input bytes into the hash
+//---------------------------------------------------------
+static void HashBytes(uint64& hash, const void* data, const size_t numBytes)
+{
+    const uint8* bytes = (const uint8*)data;
+
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+}
+
+//---------------------------------------------------------
+// Desc:  mix the input null-terminated string into the hash
+//---------------------------------------------------------
+static void HashStr(uint64& hash, const char* str)
+{
+    // (the terminator is hashed as well so "ab"+"c" != "a"+"bc")
+    if (str)
+        HashBytes(hash, str, strlen(str) + 1);
+    else
+        HashBytes(hash, "", 1);
+}
+
+//---------------------------------------------------------
+// Desc:  read the whole text file into the input buffer
+//---------------------------------------------------------
+static bool ReadTextFile(const char* path, cvector<char>& outText)
+{
+    FILE* pFile = fopen(path, "rb");
+    if (!pFile)
+        return false;
+
+    fseek(pFile, 0, SEEK_END);
+    const long len = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    outText.resize(len + 1);
+    const size_t readCount = fread(outText.data(), 1, (size_t)len, pFile);
+    outText[readCount] = '\0';
+
+    fclose(pFile);
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:  mix the text of the file and all its includes into the hash;
+//        a missing file mixes only its path (the compiler will report it)
+//---------------------------------------------------------
+static void HashFileWithIncludes(uint64& hash, const fs::path& path, const int depth)
+{
+    const std::string pathStr = path.string();
+    HashStr(hash, pathStr.c_str());
+
+    cvector<char> text;
+
+    if ((depth > MAX_INCLUDE_DEPTH) || !ReadTextFile(pathStr.c_str(), text))
+        return;
+
+    HashStr(hash, text.data());
+
+    // includes are relative to the directory of the file
+    const fs::path dir = path.parent_path();
+    const char*    pos = text.data();
+
+    while ((pos = strstr(pos, "#include")) != nullptr)
+    {
+        pos += strlen("#include");
+
+        // skip spaces until a name in quotes (system <includes> aren't used in shaders)
+        while (*pos == ' ' || *pos == '\t')
+            ++pos;
+
+        if (*pos != '"')
+            continue;
+
+        const char* nameBegin = pos + 1;
+        const char* nameEnd   = strchr(nameBegin, '"');
+
+        if (!nameEnd)
+            break;
+
+        const std::string name(nameBegin, nameEnd);
+        HashFileWithIncludes(hash, dir / name, depth + 1);
+
+        pos = nameEnd + 1;
+    }
+}
+
+
+// =================================================================================
+//                              static methods
+// =================================================================================
+uint64 ShaderCache::ComputeHash(
+    const char* srcPath,
+    const D3D_SHADER_MACRO* defines,
+    const char* funcName,
+    const char* profile)
+{
+    uint64 hash = FNV_OFFSET_BASIS;
+
+    HashFileWithIncludes(hash, fs::path(srcPath), 0);
+
+    for (const D3D_SHADER_MACRO* pDefine = defines; pDefine && pDefine->Name; ++pDefine)
+    {
+        HashStr(hash, pDefine->Name);
+        HashStr(hash, pDefine->Definition);
+    }
+
+    HashStr(hash, funcName);
+    HashStr(hash, profile);
+
+    return hash;
+}
+
+///////////////////////////////////////////////////////////
+
+void ShaderCache::GetBytecodePath(const uint64 hash, char* outPath, const int pathSize)
+{
+    snprintf(outPath, pathSize, "%s%016llx.cso", SHADER_CACHE_DIR, (unsigned long long)hash);
+}
+
+///////////////////////////////////////////////////////////
+
+void ShaderCache::CreateCacheDir()
+{
+    std::error_code ec;
+    fs::create_directories(SHADER_CACHE_DIR, ec);
+}
+
+
+// =================================================================================
+//                              manifest
+// =================================================================================
+bool ShaderCache::LoadManifest()
+{
+    entries_.clear();
+    isChanged_ = false;
+
+    // there is no manifest yet (all the variants will be compiled)
+    FILE* pFile = fopen(SHADER_CACHE_MANIFEST, "r");
+    if (!pFile)
+        return false;
+
+    Entry              entry;
+    unsigned long long hash = 0;
+
+    while (fscanf(pFile, "%47s %llx", entry.name, &hash) == 2)
+    {
+        entry.hash = (uint64)hash;
+        entries_.push_back(entry);
+    }
+
+    fclose(pFile);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ShaderCache::SaveManifest()
+{
+    if (!isChanged_)
+        return true;
+
+    CreateCacheDir();
+
+    FILE* pFile = fopen(SHADER_CACHE_MANIFEST, "w");
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open the shader cache manifest for writing: %s", SHADER_CACHE_MANIFEST);
+        LogErr(g_String);
+        return false;
+    }
+
+    for (const Entry& entry : entries_)
+        fprintf(pFile, "%s %016llx\n", entry.name, (unsigned long long)entry.hash);
+
+    fclose(pFile);
+    isChanged_ = false;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ShaderCache::GetHash(const char* variantName, uint64& outHash) const
+{
+    for (const Entry& entry : entries_)
+    {
+        if (strcmp(entry.name, variantName) == 0)
+        {
+            outHash = entry.hash;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+void ShaderCache::SetHash(const char* variantName, const uint64 hash)
+{
+    for (Entry& entry : entries_)
+    {
+        if (strcmp(entry.name, variantName) == 0)
+        {
+            isChanged_ |= (entry.hash != hash);
+            entry.hash = hash;
+            return;
+        }
+    }
+
+    Entry entry;
+    strncpy(entry.name, variantName, VARIANT_NAME_LENGTH_LIMIT - 1);
+    entry.hash = hash;
+
+    entries_.push_back(entry);
+    isChanged_ = true;
+}
+
+} // namespace Render
@@ -0,0 +1,59 @@
+// =================================================================================
+// Filename:     ShaderCache.h
+// Description:  an on-disk cache of compiled shader variants:
+//
+//               - each bytecode file is named by a hash of everything which
+//                 affects compilation: the source text, the text of all its
+//                 includes (recursively), defines, entry point and profile;
+//               - a manifest maps names of variants (e.g. "LightPS_1f") to
+//                 hashes of their bytecode files so shipped builds (without
+//                 .hlsl sources) just load .cso files without any compilation
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+class ShaderCache
+{
+public:
+    static constexpr int VARIANT_NAME_LENGTH_LIMIT = 48;
+
+    // compute a hash of the shader source + includes + defines + entry + profile
+    static uint64 ComputeHash(
+        const char* srcPath,
+        const D3D_SHADER_MACRO* defines,
+        const char* funcName,
+        const char* profile);
+
+    // get a path to the cached bytecode file by its hash
+    static void GetBytecodePath(const uint64 hash, char* outPath, const int pathSize);
+
+    static void CreateCacheDir();
+
+    // manifest: variant name => hash of its bytecode
+    bool LoadManifest();
+    bool SaveManifest();
+
+    bool GetHash(const char* variantName, uint64& outHash) const;
+    void SetHash(const char* variantName, const uint64 hash);
+
+private:
+    struct Entry
+    {
+        char   name[VARIANT_NAME_LENGTH_LIMIT]{ '\0' };
+        uint64 hash = 0;
+    };
+
+    cvector<Entry> entries_;
+    bool           isChanged_ = false;     // is the manifest needed to be saved?
+};
+
+} // namespace Render
@@ -16,7 +16,9 @@ HRESULT ShaderCompiler::CompileShaderFromFile(
     const char* filename, 
     LPCSTR functionName,
     LPCSTR shaderProfile, 
-    ID3D10Blob** shaderOutput)
+    ID3D10Blob** shaderOutput,
+    const D3D_SHADER_MACRO* defines,
+    ID3D10Blob** ppErrorMsgs)
 {
     ID3DBlob* pErrorMsgs = nullptr;
     DWORD compileFlags = D3D10_SHADER_WARNINGS_ARE_ERRORS | D3D10_SHADER_ENABLE_STRICTNESS;
@@ -28,7 +30,7 @@ HRESULT ShaderCompiler::CompileShaderFromFile(
 
     const HRESULT hr = D3DX11CompileFromFileA(
         filename,                   // pSrcFile:      the name of the .hlsl/.fx file that contains the effect souce code we want to compile
-        nullptr,                    // pDefines:      advanced option we do not use; see the SDK documentation;
+        defines,                    // pDefines:      a null-terminated arr of macros (can be nullptr)
         nullptr,                    // pInclude:      advanced option we do not use; see the SDK documentation;
         functionName,               // pFunctionName: the shader function name entry point. This is only used when compiling shader programs individually. When using the effects framework, specify null, as the technique passes defined inside the effect file specify the shader entry points.
         shaderProfile,              // pProfile:      a string specifying the shader version we are using. For Direct3D 11 effects, we use shader version 5.0 ("fx_5_0")
@@ -39,6 +41,13 @@ HRESULT ShaderCompiler::CompileShaderFromFile(
         &pErrorMsgs,                // ppErrorMsgs:   returns a pointer to a ID3D11Blob data structure that stores a string containing the compilation errors, if any.
         nullptr);                   // pHResult:      used to obtain the returned error code if compiling asynchronously. Specify null if you specified null for pPump
 
+    // the caller handles errors by itself
+    if (ppErrorMsgs)
+    {
+        *ppErrorMsgs = pErrorMsgs;
+        return hr;
+    }
+
     // If the shader failed to compile it should write something about the error
     if (pErrorMsgs != nullptr)
     {
@@ -15,11 +15,16 @@ namespace Render
 class ShaderCompiler
 {
 public:
+    // defines:     a null-terminated arr of macros (is used for shader permutations)
+    // ppErrorMsgs: if not null, compilation errors are returned here instead of
+    //              being logged (so it can be called from jobs since the logger isn't thread-safe)
     static HRESULT CompileShaderFromFile(
         const char* filename, 
         LPCSTR functionName,
         LPCSTR shaderProfile,
-        ID3D10Blob** shaderOutput);
+        ID3D10Blob** shaderOutput,
+        const D3D_SHADER_MACRO* defines = nullptr,
+        ID3D10Blob** ppErrorMsgs = nullptr);
 };
 
 }
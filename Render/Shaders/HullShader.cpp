@@ -0,0 +1,71 @@
+// =================================================================================
+// Filename: HullShader.cpp
+// Created:  14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "HullShader.h"
+#include "Helpers/CSOLoader.h"
+
+
+namespace Render
+{
+
+HullShader::~HullShader()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool HullShader::Initialize(ID3D11Device* pDevice, const char* shaderPath)
+{
+    // THIS FUNC loads a CSO shader by shaderPath
+    // and then creates a hull shader object
+
+    if ((shaderPath == nullptr) || (shaderPath[0] == '\0'))
+    {
+        LogErr("input path to hull shader file is empty!");
+        return false;
+    }
+
+    // load in shader bytecode
+    const size_t len = LoadCSO(shaderPath, pShaderBuffer_);
+    if (!len)
+    {
+        sprintf(g_String, "Failed to load .CSO-file of hull shader: %s", shaderPath);
+        LogErr(g_String);
+        Shutdown();
+        return false;
+    }
+
+    // --------------------------------------------
+
+    const HRESULT hr = pDevice->CreateHullShader(
+        pShaderBuffer_,
+        len,
+        nullptr,
+        &pShader_);
+
+    if (FAILED(hr))
+    {
+        sprintf(g_String, "Failed to create a hull shader obj: %s", shaderPath);
+        LogErr(g_String);
+        Shutdown();
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void HullShader::Shutdown()
+{
+    // Shutting down of the class object, releasing of the memory, etc.
+
+    LogDbg("Shutdown");
+    SafeDeleteArr(pShaderBuffer_);
+    SafeRelease(&pShader_);
+}
+
+}; // namespace Render
@@ -0,0 +1,32 @@
+// =================================================================================
+// Filename:     HullShader.h
+// Description:  this is a class for handling all the hull shader stuff
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <cstdint>
+#include <d3d11.h>
+
+namespace Render 
+{
+
+class HullShader
+{
+public:
+    ~HullShader();
+
+    bool Initialize(ID3D11Device* pDevice, const char* shaderPath);
+    
+    void Shutdown();
+
+    // public query API
+    inline ID3D11HullShader* GetShader() { return pShader_; };
+
+private:
+    ID3D11HullShader* pShader_ = nullptr;
+    uint8*            pShaderBuffer_ = nullptr;
+};
+
+};  // namespace Render
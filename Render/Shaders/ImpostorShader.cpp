@@ -0,0 +1,194 @@
+// =================================================================================
+// Filename:     ImpostorShader.cpp
+// Description:  implementation of the ImpostorShader's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "ImpostorShader.h"
+
+namespace Render
+{
+
+ImpostorShader::ImpostorShader()
+{
+    strcpy(className_, __func__);
+}
+
+ImpostorShader::~ImpostorShader()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool ImpostorShader::Initialize(
+    ID3D11Device* pDevice,
+    const char* vsFilePath,
+    const char* gsFilePath,
+    const char* psFilePath)
+{
+    try
+    {
+        InitializeShaders(pDevice, vsFilePath, gsFilePath, psFilePath);
+        LogDbg("is initialized");
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        Shutdown();
+        LogErr(e, true);
+        LogErr("can't initialize the impostor shader class");
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void ImpostorShader::Shutdown()
+{
+    SafeRelease(&pInstancedBuffer_);
+    pCurrVB_ = nullptr;
+}
+
+///////////////////////////////////////////////////////////
+
+void ImpostorShader::UpdateInstancedBuffer(
+    ID3D11DeviceContext* pContext,
+    const ConstBufType::InstancedDataImpostor* impostors,
+    const int numImpostors)
+{
+    try
+    {
+        CAssert::True(impostors != nullptr, "input ptr to impostors arr == nullptr");
+        CAssert::True(pInstancedBuffer_,    "ptr to instanced buffer == nullptr (you have to initialize it!)");
+
+        if ((numImpostors <= 0) || (numImpostors > numMaxImpostors_))
+        {
+            sprintf(g_String, "input number of impostors must be in the range (0, %d]", numMaxImpostors_);
+            throw EngineException(g_String);
+        }
+
+        const size_t numBytes = sizeof(ConstBufType::InstancedDataImpostor) * numImpostors;
+
+        TransientAlloc<ConstBufType::InstancedDataImpostor> alloc;
+
+        if (pTransientAlloc_)
+            alloc = pTransientAlloc_->Allocate<ConstBufType::InstancedDataImpostor>(pContext, TRANSIENT_POOL_VB, (UINT)numImpostors);
+
+        if (alloc.IsValid())
+        {
+            memcpy(alloc.ptr, impostors, numBytes);
+            pTransientAlloc_->Unmap(pContext, alloc);
+
+            pCurrVB_      = alloc.pBuffer;
+            currVBOffset_ = alloc.offset;
+            return;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mappedData;
+        HRESULT hr = pContext->Map(pInstancedBuffer_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+        CAssert::NotFailed(hr, "can't map the instanced buffer");
+
+        memcpy(mappedData.pData, impostors, numBytes);
+        pContext->Unmap(pInstancedBuffer_, 0);
+
+        pCurrVB_      = pInstancedBuffer_;
+        currVBOffset_ = 0;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't update instanced buffer for impostors rendering");
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void ImpostorShader::Render(
+    ID3D11DeviceContext* pContext,
+    SRV* pAtlasSRV,
+    const ConstBufType::cbgsImpostorAtlas& atlas,
+    const int startImpostor,
+    const int numImpostors)
+{
+    // impostors of this frame weren't uploaded
+    if (!pCurrVB_)
+        return;
+
+    // bind input layout, shaders, samplers
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetGS(pContext, gs_.GetShader());
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+
+    // each vertex is a single impostor
+    const UINT stride = sizeof(ConstBufType::InstancedDataImpostor);
+
+    pStateCache_->SetVertexBuffers(pContext, 0, 1, &pCurrVB_, &stride, &currVBOffset_);
+    pStateCache_->SetPSShaderResources(pContext, 0, 1, &pAtlasSRV);
+
+    // the atlas layout (slot 0 of GS is the per frame buffer)
+    cbgsAtlas_.data = atlas;
+    cbgsAtlas_.ApplyChanges(pContext);
+    pStateCache_->SetGSConstantBuffers(pContext, 1, 1, cbgsAtlas_.GetAddressOf());
+
+    pStateCache_->Draw(pContext, (UINT)numImpostors, (UINT)startImpostor);
+
+    // unbind the geometry shader
+    pStateCache_->SetGS(pContext, nullptr);
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+void ImpostorShader::InitializeShaders(
+    ID3D11Device* pDevice,
+    const char* vsFilePath,
+    const char* gsFilePath,
+    const char* psFilePath)
+{
+    bool result = false;
+
+    const D3D11_INPUT_ELEMENT_DESC inputLayoutDesc[] =
+    {
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,                            0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"SIZE",     0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"FORWARD",  0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    };
+
+    const UINT layoutElemNum = sizeof(inputLayoutDesc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
+
+    // initialize: VS, GS, PS, sampler state
+    result = vs_.Initialize(pDevice, vsFilePath, inputLayoutDesc, layoutElemNum);
+    CAssert::True(result, "can't initialize the vertex shader");
+
+    result = gs_.Initialize(pDevice, gsFilePath);
+    CAssert::True(result, "can't initialize the geometry shader");
+
+    result = ps_.Initialize(pDevice, psFilePath);
+    CAssert::True(result, "can't initialize the pixel shader");
+
+    result = samplerState_.Initialize(pDevice);
+    CAssert::True(result, "can't initialize the sampler state");
+
+    HRESULT hr = cbgsAtlas_.Initialize(pDevice);
+    CAssert::NotFailed(hr, "can't initialize the const buffer (for the atlas params in GS)");
+
+    // create a buffer of impostors (is used as a vertex buffer of points)
+    D3D11_BUFFER_DESC desc;
+    desc.Usage               = D3D11_USAGE_DYNAMIC;
+    desc.ByteWidth           = static_cast<UINT>(sizeof(ConstBufType::InstancedDataImpostor) * numMaxImpostors_);
+    desc.BindFlags           = D3D11_BIND_VERTEX_BUFFER;
+    desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+    desc.MiscFlags           = 0;
+    desc.StructureByteStride = 0;
+
+    hr = pDevice->CreateBuffer(&desc, nullptr, &pInstancedBuffer_);
+    CAssert::NotFailed(hr, "can't create an instanced buffer");
+}
+
+} // namespace Render
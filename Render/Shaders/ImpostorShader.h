@@ -0,0 +1,91 @@
+// =================================================================================
+// Filename:     ImpostorShader.h
+// Description:  renders impostors (the last level of detail of models): each
+//               impostor is a point which is expanded by the GS into a y-axis
+//               aligned quad textured by the nearest two views of the model's
+//               impostor atlas (they are blended by the view angle)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "VertexShader.h"
+#include "GeometryShader.h"
+#include "PixelShader.h"
+#include "SamplerState.h"
+#include "ConstantBuffer.h"
+#include "../Common/ConstBufferTypes.h"
+#include "../StateCache.h"
+#include "../TransientAllocator.h"
+
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+class ImpostorShader
+{
+    using SRV = ID3D11ShaderResourceView;
+
+public:
+    ImpostorShader();
+    ~ImpostorShader();
+
+    // restrict a copying of this class instance
+    ImpostorShader(const ImpostorShader&) = delete;
+    ImpostorShader& operator=(const ImpostorShader&) = delete;
+
+    bool Initialize(
+        ID3D11Device* pDevice,
+        const char* vsFilePath,
+        const char* gsFilePath,
+        const char* psFilePath);
+
+    void Shutdown();
+
+    // upload impostors of all the models at once (they are sorted by models
+    // so each model is rendered by a range of the buffer)
+    void UpdateInstancedBuffer(
+        ID3D11DeviceContext* pContext,
+        const ConstBufType::InstancedDataImpostor* impostors,
+        const int numImpostors);
+
+    // render a range of impostors which have the same atlas
+    void Render(
+        ID3D11DeviceContext* pContext,
+        SRV* pAtlasSRV,
+        const ConstBufType::cbgsImpostorAtlas& atlas,
+        const int startImpostor,
+        const int numImpostors);
+
+    inline const char* GetShaderName()            const { return className_; }
+    inline int         GetMaxNumImpostors()       const { return numMaxImpostors_; }
+    inline void        SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+    inline void        SetTransientAllocator(TransientAllocator* pAlloc) { pTransientAlloc_ = pAlloc; }
+
+private:
+    void InitializeShaders(
+        ID3D11Device* pDevice,
+        const char* vsFilePath,
+        const char* gsFilePath,
+        const char* psFilePath);
+
+private:
+    VertexShader        vs_;
+    GeometryShader      gs_;
+    PixelShader         ps_;
+    SamplerState        samplerState_;
+
+    ConstantBuffer<ConstBufType::cbgsImpostorAtlas> cbgsAtlas_;
+    ID3D11Buffer*       pInstancedBuffer_ = nullptr;        // impostors as a point list (if the transient allocator can't be used)
+    ID3D11Buffer*       pCurrVB_          = nullptr;        // where are impostors of this frame
+    UINT                currVBOffset_     = 0;              // in bytes
+    TransientAllocator* pTransientAlloc_  = nullptr;        // is owned by CRender
+
+    StateCache* pStateCache_ = nullptr;                     // filters redundant binds (is owned by CRender)
+    char className_[32]{ "ImpostorShader" };
+    const int numMaxImpostors_ = 16384;                     // limit of impostors per frame
+};
+
+} // namespace Render
@@ -23,14 +23,42 @@ LightShader::~LightShader()
 
 ///////////////////////////////////////////////////////////
 
+uint32 LightShader::MakePermutationKey(
+    const bool fog,
+    const bool alphaClip,
+    const int numDirLights)
+{
+    const uint32 numLights = (uint32)((numDirLights < 0) ? 0 : (numDirLights > 3) ? 3 : numDirLights);
+
+    return ((fog)       ? PERM_FOG        : 0) |
+           ((alphaClip) ? PERM_ALPHA_CLIP : 0) |
+           (numLights << PERM_DIR_LIGHTS_SHIFT);
+}
+
+///////////////////////////////////////////////////////////
+
 bool LightShader::Initialize(
     ID3D11Device* pDevice,
     const char* vsFilePath,
-    const char* psFilePath)
+    const char* psFilePath,
+    const char* psSrcFilePath)
 {
     try
     {
         InitializeShaders(pDevice, vsFilePath, psFilePath);
+
+        // (the names must be the same as in LightPS.hlsl)
+        const PermutationDefine defines[] =
+        {
+            { "FOG",            0,                     1 },
+            { "ALPHA_CLIP",     1,                     1 },
+            { "NORMAL_MAP",     2,                     1 },
+            { "NUM_DIR_LIGHTS", PERM_DIR_LIGHTS_SHIFT, 2 },
+        };
+
+        if (!psPermutations_.Initialize(pDevice, psSrcFilePath, "LightPS", defines, (int)std::size(defines)))
+            LogErr("can't prepare permutations of the light pixel shader so the default one is used");
+
         LogDbg("is initialized");
         return true;
     }
@@ -49,17 +77,18 @@ void LightShader::Render(
     ID3D11Buffer* pInstancedBuffer,
     const Instance* instances,
     const int numUniqueGeometry,       // aka the number of unique models
-    const UINT instancesBuffElemSize)
+    const UINT instancesBuffElemSize,
+    const UINT baseInstance)
 {
     // bind input layout, shaders, samplers
-    pContext->IASetInputLayout(vs_.GetInputLayout());
-    pContext->VSSetShader(vs_.GetShader(), nullptr, 0);
-    pContext->PSSetShader(ps_.GetShader(), nullptr, 0);
-    pContext->PSSetSamplers(0, 1, samplerState_.GetAddressOf());
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
 
 
     // go through each instance and render it
-    for (int i = 0, startInstanceLocation = 0; i < numUniqueGeometry; ++i)
+    for (int i = 0, startInstanceLocation = (int)baseInstance; i < numUniqueGeometry; ++i)
     {
         const Instance& instance = instances[i];
 
@@ -68,8 +97,8 @@ void LightShader::Render(
         const UINT stride[2] = { instance.vertexStride, instancesBuffElemSize };
         const UINT offset[2] = { 0,0 };
 
-        pContext->IASetVertexBuffers(0, 2, vbs, stride, offset);
-        pContext->IASetIndexBuffer(instance.pIB, DXGI_FORMAT_R32_UINT, 0);
+        pStateCache_->SetVertexBuffers(pContext, 0, 2, vbs, stride, offset);
+        pStateCache_->SetIndexBuffer(pContext, instance.pIB, instance.indexFormat, 0);
 
         // textures arr
         ID3D11ShaderResourceView* const* texSRVs = instance.texSRVs.data();
@@ -79,14 +108,16 @@ void LightShader::Render(
         for (int subsetIdx = 0; subsetIdx < numSubsets; ++subsetIdx)
         {
             // update textures for the current subset
-            pContext->PSSetShaderResources(
+            pStateCache_->SetPSShaderResources(
+                pContext,
                 1U,
                 NUM_TEXTURE_TYPES,
                 texSRVs + (subsetIdx * NUM_TEXTURE_TYPES));  // texture_buffer_begin + offset
 
             const Subset& subset = instance.subsets[subsetIdx];
 
-            pContext->DrawIndexedInstanced(
+            pStateCache_->DrawIndexedInstanced(
+                pContext,
                 subset.indexCount,
                 instance.numInstances,
                 subset.indexStart,
@@ -98,6 +129,146 @@ void LightShader::Render(
     }
 }
 
+///////////////////////////////////////////////////////////
+
+void LightShader::RenderSorted(
+    ID3D11DeviceContext* pContext,
+    ID3D11Buffer* pInstancedBuffer,
+    const Instance* instances,
+    const DrawCmd* draws,
+    const int numDraws,
+    const UINT instancesBuffElemSize,
+    const uint32 permutationKey,
+    ID3D11PixelShader* pOverridePS)
+{
+    // bind input layout, shaders, samplers (a pixel shader is chosen per draw)
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
+
+    const Instance*           prevInstance = nullptr;
+    ID3D11ShaderResourceView* boundSRVs[NUM_TEXTURE_TYPES];
+    bool                      isTexBound   = false;
+
+    if (pOverridePS)
+        pStateCache_->SetPS(pContext, pOverridePS);
+
+    for (int i = 0; i < numDraws; ++i)
+    {
+        const DrawCmd&  draw     = draws[i];
+        const Instance& instance = instances[draw.instanceIdx];
+
+        // bind vertex/index buffers if they are changed
+        if (!prevInstance || (prevInstance->pVB != instance.pVB) || (prevInstance->pIB != instance.pIB))
+        {
+            ID3D11Buffer* const vbs[2] = { instance.pVB, pInstancedBuffer };
+            const UINT stride[2] = { instance.vertexStride, instancesBuffElemSize };
+            const UINT offset[2] = { 0,0 };
+
+            pStateCache_->SetVertexBuffers(pContext, 0, 2, vbs, stride, offset);
+            pStateCache_->SetIndexBuffer(pContext, instance.pIB, instance.indexFormat, 0);
+        }
+        prevInstance = &instance;
+
+        // (redundant binds are filtered by the cache)
+        if (!pOverridePS)
+            pStateCache_->SetPS(pContext, GetPS(instance, draw.subsetIdx, permutationKey));
+
+        // update textures if they are changed; maps which are sampled from
+        // the packed arrays keep the prev binding so they don't cause binds
+        ID3D11ShaderResourceView* texSRVs[NUM_TEXTURE_TYPES];
+        memcpy(texSRVs, instance.texSRVs.data() + (draw.subsetIdx * NUM_TEXTURE_TYPES), sizeof(texSRVs));
+
+        const uint8 packed = (instance.packedTexs.empty()) ? 0 : instance.packedTexs[draw.subsetIdx];
+
+        if (isTexBound && (packed & PACKED_TEX_DIFFUSE))
+            texSRVs[PACKED_DIFFUSE_TEX_IDX] = boundSRVs[PACKED_DIFFUSE_TEX_IDX];
+
+        if (isTexBound && (packed & PACKED_TEX_NORMAL))
+            texSRVs[PACKED_NORMAL_TEX_IDX] = boundSRVs[PACKED_NORMAL_TEX_IDX];
+
+        if (!isTexBound || memcmp(boundSRVs, texSRVs, sizeof(texSRVs)) != 0)
+        {
+            pStateCache_->SetPSShaderResources(pContext, 1U, NUM_TEXTURE_TYPES, texSRVs);
+            memcpy(boundSRVs, texSRVs, sizeof(texSRVs));
+            isTexBound = true;
+        }
+
+        const Subset& subset = instance.subsets[draw.subsetIdx];
+
+        pStateCache_->DrawIndexedInstanced(
+            pContext,
+            subset.indexCount,
+            instance.numInstances,
+            subset.indexStart,
+            subset.vertexStart,
+            draw.startInstance);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void LightShader::RenderIndirect(
+    ID3D11DeviceContext* pContext,
+    ID3D11Buffer* pVisibleInstancesBuffer,
+    ID3D11Buffer* pArgsBuffer,
+    const Instance* instances,
+    const GpuDraw* draws,
+    const int numDraws,
+    const UINT instancesBuffElemSize,
+    const uint32 permutationKey)
+{
+    // bind input layout, shaders, samplers (a pixel shader is chosen per draw)
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
+
+    const Instance*           prevInstance = nullptr;
+    ID3D11ShaderResourceView* boundSRVs[NUM_TEXTURE_TYPES];
+    bool                      isTexBound   = false;
+
+    // draws of the same (instance, subset) go one by one (by LODs)
+    // so buffers and textures are bound only once for all of them
+    for (int i = 0; i < numDraws; ++i)
+    {
+        const GpuDraw&  draw     = draws[i];
+        const Instance& instance = instances[draw.instanceIdx];
+
+        if (!prevInstance || (prevInstance->pVB != instance.pVB) || (prevInstance->pIB != instance.pIB))
+        {
+            ID3D11Buffer* const vbs[2] = { instance.pVB, pVisibleInstancesBuffer };
+            const UINT stride[2] = { instance.vertexStride, instancesBuffElemSize };
+            const UINT offset[2] = { 0,0 };
+
+            pStateCache_->SetVertexBuffers(pContext, 0, 2, vbs, stride, offset);
+            pStateCache_->SetIndexBuffer(pContext, instance.pIB, instance.indexFormat, 0);
+        }
+        prevInstance = &instance;
+
+        pStateCache_->SetPS(pContext, GetPS(instance, draw.subsetIdx, permutationKey));
+
+        ID3D11ShaderResourceView* texSRVs[NUM_TEXTURE_TYPES];
+        memcpy(texSRVs, instance.texSRVs.data() + (draw.subsetIdx * NUM_TEXTURE_TYPES), sizeof(texSRVs));
+
+        const uint8 packed = (instance.packedTexs.empty()) ? 0 : instance.packedTexs[draw.subsetIdx];
+
+        if (isTexBound && (packed & PACKED_TEX_DIFFUSE))
+            texSRVs[PACKED_DIFFUSE_TEX_IDX] = boundSRVs[PACKED_DIFFUSE_TEX_IDX];
+
+        if (isTexBound && (packed & PACKED_TEX_NORMAL))
+            texSRVs[PACKED_NORMAL_TEX_IDX] = boundSRVs[PACKED_NORMAL_TEX_IDX];
+
+        if (!isTexBound || memcmp(boundSRVs, texSRVs, sizeof(texSRVs)) != 0)
+        {
+            pStateCache_->SetPSShaderResources(pContext, 1U, NUM_TEXTURE_TYPES, texSRVs);
+            memcpy(boundSRVs, texSRVs, sizeof(texSRVs));
+            isTexBound = true;
+        }
+
+        pStateCache_->DrawIndexedInstancedIndirect(pContext, pArgsBuffer, (UINT)i * GpuCulling::ARGS_STRIDE);
+    }
+}
+
 
 // =================================================================================
 //                              private methods                                       
@@ -125,6 +296,23 @@ void LightShader::InitializeShaders(
 
 ///////////////////////////////////////////////////////////
 
+ID3D11PixelShader* LightShader::GetPS(
+    const Instance& instance,
+    const int subsetIdx,
+    const uint32 permutationKey)
+{
+    if (!psPermutations_.IsInitialized())
+        return ps_.GetShader();
+
+    // no features per subset: use all of them
+    const uint8 features = (instance.features.empty()) ? 0xFF : instance.features[subsetIdx];
+    const uint32 key     = permutationKey | ((features & SUBSET_NORMAL_MAP) ? PERM_NORMAL_MAP : 0);
+
+    return psPermutations_.GetShader(key);
+}
+
+///////////////////////////////////////////////////////////
+
 void LightShader::ShaderHotReload(
     ID3D11Device* pDevice,
     const char* vsFilePath,
@@ -145,6 +333,10 @@ void LightShader::ShaderHotReload(
 
     result = ps_.CompileShaderFromFile(pDevice, psFilePath, "PS", "ps_5_0");
     CAssert::True(result, "can't hot reload the vertex shader");
+
+    // (the old variants are kept if any of them can't be compiled)
+    if (psPermutations_.IsInitialized())
+        psPermutations_.Recompile(pDevice);
 }
 
 } // namespace Render
@@ -9,8 +9,12 @@
 #include "VertexShader.h"
 #include "PixelShader.h"
 #include "SamplerState.h"        // for using the ID3D11SamplerState 
+#include "PixelShaderPermutations.h"
 
 #include "../Common/RenderTypes.h"
+#include "../DrawSorter.h"
+#include "../GpuCulling.h"
+#include "../StateCache.h"
 #include <d3d11.h>
 
 
@@ -20,6 +24,15 @@ namespace Render
 class LightShader
 {
 public:
+	// bits of the pixel shader permutation key (see PERMUTATIONS in LightPS.hlsl)
+	static constexpr uint32 PERM_FOG              = (1 << 0);
+	static constexpr uint32 PERM_ALPHA_CLIP       = (1 << 1);
+	static constexpr uint32 PERM_NORMAL_MAP       = (1 << 2);    // is set per draw by subset features
+	static constexpr uint32 PERM_DIR_LIGHTS_SHIFT = 3;           // 2 bits: the number of dir lights [0, 3]
+
+	// make the per pass part of the key (the normal map bit is added per draw)
+	static uint32 MakePermutationKey(const bool fog, const bool alphaClip, const int numDirLights);
+
 	LightShader();
 	~LightShader();
 
@@ -29,17 +42,47 @@ public:
 
 	// ----------------------------------------------------
 
+    // psSrcFilePath: a source of the pixel shader permutations
+    // (if they can't be prepared the default .cso is used for each draw)
     bool Initialize(
         ID3D11Device* pDevice,
         const char* vsFilePath,
-        const char* psFilePath);
+        const char* psFilePath,
+        const char* psSrcFilePath);
 
 	void Render(
 		ID3D11DeviceContext* pContext,
 		ID3D11Buffer* pInstancedBuffer,
 		const Instance* instances,
 		const int numUniqueGeometry,
-		const UINT instancesBuffElemSize);
+		const UINT instancesBuffElemSize,
+		const UINT baseInstance);
+
+	// render draws in the input (sorted) order; buffers and textures are
+	// bound only when they differ from the prev draw;
+	// pOverridePS: if set it is used for all the draws instead of variants
+	// of the light PS (e.g. the G-buffer PS of the deferred shading)
+	void RenderSorted(
+		ID3D11DeviceContext* pContext,
+		ID3D11Buffer* pInstancedBuffer,
+		const Instance* instances,
+		const DrawCmd* draws,
+		const int numDraws,
+		const UINT instancesBuffElemSize,
+		const uint32 permutationKey,
+		ID3D11PixelShader* pOverridePS = nullptr);
+
+	// render draws of the GPU culling: instance counts are taken from the args
+	// buffer and instances data from the compacted visible instances buffer
+	void RenderIndirect(
+		ID3D11DeviceContext* pContext,
+		ID3D11Buffer* pVisibleInstancesBuffer,
+		ID3D11Buffer* pArgsBuffer,
+		const Instance* instances,
+		const GpuDraw* draws,
+		const int numDraws,
+		const UINT instancesBuffElemSize,
+		const uint32 permutationKey);
 
     void ShaderHotReload(
         ID3D11Device* pDevice,
@@ -47,6 +90,13 @@ public:
         const char* psFilePath);
 
 	inline const char* GetShaderName() const { return className_; }
+	inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+	// shaders objects (for hot reload)
+	inline VertexShader&            GetVS()             { return vs_; }
+	inline PixelShader&             GetPS()             { return ps_; }
+	inline PixelShaderPermutations& GetPSPermutations() { return psPermutations_; }
+	inline SamplerState&            GetSamplerState()   { return samplerState_; }
 
 private:
 	void InitializeShaders(
@@ -54,11 +104,16 @@ private:
 		const char* vsFilePath,
 		const char* psFilePath);
 
+	// get a pixel shader variant for the subset of the instance
+	ID3D11PixelShader* GetPS(const Instance& instance, const int subsetIdx, const uint32 permutationKey);
+
 private:
-	VertexShader vs_;
-	PixelShader  ps_;
-	SamplerState samplerState_;          // a sampler for texturing
+	VertexShader            vs_;
+	PixelShader             ps_;                 // the default (uber) variant
+	PixelShaderPermutations psPermutations_;     // specialized variants by keys
+	SamplerState            samplerState_;       // a sampler for texturing
 
+	StateCache* pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
 	char className_[32]{"LightShader"};
 };
 
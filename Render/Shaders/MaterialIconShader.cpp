@@ -68,6 +68,7 @@ void MaterialIconShader::PrepareRendering(
     ID3D11DeviceContext* pContext,
     ID3D11Buffer* vertexBuffer,
     ID3D11Buffer* indexBuffer,
+    const DXGI_FORMAT indexFormat,
     const int vertexSize)
 {
     // bind buffers/shaders/input layout
@@ -78,25 +79,25 @@ void MaterialIconShader::PrepareRendering(
         CAssert::True(vertexSize > 0, "input size of vertex must be > 0");
 
         // bind vertex and pixel shaders
-        pContext->VSSetShader(vs_.GetShader(), nullptr, 0U);
-        pContext->PSSetShader(ps_.GetShader(), nullptr, 0U);
+        pStateCache_->SetVS(pContext, vs_.GetShader());
+        pStateCache_->SetPS(pContext, ps_.GetShader());
 
         // set the primitive topology and input layout
-        pContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        pContext->IASetInputLayout(vs_.GetInputLayout());
+        pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
 
         // set the sampler state and textures
-        pContext->PSSetSamplers(0, 1, samplerState_.GetAddressOf());
+        pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
 
         const UINT stride = vertexSize;
         const UINT offset = 0;
 
         // bind vb/ib
-        pContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-        pContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0U);
+        pStateCache_->SetVertexBuffers(pContext, 0, 1, &vertexBuffer, &stride, &offset);
+        pStateCache_->SetIndexBuffer(pContext, indexBuffer, indexFormat, 0U);
 
         // bind the constant buffer for vertex shader
-        pContext->VSSetConstantBuffers(10, 1, cbvsWorldViewProj_.GetAddressOf());
+        pStateCache_->SetVSConstantBuffers(pContext, 10, 1, cbvsWorldViewProj_.GetAddressOf());
     }
     catch (EngineException& e)
     {
@@ -111,6 +112,8 @@ void MaterialIconShader::PrepareRendering(
 void MaterialIconShader::Render(
     ID3D11DeviceContext* pContext,
     const int indexCount,
+    const UINT startIndex,
+    const int baseVertex,
     ID3D11ShaderResourceView* const* ppTextures,
     const Render::Material& mat)
 {
@@ -121,18 +124,36 @@ void MaterialIconShader::Render(
         CAssert::True(ppTextures,     "input ptr to arr of textures == nullptr");
 
         // setup textures
-        pContext->PSSetShaderResources(0, NUM_TEXTURE_TYPES, ppTextures);
+        pStateCache_->SetPSShaderResources(pContext, 0, NUM_TEXTURE_TYPES, ppTextures);
 
         // setup the material
         cbpsMaterialData_.data.ambient  = mat.ambient_;
         cbpsMaterialData_.data.diffuse  = mat.diffuse_;
         cbpsMaterialData_.data.specular = mat.specular_;
         cbpsMaterialData_.data.reflect  = mat.reflect_;
-        cbpsMaterialData_.ApplyChanges(pContext);
-        pContext->PSSetConstantBuffers(5, 1, cbpsMaterialData_.GetAddressOf());
+
+        // per-draw constants go into the ring and are bound by offsets
+        // (or are loaded into own buffers of the shader if there is no ring)
+        ConstBufferRing::Range vsRange;
+        ConstBufferRing::Range psRange;
+
+        if (pCBRing_ &&
+            pCBRing_->Push(pContext, &cbvsWorldViewProj_.data, sizeof(cbvsWorldViewProj_.data), vsRange) &&
+            pCBRing_->Push(pContext, &cbpsMaterialData_.data,  sizeof(cbpsMaterialData_.data),  psRange))
+        {
+            pCBRing_->BindVS(*pStateCache_, 10, vsRange);
+            pCBRing_->BindPS(*pStateCache_, 5, psRange);
+        }
+        else
+        {
+            cbvsWorldViewProj_.ApplyChangesIfDirty(pContext);
+            cbpsMaterialData_.ApplyChanges(pContext);
+            pStateCache_->SetVSConstantBuffers(pContext, 10, 1, cbvsWorldViewProj_.GetAddressOf());
+            pStateCache_->SetPSConstantBuffers(pContext, 5, 1, cbpsMaterialData_.GetAddressOf());
+        }
 
         // render geometry
-        pContext->DrawIndexed(indexCount, 0U, 0U);
+        pStateCache_->DrawIndexed(pContext, indexCount, startIndex, baseVertex);
     }
     catch (EngineException& e)
     {
@@ -152,7 +173,9 @@ void MaterialIconShader::SetMatrix(
 {
     cbvsWorldViewProj_.data.world = world;
     cbvsWorldViewProj_.data.viewProj = DirectX::XMMatrixTranspose(view * proj);
-    cbvsWorldViewProj_.ApplyChanges(pContext);
+
+    // is loaded by the next Render() (a matrix per draw)
+    cbvsWorldViewProj_.MarkDirty();
 }
 
 // =================================================================================
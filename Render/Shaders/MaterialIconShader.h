@@ -14,6 +14,8 @@
 
 #include "../Common/ConstBufferTypes.h"
 #include "../Common/RenderTypes.h"
+#include "../StateCache.h"
+#include "../ConstBufferRing.h"
 
 #include <d3d11.h>
 
@@ -47,11 +49,14 @@ public:
         ID3D11DeviceContext* pContext,
         ID3D11Buffer* vertexBuffer,
         ID3D11Buffer* indexBuffer,
+        const DXGI_FORMAT indexFormat,
         const int vertexSize);
 
     void Render(
         ID3D11DeviceContext* pContext,
         const int indexCount,
+        const UINT startIndex,
+        const int baseVertex,
         ID3D11ShaderResourceView* const* ppTextures,
         const Render::Material& mat);
 
@@ -62,6 +67,12 @@ public:
         const DirectX::XMMATRIX& proj);
 
     inline const char* GetShaderName() const { return className_; }
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+    inline void SetConstBufferRing(ConstBufferRing* pRing) { pCBRing_ = pRing; }
+
+    // shaders objects (for hot reload)
+    inline VertexShader& GetVS() { return vs_; }
+    inline PixelShader&  GetPS() { return ps_; }
 
 private:
     void InitializeHelper(
@@ -76,6 +87,8 @@ private:
     ConstantBuffer<ConstBufType::WorldViewProj> cbvsWorldViewProj_; // cbvs -- const buffer for vertex shader
     ConstantBuffer<ConstBufType::MaterialData>  cbpsMaterialData_;  // cbps -- const buffer for pixel shader
 
+    StateCache*      pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
+    ConstBufferRing* pCBRing_     = nullptr;    // per-draw constants (is owned by CRender; nullptr without D3D11.1)
     char className_[32]{ "MaterialIconShader" };
 };
 
@@ -49,15 +49,16 @@ void OutlineShader::Render(
 	ID3D11Buffer* pInstancedBuffer,
 	const Instance* instances,
 	const int numInstances,
-	const UINT instancesBuffElemSize)
+	const UINT instancesBuffElemSize,
+	const UINT baseInstance)
 {
 	// bind input layout and shaders
-	pContext->IASetInputLayout(vs_.GetInputLayout());
-	pContext->VSSetShader(vs_.GetShader(), nullptr, 0);
-	pContext->PSSetShader(ps_.GetShader(), nullptr, 0);
+	pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+	pStateCache_->SetVS(pContext, vs_.GetShader());
+	pStateCache_->SetPS(pContext, ps_.GetShader());
 
 	// go through each instance and render it
-	for (int i = 0, startInstanceLocation = 0; i < numInstances; ++i)
+	for (int i = 0, startInstanceLocation = (int)baseInstance; i < numInstances; ++i)
 	{
 		const Instance& instance = instances[i];
 
@@ -66,15 +67,16 @@ void OutlineShader::Render(
 		const UINT stride[2] = { instance.vertexStride, instancesBuffElemSize };
 		const UINT offset[2] = { 0,0 };
 
-		pContext->IASetVertexBuffers(0, 2, vbs, stride, offset);
-		pContext->IASetIndexBuffer(instance.pIB, DXGI_FORMAT_R32_UINT, 0);
+		pStateCache_->SetVertexBuffers(pContext, 0, 2, vbs, stride, offset);
+		pStateCache_->SetIndexBuffer(pContext, instance.pIB, instance.indexFormat, 0);
 
 		// go through each subset (mesh) of this model and render it
 		for (int subsetIdx = 0; subsetIdx < (int)std::ssize(instance.subsets); ++subsetIdx)
 		{
 			const Subset& subset = instance.subsets[subsetIdx];
 
-			pContext->DrawIndexedInstanced(
+			pStateCache_->DrawIndexedInstanced(
+				pContext,
 				subset.indexCount,
 				instance.numInstances,
 				subset.indexStart,
@@ -104,18 +106,12 @@ void OutlineShader::InitializeShaders(
 	{
 		// per vertex data
 		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{"NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"NORMAL",   0, DXGI_FORMAT_R10G10B10A2_UNORM, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0},   // after the packed texture coords
 
 		// per instance data
 		{"WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,  D3D11_INPUT_PER_INSTANCE_DATA, 1},
 		{"WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
 		{"WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-		{"WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-
-		{"WORLD_INV_TRANSPOSE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-		{"WORLD_INV_TRANSPOSE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-		{"WORLD_INV_TRANSPOSE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-		{"WORLD_INV_TRANSPOSE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 112, D3D11_INPUT_PER_INSTANCE_DATA, 1},
 	};
 
     const UINT layoutElemNum = sizeof(inputLayoutDesc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
@@ -9,6 +9,7 @@
 #include "VertexShader.h"
 #include "PixelShader.h"
 #include "../Common/RenderTypes.h"
+#include "../StateCache.h"
 
 
 namespace Render
@@ -36,9 +37,11 @@ public:
 		ID3D11Buffer* pInstancedBuffer,
 		const Instance* instances,
 		const int numInstances,
-		const UINT instancesBuffElemSize);
+		const UINT instancesBuffElemSize,
+		const UINT baseInstance);
 
 	inline const char* GetShaderName() const { return className_; }
+	inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
 
 private:
     void InitializeShaders(
@@ -49,6 +52,7 @@ private:
 private:
 	VertexShader vs_;
 	PixelShader  ps_;
+	StateCache* pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
 	char className_[32]{"OutlineShader"};
 };
 
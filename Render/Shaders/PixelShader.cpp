@@ -128,4 +128,12 @@ void PixelShader::Shutdown()
     SafeRelease(&pShader_);
 }
 
+///////////////////////////////////////////////////////////
+
+void PixelShader::Swap(ID3D11PixelShader* pShader)
+{
+    SafeRelease(&pShader_);
+    pShader_ = pShader;
+}
+
 } // namespace 
@@ -30,6 +30,10 @@ public:
 
     void Shutdown();
 
+    // replace the current shader with the input one (takes ownership);
+    // is used for background hot reload
+    void Swap(ID3D11PixelShader* pShader);
+
     inline ID3D11PixelShader* GetShader() { return pShader_; };
 
 private:
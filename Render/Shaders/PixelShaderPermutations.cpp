@@ -0,0 +1,280 @@
+////////////////////////////////////////////////////////////////////
+// Filename: PixelShaderPermutations.cpp
+// Created:  14.10.26
+////////////////////////////////////////////////////////////////////
+#include "../Common/pch.h"
+#include "PixelShaderPermutations.h"
+
+#include "Helpers/CSOLoader.h"
+#include "Helpers/ShaderCompiler.h"
+#include "Helpers/ShaderCache.h"
+#include <JobSystem.h>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+
+namespace Render
+{
+
+///////////////////////////////////////////////////////////
+
+PixelShaderPermutations::~PixelShaderPermutations()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool PixelShaderPermutations::Initialize(
+    ID3D11Device* pDevice,
+    const char* srcPath,
+    const char* cacheName,
+    const PermutationDefine* defines,
+    const int numDefines)
+{
+    if (StrHelper::IsEmpty(srcPath) || StrHelper::IsEmpty(cacheName))
+    {
+        LogErr("input path to the shader source or name of its cache is empty!");
+        return false;
+    }
+
+    if (!defines || (numDefines <= 0) || (numDefines > MAX_NUM_DEFINES))
+    {
+        LogErr("wrong input defines of shader permutations");
+        return false;
+    }
+
+    Shutdown();
+
+    strncpy(srcPath_,   srcPath,   sizeof(srcPath_) - 1);
+    strncpy(cacheName_, cacheName, sizeof(cacheName_) - 1);
+
+    // the number of keys is defined by the highest bit of all the defines
+    uint32 numKeyBits = 0;
+
+    for (int i = 0; i < numDefines; ++i)
+    {
+        defines_[i] = defines[i];
+
+        const uint32 lastBit = defines[i].shift + defines[i].numBits;
+        numKeyBits = (lastBit > numKeyBits) ? lastBit : numKeyBits;
+    }
+    numDefines_ = numDefines;
+
+    const uint32 numKeys = (1U << numKeyBits);
+    shaders_.resize(numKeys, nullptr);
+
+    if (!PrepareVariants(pDevice, shaders_))
+    {
+        Shutdown();
+        return false;
+    }
+
+    LogMsgf("%u permutations of the shader are ready: %s", numKeys, srcPath);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void PixelShaderPermutations::Shutdown()
+{
+    for (ID3D11PixelShader*& pShader : shaders_)
+        SafeRelease(&pShader);
+
+    shaders_.clear();
+}
+
+///////////////////////////////////////////////////////////
+
+bool PixelShaderPermutations::Recompile(ID3D11Device* pDevice)
+{
+    // only variants which hashes are changed (by the source or its includes)
+    // are compiled; the old variants are replaced only if all the new ones are ready
+
+    if (!IsInitialized())
+        return false;
+
+    cvector<ID3D11PixelShader*> newShaders(shaders_.size(), nullptr);
+
+    if (!PrepareVariants(pDevice, newShaders))
+    {
+        sprintf(g_String, "can't recompile permutations of the shader: %s", srcPath_);
+        LogErr(g_String);
+        return false;
+    }
+
+    Shutdown();
+    shaders_ = std::move(newShaders);
+    return true;
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+bool PixelShaderPermutations::PrepareVariants(
+    ID3D11Device* pDevice,
+    cvector<ID3D11PixelShader*>& outShaders)
+{
+    const uint32 numKeys = (uint32)outShaders.size();
+
+    ShaderCache cache;
+    cache.LoadManifest();
+    ShaderCache::CreateCacheDir();
+
+    // shipped builds don't have sources so variants are only loaded by the manifest
+    std::error_code ec;
+    const bool hasSource = fs::exists(srcPath_, ec);
+
+    cvector<uint64> hashes(numKeys, 0);
+    cvector<uint32> missedKeys;                    // variants to compile
+    char            name[ShaderCache::VARIANT_NAME_LENGTH_LIMIT]{ '\0' };
+    char            path[128]{ '\0' };
+    bool            result = true;
+
+    for (uint32 key = 0; key < numKeys; ++key)
+    {
+        snprintf(name, sizeof(name), "%s_%02x", cacheName_, key);
+
+        if (hasSource)
+        {
+            char             values[MAX_NUM_DEFINES][12];
+            D3D_SHADER_MACRO macros[MAX_NUM_DEFINES + 1];
+
+            MakeMacros(key, values, macros);
+            hashes[key] = ShaderCache::ComputeHash(srcPath_, macros, "PS", "ps_5_0");
+        }
+        else if (!cache.GetHash(name, hashes[key]))
+        {
+            sprintf(g_String, "there is neither the shader source nor the cached variant: %s", name);
+            LogErr(g_String);
+            result = false;
+            continue;
+        }
+
+        ShaderCache::GetBytecodePath(hashes[key], path, sizeof(path));
+
+        if (fs::exists(path, ec))
+        {
+            uint8_t* buffer = nullptr;
+            const size_t len = LoadCSO(path, buffer);
+            const HRESULT hr = (len) ? pDevice->CreatePixelShader((void*)buffer, len, nullptr, &outShaders[key]) : E_FAIL;
+
+            SafeDeleteArr(buffer);
+
+            if (SUCCEEDED(hr))
+                continue;
+
+            // the cache is broken: compile it again
+        }
+
+        if (!hasSource)
+        {
+            sprintf(g_String, "can't load the cached variant and there is no source to compile it: %s", name);
+            LogErr(g_String);
+            result = false;
+            continue;
+        }
+
+        missedKeys.push_back(key);
+    }
+
+    // compile missed variants in parallel; the logger isn't thread-safe so
+    // errors are collected by jobs and logged when all of them are done
+    const index          numMissed = missedKeys.size();
+    cvector<ID3D10Blob*> errorMsgs(numMissed, nullptr);
+    cvector<HRESULT>     hrs(numMissed, S_OK);
+
+    g_JobSystem.ParallelFor(numMissed, 1, [&](const index start, const index end)
+    {
+        for (index i = start; i < end; ++i)
+        {
+            const uint32     key = missedKeys[i];
+            char             values[MAX_NUM_DEFINES][12];
+            D3D_SHADER_MACRO macros[MAX_NUM_DEFINES + 1];
+            ID3D10Blob*      pBytecode = nullptr;
+
+            MakeMacros(key, values, macros);
+
+            hrs[i] = ShaderCompiler::CompileShaderFromFile(srcPath_, "PS", "ps_5_0", &pBytecode, macros, &errorMsgs[i]);
+
+            if (SUCCEEDED(hrs[i]))
+                hrs[i] = pDevice->CreatePixelShader(pBytecode->GetBufferPointer(), pBytecode->GetBufferSize(), nullptr, &outShaders[key]);
+
+            // cache the bytecode for the next runs (if it can't be written
+            // the variant is just compiled again next time)
+            if (SUCCEEDED(hrs[i]))
+            {
+                char bytecodePath[128]{ '\0' };
+                ShaderCache::GetBytecodePath(hashes[key], bytecodePath, sizeof(bytecodePath));
+
+                if (FILE* pFile = fopen(bytecodePath, "wb"))
+                {
+                    fwrite(pBytecode->GetBufferPointer(), 1, pBytecode->GetBufferSize(), pFile);
+                    fclose(pFile);
+                }
+            }
+
+            SafeRelease(&pBytecode);
+        }
+    });
+
+    for (index i = 0; i < numMissed; ++i)
+    {
+        if (errorMsgs[i])
+        {
+            LogErr((char*)errorMsgs[i]->GetBufferPointer());
+            SafeRelease(&errorMsgs[i]);
+        }
+
+        if (FAILED(hrs[i]))
+        {
+            sprintf(g_String, "can't compile the permutation %u of the shader: %s", missedKeys[i], srcPath_);
+            LogErr(g_String);
+            result = false;
+        }
+    }
+
+    if (numMissed > 0)
+        LogMsgf("%d of %u permutations are compiled: %s", (int)numMissed, numKeys, srcPath_);
+
+    if (!result)
+    {
+        for (ID3D11PixelShader*& pShader : outShaders)
+            SafeRelease(&pShader);
+
+        return false;
+    }
+
+    // remember hashes of variants so they can be loaded without the source
+    for (uint32 key = 0; key < numKeys; ++key)
+    {
+        snprintf(name, sizeof(name), "%s_%02x", cacheName_, key);
+        cache.SetHash(name, hashes[key]);
+    }
+
+    cache.SaveManifest();
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void PixelShaderPermutations::MakeMacros(
+    const uint32 key,
+    char (*values)[12],
+    D3D_SHADER_MACRO* outMacros) const
+{
+    for (int i = 0; i < numDefines_; ++i)
+    {
+        const PermutationDefine& def = defines_[i];
+        const uint32 value = (key >> def.shift) & ((1U << def.numBits) - 1);
+
+        sprintf(values[i], "%u", value);
+        outMacros[i] = { def.name, values[i] };
+    }
+
+    outMacros[numDefines_] = { nullptr, nullptr };
+}
+
+} // namespace
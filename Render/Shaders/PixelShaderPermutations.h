@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////
+// Filename:     PixelShaderPermutations.h
+// Description:  a set of specialized variants of a single pixel shader:
+//
+//               - each variant is compiled from the same .hlsl source with
+//                 defines which are unpacked from its permutation key
+//                 (so features are chosen at compile time instead of
+//                 runtime branches on const buffer flags);
+//               - compiled variants are cached as .cso files named by a hash
+//                 of the source + includes + defines (see ShaderCache) so only
+//                 really changed variants are compiled (in parallel by jobs);
+//               - without the source (shipped builds) variants are only
+//                 loaded from the cache by its manifest;
+//               - variants are selected by the key per draw
+//
+// Created:      14.10.26
+////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+// a define which is unpacked from the permutation key: its value is
+// (key >> shift) & ((1 << numBits) - 1)
+struct PermutationDefine
+{
+    const char* name    = nullptr;
+    uint32      shift   = 0;
+    uint32      numBits = 1;
+};
+
+///////////////////////////////////////////////////////////
+
+class PixelShaderPermutations
+{
+public:
+    static constexpr int MAX_NUM_DEFINES = 8;
+
+    PixelShaderPermutations() {}
+    ~PixelShaderPermutations();
+
+    // restrict a copying of this class instance
+    PixelShaderPermutations(const PixelShaderPermutations&) = delete;
+    PixelShaderPermutations& operator=(const PixelShaderPermutations&) = delete;
+
+    // load (or compile) all the variants of the shader;
+    // cacheName: a prefix of the cached .cso files (e.g. "LightPS")
+    bool Initialize(
+        ID3D11Device* pDevice,
+        const char* srcPath,
+        const char* cacheName,
+        const PermutationDefine* defines,
+        const int numDefines);
+
+    void Shutdown();
+
+    // recompile changed variants from the source (for hot reload)
+    bool Recompile(ID3D11Device* pDevice);
+
+    inline bool               IsInitialized()             const { return !shaders_.empty(); }
+    inline ID3D11PixelShader* GetShader(const uint32 key) const { return (key < (uint32)shaders_.size()) ? shaders_[key] : nullptr; }
+
+private:
+    // load/compile all the variants into the input arr (sized by the number of keys)
+    bool PrepareVariants(ID3D11Device* pDevice, cvector<ID3D11PixelShader*>& outShaders);
+
+    // unpack values of defines from the key into the null-terminated arr of macros
+    void MakeMacros(const uint32 key, char (*values)[12], D3D_SHADER_MACRO* outMacros) const;
+
+private:
+    cvector<ID3D11PixelShader*> shaders_;                    // a variant per each key
+
+    PermutationDefine           defines_[MAX_NUM_DEFINES];
+    int                         numDefines_ = 0;
+
+    char                        srcPath_[64]{ '\0' };
+    char                        cacheName_[32]{ '\0' };
+};
+
+} // namespace
@@ -21,6 +21,9 @@
 #include "BillboardShader.h"
 #include "MaterialIconShader.h"         // is used for rendering material icon (sphere + single material) which is showing in the editor's material browser
 #include "TerrainShader.h"
+#include "ImpostorShader.h"               // for the last level of detail of models (pre-rendered views)
+#include "UpscaleShader.h"                // stretches the scene rendered with a lower resolution
+#include "DebugLineShader.h"              // for the immediate-mode debug lines (boxes, spheres, frustums)
 
 namespace Render
 {
@@ -36,6 +39,9 @@ namespace Render
 		BILLBOARD,
         MATERIAL_ICON,
         TERRAIN,
+        IMPOSTOR,
+        UPSCALE,
+        DEBUG_LINE,
 	};
 
 	struct ShadersContainer
@@ -52,5 +58,26 @@ namespace Render
         MaterialIconShader  materialIconShader_;
 
         TerrainShader       terrainShader_;
+        ImpostorShader      impostorShader_;
+        UpscaleShader       upscaleShader_;
+        DebugLineShader     debugLineShader_;
+
+        // all the shaders bind their state through the same cache
+        void SetStateCache(StateCache* pCache)
+        {
+            colorShader_.SetStateCache(pCache);
+            textureShader_.SetStateCache(pCache);
+            lightShader_.SetStateCache(pCache);
+            fontShader_.SetStateCache(pCache);
+            debugShader_.SetStateCache(pCache);
+            skyDomeShader_.SetStateCache(pCache);
+            outlineShader_.SetStateCache(pCache);
+            billboardShader_.SetStateCache(pCache);
+            materialIconShader_.SetStateCache(pCache);
+            terrainShader_.SetStateCache(pCache);
+            impostorShader_.SetStateCache(pCache);
+            upscaleShader_.SetStateCache(pCache);
+            debugLineShader_.SetStateCache(pCache);
+        }
 	};
 }
@@ -58,21 +58,21 @@ void SkyDomeShader::Render(
 	// prepare input assembler (IA) stage before the rendering process
 	UINT offset = 0;
 
-	pContext->IASetVertexBuffers(0, 1, &sky.pVB, &sky.vertexStride, &offset);
-	pContext->IASetIndexBuffer(sky.pIB, DXGI_FORMAT_R16_UINT, 0);
-	pContext->IASetInputLayout(vs_.GetInputLayout());
-	pContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	pStateCache_->SetVertexBuffers(pContext, 0, 1, &sky.pVB, &sky.vertexStride, &offset);
+	pStateCache_->SetIndexBuffer(pContext, sky.pIB, DXGI_FORMAT_R16_UINT, 0);
+	pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+	pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	// bind shaders/samplers
-	pContext->VSSetShader(vs_.GetShader(), nullptr, 0);
-	pContext->PSSetShader(ps_.GetShader(), nullptr, 0);
-	pContext->PSSetSamplers(0, 1, samplerState_.GetAddressOf());
+	pStateCache_->SetVS(pContext, vs_.GetShader());
+	pStateCache_->SetPS(pContext, ps_.GetShader());
+	pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
 
 	// update textures for the current subset
 	//pContext->PSSetShaderResources(0U, 1U, sky.texSRVs);
 
 	// render the sky
-	pContext->DrawIndexed(sky.indexCount, 0, 0);
+	pStateCache_->DrawIndexed(pContext, sky.indexCount, 0, 0);
 }
 
 ///////////////////////////////////////////////////////////
@@ -84,7 +84,7 @@ void SkyDomeShader::SetSkyGradient(
 {
 	cbpsRareChanged_.data.colorCenter_ = colorCenter;
 	cbpsRareChanged_.data.colorApex_   = colorApex;
-	cbpsRareChanged_.ApplyChanges(pContext);
+	cbpsRareChanged_.MarkDirty();
 }
 
 void SkyDomeShader::SetSkyColorCenter(ID3D11DeviceContext* pContext, const DirectX::XMFLOAT3& color)
@@ -13,6 +13,7 @@
 
 #include "../Common/ConstBufferTypes.h"
 #include "../Common/RenderTypes.h"
+#include "../StateCache.h"
 
 #include <d3d11.h>
 
@@ -53,11 +54,15 @@ public:
 	void SetSkyColorCenter(ID3D11DeviceContext* pContext, const DirectX::XMFLOAT3& color);
 	void SetSkyColorApex  (ID3D11DeviceContext* pContext, const DirectX::XMFLOAT3& color);
 
+	// the gradient is loaded into the GPU only here (see CRender::FlushConstBuffers)
+	inline void FlushConstBuffers(ID3D11DeviceContext* pContext) { cbpsRareChanged_.ApplyChangesIfDirty(pContext); }
+
 
 	//
 	// inline getters
 	//
 	inline const char* GetShaderName()                       const { return className_; }
+	inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
 	inline ID3D11Buffer* const GetConstBufferVSPerFrame()    const { return cbvsPerFrame_.Get(); }
 	inline ID3D11Buffer* const GetConstBufferPSRareChanged() const { return cbpsRareChanged_.Get(); }
 
@@ -85,6 +90,7 @@ public:
 	ConstantBuffer<ConstBufType::cbvsPerFrame_SkyDome>    cbvsPerFrame_;    // cbvs: const buffer for vertex shader
 	ConstantBuffer<ConstBufType::cbpsRareChanged_SkyDome> cbpsRareChanged_; // cbps: const buffer for pixel shader
 
+	StateCache* pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
 	char className_[32]{"SkyDomeShader"};
 };
 
@@ -58,20 +58,20 @@ void TerrainShader::Render(
     const TerrainInstance& instance)
 {
     // bind vertex and pixel shaders
-    pContext->VSSetShader(vs_.GetShader(), nullptr, 0U);
-    pContext->IASetInputLayout(vs_.GetInputLayout());
-    pContext->PSSetShader(ps_.GetShader(), nullptr, 0U);
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetPS(pContext, ps_.GetShader());
 
     // set the sampler state and textures
-    pContext->PSSetSamplers(0, 1, samplerState_.GetAddressOf());
-    pContext->PSSetShaderResources(0, NUM_TEXTURE_TYPES, instance.textures);
+    pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
+    pStateCache_->SetPSShaderResources(pContext, 0, NUM_TEXTURE_TYPES, instance.textures);
 
     // bind vb/ib
     const UINT stride = instance.vertexStride;
     const UINT offset = 0;
 
-    pContext->IASetVertexBuffers(0, 1, &instance.pVB, &stride, &offset);
-    pContext->IASetIndexBuffer(instance.pIB, DXGI_FORMAT_R32_UINT, 0U);
+    pStateCache_->SetVertexBuffers(pContext, 0, 1, &instance.pVB, &stride, &offset);
+    pStateCache_->SetIndexBuffer(pContext, instance.pIB, DXGI_FORMAT_R32_UINT, 0U);
 
     // setup the material
     cbpsMaterialData_.data.ambient  = instance.material.ambient_;
@@ -80,34 +80,38 @@ void TerrainShader::Render(
     cbpsMaterialData_.data.reflect  = instance.material.reflect_;
     cbpsMaterialData_.ApplyChanges(pContext);
 
+    BindDebugParams(pContext, instance);
+
     // render geometry
     //pContext->DrawIndexed(instance.indexCount, 0U, 0U);
-    pContext->Draw(instance.numVertices, 0);
+    pStateCache_->Draw(pContext, instance.numVertices, 0);
 }
 
 // --------------------------------------------------------
-// Desc:   render terrain's vertices onto the screen
-//         (NOTE: we don't use any indices here)
+// Desc:   render visible terrain's patches onto the screen
+//         (each patch is a range of the index buffer which is
+//         offset to the patch's vertices in the static grid)
 // Args:   - pContext: a ptr to DirectX11 device context
 //         - instance: container of necessary data for rendering
 // --------------------------------------------------------
-void TerrainShader::RenderVertices(
+void TerrainShader::RenderPatches(
     ID3D11DeviceContext* pContext,
     const TerrainInstance& instance)
 {
     // bind vertex and pixel shaders
-    pContext->VSSetShader(vs_.GetShader(), nullptr, 0U);
-    pContext->IASetInputLayout(vs_.GetInputLayout());
-    pContext->PSSetShader(ps_.GetShader(), nullptr, 0U);
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetPS(pContext, ps_.GetShader());
 
     // set the sampler state and textures
-    pContext->PSSetSamplers(1U, 1U, samplerState_.GetAddressOf());
-    pContext->PSSetShaderResources(1U, NUM_TEXTURE_TYPES, instance.textures);
+    pStateCache_->SetPSSamplers(pContext, 1U, 1U, samplerState_.GetAddressOf());
+    pStateCache_->SetPSShaderResources(pContext, 1U, NUM_TEXTURE_TYPES, instance.textures);
 
-    // bind vertex buffer
+    // bind vertex/index buffers
     constexpr UINT offset = 0;
 
-    pContext->IASetVertexBuffers(0, 1, &instance.pVB, &instance.vertexStride, &offset);
+    pStateCache_->SetVertexBuffers(pContext, 0, 1, &instance.pVB, &instance.vertexStride, &offset);
+    pStateCache_->SetIndexBuffer(pContext, instance.pIB, DXGI_FORMAT_R32_UINT, 0U);
 
     // setup the material
     cbpsMaterialData_.data.ambient  = instance.material.ambient_;
@@ -116,10 +120,254 @@ void TerrainShader::RenderVertices(
     cbpsMaterialData_.data.reflect  = instance.material.reflect_;
     cbpsMaterialData_.ApplyChanges(pContext);
 
-    pContext->PSSetConstantBuffers(5, 1, cbpsMaterialData_.GetAddressOf());
+    pStateCache_->SetPSConstantBuffers(pContext, 5, 1, cbpsMaterialData_.GetAddressOf());
+
+    BindDebugParams(pContext, instance);
+
+    // render geometry
+    for (UINT i = 0; i < instance.numPatches; ++i)
+    {
+        if (instance.patchLods)
+            UpdateDebugPatch(pContext, instance, i);
+
+        pStateCache_->DrawIndexed(
+            pContext,
+            instance.patchIndexCounts[i],
+            instance.patchStartIndices[i],
+            instance.patchBaseVertices[i]);
+    }
+}
+
+// --------------------------------------------------------
+// Desc:   initialize shaders of the tessellated terrain
+//         (TerrainPS is shared with the geomipmapped terrain)
+// Args:   - pDevice:    pointer to the DirectX device
+//         - vsFilename: path to the vertex shader (passes control points)
+//         - hsFilename: path to the hull shader (culling, tess factors)
+//         - dsFilename: path to the domain shader (displacement)
+// --------------------------------------------------------
+bool TerrainShader::InitializeTessellation(
+    ID3D11Device* pDevice,
+    const char* vsFilename,
+    const char* hsFilename,
+    const char* dsFilename)
+{
+    try
+    {
+        bool result = false;
+        const InputLayoutTerrainPatch layout;
+
+        result = vsTess_.Initialize(pDevice, vsFilename, layout.desc, layout.numElems);
+        CAssert::True(result, "can't initialize the vertex shader (tessellation)");
+
+        result = hs_.Initialize(pDevice, hsFilename);
+        CAssert::True(result, "can't initialize the hull shader");
+
+        result = ds_.Initialize(pDevice, dsFilename);
+        CAssert::True(result, "can't initialize the domain shader");
+
+        const HRESULT hr = cbTess_.Initialize(pDevice);
+        CAssert::NotFailed(hr, "can't initialize the const buffer (for the tessellation params)");
+
+        isTessellation_ = true;
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the terrain tessellation");
+        return false;
+    }
+}
+
+// --------------------------------------------------------
+// Desc:   render the tessellated terrain onto the screen
+// Args:   - pContext: a ptr to DirectX11 device context
+//         - instance: container of necessary data for rendering
+//         - params:   tessellation params of this frame
+// --------------------------------------------------------
+void TerrainShader::RenderTessellated(
+    ID3D11DeviceContext* pContext,
+    const TerrainInstance& instance,
+    const ConstBufType::cbTerrainTess& params)
+{
+    // bind shaders (HS/DS slots aren't shadowed by the state cache)
+    pStateCache_->SetVS(pContext, vsTess_.GetShader());
+    pStateCache_->SetInputLayout(pContext, vsTess_.GetInputLayout());
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+    pContext->HSSetShader(hs_.GetShader(), nullptr, 0);
+    pContext->DSSetShader(ds_.GetShader(), nullptr, 0);
+
+    // each 4 control points are a patch
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_4_CONTROL_POINT_PATCHLIST);
+
+    constexpr UINT offset = 0;
+    pStateCache_->SetVertexBuffers(pContext, 0, 1, &instance.pVB, &instance.vertexStride, &offset);
+
+    // tessellation params
+    cbTess_.data = params;
+    cbTess_.ApplyChanges(pContext);
+    pContext->HSSetConstantBuffers(0, 1, cbTess_.GetAddressOf());
+    pContext->DSSetConstantBuffers(0, 1, cbTess_.GetAddressOf());
+
+    // the height map for displacement
+    pContext->DSSetShaderResources(0, 1, &instance.heightMap);
+    pContext->DSSetSamplers(0, 1, samplerHeight_.GetAddressOf());
+
+    // the same textures and material as of the geomipmapped terrain
+    pStateCache_->SetPSSamplers(pContext, 1U, 1U, samplerState_.GetAddressOf());
+    pStateCache_->SetPSShaderResources(pContext, 1U, NUM_TEXTURE_TYPES, instance.textures);
+
+    cbpsMaterialData_.data.ambient  = instance.material.ambient_;
+    cbpsMaterialData_.data.diffuse  = instance.material.diffuse_;
+    cbpsMaterialData_.data.specular = instance.material.specular_;
+    cbpsMaterialData_.data.reflect  = instance.material.reflect_;
+    cbpsMaterialData_.ApplyChanges(pContext);
+
+    pStateCache_->SetPSConstantBuffers(pContext, 5, 1, cbpsMaterialData_.GetAddressOf());
+
+    BindDebugParams(pContext, instance);
+
+    // render geometry
+    pStateCache_->Draw(pContext, instance.numVertices, 0);
+
+    // unbind the tessellation stages so the next passes don't use them
+    pContext->HSSetShader(nullptr, nullptr, 0);
+    pContext->DSSetShader(nullptr, nullptr, 0);
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+// --------------------------------------------------------
+// Desc:   initialize the vertex shader of the terrain rendered by vertex
+//         pulling (TerrainPS is shared with the geomipmapped terrain)
+// Args:   - pDevice:    pointer to the DirectX device
+//         - vsFilename: path to the vertex shader (fetches heights)
+// --------------------------------------------------------
+bool TerrainShader::InitializeVertexPulling(
+    ID3D11Device* pDevice,
+    const char* vsFilename)
+{
+    try
+    {
+        CAssert::True(!StrHelper::IsEmpty(vsFilename), "input vertex shader filename is empty");
+
+        const InputLayoutTerrainGrid layout;
+
+        bool result = vsGrid_.Initialize(pDevice, vsFilename, layout.desc, layout.numElems);
+        CAssert::True(result, "can't initialize the vertex shader (vertex pulling)");
+
+        const HRESULT hr = cbGrid_.Initialize(pDevice);
+        CAssert::NotFailed(hr, "can't initialize the const buffer (for the vertex pulling params)");
+
+        isVertexPulling_ = true;
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the terrain vertex pulling");
+        return false;
+    }
+}
+
+// --------------------------------------------------------
+// Desc:   render visible terrain's patches by vertex pulling: each patch
+//         is a single instance of the shared patch grid (the instance
+//         stream is offset to the patch by StartInstanceLocation)
+// Args:   - pContext: a ptr to DirectX11 device context
+//         - instance: container of necessary data for rendering
+//         - params:   params of the grid for this frame
+// --------------------------------------------------------
+void TerrainShader::RenderPatchesPulled(
+    ID3D11DeviceContext* pContext,
+    const TerrainInstance& instance,
+    const ConstBufType::cbvsTerrainGrid& params)
+{
+    // bind vertex and pixel shaders
+    pStateCache_->SetVS(pContext, vsGrid_.GetShader());
+    pStateCache_->SetInputLayout(pContext, vsGrid_.GetInputLayout());
+    pStateCache_->SetPS(pContext, ps_.GetShader());
+
+    // the patch grid, the first grid vertex of each patch and its morph (per instance)
+    ID3D11Buffer* vbs[3]     = { instance.pVB, instance.pPatchStartsVB, instance.pPatchMorphsVB };
+    const UINT    strides[3] = { instance.vertexStride, instance.vertexStride, instance.patchMorphStride };
+    const UINT    offsets[3] = { 0, 0, 0 };
+
+    pStateCache_->SetVertexBuffers(pContext, 0, 3, vbs, strides, offsets);
+    pStateCache_->SetIndexBuffer(pContext, instance.pIB, DXGI_FORMAT_R32_UINT, 0U);
+
+    // grid params and the height map to fetch heights from
+    cbGrid_.data = params;
+    cbGrid_.ApplyChanges(pContext);
+
+    pStateCache_->SetVSConstantBuffers(pContext, GRID_CB_SLOT, 1, cbGrid_.GetAddressOf());
+    pStateCache_->SetVSShaderResources(pContext, GRID_HEIGHT_MAP_SLOT, 1, &instance.heightMap);
+    pContext->VSSetSamplers(GRID_SAMPLER_SLOT, 1, samplerHeight_.GetAddressOf());
+
+    // the same textures and material as of the geomipmapped terrain
+    pStateCache_->SetPSSamplers(pContext, 1U, 1U, samplerState_.GetAddressOf());
+    pStateCache_->SetPSShaderResources(pContext, 1U, NUM_TEXTURE_TYPES, instance.textures);
+
+    cbpsMaterialData_.data.ambient  = instance.material.ambient_;
+    cbpsMaterialData_.data.diffuse  = instance.material.diffuse_;
+    cbpsMaterialData_.data.specular = instance.material.specular_;
+    cbpsMaterialData_.data.reflect  = instance.material.reflect_;
+    cbpsMaterialData_.ApplyChanges(pContext);
+
+    pStateCache_->SetPSConstantBuffers(pContext, 5, 1, cbpsMaterialData_.GetAddressOf());
+
+    BindDebugParams(pContext, instance);
 
     // render geometry
-    pContext->Draw(instance.numVertices, 0);
+    for (UINT i = 0; i < instance.numPatches; ++i)
+    {
+        if (instance.patchLods)
+            UpdateDebugPatch(pContext, instance, i);
+
+        pStateCache_->DrawIndexedInstanced(
+            pContext,
+            instance.patchIndexCounts[i],
+            1,
+            instance.patchStartIndices[i],
+            0,
+            instance.patchNumbers[i]);
+    }
+}
+
+// --------------------------------------------------------
+// Desc:   setup params of the heatmaps for the whole draw (the slot is
+//         shared with other passes so it is bound even if they are off)
+// --------------------------------------------------------
+void TerrainShader::BindDebugParams(
+    ID3D11DeviceContext* pContext,
+    const TerrainInstance& instance)
+{
+    cbpsDebug_.data.debugType = instance.debugType;
+    cbpsDebug_.data.patchLod  = 0;
+    cbpsDebug_.data.patchNum  = 0;
+    cbpsDebug_.data.triArea   = instance.triAreaLod0;
+    cbpsDebug_.ApplyChanges(pContext);
+
+    pStateCache_->SetPSConstantBuffers(pContext, DEBUG_CB_SLOT, 1, cbpsDebug_.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// Desc:   setup params of the heatmaps for a single patch
+//         (is called only if heatmaps are on)
+// Args:   - drawIdx: idx of the patch in the draw list
+// --------------------------------------------------------
+void TerrainShader::UpdateDebugPatch(
+    ID3D11DeviceContext* pContext,
+    const TerrainInstance& instance,
+    const UINT drawIdx)
+{
+    const UINT lod = instance.patchLods[drawIdx];
+
+    // the patch number is stable between frames (unlike the idx of the draw)
+    cbpsDebug_.data.patchLod = lod;
+    cbpsDebug_.data.patchNum = (instance.patchNumbers) ? instance.patchNumbers[drawIdx] : (UINT)instance.patchBaseVertices[drawIdx];
+    cbpsDebug_.data.triArea  = instance.triAreaLod0 * (float)(1 << (2 * lod));
+    cbpsDebug_.ApplyChanges(pContext);
 }
 
 // --------------------------------------------------------
@@ -175,9 +423,27 @@ void TerrainShader::InitializeShaders(
     result = samplerState_.Initialize(pDevice);
     CAssert::True(result, "can't initialize the sampler state");
 
+    // heights are filtered between texels and aren't wrapped at the borders
+    // (is used by the tessellated terrain and by vertex pulling)
+    D3D11_SAMPLER_DESC samplerDesc {};
+    samplerDesc.Filter         = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+    samplerDesc.AddressU       = D3D11_TEXTURE_ADDRESS_CLAMP;
+    samplerDesc.AddressV       = D3D11_TEXTURE_ADDRESS_CLAMP;
+    samplerDesc.AddressW       = D3D11_TEXTURE_ADDRESS_CLAMP;
+    samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    samplerDesc.MinLOD         = 0.0f;
+    samplerDesc.MaxLOD         = D3D11_FLOAT32_MAX;
+    samplerDesc.MaxAnisotropy  = 1;
+
+    result = samplerHeight_.Initialize(pDevice, &samplerDesc);
+    CAssert::True(result, "can't initialize the sampler state (of the height map)");
+
     // cbps - const buffer for pixel shader
     hr = cbpsMaterialData_.Initialize(pDevice);
     CAssert::NotFailed(hr, "can't initialize a constant buffer of materials");
+
+    hr = cbpsDebug_.Initialize(pDevice);
+    CAssert::NotFailed(hr, "can't initialize a constant buffer of heatmaps");
 }
 
 } // namespace
@@ -7,12 +7,15 @@
 #pragma once
 
 #include "VertexShader.h"
+#include "HullShader.h"
+#include "DomainShader.h"
 #include "PixelShader.h"
 #include "SamplerState.h"
 #include "ConstantBuffer.h"
 
 #include "../Common/ConstBufferTypes.h"
 #include "../Common/RenderTypes.h"
+#include "../StateCache.h"
 #include <d3d11.h>
 
 
@@ -40,10 +43,39 @@ public:
         ID3D11DeviceContext* pContext,
         const TerrainInstance& instance);
 
-    void RenderVertices(
+    // render visible patches: the buffers are bound once and each patch
+    // is a single indexed draw call
+    void RenderPatches(
         ID3D11DeviceContext* pContext,
         const TerrainInstance& instance);
 
+    // an alternative to the geomipmapping: the coarse patches grid (instance.pVB is
+    // a list of 4 control points per patch) is culled and tessellated by the hull
+    // shader, and the domain shader displaces vertices by instance.heightMap
+    bool InitializeTessellation(
+        ID3D11Device* pDevice,
+        const char* vsFilename,
+        const char* hsFilename,
+        const char* dsFilename);
+
+    void RenderTessellated(
+        ID3D11DeviceContext* pContext,
+        const TerrainInstance& instance,
+        const ConstBufType::cbTerrainTess& params);
+
+    // an alternative input of the geomipmapped terrain: instance.pVB/pIB are the grid
+    // of a single patch (only 2D grid coords per vertex) and each visible patch is
+    // a draw of one instance which first grid vertex is fetched from
+    // instance.pPatchStartsVB; heights are fetched by the VS from instance.heightMap
+    bool InitializeVertexPulling(
+        ID3D11Device* pDevice,
+        const char* vsFilename);
+
+    void RenderPatchesPulled(
+        ID3D11DeviceContext* pContext,
+        const TerrainInstance& instance,
+        const ConstBufType::cbvsTerrainGrid& params);
+
     void ShaderHotReload(
         ID3D11Device* pDevice,
         const char* vsFilename,
@@ -51,6 +83,13 @@ public:
 
     inline ID3D11Buffer* GetConstBufferPS() const { return cbpsMaterialData_.Get(); }
     inline const char*   GetShaderName()    const { return className_; }
+    inline bool          IsTessellation()   const { return isTessellation_; }
+    inline bool          IsVertexPulling()  const { return isVertexPulling_; }
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+    // shaders objects (for hot reload)
+    inline VertexShader& GetVS() { return vs_; }
+    inline PixelShader&  GetPS() { return ps_; }
 
 private:
     void InitializeShaders(
@@ -58,12 +97,39 @@ private:
         const char* vsFilename,
         const char* psFilename);
 
+    // params of the heatmaps (are off if instance.debugType == 0)
+    void BindDebugParams (ID3D11DeviceContext* pContext, const TerrainInstance& instance);
+    void UpdateDebugPatch(ID3D11DeviceContext* pContext, const TerrainInstance& instance, const UINT drawIdx);
+
 private:
+    // slots of the vertex pulling resources in the VS (see TerrainGridVS.hlsl)
+    static constexpr UINT GRID_CB_SLOT         = 4;
+    static constexpr UINT GRID_HEIGHT_MAP_SLOT = 0;
+    static constexpr UINT GRID_SAMPLER_SLOT    = 0;
+
+    // slot of the heatmaps params in the PS (see TerrainPS.hlsl)
+    static constexpr UINT DEBUG_CB_SLOT        = 6;
+
     VertexShader                               vs_;
     PixelShader                                ps_;
     SamplerState                               samplerState_;       // for texturing
     ConstantBuffer<ConstBufType::MaterialData> cbpsMaterialData_;   // cbps -- const buffer for pixel shader
-
+    ConstantBuffer<ConstBufType::cbpsTerrainDebug> cbpsDebug_;      // heatmaps (LOD, batches, triangle density, etc.)
+
+    // the tessellated terrain
+    VertexShader                               vsTess_;
+    HullShader                                 hs_;
+    DomainShader                               ds_;
+    SamplerState                               samplerHeight_;      // for the height map in DS (and in VS of vertex pulling)
+    ConstantBuffer<ConstBufType::cbTerrainTess> cbTess_;            // is bound to both HS and DS
+    bool                                       isTessellation_ = false;
+
+    // the terrain rendered by vertex pulling
+    VertexShader                               vsGrid_;
+    ConstantBuffer<ConstBufType::cbvsTerrainGrid> cbGrid_;
+    bool                                       isVertexPulling_ = false;
+
+    StateCache* pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
     char className_[16] = "TerrainShader";
 };
 
@@ -13,6 +13,7 @@
 #include "SamplerState.h"
 #include "ConstantBuffer.h"
 #include "../Common/RenderTypes.h"
+#include "../StateCache.h"
 
 #include <d3d11.h>
 
@@ -39,10 +40,12 @@ public:
 		ID3D11Buffer* pInstancedBuffer,
 		const Instance* instances,
 		const int numModels,
-		const UINT instancedBuffElemSize);
+		const UINT instancedBuffElemSize,
+		const UINT baseInstance);
 
 	// Public query API
 	inline const char* GetShaderName() const { return className_; }	
+	inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
 
 private:
     void InitializeShaders(
@@ -55,6 +58,7 @@ private:
 	PixelShader  ps_;
 	SamplerState samplerState_;
 
+	StateCache* pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
 	char className_[32]{"TextureShader"};
 };
 
@@ -0,0 +1,123 @@
+// =================================================================================
+// Filename:     UpscaleShader.cpp
+// Description:  implementation of the UpscaleShader's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "../Common/pch.h"
+#include "UpscaleShader.h"
+
+namespace Render
+{
+
+UpscaleShader::UpscaleShader()
+{
+    strcpy(className_, __func__);
+}
+
+UpscaleShader::~UpscaleShader()
+{
+}
+
+///////////////////////////////////////////////////////////
+
+bool UpscaleShader::Initialize(
+    ID3D11Device* pDevice,
+    const char* vsFilePath,
+    const char* psFilePath,
+    const char* psFxaaFilePath)
+{
+    try
+    {
+        InitializeShaders(pDevice, vsFilePath, psFilePath, psFxaaFilePath);
+        LogDbg("is initialized");
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the upscale shader class");
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void UpscaleShader::Render(
+    ID3D11DeviceContext* pContext,
+    SRV* pSceneSRV,
+    const UINT texWidth,
+    const UINT texHeight,
+    const UINT renderedWidth,
+    const UINT renderedHeight,
+    const bool fxaa)
+{
+    if (!pSceneSRV || (texWidth == 0) || (texHeight == 0))
+        return;
+
+    // no vertex buffers: the fullscreen triangle is generated by SV_VertexID
+    pStateCache_->SetInputLayout(pContext, nullptr);
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetGS(pContext, nullptr);
+    pStateCache_->SetPS(pContext, (fxaa) ? psFxaa_.GetShader() : ps_.GetShader());
+    pStateCache_->SetPSSamplers(pContext, 0, 1, samplerState_.GetAddressOf());
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    const float invWidth  = 1.0f / (float)texWidth;
+    const float invHeight = 1.0f / (float)texHeight;
+
+    cbpsUpscale_.data.uvScale   = { renderedWidth * invWidth, renderedHeight * invHeight };
+    cbpsUpscale_.data.uvMax     = { (renderedWidth - 0.5f) * invWidth, (renderedHeight - 0.5f) * invHeight };
+    cbpsUpscale_.data.texelSize = { invWidth, invHeight };
+    cbpsUpscale_.ApplyChanges(pContext);
+
+    pStateCache_->SetPSConstantBuffers(pContext, CONST_BUFFER_SLOT, 1, cbpsUpscale_.GetAddressOf());
+    pStateCache_->SetPSShaderResources(pContext, 0, 1, &pSceneSRV);
+
+    pStateCache_->Draw(pContext, 3, 0);
+
+    // the scene texture is bound as a render target in the next frame
+    SRV* nullSRV = nullptr;
+    pStateCache_->SetPSShaderResources(pContext, 0, 1, &nullSRV);
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+void UpscaleShader::InitializeShaders(
+    ID3D11Device* pDevice,
+    const char* vsFilePath,
+    const char* psFilePath,
+    const char* psFxaaFilePath)
+{
+    bool result = false;
+
+    // initialize: VS (without input layout), PSs, sampler state
+    result = vs_.Initialize(pDevice, vsFilePath, nullptr, 0);
+    CAssert::True(result, "can't initialize the vertex shader");
+
+    result = ps_.Initialize(pDevice, psFilePath);
+    CAssert::True(result, "can't initialize the pixel shader");
+
+    result = psFxaa_.Initialize(pDevice, psFxaaFilePath);
+    CAssert::True(result, "can't initialize the pixel shader (FXAA)");
+
+    D3D11_SAMPLER_DESC samplerDesc {};
+    samplerDesc.Filter         = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+    samplerDesc.AddressU       = D3D11_TEXTURE_ADDRESS_CLAMP;
+    samplerDesc.AddressV       = D3D11_TEXTURE_ADDRESS_CLAMP;
+    samplerDesc.AddressW       = D3D11_TEXTURE_ADDRESS_CLAMP;
+    samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    samplerDesc.MinLOD         = 0.0f;
+    samplerDesc.MaxLOD         = D3D11_FLOAT32_MAX;
+    samplerDesc.MaxAnisotropy  = 1;
+
+    result = samplerState_.Initialize(pDevice, &samplerDesc);
+    CAssert::True(result, "can't initialize the sampler state");
+
+    HRESULT hr = cbpsUpscale_.Initialize(pDevice);
+    CAssert::NotFailed(hr, "can't initialize the const buffer (for the upscale params in PS)");
+}
+
+} // namespace Render
@@ -0,0 +1,80 @@
+// =================================================================================
+// Filename:     UpscaleShader.h
+// Description:  stretches the rendered part of the scene texture (which is rendered
+//               with a lower resolution by the dynamic resolution) to the whole
+//               current render target by a fullscreen triangle;
+//               optionally the post-process anti-aliasing (FXAA) is done in
+//               the same pass
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "VertexShader.h"
+#include "PixelShader.h"
+#include "SamplerState.h"
+#include "ConstantBuffer.h"
+#include "../Common/ConstBufferTypes.h"
+#include "../StateCache.h"
+
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+class UpscaleShader
+{
+    using SRV = ID3D11ShaderResourceView;
+
+public:
+    // the slot doesn't overlap const buffers which are bound once per frame
+    static constexpr UINT CONST_BUFFER_SLOT = 12;
+
+    UpscaleShader();
+    ~UpscaleShader();
+
+    // restrict a copying of this class instance
+    UpscaleShader(const UpscaleShader&) = delete;
+    UpscaleShader& operator=(const UpscaleShader&) = delete;
+
+    bool Initialize(
+        ID3D11Device* pDevice,
+        const char* vsFilePath,
+        const char* psFilePath,
+        const char* psFxaaFilePath);
+
+    // input: the scene texture size and the size of its rendered (top-left) part;
+    // NOTE: the caller binds the render target and disables the depth test
+    void Render(
+        ID3D11DeviceContext* pContext,
+        SRV* pSceneSRV,
+        const UINT texWidth,
+        const UINT texHeight,
+        const UINT renderedWidth,
+        const UINT renderedHeight,
+        const bool fxaa);
+
+    inline const char* GetShaderName()            const { return className_; }
+    inline void        SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+private:
+    void InitializeShaders(
+        ID3D11Device* pDevice,
+        const char* vsFilePath,
+        const char* psFilePath,
+        const char* psFxaaFilePath);
+
+private:
+    VertexShader        vs_;
+    PixelShader         ps_;
+    PixelShader         psFxaa_;                            // upscale + anti-aliasing
+    SamplerState        samplerState_;                      // bilinear, clamp
+
+    ConstantBuffer<ConstBufType::cbpsUpscale> cbpsUpscale_;
+
+    StateCache* pStateCache_ = nullptr;                     // filters redundant binds (is owned by CRender)
+    char className_[32]{ "UpscaleShader" };
+};
+
+} // namespace Render
@@ -71,14 +71,18 @@ bool VertexShader::Initialize(
         return false;
     }
 
-    hr = pDevice->CreateInputLayout(layoutDesc, layoutElemNum, (void*)buffer, len, &pInputLayout_);
-    if (FAILED(hr))
+    // shaders which fetch their data by SV_VertexID/SV_InstanceID have no input layout
+    if (layoutElemNum > 0)
     {
-        SafeDeleteArr(buffer);
-        SafeRelease(&pShader_);
-        sprintf(g_String, "Failed to create the input layout for vertex shader: %s", shaderPath);
-        LogErr(g_String);
-        return false;
+        hr = pDevice->CreateInputLayout(layoutDesc, layoutElemNum, (void*)buffer, len, &pInputLayout_);
+        if (FAILED(hr))
+        {
+            SafeDeleteArr(buffer);
+            SafeRelease(&pShader_);
+            sprintf(g_String, "Failed to create the input layout for vertex shader: %s", shaderPath);
+            LogErr(g_String);
+            return false;
+        }
     }
 
     // Release the vertex shader buffer since it is no longer needed.
@@ -178,4 +182,15 @@ void VertexShader::Shutdown()
     SafeRelease(&pShader_);
 }
 
+///////////////////////////////////////////////////////////
+
+void VertexShader::Swap(ID3D11VertexShader* pShader, ID3D11InputLayout* pInputLayout)
+{
+    SafeRelease(&pInputLayout_);
+    SafeRelease(&pShader_);
+
+    pShader_      = pShader;
+    pInputLayout_ = pInputLayout;
+}
+
 }; // namespace Render
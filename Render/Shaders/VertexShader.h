@@ -17,6 +17,7 @@ class VertexShader
 public:
     ~VertexShader();
 
+    // NOTE: layoutElemNum == 0 means no input layout (vertex pulling)
     bool Initialize(
         ID3D11Device* pDevice,
         const char* shaderPath,
@@ -34,6 +35,10 @@ public:
     
     void Shutdown();
 
+    // replace the current shader and layout with the input ones (takes ownership);
+    // is used for background hot reload
+    void Swap(ID3D11VertexShader* pShader, ID3D11InputLayout* pInputLayout);
+
     // public query API
     inline ID3D11VertexShader* GetShader()      { return pShader_; };
     inline ID3D11InputLayout*  GetInputLayout() { return pInputLayout_; };
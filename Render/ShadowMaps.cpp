@@ -0,0 +1,435 @@
+// =================================================================================
+// Filename:     ShadowMaps.cpp
+// Description:  implementation of the ShadowMaps's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "ShadowMaps.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+static_assert(sizeof(ConstBufType::cbShadows) % 16 == 0, "size of the const buffer must be a multiple of 16");
+
+// slots of resources (must be the same as in ShadowMaps.hlsli)
+static constexpr UINT PS_SHADOW_MAPS_SLOT = 23;
+static constexpr UINT PS_SAMPLER_SLOT     = 4;
+static constexpr UINT PS_CB_SLOT          = 8;
+static constexpr UINT VS_CB_SLOT          = 0;     // the same as cbVSPerFrame of the depth pre-pass VS
+
+///////////////////////////////////////////////////////////
+
+ShadowMaps::~ShadowMaps()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool ShadowMaps::Initialize(ID3D11Device* pDevice, const ShadowParams& params)
+{
+    try
+    {
+        CAssert::True(params.mapSize >= 256, "size of shadow maps must be >= 256");
+        CAssert::True((params.numCascades > 0) && (params.numCascades <= MAX_CASCADES), "wrong number of shadow cascades");
+        CAssert::True(params.distance > 0.0f, "the shadows distance must be > 0");
+
+        params_ = params;
+
+        // a cascade scrolls by a whole number of texels
+        params_.mapSize &= ~63u;
+
+        CAssert::True(CreateMaps(pDevice), "can't create shadow maps");
+
+        // 2x2 PCF by each comparison sample
+        D3D11_SAMPLER_DESC samplerDesc;
+        ZeroMemory(&samplerDesc, sizeof(samplerDesc));
+        samplerDesc.Filter         = D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+        samplerDesc.AddressU       = D3D11_TEXTURE_ADDRESS_BORDER;
+        samplerDesc.AddressV       = D3D11_TEXTURE_ADDRESS_BORDER;
+        samplerDesc.AddressW       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL;
+        samplerDesc.BorderColor[0] = 1.0f;               // out of the map: lit
+        samplerDesc.BorderColor[1] = 1.0f;
+        samplerDesc.BorderColor[2] = 1.0f;
+        samplerDesc.BorderColor[3] = 1.0f;
+        samplerDesc.MaxLOD         = D3D11_FLOAT32_MAX;
+
+        bool result = cmpSampler_.Initialize(pDevice, &samplerDesc);
+        CAssert::True(result, "can't initialize the shadow maps sampler state");
+
+        // casters aren't culled (alpha clipped foliage and thin walls are two-sided anyway)
+        // and aren't clipped by the near plane (they are clamped onto it: pancaking)
+        D3D11_RASTERIZER_DESC rsDesc;
+        ZeroMemory(&rsDesc, sizeof(rsDesc));
+        rsDesc.FillMode             = D3D11_FILL_SOLID;
+        rsDesc.CullMode             = D3D11_CULL_NONE;
+        rsDesc.SlopeScaledDepthBias = 1.5f;
+        rsDesc.DepthClipEnable      = FALSE;
+
+        CAssert::NotFailed(pDevice->CreateRasterizerState(&rsDesc, &pRasterState_), "can't create a raster state of shadow casters");
+
+        CAssert::NotFailed(cbCaster_.Initialize(pDevice),  "can't initialize the shadow casters const buffer");
+        CAssert::NotFailed(cbShadows_.Initialize(pDevice), "can't initialize the shadows const buffer");
+
+        stats_.numCascades = (uint32)params_.numCascades;
+        isInit_ = true;
+
+        LogMsgf("shadow maps: %d cascades of %ux%u (%u KB with the cache)",
+            params_.numCascades,
+            params_.mapSize,
+            params_.mapSize,
+            (2 * params_.numCascades * params_.mapSize * params_.mapSize * 4) >> 10);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize shadow maps");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void ShadowMaps::Shutdown()
+{
+    for (int i = 0; i < MAX_CASCADES; ++i)
+    {
+        SafeRelease(&pMapDSVs_[i]);
+        SafeRelease(&pCacheDSVs_[i]);
+    }
+
+    SafeRelease(&pMapsSRV_);
+    SafeRelease(&pMaps_);
+    SafeRelease(&pCache_);
+    SafeRelease(&pRasterState_);
+    SafeRelease(&pPrevRTV_);
+    SafeRelease(&pPrevDSV_);
+
+    for (ShadowCascade& cascade : cascades_)
+        cascade.isStaticDirty = true;
+
+    stats_    = ShadowStats();
+    isActive_ = false;
+    isInit_   = false;
+}
+
+///////////////////////////////////////////////////////////
+
+bool ShadowMaps::CreateMaps(ID3D11Device* pDevice)
+{
+    try
+    {
+        // both arrays have the same format so the cache is copied by CopySubresourceRegion
+        D3D11_TEXTURE2D_DESC desc;
+        ZeroMemory(&desc, sizeof(desc));
+
+        desc.Width            = params_.mapSize;
+        desc.Height           = params_.mapSize;
+        desc.MipLevels        = 1;
+        desc.ArraySize        = (UINT)params_.numCascades;
+        desc.Format           = DXGI_FORMAT_R32_TYPELESS;
+        desc.SampleDesc.Count = 1;
+        desc.Usage            = D3D11_USAGE_DEFAULT;
+        desc.BindFlags        = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+
+        HRESULT hr = pDevice->CreateTexture2D(&desc, nullptr, &pMaps_);
+        CAssert::NotFailed(hr, "can't create a texture of shadow maps");
+
+        // the cache is never sampled
+        desc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+
+        hr = pDevice->CreateTexture2D(&desc, nullptr, &pCache_);
+        CAssert::NotFailed(hr, "can't create a texture of the shadow maps cache");
+
+        // a depth view per cascade
+        D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+        ZeroMemory(&dsvDesc, sizeof(dsvDesc));
+        dsvDesc.Format                         = DXGI_FORMAT_D32_FLOAT;
+        dsvDesc.ViewDimension                  = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+        dsvDesc.Texture2DArray.MipSlice        = 0;
+        dsvDesc.Texture2DArray.ArraySize       = 1;
+
+        for (int i = 0; i < params_.numCascades; ++i)
+        {
+            dsvDesc.Texture2DArray.FirstArraySlice = (UINT)i;
+
+            hr = pDevice->CreateDepthStencilView(pMaps_, &dsvDesc, &pMapDSVs_[i]);
+            CAssert::NotFailed(hr, "can't create a DSV of a shadow map");
+
+            hr = pDevice->CreateDepthStencilView(pCache_, &dsvDesc, &pCacheDSVs_[i]);
+            CAssert::NotFailed(hr, "can't create a DSV of the shadow maps cache");
+        }
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        ZeroMemory(&srvDesc, sizeof(srvDesc));
+        srvDesc.Format                         = DXGI_FORMAT_R32_FLOAT;
+        srvDesc.ViewDimension                  = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+        srvDesc.Texture2DArray.MostDetailedMip = 0;
+        srvDesc.Texture2DArray.MipLevels       = 1;
+        srvDesc.Texture2DArray.FirstArraySlice = 0;
+        srvDesc.Texture2DArray.ArraySize       = (UINT)params_.numCascades;
+
+        hr = pDevice->CreateShaderResourceView(pMaps_, &srvDesc, &pMapsSRV_);
+        CAssert::NotFailed(hr, "can't create a SRV of shadow maps");
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void ShadowMaps::SetupCascades(
+    const XMMATRIX& view,
+    const XMMATRIX& proj,
+    const XMFLOAT3& lightDir,
+    const bool isStaticChanged)
+{
+    if (!isInit_)
+        return;
+
+    // params of the camera by its perspective projection (left-handed)
+    const float nearZ = -proj.r[3].m128_f32[2] / proj.r[2].m128_f32[2];
+    const float tanX  = 1.0f / proj.r[0].m128_f32[0];
+    const float tanY  = 1.0f / proj.r[1].m128_f32[1];
+    const float k2    = (tanX * tanX) + (tanY * tanY);    // (radius of the frustum slice / its depth)^2
+
+    const XMMATRIX invView = XMMatrixInverse(nullptr, view);
+    const XMVECTOR camPos  = invView.r[3];
+    const XMVECTOR camDir  = XMVector3Normalize(invView.r[2]);
+
+    // a basis of light space (the same as of XMMatrixLookToLH)
+    const XMVECTOR F  = XMVector3Normalize(XMLoadFloat3(&lightDir));
+    const XMVECTOR up = (fabsf(XMVectorGetY(F)) > 0.99f) ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(0, 1, 0, 0);
+    const XMVECTOR R  = XMVector3Normalize(XMVector3Cross(up, F));
+    const XMVECTOR U  = XMVector3Cross(F, R);
+
+    // all the cached cascades are invalid if the light was turned
+    const bool isLightTurned =
+        (fabsf(lightDir.x - lightDir_.x) > 1e-5f) ||
+        (fabsf(lightDir.y - lightDir_.y) > 1e-5f) ||
+        (fabsf(lightDir.z - lightDir_.z) > 1e-5f);
+
+    lightDir_ = lightDir;
+
+    // splits of the view depth
+    const int   numCascades = params_.numCascades;
+    const float farZ        = params_.distance;
+    const float lambda      = params_.splitLambda;
+    float       splitNear   = nearZ;
+
+    // texture space: x,y [-1,1] => [0,1] (y goes down), z stays the same
+    const XMMATRIX toTexture(
+        0.5f,  0.0f, 0.0f, 0.0f,
+        0.0f, -0.5f, 0.0f, 0.0f,
+        0.0f,  0.0f, 1.0f, 0.0f,
+        0.5f,  0.5f, 0.0f, 1.0f);
+
+    ConstBufType::cbShadows& cb = cbShadows_.data;
+    float splits[MAX_CASCADES] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+
+    stats_.numCacheUpdates = 0;
+
+    for (int i = 0; i < numCascades; ++i)
+    {
+        const float t         = (float)(i + 1) / (float)numCascades;
+        const float splitLog  = nearZ * powf(farZ / nearZ, t);
+        const float splitUni  = nearZ + (farZ - nearZ) * t;
+        const float splitFar  = (lambda * splitLog) + ((1.0f - lambda) * splitUni);
+
+        // the bounding sphere of the frustum slice [splitNear, splitFar]: its center is
+        // on the view axis where distances to both rims are equal (or at the far plane)
+        const float n      = splitNear;
+        const float f      = splitFar;
+        const float dist   = std::min(0.5f * (n + f) * (1.0f + k2), f);
+        const float radius = sqrtf(std::max(
+            ((f - dist) * (f - dist)) + (f * f * k2),
+            ((dist - n) * (dist - n)) + (n * n * k2)));
+
+        // the sphere stays inside of the cascade whatever the snapping of its center is
+        const float halfSize = radius / (1.0f - (1.0f / SCROLL_STEPS));
+        const float step     = (2.0f * halfSize) / SCROLL_STEPS;
+
+        // snap the center in light space
+        const XMVECTOR centerW = XMVectorMultiplyAdd(camDir, XMVectorReplicate(dist), camPos);
+
+        const XMFLOAT3 centerL =
+        {
+            floorf(XMVectorGetX(XMVector3Dot(centerW, R)) / step + 0.5f) * step,
+            floorf(XMVectorGetX(XMVector3Dot(centerW, U)) / step + 0.5f) * step,
+            floorf(XMVectorGetX(XMVector3Dot(centerW, F)) / step + 0.5f) * step,
+        };
+
+        ShadowCascade& cascade = cascades_[i];
+
+        const bool isScrolled =
+            (centerL.x != cascade.center.x) ||
+            (centerL.y != cascade.center.y) ||
+            (centerL.z != cascade.center.z) ||
+            (halfSize  != cascade.halfSize);
+
+        if (isScrolled || isLightTurned || isStaticChanged)
+            cascade.isStaticDirty = true;
+
+        cascade.center   = centerL;
+        cascade.halfSize = halfSize;
+        cascade.splitFar = splitFar;
+
+        // the light looks at the cascade from the casters offset before its near side
+        const XMVECTOR snappedW =
+            XMVectorAdd(XMVectorAdd(
+                XMVectorScale(R, centerL.x),
+                XMVectorScale(U, centerL.y)),
+                XMVectorScale(F, centerL.z));
+
+        const float    depthRange = (2.0f * halfSize) + params_.casterOffset;
+        const XMVECTOR eye        = XMVectorSubtract(snappedW, XMVectorScale(F, halfSize + params_.casterOffset));
+        const XMMATRIX lightView  = XMMatrixLookToLH(eye, F, up);
+        const XMMATRIX lightProj  = XMMatrixOrthographicLH(2.0f * halfSize, 2.0f * halfSize, 0.0f, depthRange);
+
+        cascade.viewProj = lightView * lightProj;
+
+        // the volume of casters: sides of the cascade and its far side; there is
+        // no near plane so casters between the light and the cascade are kept
+        const float far = centerL.z + halfSize;
+
+        XMStoreFloat4(&cascade.planes[0], XMVectorSetW(R,               -(centerL.x + halfSize)));
+        XMStoreFloat4(&cascade.planes[1], XMVectorSetW(XMVectorNegate(R), (centerL.x - halfSize)));
+        XMStoreFloat4(&cascade.planes[2], XMVectorSetW(U,               -(centerL.y + halfSize)));
+        XMStoreFloat4(&cascade.planes[3], XMVectorSetW(XMVectorNegate(U), (centerL.y - halfSize)));
+        XMStoreFloat4(&cascade.planes[4], XMVectorSetW(F,               -far));
+
+        cb.transforms[i] = XMMatrixTranspose(cascade.viewProj * toTexture);
+        splits[i]        = splitFar;
+        splitNear        = splitFar;
+    }
+
+    cb.splits      = { splits[0], splits[1], splits[2], splits[3] };
+    cb.texelSize   = 1.0f / (float)params_.mapSize;
+    cb.depthBias   = params_.depthBias;
+    cb.numCascades = numCascades;
+    cb.fadeStart   = 0.9f * splits[numCascades - 1];
+
+    isActive_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+void ShadowMaps::Disable(ID3D11DeviceContext* pContext)
+{
+    if (!isActive_)
+        return;
+
+    cbShadows_.data.numCascades = 0;
+    cbShadows_.ApplyChanges(pContext);
+    isActive_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void ShadowMaps::Begin(ID3D11DeviceContext* pContext, const float gameTime)
+{
+    // remember the current targets and viewport
+    numPrevViewports_ = 1;
+    pContext->OMGetRenderTargets(1, &pPrevRTV_, &pPrevDSV_);
+    pContext->RSGetViewports(&numPrevViewports_, &prevViewport_);
+
+    // the shadow maps are written now
+    pStateCache_->UnbindShaderResource(pContext, pMapsSRV_);
+    pStateCache_->SetRasterState(pContext, pRasterState_);
+
+    const D3D11_VIEWPORT viewport = { 0.0f, 0.0f, (float)params_.mapSize, (float)params_.mapSize, 0.0f, 1.0f };
+    pContext->RSSetViewports(1, &viewport);
+
+    cbCaster_.data.gameTime = gameTime;
+}
+
+///////////////////////////////////////////////////////////
+
+void ShadowMaps::BindCascade(ID3D11DeviceContext* pContext, ID3D11DepthStencilView* pDSV, const int cascade)
+{
+    pContext->OMSetRenderTargets(0, nullptr, pDSV);
+
+    cbCaster_.data.viewProj = XMMatrixTranspose(cascades_[cascade].viewProj);
+    cbCaster_.ApplyChanges(pContext);
+    pStateCache_->SetVSConstantBuffers(pContext, VS_CB_SLOT, 1, cbCaster_.GetAddressOf());
+}
+
+///////////////////////////////////////////////////////////
+
+void ShadowMaps::BeginStaticCasters(ID3D11DeviceContext* pContext, const int cascade)
+{
+    // static casters of the cascade are rendered into its cache from scratch
+    pContext->ClearDepthStencilView(pCacheDSVs_[cascade], D3D11_CLEAR_DEPTH, 1.0f, 0);
+    BindCascade(pContext, pCacheDSVs_[cascade], cascade);
+
+    cascades_[cascade].isStaticDirty = false;
+    stats_.numCacheUpdates++;
+}
+
+///////////////////////////////////////////////////////////
+
+void ShadowMaps::BeginDynamicCasters(ID3D11DeviceContext* pContext, const int cascade)
+{
+    // start the shadow map of the cascade from its cached static casters
+    // (a depth resource is copied only as a whole subresource and mustn't be bound)
+    const UINT subresource = D3D11CalcSubresource(0, (UINT)cascade, 1);
+
+    pContext->OMSetRenderTargets(0, nullptr, nullptr);
+    pContext->CopySubresourceRegion(pMaps_, subresource, 0, 0, 0, pCache_, subresource, nullptr);
+
+    BindCascade(pContext, pMapDSVs_[cascade], cascade);
+}
+
+///////////////////////////////////////////////////////////
+
+void ShadowMaps::End(ID3D11DeviceContext* pContext, ID3D11Buffer* pCameraVSCB)
+{
+    // restore the pipeline
+    pContext->OMSetRenderTargets(1, &pPrevRTV_, pPrevDSV_);
+    pContext->RSSetViewports(numPrevViewports_, &prevViewport_);
+    pStateCache_->SetVSConstantBuffers(pContext, VS_CB_SLOT, 1, &pCameraVSCB);
+
+    // OMGetRenderTargets() increments ref counters
+    SafeRelease(&pPrevRTV_);
+    SafeRelease(&pPrevDSV_);
+
+    // shadow maps for lit shaders
+    cbShadows_.ApplyChanges(pContext);
+
+    ID3D11SamplerState* pSampler = cmpSampler_.GetSampler();
+
+    pStateCache_->SetPSConstantBuffers(pContext, PS_CB_SLOT, 1, cbShadows_.GetAddressOf());
+    pStateCache_->SetPSShaderResources(pContext, PS_SHADOW_MAPS_SLOT, 1, &pMapsSRV_);
+    pStateCache_->SetPSSamplers(pContext, PS_SAMPLER_SLOT, 1, &pSampler);
+}
+
+///////////////////////////////////////////////////////////
+
+void ShadowMaps::BindCS(ID3D11DeviceContext* pContext)
+{
+    // (if there is no sun the const buffer has no cascades)
+    ID3D11SamplerState* pSampler = cmpSampler_.GetSampler();
+
+    pContext->CSSetConstantBuffers(PS_CB_SLOT, 1, cbShadows_.GetAddressOf());
+    pContext->CSSetShaderResources(PS_SHADOW_MAPS_SLOT, 1, &pMapsSRV_);
+    pContext->CSSetSamplers(PS_SAMPLER_SLOT, 1, &pSampler);
+}
+
+} // namespace Render
@@ -0,0 +1,154 @@
+// =================================================================================
+// Filename:     ShadowMaps.h
+// Description:  cascaded shadow maps of the sun (the first directional light)
+//               with a cache of static casters:
+//
+//               - the camera frustum is split by the view depth and each cascade
+//                 covers the bounding sphere of its split, so the size of the
+//                 cascade doesn't depend on the camera rotation;
+//               - the cascade's center is snapped (in light space) to a grid of
+//                 1/SCROLL_STEPS of its size (a multiple of texels), so the
+//                 cascade stays still while the camera moves inside of a cell
+//                 and its shadows don't shimmer when it scrolls;
+//               - static casters are rendered into a cache of each cascade only
+//                 if the cascade was scrolled, the light was turned or the static
+//                 geometry was changed; each frame the cached depth is copied into
+//                 the shadow map and only dynamic casters are rendered over it;
+//               - casters are rendered by the depth pre-pass shaders (the view-proj
+//                 of the light is bound instead of the camera's one) with pancaking:
+//                 casters between the light and the cascade are clamped to its
+//                 near plane so it doesn't need to cover them
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/SamplerState.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "StateCache.h"
+
+#include <Types.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+struct ShadowParams
+{
+    UINT  mapSize      = 2048;              // of a cascade (is rounded down to a multiple of 64)
+    int   numCascades  = 3;
+    float distance     = 150.0f;            // shadows are cast up to this view depth
+    float splitLambda  = 0.75f;             // a blend of logarithmic (1) and uniform (0) splits
+    float depthBias    = 0.0005f;           // in the depth of the shadow map [0,1]
+    float casterOffset = 100.0f;            // the depth range toward the light which is kept in precision
+};
+
+// a cascade of the current frame
+struct ShadowCascade
+{
+    DirectX::XMMATRIX viewProj;             // world => clip space of the light (NOT transposed)
+    DirectX::XMFLOAT4 planes[5];            // world planes of the casters volume (normals look outside; no near plane)
+    DirectX::XMFLOAT3 center        = { 0,0,0 };  // the snapped center in light space
+    float             halfSize      = 0;    // half of the cascade width in world units
+    float             splitFar      = 0;    // the far view depth of the cascade
+    bool              isStaticDirty = true; // static casters must be rendered into the cache
+};
+
+struct ShadowStats
+{
+    uint32 numCascades     = 0;
+    uint32 numCacheUpdates = 0;             // cascades whose static cache was re-rendered in the last frame
+};
+
+///////////////////////////////////////////////////////////
+
+class ShadowMaps
+{
+public:
+    static constexpr int  MAX_CASCADES = 4;
+    static constexpr UINT SCROLL_STEPS = 8;  // a cascade scrolls by 1/SCROLL_STEPS of its width
+
+    ShadowMaps() {}
+    ~ShadowMaps();
+
+    // restrict a copying of this class instance
+    ShadowMaps(const ShadowMaps&) = delete;
+    ShadowMaps& operator=(const ShadowMaps&) = delete;
+
+    bool Initialize(ID3D11Device* pDevice, const ShadowParams& params);
+    void Shutdown();
+
+    // compute cascades by the camera (view/proj are NOT transposed) and the sun's
+    // direction; the cache of a cascade is invalidated if the cascade was scrolled,
+    // if the light was turned, or by isStaticChanged (static casters were changed)
+    void SetupCascades(
+        const DirectX::XMMATRIX& view,
+        const DirectX::XMMATRIX& proj,
+        const DirectX::XMFLOAT3& lightDir,
+        const bool isStaticChanged);
+
+    // shadows aren't cast (e.g. there is no sun)
+    void Disable(ID3D11DeviceContext* pContext);
+
+    // rendering of casters: Begin() => for each cascade: [BeginStaticCasters() =>
+    // render static casters] => BeginDynamicCasters() => render dynamic casters => End();
+    // NOTE: casters are rendered by the VS with the view-proj in b0 (as of the depth pre-pass)
+    void Begin              (ID3D11DeviceContext* pContext, const float gameTime);
+    void BeginStaticCasters (ID3D11DeviceContext* pContext, const int cascade);
+    void BeginDynamicCasters(ID3D11DeviceContext* pContext, const int cascade);
+
+    // restore targets and the VS const buffer of the camera; bind shadow maps for lit shaders
+    void End(ID3D11DeviceContext* pContext, ID3D11Buffer* pCameraVSCB);
+
+    // bind shadow maps to the compute shader stage by the same slots as for
+    // lit pixel shaders (for the deferred lighting)
+    void BindCS(ID3D11DeviceContext* pContext);
+
+    inline bool IsInitialized()  const { return isInit_; }
+    inline bool IsActive()       const { return isInit_ && isActive_; }
+
+    inline int                  GetNumCascades()            const { return params_.numCascades; }
+    inline const ShadowCascade& GetCascade(const int idx)   const { return cascades_[idx]; }
+    inline const ShadowParams&  GetParams()                 const { return params_; }
+    inline const ShadowStats&   GetStats()                  const { return stats_; }
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+private:
+    bool CreateMaps(ID3D11Device* pDevice);
+    void BindCascade(ID3D11DeviceContext* pContext, ID3D11DepthStencilView* pDSV, const int cascade);
+
+private:
+    ID3D11Texture2D*           pMaps_      = nullptr;        // a slice per cascade: static + dynamic casters
+    ID3D11Texture2D*           pCache_     = nullptr;        // a slice per cascade: static casters only
+    ID3D11DepthStencilView*    pMapDSVs_  [MAX_CASCADES]{ nullptr };
+    ID3D11DepthStencilView*    pCacheDSVs_[MAX_CASCADES]{ nullptr };
+    ID3D11ShaderResourceView*  pMapsSRV_   = nullptr;
+
+    SamplerState               cmpSampler_;                  // comparison (PCF)
+    ID3D11RasterizerState*     pRasterState_ = nullptr;      // slope scaled bias, no depth clip, no culling
+
+    ConstantBuffer<ConstBufType::cbvsPerFrame> cbCaster_;    // the light's view-proj for the VS of casters
+    ConstantBuffer<ConstBufType::cbShadows>    cbShadows_;   // for lit shaders
+
+    ShadowCascade              cascades_[MAX_CASCADES];
+    DirectX::XMFLOAT3          lightDir_ = { 0,0,0 };        // of the cached cascades
+
+    // targets of the scene which are restored by End()
+    ID3D11RenderTargetView*    pPrevRTV_ = nullptr;
+    ID3D11DepthStencilView*    pPrevDSV_ = nullptr;
+    D3D11_VIEWPORT             prevViewport_;
+    UINT                       numPrevViewports_ = 0;
+
+    StateCache*                pStateCache_ = nullptr;       // filters redundant binds (is owned by CRender)
+
+    ShadowParams               params_;
+    ShadowStats                stats_;
+    bool                       isActive_ = false;
+    bool                       isInit_   = false;
+};
+
+} // namespace Render
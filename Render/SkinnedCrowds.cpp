@@ -0,0 +1,254 @@
+// =================================================================================
+// Filename:     SkinnedCrowds.cpp
+// Description:  implementation of the SkinnedCrowds' functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "SkinnedCrowds.h"
+#include "Common/InputLayouts.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+
+using namespace DirectX;
+
+
+namespace Render
+{
+
+static_assert(sizeof(SkinnedInstance) == SkinnedCrowds::INSTANCE_SIZE, "size of instances must be the same as in InputLayoutSkinned");
+
+// slots of resources (must be the same as in SkinnedVS.hlsl)
+static constexpr UINT VS_ANIM_TEX_SLOT = 2;
+
+///////////////////////////////////////////////////////////
+
+SkinnedCrowds::~SkinnedCrowds()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool SkinnedCrowds::Initialize(ID3D11Device* pDevice, const UINT maxInstances)
+{
+    try
+    {
+        CAssert::True(maxInstances > 0, "max number of skinned instances must be > 0");
+
+        const InputLayoutSkinned inputLayout;
+
+        bool result = vs_.Initialize(pDevice, "shaders/SkinnedVS.cso", inputLayout.desc, inputLayout.numElem);
+        CAssert::True(result, "can't initialize the skinned vertex shader");
+
+        D3D11_BUFFER_DESC desc;
+        ZeroMemory(&desc, sizeof(desc));
+        desc.Usage          = D3D11_USAGE_DYNAMIC;
+        desc.ByteWidth      = maxInstances * INSTANCE_SIZE;
+        desc.BindFlags      = D3D11_BIND_VERTEX_BUFFER;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+        HRESULT hr = pDevice->CreateBuffer(&desc, nullptr, &pInstancesVB_);
+        CAssert::NotFailed(hr, "can't create a buffer of skinned instances");
+
+        capacity_ = maxInstances;
+        isInit_   = true;
+
+        LogMsgf("skinned crowds: capacity %u instances (%u KB)", maxInstances, (maxInstances * INSTANCE_SIZE) >> 10);
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the skinned crowds");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void SkinnedCrowds::Shutdown()
+{
+    ReleaseAnimSets();
+    SafeRelease(&pInstancesVB_);
+    vs_.Shutdown();
+
+    capacity_ = 0;
+    stats_    = SkinnedCrowdsStats();
+    isInit_   = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void SkinnedCrowds::ReleaseAnimSets()
+{
+    for (AnimSet& set : animSets_)
+    {
+        SafeRelease(&set.pTexSRV);
+        SafeRelease(&set.pTex);
+        SafeRelease(&set.pSkinVB);
+    }
+
+    animSets_.clear();
+}
+
+///////////////////////////////////////////////////////////
+
+int SkinnedCrowds::AddAnimSet(
+    ID3D11Device* pDevice,
+    const void* skin,
+    const UINT numVertices,
+    const XMFLOAT4* palettes,
+    const UINT numBones,
+    const UINT numFrames)
+{
+    AnimSet set;
+
+    try
+    {
+        CAssert::True(skin && palettes, "some of input ptrs == nullptr");
+        CAssert::True((numVertices > 0) && (numBones > 0) && (numFrames > 0), "invalid input args");
+        CAssert::True(numBones * TEXELS_PER_BONE <= MAX_TEX_WIDTH, "too many bones for the animation texture");
+        CAssert::True(numFrames <= D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION, "too many frames for the animation texture");
+
+        // skin weights go by the same idxs as vertices of the model
+        D3D11_BUFFER_DESC desc;
+        ZeroMemory(&desc, sizeof(desc));
+        desc.Usage     = D3D11_USAGE_IMMUTABLE;
+        desc.ByteWidth = numVertices * SKIN_STRIDE;
+        desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+        D3D11_SUBRESOURCE_DATA skinData = { skin, 0, 0 };
+
+        HRESULT hr = pDevice->CreateBuffer(&desc, &skinData, &set.pSkinVB);
+        CAssert::NotFailed(hr, "can't create a buffer of skin weights");
+
+        // a row per frame: all the bones of the frame
+        D3D11_TEXTURE2D_DESC texDesc;
+        ZeroMemory(&texDesc, sizeof(texDesc));
+        texDesc.Width            = numBones * TEXELS_PER_BONE;
+        texDesc.Height           = numFrames;
+        texDesc.MipLevels        = 1;
+        texDesc.ArraySize        = 1;
+        texDesc.Format           = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        texDesc.SampleDesc.Count = 1;
+        texDesc.Usage            = D3D11_USAGE_IMMUTABLE;
+        texDesc.BindFlags        = D3D11_BIND_SHADER_RESOURCE;
+
+        D3D11_SUBRESOURCE_DATA texData = { palettes, (UINT)(texDesc.Width * sizeof(XMFLOAT4)), 0 };
+
+        hr = pDevice->CreateTexture2D(&texDesc, &texData, &set.pTex);
+        CAssert::NotFailed(hr, "can't create an animation texture");
+
+        hr = pDevice->CreateShaderResourceView(set.pTex, nullptr, &set.pTexSRV);
+        CAssert::NotFailed(hr, "can't create a SRV of the animation texture");
+
+        animSets_.push_back(set);
+
+        stats_.numAnimSets = (uint32)animSets_.size();
+        stats_.texBytes   += texDesc.Width * texDesc.Height * (UINT)sizeof(XMFLOAT4);
+
+        return (int)animSets_.size() - 1;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't add an animation set of skinned crowds");
+
+        SafeRelease(&set.pTexSRV);
+        SafeRelease(&set.pTex);
+        SafeRelease(&set.pSkinVB);
+        return -1;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void SkinnedCrowds::UpdateInstances(
+    ID3D11DeviceContext* pContext,
+    const SkinnedInstance* instances,
+    const UINT numInstances)
+{
+    stats_.numInstances = 0;
+
+    if (!isInit_ || (numInstances == 0))
+        return;
+
+    const UINT numUsed = (numInstances < capacity_) ? numInstances : capacity_;
+    D3D11_MAPPED_SUBRESOURCE mapped;
+
+    if (FAILED(pContext->Map(pInstancesVB_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+    {
+        LogErr("can't map the buffer of skinned instances");
+        return;
+    }
+
+    memcpy(mapped.pData, instances, numUsed * sizeof(SkinnedInstance));
+    pContext->Unmap(pInstancesVB_, 0);
+
+    stats_.numInstances = numUsed;
+}
+
+///////////////////////////////////////////////////////////
+
+void SkinnedCrowds::Render(
+    ID3D11DeviceContext* pContext,
+    const SkinnedBatch* batches,
+    const UINT numBatches,
+    ID3D11PixelShader* pPS,
+    ID3D11SamplerState* pSampler)
+{
+    stats_.numBatches = 0;
+
+    if (!isInit_ || !batches || (numBatches == 0) || (stats_.numInstances == 0))
+        return;
+
+    pStateCache_->SetInputLayout(pContext, vs_.GetInputLayout());
+    pStateCache_->SetPrimitiveTopology(pContext, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    pStateCache_->SetVS(pContext, vs_.GetShader());
+    pStateCache_->SetGS(pContext, nullptr);
+    pStateCache_->SetPS(pContext, pPS);
+    pStateCache_->SetPSSamplers(pContext, 0, 1, &pSampler);
+
+    for (UINT i = 0; i < numBatches; ++i)
+    {
+        const SkinnedBatch& batch = batches[i];
+
+        // skip batches by a failed anim set or out of the written instances
+        if ((batch.animSet < 0) || (batch.animSet >= (int)animSets_.size()))
+            continue;
+
+        if (batch.startInstance + batch.numInstances > stats_.numInstances)
+            continue;
+
+        const AnimSet& set = animSets_[batch.animSet];
+
+        // skin weights go by the same vertex idxs as the model
+        // so both streams are offset by the base vertex of the draw
+        ID3D11Buffer* const vbs[3]     = { batch.pVB, set.pSkinVB, pInstancesVB_ };
+        const UINT          strides[3] = { batch.vertexStride, SKIN_STRIDE, INSTANCE_SIZE };
+        const UINT          offsets[3] = { 0, 0, 0 };
+
+        pStateCache_->SetVertexBuffers(pContext, 0, 3, vbs, strides, offsets);
+        pStateCache_->SetIndexBuffer(pContext, batch.pIB, batch.indexFormat, 0);
+        pStateCache_->SetVSShaderResources(pContext, VS_ANIM_TEX_SLOT, 1, &set.pTexSRV);
+        pStateCache_->SetPSShaderResources(pContext, 1U, NUM_TEXTURE_TYPES, batch.texSRVs);
+
+        pStateCache_->DrawIndexedInstanced(
+            pContext,
+            batch.indexCount,
+            batch.numInstances,
+            batch.startIndex,
+            batch.baseVertex,
+            batch.startInstance);
+
+        stats_.numBatches++;
+    }
+
+    // the slot is shared with other vertex shaders
+    ID3D11ShaderResourceView* nullSRV = nullptr;
+    pStateCache_->SetVSShaderResources(pContext, VS_ANIM_TEX_SLOT, 1, &nullSRV);
+}
+
+} // namespace Render
@@ -0,0 +1,143 @@
+// =================================================================================
+// Filename:     SkinnedCrowds.h
+// Description:  instanced rendering of skinned models (crowds):
+//
+//               - clips of a skinned model are baked at import into palettes of
+//                 a fixed rate; all of them are uploaded once as an animation
+//                 texture (a row per frame, 3 texels per bone: rows of the
+//                 affine skinning matrices), skin weights go into their own
+//                 vertex stream next to the model's vertex buffer;
+//               - per instance there is only its world, material and a pair of
+//                 frames to blend, so thousands of characters are drawn by a
+//                 single instanced draw per subset and the CPU cost doesn't
+//                 depend on the number of bones (there are no per-entity palettes
+//                 or constant buffers);
+//               - the vertex shader fetches 4 bones x 2 frames from the texture,
+//                 blends them and outputs the same data as the light VS so the
+//                 forward light PS is reused
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/VertexShader.h"
+#include "Common/RenderTypes.h"
+#include "StateCache.h"
+
+#include <Types.h>
+#include <cvector.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+
+namespace Render
+{
+
+// per instance data (must be the same as InputLayoutSkinned)
+struct SkinnedInstance
+{
+    DirectX::XMFLOAT4 world[3];             // rows of the transposed world matrix
+    uint32            materialIdx = 0;      // in the materials table
+    uint32            frame0      = 0;      // rows of the animation texture to blend
+    uint32            frame1      = 0;
+    float             frameLerp   = 0;      // 0 - frame0, 1 - frame1
+};
+
+// a draw of some subset of a skinned model by a range of instances
+struct SkinnedBatch
+{
+    int           animSet       = -1;       // a handle which is returned by AddAnimSet()
+    ID3D11Buffer* pVB           = nullptr;  // vertices of the model
+    ID3D11Buffer* pIB           = nullptr;
+    UINT          vertexStride  = 0;
+    DXGI_FORMAT   indexFormat   = DXGI_FORMAT_R32_UINT;
+    UINT          indexCount    = 0;
+    UINT          startIndex    = 0;
+    INT           baseVertex    = 0;        // the subset's first vertex (in both vertex and skin buffers)
+    UINT          startInstance = 0;
+    UINT          numInstances  = 0;
+    SRV*          texSRVs[NUM_TEXTURE_TYPES]{ nullptr };
+};
+
+struct SkinnedCrowdsStats
+{
+    uint32 numAnimSets  = 0;
+    uint32 numInstances = 0;                // instances of the last frame
+    uint32 numBatches   = 0;
+    uint32 texBytes     = 0;                // VRAM of all the animation textures
+};
+
+///////////////////////////////////////////////////////////
+
+class SkinnedCrowds
+{
+public:
+    static constexpr UINT INSTANCE_SIZE   = 64;  // sizeof(SkinnedInstance)
+    static constexpr UINT SKIN_STRIDE     = 8;   // 4 bone idxs (uint8) + 4 weights (unorm8)
+    static constexpr UINT TEXELS_PER_BONE = 3;   // rows of the 3x4 skinning matrix
+    static constexpr UINT MAX_TEX_WIDTH   = D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+
+    SkinnedCrowds() {}
+    ~SkinnedCrowds();
+
+    // restrict a copying of this class instance
+    SkinnedCrowds(const SkinnedCrowds&) = delete;
+    SkinnedCrowds& operator=(const SkinnedCrowds&) = delete;
+
+    // the shader is loaded from "shaders/SkinnedVS.cso"
+    bool Initialize(ID3D11Device* pDevice, const UINT maxInstances);
+    void Shutdown();
+
+    // upload skin weights and baked palettes of a skinned model;
+    // palettes: TEXELS_PER_BONE texels per bone, numBones per frame;
+    // ret: a handle of the animation set (-1 if failed)
+    int AddAnimSet(
+        ID3D11Device* pDevice,
+        const void* skin,
+        const UINT numVertices,
+        const DirectX::XMFLOAT4* palettes,
+        const UINT numBones,
+        const UINT numFrames);
+
+    // write instances of this frame (the prev ones are discarded)
+    void UpdateInstances(ID3D11DeviceContext* pContext, const SkinnedInstance* instances, const UINT numInstances);
+
+    // draw the batches by instances of the last update;
+    // the pixel shader is the caller's one (the light PS by default)
+    void Render(
+        ID3D11DeviceContext* pContext,
+        const SkinnedBatch* batches,
+        const UINT numBatches,
+        ID3D11PixelShader* pPS,
+        ID3D11SamplerState* pSampler);
+
+    inline bool IsInitialized() const { return isInit_; }
+    inline UINT GetCapacity()   const { return capacity_; }
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+    inline const SkinnedCrowdsStats& GetStats() const { return stats_; }
+
+private:
+    // resources of a single skinned model
+    struct AnimSet
+    {
+        ID3D11Buffer*             pSkinVB  = nullptr;
+        ID3D11Texture2D*          pTex     = nullptr;   // R32G32B32A32_FLOAT: (3 * numBones) x numFrames
+        ID3D11ShaderResourceView* pTexSRV  = nullptr;
+    };
+
+    void ReleaseAnimSets();
+
+private:
+    VertexShader       vs_;
+    ID3D11Buffer*      pInstancesVB_ = nullptr;         // dynamic: SkinnedInstance
+    StateCache*        pStateCache_  = nullptr;         // filters redundant binds (is owned by CRender)
+
+    cvector<AnimSet>   animSets_;
+    SkinnedCrowdsStats stats_;
+    UINT               capacity_     = 0;
+    bool               isInit_       = false;
+};
+
+} // namespace Render
@@ -0,0 +1,143 @@
+// =================================================================================
+// Filename:     SkyFogLut.cpp
+// Description:  implementation of the SkyFogLut's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "SkyFogLut.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+
+
+namespace Render
+{
+
+static_assert(sizeof(ConstBufType::cbSkyFog) % 16 == 0, "size of the const buffer must be a multiple of 16");
+
+///////////////////////////////////////////////////////////
+
+SkyFogLut::~SkyFogLut()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool SkyFogLut::Initialize(ID3D11Device* pDevice, const char* csFilePath)
+{
+    try
+    {
+        bool result = buildCS_.Initialize(pDevice, csFilePath);
+        CAssert::True(result, "can't initialize the compute shader");
+
+        // linear clamp: the cube map while building and the LUT itself by the lighting CS
+        D3D11_SAMPLER_DESC samplerDesc;
+        ZeroMemory(&samplerDesc, sizeof(samplerDesc));
+        samplerDesc.Filter         = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+        samplerDesc.AddressU       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressV       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressW       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+        samplerDesc.MaxLOD         = D3D11_FLOAT32_MAX;
+
+        result = samplerState_.Initialize(pDevice, &samplerDesc);
+        CAssert::True(result, "can't initialize the sampler state");
+
+        HRESULT hr = cbSkyFog_.Initialize(pDevice);
+        CAssert::NotFailed(hr, "can't initialize the const buffer of the sky fog LUT");
+
+        D3D11_TEXTURE2D_DESC desc;
+        ZeroMemory(&desc, sizeof(desc));
+        desc.Width            = SIZE;
+        desc.Height           = SIZE;
+        desc.MipLevels        = 1;
+        desc.ArraySize        = 1;
+        desc.Format           = DXGI_FORMAT_R8G8B8A8_UNORM;
+        desc.SampleDesc.Count = 1;
+        desc.Usage            = D3D11_USAGE_DEFAULT;
+        desc.BindFlags        = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+
+        hr = pDevice->CreateTexture2D(&desc, nullptr, &pLut_);
+        CAssert::NotFailed(hr, "can't create the sky fog LUT");
+
+        hr = pDevice->CreateShaderResourceView(pLut_, nullptr, &pLutSRV_);
+        CAssert::NotFailed(hr, "can't create a SRV of the sky fog LUT");
+
+        hr = pDevice->CreateUnorderedAccessView(pLut_, nullptr, &pLutUAV_);
+        CAssert::NotFailed(hr, "can't create a UAV of the sky fog LUT");
+
+        cbSkyFog_.data.lutSize    = SIZE;
+        cbSkyFog_.data.invLutSize = 1.0f / (float)SIZE;
+
+        isDirty_ = true;
+        isInit_  = true;
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the sky fog LUT");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void SkyFogLut::Shutdown()
+{
+    SafeRelease(&pLutUAV_);
+    SafeRelease(&pLutSRV_);
+    SafeRelease(&pLut_);
+
+    buildCS_.Shutdown();
+    pBuiltSkySRV_ = nullptr;
+    isInit_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void SkyFogLut::Update(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSkyCubeSRV)
+{
+    if (!isInit_)
+        return;
+
+    if (pSkyCubeSRV && (isDirty_ || (pSkyCubeSRV != pBuiltSkySRV_)))
+        Build(pContext, pSkyCubeSRV);
+
+    pStateCache_->SetPSShaderResources(pContext, SLOT, 1, &pLutSRV_);
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+void SkyFogLut::Build(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSkyCubeSRV)
+{
+    // the LUT can be bound for lit shaders since the prev frame
+    pStateCache_->UnbindShaderResource(pContext, pLutSRV_);
+
+    ID3D11ShaderResourceView*  nullSRV = nullptr;
+    ID3D11UnorderedAccessView* nullUAV = nullptr;
+
+    cbSkyFog_.ApplyChanges(pContext);
+
+    pContext->CSSetShader(buildCS_.GetShader(), nullptr, 0);
+    pContext->CSSetConstantBuffers(0, 1, cbSkyFog_.GetAddressOf());
+    pContext->CSSetShaderResources(0, 1, &pSkyCubeSRV);
+    pContext->CSSetSamplers(0, 1, samplerState_.GetAddressOf());
+    pContext->CSSetUnorderedAccessViews(0, 1, &pLutUAV_, nullptr);
+
+    // thread group is 8x8
+    pContext->Dispatch((SIZE + 7) / 8, (SIZE + 7) / 8, 1);
+
+    pContext->CSSetShaderResources(0, 1, &nullSRV);
+    pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+    pContext->CSSetShader(nullptr, nullptr, 0);
+
+    pBuiltSkySRV_ = pSkyCubeSRV;
+    isDirty_      = false;
+}
+
+} // namespace Render
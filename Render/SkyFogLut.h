@@ -0,0 +1,76 @@
+// =================================================================================
+// Filename:     SkyFogLut.h
+// Description:  a tiny LUT of the sky color along view directions for the fog:
+//
+//               - the sky cube map is sampled along octahedral directions of
+//                 SIZE x SIZE texels by a compute shader;
+//               - the LUT is rebuilt only if the sky is changed (the gradient,
+//                 the colors or the cube map itself), so lit shaders blend fogged
+//                 pixels into the sky by a fetch of a cache-resident texture
+//                 instead of the sky cube map
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/ComputeShader.h"
+#include "Shaders/SamplerState.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "StateCache.h"
+
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+class SkyFogLut
+{
+public:
+    static constexpr UINT SIZE = 32;           // must be the same as in SkyFog.hlsli
+    static constexpr UINT SLOT = 31;           // PS (and CS) slot of the LUT
+
+    SkyFogLut() {}
+    ~SkyFogLut();
+
+    // restrict a copying of this class instance
+    SkyFogLut(const SkyFogLut&) = delete;
+    SkyFogLut& operator=(const SkyFogLut&) = delete;
+
+    bool Initialize(ID3D11Device* pDevice, const char* csFilePath);
+    void Shutdown();
+
+    // rebuild the LUT if it was invalidated or the sky cube map is another one
+    // and bind it to the pixel shader stage
+    void Update(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSkyCubeSRV);
+
+    // the sky is changed (the gradient or the config of the sky)
+    inline void Invalidate() { isDirty_ = true; }
+
+    inline bool                      IsInitialized() const { return isInit_; }
+    inline ID3D11ShaderResourceView* GetSRV()        const { return pLutSRV_; }
+    inline ID3D11SamplerState* const* GetSampler()         { return samplerState_.GetAddressOf(); }
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+private:
+    void Build(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSkyCubeSRV);
+
+private:
+    ComputeShader                          buildCS_;
+    SamplerState                           samplerState_;
+    ConstantBuffer<ConstBufType::cbSkyFog> cbSkyFog_;
+
+    ID3D11Texture2D*            pLut_    = nullptr;
+    ID3D11ShaderResourceView*   pLutSRV_ = nullptr;
+    ID3D11UnorderedAccessView*  pLutUAV_ = nullptr;
+
+    ID3D11ShaderResourceView*   pBuiltSkySRV_ = nullptr;   // the cube map of the built LUT (isn't owned)
+
+    StateCache*                 pStateCache_ = nullptr;    // filters redundant binds (is owned by CRender)
+    bool                        isDirty_ = true;
+    bool                        isInit_  = false;
+};
+
+} // namespace Render
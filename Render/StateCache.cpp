@@ -0,0 +1,655 @@
+// =================================================================================
+// Filename:     StateCache.cpp
+// Description:  implementation of the StateCache's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "StateCache.h"
+#include "FrameStats.h"
+
+
+namespace Render
+{
+
+static const char* s_BindTypeNames[StateCache::NUM_BIND_TYPES] =
+{
+    "input assembler",
+    "shaders",
+    "const buffers",
+    "SRVs",
+    "samplers",
+    "render states",
+};
+
+//---------------------------------------------------------
+// Desc:   a value of the shadowed ptr which is never equal to a real object
+//         (so the next bind of the slot is issued anyway)
+//---------------------------------------------------------
+template <typename T>
+static inline T* Unknown()
+{
+    return reinterpret_cast<T*>(~(uintptr_t)0);
+}
+
+//---------------------------------------------------------
+// Desc:   compare input objects with the shadowed slots and update them;
+//         out:    a sub range of slots which must be really bound
+//         return: false if all the slots are already bound
+//---------------------------------------------------------
+template <typename T>
+static bool FilterSlots(
+    T** shadow,
+    const UINT numShadowSlots,
+    const UINT startSlot,
+    const UINT num,
+    T* const* objs,
+    UINT& outStart,
+    UINT& outNum)
+{
+    // the range goes out of the shadow: bind it as is
+    if (startSlot + num > numShadowSlots)
+    {
+        for (UINT i = startSlot; i < numShadowSlots; ++i)
+            shadow[i] = objs[i - startSlot];
+
+        outStart = startSlot;
+        outNum   = num;
+        return true;
+    }
+
+    UINT first = num;
+    UINT last  = 0;
+
+    for (UINT i = 0; i < num; ++i)
+    {
+        if (shadow[startSlot + i] == objs[i])
+            continue;
+
+        shadow[startSlot + i] = objs[i];
+        first = (i < first) ? i : first;
+        last  = i;
+    }
+
+    if (first == num)
+        return false;
+
+    outStart = startSlot + first;
+    outNum   = last - first + 1;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+StateCache::StateCache()
+{
+    Invalidate();
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetContext(ID3D11DeviceContext* pContext)
+{
+    pContext_ = pContext;
+    Invalidate();
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::Invalidate()
+{
+    pLayout_  = Unknown<ID3D11InputLayout>();
+    topology_ = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+    for (UINT i = 0; i < NUM_VB_SLOTS; ++i)
+        vbs_[i] = Unknown<ID3D11Buffer>();
+
+    pIB_      = Unknown<ID3D11Buffer>();
+    pVS_      = Unknown<ID3D11VertexShader>();
+    pGS_      = Unknown<ID3D11GeometryShader>();
+    pPS_      = Unknown<ID3D11PixelShader>();
+
+    for (UINT i = 0; i < NUM_CB_SLOTS; ++i)
+    {
+        vsCBs_[i] = Unknown<ID3D11Buffer>();
+        gsCBs_[i] = Unknown<ID3D11Buffer>();
+        psCBs_[i] = Unknown<ID3D11Buffer>();
+    }
+
+    for (UINT i = 0; i < NUM_SRV_SLOTS; ++i)
+    {
+        vsSRVs_[i] = Unknown<ID3D11ShaderResourceView>();
+        psSRVs_[i] = Unknown<ID3D11ShaderResourceView>();
+    }
+
+    for (UINT i = 0; i < NUM_SAMPLER_SLOTS; ++i)
+        psSamplers_[i] = Unknown<ID3D11SamplerState>();
+
+    pRS_  = Unknown<ID3D11RasterizerState>();
+    pBS_  = Unknown<ID3D11BlendState>();
+    pDSS_ = Unknown<ID3D11DepthStencilState>();
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::EndFrame()
+{
+    lastFrameStats_ = stats_;
+    stats_          = Stats();
+}
+
+///////////////////////////////////////////////////////////
+
+const char* StateCache::GetBindTypeName(const eBindType type)
+{
+    return s_BindTypeNames[type];
+}
+
+
+// =================================================================================
+// input assembler
+// =================================================================================
+void StateCache::SetInputLayout(ID3D11DeviceContext* pContext, ID3D11InputLayout* pLayout)
+{
+    if (IsTracked(pContext))
+    {
+        if (pLayout_ == pLayout)
+        {
+            CountFiltered(BIND_INPUT_ASSEMBLER);
+            return;
+        }
+        pLayout_ = pLayout;
+        CountIssued(BIND_INPUT_ASSEMBLER);
+    }
+
+    pContext->IASetInputLayout(pLayout);
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetPrimitiveTopology(
+    ID3D11DeviceContext* pContext,
+    const D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+    if (IsTracked(pContext))
+    {
+        if (topology_ == topology)
+        {
+            CountFiltered(BIND_INPUT_ASSEMBLER);
+            return;
+        }
+        topology_ = topology;
+        CountIssued(BIND_INPUT_ASSEMBLER);
+    }
+
+    pContext->IASetPrimitiveTopology(topology);
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetIndexBuffer(
+    ID3D11DeviceContext* pContext,
+    ID3D11Buffer* pIB,
+    const DXGI_FORMAT format,
+    const UINT offset)
+{
+    if (IsTracked(pContext))
+    {
+        if ((pIB_ == pIB) && (ibFormat_ == format) && (ibOffset_ == offset))
+        {
+            CountFiltered(BIND_INPUT_ASSEMBLER);
+            return;
+        }
+        pIB_      = pIB;
+        ibFormat_ = format;
+        ibOffset_ = offset;
+        CountIssued(BIND_INPUT_ASSEMBLER);
+    }
+
+    pContext->IASetIndexBuffer(pIB, format, offset);
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetVertexBuffers(
+    ID3D11DeviceContext* pContext,
+    const UINT startSlot,
+    const UINT numBuffers,
+    ID3D11Buffer* const* ppVBs,
+    const UINT* strides,
+    const UINT* offsets)
+{
+    if (!IsTracked(pContext))
+    {
+        pContext->IASetVertexBuffers(startSlot, numBuffers, ppVBs, strides, offsets);
+        return;
+    }
+
+    // the range goes out of the shadow: bind it as is
+    if (startSlot + numBuffers > NUM_VB_SLOTS)
+    {
+        for (UINT i = startSlot; i < NUM_VB_SLOTS; ++i)
+            vbs_[i] = Unknown<ID3D11Buffer>();
+
+        pContext->IASetVertexBuffers(startSlot, numBuffers, ppVBs, strides, offsets);
+        CountIssued(BIND_INPUT_ASSEMBLER);
+        return;
+    }
+
+    UINT first = numBuffers;
+    UINT last  = 0;
+
+    for (UINT i = 0; i < numBuffers; ++i)
+    {
+        const UINT slot = startSlot + i;
+
+        if ((vbs_[slot] == ppVBs[i]) && (vbStrides_[slot] == strides[i]) && (vbOffsets_[slot] == offsets[i]))
+            continue;
+
+        vbs_[slot]       = ppVBs[i];
+        vbStrides_[slot] = strides[i];
+        vbOffsets_[slot] = offsets[i];
+
+        first = (i < first) ? i : first;
+        last  = i;
+    }
+
+    if (first == numBuffers)
+    {
+        CountFiltered(BIND_INPUT_ASSEMBLER);
+        return;
+    }
+
+    pContext->IASetVertexBuffers(
+        startSlot + first,
+        last - first + 1,
+        ppVBs   + first,
+        strides + first,
+        offsets + first);
+
+    CountIssued(BIND_INPUT_ASSEMBLER);
+}
+
+
+// =================================================================================
+// shaders
+// =================================================================================
+void StateCache::SetVS(ID3D11DeviceContext* pContext, ID3D11VertexShader* pVS)
+{
+    if (IsTracked(pContext))
+    {
+        if (pVS_ == pVS)
+        {
+            CountFiltered(BIND_SHADER);
+            return;
+        }
+        pVS_ = pVS;
+        CountIssued(BIND_SHADER);
+    }
+
+    pContext->VSSetShader(pVS, nullptr, 0);
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetGS(ID3D11DeviceContext* pContext, ID3D11GeometryShader* pGS)
+{
+    if (IsTracked(pContext))
+    {
+        if (pGS_ == pGS)
+        {
+            CountFiltered(BIND_SHADER);
+            return;
+        }
+        pGS_ = pGS;
+        CountIssued(BIND_SHADER);
+    }
+
+    pContext->GSSetShader(pGS, nullptr, 0);
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetPS(ID3D11DeviceContext* pContext, ID3D11PixelShader* pPS)
+{
+    if (IsTracked(pContext))
+    {
+        if (pPS_ == pPS)
+        {
+            CountFiltered(BIND_SHADER);
+            return;
+        }
+        pPS_ = pPS;
+        CountIssued(BIND_SHADER);
+    }
+
+    pContext->PSSetShader(pPS, nullptr, 0);
+}
+
+
+// =================================================================================
+// resources
+// =================================================================================
+void StateCache::SetVSConstantBuffers(
+    ID3D11DeviceContext* pContext,
+    const UINT startSlot,
+    const UINT numBuffers,
+    ID3D11Buffer* const* ppCBs)
+{
+    UINT start = startSlot;
+    UINT num   = numBuffers;
+
+    if (IsTracked(pContext))
+    {
+        if (!FilterSlots(vsCBs_, NUM_CB_SLOTS, startSlot, numBuffers, ppCBs, start, num))
+        {
+            CountFiltered(BIND_CONST_BUFFER);
+            return;
+        }
+        CountIssued(BIND_CONST_BUFFER);
+    }
+
+    pContext->VSSetConstantBuffers(start, num, ppCBs + (start - startSlot));
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetGSConstantBuffers(
+    ID3D11DeviceContext* pContext,
+    const UINT startSlot,
+    const UINT numBuffers,
+    ID3D11Buffer* const* ppCBs)
+{
+    UINT start = startSlot;
+    UINT num   = numBuffers;
+
+    if (IsTracked(pContext))
+    {
+        if (!FilterSlots(gsCBs_, NUM_CB_SLOTS, startSlot, numBuffers, ppCBs, start, num))
+        {
+            CountFiltered(BIND_CONST_BUFFER);
+            return;
+        }
+        CountIssued(BIND_CONST_BUFFER);
+    }
+
+    pContext->GSSetConstantBuffers(start, num, ppCBs + (start - startSlot));
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetPSConstantBuffers(
+    ID3D11DeviceContext* pContext,
+    const UINT startSlot,
+    const UINT numBuffers,
+    ID3D11Buffer* const* ppCBs)
+{
+    UINT start = startSlot;
+    UINT num   = numBuffers;
+
+    if (IsTracked(pContext))
+    {
+        if (!FilterSlots(psCBs_, NUM_CB_SLOTS, startSlot, numBuffers, ppCBs, start, num))
+        {
+            CountFiltered(BIND_CONST_BUFFER);
+            return;
+        }
+        CountIssued(BIND_CONST_BUFFER);
+    }
+
+    pContext->PSSetConstantBuffers(start, num, ppCBs + (start - startSlot));
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::ForgetVSConstantBuffer(const UINT slot)
+{
+    if (slot < NUM_CB_SLOTS)
+        vsCBs_[slot] = Unknown<ID3D11Buffer>();
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::ForgetPSConstantBuffer(const UINT slot)
+{
+    if (slot < NUM_CB_SLOTS)
+        psCBs_[slot] = Unknown<ID3D11Buffer>();
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetVSShaderResources(
+    ID3D11DeviceContext* pContext,
+    const UINT startSlot,
+    const UINT numViews,
+    ID3D11ShaderResourceView* const* ppSRVs)
+{
+    UINT start = startSlot;
+    UINT num   = numViews;
+
+    if (IsTracked(pContext))
+    {
+        if (!FilterSlots(vsSRVs_, NUM_SRV_SLOTS, startSlot, numViews, ppSRVs, start, num))
+        {
+            CountFiltered(BIND_SRV);
+            return;
+        }
+        CountIssued(BIND_SRV);
+    }
+
+    pContext->VSSetShaderResources(start, num, ppSRVs + (start - startSlot));
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetPSShaderResources(
+    ID3D11DeviceContext* pContext,
+    const UINT startSlot,
+    const UINT numViews,
+    ID3D11ShaderResourceView* const* ppSRVs)
+{
+    UINT start = startSlot;
+    UINT num   = numViews;
+
+    if (IsTracked(pContext))
+    {
+        if (!FilterSlots(psSRVs_, NUM_SRV_SLOTS, startSlot, numViews, ppSRVs, start, num))
+        {
+            CountFiltered(BIND_SRV);
+            return;
+        }
+        CountIssued(BIND_SRV);
+    }
+
+    pContext->PSSetShaderResources(start, num, ppSRVs + (start - startSlot));
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::UnbindShaderResource(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSRV)
+{
+    if (!pSRV || !IsTracked(pContext))
+        return;
+
+    ID3D11ShaderResourceView* nullSRV = nullptr;
+
+    for (UINT i = 0; i < NUM_SRV_SLOTS; ++i)
+    {
+        if (vsSRVs_[i] == pSRV)
+            SetVSShaderResources(pContext, i, 1, &nullSRV);
+
+        if (psSRVs_[i] == pSRV)
+            SetPSShaderResources(pContext, i, 1, &nullSRV);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetPSSamplers(
+    ID3D11DeviceContext* pContext,
+    const UINT startSlot,
+    const UINT numSamplers,
+    ID3D11SamplerState* const* ppSamplers)
+{
+    UINT start = startSlot;
+    UINT num   = numSamplers;
+
+    if (IsTracked(pContext))
+    {
+        if (!FilterSlots(psSamplers_, NUM_SAMPLER_SLOTS, startSlot, numSamplers, ppSamplers, start, num))
+        {
+            CountFiltered(BIND_SAMPLER);
+            return;
+        }
+        CountIssued(BIND_SAMPLER);
+    }
+
+    pContext->PSSetSamplers(start, num, ppSamplers + (start - startSlot));
+}
+
+
+// =================================================================================
+// rasterizer / output merger
+// =================================================================================
+void StateCache::SetRasterState(ID3D11DeviceContext* pContext, ID3D11RasterizerState* pRS)
+{
+    if (IsTracked(pContext))
+    {
+        if (pRS_ == pRS)
+        {
+            CountFiltered(BIND_RENDER_STATE);
+            return;
+        }
+        pRS_ = pRS;
+        CountIssued(BIND_RENDER_STATE);
+    }
+
+    pContext->RSSetState(pRS);
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetBlendState(
+    ID3D11DeviceContext* pContext,
+    ID3D11BlendState* pBS,
+    const FLOAT* blendFactor,
+    const UINT sampleMask)
+{
+    if (IsTracked(pContext))
+    {
+        // NULL blend factor is the same as { 1,1,1,1 }
+        const FLOAT ones[4] = { 1,1,1,1 };
+        const FLOAT* factor = (blendFactor) ? blendFactor : ones;
+
+        const bool isSameFactor =
+            (blendFactor_[0] == factor[0]) &&
+            (blendFactor_[1] == factor[1]) &&
+            (blendFactor_[2] == factor[2]) &&
+            (blendFactor_[3] == factor[3]);
+
+        if ((pBS_ == pBS) && isSameFactor && (sampleMask_ == sampleMask))
+        {
+            CountFiltered(BIND_RENDER_STATE);
+            return;
+        }
+
+        pBS_ = pBS;
+        blendFactor_[0] = factor[0];
+        blendFactor_[1] = factor[1];
+        blendFactor_[2] = factor[2];
+        blendFactor_[3] = factor[3];
+        sampleMask_ = sampleMask;
+        CountIssued(BIND_RENDER_STATE);
+    }
+
+    pContext->OMSetBlendState(pBS, blendFactor, sampleMask);
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::SetDepthStencilState(
+    ID3D11DeviceContext* pContext,
+    ID3D11DepthStencilState* pDSS,
+    const UINT stencilRef)
+{
+    if (IsTracked(pContext))
+    {
+        if ((pDSS_ == pDSS) && (stencilRef_ == stencilRef))
+        {
+            CountFiltered(BIND_RENDER_STATE);
+            return;
+        }
+        pDSS_       = pDSS;
+        stencilRef_ = stencilRef;
+        CountIssued(BIND_RENDER_STATE);
+    }
+
+    pContext->OMSetDepthStencilState(pDSS, stencilRef);
+}
+
+
+
+// =================================================================================
+// draw calls
+// =================================================================================
+void StateCache::Draw(ID3D11DeviceContext* pContext, const UINT vertexCount, const UINT startVertex)
+{
+    pContext->Draw(vertexCount, startVertex);
+    g_FrameStats.AddDraw(vertexCount, 1, GetTopology(pContext));
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::DrawIndexed(
+    ID3D11DeviceContext* pContext,
+    const UINT indexCount,
+    const UINT startIndex,
+    const INT baseVertex)
+{
+    pContext->DrawIndexed(indexCount, startIndex, baseVertex);
+    g_FrameStats.AddDraw(indexCount, 1, GetTopology(pContext));
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::DrawInstanced(
+    ID3D11DeviceContext* pContext,
+    const UINT vertexCount,
+    const UINT instanceCount,
+    const UINT startVertex,
+    const UINT startInstance)
+{
+    pContext->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+    g_FrameStats.AddDraw(vertexCount, instanceCount, GetTopology(pContext));
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::DrawIndexedInstanced(
+    ID3D11DeviceContext* pContext,
+    const UINT indexCount,
+    const UINT instanceCount,
+    const UINT startIndex,
+    const INT baseVertex,
+    const UINT startInstance)
+{
+    pContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+    g_FrameStats.AddDraw(indexCount, instanceCount, GetTopology(pContext));
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::DrawInstancedIndirect(ID3D11DeviceContext* pContext, ID3D11Buffer* pArgs, const UINT argsOffset)
+{
+    pContext->DrawInstancedIndirect(pArgs, argsOffset);
+    g_FrameStats.AddIndirectDraw();
+}
+
+///////////////////////////////////////////////////////////
+
+void StateCache::DrawIndexedInstancedIndirect(ID3D11DeviceContext* pContext, ID3D11Buffer* pArgs, const UINT argsOffset)
+{
+    pContext->DrawIndexedInstancedIndirect(pArgs, argsOffset);
+    g_FrameStats.AddIndirectDraw();
+}
+
+} // namespace Render
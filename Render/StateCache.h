@@ -0,0 +1,172 @@
+// =================================================================================
+// Filename:     StateCache.h
+// Description:  a thin layer in front of the immediate context which shadows
+//               the currently bound pipeline state and skips redundant binds
+//               (input layout, topology, VB/IB, shaders, CBs, SRVs, samplers,
+//               RS/BS/DSS):
+//
+//               - all the binds of these slots on the immediate context must go
+//                 through the cache (or the cache must be invalidated after them);
+//               - binds on other contexts (deferred) are passed through as is
+//                 and aren't counted;
+//               - a bind of slots range is trimmed to the actually changed slots
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+class StateCache
+{
+public:
+    static constexpr UINT NUM_VB_SLOTS      = 4;
+    static constexpr UINT NUM_CB_SLOTS      = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+    static constexpr UINT NUM_SRV_SLOTS     = 32;           // we don't bind resources into higher slots
+    static constexpr UINT NUM_SAMPLER_SLOTS = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+
+    enum eBindType
+    {
+        BIND_INPUT_ASSEMBLER,          // input layout, topology, vertex/index buffers
+        BIND_SHADER,
+        BIND_CONST_BUFFER,
+        BIND_SRV,
+        BIND_SAMPLER,
+        BIND_RENDER_STATE,             // rasterizer, blend, depth stencil states
+
+        NUM_BIND_TYPES,
+    };
+
+    struct Stats
+    {
+        uint32 numIssued   = 0;        // calls which went to the context
+        uint32 numFiltered = 0;        // redundant calls which were skipped
+
+        uint32 issued[NUM_BIND_TYPES]{ 0 };
+        uint32 filtered[NUM_BIND_TYPES]{ 0 };
+    };
+
+public:
+    StateCache();
+
+    // restrict a copying of this class instance
+    StateCache(const StateCache&) = delete;
+    StateCache& operator=(const StateCache&) = delete;
+
+    // set a context which state is shadowed (the immediate one)
+    void SetContext(ID3D11DeviceContext* pContext);
+
+    // forget the shadowed state so the next binds will be issued anyway
+    // (call it after someone binds the state directly)
+    void Invalidate();
+
+    // counters of this frame become stats of the last frame
+    void EndFrame();
+
+    inline const Stats& GetLastFrameStats() const { return lastFrameStats_; }
+
+    static const char* GetBindTypeName(const eBindType type);
+
+    // input assembler
+    void SetInputLayout      (ID3D11DeviceContext* pContext, ID3D11InputLayout* pLayout);
+    void SetPrimitiveTopology(ID3D11DeviceContext* pContext, const D3D11_PRIMITIVE_TOPOLOGY topology);
+    void SetIndexBuffer      (ID3D11DeviceContext* pContext, ID3D11Buffer* pIB, const DXGI_FORMAT format, const UINT offset);
+
+    void SetVertexBuffers(
+        ID3D11DeviceContext* pContext,
+        const UINT startSlot,
+        const UINT numBuffers,
+        ID3D11Buffer* const* ppVBs,
+        const UINT* strides,
+        const UINT* offsets);
+
+    // shaders
+    void SetVS(ID3D11DeviceContext* pContext, ID3D11VertexShader*   pVS);
+    void SetGS(ID3D11DeviceContext* pContext, ID3D11GeometryShader* pGS);
+    void SetPS(ID3D11DeviceContext* pContext, ID3D11PixelShader*    pPS);
+
+    // resources
+    void SetVSConstantBuffers(ID3D11DeviceContext* pContext, const UINT startSlot, const UINT numBuffers, ID3D11Buffer* const* ppCBs);
+    void SetGSConstantBuffers(ID3D11DeviceContext* pContext, const UINT startSlot, const UINT numBuffers, ID3D11Buffer* const* ppCBs);
+    void SetPSConstantBuffers(ID3D11DeviceContext* pContext, const UINT startSlot, const UINT numBuffers, ID3D11Buffer* const* ppCBs);
+
+    // the slot was bound directly (e.g. a range by *SetConstantBuffers1) so the next bind is issued anyway
+    void ForgetVSConstantBuffer(const UINT slot);
+    void ForgetPSConstantBuffer(const UINT slot);
+
+    void SetVSShaderResources(ID3D11DeviceContext* pContext, const UINT startSlot, const UINT numViews, ID3D11ShaderResourceView* const* ppSRVs);
+    void SetPSShaderResources(ID3D11DeviceContext* pContext, const UINT startSlot, const UINT numViews, ID3D11ShaderResourceView* const* ppSRVs);
+
+    void SetPSSamplers(ID3D11DeviceContext* pContext, const UINT startSlot, const UINT numSamplers, ID3D11SamplerState* const* ppSamplers);
+
+    // unbind the view from all the VS/PS slots where it is bound (before its resource
+    // is bound as a render target or a depth buffer)
+    void UnbindShaderResource(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSRV);
+
+    // rasterizer / output merger
+    void SetRasterState      (ID3D11DeviceContext* pContext, ID3D11RasterizerState* pRS);
+    void SetBlendState       (ID3D11DeviceContext* pContext, ID3D11BlendState* pBS, const FLOAT* blendFactor, const UINT sampleMask);
+    void SetDepthStencilState(ID3D11DeviceContext* pContext, ID3D11DepthStencilState* pDSS, const UINT stencilRef);
+
+    // draw calls: they are counted into g_FrameStats (primitives are counted by
+    // the shadowed topology; draws of deferred contexts are counted as triangle lists)
+    void Draw                        (ID3D11DeviceContext* pContext, const UINT vertexCount, const UINT startVertex);
+    void DrawIndexed                 (ID3D11DeviceContext* pContext, const UINT indexCount, const UINT startIndex, const INT baseVertex);
+    void DrawInstanced               (ID3D11DeviceContext* pContext, const UINT vertexCount, const UINT instanceCount, const UINT startVertex, const UINT startInstance);
+    void DrawIndexedInstanced        (ID3D11DeviceContext* pContext, const UINT indexCount, const UINT instanceCount, const UINT startIndex, const INT baseVertex, const UINT startInstance);
+    void DrawInstancedIndirect       (ID3D11DeviceContext* pContext, ID3D11Buffer* pArgs, const UINT argsOffset);
+    void DrawIndexedInstancedIndirect(ID3D11DeviceContext* pContext, ID3D11Buffer* pArgs, const UINT argsOffset);
+
+private:
+    inline bool IsTracked(ID3D11DeviceContext* pContext) const { return (pContext == pContext_); }
+
+    inline void CountIssued(const eBindType type)   { stats_.numIssued++;   stats_.issued[type]++; }
+    inline void CountFiltered(const eBindType type) { stats_.numFiltered++; stats_.filtered[type]++; }
+
+    inline D3D11_PRIMITIVE_TOPOLOGY GetTopology(ID3D11DeviceContext* pContext) const
+    {
+        return IsTracked(pContext) ? topology_ : D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    }
+
+private:
+    ID3D11DeviceContext*        pContext_ = nullptr;
+
+    ID3D11InputLayout*          pLayout_  = nullptr;
+    D3D11_PRIMITIVE_TOPOLOGY    topology_ = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+    ID3D11Buffer*               vbs_[NUM_VB_SLOTS];
+    UINT                        vbStrides_[NUM_VB_SLOTS];
+    UINT                        vbOffsets_[NUM_VB_SLOTS];
+
+    ID3D11Buffer*               pIB_      = nullptr;
+    DXGI_FORMAT                 ibFormat_ = DXGI_FORMAT_UNKNOWN;
+    UINT                        ibOffset_ = 0;
+
+    ID3D11VertexShader*         pVS_ = nullptr;
+    ID3D11GeometryShader*       pGS_ = nullptr;
+    ID3D11PixelShader*          pPS_ = nullptr;
+
+    ID3D11Buffer*               vsCBs_[NUM_CB_SLOTS];
+    ID3D11Buffer*               gsCBs_[NUM_CB_SLOTS];
+    ID3D11Buffer*               psCBs_[NUM_CB_SLOTS];
+    ID3D11ShaderResourceView*   vsSRVs_[NUM_SRV_SLOTS];
+    ID3D11ShaderResourceView*   psSRVs_[NUM_SRV_SLOTS];
+    ID3D11SamplerState*         psSamplers_[NUM_SAMPLER_SLOTS];
+
+    ID3D11RasterizerState*      pRS_  = nullptr;
+    ID3D11BlendState*           pBS_  = nullptr;
+    ID3D11DepthStencilState*    pDSS_ = nullptr;
+    FLOAT                       blendFactor_[4] = { 1,1,1,1 };
+    UINT                        sampleMask_ = 0xffffffff;
+    UINT                        stencilRef_ = 0;
+
+    Stats                       stats_;
+    Stats                       lastFrameStats_;
+};
+
+} // namespace Render
@@ -0,0 +1,268 @@
+// =================================================================================
+// Filename:     StaticBatches.cpp
+// Description:  implementation of the StaticBatches' functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "StaticBatches.h"
+#include <MemHelpers.h>
+#include <cvector.h>
+#include <log.h>
+#include <CAssert.h>
+
+
+namespace Render
+{
+
+// the gather shader copies records by 16 bytes
+static_assert(StaticBatches::INSTANCE_SIZE % 16 == 0, "size of the instance record must be a multiple of 16");
+
+//---------------------------------------------------------
+// Desc:   create a raw SRV or UAV of the whole buffer
+//---------------------------------------------------------
+static HRESULT CreateRawSRV(ID3D11Device* pDevice, ID3D11Buffer* pBuffer, const UINT byteWidth, ID3D11ShaderResourceView** ppSRV)
+{
+    D3D11_SHADER_RESOURCE_VIEW_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+
+    desc.Format                = DXGI_FORMAT_R32_TYPELESS;
+    desc.ViewDimension         = D3D11_SRV_DIMENSION_BUFFEREX;
+    desc.BufferEx.FirstElement = 0;
+    desc.BufferEx.NumElements  = byteWidth / 4;
+    desc.BufferEx.Flags        = D3D11_BUFFEREX_SRV_FLAG_RAW;
+
+    return pDevice->CreateShaderResourceView(pBuffer, &desc, ppSRV);
+}
+
+static HRESULT CreateRawUAV(ID3D11Device* pDevice, ID3D11Buffer* pBuffer, const UINT byteWidth, ID3D11UnorderedAccessView** ppUAV)
+{
+    D3D11_UNORDERED_ACCESS_VIEW_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+
+    desc.Format              = DXGI_FORMAT_R32_TYPELESS;
+    desc.ViewDimension       = D3D11_UAV_DIMENSION_BUFFER;
+    desc.Buffer.FirstElement = 0;
+    desc.Buffer.NumElements  = byteWidth / 4;
+    desc.Buffer.Flags        = D3D11_BUFFER_UAV_FLAG_RAW;
+
+    return pDevice->CreateUnorderedAccessView(pBuffer, &desc, ppUAV);
+}
+
+///////////////////////////////////////////////////////////
+
+StaticBatches::~StaticBatches()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool StaticBatches::Initialize(ID3D11Device* pDevice, const char* shaderPath)
+{
+    if (!gatherCS_.Initialize(pDevice, shaderPath))
+    {
+        LogErr("can't initialize a compute shader for static batches");
+        return false;
+    }
+
+    if (FAILED(cbGather_.Initialize(pDevice)))
+    {
+        LogErr("can't initialize a const buffer for static batches");
+        gatherCS_.Shutdown();
+        return false;
+    }
+
+    isInit_ = true;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void StaticBatches::Shutdown()
+{
+    ReleaseRecords();
+    ReleaseVisible();
+    gatherCS_.Shutdown();
+    isInit_ = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void StaticBatches::ReleaseRecords()
+{
+    SafeRelease(&pRecordsSRV_);
+    SafeRelease(&pRecords_);
+    numRecords_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+void StaticBatches::ReleaseVisible()
+{
+    SafeRelease(&pIdxsSRV_);
+    SafeRelease(&pIdxs_);
+    SafeRelease(&pVisibleUAV_);
+    SafeRelease(&pVisible_);
+    visibleCapacity_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+void StaticBatches::Upload(ID3D11DeviceContext* pContext, const InstBuffData& data)
+{
+    // records are immutable so the buffer is recreated each time
+    ReleaseRecords();
+
+    const UINT numRecords = (UINT)data.GetSize();
+
+    if (!isInit_ || (numRecords == 0))
+        return;
+
+    // pack instance records in the same way as the instances ring does
+    cvector<ConstBufType::InstancedData> records(numRecords);
+
+    for (UINT i = 0; i < numRecords; ++i)
+    {
+        ConstBufType::PackInstance(
+            records[i],
+            data.worlds_[i],
+            data.texTransforms_[i],
+            data.materialIdxs_[i],
+            (data.enttIds_) ? data.enttIds_[i] : 0);
+    }
+
+    ID3D11Device* pDevice = nullptr;
+    pContext->GetDevice(&pDevice);
+
+    D3D11_BUFFER_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+
+    desc.Usage     = D3D11_USAGE_IMMUTABLE;
+    desc.ByteWidth = numRecords * INSTANCE_SIZE;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+
+    D3D11_SUBRESOURCE_DATA initData = { records.data(), 0, 0 };
+
+    HRESULT hr = pDevice->CreateBuffer(&desc, &initData, &pRecords_);
+
+    if (SUCCEEDED(hr))
+        hr = CreateRawSRV(pDevice, pRecords_, desc.ByteWidth, &pRecordsSRV_);
+
+    SafeRelease(&pDevice);
+
+    if (FAILED(hr))
+    {
+        LogErr("can't create a buffer of static instance records");
+        ReleaseRecords();
+        return;
+    }
+
+    numRecords_ = numRecords;
+}
+
+///////////////////////////////////////////////////////////
+
+bool StaticBatches::PrepareVisible(ID3D11Device* pDevice, const UINT numIdxs)
+{
+    // capacities grow in 1.5 times so small changes of visibility don't cause recreation
+    if (numIdxs <= visibleCapacity_)
+        return true;
+
+    ReleaseVisible();
+
+    const UINT capacity  = numIdxs + numIdxs / 2;
+    const UINT byteWidth = capacity * INSTANCE_SIZE;
+
+    D3D11_BUFFER_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+
+    desc.Usage               = D3D11_USAGE_DYNAMIC;
+    desc.ByteWidth           = capacity * sizeof(uint32);
+    desc.BindFlags           = D3D11_BIND_SHADER_RESOURCE;
+    desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+    desc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    desc.StructureByteStride = sizeof(uint32);
+
+    HRESULT hr = pDevice->CreateBuffer(&desc, nullptr, &pIdxs_);
+
+    if (SUCCEEDED(hr))
+        hr = pDevice->CreateShaderResourceView(pIdxs_, nullptr, &pIdxsSRV_);
+
+    if (SUCCEEDED(hr))
+    {
+        ZeroMemory(&desc, sizeof(desc));
+
+        desc.Usage     = D3D11_USAGE_DEFAULT;
+        desc.ByteWidth = byteWidth;
+        desc.BindFlags = D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_UNORDERED_ACCESS;
+        desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+
+        hr = pDevice->CreateBuffer(&desc, nullptr, &pVisible_);
+    }
+
+    if (SUCCEEDED(hr))
+        hr = CreateRawUAV(pDevice, pVisible_, byteWidth, &pVisibleUAV_);
+
+    if (FAILED(hr))
+    {
+        LogErr("can't create buffers of visible static instances");
+        ReleaseVisible();
+        return false;
+    }
+
+    visibleCapacity_ = capacity;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void StaticBatches::Gather(ID3D11DeviceContext* pContext, const uint32* idxs, const UINT numIdxs)
+{
+    if (!isInit_ || !HasBatches() || (numIdxs == 0))
+        return;
+
+    CAssert::True(idxs != nullptr, "input ptr to indices arr == nullptr");
+
+    ID3D11Device* pDevice = nullptr;
+    pContext->GetDevice(&pDevice);
+    const bool result = PrepareVisible(pDevice, numIdxs);
+    SafeRelease(&pDevice);
+
+    if (!result)
+        return;
+
+    // upload the visibility list of this frame
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    const HRESULT hr = pContext->Map(pIdxs_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+    if (FAILED(hr))
+    {
+        LogErr("can't map a buffer of visible static records");
+        return;
+    }
+
+    memcpy(mapped.pData, idxs, numIdxs * sizeof(uint32));
+    pContext->Unmap(pIdxs_, 0);
+
+    cbGather_.data.numIdxs = numIdxs;
+    cbGather_.ApplyChanges(pContext);
+
+    ID3D11ShaderResourceView* srvs[2] = { pRecordsSRV_, pIdxsSRV_ };
+
+    pContext->CSSetShader(gatherCS_.GetShader(), nullptr, 0);
+    pContext->CSSetConstantBuffers(0, 1, cbGather_.GetAddressOf());
+    pContext->CSSetShaderResources(0, 2, srvs);
+    pContext->CSSetUnorderedAccessViews(0, 1, &pVisibleUAV_, nullptr);
+
+    pContext->Dispatch((numIdxs + THREADS_NUM - 1) / THREADS_NUM, 1, 1);
+
+    // unbind so the result can be used as a vertex buffer
+    ID3D11ShaderResourceView*  nullSRVs[2] = { nullptr, nullptr };
+    ID3D11UnorderedAccessView* nullUAV     = nullptr;
+
+    pContext->CSSetShaderResources(0, 2, nullSRVs);
+    pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+    pContext->CSSetShader(nullptr, nullptr, 0);
+}
+
+} // namespace Render
@@ -0,0 +1,82 @@
+// =================================================================================
+// Filename:     StaticBatches.h
+// Description:  persistent instance data of static entities:
+//
+//               - instance records (the same layout as ConstBufType::InstancedData)
+//                 of static entts are uploaded once into an immutable buffer and
+//                 are re-uploaded only when the set of static entts is changed;
+//               - each frame the CPU sends only a compacted list of indices of
+//                 visible records (in the order of draws) and a compute shader
+//                 gathers them into the visible instances buffer;
+//               - the visible instances buffer is bound as the per-instance vertex
+//                 stream so the usual input layouts and passes are used as is
+//                 (draws of static instances start from instance 0)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/ComputeShader.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "Common/RenderTypes.h"
+
+#include <Types.h>
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+class StaticBatches
+{
+public:
+    static constexpr UINT INSTANCE_SIZE = sizeof(ConstBufType::InstancedData);
+    static constexpr UINT THREADS_NUM   = 64;                  // the group size of the gather shader
+
+    StaticBatches() {}
+    ~StaticBatches();
+
+    // restrict a copying of this class instance
+    StaticBatches(const StaticBatches&) = delete;
+    StaticBatches& operator=(const StaticBatches&) = delete;
+
+    bool Initialize(ID3D11Device* pDevice, const char* shaderPath);
+    void Shutdown();
+
+    // recreate the immutable buffer of records of all the static instances
+    // (data of instance i subset s goes by numInstances records)
+    void Upload(ID3D11DeviceContext* pContext, const InstBuffData& data);
+
+    // copy records by the input indices into the visible buffer (in the same order)
+    void Gather(ID3D11DeviceContext* pContext, const uint32* idxs, const UINT numIdxs);
+
+    inline bool          IsInitialized()    const { return isInit_; }
+    inline bool          HasBatches()       const { return numRecords_ > 0; }
+    inline UINT          GetNumRecords()    const { return numRecords_; }
+    inline ID3D11Buffer* GetVisibleBuffer() const { return pVisible_; }
+
+private:
+    void ReleaseRecords();
+    void ReleaseVisible();
+    bool PrepareVisible(ID3D11Device* pDevice, const UINT numIdxs);
+
+private:
+    ComputeShader                                  gatherCS_;
+    ConstantBuffer<ConstBufType::cbcsStaticGather> cbGather_;
+
+    ID3D11Buffer*               pRecords_    = nullptr;    // raw, immutable: instance records
+    ID3D11ShaderResourceView*   pRecordsSRV_ = nullptr;
+
+    ID3D11Buffer*               pIdxs_       = nullptr;    // structured, dynamic: visible records of this frame
+    ID3D11ShaderResourceView*   pIdxsSRV_    = nullptr;
+    ID3D11Buffer*               pVisible_    = nullptr;    // raw: gathered records (is bound as VB)
+    ID3D11UnorderedAccessView*  pVisibleUAV_ = nullptr;
+
+    UINT                        numRecords_      = 0;
+    UINT                        visibleCapacity_ = 0;
+
+    bool                        isInit_ = false;
+};
+
+} // namespace Render
@@ -0,0 +1,217 @@
+// =================================================================================
+// Filename:     TransientAllocator.cpp
+// Description:  implementation of the TransientAllocator's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "TransientAllocator.h"
+#include "FrameStats.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+
+
+namespace Render
+{
+
+TransientAllocator::~TransientAllocator()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+bool TransientAllocator::Initialize(ID3D11Device* pDevice, ID3D11DeviceContext* pImmediateContext)
+{
+    try
+    {
+        CAssert::True(pDevice,           "input ptr to the device == nullptr");
+        CAssert::True(pImmediateContext, "input ptr to the immediate context == nullptr");
+
+        const UINT capacities[NUM_TRANSIENT_POOLS] = { VB_CAPACITY, IB_CAPACITY };
+        const UINT bindFlags[NUM_TRANSIENT_POOLS]  = { D3D11_BIND_VERTEX_BUFFER, D3D11_BIND_INDEX_BUFFER };
+
+        for (int i = 0; i < NUM_TRANSIENT_POOLS; ++i)
+        {
+            D3D11_BUFFER_DESC desc;
+            desc.Usage               = D3D11_USAGE_DYNAMIC;
+            desc.ByteWidth           = capacities[i];
+            desc.BindFlags           = bindFlags[i];
+            desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+            desc.MiscFlags           = 0;
+            desc.StructureByteStride = 0;
+
+            HRESULT hr = pDevice->CreateBuffer(&desc, nullptr, &pools_[i].pBuffer);
+            CAssert::NotFailed(hr, "can't create a buffer for the transient allocator");
+
+            pools_[i].capacity = capacities[i];
+        }
+
+        D3D11_QUERY_DESC queryDesc;
+        queryDesc.Query     = D3D11_QUERY_EVENT;
+        queryDesc.MiscFlags = 0;
+
+        for (Fence& fence : fences_)
+        {
+            HRESULT hr = pDevice->CreateQuery(&queryDesc, &fence.pQuery);
+            CAssert::NotFailed(hr, "can't create a fence query for the transient allocator");
+        }
+
+        pContext_ = pImmediateContext;
+        pContext_->AddRef();
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the transient allocator");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void TransientAllocator::Shutdown()
+{
+    for (Fence& fence : fences_)
+        SafeRelease(&fence.pQuery);
+
+    for (Pool& pool : pools_)
+    {
+        SafeRelease(&pool.pBuffer);
+        pool = Pool();
+    }
+
+    SafeRelease(&pContext_);
+
+    firstFence_ = 0;
+    numFences_  = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+void TransientAllocator::EndFrame(ID3D11DeviceContext* pContext)
+{
+    if (!pContext_ || (pContext != pContext_))
+        return;
+
+    RetireFinishedFrames();
+
+    for (Pool& pool : pools_)
+        pool.frameBytes = 0;
+
+    // all the fences are in flight: the data of this frame will be retired
+    // together with the next frame (so we are just more conservative)
+    if (numFences_ == NUM_FENCES)
+        return;
+
+    Fence& fence = fences_[(firstFence_ + numFences_) % NUM_FENCES];
+
+    for (int i = 0; i < NUM_TRANSIENT_POOLS; ++i)
+        fence.end[i] = pools_[i].head;
+
+    pContext_->End(fence.pQuery);
+    ++numFences_;
+}
+
+
+// =================================================================================
+// PRIVATE HELPERS
+// =================================================================================
+void* TransientAllocator::AllocateBytes(
+    ID3D11DeviceContext* pContext,
+    const eTransientPool poolType,
+    const UINT numBytes,
+    UINT& outOffset)
+{
+    // deferred contexts can't be mapped with NO_OVERWRITE before the first DISCARD
+    // so they use their own buffers
+    if (!pContext_ || (pContext != pContext_) || (numBytes == 0))
+        return nullptr;
+
+    Pool& pool = pools_[poolType];
+
+    if ((numBytes > pool.capacity) || pool.isMapped)
+        return nullptr;
+
+    RetireFinishedFrames();
+
+    // an allocation must be contiguous so we skip the rest of the buffer if it isn't enough
+    uint64     start  = (pool.head + ALIGNMENT - 1) & ~(uint64)(ALIGNMENT - 1);
+    const UINT offset = (UINT)(start % pool.capacity);
+
+    if (offset + numBytes > pool.capacity)
+        start += pool.capacity - offset;
+
+    // the GPU still can read the data we are going to overwrite
+    if (start + numBytes - pool.tail > pool.capacity)
+        pool.needDiscard = true;
+
+    D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+
+    if (pool.needDiscard)
+    {
+        // the driver gives us a new memory so all the prev allocations are free
+        mapType          = D3D11_MAP_WRITE_DISCARD;
+        start            = pool.head + (pool.capacity - (UINT)(pool.head % pool.capacity)) % pool.capacity;
+        pool.tail        = start;
+        pool.needDiscard = false;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    const HRESULT hr = pContext_->Map(pool.pBuffer, 0, mapType, 0, &mapped);
+
+    if (FAILED(hr))
+    {
+        LogErr("can't map a buffer of the transient allocator");
+        pool.needDiscard = true;
+        return nullptr;
+    }
+
+    pool.head        = start + numBytes;
+    pool.frameBytes += numBytes;
+    pool.isMapped    = true;
+
+    g_FrameStats.AddUpload((poolType == TRANSIENT_POOL_VB) ? UPLOAD_TRANSIENT_VB : UPLOAD_TRANSIENT_IB, numBytes);
+
+    outOffset = (UINT)(start % pool.capacity);
+    return (uint8*)mapped.pData + outOffset;
+}
+
+///////////////////////////////////////////////////////////
+
+void TransientAllocator::UnmapPool(ID3D11DeviceContext* pContext, const eTransientPool poolType)
+{
+    Pool& pool = pools_[poolType];
+
+    if (!pool.isMapped)
+        return;
+
+    pContext->Unmap(pool.pBuffer, 0);
+    pool.isMapped = false;
+}
+
+///////////////////////////////////////////////////////////
+
+void TransientAllocator::RetireFinishedFrames()
+{
+    // move tails over frames which are already finished by the GPU
+    while (numFences_ > 0)
+    {
+        Fence& fence = fences_[firstFence_];
+
+        if (pContext_->GetData(fence.pQuery, nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+            break;
+
+        // after a discard a tail can be already farther
+        for (int i = 0; i < NUM_TRANSIENT_POOLS; ++i)
+            pools_[i].tail = (fence.end[i] > pools_[i].tail) ? fence.end[i] : pools_[i].tail;
+
+        firstFence_ = (firstFence_ + 1) % NUM_FENCES;
+        --numFences_;
+    }
+}
+
+} // namespace Render
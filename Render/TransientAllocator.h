@@ -0,0 +1,132 @@
+// =================================================================================
+// Filename:     TransientAllocator.h
+// Description:  a frame-scoped allocator of transient GPU data: dynamic geometry
+//               of the frame (debug lines, impostors, billboards, etc.) is
+//               sub-allocated from a few large dynamic buffers (one per pool)
+//               with MAP_WRITE_NO_OVERWRITE instead of a map with DISCARD (or
+//               a CreateBuffer) of its own small buffer;
+//
+//               allocations are retired by per-frame fences as of the InstanceRing,
+//               per-draw constants use the ConstBufferRing;
+//
+//               NOTE: only the immediate context is supported; if an allocation
+//                     fails the producer uses its own buffer
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+enum eTransientPool
+{
+    TRANSIENT_POOL_VB,                  // vertices and per instance data
+    TRANSIENT_POOL_IB,                  // indices
+
+    NUM_TRANSIENT_POOLS
+};
+
+///////////////////////////////////////////////////////////
+
+template <typename T>
+struct TransientAlloc
+{
+    T*             ptr     = nullptr;   // where to write (valid until the pool is unmapped)
+    UINT           offset  = 0;         // in bytes from the start of the buffer
+    ID3D11Buffer*  pBuffer = nullptr;   // bind it with this offset
+    eTransientPool pool    = TRANSIENT_POOL_VB;
+
+    inline bool IsValid() const { return ptr != nullptr; }
+};
+
+///////////////////////////////////////////////////////////
+
+class TransientAllocator
+{
+public:
+    static constexpr UINT ALIGNMENT      = 16;          // offsets are multiples of it (so any index format fits)
+    static constexpr UINT VB_CAPACITY    = (4 << 20);   // 4 MB
+    static constexpr UINT IB_CAPACITY    = (1 << 20);   // 1 MB
+    static constexpr int  NUM_FENCES     = 4;           // max number of frames in flight we track
+
+public:
+    TransientAllocator() {}
+    ~TransientAllocator();
+
+    // restrict a copying of this class instance
+    TransientAllocator(const TransientAllocator&) = delete;
+    TransientAllocator& operator=(const TransientAllocator&) = delete;
+
+    bool Initialize(ID3D11Device* pDevice, ID3D11DeviceContext* pImmediateContext);
+    void Shutdown();
+
+    inline bool IsSupported() const { return pContext_ != nullptr; }
+
+    // sub-allocate (and map) a place for count elements of the pool;
+    // you must call Unmap() after writing and before the draw call;
+    // ret: an invalid alloc if the allocator can't serve it (use your own buffer)
+    template <typename T>
+    TransientAlloc<T> Allocate(ID3D11DeviceContext* pContext, const eTransientPool pool, const UINT count)
+    {
+        TransientAlloc<T> alloc;
+        alloc.pool = pool;
+        alloc.ptr  = (T*)AllocateBytes(pContext, pool, (UINT)sizeof(T) * count, alloc.offset);
+
+        if (alloc.ptr)
+            alloc.pBuffer = pools_[pool].pBuffer;
+
+        return alloc;
+    }
+
+    template <typename T>
+    inline void Unmap(ID3D11DeviceContext* pContext, const TransientAlloc<T>& alloc)
+    {
+        if (alloc.IsValid())
+            UnmapPool(pContext, alloc.pool);
+    }
+
+    // put a fence after all the draws of this frame
+    void EndFrame(ID3D11DeviceContext* pContext);
+
+    inline UINT GetUsedBytes(const eTransientPool pool) const { return pools_[pool].frameBytes; }
+
+private:
+    void* AllocateBytes(ID3D11DeviceContext* pContext, const eTransientPool pool, const UINT numBytes, UINT& outOffset);
+    void  UnmapPool    (ID3D11DeviceContext* pContext, const eTransientPool pool);
+    void  RetireFinishedFrames();
+
+private:
+    struct Pool
+    {
+        ID3D11Buffer* pBuffer     = nullptr;
+        UINT          capacity    = 0;         // in bytes
+
+        // monotonic counters of bytes (the offset in the buffer is counter % capacity)
+        uint64        head        = 0;         // the next free byte
+        uint64        tail        = 0;         // the oldest byte which can be still read by the GPU
+
+        UINT          frameBytes  = 0;         // allocated by the current frame (for stats)
+        bool          needDiscard = true;      // the first map must discard
+        bool          isMapped    = false;
+    };
+
+    struct Fence
+    {
+        ID3D11Query* pQuery = nullptr;
+        uint64       end[NUM_TRANSIENT_POOLS]{0};   // heads of pools at the end of the frame
+    };
+
+    ID3D11DeviceContext* pContext_ = nullptr;       // the immediate context
+    Pool                 pools_[NUM_TRANSIENT_POOLS];
+
+    Fence                fences_[NUM_FENCES];
+    int                  firstFence_ = 0;           // the oldest fence in flight
+    int                  numFences_  = 0;
+};
+
+} // namespace Render
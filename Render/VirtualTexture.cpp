@@ -0,0 +1,342 @@
+// =================================================================================
+// Filename:     VirtualTexture.cpp
+// Description:  implementation of the VirtualTexture's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "VirtualTexture.h"
+#include <MemHelpers.h>
+#include <log.h>
+#include <CAssert.h>
+#include <cvector.h>
+
+
+namespace Render
+{
+
+static_assert(sizeof(ConstBufType::cbVirtualTexture) % 16 == 0, "size of the const buffer must be a multiple of 16");
+
+//---------------------------------------------------------
+// Desc:   is the value a power of 2?
+//---------------------------------------------------------
+static inline bool IsPow2(const UINT value)
+{
+    return (value > 0) && ((value & (value - 1)) == 0);
+}
+
+///////////////////////////////////////////////////////////
+
+VirtualTexture::~VirtualTexture()
+{
+    Shutdown();
+}
+
+//---------------------------------------------------------
+// Desc:   create the page cache, the indirection texture (with a mip per mip
+//         of pages), the feedback buffer and staging buffers to read it back
+//---------------------------------------------------------
+bool VirtualTexture::Initialize(ID3D11Device* pDevice, const VirtualTextureParams& params)
+{
+    try
+    {
+        CAssert::True(IsPow2(params.virtualSize) && IsPow2(params.pageSize), "sizes of the virtual texture and its pages must be powers of 2");
+        CAssert::True(params.virtualSize >= params.pageSize, "the virtual texture must be at least of a single page");
+        CAssert::True((params.cachePagesPerSide > 0) && (params.cachePagesPerSide <= 256), "slots of the page cache must be addressed by 8 bits");
+
+        // the mip chain of pages goes down to a single page
+        pagesPerSide_ = params.virtualSize / params.pageSize;
+        numMips_      = 0;
+        numEntries_   = 0;
+
+        for (UINT pages = pagesPerSide_; pages > 0; pages >>= 1)
+        {
+            mipOffsets_[numMips_++] = numEntries_;
+            numEntries_ += pages * pages;
+        }
+
+        CAssert::True(numMips_ <= MAX_NUM_MIPS, "too many mips of the virtual texture");
+
+        const UINT slotSize = params.pageSize + 2 * params.border;
+        cacheSize_ = slotSize * params.cachePagesPerSide;
+
+        CAssert::True(cacheSize_ <= D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION, "the page cache is too big");
+
+
+        // the physical page cache (pages already have borders so it needs no mips)
+        D3D11_TEXTURE2D_DESC texDesc;
+        ZeroMemory(&texDesc, sizeof(texDesc));
+        texDesc.Width            = cacheSize_;
+        texDesc.Height           = cacheSize_;
+        texDesc.MipLevels        = 1;
+        texDesc.ArraySize        = 1;
+        texDesc.Format           = DXGI_FORMAT_R8G8B8A8_UNORM;
+        texDesc.SampleDesc.Count = 1;
+        texDesc.Usage            = D3D11_USAGE_DEFAULT;
+        texDesc.BindFlags        = D3D11_BIND_SHADER_RESOURCE;
+
+        HRESULT hr = pDevice->CreateTexture2D(&texDesc, nullptr, &pCache_);
+        CAssert::NotFailed(hr, "can't create the page cache of the virtual texture");
+
+        hr = pDevice->CreateShaderResourceView(pCache_, nullptr, &pCacheSRV_);
+        CAssert::NotFailed(hr, "can't create a SRV of the page cache");
+
+
+        // the indirection: a texel per page (is read by Load() so it has no filtering)
+        texDesc.Width     = pagesPerSide_;
+        texDesc.Height    = pagesPerSide_;
+        texDesc.MipLevels = numMips_;
+        texDesc.Format    = DXGI_FORMAT_R8G8B8A8_UINT;
+
+        hr = pDevice->CreateTexture2D(&texDesc, nullptr, &pIndirection_);
+        CAssert::NotFailed(hr, "can't create the indirection texture of the virtual texture");
+
+        hr = pDevice->CreateShaderResourceView(pIndirection_, nullptr, &pIndirectionSRV_);
+        CAssert::NotFailed(hr, "can't create a SRV of the indirection texture");
+
+
+        // the feedback: a stamp per page of all the mips (is zeroed once)
+        D3D11_BUFFER_DESC desc;
+        ZeroMemory(&desc, sizeof(desc));
+
+        desc.Usage               = D3D11_USAGE_DEFAULT;
+        desc.ByteWidth           = numEntries_ * sizeof(uint32);
+        desc.BindFlags           = D3D11_BIND_UNORDERED_ACCESS;
+        desc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        desc.StructureByteStride = sizeof(uint32);
+
+        cvector<uint32> zeros(numEntries_, 0);
+        D3D11_SUBRESOURCE_DATA initData = { zeros.data(), 0, 0 };
+
+        hr = pDevice->CreateBuffer(&desc, &initData, &pFeedback_);
+        CAssert::NotFailed(hr, "can't create the feedback buffer of the virtual texture");
+
+        hr = pDevice->CreateUnorderedAccessView(pFeedback_, nullptr, &pFeedbackUAV_);
+        CAssert::NotFailed(hr, "can't create an UAV of the feedback buffer");
+
+
+        // staging copies of the feedback
+        desc.Usage               = D3D11_USAGE_STAGING;
+        desc.BindFlags           = 0;
+        desc.CPUAccessFlags      = D3D11_CPU_ACCESS_READ;
+        desc.MiscFlags           = 0;
+        desc.StructureByteStride = 0;
+
+        for (UINT i = 0; i < NUM_READBACKS; ++i)
+        {
+            hr = pDevice->CreateBuffer(&desc, nullptr, &pReadbacks_[i]);
+            CAssert::NotFailed(hr, "can't create a staging buffer of the feedback");
+            readbackStamps_[i] = 0;
+        }
+
+
+        D3D11_SAMPLER_DESC samplerDesc;
+        ZeroMemory(&samplerDesc, sizeof(samplerDesc));
+        samplerDesc.Filter         = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+        samplerDesc.AddressU       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressV       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressW       = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+        samplerDesc.MaxLOD         = D3D11_FLOAT32_MAX;
+
+        bool result = samplerState_.Initialize(pDevice, &samplerDesc);
+        CAssert::True(result, "can't initialize the sampler state of the virtual texture");
+
+        CAssert::NotFailed(cbVT_.Initialize(pDevice), "can't initialize the const buffer of the virtual texture");
+
+        // params are the same all the time: only the frame stamp is changed
+        ConstBufType::cbVirtualTexture& cb = cbVT_.data;
+        cb.virtualSize  = (float)params.virtualSize;
+        cb.pageSize     = (float)params.pageSize;
+        cb.border       = (float)params.border;
+        cb.cacheSize    = (float)cacheSize_;
+        cb.numMips      = numMips_;
+        cb.pagesPerSide = pagesPerSide_;
+        cb.enabled      = 1;
+        memcpy(cb.mipOffsets, mipOffsets_, sizeof(cb.mipOffsets));
+
+        params_    = params;
+        frame_     = 1;
+        copyIdx_   = 0;
+        isMapped_  = false;
+        isInit_    = true;
+
+        LogMsgf("virtual texture: %u^2 texels, %u mips of %u^2 pages, the cache of %u pages (%u KB)",
+            params.virtualSize,
+            numMips_,
+            params.pageSize,
+            GetNumSlots(),
+            (cacheSize_ * cacheSize_ * 4) >> 10);
+
+        return true;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't initialize the virtual texture");
+        Shutdown();
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void VirtualTexture::Shutdown()
+{
+    for (UINT i = 0; i < NUM_READBACKS; ++i)
+    {
+        SafeRelease(&pReadbacks_[i]);
+        readbackStamps_[i] = 0;
+    }
+
+    SafeRelease(&pFeedbackUAV_);
+    SafeRelease(&pFeedback_);
+    SafeRelease(&pIndirectionSRV_);
+    SafeRelease(&pIndirection_);
+    SafeRelease(&pCacheSRV_);
+    SafeRelease(&pCache_);
+
+    numMips_    = 0;
+    numEntries_ = 0;
+    isMapped_   = false;
+    isInit_     = false;
+}
+
+//---------------------------------------------------------
+// Desc:   copy a baked page (with borders) into the cache slot
+//---------------------------------------------------------
+void VirtualTexture::UploadPage(
+    ID3D11DeviceContext* pContext,
+    const UINT slotX,
+    const UINT slotY,
+    const uint8* pTexels)
+{
+    const UINT slotSize = GetPageSizeWithBorders();
+
+    D3D11_BOX box;
+    box.left   = slotX * slotSize;
+    box.top    = slotY * slotSize;
+    box.front  = 0;
+    box.right  = box.left + slotSize;
+    box.bottom = box.top + slotSize;
+    box.back   = 1;
+
+    pContext->UpdateSubresource(pCache_, 0, &box, pTexels, slotSize * 4, 0);
+}
+
+//---------------------------------------------------------
+// Desc:   replace all the entries of the indirection mip
+//---------------------------------------------------------
+void VirtualTexture::UploadIndirection(
+    ID3D11DeviceContext* pContext,
+    const UINT mip,
+    const uint32* pEntries)
+{
+    const UINT pages = pagesPerSide_ >> mip;
+    pContext->UpdateSubresource(pIndirection_, mip, nullptr, pEntries, pages * sizeof(uint32), 0);
+}
+
+//---------------------------------------------------------
+// Desc:   bind resources of the virtual texture to the PS; the feedback UAV
+//         goes into the output merger after the currently bound color target
+//---------------------------------------------------------
+void VirtualTexture::Bind(ID3D11DeviceContext* pContext)
+{
+    if (!isInit_)
+        return;
+
+    cbVT_.data.frame = frame_;
+    cbVT_.ApplyChanges(pContext);
+
+    ID3D11ShaderResourceView* srvs[2] = { pCacheSRV_, pIndirectionSRV_ };
+    const UINT                initialCount = (UINT)-1;
+
+    pStateCache_->SetPSConstantBuffers(pContext, CONST_BUFFER_SLOT, 1, cbVT_.GetAddressOf());
+    pStateCache_->SetPSShaderResources(pContext, CACHE_SLOT, 2, srvs);
+    pStateCache_->SetPSSamplers(pContext, SAMPLER_SLOT, 1, samplerState_.GetAddressOf());
+
+    pContext->OMSetRenderTargetsAndUnorderedAccessViews(
+        D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr,
+        FEEDBACK_UAV_SLOT, 1, &pFeedbackUAV_, &initialCount);
+}
+
+//---------------------------------------------------------
+// Desc:   unbind the feedback UAV (it is copied after the draws) and the params
+//         (so other users of the terrain PS sample their texture maps)
+//---------------------------------------------------------
+void VirtualTexture::Unbind(ID3D11DeviceContext* pContext)
+{
+    if (!isInit_)
+        return;
+
+    ID3D11UnorderedAccessView* nullUAV = nullptr;
+    ID3D11Buffer*              nullCB  = nullptr;
+    const UINT                 initialCount = (UINT)-1;
+
+    pContext->OMSetRenderTargetsAndUnorderedAccessViews(
+        D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr,
+        FEEDBACK_UAV_SLOT, 1, &nullUAV, &initialCount);
+
+    pStateCache_->SetPSConstantBuffers(pContext, CONST_BUFFER_SLOT, 1, &nullCB);
+}
+
+//---------------------------------------------------------
+// Desc:   enqueue a copy of the feedback of this frame; the staging buffer
+//         is read back when the ring comes round to it again
+//---------------------------------------------------------
+void VirtualTexture::CopyFeedback(ID3D11DeviceContext* pContext)
+{
+    if (!isInit_)
+        return;
+
+    // the staging buffer can't be mapped while it is copied into
+    if (isMapped_ && (mappedIdx_ == copyIdx_))
+        UnmapFeedback(pContext);
+
+    pContext->CopyResource(pReadbacks_[copyIdx_], pFeedback_);
+    readbackStamps_[copyIdx_] = frame_;
+
+    copyIdx_ = (copyIdx_ + 1) % NUM_READBACKS;
+
+    // 0 is never a stamp: the feedback is zeroed at start
+    frame_ = (frame_ == UINT32_MAX) ? 1 : frame_ + 1;
+}
+
+//---------------------------------------------------------
+// Desc:   map the oldest copy of the feedback (the one which will be copied
+//         into next); each copy is returned only once
+// Args:   - outStamp: requested pages are entries equal to this stamp
+//---------------------------------------------------------
+const uint32* VirtualTexture::MapFeedback(ID3D11DeviceContext* pContext, uint32& outStamp)
+{
+    outStamp = 0;
+
+    if (!isInit_ || isMapped_ || (readbackStamps_[copyIdx_] == 0))
+        return nullptr;
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    const HRESULT hr = pContext->Map(pReadbacks_[copyIdx_], 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+
+    // the GPU hasn't got to the copy yet (try again the next frame)
+    if (FAILED(hr))
+        return nullptr;
+
+    outStamp                  = readbackStamps_[copyIdx_];
+    readbackStamps_[copyIdx_] = 0;
+    mappedIdx_                = copyIdx_;
+    isMapped_                 = true;
+
+    return (const uint32*)mapped.pData;
+}
+
+///////////////////////////////////////////////////////////
+
+void VirtualTexture::UnmapFeedback(ID3D11DeviceContext* pContext)
+{
+    if (!isMapped_)
+        return;
+
+    pContext->Unmap(pReadbacks_[mappedIdx_], 0);
+    isMapped_ = false;
+}
+
+} // namespace Render
@@ -0,0 +1,146 @@
+// =================================================================================
+// Filename:     VirtualTexture.h
+// Description:  GPU side of a virtual texture (is used for the terrain texture map):
+//
+//               - the virtual texture is split into square pages; there is a mip
+//                 chain of pages down to a single page which covers everything;
+//               - only requested pages are resident in a physical page cache (a
+//                 single texture of N x N slots); each slot has a border so pages
+//                 can be bilinearly filtered without bleeding of their neighbours;
+//               - an indirection texture (a texel per page of each mip) says where
+//                 in the cache the page is: a page which isn't resident refers to
+//                 its closest resident ancestor, so the PS does one indirection
+//                 and one sample of the cache;
+//               - the PS writes the frame stamp into a feedback buffer (an entry
+//                 per page of each mip) for pages it wants; the buffer is copied
+//                 into a ring of staging buffers and is read back by the CPU a few
+//                 frames later without stall (nothing is cleared: the requests of
+//                 the copied frame are entries equal to its stamp)
+//
+//               what is baked into pages and which of them stay resident is
+//               decided by the owner (see Core::TerrainVirtualTexture)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Shaders/SamplerState.h"
+#include "Shaders/ConstantBuffer.h"
+#include "Common/ConstBufferTypes.h"
+#include "StateCache.h"
+#include <Types.h>
+#include <d3d11.h>
+
+
+namespace Render
+{
+
+struct VirtualTextureParams
+{
+    UINT virtualSize       = 16384;   // texels per side at mip 0 (a power of 2)
+    UINT pageSize          = 128;     // texels per side of a page without borders (a power of 2)
+    UINT border            = 4;       // texels on each side of a page in the cache
+    UINT cachePagesPerSide = 16;      // the page cache has N x N slots
+};
+
+///////////////////////////////////////////////////////////
+
+class VirtualTexture
+{
+public:
+    // slots of resources (must be the same as in VirtualTexture.hlsli); they don't
+    // overlap slots which are used by the terrain PS
+    static constexpr UINT CONST_BUFFER_SLOT = 13;
+    static constexpr UINT CACHE_SLOT        = 32;
+    static constexpr UINT INDIRECTION_SLOT  = 33;
+    static constexpr UINT SAMPLER_SLOT      = 5;
+    static constexpr UINT FEEDBACK_UAV_SLOT = 1;     // after the single color target of the scene pass
+
+    static constexpr UINT MAX_NUM_MIPS      = 16;
+    static constexpr UINT NUM_READBACKS     = 3;     // the feedback is read back with this latency (in frames)
+
+    VirtualTexture() {}
+    ~VirtualTexture();
+
+    // restrict a copying of this class instance
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+    bool Initialize(ID3D11Device* pDevice, const VirtualTextureParams& params);
+    void Shutdown();
+
+    // upload a baked page with its borders ((pageSize + 2*border)^2 RGBA8 texels) into the cache slot
+    void UploadPage(
+        ID3D11DeviceContext* pContext,
+        const UINT slotX,
+        const UINT slotY,
+        const uint8* pTexels);
+
+    // upload all the entries of the indirection mip ((pagesPerSide >> mip)^2 packed RGBA8_UINT:
+    // slot x, slot y, mip of the resident page)
+    void UploadIndirection(
+        ID3D11DeviceContext* pContext,
+        const UINT mip,
+        const uint32* pEntries);
+
+    // bind the cache, indirection, feedback and params to the PS for the next draws
+    // (the current render targets are kept); NOTE: is undone by Unbind()
+    void Bind(ID3D11DeviceContext* pContext);
+    void Unbind(ID3D11DeviceContext* pContext);
+
+    // copy the feedback of this frame into the next staging buffer and advance the
+    // frame stamp (is called once per frame after all the draws which write feedback)
+    void CopyFeedback(ID3D11DeviceContext* pContext);
+
+    // map the oldest copied feedback if it is ready (no stall);
+    // ret: entries of all the mips (see GetMipOffset) or nullptr
+    const uint32* MapFeedback(ID3D11DeviceContext* pContext, uint32& outStamp);
+    void          UnmapFeedback(ID3D11DeviceContext* pContext);
+
+    // pack an indirection entry (the same layout as of the RGBA8_UINT texel)
+    static inline uint32 PackEntry(const UINT slotX, const UINT slotY, const UINT mip)
+    {
+        return (slotX & 0xFF) | ((slotY & 0xFF) << 8) | ((mip & 0xFF) << 16);
+    }
+
+    inline bool IsInitialized()      const { return isInit_; }
+    inline UINT GetNumMips()         const { return numMips_; }
+    inline UINT GetPagesPerSide()    const { return pagesPerSide_; }              // at mip 0
+    inline UINT GetMipOffset(const UINT mip) const { return mipOffsets_[mip]; }   // the first entry of the mip
+    inline UINT GetNumEntries()      const { return numEntries_; }                // pages of all the mips
+    inline UINT GetNumSlots()        const { return params_.cachePagesPerSide * params_.cachePagesPerSide; }
+    inline UINT GetPageSizeWithBorders() const { return params_.pageSize + 2 * params_.border; }
+
+    inline const VirtualTextureParams& GetParams() const { return params_; }
+
+    inline void SetStateCache(StateCache* pCache) { pStateCache_ = pCache; }
+
+private:
+    SamplerState               samplerState_;              // linear clamp (the cache has no mips)
+    ConstantBuffer<ConstBufType::cbVirtualTexture> cbVT_;
+
+    ID3D11Texture2D*           pCache_          = nullptr;  // RGBA8: slots of pages with borders
+    ID3D11ShaderResourceView*  pCacheSRV_       = nullptr;
+    ID3D11Texture2D*           pIndirection_    = nullptr;  // RGBA8_UINT: a texel per page, a mip per mip of pages
+    ID3D11ShaderResourceView*  pIndirectionSRV_ = nullptr;
+    ID3D11Buffer*              pFeedback_       = nullptr;  // structured: a stamp per page of all the mips
+    ID3D11UnorderedAccessView* pFeedbackUAV_    = nullptr;
+    ID3D11Buffer*              pReadbacks_[NUM_READBACKS]{ nullptr };
+    uint32                     readbackStamps_[NUM_READBACKS]{ 0 };   // 0: the staging buffer isn't copied yet
+
+    StateCache*                pStateCache_     = nullptr;  // filters redundant binds (is owned by CRender)
+    VirtualTextureParams       params_;
+
+    UINT                       numMips_         = 0;
+    UINT                       pagesPerSide_    = 0;
+    UINT                       mipOffsets_[MAX_NUM_MIPS]{ 0 };
+    UINT                       numEntries_      = 0;
+    UINT                       cacheSize_       = 0;        // texels per side
+    uint32                     frame_           = 1;        // the stamp of requests of the current frame
+    UINT                       copyIdx_         = 0;        // the next staging buffer to copy into
+    UINT                       mappedIdx_       = 0;
+    bool                       isMapped_        = false;
+    bool                       isInit_          = false;
+};
+
+} // namespace Render
@@ -0,0 +1,48 @@
+// *********************************************************************************
+// Filename:    ClusteredLights.hlsli
+// Description: buffers of point/spot lights and their per-cluster lists
+//              (are built by the Render::LightClusters each frame);
+//              a pixel finds its cluster by screen position and view depth
+//              and shades only lights of this cluster
+//
+//              NOTE: must be included after LightHelper.hlsli
+//              NOTE: slots must be the same as in the Render::LightClusters
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+StructuredBuffer<PointLight> gPointLights   : register(t24);
+StructuredBuffer<SpotLight>  gSpotLights    : register(t25);
+StructuredBuffer<uint2>      gLightClusters : register(t26);    // per cluster: (offset into gLightIdxs, numPoint | numSpot << 16)
+StructuredBuffer<uint>       gLightIdxs     : register(t27);    // for each cluster: idxs of point lights and then spot lights
+
+
+struct ClusterLights
+{
+    uint offset;        // first idx in gLightIdxs
+    uint numPoint;
+    uint numSpot;
+};
+
+///////////////////////////////////////////////////////////
+
+ClusterLights GetClusterLights(
+    float4 posH,        // SV_Position: xy - pixel coords, w - view space depth
+    uint3  dims,        // number of clusters by x, y, z
+    float2 scaleXY,     // pixel => cluster xy
+    float  sliceScale,  // view depth => cluster z: log(z) * scale + bias
+    float  sliceBias)
+{
+    const uint x = min((uint)(posH.x * scaleXY.x), dims.x - 1);
+    const uint y = min((uint)(posH.y * scaleXY.y), dims.y - 1);
+    const uint z = (uint)clamp(floor(log(posH.w) * sliceScale + sliceBias), 0.0f, (float)(dims.z - 1));
+
+    const uint2 cluster = gLightClusters[(z * dims.y + y) * dims.x + x];
+
+    ClusterLights cl;
+    cl.offset   = cluster.x;
+    cl.numPoint = cluster.y & 0xFFFF;
+    cl.numSpot  = cluster.y >> 16;
+
+    return cl;
+}
@@ -0,0 +1,61 @@
+// *********************************************************************************
+// Filename:    DebugGS.hlsl
+// Description: a pass-through geometry shader for the triangle density heatmap:
+//              it measures the area of each triangle after projection (in NDC)
+//              so the pixel shader can show how many triangles cover its pixel
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+// ==========================
+// TYPEDEFS
+// ==========================
+struct GS_IN
+{
+	float4x4 material  : MATERIAL;
+	float4   posH      : SV_POSITION;  // homogeneous position
+	float3   posW      : POSITION;     // position in world
+	float3   normalW   : NORMAL;       // normal in world
+	float3   tangentW  : TANGENT;      // tangent in world
+	float2   tex       : TEXCOORD;
+	nointerpolation float triArea : TRI_AREA;
+};
+
+typedef GS_IN GS_OUT;
+
+
+// ==========================
+// GEOMETRY SHADER
+// ==========================
+[maxvertexcount(3)]
+void GS(triangle GS_IN gin[3], inout TriangleStream<GS_OUT> triStream)
+{
+	float area = 0;
+
+	// a triangle which is clipped by the near plane is too close: mark it as huge
+	// (its area is unknown but it covers a lot of pixels for sure)
+	if ((gin[0].posH.w > 0) && (gin[1].posH.w > 0) && (gin[2].posH.w > 0))
+	{
+		const float2 p0 = gin[0].posH.xy / gin[0].posH.w;
+		const float2 p1 = gin[1].posH.xy / gin[1].posH.w;
+		const float2 p2 = gin[2].posH.xy / gin[2].posH.w;
+
+		const float2 e0 = p1 - p0;
+		const float2 e1 = p2 - p0;
+
+		area = 0.5f * abs(e0.x*e1.y - e0.y*e1.x);
+	}
+	else
+	{
+		area = 4.0f;      // the whole screen
+	}
+
+	[unroll]
+	for (int i = 0; i < 3; ++i)
+	{
+		GS_OUT gout  = gin[i];
+		gout.triArea = area;
+		triStream.Append(gout);
+	}
+}
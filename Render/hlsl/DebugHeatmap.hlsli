@@ -0,0 +1,61 @@
+// *********************************************************************************
+// Filename:    DebugHeatmap.hlsli
+// Description: colors of the performance heatmaps (debug states of the renderer)
+//              which are shared by the debug shader and the terrain shader
+//
+//              NOTE: ids must be the same as in the Render::eDebugState
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+static const int SHOW_OVERDRAW = 11;
+static const int SHOW_LOD = 12;
+static const int SHOW_LIGHT_COUNT = 13;
+static const int SHOW_TRIANGLE_DENSITY = 14;
+static const int SHOW_BATCHES = 15;
+
+// overdraw: a pixel is accumulated by additive blending, so this is the color of a single layer
+static const float3 OVERDRAW_LAYER_COLOR = float3(0.08f, 0.04f, 0.02f);
+
+static const float MAX_LIGHTS_HEAT = 16.0f;       // lights of a cluster for the hottest color
+
+///////////////////////////////////////////////////////////
+
+float3 HeatColor(float t)
+{
+	// blue -> cyan -> green -> yellow -> red
+	t = saturate(t);
+	return saturate(float3(
+		min(4*t - 1.5f, -4*t + 4.5f),
+		min(4*t - 0.5f, -4*t + 3.5f),
+		min(4*t + 0.5f, -4*t + 2.5f)));
+}
+
+///////////////////////////////////////////////////////////
+
+float3 LodColor(int lod)
+{
+	static const float3 colors[4] =
+	{
+		float3(0, 1, 0),      // LOD 0
+		float3(1, 1, 0),
+		float3(1, 0.5f, 0),
+		float3(1, 0, 0),
+	};
+
+	return colors[clamp(lod, 0, 3)];
+}
+
+///////////////////////////////////////////////////////////
+
+float3 HashColor(uint h)
+{
+	// scramble the bits so close hashes get different colors
+	h ^= h >> 16;
+	h *= 0x7feb352d;
+	h ^= h >> 15;
+	h *= 0x846ca68b;
+	h ^= h >> 16;
+
+	return float3(h & 0xFF, (h >> 8) & 0xFF, (h >> 16) & 0xFF) / 255.0f;
+}
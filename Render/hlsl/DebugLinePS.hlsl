@@ -0,0 +1,25 @@
+// *********************************************************************************
+// Filename:    DebugLinePS.hlsl
+// Description: a pixel shader of debug lines (just the color of the vertex)
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// TYPEDEFS
+//
+struct PS_IN
+{
+	float4 posH  : SV_POSITION;
+	float4 color : COLOR;
+};
+
+
+//
+// PIXEL SHADER
+//
+float4 PS(PS_IN pin) : SV_Target
+{
+	return pin.color;
+}
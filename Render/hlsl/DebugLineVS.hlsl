@@ -0,0 +1,45 @@
+// *********************************************************************************
+// Filename:    DebugLineVS.hlsl
+// Description: a vertex shader of debug lines (a line list in world space
+//              which is accumulated by the debug-draw during the frame)
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbPerFrame : register(b0)
+{
+	matrix gViewProj;
+};
+
+
+//
+// TYPEDEFS
+//
+struct VS_IN
+{
+	float3 posW  : POSITION;        // position of the vertex in world space
+	float4 color : COLOR;           // is unpacked from R8G8B8A8_UNORM
+};
+
+struct VS_OUT
+{
+	float4 posH  : SV_POSITION;
+	float4 color : COLOR;
+};
+
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(VS_IN vin)
+{
+	VS_OUT vout;
+	vout.posH  = mul(float4(vin.posW, 1.0f), gViewProj);
+	vout.color = vin.color;
+
+	return vout;
+}
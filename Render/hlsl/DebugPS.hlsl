@@ -5,12 +5,13 @@
 // Created:     24.11.24
 // *********************************************************************************
 #include "LightHelper.hlsli"
+#include "DebugHeatmap.hlsli"
 
 
 //
 // GLOBALS
 //
-Texture2D    gTextures[128] : register(t0);
+Texture2D    gTextures[24] : register(t0);     // t24..t27 are used for light clusters
 SamplerState gSampleType   : register(s0);
 
 // debug states/flags
@@ -31,12 +32,16 @@ static const int WIREFRAME = 10;
 //
 cbuffer cbPerFrame : register(b0)
 {
-	DirectionalLight  gDirLights[3];
-	PointLight        gPointLights[25];
-	SpotLight         gSpotLights[25];
+	DirectionalLight  gDirLights[3];        // point/spot lights are in structured buffers
 	float3            gEyePosW;             // eye position in world space
 	int               gCurrNumPointLights;
 	int               gCurrNumSpotLights;
+
+	// params of the light clusters grid
+	uint3             gClusterDims;
+	float2            gClusterScaleXY;      // pixel => cluster xy
+	float             gClusterSliceScale;   // view depth => cluster z
+	float             gClusterSliceBias;
 };
 
 cbuffer cbRareChanged : register(b1)
@@ -55,9 +60,18 @@ cbuffer cbRareChanged : register(b1)
     int   gAlphaClipping;       // turn on/off alpha clipping
 }
 
+#include "ClusteredLights.hlsli"
+
 cbuffer cbRareChangedDebug : register(b4)
 {
 	int    gDebugType;           // current debug state/flags
+
+	int    gDrawLod;             // LOD of the current draw call
+	uint   gDrawBatch;           // a hash of the current draw call
+	float  gPadding0;
+
+	float2 gViewportSize;        // in pixels (triangle density)
+	float2 gPadding1;
 }
 
 
@@ -72,6 +86,7 @@ struct PS_IN
 	float3   normalW   : NORMAL;       // normal in world
 	float3   tangentW  : TANGENT;      // tangent in world
 	float2   tex       : TEXCOORD;
+	nointerpolation float triArea : TRI_AREA;   // triangle's area in NDC (from DebugGS)
 };
 
 struct PS_OUT
@@ -194,6 +209,7 @@ void ComputeSumDirectionalLights(
 ///////////////////////////////////////////////////////////
 
 void ComputeSumPointLights(
+	ClusterLights cl,    // lights of the pixel's cluster
 	Material mat,
 	float3 pos,          // a position of the vertex
 	float3 normal,       // normal vector of the pixel
@@ -210,11 +226,11 @@ void ComputeSumPointLights(
 	float4 D = float4(0.0f, 0.0f, 0.0f, 0.0f);
 	float4 S = float4(0.0f, 0.0f, 0.0f, 0.0f);
 
-	for (int i = 0; i < gCurrNumPointLights; ++i)
+	for (uint i = 0; i < cl.numPoint; ++i)
 	{
 		ComputePointLight(
 			mat,
-			gPointLights[i],
+			gPointLights[gLightIdxs[cl.offset + i]],
 			pos,                 
 			normal,
 			toEye,
@@ -230,6 +246,7 @@ void ComputeSumPointLights(
 ///////////////////////////////////////////////////////////
 
 void ComputeSumSpotLights(
+	ClusterLights cl,     // lights of the pixel's cluster
 	Material mat,
 	float3 pos,           // a position of the vertex
 	float3 normal,        // normal vector of the pixel
@@ -257,9 +274,9 @@ void ComputeSumSpotLights(
 	}
 
     // ...compute the rest of spotlights
-    for (int i = 1; i < gCurrNumSpotLights; ++i)
+    for (uint i = 0; i < cl.numSpot; ++i)
     {
-        ComputeSpotLight(mat, gSpotLights[i], pos, normal, toEye, specPower, A, D, S);
+        ComputeSpotLight(mat, gSpotLights[gLightIdxs[cl.offset + cl.numPoint + i]], pos, normal, toEye, specPower, A, D, S);
 
         ambient += A;
         diffuse += D;
@@ -303,13 +320,16 @@ float4 PS_DebugLight(PS_IN pin, int debugType) : SV_Target
 
 	Material mat = (Material)pin.material;
 
+	// get lights which reach the cluster of this pixel
+	const ClusterLights cl = GetClusterLights(pin.posH, gClusterDims, gClusterScaleXY, gClusterSliceScale, gClusterSliceBias);
+
 	switch (debugType)
 	{
 		case SHOW_ONLY_LIGHTING:   // all: directed + point + spot
 		{
 			ComputeSumDirectionalLights(mat,           bumpedNormalW, toEyeW, specFactor, ambient, diffuse, spec);
-			ComputeSumPointLights      (mat, pin.posW, bumpedNormalW, toEyeW, specFactor, ambient, diffuse, spec);
-            ComputeSumSpotLights       (mat, pin.posW, bumpedNormalW, toEyeW, specFactor, ambient, diffuse, spec);
+			ComputeSumPointLights      (cl, mat, pin.posW, bumpedNormalW, toEyeW, specFactor, ambient, diffuse, spec);
+            ComputeSumSpotLights       (cl, mat, pin.posW, bumpedNormalW, toEyeW, specFactor, ambient, diffuse, spec);
 			break;
 		}
 		case SHOW_ONLY_DIRECTED_LIGHTING:
@@ -319,12 +339,12 @@ float4 PS_DebugLight(PS_IN pin, int debugType) : SV_Target
 		}
 		case SHOW_ONLY_POINT_LIGHTING:
 		{
-			ComputeSumPointLights(mat, pin.posW, bumpedNormalW, toEyeW, specFactor, ambient, diffuse, spec);
+			ComputeSumPointLights(cl, mat, pin.posW, bumpedNormalW, toEyeW, specFactor, ambient, diffuse, spec);
 			break;
 		}
 		case SHOW_ONLY_SPOT_LIGHTING:
 		{
-			ComputeSumSpotLights(mat, pin.posW, bumpedNormalW, toEyeW, specFactor, ambient, diffuse, spec);
+			ComputeSumSpotLights(cl, mat, pin.posW, bumpedNormalW, toEyeW, specFactor, ambient, diffuse, spec);
 			break;
 		}
 		default:
@@ -347,6 +367,45 @@ float4 PS_DebugMaterial(PS_IN pin) : SV_Target
 }
 
 
+// =================================================================================
+// performance heatmaps
+// =================================================================================
+
+float4 PS_DebugHeatmap(PS_IN pin, int debugType) : SV_Target
+{
+	switch (debugType)
+	{
+		case SHOW_LOD:
+		{
+			return float4(LodColor(gDrawLod), 1.0f);
+		}
+		case SHOW_LIGHT_COUNT:
+		{
+			// point and spot lights of the pixel's cluster
+			const ClusterLights cl = GetClusterLights(pin.posH, gClusterDims, gClusterScaleXY, gClusterSliceScale, gClusterSliceBias);
+			const float numLights  = (float)(cl.numPoint + cl.numSpot);
+
+			return float4(HeatColor(numLights / MAX_LIGHTS_HEAT), 1.0f);
+		}
+		case SHOW_TRIANGLE_DENSITY:
+		{
+			// NDC [-1,1]x[-1,1] has the area 4 so its quarter is the area of the viewport
+			const float numPixels    = pin.triArea * 0.25f * gViewportSize.x * gViewportSize.y;
+			const float trisPerPixel = 1.0f / max(numPixels, 0.001f);
+
+			// red starts at a triangle per pixel (it is too dense for the rasterizer)
+			return float4(HeatColor(trisPerPixel), 1.0f);
+		}
+		case SHOW_BATCHES:
+		{
+			return float4(HashColor(gDrawBatch), 1.0f);
+		}
+	}
+
+	return float4(1.0f, 0.0f, 1.0f, 1.0f);
+}
+
+
 // =================================================================================
 // PIXEL SHADERS (AN ENTRY POINT)
 // =================================================================================
@@ -384,6 +443,19 @@ PS_OUT PS(PS_IN pin)
             pout.color = float4(1, 1, 1, 1);
             break;
         }
+        case SHOW_OVERDRAW:
+        {
+            pout.color = float4(OVERDRAW_LAYER_COLOR, 1.0f);
+            break;
+        }
+        case SHOW_LOD:
+        case SHOW_LIGHT_COUNT:
+        case SHOW_TRIANGLE_DENSITY:
+        case SHOW_BATCHES:
+        {
+            pout.color = PS_DebugHeatmap(pin, gDebugType);
+            break;
+        }
 	}
 
 	pout.depth = pin.posH.z;
@@ -4,7 +4,9 @@
 // 
 // Created:     24.11.24
 // *********************************************************************************
-
+#include "LightHelper.hlsli"
+#include "TexTransformHelper.hlsli"
+#include "PackedVertex.hlsli"
 
 //
 // CONSTANT BUFFERS
@@ -12,25 +14,28 @@
 cbuffer cbVSPerFrame : register(b0)
 {
 	matrix gViewProj;
+	float  gGameTime;
 };
 
+// table of all the materials (is re-uploaded only when materials are changed)
+StructuredBuffer<Material> gMaterials : register(t0);
+
 //
 // TYPEDEFS
 //
 struct VS_IN
 {
 	// data per instance
-	row_major matrix   world             : WORLD;
-	row_major matrix   worldInvTranspose : WORLD_INV_TRANSPOSE;
-	row_major matrix   texTransform      : TEX_TRANSFORM;
-	row_major float4x4 material          : MATERIAL;
+	row_major float3x4 world             : WORLD;
+	row_major float2x4 texTransform      : TEX_TRANSFORM;
+	uint               materialIdx       : MATERIAL_IDX;
 	uint               instanceID        : SV_InstanceID;
 
 	// data per vertex
 	float3 posL        : POSITION;     // vertex position in local space
 	float2 tex         : TEXCOORD;
-	float3 normalL     : NORMAL;       // vertex normal in local space
-	float3 tangentL    : TANGENT;      // tangent in local space
+	float3 normalL     : NORMAL;       // vertex normal in local space (packed)
+	float3 tangentL    : TANGENT;      // tangent in local space (packed)
 };
 
 struct VS_OUT
@@ -41,6 +46,7 @@ struct VS_OUT
 	float3   normalW   : NORMAL;       // normal in world
 	float3   tangentW  : TANGENT;      // tangent in world
 	float2   tex       : TEXCOORD;
+	nointerpolation float triArea : TRI_AREA;   // is computed by DebugGS (triangle density)
 };
 
 
@@ -51,22 +57,26 @@ VS_OUT VS(VS_IN vin)
 {
 	VS_OUT vout;
 
-	vout.material = vin.material;
+	// fetch material of this instance from the table
+	const Material mat = gMaterials[vin.materialIdx];
+	vout.material = float4x4(mat.ambient, mat.diffuse, mat.specular, mat.reflect);
 
 	// transform pos from local space to world space
-	vout.posW = mul(float4(vin.posL, 1.0f), vin.world).xyz;
+	vout.posW = mul(vin.world, float4(vin.posL, 1.0f));
 
 	// transform to homogeneous clip space
 	vout.posH = mul(float4(vout.posW, 1.0f), gViewProj);
 
 	// interpolating of normal can unnormalize it, so normalize it back
-	vout.normalW = normalize(mul(vin.normalL, (float3x3)vin.worldInvTranspose));
+	vout.normalW = normalize(mul((float3x3)vin.world, UnpackUnitVector(vin.normalL)));
 
 	// calculate the tangent and normalize it
-	vout.tangentW = normalize(mul(vin.tangentL, (float3x3)vin.worldInvTranspose));
+	vout.tangentW = normalize(mul((float3x3)vin.world, UnpackUnitVector(vin.tangentL)));
 
 	// output vertex texture attributes for interpolation across triangle
-	vout.tex = mul(float4(vin.tex, 0.0f, 1.0f), vin.texTransform).xy;
+	vout.tex = ComputeTexCoords(vin.tex, vin.texTransform, gGameTime);
+
+	vout.triArea = 0;
 
 	return vout;
 }
@@ -0,0 +1,37 @@
+// *********************************************************************************
+// Filename:    DeferredCompositePS.hlsl
+// Description: a pixel shader which copies pixels lit by the deferred lighting
+//              into the scene color (by the fullscreen triangle of UpscaleVS.hlsl);
+//              pixels without geometry are clipped so the scene color is kept
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// GLOBALS
+//
+Texture2D gLitColor : register(t1);   // DeferredShading::PS_LIT_COLOR_SLOT (t0 is the sky cube map)
+
+
+//
+// TYPEDEFS
+//
+struct PS_IN
+{
+    float4 posH : SV_POSITION;
+    float2 tex  : TEXCOORD;
+};
+
+
+//
+// PIXEL SHADER
+//
+float4 PS(PS_IN pin) : SV_Target
+{
+    const float4 color = gLitColor.Load(int3(pin.posH.xy, 0));
+
+    clip(color.a - 0.5f);
+
+    return float4(color.rgb, 1.0f);
+}
@@ -0,0 +1,206 @@
+// *********************************************************************************
+// Filename:    DeferredLightingCS.hlsl
+// Description: a compute shader of the deferred lighting: each thread is a pixel
+//              of a 8x8 tile; the surface is read from the G-buffer, its position
+//              is reconstructed by the depth, and it is lit by the directional
+//              lights (with the sun's shadows), the flashlight and point/spot
+//              lights of its cluster (the same lists as of the clustered forward
+//              shading) so each pixel is lit only once whatever the overdraw is;
+//              pixels without geometry get alpha 0 (they aren't composited)
+//
+//              NOTE: slots of the light buffers and const buffers are the same
+//                    as in LightPS.hlsl (they are bound to CS by the same slots)
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "LightHelper.hlsli"
+#include "GBuffer.hlsli"
+
+
+//
+// GLOBALS
+//
+StructuredBuffer<Material> gMaterials : register(t0);   // the same table as of the light VS
+
+Texture2D<float4>  gAlbedo        : register(t1);
+Texture2D<float2>  gNormals       : register(t2);
+Texture2D<uint>    gMaterialSpecs : register(t3);
+Texture2D<float>   gDepth         : register(t4);
+
+RWTexture2D<float4> gLitColor     : register(u0);
+
+SamplerState       gSampleType    : register(s0);   // linear clamp (of the sky fog LUT)
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbPerFrame    : register(b0)
+{
+    // light sources data (point/spot lights are in structured buffers)
+    DirectionalLight  gDirLights[3];
+    float3            gEyePosW;                // eye position in world space
+    int               gCurrNumPointLights;
+    int               gCurrNumSpotLights;
+
+    // params of the light clusters grid
+    uint3             gClusterDims;
+    float2            gClusterScaleXY;         // pixel => cluster xy
+    float             gClusterSliceScale;      // view depth => cluster z
+    float             gClusterSliceBias;
+
+    // the volume of baked static lights (see StaticLights.hlsli)
+    float3            gStaticLightsMin;
+    int               gHasStaticLights;
+    float3            gStaticLightsInvSize;
+    float             gStaticLightsNormalBias;
+};
+
+cbuffer cbRareChanged : register(b1)
+{
+    float3 gFixedFogColor;       // what is the color of fog?
+    float  gFogStart;            // how far from camera the fog starts?
+    float  gFogRange;            // how far from camera the object is fully fogged?
+
+    int    gNumOfDirLights;      // current number of directional light sources
+
+    int    gFogEnabled;          // turn on/off the fog effect
+    int    gTurnOnFlashLight;    // turn on/off the flashlight
+    int    gAlphaClipping;       // turn on/off alpha clipping
+}
+
+cbuffer cbDeferred    : register(b9)
+{
+    float4x4 gInvViewProj;       // clip => world
+    float4   gViewDepth;         // dot(float4(posW, 1), gViewDepth) == view depth
+    uint     gWidth;             // the rendered part of the G-buffer
+    uint     gHeight;
+    float    gInvWidth;
+    float    gInvHeight;
+};
+
+#include "ClusteredLights.hlsli"
+#include "ShadowMaps.hlsli"
+#include "SkyFog.hlsli"
+#include "StaticLights.hlsli"
+
+
+//
+// COMPUTE SHADER
+//
+[numthreads(8, 8, 1)]
+void CS(uint3 dtid : SV_DispatchThreadID)
+{
+    if ((dtid.x >= gWidth) || (dtid.y >= gHeight))
+        return;
+
+    const int3  texel = int3(dtid.xy, 0);
+    const float depth = gDepth.Load(texel);
+
+    // no geometry: the far plane
+    if (depth >= 1.0f)
+    {
+        gLitColor[dtid.xy] = float4(0.0f, 0.0f, 0.0f, 0.0f);
+        return;
+    }
+
+    // reconstruct the position in world by the depth
+    const float2 pixel = float2(dtid.xy) + 0.5f;
+    const float4 posC  = float4(pixel.x * gInvWidth * 2.0f - 1.0f, 1.0f - pixel.y * gInvHeight * 2.0f, depth, 1.0f);
+    float4       posW  = mul(posC, gInvViewProj);
+    posW.xyz /= posW.w;
+
+    const float viewDepth = dot(float4(posW.xyz, 1.0f), gViewDepth);
+
+    // unpack the surface
+    const float4 albedo = gAlbedo.Load(texel);
+    const float3 normalW = DecodeOctahedral(gNormals.Load(texel));
+
+    uint  materialIdx;
+    float specPower;
+    UnpackMaterialSpec(gMaterialSpecs.Load(texel), materialIdx, specPower);
+
+    const Material mat = gMaterials[materialIdx];
+
+    float3 toEyeW = gEyePosW - posW.xyz;
+    const float distToEye = length(toEyeW);
+    toEyeW /= distToEye;
+
+    // --------------------  LIGHT   --------------------
+
+    float4 ambient = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    float4 diffuse = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    float4 spec    = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    float4 A, D, S;
+
+    // only the sun (the first directional light) casts shadows
+    const float shadow = ComputeShadowFactor(posW.xyz, viewDepth);
+
+    for (int i = 0; i < gNumOfDirLights; ++i)
+    {
+        ComputeDirectionalLight(mat, gDirLights[i], normalW, toEyeW, specPower, A, D, S);
+
+        const float lit = (i == 0) ? shadow : 1.0f;
+
+        ambient += A;
+        diffuse += D * lit;
+        spec    += S * lit;
+    }
+
+    // get lights which reach the cluster of this pixel
+    const ClusterLights cl = GetClusterLights(
+        float4(pixel, 0.0f, viewDepth),
+        gClusterDims,
+        gClusterScaleXY,
+        gClusterSliceScale,
+        gClusterSliceBias);
+
+    for (uint p = 0; p < cl.numPoint; ++p)
+    {
+        ComputePointLight(mat, gPointLights[gLightIdxs[cl.offset + p]], posW.xyz, normalW, toEyeW, specPower, A, D, S);
+
+        ambient += A;
+        diffuse += D;
+        spec    += S;
+    }
+
+    if (gTurnOnFlashLight)
+    {
+        ComputeSpotLight(mat, gSpotLights[0], posW.xyz, normalW, toEyeW, specPower, A, D, S);
+
+        ambient += A;
+        diffuse += D;
+        spec    += S;
+    }
+
+    for (uint s = 0; s < cl.numSpot; ++s)
+    {
+        ComputeSpotLight(mat, gSpotLights[gLightIdxs[cl.offset + cl.numPoint + s]], posW.xyz, normalW, toEyeW, specPower, A, D, S);
+
+        ambient += A;
+        diffuse += D;
+        spec    += S;
+    }
+
+    if (gHasStaticLights)
+    {
+        ComputeStaticLights(gSampleType, mat, posW.xyz, normalW, A, D);
+
+        ambient += A;
+        diffuse += D;
+    }
+
+    float4 litColor = albedo * (ambient + diffuse) + spec;
+
+    // ---------------------  FOG  ----------------------
+
+    // (the same sky LUT as of the light PS so both paths are fogged alike)
+    if (gFogEnabled)
+    {
+        const float  fogLerp  = saturate((distToEye - gFogStart) / gFogRange);
+        const float3 fogColor = GetSkyFogColor(gSampleType, -toEyeW) * gFixedFogColor;
+        litColor.rgb = lerp(litColor.rgb, fogColor, fogLerp);
+    }
+
+    gLitColor[dtid.xy] = float4(litColor.rgb, 1.0f);
+}
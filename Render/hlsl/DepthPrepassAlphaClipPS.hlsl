@@ -0,0 +1,34 @@
+//
+// GLOBALS
+//
+// NOTE: slots are the same as of the diffuse maps in LightPS.hlsl
+//       (so the main pass doesn't rebind them)
+Texture2D      gDiffuseMap  : register(t2);
+Texture2DArray gDiffuseMaps : register(t28);
+SamplerState   gSampleType  : register(s0);
+
+//
+// TYPEDEFS
+//
+struct PS_IN
+{
+    float4               posH      : SV_POSITION;
+    float2               tex       : TEXCOORD;
+    nointerpolation int  diffLayer : TEX_LAYER;
+};
+
+//
+// PIXEL SHADER: only clips transparent pixels, the depth is written by the output merger
+//
+void PS(PS_IN pin)
+{
+    // the same sampling and threshold as in the light shader
+    float alpha;
+
+    if (pin.diffLayer >= 0)
+        alpha = gDiffuseMaps.Sample(gSampleType, float3(pin.tex, pin.diffLayer)).a;
+    else
+        alpha = gDiffuseMap.Sample(gSampleType, pin.tex).a;
+
+    clip(alpha - 0.1f);
+}
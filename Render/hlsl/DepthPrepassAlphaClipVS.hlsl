@@ -0,0 +1,63 @@
+// *********************************************************************************
+// Filename:    DepthPrepassAlphaClipVS.hlsl
+// Description: a vertex shader of the depth pre-pass for alpha clipped geometry
+//              (foliage, fences, etc.): along with the position it outputs texture
+//              coords and layers of the material's diffuse map so the pixel shader
+//              clips exactly the same pixels as the main pass
+//
+//              NOTE: the clip position is computed exactly as in LightVS.hlsl
+//                    (the main pass is tested by DEPTH_EQUAL against this depth)
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "TexTransformHelper.hlsli"
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbVSPerFrame : register(b0)
+{
+    matrix gViewProj;
+    float  gGameTime;
+};
+
+// layers of the materials diffuse/normal maps in the packed texture arrays (-1: not packed)
+StructuredBuffer<int2> gMaterialTexLayers : register(t1);
+
+//
+// TYPEDEFS
+//
+struct VS_IN
+{
+    // data per instance
+    row_major float3x4 world        : WORLD;
+    row_major float2x4 texTransform : TEX_TRANSFORM;
+    uint               materialIdx  : MATERIAL_IDX;
+
+    // data per vertex
+    float3   posL                   : POSITION;     // vertex position in local space
+    float2   tex                    : TEXCOORD;
+};
+
+struct VS_OUT
+{
+    precise float4       posH       : SV_POSITION;  // homogeneous position
+    float2               tex        : TEXCOORD;
+    nointerpolation int  diffLayer  : TEX_LAYER;    // -1: the diffuse map isn't packed
+};
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(VS_IN vin)
+{
+    VS_OUT vout;
+
+    const float3 posW = mul(vin.world, float4(vin.posL, 1.0f));
+    vout.posH = mul(float4(posW, 1.0f), gViewProj);
+
+    vout.tex       = ComputeTexCoords(vin.tex, vin.texTransform, gGameTime);
+    vout.diffLayer = gMaterialTexLayers[vin.materialIdx].x;
+
+    return vout;
+}
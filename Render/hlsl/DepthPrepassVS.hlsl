@@ -0,0 +1,49 @@
+// *********************************************************************************
+// Filename:    DepthPrepassVS.hlsl
+// Description: a vertex shader of the depth pre-pass for opaque geometry:
+//              only positions are fetched and there is no pixel shader at all
+//
+//              NOTE: the clip position is computed exactly as in LightVS.hlsl
+//                    (the main pass is tested by DEPTH_EQUAL against this depth)
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbVSPerFrame : register(b0)
+{
+    matrix gViewProj;
+    float  gGameTime;
+};
+
+//
+// TYPEDEFS
+//
+struct VS_IN
+{
+    // data per instance
+    row_major float3x4 world   : WORLD;
+
+    // data per vertex
+    float3   posL              : POSITION;     // vertex position in local space
+};
+
+struct VS_OUT
+{
+    precise float4 posH        : SV_POSITION;  // homogeneous position
+};
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(VS_IN vin)
+{
+    VS_OUT vout;
+
+    const float3 posW = mul(vin.world, float4(vin.posL, 1.0f));
+    vout.posH = mul(float4(posW, 1.0f), gViewProj);
+
+    return vout;
+}
@@ -0,0 +1,32 @@
+// *********************************************************************************
+// Filename:    EditorGrid.hlsli
+// Description: common types and constants of the procedural editor grid
+//              (is included by the grid shaders; see Render::EditorGrid)
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// TYPEDEFS
+//
+struct VS_OUT
+{
+    float4 posH : SV_POSITION;
+    float3 posW : POSITION;
+};
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbEditorGrid : register(b7)
+{
+    matrix gViewProj;
+    float3 gCameraPosW;
+    float  gCellSize;              // distance btw minor lines
+    float  gMajorCellSize;         // distance btw major lines
+    float  gFadeDistance;          // the grid fades out till this distance (the half size of the plane)
+    float  gHeight;                // Y of the ground plane
+    float  gLineWidth;             // in pixels
+};
@@ -0,0 +1,67 @@
+// *********************************************************************************
+// Filename:    EditorGridPS.hlsl
+// Description: a pixel shader of the editor grid: lines are computed analytically
+//              by world coords of the pixel; their screen derivatives keep lines
+//              about gLineWidth pixels wide at any distance, and a level of lines
+//              fades out where its cells become too small on screen (so there is
+//              no aliasing or moire far away); the X and Z axes are colored
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "EditorGrid.hlsli"
+
+
+//
+// HELPERS
+//
+
+// coverage [0,1] of the closest line of the grid with the cell size
+float GridLines(const float2 posXZ, const float cellSize)
+{
+    const float2 coord = posXZ / cellSize;
+    const float2 deriv = max(fwidth(coord), 1e-5f);
+
+    // distance to the closest line in pixels
+    const float2 dist  = abs(frac(coord - 0.5f) - 0.5f) / deriv;
+    const float  line_ = 1.0f - saturate(min(dist.x, dist.y) - 0.5f * gLineWidth + 0.5f);
+
+    // a cell is smaller than a few pixels: lines merge into a flat color
+    const float  lod   = 1.0f - smoothstep(0.1f, 0.3f, max(deriv.x, deriv.y));
+
+    return line_ * lod;
+}
+
+///////////////////////////////////////////////////////////
+
+// coverage [0,1] of a line along the axis by the distance to it
+float AxisLine(const float distToAxis)
+{
+    const float deriv = max(fwidth(distToAxis), 1e-5f);
+    return 1.0f - saturate(abs(distToAxis) / deriv - gLineWidth + 0.5f);
+}
+
+
+//
+// PIXEL SHADER
+//
+float4 PS(VS_OUT pin) : SV_Target
+{
+    const float2 posXZ = pin.posW.xz;
+
+    const float minor  = GridLines(posXZ, gCellSize);
+    const float major  = GridLines(posXZ, gMajorCellSize);
+    const float axisX  = AxisLine(pin.posW.z);          // the X axis goes along z == 0
+    const float axisZ  = AxisLine(pin.posW.x);
+
+    float4 color = float4(0.5f, 0.5f, 0.5f, 0.35f * minor);
+    color        = lerp(color, float4(0.7f, 0.7f, 0.7f, 0.6f), major);
+    color        = lerp(color, float4(0.9f, 0.2f, 0.2f, 0.9f), axisX);
+    color        = lerp(color, float4(0.2f, 0.3f, 0.9f, 0.9f), axisZ);
+
+    // the grid fades out by the distance from the camera
+    const float dist = distance(posXZ, gCameraPosW.xz);
+    color.a *= 1.0f - smoothstep(0.5f * gFadeDistance, gFadeDistance, dist);
+
+    clip(color.a - 0.004f);
+    return color;
+}
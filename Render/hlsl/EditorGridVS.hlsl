@@ -0,0 +1,26 @@
+// *********************************************************************************
+// Filename:    EditorGridVS.hlsl
+// Description: a vertex shader of the editor grid: a quad over the ground plane
+//              around the camera is expanded from SV_VertexID (there is no
+//              vertex buffer; it is drawn as a triangle strip of 4 vertices)
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "EditorGrid.hlsli"
+
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(uint vertexID : SV_VertexID)
+{
+    VS_OUT vout;
+
+    // (-1,-1), (1,-1), (-1,1), (1,1)
+    const float2 corner = float2((vertexID & 1) ? 1.0f : -1.0f, (vertexID & 2) ? 1.0f : -1.0f);
+
+    vout.posW = float3(gCameraPosW.x + corner.x * gFadeDistance, gHeight, gCameraPosW.z + corner.y * gFadeDistance);
+    vout.posH = mul(float4(vout.posW, 1.0f), gViewProj);
+
+    return vout;
+}
@@ -0,0 +1,37 @@
+//
+// GLOBALS
+//
+// NOTE: slots must be the same as in the Render::EntityIdBuffer
+Texture2D    gDiffuseMap : register(t1);
+SamplerState gSampleType : register(s2);
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbEntityIds : register(b11)
+{
+    matrix gViewProj;          // is narrowed to the picked pixel
+    uint   gAlphaClipping;
+};
+
+//
+// TYPEDEFS
+//
+struct PS_IN
+{
+    float4                posH   : SV_POSITION;
+    float2                tex    : TEXCOORD;
+    nointerpolation uint  enttID : ENTT_ID;
+};
+
+//
+// PIXEL SHADER: output ID of the entity into the R32_UINT target
+//
+uint PS(PS_IN pin) : SV_Target
+{
+    // the same threshold as in the light shader so picking matches what we see
+    if (gAlphaClipping)
+        clip(gDiffuseMap.Sample(gSampleType, pin.tex).a - 0.1f);
+
+    return pin.enttID;
+}
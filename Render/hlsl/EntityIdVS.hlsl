@@ -0,0 +1,45 @@
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbEntityIds : register(b11)
+{
+    matrix gViewProj;          // is narrowed to the picked pixel
+    uint   gAlphaClipping;
+};
+
+//
+// TYPEDEFS
+//
+struct VS_IN
+{
+    // data per instance
+    row_major float3x4 world             : WORLD;
+    uint               enttID            : ENTT_ID;
+
+    // data per vertex
+    float3   posL       : POSITION;     // vertex position in local space
+    float2   tex        : TEXCOORD;
+};
+
+struct VS_OUT
+{
+    float4                posH   : SV_POSITION;
+    float2                tex    : TEXCOORD;
+    nointerpolation uint  enttID : ENTT_ID;
+};
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(VS_IN vin)
+{
+    VS_OUT vout;
+
+    const float3 posW = mul(vin.world, float4(vin.posL, 1.0f));
+
+    vout.posH   = mul(float4(posW, 1.0f), gViewProj);
+    vout.tex    = vin.tex;
+    vout.enttID = vin.enttID;
+
+    return vout;
+}
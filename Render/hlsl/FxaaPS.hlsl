@@ -0,0 +1,213 @@
+// *********************************************************************************
+// Filename:    FxaaPS.hlsl
+// Description: a pixel shader of the post-process anti-aliasing (FXAA, the quality
+//              preset): edges are found by the luma contrast of neighbours, then we
+//              search for the ends of each edge and blend the pixel with its
+//              neighbour across the edge by the distance to the nearest end;
+//
+//              the scene texture can be rendered with a lower resolution (dynamic
+//              resolution) so the anti-aliasing is done in its texels and the
+//              result is stretched to the whole back buffer (the same as UpscalePS)
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+// ==========================
+// GLOBALS
+// ==========================
+Texture2D    gScene        : register(t0);
+SamplerState gSampleType   : register(s0);
+
+static const float EDGE_THRESHOLD_MIN = 0.0312f;    // skip dark areas
+static const float EDGE_THRESHOLD_MAX = 0.125f;     // the min luma contrast (relative to the max luma) of an edge
+static const float SUBPIXEL_QUALITY   = 0.75f;      // how much to blend sub-pixel aliasing
+
+// steps (in texels) of the search for the edge ends
+static const int   NUM_SEARCH_STEPS = 12;
+static const float SEARCH_STEPS[NUM_SEARCH_STEPS] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.5f, 2.0f, 2.0f, 2.0f, 2.0f, 4.0f, 8.0f };
+
+
+// ==========================
+// CONSTANT BUFFERS
+// ==========================
+cbuffer cbUpscale : register(b12)
+{
+	float2 gUvScale;             // the rendered part of the scene texture
+	float2 gUvMax;               // the center of the last rendered texel
+	float2 gTexelSize;           // 1 / size of the scene texture
+	float2 gPadding;
+};
+
+
+// ==========================
+// TYPEDEFS
+// ==========================
+struct PS_IN
+{
+	float4 posH : SV_POSITION;
+	float2 tex  : TEXCOORD;
+};
+
+
+// ==========================
+// HELPERS
+// ==========================
+float Luma(const float3 rgb)
+{
+	// perceived brightness (roughly in gamma space)
+	return sqrt(dot(rgb, float3(0.299f, 0.587f, 0.114f)));
+}
+
+float SampleLuma(const float2 uv)
+{
+	return Luma(gScene.SampleLevel(gSampleType, min(uv, gUvMax), 0).rgb);
+}
+
+float SampleLuma(const float2 uv, const float2 offset)
+{
+	return SampleLuma(uv + offset * gTexelSize);
+}
+
+
+// ==========================
+// PIXEL SHADER
+// ==========================
+float4 PS(PS_IN pin) : SV_Target
+{
+	const float2 uv          = min(pin.tex * gUvScale, gUvMax);
+	const float3 colorCenter = gScene.SampleLevel(gSampleType, uv, 0).rgb;
+
+	// luma of the pixel and its direct neighbours (+Y is down in texture space)
+	const float lumaC = Luma(colorCenter);
+	const float lumaU = SampleLuma(uv, float2( 0, -1));
+	const float lumaD = SampleLuma(uv, float2( 0,  1));
+	const float lumaL = SampleLuma(uv, float2(-1,  0));
+	const float lumaR = SampleLuma(uv, float2( 1,  0));
+
+	const float lumaMin   = min(lumaC, min(min(lumaU, lumaD), min(lumaL, lumaR)));
+	const float lumaMax   = max(lumaC, max(max(lumaU, lumaD), max(lumaL, lumaR)));
+	const float lumaRange = lumaMax - lumaMin;
+
+	// not an edge
+	if (lumaRange < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD_MAX))
+		return float4(colorCenter, 1.0f);
+
+	const float lumaUL = SampleLuma(uv, float2(-1, -1));
+	const float lumaUR = SampleLuma(uv, float2( 1, -1));
+	const float lumaDL = SampleLuma(uv, float2(-1,  1));
+	const float lumaDR = SampleLuma(uv, float2( 1,  1));
+
+	const float lumaUD           = lumaU + lumaD;
+	const float lumaLR           = lumaL + lumaR;
+	const float lumaLeftCorners  = lumaUL + lumaDL;
+	const float lumaRightCorners = lumaUR + lumaDR;
+	const float lumaUpCorners    = lumaUL + lumaUR;
+	const float lumaDownCorners  = lumaDL + lumaDR;
+
+	// is the edge horizontal or vertical?
+	const float edgeHorz =
+		abs(-2.0f * lumaL + lumaLeftCorners) +
+		abs(-2.0f * lumaC + lumaUD) * 2.0f +
+		abs(-2.0f * lumaR + lumaRightCorners);
+
+	const float edgeVert =
+		abs(-2.0f * lumaU + lumaUpCorners) +
+		abs(-2.0f * lumaC + lumaLR) * 2.0f +
+		abs(-2.0f * lumaD + lumaDownCorners);
+
+	const bool isHorz = (edgeHorz >= edgeVert);
+
+	// which side of the pixel the edge is on (the steepest gradient)
+	const float luma1     = (isHorz) ? lumaU : lumaL;
+	const float luma2     = (isHorz) ? lumaD : lumaR;
+	const float gradient1 = luma1 - lumaC;
+	const float gradient2 = luma2 - lumaC;
+
+	const bool  is1Steepest    = (abs(gradient1) >= abs(gradient2));
+	const float gradientScaled = 0.25f * max(abs(gradient1), abs(gradient2));
+
+	float stepLength = (isHorz) ? gTexelSize.y : gTexelSize.x;
+	float lumaLocalAverage;
+
+	if (is1Steepest)
+	{
+		stepLength       = -stepLength;
+		lumaLocalAverage = 0.5f * (luma1 + lumaC);
+	}
+	else
+	{
+		lumaLocalAverage = 0.5f * (luma2 + lumaC);
+	}
+
+	// move to the middle of the edge and search for its ends in both directions
+	float2 edgeUv = uv;
+
+	if (isHorz)
+		edgeUv.y += 0.5f * stepLength;
+	else
+		edgeUv.x += 0.5f * stepLength;
+
+	const float2 offset = (isHorz) ? float2(gTexelSize.x, 0.0f) : float2(0.0f, gTexelSize.y);
+
+	float2 uv1      = edgeUv - offset;
+	float2 uv2      = edgeUv + offset;
+	float  lumaEnd1 = 0.0f;
+	float  lumaEnd2 = 0.0f;
+	bool   reached1 = false;
+	bool   reached2 = false;
+
+	[loop]
+	for (int i = 0; i < NUM_SEARCH_STEPS; ++i)
+	{
+		if (!reached1)
+		{
+			lumaEnd1 = SampleLuma(uv1) - lumaLocalAverage;
+			reached1 = (abs(lumaEnd1) >= gradientScaled);
+
+			if (!reached1)
+				uv1 -= offset * SEARCH_STEPS[i];
+		}
+
+		if (!reached2)
+		{
+			lumaEnd2 = SampleLuma(uv2) - lumaLocalAverage;
+			reached2 = (abs(lumaEnd2) >= gradientScaled);
+
+			if (!reached2)
+				uv2 += offset * SEARCH_STEPS[i];
+		}
+
+		if (reached1 && reached2)
+			break;
+	}
+
+	// the distances to the ends of the edge
+	const float dist1 = (isHorz) ? (uv.x - uv1.x) : (uv.y - uv1.y);
+	const float dist2 = (isHorz) ? (uv2.x - uv.x) : (uv2.y - uv.y);
+
+	const bool  isDirection1  = (dist1 < dist2);
+	const float distFinal     = min(dist1, dist2);
+	const float edgeThickness = dist1 + dist2;
+
+	// blend only if the luma variation at the nearest end is coherent with the center
+	const bool  isLumaCenterSmaller = (lumaC < lumaLocalAverage);
+	const bool  isCorrectVariation  = (((isDirection1) ? lumaEnd1 : lumaEnd2) < 0.0f) != isLumaCenterSmaller;
+	const float pixelOffset         = (isCorrectVariation) ? (0.5f - distFinal / edgeThickness) : 0.0f;
+
+	// sub-pixel aliasing (thin lines, single pixels)
+	const float lumaAverage  = (1.0f / 12.0f) * (2.0f * (lumaUD + lumaLR) + lumaLeftCorners + lumaRightCorners);
+	const float subPixel1    = saturate(abs(lumaAverage - lumaC) / lumaRange);
+	const float subPixel2    = (-2.0f * subPixel1 + 3.0f) * subPixel1 * subPixel1;
+	const float subPixelOffs = subPixel2 * subPixel2 * SUBPIXEL_QUALITY;
+
+	const float finalOffset = max(pixelOffset, subPixelOffs);
+	float2      finalUv     = uv;
+
+	if (isHorz)
+		finalUv.y += finalOffset * stepLength;
+	else
+		finalUv.x += finalOffset * stepLength;
+
+	return float4(gScene.SampleLevel(gSampleType, min(finalUv, gUvMax), 0).rgb, 1.0f);
+}
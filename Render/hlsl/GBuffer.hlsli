@@ -0,0 +1,34 @@
+// *********************************************************************************
+// Filename:    GBuffer.hlsli
+// Description: a layout of the G-buffer of the deferred shading and packing of
+//              its values:
+//
+//              RT0 (RGBA8):   albedo (the diffuse map); alpha isn't used
+//              RT1 (RG16):    the bumped normal in world (octahedral)
+//              RT2 (R32UINT): the material idx (low 24 bits) | spec (high 8 bits)
+//
+//              NOTE: formats must be the same as in the Render::DeferredShading
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "Octahedral.hlsli"
+
+static const uint GBUFFER_MATERIAL_IDX_MASK = 0x00FFFFFF;
+
+
+//
+// HELPERS
+//
+uint PackMaterialSpec(uint materialIdx, float specPower)
+{
+    // spec is a specular map value [0,1]
+    return (materialIdx & GBUFFER_MATERIAL_IDX_MASK) | ((uint)(saturate(specPower) * 255.0f + 0.5f) << 24);
+}
+
+///////////////////////////////////////////////////////////
+
+void UnpackMaterialSpec(uint packed, out uint materialIdx, out float specPower)
+{
+    materialIdx = packed & GBUFFER_MATERIAL_IDX_MASK;
+    specPower   = (float)(packed >> 24) * (1.0f / 255.0f);
+}
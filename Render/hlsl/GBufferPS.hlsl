@@ -0,0 +1,104 @@
+// *********************************************************************************
+// Filename:    GBufferPS.hlsl
+// Description: a pixel shader of the G-buffer pass of the deferred shading:
+//              geometry goes through the light VS and its surface (albedo, the
+//              bumped normal, spec and the material idx) is written into the
+//              G-buffer instead of lighting (see DeferredLightingCS.hlsl)
+//
+//              NOTE: textures are sampled the same way as in LightPS.hlsl
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "LightHelper.hlsli"
+#include "GBuffer.hlsli"
+
+
+//
+// GLOBALS
+//
+Texture2D      gTextures[22] : register(t1);
+
+// packed diffuse/normal maps of materials (are sampled by layers from the VS)
+Texture2DArray gDiffuseMaps  : register(t28);
+Texture2DArray gNormalMaps   : register(t29);
+SamplerState   gSampleType   : register(s0);
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbRareChanged : register(b1)
+{
+    float3 gFixedFogColor;
+    float  gFogStart;
+    float  gFogRange;
+
+    int    gNumOfDirLights;
+
+    int    gFogEnabled;
+    int    gTurnOnFlashLight;
+    int    gAlphaClipping;       // turn on/off alpha clipping
+}
+
+
+//
+// TYPEDEFS
+//
+struct PS_IN
+{
+    float4x4 material           : MATERIAL;
+    float4   posH               : SV_POSITION;  // homogeneous position
+    float3   posW               : POSITION;     // position in world
+    float3   normalW            : NORMAL;       // normal in world
+    float3   tangentW           : TANGENT;      // tangent in world
+    float2   tex                : TEXCOORD;
+    nointerpolation int2 texLayers : TEX_LAYERS;   // x: diffuse, y: normal (-1: not packed)
+    uint     instanceID         : SV_InstanceID;
+    nointerpolation uint materialIdx : MATERIAL_IDX;
+};
+
+struct PS_OUT
+{
+    float4 albedo       : SV_Target0;
+    float2 normal       : SV_Target1;
+    uint   materialSpec : SV_Target2;
+};
+
+
+//
+// PIXEL SHADER
+//
+PS_OUT PS(PS_IN pin)
+{
+    // (layers are the same for the whole primitive so the branch is coherent)
+    float4 textureColor;
+
+    if (pin.texLayers.x >= 0)
+        textureColor = gDiffuseMaps.Sample(gSampleType, float3(pin.tex, pin.texLayers.x));
+    else
+        textureColor = gTextures[1].Sample(gSampleType, pin.tex);
+
+    if (gAlphaClipping)
+        clip(textureColor.a - 0.1f);
+
+    // --------------------  NORMAL MAP   --------------------
+
+    float3 normalW = normalize(pin.normalW);
+    float3 normalMap;
+
+    if (pin.texLayers.y >= 0)
+        normalMap = gNormalMaps.Sample(gSampleType, float3(pin.tex, pin.texLayers.y)).rgb;
+    else
+        normalMap = gTextures[6].Sample(gSampleType, pin.tex).rgb;
+
+    const float3 bumpedNormalW = NormalSampleToWorldSpace(normalMap, normalW, pin.tangentW);
+
+    // -------------------------------------------------------
+
+    PS_OUT pout;
+    pout.albedo       = float4(textureColor.rgb, 1.0f);
+    pout.normal       = EncodeOctahedral(bumpedNormalW);
+    pout.materialSpec = PackMaterialSpec(pin.materialIdx, 0.0f);   // no specular maps yet (as in LightPS)
+
+    return pout;
+}
@@ -0,0 +1,269 @@
+// *********************************************************************************
+// Filename:    GpuCullCS.hlsl
+// Description: a compute shader for GPU-driven rendering: each thread tests
+//              a single instance record against the frustum and the Hi-Z
+//              pyramid, selects its LOD and appends the record into the range
+//              of its (subset, LOD) draw in the visible instances buffer;
+//              the instance count of the draw is incremented right in the
+//              DrawIndexedInstancedIndirect args buffer
+//
+//              NOTE: args of each draw are 5 uints: indexCount, instanceCount,
+//                    startIndex, baseVertex, startInstance (is the offset of
+//                    the draw's range in the visible instances buffer)
+//              NOTE: the Hi-Z test is the same as on CPU (see HiZBuffer::IsVisible)
+//                    but by the AABB of the bounding sphere
+//              NOTE: if a record with clusters gets LOD 0 each its cluster (meshlet)
+//                    is tested separately and has its own draw
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// TYPEDEFS
+//
+struct InstanceBounds
+{
+    float3 center;
+    float  radius;
+    uint   drawIdx;                // the draw of LOD 0 or of the first cluster
+    uint   numLods;                // draws of LOD i > 0 go after draws of LOD 0 (or of clusters)
+    uint   clusterStart;
+    uint   numClusters;            // 0: LOD 0 is a single draw
+};
+
+struct Cluster
+{
+    float3 center;                 // in model space
+    float  radius;
+    float3 coneAxis;
+    float  coneCutoff;             // 1: is never backfacing
+};
+
+
+//
+// GLOBALS
+//
+static const uint INSTANCE_SIZE = 96;      // sizeof(ConstBufType::InstancedData)
+static const uint ARGS_STRIDE   = 20;      // 5 uints per draw
+
+ByteAddressBuffer                gInstances        : register(t0);
+StructuredBuffer<InstanceBounds> gBounds           : register(t1);
+Texture2D<float>                 gHiZ              : register(t2);
+StructuredBuffer<Cluster>        gClusters         : register(t3);
+
+RWByteAddressBuffer              gArgs             : register(u0);
+RWByteAddressBuffer              gVisibleInstances : register(u1);
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbGpuCull : register(b0)
+{
+    float4 gPlanes[6];             // world frustum planes (normals look inside)
+    matrix gHiZViewProj;           // viewProj of the frame the Hi-Z was built from
+    float3 gCameraPos;
+    uint   gNumInstances;
+    float4 gLodScreenSizesSq;      // squares of screen sizes where LOD i+1 starts
+    float  gProjScaleYSq;
+    uint   gHiZNumLevels;          // 0: occlusion test is disabled
+    uint2  gDepthSize;             // size of the depth buffer the Hi-Z was built from
+};
+
+
+//
+// HELPERS
+//
+bool IsInFrustum(const float3 center, const float radius)
+{
+    [unroll]
+    for (int i = 0; i < 6; ++i)
+    {
+        if (dot(gPlanes[i].xyz, center) + gPlanes[i].w < -radius)
+            return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool IsVisibleHiZ(const float3 center, const float radius)
+{
+    // project corners of the box into NDC by the viewProj of the pyramid
+    float3 ndcMin = float3( 1e30f,  1e30f,  1e30f);
+    float3 ndcMax = float3(-1e30f, -1e30f, -1e30f);
+
+    [unroll]
+    for (int i = 0; i < 8; ++i)
+    {
+        const float3 corner = center + radius * float3(
+            (i & 1) ? 1.0f : -1.0f,
+            (i & 2) ? 1.0f : -1.0f,
+            (i & 4) ? 1.0f : -1.0f);
+
+        const float4 clip = mul(float4(corner, 1.0f), gHiZViewProj);
+
+        // the box crosses the near plane: we can't say anything
+        if (clip.w <= 1e-4f)
+            return true;
+
+        const float3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc);
+        ndcMax = max(ndcMax, ndc);
+    }
+
+    // the box is outside of the old view (the camera has moved since then)
+    if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f)
+        return true;
+
+    // NDC => pixels of the depth buffer (y goes down)
+    const float2 size = (float2)gDepthSize;
+    const int2   last = (int2)gDepthSize - 1;
+
+    const int2 p0 = clamp((int2)(float2(ndcMin.x * 0.5f + 0.5f, 0.5f - ndcMax.y * 0.5f) * size), 0, last);
+    const int2 p1 = clamp((int2)(float2(ndcMax.x * 0.5f + 0.5f, 0.5f - ndcMin.y * 0.5f) * size), 0, last);
+
+    // pixels => texels of the level 0 (half of the depth buffer resolution)
+    int2 t0 = p0 >> 1;
+    int2 t1 = p1 >> 1;
+    uint level = 0;
+
+    // go up until the rect covers at most 2x2 texels
+    while (any((t1 - t0) > 1) && (level + 1 < gHiZNumLevels))
+    {
+        t0 >>= 1;
+        t1 >>= 1;
+        ++level;
+    }
+
+    // the rect is too big even for the smallest level
+    if (any((t1 - t0) > 1))
+        return true;
+
+    const float d0 = gHiZ.Load(int3(t0.x, t0.y, level));
+    const float d1 = gHiZ.Load(int3(t1.x, t0.y, level));
+    const float d2 = gHiZ.Load(int3(t0.x, t1.y, level));
+    const float d3 = gHiZ.Load(int3(t1.x, t1.y, level));
+
+    // the nearest point of the box is behind the farthest occluder depth of the rect
+    return ndcMin.z <= max(max(d0, d1), max(d2, d3));
+}
+
+///////////////////////////////////////////////////////////
+
+uint SelectLod(const float3 center, const float radius, const uint numLods)
+{
+    // the same as on CPU (see CGraphics::ComputeLodsOfVisibleEntts):
+    // compare squares of the projected diameter and screen sizes
+
+    const float3 toCenter   = center - gCameraPos;
+    const float  distSq     = dot(toCenter, toCenter);
+    const float  diameterSq = 4.0f * radius * radius * gProjScaleYSq;
+    const float  sizesSq[3] = { gLodScreenSizesSq.x, gLodScreenSizesSq.y, gLodScreenSizesSq.z };
+
+    uint lod = 0;
+
+    while ((lod + 1 < numLods) && (lod < 3) && (diameterSq < sizesSq[lod] * distSq))
+        ++lod;
+
+    return lod;
+}
+
+
+///////////////////////////////////////////////////////////
+
+void AppendRecord(const uint drawIdx, const uint srcAddr)
+{
+    const uint argsAddr = drawIdx * ARGS_STRIDE;
+
+    // take a slot in the range of the draw
+    uint slot = 0;
+    gArgs.InterlockedAdd(argsAddr + 4, 1, slot);
+
+    const uint rangeStart = gArgs.Load(argsAddr + 16);
+    const uint dstAddr    = (rangeStart + slot) * INSTANCE_SIZE;
+
+    [unroll]
+    for (uint offset = 0; offset < INSTANCE_SIZE; offset += 16)
+        gVisibleInstances.Store4(dstAddr + offset, gInstances.Load4(srcAddr + offset));
+}
+
+///////////////////////////////////////////////////////////
+
+void CullClusters(const InstanceBounds bounds, const uint srcAddr)
+{
+    // clusters are in model space so they are transformed by the record's
+    // world 3x4 (the first in the record, is stored by columns of the world
+    // matrix); normal cones are transformed by its 3x3 (scale is uniform)
+
+    const float4 c0 = asfloat(gInstances.Load4(srcAddr + 0));
+    const float4 c1 = asfloat(gInstances.Load4(srcAddr + 16));
+    const float4 c2 = asfloat(gInstances.Load4(srcAddr + 32));
+
+    const float scale = sqrt(max(dot(c0.xyz, c0.xyz), max(dot(c1.xyz, c1.xyz), dot(c2.xyz, c2.xyz))));
+
+    for (uint i = 0; i < bounds.numClusters; ++i)
+    {
+        const Cluster cluster = gClusters[bounds.clusterStart + i];
+        const float4  centerL = float4(cluster.center, 1.0f);
+        const float3  center  = float3(dot(c0, centerL), dot(c1, centerL), dot(c2, centerL));
+        const float   radius  = cluster.radius * scale;
+
+        if (!IsInFrustum(center, radius))
+            continue;
+
+        // all the triangles of the cluster are backfacing
+        if (cluster.coneCutoff < 1.0f)
+        {
+            const float3 axisL    = cluster.coneAxis;
+            const float3 axis     = normalize(float3(dot(c0.xyz, axisL), dot(c1.xyz, axisL), dot(c2.xyz, axisL)));
+            const float3 toCenter = center - gCameraPos;
+
+            if (dot(toCenter, axis) >= cluster.coneCutoff * length(toCenter) + radius)
+                continue;
+        }
+
+        if ((gHiZNumLevels > 0) && !IsVisibleHiZ(center, radius))
+            continue;
+
+        AppendRecord(bounds.drawIdx + i, srcAddr);
+    }
+}
+
+
+// =================================================================================
+// Compute Shader
+// =================================================================================
+[numthreads(64, 1, 1)]
+void CS(uint3 dispatchId : SV_DispatchThreadID)
+{
+    const uint idx = dispatchId.x;
+
+    if (idx >= gNumInstances)
+        return;
+
+    const InstanceBounds bounds = gBounds[idx];
+
+    if (!IsInFrustum(bounds.center, bounds.radius))
+        return;
+
+    if ((gHiZNumLevels > 0) && !IsVisibleHiZ(bounds.center, bounds.radius))
+        return;
+
+    const uint lod     = SelectLod(bounds.center, bounds.radius, bounds.numLods);
+    const uint srcAddr = idx * INSTANCE_SIZE;
+
+    // LOD 0 of a big mesh is culled by parts
+    if ((lod == 0) && (bounds.numClusters > 0))
+    {
+        CullClusters(bounds, srcAddr);
+        return;
+    }
+
+    const uint numLod0Draws = max(bounds.numClusters, 1);
+    const uint drawIdx      = (lod == 0) ? bounds.drawIdx : bounds.drawIdx + numLod0Draws + lod - 1;
+
+    AppendRecord(drawIdx, srcAddr);
+}
@@ -0,0 +1,66 @@
+// *********************************************************************************
+// Filename:    GrassCommon.hlsli
+// Description: common types and constants of the scattered grass
+//              (is included by the grass shaders; see Render::GrassScatter)
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// TYPEDEFS
+//
+struct GrassInstance
+{
+    // the same size as GrassScatter::INSTANCE_SIZE (32 bytes)
+    float3 posW;                   // the root of the clump
+    float  height;
+    uint   color;                  // packed RGBA8: the tint by the terrain (is lit by the lightmap)
+    float  yaw;                    // rotation of the clump around Y (in radians)
+    float  lean;                   // bend of blades [0,1]
+    float  phase;                  // of the wind sway
+};
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbGrass : register(b7)
+{
+    matrix gViewProj;
+    float4 gPlanes[6];             // world frustum planes (normals look inside)
+    float3 gCameraPosW;
+    float  gTime;
+    float2 gOrigin;                // position of the height map's (0,0) in world
+    float  gHeightScale;           // a sample of the height map [0,1] => height in world
+    float  gTexelSize;             // 1 / size of the height map
+    float  gCellSize;
+    uint   gCellsPerSide;
+    float  gMaxDistance;
+    float  gFadeStart;
+    float  gMinSlopeCos;
+    float  gBladeHeight;
+    float  gBladeWidth;
+    float  gWindStrength;
+    float3 gFogColor;
+    float  gFogStart;
+    float  gFogRange;              // 0: no fog
+    uint   gHasTextureMap;
+    uint   gHasLightmap;
+    uint   gPadding;
+};
+
+
+//
+// HELPERS
+//
+uint PackColor(const float3 c)
+{
+    const uint3 b = (uint3)(saturate(c) * 255.0f + 0.5f);
+    return b.x | (b.y << 8) | (b.z << 16) | (255u << 24);
+}
+
+float3 UnpackColor(const uint c)
+{
+    return float3(c & 0xFF, (c >> 8) & 0xFF, (c >> 16) & 0xFF) / 255.0f;
+}
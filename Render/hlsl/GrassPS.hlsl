@@ -0,0 +1,34 @@
+// *********************************************************************************
+// Filename:    GrassPS.hlsl
+// Description: a pixel shader of the scattered grass: the color of a clump (its
+//              tint by the terrain and the lightmap) with the same fog as of the
+//              rest of the scene
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "GrassCommon.hlsli"
+
+
+struct PS_IN
+{
+    float4 posH  : SV_POSITION;
+    float3 posW  : POSITION;
+    float3 color : COLOR;
+};
+
+
+//
+// PIXEL SHADER
+//
+float4 PS(PS_IN pin) : SV_Target
+{
+    float3 color = pin.color;
+
+    if (gFogRange > 0.0f)
+    {
+        const float fogLerp = saturate((distance(pin.posW, gCameraPosW) - gFogStart) / gFogRange);
+        color = lerp(color, gFogColor, fogLerp);
+    }
+
+    return float4(color, 1.0f);
+}
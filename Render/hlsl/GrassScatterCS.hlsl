@@ -0,0 +1,159 @@
+// *********************************************************************************
+// Filename:    GrassScatterCS.hlsl
+// Description: a compute shader which scatters clumps of grass over terrain
+//              patches: each thread is a cell of a patch (a group layer per
+//              patch); a clump is placed at a jittered point of the cell with
+//              the probability of the density (by the terrain texture map, the
+//              slope and the distance), is culled by the frustum and is appended
+//              into the instances buffer; the instance count is incremented
+//              right in the DrawInstancedIndirect args buffer
+//
+//              NOTE: random numbers are hashed by the cell in the height map
+//                    space so clumps are the same each frame (no flickering)
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "GrassCommon.hlsli"
+
+
+//
+// TYPEDEFS
+//
+struct Patch
+{
+    float2 start;                  // the min corner of the patch in the height map space
+    float2 padding;
+};
+
+
+//
+// GLOBALS
+//
+static const uint  GROUP_SIZE     = 8;
+static const uint  ARGS_COUNT     = 4;       // byte offset of the instance count in the args
+static const float PI2            = 6.28318530f;
+
+StructuredBuffer<Patch>            gPatches    : register(t0);
+Texture2D                          gHeightMap  : register(t1);
+Texture2D                          gTextureMap : register(t2);
+Texture2D                          gLightmap   : register(t3);
+SamplerState                       gSampler    : register(s0);
+
+RWByteAddressBuffer                gArgs       : register(u0);
+RWStructuredBuffer<GrassInstance>  gInstances  : register(u1);
+
+
+//
+// HELPERS
+//
+uint WangHash(uint seed)
+{
+    seed = (seed ^ 61) ^ (seed >> 16);
+    seed *= 9;
+    seed = seed ^ (seed >> 4);
+    seed *= 0x27d4eb2d;
+    seed = seed ^ (seed >> 15);
+    return seed;
+}
+
+// return a random number in range [0, 1) and update the seed
+float Random(inout uint seed)
+{
+    seed = WangHash(seed);
+    return float(seed & 0x00FFFFFF) / 16777216.0f;
+}
+
+float SampleHeight(const float2 posXZ)
+{
+    // texel (x,z) of the height map is the height at point (x,z) of the map
+    const float2 uv = (posXZ + 0.5f) * gTexelSize;
+    return gHeightMap.SampleLevel(gSampler, uv, 0).r * gHeightScale;
+}
+
+bool IsInFrustum(const float3 center, const float radius)
+{
+    [unroll]
+    for (int i = 0; i < 6; ++i)
+    {
+        if (dot(gPlanes[i].xyz, center) + gPlanes[i].w < -radius)
+            return false;
+    }
+
+    return true;
+}
+
+
+//
+// COMPUTE SHADER
+//
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void CS(uint3 dtid : SV_DispatchThreadID)
+{
+    const Patch  patch = gPatches[dtid.z];
+    const uint2  cell  = dtid.xy;
+
+    // the same cell always gets the same random numbers
+    const int2 globalCell = (int2)floor(patch.start / gCellSize + 0.5f) + (int2)cell;
+    uint       seed       = WangHash(asuint(globalCell.x) * 73856093u ^ asuint(globalCell.y) * 19349663u);
+
+    const float2 posXZ = patch.start + ((float2)cell + float2(Random(seed), Random(seed))) * gCellSize;
+    const float3 posW  = float3(posXZ.x + gOrigin.x, SampleHeight(posXZ), posXZ.y + gOrigin.y);
+
+    // the density goes down to zero at the max distance
+    const float dist    = distance(posW, gCameraPosW);
+    float       density = saturate((gMaxDistance - dist) / max(gMaxDistance - gFadeStart, 0.001f));
+
+    // no grass on steep slopes (the normal by central differences of heights)
+    const float hL = SampleHeight(posXZ - float2(1, 0));
+    const float hR = SampleHeight(posXZ + float2(1, 0));
+    const float hD = SampleHeight(posXZ - float2(0, 1));
+    const float hU = SampleHeight(posXZ + float2(0, 1));
+    const float3 normal = normalize(float3(hL - hR, 2.0f, hD - hU));
+
+    density *= saturate((normal.y - gMinSlopeCos) / max(1.0f - gMinSlopeCos, 0.001f) * 4.0f);
+
+    // grass grows where the texture map is green (the color of a clump is the same as of the ground)
+    const float2 uv    = posXZ * gTexelSize;
+    float3       color = float3(0.35f, 0.55f, 0.2f);
+
+    if (gHasTextureMap)
+    {
+        color    = gTextureMap.SampleLevel(gSampler, uv, 0).rgb;
+        density *= saturate((color.g - max(color.r, color.b)) * 8.0f);
+    }
+
+    if (Random(seed) >= density)
+        return;
+
+    const float height = gBladeHeight * lerp(0.6f, 1.2f, Random(seed));
+
+    if (!IsInFrustum(posW + float3(0, 0.5f * height, 0), height))
+        return;
+
+    if (gHasLightmap)
+        color *= gLightmap.SampleLevel(gSampler, uv, 0).r;
+
+    // a slot in the instances buffer; clumps over the capacity are just skipped
+    // (the count is returned back so it never exceeds the capacity)
+    uint numInstances, stride;
+    gInstances.GetDimensions(numInstances, stride);
+
+    uint slot;
+    gArgs.InterlockedAdd(ARGS_COUNT, 1, slot);
+
+    if (slot >= numInstances)
+    {
+        gArgs.InterlockedAdd(ARGS_COUNT, 0xFFFFFFFF);
+        return;
+    }
+
+    GrassInstance inst;
+    inst.posW   = posW;
+    inst.height = height;
+    inst.color  = PackColor(color);
+    inst.yaw    = PI2 * Random(seed);
+    inst.lean   = Random(seed);
+    inst.phase  = PI2 * Random(seed);
+
+    gInstances[slot] = inst;
+}
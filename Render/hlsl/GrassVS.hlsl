@@ -0,0 +1,73 @@
+// *********************************************************************************
+// Filename:    GrassVS.hlsl
+// Description: a vertex shader which expands clumps of the scattered grass:
+//              a clump is 3 blades around its root and each blade is a tapered
+//              quad with a tip (3 triangles); the vertex is chosen by SV_VertexID
+//              and the clump by SV_InstanceID (there is no vertex buffer);
+//              blades are bent by their lean and are swayed by the wind
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "GrassCommon.hlsli"
+
+
+//
+// GLOBALS
+//
+static const uint VERTS_PER_BLADE = 9;
+
+// (side [-1,1], height [0,1]) of blade vertices: a quad of 2 triangles + the tip
+static const float2 gBladeVerts[VERTS_PER_BLADE] =
+{
+    float2(-1, 0.0f), float2(-1, 0.5f), float2( 1, 0.0f),
+    float2( 1, 0.0f), float2(-1, 0.5f), float2( 1, 0.5f),
+    float2(-1, 0.5f), float2( 0, 1.0f), float2( 1, 0.5f),
+};
+
+StructuredBuffer<GrassInstance> gInstances : register(t15);
+
+struct VS_OUT
+{
+    float4 posH  : SV_POSITION;
+    float3 posW  : POSITION;
+    float3 color : COLOR;
+};
+
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(uint vertexID : SV_VertexID, uint instanceID : SV_InstanceID)
+{
+    const GrassInstance inst  = gInstances[instanceID];
+    const uint          blade = vertexID / VERTS_PER_BLADE;
+    const float2        vert  = gBladeVerts[vertexID % VERTS_PER_BLADE];
+
+    // blades are turned by 120 degrees around the root
+    float sinA, cosA;
+    sincos(inst.yaw + 2.0943951f * blade, sinA, cosA);
+
+    const float3 side  = float3(cosA, 0, sinA);
+    const float3 front = float3(-sinA, 0, cosA);
+
+    // a blade gets thinner to the tip and is bent forward (more to the tip)
+    const float t      = vert.y;
+    const float height = inst.height * (1.0f - 0.15f * blade);
+    const float bend   = t * t;
+
+    // the wind sways the tips by a wave over the world
+    const float  wave = sin(gTime * 2.0f + inst.phase + dot(inst.posW.xz, float2(0.3f, 0.2f)));
+    const float3 wind = float3(0.8f, 0, 0.6f) * (gWindStrength * wave * bend);
+
+    float3 posW = inst.posW;
+    posW += side  * (vert.x * gBladeWidth * (1.0f - 0.7f * t));
+    posW += front * (inst.lean * 0.4f * height * bend);
+    posW += float3(0, height * t, 0) + wind * height;
+
+    VS_OUT vout;
+    vout.posH  = mul(float4(posW, 1.0f), gViewProj);
+    vout.posW  = posW;
+    vout.color = UnpackColor(inst.color) * lerp(0.45f, 1.15f, t);    // darker at the root
+
+    return vout;
+}
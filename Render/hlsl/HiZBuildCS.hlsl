@@ -0,0 +1,74 @@
+// *********************************************************************************
+// Filename:    HiZBuildCS.hlsl
+// Description: a compute shader to build a single level of the Hi-Z buffer
+//              (hierarchical depth): each texel of the destination level
+//              keeps the max (the farthest) depth of 2x2 texels of the source
+//              level (which is either the depth buffer or the prev Hi-Z level);
+//
+//              NOTE: dstSize == ceil(srcSize / 2) so for odd sizes the last
+//                    texel of dst covers the last texel of src (we clamp coords)
+//              NOTE: if the depth buffer is multisampled it is bound to t1 and
+//                    we take the max over all its samples
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// GLOBALS
+//
+Texture2D<float>   srcDepth   : register(t0);
+Texture2DMS<float> srcDepthMS : register(t1);
+RWTexture2D<float> dstDepth   : register(u0);
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbHiZ : register(b0)
+{
+    uint2 srcSize;
+    uint2 dstSize;
+    uint  numSamples;              // > 1 only if we read the multisampled depth
+    uint3 padding;
+};
+
+
+//
+// HELPERS
+//
+float LoadDepth(uint2 coord)
+{
+    if (numSamples <= 1)
+        return srcDepth[coord];
+
+    float depth = 0.0f;
+
+    for (uint i = 0; i < numSamples; ++i)
+        depth = max(depth, srcDepthMS.Load(coord, i));
+
+    return depth;
+}
+
+
+// =================================================================================
+// Compute Shader
+// =================================================================================
+[numthreads(8, 8, 1)]
+void CS(uint3 dispatchId : SV_DispatchThreadID)
+{
+    const uint2 dst = dispatchId.xy;
+
+    if (any(dst >= dstSize))
+        return;
+
+    const uint2 src  = dst * 2;
+    const uint2 last = srcSize - 1;
+
+    const float d0 = LoadDepth(min(src,               last));
+    const float d1 = LoadDepth(min(src + uint2(1, 0), last));
+    const float d2 = LoadDepth(min(src + uint2(0, 1), last));
+    const float d3 = LoadDepth(min(src + uint2(1, 1), last));
+
+    dstDepth[dst] = max(max(d0, d1), max(d2, d3));
+}
@@ -0,0 +1,125 @@
+// *********************************************************************************
+// Filename:    ImpostorGS.hlsl
+// Description: a geometry shader to expand an impostor point into a y-axis
+//              aligned quad that faces the camera; the view direction in the
+//              model space selects the two nearest views of the atlas (views go
+//              around the Y axis starting from the model's +Z axis) and the
+//              blend weight between them
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+// ==========================
+// CONSTANT BUFFERS
+// ==========================
+cbuffer cbPerFrame : register(b0)
+{
+	matrix gViewProj;
+	float3 gEyePosW;                // eye position in world space
+};
+
+cbuffer cbImpostorAtlas : register(b1)
+{
+	float  gNumViews;
+	float  gNumCols;
+	float  gNumRows;
+	float  gPadding;
+};
+
+
+// ==========================
+// TYPEDEFS
+// ==========================
+struct GS_IN
+{
+	float3 centerW   : POSITION;
+	float2 sizeW     : SIZE;
+	float2 forwardXZ : FORWARD;
+};
+
+struct GS_OUT
+{
+	float4 posH      : SV_POSITION;
+	float3 posW      : POSITION;
+	float4 tex       : TEXCOORD0;      // xy: uv in the first view; zw: in the second one
+	float  blend     : TEXCOORD1;      // weight of the second view
+};
+
+
+// ==========================
+// HELPERS
+// ==========================
+float2 GetCellOrigin(float view)
+{
+	// the top left corner of the view's cell in the atlas (in uv)
+	float row = floor(view / gNumCols);
+	float col = view - row * gNumCols;
+
+	return float2(col / gNumCols, row / gNumRows);
+}
+
+
+// ==========================
+// GEOMETRY SHADER
+// ==========================
+[maxvertexcount(4)]
+void GS(point GS_IN gin[1], inout TriangleStream<GS_OUT> triStream)
+{
+	const float PI = 3.14159265f;
+
+	float2 texC[4] =
+	{
+		float2(0.0f, 1.0f),
+		float2(0.0f, 0.0f),
+		float2(1.0f, 1.0f),
+		float2(1.0f, 0.0f)
+	};
+
+	// y-axis aligned billboard which faces the eye
+	float3 up   = float3(0.0f, 1.0f, 0.0f);
+	float3 look = gEyePosW - gin[0].centerW;
+
+	look.y = 0.0f;
+	look   = normalize(look);
+
+	float3 right = cross(up, look);
+
+	// direction to the eye in the model space (around the Y axis)
+	float2 fwd   = gin[0].forwardXZ;
+	float  x     = dot(look.xz, float2(fwd.y, -fwd.x));
+	float  z     = dot(look.xz, fwd);
+	float  angle = atan2(x, z);                                 // [-PI, PI]
+
+	// select the two nearest views and the blend weight between them
+	float f     = frac(angle / (2.0f * PI) + 1.0f) * gNumViews;
+	float view0 = floor(f);
+	float view1 = fmod(view0 + 1.0f, gNumViews);
+	float blend = f - view0;
+
+	float2 cellSize = float2(1.0f / gNumCols, 1.0f / gNumRows);
+	float2 origin0  = GetCellOrigin(view0);
+	float2 origin1  = GetCellOrigin(view1);
+
+	// compute triangle strip vertices (quad) in world space
+	float halfWidth  = 0.5f * gin[0].sizeW.x;
+	float halfHeight = 0.5f * gin[0].sizeW.y;
+
+	float4 v[4];
+	v[0] = float4(gin[0].centerW + halfWidth * right - halfHeight * up, 1.0f);
+	v[1] = float4(gin[0].centerW + halfWidth * right + halfHeight * up, 1.0f);
+	v[2] = float4(gin[0].centerW - halfWidth * right - halfHeight * up, 1.0f);
+	v[3] = float4(gin[0].centerW - halfWidth * right + halfHeight * up, 1.0f);
+
+	GS_OUT gout;
+	[unroll]
+	for (int i = 0; i < 4; ++i)
+	{
+		gout.posH   = mul(v[i], gViewProj);
+		gout.posW   = v[i].xyz;
+		gout.tex.xy = origin0 + texC[i] * cellSize;
+		gout.tex.zw = origin1 + texC[i] * cellSize;
+		gout.blend  = blend;
+		triStream.Append(gout);
+	}
+}
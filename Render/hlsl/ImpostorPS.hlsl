@@ -0,0 +1,75 @@
+// *********************************************************************************
+// Filename:    ImpostorPS.hlsl
+// Description: a pixel shader for impostors: blends two views of the atlas
+//              (the lighting is already baked into it) and applies the fog
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "LightHelper.hlsli"
+
+
+// ==========================
+// GLOBALS
+// ==========================
+Texture2D    gAtlas        : register(t0);
+SamplerState gSampleType   : register(s0);
+
+
+// ==========================
+// CONSTANT BUFFERS
+// ==========================
+cbuffer cbPerFrame        : register(b0)
+{
+	DirectionalLight  gDirLights[3];           // aren't used: the lighting is baked into the atlas
+	float3            gEyePosW;                // eye position in world space
+};
+
+cbuffer cbRarelyChanged   : register(b1)
+{
+	float3 gFogColor;            // what is the color of fog?
+	float  gFogStart;            // how far from camera the fog starts?
+	float  gFogRange;            // how far from camera the object is fully fogged?
+
+	int    gNumOfDirLights;      // current number of directional light sources
+
+	int    gFogEnabled;          // turn on/off the fog effect
+	int    gTurnOnFlashLight;    // turn on/off the flashlight
+	int    gAlphaClipping;       // turn on/off alpha clipping
+};
+
+
+// ==========================
+// TYPEDEFS
+// ==========================
+struct PS_IN
+{
+	float4 posH   : SV_POSITION;
+	float3 posW   : POSITION;
+	float4 tex    : TEXCOORD0;
+	float  blend  : TEXCOORD1;
+};
+
+
+// ==========================
+// PIXEL SHADER
+// ==========================
+float4 PS(PS_IN pin) : SV_TARGET
+{
+	float4 color0 = gAtlas.Sample(gSampleType, pin.tex.xy);
+	float4 color1 = gAtlas.Sample(gSampleType, pin.tex.zw);
+	float4 color  = lerp(color0, color1, pin.blend);
+
+	// the background of the atlas is transparent
+	clip(color.a - 0.5f);
+
+	if (gFogEnabled)
+	{
+		float distToEye = length(gEyePosW - pin.posW);
+		float fogLerp   = saturate((distToEye - gFogStart) / gFogRange);
+
+		color = lerp(color, float4(gFogColor, 1.0f), fogLerp);
+	}
+
+	color.a = 1.0f;
+	return color;
+}
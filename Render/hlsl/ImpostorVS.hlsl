@@ -0,0 +1,40 @@
+// *********************************************************************************
+// Filename:    ImpostorVS.hlsl
+// Description: a vertex shader for impostors: each vertex is a single impostor
+//              which is just passed over to the geometry shader
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// TYPEDEFS
+//
+struct VS_IN
+{
+	float3 centerW   : POSITION;       // center of the impostor quad in world space
+	float2 sizeW     : SIZE;           // width and height of the quad
+	float2 forwardXZ : FORWARD;        // xz of the model's +Z axis in world (normalized)
+};
+
+struct VS_OUT
+{
+	float3 centerW   : POSITION;
+	float2 sizeW     : SIZE;
+	float2 forwardXZ : FORWARD;
+};
+
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(VS_IN vin)
+{
+	VS_OUT vout;
+
+	vout.centerW   = vin.centerW;
+	vout.sizeW     = vin.sizeW;
+	vout.forwardXZ = vin.forwardXZ;
+
+	return vout;
+}
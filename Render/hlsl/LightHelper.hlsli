@@ -290,8 +290,11 @@ void ComputeSpotLight(
 //---------------------------------------------------------------------------------------
 float3 NormalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, float3 tangentW)
 {
-    // Uncompress each component from [0,1] to [-1,1].
-    float3 normalT = 2.0f * normalMapSample - 1.0f;
+    // Uncompress each component from [0,1] to [-1,1];
+    // Z is restored from XY so two channel (BC5) normal maps are handled as well
+    float3 normalT;
+    normalT.xy = 2.0f * normalMapSample.xy - 1.0f;
+    normalT.z  = sqrt(saturate(1.0f - dot(normalT.xy, normalT.xy)));
 
     // Build orthonormal basis.
     float3 N = unitNormalW;
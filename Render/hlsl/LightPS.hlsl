@@ -1,11 +1,15 @@
 #include "LightHelper.hlsli"
+#include "SkyFog.hlsli"
 
 
 //
 // GLOBALS
 //
-TextureCube  gCubeMap       : register(t0);
 Texture2D    gTextures[22] : register(t1);
+
+// packed diffuse/normal maps of materials (are sampled by layers from the VS)
+Texture2DArray gDiffuseMaps : register(t28);
+Texture2DArray gNormalMaps  : register(t29);
 SamplerState gSampleType   : register(s0);
 
 
@@ -14,13 +18,23 @@ SamplerState gSampleType   : register(s0);
 //
 cbuffer cbPerFrame    : register(b0)
 {
-    // light sources data
+    // light sources data (point/spot lights are in structured buffers)
     DirectionalLight  gDirLights[3];
-    PointLight        gPointLights[25];
-    SpotLight         gSpotLights[25];
     float3            gEyePosW;                // eye position in world space  
     int               gCurrNumPointLights;
     int               gCurrNumSpotLights;
+
+    // params of the light clusters grid
+    uint3             gClusterDims;
+    float2            gClusterScaleXY;         // pixel => cluster xy
+    float             gClusterSliceScale;      // view depth => cluster z
+    float             gClusterSliceBias;
+
+    // the volume of baked static lights (see StaticLights.hlsli)
+    float3            gStaticLightsMin;
+    int               gHasStaticLights;
+    float3            gStaticLightsInvSize;
+    float             gStaticLightsNormalBias;
 };
 
 cbuffer cbRareChanged : register(b1)
@@ -39,6 +53,31 @@ cbuffer cbRareChanged : register(b1)
     int   gAlphaClipping;       // turn on/off alpha clipping
 }
 
+#include "ClusteredLights.hlsli"
+#include "ShadowMaps.hlsli"
+#include "StaticLights.hlsli"
+
+//
+// PERMUTATIONS
+//
+// defines are set per variant by PixelShaderPermutations (see LightShader);
+// when a define isn't set (the default .cso) the runtime flag is used instead
+#ifdef FOG
+    #define IS_FOG_ENABLED FOG
+#else
+    #define IS_FOG_ENABLED gFogEnabled
+#endif
+
+#ifdef ALPHA_CLIP
+    #define IS_ALPHA_CLIPPING ALPHA_CLIP
+#else
+    #define IS_ALPHA_CLIPPING gAlphaClipping
+#endif
+
+#ifndef NORMAL_MAP
+    #define NORMAL_MAP 1
+#endif
+
 //
 // TYPEDEFS
 //
@@ -50,6 +89,7 @@ struct PS_IN
     float3   normalW            : NORMAL;       // normal in world
     float3   tangentW           : TANGENT;      // tangent in world
     float2   tex                : TEXCOORD;
+    nointerpolation int2 texLayers : TEX_LAYERS;   // x: diffuse, y: normal (-1: not packed)
     uint     instanceID         : SV_InstanceID;
 };
 
@@ -76,34 +116,44 @@ float4 PS(PS_IN pin) : SV_Target
 
     // ------------------------------------------
 
-    // HACK to get proper sky pixel
-    float3 vec = -toEyeW;
-    vec.y -= 990;
-
-    float4 skyTexColor = gCubeMap.Sample(gSampleType, vec);
-
     // return blended fixed fog color with the sky color at this pixel
     // if the pixel is fully fogged
-    if (gFogEnabled && distToEye > (gFogStart + gFogRange))
+    if (IS_FOG_ENABLED && distToEye > (gFogStart + gFogRange))
     {
-        return skyTexColor * float4(gFixedFogColor, 1.0f);
+        return float4(GetSkyFogColor(gSampleType, -toEyeW) * gFixedFogColor, 1.0f);
     }
 
-    float4 textureColor = gTextures[1].Sample(gSampleType, pin.tex);
+    // (layers are the same for the whole primitive so the branch is coherent)
+    float4 textureColor;
+
+    if (pin.texLayers.x >= 0)
+        textureColor = gDiffuseMaps.Sample(gSampleType, float3(pin.tex, pin.texLayers.x));
+    else
+        textureColor = gTextures[1].Sample(gSampleType, pin.tex);
 
     // execute alpha clipping
-    if (gAlphaClipping)
+    if (IS_ALPHA_CLIPPING)
         clip(textureColor.a - 0.1f);
 
     // --------------------  NORMAL MAP   --------------------
 
-    float3 normalMap = gTextures[6].Sample(gSampleType, pin.tex).rgb;
-
     // normalize the normal vector after interpolation
     float3 normalW = normalize(pin.normalW);
 
+#if NORMAL_MAP
+    float3 normalMap;
+
+    if (pin.texLayers.y >= 0)
+        normalMap = gNormalMaps.Sample(gSampleType, float3(pin.tex, pin.texLayers.y)).rgb;
+    else
+        normalMap = gTextures[6].Sample(gSampleType, pin.tex).rgb;
+
     // compute the bumped normal in the world space
     float3 bumpedNormalW = NormalSampleToWorldSpace(normalMap, normalW, pin.tangentW);
+#else
+    // the material has no normal map so don't sample it at all
+    float3 bumpedNormalW = normalW;
+#endif
 
   
     // --------------------  LIGHT   --------------------
@@ -117,7 +167,17 @@ float4 PS(PS_IN pin) : SV_Target
     float4 A, D, S;
     
     // sum the light contribution from each directional light source
+#if !defined(NUM_DIR_LIGHTS) || (NUM_DIR_LIGHTS > 0)
+
+    // only the sun (the first directional light) casts shadows
+    const float shadow = ComputeShadowFactor(pin.posW, pin.posH.w);
+
+#if defined(NUM_DIR_LIGHTS)
+    [unroll]
+    for (int i = 0; i < NUM_DIR_LIGHTS; ++i)
+#else
     for (int i = 0; i < gNumOfDirLights; ++i)
+#endif
     {
         ComputeDirectionalLight(
             (Material)pin.material,
@@ -127,18 +187,34 @@ float4 PS(PS_IN pin) : SV_Target
             0.0f,             // specular map value
             A, D, S);
 
+        const float lit = (i == 0) ? shadow : 1.0f;
+
         ambient += A;
-        diffuse += D;
-        spec += S;
+        diffuse += D * lit;
+        spec += S * lit;
     }
+#endif
     
+    // get lights which reach the cluster of this pixel
+    // (there are no clusters for passes without point/spot lights, e.g. the planar reflection)
+    ClusterLights cl = (ClusterLights)0;
+
+    if (gCurrNumPointLights + gCurrNumSpotLights > 0)
+    {
+        cl = GetClusterLights(
+            pin.posH,
+            gClusterDims,
+            gClusterScaleXY,
+            gClusterSliceScale,
+            gClusterSliceBias);
+    }
     
-    // sum the light contribution from each point light source
-    for (i = 0; i < gCurrNumPointLights; ++i)
+    // sum the light contribution from each point light source of the cluster
+    for (uint p = 0; p < cl.numPoint; ++p)
     {
         ComputePointLight(
             (Material)pin.material,
-            gPointLights[i],
+            gPointLights[gLightIdxs[cl.offset + p]],
             pin.posW,
             bumpedNormalW,
             toEyeW,
@@ -169,12 +245,12 @@ float4 PS(PS_IN pin) : SV_Target
     }
 
     
-    // sum the light contribution from each spot light source
-    for (i = 1; i < gCurrNumSpotLights; ++i)
+    // sum the light contribution from each spot light source of the cluster
+    for (uint s = 0; s < cl.numSpot; ++s)
     {
         ComputeSpotLight(
             (Material)pin.material, 
-            gSpotLights[i],
+            gSpotLights[gLightIdxs[cl.offset + cl.numPoint + s]],
             pin.posW,
             bumpedNormalW, //bumpedNormalW, // pin.normalW,
             toEyeW,
@@ -185,6 +261,15 @@ float4 PS(PS_IN pin) : SV_Target
         diffuse += D;
         spec += S;
     }
+
+    // static lights are baked (only their diffuse and ambient)
+    if (gHasStaticLights)
+    {
+        ComputeStaticLights(gSampleType, (Material)pin.material, pin.posW, bumpedNormalW, A, D);
+
+        ambient += A;
+        diffuse += D;
+    }
     
     
     // modulate with late add
@@ -196,16 +281,12 @@ float4 PS(PS_IN pin) : SV_Target
 
     // ---------------------  FOG  ----------------------
 
-    if (gFogEnabled)
+    if (IS_FOG_ENABLED)
     {
         float fogLerp = saturate((distToEye - gFogStart) / gFogRange);
 
-        // TEMP: hacky fix for the vector to sample the proper pixel of sky
-        float3 vec = -toEyeW;
-        vec.y -= 850;
-
-        // blend sky pixel color with fixed fog color
-        float4 fogColor = gCubeMap.Sample(gSampleType, vec) * float4(gFixedFogColor, 1.0f);
+        // blend sky pixel color (by the LUT) with fixed fog color
+        float4 fogColor = float4(GetSkyFogColor(gSampleType, -toEyeW) * gFixedFogColor, 1.0f);
 
         // blend the fog color and the lit color
         litColor = lerp(litColor, fogColor, fogLerp);
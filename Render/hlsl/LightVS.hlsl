@@ -1,3 +1,6 @@
+#include "LightHelper.hlsli"
+#include "TexTransformHelper.hlsli"
+#include "PackedVertex.hlsli"
 
 //
 // CONSTANT BUFFERS
@@ -5,36 +8,44 @@
 cbuffer cbVSPerFrame : register(b0)
 {
     matrix gViewProj;
+    float  gGameTime;
 };
 
+// table of all the materials (is re-uploaded only when materials are changed)
+StructuredBuffer<Material> gMaterials : register(t0);
+
+// layers of the materials diffuse/normal maps in the packed texture arrays (-1: not packed)
+StructuredBuffer<int2>     gMaterialTexLayers : register(t1);
+
 //
 // TYPEDEFS
 //
 struct VS_IN
 {
     // data per instance
-    row_major matrix   world             : WORLD;
-    row_major matrix   worldInvTranspose : WORLD_INV_TRANSPOSE;
-    row_major matrix   texTransform      : TEX_TRANSFORM;
-    row_major float4x4 material          : MATERIAL;
+    row_major float3x4 world             : WORLD;
+    row_major float2x4 texTransform      : TEX_TRANSFORM;
+    uint               materialIdx       : MATERIAL_IDX;
     uint               instanceID        : SV_InstanceID;
 
     // data per vertex
     float3   posL       : POSITION;     // vertex position in local space
     float2   tex        : TEXCOORD;
-    float3   normalL    : NORMAL;       // vertex normal in local space
-    float3   tangentL   : TANGENT;      // tangent in local space
+    float3   normalL    : NORMAL;       // vertex normal in local space (packed)
+    float3   tangentL   : TANGENT;      // tangent in local space (packed)
 };
 
 struct VS_OUT
 {
     float4x4 material   : MATERIAL;
-    float4   posH       : SV_POSITION;  // homogeneous position
+    precise float4 posH : SV_POSITION;  // homogeneous position (is invariant with the depth pre-pass)
     float3   posW       : POSITION;     // position in world
     float3   normalW    : NORMAL;       // normal in world
     float3   tangentW   : TANGENT;      // tangent in world
     float2   tex        : TEXCOORD;
+    nointerpolation int2 texLayers : TEX_LAYERS;
     uint     instanceID : SV_InstanceID;
+    nointerpolation uint materialIdx : MATERIAL_IDX;   // for the G-buffer (the light PS skips it)
 };
 
 //
@@ -44,24 +55,29 @@ VS_OUT VS(VS_IN vin)
 {
     VS_OUT vout;
 
-    vout.material = vin.material;
+    // fetch material of this instance from the table
+    const Material mat = gMaterials[vin.materialIdx];
+    vout.material = float4x4(mat.ambient, mat.diffuse, mat.specular, mat.reflect);
+    vout.texLayers = gMaterialTexLayers[vin.materialIdx];
 
     // transform pos from local to world space
-    vout.posW = mul(float4(vin.posL, 1.0f), vin.world).xyz;
+    vout.posW = mul(vin.world, float4(vin.posL, 1.0f));
 
     // transform to homogeneous clip space
     vout.posH = mul(float4(vout.posW, 1.0f), gViewProj);
 
     // interpolating normal can unnormalize it, so normalize it
-    vout.normalW = normalize(mul(vin.normalL, (float3x3)vin.worldInvTranspose));
+    // (the world's 3x3 is used instead of the inverse transpose: scale is uniform)
+    vout.normalW = normalize(mul((float3x3)vin.world, UnpackUnitVector(vin.normalL)));
 
     // calculate the tangent and normalize it
-    vout.tangentW = normalize(mul(vin.tangentL, (float3x3)vin.worldInvTranspose));
+    vout.tangentW = normalize(mul((float3x3)vin.world, UnpackUnitVector(vin.tangentL)));
 
     // output vertex texture attributes for interpolation across triangle
-    vout.tex = mul(float4(vin.tex, 0.0f, 1.0f), vin.texTransform).xy;
+    vout.tex = ComputeTexCoords(vin.tex, vin.texTransform, gGameTime);
 
-    vout.instanceID = vin.instanceID;
+    vout.instanceID  = vin.instanceID;
+    vout.materialIdx = vin.materialIdx;
 
     return vout;
 }
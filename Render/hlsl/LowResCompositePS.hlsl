@@ -0,0 +1,101 @@
+// *********************************************************************************
+// Filename:    LowResCompositePS.hlsl
+// Description: a pixel shader which composites the low resolution blended color
+//              over the scene color (by the fullscreen triangle of UpscaleVS.hlsl)
+//              with the depth aware upsampling:
+//
+//              - if view depths of the 4 nearest low resolution texels are close
+//                to the view depth of the pixel the color is filtered bilinearly;
+//              - otherwise the pixel is on an edge of geometry and it takes the
+//                texel with the nearest view depth (so it doesn't get the color
+//                of the blended content which is behind or in front of it)
+//
+//              NOTE: the color is premultiplied by alpha which is the coverage
+//              NOTE: slots must be the same as in the Render::LowResBlending
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// GLOBALS
+//
+Texture2D<float>  gSceneDepth  : register(t1);
+Texture2D<float4> gLowColor    : register(t2);
+Texture2D<float>  gLowDepth    : register(t3);
+
+cbuffer cbLowResBlend : register(b12)
+{
+    uint  gFactor;              // full resolution pixels per low resolution one
+    uint  gPadding0;
+    uint2 gFullMax;             // the last pixel of the rendered part of the scene depth
+    uint2 gLowMax;              // the last pixel of the rendered part of low resolution targets
+    float gProjA;               // view depth == gProjB / (depth - gProjA)
+    float gProjB;
+    float gDepthThreshold;      // relative difference of view depths which is an edge
+    float3 gPadding1;
+};
+
+
+//
+// TYPEDEFS
+//
+struct PS_IN
+{
+    float4 posH : SV_POSITION;
+    float2 tex  : TEXCOORD;
+};
+
+///////////////////////////////////////////////////////////
+
+float LinearDepth(const float depth)
+{
+    return gProjB / (depth - gProjA);
+}
+
+
+//
+// PIXEL SHADER
+//
+float4 PS(PS_IN pin) : SV_Target
+{
+    const float sceneV = LinearDepth(gSceneDepth.Load(int3(pin.posH.xy, 0)));
+
+    // the bilinear footprint in the low resolution (by centers of texels)
+    const float2 lowPos = pin.posH.xy / gFactor - 0.5f;
+    const int2   base   = (int2)floor(lowPos);
+    const float2 frac   = lowPos - (float2)base;
+
+    const float weights[4] =
+    {
+        (1.0f - frac.x) * (1.0f - frac.y),
+        frac.x          * (1.0f - frac.y),
+        (1.0f - frac.x) * frac.y,
+        frac.x          * frac.y,
+    };
+
+    float4 bilinear    = 0.0f;
+    float4 nearest     = 0.0f;
+    float  nearestDiff = 1e30f;
+    float  maxDiff     = 0.0f;
+
+    [unroll]
+    for (int i = 0; i < 4; ++i)
+    {
+        const int2   texel = clamp(base + int2(i & 1, i >> 1), int2(0, 0), (int2)gLowMax);
+        const float4 color = gLowColor.Load(int3(texel, 0));
+        const float  diff  = abs(LinearDepth(gLowDepth.Load(int3(texel, 0))) - sceneV);
+
+        bilinear += color * weights[i];
+
+        if (diff < nearestDiff)
+        {
+            nearestDiff = diff;
+            nearest     = color;
+        }
+
+        maxDiff = max(maxDiff, diff);
+    }
+
+    return (maxDiff < gDepthThreshold * sceneV) ? bilinear : nearest;
+}
@@ -0,0 +1,60 @@
+// *********************************************************************************
+// Filename:    LowResDepthPS.hlsl
+// Description: a pixel shader which downsamples the scene depth into the depth
+//              of the low resolution blending (by the fullscreen triangle of
+//              UpscaleVS.hlsl): each low resolution pixel gets the farthest
+//              depth of its block of scene pixels
+//
+//              NOTE: slots must be the same as in the Render::LowResBlending
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// GLOBALS
+//
+Texture2D<float> gSceneDepth : register(t1);
+
+cbuffer cbLowResBlend : register(b12)
+{
+    uint  gFactor;              // full resolution pixels per low resolution one
+    uint  gPadding0;
+    uint2 gFullMax;             // the last pixel of the rendered part of the scene depth
+    uint2 gLowMax;              // the last pixel of the rendered part of low resolution targets
+    float gProjA;               // view depth == gProjB / (depth - gProjA)
+    float gProjB;
+    float gDepthThreshold;      // relative difference of view depths which is an edge
+    float3 gPadding1;
+};
+
+
+//
+// TYPEDEFS
+//
+struct PS_IN
+{
+    float4 posH : SV_POSITION;
+    float2 tex  : TEXCOORD;
+};
+
+
+//
+// PIXEL SHADER
+//
+float PS(PS_IN pin) : SV_Depth
+{
+    const uint2 first = (uint2)pin.posH.xy * gFactor;
+    float       depth = 0.0f;
+
+    for (uint y = 0; y < gFactor; ++y)
+    {
+        for (uint x = 0; x < gFactor; ++x)
+        {
+            const uint2 pixel = min(first + uint2(x, y), gFullMax);
+            depth = max(depth, gSceneDepth.Load(int3(pixel, 0)));
+        }
+    }
+
+    return depth;
+}
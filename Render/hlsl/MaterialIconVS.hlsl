@@ -1,3 +1,4 @@
+#include "PackedVertex.hlsli"
 
 //
 // CONSTANT BUFFERS
@@ -18,8 +19,8 @@ struct VS_IN
     // data per vertex
     float3 posL      : POSITION;        // vertex position in local space
     float2 tex       : TEXCOORD;
-    float3 normalL   : NORMAL;          // vertex normal in local space
-    float3 tangentL  : TANGENT;         // tangent in local space
+    float3 normalL   : NORMAL;          // vertex normal in local space (packed)
+    float3 tangentL  : TANGENT;         // tangent in local space (packed)
 };
 
 struct VS_OUT
@@ -46,8 +47,8 @@ VS_OUT VS(VS_IN vin)
 
 
     // just copy the rest values into the output struct
-    vout.normalW    = mul(float4(vin.normalL, 1.0f), gWorldMatrix).xyz;
-    vout.tangentW   = mul(float4(vin.tangentL, 1.0f), gWorldMatrix).xyz;
+    vout.normalW    = mul(float4(UnpackUnitVector(vin.normalL), 1.0f), gWorldMatrix).xyz;
+    vout.tangentW   = mul(float4(UnpackUnitVector(vin.tangentL), 1.0f), gWorldMatrix).xyz;
     vout.tex        = vin.tex;
 
     return vout;
@@ -0,0 +1,40 @@
+// *********************************************************************************
+// Filename:    Octahedral.hlsli
+// Description: the octahedral mapping of unit vectors into [0,1]^2 (is used for
+//              normals of the G-buffer and directions of the sky fog LUT)
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// HELPERS
+//
+float2 OctWrap(float2 v)
+{
+    return (1.0f - abs(v.yx)) * ((v.xy >= 0.0f) ? 1.0f : -1.0f);
+}
+
+///////////////////////////////////////////////////////////
+
+float2 EncodeOctahedral(float3 n)
+{
+    // unit vector => [0,1]^2
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    n.xy = (n.z >= 0.0f) ? n.xy : OctWrap(n.xy);
+
+    return n.xy * 0.5f + 0.5f;
+}
+
+///////////////////////////////////////////////////////////
+
+float3 DecodeOctahedral(float2 e)
+{
+    e = e * 2.0f - 1.0f;
+
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    const float t = saturate(-n.z);
+    n.xy += (n.xy >= 0.0f) ? -t : t;      // (per component)
+
+    return normalize(n);
+}
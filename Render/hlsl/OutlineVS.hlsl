@@ -1,4 +1,5 @@
 #include "LightHelper.hlsli"
+#include "PackedVertex.hlsli"
 
 
 //
@@ -15,13 +16,12 @@ cbuffer cbVSPerFrame : register(b0)
 struct VS_IN
 {
 	// data per instance
-	row_major matrix   world             : WORLD;
-	row_major matrix   worldInvTranspose : WORLD_INV_TRANSPOSE;
+	row_major float3x4 world             : WORLD;
 	uint               instanceID        : SV_InstanceID;
 
 	// data per vertex
 	float3   posL       : POSITION;     // vertex position in local space
-	float3   normalL    : NORMAL;       // vertex normal in local space
+	float3   normalL    : NORMAL;       // vertex normal in local space (packed)
 };
 
 struct VS_OUT
@@ -39,13 +39,13 @@ VS_OUT VS(VS_IN vin)
 	VS_OUT vout;
 
 	// transform pos from local to world space
-	float3 posW = mul(float4(vin.posL, 1.0f), vin.world).xyz;
+	float3 posW = mul(vin.world, float4(vin.posL, 1.0f));
 
 	// transform to homogeneous clip space
 	vout.posH = mul(float4(posW, 1.0f), gViewProj);
 
 	//float4 clipPosition = UnityObjectToClipPos(position);
-	float3 clipNormal = mul((float3x3) gViewProj, mul((float3x3) vin.world, vin.normalL));
+	float3 clipNormal = mul((float3x3) gViewProj, mul((float3x3) vin.world, UnpackUnitVector(vin.normalL)));
 
 	float outlineWidth = 10;
 	vout.posH.xyz += normalize(clipNormal) * outlineWidth;
@@ -0,0 +1,13 @@
+// *********************************************************************************
+// Filename:    PackedVertex.hlsli
+// Description: decoding of packed vertex attributes (see Core/Mesh/VertexPacked.h);
+//              normals and tangents come as R10G10B10A2_UNORM in [0, 1]
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+// decode a unit vector which was packed as (v * 0.5 + 0.5)
+float3 UnpackUnitVector(float3 packed)
+{
+    return packed * 2.0f - 1.0f;
+}
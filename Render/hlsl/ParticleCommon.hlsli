@@ -0,0 +1,88 @@
+// *********************************************************************************
+// Filename:    ParticleCommon.hlsli
+// Description: common types and constants of GPU particles
+//              (is included by the particle shaders; see Render::GpuParticles)
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// TYPEDEFS
+//
+struct Particle
+{
+    // the same size as GpuParticles::PARTICLE_SIZE (64 bytes)
+    float3 posW;
+    float  age;                    // in seconds since the spawn
+    float3 velocity;
+    float  lifetime;
+    float  startSize;
+    float  endSize;
+    uint   startColor;             // packed RGBA8
+    uint   endColor;
+    float  gravity;
+    float  drag;
+    uint   flags;                  // the same as of the emitter (see PackParticleFlags)
+    float  rotation;               // of the quad around the view axis (in radians)
+};
+
+struct SortEntry
+{
+    float depth;                   // view depth (particles are sorted back to front)
+    uint  particleIdx;
+};
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbParticles : register(b6)
+{
+    matrix gView;
+    matrix gProj;
+    float3 gCameraPosW;
+    float  gDeltaTime;
+    float3 gCameraForwardW;
+    uint   gFrameIdx;
+    uint   gNumSpawns;             // particles to spawn in this frame (by all the emitters)
+    uint   gNumEmitters;
+    float  gNearZ;
+    float  gFarZ;
+    float  gInvSoftDistance;
+    uint   gSoftParticles;         // 1: the scene depth is bound to the PS
+    uint2  gPadding;
+};
+
+
+//
+// HELPERS
+//
+static const uint NO_TEXTURE_SLOT = 0xF;   // a procedural round sprite
+
+uint  GetTexSlot  (const uint flags) { return flags & 0xF; }
+uint  GetAtlasCols(const uint flags) { return (flags >> 4)  & 0xFF; }
+uint  GetAtlasRows(const uint flags) { return (flags >> 12) & 0xFF; }
+bool  IsAdditive  (const uint flags) { return (flags >> 20) & 0x1; }
+
+float4 UnpackColor(const uint c)
+{
+    return float4(c & 0xFF, (c >> 8) & 0xFF, (c >> 16) & 0xFF, c >> 24) / 255.0f;
+}
+
+uint WangHash(uint seed)
+{
+    seed = (seed ^ 61) ^ (seed >> 16);
+    seed *= 9;
+    seed = seed ^ (seed >> 4);
+    seed *= 0x27d4eb2d;
+    seed = seed ^ (seed >> 15);
+    return seed;
+}
+
+// return a random number in range [0, 1) and update the seed
+float Random(inout uint seed)
+{
+    seed = WangHash(seed);
+    return float(seed & 0x00FFFFFF) / 16777216.0f;
+}
@@ -0,0 +1,126 @@
+// *********************************************************************************
+// Filename:    ParticleEmitCS.hlsl
+// Description: a compute shader which spawns new particles: each thread finds
+//              its emitter by the idx of the particle among all the spawned in
+//              this frame, takes a free slot from the dead list, initializes
+//              the particle and appends it into the current alive list
+//
+//              NOTE: if there are fewer free slots than particles to spawn
+//                    the rest particles are just skipped
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "ParticleCommon.hlsli"
+
+
+//
+// TYPEDEFS
+//
+struct Emitter
+{
+    // the same layout as GpuParticleEmitter (80 bytes)
+    float3 posW;
+    uint   spawnStart;
+    float3 axisW;
+    uint   numSpawns;
+    float2 lifetime;               // min/max
+    float2 speed;                  // min/max
+    float2 size;                   // start/end
+    float  spreadCos;
+    float  gravity;
+    uint   startColor;
+    uint   endColor;
+    float  drag;
+    uint   flags;
+};
+
+
+//
+// GLOBALS
+//
+static const float PI2 = 6.28318530f;
+
+StructuredBuffer<Emitter>          gEmitters  : register(t0);
+ByteAddressBuffer                  gCounters  : register(t1);   // 0: dead, 4: current alive, 8: next alive
+
+RWStructuredBuffer<Particle>       gParticles : register(u0);
+ConsumeStructuredBuffer<uint>      gDeadList  : register(u1);
+AppendStructuredBuffer<SortEntry>  gAliveList : register(u2);
+
+
+//
+// HELPERS
+//
+
+// return the idx of the emitter which spawns the particle by input idx
+// (the last one whose start is <= the idx; emitters go by their starts)
+uint FindEmitter(const uint spawnIdx)
+{
+    uint lo = 0;
+    uint hi = gNumEmitters - 1;
+
+    while (lo < hi)
+    {
+        const uint mid = (lo + hi + 1) >> 1;
+
+        if (gEmitters[mid].spawnStart <= spawnIdx)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return lo;
+}
+
+// a random direction within the cone around input axis
+float3 RandomConeDir(const float3 axis, const float spreadCos, inout uint seed)
+{
+    const float cosTheta = lerp(spreadCos, 1.0f, Random(seed));
+    const float sinTheta = sqrt(saturate(1.0f - cosTheta * cosTheta));
+    const float phi      = PI2 * Random(seed);
+
+    const float3 helper  = (abs(axis.y) < 0.99f) ? float3(0, 1, 0) : float3(1, 0, 0);
+    const float3 tangent = normalize(cross(helper, axis));
+    const float3 bitan   = cross(axis, tangent);
+
+    return (tangent * cos(phi) + bitan * sin(phi)) * sinTheta + axis * cosTheta;
+}
+
+
+//
+// COMPUTE SHADER
+//
+[numthreads(256, 1, 1)]
+void CS(uint3 dtid : SV_DispatchThreadID)
+{
+    const uint spawnIdx = dtid.x;
+    const uint numFree  = gCounters.Load(0);
+
+    if ((spawnIdx >= gNumSpawns) || (spawnIdx >= numFree))
+        return;
+
+    const Emitter emitter = gEmitters[FindEmitter(spawnIdx)];
+    uint          seed    = WangHash(spawnIdx * 1973 + gFrameIdx * 9277 + 26699);
+
+    Particle p;
+    p.posW       = emitter.posW;
+    p.age        = 0.0f;
+    p.velocity   = RandomConeDir(emitter.axisW, emitter.spreadCos, seed) * lerp(emitter.speed.x, emitter.speed.y, Random(seed));
+    p.lifetime   = lerp(emitter.lifetime.x, emitter.lifetime.y, Random(seed));
+    p.startSize  = emitter.size.x;
+    p.endSize    = emitter.size.y;
+    p.startColor = emitter.startColor;
+    p.endColor   = emitter.endColor;
+    p.gravity    = emitter.gravity;
+    p.drag       = emitter.drag;
+    p.flags      = emitter.flags;
+    p.rotation   = PI2 * Random(seed);
+
+    const uint slot = gDeadList.Consume();
+    gParticles[slot] = p;
+
+    SortEntry entry;
+    entry.depth       = 0.0f;          // is computed by the simulation
+    entry.particleIdx = slot;
+    gAliveList.Append(entry);
+}
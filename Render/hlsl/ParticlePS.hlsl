@@ -0,0 +1,75 @@
+// *********************************************************************************
+// Filename:    ParticlePS.hlsl
+// Description: a pixel shader of GPU particles: the output is premultiplied by
+//              alpha and additive particles have zero alpha (so both alpha blended
+//              and additive ones are rendered by a single draw with ONE/INV_SRC_ALPHA);
+//              soft particles are faded by the distance to the scene depth
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "ParticleCommon.hlsli"
+
+
+//
+// GLOBALS
+//
+Texture2D<float> gSceneDepth : register(t30);  // is bound only for soft particles
+Texture2D        gTextures[4] : register(t31);  // t31..t34 (GpuParticles::MAX_TEXTURES)
+SamplerState     gSampler    : register(s3);   // linear clamp
+
+struct PS_IN
+{
+    float4 posH    : SV_POSITION;
+    float4 color   : COLOR;
+    float2 tex     : TEXCOORD;
+    float  depthV  : DEPTH;
+    nointerpolation uint flags : FLAGS;
+};
+
+
+//
+// HELPERS
+//
+
+// a texture is chosen by a slot which is the same for the whole quad
+// so gradients are computed before branches
+float4 SampleParticleTexture(const uint slot, const float2 tex)
+{
+    const float2 dx = ddx(tex);
+    const float2 dy = ddy(tex);
+
+    [branch]
+    switch (slot)
+    {
+        case 0:  return gTextures[0].SampleGrad(gSampler, tex, dx, dy);
+        case 1:  return gTextures[1].SampleGrad(gSampler, tex, dx, dy);
+        case 2:  return gTextures[2].SampleGrad(gSampler, tex, dx, dy);
+        case 3:  return gTextures[3].SampleGrad(gSampler, tex, dx, dy);
+    }
+
+    // no texture: a round sprite with soft edges
+    const float2 r = tex * 2.0f - 1.0f;
+    return float4(1, 1, 1, saturate(1.0f - dot(r, r)));
+}
+
+
+//
+// PIXEL SHADER
+//
+float4 PS(PS_IN pin) : SV_Target
+{
+    float4 color = pin.color * SampleParticleTexture(GetTexSlot(pin.flags), pin.tex);
+
+    if (gSoftParticles)
+    {
+        // linearize the scene depth behind the pixel
+        const float depth  = gSceneDepth.Load(int3(pin.posH.xy, 0));
+        const float sceneV = (gNearZ * gFarZ) / (gFarZ - depth * (gFarZ - gNearZ));
+
+        color.a *= saturate((sceneV - pin.depthV) * gInvSoftDistance);
+    }
+
+    clip(color.a - 0.004f);
+
+    return float4(color.rgb * color.a, IsAdditive(pin.flags) ? 0.0f : color.a);
+}
@@ -0,0 +1,57 @@
+// *********************************************************************************
+// Filename:    ParticleSimulateCS.hlsl
+// Description: a compute shader which integrates alive particles: each thread
+//              takes a particle from the current alive list; a dead particle
+//              returns its slot into the dead list, an alive one is appended
+//              into the next alive list along with its view depth (for the sort)
+//
+//              NOTE: the number of alive particles is known only by GPU so the
+//                    whole capacity is dispatched and extra threads just exit
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "ParticleCommon.hlsli"
+
+
+//
+// GLOBALS
+//
+StructuredBuffer<SortEntry>        gCurrAliveList : register(t0);
+ByteAddressBuffer                  gCounters      : register(t1);   // 0: dead, 4: current alive, 8: next alive
+
+RWStructuredBuffer<Particle>       gParticles     : register(u0);
+AppendStructuredBuffer<uint>       gDeadList      : register(u1);
+AppendStructuredBuffer<SortEntry>  gNextAliveList : register(u2);
+
+
+//
+// COMPUTE SHADER
+//
+[numthreads(256, 1, 1)]
+void CS(uint3 dtid : SV_DispatchThreadID)
+{
+    if (dtid.x >= gCounters.Load(4))
+        return;
+
+    const uint idx = gCurrAliveList[dtid.x].particleIdx;
+    Particle   p   = gParticles[idx];
+
+    p.age += gDeltaTime;
+
+    if (p.age >= p.lifetime)
+    {
+        gDeadList.Append(idx);
+        return;
+    }
+
+    p.velocity.y -= p.gravity * gDeltaTime;
+    p.velocity   *= saturate(1.0f - p.drag * gDeltaTime);
+    p.posW       += p.velocity * gDeltaTime;
+
+    gParticles[idx] = p;
+
+    SortEntry entry;
+    entry.depth       = dot(p.posW - gCameraPosW, gCameraForwardW);
+    entry.particleIdx = idx;
+    gNextAliveList.Append(entry);
+}
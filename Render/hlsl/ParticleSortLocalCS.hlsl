@@ -0,0 +1,113 @@
+// *********************************************************************************
+// Filename:    ParticleSortLocalCS.hlsl
+// Description: a compute shader of the bitonic sort of alive particles (back to
+//              front by view depth) within blocks of 1024 entries in groupshared
+//              memory: each thread compares and swaps a single pair of entries
+//
+//              - gK == 0: each block is sorted from scratch (the first pass);
+//                entries after the alive count are padded with the min depth
+//                so they go after all the alive ones;
+//              - gK > 0:  the rest steps (distances < the block size) of the
+//                merge of bitonic sequences of size gK
+//
+//              NOTE: the order (descending/ascending) of a sequence is defined
+//                    by the global idx of its entries so neighbour blocks form
+//                    bitonic sequences for the next merge
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "ParticleCommon.hlsli"
+
+
+//
+// GLOBALS
+//
+static const uint BLOCK_SIZE = 1024;       // GpuParticles::SORT_GROUP_SIZE
+static const uint NUM_THREADS = BLOCK_SIZE / 2;
+
+ByteAddressBuffer                gCounters  : register(t0);   // 8: the alive count
+RWStructuredBuffer<SortEntry>    gAliveList : register(u0);
+
+groupshared SortEntry gsEntries[BLOCK_SIZE];
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbParticleSort : register(b0)
+{
+    uint  gK;                      // the size of sequences to merge (0: sort the block)
+    uint  gJ;                      // the first distance of compared entries
+    uint2 gSortPadding;
+};
+
+
+//
+// HELPERS
+//
+void CompareAndSwap(const uint threadIdx, const uint blockStart, const uint k, const uint j)
+{
+    const uint i = ((threadIdx / j) * 2 * j) + (threadIdx % j);
+    const uint l = i + j;
+
+    const SortEntry a = gsEntries[i];
+    const SortEntry b = gsEntries[l];
+
+    // descending (far first) if the idx is in an even sequence of size k
+    const bool descending = (((blockStart + i) & k) == 0);
+
+    if ((a.depth < b.depth) == descending)
+    {
+        gsEntries[i] = b;
+        gsEntries[l] = a;
+    }
+}
+
+
+//
+// COMPUTE SHADER
+//
+[numthreads(NUM_THREADS, 1, 1)]
+void CS(uint3 gid : SV_GroupID, uint gtid : SV_GroupIndex)
+{
+    const uint blockStart = gid.x * BLOCK_SIZE;
+    const uint idx0       = blockStart + gtid;
+    const uint idx1       = idx0 + NUM_THREADS;
+
+    if (gK == 0)
+    {
+        const uint numAlive = gCounters.Load(8);
+
+        SortEntry padding;
+        padding.depth       = -3.402823466e+38f;
+        padding.particleIdx = 0;
+
+        gsEntries[gtid]               = (idx0 < numAlive) ? gAliveList[idx0] : padding;
+        gsEntries[gtid + NUM_THREADS] = (idx1 < numAlive) ? gAliveList[idx1] : padding;
+        GroupMemoryBarrierWithGroupSync();
+
+        for (uint k = 2; k <= BLOCK_SIZE; k <<= 1)
+        {
+            for (uint j = k >> 1; j > 0; j >>= 1)
+            {
+                CompareAndSwap(gtid, blockStart, k, j);
+                GroupMemoryBarrierWithGroupSync();
+            }
+        }
+    }
+    else
+    {
+        gsEntries[gtid]               = gAliveList[idx0];
+        gsEntries[gtid + NUM_THREADS] = gAliveList[idx1];
+        GroupMemoryBarrierWithGroupSync();
+
+        for (uint j = gJ; j > 0; j >>= 1)
+        {
+            CompareAndSwap(gtid, blockStart, gK, j);
+            GroupMemoryBarrierWithGroupSync();
+        }
+    }
+
+    gAliveList[idx0] = gsEntries[gtid];
+    gAliveList[idx1] = gsEntries[gtid + NUM_THREADS];
+}
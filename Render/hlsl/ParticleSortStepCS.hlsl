@@ -0,0 +1,50 @@
+// *********************************************************************************
+// Filename:    ParticleSortStepCS.hlsl
+// Description: a compute shader of a single global step of the bitonic sort of
+//              alive particles (for distances which don't fit into a block of
+//              ParticleSortLocalCS): each thread compares and swaps a single
+//              pair of entries which are gJ apart
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "ParticleCommon.hlsli"
+
+
+//
+// GLOBALS
+//
+RWStructuredBuffer<SortEntry> gAliveList : register(u0);
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbParticleSort : register(b0)
+{
+    uint  gK;                      // the size of sequences to merge
+    uint  gJ;                      // the distance of compared entries
+    uint2 gSortPadding;
+};
+
+
+//
+// COMPUTE SHADER
+//
+[numthreads(256, 1, 1)]
+void CS(uint3 dtid : SV_DispatchThreadID)
+{
+    const uint i = ((dtid.x / gJ) * 2 * gJ) + (dtid.x % gJ);
+    const uint l = i + gJ;
+
+    const SortEntry a = gAliveList[i];
+    const SortEntry b = gAliveList[l];
+
+    // descending (far first) if the idx is in an even sequence of size gK
+    const bool descending = ((i & gK) == 0);
+
+    if ((a.depth < b.depth) == descending)
+    {
+        gAliveList[i] = b;
+        gAliveList[l] = a;
+    }
+}
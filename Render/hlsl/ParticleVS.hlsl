@@ -0,0 +1,68 @@
+// *********************************************************************************
+// Filename:    ParticleVS.hlsl
+// Description: a vertex shader which expands GPU particles into view aligned quads:
+//              a 4-vertex quad (triangle strip) is drawn instanced and each vertex
+//              fetches its particle by the sorted alive list (by SV_InstanceID);
+//              the size, the color and the frame of the flipbook atlas are lerped
+//              by the age of the particle
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "ParticleCommon.hlsli"
+
+
+//
+// GLOBALS
+//
+StructuredBuffer<Particle>  gParticles  : register(t12);
+StructuredBuffer<SortEntry> gSortedList : register(t13);   // back to front
+
+struct VS_OUT
+{
+    float4 posH    : SV_POSITION;
+    float4 color   : COLOR;
+    float2 tex     : TEXCOORD;
+    float  depthV  : DEPTH;                    // view depth (for soft particles)
+    nointerpolation uint flags : FLAGS;
+};
+
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(uint vertexID : SV_VertexID, uint instanceID : SV_InstanceID)
+{
+    const Particle p = gParticles[gSortedList[instanceID].particleIdx];
+    const float    t = saturate(p.age / p.lifetime);
+
+    // 0: left-bottom, 1: left-top, 2: right-bottom, 3: right-top
+    const float2 corner = float2(
+        (vertexID & 2) ? 1.0f : -1.0f,
+        (vertexID & 1) ? 1.0f : -1.0f);
+
+    float sinR, cosR;
+    sincos(p.rotation, sinR, cosR);
+
+    const float  halfSize = 0.5f * lerp(p.startSize, p.endSize, t);
+    const float2 offset   = float2(corner.x * cosR - corner.y * sinR, corner.x * sinR + corner.y * cosR) * halfSize;
+
+    float4 posV = mul(float4(p.posW, 1.0f), gView);
+    posV.xy += offset;
+
+    // a frame of the flipbook atlas by the age
+    const uint cols      = max(GetAtlasCols(p.flags), 1);
+    const uint rows      = max(GetAtlasRows(p.flags), 1);
+    const uint numFrames = cols * rows;
+    const uint frame     = min((uint)(t * numFrames), numFrames - 1);
+
+    const float2 frameTex = float2(0.5f + 0.5f * corner.x, 0.5f - 0.5f * corner.y);
+
+    VS_OUT vout;
+    vout.posH   = mul(posV, gProj);
+    vout.color  = lerp(UnpackColor(p.startColor), UnpackColor(p.endColor), t);
+    vout.tex    = (frameTex + float2(frame % cols, frame / cols)) / float2(cols, rows);
+    vout.depthV = posV.z;
+    vout.flags  = p.flags;
+
+    return vout;
+}
@@ -0,0 +1,47 @@
+// *********************************************************************************
+// Filename:    PlanarReflectionPS.hlsl
+// Description: a pixel shader which blends the planar reflection over pixels of
+//              the mirror (by the fullscreen triangle of UpscaleVS.hlsl; pixels
+//              of the mirror are chosen by the stencil test)
+//
+//              NOTE: the reflection is rendered by the same projection as the scene
+//                    so a pixel takes it by its screen coords
+//              NOTE: slots must be the same as in the Render::PlanarReflection
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// GLOBALS
+//
+Texture2D<float4> gReflection : register(t1);
+SamplerState      gSampleType : register(s0);
+
+cbuffer cbPlanarReflection : register(b12)
+{
+    float2 gInvSceneSize;       // pixel => uv of the reflection
+    float  gStrength;           // how much of the reflection is blended over the mirror
+    float  gPadding;
+};
+
+
+//
+// TYPEDEFS
+//
+struct PS_IN
+{
+    float4 posH : SV_POSITION;
+    float2 tex  : TEXCOORD;
+};
+
+
+//
+// PIXEL SHADER
+//
+float4 PS(PS_IN pin) : SV_Target
+{
+    const float2 uv = pin.posH.xy * gInvSceneSize;
+
+    return float4(gReflection.Sample(gSampleType, uv).rgb, gStrength);
+}
@@ -0,0 +1,64 @@
+// *********************************************************************************
+// Filename:    ShadowMaps.hlsli
+// Description: cascaded shadow maps of the sun (the first directional light):
+//              a cascade is chosen by the view depth of the pixel and its depth
+//              is compared with the shadow map by 3x3 PCF
+//
+//              NOTE: slots must be the same as in the Render::ShadowMaps
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+Texture2DArray         gShadowMaps   : register(t23);    // a slice per cascade
+SamplerComparisonState gShadowSampler : register(s4);
+
+cbuffer cbShadows : register(b8)
+{
+    float4x4 gShadowTransforms[4];   // world => texture space of the cascade (uv, depth)
+    float4   gShadowSplits;          // the far view depth of each cascade
+    float    gShadowTexelSize;       // 1 / size of the shadow map
+    float    gShadowDepthBias;
+    int      gNumShadowCascades;     // 0: no shadows
+    float    gShadowFadeStart;       // shadows fade out till the far split of the last cascade
+};
+
+///////////////////////////////////////////////////////////
+
+float ComputeShadowFactor(float3 posW, float viewDepth)
+{
+    // return: 0 - fully in shadow, 1 - fully lit
+
+    if ((gNumShadowCascades == 0) || (viewDepth >= gShadowSplits[gNumShadowCascades - 1]))
+        return 1.0f;
+
+    // splits of unused cascades are "infinite" so they are never chosen
+    int cascade = 0;
+
+    [unroll]
+    for (int i = 0; i < 3; ++i)
+        cascade += (viewDepth > gShadowSplits[i]) ? 1 : 0;
+
+    const float4 posS  = mul(float4(posW, 1.0f), gShadowTransforms[cascade]);
+    const float  depth = posS.z - gShadowDepthBias;
+
+    // 3x3 PCF (each comparison sample is bilinear already)
+    float lit = 0.0f;
+
+    [unroll]
+    for (int y = -1; y <= 1; ++y)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; ++x)
+        {
+            const float2 uv = posS.xy + float2(x, y) * gShadowTexelSize;
+            lit += gShadowMaps.SampleCmpLevelZero(gShadowSampler, float3(uv, cascade), depth);
+        }
+    }
+
+    lit *= (1.0f / 9.0f);
+
+    // no hard edge where shadows end
+    const float fade = saturate((viewDepth - gShadowFadeStart) / (gShadowSplits[gNumShadowCascades - 1] - gShadowFadeStart));
+
+    return lerp(lit, 1.0f, fade);
+}
@@ -0,0 +1,124 @@
+// *********************************************************************************
+// Filename:    SkinnedVS.hlsl
+// Description: a vertex shader of skinned crowds: skinning matrices of 4 bones
+//              are fetched from the animation texture (a row per baked frame,
+//              3 texels per bone) for 2 frames of the instance, the frames are
+//              blended and the vertex is skinned by the weighted sum of matrices;
+//              the output is the same as of LightVS so the light PS is reused
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "LightHelper.hlsli"
+#include "PackedVertex.hlsli"
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbVSPerFrame : register(b0)
+{
+    matrix gViewProj;
+    float  gGameTime;
+};
+
+// table of all the materials (is re-uploaded only when materials are changed)
+StructuredBuffer<Material> gMaterials : register(t0);
+
+// layers of the materials diffuse/normal maps in the packed texture arrays (-1: not packed)
+StructuredBuffer<int2>     gMaterialTexLayers : register(t1);
+
+// baked skinning palettes: rows of the transposed 3x4 matrices
+Texture2D<float4>          gAnimPalettes : register(t2);
+
+//
+// TYPEDEFS
+//
+struct VS_IN
+{
+    // data per instance
+    row_major float3x4 world             : WORLD;
+    uint               materialIdx       : MATERIAL_IDX;
+    uint2              frames            : ANIM_FRAMES;
+    float              frameLerp         : ANIM_LERP;
+    uint               instanceID        : SV_InstanceID;
+
+    // data per vertex
+    float3   posL       : POSITION;     // vertex position in the bind pose
+    float2   tex        : TEXCOORD;
+    float3   normalL    : NORMAL;       // (packed)
+    float3   tangentL   : TANGENT;      // (packed)
+
+    uint4    boneIdxs   : BONE_IDXS;
+    float4   weights    : BONE_WEIGHTS; // sum up to 1
+};
+
+struct VS_OUT
+{
+    float4x4 material   : MATERIAL;
+    precise float4 posH : SV_POSITION;
+    float3   posW       : POSITION;     // position in world
+    float3   normalW    : NORMAL;       // normal in world
+    float3   tangentW   : TANGENT;      // tangent in world
+    float2   tex        : TEXCOORD;
+    nointerpolation int2 texLayers : TEX_LAYERS;
+    uint     instanceID : SV_InstanceID;
+    nointerpolation uint materialIdx : MATERIAL_IDX;
+};
+
+//
+// HELPERS
+//
+float3x4 LoadBone(const uint bone, const uint frame)
+{
+    const uint x = bone * 3;
+
+    return float3x4(
+        gAnimPalettes.Load(int3(x + 0, frame, 0)),
+        gAnimPalettes.Load(int3(x + 1, frame, 0)),
+        gAnimPalettes.Load(int3(x + 2, frame, 0)));
+}
+
+//---------------------------------------------------------
+// a skinning matrix of the bone blended between two frames
+//---------------------------------------------------------
+float3x4 LoadBlendedBone(const uint bone, const uint2 frames, const float lerpFactor)
+{
+    return lerp(LoadBone(bone, frames.x), LoadBone(bone, frames.y), lerpFactor);
+}
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(VS_IN vin)
+{
+    VS_OUT vout;
+
+    // fetch material of this instance from the table
+    const Material mat = gMaterials[vin.materialIdx];
+    vout.material  = float4x4(mat.ambient, mat.diffuse, mat.specular, mat.reflect);
+    vout.texLayers = gMaterialTexLayers[vin.materialIdx];
+
+    // linear blend skinning: the weighted sum of the bones matrices
+    // (each one is lerped between frames which is fine at the bake rate)
+    float3x4 skin = vin.weights.x * LoadBlendedBone(vin.boneIdxs.x, vin.frames, vin.frameLerp);
+    skin += vin.weights.y * LoadBlendedBone(vin.boneIdxs.y, vin.frames, vin.frameLerp);
+    skin += vin.weights.z * LoadBlendedBone(vin.boneIdxs.z, vin.frames, vin.frameLerp);
+    skin += vin.weights.w * LoadBlendedBone(vin.boneIdxs.w, vin.frames, vin.frameLerp);
+
+    // bind pose => model space => world
+    const float3 posM     = mul(skin, float4(vin.posL, 1.0f));
+    const float3 normalM  = mul((float3x3)skin, UnpackUnitVector(vin.normalL));
+    const float3 tangentM = mul((float3x3)skin, UnpackUnitVector(vin.tangentL));
+
+    vout.posW = mul(vin.world, float4(posM, 1.0f));
+    vout.posH = mul(float4(vout.posW, 1.0f), gViewProj);
+
+    // skinned matrices can have a non-uniform scale but bones are mostly rigid
+    vout.normalW  = normalize(mul((float3x3)vin.world, normalM));
+    vout.tangentW = normalize(mul((float3x3)vin.world, tangentM));
+
+    vout.tex         = vin.tex;
+    vout.instanceID  = vin.instanceID;
+    vout.materialIdx = vin.materialIdx;
+
+    return vout;
+}
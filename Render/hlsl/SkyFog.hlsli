@@ -0,0 +1,28 @@
+// *********************************************************************************
+// Filename:    SkyFog.hlsli
+// Description: the sky fog LUT: a tiny texture of the sky color along directions
+//              (octahedral mapping) which is built by Render::SkyFogLut only when
+//              the sky is changed; fogged pixels blend into the sky behind them
+//              by a fetch of this LUT (instead of the sky cube map)
+//
+//              NOTE: the slot must be the same as in the Render::SkyFogLut
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "Octahedral.hlsli"
+
+Texture2D gSkyFogLut : register(t31);
+
+static const float SKY_FOG_LUT_SIZE = 32.0f;
+
+///////////////////////////////////////////////////////////
+
+float3 GetSkyFogColor(SamplerState samplerState, float3 dirW)
+{
+    // dirW: a unit direction from the eye to the pixel;
+    // uv is kept inside of the texels border so wrapping doesn't bleed
+    const float halfTexel = 0.5f / SKY_FOG_LUT_SIZE;
+    const float2 uv       = clamp(EncodeOctahedral(dirW), halfTexel, 1.0f - halfTexel);
+
+    return gSkyFogLut.SampleLevel(samplerState, uv, 0).rgb;
+}
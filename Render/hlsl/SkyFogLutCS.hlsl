@@ -0,0 +1,45 @@
+// *********************************************************************************
+// Filename:    SkyFogLutCS.hlsl
+// Description: a compute shader which builds the sky fog LUT: each thread is
+//              a texel of the LUT which stores the sky color (the same as
+//              rendered by SkyDomePS.hlsl) along its octahedral direction
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "Octahedral.hlsli"
+
+
+//
+// GLOBALS
+//
+TextureCube         gCubeMap    : register(t0);
+SamplerState        gSampleType : register(s0);
+
+RWTexture2D<float4> gLut        : register(u0);
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbSkyFog : register(b0)
+{
+    uint  gLutSize;
+    float gInvLutSize;
+    float2 gPadding;
+};
+
+
+//
+// COMPUTE SHADER
+//
+[numthreads(8, 8, 1)]
+void CS(uint3 dtid : SV_DispatchThreadID)
+{
+    if ((dtid.x >= gLutSize) || (dtid.y >= gLutSize))
+        return;
+
+    const float3 dir = DecodeOctahedral((float2(dtid.xy) + 0.5f) * gInvLutSize);
+
+    // a blurred mip: the LUT is tiny so fine details of the sky aren't needed
+    gLut[dtid.xy] = float4(gCubeMap.SampleLevel(gSampleType, dir, 2.0f).rgb, 1.0f);
+}
@@ -0,0 +1,53 @@
+// *********************************************************************************
+// Filename:    StaticGatherCS.hlsl
+// Description: a compute shader for static batches: each thread copies a single
+//              instance record (it is chosen by the visibility list of this frame)
+//              from the persistent records buffer into the visible instances
+//              buffer which is then bound as the per-instance vertex stream
+//
+//              NOTE: record i of the visible buffer is the record gIdxs[i] so
+//                    the CPU only defines the order of visible instances
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// GLOBALS
+//
+static const uint INSTANCE_SIZE = 96;      // sizeof(ConstBufType::InstancedData)
+
+ByteAddressBuffer      gRecords : register(t0);
+StructuredBuffer<uint> gIdxs    : register(t1);
+
+RWByteAddressBuffer    gVisible : register(u0);
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbStaticGather : register(b0)
+{
+    uint  gNumIdxs;                // the number of records to copy
+    uint3 gPadding;
+};
+
+
+// =================================================================================
+// Compute Shader
+// =================================================================================
+[numthreads(64, 1, 1)]
+void CS(uint3 dispatchId : SV_DispatchThreadID)
+{
+    const uint idx = dispatchId.x;
+
+    if (idx >= gNumIdxs)
+        return;
+
+    const uint srcAddr = gIdxs[idx] * INSTANCE_SIZE;
+    const uint dstAddr = idx * INSTANCE_SIZE;
+
+    [unroll]
+    for (uint offset = 0; offset < INSTANCE_SIZE; offset += 16)
+        gVisible.Store4(dstAddr + offset, gRecords.Load4(srcAddr + offset));
+}
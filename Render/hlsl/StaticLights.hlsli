@@ -0,0 +1,61 @@
+// *********************************************************************************
+// Filename:    StaticLights.hlsli
+// Description: baked lighting of static point/spot lights (see Core::LightBaker):
+//              a world-space volume over the ranges of the lights where each voxel
+//              keeps the sum of the lights' diffuse/ambient colors (attenuated and
+//              shadowed) and the mean direction to them; static lights aren't in
+//              the clusters so the lit shaders get them by 3 fetches instead of a
+//              loop over the lights
+//
+//              NOTE: slots must be the same as in the Render::CRender
+//                    (STATIC_LIGHTS_SLOT); the const buffer of the shader must
+//                    declare gStaticLightsMin/InvSize/NormalBias and gHasStaticLights
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+Texture3D gStaticLightsDiffuse : register(t35);   // rgb: sum of diffuse colors (without N dot L)
+Texture3D gStaticLightsAmbient : register(t36);   // rgb: sum of ambient colors
+Texture3D gStaticLightsDir     : register(t37);   // xyz: mean direction to the lights weighted by their luminance
+
+///////////////////////////////////////////////////////////
+
+void ComputeStaticLights(
+    SamplerState samplerState,
+    Material mat,
+    float3 posW,
+    float3 normal,
+    out float4 ambient,
+    out float4 diffuse)
+{
+    ambient = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    diffuse = float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+    // the sample point is pushed out of the surface so voxels behind it
+    // (inside of walls: they are shadowed) aren't blended in
+    const float3 uvw = (posW + normal * gStaticLightsNormalBias - gStaticLightsMin) * gStaticLightsInvSize;
+
+    // there are no static lights outside of the volume
+    if (any(uvw < 0.0f) || any(uvw > 1.0f))
+        return;
+
+    float3 dims;
+    gStaticLightsDiffuse.GetDimensions(dims.x, dims.y, dims.z);
+
+    // sample inside of the border texels so wrapping samplers don't bleed
+    const float3 halfTexel = 0.5f / dims;
+    const float3 uvwClamp  = clamp(uvw, halfTexel, 1.0f - halfTexel);
+
+    const float3 lightColor = gStaticLightsDiffuse.SampleLevel(samplerState, uvwClamp, 0).rgb;
+    const float3 ambColor   = gStaticLightsAmbient.SampleLevel(samplerState, uvwClamp, 0).rgb;
+    const float3 dir        = gStaticLightsDir.SampleLevel(samplerState, uvwClamp, 0).xyz;
+
+    // a single light gives a unit mean direction (so it is N dot L), lights from
+    // all around give a short one: it tends to the mean N dot L over sphere (1/4)
+    const float len      = length(dir);
+    const float nDotL    = (len > 1e-4f) ? saturate(dot(normal, dir / len)) : 0.0f;
+    const float lambert  = lerp(0.25f, nDotL, saturate(len));
+
+    ambient = mat.ambient * float4(ambColor, 0.0f);
+    diffuse = mat.diffuse * float4(lightColor * lambert, 0.0f);
+}
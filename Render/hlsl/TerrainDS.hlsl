@@ -0,0 +1,80 @@
+// *********************************************************************************
+// Filename:    TerrainDS.hlsl
+// Description: a domain shader of the tessellated terrain: a generated vertex
+//              is displaced by the height map; its output is the same as of
+//              TerrainVS (is used by TerrainPS)
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "TerrainTess.hlsli"
+
+
+//
+// GLOBALS
+//
+Texture2D    gHeightMap    : register(t0);
+SamplerState gSampleHeight : register(s0);
+
+
+//
+// TYPEDEFS
+//
+struct DS_OUT
+{
+	float4   posH       : SV_POSITION;  // homogeneous position
+	float4   color      : COLOR;
+	float3   posW       : POSITION;     // position in world
+	float3   normalW    : NORMAL;       // normal in world
+	float3   tangentW   : TANGENT;      // tangent in world
+	float2   tex        : TEXCOORD;
+};
+
+
+//
+// HELPERS
+//
+float SampleHeight(float2 posXZ)
+{
+	// texel (x,z) of the height map is the height at point (x,z) in world
+	const float2 uv = (posXZ + 0.5f) * gTexelSize;
+	return gHeightMap.SampleLevel(gSampleHeight, uv, 0).r * gHeightScale;
+}
+
+
+//
+// DOMAIN SHADER
+//
+[domain("quad")]
+DS_OUT DS(
+	PatchTess patchTess,
+	float2 uv : SV_DomainLocation,
+	const OutputPatch<ControlPoint, 4> quad)
+{
+	DS_OUT dout;
+
+	// bilinear interpolation of the corners
+	float3 posW = lerp(
+		lerp(quad[0].posW, quad[1].posW, uv.x),
+		lerp(quad[2].posW, quad[3].posW, uv.x),
+		uv.y);
+
+	// displacement by the height map
+	posW.y = SampleHeight(posW.xz);
+
+	// normal and tangent by central differences of heights (a texel is 1 unit)
+	const float hL = SampleHeight(posW.xz - float2(1.0f, 0.0f));
+	const float hR = SampleHeight(posW.xz + float2(1.0f, 0.0f));
+	const float hD = SampleHeight(posW.xz - float2(0.0f, 1.0f));
+	const float hU = SampleHeight(posW.xz + float2(0.0f, 1.0f));
+
+	dout.posW     = posW;
+	dout.posH     = mul(float4(posW, 1.0f), gViewProj);
+	dout.color    = float4(1.0f, 1.0f, 1.0f, 1.0f);
+	dout.normalW  = normalize(float3(hL - hR, 2.0f, hD - hU));
+	dout.tangentW = normalize(float3(2.0f, hR - hL, 0.0f));
+
+	// texture coords are the same as of the geomipmapped terrain
+	dout.tex      = posW.xz * gTexelSize;
+
+	return dout;
+}
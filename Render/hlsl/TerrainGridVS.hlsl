@@ -0,0 +1,164 @@
+// *********************************************************************************
+// Filename:    TerrainGridVS.hlsl
+// Description: a vertex shader of the terrain rendered by vertex pulling: a vertex
+//              has only its 2D coords in the grid of a single patch (which is shared
+//              by all the patches) and the first grid vertex of the patch comes per
+//              instance; the height, normal and texture coords are computed by the
+//              height map; the output is the same as of TerrainVS (is used by TerrainPS)
+//
+//              geomorphing: a vertex which is absent in the parent (coarser) LOD
+//              is moved towards the parent's surface by the morph factor of its
+//              patch (or of its patch's side) so LODs are switched without pops
+//
+//              NOTE: the layout of cbTerrainGrid must be the same as of
+//                    ConstBufType::cbvsTerrainGrid
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbVSPerFrame : register(b0)
+{
+	matrix gViewProj;
+};
+
+cbuffer cbTerrainGrid : register(b4)
+{
+	float2 gOrigin;                 // position of the height map's (0,0) in world
+	float  gGridStep;               // distance btw grid vertices (a texel is 1 unit in world)
+	float  gHeightScale;            // a sample of the height map [0,1] => height in world
+	float  gTexelSize;              // 1 / size of the height map
+	uint   gCellsPerPatch;          // grid cells per side of a patch
+	float2 gPadding;
+};
+
+
+//
+// GLOBALS
+//
+Texture2D    gHeightMap    : register(t0);
+SamplerState gSampleHeight : register(s0);
+
+
+//
+// TYPEDEFS
+//
+struct VS_IN
+{
+	uint2    gridPos    : POSITION;     // a vertex of the patch grid (x,z)
+	uint2    patchStart : PATCH;        // the first grid vertex of the patch (per instance)
+	float4   edgeMorphs : MORPH0;       // morph factors of sides: left, up, right, down
+	float    morph      : MORPH1;       // morph factor of inner vertices
+	uint2    lods       : LOD;          // LOD of the patch, LODs of sides (8 bits per side)
+};
+
+struct VS_OUT
+{
+	float4   posH       : SV_POSITION;  // homogeneous position
+	float4   color      : COLOR;
+	float3   posW       : POSITION;     // position in world
+	float3   normalW    : NORMAL;       // normal in world
+	float3   tangentW   : TANGENT;      // tangent in world
+	float2   tex        : TEXCOORD;
+};
+
+
+//
+// HELPERS
+//
+float SampleHeight(float2 posXZ)
+{
+	// texel (x,z) of the height map is the height at point (x,z) of the map
+	const float2 uv = (posXZ + 0.5f) * gTexelSize;
+	return gHeightMap.SampleLevel(gSampleHeight, uv, 0).r * gHeightScale;
+}
+
+///////////////////////////////////////////////////////////
+
+float SampleGridHeight(int2 gridPos, uint2 patchStart)
+{
+	return SampleHeight((float2)(gridPos + (int2)patchStart) * gGridStep);
+}
+
+///////////////////////////////////////////////////////////
+
+float MorphHeight(VS_IN vin, float height)
+{
+	// a vertex of a side is morphed by the factor/LOD of the side
+	// (the same for both the neighbor patches); corners are never morphed
+	const uint2 g    = vin.gridPos;
+	const uint  last = gCellsPerPatch;
+
+	uint  lod   = vin.lods.x;
+	float morph = vin.morph;
+
+	const int side = (g.x == 0) ? 0 : (g.y == last) ? 1 : (g.x == last) ? 2 : (g.y == 0) ? 3 : -1;
+
+	if (side != -1)
+	{
+		lod   = (vin.lods.y >> (side * 8)) & 0xFF;
+		morph = vin.edgeMorphs[side];
+	}
+
+	// vertices of the grid of step 2*h are in the parent LOD as well
+	const uint  h   = 1u << lod;
+	const uint2 odd = (g >> lod) & 1;
+
+	if ((morph <= 0.0f) || !any(odd))
+		return height;
+
+	float parentHeight;
+
+	if (all(odd))
+	{
+		// the center of a fan lies in the middle of the diagonal btw
+		// the center and a corner of the parent's fan
+		const uint  parentFan = 4 * h;
+		const int2  center    = (int2)((g / parentFan) * parentFan + 2 * h);
+		const int2  corner    = 2 * (int2)g - center;
+
+		parentHeight = 0.5f * (SampleGridHeight(center, vin.patchStart) + SampleGridHeight(corner, vin.patchStart));
+	}
+	else
+	{
+		// a mid vertex of a side of a fan lies in the middle of the parent's edge
+		const int2 dir = (odd.x) ? int2(h, 0) : int2(0, h);
+
+		parentHeight = 0.5f * (SampleGridHeight((int2)g - dir, vin.patchStart) + SampleGridHeight((int2)g + dir, vin.patchStart));
+	}
+
+	return lerp(height, parentHeight, morph);
+}
+
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(VS_IN vin)
+{
+	VS_OUT vout;
+
+	// position in the height map (the same as of the static grid of geomipmapping)
+	const float2 posXZ = (float2)(vin.gridPos + vin.patchStart) * gGridStep;
+	const float  posY  = MorphHeight(vin, SampleHeight(posXZ));
+
+	// normal and tangent by central differences of heights (one grid step aside)
+	const float hL = SampleHeight(posXZ - float2(gGridStep, 0.0f));
+	const float hR = SampleHeight(posXZ + float2(gGridStep, 0.0f));
+	const float hD = SampleHeight(posXZ - float2(0.0f, gGridStep));
+	const float hU = SampleHeight(posXZ + float2(0.0f, gGridStep));
+
+	vout.posW     = float3(posXZ.x + gOrigin.x, posY, posXZ.y + gOrigin.y);
+	vout.posH     = mul(float4(vout.posW, 1.0f), gViewProj);
+	vout.color    = float4(1.0f, 1.0f, 1.0f, 1.0f);
+	vout.normalW  = normalize(float3(hL - hR, 2.0f * gGridStep, hD - hU));
+	vout.tangentW = normalize(float3(2.0f * gGridStep, hR - hL, 0.0f));
+
+	// color comes from the texture/light maps by these coords (see TerrainPS)
+	vout.tex      = posXZ * gTexelSize;
+
+	return vout;
+}
@@ -0,0 +1,100 @@
+// *********************************************************************************
+// Filename:    TerrainHS.hlsl
+// Description: a hull shader of the tessellated terrain: patches out of the
+//              frustum are culled (zero tess factors), and each edge is
+//              tessellated by its screen-space length so adjacent patches
+//              always have the same factors along their common edge (no cracks)
+//
+//              corners order of the patch (u is along +X, v is along -Z):
+//              0 -- 1
+//              |    |
+//              2 -- 3
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "TerrainTess.hlsli"
+
+
+//
+// HELPERS
+//
+bool AabbOutsideFrustum(float3 center, float3 extents)
+{
+	[unroll]
+	for (int i = 0; i < 6; ++i)
+	{
+		// the projected "radius" of the box onto the plane's normal
+		const float r = dot(extents, abs(gFrustumPlanes[i].xyz));
+
+		if (dot(float4(center, 1.0f), gFrustumPlanes[i]) < -r)
+			return true;
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////
+
+float CalcTessFactor(float3 p0, float3 p1)
+{
+	// the edge is bounded by a sphere: its diameter in pixels defines the factor
+	const float3 center   = 0.5f * (p0 + p1);
+	const float  diameter = distance(p0, p1);
+	const float  w        = max(mul(float4(center, 1.0f), gViewProj).w, 0.01f);
+	const float  pixels   = diameter * gScreenScale / w;
+
+	return clamp(pixels / gTargetEdgePixels, 1.0f, gMaxTessFactor);
+}
+
+
+//
+// CONSTANT HULL SHADER
+//
+PatchTess ConstantHS(InputPatch<ControlPoint, 4> patch, uint patchID : SV_PrimitiveID)
+{
+	PatchTess pt;
+
+	// the patch's AABB: xz by the corners, y by the min/max heights of the patch
+	const float3 vMin = float3(patch[2].posW.x, patch[0].boundsY.x, patch[2].posW.z);
+	const float3 vMax = float3(patch[1].posW.x, patch[0].boundsY.y, patch[1].posW.z);
+
+	if (AabbOutsideFrustum(0.5f * (vMin + vMax), 0.5f * (vMax - vMin)))
+	{
+		pt.edgeTess[0]   = 0.0f;
+		pt.edgeTess[1]   = 0.0f;
+		pt.edgeTess[2]   = 0.0f;
+		pt.edgeTess[3]   = 0.0f;
+		pt.insideTess[0] = 0.0f;
+		pt.insideTess[1] = 0.0f;
+		return pt;
+	}
+
+	pt.edgeTess[0] = CalcTessFactor(patch[0].posW, patch[2].posW);    // u == 0
+	pt.edgeTess[1] = CalcTessFactor(patch[0].posW, patch[1].posW);    // v == 0
+	pt.edgeTess[2] = CalcTessFactor(patch[1].posW, patch[3].posW);    // u == 1
+	pt.edgeTess[3] = CalcTessFactor(patch[2].posW, patch[3].posW);    // v == 1
+
+	const float inside = 0.25f * (pt.edgeTess[0] + pt.edgeTess[1] + pt.edgeTess[2] + pt.edgeTess[3]);
+	pt.insideTess[0] = inside;
+	pt.insideTess[1] = inside;
+
+	return pt;
+}
+
+
+//
+// CONTROL POINT HULL SHADER
+//
+[domain("quad")]
+[partitioning("fractional_even")]
+[outputtopology("triangle_cw")]
+[outputcontrolpoints(4)]
+[patchconstantfunc("ConstantHS")]
+[maxtessfactor(64.0f)]
+ControlPoint HS(
+	InputPatch<ControlPoint, 4> patch,
+	uint i : SV_OutputControlPointID,
+	uint patchID : SV_PrimitiveID)
+{
+	return patch[i];
+}
@@ -1,10 +1,11 @@
 #include "LightHelper.hlsli"
+#include "SkyFog.hlsli"
+#include "DebugHeatmap.hlsli"
 
 
 //
 // GLOBALS
 //
-TextureCube  gCubeMap       : register(t0);
 Texture2D    gTextures[22]  : register(t1);
 
 SamplerState gSampleSky     : register(s0);
@@ -18,13 +19,17 @@ SamplerState gSampleType    : register(s1);
 
 cbuffer cbPerFrame    : register(b0)
 {
-    // light sources data
+    // light sources data (point/spot lights are in structured buffers)
     DirectionalLight  gDirLights[3];
-    PointLight        gPointLights[25];
-    SpotLight         gSpotLights[25];
     float3            gEyePosW;                // eye position in world space  
     int               gCurrNumPointLights;
     int               gCurrNumSpotLights;
+
+    // params of the light clusters grid
+    uint3             gClusterDims;
+    float2            gClusterScaleXY;         // pixel => cluster xy
+    float             gClusterSliceScale;      // view depth => cluster z
+    float             gClusterSliceBias;
 };
 
 cbuffer cbRareChanged : register(b1)
@@ -43,6 +48,10 @@ cbuffer cbRareChanged : register(b1)
     int    gAlphaClipping;       // turn on/off alpha clipping
 };
 
+#include "ClusteredLights.hlsli"
+#include "ShadowMaps.hlsli"
+#include "VirtualTexture.hlsli"
+
 cbuffer cbTerrain : register(b5)
 {
     float4 gAmbient;
@@ -51,6 +60,14 @@ cbuffer cbTerrain : register(b5)
     float4 gReflect;
 };
 
+cbuffer cbTerrainDebug : register(b6)
+{
+    int    gDebugType;           // a heatmap (0 - the terrain is shaded as usual)
+    uint   gPatchLod;            // of the current draw
+    uint   gPatchNum;
+    float  gPatchTriArea;        // area of a triangle of the current draw (by the XZ plane)
+};
+
 //
 // TYPEDEFS
 //
@@ -71,11 +88,54 @@ struct PS_OUT
 };
 
 
+//
+// HELPERS
+//
+float4 GetHeatmapColor(PS_IN pin)
+{
+    // the world area which is covered by this pixel (by the XZ plane as the triangle's area)
+    const float3 dx        = ddx(pin.posW);
+    const float3 dy        = ddy(pin.posW);
+    const float  pixelArea = abs(dx.x*dy.z - dx.z*dy.x);
+
+    switch (gDebugType)
+    {
+        case SHOW_OVERDRAW:
+        {
+            return float4(OVERDRAW_LAYER_COLOR, 1.0f);
+        }
+        case SHOW_LOD:
+        {
+            return float4(LodColor(gPatchLod), 1.0f);
+        }
+        case SHOW_LIGHT_COUNT:
+        {
+            const ClusterLights cl = GetClusterLights(pin.posH, gClusterDims, gClusterScaleXY, gClusterSliceScale, gClusterSliceBias);
+            return float4(HeatColor((cl.numPoint + cl.numSpot) / MAX_LIGHTS_HEAT), 1.0f);
+        }
+        case SHOW_TRIANGLE_DENSITY:
+        {
+            // triangles per pixel == pixel area / triangle area
+            return float4(HeatColor(pixelArea / max(gPatchTriArea, 1e-6f)), 1.0f);
+        }
+        case SHOW_BATCHES:
+        {
+            return float4(HashColor(gPatchNum), 1.0f);
+        }
+    }
+
+    return float4(1.0f, 0.0f, 1.0f, 1.0f);
+}
+
 //
 // PIXEL SHADER
 //
+[earlydepthstencil]    // occluded pixels must not request pages of the virtual texture
 float4 PS(PS_IN pin) : SV_Target
 {
+    if (gDebugType != 0)
+        return GetHeatmapColor(pin);
+
     // a vector in the world space from vertex to eye pos
     float3 toEyeW = gEyePosW - pin.posW;
 
@@ -87,17 +147,11 @@ float4 PS(PS_IN pin) : SV_Target
 
     // --------------------------------------------------
 
-    // HACK to get proper sky pixel
-    float3 vec = -toEyeW;
-    vec.y -= 990;
-
-    float4 skyTexColor = gCubeMap.Sample(gSampleType, vec);
-
     // return blended fixed fog color with the sky color at this pixel
     // if the pixel is fully fogged
     if (gFogEnabled && distToEye > (gFogStart + gFogRange))
     {
-        return skyTexColor * float4(gFixedFogColor, 1.0f);
+        return float4(GetSkyFogColor(gSampleSky, -toEyeW) * gFixedFogColor, 1.0f);
     }
 
 
@@ -106,8 +160,15 @@ float4 PS(PS_IN pin) : SV_Target
     // how many times we scale the detail map
     const float detalizationLvl = 32;
 
-    float4 textureColor   = gTextures[1].Sample(gSampleType, pin.tex);
-    float4 lightMapColor  = gTextures[10].Sample(gSampleType, pin.tex);
+    // the texture map is virtual (if the terrain has it) or a plain texture
+    float4 textureColor;
+
+    if (gVTEnabled)
+        textureColor = SampleVirtualTexture(pin.tex, pin.posH);
+    else
+        textureColor = gTextures[1].Sample(gSampleType, pin.tex);
+
+    float4 lightMapColor  = gTextures[10].Sample(gSampleType, pin.tex).rrra;    // a gray/BC4 lightmap has only R
     float4 detailMapColor = gTextures[16].Sample(gSampleType, pin.tex * detalizationLvl);
 
     // posW.y / 255 * 10: height based lighting
@@ -124,8 +185,8 @@ float4 PS(PS_IN pin) : SV_Target
 
     if (gFogEnabled)
     {
-        // blend sky texture pixel with fixed fog color
-        float4 fogColor = skyTexColor * float4(gFixedFogColor, 1.0f);
+        // blend sky pixel color (by the LUT) with fixed fog color
+        float4 fogColor = float4(GetSkyFogColor(gSampleSky, -toEyeW) * gFixedFogColor, 1.0f);
 
         float fogLerp = saturate((distToEye - gFogStart) / gFogRange);
 
@@ -163,6 +224,9 @@ float4 PS(PS_IN pin) : SV_Target
     // sum the light contribution from each light source (ambient, diffuse, specular)
     float4 A, D, S;
 
+    // only the sun (the first directional light) casts shadows
+    const float shadow = ComputeShadowFactor(pin.posW, pin.posH.w);
+
     // sum the light contribution from each directional light source
     for (int i = 0; i < gNumOfDirLights; ++i)
     {
@@ -174,18 +238,28 @@ float4 PS(PS_IN pin) : SV_Target
             0.0f,             // specular map value
             A, D, S);
 
+        const float lit = (i == 0) ? shadow : 1.0f;
+
         ambient += A;
-        diffuse += D;
-        spec += S;
+        diffuse += D * lit;
+        spec += S * lit;
     }
 
 
-    // sum the light contribution from each point light source
-    for (i = 0; i < gCurrNumPointLights; ++i)
+    // get lights which reach the cluster of this pixel
+    const ClusterLights cl = GetClusterLights(
+        pin.posH,
+        gClusterDims,
+        gClusterScaleXY,
+        gClusterSliceScale,
+        gClusterSliceBias);
+
+    // sum the light contribution from each point light source of the cluster
+    for (uint p = 0; p < cl.numPoint; ++p)
     {
         ComputePointLight(
             mat,
-            gPointLights[i],
+            gPointLights[gLightIdxs[cl.offset + p]],
             pin.posW,
             bumpedNormalW,
             toEyeW,
@@ -216,12 +290,12 @@ float4 PS(PS_IN pin) : SV_Target
     }
 
 
-    // sum the light contribution from each spot light source
-    for (i = 1; i < gCurrNumSpotLights; ++i)
+    // sum the light contribution from each spot light source of the cluster
+    for (uint s = 0; s < cl.numSpot; ++s)
     {
         ComputeSpotLight(
             mat,
-            gSpotLights[i],
+            gSpotLights[gLightIdxs[cl.offset + cl.numPoint + s]],
             pin.posW,
             bumpedNormalW, //bumpedNormalW, // pin.normalW,
             toEyeW,
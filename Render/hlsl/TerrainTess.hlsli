@@ -0,0 +1,41 @@
+// *********************************************************************************
+// Filename:    TerrainTess.hlsli
+// Description: common stuff of the tessellated terrain: the constant buffer
+//              (is bound to both the hull and domain shaders) and control points
+//
+//              NOTE: the layout must be the same as of ConstBufType::cbTerrainTess
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbTerrainTess : register(b0)
+{
+	matrix gViewProj;
+	float4 gFrustumPlanes[6];       // world frustum planes (normals look inside)
+	float3 gEyePosW;
+	float  gScreenScale;            // world size * gScreenScale / w => size in pixels
+	float  gTargetEdgePixels;       // desired screen-space length of a tessellated edge
+	float  gMaxTessFactor;
+	float  gHeightScale;            // a sample of the height map [0,1] => height in world
+	float  gTexelSize;              // 1 / size of the height map (a texel is 1 unit in world)
+};
+
+
+//
+// TYPEDEFS
+//
+struct ControlPoint
+{
+	float3 posW    : POSITION;      // a corner of the patch (y is the height at the corner)
+	float2 boundsY : BOUNDS;        // min/max height of the whole patch (for culling)
+};
+
+struct PatchTess
+{
+	float edgeTess[4]   : SV_TessFactor;
+	float insideTess[2] : SV_InsideTessFactor;
+};
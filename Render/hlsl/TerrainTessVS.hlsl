@@ -0,0 +1,18 @@
+// *********************************************************************************
+// Filename:    TerrainTessVS.hlsl
+// Description: a vertex shader of the tessellated terrain: corners of the coarse
+//              patches are already in world space so they are just passed
+//              into the hull shader
+//
+// Created:     14.10.26
+// *********************************************************************************
+#include "TerrainTess.hlsli"
+
+
+//
+// VERTEX SHADER
+//
+ControlPoint VS(ControlPoint vin)
+{
+	return vin;
+}
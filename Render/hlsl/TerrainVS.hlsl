@@ -1,3 +1,4 @@
+#include "PackedVertex.hlsli"
 
 //
 // CONSTANT BUFFERS
@@ -15,8 +16,8 @@ struct VS_IN
     // data per vertex
     float3   posL       : POSITION;     // vertex position in local space
     float2   tex        : TEXCOORD;
-    float3   normalL    : NORMAL;       // vertex normal in local space
-    float3   tangentL   : TANGENT;      // tangent in local space
+    float3   normalL    : NORMAL;       // vertex normal in local space (packed)
+    float3   tangentL   : TANGENT;      // tangent in local space (packed)
     float4   color      : COLOR;
 };
 
@@ -47,10 +48,10 @@ VS_OUT VS(VS_IN vin)
     vout.posH = mul(float4(vout.posW, 1.0f), gViewProj);
 
     // interpolating normal can unnormalize it, so normalize it
-    vout.normalW = vin.normalL;// normalize(mul(vin.normalL, (float3x3)vin.worldInvTranspose));
+    vout.normalW = UnpackUnitVector(vin.normalL);// normalize(mul(vin.normalL, (float3x3)vin.worldInvTranspose));
 
     // calculate the tangent and normalize it
-    vout.tangentW = vin.tangentL; // normalize(mul(vin.tangentL, (float3x3)vin.worldInvTranspose));
+    vout.tangentW = UnpackUnitVector(vin.tangentL); // normalize(mul(vin.tangentL, (float3x3)vin.worldInvTranspose));
 
     // output vertex texture attributes for interpolation across triangle
     vout.tex = vin.tex; // mul(float4(vin.tex, 0.0f, 1.0f), vin.texTransform).xy;
@@ -0,0 +1,45 @@
+// *********************************************************************************
+// Filename:    TexTransformHelper.hlsli
+// Description: computation of texture coords by the per-instance texture transformation;
+//              it is either a usual affine 2x3 matrix (uv' = rows * (u, v, 1)) or
+//              packed params of a texture animation which is evaluated here by
+//              the game time (the packing is made by the ECS::TextureTransformSystem,
+//              the 2x3 is packed by ConstBufType::PackInstance)
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+// tags of packed animations (are stored in texTransform[0].w, it is 0 for a usual matrix)
+// NOTE: must be the same as in the ECS::TextureTransformSystem
+#define TEX_ANIM_ATLAS     1.0f
+#define TEX_ANIM_ROTATION  2.0f
+
+
+float2 ComputeTexCoords(float2 tex, float2x4 texTransform, float gameTime)
+{
+    const float4 p0 = texTransform[0];
+    const float4 p1 = texTransform[1];
+
+    // atlas animation: p0 = { cell_width, cell_height, columns, tag }
+    //                  p1 = { frame_duration, frames_count, 0, 0 }
+    if (p0.w == TEX_ANIM_ATLAS)
+    {
+        const uint frame = (uint)(gameTime / p1.x) % (uint)p1.y;
+        const uint col   = frame % (uint)p0.z;
+        const uint row   = frame / (uint)p0.z;
+
+        return (tex + float2(col, row)) * p0.xy;
+    }
+
+    // rotation around tex coord: p0 = { center_u, center_v, speed, tag }
+    if (p0.w == TEX_ANIM_ROTATION)
+    {
+        float s, c;
+        sincos(p0.z * gameTime, s, c);
+
+        const float2 d = tex - p0.xy;
+        return float2(d.x*c - d.y*s, d.x*s + d.y*c) + p0.xy;
+    }
+
+    return mul(texTransform, float4(tex, 1.0f, 0.0f));
+}
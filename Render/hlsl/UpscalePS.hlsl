@@ -0,0 +1,47 @@
+// *********************************************************************************
+// Filename:    UpscalePS.hlsl
+// Description: a pixel shader to stretch the rendered (top-left) part of the
+//              scene texture to the whole back buffer by bilinear filtering
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+// ==========================
+// GLOBALS
+// ==========================
+Texture2D    gScene        : register(t0);
+SamplerState gSampleType   : register(s0);
+
+
+// ==========================
+// CONSTANT BUFFERS
+// ==========================
+cbuffer cbUpscale : register(b12)
+{
+	float2 gUvScale;             // the rendered part of the scene texture
+	float2 gUvMax;               // the center of the last rendered texel
+	float2 gTexelSize;           // 1 / size of the scene texture (is used by FXAA)
+	float2 gPadding;
+};
+
+
+// ==========================
+// TYPEDEFS
+// ==========================
+struct PS_IN
+{
+	float4 posH : SV_POSITION;
+	float2 tex  : TEXCOORD;
+};
+
+
+// ==========================
+// PIXEL SHADER
+// ==========================
+float4 PS(PS_IN pin) : SV_Target
+{
+	const float2 uv = min(pin.tex * gUvScale, gUvMax);
+
+	return float4(gScene.Sample(gSampleType, uv).rgb, 1.0f);
+}
@@ -0,0 +1,33 @@
+// *********************************************************************************
+// Filename:    UpscaleVS.hlsl
+// Description: a vertex shader of a fullscreen triangle (without any vertex
+//              buffer: the vertices are generated by SV_VertexID)
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// TYPEDEFS
+//
+struct VS_OUT
+{
+	float4 posH : SV_POSITION;
+	float2 tex  : TEXCOORD;
+};
+
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(uint vertexID : SV_VertexID)
+{
+	// (0, 0), (2, 0), (0, 2) in texture space cover the whole screen
+	const float2 tex = float2((vertexID << 1) & 2, vertexID & 2);
+
+	VS_OUT vout;
+	vout.posH = float4(tex.x * 2.0f - 1.0f, 1.0f - tex.y * 2.0f, 0.0f, 1.0f);
+	vout.tex  = tex;
+
+	return vout;
+}
@@ -0,0 +1,72 @@
+// *********************************************************************************
+// Filename:    VirtualTexture.hlsli
+// Description: sampling of a virtual texture (the terrain texture map): the mip
+//              is chosen by derivatives of the virtual texel coords, the page of
+//              this mip is requested through the feedback buffer, and its entry
+//              of the indirection says where in the page cache is the page (or
+//              its closest resident ancestor)
+//
+//              NOTE: slots must be the same as in the Render::VirtualTexture
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+Texture2D<float4>        gVTCache       : register(t32);    // slots of pages with borders
+Texture2D<uint4>         gVTIndirection : register(t33);    // per page of each mip: (slot x, slot y, resident mip)
+SamplerState             gVTSampler     : register(s5);     // linear clamp
+RWStructuredBuffer<uint> gVTFeedback    : register(u1);     // per page of each mip: the stamp of the last request
+
+cbuffer cbVirtualTexture : register(b13)
+{
+    float gVTVirtualSize;          // texels per side at mip 0
+    float gVTPageSize;             // texels per side of a page (without borders)
+    float gVTBorder;               // texels on each side of a page in the cache
+    float gVTCacheSize;            // texels per side of the page cache
+    uint  gVTNumMips;
+    uint  gVTPagesPerSide;         // at mip 0
+    uint  gVTFrame;                // the stamp of requests of this frame
+    uint  gVTEnabled;              // 0 if the buffer isn't bound
+    uint4 gVTMipOffsets[4];        // the first feedback entry of each mip (16 mips)
+};
+
+//---------------------------------------------------------
+// Desc:   sample the virtual texture
+// Args:   - uv:   coords in the virtual texture [0,1]
+//         - posH: screen position of the pixel (is used to request pages
+//                 only by a quarter of pixels per frame)
+//---------------------------------------------------------
+float4 SampleVirtualTexture(float2 uv, float4 posH)
+{
+    uv = saturate(uv);
+
+    // the mip by the footprint of the pixel in texels of mip 0
+    const float2 texel   = uv * gVTVirtualSize;
+    const float2 dx      = ddx(texel);
+    const float2 dy      = ddy(texel);
+    const float  maxLen2 = max(dot(dx, dx), dot(dy, dy));
+    const uint   mip     = (uint)clamp(0.5f * log2(max(maxLen2, 1.0f)), 0.0f, (float)(gVTNumMips - 1));
+
+    const uint   pages   = gVTPagesPerSide >> mip;
+    const uint2  page    = min((uint2)(uv * pages), pages - 1);
+
+    // request the page: pixels take turns framewise (it is enough since
+    // resident pages aren't evicted till they aren't requested for a few frames)
+    const uint2 pixel = (uint2)posH.xy;
+
+    if (((pixel.x + pixel.y * 2 + gVTFrame) & 3) == 0)
+    {
+        const uint offset = gVTMipOffsets[mip >> 2][mip & 3];
+        gVTFeedback[offset + page.y * pages + page.x] = gVTFrame;
+    }
+
+    // where is the page (or its resident ancestor) in the cache
+    const uint4  entry        = gVTIndirection.Load(int3(page, mip));
+    const uint   residentMip  = max(entry.z, mip);
+    const uint2  residentPage = page >> (residentMip - mip);
+    const float2 local        = uv * (float)(gVTPagesPerSide >> residentMip) - (float2)residentPage;
+
+    const float  slotSize     = gVTPageSize + 2.0f * gVTBorder;
+    const float2 cacheTexel   = (float2)entry.xy * slotSize + gVTBorder + local * gVTPageSize;
+
+    return gVTCache.SampleLevel(gVTSampler, cacheTexel / gVTCacheSize, 0);
+}
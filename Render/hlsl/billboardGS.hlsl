@@ -31,7 +31,7 @@ struct GS_OUT
 	float3 posW    : POSITION;
 	float3 normalW : NORMAL;
 	float2 tex     : TEXCOORD;
-	uint   primID  : SV_PrimitiveID;
+	nointerpolation uint texIdx : TEX_IDX;     // a layer of the texture array
 };
 
 
@@ -91,7 +91,7 @@ void GS(
 		gout.posW = v[i].xyz;
 		gout.normalW = look;
 		gout.tex = gTexC[i];
-		gout.primID = primID;
+		gout.texIdx = primID % 4;
 		triStream.Append(gout);
 	}
 }
\ No newline at end of file
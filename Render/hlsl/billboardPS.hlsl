@@ -13,10 +13,8 @@ SamplerState gSampleType   : register(s0);
 // ==========================
 cbuffer cbPerFrame        : register(b0)
 {
-	// light sources data
+	// light sources data (point/spot lights are in structured buffers)
 	DirectionalLight  gDirLights[3];
-	PointLight        gPointLights[25];
-	SpotLight         gSpotLights[25];
 	float3            gEyePosW;                // eye position in world space  
 	int               gCurrNumPointLights;
 	int               gCurrNumSpotLights;
@@ -48,7 +46,7 @@ struct PS_INPUT
 	float3 posW   : POSITION;
 	float3 normalW : NORMAL;
 	float2 tex    : TEXCOORD;
-	uint   primID : SV_PrimitiveID;
+	nointerpolation uint texIdx : TEX_IDX;     // a layer of the texture array (is set by billboardGS or billboardPullVS)
 };
 
 
@@ -74,7 +72,7 @@ float4 PS(PS_INPUT pin) : SV_TARGET
 	//float4 texColor = float4(1, 1, 1, 1);
 
 	// sample texture
-	float3 uvw = float3(pin.tex, pin.primID % 4);
+	float3 uvw = float3(pin.tex, pin.texIdx);
 	float4 texColor = gTreeMapArray.Sample(gSampleType, uvw);
 
 	if (gAlphaClipping)
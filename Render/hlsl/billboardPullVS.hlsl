@@ -0,0 +1,80 @@
+// *********************************************************************************
+// Filename:    billboardPullVS.hlsl
+// Description: a vertex shader which expands billboards without a geometry shader:
+//              a 4-vertex quad (triangle strip) is drawn instanced and each vertex
+//              fetches its billboard from a structured buffer by SV_InstanceID;
+//              the output is the same as of billboardGS (is used by billboardPS)
+//
+// Created:     14.10.26
+// *********************************************************************************
+
+
+//
+// CONSTANT BUFFERS
+//
+cbuffer cbPerFrame : register(b3)
+{
+	matrix gViewProj;
+	float3 gEyePosW;                // eye position in world space
+};
+
+
+//
+// TYPEDEFS
+//
+struct Billboard
+{
+	// the same layout as ConstBufType::InstancedDataBillboards (96 bytes)
+	float4x4 material;
+	float3   posW;                  // billboard bottom center pos in a world space
+	float2   sizeW;                 // width and height of the billboard
+	float3   padding;
+};
+
+StructuredBuffer<Billboard> gBillboards : register(t10);
+
+struct VS_OUT
+{
+	float4 posH    : SV_POSITION;
+	float3 posW    : POSITION;
+	float3 normalW : NORMAL;
+	float2 tex     : TEXCOORD;
+	nointerpolation uint texIdx : TEX_IDX;
+};
+
+
+//
+// VERTEX SHADER
+//
+VS_OUT VS(uint vertexID : SV_VertexID, uint instanceID : SV_InstanceID)
+{
+	const Billboard billboard = gBillboards[instanceID];
+
+	// the same corners order as in billboardGS:
+	// 0: right-bottom, 1: right-top, 2: left-bottom, 3: left-top
+	const float2 corner = float2(
+		(vertexID & 2) ? -1.0f : 1.0f,
+		(vertexID & 1) ?  1.0f : -1.0f);
+
+	float3 centerW = billboard.posW;
+	centerW.y += (billboard.sizeW.y * 0.5f);
+
+	// y-axis aligned billboard which faces the eye
+	float3 up   = float3(0.0f, 1.0f, 0.0f);
+	float3 look = gEyePosW - centerW;
+
+	look.y = 0.0f;
+	look = normalize(look);
+
+	float3 right = cross(up, look);
+	float3 posW  = centerW + (0.5f * billboard.sizeW.x * corner.x) * right + (0.5f * billboard.sizeW.y * corner.y) * up;
+
+	VS_OUT vout;
+	vout.posH    = mul(float4(posW, 1.0f), gViewProj);
+	vout.posW    = posW;
+	vout.normalW = look;
+	vout.tex     = float2((vertexID >> 1) & 1, 1 - (vertexID & 1));
+	vout.texIdx  = instanceID % 4;
+
+	return vout;
+}
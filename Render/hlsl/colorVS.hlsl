@@ -19,10 +19,9 @@ cbuffer cbPerFrame : register(b0)
 struct VS_INPUT
 { 
 	// data per instance
-	row_major matrix   world             : WORLD;
-	row_major matrix   worldInvTranspose : WORLD_INV_TRANSPOSE;
-	row_major matrix   texTransform      : TEX_TRANSFORM;
-	row_major float4x4 material          : MATERIAL;
+	row_major float3x4 world             : WORLD;
+	row_major float2x4 texTransform      : TEX_TRANSFORM;
+	uint               materialIdx       : MATERIAL_IDX;
 	uint               instanceID        : SV_InstanceID;
 
 	float3 posL   : POSITION;       // position of the vertex in local space
@@ -45,7 +44,7 @@ VS_OUTPUT VS(VS_INPUT vin)
 	VS_OUTPUT vout;
 
 	// transform pos from local to world space
-	vout.posW = mul(float4(vin.posL, 1.0f), vin.world).xyz;
+	vout.posW = mul(vin.world, float4(vin.posL, 1.0f));
 
 	// transform to homogeneous clip space
 	vout.posH = mul(float4(vout.posW, 1.0f), gViewProj);
@@ -13,10 +13,8 @@ SamplerState gSampleType   : register(s0);
 //////////////////////////////////
 cbuffer cbPerFrame        : register(b0)
 {
-	// light sources data
+	// light sources data (point/spot lights are in structured buffers)
 	DirectionalLight  gDirLights[3];
-	PointLight        gPointLights[25];
-	SpotLight         gSpotLights[25];
 	float3            gEyePosW;                // eye position in world space  
 	int               gCurrNumPointLights;
 	int               gCurrNumSpotLights;
@@ -5,6 +5,11 @@
 // =================================================================================
 #include "pch.h"
 #include "Application.h"
+#include <AssetPack.h>
+#include <InitGraph.h>
+#include <JobSystem.h>
+#include <StartupTimeline.h>
+#include <CVars.h>
 
 
 namespace Game
@@ -25,12 +30,17 @@ Application::~Application()
 
 void Application::Initialize()
 {
-    // compute duration of importing process
-    auto initStartTime = std::chrono::steady_clock::now();
+    // measure each phase of the startup (the breakdown is logged at the end)
+    g_CpuProfiler.SetThreadName("main");
+    g_StartupTimeline.Begin();
 
     // ATTENTION: put the declation of logger before all the others; this instance is necessary to create a logger text file
     InitLogger("DoorsEngineLog.txt");
 
+    // the seed of random values is fixed before the scene is created
+    if (isBenchmark_)
+        benchmark_.Initialize(benchmarkParams_);
+
     // explicitly init Windows Runtime and COM
     HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
     if (FAILED(hr))
@@ -39,41 +49,256 @@ void Application::Initialize()
         exit(-1);
     }
 
+    // pack loose files before anything is loaded so this run already uses the packs
+    if (settings_.GetBool("ASSET_PACKS_BUILD"))
+    {
+        STARTUP_PHASE("asset packs: build");
+        BuildAssetPacks();
+    }
+
+    // workers are started before the engine so they can execute init tasks
+    {
+        STARTUP_PHASE("job system");
+        g_JobSystem.Initialize();
+    }
+
     eventHandler_.AddEventListener(&engine_);         // set engine class as one of the window events listeners
     wndContainer_.SetEventHandler(&eventHandler_);    // set an event handler for the window container
 
-    InitWindow();
-    InitEngine();
+    // the scene initializer keeps data which is passed btw its steps
+    SceneInitializer sceneInit;
+    ID3D11Device*    pDevice = nullptr;
 
-    Core::D3DClass& d3d   = engine_.GetGraphicsClass().GetD3DClass();
-    ID3D11Device* pDevice = d3d.GetDevice();
+    if (isBenchmark_)
+        sceneInit.SetTerrainSize(benchmarkParams_.terrainSize);
 
-    InitScene(pDevice, settings_);
-    InitRenderModule(pDevice, settings_, &render_);
+    // build a dependency graph of the initialization:
+    // shaders and the terrain generation are jobs which go in parallel with
+    // the scene init on the main thread (textures are already loaded asynchronously);
+    // the window, the immediate context and the managers stay on the main thread
+    InitGraph graph;
 
-    // create a facade btw the UI and the engine parts
-    pFacadeEngineToUI_ = new UI::FacadeEngineToUI(
-        d3d.GetDeviceContext(),
-        &render_,
-        &entityMgr_,
-        &engine_.GetGraphicsClass());
+    const int window = graph.AddTask("window", INIT_TASK_MAIN_THREAD, [this]()
+    {
+        // the engine is initialized without a window in the headless mode
+        if (isBenchmark_ && benchmarkParams_.isHeadless)
+            return true;
 
-    // initialize the main UserInterface class
-    InitGUI(pDevice, d3d.GetWindowWidth(), d3d.GetWindowHeight());
+        return InitWindow();
+    });
+
+    const int terrainGen = graph.AddTask("terrain: generate", INIT_TASK_ANY_THREAD, [&sceneInit]()
+    {
+        return sceneInit.GenerateTerrain();
+    });
+
+    // entities are bulk-loaded from the scene file (saved by the editor) if there is
+    // such a file; otherwise they are created by the code of the scene initializer
+    const int sceneFile = graph.AddTask("scene: load file", INIT_TASK_MAIN_THREAD, [this, &sceneInit]()
+    {
+        if (!settings_.GetBool("SCENE_LOAD_FROM_FILE"))
+            return true;
+
+        // the scene file is loaded only if there is no scene directory (saved by a newer editor)
+        const char* path = (ECS::WorldFileReader::IsWorldDir(g_RelPathSceneDir)) ? g_RelPathSceneDir : g_RelPathSceneFile;
+
+        return sceneInit.LoadScene(entityMgr_, path);
+    });
+
+    const int engine = graph.AddTask("engine: D3D device", INIT_TASK_MAIN_THREAD, [this, &pDevice]()
+    {
+        if (!InitEngine())
+            return false;
+
+        pDevice = engine_.GetGraphicsClass().GetD3DClass().GetDevice();
+        return true;
+    }, { window });
+
+    const int shaders = graph.AddTask("render: shaders", INIT_TASK_ANY_THREAD, [this, &pDevice]()
+    {
+        // NOTE: the WVO matrix is updated by the renderer initialization
+        Render::InitParams renderParams;
+        SetupRenderParams(settings_, renderParams);
 
-    auto initEndTime = std::chrono::steady_clock::now();
-    std::chrono::duration<float, std::milli> initDuration = initEndTime - initStartTime;
+        return render_.LoadShaders(pDevice, renderParams);
+    }, { engine });
+
+    const int sceneBase = graph.AddTask("scene: textures and primitives", INIT_TASK_MAIN_THREAD, [this, &sceneInit, &pDevice]()
+    {
+        // evaluate atlas/rotation texture animations in the vertex shader
+        entityMgr_.texTransformSystem_.SetGpuTexAnimations(settings_.GetBool("GPU_TEX_ANIMATIONS"));
+
+        return sceneInit.InitBaseAssets(pDevice, entityMgr_);
+    }, { engine, sceneFile });
+
+    const int sceneTerrain = graph.AddTask("scene: terrain", INIT_TASK_MAIN_THREAD, [this, &sceneInit, &pDevice]()
+    {
+        return sceneInit.InitTerrain(pDevice, entityMgr_);
+    }, { sceneBase, terrainGen });
+
+    const int sceneModels = graph.AddTask("scene: models", INIT_TASK_MAIN_THREAD, [this, &sceneInit, &pDevice]()
+    {
+        return sceneInit.InitModels(pDevice, entityMgr_);
+    }, { sceneTerrain });
+
+    const int sceneEntities = graph.AddTask("scene: entities", INIT_TASK_MAIN_THREAD, [this, &sceneInit, &pDevice]()
+    {
+        return InitScene(pDevice, settings_, sceneInit);
+    }, { sceneModels });
+
+    // the stress scene of the benchmark is added over the usual one
+    const int sceneBenchmark = graph.AddTask("scene: benchmark", INIT_TASK_MAIN_THREAD, [this]()
+    {
+        return (benchmark_.IsActive()) ? benchmark_.CreateStressScene(entityMgr_) : true;
+    }, { sceneEntities });
+
+    graph.AddTask("assets hot reload", INIT_TASK_MAIN_THREAD, [this, &sceneInit, &pDevice]()
+    {
+        Core::AssetHotReloader& reloader = engine_.GetAssetHotReloader();
+
+        if (reloader.IsInitialized())
+            sceneInit.AddHotReloadNodes(pDevice, reloader, settings_.GetBool("TERRAIN_STREAMING"));
+
+        return true;
+    }, { sceneEntities });
+
+    const int render = graph.AddTask("render module", INIT_TASK_MAIN_THREAD, [this, &pDevice]()
+    {
+        if (!InitRenderModule(pDevice, settings_, &render_))
+            return false;
+
+        // bind render states through the state cache of the render module
+        engine_.GetGraphicsClass().GetD3DClass().GetRenderStates().SetStateCache(&render_.GetStateCache());
+        return true;
+    }, { shaders, sceneBenchmark });
+
+    graph.AddTask("impostors", INIT_TASK_MAIN_THREAD, [this]()
+    {
+        // far trees are rendered by impostors (their last LOD)
+        BakeImpostors();
+        return true;
+    }, { render });
+
+    const int staticMerging = graph.AddTask("static props merging", INIT_TASK_MAIN_THREAD, [this]()
+    {
+        // small static props are rendered by merged meshes per grid cell
+        if (settings_.GetBool("MERGE_STATIC_PROPS"))
+            engine_.GetGraphicsClass().MergeStaticProps(&entityMgr_);
+
+        return true;
+    }, { render });
+
+    graph.AddTask("static lights", INIT_TASK_MAIN_THREAD, [this]()
+    {
+        // static lights are lit by the baked volume (merged cells cast shadows as well)
+        if (settings_.GetBool("BAKED_STATIC_LIGHTS"))
+            engine_.GetGraphicsClass().LoadStaticLights(&entityMgr_, &render_);
+
+        return true;
+    }, { staticMerging });
+
+    graph.AddTask("gui", INIT_TASK_MAIN_THREAD, [this, &pDevice]()
+    {
+        Core::D3DClass& d3d = engine_.GetGraphicsClass().GetD3DClass();
+
+        // create a facade btw the UI and the engine parts
+        pFacadeEngineToUI_ = new UI::FacadeEngineToUI(
+            d3d.GetDeviceContext(),
+            &render_,
+            &entityMgr_,
+            &engine_.GetGraphicsClass());
+
+        // initialize the main UserInterface class
+        return InitGUI(pDevice, d3d.GetWindowWidth(), d3d.GetWindowHeight());
+    }, { render });
+
+    if (!graph.Run())
+        LogErr("some steps of the initialization failed (see the log above)");
+
+    // log the breakdown of the startup (and dump its trace if necessary)
+    const char* tracePath = (settings_.GetBool("STARTUP_TRACE")) ? "startup_trace.json" : nullptr;
+    const float initTime  = g_StartupTimeline.End(tracePath);
 
     // create a str with duration time about the engine initialization process
     char initTimeBuf[256]{ '\0' };
     const POINT drawAt = { 10, 350 };
 
-    sprintf(initTimeBuf, "Init time: %d ms", (int)initDuration.count());
-    userInterface_.CreateConstStr(pDevice, initTimeBuf, drawAt);
+    sprintf(initTimeBuf, "Init time: %d ms", (int)initTime);
+
+    if (pDevice)
+        userInterface_.CreateConstStr(pDevice, initTimeBuf, drawAt);
+
+    // the session is recorded (or the recorded one is replayed) since the first frame
+    if (inputReplayMode_ == INPUT_REPLAY_RECORD)
+        engine_.StartInputRecording(inputReplayPath_);
+
+    else if (inputReplayMode_ == INPUT_REPLAY_PLAY)
+        engine_.StartInputReplay(inputReplayPath_, inputReplayTracePath_);
+}
+
+///////////////////////////////////////////////////////////
+
+void Application::BakeImpostors()
+{
+    // bake impostor atlases of models which are rendered far away in large numbers
+
+    Core::CGraphics& graphics = engine_.GetGraphicsClass();
+    const char* modelsNames[] = { "tree_spruce", "tree_pine" };
+
+    for (const char* name : modelsNames)
+    {
+        const ModelID modelID = g_ModelMgr.GetModelIdByName(name);
+
+        if (modelID != INVALID_MODEL_ID)
+            graphics.BakeImpostor(modelID, &render_);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void Application::BuildAssetPacks()
+{
+    // pack each content set into its own archive (data/packs/*.dpak);
+    // NOTE: settings.txt stays loose so this flag can be switched off again;
+    // already compressed formats (.dds with BC data, .png, .jpg) are stored
+    // as is since LZ4 doesn't make them smaller enough
+
+    struct ContentSet
+    {
+        const char* packName;
+        const char* srcPaths[4];
+        int         numSrcPaths;
+    };
+
+    const ContentSet contentSets[] =
+    {
+        { "config.dpak",   { "data/sky_config.txt" },                      1 },
+        { "shaders.dpak",  { "shaders/" },                                 1 },
+        { "models.dpak",   { g_RelPathAssetsDir },                         1 },
+        { "textures.dpak", { g_RelPathTexDir, "data/cooked/" },            2 },
+        { "terrain.dpak",  { "data/terrain/" },                            1 },
+    };
+
+    // packs can't be replaced while they are mapped
+    FileSys::UnmountPacks();
 
-    LogMsgf("%s---------------------------------------------\n", GREEN);
-    LogMsg(initTimeBuf);
-    LogMsgf("%s---------------------------------------------\n", GREEN);
+    AssetPackBuildParams params;
+    AssetPackBuildStats  stats;
+    char                 packPath[256]{ '\0' };
+
+    for (const ContentSet& set : contentSets)
+    {
+        snprintf(packPath, sizeof(packPath), "%s%s", g_RelPathPacksDir, set.packName);
+        AssetPack::Build(packPath, set.srcPaths, set.numSrcPaths, params, stats);
+    }
+
+    FileSys::MountPacksDir(g_RelPathPacksDir);
+
+    LogMsgf("asset packs: %u files (%u compressed); %llu KB => %llu KB",
+        stats.numFiles,
+        stats.numPacked,
+        (unsigned long long)(stats.srcBytes >> 10),
+        (unsigned long long)(stats.packBytes >> 10));
 }
 
 ///////////////////////////////////////////////////////////
@@ -127,8 +352,13 @@ bool Application::InitEngine()
 
 ///////////////////////////////////////////////////////////
 
-bool Application::InitScene(ID3D11Device* pDevice, const Settings& settings)
+bool Application::InitScene(
+    ID3D11Device* pDevice,
+    const Settings& settings,
+    SceneInitializer& sceneInit)
 {
+    // create light sources, cameras and the player; the rest of the scene
+    // (assets, the terrain, models) must be already initialized by sceneInit
     const Core::D3DClass& d3d = engine_.GetGraphicsClass().GetD3DClass();
     const SIZE windowedSize   = d3d.GetWindowedWndSize();
     const SIZE fullscreenSize = d3d.GetFullscreenWndSize();
@@ -147,10 +377,7 @@ bool Application::InitScene(ID3D11Device* pDevice, const Settings& settings)
     gameCamParams.wndHeight     = (float)fullscreenSize.cy;
     gameCamParams.aspectRatio   = editorCamParams.wndWidth / editorCamParams.wndHeight;
 
-
-    SceneInitializer sceneInitializer;
-
-    bool result = sceneInitializer.Initialize(
+    bool result = sceneInit.InitEntities(
         pDevice,
         entityMgr_,
         editorCamParams,
@@ -158,6 +385,7 @@ bool Application::InitScene(ID3D11Device* pDevice, const Settings& settings)
     if (!result)
     {
         LogErr("can't initialize the scene's some stuff");
+        return false;
     }
 
 
@@ -175,6 +403,24 @@ bool Application::InitScene(ID3D11Device* pDevice, const Settings& settings)
     const float fullFogDistance = fogStart + fogRange;
     graphics.SetFullFogDist((int)fullFogDistance);
 
+    // runtime knobs of the scene (see CVarRegistry)
+    g_CVars.RegisterInt("FULL_FOG_DISTANCE", (int)fullFogDistance, 1, 100000, "entts further than it are fully fogged",
+        [this](const CVar& var) { engine_.GetGraphicsClass().SetFullFogDist(var.GetInt()); });
+
+    g_CVars.RegisterFloat("FAR_Z", editorCamParams.farZ, 1.0f, 100000.0f, "the far plane of the editor and game cameras",
+        [this](const CVar& var)
+        {
+            ECS::CameraSystem& camSys = entityMgr_.cameraSystem_;
+
+            for (const char* name : { "editor_camera", "game_camera" })
+            {
+                const EntityID id = entityMgr_.nameSystem_.GetIdByName(name);
+
+                if (camSys.HasEntity(id))
+                    camSys.SetupProjection(id, camSys.GetFovY(id), camSys.GetAspect(id), camSys.GetNearZ(id), var.GetFloat());
+            }
+        });
+
     return true;
 }
 
@@ -196,18 +442,9 @@ bool Application::InitRenderModule(
     const DirectX::XMMATRIX  WVO      = baseView * ortho;
 
     Render::InitParams renderParams;
+    SetupRenderParams(settings, renderParams);
     renderParams.worldViewOrtho       = DirectX::XMMatrixTranspose(WVO);
 
-    // zaporizha sky box horizon (darker by 0.1f)
-    renderParams.fogColor =
-    {
-        settings.GetFloat("FOG_RED"),
-        settings.GetFloat("FOG_GREEN"),
-        settings.GetFloat("FOG_BLUE"),
-    };
-    renderParams.fogStart = settings.GetFloat("FOG_START");
-    renderParams.fogRange = settings.GetFloat("FOG_RANGE");
-
     const DirectX::XMFLOAT3 skyColorCenter = g_ModelMgr.GetSky().GetColorCenter();
     const DirectX::XMFLOAT3 skyColorApex   = g_ModelMgr.GetSky().GetColorApex();
 
@@ -235,6 +472,42 @@ bool Application::InitRenderModule(
 
 ///////////////////////////////////////////////////////////
 
+void Application::SetupRenderParams(const Settings& settings, Render::InitParams& outParams)
+{
+    // render params which depend only on settings (can be called by any thread)
+
+    // zaporizha sky box horizon (darker by 0.1f)
+    outParams.fogColor =
+    {
+        settings.GetFloat("FOG_RED"),
+        settings.GetFloat("FOG_GREEN"),
+        settings.GetFloat("FOG_BLUE"),
+    };
+    outParams.fogStart = settings.GetFloat("FOG_START");
+    outParams.fogRange = settings.GetFloat("FOG_RANGE");
+    outParams.numDeferredContexts = settings.GetInt("DEFERRED_CONTEXTS");
+    outParams.billboardVertexPulling = settings.GetBool("BILLBOARD_VERTEX_PULLING");
+    outParams.maxParticles = (UINT)settings.GetInt("GPU_PARTICLES_MAX");
+
+    outParams.maxGrassInstances        = (UINT)settings.GetInt("GRASS_MAX_INSTANCES");
+    outParams.grassParams.density      = settings.GetFloat("GRASS_DENSITY");
+    outParams.grassParams.maxDistance  = settings.GetFloat("GRASS_DISTANCE");
+    outParams.grassParams.fadeStart    = 0.6f * outParams.grassParams.maxDistance;
+    outParams.grassParams.maxSlope     = settings.GetFloat("GRASS_MAX_SLOPE");
+    outParams.grassParams.bladeHeight  = settings.GetFloat("GRASS_BLADE_HEIGHT");
+
+    outParams.maxSkinnedInstances      = (UINT)settings.GetInt("SKINNED_MAX_INSTANCES");
+
+    outParams.editorGridParams.fadeDistance = settings.GetFloat("EDITOR_GRID_DIMENSION");
+    outParams.editorGridParams.cellSize     = settings.GetFloat("EDITOR_GRID_CELL_DIMENSION");
+
+    outParams.shadowParams.numCascades = settings.GetInt("SHADOW_CASCADES");
+    outParams.shadowParams.mapSize     = (UINT)settings.GetInt("SHADOW_MAP_SIZE");
+    outParams.shadowParams.distance    = settings.GetFloat("SHADOW_DISTANCE");
+}
+
+///////////////////////////////////////////////////////////
+
 bool Application::InitGUI(
     ID3D11Device* pDevice,
     const int wndWidth,
@@ -288,13 +561,37 @@ bool Application::InitGUI(
 
 void Application::Run()
 {
+    // the audit doesn't need any frame: the scene is already initialized
+    if (isAudit_)
+    {
+        RunContentAudit();
+        return;
+    }
+
     // run the engine
-    while (wndContainer_.renderWindow_.ProcessMessages(hInstance_, mainHWND_) == true)
+    while (true)
     {
+        // wait for the swap chain right before the input is sampled (by processing
+        // of window messages) for minimal latency of the game mode
+        if (!engine_.IsPaused())
+            engine_.WaitForNextFrame();
+
+        if (!engine_.IsHeadless() && !wndContainer_.renderWindow_.ProcessMessages(hInstance_, mainHWND_))
+            break;
+
         if (!engine_.IsPaused())
         {
+            // the benchmark moves the camera before the frame is updated
+            if (benchmark_.IsActive() && !UpdateBenchmark())
+                break;
+
             engine_.Update();
             engine_.RenderFrame();
+
+            // the frame cap (and low rates of the unfocused editor or the power-saving mode);
+            // the benchmark and the input replay aren't limited
+            if (!benchmark_.IsActive() && !engine_.IsInputReplaying())
+                engine_.LimitFrameRate();
         }
         else
         {
@@ -308,9 +605,78 @@ void Application::Run()
 
 ///////////////////////////////////////////////////////////
 
+void Application::EnableBenchmark(const BenchmarkParams& params)
+{
+    benchmarkParams_ = params;
+    isBenchmark_     = true;
+
+    if (params.isHeadless)
+        settings_.UpdateSettingByKey("HEADLESS_DEVICE", std::string(params.device));
+}
+
+///////////////////////////////////////////////////////////
+
+void Application::EnableInputReplay(const eInputReplayMode mode, const char* filePath, const char* tracePath)
+{
+    inputReplayMode_ = mode;
+    snprintf(inputReplayPath_,      sizeof(inputReplayPath_),      "%s", filePath);
+    snprintf(inputReplayTracePath_, sizeof(inputReplayTracePath_), "%s", tracePath);
+}
+
+///////////////////////////////////////////////////////////
+
+void Application::EnableContentAudit(const char* csvPath)
+{
+    snprintf(auditPath_, sizeof(auditPath_), "%s", csvPath);
+    isAudit_ = true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool Application::RunContentAudit()
+{
+    // the audit must see all the models of the scene (not their placeholders)
+    g_ModelMgr.FinishLoading();
+
+    ContentAuditor auditor;
+    AuditBudgets   budgets;
+
+    budgets.LoadFromSettings(settings_);
+    auditor.Run(entityMgr_, budgets);
+
+    isAuditFailed_ = (auditor.GetNumIssues() > 0) || !auditor.ExportCSV(auditPath_);
+    return !isAuditFailed_;
+}
+
+///////////////////////////////////////////////////////////
+
+bool Application::UpdateBenchmark()
+{
+    // move the current camera by the path and add the timings of the last frame;
+    // return false when the benchmark is finished (its results are written then)
+
+    const EntityID cameraID = engine_.GetGraphicsClass().GetCurrentCamera();
+    const float deltaTime   = engine_.GetTimer().GetDeltaTime();
+
+    if (benchmark_.Update(entityMgr_, cameraID, engine_.GetSystemState(), deltaTime))
+        return true;
+
+    // the render thread may still use the ECS
+    engine_.SyncRenderThread();
+    benchmark_.Finish();
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
 void Application::Close()
 {
-    wndContainer_.renderWindow_.UnregisterWindowClass(hInstance_);
+    // the recorded camera path is saved when the window is closed
+    benchmark_.Finish();
+
+    if (!engine_.IsHeadless())
+        wndContainer_.renderWindow_.UnregisterWindowClass(hInstance_);
+
     CloseLogger();
 }
 
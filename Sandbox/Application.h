@@ -8,10 +8,12 @@
 
 #include "Engine/Engine.h"
 #include "Engine/Settings.h"
+#include "Engine/ContentAuditor.h"
 #include <EngineException.h>
 #include <FileSystemPaths.h>
 
 #include "SceneInitializer.h"
+#include "Benchmark.h"
 
 // UI
 #include "../UI/UICommon/IFacadeEngineToUI.h"
@@ -34,11 +36,29 @@ public:
     void Run();
     void Close();
 
+    // run the benchmark instead of the usual session (must be called before Initialize())
+    void EnableBenchmark(const BenchmarkParams& params);
+
+    // record the session or replay a recorded one (must be called before Initialize())
+    void EnableInputReplay(const eInputReplayMode mode, const char* filePath, const char* tracePath);
+
+    // write the content audit into the CSV file and exit right after the initialization
+    // (must be called before Initialize())
+    void EnableContentAudit(const char* csvPath);
+
+    // nonzero if the benchmark is failed (or CPU timings have regressed) or any budget of the audit is exceeded
+    inline int GetExitCode() const { return (benchmark_.IsFailed() || isAuditFailed_) ? 1 : 0; }
+
     bool InitWindow();
     bool InitEngine();
-    bool InitScene(ID3D11Device* pDevice, const Settings& settings);
+    bool InitScene(ID3D11Device* pDevice, const Settings& settings, SceneInitializer& sceneInit);
     bool InitRenderModule(ID3D11Device* pDevice, const Core::Settings& settings, Render::CRender* pRender);
+    void SetupRenderParams(const Core::Settings& settings, Render::InitParams& outParams);
     bool InitGUI(ID3D11Device* pDevice, const int wndWidth, const int wndHeight);
+    void BakeImpostors();
+    void BuildAssetPacks();
+    bool UpdateBenchmark();
+    bool RunContentAudit();
 
 
 private:
@@ -51,11 +71,23 @@ private:
 
     UI::IFacadeEngineToUI* pFacadeEngineToUI_ = nullptr;  // a facade interface which are used by UI to contact with some engine's parts
 
-    HWND                  mainHWND_;
+    HWND                  mainHWND_ = NULL;
     Core::Settings        settings_;
     EventHandler          eventHandler_;
     Core::WindowContainer wndContainer_;
     bool                  startInGameMode_ = false;
+
+    Benchmark             benchmark_;
+    BenchmarkParams       benchmarkParams_;
+    bool                  isBenchmark_ = false;
+
+    eInputReplayMode      inputReplayMode_ = INPUT_REPLAY_NONE;
+    char                  inputReplayPath_[256]{ '\0' };
+    char                  inputReplayTracePath_[256]{ '\0' };
+
+    char                  auditPath_[256]{ '\0' };
+    bool                  isAudit_       = false;
+    bool                  isAuditFailed_ = false;
 };
 
 } // namespace Game
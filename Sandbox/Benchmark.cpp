@@ -0,0 +1,873 @@
+// =================================================================================
+// Filename:     Benchmark.cpp
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "pch.h"
+#include "Benchmark.h"
+#include "Entity/EntityMgr.h"
+#include "../Core/Terrain/Terrain.h"
+
+#include <Profiler.h>
+#include <algorithm>
+
+using namespace Core;
+using namespace DirectX;
+
+
+namespace Game
+{
+
+// CPU timings which are checked against the baseline
+static const char* s_CpuTimingNames[Benchmark::NUM_CPU_TIMINGS] =
+{
+    "culling",
+    "render_prep",
+    "ecs_update",
+    "instance_upload",
+    "terrain_tessellation",
+};
+
+// a timing is a sum of these profiler zones
+static const char* s_CpuZones[] =
+{
+    "FrustumCulling",
+    "OcclusionCulling",
+    "LightsCulling",
+    "PrepBasicInstances",
+    "PrepAlphaClippedInstances",
+    "PrepBlendedInstances",
+    "PrepImpostors",
+    "ComputeLods",
+    "EntityMgr::Update",
+    "UploadInstances",
+    "TerrainTessellation",
+};
+
+static const int s_CpuZoneTimings[] = { 0, 0, 0, 1, 1, 1, 1, 1, 2, 3, 4 };
+
+static_assert(ARRAYSIZE(s_CpuZones) == ARRAYSIZE(s_CpuZoneTimings), "each zone must have its timing");
+
+// small timings aren't regressed by the noise of measurement (ms)
+static constexpr float MIN_REGRESSION_MS = 0.02f;
+
+//---------------------------------------------------------
+// Desc:   get a value of the "key=value" argument
+// Ret:    a pointer to the value or nullptr if the argument has another key
+//---------------------------------------------------------
+static const char* GetArgValue(const char* arg, const char* key)
+{
+    const size_t len = strlen(key);
+
+    if (strncmp(arg, key, len) != 0 || arg[len] != '=')
+        return nullptr;
+
+    return arg + len + 1;
+}
+
+//---------------------------------------------------------
+// Desc:   create directories of the file's path (if there are no such)
+//---------------------------------------------------------
+static void CreateParentDirs(const char* filePath)
+{
+    const std::filesystem::path dir = std::filesystem::path(filePath).parent_path();
+    std::error_code err;
+
+    if (!dir.empty())
+        std::filesystem::create_directories(dir, err);
+}
+
+//---------------------------------------------------------
+// Desc:   a value of the sorted array at the percentile (0..100)
+//---------------------------------------------------------
+static float GetPercentile(const cvector<float>& sorted, const int percentile)
+{
+    if (sorted.empty())
+        return 0.0f;
+
+    return sorted[(sorted.size() - 1) * percentile / 100];
+}
+
+//---------------------------------------------------------
+// Desc:   a Catmull-Rom spline through p1..p2 (p0, p3 are neighbour keys)
+//---------------------------------------------------------
+static XMVECTOR CatmullRom(
+    const XMFLOAT3& p0,
+    const XMFLOAT3& p1,
+    const XMFLOAT3& p2,
+    const XMFLOAT3& p3,
+    const float t)
+{
+    return XMVectorCatmullRom(
+        XMLoadFloat3(&p0),
+        XMLoadFloat3(&p1),
+        XMLoadFloat3(&p2),
+        XMLoadFloat3(&p3),
+        t);
+}
+
+///////////////////////////////////////////////////////////
+
+bool Benchmark::ParseCmdLine(const int argc, char* argv[], BenchmarkParams& outParams)
+{
+    bool isBenchmark = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = nullptr;
+
+        if (strcmp(arg, "--benchmark") == 0)
+        {
+            isBenchmark = true;
+        }
+        else if (strcmp(arg, "--benchmark-record") == 0)
+        {
+            isBenchmark = true;
+            outParams.isRecording = true;
+        }
+        else if (strcmp(arg, "--headless") == 0)
+            outParams.isHeadless = true;
+
+        else if (strcmp(arg, "--update-baseline") == 0)
+            outParams.isUpdateBaseline = true;
+
+        else if ((value = GetArgValue(arg, "frames")))
+            outParams.numFrames = std::max(0, atoi(value));
+
+        else if ((value = GetArgValue(arg, "threshold")))
+            outParams.threshold = std::max(0.0f, (float)atof(value));
+
+        else if ((value = GetArgValue(arg, "baseline")))
+            strncpy(outParams.pathBaseline, value, sizeof(outParams.pathBaseline) - 1);
+
+        else if ((value = GetArgValue(arg, "device")))
+            strncpy(outParams.device, value, sizeof(outParams.device) - 1);
+
+        else if ((value = GetArgValue(arg, "entts")))
+            outParams.numEntts = std::max(0, atoi(value));
+
+        else if ((value = GetArgValue(arg, "lights")))
+            outParams.numLights = std::max(0, atoi(value));
+
+        else if ((value = GetArgValue(arg, "terrain")))
+            outParams.terrainSize = std::max(0, atoi(value));
+
+        else if ((value = GetArgValue(arg, "duration")))
+            outParams.duration = std::max(1.0f, (float)atof(value));
+
+        else if ((value = GetArgValue(arg, "warmup")))
+            outParams.warmup = std::max(0.0f, (float)atof(value));
+
+        else if ((value = GetArgValue(arg, "seed")))
+            outParams.seed = (uint)strtoul(value, nullptr, 10);
+
+        else if ((value = GetArgValue(arg, "path")))
+            strncpy(outParams.pathCamera, value, sizeof(outParams.pathCamera) - 1);
+
+        else if ((value = GetArgValue(arg, "out")))
+            strncpy(outParams.pathOutput, value, sizeof(outParams.pathOutput) - 1);
+
+        else if ((value = GetArgValue(arg, "tag")))
+            strncpy(outParams.tag, value, sizeof(outParams.tag) - 1);
+
+        else
+        {
+            sprintf(g_String, "unknown command line argument: %s", arg);
+            LogErr(g_String);
+        }
+    }
+
+    // the terrain is generated by the geomipmapping so its size must be 2^n+1
+    const int size = outParams.terrainSize;
+
+    if (size && ((size - 1) & (size - 2)) != 0)
+    {
+        sprintf(g_String, "terrain size must be 2^n+1 (%d); the size from the config is used", size);
+        LogErr(g_String);
+        outParams.terrainSize = 0;
+    }
+
+    if (strcmp(outParams.device, "warp") != 0 && strcmp(outParams.device, "reference") != 0)
+    {
+        sprintf(g_String, "unknown headless device: %s (warp or reference); WARP is used", outParams.device);
+        LogErr(g_String);
+        strcpy(outParams.device, "warp");
+    }
+
+    // there is nobody to fly the camera in the headless mode
+    if (outParams.isHeadless && outParams.isRecording)
+    {
+        LogErr("the camera path can't be recorded in the headless mode");
+        outParams.isHeadless = false;
+    }
+
+    return isBenchmark;
+}
+
+///////////////////////////////////////////////////////////
+
+void Benchmark::Initialize(const BenchmarkParams& params)
+{
+    params_     = params;
+    isActive_   = true;
+    isFailed_   = false;
+    time_       = 0.0f;
+    zonesTicks_ = CpuProfiler::GetTicks();
+
+    // the same random scene in each run
+    srand(params_.seed);
+
+    if (params_.isRecording)
+    {
+        LogMsgf("benchmark: recording of the camera path into %s", params_.pathCamera);
+        return;
+    }
+
+    LoadCameraPath();
+    frames_.reserve((params_.numFrames > 0) ? params_.numFrames + 1 : (size)(params_.duration * 240));
+
+    LogMsgf("benchmark: %d entts, %d lights, duration %.1f s",
+        params_.numEntts, params_.numLights, params_.duration);
+
+    if (params_.isHeadless)
+        LogMsgf("benchmark: headless (%s device), %d frames", params_.device, params_.numFrames);
+}
+
+///////////////////////////////////////////////////////////
+
+bool Benchmark::CreateStressScene(ECS::EntityMgr& mgr)
+{
+    // a square grid of models over the terrain and point lights in random places over it
+
+    if (params_.isRecording)
+        return true;
+
+    // a path around the grid if there is no recorded one
+    if (keys_.empty())
+        MakeDefaultCameraPath();
+
+    const TerrainGeomipmapped& terrain = g_ModelMgr.GetTerrainGeomip();
+    const float terrainSize = (float)std::min(terrain.GetWidth(), terrain.GetDepth());
+
+    const int numEntts  = params_.numEntts;
+    const int numLights = params_.numLights;
+
+    try
+    {
+        if (numEntts > 0)
+        {
+            const BasicModel& sphere   = g_ModelMgr.GetModelByName("basic_sphere");
+            const BasicModel& cylinder = g_ModelMgr.GetModelByName("basic_cylinder");
+
+            const cvector<EntityID> enttsIDs = mgr.CreateEntities(numEntts);
+            const EntityID* ids = enttsIDs.data();
+
+            cvector<XMFLOAT3>    positions(numEntts);
+            cvector<XMVECTOR>    dirQuats(numEntts, { 0,0,0,1 });
+            cvector<float>       uniformScales(numEntts, 1.0f);
+            cvector<std::string> names(numEntts);
+
+            // the grid is placed in the middle of the terrain
+            const int   numCols  = (int)ceilf(sqrtf((float)numEntts));
+            const float spacing  = std::min(6.0f, 0.8f * terrainSize / numCols);
+            const float gridSize = spacing * (numCols - 1);
+            const float offset   = 0.5f * (terrainSize - gridSize);
+
+            for (int i = 0; i < numEntts; ++i)
+            {
+                const float x = offset + spacing * (i % numCols);
+                const float z = offset + spacing * (i / numCols);
+                const float y = terrain.GetScaledInterpolatedHeightAtPoint(x, z) + 1.5f;
+
+                positions[i] = { x, y, z };
+                names[i]     = "bench_entt_" + std::to_string(i);
+            }
+
+            mgr.AddTransformComponent(ids, numEntts, positions.data(), dirQuats.data(), uniformScales.data());
+            mgr.AddNameComponent(ids, names.data(), numEntts);
+
+            // spheres and cylinders by turns
+            cvector<ModelID> modelsIDs(numEntts);
+
+            for (int i = 0; i < numEntts; ++i)
+                modelsIDs[i] = (i & 1) ? cylinder.GetID() : sphere.GetID();
+
+            mgr.AddModelComponent(ids, modelsIDs.data(), numEntts);
+
+            ECS::RenderInitParams renderParams;
+            renderParams.shaderType   = ECS::LIGHT_SHADER;
+            renderParams.topologyType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+            mgr.AddRenderingComponent(ids, numEntts, renderParams);
+            mgr.renderSystem_.SetStatic(ids, numEntts, true);      // the grid never moves
+
+            // each model has only one mesh
+            constexpr size numSubsets = 1;
+            const ECS::BoundingType boundTypes[numSubsets] = { ECS::BoundingType::BOUND_BOX };
+
+            for (int i = 0; i < numEntts; ++i)
+            {
+                const BasicModel& model = (i & 1) ? cylinder : sphere;
+                const MaterialID  matID = model.meshes_.subsets_[0].materialID;
+
+                mgr.AddBoundingComponent(ids + i, 1, numSubsets, boundTypes, model.GetSubsetsAABB());
+                mgr.AddMaterialComponent(ids[i], &matID, numSubsets, true);
+            }
+        }
+
+        if (numLights > 0)
+        {
+            ECS::PointLightsInitParams lightsParams;
+            lightsParams.data.resize(numLights);
+
+            cvector<XMFLOAT3>    positions(numLights);
+            cvector<XMVECTOR>    dirQuats(numLights, { 0,0,0,1 });
+            cvector<float>       uniformScales(numLights);
+            cvector<std::string> names(numLights);
+
+            const float margin = 0.1f * terrainSize;
+
+            for (int i = 0; i < numLights; ++i)
+            {
+                ECS::PointLight& light = lightsParams.data[i];
+                const XMFLOAT4 color   = MathHelper::RandColorRGBA();
+
+                light.ambient  = { color.x * 0.2f, color.y * 0.2f, color.z * 0.2f, 1.0f };
+                light.diffuse  = { color.x * 0.8f, color.y * 0.8f, color.z * 0.8f, 1.0f };
+                light.specular = { color.x * 0.5f, color.y * 0.5f, color.z * 0.5f, 3.0f };
+                light.att      = { 0, 0.1f, 0.005f };
+                light.range    = 30;
+
+                const float x = MathHelper::RandF(margin, terrainSize - margin);
+                const float z = MathHelper::RandF(margin, terrainSize - margin);
+                const float y = terrain.GetScaledInterpolatedHeightAtPoint(x, z) + 5.0f;
+
+                positions[i]     = { x, y, z };
+                uniformScales[i] = light.range;
+                names[i]         = "bench_point_light_" + std::to_string(i);
+            }
+
+            const cvector<EntityID> lightsIDs = mgr.CreateEntities(numLights);
+            const EntityID* ids = lightsIDs.data();
+
+            mgr.AddTransformComponent(ids, numLights, positions.data(), dirQuats.data(), uniformScales.data());
+            mgr.AddLightComponent(ids, numLights, lightsParams);
+            mgr.AddNameComponent(ids, names.data(), numLights);
+        }
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't create the stress scene of the benchmark");
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool Benchmark::Update(
+    ECS::EntityMgr& mgr,
+    const EntityID cameraID,
+    const Core::SystemState& sysState,
+    const float deltaTime)
+{
+    if (!isActive_)
+        return false;
+
+    // recording: the camera is flown by the user
+    if (params_.isRecording)
+    {
+        time_ += deltaTime;
+
+        if (time_ < nextKeyTime_)
+            return true;
+
+        XMVECTOR pos;
+        XMVECTOR dir;
+        mgr.transformSystem_.GetPosAndDir(cameraID, pos, dir);
+
+        CameraKey key;
+        key.time = nextKeyTime_;
+        XMStoreFloat3(&key.pos, pos);
+        XMStoreFloat3(&key.target, XMVectorAdd(pos, XMVectorScale(XMVector3Normalize(dir), 10.0f)));
+
+        keys_.push_back(key);
+        nextKeyTime_ += RECORD_KEY_INTERVAL;
+        return true;
+    }
+
+    // by frames: each frame of any run (any device) gets the same view
+    time_ += (params_.numFrames > 0) ? params_.duration / params_.numFrames : deltaTime;
+
+    // the stats of the system state belong to the last finished frame
+    const float measureTime = time_ - params_.warmup;
+
+    if (measureTime >= 0.0f)
+    {
+        FrameTiming frame;
+        frame.time            = measureTime;
+        frame.frameTime       = sysState.frameTime;
+        frame.updateTime      = sysState.updateTime;
+        frame.renderTime      = sysState.renderTime;
+        frame.gpuTime         = sysState.gpuFrameTime;
+        frame.numVisibleObjs  = sysState.visibleObjectsCount;
+        frame.numVisibleVerts = sysState.visibleVerticesCount;
+
+        MeasureCpuZones(frame);
+        frames_.push_back(frame);
+    }
+    else
+    {
+        // zones of the warm up aren't added to the first measured frame
+        zonesTicks_ = CpuProfiler::GetTicks();
+    }
+
+    if (measureTime >= params_.duration)
+        return false;
+
+    // the path is flown once during the warm up and the measurement
+    const float pathTime = std::max(0.0f, measureTime) / params_.duration;
+
+    XMVECTOR pos;
+    XMVECTOR target;
+    EvalCameraPath(pathTime * keys_.back().time, pos, target);
+
+    XMFLOAT3 camPos;
+    XMStoreFloat3(&camPos, pos);
+
+    mgr.transformSystem_.SetPosition(cameraID, camPos);
+    mgr.transformSystem_.SetDirection(cameraID, XMVectorSubtract(target, pos));
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool Benchmark::Finish()
+{
+    if (!isActive_)
+        return true;
+
+    isActive_ = false;
+
+    if (params_.isRecording)
+        return SaveCameraPath();
+
+    if (frames_.empty())
+    {
+        LogErr("benchmark: there are no measured frames");
+        isFailed_ = true;
+        return false;
+    }
+
+    CreateParentDirs(params_.pathOutput);
+    bool result = WriteCSV() && WriteJSON();
+
+    if (result)
+        LogMsgf("benchmark: %d frames are written into %s.csv/.json", (int)frames_.size(), params_.pathOutput);
+
+    if (result && params_.isUpdateBaseline)
+    {
+        char path[160]{ '\0' };
+        snprintf(path, sizeof(path), "%s.json", params_.pathOutput);
+        CreateParentDirs(params_.pathBaseline);
+
+        std::error_code err;
+        std::filesystem::copy_file(path, params_.pathBaseline, std::filesystem::copy_options::overwrite_existing, err);
+
+        if (err)
+        {
+            sprintf(g_String, "benchmark: can't store the baseline: %s", params_.pathBaseline);
+            LogErr(g_String);
+            result = false;
+        }
+        else
+        {
+            LogMsgf("benchmark: the baseline is updated: %s", params_.pathBaseline);
+        }
+    }
+    else if (result)
+    {
+        result = CompareWithBaseline();
+    }
+
+    isFailed_ = !result;
+    return result;
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+
+void Benchmark::LoadCameraPath()
+{
+    // a key per line: time (s), position xyz, target xyz; # - a comment
+
+    keys_.clear();
+
+    FILE* pFile = fopen(params_.pathCamera, "r");
+    if (!pFile)
+    {
+        LogMsgf("benchmark: there is no camera path (%s); a default one is used", params_.pathCamera);
+        return;
+    }
+
+    char line[256]{ '\0' };
+
+    while (fgets(line, sizeof(line), pFile))
+    {
+        if (line[0] == '#')
+            continue;
+
+        CameraKey key;
+        const int numRead = sscanf(line, "%f %f %f %f %f %f %f",
+            &key.time,
+            &key.pos.x, &key.pos.y, &key.pos.z,
+            &key.target.x, &key.target.y, &key.target.z);
+
+        if (numRead != 7)
+            continue;
+
+        // keys must go by time
+        if (!keys_.empty() && key.time <= keys_.back().time)
+            continue;
+
+        keys_.push_back(key);
+    }
+
+    fclose(pFile);
+
+    // a spline needs at least two keys
+    if (keys_.size() < 2)
+    {
+        sprintf(g_String, "benchmark: camera path has less than 2 keys: %s", params_.pathCamera);
+        LogErr(g_String);
+        keys_.clear();
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void Benchmark::MakeDefaultCameraPath()
+{
+    // one orbit around the middle of the terrain
+
+    const TerrainGeomipmapped& terrain = g_ModelMgr.GetTerrainGeomip();
+    const float halfSize = 0.5f * (float)std::min(terrain.GetWidth(), terrain.GetDepth());
+
+    constexpr int numKeys = 17;
+    const float   radius  = 0.6f * halfSize;
+    const float   height  = terrain.GetScaledInterpolatedHeightAtPoint(halfSize, halfSize);
+
+    keys_.resize(numKeys);
+
+    for (int i = 0; i < numKeys; ++i)
+    {
+        const float angle = XM_2PI * i / (numKeys - 1);
+
+        keys_[i].time   = (float)i;
+        keys_[i].pos    = { halfSize + radius * cosf(angle), height + 40.0f, halfSize + radius * sinf(angle) };
+        keys_[i].target = { halfSize, height, halfSize };
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool Benchmark::SaveCameraPath() const
+{
+    CreateParentDirs(params_.pathCamera);
+
+    FILE* pFile = fopen(params_.pathCamera, "w");
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open a file to save the camera path: %s", params_.pathCamera);
+        LogErr(g_String);
+        return false;
+    }
+
+    fprintf(pFile, "# time  pos_x pos_y pos_z  target_x target_y target_z\n");
+
+    for (const CameraKey& key : keys_)
+    {
+        fprintf(pFile, "%.3f  %.3f %.3f %.3f  %.3f %.3f %.3f\n",
+            key.time,
+            key.pos.x, key.pos.y, key.pos.z,
+            key.target.x, key.target.y, key.target.z);
+    }
+
+    fclose(pFile);
+    LogMsgf("benchmark: %d keys of the camera path are saved into %s", (int)keys_.size(), params_.pathCamera);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void Benchmark::EvalCameraPath(const float time, XMVECTOR& pos, XMVECTOR& target) const
+{
+    // find a segment of the time and interpolate its position and target
+
+    const int numKeys = (int)keys_.size();
+    int i = 0;
+
+    while ((i < numKeys - 2) && (keys_[i + 1].time <= time))
+        ++i;
+
+    const CameraKey& k0 = keys_[std::max(i - 1, 0)];
+    const CameraKey& k1 = keys_[i];
+    const CameraKey& k2 = keys_[i + 1];
+    const CameraKey& k3 = keys_[std::min(i + 2, numKeys - 1)];
+
+    const float t = std::clamp((time - k1.time) / (k2.time - k1.time), 0.0f, 1.0f);
+
+    pos    = CatmullRom(k0.pos,    k1.pos,    k2.pos,    k3.pos,    t);
+    target = CatmullRom(k0.target, k1.target, k2.target, k3.target, t);
+}
+
+///////////////////////////////////////////////////////////
+
+void Benchmark::MeasureCpuZones(FrameTiming& frame)
+{
+    // sum the profiler zones which are finished since the previous frame
+    // (a zone of the render thread can belong to the frame before)
+
+    constexpr int numZones = (int)ARRAYSIZE(s_CpuZones);
+    int64_t ticks[numZones]{ 0 };
+
+    const int64_t now = CpuProfiler::GetTicks();
+    g_CpuProfiler.SumZones(s_CpuZones, numZones, zonesTicks_, now, ticks);
+    zonesTicks_ = now;
+
+    for (int i = 0; i < NUM_CPU_TIMINGS; ++i)
+        frame.cpuTimings[i] = 0.0f;
+
+    for (int i = 0; i < numZones; ++i)
+        frame.cpuTimings[s_CpuZoneTimings[i]] += (float)CpuProfiler::TicksToMs(ticks[i]);
+}
+
+///////////////////////////////////////////////////////////
+
+void Benchmark::GetCpuMedians(float* outMedians) const
+{
+    cvector<float> values(frames_.size());
+
+    for (int t = 0; t < NUM_CPU_TIMINGS; ++t)
+    {
+        for (index i = 0; i < frames_.size(); ++i)
+            values[i] = frames_[i].cpuTimings[t];
+
+        std::sort(values.begin(), values.end());
+        outMedians[t] = GetPercentile(values, 50);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool Benchmark::WriteCSV() const
+{
+    char path[160]{ '\0' };
+    snprintf(path, sizeof(path), "%s.csv", params_.pathOutput);
+
+    FILE* pFile = fopen(path, "w");
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open a file to write the benchmark results: %s", path);
+        LogErr(g_String);
+        return false;
+    }
+
+    fprintf(pFile, "frame,time_s,frame_ms,update_ms,render_ms,gpu_ms,visible_objects,visible_vertices");
+
+    for (int t = 0; t < NUM_CPU_TIMINGS; ++t)
+        fprintf(pFile, ",%s_ms", s_CpuTimingNames[t]);
+
+    fputc('\n', pFile);
+
+    for (int i = 0; const FrameTiming& frame : frames_)
+    {
+        fprintf(pFile, "%d,%.4f,%.3f,%.3f,%.3f,%.3f,%u,%u",
+            i++,
+            frame.time,
+            frame.frameTime,
+            frame.updateTime,
+            frame.renderTime,
+            frame.gpuTime,
+            frame.numVisibleObjs,
+            frame.numVisibleVerts);
+
+        for (int t = 0; t < NUM_CPU_TIMINGS; ++t)
+            fprintf(pFile, ",%.4f", frame.cpuTimings[t]);
+
+        fputc('\n', pFile);
+    }
+
+    fclose(pFile);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool Benchmark::WriteJSON() const
+{
+    // a summary of each timing: the average, percentiles and the maximum
+
+    char path[160]{ '\0' };
+    snprintf(path, sizeof(path), "%s.json", params_.pathOutput);
+
+    FILE* pFile = fopen(path, "w");
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open a file to write the benchmark summary: %s", path);
+        LogErr(g_String);
+        return false;
+    }
+
+    const size numFrames = frames_.size();
+    cvector<float> values(numFrames);
+
+    auto writeStats = [&](const char* name, auto getValue, const bool isLast)
+    {
+        double sum = 0.0;
+
+        for (index i = 0; i < numFrames; ++i)
+        {
+            values[i] = getValue(frames_[i]);
+            sum += values[i];
+        }
+
+        std::sort(values.begin(), values.end());
+
+        fprintf(pFile, "    \"%s\": { \"avg\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f }%s\n",
+            name,
+            sum / numFrames,
+            GetPercentile(values, 50),
+            GetPercentile(values, 95),
+            GetPercentile(values, 99),
+            values.back(),
+            (isLast) ? "" : ",");
+    };
+
+    fprintf(pFile, "{\n");
+    fprintf(pFile, "  \"tag\": \"%s\",\n", params_.tag);
+    fprintf(pFile, "  \"params\": { \"entts\": %d, \"lights\": %d, \"terrain\": %d, \"duration\": %.1f, \"seed\": %u, \"camera_path\": \"%s\", \"headless\": %s, \"device\": \"%s\", \"num_frames\": %d },\n",
+        params_.numEntts,
+        params_.numLights,
+        params_.terrainSize,
+        params_.duration,
+        params_.seed,
+        params_.pathCamera,
+        (params_.isHeadless) ? "true" : "false",
+        (params_.isHeadless) ? params_.device : "gpu",
+        params_.numFrames);
+    fprintf(pFile, "  \"frames\": %d,\n", (int)numFrames);
+    fprintf(pFile, "  \"avg_fps\": %.1f,\n", numFrames / std::max(frames_.back().time, 0.001f));
+    fprintf(pFile, "  \"timings_ms\": {\n");
+
+    writeStats("frame",  [](const FrameTiming& f) { return f.frameTime; }, false);
+    writeStats("cpu",    [](const FrameTiming& f) { return f.updateTime + f.renderTime; }, false);
+    writeStats("update", [](const FrameTiming& f) { return f.updateTime; }, false);
+    writeStats("render", [](const FrameTiming& f) { return f.renderTime; }, false);
+    writeStats("gpu",    [](const FrameTiming& f) { return f.gpuTime; }, true);
+
+    fprintf(pFile, "  },\n");
+    fprintf(pFile, "  \"cpu_zones_ms\": {\n");
+
+    for (int t = 0; t < NUM_CPU_TIMINGS; ++t)
+    {
+        writeStats(
+            s_CpuTimingNames[t],
+            [t](const FrameTiming& f) { return f.cpuTimings[t]; },
+            t == NUM_CPU_TIMINGS - 1);
+    }
+
+    fprintf(pFile, "  }\n");
+    fprintf(pFile, "}\n");
+
+    fclose(pFile);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool Benchmark::CompareWithBaseline() const
+{
+    // the baseline is a summary JSON of a previous run: medians of CPU timings
+    // are compared (they are less noisy than averages and maximums)
+
+    FILE* pFile = fopen(params_.pathBaseline, "r");
+    if (!pFile)
+    {
+        LogMsgf("benchmark: there is no baseline (%s); run with --update-baseline to store it", params_.pathBaseline);
+        return true;
+    }
+
+    std::string json;
+    char buf[512];
+    size_t numRead = 0;
+
+    while ((numRead = fread(buf, 1, sizeof(buf), pFile)) > 0)
+        json.append(buf, numRead);
+
+    fclose(pFile);
+
+    // results of another device (or a GPU) aren't comparable
+    char deviceStr[48]{ '\0' };
+    snprintf(deviceStr, sizeof(deviceStr), "\"device\": \"%s\"", (params_.isHeadless) ? params_.device : "gpu");
+
+    if (json.find(deviceStr) == std::string::npos)
+    {
+        sprintf(g_String, "benchmark: the baseline is measured by another device: %s", params_.pathBaseline);
+        LogErr(g_String);
+    }
+
+    const size_t zonesPos = json.find("\"cpu_zones_ms\"");
+    if (zonesPos == std::string::npos)
+    {
+        sprintf(g_String, "benchmark: there are no CPU timings in the baseline: %s", params_.pathBaseline);
+        LogErr(g_String);
+        return true;
+    }
+
+    float medians[NUM_CPU_TIMINGS];
+    GetCpuMedians(medians);
+
+    const float maxGrowth = 1.0f + params_.threshold * 0.01f;
+    int numRegressions = 0;
+
+    LogMsgf("benchmark: CPU timings (p50, ms)     baseline    current     delta");
+
+    for (int t = 0; t < NUM_CPU_TIMINGS; ++t)
+    {
+        char key[64]{ '\0' };
+        snprintf(key, sizeof(key), "\"%s\"", s_CpuTimingNames[t]);
+
+        const size_t keyPos = json.find(key, zonesPos);
+        const size_t p50Pos = (keyPos != std::string::npos) ? json.find("\"p50\":", keyPos) : std::string::npos;
+        float baseline = 0.0f;
+
+        if ((p50Pos == std::string::npos) || (sscanf(json.c_str() + p50Pos + 6, "%f", &baseline) != 1))
+        {
+            LogMsgf("  %-28s (no baseline)", s_CpuTimingNames[t]);
+            continue;
+        }
+
+        const float curr  = medians[t];
+        const float delta = (baseline > 0.0f) ? 100.0f * (curr - baseline) / baseline : 0.0f;
+        const bool  isRegression = (curr > baseline * maxGrowth) && (curr - baseline > MIN_REGRESSION_MS);
+
+        LogMsgf("  %-28s %10.3f %10.3f %+8.1f%%", s_CpuTimingNames[t], baseline, curr, delta);
+
+        if (isRegression)
+        {
+            sprintf(g_String, "benchmark: CPU regression of %s: %.3f ms => %.3f ms (%+.1f%%, threshold %.1f%%)",
+                s_CpuTimingNames[t], baseline, curr, delta, params_.threshold);
+            LogErr(g_String);
+            ++numRegressions;
+        }
+    }
+
+    return numRegressions == 0;
+}
+
+} // namespace Game
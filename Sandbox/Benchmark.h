@@ -0,0 +1,147 @@
+// =================================================================================
+// Filename:     Benchmark.h
+// Description:  a reproducible benchmark mode which is started by the command line:
+//
+//                 Sandbox.exe --benchmark entts=5000 lights=64 terrain=1025
+//                             duration=30 out=benchmark/result tag=<commit>
+//
+//               - a stress scene (a grid of N entities, N point lights) is added
+//                 to the usual scene; random values use a fixed seed;
+//               - the current camera flies by a recorded spline; its timing is
+//                 the wall time so each run sees the same views at the same time;
+//               - per-frame CPU/GPU timings are written as CSV and their summary
+//                 (avg, percentiles) as JSON so runs can be compared per commit;
+//
+//               the camera path is recorded by "--benchmark-record path=..."
+//               (a key of the editor camera is added twice per second)
+//
+//               the headless mode is for build agents without GPUs:
+//
+//                 Sandbox.exe --benchmark --headless frames=600 device=warp
+//                             baseline=data/benchmark/baseline.json threshold=10
+//
+//               - there is no window: a WARP (or reference) device renders offscreen;
+//               - the camera goes by a fixed step per frame so each frame of a run
+//                 has the same view and the same work of culling, etc.;
+//               - CPU timings of culling, render prep, ECS update, instance buffer
+//                 upload and terrain tessellation (profiler zones) are compared with
+//                 the baseline (a summary JSON of a previous run); a regression makes
+//                 the exit code nonzero; "--update-baseline" stores the current result
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <CoreCommon/SystemState.h>
+#include <DirectXMath.h>
+
+
+namespace ECS
+{
+class EntityMgr;
+}
+
+
+namespace Game
+{
+
+struct BenchmarkParams
+{
+    int   numEntts      = 2000;                        // entities of the stress grid
+    int   numLights     = 32;                          // point lights over the grid
+    int   terrainSize   = 0;                           // 0: from terrain.cfg; otherwise 2^n+1
+    float duration      = 30.0f;                       // seconds of the measured fly-through
+    float warmup        = 3.0f;                        // seconds which aren't measured (loading of streamed data)
+    uint  seed          = 1234;
+    bool  isRecording   = false;                       // record the camera path instead of playing it
+    bool  isHeadless    = false;                       // no window; a software device
+    bool  isUpdateBaseline = false;                    // store the result as the new baseline
+    int   numFrames     = 0;                           // > 0: the duration is split into fixed steps by frames
+    float threshold     = 10.0f;                       // % of a CPU timing growth which is a regression
+
+    char  pathCamera[128] = "data/benchmark/camera_path.txt";
+    char  pathOutput[128] = "benchmark/result";        // <path>.csv and <path>.json
+    char  pathBaseline[128] = "data/benchmark/baseline.json";
+    char  device[16]    = "warp";                      // the headless device: warp or reference
+    char  tag[64]{ '\0' };                             // any label of the run (e.g. a commit hash)
+};
+
+///////////////////////////////////////////////////////////
+
+class Benchmark
+{
+public:
+    static constexpr float RECORD_KEY_INTERVAL = 0.5f; // seconds btw keys of the recorded path
+    static constexpr int   NUM_CPU_TIMINGS     = 5;    // culling, render prep, ECS update, upload, terrain
+
+    // return true if the command line asks for the benchmark (or the recording of its path)
+    static bool ParseCmdLine(const int argc, char* argv[], BenchmarkParams& outParams);
+
+    void Initialize(const BenchmarkParams& params);
+
+    // add the stress entities and lights (the terrain must be already created)
+    bool CreateStressScene(ECS::EntityMgr& mgr);
+
+    // move the camera by the path (or record its key) and add the timings of
+    // the last frame; return false when the benchmark is finished
+    bool Update(
+        ECS::EntityMgr& mgr,
+        const EntityID cameraID,
+        const Core::SystemState& sysState,
+        const float deltaTime);
+
+    // write results (or the recorded path); return false if it is failed
+    // or CPU timings have regressed against the baseline
+    bool Finish();
+
+    inline bool                   IsActive()  const { return isActive_; }
+    inline bool                   IsFailed()  const { return isFailed_; }
+    inline const BenchmarkParams& GetParams() const { return params_; }
+
+private:
+    struct CameraKey
+    {
+        float             time = 0;
+        DirectX::XMFLOAT3 pos;
+        DirectX::XMFLOAT3 target;                      // the camera looks at this point
+    };
+
+    struct FrameTiming
+    {
+        float time;                                    // since the start of measurement (s)
+        float frameTime;                               // ms
+        float updateTime;
+        float renderTime;
+        float gpuTime;
+        uint  numVisibleObjs;
+        uint  numVisibleVerts;
+        float cpuTimings[NUM_CPU_TIMINGS];             // ms of profiler zones (see s_CpuZones)
+    };
+
+    void LoadCameraPath();
+    void MakeDefaultCameraPath();
+    bool SaveCameraPath() const;
+    void EvalCameraPath(const float time, DirectX::XMVECTOR& pos, DirectX::XMVECTOR& target) const;
+
+    void MeasureCpuZones(FrameTiming& frame);
+    void GetCpuMedians(float* outMedians) const;
+
+    bool WriteCSV() const;
+    bool WriteJSON() const;
+    bool CompareWithBaseline() const;
+
+private:
+    BenchmarkParams      params_;
+    cvector<CameraKey>   keys_;                        // the camera path (sorted by time)
+    cvector<FrameTiming> frames_;                      // measured frames
+
+    float                time_        = 0.0f;          // since the first frame (s)
+    float                nextKeyTime_ = 0.0f;          // recording: when the next key is added
+    int64_t              zonesTicks_  = 0;             // profiler zones are summed since this time
+    bool                 isActive_    = false;
+    bool                 isFailed_    = false;
+};
+
+} // namespace Game
@@ -198,6 +198,9 @@ void InitPointLightEntities(ECS::EntityMgr& mgr)
         mgr.AddLightComponent(ids, numPointLights, pointLightsParams);
         mgr.AddNameComponent(ids, names, numPointLights);
         //mgr.AddBoundingComponent(ids, boundSpheres, numPointLights);
+
+        // these lights never move so their lighting is baked (see LightBaker)
+        mgr.lightSystem_.SetStatic(ids, numPointLights, true);
     }
 }
 
@@ -260,10 +263,13 @@ void InitSpotLightEntities(ECS::EntityMgr& mgr)
         float uniformScales[numSpotLights];
 
         // generate positions: 2 rows of spot light sources
+        index numRowLights = 0;
+
         for (index i = 0, z = 0; i < numSpotLights / 2; z += 30, i += 2)
         {
             positions[i + 0] = { -8, 10, (float)z };
             positions[i + 1] = { +8, 10, (float)z };
+            numRowLights = i + 2;
         }
 
       
@@ -294,6 +300,11 @@ void InitSpotLightEntities(ECS::EntityMgr& mgr)
 
         // main flashlight is inactive by default
         mgr.lightSystem_.SetLightIsActive(flashLightID, false);
+
+        // lights of the rows never move so their lighting is baked
+        // (the flashlight follows the camera so it is always dynamic)
+        if (numRowLights > 1)
+            mgr.lightSystem_.SetStatic(enttsIDs + 1, numRowLights - 1, true);
     }
 }
 
@@ -0,0 +1,940 @@
+// =================================================================================
+// Filename:     MicroBenchmark.cpp
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "pch.h"
+#include "MicroBenchmark.h"
+#include "Entity/EntityMgr.h"
+#include "Common/AABBTree.h"
+#include "../Core/Terrain/TerrainGeomipmapped.h"
+#include "../Core/Texture/Image.h"
+#include "../Core/CoreCommon/Frustum.h"
+
+#include <JobSystem.h>
+#include <algorithm>
+#include <memory>
+
+using namespace Core;
+using namespace DirectX;
+
+
+namespace Game
+{
+
+// results of kernels are accumulated here so the compiler can't throw them away
+static volatile int64_t s_Sink = 0;
+
+// a fixed seed of input data of each case (runs are comparable)
+static constexpr unsigned int MICRO_BENCH_SEED = 12345;
+
+//---------------------------------------------------------
+// Desc:   get a value of the "key=value" argument
+// Ret:    a pointer to the value or nullptr if the argument has another key
+//---------------------------------------------------------
+static const char* GetArgValue(const char* arg, const char* key)
+{
+    const size_t len = strlen(key);
+
+    if (strncmp(arg, key, len) != 0 || arg[len] != '=')
+        return nullptr;
+
+    return arg + len + 1;
+}
+
+//---------------------------------------------------------
+// Desc:   create directories of the file's path (if there are no such)
+//---------------------------------------------------------
+static void CreateParentDirs(const char* filePath)
+{
+    const std::filesystem::path dir = std::filesystem::path(filePath).parent_path();
+    std::error_code err;
+
+    if (!dir.empty())
+        std::filesystem::create_directories(dir, err);
+}
+
+//---------------------------------------------------------
+// Desc:   a camera which looks over the terrain (or the field of objects)
+//         of size x size from its corner
+//---------------------------------------------------------
+static void SetupCamera(const float size, XMFLOAT4X4& outView, XMFLOAT4X4& outProj, XMFLOAT3& outPos)
+{
+    outPos = { 0.1f * size, 0.15f * size, 0.1f * size };
+
+    const XMVECTOR pos    = XMLoadFloat3(&outPos);
+    const XMVECTOR target = { 0.6f * size, 0.0f, 0.6f * size, 1.0f };
+
+    XMStoreFloat4x4(&outView, XMMatrixLookAtLH(pos, target, { 0,1,0,0 }));
+    XMStoreFloat4x4(&outProj, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 1.0f, size));
+}
+
+//---------------------------------------------------------
+// Desc:   world-space planes of the camera's frustum (normals look inside)
+//---------------------------------------------------------
+static void SetupFrustum(const float size, Frustum& outFrustum)
+{
+    XMFLOAT4X4 view;
+    XMFLOAT4X4 proj;
+    XMFLOAT3   pos;
+
+    SetupCamera(size, view, proj, pos);
+    outFrustum.Initialize(&view._11, &proj._11);
+}
+
+
+// =================================================================================
+// cvector
+// =================================================================================
+static void BenchCvectorPushBack(MicroBenchState& state, const int numElems)
+{
+    // growth of an empty array (with reallocations)
+    state.SetNumElems(numElems);
+    state.Measure([numElems]()
+    {
+        cvector<int> arr;
+
+        for (int i = 0; i < numElems; ++i)
+            arr.push_back(i);
+
+        s_Sink = s_Sink + arr.back();
+    });
+}
+
+///////////////////////////////////////////////////////////
+
+static void BenchCvectorInsertBefore(MicroBenchState& state, const int numElems)
+{
+    // a single sorted insertion into the middle of the array (the shift of the tail)
+    cvector<int> arr(numElems);
+
+    for (int i = 0; i < numElems; ++i)
+        arr[i] = i * 2;
+
+    const int   value = numElems | 1;
+    const index idx   = arr.get_insert_idx(value);
+
+    state.SetNumElems(1);
+    state.Measure(
+        [&arr, idx, value]() { arr.insert_before(idx, value); },
+        [&arr, idx]()        { if ((arr.size() > idx) && (arr[idx] & 1)) arr.erase(idx); });
+}
+
+///////////////////////////////////////////////////////////
+
+static void BenchCvectorBinarySearch(MicroBenchState& state, const int numElems)
+{
+    // lookups of random values (half of them exist) in the sorted array
+    constexpr int numQueries = 1024;
+
+    cvector<int> arr(numElems);
+    cvector<int> queries(numQueries);
+
+    for (int i = 0; i < numElems; ++i)
+        arr[i] = i * 2;
+
+    for (int i = 0; i < numQueries; ++i)
+        queries[i] = (int)MathHelper::RandUINT(0, 2 * numElems);
+
+    state.SetNumElems(numQueries);
+    state.Measure([&arr, &queries]()
+    {
+        int64_t numFound = 0;
+
+        for (const int value : queries)
+            numFound += arr.binary_search(value);
+
+        s_Sink = s_Sink + numFound;
+    });
+}
+
+///////////////////////////////////////////////////////////
+
+static void BenchCvectorMergeSorted(MicroBenchState& state, const int numElems)
+{
+    // a batched sorted insertion of 10% new values (as by adding of components)
+    const int numValues = std::max(1, numElems / 10);
+
+    cvector<int>   src(numElems);
+    cvector<int>   values(numValues);
+    cvector<int>   arr;
+    cvector<index> idxs;
+
+    for (int i = 0; i < numElems; ++i)
+        src[i] = i * 2;
+
+    for (int i = 0; i < numValues; ++i)
+        values[i] = (int)MathHelper::RandUINT(0, 2 * numElems) | 1;
+
+    std::sort(values.begin(), values.end());
+
+    state.SetNumElems(numElems + numValues);
+    state.Measure(
+        [&arr, &values, &idxs]() { arr.merge_sorted(values, idxs); },
+        [&arr, &src]()           { arr = src; });
+}
+
+
+// =================================================================================
+// ECS
+// =================================================================================
+
+// entts with transforms (and movement) which are scattered over the field
+struct EcsScene
+{
+    std::unique_ptr<ECS::EntityMgr> pMgr = std::make_unique<ECS::EntityMgr>();
+    cvector<EntityID>               ids;
+    cvector<XMFLOAT3>               positions;
+    cvector<XMVECTOR>               dirQuats;
+    cvector<float>                  scales;
+
+    void Create(const int numEntts, const bool addTransform, const bool addMove)
+    {
+        ECS::EntityMgr& mgr = *pMgr;
+
+        ids = mgr.CreateEntities(numEntts);
+        positions.resize(numEntts);
+        dirQuats.resize(numEntts);
+        scales.resize(numEntts);
+
+        for (int i = 0; i < numEntts; ++i)
+        {
+            positions[i] = { MathHelper::RandF(0, 1000), MathHelper::RandF(0, 100), MathHelper::RandF(0, 1000) };
+            dirQuats[i]  = XMQuaternionRotationRollPitchYaw(0, MathHelper::RandF(0, XM_2PI), 0);
+            scales[i]    = MathHelper::RandF(0.5f, 2.0f);
+        }
+
+        if (addTransform)
+            mgr.AddTransformComponent(ids.data(), numEntts, positions.data(), dirQuats.data(), scales.data());
+
+        if (addMove)
+        {
+            cvector<XMFLOAT3> translations(numEntts);
+            cvector<XMVECTOR> rotQuats(numEntts);
+            cvector<float>    scaleFactors(numEntts, 1.0f);
+
+            for (int i = 0; i < numEntts; ++i)
+            {
+                translations[i] = { MathHelper::RandF(-1, 1), 0, MathHelper::RandF(-1, 1) };
+                rotQuats[i]     = XMQuaternionRotationRollPitchYaw(0, MathHelper::RandF(-0.01f, 0.01f), 0);
+            }
+
+            mgr.AddMoveComponent(ids.data(), translations.data(), rotQuats.data(), scaleFactors.data(), numEntts);
+        }
+    }
+};
+
+///////////////////////////////////////////////////////////
+
+static void BenchTransformAddRecords(MicroBenchState& state, const int numElems)
+{
+    EcsScene scene;
+    scene.Create(numElems, true, false);
+
+    ECS::TransformSystem& transformSys = scene.pMgr->transformSystem_;
+
+    state.SetNumElems(numElems);
+    state.Measure(
+        [&]() { transformSys.AddRecords(scene.ids.data(), scene.positions.data(), scene.dirQuats.data(), scene.scales.data(), numElems); },
+        [&]() { transformSys.RemoveRecords(scene.ids.data(), numElems); });
+}
+
+///////////////////////////////////////////////////////////
+
+static void BenchTransformGetWorlds(MicroBenchState& state, const int numElems)
+{
+    EcsScene scene;
+    scene.Create(numElems, true, false);
+
+    ECS::TransformSystem& transformSys = scene.pMgr->transformSystem_;
+    cvector<XMMATRIX> worlds(numElems);
+
+    state.SetNumElems(numElems);
+    state.Measure([&]() { transformSys.GetWorlds(scene.ids.data(), numElems, worlds.data()); });
+}
+
+///////////////////////////////////////////////////////////
+
+static void BenchTransformGetInverseWorlds(MicroBenchState& state, const int numElems)
+{
+    EcsScene scene;
+    scene.Create(numElems, true, false);
+
+    ECS::TransformSystem& transformSys = scene.pMgr->transformSystem_;
+    cvector<XMMATRIX> invWorlds(numElems);
+
+    state.SetNumElems(numElems);
+    state.Measure([&]() { transformSys.GetInverseWorlds(scene.ids.data(), numElems, invWorlds.data()); });
+}
+
+///////////////////////////////////////////////////////////
+
+static void BenchMoveUpdateAllMoves(MicroBenchState& state, const int numElems)
+{
+    EcsScene scene;
+    scene.Create(numElems, true, true);
+
+    ECS::EntityMgr& mgr = *scene.pMgr;
+
+    state.SetNumElems(numElems);
+    state.Measure([&mgr]() { mgr.moveSystem_.UpdateAllMoves(0.016f, mgr.transformSystem_); });
+}
+
+///////////////////////////////////////////////////////////
+
+static void BenchSeparateByRenderStates(MicroBenchState& state, const int numElems)
+{
+    // a mix of buckets as in a usual scene: mostly default states, some
+    // alpha clipped (foliage) and some blended entts
+    EcsScene scene;
+    scene.Create(numElems, false, false);
+
+    ECS::EntityMgr&         mgr = *scene.pMgr;
+    ECS::RenderStatesSystem& rsSys = mgr.renderStatesSystem_;
+
+    mgr.AddRenderStatesComponent(scene.ids.data(), numElems);
+
+    for (int i = 0; i < numElems; ++i)
+    {
+        const EntityID id = scene.ids[i];
+
+        if ((i % 8) == 0)
+        {
+            rsSys.UpdateStates(id, ECS::ALPHA_CLIPPING);
+            rsSys.UpdateStates(id, ECS::CULL_NONE);
+        }
+        else if ((i % 16) == 1)
+        {
+            rsSys.UpdateStates(id, ECS::TRANSPARENCY);
+        }
+    }
+
+    ECS::RenderStatesSystem::EnttsRenderStatesData data;
+
+    state.SetNumElems(numElems);
+    state.Measure([&]()
+    {
+        data.Clear();
+        rsSys.SeparateEnttsByRenderStates(scene.ids, data);
+        s_Sink = s_Sink + data.enttsDefault_.ids_.size();
+    });
+}
+
+
+// =================================================================================
+// culling
+// =================================================================================
+
+// bounding spheres/boxes of objects in SoA layout
+struct CullScene
+{
+    static constexpr float FIELD_SIZE = 1000.0f;
+
+    cvector<float> xs;
+    cvector<float> ys;
+    cvector<float> zs;
+    cvector<float> radiuses;
+    cvector<int>   visIdxs;
+    Frustum        frustum;
+
+    void Create(const int numObjs)
+    {
+        xs.resize(numObjs);
+        ys.resize(numObjs);
+        zs.resize(numObjs);
+        radiuses.resize(numObjs);
+        visIdxs.resize(numObjs);
+
+        for (int i = 0; i < numObjs; ++i)
+        {
+            xs[i]       = MathHelper::RandF(0, FIELD_SIZE);
+            ys[i]       = MathHelper::RandF(0, 100);
+            zs[i]       = MathHelper::RandF(0, FIELD_SIZE);
+            radiuses[i] = MathHelper::RandF(0.5f, 5.0f);
+        }
+
+        SetupFrustum(FIELD_SIZE, frustum);
+    }
+};
+
+///////////////////////////////////////////////////////////
+
+static void BenchCullSphereBatch(MicroBenchState& state, const int numElems)
+{
+    CullScene scene;
+    scene.Create(numElems);
+
+    state.SetNumElems(numElems);
+    state.Measure([&scene, numElems]()
+    {
+        s_Sink = s_Sink + scene.frustum.SphereTestBatch(
+            scene.xs.data(),
+            scene.ys.data(),
+            scene.zs.data(),
+            scene.radiuses.data(),
+            numElems,
+            scene.visIdxs.data());
+    });
+}
+
+///////////////////////////////////////////////////////////
+
+static void BenchCullCubeBatch(MicroBenchState& state, const int numElems)
+{
+    CullScene scene;
+    scene.Create(numElems);
+
+    state.SetNumElems(numElems);
+    state.Measure([&scene, numElems]()
+    {
+        s_Sink = s_Sink + scene.frustum.CubeTestBatch(
+            scene.xs.data(),
+            scene.ys.data(),
+            scene.zs.data(),
+            2.0f,
+            numElems,
+            scene.visIdxs.data());
+    });
+}
+
+///////////////////////////////////////////////////////////
+
+static void BenchCullBvhQuery(MicroBenchState& state, const int numElems)
+{
+    CullScene scene;
+    scene.Create(numElems);
+
+    ECS::AABBTree tree;
+
+    for (int i = 0; i < numElems; ++i)
+    {
+        const float r = scene.radiuses[i];
+        tree.Update((EntityID)(i + 1), { scene.xs[i]-r, scene.ys[i]-r, scene.zs[i]-r }, { scene.xs[i]+r, scene.ys[i]+r, scene.zs[i]+r });
+    }
+
+    // the BVH takes planes which look outside of the frustum
+    XMFLOAT4 planes[6];
+
+    for (int i = 0; i < 6; ++i)
+    {
+        const FrustumPlane& pl = scene.frustum.planes_[i];
+        planes[i] = { -pl.n.x, -pl.n.y, -pl.n.z, -pl.d };
+    }
+
+    cvector<EntityID> inside;
+    cvector<EntityID> intersected;
+
+    state.SetNumElems(numElems);
+    state.Measure([&]()
+    {
+        inside.clear();
+        intersected.clear();
+        tree.QueryFrustum(planes, 6, inside, intersected);
+
+        s_Sink = s_Sink + inside.size() + intersected.size();
+    });
+}
+
+
+// =================================================================================
+// terrain
+// =================================================================================
+
+// a generated geomipmapped terrain (without GPU buffers) and a camera over it
+struct TerrainScene
+{
+    std::unique_ptr<TerrainGeomipmapped> pTerrain = std::make_unique<TerrainGeomipmapped>();
+    CameraParams                         camParams;
+
+    bool Create(const int size)
+    {
+        TerrainGeomipmapped& terrain = *pTerrain;
+
+        if (!terrain.GenHeightMidpointDisplacement(size, 1.0f, false) ||
+            !terrain.InitGeomipmapping(17))
+        {
+            sprintf(g_String, "microbench: can't create a terrain (size: %d)", size);
+            LogErr(g_String);
+            return false;
+        }
+
+        XMFLOAT4X4 view;
+        XMFLOAT4X4 proj;
+        XMFLOAT3   pos;
+        Frustum    frustum;
+
+        SetupCamera((float)size, view, proj, pos);
+        frustum.Initialize(&view._11, &proj._11);
+
+        // (the order of planes of the terrain's frustum: near, far, right, left, top, bottom)
+        const eFrustumPlane order[6] = { FRUSTUM_NEAR, FRUSTUM_FAR, FRUSTUM_RIGHT, FRUSTUM_LEFT, FRUSTUM_TOP, FRUSTUM_BOTTOM };
+
+        for (int i = 0; i < 6; ++i)
+            memcpy(camParams.planes[i], &frustum.planes_[order[i]], sizeof(camParams.planes[i]));
+
+        camParams.posX          = pos.x;
+        camParams.posY          = pos.y;
+        camParams.posZ          = pos.z;
+        memcpy(camParams.viewMatrix, &view._11, sizeof(camParams.viewMatrix));
+        memcpy(camParams.projMatrix, &proj._11, sizeof(camParams.projMatrix));
+
+        camParams.fovY          = XM_PIDIV4;
+        camParams.fovX          = 2.0f * atanf(tanf(0.5f * XM_PIDIV4) * 16.0f / 9.0f);
+        camParams.nearZ         = 1.0f;
+        camParams.farZ          = (float)size;
+        camParams.screenHeight  = 1080.0f;
+        camParams.maxPixelError = 1.0f;
+
+        return true;
+    }
+
+    inline int GetNumPatches() const
+    {
+        return pTerrain->numPatchesPerSide_ * pTerrain->numPatchesPerSide_;
+    }
+};
+
+///////////////////////////////////////////////////////////
+
+static void BenchTerrainUpdate(MicroBenchState& state, const int numElems)
+{
+    // culling of patches by the quadtree + LODs by the screen-space error + indices
+    TerrainScene scene;
+
+    if (!scene.Create(numElems))
+        return;
+
+    TerrainGeomipmapped& terrain = *scene.pTerrain;
+
+    state.SetNumElems(scene.GetNumPatches());
+    state.Measure([&]() { terrain.Update(scene.camParams); });
+}
+
+///////////////////////////////////////////////////////////
+
+static void BenchTerrainComputeTesselation(MicroBenchState& state, const int numElems)
+{
+    // only the building of indices of visible patches (they are culled once)
+    TerrainScene scene;
+
+    if (!scene.Create(numElems))
+        return;
+
+    TerrainGeomipmapped& terrain = *scene.pTerrain;
+    terrain.Update(scene.camParams);
+
+    state.SetNumElems(scene.GetNumPatches());
+    state.Measure([&terrain]() { terrain.ComputeTesselation(); });
+}
+
+
+// =================================================================================
+// images
+// =================================================================================
+
+// the color of a pixel: runs of 16 pixels of the same color which alternate
+// with runs of a gradient (so the RLE file has both kinds of packets)
+static void GetTestPixel(const int x, const int y, uint8& r, uint8& g, uint8& b)
+{
+    const bool isFlat = ((x >> 4) & 1) == 0;
+
+    r = (uint8)(isFlat ? (x >> 4) * 16 : x);
+    g = (uint8)(isFlat ? (y >> 4) * 16 : y);
+    b = (uint8)(isFlat ? 128 : x + y);
+}
+
+//---------------------------------------------------------
+// Desc:   write a 24-bit TGA file (uncompressed or RLE)
+//---------------------------------------------------------
+static bool WriteTestTGA(const char* path, const int size, const bool isRle)
+{
+    FILE* pFile = fopen(path, "wb");
+    if (!pFile)
+    {
+        sprintf(g_String, "microbench: can't open a file for writing: %s", path);
+        LogErr(g_String);
+        return false;
+    }
+
+    TGAInfoHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.imageType    = (isRle) ? RleRgb : UncompressedRgb;
+    header.width        = (uint16)size;
+    header.height       = (uint16)size;
+    header.bitsPerPixel = 24;
+
+    fwrite(&header, sizeof(header), 1, pFile);
+
+    cvector<uint8> row;
+    row.reserve(size * 4);
+
+    for (int y = 0; y < size; ++y)
+    {
+        row.clear();
+
+        // (the size is a multiple of 16 so each packet is exactly 16 pixels of the row)
+        for (int x = 0; x < size; x += 16)
+        {
+            const bool isFlat = ((x >> 4) & 1) == 0;
+
+            if (isRle)
+                row.push_back(uint8((isFlat) ? 0x80 | 15 : 15));
+
+            for (int i = 0; i < 16; ++i)
+            {
+                uint8 r, g, b;
+                GetTestPixel(x + i, y, r, g, b);
+                row.push_back(b);
+                row.push_back(g);
+                row.push_back(r);
+
+                if (isRle && isFlat)
+                    break;
+            }
+        }
+
+        fwrite(row.data(), 1, row.size(), pFile);
+    }
+
+    fclose(pFile);
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   write a 24-bit BMP file by the image itself
+//---------------------------------------------------------
+static bool WriteTestBMP(const char* path, const int size)
+{
+    Image image;
+
+    if (!image.Create(size, size, 24))
+        return false;
+
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            uint8 r, g, b;
+            GetTestPixel(x, y, r, g, b);
+            image.SetColor(x, y, r, g, b);
+        }
+    }
+
+    return image.SaveBMP(path);
+}
+
+///////////////////////////////////////////////////////////
+
+enum eTestImageType
+{
+    TEST_IMAGE_BMP,
+    TEST_IMAGE_TGA,
+    TEST_IMAGE_TGA_RLE,
+};
+
+static void BenchImageLoad(MicroBenchState& state, const int size, const eTestImageType type)
+{
+    // NOTE: Image::LoadData logs each loaded file so the time of
+    //       logging is a part of the measured time
+    static const char* s_Exts[] = { "bmp", "tga", "rle.tga" };
+
+    char path[64]{ '\0' };
+    snprintf(path, sizeof(path), "benchmark/micro_image_%d.%s", size, s_Exts[type]);
+    CreateParentDirs(path);
+
+    const bool isWritten = (type == TEST_IMAGE_BMP) ?
+        WriteTestBMP(path, size) :
+        WriteTestTGA(path, size, type == TEST_IMAGE_TGA_RLE);
+
+    if (!isWritten)
+        return;
+
+    state.SetNumElems((int64_t)size * size);
+    state.Measure([path]()
+    {
+        Image image;
+        image.LoadData(path);
+        s_Sink = s_Sink + image.GetWidth();
+    });
+
+    std::error_code err;
+    std::filesystem::remove(path, err);
+}
+
+static void BenchImageLoadBMP   (MicroBenchState& state, const int size) { BenchImageLoad(state, size, TEST_IMAGE_BMP); }
+static void BenchImageLoadTGA   (MicroBenchState& state, const int size) { BenchImageLoad(state, size, TEST_IMAGE_TGA); }
+static void BenchImageLoadTGARle(MicroBenchState& state, const int size) { BenchImageLoad(state, size, TEST_IMAGE_TGA_RLE); }
+
+
+///////////////////////////////////////////////////////////
+
+bool MicroBenchmark::ParseCmdLine(const int argc, char* argv[], MicroBenchParams& outParams)
+{
+    bool isMicroBench = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--microbench") == 0)
+            isMicroBench = true;
+    }
+
+    if (!isMicroBench)
+        return false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = nullptr;
+
+        if (strcmp(arg, "--microbench") == 0)
+            continue;
+
+        else if (strcmp(arg, "--update-baseline") == 0)
+            outParams.isUpdateBaseline = true;
+
+        else if ((value = GetArgValue(arg, "min-time")))
+            outParams.minTime = std::max(0.001f, (float)atof(value));
+
+        else if ((value = GetArgValue(arg, "repeats")))
+            outParams.numRepeats = std::max(1, atoi(value));
+
+        else if ((value = GetArgValue(arg, "threshold")))
+            outParams.threshold = std::max(0.0f, (float)atof(value));
+
+        else if ((value = GetArgValue(arg, "filter")))
+            strncpy(outParams.filter, value, sizeof(outParams.filter) - 1);
+
+        else if ((value = GetArgValue(arg, "out")))
+            strncpy(outParams.pathOutput, value, sizeof(outParams.pathOutput) - 1);
+
+        else if ((value = GetArgValue(arg, "baseline")))
+            strncpy(outParams.pathBaseline, value, sizeof(outParams.pathBaseline) - 1);
+
+        else if ((value = GetArgValue(arg, "tag")))
+            strncpy(outParams.tag, value, sizeof(outParams.tag) - 1);
+
+        else
+            printf("microbench: unknown command line argument: %s\n", arg);
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool MicroBenchmark::Run(const MicroBenchParams& params)
+{
+    static const Case s_Cases[] =
+    {
+        { "cvector/push_back",          BenchCvectorPushBack,           1000 },
+        { "cvector/push_back",          BenchCvectorPushBack,           100000 },
+        { "cvector/push_back",          BenchCvectorPushBack,           1000000 },
+        { "cvector/insert_before",      BenchCvectorInsertBefore,       1000 },
+        { "cvector/insert_before",      BenchCvectorInsertBefore,       100000 },
+        { "cvector/insert_before",      BenchCvectorInsertBefore,       1000000 },
+        { "cvector/binary_search",      BenchCvectorBinarySearch,       1000 },
+        { "cvector/binary_search",      BenchCvectorBinarySearch,       100000 },
+        { "cvector/binary_search",      BenchCvectorBinarySearch,       1000000 },
+        { "cvector/merge_sorted",       BenchCvectorMergeSorted,        1000 },
+        { "cvector/merge_sorted",       BenchCvectorMergeSorted,        100000 },
+        { "cvector/merge_sorted",       BenchCvectorMergeSorted,        1000000 },
+
+        { "ecs/transform_add_records",  BenchTransformAddRecords,       1000 },
+        { "ecs/transform_add_records",  BenchTransformAddRecords,       100000 },
+        { "ecs/transform_get_worlds",   BenchTransformGetWorlds,        1000 },
+        { "ecs/transform_get_worlds",   BenchTransformGetWorlds,        100000 },
+        { "ecs/transform_get_inv_worlds", BenchTransformGetInverseWorlds, 1000 },
+        { "ecs/transform_get_inv_worlds", BenchTransformGetInverseWorlds, 100000 },
+        { "ecs/move_update_all",        BenchMoveUpdateAllMoves,        1000 },
+        { "ecs/move_update_all",        BenchMoveUpdateAllMoves,        100000 },
+        { "ecs/separate_render_states", BenchSeparateByRenderStates,    1000 },
+        { "ecs/separate_render_states", BenchSeparateByRenderStates,    100000 },
+
+        { "cull/sphere_batch",          BenchCullSphereBatch,           10000 },
+        { "cull/sphere_batch",          BenchCullSphereBatch,           1000000 },
+        { "cull/cube_batch",            BenchCullCubeBatch,             10000 },
+        { "cull/cube_batch",            BenchCullCubeBatch,             1000000 },
+        { "cull/bvh_query",             BenchCullBvhQuery,              10000 },
+        { "cull/bvh_query",             BenchCullBvhQuery,              100000 },
+
+        { "terrain/update",             BenchTerrainUpdate,             512 },
+        { "terrain/update",             BenchTerrainUpdate,             1024 },
+        { "terrain/compute_tesselation", BenchTerrainComputeTesselation, 512 },
+        { "terrain/compute_tesselation", BenchTerrainComputeTesselation, 1024 },
+
+        { "image/load_bmp",             BenchImageLoadBMP,              256 },
+        { "image/load_bmp",             BenchImageLoadBMP,              1024 },
+        { "image/load_tga",             BenchImageLoadTGA,              256 },
+        { "image/load_tga",             BenchImageLoadTGA,              1024 },
+        { "image/load_tga_rle",         BenchImageLoadTGARle,           256 },
+        { "image/load_tga_rle",         BenchImageLoadTGARle,           1024 },
+    };
+
+    params_ = params;
+    results_.clear();
+
+    // ECS kernels split big batches across workers as in the engine
+    if (!g_JobSystem.IsInitialized())
+        g_JobSystem.Initialize();
+
+    LogMsgf("microbench: min time %.3f s, repeats %d, filter \"%s\"", params_.minTime, params_.numRepeats, params_.filter);
+    LogMsgf("microbench: %-40s %12s %14s %12s", "case", "iterations", "ns/iter", "ns/elem");
+
+    for (const Case& c : s_Cases)
+    {
+        Result result;
+        snprintf(result.name, sizeof(result.name), "%s/%d", c.name, c.numElems);
+
+        if (params_.filter[0] && !strstr(result.name, params_.filter))
+            continue;
+
+        srand(MICRO_BENCH_SEED);
+
+        MicroBenchState state(params_);
+        c.func(state, c.numElems);
+
+        // the case couldn't prepare its input data
+        if (state.GetNumIters() == 0)
+        {
+            sprintf(g_String, "microbench: the case is skipped: %s", result.name);
+            LogErr(g_String);
+            continue;
+        }
+
+        result.numElems  = state.GetNumElems();
+        result.numIters  = state.GetNumIters();
+        result.nsPerIter = state.GetNsPerIter();
+        results_.push_back(result);
+
+        LogMsgf("microbench: %-40s %12lld %14.1f %12.3f",
+            result.name,
+            (long long)result.numIters,
+            result.nsPerIter,
+            result.nsPerIter / (double)std::max<int64_t>(result.numElems, 1));
+    }
+
+    g_JobSystem.Shutdown();
+
+    bool isPassed = WriteJSON() && CompareWithBaseline();
+
+    if (params_.isUpdateBaseline)
+    {
+        CreateParentDirs(params_.pathBaseline);
+        std::error_code err;
+        std::filesystem::copy_file(params_.pathOutput, params_.pathBaseline, std::filesystem::copy_options::overwrite_existing, err);
+
+        if (err)
+        {
+            sprintf(g_String, "microbench: can't store the baseline: %s", params_.pathBaseline);
+            LogErr(g_String);
+            isPassed = false;
+        }
+        else
+        {
+            LogMsgf("microbench: the baseline is updated: %s", params_.pathBaseline);
+        }
+    }
+
+    return isPassed;
+}
+
+///////////////////////////////////////////////////////////
+
+bool MicroBenchmark::WriteJSON() const
+{
+    CreateParentDirs(params_.pathOutput);
+
+    FILE* pFile = fopen(params_.pathOutput, "w");
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open a file to write results of microbenchmarks: %s", params_.pathOutput);
+        LogErr(g_String);
+        return false;
+    }
+
+    fprintf(pFile, "{\n");
+    fprintf(pFile, "  \"tag\": \"%s\",\n", params_.tag);
+    fprintf(pFile, "  \"params\": { \"min_time\": %.3f, \"repeats\": %d },\n", params_.minTime, params_.numRepeats);
+    fprintf(pFile, "  \"cases\": {\n");
+
+    for (index i = 0; i < results_.size(); ++i)
+    {
+        const Result& r = results_[i];
+
+        fprintf(pFile, "    \"%s\": { \"elements\": %lld, \"iterations\": %lld, \"ns_per_iter\": %.3f, \"ns_per_elem\": %.5f }%s\n",
+            r.name,
+            (long long)r.numElems,
+            (long long)r.numIters,
+            r.nsPerIter,
+            r.nsPerIter / (double)std::max<int64_t>(r.numElems, 1),
+            (i == results_.size() - 1) ? "" : ",");
+    }
+
+    fprintf(pFile, "  }\n");
+    fprintf(pFile, "}\n");
+
+    fclose(pFile);
+    LogMsgf("microbench: results are written: %s", params_.pathOutput);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool MicroBenchmark::CompareWithBaseline() const
+{
+    // the baseline is a JSON of a previous run: times of an iteration of
+    // each case which is in both of them are compared
+
+    FILE* pFile = fopen(params_.pathBaseline, "r");
+    if (!pFile)
+    {
+        LogMsgf("microbench: there is no baseline (%s); run with --update-baseline to store it", params_.pathBaseline);
+        return true;
+    }
+
+    std::string json;
+    char buf[512];
+    size_t numRead = 0;
+
+    while ((numRead = fread(buf, 1, sizeof(buf), pFile)) > 0)
+        json.append(buf, numRead);
+
+    fclose(pFile);
+
+    const double maxGrowth = 1.0 + params_.threshold * 0.01;
+    int numRegressions = 0;
+
+    LogMsgf("microbench: %-40s %12s %12s %9s", "case (ns/iter)", "baseline", "current", "delta");
+
+    for (const Result& r : results_)
+    {
+        char key[72]{ '\0' };
+        snprintf(key, sizeof(key), "\"%s\":", r.name);
+
+        const size_t keyPos  = json.find(key);
+        const size_t timePos = (keyPos != std::string::npos) ? json.find("\"ns_per_iter\":", keyPos) : std::string::npos;
+        double baseline = 0.0;
+
+        if ((timePos == std::string::npos) || (sscanf(json.c_str() + timePos + 14, "%lf", &baseline) != 1))
+        {
+            LogMsgf("  %-40s (no baseline)", r.name);
+            continue;
+        }
+
+        const double delta = (baseline > 0.0) ? 100.0 * (r.nsPerIter - baseline) / baseline : 0.0;
+
+        LogMsgf("  %-40s %12.1f %12.1f %+8.1f%%", r.name, baseline, r.nsPerIter, delta);
+
+        if (r.nsPerIter > baseline * maxGrowth)
+        {
+            sprintf(g_String, "microbench: regression of %s: %.1f ns => %.1f ns (%+.1f%%, threshold %.1f%%)",
+                r.name, baseline, r.nsPerIter, delta, params_.threshold);
+            LogErr(g_String);
+            ++numRegressions;
+        }
+    }
+
+    return numRegressions == 0;
+}
+
+} // namespace Game
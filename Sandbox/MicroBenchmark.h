@@ -0,0 +1,149 @@
+// =================================================================================
+// Filename:     MicroBenchmark.h
+// Description:  a suite of microbenchmarks of the engine's hot kernels which is
+//               started by the command line (without the window and the device):
+//
+//                 Sandbox.exe --microbench filter=cvector min-time=0.2
+//                             out=benchmark/micro.json baseline=data/benchmark/micro_baseline.json
+//
+//               - cvector: push_back / insert_before / binary_search / merge_sorted;
+//               - ECS: TransformSystem (AddRecords, GetWorlds, GetInverseWorlds),
+//                 MoveSystem::UpdateAllMoves, RenderStatesSystem::SeparateEnttsByRenderStates;
+//               - culling: the batched frustum tests and the BVH frustum query;
+//               - terrain: TerrainGeomipmapped::Update / ComputeTesselation;
+//               - images: decoding of BMP/TGA (uncompressed and RLE) by Image::LoadData;
+//
+//               each case runs for min-time seconds (after a warmup) and its result is
+//               the median time of an iteration over repeats; results are written as
+//               JSON and compared with the baseline (a JSON of a previous run): a case
+//               which becomes slower than the threshold (%) makes the exit code nonzero;
+//               "--update-baseline" stores the current result as the baseline
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include <Types.h>
+#include <cvector.h>
+#include <chrono>
+#include <algorithm>
+
+
+namespace Game
+{
+
+struct MicroBenchParams
+{
+    float minTime      = 0.1f;                         // seconds of measurement of each repeat
+    int   numRepeats   = 5;                            // the result is the median of repeats
+    float threshold    = 10.0f;                        // % of a slowdown which is a regression
+    bool  isUpdateBaseline = false;
+
+    char  filter[64]{ '\0' };                          // run only cases which names contain it
+    char  pathOutput[128]   = "benchmark/micro.json";
+    char  pathBaseline[128] = "data/benchmark/micro_baseline.json";
+    char  tag[64]{ '\0' };                             // any label of the run (e.g. a commit hash)
+};
+
+///////////////////////////////////////////////////////////
+
+// measures a single case: the body is called by iterations until the time is out
+class MicroBenchState
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    MicroBenchState(const MicroBenchParams& params) : params_(params) {}
+
+    // the number of processed elements per iteration (for ns per element)
+    inline void SetNumElems(const int64_t numElems) { numElems_ = numElems; }
+
+    // measure the body; reset (if it isn't nullptr) restores the input data of the
+    // body before each iteration and isn't measured
+    template <class Body, class Reset>
+    void Measure(Body&& body, Reset&& reset)
+    {
+        // warmup (caches, lazy allocations of the body)
+        reset();
+        body();
+
+        cvector<double> repeats(params_.numRepeats);
+        const double    minTimeNs = params_.minTime * 1e9;
+
+        for (int r = 0; r < params_.numRepeats; ++r)
+        {
+            double  timeNs = 0;
+            int64_t iters  = 0;
+
+            while ((timeNs < minTimeNs) || (iters == 0))
+            {
+                reset();
+
+                const Clock::time_point start = Clock::now();
+                body();
+                timeNs += (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+                ++iters;
+            }
+
+            repeats[r]  = timeNs / (double)iters;
+            numIters_  += iters;
+        }
+
+        std::sort(repeats.begin(), repeats.end());
+        nsPerIter_ = repeats[repeats.size() / 2];
+    }
+
+    template <class Body>
+    inline void Measure(Body&& body) { Measure(body, [](){}); }
+
+    inline int64_t GetNumElems()  const { return numElems_; }
+    inline int64_t GetNumIters()  const { return numIters_; }
+    inline double  GetNsPerIter() const { return nsPerIter_; }
+
+private:
+    const MicroBenchParams& params_;
+    int64_t                 numElems_  = 1;
+    int64_t                 numIters_  = 0;
+    double                  nsPerIter_ = 0;
+};
+
+///////////////////////////////////////////////////////////
+
+class MicroBenchmark
+{
+public:
+    // return true if the command line asks for the microbenchmarks
+    static bool ParseCmdLine(const int argc, char* argv[], MicroBenchParams& outParams);
+
+    // run all the cases (which pass the filter) and write results;
+    // return false if it is failed or any case has regressed against the baseline
+    bool Run(const MicroBenchParams& params);
+
+private:
+    using CaseFunc = void(*)(MicroBenchState& state, const int numElems);
+
+    struct Case
+    {
+        const char* name;
+        CaseFunc    func;
+        int         numElems;
+    };
+
+    struct Result
+    {
+        char    name[64]{ '\0' };                      // "group/kernel/numElems"
+        int64_t numElems  = 0;
+        int64_t numIters  = 0;
+        double  nsPerIter = 0;
+    };
+
+    bool WriteJSON() const;
+    bool CompareWithBaseline() const;
+
+private:
+    MicroBenchParams params_;
+    cvector<Result>  results_;
+};
+
+} // namespace Game
@@ -3,7 +3,11 @@
 #include "LightEnttsInitializer.h"
 #include "SetupModels.h"
 #include "../Core/Engine/Settings.h"
+#include "../Core/Engine/AssetHotReloader.h"
 #include "../Core/Terrain/Terrain.h"
+
+#include <MemHelpers.h>
+#include <sstream>
 //#include <time.h>
 
 using namespace Core;
@@ -25,14 +29,79 @@ bool SceneInitializer::Initialize(
 {
     LogMsg("scene initialization (start)");
 
-    bool result = false;
+    // the same steps as the init graph executes but one by one
+    if (!GenerateTerrain())
+    {
+        LogErr("can't generate the terrain");
+    }
 
     // create and init scene elements
-    if (!InitModelEntities(pDevice, enttMgr))
+    if (!InitBaseAssets(pDevice, enttMgr))
+    {
+        LogErr("can't initialize base assets");
+    }
+
+    if (!InitTerrain(pDevice, enttMgr))
+    {
+        LogErr("can't initialize the terrain");
+    }
+
+    if (!InitModels(pDevice, enttMgr))
     {
         LogErr("can't initialize models");
     }
 
+    InitEntities(pDevice, enttMgr, editorCamParams, gameCamParams);
+
+    LogMsg("is initialized");
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool SceneInitializer::LoadScene(ECS::EntityMgr& enttMgr, const char* filepath)
+{
+    // bulk-load all the components of entities from the scene file;
+    // NOTE: components refer to models/materials/textures by IDs so the assets
+    //       must be created in the same order as when the scene was saved
+    //       (the assets creation code below doesn't depend on isSceneLoaded_)
+
+    isSceneLoaded_ = false;
+
+    if (!filepath)
+        return true;
+
+    if (!ECS::WorldFileReader::IsWorldDir(filepath) && !FileSys::Exists(filepath))
+        return true;
+
+    if (!enttMgr.Deserialize(filepath))
+    {
+        LogErr("can't load the scene file (remove it to build the scene by code)");
+        return false;
+    }
+
+    LogMsgf("scene is loaded from the file: %s", filepath);
+    isSceneLoaded_ = true;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool SceneInitializer::InitEntities(
+    ID3D11Device* pDevice,
+    ECS::EntityMgr& enttMgr,
+    const CameraInitParams& editorCamParams,
+    const CameraInitParams& gameCamParams)
+{
+    if (isSceneLoaded_)
+    {
+        // the player's model is an asset so it is created anyway
+        InitPlayer(pDevice, &enttMgr);
+        SetupLoadedCameras(enttMgr, editorCamParams, gameCamParams);
+        return true;
+    }
+
     // init all the light source on the scene
     if (!InitLightSources(enttMgr))
     {
@@ -43,13 +112,12 @@ bool SceneInitializer::Initialize(
     if (!InitCameras(enttMgr, editorCamParams, gameCamParams))
     {
         LogErr("can't initialize cameras");
+        return false;
     }
 
     // create and setup a player entity
     InitPlayer(pDevice, &enttMgr);
 
-    LogMsg("is initialized");
-
     return true;
 }
 
@@ -59,17 +127,21 @@ void SceneInitializer::InitPlayer(ID3D11Device* pDevice, ECS::EntityMgr* pEnttMg
 {
     // create and setup the player's entity
 
-    const EntityID playerID = pEnttMgr->CreateEntity("player");
-    pEnttMgr->AddTransformComponent(playerID, { 0,0,0 }, { 0,0,1 });
-
-    // ------------------------------------------
-
-    // create and set a model for the player entity
+    // create a model for the player entity
     const MeshSphereParams sphereParams(1, 20, 20);
     ModelsCreator creator;
     const ModelID sphereID = creator.CreateSphere(pDevice, sphereParams);
     BasicModel& sphere = g_ModelMgr.GetModelByID(sphereID);
 
+    // the entity is already loaded from the scene file
+    if (isSceneLoaded_)
+        return;
+
+    const EntityID playerID = pEnttMgr->CreateEntity("player");
+    pEnttMgr->AddTransformComponent(playerID, { 0,0,0 }, { 0,0,1 });
+
+    // ------------------------------------------
+
     pEnttMgr->AddModelComponent(playerID, sphere.GetID());
 
     // setup material (light properties + textures) for the player entity
@@ -185,6 +257,40 @@ bool SceneInitializer::InitCameras(
 
 ///////////////////////////////////////////////////////////
 
+void SceneInitializer::SetupLoadedCameras(
+    ECS::EntityMgr& enttMgr,
+    const CameraInitParams& editorCamParams,
+    const CameraInitParams& gameCamParams)
+{
+    // cameras are loaded from the scene file but their projection
+    // depends on the current size of the window
+
+    ECS::CameraSystem& camSys   = enttMgr.cameraSystem_;
+    const EntityID editorCamID  = enttMgr.nameSystem_.GetIdByName("editor_camera");
+    const EntityID gameCamID    = enttMgr.nameSystem_.GetIdByName("game_camera");
+
+    const EntityID          camsIDs[2]    = { editorCamID, gameCamID };
+    const CameraInitParams* camsParams[2] = { &editorCamParams, &gameCamParams };
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!camSys.HasEntity(camsIDs[i]))
+            continue;
+
+        const CameraInitParams& params = *camsParams[i];
+
+        camSys.SetAspectRatio(camsIDs[i], params.aspectRatio);
+        camSys.SetupOrthographicMatrix(
+            camsIDs[i],
+            params.wndWidth,
+            params.wndHeight,
+            params.nearZ,
+            params.farZ);
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 inline float GetHeightOfGeneratedTerrainAtPoint(const float x, const float z)
 {
     return 0.1f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
@@ -198,12 +304,8 @@ void CreateLightPoles(ECS::EntityMgr& mgr, const BasicModel& lightPole)
 
     constexpr size numEntts = 10;
 
-    const cvector<EntityID> enttsIDs = mgr.CreateEntities(numEntts);
-
     XMFLOAT3    positions[numEntts];
     XMVECTOR    dirQuats[numEntts];
-    float       uniformScales[numEntts];
-    std::string names[numEntts];
 
     // setup positions: 2 rows of lightPoles
     for (index i = 0, z = 0; i < numEntts; z += 30, i += 2)
@@ -224,38 +326,25 @@ void CreateLightPoles(ECS::EntityMgr& mgr, const BasicModel& lightPole)
         dirQuats[i + 1] = DirectX::XMQuaternionRotationRollPitchYaw(0, -pidiv2, 0);
     }
 
-    // setup scales
-    for (index i = 0; i < numEntts; ++i)
-        uniformScales[i] = 1.0f;
-
-    // generate names
-    for (index i = 0; i < numEntts; ++i)
-        names[i] += "lightPole_" + std::to_string(enttsIDs[i]);
-
     // ----------------------------------------------------
 
-    const EntityID* ids = enttsIDs.data();
-
-    mgr.AddTransformComponent(ids, numEntts, positions, dirQuats, uniformScales);
-    mgr.AddNameComponent(ids, names, numEntts);
-    mgr.AddModelComponent(ids, lightPole.GetID(), numEntts);
-
+    // all the light poles are the same so create them by a prefab
     ECS::RenderInitParams renderParams;
     renderParams.shaderType = ECS::LIGHT_SHADER;
     renderParams.topologyType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
-    mgr.AddRenderingComponent(ids, numEntts, renderParams);
+    const size numSubsets = lightPole.GetNumSubsets();
+    const cvector<ECS::BoundingType> boundTypes(numSubsets, ECS::BoundingType::BOUND_BOX);
 
-    const size numSubsets = 2;                       // number of submeshes
-    const ECS::BoundingType boundTypes[1] = { ECS::BoundingType::BOUND_BOX };
+    ECS::Prefab prefab;
+    prefab.SetName("lightPole")
+          .SetTransform({ 0,0,0,1 }, 1.0f)
+          .SetModel(lightPole.GetID())
+          .SetRendering(renderParams)
+          .SetBounding(boundTypes.data(), lightPole.GetSubsetsAABB(), numSubsets);
 
-    // add bounding component to each entity
-    mgr.AddBoundingComponent(
-        ids,
-        numEntts,
-        numSubsets,
-        boundTypes,
-        lightPole.GetSubsetsAABB());      // AABB data (center, extents)
+    const cvector<EntityID> enttsIDs = mgr.Instantiate(prefab, numEntts, positions, dirQuats);
+    mgr.renderSystem_.SetStatic(enttsIDs.data(), numEntts, true);
 }
 
 ///////////////////////////////////////////////////////////
@@ -349,22 +438,26 @@ void CreateSpheres(ECS::EntityMgr& mgr, const BasicModel& model)
 
 ///////////////////////////////////////////////////////////
 
-void CreateSkyBox(ECS::EntityMgr& mgr, SkyModel& sky)
+void SetupSky(SkyModel& sky)
 {
-    LogDbg("create sky box entity");
+    LogDbg("setup the sky");
 
     std::string skyTexPath;
     int textureIdx = 0;
     XMFLOAT3 colorCenter;
     XMFLOAT3 colorApex;
 
-    std::ifstream fin("data/sky_config.txt");
+    uint8* configData = nullptr;
+    size_t configSize = 0;
 
-    // read in params for the sky from the config file
-    if (fin.is_open())
+    // read in params for the sky from the config file (from asset packs or from disk)
+    if (FileSys::ReadFile("data/sky_config.txt", configData, configSize))
     {
+        std::istringstream fin(std::string((const char*)configData, configSize));
         std::string ignore;
 
+        SafeDeleteArr(configData);
+
         // read in a path to the sky texture
         fin >> ignore;
         fin >> textureIdx;
@@ -400,8 +493,14 @@ void CreateSkyBox(ECS::EntityMgr& mgr, SkyModel& sky)
     sky.SetTexture(textureIdx, skyMapID);
     sky.SetColorCenter(colorCenter);
     sky.SetColorApex(colorApex);
+}
+
+///////////////////////////////////////////////////////////
+
+void CreateSkyBox(ECS::EntityMgr& mgr)
+{
+    LogDbg("create sky box entity");
 
-    // setup sky entity
     const EntityID enttID = mgr.CreateEntity();
     mgr.AddTransformComponent(enttID, { 0,990,0 });
     mgr.AddNameComponent(enttID, "sky");
@@ -492,6 +591,72 @@ void CreateCylinders(ECS::EntityMgr& mgr, const BasicModel& model)
 
 ///////////////////////////////////////////////////////////
 
+void CreateCubesMaterials()
+{
+    // load textures and create materials for the cubes entities
+    // (they are assets so they are created even if entities are loaded from file)
+
+    constexpr int numTextures = 6;
+
+    const std::string texFilenames[numTextures] =
+    {
+        "cat.dds",
+        "fire_atlas.dds",
+        "WireFence.dds",
+        "WoodCrate01.dds",
+        "WoodCrate02.dds",
+        "box01d.dds",
+    };
+
+    // load and setup only diffuse texture for each cube
+    TexID texIDs[numTextures];
+
+    for (int i = 0; i < numTextures; ++i)
+    {
+        sprintf(g_String, "%s%s", g_RelPathTexDir, texFilenames[i].c_str());
+        texIDs[i] = g_TextureMgr.LoadFromFile(g_String);
+    }
+
+    // cube_0: rotated cat
+    Material catMaterial;
+    catMaterial.SetName("cat");
+    catMaterial.SetTexture(TEX_TYPE_DIFFUSE, texIDs[0]);
+    g_MaterialMgr.AddMaterial(std::move(catMaterial));
+
+    // cube_1: firecamp animated
+    Material firecampMaterial;
+    firecampMaterial.SetName("firecamp");
+    firecampMaterial.SetTexture(TEX_TYPE_DIFFUSE, texIDs[1]);
+    g_MaterialMgr.AddMaterial(std::move(firecampMaterial));
+
+    // cube_2: wirefence with alpha clipping
+    Material wirefenceMaterial;
+    wirefenceMaterial.SetName("wirefence");
+    wirefenceMaterial.SetAlphaClip(true);
+    wirefenceMaterial.SetTexture(TEX_TYPE_DIFFUSE, texIDs[2]);
+    g_MaterialMgr.AddMaterial(std::move(wirefenceMaterial));
+
+    // cube_3: wood crate 1
+    Material woodCrate1Material;
+    woodCrate1Material.SetName("wood_crate_1");
+    woodCrate1Material.SetTexture(TEX_TYPE_DIFFUSE, texIDs[3]);
+    g_MaterialMgr.AddMaterial(std::move(woodCrate1Material));
+
+    // cube_4: wood crate 2
+    Material woodCrate2Material;
+    woodCrate2Material.SetName("wood_crate_2");
+    woodCrate2Material.SetTexture(TEX_TYPE_DIFFUSE, texIDs[4]);
+    g_MaterialMgr.AddMaterial(std::move(woodCrate2Material));
+
+    // cube_5: box01
+    //Material box01Material;
+    //box01Material.SetName("box_01");
+    //box01Material.SetTexture(TEX_TYPE_DIFFUSE, texIDs[5]);
+    //materialMgr.AddMaterial(std::move(box01Material));
+}
+
+///////////////////////////////////////////////////////////
+
 void CreateCubes(ECS::EntityMgr& mgr, const BasicModel& model)
 {
     LogDbg("create cubes entities");
@@ -521,46 +686,6 @@ void CreateCubes(ECS::EntityMgr& mgr, const BasicModel& model)
         for (int i = 0; i < numEntts; ++i)
             enttsNameToID.insert({ enttsNames[i], enttsIDs[i] });
 
-
-        // ---------------------------------------------------------
-        // setup textures for the cubes
-
-        const std::string texKeys[numEntts] =
-        {
-            "cat",
-            "fireAtlas",
-            "wireFence",
-            "woodCrate01",
-            "woodCrate02",
-            "box01d",
-        };
-
-        const std::string texFilenames[numEntts] =
-        {
-            "cat.dds",
-            "fire_atlas.dds",
-            "WireFence.dds",
-            "WoodCrate01.dds",
-            "WoodCrate02.dds",
-            "box01d.dds",
-        };
-
-        // load and setup only diffuse texture for each cube
-        TexID texIDs[numEntts];
-
-        for (int i = 0; i < numEntts; ++i)
-        {
-            sprintf(g_String, "%s%s", g_RelPathTexDir, texFilenames[i].c_str());
-            texIDs[i] = g_TextureMgr.LoadFromFile(g_String);
-        }
-
-        // ---------------------------------------------
-
-        std::map<std::string, TexID> keysToTexIDs;
-
-        for (int i = 0; i < numEntts; ++i)
-            keysToTexIDs.insert({ texKeys[i], texIDs[i] });
-
         // ---------------------------------------------------------
         // prepare position/rotations/scales
 
@@ -595,45 +720,14 @@ void CreateCubes(ECS::EntityMgr& mgr, const BasicModel& model)
 
 
         // ---------------------------------------------------------
-        // Prepare materials for the cubes
-
-        // cube_0: rotated cat
-        Material catMaterial;
-        catMaterial.SetName("cat");
-        catMaterial.SetTexture(TEX_TYPE_DIFFUSE, keysToTexIDs.at("cat"));
-        const MaterialID catMatID = g_MaterialMgr.AddMaterial(std::move(catMaterial));
-
-        // cube_1: firecamp animated
-        Material firecampMaterial;
-        firecampMaterial.SetName("firecamp");
-        firecampMaterial.SetTexture(TEX_TYPE_DIFFUSE, keysToTexIDs.at("fireAtlas"));
-        const MaterialID firecampMatID = g_MaterialMgr.AddMaterial(std::move(firecampMaterial));
-
-        // cube_2: wirefence with alpha clipping
-        Material wirefenceMaterial;
-        wirefenceMaterial.SetName("wirefence");
-        wirefenceMaterial.SetAlphaClip(true);
-        wirefenceMaterial.SetTexture(TEX_TYPE_DIFFUSE, keysToTexIDs.at("wireFence"));
-        const MaterialID wirefenceMatID = g_MaterialMgr.AddMaterial(std::move(wirefenceMaterial));
-
-        // cube_3: wood crate 1
-        Material woodCrate1Material;
-        woodCrate1Material.SetName("wood_crate_1");
-        woodCrate1Material.SetTexture(TEX_TYPE_DIFFUSE, keysToTexIDs.at("woodCrate01"));
-        const MaterialID woodCrate1MatID = g_MaterialMgr.AddMaterial(std::move(woodCrate1Material));
-
-        // cube_4: wood crate 2
-        Material woodCrate2Material;
-        woodCrate2Material.SetName("wood_crate_2");
-        woodCrate2Material.SetTexture(TEX_TYPE_DIFFUSE, keysToTexIDs.at("woodCrate02"));
-        const MaterialID woodCrate2MatID = g_MaterialMgr.AddMaterial(std::move(woodCrate2Material));
-
-        // cube_5: box01
-        //Material box01Material;
-        //box01Material.SetName("box_01");
-        //box01Material.SetTexture(TEX_TYPE_DIFFUSE, keysToTexIDs.at("box01"));
-        //const MaterialID box01MatID = materialMgr.AddMaterial(std::move(box01Material));
-        const MaterialID box01MatID = model.meshes_.subsets_[0].materialID;
+        // get materials for the cubes (see CreateCubesMaterials())
+
+        const MaterialID catMatID        = g_MaterialMgr.GetMaterialIdByName("cat");
+        const MaterialID firecampMatID   = g_MaterialMgr.GetMaterialIdByName("firecamp");
+        const MaterialID wirefenceMatID  = g_MaterialMgr.GetMaterialIdByName("wirefence");
+        const MaterialID woodCrate1MatID = g_MaterialMgr.GetMaterialIdByName("wood_crate_1");
+        const MaterialID woodCrate2MatID = g_MaterialMgr.GetMaterialIdByName("wood_crate_2");
+        const MaterialID box01MatID      = model.meshes_.subsets_[0].materialID;
 
         // add material component (materials are the same as the original model)
 
@@ -701,6 +795,69 @@ void CreateCubes(ECS::EntityMgr& mgr, const BasicModel& model)
 
 ///////////////////////////////////////////////////////////
 
+void CreateParticleEmitters(ECS::EntityMgr& mgr)
+{
+    // create a campfire: additive flames by the fire atlas and alpha blended smoke
+    // above them (particles are simulated and rendered on GPU)
+
+    LogDbg("create particle emitters");
+
+    try
+    {
+        // the atlas is already loaded for the cubes (see CreateCubesMaterials())
+        const TexID fireTexID = g_TextureMgr.LoadFromFile(g_RelPathTexDir, "fire_atlas.dds");
+
+        const EntityID fireID  = mgr.CreateEntity();
+        const EntityID smokeID = mgr.CreateEntity();
+
+        ECS::ParticleEmitterParams fire;
+        fire.startColor  = { 1.0f, 0.8f, 0.6f, 1.0f };
+        fire.endColor    = { 1.0f, 0.3f, 0.1f, 0.0f };
+        fire.spawnRate   = 60.0f;
+        fire.minLifetime = 0.6f;
+        fire.maxLifetime = 1.2f;
+        fire.minSpeed    = 0.3f;
+        fire.maxSpeed    = 0.8f;
+        fire.spreadAngle = 0.4f;
+        fire.startSize   = 0.8f;
+        fire.endSize     = 0.3f;
+        fire.gravity     = -1.0f;                   // flames rise
+        fire.texID       = fireTexID;
+        fire.atlasCols   = 8;
+        fire.atlasRows   = 15;
+        fire.blend       = ECS::PARTICLE_BLEND_ADDITIVE;
+
+        ECS::ParticleEmitterParams smoke;
+        smoke.startColor  = { 0.3f, 0.3f, 0.3f, 0.5f };
+        smoke.endColor    = { 0.5f, 0.5f, 0.5f, 0.0f };
+        smoke.spawnRate   = 15.0f;
+        smoke.minLifetime = 3.0f;
+        smoke.maxLifetime = 5.0f;
+        smoke.minSpeed    = 0.5f;
+        smoke.maxSpeed    = 1.0f;
+        smoke.spreadAngle = 0.25f;
+        smoke.startSize   = 0.5f;
+        smoke.endSize     = 2.5f;
+        smoke.gravity     = -0.2f;
+        smoke.drag        = 0.3f;
+        smoke.blend       = ECS::PARTICLE_BLEND_ALPHA;
+
+        mgr.AddTransformComponent(fireID,  { -7, 0.5f, 4 });
+        mgr.AddTransformComponent(smokeID, { -7, 1.5f, 4 });
+        mgr.AddNameComponent(fireID,  "campfire_flames");
+        mgr.AddNameComponent(smokeID, "campfire_smoke");
+        mgr.AddParticleEmitterComponent(fireID,  fire);
+        mgr.AddParticleEmitterComponent(smokeID, smoke);
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e, true);
+        LogErr("can't create particle emitters");
+    }
+}
+
+///////////////////////////////////////////////////////////
+
 void CreateTerrain(ECS::EntityMgr& mgr, const Core::TerrainGeomipmapped& terrain)
 {
     //
@@ -776,6 +933,55 @@ void CreateSkull(ECS::EntityMgr& mgr, const BasicModel& model)
     }
 }
 
+//---------------------------------------------------------
+// Desc:   place objects at random points on the terrain: heights are sampled
+//         by batches and objects which are placed too high are placed again
+// Args:   - positions: output positions
+//         - num:       number of positions
+//         - range:     max coord by X and Z
+//         - maxHeight: max height of a position
+//         - offsetY:   offset of a position over the terrain
+//---------------------------------------------------------
+static void PlaceOnTerrain(
+    const TerrainGeomipmapped& terrain,
+    XMFLOAT3* positions,
+    const int num,
+    const float range,
+    const float maxHeight,
+    const float offsetY)
+{
+    cvector<XMFLOAT2> xz(num);
+    cvector<float>    heights(num);
+    cvector<int>      pending(num);       // idxs of positions which aren't placed yet
+
+    for (int i = 0; i < num; ++i)
+        pending[i] = i;
+
+    while (!pending.empty())
+    {
+        const int numPending = (int)pending.size();
+
+        for (int i = 0; i < numPending; ++i)
+            xz[i] = { MathHelper::RandF(0, range), MathHelper::RandF(0, range) };
+
+        terrain.SampleHeights(xz.data(), numPending, heights.data());
+
+        int numLeft = 0;
+
+        for (int i = 0; i < numPending; ++i)
+        {
+            const float y = heights[i] + offsetY;
+
+            if (y <= maxHeight)
+                positions[pending[i]] = { xz[i].x, y, xz[i].y };
+            else
+                pending[numLeft++] = pending[i];
+        }
+
+        pending.resize(numLeft);
+    }
+}
+
 ///////////////////////////////////////////////////////////
 
 void CreateTreesPine(ECS::EntityMgr& mgr, const BasicModel& model)
@@ -807,17 +1013,8 @@ void CreateTreesPine(ECS::EntityMgr& mgr, const BasicModel& model)
     const float range = (float)terrain.heightMap_.GetWidth();
     const float maxHeight = 60;// terrain.tiles_.regions[HIGHEST_TILE].lowHeight;
 
-    // generate positions
-    for (XMFLOAT3& pos : positions)
-    {
-        do
-        {
-            pos.x = MathHelper::RandF(0, range);
-            pos.z = MathHelper::RandF(0, range);
-            pos.y = terrain.GetScaledHeightAtPoint((int)pos.x, (int)pos.z) - 0.3f;
-
-        } while (maxHeight < pos.y);   // limit height for trees
-    }
+    // generate positions (limit height for trees)
+    PlaceOnTerrain(terrain, positions, (int)numEntts, range, maxHeight, -0.3f);
 
     // generate directions
     for (index i = 0; i < numEntts; ++i)
@@ -899,17 +1096,8 @@ void CreateTreesSpruce(ECS::EntityMgr& mgr, const BasicModel& model)
     const float range            = (float)terrain.heightMap_.GetWidth();
     const float maxHeight        = 80;
 
-    // generate positions
-    for (XMFLOAT3& pos : positions)
-    {
-        do
-        {
-            pos.x = MathHelper::RandF(0, range);
-            pos.z = MathHelper::RandF(0, range);
-            pos.y = terrain.GetScaledHeightAtPoint((int)pos.x, (int)pos.z) - 0.3f;
-
-        } while (maxHeight < pos.y);   // limit height for trees
-    }
+    // generate positions (limit height for trees)
+    PlaceOnTerrain(terrain, positions, (int)numEntts, range, maxHeight, -0.3f);
 
     // generate direction quats
     for (int i = 0; i < numEntts; ++i)
@@ -1009,6 +1197,7 @@ void CreatePowerLine(ECS::EntityMgr& mgr, const BasicModel& model)
     mgr.AddNameComponent(ids, names, numEntts);
     mgr.AddModelComponent(ids, model.GetID(), numEntts);
     mgr.AddRenderingComponent(ids, numEntts, renderParams);
+    mgr.renderSystem_.SetStatic(ids, numEntts, true);
 
     mgr.AddBoundingComponent(
         enttsIDs.data(),
@@ -1252,6 +1441,7 @@ void CreateBuilding(ECS::EntityMgr& mgr, const BasicModel& model)
     mgr.AddNameComponent(enttID, "building");
     mgr.AddModelComponent(enttID, model.GetID());
     mgr.AddRenderingComponent(enttID, renderParams);
+    mgr.renderSystem_.SetStatic(&enttID, 1, true);
 
     mgr.AddBoundingComponent(
         &enttID,
@@ -1324,6 +1514,7 @@ void CreateApartment(ECS::EntityMgr& mgr, const BasicModel& model)
     mgr.AddNameComponent(enttID, "apartment");
     mgr.AddModelComponent(enttID, model.GetID());
     mgr.AddRenderingComponent(enttID, renderParams);
+    mgr.renderSystem_.SetStatic(&enttID, 1, true);
 
     mgr.AddBoundingComponent(
         &enttID,
@@ -1465,6 +1656,7 @@ void CreateCastleTower(ECS::EntityMgr& mgr, const BasicModel& model)
     mgr.AddNameComponent(enttID, "castle_tower");
     mgr.AddModelComponent(enttID, model.GetID());
     mgr.AddRenderingComponent(enttID, renderParams);
+    mgr.renderSystem_.SetStatic(&enttID, 1, true);
 
     mgr.AddBoundingComponent(
         &enttID,
@@ -1556,6 +1748,7 @@ void CreateHouse(ECS::EntityMgr& mgr, const BasicModel& model)
     mgr.AddNameComponent(enttID, "kordon_house");
     mgr.AddModelComponent(enttID, model.GetID());
     mgr.AddRenderingComponent(enttID, renderParams);
+    mgr.renderSystem_.SetStatic(&enttID, 1, true);
 
     mgr.AddBoundingComponent(
         &enttID,
@@ -1592,6 +1785,7 @@ void CreateHouse2(ECS::EntityMgr& mgr, const BasicModel& model)
     mgr.AddNameComponent(enttID, "blockpost");
     mgr.AddModelComponent(enttID, model.GetID());
     mgr.AddRenderingComponent(enttID, renderParams);
+    mgr.renderSystem_.SetStatic(&enttID, 1, true);
 
     mgr.AddBoundingComponent(
         &enttID,
@@ -1691,6 +1885,7 @@ void CreatePillar(ECS::EntityMgr& mgr, const BasicModel& model)
     mgr.AddNameComponent(enttID, "pillar_" + std::to_string(enttID));
     mgr.AddModelComponent(enttID, model.GetID());
     mgr.AddRenderingComponent(enttID, renderParams);
+    mgr.renderSystem_.SetStatic(&enttID, 1, true);
 
     mgr.AddBoundingComponent(
         &enttID,
@@ -1707,19 +1902,27 @@ void PrintImportTimingInfo()
     // print into the console information about the duration of the whole
     // process of importing models from the external formats
 
-    const double factor = (1.0 / ModelImporter::s_ImportDuration_) * 100.0;
+    const ModelImportStats& stats = ModelImporter::s_Stats_;
+    const double factor = (stats.total > 0) ? (1.0 / stats.total) * 100.0 : 0.0;
 
 
     LogMsgf("%-------------------------------------------------", GREEN);
     LogMsgf(" ");
 
     LogMsgf("%sSummary about import process:", YELLOW);
-    LogMsgf("time spent to import:        %.3f ms (100 %%)", ModelImporter::s_ImportDuration_);
-    LogMsgf("time spent to load scene:    %.3f ms (%.2f %%)", ModelImporter::s_SceneLoading_, ModelImporter::s_SceneLoading_ * factor);
-    LogMsgf("time spent to load nodes:    %.3f ms (%.2f %%)", ModelImporter::s_NodesLoading_, ModelImporter::s_NodesLoading_ * factor);
-
-    LogMsgf("time spent to load vertices: %.3f ms (%.2f %%)", ModelImporter::s_VerticesLoading_, ModelImporter::s_VerticesLoading_ * factor);
-    LogMsgf("time spent to load textures: %.3f ms (%.2f %%)", ModelImporter::s_TexLoadingDuration_, ModelImporter::s_TexLoadingDuration_ * factor);
+    LogMsgf("imported: %u models, %u meshes, %u textures from disk", stats.numModels, stats.numMeshes, stats.numTexFromDisk);
+
+    // async loads are swapped in later so there can be more of deduplicated textures
+    const TexDedupStats& dedup = g_TextureMgr.GetDedupStats();
+    LogMsgf("deduplicated textures (the same content by different paths): %u (%.2f MB of VRAM saved)", dedup.numDeduped, (double)dedup.bytesSaved / (1024.0 * 1024.0));
+    LogMsgf("time spent to import:          %.3f ms (100 %%)", stats.total);
+    LogMsgf("time spent to load scene:      %.3f ms (%.2f %%)", stats.sceneLoading, stats.sceneLoading * factor);
+    LogMsgf("time spent to flatten nodes:   %.3f ms (%.2f %%)", stats.flattening,   stats.flattening * factor);
+    LogMsgf("time spent to load geometry:   %.3f ms (%.2f %%)", stats.geometry,     stats.geometry * factor);
+    LogMsgf("time spent to load materials:  %.3f ms (%.2f %%)", stats.materials,    stats.materials * factor);
+    LogMsgf("time spent to queue textures:  %.3f ms (%.2f %%)", stats.texLoading,   stats.texLoading * factor);
+    LogMsgf("time spent to register data:   %.3f ms (%.2f %%)", stats.registration, stats.registration * factor);
+    LogMsgf("time spent to bake animations: %.3f ms (%.2f %%)", stats.animations,   stats.animations * factor);
     LogMsgf("%s-------------------------------------------------\n", GREEN);
 }
 
@@ -1729,10 +1932,10 @@ void PrintImportTimingInfo()
 #define CREATE_CASTLE 1
 #define CREATE_TREES 1
 
-void ImportExternalModels(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
+void ImportExternalModels(ID3D11Device* pDevice, ECS::EntityMgr& mgr, const bool createEntts)
 {
     // 1. import models from different external formats (.obj, .blend, .fbx, etc.)
-    // 2. create relative entities
+    // 2. create relative entities (if they aren't loaded from the scene file)
 
 
     // paths to external models
@@ -1831,6 +2034,9 @@ void ImportExternalModels(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
     //SetupAk74(ak74);
     //SetupTraktor(traktor13);
 
+    if (!createEntts)
+        return;
+
 #if CREATE_TREES
     //CreateTreesPine(mgr, treePine);
     CreateTreesSpruce(mgr, treeSpruce);
@@ -1862,7 +2068,7 @@ void ImportExternalModels(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
 
 ///////////////////////////////////////////////////////////
 
-void GenerateAssets(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
+void GenerateAssets(ID3D11Device* pDevice, ECS::EntityMgr& mgr, const bool createEntts)
 {
     ModelsCreator creator;
 
@@ -1873,35 +2079,7 @@ void GenerateAssets(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
     //const ModelID skyBoxID = creator.CreateSphere(pDevice, skyDomeSphereParams);
     SkyModel& skyBox = g_ModelMgr.GetSky();
 
-#if 1
-    // create terrain
-    //const ModelID terrainID = creator.CreateGeneratedTerrain(pDevice, 500, 500, 501, 501);
-
-    const char* terrainConfigPath = "data/terrain/terrain.cfg";
-#if 0
-    const ModelID terrainID     = creator.CreateTerrain(pDevice, terrainConfigPath);
-    Core::Terrain& terrain      = g_ModelMgr.GetTerrain();
-#else
-    const ModelID terrainID             = creator.CreateTerrainGeomipmapped(pDevice, terrainConfigPath);
-    Core::TerrainGeomipmapped& terrain  = g_ModelMgr.GetTerrainGeomip();
-#endif
-
-    // load and set a texture for the terrain model
-
-    // create and setup material for terrain
-    Material terrainMat;
-    terrainMat.SetAmbient(0.2f, 0.2f, 0.2f, 1.0f);
-    terrainMat.SetTexture(TEX_TYPE_DIFFUSE, terrain.texture_.GetID());
-    terrainMat.SetTexture(TEX_TYPE_DIFFUSE_ROUGHNESS, terrain.detailMap_.GetID());
-    terrainMat.SetTexture(TEX_TYPE_LIGHTMAP, terrain.lightmap_.id);
-    //terrainMat.SetTexture(TEX_TYPE_NORMALS, terrain.normalMap_.GetID());
-    strcpy(terrainMat.name, "terrain_mat_1");
-    const MaterialID terrainMatID = g_MaterialMgr.AddMaterial(std::move(terrainMat));
-
-    terrain.SetMaterial(terrainMatID);
-
-    CreateTerrain(mgr, terrain);
-#endif
+    // NOTE: the terrain is created separately (see CreateTerrainAssets())
 
     // generate some models manually
     const MeshSphereParams    boundSphereParams(1, 8, 8);
@@ -1943,17 +2121,60 @@ void GenerateAssets(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
     // manual setup of some models
     SetupCube(cube);
     SetupSphere(sphere);
+    SetupSky(skyBox);
+    CreateCubesMaterials();
+
+    if (!createEntts)
+        return;
 
     // create and setup entities with models
-    CreateSkyBox(mgr, skyBox);
+    CreateSkyBox(mgr);
     CreateCubes(mgr, cube);
     CreateSpheres(mgr, sphere);
     CreateCylinders(mgr, cylinder);
+    CreateParticleEmitters(mgr);
+}
+
+///////////////////////////////////////////////////////////
+
+void CreateTerrainAssets(
+    ID3D11Device* pDevice,
+    ECS::EntityMgr& mgr,
+    const TerrainConfig& terrainCfg,
+    const bool createEntts)
+{
+    // create GPU resources, a material and an entity of the already generated terrain
+
+    ModelsCreator creator;
+
+#if 0
+    //const ModelID terrainID = creator.CreateGeneratedTerrain(pDevice, 500, 500, 501, 501);
+    const ModelID terrainID     = creator.CreateTerrain(pDevice, terrainConfigPath);
+    Core::Terrain& terrain      = g_ModelMgr.GetTerrain();
+#else
+    creator.UploadTerrainGeomipmapped(pDevice, terrainCfg);
+    Core::TerrainGeomipmapped& terrain  = g_ModelMgr.GetTerrainGeomip();
+#endif
+
+    // create and setup material for terrain
+    Material terrainMat;
+    terrainMat.SetAmbient(0.2f, 0.2f, 0.2f, 1.0f);
+    terrainMat.SetTexture(TEX_TYPE_DIFFUSE, terrain.texture_.GetID());
+    terrainMat.SetTexture(TEX_TYPE_DIFFUSE_ROUGHNESS, terrain.detailMap_.GetID());
+    terrainMat.SetTexture(TEX_TYPE_LIGHTMAP, terrain.lightmap_.id);
+    //terrainMat.SetTexture(TEX_TYPE_NORMALS, terrain.normalMap_.GetID());
+    strcpy(terrainMat.name, "terrain_mat_1");
+    const MaterialID terrainMatID = g_MaterialMgr.AddMaterial(std::move(terrainMat));
+
+    terrain.SetMaterial(terrainMatID);
+
+    if (createEntts)
+        CreateTerrain(mgr, terrain);
 }
 
 ///////////////////////////////////////////////////////////
 
-void LoadAssets(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
+void LoadAssets(ID3D11Device* pDevice, ECS::EntityMgr& mgr, const bool createEntts)
 {
     // load models from the internal .de3d format
 
@@ -1961,6 +2182,12 @@ void LoadAssets(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
 
     g_ModelMgr.Deserialize(pDevice);
 
+    // models are searched by names below so they must be already loaded
+    g_ModelMgr.FinishLoading();
+
+    if (!createEntts)
+        return;
+
     // create and setup entities with models
     //CreateTreesPine   (mgr, storage.GetModelByName("tree_pine"));
     //CreateTreesSpruce (mgr, storage.GetModelByName("tree_spruce"));
@@ -2049,9 +2276,41 @@ void LoadTreesBillboardsTextures()
 
 ///////////////////////////////////////////////////////////
 
-bool SceneInitializer::InitModelEntities(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
+bool SceneInitializer::GenerateTerrain()
+{
+    // generate CPU data of the terrain (heights, tile map, light map, LODs);
+    // NOTE: can be executed by any thread (in parallel with other steps)
+
+    ModelsCreator creator;
+    return creator.GenerateTerrainGeomipmapped("data/terrain/terrain.cfg", terrainCfg_, terrainSize_);
+}
+
+///////////////////////////////////////////////////////////
+
+bool SceneInitializer::InitTerrain(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
+{
+    // the terrain must be already generated (see GenerateTerrain())
+
+    try
+    {
+        CreateTerrainAssets(pDevice, mgr, terrainCfg_, !isSceneLoaded_);
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't initialize the terrain");
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool SceneInitializer::InitBaseAssets(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
 {
-    // initialize all the models on the scene
+    // initialize models which are always created by the engine: the "invalid"
+    // model and material, the bounding box, the sky and generated primitives
 
     LogMsgf("\n");
     LogMsgf("------------------------------------------------------------");
@@ -2076,7 +2335,8 @@ bool SceneInitializer::InitModelEntities(ID3D11Device* pDevice, ECS::EntityMgr&
         MaterialID invalidMaterialID = g_MaterialMgr.AddMaterial(std::move(invalidMaterial));
 
         // create a cube which will serve for us as an invalid model
-        const ModelID cubeID = creator.CreateCube(pDevice);
+        // (a unique one: its material is changed)
+        const ModelID cubeID = creator.CreateCube(pDevice, false);
         BasicModel& invalidModel = g_ModelMgr.GetModelByID(cubeID);
 
         invalidModel.SetName("invalid_model");
@@ -2086,19 +2346,50 @@ bool SceneInitializer::InitModelEntities(ID3D11Device* pDevice, ECS::EntityMgr&
         const ModelID boundingBoxID = creator.CreateBoundingLineBox(pDevice);
 
         LoadTreesBillboardsTextures();
-        GenerateAssets(pDevice, mgr);
+        GenerateAssets(pDevice, mgr, !isSceneLoaded_);
+    }
+    catch (const std::out_of_range& e)
+    {
+        LogErr(e.what());
+        LogErr("went out of range");
+        return false;
+    }
+    catch (const std::bad_alloc& e)
+    {
+        LogErr(e.what());
+        LogErr("can't allocate memory for some element");
+        return false;
+    }
+    catch (EngineException& e)
+    {
+        LogErr(e);
+        LogErr("can't initialize base assets");
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool SceneInitializer::InitModels(ID3D11Device* pDevice, ECS::EntityMgr& mgr)
+{
+    // load (or import) models and create their entities;
+    // NOTE: some entities are placed on the terrain so it must be already initialized
 
+    try
+    {
 #if 1
         if (FileSys::Exists(g_RelPathAssetsDir))
         {
-            LoadAssets(pDevice, mgr);
+            LoadAssets(pDevice, mgr, !isSceneLoaded_);
         }
         else
         {
-            ImportExternalModels(pDevice, mgr);
+            ImportExternalModels(pDevice, mgr, !isSceneLoaded_);
         }
 #else
-        ImportExternalModels(pDevice, mgr);
+        ImportExternalModels(pDevice, mgr, !isSceneLoaded_);
         ProjectSaver saver;
         saver.StoreModels(pDevice);
 #endif
@@ -2201,6 +2492,62 @@ bool SceneInitializer::InitLightSources(ECS::EntityMgr& mgr)
     return true;
 }
 
+///////////////////////////////////////////////////////////
+
+void SceneInitializer::AddHotReloadNodes(
+    ID3D11Device* pDevice,
+    Core::AssetHotReloader& reloader,
+    const bool isTerrainStreamed) const
+{
+    // the sky texture is reloaded as a texture; its path and colors are in the config
+    reloader.AddNode("sky", []()
+    {
+        SetupSky(g_ModelMgr.GetSky());
+        return true;
+    },
+    { "data/sky_config.txt" });
+
+    // tiles of the streamed terrain are split from the loaded one so it isn't reloaded
+    if (isTerrainStreamed)
+        return;
+
+    const TerrainConfig& cfg = terrainCfg_;
 
+    // only source files are watched: maps which are saved by the generation
+    // itself would cause the reloading again and again
+    const char* heightMap  = (cfg.generateHeights)    ? nullptr : cfg.pathHeightMap;
+    const char* lightMap   = (cfg.generateLightMap)   ? nullptr : cfg.pathLightMap;
+    const char* textureMap = (cfg.generateTextureMap) ? nullptr : cfg.pathTextureMap;
+    const char* tiles[4]   = { nullptr, nullptr, nullptr, nullptr };
+
+    // a loaded .dds texture map is a texture by itself (reloaded without the terrain)
+    char extension[8]{ '\0' };
+    FileSys::GetFileExt(cfg.pathTextureMap, extension);
+
+    if (strcmp(extension, ".dds") == 0)
+        textureMap = nullptr;
+
+    if (cfg.generateTextureMap)
+    {
+        tiles[0] = cfg.pathLowestTile;
+        tiles[1] = cfg.pathLowTile;
+        tiles[2] = cfg.pathHighTile;
+        tiles[3] = cfg.pathHighestTile;
+    }
+
+    reloader.AddNode("terrain", [pDevice]()
+    {
+        ModelsCreator creator;
+        return creator.ReloadTerrainGeomipmapped(pDevice, "data/terrain/terrain.cfg");
+    },
+    {
+        "data/terrain/terrain.cfg",
+        heightMap,
+        lightMap,
+        textureMap,
+        cfg.pathDetailMap,
+        tiles[0], tiles[1], tiles[2], tiles[3]
+    });
+}
 
 } // namespace Game
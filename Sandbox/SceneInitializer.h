@@ -2,6 +2,12 @@
 
 // Entity-Component-System
 #include "Entity/EntityMgr.h"
+#include <Terrain/TerrainBase.h>
+
+namespace Core
+{
+class AssetHotReloader;
+}
 
 namespace Game
 {
@@ -21,14 +27,48 @@ struct CameraInitParams
 class SceneInitializer
 {
 public:
+    // initialize the whole scene step by step
     bool Initialize(
         ID3D11Device* pDevice,
         ECS::EntityMgr& enttMgr,
         const CameraInitParams& editorCamParams,
         const CameraInitParams& gameCamParams);
 
+    // load entities from the scene file (see EntityMgr::Serialize()); if it is
+    // loaded then next steps only create assets and don't create any entities
+    bool LoadScene(ECS::EntityMgr& enttMgr, const char* filepath);
+
+    inline bool IsSceneLoaded() const { return isSceneLoaded_; }
+
+    // generate the terrain of this size (2^n+1) instead of the size from its config
+    inline void SetTerrainSize(const int size) { terrainSize_ = size; }
+
+    // separate steps of the initialization (e.g. for tasks of the init graph):
+    //   GenerateTerrain: CPU data of the terrain (can be executed by any thread)
+    //   InitBaseAssets:  the "invalid" model/material, the sky, primitives and their entities
+    //   InitTerrain:     GPU resources and the entity of the generated terrain
+    //   InitModels:      loaded (or imported) models and their entities (needs the terrain)
+    //   InitEntities:    light sources, cameras and the player
+    bool GenerateTerrain();
+    bool InitBaseAssets (ID3D11Device* pDevice, ECS::EntityMgr& enttMgr);
+    bool InitTerrain    (ID3D11Device* pDevice, ECS::EntityMgr& enttMgr);
+    bool InitModels     (ID3D11Device* pDevice, ECS::EntityMgr& enttMgr);
+
+    bool InitEntities(
+        ID3D11Device* pDevice,
+        ECS::EntityMgr& enttMgr,
+        const CameraInitParams& editorCamParams,
+        const CameraInitParams& gameCamParams);
+
+    // add objects of the scene which are reloaded when their files are changed:
+    // the sky (by its config) and the terrain (by its config and source maps);
+    // textures and models are found by the reloader itself
+    void AddHotReloadNodes(
+        ID3D11Device* pDevice,
+        Core::AssetHotReloader& reloader,
+        const bool isTerrainStreamed) const;
+
 private:
-    bool InitModelEntities(ID3D11Device* pDevice, ECS::EntityMgr& enttMgr);
     void InitPlayer(ID3D11Device* pDevice, ECS::EntityMgr* pEnttMgr);
     bool InitLightSources(ECS::EntityMgr& mgr);
 
@@ -36,7 +76,16 @@ private:
         ECS::EntityMgr& mgr,
         const CameraInitParams& editorCamParams,
         const CameraInitParams& gameCamParams);
-    
+
+    void SetupLoadedCameras(
+        ECS::EntityMgr& mgr,
+        const CameraInitParams& editorCamParams,
+        const CameraInitParams& gameCamParams);
+
+private:
+    Core::TerrainConfig terrainCfg_;                   // params of the generated terrain
+    bool                isSceneLoaded_ = false;        // are entities loaded from the scene file?
+    int                 terrainSize_   = 0;            // 0: the size from the terrain's config
 };
 
 }
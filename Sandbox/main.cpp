@@ -3,18 +3,59 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include "pch.h"
 #include "Application.h"
+#include "MicroBenchmark.h"
+#include <CVars.h>
 
-int main()
+int main(int argc, char* argv[])
 {
 #if defined(DEBUG) | defined(_DEBUG)
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+	// Sandbox.exe --microbench [filter=str min-time=S repeats=N out=path baseline=path
+	//             threshold=% tag=str --update-baseline] (kernels are measured without the window)
+	Game::MicroBenchParams microBenchParams;
+
+	if (Game::MicroBenchmark::ParseCmdLine(argc, argv, microBenchParams))
+	{
+		InitLogger("MicroBenchLog.txt");
+
+		Game::MicroBenchmark microBench;
+		const bool isPassed = microBench.Run(microBenchParams);
+
+		CloseLogger();
+		return (isPassed) ? 0 : 1;
+	}
+
 	Game::Application app;
+	Game::BenchmarkParams benchmarkParams;
+
+	// Sandbox.exe --benchmark entts=N lights=N terrain=N duration=S out=path tag=str
+	//             [--headless frames=N device=warp|reference baseline=path threshold=%]
+	if (Game::Benchmark::ParseCmdLine(argc, argv, benchmarkParams))
+		app.EnableBenchmark(benchmarkParams);
+
+	// Sandbox.exe --record-input path | --replay-input path [trace=path]
+	char replayPath[256]{ '\0' };
+	char replayTracePath[256]{ '\0' };
+	const eInputReplayMode replayMode = InputReplay::ParseCmdLine(argc, argv, replayPath, replayTracePath, (int)sizeof(replayPath));
+
+	if (replayMode != INPUT_REPLAY_NONE)
+		app.EnableInputReplay(replayMode, replayPath, replayTracePath);
+
+	// Sandbox.exe --audit path (write the content audit as CSV and exit)
+	char auditPath[256]{ '\0' };
+
+	if (Core::ContentAuditor::ParseCmdLine(argc, argv, auditPath, (int)sizeof(auditPath)))
+		app.EnableContentAudit(auditPath);
+
+	// Sandbox.exe +OCCLUSION_CULLING=false +FAR_Z=500 (console variables, see CVarRegistry)
+	g_CVars.ParseCmdLine(argc, argv);
 
 	app.Initialize();
 	app.Run();
 	app.Close();
 
-	return 0;
+	// a CPU regression of the benchmark fails the build agent's step
+	return app.GetExitCode();
 }
@@ -0,0 +1,645 @@
+// =================================================================================
+// Filename:     AssetPack.cpp
+// Description:  implementation of the AssetPack's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "AssetPack.h"
+#include "log.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#pragma warning (disable : 4996)
+
+namespace fs = std::filesystem;
+
+
+static const char ASSET_PACK_MAGIC[4] = { 'D', 'P', 'A', 'K' };
+
+// FNV-1a params
+static constexpr uint64 FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static constexpr uint64 FNV_PRIME        = 1099511628211ULL;
+
+// LZ4 block format params
+static constexpr int    LZ4_MIN_MATCH    = 4;
+static constexpr int    LZ4_LAST_LITERALS = 5;          // the last bytes are always literals
+static constexpr int    LZ4_MF_LIMIT     = 12;          // the last match starts before it
+static constexpr int    LZ4_MAX_OFFSET   = 65535;
+static constexpr int    LZ4_HASH_LOG     = 14;
+
+
+//---------------------------------------------------------
+// Desc:  normalize a path of the file: lowercase, '/' separators,
+//        without leading "./" and repeated separators
+//---------------------------------------------------------
+static void NormalizePath(const char* path, char* outPath, const int outPathSize)
+{
+    int len = 0;
+
+    while (path[0] == '.' && (path[1] == '/' || path[1] == '\\'))
+        path += 2;
+
+    for (; *path && (len < outPathSize - 1); ++path)
+    {
+        char ch = (*path == '\\') ? '/' : (char)tolower((uint8)*path);
+
+        if ((ch == '/') && (len > 0) && (outPath[len - 1] == '/'))
+            continue;
+
+        outPath[len++] = ch;
+    }
+
+    outPath[len] = '\0';
+}
+
+//---------------------------------------------------------
+// Desc:  FNV-1a hash of the null-terminated string
+//---------------------------------------------------------
+static uint64 HashStr(const char* str)
+{
+    uint64 hash = FNV_OFFSET_BASIS;
+
+    for (; *str; ++str)
+    {
+        hash ^= (uint8)*str;
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+//---------------------------------------------------------
+// Desc:  read 4 bytes from unaligned memory
+//---------------------------------------------------------
+static inline uint32 Read32(const uint8* ptr)
+{
+    uint32 value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+//---------------------------------------------------------
+// Desc:  write a length of the LZ4 sequence part which doesn't fit into its token
+//---------------------------------------------------------
+static inline bool WriteLz4Len(uint8* dst, size_t& outPos, const size_t dstCapacity, size_t len)
+{
+    for (; len >= 255; len -= 255)
+    {
+        if (outPos >= dstCapacity)
+            return false;
+        dst[outPos++] = 255;
+    }
+
+    if (outPos >= dstCapacity)
+        return false;
+
+    dst[outPos++] = (uint8)len;
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:  write a LZ4 sequence: literals and a match (matchLen == 0: the last literals)
+//---------------------------------------------------------
+static bool WriteLz4Sequence(
+    uint8* dst,
+    size_t& outPos,
+    const size_t dstCapacity,
+    const uint8* literals,
+    const size_t numLiterals,
+    const size_t matchOffset,
+    const size_t matchLen)
+{
+    if (outPos >= dstCapacity)
+        return false;
+
+    const size_t matchCode = (matchLen > 0) ? matchLen - LZ4_MIN_MATCH : 0;
+    uint8&       token     = dst[outPos++];
+
+    token  = (uint8)(((numLiterals < 15) ? numLiterals : 15) << 4);
+    token |= (uint8)((matchCode < 15) ? matchCode : 15);
+
+    if ((numLiterals >= 15) && !WriteLz4Len(dst, outPos, dstCapacity, numLiterals - 15))
+        return false;
+
+    if (outPos + numLiterals > dstCapacity)
+        return false;
+
+    memcpy(dst + outPos, literals, numLiterals);
+    outPos += numLiterals;
+
+    if (matchLen == 0)
+        return true;
+
+    if (outPos + 2 > dstCapacity)
+        return false;
+
+    dst[outPos++] = (uint8)(matchOffset & 0xFF);
+    dst[outPos++] = (uint8)(matchOffset >> 8);
+
+    if ((matchCode >= 15) && !WriteLz4Len(dst, outPos, dstCapacity, matchCode - 15))
+        return false;
+
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:  compress data into a LZ4 block (a greedy single hash table matcher)
+// Ret:   the number of compressed bytes (0 if it doesn't fit into dstCapacity)
+//---------------------------------------------------------
+static size_t Lz4Compress(const uint8* src, const size_t srcSize, uint8* dst, const size_t dstCapacity)
+{
+    std::vector<uint32> table(1 << LZ4_HASH_LOG, 0);   // positions + 1 (0: empty)
+
+    size_t outPos = 0;
+    size_t anchor = 0;
+    size_t pos    = 0;
+
+    const size_t mfLimit    = (srcSize > LZ4_MF_LIMIT) ? srcSize - LZ4_MF_LIMIT : 0;
+    const size_t matchLimit = (srcSize > LZ4_LAST_LITERALS) ? srcSize - LZ4_LAST_LITERALS : 0;
+
+    while (pos < mfLimit)
+    {
+        const uint32 sequence = Read32(src + pos);
+        const uint32 hash     = (sequence * 2654435761U) >> (32 - LZ4_HASH_LOG);
+        const size_t ref      = table[hash];
+
+        table[hash] = (uint32)(pos + 1);
+
+        if ((ref == 0) || (pos - (ref - 1) > LZ4_MAX_OFFSET) || (Read32(src + ref - 1) != sequence))
+        {
+            ++pos;
+            continue;
+        }
+
+        const size_t matchPos = ref - 1;
+        size_t       matchLen = LZ4_MIN_MATCH;
+
+        while ((pos + matchLen < matchLimit) && (src[matchPos + matchLen] == src[pos + matchLen]))
+            ++matchLen;
+
+        if (!WriteLz4Sequence(dst, outPos, dstCapacity, src + anchor, pos - anchor, pos - matchPos, matchLen))
+            return 0;
+
+        pos   += matchLen;
+        anchor = pos;
+    }
+
+    if (!WriteLz4Sequence(dst, outPos, dstCapacity, src + anchor, srcSize - anchor, 0, 0))
+        return 0;
+
+    return outPos;
+}
+
+//---------------------------------------------------------
+// Desc:  decompress a LZ4 block (all the reads and writes are range checked)
+// Ret:   true if exactly dstSize bytes are decompressed
+//---------------------------------------------------------
+static bool Lz4Decompress(const uint8* src, const size_t srcSize, uint8* dst, const size_t dstSize)
+{
+    size_t inPos  = 0;
+    size_t outPos = 0;
+
+    while (inPos < srcSize)
+    {
+        const uint8 token       = src[inPos++];
+        size_t      numLiterals = token >> 4;
+
+        if (numLiterals == 15)
+        {
+            uint8 add = 255;
+            while ((add == 255) && (inPos < srcSize))
+            {
+                add = src[inPos++];
+                numLiterals += add;
+            }
+        }
+
+        if ((inPos + numLiterals > srcSize) || (outPos + numLiterals > dstSize))
+            return false;
+
+        memcpy(dst + outPos, src + inPos, numLiterals);
+        inPos  += numLiterals;
+        outPos += numLiterals;
+
+        // the last sequence has no match
+        if (inPos == srcSize)
+            break;
+
+        if (inPos + 2 > srcSize)
+            return false;
+
+        const size_t offset = src[inPos] | (src[inPos + 1] << 8);
+        inPos += 2;
+
+        if ((offset == 0) || (offset > outPos))
+            return false;
+
+        size_t matchLen = token & 15;
+
+        if (matchLen == 15)
+        {
+            uint8 add = 255;
+            while ((add == 255) && (inPos < srcSize))
+            {
+                add = src[inPos++];
+                matchLen += add;
+            }
+        }
+
+        matchLen += LZ4_MIN_MATCH;
+
+        if (outPos + matchLen > dstSize)
+            return false;
+
+        uint8*       out   = dst + outPos;
+        const uint8* match = out - offset;
+
+        // an overlapped match repeats the last offset bytes
+        if (offset >= matchLen)
+        {
+            memcpy(out, match, matchLen);
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLen; ++i)
+                out[i] = match[i];
+        }
+
+        outPos += matchLen;
+    }
+
+    return outPos == dstSize;
+}
+
+//---------------------------------------------------------
+// Desc:  read the whole file from disk into the buffer
+//---------------------------------------------------------
+static bool ReadDiskFile(const char* filePath, std::vector<uint8>& outData)
+{
+    FILE* pFile = fopen(filePath, "rb");
+    if (!pFile)
+        return false;
+
+    fseek(pFile, 0, SEEK_END);
+    const long fileSize = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    if (fileSize < 0)
+    {
+        fclose(pFile);
+        return false;
+    }
+
+    outData.resize((size_t)fileSize);
+
+    const size_t numRead = (fileSize > 0) ? fread(outData.data(), 1, (size_t)fileSize, pFile) : 0;
+    fclose(pFile);
+
+    return numRead == (size_t)fileSize;
+}
+
+//---------------------------------------------------------
+// Desc:  write zero bytes until the position is aligned
+//---------------------------------------------------------
+static void WritePadding(FILE* pFile, uint64& pos, const uint32 align)
+{
+    static const uint8 zeros[256]{ 0 };
+    const uint64       alignedPos = (pos + align - 1) & ~((uint64)align - 1);
+
+    for (uint64 left = alignedPos - pos; left > 0;)
+    {
+        const size_t numBytes = (left < sizeof(zeros)) ? (size_t)left : sizeof(zeros);
+
+        fwrite(zeros, 1, numBytes, pFile);
+        left -= numBytes;
+    }
+
+    pos = alignedPos;
+}
+
+
+// =================================================================================
+// Public API
+// =================================================================================
+bool AssetPack::Open(const char* packPath)
+{
+    Close();
+
+    if (!packPath || packPath[0] == '\0')
+    {
+        LogErr("input path to the asset pack is empty");
+        return false;
+    }
+
+    // a pack itself is always read from disk (not from other packs)
+    if (!file_.OpenOnDisk(packPath))
+        return false;
+
+    const uint8*           pData  = file_.GetData();
+    const size_t           size   = file_.GetSize();
+    const AssetPackHeader* header = (const AssetPackHeader*)pData;
+
+    if ((size < sizeof(AssetPackHeader)) ||
+        (memcmp(header->magic, ASSET_PACK_MAGIC, sizeof(header->magic)) != 0) ||
+        (header->version != VERSION) ||
+        (header->tocOffset + (uint64)header->numEntries * sizeof(AssetPackEntry) > size) ||
+        (header->pathsOffset + header->pathsSize > size))
+    {
+        sprintf(g_String, "invalid (or old) asset pack: %s", packPath);
+        LogErr(g_String);
+        Close();
+        return false;
+    }
+
+    header_  = header;
+    entries_ = (const AssetPackEntry*)(pData + header->tocOffset);
+    paths_   = (const char*)(pData + header->pathsOffset);
+
+    strncpy(path_, packPath, sizeof(path_) - 1);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void AssetPack::Close()
+{
+    file_.Close();
+
+    header_  = nullptr;
+    entries_ = nullptr;
+    paths_   = nullptr;
+    path_[0] = '\0';
+}
+
+///////////////////////////////////////////////////////////
+
+index AssetPack::Find(const char* filePath) const
+{
+    if (!header_ || !filePath)
+        return -1;
+
+    char normPath[256]{ '\0' };
+    NormalizePath(filePath, normPath, sizeof(normPath));
+
+    const uint64          hash  = HashStr(normPath);
+    const AssetPackEntry* first = entries_;
+    const AssetPackEntry* last  = entries_ + header_->numEntries;
+
+    const AssetPackEntry* it = std::lower_bound(first, last, hash, [](const AssetPackEntry& entry, const uint64 value)
+    {
+        return entry.pathHash < value;
+    });
+
+    // compare paths as well: different paths can have the same hash
+    for (; (it != last) && (it->pathHash == hash); ++it)
+    {
+        if ((it->pathOffset < header_->pathsSize) && (strcmp(paths_ + it->pathOffset, normPath) == 0))
+            return it - first;
+    }
+
+    return -1;
+}
+
+///////////////////////////////////////////////////////////
+
+const uint8* AssetPack::GetView(const index entryIdx) const
+{
+    const AssetPackEntry& entry = entries_[entryIdx];
+
+    if (entry.flags & ASSET_PACK_ENTRY_LZ4)
+        return nullptr;
+
+    return file_.GetData() + entry.offset;
+}
+
+///////////////////////////////////////////////////////////
+
+bool AssetPack::Read(const index entryIdx, uint8* outData) const
+{
+    const AssetPackEntry& entry = entries_[entryIdx];
+    const uint8*          pData = file_.GetData() + entry.offset;
+
+    if (entry.offset + entry.packedSize > file_.GetSize())
+        return false;
+
+    return Unpack(entryIdx, pData, outData);
+}
+
+///////////////////////////////////////////////////////////
+
+bool AssetPack::Unpack(const index entryIdx, const uint8* storedData, uint8* outData) const
+{
+    const AssetPackEntry& entry = entries_[entryIdx];
+
+    if (entry.flags & ASSET_PACK_ENTRY_LZ4)
+        return Lz4Decompress(storedData, entry.packedSize, outData, entry.size);
+
+    memcpy(outData, storedData, entry.size);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void AssetPack::Prefetch(const index* entryIdxs, const int numEntries) const
+{
+    if (!header_ || !entryIdxs || (numEntries <= 0))
+        return;
+
+    std::vector<WIN32_MEMORY_RANGE_ENTRY> ranges(numEntries);
+
+    for (int i = 0; i < numEntries; ++i)
+    {
+        const AssetPackEntry& entry = entries_[entryIdxs[i]];
+
+        ranges[i].VirtualAddress = (void*)(file_.GetData() + entry.offset);
+        ranges[i].NumberOfBytes  = entry.packedSize;
+    }
+
+    // it is only a hint: pages are read on access anyway if it fails
+    PrefetchVirtualMemory(GetCurrentProcess(), ranges.size(), ranges.data(), 0);
+}
+
+///////////////////////////////////////////////////////////
+
+bool AssetPack::Build(
+    const char* packPath,
+    const char* const* srcPaths,
+    const int numSrcPaths,
+    const AssetPackBuildParams& params,
+    AssetPackBuildStats& outStats)
+{
+    if (!packPath || packPath[0] == '\0' || !srcPaths || (numSrcPaths <= 0))
+    {
+        LogErr("invalid input args to build an asset pack");
+        return false;
+    }
+
+    const uint32 align = (params.entryAlign > 0) ? params.entryAlign : 1;
+
+    if (align & (align - 1))
+    {
+        LogErr("alignment of asset pack entries must be a power of 2");
+        return false;
+    }
+
+    // collect files to pack
+    std::vector<std::string> filePaths;
+    std::error_code          error;
+
+    for (int i = 0; i < numSrcPaths; ++i)
+    {
+        if (fs::is_directory(srcPaths[i], error))
+        {
+            for (const fs::directory_entry& entry : fs::recursive_directory_iterator(srcPaths[i], error))
+            {
+                if (entry.is_regular_file(error))
+                    filePaths.push_back(entry.path().generic_string());
+            }
+        }
+        else if (fs::is_regular_file(srcPaths[i], error))
+        {
+            filePaths.push_back(srcPaths[i]);
+        }
+    }
+
+    // write into a temp file so a broken build doesn't replace the pack
+    const std::string tmpPath = std::string(packPath) + ".tmp";
+
+    fs::create_directories(fs::path(packPath).parent_path(), error);
+
+    FILE* pFile = fopen(tmpPath.c_str(), "wb");
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open a file to build an asset pack: %s", tmpPath.c_str());
+        LogErr(g_String);
+        return false;
+    }
+
+    AssetPackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+    header.version    = VERSION;
+    header.entryAlign = align;
+
+    fwrite(&header, sizeof(header), 1, pFile);
+    uint64 pos = sizeof(header);
+
+    std::vector<AssetPackEntry> entries;
+    std::string                 paths;
+    std::vector<uint8>          data;
+    std::vector<uint8>          packed;
+
+    entries.reserve(filePaths.size());
+
+    for (const std::string& filePath : filePaths)
+    {
+        char normPath[256]{ '\0' };
+        NormalizePath(filePath.c_str(), normPath, sizeof(normPath));
+
+        if (!ReadDiskFile(filePath.c_str(), data))
+        {
+            sprintf(g_String, "can't read a file to pack: %s", filePath.c_str());
+            LogErr(g_String);
+            continue;
+        }
+
+        AssetPackEntry entry;
+        entry.pathHash   = HashStr(normPath);
+        entry.size       = (uint32)data.size();
+        entry.packedSize = entry.size;
+        entry.pathOffset = (uint32)paths.size();
+        entry.flags      = 0;
+
+        const uint8* pStored = data.data();
+
+        // the worst case of LZ4 is a bit bigger than the source
+        if (params.compress && (data.size() > LZ4_MF_LIMIT))
+        {
+            packed.resize(data.size() + data.size() / 255 + 16);
+
+            const size_t packedSize = Lz4Compress(data.data(), data.size(), packed.data(), packed.size());
+
+            if ((packedSize > 0) && (packedSize <= data.size() * params.minCompression))
+            {
+                entry.packedSize = (uint32)packedSize;
+                entry.flags     |= ASSET_PACK_ENTRY_LZ4;
+                pStored          = packed.data();
+                outStats.numPacked++;
+            }
+        }
+
+        WritePadding(pFile, pos, align);
+        entry.offset = pos;
+
+        fwrite(pStored, 1, entry.packedSize, pFile);
+        pos += entry.packedSize;
+
+        paths.append(normPath, strlen(normPath) + 1);
+        entries.push_back(entry);
+
+        outStats.numFiles++;
+        outStats.srcBytes += entry.size;
+    }
+
+    // paths and the TOC (sorted by hash for a binary search)
+    std::sort(entries.begin(), entries.end(), [](const AssetPackEntry& a, const AssetPackEntry& b)
+    {
+        return a.pathHash < b.pathHash;
+    });
+
+    header.numEntries  = (uint32)entries.size();
+    header.pathsOffset = pos;
+    header.pathsSize   = paths.size();
+
+    fwrite(paths.data(), 1, paths.size(), pFile);
+    pos += paths.size();
+
+    WritePadding(pFile, pos, 8);
+    header.tocOffset = pos;
+
+    fwrite(entries.data(), sizeof(AssetPackEntry), entries.size(), pFile);
+    pos += entries.size() * sizeof(AssetPackEntry);
+
+    fseek(pFile, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, pFile);
+
+    const bool isWritten = (ferror(pFile) == 0);
+    fclose(pFile);
+
+    if (!isWritten)
+    {
+        sprintf(g_String, "can't write an asset pack: %s", tmpPath.c_str());
+        LogErr(g_String);
+        fs::remove(tmpPath, error);
+        return false;
+    }
+
+    fs::rename(tmpPath, packPath, error);
+
+    if (error)
+    {
+        sprintf(g_String, "can't replace an asset pack (is it mounted?): %s", packPath);
+        LogErr(g_String);
+        fs::remove(tmpPath, error);
+        return false;
+    }
+
+    outStats.packBytes += pos;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+uint64 AssetPack::HashPath(const char* filePath)
+{
+    char normPath[256]{ '\0' };
+    NormalizePath(filePath, normPath, sizeof(normPath));
+
+    return HashStr(normPath);
+}
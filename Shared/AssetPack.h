@@ -0,0 +1,135 @@
+// =================================================================================
+// Filename:     AssetPack.h
+// Description:  a pack of asset files (one per content set: shaders, models,
+//               textures, etc.) so startup opens a few files instead of hundreds:
+//
+//               [header][entry data (aligned)...][paths][TOC: entries sorted by hash]
+//
+//               - a file is found by FNV-1a hash of its normalized path
+//                 (lowercase, '/' separators) with a binary search over the TOC;
+//               - the pack is memory-mapped so an uncompressed entry is used
+//                 in place; an entry can be LZ4 compressed (the block format)
+//                 if it saves enough space
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "MappedFile.h"
+#include "Types.h"
+
+
+// =================================================================================
+// File format
+// =================================================================================
+#pragma pack(push, 1)
+
+struct AssetPackHeader
+{
+    char   magic[4];           // "DPAK"
+    uint32 version;
+    uint32 numEntries;
+    uint32 entryAlign;         // of entry data offsets
+    uint64 tocOffset;          // AssetPackEntry[numEntries]
+    uint64 pathsOffset;        // null-terminated normalized paths
+    uint64 pathsSize;
+};
+
+///////////////////////////////////////////////////////////
+
+struct AssetPackEntry
+{
+    uint64 pathHash;
+    uint64 offset;             // of the entry data from the pack start
+    uint32 packedSize;         // stored bytes
+    uint32 size;               // bytes of the original file
+    uint32 pathOffset;         // in the paths block
+    uint32 flags;
+};
+
+#pragma pack(pop)
+
+///////////////////////////////////////////////////////////
+
+enum eAssetPackEntryFlags
+{
+    ASSET_PACK_ENTRY_LZ4 = (1 << 0),
+};
+
+///////////////////////////////////////////////////////////
+
+struct AssetPackBuildParams
+{
+    uint32 entryAlign     = 64;              // power of 2
+    bool   compress       = true;            // try LZ4 for each entry
+    float  minCompression = 0.9f;            // keep a compressed entry if packed <= size * this
+};
+
+///////////////////////////////////////////////////////////
+
+struct AssetPackBuildStats
+{
+    uint32 numFiles    = 0;
+    uint32 numPacked   = 0;                  // LZ4 compressed entries
+    uint64 srcBytes    = 0;
+    uint64 packBytes   = 0;
+};
+
+// =================================================================================
+// Class
+// =================================================================================
+class AssetPack
+{
+public:
+    static constexpr uint32 VERSION = 1;
+
+    AssetPack() {}
+    ~AssetPack() { Close(); }
+
+    // restrict a copying of this class instance
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    bool Open(const char* packPath);
+    void Close();
+
+    // get idx of the entry by a path of the file (-1 if there is no such a file)
+    index Find(const char* filePath) const;
+
+    // get the entry data in place (nullptr if the entry is compressed)
+    const uint8* GetView(const index entryIdx) const;
+
+    // copy or decompress the entry data (outData must be of entry.size bytes)
+    bool Read(const index entryIdx, uint8* outData) const;
+
+    // copy or decompress stored data of the entry which is read by the caller
+    // (storedData must be of entry.packedSize bytes, outData of entry.size bytes)
+    bool Unpack(const index entryIdx, const uint8* storedData, uint8* outData) const;
+
+    // ask the OS to read stored data of entries in the background (one batched request)
+    void Prefetch(const index* entryIdxs, const int numEntries) const;
+
+    // pack the files (directories are packed recursively); files are stored
+    // by their paths as they are (e.g. "data/textures/brick01d.dds")
+    static bool Build(
+        const char* packPath,
+        const char* const* srcPaths,
+        const int numSrcPaths,
+        const AssetPackBuildParams& params,
+        AssetPackBuildStats& outStats);
+
+    // hash of the normalized path (the same as it is used in the TOC)
+    static uint64 HashPath(const char* filePath);
+
+    inline bool                  IsOpen()        const { return header_ != nullptr; }
+    inline int                   GetNumEntries() const { return (header_) ? (int)header_->numEntries : 0; }
+    inline const AssetPackEntry& GetEntry(const index entryIdx) const { return entries_[entryIdx]; }
+    inline const char*           GetPath()       const { return path_; }
+
+private:
+    char                   path_[256]{ '\0' };
+    MappedFile             file_;
+    const AssetPackHeader* header_  = nullptr;
+    const AssetPackEntry*  entries_ = nullptr;   // SORTED by path hash
+    const char*            paths_   = nullptr;
+};
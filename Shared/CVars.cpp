@@ -0,0 +1,411 @@
+// =================================================================================
+// Filename:     CVars.cpp
+// Description:  implementation of the registry of console variables
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "CVars.h"
+#include "log.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#pragma warning (disable : 4996)
+
+
+// a global instance of the registry
+CVarRegistry g_CVars;
+
+
+//---------------------------------------------------------
+// Desc:  compare strings without case (like strcmp)
+//---------------------------------------------------------
+static int CompareNoCase(const char* a, const char* b)
+{
+    for (; *a && (tolower((unsigned char)*a) == tolower((unsigned char)*b)); ++a, ++b) {}
+
+    return tolower((unsigned char)*a) - tolower((unsigned char)*b);
+}
+
+//---------------------------------------------------------
+// Desc:  check if the str contains the substr (without case)
+//---------------------------------------------------------
+static bool ContainsNoCase(const char* str, const char* substr)
+{
+    const size_t subLen = strlen(substr);
+
+    for (; *str; ++str)
+    {
+        size_t i = 0;
+
+        while ((i < subLen) && str[i] && (tolower((unsigned char)str[i]) == tolower((unsigned char)substr[i])))
+            ++i;
+
+        if (i == subLen)
+            return true;
+    }
+
+    return subLen == 0;
+}
+
+///////////////////////////////////////////////////////////
+
+void CVar::ToStr(char* outStr, const size_t bufSize) const
+{
+    switch (type_)
+    {
+        case CVAR_BOOL:  snprintf(outStr, bufSize, "%s", (GetBool()) ? "true" : "false"); break;
+        case CVAR_INT:   snprintf(outStr, bufSize, "%d", GetInt());                       break;
+        case CVAR_FLOAT: snprintf(outStr, bufSize, "%g", GetFloat());                     break;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+CVarRegistry::~CVarRegistry()
+{
+    Clear();
+}
+
+///////////////////////////////////////////////////////////
+
+CVar* CVarRegistry::RegisterBool(
+    const char* name,
+    const bool value,
+    const char* desc,
+    CVar::OnChange&& onChange)
+{
+    return Register(name, CVAR_BOOL, (value) ? 1.0f : 0.0f, 0.0f, 1.0f, desc, std::move(onChange));
+}
+
+///////////////////////////////////////////////////////////
+
+CVar* CVarRegistry::RegisterInt(
+    const char* name,
+    const int value,
+    const int minValue,
+    const int maxValue,
+    const char* desc,
+    CVar::OnChange&& onChange)
+{
+    return Register(name, CVAR_INT, (float)value, (float)minValue, (float)maxValue, desc, std::move(onChange));
+}
+
+///////////////////////////////////////////////////////////
+
+CVar* CVarRegistry::RegisterFloat(
+    const char* name,
+    const float value,
+    const float minValue,
+    const float maxValue,
+    const char* desc,
+    CVar::OnChange&& onChange)
+{
+    return Register(name, CVAR_FLOAT, value, minValue, maxValue, desc, std::move(onChange));
+}
+
+///////////////////////////////////////////////////////////
+
+void CVarRegistry::Clear()
+{
+    for (CVar*& pVar : vars_)
+    {
+        delete pVar;
+        pVar = nullptr;
+    }
+
+    vars_.clear();
+    changes_.clear();
+}
+
+///////////////////////////////////////////////////////////
+
+CVar* CVarRegistry::Find(const char* name) const
+{
+    if (!name)
+        return nullptr;
+
+    // binary search by names
+    index lo = 0;
+    index hi = (index)vars_.size() - 1;
+
+    while (lo <= hi)
+    {
+        const index mid = (lo + hi) / 2;
+        const int   cmp = CompareNoCase(vars_[mid]->name_, name);
+
+        if (cmp == 0)
+            return vars_[mid];
+
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+
+    return nullptr;
+}
+
+///////////////////////////////////////////////////////////
+
+bool CVarRegistry::Set(const char* name, const char* value)
+{
+    CVar* pVar = Find(name);
+
+    if (!pVar)
+    {
+        sprintf(g_String, "there is no cvar: %s", name);
+        LogErr(g_String);
+        return false;
+    }
+
+    float parsed = 0;
+
+    if (!ParseValue(*pVar, value, parsed))
+    {
+        sprintf(g_String, "invalid value of the cvar %s: %s", pVar->name_, value);
+        LogErr(g_String);
+        return false;
+    }
+
+    SetFloat(pVar, parsed);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void CVarRegistry::SetFloat(CVar* pVar, const float value)
+{
+    if (!pVar)
+        return;
+
+    const float clamped = Clamp(*pVar, value);
+
+    // a later change of the same cvar replaces the queued one
+    for (Change& change : changes_)
+    {
+        if (change.pVar == pVar)
+        {
+            change.value = clamped;
+            return;
+        }
+    }
+
+    changes_.push_back({ pVar, clamped });
+}
+
+///////////////////////////////////////////////////////////
+
+void CVarRegistry::SetDefault(CVar* pVar)
+{
+    if (pVar)
+        SetFloat(pVar, pVar->default_);
+}
+
+///////////////////////////////////////////////////////////
+
+void CVarRegistry::ApplyChanges()
+{
+    // a callback can queue new changes so we apply only the current ones
+    const vsize numChanges = changes_.size();
+
+    for (vsize i = 0; i < numChanges; ++i)
+    {
+        CVar& var = *changes_[i].pVar;
+
+        if (var.value_ == changes_[i].value)
+            continue;
+
+        var.value_ = changes_[i].value;
+
+        char valueStr[32];
+        var.ToStr(valueStr, sizeof(valueStr));
+        LogMsgf("cvar %s = %s", var.name_, valueStr);
+
+        if (var.onChange_)
+            var.onChange_(var);
+    }
+
+    for (vsize i = numChanges; i < changes_.size(); ++i)
+        changes_[i - numChanges] = changes_[i];
+
+    changes_.resize(changes_.size() - numChanges);
+}
+
+///////////////////////////////////////////////////////////
+
+bool CVarRegistry::Execute(const char* cmd)
+{
+    char name[64]{ '\0' };
+    char value[64]{ '\0' };
+
+    if (!cmd || (sscanf(cmd, "%63s %63s", name, value) < 1))
+        return false;
+
+    // list cvars (by a filter)
+    if (CompareNoCase(name, "list") == 0)
+    {
+        char valueStr[32];
+
+        for (const CVar* pVar : vars_)
+        {
+            if (!ContainsNoCase(pVar->name_, value))
+                continue;
+
+            pVar->ToStr(valueStr, sizeof(valueStr));
+            LogMsgf("%s = %s  (%s)", pVar->name_, valueStr, pVar->desc_);
+        }
+        return true;
+    }
+
+    // log the current value
+    if (value[0] == '\0')
+    {
+        const CVar* pVar = Find(name);
+
+        if (!pVar)
+        {
+            sprintf(g_String, "there is no cvar: %s", name);
+            LogErr(g_String);
+            return false;
+        }
+
+        char valueStr[32];
+        pVar->ToStr(valueStr, sizeof(valueStr));
+        LogMsgf("%s = %s  (%s)", pVar->name_, valueStr, pVar->desc_);
+        return true;
+    }
+
+    return Set(name, value);
+}
+
+///////////////////////////////////////////////////////////
+
+void CVarRegistry::ParseCmdLine(const int argc, char* argv[])
+{
+    // arguments: +NAME=value (other args are skipped)
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* eq  = strchr(arg, '=');
+
+        if ((arg[0] != '+') || !eq || (eq == arg + 1))
+            continue;
+
+        Override ovr;
+        const size_t nameLen = std::min((size_t)(eq - arg - 1), sizeof(ovr.name) - 1);
+
+        strncpy(ovr.name, arg + 1, nameLen);
+        strncpy(ovr.value, eq + 1, sizeof(ovr.value) - 1);
+        overrides_.push_back(ovr);
+    }
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+CVar* CVarRegistry::Register(
+    const char* name,
+    const eCVarType type,
+    const float value,
+    const float minValue,
+    const float maxValue,
+    const char* desc,
+    CVar::OnChange&& onChange)
+{
+    if (!name || (name[0] == '\0'))
+    {
+        LogErr("input name of the cvar is empty");
+        return nullptr;
+    }
+
+    if (Find(name))
+    {
+        sprintf(g_String, "the cvar is already registered: %s", name);
+        LogErr(g_String);
+        return nullptr;
+    }
+
+    CVar* pVar      = new CVar();
+    pVar->name_     = name;
+    pVar->desc_     = (desc) ? desc : "";
+    pVar->type_     = type;
+    pVar->min_      = minValue;
+    pVar->max_      = maxValue;
+    pVar->value_    = Clamp(*pVar, value);
+    pVar->default_  = pVar->value_;
+    pVar->onChange_ = std::move(onChange);
+
+    // keep the names sorted
+    vsize idx = 0;
+    while ((idx < vars_.size()) && (CompareNoCase(vars_[idx]->name_, name) < 0))
+        ++idx;
+
+    vars_.insert_before(idx, pVar);
+
+    // the command line overrides the initial value (the subsystem gets it by the callback)
+    for (const Override& ovr : overrides_)
+    {
+        float parsed = 0;
+
+        if ((CompareNoCase(ovr.name, name) == 0) && ParseValue(*pVar, ovr.value, parsed))
+        {
+            pVar->value_ = Clamp(*pVar, parsed);
+
+            if (pVar->onChange_)
+                pVar->onChange_(*pVar);
+
+            LogMsgf("cvar %s is overridden by the command line: %s", name, ovr.value);
+        }
+    }
+
+    return pVar;
+}
+
+///////////////////////////////////////////////////////////
+
+bool CVarRegistry::ParseValue(const CVar& var, const char* str, float& outValue) const
+{
+    if (!str || (str[0] == '\0'))
+        return false;
+
+    if (var.type_ == CVAR_BOOL)
+    {
+        if ((CompareNoCase(str, "true") == 0) || (CompareNoCase(str, "on") == 0) || (strcmp(str, "1") == 0))
+        {
+            outValue = 1.0f;
+            return true;
+        }
+        if ((CompareNoCase(str, "false") == 0) || (CompareNoCase(str, "off") == 0) || (strcmp(str, "0") == 0))
+        {
+            outValue = 0.0f;
+            return true;
+        }
+        return false;
+    }
+
+    char* end = nullptr;
+    const float value = (var.type_ == CVAR_INT) ? (float)strtol(str, &end, 10) : strtof(str, &end);
+
+    if (!end || (*end != '\0'))
+        return false;
+
+    outValue = value;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+float CVarRegistry::Clamp(const CVar& var, const float value) const
+{
+    // min == max: the range isn't limited
+    float clamped = value;
+
+    if (var.min_ < var.max_)
+        clamped = (value < var.min_) ? var.min_ : (value > var.max_) ? var.max_ : value;
+
+    return (var.type_ == CVAR_FLOAT) ? clamped : (float)(int)clamped;
+}
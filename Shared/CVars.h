@@ -0,0 +1,140 @@
+// =================================================================================
+// Filename:     CVars.h
+// Description:  a registry of typed console variables (bool, int, float) which
+//               are changed at runtime (by the editor console or the command
+//               line) without a restart:
+//
+//               - a subsystem registers its knob with the initial value (usually
+//                 from settings.txt and by the same key) and a change callback
+//                 which copies the new value into the subsystem;
+//               - a new value is only queued by Set(); callbacks are called by
+//                 ApplyChanges() at the start of a frame when the render thread
+//                 is synced (so the subsystems don't need locks);
+//               - "+NAME=value" args of the command line override values of
+//                 cvars when they are registered
+//
+//               NOTE: names and descriptions must be string literals (or live
+//                     forever) since only pointers to them are stored;
+//                     the registry is used only by the main thread
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Types.h"
+#include "cvector.h"
+#include <functional>
+
+
+enum eCVarType : uint8
+{
+    CVAR_BOOL,
+    CVAR_INT,
+    CVAR_FLOAT,
+};
+
+///////////////////////////////////////////////////////////
+
+class CVar
+{
+public:
+    using OnChange = std::function<void(const CVar&)>;
+
+    inline const char* GetName()  const { return name_; }
+    inline const char* GetDesc()  const { return desc_; }
+    inline eCVarType   GetType()  const { return type_; }
+
+    inline bool        GetBool()  const { return value_ != 0.0f; }
+    inline int         GetInt()   const { return (int)value_; }
+    inline float       GetFloat() const { return value_; }
+    inline float       GetMin()   const { return min_; }
+    inline float       GetMax()   const { return max_; }
+    inline float       GetDefault() const { return default_; }
+
+    // the value as a string ("true", "12", "0.5")
+    void ToStr(char* outStr, const size_t bufSize) const;
+
+private:
+    friend class CVarRegistry;
+
+    const char* name_    = nullptr;
+    const char* desc_    = nullptr;
+    eCVarType   type_    = CVAR_BOOL;
+    float       value_   = 0;         // ints are stored as floats as well (exact till 2^24)
+    float       default_ = 0;
+    float       min_     = 0;
+    float       max_     = 0;
+    OnChange    onChange_;
+};
+
+///////////////////////////////////////////////////////////
+
+class CVarRegistry
+{
+public:
+    CVarRegistry() {}
+    ~CVarRegistry();
+
+    // restrict copying
+    CVarRegistry(const CVarRegistry&) = delete;
+    CVarRegistry& operator=(const CVarRegistry&) = delete;
+
+    // register a knob (ret: nullptr if there is already a cvar by such a name);
+    // onChange is called only when the value is changed
+    CVar* RegisterBool (const char* name, const bool value, const char* desc, CVar::OnChange&& onChange);
+    CVar* RegisterInt  (const char* name, const int value, const int minValue, const int maxValue, const char* desc, CVar::OnChange&& onChange);
+    CVar* RegisterFloat(const char* name, const float value, const float minValue, const float maxValue, const char* desc, CVar::OnChange&& onChange);
+
+    // remove all the cvars (their callbacks can refer to subsystems which are destroyed)
+    void  Clear();
+
+    // search by a name (it isn't case-sensitive)
+    CVar* Find(const char* name) const;
+
+    // queue a new value (is clamped by the range of the cvar); ret: false if
+    // there is no such a cvar or the value can't be parsed
+    bool  Set     (const char* name, const char* value);
+    void  SetFloat(CVar* pVar, const float value);
+    void  SetDefault(CVar* pVar);
+
+    // call callbacks of the queued changes
+    inline bool HasChanges() const { return !changes_.empty(); }
+    void  ApplyChanges();
+
+    // execute a console command: "NAME value" sets the cvar, "NAME" logs its
+    // value, "list [filter]" logs cvars which names contain the filter
+    bool  Execute(const char* cmd);
+
+    // store "+NAME=value" args till their cvars are registered
+    void  ParseCmdLine(const int argc, char* argv[]);
+
+    inline const cvector<CVar*>& GetAll() const { return vars_; }
+
+private:
+    struct Change
+    {
+        CVar* pVar  = nullptr;
+        float value = 0;
+    };
+
+    struct Override
+    {
+        char name[64]{ '\0' };
+        char value[32]{ '\0' };
+    };
+
+    CVar* Register(const char* name, const eCVarType type, const float value, const float minValue, const float maxValue, const char* desc, CVar::OnChange&& onChange);
+    bool  ParseValue(const CVar& var, const char* str, float& outValue) const;
+    float Clamp(const CVar& var, const float value) const;
+
+private:
+    cvector<CVar*>    vars_;               // sorted by names
+    cvector<Change>   changes_;
+    cvector<Override> overrides_;          // of the command line
+};
+
+
+// =================================================================================
+// a global instance of the registry
+// =================================================================================
+extern CVarRegistry g_CVars;
@@ -0,0 +1,348 @@
+// =================================================================================
+// Filename:     FileSystem.cpp
+// Description:  implementation of the virtual file system (mounted asset packs)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "FileSystem.h"
+#include "FileSystemPaths.h"
+#include "AssetPack.h"
+#include "JobSystem.h"
+#include "MemHelpers.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+#pragma warning (disable : 4996)
+
+namespace fs = std::filesystem;
+
+
+// mounted packs: the last mounted is searched first
+static std::vector<AssetPack*> s_Packs;
+static std::once_flag          s_DefaultPacksFlag;
+
+// packed files which are read by a single job (in order of their offsets)
+static constexpr int READS_PER_JOB = 16;
+
+
+//---------------------------------------------------------
+// Desc:  mount all the packs of the directory (if there is any)
+//---------------------------------------------------------
+static void MountDir(const char* dirPath)
+{
+    std::error_code error;
+
+    if (!dirPath || !fs::is_directory(dirPath, error))
+        return;
+
+    std::vector<std::string> packPaths;
+
+    for (const fs::directory_entry& entry : fs::directory_iterator(dirPath, error))
+    {
+        if (entry.is_regular_file(error) && (entry.path().extension() == ".dpak"))
+            packPaths.push_back(entry.path().generic_string());
+    }
+
+    // the order of mounting doesn't depend on the order of the dir listing
+    std::sort(packPaths.begin(), packPaths.end());
+
+    for (const std::string& packPath : packPaths)
+    {
+        AssetPack* pPack = new AssetPack();
+
+        if (!pPack->Open(packPath.c_str()))
+        {
+            delete pPack;
+            continue;
+        }
+
+        LogMsgf("mounted asset pack: %s (%d files)", packPath.c_str(), pPack->GetNumEntries());
+        s_Packs.push_back(pPack);
+    }
+}
+
+//---------------------------------------------------------
+// Desc:  packs of the default dir are mounted once on the first access to files
+//        (settings and configs can be read before any explicit mounting)
+//---------------------------------------------------------
+static void MountDefaultPacks()
+{
+    std::call_once(s_DefaultPacksFlag, []() { MountDir(g_RelPathPacksDir); });
+}
+
+//---------------------------------------------------------
+// Desc:  find a pack and an entry of the file
+//---------------------------------------------------------
+static AssetPack* FindPacked(const char* filePath, index& outEntryIdx)
+{
+    if (!filePath || filePath[0] == '\0')
+        return nullptr;
+
+    MountDefaultPacks();
+
+    for (auto it = s_Packs.rbegin(); it != s_Packs.rend(); ++it)
+    {
+        const index entryIdx = (*it)->Find(filePath);
+
+        if (entryIdx >= 0)
+        {
+            outEntryIdx = entryIdx;
+            return *it;
+        }
+    }
+
+    return nullptr;
+}
+
+//---------------------------------------------------------
+// Desc:  read the whole file from disk into a new[] buffer
+//---------------------------------------------------------
+static bool ReadDiskFile(const char* filePath, uint8*& outData, size_t& outSize)
+{
+    FILE* pFile = fopen(filePath, "rb");
+    if (!pFile)
+        return false;
+
+    fseek(pFile, 0, SEEK_END);
+    const long fileSize = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    if (fileSize < 0)
+    {
+        fclose(pFile);
+        return false;
+    }
+
+    outData = new uint8[fileSize + 1];
+    outSize = (size_t)fileSize;
+
+    const size_t numRead = fread(outData, 1, outSize, pFile);
+    fclose(pFile);
+
+    if (numRead != outSize)
+    {
+        SafeDeleteArr(outData);
+        outSize = 0;
+        return false;
+    }
+
+    outData[outSize] = '\0';
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:  unpack the entry into a new[] buffer
+//---------------------------------------------------------
+static bool ReadPackedFile(const AssetPack& pack, const index entryIdx, uint8*& outData, size_t& outSize)
+{
+    const AssetPackEntry& entry = pack.GetEntry(entryIdx);
+
+    outData = new uint8[entry.size + 1];
+    outSize = entry.size;
+
+    if (!pack.Read(entryIdx, outData))
+    {
+        SafeDeleteArr(outData);
+        outSize = 0;
+        return false;
+    }
+
+    outData[outSize] = '\0';
+    return true;
+}
+
+
+// =================================================================================
+// Public API
+// =================================================================================
+bool FileSys::MountPack(const char* packPath)
+{
+    MountDefaultPacks();
+
+    AssetPack* pPack = new AssetPack();
+
+    if (!pPack->Open(packPath))
+    {
+        delete pPack;
+        return false;
+    }
+
+    s_Packs.push_back(pPack);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void FileSys::MountPacksDir(const char* dirPath)
+{
+    MountDefaultPacks();
+    MountDir(dirPath);
+}
+
+///////////////////////////////////////////////////////////
+
+void FileSys::UnmountPacks()
+{
+    MountDefaultPacks();
+
+    for (AssetPack* pPack : s_Packs)
+        delete pPack;
+
+    s_Packs.clear();
+}
+
+///////////////////////////////////////////////////////////
+
+int FileSys::GetNumMountedPacks()
+{
+    MountDefaultPacks();
+    return (int)s_Packs.size();
+}
+
+///////////////////////////////////////////////////////////
+
+bool FileSys::IsPacked(const char* filePath)
+{
+    index entryIdx = -1;
+    return FindPacked(filePath, entryIdx) != nullptr;
+}
+
+///////////////////////////////////////////////////////////
+
+const AssetPack* FileSys::FindPack(const char* filePath, index& outEntryIdx)
+{
+    outEntryIdx = -1;
+    return FindPacked(filePath, outEntryIdx);
+}
+
+///////////////////////////////////////////////////////////
+
+bool FileSys::GetPackedView(const char* filePath, const uint8*& outData, size_t& outSize)
+{
+    index            entryIdx = -1;
+    const AssetPack* pPack    = FindPacked(filePath, entryIdx);
+
+    if (!pPack)
+        return false;
+
+    const uint8* pView = pPack->GetView(entryIdx);
+
+    if (!pView)
+        return false;
+
+    outData = pView;
+    outSize = pPack->GetEntry(entryIdx).size;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool FileSys::ReadFile(const char* filePath, uint8*& outData, size_t& outSize)
+{
+    // NOTE: it can be executed by worker threads so g_String isn't used here
+
+    char             msg[320]{ '\0' };
+    index            entryIdx = -1;
+    const AssetPack* pPack    = FindPacked(filePath, entryIdx);
+
+    outData = nullptr;
+    outSize = 0;
+
+    if (pPack)
+    {
+        if (ReadPackedFile(*pPack, entryIdx, outData, outSize))
+            return true;
+
+        snprintf(msg, sizeof(msg), "can't unpack a file: %s (pack: %s)", filePath, pPack->GetPath());
+        LogErr(msg);
+        return false;
+    }
+
+    if (!ReadDiskFile(filePath, outData, outSize))
+    {
+        snprintf(msg, sizeof(msg), "can't read a file: %s", (filePath) ? filePath : "");
+        LogErr(msg);
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void FileSys::ReadFilesAsync(FileReadRequest* requests, const int numRequests, JobCounter* pCounter)
+{
+    if (!requests || (numRequests <= 0))
+        return;
+
+    struct PackedRead
+    {
+        const AssetPack* pPack;
+        index            entryIdx;
+        int              requestIdx;
+    };
+
+    std::vector<PackedRead> packedReads;
+    packedReads.reserve(numRequests);
+
+    for (int i = 0; i < numRequests; ++i)
+    {
+        index            entryIdx = -1;
+        const AssetPack* pPack    = FindPacked(requests[i].path, entryIdx);
+
+        if (pPack)
+        {
+            packedReads.push_back({ pPack, entryIdx, i });
+            continue;
+        }
+
+        // a file on disk is read by a separate job
+        FileReadRequest* pRequest = requests + i;
+
+        g_JobSystem.Run([pRequest]()
+        {
+            pRequest->isRead = ReadFile(pRequest->path, pRequest->data, pRequest->size);
+        }, pCounter);
+    }
+
+    // read packed files in order of their position in packs (sequential I/O)
+    std::sort(packedReads.begin(), packedReads.end(), [](const PackedRead& a, const PackedRead& b)
+    {
+        if (a.pPack != b.pPack)
+            return a.pPack < b.pPack;
+
+        return a.pPack->GetEntry(a.entryIdx).offset < b.pPack->GetEntry(b.entryIdx).offset;
+    });
+
+    // a single prefetch request per pack: the OS reads all the ranges in the background
+    std::vector<index> entryIdxs;
+
+    for (size_t i = 0; i < packedReads.size();)
+    {
+        const AssetPack* pPack = packedReads[i].pPack;
+        entryIdxs.clear();
+
+        for (; (i < packedReads.size()) && (packedReads[i].pPack == pPack); ++i)
+            entryIdxs.push_back(packedReads[i].entryIdx);
+
+        pPack->Prefetch(entryIdxs.data(), (int)entryIdxs.size());
+    }
+
+    for (size_t start = 0; start < packedReads.size(); start += READS_PER_JOB)
+    {
+        const size_t end = std::min(start + READS_PER_JOB, packedReads.size());
+        std::vector<PackedRead> batch(packedReads.begin() + start, packedReads.begin() + end);
+
+        g_JobSystem.Run([batch = std::move(batch), requests]()
+        {
+            for (const PackedRead& read : batch)
+            {
+                FileReadRequest& request = requests[read.requestIdx];
+                request.isRead = ReadPackedFile(*read.pPack, read.entryIdx, request.data, request.size);
+            }
+        }, pCounter);
+    }
+}
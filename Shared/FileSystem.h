@@ -1,20 +1,66 @@
 // *********************************************************************************
 // Filename:     Filesystem.h
-// Description:  utils for working with files paths
+// Description:  utils for working with files paths;
+//               a virtual file system: files are looked for in mounted asset
+//               packs (see AssetPack.h) first and then on disk
 // 
 // Created:      17.04.2025 by DimaSkup
 // *********************************************************************************
 #pragma once
 
 #include "log.h"
+#include "Types.h"
 #include <string.h>
 
 
+struct JobCounter;
+class AssetPack;
+
+///////////////////////////////////////////////////////////
+
+struct FileReadRequest
+{
+    char   path[256]{ '\0' };
+    uint8* data   = nullptr;         // allocated by new[]: the owner releases it by SafeDeleteArr
+    size_t size   = 0;
+    bool   isRead = false;
+};
+
+///////////////////////////////////////////////////////////
 
 class FileSys
 {
 public:
 
+    // ----------------------------------------------------
+    // virtual file system (mounted packs are searched from the last mounted one);
+    // NOTE: (un)mount packs when no files are read by other threads
+    // ----------------------------------------------------
+    static bool MountPack    (const char* packPath);
+    static void MountPacksDir(const char* dirPath);
+    static void UnmountPacks ();
+    static int  GetNumMountedPacks();
+
+    // check if the file is stored in mounted packs
+    static bool IsPacked(const char* filePath);
+
+    // get a pack and an idx of the entry of the file (nullptr if the file isn't packed)
+    static const AssetPack* FindPack(const char* filePath, index& outEntryIdx);
+
+    // get an uncompressed packed file in place (no copying);
+    // returns false if the file isn't packed or it is compressed
+    static bool GetPackedView(const char* filePath, const uint8*& outData, size_t& outSize);
+
+    // read (or unpack) the whole file from packs or from disk into a new[] buffer
+    // (there is an extra '\0' after the data so a text can be parsed in place)
+    static bool ReadFile(const char* filePath, uint8*& outData, size_t& outSize);
+
+    // read the files by jobs: packed files are prefetched by one request per pack
+    // and read in order of their offsets; pCounter is a fence for all the reads
+    static void ReadFilesAsync(FileReadRequest* requests, const int numRequests, JobCounter* pCounter);
+
+    ///////////////////////////////////////////////////////////
+
     inline static bool Exists(const char* filePath)
     {
         // check if file by filePath (relatively to the working directory) exists
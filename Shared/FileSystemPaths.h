@@ -15,6 +15,11 @@ static const char* g_RelPathShadersDir      = "data/shaders/";
 static const char* g_RelPathTexDir          = "data/textures/";
 static const char* g_RelPathUIDataDir       = "data/ui/";
 static const char* g_RelPathAudioDir        = "data/audio/";
+static const char* g_RelPathPacksDir        = "data/packs/";           // asset packs (are mounted on the first access to files)
+static const char* g_RelPathScenesDir       = "data/scenes/";
+static const char* g_RelPathSceneFile       = "data/scenes/main.dewf"; // entities of the scene as a single world file (an older way of saving)
+static const char* g_RelPathSceneDir        = "data/scenes/main/";     // entities of the scene as a world directory (is saved by the editor, is loaded at startup)
+static const char* g_RelPathBakedDir        = "data/baked/";           // baked data of the scene (e.g. the volume of static lights)
 
 // full paths from the sys root
 //static const std::string g_BuildDir(BUILD_DIR);
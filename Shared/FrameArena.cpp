@@ -0,0 +1,115 @@
+// =================================================================================
+// Filename:     FrameArena.cpp
+// Description:  implementation of the LinearArena's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "FrameArena.h"
+#include "log.h"
+
+
+LinearArena::~LinearArena()
+{
+    FreeOverflowBlocks();
+
+    if (pMem_)
+        CvectorHeapAllocator::Free(pMem_);
+}
+
+///////////////////////////////////////////////////////////
+
+void LinearArena::Reset()
+{
+    const size_t usedBytes = GetUsedBytes();
+
+    if (peakBytes_ < usedBytes)
+        peakBytes_ = usedBytes;
+
+    // memory ran out during the prev frame so grow the main block to fit all the data
+    if (!overflowBlocks_.empty())
+    {
+        FreeOverflowBlocks();
+        Reserve(peakBytes_ + (peakBytes_ >> 1));
+    }
+
+    offset_.store(0, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////
+
+void LinearArena::Reserve(const size_t capacity)
+{
+    // NOTE: all the previous allocations from the main block become invalid
+
+    if (capacity <= capacity_)
+        return;
+
+    // round up to the alignment so each aligned offset stays inside the block
+    const size_t newCapacity = (capacity + MIN_ALIGNMENT - 1) & ~(MIN_ALIGNMENT - 1);
+    uint8* pMem = (uint8*)CvectorHeapAllocator::Allocate(newCapacity, MIN_ALIGNMENT);
+
+    if (!pMem)
+    {
+        LogErr("can't allocate memory for the linear arena");
+        throw std::bad_alloc{};
+    }
+
+    if (pMem_)
+        CvectorHeapAllocator::Free(pMem_);
+
+    pMem_     = pMem;
+    capacity_ = newCapacity;
+    offset_.store(0, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////
+
+void* LinearArena::AllocBytes(const size_t numBytes, const size_t alignment)
+{
+    size_t offset = offset_.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        const size_t alignedOffset = (offset + alignment - 1) & ~(alignment - 1);
+        const size_t newOffset     = alignedOffset + numBytes;
+
+        // the main block is out of memory
+        if (newOffset > capacity_)
+            return AllocOverflow(numBytes, alignment);
+
+        if (offset_.compare_exchange_weak(offset, newOffset, std::memory_order_relaxed))
+            return pMem_ + alignedOffset;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void* LinearArena::AllocOverflow(const size_t numBytes, const size_t alignment)
+{
+    // a rare case: allocate a separate block (it lives until the next reset)
+
+    void* ptr = CvectorHeapAllocator::Allocate(numBytes, alignment);
+
+    if (!ptr)
+    {
+        LogErr("can't allocate memory for the linear arena");
+        throw std::bad_alloc{};
+    }
+
+    std::lock_guard<std::mutex> lock(overflowMutex_);
+    overflowBlocks_.push_back(ptr);
+    overflowBytes_ += numBytes + alignment;
+
+    return ptr;
+}
+
+///////////////////////////////////////////////////////////
+
+void LinearArena::FreeOverflowBlocks()
+{
+    for (void* ptr : overflowBlocks_)
+        CvectorHeapAllocator::Free(ptr);
+
+    overflowBlocks_.clear();
+    overflowBytes_ = 0;
+}
@@ -0,0 +1,142 @@
+// =================================================================================
+// Filename:     FrameArena.h
+// Description:  linear (bump) allocators for transient per-frame data:
+//
+//               - LinearArena hands out typed spans from a single memory block;
+//                 an allocation is just an atomic bump of offset, so it is cheap
+//                 and can be done from several threads at once;
+//               - if the block is out of memory we allocate an overflow block
+//                 so allocation never fails; at the next Reset() the main block
+//                 grows to the peak usage so in the steady state there are
+//                 no heap allocations at all;
+//               - FrameArena is a pair of linear arenas (double buffering):
+//                 data of the previous frame stays valid during the current one
+//
+//               NOTE: only trivially destructible types (no destructors are called)
+//               NOTE: spans are valid until the Reset() of their arena
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Types.h"
+#include "cvector.h"
+
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+
+
+// =================================================================================
+// TYPED SPAN OF ARENA MEMORY
+// =================================================================================
+template <typename T>
+struct ArenaSpan
+{
+    inline       T& operator[](index i)       { return data_[i]; }
+    inline const T& operator[](index i) const { return data_[i]; }
+
+    inline T*       begin()       { return data_; }
+    inline const T* begin() const { return data_; }
+    inline T*       end()         { return data_ + size_; }
+    inline const T* end()   const { return data_ + size_; }
+
+    inline T*       data()  const { return data_; }
+    inline vsize    size()  const { return size_; }
+    inline bool     empty() const { return size_ == 0; }
+
+    T*    data_ = nullptr;
+    vsize size_ = 0;
+};
+
+// =================================================================================
+// LINEAR ARENA
+// =================================================================================
+class LinearArena
+{
+public:
+    // all the allocations are aligned at least to 16 bytes (so SIMD types are safe)
+    static constexpr size_t MIN_ALIGNMENT = 16;
+
+    LinearArena() {}
+    explicit LinearArena(const size_t capacity) { Reserve(capacity); }
+    ~LinearArena();
+
+    // restrict copying
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    // get a span of numElems elements (memory isn't initialized);
+    // can be called from several threads at once
+    template <typename T>
+    ArenaSpan<T> Alloc(const vsize numElems)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "arena can store only trivially destructible types");
+
+        if (numElems <= 0)
+            return ArenaSpan<T>();
+
+        const size_t alignment = (alignof(T) > MIN_ALIGNMENT) ? alignof(T) : MIN_ALIGNMENT;
+        void* ptr = AllocBytes(sizeof(T) * numElems, alignment);
+
+        return ArenaSpan<T>{ (T*)ptr, numElems };
+    }
+
+    // release all the allocations at once (and grow the main block if we had any overflow);
+    // NOTE: must not be called while other threads allocate from this arena
+    void Reset();
+
+    // grow the main block to have at least this number of bytes
+    void Reserve(const size_t capacity);
+
+    inline size_t GetCapacity()  const { return capacity_; }
+    inline size_t GetUsedBytes() const { return offset_.load(std::memory_order_relaxed) + overflowBytes_; }
+    inline size_t GetPeakBytes() const { return peakBytes_; }
+
+private:
+    void* AllocBytes(const size_t numBytes, const size_t alignment);
+    void* AllocOverflow(const size_t numBytes, const size_t alignment);
+    void  FreeOverflowBlocks();
+
+private:
+    uint8*              pMem_     = nullptr;    // main memory block
+    size_t              capacity_ = 0;
+    std::atomic<size_t> offset_   = 0;          // bump offset into the main block
+
+    // if the main block is out of memory we allocate separate blocks
+    std::mutex          overflowMutex_;
+    cvector<void*>      overflowBlocks_;
+    size_t              overflowBytes_ = 0;
+
+    size_t              peakBytes_ = 0;         // max usage between two resets
+};
+
+// =================================================================================
+// DOUBLE-BUFFERED FRAME ARENA
+// =================================================================================
+class FrameArena
+{
+public:
+    explicit FrameArena(const size_t capacity = 0)
+    {
+        arenas_[0].Reserve(capacity);
+        arenas_[1].Reserve(capacity);
+    }
+
+    // switch to another arena and release its allocations (which were made two frames ago)
+    inline void BeginFrame()
+    {
+        currIdx_ ^= 1;
+        arenas_[currIdx_].Reset();
+    }
+
+    template <typename T>
+    inline ArenaSpan<T> Alloc(const vsize numElems) { return arenas_[currIdx_].Alloc<T>(numElems); }
+
+    inline LinearArena&       GetCurr()       { return arenas_[currIdx_]; }
+    inline const LinearArena& GetPrev() const { return arenas_[currIdx_ ^ 1]; }
+
+private:
+    LinearArena arenas_[2];
+    int         currIdx_ = 0;
+};
@@ -0,0 +1,371 @@
+// =================================================================================
+// Filename:     HitchRecorder.cpp
+// Description:  implementation of the HitchRecorder's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "HitchRecorder.h"
+#include "Profiler.h"
+#include "MemTracker.h"
+#include "log.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string.h>
+#include <time.h>
+
+#pragma warning (disable : 4996)
+
+
+// a global instance of the recorder
+HitchRecorder g_HitchRecorder;
+
+// pseudo threads of the trace for data which isn't CPU zones
+static constexpr uint32 TID_FRAMES = 1000;
+static constexpr uint32 TID_EVENTS = 1001;
+
+
+//---------------------------------------------------------
+// Desc:  write the string into the file as a JSON string (with quotes)
+//---------------------------------------------------------
+static void WriteJsonStr(FILE* pFile, const char* str)
+{
+    fputc('"', pFile);
+
+    for (const char* ch = (str) ? str : ""; *ch; ++ch)
+    {
+        if (*ch == '"' || *ch == '\\')
+            fputc('\\', pFile);
+
+        fputc(*ch, pFile);
+    }
+
+    fputc('"', pFile);
+}
+
+//---------------------------------------------------------
+// Desc:  the number of allocations by all the memory tags since the start
+//---------------------------------------------------------
+static uint64 GetTotalNumAllocs()
+{
+    uint64 numAllocs = 0;
+
+    for (int tag = 0; tag < NUM_MEM_TAGS; ++tag)
+        numAllocs += g_MemTracker.GetNumAllocs(eMemTag(tag));
+
+    return numAllocs;
+}
+
+///////////////////////////////////////////////////////////
+
+void HitchRecorder::SetEnabled(const bool enabled)
+{
+    if (isEnabled_ == enabled)
+        return;
+
+    isEnabled_      = enabled;
+    numFrames_      = 0;
+    frameBegin_     = 0;
+    isHitchPending_ = false;
+    cooldownLeft_   = 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    numGpuFrames_ = 0;
+    numEvents_    = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+void HitchRecorder::SetConfig(const Config& config)
+{
+    config_ = config;
+
+    // the dump window must fit into the ring
+    const int maxBefore = MAX_FRAMES - 1 - std::max(0, config_.numFramesAfter);
+
+    config_.numFramesAfter  = std::clamp(config_.numFramesAfter,  0, MAX_FRAMES - 1);
+    config_.numFramesBefore = std::clamp(config_.numFramesBefore, 0, std::max(0, maxBefore));
+    config_.thresholdRatio  = std::max(1.0f, config_.thresholdRatio);
+    config_.dumpDir[sizeof(config_.dumpDir) - 1] = '\0';
+}
+
+///////////////////////////////////////////////////////////
+
+void HitchRecorder::BeginFrame()
+{
+    if (!isEnabled_)
+        return;
+
+    const int64_t now       = CpuProfiler::GetTicks();
+    const uint64  numAllocs = GetTotalNumAllocs();
+
+    if (frameBegin_ == 0)
+    {
+        frameBegin_    = now;
+        prevNumAllocs_ = numAllocs;
+        return;
+    }
+
+    // close the prev frame
+    Frame& frame    = frames_[numFrames_ % MAX_FRAMES];
+    frame.begin     = frameBegin_;
+    frame.end       = now;
+    frame.numAllocs = numAllocs - prevNumAllocs_;
+    frame.heapBytes = g_MemTracker.GetTotal();
+    frame.isHitch   = false;
+
+    const uint32 frameIdx = numFrames_++;
+    frameBegin_    = now;
+    prevNumAllocs_ = numAllocs;
+
+    if (cooldownLeft_ > 0)
+    {
+        --cooldownLeft_;
+    }
+    else if (IsHitch((float)CpuProfiler::TicksToMs(frame.end - frame.begin)))
+    {
+        frame.isHitch = true;
+
+        // the window is started by the first hitch (next ones are inside of it)
+        if (!isHitchPending_)
+        {
+            isHitchPending_ = true;
+            hitchFrame_     = frameIdx;
+        }
+    }
+
+    // wait for frames after the hitch
+    if (!isHitchPending_ || (frameIdx - hitchFrame_ < (uint32)config_.numFramesAfter))
+        return;
+
+    const uint32 before = std::min((uint32)config_.numFramesBefore, hitchFrame_);
+    WriteDump(hitchFrame_ - before, frameIdx);
+
+    // the dump itself takes time so the next frames aren't checked for a while
+    isHitchPending_ = false;
+    cooldownLeft_   = config_.cooldownFrames;
+}
+
+///////////////////////////////////////////////////////////
+
+void HitchRecorder::AddGpuFrame(
+    const float frameMs,
+    const float* passTimes,
+    const char* const* passNames,
+    const int numPasses)
+{
+    if (!isEnabled_)
+        return;
+
+    const int64_t now = CpuProfiler::GetTicks();
+    const int     num = std::min(numPasses, MAX_GPU_PASSES);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    GpuFrame& frame = gpuFrames_[numGpuFrames_++ % MAX_FRAMES];
+
+    frame.ticks     = now;
+    frame.frameMs   = frameMs;
+    frame.numPasses = num;
+
+    for (int i = 0; i < num; ++i)
+    {
+        frame.passTimes[i] = passTimes[i];
+        frame.passNames[i] = passNames[i];
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void HitchRecorder::AddEvent(
+    const char* category,
+    const char* name,
+    const int64_t begin,
+    const int64_t end)
+{
+    if (!isEnabled_)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Event& event = events_[numEvents_++ % MAX_EVENTS];
+
+    event.begin    = begin;
+    event.end      = end;
+    event.category = category;
+    strncpy(event.name, (name) ? name : "", MAX_EVENT_NAME - 1);
+    event.name[MAX_EVENT_NAME - 1] = '\0';
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+bool HitchRecorder::IsHitch(const float frameMs) const
+{
+    // compare with the median of the prev frames (the frame itself is already in the ring)
+    const uint32 numPrev = std::min(numFrames_ - 1, (uint32)MEDIAN_WINDOW);
+
+    if ((frameMs < config_.minHitchMs) || (numPrev < MEDIAN_WINDOW / 4))
+        return false;
+
+    float times[MEDIAN_WINDOW];
+
+    for (uint32 i = 0; i < numPrev; ++i)
+    {
+        const Frame& prev = frames_[(numFrames_ - 2 - i) % MAX_FRAMES];
+        times[i] = (float)CpuProfiler::TicksToMs(prev.end - prev.begin);
+    }
+
+    std::nth_element(times, times + numPrev / 2, times + numPrev);
+
+    return frameMs > times[numPrev / 2] * config_.thresholdRatio;
+}
+
+///////////////////////////////////////////////////////////
+
+void HitchRecorder::WriteDump(const uint32 firstFrame, const uint32 lastFrame)
+{
+    // write frames [firstFrame, lastFrame] with CPU zones, GPU times and
+    // events of their time range as a Chrome trace
+
+    const Frame&  hitch   = frames_[hitchFrame_ % MAX_FRAMES];
+    const int64_t begin   = frames_[firstFrame % MAX_FRAMES].begin;
+    const int64_t end     = frames_[lastFrame  % MAX_FRAMES].end;
+    const double  hitchMs = CpuProfiler::TicksToMs(hitch.end - hitch.begin);
+
+    using period = std::chrono::steady_clock::period;
+    const double ticksToUs = 1e6 * (double)period::num / (double)period::den;
+
+    // the file is named by the local time and the duration of the hitch
+    const time_t currTime = time(nullptr);
+    char         timeStr[32]{ '\0' };
+    char         path[128]{ '\0' };
+
+    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d_%H-%M-%S", localtime(&currTime));
+    snprintf(path, sizeof(path), "%s/hitch_%s_%dms.json", config_.dumpDir, timeStr, (int)hitchMs);
+
+    std::error_code ec;
+    std::filesystem::create_directories(config_.dumpDir, ec);
+
+    FILE* pFile = fopen(path, "w");
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open the hitch dump for writing: %s", path);
+        LogErr(g_String);
+        return;
+    }
+
+    fprintf(pFile, "{\"traceEvents\":[\n");
+    fprintf(pFile, "{\"ph\":\"M\",\"pid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"engine\"}}");
+    fprintf(pFile, ",\n{\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"frames\"}}", TID_FRAMES);
+    fprintf(pFile, ",\n{\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"asset events\"}}", TID_EVENTS);
+
+    // frames and their allocations
+    for (uint32 i = firstFrame; i <= lastFrame; ++i)
+    {
+        const Frame& frame = frames_[i % MAX_FRAMES];
+        const double ts    = (double)(frame.begin - begin) * ticksToUs;
+
+        fprintf(pFile, ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":\"%s %u\",\"args\":{\"allocs\":%llu}}",
+            TID_FRAMES,
+            ts,
+            (double)(frame.end - frame.begin) * ticksToUs,
+            (frame.isHitch) ? "HITCH" : "frame",
+            i,
+            (unsigned long long)frame.numAllocs);
+
+        fprintf(pFile, ",\n{\"ph\":\"C\",\"pid\":0,\"ts\":%.3f,\"name\":\"memory\",\"args\":{\"allocs\":%llu,\"heap MB\":%.2f}}",
+            ts,
+            (unsigned long long)frame.numAllocs,
+            (double)frame.heapBytes / (1024.0 * 1024.0));
+    }
+
+    // CPU zones of all the threads
+    const uint32 numZones = g_CpuProfiler.WriteTraceEvents(pFile, begin, end);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // GPU times of frames which were read back within the window
+        // (they belong to frames a few frames earlier)
+        const uint32 firstGpu = (numGpuFrames_ > MAX_FRAMES) ? numGpuFrames_ - MAX_FRAMES : 0;
+
+        for (uint32 i = firstGpu; i < numGpuFrames_; ++i)
+        {
+            const GpuFrame& gpu = gpuFrames_[i % MAX_FRAMES];
+
+            if ((gpu.ticks < begin) || (gpu.ticks > end))
+                continue;
+
+            fprintf(pFile, ",\n{\"ph\":\"C\",\"pid\":0,\"ts\":%.3f,\"name\":\"gpu ms\",\"args\":{\"frame\":%.3f",
+                (double)(gpu.ticks - begin) * ticksToUs,
+                gpu.frameMs);
+
+            for (int p = 0; p < gpu.numPasses; ++p)
+            {
+                if (gpu.passTimes[p] <= 0.0f)
+                    continue;
+
+                fputc(',', pFile);
+                WriteJsonStr(pFile, gpu.passNames[p]);
+                fprintf(pFile, ":%.3f", gpu.passTimes[p]);
+            }
+
+            fprintf(pFile, "}}");
+        }
+
+        // asset loads which intersect the window
+        const uint32 firstEvent = (numEvents_ > MAX_EVENTS) ? numEvents_ - MAX_EVENTS : 0;
+
+        for (uint32 i = firstEvent; i < numEvents_; ++i)
+        {
+            const Event& event = events_[i % MAX_EVENTS];
+
+            if ((event.end < begin) || (event.begin > end))
+                continue;
+
+            const int64_t eventBegin = std::max(event.begin, begin);
+
+            if (event.end > event.begin)
+            {
+                fprintf(pFile, ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"cat\":",
+                    TID_EVENTS,
+                    (double)(eventBegin - begin) * ticksToUs,
+                    (double)(event.end - eventBegin) * ticksToUs);
+            }
+            else
+            {
+                fprintf(pFile, ",\n{\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"cat\":",
+                    TID_EVENTS,
+                    (double)(eventBegin - begin) * ticksToUs);
+            }
+
+            WriteJsonStr(pFile, event.category);
+            fprintf(pFile, ",\"name\":");
+            WriteJsonStr(pFile, event.name);
+            fputc('}', pFile);
+        }
+    }
+
+    fprintf(pFile, "\n]}\n");
+    fclose(pFile);
+
+    ++numDumps_;
+    sprintf(g_String, "a hitch of %.1f ms is dumped (frames: %u, zones: %u): %s", hitchMs, lastFrame - firstFrame + 1, numZones, path);
+    LogMsg(g_String);
+}
+
+
+// =================================================================================
+// SCOPED EVENT
+// =================================================================================
+HitchEventScope::HitchEventScope(const char* category, const char* name) :
+    category_(category),
+    name_(name),
+    begin_(CpuProfiler::GetTicks())
+{
+}
+
+HitchEventScope::~HitchEventScope()
+{
+    g_HitchRecorder.AddEvent(category_, name_, begin_, CpuProfiler::GetTicks());
+}
@@ -0,0 +1,151 @@
+// =================================================================================
+// Filename:     HitchRecorder.h
+// Description:  a flight recorder of frame hitches (a performance counterpart
+//               of the crash dump):
+//
+//               - the last MAX_FRAMES frames are kept in rolling buffers: CPU
+//                 time range and allocations of each frame, GPU times of frames
+//                 (when they are read back) and asset load events;
+//               - CPU zones of the frames are kept by the CpuProfiler's rings
+//                 themselves so zone recording costs nothing more;
+//               - a frame which is longer than thresholdRatio * (the moving median)
+//                 (and than the min time) is a hitch: after numFramesAfter more
+//                 frames the window around it is written into the dump directory
+//                 as a Chrome trace JSON (chrome://tracing or ui.perfetto.dev)
+//
+//               NOTE: category names of events must be string literals (or live
+//                     forever) since only pointers to them are stored
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Types.h"
+#include <mutex>
+
+
+class HitchRecorder
+{
+public:
+    static constexpr int MAX_FRAMES      = 128;     // rolling window of frames
+    static constexpr int MAX_GPU_PASSES  = 16;
+    static constexpr int MAX_EVENTS      = 512;
+    static constexpr int MAX_EVENT_NAME  = 96;
+    static constexpr int MEDIAN_WINDOW   = 64;      // the number of frames for the moving median
+
+    struct Config
+    {
+        float thresholdRatio  = 3.0f;               // a hitch: frame time > ratio * median
+        float minHitchMs      = 33.0f;              // frames shorter than it aren't hitches anyway
+        int   numFramesBefore = 60;
+        int   numFramesAfter  = 10;
+        int   cooldownFrames  = 300;                // frames after a dump which aren't checked
+        char  dumpDir[64]     = "hitches";
+    };
+
+public:
+    HitchRecorder() {}
+
+    // restrict copying
+    HitchRecorder(const HitchRecorder&) = delete;
+    HitchRecorder& operator=(const HitchRecorder&) = delete;
+
+    void SetEnabled(const bool enabled);
+    void SetConfig (const Config& config);
+
+    inline bool IsEnabled() const { return isEnabled_; }
+
+    // is called by the main thread at the start of each frame: closes the prev
+    // frame, checks it for a hitch and writes the dump when the window is filled
+    void BeginFrame();
+
+    // GPU times (ms) of a frame which is just read back (from any thread)
+    void AddGpuFrame(
+        const float frameMs,
+        const float* passTimes,
+        const char* const* passNames,
+        const int numPasses);
+
+    // an asset load (or another event) within the time range (ticks of
+    // CpuProfiler::GetTicks); begin == end: an instant event (from any thread)
+    void AddEvent(const char* category, const char* name, const int64_t begin, const int64_t end);
+
+    inline int GetNumDumps() const { return numDumps_; }
+
+private:
+    struct Frame
+    {
+        int64_t begin     = 0;
+        int64_t end       = 0;
+        uint64  numAllocs = 0;                      // allocations during the frame
+        uint64  heapBytes = 0;                      // tracked heap memory at the end of the frame
+        bool    isHitch   = false;
+    };
+
+    struct GpuFrame
+    {
+        int64_t     ticks = 0;                      // when the frame was read back
+        float       frameMs = 0;
+        float       passTimes[MAX_GPU_PASSES]{ 0 };
+        const char* passNames[MAX_GPU_PASSES]{ nullptr };
+        int         numPasses = 0;
+    };
+
+    struct Event
+    {
+        int64_t     begin    = 0;
+        int64_t     end      = 0;
+        const char* category = nullptr;
+        char        name[MAX_EVENT_NAME]{ '\0' };
+    };
+
+    bool IsHitch(const float frameMs) const;
+    void WriteDump(const uint32 firstFrame, const uint32 lastFrame);
+
+private:
+    Config      config_;
+    bool        isEnabled_ = false;
+
+    // frames are written only by the main thread
+    Frame       frames_[MAX_FRAMES];
+    uint32      numFrames_       = 0;               // monotonic (the idx in the ring is % MAX_FRAMES)
+    int64_t     frameBegin_      = 0;
+    uint64      prevNumAllocs_   = 0;
+
+    uint32      hitchFrame_      = 0;               // a detected hitch which waits for frames after it
+    bool        isHitchPending_  = false;
+    int         cooldownLeft_    = 0;
+    int         numDumps_        = 0;
+
+    // GPU frames and events are written by any thread
+    std::mutex  mutex_;
+    GpuFrame    gpuFrames_[MAX_FRAMES];
+    uint32      numGpuFrames_    = 0;
+    Event       events_[MAX_EVENTS];
+    uint32      numEvents_       = 0;
+};
+
+
+// =================================================================================
+// a global instance of the recorder
+// =================================================================================
+extern HitchRecorder g_HitchRecorder;
+
+
+// =================================================================================
+// SCOPED EVENT (e.g. a synchronous asset load)
+// =================================================================================
+class HitchEventScope
+{
+public:
+    HitchEventScope(const char* category, const char* name);
+    ~HitchEventScope();
+
+    HitchEventScope(const HitchEventScope&) = delete;
+    HitchEventScope& operator=(const HitchEventScope&) = delete;
+
+private:
+    const char* category_;
+    const char* name_;
+    int64_t     begin_;
+};
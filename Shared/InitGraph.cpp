@@ -0,0 +1,238 @@
+// =================================================================================
+// Filename:     InitGraph.cpp
+// Description:  implementation of the dependency graph of initialization tasks
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "InitGraph.h"
+#include "StartupTimeline.h"
+#include "EngineException.h"
+#include "log.h"
+
+#pragma warning (disable : 4996)
+
+
+InitGraph::~InitGraph()
+{
+    for (Task*& pTask : tasks_)
+    {
+        delete pTask;
+        pTask = nullptr;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+int InitGraph::AddTask(
+    const char* name,
+    const eInitTaskThread thread,
+    TaskFunc&& func,
+    std::initializer_list<int> deps)
+{
+    char  msg[160]{ '\0' };
+    Task* pTask   = new Task();
+    pTask->name   = (name) ? name : "";
+    pTask->thread = thread;
+    pTask->func   = std::move(func);
+
+    for (const int depIdx : deps)
+    {
+        // a dependency must be added before the task (so there are no cycles)
+        if ((depIdx < 0) || (depIdx >= (int)tasks_.size()))
+        {
+            snprintf(msg, sizeof(msg), "init task '%s': wrong idx of dependency: %d", pTask->name, depIdx);
+            LogErr(msg);
+            continue;
+        }
+
+        if (pTask->numDeps >= MAX_DEPS)
+        {
+            snprintf(msg, sizeof(msg), "init task '%s': too many dependencies (max: %d)", pTask->name, MAX_DEPS);
+            LogErr(msg);
+            break;
+        }
+
+        pTask->deps[pTask->numDeps++] = depIdx;
+    }
+
+    tasks_.push_back(pTask);
+    return (int)tasks_.size() - 1;
+}
+
+///////////////////////////////////////////////////////////
+
+bool InitGraph::Run()
+{
+    char msg[160]{ '\0' };
+    bool isSucceeded = true;
+
+    while (true)
+    {
+        Task*       pReadyTask   = nullptr;        // the first main thread task which can be executed
+        const Task* pBlockedTask = nullptr;        // the first main thread task which waits for its dependencies
+        bool        isProgress   = false;
+        bool        isFinished   = true;
+
+        // jobs are started before a main thread task so they go in parallel with it
+        for (Task* pTask : tasks_)
+        {
+            const int state = pTask->state.load(std::memory_order_acquire);
+
+            if (state == INIT_TASK_RUNNING)
+                isFinished = false;
+
+            if (state != INIT_TASK_PENDING)
+                continue;
+
+            isFinished = false;
+
+            const eTaskState depsState = GetDepsState(*pTask);
+
+            if (depsState == INIT_TASK_FAILED)
+            {
+                snprintf(msg, sizeof(msg), "init task is skipped (some of its dependencies failed): %s", pTask->name);
+                LogErr(msg);
+
+                pTask->state.store(INIT_TASK_SKIPPED, std::memory_order_release);
+                isSucceeded = false;
+                isProgress  = true;
+                continue;
+            }
+
+            if (pTask->thread == INIT_TASK_MAIN_THREAD)
+            {
+                if ((depsState == INIT_TASK_DONE) && !pReadyTask)
+                    pReadyTask = pTask;
+
+                if ((depsState == INIT_TASK_PENDING) && !pBlockedTask)
+                    pBlockedTask = pTask;
+
+                continue;
+            }
+
+            if (depsState == INIT_TASK_DONE)
+            {
+                pTask->state.store(INIT_TASK_RUNNING, std::memory_order_release);
+                g_JobSystem.Run([pTask]() { ExecuteTask(*pTask); }, &pTask->counter);
+                isProgress = true;
+            }
+        }
+
+        // some jobs could be done meanwhile so start from the beginning after it
+        if (pReadyTask)
+        {
+            pReadyTask->state.store(INIT_TASK_RUNNING, std::memory_order_release);
+            ExecuteTask(*pReadyTask);
+            continue;
+        }
+
+        if (isProgress)
+            continue;
+
+        if (isFinished)
+            break;
+
+        // nothing can be started right now: wait for a job which blocks the first
+        // main thread task (or for any running job); the main thread helps with jobs
+        const Task* pRunning = (pBlockedTask) ? FindRunningDep(*pBlockedTask) : nullptr;
+
+        for (index i = 0; !pRunning && (i < tasks_.size()); ++i)
+        {
+            if (tasks_[i]->state.load(std::memory_order_acquire) == INIT_TASK_RUNNING)
+                pRunning = tasks_[i];
+        }
+
+        if (pRunning)
+            g_JobSystem.Wait(pRunning->counter);
+    }
+
+    for (const Task* pTask : tasks_)
+    {
+        if (pTask->state.load(std::memory_order_acquire) != INIT_TASK_DONE)
+            isSucceeded = false;
+    }
+
+    return isSucceeded;
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+void InitGraph::ExecuteTask(Task& task)
+{
+    // NOTE: can be executed by any thread so g_String isn't used here
+
+    bool result = false;
+    {
+        STARTUP_PHASE(task.name);
+
+        try
+        {
+            result = task.func();
+        }
+        catch (EngineException& e)
+        {
+            LogErr(e);
+        }
+        catch (std::exception& e)
+        {
+            LogErr(e.what());
+        }
+    }
+
+    if (!result)
+    {
+        char msg[160]{ '\0' };
+        snprintf(msg, sizeof(msg), "init task is failed: %s", task.name);
+        LogErr(msg);
+    }
+
+    task.state.store((result) ? INIT_TASK_DONE : INIT_TASK_FAILED, std::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////
+
+InitGraph::eTaskState InitGraph::GetDepsState(const Task& task) const
+{
+    // DONE: all the dependencies are done; FAILED: some dependency failed (or was skipped)
+
+    eTaskState depsState = INIT_TASK_DONE;
+
+    for (int i = 0; i < task.numDeps; ++i)
+    {
+        const int state = tasks_[task.deps[i]]->state.load(std::memory_order_acquire);
+
+        if ((state == INIT_TASK_FAILED) || (state == INIT_TASK_SKIPPED))
+            return INIT_TASK_FAILED;
+
+        if (state != INIT_TASK_DONE)
+            depsState = INIT_TASK_PENDING;
+    }
+
+    return depsState;
+}
+
+///////////////////////////////////////////////////////////
+
+const InitGraph::Task* InitGraph::FindRunningDep(const Task& task) const
+{
+    // find a running job which the task waits for (directly or through pending tasks)
+
+    for (int i = 0; i < task.numDeps; ++i)
+    {
+        const Task* pDep  = tasks_[task.deps[i]];
+        const int   state = pDep->state.load(std::memory_order_acquire);
+
+        if (state == INIT_TASK_RUNNING)
+            return pDep;
+
+        if (state == INIT_TASK_PENDING)
+        {
+            if (const Task* pRunning = FindRunningDep(*pDep))
+                return pRunning;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,86 @@
+// =================================================================================
+// Filename:     InitGraph.h
+// Description:  a dependency graph of initialization tasks:
+//
+//               - a task is started as soon as all its dependencies are done;
+//               - tasks which can be executed by any thread are jobs of the
+//                 job system; the rest of tasks (which touch the immediate
+//                 context, the window or not thread-safe managers) are executed
+//                 by the main thread in order of adding;
+//               - while the main thread waits for some job it helps to execute jobs;
+//               - each task is a startup phase (see StartupTimeline.h);
+//               - if a task fails then all the tasks which depend on it are skipped
+//
+//               NOTE: task names must be string literals (or live forever)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "JobSystem.h"
+
+#include <initializer_list>
+
+
+enum eInitTaskThread
+{
+    INIT_TASK_MAIN_THREAD,
+    INIT_TASK_ANY_THREAD,
+};
+
+///////////////////////////////////////////////////////////
+
+class InitGraph
+{
+public:
+    using TaskFunc = std::function<bool()>;
+
+    static constexpr int MAX_DEPS = 8;
+
+public:
+    InitGraph() {}
+    ~InitGraph();
+
+    // restrict copying
+    InitGraph(const InitGraph&) = delete;
+    InitGraph& operator=(const InitGraph&) = delete;
+
+    // add a task which is executed after all the tasks of deps (their idxs);
+    // return: idx of the added task (to be a dependency of next tasks)
+    int AddTask(
+        const char* name,
+        const eInitTaskThread thread,
+        TaskFunc&& func,
+        std::initializer_list<int> deps = {});
+
+    // execute all the tasks; returns false if any task failed or was skipped
+    bool Run();
+
+private:
+    enum eTaskState
+    {
+        INIT_TASK_PENDING,
+        INIT_TASK_RUNNING,
+        INIT_TASK_DONE,
+        INIT_TASK_FAILED,
+        INIT_TASK_SKIPPED,                                    // some dependency failed
+    };
+
+    struct Task
+    {
+        const char*      name = nullptr;
+        eInitTaskThread  thread = INIT_TASK_MAIN_THREAD;
+        TaskFunc         func;
+        int              deps[MAX_DEPS]{ 0 };
+        int              numDeps = 0;
+        std::atomic<int> state = INIT_TASK_PENDING;
+        JobCounter       counter;                             // of the job (if the task is a job)
+    };
+
+    static void       ExecuteTask(Task& task);
+    eTaskState        GetDepsState(const Task& task) const;
+    const Task*       FindRunningDep(const Task& task) const;
+
+private:
+    cvector<Task*>   tasks_;
+};
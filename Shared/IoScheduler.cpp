@@ -0,0 +1,746 @@
+// =================================================================================
+// Filename:     IoScheduler.cpp
+// Description:  implementation of the IoScheduler's functional (Win32 IOCP)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "IoScheduler.h"
+#include "AssetPack.h"
+#include "FileSystem.h"
+#include "JobSystem.h"
+#include "MemHelpers.h"
+#include "Profiler.h"
+#include "log.h"
+
+#include <algorithm>
+#include <memory>
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#pragma warning (disable : 4996)
+
+
+// a global instance of the I/O scheduler
+IoScheduler g_IoScheduler;
+
+// completion keys of packets which aren't completions of reads
+static constexpr ULONG_PTR IO_KEY_WAKE = 1;
+
+
+// =================================================================================
+// Internal types
+// =================================================================================
+struct IoScheduler::IoRequest
+{
+    IoRequestID      id         = INVALID_IO_REQUEST_ID;
+    char             path[256]{ '\0' };
+    float            priority   = 0;
+    IoCallback       onDone;
+    JobCounter*      pCounter   = nullptr;
+
+    // the packed entry of the file (pPack == nullptr: the file is on disk)
+    const AssetPack* pPack      = nullptr;
+    index            entryIdx   = -1;
+    uint64           offset     = 0;            // of stored data in the pack
+    uint32           storedSize = 0;
+
+    bool             isCanceled = false;
+};
+
+///////////////////////////////////////////////////////////
+
+struct IoScheduler::Read
+{
+    OVERLAPPED          overlapped{};           // MUST be the first (a read is found by it)
+    HANDLE              hFile      = nullptr;   // nullptr: the file isn't opened yet
+    bool                isOwnFile  = false;     // a file on disk (the handle is closed by the read)
+    bool                isIssued   = false;     // there is a packet of the read in the port
+    uint64              offset     = 0;
+    uint32              size       = 0;
+    uint8*              buffer     = nullptr;   // size + 1 bytes
+    cvector<IoRequest*> requests;               // SORTED by offset (one if the file is on disk)
+};           // MUST be the first (a read is found by it)
+    HANDLE            hFile      = nullptr;     // nullptr: the read isn't issued yet
+    bool              isOwnFile  = false;       // a file on disk (the handle is closed by the read)
+    bool              isIssued   = false;       // there is a packet of the read in the port
+    uint64            offset     = 0;
+    uint32            size       = 0;
+    uint8*            buffer     = nullptr;     // size + 1 bytes
+    cvector<IoRequest*> requests;               // SORTED by offset (one if the file is on disk)
+};
+
+
+//---------------------------------------------------------
+// Desc:  execute the callback of the request and release the request
+//        (is executed by a job)
+//---------------------------------------------------------
+static void RunCallback(
+    IoCallback& onDone,
+    JobCounter* pCounter,
+    const IoRequestID id,
+    const eIoStatus status,
+    uint8* data,
+    const size_t size)
+{
+    IoCompletion completion;
+    completion.id     = id;
+    completion.status = status;
+    completion.data   = data;
+    completion.size   = size;
+
+    if (onDone)
+        onDone(completion);
+    else
+        SafeDeleteArr(completion.data);
+
+    if (pCounter)
+        pCounter->numJobs.fetch_sub(1, std::memory_order_release);
+}
+
+
+// =================================================================================
+// Public API
+// =================================================================================
+bool IoScheduler::Initialize(const IoSchedulerParams& params)
+{
+    if (isRunning_)
+        return true;
+
+    params_ = params;
+    params_.maxReadsInFlight = std::max(params_.maxReadsInFlight, 1);
+
+    hPort_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+
+    if (!hPort_)
+    {
+        LogErr("can't create an I/O completion port");
+        return false;
+    }
+
+    isRunning_ = true;
+    thread_    = std::thread(&IoScheduler::IoThreadLoop, this);
+
+    LogMsgf("the I/O scheduler is initialized (reads in flight: %d, coalesce gap: %u KB)",
+        params_.maxReadsInFlight, params_.coalesceGap >> 10);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void IoScheduler::Shutdown()
+{
+    if (!thread_.joinable())
+        return;
+
+    cvector<IoRequest*> canceled;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isRunning_ = false;
+
+        canceled = pending_;
+        pending_.clear();
+
+        // the I/O thread exits when all the reads in flight are completed
+        for (Read* pRead : reads_)
+        {
+            for (IoRequest* pRequest : pRead->requests)
+                pRequest->isCanceled = true;
+
+            if (pRead->hFile)
+                CancelIoEx(pRead->hFile, &pRead->overlapped);
+        }
+
+        stats_.numCanceled += canceled.size();
+        stats_.numPending   = 0;
+    }
+
+    for (IoRequest* pRequest : canceled)
+        Deliver(pRequest, IO_STATUS_CANCELED, nullptr, 0);
+
+    Wake();
+    thread_.join();
+
+    for (void* hFile : packHandles_)
+        CloseHandle((HANDLE)hFile);
+
+    packs_.clear();
+    packHandles_.clear();
+
+    CloseHandle((HANDLE)hPort_);
+    hPort_ = nullptr;
+
+    LogMsgf("the I/O scheduler is shut down (reads: %llu, coalesced requests: %llu, canceled: %llu, MB read: %llu)",
+        (unsigned long long)stats_.numReads,
+        (unsigned long long)stats_.numCoalesced,
+        (unsigned long long)stats_.numCanceled,
+        (unsigned long long)(stats_.bytesRead >> 20));
+}
+
+///////////////////////////////////////////////////////////
+
+IoRequestID IoScheduler::Request(
+    const char* filePath,
+    const float priority,
+    IoCallback&& onDone,
+    JobCounter* pCounter)
+{
+    IoRequest* pRequest = new IoRequest;
+
+    strncpy(pRequest->path, (filePath) ? filePath : "", sizeof(pRequest->path) - 1);
+    pRequest->priority = priority;
+    pRequest->onDone   = std::move(onDone);
+    pRequest->pCounter = pCounter;
+
+    if (pCounter)
+        pCounter->numJobs.fetch_add(1, std::memory_order_relaxed);
+
+    // stored data of a packed file is read by its range in the pack
+    pRequest->pPack = FileSys::FindPack(pRequest->path, pRequest->entryIdx);
+
+    if (pRequest->pPack)
+    {
+        const AssetPackEntry& entry = pRequest->pPack->GetEntry(pRequest->entryIdx);
+        pRequest->offset     = entry.offset;
+        pRequest->storedSize = entry.packedSize;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // 0 is reserved for the invalid id
+        if (++lastID_ == INVALID_IO_REQUEST_ID)
+            ++lastID_;
+
+        pRequest->id = lastID_;
+        stats_.numRequests++;
+
+        if (isRunning_)
+        {
+            const IoRequestID id = pRequest->id;
+
+            pending_.push_back(pRequest);
+            stats_.numPending++;
+            Wake();
+            return id;
+        }
+    }
+
+    // there is no I/O thread: the file is read by a job right away
+    g_JobSystem.Run([pRequest]()
+    {
+        uint8*       data   = nullptr;
+        size_t       size   = 0;
+        const bool   isRead = FileSys::ReadFile(pRequest->path, data, size);
+
+        RunCallback(
+            pRequest->onDone,
+            pRequest->pCounter,
+            pRequest->id,
+            (isRead) ? IO_STATUS_DONE : IO_STATUS_FAILED,
+            data,
+            size);
+
+        delete pRequest;
+    });
+
+    return INVALID_IO_REQUEST_ID;
+}
+
+///////////////////////////////////////////////////////////
+
+bool IoScheduler::Cancel(const IoRequestID id)
+{
+    if (id == INVALID_IO_REQUEST_ID)
+        return false;
+
+    IoRequest* pCanceled = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // a pending request never touches the disk
+        for (index i = 0; i < pending_.size(); ++i)
+        {
+            if (pending_[i]->id == id)
+            {
+                pCanceled = pending_[i];
+                pending_.erase(i);
+                stats_.numPending--;
+                stats_.numCanceled++;
+                break;
+            }
+        }
+
+        // a request in flight: its completion is delivered as cancelled and the read
+        // itself is cancelled when no other request of it is needed
+        if (!pCanceled)
+        {
+            for (Read* pRead : reads_)
+            {
+                for (IoRequest* pRequest : pRead->requests)
+                {
+                    if ((pRequest->id != id) || pRequest->isCanceled)
+                        continue;
+
+                    pRequest->isCanceled = true;
+                    stats_.numCanceled++;
+
+                    if (pRead->hFile && !IsNeeded(pRead))
+                        CancelIoEx(pRead->hFile, &pRead->overlapped);
+
+                    return true;
+                }
+            }
+
+            return false;
+        }
+    }
+
+    Deliver(pCanceled, IO_STATUS_CANCELED, nullptr, 0);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void IoScheduler::SetPriority(const IoRequestID id, const float priority)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (IoRequest* pRequest : pending_)
+    {
+        if (pRequest->id == id)
+        {
+            pRequest->priority = priority;
+            return;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+IoSchedulerStats IoScheduler::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+//---------------------------------------------------------
+// Desc:  is any request of the read still needed?
+//---------------------------------------------------------
+bool IoScheduler::IsNeeded(const Read* pRead)
+{
+    for (const IoRequest* pRequest : pRead->requests)
+    {
+        if (!pRequest->isCanceled)
+            return true;
+    }
+
+    return false;
+}
+
+//---------------------------------------------------------
+// Desc:  the loop of the I/O thread: handle completions of reads and
+//        issue pending requests while there are free slots for reads
+//---------------------------------------------------------
+void IoScheduler::IoThreadLoop()
+{
+    g_CpuProfiler.SetThreadName("io");
+
+    while (true)
+    {
+        DWORD        numBytes    = 0;
+        ULONG_PTR    key         = 0;
+        OVERLAPPED*  pOverlapped = nullptr;
+
+        const BOOL isOk = GetQueuedCompletionStatus((HANDLE)hPort_, &numBytes, &key, &pOverlapped, INFINITE);
+
+        // a completed (or failed/cancelled) read; else it is a wake-up
+        if (pOverlapped)
+            CompleteRead((Read*)pOverlapped, isOk == TRUE, (uint32)numBytes);
+
+        if (!isRunning_)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (reads_.empty())
+                return;
+
+            continue;
+        }
+
+        IssueReads();
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void IoScheduler::IssueReads()
+{
+    while (true)
+    {
+        IoRequest* pFirst = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (pending_.empty() || (reads_.size() >= params_.maxReadsInFlight))
+                return;
+
+            // the highest priority first (the oldest one of equal priorities)
+            index best = 0;
+
+            for (index i = 1; i < pending_.size(); ++i)
+            {
+                if (pending_[i]->priority > pending_[best]->priority)
+                    best = i;
+            }
+
+            pFirst = pending_[best];
+            pending_.erase(best);
+            stats_.numPending--;
+        }
+
+        IssueRead(pFirst);
+    }
+}
+
+//---------------------------------------------------------
+// Desc:  issue an overlapped read of the request; a packed request takes
+//        pending requests of its neighbour entries into the same read
+// Ret:   false if the read can't be issued (the completion is already delivered)
+//---------------------------------------------------------
+bool IoScheduler::IssueRead(IoRequest* pFirst)
+{
+    Read* pRead = new Read;
+    pRead->requests.push_back(pFirst);
+
+    HANDLE hFile = nullptr;
+
+    if (pFirst->pPack)
+    {
+        hFile = (HANDLE)GetPackHandle(pFirst->pPack);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        pRead->offset = pFirst->offset;
+        pRead->size   = pFirst->storedSize;
+
+        // pending entries of the same pack sorted by offset
+        cvector<IoRequest*> neighbours;
+
+        for (IoRequest* pRequest : pending_)
+        {
+            if (pRequest->pPack == pFirst->pPack)
+                neighbours.push_back(pRequest);
+        }
+
+        std::sort(neighbours.begin(), neighbours.end(), [](const IoRequest* a, const IoRequest* b)
+        {
+            return a->offset < b->offset;
+        });
+
+        // grow the range forward (the sequential direction) and then backward
+        uint64 start = pRead->offset;
+        uint64 end   = pRead->offset + pRead->size;
+
+        for (IoRequest* pRequest : neighbours)
+        {
+            if (pRequest->offset < end)
+                continue;
+
+            const uint64 newEnd = pRequest->offset + pRequest->storedSize;
+
+            if ((pRequest->offset > end + params_.coalesceGap) || (newEnd - start > params_.maxCoalesceSize))
+                break;
+
+            pRead->requests.push_back(pRequest);
+            end = newEnd;
+        }
+
+        for (index i = neighbours.size() - 1; i >= 0; --i)
+        {
+            IoRequest* pRequest = neighbours[i];
+            const uint64 reqEnd = pRequest->offset + pRequest->storedSize;
+
+            if (pRequest->offset >= pFirst->offset)
+                continue;
+
+            if ((reqEnd + params_.coalesceGap < start) || (end - pRequest->offset > params_.maxCoalesceSize))
+                break;
+
+            pRead->requests.push_back(pRequest);
+            start = std::min(start, pRequest->offset);
+        }
+
+        for (index i = 1; i < pRead->requests.size(); ++i)
+        {
+            const index idx = pending_.find(pRead->requests[i]);
+            pending_.erase(idx);
+            stats_.numPending--;
+            stats_.numCoalesced++;
+        }
+
+        std::sort(pRead->requests.begin(), pRead->requests.end(), [](const IoRequest* a, const IoRequest* b)
+        {
+            return a->offset < b->offset;
+        });
+
+        pRead->offset = start;
+        pRead->size   = (uint32)(end - start);
+        reads_.push_back(pRead);
+    }
+    else
+    {
+        hFile = CreateFileA(
+            pFirst->path,
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr);
+
+        LARGE_INTEGER fileSize{};
+
+        if ((hFile == INVALID_HANDLE_VALUE) ||
+            !GetFileSizeEx(hFile, &fileSize) ||
+            (fileSize.QuadPart > UINT32_MAX) ||
+            !CreateIoCompletionPort(hFile, (HANDLE)hPort_, 0, 0))
+        {
+            if (hFile != INVALID_HANDLE_VALUE)
+                CloseHandle(hFile);
+
+            char msg[320]{ '\0' };
+            snprintf(msg, sizeof(msg), "can't open a file for async reads: %s", pFirst->path);
+            LogErr(msg);
+
+            hFile = nullptr;
+        }
+
+        pRead->isOwnFile = (hFile != nullptr);
+        pRead->size      = (uint32)fileSize.QuadPart;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        reads_.push_back(pRead);
+    }
+
+    // ---------------------------------------------
+
+    bool isIssued = false;
+    bool isNeeded = false;
+
+    if (hFile)
+    {
+        if (pRead->size > 0)
+        {
+            pRead->buffer                = new uint8[pRead->size + 1];
+            pRead->buffer[pRead->size]   = '\0';
+            pRead->overlapped.Offset     = (DWORD)(pRead->offset & 0xFFFFFFFF);
+            pRead->overlapped.OffsetHigh = (DWORD)(pRead->offset >> 32);
+        }
+
+        // since now the read can be cancelled by the OS; the stats are
+        // updated before the packet of the read can be handled
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        pRead->hFile    = hFile;
+        isNeeded        = IsNeeded(pRead) && (pRead->size > 0);
+        pRead->isIssued = isNeeded;
+
+        if (isNeeded)
+        {
+            stats_.numReads++;
+            stats_.numInFlight++;
+        }
+    }
+
+    if (isNeeded)
+    {
+        const BOOL isOk = ReadFile(hFile, pRead->buffer, pRead->size, nullptr, &pRead->overlapped);
+        isIssued = isOk || (GetLastError() == ERROR_IO_PENDING);
+
+        if (!isIssued)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pRead->isIssued = false;
+            stats_.numReads--;
+            stats_.numInFlight--;
+        }
+    }
+
+    if (isIssued)
+        return true;
+
+    // there is no packet of the read: complete it right now (an empty file is read successfully)
+    CompleteRead(pRead, (hFile != nullptr) && (pRead->size == 0), 0);
+    return false;
+}
+
+//---------------------------------------------------------
+// Desc:  deliver completions of requests of the read; stored data of
+//        packed requests is unpacked by their jobs
+//---------------------------------------------------------
+void IoScheduler::CompleteRead(Read* pRead, const bool isOk, const uint32 numBytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        const index idx = reads_.find(pRead);
+
+        if (idx != -1)
+            reads_.erase(idx);
+
+        if (pRead->isIssued)
+        {
+            stats_.numInFlight--;
+            stats_.bytesRead += (isOk) ? numBytes : 0;
+        }
+    }
+
+    if (pRead->isOwnFile)
+        CloseHandle(pRead->hFile);
+
+    const bool isRead = isOk && (numBytes == pRead->size);
+
+    // a file on disk: the buffer is passed to the callback as it is
+    if (!pRead->requests[0]->pPack)
+    {
+        IoRequest* pRequest = pRead->requests[0];
+
+        if (pRequest->isCanceled)
+            Deliver(pRequest, IO_STATUS_CANCELED, nullptr, 0);
+
+        else if (!isRead)
+            Deliver(pRequest, IO_STATUS_FAILED, nullptr, 0);
+
+        else
+        {
+            Deliver(pRequest, IO_STATUS_DONE, (pRead->buffer) ? pRead->buffer : new uint8[1]{ '\0' }, pRead->size);
+            pRead->buffer = nullptr;
+        }
+
+        SafeDeleteArr(pRead->buffer);
+        delete pRead;
+        return;
+    }
+
+    // packed files: each one is unpacked by its own job; the stored data
+    // is shared by them and released after the last one
+    std::shared_ptr<uint8[]> stored(pRead->buffer);
+    const uint64             readOffset = pRead->offset;
+
+    for (IoRequest* pRequest : pRead->requests)
+    {
+        if (pRequest->isCanceled)
+        {
+            Deliver(pRequest, IO_STATUS_CANCELED, nullptr, 0);
+            continue;
+        }
+
+        if (!isRead)
+        {
+            Deliver(pRequest, IO_STATUS_FAILED, nullptr, 0);
+            continue;
+        }
+
+        const uint64 offset = pRequest->offset - readOffset;
+
+        g_JobSystem.Run([pRequest, stored, offset]()
+        {
+            const AssetPackEntry& entry = pRequest->pPack->GetEntry(pRequest->entryIdx);
+            uint8*                data  = new uint8[entry.size + 1];
+            eIoStatus             status = IO_STATUS_DONE;
+
+            if (!pRequest->pPack->Unpack(pRequest->entryIdx, stored.get() + offset, data))
+            {
+                char msg[320]{ '\0' };
+                snprintf(msg, sizeof(msg), "can't unpack a file: %s (pack: %s)", pRequest->path, pRequest->pPack->GetPath());
+                LogErr(msg);
+
+                SafeDeleteArr(data);
+                status = IO_STATUS_FAILED;
+            }
+            else
+            {
+                data[entry.size] = '\0';
+            }
+
+            RunCallback(
+                pRequest->onDone,
+                pRequest->pCounter,
+                pRequest->id,
+                status,
+                data,
+                (data) ? entry.size : 0);
+
+            delete pRequest;
+        });
+    }
+
+    delete pRead;
+}
+
+//---------------------------------------------------------
+// Desc:  get a handle of the pack for overlapped reads (is opened on
+//        the first read from the pack); is used by the I/O thread only
+//---------------------------------------------------------
+void* IoScheduler::GetPackHandle(const AssetPack* pPack)
+{
+    const index idx = packs_.find(pPack);
+
+    if (idx != -1)
+        return packHandles_[idx];
+
+    HANDLE hFile = CreateFileA(
+        pPack->GetPath(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_OVERLAPPED,
+        nullptr);
+
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        char msg[320]{ '\0' };
+        snprintf(msg, sizeof(msg), "can't open a pack for async reads: %s", pPack->GetPath());
+        LogErr(msg);
+        return nullptr;
+    }
+
+    if (!CreateIoCompletionPort(hFile, (HANDLE)hPort_, 0, 0))
+    {
+        CloseHandle(hFile);
+        return nullptr;
+    }
+
+    packs_.push_back(pPack);
+    packHandles_.push_back(hFile);
+    return hFile;
+}
+
+//---------------------------------------------------------
+// Desc:  deliver the completion of the request by a job
+//---------------------------------------------------------
+void IoScheduler::Deliver(
+    IoRequest* pRequest,
+    const eIoStatus status,
+    uint8* data,
+    const size_t size)
+{
+    g_JobSystem.Run([pRequest, status, data, size]()
+    {
+        RunCallback(pRequest->onDone, pRequest->pCounter, pRequest->id, status, data, size);
+        delete pRequest;
+    });
+}
+
+///////////////////////////////////////////////////////////
+
+void IoScheduler::Wake()
+{
+    PostQueuedCompletionStatus((HANDLE)hPort_, 0, IO_KEY_WAKE, nullptr);
+}
@@ -0,0 +1,168 @@
+// =================================================================================
+// Filename:     IoScheduler.h
+// Description:  a central scheduler of asynchronous file reads so streamed content
+//               (textures, models, terrain tiles, world chunks, audio) doesn't
+//               fight over the disk:
+//
+//               - a single I/O thread issues overlapped reads (Win32 IOCP) and
+//                 keeps a limited number of them in flight;
+//               - pending requests are issued by their priority (e.g. the
+//                 on-screen size or the negative distance to the camera), the
+//                 priority can be changed while the request is waiting;
+//               - a request which isn't needed anymore is cancelled: if it isn't
+//                 issued yet it never touches the disk, if it is in flight the
+//                 read is cancelled by the OS (when it is the only one of the read);
+//               - requests for entries of the same asset pack which lie close
+//                 to each other are coalesced into one read;
+//               - a completion (done, failed or cancelled) is delivered exactly
+//                 once by a job of the job system so the data is decoded there
+//
+//               NOTE: the data of the completion is allocated by new[] (there is an
+//                     extra '\0' after it as of FileSys::ReadFile); the callback
+//                     takes its ownership and releases it by SafeDeleteArr
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "cvector.h"
+#include "Types.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct JobCounter;
+class AssetPack;
+
+
+// =================================================================================
+// Data structures
+// =================================================================================
+using IoRequestID = uint32;
+
+constexpr IoRequestID INVALID_IO_REQUEST_ID = 0;
+
+///////////////////////////////////////////////////////////
+
+enum eIoStatus
+{
+    IO_STATUS_DONE,
+    IO_STATUS_FAILED,
+    IO_STATUS_CANCELED,
+};
+
+///////////////////////////////////////////////////////////
+
+struct IoCompletion
+{
+    IoRequestID id     = INVALID_IO_REQUEST_ID;
+    eIoStatus   status = IO_STATUS_FAILED;
+    uint8*      data   = nullptr;            // only for IO_STATUS_DONE (the callback owns it)
+    size_t      size   = 0;
+};
+
+using IoCallback = std::function<void(IoCompletion&)>;
+
+///////////////////////////////////////////////////////////
+
+struct IoSchedulerParams
+{
+    int    maxReadsInFlight = 8;             // overlapped reads which are issued at once
+    uint32 coalesceGap      = 64 << 10;      // pack entries closer than it are read together (bytes)
+    uint32 maxCoalesceSize  = 4 << 20;       // the max size of a coalesced read (bytes)
+};
+
+///////////////////////////////////////////////////////////
+
+struct IoSchedulerStats
+{
+    uint32 numPending   = 0;                 // requests which wait for issuing
+    uint32 numInFlight  = 0;                 // reads at the moment
+    uint64 numRequests  = 0;                 // since the start
+    uint64 numReads     = 0;                 // overlapped reads (a coalesced one is counted once)
+    uint64 numCoalesced = 0;                 // requests which were read by the read of another one
+    uint64 numCanceled  = 0;
+    uint64 bytesRead    = 0;
+};
+
+// =================================================================================
+// Class
+// =================================================================================
+class IoScheduler
+{
+public:
+    IoScheduler() {}
+    ~IoScheduler() { Shutdown(); }
+
+    // restrict a copying of this class instance
+    IoScheduler(const IoScheduler&) = delete;
+    IoScheduler& operator=(const IoScheduler&) = delete;
+
+    bool Initialize(const IoSchedulerParams& params = IoSchedulerParams());
+
+    // cancel all the requests, wait for their reads and stop the I/O thread;
+    // NOTE: completions of cancelled requests are still delivered by jobs
+    void Shutdown();
+
+    // request a read of the whole file (from mounted packs or from disk); a higher
+    // priority is issued first; onDone is executed by a job; if pCounter != nullptr
+    // it is incremented right now and decremented after onDone is executed;
+    // NOTE: if the scheduler isn't initialized the file is read by a job right away
+    IoRequestID Request(
+        const char* filePath,
+        const float priority,
+        IoCallback&& onDone,
+        JobCounter* pCounter = nullptr);
+
+    // the request isn't needed anymore (the completion comes with IO_STATUS_CANCELED);
+    // ret: false if the request is already completed (or there is no such a request)
+    bool Cancel(const IoRequestID id);
+
+    // change the priority of the request which is still pending
+    void SetPriority(const IoRequestID id, const float priority);
+
+    IoSchedulerStats GetStats();
+
+    inline bool IsInitialized() const { return isRunning_; }
+
+private:
+    struct IoRequest;
+    struct Read;
+
+    void IoThreadLoop();
+    void IssueReads();
+    bool IssueRead(IoRequest* pFirst);
+    void CompleteRead(Read* pRead, const bool isOk, const uint32 numBytes);
+
+    void* GetPackHandle(const AssetPack* pPack);
+    void  Deliver(IoRequest* pRequest, const eIoStatus status, uint8* data, const size_t size);
+    void  Wake();
+
+    static bool IsNeeded(const Read* pRead);
+
+private:
+    IoSchedulerParams       params_;
+    void*                   hPort_       = nullptr;    // HANDLE of the completion port
+
+    // guarded by mutex_
+    std::mutex              mutex_;
+    cvector<IoRequest*>     pending_;                  // requests which aren't issued yet
+    cvector<Read*>          reads_;                    // reads in flight
+    IoSchedulerStats        stats_;
+    IoRequestID             lastID_      = INVALID_IO_REQUEST_ID;
+
+    // the I/O thread only
+    cvector<const AssetPack*> packs_;                  // packs which are opened for overlapped reads
+    cvector<void*>          packHandles_;              // HANDLE per pack of packs_
+
+    std::thread             thread_;
+    std::atomic<bool>       isRunning_   = false;
+};
+
+
+// =================================================================================
+// a global instance of the I/O scheduler
+// =================================================================================
+extern IoScheduler g_IoScheduler;
@@ -0,0 +1,249 @@
+// =================================================================================
+// Filename:     JobSystem.cpp
+// Description:  implementation of the work-stealing job system
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "JobSystem.h"
+#include "log.h"
+#include "Profiler.h"
+
+#pragma warning (disable : 4996)
+
+
+// a global instance of the job system
+JobSystem g_JobSystem;
+
+// idx of the jobs queue of the current thread:
+// 0 - main thread (and any other not worker thread), [1..N] - worker threads
+static thread_local int s_QueueIdx = 0;
+
+
+JobSystem::JobSystem()
+{
+}
+
+///////////////////////////////////////////////////////////
+
+JobSystem::~JobSystem()
+{
+    Shutdown();
+}
+
+///////////////////////////////////////////////////////////
+
+void JobSystem::Initialize(const int numWorkers)
+{
+    // create a fixed pool of worker threads
+
+    if (IsInitialized())
+    {
+        LogErr("the job system is already initialized");
+        return;
+    }
+
+    const int numHwThreads = (int)std::thread::hardware_concurrency();
+    const int numThreads   = (numWorkers > 0) ? numWorkers : ((numHwThreads > 1) ? numHwThreads - 1 : 1);
+
+    // a queue for the main thread + a queue per each worker
+    queues_.resize(numThreads + 1);
+
+    for (JobQueue*& pQueue : queues_)
+        pQueue = new JobQueue();
+
+    isRunning_ = true;
+    workers_.resize(numThreads);
+
+    for (int i = 0; i < numThreads; ++i)
+        workers_[i] = std::thread(&JobSystem::WorkerLoop, this, i + 1);
+
+    sprintf(g_String, "the job system is initialized (number of workers: %d)", numThreads);
+    LogMsg(g_String);
+}
+
+///////////////////////////////////////////////////////////
+
+void JobSystem::Shutdown()
+{
+    // execute all the remaining jobs and stop the worker threads
+
+    if (!IsInitialized())
+        return;
+
+    while (TryExecuteJob(0)) {}
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        isRunning_ = false;
+    }
+    wakeCondition_.notify_all();
+
+    for (std::thread& worker : workers_)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    for (JobQueue*& pQueue : queues_)
+    {
+        delete pQueue;
+        pQueue = nullptr;
+    }
+
+    workers_.clear();
+    queues_.clear();
+    numPendingJobs_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+void JobSystem::Run(JobFunc&& func, JobCounter* pCounter)
+{
+    // add a job into the queue of the current thread (it'll be
+    // executed by this thread or stolen by some idle worker)
+
+    if (pCounter)
+        pCounter->numJobs.fetch_add(1, std::memory_order_relaxed);
+
+    // there is no workers so just execute the job in place
+    if (!IsInitialized())
+    {
+        func();
+
+        if (pCounter)
+            pCounter->numJobs.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+
+    JobQueue& queue = *queues_[GetCurrQueueIdx()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back({ std::move(func), pCounter });
+    }
+
+    numPendingJobs_.fetch_add(1, std::memory_order_release);
+
+    // wake up some sleeping worker; we touch the mutex so the worker can't
+    // miss this notification between checking the condition and going to sleep
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+    }
+    wakeCondition_.notify_one();
+}
+
+///////////////////////////////////////////////////////////
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+    // help to execute jobs until the counter is done
+
+    const int queueIdx = GetCurrQueueIdx();
+
+    while (!counter.IsDone())
+    {
+        if (!TryExecuteJob(queueIdx))
+            std::this_thread::yield();
+    }
+}
+
+
+// =================================================================================
+// PRIVATE HELPERS
+// =================================================================================
+void JobSystem::WorkerLoop(const int queueIdx)
+{
+    s_QueueIdx = queueIdx;
+
+    char threadName[32];
+    snprintf(threadName, sizeof(threadName), "worker %d", queueIdx);
+    g_CpuProfiler.SetThreadName(threadName);
+
+    while (isRunning_)
+    {
+        if (TryExecuteJob(queueIdx))
+            continue;
+
+        // there is nothing to do so go to sleep until some job is added
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+
+        wakeCondition_.wait(lock, [this]()
+        {
+            return (numPendingJobs_.load(std::memory_order_acquire) > 0) || !isRunning_;
+        });
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool JobSystem::PopJob(const int queueIdx, Job& outJob)
+{
+    // the owner takes the most recent job (it is still hot in the cache)
+
+    JobQueue& queue = *queues_[queueIdx];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.jobs.empty())
+        return false;
+
+    outJob = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+bool JobSystem::StealJob(const int thiefIdx, Job& outJob)
+{
+    // try to steal the oldest job from other queues
+
+    const int numQueues = (int)queues_.size();
+
+    for (int i = 1; i < numQueues; ++i)
+    {
+        JobQueue& victim = *queues_[(thiefIdx + i) % numQueues];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+
+        if (!lock.owns_lock() || victim.jobs.empty())
+            continue;
+
+        outJob = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+
+        return true;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////
+
+bool JobSystem::TryExecuteJob(const int queueIdx)
+{
+    // execute a single job from own queue or stolen from another one;
+    // return false if there was no job to execute
+
+    Job job;
+
+    if (!PopJob(queueIdx, job) && !StealJob(queueIdx, job))
+        return false;
+
+    numPendingJobs_.fetch_sub(1, std::memory_order_relaxed);
+
+    {
+        PROFILE_SCOPE("job");
+        job.func();
+    }
+
+    if (job.pCounter)
+        job.pCounter->numJobs.fetch_sub(1, std::memory_order_release);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+int JobSystem::GetCurrQueueIdx() const
+{
+    return s_QueueIdx;
+}
@@ -0,0 +1,159 @@
+// =================================================================================
+// Filename:     JobSystem.h
+// Description:  a work-stealing job system:
+//
+//               - a fixed pool of worker threads (created once at startup);
+//               - each thread (including the main one) has its own deque of jobs:
+//                 the owner pushes/pops jobs at the back, and idle threads steal
+//                 jobs from the front of other deques;
+//               - a JobCounter is used as a fence: it is incremented for each
+//                 added job and decremented when the job is done, so we can
+//                 wait for a group of jobs (the waiting thread executes
+//                 pending jobs instead of just sleeping)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "cvector.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+// =================================================================================
+// JOB COUNTER (fence for a group of jobs)
+// =================================================================================
+struct JobCounter
+{
+    std::atomic<int> numJobs = 0;                   // the number of not finished jobs
+
+    inline bool IsDone() const { return numJobs.load(std::memory_order_acquire) == 0; }
+};
+
+// =================================================================================
+// JOB SYSTEM
+// =================================================================================
+class JobSystem
+{
+public:
+    using JobFunc = std::function<void()>;
+
+    struct Job
+    {
+        JobFunc     func;
+        JobCounter* pCounter = nullptr;             // is decremented when the job is done
+    };
+
+public:
+    JobSystem();
+    ~JobSystem();
+
+    // restrict copying
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // numWorkers == 0: use (number of hardware threads - 1) workers
+    void Initialize(const int numWorkers = 0);
+    void Shutdown();
+
+    // add a job for execution; if pCounter != nullptr it is incremented right now
+    // and decremented when the job is done
+    void Run(JobFunc&& func, JobCounter* pCounter = nullptr);
+
+    // wait until all the jobs of counter are done;
+    // while waiting the caller thread helps to execute pending jobs
+    void Wait(const JobCounter& counter);
+
+    // split the range [0, numElems) into chunks of grain elements and execute
+    // fn(startIdx, endIdx) for each chunk on all the threads; returns when all
+    // the chunks are done (the caller thread executes chunks as well)
+    template <typename Fn>
+    void ParallelFor(const index numElems, const index grain, Fn&& fn);
+
+    // the number of threads which execute jobs (workers + caller thread)
+    inline int  GetNumThreads() const { return (int)queues_.size(); }
+    inline bool IsInitialized() const { return !workers_.empty(); }
+
+    // native handles of worker threads (for instance: to sample their CPU times)
+    inline int  GetNumWorkers() const { return (int)workers_.size(); }
+    inline std::thread::native_handle_type GetWorkerHandle(const int idx) { return workers_[idx].native_handle(); }
+
+    // idx of the calling thread in [0, GetNumThreads()): 0 - the main thread
+    // (and any other thread which isn't a worker), [1..N] - workers
+    int  GetCurrQueueIdx() const;
+
+private:
+    struct JobQueue
+    {
+        std::mutex      mutex;
+        std::deque<Job> jobs;
+    };
+
+    void WorkerLoop(const int queueIdx);
+
+    bool PopJob  (const int queueIdx, Job& outJob);
+    bool StealJob(const int thiefIdx, Job& outJob);
+    bool TryExecuteJob(const int queueIdx);
+
+private:
+    cvector<std::thread>    workers_;
+    cvector<JobQueue*>      queues_;               // [0]: for the main thread and not worker threads; [1..N]: for workers
+
+    std::mutex              sleepMutex_;
+    std::condition_variable wakeCondition_;
+    std::atomic<int>        numPendingJobs_ = 0;
+    std::atomic<bool>       isRunning_      = false;
+};
+
+
+// =================================================================================
+// a global instance of the job system
+// =================================================================================
+extern JobSystem g_JobSystem;
+
+
+// =================================================================================
+// TEMPLATES IMPLEMENTATION
+// =================================================================================
+template <typename Fn>
+void JobSystem::ParallelFor(const index numElems, const index grain, Fn&& fn)
+{
+    if (numElems <= 0)
+        return;
+
+    const index chunkSize = (grain > 0) ? grain : 1;
+
+    // not enough work to split or there is no workers: execute in place
+    if ((numElems <= chunkSize) || !IsInitialized())
+    {
+        fn((index)0, numElems);
+        return;
+    }
+
+    JobCounter counter;
+
+    // the first chunk is executed by the caller thread after others are added
+    for (index start = chunkSize; start < numElems; start += chunkSize)
+    {
+        const index end = (start + chunkSize < numElems) ? start + chunkSize : numElems;
+        Run([&fn, start, end]() { fn(start, end); }, &counter);
+    }
+
+    fn((index)0, chunkSize);
+    Wait(counter);
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename T, typename Fn>
+inline void ParallelFor(cvector<T>& arr, const index grain, Fn&& fn)
+{
+    // execute fn(startIdx, endIdx) for each chunk of the array on all the threads;
+    // NOTE: fn must process only elements in range [startIdx, endIdx)
+    g_JobSystem.ParallelFor(arr.size(), grain, std::forward<Fn>(fn));
+}
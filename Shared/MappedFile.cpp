@@ -0,0 +1,157 @@
+// =================================================================================
+// Filename:     MappedFile.cpp
+// Description:  implementation of the MappedFile's functional (Win32)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "MappedFile.h"
+#include "FileSystem.h"
+#include "MemHelpers.h"
+#include "log.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#pragma warning (disable : 4996)
+
+
+//---------------------------------------------------------
+// Desc:   get the file's content from mounted packs or map the file from disk
+// Args:   - filePath: path to the file
+// Ret:    true if the file's content is accessible by GetData()
+//---------------------------------------------------------
+bool MappedFile::Open(const char* filePath)
+{
+    Close();
+
+    if (!filePath || filePath[0] == '\0')
+    {
+        LogErr("input path to the file is empty");
+        return false;
+    }
+
+    const uint8* pView = nullptr;
+
+    // the pack is mapped as copy-on-write as well
+    if (FileSys::GetPackedView(filePath, pView, size_))
+    {
+        pData_    = (uint8*)pView;
+        isPacked_ = true;
+        return true;
+    }
+
+    // a compressed entry is unpacked into memory
+    if (FileSys::IsPacked(filePath))
+    {
+        if (!FileSys::ReadFile(filePath, pData_, size_))
+            return false;
+
+        isOwned_ = true;
+        return true;
+    }
+
+    return OpenOnDisk(filePath);
+}
+
+//---------------------------------------------------------
+// Desc:   map the whole file from disk into memory (packs aren't used)
+// Args:   - filePath: path to the file
+// Ret:    true if the file's content is accessible by GetData()
+//---------------------------------------------------------
+bool MappedFile::OpenOnDisk(const char* filePath)
+{
+    Close();
+
+    if (!filePath || filePath[0] == '\0')
+    {
+        LogErr("input path to the file is empty");
+        return false;
+    }
+
+    HANDLE hFile = CreateFileA(
+        filePath,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        sprintf(g_String, "can't open a file for mapping: %s", filePath);
+        LogErr(g_String);
+        return false;
+    }
+    hFile_ = hFile;
+
+    LARGE_INTEGER fileSize{};
+
+    if (!GetFileSizeEx(hFile, &fileSize) || (fileSize.QuadPart <= 0))
+    {
+        sprintf(g_String, "can't map a file (it is empty or its size is unknown): %s", filePath);
+        LogErr(g_String);
+        Close();
+        return false;
+    }
+
+    // copy-on-write: the mapped data can be changed without touching the file
+    HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+
+    if (!hMapping)
+    {
+        sprintf(g_String, "can't create a file mapping: %s", filePath);
+        LogErr(g_String);
+        Close();
+        return false;
+    }
+    hMapping_ = hMapping;
+
+    pData_ = (uint8*)MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, 0);
+
+    if (!pData_)
+    {
+        sprintf(g_String, "can't map a view of file: %s", filePath);
+        LogErr(g_String);
+        Close();
+        return false;
+    }
+
+    size_ = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   unmap the view and close handles of the file
+//---------------------------------------------------------
+void MappedFile::Close()
+{
+    if (isOwned_)
+        SafeDeleteArr(pData_);
+
+    if (isPacked_)
+        pData_ = nullptr;
+
+    isPacked_ = false;
+    isOwned_  = false;
+
+    if (pData_)
+    {
+        UnmapViewOfFile(pData_);
+        pData_ = nullptr;
+    }
+
+    if (hMapping_)
+    {
+        CloseHandle((HANDLE)hMapping_);
+        hMapping_ = nullptr;
+    }
+
+    if (hFile_)
+    {
+        CloseHandle((HANDLE)hFile_);
+        hFile_ = nullptr;
+    }
+
+    size_ = 0;
+}
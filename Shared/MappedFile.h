@@ -0,0 +1,47 @@
+// =================================================================================
+// Filename:     MappedFile.h
+// Description:  a read-only memory-mapped file: the file's content is
+//               accessible directly by a pointer without reading/copying it
+//               into a separate buffer (pages are loaded by the OS on demand);
+//
+//               NOTE: the view is mapped as copy-on-write, so the data can be
+//               modified in memory but changes never go back into the file
+//
+//               a file of mounted asset packs (see FileSys) is a view into the
+//               pack's mapping, or an unpacked copy if its entry is compressed
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Types.h"
+
+
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile() { Close(); }
+
+    // restrict a copying of this class instance
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // look for the file in mounted packs first and then on disk
+    bool Open      (const char* filePath);
+    bool OpenOnDisk(const char* filePath);
+    void Close();
+
+    inline uint8*       GetData()       { return pData_; }
+    inline const uint8* GetData() const { return pData_; }
+    inline size_t       GetSize() const { return size_; }
+    inline bool         IsOpen()  const { return pData_ != nullptr; }
+
+private:
+    void*  hFile_    = nullptr;    // HANDLE of the file
+    void*  hMapping_ = nullptr;    // HANDLE of the file mapping object
+    uint8* pData_    = nullptr;    // start of the mapped view
+    size_t size_     = 0;          // size of the file in bytes
+    bool   isPacked_ = false;      // pData_ is a view into a pack (it isn't unmapped by Close)
+    bool   isOwned_  = false;      // pData_ is an unpacked copy (released by Close)
+};
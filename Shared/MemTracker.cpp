@@ -0,0 +1,394 @@
+// =================================================================================
+// Filename:     MemTracker.cpp
+// Description:  implementation of the memory tracker and the replacement
+//               of the global new/delete (all the heap memory is tagged)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "MemTracker.h"
+#include "log.h"
+
+#include <malloc.h>
+#include <new>
+
+#pragma warning (disable : 4996)
+
+
+// a global instance of the tracker
+constinit MemTracker g_MemTracker;
+
+// the tag of memory which is allocated by the current thread
+static thread_local eMemTag s_ThreadTag = MEM_TAG_OTHER;
+
+// it is right before the memory of each tracked allocation
+struct AllocHeader
+{
+    uint64 numBytes;
+    uint32 offset;          // from the start of the real allocation to the user's memory
+    uint8  tag;
+    uint8  padding[3];
+};
+
+static_assert(sizeof(AllocHeader) == MemTracker::MIN_ALIGNMENT, "header must keep the alignment of memory");
+
+
+//---------------------------------------------------------
+// Desc:   raise the peak value if the current one is bigger
+//---------------------------------------------------------
+static void UpdatePeak(std::atomic<int64_t>& peak, const int64_t value)
+{
+    int64_t prev = peak.load(std::memory_order_relaxed);
+
+    while ((prev < value) && !peak.compare_exchange_weak(prev, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+//---------------------------------------------------------
+// Desc:   aligned allocation/release of the raw memory
+//---------------------------------------------------------
+static inline void* RawAlloc(const size_t numBytes, const size_t alignment)
+{
+#ifdef _WIN32
+    return _aligned_malloc(numBytes, alignment);
+#else
+    return aligned_alloc(alignment, (numBytes + alignment - 1) & ~(alignment - 1));
+#endif
+}
+
+static inline void RawFree(void* ptr)
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+//---------------------------------------------------------
+// Desc:   bytes in megabytes (for reports)
+//---------------------------------------------------------
+static inline double ToMB(const uint64 bytes)
+{
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+///////////////////////////////////////////////////////////
+
+void* MemTracker::Allocate(const size_t numBytes, const size_t alignment)
+{
+    return Allocate(numBytes, alignment, s_ThreadTag);
+}
+
+///////////////////////////////////////////////////////////
+
+void* MemTracker::Allocate(const size_t numBytes, const size_t alignment, const eMemTag tag)
+{
+    // the header takes the whole alignment so the user's memory stays aligned
+
+    const size_t align = (alignment > MIN_ALIGNMENT) ? alignment : MIN_ALIGNMENT;
+
+#if MEM_TRACKER_ENABLED
+    uint8* pMem = (uint8*)RawAlloc(numBytes + align, align);
+    if (!pMem)
+        return nullptr;
+
+    uint8*       pUser   = pMem + align;
+    AllocHeader* pHeader = (AllocHeader*)(pUser - sizeof(AllocHeader));
+
+    pHeader->numBytes = numBytes;
+    pHeader->offset   = (uint32)align;
+    pHeader->tag      = tag;
+
+    g_MemTracker.OnAlloc(tag, (int64_t)numBytes);
+    return pUser;
+#else
+    (void)tag;
+    return RawAlloc(numBytes, align);
+#endif
+}
+
+///////////////////////////////////////////////////////////
+
+void MemTracker::Free(void* ptr)
+{
+    if (!ptr)
+        return;
+
+#if MEM_TRACKER_ENABLED
+    uint8*             pUser   = (uint8*)ptr;
+    const AllocHeader* pHeader = (const AllocHeader*)(pUser - sizeof(AllocHeader));
+
+    g_MemTracker.OnFree((eMemTag)pHeader->tag, (int64_t)pHeader->numBytes);
+    RawFree(pUser - pHeader->offset);
+#else
+    RawFree(ptr);
+#endif
+}
+
+///////////////////////////////////////////////////////////
+
+eMemTag MemTracker::SetThreadTag(const eMemTag tag)
+{
+    const eMemTag prevTag = s_ThreadTag;
+    s_ThreadTag = tag;
+    return prevTag;
+}
+
+///////////////////////////////////////////////////////////
+
+void MemTracker::SetGpuUsage(const eGpuMemTag tag, const uint64 bytes)
+{
+    gpuCurr_[tag].store((int64_t)bytes, std::memory_order_relaxed);
+    UpdatePeak(gpuPeak_[tag], (int64_t)bytes);
+}
+
+///////////////////////////////////////////////////////////
+
+void MemTracker::AddGpu(const eGpuMemTag tag, const uint64 bytes)
+{
+    const int64_t curr = gpuCurr_[tag].fetch_add((int64_t)bytes, std::memory_order_relaxed) + (int64_t)bytes;
+    UpdatePeak(gpuPeak_[tag], curr);
+}
+
+///////////////////////////////////////////////////////////
+
+void MemTracker::RemoveGpu(const eGpuMemTag tag, const uint64 bytes)
+{
+    gpuCurr_[tag].fetch_sub((int64_t)bytes, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////
+
+void MemTracker::CheckBudgets()
+{
+    for (int i = 0; i < NUM_MEM_TAGS; ++i)
+    {
+        const eMemTag tag     = (eMemTag)i;
+        const bool    isOver  = budgets_[i] && (GetCurrent(tag) > budgets_[i]);
+
+        if (isOver && !isOverBudget_[i])
+        {
+            sprintf(g_String, "memory budget is exceeded: %s uses %.1f MB (budget %.1f MB)",
+                GetTagName(tag), ToMB(GetCurrent(tag)), ToMB(budgets_[i]));
+            LogErr(g_String);
+        }
+
+        isOverBudget_[i] = isOver;
+    }
+
+    for (int i = 0; i < NUM_GPU_MEM_TAGS; ++i)
+    {
+        const eGpuMemTag tag    = (eGpuMemTag)i;
+        const bool       isOver = gpuBudgets_[i] && (GetGpuCurrent(tag) > gpuBudgets_[i]);
+
+        if (isOver && !isGpuOverBudget_[i])
+        {
+            sprintf(g_String, "GPU memory budget is exceeded: %s uses %.1f MB (budget %.1f MB)",
+                GetGpuTagName(tag), ToMB(GetGpuCurrent(tag)), ToMB(gpuBudgets_[i]));
+            LogErr(g_String);
+        }
+
+        isGpuOverBudget_[i] = isOver;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void MemTracker::LogReport() const
+{
+    LogMsgf("memory (MB):     current      peak    budget    allocs");
+
+    for (int i = 0; i < NUM_MEM_TAGS; ++i)
+    {
+        const eMemTag tag = (eMemTag)i;
+
+        LogMsgf("  %-12s %10.2f %9.2f %9.1f %9llu",
+            GetTagName(tag),
+            ToMB(GetCurrent(tag)),
+            ToMB(GetPeak(tag)),
+            ToMB(GetBudget(tag)),
+            (unsigned long long)GetNumAllocs(tag));
+    }
+
+    LogMsgf("  %-12s %10.2f %9.2f", "total", ToMB(GetTotal()), ToMB(GetTotalPeak()));
+
+    for (int i = 0; i < NUM_GPU_MEM_TAGS; ++i)
+    {
+        const eGpuMemTag tag = (eGpuMemTag)i;
+
+        LogMsgf("  gpu %-8s %10.2f %9.2f %9.1f",
+            GetGpuTagName(tag),
+            ToMB(GetGpuCurrent(tag)),
+            ToMB(GetGpuPeak(tag)),
+            ToMB(GetGpuBudget(tag)));
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+bool MemTracker::DumpReport(const char* filePath) const
+{
+    FILE* pFile = fopen(filePath, "w");
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open a file to dump the memory report: %s", filePath);
+        LogErr(g_String);
+        return false;
+    }
+
+    WriteReport(pFile);
+    fclose(pFile);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+const char* MemTracker::GetTagName(const eMemTag tag)
+{
+    switch (tag)
+    {
+        case MEM_TAG_OTHER:    return "other";
+        case MEM_TAG_ECS:      return "ecs";
+        case MEM_TAG_MODELS:   return "models";
+        case MEM_TAG_TEXTURES: return "textures";
+        case MEM_TAG_TERRAIN:  return "terrain";
+        case MEM_TAG_RENDER:   return "render";
+        case MEM_TAG_UI:       return "ui";
+        case MEM_TAG_LOG:      return "log";
+    }
+    return "unknown";
+}
+
+///////////////////////////////////////////////////////////
+
+const char* MemTracker::GetGpuTagName(const eGpuMemTag tag)
+{
+    switch (tag)
+    {
+        case GPU_MEM_TEXTURES:       return "textures";
+        case GPU_MEM_MODELS:         return "models";
+        case GPU_MEM_TERRAIN:        return "terrain";
+        case GPU_MEM_RENDER_TARGETS: return "targets";
+    }
+    return "unknown";
+}
+
+
+// =================================================================================
+// Private methods
+// =================================================================================
+
+void MemTracker::OnAlloc(const eMemTag tag, const int64_t bytes)
+{
+    const int64_t curr  = curr_[tag].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    const int64_t total = total_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+    numAllocs_[tag].fetch_add(1, std::memory_order_relaxed);
+
+    UpdatePeak(peak_[tag], curr);
+    UpdatePeak(totalPeak_, total);
+}
+
+///////////////////////////////////////////////////////////
+
+void MemTracker::OnFree(const eMemTag tag, const int64_t bytes)
+{
+    curr_[tag].fetch_sub(bytes, std::memory_order_relaxed);
+    total_.fetch_sub(bytes, std::memory_order_relaxed);
+    numAllocs_[tag].fetch_sub(1, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////
+
+void MemTracker::WriteReport(FILE* pFile) const
+{
+    // the same table as in the log but in bytes (so it can be compared with budgets by tools)
+
+    fprintf(pFile, "%-12s %14s %14s %14s %10s\n", "cpu", "current", "peak", "budget", "allocs");
+
+    for (int i = 0; i < NUM_MEM_TAGS; ++i)
+    {
+        const eMemTag tag = (eMemTag)i;
+
+        fprintf(pFile, "%-12s %14llu %14llu %14llu %10llu\n",
+            GetTagName(tag),
+            (unsigned long long)GetCurrent(tag),
+            (unsigned long long)GetPeak(tag),
+            (unsigned long long)GetBudget(tag),
+            (unsigned long long)GetNumAllocs(tag));
+    }
+
+    fprintf(pFile, "%-12s %14llu %14llu\n\n",
+        "total",
+        (unsigned long long)GetTotal(),
+        (unsigned long long)GetTotalPeak());
+
+    fprintf(pFile, "%-12s %14s %14s %14s\n", "gpu", "current", "peak", "budget");
+
+    for (int i = 0; i < NUM_GPU_MEM_TAGS; ++i)
+    {
+        const eGpuMemTag tag = (eGpuMemTag)i;
+
+        fprintf(pFile, "%-12s %14llu %14llu %14llu\n",
+            GetGpuTagName(tag),
+            (unsigned long long)GetGpuCurrent(tag),
+            (unsigned long long)GetGpuPeak(tag),
+            (unsigned long long)GetGpuBudget(tag));
+    }
+}
+
+
+// =================================================================================
+// Replacement of the global new/delete
+// =================================================================================
+#if MEM_TRACKER_ENABLED
+
+void* operator new(size_t numBytes)
+{
+    if (void* ptr = MemTracker::Allocate(numBytes, __STDCPP_DEFAULT_NEW_ALIGNMENT__))
+        return ptr;
+
+    throw std::bad_alloc{};
+}
+
+void* operator new[](size_t numBytes)
+{
+    return operator new(numBytes);
+}
+
+void* operator new(size_t numBytes, std::align_val_t alignment)
+{
+    if (void* ptr = MemTracker::Allocate(numBytes, (size_t)alignment))
+        return ptr;
+
+    throw std::bad_alloc{};
+}
+
+void* operator new[](size_t numBytes, std::align_val_t alignment)
+{
+    return operator new(numBytes, alignment);
+}
+
+void* operator new(size_t numBytes, const std::nothrow_t&) noexcept
+{
+    return MemTracker::Allocate(numBytes, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](size_t numBytes, const std::nothrow_t&) noexcept
+{
+    return MemTracker::Allocate(numBytes, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete  (void* ptr)                                     noexcept { MemTracker::Free(ptr); }
+void operator delete[](void* ptr)                                     noexcept { MemTracker::Free(ptr); }
+void operator delete  (void* ptr, size_t)                             noexcept { MemTracker::Free(ptr); }
+void operator delete[](void* ptr, size_t)                             noexcept { MemTracker::Free(ptr); }
+void operator delete  (void* ptr, std::align_val_t)                   noexcept { MemTracker::Free(ptr); }
+void operator delete[](void* ptr, std::align_val_t)                   noexcept { MemTracker::Free(ptr); }
+void operator delete  (void* ptr, size_t, std::align_val_t)           noexcept { MemTracker::Free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t)           noexcept { MemTracker::Free(ptr); }
+void operator delete  (void* ptr, const std::nothrow_t&)              noexcept { MemTracker::Free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&)              noexcept { MemTracker::Free(ptr); }
+
+#endif // MEM_TRACKER_ENABLED
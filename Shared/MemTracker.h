@@ -0,0 +1,147 @@
+// =================================================================================
+// Filename:     MemTracker.h
+// Description:  accounting of memory by its owners (subsystems):
+//
+//               - each heap allocation (global new/delete, cvector's storage and
+//                 aligned class allocators) keeps a small header with its size and
+//                 tag so the counters of an owner are exact till the memory is freed;
+//               - the tag is taken from the current thread: a subsystem marks its
+//                 code by MEM_TAG_SCOPE(tag), untagged memory goes into MEM_TAG_OTHER;
+//               - GPU memory of textures, buffers and render targets is set by
+//                 its managers (they know the exact sizes of their resources);
+//               - current/peak values are checked against budgets (are read from
+//                 the settings per platform) and are shown by the debug editor
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Types.h"
+#include <atomic>
+#include <stdio.h>
+
+// switch off to get rid of the allocation headers and counters (the global
+// new/delete aren't replaced then and all the memory goes into MEM_TAG_OTHER)
+#ifndef MEM_TRACKER_ENABLED
+#define MEM_TRACKER_ENABLED 1
+#endif
+
+
+enum eMemTag : uint8
+{
+    MEM_TAG_OTHER,
+    MEM_TAG_ECS,
+    MEM_TAG_MODELS,
+    MEM_TAG_TEXTURES,           // CPU side: decoded images, the manager's data
+    MEM_TAG_TERRAIN,
+    MEM_TAG_RENDER,
+    MEM_TAG_UI,
+    MEM_TAG_LOG,
+
+    NUM_MEM_TAGS
+};
+
+enum eGpuMemTag : uint8
+{
+    GPU_MEM_TEXTURES,
+    GPU_MEM_MODELS,             // vertex/index buffers of models (and the geometry pool)
+    GPU_MEM_TERRAIN,
+    GPU_MEM_RENDER_TARGETS,     // frame buffers
+
+    NUM_GPU_MEM_TAGS
+};
+
+///////////////////////////////////////////////////////////
+
+class MemTracker
+{
+public:
+    static constexpr size_t MIN_ALIGNMENT = 16;
+
+    // tagged allocation (by the tag of the current thread if it isn't passed);
+    // memory must be released only by Free()
+    static void* Allocate(const size_t numBytes, const size_t alignment);
+    static void* Allocate(const size_t numBytes, const size_t alignment, const eMemTag tag);
+    static void  Free(void* ptr);
+
+    // set the tag of the current thread; return the previous one
+    static eMemTag SetThreadTag(const eMemTag tag);
+
+    // GPU memory: a manager either sets its whole usage or adds/removes a resource
+    void SetGpuUsage(const eGpuMemTag tag, const uint64 bytes);
+    void AddGpu     (const eGpuMemTag tag, const uint64 bytes);
+    void RemoveGpu  (const eGpuMemTag tag, const uint64 bytes);
+
+    // budgets in bytes (0 - no budget)
+    inline void SetBudget   (const eMemTag tag, const uint64 bytes)    { budgets_[tag] = bytes; }
+    inline void SetGpuBudget(const eGpuMemTag tag, const uint64 bytes) { gpuBudgets_[tag] = bytes; }
+
+    // log each owner which exceeded its budget (only once until it is back in the budget)
+    void CheckBudgets();
+
+    // log the report (or write it into the file) of the current/peak usage
+    void LogReport() const;
+    bool DumpReport(const char* filePath) const;
+
+    inline uint64 GetCurrent  (const eMemTag tag)    const { return (uint64)curr_[tag].load(std::memory_order_relaxed); }
+    inline uint64 GetPeak     (const eMemTag tag)    const { return (uint64)peak_[tag].load(std::memory_order_relaxed); }
+    inline uint64 GetNumAllocs(const eMemTag tag)    const { return (uint64)numAllocs_[tag].load(std::memory_order_relaxed); }
+    inline uint64 GetBudget   (const eMemTag tag)    const { return budgets_[tag]; }
+    inline uint64 GetTotal()                         const { return (uint64)total_.load(std::memory_order_relaxed); }
+    inline uint64 GetTotalPeak()                     const { return (uint64)totalPeak_.load(std::memory_order_relaxed); }
+
+    inline uint64 GetGpuCurrent(const eGpuMemTag tag) const { return (uint64)gpuCurr_[tag].load(std::memory_order_relaxed); }
+    inline uint64 GetGpuPeak   (const eGpuMemTag tag) const { return (uint64)gpuPeak_[tag].load(std::memory_order_relaxed); }
+    inline uint64 GetGpuBudget (const eGpuMemTag tag) const { return gpuBudgets_[tag]; }
+
+    static const char* GetTagName   (const eMemTag tag);
+    static const char* GetGpuTagName(const eGpuMemTag tag);
+
+private:
+    void OnAlloc(const eMemTag tag, const int64_t bytes);
+    void OnFree (const eMemTag tag, const int64_t bytes);
+    void WriteReport(FILE* pFile) const;
+
+private:
+    std::atomic<int64_t> curr_[NUM_MEM_TAGS]{};
+    std::atomic<int64_t> peak_[NUM_MEM_TAGS]{};
+    std::atomic<int64_t> numAllocs_[NUM_MEM_TAGS]{};   // alive allocations
+    std::atomic<int64_t> total_ = 0;
+    std::atomic<int64_t> totalPeak_ = 0;
+
+    std::atomic<int64_t> gpuCurr_[NUM_GPU_MEM_TAGS]{};
+    std::atomic<int64_t> gpuPeak_[NUM_GPU_MEM_TAGS]{};
+
+    uint64               budgets_[NUM_MEM_TAGS]{ 0 };
+    uint64               gpuBudgets_[NUM_GPU_MEM_TAGS]{ 0 };
+    bool                 isOverBudget_[NUM_MEM_TAGS]{ false };
+    bool                 isGpuOverBudget_[NUM_GPU_MEM_TAGS]{ false };
+};
+
+///////////////////////////////////////////////////////////
+
+// memory of the current thread is tagged until the end of the scope
+class MemTagScope
+{
+public:
+    explicit MemTagScope(const eMemTag tag) : prevTag_(MemTracker::SetThreadTag(tag)) {}
+    ~MemTagScope() { MemTracker::SetThreadTag(prevTag_); }
+
+    MemTagScope(const MemTagScope&) = delete;
+    MemTagScope& operator=(const MemTagScope&) = delete;
+
+private:
+    eMemTag prevTag_;
+};
+
+#if MEM_TRACKER_ENABLED
+    #define MEM_TAG_CONCAT_IMPL(a, b) a##b
+    #define MEM_TAG_CONCAT(a, b)      MEM_TAG_CONCAT_IMPL(a, b)
+    #define MEM_TAG_SCOPE(tag)        MemTagScope MEM_TAG_CONCAT(memTagScope_, __LINE__)(tag)
+#else
+    #define MEM_TAG_SCOPE(tag)
+#endif
+
+
+// a global instance (is constant-initialized so it works before any static constructor)
+extern MemTracker g_MemTracker;
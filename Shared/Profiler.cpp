@@ -0,0 +1,255 @@
+// =================================================================================
+// Filename:     Profiler.cpp
+// Description:  implementation of the CPU profiler
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "Profiler.h"
+#include "log.h"
+
+#include <string.h>
+
+#pragma warning (disable : 4996)
+
+
+// a global instance of the profiler
+CpuProfiler g_CpuProfiler;
+
+// the ring buffer of the current thread (is created at its first zone)
+static thread_local CpuProfiler::ThreadBuffer* s_pThreadBuffer = nullptr;
+
+
+//---------------------------------------------------------
+// Desc:  write the string into the file as a JSON string (with quotes)
+//---------------------------------------------------------
+static void WriteJsonStr(FILE* pFile, const char* str)
+{
+    fputc('"', pFile);
+
+    for (const char* ch = (str) ? str : ""; *ch; ++ch)
+    {
+        if (*ch == '"' || *ch == '\\')
+            fputc('\\', pFile);
+
+        fputc(*ch, pFile);
+    }
+
+    fputc('"', pFile);
+}
+
+///////////////////////////////////////////////////////////
+
+CpuProfiler::~CpuProfiler()
+{
+    for (ThreadBuffer*& pBuf : buffers_)
+    {
+        delete pBuf;
+        pBuf = nullptr;
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void CpuProfiler::BeginFrame()
+{
+    if (isCaptureRequested_)
+    {
+        isCaptureRequested_ = false;
+        isCapturing_        = true;
+        numFramesLeft_      = numFramesToCapture_;
+        captureBegin_       = GetTicks();
+        return;
+    }
+
+    if (isCapturing_ && (--numFramesLeft_ <= 0))
+    {
+        isCapturing_ = false;
+        WriteTrace(capturePath_, captureBegin_, GetTicks());
+    }
+}
+
+///////////////////////////////////////////////////////////
+
+void CpuProfiler::RequestCapture(const int numFrames, const char* filePath)
+{
+    if (IsCapturing())
+    {
+        LogErr("the profiler is already capturing frames");
+        return;
+    }
+
+    if (!filePath || (filePath[0] == '\0'))
+    {
+        LogErr("input path to the trace file is empty");
+        return;
+    }
+
+    strncpy(capturePath_, filePath, sizeof(capturePath_) - 1);
+    numFramesToCapture_ = (numFrames > 0) ? numFrames : 1;
+    isCaptureRequested_ = true;
+
+#if !PROFILER_ENABLED
+    LogErr("the profiler is disabled at compile time (the trace will contain no zones)");
+#endif
+}
+
+///////////////////////////////////////////////////////////
+
+void CpuProfiler::SetThreadName(const char* name)
+{
+    ThreadBuffer* pBuf = GetThreadBuffer();
+    strncpy(pBuf->name, name, sizeof(pBuf->name) - 1);
+}
+
+///////////////////////////////////////////////////////////
+
+const char* CpuProfiler::GetThreadName()
+{
+    return GetThreadBuffer()->name;
+}
+
+///////////////////////////////////////////////////////////
+
+void CpuProfiler::WriteTrace(const char* filePath, const int64_t captureBegin, const int64_t captureEnd)
+{
+    // write zones which are inside the captured time range as "complete" events;
+    // NOTE: other threads keep writing while we read so if some ring is
+    //       overflowed during the capture its oldest zones are just lost
+
+    if (!filePath || (filePath[0] == '\0'))
+    {
+        LogErr("input path to the trace file is empty");
+        return;
+    }
+
+    FILE* pFile = fopen(filePath, "w");
+    if (!pFile)
+    {
+        sprintf(g_String, "can't open the trace file for writing: %s", filePath);
+        LogErr(g_String);
+        return;
+    }
+
+    fprintf(pFile, "{\"traceEvents\":[\n");
+    fprintf(pFile, "{\"ph\":\"M\",\"pid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"engine\"}}");
+
+    const uint32 numZones = WriteTraceEvents(pFile, captureBegin, captureEnd);
+
+    fprintf(pFile, "\n]}\n");
+    fclose(pFile);
+
+    sprintf(g_String, "the trace is written (zones: %u): %s", numZones, filePath);
+    LogMsg(g_String);
+}
+
+///////////////////////////////////////////////////////////
+
+uint32 CpuProfiler::WriteTraceEvents(FILE* pFile, const int64_t captureBegin, const int64_t captureEnd)
+{
+    using period = std::chrono::steady_clock::period;
+    const double ticksToUs = 1e6 * (double)period::num / (double)period::den;
+
+    std::lock_guard<std::mutex> lock(buffersMutex_);
+    uint32 numZones = 0;
+
+    for (const ThreadBuffer* pBuf : buffers_)
+    {
+        // metadata: name of the thread
+        fprintf(pFile, ",\n{\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", pBuf->threadIdx);
+        WriteJsonStr(pFile, pBuf->name);
+        fprintf(pFile, "}}");
+
+        const uint32 head  = pBuf->head.load(std::memory_order_acquire);
+        const uint32 first = (head > RING_SIZE) ? head - RING_SIZE : 0;
+
+        for (uint32 i = first; i < head; ++i)
+        {
+            const Zone& zone = pBuf->zones[i & (RING_SIZE - 1)];
+
+            if ((zone.begin < captureBegin) || (zone.end > captureEnd))
+                continue;
+
+            fprintf(pFile, ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+                pBuf->threadIdx,
+                (double)(zone.begin - captureBegin) * ticksToUs,
+                (double)(zone.end - zone.begin) * ticksToUs);
+
+            WriteJsonStr(pFile, zone.name);
+            fputc('}', pFile);
+            ++numZones;
+        }
+    }
+
+    return numZones;
+}
+
+///////////////////////////////////////////////////////////
+
+void CpuProfiler::SumZones(
+    const char* const* names,
+    const int numNames,
+    const int64_t rangeBegin,
+    const int64_t rangeEnd,
+    int64_t* outTicks)
+{
+    // zones of a thread are written by their end so we go back from the newest
+    // one until the range begin; names are compared by content (a literal
+    // can have different addresses in different modules)
+
+    for (int i = 0; i < numNames; ++i)
+        outTicks[i] = 0;
+
+    std::lock_guard<std::mutex> lock(buffersMutex_);
+
+    for (const ThreadBuffer* pBuf : buffers_)
+    {
+        const uint32 head  = pBuf->head.load(std::memory_order_acquire);
+        const uint32 first = (head > RING_SIZE) ? head - RING_SIZE : 0;
+
+        for (uint32 z = head; z > first; --z)
+        {
+            const Zone& zone = pBuf->zones[(z - 1) & (RING_SIZE - 1)];
+
+            if (zone.end < rangeBegin)
+                break;
+
+            if (zone.end > rangeEnd)
+                continue;
+
+            for (int i = 0; i < numNames; ++i)
+            {
+                if ((zone.name == names[i]) || (strcmp(zone.name, names[i]) == 0))
+                {
+                    outTicks[i] += zone.end - zone.begin;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
+// =================================================================================
+//                              private methods
+// =================================================================================
+CpuProfiler::ThreadBuffer* CpuProfiler::GetThreadBuffer()
+{
+    return (s_pThreadBuffer) ? s_pThreadBuffer : RegisterThread();
+}
+
+///////////////////////////////////////////////////////////
+
+CpuProfiler::ThreadBuffer* CpuProfiler::RegisterThread()
+{
+    std::lock_guard<std::mutex> lock(buffersMutex_);
+
+    ThreadBuffer* pBuf = new ThreadBuffer();
+    pBuf->threadIdx = (uint32)buffers_.size();
+    snprintf(pBuf->name, sizeof(pBuf->name), "thread %u", pBuf->threadIdx);
+
+    buffers_.push_back(pBuf);
+    s_pThreadBuffer = pBuf;
+
+    return pBuf;
+}
+
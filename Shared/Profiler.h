@@ -0,0 +1,164 @@
+// =================================================================================
+// Filename:     Profiler.h
+// Description:  a lightweight hierarchical CPU profiler of scoped zones:
+//
+//               - PROFILE_SCOPE("name") measures time until the end of the scope;
+//                 zones of the same thread are nested by their time ranges;
+//               - each thread writes zones into its own ring buffer (TLS) so
+//                 recording takes no locks and no allocations (the buffer is
+//                 allocated only once at the first zone of the thread);
+//               - on demand N frames are captured and dumped as a Chrome trace
+//                 JSON (open it in chrome://tracing or ui.perfetto.dev);
+//               - PROFILER_ENABLED 0 turns off all the zones at compile time
+//
+//               NOTE: zone names must be string literals (or live forever)
+//                     since only pointers to them are stored
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Types.h"
+#include "cvector.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+
+// =================================================================================
+// CPU PROFILER
+// =================================================================================
+class CpuProfiler
+{
+public:
+    static constexpr uint32 RING_SIZE = 1 << 16;              // zones per thread (must be a power of 2)
+
+    struct Zone
+    {
+        const char* name  = nullptr;
+        int64_t     begin = 0;                                // ticks of the steady clock
+        int64_t     end   = 0;
+    };
+
+    struct ThreadBuffer
+    {
+        Zone                zones[RING_SIZE];
+        std::atomic<uint32> head = 0;                         // the number of written zones
+        uint32              threadIdx = 0;
+        char                name[32]{ '\0' };
+    };
+
+public:
+    CpuProfiler() {}
+    ~CpuProfiler();
+
+    // restrict copying
+    CpuProfiler(const CpuProfiler&) = delete;
+    CpuProfiler& operator=(const CpuProfiler&) = delete;
+
+    // is called by the main thread at the start of each frame
+    // (starts/stops a requested capture)
+    void BeginFrame();
+
+    // capture the next numFrames frames and write them into the trace file
+    void RequestCapture(const int numFrames, const char* filePath);
+
+    // name of the current thread in the trace (e.g. "main", "worker 1")
+    void        SetThreadName(const char* name);
+    const char* GetThreadName();
+
+    // write zones of all the threads within the time range into the trace file
+    // (e.g. zones of the startup which is over before any capture is requested)
+    void WriteTrace(const char* filePath, const int64_t captureBegin, const int64_t captureEnd);
+
+    // write zones of the time range as events into an opened trace (each event
+    // starts with a separator so at least one event must be already written);
+    // ret: the number of written zones
+    uint32 WriteTraceEvents(FILE* pFile, const int64_t captureBegin, const int64_t captureEnd);
+
+    // sum durations (ticks) of zones of all the threads with the input names which have
+    // finished within the time range (e.g. CPU timings of a frame for the benchmark)
+    void SumZones(
+        const char* const* names,
+        const int numNames,
+        const int64_t rangeBegin,
+        const int64_t rangeEnd,
+        int64_t* outTicks);
+
+    inline bool IsCapturing() const { return isCapturing_ || isCaptureRequested_; }
+
+    inline void AddZone(const char* name, const int64_t begin, const int64_t end)
+    {
+        ThreadBuffer* pBuf = GetThreadBuffer();
+        const uint32  head = pBuf->head.load(std::memory_order_relaxed);
+
+        pBuf->zones[head & (RING_SIZE - 1)] = { name, begin, end };
+        pBuf->head.store(head + 1, std::memory_order_release);
+    }
+
+    static inline int64_t GetTicks()
+    {
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    static inline double TicksToMs(const int64_t ticks)
+    {
+        using period = std::chrono::steady_clock::period;
+        return 1e3 * (double)ticks * (double)period::num / (double)period::den;
+    }
+
+private:
+    ThreadBuffer* GetThreadBuffer();
+    ThreadBuffer* RegisterThread();
+
+private:
+    std::mutex              buffersMutex_;       // is locked only to register a thread or to dump the trace
+    cvector<ThreadBuffer*>  buffers_;
+
+    char                    capturePath_[128]{ '\0' };
+    int64_t                 captureBegin_       = 0;
+    int                     numFramesToCapture_ = 0;
+    int                     numFramesLeft_      = 0;
+    bool                    isCaptureRequested_ = false;
+    bool                    isCapturing_        = false;
+};
+
+
+// =================================================================================
+// a global instance of the profiler
+// =================================================================================
+extern CpuProfiler g_CpuProfiler;
+
+
+// =================================================================================
+// SCOPED ZONE
+// =================================================================================
+class ProfileZone
+{
+public:
+    inline ProfileZone(const char* name) : name_(name), begin_(CpuProfiler::GetTicks()) {}
+    inline ~ProfileZone() { g_CpuProfiler.AddZone(name_, begin_, CpuProfiler::GetTicks()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name_;
+    int64_t     begin_;
+};
+
+
+#if PROFILER_ENABLED
+    #define PROFILE_CONCAT_IMPL(a, b) a##b
+    #define PROFILE_CONCAT(a, b)      PROFILE_CONCAT_IMPL(a, b)
+    #define PROFILE_SCOPE(name)       ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#else
+    #define PROFILE_SCOPE(name)
+#endif
@@ -0,0 +1,242 @@
+// =================================================================================
+// Filename:     SlabPool.h
+// Description:  a pool of objects with stable addresses: objects live in
+//               fixed-size pages (slabs) which are never moved or released
+//               until the pool is cleared, so pointers/references to an object
+//               stay valid while other objects are added (e.g. by loading jobs):
+//
+//               - a slot is taken lock-free: from the free list (a tagged
+//                 stack so a reused slot isn't confused) or by bumping the number
+//                 of used slots; a new page is published into the fixed page
+//                 table by CAS (a loser of the race releases its page);
+//               - a handle is (slot idx, generation): the generation of a slot is
+//                 increased when its object is created and when it is released
+//                 (odd: alive) so a stale handle is detected by Get();
+//               - access of an alive object by its handle/idx is lock-free
+//
+//               NOTE: the owner of the slot publishes it to other threads only
+//                     after Allocate() and stops using it before Release()
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Types.h"
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+
+// =================================================================================
+// Handle
+// =================================================================================
+struct SlabHandle
+{
+    uint32 idx        = 0;
+    uint32 generation = 0;                  // 0: the invalid handle
+
+    inline bool IsValid() const { return generation != 0; }
+    inline bool operator==(const SlabHandle& rhs) const { return (idx == rhs.idx) && (generation == rhs.generation); }
+    inline bool operator!=(const SlabHandle& rhs) const { return !(*this == rhs); }
+};
+
+// =================================================================================
+// Class
+// =================================================================================
+template <typename T, uint32 PAGE_SIZE = 256, uint32 MAX_PAGES = 1024>
+class SlabPool
+{
+public:
+    static constexpr uint32 MAX_SLOTS = PAGE_SIZE * MAX_PAGES;
+
+    SlabPool() {}
+    ~SlabPool() { Clear(); }
+
+    // restrict a copying of this class instance
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    // construct an object in a free slot (may be called by several threads at once);
+    // returns the invalid handle if the pool is full
+    template <typename... Args>
+    SlabHandle Allocate(Args&&... args);
+
+    // destroy the object and return its slot into the free list (a stale handle is ignored)
+    void Release(const SlabHandle handle);
+
+    // destroy all the objects and release pages;
+    // NOTE: no other thread may use the pool at this moment
+    void Clear();
+
+    // nullptr if the handle is stale (or invalid)
+    inline T*       Get(const SlabHandle handle)           { return (IsAlive(handle)) ? GetObj(handle.idx) : nullptr; }
+    inline const T* Get(const SlabHandle handle)     const { return (IsAlive(handle)) ? GetObj(handle.idx) : nullptr; }
+
+    // access the object by a handle which is known to be alive (NOT checked)
+    inline T&       operator[](const SlabHandle handle)       { return *GetObj(handle.idx); }
+    inline const T& operator[](const SlabHandle handle) const { return *GetObj(handle.idx); }
+
+    bool IsAlive(const SlabHandle handle) const;
+
+    // the number of objects at the moment
+    inline uint32 GetNumAlive() const { return numAlive_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        alignas(T) uint8    storage[sizeof(T)];
+        std::atomic<uint32> generation = 0;     // odd: the object is alive
+        std::atomic<uint32> nextFree   = 0;     // idx+1 of the next free slot (0: the last one)
+    };
+
+    inline Slot* GetSlot(const uint32 idx) const
+    {
+        Slot* pPage = pages_[idx / PAGE_SIZE].load(std::memory_order_acquire);
+        return (pPage) ? pPage + (idx % PAGE_SIZE) : nullptr;
+    }
+
+    inline T* GetObj(const uint32 idx) const { return (T*)GetSlot(idx)->storage; }
+
+    void AcquirePage(const uint32 pageIdx);
+
+    static inline uint64 PackHead(const uint64 tag, const uint32 firstFree) { return (tag << 32) | firstFree; }
+
+private:
+    std::atomic<Slot*>  pages_[MAX_PAGES]{};
+    std::atomic<uint32> numSlots_ = 0;          // slots which were ever taken (free ones are in the list)
+    std::atomic<uint32> numAlive_ = 0;
+    std::atomic<uint64> freeHead_ = 0;          // [tag: 32 bits][idx+1 of the first free slot: 32 bits]
+};
+
+
+// =================================================================================
+// TEMPLATES IMPLEMENTATION
+// =================================================================================
+template <typename T, uint32 PAGE_SIZE, uint32 MAX_PAGES>
+template <typename... Args>
+SlabHandle SlabPool<T, PAGE_SIZE, MAX_PAGES>::Allocate(Args&&... args)
+{
+    uint32 idx  = 0;
+    uint64 head = freeHead_.load(std::memory_order_acquire);
+
+    while (true)
+    {
+        const uint32 firstFree = (uint32)(head & 0xFFFFFFFF);
+
+        // there are no free slots: take a new one (and its page if it is the first one)
+        if (firstFree == 0)
+        {
+            idx = numSlots_.fetch_add(1, std::memory_order_relaxed);
+
+            if (idx >= MAX_SLOTS)
+            {
+                numSlots_.fetch_sub(1, std::memory_order_relaxed);
+                return SlabHandle();
+            }
+
+            AcquirePage(idx / PAGE_SIZE);
+            break;
+        }
+
+        // pop the first free slot; the tag is changed by each pop/push so
+        // a slot which is popped and pushed back meanwhile fails the CAS
+        const Slot*  pSlot = GetSlot(firstFree - 1);
+        const uint64 next  = PackHead((head >> 32) + 1, pSlot->nextFree.load(std::memory_order_relaxed));
+
+        if (freeHead_.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            idx = firstFree - 1;
+            break;
+        }
+    }
+
+    Slot* pSlot = GetSlot(idx);
+    new (pSlot->storage) T(std::forward<Args>(args)...);
+
+    const uint32 generation = pSlot->generation.load(std::memory_order_relaxed) + 1;
+    pSlot->generation.store(generation, std::memory_order_release);
+    numAlive_.fetch_add(1, std::memory_order_relaxed);
+
+    return SlabHandle{ idx, generation };
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename T, uint32 PAGE_SIZE, uint32 MAX_PAGES>
+void SlabPool<T, PAGE_SIZE, MAX_PAGES>::Release(const SlabHandle handle)
+{
+    if (!IsAlive(handle))
+        return;
+
+    Slot* pSlot = GetSlot(handle.idx);
+
+    ((T*)pSlot->storage)->~T();
+    pSlot->generation.store(handle.generation + 1, std::memory_order_release);
+    numAlive_.fetch_sub(1, std::memory_order_relaxed);
+
+    // push the slot into the free list
+    uint64 head = freeHead_.load(std::memory_order_relaxed);
+    uint64 next = 0;
+
+    do
+    {
+        pSlot->nextFree.store((uint32)(head & 0xFFFFFFFF), std::memory_order_relaxed);
+        next = PackHead((head >> 32) + 1, handle.idx + 1);
+    }
+    while (!freeHead_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename T, uint32 PAGE_SIZE, uint32 MAX_PAGES>
+void SlabPool<T, PAGE_SIZE, MAX_PAGES>::Clear()
+{
+    const uint32 numSlots = numSlots_.load(std::memory_order_acquire);
+
+    for (uint32 i = 0; i < numSlots; ++i)
+    {
+        Slot* pSlot = GetSlot(i);
+
+        if (pSlot && (pSlot->generation.load(std::memory_order_relaxed) & 1))
+            ((T*)pSlot->storage)->~T();
+    }
+
+    for (std::atomic<Slot*>& page : pages_)
+    {
+        delete[] page.load(std::memory_order_relaxed);
+        page.store(nullptr, std::memory_order_relaxed);
+    }
+
+    numSlots_ = 0;
+    numAlive_ = 0;
+    freeHead_ = 0;
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename T, uint32 PAGE_SIZE, uint32 MAX_PAGES>
+bool SlabPool<T, PAGE_SIZE, MAX_PAGES>::IsAlive(const SlabHandle handle) const
+{
+    if (!handle.IsValid() || (handle.idx >= MAX_SLOTS))
+        return false;
+
+    const Slot* pSlot = GetSlot(handle.idx);
+    return pSlot && (pSlot->generation.load(std::memory_order_acquire) == handle.generation);
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename T, uint32 PAGE_SIZE, uint32 MAX_PAGES>
+void SlabPool<T, PAGE_SIZE, MAX_PAGES>::AcquirePage(const uint32 pageIdx)
+{
+    if (pages_[pageIdx].load(std::memory_order_acquire))
+        return;
+
+    Slot* pPage    = new Slot[PAGE_SIZE];
+    Slot* expected = nullptr;
+
+    // another thread could publish the page meanwhile
+    if (!pages_[pageIdx].compare_exchange_strong(expected, pPage, std::memory_order_acq_rel))
+        delete[] pPage;
+}
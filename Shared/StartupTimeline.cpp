@@ -0,0 +1,139 @@
+// =================================================================================
+// Filename:     StartupTimeline.cpp
+// Description:  implementation of the startup timeline
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "StartupTimeline.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cstring>
+
+#pragma warning (disable : 4996)
+
+
+// a global instance of the startup timeline
+StartupTimeline g_StartupTimeline;
+
+
+//---------------------------------------------------------
+// Desc:  convert a number of the steady clock ticks into milliseconds
+//---------------------------------------------------------
+static inline double TicksToMs(const int64_t ticks)
+{
+    using period = std::chrono::steady_clock::period;
+    return (double)ticks * 1e3 * (double)period::num / (double)period::den;
+}
+
+///////////////////////////////////////////////////////////
+
+void StartupTimeline::Begin()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    numPhases_  = 0;
+    numDropped_ = 0;
+    begin_      = CpuProfiler::GetTicks();
+    isActive_   = true;
+}
+
+///////////////////////////////////////////////////////////
+
+float StartupTimeline::End(const char* tracePath)
+{
+    const int64_t end = CpuProfiler::GetTicks();
+    int64_t       begin = 0;
+    float         totalMs = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!isActive_)
+        {
+            LogErr("the startup timeline isn't started");
+            return 0;
+        }
+
+        isActive_ = false;
+        begin     = begin_;
+        totalMs   = (float)TicksToMs(end - begin);
+
+        // an outer phase goes right before its nested ones
+        std::sort(phases_, phases_ + numPhases_, [](const Phase& a, const Phase& b)
+        {
+            return (a.begin != b.begin) ? (a.begin < b.begin) : (a.end > b.end);
+        });
+
+        LogMsgf(" ");
+        LogMsgf("%s------------------------------------------------------------", GREEN);
+        LogMsgf("%s                     STARTUP TIMELINE                       ", GREEN);
+        LogMsgf("%s------------------------------------------------------------", GREEN);
+        LogMsgf("  start (ms)   duration (ms)   thread       phase");
+
+        double topLevelMs = 0;
+
+        for (int i = 0; i < numPhases_; ++i)
+        {
+            const Phase& phase = phases_[i];
+            int          depth = 0;
+
+            // the number of phases of the same thread which enclose this one
+            for (int j = 0; j < i; ++j)
+            {
+                const Phase& outer = phases_[j];
+
+                if ((outer.end >= phase.end) && (strcmp(outer.threadName, phase.threadName) == 0))
+                    ++depth;
+            }
+
+            const double startMs    = TicksToMs(phase.begin - begin);
+            const double durationMs = TicksToMs(phase.end - phase.begin);
+
+            if (depth == 0)
+                topLevelMs += durationMs;
+
+            LogMsgf("  %10.1f   %13.1f   %-10s   %*s%s", startMs, durationMs, phase.threadName, depth * 2, "", phase.name);
+        }
+
+        if (numDropped_ > 0)
+            LogMsgf("  (%d phases are dropped: increase StartupTimeline::MAX_PHASES)", numDropped_);
+
+        // work of top level phases of all the threads against the wall time:
+        // everything above 1.0 is the work which was done in parallel
+        LogMsgf("startup: %.1f ms (top level phases: %.1f ms => x%.2f overlapped)",
+            totalMs,
+            topLevelMs,
+            (totalMs > 0) ? topLevelMs / totalMs : 0.0);
+        LogMsgf("%s------------------------------------------------------------\n", GREEN);
+    }
+
+    if (tracePath && (tracePath[0] != '\0'))
+        g_CpuProfiler.WriteTrace(tracePath, begin, end);
+
+    return totalMs;
+}
+
+///////////////////////////////////////////////////////////
+
+void StartupTimeline::AddPhase(const char* name, const int64_t begin, const int64_t end)
+{
+    // the name of thread is taken before locking (it can register the thread in the profiler)
+    const char* threadName = g_CpuProfiler.GetThreadName();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!isActive_)
+        return;
+
+    if (numPhases_ >= MAX_PHASES)
+    {
+        ++numDropped_;
+        return;
+    }
+
+    Phase& phase = phases_[numPhases_++];
+    phase.name   = name;
+    phase.begin  = begin;
+    phase.end    = end;
+    strncpy(phase.threadName, threadName, sizeof(phase.threadName) - 1);
+}
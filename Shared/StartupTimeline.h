@@ -0,0 +1,101 @@
+// =================================================================================
+// Filename:     StartupTimeline.h
+// Description:  a timeline of startup phases (window, device, shaders, scene, etc.):
+//
+//               - STARTUP_PHASE("name") measures a phase until the end of the scope;
+//                 phases can be nested and can be executed by any thread;
+//               - each phase is a zone of the CPU profiler as well so the whole
+//                 startup can be dumped as a Chrome trace;
+//               - at the end of the startup the breakdown of phases (start,
+//                 duration, thread) is written into the log
+//
+//               NOTE: phase names must be string literals (or live forever)
+//                     since only pointers to them are stored
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "Profiler.h"
+
+
+// =================================================================================
+// STARTUP TIMELINE
+// =================================================================================
+class StartupTimeline
+{
+public:
+    static constexpr int MAX_PHASES = 128;
+
+    struct Phase
+    {
+        const char* name  = nullptr;
+        int64_t     begin = 0;                                // ticks of the steady clock
+        int64_t     end   = 0;
+        char        threadName[32]{ '\0' };
+    };
+
+public:
+    StartupTimeline() {}
+
+    // restrict copying
+    StartupTimeline(const StartupTimeline&) = delete;
+    StartupTimeline& operator=(const StartupTimeline&) = delete;
+
+    // the startup begins (phases are recorded until End())
+    void Begin();
+
+    // write the breakdown of phases into the log and the trace of the startup
+    // into the file (if tracePath isn't empty); returns the startup duration in ms
+    float End(const char* tracePath = nullptr);
+
+    // is called by a phase when it is over (by any thread)
+    void AddPhase(const char* name, const int64_t begin, const int64_t end);
+
+private:
+    std::mutex  mutex_;
+    Phase       phases_[MAX_PHASES];
+    int         numPhases_  = 0;
+    int         numDropped_ = 0;                              // phases out of MAX_PHASES
+    int64_t     begin_      = 0;
+    bool        isActive_   = false;
+};
+
+
+// =================================================================================
+// a global instance of the startup timeline
+// =================================================================================
+extern StartupTimeline g_StartupTimeline;
+
+
+// =================================================================================
+// SCOPED PHASE
+// =================================================================================
+class StartupPhase
+{
+public:
+    inline StartupPhase(const char* name) : name_(name), begin_(CpuProfiler::GetTicks()) {}
+
+    inline ~StartupPhase()
+    {
+        const int64_t end = CpuProfiler::GetTicks();
+
+#if PROFILER_ENABLED
+        g_CpuProfiler.AddZone(name_, begin_, end);
+#endif
+        g_StartupTimeline.AddPhase(name_, begin_, end);
+    }
+
+    StartupPhase(const StartupPhase&) = delete;
+    StartupPhase& operator=(const StartupPhase&) = delete;
+
+private:
+    const char* name_;
+    int64_t     begin_;
+};
+
+
+// phases are recorded even if the profiler is disabled (the breakdown is always logged)
+#define STARTUP_CONCAT_IMPL(a, b) a##b
+#define STARTUP_CONCAT(a, b)      STARTUP_CONCAT_IMPL(a, b)
+#define STARTUP_PHASE(name)       StartupPhase STARTUP_CONCAT(startupPhase_, __LINE__)(name)
@@ -0,0 +1,158 @@
+// =================================================================================
+// Filename:     TextTokenizer.cpp
+// Description:  implementation of the TextTokenizer's functional
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#include "TextTokenizer.h"
+#include "log.h"
+
+#pragma warning (disable : 4996)
+
+
+//---------------------------------------------------------
+// Desc:   map the file and start tokenizing from its beginning
+// Args:   - filePath: path to the text file
+//---------------------------------------------------------
+bool TextTokenizer::Open(const char* filePath)
+{
+    isFailed_ = false;
+
+    if (!file_.Open(filePath))
+    {
+        SetText(nullptr, 0);
+        isFailed_ = true;
+        return false;
+    }
+
+    SetText((const char*)file_.GetData(), file_.GetSize());
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   start tokenizing of the text in memory
+//---------------------------------------------------------
+void TextTokenizer::SetText(const char* pText, const size_t length)
+{
+    pCurr_    = pText;
+    pEnd_     = (pText) ? pText + length : nullptr;
+    isFailed_ = false;
+}
+
+//---------------------------------------------------------
+// Desc:   skip whitespaces before the next token
+// Ret:    true if there are no tokens anymore
+//---------------------------------------------------------
+bool TextTokenizer::IsEnd()
+{
+    while ((pCurr_ < pEnd_) && IsSpace(*pCurr_))
+        ++pCurr_;
+
+    return pCurr_ >= pEnd_;
+}
+
+//---------------------------------------------------------
+// Desc:   get the next run of non-whitespace chars
+// Args:   - outToken:  a ptr to the first char of the token (in the text)
+//         - outLength: the number of chars of the token
+//---------------------------------------------------------
+bool TextTokenizer::Next(const char*& outToken, size_t& outLength)
+{
+    if (IsEnd())
+        return Fail();
+
+    const char* start = pCurr_;
+
+    while ((pCurr_ < pEnd_) && !IsSpace(*pCurr_))
+        ++pCurr_;
+
+    outToken  = start;
+    outLength = pCurr_ - start;
+
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   skip the number of tokens whatever they are
+//---------------------------------------------------------
+bool TextTokenizer::Skip(const int numTokens)
+{
+    const char* token  = nullptr;
+    size_t      length = 0;
+
+    for (int i = 0; i < numTokens; ++i)
+    {
+        if (!Next(token, length))
+            return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   move to the beginning of the next line
+//---------------------------------------------------------
+void TextTokenizer::SkipLine()
+{
+    while ((pCurr_ < pEnd_) && (*pCurr_ != '\n'))
+        ++pCurr_;
+}
+
+//---------------------------------------------------------
+// Desc:   read the next token and compare it with the key
+//---------------------------------------------------------
+bool TextTokenizer::Expect(const char* key)
+{
+    const char*  token  = nullptr;
+    size_t       length = 0;
+    const size_t keyLen = strlen(key);
+
+    if (!Next(token, length))
+        return false;
+
+    if ((length != keyLen) || (strncmp(token, key, keyLen) != 0))
+        return Fail();
+
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   copy the next token as a null-terminated string
+// Args:   - outStr:  a buffer for the token
+//         - bufSize: size of the buffer (with the terminating '\0')
+//---------------------------------------------------------
+bool TextTokenizer::ReadStr(char* outStr, const size_t bufSize)
+{
+    const char* token  = nullptr;
+    size_t      length = 0;
+
+    if (!outStr || (bufSize == 0))
+        return Fail();
+
+    if (!Next(token, length))
+    {
+        outStr[0] = '\0';
+        return false;
+    }
+
+    const size_t numChars = (length < bufSize - 1) ? length : bufSize - 1;
+
+    memcpy(outStr, token, numChars);
+    outStr[numChars] = '\0';
+
+    return true;
+}
+
+//---------------------------------------------------------
+// Desc:   read a string value of the "key value" record
+//---------------------------------------------------------
+bool TextTokenizer::ReadKeyStr(const char* key, char* outStr, const size_t bufSize)
+{
+    if (!Expect(key))
+    {
+        SkipLine();
+        return false;
+    }
+
+    return ReadStr(outStr, bufSize);
+}
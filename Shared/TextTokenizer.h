@@ -0,0 +1,132 @@
+// =================================================================================
+// Filename:     TextTokenizer.h
+// Description:  a fast tokenizer of text files (meshes, setup and config files):
+//               the file is memory-mapped (see MappedFile) and tokens are
+//               runs of non-whitespace chars which are parsed right in place
+//               by std::from_chars (so it isn't locale-aware and there is
+//               no allocation per token);
+//
+//               a failed read marks the tokenizer as failed (see IsFailed) so
+//               loaders can read all the values and check it only once;
+//               a "key value" record with an unexpected key is skipped till
+//               the end of its line (as if the text is read line by line)
+//
+// Created:      14.10.26  by DimaSkup
+// =================================================================================
+#pragma once
+
+#include "MappedFile.h"
+#include <charconv>
+#include <string.h>
+#include <type_traits>
+
+
+class TextTokenizer
+{
+public:
+    TextTokenizer() {}
+
+    // restrict a copying of this class instance
+    TextTokenizer(const TextTokenizer&) = delete;
+    TextTokenizer& operator=(const TextTokenizer&) = delete;
+
+    // map the whole file (mounted packs are looked for first)
+    bool Open(const char* filePath);
+
+    // tokenize a text in memory (it must be alive while it is tokenized)
+    void SetText(const char* pText, const size_t length);
+
+    // skip whitespaces; ret: true if there are no tokens anymore
+    bool IsEnd();
+
+    // get the next token as a view of the text (it isn't null-terminated)
+    bool Next(const char*& outToken, size_t& outLength);
+
+    // skip tokens (headers, separators, etc.)
+    bool Skip(const int numTokens = 1);
+
+    // skip the rest of the current line
+    void SkipLine();
+
+    // the next token must be equal to the key
+    bool Expect(const char* key);
+
+    // copy the next token into the buffer (is truncated by the buffer size)
+    bool ReadStr(char* outStr, const size_t bufSize);
+
+    template <typename T>
+    bool Read(T& outValue);
+
+    template <typename T, typename... Ts>
+    bool Read(T& outValue, Ts&... outValues);
+
+    // read values of the "key value" record (for instance: "Terrain_width: 256")
+    template <typename... Ts>
+    bool ReadKey(const char* key, Ts&... outValues);
+
+    bool ReadKeyStr(const char* key, char* outStr, const size_t bufSize);
+
+    inline bool IsFailed() const { return isFailed_; }
+
+private:
+    inline bool Fail() { isFailed_ = true; return false; }
+
+    static inline bool IsSpace(const char c)
+    {
+        return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') || (c == '\v') || (c == '\f');
+    }
+
+private:
+    MappedFile  file_;
+    const char* pCurr_    = nullptr;
+    const char* pEnd_     = nullptr;
+    bool        isFailed_ = false;
+};
+
+
+// =================================================================================
+// TEMPLATES IMPLEMENTATION
+// =================================================================================
+template <typename T>
+bool TextTokenizer::Read(T& outValue)
+{
+    const char* token  = nullptr;
+    size_t      length = 0;
+
+    if (!Next(token, length))
+        return false;
+
+    const char*                  end = token + length;
+    const std::from_chars_result res = std::from_chars(token, end, outValue);
+
+    // the whole token must be a number (floats can have the "f" suffix: "0.4f")
+    const bool isSuffix = std::is_floating_point_v<T> && (res.ptr + 1 == end) && ((*res.ptr == 'f') || (*res.ptr == 'F'));
+
+    if ((res.ec != std::errc()) || ((res.ptr != end) && !isSuffix))
+        return Fail();
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename T, typename... Ts>
+bool TextTokenizer::Read(T& outValue, Ts&... outValues)
+{
+    const bool result = Read(outValue);
+    return Read(outValues...) && result;
+}
+
+///////////////////////////////////////////////////////////
+
+template <typename... Ts>
+bool TextTokenizer::ReadKey(const char* key, Ts&... outValues)
+{
+    if (!Expect(key))
+    {
+        SkipLine();
+        return false;
+    }
+
+    return Read(outValues...);
+}
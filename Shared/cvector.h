@@ -10,6 +10,13 @@
 #include <algorithm>
 #include <utility>
 #include <stdarg.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include "MemTracker.h"
 
 
 // this macro is used for the vassert() method
@@ -25,12 +32,47 @@ using vsize = ptrdiff_t;
 static float growFactor_ = 1.5f;
 
 
+// =================================================================================
+// ALLOCATORS
+// =================================================================================
+
+// default allocator of cvector: aligned heap memory (is accounted by the tag of
+// the current thread, see MemTracker); a custom allocator (for instance: frame arena
+// or pool) must have the same static interface; memory allocated with Allocate()
+// is released only by Free()
+struct CvectorHeapAllocator
+{
+    static inline void* Allocate(const size_t numBytes, const size_t alignment)
+    {
+        return MemTracker::Allocate(numBytes, alignment);
+    }
+
+    static inline void Free(void* ptr)
+    {
+        MemTracker::Free(ptr);
+    }
+};
+
+// by default the storage is aligned at least to 16 bytes (so SIMD types like XMMATRIX are safe)
+template <typename T>
+constexpr size_t CvectorDefaultAlignment = (alignof(T) > 16) ? alignof(T) : 16;
+
+
 // =================================================================================
 // CVECTOR
 // =================================================================================
-template<typename T>
+template<typename T, typename Allocator = CvectorHeapAllocator, size_t Alignment = CvectorDefaultAlignment<T>>
 class cvector
 {
+    static_assert((Alignment & (Alignment - 1)) == 0, "alignment of cvector must be a power of 2");
+    static_assert(Alignment >= alignof(T), "alignment of cvector is less than alignment of type");
+
+    // POD elements aren't constructed/destructed at all (their memory is
+    // just zeroed when the buffer grows) and they are relocated with memcpy
+    static constexpr bool IS_POD =
+        std::is_trivially_copyable_v<T> &&
+        std::is_trivially_default_constructible_v<T>;
+
 private:
     T* data_ = nullptr;
     vsize heightMapSize_ = 0;
@@ -40,8 +82,8 @@ public:
     cvector();
     cvector(const vsize count, const T& value = T());
 
-    cvector(const cvector<T>& other);
-    cvector(cvector<T>&& other) noexcept;
+    cvector(const cvector& other);
+    cvector(cvector&& other) noexcept;
 
     cvector(std::initializer_list<T> il);
 
@@ -55,10 +97,10 @@ public:
     inline       T& operator[](index i) { return data_[i]; }    // v[i] = x
     inline const T& operator[](index i) const { return data_[i]; }    // x = v[i]
 
-    bool        operator==(const cvector<T>& rhs) const;
-    cvector<T>& operator=(const cvector<T>& rhs);
-    cvector<T>& operator=(cvector<T>&& rhs) noexcept;
-    cvector<T>& operator=(std::initializer_list<T> list);
+    bool        operator==(const cvector& rhs) const;
+    cvector& operator=(const cvector& rhs);
+    cvector& operator=(cvector&& rhs) noexcept;
+    cvector& operator=(std::initializer_list<T> list);
 
 
     // iterators
@@ -76,7 +118,7 @@ public:
     inline vsize    capacity()              const { return capacity_; }
     inline bool     is_valid_index(index i) const { return (i >= 0) && (i < heightMapSize_); };
 
-    void get_data_by_idxs(const cvector<index>& idxs, cvector<T>& outData) const;
+    void get_data_by_idxs(const cvector<index>& idxs, cvector& outData) const;
     void get_data_by_idxs(const cvector<index>& idxs, T* outData) const;
 
     // setters
@@ -88,15 +130,24 @@ public:
     void         shrink_to_fit();
     void         purge();
     void         erase(const vsize index);
+    void         erase_by_idxs(const cvector<index>& sortedIdxs);
     inline void  assign(std::initializer_list<T> il) { assign(il.begin(), il.end()); };
 
     // get index(or indices) for sorted insertion / insertion
     index get_insert_idx(const ptrdiff_t& value) const;
-    void  get_insert_idxs(const cvector<T>& values, cvector<index>& idxs) const;
+    void  get_insert_idxs(const cvector& values, cvector<index>& idxs) const;
     void  get_insert_idxs(const T* values, const vsize numValues, cvector<index>& idxs) const;
     void  insert_before(const vsize idx, const T& val);
     void  insert_before(const vsize idx, T&& value);
 
+    // batched sorted insertion with a single pass over the array (O(N + K)):
+    // merge SORTED input values into the SORTED array and output the final idx of each one;
+    // then the same idxs are used to insert records into parallel arrays with insert_by_idxs()
+    void  merge_sorted(const cvector& values, cvector<index>& outIdxs);
+    void  merge_sorted(const T* values, const vsize numValues, cvector<index>& outIdxs);
+    void  insert_by_idxs(const cvector<index>& sortedIdxs, const T* values);
+    void  insert_by_idxs(const cvector<index>& sortedIdxs, const T& value);
+
     template <typename U>
     void append_vector(U&& src);
 
@@ -113,11 +164,11 @@ public:
     index find(const T& value) const;
     index get_idx(const T& value) const;
     void get_idxs(const T* values, const vsize numElems, cvector<index>& outIdxs) const;
-    void get_idxs(const cvector<T>& values, cvector<index>& outIdxs) const;
+    void get_idxs(const cvector& values, cvector<index>& outIdxs) const;
 
     bool has_value(const T& val) const;
     bool binary_search(const T& value) const;
-    bool binary_search(const cvector<T>& vSrc) const;
+    bool binary_search(const cvector& vSrc) const;
     bool binary_search(const T* values, const vsize numElems) const;
     void binary_search(const T* values, vsize numElems, cvector<bool>& flags) const;
 
@@ -127,6 +178,10 @@ public:
     void resize(const vsize newSize);
     void resize(const vsize newSize, const T& value);
 
+    // change size without initialization of new elements (only for POD types);
+    // is used when all the elements are written right after resizing
+    void resize_uninitialized(const vsize newSize);
+
 private:
     void vassert(
         const bool condition,
@@ -146,9 +201,14 @@ private:
 
 
     void realloc_buffer_discard(const vsize newCapacity);
-    void realloc_buffer(const vsize newCapacity);
+    void realloc_buffer(const vsize newCapacity, const bool initNewElems = true);
 
-    inline void safe_delete() { if (data_) { delete[] data_; data_ = nullptr; } }
+    T*   alloc_buffer(const vsize capacity);
+    void free_buffer(T* buffer, const vsize capacity);
+
+    void spread_by_idxs(const cvector<index>& sortedIdxs);
+
+    inline void safe_delete() { if (data_) { free_buffer(data_, capacity_); data_ = nullptr; } }
 
     inline vsize GetGrownCapacity(const vsize capacity)
     {
@@ -159,8 +219,8 @@ private:
 
 // =================================================================================
 
-template <typename T>
-void cvector<T>::error_msg(
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::error_msg(
     const char* msg,
     const char* format,
     const char* fileName,
@@ -179,8 +239,8 @@ void cvector<T>::error_msg(
 // =================================================================================
 //                          constructor, destructor
 // =================================================================================
-template <typename T>
-inline cvector<T>::cvector() :
+template <typename T, typename Allocator, size_t Alignment>
+inline cvector<T, Allocator, Alignment>::cvector() :
     heightMapSize_(0),
     capacity_(0),
     data_(nullptr)
@@ -189,12 +249,12 @@ inline cvector<T>::cvector() :
 
 // ----------------------------------------------------
 
-template <typename T>
-inline cvector<T>::cvector(const vsize count, const T& value) :
+template <typename T, typename Allocator, size_t Alignment>
+inline cvector<T, Allocator, Alignment>::cvector(const vsize count, const T& value) :
     heightMapSize_(count),
     capacity_(count)
 {
-    data_ = new T[capacity_];                               // alloc memory
+    data_ = alloc_buffer(capacity_);                        // alloc memory
 
     for (vsize i = 0; i < heightMapSize_; ++i)
         data_[i] = value;                                   // init each element
@@ -202,21 +262,29 @@ inline cvector<T>::cvector(const vsize count, const T& value) :
 
 // ----------------------------------------------------
 
-template <typename T>
-inline cvector<T>::cvector(const cvector<T>& other) :
+template <typename T, typename Allocator, size_t Alignment>
+inline cvector<T, Allocator, Alignment>::cvector(const cvector& other) :
     heightMapSize_(other.heightMapSize_),
     capacity_(other.capacity_)
 {
-    data_ = new T[capacity_];
+    data_ = alloc_buffer(capacity_);
 
-    for (vsize i = 0; i < heightMapSize_; ++i)
-        data_[i] = other.data_[i];
+    if constexpr (std::is_trivially_copyable_v<T>)
+    {
+        if (heightMapSize_ > 0)
+            memcpy(data_, other.data_, heightMapSize_ * sizeof(T));
+    }
+    else
+    {
+        for (vsize i = 0; i < heightMapSize_; ++i)
+            data_[i] = other.data_[i];
+    }
 }
 
 // ----------------------------------------------------
 
-template <typename T>
-inline cvector<T>::cvector(cvector<T>&& other) noexcept :
+template <typename T, typename Allocator, size_t Alignment>
+inline cvector<T, Allocator, Alignment>::cvector(cvector&& other) noexcept :
     data_(std::exchange(other.data_, nullptr)),
     heightMapSize_(std::exchange(other.heightMapSize_, 0)),
     capacity_(std::exchange(other.capacity_, 0))
@@ -225,16 +293,16 @@ inline cvector<T>::cvector(cvector<T>&& other) noexcept :
 
 // ----------------------------------------------------
 
-template <typename T>
-inline cvector<T>::cvector(std::initializer_list<T> il) : cvector()
+template <typename T, typename Allocator, size_t Alignment>
+inline cvector<T, Allocator, Alignment>::cvector(std::initializer_list<T> il) : cvector()
 {
     assign(il.begin(), il.end());
 }
 
 // ----------------------------------------------------
 
-template <typename T>
-cvector<T>::~cvector()
+template <typename T, typename Allocator, size_t Alignment>
+cvector<T, Allocator, Alignment>::~cvector()
 {
     safe_delete();
     heightMapSize_ = 0;
@@ -243,8 +311,8 @@ cvector<T>::~cvector()
 
 // ----------------------------------------------------
 
-template <typename T>
-bool cvector<T>::operator==(const cvector<T>& rhs) const
+template <typename T, typename Allocator, size_t Alignment>
+bool cvector<T, Allocator, Alignment>::operator==(const cvector& rhs) const
 {
     // check if sizes are equal
     if (this->size() != rhs.size())
@@ -262,8 +330,8 @@ bool cvector<T>::operator==(const cvector<T>& rhs) const
 // =================================================================================
 //                  assignment: copy, move, initializer_list
 // =================================================================================
-template <typename T>
-inline cvector<T>& cvector<T>::operator=(const cvector<T>& rhs)
+template <typename T, typename Allocator, size_t Alignment>
+inline cvector<T, Allocator, Alignment>& cvector<T, Allocator, Alignment>::operator=(const cvector& rhs)
 {
     // copy assignment operator
 
@@ -276,8 +344,16 @@ inline cvector<T>& cvector<T>::operator=(const cvector<T>& rhs)
     }
 
     // copy the data
-    for (vsize i = 0; i < rhs.heightMapSize_; ++i)
-        data_[i] = rhs.data_[i];
+    if constexpr (std::is_trivially_copyable_v<T>)
+    {
+        if (rhs.heightMapSize_ > 0)
+            memcpy(data_, rhs.data_, rhs.heightMapSize_ * sizeof(T));
+    }
+    else
+    {
+        for (vsize i = 0; i < rhs.heightMapSize_; ++i)
+            data_[i] = rhs.data_[i];
+    }
 
     heightMapSize_ = rhs.heightMapSize_;
 
@@ -286,8 +362,8 @@ inline cvector<T>& cvector<T>::operator=(const cvector<T>& rhs)
 
 // ----------------------------------------------------
 
-template <typename T>
-inline cvector<T>& cvector<T>::operator=(cvector<T>&& rhs) noexcept
+template <typename T, typename Allocator, size_t Alignment>
+inline cvector<T, Allocator, Alignment>& cvector<T, Allocator, Alignment>::operator=(cvector&& rhs) noexcept
 {
     if (this == &rhs) return *this;
 
@@ -302,8 +378,8 @@ inline cvector<T>& cvector<T>::operator=(cvector<T>&& rhs) noexcept
 
 // ----------------------------------------------------
 
-template <typename T>
-cvector<T>& cvector<T>::operator=(std::initializer_list<T> list)
+template <typename T, typename Allocator, size_t Alignment>
+cvector<T, Allocator, Alignment>& cvector<T, Allocator, Alignment>::operator=(std::initializer_list<T> list)
 {
     const vsize listSize = list.size();
 
@@ -326,10 +402,10 @@ cvector<T>& cvector<T>::operator=(std::initializer_list<T> list)
 // =================================================================================
 //                           get data by indices
 // =================================================================================
-template <typename T>
-inline void cvector<T>::get_data_by_idxs(
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::get_data_by_idxs(
     const cvector<index>& idxs,
-    cvector<T>& outData) const
+    cvector& outData) const
 {
     // out:  array of data elements by input indices
 
@@ -341,8 +417,8 @@ inline void cvector<T>::get_data_by_idxs(
 
 // ----------------------------------------------------
 
-template <typename T>
-void cvector<T>::get_data_by_idxs(const cvector<index>& idxs, T* outData) const
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::get_data_by_idxs(const cvector<index>& idxs, T* outData) const
 {
     // out:  array of data elements by input indices
     // NOTE: it is supposed that idxs.size() == outData.size()
@@ -364,8 +440,8 @@ void cvector<T>::get_data_by_idxs(const cvector<index>& idxs, T* outData) const
 // =================================================================================
 //                               shift elements
 // =================================================================================
-template <typename T>
-void cvector<T>::shift_right(const index idx, const int num)
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::shift_right(const index idx, const int num)
 {
     // shift right all the elements of range [idx, end) by the num positions;
     // idx - start index of the original range
@@ -397,8 +473,8 @@ void cvector<T>::shift_right(const index idx, const int num)
 
 // ----------------------------------------------------
 
-template <typename T>
-inline void cvector<T>::shift_left(const index idx, const int num)
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::shift_left(const index idx, const int num)
 {
     // shift left all the elements of range [idx, end) by the num positions;
     // idx - start index of the original range
@@ -420,8 +496,8 @@ inline void cvector<T>::shift_left(const index idx, const int num)
 // =================================================================================                                                                                                              
 //                               public setters
 // =================================================================================
-template <typename T>
-inline void cvector<T>::push_back(const T& value)
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::push_back(const T& value)
 {
     if (heightMapSize_ == capacity_)
     {
@@ -436,8 +512,8 @@ inline void cvector<T>::push_back(const T& value)
 
 // ----------------------------------------------------
 
-template <typename T>
-inline void cvector<T>::push_back(T&& rvalue)
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::push_back(T&& rvalue)
 {
     if (heightMapSize_ == capacity_)
     {
@@ -452,8 +528,8 @@ inline void cvector<T>::push_back(T&& rvalue)
 
 // ----------------------------------------------------
 
-template <typename T>
-inline void cvector<T>::erase(const vsize index)
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::erase(const vsize index)
 {
     if constexpr (ENABLE_CHECK)
     {
@@ -472,8 +548,48 @@ inline void cvector<T>::erase(const vsize index)
 
 // ----------------------------------------------------
 
-template <typename T>
-index cvector<T>::get_insert_idx(const ptrdiff_t& value) const
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::erase_by_idxs(const cvector<index>& sortedIdxs)
+{
+    // remove elements by the input SORTED unique idxs with a single pass:
+    // each kept element is moved at most once, so removal of a batch of
+    // elements costs O(N) instead of O(N) per each removed element
+
+    const vsize numIdxs = sortedIdxs.size();
+
+    if (numIdxs == 0)
+        return;
+
+    if constexpr (ENABLE_CHECK)
+    {
+        if ((sortedIdxs[0] < 0) | (sortedIdxs[numIdxs - 1] >= heightMapSize_))
+        {
+            error_msg("invalid input args", CALLER_INFO);
+            return;
+        }
+    }
+
+    vsize writeIdx = sortedIdxs[0];
+    vsize removeIdx = 0;
+
+    for (vsize readIdx = writeIdx; readIdx < heightMapSize_; ++readIdx)
+    {
+        if ((removeIdx < numIdxs) && (sortedIdxs[removeIdx] == readIdx))
+        {
+            removeIdx++;
+            continue;
+        }
+
+        data_[writeIdx++] = std::move(data_[readIdx]);
+    }
+
+    heightMapSize_ = writeIdx;
+}
+
+// ----------------------------------------------------
+
+template <typename T, typename Allocator, size_t Alignment>
+index cvector<T, Allocator, Alignment>::get_insert_idx(const ptrdiff_t& value) const
 {
     // get position (index) into array for sorted INSERTION;
     // is used together with insert_before() method
@@ -483,8 +599,8 @@ index cvector<T>::get_insert_idx(const ptrdiff_t& value) const
 
 // ----------------------------------------------------
 
-template <typename T>
-void cvector<T>::get_insert_idxs(const cvector<T>& values, cvector<index>& idxs) const
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::get_insert_idxs(const cvector& values, cvector<index>& idxs) const
 {
     // get positions (indices) into array for sorted INSERTION;
     // is used together with insert_before() method
@@ -501,8 +617,8 @@ void cvector<T>::get_insert_idxs(const cvector<T>& values, cvector<index>& idxs)
 
 // ----------------------------------------------------
 
-template <typename T>
-void cvector<T>::get_insert_idxs(
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::get_insert_idxs(
     const T* values,
     const vsize numValues,
     cvector<index>& idxs) const
@@ -529,8 +645,8 @@ void cvector<T>::get_insert_idxs(
 
 // ----------------------------------------------------
 
-template <typename T>
-void cvector<T>::insert_before(const vsize idx, const T& value)
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::insert_before(const vsize idx, const T& value)
 {
     // insert input value before arr value by idx;
     // so input value will be right at this idx and all the rest will shift right;
@@ -562,8 +678,8 @@ void cvector<T>::insert_before(const vsize idx, const T& value)
 
 // ----------------------------------------------------
 
-template <typename T>
-void cvector<T>::insert_before(const vsize idx, T&& value)
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::insert_before(const vsize idx, T&& value)
 {
     // insert input value before arr value by idx;
     // so input value will be right at this idx and all the rest will shift right;
@@ -595,9 +711,157 @@ void cvector<T>::insert_before(const vsize idx, T&& value)
 
 // ----------------------------------------------------
 
-template <typename T>
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::merge_sorted(const cvector& values, cvector<index>& outIdxs)
+{
+    merge_sorted(values.data(), values.size(), outIdxs);
+}
+
+// ----------------------------------------------------
+
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::merge_sorted(
+    const T* values,
+    const vsize numValues,
+    cvector<index>& outIdxs)
+{
+    // merge the input SORTED values into the current SORTED array;
+    // the array grows only once and each element is moved at most once
+    // (we go from the end so there is no need in a temp buffer);
+    // equal values are placed after the existing ones (as with get_insert_idxs());
+    //
+    // out: outIdxs[i] - final position of values[i] in the array
+
+    outIdxs.resize(numValues);
+
+    if (numValues == 0)
+        return;
+
+    if constexpr (ENABLE_CHECK)
+    {
+        if ((values == nullptr) | (numValues < 0) | !std::is_sorted(values, values + numValues))
+        {
+            error_msg("invalid input args", CALLER_INFO);
+            outIdxs.clear();
+            return;
+        }
+    }
+
+    const vsize newSize = heightMapSize_ + numValues;
+
+    if (capacity_ < newSize)
+        reserve(GetGrownCapacity(newSize));
+
+    vsize readIdx  = heightMapSize_ - 1;
+    vsize writeIdx = newSize - 1;
+
+    for (vsize i = numValues - 1; i >= 0; --i)
+    {
+        while ((readIdx >= 0) && (values[i] < data_[readIdx]))
+            data_[writeIdx--] = std::move(data_[readIdx--]);
+
+        data_[writeIdx] = values[i];
+        outIdxs[i] = writeIdx--;
+    }
+
+    heightMapSize_ = newSize;
+}
+
+// ----------------------------------------------------
+
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::insert_by_idxs(const cvector<index>& sortedIdxs, const T* values)
+{
+    // insert input values so values[i] will be right at sortedIdxs[i]
+    // (idxs are final positions, for instance: from merge_sorted())
+
+    if constexpr (ENABLE_CHECK)
+    {
+        if ((values == nullptr) & (sortedIdxs.size() > 0))
+        {
+            error_msg("invalid input args", CALLER_INFO);
+            return;
+        }
+    }
+
+    spread_by_idxs(sortedIdxs);
+
+    for (vsize i = 0; i < sortedIdxs.size(); ++i)
+        data_[sortedIdxs[i]] = values[i];
+}
+
+// ----------------------------------------------------
+
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::insert_by_idxs(const cvector<index>& sortedIdxs, const T& value)
+{
+    // insert the same value at each of the input final positions
+
+    spread_by_idxs(sortedIdxs);
+
+    for (const index idx : sortedIdxs)
+        data_[idx] = value;
+}
+
+// ----------------------------------------------------
+
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::spread_by_idxs(const cvector<index>& sortedIdxs)
+{
+    // move existing elements to their final positions so there are
+    // "holes" right at the input SORTED unique idxs (they are filled by a caller);
+    // an old element is shifted by the number of holes before it so
+    // elements between two neighbour holes are moved as a single range
+
+    const vsize numIdxs = sortedIdxs.size();
+
+    if (numIdxs == 0)
+        return;
+
+    const vsize newSize = heightMapSize_ + numIdxs;
+
+    if constexpr (ENABLE_CHECK)
+    {
+        if ((sortedIdxs[0] < 0) | (sortedIdxs[numIdxs - 1] >= newSize))
+        {
+            error_msg("invalid input args", CALLER_INFO);
+            return;
+        }
+    }
+
+    if (capacity_ < newSize)
+        reserve(GetGrownCapacity(newSize));
+
+    vsize readEnd = heightMapSize_;
+
+    for (vsize i = numIdxs - 1; i >= 0; --i)
+    {
+        // old elements of range [readBeg, readEnd) go right after the i-th hole
+        const vsize readBeg = sortedIdxs[i] - i;
+        const vsize shift   = i + 1;
+
+        if constexpr (IS_POD)
+        {
+            if (readEnd > readBeg)
+                memmove(&data_[readBeg + shift], &data_[readBeg], (readEnd - readBeg) * sizeof(T));
+        }
+        else
+        {
+            for (vsize j = readEnd - 1; j >= readBeg; --j)
+                data_[j + shift] = std::move(data_[j]);
+        }
+
+        readEnd = readBeg;
+    }
+
+    heightMapSize_ = newSize;
+}
+
+// ----------------------------------------------------
+
+template <typename T, typename Allocator, size_t Alignment>
 template <typename U>
-void cvector<T>::append_vector(U&& src)
+void cvector<T, Allocator, Alignment>::append_vector(U&& src)
 {
     // move or copy the input cvector at the end of 
     // the current one (append one to another)
@@ -637,9 +901,9 @@ void cvector<T>::append_vector(U&& src)
 
 // ----------------------------------------------------
 
-template <typename T>
+template <typename T, typename Allocator, size_t Alignment>
 template <typename Iter>
-inline void cvector<T>::assign(Iter first, Iter last)
+inline void cvector<T, Allocator, Alignment>::assign(Iter first, Iter last)
 {
     vsize const sz = vsize(last - first);
     if (heightMapSize_ < sz) resize(sz);
@@ -652,8 +916,8 @@ inline void cvector<T>::assign(Iter first, Iter last)
 // =================================================================================
 //                                  search
 // =================================================================================
-template <typename T>
-inline index cvector<T>::find(const T& val) const
+template <typename T, typename Allocator, size_t Alignment>
+inline index cvector<T, Allocator, Alignment>::find(const T& val) const
 {
     // NOTE:  is used for a cvector of RANDOMLY placed values;
     // DESC:  find first matching val and return its index;
@@ -666,8 +930,8 @@ inline index cvector<T>::find(const T& val) const
 
 // ----------------------------------------------------
 
-template <typename T>
-inline index cvector<T>::get_idx(const T& val) const
+template <typename T, typename Allocator, size_t Alignment>
+inline index cvector<T, Allocator, Alignment>::get_idx(const T& val) const
 {
     // NOTE:  your (*this) cvector must be SORTED!
     // DESC:  get current position (index) into (*this) array for the input value
@@ -677,8 +941,8 @@ inline index cvector<T>::get_idx(const T& val) const
 
 // ----------------------------------------------------
 
-template <typename T>
-inline void cvector<T>::get_idxs(
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::get_idxs(
     const T* values,
     const vsize numElems,
     cvector<index>& outIdxs) const
@@ -703,9 +967,9 @@ inline void cvector<T>::get_idxs(
 
 // ----------------------------------------------------
 
-template <typename T>
-inline void cvector<T>::get_idxs(
-    const cvector<T>& values,
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::get_idxs(
+    const cvector& values,
     cvector<index>& outIdxs) const
 {
     // NOTE:  your (*this) cvector must be SORTED!
@@ -719,8 +983,8 @@ inline void cvector<T>::get_idxs(
 
 // ----------------------------------------------------
 
-template <typename T>
-inline bool cvector<T>::has_value(const T& val) const
+template <typename T, typename Allocator, size_t Alignment>
+inline bool cvector<T, Allocator, Alignment>::has_value(const T& val) const
 {
     // NOTE:  for a cvector of RANDOMLY placed values:
     // DESC:  check if (*this) cvector has such a value
@@ -730,8 +994,8 @@ inline bool cvector<T>::has_value(const T& val) const
 
 // ----------------------------------------------------
 
-template <typename T>
-inline bool cvector<T>::binary_search(const T& val) const
+template <typename T, typename Allocator, size_t Alignment>
+inline bool cvector<T, Allocator, Alignment>::binary_search(const T& val) const
 {
     // NOTE: your (*this) cvector must be SORTED!
     return std::binary_search(begin(), end(), val);
@@ -739,8 +1003,8 @@ inline bool cvector<T>::binary_search(const T& val) const
 
 // ----------------------------------------------------
 
-template <typename T>
-bool cvector<T>::binary_search(const cvector<T>& values) const
+template <typename T, typename Allocator, size_t Alignment>
+bool cvector<T, Allocator, Alignment>::binary_search(const cvector& values) const
 {
     // NOTE: your (*this) cvector must be SORTED!
     // check if each value from the input cvector exists in the current (*this) cvector
@@ -757,8 +1021,8 @@ bool cvector<T>::binary_search(const cvector<T>& values) const
 
 // ----------------------------------------------------
 
-template <typename T>
-bool cvector<T>::binary_search(const T* values, const vsize numElems) const
+template <typename T, typename Allocator, size_t Alignment>
+bool cvector<T, Allocator, Alignment>::binary_search(const T* values, const vsize numElems) const
 {
     // NOTE: your (*this) cvector must be SORTED!
     // check if each value from the input raw array exists in the current cvector
@@ -784,8 +1048,8 @@ bool cvector<T>::binary_search(const T* values, const vsize numElems) const
 
 // ----------------------------------------------------
 
-template <typename T>
-void cvector<T>::binary_search(const T* values, vsize numElems, cvector<bool>& flags) const
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::binary_search(const T* values, vsize numElems, cvector<bool>& flags) const
 {
     // NOTE: your (*this) cvector must be SORTED!
     // check if each value from the input raw array exists and put responsible boolean-flag into output array
@@ -814,8 +1078,8 @@ void cvector<T>::binary_search(const T* values, vsize numElems, cvector<bool>& f
 // =================================================================================
 //                          change size / capacity
 // =================================================================================
-template <typename T>
-inline void cvector<T>::reserve(const vsize newCapacity)
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::reserve(const vsize newCapacity)
 {
    // printf("reserve for :%s of size %d\n", typeid(T).name(), newCapacity);
     if (capacity_ < newCapacity)
@@ -824,8 +1088,8 @@ inline void cvector<T>::reserve(const vsize newCapacity)
 
 // ----------------------------------------------------
 
-template <typename T>
-inline void cvector<T>::resize(const vsize newSize)
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::resize(const vsize newSize)
 {
     if (capacity_ < newSize)
         realloc_buffer(newSize);
@@ -835,8 +1099,21 @@ inline void cvector<T>::resize(const vsize newSize)
 
 // ----------------------------------------------------
 
-template <typename T>
-void cvector<T>::resize(const vsize newSize, const T& value)
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::resize_uninitialized(const vsize newSize)
+{
+    static_assert(IS_POD, "resize_uninitialized() can be used only for trivially copyable types");
+
+    if (capacity_ < newSize)
+        realloc_buffer(newSize, false);
+
+    heightMapSize_ = newSize * (newSize >= 0);
+}
+
+// ----------------------------------------------------
+
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::resize(const vsize newSize, const T& value)
 {
     if (capacity_ < newSize)
     {
@@ -852,8 +1129,8 @@ void cvector<T>::resize(const vsize newSize, const T& value)
 // =================================================================================
 //                            memory deallocation
 // =================================================================================
-template <typename T>
-void cvector<T>::shrink_to_fit()
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::shrink_to_fit()
 {
     // requests the removal of unused capacity. 
     // so the capacity() may be reduced to size().
@@ -864,8 +1141,8 @@ void cvector<T>::shrink_to_fit()
 
 // ----------------------------------------------------
 
-template <typename T>
-void cvector<T>::purge()
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::purge()
 {
     safe_delete();
     heightMapSize_ = 0;
@@ -876,8 +1153,8 @@ void cvector<T>::purge()
 // =================================================================================
 //                              private methods
 // =================================================================================
-template <typename T>
-void cvector<T>::vassert(
+template <typename T, typename Allocator, size_t Alignment>
+void cvector<T, Allocator, Alignment>::vassert(
     const bool condition,
     const char* msg,
     const char* format,
@@ -899,8 +1176,51 @@ void cvector<T>::vassert(
 
 // ----------------------------------------------------
 
-template <typename T>
-inline void cvector<T>::realloc_buffer_discard(const vsize newCapacity)
+template <typename T, typename Allocator, size_t Alignment>
+inline T* cvector<T, Allocator, Alignment>::alloc_buffer(const vsize capacity)
+{
+    // allocate aligned memory for capacity elements;
+    // NOTE: not POD elements are constructed for the whole capacity
+    //       (so they can be assigned right away), POD elements aren't initialized
+
+    if (capacity <= 0)
+        return nullptr;
+
+    T* buffer = (T*)Allocator::Allocate(capacity * sizeof(T), Alignment);
+
+    if (!buffer)
+        throw std::bad_alloc();
+
+    if constexpr (!IS_POD)
+    {
+        for (vsize i = 0; i < capacity; ++i)
+            new (&buffer[i]) T();
+    }
+
+    return buffer;
+}
+
+// ----------------------------------------------------
+
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::free_buffer(T* buffer, const vsize capacity)
+{
+    if (!buffer)
+        return;
+
+    if constexpr (!std::is_trivially_destructible_v<T>)
+    {
+        for (vsize i = 0; i < capacity; ++i)
+            buffer[i].~T();
+    }
+
+    Allocator::Free(buffer);
+}
+
+// ----------------------------------------------------
+
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::realloc_buffer_discard(const vsize newCapacity)
 {
     // reallocate memory for a new buffer of capacity == newCapacity
     // without saving an old data;
@@ -914,7 +1234,7 @@ inline void cvector<T>::realloc_buffer_discard(const vsize newCapacity)
         if (data_)
             safe_delete();
 
-        data_ = new T[newCapacity];
+        data_ = alloc_buffer(newCapacity);
         capacity_ = newCapacity;
     }
     catch (const std::bad_alloc& e)
@@ -926,41 +1246,47 @@ inline void cvector<T>::realloc_buffer_discard(const vsize newCapacity)
 
 // ----------------------------------------------------
 
-template <typename T>
-inline void cvector<T>::realloc_buffer(const vsize newCapacity)
+template <typename T, typename Allocator, size_t Alignment>
+inline void cvector<T, Allocator, Alignment>::realloc_buffer(const vsize newCapacity, const bool initNewElems)
 {
     // If reallocation occurs, all iterators(including the end() iterator) 
     // and all references to the elements are invalidated.
+    //
+    // initNewElems: if false the memory of POD elements after the current size
+    //               isn't zeroed (all of them will be written by the caller)
 
     try
     {
-        // if we had any data before
-        if (data_)
-        {
-            T* newData = new T[newCapacity]{};
+        T* newData = alloc_buffer(newCapacity);
 
-            // if we need to store less elements than before
-            if (newCapacity < heightMapSize_)
-                heightMapSize_ = newCapacity;
-            
+        // if we need to store less elements than before
+        if (newCapacity < heightMapSize_)
+            heightMapSize_ = newCapacity;
 
-            // TODO: test using memmove()
-            // 
-            // move necessary elements into the new buffer
+        // move necessary elements into the new buffer
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            if (heightMapSize_ > 0)
+                memcpy(newData, data_, heightMapSize_ * sizeof(T));
+        }
+        else
+        {
             for (vsize i = 0; i < heightMapSize_; ++i)
                 newData[i] = std::move(data_[i]);
-
-            // release memory from the old buffer
-            delete[] data_;
-
-            data_ = newData;
-            capacity_ = newCapacity;
         }
-        else
+
+        // value-initialize the rest of POD elements
+        if constexpr (IS_POD)
         {
-            data_ = new T[newCapacity]{};
-            capacity_ = newCapacity;
+            if (initNewElems && (newCapacity > heightMapSize_))
+                memset(newData + heightMapSize_, 0, (newCapacity - heightMapSize_) * sizeof(T));
         }
+
+        // release memory from the old buffer
+        safe_delete();
+
+        data_ = newData;
+        capacity_ = newCapacity;
     }
     catch (const std::bad_alloc& e)
     {
@@ -968,3 +1294,32 @@ inline void cvector<T>::realloc_buffer(const vsize newCapacity)
         error_msg("can't allocate memory for buffer", CALLER_INFO);
     }
 }
+
+
+// =================================================================================
+// READ-ONLY VIEW
+// =================================================================================
+
+// a read-only view over contiguous elements (for instance: all the records of
+// some component) so getters don't need to copy arrays into outputs;
+// NOTE: is valid until the viewed array is reallocated (records are added/removed)
+template <typename T>
+struct ConstSpan
+{
+    ConstSpan() {}
+    ConstSpan(const T* data, const vsize size) : data_(data), size_(size) {}
+
+    template <typename Allocator, size_t Alignment>
+    ConstSpan(const cvector<T, Allocator, Alignment>& v) : data_(v.data()), size_(v.size()) {}
+
+    inline const T& operator[](index i) const { return data_[i]; }
+
+    inline const T* begin() const { return data_; }
+    inline const T* end()   const { return data_ + size_; }
+    inline const T* data()  const { return data_; }
+    inline vsize    size()  const { return size_; }
+    inline bool     empty() const { return size_ == 0; }
+
+    const T* data_ = nullptr;
+    vsize    size_ = 0;
+};
@@ -2,29 +2,93 @@
 // Filename: Log.cpp
 // =================================================================================
 #include "Log.h"
+#include "MemTracker.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #pragma warning (disable : 4996)
 
 
 char g_String[g_StrLim]{ '\0' };                 // global buffer for characters
-char s_TmpStr[g_StrLim]{ '\0' };                 // static buffer for internal using
+
+// a message which waits in the ring buffer of its thread; the source location
+// is formatted by the writer thread (names of files/functions are literals)
+struct LogRecord
+{
+    uint64_t    seq      = 0;                    // order of the call (among all the threads)
+    long        time     = 0;                    // clock() at the moment of the call
+    LogType     type     = LOG_TYPE_MESSAGE;
+    const char* lvlText  = "";
+    const char* fileName = nullptr;              // nullptr if the message has no location
+    const char* funcName = nullptr;
+    int         codeLine = 0;
+    char        text[g_StrLim]{ '\0' };
+};
+
+// rate limiting of messages of a single call site
+struct LogRepeatSlot
+{
+    const void* key           = nullptr;         // name of the caller's file (or the format string)
+    int         codeLine      = 0;
+    long        windowStart   = 0;
+    int         count         = 0;               // the number of messages in the current window
+    int         numSuppressed = 0;               // are reported with the next message of this call site
+};
+
+// single producer (the owner thread) / single consumer (the writer thread)
+struct LogThreadBuffer
+{
+    static constexpr uint32_t CAPACITY  = 256;   // must be a power of 2
+    static constexpr int      NUM_SLOTS = 64;    // must be a power of 2
+
+    LogRecord             records[CAPACITY];
+    std::atomic<uint32_t> head = 0;              // is written by the owner thread only
+    std::atomic<uint32_t> tail = 0;              // is written by the writer thread only
+    LogRepeatSlot         repeats[NUM_SLOTS];    // is used by the owner thread only
+};
+
+// at most this number of messages of the same call site per window (the rest are suppressed)
+static constexpr int  LOG_REPEAT_LIMIT     = 20;
+static constexpr long LOG_REPEAT_WINDOW_MS = 1000;
 
 static LogStorage s_LogStorage;
-static FILE*      s_pLogFile = nullptr;     // a static descriptor of the log file 
+static FILE*      s_pLogFile = nullptr;     // a static descriptor of the log file
+
+// output of messages (by the writer thread or by the caller if there is no writer)
+// is serialized; it is recursive since helpers also log errors
+static std::recursive_mutex s_LogMutex;
+
+// ring buffers of all the threads which have logged anything (are never freed
+// while the writer is running: the owner thread has a ptr to its buffer)
+static std::mutex                                    s_BuffersMutex;
+static std::vector<std::unique_ptr<LogThreadBuffer>> s_Buffers;
+static thread_local LogThreadBuffer*                 t_pBuffer = nullptr;
+static thread_local bool                             t_IsWriterThread = false;
+
+static std::atomic<uint64_t>   s_NextSeq = 0;
+static std::atomic<bool>       s_IsWriterRunning = false;
+static std::thread             s_Writer;
+static std::mutex              s_WriterMutex;
+static std::condition_variable s_WriterCv;
 
 // helpers prototypes
 void        GetPathFromProjRoot(const char* fullPath, char* outPath);
-void        PrintHelper(const char* lvlText, const char* text, const LogType type);
+void        PushRecord(const LogType type, const char* lvlText, const char* text, const char* fileName = nullptr, const char* funcName = nullptr, const int codeLine = 0, const void* repeatKey = nullptr);
+void        WriteRecord(const LogRecord& rec);
+void        WriterLoop();
+void        DrainBuffers();
 void        PrintExceptionErrHelper(const EngineException& e, const bool showMsgBox);
 
-const char* PrepareMsg(const char* msg, const std::source_location& loc);                                 // for C++20
-const char* PrepareMsg(const char* msg, const char* fileName, const char* funcName, const int codeLine);  // for C or below C++20
-
-const char* PrepareErrMsg(const char* msg, const std::source_location& loc);
-const char* PrepareErrMsg(const char* msg, const char* fileName, const char* funcName, const int codeLine);
+void        PrepareMsg   (char* outBuf, const size_t bufSize, const char* msg, const char* fileName, const char* funcName, const int codeLine);
+void        PrepareErrMsg(char* outBuf, const size_t bufSize, const char* msg, const char* fileName, const char* funcName, const int codeLine);
 
 // =================================================================================
 
@@ -45,6 +109,10 @@ bool InitLogger(const char* logFileName)
 
     if ((s_pLogFile = fopen(logFileName, "w")) != nullptr)
     {
+        // since now messages are written by the background thread
+        s_IsWriterRunning = true;
+        s_Writer = std::thread(WriterLoop);
+
         LogMsg("the log file is created successfully");
 
         char time[9];
@@ -53,8 +121,10 @@ bool InitLogger(const char* logFileName)
         _strtime(time);
         _strtime(date);
 
-        if (s_pLogFile)
+        {
+            std::lock_guard<std::recursive_mutex> lock(s_LogMutex);
             fprintf(s_pLogFile, "%s : %s| the Log file is created\n", time, date);
+        }
         LogMsgf("-------------------------------------------\n\n");
 
         return true;
@@ -70,7 +140,19 @@ bool InitLogger(const char* logFileName)
 
 void CloseLogger()
 {
-    // print message about closing of the log file and close it
+    // write all the queued messages, print message about closing of the log file and close it
+
+    if (s_IsWriterRunning)
+    {
+        s_IsWriterRunning = false;
+        s_WriterCv.notify_one();
+        s_Writer.join();
+    }
+
+    DrainBuffers();
+
+    if (!s_pLogFile)
+        return;
 
     char time[9];
     char date[9];
@@ -78,31 +160,45 @@ void CloseLogger()
     _strtime(time);
     _strdate(date);
 
+    std::lock_guard<std::recursive_mutex> lock(s_LogMutex);
+
     fprintf(s_pLogFile, "\n-------------------------------------------\n");
     fprintf(s_pLogFile, "%s : %s| the end of the Log file\n", time, date);
 
     fflush(s_pLogFile);
     fclose(s_pLogFile);
+    s_pLogFile = nullptr;
 }
 
 ///////////////////////////////////////////////////////////
 
-void AddMsgIntoLogStorage(const char* msg, const LogType type)
+static void AddMsgIntoLogStorage(const char* msg, const LogType type)
 {
-    // add a new message into the log storage 
+    // add a new message into the log storage (the oldest one is overwritten if it's full)
 
     if (!msg || msg[0] == '\0')
         return;
 
-    int& numLogs = s_LogStorage.numLogs;
-    LogMessage& log = s_LogStorage.logs[numLogs];
-    char** buf = &log.msg;                          // get a buffer to the text of this log
+    std::lock_guard<std::mutex> lock(s_LogStorage.mutex);
+
+    int idx = 0;
+
+    if (s_LogStorage.numLogs < LogStorage::MAX_NUM_LOGS)
+    {
+        idx = (s_LogStorage.firstLog + s_LogStorage.numLogs) % LogStorage::MAX_NUM_LOGS;
+        ++s_LogStorage.numLogs;
+    }
+    else
+    {
+        idx = s_LogStorage.firstLog;
+        s_LogStorage.firstLog = (s_LogStorage.firstLog + 1) % LogStorage::MAX_NUM_LOGS;
+    }
+
+    LogMessage& log = s_LogStorage.logs[idx];
     log.type = type;                                // store the type of this log
-    
-    *buf = new char[strlen(msg) + 1]{ '\0' };
-    strcpy(*buf, msg);
-    
-    ++numLogs;
+
+    strncpy(log.msg, msg, g_StrLim - 1);
+    log.msg[g_StrLim - 1] = '\0';
 }
 
 ///////////////////////////////////////////////////////////
@@ -116,56 +212,42 @@ const LogStorage* GetLogStorage() { return &s_LogStorage; }
 // =================================================================================
 void LogMsg(const char* msg, const std::source_location& loc)
 {
-    printf("%s", GREEN);                                // setup console color
-    const char* buf = PrepareMsg(msg, loc);
-    PrintHelper("", buf, LOG_TYPE_MESSAGE);
-    printf("%s", RESET);                                // reset console color
+    PushRecord(LOG_TYPE_MESSAGE, "", msg, loc.file_name(), loc.function_name(), (int)loc.line());
 }
 
 ///////////////////////////////////////////////////////////
 
 void LogDbg(const char* msg, const std::source_location& loc)
 {
-    const char* buf = PrepareMsg(msg, loc);
-    PrintHelper("DEBUG", buf, LOG_TYPE_DEBUG);
+    PushRecord(LOG_TYPE_DEBUG, "DEBUG", msg, loc.file_name(), loc.function_name(), (int)loc.line());
 }
 
 ///////////////////////////////////////////////////////////
 
 void LogErr(const char* msg, const std::source_location& loc)
 {
-    printf("%s", RED);                                  // setup console color
-    const char* buf = PrepareErrMsg(msg, loc);
-    PrintHelper("ERROR", buf, LOG_TYPE_ERROR);
-    printf("%s", RESET);                                // reset console color
+    PushRecord(LOG_TYPE_ERROR, "ERROR", msg, loc.file_name(), loc.function_name(), (int)loc.line());
 }
 
 ///////////////////////////////////////////////////////////
 
 void LogMsg(const char* fileName, const char* funcName, const int codeLine, const char* msg)
 {
-    printf("%s", GREEN);                                // setup console color
-    const char* buf = PrepareMsg(msg, fileName, funcName, codeLine);
-    PrintHelper("", buf, LOG_TYPE_MESSAGE);
-    printf("%s", RESET);                                // reset console color
+    PushRecord(LOG_TYPE_MESSAGE, "", msg, fileName, funcName, codeLine);
 }
 
 ///////////////////////////////////////////////////////////
 
 void LogDbg(const char* fileName, const char* funcName, const int codeLine, const char* msg)
 {
-    const char* buf = PrepareMsg(msg, fileName, funcName, codeLine);
-    PrintHelper("DEBUG", buf, LOG_TYPE_DEBUG);
+    PushRecord(LOG_TYPE_DEBUG, "DEBUG", msg, fileName, funcName, codeLine);
 }
 
 ///////////////////////////////////////////////////////////
 
 void LogErr(const char* fileName, const char* funcName, const int codeLine, const char* msg)
 {
-    printf("%s", RED);                                  // setup console color
-    const char* buf = PrepareErrMsg(msg, fileName, funcName, codeLine);
-    PrintHelper("ERROR", buf, LOG_TYPE_ERROR);
-    printf("%s", RESET);                                // reset console color
+    PushRecord(LOG_TYPE_ERROR, "ERROR", msg, fileName, funcName, codeLine);
 }
 
 
@@ -174,14 +256,16 @@ void LogErr(const char* fileName, const char* funcName, const int codeLine, cons
 // =================================================================================
 void LogMsgf(const char* format, ...)
 {
+    // the message is formatted by the caller (args can't outlive the call)
+    char buf[g_StrLim]{ '\0' };
+
     va_list args;
     va_start(args, format);
-
-    vsnprintf(s_TmpStr, g_StrLim, format, args);
-    PrintHelper("", s_TmpStr, LOG_TYPE_FORMATTED);
-    printf("%s", RESET);                  // reset console color
-
+    vsnprintf(buf, g_StrLim, format, args);
     va_end(args);
+
+    // the format string is a key of the call site for the rate limiting
+    PushRecord(LOG_TYPE_FORMATTED, "", buf, nullptr, nullptr, 0, format);
 }
 
 
@@ -208,109 +292,302 @@ void LogErr(const EngineException& e, const bool showMsgBox)
 // =================================================================================
 void GetPathFromProjRoot(const char* fullPath, char* outPath)
 {
-    // return relative path from the project root
+    // return relative path from the project root;
+    // NOTE: is called while printing so it doesn't log anything itself
+
+    if (!outPath)
+        return;
+
+    outPath[0] = '\0';
 
     if ((!fullPath) || (fullPath[0] == '\0'))
-    {
-        LogErr("input path is empty!");
         return;
+
+    const char* found = strstr(fullPath, "DoorsEngine\\");
+
+    // if we found the substring we copy all the text after "DoorsEngine\"
+    if (found != nullptr)
+        strncpy(outPath, found + strlen("DoorsEngine\\"), 127);
+}
+
+///////////////////////////////////////////////////////////
+
+static LogThreadBuffer* GetThreadBuffer()
+{
+    // the ring buffer of the calling thread (is created at the first call)
+
+    if (!t_pBuffer)
+    {
+        std::unique_ptr<LogThreadBuffer> pBuffer = std::make_unique<LogThreadBuffer>();
+        t_pBuffer = pBuffer.get();
+
+        std::lock_guard<std::mutex> lock(s_BuffersMutex);
+        s_Buffers.push_back(std::move(pBuffer));
     }
 
-    if (!outPath)
+    return t_pBuffer;
+}
+
+///////////////////////////////////////////////////////////
+
+static bool CheckRepeats(LogThreadBuffer& buffer, const void* key, const int codeLine, const long time, int& outNumSuppressed)
+{
+    // rate limiting of messages from the same call site (by the owner thread);
+    // return: false if the message must be suppressed
+
+    const uintptr_t hash = ((uintptr_t)key >> 4) ^ (uintptr_t)codeLine * 31;
+    LogRepeatSlot&  slot = buffer.repeats[hash & (LogThreadBuffer::NUM_SLOTS - 1)];
+
+    outNumSuppressed = 0;
+
+    // the slot is taken by another call site
+    if ((slot.key != key) || (slot.codeLine != codeLine))
+    {
+        slot.key           = key;
+        slot.codeLine      = codeLine;
+        slot.windowStart   = time;
+        slot.count         = 0;
+        slot.numSuppressed = 0;
+    }
+
+    // the next window: report how many messages were suppressed by the previous one
+    if (time - slot.windowStart >= LOG_REPEAT_WINDOW_MS * CLOCKS_PER_SEC / 1000)
+    {
+        outNumSuppressed   = slot.numSuppressed;
+        slot.windowStart   = time;
+        slot.count         = 0;
+        slot.numSuppressed = 0;
+    }
+
+    if (slot.count >= LOG_REPEAT_LIMIT)
+    {
+        ++slot.numSuppressed;
+        return false;
+    }
+
+    ++slot.count;
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+
+void PushRecord(
+    const LogType type,
+    const char* lvlText,
+    const char* text,
+    const char* fileName,
+    const char* funcName,
+    const int codeLine,
+    const void* repeatKey)
+{
+    // put a message into the ring buffer of the calling thread (lock-free);
+    // if there is no writer thread the message is written right here;
+    // repeatKey - a key of the call site for the rate limiting (the caller's file by default)
+
+    MEM_TAG_SCOPE(MEM_TAG_LOG);
+
+    if (!text)
+        text = "";
+
+    const long time = (long)clock();
+
+    if (!s_IsWriterRunning || t_IsWriterThread)
     {
-        LogErr("in-out path == nullptr");
+        LogRecord rec;
+        rec.time     = time;
+        rec.type     = type;
+        rec.lvlText  = lvlText;
+        rec.fileName = fileName;
+        rec.funcName = funcName;
+        rec.codeLine = codeLine;
+        strncpy(rec.text, text, g_StrLim - 1);
+
+        WriteRecord(rec);
         return;
     }
 
-    const char* found = strstr(fullPath, "DoorsEngine\\");
+    LogThreadBuffer& buffer = *GetThreadBuffer();
+    const void*      key    = (repeatKey) ? repeatKey : (const void*)fileName;
+    int              numSuppressed = 0;
 
-    // if we found the substring we copy all the text after "DoorsEngine\"
-    if (found != nullptr)
-        strcpy(outPath, found + strlen("DoorsEngine\\"));
+    // messages without a call site (e.g. exceptions) aren't rate-limited
+    if (key && !CheckRepeats(buffer, key, codeLine, time, numSuppressed))
+        return;
+
+    // the buffer is full: wake the writer up and wait until it takes some messages
+    const uint32_t head = buffer.head.load(std::memory_order_relaxed);
+
+    while (head - buffer.tail.load(std::memory_order_acquire) >= LogThreadBuffer::CAPACITY)
+    {
+        s_WriterCv.notify_one();
+        std::this_thread::yield();
+    }
+
+    LogRecord& rec = buffer.records[head & (LogThreadBuffer::CAPACITY - 1)];
+    rec.seq      = s_NextSeq.fetch_add(1, std::memory_order_relaxed);
+    rec.time     = time;
+    rec.type     = type;
+    rec.lvlText  = lvlText;
+    rec.fileName = fileName;
+    rec.funcName = funcName;
+    rec.codeLine = codeLine;
+
+    if (numSuppressed > 0)
+        snprintf(rec.text, g_StrLim, "%s (%d repeats are suppressed)", text, numSuppressed);
     else
-        outPath[0] = '\0';
+    {
+        strncpy(rec.text, text, g_StrLim - 1);
+        rec.text[g_StrLim - 1] = '\0';
+    }
+
+    buffer.head.store(head + 1, std::memory_order_release);
+
+    // errors are written as soon as possible (the app can crash right after it)
+    if (type == LOG_TYPE_ERROR)
+        s_WriterCv.notify_one();
 }
 
 ///////////////////////////////////////////////////////////
 
-void PrintHelper(const char* lvlText, const char* text, const LogType type)
+void WriteRecord(const LogRecord& rec)
 {
     // a helper for printing messages into the command prompt
     // and into the Logger text file
 
-    snprintf(g_String, g_StrLim, "[%05d] %s: %s\n", clock(), lvlText, text);
-    printf(g_String);
-    AddMsgIntoLogStorage(g_String, type);
+    char text[g_StrLim]{ '\0' };
+    char line[g_StrLim]{ '\0' };
+
+    if (!rec.fileName)
+        strcpy(text, rec.text);
+
+    else if (rec.type == LOG_TYPE_ERROR)
+        PrepareErrMsg(text, g_StrLim, rec.text, rec.fileName, rec.funcName, rec.codeLine);
+
+    else
+        PrepareMsg(text, g_StrLim, rec.text, rec.fileName, rec.funcName, rec.codeLine);
+
+    snprintf(line, g_StrLim, "[%05ld] %s: %s\n", rec.time, rec.lvlText, text);
+
+    std::lock_guard<std::recursive_mutex> lock(s_LogMutex);
+
+    // setup console color
+    if (rec.type == LOG_TYPE_MESSAGE)
+        printf("%s", GREEN);
+    else if (rec.type == LOG_TYPE_ERROR)
+        printf("%s", RED);
+
+    fputs(line, stdout);
+    printf("%s", RESET);                                // reset console color
+
+    AddMsgIntoLogStorage(line, rec.type);
 
     if (s_pLogFile)
-        fprintf(s_pLogFile, g_String);
+        fputs(line, s_pLogFile);
 }
 
 ///////////////////////////////////////////////////////////
 
-const char* PrepareMsg(const char* msg, const std::source_location& loc)
+void WriterLoop()
 {
-    // prepare a message for logger and put it into the global buffer (g_String)
+    // the background thread: wake up periodically (or by an error) and write all the queued messages
 
-    char pathFromProjRoot[128]{ '\0' };
-    GetPathFromProjRoot(loc.file_name(), pathFromProjRoot);
+    t_IsWriterThread = true;
+    MEM_TAG_SCOPE(MEM_TAG_LOG);
 
-    snprintf(s_TmpStr, g_StrLim, "%s: %s() (line: %d): %s",
-        pathFromProjRoot,                           // relative path to the caller file
-        loc.function_name(),                        // a function name where we called this log-function
-        loc.line(),                                 // at what line
-        msg);
+    while (s_IsWriterRunning)
+    {
+        {
+            std::unique_lock<std::mutex> lock(s_WriterMutex);
+            s_WriterCv.wait_for(lock, std::chrono::milliseconds(10));
+        }
 
-    return s_TmpStr;
+        DrainBuffers();
+    }
 }
 
 ///////////////////////////////////////////////////////////
 
-const char* PrepareMsg(
-    const char* msg,
-    const char* fileName,
-    const char* funcName,
-    const int codeLine)
+void DrainBuffers()
 {
-    char pathFromProjRoot[128]{ '\0' };
-    GetPathFromProjRoot(fileName, pathFromProjRoot);
+    // write messages of all the ring buffers in order of calls
 
-    snprintf(s_TmpStr, g_StrLim, "%s: %s() (line: %d): %s",
-        pathFromProjRoot,                               // relative path to the caller file
-        funcName,                                       // a function name where we called this log-function
-        codeLine,                                       // at what line
-        msg);
+    static std::vector<LogThreadBuffer*> buffers;
+    static std::vector<uint32_t>         heads;
+    static std::vector<const LogRecord*> records;
+
+    std::lock_guard<std::recursive_mutex> lock(s_LogMutex);
+
+    {
+        std::lock_guard<std::mutex> buffersLock(s_BuffersMutex);
+
+        buffers.clear();
+        for (const std::unique_ptr<LogThreadBuffer>& pBuffer : s_Buffers)
+            buffers.push_back(pBuffer.get());
+    }
+
+    heads.resize(buffers.size());
+    records.clear();
+
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+        LogThreadBuffer& buffer = *buffers[i];
+        const uint32_t   tail   = buffer.tail.load(std::memory_order_relaxed);
+        heads[i]                = buffer.head.load(std::memory_order_acquire);
+
+        for (uint32_t j = tail; j != heads[i]; ++j)
+            records.push_back(&buffer.records[j & (LogThreadBuffer::CAPACITY - 1)]);
+    }
+
+    if (records.empty())
+        return;
 
-    return s_TmpStr;
+    std::sort(records.begin(), records.end(), [](const LogRecord* a, const LogRecord* b)
+    {
+        return a->seq < b->seq;
+    });
+
+    for (const LogRecord* pRec : records)
+        WriteRecord(*pRec);
+
+    // release the written records to the owner threads
+    for (size_t i = 0; i < buffers.size(); ++i)
+        buffers[i]->tail.store(heads[i], std::memory_order_release);
+
+    if (s_pLogFile)
+        fflush(s_pLogFile);
 }
 
 ///////////////////////////////////////////////////////////
 
-const char* PrepareErrMsg(const char* msg, const std::source_location& loc)
+void PrepareMsg(
+    char* outBuf,
+    const size_t bufSize,
+    const char* msg,
+    const char* fileName,
+    const char* funcName,
+    const int codeLine)
 {
-    // prepare error message to be printed in specific format
+    // prepare a message for logger and put it into the output buffer
 
     char pathFromProjRoot[128]{ '\0' };
-    GetPathFromProjRoot(loc.file_name(), pathFromProjRoot);
+    GetPathFromProjRoot(fileName, pathFromProjRoot);
 
-    snprintf(
-        s_TmpStr,
-        g_StrLim,
-        "\nFILE:  %s\n"
-        "FUNC:  %s()\n"
-        "LINE:  %d\n"
-        "MSG:   %s\n",
+    snprintf(outBuf, bufSize, "%s: %s() (line: %d): %s",
         pathFromProjRoot,                               // relative path to the caller file
-        loc.function_name(),                            // a function name where we called this log-function
-        loc.line(),                                     // at what line
+        funcName,                                       // a function name where we called this log-function
+        codeLine,                                       // at what line
         msg);
-
-    return s_TmpStr;
 }
 
 ///////////////////////////////////////////////////////////
 
-const char* PrepareErrMsg(const char* msg, const char* fileName, const char* funcName, const int codeLine)
+void PrepareErrMsg(
+    char* outBuf,
+    const size_t bufSize,
+    const char* msg,
+    const char* fileName,
+    const char* funcName,
+    const int codeLine)
 {
     // prepare error message to be printed in specific format
 
@@ -318,8 +595,8 @@ const char* PrepareErrMsg(const char* msg, const char* fileName, const char* fun
     GetPathFromProjRoot(fileName, pathFromProjRoot);
 
     snprintf(
-        s_TmpStr,
-        g_StrLim,
+        outBuf,
+        bufSize,
         "\nFILE:  %s\n"
         "FUNC:  %s()\n"
         "LINE:  %d\n"
@@ -328,8 +605,6 @@ const char* PrepareErrMsg(const char* msg, const char* fileName, const char* fun
         funcName,                                       // a function name where we called this log-function
         codeLine,                                       // at what line
         msg);
-
-    return s_TmpStr;
 }
 
 ///////////////////////////////////////////////////////////
@@ -341,7 +616,5 @@ void PrintExceptionErrHelper(const EngineException& e, const bool showMsgBox)
         MessageBoxA(NULL, e.GetConstStr(), "Error", MB_ICONERROR);
 
     // print an error msg into the console and log file
-    printf("%s", RED);                                   // setup console color
-    PrintHelper("ERROR: ", e.GetConstStr(), LOG_TYPE_ERROR);
-    printf("%s", RESET);                                 // reset console color
+    PushRecord(LOG_TYPE_ERROR, "ERROR: ", e.GetConstStr());
 }
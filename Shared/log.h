@@ -1,15 +1,26 @@
 // =================================================================================
 // Filename:    Log.h
-// Description: just logger
+// Description: just logger:
+//
+//              - a log call only copies the message (and ptrs to its source location)
+//                into a lock-free ring buffer of the calling thread; a background writer
+//                thread drains buffers of all the threads (in order of calls), formats
+//                messages and writes them into the console, the log file and the storage;
+//              - repeated messages of the same call site are rate-limited per thread;
+//              - the log storage (for the editor's console) keeps only the last messages
 // =================================================================================
 #pragma once
 
 #include <source_location>
+#include <mutex>
 #include "EngineException.h"
 
 #pragma warning (disable : 4996)
 
 
+constexpr int g_StrLim = 256;
+
+
 enum LogType
 {
     LOG_TYPE_MESSAGE,
@@ -20,16 +31,24 @@ enum LogType
 
 struct LogMessage
 {
-    char*   msg = nullptr;
+    char    msg[g_StrLim]{ '\0' };
     LogType type = LOG_TYPE_MESSAGE;
 };
 
 struct LogStorage
 {
-    // here we store log messages (preferably we may use it in the UI log printing)
+    // here we store the last log messages (for the UI log printing);
+    // it's a ring buffer so the oldest messages are overwritten by new ones
 
-    LogMessage logs[2048];
-    int        numLogs = 0;   // actual number of log messages
+    static constexpr int MAX_NUM_LOGS = 1024;
+
+    LogMessage         logs[MAX_NUM_LOGS];
+    int                firstLog = 0;      // idx of the oldest message
+    int                numLogs  = 0;      // actual number of log messages
+    mutable std::mutex mutex;             // must be locked while reading (messages are added by the writer thread)
+
+    // get a message by its order number (0 - the oldest one)
+    inline const LogMessage& GetLog(const int i) const { return logs[(firstLog + i) % MAX_NUM_LOGS]; }
 };
 
 // macros to setup console color
@@ -58,7 +77,7 @@ struct LogStorage
 
 ///////////////////////////////////////////////////////////
 
-constexpr int g_StrLim = 256;
+// NOTE: the global buffer is only for the main thread code (jobs use local buffers)
 extern char   g_String[g_StrLim];
 
 extern bool InitLogger(const char* logFileName);      // call it at the very beginning of the application